@@ -17,31 +17,104 @@
 #define MAX_CONFIG_ENTRIES 256
 #define MAX_KEY_LENGTH 64
 #define MAX_VALUE_LENGTH 1024
+#define CONFIG_HASH_BUCKETS 512  /* Power of two, twice the entry limit */
 
 typedef struct {
     char key[MAX_KEY_LENGTH];
     TinyAIConfigValue value;
     int active;  /* 1 if set, 0 if deleted or inactive */
+    unsigned hash;  /* Hash of the key */
+    int next;  /* 1 + index of the next entry in the bucket, 0 at the end */
 } ConfigEntry;
 
 static ConfigEntry configEntries[MAX_CONFIG_ENTRIES];
+static int configBuckets[CONFIG_HASH_BUCKETS];  /* 1 + index of the first entry, 0 if empty */
 static int configEntryCount = 0;
 static int configInitialized = 0;
 
+/* ----------------- Snapshot Storage ----------------- */
+
+/**
+ * A key with its value resolved to every type
+ */
+typedef struct {
+    const char *key;
+    unsigned hash;
+    int intValue;
+    float floatValue;
+    int boolValue;
+    const char *stringValue;
+} SnapshotEntry;
+
+/**
+ * Immutable view of the configuration at one generation
+ *
+ * Lookups probe an open-addressed table of entry indices. Replaced
+ * snapshots are kept on the retired list until cleanup, so readers
+ * never have to count references.
+ */
+struct TinyAIConfigSnapshot {
+    unsigned generation;
+    int count;
+    SnapshotEntry *entries;
+    int *slots;  /* 1 + entry index, 0 if empty */
+    unsigned slotMask;
+    char *text;  /* Keys and string values */
+    struct TinyAIConfigSnapshot *retired;
+};
+
+static unsigned configGeneration = 1;  /* Bumped on every change */
+static TinyAIConfigSnapshot *configSnapshot = NULL;  /* Published snapshot */
+static int configBuilding = 0;  /* Set while a thread builds a snapshot */
+
 /* ----------------- Helper Functions ----------------- */
 
+/**
+ * Hash a configuration key (FNV-1a)
+ */
+static unsigned hashConfigKey(const char *key) {
+    unsigned hash = 2166136261u;
+    while (*key) {
+        hash = (hash ^ (unsigned char)*key++) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Record a change, so the next snapshot read sees it
+ */
+static void configChanged() {
+    __atomic_add_fetch(&configGeneration, 1, __ATOMIC_RELEASE);
+}
+
 /**
  * Find a configuration entry by key
  */
 static int findConfigEntry(const char *key) {
-    for (int i = 0; i < configEntryCount; i++) {
-        if (configEntries[i].active && strcmp(configEntries[i].key, key) == 0) {
+    unsigned hash = hashConfigKey(key);
+    for (int i = configBuckets[hash & (CONFIG_HASH_BUCKETS - 1)] - 1; i >= 0;
+         i = configEntries[i].next - 1) {
+        if (configEntries[i].hash == hash && strcmp(configEntries[i].key, key) == 0) {
             return i;
         }
     }
     return -1;
 }
 
+/**
+ * Take an entry out of its bucket chain
+ */
+static void unlinkConfigEntry(int index) {
+    int *link = &configBuckets[configEntries[index].hash & (CONFIG_HASH_BUCKETS - 1)];
+    while (*link && *link - 1 != index) {
+        link = &configEntries[*link - 1].next;
+    }
+    if (*link) {
+        *link = configEntries[index].next;
+    }
+    configEntries[index].next = 0;
+}
+
 /**
  * Create a new configuration entry
  */
@@ -49,9 +122,6 @@ static int createConfigEntry(const char *key, TinyAIConfigType type) {
     /* Check if key already exists */
     int index = findConfigEntry(key);
     if (index >= 0) {
-        /* Key exists, update type */
-        configEntries[index].value.type = type;
-        
         /* Free string value if needed */
         if (type != TINYAI_CONFIG_STRING && 
             configEntries[index].value.type == TINYAI_CONFIG_STRING &&
@@ -60,50 +130,245 @@ static int createConfigEntry(const char *key, TinyAIConfigType type) {
             configEntries[index].value.value.stringValue = NULL;
         }
         
+        /* Key exists, update type */
+        if (type == TINYAI_CONFIG_STRING &&
+            configEntries[index].value.type != TINYAI_CONFIG_STRING) {
+            configEntries[index].value.value.stringValue = NULL;
+        }
+        configEntries[index].value.type = type;
+        
         return index;
     }
     
     /* Check if we have space */
     if (configEntryCount >= MAX_CONFIG_ENTRIES) {
-        /* Look for an inactive entry */
-        for (int i = 0; i < configEntryCount; i++) {
-            if (!configEntries[i].active) {
-                /* Found an inactive entry, reuse it */
-                strncpy(configEntries[i].key, key, MAX_KEY_LENGTH - 1);
-                configEntries[i].key[MAX_KEY_LENGTH - 1] = '\0';
-                configEntries[i].value.type = type;
-                configEntries[i].active = 1;
-                
-                /* Clean up possible string value */
-                if (configEntries[i].value.type == TINYAI_CONFIG_STRING &&
-                    configEntries[i].value.value.stringValue) {
-                    free(configEntries[i].value.value.stringValue);
-                    configEntries[i].value.value.stringValue = NULL;
-                }
-                
-                return i;
-            }
+        /* Look for an inactive entry; removal already freed its string */
+        index = 0;
+        while (index < configEntryCount && configEntries[index].active) {
+            index++;
         }
-        
-        /* No space available */
-        return -1;
+        if (index == configEntryCount) {
+            /* No space available */
+            return -1;
+        }
+    } else {
+        index = configEntryCount++;
     }
     
-    /* Create a new entry */
-    index = configEntryCount++;
+    /* Fill in the entry and link it into its bucket */
     strncpy(configEntries[index].key, key, MAX_KEY_LENGTH - 1);
     configEntries[index].key[MAX_KEY_LENGTH - 1] = '\0';
     configEntries[index].value.type = type;
+    configEntries[index].value.value.stringValue = NULL;
     configEntries[index].active = 1;
+    configEntries[index].hash = hashConfigKey(configEntries[index].key);
     
-    /* Initialize string value to NULL */
-    if (type == TINYAI_CONFIG_STRING) {
-        configEntries[index].value.value.stringValue = NULL;
-    }
+    int *bucket = &configBuckets[configEntries[index].hash & (CONFIG_HASH_BUCKETS - 1)];
+    configEntries[index].next = *bucket;
+    *bucket = index + 1;
     
     return index;
 }
 
+/**
+ * Resolve a value as an integer
+ */
+static int resolveInt(const TinyAIConfigValue *value, int defaultValue) {
+    switch (value->type) {
+        case TINYAI_CONFIG_INTEGER:
+            return value->value.intValue;
+        
+        case TINYAI_CONFIG_FLOAT:
+            return (int)value->value.floatValue;
+        
+        case TINYAI_CONFIG_BOOLEAN:
+            return value->value.boolValue ? 1 : 0;
+        
+        case TINYAI_CONFIG_STRING:
+            if (value->value.stringValue) {
+                return atoi(value->value.stringValue);
+            }
+            break;
+    }
+    
+    return defaultValue;
+}
+
+/**
+ * Resolve a value as a float
+ */
+static float resolveFloat(const TinyAIConfigValue *value, float defaultValue) {
+    switch (value->type) {
+        case TINYAI_CONFIG_INTEGER:
+            return (float)value->value.intValue;
+        
+        case TINYAI_CONFIG_FLOAT:
+            return value->value.floatValue;
+        
+        case TINYAI_CONFIG_BOOLEAN:
+            return value->value.boolValue ? 1.0f : 0.0f;
+        
+        case TINYAI_CONFIG_STRING:
+            if (value->value.stringValue) {
+                return atof(value->value.stringValue);
+            }
+            break;
+    }
+    
+    return defaultValue;
+}
+
+/**
+ * Resolve a value as a boolean
+ */
+static int resolveBool(const TinyAIConfigValue *value, int defaultValue) {
+    switch (value->type) {
+        case TINYAI_CONFIG_INTEGER:
+            return value->value.intValue != 0;
+        
+        case TINYAI_CONFIG_FLOAT:
+            return value->value.floatValue != 0.0f;
+        
+        case TINYAI_CONFIG_BOOLEAN:
+            return value->value.boolValue;
+        
+        case TINYAI_CONFIG_STRING:
+            if (value->value.stringValue) {
+                return strcmp(value->value.stringValue, "true") == 0 ||
+                       strcmp(value->value.stringValue, "1") == 0 ||
+                       strcmp(value->value.stringValue, "yes") == 0 ||
+                       strcmp(value->value.stringValue, "y") == 0 ||
+                       strcmp(value->value.stringValue, "on") == 0;
+            }
+            break;
+    }
+    
+    return defaultValue;
+}
+
+/**
+ * Resolve a value as a string, formatting numbers into buffer
+ *
+ * @return The string, or NULL for a string entry without a value
+ */
+static const char* resolveString(const TinyAIConfigValue *value, char *buffer, size_t size) {
+    switch (value->type) {
+        case TINYAI_CONFIG_INTEGER:
+            snprintf(buffer, size, "%d", value->value.intValue);
+            return buffer;
+        
+        case TINYAI_CONFIG_FLOAT:
+            snprintf(buffer, size, "%f", value->value.floatValue);
+            return buffer;
+        
+        case TINYAI_CONFIG_BOOLEAN:
+            return value->value.boolValue ? "true" : "false";
+        
+        case TINYAI_CONFIG_STRING:
+            return value->value.stringValue;
+    }
+    
+    return NULL;
+}
+
+/**
+ * Free a snapshot and every snapshot it replaced
+ */
+static void freeSnapshots(TinyAIConfigSnapshot *snapshot) {
+    while (snapshot) {
+        TinyAIConfigSnapshot *retired = snapshot->retired;
+        free(snapshot->entries);
+        free(snapshot->slots);
+        free(snapshot->text);
+        free(snapshot);
+        snapshot = retired;
+    }
+}
+
+/**
+ * Build a snapshot of the active entries at the given generation
+ */
+static TinyAIConfigSnapshot* buildSnapshot(unsigned generation) {
+    TinyAIConfigSnapshot *snapshot = (TinyAIConfigSnapshot*)calloc(1, sizeof(*snapshot));
+    if (!snapshot) {
+        return NULL;
+    }
+    snapshot->generation = generation;
+    
+    /* Size the table and the text block */
+    char number[64];
+    size_t textSize = 1;
+    int count = 0;
+    for (int i = 0; i < configEntryCount; i++) {
+        const char *string = resolveString(&configEntries[i].value, number, sizeof(number));
+        if (configEntries[i].active && string) {
+            textSize += strlen(configEntries[i].key) + strlen(string) + 2;
+            count++;
+        }
+    }
+    
+    unsigned slotCount = 16;
+    while (slotCount < (unsigned)count * 2) {
+        slotCount *= 2;
+    }
+    snapshot->slotMask = slotCount - 1;
+    snapshot->entries = (SnapshotEntry*)malloc((count ? count : 1) * sizeof(SnapshotEntry));
+    snapshot->slots = (int*)calloc(slotCount, sizeof(int));
+    snapshot->text = (char*)malloc(textSize);
+    if (!snapshot->entries || !snapshot->slots || !snapshot->text) {
+        freeSnapshots(snapshot);
+        return NULL;
+    }
+    
+    /* Resolve every entry to all types once */
+    char *text = snapshot->text;
+    for (int i = 0; i < configEntryCount; i++) {
+        const TinyAIConfigValue *value = &configEntries[i].value;
+        const char *string = resolveString(value, number, sizeof(number));
+        if (!configEntries[i].active || !string) {
+            continue;
+        }
+        
+        SnapshotEntry *entry = &snapshot->entries[snapshot->count];
+        entry->key = text;
+        text += sprintf(text, "%s", configEntries[i].key) + 1;
+        entry->stringValue = text;
+        text += sprintf(text, "%s", string) + 1;
+        entry->hash = configEntries[i].hash;
+        entry->intValue = resolveInt(value, 0);
+        entry->floatValue = resolveFloat(value, 0.0f);
+        entry->boolValue = resolveBool(value, 0);
+        
+        unsigned slot = entry->hash & snapshot->slotMask;
+        while (snapshot->slots[slot]) {
+            slot = (slot + 1) & snapshot->slotMask;
+        }
+        snapshot->slots[slot] = ++snapshot->count;
+    }
+    
+    return snapshot;
+}
+
+/**
+ * Find a key in a snapshot
+ */
+static const SnapshotEntry* findSnapshotEntry(const TinyAIConfigSnapshot *snapshot,
+                                              const char *key) {
+    if (!snapshot || !key) {
+        return NULL;
+    }
+    
+    unsigned hash = hashConfigKey(key);
+    for (unsigned slot = hash & snapshot->slotMask; snapshot->slots[slot];
+         slot = (slot + 1) & snapshot->slotMask) {
+        const SnapshotEntry *entry = &snapshot->entries[snapshot->slots[slot] - 1];
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
 /**
  * Trim whitespace from string
  */
@@ -202,6 +467,7 @@ int tinyaiConfigInit() {
     
     /* Clear the config entries */
     memset(configEntries, 0, sizeof(configEntries));
+    memset(configBuckets, 0, sizeof(configBuckets));
     configEntryCount = 0;
     configInitialized = 1;
     
@@ -222,10 +488,15 @@ void tinyaiConfigCleanup() {
         }
     }
     
+    /* Free the published snapshot and the ones it replaced */
+    freeSnapshots(__atomic_exchange_n(&configSnapshot, NULL, __ATOMIC_ACQ_REL));
+    
     /* Reset state */
     memset(configEntries, 0, sizeof(configEntries));
+    memset(configBuckets, 0, sizeof(configBuckets));
     configEntryCount = 0;
     configInitialized = 0;
+    configChanged();
 }
 
 /**
@@ -253,6 +524,9 @@ int tinyaiConfigLoad(const char *path) {
     
     tinyaiCloseFile(file);
     
+    /* Readers pick up the reloaded values without building a snapshot */
+    tinyaiConfigPublish();
+    
     return errors ? -1 : 0;
 }
 
@@ -325,6 +599,7 @@ int tinyaiConfigSetInt(const char *key, int value) {
     }
     
     configEntries[index].value.value.intValue = value;
+    configChanged();
     
     return 0;
 }
@@ -342,24 +617,7 @@ int tinyaiConfigGetInt(const char *key, int defaultValue) {
         return defaultValue;
     }
     
-    switch (configEntries[index].value.type) {
-        case TINYAI_CONFIG_INTEGER:
-            return configEntries[index].value.value.intValue;
-        
-        case TINYAI_CONFIG_FLOAT:
-            return (int)configEntries[index].value.value.floatValue;
-        
-        case TINYAI_CONFIG_BOOLEAN:
-            return configEntries[index].value.value.boolValue ? 1 : 0;
-        
-        case TINYAI_CONFIG_STRING:
-            if (configEntries[index].value.value.stringValue) {
-                return atoi(configEntries[index].value.value.stringValue);
-            }
-            break;
-    }
-    
-    return defaultValue;
+    return resolveInt(&configEntries[index].value, defaultValue);
 }
 
 /**
@@ -378,6 +636,7 @@ int tinyaiConfigSetFloat(const char *key, float value) {
     }
     
     configEntries[index].value.value.floatValue = value;
+    configChanged();
     
     return 0;
 }
@@ -395,24 +654,7 @@ float tinyaiConfigGetFloat(const char *key, float defaultValue) {
         return defaultValue;
     }
     
-    switch (configEntries[index].value.type) {
-        case TINYAI_CONFIG_INTEGER:
-            return (float)configEntries[index].value.value.intValue;
-        
-        case TINYAI_CONFIG_FLOAT:
-            return configEntries[index].value.value.floatValue;
-        
-        case TINYAI_CONFIG_BOOLEAN:
-            return configEntries[index].value.value.boolValue ? 1.0f : 0.0f;
-        
-        case TINYAI_CONFIG_STRING:
-            if (configEntries[index].value.value.stringValue) {
-                return atof(configEntries[index].value.value.stringValue);
-            }
-            break;
-    }
-    
-    return defaultValue;
+    return resolveFloat(&configEntries[index].value, defaultValue);
 }
 
 /**
@@ -436,16 +678,10 @@ int tinyaiConfigSetString(const char *key, const char *value) {
     }
     
     /* Copy the new value */
-    if (value) {
-        configEntries[index].value.value.stringValue = _strdup(value);
-        if (!configEntries[index].value.value.stringValue) {
-            return -1;
-        }
-    } else {
-        configEntries[index].value.value.stringValue = NULL;
-    }
+    configEntries[index].value.value.stringValue = value ? _strdup(value) : NULL;
+    configChanged();
     
-    return 0;
+    return value && !configEntries[index].value.value.stringValue ? -1 : 0;
 }
 
 /**
@@ -462,25 +698,9 @@ const char* tinyaiConfigGetString(const char *key, const char *defaultValue) {
     }
     
     static char buffer[MAX_VALUE_LENGTH];
+    const char *value = resolveString(&configEntries[index].value, buffer, sizeof(buffer));
     
-    switch (configEntries[index].value.type) {
-        case TINYAI_CONFIG_INTEGER:
-            sprintf(buffer, "%d", configEntries[index].value.value.intValue);
-            return buffer;
-        
-        case TINYAI_CONFIG_FLOAT:
-            sprintf(buffer, "%f", configEntries[index].value.value.floatValue);
-            return buffer;
-        
-        case TINYAI_CONFIG_BOOLEAN:
-            return configEntries[index].value.value.boolValue ? "true" : "false";
-        
-        case TINYAI_CONFIG_STRING:
-            return configEntries[index].value.value.stringValue ? 
-                   configEntries[index].value.value.stringValue : defaultValue;
-    }
-    
-    return defaultValue;
+    return value ? value : defaultValue;
 }
 
 /**
@@ -499,6 +719,7 @@ int tinyaiConfigSetBool(const char *key, int value) {
     }
     
     configEntries[index].value.value.boolValue = value ? 1 : 0;
+    configChanged();
     
     return 0;
 }
@@ -516,28 +737,7 @@ int tinyaiConfigGetBool(const char *key, int defaultValue) {
         return defaultValue;
     }
     
-    switch (configEntries[index].value.type) {
-        case TINYAI_CONFIG_INTEGER:
-            return configEntries[index].value.value.intValue != 0;
-        
-        case TINYAI_CONFIG_FLOAT:
-            return configEntries[index].value.value.floatValue != 0.0f;
-        
-        case TINYAI_CONFIG_BOOLEAN:
-            return configEntries[index].value.value.boolValue;
-        
-        case TINYAI_CONFIG_STRING:
-            if (configEntries[index].value.value.stringValue) {
-                return strcmp(configEntries[index].value.value.stringValue, "true") == 0 ||
-                       strcmp(configEntries[index].value.value.stringValue, "1") == 0 ||
-                       strcmp(configEntries[index].value.value.stringValue, "yes") == 0 ||
-                       strcmp(configEntries[index].value.value.stringValue, "y") == 0 ||
-                       strcmp(configEntries[index].value.value.stringValue, "on") == 0;
-            }
-            break;
-    }
-    
-    return defaultValue;
+    return resolveBool(&configEntries[index].value, defaultValue);
 }
 
 /**
@@ -571,7 +771,9 @@ int tinyaiConfigRemoveKey(const char *key) {
         configEntries[index].value.value.stringValue = NULL;
     }
     
+    unlinkConfigEntry(index);
     configEntries[index].active = 0;
+    configChanged();
     
     return 1;
 }
@@ -610,6 +812,8 @@ int tinyaiConfigSetDefaults() {
     tinyaiConfigSetString("system.version", "0.1.0");
     tinyaiConfigSetString("system.data_dir", "./data");
     tinyaiConfigSetString("system.model_dir", "./models");
+    tinyaiConfigSetInt("system.threads", 0);  /* One per online CPU */
+    tinyaiConfigSetString("system.profile", "performance");  /* Or "energy" */
     
     /* Memory settings */
     tinyaiConfigSetInt("memory.pool_size", 1024 * 1024);  /* 1MB */
@@ -707,5 +911,97 @@ int tinyaiConfigApplyCommandLine(int argc, char **argv) {
         }
     }
     
+    tinyaiConfigPublish();
+    
+    return 0;
+}
+
+/* ----------------- Snapshots ----------------- */
+
+/**
+ * Build a snapshot of the current configuration and publish it
+ */
+int tinyaiConfigPublish() {
+    unsigned generation = __atomic_load_n(&configGeneration, __ATOMIC_ACQUIRE);
+    TinyAIConfigSnapshot *snapshot = buildSnapshot(generation);
+    if (!snapshot) {
+        return -1;
+    }
+    
+    /* Readers may still hold the old snapshot, so it is retired rather than freed */
+    TinyAIConfigSnapshot *current = __atomic_load_n(&configSnapshot, __ATOMIC_ACQUIRE);
+    do {
+        snapshot->retired = current;
+    } while (!__atomic_compare_exchange_n(&configSnapshot, &current, snapshot, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    
     return 0;
 }
+
+/**
+ * Get the current configuration snapshot
+ */
+const TinyAIConfigSnapshot* tinyaiConfigSnapshot() {
+    TinyAIConfigSnapshot *snapshot = __atomic_load_n(&configSnapshot, __ATOMIC_ACQUIRE);
+    unsigned generation = __atomic_load_n(&configGeneration, __ATOMIC_ACQUIRE);
+    if (snapshot && snapshot->generation == generation) {
+        return snapshot;
+    }
+    
+    /* Stale: one thread rebuilds while the others keep the previous snapshot */
+    int idle = 0;
+    if (__atomic_compare_exchange_n(&configBuilding, &idle, 1, 0, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+        tinyaiConfigPublish();
+        __atomic_store_n(&configBuilding, 0, __ATOMIC_RELEASE);
+    } else {
+        while (!snapshot && __atomic_load_n(&configBuilding, __ATOMIC_ACQUIRE)) {
+            /* Only the very first snapshot is waited for */
+        }
+    }
+    
+    return __atomic_load_n(&configSnapshot, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Get an integer value from a snapshot
+ */
+int tinyaiConfigSnapshotGetInt(const TinyAIConfigSnapshot *snapshot, const char *key,
+                               int defaultValue) {
+    const SnapshotEntry *entry = findSnapshotEntry(snapshot, key);
+    return entry ? entry->intValue : defaultValue;
+}
+
+/**
+ * Get a float value from a snapshot
+ */
+float tinyaiConfigSnapshotGetFloat(const TinyAIConfigSnapshot *snapshot, const char *key,
+                                   float defaultValue) {
+    const SnapshotEntry *entry = findSnapshotEntry(snapshot, key);
+    return entry ? entry->floatValue : defaultValue;
+}
+
+/**
+ * Get a boolean value from a snapshot
+ */
+int tinyaiConfigSnapshotGetBool(const TinyAIConfigSnapshot *snapshot, const char *key,
+                                int defaultValue) {
+    const SnapshotEntry *entry = findSnapshotEntry(snapshot, key);
+    return entry ? entry->boolValue : defaultValue;
+}
+
+/**
+ * Get a string value from a snapshot
+ */
+const char* tinyaiConfigSnapshotGetString(const TinyAIConfigSnapshot *snapshot,
+                                          const char *key, const char *defaultValue) {
+    const SnapshotEntry *entry = findSnapshotEntry(snapshot, key);
+    return entry ? entry->stringValue : defaultValue;
+}
+
+/**
+ * Check if a snapshot has a key
+ */
+int tinyaiConfigSnapshotHasKey(const TinyAIConfigSnapshot *snapshot, const char *key) {
+    return findSnapshotEntry(snapshot, key) != NULL;
+}
@@ -33,6 +33,16 @@ typedef struct {
     } value;
 } TinyAIConfigValue;
 
+/**
+ * Immutable snapshot of the configuration
+ *
+ * Every key is resolved to all value types when the snapshot is built, so
+ * reads are a hash lookup without locks or conversions. A snapshot never
+ * changes and stays valid until tinyaiConfigCleanup(); a newer one is
+ * published whenever the configuration changes.
+ */
+typedef struct TinyAIConfigSnapshot TinyAIConfigSnapshot;
+
 /* ----------------- Configuration API ----------------- */
 
 /**
@@ -185,4 +195,81 @@ int tinyaiConfigOverride(const char *key, const char *value);
  */
 int tinyaiConfigApplyCommandLine(int argc, char **argv);
 
+/* ----------------- Configuration Snapshots ----------------- */
+
+/**
+ * Build a snapshot of the current configuration and publish it
+ * 
+ * tinyaiConfigLoad() and tinyaiConfigApplyCommandLine() publish on their
+ * own. A thread that changes keys while workers run should publish once
+ * after its changes, so workers never rebuild the snapshot themselves.
+ * 
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiConfigPublish();
+
+/**
+ * Get the current configuration snapshot
+ * 
+ * Returns the published snapshot, building it first if the configuration
+ * changed since. Workers may keep the pointer and compare it to a later
+ * call to notice changes.
+ * 
+ * @return Snapshot, or NULL if it could not be built
+ */
+const TinyAIConfigSnapshot* tinyaiConfigSnapshot();
+
+/**
+ * Get an integer value from a snapshot
+ * 
+ * @param snapshot Configuration snapshot
+ * @param key Configuration key
+ * @param defaultValue Default value if key not found
+ * @return Configuration value or default value
+ */
+int tinyaiConfigSnapshotGetInt(const TinyAIConfigSnapshot *snapshot, const char *key,
+                               int defaultValue);
+
+/**
+ * Get a float value from a snapshot
+ * 
+ * @param snapshot Configuration snapshot
+ * @param key Configuration key
+ * @param defaultValue Default value if key not found
+ * @return Configuration value or default value
+ */
+float tinyaiConfigSnapshotGetFloat(const TinyAIConfigSnapshot *snapshot, const char *key,
+                                   float defaultValue);
+
+/**
+ * Get a boolean value from a snapshot
+ * 
+ * @param snapshot Configuration snapshot
+ * @param key Configuration key
+ * @param defaultValue Default value if key not found
+ * @return Configuration value or default value
+ */
+int tinyaiConfigSnapshotGetBool(const TinyAIConfigSnapshot *snapshot, const char *key,
+                                int defaultValue);
+
+/**
+ * Get a string value from a snapshot
+ * 
+ * @param snapshot Configuration snapshot
+ * @param key Configuration key
+ * @param defaultValue Default value if key not found
+ * @return Configuration value, valid as long as the snapshot, or default value
+ */
+const char* tinyaiConfigSnapshotGetString(const TinyAIConfigSnapshot *snapshot,
+                                          const char *key, const char *defaultValue);
+
+/**
+ * Check if a snapshot has a key
+ * 
+ * @param snapshot Configuration snapshot
+ * @param key Configuration key
+ * @return 1 if key exists, 0 if not
+ */
+int tinyaiConfigSnapshotHasKey(const TinyAIConfigSnapshot *snapshot, const char *key);
+
 #endif /* TINYAI_CONFIG_H */
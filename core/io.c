@@ -28,12 +28,14 @@
 #else // POSIX
 #include <unistd.h> // For rmdir, getcwd, chdir, access
 #include <dirent.h> // For opendir, readdir, closedir
+#include <fcntl.h> // For posix_fadvise, F_NOCACHE
 #define PATH_SEPARATOR '/'
 #endif
 
 /* ----------------- Internal State & Error Handling ----------------- */
 
 static int g_lastIOError = TINYAI_IO_SUCCESS;
+static size_t g_bufferSize = TINYAI_IO_DEFAULT_BUFFER_SIZE;
 
 // Helper to map errno to TinyAI error codes
 static int mapErrnoToTinyAIError(int err) {
@@ -64,6 +66,8 @@ static void setLastErrorFromErrno() {
 struct TinyAIFile {
     FILE *fp;
     int mode; // Store the mode flags used to open
+    char *buffer; // Stream buffer of read-only files (NULL: the C library's own)
+    int64_t dropped; // Bytes already dropped from the page cache (TINYAI_FILE_DIRECT)
 };
 
 // Directory handle structure (Platform-dependent)
@@ -98,6 +102,14 @@ int tinyaiIOGetLastError() {
     return g_lastIOError;
 }
 
+void tinyaiIOSetBufferSize(size_t size) {
+    g_bufferSize = size;
+}
+
+size_t tinyaiIOGetBufferSize() {
+    return g_bufferSize;
+}
+
 const char* tinyaiIOGetErrorString(int error) {
     switch (error) {
         case TINYAI_IO_SUCCESS: return "Success";
@@ -114,6 +126,44 @@ const char* tinyaiIOGetErrorString(int error) {
 
 /* ----------------- File Operations ----------------- */
 
+// Helper to pass an access pattern hint to the OS
+static int adviseStream(FILE *fp, int64_t offset, int64_t length, int advice) {
+#if defined(POSIX_FADV_SEQUENTIAL)
+    int posixAdvice;
+    switch (advice) {
+        case TINYAI_IO_ADVICE_NORMAL: posixAdvice = POSIX_FADV_NORMAL; break;
+        case TINYAI_IO_ADVICE_SEQUENTIAL: posixAdvice = POSIX_FADV_SEQUENTIAL; break;
+        case TINYAI_IO_ADVICE_RANDOM: posixAdvice = POSIX_FADV_RANDOM; break;
+        case TINYAI_IO_ADVICE_WILLNEED: posixAdvice = POSIX_FADV_WILLNEED; break;
+        case TINYAI_IO_ADVICE_DONTNEED: posixAdvice = POSIX_FADV_DONTNEED; break;
+        default: return TINYAI_IO_INVALID;
+    }
+    // posix_fadvise returns the error rather than setting errno
+    int err = posix_fadvise(fileno(fp), (off_t)offset, (off_t)length, posixAdvice);
+    return err == 0 ? TINYAI_IO_SUCCESS : mapErrnoToTinyAIError(err);
+#else
+    // Hints are optional; systems without them just read normally
+    (void)fp;
+    (void)offset;
+    (void)length;
+    return advice >= TINYAI_IO_ADVICE_NORMAL && advice <= TINYAI_IO_ADVICE_DONTNEED
+               ? TINYAI_IO_SUCCESS
+               : TINYAI_IO_INVALID;
+#endif
+}
+
+// Helper to drop data already read from the page cache (TINYAI_FILE_DIRECT)
+static void dropReadData(TinyAIFile *file) {
+    if (!(file->mode & TINYAI_FILE_DIRECT)) {
+        return;
+    }
+    long pos = ftell(file->fp);
+    if (pos > file->dropped) {
+        adviseStream(file->fp, file->dropped, pos - file->dropped, TINYAI_IO_ADVICE_DONTNEED);
+        file->dropped = pos;
+    }
+}
+
 TinyAIFile* tinyaiOpenFile(const char *path, int mode) {
     char fopen_mode[5] = {0}; // Max "rb+" + null terminator
     int current_pos = 0;
@@ -159,13 +209,36 @@ TinyAIFile* tinyaiOpenFile(const char *path, int mode) {
 
     taiFile->fp = fp;
     taiFile->mode = mode;
+    taiFile->buffer = NULL;
+    taiFile->dropped = 0;
+
+    // Read-only files are loaded front to back: buffer them generously and read ahead
+    if (!(mode & (TINYAI_FILE_WRITE | TINYAI_FILE_APPEND))) {
+        if (g_bufferSize > 0) {
+            taiFile->buffer = (char*)malloc(g_bufferSize);
+            if (taiFile->buffer && setvbuf(fp, taiFile->buffer, _IOFBF, g_bufferSize) != 0) {
+                free(taiFile->buffer);
+                taiFile->buffer = NULL;
+            }
+        }
+        adviseStream(fp, 0, 0, TINYAI_IO_ADVICE_SEQUENTIAL);
+    }
+#if defined(F_NOCACHE)
+    if (mode & TINYAI_FILE_DIRECT) {
+        fcntl(fileno(fp), F_NOCACHE, 1);
+    }
+#endif
+
     setLastError(TINYAI_IO_SUCCESS);
     return taiFile;
 }
 
 void tinyaiCloseFile(TinyAIFile *file) {
     if (file && file->fp) {
+        dropReadData(file);
         fclose(file->fp);
+        // The stream buffer is in use until the stream is closed
+        free(file->buffer);
         // Use TINYAI_FREE if memory tracking is enabled and integrated
         free(file); 
     }
@@ -192,9 +265,54 @@ int64_t tinyaiReadFile(TinyAIFile *file, void *buffer, size_t size) {
     } else {
          setLastError(TINYAI_IO_SUCCESS);
     }
+    dropReadData(file);
     return (int64_t)bytesRead;
 }
 
+int64_t tinyaiReadFileVector(TinyAIFile *file, const TinyAIIOVector *vectors, int count) {
+    if (!file || !file->fp || (!vectors && count > 0) || count < 0) {
+        setLastError(TINYAI_IO_INVALID);
+        return TINYAI_IO_INVALID;
+    }
+
+    // Small vectors come out of the stream buffer; large ones are read straight into place
+    int64_t total = 0;
+    setLastError(TINYAI_IO_SUCCESS);
+    for (int i = 0; i < count; i++) {
+        if (vectors[i].size == 0) {
+            continue;
+        }
+        if (!vectors[i].buffer) {
+            setLastError(TINYAI_IO_INVALID);
+            return TINYAI_IO_INVALID;
+        }
+
+        size_t bytesRead = fread(vectors[i].buffer, 1, vectors[i].size, file->fp);
+        total += (int64_t)bytesRead;
+        if (bytesRead < vectors[i].size) {
+            if (ferror(file->fp)) {
+                setLastErrorFromErrno();
+                return g_lastIOError;
+            }
+            setLastError(TINYAI_IO_EOF);
+            break;
+        }
+    }
+    dropReadData(file);
+    return total;
+}
+
+int tinyaiAdviseFile(TinyAIFile *file, int64_t offset, int64_t length, int advice) {
+    if (!file || !file->fp || offset < 0 || length < 0) {
+        setLastError(TINYAI_IO_INVALID);
+        return TINYAI_IO_INVALID;
+    }
+
+    int result = adviseStream(file->fp, offset, length, advice);
+    setLastError(result);
+    return result;
+}
+
 int64_t tinyaiWriteFile(TinyAIFile *file, const void *buffer, size_t size) {
      if (!file || !file->fp || !buffer) {
         setLastError(TINYAI_IO_INVALID);
@@ -234,6 +352,8 @@ int tinyaiReadLine(TinyAIFile *file, char *buffer, size_t size) {
         }
     }
     
+    dropReadData(file);
+
     // Remove trailing newline if present and buffer has space
     size_t len = strlen(buffer);
     if (len > 0 && buffer[len - 1] == '\n') {
@@ -19,6 +19,7 @@
 #define TINYAI_FILE_BINARY      0x08    /* Open in binary mode */
 #define TINYAI_FILE_CREATE      0x10    /* Create if doesn't exist */
 #define TINYAI_FILE_TRUNCATE    0x20    /* Truncate if exists */
+#define TINYAI_FILE_DIRECT      0x40    /* Keep data read out of the OS page cache */
 
 /* ----------------- File Error Codes ----------------- */
 
@@ -31,6 +32,18 @@
 #define TINYAI_IO_NO_MEMORY    -6       /* Out of memory */
 #define TINYAI_IO_EOF          -7       /* End of file */
 
+/* ----------------- Read Buffering ----------------- */
+
+/* Default stream buffer of files opened read-only */
+#define TINYAI_IO_DEFAULT_BUFFER_SIZE (1024 * 1024)
+
+/* Access pattern hints for tinyaiAdviseFile */
+#define TINYAI_IO_ADVICE_NORMAL      0  /* No particular pattern */
+#define TINYAI_IO_ADVICE_SEQUENTIAL  1  /* Read front to back: read ahead aggressively */
+#define TINYAI_IO_ADVICE_RANDOM      2  /* Scattered reads: do not read ahead */
+#define TINYAI_IO_ADVICE_WILLNEED    3  /* Start reading the range in the background */
+#define TINYAI_IO_ADVICE_DONTNEED    4  /* Drop the range from the page cache */
+
 /* ----------------- Type Definitions ----------------- */
 
 /* File handle type */
@@ -39,6 +52,12 @@ typedef struct TinyAIFile TinyAIFile;
 /* Directory handle type */
 typedef struct TinyAIDir TinyAIDir;
 
+/* One destination of a vectored read */
+typedef struct {
+    void *buffer;           /* Destination */
+    size_t size;            /* Bytes to read into it */
+} TinyAIIOVector;
+
 /* File information structure */
 typedef struct {
     char *path;             /* Full path to file */
@@ -77,11 +96,35 @@ int tinyaiIOGetLastError();
  */
 const char* tinyaiIOGetErrorString(int error);
 
+/**
+ * Set the stream buffer size of files opened read-only from now on
+ * 
+ * Loaders read many small header fields; a large buffer serves them from
+ * memory and turns the reads behind them into a few large ones. Reads larger
+ * than the buffer go straight into the caller's memory.
+ * 
+ * @param size Buffer size in bytes (0 for the C library's default)
+ */
+void tinyaiIOSetBufferSize(size_t size);
+
+/**
+ * Get the stream buffer size of files opened read-only
+ * 
+ * @return Buffer size in bytes (TINYAI_IO_DEFAULT_BUFFER_SIZE unless changed)
+ */
+size_t tinyaiIOGetBufferSize();
+
 /* ----------------- File Operations ----------------- */
 
 /**
  * Open a file
  * 
+ * Files opened read-only get a tinyaiIOGetBufferSize() buffer and are
+ * hinted as read sequentially. With TINYAI_FILE_DIRECT, data read is dropped
+ * from the page cache behind the reads (and not cached at all on macOS), so
+ * loading a large model does not evict everything else; true O_DIRECT would
+ * need sector-aligned buffers at every call site.
+ * 
  * @param path File path
  * @param mode File mode flags
  * @return File handle or NULL on error
@@ -105,6 +148,33 @@ void tinyaiCloseFile(TinyAIFile *file);
  */
 int64_t tinyaiReadFile(TinyAIFile *file, void *buffer, size_t size);
 
+/**
+ * Read consecutive bytes of a file into several buffers
+ * 
+ * Fills each vector in turn, as readv does, so a record of fields of
+ * different types is read with one call.
+ * 
+ * @param file File handle
+ * @param vectors Destinations, in file order
+ * @param count Number of vectors
+ * @return Total number of bytes read (less than requested at end of file) or
+ *         negative error code
+ */
+int64_t tinyaiReadFileVector(TinyAIFile *file, const TinyAIIOVector *vectors, int count);
+
+/**
+ * Hint how a range of a file will be read
+ * 
+ * Hints are advisory: on systems without them this does nothing and succeeds.
+ * 
+ * @param file File handle
+ * @param offset Start of the range
+ * @param length Length of the range (0 for the rest of the file)
+ * @param advice TINYAI_IO_ADVICE_* hint
+ * @return 0 on success, negative error code on failure
+ */
+int tinyaiAdviseFile(TinyAIFile *file, int64_t offset, int64_t length, int advice);
+
 /**
  * Write to a file
  * 
@@ -6,13 +6,24 @@
 #include "io.h"
 #include <assert.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
 #ifdef _WIN32
+#include <process.h>
 #include <windows.h>
+typedef HANDLE           LogThread;
+typedef CRITICAL_SECTION LogMutex;
+typedef DWORD            LogRingKey;
+#else
+#include <pthread.h>
+#include <sched.h>
+typedef pthread_t       LogThread;
+typedef pthread_mutex_t LogMutex;
+typedef pthread_key_t   LogRingKey;
 #endif
 
 /* ----------------- Private Data Types ----------------- */
@@ -60,6 +71,42 @@ static const char *LOG_LEVEL_COLORS[] = {
  */
 #define MAX_LOG_FILE_PATH 256
 
+/**
+ * Default and smallest size of a thread's ring buffer; a ring always has
+ * room for the longest message
+ */
+#define LOG_RING_DEFAULT_SIZE (64 * 1024)
+#define LOG_RING_MIN_SIZE     (4 * MAX_LOG_MESSAGE_LENGTH)
+
+/**
+ * Default writer sleep when every ring is empty
+ */
+#define LOG_POLL_DEFAULT_MS 2
+
+/**
+ * Header of a queued message; the message and its terminator follow,
+ * padded to a multiple of the header size, and may wrap around the ring
+ */
+typedef struct {
+    uint32_t length; /* Message bytes without the terminator */
+    uint32_t level;
+} LogRecord;
+
+/**
+ * Single-producer, single-consumer ring of one logging thread
+ *
+ * head and tail count bytes ever read and written; only the owning
+ * thread moves tail and only the writer (under drain_lock) moves head.
+ */
+typedef struct LogRing {
+    char           *data;
+    size_t          mask;    /* Size minus one; the size is a power of two */
+    size_t          head;    /* Bytes consumed by the writer */
+    size_t          tail;    /* Bytes produced by the owner */
+    int             claimed; /* 1 while a live thread owns the ring */
+    struct LogRing *next;
+} LogRing;
+
 /**
  * Log system state
  */
@@ -72,6 +119,17 @@ typedef struct {
     char             log_file_path[MAX_LOG_FILE_PATH];
     size_t           current_file_size;
     int              current_file_index;
+
+    /* Asynchronous logging */
+    int                  async_running; /* Read by every logging thread */
+    TinyAILogAsyncConfig async_config;
+    LogRing             *rings;         /* Every ring ever claimed */
+    LogRingKey           ring_key;      /* Ring of the calling thread */
+    LogThread            writer;
+    LogMutex             drain_lock;    /* Held while rings are consumed */
+    int                  writer_stop;
+    size_t               dropped;
+    size_t               dropped_reported;
 } LogSystemState;
 
 /**
@@ -94,6 +152,14 @@ static void write_to_console(TinyAILogLevel level, const char *message);
 static int  write_to_file(const char *message);
 static int  rotate_log_file_if_needed(void);
 static void escape_json_string(const char *input, char *output, size_t output_size);
+static void log_message(TinyAILogLevel level, const char *file, int line, const char *format,
+                        va_list args);
+static void dispatch_log_message(TinyAILogLevel level, const char *message);
+static void stop_async_logging(void);
+static void pause_log_writer(void);
+static void resume_log_writer(void);
+static int  apply_logging_config(const TinyAILogConfig *config);
+static int  open_log_file(const char *file_path);
 
 /* ----------------- Core Functions ----------------- */
 
@@ -142,6 +208,19 @@ int tinyai_configure_logging(const TinyAILogConfig *config)
         return 0;
     }
 
+    /* The writer thread must not use the outputs while they change */
+    pause_log_writer();
+    int result = apply_logging_config(config);
+    resume_log_writer();
+
+    if (result) {
+        TINYAI_LOG_INFO("Logging configuration updated");
+    }
+    return result;
+}
+
+static int apply_logging_config(const TinyAILogConfig *config)
+{
     /* Close existing log file if we're changing output settings */
     if ((log_state.config.output & TINYAI_LOG_OUTPUT_FILE) && (log_state.log_file != NULL) &&
         ((!(config->output & TINYAI_LOG_OUTPUT_FILE)) ||
@@ -206,7 +285,6 @@ int tinyai_configure_logging(const TinyAILogConfig *config)
         }
     }
 
-    TINYAI_LOG_INFO("Logging configuration updated");
     return 1;
 }
 
@@ -245,6 +323,14 @@ int tinyai_set_log_file(const char *file_path)
         tinyai_logging_init();
     }
 
+    pause_log_writer();
+    int result = open_log_file(file_path);
+    resume_log_writer();
+    return result;
+}
+
+static int open_log_file(const char *file_path)
+{
     if (!file_path) {
         if (log_state.log_file) {
             fclose(log_state.log_file);
@@ -321,6 +407,9 @@ void tinyai_logging_shutdown(void)
 
     TINYAI_LOG_INFO("Logging system shutting down");
 
+    /* Write out what the writer thread has not yet */
+    stop_async_logging();
+
     /* Close log file if open */
     if (log_state.log_file) {
         fclose(log_state.log_file);
@@ -342,51 +431,370 @@ void tinyai_log(TinyAILogLevel level, const char *format, ...)
 
 void tinyai_vlog(TinyAILogLevel level, const char *format, va_list args)
 {
-    if (!log_state.initialized) {
-        tinyai_logging_init();
+    va_list args_copy;
+    va_copy(args_copy, args);
+    log_message(level, NULL, 0, format, args_copy);
+    va_end(args_copy);
+}
+
+void tinyai_log_with_source(TinyAILogLevel level, const char *file, int line, const char *format,
+                            ...)
+{
+    va_list args;
+    va_start(args, format);
+    log_message(level, file, line, format, args);
+    va_end(args);
+}
+
+/* ----------------- Asynchronous Logging ----------------- */
+
+static void *get_thread_ring(void)
+{
+#ifdef _WIN32
+    return FlsGetValue(log_state.ring_key);
+#else
+    return pthread_getspecific(log_state.ring_key);
+#endif
+}
+
+/* Called as a thread exits; another thread may take over the ring */
+#ifdef _WIN32
+static void WINAPI release_thread_ring(void *ring)
+#else
+static void release_thread_ring(void *ring)
+#endif
+{
+    if (ring) {
+        __atomic_store_n(&((LogRing *)ring)->claimed, 0, __ATOMIC_RELEASE);
     }
+}
 
-    /* Check log level */
-    if (level > log_state.config.level || level == TINYAI_LOG_NONE) {
+static LogRing *thread_log_ring(void)
+{
+    LogRing *ring = (LogRing *)get_thread_ring();
+    if (ring) {
+        return ring;
+    }
+
+    /* Take over the ring of an exited thread, or add a new one */
+    for (ring = __atomic_load_n(&log_state.rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        int released = 0;
+        if (__atomic_compare_exchange_n(&ring->claimed, &released, 1, false, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (!ring) {
+        ring = (LogRing *)calloc(1, sizeof(LogRing));
+        if (!ring || !(ring->data = (char *)malloc(log_state.async_config.ring_size))) {
+            free(ring);
+            return NULL;
+        }
+        ring->mask    = log_state.async_config.ring_size - 1;
+        ring->claimed = 1;
+        ring->next    = __atomic_load_n(&log_state.rings, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&log_state.rings, &ring->next, ring, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+#ifdef _WIN32
+    FlsSetValue(log_state.ring_key, ring);
+#else
+    pthread_setspecific(log_state.ring_key, ring);
+#endif
+    return ring;
+}
+
+static size_t log_record_size(size_t length)
+{
+    return sizeof(LogRecord) + (length + sizeof(LogRecord)) / sizeof(LogRecord) * sizeof(LogRecord);
+}
+
+/* Copy bytes into a ring, wrapping around its end */
+static void ring_write(LogRing *ring, size_t position, const void *bytes, size_t size)
+{
+    size_t offset = position & ring->mask;
+    size_t first  = size < ring->mask + 1 - offset ? size : ring->mask + 1 - offset;
+    memcpy(ring->data + offset, bytes, first);
+    memcpy(ring->data, (const char *)bytes + first, size - first);
+}
+
+static void ring_read(const LogRing *ring, size_t position, void *bytes, size_t size)
+{
+    size_t offset = position & ring->mask;
+    size_t first  = size < ring->mask + 1 - offset ? size : ring->mask + 1 - offset;
+    memcpy(bytes, ring->data + offset, first);
+    memcpy((char *)bytes + first, ring->data, size - first);
+}
+
+static void log_yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static void log_sleep(int milliseconds)
+{
+#ifdef _WIN32
+    Sleep((DWORD)milliseconds);
+#else
+    struct timespec delay = {milliseconds / 1000, (long)(milliseconds % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+#endif
+}
+
+static bool enqueue_log_message(TinyAILogLevel level, const char *message)
+{
+    LogRing *ring = thread_log_ring();
+    if (!ring) {
+        __atomic_add_fetch(&log_state.dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    LogRecord record = {(uint32_t)strlen(message), (uint32_t)level};
+    size_t    size   = log_record_size(record.length);
+    size_t    tail   = ring->tail;
+    while (size > ring->mask + 1 - (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))) {
+        if (log_state.async_config.full_policy == TINYAI_LOG_ASYNC_DROP) {
+            __atomic_add_fetch(&log_state.dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        log_yield();
+    }
+
+    ring_write(ring, tail, &record, sizeof(record));
+    ring_write(ring, tail + sizeof(record), message, record.length + 1);
+    __atomic_store_n(&ring->tail, tail + size, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Write out every queued message; the caller holds drain_lock */
+static size_t drain_log_rings(void)
+{
+    char   message[MAX_LOG_MESSAGE_LENGTH];
+    size_t written = 0;
+
+    for (LogRing *ring = __atomic_load_n(&log_state.rings, __ATOMIC_ACQUIRE); ring;
+         ring          = ring->next) {
+        size_t head = ring->head;
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            LogRecord record;
+            ring_read(ring, head, &record, sizeof(record));
+            ring_read(ring, head + sizeof(record), message, record.length + 1);
+            __atomic_store_n(&ring->head, head += log_record_size(record.length),
+                             __ATOMIC_RELEASE);
+            dispatch_log_message((TinyAILogLevel)record.level, message);
+            written++;
+        }
+    }
+
+    /* Say how many messages went missing since the last report */
+    size_t dropped = __atomic_load_n(&log_state.dropped, __ATOMIC_RELAXED);
+    if (dropped != log_state.dropped_reported) {
+        snprintf(message, sizeof(message), "[WARN] %zu log messages dropped, ring buffers full",
+                 dropped - log_state.dropped_reported);
+        log_state.dropped_reported = dropped;
+        dispatch_log_message(TINYAI_LOG_WARN, message);
+        written++;
+    }
+
+    if (written) {
+        if (log_state.log_file) {
+            fflush(log_state.log_file);
+        }
+        fflush(stdout);
+    }
+    return written;
+}
+
+static void lock_drain(void)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&log_state.drain_lock);
+#else
+    pthread_mutex_lock(&log_state.drain_lock);
+#endif
+}
+
+static void unlock_drain(void)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&log_state.drain_lock);
+#else
+    pthread_mutex_unlock(&log_state.drain_lock);
+#endif
+}
+
+/* Hold off the writer thread, after it has written what is queued */
+static void pause_log_writer(void)
+{
+    if (log_state.async_running) {
+        lock_drain();
+        drain_log_rings();
+    }
+}
+
+static void resume_log_writer(void)
+{
+    if (log_state.async_running) {
+        unlock_drain();
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall log_writer_thread(void *param)
+#else
+static void *log_writer_thread(void *param)
+#endif
+{
+    (void)param;
+    while (!__atomic_load_n(&log_state.writer_stop, __ATOMIC_ACQUIRE)) {
+        lock_drain();
+        size_t written = drain_log_rings();
+        unlock_drain();
+
+        if (!written) {
+            log_sleep(log_state.async_config.poll_interval_ms);
+        }
+    }
+    return 0;
+}
+
+static bool start_async_logging(const TinyAILogAsyncConfig *async_config)
+{
+    /* Rings hold the longest message and wrap with a mask */
+    size_t ring_size = LOG_RING_MIN_SIZE;
+    while (ring_size < async_config->ring_size) {
+        ring_size *= 2;
+    }
+    log_state.async_config           = *async_config;
+    log_state.async_config.ring_size = async_config->ring_size ? ring_size : LOG_RING_DEFAULT_SIZE;
+    if (log_state.async_config.poll_interval_ms <= 0) {
+        log_state.async_config.poll_interval_ms = LOG_POLL_DEFAULT_MS;
+    }
+    log_state.rings            = NULL;
+    log_state.writer_stop      = 0;
+    log_state.dropped          = 0;
+    log_state.dropped_reported = 0;
+
+#ifdef _WIN32
+    log_state.ring_key = FlsAlloc(release_thread_ring);
+    if (log_state.ring_key == FLS_OUT_OF_INDEXES) {
+        return false;
+    }
+    InitializeCriticalSection(&log_state.drain_lock);
+    log_state.writer = (HANDLE)_beginthreadex(NULL, 0, log_writer_thread, NULL, 0, NULL);
+    bool started     = log_state.writer != NULL;
+    if (!started) {
+        DeleteCriticalSection(&log_state.drain_lock);
+        FlsFree(log_state.ring_key);
+    }
+#else
+    if (pthread_key_create(&log_state.ring_key, release_thread_ring) != 0) {
+        return false;
+    }
+    pthread_mutex_init(&log_state.drain_lock, NULL);
+    bool started = pthread_create(&log_state.writer, NULL, log_writer_thread, NULL) == 0;
+    if (!started) {
+        pthread_mutex_destroy(&log_state.drain_lock);
+        pthread_key_delete(log_state.ring_key);
+    }
+#endif
+
+    if (!started) {
+        fprintf(stderr, "Failed to start the log writer thread\n");
+        return false;
+    }
+    __atomic_store_n(&log_state.async_running, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void stop_async_logging(void)
+{
+    if (!log_state.async_running) {
         return;
     }
 
-    /* Format message based on selected format */
-    char    message[MAX_LOG_MESSAGE_LENGTH];
-    va_list args_copy;
-    va_copy(args_copy, args);
+    /* New messages go straight to the outputs again */
+    __atomic_store_n(&log_state.async_running, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&log_state.writer_stop, 1, __ATOMIC_RELEASE);
+#ifdef _WIN32
+    WaitForSingleObject(log_state.writer, INFINITE);
+    CloseHandle(log_state.writer);
+#else
+    pthread_join(log_state.writer, NULL);
+#endif
+    drain_log_rings();
 
-    switch (log_state.config.format) {
-    case TINYAI_LOG_FORMAT_JSON:
-        format_log_message_json(level, NULL, 0, format, args_copy, message, sizeof(message));
-        break;
-    case TINYAI_LOG_FORMAT_CSV:
-        format_log_message_csv(level, NULL, 0, format, args_copy, message, sizeof(message));
-        break;
-    case TINYAI_LOG_FORMAT_PLAIN:
-    default:
-        format_log_message(level, NULL, 0, format, args_copy, message, sizeof(message));
-        break;
+    /* Forget the rings first, so exiting threads no longer touch them */
+#ifdef _WIN32
+    FlsFree(log_state.ring_key);
+    DeleteCriticalSection(&log_state.drain_lock);
+#else
+    pthread_key_delete(log_state.ring_key);
+    pthread_mutex_destroy(&log_state.drain_lock);
+#endif
+    while (log_state.rings) {
+        LogRing *next = log_state.rings->next;
+        free(log_state.rings->data);
+        free(log_state.rings);
+        log_state.rings = next;
     }
+    log_state.async_config.enabled = false;
+}
 
-    va_end(args_copy);
+int tinyai_configure_async_logging(const TinyAILogAsyncConfig *async_config)
+{
+    if (!log_state.initialized) {
+        if (!tinyai_logging_init()) {
+            return 0;
+        }
+    }
 
-    /* Write to enabled output destinations */
-    if (log_state.config.output & TINYAI_LOG_OUTPUT_CONSOLE) {
-        write_to_console(level, message);
+    if (!async_config) {
+        return 0;
     }
 
-    if (log_state.config.output & TINYAI_LOG_OUTPUT_FILE) {
-        write_to_file(message);
+    stop_async_logging();
+    if (async_config->enabled && !start_async_logging(async_config)) {
+        return 0;
     }
+    return 1;
+}
 
-    if ((log_state.config.output & TINYAI_LOG_OUTPUT_CUSTOM) && log_state.custom_handler) {
-        log_state.custom_handler(level, message, log_state.custom_handler_data);
+void tinyai_log_flush(void)
+{
+    if (!log_state.initialized) {
+        return;
+    }
+
+    if (__atomic_load_n(&log_state.async_running, __ATOMIC_ACQUIRE)) {
+        lock_drain();
+        drain_log_rings();
+        unlock_drain();
+    }
+    else {
+        if (log_state.log_file) {
+            fflush(log_state.log_file);
+        }
+        fflush(stdout);
     }
 }
 
-void tinyai_log_with_source(TinyAILogLevel level, const char *file, int line, const char *format,
-                            ...)
+size_t tinyai_log_dropped(void)
+{
+    return __atomic_load_n(&log_state.dropped, __ATOMIC_RELAXED);
+}
+
+/* ----------------- Helper Functions ----------------- */
+
+static void log_message(TinyAILogLevel level, const char *file, int line, const char *format,
+                        va_list args)
 {
     if (!log_state.initialized) {
         tinyai_logging_init();
@@ -398,9 +806,7 @@ void tinyai_log_with_source(TinyAILogLevel level, const char *file, int line, co
     }
 
     /* Format message based on selected format */
-    char    message[MAX_LOG_MESSAGE_LENGTH];
-    va_list args;
-    va_start(args, format);
+    char message[MAX_LOG_MESSAGE_LENGTH];
 
     switch (log_state.config.format) {
     case TINYAI_LOG_FORMAT_JSON:
@@ -415,8 +821,16 @@ void tinyai_log_with_source(TinyAILogLevel level, const char *file, int line, co
         break;
     }
 
-    va_end(args);
+    /* In asynchronous mode the writer thread does the output */
+    if (__atomic_load_n(&log_state.async_running, __ATOMIC_ACQUIRE)) {
+        enqueue_log_message(level, message);
+        return;
+    }
+    dispatch_log_message(level, message);
+}
 
+static void dispatch_log_message(TinyAILogLevel level, const char *message)
+{
     /* Write to enabled output destinations */
     if (log_state.config.output & TINYAI_LOG_OUTPUT_CONSOLE) {
         write_to_console(level, message);
@@ -431,14 +845,18 @@ void tinyai_log_with_source(TinyAILogLevel level, const char *file, int line, co
     }
 }
 
-/* ----------------- Helper Functions ----------------- */
-
 static void format_timestamp(char *buffer, size_t buffer_size)
 {
-    time_t     now      = time(NULL);
-    struct tm *timeinfo = localtime(&now);
+    time_t    now = time(NULL);
+    struct tm timeinfo;
 
-    strftime(buffer, buffer_size, "%Y-%m-%d %H:%M:%S", timeinfo);
+    /* Logging threads format their own timestamps */
+#ifdef _WIN32
+    localtime_s(&timeinfo, &now);
+#else
+    localtime_r(&now, &timeinfo);
+#endif
+    strftime(buffer, buffer_size, "%Y-%m-%d %H:%M:%S", &timeinfo);
 }
 
 static void format_log_message(TinyAILogLevel level, const char *file, int line, const char *format,
@@ -629,9 +1047,11 @@ static int write_to_file(const char *message)
         }
     }
 
-    /* Write message to file */
+    /* Write message to file; the writer thread flushes once per batch */
     fprintf(log_state.log_file, "%s\n", message);
-    fflush(log_state.log_file);
+    if (!log_state.async_running) {
+        fflush(log_state.log_file);
+    }
 
     /* Update file size */
     log_state.current_file_size += strlen(message) + 1; /* +1 for newline */
@@ -81,6 +81,24 @@ typedef struct {
     bool                    colorize_console;  /* Use colors in console output */
 } TinyAILogConfig;
 
+/**
+ * What a logging thread does when its ring buffer is full
+ */
+typedef enum {
+    TINYAI_LOG_ASYNC_DROP  = 0, /* Drop the message and count it */
+    TINYAI_LOG_ASYNC_BLOCK = 1  /* Wait until the writer makes room */
+} TinyAILogFullPolicy;
+
+/**
+ * Asynchronous logging configuration
+ */
+typedef struct {
+    bool                enabled;          /* Hand messages to a background writer */
+    size_t              ring_size;        /* Bytes of each thread's ring (0 for the default) */
+    TinyAILogFullPolicy full_policy;      /* What to do when a ring is full */
+    int                 poll_interval_ms; /* Writer sleep when all rings are empty (0: default) */
+} TinyAILogAsyncConfig;
+
 /**
  * Custom log handler function type
  *
@@ -155,6 +173,33 @@ int tinyai_configure_log_rotation(const TinyAILogRotationConfig *rotation_config
  */
 int tinyai_register_log_handler(TinyAILogHandler handler, void *user_data);
 
+/**
+ * Configure asynchronous logging
+ *
+ * When enabled, each logging thread formats its messages into its own
+ * lock-free ring buffer and a background writer thread writes them to the
+ * console, the log file and the custom handler in batches, rotating the file
+ * as needed. The custom handler then runs on the writer thread. Messages of
+ * one thread keep their order; messages of different threads may interleave.
+ * Call this while no other thread is logging.
+ *
+ * @param async_config Asynchronous logging configuration
+ * @return 1 on success, 0 on failure
+ */
+int tinyai_configure_async_logging(const TinyAILogAsyncConfig *async_config);
+
+/**
+ * Write out every queued message and flush the outputs
+ */
+void tinyai_log_flush(void);
+
+/**
+ * Get the number of messages dropped because a ring buffer was full
+ *
+ * @return Messages dropped since asynchronous logging was enabled
+ */
+size_t tinyai_log_dropped(void);
+
 /**
  * Shutdown the logging system
  */
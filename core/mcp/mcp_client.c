@@ -1,31 +1,2404 @@
 /**
  * @file mcp_client.c
  * @brief Implementation of the Model Context Protocol (MCP) client for TinyAI
+ *
+ * Messages are JSON-RPC requests POSTed to the server endpoint over HTTP/1.1
+ * (the MCP streamable HTTP transport). Connections are kept alive in a small
+ * pool, so repeated calls skip the TCP handshake, and a batch of calls can be
+ * pipelined on one connection. mock:// URLs connect to a simulated server.
  */
 
 #include "mcp_client.h"
+#include "../../utils/trace.h"
+#include <ctype.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <process.h>
+#include <windows.h>
+typedef SOCKET             McpSocket;
+typedef CRITICAL_SECTION   Mutex;
+typedef CONDITION_VARIABLE Condition;
+typedef HANDLE             ThreadHandle;
+#define MCP_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int             McpSocket;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t  Condition;
+typedef pthread_t       ThreadHandle;
+#define MCP_INVALID_SOCKET (-1)
+#endif
+
+/* Keep a closed peer from raising SIGPIPE where the platform allows it */
+#ifdef MSG_NOSIGNAL
+#define MCP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define MCP_SEND_FLAGS 0
+#endif
+
+/* Default configuration values */
+#define DEFAULT_TIMEOUT_MS 5000
+#define DEFAULT_MAX_RETRIES 3
+#define DEFAULT_MAX_CONNECTIONS 4
+#define DEFAULT_REQUEST_TIMEOUT_MS 60000
+
+/* Default response cache bounds */
+#define DEFAULT_CACHE_ENTRIES 256
+#define DEFAULT_CACHE_BYTES (1024 * 1024)
+#define DEFAULT_CACHE_TTL_MS 60000
+
+/* Delay before the first connection retry, doubled for each further retry */
+#define RETRY_BACKOFF_MS 100
+#define MAX_RETRY_BACKOFF_MS 2000
+
+/* Largest HTTP response header accepted */
+#define MAX_HEADER_BYTES 16384
+
+/* Protocol revision requested when initializing a session */
+#define MCP_PROTOCOL_VERSION "2025-03-26"
+
+/* Longest a cancellable request waits on its socket between cancellation checks */
+#define CANCEL_POLL_MS 20
+
+/* Most queued calls a worker pipelines in one batch */
+#define ASYNC_BATCH_MAX 16
+
+/**
+ * @brief Growing byte buffer, kept NUL-terminated
+ */
+typedef struct {
+    char  *data;
+    size_t length;
+    size_t capacity;
+} McpBuffer;
+
+/**
+ * @brief Pooled connection to the server
+ */
+typedef struct {
+    McpSocket socket; /* Open keep-alive connection, or MCP_INVALID_SOCKET */
+    bool      busy;   /* Lent to a request */
+    bool      pooled; /* Part of the pool (false for overflow connections) */
+    McpBuffer input;  /* Received bytes not yet parsed, such as later pipelined replies */
+    const volatile int *cancel; /* Cancellation flag of the request using it (NULL if none) */
+} McpConnection;
+
+/**
+ * @brief HTTP reply to a posted message
+ */
+typedef struct {
+    int       status;         /* HTTP status code */
+    bool      keepAlive;      /* Connection stays open after the reply */
+    char      sessionId[128]; /* Mcp-Session-Id header, if any */
+    McpBuffer body;           /* JSON-RPC message */
+} McpResponse;
+
+/**
+ * @brief Asynchronous calls pipelined together by a worker
+ */
+typedef struct {
+    volatile int cancelled; /* Set to abandon the request once none of its calls is waiting */
+    int          live;      /* Calls not yet finished (guarded by the client lock) */
+} McpBatch;
+
+/**
+ * @brief Tool call or resource read queued for the client's workers
+ */
+struct TinyAIMcpAsyncCall {
+    TinyAIMcpClient      *client;
+    char                 *name;         /* Tool name, or URI of the resource */
+    char                 *arguments;    /* JSON arguments of a tool (NULL for none) */
+    bool                  resource;     /* Reads a resource instead of calling a tool */
+    TinyAIMcpAsyncOptions options;      /* Callbacks */
+    TinyAIMcpCallStatus   status;       /* Guarded by the client lock */
+    McpBuffer             result;       /* Result or error message, set when it finishes */
+    int                   resultLength; /* Length of the result, or -1 on error */
+    McpBatch             *batch;        /* Batch sending it while running */
+    McpBuffer             cacheKey;     /* Key its result is cached under (empty if not cached) */
+    int                   references;   /* Caller and worker (guarded by the client lock) */
+    TinyAIMcpAsyncCall   *next;         /* Next unfinished call of the client */
+};
+
+/**
+ * @brief Cached result of a tool call or resource read
+ */
+typedef struct McpCacheEntry McpCacheEntry;
+struct McpCacheEntry {
+    char          *key;          /* Kind, name and canonical arguments */
+    size_t         keyLength;    /* Length of the key */
+    uint32_t       hash;         /* Hash of the key */
+    char          *value;        /* Result */
+    size_t         length;       /* Length of the result */
+    double         expiresAt;    /* Fresh until then */
+    double         staleUntil;   /* Served while being refreshed until then */
+    bool           revalidating; /* A refresh is in flight */
+    McpCacheEntry *chain;        /* Next entry of the same bucket */
+    McpCacheEntry *newer;        /* Next more recently used entry */
+    McpCacheEntry *older;        /* Next less recently used entry */
+};
+
+/**
+ * @brief Response cache: hash table of entries kept in least recently used order
+ */
+typedef struct {
+    TinyAIMcpCacheConfig config;      /* Bounds and lifetimes (defaults applied) */
+    McpCacheEntry      **buckets;     /* Hash buckets */
+    uint32_t             bucketCount; /* Number of buckets (a power of two) */
+    McpCacheEntry       *newest;      /* Most recently used entry */
+    McpCacheEntry       *oldest;      /* Least recently used entry, evicted first */
+    TinyAIMcpCacheStats  stats;       /* Statistics */
+} McpCache;
+
+/**
+ * @brief Outcome of a cache lookup
+ */
+typedef enum {
+    CACHE_MISS,  /* Not cached, or expired */
+    CACHE_FRESH, /* Fresh result */
+    CACHE_STALE  /* Stale result that may still be served */
+} McpCacheLookup;
+
+/**
+ * @brief MCP client implementation structure
+ */
+struct TinyAIMcpClient {
+    TinyAIMcpConfig          config;                   /* Client configuration */
+    TinyAIMcpConnectionState connectionState;          /* Current connection state */
+    char                     serverUrl[256];           /* Current server URL */
+    time_t                   lastConnectionAttempt;    /* Timestamp of last connection attempt */
+    int                      connectionAttempts;       /* Number of connection attempts */
+    char                     lastError[256];           /* Last error message */
+    bool                     isConnectionActive;       /* Whether connection is active */
+    char                     serverCapabilities[1024]; /* Server capabilities */
+
+    /* Server */
+    bool  mock;              /* Simulated server (mock:// URL) */
+    char  host[128];         /* Server host name or address */
+    char  port[8];           /* Server port */
+    char  path[128];         /* Endpoint path */
+    char  sessionId[128];    /* Mcp-Session-Id assigned by the server */
+    char  serverName[64];    /* Name reported by the server */
+    char  serverVersion[32]; /* Version reported by the server */
+    char *tools;             /* Result of tools/list (NULL if not listed) */
+
+    /* Transport */
+    McpConnection          *pool;          /* Keep-alive connections */
+    int                     poolSize;      /* Connections in the pool */
+    Mutex                   lock;          /* Guards the pool, request IDs, statistics and calls */
+    long                    nextRequestId; /* ID of the next JSON-RPC request */
+    TinyAIMcpTransportStats stats;         /* Transport statistics */
+    McpCache               *cache;         /* Response cache (NULL when disabled) */
+
+    /* Asynchronous calls */
+    Condition           asyncChanged;  /* Signaled when an asynchronous call finishes */
+    Condition           workQueued;    /* Signaled when calls are queued or workers must stop */
+    TinyAIMcpAsyncCall *asyncCalls;    /* Unfinished calls, oldest first */
+    TinyAIMcpAsyncCall *asyncTail;     /* Newest unfinished call */
+    int                 queuedCalls;   /* Calls waiting for a worker */
+    ThreadHandle       *workers;       /* Worker threads */
+    int                 workerCount;   /* Worker threads started */
+    int                 idleWorkers;   /* Workers waiting for calls */
+    bool                stopWorkers;   /* Workers exit when set */
+};
+
+/* Platform helpers */
+
+static void initMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static void destroyMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+static void lockMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static void unlockMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+static void initCondition(Condition *condition)
+{
+#ifdef _WIN32
+    InitializeConditionVariable(condition);
+#else
+    pthread_cond_init(condition, NULL);
+#endif
+}
+
+static void destroyCondition(Condition *condition)
+{
+#ifndef _WIN32
+    pthread_cond_destroy(condition);
+#else
+    (void)condition;
+#endif
+}
+
+static void broadcastCondition(Condition *condition)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
+}
+
+/* Wait on a condition for up to timeoutMs (negative to wait without a limit) */
+static void waitCondition(Condition *condition, Mutex *mutex, int timeoutMs)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(condition, mutex, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
+#else
+    if (timeoutMs < 0) {
+        pthread_cond_wait(condition, mutex);
+        return;
+    }
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += timeoutMs / 1000;
+    until.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (until.tv_nsec >= 1000000000L) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(condition, mutex, &until);
+#endif
+}
+
+static double currentTimeMs(void)
+{
+#ifdef _WIN32
+    return (double)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+static void sleepMs(int milliseconds)
+{
+#ifdef _WIN32
+    Sleep((DWORD)milliseconds);
+#else
+    struct timespec delay = {milliseconds / 1000, (long)(milliseconds % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+#endif
+}
+
+/* Start the socket library once per process */
+static bool initSockets(void)
+{
+#ifdef _WIN32
+    static bool initialized = false;
+    if (!initialized) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            return false;
+        }
+        initialized = true;
+    }
+#endif
+    return true;
+}
+
+static void closeSocket(McpSocket socket)
+{
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+static void setNonBlocking(McpSocket socket)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(socket, FIONBIO, &mode);
+#else
+    fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+
+/* Whether the last socket call failed only because it would have blocked */
+static bool socketWouldBlock(void)
+{
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS || errno == EINTR;
+#endif
+}
+
+/* Wait until a socket can be read or written; returns > 0 when ready, 0 on timeout */
+static int waitSocket(McpSocket socket, bool forWrite, int timeoutMs)
+{
+#ifdef _WIN32
+    WSAPOLLFD descriptor = {socket, forWrite ? POLLWRNORM : POLLRDNORM, 0};
+    return WSAPoll(&descriptor, 1, timeoutMs);
+#else
+    struct pollfd descriptor = {socket, forWrite ? POLLOUT : POLLIN, 0};
+    int           ready;
+    do {
+        ready = poll(&descriptor, 1, timeoutMs);
+    } while (ready < 0 && errno == EINTR);
+    return ready;
+#endif
+}
+
+/* Cancellation flags are set and polled from different threads */
+static void setFlag(volatile int *flag)
+{
+#ifdef _WIN32
+    InterlockedExchange((volatile LONG *)flag, 1);
+#else
+    __atomic_store_n(flag, 1, __ATOMIC_RELEASE);
+#endif
+}
+
+static bool flagSet(const volatile int *flag)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange((volatile LONG *)flag, 0, 0) != 0;
+#else
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE) != 0;
+#endif
+}
+
+/* Milliseconds left before a deadline */
+static int remainingMs(double deadline)
+{
+    double remaining = deadline - currentTimeMs();
+    return remaining > 0 ? (int)(remaining + 0.5) : 0;
+}
+
+/* Wait on a connection's socket until a deadline; returns -1 if its request is cancelled */
+static int waitConnection(const McpConnection *connection, bool forWrite, double deadline)
+{
+    for (;;) {
+        int remaining = remainingMs(deadline);
+        if (!connection->cancel) {
+            return waitSocket(connection->socket, forWrite, remaining);
+        }
+        if (flagSet(connection->cancel)) {
+            return -1;
+        }
+
+        int slice = remaining < CANCEL_POLL_MS ? remaining : CANCEL_POLL_MS;
+        int ready = waitSocket(connection->socket, forWrite, slice);
+        if (ready != 0 || slice == remaining) {
+            return ready;
+        }
+    }
+}
+
+/* Buffer helpers */
+
+static bool bufferReserve(McpBuffer *buffer, size_t extra)
+{
+    if (buffer->length + extra + 1 <= buffer->capacity) {
+        return true;
+    }
+
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 256;
+    while (capacity < buffer->length + extra + 1) {
+        capacity *= 2;
+    }
+    char *data = (char *)realloc(buffer->data, capacity);
+    if (!data) {
+        return false;
+    }
+    buffer->data     = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+static bool bufferAppend(McpBuffer *buffer, const char *data, size_t length)
+{
+    if (!bufferReserve(buffer, length)) {
+        return false;
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
+
+static bool bufferPrintf(McpBuffer *buffer, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0 || !bufferReserve(buffer, (size_t)length)) {
+        return false;
+    }
+
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+    va_end(args);
+    buffer->length += (size_t)length;
+    return true;
+}
+
+/* Append a string as a quoted JSON string */
+static bool bufferAppendJsonString(McpBuffer *buffer, const char *text)
+{
+    bool ok = bufferAppend(buffer, "\"", 1);
+    for (const char *c = text; *c && ok; c++) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch == '"' || ch == '\\') {
+            ok = bufferPrintf(buffer, "\\%c", ch);
+        }
+        else if (ch < 0x20) {
+            ok = bufferPrintf(buffer, "\\u%04x", ch);
+        }
+        else {
+            ok = bufferAppend(buffer, c, 1);
+        }
+    }
+    return ok && bufferAppend(buffer, "\"", 1);
+}
+
+/* Drop bytes from the front of a buffer */
+static void bufferConsume(McpBuffer *buffer, size_t count)
+{
+    if (count >= buffer->length) {
+        buffer->length = 0;
+    }
+    else {
+        memmove(buffer->data, buffer->data + count, buffer->length - count);
+        buffer->length -= count;
+    }
+    if (buffer->data) {
+        buffer->data[buffer->length] = '\0';
+    }
+}
+
+/* JSON scanning: just enough to pick members out of JSON-RPC replies */
+
+static const char *jsonSkipSpace(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+    return p;
+}
+
+/* Skip a string starting at its opening quote; returns the end, or NULL if unterminated */
+static const char *jsonSkipString(const char *p)
+{
+    for (p++; *p; p++) {
+        if (*p == '\\' && p[1]) {
+            p++;
+        }
+        else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/* Skip any JSON value; returns the end, or NULL if malformed */
+static const char *jsonSkipValue(const char *p)
+{
+    p = jsonSkipSpace(p);
+    if (*p == '"') {
+        return jsonSkipString(p);
+    }
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '"') {
+                p = jsonSkipString(p);
+                if (!p) {
+                    return NULL;
+                }
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            }
+            else if ((*p == '}' || *p == ']') && --depth == 0) {
+                return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+
+    /* Number or literal */
+    const char *start = p;
+    while (*p && !strchr(",}] \t\r\n", *p)) {
+        p++;
+    }
+    return p > start ? p : NULL;
+}
+
+/* Find a member of a JSON object; returns its value and sets its length, or NULL */
+static const char *jsonFindMember(const char *object, const char *key, size_t *length)
+{
+    const char *p = jsonSkipSpace(object);
+    if (*p != '{') {
+        return NULL;
+    }
+
+    size_t keyLength = strlen(key);
+    p                = jsonSkipSpace(p + 1);
+    while (*p == '"') {
+        const char *name    = p + 1;
+        const char *nameEnd = jsonSkipString(p);
+        if (!nameEnd) {
+            return NULL;
+        }
+
+        p = jsonSkipSpace(nameEnd);
+        if (*p != ':') {
+            return NULL;
+        }
+        const char *value    = jsonSkipSpace(p + 1);
+        const char *valueEnd = jsonSkipValue(value);
+        if (!valueEnd) {
+            return NULL;
+        }
+
+        if ((size_t)(nameEnd - 1 - name) == keyLength && strncmp(name, key, keyLength) == 0) {
+            *length = (size_t)(valueEnd - value);
+            return value;
+        }
+
+        p = jsonSkipSpace(valueEnd);
+        if (*p != ',') {
+            return NULL;
+        }
+        p = jsonSkipSpace(p + 1);
+    }
+    return NULL;
+}
+
+/* Copy a bounded run of text into a buffer, truncating it to fit; returns bytes copied */
+static int copyText(char *out, int outSize, const char *text, size_t length)
+{
+    size_t count = length < (size_t)outSize - 1 ? length : (size_t)outSize - 1;
+    memcpy(out, text, count);
+    out[count] = '\0';
+    return (int)count;
+}
+
+/* Copy a JSON string member of an object without its quotes (escapes are kept) */
+static void copyJsonString(const char *object, const char *key, char *out, int outSize)
+{
+    size_t      length;
+    const char *value = object ? jsonFindMember(object, key, &length) : NULL;
+    if (value && *value == '"' && length >= 2) {
+        copyText(out, outSize, value + 1, length - 2);
+    }
+}
+
+/* Case-insensitive search for a lowercase token in a header value */
+static bool containsToken(const char *text, const char *token)
+{
+    size_t length = strlen(token);
+    for (; *text; text++) {
+        size_t i = 0;
+        while (i < length && text[i] && tolower((unsigned char)text[i]) == token[i]) {
+            i++;
+        }
+        if (i == length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Value of a header line if its name matches (name given in lowercase), or NULL */
+static const char *headerValue(const char *line, const char *name)
+{
+    size_t length = strlen(name);
+    for (size_t i = 0; i < length; i++) {
+        if (tolower((unsigned char)line[i]) != name[i]) {
+            return NULL;
+        }
+    }
+    if (line[length] != ':') {
+        return NULL;
+    }
+    const char *value = line + length + 1;
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+    return value;
+}
+
+static void setError(TinyAIMcpClient *client, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    lockMutex(&client->lock);
+    vsnprintf(client->lastError, sizeof(client->lastError), format, args);
+    unlockMutex(&client->lock);
+    va_end(args);
+}
+
+/* Connections */
+
+/* Make one attempt to open a TCP connection to the server */
+static McpSocket openSocket(TinyAIMcpClient *client)
+{
+    struct addrinfo  hints;
+    struct addrinfo *addresses = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(client->host, client->port, &hints, &addresses) != 0) {
+        setError(client, "Cannot resolve MCP server host %s", client->host);
+        return MCP_INVALID_SOCKET;
+    }
+
+    int timeoutMs =
+        client->config.connectionTimeoutMs > 0 ? client->config.connectionTimeoutMs
+                                               : DEFAULT_TIMEOUT_MS;
+    McpSocket result = MCP_INVALID_SOCKET;
+    for (struct addrinfo *address = addresses; address && result == MCP_INVALID_SOCKET;
+         address                  = address->ai_next) {
+        McpSocket candidate = socket(address->ai_family, address->ai_socktype,
+                                     address->ai_protocol);
+        if (candidate == MCP_INVALID_SOCKET) {
+            continue;
+        }
+
+        /* Connect without blocking so the timeout can be enforced */
+        setNonBlocking(candidate);
+        bool connected = connect(candidate, address->ai_addr, (int)address->ai_addrlen) == 0;
+        if (!connected && socketWouldBlock() && waitSocket(candidate, true, timeoutMs) > 0) {
+            int       error  = 0;
+            socklen_t length = sizeof(error);
+            connected        = getsockopt(candidate, SOL_SOCKET, SO_ERROR, (char *)&error,
+                                          &length) == 0 &&
+                        error == 0;
+        }
+
+        if (connected) {
+            /* Requests are small and latency-bound: send them without waiting to coalesce */
+            int on = 1;
+            setsockopt(candidate, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+            setsockopt(candidate, SOL_SOCKET, SO_KEEPALIVE, (const char *)&on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+            setsockopt(candidate, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&on, sizeof(on));
+#endif
+            result = candidate;
+        }
+        else {
+            closeSocket(candidate);
+        }
+    }
+
+    freeaddrinfo(addresses);
+    if (result == MCP_INVALID_SOCKET) {
+        setError(client, "Cannot connect to MCP server %s:%s", client->host, client->port);
+    }
+    return result;
+}
+
+/* Open a connection, retrying failed attempts with exponential backoff */
+static McpSocket connectWithRetry(TinyAIMcpClient *client)
+{
+    int retries = client->config.maxRetryAttempts > 0 ? client->config.maxRetryAttempts : 0;
+    int backoff = RETRY_BACKOFF_MS;
+
+    for (int attempt = 0;; attempt++) {
+        McpSocket socket = openSocket(client);
+
+        lockMutex(&client->lock);
+        client->connectionAttempts++;
+        if (socket != MCP_INVALID_SOCKET) {
+            client->stats.connectionsOpened++;
+        }
+        else if (attempt < retries) {
+            client->stats.connectRetries++;
+        }
+        unlockMutex(&client->lock);
+
+        if (socket != MCP_INVALID_SOCKET || attempt >= retries) {
+            return socket;
+        }
+
+        sleepMs(backoff);
+        backoff = backoff * 2 < MAX_RETRY_BACKOFF_MS ? backoff * 2 : MAX_RETRY_BACKOFF_MS;
+    }
+}
+
+static void closeConnection(McpConnection *connection)
+{
+    if (connection->socket != MCP_INVALID_SOCKET) {
+        closeSocket(connection->socket);
+        connection->socket = MCP_INVALID_SOCKET;
+    }
+    connection->input.length = 0;
+}
+
+/* Take an idle pooled connection (preferring open ones), opening a new one if needed */
+static McpConnection *acquireConnection(TinyAIMcpClient *client, bool *reused)
+{
+    McpConnection *connection = NULL;
+
+    lockMutex(&client->lock);
+    for (int i = 0; i < client->poolSize && !connection; i++) {
+        if (!client->pool[i].busy && client->pool[i].socket != MCP_INVALID_SOCKET) {
+            connection = &client->pool[i];
+        }
+    }
+    for (int i = 0; i < client->poolSize && !connection; i++) {
+        if (!client->pool[i].busy) {
+            connection = &client->pool[i];
+        }
+    }
+    if (connection) {
+        connection->busy = true;
+    }
+    unlockMutex(&client->lock);
+
+    /* With every pooled connection in use, open one that is closed after the request */
+    if (!connection) {
+        connection = (McpConnection *)calloc(1, sizeof(McpConnection));
+        if (!connection) {
+            return NULL;
+        }
+        connection->socket = MCP_INVALID_SOCKET;
+        connection->busy   = true;
+    }
+
+    *reused = connection->socket != MCP_INVALID_SOCKET;
+    if (!*reused) {
+        connection->input.length = 0;
+        connection->socket       = connectWithRetry(client);
+    }
+    return connection;
+}
+
+static void releaseConnection(TinyAIMcpClient *client, McpConnection *connection, bool keepOpen)
+{
+    connection->cancel = NULL;
+    if (!keepOpen || !connection->pooled) {
+        closeConnection(connection);
+    }
+
+    if (!connection->pooled) {
+        free(connection->input.data);
+        free(connection);
+        return;
+    }
+
+    lockMutex(&client->lock);
+    connection->busy = false;
+    unlockMutex(&client->lock);
+}
+
+static void closePool(TinyAIMcpClient *client)
+{
+    for (int i = 0; i < client->poolSize; i++) {
+        closeConnection(&client->pool[i]);
+        free(client->pool[i].input.data);
+    }
+    free(client->pool);
+    client->pool     = NULL;
+    client->poolSize = 0;
+}
+
+static bool createPool(TinyAIMcpClient *client)
+{
+    int size = client->config.maxConnections > 0 ? client->config.maxConnections
+                                                 : DEFAULT_MAX_CONNECTIONS;
+    client->pool = (McpConnection *)calloc((size_t)size, sizeof(McpConnection));
+    if (!client->pool) {
+        return false;
+    }
+
+    for (int i = 0; i < size; i++) {
+        client->pool[i].socket = MCP_INVALID_SOCKET;
+        client->pool[i].pooled = true;
+    }
+    client->poolSize = size;
+    return true;
+}
+
+/* HTTP */
+
+static bool sendAll(const McpConnection *connection, const char *data, size_t length,
+                    double deadline)
+{
+    while (length > 0) {
+        if (waitConnection(connection, true, deadline) <= 0) {
+            return false;
+        }
+        int chunk = length > 65536 ? 65536 : (int)length;
+        int sent  = (int)send(connection->socket, data, chunk, MCP_SEND_FLAGS);
+        if (sent < 0 && socketWouldBlock()) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+/* Read more bytes into a connection's input; returns false on end of stream, error or timeout */
+static bool receiveMore(McpConnection *connection, double deadline)
+{
+    if (!bufferReserve(&connection->input, 4096)) {
+        return false;
+    }
+
+    for (;;) {
+        if (waitConnection(connection, false, deadline) <= 0) {
+            return false;
+        }
+        int received = (int)recv(connection->socket, connection->input.data +
+                                                         connection->input.length,
+                                 4096, 0);
+        if (received < 0 && socketWouldBlock()) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        connection->input.length += (size_t)received;
+        connection->input.data[connection->input.length] = '\0';
+        return true;
+    }
+}
+
+/* Wait until the input holds at least a number of bytes */
+static bool ensureInput(McpConnection *connection, size_t count, double deadline)
+{
+    while (connection->input.length < count) {
+        if (!receiveMore(connection, deadline)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Receiver of the notifications streamed ahead of a reply
+ */
+typedef struct {
+    void (*onEvent)(const char *data, size_t length, void *userData);
+    void *userData;
+} McpEventSink;
+
+/**
+ * @brief Incremental parser of a text/event-stream body
+ */
+typedef struct {
+    bool                active;   /* The body is an event stream */
+    const McpEventSink *sink;     /* Receiver of notification events (NULL to drop them) */
+    McpBuffer           reply;    /* Data of the event holding the JSON-RPC reply */
+    bool                hasReply; /* The reply event has arrived */
+} McpEventStream;
+
+/* Handle one event: the JSON-RPC reply is kept, anything else goes to the sink */
+static bool handleEvent(McpEventStream *stream, const char *event, size_t eventLength)
+{
+    McpBuffer data = {NULL, 0, 0};
+    bool      ok   = true;
+
+    for (size_t offset = 0; offset < eventLength && ok;) {
+        const char *line    = event + offset;
+        const char *newline = (const char *)memchr(line, '\n', eventLength - offset);
+        size_t      length  = newline ? (size_t)(newline - line) : eventLength - offset;
+        offset += length + 1;
+        if (length > 0 && line[length - 1] == '\r') {
+            length--;
+        }
+        if (length >= 5 && strncmp(line, "data:", 5) == 0) {
+            size_t skip = length > 5 && line[5] == ' ' ? 6 : 5;
+            ok          = (data.length == 0 || bufferAppend(&data, "\n", 1)) &&
+                 bufferAppend(&data, line + skip, length - skip);
+        }
+    }
+    if (!ok || data.length == 0) {
+        free(data.data);
+        return ok;
+    }
+
+    size_t length;
+    bool   isReply = jsonFindMember(data.data, "result", &length) ||
+                   jsonFindMember(data.data, "error", &length);
+    if (isReply && !stream->hasReply) {
+        stream->reply    = data;
+        stream->hasReply = true;
+        return true;
+    }
+    if (!isReply && stream->sink && stream->sink->onEvent) {
+        stream->sink->onEvent(data.data, data.length, stream->sink->userData);
+    }
+    free(data.data);
+    return true;
+}
+
+/* Pass on the complete events at the front of a body, dropping them from it */
+static bool dispatchEvents(McpEventStream *stream, McpBuffer *body, bool final)
+{
+    size_t start = 0;
+    bool   ok    = true;
+
+    for (size_t lineStart = 0; ok && lineStart < body->length;) {
+        const char *newline =
+            (const char *)memchr(body->data + lineStart, '\n', body->length - lineStart);
+        if (!newline) {
+            break;
+        }
+        size_t lineEnd = (size_t)(newline - body->data);
+        size_t length  = lineEnd - lineStart;
+        if (length > 0 && body->data[lineEnd - 1] == '\r') {
+            length--;
+        }
+        if (length == 0) {
+            ok    = handleEvent(stream, body->data + start, lineStart - start);
+            start = lineEnd + 1;
+        }
+        lineStart = lineEnd + 1;
+    }
+    if (ok && final && start < body->length) {
+        ok    = handleEvent(stream, body->data + start, body->length - start);
+        start = body->length;
+    }
+
+    bufferConsume(body, start);
+    return ok;
+}
+
+/* Add received body bytes to a response, streaming out any events they complete */
+static bool appendBody(McpResponse *response, McpEventStream *stream, const char *data,
+                       size_t length)
+{
+    return bufferAppend(&response->body, data, length) &&
+           (!stream->active || dispatchEvents(stream, &response->body, false));
+}
+
+/* Read a chunked body into a response */
+static bool readChunkedBody(McpConnection *connection, McpResponse *response,
+                            McpEventStream *stream, double deadline)
+{
+    for (;;) {
+        char *lineEnd;
+        while (!(lineEnd = strstr(connection->input.data ? connection->input.data : "", "\r\n"))) {
+            if (connection->input.length > MAX_HEADER_BYTES ||
+                !receiveMore(connection, deadline)) {
+                return false;
+            }
+        }
+
+        size_t size       = strtoul(connection->input.data, NULL, 16);
+        size_t lineLength = (size_t)(lineEnd - connection->input.data) + 2;
+        if (size == 0) {
+            /* Skip trailers up to the empty line ending the body */
+            bufferConsume(&connection->input, lineLength);
+            while (!(lineEnd = strstr(connection->input.data, "\r\n"))) {
+                if (connection->input.length > MAX_HEADER_BYTES ||
+                    !receiveMore(connection, deadline)) {
+                    return false;
+                }
+            }
+            size_t trailerLength = (size_t)(lineEnd - connection->input.data) + 2;
+            bufferConsume(&connection->input, trailerLength);
+            if (trailerLength == 2) {
+                return true;
+            }
+            continue;
+        }
+
+        if (!ensureInput(connection, lineLength + size + 2, deadline) ||
+            !appendBody(response, stream, connection->input.data + lineLength, size)) {
+            return false;
+        }
+        bufferConsume(&connection->input, lineLength + size + 2);
+    }
+}
+
+/**
+ * Read one HTTP response from a connection
+ *
+ * An event-stream body is parsed as it arrives: the event holding the
+ * JSON-RPC reply becomes the body, and the notifications ahead of it
+ * (such as progress or partial results) go to the sink. anyReceived
+ * reports whether any of the response arrived.
+ */
+static bool readResponse(McpConnection *connection, McpResponse *response,
+                         const McpEventSink *sink, double deadline, bool *anyReceived)
+{
+    memset(response, 0, sizeof(McpResponse));
+
+    for (;;) {
+        /* Headers */
+        char *headerEnd;
+        while (!(headerEnd = connection->input.length > 0
+                                 ? strstr(connection->input.data, "\r\n\r\n")
+                                 : NULL)) {
+            if (connection->input.length > MAX_HEADER_BYTES ||
+                !receiveMore(connection, deadline)) {
+                return false;
+            }
+            *anyReceived = true;
+        }
+        *anyReceived = true;
+
+        int minor = 1;
+        if (sscanf(connection->input.data, "HTTP/1.%d %d", &minor, &response->status) != 2) {
+            return false;
+        }
+        response->keepAlive = minor >= 1;
+
+        size_t         headerLength  = (size_t)(headerEnd - connection->input.data) + 4;
+        bool           chunked       = false;
+        long           contentLength = -1;
+        McpEventStream stream        = {false, sink, {NULL, 0, 0}, false};
+
+        headerEnd[2] = '\0';
+        for (char *line = strstr(connection->input.data, "\r\n") + 2; *line;) {
+            char *lineEnd = strstr(line, "\r\n");
+            *lineEnd      = '\0';
+
+            const char *value;
+            if ((value = headerValue(line, "content-length"))) {
+                contentLength = strtol(value, NULL, 10);
+            }
+            else if ((value = headerValue(line, "transfer-encoding"))) {
+                chunked = containsToken(value, "chunked");
+            }
+            else if ((value = headerValue(line, "connection"))) {
+                response->keepAlive = !containsToken(value, "close");
+            }
+            else if ((value = headerValue(line, "content-type"))) {
+                stream.active = containsToken(value, "text/event-stream");
+            }
+            else if ((value = headerValue(line, "mcp-session-id"))) {
+                snprintf(response->sessionId, sizeof(response->sessionId), "%s", value);
+            }
+            line = lineEnd + 2;
+        }
+        bufferConsume(&connection->input, headerLength);
+
+        /* Interim replies such as 100 Continue precede the real one */
+        if (response->status >= 100 && response->status < 200) {
+            continue;
+        }
+
+        /* Body, taken as it arrives so streamed events are passed on early */
+        bool ok = true;
+        if (chunked) {
+            ok = readChunkedBody(connection, response, &stream, deadline);
+        }
+        else if (contentLength >= 0) {
+            size_t remaining = (size_t)contentLength;
+            while (ok && remaining > 0) {
+                if (connection->input.length == 0 && !receiveMore(connection, deadline)) {
+                    ok = false;
+                    break;
+                }
+                size_t take = connection->input.length < remaining ? connection->input.length
+                                                                   : remaining;
+                ok          = appendBody(response, &stream, connection->input.data, take);
+                bufferConsume(&connection->input, take);
+                remaining -= take;
+            }
+        }
+        else if (response->status != 202 && response->status != 204) {
+            /* Without a length, the body runs to the end of the connection */
+            do {
+                ok = appendBody(response, &stream,
+                                connection->input.data ? connection->input.data : "",
+                                connection->input.length);
+                connection->input.length = 0;
+            } while (ok && receiveMore(connection, deadline));
+            response->keepAlive = false;
+        }
+
+        if (stream.active) {
+            ok = ok && dispatchEvents(&stream, &response->body, true);
+            free(response->body.data);
+            response->body = stream.reply;
+        }
+        return ok;
+    }
+}
+
+static void freeResponse(McpResponse *response)
+{
+    free(response->body.data);
+    memset(response, 0, sizeof(McpResponse));
+}
+
+/* Frame JSON-RPC messages as HTTP requests */
+static bool frameMessages(TinyAIMcpClient *client, const McpBuffer *messages, int count,
+                          McpBuffer *wire)
+{
+    char sessionId[sizeof(client->sessionId)];
+    lockMutex(&client->lock);
+    memcpy(sessionId, client->sessionId, sizeof(sessionId));
+    unlockMutex(&client->lock);
+
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        ok = bufferPrintf(wire,
+                          "POST %s HTTP/1.1\r\n"
+                          "Host: %s:%s\r\n"
+                          "Content-Type: application/json\r\n"
+                          "Accept: application/json, text/event-stream\r\n"
+                          "Connection: keep-alive\r\n"
+                          "Content-Length: %lu\r\n",
+                          client->path, client->host, client->port,
+                          (unsigned long)messages[i].length) &&
+             (!sessionId[0] || bufferPrintf(wire, "Mcp-Session-Id: %s\r\n", sessionId)) &&
+             bufferAppend(wire, "\r\n", 2) &&
+             bufferAppend(wire, messages[i].data, messages[i].length);
+    }
+    return ok;
+}
+
+/**
+ * Post JSON-RPC messages and read their replies in order
+ *
+ * The messages are pipelined on one connection. A connection the server
+ * closes part way is replaced and the unanswered messages are resent, and
+ * so is a reused keep-alive connection that fails before any reply (the
+ * server closed it while idle). Events streamed ahead of each reply go to
+ * the matching sink (if sinks are given), and setting *cancel (if given)
+ * abandons the request. Returns the number of replies read.
+ */
+static int postMessages(TinyAIMcpClient *client, const McpBuffer *messages, int count,
+                        McpResponse *responses, const McpEventSink *sinks,
+                        const volatile int *cancel)
+{
+    int    requestTimeoutMs = client->config.requestTimeoutMs > 0 ? client->config.requestTimeoutMs
+                                                                  : DEFAULT_REQUEST_TIMEOUT_MS;
+    double   deadline       = currentTimeMs() + requestTimeoutMs;
+    int      done           = 0;
+    bool     mayRetry       = true;
+    uint64_t span           = TINYAI_TRACE_BEGIN();
+
+    while (done < count && !(cancel && flagSet(cancel))) {
+        bool           reused;
+        McpConnection *connection = acquireConnection(client, &reused);
+        if (!connection) {
+            break;
+        }
+        if (connection->socket == MCP_INVALID_SOCKET) {
+            releaseConnection(client, connection, false);
+            break;
+        }
+        connection->cancel = cancel;
+
+        McpBuffer wire = {NULL, 0, 0};
+        bool      ok   = frameMessages(client, messages + done, count - done, &wire) &&
+                  sendAll(connection, wire.data, wire.length, deadline);
+        free(wire.data);
+
+        lockMutex(&client->lock);
+        client->stats.requestsSent += count - done;
+        unlockMutex(&client->lock);
+
+        int  first       = done;
+        bool anyReceived = false;
+        bool keepAlive   = true;
+        while (ok && done < count && keepAlive) {
+            ok = readResponse(connection, &responses[done], sinks ? &sinks[done] : NULL, deadline,
+                              &anyReceived);
+            if (ok) {
+                keepAlive = responses[done].keepAlive;
+                done++;
+            }
+            else {
+                freeResponse(&responses[done]);
+            }
+        }
+        releaseConnection(client, connection, ok && keepAlive);
+
+        /* Resend what is left on a new connection after progress, or once after a stale one */
+        if (done > first) {
+            continue;
+        }
+        if (!reused || anyReceived || !mayRetry || remainingMs(deadline) == 0) {
+            break;
+        }
+        mayRetry = false;
+        lockMutex(&client->lock);
+        client->stats.reconnects++;
+        unlockMutex(&client->lock);
+    }
+
+    if (done < count) {
+        setError(client, "No reply from MCP server %s:%s", client->host, client->port);
+    }
+
+    /* Keep the session the server assigned for later requests */
+    for (int i = 0; i < done; i++) {
+        if (responses[i].sessionId[0]) {
+            lockMutex(&client->lock);
+            memcpy(client->sessionId, responses[i].sessionId, sizeof(client->sessionId));
+            unlockMutex(&client->lock);
+        }
+    }
+
+    TINYAI_TRACE_END_ARG(span, "mcp.post", count);
+    return done;
+}
+
+/* JSON-RPC */
+
+/* Build a JSON-RPC request, or a notification (no ID, no reply expected) */
+static bool buildMessage(TinyAIMcpClient *client, McpBuffer *message, const char *method,
+                         const char *params, bool notification)
+{
+    lockMutex(&client->lock);
+    long id = ++client->nextRequestId;
+    unlockMutex(&client->lock);
+
+    return bufferPrintf(message, "{\"jsonrpc\":\"2.0\",") &&
+           (notification || bufferPrintf(message, "\"id\":%ld,", id)) &&
+           bufferPrintf(message, "\"method\":") && bufferAppendJsonString(message, method) &&
+           (!params || bufferPrintf(message, ",\"params\":%s", params)) &&
+           bufferAppend(message, "}", 1);
+}
+
+/* Send one message and wait for its reply */
+static bool sendMessage(TinyAIMcpClient *client, const char *method, const char *params,
+                        bool notification, McpResponse *response)
+{
+    McpBuffer message = {NULL, 0, 0};
+    bool      ok      = buildMessage(client, &message, method, params, notification) &&
+                 postMessages(client, &message, 1, response, NULL, NULL) == 1;
+    free(message.data);
+    return ok;
+}
+
+/**
+ * Take the result of a JSON-RPC reply into a growable buffer
+ *
+ * Returns the length of the result, or -1 with an error message stored
+ * instead when the request failed or the tool reported an error.
+ */
+static int takeRpcResult(const McpResponse *response, McpBuffer *out)
+{
+    out->length = 0;
+    if (response->status < 200 || response->status >= 300) {
+        bufferPrintf(out, "Error: MCP server replied with HTTP status %d", response->status);
+        return -1;
+    }
+
+    const char *body = response->body.data ? response->body.data : "";
+    size_t      length;
+    const char *error = jsonFindMember(body, "error", &length);
+    if (error) {
+        size_t      messageLength = 0;
+        const char *message       = jsonFindMember(error, "message", &messageLength);
+        bufferPrintf(out, "Error: ");
+        bufferAppend(out, message ? message : error, message ? messageLength : length);
+        return -1;
+    }
+
+    const char *value = jsonFindMember(body, "result", &length);
+    if (!value) {
+        bufferPrintf(out, "Error: Invalid reply from MCP server");
+        return -1;
+    }
+    if (!bufferAppend(out, value, length)) {
+        return -1;
+    }
+
+    /* A tool that ran but failed reports it in its result */
+    size_t      flagLength;
+    const char *flag = jsonFindMember(value, "isError", &flagLength);
+    if (flag && flagLength == 4 && strncmp(flag, "true", 4) == 0) {
+        return -1;
+    }
+    return (int)length;
+}
+
+/* Parse an http://host[:port][/path] URL into the client */
+static bool parseServerUrl(TinyAIMcpClient *client, const char *serverUrl)
+{
+    const char *prefix = "http://";
+    if (strncmp(serverUrl, prefix, strlen(prefix)) != 0) {
+        setError(client, "Unsupported MCP server URL (expected http:// or mock://): %s",
+                 serverUrl);
+        return false;
+    }
+
+    const char *host     = serverUrl + strlen(prefix);
+    const char *path     = strchr(host, '/');
+    const char *hostEnd  = path ? path : host + strlen(host);
+    const char *portMark = NULL;
+
+    /* Bracketed IPv6 addresses contain colons of their own */
+    if (*host == '[') {
+        const char *close = memchr(host, ']', (size_t)(hostEnd - host));
+        if (!close) {
+            setError(client, "Invalid MCP server URL: %s", serverUrl);
+            return false;
+        }
+        portMark = close + 1 < hostEnd && close[1] == ':' ? close + 1 : NULL;
+        snprintf(client->host, sizeof(client->host), "%.*s", (int)(close - host - 1), host + 1);
+    }
+    else {
+        portMark = memchr(host, ':', (size_t)(hostEnd - host));
+        snprintf(client->host, sizeof(client->host), "%.*s",
+                 (int)((portMark ? portMark : hostEnd) - host), host);
+    }
+
+    if (portMark) {
+        snprintf(client->port, sizeof(client->port), "%.*s", (int)(hostEnd - portMark - 1),
+                 portMark + 1);
+    }
+    else {
+        strcpy(client->port, "80");
+    }
+    snprintf(client->path, sizeof(client->path), "%s", path ? path : "/");
+
+    if (!client->host[0] || !client->port[0]) {
+        setError(client, "Invalid MCP server URL: %s", serverUrl);
+        return false;
+    }
+    return true;
+}
+
+/* Initialize an MCP session and list the server's tools */
+static bool initializeSession(TinyAIMcpClient *client)
+{
+    McpResponse response;
+    char        params[256];
+    snprintf(params, sizeof(params),
+             "{\"protocolVersion\":\"%s\",\"capabilities\":{},"
+             "\"clientInfo\":{\"name\":\"TinyAI\",\"version\":\"0.1.0\"}}",
+             MCP_PROTOCOL_VERSION);
+
+    if (!sendMessage(client, "initialize", params, false, &response)) {
+        return false;
+    }
+
+    size_t      length;
+    const char *body   = response.body.data ? response.body.data : "";
+    const char *result = response.status == 200 ? jsonFindMember(body, "result", &length) : NULL;
+    if (!result) {
+        setError(client, "MCP server rejected initialization (HTTP status %d)", response.status);
+        freeResponse(&response);
+        return false;
+    }
+
+    size_t      capabilitiesLength = 0;
+    const char *capabilities       = jsonFindMember(result, "capabilities", &capabilitiesLength);
+    const char *serverInfo         = jsonFindMember(result, "serverInfo", &length);
+    copyText(client->serverCapabilities, sizeof(client->serverCapabilities),
+             capabilities ? capabilities : "{}", capabilities ? capabilitiesLength : 2);
+    copyJsonString(serverInfo, "name", client->serverName, sizeof(client->serverName));
+    copyJsonString(serverInfo, "version", client->serverVersion, sizeof(client->serverVersion));
+    bool hasTools = capabilities && jsonFindMember(capabilities, "tools", &length);
+    freeResponse(&response);
+
+    if (!sendMessage(client, "notifications/initialized", NULL, true, &response)) {
+        return false;
+    }
+    freeResponse(&response);
+
+    /* Tool names let tinyaiMcpHasCapability answer without asking the server */
+    if (hasTools && sendMessage(client, "tools/list", "{}", false, &response)) {
+        body   = response.body.data ? response.body.data : "";
+        result = jsonFindMember(body, "result", &length);
+        if (result) {
+            client->tools = (char *)malloc(length + 1);
+            if (client->tools) {
+                memcpy(client->tools, result, length);
+                client->tools[length] = '\0';
+            }
+        }
+        freeResponse(&response);
+    }
+
+    return true;
+}
+
+/* Response cache */
+
+/* Write a JSON value in canonical form: no whitespace, object members sorted; returns its end */
+static const char *canonicalJson(const char *p, McpBuffer *out)
+{
+    p = jsonSkipSpace(p);
+    if (*p != '{' && *p != '[') {
+        const char *end = jsonSkipValue(p);
+        return end && bufferAppend(out, p, (size_t)(end - p)) ? end : NULL;
+    }
+
+    /* Arrays keep their order; objects are written with their members sorted by name */
+    bool        object = *p == '{';
+    char        close  = object ? '}' : ']';
+    const char *items[64];
+    int         count = 0;
+
+    p = jsonSkipSpace(p + 1);
+    while (*p != close) {
+        if (count == (int)(sizeof(items) / sizeof(items[0])) || (object && *p != '"')) {
+            return NULL;
+        }
+        items[count++] = p;
+
+        const char *end = object ? jsonSkipString(p) : jsonSkipValue(p);
+        if (end && object) {
+            end = jsonSkipSpace(end);
+            end = *end == ':' ? jsonSkipValue(end + 1) : NULL;
+        }
+        if (!end) {
+            return NULL;
+        }
+        p = jsonSkipSpace(end);
+        if (*p == ',') {
+            p = jsonSkipSpace(p + 1);
+        }
+        else if (*p != close) {
+            return NULL;
+        }
+    }
+
+    for (int i = 1; object && i < count; i++) {
+        const char *item   = items[i];
+        size_t      length = (size_t)(jsonSkipString(item) - item);
+        int         j      = i;
+        while (j > 0) {
+            size_t previous = (size_t)(jsonSkipString(items[j - 1]) - items[j - 1]);
+            size_t shortest = length < previous ? length : previous;
+            int    order    = memcmp(items[j - 1], item, shortest);
+            if (order < 0 || (order == 0 && previous <= length)) {
+                break;
+            }
+            items[j] = items[j - 1];
+            j--;
+        }
+        items[j] = item;
+    }
+
+    bool ok = bufferAppend(out, object ? "{" : "[", 1);
+    for (int i = 0; i < count && ok; i++) {
+        const char *value = items[i];
+        if (i > 0) {
+            ok = bufferAppend(out, ",", 1);
+        }
+        if (object && ok) {
+            const char *nameEnd = jsonSkipString(value);
+            ok                  = bufferAppend(out, value, (size_t)(nameEnd - value)) &&
+                 bufferAppend(out, ":", 1);
+            value = jsonSkipSpace(nameEnd) + 1;
+        }
+        ok = ok && canonicalJson(value, out);
+    }
+    return ok && bufferAppend(out, &close, 1) ? p + 1 : NULL;
+}
+
+/* Build the cache key of a call: its kind, name and arguments in canonical form */
+static bool buildCacheKey(const char *name, const char *arguments, bool resource, McpBuffer *key)
+{
+    if (!bufferPrintf(key, "%s %s\n", resource ? "resource" : "tool", name)) {
+        return false;
+    }
+
+    /* Arguments that are not valid JSON are used as given */
+    size_t      prefix = key->length;
+    const char *text   = arguments && arguments[0] ? arguments : "{}";
+    const char *end    = canonicalJson(text, key);
+    if (!end || *jsonSkipSpace(end)) {
+        key->length = prefix;
+        return bufferAppend(key, text, strlen(text));
+    }
+    return true;
+}
+
+/* FNV-1a hash of a key */
+static uint32_t hashKey(const char *key, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static McpCache *createCache(const TinyAIMcpCacheConfig *config)
+{
+    McpCache *cache = (McpCache *)calloc(1, sizeof(McpCache));
+    if (!cache)
+        return NULL;
+
+    cache->config = *config;
+    if (cache->config.maxEntries <= 0)
+        cache->config.maxEntries = DEFAULT_CACHE_ENTRIES;
+    if (cache->config.maxBytes == 0)
+        cache->config.maxBytes = DEFAULT_CACHE_BYTES;
+    if (cache->config.ttlMs <= 0)
+        cache->config.ttlMs = DEFAULT_CACHE_TTL_MS;
+    if (cache->config.staleMs < 0)
+        cache->config.staleMs = 0;
+
+    /* Keep chains short: at least two buckets per entry */
+    cache->bucketCount = 16;
+    while (cache->bucketCount < (uint32_t)cache->config.maxEntries * 2 &&
+           cache->bucketCount < (1u << 20)) {
+        cache->bucketCount *= 2;
+    }
+    cache->buckets = (McpCacheEntry **)calloc(cache->bucketCount, sizeof(McpCacheEntry *));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static McpCacheEntry *findCacheEntry(McpCache *cache, const McpBuffer *key, uint32_t hash)
+{
+    for (McpCacheEntry *entry = cache->buckets[hash & (cache->bucketCount - 1)]; entry;
+         entry = entry->chain) {
+        if (entry->hash == hash && entry->keyLength == key->length &&
+            memcmp(entry->key, key->data, key->length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* Unlink an entry from the recency list */
+static void detachCacheEntry(McpCache *cache, McpCacheEntry *entry)
+{
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        cache->newest = entry->older;
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        cache->oldest = entry->newer;
+    entry->newer = entry->older = NULL;
+}
+
+/* Make an entry the most recently used */
+static void touchCacheEntry(McpCache *cache, McpCacheEntry *entry)
+{
+    if (cache->newest == entry) {
+        return;
+    }
+    if (entry->newer || entry->older || cache->oldest == entry) {
+        detachCacheEntry(cache, entry);
+    }
+    entry->older = cache->newest;
+    if (cache->newest)
+        cache->newest->newer = entry;
+    cache->newest = entry;
+    if (!cache->oldest)
+        cache->oldest = entry;
+}
+
+static void removeCacheEntry(McpCache *cache, McpCacheEntry *entry)
+{
+    for (McpCacheEntry **link = &cache->buckets[entry->hash & (cache->bucketCount - 1)]; *link;
+         link = &(*link)->chain) {
+        if (*link == entry) {
+            *link = entry->chain;
+            break;
+        }
+    }
+    detachCacheEntry(cache, entry);
+
+    cache->stats.entries--;
+    cache->stats.bytes -= entry->keyLength + entry->length;
+    free(entry->key);
+    free(entry->value);
+    free(entry);
+}
+
+static void destroyCache(McpCache *cache)
+{
+    if (!cache)
+        return;
+    while (cache->oldest) {
+        removeCacheEntry(cache, cache->oldest);
+    }
+    free(cache->buckets);
+    free(cache);
+}
+
+/**
+ * Look up a key (client lock held)
+ *
+ * Copies a fresh or stale result into value. revalidate is set when the
+ * result is stale and no refresh is in flight yet; the caller then starts
+ * one. Expired results are dropped.
+ */
+static McpCacheLookup lookupCache(McpCache *cache, const McpBuffer *key, McpBuffer *value,
+                                  bool *revalidate)
+{
+    double         now   = currentTimeMs();
+    McpCacheEntry *entry = findCacheEntry(cache, key, hashKey(key->data, key->length));
+    *revalidate          = false;
+
+    if (entry && now >= entry->staleUntil) {
+        removeCacheEntry(cache, entry);
+        entry = NULL;
+    }
+    if (!entry || !bufferAppend(value, entry->value, entry->length)) {
+        cache->stats.misses++;
+        return CACHE_MISS;
+    }
+
+    touchCacheEntry(cache, entry);
+    if (now < entry->expiresAt) {
+        cache->stats.hits++;
+        return CACHE_FRESH;
+    }
+
+    cache->stats.staleHits++;
+    if (!entry->revalidating) {
+        entry->revalidating = true;
+        *revalidate         = true;
+        cache->stats.revalidations++;
+    }
+    return CACHE_STALE;
+}
+
+/* Cache a result, evicting the least recently used ones beyond the bounds (client lock held) */
+static void storeCache(McpCache *cache, const McpBuffer *key, const char *value, size_t length)
+{
+    uint32_t       hash  = hashKey(key->data, key->length);
+    McpCacheEntry *entry = findCacheEntry(cache, key, hash);
+    if (entry) {
+        removeCacheEntry(cache, entry);
+    }
+    if (key->length + length > cache->config.maxBytes) {
+        return;
+    }
+
+    entry = (McpCacheEntry *)calloc(1, sizeof(McpCacheEntry));
+    if (!entry)
+        return;
+    entry->key   = (char *)malloc(key->length + 1);
+    entry->value = (char *)malloc(length + 1);
+    if (!entry->key || !entry->value) {
+        free(entry->key);
+        free(entry->value);
+        free(entry);
+        return;
+    }
+
+    memcpy(entry->key, key->data, key->length + 1);
+    memcpy(entry->value, value, length);
+    entry->value[length] = '\0';
+    entry->keyLength     = key->length;
+    entry->length        = length;
+    entry->hash          = hash;
+    entry->expiresAt     = currentTimeMs() + cache->config.ttlMs;
+    entry->staleUntil    = entry->expiresAt + cache->config.staleMs;
+
+    while (cache->oldest && (cache->stats.entries + 1 > cache->config.maxEntries ||
+                             cache->stats.bytes + key->length + length > cache->config.maxBytes)) {
+        removeCacheEntry(cache, cache->oldest);
+        cache->stats.evictions++;
+    }
+
+    McpCacheEntry **bucket = &cache->buckets[hash & (cache->bucketCount - 1)];
+    entry->chain           = *bucket;
+    *bucket                = entry;
+    touchCacheEntry(cache, entry);
+    cache->stats.entries++;
+    cache->stats.bytes += key->length + length;
+}
+
+/* Let a stale result be refreshed again after a failed refresh (client lock held) */
+static void endRevalidation(McpCache *cache, const McpBuffer *key)
+{
+    McpCacheEntry *entry = findCacheEntry(cache, key, hashKey(key->data, key->length));
+    if (entry) {
+        entry->revalidating = false;
+    }
+}
+
+/* Cache key of a call if the cache is enabled (mock servers are not cached) */
+static bool cacheKeyFor(TinyAIMcpClient *client, const char *name, const char *arguments,
+                        bool resource, McpBuffer *key)
+{
+    lockMutex(&client->lock);
+    bool enabled = client->cache != NULL;
+    unlockMutex(&client->lock);
+
+    if (!enabled || client->mock || !buildCacheKey(name, arguments, resource, key)) {
+        key->length = 0;
+        return false;
+    }
+    return true;
+}
+
+static TinyAIMcpAsyncCall *submitAsyncCall(TinyAIMcpClient *client, const char *name,
+                                           const char *arguments, bool resource,
+                                           const TinyAIMcpAsyncOptions *options, bool useCache);
+
+/* Drop a background refresh once it finishes; the worker has already cached its result */
+static void releaseRefresh(TinyAIMcpAsyncCall *call, void *userData)
+{
+    (void)userData;
+    tinyaiMcpAsyncCallRelease(call);
+}
+
+/**
+ * Answer a call from the cache
+ *
+ * A stale result is answered too, and a background call is started to
+ * refresh it. Returns the length of the result, or -1 on a miss.
+ */
+static int answerFromCache(TinyAIMcpClient *client, const McpBuffer *key, const char *name,
+                           const char *arguments, bool resource, McpBuffer *result)
+{
+    McpCacheLookup found      = CACHE_MISS;
+    bool           revalidate = false;
+    lockMutex(&client->lock);
+    if (client->cache) {
+        found = lookupCache(client->cache, key, result, &revalidate);
+    }
+    unlockMutex(&client->lock);
+
+    if (revalidate) {
+        TinyAIMcpAsyncOptions options = {NULL, releaseRefresh, NULL};
+        if (!submitAsyncCall(client, name, arguments, resource, &options, false)) {
+            lockMutex(&client->lock);
+            if (client->cache) {
+                endRevalidation(client->cache, key);
+            }
+            unlockMutex(&client->lock);
+        }
+    }
+    return found == CACHE_MISS ? -1 : (int)result->length;
+}
+
+/* Cache a successful result, or let a failed one be refreshed again */
+static void updateCache(TinyAIMcpClient *client, const McpBuffer *key, const McpBuffer *result,
+                        bool succeeded)
+{
+    lockMutex(&client->lock);
+    if (client->cache && succeeded) {
+        storeCache(client->cache, key, result->data ? result->data : "", result->length);
+    }
+    else if (client->cache) {
+        endRevalidation(client->cache, key);
+    }
+    unlockMutex(&client->lock);
+}
+
+/* Simulated server for mock:// URLs */
+
+static void connectMock(TinyAIMcpClient *client)
+{
+    strcpy(client->serverName, "TinyAI MCP Server");
+    strcpy(client->serverVersion, "0.1.0");
+
+    /* Set some default capabilities for testing */
+    strcpy(
+        client->serverCapabilities,
+        "{"
+        "  \"tools\": ["
+        "    {\"name\": \"generate_text\", \"description\": \"Generate text with remote model\"},"
+        "    {\"name\": \"tokenize_text\", \"description\": \"Tokenize text with remote model\"},"
+        "    {\"name\": \"convert_model\", \"description\": \"Convert model to TinyAI format\"}"
+        "  ],"
+        "  \"resources\": ["
+        "    {\"name\": \"model_repository\", \"description\": \"Access models from repository\"},"
+        "    {\"name\": \"knowledge_base\", \"description\": \"Access knowledge base data\"}"
+        "  ]"
+        "}");
+}
+
+static int callMockTool(const char *toolName, const char *arguments, char *result,
+                        int resultSize)
+{
+    if (strcmp(toolName, "generate_text") == 0) {
+        snprintf(result, resultSize, "Generated text based on arguments: %s",
+                 arguments ? arguments : "none");
+    }
+    else if (strcmp(toolName, "tokenize_text") == 0) {
+        snprintf(result, resultSize, "Tokenized text based on arguments: %s",
+                 arguments ? arguments : "none");
+    }
+    else if (strcmp(toolName, "convert_model") == 0) {
+        snprintf(result, resultSize, "Model conversion initiated with arguments: %s",
+                 arguments ? arguments : "none");
+    }
+    else {
+        snprintf(result, resultSize, "Executed tool '%s' with arguments: %s", toolName,
+                 arguments ? arguments : "none");
+    }
+
+    return strlen(result);
+}
+
+static int accessMockResource(const char *resourceUri, char *result, int resultSize)
+{
+    if (strstr(resourceUri, "model_repository") != NULL) {
+        snprintf(result, resultSize, "Model repository data for URI: %s", resourceUri);
+    }
+    else if (strstr(resourceUri, "knowledge_base") != NULL) {
+        snprintf(result, resultSize, "Knowledge base data for URI: %s", resourceUri);
+    }
+    else {
+        snprintf(result, resultSize, "Resource data for URI: %s", resourceUri);
+    }
+
+    return strlen(result);
+}
+
+/* Tool calls */
+
+/* Make tool calls with pipelined requests */
+static int callTools(TinyAIMcpClient *client, TinyAIMcpToolCall *calls, int count)
+{
+    /* If not connected, can't call tools */
+    if (client->connectionState != TINYAI_MCP_CONNECTED) {
+        for (int i = 0; i < count; i++) {
+            if (calls[i].result && calls[i].resultSize > 0) {
+                snprintf(calls[i].result, calls[i].resultSize,
+                         "Error: Not connected to MCP server");
+            }
+            calls[i].resultLength = -1;
+        }
+        return -1;
+    }
+
+    McpBuffer   *messages  = (McpBuffer *)calloc((size_t)count, sizeof(McpBuffer));
+    McpBuffer   *keys      = (McpBuffer *)calloc((size_t)count, sizeof(McpBuffer));
+    McpResponse *responses = (McpResponse *)calloc((size_t)count, sizeof(McpResponse));
+    int         *indices   = (int *)malloc((size_t)count * sizeof(int));
+    int          batched   = 0;
+    int          succeeded = 0;
+    bool         ok        = messages && keys && responses && indices;
+
+    /* Check every call and build the requests of those that can be made */
+    for (int i = 0; i < count && ok; i++) {
+        TinyAIMcpToolCall *call = &calls[i];
+        call->resultLength      = -1;
+        if (!call->toolName || !call->result || call->resultSize <= 0) {
+            continue;
+        }
+        if (!tinyaiMcpHasCapability(client, call->toolName)) {
+            snprintf(call->result, call->resultSize, "Error: Tool '%s' not supported by server",
+                     call->toolName);
+            continue;
+        }
+
+        if (client->mock) {
+            call->resultLength =
+                callMockTool(call->toolName, call->arguments, call->result, call->resultSize);
+            succeeded++;
+            continue;
+        }
+
+        /* Cached results need no request */
+        McpBuffer cached = {NULL, 0, 0};
+        if (cacheKeyFor(client, call->toolName, call->arguments, false, &keys[batched]) &&
+            answerFromCache(client, &keys[batched], call->toolName, call->arguments, false,
+                            &cached) >= 0) {
+            call->resultLength = copyText(call->result, call->resultSize,
+                                          cached.data ? cached.data : "", cached.length);
+            free(cached.data);
+            keys[batched].length = 0;
+            succeeded++;
+            continue;
+        }
+        free(cached.data);
+
+        McpBuffer params = {NULL, 0, 0};
+        ok = bufferPrintf(&params, "{\"name\":") &&
+             bufferAppendJsonString(&params, call->toolName) &&
+             bufferPrintf(&params, ",\"arguments\":%s}",
+                          call->arguments && call->arguments[0] ? call->arguments : "{}") &&
+             buildMessage(client, &messages[batched], "tools/call", params.data, false);
+        free(params.data);
+        indices[batched++] = i;
+    }
+
+    /* Pipeline the requests and match the replies to the calls in order */
+    int received =
+        ok && batched > 0 ? postMessages(client, messages, batched, responses, NULL, NULL) : 0;
+    for (int b = 0; b < batched; b++) {
+        TinyAIMcpToolCall *call = &calls[indices[b]];
+        if (b < received) {
+            McpBuffer taken  = {NULL, 0, 0};
+            int       length = takeRpcResult(&responses[b], &taken);
+            int written = copyText(call->result, call->resultSize, taken.data ? taken.data : "",
+                                   taken.length);
+            call->resultLength = length < 0 ? -1 : written;
+            succeeded += call->resultLength >= 0;
+            if (keys[b].length > 0) {
+                updateCache(client, &keys[b], &taken, length >= 0);
+            }
+            free(taken.data);
+        }
+        else {
+            snprintf(call->result, call->resultSize, "Error: No reply from MCP server");
+        }
+        freeResponse(&responses[b]);
+        free(messages[b].data);
+    }
+    for (int i = 0; keys && i < count; i++) {
+        free(keys[i].data);
+    }
+
+    free(messages);
+    free(keys);
+    free(responses);
+    free(indices);
+    return succeeded;
+}
+
+/* Asynchronous calls */
+
+static char *copyString(const char *text)
+{
+    size_t length = strlen(text) + 1;
+    char  *copy   = (char *)malloc(length);
+    if (copy) {
+        memcpy(copy, text, length);
+    }
+    return copy;
+}
+
+static void freeAsyncCall(TinyAIMcpAsyncCall *call)
+{
+    free(call->name);
+    free(call->arguments);
+    free(call->cacheKey.data);
+    free(call->result.data);
+    free(call);
+}
+
+/* Remove a call from the client's unfinished calls (client lock held) */
+static void unlinkAsyncCall(TinyAIMcpClient *client, TinyAIMcpAsyncCall *call)
+{
+    TinyAIMcpAsyncCall *previous = NULL;
+    for (TinyAIMcpAsyncCall **link = &client->asyncCalls; *link;
+         previous = *link, link = &(*link)->next) {
+        if (*link == call) {
+            *link = call->next;
+            if (client->asyncTail == call) {
+                client->asyncTail = previous;
+            }
+            return;
+        }
+    }
+}
+
+/* Drop a reference to an asynchronous call, freeing it with the last one */
+static void releaseAsyncCall(TinyAIMcpAsyncCall *call)
+{
+    TinyAIMcpClient *client = call->client;
+    lockMutex(&client->lock);
+    bool last = --call->references == 0;
+    unlockMutex(&client->lock);
+
+    if (last) {
+        freeAsyncCall(call);
+    }
+}
+
 /**
- * @brief MCP client implementation structure
+ * Finish a call unless it already has (client lock held)
+ *
+ * Takes over the result buffer, leaving it empty. Returns whether the call
+ * finished now, in which case the caller runs its completion callback once
+ * the lock is released.
  */
-struct TinyAIMcpClient {
-    TinyAIMcpConfig          config;                   /* Client configuration */
-    TinyAIMcpConnectionState connectionState;          /* Current connection state */
-    char                     serverUrl[256];           /* Current server URL */
-    time_t                   lastConnectionAttempt;    /* Timestamp of last connection attempt */
-    int                      connectionAttempts;       /* Number of connection attempts */
-    char                     lastError[256];           /* Last error message */
-    bool                     isConnectionActive;       /* Whether connection is active */
-    char                     serverCapabilities[1024]; /* Server capabilities */
-};
+static bool finishAsyncCall(TinyAIMcpClient *client, TinyAIMcpAsyncCall *call,
+                            TinyAIMcpCallStatus status, McpBuffer *result, int resultLength)
+{
+    if (call->status != TINYAI_MCP_CALL_QUEUED && call->status != TINYAI_MCP_CALL_RUNNING) {
+        return false;
+    }
 
-/* Default configuration values */
-#define DEFAULT_TIMEOUT_MS 5000
-#define DEFAULT_MAX_RETRIES 3
+    /* The request is abandoned once none of the calls sharing it is waiting for it */
+    if (call->status == TINYAI_MCP_CALL_QUEUED) {
+        client->queuedCalls--;
+    }
+    else if (call->batch && --call->batch->live == 0) {
+        setFlag(&call->batch->cancelled);
+    }
+
+    free(call->result.data);
+    call->result       = *result;
+    call->resultLength = resultLength;
+    call->status       = status;
+    call->batch        = NULL;
+    memset(result, 0, sizeof(McpBuffer));
+
+    unlinkAsyncCall(client, call);
+    broadcastCondition(&client->asyncChanged);
+    return true;
+}
+
+/* Cancel a call that has not finished, running its completion callback */
+static void cancelAsyncCall(TinyAIMcpAsyncCall *call)
+{
+    TinyAIMcpClient *client  = call->client;
+    McpBuffer        message = {NULL, 0, 0};
+    bufferPrintf(&message, "Error: Call cancelled");
+
+    lockMutex(&client->lock);
+    bool finished = finishAsyncCall(client, call, TINYAI_MCP_CALL_CANCELLED, &message, -1);
+    unlockMutex(&client->lock);
+    free(message.data);
+
+    if (finished && call->options.onComplete) {
+        call->options.onComplete(call, call->options.userData);
+    }
+}
+
+/* Pass a notification streamed ahead of a reply to its call */
+static void forwardPartial(const char *data, size_t length, void *userData)
+{
+    TinyAIMcpAsyncCall *call   = (TinyAIMcpAsyncCall *)userData;
+    TinyAIMcpClient    *client = call->client;
+
+    lockMutex(&client->lock);
+    bool running = call->status == TINYAI_MCP_CALL_RUNNING;
+    unlockMutex(&client->lock);
+
+    if (running) {
+        call->options.onPartial(call, data, (int)length, call->options.userData);
+    }
+}
+
+/* Build the JSON-RPC request of an asynchronous call */
+static bool buildAsyncMessage(TinyAIMcpClient *client, const TinyAIMcpAsyncCall *call,
+                              McpBuffer *message)
+{
+    McpBuffer params = {NULL, 0, 0};
+    bool      ok;
+    if (call->resource) {
+        ok = bufferPrintf(&params, "{\"uri\":") && bufferAppendJsonString(&params, call->name) &&
+             bufferAppend(&params, "}", 1);
+    }
+    else {
+        ok = bufferPrintf(&params, "{\"name\":") && bufferAppendJsonString(&params, call->name) &&
+             bufferPrintf(&params, ",\"arguments\":%s}",
+                          call->arguments && call->arguments[0] ? call->arguments : "{}");
+    }
+    ok = ok && buildMessage(client, message, call->resource ? "resources/read" : "tools/call",
+                            params.data, false);
+    free(params.data);
+    return ok;
+}
+
+/* Make a batch of calls with pipelined requests and finish each with its result */
+static void runAsyncBatch(TinyAIMcpClient *client, McpBatch *batch, TinyAIMcpAsyncCall **calls,
+                          int count)
+{
+    McpBuffer    results[ASYNC_BATCH_MAX];
+    int          lengths[ASYNC_BATCH_MAX];
+    bool         finished[ASYNC_BATCH_MAX];
+    McpBuffer    messages[ASYNC_BATCH_MAX];
+    McpResponse  responses[ASYNC_BATCH_MAX];
+    McpEventSink sinks[ASYNC_BATCH_MAX];
+    int          indices[ASYNC_BATCH_MAX];
+    int          batched   = 0;
+    bool         connected = client->connectionState == TINYAI_MCP_CONNECTED;
+
+    memset(results, 0, sizeof(results));
+    memset(messages, 0, sizeof(messages));
+
+    /* Check every call and build the requests of those that can be made */
+    for (int i = 0; i < count; i++) {
+        TinyAIMcpAsyncCall *call = calls[i];
+        lengths[i]               = -1;
+        if (!connected) {
+            bufferPrintf(&results[i], "Error: Not connected to MCP server");
+            continue;
+        }
+        if (!call->resource && !tinyaiMcpHasCapability(client, call->name)) {
+            bufferPrintf(&results[i], "Error: Tool '%s' not supported by server", call->name);
+            continue;
+        }
+
+        if (client->mock) {
+            char mockResult[1024];
+            lengths[i] = call->resource
+                             ? accessMockResource(call->name, mockResult, sizeof(mockResult))
+                             : callMockTool(call->name, call->arguments, mockResult,
+                                            sizeof(mockResult));
+            bufferAppend(&results[i], mockResult, (size_t)lengths[i]);
+            continue;
+        }
+
+        if (!buildAsyncMessage(client, call, &messages[batched])) {
+            free(messages[batched].data);
+            memset(&messages[batched], 0, sizeof(McpBuffer));
+            bufferPrintf(&results[i], "Error: Out of memory");
+            continue;
+        }
+        sinks[batched].onEvent  = call->options.onPartial ? forwardPartial : NULL;
+        sinks[batched].userData = call;
+        indices[batched++]      = i;
+    }
+
+    /* Pipeline the requests and match the replies to the calls in order */
+    int received =
+        batched > 0 ? postMessages(client, messages, batched, responses, sinks, &batch->cancelled)
+                    : 0;
+    for (int b = 0; b < batched; b++) {
+        int i = indices[b];
+        if (b < received) {
+            lengths[i] = takeRpcResult(&responses[b], &results[i]);
+            freeResponse(&responses[b]);
+        }
+        else {
+            bufferPrintf(&results[i], "Error: No reply from MCP server");
+        }
+        free(messages[b].data);
+    }
+
+    /* Cache the results before they are handed over */
+    for (int i = 0; i < count; i++) {
+        if (calls[i]->cacheKey.length > 0) {
+            updateCache(client, &calls[i]->cacheKey, &results[i], lengths[i] >= 0);
+        }
+    }
+
+    lockMutex(&client->lock);
+    for (int i = 0; i < count; i++) {
+        finished[i] = finishAsyncCall(client, calls[i],
+                                      lengths[i] >= 0 ? TINYAI_MCP_CALL_SUCCEEDED
+                                                      : TINYAI_MCP_CALL_FAILED,
+                                      &results[i], lengths[i]);
+    }
+    unlockMutex(&client->lock);
+
+    for (int i = 0; i < count; i++) {
+        free(results[i].data);
+        if (finished[i] && calls[i]->options.onComplete) {
+            calls[i]->options.onComplete(calls[i], calls[i]->options.userData);
+        }
+    }
+}
+
+/* Worker thread: run queued calls in pipelined batches until told to stop */
+#ifdef _WIN32
+static unsigned __stdcall asyncWorker(void *arg)
+#else
+static void *asyncWorker(void *arg)
+#endif
+{
+    TinyAIMcpClient    *client = (TinyAIMcpClient *)arg;
+    TinyAIMcpAsyncCall *calls[ASYNC_BATCH_MAX];
+    tinyaiTraceSetThreadName("mcp worker");
+
+    lockMutex(&client->lock);
+    while (!client->stopWorkers) {
+        if (client->queuedCalls == 0) {
+            client->idleWorkers++;
+            waitCondition(&client->workQueued, &client->lock, -1);
+            client->idleWorkers--;
+            continue;
+        }
+
+        /* Take the oldest queued calls, holding a reference to each while it runs */
+        McpBatch batch = {0, 0};
+        int      count = 0;
+        for (TinyAIMcpAsyncCall *call = client->asyncCalls; call && count < ASYNC_BATCH_MAX;
+             call = call->next) {
+            if (call->status == TINYAI_MCP_CALL_QUEUED) {
+                call->status = TINYAI_MCP_CALL_RUNNING;
+                call->batch  = &batch;
+                call->references++;
+                calls[count++] = call;
+            }
+        }
+        client->queuedCalls -= count;
+        batch.live = count;
+        unlockMutex(&client->lock);
+
+        uint64_t span = TINYAI_TRACE_BEGIN();
+        runAsyncBatch(client, &batch, calls, count);
+        TINYAI_TRACE_END_ARG(span, "mcp.async_batch", count);
+        for (int i = 0; i < count; i++) {
+            releaseAsyncCall(calls[i]);
+        }
+        lockMutex(&client->lock);
+    }
+    unlockMutex(&client->lock);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static bool startWorker(TinyAIMcpClient *client, ThreadHandle *thread)
+{
+#ifdef _WIN32
+    *thread = (HANDLE)_beginthreadex(NULL, 0, asyncWorker, client, 0, NULL);
+    return *thread != 0;
+#else
+    return pthread_create(thread, NULL, asyncWorker, client) == 0;
+#endif
+}
+
+static void joinWorker(ThreadHandle thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+/**
+ * Queue a call for the client's workers, starting another worker if none is idle
+ *
+ * With useCache set, a call the response cache can answer finishes at once
+ * on the calling thread instead.
+ */
+static TinyAIMcpAsyncCall *submitAsyncCall(TinyAIMcpClient *client, const char *name,
+                                           const char *arguments, bool resource,
+                                           const TinyAIMcpAsyncOptions *options, bool useCache)
+{
+    TinyAIMcpAsyncCall *call = (TinyAIMcpAsyncCall *)calloc(1, sizeof(TinyAIMcpAsyncCall));
+    if (!call)
+        return NULL;
+
+    call->client       = client;
+    call->name         = copyString(name);
+    call->arguments    = arguments ? copyString(arguments) : NULL;
+    call->resource     = resource;
+    call->status       = TINYAI_MCP_CALL_QUEUED;
+    call->resultLength = -1;
+    call->references   = 1;
+    if (options) {
+        call->options = *options;
+    }
+    if (!call->name || (arguments && !call->arguments)) {
+        freeAsyncCall(call);
+        return NULL;
+    }
+
+    if (cacheKeyFor(client, name, arguments, resource, &call->cacheKey) && useCache &&
+        answerFromCache(client, &call->cacheKey, name, arguments, resource, &call->result) >= 0) {
+        call->resultLength = (int)call->result.length;
+        call->status       = TINYAI_MCP_CALL_SUCCEEDED;
+        if (call->options.onComplete) {
+            call->options.onComplete(call, call->options.userData);
+        }
+        return call;
+    }
+
+    int maxWorkers = client->config.maxConnections > 0 ? client->config.maxConnections
+                                                       : DEFAULT_MAX_CONNECTIONS;
+
+    lockMutex(&client->lock);
+    if (client->idleWorkers == 0 && client->workerCount < maxWorkers) {
+        if (!client->workers) {
+            client->workers = (ThreadHandle *)calloc((size_t)maxWorkers, sizeof(ThreadHandle));
+        }
+        if (client->workers && startWorker(client, &client->workers[client->workerCount])) {
+            client->workerCount++;
+        }
+    }
+    if (client->workerCount == 0) {
+        unlockMutex(&client->lock);
+        freeAsyncCall(call);
+        return NULL;
+    }
+
+    if (client->asyncTail) {
+        client->asyncTail->next = call;
+    }
+    else {
+        client->asyncCalls = call;
+    }
+    client->asyncTail = call;
+    client->queuedCalls++;
+    broadcastCondition(&client->workQueued);
+    unlockMutex(&client->lock);
+    return call;
+}
+
+/* Cancel the unfinished asynchronous calls of a client and stop its workers */
+static void cancelAsyncCalls(TinyAIMcpClient *client)
+{
+    lockMutex(&client->lock);
+    while (client->asyncCalls) {
+        TinyAIMcpAsyncCall *call = client->asyncCalls;
+        call->references++;
+        unlockMutex(&client->lock);
+
+        cancelAsyncCall(call);
+        releaseAsyncCall(call);
+        lockMutex(&client->lock);
+    }
+
+    ThreadHandle *workers     = client->workers;
+    int           workerCount = client->workerCount;
+    client->workers           = NULL;
+    client->workerCount       = 0;
+    client->stopWorkers       = true;
+    broadcastCondition(&client->workQueued);
+    unlockMutex(&client->lock);
+
+    for (int i = 0; i < workerCount; i++) {
+        joinWorker(workers[i]);
+    }
+    free(workers);
+
+    lockMutex(&client->lock);
+    client->stopWorkers = false;
+    unlockMutex(&client->lock);
+}
+
+/* Public API */
 
 void tinyaiMcpGetDefaultConfig(TinyAIMcpConfig *config)
 {
@@ -38,10 +2411,15 @@ void tinyaiMcpGetDefaultConfig(TinyAIMcpConfig *config)
     config->connectionTimeoutMs = DEFAULT_TIMEOUT_MS;
     config->maxRetryAttempts    = DEFAULT_MAX_RETRIES;
     config->forceOffline        = false;
+    config->maxConnections      = DEFAULT_MAX_CONNECTIONS;
+    config->requestTimeoutMs    = DEFAULT_REQUEST_TIMEOUT_MS;
 }
 
 TinyAIMcpClient *tinyaiMcpCreateClient(const TinyAIMcpConfig *config)
 {
+    if (!initSockets())
+        return NULL;
+
     TinyAIMcpClient *client = (TinyAIMcpClient *)malloc(sizeof(TinyAIMcpClient));
     if (!client)
         return NULL;
@@ -58,6 +2436,9 @@ TinyAIMcpClient *tinyaiMcpCreateClient(const TinyAIMcpConfig *config)
     client->connectionState    = TINYAI_MCP_DISCONNECTED;
     client->isConnectionActive = false;
     client->connectionAttempts = 0;
+    initMutex(&client->lock);
+    initCondition(&client->asyncChanged);
+    initCondition(&client->workQueued);
 
     return client;
 }
@@ -72,6 +2453,13 @@ void tinyaiMcpDestroyClient(TinyAIMcpClient *client)
         tinyaiMcpDisconnect(client);
     }
 
+    cancelAsyncCalls(client);
+    closePool(client);
+    destroyCache(client->cache);
+    free(client->tools);
+    destroyCondition(&client->asyncChanged);
+    destroyCondition(&client->workQueued);
+    destroyMutex(&client->lock);
     free(client);
 }
 
@@ -99,43 +2487,37 @@ bool tinyaiMcpConnect(TinyAIMcpClient *client, const char *serverUrl)
         tinyaiMcpDisconnect(client);
     }
 
+    /* Forget any state left by a failed attempt */
+    closePool(client);
+    free(client->tools);
+    client->tools = NULL;
+    memset(client->sessionId, 0, sizeof(client->sessionId));
+    memset(client->serverName, 0, sizeof(client->serverName));
+    memset(client->serverVersion, 0, sizeof(client->serverVersion));
+
     /* Store server URL */
-    strncpy(client->serverUrl, serverUrl, sizeof(client->serverUrl) - 1);
+    snprintf(client->serverUrl, sizeof(client->serverUrl), "%s", serverUrl);
 
     /* Reset connection state */
     client->connectionState       = TINYAI_MCP_CONNECTING;
     client->lastConnectionAttempt = time(NULL);
-    client->connectionAttempts    = 1;
-
-    /*
-     * In a real implementation, we would:
-     * 1. Establish a socket connection to the server
-     * 2. Send handshake data and authenticate
-     * 3. Receive capabilities from the server
-     * 4. Update connection state based on response
-     *
-     * For this initial implementation, we'll simulate a successful connection
-     */
-
-    /* Simulate successful connection */
-    client->connectionState    = TINYAI_MCP_CONNECTED;
-    client->isConnectionActive = true;
+    client->connectionAttempts    = 0;
+    client->mock                  = strncmp(serverUrl, "mock://", 7) == 0;
 
-    /* Set some default capabilities for testing */
-    strcpy(
-        client->serverCapabilities,
-        "{"
-        "  \"tools\": ["
-        "    {\"name\": \"generate_text\", \"description\": \"Generate text with remote model\"},"
-        "    {\"name\": \"tokenize_text\", \"description\": \"Tokenize text with remote model\"},"
-        "    {\"name\": \"convert_model\", \"description\": \"Convert model to TinyAI format\"}"
-        "  ],"
-        "  \"resources\": ["
-        "    {\"name\": \"model_repository\", \"description\": \"Access models from repository\"},"
-        "    {\"name\": \"knowledge_base\", \"description\": \"Access knowledge base data\"}"
-        "  ]"
-        "}");
+    if (client->mock) {
+        client->connectionAttempts = 1;
+        connectMock(client);
+    }
+    else if (!parseServerUrl(client, serverUrl) || !createPool(client) ||
+             !initializeSession(client)) {
+        /* The first request opens the first pooled connection, with retries */
+        closePool(client);
+        client->connectionState = TINYAI_MCP_ERROR;
+        return false;
+    }
 
+    client->connectionState    = TINYAI_MCP_CONNECTED;
+    client->isConnectionActive = true;
     return true;
 }
 
@@ -149,12 +2531,12 @@ void tinyaiMcpDisconnect(TinyAIMcpClient *client)
         return;
     }
 
-    /*
-     * In a real implementation, we would:
-     * 1. Send a disconnect message to the server
-     * 2. Close the socket connection
-     * 3. Clean up any resources
-     */
+    /* Stop asynchronous calls, then close the pooled connections */
+    cancelAsyncCalls(client);
+    closePool(client);
+    free(client->tools);
+    client->tools = NULL;
+    memset(client->sessionId, 0, sizeof(client->sessionId));
 
     /* Reset connection state */
     client->connectionState    = TINYAI_MCP_DISCONNECTED;
@@ -195,11 +2577,12 @@ bool tinyaiMcpGetServerInfo(TinyAIMcpClient *client, TinyAIMcpServerInfo *info)
     }
 
     /* Fill in server info */
-    strcpy(info->serverName, "TinyAI MCP Server");
-    strcpy(info->serverUrl, client->serverUrl);
-    strcpy(info->serverVersion, "0.1.0");
+    snprintf(info->serverName, sizeof(info->serverName), "%s", client->serverName);
+    snprintf(info->serverUrl, sizeof(info->serverUrl), "%s", client->serverUrl);
+    snprintf(info->serverVersion, sizeof(info->serverVersion), "%s", client->serverVersion);
     info->connectionState = client->connectionState;
-    strcpy(info->serverCapabilities, client->serverCapabilities);
+    snprintf(info->serverCapabilities, sizeof(info->serverCapabilities), "%s",
+             client->serverCapabilities);
 
     return true;
 }
@@ -214,8 +2597,9 @@ bool tinyaiMcpHasCapability(TinyAIMcpClient *client, const char *capability)
         return false;
     }
 
-    /* Check if capability is in capabilities string */
-    return (strstr(client->serverCapabilities, capability) != NULL);
+    /* Check if capability is in the capabilities or the listed tools */
+    return strstr(client->serverCapabilities, capability) != NULL ||
+           (client->tools && strstr(client->tools, capability) != NULL);
 }
 
 int tinyaiMcpCallTool(TinyAIMcpClient *client, const char *toolName, const char *arguments,
@@ -224,45 +2608,97 @@ int tinyaiMcpCallTool(TinyAIMcpClient *client, const char *toolName, const char
     if (!client || !toolName || !result || resultSize <= 0)
         return -1;
 
-    /* If not connected, can't call tool */
-    if (client->connectionState != TINYAI_MCP_CONNECTED) {
-        strncpy(result, "Error: Not connected to MCP server", resultSize - 1);
+    TinyAIMcpToolCall call = {toolName, arguments, result, resultSize, -1};
+    tinyaiMcpCallTools(client, &call, 1);
+    return call.resultLength;
+}
+
+int tinyaiMcpCallTools(TinyAIMcpClient *client, TinyAIMcpToolCall *calls, int count)
+{
+    if (!client || !calls || count <= 0)
         return -1;
+
+    uint64_t span      = TINYAI_TRACE_BEGIN();
+    int      succeeded = callTools(client, calls, count);
+    TINYAI_TRACE_END_ARG(span, "mcp.call_tools", count);
+    return succeeded;
+}
+
+TinyAIMcpAsyncCall *tinyaiMcpCallToolAsync(TinyAIMcpClient *client, const char *toolName,
+                                           const char *arguments,
+                                           const TinyAIMcpAsyncOptions *options)
+{
+    if (!client || !toolName)
+        return NULL;
+    return submitAsyncCall(client, toolName, arguments, false, options, true);
+}
+
+TinyAIMcpAsyncCall *tinyaiMcpAccessResourceAsync(TinyAIMcpClient *client, const char *resourceUri,
+                                                 const TinyAIMcpAsyncOptions *options)
+{
+    if (!client || !resourceUri)
+        return NULL;
+    return submitAsyncCall(client, resourceUri, NULL, true, options, true);
+}
+
+TinyAIMcpCallStatus tinyaiMcpAsyncCallStatus(TinyAIMcpAsyncCall *call)
+{
+    if (!call)
+        return TINYAI_MCP_CALL_FAILED;
+
+    lockMutex(&call->client->lock);
+    TinyAIMcpCallStatus status = call->status;
+    unlockMutex(&call->client->lock);
+    return status;
+}
+
+bool tinyaiMcpAsyncCallWait(TinyAIMcpAsyncCall *call, int timeoutMs)
+{
+    if (!call)
+        return false;
+
+    TinyAIMcpClient *client   = call->client;
+    double           deadline = currentTimeMs() + (timeoutMs > 0 ? timeoutMs : 0);
+
+    lockMutex(&client->lock);
+    while (call->status <= TINYAI_MCP_CALL_RUNNING && timeoutMs != 0) {
+        int remaining = timeoutMs < 0 ? -1 : remainingMs(deadline);
+        if (remaining == 0) {
+            break;
+        }
+        waitCondition(&client->asyncChanged, &client->lock, remaining);
     }
+    bool done = call->status > TINYAI_MCP_CALL_RUNNING;
+    unlockMutex(&client->lock);
+    return done;
+}
 
-    /* Check if tool exists */
-    if (!tinyaiMcpHasCapability(client, toolName)) {
-        snprintf(result, resultSize - 1, "Error: Tool '%s' not supported by server", toolName);
+int tinyaiMcpAsyncCallResult(TinyAIMcpAsyncCall *call, const char **result)
+{
+    if (!call || !tinyaiMcpAsyncCallWait(call, 0))
         return -1;
+
+    /* A finished call's result no longer changes */
+    if (result) {
+        *result = call->result.data ? call->result.data : "";
     }
+    return call->resultLength;
+}
 
-    /*
-     * In a real implementation, we would:
-     * 1. Format a request to the server
-     * 2. Send the request
-     * 3. Receive the response
-     * 4. Parse the response and fill the result buffer
-     */
+void tinyaiMcpAsyncCallCancel(TinyAIMcpAsyncCall *call)
+{
+    if (!call)
+        return;
+    cancelAsyncCall(call);
+}
 
-    /* For now, return a placeholder response */
-    if (strcmp(toolName, "generate_text") == 0) {
-        snprintf(result, resultSize - 1, "Generated text based on arguments: %s",
-                 arguments ? arguments : "none");
-    }
-    else if (strcmp(toolName, "tokenize_text") == 0) {
-        snprintf(result, resultSize - 1, "Tokenized text based on arguments: %s",
-                 arguments ? arguments : "none");
-    }
-    else if (strcmp(toolName, "convert_model") == 0) {
-        snprintf(result, resultSize - 1, "Model conversion initiated with arguments: %s",
-                 arguments ? arguments : "none");
-    }
-    else {
-        snprintf(result, resultSize - 1, "Executed tool '%s' with arguments: %s", toolName,
-                 arguments ? arguments : "none");
-    }
+void tinyaiMcpAsyncCallRelease(TinyAIMcpAsyncCall *call)
+{
+    if (!call)
+        return;
 
-    return strlen(result);
+    cancelAsyncCall(call);
+    releaseAsyncCall(call);
 }
 
 int tinyaiMcpAccessResource(TinyAIMcpClient *client, const char *resourceUri, char *result,
@@ -273,30 +2709,45 @@ int tinyaiMcpAccessResource(TinyAIMcpClient *client, const char *resourceUri, ch
 
     /* If not connected, can't access resource */
     if (client->connectionState != TINYAI_MCP_CONNECTED) {
-        strncpy(result, "Error: Not connected to MCP server", resultSize - 1);
+        snprintf(result, resultSize, "Error: Not connected to MCP server");
         return -1;
     }
 
-    /*
-     * In a real implementation, we would:
-     * 1. Parse the resource URI
-     * 2. Send a request to the server
-     * 3. Receive the response
-     * 4. Parse the response and fill the result buffer
-     */
-
-    /* For now, return a placeholder response */
-    if (strstr(resourceUri, "model_repository") != NULL) {
-        snprintf(result, resultSize - 1, "Model repository data for URI: %s", resourceUri);
+    if (client->mock) {
+        return accessMockResource(resourceUri, result, resultSize);
     }
-    else if (strstr(resourceUri, "knowledge_base") != NULL) {
-        snprintf(result, resultSize - 1, "Knowledge base data for URI: %s", resourceUri);
+
+    McpBuffer key   = {NULL, 0, 0};
+    McpBuffer taken = {NULL, 0, 0};
+    int       length;
+    if (cacheKeyFor(client, resourceUri, NULL, true, &key) &&
+        answerFromCache(client, &key, resourceUri, NULL, true, &taken) >= 0) {
+        length = (int)taken.length;
     }
     else {
-        snprintf(result, resultSize - 1, "Resource data for URI: %s", resourceUri);
+        McpBuffer   params = {NULL, 0, 0};
+        McpResponse response;
+        if (bufferPrintf(&params, "{\"uri\":") && bufferAppendJsonString(&params, resourceUri) &&
+            bufferAppend(&params, "}", 1) &&
+            sendMessage(client, "resources/read", params.data, false, &response)) {
+            length = takeRpcResult(&response, &taken);
+            freeResponse(&response);
+            if (key.length > 0) {
+                updateCache(client, &key, &taken, length >= 0);
+            }
+        }
+        else {
+            taken.length = 0;
+            bufferPrintf(&taken, "Error: No reply from MCP server");
+            length = -1;
+        }
+        free(params.data);
     }
 
-    return strlen(result);
+    int written = copyText(result, resultSize, taken.data ? taken.data : "", taken.length);
+    free(key.data);
+    free(taken.data);
+    return length < 0 ? -1 : written;
 }
 
 void tinyaiMcpSetExecutionPreference(TinyAIMcpClient             *client,
@@ -333,3 +2784,48 @@ bool tinyaiMcpGetForceOffline(TinyAIMcpClient *client)
         return true; /* Default to offline if no client */
     return client->config.forceOffline;
 }
+
+bool tinyaiMcpGetTransportStats(TinyAIMcpClient *client, TinyAIMcpTransportStats *stats)
+{
+    if (!client || !stats)
+        return false;
+
+    lockMutex(&client->lock);
+    *stats = client->stats;
+    unlockMutex(&client->lock);
+    return true;
+}
+
+bool tinyaiMcpSetCacheConfig(TinyAIMcpClient *client, const TinyAIMcpCacheConfig *config)
+{
+    if (!client)
+        return false;
+
+    McpCache *cache = NULL;
+    if (config && !(cache = createCache(config)))
+        return false;
+
+    lockMutex(&client->lock);
+    McpCache *previous = client->cache;
+    client->cache      = cache;
+    unlockMutex(&client->lock);
+
+    destroyCache(previous);
+    return true;
+}
+
+bool tinyaiMcpGetCacheStats(TinyAIMcpClient *client, TinyAIMcpCacheStats *stats)
+{
+    if (!client || !stats)
+        return false;
+
+    lockMutex(&client->lock);
+    if (client->cache) {
+        *stats = client->cache->stats;
+    }
+    else {
+        memset(stats, 0, sizeof(TinyAIMcpCacheStats));
+    }
+    unlockMutex(&client->lock);
+    return true;
+}
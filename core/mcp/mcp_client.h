@@ -3,13 +3,16 @@
  * @brief Model Context Protocol (MCP) client implementation for TinyAI
  *
  * This file defines the API for interacting with MCP servers, providing
- * hybrid local/remote execution capabilities for TinyAI.
+ * hybrid local/remote execution capabilities for TinyAI. Requests travel
+ * as JSON-RPC over HTTP/1.1 on a pool of keep-alive connections, so only
+ * the first call to a server pays for the TCP handshake.
  */
 
 #ifndef TINYAI_MCP_CLIENT_H
 #define TINYAI_MCP_CLIENT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -46,6 +49,8 @@ typedef struct {
     int                          connectionTimeoutMs; /**< Connection timeout in milliseconds */
     int                          maxRetryAttempts;    /**< Maximum connection retry attempts */
     bool                         forceOffline;        /**< Force offline mode */
+    int                          maxConnections;      /**< Pooled connections (and async workers) */
+    int                          requestTimeoutMs;    /**< Time to wait for replies in milliseconds */
 } TinyAIMcpConfig;
 
 /**
@@ -59,6 +64,94 @@ typedef struct {
     char                     serverCapabilities[1024]; /**< JSON string of capabilities */
 } TinyAIMcpServerInfo;
 
+/**
+ * @brief One call of a pipelined batch of tool calls
+ */
+typedef struct {
+    const char *toolName;     /**< Name of the tool to call */
+    const char *arguments;    /**< JSON arguments for the tool (NULL for none) */
+    char       *result;       /**< Output buffer for the result */
+    int         resultSize;   /**< Size of the output buffer */
+    int         resultLength; /**< Bytes written to the result, or negative on error */
+} TinyAIMcpToolCall;
+
+/**
+ * @brief MCP transport statistics
+ */
+typedef struct {
+    int connectionsOpened; /**< TCP connections established */
+    int connectRetries;    /**< Failed connection attempts that were retried */
+    int requestsSent;      /**< HTTP requests written */
+    int reconnects;        /**< Requests resent after a keep-alive connection was closed */
+} TinyAIMcpTransportStats;
+
+/**
+ * @brief Settings of the response cache
+ */
+typedef struct {
+    int    maxEntries; /**< Most results kept (0 for 256) */
+    size_t maxBytes;   /**< Most bytes of keys and results kept (0 for 1 MiB) */
+    int    ttlMs;      /**< Time a result stays fresh in milliseconds (0 for 60000) */
+    int    staleMs;    /**< Time after that it is still served while being refreshed (0 for none) */
+} TinyAIMcpCacheConfig;
+
+/**
+ * @brief Response cache statistics
+ */
+typedef struct {
+    int    hits;          /**< Lookups answered with a fresh result */
+    int    staleHits;     /**< Lookups answered with a stale result while it was refreshed */
+    int    misses;        /**< Lookups that went to the server */
+    int    revalidations; /**< Background refreshes of stale results */
+    int    evictions;     /**< Results dropped to stay within the size bounds */
+    int    entries;       /**< Results currently cached */
+    size_t bytes;         /**< Bytes currently cached */
+} TinyAIMcpCacheStats;
+
+/**
+ * @brief Tool call or resource read running in the background
+ */
+typedef struct TinyAIMcpAsyncCall TinyAIMcpAsyncCall;
+
+/**
+ * @brief State of an asynchronous call
+ */
+typedef enum {
+    TINYAI_MCP_CALL_QUEUED,    /**< Waiting for a worker */
+    TINYAI_MCP_CALL_RUNNING,   /**< Request sent, reply pending */
+    TINYAI_MCP_CALL_SUCCEEDED, /**< Finished with a result */
+    TINYAI_MCP_CALL_FAILED,    /**< Finished with an error message as its result */
+    TINYAI_MCP_CALL_CANCELLED  /**< Cancelled before it finished */
+} TinyAIMcpCallStatus;
+
+/**
+ * @brief Callback receiving a notification streamed ahead of a call's reply
+ *
+ * @param call Asynchronous call
+ * @param data JSON-RPC notification, such as a progress or partial result message
+ * @param length Length of the notification
+ * @param userData User data from the call's options
+ */
+typedef void (*TinyAIMcpPartialCallback)(TinyAIMcpAsyncCall *call, const char *data, int length,
+                                         void *userData);
+
+/**
+ * @brief Callback run once when an asynchronous call finishes, fails or is cancelled
+ *
+ * @param call Asynchronous call (its result and status are available)
+ * @param userData User data from the call's options
+ */
+typedef void (*TinyAIMcpCompletionCallback)(TinyAIMcpAsyncCall *call, void *userData);
+
+/**
+ * @brief Options of an asynchronous call
+ */
+typedef struct {
+    TinyAIMcpPartialCallback    onPartial;  /**< Streamed notifications (can be NULL) */
+    TinyAIMcpCompletionCallback onComplete; /**< Completion (can be NULL) */
+    void                       *userData;   /**< Passed to the callbacks */
+} TinyAIMcpAsyncOptions;
+
 /**
  * @brief MCP client context
  */
@@ -82,6 +175,10 @@ void tinyaiMcpDestroyClient(TinyAIMcpClient *client);
 /**
  * @brief Connect to an MCP server
  *
+ * Opens a connection to an http://host[:port][/path] endpoint, retrying
+ * up to maxRetryAttempts times with exponential backoff, and initializes
+ * an MCP session on it. mock:// URLs connect to a simulated server.
+ *
  * @param client Client instance
  * @param serverUrl Server URL
  * @return true if connection was successful or in progress
@@ -146,6 +243,104 @@ bool tinyaiMcpHasCapability(TinyAIMcpClient *client, const char *capability);
 int tinyaiMcpCallTool(TinyAIMcpClient *client, const char *toolName, const char *arguments,
                       char *result, int resultSize);
 
+/**
+ * @brief Call several remote MCP tools with pipelined requests
+ *
+ * Writes every request to one connection before reading the replies, so
+ * the batch costs a single round trip instead of one per call. The result
+ * of each call is written to its own buffer, as by tinyaiMcpCallTool.
+ *
+ * @param client Client instance
+ * @param calls Calls to make
+ * @param count Number of calls
+ * @return int Number of calls that succeeded, or negative value if not connected
+ */
+int tinyaiMcpCallTools(TinyAIMcpClient *client, TinyAIMcpToolCall *calls, int count);
+
+/**
+ * @brief Submit a remote MCP tool call without waiting for it
+ *
+ * The call is queued for the client's worker threads (at most
+ * maxConnections of them), which pipeline queued calls on their
+ * connections, so one thread can keep many calls in flight while it does
+ * other work. Completion can be polled with tinyaiMcpAsyncCallStatus or
+ * tinyaiMcpAsyncCallWait, or reported through the options' callbacks.
+ * Callbacks run on a worker thread, on the thread cancelling the call, or
+ * on the submitting thread when the call is answered from the response
+ * cache. They may run after a wait on the call has returned, and must not
+ * disconnect or destroy the client. Disconnecting or
+ * destroying the client cancels unfinished calls.
+ *
+ * @param client Client instance
+ * @param toolName Name of the tool to call
+ * @param arguments JSON string of arguments for the tool (copied)
+ * @param options Callbacks (can be NULL)
+ * @return TinyAIMcpAsyncCall* Submitted call, or NULL on failure
+ */
+TinyAIMcpAsyncCall *tinyaiMcpCallToolAsync(TinyAIMcpClient *client, const char *toolName,
+                                           const char *arguments,
+                                           const TinyAIMcpAsyncOptions *options);
+
+/**
+ * @brief Submit a read of an MCP resource without waiting for it
+ *
+ * Runs as tinyaiMcpCallToolAsync does.
+ *
+ * @param client Client instance
+ * @param resourceUri URI of the resource to read (copied)
+ * @param options Callbacks (can be NULL)
+ * @return TinyAIMcpAsyncCall* Submitted call, or NULL on failure
+ */
+TinyAIMcpAsyncCall *tinyaiMcpAccessResourceAsync(TinyAIMcpClient *client, const char *resourceUri,
+                                                 const TinyAIMcpAsyncOptions *options);
+
+/**
+ * @brief Get the state of an asynchronous call
+ *
+ * @param call Asynchronous call
+ * @return TinyAIMcpCallStatus Current state
+ */
+TinyAIMcpCallStatus tinyaiMcpAsyncCallStatus(TinyAIMcpAsyncCall *call);
+
+/**
+ * @brief Wait for an asynchronous call to finish
+ *
+ * @param call Asynchronous call
+ * @param timeoutMs Longest time to wait in milliseconds (0 to poll, negative for no limit)
+ * @return true if the call has finished
+ * @return false if it is still queued or running
+ */
+bool tinyaiMcpAsyncCallWait(TinyAIMcpAsyncCall *call, int timeoutMs);
+
+/**
+ * @brief Get the result of a finished asynchronous call
+ *
+ * The result is held in a buffer sized to fit it, so it is never truncated.
+ *
+ * @param call Asynchronous call
+ * @param result Output pointer to the result, valid until the call is released (can be NULL)
+ * @return int Length of the result, or negative value on error or if not finished
+ */
+int tinyaiMcpAsyncCallResult(TinyAIMcpAsyncCall *call, const char **result);
+
+/**
+ * @brief Cancel an asynchronous call
+ *
+ * The call finishes at once as cancelled. A request already sent is
+ * abandoned, and its connection closed, once every call pipelined with it
+ * is cancelled too.
+ *
+ * @param call Asynchronous call
+ */
+void tinyaiMcpAsyncCallCancel(TinyAIMcpAsyncCall *call);
+
+/**
+ * @brief Release an asynchronous call, cancelling it if it has not finished
+ *
+ * @param call Asynchronous call
+ */
+void tinyaiMcpAsyncCallRelease(TinyAIMcpAsyncCall *call);
+
 /**
  * @brief Access an MCP resource
  *
@@ -192,6 +387,46 @@ void tinyaiMcpSetForceOffline(TinyAIMcpClient *client, bool forceOffline);
  */
 bool tinyaiMcpGetForceOffline(TinyAIMcpClient *client);
 
+/**
+ * @brief Get transport statistics
+ *
+ * @param client Client instance
+ * @param stats Output statistics
+ * @return true if statistics were retrieved
+ * @return false on failure
+ */
+bool tinyaiMcpGetTransportStats(TinyAIMcpClient *client, TinyAIMcpTransportStats *stats);
+
+/**
+ * @brief Enable, reconfigure or disable the response cache
+ *
+ * Successful results of tool calls and resource reads are cached under
+ * the tool name or resource URI and the arguments in canonical form (key
+ * order and whitespace do not matter). A cached result is returned
+ * without any request while it is fresh. Once stale it is still returned
+ * for staleMs while one background call refreshes it. Least recently used
+ * results are dropped to stay within maxEntries and maxBytes. Only enable
+ * the cache for servers whose tools give the same result for the same
+ * arguments. The cache is disabled by default, and reconfiguring it
+ * empties it.
+ *
+ * @param client Client instance
+ * @param config Cache settings (NULL to disable the cache)
+ * @return true if the cache was configured
+ * @return false on failure
+ */
+bool tinyaiMcpSetCacheConfig(TinyAIMcpClient *client, const TinyAIMcpCacheConfig *config);
+
+/**
+ * @brief Get response cache statistics
+ *
+ * @param client Client instance
+ * @param stats Output statistics (all zero while the cache is disabled)
+ * @return true if statistics were retrieved
+ * @return false on failure
+ */
+bool tinyaiMcpGetCacheStats(TinyAIMcpClient *client, TinyAIMcpCacheStats *stats);
+
 /**
  * @brief Get default MCP client configuration
  *
@@ -3,19 +3,31 @@
  */
 
 #include "memory.h"
+#include <stdint.h> // For uintptr_t
 #include <stdlib.h> // For malloc, realloc, free, calloc
 #include <stdio.h>  // For printf (debugging/leaks)
 #include <string.h> // For memset
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 /* ----------------- Standard Allocation Wrappers ----------------- */
 
+// Allocations made through the wrappers (not synchronized, profiling only)
+static size_t g_allocCount = 0;
+
 void* tinyaiAlloc(size_t size) {
     // Basic wrapper around malloc
+    g_allocCount++;
     return malloc(size);
 }
 
 void* tinyaiRealloc(void *ptr, size_t size) {
     // Basic wrapper around realloc
+    g_allocCount++;
     return realloc(ptr, size);
 }
 
@@ -26,9 +38,14 @@ void tinyaiFree(void *ptr) {
 
 void* tinyaiCalloc(size_t count, size_t size) {
     // Basic wrapper around calloc
+    g_allocCount++;
     return calloc(count, size);
 }
 
+size_t tinyaiAllocCount(void) {
+    return g_allocCount;
+}
+
 /* ----------------- Memory Pool (Simple Bump Allocator) ----------------- */
 
 static unsigned char *g_memPool = NULL;
@@ -138,69 +155,353 @@ void tinyaiMemPoolStats(size_t *totalSize, size_t *usedSize,
 }
 
 
-/* ----------------- Memory Tracking (Simple Linked List) ----------------- */
+/* ----------------- Memory Tracking (Sharded Hash Tables) ----------------- */
 
-#ifdef TINYAI_MEMORY_TRACKING
+// Live allocations are spread over shards by address, each an open-addressing
+// table under its own lock, so tracking is O(1) per call and threads freeing
+// different blocks rarely contend. Each shard also aggregates its allocations
+// by call site; reports merge the shards.
 
-typedef struct MemTrackNode {
-    void *ptr;
+#define TRACK_SHARD_BITS 5
+#define TRACK_SHARDS (1 << TRACK_SHARD_BITS)
+#define TRACK_MIN_SLOTS 64
+
+#ifdef _WIN32
+typedef SRWLOCK TrackLock;
+#define trackLock(lock) AcquireSRWLockExclusive(lock)
+#define trackUnlock(lock) ReleaseSRWLockExclusive(lock)
+#else
+typedef pthread_mutex_t TrackLock;
+#define trackLock(lock) pthread_mutex_lock(lock)
+#define trackUnlock(lock) pthread_mutex_unlock(lock)
+#endif
+
+typedef struct {
+    void *ptr;  // NULL for an empty slot
     size_t size;
-    const char *file;
-    int line;
-    struct MemTrackNode *next;
-} MemTrackNode;
+    int site;   // Index into the shard's site table
+} TrackEntry;
+
+typedef struct {
+    TrackLock lock;
+    TrackEntry *entries;
+    size_t capacity;
+    size_t count;        // Also read without the lock to skip empty shards
+    TinyAIMemTrackSite *sites;
+    int *siteSlots;      // Open-addressing index into sites, -1 for empty
+    size_t siteCapacity; // Slots in siteSlots; sites holds half as many
+    size_t numSites;
+    size_t allocCount;
+    size_t allocSize;
+    size_t freeCount;
+    size_t freeSize;
+} TrackShard;
+
+static TrackShard g_trackShards[TRACK_SHARDS];
+static unsigned int g_trackSampleRate = 1;
+static unsigned long g_trackSampleCounter = 0;
+#ifndef _WIN32
+static pthread_once_t g_trackOnce = PTHREAD_ONCE_INIT;
+#else
+static INIT_ONCE g_trackOnce = INIT_ONCE_STATIC_INIT;
+#endif
+
+#ifdef _WIN32
+static BOOL CALLBACK initTrackShards(PINIT_ONCE once, PVOID param, PVOID *context) {
+    (void)once; (void)param; (void)context;
+    for (int i = 0; i < TRACK_SHARDS; i++) {
+        InitializeSRWLock(&g_trackShards[i].lock);
+    }
+    return TRUE;
+}
+#else
+static void initTrackShards(void) {
+    for (int i = 0; i < TRACK_SHARDS; i++) {
+        pthread_mutex_init(&g_trackShards[i].lock, NULL);
+    }
+}
+#endif
+
+// Shard locks are created once, whichever tracking call comes first
+static void ensureTrackShards(void) {
+#ifdef _WIN32
+    InitOnceExecuteOnce(&g_trackOnce, initTrackShards, NULL, NULL);
+#else
+    pthread_once(&g_trackOnce, initTrackShards);
+#endif
+}
+
+static uint64_t hashPointer(const void *ptr) {
+    return (uint64_t)(uintptr_t)ptr * 0x9E3779B97F4A7C15ull;
+}
+
+static TrackShard *shardOf(const void *ptr) {
+    return &g_trackShards[hashPointer(ptr) >> (64 - TRACK_SHARD_BITS)];
+}
+
+// Every shard of a pointer shares its top hash bits, so slots use the low ones
+static size_t slotOf(const void *ptr, size_t capacity) {
+    uint64_t hash = hashPointer(ptr);
+    return (size_t)(hash ^ (hash >> 29)) & (capacity - 1);
+}
+
+static size_t siteSlotOf(const char *file, int line, size_t capacity) {
+    uint64_t hash = ((uint64_t)(uintptr_t)file ^ (uint64_t)(unsigned)line) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(hash >> 32) & (capacity - 1);
+}
+
+static size_t loadCount(const size_t *count) {
+#ifdef _WIN32
+    return (size_t)InterlockedCompareExchangePointer((PVOID volatile *)count, NULL, NULL);
+#else
+    return __atomic_load_n(count, __ATOMIC_RELAXED);
+#endif
+}
+
+static void storeCount(size_t *count, size_t value) {
+#ifdef _WIN32
+    InterlockedExchangePointer((PVOID volatile *)count, (PVOID)value);
+#else
+    __atomic_store_n(count, value, __ATOMIC_RELAXED);
+#endif
+}
+
+// Decide whether this allocation is one of the 1 in N that get tracked
+static int sampleAllocation(void) {
+    unsigned int rate = g_trackSampleRate;
+    if (rate <= 1) {
+        return 1;
+    }
+#ifdef _WIN32
+    unsigned long ticket =
+        (unsigned long)InterlockedIncrement((LONG volatile *)&g_trackSampleCounter);
+#else
+    unsigned long ticket = __atomic_add_fetch(&g_trackSampleCounter, 1, __ATOMIC_RELAXED);
+#endif
+    return ticket % rate == 0;
+}
+
+// Find or add the site of a call, growing the index at half full (lock held)
+static int findSite(TrackShard *shard, const char *file, int line) {
+    if (shard->siteCapacity > 0) {
+        size_t mask = shard->siteCapacity - 1;
+        for (size_t slot = siteSlotOf(file, line, shard->siteCapacity);;
+             slot = (slot + 1) & mask) {
+            int index = shard->siteSlots[slot];
+            if (index < 0) {
+                break;
+            }
+            if (shard->sites[index].line == line && shard->sites[index].file == file) {
+                return index;
+            }
+        }
+    }
+
+    if ((shard->numSites + 1) * 2 > shard->siteCapacity) {
+        size_t capacity = shard->siteCapacity ? shard->siteCapacity * 2 : TRACK_MIN_SLOTS;
+        int *slots = (int *)malloc(capacity * sizeof(int));
+        TinyAIMemTrackSite *sites =
+            (TinyAIMemTrackSite *)realloc(shard->sites, capacity / 2 * sizeof(TinyAIMemTrackSite));
+        if (sites) {
+            shard->sites = sites;
+        }
+        if (!slots || !sites) {
+            free(slots);
+            return -1;
+        }
+        memset(slots, 0xFF, capacity * sizeof(int));
+        for (size_t i = 0; i < shard->numSites; i++) {
+            size_t slot = siteSlotOf(sites[i].file, sites[i].line, capacity);
+            while (slots[slot] >= 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            slots[slot] = (int)i;
+        }
+        free(shard->siteSlots);
+        shard->siteSlots = slots;
+        shard->siteCapacity = capacity;
+    }
+
+    size_t slot = siteSlotOf(file, line, shard->siteCapacity);
+    while (shard->siteSlots[slot] >= 0) {
+        slot = (slot + 1) & (shard->siteCapacity - 1);
+    }
+    int index = (int)shard->numSites++;
+    shard->siteSlots[slot] = index;
+    memset(&shard->sites[index], 0, sizeof(TinyAIMemTrackSite));
+    shard->sites[index].file = file;
+    shard->sites[index].line = line;
+    return index;
+}
+
+// Double the entry table of a shard (lock held)
+static int growEntries(TrackShard *shard) {
+    size_t capacity = shard->capacity ? shard->capacity * 2 : TRACK_MIN_SLOTS;
+    TrackEntry *entries = (TrackEntry *)calloc(capacity, sizeof(TrackEntry));
+    if (!entries) {
+        return -1;
+    }
+    for (size_t i = 0; i < shard->capacity; i++) {
+        if (shard->entries[i].ptr) {
+            size_t slot = slotOf(shard->entries[i].ptr, capacity);
+            while (entries[slot].ptr) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            entries[slot] = shard->entries[i];
+        }
+    }
+    free(shard->entries);
+    shard->entries = entries;
+    shard->capacity = capacity;
+    return 0;
+}
+
+// Remove the entry at a slot, moving later entries of its probe run back (lock held)
+static void removeEntry(TrackShard *shard, size_t slot) {
+    size_t mask = shard->capacity - 1;
+    size_t hole = slot;
+    shard->entries[hole].ptr = NULL;
+    for (size_t next = (hole + 1) & mask; shard->entries[next].ptr; next = (next + 1) & mask) {
+        size_t home = slotOf(shard->entries[next].ptr, shard->capacity);
+        // Move the entry unless its home lies cyclically in (hole, next]
+        if ((next > hole && (home <= hole || home > next)) ||
+            (next < hole && home <= hole && home > next)) {
+            shard->entries[hole] = shard->entries[next];
+            shard->entries[next].ptr = NULL;
+            hole = next;
+        }
+    }
+    storeCount(&shard->count, shard->count - 1);
+}
+
+// Find the slot of a tracked pointer (lock held)
+static int findEntry(const TrackShard *shard, const void *ptr, size_t *slotOut) {
+    if (shard->capacity == 0) {
+        return 0;
+    }
+    size_t mask = shard->capacity - 1;
+    for (size_t slot = slotOf(ptr, shard->capacity); shard->entries[slot].ptr;
+         slot = (slot + 1) & mask) {
+        if (shard->entries[slot].ptr == ptr) {
+            *slotOut = slot;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Stop tracking a pointer, returning whether it was tracked and its entry
+static int untrack(void *ptr, TrackEntry *removed, const char **file, int *line) {
+    TrackShard *shard = shardOf(ptr);
+    size_t slot;
+    if (loadCount(&shard->count) == 0) {
+        return 0;
+    }
 
-static MemTrackNode *g_memTrackHead = NULL;
-static size_t g_memTrackAllocCount = 0;
-static size_t g_memTrackAllocSize = 0;
-static size_t g_memTrackFreeCount = 0;
-// Note: Tracking total freed size isn't straightforward without storing original size on free
+    trackLock(&shard->lock);
+    int found = findEntry(shard, ptr, &slot);
+    if (found) {
+        TrackEntry entry = shard->entries[slot];
+        if (entry.site >= 0) {
+            TinyAIMemTrackSite *site = &shard->sites[entry.site];
+            site->liveCount--;
+            site->liveBytes -= entry.size;
+            if (file) *file = site->file;
+            if (line) *line = site->line;
+        }
+        shard->freeCount++;
+        shard->freeSize += entry.size;
+        removeEntry(shard, slot);
+        if (removed) *removed = entry;
+    }
+    trackUnlock(&shard->lock);
+    return found;
+}
 
 int tinyaiMemTrackInit() {
-    g_memTrackHead = NULL;
-    g_memTrackAllocCount = 0;
-    g_memTrackAllocSize = 0;
-    g_memTrackFreeCount = 0;
+    ensureTrackShards();
     return 0; // Success
 }
 
 void tinyaiMemTrackCleanup() {
     // Dump leaks before cleaning up
-    tinyaiMemTrackDumpLeaks(); 
+    tinyaiMemTrackDumpLeaks();
+
+    ensureTrackShards();
+    for (int i = 0; i < TRACK_SHARDS; i++) {
+        TrackShard *shard = &g_trackShards[i];
+        trackLock(&shard->lock);
+        free(shard->entries);
+        free(shard->sites);
+        free(shard->siteSlots);
+        shard->entries = NULL;
+        shard->sites = NULL;
+        shard->siteSlots = NULL;
+        shard->capacity = shard->siteCapacity = shard->numSites = 0;
+        shard->allocCount = shard->allocSize = shard->freeCount = shard->freeSize = 0;
+        storeCount(&shard->count, 0);
+        trackUnlock(&shard->lock);
+    }
+}
 
-    // Free any remaining nodes in the tracking list itself
-    MemTrackNode *current = g_memTrackHead;
-    while (current != NULL) {
-        MemTrackNode *next = current->next;
-        free(current); // Free the tracking node itself
-        current = next;
+int tinyaiMemTrackSetSampleRate(unsigned int rate) {
+    if (rate == 0) {
+        return 1;
     }
-    g_memTrackHead = NULL;
+    g_trackSampleRate = rate;
+    return 0;
 }
 
-void tinyaiMemTrackAlloc(void *ptr, size_t size, const char *file, int line) {
-    if (ptr == NULL) {
-        // Don't track failed allocations
+// Start tracking a pointer, sampled or not
+static void track(void *ptr, size_t size, const char *file, int line) {
+    ensureTrackShards();
+    TrackShard *shard = shardOf(ptr);
+    size_t slot;
+    trackLock(&shard->lock);
+
+    // Memory freed behind the tracker's back and handed out again replaces its entry
+    if (findEntry(shard, ptr, &slot)) {
+        TrackEntry *stale = &shard->entries[slot];
+        if (stale->site >= 0) {
+            shard->sites[stale->site].liveCount--;
+            shard->sites[stale->site].liveBytes -= stale->size;
+        }
+        removeEntry(shard, slot);
+    }
+
+    if ((shard->count + 1) * 2 > shard->capacity && growEntries(shard) != 0) {
+        trackUnlock(&shard->lock);
+        fprintf(stderr, "Warning: Failed to grow memory tracking table\n");
         return;
     }
 
-    // Allocate a node to store tracking info
-    MemTrackNode *newNode = (MemTrackNode *)malloc(sizeof(MemTrackNode));
-    if (newNode == NULL) {
-        fprintf(stderr, "FATAL: Failed to allocate memory for tracking node!\n");
-        // In a real scenario, might need a more robust way to handle this
-        return; 
+    int site = findSite(shard, file, line);
+    if (site >= 0) {
+        shard->sites[site].allocCount++;
+        shard->sites[site].allocBytes += size;
+        shard->sites[site].liveCount++;
+        shard->sites[site].liveBytes += size;
     }
 
-    newNode->ptr = ptr;
-    newNode->size = size;
-    newNode->file = file;
-    newNode->line = line;
-    newNode->next = g_memTrackHead; // Prepend to list
-    g_memTrackHead = newNode;
+    slot = slotOf(ptr, shard->capacity);
+    while (shard->entries[slot].ptr) {
+        slot = (slot + 1) & (shard->capacity - 1);
+    }
+    shard->entries[slot].ptr = ptr;
+    shard->entries[slot].size = size;
+    shard->entries[slot].site = site;
+    storeCount(&shard->count, shard->count + 1);
+    shard->allocCount++;
+    shard->allocSize += size;
+    trackUnlock(&shard->lock);
+}
 
-    g_memTrackAllocCount++;
-    g_memTrackAllocSize += size;
+void tinyaiMemTrackAlloc(void *ptr, size_t size, const char *file, int line) {
+    if (ptr == NULL || !sampleAllocation()) {
+        // Don't track failed or unsampled allocations
+        return;
+    }
+    track(ptr, size, file, line);
 }
 
 void tinyaiMemTrackFree(void *ptr) {
@@ -208,53 +509,86 @@ void tinyaiMemTrackFree(void *ptr) {
         return; // Don't track freeing NULL
     }
 
-    MemTrackNode *current = g_memTrackHead;
-    MemTrackNode *prev = NULL;
+    // Unsampled pointers are expected to be missing; with every allocation
+    // tracked, a miss is a double free or memory from elsewhere
+    if (!untrack(ptr, NULL, NULL, NULL) && g_trackSampleRate <= 1) {
+        fprintf(stderr, "Warning: Attempting to free untracked or already freed memory: %p\n", ptr);
+    }
+}
 
-    while (current != NULL) {
-        if (current->ptr == ptr) {
-            // Found the allocation to remove
-            if (prev == NULL) {
-                // Removing the head node
-                g_memTrackHead = current->next;
-            } else {
-                prev->next = current->next;
-            }
+void *tinyaiMemTrackedAlloc(size_t size, const char *file, int line) {
+    void *ptr = tinyaiAlloc(size);
+    tinyaiMemTrackAlloc(ptr, size, file, line);
+    return ptr;
+}
+
+void *tinyaiMemTrackedCalloc(size_t count, size_t size, const char *file, int line) {
+    void *ptr = tinyaiCalloc(count, size);
+    tinyaiMemTrackAlloc(ptr, count * size, file, line);
+    return ptr;
+}
 
-            g_memTrackFreeCount++;
-            // g_memTrackAllocSize -= current->size; // Adjust current allocated size
-            
-            free(current); // Free the tracking node itself
-            return;
+void *tinyaiMemTrackedRealloc(void *ptr, size_t size, const char *file, int line) {
+    if (ptr == NULL) {
+        return tinyaiMemTrackedAlloc(size, file, line);
+    }
+
+    // Untrack first so another thread reusing the old address cannot be confused
+    // with it, and restore the entry if the block stays where it was
+    TrackEntry old;
+    const char *oldFile = file;
+    int oldLine = line;
+    int tracked = untrack(ptr, &old, &oldFile, &oldLine);
+    void *grown = tinyaiRealloc(ptr, size);
+    if (grown == NULL) {
+        if (tracked && size > 0) {
+            track(ptr, old.size, oldFile, oldLine);
         }
-        prev = current;
-        current = current->next;
+        return NULL;
     }
+    // A block keeps the sampling decision of its first allocation
+    if (tracked || g_trackSampleRate <= 1) {
+        track(grown, size, file, line);
+    }
+    return grown;
+}
 
-    // If we reach here, ptr was not found in the tracked list
-    // This could indicate a double free or freeing untracked memory
-    fprintf(stderr, "Warning: Attempting to free untracked or already freed memory: %p\n", ptr);
+void tinyaiMemTrackedFree(void *ptr) {
+    tinyaiMemTrackFree(ptr);
+    tinyaiFree(ptr);
 }
 
 int tinyaiMemTrackDumpLeaks() {
     int leakCount = 0;
-    MemTrackNode *current = g_memTrackHead;
     size_t totalLeakedSize = 0;
 
-    if (current != NULL) {
-        printf("--- TinyAI Memory Leak Report ---\n");
-    }
-
-    while (current != NULL) {
-        printf("  Leak detected: %p (%zu bytes) allocated at %s:%d\n",
-               current->ptr, current->size, current->file, current->line);
-        leakCount++;
-        totalLeakedSize += current->size;
-        current = current->next;
+    ensureTrackShards();
+    for (int i = 0; i < TRACK_SHARDS; i++) {
+        TrackShard *shard = &g_trackShards[i];
+        trackLock(&shard->lock);
+        for (size_t slot = 0; slot < shard->capacity; slot++) {
+            const TrackEntry *entry = &shard->entries[slot];
+            if (!entry->ptr) {
+                continue;
+            }
+            if (leakCount == 0) {
+                printf("--- TinyAI Memory Leak Report ---\n");
+            }
+            const TinyAIMemTrackSite *site = entry->site >= 0 ? &shard->sites[entry->site] : NULL;
+            printf("  Leak detected: %p (%zu bytes) allocated at %s:%d\n", entry->ptr,
+                   entry->size, site ? site->file : "?", site ? site->line : 0);
+            leakCount++;
+            totalLeakedSize += entry->size;
+        }
+        trackUnlock(&shard->lock);
     }
 
     if (leakCount > 0) {
-        printf("--- Total Leaked: %d blocks, %zu bytes ---\n", leakCount, totalLeakedSize);
+        printf("--- Total Leaked: %d blocks, %zu bytes", leakCount, totalLeakedSize);
+        if (g_trackSampleRate > 1) {
+            printf(" (1 in %u allocations sampled)", g_trackSampleRate);
+        }
+        printf(" ---\n");
     } else {
          printf("--- TinyAI Memory Leak Report: No leaks detected ---\n");
     }
@@ -262,30 +596,86 @@ int tinyaiMemTrackDumpLeaks() {
     return leakCount;
 }
 
-void tinyaiMemTrackStats(size_t *allocCount, size_t *allocSize, 
-                        size_t *freeCount, size_t *freeSize) {
-    // Note: freeSize is tricky to track accurately without storing size on free
-    if (allocCount) *allocCount = g_memTrackAllocCount;
-    if (allocSize) *allocSize = g_memTrackAllocSize; // Total ever allocated
-    if (freeCount) *freeCount = g_memTrackFreeCount;
-    if (freeSize) *freeSize = 0; // Placeholder - not accurately tracked here
+// Largest live footprint first, then most bytes ever allocated
+static int compareSites(const void *a, const void *b) {
+    const TinyAIMemTrackSite *x = (const TinyAIMemTrackSite *)a;
+    const TinyAIMemTrackSite *y = (const TinyAIMemTrackSite *)b;
+    if (x->liveBytes != y->liveBytes) {
+        return x->liveBytes > y->liveBytes ? -1 : 1;
+    }
+    if (x->allocBytes != y->allocBytes) {
+        return x->allocBytes > y->allocBytes ? -1 : 1;
+    }
+    return 0;
 }
 
-#else // TINYAI_MEMORY_TRACKING not defined
+size_t tinyaiMemTrackGetSites(TinyAIMemTrackSite *sites, size_t maxSites) {
+    TinyAIMemTrackSite *merged = NULL;
+    size_t numMerged = 0, capacity = 0;
+
+    ensureTrackShards();
+    for (int i = 0; i < TRACK_SHARDS; i++) {
+        TrackShard *shard = &g_trackShards[i];
+        trackLock(&shard->lock);
+        for (size_t s = 0; s < shard->numSites; s++) {
+            const TinyAIMemTrackSite *site = &shard->sites[s];
+            size_t m = 0;
+            // The same call site shows up once per shard; file names from
+            // different translation units may not share a pointer
+            while (m < numMerged && (merged[m].line != site->line ||
+                                     (merged[m].file != site->file &&
+                                      strcmp(merged[m].file, site->file) != 0))) {
+                m++;
+            }
+            if (m == numMerged) {
+                if (numMerged == capacity) {
+                    size_t grown = capacity ? capacity * 2 : TRACK_MIN_SLOTS;
+                    TinyAIMemTrackSite *larger =
+                        (TinyAIMemTrackSite *)realloc(merged, grown * sizeof(TinyAIMemTrackSite));
+                    if (!larger) {
+                        break;
+                    }
+                    merged = larger;
+                    capacity = grown;
+                }
+                merged[numMerged++] = *site;
+                continue;
+            }
+            merged[m].allocCount += site->allocCount;
+            merged[m].allocBytes += site->allocBytes;
+            merged[m].liveCount += site->liveCount;
+            merged[m].liveBytes += site->liveBytes;
+        }
+        trackUnlock(&shard->lock);
+    }
 
-// Provide empty stub functions if tracking is disabled
+    if (numMerged > 0) {
+        qsort(merged, numMerged, sizeof(TinyAIMemTrackSite), compareSites);
+    }
+    if (sites) {
+        memcpy(sites, merged, (numMerged < maxSites ? numMerged : maxSites) * sizeof(*sites));
+    }
+    free(merged);
+    return numMerged;
+}
 
-int tinyaiMemTrackInit() { return 0; }
-void tinyaiMemTrackCleanup() {}
-void tinyaiMemTrackAlloc(void *ptr, size_t size, const char *file, int line) { (void)ptr; (void)size; (void)file; (void)line; }
-void tinyaiMemTrackFree(void *ptr) { (void)ptr; }
-int tinyaiMemTrackDumpLeaks() { return 0; }
 void tinyaiMemTrackStats(size_t *allocCount, size_t *allocSize, 
                         size_t *freeCount, size_t *freeSize) {
-    if (allocCount) *allocCount = 0;
-    if (allocSize) *allocSize = 0;
-    if (freeCount) *freeCount = 0;
-    if (freeSize) *freeSize = 0;
-}
+    size_t counts[4] = {0, 0, 0, 0};
+
+    ensureTrackShards();
+    for (int i = 0; i < TRACK_SHARDS; i++) {
+        TrackShard *shard = &g_trackShards[i];
+        trackLock(&shard->lock);
+        counts[0] += shard->allocCount;
+        counts[1] += shard->allocSize;
+        counts[2] += shard->freeCount;
+        counts[3] += shard->freeSize;
+        trackUnlock(&shard->lock);
+    }
 
-#endif // TINYAI_MEMORY_TRACKING
+    if (allocCount) *allocCount = counts[0];
+    if (allocSize) *allocSize = counts[1]; // Total ever allocated
+    if (freeCount) *freeCount = counts[2];
+    if (freeSize) *freeSize = counts[3];
+}
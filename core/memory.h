@@ -44,6 +44,17 @@ void tinyaiFree(void *ptr);
  */
 void* tinyaiCalloc(size_t count, size_t size);
 
+/**
+ * Get the number of allocations made so far
+ * 
+ * Counts tinyaiAlloc, tinyaiRealloc and tinyaiCalloc calls. The counter is
+ * not synchronized, so concurrent allocations may be missed; it is meant
+ * for profiling.
+ * 
+ * @return Allocation count
+ */
+size_t tinyaiAllocCount(void);
+
 /* ----------------- Memory Pool ----------------- */
 
 /**
@@ -92,6 +103,27 @@ void tinyaiMemPoolStats(size_t *totalSize, size_t *usedSize,
 
 /* ----------------- Memory Tracking ----------------- */
 
+/*
+ * Tracked allocations live in hash tables sharded by address, each with its
+ * own lock, so tracking costs O(1) per call and scales across threads. With a
+ * sample rate of N only 1 in N allocations is tracked, which keeps the cost
+ * low enough for production builds; statistics and reports then cover the
+ * sampled allocations only. The TINYAI_MALLOC family routes through the
+ * tracker when TINYAI_MEMORY_TRACKING is defined.
+ */
+
+/**
+ * Allocations aggregated by the call site that made them
+ */
+typedef struct {
+    const char *file;  /* Source file name */
+    int line;          /* Source line number */
+    size_t allocCount; /* Tracked allocations ever made here */
+    size_t allocBytes; /* Bytes of those allocations */
+    size_t liveCount;  /* Tracked allocations not yet freed */
+    size_t liveBytes;  /* Bytes of those allocations */
+} TinyAIMemTrackSite;
+
 /**
  * Initialize memory tracking
  * 
@@ -105,7 +137,17 @@ int tinyaiMemTrackInit();
 void tinyaiMemTrackCleanup();
 
 /**
- * Track memory allocation
+ * Track 1 in rate allocations
+ * 
+ * Frees of allocations tracked under an earlier rate are still matched.
+ * 
+ * @param rate Sampling rate, 1 (the default) to track every allocation
+ * @return 0 on success, non-zero if rate is 0
+ */
+int tinyaiMemTrackSetSampleRate(unsigned int rate);
+
+/**
+ * Track memory allocation, subject to sampling
  * 
  * @param ptr Pointer to allocated memory
  * @param size Size of allocation
@@ -121,6 +163,45 @@ void tinyaiMemTrackAlloc(void *ptr, size_t size, const char *file, int line);
  */
 void tinyaiMemTrackFree(void *ptr);
 
+/**
+ * Allocate memory and track it
+ * 
+ * @param size Size in bytes to allocate
+ * @param file Source file name
+ * @param line Source line number
+ * @return Pointer to allocated memory or NULL on failure
+ */
+void* tinyaiMemTrackedAlloc(size_t size, const char *file, int line);
+
+/**
+ * Allocate zero-initialized memory and track it
+ * 
+ * @param count Number of elements
+ * @param size Size of each element
+ * @param file Source file name
+ * @param line Source line number
+ * @return Pointer to allocated memory or NULL on failure
+ */
+void* tinyaiMemTrackedCalloc(size_t count, size_t size, const char *file, int line);
+
+/**
+ * Reallocate memory, moving its tracking to the new block
+ * 
+ * @param ptr Pointer to memory to reallocate
+ * @param size New size in bytes
+ * @param file Source file name
+ * @param line Source line number
+ * @return Pointer to reallocated memory or NULL on failure
+ */
+void* tinyaiMemTrackedRealloc(void *ptr, size_t size, const char *file, int line);
+
+/**
+ * Stop tracking memory and free it
+ * 
+ * @param ptr Pointer to memory to free
+ */
+void tinyaiMemTrackedFree(void *ptr);
+
 /**
  * Dump memory leaks
  * 
@@ -128,6 +209,15 @@ void tinyaiMemTrackFree(void *ptr);
  */
 int tinyaiMemTrackDumpLeaks();
 
+/**
+ * Get tracked allocations aggregated by call site
+ * 
+ * @param sites Array to fill, largest live footprint first (may be NULL)
+ * @param maxSites Capacity of sites
+ * @return Number of call sites seen, which may exceed maxSites
+ */
+size_t tinyaiMemTrackGetSites(TinyAIMemTrackSite *sites, size_t maxSites);
+
 /**
  * Get memory tracking statistics
  * 
@@ -143,18 +233,10 @@ void tinyaiMemTrackStats(size_t *allocCount, size_t *allocSize,
 
 /* Memory tracking macros */
 #ifdef TINYAI_MEMORY_TRACKING
-#define TINYAI_MALLOC(size) \
-    (tinyaiMemTrackAlloc(tinyaiAlloc(size), (size), __FILE__, __LINE__), \
-     tinyaiAlloc(size))
-#define TINYAI_REALLOC(ptr, size) \
-    (tinyaiMemTrackFree(ptr), \
-     tinyaiMemTrackAlloc(tinyaiRealloc(ptr, size), (size), __FILE__, __LINE__), \
-     tinyaiRealloc(ptr, size))
-#define TINYAI_FREE(ptr) \
-    (tinyaiMemTrackFree(ptr), tinyaiFree(ptr))
-#define TINYAI_CALLOC(count, size) \
-    (tinyaiMemTrackAlloc(tinyaiCalloc(count, size), (count) * (size), __FILE__, __LINE__), \
-     tinyaiCalloc(count, size))
+#define TINYAI_MALLOC(size) tinyaiMemTrackedAlloc((size), __FILE__, __LINE__)
+#define TINYAI_REALLOC(ptr, size) tinyaiMemTrackedRealloc((ptr), (size), __FILE__, __LINE__)
+#define TINYAI_FREE(ptr) tinyaiMemTrackedFree(ptr)
+#define TINYAI_CALLOC(count, size) tinyaiMemTrackedCalloc((count), (size), __FILE__, __LINE__)
 #else
 #define TINYAI_MALLOC(size) tinyaiAlloc(size)
 #define TINYAI_REALLOC(ptr, size) tinyaiRealloc(ptr, size)
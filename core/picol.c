@@ -49,6 +49,13 @@ struct picolParser {
 // Add the typedef even though it's in picol.h because of possible include ordering issues
 typedef int (*picolCmdFunc)(picolInterp *i, int argc, char **argv, void *privdata);
 
+// Forward declarations
+struct picolProc;
+int         picolCommandCallProc(picolInterp *i, int argc, char **argv, void *pd);
+static int  picolRun(picolInterp *i, struct picolScript *s);
+static void picolFlushScripts(picolInterp *i);
+static void picolFreeProc(struct picolProc *proc);
+
 void picolInitParser(struct picolParser *p, char *text)
 {
     p->text = p->p = text;
@@ -283,45 +290,282 @@ int picolGetToken(struct picolParser *p)
     return PICOL_OK; /* unreached */
 }
 
-// Implementation of picolCreateInterp (required by picol.h)
-picolInterp *picolCreateInterp(void)
+/* ----------------------- Hash tables ----------------------- */
+
+// Smallest bucket count of a variable or command table
+#define PICOL_MIN_BUCKETS 8
+
+// Bucket count of the compiled script cache
+#define PICOL_SCRIPT_BUCKETS 128
+
+// FNV-1a hash of a NUL-terminated string
+static unsigned int picolHash(const char *s)
 {
-    picolInterp *i = malloc(sizeof(picolInterp));
-    if (!i)
+    unsigned int h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Find a variable in a call frame's table
+static struct picolVar *picolFrameGetVar(picolCallFrame *cf, char *name)
+{
+    if (!cf->vars)
         return NULL;
+    struct picolVar *v = cf->vars[picolHash(name) & (cf->varBuckets - 1)];
+    while (v) {
+        if (strcmp(v->name, name) == 0)
+            return v;
+        v = v->next;
+    }
+    return NULL;
+}
 
-    i->level     = 0;
-    i->callframe = malloc(sizeof(picolCallFrame));
-    if (!i->callframe) {
-        free(i);
+// Make room for one more variable, doubling the buckets once they average one entry
+static int picolFrameReserveVar(picolCallFrame *cf)
+{
+    if (cf->vars && cf->varCount < cf->varBuckets)
+        return PICOL_OK;
+
+    int               buckets = cf->vars ? cf->varBuckets * 2 : PICOL_MIN_BUCKETS;
+    struct picolVar **table   = calloc(buckets, sizeof(struct picolVar *));
+    if (!table)
+        return cf->vars ? PICOL_OK : PICOL_ERR; // A full table still works, just slower
+    for (int b = 0; cf->vars && b < cf->varBuckets; b++) {
+        struct picolVar *v = cf->vars[b], *next;
+        for (; v; v = next) {
+            unsigned int slot = picolHash(v->name) & (buckets - 1);
+            next              = v->next;
+            v->next           = table[slot];
+            table[slot]       = v;
+        }
+    }
+    free(cf->vars);
+    cf->vars       = table;
+    cf->varBuckets = buckets;
+    return PICOL_OK;
+}
+
+// Make room for one more command, doubling the buckets once they average one entry
+static int picolReserveCommand(picolInterp *i)
+{
+    if (i->commands && i->commandCount < i->commandBuckets)
+        return PICOL_OK;
+
+    int               buckets = i->commands ? i->commandBuckets * 2 : PICOL_MIN_BUCKETS * 4;
+    struct picolCmd **table   = calloc(buckets, sizeof(struct picolCmd *));
+    if (!table)
+        return i->commands ? PICOL_OK : PICOL_ERR;
+    for (int b = 0; i->commands && b < i->commandBuckets; b++) {
+        struct picolCmd *c = i->commands[b], *next;
+        for (; c; c = next) {
+            unsigned int slot = picolHash(c->name) & (buckets - 1);
+            next              = c->next;
+            c->next           = table[slot];
+            table[slot]       = c;
+        }
+    }
+    free(i->commands);
+    i->commands       = table;
+    i->commandBuckets = buckets;
+    return PICOL_OK;
+}
+
+/* ----------------------- Compiled scripts ----------------------- */
+
+// A piece of a word: literal text, a variable to substitute or a command to run
+typedef struct picolPart {
+    int                 type;   /* PT_STR (literal), PT_VAR or PT_CMD */
+    char               *text;   /* Literal text, variable name or command source */
+    struct picolScript *script; /* Compiled command (PT_CMD only) */
+} picolPart;
+
+// A script parsed once into commands of words of parts, ready to run many times
+struct picolScript {
+    char               *text;         /* Source text (the cache key) */
+    unsigned int        hash;         /* Hash of text */
+    int                 refs;         /* References from the cache and running evaluations */
+    picolPart          *parts;        /* Parts of every word, in order */
+    int                 partCount;    /* Number of parts */
+    int                *words;        /* First part of each word; words[wordCount] = partCount */
+    int                 wordCount;    /* Number of words */
+    int                *commands;     /* First word of each command, plus a wordCount sentinel */
+    int                 commandCount; /* Number of commands */
+    struct picolScript *next;         /* Next script in the same cache bucket */
+};
+
+static void picolReleaseScript(struct picolScript *s)
+{
+    if (!s || --s->refs > 0)
+        return;
+    for (int j = 0; j < s->partCount; j++) {
+        free(s->parts[j].text);
+        picolReleaseScript(s->parts[j].script);
+    }
+    free(s->parts);
+    free(s->words);
+    free(s->commands);
+    free(s->text);
+    free(s);
+}
+
+// Append to one of a script's arrays, growing it by doubling
+static int picolGrowArray(void **array, int count, size_t size)
+{
+    // Capacity is 8, or the power of two the count last reached: only those counts are full
+    if (count != 0 && (count < 8 || (count & (count - 1)) != 0))
+        return PICOL_OK;
+    int   capacity = count ? count * 2 : 8;
+    void *grown    = realloc(*array, capacity * size);
+    if (!grown)
+        return PICOL_ERR;
+    *array = grown;
+    return PICOL_OK;
+}
+
+/* Parse a script into its commands, words and parts. Tokens are grouped the
+ * way the evaluator always has: a token after a separator or end of line
+ * starts a new word, any other token is interpolated into the current word,
+ * and each end of line closes a command. Nested [commands] are compiled too. */
+static struct picolScript *picolCompile(const char *text)
+{
+    struct picolParser  p;
+    struct picolScript *s = calloc(1, sizeof(struct picolScript));
+    if (!s || !(s->text = _strdup(text))) {
+        free(s);
         return NULL;
     }
+    s->refs           = 1;
+    int commandFirst = 0; /* First word of the command being parsed */
 
-    i->callframe->vars    = NULL;
-    i->callframe->parent  = NULL;
-    i->callframe->command = NULL; // Initialize command field
-    i->commands           = NULL;
-    i->resultString       = _strdup("");
-    i->result             = PICOL_OK;
-    i->arrays             = NULL; // Initialize arrays field
-    i->current            = NULL; // Initialize current field
+    picolInitParser(&p, s->text);
+    while (1) {
+        int prevtype = p.type;
+        picolGetToken(&p);
+        if (p.type == PT_EOF)
+            break;
+        if (p.type == PT_SEP)
+            continue;
+        if (p.type == PT_EOL) {
+            if (s->wordCount > commandFirst) {
+                if (picolGrowArray((void **)&s->commands, s->commandCount, sizeof(int)))
+                    goto oom;
+                s->commands[s->commandCount++] = commandFirst;
+                commandFirst                   = s->wordCount;
+            }
+            continue;
+        }
 
-    return i;
+        int tlen = p.end - p.start + 1;
+        if (tlen < 0)
+            tlen = 0;
+        if (prevtype == PT_SEP || prevtype == PT_EOL) {
+            if (picolGrowArray((void **)&s->words, s->wordCount, sizeof(int)))
+                goto oom;
+            s->words[s->wordCount++] = s->partCount;
+        }
+        if (picolGrowArray((void **)&s->parts, s->partCount, sizeof(picolPart)))
+            goto oom;
+        picolPart *part = &s->parts[s->partCount];
+        part->type      = p.type == PT_VAR || p.type == PT_CMD ? p.type : PT_STR;
+        part->script    = NULL;
+        part->text      = malloc(tlen + 1);
+        if (!part->text)
+            goto oom;
+        memcpy(part->text, p.start, tlen);
+        part->text[tlen] = '\0';
+        s->partCount++;
+        if (part->type == PT_CMD && !(part->script = picolCompile(part->text)))
+            goto oom;
+    }
+
+    // Sentinels, so word w spans parts [words[w], words[w + 1]) and likewise for commands
+    if (picolGrowArray((void **)&s->words, s->wordCount, sizeof(int)) ||
+        picolGrowArray((void **)&s->commands, s->commandCount, sizeof(int)))
+        goto oom;
+    s->words[s->wordCount]       = s->partCount;
+    s->commands[s->commandCount] = s->wordCount;
+    return s;
+
+oom:
+    picolReleaseScript(s);
+    return NULL;
+}
+
+// Get the compiled form of a script from the cache, compiling it on a miss
+static struct picolScript *picolGetScript(picolInterp *i, char *text)
+{
+    unsigned int hash = picolHash(text);
+    if (!i->scripts) {
+        i->scripts = calloc(PICOL_SCRIPT_BUCKETS, sizeof(struct picolScript *));
+        if (!i->scripts)
+            return picolCompile(text); // Runs uncached
+    }
+
+    struct picolScript **bucket = &i->scripts[hash & (PICOL_SCRIPT_BUCKETS - 1)];
+    for (struct picolScript *s = *bucket; s; s = s->next) {
+        if (s->hash == hash && strcmp(s->text, text) == 0) {
+            s->refs++;
+            return s;
+        }
+    }
+
+    struct picolScript *s = picolCompile(text);
+    if (!s)
+        return NULL;
+    if (i->scriptCount >= PICOL_SCRIPT_CACHE) {
+        // Start over rather than track recency; running scripts keep their own reference
+        picolFlushScripts(i);
+    }
+    s->hash  = hash;
+    s->next  = *bucket;
+    *bucket  = s;
+    s->refs++; /* One for the cache, one for the caller */
+    i->scriptCount++;
+    return s;
 }
 
-// Use the existing picolInitInterp as helper for picolCreateInterp
+// Drop every cached script
+static void picolFlushScripts(picolInterp *i)
+{
+    for (int b = 0; i->scripts && b < PICOL_SCRIPT_BUCKETS; b++) {
+        struct picolScript *s = i->scripts[b], *next;
+        for (; s; s = next) {
+            next    = s->next;
+            s->next = NULL;
+            picolReleaseScript(s);
+        }
+        i->scripts[b] = NULL;
+    }
+    i->scriptCount = 0;
+}
+
+// Initialize an interpreter in place; picolCreateInterp allocates one first
 void picolInitInterp(picolInterp *i)
 {
-    i->level              = 0;
-    i->callframe          = malloc(sizeof(picolCallFrame));
-    i->callframe->vars    = NULL;
-    i->callframe->parent  = NULL;
-    i->callframe->command = NULL; // Initialize command field
-    i->commands           = NULL;
-    i->resultString       = _strdup("");
-    i->result             = PICOL_OK;
-    i->arrays             = NULL; // Initialize arrays field
-    i->current            = NULL; // Initialize current field
+    memset(i, 0, sizeof(picolInterp));
+    i->callframe = calloc(1, sizeof(picolCallFrame)); // No variables, no parent, no command
+    i->resultString = _strdup("");
+    i->result       = PICOL_OK;
+}
+
+// Implementation of picolCreateInterp (required by picol.h)
+picolInterp *picolCreateInterp(void)
+{
+    picolInterp *i = malloc(sizeof(picolInterp));
+    if (!i)
+        return NULL;
+
+    picolInitInterp(i);
+    if (!i->callframe || !i->resultString) {
+        free(i->callframe);
+        free(i->resultString);
+        free(i);
+        return NULL;
+    }
+    return i;
 }
 
 // Changed return type to void to match header file
@@ -338,13 +582,7 @@ char *picolGetResult(picolInterp *i) { return i->resultString; }
 // with the declaration in picol.h
 static struct picolVar *picolInternalGetVar(picolInterp *i, char *name)
 {
-    struct picolVar *v = i->callframe->vars;
-    while (v) {
-        if (strcmp(v->name, name) == 0)
-            return v;
-        v = v->next;
-    }
-    return NULL;
+    return picolFrameGetVar(i->callframe, name);
 }
 
 // This must match the declaration in picol.h
@@ -354,7 +592,6 @@ char *picolGetVar(picolInterp *i, char *name)
     return v ? v->val : NULL;
 }
 
-// Use typedef picolInterp *
 int picolSetVar(picolInterp *i, char *name, char *val)
 {
     struct picolVar *v = picolInternalGetVar(i, name);
@@ -362,16 +599,16 @@ int picolSetVar(picolInterp *i, char *name, char *val)
         free(v->val);
         v->val = _strdup(val);
         if (!v->val) {
-            picolSetResult(i, "Out of memory updating variable"); // This sets resultString
-            i->result = PICOL_ERR;                                // Set error code
+            picolSetResult(i, "Out of memory updating variable");
+            i->result = PICOL_ERR;
             return PICOL_ERR;
         }
     }
     else {
-        v = malloc(sizeof(picolVar)); // Use typedef
+        v = picolFrameReserveVar(i->callframe) == PICOL_OK ? malloc(sizeof(picolVar)) : NULL;
         if (!v) {
             picolSetResult(i, "Out of memory setting variable");
-            i->result = PICOL_ERR; // Set error code
+            i->result = PICOL_ERR;
             return PICOL_ERR;
         }
         v->name = _strdup(name);
@@ -383,19 +620,71 @@ int picolSetVar(picolInterp *i, char *name, char *val)
                 free(v->val);
             free(v);
             picolSetResult(i, "Out of memory setting variable");
-            i->result = PICOL_ERR; // Set error code
+            i->result = PICOL_ERR;
             return PICOL_ERR;
         }
-        v->next            = i->callframe->vars;
-        i->callframe->vars = v;
+        picolCallFrame *cf    = i->callframe;
+        unsigned int    slot  = picolHash(name) & (cf->varBuckets - 1);
+        v->next               = cf->vars[slot];
+        cf->vars[slot]        = v;
+        cf->varCount++;
     }
     return PICOL_OK;
 }
 
-// Use typedef picolInterp *
+// Implementation of array functions required by picol.h
+picolArray *picolInternalGetArray(picolInterp *i, char *name)
+{
+    picolArray *a = i->arrays;
+    while (a) {
+        if (strcmp(a->name, name) == 0)
+            return a;
+        a = a->next;
+    }
+    return NULL;
+}
+
+int picolSetArrayVar(picolInterp *i, char *name, char *key, char *val)
+{
+    picolArray *a = picolInternalGetArray(i, name);
+
+    // Create array if it doesn't exist
+    if (!a) {
+        a = malloc(sizeof(picolArray));
+        if (!a) {
+            picolSetResult(i, "Out of memory creating array");
+            i->result = PICOL_ERR;
+            return PICOL_ERR;
+        }
+        a->name   = _strdup(name);
+        a->vars   = NULL;
+        a->next   = i->arrays;
+        i->arrays = a;
+    }
+
+    // Create key format: "name(key)"
+    char fullname[PICOL_MAX_STR];
+    snprintf(fullname, PICOL_MAX_STR, "%s(%s)", name, key);
+
+    // Set the variable using existing mechanism
+    return picolSetVar(i, fullname, val);
+}
+
+char *picolGetArrayVar(picolInterp *i, char *name, char *key)
+{
+    // Create key format: "name(key)"
+    char fullname[PICOL_MAX_STR];
+    snprintf(fullname, PICOL_MAX_STR, "%s(%s)", name, key);
+
+    // Get the variable using existing mechanism
+    return picolGetVar(i, fullname);
+}
+
 struct picolCmd *picolGetCommand(picolInterp *i, char *name)
 {
-    struct picolCmd *c = i->commands;
+    if (!i->commands)
+        return NULL;
+    struct picolCmd *c = i->commands[picolHash(name) & (i->commandBuckets - 1)];
     while (c) {
         if (strcmp(c->name, name) == 0)
             return c;
@@ -404,7 +693,6 @@ struct picolCmd *picolGetCommand(picolInterp *i, char *name)
     return NULL;
 }
 
-// Use typedef picolInterp *
 int picolRegisterCommand(picolInterp *i, char *name, picolCmdFunc func, void *privdata)
 {
     struct picolCmd *c = picolGetCommand(i, name);
@@ -416,55 +704,47 @@ int picolRegisterCommand(picolInterp *i, char *name, picolCmdFunc func, void *pr
         return PICOL_ERR;
     }
 
-    c = malloc(sizeof(picolCmd));
+    c = picolReserveCommand(i) == PICOL_OK ? malloc(sizeof(picolCmd)) : NULL;
     if (c)
         c->name = _strdup(name);
     if (c == NULL || c->name == NULL) {
-        if (c)
-            free(c->name);
         free(c);
         picolSetResult(i, "Out of memory registering command");
         i->result = PICOL_ERR;
         return PICOL_ERR;
     }
-    c->func     = func;
-    c->type     = PICOL_COMMAND_TYPE_C; // Set command type from enum in picol.h
-    c->privdata = privdata;
-    c->next     = i->commands;
-    i->commands = c;
+    unsigned int slot = picolHash(name) & (i->commandBuckets - 1);
+    c->func           = func;
+    c->type           = PICOL_COMMAND_TYPE_C; // Set command type from enum in picol.h
+    c->privdata       = privdata;
+    c->next           = i->commands[slot];
+    i->commands[slot] = c;
+    i->commandCount++;
     return PICOL_OK;
 }
 
+// Free a command, including the definition of a proc
+static void picolFreeCommand(struct picolCmd *c)
+{
+    free(c->name);
+    if (c->type == PICOL_COMMAND_TYPE_C && c->func == picolCommandCallProc)
+        picolFreeProc(c->privdata);
+    free(c);
+}
+
 // Implementation of picolUnregisterCommand (required by picol.h)
 int picolUnregisterCommand(picolInterp *i, char *name)
 {
-    struct picolCmd *c    = i->commands;
-    struct picolCmd *prev = NULL;
-
-    while (c) {
+    struct picolCmd **link = i->commands ? &i->commands[picolHash(name) & (i->commandBuckets - 1)]
+                                         : NULL;
+    for (; link && *link; link = &(*link)->next) {
+        struct picolCmd *c = *link;
         if (strcmp(c->name, name) == 0) {
-            if (prev == NULL) {
-                i->commands = c->next;
-            }
-            else {
-                prev->next = c->next;
-            }
-
-            // Free command resources
-            free(c->name);
-            if (c->type == PICOL_COMMAND_TYPE_C && c->func == picolCommandCallProc) {
-                char **procdata = c->privdata;
-                if (procdata) {
-                    free(procdata[0]);
-                    free(procdata[1]);
-                    free(procdata);
-                }
-            }
-            free(c);
+            *link = c->next;
+            i->commandCount--;
+            picolFreeCommand(c);
             return PICOL_OK;
         }
-        prev = c;
-        c    = c->next;
     }
 
     picolSetResult(i, "No such command");
@@ -472,109 +752,127 @@ int picolUnregisterCommand(picolInterp *i, char *name)
     return PICOL_ERR;
 }
 
-/* EVAL! */
-// Use typedef picolInterp *
-int picolEval(picolInterp *i, char *t)
+/* Build the value of a word. A single literal part is copied as is; other
+ * words concatenate their literal text, variable values and command results. */
+static char *picolWordValue(picolInterp *i, struct picolScript *s, int w, int *retcode)
 {
-    struct picolParser p; // Internal parser struct
-    int                argc = 0, j;
-    char             **argv = NULL;
-    char               errbuf[1024];
-    int                retcode = PICOL_OK;
-    picolSetResult(i, ""); // Sets resultString
-    i->result = PICOL_OK;  // Reset result code
-    picolInitParser(&p, t);
-    while (1) {
-        char *t;
-        int   tlen;
-        int   prevtype = p.type;
-        picolGetToken(&p);
-        if (p.type == PT_EOF)
-            break;
-        tlen = p.end - p.start + 1;
-        if (tlen < 0)
-            tlen = 0;
-        t = malloc(tlen + 1);
-        memcpy(t, p.start, tlen);
-        t[tlen] = '\0';
-        if (p.type == PT_VAR) {
-            struct picolVar *v = picolGetVar(i, t);
-            if (!v) {
-                snprintf(errbuf, 1024, "No such variable '%s'", t);
-                free(t);
+    char  errbuf[1024];
+    char *value = NULL;
+    int   len   = 0;
+    *retcode    = PICOL_OK;
+
+    for (int j = s->words[w]; j < s->words[w + 1]; j++) {
+        picolPart *part  = &s->parts[j];
+        char      *piece = part->text;
+        if (part->type == PT_VAR) {
+            piece = picolGetVar(i, part->text);
+            if (!piece) {
+                snprintf(errbuf, 1024, "No such variable '%s'", part->text);
                 picolSetResult(i, errbuf);
-                i->result = PICOL_ERR; // Set error code
-                retcode   = PICOL_ERR;
-                goto err;
+                i->result = PICOL_ERR;
+                *retcode  = PICOL_ERR;
+                free(value);
+                return NULL;
             }
-            free(t);
-            t = _strdup(v->val);
-        }
-        else if (p.type == PT_CMD) {
-            retcode = picolEval(i, t);
-            free(t);
-            if (retcode != PICOL_OK)
-                goto err;
-            t = _strdup(i->resultString); // Get result from resultString
         }
-        else if (p.type == PT_ESC) {
-            /* TODO: escape handling missing! */
+        else if (part->type == PT_CMD) {
+            *retcode = picolRun(i, part->script);
+            if (*retcode != PICOL_OK) {
+                free(value);
+                return NULL;
+            }
+            piece = i->resultString;
         }
-        else if (p.type == PT_SEP) {
-            prevtype = p.type;
-            free(t);
-            continue;
+
+        int   plen  = strlen(piece);
+        char *grown = realloc(value, len + plen + 1);
+        if (!grown) {
+            picolSetResult(i, "Out of memory evaluating word");
+            i->result = PICOL_ERR;
+            *retcode  = PICOL_ERR;
+            free(value);
+            return NULL;
         }
-        /* We have a complete command + args. Call it! */
-        if (p.type == PT_EOL) {
-            struct picolCmd *c;
-            free(t);
-            prevtype = p.type;
-            if (argc) {
-                if ((c = picolGetCommand(i, argv[0])) == NULL) {
-                    snprintf(errbuf, 1024, "No such command '%s'", argv[0]);
-                    picolSetResult(i, errbuf);
-                    i->result = PICOL_ERR; // Set error code
-                    retcode   = PICOL_ERR;
-                    goto err;
-                }
-                retcode = c->func(i, argc, argv, c->privdata);
-                // The command function itself should set i->result and i->resultString
-                if (retcode != PICOL_OK)
-                    goto err;
+        value = grown;
+        memcpy(value + len, piece, plen + 1);
+        len += plen;
+    }
+    return value;
+}
+
+/* Run a compiled script: each command's words are substituted and the command
+ * called, stopping at the first one that does not return PICOL_OK. */
+static int picolRun(picolInterp *i, struct picolScript *s)
+{
+    char   errbuf[1024];
+    char  *stackArgv[16];
+    char **argv    = stackArgv;
+    int    argc    = 0, j;
+    int    retcode = PICOL_OK;
+    picolSetResult(i, "");
+    i->result = PICOL_OK;
+
+    for (int c = 0; c < s->commandCount; c++) {
+        int first = s->commands[c], count = s->commands[c + 1] - first;
+        if (count > (int)(sizeof(stackArgv) / sizeof(char *))) {
+            argv = malloc(sizeof(char *) * (count + 1));
+            if (!argv) {
+                picolSetResult(i, "Out of memory evaluating command");
+                i->result = PICOL_ERR;
+                return PICOL_ERR;
             }
-            /* Prepare for the next command */
-            for (j = 0; j < argc; j++)
-                free(argv[j]);
-            free(argv);
-            argv = NULL;
-            argc = 0;
-            continue;
         }
-        /* We have a new token, append to the previous or as new arg? */
-        if (prevtype == PT_SEP || prevtype == PT_EOL) {
-            argv       = realloc(argv, sizeof(char *) * (argc + 1));
-            argv[argc] = t;
-            argc++;
+        for (argc = 0; argc < count; argc++) {
+            argv[argc] = picolWordValue(i, s, first + argc, &retcode);
+            if (!argv[argc])
+                goto err;
         }
-        else { /* Interpolation */
-            int oldlen = strlen(argv[argc - 1]), tlen = strlen(t);
-            argv[argc - 1] = realloc(argv[argc - 1], oldlen + tlen + 1);
-            memcpy(argv[argc - 1] + oldlen, t, tlen);
-            argv[argc - 1][oldlen + tlen] = '\0';
-            free(t);
+
+        struct picolCmd *cmd = picolGetCommand(i, argv[0]);
+        if (cmd == NULL) {
+            snprintf(errbuf, 1024, "No such command '%s'", argv[0]);
+            picolSetResult(i, errbuf);
+            i->result = PICOL_ERR;
+            retcode   = PICOL_ERR;
+            goto err;
         }
-        prevtype = p.type;
+        retcode = cmd->func(i, argc, argv, cmd->privdata);
+        // The command function itself should set i->result and i->resultString
+        if (retcode != PICOL_OK)
+            goto err;
+
+        /* Prepare for the next command */
+        for (j = 0; j < argc; j++)
+            free(argv[j]);
+        if (argv != stackArgv)
+            free(argv);
+        argv = stackArgv;
     }
+    return PICOL_OK;
+
 err:
     for (j = 0; j < argc; j++)
         free(argv[j]);
-    free(argv);
+    if (argv != stackArgv)
+        free(argv);
+    return retcode;
+}
+
+/* EVAL! */
+int picolEval(picolInterp *i, char *t)
+{
+    struct picolScript *s = picolGetScript(i, t);
+    if (!s) {
+        picolSetResult(i, "Out of memory parsing script");
+        i->result = PICOL_ERR;
+        return PICOL_ERR;
+    }
+    int retcode = picolRun(i, s);
+    picolReleaseScript(s);
     return retcode;
 }
 
 /* ACTUAL COMMANDS! */
-// Use typedef picolInterp *
 int picolArityErr(picolInterp *i, char *name)
 {
     char buf[1024];
@@ -704,99 +1002,120 @@ int picolCommandRetCodes(picolInterp *i, int argc, char **argv, void *pd)
 // Use typedef picolInterp *
 void picolDropCallFrame(picolInterp *i)
 {
-    picolCallFrame  *cf = i->callframe; // Use typedef
-    struct picolVar *v  = cf->vars, *t;
-    while (v) {
-        t = v->next;
-        free(v->name);
-        free(v->val);
-        free(v);
-        v = t;
+    picolCallFrame *cf = i->callframe; // Use typedef
+    for (int b = 0; cf->vars && b < cf->varBuckets; b++) {
+        struct picolVar *v = cf->vars[b], *t;
+        while (v) {
+            t = v->next;
+            free(v->name);
+            free(v->val);
+            free(v);
+            v = t;
+        }
     }
+    free(cf->vars);
     i->callframe = cf->parent;
     free(cf);
 }
 
+// A proc's definition: its parameter names, split once, and its compiled body
+typedef struct picolProc {
+    int                 arity;  /* Number of parameters */
+    char              **params; /* Parameter names */
+    struct picolScript *body;   /* Compiled body */
+} picolProc;
+
+static void picolFreeProc(struct picolProc *proc)
+{
+    if (!proc)
+        return;
+    for (int j = 0; j < proc->arity; j++)
+        free(proc->params[j]);
+    free(proc->params);
+    picolReleaseScript(proc->body);
+    free(proc);
+}
+
 // Use typedef picolInterp *
 int picolCommandCallProc(picolInterp *i, int argc, char **argv, void *pd)
 {
-    char          **x = pd, *alist = x[0], *body = x[1], *p = _strdup(alist), *tofree;
-    picolCallFrame *cf    = malloc(sizeof(picolCallFrame)); // Use typedef
-    int             arity = 0, done = 0, errcode = PICOL_OK;
+    picolProc      *proc    = pd;
+    picolCallFrame *cf      = NULL;
+    int             errcode = PICOL_OK;
     char            errbuf[1024];
-    cf->vars     = NULL;
+
+    if (argc - 1 != proc->arity) {
+        snprintf(errbuf, 1024, "Proc '%s' called with wrong arg num", argv[0]);
+        picolSetResult(i, errbuf);
+        i->result = PICOL_ERR; // Set error code
+        return PICOL_ERR;
+    }
+    cf = calloc(1, sizeof(picolCallFrame)); // Use typedef
+    if (!cf) {
+        picolSetResult(i, "Out of memory calling proc");
+        i->result = PICOL_ERR;
+        return PICOL_ERR;
+    }
     cf->parent   = i->callframe;
     i->callframe = cf;
-    tofree       = p;
-    while (1) {
-        char *start = p;
-        while (*p != ' ' && *p != '\0')
-            p++;
-        if (*p != '\0' && p == start) {
-            p++;
-            continue;
-        }
-        if (p == start)
-            break;
-        if (*p == '\0')
-            done = 1;
-        else
-            *p = '\0';
-        if (++arity > argc - 1)
-            goto arityerr;
-        picolSetVar(i, start, argv[arity]);
-        p++;
-        if (done)
-            break;
-    }
-    free(tofree);
-    if (arity != argc - 1)
-        goto arityerr;
-    errcode = picolEval(i, body);
+    for (int j = 0; j < proc->arity; j++)
+        picolSetVar(i, proc->params[j], argv[j + 1]);
+
+    /* The body outlives the proc if it unregisters itself while running */
+    struct picolScript *body = proc->body;
+    body->refs++;
+    errcode = picolRun(i, body);
+    picolReleaseScript(body);
     if (errcode == PICOL_RETURN)
         errcode = PICOL_OK;
     picolDropCallFrame(i); /* remove the called proc callframe */
     return errcode;
-arityerr:
-    snprintf(errbuf, 1024, "Proc '%s' called with wrong arg num", argv[0]);
-    picolSetResult(i, errbuf);
-    i->result = PICOL_ERR; // Set error code
-    free(tofree);
-    picolDropCallFrame(i); /* remove the called proc callframe */
-    return PICOL_ERR;
 }
 
 // Use typedef picolInterp *
 int picolCommandProc(picolInterp *i, int argc, char **argv, void *pd)
 {
-    char **procdata = malloc(sizeof(char *) * 2);
-    if (!procdata) {
-        picolSetResult(i, "Out of memory registering proc");
-        i->result = PICOL_ERR; // Set error code
-        return PICOL_ERR;
-    }
-    procdata[0] = procdata[1] = NULL;
-
-    if (argc != 4) {
-        free(procdata);
+    if (argc != 4)
         return picolArityErr(i, argv[0]);
-    }
 
-    procdata[0] = _strdup(argv[2]); /* Arguments list. */
-    procdata[1] = _strdup(argv[3]); /* Procedure body. */
-    if (procdata[0] == NULL || procdata[1] == NULL)
+    picolProc *proc = calloc(1, sizeof(picolProc));
+    if (!proc)
+        goto oom;
+
+    /* Arguments list: names separated by spaces */
+    for (char *p = argv[2]; *p;) {
+        char *start = p;
+        while (*p != ' ' && *p != '\0')
+            p++;
+        if (p > start) {
+            char **params = realloc(proc->params, sizeof(char *) * (proc->arity + 1));
+            if (!params)
+                goto oom;
+            proc->params = params;
+            if (!(proc->params[proc->arity] = malloc(p - start + 1)))
+                goto oom;
+            memcpy(proc->params[proc->arity], start, p - start);
+            proc->params[proc->arity++][p - start] = '\0';
+        }
+        if (*p == ' ')
+            p++;
+    }
+    /* Procedure body, parsed once for every call */
+    if (!(proc->body = picolCompile(argv[3])))
         goto oom;
-    int regResult = picolRegisterCommand(i, argv[1], picolCommandCallProc, procdata);
+
+    int regResult = picolRegisterCommand(i, argv[1], picolCommandCallProc, proc);
     if (regResult == PICOL_OK) {
         picolSetResult(i, ""); // Set empty result on success
     }
+    else {
+        picolFreeProc(proc);
+    }
     // picolRegisterCommand already sets result on error
     return regResult;
 
 oom:
-    free(procdata[0]); /* Safe to free NULL */
-    free(procdata[1]);
-    free(procdata);
+    picolFreeProc(proc);
     picolSetResult(i, "Out of memory registering proc");
     i->result = PICOL_ERR; // Set error code
     return PICOL_ERR;
@@ -865,6 +1184,7 @@ int main(int argc, char **argv)
     // picolFreeInterp(&interp); // Need to implement or find picolFreeInterp
     return 0;
 }
+#endif // TINYAI_BUILD
 
 /* Add an implementation for picolFreeInterp */
 void picolFreeInterp(picolInterp *i)
@@ -878,22 +1198,20 @@ void picolFreeInterp(picolInterp *i)
     }
 
     // Free commands
-    struct picolCmd *c = i->commands;
-    struct picolCmd *next;
-    while (c) {
-        next = c->next;
-        free(c->name);
-        if (c->type == PICOL_COMMAND_TYPE_C && c->func == picolCommandCallProc) {
-            char **procdata = c->privdata;
-            if (procdata) {
-                free(procdata[0]);
-                free(procdata[1]);
-                free(procdata);
-            }
+    for (int b = 0; i->commands && b < i->commandBuckets; b++) {
+        struct picolCmd *c = i->commands[b];
+        struct picolCmd *next;
+        while (c) {
+            next = c->next;
+            picolFreeCommand(c);
+            c = next;
         }
-        free(c);
-        c = next;
     }
+    free(i->commands);
+
+    // Free compiled scripts
+    picolFlushScripts(i);
+    free(i->scripts);
 
     // Free arrays
     picolArray *a = i->arrays;
@@ -917,52 +1235,3 @@ void picolFreeInterp(picolInterp *i)
     // Free the interpreter itself
     free(i);
 }
-// Implementation of array functions required by picol.h
-picolArray *picolInternalGetArray(picolInterp *i, char *name)
-{
-    picolArray *a = i->arrays;
-    while (a) {
-        if (strcmp(a->name, name) == 0)
-            return a;
-        a = a->next;
-    }
-    return NULL;
-}
-
-int picolSetArrayVar(picolInterp *i, char *name, char *key, char *val)
-{
-    picolArray *a = picolInternalGetArray(i, name);
-
-    // Create array if it doesn't exist
-    if (!a) {
-        a = malloc(sizeof(picolArray));
-        if (!a) {
-            picolSetResult(i, "Out of memory creating array");
-            i->result = PICOL_ERR;
-            return PICOL_ERR;
-        }
-        a->name   = _strdup(name);
-        a->vars   = NULL;
-        a->next   = i->arrays;
-        i->arrays = a;
-    }
-
-    // Create key format: "name(key)"
-    char fullname[PICOL_MAX_STR];
-    snprintf(fullname, PICOL_MAX_STR, "%s(%s)", name, key);
-
-    // Set the variable using existing mechanism
-    return picolSetVar(i, fullname, val);
-}
-
-char *picolGetArrayVar(picolInterp *i, char *name, char *key)
-{
-    // Create key format: "name(key)"
-    char fullname[PICOL_MAX_STR];
-    snprintf(fullname, PICOL_MAX_STR, "%s(%s)", name, key);
-
-    // Get the variable using existing mechanism
-    return picolGetVar(i, fullname);
-}
-
-#endif // TINYAI_BUILD
@@ -22,6 +22,10 @@ extern "C" {
  * processed as a command result or argument. */
 #define PICOL_MAX_STR 4096
 
+/* PICOL_SCRIPT_CACHE is the number of evaluated scripts kept compiled, so
+ * loop and branch bodies are parsed once rather than on every evaluation. */
+#define PICOL_SCRIPT_CACHE 256
+
 enum {PICOL_OK, PICOL_ERR, PICOL_RETURN, PICOL_BREAK, PICOL_CONTINUE};
 enum {PICOL_COMMAND_TYPE_STR, PICOL_COMMAND_TYPE_C};
 
@@ -37,15 +41,24 @@ typedef struct picolArray {
 } picolArray;
 
 typedef struct picolCallFrame {
-    struct picolVar *vars;
+    struct picolVar **vars;        /* Hash buckets of the frame's variables (NULL until set) */
+    int varBuckets;                /* Number of buckets (a power of two) */
+    int varCount;                  /* Number of variables */
     struct picolCallFrame *parent; /* parent is NULL at top level */
     char *command;                 /* Currently executing command (or NULL) */
 } picolCallFrame;
 
+/* Script compiled to a list of words and commands (internal to picol.c) */
+struct picolScript;
+
 typedef struct picolInterp {
     int result;
     char *resultString;
-    struct picolCmd *commands;
+    struct picolCmd **commands;    /* Hash buckets of the registered commands */
+    int commandBuckets;            /* Number of buckets (a power of two) */
+    int commandCount;              /* Number of commands */
+    struct picolScript **scripts;  /* Compiled scripts by their text, hashed */
+    int scriptCount;               /* Number of cached scripts */
     struct picolCallFrame *callframe;
     struct picolArray *arrays;
     int level;
@@ -10,10 +10,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include "runtime.h"
 #include "picol.h" // Include the header from the same directory
 #include "io.h"
 #include "config.h"
 #include "memory.h"
+#include "../utils/thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 /* ----------------- Module System ----------------- */
 
@@ -133,12 +141,6 @@ int tinyaiUnloadModule(picolInterp *interp, const char *name) {
 /* Resource tracker structure */
 #define MAX_RESOURCES 256
 
-typedef enum {
-    RESOURCE_FILE,
-    RESOURCE_MEMORY,
-    RESOURCE_OTHER
-} ResourceType;
-
 typedef struct {
     ResourceType type;
     void *handle;
@@ -201,16 +203,6 @@ void tinyaiReleaseAllResources() {
 
 #define MAX_ERROR_MSG 1024
 
-typedef enum {
-    ERROR_NONE,
-    ERROR_SYNTAX,
-    ERROR_RUNTIME,
-    ERROR_MEMORY,
-    ERROR_IO,
-    ERROR_MODULE,
-    ERROR_OTHER
-} ErrorType;
-
 typedef struct {
     ErrorType type;
     char message[MAX_ERROR_MSG];
@@ -262,122 +254,269 @@ void tinyaiClearError() {
 #define MAX_EVENT_HANDLERS 64
 
 typedef struct {
-    char name[64];
     int priority;
-    int (*handler)(void *data);
+    TinyAIEventHandler handler;
     void *userData;
 } EventHandler;
 
+/*
+ * Handlers of an event, highest priority first. A list is never changed once
+ * published: registering a handler publishes a copy with it added, so a
+ * trigger reads the list without locking. Replaced lists stay allocated until
+ * the runtime is cleaned up, since a trigger may still be walking them.
+ */
+typedef struct EventHandlerList {
+    struct EventHandlerList *retired; /* Next replaced list */
+    int count;
+    EventHandler entries[];
+} EventHandlerList;
+
 typedef struct {
     char name[64];
-    EventHandler handlers[MAX_EVENT_HANDLERS];
-    int handlerCount;
+    EventHandlerList *handlers; /* Current list, NULL while there are no handlers */
 } Event;
 
-static Event events[MAX_EVENTS];
-static int eventCount = 0;
+/* An event queued on the thread pool */
+typedef struct {
+    int eventId;
+    void *data;
+} AsyncEvent;
 
-/**
- * Register an event
- */
-int tinyaiRegisterEvent(const char *name) {
-    if (eventCount >= MAX_EVENTS) return -1; /* Too many events */
-    
-    /* Check if event already exists */
-    for (int i = 0; i < eventCount; i++) {
+static Event events[MAX_EVENTS];
+static int eventCount = 0; /* Published after the event's name is written */
+static EventHandlerList *retiredHandlers = NULL;
+static TinyAITaskGroup *asyncEvents = NULL;
+
+/* Serializes registration; triggers never take it */
+#ifdef _WIN32
+static SRWLOCK eventLock = SRWLOCK_INIT;
+#define lockEvents() AcquireSRWLockExclusive(&eventLock)
+#define unlockEvents() ReleaseSRWLockExclusive(&eventLock)
+#else
+static pthread_mutex_t eventLock = PTHREAD_MUTEX_INITIALIZER;
+#define lockEvents() pthread_mutex_lock(&eventLock)
+#define unlockEvents() pthread_mutex_unlock(&eventLock)
+#endif
+
+static int findEvent(const char *name) {
+    int count = __atomic_load_n(&eventCount, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
         if (strcmp(events[i].name, name) == 0) {
-            return i; /* Event already exists */
+            return i;
         }
     }
-    
+    return -1;
+}
+
+/* Register an event; the caller holds the event lock */
+static int registerEventLocked(const char *name) {
+    int eventId = findEvent(name);
+    if (eventId >= 0) return eventId; /* Event already exists */
+    if (eventCount >= MAX_EVENTS) return -1; /* Too many events */
+
     /* Create new event */
     Event *event = &events[eventCount];
     strncpy(event->name, name, sizeof(event->name) - 1);
     event->name[sizeof(event->name) - 1] = '\0';
-    event->handlerCount = 0;
-    
-    return eventCount++;
+    event->handlers = NULL;
+
+    __atomic_store_n(&eventCount, eventCount + 1, __ATOMIC_RELEASE);
+    return eventCount - 1;
 }
 
 /**
- * Register an event handler
+ * Register an event
  */
-int tinyaiRegisterEventHandler(const char *eventName, int priority,
-                            int (*handler)(void *data), void *userData) {
-    /* Find the event */
-    int eventId = -1;
-    for (int i = 0; i < eventCount; i++) {
-        if (strcmp(events[i].name, eventName) == 0) {
-            eventId = i;
-            break;
-        }
-    }
-    
-    if (eventId == -1) {
-        /* Event doesn't exist, create it */
-        eventId = tinyaiRegisterEvent(eventName);
-        if (eventId == -1) return 0; /* Failed to create event */
+int tinyaiRegisterEvent(const char *name) {
+    if (!name) return -1;
+
+    lockEvents();
+    int eventId = registerEventLocked(name);
+    unlockEvents();
+    return eventId;
+}
+
+/**
+ * Find a registered event
+ */
+int tinyaiFindEvent(const char *name) {
+    return name ? findEvent(name) : -1;
+}
+
+/**
+ * Register an event handler by event ID
+ */
+int tinyaiRegisterEventHandlerId(int eventId, int priority,
+                                 TinyAIEventHandler handler, void *userData) {
+    if (!handler) return 0;
+
+    lockEvents();
+    if (eventId < 0 || eventId >= eventCount) {
+        unlockEvents();
+        return 0; /* Invalid event */
     }
-    
+
     Event *event = &events[eventId];
-    if (event->handlerCount >= MAX_EVENT_HANDLERS) {
+    EventHandlerList *old = event->handlers;
+    int count = old ? old->count : 0;
+    if (count >= MAX_EVENT_HANDLERS) {
+        unlockEvents();
         return 0; /* Too many handlers for this event */
     }
-    
-    /* Add the handler */
-    EventHandler *h = &event->handlers[event->handlerCount++];
-    strncpy(h->name, eventName, sizeof(h->name) - 1);
-    h->name[sizeof(h->name) - 1] = '\0';
-    h->priority = priority;
-    h->handler = handler;
-    h->userData = userData;
-    
-    /* Sort handlers by priority (higher priority first) */
-    for (int i = event->handlerCount - 1; i > 0; i--) {
-        if (event->handlers[i].priority > event->handlers[i-1].priority) {
-            /* Swap */
-            EventHandler temp = event->handlers[i];
-            event->handlers[i] = event->handlers[i-1];
-            event->handlers[i-1] = temp;
-        } else {
-            break;
-        }
+
+    EventHandlerList *list = (EventHandlerList *)malloc(sizeof(EventHandlerList) +
+                                                        (count + 1) * sizeof(EventHandler));
+    if (!list) {
+        unlockEvents();
+        return 0;
     }
-    
+
+    /* Copy the handlers with the new one after those of equal or higher priority */
+    int pos = 0;
+    while (pos < count && old->entries[pos].priority >= priority) {
+        list->entries[pos] = old->entries[pos];
+        pos++;
+    }
+    list->entries[pos].priority = priority;
+    list->entries[pos].handler = handler;
+    list->entries[pos].userData = userData;
+    for (int i = pos; i < count; i++) {
+        list->entries[i + 1] = old->entries[i];
+    }
+    list->count = count + 1;
+    list->retired = NULL;
+
+    __atomic_store_n(&event->handlers, list, __ATOMIC_RELEASE);
+    if (old) {
+        old->retired = retiredHandlers;
+        retiredHandlers = old;
+    }
+    unlockEvents();
     return 1;
 }
 
 /**
- * Trigger an event
+ * Register an event handler
  */
-int tinyaiTriggerEvent(const char *eventName, void *data) {
-    /* Find the event */
-    int eventId = -1;
-    for (int i = 0; i < eventCount; i++) {
-        if (strcmp(events[i].name, eventName) == 0) {
-            eventId = i;
-            break;
-        }
-    }
-    
-    if (eventId == -1) {
+int tinyaiRegisterEventHandler(const char *eventName, int priority,
+                            TinyAIEventHandler handler, void *userData) {
+    if (!eventName) return 0;
+
+    /* Create the event if it doesn't exist */
+    lockEvents();
+    int eventId = registerEventLocked(eventName);
+    unlockEvents();
+    if (eventId == -1) return 0; /* Failed to create event */
+
+    return tinyaiRegisterEventHandlerId(eventId, priority, handler, userData);
+}
+
+/**
+ * Check whether an event has handlers
+ */
+int tinyaiEventHasHandlers(int eventId) {
+    if (eventId < 0 || eventId >= __atomic_load_n(&eventCount, __ATOMIC_ACQUIRE)) return 0;
+    return __atomic_load_n(&events[eventId].handlers, __ATOMIC_RELAXED) != NULL;
+}
+
+/**
+ * Trigger an event by ID
+ */
+int tinyaiTriggerEventId(int eventId, void *data) {
+    if (eventId < 0 || eventId >= __atomic_load_n(&eventCount, __ATOMIC_ACQUIRE)) {
         return 0; /* Event doesn't exist */
     }
-    
-    Event *event = &events[eventId];
-    
+
+    EventHandlerList *list = __atomic_load_n(&events[eventId].handlers, __ATOMIC_ACQUIRE);
+    if (!list) return 1;
+
     /* Call all handlers in priority order */
-    for (int i = 0; i < event->handlerCount; i++) {
-        int result = event->handlers[i].handler(data);
+    for (int i = 0; i < list->count; i++) {
+        int result = list->entries[i].handler(data);
         if (result != 0) {
             /* Handler requested to stop propagation */
             return 1;
         }
     }
-    
+
     return 1;
 }
 
+/**
+ * Trigger an event
+ */
+int tinyaiTriggerEvent(const char *eventName, void *data) {
+    return eventName ? tinyaiTriggerEventId(findEvent(eventName), data) : 0;
+}
+
+static void dispatchAsyncEvent(void *context) {
+    AsyncEvent *queued = (AsyncEvent *)context;
+    tinyaiTriggerEventId(queued->eventId, queued->data);
+    free(queued);
+}
+
+/**
+ * Trigger an event on the thread pool
+ */
+int tinyaiTriggerEventAsync(int eventId, void *data) {
+    if (eventId < 0 || eventId >= __atomic_load_n(&eventCount, __ATOMIC_ACQUIRE)) {
+        return 0; /* Event doesn't exist */
+    }
+    if (!__atomic_load_n(&events[eventId].handlers, __ATOMIC_ACQUIRE)) {
+        return 1; /* Nothing to dispatch */
+    }
+
+    /* The group is created with the shared pool on first use */
+    TinyAITaskGroup *group = __atomic_load_n(&asyncEvents, __ATOMIC_ACQUIRE);
+    if (!group) {
+        lockEvents();
+        group = asyncEvents;
+        if (!group) {
+            group = tinyaiCreateTaskGroup(tinyaiGetThreadPool());
+            __atomic_store_n(&asyncEvents, group, __ATOMIC_RELEASE);
+        }
+        unlockEvents();
+    }
+
+    AsyncEvent *queued = (AsyncEvent *)malloc(sizeof(AsyncEvent));
+    if (!group || !queued) {
+        free(queued);
+        return tinyaiTriggerEventId(eventId, data); /* Dispatch here instead */
+    }
+    queued->eventId = eventId;
+    queued->data = data;
+    tinyaiTaskGroupRun(group, dispatchAsyncEvent, queued, TINYAI_AFFINITY_ANY);
+    return 1;
+}
+
+/**
+ * Wait for asynchronously triggered events
+ */
+void tinyaiWaitForEvents(void) {
+    TinyAITaskGroup *group = __atomic_load_n(&asyncEvents, __ATOMIC_ACQUIRE);
+    if (group) {
+        tinyaiTaskGroupWait(group);
+    }
+}
+
+/* Drop every event and handler; no trigger may be running */
+static void clearEvents(void) {
+    tinyaiDestroyTaskGroup(asyncEvents);
+    asyncEvents = NULL;
+
+    for (int i = 0; i < eventCount; i++) {
+        free(events[i].handlers);
+        events[i].handlers = NULL;
+    }
+    eventCount = 0;
+
+    while (retiredHandlers) {
+        EventHandlerList *next = retiredHandlers->retired;
+        free(retiredHandlers);
+        retiredHandlers = next;
+    }
+}
+
 /* ----------------- Picol Command Wrappers ----------------- */
 
 /**
@@ -498,4 +637,7 @@ void tinyaiRuntimeCleanup(picolInterp *interp) {
     
     /* Release all resources */
     tinyaiReleaseAllResources();
+
+    /* Let queued events finish, then drop events and handlers */
+    clearEvents();
 }
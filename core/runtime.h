@@ -130,25 +130,67 @@ void tinyaiClearError();
 
 /* ----------------- Event System ----------------- */
 
+/*
+ * Events are resolved to integer IDs when registered, so code that fires an
+ * event often looks it up once and triggers it by ID. Triggers take no lock:
+ * each event's handlers are an immutable list that registration replaces.
+ */
+
+/**
+ * Event handler
+ *
+ * @param data Data passed to the trigger
+ * @return 0 to continue, non-zero to stop calling lower priority handlers
+ */
+typedef int (*TinyAIEventHandler)(void *data);
+
 /**
  * Register an event
  * 
  * @param name Event name
- * @return Event ID or -1 on error
+ * @return Event ID (the existing one if already registered) or -1 on error
  */
 int tinyaiRegisterEvent(const char *name);
 
+/**
+ * Find a registered event
+ *
+ * @param name Event name
+ * @return Event ID or -1 if not registered
+ */
+int tinyaiFindEvent(const char *name);
+
 /**
  * Register an event handler
  * 
- * @param eventName Event name
+ * @param eventName Event name (registered if it doesn't exist)
  * @param priority Handler priority (higher = called first)
  * @param handler Handler function
  * @param userData User data to pass to the handler
  * @return 1 on success, 0 on failure
  */
 int tinyaiRegisterEventHandler(const char *eventName, int priority,
-                            int (*handler)(void *data), void *userData);
+                            TinyAIEventHandler handler, void *userData);
+
+/**
+ * Register an event handler by event ID
+ *
+ * @param eventId Event ID
+ * @param priority Handler priority (higher = called first)
+ * @param handler Handler function
+ * @param userData User data to pass to the handler
+ * @return 1 on success, 0 on failure
+ */
+int tinyaiRegisterEventHandlerId(int eventId, int priority,
+                                 TinyAIEventHandler handler, void *userData);
+
+/**
+ * Check whether an event has handlers, to skip preparing data nobody reads
+ *
+ * @param eventId Event ID
+ * @return 1 if the event has handlers, 0 otherwise
+ */
+int tinyaiEventHasHandlers(int eventId);
 
 /**
  * Trigger an event
@@ -159,6 +201,32 @@ int tinyaiRegisterEventHandler(const char *eventName, int priority,
  */
 int tinyaiTriggerEvent(const char *eventName, void *data);
 
+/**
+ * Trigger an event by ID, calling its handlers on this thread
+ *
+ * @param eventId Event ID
+ * @param data Data to pass to handlers
+ * @return 1 on success, 0 if the event doesn't exist
+ */
+int tinyaiTriggerEventId(int eventId, void *data);
+
+/**
+ * Trigger an event by ID, calling its handlers on the shared thread pool
+ *
+ * Handlers run on the calling thread when there is no pool. The data must
+ * stay valid until the handlers have run; tinyaiWaitForEvents waits for them.
+ *
+ * @param eventId Event ID
+ * @param data Data to pass to handlers
+ * @return 1 on success, 0 if the event doesn't exist
+ */
+int tinyaiTriggerEventAsync(int eventId, void *data);
+
+/**
+ * Wait until the handlers of every asynchronously triggered event have run
+ */
+void tinyaiWaitForEvents(void);
+
 /* ----------------- Initialization ----------------- */
 
 /**
@@ -5,6 +5,8 @@
 
 #include "kws.h"
 #include "../../../core/memory.h"
+#include "../../../utils/quantize.h"
+#include "../../../utils/simd_ops.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,19 +22,56 @@
 #define DEFAULT_SMOOTH_DETECTIONS true     /* Apply smoothing */
 #define DEFAULT_MIN_DETECTION_DURATION 50  /* Minimum 50 ms for a valid detection */
 #define DEFAULT_NOISE_ADAPTATION_RATE 0.1f /* Noise adaptation rate */
+#define DEFAULT_STREAMING_INFERENCE true   /* Cache per-frame activations */
+#define DEFAULT_USE_VAD_GATE true          /* Skip the model in silence */
+#define DEFAULT_VAD_THRESHOLD 4.0f         /* Speech is 4x the noise energy (6 dB) */
+#define DEFAULT_VAD_HANGOVER 200           /* Keep scoring 200 ms after speech */
+#define DEFAULT_QUANTIZE_KEYWORDS false    /* Score keywords with FP32 weights */
+
+/* Units of the model's per-frame layer */
+#define KWS_HIDDEN_SIZE 32
+
+/* Frames whose keywords tinyaiKWSProcessAudio scores together */
+#define KWS_SCORE_BATCH 16
 
 /* Keyword spotting model definition
  * This is a simplified model for demonstration purposes
- * In a real implementation, this would be a neural network model
+ * In a real implementation, the weights would be loaded from the model file
+ *
+ * The model is a time-delay network: a per-frame layer maps each frame's
+ * features to hidden units, a temporal filter sums each unit over the
+ * context frames, and an output layer scores the keywords. The per-frame
+ * layer sees one frame at a time, so its outputs can be kept and reused as
+ * the context window slides. The output layer rows of the keywords in use
+ * are packed into one scoring matrix with a column per keyword, so all
+ * keywords are scored by one vector-matrix product.
  */
 struct TinyAIKWSModel {
-    int     inputSize;   /* Size of input features */
-    int     numKeywords; /* Number of keywords supported */
-    char  **keywords;    /* Array of keyword strings */
-    float **weights;     /* Simulated weights (for demonstration) */
-    bool    initialized; /* Whether the model is initialized */
+    int               inputSize;        /* Features of one frame */
+    int               contextFrames;    /* Frames of context the model sees */
+    int               hiddenSize;       /* Units of the per-frame layer */
+    int               numKeywords;      /* Number of keywords supported */
+    char            **keywords;         /* Array of keyword strings */
+    float            *frameWeights;     /* Per-frame layer [hiddenSize x inputSize] */
+    float            *frameBias;        /* Per-frame layer bias [hiddenSize] */
+    float            *temporalWeights;  /* Temporal filter, newest frame first
+                                           [contextFrames x hiddenSize] */
+    float            *outputWeights;    /* Output layer [numKeywords x hiddenSize] */
+    int               packedKeywords;   /* Keywords in the scoring matrix */
+    float            *scoreWeights;     /* Scoring matrix [hiddenSize x packedKeywords] */
+    TinyAIMatrix4bit *scoreWeights4bit; /* Scoring matrix in 4 bits, NULL when FP32 */
+    bool              initialized;      /* Whether the model is initialized */
 };
 
+/* Frames whose keywords wait to be scored together */
+typedef struct {
+    float pooled[KWS_SCORE_BATCH * KWS_HIDDEN_SIZE]; /* Temporal filter outputs of scored frames */
+    float noiseLevel[KWS_SCORE_BATCH];               /* Noise level after each frame */
+    bool  active[KWS_SCORE_BATCH];                   /* Whether each frame is scored */
+    int   numFrames;                                 /* Frames queued */
+    int   numScored;                                 /* Queued frames to score */
+} KWSBatch;
+
 /**
  * Initialize the default keyword spotting configuration
  * @param config Configuration structure to initialize
@@ -52,6 +91,11 @@ void tinyaiKWSInitConfig(TinyAIKWSConfig *config)
     config->smoothDetections     = DEFAULT_SMOOTH_DETECTIONS;
     config->minDetectionDuration = DEFAULT_MIN_DETECTION_DURATION;
     config->noiseAdaptationRate  = DEFAULT_NOISE_ADAPTATION_RATE;
+    config->streamingInference   = DEFAULT_STREAMING_INFERENCE;
+    config->useVadGate           = DEFAULT_USE_VAD_GATE;
+    config->vadThreshold         = DEFAULT_VAD_THRESHOLD;
+    config->vadHangover          = DEFAULT_VAD_HANGOVER;
+    config->quantizeKeywords     = DEFAULT_QUANTIZE_KEYWORDS;
 }
 
 /**
@@ -73,63 +117,12 @@ static void initFeatureConfig(const TinyAIKWSConfig     *kwsConfig,
     featuresConfig->preEmphasis       = 0.97f; /* Standard value for speech */
 }
 
-/**
- * Create a simple keyword spotting model
- * @param numKeywords Number of keywords to support
- * @param inputSize Size of input features
- * @return New model, or NULL on failure
- */
-static TinyAIKWSModel *createModel(int numKeywords, int inputSize)
+/* Random weights in [-scale, scale] for the simulation */
+static void randomWeights(float *weights, int count, float scale)
 {
-    TinyAIKWSModel *model = (TinyAIKWSModel *)malloc(sizeof(TinyAIKWSModel));
-    if (!model) {
-        return NULL;
-    }
-
-    /* Initialize model */
-    model->inputSize   = inputSize;
-    model->numKeywords = numKeywords;
-    model->initialized = false;
-
-    /* Allocate keywords array */
-    model->keywords = (char **)malloc(numKeywords * sizeof(char *));
-    if (!model->keywords) {
-        free(model);
-        return NULL;
-    }
-
-    for (int i = 0; i < numKeywords; i++) {
-        model->keywords[i] = NULL;
-    }
-
-    /* Allocate weights "matrix" for simulation */
-    model->weights = (float **)malloc(numKeywords * sizeof(float *));
-    if (!model->weights) {
-        free(model->keywords);
-        free(model);
-        return NULL;
-    }
-
-    for (int i = 0; i < numKeywords; i++) {
-        model->weights[i] = (float *)malloc(inputSize * sizeof(float));
-        if (!model->weights[i]) {
-            for (int j = 0; j < i; j++) {
-                free(model->weights[j]);
-            }
-            free(model->weights);
-            free(model->keywords);
-            free(model);
-            return NULL;
-        }
-
-        /* Initialize with some random values for simulation */
-        for (int j = 0; j < inputSize; j++) {
-            model->weights[i][j] = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * 0.1f;
-        }
+    for (int i = 0; i < count; i++) {
+        weights[i] = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * scale;
     }
-
-    model->initialized = true;
-    return model;
 }
 
 /**
@@ -151,16 +144,57 @@ static void freeModel(TinyAIKWSModel *model)
         free(model->keywords);
     }
 
-    if (model->weights) {
-        for (int i = 0; i < model->numKeywords; i++) {
-            if (model->weights[i]) {
-                free(model->weights[i]);
-            }
-        }
-        free(model->weights);
+    free(model->frameWeights);
+    free(model->frameBias);
+    free(model->temporalWeights);
+    free(model->outputWeights);
+    free(model->scoreWeights);
+    tinyaiDestroyMatrix4bit(model->scoreWeights4bit);
+    free(model);
+}
+
+/**
+ * Create a simple keyword spotting model
+ * @param numKeywords Number of keywords to support
+ * @param inputSize Features of one frame
+ * @param contextFrames Frames of context the model sees
+ * @return New model, or NULL on failure
+ */
+static TinyAIKWSModel *createModel(int numKeywords, int inputSize, int contextFrames)
+{
+    TinyAIKWSModel *model = (TinyAIKWSModel *)calloc(1, sizeof(TinyAIKWSModel));
+    if (!model) {
+        return NULL;
     }
 
-    free(model);
+    /* Initialize model */
+    model->inputSize     = inputSize;
+    model->contextFrames = contextFrames;
+    model->hiddenSize    = KWS_HIDDEN_SIZE;
+    model->numKeywords   = numKeywords;
+    model->initialized   = false;
+
+    /* Allocate keywords and weights */
+    int hidden             = model->hiddenSize;
+    model->keywords        = (char **)calloc(numKeywords, sizeof(char *));
+    model->frameWeights    = (float *)malloc(hidden * inputSize * sizeof(float));
+    model->frameBias       = (float *)malloc(hidden * sizeof(float));
+    model->temporalWeights = (float *)malloc(contextFrames * hidden * sizeof(float));
+    model->outputWeights   = (float *)malloc(numKeywords * hidden * sizeof(float));
+    if (!model->keywords || !model->frameWeights || !model->frameBias ||
+        !model->temporalWeights || !model->outputWeights) {
+        freeModel(model);
+        return NULL;
+    }
+
+    /* Initialize with some random values for simulation */
+    randomWeights(model->frameWeights, hidden * inputSize, 0.1f);
+    randomWeights(model->frameBias, hidden, 0.1f);
+    randomWeights(model->temporalWeights, contextFrames * hidden, 1.0f / contextFrames);
+    randomWeights(model->outputWeights, numKeywords * hidden, 0.1f);
+
+    model->initialized = true;
+    return model;
 }
 
 /**
@@ -190,6 +224,44 @@ static bool addKeywordToModel(TinyAIKWSModel *model, const char *keyword, int ke
     return true;
 }
 
+/**
+ * Pack the output layer rows of the first keywords into the scoring matrix
+ * @param model Model to update
+ * @param numKeywords Keywords to pack
+ * @param quantize Whether to quantize the matrix to 4 bits
+ * @return true on success, false on failure
+ */
+static bool packKeywordScoring(TinyAIKWSModel *model, int numKeywords, bool quantize)
+{
+    int    hidden  = model->hiddenSize;
+    float *weights = (float *)malloc(hidden * numKeywords * sizeof(float));
+    if (!weights) {
+        return false;
+    }
+    for (int k = 0; k < numKeywords; k++) {
+        for (int h = 0; h < hidden; h++) {
+            weights[h * numKeywords + k] = model->outputWeights[k * hidden + h];
+        }
+    }
+
+    TinyAIMatrix4bit *quantized = NULL;
+    if (quantize) {
+        TinyAIMatrixFP32 matrix = {weights, (uint32_t)hidden, (uint32_t)numKeywords};
+        quantized               = tinyaiQuantizeFP32To4bit(&matrix);
+        if (!quantized) {
+            free(weights);
+            return false;
+        }
+    }
+
+    free(model->scoreWeights);
+    tinyaiDestroyMatrix4bit(model->scoreWeights4bit);
+    model->scoreWeights     = weights;
+    model->scoreWeights4bit = quantized;
+    model->packedKeywords   = numKeywords;
+    return true;
+}
+
 /**
  * Create a new keyword spotting state
  * @param config Configuration
@@ -222,9 +294,8 @@ TinyAIKWSState *tinyaiKWSCreate(const TinyAIKWSConfig *config, const char *model
         numMfccFeatures *= 3; /* MFCC + delta + delta-delta */
     }
     int contextFrames = 1 + 2 * state->config.numContextFrames; /* center frame + context */
-    int inputSize     = numMfccFeatures * contextFrames;
 
-    state->model = createModel(TINYAI_KWS_MAX_KEYWORDS, inputSize);
+    state->model = createModel(TINYAI_KWS_MAX_KEYWORDS, numMfccFeatures, contextFrames);
     if (!state->model) {
         free(state);
         return NULL;
@@ -241,10 +312,24 @@ TinyAIKWSState *tinyaiKWSCreate(const TinyAIKWSConfig *config, const char *model
     memset(state->featureBuffer, 0, state->featureBufferSize * sizeof(float));
     state->featureBufferIndex = 0;
 
+    /* Allocate the per-frame layer outputs of the context, computed on first use */
+    state->hiddenRing  = (float *)malloc(contextFrames * KWS_HIDDEN_SIZE * sizeof(float));
+    state->hiddenValid = (bool *)calloc(contextFrames, sizeof(bool));
+    if (!state->hiddenRing || !state->hiddenValid) {
+        free(state->hiddenRing);
+        free(state->hiddenValid);
+        free(state->featureBuffer);
+        freeModel(state->model);
+        free(state);
+        return NULL;
+    }
+
     /* Allocate detection state buffers */
     state->scoresSize = TINYAI_KWS_MAX_KEYWORDS;
     state->scores     = (float *)malloc(state->scoresSize * sizeof(float));
     if (!state->scores) {
+        free(state->hiddenValid);
+        free(state->hiddenRing);
         free(state->featureBuffer);
         freeModel(state->model);
         free(state);
@@ -255,6 +340,8 @@ TinyAIKWSState *tinyaiKWSCreate(const TinyAIKWSConfig *config, const char *model
     state->smoothedScores = (float *)malloc(state->scoresSize * sizeof(float));
     if (!state->smoothedScores) {
         free(state->scores);
+        free(state->hiddenValid);
+        free(state->hiddenRing);
         free(state->featureBuffer);
         freeModel(state->model);
         free(state);
@@ -266,6 +353,8 @@ TinyAIKWSState *tinyaiKWSCreate(const TinyAIKWSConfig *config, const char *model
     if (!state->activeDetections) {
         free(state->smoothedScores);
         free(state->scores);
+        free(state->hiddenValid);
+        free(state->hiddenRing);
         free(state->featureBuffer);
         freeModel(state->model);
         free(state);
@@ -281,6 +370,8 @@ TinyAIKWSState *tinyaiKWSCreate(const TinyAIKWSConfig *config, const char *model
         free(state->activeDetections);
         free(state->smoothedScores);
         free(state->scores);
+        free(state->hiddenValid);
+        free(state->hiddenRing);
         free(state->featureBuffer);
         freeModel(state->model);
         free(state);
@@ -314,6 +405,8 @@ void tinyaiKWSFree(TinyAIKWSState *state)
     if (state->featureBuffer) {
         free(state->featureBuffer);
     }
+    free(state->hiddenRing);
+    free(state->hiddenValid);
 
     /* Free features */
     if (state->features) {
@@ -356,6 +449,12 @@ bool tinyaiKWSReset(TinyAIKWSState *state)
         memset(state->featureBuffer, 0, state->featureBufferSize * sizeof(float));
     }
     state->featureBufferIndex = 0;
+    if (state->hiddenValid) {
+        memset(state->hiddenValid, 0, state->model->contextFrames * sizeof(bool));
+    }
+    state->hangoverCounter = 0;
+    state->framesScored    = 0;
+    state->framesGated     = 0;
 
     /* Reset detection state */
     if (state->scores) {
@@ -417,8 +516,9 @@ bool tinyaiKWSAddKeyword(TinyAIKWSState *state, const char *keyword, float thres
     kw->threshold  = actualThreshold;
     kw->modelIndex = index;
 
-    /* Add to model */
-    if (!addKeywordToModel(state->model, keyword, index)) {
+    /* Add to model and to the scoring matrix */
+    if (!addKeywordToModel(state->model, keyword, index) ||
+        !packKeywordScoring(state->model, index + 1, state->config.quantizeKeywords)) {
         return false;
     }
 
@@ -429,30 +529,107 @@ bool tinyaiKWSAddKeyword(TinyAIKWSState *state, const char *keyword, float thres
 }
 
 /**
- * Perform keyword detection on features
- * @param state Keyword spotting state
- * @param features Frame features
- * @param numFeatures Number of features
- * @return true on success, false on failure
+ * Run the per-frame layer on one frame's features
+ * @param model Model to run
+ * @param features Features of the frame [inputSize]
+ * @param hidden Output layer outputs [hiddenSize]
  */
-static bool detectKeywords(TinyAIKWSState *state, const float *features, int numFeatures)
+static void computeFrameHidden(const TinyAIKWSModel *model, const float *features, float *hidden)
 {
-    if (!state || !features || numFeatures <= 0) {
-        return false;
+    for (int h = 0; h < model->hiddenSize; h++) {
+        const float *weights = model->frameWeights + h * model->inputSize;
+        float sum = model->frameBias[h] + tinyaiSimdDot(weights, features, model->inputSize);
+        hidden[h] = sum > 0.0f ? sum : 0.0f; /* ReLU */
     }
+}
 
-    /* Run "model" (simulation) */
-    for (int i = 0; i < state->numKeywords; i++) {
-        float sum = 0.0f;
+/**
+ * Run the model up to the output layer on the context window ending at the newest frame
+ *
+ * Without streaming inference, the per-frame layer runs on every frame of
+ * the window. With it, each frame's outputs are computed once, when first
+ * needed, and kept in the ring until the frame leaves the window.
+ * @param state Keyword spotting state
+ * @param pooled Output temporal filter outputs [hiddenSize]
+ */
+static void poolContext(TinyAIKWSState *state, float *pooled)
+{
+    const TinyAIKWSModel *model   = state->model;
+    int                   context = model->contextFrames;
+    int                   hidden  = model->hiddenSize;
+    float                 frameHidden[KWS_HIDDEN_SIZE];
+
+    memset(pooled, 0, hidden * sizeof(float));
+
+    for (int age = 0; age < context; age++) {
+        int          slot     = (state->featureBufferIndex - 1 - age + context) % context;
+        const float *features = state->featureBuffer + slot * model->inputSize;
+        const float *outputs  = frameHidden;
+        if (state->config.streamingInference) {
+            float *cached = state->hiddenRing + slot * hidden;
+            if (!state->hiddenValid[slot]) {
+                computeFrameHidden(model, features, cached);
+                state->hiddenValid[slot] = true;
+            }
+            outputs = cached;
+        }
+        else {
+            computeFrameHidden(model, features, frameHidden);
+        }
 
-        /* Simple dot product with weights as a simulation */
-        for (int j = 0; j < numFeatures && j < state->model->inputSize; j++) {
-            sum += features[j] * state->model->weights[i][j];
+        /* Temporal filter */
+        const float *taps = model->temporalWeights + age * hidden;
+        for (int h = 0; h < hidden; h++) {
+            pooled[h] += taps[h] * outputs[h];
         }
+    }
+}
+
+/**
+ * Run the output layer of several frames against the scoring matrix
+ *
+ * Each row of the FP32 matrix is read once for all frames and added to
+ * every frame's scores; the 4-bit matrix goes through one batched product.
+ * @param state Keyword spotting state
+ * @param pooled Temporal filter outputs of the frames [count x hiddenSize]
+ * @param count Number of frames
+ * @param scores Output keyword scores [count x numKeywords]
+ */
+static void scoreKeywords(const TinyAIKWSState *state, const float *pooled, int count,
+                          float *scores)
+{
+    const TinyAIKWSModel *model    = state->model;
+    int                   hidden   = model->hiddenSize;
+    int                   keywords = state->numKeywords;
+    if (count <= 0 || keywords <= 0) {
+        return;
+    }
+
+    /* Output layer with sigmoid activation */
+    if (model->scoreWeights4bit) {
+        tinyaiMatrix4bitMatMulActivate(model->scoreWeights4bit, pooled, (uint32_t)count, NULL,
+                                       TINYAI_SIMD_ACTIVATION_SIGMOID, scores);
+        return;
+    }
 
-        /* Apply sigmoid activation */
-        state->scores[i] = 1.0f / (1.0f + expf(-sum));
+    memset(scores, 0, count * keywords * sizeof(float));
+    for (int h = 0; h < hidden; h++) {
+        const float *row = model->scoreWeights + h * keywords;
+        for (int f = 0; f < count; f++) {
+            tinyaiSimdVecScaleAdd(scores + f * keywords, row, pooled[f * hidden + h], keywords);
+        }
+    }
+    tinyaiSimdActivate(scores, count * keywords, TINYAI_SIMD_ACTIVATION_SIGMOID);
+}
 
+/**
+ * Perform keyword detection on the current scores
+ * @param state Keyword spotting state
+ * @param noiseLevel Noise level estimate when the frame was processed
+ */
+static void detectKeywords(TinyAIKWSState *state, float noiseLevel)
+{
+    for (int i = 0; i < state->numKeywords; i++) {
         /* Apply smoothing */
         if (state->config.smoothDetections) {
             state->smoothedScores[i] = state->smoothedScores[i] * 0.8f + state->scores[i] * 0.2f;
@@ -462,7 +639,7 @@ static bool detectKeywords(TinyAIKWSState *state, const float *features, int num
         }
 
         /* Check against threshold */
-        float threshold = state->keywords[i].threshold * (1.0f + state->noiseLevel);
+        float threshold = state->keywords[i].threshold * (1.0f + noiseLevel);
         bool  isActive  = state->smoothedScores[i] > threshold;
 
         /* Update active detections */
@@ -493,64 +670,177 @@ static bool detectKeywords(TinyAIKWSState *state, const float *features, int num
             state->activeDetections[i] = 0;
         }
     }
+}
 
-    return true;
+/**
+ * Update the noise level estimate with a frame's energy
+ * @param state Keyword spotting state
+ * @param frameEnergy Mean energy of the frame
+ */
+static void updateNoiseLevel(TinyAIKWSState *state, float frameEnergy)
+{
+    if (frameEnergy < state->noiseLevel) {
+        state->noiseLevel = state->noiseLevel * (1.0f - state->config.noiseAdaptationRate) +
+                            frameEnergy * state->config.noiseAdaptationRate;
+    }
 }
 
 /**
- * Process audio frame for keyword detection
+ * Add a frame's features to the context window
  * @param state Keyword spotting state
- * @param frame Audio frame (float samples)
- * @param frameSize Number of samples in frame
- * @return true on success, false on failure
+ * @param frameEnergy Mean energy of the frame
  */
-bool tinyaiKWSProcessFrame(TinyAIKWSState *state, const float *frame, int frameSize)
+static void pushFrameFeatures(TinyAIKWSState *state, float frameEnergy)
 {
-    if (!state || !frame || frameSize <= 0) {
-        return false;
+    /* Extract features (simplified, would use audio_features.h in real impl) */
+    int    numMfcc  = state->config.numMfccCoefficients;
+    int    slot     = state->featureBufferIndex;
+    float *features = state->featureBuffer + slot * state->model->inputSize;
+
+    /* Generate some fake features for the simulation */
+    for (int i = 0; i < numMfcc; i++) {
+        features[i] = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * sqrtf(frameEnergy);
+        if (state->config.useDeltas) {
+            features[i + numMfcc]     = features[i] * 0.5f; /* Fake delta */
+            features[i + 2 * numMfcc] = features[i] * 0.2f; /* Fake delta-delta */
+        }
     }
 
-    /* This function would typically:
-     * 1. Convert frame to MFCC features
-     * 2. Store in feature buffer
-     * 3. When enough context frames, perform detection
-     *
-     * This is a simplified implementation
-     */
+    /* The slot's per-frame layer outputs belonged to the frame it replaces */
+    state->hiddenValid[slot]  = false;
+    state->featureBufferIndex = (slot + 1) % state->model->contextFrames;
+}
 
-    /* Extract features (simplified, would use audio_features.h in real impl) */
-    float features[13] = {0}; /* Simplified MFCC features */
+/**
+ * Add a frame of known energy to a batch, running the model up to the output layer
+ * @param state Keyword spotting state
+ * @param batch Batch to add the frame to
+ * @param frameEnergy Mean energy of the frame
+ * @param voiceActive Whether to run the model
+ */
+static void queueFrame(TinyAIKWSState *state, KWSBatch *batch, float frameEnergy,
+                       bool voiceActive)
+{
+    updateNoiseLevel(state, frameEnergy);
+    pushFrameFeatures(state, frameEnergy);
 
-    /* Simple energy-based features for simulation */
-    float totalEnergy = 0.0f;
-    for (int i = 0; i < frameSize; i++) {
-        totalEnergy += frame[i] * frame[i];
+    if (voiceActive) {
+        poolContext(state, batch->pooled + batch->numScored++ * KWS_HIDDEN_SIZE);
     }
+    batch->noiseLevel[batch->numFrames] = state->noiseLevel;
+    batch->active[batch->numFrames++]   = voiceActive;
+}
 
-    /* Update noise level */
-    float frameEnergy = totalEnergy / frameSize;
-    if (frameEnergy < state->noiseLevel) {
-        state->noiseLevel = state->noiseLevel * (1.0f - state->config.noiseAdaptationRate) +
-                            frameEnergy * state->config.noiseAdaptationRate;
+/**
+ * Score the keywords of a batch's frames and run detection on them in order
+ * @param state Keyword spotting state
+ * @param batch Batch to empty
+ * @param scores Scratch scores [numScored x numKeywords], or state->scores for one frame
+ */
+static void flushFrames(TinyAIKWSState *state, KWSBatch *batch, float *scores)
+{
+    int          keywords = state->numKeywords;
+    const float *row      = scores;
+
+    scoreKeywords(state, batch->pooled, batch->numScored, scores);
+    for (int i = 0; i < batch->numFrames; i++) {
+        /* In silence the scores fall to zero without running the model */
+        if (batch->active[i]) {
+            if (row != state->scores) {
+                memcpy(state->scores, row, keywords * sizeof(float));
+            }
+            row += keywords;
+            state->framesScored++;
+        }
+        else {
+            memset(state->scores, 0, keywords * sizeof(float));
+            state->framesGated++;
+        }
+
+        detectKeywords(state, batch->noiseLevel[i]);
     }
+    batch->numFrames = 0;
+    batch->numScored = 0;
+}
 
-    /* Generate some fake features for the simulation */
-    for (int i = 0; i < 13; i++) {
-        features[i] = ((float)rand() / RAND_MAX * 2.0f - 1.0f) * sqrtf(frameEnergy);
+/**
+ * Process a frame of known energy
+ * @param state Keyword spotting state
+ * @param frameEnergy Mean energy of the frame
+ * @param voiceActive Whether to run the model
+ */
+static void processFrame(TinyAIKWSState *state, float frameEnergy, bool voiceActive)
+{
+    KWSBatch batch;
+    batch.numFrames = 0;
+    batch.numScored = 0;
+    queueFrame(state, &batch, frameEnergy, voiceActive);
+    flushFrames(state, &batch, state->scores);
+}
+
+/**
+ * Decide whether the model runs on a frame
+ *
+ * The energy gate compares against the noise level from before this frame,
+ * held open for the hangover so the ends of words are still scored.
+ * @param state Keyword spotting state
+ * @param frameEnergy Mean energy of the frame
+ * @return true to run the model, false to skip it
+ */
+static bool gateFrame(TinyAIKWSState *state, float frameEnergy)
+{
+    if (!state->config.useVadGate) {
+        return true;
+    }
+
+    if (frameEnergy > state->noiseLevel * state->config.vadThreshold) {
+        int shift              = state->config.frameShift > 0 ? state->config.frameShift : 1;
+        state->hangoverCounter = state->config.vadHangover / shift;
+    }
+    else if (state->hangoverCounter > 0) {
+        state->hangoverCounter--;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Process audio frame for keyword detection, with voice activity from the caller
+ * @param state Keyword spotting state
+ * @param frame Audio frame (float samples)
+ * @param frameSize Number of samples in frame
+ * @param voiceActive Whether the frame holds speech
+ * @return true on success, false on failure
+ */
+bool tinyaiKWSProcessFrameGated(TinyAIKWSState *state, const float *frame, int frameSize,
+                                bool voiceActive)
+{
+    if (!state || !frame || frameSize <= 0) {
+        return false;
     }
 
-    /* Would typically handle feature buffer with context here */
+    processFrame(state, tinyaiSimdDot(frame, frame, frameSize) / frameSize, voiceActive);
+    return true;
+}
 
-    /* Simulate feature vector for detection */
-    float featureVector[39]; /* 13 MFCC + delta + delta-delta */
-    for (int i = 0; i < 13; i++) {
-        featureVector[i]      = features[i];
-        featureVector[i + 13] = features[i] * 0.5f; /* Fake delta */
-        featureVector[i + 26] = features[i] * 0.2f; /* Fake delta-delta */
+/**
+ * Process audio frame for keyword detection
+ * @param state Keyword spotting state
+ * @param frame Audio frame (float samples)
+ * @param frameSize Number of samples in frame
+ * @return true on success, false on failure
+ */
+bool tinyaiKWSProcessFrame(TinyAIKWSState *state, const float *frame, int frameSize)
+{
+    if (!state || !frame || frameSize <= 0) {
+        return false;
     }
 
-    /* Run detection */
-    return detectKeywords(state, featureVector, 39);
+    float frameEnergy = tinyaiSimdDot(frame, frame, frameSize) / frameSize;
+    processFrame(state, frameEnergy, gateFrame(state, frameEnergy));
+    return true;
 }
 
 /**
@@ -582,11 +872,29 @@ bool tinyaiKWSProcessAudio(TinyAIKWSState *state, const TinyAIAudioData *audio,
         return false;
     }
 
+    /* Frames are processed as by tinyaiKWSProcessFrame, scoring a batch at a time */
+    int       keywords = state->numKeywords > 0 ? state->numKeywords : 1;
+    float    *scores   = (float *)malloc(KWS_SCORE_BATCH * keywords * sizeof(float));
+    KWSBatch *batch    = (KWSBatch *)malloc(sizeof(KWSBatch));
+    if (!scores || !batch) {
+        free(scores);
+        free(batch);
+        return false;
+    }
+    batch->numFrames = 0;
+    batch->numScored = 0;
+
     for (int i = 0; i + frameSizeSamples <= numSamples; i += frameShiftSamples) {
-        if (!tinyaiKWSProcessFrame(state, samples + i, frameSizeSamples)) {
-            return false;
+        const float *frame  = samples + i;
+        float        energy = tinyaiSimdDot(frame, frame, frameSizeSamples) / frameSizeSamples;
+        queueFrame(state, batch, energy, gateFrame(state, energy));
+        if (batch->numFrames == KWS_SCORE_BATCH) {
+            flushFrames(state, batch, scores);
         }
     }
+    flushFrames(state, batch, scores);
+    free(scores);
+    free(batch);
 
     /* Return detections */
     if (state->numDetections > 0) {
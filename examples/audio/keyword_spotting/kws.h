@@ -22,8 +22,11 @@ extern "C" {
 
 /**
  * Maximum number of supported keywords
+ *
+ * All keywords are scored together with one product against a packed
+ * matrix, so the cost of scoring grows slowly with their number.
  */
-#define TINYAI_KWS_MAX_KEYWORDS 10
+#define TINYAI_KWS_MAX_KEYWORDS 256
 
 /**
  * Maximum keyword length in characters
@@ -69,6 +72,11 @@ typedef struct {
     bool  smoothDetections;     /* Whether to apply smoothing to detections */
     int   minDetectionDuration; /* Minimum detection duration in milliseconds */
     float noiseAdaptationRate;  /* Noise adaptation rate (0.0-1.0) */
+    bool  streamingInference;   /* Whether to cache per-frame activations across frames */
+    bool  useVadGate;           /* Whether to skip the model while there is no speech */
+    float vadThreshold;         /* Frame energy over the noise level that counts as speech */
+    int   vadHangover;          /* Time the gate stays open after speech in milliseconds */
+    bool  quantizeKeywords;     /* Whether to score keywords with 4-bit weights */
 } TinyAIKWSConfig;
 
 /**
@@ -92,6 +100,13 @@ typedef struct {
     int                       featureBufferSize;  /* Size of feature buffer */
     int                       featureBufferIndex; /* Current index in feature buffer */
 
+    /* Streaming inference */
+    float *hiddenRing;      /* Per-frame layer outputs of the context frames */
+    bool  *hiddenValid;     /* Whether each frame's outputs are up to date */
+    int    hangoverCounter; /* Frames the VAD gate stays open */
+    int    framesScored;    /* Frames the model ran on */
+    int    framesGated;     /* Frames the VAD gate skipped */
+
     /* Detection state */
     float *scores;           /* Detection scores */
     int    scoresSize;       /* Size of scores buffer */
@@ -143,6 +158,13 @@ bool tinyaiKWSAddKeyword(TinyAIKWSState *state, const char *keyword, float thres
 
 /**
  * Process audio frame for keyword detection
+ *
+ * The model sees the features of the last 1 + 2 * numContextFrames frames.
+ * With streaming inference, the per-frame layer runs on the new frame only
+ * and the outputs of earlier frames come from a ring buffer, so a frame
+ * costs one frame of that layer rather than the whole context's. With the
+ * VAD gate, frames whose energy stays below vadThreshold times the noise
+ * level skip the model, as with tinyaiKWSProcessFrameGated.
  * @param state Keyword spotting state
  * @param frame Audio frame (float samples)
  * @param frameSize Number of samples in frame
@@ -150,8 +172,28 @@ bool tinyaiKWSAddKeyword(TinyAIKWSState *state, const char *keyword, float thres
  */
 bool tinyaiKWSProcessFrame(TinyAIKWSState *state, const float *frame, int frameSize);
 
+/**
+ * Process audio frame for keyword detection, with voice activity from the caller
+ *
+ * The frame's features always enter the context, but the model only runs
+ * while voiceActive is set; in silence the scores fall to zero, which ends
+ * open detections. Streaming inference catches up on the frames it skipped
+ * when voice returns, so gated scores equal ungated ones during speech.
+ * @param state Keyword spotting state
+ * @param frame Audio frame (float samples)
+ * @param frameSize Number of samples in frame
+ * @param voiceActive Whether the frame holds speech, e.g. from a VAD
+ * @return true on success, false on failure
+ */
+bool tinyaiKWSProcessFrameGated(TinyAIKWSState *state, const float *frame, int frameSize,
+                                bool voiceActive);
+
 /**
  * Process full audio buffer for keyword detection
+ *
+ * The frames are processed as by tinyaiKWSProcessFrame, but the keywords
+ * of several frames are scored with one matrix product, so the scoring
+ * weights are read once per batch rather than once per frame.
  * @param state Keyword spotting state
  * @param audio Audio data
  * @param detections Output array of detections (caller must free)
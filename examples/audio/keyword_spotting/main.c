@@ -280,6 +280,9 @@ int main(int argc, char **argv)
     printf("  MFCC coefficients: %d\n", config.numMfccCoefficients);
     printf("  Use deltas: %s\n", config.useDeltas ? "yes" : "no");
     printf("  Smoothing: %s\n", config.smoothDetections ? "yes" : "no");
+    printf("  Streaming inference: %s\n", config.streamingInference ? "yes" : "no");
+    printf("  VAD gate: %s\n", config.useVadGate ? "yes" : "no");
+    printf("  Keyword weights: %s\n", config.quantizeKeywords ? "4-bit" : "FP32");
     printf("\n");
 
     /* Create KWS state */
@@ -25,6 +25,9 @@
 /* Number of phonemes in the English language (including silence) */
 #define NUM_PHONEMES 44
 
+/* Index of SIL in englishPhonemes, which the decoder also uses as its blank */
+#define SILENCE_PHONEME 39
+
 /* Size of context window for acoustic model (frames before/after) */
 #define CONTEXT_FRAMES 5
 
@@ -33,6 +36,13 @@
 #define AM_HIDDEN_SIZE 64       /* Size of hidden representation */
 #define AM_MIN_CONFIDENCE 0.01f /* Minimum confidence for phoneme probability */
 
+/* Decoder parameters */
+#define MAX_WORD_PHONEMES 32         /* Longest pronunciation in phonemes */
+#define MIN_PHONEME_PROB 1.0e-10f    /* Floor of phoneme probabilities before the log */
+#define WORD_INSERTION_SCORE -1.0f   /* Log score of every word, against splitting long words */
+#define CUSTOM_WORD_BOOST 4.0f       /* Log score of a custom word of weight 1.0 */
+#define FRAME_SHIFT_SECONDS 0.01f    /* Hop between the frames of tinyaiASRProcessAudio */
+
 /**
  * Phoneme information structure
  */
@@ -58,17 +68,6 @@ typedef struct {
     float prob;     /* Bigram probability */
 } BigramInfo;
 
-/**
- * Hypothesis node for beam search
- */
-struct TinyAIASRHypothesis {
-    int                 *phonemeSequence; /* Sequence of phoneme indices */
-    int                  phonemeCount;    /* Number of phonemes in sequence */
-    float                score;           /* Score of this hypothesis */
-    bool                 isFinalized;     /* Whether this hypothesis is finalized */
-    TinyAIASRHypothesis *parent;          /* Parent hypothesis (for backtracking) */
-};
-
 /**
  * Acoustic model structure
  */
@@ -311,6 +310,215 @@ static void freeLanguageModel(TinyAIASRLanguageModel *model)
     free(model);
 }
 
+/**
+ * Check if a word is in the language model vocabulary
+ * @param model Language model
+ * @param word Word to check
+ * @return Index of word in vocabulary, or -1 if not found
+ */
+static int findWordInVocabulary(const TinyAIASRLanguageModel *model, const char *word)
+{
+    if (!model || !word || !model->vocabulary) {
+        return -1;
+    }
+
+    for (int i = 0; i < model->vocabSize; i++) {
+        if (strcasecmp(model->vocabulary[i].word, word) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Get the probability of a word given the word before it
+ * @param model Language model
+ * @param prevIdx Vocabulary index of the previous word, -1 for none or out of vocabulary
+ * @param idx Vocabulary index of the word, -1 if out of vocabulary
+ * @return Bigram probability, backed off to the unigram probability
+ */
+static float getWordProbability(const TinyAIASRLanguageModel *model, int prevIdx, int idx)
+{
+    if (!model || model->type == TINYAI_ASR_LM_NONE) {
+        return 1.0f; /* No language model, return neutral prob */
+    }
+
+    if (idx < 0) {
+        return 1.0f - model->oovPenalty; /* Out of vocabulary penalty */
+    }
+
+    if (model->type == TINYAI_ASR_LM_UNIGRAM || prevIdx < 0) {
+        return model->vocabulary[idx].unigram;
+    }
+
+    /* Search for bigram in model */
+    for (int i = 0; i < model->numBigrams; i++) {
+        if (model->bigrams[i].word1Idx == prevIdx && model->bigrams[i].word2Idx == idx) {
+            return model->bigrams[i].prob;
+        }
+    }
+
+    /* Bigram not found, back off to unigram */
+    return model->vocabulary[idx].unigram * 0.4f; /* Back-off weight */
+}
+
+/* Letter-to-sound rules: letter pairs with their own phoneme, then single letters */
+static const struct {
+    char        letters[3];
+    const char *phoneme;
+} letterPairPhonemes[] = {{"th", "TH"}, {"sh", "SH"}, {"ch", "CH"}, {"ng", "NG"}, {"ph", "F"},
+                          {"ee", "IY"}, {"ea", "IY"}, {"oo", "UW"}, {"ou", "AW"}, {"ow", "OW"},
+                          {"ay", "EY"}, {"ai", "EY"}, {"oy", "OY"}, {"wh", "W"},  {"ck", "K"}};
+
+static const char *letterPhonemes[26] = {"AE", "B", "K", "D",  "EH", "F", "G", "HH", "IH",
+                                         "JH", "K", "L", "M",  "N",  "AA", "P", "K", "R",
+                                         "S",  "T", "AH", "V", "W",  "K",  "Y", "Z"};
+
+/**
+ * Find a phoneme by its symbol
+ * @param symbol Phoneme symbol
+ * @return Index of the phoneme, or -1 if not found
+ */
+static int findPhoneme(const char *symbol)
+{
+    for (int i = 0; i < NUM_PHONEMES; i++) {
+        if (strcmp(englishPhonemes[i].symbol, symbol) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Spell a word out as phonemes by letter-to-sound rules
+ *
+ * Characters other than letters are skipped, and a phoneme repeated by
+ * double letters is spoken once.
+ * @param word Word to spell
+ * @param phonemes Output phoneme indices
+ * @param maxPhonemes Capacity of phonemes
+ * @return Number of phonemes, 0 if the word has no letters or is too long
+ */
+static int spellWord(const char *word, int *phonemes, int maxPhonemes)
+{
+    int count = 0;
+
+    for (const char *p = word; *p;) {
+        char c = (char)tolower((unsigned char)*p);
+        if (c < 'a' || c > 'z') {
+            p++;
+            continue;
+        }
+
+        const char *symbol = letterPhonemes[c - 'a'];
+        int         length = 1;
+        for (size_t i = 0; i < sizeof(letterPairPhonemes) / sizeof(letterPairPhonemes[0]); i++) {
+            if (c == letterPairPhonemes[i].letters[0] &&
+                tolower((unsigned char)p[1]) == letterPairPhonemes[i].letters[1]) {
+                symbol = letterPairPhonemes[i].phoneme;
+                length = 2;
+                break;
+            }
+        }
+        p += length;
+
+        int phoneme = findPhoneme(symbol);
+        if (count > 0 && phonemes[count - 1] == phoneme) {
+            continue;
+        }
+        if (count == maxPhonemes) {
+            return 0;
+        }
+        phonemes[count++] = phoneme;
+    }
+
+    return count;
+}
+
+/**
+ * Add a word to the decoder's lexicon
+ * @param state ASR state
+ * @param word Word to add
+ * @param score Log score added when the word is recognized
+ * @return true on success or if the word has no pronunciation, false on failure
+ */
+static bool addLexiconWord(TinyAIASRState *state, const char *word, float score)
+{
+    int  phonemes[MAX_WORD_PHONEMES];
+    char text[TINYAI_ASR_MAX_TOKEN_LENGTH];
+
+    int numPhonemes = spellWord(word, phonemes, MAX_WORD_PHONEMES);
+    if (numPhonemes == 0) {
+        return true;
+    }
+
+    /* Words are recognized in lower case */
+    size_t length = 0;
+    for (; word[length] && length < sizeof(text) - 1; length++) {
+        text[length] = (char)tolower((unsigned char)word[length]);
+    }
+    text[length] = '\0';
+
+    int tag = findWordInVocabulary(state->languageModel, text);
+    return tinyaiASRLexiconAddWord(state->lexicon, text, phonemes, numPhonemes, score, tag) >= 0;
+}
+
+/**
+ * Score a word recognized after another with the language model
+ * @param context ASR state
+ * @param prevWord Lexicon index of the previous word, -1 at the start
+ * @param word Lexicon index of the word
+ * @return Weighted log probability of the word
+ */
+static float scoreWordWithLM(void *context, int prevWord, int word)
+{
+    TinyAIASRState *state = (TinyAIASRState *)context;
+    if (!state->languageModel || state->languageModel->type == TINYAI_ASR_LM_NONE) {
+        return 0.0f;
+    }
+
+    int   prevIdx = prevWord >= 0 ? tinyaiASRLexiconGetTag(state->lexicon, prevWord) : -1;
+    int   idx     = tinyaiASRLexiconGetTag(state->lexicon, word);
+    float prob    = getWordProbability(state->languageModel, prevIdx, idx);
+    return state->config.lmWeight * logf(prob);
+}
+
+/**
+ * Initialize the decoder configuration based on ASR config
+ * @param asrConfig ASR configuration
+ * @param decoderConfig Output decoder configuration
+ */
+static void initDecoderConfig(const TinyAIASRConfig *asrConfig,
+                              TinyAIASRDecoderConfig *decoderConfig)
+{
+    int beamWidth = asrConfig->beamWidth;
+    if (beamWidth < 1) {
+        beamWidth = 1;
+    }
+    else if (beamWidth > TINYAI_ASR_MAX_BEAM_WIDTH) {
+        beamWidth = TINYAI_ASR_MAX_BEAM_WIDTH;
+    }
+
+    /* Faster modes prune harder, both hypotheses and the labels they extend into */
+    if (asrConfig->mode == TINYAI_ASR_MODE_FAST) {
+        decoderConfig->beamThreshold  = 8.0f;
+        decoderConfig->labelThreshold = 5.0f;
+    }
+    else if (asrConfig->mode == TINYAI_ASR_MODE_ACCURATE) {
+        decoderConfig->beamThreshold  = 16.0f;
+        decoderConfig->labelThreshold = 10.0f;
+    }
+    else { /* Balanced mode */
+        decoderConfig->beamThreshold  = 12.0f;
+        decoderConfig->labelThreshold = 7.0f;
+    }
+
+    decoderConfig->beamWidth     = beamWidth;
+    decoderConfig->blankLabel    = SILENCE_PHONEME;
+    decoderConfig->wordInsertion = WORD_INSERTION_SCORE;
+}
+
 /**
  * Initialize feature extraction configuration based on ASR config
  * @param asrConfig ASR configuration
@@ -430,39 +638,47 @@ TinyAIASRState *tinyaiASRCreate(const TinyAIASRConfig *config, const char *acous
     }
     memset(state->phonemeProbs, 0, state->numPhonemes * sizeof(float));
 
-    /* Set up beam search */
-    state->maxHypotheses = state->config.beamWidth;
-    state->hypotheses =
-        (TinyAIASRHypothesis *)malloc(state->maxHypotheses * sizeof(TinyAIASRHypothesis));
-    if (!state->hypotheses) {
-        free(state->phonemeProbs);
-        free(state->features);
-        freeLanguageModel(state->languageModel);
-        freeAcousticModel(state->acousticModel);
-        free(state);
+    /* Build the lexicon from the common words and the configured custom vocabulary */
+    state->lexicon = tinyaiASRLexiconCreate(state->numPhonemes);
+    if (!state->lexicon) {
+        tinyaiASRFree(state);
         return NULL;
     }
 
-    /* Initialize hypotheses */
-    for (int i = 0; i < state->maxHypotheses; i++) {
-        state->hypotheses[i].phonemeSequence =
-            (int *)malloc(1000 * sizeof(int)); /* Arbitrary limit */
-        if (!state->hypotheses[i].phonemeSequence) {
-            for (int j = 0; j < i; j++) {
-                free(state->hypotheses[j].phonemeSequence);
-            }
-            free(state->hypotheses);
-            free(state->phonemeProbs);
-            free(state->features);
-            freeLanguageModel(state->languageModel);
-            freeAcousticModel(state->acousticModel);
-            free(state);
+    for (size_t i = 0; i < NUM_COMMON_WORDS; i++) {
+        if (!addLexiconWord(state, commonWords[i], 0.0f)) {
+            tinyaiASRFree(state);
             return NULL;
         }
-        state->hypotheses[i].phonemeCount = 0;
-        state->hypotheses[i].score        = 0.0f;
-        state->hypotheses[i].isFinalized  = false;
-        state->hypotheses[i].parent       = NULL;
+    }
+
+    if (state->config.customVocabulary) {
+        char *words = (char *)malloc(strlen(state->config.customVocabulary) + 1);
+        if (!words) {
+            tinyaiASRFree(state);
+            return NULL;
+        }
+        strcpy(words, state->config.customVocabulary);
+
+        bool added = true;
+        for (char *word = strtok(words, ","); word && added; word = strtok(NULL, ",")) {
+            added = addLexiconWord(state, word, CUSTOM_WORD_BOOST);
+        }
+        free(words);
+
+        if (!added) {
+            tinyaiASRFree(state);
+            return NULL;
+        }
+    }
+
+    /* Set up beam search */
+    TinyAIASRDecoderConfig decoderConfig;
+    initDecoderConfig(&state->config, &decoderConfig);
+    state->decoder = tinyaiASRDecoderCreate(state->lexicon, &decoderConfig, scoreWordWithLM, state);
+    if (!state->decoder) {
+        tinyaiASRFree(state);
+        return NULL;
     }
 
     /* Initialize recognition fields */
@@ -479,27 +695,6 @@ TinyAIASRState *tinyaiASRCreate(const TinyAIASRConfig *config, const char *acous
     return state;
 }
 
-/**
- * Free an ASR hypothesis
- * @param hypothesis Hypothesis to free
- */
-static void freeHypothesis(TinyAIASRHypothesis *hypothesis)
-{
-    if (!hypothesis) {
-        return;
-    }
-
-    if (hypothesis->phonemeSequence) {
-        free(hypothesis->phonemeSequence);
-        hypothesis->phonemeSequence = NULL;
-    }
-
-    hypothesis->phonemeCount = 0;
-    hypothesis->score        = 0.0f;
-    hypothesis->isFinalized  = false;
-    hypothesis->parent       = NULL;
-}
-
 /**
  * Free ASR state
  * @param state ASR state to free
@@ -529,13 +724,9 @@ void tinyaiASRFree(TinyAIASRState *state)
         free(state->phonemeProbs);
     }
 
-    /* Free hypotheses */
-    if (state->hypotheses) {
-        for (int i = 0; i < state->maxHypotheses; i++) {
-            freeHypothesis(&state->hypotheses[i]);
-        }
-        free(state->hypotheses);
-    }
+    /* Free decoder */
+    tinyaiASRDecoderFree(state->decoder);
+    tinyaiASRLexiconFree(state->lexicon);
 
     /* Free VAD state if used */
     if (state->vadState) {
@@ -570,12 +761,7 @@ bool tinyaiASRReset(TinyAIASRState *state)
     }
 
     /* Reset hypotheses */
-    for (int i = 0; i < state->maxHypotheses; i++) {
-        state->hypotheses[i].phonemeCount = 0;
-        state->hypotheses[i].score        = 0.0f;
-        state->hypotheses[i].isFinalized  = false;
-        state->hypotheses[i].parent       = NULL;
-    }
+    tinyaiASRDecoderReset(state->decoder);
 
     /* Reset result */
     state->currentResult.numTokens     = 0;
@@ -636,185 +822,69 @@ static bool simulateAcousticModel(TinyAIASRState *state, const float *features,
 }
 
 /**
- * Find most likely phoneme from probabilities
- * @param probs Phoneme probabilities
- * @param numPhonemes Number of phonemes
- * @return Index of most likely phoneme
- */
-static int getMostLikelyPhoneme(const float *probs, int numPhonemes)
-{
-    int   bestIdx  = 0;
-    float bestProb = probs[0];
-
-    for (int i = 1; i < numPhonemes; i++) {
-        if (probs[i] > bestProb) {
-            bestProb = probs[i];
-            bestIdx  = i;
-        }
-    }
-
-    return bestIdx;
-}
-
-/**
- * Check if a word is in the language model vocabulary
- * @param model Language model
- * @param word Word to check
- * @return Index of word in vocabulary, or -1 if not found
- */
-static int findWordInVocabulary(const TinyAIASRLanguageModel *model, const char *word)
-{
-    if (!model || !word || !model->vocabulary) {
-        return -1;
-    }
-
-    for (int i = 0; i < model->vocabSize; i++) {
-        if (strcasecmp(model->vocabulary[i].word, word) == 0) {
-            return i;
-        }
-    }
-
-    return -1;
-}
-
-/**
- * Get unigram probability of a word
- * @param model Language model
- * @param word Word to look up
- * @return Unigram probability of word
- */
-static float getUnigramProbability(const TinyAIASRLanguageModel *model, const char *word)
-{
-    if (!model || !word || model->type == TINYAI_ASR_LM_NONE) {
-        return 1.0f; /* No language model, return neutral prob */
-    }
-
-    int idx = findWordInVocabulary(model, word);
-    if (idx < 0) {
-        return 1.0f - model->oovPenalty; /* Out of vocabulary penalty */
-    }
-
-    return model->vocabulary[idx].unigram;
-}
-
-/**
- * Get bigram probability of word pair
- * @param model Language model
- * @param word1 First word
- * @param word2 Second word
- * @return Bigram probability
+ * Advance the decoder by one frame of phoneme probabilities
+ * @param state ASR state
+ * @param phonemeProbs Phoneme probabilities of the frame (may be state->phonemeProbs)
+ * @return true on success, false on failure
  */
-static float getBigramProbability(const TinyAIASRLanguageModel *model, const char *word1,
-                                  const char *word2)
+static bool decodeFrame(TinyAIASRState *state, const float *phonemeProbs)
 {
-    if (!model || !word1 || !word2 || model->type == TINYAI_ASR_LM_NONE ||
-        model->type == TINYAI_ASR_LM_UNIGRAM) {
-        return 1.0f; /* No bigram model, return neutral prob */
-    }
-
-    int idx1 = findWordInVocabulary(model, word1);
-    int idx2 = findWordInVocabulary(model, word2);
-
-    if (idx1 < 0 || idx2 < 0) {
-        return 1.0f - model->oovPenalty; /* Out of vocabulary penalty */
+    for (int i = 0; i < state->numPhonemes; i++) {
+        float prob             = phonemeProbs[i];
+        state->phonemeProbs[i] = logf(prob > MIN_PHONEME_PROB ? prob : MIN_PHONEME_PROB);
     }
 
-    /* Search for bigram in model */
-    for (int i = 0; i < model->numBigrams; i++) {
-        if (model->bigrams[i].word1Idx == idx1 && model->bigrams[i].word2Idx == idx2) {
-            return model->bigrams[i].prob;
-        }
-    }
-
-    /* Bigram not found, back off to unigram */
-    return model->vocabulary[idx2].unigram * 0.4f; /* Back-off weight */
+    return tinyaiASRDecoderStep(state->decoder, state->phonemeProbs);
 }
 
 /**
- * Map a sequence of phonemes to a word
+ * Fill the current result with the words of the decoder's best hypothesis
  * @param state ASR state
- * @param phonemes Array of phoneme indices
- * @param numPhonemes Number of phonemes
- * @param word Output word buffer
- * @param maxWordLen Maximum word length
+ * @param final Whether the utterance has ended
  * @return true on success, false on failure
  */
-static bool phonemesToWord(TinyAIASRState *state, const int *phonemes, int numPhonemes, char *word,
-                           int maxWordLen)
+static bool updateResult(TinyAIASRState *state, bool final)
 {
-    if (!state || !phonemes || !word || numPhonemes <= 0 || maxWordLen <= 0) {
+    int   words[TINYAI_ASR_MAX_TOKENS];
+    int   startFrames[TINYAI_ASR_MAX_TOKENS];
+    int   endFrames[TINYAI_ASR_MAX_TOKENS];
+    float confidence = 0.0f;
+
+    int numWords = tinyaiASRDecoderGetBest(state->decoder, final, words, startFrames, endFrames,
+                                           TINYAI_ASR_MAX_TOKENS, &confidence);
+    if (numWords < 0) {
         return false;
     }
 
-    /* This is a simplified, non-realistic implementation */
-    /* In a real system, this would use a pronunciation dictionary or weighted FST */
+    TinyAIASRResult *result = &state->currentResult;
+    result->numTokens       = 0;
+    result->transcript[0]   = '\0';
+    result->confidence      = confidence;
 
-    /* Just convert each phoneme to its example word */
-    /* For demonstration purposes only */
+    size_t length = 0;
+    for (int i = 0; i < numWords; i++) {
+        const char     *text  = tinyaiASRLexiconGetWord(state->lexicon, words[i]);
+        TinyAIASRToken *token = &result->tokens[result->numTokens++];
 
-    if (numPhonemes == 1) {
-        /* Single phoneme case */
-        int idx = phonemes[0];
-        if (idx >= 0 && idx < state->acousticModel->numPhonemes) {
-            PhonemeInfo *info = &state->acousticModel->phonemeInfo[idx];
-            if (strlen(info->example) < (size_t)maxWordLen) {
-                strcpy(word, info->example);
-                return true;
-            }
-        }
-    }
-    else {
-        /* Try to construct something plausible from multiple phonemes */
-        char temp[TINYAI_ASR_MAX_TOKEN_LENGTH] = {0};
-        int  len                               = 0;
-
-        /* Take the example word from the first non-silence phoneme */
-        for (int i = 0; i < numPhonemes && len == 0; i++) {
-            int idx = phonemes[i];
-            if (idx >= 0 && idx < state->acousticModel->numPhonemes) {
-                PhonemeInfo *info = &state->acousticModel->phonemeInfo[idx];
-                if (strcmp(info->symbol, "SIL") != 0) {
-                    strcpy(temp, info->example);
-                    len = strlen(temp);
-                }
-            }
-        }
-
-        /* Add some randomness to make it look like different words */
-        if (len > 0) {
-            if (rand() % 3 == 0) {
-                /* Add suffix */
-                const char *suffixes[] = {"ing", "ed", "s", "er", "est", "ly"};
-                const char *suffix     = suffixes[rand() % 6];
-                if (len + strlen(suffix) < TINYAI_ASR_MAX_TOKEN_LENGTH) {
-                    strcat(temp, suffix);
-                }
-            }
-            else if (rand() % 3 == 0 && len > 3) {
-                /* Truncate */
-                temp[len - (1 + rand() % 2)] = '\0';
-            }
+        strncpy(token->text, text, TINYAI_ASR_MAX_TOKEN_LENGTH - 1);
+        token->text[TINYAI_ASR_MAX_TOKEN_LENGTH - 1] = '\0';
+        token->type                                  = TINYAI_ASR_TOKEN_WORD;
+        token->confidence                            = confidence;
+        token->startTime                             = startFrames[i] * FRAME_SHIFT_SECONDS;
+        token->endTime                               = endFrames[i] * FRAME_SHIFT_SECONDS;
 
-            /* Copy to output if it fits */
-            if (strlen(temp) < (size_t)maxWordLen) {
-                strcpy(word, temp);
-                return true;
-            }
+        /* Join the words with spaces, as many as fit */
+        size_t textLength = strlen(token->text);
+        if (length + textLength + 2 > TINYAI_ASR_MAX_TRANSCRIPT_LENGTH) {
+            continue;
         }
-    }
-
-    /* Fallback - just use the first phoneme's example word */
-    int idx = phonemes[0];
-    if (idx >= 0 && idx < state->acousticModel->numPhonemes) {
-        PhonemeInfo *info = &state->acousticModel->phonemeInfo[idx];
-        if (strlen(info->example) < (size_t)maxWordLen) {
-            strcpy(word, info->example);
-            return true;
+        if (length > 0) {
+            result->transcript[length++] = ' ';
         }
+        memcpy(result->transcript + length, token->text, textLength + 1);
+        length += textLength;
     }
 
-    /* Last resort - use a generic word */
-    strcpy(word, "unknown");
     return true;
 }
 
@@ -850,8 +920,10 @@ bool tinyaiASREndRecognition(TinyAIASRState *state)
         return false;
     }
 
-    /* Finalize any in-progress recognition */
-    /* In a real implementation, this would process any remaining audio and finalize the result */
+    /* Finalize the best hypothesis */
+    if (!updateResult(state, true)) {
+        return false;
+    }
 
     /* Mark result as ready */
     state->resultReady = true;
@@ -887,9 +959,12 @@ bool tinyaiASRProcessFrame(TinyAIASRState *state, const float *frame, int frameS
         hasVoice = energy > 0.001f;
     }
 
-    /* Skip processing if no voice is detected */
+    /* Skip the acoustic model if no voice is detected, decoding the frame as silence */
     if (!hasVoice) {
-        return true;
+        for (int i = 0; i < state->numPhonemes; i++) {
+            state->phonemeProbs[i] = i == SILENCE_PHONEME ? 1.0f : 0.0f;
+        }
+        return decodeFrame(state, state->phonemeProbs);
     }
 
     /* Extract features (simplified) */
@@ -904,53 +979,26 @@ bool tinyaiASRProcessFrame(TinyAIASRState *state, const float *frame, int frameS
     /* Run acoustic model */
     simulateAcousticModel(state, features, state->phonemeProbs);
 
-    /* Get most likely phoneme */
-    int phoneme = getMostLikelyPhoneme(state->phonemeProbs, state->numPhonemes);
+    return decodeFrame(state, state->phonemeProbs);
+}
 
-    /* In a real implementation, this would update the beam search hypotheses */
-    /* For simplicity, we'll just accumulate phonemes in the first hypothesis */
-    TinyAIASRHypothesis *hyp = &state->hypotheses[0];
-    if (hyp->phonemeCount < 1000) { /* Check arbitrary limit */
-        hyp->phonemeSequence[hyp->phonemeCount++] = phoneme;
+/**
+ * Decode phoneme probabilities from an external acoustic model
+ * @param state ASR state
+ * @param phonemeProbs Phoneme probabilities [numFrames x number of phonemes]
+ * @param numFrames Number of frames
+ * @return true on success, false on failure
+ */
+bool tinyaiASRProcessPhonemeProbs(TinyAIASRState *state, const float *phonemeProbs,
+                                  int numFrames)
+{
+    if (!state || !phonemeProbs || numFrames < 0) {
+        return false;
     }
 
-    /* Every 10 frames, update the result */
-    if (hyp->phonemeCount % 10 == 0) {
-        /* Map phonemes to words */
-        char word[TINYAI_ASR_MAX_TOKEN_LENGTH];
-
-        if (phonemesToWord(state, hyp->phonemeSequence, hyp->phonemeCount, word,
-                           TINYAI_ASR_MAX_TOKEN_LENGTH)) {
-            /* Add to transcript if not already there */
-            if (strlen(state->currentResult.transcript) == 0) {
-                strcpy(state->currentResult.transcript, word);
-            }
-            else {
-                /* Check if different from the last word */
-                char lastWord[TINYAI_ASR_MAX_TOKEN_LENGTH];
-                int  currentLength = strlen(state->currentResult.transcript);
-
-                /* Get last word */
-                int i = currentLength - 1;
-                while (i >= 0 && !isspace(state->currentResult.transcript[i])) {
-                    i--;
-                }
-
-                /* Copy last word */
-                strcpy(lastWord, state->currentResult.transcript + i + 1);
-
-                /* Add new word if different */
-                if (strcmp(lastWord, word) != 0) {
-                    /* Add space if needed */
-                    if (currentLength > 0 &&
-                        state->currentResult.transcript[currentLength - 1] != ' ') {
-                        strcat(state->currentResult.transcript, " ");
-                    }
-
-                    /* Add word */
-                    strcat(state->currentResult.transcript, word);
-                }
-            }
+    for (int t = 0; t < numFrames; t++) {
+        if (!decodeFrame(state, phonemeProbs + (size_t)t * state->numPhonemes)) {
+            return false;
         }
     }
 
@@ -1032,6 +1080,11 @@ bool tinyaiASRGetPartialResult(TinyAIASRState *state, TinyAIASRResult *result)
         return false;
     }
 
+    /* Read the completed words of the best hypothesis so far */
+    if (!state->resultReady && !updateResult(state, false)) {
+        return false;
+    }
+
     /* Copy result */
     *result = state->currentResult;
 
@@ -1073,9 +1126,13 @@ bool tinyaiASRAddCustomVocabulary(TinyAIASRState *state, const char **vocabulary
         return false;
     }
 
-    /* In a real implementation, this would update the language model with the custom vocabulary */
+    /* Favor the words in the lexicon; hypotheses reach new words from the next frame */
+    for (int i = 0; i < numWords; i++) {
+        if (vocabulary[i] && !addLexiconWord(state, vocabulary[i], weight * CUSTOM_WORD_BOOST)) {
+            return false;
+        }
+    }
 
-    /* Simulate success */
     return true;
 }
 
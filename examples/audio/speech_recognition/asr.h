@@ -13,6 +13,7 @@
 #include "../../../models/audio/audio_features.h"
 #include "../../../models/audio/audio_model.h"
 #include "../../../models/audio/audio_utils.h"
+#include "asr_decoder.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -106,11 +107,6 @@ typedef struct {
     char                      *customVocabulary; /* Additional vocabulary (comma-separated) */
 } TinyAIASRConfig;
 
-/**
- * Decoder hypothesis
- */
-typedef struct TinyAIASRHypothesis TinyAIASRHypothesis;
-
 /**
  * Acoustic model
  */
@@ -136,10 +132,10 @@ typedef struct {
     int                       featureIndex;   /* Current index in features buffer */
 
     /* Recognition state */
-    TinyAIASRHypothesis *hypotheses;    /* Beam search hypotheses */
-    int                  maxHypotheses; /* Maximum number of hypotheses */
-    float               *phonemeProbs;  /* Phoneme probabilities buffer */
-    int                  numPhonemes;   /* Number of phonemes */
+    TinyAIASRLexicon *lexicon;      /* Pronunciations of the vocabulary */
+    TinyAIASRDecoder *decoder;      /* Beam search over the lexicon */
+    float            *phonemeProbs; /* Phoneme probabilities buffer */
+    int               numPhonemes;  /* Number of phonemes */
 
     /* Results */
     TinyAIASRResult currentResult; /* Current recognition result */
@@ -204,6 +200,20 @@ bool tinyaiASREndRecognition(TinyAIASRState *state);
  */
 bool tinyaiASRProcessFrame(TinyAIASRState *state, const float *frame, int frameSize);
 
+/**
+ * Decode phoneme probabilities from an external acoustic model
+ *
+ * Each frame holds a probability for each of the recognizer's phonemes: the
+ * ARPAbet phonemes AA to ZH in alphabetical order, then SIL, then padding.
+ * Silence doubles as the separator of repeated phonemes.
+ * @param state ASR state
+ * @param phonemeProbs Phoneme probabilities [numFrames x number of phonemes]
+ * @param numFrames Number of frames
+ * @return true on success, false on failure
+ */
+bool tinyaiASRProcessPhonemeProbs(TinyAIASRState *state, const float *phonemeProbs,
+                                  int numFrames);
+
 /**
  * Process complete audio for speech recognition
  * @param state ASR state
@@ -241,6 +251,9 @@ bool tinyaiASRCalibrateAcousticModel(TinyAIASRState        *state,
 
 /**
  * Add custom vocabulary words to improve recognition
+ *
+ * The words join the decoder's lexicon, spelled out by letter-to-sound
+ * rules, and are favored in proportion to weight.
  * @param state ASR state
  * @param vocabulary Array of vocabulary words
  * @param numWords Number of words
@@ -0,0 +1,824 @@
+/**
+ * @file asr_decoder.c
+ * @brief Lexicon-constrained prefix beam search for the TinyAI speech recognizer
+ */
+
+#include "asr_decoder.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Node of the lexicon trie every pronunciation starts from */
+#define LEXICON_ROOT 0
+
+/* Log probability of an impossible path */
+#define LOG_ZERO (-1.0e30f)
+
+/* Initial number of slots in the word history table (a power of two) */
+#define HISTORY_TABLE_INITIAL_SIZE 1024
+
+/**
+ * Node of the lexicon trie
+ */
+typedef struct {
+    int label;       /* Label of the arc into the node, -1 at the root */
+    int firstChild;  /* First node one label deeper, -1 for none */
+    int nextSibling; /* Next node with the same parent, -1 for none */
+    int word;        /* Word pronounced by the path to the node, -1 for none */
+} LexiconNode;
+
+/**
+ * Word of the lexicon
+ */
+typedef struct {
+    char *text;  /* Text of the word */
+    float score; /* Log score added when the word is recognized */
+    int   tag;   /* Caller's value for the word */
+} LexiconWord;
+
+/**
+ * Lexicon structure
+ */
+struct TinyAIASRLexicon {
+    int          numLabels;    /* Number of phoneme labels */
+    LexiconNode *nodes;        /* Trie nodes, the root first */
+    int          numNodes;     /* Number of trie nodes */
+    int          nodeCapacity; /* Allocated trie nodes */
+    LexiconWord *words;        /* Words, in the order they were added */
+    int          numWords;     /* Number of words */
+    int          wordCapacity; /* Allocated words */
+};
+
+/**
+ * Hypothesis of the beam: a word sequence and a position in the next word
+ *
+ * Paths of the hypothesis' labels are split by whether they end in a blank,
+ * which decides whether a repeat of the last label extends the prefix.
+ */
+typedef struct {
+    int   node;      /* Trie node of the word in progress, the root before the first label */
+    int   history;   /* Word history entry of the completed words, -1 for none */
+    int   wordStart; /* Frame the word in progress started in */
+    float logBlank;  /* Log probability of the paths ending in blank */
+    float logLabel;  /* Log probability of the paths ending in the last label */
+    float wordScore; /* Sum of the scores of the completed words */
+} Hypothesis;
+
+/**
+ * Completed word of a hypothesis, linked to the words before it
+ *
+ * Entries are shared between hypotheses and interned, so equal word
+ * sequences have equal entries and hypotheses can be merged by index.
+ */
+typedef struct {
+    int word;       /* Lexicon index of the word */
+    int parent;     /* Entry of the words before, -1 for none */
+    int startFrame; /* First frame of the word */
+    int endFrame;   /* Frame after the word */
+} HistoryEntry;
+
+/**
+ * Decoder structure
+ */
+struct TinyAIASRDecoder {
+    const TinyAIASRLexicon *lexicon;   /* Lexicon the words come from */
+    TinyAIASRDecoderConfig  config;    /* Configuration */
+    TinyAIASRWordScoreFn    wordScore; /* Score of a closed word */
+    void                   *context;   /* Context of wordScore */
+    int                     numFrames; /* Frames consumed since the last reset */
+
+    /* Beam and the candidates of the next frame, preallocated at their largest */
+    Hypothesis *beam;              /* Hypotheses of the current frame */
+    int         numBeam;           /* Number of hypotheses */
+    Hypothesis *candidates;        /* Extensions of the hypotheses */
+    float      *candidateScores;   /* Total log score of each candidate */
+    int        *candidateSlots;    /* Merge table slot of each candidate */
+    int         numCandidates;     /* Number of candidates */
+    int         candidateCapacity; /* Most candidates a frame can produce */
+    int        *mergeTable;        /* Candidate of each (history, node) slot, -1 if empty */
+    int         mergeMask;         /* Merge table size minus one */
+
+    /* Word histories of the utterance */
+    HistoryEntry *history;      /* Interned history entries */
+    int           numHistory;   /* Number of entries */
+    int          *historyTable; /* Entry of each (parent, word) slot, -1 if empty */
+    int           historyMask;  /* History table size minus one */
+};
+
+/**
+ * Add two log probabilities
+ * @param a First log probability
+ * @param b Second log probability
+ * @return log(exp(a) + exp(b))
+ */
+static float logAdd(float a, float b)
+{
+    if (a < b) {
+        float t = a;
+        a       = b;
+        b       = t;
+    }
+    if (b <= LOG_ZERO) {
+        return a;
+    }
+    return a + log1pf(expf(b - a));
+}
+
+/**
+ * Hash a pair of indices into a table slot
+ * @param a First index
+ * @param b Second index
+ * @param mask Table size minus one
+ * @return Slot of the pair
+ */
+static int hashPair(int a, int b, int mask)
+{
+    uint32_t h = (uint32_t)a * 0x9E3779B1u ^ (uint32_t)b * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 13;
+    return (int)(h & (uint32_t)mask);
+}
+
+/**
+ * Create an empty lexicon
+ * @param numLabels Number of phoneme labels, including the blank
+ * @return New lexicon, or NULL on failure
+ */
+TinyAIASRLexicon *tinyaiASRLexiconCreate(int numLabels)
+{
+    if (numLabels <= 0) {
+        return NULL;
+    }
+
+    TinyAIASRLexicon *lexicon = (TinyAIASRLexicon *)calloc(1, sizeof(TinyAIASRLexicon));
+    if (!lexicon) {
+        return NULL;
+    }
+
+    lexicon->numLabels    = numLabels;
+    lexicon->nodeCapacity = 256;
+    lexicon->nodes        = (LexiconNode *)malloc(lexicon->nodeCapacity * sizeof(LexiconNode));
+    if (!lexicon->nodes) {
+        free(lexicon);
+        return NULL;
+    }
+
+    /* The root has no label and pronounces no word */
+    lexicon->nodes[LEXICON_ROOT].label       = -1;
+    lexicon->nodes[LEXICON_ROOT].firstChild  = -1;
+    lexicon->nodes[LEXICON_ROOT].nextSibling = -1;
+    lexicon->nodes[LEXICON_ROOT].word        = -1;
+    lexicon->numNodes                        = 1;
+
+    return lexicon;
+}
+
+/**
+ * Free a lexicon
+ * @param lexicon The lexicon to free
+ */
+void tinyaiASRLexiconFree(TinyAIASRLexicon *lexicon)
+{
+    if (!lexicon) {
+        return;
+    }
+
+    for (int i = 0; i < lexicon->numWords; i++) {
+        free(lexicon->words[i].text);
+    }
+    free(lexicon->words);
+    free(lexicon->nodes);
+    free(lexicon);
+}
+
+/**
+ * Find or add the child of a trie node along a label
+ * @param lexicon The lexicon to extend
+ * @param node Parent node
+ * @param label Label of the arc
+ * @return Index of the child, negative on failure
+ */
+static int lexiconChild(TinyAIASRLexicon *lexicon, int node, int label)
+{
+    for (int c = lexicon->nodes[node].firstChild; c >= 0; c = lexicon->nodes[c].nextSibling) {
+        if (lexicon->nodes[c].label == label) {
+            return c;
+        }
+    }
+
+    if (lexicon->numNodes == lexicon->nodeCapacity) {
+        int          capacity = lexicon->nodeCapacity * 2;
+        LexiconNode *nodes =
+            (LexiconNode *)realloc(lexicon->nodes, capacity * sizeof(LexiconNode));
+        if (!nodes) {
+            return -1;
+        }
+        lexicon->nodes        = nodes;
+        lexicon->nodeCapacity = capacity;
+    }
+
+    int child                         = lexicon->numNodes++;
+    lexicon->nodes[child].label       = label;
+    lexicon->nodes[child].firstChild  = -1;
+    lexicon->nodes[child].nextSibling = lexicon->nodes[node].firstChild;
+    lexicon->nodes[child].word        = -1;
+    lexicon->nodes[node].firstChild   = child;
+    return child;
+}
+
+/**
+ * Add a word to a lexicon
+ * @param lexicon The lexicon to extend
+ * @param word Text of the word, copied
+ * @param labels Pronunciation, without blanks
+ * @param numLabels Number of labels in the pronunciation
+ * @param score Log score added when the word is recognized
+ * @param tag Value returned by tinyaiASRLexiconGetTag, for the caller's use
+ * @return Index of the word holding the pronunciation, negative on failure
+ */
+int tinyaiASRLexiconAddWord(TinyAIASRLexicon *lexicon, const char *word, const int *labels,
+                            int numLabels, float score, int tag)
+{
+    if (!lexicon || !word || !labels || numLabels <= 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < numLabels; i++) {
+        if (labels[i] < 0 || labels[i] >= lexicon->numLabels) {
+            return -1;
+        }
+    }
+
+    /* Walk the pronunciation down the trie, adding the nodes it lacks */
+    int node = LEXICON_ROOT;
+    for (int i = 0; i < numLabels; i++) {
+        node = lexiconChild(lexicon, node, labels[i]);
+        if (node < 0) {
+            return -1;
+        }
+    }
+
+    /* A homophone keeps the first word */
+    int existing = lexicon->nodes[node].word;
+    if (existing >= 0) {
+        if (score > lexicon->words[existing].score) {
+            lexicon->words[existing].score = score;
+        }
+        return existing;
+    }
+
+    if (lexicon->numWords == lexicon->wordCapacity) {
+        int          capacity = lexicon->wordCapacity ? lexicon->wordCapacity * 2 : 128;
+        LexiconWord *words =
+            (LexiconWord *)realloc(lexicon->words, capacity * sizeof(LexiconWord));
+        if (!words) {
+            return -1;
+        }
+        lexicon->words        = words;
+        lexicon->wordCapacity = capacity;
+    }
+
+    size_t length = strlen(word);
+    char  *text   = (char *)malloc(length + 1);
+    if (!text) {
+        return -1;
+    }
+    memcpy(text, word, length + 1);
+
+    int index                   = lexicon->numWords++;
+    lexicon->words[index].text  = text;
+    lexicon->words[index].score = score;
+    lexicon->words[index].tag   = tag;
+    lexicon->nodes[node].word   = index;
+    return index;
+}
+
+/**
+ * Get the number of words in a lexicon
+ * @param lexicon The lexicon to query
+ * @return Number of words, 0 if lexicon is NULL
+ */
+int tinyaiASRLexiconNumWords(const TinyAIASRLexicon *lexicon)
+{
+    return lexicon ? lexicon->numWords : 0;
+}
+
+/**
+ * Get the text of a word in a lexicon
+ * @param lexicon The lexicon to query
+ * @param word Index of the word
+ * @return Text of the word, or NULL if the index is out of range
+ */
+const char *tinyaiASRLexiconGetWord(const TinyAIASRLexicon *lexicon, int word)
+{
+    if (!lexicon || word < 0 || word >= lexicon->numWords) {
+        return NULL;
+    }
+    return lexicon->words[word].text;
+}
+
+/**
+ * Get the tag of a word in a lexicon
+ * @param lexicon The lexicon to query
+ * @param word Index of the word
+ * @return Tag given when the word was added, -1 if the index is out of range
+ */
+int tinyaiASRLexiconGetTag(const TinyAIASRLexicon *lexicon, int word)
+{
+    if (!lexicon || word < 0 || word >= lexicon->numWords) {
+        return -1;
+    }
+    return lexicon->words[word].tag;
+}
+
+/**
+ * Create a decoder over a lexicon
+ * @param lexicon Lexicon the decoded words come from
+ * @param config Decoder configuration
+ * @param wordScore Score of each word closed (NULL for none)
+ * @param context Context passed to wordScore
+ * @return New decoder, or NULL on failure
+ */
+TinyAIASRDecoder *tinyaiASRDecoderCreate(const TinyAIASRLexicon       *lexicon,
+                                         const TinyAIASRDecoderConfig *config,
+                                         TinyAIASRWordScoreFn wordScore, void *context)
+{
+    if (!lexicon || !config || config->beamWidth <= 0 || config->blankLabel < 0 ||
+        config->blankLabel >= lexicon->numLabels) {
+        return NULL;
+    }
+
+    TinyAIASRDecoder *decoder = (TinyAIASRDecoder *)calloc(1, sizeof(TinyAIASRDecoder));
+    if (!decoder) {
+        return NULL;
+    }
+
+    decoder->lexicon   = lexicon;
+    decoder->config    = *config;
+    decoder->wordScore = wordScore;
+    decoder->context   = context;
+
+    /* A hypothesis yields its own prefix, at most one extension per label
+     * within its word and one per label starting the next word */
+    decoder->candidateCapacity = config->beamWidth * (2 * lexicon->numLabels + 1);
+
+    int mergeSize = 1;
+    while (mergeSize < 2 * decoder->candidateCapacity) {
+        mergeSize <<= 1;
+    }
+    decoder->mergeMask = mergeSize - 1;
+
+    decoder->beam = (Hypothesis *)malloc(config->beamWidth * sizeof(Hypothesis));
+    decoder->candidates =
+        (Hypothesis *)malloc(decoder->candidateCapacity * sizeof(Hypothesis));
+    decoder->candidateScores = (float *)malloc(decoder->candidateCapacity * sizeof(float));
+    decoder->candidateSlots  = (int *)malloc(decoder->candidateCapacity * sizeof(int));
+    decoder->mergeTable      = (int *)malloc(mergeSize * sizeof(int));
+    decoder->historyMask     = HISTORY_TABLE_INITIAL_SIZE - 1;
+    decoder->historyTable    = (int *)malloc(HISTORY_TABLE_INITIAL_SIZE * sizeof(int));
+    decoder->history =
+        (HistoryEntry *)malloc(HISTORY_TABLE_INITIAL_SIZE / 2 * sizeof(HistoryEntry));
+    if (!decoder->beam || !decoder->candidates || !decoder->candidateScores ||
+        !decoder->candidateSlots || !decoder->mergeTable || !decoder->historyTable ||
+        !decoder->history) {
+        tinyaiASRDecoderFree(decoder);
+        return NULL;
+    }
+
+    memset(decoder->mergeTable, 0xFF, mergeSize * sizeof(int));
+    tinyaiASRDecoderReset(decoder);
+
+    return decoder;
+}
+
+/**
+ * Free a decoder
+ * @param decoder The decoder to free
+ */
+void tinyaiASRDecoderFree(TinyAIASRDecoder *decoder)
+{
+    if (!decoder) {
+        return;
+    }
+
+    free(decoder->beam);
+    free(decoder->candidates);
+    free(decoder->candidateScores);
+    free(decoder->candidateSlots);
+    free(decoder->mergeTable);
+    free(decoder->historyTable);
+    free(decoder->history);
+    free(decoder);
+}
+
+/**
+ * Drop a decoder's hypotheses, to start a new utterance
+ * @param decoder The decoder to reset
+ */
+void tinyaiASRDecoderReset(TinyAIASRDecoder *decoder)
+{
+    if (!decoder) {
+        return;
+    }
+
+    /* One empty hypothesis, as if preceded by a blank */
+    Hypothesis *start = &decoder->beam[0];
+    start->node       = LEXICON_ROOT;
+    start->history    = -1;
+    start->wordStart  = 0;
+    start->logBlank   = 0.0f;
+    start->logLabel   = LOG_ZERO;
+    start->wordScore  = 0.0f;
+    decoder->numBeam  = 1;
+
+    decoder->numHistory = 0;
+    memset(decoder->historyTable, 0xFF, (decoder->historyMask + 1) * sizeof(int));
+    decoder->numFrames = 0;
+}
+
+/**
+ * Double the capacity of a decoder's word histories
+ * @param decoder The decoder to extend
+ * @return true on success, false on failure
+ */
+static bool growHistory(TinyAIASRDecoder *decoder)
+{
+    int  size  = (decoder->historyMask + 1) * 2;
+    int *table = (int *)malloc(size * sizeof(int));
+    if (!table) {
+        return false;
+    }
+    HistoryEntry *history =
+        (HistoryEntry *)realloc(decoder->history, size / 2 * sizeof(HistoryEntry));
+    if (!history) {
+        free(table);
+        return false;
+    }
+
+    memset(table, 0xFF, size * sizeof(int));
+    for (int i = 0; i < decoder->numHistory; i++) {
+        int slot = hashPair(history[i].parent, history[i].word, size - 1);
+        while (table[slot] >= 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+        table[slot] = i;
+    }
+
+    free(decoder->historyTable);
+    decoder->historyTable = table;
+    decoder->historyMask  = size - 1;
+    decoder->history      = history;
+    return true;
+}
+
+/**
+ * Get the history entry of a word following a history, adding it if new
+ * @param decoder The decoder
+ * @param parent Entry of the words before, -1 for none
+ * @param word Lexicon index of the word
+ * @param startFrame First frame of the word
+ * @param endFrame Frame after the word
+ * @return Index of the entry, negative on failure
+ */
+static int internHistory(TinyAIASRDecoder *decoder, int parent, int word, int startFrame,
+                         int endFrame)
+{
+    int slot = hashPair(parent, word, decoder->historyMask);
+    for (int e; (e = decoder->historyTable[slot]) >= 0;
+         slot = (slot + 1) & decoder->historyMask) {
+        if (decoder->history[e].parent == parent && decoder->history[e].word == word) {
+            return e;
+        }
+    }
+
+    /* Keep the table at most half full */
+    if (decoder->numHistory + 1 > (decoder->historyMask + 1) / 2) {
+        if (!growHistory(decoder)) {
+            return -1;
+        }
+        slot = hashPair(parent, word, decoder->historyMask);
+        while (decoder->historyTable[slot] >= 0) {
+            slot = (slot + 1) & decoder->historyMask;
+        }
+    }
+
+    int           index         = decoder->numHistory++;
+    HistoryEntry *entry         = &decoder->history[index];
+    entry->word                 = word;
+    entry->parent               = parent;
+    entry->startFrame           = startFrame;
+    entry->endFrame             = endFrame;
+    decoder->historyTable[slot] = index;
+    return index;
+}
+
+/**
+ * Get the score of a word closing a hypothesis
+ * @param decoder The decoder
+ * @param history Entry of the words before, -1 for none
+ * @param word Lexicon index of the word
+ * @return Log score of the word
+ */
+static float scoreWord(const TinyAIASRDecoder *decoder, int history, int word)
+{
+    float score = decoder->lexicon->words[word].score + decoder->config.wordInsertion;
+    if (decoder->wordScore) {
+        int prevWord = history >= 0 ? decoder->history[history].word : -1;
+        score += decoder->wordScore(decoder->context, prevWord, word);
+    }
+    return score;
+}
+
+/**
+ * Add paths to the candidate with a history and node, merging them into an
+ * existing candidate of the same prefix
+ * @param decoder The decoder
+ * @param history Word history of the candidate
+ * @param node Trie node of the candidate
+ * @param wordStart Frame the candidate's word in progress started in
+ * @param logBlank Log probability of the paths ending in blank
+ * @param logLabel Log probability of the paths ending in a label
+ * @param wordScore Word scores of the candidate
+ */
+static void addCandidate(TinyAIASRDecoder *decoder, int history, int node, int wordStart,
+                         float logBlank, float logLabel, float wordScore)
+{
+    int slot = hashPair(history, node, decoder->mergeMask);
+    for (int c; (c = decoder->mergeTable[slot]) >= 0; slot = (slot + 1) & decoder->mergeMask) {
+        Hypothesis *candidate = &decoder->candidates[c];
+        if (candidate->history == history && candidate->node == node) {
+            candidate->logBlank = logAdd(candidate->logBlank, logBlank);
+            candidate->logLabel = logAdd(candidate->logLabel, logLabel);
+            return;
+        }
+    }
+
+    if (decoder->numCandidates == decoder->candidateCapacity) {
+        return;
+    }
+
+    int         index              = decoder->numCandidates++;
+    Hypothesis *candidate          = &decoder->candidates[index];
+    candidate->node                = node;
+    candidate->history             = history;
+    candidate->wordStart           = wordStart;
+    candidate->logBlank            = logBlank;
+    candidate->logLabel            = logLabel;
+    candidate->wordScore           = wordScore;
+    decoder->mergeTable[slot]      = index;
+    decoder->candidateSlots[index] = slot;
+}
+
+/**
+ * Reorder candidates so the k best come first, in no particular order
+ * @param candidates Candidates to reorder
+ * @param scores Score of each candidate, reordered with them
+ * @param count Number of candidates
+ * @param k Number of best candidates to gather (less than count)
+ */
+static void selectBest(Hypothesis *candidates, float *scores, int count, int k)
+{
+    int lo = 0;
+    int hi = count - 1;
+
+    while (lo < hi) {
+        /* Partition around the middle score, best first */
+        float pivot = scores[lo + (hi - lo) / 2];
+        int   i     = lo;
+        int   j     = hi;
+        while (i <= j) {
+            while (scores[i] > pivot) {
+                i++;
+            }
+            while (scores[j] < pivot) {
+                j--;
+            }
+            if (i <= j) {
+                float      s  = scores[i];
+                Hypothesis h  = candidates[i];
+                scores[i]     = scores[j];
+                candidates[i] = candidates[j];
+                scores[j]     = s;
+                candidates[j] = h;
+                i++;
+                j--;
+            }
+        }
+
+        /* Continue in the part holding the k-th position */
+        if (k - 1 <= j) {
+            hi = j;
+        }
+        else if (k - 1 >= i) {
+            lo = i;
+        }
+        else {
+            break;
+        }
+    }
+}
+
+/**
+ * Advance a decoder by one frame
+ * @param decoder The decoder to advance
+ * @param logProbs Log probability of every label in the frame
+ * @return true on success, false on failure
+ */
+bool tinyaiASRDecoderStep(TinyAIASRDecoder *decoder, const float *logProbs)
+{
+    if (!decoder || !logProbs) {
+        return false;
+    }
+
+    const LexiconNode *nodes = decoder->lexicon->nodes;
+    int                frame = decoder->numFrames;
+    int                blank = decoder->config.blankLabel;
+
+    /* Labels far below the frame's best are not worth extending into */
+    float maxLogProb = logProbs[0];
+    for (int i = 1; i < decoder->lexicon->numLabels; i++) {
+        if (logProbs[i] > maxLogProb) {
+            maxLogProb = logProbs[i];
+        }
+    }
+    float cutoff = maxLogProb - decoder->config.labelThreshold;
+
+    decoder->numCandidates = 0;
+    for (int h = 0; h < decoder->numBeam; h++) {
+        const Hypothesis *hyp   = &decoder->beam[h];
+        float             total = logAdd(hyp->logBlank, hyp->logLabel);
+        int               last  = nodes[hyp->node].label;
+
+        /* The same prefix, through a blank or a repeat of its last label */
+        addCandidate(decoder, hyp->history, hyp->node, hyp->wordStart, total + logProbs[blank],
+                     last >= 0 ? hyp->logLabel + logProbs[last] : LOG_ZERO, hyp->wordScore);
+
+        /* A repeated label only extends the prefix after a blank */
+        int wordStart = hyp->node == LEXICON_ROOT ? frame : hyp->wordStart;
+        for (int c = nodes[hyp->node].firstChild; c >= 0; c = nodes[c].nextSibling) {
+            int label = nodes[c].label;
+            if (logProbs[label] < cutoff) {
+                continue;
+            }
+            float from = label == last ? hyp->logBlank : total;
+            addCandidate(decoder, hyp->history, c, wordStart, LOG_ZERO, from + logProbs[label],
+                         hyp->wordScore);
+        }
+
+        /* Close the word in progress and start the next one */
+        int word = nodes[hyp->node].word;
+        if (hyp->node == LEXICON_ROOT || word < 0) {
+            continue;
+        }
+        int   history    = -1;
+        float closeScore = 0.0f;
+        for (int c = nodes[LEXICON_ROOT].firstChild; c >= 0; c = nodes[c].nextSibling) {
+            int label = nodes[c].label;
+            if (logProbs[label] < cutoff) {
+                continue;
+            }
+            if (history < 0) {
+                history = internHistory(decoder, hyp->history, word, hyp->wordStart, frame);
+                if (history < 0) {
+                    return false;
+                }
+                closeScore = scoreWord(decoder, hyp->history, word);
+            }
+            float from = label == last ? hyp->logBlank : total;
+            addCandidate(decoder, history, c, frame, LOG_ZERO, from + logProbs[label],
+                         hyp->wordScore + closeScore);
+        }
+    }
+
+    /* Clear the merge table for the next frame */
+    for (int i = 0; i < decoder->numCandidates; i++) {
+        decoder->mergeTable[decoder->candidateSlots[i]] = -1;
+    }
+
+    /* Threshold pruning: drop candidates far below the best */
+    float best = LOG_ZERO;
+    for (int i = 0; i < decoder->numCandidates; i++) {
+        const Hypothesis *c         = &decoder->candidates[i];
+        decoder->candidateScores[i] = logAdd(c->logBlank, c->logLabel) + c->wordScore;
+        if (decoder->candidateScores[i] > best) {
+            best = decoder->candidateScores[i];
+        }
+    }
+
+    float floor = best - decoder->config.beamThreshold;
+    int   kept  = 0;
+    for (int i = 0; i < decoder->numCandidates; i++) {
+        if (decoder->candidateScores[i] >= floor) {
+            decoder->candidates[kept]      = decoder->candidates[i];
+            decoder->candidateScores[kept] = decoder->candidateScores[i];
+            kept++;
+        }
+    }
+
+    /* Histogram pruning: keep the beam width best */
+    if (kept > decoder->config.beamWidth) {
+        selectBest(decoder->candidates, decoder->candidateScores, kept,
+                   decoder->config.beamWidth);
+        kept = decoder->config.beamWidth;
+    }
+
+    memcpy(decoder->beam, decoder->candidates, kept * sizeof(Hypothesis));
+    decoder->numBeam = kept;
+    decoder->numFrames++;
+
+    return true;
+}
+
+/**
+ * Get the number of frames a decoder has consumed since it was reset
+ * @param decoder The decoder to query
+ * @return Number of frames, 0 if decoder is NULL
+ */
+int tinyaiASRDecoderNumFrames(const TinyAIASRDecoder *decoder)
+{
+    return decoder ? decoder->numFrames : 0;
+}
+
+/**
+ * Get the words of a decoder's best hypothesis
+ * @param decoder The decoder to query
+ * @param final Whether the utterance has ended
+ * @param words Output lexicon indices of the words, in order
+ * @param startFrames Output first frame of each word (may be NULL)
+ * @param endFrames Output frame after each word (may be NULL)
+ * @param maxWords Capacity of the output arrays
+ * @param confidence Output confidence (0.0-1.0) of the result (may be NULL)
+ * @return Number of words, at most maxWords, negative on failure
+ */
+int tinyaiASRDecoderGetBest(TinyAIASRDecoder *decoder, bool final, int *words, int *startFrames,
+                            int *endFrames, int maxWords, float *confidence)
+{
+    if (!decoder || !words || maxWords <= 0) {
+        return -1;
+    }
+
+    const LexiconNode *nodes       = decoder->lexicon->nodes;
+    int                bestHistory = -1;
+    float              bestScore   = LOG_ZERO;
+    float              totalScore  = LOG_ZERO;
+    bool               found       = false;
+
+    /* If every hypothesis ends inside a word, fall back to their completed words */
+    for (int pass = final ? 0 : 1; pass < 2 && !found; pass++) {
+        for (int h = 0; h < decoder->numBeam; h++) {
+            const Hypothesis *hyp     = &decoder->beam[h];
+            float             score   = logAdd(hyp->logBlank, hyp->logLabel) + hyp->wordScore;
+            int               history = hyp->history;
+
+            /* At the end, a hypothesis inside a word has no complete reading */
+            if (pass == 0 && hyp->node != LEXICON_ROOT) {
+                int word = nodes[hyp->node].word;
+                if (word < 0) {
+                    continue;
+                }
+                score += scoreWord(decoder, hyp->history, word);
+                history = internHistory(decoder, hyp->history, word, hyp->wordStart,
+                                        decoder->numFrames);
+                if (history < 0) {
+                    return -1;
+                }
+            }
+
+            totalScore = logAdd(totalScore, score);
+            if (!found || score > bestScore) {
+                bestScore   = score;
+                bestHistory = history;
+                found       = true;
+            }
+        }
+    }
+
+    if (confidence) {
+        *confidence = found ? expf(bestScore - totalScore) : 0.0f;
+    }
+
+    /* Walk the history back, dropping the words past maxWords */
+    int count = 0;
+    for (int e = bestHistory; e >= 0; e = decoder->history[e].parent) {
+        count++;
+    }
+    int e = bestHistory;
+    for (int skip = count - maxWords; skip > 0; skip--) {
+        e = decoder->history[e].parent;
+    }
+    if (count > maxWords) {
+        count = maxWords;
+    }
+    for (int i = count - 1; i >= 0; i--, e = decoder->history[e].parent) {
+        words[i] = decoder->history[e].word;
+        if (startFrames) {
+            startFrames[i] = decoder->history[e].startFrame;
+        }
+        if (endFrames) {
+            endFrames[i] = decoder->history[e].endFrame;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file asr_decoder.h
+ * @brief Lexicon-constrained prefix beam search for the TinyAI speech recognizer
+ *
+ * The decoder searches per-frame phoneme log-probabilities, CTC style, for
+ * the word sequences whose pronunciations are in a lexicon trie. Each frame
+ * extends only the hypotheses that survive threshold and histogram pruning,
+ * along the trie arcs of labels that are likely in that frame, so the cost
+ * of a frame is bounded by the beam width rather than the vocabulary size.
+ */
+
+#ifndef TINYAI_ASR_DECODER_H
+#define TINYAI_ASR_DECODER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pronunciation lexicon: a trie of phoneme sequences ending in words (opaque)
+ */
+typedef struct TinyAIASRLexicon TinyAIASRLexicon;
+
+/**
+ * Prefix beam search decoder (opaque)
+ */
+typedef struct TinyAIASRDecoder TinyAIASRDecoder;
+
+/**
+ * Score of a word closing a hypothesis, added to its log probability
+ * @param context Context given to tinyaiASRDecoderCreate
+ * @param prevWord Lexicon index of the previous word, -1 at the start
+ * @param word Lexicon index of the word
+ * @return Log score, such as a weighted language model probability
+ */
+typedef float (*TinyAIASRWordScoreFn)(void *context, int prevWord, int word);
+
+/**
+ * Decoder configuration
+ */
+typedef struct {
+    int   beamWidth;      /* Most hypotheses kept per frame (histogram pruning) */
+    float beamThreshold;  /* Log score below the best at which a hypothesis is pruned */
+    float labelThreshold; /* Log probability below a frame's best at which a label is skipped */
+    int   blankLabel;     /* Label that separates repeats and emits nothing */
+    float wordInsertion;  /* Log score added for every word */
+} TinyAIASRDecoderConfig;
+
+/**
+ * Create an empty lexicon
+ * @param numLabels Number of phoneme labels, including the blank
+ * @return New lexicon, or NULL on failure
+ */
+TinyAIASRLexicon *tinyaiASRLexiconCreate(int numLabels);
+
+/**
+ * Free a lexicon
+ * @param lexicon The lexicon to free
+ */
+void tinyaiASRLexiconFree(TinyAIASRLexicon *lexicon);
+
+/**
+ * Add a word to a lexicon
+ *
+ * A pronunciation holds one word: adding another word with the same
+ * pronunciation keeps the first and raises its score to the higher of the
+ * two.
+ * @param lexicon The lexicon to extend
+ * @param word Text of the word, copied
+ * @param labels Pronunciation, without blanks
+ * @param numLabels Number of labels in the pronunciation
+ * @param score Log score added when the word is recognized
+ * @param tag Value returned by tinyaiASRLexiconGetTag, for the caller's use
+ * @return Index of the word holding the pronunciation, negative on failure
+ */
+int tinyaiASRLexiconAddWord(TinyAIASRLexicon *lexicon, const char *word, const int *labels,
+                            int numLabels, float score, int tag);
+
+/**
+ * Get the number of words in a lexicon
+ * @param lexicon The lexicon to query
+ * @return Number of words, 0 if lexicon is NULL
+ */
+int tinyaiASRLexiconNumWords(const TinyAIASRLexicon *lexicon);
+
+/**
+ * Get the text of a word in a lexicon
+ * @param lexicon The lexicon to query
+ * @param word Index of the word
+ * @return Text of the word, or NULL if the index is out of range
+ */
+const char *tinyaiASRLexiconGetWord(const TinyAIASRLexicon *lexicon, int word);
+
+/**
+ * Get the tag of a word in a lexicon
+ * @param lexicon The lexicon to query
+ * @param word Index of the word
+ * @return Tag given when the word was added, -1 if the index is out of range
+ */
+int tinyaiASRLexiconGetTag(const TinyAIASRLexicon *lexicon, int word);
+
+/**
+ * Create a decoder over a lexicon
+ *
+ * The lexicon is not copied and may gain words while the decoder is in use;
+ * hypotheses reach new words from the next frame on.
+ * @param lexicon Lexicon the decoded words come from
+ * @param config Decoder configuration
+ * @param wordScore Score of each word closed (NULL for none)
+ * @param context Context passed to wordScore
+ * @return New decoder, or NULL on failure
+ */
+TinyAIASRDecoder *tinyaiASRDecoderCreate(const TinyAIASRLexicon       *lexicon,
+                                         const TinyAIASRDecoderConfig *config,
+                                         TinyAIASRWordScoreFn wordScore, void *context);
+
+/**
+ * Free a decoder
+ * @param decoder The decoder to free
+ */
+void tinyaiASRDecoderFree(TinyAIASRDecoder *decoder);
+
+/**
+ * Drop a decoder's hypotheses, to start a new utterance
+ * @param decoder The decoder to reset
+ */
+void tinyaiASRDecoderReset(TinyAIASRDecoder *decoder);
+
+/**
+ * Advance a decoder by one frame
+ * @param decoder The decoder to advance
+ * @param logProbs Log probability of every label in the frame
+ * @return true on success, false on failure
+ */
+bool tinyaiASRDecoderStep(TinyAIASRDecoder *decoder, const float *logProbs);
+
+/**
+ * Get the number of frames a decoder has consumed since it was reset
+ * @param decoder The decoder to query
+ * @return Number of frames, 0 if decoder is NULL
+ */
+int tinyaiASRDecoderNumFrames(const TinyAIASRDecoder *decoder);
+
+/**
+ * Get the words of a decoder's best hypothesis
+ *
+ * A partial result has the completed words of the best hypothesis so far.
+ * A final result also closes the word each hypothesis is in and drops the
+ * hypotheses that end inside a word, unless all of them do. The confidence
+ * is the best hypothesis' share of the probability of those considered.
+ * @param decoder The decoder to query
+ * @param final Whether the utterance has ended
+ * @param words Output lexicon indices of the words, in order
+ * @param startFrames Output first frame of each word (may be NULL)
+ * @param endFrames Output frame after each word (may be NULL)
+ * @param maxWords Capacity of the output arrays
+ * @param confidence Output confidence (0.0-1.0) of the result (may be NULL)
+ * @return Number of words, at most maxWords, negative on failure
+ */
+int tinyaiASRDecoderGetBest(TinyAIASRDecoder *decoder, bool final, int *words, int *startFrames,
+                            int *endFrames, int maxWords, float *confidence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_ASR_DECODER_H */
@@ -5,6 +5,7 @@
 
 #include "vad.h"
 #include "../../../core/memory.h"
+#include "../../../utils/simd_ops.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -176,12 +177,7 @@ static float calculateEnergy(const float *samples, int numSamples)
         return 0.0f;
     }
 
-    float sum = 0.0f;
-    for (int i = 0; i < numSamples; i++) {
-        sum += samples[i] * samples[i];
-    }
-
-    return sum / numSamples;
+    return tinyaiSimdDot(samples, samples, numSamples) / numSamples;
 }
 
 /**
@@ -196,14 +192,7 @@ static float calculateZCR(const float *samples, int numSamples)
         return 0.0f;
     }
 
-    int crossings = 0;
-    for (int i = 1; i < numSamples; i++) {
-        if ((samples[i - 1] >= 0.0f && samples[i] < 0.0f) ||
-            (samples[i - 1] < 0.0f && samples[i] >= 0.0f)) {
-            crossings++;
-        }
-    }
-
+    int crossings = tinyaiSimdCountZeroCrossings(samples, numSamples);
     return (float)crossings / (float)(numSamples - 1);
 }
 
@@ -6,9 +6,11 @@
 #include "chat_model.h"
 #include "../../core/io.h"
 #include "../../core/memory.h"
+#include "../../models/text/attention.h"
 #include "../../models/text/generate.h"
 #include "../../models/text/tokenizer.h"
 #include "../../utils/quantize.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +26,9 @@
 /* Maximum length of role prefix */
 #define MAX_ROLE_PREFIX_LENGTH 32
 
+/* Text between messages */
+#define MESSAGE_SEPARATOR "\n\n"
+
 /* Maximum number of characters to buffer for streaming */
 #define MAX_STREAMING_BUFFER 16
 
@@ -32,6 +37,29 @@
 #define JSON_KEY_ROLE "role"
 #define JSON_KEY_CONTENT "content"
 
+/* Binary session snapshots */
+#define SNAPSHOT_MAGIC 0x53434954 /* "TICS" */
+#define SNAPSHOT_VERSION 1
+
+/**
+ * Positions a message occupies in the conversation's KV cache
+ *
+ * A message is cached as its role prefix, its content and the separator
+ * before the next message, in that order.
+ */
+typedef struct {
+    int length;  /* Positions held (0 once rolled out of the window) */
+    int prefix;  /* Role prefix positions at the start */
+    int content; /* Content positions after the prefix */
+} ChatSpan;
+
+/* Growing buffer of token IDs */
+typedef struct {
+    int *tokens;
+    int  count;
+    int  capacity;
+} TokenBuffer;
+
 /**
  * Internal structure for chat session
  */
@@ -53,6 +81,18 @@ struct TinyAIChatSession {
     int   maxTokens;   /* Maximum tokens in response */
     float temperature; /* Sampling temperature */
     float topP;        /* Top-p sampling parameter */
+
+    /* Conversation kept in the model between turns */
+    TinyAIGenerationWorkspace *workspace;        /* Buffers and KV cache of the conversation
+                                                    (NULL to rebuild the context every turn) */
+    ChatSpan                  *spans;            /* Cached positions of each message */
+    int                        cachedMessages;   /* Messages already fed to the cache */
+    bool                       separatorPending; /* Last cached message lacks its separator */
+    ChatSpan                   responseSpan;     /* Span of the response about to be added */
+
+    /* Token IDs of the text around messages, encoded once */
+    TokenBuffer rolePrefixes[TINYAI_ROLE_ASSISTANT + 1]; /* Prefix of each role */
+    TokenBuffer separator;                               /* Text between messages */
 };
 
 /* Streaming callback structure */
@@ -62,7 +102,6 @@ typedef struct {
     char                    *fullResponse;
     size_t                   responseLen;
     size_t                   responseCapacity;
-    TinyAITokenizer         *tokenizer;
 } StreamingContext;
 
 /* Role conversion utilities */
@@ -113,22 +152,66 @@ static void createRolePrefix(TinyAIChatRole role, char *prefix, size_t maxLength
     }
 }
 
-/* Calculate token count for a message */
-static int calculateTokenCount(TinyAITokenizer *tokenizer, const char *text)
+/* Append token IDs to a buffer, returning how many were added or -1 on error */
+static int appendTokens(TokenBuffer *buffer, const int *tokens, int count)
 {
-    if (!tokenizer || !text) {
+    if (count <= 0) {
         return 0;
     }
 
-    int  tokenCount = 0;
-    int *tokens     = tinyaiTokenizerEncodeText(tokenizer, text, &tokenCount);
+    if (buffer->count + count > buffer->capacity) {
+        int newCapacity = buffer->capacity > 0 ? buffer->capacity * 2 : 256;
+        while (buffer->count + count > newCapacity) {
+            newCapacity *= 2;
+        }
+        int *newTokens = (int *)realloc(buffer->tokens, newCapacity * sizeof(int));
+        if (!newTokens) {
+            return -1;
+        }
+        buffer->tokens   = newTokens;
+        buffer->capacity = newCapacity;
+    }
+
+    memcpy(buffer->tokens + buffer->count, tokens, count * sizeof(int));
+    buffer->count += count;
+    return count;
+}
 
-    if (tokens) {
-        free(tokens);
-        return tokenCount;
+/* Append the tokens of a text to a buffer, returning how many were added or -1 on error */
+static int appendTextTokens(TinyAITokenizer *tokenizer, TokenBuffer *buffer, const char *text)
+{
+    int  count  = 0;
+    int *tokens = tinyaiTokenizerEncodeText(tokenizer, text, &count);
+    if (!tokens) {
+        return 0;
     }
 
-    return 0;
+    int added = appendTokens(buffer, tokens, count);
+    free(tokens);
+    return added;
+}
+
+/* Append a message as prefix, content and separator from its cached token IDs, recording
+ * where the parts fall in the span; returns false on allocation failure */
+static bool appendMessageTokens(const TinyAIChatSession *session, TokenBuffer *buffer, int index,
+                                ChatSpan *span)
+{
+    const TinyAIChatMessage *message = &session->messages[index];
+    const TokenBuffer       *prefix  = &session->rolePrefixes[message->role];
+
+    span->prefix  = appendTokens(buffer, prefix->tokens, prefix->count);
+    span->content = appendTokens(buffer, message->tokens, message->token_count);
+    int after     = appendTokens(buffer, session->separator.tokens, session->separator.count);
+    span->length  = span->prefix + span->content + after;
+    return span->prefix >= 0 && span->content >= 0 && after >= 0;
+}
+
+/* Context positions a message takes: its role prefix, content and separator */
+static int messageTokenCost(const TinyAIChatSession *session, int index)
+{
+    const TinyAIChatMessage *message = &session->messages[index];
+    return session->rolePrefixes[message->role].count + message->token_count +
+           session->separator.count;
 }
 
 /* Calculate memory usage for chat history */
@@ -145,6 +228,7 @@ static size_t calculateHistoryMemoryUsage(TinyAIChatSession *session)
         if (session->messages[i].content) {
             total += strlen(session->messages[i].content) + 1;
         }
+        total += session->messages[i].token_count * sizeof(int);
     }
 
     /* Add array overhead */
@@ -153,6 +237,105 @@ static size_t calculateHistoryMemoryUsage(TinyAIChatSession *session)
     return total;
 }
 
+/* Whether turns continue from the conversation's KV cache */
+static bool hasConversationCache(const TinyAIChatSession *session)
+{
+    return session->workspace && session->workspace->cache;
+}
+
+/* Forget the cached conversation; the next turn feeds the whole history again */
+static void resetConversationCache(TinyAIChatSession *session)
+{
+    if (!hasConversationCache(session)) {
+        return;
+    }
+
+    tinyaiResetKVCache(session->workspace->cache);
+    memset(session->spans, 0, session->messageCapacity * sizeof(ChatSpan));
+    memset(&session->responseSpan, 0, sizeof(ChatSpan));
+    session->cachedMessages   = 0;
+    session->separatorPending = false;
+}
+
+/* First cache position of a cached message */
+static int spanStart(const TinyAIChatSession *session, int index)
+{
+    int start = 0;
+    for (int i = 0; i < index; i++) {
+        start += session->spans[i].length;
+    }
+    return start;
+}
+
+/* Length of the overlap of two runs of positions [a, b) and [c, d) */
+static int runOverlap(int a, int b, int c, int d)
+{
+    int first = a > c ? a : c;
+    int last  = b < d ? b : d;
+    return last > first ? last - first : 0;
+}
+
+/* Remove a run of positions from a span, shrinking the parts it covered */
+static void shrinkSpan(ChatSpan *span, int offset, int count)
+{
+    int end        = offset + count;
+    int prefixEnd  = span->prefix;
+    int contentEnd = prefixEnd + span->content;
+    span->prefix -= runOverlap(offset, end, 0, prefixEnd);
+    span->content -= runOverlap(offset, end, prefixEnd, contentEnd);
+    span->length -= count;
+}
+
+/* Drop part of a cached message from the cache, moving later positions down */
+static void discardFromSpan(TinyAIChatSession *session, int index, int offset, int count)
+{
+    ChatSpan *span = &session->spans[index];
+    if (!hasConversationCache(session) || index >= session->cachedMessages || count <= 0) {
+        return;
+    }
+
+    /* A sliding-window cache forgets old positions on its own */
+    TinyAIKVCache *cache = session->workspace->cache;
+    if (!cache->windowSize && tinyaiKVCacheDiscard(cache, (uint32_t)(spanStart(session, index) +
+                                                                     offset),
+                                                   (uint32_t)count) != 0) {
+        resetConversationCache(session);
+        return;
+    }
+
+    shrinkSpan(span, offset, count);
+    if (span->length == 0 && index == session->cachedMessages - 1) {
+        session->separatorPending = false;
+    }
+}
+
+/* Remove a message from the history, and from the cache if it was fed to it */
+static void removeMessage(TinyAIChatSession *session, int index)
+{
+    if (index < session->cachedMessages) {
+        discardFromSpan(session, index, 0, session->spans[index].length);
+        if (index == session->cachedMessages - 1) {
+            session->separatorPending = false;
+        }
+        if (session->cachedMessages > 0) {
+            session->cachedMessages--;
+        }
+    }
+
+    /* Free the message content */
+    free(session->messages[index].content);
+    free(session->messages[index].tokens);
+
+    /* Shift remaining messages */
+    for (int j = index; j < session->messageCount - 1; j++) {
+        session->messages[j] = session->messages[j + 1];
+        session->spans[j]    = session->spans[j + 1];
+    }
+
+    /* Decrement message count */
+    session->messageCount--;
+}
+
 /* Prune history to fit within token constraints */
 static void pruneHistory(TinyAIChatSession *session)
 {
@@ -160,10 +343,10 @@ static void pruneHistory(TinyAIChatSession *session)
         return;
     }
 
-    /* Count total tokens in history */
+    /* Count total tokens in history from the counts cached when messages were added */
     int totalTokens = 0;
     for (int i = 0; i < session->messageCount; i++) {
-        totalTokens += session->messages[i].token_count;
+        totalTokens += messageTokenCost(session, i);
     }
 
     /* If we're within limits, nothing to do */
@@ -176,159 +359,109 @@ static void pruneHistory(TinyAIChatSession *session)
 
     int tokensToRemove = totalTokens - session->maxContextTokens;
 
+    /* Identify the index of the most recent user message */
+    int lastUserIdx = -1;
+    for (int j = session->messageCount - 1; j >= 0; j--) {
+        if (session->messages[j].role == TINYAI_ROLE_USER) {
+            lastUserIdx = j;
+            break;
+        }
+    }
+
     /* First pass: remove oldest messages that are not system or most recent user message */
     for (int i = 0; i < session->messageCount && tokensToRemove > 0;) {
         /* Skip system messages and the most recent user message */
-        if (session->messages[i].role == TINYAI_ROLE_SYSTEM) {
-            i++;
-            continue;
-        }
-
-        /* Identify the index of the most recent user message */
-        int lastUserIdx = -1;
-        for (int j = session->messageCount - 1; j >= 0; j--) {
-            if (session->messages[j].role == TINYAI_ROLE_USER) {
-                lastUserIdx = j;
-                break;
-            }
-        }
-
-        /* Skip the most recent user message */
-        if (i == lastUserIdx) {
+        if (session->messages[i].role == TINYAI_ROLE_SYSTEM || i == lastUserIdx) {
             i++;
             continue;
         }
 
         /* Remove this message */
-        tokensToRemove -= session->messages[i].token_count;
-
-        /* Free the message content */
-        free(session->messages[i].content);
-
-        /* Shift remaining messages */
-        for (int j = i; j < session->messageCount - 1; j++) {
-            session->messages[j] = session->messages[j + 1];
+        tokensToRemove -= messageTokenCost(session, i);
+        removeMessage(session, i);
+        if (i < lastUserIdx) {
+            lastUserIdx--;
         }
-
-        /* Decrement message count */
-        session->messageCount--;
     }
 
     /* Second pass: if we still need to remove tokens, trim assistant responses */
     for (int i = 0; i < session->messageCount && tokensToRemove > 0; i++) {
         if (session->messages[i].role == TINYAI_ROLE_ASSISTANT) {
-            /* Get token count */
-            int tokenCount = session->messages[i].token_count;
+            TinyAIChatMessage *message = &session->messages[i];
 
             /* If this message is small enough, removing it entirely is better */
-            if (tokenCount <= tokensToRemove) {
-                /* Remove this message */
-                tokensToRemove -= tokenCount;
-
-                /* Free the message content */
-                free(session->messages[i].content);
+            if (messageTokenCost(session, i) <= tokensToRemove ||
+                message->token_count <= tokensToRemove) {
+                /* Remove this message, then revisit the index (since we shifted) */
+                tokensToRemove -= messageTokenCost(session, i);
+                removeMessage(session, i);
+                i--;
+                continue;
+            }
 
-                /* Shift remaining messages */
-                for (int j = i; j < session->messageCount - 1; j++) {
-                    session->messages[j] = session->messages[j + 1];
+            /* Truncate the message to its first tokens, decoding the cached IDs */
+            int   tokensToKeep = message->token_count - tokensToRemove;
+            char *newContent =
+                tinyaiTokenizerDecode(session->tokenizer, message->tokens, tokensToKeep);
+
+            if (newContent) {
+                /* Drop the cut content from the cache as well */
+                int cachedContent = session->spans[i].content;
+                if (cachedContent > tokensToKeep) {
+                    discardFromSpan(session, i, session->spans[i].prefix + tokensToKeep,
+                                    cachedContent - tokensToKeep);
                 }
 
-                /* Decrement message count and index (since we shifted) */
-                session->messageCount--;
-                i--;
+                /* Replace the message content; its IDs are the kept prefix of the old ones */
+                free(message->content);
+                message->content     = newContent;
+                message->token_count = tokensToKeep;
+                tokensToRemove       = 0;
             }
             else {
-                /* We need to truncate this message */
-
-                /* Tokenize the message */
-                int  count  = 0;
-                int *tokens = tinyaiTokenizerEncodeText(session->tokenizer,
-                                                        session->messages[i].content, &count);
-
-                if (tokens) {
-                    /* Calculate how many tokens to keep */
-                    int tokensToDecode = count - tokensToRemove;
-                    if (tokensToDecode > 0) {
-                        /* Decode the truncated message */
-                        char *newContent =
-                            tinyaiTokenizerDecode(session->tokenizer, tokens, tokensToDecode);
-
-                        if (newContent) {
-                            /* Replace the message content */
-                            free(session->messages[i].content);
-                            session->messages[i].content     = newContent;
-                            session->messages[i].token_count = tokensToDecode;
-
-                            /* Update tokens to remove */
-                            tokensToRemove = 0;
-                        }
-                    }
-
-                    free(tokens);
-                }
-
                 /* If truncation didn't work, remove the message entirely */
-                if (tokensToRemove > 0) {
-                    /* Remove this message */
-                    tokensToRemove -= session->messages[i].token_count;
-
-                    /* Free the message content */
-                    free(session->messages[i].content);
-
-                    /* Shift remaining messages */
-                    for (int j = i; j < session->messageCount - 1; j++) {
-                        session->messages[j] = session->messages[j + 1];
-                    }
-
-                    /* Decrement message count and index (since we shifted) */
-                    session->messageCount--;
-                    i--;
-                }
+                tokensToRemove -= messageTokenCost(session, i);
+                removeMessage(session, i);
+                i--;
             }
         }
     }
 }
 
 /* Streaming token callback */
-static int tokenCallbackFunc(int token, void *userData)
+static bool tokenCallbackFunc(int token, const char *piece, void *userData)
 {
     StreamingContext *ctx = (StreamingContext *)userData;
-    if (!ctx || !ctx->tokenizer) {
-        return 0;
-    }
-
-    /* Decode the token */
-    char *tokenText = tinyaiTokenizerDecodeToken(ctx->tokenizer, token);
-    if (!tokenText) {
-        return 0;
+    (void)token;
+    if (!ctx || !piece) {
+        return false;
     }
 
     /* Call user callback */
-    int shouldContinue = 1;
+    bool shouldContinue = true;
     if (ctx->userCallback) {
-        shouldContinue = ctx->userCallback(tokenText, false, ctx->userData);
+        shouldContinue = ctx->userCallback(piece, false, ctx->userData);
     }
 
     /* Append to full response */
-    size_t tokenLen = strlen(tokenText);
-    if (ctx->responseLen + tokenLen >= ctx->responseCapacity) {
+    size_t pieceLen = strlen(piece);
+    if (ctx->responseLen + pieceLen >= ctx->responseCapacity) {
         /* Resize buffer */
         size_t newCapacity = ctx->responseCapacity * 2;
-        char  *newResponse = (char *)realloc(ctx->fullResponse, newCapacity);
+        while (ctx->responseLen + pieceLen >= newCapacity) {
+            newCapacity *= 2;
+        }
+        char *newResponse = (char *)realloc(ctx->fullResponse, newCapacity);
         if (!newResponse) {
-            free(tokenText);
-            return 0;
+            return false;
         }
         ctx->fullResponse     = newResponse;
         ctx->responseCapacity = newCapacity;
     }
 
-    /* Copy token to response */
-    strcpy(ctx->fullResponse + ctx->responseLen, tokenText);
-    ctx->responseLen += tokenLen;
-
-    /* Free token text */
-    free(tokenText);
+    /* Copy piece to response */
+    memcpy(ctx->fullResponse + ctx->responseLen, piece, pieceLen + 1);
+    ctx->responseLen += pieceLen;
 
     return shouldContinue;
 }
@@ -362,7 +495,10 @@ TinyAIChatSession *tinyaiChatSessionCreate(const TinyAIChatConfig *config)
     session->messageCapacity = 16;
     session->messages =
         (TinyAIChatMessage *)malloc(session->messageCapacity * sizeof(TinyAIChatMessage));
-    if (!session->messages) {
+    session->spans = (ChatSpan *)calloc(session->messageCapacity, sizeof(ChatSpan));
+    if (!session->messages || !session->spans) {
+        free(session->messages);
+        free(session->spans);
         free(session);
         fprintf(stderr, "Failed to allocate chat history\n");
         return NULL;
@@ -372,16 +508,33 @@ TinyAIChatSession *tinyaiChatSessionCreate(const TinyAIChatConfig *config)
     session->tokenizer = tinyaiTokenizerCreate(config->tokenizerPath);
     if (!session->tokenizer) {
         free(session->messages);
+        free(session->spans);
         free(session);
         fprintf(stderr, "Failed to create tokenizer from %s\n", config->tokenizerPath);
         return NULL;
     }
 
+    /* Encode the text around messages once; messages are encoded when added */
+    char rolePrefix[MAX_ROLE_PREFIX_LENGTH];
+    bool encoded =
+        appendTextTokens(session->tokenizer, &session->separator, MESSAGE_SEPARATOR) >= 0;
+    for (int role = TINYAI_ROLE_SYSTEM; role <= TINYAI_ROLE_ASSISTANT && encoded; role++) {
+        createRolePrefix((TinyAIChatRole)role, rolePrefix, MAX_ROLE_PREFIX_LENGTH);
+        encoded = appendTextTokens(session->tokenizer, &session->rolePrefixes[role],
+                                   rolePrefix) >= 0;
+    }
+    if (!encoded) {
+        tinyaiChatSessionFree(session);
+        fprintf(stderr, "Failed to encode message prefixes\n");
+        return NULL;
+    }
+
     /* Load model */
     session->model = tinyaiLoadModel(config->modelPath, config->weightsPath, config->tokenizerPath);
     if (!session->model) {
         tinyaiTokenizerFree(session->tokenizer);
         free(session->messages);
+        free(session->spans);
         free(session);
         fprintf(stderr, "Failed to load model from %s and %s\n", config->modelPath,
                 config->weightsPath);
@@ -396,6 +549,14 @@ TinyAIChatSession *tinyaiChatSessionCreate(const TinyAIChatConfig *config)
         }
     }
 
+    /* The conversation stays in the model's KV cache between turns, so each turn only
+     * prefills the messages added since the last one */
+    session->workspace = tinyaiCreateGenerationWorkspace(session->model);
+    if (!hasConversationCache(session)) {
+        fprintf(stderr, "Warning: Conversation cache unavailable\n");
+        /* Continue by rebuilding the context every turn */
+    }
+
     return session;
 }
 
@@ -406,6 +567,9 @@ void tinyaiChatSessionFree(TinyAIChatSession *session)
         return;
     }
 
+    /* Free the conversation cache */
+    tinyaiDestroyGenerationWorkspace(session->workspace);
+
     /* Free the model */
     if (session->model) {
         tinyaiDestroyModel(session->model);
@@ -419,15 +583,54 @@ void tinyaiChatSessionFree(TinyAIChatSession *session)
     /* Free message contents */
     for (int i = 0; i < session->messageCount; i++) {
         free(session->messages[i].content);
+        free(session->messages[i].tokens);
     }
 
     /* Free messages array */
     free(session->messages);
+    free(session->spans);
+
+    /* Free the encoded prefixes */
+    for (int role = TINYAI_ROLE_SYSTEM; role <= TINYAI_ROLE_ASSISTANT; role++) {
+        free(session->rolePrefixes[role].tokens);
+    }
+    free(session->separator.tokens);
 
     /* Free session structure */
     free(session);
 }
 
+/* Grow the message and span arrays to hold a number of messages */
+static bool reserveMessages(TinyAIChatSession *session, int count)
+{
+    if (count <= session->messageCapacity) {
+        return true;
+    }
+
+    int newCapacity = session->messageCapacity > 0 ? session->messageCapacity * 2 : 16;
+    while (newCapacity < count) {
+        newCapacity *= 2;
+    }
+
+    TinyAIChatMessage *newMessages = (TinyAIChatMessage *)realloc(
+        session->messages, newCapacity * sizeof(TinyAIChatMessage));
+    if (!newMessages) {
+        return false;
+    }
+    session->messages = newMessages;
+
+    ChatSpan *newSpans = (ChatSpan *)realloc(session->spans, newCapacity * sizeof(ChatSpan));
+    if (!newSpans) {
+        return false;
+    }
+    memset(newSpans + session->messageCapacity, 0,
+           (newCapacity - session->messageCapacity) * sizeof(ChatSpan));
+
+    session->spans           = newSpans;
+    session->messageCapacity = newCapacity;
+    return true;
+}
+
 /* Add a message to the chat history */
 bool tinyaiChatAddMessage(TinyAIChatSession *session, TinyAIChatRole role, const char *content)
 {
@@ -435,31 +638,41 @@ bool tinyaiChatAddMessage(TinyAIChatSession *session, TinyAIChatRole role, const
         return false;
     }
 
-    /* Check if we need to resize the messages array */
-    if (session->messageCount >= session->messageCapacity) {
-        int                newCapacity = session->messageCapacity * 2;
-        TinyAIChatMessage *newMessages = (TinyAIChatMessage *)realloc(
-            session->messages, newCapacity * sizeof(TinyAIChatMessage));
-        if (!newMessages) {
-            fprintf(stderr, "Failed to resize message history\n");
-            return false;
-        }
+    if (role < TINYAI_ROLE_SYSTEM || role > TINYAI_ROLE_ASSISTANT) {
+        fprintf(stderr, "Invalid message role\n");
+        return false;
+    }
 
-        session->messages        = newMessages;
-        session->messageCapacity = newCapacity;
+    if (!reserveMessages(session, session->messageCount + 1)) {
+        fprintf(stderr, "Failed to resize message history\n");
+        return false;
     }
 
     /* Add the new message */
-    session->messages[session->messageCount].role    = role;
-    session->messages[session->messageCount].content = _strdup(content);
-    if (!session->messages[session->messageCount].content) {
+    TinyAIChatMessage *message = &session->messages[session->messageCount];
+    message->role              = role;
+    message->content           = _strdup(content);
+    if (!message->content) {
         fprintf(stderr, "Failed to allocate message content\n");
         return false;
     }
 
-    /* Calculate token count */
-    session->messages[session->messageCount].token_count =
-        calculateTokenCount(session->tokenizer, content);
+    /* Tokenize once; pruning and prefill reuse the IDs */
+    message->token_count = 0;
+    message->tokens      = session->tokenizer ? tinyaiTokenizerEncodeText(session->tokenizer,
+                                                                          content,
+                                                                          &message->token_count)
+                                              : NULL;
+    if (!message->tokens) {
+        message->token_count = 0;
+    }
+
+    /* A response generated on the conversation cache is already in it */
+    session->spans[session->messageCount] = session->responseSpan;
+    if (session->responseSpan.length > 0) {
+        session->cachedMessages++;
+    }
+    memset(&session->responseSpan, 0, sizeof(ChatSpan));
 
     /* Increment message count */
     session->messageCount++;
@@ -470,64 +683,31 @@ bool tinyaiChatAddMessage(TinyAIChatSession *session, TinyAIChatRole role, const
     return true;
 }
 
-/* Generate a response to the conversation */
-char *tinyaiChatGenerateResponse(TinyAIChatSession       *session,
+/* Generate a response by feeding the whole history again */
+static char *generateFromHistory(TinyAIChatSession       *session,
                                  TinyAIChatStreamCallback stream_callback, void *user_data)
 {
-    if (!session || !session->model || !session->tokenizer) {
-        return NULL;
-    }
-
-    /* Build the chat context */
-    char   rolePrefix[MAX_ROLE_PREFIX_LENGTH];
-    size_t contextSize = 1; /* Start with 1 for null terminator */
-
-    /* First, calculate required size */
-    for (int i = 0; i < session->messageCount; i++) {
-        createRolePrefix(session->messages[i].role, rolePrefix, MAX_ROLE_PREFIX_LENGTH);
-        contextSize +=
-            strlen(rolePrefix) + strlen(session->messages[i].content) + 2; /* +2 for newlines */
+    /* Assemble the context from the token IDs cached with each message */
+    TokenBuffer context = {NULL, 0, 0};
+    ChatSpan    span;
+    bool        ok = true;
+    for (int i = 0; i < session->messageCount && ok; i++) {
+        ok = appendMessageTokens(session, &context, i, &span);
     }
 
     /* Add assistant prefix for the response */
-    createRolePrefix(TINYAI_ROLE_ASSISTANT, rolePrefix, MAX_ROLE_PREFIX_LENGTH);
-    contextSize += strlen(rolePrefix);
-
-    /* Allocate context buffer */
-    char *context = (char *)malloc(contextSize);
-    if (!context) {
-        fprintf(stderr, "Failed to allocate context buffer\n");
-        return NULL;
-    }
-
-    /* Build context string */
-    context[0] = '\0';
-    for (int i = 0; i < session->messageCount; i++) {
-        createRolePrefix(session->messages[i].role, rolePrefix, MAX_ROLE_PREFIX_LENGTH);
-        strcat(context, rolePrefix);
-        strcat(context, session->messages[i].content);
-        strcat(context, "\n\n");
-    }
-
-    /* Add assistant prefix for the response */
-    createRolePrefix(TINYAI_ROLE_ASSISTANT, rolePrefix, MAX_ROLE_PREFIX_LENGTH);
-    strcat(context, rolePrefix);
-
-    /* Tokenize context */
-    int  contextTokens = 0;
-    int *tokens        = tinyaiTokenizerEncodeText(session->tokenizer, context, &contextTokens);
-
-    if (!tokens) {
-        free(context);
-        fprintf(stderr, "Failed to tokenize context\n");
+    const TokenBuffer *responsePrefix = &session->rolePrefixes[TINYAI_ROLE_ASSISTANT];
+    if (!ok || appendTokens(&context, responsePrefix->tokens, responsePrefix->count) < 0) {
+        free(context.tokens);
+        fprintf(stderr, "Failed to allocate context tokens\n");
         return NULL;
     }
 
     /* Set up generation parameters */
     TinyAIGenerationParams params;
     memset(&params, 0, sizeof(TinyAIGenerationParams));
-    params.promptTokens   = tokens;
-    params.promptLength   = contextTokens;
+    params.promptTokens   = context.tokens;
+    params.promptLength   = context.count;
     params.maxTokens      = session->maxTokens;
     params.temperature    = session->temperature;
     params.topP           = session->topP;
@@ -544,13 +724,11 @@ char *tinyaiChatGenerateResponse(TinyAIChatSession       *session,
         memset(&streamCtx, 0, sizeof(StreamingContext));
         streamCtx.userCallback     = stream_callback;
         streamCtx.userData         = user_data;
-        streamCtx.tokenizer        = session->tokenizer;
         streamCtx.responseCapacity = 1024;
         streamCtx.fullResponse     = (char *)malloc(streamCtx.responseCapacity);
 
         if (!streamCtx.fullResponse) {
-            free(tokens);
-            free(context);
+            free(context.tokens);
             fprintf(stderr, "Failed to allocate response buffer\n");
             return NULL;
         }
@@ -575,8 +753,7 @@ char *tinyaiChatGenerateResponse(TinyAIChatSession       *session,
         /* Allocate buffer for output tokens */
         int *outputTokens = (int *)malloc(params.maxTokens * sizeof(int));
         if (!outputTokens) {
-            free(tokens);
-            free(context);
+            free(context.tokens);
             fprintf(stderr, "Failed to allocate output tokens buffer\n");
             return NULL;
         }
@@ -592,12 +769,146 @@ char *tinyaiChatGenerateResponse(TinyAIChatSession       *session,
     }
 
     /* Clean up */
-    free(tokens);
-    free(context);
+    free(context.tokens);
+
+    return response;
+}
+
+/* Generate a response continuing the conversation held in the KV cache */
+static char *generateContinuing(TinyAIChatSession       *session,
+                                TinyAIChatStreamCallback stream_callback, void *user_data)
+{
+    TinyAIKVCache     *cache    = session->workspace->cache;
+    const TokenBuffer *response = &session->rolePrefixes[TINYAI_ROLE_ASSISTANT];
+    TokenBuffer        turn     = {NULL, 0, 0};
+    int                firstNew = session->cachedMessages;
+
+    /* The separator after the last response, then the messages added since, from the token
+     * IDs cached with them */
+    int  separator = session->separatorPending ? appendTokens(&turn, session->separator.tokens,
+                                                              session->separator.count)
+                                               : 0;
+    bool ok        = separator >= 0;
+    for (int i = firstNew; i < session->messageCount && ok; i++) {
+        ok = appendMessageTokens(session, &turn, i, &session->spans[i]);
+    }
+
+    /* Then the prefix of the response */
+    int responsePrefix = ok ? appendTokens(&turn, response->tokens, response->count) : -1;
+    if (responsePrefix < 0) {
+        free(turn.tokens);
+        fprintf(stderr, "Failed to allocate context tokens\n");
+        return NULL;
+    }
+
+    /* Roll the window over the oldest messages until the turn and its response fit, keeping
+     * system messages while anything else is left. A sliding-window cache rolls itself. */
+    int capacity = (int)cache->maxSeqLength;
+    for (int pass = 0; pass < 2 && !cache->windowSize; pass++) {
+        for (int i = 0; i < firstNew; i++) {
+            if ((int)cache->length + turn.count + session->maxTokens <= capacity) {
+                break;
+            }
+            if (pass == 0 && session->messages[i].role == TINYAI_ROLE_SYSTEM) {
+                continue;
+            }
+            discardFromSpan(session, i, 0, session->spans[i].length);
+
+            /* A failed discard resets the cache, so the whole history is fed again */
+            if (session->cachedMessages != firstNew) {
+                free(turn.tokens);
+                return generateContinuing(session, stream_callback, user_data);
+            }
+        }
+    }
+
+    /* With the message before it gone, the separator is not needed */
+    if (separator > 0 && !session->separatorPending) {
+        turn.count -= separator;
+        memmove(turn.tokens, turn.tokens + separator, turn.count * sizeof(int));
+        separator = 0;
+    }
+
+    /* Alone, the new messages crowd out the response: keep their most recent tokens */
+    int room = capacity - (int)cache->length;
+    if (!cache->windowSize && turn.count + session->maxTokens > room) {
+        int keep = room - session->maxTokens > room / 2 ? room - session->maxTokens : room / 2;
+        keep     = keep > responsePrefix + 1 ? keep : responsePrefix + 1;
+        int trim = turn.count - keep;
+        for (int i = firstNew; i < session->messageCount && trim > 0; i++) {
+            int count = session->spans[i].length < trim ? session->spans[i].length : trim;
+            shrinkSpan(&session->spans[i], 0, count);
+            trim -= count;
+            turn.count -= count;
+            memmove(turn.tokens, turn.tokens + count, turn.count * sizeof(int));
+        }
+    }
+
+    /* Set up generation parameters; only the new tokens are prefilled */
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(TinyAIGenerationParams));
+    params.promptTokens   = turn.tokens;
+    params.promptLength   = turn.count;
+    params.maxTokens      = session->maxTokens;
+    params.temperature    = session->temperature;
+    params.topP           = session->topP;
+    params.samplingMethod = TINYAI_SAMPLING_TOP_P;
+
+    /* Collect the response, streaming it if asked to */
+    StreamingContext streamCtx;
+    memset(&streamCtx, 0, sizeof(StreamingContext));
+    streamCtx.userCallback     = stream_callback;
+    streamCtx.userData         = user_data;
+    streamCtx.responseCapacity = 1024;
+    streamCtx.fullResponse     = (char *)malloc(streamCtx.responseCapacity);
+    int *outputTokens          = (int *)malloc(session->maxTokens * sizeof(int));
+
+    int numTokens = -1;
+    if (streamCtx.fullResponse && outputTokens) {
+        streamCtx.fullResponse[0] = '\0';
+        numTokens = tinyaiGenerateTextContinue(session->model, &params, session->workspace,
+                                               outputTokens, session->maxTokens,
+                                               tokenCallbackFunc, &streamCtx);
+    }
+    free(outputTokens);
+    free(turn.tokens);
+
+    if (numTokens < 0) {
+        free(streamCtx.fullResponse);
+        resetConversationCache(session);
+        fprintf(stderr, "Failed to generate response\n");
+        return NULL;
+    }
+
+    /* The cache now holds every message and the response */
+    if (separator > 0) {
+        session->spans[firstNew - 1].length += separator;
+    }
+    session->cachedMessages       = session->messageCount;
+    session->separatorPending     = true;
+    session->responseSpan.prefix  = responsePrefix;
+    session->responseSpan.content = numTokens;
+    session->responseSpan.length  = responsePrefix + numTokens;
+
+    return streamCtx.fullResponse;
+}
+
+/* Generate a response to the conversation */
+char *tinyaiChatGenerateResponse(TinyAIChatSession       *session,
+                                 TinyAIChatStreamCallback stream_callback, void *user_data)
+{
+    if (!session || !session->model || !session->tokenizer) {
+        return NULL;
+    }
+
+    char *response = hasConversationCache(session)
+                         ? generateContinuing(session, stream_callback, user_data)
+                         : generateFromHistory(session, stream_callback, user_data);
 
     /* Add response to chat history if successful */
-    if (response) {
-        tinyaiChatAddMessage(session, TINYAI_ROLE_ASSISTANT, response);
+    if (response && !tinyaiChatAddMessage(session, TINYAI_ROLE_ASSISTANT, response)) {
+        /* The cache holds a response the history lacks */
+        resetConversationCache(session);
     }
 
     return response;
@@ -841,6 +1152,241 @@ bool tinyaiChatLoadHistory(TinyAIChatSession *session, const char *filePath)
     return session->messageCount > 0;
 }
 
+/* Header of a session snapshot */
+typedef struct {
+    uint32_t magic;            /* SNAPSHOT_MAGIC */
+    uint32_t version;          /* SNAPSHOT_VERSION */
+    uint32_t tokenizerHash;    /* Hash of the encoded role prefixes and separator */
+    uint32_t messageCount;     /* Messages saved */
+    uint32_t cachedMessages;   /* Messages held by the saved KV cache */
+    uint32_t separatorPending; /* Last cached message lacks its separator */
+    uint64_t cacheSize;        /* Bytes of saved KV cache (0 for none) */
+} SnapshotHeader;
+
+/* Record of a saved message, followed by its content and token IDs */
+typedef struct {
+    uint32_t role;         /* TinyAIChatRole */
+    uint32_t contentBytes; /* Content length without the terminator */
+    uint32_t tokenCount;   /* Token IDs saved */
+    ChatSpan span;         /* Positions in the saved KV cache */
+} SnapshotMessage;
+
+/* FNV-1a hash of the encoded text around messages, identifying the tokenizer's encoding */
+static uint32_t snapshotTokenizerHash(const TinyAIChatSession *session)
+{
+    uint32_t hash = 2166136261u;
+    for (int part = 0; part <= TINYAI_ROLE_ASSISTANT + 1; part++) {
+        const TokenBuffer *buffer =
+            part <= TINYAI_ROLE_ASSISTANT ? &session->rolePrefixes[part] : &session->separator;
+        hash = (hash ^ (uint32_t)buffer->count) * 16777619u;
+        for (int i = 0; i < buffer->count; i++) {
+            hash = (hash ^ (uint32_t)buffer->tokens[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+/* Save the session to a binary snapshot */
+bool tinyaiChatSaveSnapshot(TinyAIChatSession *session, const char *filePath, bool includeCache)
+{
+    if (!session || !filePath) {
+        return false;
+    }
+
+    /* The KV cache is saved in its own format, with only the cached positions */
+    void  *cacheState = NULL;
+    size_t cacheSize  = 0;
+    if (includeCache && hasConversationCache(session) && session->cachedMessages > 0) {
+        cacheSize  = tinyaiKVCacheSavedSize(session->workspace->cache);
+        cacheState = malloc(cacheSize);
+        if (!cacheState ||
+            tinyaiSaveKVCache(session->workspace->cache, cacheState, cacheSize) != cacheSize) {
+            free(cacheState);
+            fprintf(stderr, "Failed to save the conversation cache\n");
+            return false;
+        }
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic            = SNAPSHOT_MAGIC;
+    header.version          = SNAPSHOT_VERSION;
+    header.tokenizerHash    = snapshotTokenizerHash(session);
+    header.messageCount     = (uint32_t)session->messageCount;
+    header.cachedMessages   = cacheSize > 0 ? (uint32_t)session->cachedMessages : 0;
+    header.separatorPending = cacheSize > 0 && session->separatorPending;
+    header.cacheSize        = cacheSize;
+
+    /* Write a temporary file and rename it over the snapshot, so a failed save keeps the
+     * previous one */
+    size_t pathSize = strlen(filePath) + 5;
+    char  *tempPath = (char *)malloc(pathSize);
+    FILE  *file     = NULL;
+    if (tempPath) {
+        snprintf(tempPath, pathSize, "%s.tmp", filePath);
+        file = fopen(tempPath, "wb");
+    }
+
+    bool ok = file && fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; i < session->messageCount && ok; i++) {
+        const TinyAIChatMessage *message = &session->messages[i];
+        SnapshotMessage          record;
+        memset(&record, 0, sizeof(record));
+        record.role         = (uint32_t)message->role;
+        record.contentBytes = (uint32_t)strlen(message->content);
+        record.tokenCount   = (uint32_t)message->token_count;
+        if ((uint32_t)i < header.cachedMessages) {
+            record.span = session->spans[i];
+        }
+
+        ok = fwrite(&record, sizeof(record), 1, file) == 1 &&
+             fwrite(message->content, 1, record.contentBytes, file) == record.contentBytes &&
+             (record.tokenCount == 0 ||
+              fwrite(message->tokens, sizeof(int), record.tokenCount, file) == record.tokenCount);
+    }
+    ok = ok && (cacheSize == 0 || fwrite(cacheState, 1, cacheSize, file) == cacheSize);
+
+    if (file && fclose(file) != 0) {
+        ok = false;
+    }
+    free(cacheState);
+
+    if (ok && tinyaiRenameFile(tempPath, filePath) != TINYAI_IO_SUCCESS) {
+        ok = false;
+    }
+    if (!ok) {
+        if (file) {
+            remove(tempPath);
+        }
+        fprintf(stderr, "Failed to write snapshot: %s\n", filePath);
+    }
+    free(tempPath);
+
+    return ok;
+}
+
+/* Read the saved messages of a snapshot into the empty history */
+static bool readSnapshotMessages(TinyAIChatSession *session, FILE *file, uint32_t count)
+{
+    if (count > INT32_MAX || !reserveMessages(session, (int)count)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        SnapshotMessage record;
+        if (fread(&record, sizeof(record), 1, file) != 1 || record.role > TINYAI_ROLE_ASSISTANT ||
+            record.tokenCount > INT32_MAX / sizeof(int) || record.contentBytes == UINT32_MAX) {
+            return false;
+        }
+
+        /* Count the message before filling it so clearing the history frees it on failure */
+        TinyAIChatMessage *message = &session->messages[session->messageCount++];
+        message->role              = (TinyAIChatRole)record.role;
+        message->content           = (char *)malloc((size_t)record.contentBytes + 1);
+        message->tokens            = NULL;
+        message->token_count       = (int)record.tokenCount;
+        session->spans[i]          = record.span;
+        if (record.tokenCount > 0) {
+            message->tokens = (int *)malloc(record.tokenCount * sizeof(int));
+        }
+
+        if (!message->content || (record.tokenCount > 0 && !message->tokens) ||
+            fread(message->content, 1, record.contentBytes, file) != record.contentBytes ||
+            (record.tokenCount > 0 &&
+             fread(message->tokens, sizeof(int), record.tokenCount, file) != record.tokenCount)) {
+            return false;
+        }
+        message->content[record.contentBytes] = '\0';
+    }
+
+    return true;
+}
+
+/* Restore the saved KV cache of a snapshot, returning false if it does not fit the session */
+static bool readSnapshotCache(TinyAIChatSession *session, FILE *file,
+                              const SnapshotHeader *header)
+{
+    if (!hasConversationCache(session) || header->cacheSize > SIZE_MAX ||
+        header->cachedMessages > (uint32_t)session->messageCount) {
+        return false;
+    }
+
+    void *cacheState = malloc((size_t)header->cacheSize);
+    bool  restored   = cacheState &&
+                    fread(cacheState, 1, (size_t)header->cacheSize, file) == header->cacheSize &&
+                    tinyaiRestoreKVCache(session->workspace->cache, cacheState,
+                                         (size_t)header->cacheSize) == 0;
+    free(cacheState);
+
+    /* The spans of the cached messages must account for every cached position */
+    if (restored) {
+        for (uint32_t i = 0; i < header->cachedMessages && restored; i++) {
+            const ChatSpan *span = &session->spans[i];
+            restored = span->prefix >= 0 && span->content >= 0 &&
+                       span->prefix + span->content <= span->length;
+        }
+        restored = restored && spanStart(session, (int)header->cachedMessages) ==
+                                   (int)session->workspace->cache->length;
+    }
+    if (!restored) {
+        return false;
+    }
+
+    session->cachedMessages   = (int)header->cachedMessages;
+    session->separatorPending = header->separatorPending != 0;
+    return true;
+}
+
+/* Restore a session from a binary snapshot */
+bool tinyaiChatLoadSnapshot(TinyAIChatSession *session, const char *filePath)
+{
+    if (!session || !filePath) {
+        return false;
+    }
+
+    FILE *file = fopen(filePath, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open file for reading: %s\n", filePath);
+        return false;
+    }
+
+    SnapshotHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != SNAPSHOT_MAGIC ||
+        header.version != SNAPSHOT_VERSION) {
+        fclose(file);
+        fprintf(stderr, "Invalid snapshot: %s\n", filePath);
+        return false;
+    }
+
+    /* Saved token IDs are only meaningful to the tokenizer that produced them */
+    if (header.tokenizerHash != snapshotTokenizerHash(session)) {
+        fclose(file);
+        fprintf(stderr, "Snapshot was saved with a different tokenizer: %s\n", filePath);
+        return false;
+    }
+
+    /* Replace the history with the saved messages */
+    tinyaiChatClearHistory(session);
+    if (!readSnapshotMessages(session, file, header.messageCount)) {
+        tinyaiChatClearHistory(session);
+        fclose(file);
+        fprintf(stderr, "Failed to read snapshot: %s\n", filePath);
+        return false;
+    }
+
+    /* Without the saved cache, the next turn prefills the history */
+    if (header.cacheSize > 0 && !readSnapshotCache(session, file, &header)) {
+        resetConversationCache(session);
+        fprintf(stderr, "Warning: Snapshot cache does not match the model\n");
+    }
+    if (session->cachedMessages == 0) {
+        memset(session->spans, 0, session->messageCapacity * sizeof(ChatSpan));
+    }
+
+    fclose(file);
+    return true;
+}
+
 /* Get the number of messages in the chat history */
 int tinyaiChatGetMessageCount(TinyAIChatSession *session)
 {
@@ -875,10 +1421,12 @@ void tinyaiChatClearHistory(TinyAIChatSession *session)
     /* Free message contents */
     for (int i = 0; i < session->messageCount; i++) {
         free(session->messages[i].content);
+        free(session->messages[i].tokens);
     }
 
-    /* Reset message count */
+    /* Reset message count and the conversation cache */
     session->messageCount = 0;
+    resetConversationCache(session);
 }
 
 /* Get current memory usage statistics */
@@ -903,6 +1451,14 @@ bool tinyaiChatGetMemoryUsage(TinyAIChatSession *session, size_t *modelMemory,
     /* Calculate total memory */
     size_t mTotal = mModel + mHistory + sizeof(TinyAIChatSession);
 
+    /* Add the conversation cache */
+    if (hasConversationCache(session)) {
+        const TinyAIKVCache *cache = session->workspace->cache;
+        mTotal += (size_t)2 * cache->numLayers * cache->maxSeqLength * cache->rowSize *
+                      sizeof(float) +
+                  (size_t)cache->stateSize * sizeof(float);
+    }
+
     /* Add tokenizer memory (rough estimate) */
     if (session->tokenizer) {
         mTotal += 2 * 1024 * 1024; /* Rough estimate */
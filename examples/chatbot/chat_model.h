@@ -32,6 +32,7 @@ typedef enum {
 typedef struct {
     TinyAIChatRole role;        /* Role (system, user, assistant) */
     char          *content;     /* Message content */
+    int           *tokens;      /* Token IDs of the content (encoded once, when added) */
     int            token_count; /* Number of tokens in the message (cached) */
 } TinyAIChatMessage;
 
@@ -126,6 +127,34 @@ bool tinyaiChatSaveHistory(TinyAIChatSession *session, const char *filePath);
  */
 bool tinyaiChatLoadHistory(TinyAIChatSession *session, const char *filePath);
 
+/**
+ * Save the session to a binary snapshot
+ *
+ * Unlike the JSON history, a snapshot keeps the token IDs of every message
+ * and, with includeCache, the conversation's KV cache, so a session resumed
+ * with tinyaiChatLoadSnapshot continues without tokenizing or prefilling the
+ * history again. The file is replaced only once the snapshot is complete.
+ *
+ * @param session Chat session
+ * @param filePath Path to save the snapshot
+ * @param includeCache Whether to save the KV cache with the messages
+ * @return True on success, false on failure
+ */
+bool tinyaiChatSaveSnapshot(TinyAIChatSession *session, const char *filePath, bool includeCache);
+
+/**
+ * Restore a session from a binary snapshot
+ *
+ * Replaces the chat history. The session must use the tokenizer the
+ * snapshot was saved with; a saved KV cache that does not match the
+ * session's model is dropped, and the next turn prefills the history.
+ *
+ * @param session Chat session
+ * @param filePath Path to load the snapshot from
+ * @return True on success, false if the snapshot could not be read
+ */
+bool tinyaiChatLoadSnapshot(TinyAIChatSession *session, const char *filePath);
+
 /**
  * Get the number of messages in the chat history
  *
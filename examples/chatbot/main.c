@@ -135,6 +135,7 @@ void printUsage(const char *progname)
     printf("  --system-prompt <file> File containing system prompt/instructions\n");
     printf("  --load-history <file>  Load conversation history from file\n");
     printf("  --save-history <file>  Save conversation history to file on exit\n");
+    printf("  --snapshot <file>      Resume the session from a binary snapshot and save it on exit\n");
     printf("  --no-stream            Disable streaming generation\n");
     printf("  --quantized            Use 4-bit quantization (default: enabled)\n");
     printf("  --no-quantize          Disable quantization\n");
@@ -168,6 +169,7 @@ int main(int argc, char *argv[])
     const char *system_prompt_file = NULL;
     const char *load_history_file  = NULL;
     const char *save_history_file  = NULL;
+    const char *snapshot_file      = NULL;
     int         memory_limit_mb    = 16;
     int         max_tokens         = 100;
     float       temperature        = 0.7f;
@@ -224,6 +226,9 @@ int main(int argc, char *argv[])
         else if (strcmp(argv[i], "--save-history") == 0) {
             save_history_file = DEFAULT_HISTORY_FILE;
         }
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_file = argv[++i];
+        }
         else if (strcmp(argv[i], "--no-stream") == 0) {
             use_streaming = false;
         }
@@ -312,6 +317,17 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* Resume from a snapshot if one was saved, without prefilling the history again */
+    if (snapshot_file && tinyaiFileExists(snapshot_file) == 1) {
+        if (tinyaiChatLoadSnapshot(session, snapshot_file)) {
+            int msg_count = tinyaiChatGetMessageCount(session);
+            printf("Resumed %d messages from %s\n", msg_count, snapshot_file);
+        }
+        else {
+            fprintf(stderr, "Failed to resume session from: %s\n", snapshot_file);
+        }
+    }
+
     /* Display initial memory usage */
     printMemoryUsage(session);
 
@@ -387,6 +403,16 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* Save a snapshot, with the conversation cache, to resume from */
+    if (snapshot_file) {
+        if (tinyaiChatSaveSnapshot(session, snapshot_file, true)) {
+            printf("Session snapshot saved to %s\n", snapshot_file);
+        }
+        else {
+            fprintf(stderr, "Failed to save session snapshot to %s\n", snapshot_file);
+        }
+    }
+
     /* Final memory usage */
     printMemoryUsage(session);
 
@@ -9,6 +9,9 @@
 #include "../../models/text/generate.h"
 #include "../../models/text/tokenizer.h"
 #include "../../utils/quantize.h"
+#include "../../utils/simd_ops.h"
+#include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -200,6 +203,22 @@ bool tinyaiDocumentProcessFile(TinyAIDocumentProcessor *processor, const char *f
     return result;
 }
 
+/**
+ * Format classification results for output
+ */
+static void formatClassResults(const TinyAIDocumentClassResult *results, int numResults,
+                               char *outputBuffer, int outputSize)
+{
+    int offset = 0;
+    offset += snprintf(outputBuffer + offset, outputSize - offset, "Classification Results:\n");
+    for (int i = 0; i < numResults && offset < outputSize; i++) {
+        offset += snprintf(outputBuffer + offset, outputSize - offset,
+                           "  Class: %s (ID: %d), Confidence: %.2f%%\n",
+                           results[i].label ? results[i].label : "Unknown", results[i].classId,
+                           results[i].confidence * 100.0f);
+    }
+}
+
 /**
  * Process document text
  */
@@ -220,15 +239,7 @@ bool tinyaiDocumentProcessText(TinyAIDocumentProcessor *processor, const char *t
             return false;
         }
 
-        /* Format the results */
-        int offset = 0;
-        offset += snprintf(outputBuffer + offset, outputSize - offset, "Classification Results:\n");
-        for (int i = 0; i < numResults && offset < outputSize; i++) {
-            offset += snprintf(outputBuffer + offset, outputSize - offset,
-                               "  Class: %s (ID: %d), Confidence: %.2f%%\n",
-                               results[i].label ? results[i].label : "Unknown", results[i].classId,
-                               results[i].confidence * 100.0f);
-        }
+        formatClassResults(results, numResults, outputBuffer, outputSize);
         return true;
     }
 
@@ -305,21 +316,11 @@ int tinyaiDocumentClassify(TinyAIDocumentProcessor *processor, const char *text,
         results[i].label      = processor->classLabels ? processor->classLabels[i] : NULL;
     }
 
-    /* Apply softmax to get probabilities */
-    float maxLogit = outputLogits[0];
-    for (int i = 1; i < processor->numClasses; i++) {
-        if (outputLogits[i] > maxLogit) {
-            maxLogit = outputLogits[i];
-        }
-    }
-
-    float sumExp = 0.0f;
-    for (int i = 0; i < processor->numClasses; i++) {
-        sumExp += expf(outputLogits[i] - maxLogit);
-    }
+    /* Apply softmax to get probabilities: p = exp(logit - logSumExp) */
+    float logSumExp = tinyaiSimdLogSumExp(outputLogits, processor->numClasses);
 
     for (int i = 0; i < processor->numClasses; i++) {
-        float probability = expf(outputLogits[i] - maxLogit) / sumExp;
+        float probability = expf(outputLogits[i] - logSumExp);
 
         /* Find where this class should be inserted in the results array */
         int insertPos = numResults;
@@ -527,6 +528,523 @@ bool tinyaiDocumentExtractInfo(TinyAIDocumentProcessor *processor, const char *t
     return true;
 }
 
+/* Streaming defaults */
+#define STREAM_DEFAULT_READ_BYTES (1024 * 1024)
+#define STREAM_DEFAULT_PARALLEL 4
+#define STREAM_MAX_PARALLEL 16
+#define STREAM_MAX_LEVELS 32
+#define STREAM_MAX_RESULTS 10
+
+/**
+ * Output of a chunk or merge awaiting the next merge
+ */
+typedef struct {
+    int *tokens;
+    int  count;
+} StreamOutput;
+
+/**
+ * Streaming state
+ */
+typedef struct {
+    TinyAIDocumentProcessor *processor;
+    int                     *prefix;       /* Prompt tokens before every chunk and merge */
+    int                      prefixLength; /* Number of prompt tokens */
+    int                      chunkTokens;  /* Document tokens per chunk */
+    int                      parallel;     /* Chunks per batched pass */
+    int                      fanIn;        /* Outputs merged into one */
+
+    /* Classification: length-weighted sum of chunk class probabilities */
+    float  *logits;
+    double *classSums;
+    double  classWeight;
+
+    /* Outputs awaiting a merge, fanIn slots per level */
+    StreamOutput *levels[STREAM_MAX_LEVELS];
+    int           levelCounts[STREAM_MAX_LEVELS];
+
+    TinyAIDocumentStreamStats stats;
+} DocumentStream;
+
+/**
+ * Initialize a streaming configuration with default values
+ */
+void tinyaiDocumentStreamConfigDefault(TinyAIDocumentStreamConfig *config)
+{
+    if (!config) {
+        return;
+    }
+
+    memset(config, 0, sizeof(TinyAIDocumentStreamConfig));
+    config->readBytes      = STREAM_DEFAULT_READ_BYTES;
+    config->parallelChunks = STREAM_DEFAULT_PARALLEL;
+}
+
+/**
+ * Generate one output per input in a single batched pass
+ *
+ * Each input follows the prompt prefix; outputs hold the generated tokens
+ * only, without a final EOS.
+ */
+static bool streamGenerate(DocumentStream *stream, const int *const *inputs, const int *lengths,
+                           int count, StreamOutput *outputs)
+{
+    TinyAIDocumentProcessor *processor = stream->processor;
+    int                      capacity  = stream->prefixLength + stream->chunkTokens +
+                                   processor->maxOutputLength;
+
+    TinyAIGenerationParams params[STREAM_MAX_PARALLEL];
+    int                   *buffers[STREAM_MAX_PARALLEL];
+    int                    tokenCounts[STREAM_MAX_PARALLEL];
+    bool                   success = true;
+
+    memset(buffers, 0, sizeof(buffers));
+    for (int b = 0; b < count && success; b++) {
+        buffers[b] = (int *)malloc(2 * (size_t)capacity * sizeof(int));
+        if (!buffers[b]) {
+            fprintf(stderr, "Failed to allocate generation buffers\n");
+            success = false;
+            break;
+        }
+
+        /* The prompt lives in the second half, the output in the first */
+        int *prompt = buffers[b] + capacity;
+        int  length = lengths[b] < stream->chunkTokens ? lengths[b] : stream->chunkTokens;
+        memcpy(prompt, stream->prefix, stream->prefixLength * sizeof(int));
+        memcpy(prompt + stream->prefixLength, inputs[b], length * sizeof(int));
+
+        memset(&params[b], 0, sizeof(TinyAIGenerationParams));
+        params[b].maxTokens      = processor->maxOutputLength;
+        params[b].samplingMethod = TINYAI_SAMPLING_TOP_P;
+        params[b].temperature    = 0.7f;
+        params[b].topP           = 0.9f;
+        params[b].promptTokens   = prompt;
+        params[b].promptLength   = stream->prefixLength + length;
+    }
+
+    if (success && tinyaiGenerateTextBatch(processor->model, params, count, buffers, capacity,
+                                           tokenCounts) != 0) {
+        fprintf(stderr, "Failed to generate chunk outputs\n");
+        success = false;
+    }
+
+    for (int b = 0; b < count; b++) {
+        outputs[b].tokens = NULL;
+        outputs[b].count  = 0;
+        if (success) {
+            int  generated = tokenCounts[b] - params[b].promptLength;
+            int *tokens    = buffers[b] + params[b].promptLength;
+            while (generated > 0 && tokens[generated - 1] == TINYAI_TOKEN_EOS) {
+                generated--;
+            }
+
+            /* Keep the generated tokens at the start of their buffer */
+            memmove(buffers[b], tokens, (generated > 0 ? generated : 0) * sizeof(int));
+            outputs[b].tokens = buffers[b];
+            outputs[b].count  = generated > 0 ? generated : 0;
+        }
+        else {
+            free(buffers[b]);
+        }
+    }
+
+    return success;
+}
+
+/**
+ * Merge outputs into one by running the prompt over their concatenation
+ *
+ * Frees the inputs.
+ */
+static bool streamMerge(DocumentStream *stream, StreamOutput *inputs, int count,
+                        StreamOutput *merged)
+{
+    int *joined = (int *)malloc((size_t)stream->chunkTokens * sizeof(int));
+    int  length = 0;
+    for (int i = 0; i < count && joined; i++) {
+        int take = inputs[i].count < stream->chunkTokens - length
+                       ? inputs[i].count
+                       : stream->chunkTokens - length;
+        memcpy(joined + length, inputs[i].tokens, take * sizeof(int));
+        length += take;
+    }
+    for (int i = 0; i < count; i++) {
+        free(inputs[i].tokens);
+        inputs[i].tokens = NULL;
+    }
+    if (!joined) {
+        fprintf(stderr, "Failed to allocate merge buffer\n");
+        return false;
+    }
+
+    const int *input   = joined;
+    bool       success = streamGenerate(stream, &input, &length, 1, merged);
+    free(joined);
+    stream->stats.merges++;
+    return success;
+}
+
+/**
+ * Add an output to a level of the merge tree, merging the level once full
+ */
+static bool streamPushOutput(DocumentStream *stream, int level, StreamOutput output)
+{
+    while (true) {
+        if (level >= STREAM_MAX_LEVELS) {
+            fprintf(stderr, "Document too large for the merge tree\n");
+            free(output.tokens);
+            return false;
+        }
+        if (!stream->levels[level]) {
+            stream->levels[level] =
+                (StreamOutput *)malloc((size_t)stream->fanIn * sizeof(StreamOutput));
+            if (!stream->levels[level]) {
+                free(output.tokens);
+                return false;
+            }
+        }
+        if (level + 1 > stream->stats.mergeLevels) {
+            stream->stats.mergeLevels = level + 1;
+        }
+
+        stream->levels[level][stream->levelCounts[level]++] = output;
+        if (stream->levelCounts[level] < stream->fanIn) {
+            return true;
+        }
+
+        /* Full: merge the level into one output of the next */
+        stream->levelCounts[level] = 0;
+        if (!streamMerge(stream, stream->levels[level], stream->fanIn, &output)) {
+            return false;
+        }
+        level++;
+    }
+}
+
+/**
+ * Classify, summarize or extract from a run of document tokens
+ */
+static bool streamProcessTokens(DocumentStream *stream, const int *tokens, int count)
+{
+    TinyAIDocumentProcessor *processor = stream->processor;
+
+    while (count > 0) {
+        const int *inputs[STREAM_MAX_PARALLEL];
+        int        lengths[STREAM_MAX_PARALLEL];
+        int        batch = 0;
+        while (batch < stream->parallel && count > 0) {
+            lengths[batch] = count < stream->chunkTokens ? count : stream->chunkTokens;
+            inputs[batch]  = tokens;
+            tokens += lengths[batch];
+            count -= lengths[batch];
+            batch++;
+        }
+        stream->stats.chunks += batch;
+        stream->stats.batches++;
+
+        if (processor->mode == TINYAI_DOC_MODE_CLASSIFY) {
+            /* Class probabilities of each chunk, weighted by its length */
+            for (int b = 0; b < batch; b++) {
+                if (tinyaiModelForward(processor->model, inputs[b], lengths[b], stream->logits) !=
+                    0) {
+                    fprintf(stderr, "Failed to run model forward pass\n");
+                    return false;
+                }
+                float logSumExp = tinyaiSimdLogSumExp(stream->logits, processor->numClasses);
+                for (int c = 0; c < processor->numClasses; c++) {
+                    stream->classSums[c] += lengths[b] * exp(stream->logits[c] - logSumExp);
+                }
+                stream->classWeight += lengths[b];
+            }
+            continue;
+        }
+
+        StreamOutput outputs[STREAM_MAX_PARALLEL];
+        if (!streamGenerate(stream, inputs, lengths, batch, outputs)) {
+            return false;
+        }
+        for (int b = 0; b < batch; b++) {
+            if (!streamPushOutput(stream, 0, outputs[b])) {
+                for (int rest = b + 1; rest < batch; rest++) {
+                    free(outputs[rest].tokens);
+                }
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Merge what is left of every level into the final output
+ */
+static bool streamFinish(DocumentStream *stream, StreamOutput *final)
+{
+    StreamOutput carry     = {NULL, 0};
+    bool         haveCarry = false;
+
+    for (int level = 0; level < STREAM_MAX_LEVELS; level++) {
+        int count = stream->levelCounts[level];
+        if (count == 0 && !haveCarry) {
+            continue;
+        }
+
+        /* The carry from below comes after this level's older outputs */
+        if (haveCarry) {
+            stream->levels[level][count++] = carry;
+            haveCarry                      = false;
+        }
+        stream->levelCounts[level] = 0;
+
+        /* A single output with nothing above it is the result */
+        bool above = false;
+        for (int next = level + 1; next < STREAM_MAX_LEVELS; next++) {
+            above = above || stream->levelCounts[next] > 0;
+        }
+        if (count == 1 && !above) {
+            *final = stream->levels[level][0];
+            return true;
+        }
+        if (count == 1) {
+            carry = stream->levels[level][0];
+        }
+        else if (!streamMerge(stream, stream->levels[level], count, &carry)) {
+            return false;
+        }
+        haveCarry = true;
+
+        /* The merge tree grows one level for the carry */
+        if (level + 1 < STREAM_MAX_LEVELS && !stream->levels[level + 1]) {
+            stream->levels[level + 1] =
+                (StreamOutput *)malloc((size_t)(stream->fanIn + 1) * sizeof(StreamOutput));
+            if (!stream->levels[level + 1]) {
+                free(carry.tokens);
+                return false;
+            }
+        }
+    }
+
+    free(carry.tokens);
+    return false;
+}
+
+/**
+ * Process a document file of any size with bounded memory
+ */
+bool tinyaiDocumentProcessFileStreaming(TinyAIDocumentProcessor          *processor,
+                                        const char                       *filePath,
+                                        const TinyAIDocumentStreamConfig *config,
+                                        char *outputBuffer, int outputSize,
+                                        TinyAIDocumentStreamStats *stats)
+{
+    if (!processor || !filePath || !outputBuffer || outputSize <= 0) {
+        return false;
+    }
+
+    TinyAIDocumentStreamConfig defaults;
+    if (!config) {
+        tinyaiDocumentStreamConfigDefault(&defaults);
+        config = &defaults;
+    }
+
+    /* Prompt put before every chunk and merge */
+    const char *promptText = NULL;
+    char       *ownedPrompt = NULL;
+    if (processor->mode == TINYAI_DOC_MODE_SUMMARIZE) {
+        promptText = "Summarize the following text:\n\n";
+    }
+    else if (processor->mode == TINYAI_DOC_MODE_EXTRACT_INFO) {
+        if (!config->prompt) {
+            snprintf(outputBuffer, outputSize, "Error: Extraction requires a prompt.");
+            return false;
+        }
+        size_t length = strlen(config->prompt) + strlen("\n\nDocument:\n\n") + 1;
+        ownedPrompt   = (char *)malloc(length);
+        if (!ownedPrompt) {
+            return false;
+        }
+        snprintf(ownedPrompt, length, "%s\n\nDocument:\n\n", config->prompt);
+        promptText = ownedPrompt;
+    }
+    else if (processor->numClasses <= 0) {
+        snprintf(outputBuffer, outputSize, "Error: Classification requires class labels.");
+        return false;
+    }
+
+    DocumentStream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.processor = processor;
+    if (promptText) {
+        int maxPrompt = (int)strlen(promptText) + 1;
+        stream.prefix = (int *)malloc(maxPrompt * sizeof(int));
+        if (stream.prefix) {
+            stream.prefixLength =
+                tinyaiEncodeText(processor->tokenizer, promptText, stream.prefix, maxPrompt);
+        }
+    }
+    free(ownedPrompt);
+
+    /* Chunks fill the input window after the prompt */
+    int maxInput       = processor->maxInputLength > 0 ? processor->maxInputLength : 512;
+    stream.chunkTokens = config->chunkTokens > 0 ? config->chunkTokens
+                                                 : maxInput - stream.prefixLength;
+    if (stream.chunkTokens < 1) {
+        stream.chunkTokens = 1;
+    }
+    stream.parallel = config->parallelChunks > 0 ? config->parallelChunks : STREAM_DEFAULT_PARALLEL;
+    if (stream.parallel > STREAM_MAX_PARALLEL) {
+        stream.parallel = STREAM_MAX_PARALLEL;
+    }
+    int outputTokens = processor->maxOutputLength > 0 ? processor->maxOutputLength : 1;
+    stream.fanIn = config->mergeFanIn > 0 ? config->mergeFanIn : stream.chunkTokens / outputTokens;
+    if (stream.fanIn < 2) {
+        stream.fanIn = 2;
+    }
+
+    size_t readBytes   = config->readBytes > 0 ? config->readBytes : STREAM_DEFAULT_READ_BYTES;
+    size_t pendingSize = (size_t)stream.parallel * stream.chunkTokens + readBytes;
+    FILE  *file        = fopen(filePath, "rb");
+    char  *block       = (char *)malloc(readBytes + 1);
+    int   *blockTokens = (int *)malloc((readBytes + 1) * sizeof(int));
+    int   *pending     = (int *)malloc(pendingSize * sizeof(int));
+    if (processor->mode == TINYAI_DOC_MODE_CLASSIFY) {
+        uint32_t vocabSize =
+            processor->model->layers[processor->model->layerCount - 1].outputSize;
+        stream.logits    = (float *)malloc(vocabSize * sizeof(float));
+        stream.classSums = (double *)calloc(processor->numClasses, sizeof(double));
+    }
+
+    bool success = file && block && blockTokens && pending && (!promptText || stream.prefix) &&
+                   (processor->mode != TINYAI_DOC_MODE_CLASSIFY ||
+                    (stream.logits && stream.classSums));
+    if (!file) {
+        fprintf(stderr, "Failed to open file: %s\n", filePath);
+    }
+    else if (!success) {
+        fprintf(stderr, "Failed to allocate streaming buffers\n");
+    }
+
+    /* Read, tokenize once and process the document a block at a time */
+    size_t carry        = 0;
+    size_t pendingCount = 0;
+    size_t batchTokens  = (size_t)stream.parallel * stream.chunkTokens;
+    bool   atEnd        = false;
+    while (success && !atEnd) {
+        size_t wanted = readBytes - carry;
+        size_t got    = fread(block + carry, 1, wanted, file);
+        size_t size   = carry + got;
+        atEnd         = got < wanted;
+        stream.stats.bytesRead += got;
+
+        /* Cut after the last whitespace, which ends a word and encodes to nothing, so
+         * tokenizing block by block gives the tokens of the whole document */
+        size_t split = size;
+        if (!atEnd) {
+            while (split > 0 && !isspace((unsigned char)block[split - 1])) {
+                split--;
+            }
+            if (split == 0) {
+                split = size; /* A word longer than a block */
+            }
+        }
+
+        char saved   = block[split];
+        block[split] = '\0';
+        const char *text = block;
+        int         offsets[2];
+        int count = tinyaiEncodeTextBatch(processor->tokenizer, &text, 1, blockTokens,
+                                          (int)(readBytes + 1), offsets);
+        block[split] = saved;
+        if (count < 0) {
+            fprintf(stderr, "Failed to tokenize document\n");
+            success = false;
+            break;
+        }
+
+        memcpy(pending + pendingCount, blockTokens, count * sizeof(int));
+        pendingCount += count;
+        stream.stats.tokens += count;
+        if (pendingCount > stream.stats.peakTokens) {
+            stream.stats.peakTokens = pendingCount;
+        }
+        carry = size - split;
+        memmove(block, block + split, carry);
+
+        /* Process whole batches of chunks; the rest waits for more tokens */
+        size_t ready = atEnd ? pendingCount : pendingCount - pendingCount % batchTokens;
+        if (ready > 0) {
+            success = streamProcessTokens(&stream, pending, (int)ready);
+            memmove(pending, pending + ready, (pendingCount - ready) * sizeof(int));
+            pendingCount -= ready;
+        }
+    }
+
+    if (success && stream.stats.chunks == 0) {
+        snprintf(outputBuffer, outputSize, "Error: The document is empty.");
+        success = false;
+    }
+
+    /* Merge the chunk results */
+    if (success && processor->mode == TINYAI_DOC_MODE_CLASSIFY) {
+        TinyAIDocumentClassResult results[STREAM_MAX_RESULTS];
+        int numResults = processor->numClasses < STREAM_MAX_RESULTS ? processor->numClasses
+                                                                    : STREAM_MAX_RESULTS;
+        for (int i = 0; i < numResults; i++) {
+            results[i].classId    = -1;
+            results[i].confidence = -1.0f;
+        }
+        for (int c = 0; c < processor->numClasses; c++) {
+            float probability = (float)(stream.classSums[c] / stream.classWeight);
+            int   position    = numResults;
+            while (position > 0 && probability > results[position - 1].confidence) {
+                position--;
+            }
+            if (position < numResults) {
+                memmove(&results[position + 1], &results[position],
+                        (numResults - position - 1) * sizeof(TinyAIDocumentClassResult));
+                results[position].classId    = c;
+                results[position].confidence = probability;
+                results[position].label = processor->classLabels ? processor->classLabels[c] : NULL;
+            }
+        }
+        formatClassResults(results, numResults, outputBuffer, outputSize);
+    }
+    else if (success) {
+        StreamOutput final = {NULL, 0};
+        success            = streamFinish(&stream, &final);
+        if (success) {
+            tinyaiDecodeTokens(processor->tokenizer, final.tokens, final.count, outputBuffer,
+                               outputSize);
+        }
+        free(final.tokens);
+    }
+
+    /* Clean up */
+    for (int level = 0; level < STREAM_MAX_LEVELS; level++) {
+        if (stream.levels[level]) {
+            for (int i = 0; i < stream.levelCounts[level]; i++) {
+                free(stream.levels[level][i].tokens);
+            }
+            free(stream.levels[level]);
+        }
+    }
+    if (file) {
+        fclose(file);
+    }
+    free(block);
+    free(blockTokens);
+    free(pending);
+    free(stream.prefix);
+    free(stream.logits);
+    free(stream.classSums);
+
+    if (stats) {
+        *stats = stream.stats;
+    }
+    return success;
+}
+
 /**
  * Get memory usage statistics
  */
@@ -43,6 +43,30 @@ typedef struct {
     const char                **classLabels;     /* Class labels for classification mode */
 } TinyAIDocumentProcessorConfig;
 
+/**
+ * Streaming document processing configuration
+ */
+typedef struct {
+    size_t      readBytes;      /* Bytes read from the file at a time (0 for 1 MB) */
+    int         chunkTokens;    /* Document tokens per chunk (0 for what fits in maxInputLength) */
+    int         parallelChunks; /* Chunks summarized in one batched pass (0 for 4) */
+    int         mergeFanIn;     /* Summaries merged into one at each level (0 for what fits) */
+    const char *prompt;         /* Extraction prompt (required for TINYAI_DOC_MODE_EXTRACT_INFO) */
+} TinyAIDocumentStreamConfig;
+
+/**
+ * Streaming document processing statistics
+ */
+typedef struct {
+    size_t bytesRead;   /* Bytes read from the file */
+    size_t tokens;      /* Document tokens, each encoded once */
+    size_t peakTokens;  /* Most document tokens buffered at once */
+    int    chunks;      /* Chunks classified, summarized or extracted from */
+    int    batches;     /* Batched passes over chunks */
+    int    merges;      /* Passes merging summaries */
+    int    mergeLevels; /* Levels of the merge tree */
+} TinyAIDocumentStreamStats;
+
 /**
  * Document processor handle
  */
@@ -96,6 +120,41 @@ bool tinyaiDocumentProcessFile(TinyAIDocumentProcessor *processor, const char *f
 bool tinyaiDocumentProcessText(TinyAIDocumentProcessor *processor, const char *text,
                                char *outputBuffer, int outputSize);
 
+/**
+ * Initialize a streaming configuration with default values
+ *
+ * @param config Configuration to initialize
+ */
+void tinyaiDocumentStreamConfigDefault(TinyAIDocumentStreamConfig *config);
+
+/**
+ * Process a document file of any size with bounded memory
+ *
+ * The file is read a block at a time and every block is tokenized once,
+ * split at whitespace so the tokens match tokenizing the whole file. The
+ * tokens are cut into chunks that fit the model. To classify, each chunk is
+ * classified and the class probabilities are averaged, weighted by chunk
+ * length. To summarize or extract, chunks are processed parallelChunks at a
+ * time in one batched generation pass. Their outputs are then merged
+ * hierarchically: every mergeFanIn outputs of one level are summarized (or
+ * extracted from again) into one output of the next level. Memory depends on
+ * the chunk size, the batch and the depth of the merge tree, not on the size
+ * of the document.
+ *
+ * @param processor Processor to use
+ * @param filePath Path to document file
+ * @param config Streaming configuration (NULL for defaults)
+ * @param outputBuffer Buffer to store output (must be pre-allocated)
+ * @param outputSize Size of output buffer
+ * @param stats Optional output parameter for statistics
+ * @return True on success, false on failure
+ */
+bool tinyaiDocumentProcessFileStreaming(TinyAIDocumentProcessor          *processor,
+                                        const char                       *filePath,
+                                        const TinyAIDocumentStreamConfig *config,
+                                        char *outputBuffer, int outputSize,
+                                        TinyAIDocumentStreamStats *stats);
+
 /**
  * Classify a document
  *
@@ -63,6 +63,8 @@ void print_usage(const char *progname)
     printf("  --max-output <n>     Maximum output length in tokens (default: 256)\n");
     printf("  --simd               Enable SIMD acceleration\n");
     printf("  --quantized          Use 4-bit quantization\n");
+    printf("  --stream             Process the file in chunks with bounded memory\n");
+    printf("  --parallel <n>       Chunks processed per batched pass when streaming (default: 4)\n");
     printf("  --help               Show this help message\n");
 }
 
@@ -143,6 +145,8 @@ int main(int argc, char *argv[])
     bool                        use_simd          = false;
     bool                        use_quantization  = false;
     bool                        mode_set          = false;
+    bool                        stream            = false;
+    int                         parallel_chunks   = 0;
 
     /* Parse command line arguments */
     for (int i = 1; i < argc; i++) {
@@ -177,6 +181,12 @@ int main(int argc, char *argv[])
         else if (strcmp(argv[i], "--quantized") == 0) {
             use_quantization = true;
         }
+        else if (strcmp(argv[i], "--stream") == 0) {
+            stream = true;
+        }
+        else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            parallel_chunks = atoi(argv[++i]);
+        }
         else if (strcmp(argv[i], "classify") == 0) {
             mode     = TINYAI_DOC_MODE_CLASSIFY;
             mode_set = true;
@@ -281,7 +291,27 @@ int main(int argc, char *argv[])
 
     /* Process the document based on the mode */
     bool success = false;
-    if (mode == TINYAI_DOC_MODE_EXTRACT_INFO) {
+    if (stream) {
+        TinyAIDocumentStreamConfig stream_config;
+        TinyAIDocumentStreamStats  stream_stats;
+        tinyaiDocumentStreamConfigDefault(&stream_config);
+        stream_config.parallelChunks = parallel_chunks;
+        stream_config.prompt         = extraction_prompt;
+
+        printf("Streaming document: %s\n", document_path);
+        success = tinyaiDocumentProcessFileStreaming(processor, document_path, &stream_config,
+                                                     output_buffer, MAX_OUTPUT_LENGTH,
+                                                     &stream_stats);
+        printf("Stream statistics:\n");
+        printf("  Read: %.2f MB, %zu tokens (at most %zu buffered)\n",
+               stream_stats.bytesRead / (1024.0 * 1024.0), stream_stats.tokens,
+               stream_stats.peakTokens);
+        printf("  Chunks: %d in %d batches\n", stream_stats.chunks, stream_stats.batches);
+        if (mode != TINYAI_DOC_MODE_CLASSIFY) {
+            printf("  Merges: %d over %d levels\n", stream_stats.merges, stream_stats.mergeLevels);
+        }
+    }
+    else if (mode == TINYAI_DOC_MODE_EXTRACT_INFO) {
         printf("Extracting information from %s using prompt: \"%s\"\n", document_path,
                extraction_prompt);
         success =
@@ -7,6 +7,7 @@
  */
 
 #include "media_tagger.h"
+#include "tag_pipeline.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,26 +42,21 @@ void print_usage(const char *progname)
     printf("  --quantized               Use 4-bit quantization for models\n");
     printf("  --simd                    Use SIMD acceleration\n");
     printf("  --batch <directory>       Process all supported files in directory\n");
+    printf("  --decode-threads <n>      Decoder threads for --batch (default: half the cores)\n");
+    printf("  --retag                   Tag files in --batch even if their tags are up to date\n");
+    printf("  --dedup <file>            Reuse tags of near-duplicate images recorded in file\n");
+    printf("  --dedup-distance <n>      Hash bits near duplicates may differ in (default: %d)\n",
+           TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE);
     printf("  --help                    Show this help message\n");
 }
 
-/* Process a single file */
-bool process_file(TinyAIMediaTagger *tagger, const char *filepath, const char *outputDir,
-                  const char *format, bool generateDescription)
+/* Print, describe and save the tags of a file, then free them */
+void report_tags(TinyAIMediaTagger *tagger, const char *filepath, TinyAITag *tags, int numTags,
+                 TinyAIMediaType mediaType, const char *outputDir, const char *format,
+                 bool generateDescription)
 {
-    TinyAITag       tags[MAX_TAGS];
-    char            outputPath[MAX_PATH_LENGTH];
-    char            description[MAX_DESCRIPTION_LENGTH];
-    TinyAIMediaType mediaType;
-
-    printf("Processing: %s\n", filepath);
-
-    /* Tag the file */
-    int numTags = tinyaiMediaTaggerTagFile(tagger, filepath, tags, MAX_TAGS, &mediaType);
-    if (numTags <= 0) {
-        fprintf(stderr, "Error: Failed to tag file %s\n", filepath);
-        return false;
-    }
+    char outputPath[MAX_PATH_LENGTH];
+    char description[MAX_DESCRIPTION_LENGTH];
 
     printf("Identified as: %s\n", mediaType == TINYAI_MEDIA_TYPE_IMAGE   ? "Image"
                                   : mediaType == TINYAI_MEDIA_TYPE_AUDIO ? "Audio"
@@ -104,10 +100,95 @@ bool process_file(TinyAIMediaTagger *tagger, const char *filepath, const char *o
 
     /* Free tags */
     tinyaiMediaTaggerFreeTags(tags, numTags);
+}
+
+/* Process a single file */
+bool process_file(TinyAIMediaTagger *tagger, const char *filepath, const char *outputDir,
+                  const char *format, bool generateDescription)
+{
+    TinyAITag       tags[MAX_TAGS];
+    TinyAIMediaType mediaType;
+
+    printf("Processing: %s\n", filepath);
 
+    /* Tag the file */
+    int numTags = tinyaiMediaTaggerTagFile(tagger, filepath, tags, MAX_TAGS, &mediaType);
+    if (numTags <= 0) {
+        fprintf(stderr, "Error: Failed to tag file %s\n", filepath);
+        return false;
+    }
+
+    report_tags(tagger, filepath, tags, numTags, mediaType, outputDir, format,
+                generateDescription);
     return true;
 }
 
+/* Process a batch of image files with one pass through the image model */
+int process_image_batch(TinyAIMediaTagger *tagger, char paths[][MAX_PATH_LENGTH], int count,
+                        const char *outputDir, const char *format, bool generateDescription)
+{
+    TinyAIImage *images[TINYAI_IMAGE_MAX_BATCH];
+    const char  *imagePaths[TINYAI_IMAGE_MAX_BATCH];
+    int          numTags[TINYAI_IMAGE_MAX_BATCH];
+    int          numImages      = 0;
+    int          filesProcessed = 0;
+
+    /* Load the images */
+    for (int i = 0; i < count; i++) {
+        printf("Processing: %s\n", paths[i]);
+        images[numImages] = tinyaiImageLoadFromFile(paths[i]);
+        if (!images[numImages]) {
+            fprintf(stderr, "Error: Failed to load image from %s\n", paths[i]);
+            continue;
+        }
+        imagePaths[numImages++] = paths[i];
+    }
+    if (numImages == 0) {
+        return 0;
+    }
+
+    /* Tag them together */
+    TinyAITag *tags = (TinyAITag *)malloc(numImages * MAX_TAGS * sizeof(TinyAITag));
+    if (tags && tinyaiMediaTaggerTagImages(tagger, (const TinyAIImage *const *)images, numImages,
+                                           tags, MAX_TAGS, numTags) == 0) {
+        for (int i = 0; i < numImages; i++) {
+            if (numTags[i] <= 0) {
+                fprintf(stderr, "Error: Failed to tag file %s\n", imagePaths[i]);
+                continue;
+            }
+            report_tags(tagger, imagePaths[i], tags + i * MAX_TAGS, numTags[i],
+                        TINYAI_MEDIA_TYPE_IMAGE, outputDir, format, generateDescription);
+            filesProcessed++;
+        }
+    }
+    else {
+        fprintf(stderr, "Error: Failed to tag image batch\n");
+    }
+
+    /* Clean up */
+    free(tags);
+    for (int i = 0; i < numImages; i++) {
+        tinyaiImageFree(images[i]);
+    }
+
+    return filesProcessed;
+}
+
+/* Queue an image file for batched tagging, running the batch once it is full */
+int queue_image(TinyAIMediaTagger *tagger, char paths[][MAX_PATH_LENGTH], int *count,
+                const char *filepath, const char *outputDir, const char *format,
+                bool generateDescription)
+{
+    snprintf(paths[(*count)++], MAX_PATH_LENGTH, "%s", filepath);
+    if (*count < TINYAI_IMAGE_MAX_BATCH) {
+        return 0;
+    }
+
+    *count = 0;
+    return process_image_batch(tagger, paths, TINYAI_IMAGE_MAX_BATCH, outputDir, format,
+                               generateDescription);
+}
+
 /* Process all supported files in a directory */
 int process_directory(TinyAIMediaTagger *tagger, const char *dirPath, const char *outputDir,
                       const char *format, bool generateDescription)
@@ -115,6 +196,10 @@ int process_directory(TinyAIMediaTagger *tagger, const char *dirPath, const char
     char filepath[MAX_PATH_LENGTH];
     int  filesProcessed = 0;
 
+    /* Images are tagged in batches; other media one file at a time */
+    char imagePaths[TINYAI_IMAGE_MAX_BATCH][MAX_PATH_LENGTH];
+    int  numImagePaths = 0;
+
     printf("Processing directory: %s\n", dirPath);
 
 #ifdef _WIN32
@@ -145,7 +230,11 @@ int process_directory(TinyAIMediaTagger *tagger, const char *dirPath, const char
 
         /* Check if file has a supported extension */
         TinyAIMediaType type = tinyaiMediaTaggerDetectType(filepath);
-        if (type != TINYAI_MEDIA_TYPE_UNKNOWN) {
+        if (type == TINYAI_MEDIA_TYPE_IMAGE) {
+            filesProcessed += queue_image(tagger, imagePaths, &numImagePaths, filepath, outputDir,
+                                          format, generateDescription);
+        }
+        else if (type != TINYAI_MEDIA_TYPE_UNKNOWN) {
             if (process_file(tagger, filepath, outputDir, format, generateDescription)) {
                 filesProcessed++;
             }
@@ -175,7 +264,11 @@ int process_directory(TinyAIMediaTagger *tagger, const char *dirPath, const char
 
         /* Check if file has a supported extension */
         TinyAIMediaType type = tinyaiMediaTaggerDetectType(filepath);
-        if (type != TINYAI_MEDIA_TYPE_UNKNOWN) {
+        if (type == TINYAI_MEDIA_TYPE_IMAGE) {
+            filesProcessed += queue_image(tagger, imagePaths, &numImagePaths, filepath, outputDir,
+                                          format, generateDescription);
+        }
+        else if (type != TINYAI_MEDIA_TYPE_UNKNOWN) {
             if (process_file(tagger, filepath, outputDir, format, generateDescription)) {
                 filesProcessed++;
             }
@@ -185,6 +278,12 @@ int process_directory(TinyAIMediaTagger *tagger, const char *dirPath, const char
     closedir(dir);
 #endif
 
+    /* Tag the images left in the last batch */
+    if (numImagePaths > 0) {
+        filesProcessed += process_image_batch(tagger, imagePaths, numImagePaths, outputDir, format,
+                                              generateDescription);
+    }
+
     printf("Processed %d files from directory %s\n", filesProcessed, dirPath);
     return filesProcessed;
 }
@@ -200,12 +299,17 @@ int main(int argc, char *argv[])
     const char *output_dir           = NULL;
     const char *format               = "json";
     const char *batch_dir            = NULL;
+    const char *dedup_path           = NULL;
     float       threshold            = 0.5f;
     int         max_tags             = 20;
     bool        generate_description = false;
     bool        use_quantization     = false;
     bool        use_simd             = false;
+    bool        retag                = false;
+    int         decode_threads       = 0;
+    int         dedup_distance       = TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE;
     int         files_processed      = 0;
+    bool        batch_clean          = false; /* Pipeline ran without failures */
 
     /* Parse command line arguments */
     for (int i = 1; i < argc; i++) {
@@ -252,6 +356,18 @@ int main(int argc, char *argv[])
         else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
             batch_dir = argv[++i];
         }
+        else if (strcmp(argv[i], "--decode-threads") == 0 && i + 1 < argc) {
+            decode_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--retag") == 0) {
+            retag = true;
+        }
+        else if (strcmp(argv[i], "--dedup") == 0 && i + 1 < argc) {
+            dedup_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--dedup-distance") == 0 && i + 1 < argc) {
+            dedup_distance = atoi(argv[++i]);
+        }
     }
 
     /* Validate required arguments */
@@ -304,6 +420,19 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    /* Open the index of images tagged in earlier runs */
+    TinyAIDuplicateIndex *dedup_index = NULL;
+    if (dedup_path) {
+        dedup_index = tinyaiCreateDuplicateIndex(dedup_path);
+        if (!dedup_index || !tinyaiMediaTaggerSetDuplicateIndex(tagger, dedup_index,
+                                                                dedup_distance)) {
+            fprintf(stderr, "Error: Failed to use duplicate index %s\n", dedup_path);
+            tinyaiDestroyDuplicateIndex(dedup_index);
+            tinyaiMediaTaggerFree(tagger);
+            return 1;
+        }
+    }
+
     clock_t init_time = clock();
     printf("Initialization completed in %.2f seconds\n",
            (double)(init_time - start_time) / CLOCKS_PER_SEC);
@@ -318,8 +447,37 @@ int main(int argc, char *argv[])
     }
 
     /* Process files */
-    if (batch_dir) {
-        /* Process all files in directory */
+    if (batch_dir && !generate_description) {
+        /* Read, decode, tag and save files concurrently */
+        TinyAITagPipelineConfig pipelineConfig;
+        TinyAITagPipelineStats  pipelineStats;
+        tinyaiTagPipelineConfigDefault(&pipelineConfig);
+        pipelineConfig.outputDir     = output_dir;
+        pipelineConfig.format        = format;
+        pipelineConfig.maxTags       = MAX_TAGS;
+        pipelineConfig.decodeThreads = decode_threads;
+        pipelineConfig.skipTagged    = !retag;
+
+        printf("Processing directory: %s\n", batch_dir);
+        files_processed =
+            tinyaiMediaTaggerTagDirectory(tagger, batch_dir, &pipelineConfig, &pipelineStats);
+        if (files_processed < 0) {
+            files_processed = 0;
+        }
+        else {
+            batch_clean = pipelineStats.filesFailed == 0;
+            printf("Found %d files: %d tagged, %d up to date, %d failed (%d image batches)\n",
+                   pipelineStats.filesFound, pipelineStats.filesTagged,
+                   pipelineStats.filesSkipped, pipelineStats.filesFailed,
+                   pipelineStats.imageBatches);
+            printf("Stage time: read %.1f ms, decode %.1f ms, tag %.1f ms, write %.1f ms "
+                   "(%.1f ms wall)\n",
+                   pipelineStats.readMs, pipelineStats.decodeMs, pipelineStats.tagMs,
+                   pipelineStats.writeMs, pipelineStats.totalMs);
+        }
+    }
+    else if (batch_dir) {
+        /* Descriptions print with each file, so process them in turn */
         files_processed =
             process_directory(tagger, batch_dir, output_dir, format, generate_description);
     }
@@ -329,7 +487,8 @@ int main(int argc, char *argv[])
             /* Skip options and their values */
             if (argv[i][0] == '-') {
                 if (strcmp(argv[i], "--generate-description") != 0 &&
-                    strcmp(argv[i], "--quantized") != 0 && strcmp(argv[i], "--simd") != 0) {
+                    strcmp(argv[i], "--quantized") != 0 && strcmp(argv[i], "--simd") != 0 &&
+                    strcmp(argv[i], "--retag") != 0) {
                     i++; /* Skip option value */
                 }
                 continue;
@@ -346,9 +505,17 @@ int main(int argc, char *argv[])
     clock_t end_time = clock();
     printf("\nProcessed %d files in %.2f seconds\n", files_processed,
            (double)(end_time - start_time) / CLOCKS_PER_SEC);
+    if (dedup_index) {
+        TinyAIDuplicateIndexStats dedup_stats;
+        tinyaiDuplicateIndexGetStats(dedup_index, &dedup_stats);
+        printf("Duplicates: %llu exact, %llu near, %llu new (%d images indexed)\n",
+               (unsigned long long)dedup_stats.exactHits, (unsigned long long)dedup_stats.nearHits,
+               (unsigned long long)dedup_stats.misses, dedup_stats.numEntries);
+    }
 
     /* Clean up */
     tinyaiMediaTaggerFree(tagger);
+    tinyaiDestroyDuplicateIndex(dedup_index);
 
-    return files_processed > 0 ? 0 : 1;
+    return files_processed > 0 || batch_clean ? 0 : 1;
 }
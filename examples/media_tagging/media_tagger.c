@@ -32,10 +32,14 @@ struct TinyAIMediaTagger {
     TinyAIModel           *textModel;       /* Text generation model */
     TinyAITokenizer       *tokenizer;       /* Tokenizer */
     TinyAIMultimodalModel *multimodalModel; /* Multimodal model (optional) */
+    TinyAIEmbeddingCache  *embeddingCache;  /* Cache of image model outputs (not owned) */
+    TinyAIDuplicateIndex  *duplicateIndex;  /* Perceptual hashes of tagged images (not owned) */
+    char                  *imageWeights;    /* Image weights path, identifying cached outputs */
 
     /* Configuration */
     int               maxTags;             /* Maximum number of tags to generate */
     float             confidenceThreshold; /* Minimum confidence threshold */
+    int               duplicateDistance;   /* Hamming distance of near-duplicate images */
     TinyAITagCategory categories;          /* Tag categories to include */
     bool              useQuantization;     /* Whether to use quantization */
     bool              useSIMD;             /* Whether to use SIMD */
@@ -145,7 +149,8 @@ TinyAIMediaTagger *tinyaiMediaTaggerCreate(const TinyAIMediaTaggerConfig *config
         imageParams.useSIMD         = tagger->useSIMD;
 
         /* Create image model */
-        tagger->imageModel = tinyaiImageModelCreate(&imageParams);
+        tagger->imageModel       = tinyaiImageModelCreate(&imageParams);
+        tagger->imageWeights     = _strdup(config->imageWeightsPath);
         if (!tagger->imageModel) {
             fprintf(stderr, "Warning: Failed to create image model\n");
         }
@@ -210,6 +215,8 @@ void tinyaiMediaTaggerFree(TinyAIMediaTagger *tagger)
         tinyaiMultimodalModelFree(tagger->multimodalModel);
     }
 
+    free(tagger->imageWeights);
+
     /* Free tagger structure */
     free(tagger);
 }
@@ -247,6 +254,20 @@ TinyAIMediaType tinyaiMediaTaggerDetectType(const char *filepath)
     return TINYAI_MEDIA_TYPE_UNKNOWN;
 }
 
+/**
+ * Get the image size the image model takes
+ */
+bool tinyaiMediaTaggerGetImageSize(const TinyAIMediaTagger *tagger, int *width, int *height)
+{
+    if (!tagger || !width || !height) {
+        return false;
+    }
+
+    *width  = tagger->imageWidth;
+    *height = tagger->imageHeight;
+    return true;
+}
+
 /**
  * Set categories to include in tagging
  */
@@ -273,6 +294,37 @@ bool tinyaiMediaTaggerSetThreshold(TinyAIMediaTagger *tagger, float threshold)
     return true;
 }
 
+/**
+ * Set the embedding cache for image outputs
+ */
+bool tinyaiMediaTaggerSetEmbeddingCache(TinyAIMediaTagger *tagger, TinyAIEmbeddingCache *cache)
+{
+    if (!tagger) {
+        return false;
+    }
+
+    tagger->embeddingCache = cache;
+    if (tagger->multimodalModel) {
+        tinyaiMultimodalModelSetEmbeddingCache(tagger->multimodalModel, cache);
+    }
+    return true;
+}
+
+/**
+ * Set the perceptual-hash index for near-duplicate images
+ */
+bool tinyaiMediaTaggerSetDuplicateIndex(TinyAIMediaTagger *tagger, TinyAIDuplicateIndex *index,
+                                        int maxDistance)
+{
+    if (!tagger || maxDistance < 0) {
+        return false;
+    }
+
+    tagger->duplicateIndex    = index;
+    tagger->duplicateDistance = maxDistance;
+    return true;
+}
+
 /**
  * Read text from a file
  */
@@ -325,8 +377,12 @@ int tinyaiMediaTaggerTagFile(TinyAIMediaTagger *tagger, const char *filepath, Ti
     switch (type) {
     case TINYAI_MEDIA_TYPE_IMAGE:
         if (tagger->imageModel) {
-            /* Load image */
-            TinyAIImage *image = tinyaiImageLoadFromFile(filepath);
+            /* Load image; duplicates are found on a decode shrunk toward the model's size */
+            TinyAIImage *image =
+                tagger->duplicateIndex
+                    ? tinyaiImageLoadFromFileScaled(filepath, tagger->imageWidth,
+                                                    tagger->imageHeight)
+                    : tinyaiImageLoadFromFile(filepath);
             if (!image) {
                 fprintf(stderr, "Error: Failed to load image from %s\n", filepath);
                 return -1;
@@ -377,61 +433,184 @@ int tinyaiMediaTaggerTagFile(TinyAIMediaTagger *tagger, const char *filepath, Ti
 int tinyaiMediaTaggerTagImage(TinyAIMediaTagger *tagger, const TinyAIImage *image, TinyAITag *tags,
                               int maxTags)
 {
-    if (!tagger || !image || !tags || maxTags <= 0 || !tagger->imageModel) {
+    int numTags = -1;
+    if (!image || tinyaiMediaTaggerTagImages(tagger, &image, 1, tags, maxTags, &numTags) != 0) {
         return -1;
     }
+    return numTags;
+}
 
-    /* Preprocess image if needed */
-    TinyAIImage *processedImage = NULL;
-    if (image->width != tagger->imageWidth || image->height != tagger->imageHeight) {
-        processedImage = tinyaiImageResize(image, tagger->imageWidth, tagger->imageHeight);
-        if (!processedImage) {
-            fprintf(stderr, "Error: Failed to resize image\n");
-            return -1;
-        }
+/**
+ * Fill classification results from stored (class, confidence) pairs
+ */
+static void restoreResults(const TinyAIMediaTagger *tagger, const float *stored,
+                           TinyAIImageClassResult *results, int numClasses)
+{
+    for (int i = 0; i < numClasses; i++) {
+        results[i].classId    = (int)stored[2 * i];
+        results[i].confidence = stored[2 * i + 1];
+        results[i].label      = tinyaiImageModelGetLabel(tagger->imageModel, results[i].classId);
     }
-    else {
-        processedImage = tinyaiImageCopy(image);
-        if (!processedImage) {
-            fprintf(stderr, "Error: Failed to copy image\n");
-            return -1;
-        }
+}
+
+/**
+ * Tag a batch of images in one pass through the image model
+ */
+int tinyaiMediaTaggerTagImages(TinyAIMediaTagger *tagger, const TinyAIImage *const *images,
+                               int numImages, TinyAITag *tags, int maxTags, int *numTags)
+{
+    if (!tagger || !images || numImages <= 0 || !tags || maxTags <= 0 || !numTags ||
+        !tagger->imageModel) {
+        return -1;
     }
 
-    /* Allocate results array */
     int numClasses = maxTags < 20 ? maxTags : 20; /* Limit to reasonable number */
-    TinyAIImageClassResult *results =
-        (TinyAIImageClassResult *)malloc(numClasses * sizeof(TinyAIImageClassResult));
-    if (!results) {
-        fprintf(stderr, "Error: Failed to allocate classification results\n");
-        tinyaiImageFree(processedImage);
+
+    /* Results of every image, then the classifier's output for the cache misses */
+    TinyAIImageClassResult *results = (TinyAIImageClassResult *)malloc(
+        (size_t)numImages * numClasses * 2 * sizeof(TinyAIImageClassResult));
+    TinyAIImage **processed = (TinyAIImage **)calloc(numImages, sizeof(TinyAIImage *));
+    int          *missIndex = (int *)malloc(numImages * sizeof(int));
+    uint64_t     *hashes    = (uint64_t *)malloc(numImages * sizeof(uint64_t));
+    float        *cached    = (float *)malloc((size_t)numClasses * 2 * sizeof(float));
+    if (!results || !processed || !missIndex || !hashes || !cached) {
+        fprintf(stderr, "Error: Failed to allocate image batch\n");
+        free(results);
+        free(processed);
+        free(missIndex);
+        free(hashes);
+        free(cached);
         return -1;
     }
+    TinyAIImageClassResult *missResults = results + (size_t)numImages * numClasses;
 
-    /* Classify image */
-    int numResults =
-        tinyaiImageModelClassify(tagger->imageModel, processedImage, numClasses, results);
+    /* Serve images tagged before from the embedding cache, keyed on the original pixels
+     * so hits skip resizing as well. Entries are numClasses (class, confidence) pairs. */
+    uint64_t encoderHash = 0;
+    if (tagger->embeddingCache || tagger->duplicateIndex) {
+        int shape[3] = {tagger->imageWidth, tagger->imageHeight, numClasses};
+        encoderHash  = tinyaiEmbeddingCacheEncoderHash(tagger->imageWeights, shape, 3);
+    }
 
-    /* Convert classification results to tags */
-    int numTags = 0;
-    for (int i = 0; i < numResults && numTags < maxTags; i++) {
-        /* Skip tags below threshold */
-        if (results[i].confidence < tagger->confidenceThreshold) {
+    int status    = 0;
+    int numMisses = 0;
+    for (int n = 0; n < numImages && status == 0; n++) {
+        const TinyAIImage      *image     = images[n];
+        TinyAIImageClassResult *imageRows = results + (size_t)n * numClasses;
+        if (!image) {
+            status = -1;
+            break;
+        }
+
+        if (tagger->embeddingCache &&
+            tinyaiEmbeddingCacheLookup(tagger->embeddingCache,
+                                       tinyaiEmbeddingCacheKey(image, encoderHash), cached,
+                                       numClasses * 2) == 0) {
+            restoreResults(tagger, cached, imageRows, numClasses);
             continue;
         }
 
-        /* Create tag based on result */
-        tags[numTags] = createTag(results[i].label ? results[i].label : "unknown",
-                                  results[i].confidence, TINYAI_TAG_CATEGORY_OBJECT);
+        /* Near duplicates of images tagged before (resized, recompressed) reuse their results;
+           featureless images hash to 0 and are never matched */
+        if (tagger->duplicateIndex) {
+            hashes[n] = tinyaiDuplicateIndexHash(image);
+            if (hashes[n] != 0 &&
+                tinyaiDuplicateIndexLookup(tagger->duplicateIndex, hashes[n], encoderHash,
+                                           tagger->duplicateDistance, cached,
+                                           numClasses * 2) >= 0) {
+                restoreResults(tagger, cached, imageRows, numClasses);
+                continue;
+            }
+        }
 
-        numTags++;
+        /* Preprocess images if needed */
+        TinyAIImage *input;
+        if (image->width != tagger->imageWidth || image->height != tagger->imageHeight) {
+            input = tinyaiImageResize(image, tagger->imageWidth, tagger->imageHeight);
+            if (!input) {
+                fprintf(stderr, "Error: Failed to resize image\n");
+                status = -1;
+            }
+        }
+        else {
+            input = tinyaiImageCopy(image);
+            if (!input) {
+                fprintf(stderr, "Error: Failed to copy image\n");
+                status = -1;
+            }
+        }
+        processed[numMisses]   = input;
+        missIndex[numMisses++] = n;
+    }
+
+    /* Classify every image the cache missed with one batched pass */
+    if (status == 0 && numMisses > 0) {
+        int numResults = tinyaiImageModelClassifyBatch(
+            tagger->imageModel, (const TinyAIImage *const *)processed, numMisses, numClasses,
+            missResults);
+        if (numResults < 0) {
+            status = -1;
+        }
+
+        for (int m = 0; m < numMisses && status == 0; m++) {
+            TinyAIImageClassResult *imageRows = results + (size_t)missIndex[m] * numClasses;
+            for (int i = 0; i < numClasses; i++) {
+                if (i < numResults) {
+                    imageRows[i] = missResults[(size_t)m * numClasses + i];
+                }
+                else {
+                    imageRows[i].classId    = -1;
+                    imageRows[i].confidence = 0.0f;
+                    imageRows[i].label      = NULL;
+                }
+                cached[2 * i]     = (float)imageRows[i].classId;
+                cached[2 * i + 1] = imageRows[i].confidence;
+            }
+
+            if (tagger->embeddingCache) {
+                uint64_t key = tinyaiEmbeddingCacheKey(images[missIndex[m]], encoderHash);
+                tinyaiEmbeddingCacheInsert(tagger->embeddingCache, key, cached, numClasses * 2);
+            }
+            if (tagger->duplicateIndex && hashes[missIndex[m]] != 0) {
+                tinyaiDuplicateIndexInsert(tagger->duplicateIndex, hashes[missIndex[m]],
+                                           encoderHash, cached, numClasses * 2);
+            }
+        }
+    }
+
+    /* Convert classification results to tags */
+    for (int n = 0; n < numImages && status == 0; n++) {
+        const TinyAIImageClassResult *imageResults = results + (size_t)n * numClasses;
+        TinyAITag                    *imageTags    = tags + (size_t)n * maxTags;
+
+        numTags[n] = 0;
+        for (int i = 0; i < numClasses && numTags[n] < maxTags; i++) {
+            /* Skip padding and tags below threshold */
+            if (imageResults[i].classId < 0 ||
+                imageResults[i].confidence < tagger->confidenceThreshold) {
+                continue;
+            }
+
+            /* Create tag based on result */
+            imageTags[numTags[n]++] =
+                createTag(imageResults[i].label ? imageResults[i].label : "unknown",
+                          imageResults[i].confidence, TINYAI_TAG_CATEGORY_OBJECT);
+        }
     }
 
     /* Clean up */
+    for (int m = 0; m < numMisses; m++) {
+        if (processed[m]) {
+            tinyaiImageFree(processed[m]);
+        }
+    }
+    free(processed);
+    free(missIndex);
+    free(hashes);
+    free(cached);
     free(results);
-    tinyaiImageFree(processedImage);
 
-    return numTags;
+    return status;
 }
 
 /**
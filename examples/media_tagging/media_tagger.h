@@ -10,6 +10,7 @@
 #define TINYAI_MEDIA_TAGGER_H
 
 #include "../../models/image/image_model.h"
+#include "../../models/multimodal/duplicate_index.h"
 #include "../../models/multimodal/multimodal_model.h"
 #include "../../models/text/generate.h"
 #include "../../models/text/tokenizer.h"
@@ -105,6 +106,19 @@ void tinyaiMediaTaggerFree(TinyAIMediaTagger *tagger);
  */
 TinyAIMediaType tinyaiMediaTaggerDetectType(const char *filepath);
 
+/**
+ * Get the image size the image model takes
+ *
+ * Images of this size are tagged without resizing, so loaders can produce
+ * them directly.
+ *
+ * @param tagger Tagger to query
+ * @param width Output parameter for the image width
+ * @param height Output parameter for the image height
+ * @return true on success, false on failure
+ */
+bool tinyaiMediaTaggerGetImageSize(const TinyAIMediaTagger *tagger, int *width, int *height);
+
 /**
  * Set categories to include in tagging
  *
@@ -148,6 +162,55 @@ int tinyaiMediaTaggerTagFile(TinyAIMediaTagger *tagger, const char *filepath, Ti
 int tinyaiMediaTaggerTagImage(TinyAIMediaTagger *tagger, const TinyAIImage *image, TinyAITag *tags,
                               int maxTags);
 
+/**
+ * Tag a batch of images
+ *
+ * The images run through the image model together (see
+ * tinyaiImageModelClassifyBatch), which is much cheaper per image than
+ * tagging them one at a time.
+ *
+ * @param tagger Tagger to use
+ * @param images Images to tag
+ * @param numImages Number of images
+ * @param tags Array of numImages * maxTags tags; image i's start at tags[i * maxTags]
+ * @param maxTags Maximum number of tags to generate per image
+ * @param numTags Array receiving the number of tags generated for each image
+ * @return 0 on success, -1 on error
+ */
+int tinyaiMediaTaggerTagImages(TinyAIMediaTagger *tagger, const TinyAIImage *const *images,
+                               int numImages, TinyAITag *tags, int maxTags, int *numTags);
+
+/**
+ * Set the embedding cache for image outputs
+ *
+ * Images tagged before (by pixel content) then skip resizing and the image
+ * model. The cache may be shared with captioning and visual QA, since keys
+ * include the model, and must outlive the tagger.
+ *
+ * @param tagger Tagger to configure
+ * @param cache Embedding cache to use, or NULL to classify every image
+ * @return true on success, false on failure
+ */
+bool tinyaiMediaTaggerSetEmbeddingCache(TinyAIMediaTagger *tagger, TinyAIEmbeddingCache *cache);
+
+/**
+ * Set the perceptual-hash index for near-duplicate images
+ *
+ * Images whose perceptual hash is within maxDistance bits of an image tagged
+ * before (resized or recompressed copies) reuse its tags and skip resizing
+ * and the image model. Files are then decoded at about the model's input
+ * size, which keeps decoding cheap as well. The index must outlive the
+ * tagger.
+ *
+ * @param tagger Tagger to configure
+ * @param index Duplicate index to use, or NULL to classify every image
+ * @param maxDistance Largest Hamming distance that counts as a duplicate
+ *                    (TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE is a good start)
+ * @return true on success, false on failure
+ */
+bool tinyaiMediaTaggerSetDuplicateIndex(TinyAIMediaTagger *tagger, TinyAIDuplicateIndex *index,
+                                        int maxDistance);
+
 /**
  * Tag text content
  *
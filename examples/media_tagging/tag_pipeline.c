@@ -0,0 +1,979 @@
+/**
+ * @file tag_pipeline.c
+ * @brief Staged directory pipeline for the TinyAI media tagger
+ */
+
+#include "tag_pipeline.h"
+#include "../../utils/thread_pool.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <process.h>
+#include <windows.h>
+typedef HANDLE ThreadHandle;
+#else
+#include <dirent.h>
+#include <pthread.h>
+typedef pthread_t ThreadHandle;
+#endif
+
+/* Defaults */
+#define PIPELINE_DEFAULT_MAX_TAGS 20
+#define PIPELINE_MAX_DECODERS 32
+
+/* FNV-1a parameters */
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+/**
+ * File moving through the pipeline
+ */
+typedef struct {
+    char           *path;        /* Media file */
+    char           *tagPath;     /* Tag file */
+    TinyAIMediaType type;        /* Media type */
+    uint64_t        pathHash;    /* Hash of the tag file path, keying the manifest */
+    uint64_t        contentHash; /* Hash of the file contents */
+    unsigned char  *bytes;       /* File contents, NUL-terminated (reader to decoder) */
+    size_t          size;        /* Size of the contents */
+    TinyAIImage    *image;       /* Decoded image (decoder to tagger) */
+    char           *text;        /* Decoded text (decoder to tagger) */
+    TinyAITag      *tags;        /* Tags (tagger to writer) */
+    int             numTags;     /* Number of tags */
+} PipelineItem;
+
+/**
+ * Bounded queue between two stages
+ *
+ * Closes once every producer has finished; consumers then drain it.
+ */
+typedef struct {
+    PipelineItem **items;
+    int            capacity;
+    int            head;
+    int            count;
+    int            producers; /* Producers still running */
+#ifdef _WIN32
+    SRWLOCK            lock;
+    CONDITION_VARIABLE notEmpty;
+    CONDITION_VARIABLE notFull;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t  notEmpty;
+    pthread_cond_t  notFull;
+#endif
+} PipelineQueue;
+
+/**
+ * Content hashes recorded when tags were saved, by tag file path hash
+ *
+ * Open addressing; a path hash of 0 marks an empty slot.
+ */
+typedef struct {
+    uint64_t *keys;
+    uint64_t *values;
+    size_t    capacity;
+    size_t    count;
+} PipelineManifest;
+
+/**
+ * Pipeline state shared by the stages
+ */
+typedef struct {
+    TinyAIMediaTagger *tagger;
+    const char        *dirPath;
+    const char        *outputDir;
+    const char        *format;
+    int                maxTags;
+    bool               skipTagged;
+    int                imageWidth;
+    int                imageHeight;
+
+    PipelineQueue readQueue;    /* Reader to decoders */
+    PipelineQueue decodedQueue; /* Decoders to tagger */
+    PipelineQueue taggedQueue;  /* Tagger to writer */
+
+    PipelineManifest manifest;     /* Read by the reader only */
+    FILE            *manifestFile; /* Appended by the writer only */
+    bool             listFailed;   /* Directory could not be opened */
+
+    /* Statistics, shared by the decoders */
+    TinyAITagPipelineStats stats;
+    uint64_t               readNs;
+    uint64_t               decodeNs;
+    uint64_t               tagNs;
+    uint64_t               writeNs;
+#ifdef _WIN32
+    SRWLOCK statsLock;
+#else
+    pthread_mutex_t statsLock;
+#endif
+} Pipeline;
+
+/**
+ * Stage run on its own thread
+ */
+typedef struct {
+    Pipeline *pipeline;
+    void (*run)(Pipeline *pipeline);
+} StageThread;
+
+/**
+ * Get a monotonic time in nanoseconds
+ */
+static uint64_t getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        count;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)((double)count.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * FNV-1a hash of a byte range
+ */
+static uint64_t hashBytes(const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t             hash  = FNV_OFFSET;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Queue */
+
+static bool queueInit(PipelineQueue *queue, int capacity, int producers)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->items = (PipelineItem **)malloc((size_t)capacity * sizeof(PipelineItem *));
+    if (!queue->items) {
+        return false;
+    }
+    queue->capacity  = capacity;
+    queue->producers = producers;
+#ifdef _WIN32
+    InitializeSRWLock(&queue->lock);
+    InitializeConditionVariable(&queue->notEmpty);
+    InitializeConditionVariable(&queue->notFull);
+#else
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->notEmpty, NULL);
+    pthread_cond_init(&queue->notFull, NULL);
+#endif
+    return true;
+}
+
+static void queueDestroy(PipelineQueue *queue)
+{
+    if (!queue->items) {
+        return;
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->notEmpty);
+    pthread_cond_destroy(&queue->notFull);
+#endif
+    free(queue->items);
+    queue->items = NULL;
+}
+
+static void lockQueue(PipelineQueue *queue)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&queue->lock);
+#else
+    pthread_mutex_lock(&queue->lock);
+#endif
+}
+
+static void unlockQueue(PipelineQueue *queue)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&queue->lock);
+#else
+    pthread_mutex_unlock(&queue->lock);
+#endif
+}
+
+static void waitQueue(PipelineQueue *queue, bool forSpace)
+{
+#ifdef _WIN32
+    SleepConditionVariableSRW(forSpace ? &queue->notFull : &queue->notEmpty, &queue->lock,
+                              INFINITE, 0);
+#else
+    pthread_cond_wait(forSpace ? &queue->notFull : &queue->notEmpty, &queue->lock);
+#endif
+}
+
+static void wakeQueue(PipelineQueue *queue, bool space)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(space ? &queue->notFull : &queue->notEmpty);
+#else
+    pthread_cond_broadcast(space ? &queue->notFull : &queue->notEmpty);
+#endif
+}
+
+/**
+ * Add an item, waiting while the queue is full
+ */
+static void queuePush(PipelineQueue *queue, PipelineItem *item)
+{
+    lockQueue(queue);
+    while (queue->count == queue->capacity) {
+        waitQueue(queue, true);
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    wakeQueue(queue, false);
+    unlockQueue(queue);
+}
+
+/**
+ * Take an item, waiting while the queue is empty but still open
+ *
+ * Returns NULL once the queue is closed and drained, or at once if it is
+ * empty and wait is false.
+ */
+static PipelineItem *queuePop(PipelineQueue *queue, bool wait)
+{
+    PipelineItem *item = NULL;
+
+    lockQueue(queue);
+    while (wait && queue->count == 0 && queue->producers > 0) {
+        waitQueue(queue, false);
+    }
+    if (queue->count > 0) {
+        item        = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        wakeQueue(queue, true);
+    }
+    unlockQueue(queue);
+
+    return item;
+}
+
+/**
+ * Record that a producer has finished
+ */
+static void queueClose(PipelineQueue *queue)
+{
+    lockQueue(queue);
+    queue->producers--;
+    if (queue->producers <= 0) {
+        wakeQueue(queue, false);
+    }
+    unlockQueue(queue);
+}
+
+/* Statistics */
+
+static void lockStats(Pipeline *pipeline)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&pipeline->statsLock);
+#else
+    pthread_mutex_lock(&pipeline->statsLock);
+#endif
+}
+
+static void unlockStats(Pipeline *pipeline)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&pipeline->statsLock);
+#else
+    pthread_mutex_unlock(&pipeline->statsLock);
+#endif
+}
+
+/* Items */
+
+static void freeItem(PipelineItem *item)
+{
+    if (!item) {
+        return;
+    }
+    if (item->image) {
+        tinyaiImageFree(item->image);
+    }
+    if (item->tags) {
+        tinyaiMediaTaggerFreeTags(item->tags, item->numTags);
+        free(item->tags);
+    }
+    free(item->path);
+    free(item->tagPath);
+    free(item->bytes);
+    free(item->text);
+    free(item);
+}
+
+/**
+ * Drop an item that failed at some stage
+ */
+static void failItem(Pipeline *pipeline, PipelineItem *item, const char *reason)
+{
+    fprintf(stderr, "Error: Failed to %s %s\n", reason, item->path);
+    lockStats(pipeline);
+    pipeline->stats.filesFailed++;
+    unlockStats(pipeline);
+    freeItem(item);
+}
+
+/**
+ * Allocate "<dir>/<name><suffix>"
+ */
+static char *joinPath(const char *dir, const char *name, const char *suffix)
+{
+    size_t length = strlen(dir) + strlen(name) + strlen(suffix) + 2;
+    char  *path   = (char *)malloc(length);
+    if (path) {
+#ifdef _WIN32
+        snprintf(path, length, "%s\\%s%s", dir, name, suffix);
+#else
+        snprintf(path, length, "%s/%s%s", dir, name, suffix);
+#endif
+    }
+    return path;
+}
+
+/**
+ * Read a whole file, NUL-terminated so text needs no copy
+ */
+static unsigned char *readFileBytes(const char *filepath, size_t *size)
+{
+    FILE *file = fopen(filepath, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (fileSize < 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    unsigned char *bytes = (unsigned char *)malloc((size_t)fileSize + 1);
+    if (!bytes) {
+        fclose(file);
+        return NULL;
+    }
+
+    *size        = fread(bytes, 1, (size_t)fileSize, file);
+    bytes[*size] = '\0';
+    fclose(file);
+    return bytes;
+}
+
+/* Manifest */
+
+static bool manifestGrow(PipelineManifest *manifest)
+{
+    size_t    capacity = manifest->capacity ? manifest->capacity * 2 : 1024;
+    uint64_t *keys     = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+    uint64_t *values   = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return false;
+    }
+
+    for (size_t i = 0; i < manifest->capacity; i++) {
+        if (manifest->keys[i] == 0) {
+            continue;
+        }
+        size_t slot = manifest->keys[i] & (capacity - 1);
+        while (keys[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        keys[slot]   = manifest->keys[i];
+        values[slot] = manifest->values[i];
+    }
+
+    free(manifest->keys);
+    free(manifest->values);
+    manifest->keys     = keys;
+    manifest->values   = values;
+    manifest->capacity = capacity;
+    return true;
+}
+
+/**
+ * Record a content hash, replacing an earlier one for the same path
+ */
+static bool manifestPut(PipelineManifest *manifest, uint64_t key, uint64_t value)
+{
+    if ((manifest->count + 1) * 2 > manifest->capacity && !manifestGrow(manifest)) {
+        return false;
+    }
+
+    size_t slot = key & (manifest->capacity - 1);
+    while (manifest->keys[slot] != 0 && manifest->keys[slot] != key) {
+        slot = (slot + 1) & (manifest->capacity - 1);
+    }
+    if (manifest->keys[slot] == 0) {
+        manifest->keys[slot] = key;
+        manifest->count++;
+    }
+    manifest->values[slot] = value;
+    return true;
+}
+
+static bool manifestGet(const PipelineManifest *manifest, uint64_t key, uint64_t *value)
+{
+    if (manifest->capacity == 0) {
+        return false;
+    }
+
+    size_t slot = key & (manifest->capacity - 1);
+    while (manifest->keys[slot] != 0) {
+        if (manifest->keys[slot] == key) {
+            *value = manifest->values[slot];
+            return true;
+        }
+        slot = (slot + 1) & (manifest->capacity - 1);
+    }
+    return false;
+}
+
+/**
+ * Load the manifest of the output directory; later lines win
+ */
+static void manifestLoad(PipelineManifest *manifest, const char *filepath)
+{
+    FILE *file = fopen(filepath, "r");
+    if (!file) {
+        return;
+    }
+
+    unsigned long long key, value;
+    while (fscanf(file, "%16llx %16llx", &key, &value) == 2) {
+        if (key != 0 && !manifestPut(manifest, (uint64_t)key, (uint64_t)value)) {
+            break;
+        }
+    }
+    fclose(file);
+}
+
+static void manifestFree(PipelineManifest *manifest)
+{
+    free(manifest->keys);
+    free(manifest->values);
+    memset(manifest, 0, sizeof(*manifest));
+}
+
+/* Stages */
+
+/**
+ * Whether a tag file is at least as new as its media file
+ */
+static bool tagFileCurrent(const char *path, const char *tagPath, bool *tagFileExists)
+{
+    struct stat media, tags;
+    *tagFileExists = stat(tagPath, &tags) == 0;
+    return *tagFileExists && stat(path, &media) == 0 && tags.st_mtime >= media.st_mtime;
+}
+
+/**
+ * Check, read and queue one directory entry
+ */
+static void readEntry(Pipeline *pipeline, const char *name)
+{
+    char *path = joinPath(pipeline->dirPath, name, "");
+    if (!path) {
+        return;
+    }
+    TinyAIMediaType type = tinyaiMediaTaggerDetectType(path);
+    if (type == TINYAI_MEDIA_TYPE_UNKNOWN) {
+        free(path);
+        return;
+    }
+    pipeline->stats.filesFound++;
+
+    PipelineItem *item = (PipelineItem *)calloc(1, sizeof(PipelineItem));
+    char          suffix[16];
+    snprintf(suffix, sizeof(suffix), ".tags.%s", pipeline->format);
+    if (!item || !(item->tagPath = joinPath(pipeline->outputDir, name, suffix))) {
+        fprintf(stderr, "Error: Failed to allocate pipeline item for %s\n", path);
+        free(item);
+        free(path);
+        lockStats(pipeline);
+        pipeline->stats.filesFailed++;
+        unlockStats(pipeline);
+        return;
+    }
+    item->path     = path;
+    item->type     = type;
+    item->pathHash = hashBytes(item->tagPath, strlen(item->tagPath)) | 1;
+
+    /* Tags newer than the file need no read at all */
+    bool tagFileExists = false;
+    if (pipeline->skipTagged && tagFileCurrent(item->path, item->tagPath, &tagFileExists)) {
+        pipeline->stats.filesSkipped++;
+        freeItem(item);
+        return;
+    }
+
+    item->bytes = readFileBytes(item->path, &item->size);
+    if (!item->bytes) {
+        failItem(pipeline, item, "read");
+        return;
+    }
+    item->contentHash = hashBytes(item->bytes, item->size);
+
+    /* Touched but unchanged since its tags were saved */
+    uint64_t recorded;
+    if (pipeline->skipTagged && tagFileExists &&
+        manifestGet(&pipeline->manifest, item->pathHash, &recorded) &&
+        recorded == item->contentHash) {
+        pipeline->stats.filesSkipped++;
+        freeItem(item);
+        return;
+    }
+
+    /* Time waiting for the decoders is not read time */
+    pipeline->readNs -= getTimeNs();
+    queuePush(&pipeline->readQueue, item);
+    pipeline->readNs += getTimeNs();
+}
+
+/**
+ * Reader: list the directory and read the files that need tags
+ */
+static void runReader(Pipeline *pipeline)
+{
+    uint64_t start = getTimeNs();
+
+#ifdef _WIN32
+    WIN32_FIND_DATA findData;
+    char           *searchPath = joinPath(pipeline->dirPath, "*", "");
+    HANDLE          hFind =
+        searchPath ? FindFirstFile(searchPath, &findData) : INVALID_HANDLE_VALUE;
+    free(searchPath);
+
+    if (hFind == INVALID_HANDLE_VALUE) {
+        pipeline->listFailed = true;
+    }
+    else {
+        do {
+            if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                readEntry(pipeline, findData.cFileName);
+            }
+        } while (FindNextFile(hFind, &findData));
+        FindClose(hFind);
+    }
+#else
+    DIR *dir = opendir(pipeline->dirPath);
+    if (!dir) {
+        pipeline->listFailed = true;
+    }
+    else {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+                readEntry(pipeline, entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+#endif
+
+    pipeline->readNs += getTimeNs() - start;
+    queueClose(&pipeline->readQueue);
+}
+
+/**
+ * Decode file contents into the input its tagger takes
+ */
+static bool decodeItem(Pipeline *pipeline, PipelineItem *item)
+{
+    switch (item->type) {
+    case TINYAI_MEDIA_TYPE_IMAGE:
+        /* Shrink while decoding, then resize here instead of in the tagger */
+        item->image = tinyaiImageLoadFromMemoryScaled(item->bytes, item->size,
+                                                      pipeline->imageWidth, pipeline->imageHeight);
+        if (item->image && (item->image->width != pipeline->imageWidth ||
+                            item->image->height != pipeline->imageHeight)) {
+            TinyAIImage *resized =
+                tinyaiImageResize(item->image, pipeline->imageWidth, pipeline->imageHeight);
+            tinyaiImageFree(item->image);
+            item->image = resized;
+        }
+        free(item->bytes);
+        item->bytes = NULL;
+        return item->image != NULL;
+
+    case TINYAI_MEDIA_TYPE_TEXT:
+        item->text  = (char *)item->bytes;
+        item->bytes = NULL;
+        return true;
+
+    default:
+        /* Other media are tagged from the file */
+        free(item->bytes);
+        item->bytes = NULL;
+        return true;
+    }
+}
+
+/**
+ * Decoder: decode files as they arrive
+ */
+static void runDecoder(Pipeline *pipeline)
+{
+    PipelineItem *item;
+    while ((item = queuePop(&pipeline->readQueue, true)) != NULL) {
+        uint64_t start   = getTimeNs();
+        bool     decoded = decodeItem(pipeline, item);
+        uint64_t elapsed = getTimeNs() - start;
+
+        lockStats(pipeline);
+        pipeline->decodeNs += elapsed;
+        unlockStats(pipeline);
+
+        if (decoded) {
+            queuePush(&pipeline->decodedQueue, item);
+        }
+        else {
+            failItem(pipeline, item, "decode");
+        }
+    }
+    queueClose(&pipeline->decodedQueue);
+}
+
+/**
+ * Pass a tagged item to the writer
+ */
+static void queueTagged(Pipeline *pipeline, PipelineItem *item)
+{
+    if (item->numTags <= 0) {
+        failItem(pipeline, item, "tag");
+        return;
+    }
+    queuePush(&pipeline->taggedQueue, item);
+}
+
+/**
+ * Tag a text or other non-image file
+ */
+static void tagSingle(Pipeline *pipeline, PipelineItem *item)
+{
+    uint64_t start = getTimeNs();
+
+    item->tags = (TinyAITag *)malloc((size_t)pipeline->maxTags * sizeof(TinyAITag));
+    if (item->tags) {
+        item->numTags = item->type == TINYAI_MEDIA_TYPE_TEXT
+                            ? tinyaiMediaTaggerTagText(pipeline->tagger, item->text,
+                                                       item->tags, pipeline->maxTags)
+                            : tinyaiMediaTaggerTagFile(pipeline->tagger, item->path,
+                                                       item->tags, pipeline->maxTags, NULL);
+    }
+    if (item->numTags < 0) {
+        item->numTags = 0;
+    }
+    free(item->text);
+    item->text = NULL;
+
+    pipeline->tagNs += getTimeNs() - start;
+    queueTagged(pipeline, item);
+}
+
+/**
+ * Tag a batch of decoded images in one pass through the image model
+ */
+static void tagImageBatch(Pipeline *pipeline, PipelineItem **batch, int count)
+{
+    uint64_t           start = getTimeNs();
+    const TinyAIImage *images[TINYAI_IMAGE_MAX_BATCH];
+    int                numTags[TINYAI_IMAGE_MAX_BATCH];
+    for (int i = 0; i < count; i++) {
+        images[i] = batch[i]->image;
+    }
+
+    size_t     perImage = (size_t)pipeline->maxTags * sizeof(TinyAITag);
+    TinyAITag *tags     = (TinyAITag *)malloc(count * perImage);
+    bool       tagged   = tags && tinyaiMediaTaggerTagImages(pipeline->tagger, images, count, tags,
+                                                             pipeline->maxTags, numTags) == 0;
+    pipeline->stats.imageBatches++;
+
+    for (int i = 0; i < count; i++) {
+        PipelineItem *item = batch[i];
+        tinyaiImageFree(item->image);
+        item->image = NULL;
+
+        if (tagged && numTags[i] > 0) {
+            item->tags = (TinyAITag *)malloc(perImage);
+            if (item->tags) {
+                memcpy(item->tags, tags + (size_t)i * pipeline->maxTags,
+                       numTags[i] * sizeof(TinyAITag));
+                item->numTags = numTags[i];
+            }
+            else {
+                tinyaiMediaTaggerFreeTags(tags + (size_t)i * pipeline->maxTags, numTags[i]);
+            }
+        }
+    }
+    free(tags);
+
+    pipeline->tagNs += getTimeNs() - start;
+    for (int i = 0; i < count; i++) {
+        queueTagged(pipeline, batch[i]);
+    }
+}
+
+/**
+ * Tagger: batch whatever images have been decoded, up to a full batch
+ *
+ * Only the first item of a batch is waited for, so batches fill up when
+ * the image model is the bottleneck and stay small when decoding is.
+ */
+static void runTagger(Pipeline *pipeline)
+{
+    PipelineItem *batch[TINYAI_IMAGE_MAX_BATCH];
+    PipelineItem *item;
+
+    while ((item = queuePop(&pipeline->decodedQueue, true)) != NULL) {
+        int count = 0;
+        do {
+            if (item->type == TINYAI_MEDIA_TYPE_IMAGE) {
+                batch[count++] = item;
+            }
+            else {
+                tagSingle(pipeline, item);
+            }
+        } while (count < TINYAI_IMAGE_MAX_BATCH &&
+                 (item = queuePop(&pipeline->decodedQueue, false)) != NULL);
+
+        if (count > 0) {
+            tagImageBatch(pipeline, batch, count);
+        }
+    }
+    queueClose(&pipeline->taggedQueue);
+}
+
+/**
+ * Writer: save tags and record the contents they were made from
+ */
+static void runWriter(Pipeline *pipeline)
+{
+    PipelineItem *item;
+    while ((item = queuePop(&pipeline->taggedQueue, true)) != NULL) {
+        uint64_t start = getTimeNs();
+        bool     saved = tinyaiMediaTaggerSaveTags(item->tags, item->numTags, item->tagPath,
+                                                   pipeline->format);
+        if (saved && pipeline->manifestFile) {
+            fprintf(pipeline->manifestFile, "%016llx %016llx\n",
+                    (unsigned long long)item->pathHash, (unsigned long long)item->contentHash);
+        }
+        pipeline->writeNs += getTimeNs() - start;
+
+        if (saved) {
+            lockStats(pipeline);
+            pipeline->stats.filesTagged++;
+            unlockStats(pipeline);
+            freeItem(item);
+        }
+        else {
+            failItem(pipeline, item, "save tags of");
+        }
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall stageThreadFunc(void *param)
+#else
+static void *stageThreadFunc(void *param)
+#endif
+{
+    StageThread *stage = (StageThread *)param;
+    stage->run(stage->pipeline);
+#ifdef _WIN32
+    _endthreadex(0);
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static bool startStage(StageThread *stage, ThreadHandle *thread)
+{
+#ifdef _WIN32
+    *thread = (HANDLE)_beginthreadex(NULL, 0, stageThreadFunc, stage, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, stageThreadFunc, stage) == 0;
+#endif
+}
+
+static void joinStage(ThreadHandle thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+/**
+ * Initialize a pipeline configuration with default values
+ */
+void tinyaiTagPipelineConfigDefault(TinyAITagPipelineConfig *config)
+{
+    if (!config) {
+        return;
+    }
+
+    memset(config, 0, sizeof(TinyAITagPipelineConfig));
+    config->format     = "json";
+    config->maxTags    = PIPELINE_DEFAULT_MAX_TAGS;
+    config->skipTagged = true;
+}
+
+/**
+ * Tag every supported file in a directory
+ */
+int tinyaiMediaTaggerTagDirectory(TinyAIMediaTagger *tagger, const char *dirPath,
+                                  const TinyAITagPipelineConfig *config,
+                                  TinyAITagPipelineStats        *stats)
+{
+    if (!tagger || !dirPath) {
+        return -1;
+    }
+
+    TinyAITagPipelineConfig defaults;
+    if (!config) {
+        tinyaiTagPipelineConfigDefault(&defaults);
+        config = &defaults;
+    }
+
+    int decoders = config->decodeThreads;
+    if (decoders <= 0) {
+        decoders = tinyaiThreadPoolSize(tinyaiGetThreadPool()) / 2;
+    }
+    decoders = decoders < 1 ? 1 : decoders > PIPELINE_MAX_DECODERS ? PIPELINE_MAX_DECODERS
+                                                                   : decoders;
+    int depth = config->queueDepth > 0 ? config->queueDepth : 2 * TINYAI_IMAGE_MAX_BATCH;
+
+    Pipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.tagger     = tagger;
+    pipeline.dirPath    = dirPath;
+    pipeline.outputDir  = config->outputDir ? config->outputDir : ".";
+    pipeline.format     = config->format ? config->format : "json";
+    pipeline.maxTags    = config->maxTags > 0 ? config->maxTags : PIPELINE_DEFAULT_MAX_TAGS;
+    pipeline.skipTagged = config->skipTagged;
+    if (!tinyaiMediaTaggerGetImageSize(tagger, &pipeline.imageWidth, &pipeline.imageHeight) ||
+        !queueInit(&pipeline.readQueue, depth, 1) ||
+        !queueInit(&pipeline.decodedQueue, depth, decoders) ||
+        !queueInit(&pipeline.taggedQueue, depth, 1)) {
+        fprintf(stderr, "Error: Failed to initialize tagging pipeline\n");
+        queueDestroy(&pipeline.readQueue);
+        queueDestroy(&pipeline.decodedQueue);
+        return -1;
+    }
+#ifdef _WIN32
+    InitializeSRWLock(&pipeline.statsLock);
+#else
+    pthread_mutex_init(&pipeline.statsLock, NULL);
+#endif
+
+    char *manifestPath = joinPath(pipeline.outputDir, TINYAI_TAG_PIPELINE_MANIFEST, "");
+    if (manifestPath) {
+        if (pipeline.skipTagged) {
+            manifestLoad(&pipeline.manifest, manifestPath);
+        }
+        pipeline.manifestFile = fopen(manifestPath, "a");
+        free(manifestPath);
+    }
+
+    uint64_t     start = getTimeNs();
+    StageThread  readerStage  = {&pipeline, runReader};
+    StageThread  decoderStage = {&pipeline, runDecoder};
+    StageThread  writerStage  = {&pipeline, runWriter};
+    ThreadHandle readerThread, writerThread;
+    ThreadHandle decoderThreads[PIPELINE_MAX_DECODERS];
+    int          numDecoders = 0;
+    bool         started     = true;
+
+    /* Decoders first: without them nothing drains the reader */
+    while (numDecoders < decoders && startStage(&decoderStage, &decoderThreads[numDecoders])) {
+        numDecoders++;
+    }
+    for (int i = numDecoders; i < decoders; i++) {
+        queueClose(&pipeline.decodedQueue);
+    }
+    bool writerStarted = numDecoders > 0 && startStage(&writerStage, &writerThread);
+    bool readerStarted = writerStarted && startStage(&readerStage, &readerThread);
+    if (!readerStarted) {
+        fprintf(stderr, "Error: Failed to start tagging pipeline threads\n");
+        queueClose(&pipeline.readQueue);
+        started = false;
+    }
+
+    /* The tagger runs here; with no writer its output is dropped */
+    if (writerStarted) {
+        runTagger(&pipeline);
+    }
+    for (int i = 0; i < numDecoders; i++) {
+        joinStage(decoderThreads[i]);
+    }
+    if (!writerStarted) {
+        queueClose(&pipeline.taggedQueue);
+        PipelineItem *item;
+        while ((item = queuePop(&pipeline.decodedQueue, false)) != NULL) {
+            freeItem(item);
+        }
+    }
+    else {
+        joinStage(writerThread);
+    }
+    if (readerStarted) {
+        joinStage(readerThread);
+    }
+
+    if (pipeline.listFailed) {
+        fprintf(stderr, "Error: Could not open directory %s\n", dirPath);
+        started = false;
+    }
+
+    pipeline.stats.readMs   = pipeline.readNs / 1e6;
+    pipeline.stats.decodeMs = pipeline.decodeNs / 1e6;
+    pipeline.stats.tagMs    = pipeline.tagNs / 1e6;
+    pipeline.stats.writeMs  = pipeline.writeNs / 1e6;
+    pipeline.stats.totalMs  = (getTimeNs() - start) / 1e6;
+    if (stats) {
+        *stats = pipeline.stats;
+    }
+
+    if (pipeline.manifestFile) {
+        fclose(pipeline.manifestFile);
+    }
+    manifestFree(&pipeline.manifest);
+    queueDestroy(&pipeline.readQueue);
+    queueDestroy(&pipeline.decodedQueue);
+    queueDestroy(&pipeline.taggedQueue);
+#ifndef _WIN32
+    pthread_mutex_destroy(&pipeline.statsLock);
+#endif
+
+    return started ? pipeline.stats.filesTagged : -1;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file tag_pipeline.h
+ * @brief Staged directory pipeline for the TinyAI media tagger
+ *
+ * Tags every supported file of a directory with concurrent stages joined by
+ * bounded queues: a reader that lists the directory, skips files whose tags
+ * are up to date and reads the rest into memory; decoder threads that turn
+ * file contents into images and text; the tagger, which classifies images
+ * in batches on the calling thread; and a writer that saves the tags. A
+ * stage only waits when the queue it feeds is full or the one it drains is
+ * empty, so reads, decoding, inference and writes of different files
+ * overlap instead of taking turns.
+ */
+
+#ifndef TINYAI_TAG_PIPELINE_H
+#define TINYAI_TAG_PIPELINE_H
+
+#include "media_tagger.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Name of the file in the output directory recording the content hash of
+ * every file tagged by the pipeline
+ */
+#define TINYAI_TAG_PIPELINE_MANIFEST ".tinyai_tags"
+
+/**
+ * Directory pipeline configuration
+ */
+typedef struct {
+    const char *outputDir;     /* Directory for tag files (NULL for the current directory) */
+    const char *format;        /* Tag file format: "txt", "json" or "xml" (NULL for json) */
+    int         maxTags;       /* Maximum number of tags per file (0 for 20) */
+    int         decodeThreads; /* Decoder threads (0 for half the shared thread pool) */
+    int         queueDepth;    /* Files each queue holds (0 for two image batches) */
+    bool        skipTagged;    /* Skip files whose tags are up to date */
+} TinyAITagPipelineConfig;
+
+/**
+ * Directory pipeline statistics
+ *
+ * Stage times are the time each stage spent working, not waiting on its
+ * queues; decode time is summed over the decoder threads.
+ */
+typedef struct {
+    int    filesFound;   /* Files of a supported media type */
+    int    filesSkipped; /* Files whose tags were up to date */
+    int    filesTagged;  /* Files tagged and saved */
+    int    filesFailed;  /* Files that could not be read, decoded, tagged or saved */
+    int    imageBatches; /* Batched passes through the image model */
+    double readMs;       /* Time listing, checking and reading files */
+    double decodeMs;     /* Time decoding files */
+    double tagMs;        /* Time tagging */
+    double writeMs;      /* Time saving tags */
+    double totalMs;      /* Wall-clock time of the run */
+} TinyAITagPipelineStats;
+
+/**
+ * Initialize a pipeline configuration with default values
+ *
+ * @param config Configuration to initialize
+ */
+void tinyaiTagPipelineConfigDefault(TinyAITagPipelineConfig *config);
+
+/**
+ * Tag every supported file in a directory
+ *
+ * Tags of a file are saved to <outputDir>/<file name>.tags.<format>. With
+ * skipTagged, a file is skipped without being read when its tag file is at
+ * least as new as it, and after being read when its contents hash to the
+ * value recorded in the manifest when its tags were saved (for example
+ * after a copy that only changed its modification time). The tagger is
+ * only used from the calling thread.
+ *
+ * @param tagger Tagger to use
+ * @param dirPath Directory to tag
+ * @param config Pipeline configuration (NULL for defaults)
+ * @param stats Optional output parameter for statistics
+ * @return Number of files tagged, or -1 if the pipeline could not run
+ */
+int tinyaiMediaTaggerTagDirectory(TinyAIMediaTagger *tagger, const char *dirPath,
+                                  const TinyAITagPipelineConfig *config,
+                                  TinyAITagPipelineStats        *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_TAG_PIPELINE_H */
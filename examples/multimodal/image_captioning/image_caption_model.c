@@ -16,10 +16,12 @@
 struct TinyAIImageCaptionModel {
     TinyAIMultimodalModel *model;        /* Underlying multimodal model */
     TinyAITokenizer       *tokenizer;    /* Tokenizer for text generation */
+    TinyAIModel           *decoder;      /* Text decoder fed the image prefix (can be NULL) */
     int                    imageWidth;   /* Input image width */
     int                    imageHeight;  /* Input image height */
     int                    maxTokens;    /* Maximum tokens for caption */
     int                    textEmbedDim; /* Text embedding dimension */
+    int                    beamWidth;    /* Decoder beam search width */
     bool                   useSIMD;      /* Whether SIMD is enabled */
 };
 
@@ -47,6 +49,7 @@ TinyAIImageCaptionModel *tinyaiImageCaptionModelCreate(const TinyAIImageCaptionC
     model->imageHeight  = config->imageHeight;
     model->maxTokens    = config->maxTokenLength;
     model->textEmbedDim = config->textEmbedDim;
+    model->beamWidth    = config->beamWidth > 0 ? config->beamWidth : 1;
     model->useSIMD      = config->useSIMD;
 
     /* Load tokenizer */
@@ -114,6 +117,24 @@ TinyAIImageCaptionModel *tinyaiImageCaptionModelCreate(const TinyAIImageCaptionC
     /* Clean up */
     free(mmParams.modalityConfigs);
 
+    /* Load the text decoder; its embedding layer must take the fused embeddings */
+    if (config->decoderFile) {
+        model->decoder =
+            tinyaiLoadModel(config->decoderFile, config->decoderWeightsFile, config->vocabFile);
+        if (!model->decoder) {
+            fprintf(stderr, "Failed to load text decoder from %s\n", config->decoderFile);
+            tinyaiImageCaptionModelFree(model);
+            return NULL;
+        }
+        if (model->decoder->layerCount == 0 ||
+            model->decoder->layers[0].type != TINYAI_LAYER_EMBEDDING ||
+            (int)model->decoder->layers[0].outputSize != config->textEmbedDim) {
+            fprintf(stderr, "Text decoder embeddings do not match the text embedding dimension\n");
+            tinyaiImageCaptionModelFree(model);
+            return NULL;
+        }
+    }
+
     return model;
 }
 
@@ -136,6 +157,11 @@ void tinyaiImageCaptionModelFree(TinyAIImageCaptionModel *model)
         tinyaiTokenizerFree(model->tokenizer);
     }
 
+    /* Free text decoder */
+    if (model->decoder) {
+        tinyaiDestroyModel(model->decoder);
+    }
+
     /* Free model structure */
     free(model);
 }
@@ -166,6 +192,37 @@ bool tinyaiImageCaptionGenerate(TinyAIImageCaptionModel *model, const char *imag
     return success;
 }
 
+/**
+ * Decode a caption with beam search, feeding the fused image embeddings to
+ * the text decoder as a prefix
+ *
+ * Returns the number of caption tokens (start token included), 0 on failure.
+ */
+static int generateWithDecoder(TinyAIImageCaptionModel      *model,
+                               const TinyAIMultimodalOutput *mmOutput, int startToken,
+                               int *captionTokens, int maxTokens)
+{
+    if (!mmOutput->embeddings || mmOutput->embedDim != model->textEmbedDim ||
+        mmOutput->length <= 0) {
+        return 0;
+    }
+
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens    = maxTokens - 1;
+    params.promptTokens = &startToken;
+    params.promptLength = 1;
+
+    TinyAIBeamSearchParams beam;
+    memset(&beam, 0, sizeof(beam));
+    beam.beamWidth        = model->beamWidth;
+    beam.lengthPenalty    = 1.0f;
+    beam.prefixEmbeddings = mmOutput->embeddings;
+    beam.prefixRows       = mmOutput->length;
+
+    return tinyaiGenerateTextBeam(model->decoder, &params, &beam, captionTokens, maxTokens);
+}
+
 /**
  * Generate a caption for an image directly from image data
  */
@@ -244,7 +301,6 @@ bool tinyaiImageCaptionGenerateFromImage(TinyAIImageCaptionModel *model, const T
         return false;
     }
 
-    /* Generate caption using a simple greedy decoding */
     int captionTokens[256]; /* Maximum token buffer */
     captionTokens[0] = startToken;
     int numTokens    = 1;
@@ -253,8 +309,22 @@ bool tinyaiImageCaptionGenerateFromImage(TinyAIImageCaptionModel *model, const T
         endToken = tinyaiTokenizerGetVocabSize(model->tokenizer) - 1; /* Default end token */
     }
 
-    /* Generate tokens one by one */
-    for (int i = 1; i < model->maxTokens && i < 256; i++) {
+    /* With a text decoder the image is encoded only once */
+    if (model->decoder) {
+        int maxTokens = model->maxTokens < 256 ? model->maxTokens : 256;
+        numTokens     = generateWithDecoder(model, &mmOutput, startToken, captionTokens, maxTokens);
+        if (numTokens <= 0) {
+            fprintf(stderr, "Failed to decode caption\n");
+            tinyaiMultimodalOutputFree(&mmOutput);
+            free(tokens);
+            tinyaiMultimodalInputFree(&mmInput, false);
+            tinyaiImageFree(processedImage);
+            return false;
+        }
+    }
+
+    /* Otherwise generate tokens one by one with greedy decoding */
+    for (int i = 1; !model->decoder && i < model->maxTokens && i < 256; i++) {
         /* Get logits from output */
         float *logits = mmOutput.textLogits;
         if (!logits) {
@@ -349,3 +419,16 @@ bool tinyaiImageCaptionModelEnableSIMD(TinyAIImageCaptionModel *model, bool enab
     model->useSIMD = enable;
     return tinyaiMultimodalModelEnableSIMD(model->model, enable);
 }
+
+/**
+ * Use an image embedding cache
+ */
+bool tinyaiImageCaptionModelSetEmbeddingCache(TinyAIImageCaptionModel *model,
+                                              TinyAIEmbeddingCache    *cache)
+{
+    if (!model) {
+        return false;
+    }
+
+    return tinyaiMultimodalModelSetEmbeddingCache(model->model, cache);
+}
@@ -7,6 +7,7 @@
 #define TINYAI_IMAGE_CAPTION_MODEL_H
 
 #include "../../../models/multimodal/multimodal_model.h"
+#include "../../../models/text/generate.h"
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -17,16 +18,19 @@ extern "C" {
  * Image captioning model configuration
  */
 typedef struct {
-    int   imageWidth;      /* Input image width */
-    int   imageHeight;     /* Input image height */
-    int   maxTokenLength;  /* Maximum token length for generated caption */
-    int   textEmbedDim;    /* Text embedding dimension */
-    int   imageFeatureDim; /* Image feature dimension */
-    int   fusionDim;       /* Dimension of fused representation */
-    bool  useQuantization; /* Whether to use 4-bit quantization */
-    bool  useSIMD;         /* Whether to use SIMD acceleration */
-    char *weightsFile;     /* Path to weights file */
-    char *vocabFile;       /* Path to vocabulary file */
+    int   imageWidth;         /* Input image width */
+    int   imageHeight;        /* Input image height */
+    int   maxTokenLength;     /* Maximum token length for generated caption */
+    int   textEmbedDim;       /* Text embedding dimension */
+    int   imageFeatureDim;    /* Image feature dimension */
+    int   fusionDim;          /* Dimension of fused representation */
+    bool  useQuantization;    /* Whether to use 4-bit quantization */
+    bool  useSIMD;            /* Whether to use SIMD acceleration */
+    char *weightsFile;        /* Path to weights file */
+    char *vocabFile;          /* Path to vocabulary file */
+    char *decoderFile;        /* Path to text decoder structure file (can be NULL) */
+    char *decoderWeightsFile; /* Path to text decoder weights file (can be NULL) */
+    int   beamWidth;          /* Decoder beam search width (0 or 1 for greedy) */
 } TinyAIImageCaptionConfig;
 
 /**
@@ -64,6 +68,11 @@ bool tinyaiImageCaptionGenerate(TinyAIImageCaptionModel *model, const char *imag
 /**
  * Generate a caption for an image directly from image data
  *
+ * With a text decoder, the image is encoded once and its fused embeddings are
+ * fed to the decoder as a prefix; beam search then advances every hypothesis
+ * in one batched forward pass, sharing the prefix key/value blocks between
+ * beams. Without a decoder, the multimodal model is rerun for every token.
+ *
  * @param model Model to use
  * @param image Image to caption
  * @param caption Buffer to store the generated caption
@@ -93,6 +102,20 @@ bool tinyaiImageCaptionModelGetMemoryUsage(const TinyAIImageCaptionModel *model,
  */
 bool tinyaiImageCaptionModelEnableSIMD(TinyAIImageCaptionModel *model, bool enable);
 
+/**
+ * Use an image embedding cache
+ *
+ * Every generated token reprocesses the image, so with a cache the image is
+ * encoded once, and not at all for images captioned before. The cache may be
+ * shared with visual QA and tagging and must outlive the model.
+ *
+ * @param model Model to configure
+ * @param cache Embedding cache to use, or NULL to encode every image
+ * @return true on success, false on failure
+ */
+bool tinyaiImageCaptionModelSetEmbeddingCache(TinyAIImageCaptionModel *model,
+                                              TinyAIEmbeddingCache    *cache);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,8 @@ void print_usage(const char *progname)
     printf("  --batch <file>         Batch file with image paths and questions\n");
     printf("  --quantized            Use 4-bit quantization\n");
     printf("  --simd                 Use SIMD acceleration\n");
+    printf("  --cache-mb <n>         Image embedding cache size in MB (default: 4, 0 to disable)\n");
+    printf("  --cache-dir <dir>      Directory that keeps image embeddings across runs\n");
     printf("  --help                 Show this help message\n");
 }
 
@@ -153,6 +155,8 @@ int main(int argc, char *argv[])
     int               max_tokens       = 100;
     bool              use_quantization = false;
     bool              use_simd         = false;
+    int               cache_mb         = 4;
+    const char       *cache_dir        = NULL;
 
     /* Parse command line arguments */
     for (int i = 1; i < argc; i++) {
@@ -211,6 +215,16 @@ int main(int argc, char *argv[])
         else if (strcmp(argv[i], "--simd") == 0) {
             use_simd = true;
         }
+        else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            cache_mb = atoi(argv[++i]);
+            if (cache_mb < 0) {
+                fprintf(stderr, "Error: Invalid cache size\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        }
     }
 
     /* Validate required arguments */
@@ -261,6 +275,10 @@ int main(int argc, char *argv[])
     config.useQuantization = use_quantization;
     config.useSIMD         = use_simd;
 
+    /* Batch files usually ask several questions per image */
+    config.embeddingCacheSize = (size_t)cache_mb * 1024 * 1024;
+    config.embeddingCachePath = cache_dir;
+
     /* Create visual QA system */
     printf("Initializing visual QA system...\n");
     clock_t start_time = clock();
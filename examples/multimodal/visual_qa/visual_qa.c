@@ -26,6 +26,8 @@ struct TinyAIVisualQA {
     bool                   useSIMD;         /* Whether to use SIMD */
     int                    imageWidth;      /* Image width */
     int                    imageHeight;     /* Image height */
+    TinyAIEmbeddingCache  *embeddingCache;  /* Image embedding cache */
+    bool                   ownsCache;       /* Whether we created the cache */
 };
 
 /* Predefined prompt templates for different answer styles */
@@ -92,6 +94,19 @@ TinyAIVisualQA *tinyaiVisualQACreate(const TinyAIVisualQAConfig *config)
         return NULL;
     }
 
+    /* Cache image embeddings across questions */
+    if (config->embeddingCacheSize > 0) {
+        vqa->embeddingCache =
+            tinyaiCreateEmbeddingCache(config->embeddingCacheSize, config->embeddingCachePath);
+        if (!vqa->embeddingCache) {
+            fprintf(stderr, "Failed to create embedding cache\n");
+            tinyaiVisualQAFree(vqa);
+            return NULL;
+        }
+        vqa->ownsCache = true;
+        tinyaiMultimodalModelSetEmbeddingCache(vqa->model, vqa->embeddingCache);
+    }
+
     return vqa;
 }
 
@@ -119,6 +134,11 @@ void tinyaiVisualQAFree(TinyAIVisualQA *vqa)
         free(vqa->customTemplate);
     }
 
+    /* Free the embedding cache if we created it */
+    if (vqa->ownsCache) {
+        tinyaiDestroyEmbeddingCache(vqa->embeddingCache);
+    }
+
     /* Free the VQA structure */
     free(vqa);
 }
@@ -240,6 +260,24 @@ bool tinyaiVisualQAAnswerQuestionForImage(TinyAIVisualQA *vqa, const TinyAIImage
     return true;
 }
 
+/**
+ * Use a shared image embedding cache
+ */
+bool tinyaiVisualQASetEmbeddingCache(TinyAIVisualQA *vqa, TinyAIEmbeddingCache *cache)
+{
+    if (!vqa || !vqa->model) {
+        return false;
+    }
+
+    if (vqa->ownsCache && vqa->embeddingCache != cache) {
+        tinyaiDestroyEmbeddingCache(vqa->embeddingCache);
+    }
+    vqa->embeddingCache = cache;
+    vqa->ownsCache      = false;
+
+    return tinyaiMultimodalModelSetEmbeddingCache(vqa->model, cache);
+}
+
 /**
  * Set the answer style
  */
@@ -49,6 +49,10 @@ typedef struct {
     bool useSIMD;         /* Whether to use SIMD acceleration */
     int  imageWidth;      /* Image width for model input */
     int  imageHeight;     /* Image height for model input */
+
+    /* Image embedding cache, so follow-up questions skip the image encoder */
+    size_t      embeddingCacheSize; /* Bytes of embeddings kept in memory (0 for no cache) */
+    const char *embeddingCachePath; /* Directory of the disk tier (optional) */
 } TinyAIVisualQAConfig;
 
 /**
@@ -97,6 +101,19 @@ bool tinyaiVisualQAAnswerQuestion(TinyAIVisualQA *vqa, const char *imagePath, co
 bool tinyaiVisualQAAnswerQuestionForImage(TinyAIVisualQA *vqa, const TinyAIImage *image,
                                           const char *question, char *answer, int maxLength);
 
+/**
+ * Use a shared image embedding cache
+ *
+ * Replaces the cache created from the configuration, if any. The cache
+ * may also serve captioning and media tagging, and must outlive the
+ * visual QA system.
+ *
+ * @param vqa Visual QA system to configure
+ * @param cache Embedding cache to use, or NULL to encode every image
+ * @return True on success, false on failure
+ */
+bool tinyaiVisualQASetEmbeddingCache(TinyAIVisualQA *vqa, TinyAIEmbeddingCache *cache);
+
 /**
  * Set the answer style
  *
@@ -8,20 +8,33 @@
 #include "../core/memory.h"           // For memory allocation
 #include "../models/text/generate.h"  // For model/tokenizer types
 #include "../models/text/tokenizer.h" // For tokenizer type
+#include "../utils/trace.h"           // For the trace command
 
 #include <ctype.h> // For isspace
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h> // For QueryPerformanceCounter
+#endif
 
 // Define TinyAI Version (replace with actual versioning later)
 #define TINYAI_VERSION "0.1.0-alpha"
 
+// Sequences the batch command decodes together unless --workers says otherwise
+#define BATCH_DEFAULT_WORKERS 8
+
 /* ----------------- Internal State ----------------- */
 
 static TinyAICommand g_commands[TINYAI_CLI_MAX_COMMANDS];
 static int           g_commandCount = 0;
 
+// Open-addressed index of g_commands by name: 1 + position, 0 for an empty slot
+#define COMMAND_INDEX_SIZE (TINYAI_CLI_MAX_COMMANDS * 2)
+static int g_commandIndex[COMMAND_INDEX_SIZE];
+
 /* ----------------- Helper Functions ----------------- */
 
 // Simple command line parsing into argc/argv
@@ -78,17 +91,487 @@ static int parseCommandLine(char *line, char **argv, int maxArgs)
     return argc;
 }
 
+// Index slot holding a command name, or the empty slot where it belongs
+static int *commandSlot(const char *name)
+{
+    unsigned int hash = 2166136261u; // FNV-1a
+    for (const char *c = name; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    }
+
+    // The index is never more than half full, so probing always reaches an empty slot
+    for (unsigned int i = hash % COMMAND_INDEX_SIZE;; i = (i + 1) % COMMAND_INDEX_SIZE) {
+        int entry = g_commandIndex[i];
+        if (entry == 0 || strcmp(g_commands[entry - 1].name, name) == 0) {
+            return &g_commandIndex[i];
+        }
+    }
+}
+
 // Find a command by name
 static TinyAICommand *findCommand(const char *name)
 {
-    for (int i = 0; i < g_commandCount; ++i) {
-        if (strcmp(g_commands[i].name, name) == 0) {
-            return &g_commands[i];
+    int entry = *commandSlot(name);
+    return entry ? &g_commands[entry - 1] : NULL;
+}
+
+/* ----------------- Batch Helpers ----------------- */
+
+// Growable text buffer, always NUL-terminated once written to
+typedef struct {
+    char  *data;
+    size_t length;
+    size_t capacity;
+} CLIBuffer;
+
+static bool bufferAppend(CLIBuffer *buffer, const char *text, size_t length)
+{
+    if (buffer->length + length + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->length + length + 1) {
+            capacity *= 2;
+        }
+        char *data = (char *)realloc(buffer->data, capacity);
+        if (!data) {
+            return false;
+        }
+        buffer->data     = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
+
+// Write text as a quoted JSON string
+static void writeJsonString(FILE *out, const char *text)
+{
+    fputc('"', out);
+    for (const char *c = text; *c; c++) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch == '"' || ch == '\\') {
+            fprintf(out, "\\%c", ch);
+        }
+        else if (ch == '\n') {
+            fputs("\\n", out);
+        }
+        else if (ch < 0x20) {
+            fprintf(out, "\\u%04x", ch);
+        }
+        else {
+            fputc(ch, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Read one line of any length, without its line ending; returns false at end of input
+static bool readLine(FILE *in, CLIBuffer *line)
+{
+    char chunk[4096];
+    line->length = 0;
+    if (line->data) {
+        line->data[0] = '\0';
+    }
+
+    while (fgets(chunk, sizeof(chunk), in)) {
+        size_t length = strlen(chunk);
+        if (!bufferAppend(line, chunk, length)) {
+            return false;
+        }
+        if (length > 0 && chunk[length - 1] == '\n') {
+            break;
+        }
+    }
+    if (line->length == 0) {
+        return false;
+    }
+    while (line->length > 0 &&
+           (line->data[line->length - 1] == '\n' || line->data[line->length - 1] == '\r')) {
+        line->data[--line->length] = '\0';
+    }
+    return true;
+}
+
+// JSON scanning: just enough to pick the members of a prompt line
+
+static const char *jsonSkipSpace(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+        p++;
+    }
+    return p;
+}
+
+// Skip a string starting at its opening quote; returns the end, or NULL if unterminated
+static const char *jsonSkipString(const char *p)
+{
+    for (p++; *p; p++) {
+        if (*p == '\\' && p[1]) {
+            p++;
+        }
+        else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+// Skip any JSON value; returns the end, or NULL if malformed
+static const char *jsonSkipValue(const char *p)
+{
+    p = jsonSkipSpace(p);
+    if (*p == '"') {
+        return jsonSkipString(p);
+    }
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (*p) {
+            if (*p == '"') {
+                p = jsonSkipString(p);
+                if (!p) {
+                    return NULL;
+                }
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            }
+            else if ((*p == '}' || *p == ']') && --depth == 0) {
+                return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+
+    // Number or literal
+    const char *start = p;
+    while (*p && !strchr(",}] \t\r\n", *p)) {
+        p++;
+    }
+    return p > start ? p : NULL;
+}
+
+// Find a member of a JSON object; returns its value and sets its length, or NULL
+static const char *jsonFindMember(const char *object, const char *key, size_t *length)
+{
+    const char *p = jsonSkipSpace(object);
+    if (*p != '{') {
+        return NULL;
+    }
+
+    size_t keyLength = strlen(key);
+    p                = jsonSkipSpace(p + 1);
+    while (*p == '"') {
+        const char *name    = p + 1;
+        const char *nameEnd = jsonSkipString(p);
+        if (!nameEnd) {
+            return NULL;
+        }
+
+        p = jsonSkipSpace(nameEnd);
+        if (*p != ':') {
+            return NULL;
+        }
+        const char *value    = jsonSkipSpace(p + 1);
+        const char *valueEnd = jsonSkipValue(value);
+        if (!valueEnd) {
+            return NULL;
+        }
+
+        if ((size_t)(nameEnd - 1 - name) == keyLength && strncmp(name, key, keyLength) == 0) {
+            *length = (size_t)(valueEnd - value);
+            return value;
+        }
+
+        p = jsonSkipSpace(valueEnd);
+        if (*p != ',') {
+            return NULL;
         }
+        p = jsonSkipSpace(p + 1);
     }
     return NULL;
 }
 
+// Append a code point as UTF-8
+static bool appendUtf8(CLIBuffer *buffer, unsigned long code)
+{
+    char   bytes[4];
+    size_t count;
+    if (code < 0x80) {
+        bytes[0] = (char)code;
+        count    = 1;
+    }
+    else if (code < 0x800) {
+        bytes[0] = (char)(0xC0 | (code >> 6));
+        bytes[1] = (char)(0x80 | (code & 0x3F));
+        count    = 2;
+    }
+    else if (code < 0x10000) {
+        bytes[0] = (char)(0xE0 | (code >> 12));
+        bytes[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (code & 0x3F));
+        count    = 3;
+    }
+    else {
+        bytes[0] = (char)(0xF0 | (code >> 18));
+        bytes[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+        bytes[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+        bytes[3] = (char)(0x80 | (code & 0x3F));
+        count    = 4;
+    }
+    return bufferAppend(buffer, bytes, count);
+}
+
+// Read the four hex digits of a \u escape; returns -1 if malformed
+static long jsonHex4(const char *p)
+{
+    long code = 0;
+    for (int i = 0; i < 4; i++) {
+        if (!isxdigit((unsigned char)p[i])) {
+            return -1;
+        }
+        char c = (char)tolower((unsigned char)p[i]);
+        code   = code * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+    return code;
+}
+
+// Decode the JSON string at p (its opening quote) into a new heap string, or NULL
+static char *jsonDecodeString(const char *p)
+{
+    CLIBuffer   text = {0};
+    const char *end  = *p == '"' ? jsonSkipString(p) : NULL;
+    if (!end || !bufferAppend(&text, "", 0)) {
+        return NULL;
+    }
+
+    for (p++; p < end - 1; p++) {
+        bool ok;
+        if (*p != '\\') {
+            ok = bufferAppend(&text, p, 1);
+        }
+        else {
+            char escaped = *++p;
+            switch (escaped) {
+            case 'n':
+                ok = bufferAppend(&text, "\n", 1);
+                break;
+            case 't':
+                ok = bufferAppend(&text, "\t", 1);
+                break;
+            case 'r':
+                ok = bufferAppend(&text, "\r", 1);
+                break;
+            case 'b':
+                ok = bufferAppend(&text, "\b", 1);
+                break;
+            case 'f':
+                ok = bufferAppend(&text, "\f", 1);
+                break;
+            case 'u': {
+                long code = jsonHex4(p + 1);
+                ok        = code >= 0;
+                p += 4;
+                // A high surrogate pairs with the low one escaped right after it
+                if (ok && code >= 0xD800 && code < 0xDC00 && p[1] == '\\' && p[2] == 'u') {
+                    long low = jsonHex4(p + 3);
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                ok = ok && appendUtf8(&text, (unsigned long)code);
+                break;
+            }
+            default: // \" \\ \/
+                ok = bufferAppend(&text, &escaped, 1);
+                break;
+            }
+        }
+        if (!ok) {
+            free(text.data);
+            return NULL;
+        }
+    }
+    return text.data;
+}
+
+// Get a monotonic timestamp in nanoseconds
+static uint64_t getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// One prompt of a batch run
+typedef struct {
+    int         index;     // Line number among the prompts, from 0
+    char       *id;        // Raw JSON of the line's "id" member (NULL if absent)
+    CLIBuffer   text;      // Generated text
+    int         generated; // Tokens generated
+    uint64_t    startNs;   // When the prompt joined the batch
+    uint64_t    endNs;     // When it finished
+    const char *error;     // Why the prompt failed (NULL on success)
+} BatchItem;
+
+// Collects the pieces of a batch sequence as they are sampled
+static bool batchToken(int token, const char *piece, void *userData)
+{
+    BatchItem *item = (BatchItem *)userData;
+    (void)token;
+    item->generated++;
+    if (piece && *piece && !bufferAppend(&item->text, piece, strlen(piece))) {
+        item->error = "out of memory";
+        return false;
+    }
+    return true;
+}
+
+static void freeBatchItem(BatchItem *item)
+{
+    if (item) {
+        free(item->id);
+        free(item->text.data);
+        free(item);
+    }
+}
+
+// Write a finished prompt as one JSONL result line
+static void writeBatchResult(FILE *out, const BatchItem *item)
+{
+    fprintf(out, "{\"index\":%d", item->index);
+    if (item->id) {
+        fprintf(out, ",\"id\":%s", item->id);
+    }
+    if (item->error) {
+        fputs(",\"error\":", out);
+        writeJsonString(out, item->error);
+    }
+    else {
+        fputs(",\"text\":", out);
+        writeJsonString(out, item->text.data ? item->text.data : "");
+        fprintf(out, ",\"tokens\":%d,\"ms\":%.1f", item->generated,
+                (double)(item->endNs - item->startNs) / 1e6);
+    }
+    fputs("}\n", out);
+}
+
+// Parse a prompt line into generation parameters; returns an error message or NULL
+static const char *parseBatchLine(TinyAICLIContext *ctx, const char *line, BatchItem *item,
+                                  TinyAIGenerationParams *params, int *promptTokens,
+                                  int maxPromptTokens)
+{
+    size_t      length;
+    const char *value = jsonFindMember(line, "id", &length);
+    if (value) {
+        item->id = (char *)malloc(length + 1);
+        if (!item->id) {
+            return "out of memory";
+        }
+        memcpy(item->id, value, length);
+        item->id[length] = '\0';
+    }
+
+    value = jsonFindMember(line, "prompt", &length);
+    if (!value || *value != '"') {
+        return "missing \"prompt\" string";
+    }
+    char *prompt = jsonDecodeString(value);
+    if (!prompt) {
+        return "malformed \"prompt\" string";
+    }
+    int promptLength = tinyaiEncodeText(ctx->tokenizer, prompt, promptTokens, maxPromptTokens);
+    free(prompt);
+    if (promptLength <= 0) {
+        return "failed to tokenize prompt";
+    }
+
+    *params              = ctx->params;
+    params->promptTokens = promptTokens;
+    params->promptLength = promptLength;
+    if ((value = jsonFindMember(line, "max_tokens", &length)) != NULL) {
+        params->maxTokens = atoi(value);
+    }
+    if ((value = jsonFindMember(line, "temperature", &length)) != NULL) {
+        params->temperature = (float)atof(value);
+    }
+    if ((value = jsonFindMember(line, "seed", &length)) != NULL) {
+        params->seed = (uint32_t)strtoul(value, NULL, 10);
+    }
+    return NULL;
+}
+
+// Where finished prompts go, and the totals reported at the end of a run
+typedef struct {
+    FILE       *out;
+    bool        inOrder;     // Hold results back until every earlier prompt is written
+    BatchItem **pending;     // Finished prompts from index next on (NULL until finished)
+    int         pendingSize; // Capacity of pending
+    int         next;        // Index of the next result written in input order
+    int         failed;      // Prompts that failed
+    uint64_t    tokens;      // Tokens generated over all prompts
+} BatchOutput;
+
+// Hand over a finished prompt; results are written as soon as their order allows
+static void emitBatchItem(BatchOutput *output, BatchItem *item)
+{
+    output->tokens += (uint64_t)item->generated;
+    output->failed += item->error != NULL;
+
+    int offset = item->index - output->next;
+    if (output->inOrder && offset >= output->pendingSize) {
+        int size = output->pendingSize ? output->pendingSize : 16;
+        while (offset >= size) {
+            size *= 2;
+        }
+        BatchItem **pending =
+            (BatchItem **)realloc(output->pending, (size_t)size * sizeof(BatchItem *));
+        if (pending) {
+            memset(pending + output->pendingSize, 0,
+                   (size_t)(size - output->pendingSize) * sizeof(BatchItem *));
+            output->pending     = pending;
+            output->pendingSize = size;
+        }
+    }
+    if (!output->inOrder || offset >= output->pendingSize) {
+        // Out of memory for parking it: better written out of order than lost
+        writeBatchResult(output->out, item);
+        freeBatchItem(item);
+        return;
+    }
+
+    output->pending[offset] = item;
+    int ready               = 0;
+    while (ready < output->pendingSize && output->pending[ready]) {
+        writeBatchResult(output->out, output->pending[ready]);
+        freeBatchItem(output->pending[ready]);
+        ready++;
+    }
+    if (ready > 0) {
+        memmove(output->pending, output->pending + ready,
+                (size_t)(output->pendingSize - ready) * sizeof(BatchItem *));
+        memset(output->pending + output->pendingSize - ready, 0,
+               (size_t)ready * sizeof(BatchItem *));
+        output->next += ready;
+    }
+}
+
 /* ----------------- API Functions Implementation ----------------- */
 
 int tinyaiCLIInit(TinyAICLIContext *context)
@@ -117,12 +600,17 @@ int tinyaiCLIInit(TinyAICLIContext *context)
     context->forceLocal  = 0;
 
     g_commandCount = 0;
+    memset(g_commandIndex, 0, sizeof(g_commandIndex));
 
     // Register built-in commands
     tinyaiCLIRegisterCommand("help", "Show help information.", "help [command]", tinyaiCommandHelp);
     tinyaiCLIRegisterCommand("version", "Show TinyAI version.", "version", tinyaiCommandVersion);
     tinyaiCLIRegisterCommand("generate", "Generate text using the loaded model.",
                              "generate <prompt>", tinyaiCommandGenerate);
+    tinyaiCLIRegisterCommand("batch", "Generate text for a JSONL file of prompts in batches.",
+                             "batch <prompts.jsonl | -> [-o results.jsonl] [--workers N] "
+                             "[--order input|completion]",
+                             tinyaiCommandBatch);
     tinyaiCLIRegisterCommand("tokenize", "Tokenize input text.", "tokenize <text>",
                              tinyaiCommandTokenize);
     tinyaiCLIRegisterCommand("model", "Load or inspect the model.", "model load <path> | info",
@@ -134,6 +622,9 @@ int tinyaiCLIInit(TinyAICLIContext *context)
     tinyaiCLIRegisterCommand("hybrid", "Control hybrid local/remote execution mode.",
                              "hybrid on | off | status | force-local | force-remote",
                              tinyaiCommandHybrid);
+    tinyaiCLIRegisterCommand("trace", "Record trace spans for chrome://tracing or Perfetto.",
+                             "trace start [spans-per-thread] | stop [file.json] | status",
+                             tinyaiCommandTrace);
     tinyaiCLIRegisterCommand("exit", "Exit the interactive shell.", "exit", tinyaiCommandExit);
     tinyaiCLIRegisterCommand("quit", "Exit the interactive shell.", "quit",
                              tinyaiCommandExit); // Alias for exit
@@ -175,6 +666,7 @@ void tinyaiCLICleanup(TinyAICLIContext *context)
 
     // Reset command registry (optional, as it's static)
     g_commandCount = 0;
+    memset(g_commandIndex, 0, sizeof(g_commandIndex));
 
     // Cleanup subsystems if initialized here
     // tinyaiIOCleanup();
@@ -388,16 +880,20 @@ int tinyaiCLIRegisterCommand(const char *name, const char *description, const ch
                 name ? name : "(null)");
         return 1; // Error
     }
-    if (findCommand(name)) {
+    int           *slot = commandSlot(name);
+    TinyAICommand *cmd  = *slot ? &g_commands[*slot - 1] : &g_commands[g_commandCount];
+    if (*slot) {
         fprintf(stderr, "Warning: Command '%s' already registered. Overwriting.\n", name);
         // Allow overwriting for now, could return error instead
     }
+    else {
+        *slot = ++g_commandCount;
+    }
 
-    g_commands[g_commandCount].name        = name;
-    g_commands[g_commandCount].description = description;
-    g_commands[g_commandCount].usage       = usage;
-    g_commands[g_commandCount].handler     = handler;
-    g_commandCount++;
+    cmd->name        = name;
+    cmd->description = description;
+    cmd->usage       = usage;
+    cmd->handler     = handler;
 
     return 0; // Success
 }
@@ -549,7 +1045,8 @@ int tinyaiCommandGenerate(int argc, char **argv, void *context)
 
             // Get generation stats
             double localTime, remoteTime, tokensPerSec;
-            tinyaiHybridGenerateGetStats(ctx->hybridGen, &localTime, &remoteTime, &tokensPerSec);
+            tinyaiHybridGenerateGetStats(ctx->hybridGen, &localTime, &remoteTime, &tokensPerSec,
+                                         NULL);
 
             if (tinyaiHybridGenerateUsedRemote(ctx->hybridGen)) {
                 printf("Remote execution time: %.2f ms\n", remoteTime);
@@ -767,58 +1264,18 @@ int tinyaiCommandModel(int argc, char **argv, void *context)
 
         printf("Creating vocabulary with up to %d tokens from %s\n", vocabSize, corpusPath);
 
-        // Load corpus file
-        FILE *corpusFile = fopen(corpusPath, "r");
-        if (!corpusFile) {
-            fprintf(stderr, "Error: Could not open corpus file %s\n", corpusPath);
-            return TINYAI_CLI_EXIT_ERROR;
-        }
-
-        // Determine file size
-        fseek(corpusFile, 0, SEEK_END);
-        long fileSize = ftell(corpusFile);
-        fseek(corpusFile, 0, SEEK_SET);
-
-        if (fileSize <= 0) {
-            fprintf(stderr, "Error: Corpus file is empty or invalid.\n");
-            fclose(corpusFile);
-            return TINYAI_CLI_EXIT_ERROR;
-        }
-
-        // Allocate memory for corpus
-        char *corpus = (char *)malloc(fileSize + 1);
-        if (!corpus) {
-            fprintf(stderr, "Error: Failed to allocate memory for corpus.\n");
-            fclose(corpusFile);
-            return TINYAI_CLI_EXIT_ERROR;
-        }
-
-        // Read corpus
-        size_t bytesRead = fread(corpus, 1, fileSize, corpusFile);
-        fclose(corpusFile);
-
-        if (bytesRead <= 0) {
-            fprintf(stderr, "Error: Failed to read corpus file.\n");
-            free(corpus);
-            return TINYAI_CLI_EXIT_ERROR;
-        }
-
-        corpus[bytesRead] = '\0'; // Ensure null termination
-
         // Create new tokenizer
         TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
         if (!tokenizer) {
             fprintf(stderr, "Error: Failed to create tokenizer.\n");
-            free(corpus);
             return TINYAI_CLI_EXIT_ERROR;
         }
 
-        // Build vocabulary
-        int result = tinyaiCreateMinimalVocabulary(tokenizer, corpus, vocabSize);
+        // Build vocabulary, streaming the corpus from disk
+        int result = tinyaiCreateVocabularyFromFile(tokenizer, corpusPath, vocabSize);
         if (result != 0) {
-            fprintf(stderr, "Error: Failed to create vocabulary.\n");
+            fprintf(stderr, "Error: Failed to create vocabulary from %s.\n", corpusPath);
             tinyaiDestroyTokenizer(tokenizer);
-            free(corpus);
             return TINYAI_CLI_EXIT_ERROR;
         }
 
@@ -829,7 +1286,6 @@ int tinyaiCommandModel(int argc, char **argv, void *context)
         if (result != 0) {
             fprintf(stderr, "Error: Failed to save vocabulary to %s.\n", outputPath);
             tinyaiDestroyTokenizer(tokenizer);
-            free(corpus);
             return TINYAI_CLI_EXIT_ERROR;
         }
 
@@ -837,7 +1293,6 @@ int tinyaiCommandModel(int argc, char **argv, void *context)
 
         // Cleanup
         tinyaiDestroyTokenizer(tokenizer);
-        free(corpus);
     }
     else if (strcmp(argv[1], "info") == 0) {
         printf("Current Model Path: %s\n", ctx->modelPath ? ctx->modelPath : "(None)");
@@ -1178,14 +1633,16 @@ int tinyaiCommandHybrid(int argc, char **argv, void *context)
                    tinyaiHybridGenerateHasRemote(ctx->hybridGen) ? "Yes" : "No");
 
             // Get execution stats if available
-            double localTime, remoteTime, tokensPerSec;
-            tinyaiHybridGenerateGetStats(ctx->hybridGen, &localTime, &remoteTime, &tokensPerSec);
+            double localTime, remoteTime, tokensPerSec, cacheHitRate;
+            tinyaiHybridGenerateGetStats(ctx->hybridGen, &localTime, &remoteTime, &tokensPerSec,
+                                         &cacheHitRate);
 
             if (localTime > 0.0 || remoteTime > 0.0) {
                 printf("Last generation stats:\n");
                 printf("  Local time: %.2f ms\n", localTime);
                 printf("  Remote time: %.2f ms\n", remoteTime);
                 printf("  Tokens per second: %.2f\n", tokensPerSec);
+                printf("  Remote cache hit rate: %.1f%%\n", cacheHitRate * 100.0);
                 printf("  Last execution: %s\n",
                        tinyaiHybridGenerateUsedRemote(ctx->hybridGen) ? "Remote" : "Local");
             }
@@ -1246,3 +1703,211 @@ int tinyaiCommandHybrid(int argc, char **argv, void *context)
 
     return TINYAI_CLI_EXIT_SUCCESS;
 }
+
+/**
+ * Batch command handler implementation
+ *
+ * Prompts are read one JSON object per line ("prompt", plus optional "id",
+ * "max_tokens", "temperature" and "seed") and decoded together in one
+ * continuous batch: a prompt joins as soon as a sequence finishes, and each
+ * step advances every running sequence in one batched forward pass.
+ */
+int tinyaiCommandBatch(int argc, char **argv, void *context)
+{
+    TinyAICLIContext *ctx        = (TinyAICLIContext *)context;
+    const char       *inputPath  = NULL;
+    const char       *outputPath = NULL;
+    int               workers    = BATCH_DEFAULT_WORKERS;
+    BatchOutput       output     = {0};
+
+    output.inOrder = true;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--order") == 0 && i + 1 < argc &&
+                 (strcmp(argv[i + 1], "input") == 0 || strcmp(argv[i + 1], "completion") == 0)) {
+            output.inOrder = strcmp(argv[++i], "input") == 0;
+        }
+        else if (!inputPath && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+            inputPath = argv[i];
+        }
+        else {
+            inputPath = NULL;
+            break;
+        }
+    }
+    if (!inputPath || workers <= 0) {
+        fprintf(stderr, "Usage: batch <prompts.jsonl | -> [-o results.jsonl] [--workers N] "
+                        "[--order input|completion]\n");
+        return TINYAI_CLI_EXIT_ERROR;
+    }
+    if (!ctx->model || !ctx->tokenizer) {
+        fprintf(stderr,
+                "Error: Model and tokenizer must be loaded first (use 'model load ...').\n");
+        return TINYAI_CLI_EXIT_ERROR;
+    }
+
+    FILE *in   = strcmp(inputPath, "-") == 0 ? stdin : fopen(inputPath, "r");
+    output.out = !outputPath || strcmp(outputPath, "-") == 0 ? stdout : fopen(outputPath, "w");
+    if (!in || !output.out) {
+        fprintf(stderr, "Error: Failed to open '%s'.\n", !in ? inputPath : outputPath);
+        if (in && in != stdin)
+            fclose(in);
+        if (output.out && output.out != stdout)
+            fclose(output.out);
+        return TINYAI_CLI_EXIT_ERROR;
+    }
+
+    // One slot per worker: the workers share each forward pass instead of a thread each
+    int                    contextSize = (int)ctx->model->contextSize;
+    TinyAIGenerationBatch *batch       = tinyaiCreateGenerationBatch(ctx->model, workers, 0, NULL);
+    BatchItem            **slots       = (BatchItem **)calloc((size_t)workers, sizeof(BatchItem *));
+    int                   *prompt      = (int *)malloc((size_t)contextSize * sizeof(int));
+    CLIBuffer              line        = {0};
+    int                    count       = 0;
+    int                    running     = 0;
+    bool                   eof         = false;
+    int                    result      = TINYAI_CLI_EXIT_SUCCESS;
+    uint64_t               startNs     = getTimeNs();
+
+    if (!batch || !slots || !prompt) {
+        fprintf(stderr, "Error: Failed to create the generation batch.\n");
+        result = TINYAI_CLI_EXIT_ERROR;
+        eof    = true;
+    }
+
+    while (!eof || running > 0) {
+        // Fill free slots from the input; a prompt that cannot start finishes at once
+        while (!eof && running < workers) {
+            if (!readLine(in, &line)) {
+                eof = true;
+                break;
+            }
+            if (*jsonSkipSpace(line.data) == '\0') {
+                continue;
+            }
+
+            BatchItem *item = (BatchItem *)calloc(1, sizeof(BatchItem));
+            if (!item) {
+                fprintf(stderr, "Error: Out of memory.\n");
+                result = TINYAI_CLI_EXIT_ERROR;
+                eof    = true;
+                break;
+            }
+            TinyAIGenerationParams params;
+            int                    slot = -1;
+            item->index                 = count++;
+            item->startNs               = getTimeNs();
+            item->error = parseBatchLine(ctx, line.data, item, &params, prompt, contextSize);
+            if (!item->error) {
+                slot = tinyaiGenerationBatchAdd(batch, &params, batchToken, item);
+                if (slot < 0 || slot >= workers) {
+                    item->error = "failed to start generation";
+                }
+            }
+            if (item->error) {
+                item->endNs = getTimeNs();
+                emitBatchItem(&output, item);
+                continue;
+            }
+            slots[slot] = item;
+            running++;
+        }
+        if (running == 0) {
+            continue;
+        }
+
+        int stepped = tinyaiGenerationBatchStep(batch);
+        for (int slot = 0; slot < workers; slot++) {
+            BatchItem *item = slots[slot];
+            if (!item || (stepped >= 0 && tinyaiGenerationBatchRunning(batch, slot, NULL))) {
+                continue;
+            }
+            tinyaiGenerationBatchRemove(batch, slot);
+            slots[slot] = NULL;
+            running--;
+            item->endNs = getTimeNs();
+            if (stepped < 0 && !item->error) {
+                item->error = "generation failed";
+            }
+            emitBatchItem(&output, item);
+        }
+    }
+
+    // Whatever is still parked (only after an allocation failure) goes out in order
+    for (int i = 0; i < output.pendingSize; i++) {
+        if (output.pending[i]) {
+            writeBatchResult(output.out, output.pending[i]);
+            freeBatchItem(output.pending[i]);
+        }
+    }
+    fflush(output.out);
+    if (ferror(in) || ferror(output.out)) {
+        fprintf(stderr, "Error: Failed to read prompts or write results.\n");
+        result = TINYAI_CLI_EXIT_ERROR;
+    }
+
+    double seconds = (double)(getTimeNs() - startNs) / 1e9;
+    fprintf(stderr, "Batch: %d prompts (%d failed), %llu tokens in %.2f s, %.2f tokens/sec\n",
+            count, output.failed, (unsigned long long)output.tokens, seconds,
+            seconds > 0.0 ? (double)output.tokens / seconds : 0.0);
+
+    tinyaiDestroyGenerationBatch(batch);
+    free(output.pending);
+    free(slots);
+    free(prompt);
+    free(line.data);
+    if (in != stdin)
+        fclose(in);
+    if (output.out != stdout)
+        fclose(output.out);
+    return result;
+}
+
+/**
+ * Trace command handler implementation
+ */
+int tinyaiCommandTrace(int argc, char **argv, void *context)
+{
+    (void)context;
+
+    if (argc >= 2 && strcmp(argv[1], "start") == 0) {
+        size_t spans = argc >= 3 ? (size_t)strtoul(argv[2], NULL, 10) : 0;
+        if (!tinyaiTraceStart(spans)) {
+            fprintf(stderr, "Error: Failed to start tracing.\n");
+            return TINYAI_CLI_EXIT_ERROR;
+        }
+        printf("Tracing started.\n");
+    }
+    else if (argc >= 2 && strcmp(argv[1], "stop") == 0) {
+        const char      *path = argc >= 3 ? argv[2] : "tinyai-trace.json";
+        TinyAITraceStats stats;
+        tinyaiTraceStop();
+        tinyaiTraceGetStats(&stats);
+        if (!tinyaiTraceWrite(path)) {
+            return TINYAI_CLI_EXIT_ERROR;
+        }
+        printf("Wrote %zu spans from %d threads to %s", stats.spans, stats.threads, path);
+        if (stats.dropped > 0) {
+            printf(" (%zu dropped by full buffers)", stats.dropped);
+        }
+        printf("\n");
+    }
+    else if (argc >= 2 && strcmp(argv[1], "status") == 0) {
+        TinyAITraceStats stats;
+        tinyaiTraceGetStats(&stats);
+        printf("Tracing: %s, %zu spans from %d threads, %zu dropped\n",
+               __atomic_load_n(&tinyaiTraceActive, __ATOMIC_RELAXED) ? "on" : "off", stats.spans,
+               stats.threads, stats.dropped);
+    }
+    else {
+        fprintf(stderr, "Usage: trace start [spans-per-thread] | stop [file.json] | status\n");
+        return TINYAI_CLI_EXIT_ERROR;
+    }
+
+    return TINYAI_CLI_EXIT_SUCCESS;
+}
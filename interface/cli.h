@@ -161,6 +161,12 @@ int tinyaiCommandVersion(int argc, char **argv, void *context);
  */
 int tinyaiCommandGenerate(int argc, char **argv, void *context);
 
+/**
+ * Batch command handler: generates text for a JSONL file of prompts with the
+ * continuous batching engine and writes one JSONL result per prompt
+ */
+int tinyaiCommandBatch(int argc, char **argv, void *context);
+
 /**
  * Tokenize command handler
  */
@@ -191,4 +197,9 @@ int tinyaiCommandMcp(int argc, char **argv, void *context);
  */
 int tinyaiCommandHybrid(int argc, char **argv, void *context);
 
+/**
+ * Trace command handler: records trace spans and writes them as Chrome trace JSON
+ */
+int tinyaiCommandTrace(int argc, char **argv, void *context);
+
 #endif /* TINYAI_CLI_H */
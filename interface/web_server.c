@@ -1,36 +1,1405 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h> // For getenv, atoi
 #include <string.h>
+#include <time.h>
 
-#include "../core/config.h"              // For accessing config values like model paths
-#include "../models/text/generate.h"     // For text generation functions
-#include "../models/text/tokenizer.h"    // For tokenizer
-#include "../vendor/mongoose/mongoose.h" // Absolute path from project root
+#include "../core/config.h"                // For accessing config values like model paths
+#include "../core/mcp/mcp_client.h"        // For shedding requests to a remote server
+#include "../core/memory.h"                // For TINYAI_FREE of detokenizer buffers
+#include "../models/text/generate.h"       // For text generation functions
+#include "../models/text/tokenizer.h"      // For tokenizer
+#include "../utils/advanced_memory_pool.h" // For the key/value cache memory and its stats
+#include "../utils/cancel.h"               // For stopping generations whose client went away
+#include "../utils/memory_governor.h"      // For the process's resident memory
+#include "../utils/mmap_loader.h"          // For the residency of a mapped model snapshot
+#include "../utils/trace.h"                // For request and generation trace spans
+#include "../vendor/mongoose/mongoose.h"   // Absolute path from project root
 #include "web_server.h"
 
+#ifdef _WIN32
+#include <process.h>
+#include <windows.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#endif
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
 // --- Global State (Consider managing this better in a real app) ---
-static TinyAIModel     *g_model     = NULL;
-static TinyAITokenizer *g_tokenizer = NULL;
-static picolInterp     *g_interp    = NULL; // Store interpreter if needed for commands
-static volatile int     s_exit_flag = 0;    // Flag to signal server shutdown
+static picolInterp *g_interp    = NULL;  // Store interpreter if needed for commands
+static volatile int s_exit_flag = 0;     // Flag to signal server shutdown
+static bool         g_can_wake  = false; // The scheduler can hand results to the loop
+static int          g_pending   = 0;     // Jobs queued or running
 // ---
 
 // --- Forward Declarations ---
 static void handle_api_generate(struct mg_connection *c, struct mg_http_message *hm);
+static void handle_metrics(struct mg_connection *c);
+static void handle_reload(struct mg_connection *c, struct mg_http_message *hm);
+// ---
+
+// --- Metrics ---
+// Served at /metrics in the Prometheus text format. Every thread records into
+// a shard of its own with relaxed atomic operations, so instrumentation never
+// contends for a lock or a cache line; a scrape sums the shards.
+
+#define METRIC_SHARDS 8
+#define LATENCY_BUCKETS 12
+
+static const double k_latency_bounds[LATENCY_BUCKETS] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                                                         0.5,   1.0,  2.5,   5.0,  10.0, 30.0};
+
+typedef struct {
+    uint64_t buckets[LATENCY_BUCKETS + 1]; // Observations per bucket, the last past every bound
+    uint64_t sum_us;                       // Sum of the observations in microseconds
+} LatencyHistogram;
+
+typedef struct {
+    uint64_t         requests;      // /api/generate requests received
+    uint64_t         queued;        // Requests queued as generation jobs
+    uint64_t         completed;     // Jobs that finished generating
+    uint64_t         failed;        // Jobs that failed or were dropped
+    uint64_t         prompt_tokens; // Prompt tokens of queued jobs
+    uint64_t         tokens;        // Generated tokens
+    uint64_t         rejected;      // Requests turned away with 429 or 503
+    uint64_t         shed;          // Requests sent to the remote server instead
+    uint64_t         reloads;       // Model versions switched to
+    uint64_t         reload_errors; // Model versions that failed to load
+    LatencyHistogram ttft;          // From queueing to the first token
+    LatencyHistogram token_latency; // Between consecutive tokens of a job
+
+    // Gauges the scheduler publishes after every step
+    uint64_t running;                // Jobs in the batch
+    uint64_t kv_blocks_free;         // Free blocks of the paged key/value caches
+    uint64_t prefix_lookups;         // Prompt-prefix cache lookups
+    uint64_t prefix_hits;            // Lookups that restored a prefix
+    uint64_t prefix_tokens;          // Prompt tokens looked up
+    uint64_t prefix_tokens_restored; // Prompt tokens restored instead of prefilled
+    uint64_t prefix_bytes;           // Bytes held by the prefix cache
+
+    uint64_t padding[8]; // Keeps neighbouring shards off each other's cache lines
+} MetricShard;
+
+static MetricShard               g_metrics[METRIC_SHARDS];
+static int                       g_metric_threads = 0;    // Threads given a shard so far
+static int                       g_queued_jobs    = 0;    // Jobs waiting for a batch slot
+static THREAD_LOCAL MetricShard *t_metrics        = NULL; // This thread's shard
+
+static int atomic_add(int *value, int delta)
+{
+#ifdef _WIN32
+    return (int)InterlockedExchangeAdd((volatile LONG *)value, delta) + delta;
+#else
+    return __atomic_add_fetch(value, delta, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static MetricShard *metric_shard(void)
+{
+    if (!t_metrics) {
+        t_metrics = &g_metrics[(atomic_add(&g_metric_threads, 1) - 1) % METRIC_SHARDS];
+    }
+    return t_metrics;
+}
+
+static void metric_add(uint64_t *counter, uint64_t delta)
+{
+#ifdef _WIN32
+    InterlockedExchangeAdd64((volatile LONG64 *)counter, (LONG64)delta);
+#else
+    __atomic_fetch_add(counter, delta, __ATOMIC_RELAXED);
+#endif
+}
+
+static void metric_set(uint64_t *gauge, uint64_t value)
+{
+#ifdef _WIN32
+    InterlockedExchange64((volatile LONG64 *)gauge, (LONG64)value);
+#else
+    __atomic_store_n(gauge, value, __ATOMIC_RELAXED);
+#endif
+}
+
+static uint64_t metric_read(uint64_t *value)
+{
+#ifdef _WIN32
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64 *)value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+#endif
+}
+
+static void metric_observe(LatencyHistogram *histogram, double seconds)
+{
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS && seconds > k_latency_bounds[bucket]) {
+        bucket++;
+    }
+    metric_add(&histogram->buckets[bucket], 1);
+    metric_add(&histogram->sum_us, (uint64_t)(seconds * 1e6));
+}
+
+// Monotonic time in milliseconds
+static double now_ms(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart * 1000.0 / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+// ---
+
+// --- Connections ---
+// API clients keep their connections: a whole response leaves the connection
+// open for the next request, until it sits idle for server.keepalive_ms.
+// Streamed responses end with their connection. Bodies over
+// server.max_body_kb are refused from the request headers, before Mongoose
+// buffers them.
+
+#define DEFAULT_KEEPALIVE_MS 30000
+#define DEFAULT_MAX_BODY_KB 1024
+
+// State of a connection, kept in its c->data
+typedef struct {
+    struct GenerateJob *job;         // Generation answering its request, if any
+    double              last_active; // When its last request came or response went
+    bool                close_after; // Close once the generation has answered
+} ConnState;
+
+typedef char ConnStateFits[sizeof(ConnState) <= sizeof(((struct mg_connection *)0)->data) ? 1
+                                                                                           : -1];
+
+static int    g_keepalive_ms = DEFAULT_KEEPALIVE_MS;
+static size_t g_max_body     = (size_t)DEFAULT_MAX_BODY_KB << 10;
+
+static ConnState get_conn(struct mg_connection *c)
+{
+    ConnState state;
+    memcpy(&state, c->data, sizeof(state));
+    return state;
+}
+
+static void set_conn(struct mg_connection *c, const ConnState *state)
+{
+    memcpy(c->data, state, sizeof(*state));
+}
+
+// Small writes, such as streamed tokens, go out at once instead of waiting
+// on Nagle's algorithm
+static void set_no_delay(struct mg_connection *c)
+{
+    int on = 1;
+#ifdef _WIN32
+    setsockopt((SOCKET)(size_t)c->fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+#else
+    setsockopt((int)(size_t)c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#endif
+}
+// ---
+
+// --- Batch Scheduler ---
+// The event loop only parses requests and queues them as jobs. A scheduler
+// thread runs them as one continuous batch: every step decodes the next token
+// of all running jobs in a single batched forward pass, so the model's
+// weights are read once per step however many users are waiting. Queued jobs
+// join as soon as a slot frees up, higher priority classes first and each
+// class in arrival order, and finished ones leave at once; every running job
+// gets one token per step. Everything the jobs produce goes back to the loop
+// with mg_wakeup(), so the loop keeps serving other connections meanwhile.
+//
+// Admission control keeps overload from reaching the batch: the queue is
+// bounded, and a request whose estimated wait for a slot exceeds its class's
+// latency objective is turned away with Retry-After (or shed to a remote
+// server) rather than queued behind work it cannot overtake.
+//
+// The model is held as a refcounted version: with its tokenizer, batch and
+// key/value caches. POST /api/reload loads the next version on a thread of
+// its own and then switches new requests to it; requests already queued or
+// running finish on the version they were tokenized for, and the scheduler
+// steps every live version's batch until the old one's last request ends and
+// it can be freed. Deployments roll out without dropping or stalling requests.
+
+#define DEFAULT_MAX_BATCH 8
+#define DEFAULT_PREFILL_CHUNK 64
+#define DEFAULT_PREFIX_CACHE_MB 32
+#define DEFAULT_MAX_QUEUE 64
+#define DEFAULT_SLO_MS 10000
+#define DEFAULT_MAX_REQUEST_TOKENS 4096
+#define MAX_REQUEST_TEMPERATURE 100.0
+#define PRIORITY_CLASSES 3
+
+enum { PRIORITY_HIGH, PRIORITY_NORMAL, PRIORITY_LOW };
+
+static const char *const k_priority_names[PRIORITY_CLASSES] = {"high", "normal", "low"};
+
+struct GenerateJob;
+
+typedef struct ModelVersion {
+    int                       number;         // Versions are numbered from 1 as they load
+    TinyAIModel              *model;          // Prepared model
+    TinyAITokenizer          *tokenizer;      // Tokenizer of its requests
+    bool                      owns_tokenizer; // Tokenizer to free along with the model
+    TinyAIGenerationBatch    *batch;          // Sequences being generated
+    TinyAIKVBlockPool        *kv_pool;        // Blocks of their paged caches
+    TinyAIAdvancedMemoryPool *kv_memory;      // Memory of the blocks
+    struct GenerateJob      **slots;          // Job of every batch slot
+    int                       running;        // Jobs in the batch (scheduler only)
+    int                       references;     // Held while current, and by each job
+    struct ModelVersion      *next;           // Next older live version
+} ModelVersion;
+
+typedef struct GenerateJob {
+    struct mg_mgr         *mgr;           // Manager to wake with each result
+    ModelVersion          *version;       // Model version the job runs on
+    unsigned long          conn_id;       // Connection the results go to
+    bool                   stream;        // Stream tokens as Server-Sent Events
+    int                    priority;      // Priority class of the request
+    TinyAIGenerationParams params;        // Generation parameters
+    int                   *prompt_tokens; // Copy of the prompt tokens
+    TinyAIDetokenizer      detokenizer;   // Turns tokens into whole UTF-8 text
+    int                    generated;     // Tokens generated so far
+    double                 queued_ms;     // When the job was queued
+    double                 last_token_ms; // When its last token was generated
+    TinyAIMcpAsyncCall    *remote;        // Remote call of a shed job
+    TinyAICancelToken     *cancel;        // Cancelled when the client goes away
+    int                    references;    // Held by the scheduler and the connection
+    struct GenerateJob    *next;          // Next job in the queue
+} GenerateJob;
+
+static int              g_max_batch     = 0;
+static int              g_prefill_chunk = 0;
+static int              g_prefix_mb     = 0;
+static bool             g_scheduling    = false; // Scheduler thread started
+static bool             g_stopping      = false; // Scheduler to exit once idle
+static TinyAIMcpClient *g_shed          = NULL;  // Remote server taking overflow
+static int              g_reloading     = 0;     // A new model version is loading
+static bool             g_loader_joins  = false; // The loader thread is to be joined
+
+// Versions, queues and load, guarded by the queue lock
+static ModelVersion *g_current       = NULL; // Version new requests run on
+static ModelVersion *g_versions      = NULL; // Live versions, newest first
+static int           g_version_count = 0;    // Versions loaded so far
+static GenerateJob *g_queue_head[PRIORITY_CLASSES];   // Jobs waiting for a slot, per class
+static GenerateJob *g_queue_tail[PRIORITY_CLASSES];
+static int          g_queue_jobs[PRIORITY_CLASSES];   // Jobs in each queue
+static double       g_queue_tokens[PRIORITY_CLASSES]; // Tokens they may generate
+static int          g_running_jobs   = 0;             // Jobs in the batch
+static double       g_running_tokens = 0.0;           // Tokens they may still generate
+static double       g_tokens_per_sec = 0.0;           // Smoothed batch throughput
+static int          g_max_queue      = DEFAULT_MAX_QUEUE;
+static int          g_slo_ms[PRIORITY_CLASSES]; // Longest estimated wait admitted (0 for any)
+
+#ifdef _WIN32
+static HANDLE             g_scheduler;
+static HANDLE             g_loader;
+static SRWLOCK            g_lock       = SRWLOCK_INIT;
+static CONDITION_VARIABLE g_work_ready = CONDITION_VARIABLE_INIT;
+#define lock_queue() AcquireSRWLockExclusive(&g_lock)
+#define unlock_queue() ReleaseSRWLockExclusive(&g_lock)
+#define wait_for_work() SleepConditionVariableSRW(&g_work_ready, &g_lock, INFINITE, 0)
+#define wake_scheduler() WakeConditionVariable(&g_work_ready)
+#else
+static pthread_t       g_scheduler;
+static pthread_t       g_loader;
+static pthread_mutex_t g_lock       = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_work_ready = PTHREAD_COND_INITIALIZER;
+#define lock_queue() pthread_mutex_lock(&g_lock)
+#define unlock_queue() pthread_mutex_unlock(&g_lock)
+#define wait_for_work() pthread_cond_wait(&g_work_ready, &g_lock)
+#define wake_scheduler() pthread_cond_signal(&g_work_ready)
+#endif
+
+static void destroy_model_version(ModelVersion *version)
+{
+    TinyAITokenizer *tokenizer = version->owns_tokenizer ? version->tokenizer : NULL;
+    tinyaiDestroyGenerationBatch(version->batch);
+    tinyaiDestroyKVBlockPool(version->kv_pool);
+    tinyaiAdvancedPoolDestroy(version->kv_memory);
+    free(version->slots);
+    tinyaiDestroyModel(version->model);
+    tinyaiDestroyTokenizer(tokenizer);
+    free(version);
+}
+
+// Load a model version with its batch and caches; returns NULL on failure.
+// A snapshot is mapped and used in place, and its pages are read once here
+// so the first requests on it do not fault them in.
+static ModelVersion *load_model_version(const char *model_file, const char *weights_file,
+                                        const char *tokenizer_file, const char *snapshot_file)
+{
+    TinyAIModel *model = snapshot_file ? tinyaiLoadModelSnapshot(snapshot_file)
+                                       : tinyaiLoadModel(model_file, weights_file, tokenizer_file);
+    if (!model) {
+        fprintf(stderr, "Error: Failed to load model from %s\n",
+                snapshot_file ? snapshot_file : model_file);
+        return NULL;
+    }
+    if (model->snapshot) {
+        volatile unsigned char touched = 0;
+        for (size_t offset = 0; offset < model->snapshotSize; offset += 4096) {
+            touched ^= ((const unsigned char *)model->snapshot)[offset];
+        }
+        (void)touched;
+    }
+
+    ModelVersion *version = (ModelVersion *)calloc(1, sizeof(ModelVersion));
+    if (!version) {
+        TinyAITokenizer *tokenizer = model->snapshot ? NULL : model->tokenizer;
+        tinyaiDestroyModel(model);
+        tinyaiDestroyTokenizer(tokenizer);
+        return NULL;
+    }
+    version->model          = model;
+    version->tokenizer      = model->tokenizer;
+    version->owns_tokenizer = !model->snapshot; // A snapshot's model frees its own
+    version->references     = 1;
+
+    // Paged caches only take blocks for the positions a request uses
+    int blocks = tinyaiConfigGetInt(
+        "server.kv_blocks", g_max_batch * (int)((model->contextSize + TINYAI_KV_BLOCK_SIZE - 1) /
+                                                TINYAI_KV_BLOCK_SIZE));
+    TinyAIAdvancedPoolConfig memory_config;
+    tinyaiAdvancedPoolGetDefaultConfig(&memory_config);
+    memory_config.threadSafe = true; // Scrapes read its stats from the event loop
+    version->kv_memory       = tinyaiAdvancedPoolCreate(&memory_config);
+    version->kv_pool = tinyaiCreateModelKVBlockPool(model, (uint32_t)(blocks > 0 ? blocks : 1),
+                                                    version->kv_memory);
+
+    // Repeated prompt prefixes are restored instead of prefilled
+    if (g_prefix_mb > 0 && tinyaiEnablePrefixCache(model, (size_t)g_prefix_mb << 20) != 0) {
+        fprintf(stderr, "Warning: Failed to enable the prompt-prefix cache.\n");
+    }
+
+    version->batch =
+        tinyaiCreateGenerationBatch(model, g_max_batch, g_prefill_chunk, version->kv_pool);
+    version->slots = (struct GenerateJob **)calloc((size_t)g_max_batch, sizeof(GenerateJob *));
+    if (!version->batch || !version->slots) {
+        fprintf(stderr, "Error: Failed to create the generation batch.\n");
+        destroy_model_version(version);
+        return NULL;
+    }
+    return version;
+}
+
+// Take a reference to the current version, or NULL if there is none
+static ModelVersion *acquire_version(void)
+{
+    lock_queue();
+    ModelVersion *version = g_current;
+    if (version) {
+        atomic_add(&version->references, 1);
+    }
+    unlock_queue();
+    return version;
+}
+
+// Drop a reference; the scheduler frees a version once none are left
+static void release_version(ModelVersion *version)
+{
+    if (version && atomic_add(&version->references, -1) == 0) {
+        lock_queue();
+        wake_scheduler();
+        unlock_queue();
+    }
+}
+
+static void release_job(GenerateJob *job)
+{
+    if (atomic_add(&job->references, -1) == 0) {
+        tinyaiMcpAsyncCallRelease(job->remote);
+        tinyaiDestroyCancelToken(job->cancel);
+        TINYAI_FREE(job->detokenizer.text);
+        free(job->prompt_tokens);
+        release_version(job->version);
+        free(job);
+    }
+}
+
+// Hand a message to the event loop, which writes it to the job's connection
+static void send_to_loop(GenerateJob *job, char *message)
+{
+    if (message) {
+        mg_wakeup(job->mgr, job->conn_id, message, strlen(message));
+        free(message);
+    }
+}
+
+static void send_stream_event(GenerateJob *job, const char *event, const char *json)
+{
+    send_to_loop(job, mg_mprintf("%s%s%sdata: %s\n\n", event ? "event: " : "",
+                                 event ? event : "", event ? "\n" : "", json));
+}
+
+static void send_stream_text(GenerateJob *job, int token, const char *text, int length)
+{
+    char *escaped = mg_json_esc(NULL, text, (size_t)length);
+    char *json    = escaped ? mg_mprintf("{\"token\":%d,\"text\":\"%s\"}", token, escaped) : NULL;
+    if (json) {
+        send_stream_event(job, NULL, json);
+    }
+    free(json);
+    free(escaped);
+}
+
+// A whole HTTP response, for jobs that do not stream
+static void send_response(GenerateJob *job, int status, const char *body)
+{
+    send_to_loop(job, mg_mprintf("HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                                 "Content-Length: %d\r\n\r\n%s",
+                                 status, status == 200 ? "OK" : "Error", (int)strlen(body), body));
+}
+
+// Token callback: collect each token's text, streaming it if asked to
+static bool job_token(int token, const char *piece, void *user_data)
+{
+    GenerateJob *job = (GenerateJob *)user_data;
+    const char  *text;
+    (void)piece; // The detokenizer keeps multi-byte characters whole across tokens
+
+    MetricShard *metrics = metric_shard();
+    double       now     = now_ms();
+    metric_observe(job->generated == 0 ? &metrics->ttft : &metrics->token_latency,
+                   (now - (job->generated == 0 ? job->queued_ms : job->last_token_ms)) / 1000.0);
+    metric_add(&metrics->tokens, 1);
+    job->last_token_ms = now;
+
+    int length = tinyaiDetokenizerAppend(&job->detokenizer, token, &text);
+    job->generated++;
+    if (job->stream) {
+        send_stream_text(job, token, length > 0 ? text : "", length > 0 ? length : 0);
+    }
+    return !tinyaiCancelRequested(job->cancel) && !s_exit_flag;
+}
+
+// Send a job's last output once it has left the batch (or never joined it)
+static void finish_job(GenerateJob *job, bool failed)
+{
+    // Pass on bytes held back as an unfinished character
+    const char *text;
+    int         length = tinyaiDetokenizerFlush(&job->detokenizer, &text);
+    if (job->stream) {
+        if (length > 0) {
+            send_stream_text(job, -1, text, length);
+        }
+        if (failed) {
+            send_stream_event(job, "error", "{\"error\":\"Text generation failed\"}");
+        }
+        else {
+            char done[64];
+            snprintf(done, sizeof(done), "{\"tokens\":%d}", job->generated);
+            send_stream_event(job, "done", done);
+        }
+    }
+    else if (failed || job->generated == 0) {
+        send_response(job, 500, "{\"error\":\"Text generation failed or produced no output\"}\n");
+    }
+    else {
+        char *escaped =
+            mg_json_esc(NULL, job->detokenizer.text ? job->detokenizer.text : "",
+                        job->detokenizer.length);
+        char *body = escaped ? mg_mprintf("{\"result\": \"%s\"}\n", escaped) : NULL;
+        if (body) {
+            send_response(job, 200, body);
+        }
+        else {
+            send_response(job, 500, "{\"error\":\"Failed to encode the result\"}\n");
+        }
+        free(body);
+        free(escaped);
+    }
+
+    metric_add(failed || job->generated == 0 ? &metric_shard()->failed
+                                             : &metric_shard()->completed,
+               1);
+    release_job(job);
+    atomic_add(&g_pending, -1);
+}
+
+// Oldest job of the highest priority class waiting (queue locked)
+static GenerateJob *next_job(void)
+{
+    for (int priority = 0; priority < PRIORITY_CLASSES; priority++) {
+        if (g_queue_head[priority]) {
+            return g_queue_head[priority];
+        }
+    }
+    return NULL;
+}
+
+// Take a job off the head of its queue (queue locked)
+static void pop_job(GenerateJob *job)
+{
+    int priority           = job->priority;
+    g_queue_head[priority] = job->next;
+    if (!g_queue_head[priority]) {
+        g_queue_tail[priority] = NULL;
+    }
+    g_queue_jobs[priority]--;
+    g_queue_tokens[priority] -= job->params.maxTokens;
+    atomic_add(&g_queued_jobs, -1);
+}
+
+// Record what the batches still have to generate, for wait estimates (queue locked)
+static void update_running_load(void)
+{
+    g_running_jobs   = 0;
+    g_running_tokens = 0.0;
+    for (ModelVersion *version = g_versions; version; version = version->next) {
+        for (int slot = 0; slot < g_max_batch; slot++) {
+            GenerateJob *job = version->slots[slot];
+            if (job) {
+                g_running_jobs++;
+                g_running_tokens += job->params.maxTokens - job->generated;
+            }
+        }
+    }
+}
+
+// Unlink the versions nothing holds any more, which only the scheduler
+// frees, and return them (queue locked)
+static ModelVersion *retire_versions(void)
+{
+    ModelVersion  *retired = NULL;
+    ModelVersion **link    = &g_versions;
+    while (*link) {
+        ModelVersion *version = *link;
+        if (atomic_add(&version->references, 0) == 0) {
+            *link         = version->next;
+            version->next = retired;
+            retired       = version;
+        }
+        else {
+            link = &version->next;
+        }
+    }
+    return retired;
+}
+
+// Move queued jobs into free slots of their versions' batches, highest
+// priority first, and free retired versions; returns false to stop
+static bool admit_jobs(void)
+{
+    GenerateJob  *job;
+    ModelVersion *retired;
+
+    lock_queue();
+    for (;;) {
+        update_running_load();
+        retired = retire_versions();
+        if (retired || g_running_jobs > 0 || next_job() || g_stopping) {
+            break;
+        }
+        wait_for_work();
+    }
+    bool stop = g_stopping && !next_job() && g_running_jobs == 0;
+
+    while ((job = next_job()) != NULL) {
+        ModelVersion *version = job->version;
+        int           slot    = -1;
+        if (!tinyaiCancelRequested(job->cancel) && !s_exit_flag) {
+            slot = tinyaiGenerationBatchAdd(version->batch, &job->params, job_token, job);
+            if (slot < 0 && version->running > 0) {
+                break; // Batch full: wait for a job to leave
+            }
+        }
+
+        pop_job(job);
+        if (slot < 0) {
+            unlock_queue();
+            finish_job(job, true);
+            lock_queue();
+            continue;
+        }
+        version->slots[slot] = job;
+        version->running++;
+    }
+    update_running_load();
+    unlock_queue();
+
+    while (retired) {
+        ModelVersion *next = retired->next;
+        printf("Freeing model version %d\n", retired->number);
+        destroy_model_version(retired);
+        retired = next;
+    }
+    return !stop;
+}
+
+// Tokens the jobs in a batch have generated so far
+static int batch_tokens(const ModelVersion *version)
+{
+    int tokens = 0;
+    for (int slot = 0; slot < g_max_batch; slot++) {
+        tokens += version->slots[slot] ? version->slots[slot]->generated : 0;
+    }
+    return tokens;
+}
+
+// Fold a step's throughput into the smoothed rate wait estimates use
+static void record_step(int tokens, double elapsed_ms)
+{
+    if (tokens <= 0 || elapsed_ms <= 0.0) {
+        return;
+    }
+    double rate = tokens * 1000.0 / elapsed_ms;
+    lock_queue();
+    g_tokens_per_sec = g_tokens_per_sec > 0.0 ? 0.9 * g_tokens_per_sec + 0.1 * rate : rate;
+    unlock_queue();
+}
+
+// Estimated milliseconds before a request of a class gets a batch slot, or
+// -1 while the throughput is unknown (queue locked)
+//
+// Jobs of its class and above go first. With B slots busy at T tokens per
+// second, a job averaging L tokens leaves every L / T seconds, so waiting
+// for n jobs to leave takes about n * L / T.
+static double estimate_wait_ms(int priority)
+{
+    int    jobs   = g_running_jobs;
+    double tokens = g_running_tokens;
+    for (int ahead = 0; ahead <= priority; ahead++) {
+        jobs += g_queue_jobs[ahead];
+        tokens += g_queue_tokens[ahead];
+    }
+
+    int departures = jobs - g_max_batch + 1;
+    if (departures <= 0) {
+        return 0.0;
+    }
+    if (g_tokens_per_sec <= 0.0) {
+        return -1.0;
+    }
+    return departures * (tokens / jobs) * 1000.0 / g_tokens_per_sec;
+}
+
+// Publish the state only the scheduler may read for the next scrape
+static void publish_batch_metrics(void)
+{
+    lock_queue();
+    ModelVersion *current  = g_current; // Only the scheduler frees versions
+    ModelVersion *versions = g_versions;
+    unlock_queue();
+
+    int running = 0;
+    for (ModelVersion *version = versions; version; version = version->next) {
+        running += version->running;
+    }
+
+    MetricShard           *metrics = metric_shard();
+    TinyAIPrefixCacheStats prefix;
+    tinyaiPrefixCacheGetStats(current ? current->model->prefixCache : NULL, &prefix);
+
+    metric_set(&metrics->running, (uint64_t)running);
+    metric_set(&metrics->kv_blocks_free,
+               current && current->kv_pool ? tinyaiKVBlockPoolFreeBlocks(current->kv_pool) : 0);
+    metric_set(&metrics->prefix_lookups, prefix.lookups);
+    metric_set(&metrics->prefix_hits, prefix.hits);
+    metric_set(&metrics->prefix_tokens, prefix.tokensLookedUp);
+    metric_set(&metrics->prefix_tokens_restored, prefix.tokensRestored);
+    metric_set(&metrics->prefix_bytes, prefix.memoryUsed);
+}
+
+// Decode the next token of every job of a version's batch
+static void step_version(ModelVersion *version)
+{
+    double   started = now_ms();
+    uint64_t span    = TINYAI_TRACE_BEGIN();
+    int      before  = batch_tokens(version);
+    int      running = tinyaiGenerationBatchStep(version->batch);
+    TINYAI_TRACE_END_ARG(span, "batch.step", running);
+    record_step(batch_tokens(version) - before, now_ms() - started);
+
+    // Jobs leave the batch at token boundaries
+    for (int slot = 0; slot < g_max_batch; slot++) {
+        GenerateJob *job = version->slots[slot];
+        if (job && (running < 0 || !tinyaiGenerationBatchRunning(version->batch, slot, NULL))) {
+            tinyaiGenerationBatchRemove(version->batch, slot);
+            version->slots[slot] = NULL;
+            finish_job(job, running < 0);
+        }
+    }
+    version->running = running > 0 ? running : 0;
+}
+
+#ifdef _WIN32
+static unsigned __stdcall batch_scheduler(void *arg)
+#else
+static void *batch_scheduler(void *arg)
+#endif
+{
+    (void)arg;
+    tinyaiTraceSetThreadName("scheduler");
+
+    while (admit_jobs()) {
+        // Older versions keep running their jobs alongside the current one
+        lock_queue();
+        ModelVersion *version = g_versions;
+        unlock_queue();
+        for (; version; version = version->next) {
+            if (version->running > 0) {
+                step_version(version);
+            }
+        }
+        publish_batch_metrics();
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// Read the batch sizes model versions are loaded with
+static void read_batch_config(void)
+{
+    int max_batch     = tinyaiConfigGetInt("server.max_batch", DEFAULT_MAX_BATCH);
+    int prefill_chunk = tinyaiConfigGetInt("server.prefill_chunk", DEFAULT_PREFILL_CHUNK);
+    g_max_batch       = max_batch > 0 ? max_batch : 1;
+    g_prefill_chunk   = prefill_chunk > 0 ? prefill_chunk : 0;
+    g_prefix_mb       = tinyaiConfigGetInt("server.prefix_cache_mb", DEFAULT_PREFIX_CACHE_MB);
+}
+
+// Read the admission limits, and connect to the server overflow is shed to
+static void start_admission(void)
+{
+    char key[64];
+    int  slo_ms = tinyaiConfigGetInt("server.slo_ms", DEFAULT_SLO_MS);
+    g_max_queue = tinyaiConfigGetInt("server.max_queue", DEFAULT_MAX_QUEUE);
+    for (int priority = 0; priority < PRIORITY_CLASSES; priority++) {
+        snprintf(key, sizeof(key), "server.slo_ms.%s", k_priority_names[priority]);
+        g_slo_ms[priority] = tinyaiConfigGetInt(key, slo_ms);
+    }
+
+    const char *shed_url = tinyaiConfigGetString("server.shed_url", NULL);
+    if (shed_url && shed_url[0]) {
+        TinyAIMcpConfig config;
+        tinyaiMcpGetDefaultConfig(&config);
+        g_shed = tinyaiMcpCreateClient(&config);
+        if (!g_shed || !tinyaiMcpConnect(g_shed, shed_url)) {
+            fprintf(stderr, "Warning: Failed to connect to %s; overload is not shed.\n",
+                    shed_url);
+            tinyaiMcpDestroyClient(g_shed);
+            g_shed = NULL;
+        }
+    }
+}
+
+// Start the scheduler; returns false if generation is unavailable
+static bool start_scheduler(void)
+{
+    g_stopping = false;
+#ifdef _WIN32
+    g_scheduler  = (HANDLE)_beginthreadex(NULL, 0, batch_scheduler, NULL, 0, NULL);
+    g_scheduling = g_scheduler != 0;
+#else
+    g_scheduling = pthread_create(&g_scheduler, NULL, batch_scheduler, NULL) == 0;
+#endif
+    if (g_scheduling) {
+        start_admission();
+    }
+    return g_scheduling;
+}
+
+static void stop_scheduler(void)
+{
+    if (!g_scheduling) {
+        return;
+    }
+
+    lock_queue();
+    g_stopping = true;
+    wake_scheduler();
+    unlock_queue();
+
+#ifdef _WIN32
+    WaitForSingleObject(g_scheduler, INFINITE);
+    CloseHandle(g_scheduler);
+#else
+    pthread_join(g_scheduler, NULL);
+#endif
+    g_scheduling = false;
+
+    tinyaiMcpDestroyClient(g_shed);
+    g_shed = NULL;
+}
+
+// Paths of the model version a reload loads
+typedef struct {
+    char *model;
+    char *weights;
+    char *tokenizer;
+    char *snapshot;
+} ReloadRequest;
+
+static void free_reload_request(ReloadRequest *request)
+{
+    free(request->model);
+    free(request->weights);
+    free(request->tokenizer);
+    free(request->snapshot);
+    free(request);
+}
+
+// Load the next model version and switch new requests to it
+#ifdef _WIN32
+static unsigned __stdcall model_loader(void *arg)
+#else
+static void *model_loader(void *arg)
+#endif
+{
+    ReloadRequest *request = (ReloadRequest *)arg;
+    ModelVersion  *version = load_model_version(request->model, request->weights,
+                                                request->tokenizer, request->snapshot);
+    if (version) {
+        lock_queue();
+        version->number = ++g_version_count;
+        version->next   = g_versions;
+        g_versions      = version;
+        ModelVersion *previous = g_current;
+        g_current              = version;
+        unlock_queue();
+
+        release_version(previous); // Freed once its last request ends
+        metric_add(&metric_shard()->reloads, 1);
+        printf("Switched to model version %d\n", version->number);
+    }
+    else {
+        metric_add(&metric_shard()->reload_errors, 1);
+    }
+    free_reload_request(request);
+    atomic_add(&g_reloading, -1);
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// Wait for the last reload's thread to exit
+static void join_loader(void)
+{
+    if (!g_loader_joins) {
+        return;
+    }
+#ifdef _WIN32
+    WaitForSingleObject(g_loader, INFINITE);
+    CloseHandle(g_loader);
+#else
+    pthread_join(g_loader, NULL);
+#endif
+    g_loader_joins = false;
+}
+
+// Free every model version once the scheduler has stopped
+static void free_model_versions(void)
+{
+    while (g_versions) {
+        ModelVersion *next = g_versions->next;
+        destroy_model_version(g_versions);
+        g_versions = next;
+    }
+    g_current = NULL;
+}
+
+// Arguments of a remote generate_text call, in the form the hybrid generator sends
+static char *shed_arguments(const TinyAIGenerationParams *params)
+{
+    size_t size = (size_t)params->promptLength * 13 + 256;
+    char  *args = (char *)malloc(size);
+    if (!args) {
+        return NULL;
+    }
+
+    size_t length = (size_t)snprintf(args, size, "{\"prompt\":[");
+    for (int i = 0; i < params->promptLength; i++) {
+        length += (size_t)snprintf(args + length, size - length, "%s%d", i ? "," : "",
+                                   params->promptTokens[i]);
+    }
+    snprintf(args + length, size - length,
+             "],\"max_tokens\":%d,\"temperature\":%.2f,\"sampling_method\":\"temperature\","
+             "\"top_k\":%d,\"top_p\":%.2f,\"seed\":%d}",
+             params->maxTokens, params->temperature, params->topK, params->topP, params->seed);
+    return args;
+}
+
+// Completion of a shed job: its remote tokens go out as if generated here
+static void shed_done(TinyAIMcpAsyncCall *call, void *user_data)
+{
+    GenerateJob *job    = (GenerateJob *)user_data;
+    const char  *result = NULL;
+    int          offset = -1;
+    int          length = 0;
+
+    if (tinyaiMcpAsyncCallStatus(call) == TINYAI_MCP_CALL_SUCCEEDED &&
+        tinyaiMcpAsyncCallResult(call, &result) >= 0) {
+        offset = mg_json_get(mg_str(result), "$.tokens", &length);
+    }
+    if (offset >= 0) {
+        struct mg_str tokens = mg_str_n(result + offset, (size_t)length);
+        struct mg_str value;
+        size_t        next = 0;
+        while (job->generated < job->params.maxTokens &&
+               (next = mg_json_next(tokens, next, NULL, &value)) > 0 &&
+               job_token((int)strtol(value.buf, NULL, 10), NULL, job)) {
+        }
+    }
+    finish_job(job, offset < 0);
+}
+
+// Reply to a request admission control turned away
+static void reject_request(struct mg_connection *c, int status, double wait_ms)
+{
+    char headers[96];
+    int  retry_after = wait_ms > 0.0 ? (int)(wait_ms / 1000.0) + 1 : 1;
+    snprintf(headers, sizeof(headers), "Content-Type: application/json\r\nRetry-After: %d\r\n",
+             retry_after);
+    metric_add(&metric_shard()->rejected, 1);
+    mg_http_reply(c, status, headers, "{\"error\":\"%s\",\"retry_after\":%d}\n",
+                  status == 429 ? "Server is busy" : "Request queue is full", retry_after);
+}
+
+// Queue a generation for the scheduler; the connection is answered when it ends.
+// Replies 503 when the queue is full and 429 when the estimated wait exceeds
+// the priority class's objective, unless the request can be shed instead.
+// The job takes over the caller's reference to the model version.
+static void queue_job(struct mg_connection *c, ModelVersion *version,
+                      const TinyAIGenerationParams *params, bool stream, int priority)
+{
+    GenerateJob *job = (GenerateJob *)calloc(1, sizeof(GenerateJob));
+    if (!job || !g_can_wake || !g_scheduling ||
+        !(job->prompt_tokens = (int *)malloc((size_t)params->promptLength * sizeof(int))) ||
+        !(job->cancel = tinyaiCreateCancelToken()) ||
+        tinyaiDetokenizerInit(&job->detokenizer, version->tokenizer, NULL, 0) != 0) {
+        if (job) {
+            tinyaiDestroyCancelToken(job->cancel);
+            free(job->prompt_tokens);
+            free(job);
+        }
+        release_version(version);
+        mg_http_reply(c, 503, "Content-Type: application/json\r\n",
+                      "{\"error\":\"Generation is not available\"}\n");
+        return;
+    }
+
+    job->mgr      = c->mgr;
+    job->version  = version;
+    job->conn_id  = c->id;
+    job->stream   = stream;
+    job->priority = priority;
+    job->params   = *params;
+    memcpy(job->prompt_tokens, params->promptTokens, (size_t)params->promptLength * sizeof(int));
+    job->params.promptTokens = job->prompt_tokens;
+    job->params.cancel       = job->cancel;
+    job->references          = 2;
+    job->queued_ms           = now_ms();
+
+    // Admit it, or not, in the same critical section that queues it
+    int status = 0;
+    lock_queue();
+    int queued = g_queue_jobs[PRIORITY_HIGH] + g_queue_jobs[PRIORITY_NORMAL] +
+                 g_queue_jobs[PRIORITY_LOW];
+    double wait = estimate_wait_ms(priority);
+    if (g_max_queue > 0 && queued >= g_max_queue) {
+        status = 503;
+    }
+    else if (g_slo_ms[priority] > 0 && wait > g_slo_ms[priority]) {
+        status = 429;
+    }
+    else {
+        if (g_queue_tail[priority]) {
+            g_queue_tail[priority]->next = job;
+        }
+        else {
+            g_queue_head[priority] = job;
+        }
+        g_queue_tail[priority] = job;
+        g_queue_jobs[priority]++;
+        g_queue_tokens[priority] += params->maxTokens;
+        atomic_add(&g_queued_jobs, 1);
+        wake_scheduler();
+    }
+    unlock_queue();
+
+    char *shed_args = status && g_shed && tinyaiMcpIsAvailable(g_shed) ? shed_arguments(params)
+                                                                        : NULL;
+    if (status && !shed_args) {
+        job->references = 1;
+        release_job(job);
+        reject_request(c, status, wait);
+        return;
+    }
+
+    if (stream) {
+        mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                     "Cache-Control: no-cache\r\n\r\n");
+    }
+    // The connection's reference, dropped once the job has answered
+    ConnState state = get_conn(c);
+    state.job       = job;
+    set_conn(c, &state);
+    atomic_add(&g_pending, 1);
+    metric_add(&metric_shard()->prompt_tokens, (uint64_t)params->promptLength);
+
+    if (shed_args) {
+        // Overflow runs on the remote server; the completion holds the scheduler's reference
+        TinyAIMcpAsyncOptions options = {NULL, shed_done, job};
+        atomic_add(&job->references, 1); // Keeps the job until the call is stored
+        job->remote = tinyaiMcpCallToolAsync(g_shed, "generate_text", shed_args, &options);
+        free(shed_args);
+        metric_add(&metric_shard()->shed, 1);
+        if (!job->remote) {
+            finish_job(job, true);
+        }
+        release_job(job);
+        return;
+    }
+    metric_add(&metric_shard()->queued, 1);
+}
+// ---
+
+// --- Traffic Capture ---
+// With server.capture_file set, every generation request that tokenizes is
+// appended to that file as one JSON line: its arrival time, prompt token
+// count, the generation parameters it ran with, whether it streamed and its
+// priority class. The prompt text is only recorded when
+// server.capture_redact is 0. tinyai_replay_bench replays a capture against
+// a server, so scheduling and batching changes can be measured on the
+// arrival pattern and request mix of real traffic.
+//
+// Arrival times are wall-clock milliseconds (the monotonic clock offset by
+// the wall clock at start), so the captures of successive runs can be
+// appended to one file. Lines are written and flushed on the event loop.
+
+static FILE  *g_capture          = NULL;  // File requests are appended to
+static bool   g_capture_redact   = true;  // Leave out prompt text
+static double g_capture_epoch_ms = 0.0;   // Wall-clock time of the monotonic clock's zero
+
+static void start_capture(void)
+{
+    const char *path = tinyaiConfigGetString("server.capture_file", NULL);
+    if (!path || !path[0]) {
+        return;
+    }
+    g_capture = fopen(path, "a");
+    if (!g_capture) {
+        fprintf(stderr, "Warning: Cannot open capture file %s; traffic is not captured.\n",
+                path);
+        return;
+    }
+    g_capture_redact   = tinyaiConfigGetInt("server.capture_redact", 1) != 0;
+    g_capture_epoch_ms = (double)time(NULL) * 1000.0 - now_ms();
+    printf("Capturing requests to %s%s\n", path, g_capture_redact ? " (redacted)" : "");
+}
+
+static void capture_request(const TinyAIGenerationParams *params, bool stream, int priority,
+                            const char *prompt)
+{
+    if (!g_capture) {
+        return;
+    }
+    char *escaped = g_capture_redact ? NULL : mg_json_esc(NULL, prompt, strlen(prompt));
+    fprintf(g_capture,
+            "{\"time_ms\":%.3f,\"prompt_tokens\":%d,\"max_tokens\":%d,\"temperature\":%.3f,"
+            "\"top_k\":%d,\"top_p\":%.3f,\"seed\":%d,\"stream\":%s,\"priority\":\"%s\"",
+            now_ms() + g_capture_epoch_ms, params->promptLength, params->maxTokens,
+            params->temperature, params->topK, params->topP, params->seed,
+            stream ? "true" : "false", k_priority_names[priority]);
+    if (escaped) {
+        fprintf(g_capture, ",\"prompt\":\"%s\"", escaped);
+    }
+    fprintf(g_capture, "}\n");
+    fflush(g_capture);
+    free(escaped);
+}
+
+static void stop_capture(void)
+{
+    if (g_capture) {
+        fclose(g_capture);
+        g_capture = NULL;
+    }
+}
+// ---
+
+// --- Static Assets ---
+// Web UI files are served from memory. Each is read once, on its first
+// request, together with the .br and .gz files precompressed next to it, and
+// answered with an ETag so a revisit costs a 304. Other paths, and files over
+// the cache's budget (server.asset_cache_mb), go to mg_http_serve_dir().
+
+#define ASSET_BUCKETS 64
+#define DEFAULT_ASSET_CACHE_MB 16
+
+enum { ENCODING_BROTLI, ENCODING_GZIP, ENCODING_IDENTITY, ENCODINGS };
+
+static const char *const k_encoding_names[ENCODINGS]    = {"br", "gzip", NULL};
+static const char *const k_encoding_suffixes[ENCODINGS] = {".br", ".gz", ""};
+
+typedef struct Asset {
+    char         *uri;             // Request path
+    const char   *type;            // Content type
+    char         *data[ENCODINGS]; // Contents in each encoding (NULL when absent)
+    size_t        size[ENCODINGS];
+    char          etag[24];        // Quoted hash of the contents
+    struct Asset *next;            // Next asset in its bucket
+} Asset;
+
+static Asset *g_assets[ASSET_BUCKETS];
+static size_t g_asset_bytes = 0;
+static size_t g_asset_limit = (size_t)DEFAULT_ASSET_CACHE_MB << 20;
+
+static uint64_t fnv1a(const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static const char *asset_type(const char *path)
+{
+    static const char *const types[][2] = {
+        {".html", "text/html; charset=utf-8"},
+        {".js", "text/javascript; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".json", "application/json"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".ico", "image/x-icon"},
+        {".wasm", "application/wasm"},
+        {".txt", "text/plain; charset=utf-8"},
+    };
+    const char *extension = strrchr(path, '.');
+    for (size_t i = 0; extension && i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strcmp(extension, types[i][0]) == 0) {
+            return types[i][1];
+        }
+    }
+    return "application/octet-stream";
+}
+
+// Read a whole file within the cache's budget; returns NULL if it is
+// missing, unreadable (or a directory) or too large
+static char *read_file(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    char *data   = NULL;
+    long  length = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (length >= 0 && (size_t)length <= g_asset_limit && fseek(file, 0, SEEK_SET) == 0 &&
+        (data = (char *)malloc(length > 0 ? (size_t)length : 1)) != NULL &&
+        fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+// Whether a request path names a file the cache may hold: letters, digits
+// and "/._-" only, with no hidden names or ".."
+static bool asset_uri_ok(struct mg_str uri)
+{
+    if (uri.len == 0 || uri.len > 256 || uri.buf[0] != '/') {
+        return false;
+    }
+    for (size_t i = 1; i < uri.len; i++) {
+        char ch = uri.buf[i];
+        if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+              ch == '/' || ch == '.' || ch == '_' || ch == '-') ||
+            (ch == '.' && (uri.buf[i - 1] == '/' || uri.buf[i - 1] == '.'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void free_asset(Asset *asset)
+{
+    for (int encoding = 0; encoding < ENCODINGS; encoding++) {
+        free(asset->data[encoding]);
+    }
+    free(asset->uri);
+    free(asset);
+}
+
+// Read a file and its precompressed forms into the cache; NULL if it cannot be held
+static Asset *load_asset(const char *root, struct mg_str uri, uint64_t hash)
+{
+    char   path[512];
+    char   encoded[520];
+    size_t bytes = 0;
+    snprintf(path, sizeof(path), "%s%.*s%s", root, (int)uri.len, uri.buf,
+             uri.buf[uri.len - 1] == '/' ? "index.html" : "");
+
+    Asset *asset = (Asset *)calloc(1, sizeof(Asset));
+    if (!asset) {
+        return NULL;
+    }
+    for (int encoding = 0; encoding < ENCODINGS; encoding++) {
+        snprintf(encoded, sizeof(encoded), "%s%s", path, k_encoding_suffixes[encoding]);
+        asset->data[encoding] = read_file(encoded, &asset->size[encoding]);
+        bytes += asset->size[encoding];
+    }
+    asset->uri = mg_mprintf("%.*s", (int)uri.len, uri.buf);
+    if (!asset->data[ENCODING_IDENTITY] || !asset->uri || g_asset_bytes + bytes > g_asset_limit) {
+        free_asset(asset);
+        return NULL;
+    }
+
+    asset->type = asset_type(path);
+    snprintf(asset->etag, sizeof(asset->etag), "\"%016llx\"",
+             (unsigned long long)fnv1a(asset->data[ENCODING_IDENTITY],
+                                       asset->size[ENCODING_IDENTITY]));
+    asset->next                    = g_assets[hash % ASSET_BUCKETS];
+    g_assets[hash % ASSET_BUCKETS] = asset;
+    g_asset_bytes += bytes;
+    return asset;
+}
+
+// Answer a GET or HEAD of a web UI file from the cache; returns false to leave it to Mongoose
+static bool serve_asset(struct mg_connection *c, struct mg_http_message *hm, const char *root)
+{
+    bool head = mg_match(hm->method, mg_str("HEAD"), NULL);
+    if (g_asset_limit == 0 || (!head && !mg_match(hm->method, mg_str("GET"), NULL)) ||
+        !asset_uri_ok(hm->uri)) {
+        return false;
+    }
+
+    uint64_t hash  = fnv1a(hm->uri.buf, hm->uri.len);
+    Asset   *asset = g_assets[hash % ASSET_BUCKETS];
+    while (asset && (strlen(asset->uri) != hm->uri.len ||
+                     memcmp(asset->uri, hm->uri.buf, hm->uri.len) != 0)) {
+        asset = asset->next;
+    }
+    if (!asset && !(asset = load_asset(root, hm->uri, hash))) {
+        return false;
+    }
+
+    struct mg_str *match = mg_http_get_header(hm, "If-None-Match");
+    if (match && mg_strstr(*match, mg_str(asset->etag))) {
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nContent-Length: 0\r\n\r\n",
+                  asset->etag);
+        return true;
+    }
+
+    // The smallest encoding the client takes
+    struct mg_str *accept   = mg_http_get_header(hm, "Accept-Encoding");
+    int            encoding = ENCODING_IDENTITY;
+    for (int e = 0; accept && e < ENCODING_IDENTITY; e++) {
+        if (asset->data[e] && mg_strstr(*accept, mg_str(k_encoding_names[e]))) {
+            encoding = e;
+            break;
+        }
+    }
+    const char *name = k_encoding_names[encoding];
+    mg_printf(c,
+              "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %lu\r\nETag: %s\r\n"
+              "Cache-Control: no-cache\r\nVary: Accept-Encoding\r\n%s%s%s\r\n",
+              asset->type, (unsigned long)asset->size[encoding], asset->etag,
+              name ? "Content-Encoding: " : "", name ? name : "", name ? "\r\n" : "");
+    if (!head) {
+        mg_send(c, asset->data[encoding], asset->size[encoding]);
+    }
+    return true;
+}
+
+static void free_assets(void)
+{
+    for (int bucket = 0; bucket < ASSET_BUCKETS; bucket++) {
+        while (g_assets[bucket]) {
+            Asset *next = g_assets[bucket]->next;
+            free_asset(g_assets[bucket]);
+            g_assets[bucket] = next;
+        }
+    }
+    g_asset_bytes = 0;
+}
 // ---
 
 // Mongoose event handler function
 static void fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data)
 {
-    if (ev == MG_EV_HTTP_MSG) {
+    if (ev == MG_EV_ACCEPT) {
+        ConnState state = {NULL, now_ms(), false};
+        set_conn(c, &state);
+        set_no_delay(c);
+    }
+    else if (ev == MG_EV_HTTP_HDRS) {
+        // The declared body length: refuse it before it is buffered
+        struct mg_http_message *hm = (struct mg_http_message *)ev_data;
+        if (g_max_body > 0 && hm->body.len > g_max_body && !c->is_draining) {
+            mg_http_reply(c, 413, "Content-Type: application/json\r\nConnection: close\r\n",
+                          "{\"error\":\"Request body too large\"}\n");
+            c->is_draining = 1;
+        }
+    }
+    else if (ev == MG_EV_HTTP_MSG) {
         struct mg_http_message *hm            = (struct mg_http_message *)ev_data;
         const char             *document_root = (const char *)fn_data;
+        ConnState               state         = get_conn(c);
+
+        if (c->is_draining) {
+            return; // Already answered, and closing
+        }
+        if (state.job) {
+            // Pipelined behind a generation: the connection closes once that
+            // answers, and the client retries this request on a new one
+            state.close_after = true;
+            set_conn(c, &state);
+            return;
+        }
+        state.last_active = now_ms();
+        set_conn(c, &state);
 
+        // Handling only: a generation goes on as batch steps of the scheduler
+        uint64_t    span      = TINYAI_TRACE_BEGIN();
+        const char *span_name = "http.static";
+        if (g_max_body > 0 && hm->body.len > g_max_body) {
+            // A body without a declared length, buffered past the limit
+            mg_http_reply(c, 413, "Content-Type: application/json\r\nConnection: close\r\n",
+                          "{\"error\":\"Request body too large\"}\n");
+            c->is_draining = 1;
+        }
         // Check if it's an API call
-        if (mg_http_match_uri(hm, "/api/generate") && mg_match(hm->method, mg_str("POST"), NULL)) {
+        else if (mg_http_match_uri(hm, "/api/generate") &&
+                 mg_match(hm->method, mg_str("POST"), NULL)) {
             handle_api_generate(c, hm);
+            span_name = "http.generate";
         }
-        else {
+        else if (mg_http_match_uri(hm, "/metrics")) {
+            handle_metrics(c);
+            span_name = "http.metrics";
+        }
+        else if (mg_http_match_uri(hm, "/api/reload") &&
+                 mg_match(hm->method, mg_str("POST"), NULL)) {
+            handle_reload(c, hm);
+            span_name = "http.reload";
+        }
+        else if (!serve_asset(c, hm, document_root)) {
             // Serve static files
             struct mg_http_serve_opts opts = {
                 .root_dir = document_root,
@@ -38,130 +1407,507 @@ static void fn(struct mg_connection *c, int ev, void *ev_data, void *fn_data)
             };
             mg_http_serve_dir(c, hm, &opts);
         }
+        TINYAI_TRACE_END(span, span_name);
+    }
+    else if (ev == MG_EV_WAKEUP) {
+        // Output of the batch scheduler: a stream event, where "event:" lines
+        // mark the last one and the stream ends with the connection, or a
+        // whole response, after which the connection waits for the next request
+        struct mg_str *data = (struct mg_str *)ev_data;
+        mg_send(c, data->buf, data->len);
+        if (data->len > 6 && memcmp(data->buf, "event:", 6) == 0) {
+            c->is_draining = 1;
+        }
+        else if (data->len > 5 && memcmp(data->buf, "HTTP/", 5) == 0) {
+            ConnState state = get_conn(c);
+            if (state.job) {
+                release_job(state.job);
+                state.job = NULL;
+            }
+            state.last_active = now_ms();
+            set_conn(c, &state);
+            if (state.close_after) {
+                c->is_draining = 1;
+            }
+        }
+    }
+    else if (ev == MG_EV_POLL) {
+        // Close keep-alive connections left idle
+        ConnState state = get_conn(c);
+        if (g_keepalive_ms > 0 && state.last_active > 0.0 && !state.job && c->send.len == 0 &&
+            c->recv.len == 0 && now_ms() - state.last_active > g_keepalive_ms) {
+            c->is_closing = 1;
+        }
     }
     else if (ev == MG_EV_CLOSE) {
-        // Connection closed
+        // Connection closed: stop any generation still queued, running or shed for it
+        GenerateJob *job = get_conn(c).job;
+        if (job) {
+            tinyaiCancel(job->cancel); // A prefill in flight stops within one layer
+            if (job->remote) {
+                tinyaiMcpAsyncCallCancel(job->remote);
+            }
+            release_job(job);
+        }
+    }
+}
+
+// Whether a comma-separated list of API keys holds a key
+static bool key_listed(const char *list, struct mg_str key)
+{
+    while (list && *list) {
+        const char *end = strchr(list, ',');
+        size_t      length;
+        while (*list == ' ') {
+            list++;
+        }
+        length = end ? (size_t)(end - list) : strlen(list);
+        while (length > 0 && list[length - 1] == ' ') {
+            length--;
+        }
+        if (length == key.len && length > 0 && memcmp(list, key.buf, length) == 0) {
+            return true;
+        }
+        list = end ? end + 1 : NULL;
+    }
+    return false;
+}
+
+// API key of a request, from its X-API-Key or Authorization: Bearer header
+static struct mg_str request_key(struct mg_http_message *hm)
+{
+    struct mg_str *header = mg_http_get_header(hm, "X-API-Key");
+    struct mg_str  key    = {NULL, 0};
+    if (header) {
+        key = *header;
+    }
+    else if ((header = mg_http_get_header(hm, "Authorization")) != NULL && header->len > 7 &&
+             mg_ncasecmp(header->buf, "Bearer ", 7) == 0) {
+        key = mg_str_n(header->buf + 7, header->len - 7);
+    }
+    return key;
+}
+
+// Priority class of a request from its API key. Keys listed in
+// server.keys.high or server.keys.low get those classes; others, and
+// requests without one, are normal.
+static int request_priority(struct mg_http_message *hm)
+{
+    struct mg_str key = request_key(hm);
+    if (key.len > 0) {
+        if (key_listed(tinyaiConfigGetString("server.keys.high", NULL), key)) {
+            return PRIORITY_HIGH;
+        }
+        if (key_listed(tinyaiConfigGetString("server.keys.low", NULL), key)) {
+            return PRIORITY_LOW;
+        }
+    }
+    return PRIORITY_NORMAL;
+}
+
+// Generation parameters a request body sets: "max_tokens", "temperature",
+// "top_k", "top_p" and "seed" replace the configured defaults. The body is
+// untrusted, so every value is bounded before it is converted: max_tokens to
+// server.max_request_tokens and the model's context, temperature to
+// MAX_REQUEST_TEMPERATURE, top_k to the vocabulary, and a seed outside the
+// range of int is ignored.
+static void override_params(struct mg_str body, const TinyAIConfigSnapshot *config,
+                            const ModelVersion *version, TinyAIGenerationParams *params)
+{
+    double value;
+    double max_tokens = tinyaiConfigSnapshotGetInt(config, "server.max_request_tokens",
+                                                   DEFAULT_MAX_REQUEST_TOKENS);
+    double context    = (double)version->model->contextSize;
+    double vocabulary = (double)version->tokenizer->tokenCount;
+    if (context > 0.0 && context < max_tokens) {
+        max_tokens = context;
+    }
+
+    if (mg_json_get_num(body, "$.max_tokens", &value) && value >= 1.0 && max_tokens >= 1.0) {
+        params->maxTokens = (int)(value < max_tokens ? value : max_tokens);
+    }
+    if (mg_json_get_num(body, "$.temperature", &value) && value >= 0.0) {
+        params->temperature =
+            (float)(value < MAX_REQUEST_TEMPERATURE ? value : MAX_REQUEST_TEMPERATURE);
+    }
+    if (mg_json_get_num(body, "$.top_k", &value) && value >= 0.0) {
+        params->topK = (int)(value < vocabulary ? value : vocabulary);
+    }
+    if (mg_json_get_num(body, "$.top_p", &value) && value > 0.0 && value <= 1.0) {
+        params->topP = (float)value;
+    }
+    if (mg_json_get_num(body, "$.seed", &value) && value >= (double)INT_MIN &&
+        value <= (double)INT_MAX) {
+        params->seed = (int)value;
     }
 }
 
 // API Handler for /api/generate
+// Replies with {"result": "..."} once generation ends, or, when the body has
+// "stream": true or the client accepts text/event-stream, streams each token
+// as a Server-Sent Event: data: {"token": id, "text": "..."}, ending with an
+// "event: done" (or "event: error") event. Under overload it replies 429 or
+// 503 with Retry-After instead; see queue_job().
 static void handle_api_generate(struct mg_connection *c, struct mg_http_message *hm)
 {
-    char  prompt_buf[512] = {0}; // Buffer for the prompt
-    char *result_text     = NULL;
-    int   result_len      = 0;
+    metric_add(&metric_shard()->requests, 1);
 
-    // 1. Parse prompt from JSON body: {"prompt": "..."}
-    char *prompt_val_ptr = mg_json_get_str(hm->body, "$.prompt");
-    if (prompt_val_ptr != NULL) {
-        // Copy the value, ensuring not to overflow prompt_buf
-        strncpy(prompt_buf, prompt_val_ptr, sizeof(prompt_buf) - 1);
-        prompt_buf[sizeof(prompt_buf) - 1] = '\0'; // Ensure null termination
-        // NOTE: mg_json_get_str returns a pointer into the original JSON string (hm->body).
-        // We don't free prompt_val_ptr itself.
-    }
-    else {
+    // 1. Parse prompt from JSON body: {"prompt": "..."}; its length is bounded by the body limit
+    char *prompt = mg_json_get_str(hm->body, "$.prompt");
+    if (!prompt) {
         // Handle error: prompt not found or parsing failed
         mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                       "{\"error\":\"Invalid JSON or missing/invalid 'prompt' field\"}\n");
         return;
     }
-
-    // Check if prompt_buf is still empty after potential copy
-    if (strlen(prompt_buf) == 0) {
+    if (prompt[0] == '\0') {
+        free(prompt);
         mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                       "{\"error\":\"Empty 'prompt' value provided\"}\n");
         return;
     }
 
-    // 2. Check if model is loaded
-    if (!g_model || !g_tokenizer) {
+    // 2. Check if model is loaded; the request runs on the version current now
+    ModelVersion *version = acquire_version();
+    if (!version) {
+        free(prompt);
         mg_http_reply(c, 503, "Content-Type: application/json\r\n",
                       "{\"error\":\"Model or tokenizer not loaded\"}\n");
         return;
     }
 
-    // 3. Prepare generation parameters (use defaults or config)
-    TinyAIGenerationParams params = {0};
-    params.maxTokens = tinyaiConfigGetInt("generate.max_tokens", 128); // Get from config or default
-    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;               // Example
-    params.temperature =
-        tinyaiConfigGetFloat("generate.temperature", 0.7f); // Get from config or default
-    params.topK = tinyaiConfigGetInt("generate.top_k", 40);
-    params.topP = tinyaiConfigGetFloat("generate.top_p", 0.9f);
-    params.seed = tinyaiConfigGetInt("generate.seed", 0); // 0 for random
+    // 3. Prepare generation parameters from the config snapshot, or defaults
+    const TinyAIConfigSnapshot *config = tinyaiConfigSnapshot();
+    TinyAIGenerationParams      params = {0};
+    params.maxTokens      = tinyaiConfigSnapshotGetInt(config, "generate.max_tokens", 128);
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = tinyaiConfigSnapshotGetFloat(config, "generate.temperature", 0.7f);
+    params.topK           = tinyaiConfigSnapshotGetInt(config, "generate.top_k", 40);
+    params.topP           = tinyaiConfigSnapshotGetFloat(config, "generate.top_p", 0.9f);
+    params.seed           = tinyaiConfigSnapshotGetInt(config, "generate.seed", 0); // 0 for random
+    override_params(hm->body, config, version, &params);
 
-    // 4. Tokenize the prompt
-    int prompt_tokens[512]; // Adjust size as needed
-    params.promptLength = tinyaiTokenize(g_tokenizer, prompt_buf, prompt_tokens,
-                                         sizeof(prompt_tokens) / sizeof(prompt_tokens[0]));
+    // 4. Tokenize the prompt, up to the model's context
+    int  capacity      = version->model->contextSize > 0 ? (int)version->model->contextSize : 512;
+    int *prompt_tokens = (int *)malloc((size_t)capacity * sizeof(int));
+    params.promptLength =
+        prompt_tokens ? tinyaiEncodeText(version->tokenizer, prompt, prompt_tokens, capacity) : 0;
     if (params.promptLength <= 0) {
+        release_version(version);
+        free(prompt_tokens);
+        free(prompt);
         mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                       "{\"error\":\"Failed to tokenize prompt or prompt too long\"}\n");
         return;
     }
     params.promptTokens = prompt_tokens;
 
-    // 5. Allocate buffer for output tokens - dynamically to avoid VLA issues
-    int *output_tokens = (int *)malloc((params.maxTokens + params.promptLength) * sizeof(int));
-    if (!output_tokens) {
-        mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                      "{\"error\":\"Failed to allocate memory for generation\"}\n");
-        return;
+    // Generation runs on the batch scheduler; streamed replies start at once
+    bool           stream   = false;
+    struct mg_str *accept   = mg_http_get_header(hm, "Accept");
+    int            priority = request_priority(hm);
+    mg_json_get_bool(hm->body, "$.stream", &stream);
+    stream = stream || (accept && mg_strstr(*accept, mg_str("text/event-stream")));
+    printf("Queueing generation for prompt: \"%.60s%s\"\n", prompt,
+           strlen(prompt) > 60 ? "..." : ""); // Log
+    capture_request(&params, stream, priority, prompt);
+    queue_job(c, version, &params, stream, priority);
+    free(prompt_tokens);
+    free(prompt);
+}
+
+// A path of a reload: from the request body, or else the configured one
+static char *reload_path(struct mg_http_message *hm, const char *json_path,
+                         const char *config_key)
+{
+    char *value = mg_json_get_str(hm->body, json_path);
+    if (!value && config_key) {
+        const char *configured = tinyaiConfigGetString(config_key, NULL);
+        value                  = configured && configured[0] ? mg_mprintf("%s", configured) : NULL;
     }
+    return value;
+}
 
-    // 6. Generate text
-    printf("Generating text for prompt: \"%s\"\n", prompt_buf); // Log
-    int generated_count = tinyaiGenerateText(g_model, &params, output_tokens, params.maxTokens);
+// API Handler for /api/reload: load a new model version and switch to it
+// Takes {"model", "weights", "tokenizer"} paths or a prepared {"snapshot"},
+// defaulting to the configured ones, and needs an API key listed in
+// server.keys.admin. Replies 202 at once; requests switch to the new version
+// once it has loaded, which /metrics shows as tinyai_model_version.
+static void handle_reload(struct mg_connection *c, struct mg_http_message *hm)
+{
+    if (!key_listed(tinyaiConfigGetString("server.keys.admin", NULL), request_key(hm))) {
+        mg_http_reply(c, 403, "Content-Type: application/json\r\n",
+                      "{\"error\":\"Reloading needs an admin API key\"}\n");
+        return;
+    }
+    if (!g_scheduling) {
+        mg_http_reply(c, 503, "Content-Type: application/json\r\n",
+                      "{\"error\":\"Generation is not available\"}\n");
+        return;
+    }
+    if (atomic_add(&g_reloading, 1) != 1) {
+        atomic_add(&g_reloading, -1);
+        mg_http_reply(c, 409, "Content-Type: application/json\r\n",
+                      "{\"error\":\"A model version is already loading\"}\n");
+        return;
+    }
+    join_loader();
 
-    // 7. Decode the generated tokens (excluding prompt)
-    if (generated_count > 0) {
-        result_text = tinyaiDecode(g_tokenizer, output_tokens, generated_count);
-        if (result_text) {
-            result_len = strlen(result_text);
-            printf("Generated text: %s\n", result_text); // Log
+    // Paths given in the body replace the configured model as a whole
+    ReloadRequest *request = (ReloadRequest *)calloc(1, sizeof(ReloadRequest));
+    if (request) {
+        request->snapshot = reload_path(hm, "$.snapshot", NULL);
+        request->model    = reload_path(hm, "$.model", NULL);
+        if (!request->snapshot && !request->model) {
+            request->snapshot = reload_path(hm, "$.snapshot", "model.snapshot");
+            request->model = request->snapshot ? NULL : reload_path(hm, "$.model", "model.path");
         }
-        else {
-            mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                          "{\"error\":\"Failed to decode generated tokens\"}\n");
-            return;
+        request->weights   = reload_path(hm, "$.weights", "model.weights_path");
+        request->tokenizer = reload_path(hm, "$.tokenizer", "tokenizer.path");
+    }
+    if (!request || (!request->snapshot && (!request->model || !request->tokenizer))) {
+        if (request) {
+            free_reload_request(request);
         }
+        atomic_add(&g_reloading, -1);
+        mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                      "{\"error\":\"No model or snapshot to load\"}\n");
+        return;
     }
-    else {
-        // Handle generation failure or empty output
+
+    printf("Loading model version from %s...\n",
+           request->snapshot ? request->snapshot : request->model);
+#ifdef _WIN32
+    g_loader       = (HANDLE)_beginthreadex(NULL, 0, model_loader, request, 0, NULL);
+    g_loader_joins = g_loader != 0;
+#else
+    g_loader_joins = pthread_create(&g_loader, NULL, model_loader, request) == 0;
+#endif
+    if (!g_loader_joins) {
+        free_reload_request(request);
+        atomic_add(&g_reloading, -1);
         mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                      "{\"error\":\"Text generation failed or produced no output\"}\n");
+                      "{\"error\":\"Failed to start loading the model\"}\n");
         return;
     }
 
-    // 8. Send JSON response: {"result": "..."}
-    // Use mg_http_reply which handles chunking if needed
-    mg_printf(
-        c,
-        "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n");
-    mg_http_printf_chunk(c, "{\"result\": ");
-    mg_http_write_chunk(c, "\"", 1); // Start JSON string
-    // Simple JSON escaping (replace " with \" and \ with \\) - Mongoose might have helpers?
-    // For simplicity, let's assume basic escaping is sufficient for now.
-    // A proper JSON library would be better for complex text.
-    char *escaped_result = mg_json_esc(NULL, result_text, result_len); // Mongoose helper
-    if (escaped_result) {
-        mg_http_write_chunk(c, escaped_result, strlen(escaped_result));
-        free(escaped_result);
+    lock_queue();
+    int number = g_version_count + 1;
+    unlock_queue();
+    mg_http_reply(c, 202, "Content-Type: application/json\r\n",
+                  "{\"status\":\"loading\",\"version\":%d}\n", number);
+}
+
+// Text of a /metrics reply, grown as it is written
+typedef struct {
+    char  *data;
+    size_t length;
+    size_t capacity;
+} MetricsText;
+
+static void metrics_printf(MetricsText *text, const char *format, ...)
+{
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int written = text->data ? vsnprintf(text->data + text->length,
+                                             text->capacity - text->length, format, args)
+                                 : -1;
+        va_end(args);
+        if (written >= 0 && (size_t)written < text->capacity - text->length) {
+            text->length += (size_t)written;
+            return;
+        }
+
+        size_t capacity = text->capacity ? text->capacity * 2 : 4096;
+        char  *data     = (char *)realloc(text->data, capacity);
+        if (!data) {
+            return; // The reply is cut short rather than lost
+        }
+        text->data     = data;
+        text->capacity = capacity;
+    }
+}
+
+static void metrics_value(MetricsText *text, const char *name, const char *type,
+                          const char *help, double value)
+{
+    metrics_printf(text, "# HELP %s %s\n# TYPE %s %s\n%s %.17g\n", name, help, name, type, name,
+                   value);
+}
+
+// Sum a histogram over every shard and write it with cumulative buckets
+static void metrics_histogram(MetricsText *text, const char *name, const char *help,
+                              size_t offset)
+{
+    uint64_t buckets[LATENCY_BUCKETS + 1] = {0};
+    uint64_t sum_us                       = 0;
+    for (int i = 0; i < METRIC_SHARDS; i++) {
+        LatencyHistogram *histogram = (LatencyHistogram *)((char *)&g_metrics[i] + offset);
+        for (int b = 0; b <= LATENCY_BUCKETS; b++) {
+            buckets[b] += metric_read(&histogram->buckets[b]);
+        }
+        sum_us += metric_read(&histogram->sum_us);
     }
-    else {
-        // Fallback if escaping fails (shouldn't happen often)
-        mg_http_write_chunk(c, "Error escaping result", strlen("Error escaping result"));
+
+    metrics_printf(text, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+    uint64_t count = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        count += buckets[b];
+        metrics_printf(text, "%s_bucket{le=\"%g\"} %llu\n", name, k_latency_bounds[b],
+                       (unsigned long long)count);
     }
-    mg_http_write_chunk(c, "\"", 1); // End JSON string
-    mg_http_printf_chunk(c, "}");
-    mg_http_printf_chunk(c, ""); // End chunked response
+    count += buckets[LATENCY_BUCKETS];
+    metrics_printf(text, "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.6f\n%s_count %llu\n", name,
+                   (unsigned long long)count, name, sum_us / 1e6, name,
+                   (unsigned long long)count);
+}
 
-    // 9. Clean up allocated memory
-    if (result_text) {
-        free(result_text); // Assuming tinyaiDecode allocates memory
+// Sum a counter or gauge over every shard
+static double metric_sum(size_t offset)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < METRIC_SHARDS; i++) {
+        total += metric_read((uint64_t *)((char *)&g_metrics[i] + offset));
     }
-    free(output_tokens);
+    return (double)total;
+}
+
+#define METRIC_SUM(field) metric_sum(offsetof(MetricShard, field))
+
+// API Handler for /metrics: request, latency, throughput, cache and memory telemetry
+static void handle_metrics(struct mg_connection *c)
+{
+    static double last_scrape_ms = 0.0; // Scrapes only run on the event loop
+    static double last_tokens    = 0.0;
+
+    MetricsText text   = {NULL, 0, 0};
+    double      now    = now_ms();
+    double      tokens = METRIC_SUM(tokens);
+
+    metrics_value(&text, "tinyai_requests_total", "counter",
+                  "Generation requests received", METRIC_SUM(requests));
+    metrics_value(&text, "tinyai_requests_queued_total", "counter",
+                  "Generation requests queued for the batch scheduler", METRIC_SUM(queued));
+    metrics_value(&text, "tinyai_requests_completed_total", "counter",
+                  "Generation requests that finished", METRIC_SUM(completed));
+    metrics_value(&text, "tinyai_requests_failed_total", "counter",
+                  "Generation requests that failed or were dropped", METRIC_SUM(failed));
+    metrics_value(&text, "tinyai_requests_rejected_total", "counter",
+                  "Generation requests turned away with 429 or 503", METRIC_SUM(rejected));
+    metrics_value(&text, "tinyai_requests_shed_total", "counter",
+                  "Generation requests sent to the remote server under overload",
+                  METRIC_SUM(shed));
+    metrics_value(&text, "tinyai_queue_depth", "gauge", "Requests waiting for a batch slot",
+                  (double)atomic_add(&g_queued_jobs, 0));
+
+    lock_queue();
+    double wait = estimate_wait_ms(PRIORITY_NORMAL);
+    double rate = g_tokens_per_sec;
+    unlock_queue();
+    // Model versions
+    lock_queue();
+    int current_number = g_current ? g_current->number : 0;
+    int live_versions  = 0;
+    for (ModelVersion *version = g_versions; version; version = version->next) {
+        live_versions++;
+    }
+    unlock_queue();
+    metrics_value(&text, "tinyai_model_version", "gauge",
+                  "Model version new requests run on", current_number);
+    metrics_value(&text, "tinyai_model_versions_live", "gauge",
+                  "Model versions loaded, counting ones finishing their last requests",
+                  live_versions);
+    metrics_value(&text, "tinyai_model_reloads_total", "counter",
+                  "Model versions switched to after the first", METRIC_SUM(reloads));
+    metrics_value(&text, "tinyai_model_reload_errors_total", "counter",
+                  "Model versions that failed to load", METRIC_SUM(reload_errors));
+
+    metrics_value(&text, "tinyai_estimated_wait_seconds", "gauge",
+                  "Estimated wait for a batch slot of a normal-priority request",
+                  wait > 0.0 ? wait / 1000.0 : 0.0);
+    metrics_value(&text, "tinyai_batch_tokens_per_second", "gauge",
+                  "Smoothed throughput of the decoding batch while it runs", rate);
+    metrics_value(&text, "tinyai_batch_running", "gauge", "Requests in the decoding batch",
+                  METRIC_SUM(running));
+    metrics_value(&text, "tinyai_prompt_tokens_total", "counter",
+                  "Prompt tokens of queued requests", METRIC_SUM(prompt_tokens));
+    metrics_value(&text, "tinyai_generated_tokens_total", "counter", "Tokens generated", tokens);
+    metrics_value(&text, "tinyai_tokens_per_second", "gauge",
+                  "Tokens generated per second since the previous scrape",
+                  last_scrape_ms > 0.0 && now > last_scrape_ms
+                      ? (tokens - last_tokens) * 1000.0 / (now - last_scrape_ms)
+                      : 0.0);
+    last_scrape_ms = now;
+    last_tokens    = tokens;
+
+    metrics_histogram(&text, "tinyai_time_to_first_token_seconds",
+                      "Time from queueing a request to its first token",
+                      offsetof(MetricShard, ttft));
+    metrics_histogram(&text, "tinyai_token_latency_seconds",
+                      "Time between consecutive tokens of a request",
+                      offsetof(MetricShard, token_latency));
+
+    // Key/value and prompt-prefix caches
+    double lookups = METRIC_SUM(prefix_lookups);
+    double looked  = METRIC_SUM(prefix_tokens);
+    metrics_value(&text, "tinyai_kv_blocks_free", "gauge",
+                  "Free blocks of the paged key/value caches", METRIC_SUM(kv_blocks_free));
+    metrics_value(&text, "tinyai_prefix_cache_lookups_total", "counter",
+                  "Prompt-prefix cache lookups", lookups);
+    metrics_value(&text, "tinyai_prefix_cache_hits_total", "counter",
+                  "Prompt-prefix cache lookups that restored a prefix", METRIC_SUM(prefix_hits));
+    metrics_value(&text, "tinyai_prefix_cache_hit_rate", "gauge",
+                  "Share of prompt-prefix cache lookups that restored a prefix",
+                  lookups > 0 ? METRIC_SUM(prefix_hits) / lookups : 0.0);
+    metrics_value(&text, "tinyai_kv_cache_hit_rate", "gauge",
+                  "Share of looked-up prompt tokens restored instead of prefilled",
+                  looked > 0 ? METRIC_SUM(prefix_tokens_restored) / looked : 0.0);
+    metrics_value(&text, "tinyai_prefix_cache_bytes", "gauge",
+                  "Bytes held by the prompt-prefix cache", METRIC_SUM(prefix_bytes));
+
+    // Memory of the current version's key/value cache blocks
+    ModelVersion *version = acquire_version();
+    if (version && version->kv_memory) {
+        TinyAIAdvancedPoolStats pool;
+        tinyaiAdvancedPoolGetStats(version->kv_memory, &pool);
+        metrics_value(&text, "tinyai_memory_pool_allocated_bytes", "gauge",
+                      "Bytes the key/value memory pool holds", (double)pool.totalAllocated);
+        metrics_value(&text, "tinyai_memory_pool_used_bytes", "gauge",
+                      "Bytes of the key/value memory pool in use", (double)pool.totalUsed);
+        metrics_value(&text, "tinyai_memory_pool_wasted_bytes", "gauge",
+                      "Bytes of the key/value memory pool lost to rounding",
+                      (double)pool.totalWasted);
+        metrics_value(&text, "tinyai_memory_pool_cache_hit_rate", "gauge",
+                      "Share of allocations served from a thread cache", pool.cacheHitRate);
+        metrics_value(&text, "tinyai_memory_pool_pressure", "gauge",
+                      "Memory pressure score of the key/value memory pool (0-100)",
+                      pool.pressureScore);
+    }
+
+    // Residency of the mapped model snapshot, and of the whole process
+    if (version && version->model->snapshot) {
+        TinyAIModel *model = version->model;
+        metrics_value(&text, "tinyai_model_mapped_bytes", "gauge",
+                      "Bytes of the mapped model snapshot", (double)model->snapshotSize);
+        metrics_value(&text, "tinyai_model_resident_bytes", "gauge",
+                      "Bytes of the mapped model snapshot resident in memory",
+                      (double)tinyaiGetMappingResidentBytes(model->snapshot, model->snapshotSize));
+    }
+    release_version(version);
+    metrics_value(&text, "tinyai_process_resident_bytes", "gauge",
+                  "Resident memory of the server process", (double)tinyaiGetResidentMemory());
+
+    if (!text.data) {
+        mg_http_reply(c, 500, "Content-Type: text/plain\r\n", "Out of memory\n");
+        return;
+    }
+    mg_printf(c,
+              "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+              "Content-Length: %lu\r\n\r\n",
+              (unsigned long)text.length);
+    mg_send(c, text.data, text.length);
+    free(text.data);
 }
 
 // Function to start the web server
@@ -171,45 +1917,58 @@ int start_web_server(picolInterp *interp, const char *port, const char *document
     char          addr[64];
 
     // --- Load Model and Tokenizer ---
-    // Get paths from config (assuming they are set via CLI or config file)
-    const char *model_file = tinyaiConfigGet("model.path", NULL);
+    // Get paths from config (assuming they are set via CLI or config file); a
+    // prepared snapshot holds the model and its tokenizer in one mapped file
+    const char *snapshot_file = tinyaiConfigGetString("model.snapshot", NULL);
+    const char *model_file    = tinyaiConfigGetString("model.path", NULL);
     const char *weights_file =
-        tinyaiConfigGet("model.weights_path", NULL); // Assuming separate weights
-    const char *tokenizer_file = tinyaiConfigGet("tokenizer.path", NULL);
+        tinyaiConfigGetString("model.weights_path", NULL); // Assuming separate weights
+    const char *tokenizer_file = tinyaiConfigGetString("tokenizer.path", NULL);
 
-    if (!model_file || !tokenizer_file) {
+    if (!snapshot_file && (!model_file || !tokenizer_file)) {
         fprintf(stderr, "Error: Model or Tokenizer path not configured.\n");
         fprintf(stderr, "Please specify using --model and --tokenizer options or config file.\n");
         return 1;
     }
-    // If weights are separate, check for weights_file too
 
-    printf("Loading tokenizer from %s...\n", tokenizer_file);
-    g_tokenizer = tinyaiLoadTokenizer(tokenizer_file);
-    if (!g_tokenizer) {
-        fprintf(stderr, "Error: Failed to load tokenizer from %s\n", tokenizer_file);
-        return 1;
-    }
+    // Connection and static file settings
+    int max_body_kb = tinyaiConfigGetInt("server.max_body_kb", DEFAULT_MAX_BODY_KB);
+    int asset_mb    = tinyaiConfigGetInt("server.asset_cache_mb", DEFAULT_ASSET_CACHE_MB);
+    g_keepalive_ms  = tinyaiConfigGetInt("server.keepalive_ms", DEFAULT_KEEPALIVE_MS);
+    g_max_body      = max_body_kb > 0 ? (size_t)max_body_kb << 10 : 0;
+    g_asset_limit   = asset_mb > 0 ? (size_t)asset_mb << 20 : 0;
 
-    printf("Loading model from %s...\n", model_file);
-    // Assuming tinyaiLoadModel handles both structure and weights if weights_file is NULL
-    g_model = tinyaiLoadModel(model_file, weights_file, tokenizer_file);
-    if (!g_model) {
-        fprintf(stderr, "Error: Failed to load model from %s\n", model_file);
-        tinyaiDestroyTokenizer(g_tokenizer); // Clean up tokenizer
-        g_tokenizer = NULL;
+    // The first model version; /api/reload switches to later ones
+    read_batch_config();
+    printf("Loading model from %s...\n", snapshot_file ? snapshot_file : model_file);
+    g_current = load_model_version(model_file, weights_file, tokenizer_file, snapshot_file);
+    if (!g_current) {
         return 1;
     }
-    // Assign tokenizer to model if not done by tinyaiLoadModel
-    if (g_model->tokenizer == NULL) {
-        g_model->tokenizer = g_tokenizer;
-    }
+    g_version_count   = 1;
+    g_current->number = g_version_count;
+    g_versions        = g_current;
     // --- Model Loaded ---
 
     g_interp = interp; // Store interpreter if needed later
 
-    // Initialize Mongoose manager
+    // A trace of the whole run, written at shutdown
+    const char *trace_file = tinyaiConfigGetString("server.trace_file", NULL);
+    if (trace_file && trace_file[0]) {
+        tinyaiTraceStart(0);
+    }
+    tinyaiTraceSetThreadName("http");
+    start_capture();
+
+    // Initialize Mongoose manager; wakeups let the scheduler write to connections
     mg_mgr_init(&mgr);
+    g_can_wake = mg_wakeup_init(&mgr);
+    if (!g_can_wake) {
+        fprintf(stderr, "Warning: Generation is unavailable without event loop wakeups.\n");
+    }
+    if (g_can_wake && !start_scheduler()) {
+        fprintf(stderr, "Warning: Failed to start the generation scheduler.\n");
+    }
     snprintf(addr, sizeof(addr), "http://0.0.0.0:%s", port);
 
     printf("Starting web server on %s, serving %s\n", addr, document_root);
@@ -217,9 +1976,10 @@ int start_web_server(picolInterp *interp, const char *port, const char *document
     // Create listening connection
     if (mg_http_listen(&mgr, addr, fn, (void *)document_root) == NULL) {
         fprintf(stderr, "Error: Cannot listen on %s. Is the port already in use?\n", addr);
+        stop_scheduler();
         mg_mgr_free(&mgr);
-        tinyaiDestroyModel(g_model);
-        tinyaiDestroyTokenizer(g_tokenizer);
+        free_model_versions();
+        stop_capture();
         return 1;
     }
 
@@ -229,15 +1989,28 @@ int start_web_server(picolInterp *interp, const char *port, const char *document
         mg_mgr_poll(&mgr, 1000); // Poll with 1 second timeout
     }
 
-    // Cleanup
+    // Cleanup: jobs stop at the next token, then deliver their last output
     printf("Shutting down web server...\n");
+    if (g_shed) {
+        tinyaiMcpDisconnect(g_shed); // Cancels the calls of shed jobs
+    }
+    while (atomic_add(&g_pending, 0) > 0) {
+        mg_mgr_poll(&mgr, 50);
+    }
+    join_loader();
+    stop_scheduler();
     mg_mgr_free(&mgr);
-    tinyaiDestroyModel(g_model);
-    tinyaiDestroyTokenizer(g_tokenizer);
-    g_model     = NULL;
-    g_tokenizer = NULL;
-    g_interp    = NULL;
+    free_model_versions();
+    free_assets();
+    stop_capture();
+    g_interp = NULL;
 
+    if (trace_file && trace_file[0]) {
+        tinyaiTraceStop();
+        if (tinyaiTraceWrite(trace_file)) {
+            printf("Trace written to %s\n", trace_file);
+        }
+    }
     return 0;
 }
 
@@ -0,0 +1,638 @@
+/**
+ * @file audio_feature_store.c
+ * @brief Batch feature extraction into memory-mappable feature stores
+ */
+
+#include "audio_feature_store.h"
+#include "audio_utils.h"
+#include "../../utils/thread_pool.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Input samples resampled at a time */
+#define RESAMPLE_BLOCK 1024
+
+/* Frames a batch stream holds between pops */
+#define STREAM_FRAMES 64
+
+/* Index entry flag of a recording that could not be loaded */
+#define ENTRY_MISSING 1u
+
+/**
+ * Header at the start of a feature store
+ */
+typedef struct {
+    uint32_t magic;         /* TINYAI_FEATURE_STORE_MAGIC */
+    uint32_t version;       /* TINYAI_FEATURE_STORE_VERSION */
+    uint32_t numRecordings; /* Entries in the index */
+    uint32_t featureSize;   /* Floats in one frame */
+    uint32_t featureType;   /* TinyAIAudioFeaturesType of the frames */
+    uint32_t sampleRate;    /* Sample rate the recordings were resampled to */
+    uint32_t frameShift;    /* Samples between frames at that rate */
+    uint32_t reserved;
+    uint64_t indexOffset; /* Offset of the index */
+    uint64_t fileSize;    /* Size of the whole store */
+} FeatureStoreHeader;
+
+/**
+ * Index entry of one recording
+ */
+typedef struct {
+    uint64_t dataOffset; /* Offset of the recording's frames (0 when missing) */
+    uint32_t numFrames;  /* Number of frames */
+    uint32_t flags;      /* ENTRY_MISSING */
+} FeatureStoreEntry;
+
+/**
+ * A mapped feature store
+ */
+struct TinyAIAudioFeatureStore {
+    const uint8_t            *data; /* Mapping of the whole file */
+    size_t                    size;
+    const FeatureStoreHeader *header;
+    const FeatureStoreEntry  *entries;
+#ifdef _WIN32
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+#endif
+};
+
+/**
+ * Per-recording state of a batch, reused by every group of recordings
+ */
+typedef struct {
+    TinyAIAudioFeatureStream *stream;
+    TinyAIAudioResampler     *resampler;     /* Resampler of the last rate that needed one */
+    int                       resamplerRate; /* Input rate of the resampler */
+    float                    *input;         /* One block of decoded input */
+    float                    *block;         /* Resampled output of one block of input */
+    float                    *frames;        /* Frames of the current recording */
+    size_t                    capacity;      /* Floats frames holds */
+    int                       numFrames;     /* Frames of the current recording */
+    bool                      loaded;        /* Whether the current recording was loaded */
+} BatchSlot;
+
+/**
+ * A group of recordings extracted side by side
+ */
+typedef struct {
+    const char *const *paths;
+    BatchSlot         *slots;
+    int                first; /* Index of the group's first recording */
+    int                sampleRate;
+    int                frameLength;
+    int                frameShift;
+    int                featureSize;
+} BatchGroup;
+
+static uint64_t alignStoreOffset(uint64_t offset)
+{
+    return (offset + TINYAI_FEATURE_STORE_ALIGNMENT - 1) &
+           ~(uint64_t)(TINYAI_FEATURE_STORE_ALIGNMENT - 1);
+}
+
+/* Write zeros up to offset */
+static bool padStoreFile(FILE *fp, uint64_t *position, uint64_t offset)
+{
+    static const uint8_t zeros[TINYAI_FEATURE_STORE_ALIGNMENT] = {0};
+    while (*position < offset) {
+        size_t n = (size_t)(offset - *position < sizeof(zeros) ? offset - *position
+                                                               : sizeof(zeros));
+        if (fwrite(zeros, 1, n, fp) != n) {
+            return false;
+        }
+        *position += n;
+    }
+    return true;
+}
+
+/*
+ * Push samples into the slot's stream, popping completed frames straight
+ * into their place in the slot's frame buffer
+ */
+static bool pushRecordingSamples(BatchSlot *slot, const BatchGroup *group, const float *samples,
+                                 int numSamples, int numFrames)
+{
+    for (int pushed = 0; pushed < numSamples;) {
+        int consumed = tinyaiAudioFeatureStreamPush(slot->stream, samples + pushed,
+                                                    numSamples - pushed);
+        int popped   = tinyaiAudioFeatureStreamPop(
+            slot->stream, slot->frames + (size_t)slot->numFrames * group->featureSize,
+            numFrames - slot->numFrames);
+        if (consumed < 0 || popped < 0 || (consumed == 0 && popped == 0)) {
+            return false;
+        }
+        pushed += consumed;
+        slot->numFrames += popped;
+    }
+    return true;
+}
+
+/* The slot keeps its resampler while recordings share a rate */
+static bool prepareResampler(BatchSlot *slot, int rate, const BatchGroup *group)
+{
+    if (slot->resampler && slot->resamplerRate == rate) {
+        return true;
+    }
+
+    tinyaiAudioResamplerFree(slot->resampler);
+    slot->resampler     = tinyaiAudioResamplerCreate(rate, group->sampleRate);
+    slot->resamplerRate = rate;
+    int    size         = tinyaiAudioResamplerMaxOutput(slot->resampler, RESAMPLE_BLOCK);
+    float *block = slot->resampler ? (float *)realloc(slot->block, size * sizeof(float)) : NULL;
+    if (block) {
+        slot->block = block;
+        return true;
+    }
+    tinyaiAudioResamplerFree(slot->resampler);
+    slot->resampler = NULL;
+    return false;
+}
+
+/* Size the slot's frame buffer for a recording and reset its stream */
+static bool reserveFrames(BatchSlot *slot, int numFrames, const BatchGroup *group)
+{
+    size_t needed = (size_t)numFrames * group->featureSize;
+    if (needed > slot->capacity) {
+        float *frames = (float *)realloc(slot->frames, needed * sizeof(float));
+        if (!frames) {
+            return false;
+        }
+        slot->frames   = frames;
+        slot->capacity = needed;
+    }
+
+    tinyaiAudioFeatureStreamReset(slot->stream);
+    slot->numFrames = 0;
+    return true;
+}
+
+static int countFrames(int numSamples, const BatchGroup *group)
+{
+    return numSamples >= group->frameLength
+               ? (numSamples - group->frameLength) / group->frameShift + 1
+               : 0;
+}
+
+/*
+ * Stream a WAV recording through the slot's stream: each block is read,
+ * decoded to mono and resampled, then pushed, so the recording's samples
+ * are never in memory at once. The frame count is known from the header,
+ * so the frames are popped straight into their final buffer.
+ */
+static bool streamWavRecording(BatchSlot *slot, TinyAIWavReader *reader, const BatchGroup *group)
+{
+    TinyAIAudioFormat format;
+    tinyaiWavReaderGetFormat(reader, &format);
+    int64_t numSamples = tinyaiWavReaderNumFrames(reader);
+    int     rate       = format.sampleRate;
+    bool    resample   = rate != group->sampleRate;
+    if (numSamples > INT_MAX) {
+        return false;
+    }
+
+    int64_t outSamples = resample ? (numSamples * group->sampleRate + rate - 1) / rate
+                                  : numSamples;
+    int     numFrames  = countFrames(outSamples > INT_MAX ? INT_MAX : (int)outSamples, group);
+    bool    ok         = reserveFrames(slot, numFrames, group);
+    if (ok && resample) {
+        tinyaiAudioResamplerReset(slot->resampler);
+    }
+
+    int n;
+    while (ok && (n = tinyaiWavReaderRead(reader, slot->input, RESAMPLE_BLOCK)) != 0) {
+        if (n < 0) {
+            ok = false;
+        }
+        else if (resample) {
+            int m = tinyaiAudioResamplerProcess(slot->resampler, slot->input, n, slot->block);
+            ok    = m >= 0 && pushRecordingSamples(slot, group, slot->block, m, numFrames);
+        }
+        else {
+            ok = pushRecordingSamples(slot, group, slot->input, n, numFrames);
+        }
+    }
+    if (ok && resample) {
+        int m = tinyaiAudioResamplerFlush(slot->resampler, slot->block);
+        ok    = m >= 0 && pushRecordingSamples(slot, group, slot->block, m, numFrames);
+    }
+    if (ok) {
+        slot->numFrames += tinyaiAudioFeatureStreamPop(
+            slot->stream, slot->frames + (size_t)slot->numFrames * group->featureSize,
+            numFrames - slot->numFrames);
+    }
+
+    /* A file cut short keeps the frames of the samples it has */
+    return ok && (slot->numFrames == numFrames || tinyaiWavReaderNumFrames(reader) < numSamples);
+}
+
+/*
+ * Extract one recording. WAV files at a rate with a filter bank stream
+ * through a reader; anything else is loaded whole and run through the
+ * slot's stream, resampling a block at a time.
+ */
+static bool extractRecording(BatchSlot *slot, const char *path, const BatchGroup *group)
+{
+    if (!path) {
+        return false;
+    }
+
+    TinyAIWavReader *reader = tinyaiWavReaderOpen(path);
+    if (reader) {
+        TinyAIAudioFormat format;
+        tinyaiWavReaderGetFormat(reader, &format);
+        if (format.sampleRate == group->sampleRate ||
+            prepareResampler(slot, format.sampleRate, group)) {
+            bool ok = streamWavRecording(slot, reader, group);
+            tinyaiWavReaderClose(reader);
+            return ok;
+        }
+        tinyaiWavReaderClose(reader);
+    }
+
+    TinyAIAudioData audio;
+    if (!tinyaiAudioDataLoad(path, &audio)) {
+        return false;
+    }
+    if (!audio.data || audio.format.sampleRate <= 0) {
+        tinyaiAudioDataFree(&audio);
+        return false;
+    }
+
+    /* The loader decodes to float mono */
+    const float *samples    = (const float *)audio.data;
+    int          numSamples = (int)(audio.dataSize / sizeof(float));
+    int          rate       = audio.format.sampleRate;
+    bool         resample   = rate != group->sampleRate;
+
+    if (resample) {
+        prepareResampler(slot, rate, group);
+    }
+
+    /* Rates without a filter bank are resampled whole by tinyaiAudioResample */
+    TinyAIAudioData resampled;
+    memset(&resampled, 0, sizeof(resampled));
+    int outSamples = numSamples;
+    if (resample && slot->resampler) {
+        outSamples = (int)(((int64_t)numSamples * group->sampleRate + rate - 1) / rate);
+    }
+    else if (resample) {
+        if (!tinyaiAudioResample(&audio, &resampled, group->sampleRate)) {
+            tinyaiAudioDataFree(&audio);
+            return false;
+        }
+        samples    = (const float *)resampled.data;
+        numSamples = outSamples = (int)(resampled.dataSize / sizeof(float));
+        resample   = false;
+    }
+    int numFrames = countFrames(outSamples, group);
+
+    bool ok = reserveFrames(slot, numFrames, group);
+    if (ok && resample) {
+        tinyaiAudioResamplerReset(slot->resampler);
+        for (int start = 0; ok && start < numSamples; start += RESAMPLE_BLOCK) {
+            int n = numSamples - start < RESAMPLE_BLOCK ? numSamples - start : RESAMPLE_BLOCK;
+            int m = tinyaiAudioResamplerProcess(slot->resampler, samples + start, n, slot->block);
+            ok    = m >= 0 && pushRecordingSamples(slot, group, slot->block, m, numFrames);
+        }
+        int m = ok ? tinyaiAudioResamplerFlush(slot->resampler, slot->block) : -1;
+        ok    = m >= 0 && pushRecordingSamples(slot, group, slot->block, m, numFrames);
+    }
+    else if (ok) {
+        ok = pushRecordingSamples(slot, group, samples, numSamples, numFrames);
+    }
+    if (ok) {
+        slot->numFrames += tinyaiAudioFeatureStreamPop(
+            slot->stream, slot->frames + (size_t)slot->numFrames * group->featureSize,
+            numFrames - slot->numFrames);
+    }
+
+    tinyaiAudioDataFree(&resampled);
+    tinyaiAudioDataFree(&audio);
+    return ok && slot->numFrames == numFrames;
+}
+
+/* Parallel task: extract a range of the group's recordings */
+static void extractRecordingsTask(void *context, size_t begin, size_t end)
+{
+    const BatchGroup *group = (const BatchGroup *)context;
+    for (size_t i = begin; i < end; i++) {
+        BatchSlot *slot = &group->slots[i];
+        slot->loaded    = extractRecording(slot, group->paths[group->first + i], group);
+    }
+}
+
+/**
+ * Extract features from a corpus of recordings into a feature store
+ * @param paths Paths of the recordings
+ * @param numPaths Number of recordings
+ * @param config Feature extraction configuration
+ * @param advancedOptions Advanced options (NULL for defaults)
+ * @param sampleRate Sample rate every recording is resampled to, in Hz
+ * @param maxInFlight Most recordings in memory at once (0 for the number of threads)
+ * @param storePath Path of the store to create
+ * @return Number of recordings stored, negative on failure
+ */
+int tinyaiAudioBuildFeatureStore(const char *const *paths, int numPaths,
+                                 const TinyAIAudioFeaturesConfig          *config,
+                                 const TinyAIAudioFeaturesAdvancedOptions *advancedOptions,
+                                 int sampleRate, int maxInFlight, const char *storePath)
+{
+    if ((!paths && numPaths > 0) || numPaths < 0 || !config || sampleRate <= 0 ||
+        maxInFlight < 0 || !storePath) {
+        return -1;
+    }
+
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    if (maxInFlight == 0) {
+        maxInFlight = tinyaiThreadPoolSize(pool);
+    }
+    int numSlots = numPaths < maxInFlight ? numPaths : maxInFlight;
+
+    BatchSlot         *slots   = (BatchSlot *)calloc(numSlots > 0 ? numSlots : 1,
+                                                     sizeof(BatchSlot));
+    FeatureStoreEntry *entries = (FeatureStoreEntry *)calloc(numPaths > 0 ? numPaths : 1,
+                                                             sizeof(FeatureStoreEntry));
+    bool               ok      = slots && entries;
+
+    /* Every slot has its own stream, all sharing the configuration's tables */
+    int featureSize = 0;
+    for (int i = 0; ok && i < numSlots; i++) {
+        BatchSlot *slot = &slots[i];
+        slot->stream    = tinyaiAudioFeatureStreamCreate(config, advancedOptions, sampleRate,
+                                                         STREAM_FRAMES);
+        featureSize     = tinyaiAudioFeatureStreamFeatureSize(slot->stream);
+        slot->frames    = (float *)malloc(featureSize * sizeof(float));
+        slot->capacity  = featureSize;
+        slot->input     = (float *)malloc(RESAMPLE_BLOCK * sizeof(float));
+        ok              = slot->stream && slot->frames && slot->input;
+    }
+    if (ok && numSlots == 0) {
+        /* An empty corpus still records the frame size */
+        TinyAIAudioFeatureStream *stream =
+            tinyaiAudioFeatureStreamCreate(config, advancedOptions, sampleRate, 1);
+        featureSize = tinyaiAudioFeatureStreamFeatureSize(stream);
+        ok          = stream != NULL;
+        tinyaiAudioFeatureStreamFree(stream);
+    }
+
+    FeatureStoreHeader header = {0};
+    header.magic              = TINYAI_FEATURE_STORE_MAGIC;
+    header.version            = TINYAI_FEATURE_STORE_VERSION;
+    header.numRecordings      = (uint32_t)numPaths;
+    header.featureSize        = (uint32_t)featureSize;
+    header.featureType        = (uint32_t)config->type;
+    header.sampleRate         = (uint32_t)sampleRate;
+    header.frameShift         = (uint32_t)config->frameShift;
+    header.indexOffset        = alignStoreOffset(sizeof(FeatureStoreHeader));
+
+    /* Frames first; the header and the index are written once every offset is known */
+    FILE    *fp       = ok ? fopen(storePath, "wb") : NULL;
+    uint64_t position = 0;
+    ok                = fp != NULL &&
+         padStoreFile(fp, &position,
+                      header.indexOffset + (uint64_t)numPaths * sizeof(FeatureStoreEntry));
+
+    int        stored = 0;
+    BatchGroup group  = {paths, slots, 0, sampleRate, config->frameLength, config->frameShift,
+                         featureSize};
+    for (int first = 0; ok && first < numPaths; first += numSlots) {
+        int count   = numPaths - first < numSlots ? numPaths - first : numSlots;
+        group.first = first;
+        tinyaiParallelFor(pool, (size_t)count, 1, extractRecordingsTask, &group);
+
+        for (int i = 0; ok && i < count; i++) {
+            const BatchSlot   *slot  = &slots[i];
+            FeatureStoreEntry *entry = &entries[first + i];
+            if (!slot->loaded) {
+                entry->flags = ENTRY_MISSING;
+                continue;
+            }
+
+            size_t size       = (size_t)slot->numFrames * featureSize;
+            entry->dataOffset = alignStoreOffset(position);
+            entry->numFrames  = (uint32_t)slot->numFrames;
+            ok                = padStoreFile(fp, &position, entry->dataOffset) &&
+                 fwrite(slot->frames, sizeof(float), size, fp) == size;
+            position += size * sizeof(float);
+            stored++;
+        }
+    }
+    header.fileSize = position;
+
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1 &&
+         fseek(fp, (long)header.indexOffset, SEEK_SET) == 0 &&
+         (numPaths == 0 ||
+          fwrite(entries, sizeof(FeatureStoreEntry), numPaths, fp) == (size_t)numPaths);
+
+    if (fp && fclose(fp) != 0) {
+        ok = false;
+    }
+    if (fp && !ok) {
+        remove(storePath);
+    }
+
+    for (int i = 0; slots && i < numSlots; i++) {
+        tinyaiAudioFeatureStreamFree(slots[i].stream);
+        tinyaiAudioResamplerFree(slots[i].resampler);
+        free(slots[i].input);
+        free(slots[i].block);
+        free(slots[i].frames);
+    }
+    free(slots);
+    free(entries);
+    return ok ? stored : -1;
+}
+
+/* Map a whole file read-only */
+static bool mapStoreFile(TinyAIAudioFeatureStore *store, const char *path)
+{
+#ifdef _WIN32
+    store->fileHandle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL, NULL);
+    if (store->fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    DWORD highSize;
+    DWORD lowSize = GetFileSize(store->fileHandle, &highSize);
+    store->size   = (((size_t)highSize) << 32) | lowSize;
+    if (store->size < sizeof(FeatureStoreHeader)) {
+        CloseHandle(store->fileHandle);
+        return false;
+    }
+
+    store->mappingHandle =
+        CreateFileMapping(store->fileHandle, NULL, PAGE_READONLY, highSize, lowSize, NULL);
+    if (!store->mappingHandle) {
+        CloseHandle(store->fileHandle);
+        return false;
+    }
+
+    store->data = (const uint8_t *)MapViewOfFile(store->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!store->data) {
+        CloseHandle(store->mappingHandle);
+        CloseHandle(store->fileHandle);
+        return false;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(FeatureStoreHeader)) {
+        close(fd);
+        return false;
+    }
+    store->size = (size_t)st.st_size;
+
+    /* The mapping outlives the descriptor */
+    void *data = mmap(NULL, store->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    store->data = (const uint8_t *)data;
+#endif
+    return true;
+}
+
+static void unmapStoreFile(TinyAIAudioFeatureStore *store)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(store->data);
+    CloseHandle(store->mappingHandle);
+    CloseHandle(store->fileHandle);
+#else
+    munmap((void *)store->data, store->size);
+#endif
+}
+
+/* Check that the header and every entry lie within the file */
+static bool validateStore(const TinyAIAudioFeatureStore *store)
+{
+    const FeatureStoreHeader *header = store->header;
+    if (header->magic != TINYAI_FEATURE_STORE_MAGIC ||
+        header->version != TINYAI_FEATURE_STORE_VERSION || header->fileSize != store->size ||
+        header->featureSize == 0 || header->indexOffset % sizeof(uint64_t) != 0 ||
+        header->indexOffset > store->size ||
+        (store->size - header->indexOffset) / sizeof(FeatureStoreEntry) <
+            header->numRecordings) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->numRecordings; i++) {
+        const FeatureStoreEntry *entry = &store->entries[i];
+        if (entry->flags & ENTRY_MISSING) {
+            continue;
+        }
+        uint64_t bytes = (uint64_t)entry->numFrames * header->featureSize * sizeof(float);
+        if (entry->dataOffset % sizeof(float) != 0 || entry->dataOffset > store->size ||
+            bytes > store->size - entry->dataOffset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Map a feature store for reading
+ * @param path Path of the store
+ * @return Newly opened store, or NULL on failure or if the file is not a valid store
+ */
+TinyAIAudioFeatureStore *tinyaiAudioFeatureStoreOpen(const char *path)
+{
+    if (!path) {
+        return NULL;
+    }
+
+    TinyAIAudioFeatureStore *store =
+        (TinyAIAudioFeatureStore *)calloc(1, sizeof(TinyAIAudioFeatureStore));
+    if (!store) {
+        return NULL;
+    }
+    if (!mapStoreFile(store, path)) {
+        free(store);
+        return NULL;
+    }
+
+    store->header = (const FeatureStoreHeader *)store->data;
+    store->entries =
+        (const FeatureStoreEntry *)(store->data + (size_t)store->header->indexOffset);
+    if (!validateStore(store)) {
+        tinyaiAudioFeatureStoreClose(store);
+        return NULL;
+    }
+    return store;
+}
+
+/**
+ * Unmap a feature store
+ * @param store The store to close
+ */
+void tinyaiAudioFeatureStoreClose(TinyAIAudioFeatureStore *store)
+{
+    if (!store) {
+        return;
+    }
+    unmapStoreFile(store);
+    free(store);
+}
+
+/**
+ * Get the number of recordings in a feature store
+ * @param store The store to query
+ * @return Number of recordings, 0 if store is NULL
+ */
+int tinyaiAudioFeatureStoreNumRecordings(const TinyAIAudioFeatureStore *store)
+{
+    return store ? (int)store->header->numRecordings : 0;
+}
+
+/**
+ * Get the number of features in each frame of a feature store
+ * @param store The store to query
+ * @return Features per frame, 0 if store is NULL
+ */
+int tinyaiAudioFeatureStoreFeatureSize(const TinyAIAudioFeatureStore *store)
+{
+    return store ? (int)store->header->featureSize : 0;
+}
+
+/**
+ * Get the frames of one recording, in place in the mapping
+ * @param store The store to read
+ * @param index Index of the recording
+ * @param frames Output parameter for the frames
+ * @param numFrames Output parameter for the number of frames
+ * @return true on success, false if the index is out of range or the recording is missing
+ */
+bool tinyaiAudioFeatureStoreGetRecording(const TinyAIAudioFeatureStore *store, int index,
+                                         const float **frames, int *numFrames)
+{
+    if (!store || !frames || !numFrames || index < 0 ||
+        (uint32_t)index >= store->header->numRecordings) {
+        return false;
+    }
+
+    const FeatureStoreEntry *entry = &store->entries[index];
+    if (entry->flags & ENTRY_MISSING) {
+        return false;
+    }
+    *frames    = (const float *)(store->data + (size_t)entry->dataOffset);
+    *numFrames = (int)entry->numFrames;
+    return true;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file audio_feature_store.h
+ * @brief Batch feature extraction into memory-mappable feature stores
+ *
+ * A feature store holds the feature frames of a corpus of recordings in one
+ * file: a header, an index with one entry per recording, and each
+ * recording's frames as contiguous floats. Stores are read back through a
+ * read-only mapping, so model passes over a corpus use the frames in place.
+ */
+
+#ifndef TINYAI_AUDIO_FEATURE_STORE_H
+#define TINYAI_AUDIO_FEATURE_STORE_H
+
+#include "audio_features.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Feature store file format
+ *
+ * Little-endian. The index follows the header, and the frames of every
+ * recording start at a multiple of TINYAI_FEATURE_STORE_ALIGNMENT bytes.
+ */
+#define TINYAI_FEATURE_STORE_MAGIC 0x53464154 /* "TAFS" in ASCII */
+#define TINYAI_FEATURE_STORE_VERSION 1
+#define TINYAI_FEATURE_STORE_ALIGNMENT 64
+
+/**
+ * A feature store mapped for reading
+ */
+typedef struct TinyAIAudioFeatureStore TinyAIAudioFeatureStore;
+
+/**
+ * Extract features from a corpus of recordings into a feature store
+ *
+ * Recordings are decoded, resampled and run through a feature stream on
+ * the shared thread pool, up to maxInFlight at a time: only those
+ * recordings' frames are in memory, and each group is written to the
+ * store, in the order of paths, before the next one is started. WAV files
+ * are read, downmixed and resampled a block at a time as their samples are
+ * pushed into the stream; other recordings are loaded whole first. Frames are those of
+ * tinyaiAudioFeatureStreamCreate, without delta features. A recording that
+ * cannot be loaded keeps its index entry, marked as missing.
+ * @param paths Paths of the recordings
+ * @param numPaths Number of recordings
+ * @param config Feature extraction configuration
+ * @param advancedOptions Advanced options (NULL for defaults)
+ * @param sampleRate Sample rate every recording is resampled to, in Hz
+ * @param maxInFlight Most recordings in memory at once (0 for the number of threads)
+ * @param storePath Path of the store to create
+ * @return Number of recordings stored, negative on failure
+ */
+int tinyaiAudioBuildFeatureStore(const char *const *paths, int numPaths,
+                                 const TinyAIAudioFeaturesConfig          *config,
+                                 const TinyAIAudioFeaturesAdvancedOptions *advancedOptions,
+                                 int sampleRate, int maxInFlight, const char *storePath);
+
+/**
+ * Map a feature store for reading
+ * @param path Path of the store
+ * @return Newly opened store, or NULL on failure or if the file is not a valid store
+ */
+TinyAIAudioFeatureStore *tinyaiAudioFeatureStoreOpen(const char *path);
+
+/**
+ * Unmap a feature store; the frames it returned are no longer valid
+ * @param store The store to close
+ */
+void tinyaiAudioFeatureStoreClose(TinyAIAudioFeatureStore *store);
+
+/**
+ * Get the number of recordings in a feature store, including missing ones
+ * @param store The store to query
+ * @return Number of recordings, 0 if store is NULL
+ */
+int tinyaiAudioFeatureStoreNumRecordings(const TinyAIAudioFeatureStore *store);
+
+/**
+ * Get the number of features in each frame of a feature store
+ * @param store The store to query
+ * @return Features per frame, 0 if store is NULL
+ */
+int tinyaiAudioFeatureStoreFeatureSize(const TinyAIAudioFeatureStore *store);
+
+/**
+ * Get the frames of one recording, in place in the mapping
+ * @param store The store to read
+ * @param index Index of the recording, in the order it was given when the store was built
+ * @param frames Output parameter for the frames [numFrames x feature size]
+ * @param numFrames Output parameter for the number of frames
+ * @return true on success, false if the index is out of range or the recording is missing
+ */
+bool tinyaiAudioFeatureStoreGetRecording(const TinyAIAudioFeatureStore *store, int index,
+                                         const float **frames, int *numFrames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_AUDIO_FEATURE_STORE_H */
@@ -113,78 +113,280 @@ bool tinyaiAudioApplyWindow(const float *samples, int numSamples, TinyAIWindowTy
     return true;
 }
 
+/*
+ * Real-input FFT plans
+ *
+ * A real frame of N samples is transformed as N/2 complex points, the even
+ * samples as real parts and the odd ones as imaginary parts, and the two
+ * interleaved half spectra are separated afterwards. Everything that only
+ * depends on N - bit-reversed positions and twiddle factors - is computed
+ * once per plan.
+ */
+struct TinyAIFFTPlan {
+    int    size;      /* Real samples transformed */
+    int    half;      /* Complex points of the inner transform, size / 2 */
+    int   *reverse;   /* Bit-reversed position of each complex point [half] */
+    float *twiddleRe; /* exp(-i*pi*j/m) at [m + j], for the stages of half size m >= 4 */
+    float *twiddleIm;
+    float *splitRe; /* exp(-2i*pi*k/size) for separating the half spectra [half / 2 + 1] */
+    float *splitIm;
+};
+
+/* Largest plan size is 2^30; plans of other sizes are cached by exponent */
+#define FFT_MAX_BITS 30
+
+static TinyAIFFTPlan *g_fftPlans[FFT_MAX_BITS + 1];
+
 /**
- * Compute bit reversal for FFT
- * @param i Index to reverse
- * @param bits Number of bits
- * @return Bit-reversed index
+ * Exponent of a power-of-2 size, or -1 for any other size
  */
-static int bitReverse(int i, int bits)
+static int fftBits(int size)
 {
-    int j = 0;
-    for (int b = 0; b < bits; b++) {
-        j = (j << 1) | (i & 1);
-        i >>= 1;
+    if (size <= 0 || (size & (size - 1)) != 0) {
+        return -1;
     }
-    return j;
+    int bits = 0;
+    while ((1 << bits) < size) {
+        bits++;
+    }
+    return bits;
 }
 
 /**
- * Compute FFT using Cooley-Tukey algorithm
- * @param real Real part of input/output
- * @param imag Imaginary part of input/output
- * @param size Size of FFT (must be power of 2)
+ * Create an FFT plan for real frames of one size
+ * @param fftSize Size of FFT (power of 2)
+ * @return Newly allocated plan, or NULL on failure
  */
-static void fft(float *real, float *imag, int size)
+TinyAIFFTPlan *tinyaiAudioCreateFFTPlan(int fftSize)
 {
-    /* Check if size is power of 2 */
-    int bits = 0;
-    int temp = size;
-    while (temp > 1) {
-        temp >>= 1;
-        bits++;
+    int bits = fftBits(fftSize);
+    if (bits < 0 || bits > FFT_MAX_BITS) {
+        return NULL;
     }
 
-    /* Bit reversal */
-    for (int i = 0; i < size; i++) {
-        int j = bitReverse(i, bits);
-        if (j > i) {
-            float temp_real = real[i];
-            float temp_imag = imag[i];
-            real[i]         = real[j];
-            imag[i]         = imag[j];
-            real[j]         = temp_real;
-            imag[j]         = temp_imag;
+    TinyAIFFTPlan *plan = (TinyAIFFTPlan *)calloc(1, sizeof(TinyAIFFTPlan));
+    if (!plan) {
+        return NULL;
+    }
+    plan->size = fftSize;
+    plan->half = fftSize / 2;
+
+    /* A plan of size 1 has no complex points, but keeps non-NULL tables */
+    int points      = plan->half > 0 ? plan->half : 1;
+    int splitCount  = plan->half / 2 + 1;
+    plan->reverse   = (int *)malloc(points * sizeof(int));
+    plan->twiddleRe = (float *)malloc(points * sizeof(float));
+    plan->twiddleIm = (float *)malloc(points * sizeof(float));
+    plan->splitRe   = (float *)malloc(splitCount * sizeof(float));
+    plan->splitIm   = (float *)malloc(splitCount * sizeof(float));
+    if (!plan->reverse || !plan->twiddleRe || !plan->twiddleIm || !plan->splitRe ||
+        !plan->splitIm) {
+        tinyaiAudioFreeFFTPlan(plan);
+        return NULL;
+    }
+
+    /* Bit-reversed positions over the bits of the complex transform */
+    int half     = plan->half;
+    int halfBits = bits > 0 ? bits - 1 : 0;
+    for (int i = 0; i < half; i++) {
+        int j = 0;
+        for (int b = 0, v = i; b < halfBits; b++, v >>= 1) {
+            j = (j << 1) | (v & 1);
         }
+        plan->reverse[i] = j;
     }
 
-    /* FFT computation */
-    for (int stage = 1; stage <= bits; stage++) {
-        int   m     = 1 << stage;
-        int   m2    = m >> 1;
-        float wr    = 1.0f;
-        float wi    = 0.0f;
-        float theta = -PI / (float)m2;
-        float wpr   = cosf(theta);
-        float wpi   = sinf(theta);
-
-        for (int j = 0; j < m2; j++) {
-            for (int i = j; i < size; i += m) {
-                int   k  = i + m2;
-                float tr = wr * real[k] - wi * imag[k];
-                float ti = wr * imag[k] + wi * real[k];
-                real[k]  = real[i] - tr;
-                imag[k]  = imag[i] - ti;
-                real[i] += tr;
-                imag[i] += ti;
+    /* Twiddles in double precision, so large sizes do not accumulate rounding */
+    for (int m = 4; m < half; m <<= 1) {
+        for (int j = 0; j < m; j++) {
+            double angle           = -3.14159265358979323846 * j / m;
+            plan->twiddleRe[m + j] = (float)cos(angle);
+            plan->twiddleIm[m + j] = (float)sin(angle);
+        }
+    }
+    for (int k = 0; k < splitCount; k++) {
+        double angle     = -6.28318530717958647692 * k / fftSize;
+        plan->splitRe[k] = (float)cos(angle);
+        plan->splitIm[k] = (float)sin(angle);
+    }
+
+    return plan;
+}
+
+/**
+ * Free an FFT plan
+ * @param plan The plan to free
+ */
+void tinyaiAudioFreeFFTPlan(TinyAIFFTPlan *plan)
+{
+    if (!plan) {
+        return;
+    }
+    free(plan->reverse);
+    free(plan->twiddleRe);
+    free(plan->twiddleIm);
+    free(plan->splitRe);
+    free(plan->splitIm);
+    free(plan);
+}
+
+/**
+ * Complex FFT of points already in bit-reversed order
+ *
+ * The first two stages only multiply by 1 and -i, so they run together as
+ * one radix-4 pass. The later stages read their twiddles from a contiguous
+ * run of the table, so the inner loop over a group's butterflies vectorizes.
+ */
+static void fftComplex(const TinyAIFFTPlan *plan, float *re, float *im)
+{
+    int n = plan->half;
+
+    if (n == 2) {
+        float r = re[1], i = im[1];
+        re[1]   = re[0] - r;
+        im[1]   = im[0] - i;
+        re[0] += r;
+        im[0] += i;
+        return;
+    }
+
+    for (int g = 0; g + 3 < n; g += 4) {
+        float r0 = re[g] + re[g + 1], i0 = im[g] + im[g + 1];
+        float r1 = re[g] - re[g + 1], i1 = im[g] - im[g + 1];
+        float r2 = re[g + 2] + re[g + 3], i2 = im[g + 2] + im[g + 3];
+        float r3 = re[g + 2] - re[g + 3], i3 = im[g + 2] - im[g + 3];
+
+        /* The odd butterfly of the second stage takes -i * (r3 + i*i3) = i3 - i*r3 */
+        re[g]     = r0 + r2;
+        im[g]     = i0 + i2;
+        re[g + 2] = r0 - r2;
+        im[g + 2] = i0 - i2;
+        re[g + 1] = r1 + i3;
+        im[g + 1] = i1 - r3;
+        re[g + 3] = r1 - i3;
+        im[g + 3] = i1 + r3;
+    }
+
+    for (int m = 4; m < n; m <<= 1) {
+        const float *wr = plan->twiddleRe + m;
+        const float *wi = plan->twiddleIm + m;
+        for (int g = 0; g < n; g += 2 * m) {
+            float *ar = re + g, *ai = im + g;
+            float *br = ar + m, *bi = ai + m;
+            for (int j = 0; j < m; j++) {
+                float tr = wr[j] * br[j] - wi[j] * bi[j];
+                float ti = wr[j] * bi[j] + wi[j] * br[j];
+                br[j]    = ar[j] - tr;
+                bi[j]    = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
             }
-            float wtemp = wr;
-            wr          = wr * wpr - wi * wpi;
-            wi          = wi * wpr + wtemp * wpi;
         }
     }
 }
 
+/**
+ * Compute the FFT of a frame of real samples with a plan
+ *
+ * @param plan Plan for the FFT size
+ * @param samples Array of audio samples (windowed)
+ * @param numSamples Number of samples (<= the plan's size; the rest are zero)
+ * @param real Output real part of FFT [size]
+ * @param imag Output imaginary part of FFT [size]
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioExecuteFFTPlan(const TinyAIFFTPlan *plan, const float *samples, int numSamples,
+                               float *real, float *imag)
+{
+    if (!plan || !samples || !real || !imag || numSamples <= 0 || numSamples > plan->size) {
+        return false;
+    }
+
+    int size = plan->size;
+    int n    = plan->half;
+    if (size == 1) {
+        real[0] = samples[0];
+        imag[0] = 0.0f;
+        return true;
+    }
+
+    /* Even and odd samples become the complex points, stored straight in bit-reversed order */
+    for (int m = 0; m < n; m++) {
+        int   r = plan->reverse[m];
+        int   s = 2 * m;
+        real[r] = s < numSamples ? samples[s] : 0.0f;
+        imag[r] = s + 1 < numSamples ? samples[s + 1] : 0.0f;
+    }
+    if (n > 1) {
+        fftComplex(plan, real, imag);
+    }
+
+    /*
+     * Separate the spectra of the even samples, E = (Z[k] + conj(Z[n-k])) / 2,
+     * and the odd samples, O = -i (Z[k] - conj(Z[n-k])) / 2. Then
+     * X[k] = E + W^k O and X[n-k] = conj(E - W^k O), so each pair of bins is
+     * rewritten in place from the same pair of complex points.
+     */
+    float z0 = real[0];
+    real[0]  = z0 + imag[0];
+    real[n]  = z0 - imag[0];
+    imag[0]  = 0.0f;
+    imag[n]  = 0.0f;
+    for (int k = 1; k <= n / 2; k++) {
+        int   l  = n - k;
+        float evenRe = 0.5f * (real[k] + real[l]);
+        float evenIm = 0.5f * (imag[k] - imag[l]);
+        float oddRe  = 0.5f * (imag[k] + imag[l]);
+        float oddIm  = -0.5f * (real[k] - real[l]);
+        float tr     = plan->splitRe[k] * oddRe - plan->splitIm[k] * oddIm;
+        float ti     = plan->splitRe[k] * oddIm + plan->splitIm[k] * oddRe;
+        real[k]      = evenRe + tr;
+        imag[k]      = evenIm + ti;
+        real[l]      = evenRe - tr;
+        imag[l]      = ti - evenIm;
+    }
+
+    /* The upper half of a real signal's spectrum mirrors the lower half */
+    for (int k = 1; k < n; k++) {
+        real[size - k] = real[k];
+        imag[size - k] = -imag[k];
+    }
+
+    return true;
+}
+
+/**
+ * Plan for an FFT size, created on first use and kept for the life of the process
+ *
+ * Plans are never changed once published, so threads share them freely;
+ * two threads asking for a new size at once may both build it, and the
+ * loser frees its copy.
+ */
+static const TinyAIFFTPlan *cachedFFTPlan(int fftSize)
+{
+    int bits = fftBits(fftSize);
+    if (bits < 0 || bits > FFT_MAX_BITS) {
+        return NULL;
+    }
+
+    TinyAIFFTPlan *plan = __atomic_load_n(&g_fftPlans[bits], __ATOMIC_ACQUIRE);
+    if (plan) {
+        return plan;
+    }
+
+    plan = tinyaiAudioCreateFFTPlan(fftSize);
+    if (!plan) {
+        return NULL;
+    }
+    TinyAIFFTPlan *expected = NULL;
+    if (!__atomic_compare_exchange_n(&g_fftPlans[bits], &expected, plan, false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+        tinyaiAudioFreeFFTPlan(plan);
+        plan = expected;
+    }
+    return plan;
+}
+
 /**
  * Compute FFT of a frame of audio samples
  * @param samples Array of audio samples (windowed)
@@ -201,30 +403,13 @@ bool tinyaiAudioComputeFFT(const float *samples, int numSamples, int fftSize, fl
         return false;
     }
 
-    /* Check if fftSize is power of 2 */
-    int temp = fftSize;
-    while (temp > 1) {
-        if (temp & 1) {
-            return false; /* Not a power of 2 */
-        }
-        temp >>= 1;
-    }
-
-    /* Initialize real and imaginary parts */
-    for (int i = 0; i < fftSize; i++) {
-        if (i < numSamples) {
-            real[i] = samples[i];
-        }
-        else {
-            real[i] = 0.0f; /* Zero padding */
-        }
-        imag[i] = 0.0f;
+    /* Plans exist only for powers of 2 */
+    const TinyAIFFTPlan *plan = cachedFFTPlan(fftSize);
+    if (!plan) {
+        return false;
     }
 
-    /* Compute FFT */
-    fft(real, imag, fftSize);
-
-    return true;
+    return tinyaiAudioExecuteFFTPlan(plan, samples, numSamples, real, imag);
 }
 
 /**
@@ -373,15 +558,11 @@ bool tinyaiAudioApplyMelFilterBank(const float *spectrum, int spectrumSize, cons
         return false;
     }
 
-    /* Initialize mel energies to zeros */
-    memset(melEnergies, 0, numFilters * sizeof(float));
-
     /* Apply filter bank */
     for (int i = 0; i < numFilters; i++) {
         /* Compute weighted sum */
-        for (int j = 0; j < spectrumSize; j++) {
-            melEnergies[i] += spectrum[j] * filterBank[i * spectrumSize + j];
-        }
+        melEnergies[i] = tinyaiSimdDot(spectrum, filterBank + (size_t)i * spectrumSize,
+                                       spectrumSize);
 
         /* Avoid negative energies (due to floating-point errors) */
         if (melEnergies[i] < 1e-10f) {
@@ -392,6 +573,135 @@ bool tinyaiAudioApplyMelFilterBank(const float *spectrum, int spectrumSize, cons
     return true;
 }
 
+/*
+ * Sparse mel filter bank
+ *
+ * Each triangular filter covers a short run of bins, so only that run of
+ * weights is stored, packed one filter after another.
+ */
+struct TinyAISparseMelFilterBank {
+    int    numFilters;
+    int   *start;  /* First bin of each filter */
+    int   *length; /* Bins of each filter */
+    int   *offset; /* Position of each filter's weights in weights */
+    float *weights;
+};
+
+/**
+ * Create a mel filter bank that stores only the nonzero run of each filter
+ * @param numFilters Number of mel filters
+ * @param fftSize Size of FFT
+ * @param sampleRate Sample rate in Hz
+ * @param fMin Minimum frequency in Hz
+ * @param fMax Maximum frequency in Hz
+ * @return Newly allocated filter bank, or NULL on failure
+ */
+TinyAISparseMelFilterBank *tinyaiAudioCreateSparseMelFilterBank(int numFilters, int fftSize,
+                                                                int sampleRate, float fMin,
+                                                                float fMax)
+{
+    if (numFilters <= 0 || fftSize <= 0) {
+        return NULL;
+    }
+
+    int    halfSize = fftSize / 2 + 1;
+    float *dense    = (float *)malloc((size_t)numFilters * halfSize * sizeof(float));
+    if (!dense || !tinyaiAudioCreateMelFilterBank(numFilters, fftSize, sampleRate, fMin, fMax,
+                                                  dense)) {
+        free(dense);
+        return NULL;
+    }
+
+    TinyAISparseMelFilterBank *bank =
+        (TinyAISparseMelFilterBank *)calloc(1, sizeof(TinyAISparseMelFilterBank));
+    if (!bank) {
+        free(dense);
+        return NULL;
+    }
+    bank->numFilters = numFilters;
+    bank->start      = (int *)malloc(numFilters * sizeof(int));
+    bank->length     = (int *)malloc(numFilters * sizeof(int));
+    bank->offset     = (int *)malloc(numFilters * sizeof(int));
+    if (!bank->start || !bank->length || !bank->offset) {
+        free(dense);
+        tinyaiAudioFreeSparseMelFilterBank(bank);
+        return NULL;
+    }
+
+    /* Trim the zeros around each filter */
+    int total = 0;
+    for (int i = 0; i < numFilters; i++) {
+        const float *filter = dense + (size_t)i * halfSize;
+        int          begin  = 0;
+        int          end    = halfSize;
+        while (begin < end && filter[begin] == 0.0f) {
+            begin++;
+        }
+        while (end > begin && filter[end - 1] == 0.0f) {
+            end--;
+        }
+        bank->start[i]  = begin;
+        bank->length[i] = end - begin;
+        bank->offset[i] = total;
+        total += end - begin;
+    }
+
+    bank->weights = (float *)malloc((total > 0 ? total : 1) * sizeof(float));
+    if (!bank->weights) {
+        free(dense);
+        tinyaiAudioFreeSparseMelFilterBank(bank);
+        return NULL;
+    }
+    for (int i = 0; i < numFilters; i++) {
+        memcpy(bank->weights + bank->offset[i], dense + (size_t)i * halfSize + bank->start[i],
+               bank->length[i] * sizeof(float));
+    }
+
+    free(dense);
+    return bank;
+}
+
+/**
+ * Free a sparse mel filter bank
+ * @param bank The filter bank to free
+ */
+void tinyaiAudioFreeSparseMelFilterBank(TinyAISparseMelFilterBank *bank)
+{
+    if (!bank) {
+        return;
+    }
+    free(bank->start);
+    free(bank->length);
+    free(bank->offset);
+    free(bank->weights);
+    free(bank);
+}
+
+/**
+ * Apply a sparse mel filter bank to a spectrum
+ * @param bank Sparse mel filter bank
+ * @param spectrum Input power/magnitude spectrum (fftSize/2+1)
+ * @param melEnergies Output mel filter energies
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioApplySparseMelFilterBank(const TinyAISparseMelFilterBank *bank,
+                                         const float *spectrum, float *melEnergies)
+{
+    if (!bank || !spectrum || !melEnergies) {
+        return false;
+    }
+
+    for (int i = 0; i < bank->numFilters; i++) {
+        float energy = tinyaiSimdDot(spectrum + bank->start[i], bank->weights + bank->offset[i],
+                                     bank->length[i]);
+
+        /* Avoid negative energies (due to floating-point errors) */
+        melEnergies[i] = energy < 1e-10f ? 1e-10f : energy;
+    }
+
+    return true;
+}
+
 /**
  * Apply liftering to MFCCs
  * @param coefficients MFCC coefficients
@@ -410,26 +720,56 @@ static void applyCepstralLifter(float *coefficients, int numCoefficients, float
     }
 }
 
+/* Filter counts with a cached DCT matrix; MFCC front ends use a few dozen filters */
+#define DCT_MAX_FILTERS 256
+
+static float *g_dctMatrices[DCT_MAX_FILTERS + 1];
+
 /**
- * Compute DCT-II for MFCC calculation
- * @param input Input array
- * @param output Output array
- * @param inputSize Input size
- * @param outputSize Output size
+ * Fill the DCT matrix for MFCCs: row k holds 2 cos(pi k (2n + 1) / size)
  */
-static void dct(const float *input, float *output, int inputSize, int outputSize)
+static void fillDCTMatrix(float *matrix, int size, int rows)
 {
-    float inputSizeInv = 1.0f / (float)inputSize;
-
-    for (int k = 0; k < outputSize; k++) {
-        float sum = 0.0f;
-        for (int n = 0; n < inputSize; n++) {
-            sum += input[n] * cosf(PI * k * (2 * n + 1) * inputSizeInv);
+    float inputSizeInv = 1.0f / (float)size;
+    for (int k = 0; k < rows; k++) {
+        for (int n = 0; n < size; n++) {
+            matrix[k * size + n] = 2.0f * cosf(PI * k * (2 * n + 1) * inputSizeInv);
         }
-        output[k] = sum * 2.0f;
     }
 }
 
+/**
+ * Square DCT-II matrix for a filter count, created on first use and kept for the process
+ *
+ * Published like the FFT plans: read-only once built, and a thread that
+ * loses the race to publish frees its copy.
+ */
+static const float *cachedDCTMatrix(int size)
+{
+    if (size <= 0 || size > DCT_MAX_FILTERS) {
+        return NULL;
+    }
+
+    float *matrix = __atomic_load_n(&g_dctMatrices[size], __ATOMIC_ACQUIRE);
+    if (matrix) {
+        return matrix;
+    }
+
+    matrix = (float *)malloc((size_t)size * size * sizeof(float));
+    if (!matrix) {
+        return NULL;
+    }
+    fillDCTMatrix(matrix, size, size);
+
+    float *expected = NULL;
+    if (!__atomic_compare_exchange_n(&g_dctMatrices[size], &expected, matrix, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(matrix);
+        matrix = expected;
+    }
+    return matrix;
+}
+
 /**
  * Compute MFCCs from mel energies
  * @param melEnergies Input mel filter energies
@@ -447,24 +787,46 @@ bool tinyaiAudioComputeMFCC(const float *melEnergies, int numFilters, int numCoe
         return false;
     }
 
-    /* Apply log to mel energies */
-    float *logMelEnergies = (float *)malloc(numFilters * sizeof(float));
-    if (!logMelEnergies) {
+    /* Usual filter counts take the log energies on the stack and a cached DCT matrix */
+    float        stackLog[DCT_MAX_FILTERS];
+    const float *matrix         = cachedDCTMatrix(numFilters);
+    float       *logMelEnergies = numFilters <= DCT_MAX_FILTERS
+                                      ? stackLog
+                                      : (float *)malloc(numFilters * sizeof(float));
+    float       *ownMatrix      = NULL;
+    if (!matrix && logMelEnergies) {
+        ownMatrix = (float *)malloc((size_t)numCoefficients * numFilters * sizeof(float));
+        if (ownMatrix) {
+            fillDCTMatrix(ownMatrix, numFilters, numCoefficients);
+        }
+        matrix = ownMatrix;
+    }
+    if (!logMelEnergies || !matrix) {
+        if (logMelEnergies != stackLog) {
+            free(logMelEnergies);
+        }
+        free(ownMatrix);
         return false;
     }
 
+    /* Apply log to mel energies */
     for (int i = 0; i < numFilters; i++) {
         logMelEnergies[i] = logf(melEnergies[i]);
     }
 
     /* Apply DCT-II to get MFCCs */
-    dct(logMelEnergies, coefficients, numFilters, numCoefficients);
+    for (int k = 0; k < numCoefficients; k++) {
+        coefficients[k] = tinyaiSimdDot(matrix + (size_t)k * numFilters, logMelEnergies,
+                                        numFilters);
+    }
 
     /* Apply liftering */
     applyCepstralLifter(coefficients, numCoefficients, lifterCoeff);
 
-    /* Free temporary array */
-    free(logMelEnergies);
+    if (logMelEnergies != stackLog) {
+        free(logMelEnergies);
+    }
+    free(ownMatrix);
 
     return true;
 }
@@ -513,104 +875,359 @@ static void removeDC(float *samples, int numSamples)
     }
 }
 
+/*
+ * Streaming feature extraction
+ *
+ * Everything that depends only on the configuration - window, mel filters,
+ * DCT matrix and FFT plan - is computed when the stream is created, and the
+ * frame buffers are allocated once, so pushing samples allocates nothing.
+ */
+struct TinyAIAudioFeatureStream {
+    TinyAIAudioFeaturesType type;
+    int                     frameLength;
+    int                     frameShift;
+    int                     fftSize;
+    int                     numFilters;
+    int                     numCoefficients;
+    int                     featureSize; /* Floats in one feature frame */
+    float                   preEmphasis;
+    bool                    removeDC;
+    bool                    usePower;
+    bool                    useLogMel;
+
+    /* Precomputed tables */
+    const TinyAIFFTPlan *plan;
+    float               *window;      /* Window coefficients [frameLength] */
+    TinyAISparseMelFilterBank *filterBank;
+    float                     *dct; /* Liftered DCT-II [numCoefficients x numFilters] */
+
+    /* Samples of the frame being gathered */
+    float *history;
+    int    filled; /* Samples in history */
+    int    skip;   /* Samples still to drop when frames are further apart than their length */
+
+    /* Work buffers of one frame */
+    float *frame;
+    float *real;
+    float *imag;
+    float *spectrum;
+    float *melEnergies;
+
+    /* Completed frames, oldest at head */
+    float *ring;
+    int    capacity;
+    int    head;
+    int    count;
+};
+
 /**
- * Extract MFCC features from audio frame
- * @param frame Input audio frame
- * @param frameLength Frame length in samples
- * @param config Feature extraction configuration
- * @param advancedOptions Advanced options (NULL for defaults)
- * @param coefficients Output MFCC coefficients
- * @return true on success, false on failure
+ * Number of features a stream produces per frame, or 0 for an invalid configuration
  */
-static bool extractMFCCFrame(const float *frame, int frameLength,
-                             const TinyAIAudioFeaturesConfig          *config,
-                             const TinyAIAudioFeaturesAdvancedOptions *advancedOptions,
-                             float                                    *coefficients)
+static int streamFeatureSize(const TinyAIAudioFeaturesConfig          *config,
+                             const TinyAIAudioFeaturesAdvancedOptions *options)
 {
-    if (!frame || !config || !coefficients || frameLength <= 0) {
-        return false;
+    switch (config->type) {
+    case TINYAI_AUDIO_FEATURES_MFCC:
+        return config->numCoefficients > 0 && config->numCoefficients <= config->numFilters
+                   ? config->numCoefficients
+                   : 0;
+    case TINYAI_AUDIO_FEATURES_MEL:
+        return config->numFilters > 0 ? config->numFilters : 0;
+    case TINYAI_AUDIO_FEATURES_SPECTROGRAM:
+        return options->fftSize / 2 + 1;
+    case TINYAI_AUDIO_FEATURES_RAW:
+        return config->frameLength;
+    default:
+        return 0;
     }
+}
 
-    /* Use default options if not provided */
+/**
+ * Create a streaming feature extractor
+ * @param config Feature extraction configuration
+ * @param advancedOptions Advanced options (NULL for defaults)
+ * @param sampleRate Sample rate of the pushed audio in Hz
+ * @param maxFrames Completed frames the stream holds until they are popped
+ * @return Newly allocated stream, or NULL on failure
+ */
+TinyAIAudioFeatureStream *
+tinyaiAudioFeatureStreamCreate(const TinyAIAudioFeaturesConfig          *config,
+                               const TinyAIAudioFeaturesAdvancedOptions *advancedOptions,
+                               int sampleRate, int maxFrames)
+{
     TinyAIAudioFeaturesAdvancedOptions defaultOptions;
     if (!advancedOptions) {
         tinyaiAudioFeaturesInitAdvancedOptions(&defaultOptions);
         advancedOptions = &defaultOptions;
     }
+    if (!config || config->frameLength <= 0 || config->frameShift <= 0 || sampleRate <= 0 ||
+        maxFrames <= 0 || advancedOptions->fftSize < config->frameLength) {
+        return NULL;
+    }
 
-    /* Allocate temporary buffers */
-    float *preemphasizedFrame = (float *)malloc(frameLength * sizeof(float));
-    if (!preemphasizedFrame) {
-        return false;
+    int featureSize = streamFeatureSize(config, advancedOptions);
+    if (featureSize <= 0) {
+        return NULL;
     }
 
-    int    fftSize       = advancedOptions->fftSize;
-    float *windowedFrame = (float *)malloc(frameLength * sizeof(float));
-    float *real          = (float *)malloc(fftSize * sizeof(float));
-    float *imag          = (float *)malloc(fftSize * sizeof(float));
-    float *spectrum      = (float *)malloc((fftSize / 2 + 1) * sizeof(float));
-    float *filterBank    = (float *)malloc(config->numFilters * (fftSize / 2 + 1) * sizeof(float));
-    float *melEnergies   = (float *)malloc(config->numFilters * sizeof(float));
-
-    if (!windowedFrame || !real || !imag || !spectrum || !filterBank || !melEnergies) {
-        /* Free allocated buffers */
-        free(preemphasizedFrame);
-        if (windowedFrame)
-            free(windowedFrame);
-        if (real)
-            free(real);
-        if (imag)
-            free(imag);
-        if (spectrum)
-            free(spectrum);
-        if (filterBank)
-            free(filterBank);
-        if (melEnergies)
-            free(melEnergies);
-        return false;
+    TinyAIAudioFeatureStream *stream =
+        (TinyAIAudioFeatureStream *)calloc(1, sizeof(TinyAIAudioFeatureStream));
+    if (!stream) {
+        return NULL;
     }
 
-    /* Apply pre-emphasis */
-    applyPreEmphasis(frame, preemphasizedFrame, frameLength, config->preEmphasis);
+    int fftSize             = advancedOptions->fftSize;
+    int halfSize            = fftSize / 2 + 1;
+    int numFilters          = config->numFilters > 0 ? config->numFilters : 0;
+    stream->type            = config->type;
+    stream->frameLength     = config->frameLength;
+    stream->frameShift      = config->frameShift;
+    stream->fftSize         = fftSize;
+    stream->numFilters      = numFilters;
+    stream->numCoefficients = config->numCoefficients;
+    stream->featureSize     = featureSize;
+    stream->preEmphasis     = config->preEmphasis;
+    stream->removeDC        = advancedOptions->removeDC;
+    stream->usePower        = advancedOptions->usePower;
+    stream->useLogMel       = config->useLogMel;
+    stream->capacity        = maxFrames;
+
+    bool mel         = config->type == TINYAI_AUDIO_FEATURES_MFCC ||
+               config->type == TINYAI_AUDIO_FEATURES_MEL;
+    stream->plan     = cachedFFTPlan(fftSize);
+    stream->window   = (float *)malloc(config->frameLength * sizeof(float));
+    stream->history  = (float *)malloc(config->frameLength * sizeof(float));
+    stream->frame    = (float *)malloc(config->frameLength * sizeof(float));
+    stream->real     = (float *)malloc(fftSize * sizeof(float));
+    stream->imag     = (float *)malloc(fftSize * sizeof(float));
+    stream->spectrum = (float *)malloc(halfSize * sizeof(float));
+    stream->ring     = (float *)malloc((size_t)maxFrames * featureSize * sizeof(float));
+    if (!stream->plan || !stream->window || !stream->history || !stream->frame ||
+        !stream->real || !stream->imag || !stream->spectrum || !stream->ring) {
+        tinyaiAudioFeatureStreamFree(stream);
+        return NULL;
+    }
 
-    /* Remove DC offset if requested */
-    if (advancedOptions->removeDC) {
-        removeDC(preemphasizedFrame, frameLength);
+    /* The window is the response of the window function to a frame of ones */
+    for (int i = 0; i < config->frameLength; i++) {
+        stream->window[i] = 1.0f;
+    }
+    if (!tinyaiAudioApplyWindow(stream->window, config->frameLength, advancedOptions->windowType,
+                                advancedOptions->windowParam, stream->window)) {
+        tinyaiAudioFeatureStreamFree(stream);
+        return NULL;
     }
 
-    /* Apply window function */
-    tinyaiAudioApplyWindow(preemphasizedFrame, frameLength, advancedOptions->windowType,
-                           advancedOptions->windowParam, windowedFrame);
+    if (mel) {
+        stream->filterBank  = tinyaiAudioCreateSparseMelFilterBank(
+            numFilters, fftSize, sampleRate, advancedOptions->fMin, advancedOptions->fMax);
+        stream->melEnergies = (float *)malloc(numFilters * sizeof(float));
+        if (!stream->filterBank || !stream->melEnergies) {
+            tinyaiAudioFeatureStreamFree(stream);
+            return NULL;
+        }
+    }
 
-    /* Compute FFT */
-    tinyaiAudioComputeFFT(windowedFrame, frameLength, fftSize, real, imag);
+    if (config->type == TINYAI_AUDIO_FEATURES_MFCC) {
+        stream->dct = (float *)malloc((size_t)config->numCoefficients * numFilters * sizeof(float));
+        if (!stream->dct) {
+            tinyaiAudioFeatureStreamFree(stream);
+            return NULL;
+        }
 
-    /* Compute power/magnitude spectrum */
-    tinyaiAudioComputeSpectrum(real, imag, fftSize, spectrum, advancedOptions->usePower);
-
-    /* Create mel filter bank - use default 16kHz sample rate */
-    int sampleRate = 16000; /* Standard sample rate for speech processing */
-    tinyaiAudioCreateMelFilterBank(config->numFilters, fftSize, sampleRate, advancedOptions->fMin,
-                                   advancedOptions->fMax, filterBank);
-
-    /* Apply mel filter bank */
-    tinyaiAudioApplyMelFilterBank(spectrum, fftSize / 2 + 1, filterBank, config->numFilters,
-                                  melEnergies);
-
-    /* Compute MFCCs */
-    tinyaiAudioComputeMFCC(melEnergies, config->numFilters, config->numCoefficients, coefficients,
-                           advancedOptions->lifterCoeff);
-
-    /* Free temporary buffers */
-    free(preemphasizedFrame);
-    free(windowedFrame);
-    free(real);
-    free(imag);
-    free(spectrum);
-    free(filterBank);
-    free(melEnergies);
+        /* The DCT of tinyaiAudioComputeMFCC, with the cepstral lifter folded into each row */
+        float lifterCoeff = advancedOptions->lifterCoeff;
+        fillDCTMatrix(stream->dct, numFilters, config->numCoefficients);
+        for (int k = 0; k < config->numCoefficients; k++) {
+            float lifter = lifterCoeff > 0.0f
+                               ? 1.0f + (lifterCoeff / 2.0f) * sinf(PI * k / lifterCoeff)
+                               : 1.0f;
+            for (int n = 0; n < numFilters; n++) {
+                stream->dct[k * numFilters + n] *= lifter;
+            }
+        }
+    }
 
-    return true;
+    return stream;
+}
+
+/**
+ * Free a streaming feature extractor
+ * @param stream The stream to free
+ */
+void tinyaiAudioFeatureStreamFree(TinyAIAudioFeatureStream *stream)
+{
+    if (!stream) {
+        return;
+    }
+    free(stream->window);
+    tinyaiAudioFreeSparseMelFilterBank(stream->filterBank);
+    free(stream->dct);
+    free(stream->history);
+    free(stream->frame);
+    free(stream->real);
+    free(stream->imag);
+    free(stream->spectrum);
+    free(stream->melEnergies);
+    free(stream->ring);
+    free(stream);
+}
+
+/**
+ * Compute the features of the frame in the history into a ring slot
+ */
+static void streamFrame(TinyAIAudioFeatureStream *stream, float *features)
+{
+    int length = stream->frameLength;
+
+    if (stream->type == TINYAI_AUDIO_FEATURES_RAW) {
+        memcpy(features, stream->history, length * sizeof(float));
+        return;
+    }
+
+    float *frame = stream->frame;
+    applyPreEmphasis(stream->history, frame, length, stream->preEmphasis);
+    if (stream->removeDC) {
+        removeDC(frame, length);
+    }
+    for (int i = 0; i < length; i++) {
+        frame[i] *= stream->window[i];
+    }
+
+    float *spectrum = stream->type == TINYAI_AUDIO_FEATURES_SPECTROGRAM ? features
+                                                                        : stream->spectrum;
+    tinyaiAudioExecuteFFTPlan(stream->plan, frame, length, stream->real, stream->imag);
+    tinyaiAudioComputeSpectrum(stream->real, stream->imag, stream->fftSize, spectrum,
+                               stream->usePower);
+    if (stream->type == TINYAI_AUDIO_FEATURES_SPECTROGRAM) {
+        return;
+    }
+
+    float *mel = stream->type == TINYAI_AUDIO_FEATURES_MEL ? features : stream->melEnergies;
+    tinyaiAudioApplySparseMelFilterBank(stream->filterBank, spectrum, mel);
+    if (stream->type == TINYAI_AUDIO_FEATURES_MFCC || stream->useLogMel) {
+        for (int i = 0; i < stream->numFilters; i++) {
+            mel[i] = logf(mel[i]);
+        }
+    }
+    if (stream->type == TINYAI_AUDIO_FEATURES_MEL) {
+        return;
+    }
+
+    for (int k = 0; k < stream->numCoefficients; k++) {
+        features[k] =
+            tinyaiSimdDot(stream->dct + (size_t)k * stream->numFilters, mel, stream->numFilters);
+    }
+}
+
+/**
+ * Push audio samples into a stream
+ *
+ * Samples are consumed until the frames they complete would overflow the
+ * stream's completed frames; pop frames and push the rest again.
+ * @param stream The stream to feed
+ * @param samples Audio samples, continuing the previous push
+ * @param numSamples Number of samples
+ * @return Number of samples consumed, negative on failure
+ */
+int tinyaiAudioFeatureStreamPush(TinyAIAudioFeatureStream *stream, const float *samples,
+                                 int numSamples)
+{
+    if (!stream || (!samples && numSamples > 0) || numSamples < 0) {
+        return -1;
+    }
+
+    int consumed = 0;
+    while (consumed < numSamples) {
+        int remaining = numSamples - consumed;
+        if (stream->skip > 0) {
+            int n = remaining < stream->skip ? remaining : stream->skip;
+            stream->skip -= n;
+            consumed += n;
+            continue;
+        }
+
+        /* Stop short of completing a frame while there is no slot for it */
+        int n = stream->frameLength - stream->filled;
+        if (stream->count == stream->capacity) {
+            n--;
+        }
+        n = remaining < n ? remaining : n;
+        if (n <= 0) {
+            break;
+        }
+        memcpy(stream->history + stream->filled, samples + consumed, n * sizeof(float));
+        stream->filled += n;
+        consumed += n;
+
+        if (stream->filled == stream->frameLength) {
+            int slot = (stream->head + stream->count) % stream->capacity;
+            streamFrame(stream, stream->ring + (size_t)slot * stream->featureSize);
+            stream->count++;
+
+            /* Keep the overlap with the next frame, or skip the gap before it */
+            if (stream->frameShift < stream->frameLength) {
+                stream->filled = stream->frameLength - stream->frameShift;
+                memmove(stream->history, stream->history + stream->frameShift,
+                        stream->filled * sizeof(float));
+            }
+            else {
+                stream->filled = 0;
+                stream->skip   = stream->frameShift - stream->frameLength;
+            }
+        }
+    }
+
+    return consumed;
+}
+
+/**
+ * Pop completed feature frames from a stream, oldest first
+ * @param stream The stream to read
+ * @param features Output frames, one after another [maxFrames x feature size]
+ * @param maxFrames Most frames to pop
+ * @return Number of frames popped, negative on failure
+ */
+int tinyaiAudioFeatureStreamPop(TinyAIAudioFeatureStream *stream, float *features, int maxFrames)
+{
+    if (!stream || (!features && maxFrames > 0) || maxFrames < 0) {
+        return -1;
+    }
+
+    int    frames = stream->count < maxFrames ? stream->count : maxFrames;
+    size_t size   = (size_t)stream->featureSize;
+    for (int i = 0; i < frames; i++) {
+        memcpy(features + i * size, stream->ring + stream->head * size, size * sizeof(float));
+        stream->head = (stream->head + 1) % stream->capacity;
+    }
+    stream->count -= frames;
+
+    return frames;
+}
+
+/**
+ * Get the number of features in each frame of a stream
+ * @param stream The stream to query
+ * @return Features per frame, 0 if stream is NULL
+ */
+int tinyaiAudioFeatureStreamFeatureSize(const TinyAIAudioFeatureStream *stream)
+{
+    return stream ? stream->featureSize : 0;
+}
+
+/**
+ * Drop a stream's buffered samples and completed frames
+ * @param stream The stream to reset
+ */
+void tinyaiAudioFeatureStreamReset(TinyAIAudioFeatureStream *stream)
+{
+    if (!stream) {
+        return;
+    }
+    stream->filled = 0;
+    stream->skip   = 0;
+    stream->head   = 0;
+    stream->count  = 0;
 }
 
 /**
@@ -631,54 +1248,32 @@ static bool extractAudioFeatures(const TinyAIAudioData                    *audio
         return false;
     }
 
-    /* Use default options if not provided */
-    TinyAIAudioFeaturesAdvancedOptions defaultOptions;
-    if (!advancedOptions) {
-        tinyaiAudioFeaturesInitAdvancedOptions(&defaultOptions);
-        advancedOptions = &defaultOptions;
-    }
-
-    /* Convert audio data to float samples */
-    int    numSamples = (int)(audio->dataSize / (audio->format.bitsPerSample / 8));
-    float *samples    = (float *)malloc(numSamples * sizeof(float));
-    if (!samples) {
-        return false;
-    }
-
     /* TODO: Convert audio samples based on format */
     /* For now, assume the data is already in float format */
-    memcpy(samples, audio->data, numSamples * sizeof(float));
+    int          numSamples = (int)(audio->dataSize / (audio->format.bitsPerSample / 8));
+    const float *samples    = (const float *)audio->data;
 
     /* Calculate number of frames */
     int frameLength = config->frameLength;
     int frameShift  = config->frameShift;
-    int numFrames   = (numSamples - frameLength) / frameShift + 1;
-    if (numFrames <= 0) {
-        free(samples);
+    if (frameLength <= 0 || frameShift <= 0 || numSamples < frameLength) {
         return false;
     }
-
-    /* Determine feature dimensions */
-    int featuresPerFrame = 0;
-    switch (featureType) {
-    case TINYAI_AUDIO_FEATURES_MFCC:
-        featuresPerFrame = config->numCoefficients;
-        break;
-    case TINYAI_AUDIO_FEATURES_MEL:
-        featuresPerFrame = config->numFilters;
-        break;
-    case TINYAI_AUDIO_FEATURES_SPECTROGRAM:
-        featuresPerFrame = advancedOptions->fftSize / 2 + 1;
-        break;
-    case TINYAI_AUDIO_FEATURES_RAW:
-        featuresPerFrame = frameLength;
-        break;
-    default:
-        free(samples);
+    int numFrames = (numSamples - frameLength) / frameShift + 1;
+
+    /* Frames are computed by a stream over the whole clip */
+    TinyAIAudioFeaturesConfig streamConfig = *config;
+    streamConfig.type                      = featureType;
+    int sampleRate = audio->format.sampleRate > 0 ? audio->format.sampleRate : 16000;
+    TinyAIAudioFeatureStream *stream =
+        tinyaiAudioFeatureStreamCreate(&streamConfig, advancedOptions, sampleRate, 1);
+    if (!stream) {
         return false;
     }
 
     /* Add delta features if requested */
+    int baseFeatures     = tinyaiAudioFeatureStreamFeatureSize(stream);
+    int featuresPerFrame = baseFeatures;
     if (config->includeDelta) {
         featuresPerFrame *= 2;
     }
@@ -687,9 +1282,9 @@ static bool extractAudioFeatures(const TinyAIAudioData                    *audio
     }
 
     /* Allocate features */
-    features->data = (float *)malloc(numFrames * featuresPerFrame * sizeof(float));
+    features->data = (float *)calloc((size_t)numFrames * featuresPerFrame, sizeof(float));
     if (!features->data) {
-        free(samples);
+        tinyaiAudioFeatureStreamFree(stream);
         return false;
     }
 
@@ -698,40 +1293,12 @@ static bool extractAudioFeatures(const TinyAIAudioData                    *audio
     features->numFeatures = featuresPerFrame;
     features->type        = featureType;
 
-    /* Extract features for each frame */
+    /* Each frame's base features lead its feature vector */
+    int pushed = 0;
     for (int i = 0; i < numFrames; i++) {
-        int    offset        = i * frameShift;
-        float *frame         = samples + offset;
-        float *featureVector = features->data + i * featuresPerFrame;
-
-        switch (featureType) {
-        case TINYAI_AUDIO_FEATURES_MFCC:
-            if (!extractMFCCFrame(frame, frameLength, config, advancedOptions, featureVector)) {
-                free(samples);
-                free(features->data);
-                features->data = NULL;
-                return false;
-            }
-            break;
-
-        case TINYAI_AUDIO_FEATURES_MEL:
-            /* TODO: Implement Mel spectrogram extraction */
-            break;
-
-        case TINYAI_AUDIO_FEATURES_SPECTROGRAM:
-            /* TODO: Implement spectrogram extraction */
-            break;
-
-        case TINYAI_AUDIO_FEATURES_RAW:
-            /* Just copy the raw samples */
-            memcpy(featureVector, frame, frameLength * sizeof(float));
-            break;
-
-        default:
-            free(samples);
-            free(features->data);
-            features->data = NULL;
-            return false;
+        while (tinyaiAudioFeatureStreamPop(stream, features->data + (size_t)i * featuresPerFrame,
+                                           1) == 0) {
+            pushed += tinyaiAudioFeatureStreamPush(stream, samples + pushed, numSamples - pushed);
         }
     }
 
@@ -740,9 +1307,7 @@ static bool extractAudioFeatures(const TinyAIAudioData                    *audio
         /* TODO: Implement delta feature computation */
     }
 
-    /* Free temporary buffers */
-    free(samples);
-
+    tinyaiAudioFeatureStreamFree(stream);
     return true;
 }
 
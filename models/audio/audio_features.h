@@ -46,6 +46,21 @@ typedef struct {
     float            ditheringCoeff;  /* Coefficient for dithering */
 } TinyAIAudioFeaturesAdvancedOptions;
 
+/**
+ * Precomputed tables for real-input FFTs of one size (opaque)
+ */
+typedef struct TinyAIFFTPlan TinyAIFFTPlan;
+
+/**
+ * Mel filter bank holding only the nonzero run of each filter (opaque)
+ */
+typedef struct TinyAISparseMelFilterBank TinyAISparseMelFilterBank;
+
+/**
+ * Feature extractor for audio that arrives in chunks (opaque)
+ */
+typedef struct TinyAIAudioFeatureStream TinyAIAudioFeatureStream;
+
 /**
  * Initialize default advanced options for feature extraction
  * @param options Options structure to initialize
@@ -65,8 +80,39 @@ bool tinyaiAudioFeaturesInitAdvancedOptions(TinyAIAudioFeaturesAdvancedOptions *
 bool tinyaiAudioApplyWindow(const float *samples, int numSamples, TinyAIWindowType windowType,
                             float param, float *output);
 
+/**
+ * Create an FFT plan for real frames of one size
+ *
+ * The plan holds the bit-reversal order and twiddle factors of the size, and
+ * is read-only once created, so threads can share it.
+ * @param fftSize Size of FFT (power of 2)
+ * @return Newly allocated plan, or NULL on failure
+ */
+TinyAIFFTPlan *tinyaiAudioCreateFFTPlan(int fftSize);
+
+/**
+ * Free an FFT plan
+ * @param plan The plan to free
+ */
+void tinyaiAudioFreeFFTPlan(TinyAIFFTPlan *plan);
+
+/**
+ * Compute the FFT of a frame of real samples with a plan
+ * @param plan Plan for the FFT size
+ * @param samples Array of audio samples (windowed)
+ * @param numSamples Number of samples (<= the plan's size; the rest are zero)
+ * @param real Output real part of FFT (plan's size)
+ * @param imag Output imaginary part of FFT (plan's size)
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioExecuteFFTPlan(const TinyAIFFTPlan *plan, const float *samples, int numSamples,
+                               float *real, float *imag);
+
 /**
  * Compute FFT of a frame of audio samples
+ *
+ * Uses a plan for fftSize that is created on first use and cached for the
+ * life of the process.
  * @param samples Array of audio samples (windowed)
  * @param numSamples Number of samples
  * @param fftSize Size of FFT (power of 2, >= numSamples)
@@ -114,6 +160,38 @@ bool tinyaiAudioCreateMelFilterBank(int numFilters, int fftSize, int sampleRate,
 bool tinyaiAudioApplyMelFilterBank(const float *spectrum, int spectrumSize, const float *filterBank,
                                    int numFilters, float *melEnergies);
 
+/**
+ * Create a mel filter bank that stores only the nonzero run of each filter
+ *
+ * Each triangular filter covers a few bins, so applying the sparse bank
+ * takes a fraction of the work of the dense numFilters x (fftSize/2+1) one.
+ * @param numFilters Number of mel filters
+ * @param fftSize Size of FFT
+ * @param sampleRate Sample rate in Hz
+ * @param fMin Minimum frequency in Hz
+ * @param fMax Maximum frequency in Hz
+ * @return Newly allocated filter bank, or NULL on failure
+ */
+TinyAISparseMelFilterBank *tinyaiAudioCreateSparseMelFilterBank(int numFilters, int fftSize,
+                                                                int sampleRate, float fMin,
+                                                                float fMax);
+
+/**
+ * Free a sparse mel filter bank
+ * @param bank The filter bank to free
+ */
+void tinyaiAudioFreeSparseMelFilterBank(TinyAISparseMelFilterBank *bank);
+
+/**
+ * Apply a sparse mel filter bank to a spectrum
+ * @param bank Sparse mel filter bank
+ * @param spectrum Input power/magnitude spectrum (fftSize/2+1)
+ * @param melEnergies Output mel filter energies
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioApplySparseMelFilterBank(const TinyAISparseMelFilterBank *bank,
+                                         const float *spectrum, float *melEnergies);
+
 /**
  * Compute MFCCs from mel energies
  * @param melEnergies Input mel filter energies
@@ -126,6 +204,68 @@ bool tinyaiAudioApplyMelFilterBank(const float *spectrum, int spectrumSize, cons
 bool tinyaiAudioComputeMFCC(const float *melEnergies, int numFilters, int numCoefficients,
                             float *coefficients, float lifterCoeff);
 
+/**
+ * Create a streaming feature extractor
+ *
+ * The window, mel filters, DCT matrix and FFT plan of the configuration are
+ * computed here, and all buffers are allocated here, so pushing samples and
+ * popping frames take constant memory and allocate nothing. Frames hold the
+ * features of config->type: MFCCs, mel energies (logarithmic with
+ * config->useLogMel), the power or magnitude spectrum, or the raw samples.
+ * Delta features need frames ahead and are not produced by a stream.
+ * @param config Feature extraction configuration
+ * @param advancedOptions Advanced options (NULL for defaults)
+ * @param sampleRate Sample rate of the pushed audio in Hz
+ * @param maxFrames Completed frames the stream holds until they are popped
+ * @return Newly allocated stream, or NULL on failure
+ */
+TinyAIAudioFeatureStream *
+tinyaiAudioFeatureStreamCreate(const TinyAIAudioFeaturesConfig          *config,
+                               const TinyAIAudioFeaturesAdvancedOptions *advancedOptions,
+                               int sampleRate, int maxFrames);
+
+/**
+ * Free a streaming feature extractor
+ * @param stream The stream to free
+ */
+void tinyaiAudioFeatureStreamFree(TinyAIAudioFeatureStream *stream);
+
+/**
+ * Push audio samples into a stream
+ *
+ * A frame is computed as soon as its last sample arrives. Samples are
+ * consumed until the completed frames would overflow the stream; pop frames
+ * and push the rest again.
+ * @param stream The stream to feed
+ * @param samples Audio samples, continuing the previous push
+ * @param numSamples Number of samples
+ * @return Number of samples consumed, negative on failure
+ */
+int tinyaiAudioFeatureStreamPush(TinyAIAudioFeatureStream *stream, const float *samples,
+                                 int numSamples);
+
+/**
+ * Pop completed feature frames from a stream, oldest first
+ * @param stream The stream to read
+ * @param features Output frames, one after another [maxFrames x feature size]
+ * @param maxFrames Most frames to pop
+ * @return Number of frames popped, negative on failure
+ */
+int tinyaiAudioFeatureStreamPop(TinyAIAudioFeatureStream *stream, float *features, int maxFrames);
+
+/**
+ * Get the number of features in each frame of a stream
+ * @param stream The stream to query
+ * @return Features per frame, 0 if stream is NULL
+ */
+int tinyaiAudioFeatureStreamFeatureSize(const TinyAIAudioFeatureStream *stream);
+
+/**
+ * Drop a stream's buffered samples and completed frames, to start a new recording
+ * @param stream The stream to reset
+ */
+void tinyaiAudioFeatureStreamReset(TinyAIAudioFeatureStream *stream);
+
 /**
  * Extract MFCC features from raw audio
  * @param audio Input audio data
@@ -1,11 +1,20 @@
 /**
  * @file audio_model.c
  * @brief Implementation of audio model functionality for TinyAI
+ *
+ * The model runs each feature frame through its hidden layers, averages the
+ * last hidden layer over time and classifies the average with its output
+ * layer. Layers are compiled once into an execution plan of steps on 4-bit
+ * matrices (or float weights without quantization), and frames run through
+ * the steps in chunks spread across the shared thread pool.
  */
 
 #include "audio_model.h"
 #include "../../core/memory.h"
+#include "../../utils/cancel.h"
 #include "../../utils/quantize.h"
+#include "../../utils/simd_ops.h"
+#include "../../utils/thread_pool.h"
 #include "audio_features.h"
 #include "audio_utils.h"
 #include <math.h>
@@ -13,6 +22,24 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Most layers a model can have */
+#define AUDIO_MODEL_MAX_LAYERS 31
+
+/* Frames run through the hidden layers as one matrix product */
+#define AUDIO_MODEL_CHUNK_FRAMES 64
+
+/**
+ * Step of the execution plan: one layer's product, bias and activation
+ */
+typedef struct {
+    int               inputSize;  /* Input row width */
+    int               outputSize; /* Output row width */
+    int               activation; /* TINYAI_SIMD_ACTIVATION_* after the bias */
+    TinyAIMatrix4bit *matrix;     /* 4-bit weights [inputSize x outputSize], or NULL */
+    float            *weights;    /* Float weights [inputSize x outputSize] without quantization */
+    float            *biases;     /* Biases [outputSize] */
+} AudioModelStep;
+
 /**
  * Audio model structure definition
  */
@@ -20,10 +47,9 @@ struct TinyAIAudioModel {
     /* Configuration */
     TinyAIAudioModelConfig config;
 
-    /* Model parameters */
-    float   *weights;          /* Weights for the model (non-quantized) */
-    uint8_t *quantizedWeights; /* 4-bit quantized weights if enabled */
-    float   *biases;           /* Biases for the model */
+    /* Execution plan */
+    AudioModelStep *steps;    /* One step per layer, the output layer last */
+    int             maxWidth; /* Widest hidden row */
 
     /* Model architecture */
     int inputDim;   /* Input dimension */
@@ -36,10 +62,62 @@ struct TinyAIAudioModel {
     bool useSIMD;         /* Whether to use SIMD acceleration */
 
     /* Memory management */
-    void *memoryPool;        /* Memory pool for efficient allocation */
-    bool  useExternalMemory; /* Whether memory pool is external */
+    void        *memoryPool;        /* Memory pool for efficient allocation */
+    bool         useExternalMemory; /* Whether memory pool is external */
+    TinyAIArena *arena;             /* Per-call temporaries, or NULL for the heap */
 };
 
+/**
+ * Compile one layer into a plan step with random weights
+ * @param step Step to fill
+ * @param inputSize Input row width
+ * @param outputSize Output row width
+ * @param activation TINYAI_SIMD_ACTIVATION_* after the bias
+ * @param quantize Whether to quantize the weights to 4 bits
+ * @return true on success, false on failure
+ */
+static bool initStep(AudioModelStep *step, int inputSize, int outputSize, int activation,
+                     bool quantize)
+{
+    size_t count = (size_t)inputSize * outputSize;
+
+    step->inputSize  = inputSize;
+    step->outputSize = outputSize;
+    step->activation = activation;
+
+    float *weights = (float *)malloc(count * sizeof(float));
+    step->biases   = (float *)calloc((size_t)outputSize, sizeof(float));
+    if (!weights || !step->biases) {
+        free(weights);
+        return false;
+    }
+
+    /* Small random values until weights can be loaded */
+    for (size_t i = 0; i < count; i++) {
+        weights[i] = ((float)rand() / RAND_MAX) * 0.1f - 0.05f;
+    }
+
+    if (!quantize) {
+        step->weights = weights;
+        return true;
+    }
+
+    TinyAIMatrixFP32 matrix = {weights, (uint32_t)inputSize, (uint32_t)outputSize};
+    step->matrix            = tinyaiQuantizeFP32To4bit(&matrix);
+    free(weights);
+    if (!step->matrix) {
+        return false;
+    }
+
+    /* Panels are fastest with float activations; int8 ones need the row-major layout */
+    if (tinyaiGetActivationPrecision() == TINYAI_PRECISION_FP32 &&
+        tinyaiMatrix4bitPrepack(step->matrix) != 0) {
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * Create an audio model
  * @param config Configuration for the audio model
@@ -52,6 +130,12 @@ TinyAIAudioModel *tinyaiAudioModelCreate(const TinyAIAudioModelConfig *config)
         return NULL;
     }
 
+    if (config->numLayers < 1 || config->numLayers > AUDIO_MODEL_MAX_LAYERS ||
+        config->numClasses <= 0 || (config->numLayers > 1 && config->hiddenSize <= 0)) {
+        fprintf(stderr, "Invalid audio model architecture\n");
+        return NULL;
+    }
+
     /* Allocate model structure */
     TinyAIAudioModel *model = (TinyAIAudioModel *)malloc(sizeof(TinyAIAudioModel));
     if (!model) {
@@ -104,137 +188,37 @@ TinyAIAudioModel *tinyaiAudioModelCreate(const TinyAIAudioModelConfig *config)
         return NULL;
     }
 
-    /* Calculate memory requirements */
-    size_t weightBytes = 0;
-    size_t biasBytes   = 0;
-
-    /* Simple feed-forward architecture with uniform layer sizes */
-    int layerSizes[32]; /* Up to 32 layers */
-    layerSizes[0] = model->inputDim;
-    for (int i = 1; i < model->numLayers; i++) {
-        layerSizes[i] = model->hiddenSize;
-    }
-    layerSizes[model->numLayers] = model->numClasses;
-
-    /* Calculate memory for weights */
-    for (int i = 0; i < model->numLayers; i++) {
-        weightBytes += (size_t)layerSizes[i] * layerSizes[i + 1] * sizeof(float);
-        biasBytes += (size_t)layerSizes[i + 1] * sizeof(float);
-    }
-
-    /* If using quantization, adjust weight memory */
-    if (model->useQuantization) {
-        model->quantizedWeights = (uint8_t *)malloc((weightBytes + 1) / 2); /* 4-bit quantization */
-        if (!model->quantizedWeights) {
-            fprintf(stderr, "Failed to allocate quantized weights\n");
-            free(model);
-            return NULL;
-        }
-    }
-    else {
-        model->weights = (float *)malloc(weightBytes);
-        if (!model->weights) {
-            fprintf(stderr, "Failed to allocate weights\n");
-            free(model);
-            return NULL;
-        }
+    if (config->weightsFile) {
+        /* Load weights from file - placeholder, would need to be implemented */
+        fprintf(stderr, "Loading weights from file not yet implemented\n");
     }
 
-    /* Allocate biases */
-    model->biases = (float *)malloc(biasBytes);
-    if (!model->biases) {
-        fprintf(stderr, "Failed to allocate biases\n");
-        if (model->useQuantization) {
-            free(model->quantizedWeights);
-        }
-        else {
-            free(model->weights);
-        }
+    /* Compile the layers: ReLU hidden layers over frames, then the output layer */
+    model->steps = (AudioModelStep *)calloc((size_t)model->numLayers, sizeof(AudioModelStep));
+    if (!model->steps) {
+        fprintf(stderr, "Failed to allocate audio model plan\n");
         free(model);
         return NULL;
     }
 
-    /* Initialize weights and biases */
-    if (config->weightsFile) {
-        /* Load weights from file - placeholder, would need to be implemented */
-        fprintf(stderr, "Loading weights from file not yet implemented\n");
-        /* Initialize with random values for now */
-        if (!model->useQuantization) {
-            for (size_t i = 0; i < weightBytes / sizeof(float); i++) {
-                model->weights[i] =
-                    ((float)rand() / RAND_MAX) * 0.1f - 0.05f; /* Small random values */
-            }
-        }
-        else {
-            /* For quantized weights, first create float weights then quantize */
-            float *tempWeights = (float *)malloc(weightBytes);
-            if (!tempWeights) {
-                fprintf(stderr, "Failed to allocate temporary weights\n");
-                free(model->biases);
-                if (model->useQuantization) {
-                    free(model->quantizedWeights);
-                }
-                else {
-                    free(model->weights);
-                }
-                free(model);
-                return NULL;
-            }
-
-            /* Fill with random values */
-            for (size_t i = 0; i < weightBytes / sizeof(float); i++) {
-                tempWeights[i] = ((float)rand() / RAND_MAX) * 0.1f - 0.05f;
-            }
-
-            /* Quantize */
-            tinyaiQuantizeWeights(tempWeights, model->quantizedWeights, weightBytes / sizeof(float),
-                                  4);
-
-            /* Clean up */
-            free(tempWeights);
-        }
-    }
-    else {
-        /* Initialize with random values */
-        if (!model->useQuantization) {
-            for (size_t i = 0; i < weightBytes / sizeof(float); i++) {
-                model->weights[i] =
-                    ((float)rand() / RAND_MAX) * 0.1f - 0.05f; /* Small random values */
-            }
+    model->maxWidth = model->inputDim;
+    for (int i = 0; i < model->numLayers; i++) {
+        bool last       = i == model->numLayers - 1;
+        int  inputSize  = i == 0 ? model->inputDim : model->hiddenSize;
+        int  outputSize = last ? model->numClasses : model->hiddenSize;
+        int  activation = last ? TINYAI_SIMD_ACTIVATION_NONE : TINYAI_SIMD_ACTIVATION_RELU;
+
+        if (!initStep(&model->steps[i], inputSize, outputSize, activation,
+                      model->useQuantization)) {
+            fprintf(stderr, "Failed to initialize audio model layer %d\n", i);
+            tinyaiAudioModelFree(model);
+            return NULL;
         }
-        else {
-            /* For quantized weights, first create float weights then quantize */
-            float *tempWeights = (float *)malloc(weightBytes);
-            if (!tempWeights) {
-                fprintf(stderr, "Failed to allocate temporary weights\n");
-                free(model->biases);
-                if (model->useQuantization) {
-                    free(model->quantizedWeights);
-                }
-                else {
-                    free(model->weights);
-                }
-                free(model);
-                return NULL;
-            }
-
-            /* Fill with random values */
-            for (size_t i = 0; i < weightBytes / sizeof(float); i++) {
-                tempWeights[i] = ((float)rand() / RAND_MAX) * 0.1f - 0.05f;
-            }
-
-            /* Quantize */
-            tinyaiQuantizeWeights(tempWeights, model->quantizedWeights, weightBytes / sizeof(float),
-                                  4);
-
-            /* Clean up */
-            free(tempWeights);
+        if (!last && outputSize > model->maxWidth) {
+            model->maxWidth = outputSize;
         }
     }
 
-    /* Initialize biases to zeros */
-    memset(model->biases, 0, biasBytes);
-
     return model;
 }
 
@@ -248,17 +232,16 @@ void tinyaiAudioModelFree(TinyAIAudioModel *model)
         return;
     }
 
-    /* Free weights */
-    if (model->useQuantization) {
-        free(model->quantizedWeights);
-    }
-    else {
-        free(model->weights);
+    /* Free the plan's weights and biases */
+    if (model->steps) {
+        for (int i = 0; i < model->numLayers; i++) {
+            tinyaiDestroyMatrix4bit(model->steps[i].matrix);
+            free(model->steps[i].weights);
+            free(model->steps[i].biases);
+        }
+        free(model->steps);
     }
 
-    /* Free biases */
-    free(model->biases);
-
     /* Free memory pool if owned */
     if (model->memoryPool && !model->useExternalMemory) {
         free(model->memoryPool);
@@ -269,27 +252,53 @@ void tinyaiAudioModelFree(TinyAIAudioModel *model)
 }
 
 /**
- * Process audio data with the model
- * @param model The audio model to use
- * @param audio The audio data to process
- * @param output The output structure to fill
+ * Run rows through a plan step: output = act(input * W + b)
+ * @param step The step to run
+ * @param input Input rows [rows x inputSize]
+ * @param rows Number of rows
+ * @param output Output rows [rows x outputSize], must not alias input
  * @return true on success, false on failure
  */
-bool tinyaiAudioModelProcess(TinyAIAudioModel *model, const TinyAIAudioData *audio,
-                             TinyAIAudioModelOutput *output)
+static bool runStep(const AudioModelStep *step, const float *input, int rows, float *output)
 {
-    if (!model || !audio || !output) {
-        return false;
+    if (step->matrix) {
+        return tinyaiMatrix4bitMatMulActivate(step->matrix, input, (uint32_t)rows, step->biases,
+                                              step->activation, output) == 0;
+    }
+
+    for (int r = 0; r < rows; r++) {
+        const float *x = input + (size_t)r * step->inputSize;
+        float       *y = output + (size_t)r * step->outputSize;
+
+        memcpy(y, step->biases, step->outputSize * sizeof(float));
+        for (int k = 0; k < step->inputSize; k++) {
+            tinyaiSimdVecScaleAdd(y, step->weights + (size_t)k * step->outputSize, x[k],
+                                  step->outputSize);
+        }
+        if (step->activation != TINYAI_SIMD_ACTIVATION_NONE) {
+            tinyaiSimdActivate(y, step->outputSize, step->activation);
+        }
     }
 
-    /* Extract features from audio */
-    TinyAIAudioFeatures features;
-    memset(&features, 0, sizeof(TinyAIAudioFeatures));
+    return true;
+}
+
+/**
+ * Extract the features the model was configured for
+ * @param model The audio model
+ * @param audio The audio data to process
+ * @param features Output features
+ * @return true on success, false on failure
+ */
+static bool extractFeatures(const TinyAIAudioModel *model, const TinyAIAudioData *audio,
+                            TinyAIAudioFeatures *features)
+{
+    memset(features, 0, sizeof(TinyAIAudioFeatures));
 
     /* Extract features based on configuration */
     switch (model->config.featuresConfig.type) {
     case TINYAI_AUDIO_FEATURES_MFCC:
-        if (!tinyaiAudioExtractMFCC(audio, &model->config.featuresConfig, NULL, &features)) {
+        if (!tinyaiAudioExtractMFCC(audio, &model->config.featuresConfig, NULL, features)) {
             fprintf(stderr, "Failed to extract MFCC features\n");
             return false;
         }
@@ -297,14 +306,14 @@ bool tinyaiAudioModelProcess(TinyAIAudioModel *model, const TinyAIAudioData *aud
 
     case TINYAI_AUDIO_FEATURES_MEL:
         if (!tinyaiAudioExtractMelSpectrogram(audio, &model->config.featuresConfig, NULL,
-                                              &features)) {
+                                              features)) {
             fprintf(stderr, "Failed to extract Mel spectrogram features\n");
             return false;
         }
         break;
 
     case TINYAI_AUDIO_FEATURES_SPECTROGRAM:
-        if (!tinyaiAudioExtractSpectrogram(audio, &model->config.featuresConfig, NULL, &features)) {
+        if (!tinyaiAudioExtractSpectrogram(audio, &model->config.featuresConfig, NULL, features)) {
             fprintf(stderr, "Failed to extract spectrogram features\n");
             return false;
         }
@@ -313,7 +322,6 @@ bool tinyaiAudioModelProcess(TinyAIAudioModel *model, const TinyAIAudioData *aud
     case TINYAI_AUDIO_FEATURES_RAW:
         /* For raw audio, just convert samples to float and reshape */
         fprintf(stderr, "Raw audio features not yet implemented\n");
-        tinyaiAudioFeaturesFree(&features);
         return false;
 
     default:
@@ -321,98 +329,283 @@ bool tinyaiAudioModelProcess(TinyAIAudioModel *model, const TinyAIAudioData *aud
         return false;
     }
 
-    /* Initialize output if not already initialized */
-    if (!output->logits || !output->probabilities) {
-        if (!tinyaiAudioModelOutputInit(output, model->numClasses)) {
-            fprintf(stderr, "Failed to initialize audio model output\n");
-            tinyaiAudioFeaturesFree(&features);
-            return false;
+    /* Validate feature dimensions */
+    if (features->numFeatures != model->inputDim || features->numFrames <= 0) {
+        fprintf(stderr, "Feature dimension mismatch: got %d, expected %d\n",
+                features->numFeatures, model->inputDim);
+        tinyaiAudioFeaturesFree(features);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Clips whose features are extracted on the thread pool, one task per clip
+ */
+typedef struct {
+    const TinyAIAudioModel *model;
+    const TinyAIAudioData  *audios;
+    TinyAIAudioFeatures    *features;
+    bool                   *extracted;
+} FeatureTask;
+
+static void extractFeatureRange(void *context, size_t begin, size_t end)
+{
+    FeatureTask *task = (FeatureTask *)context;
+
+    for (size_t i = begin; i < end; i++) {
+        task->extracted[i] = extractFeatures(task->model, &task->audios[i], &task->features[i]);
+    }
+}
+
+/**
+ * Chunks of frames run through the hidden layers, as a thread pool task
+ *
+ * Each chunk leaves the sum of its last hidden rows (or of its features, in
+ * a model without hidden layers) for the pooling.
+ */
+typedef struct {
+    const TinyAIAudioModel    *model;
+    const TinyAIAudioFeatures *features;
+    const int                 *chunkClip;  /* Clip of each chunk */
+    const int                 *chunkFirst; /* First frame of each chunk */
+    float                     *chunkSums;  /* Row sum of each chunk [chunks x pooled width] */
+    int                        poolWidth;  /* Width of the pooled rows */
+    bool                       failed;
+} ChunkTask;
+
+static void runChunks(void *context, size_t begin, size_t end)
+{
+    ChunkTask              *task       = (ChunkTask *)context;
+    const TinyAIAudioModel *model      = task->model;
+    size_t                  bufferSize = (size_t)AUDIO_MODEL_CHUNK_FRAMES * model->maxWidth;
+
+    float *buffers = NULL;
+    if (model->numLayers > 1) {
+        buffers = (float *)malloc(2 * bufferSize * sizeof(float));
+        if (!buffers) {
+            task->failed = true;
+            return;
         }
     }
 
-    /* Validate feature dimensions */
-    if (features.numFeatures != model->inputDim) {
-        fprintf(stderr, "Feature dimension mismatch: got %d, expected %d\n", features.numFeatures,
-                model->inputDim);
-        tinyaiAudioFeaturesFree(&features);
-        return false;
+    for (size_t c = begin; c < end; c++) {
+        const TinyAIAudioFeatures *features = &task->features[task->chunkClip[c]];
+        int                        first    = task->chunkFirst[c];
+        int rows = features->numFrames - first < AUDIO_MODEL_CHUNK_FRAMES
+                       ? features->numFrames - first
+                       : AUDIO_MODEL_CHUNK_FRAMES;
+
+        /* Hidden layers ping-pong between the two buffers */
+        const float *rowData = features->data + (size_t)first * features->numFeatures;
+        for (int i = 0; i < model->numLayers - 1; i++) {
+            float *output = buffers + (i % 2) * bufferSize;
+
+            /* Abandoned work stops at the next layer boundary */
+            if (tinyaiCancelled() || !runStep(&model->steps[i], rowData, rows, output)) {
+                task->failed = true;
+                free(buffers);
+                return;
+            }
+            rowData = output;
+        }
+
+        float *sum = task->chunkSums + c * (size_t)task->poolWidth;
+        memset(sum, 0, task->poolWidth * sizeof(float));
+        for (int r = 0; r < rows; r++) {
+            tinyaiSimdVecAdd(sum, sum, rowData + (size_t)r * task->poolWidth, task->poolWidth);
+        }
+    }
+
+    free(buffers);
+}
+
+/**
+ * Allocate a temporary of a call, from the model's arena if it has one
+ * @param model The audio model
+ * @param size Size in bytes
+ * @return The temporary, or NULL on failure
+ */
+static void *allocTemporary(TinyAIAudioModel *model, size_t size)
+{
+    return model->arena ? tinyaiArenaAlloc(model->arena, size) : malloc(size);
+}
+
+/**
+ * Free a temporary of a call; arena temporaries go with the call's scope
+ * @param model The audio model
+ * @param temporary The temporary to free
+ */
+static void freeTemporary(TinyAIAudioModel *model, void *temporary)
+{
+    if (!model->arena) {
+        free(temporary);
     }
+}
 
-    /* For now, we'll just use a very simple model that averages the features across time */
-    /* This is a placeholder for a real model implementation */
-    float *avgFeatures = (float *)malloc(model->inputDim * sizeof(float));
-    if (!avgFeatures) {
-        fprintf(stderr, "Failed to allocate average features\n");
-        tinyaiAudioFeaturesFree(&features);
+/**
+ * Process a batch of audio clips with the model
+ * @param model The audio model to use
+ * @param audios The audio clips to process
+ * @param count Number of clips
+ * @param outputs The output structures to fill, one per clip
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioModelProcessBatch(TinyAIAudioModel *model, const TinyAIAudioData *audios,
+                                  int count, TinyAIAudioModelOutput *outputs)
+{
+    if (!model || !audios || !outputs || count <= 0) {
         return false;
     }
 
-    /* Initialize to zeros */
-    memset(avgFeatures, 0, model->inputDim * sizeof(float));
+    /* Initialize outputs if not already initialized */
+    for (int i = 0; i < count; i++) {
+        if ((!outputs[i].logits || !outputs[i].probabilities) &&
+            !tinyaiAudioModelOutputInit(&outputs[i], model->numClasses)) {
+            fprintf(stderr, "Failed to initialize audio model output\n");
+            return false;
+        }
+    }
 
-    /* Sum features across time */
-    for (int t = 0; t < features.numFrames; t++) {
-        for (int f = 0; f < features.numFeatures; f++) {
-            avgFeatures[f] += features.data[t * features.numFeatures + f];
+    TinyAIArenaMark   mark      = tinyaiArenaBeginScope(model->arena);
+    TinyAIThreadPool *pool      = tinyaiGetThreadPool();
+    int               poolWidth = model->steps[model->numLayers - 1].inputSize;
+    bool              success   = false;
+
+    int                 *chunkClip  = NULL;
+    int                 *chunkFirst = NULL;
+    float               *chunkSums  = NULL;
+    float               *pooled     = NULL;
+    float               *logits     = NULL;
+    TinyAIAudioFeatures *features =
+        (TinyAIAudioFeatures *)allocTemporary(model, count * sizeof(TinyAIAudioFeatures));
+    bool *extracted = (bool *)allocTemporary(model, count * sizeof(bool));
+    if (!features || !extracted) {
+        fprintf(stderr, "Failed to allocate audio model temporaries\n");
+        goto cleanup;
+    }
+    memset(extracted, 0, count * sizeof(bool));
+
+    /* Extract every clip's features at once, a clip per task */
+    FeatureTask featureTask = {model, audios, features, extracted};
+    tinyaiParallelFor(pool, (size_t)count, 1, extractFeatureRange, &featureTask);
+
+    int numChunks = 0;
+    for (int i = 0; i < count; i++) {
+        if (!extracted[i]) {
+            goto cleanup;
+        }
+        numChunks += (features[i].numFrames + AUDIO_MODEL_CHUNK_FRAMES - 1) /
+                     AUDIO_MODEL_CHUNK_FRAMES;
+    }
+
+    /* Cut every clip into chunks, so long clips spread over the threads */
+    chunkClip  = (int *)allocTemporary(model, numChunks * sizeof(int));
+    chunkFirst = (int *)allocTemporary(model, numChunks * sizeof(int));
+    chunkSums  = (float *)allocTemporary(model, (size_t)numChunks * poolWidth * sizeof(float));
+    pooled     = (float *)allocTemporary(model, (size_t)count * poolWidth * sizeof(float));
+    logits     = (float *)allocTemporary(model, (size_t)count * model->numClasses * sizeof(float));
+    if (!chunkClip || !chunkFirst || !chunkSums || !pooled || !logits) {
+        fprintf(stderr, "Failed to allocate audio model temporaries\n");
+        goto cleanup;
+    }
+
+    int chunk = 0;
+    for (int i = 0; i < count; i++) {
+        for (int first = 0; first < features[i].numFrames; first += AUDIO_MODEL_CHUNK_FRAMES) {
+            chunkClip[chunk]  = i;
+            chunkFirst[chunk] = first;
+            chunk++;
         }
     }
 
-    /* Divide by number of frames to get average */
-    for (int f = 0; f < features.numFeatures; f++) {
-        avgFeatures[f] /= features.numFrames;
+    /* Work of a chunk: the multiply-adds of its hidden layers */
+    size_t work = (size_t)AUDIO_MODEL_CHUNK_FRAMES * poolWidth;
+    for (int i = 0; i < model->numLayers - 1; i++) {
+        work += (size_t)AUDIO_MODEL_CHUNK_FRAMES * model->steps[i].inputSize *
+                model->steps[i].outputSize;
     }
 
-    /* Apply simple linear transformation to get logits */
-    /* This is a placeholder for a real model forward pass */
-    for (int c = 0; c < model->numClasses; c++) {
-        output->logits[c] = model->biases[c];
-        for (int f = 0; f < model->inputDim; f++) {
-            if (model->useQuantization) {
-                /* For quantized weights, would need dequantization here */
-                /* For now, just use a simple random value for demonstration */
-                output->logits[c] += avgFeatures[f] * (((float)rand() / RAND_MAX) * 2.0f - 1.0f);
-            }
-            else {
-                /* For full precision, would multiply by weights */
-                /* For now, just use a simple random value for demonstration */
-                output->logits[c] += avgFeatures[f] * (((float)rand() / RAND_MAX) * 2.0f - 1.0f);
-            }
-        }
+    ChunkTask chunkTask = {model, features, chunkClip, chunkFirst, chunkSums, poolWidth, false};
+    tinyaiParallelFor(pool, (size_t)numChunks, tinyaiThreadPoolGrain(pool, work, 1), runChunks,
+                      &chunkTask);
+    if (chunkTask.failed || tinyaiCancelled()) {
+        fprintf(stderr, "Audio model forward pass failed\n");
+        goto cleanup;
     }
 
-    /* Apply softmax to get probabilities */
-    float maxLogit = output->logits[0];
-    for (int c = 1; c < model->numClasses; c++) {
-        if (output->logits[c] > maxLogit) {
-            maxLogit = output->logits[c];
+    /* Average each clip's chunk sums over its frames, in chunk order */
+    memset(pooled, 0, (size_t)count * poolWidth * sizeof(float));
+    for (int c = 0; c < numChunks; c++) {
+        float *row = pooled + (size_t)chunkClip[c] * poolWidth;
+        tinyaiSimdVecAdd(row, row, chunkSums + (size_t)c * poolWidth, poolWidth);
+    }
+    for (int i = 0; i < count; i++) {
+        float *row = pooled + (size_t)i * poolWidth;
+        for (int f = 0; f < poolWidth; f++) {
+            row[f] /= features[i].numFrames;
         }
     }
 
-    float sumExp = 0.0f;
-    for (int c = 0; c < model->numClasses; c++) {
-        output->probabilities[c] = expf(output->logits[c] - maxLogit);
-        sumExp += output->probabilities[c];
+    /* Classify every clip in one product */
+    if (!runStep(&model->steps[model->numLayers - 1], pooled, count, logits)) {
+        fprintf(stderr, "Audio model output layer failed\n");
+        goto cleanup;
     }
 
-    for (int c = 0; c < model->numClasses; c++) {
-        output->probabilities[c] /= sumExp;
+    for (int i = 0; i < count; i++) {
+        TinyAIAudioModelOutput *output = &outputs[i];
+        memcpy(output->logits, logits + (size_t)i * model->numClasses,
+               model->numClasses * sizeof(float));
+
+        /* Apply softmax to get probabilities */
+        tinyaiSimdSoftmaxTemperature(output->probabilities, output->logits, model->numClasses,
+                                     1.0f);
+
+        /* Find predicted class */
+        output->predictedClass = tinyaiSimdArgmax(output->probabilities, model->numClasses);
+        output->confidence     = output->probabilities[output->predictedClass];
     }
+    success = true;
 
-    /* Find predicted class */
-    output->predictedClass = 0;
-    output->confidence     = output->probabilities[0];
-    for (int c = 1; c < model->numClasses; c++) {
-        if (output->probabilities[c] > output->confidence) {
-            output->predictedClass = c;
-            output->confidence     = output->probabilities[c];
+cleanup:
+    if (features && extracted) {
+        for (int i = 0; i < count; i++) {
+            if (extracted[i]) {
+                tinyaiAudioFeaturesFree(&features[i]);
+            }
         }
     }
+    freeTemporary(model, logits);
+    freeTemporary(model, pooled);
+    freeTemporary(model, chunkSums);
+    freeTemporary(model, chunkFirst);
+    freeTemporary(model, chunkClip);
+    freeTemporary(model, extracted);
+    freeTemporary(model, features);
+    if (model->arena) {
+        tinyaiArenaEndScope(model->arena, mark);
+    }
 
-    /* Clean up */
-    free(avgFeatures);
-    tinyaiAudioFeaturesFree(&features);
+    return success;
+}
 
-    return true;
+/**
+ * Process audio data with the model
+ * @param model The audio model to use
+ * @param audio The audio data to process
+ * @param output The output structure to fill
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioModelProcess(TinyAIAudioModel *model, const TinyAIAudioData *audio,
+                             TinyAIAudioModelOutput *output)
+{
+    if (!model || !audio || !output) {
+        return false;
+    }
+
+    return tinyaiAudioModelProcessBatch(model, audio, 1, output);
 }
 
 /**
@@ -492,3 +685,20 @@ bool tinyaiAudioModelEnableSIMD(TinyAIAudioModel *model, bool enable)
 
     return true;
 }
+
+/**
+ * Set an arena for the temporaries of each call to process audio
+ * @param model The model to configure
+ * @param arena Arena to use, or NULL to allocate from the heap again
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioModelSetArena(TinyAIAudioModel *model, TinyAIArena *arena)
+{
+    if (!model) {
+        return false;
+    }
+
+    model->arena = arena;
+
+    return true;
+}
@@ -10,6 +10,7 @@
 #ifndef TINYAI_AUDIO_MODEL_H
 #define TINYAI_AUDIO_MODEL_H
 
+#include "../../utils/arena.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -117,6 +118,11 @@ void tinyaiAudioModelFree(TinyAIAudioModel *model);
 
 /**
  * Process audio data with the model
+ *
+ * Each feature frame runs through the hidden layers, the last hidden layer
+ * is averaged over time and the output layer classifies the average. Fails
+ * before the next layer once the cancellation token installed on the
+ * calling thread (see cancel.h) fires.
  * @param model The audio model to use
  * @param audio The audio data to process
  * @param output The output structure to fill
@@ -125,6 +131,21 @@ void tinyaiAudioModelFree(TinyAIAudioModel *model);
 bool tinyaiAudioModelProcess(TinyAIAudioModel *model, const TinyAIAudioData *audio,
                              TinyAIAudioModelOutput *output);
 
+/**
+ * Process a batch of audio clips with the model
+ *
+ * The clips' frames are cut into chunks that run on the shared thread pool
+ * together, so a batch of short utterances or one long recording both keep
+ * every thread busy. Each output matches tinyaiAudioModelProcess on its clip.
+ * @param model The audio model to use
+ * @param audios The audio clips to process
+ * @param count Number of clips
+ * @param outputs The output structures to fill, one per clip
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioModelProcessBatch(TinyAIAudioModel *model, const TinyAIAudioData *audios,
+                                  int count, TinyAIAudioModelOutput *outputs);
+
 /**
  * Extract features from audio data
  * @param audio The audio data to process
@@ -178,6 +199,14 @@ void tinyaiAudioModelOutputFree(TinyAIAudioModelOutput *output);
  */
 bool tinyaiAudioModelEnableSIMD(TinyAIAudioModel *model, bool enable);
 
+/**
+ * Set an arena for the temporaries of each call to process audio
+ * @param model The model to configure
+ * @param arena Arena to use, or NULL to allocate from the heap again
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioModelSetArena(TinyAIAudioModel *model, TinyAIArena *arena);
+
 #ifdef __cplusplus
 }
 #endif
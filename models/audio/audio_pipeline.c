@@ -0,0 +1,408 @@
+/**
+ * @file audio_pipeline.c
+ * @brief VAD-gated streaming audio pipeline
+ */
+
+#include "audio_pipeline.h"
+#include "../../utils/energy.h"
+#include "../../utils/simd_ops.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Default configuration values */
+#define DEFAULT_SAMPLE_RATE 16000
+#define DEFAULT_FRAME_MS 10                 /* 10 ms frames */
+#define DEFAULT_MIN_ENERGY 1e-5f            /* -50 dBFS */
+#define DEFAULT_ENERGY_RATIO 4.0f           /* Speech is 6 dB over the noise */
+#define DEFAULT_MAX_ZERO_CROSSING_RATE 0.5f /* White noise crosses at about 0.5 */
+#define DEFAULT_NOISE_ADAPTATION_RATE 0.05f
+#define DEFAULT_HANGOVER_MS 300
+#define DEFAULT_PRE_ROLL_MS 200
+
+/* The noise level rises this much slower than it falls, so speech does not raise it */
+#define NOISE_RISE_DIVISOR 10.0f
+
+struct TinyAIAudioPipeline {
+    TinyAIAudioPipelineConfig config;
+    TinyAIAudioPipelineStage  stages[TINYAI_AUDIO_PIPELINE_MAX_STAGES];
+    int                       numStages;
+
+    /* Detector */
+    int    frameSamples;    /* Samples of one detector frame */
+    int    hangoverFrames;  /* Frames passed on after speech */
+    float *frame;           /* Frame being filled */
+    int    frameFill;       /* Samples in frame */
+    float  noiseLevel;      /* Noise energy estimate, negative before the first frame */
+    int    hangoverCounter; /* Frames of hangover left */
+    bool   active;          /* Whether frames are flowing to the stages */
+
+    /* Pre-roll ring of the latest frames not passed on */
+    float *preRoll;
+    int    preRollSize; /* Samples the ring holds, a whole number of frames */
+    int    preRollHead; /* Index of the oldest sample */
+    int    preRollFill; /* Samples in the ring */
+
+    /* Speech gathered for the next burst */
+    float *burst;
+    int    burstSize; /* Samples of a burst, a whole number of frames (0 = off) */
+    int    burstFill; /* Samples gathered */
+
+    /* Statistics */
+    int64_t framesTotal;
+    int64_t framesPassed;
+};
+
+/**
+ * Initialize the default pipeline configuration for 16 kHz audio
+ * @param config Configuration structure to initialize
+ */
+void tinyaiAudioPipelineInitConfig(TinyAIAudioPipelineConfig *config)
+{
+    if (!config) {
+        return;
+    }
+
+    config->sampleRate          = DEFAULT_SAMPLE_RATE;
+    config->frameMs             = DEFAULT_FRAME_MS;
+    config->minEnergy           = DEFAULT_MIN_ENERGY;
+    config->energyRatio         = DEFAULT_ENERGY_RATIO;
+    config->maxZeroCrossingRate = DEFAULT_MAX_ZERO_CROSSING_RATE;
+    config->noiseAdaptationRate = DEFAULT_NOISE_ADAPTATION_RATE;
+    config->hangoverMs          = DEFAULT_HANGOVER_MS;
+    config->preRollMs           = DEFAULT_PRE_ROLL_MS;
+    config->burstMs             = tinyaiGetExecutionProfile() == TINYAI_PROFILE_ENERGY
+                                      ? TINYAI_ENERGY_AUDIO_BURST_MS
+                                      : 0;
+}
+
+/**
+ * Create a pipeline without stages
+ * @param config Detector configuration
+ * @return Newly allocated pipeline, or NULL on failure
+ */
+TinyAIAudioPipeline *tinyaiAudioPipelineCreate(const TinyAIAudioPipelineConfig *config)
+{
+    if (!config || config->sampleRate <= 0 || config->frameMs <= 0 || config->hangoverMs < 0 ||
+        config->preRollMs < 0 || config->burstMs < 0) {
+        return NULL;
+    }
+
+    int frameSamples = (int)((int64_t)config->sampleRate * config->frameMs / 1000);
+    if (frameSamples < 2) {
+        return NULL;
+    }
+
+    TinyAIAudioPipeline *pipeline = (TinyAIAudioPipeline *)calloc(1, sizeof(TinyAIAudioPipeline));
+    if (!pipeline) {
+        return NULL;
+    }
+
+    /* Hangover, pre-roll and bursts round up to whole frames */
+    pipeline->config         = *config;
+    pipeline->frameSamples   = frameSamples;
+    pipeline->hangoverFrames = (config->hangoverMs + config->frameMs - 1) / config->frameMs;
+    pipeline->preRollSize =
+        (config->preRollMs + config->frameMs - 1) / config->frameMs * frameSamples;
+    pipeline->burstSize = (config->burstMs + config->frameMs - 1) / config->frameMs * frameSamples;
+    pipeline->frame     = (float *)malloc(frameSamples * sizeof(float));
+    pipeline->preRoll   = (float *)malloc((pipeline->preRollSize > 0 ? pipeline->preRollSize : 1) *
+                                          sizeof(float));
+    pipeline->burst =
+        pipeline->burstSize > 0 ? (float *)malloc(pipeline->burstSize * sizeof(float)) : NULL;
+    if (!pipeline->frame || !pipeline->preRoll || (pipeline->burstSize > 0 && !pipeline->burst)) {
+        tinyaiAudioPipelineFree(pipeline);
+        return NULL;
+    }
+
+    tinyaiAudioPipelineReset(pipeline);
+    return pipeline;
+}
+
+/**
+ * Free a pipeline
+ * @param pipeline The pipeline to free
+ */
+void tinyaiAudioPipelineFree(TinyAIAudioPipeline *pipeline)
+{
+    if (!pipeline) {
+        return;
+    }
+    free(pipeline->frame);
+    free(pipeline->preRoll);
+    free(pipeline->burst);
+    free(pipeline);
+}
+
+/**
+ * Append a stage to a pipeline's chain
+ * @param pipeline The pipeline to extend
+ * @param stage The stage, copied into the pipeline
+ * @return true on success, false on failure or if the chain is full
+ */
+bool tinyaiAudioPipelineAddStage(TinyAIAudioPipeline *pipeline,
+                                 const TinyAIAudioPipelineStage *stage)
+{
+    if (!pipeline || !stage || !stage->process ||
+        pipeline->numStages >= TINYAI_AUDIO_PIPELINE_MAX_STAGES) {
+        return false;
+    }
+    pipeline->stages[pipeline->numStages++] = *stage;
+    return true;
+}
+
+/* Run samples down the chain until a stage holds them back */
+static int runStages(TinyAIAudioPipeline *pipeline, const float *samples, int numSamples)
+{
+    for (int i = 0; i < pipeline->numStages; i++) {
+        const TinyAIAudioPipelineStage *stage = &pipeline->stages[i];
+        if (!stage->process(stage->context, samples, numSamples)) {
+            break;
+        }
+    }
+    return numSamples;
+}
+
+/* Run the gathered burst down the chain */
+static int releaseBurst(TinyAIAudioPipeline *pipeline)
+{
+    int passed = pipeline->burstFill > 0 ? runStages(pipeline, pipeline->burst,
+                                                     pipeline->burstFill)
+                                         : 0;
+    pipeline->burstFill = 0;
+    return passed;
+}
+
+/* Pass samples on, or gather them into bursts when those are on */
+static int passSamples(TinyAIAudioPipeline *pipeline, const float *samples, int numSamples)
+{
+    if (pipeline->burstSize == 0) {
+        return runStages(pipeline, samples, numSamples);
+    }
+
+    int passed = 0;
+    for (int i = 0; i < numSamples;) {
+        int n = pipeline->burstSize - pipeline->burstFill;
+        n     = numSamples - i < n ? numSamples - i : n;
+        memcpy(pipeline->burst + pipeline->burstFill, samples + i, n * sizeof(float));
+        pipeline->burstFill += n;
+        i += n;
+
+        if (pipeline->burstFill == pipeline->burstSize) {
+            passed += releaseBurst(pipeline);
+        }
+    }
+    return passed;
+}
+
+/* End the open segment after the rest of its burst */
+static int endSegment(TinyAIAudioPipeline *pipeline)
+{
+    int passed = releaseBurst(pipeline);
+    for (int i = 0; i < pipeline->numStages; i++) {
+        const TinyAIAudioPipelineStage *stage = &pipeline->stages[i];
+        if (stage->endSegment) {
+            stage->endSegment(stage->context);
+        }
+    }
+    pipeline->active = false;
+    return passed;
+}
+
+/* Keep a frame that was not passed on in the pre-roll, dropping the oldest */
+static void holdFrame(TinyAIAudioPipeline *pipeline, const float *frame)
+{
+    int size = pipeline->preRollSize;
+    if (size == 0) {
+        return;
+    }
+    for (int i = 0; i < pipeline->frameSamples; i++) {
+        int tail                = (pipeline->preRollHead + pipeline->preRollFill) % size;
+        pipeline->preRoll[tail] = frame[i];
+        if (pipeline->preRollFill < size) {
+            pipeline->preRollFill++;
+        }
+        else {
+            pipeline->preRollHead = (pipeline->preRollHead + 1) % size;
+        }
+    }
+}
+
+/* Pass the pre-roll on, oldest first, in at most two pieces */
+static int releasePreRoll(TinyAIAudioPipeline *pipeline)
+{
+    int fill   = pipeline->preRollFill;
+    int first  = pipeline->preRollSize - pipeline->preRollHead;
+    first      = first < fill ? first : fill;
+    int passed = first > 0 ? passSamples(pipeline, pipeline->preRoll + pipeline->preRollHead,
+                                         first)
+                           : 0;
+    if (fill > first) {
+        passed += passSamples(pipeline, pipeline->preRoll, fill - first);
+    }
+
+    pipeline->framesPassed += fill / pipeline->frameSamples;
+    pipeline->preRollHead = 0;
+    pipeline->preRollFill = 0;
+    return passed;
+}
+
+/**
+ * Decide whether a full frame is speech, and pass it on or hold it
+ * @return Number of samples passed to the first stage
+ */
+static int processFrame(TinyAIAudioPipeline *pipeline)
+{
+    const TinyAIAudioPipelineConfig *config = &pipeline->config;
+    const float                     *frame  = pipeline->frame;
+    int                              n      = pipeline->frameSamples;
+
+    /* One pass each for energy and zero crossings */
+    float energy = tinyaiSimdDot(frame, frame, n) / n;
+    float zcr    = (float)tinyaiSimdCountZeroCrossings(frame, n) / (n - 1);
+    bool  speech = pipeline->noiseLevel >= 0.0f && energy > config->minEnergy &&
+                  energy > pipeline->noiseLevel * config->energyRatio &&
+                  (config->maxZeroCrossingRate <= 0.0f || zcr <= config->maxZeroCrossingRate);
+
+    /* The noise level follows non-speech frames, falling quickly and rising slowly */
+    if (pipeline->noiseLevel < 0.0f) {
+        pipeline->noiseLevel = energy;
+    }
+    else if (!speech) {
+        float rate = config->noiseAdaptationRate;
+        if (energy > pipeline->noiseLevel) {
+            rate /= NOISE_RISE_DIVISOR;
+        }
+        pipeline->noiseLevel += rate * (energy - pipeline->noiseLevel);
+    }
+
+    int passed = 0;
+    if (speech) {
+        pipeline->hangoverCounter = pipeline->hangoverFrames;
+        if (!pipeline->active) {
+            pipeline->active = true;
+            passed += releasePreRoll(pipeline);
+        }
+    }
+    else if (pipeline->active) {
+        if (pipeline->hangoverCounter > 0) {
+            pipeline->hangoverCounter--;
+        }
+        else {
+            passed += endSegment(pipeline);
+        }
+    }
+
+    if (pipeline->active) {
+        passed += passSamples(pipeline, frame, n);
+        pipeline->framesPassed++;
+    }
+    else {
+        holdFrame(pipeline, frame);
+    }
+    pipeline->framesTotal++;
+    return passed;
+}
+
+/**
+ * Push audio into a pipeline
+ * @param pipeline The pipeline to feed
+ * @param samples Audio samples, continuing the previous push
+ * @param numSamples Number of samples
+ * @return Number of samples passed to the first stage, negative on failure
+ */
+int tinyaiAudioPipelinePush(TinyAIAudioPipeline *pipeline, const float *samples, int numSamples)
+{
+    if (!pipeline || (!samples && numSamples > 0) || numSamples < 0) {
+        return -1;
+    }
+
+    int passed = 0;
+    for (int i = 0; i < numSamples;) {
+        int n = pipeline->frameSamples - pipeline->frameFill;
+        n     = numSamples - i < n ? numSamples - i : n;
+        memcpy(pipeline->frame + pipeline->frameFill, samples + i, n * sizeof(float));
+        pipeline->frameFill += n;
+        i += n;
+
+        if (pipeline->frameFill == pipeline->frameSamples) {
+            passed += processFrame(pipeline);
+            pipeline->frameFill = 0;
+        }
+    }
+    return passed;
+}
+
+/**
+ * End the pushed audio
+ * @param pipeline The pipeline to flush
+ * @return Number of samples passed to the first stage, negative on failure
+ */
+int tinyaiAudioPipelineFlush(TinyAIAudioPipeline *pipeline)
+{
+    if (!pipeline) {
+        return -1;
+    }
+
+    int passed = 0;
+    if (pipeline->active) {
+        if (pipeline->frameFill > 0) {
+            passed = passSamples(pipeline, pipeline->frame, pipeline->frameFill);
+        }
+        passed += endSegment(pipeline);
+    }
+    pipeline->frameFill = 0;
+    return passed;
+}
+
+/**
+ * Drop a pipeline's buffered audio and detector state
+ * @param pipeline The pipeline to reset
+ */
+void tinyaiAudioPipelineReset(TinyAIAudioPipeline *pipeline)
+{
+    if (!pipeline) {
+        return;
+    }
+
+    pipeline->frameFill       = 0;
+    pipeline->noiseLevel      = -1.0f;
+    pipeline->hangoverCounter = 0;
+    pipeline->active          = false;
+    pipeline->preRollHead     = 0;
+    pipeline->preRollFill     = 0;
+    pipeline->burstFill       = 0;
+    pipeline->framesTotal     = 0;
+    pipeline->framesPassed    = 0;
+}
+
+/**
+ * Get whether frames are flowing through a pipeline's stages
+ * @param pipeline The pipeline to query
+ * @return true during speech and its hangover, false otherwise
+ */
+bool tinyaiAudioPipelineIsActive(const TinyAIAudioPipeline *pipeline)
+{
+    return pipeline && pipeline->active;
+}
+
+/**
+ * Get the frame counts of a pipeline
+ * @param pipeline The pipeline to query
+ * @param framesTotal Output parameter for the frames pushed (may be NULL)
+ * @param framesPassed Output parameter for the frames passed to the stages (may be NULL)
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioPipelineGetStats(const TinyAIAudioPipeline *pipeline, int64_t *framesTotal,
+                                 int64_t *framesPassed)
+{
+    if (!pipeline) {
+        return false;
+    }
+    if (framesTotal) {
+        *framesTotal = pipeline->framesTotal;
+    }
+    if (framesPassed) {
+        *framesPassed = pipeline->framesPassed;
+    }
+    return true;
+}
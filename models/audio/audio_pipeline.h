@@ -0,0 +1,146 @@
+/**
+ * @file audio_pipeline.h
+ * @brief VAD-gated streaming audio pipeline
+ *
+ * A pipeline runs a voice activity detector on pushed audio and passes on
+ * only the frames it judges to be speech, through a chain of stages such as
+ * keyword spotting and speech recognition. Silence stops at the detector,
+ * so the stages' compute scales with speech time rather than wall time.
+ *
+ * With a burst length set, speech is gathered and handed to the stages in
+ * pieces of that length, and at the end of each segment, rather than frame
+ * by frame, so the cores running the stages idle between bursts.
+ */
+
+#ifndef TINYAI_AUDIO_PIPELINE_H
+#define TINYAI_AUDIO_PIPELINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Most stages a pipeline chains after its detector
+ */
+#define TINYAI_AUDIO_PIPELINE_MAX_STAGES 8
+
+/**
+ * Voice activity detection configuration of a pipeline
+ */
+typedef struct {
+    int   sampleRate;          /* Sample rate of the pushed audio in Hz */
+    int   frameMs;             /* Length and hop of a detector frame in milliseconds */
+    float minEnergy;           /* Mean frame energy below which a frame is silence */
+    float energyRatio;         /* Mean frame energy over the noise level that is speech */
+    float maxZeroCrossingRate; /* Crossings per sample above which a frame is noise (0 = off) */
+    float noiseAdaptationRate; /* Rate the noise level follows quieter frames (0.0-1.0) */
+    int   hangoverMs;          /* Time frames keep flowing after speech in milliseconds */
+    int   preRollMs;           /* Audio before a speech onset passed on with it in milliseconds */
+    int   burstMs;             /* Speech gathered before it is passed on in milliseconds (0 = off) */
+} TinyAIAudioPipelineConfig;
+
+/**
+ * A stage of a pipeline
+ *
+ * process receives the speech audio in order, in pieces of any length; it
+ * returns whether the piece flows on to the next stage, so a stage such as
+ * a keyword spotter can hold back later stages until it fires. endSegment,
+ * if set, is called when a stretch of speech ends, after its last piece.
+ */
+typedef struct {
+    bool (*process)(void *context, const float *samples, int numSamples);
+    void (*endSegment)(void *context);
+    void *context;
+} TinyAIAudioPipelineStage;
+
+/**
+ * A VAD-gated pipeline (opaque)
+ */
+typedef struct TinyAIAudioPipeline TinyAIAudioPipeline;
+
+/**
+ * Initialize the default pipeline configuration for 16 kHz audio
+ *
+ * Bursts are off, except under the energy execution profile (see energy.h).
+ * @param config Configuration structure to initialize
+ */
+void tinyaiAudioPipelineInitConfig(TinyAIAudioPipelineConfig *config);
+
+/**
+ * Create a pipeline without stages
+ * @param config Detector configuration
+ * @return Newly allocated pipeline, or NULL on failure
+ */
+TinyAIAudioPipeline *tinyaiAudioPipelineCreate(const TinyAIAudioPipelineConfig *config);
+
+/**
+ * Free a pipeline
+ * @param pipeline The pipeline to free
+ */
+void tinyaiAudioPipelineFree(TinyAIAudioPipeline *pipeline);
+
+/**
+ * Append a stage to a pipeline's chain
+ * @param pipeline The pipeline to extend
+ * @param stage The stage, copied into the pipeline
+ * @return true on success, false on failure or if the chain is full
+ */
+bool tinyaiAudioPipelineAddStage(TinyAIAudioPipeline *pipeline,
+                                 const TinyAIAudioPipelineStage *stage);
+
+/**
+ * Push audio into a pipeline
+ *
+ * Samples are cut into detector frames. Each frame's energy and
+ * zero-crossing rate decide whether it is speech; speech frames, and the
+ * frames of the hangover after them, flow through the stages, preceded at
+ * each onset by the pre-roll held from before it. Other frames only enter
+ * the pre-roll. A partial frame waits for the next push, and with bursts on,
+ * speech waits until a burst fills or its segment ends.
+ * @param pipeline The pipeline to feed
+ * @param samples Audio samples, continuing the previous push
+ * @param numSamples Number of samples
+ * @return Number of samples passed to the first stage, negative on failure
+ */
+int tinyaiAudioPipelinePush(TinyAIAudioPipeline *pipeline, const float *samples, int numSamples);
+
+/**
+ * End the pushed audio: pass on the partial frame if speech is flowing and
+ * end the open segment
+ * @param pipeline The pipeline to flush
+ * @return Number of samples passed to the first stage, negative on failure
+ */
+int tinyaiAudioPipelineFlush(TinyAIAudioPipeline *pipeline);
+
+/**
+ * Drop a pipeline's buffered audio and detector state, to start a new stream
+ * @param pipeline The pipeline to reset
+ */
+void tinyaiAudioPipelineReset(TinyAIAudioPipeline *pipeline);
+
+/**
+ * Get whether frames are flowing through a pipeline's stages
+ * @param pipeline The pipeline to query
+ * @return true during speech and its hangover, false otherwise
+ */
+bool tinyaiAudioPipelineIsActive(const TinyAIAudioPipeline *pipeline);
+
+/**
+ * Get the frame counts of a pipeline since it was created or reset
+ * @param pipeline The pipeline to query
+ * @param framesTotal Output parameter for the frames pushed (may be NULL)
+ * @param framesPassed Output parameter for the frames passed to the stages (may be NULL)
+ * @return true on success, false on failure
+ */
+bool tinyaiAudioPipelineGetStats(const TinyAIAudioPipeline *pipeline, int64_t *framesTotal,
+                                 int64_t *framesPassed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_AUDIO_PIPELINE_H */
@@ -6,6 +6,8 @@
 #include "audio_utils.h"
 #include "../../core/io.h"
 #include "../../core/memory.h"
+#include "../../utils/simd_ops.h"
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,9 +19,25 @@
 #define FMT_CHUNK_ID 0x20746D66  /* "fmt " */
 #define DATA_CHUNK_ID 0x61746164 /* "data" */
 
+/* Encodings of the format chunk */
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+/* Raw bytes a WAV reader decodes at a time */
+#define WAV_CHUNK_BYTES (64 * 1024)
+
 /* Maximum number of supported channels */
 #define MAX_CHANNELS 8
 
+/* Polyphase resampling */
+#define RESAMPLER_MAX_PHASES 1024    /* Most phases (reduced output rate) of a filter bank */
+#define RESAMPLER_MAX_TAPS 1024      /* Most taps of one phase */
+#define RESAMPLER_ZERO_CROSSINGS 8   /* Zero crossings of the sinc on each side */
+#define RESAMPLER_ROLLOFF 0.9        /* Cutoff relative to the lower of the two Nyquist rates */
+#define RESAMPLER_BLOCK 1024         /* Input samples buffered at a time */
+#define RESAMPLER_CACHE_SIZE 16      /* Filter banks shared across resamplers */
+
 /* WAV file header structures */
 typedef struct {
     uint32_t chunkId;   /* "RIFF" */
@@ -44,232 +62,327 @@ typedef struct {
 } DataHeader;
 
 /**
- * Convert samples from integer to float format
- * @param input Input integer samples
- * @param output Output float samples
- * @param numSamples Number of samples
- * @param bitsPerSample Bits per sample (8, 16, 24, etc.)
- * @return true on success, false on failure
+ * Streaming WAV reader
+ *
+ * Raw frames are read a chunk at a time and decoded straight into the
+ * caller's buffer, so reading takes constant memory whatever the length of
+ * the recording.
  */
-static bool convertIntToFloat(const void *input, float *output, int numSamples, int bitsPerSample)
+struct TinyAIWavReader {
+    TinyAIFile       *file;
+    TinyAIAudioFormat format;      /* Format as stored in the file */
+    bool              isFloat;     /* IEEE float rather than integer PCM samples */
+    int               frameBytes;  /* Bytes of one frame of all channels */
+    int               chunkFrames; /* Frames chunk holds */
+    int64_t           dataOffset;  /* File offset of the first frame */
+    int64_t           numFrames;
+    int64_t           position; /* Next frame to read */
+    uint8_t          *chunk;    /* Raw frames being decoded */
+};
+
+/* Skip a chunk's payload, including the pad byte of an odd size */
+static bool skipWavChunk(TinyAIFile *file, uint32_t size)
 {
-    if (!input || !output || numSamples <= 0) {
+    return tinyaiSeekFile(file, (int64_t)size + (size & 1), 1) >= 0;
+}
+
+/**
+ * Parse the RIFF header and the chunks up to the data, leaving the file at the first frame
+ */
+static bool readWavHeader(TinyAIWavReader *reader)
+{
+    RiffHeader riffHeader;
+    if (tinyaiReadFile(reader->file, &riffHeader, sizeof(RiffHeader)) != sizeof(RiffHeader) ||
+        riffHeader.chunkId != RIFF_CHUNK_ID || riffHeader.format != WAVE_FORMAT) {
         return false;
     }
 
-    switch (bitsPerSample) {
-    case 8: {
-        /* 8-bit samples are unsigned [0, 255] */
-        const uint8_t *samples = (const uint8_t *)input;
-        for (int i = 0; i < numSamples; i++) {
-            /* Convert to [-1.0, 1.0] */
-            output[i] = ((float)samples[i] - 128.0f) / 128.0f;
+    /* Chunks come in any order, but the format precedes the data */
+    FmtHeader  fmtHeader;
+    DataHeader chunk;
+    bool       haveFormat = false;
+    uint16_t   encoding   = 0;
+    while (true) {
+        if (tinyaiReadFile(reader->file, &chunk, sizeof(DataHeader)) != sizeof(DataHeader)) {
+            return false;
         }
-        break;
-    }
-    case 16: {
-        /* 16-bit samples are signed [-32768, 32767] */
-        const int16_t *samples = (const int16_t *)input;
-        for (int i = 0; i < numSamples; i++) {
-            /* Convert to [-1.0, 1.0] */
-            output[i] = (float)samples[i] / 32768.0f;
+        if (chunk.chunkId == DATA_CHUNK_ID) {
+            break;
         }
-        break;
-    }
-    case 24: {
-        /* 24-bit samples are signed, stored as 3 bytes */
-        const uint8_t *bytes = (const uint8_t *)input;
-        for (int i = 0; i < numSamples; i++) {
-            /* Extract 24-bit signed value */
-            int value = (bytes[i * 3] << 8) | (bytes[i * 3 + 1] << 16) | (bytes[i * 3 + 2] << 24);
-            value >>= 8; /* Shift back to get correct sign extension */
-            /* Convert to [-1.0, 1.0] */
-            output[i] = (float)value / 8388608.0f; /* 2^23 */
+        if (chunk.chunkId != FMT_CHUNK_ID) {
+            if (!skipWavChunk(reader->file, chunk.chunkSize)) {
+                return false;
+            }
+            continue;
         }
-        break;
-    }
-    case 32: {
-        /* 32-bit samples could be signed int or float */
-        /* For now, assume signed int */
-        const int32_t *samples = (const int32_t *)input;
-        for (int i = 0; i < numSamples; i++) {
-            /* Convert to [-1.0, 1.0] */
-            output[i] = (float)samples[i] / 2147483648.0f; /* 2^31 */
+
+        size_t fieldsSize = sizeof(FmtHeader) - sizeof(DataHeader);
+        if (chunk.chunkSize < fieldsSize ||
+            tinyaiReadFile(reader->file, (uint8_t *)&fmtHeader + sizeof(DataHeader),
+                           fieldsSize) != (int64_t)fieldsSize) {
+            return false;
         }
-        break;
+        uint32_t extraSize = chunk.chunkSize - (uint32_t)fieldsSize;
+        encoding           = fmtHeader.audioFormat;
+
+        /* WAVE_FORMAT_EXTENSIBLE keeps the encoding in the first bytes of its subformat GUID */
+        uint8_t extension[24];
+        if (encoding == WAVE_FORMAT_EXTENSIBLE && extraSize >= sizeof(extension)) {
+            if (tinyaiReadFile(reader->file, extension, sizeof(extension)) !=
+                (int64_t)sizeof(extension)) {
+                return false;
+            }
+            encoding = (uint16_t)(extension[8] | (extension[9] << 8));
+            extraSize -= sizeof(extension);
+        }
+        int64_t rest = (int64_t)extraSize + (chunk.chunkSize & 1);
+        if (rest > 0 && tinyaiSeekFile(reader->file, rest, 1) < 0) {
+            return false;
+        }
+        haveFormat = true;
     }
-    default:
+    if (!haveFormat) {
         return false;
     }
 
-    return true;
+    /* Integer PCM of 8 to 32 bits, or 32-bit floats */
+    int bits = fmtHeader.bitsPerSample;
+    if ((encoding != WAVE_FORMAT_PCM && encoding != WAVE_FORMAT_IEEE_FLOAT) ||
+        (encoding == WAVE_FORMAT_IEEE_FLOAT && bits != 32) ||
+        (bits != 8 && bits != 16 && bits != 24 && bits != 32) || fmtHeader.numChannels == 0 ||
+        fmtHeader.numChannels > MAX_CHANNELS || fmtHeader.sampleRate == 0) {
+        return false;
+    }
+
+    reader->format.sampleRate    = (int)fmtHeader.sampleRate;
+    reader->format.channels      = fmtHeader.numChannels;
+    reader->format.bitsPerSample = bits;
+    reader->isFloat              = encoding == WAVE_FORMAT_IEEE_FLOAT;
+    reader->frameBytes           = fmtHeader.numChannels * (bits / 8);
+    reader->numFrames            = chunk.chunkSize / reader->frameBytes;
+    reader->dataOffset           = tinyaiTellFile(reader->file);
+    return reader->dataOffset >= 0;
 }
 
 /**
- * Convert multi-channel audio to mono
- * @param input Input multi-channel samples (interleaved)
- * @param output Output mono samples
- * @param numFrames Number of frames
- * @param numChannels Number of channels
- * @return true on success, false on failure
+ * Decode one sample to [-1, 1]
  */
-static bool convertToMono(const float *input, float *output, int numFrames, int numChannels)
+static float decodeWavSample(const uint8_t *bytes, int bits, bool isFloat)
 {
-    if (!input || !output || numFrames <= 0 || numChannels <= 0) {
-        return false;
+    switch (bits) {
+    case 8:
+        /* 8-bit samples are unsigned [0, 255] */
+        return ((float)bytes[0] - 128.0f) / 128.0f;
+    case 16: {
+        int16_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return (float)value / 32768.0f;
     }
-
-    /* Special case for mono */
-    if (numChannels == 1) {
-        if (input != output) {
-            memcpy(output, input, numFrames * sizeof(float));
+    case 24: {
+        /* Assemble in the top bytes, then shift back for the sign */
+        int32_t value = (int32_t)((uint32_t)bytes[0] << 8 | (uint32_t)bytes[1] << 16 |
+                                  (uint32_t)bytes[2] << 24);
+        return (float)(value >> 8) / 8388608.0f; /* 2^23 */
+    }
+    default: {
+        if (isFloat) {
+            float value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
         }
-        return true;
+        int32_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return (float)value / 2147483648.0f; /* 2^31 */
     }
+    }
+}
 
-    /* Average all channels */
-    for (int i = 0; i < numFrames; i++) {
-        float sum = 0.0f;
-        for (int j = 0; j < numChannels; j++) {
-            sum += input[i * numChannels + j];
-        }
-        output[i] = sum / numChannels;
+/**
+ * Decode frames to mono floats in one pass, averaging the channels
+ */
+static void decodeWavFrames(const TinyAIWavReader *reader, const uint8_t *bytes, int frames,
+                            float *output)
+{
+    int channels = reader->format.channels;
+    int bits     = reader->format.bitsPerSample;
+    if (bits == 16) {
+        tinyaiSimdPCM16ToMono((const int16_t *)bytes, channels, frames, output);
+        return;
     }
 
-    return true;
+    int sampleBytes = bits / 8;
+    for (int i = 0; i < frames; i++) {
+        const uint8_t *frame = bytes + (size_t)i * reader->frameBytes;
+        float          sum   = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            sum += decodeWavSample(frame + c * sampleBytes, bits, reader->isFloat);
+        }
+        output[i] = sum / channels;
+    }
 }
 
 /**
- * Load audio data from a WAV file
+ * Open a WAV file for streaming
  * @param path Path to the WAV file
- * @param audio Output structure to receive audio data
- * @return true on success, false on failure
+ * @return Newly opened reader, or NULL on failure or for an unsupported encoding
  */
-static bool loadWavFile(const char *path, TinyAIAudioData *audio)
+TinyAIWavReader *tinyaiWavReaderOpen(const char *path)
 {
-    if (!path || !audio) {
-        return false;
+    if (!path) {
+        return NULL;
     }
 
-    /* Open file */
-    FILE *file = fopen(path, "rb");
-    if (!file) {
-        return false;
+    TinyAIWavReader *reader = (TinyAIWavReader *)calloc(1, sizeof(TinyAIWavReader));
+    if (!reader) {
+        return NULL;
     }
-
-    /* Read RIFF header */
-    RiffHeader riffHeader;
-    if (fread(&riffHeader, sizeof(RiffHeader), 1, file) != 1 ||
-        riffHeader.chunkId != RIFF_CHUNK_ID || riffHeader.format != WAVE_FORMAT) {
-        fclose(file);
-        return false;
+    reader->file = tinyaiOpenFile(path, TINYAI_FILE_READ | TINYAI_FILE_BINARY);
+    if (!reader->file || !readWavHeader(reader)) {
+        tinyaiWavReaderClose(reader);
+        return NULL;
     }
 
-    /* Read format header */
-    FmtHeader fmtHeader;
-    if (fread(&fmtHeader, sizeof(FmtHeader), 1, file) != 1 || fmtHeader.chunkId != FMT_CHUNK_ID) {
-        fclose(file);
-        return false;
+    reader->chunkFrames = WAV_CHUNK_BYTES / reader->frameBytes;
+    reader->chunk       = (uint8_t *)malloc((size_t)reader->chunkFrames * reader->frameBytes);
+    if (!reader->chunk) {
+        tinyaiWavReaderClose(reader);
+        return NULL;
     }
 
-    /* Skip extra format bytes if present */
-    if (fmtHeader.chunkSize > 16) {
-        fseek(file, fmtHeader.chunkSize - 16, SEEK_CUR);
-    }
+    tinyaiAdviseFile(reader->file, reader->dataOffset,
+                     reader->numFrames * reader->frameBytes, TINYAI_IO_ADVICE_SEQUENTIAL);
+    return reader;
+}
 
-    /* Find data chunk */
-    DataHeader dataHeader;
-    while (1) {
-        if (fread(&dataHeader, sizeof(DataHeader), 1, file) != 1) {
-            fclose(file);
-            return false;
-        }
-        if (dataHeader.chunkId == DATA_CHUNK_ID) {
-            break;
-        }
-        fseek(file, dataHeader.chunkSize, SEEK_CUR);
+/**
+ * Close a WAV reader
+ * @param reader The reader to close
+ */
+void tinyaiWavReaderClose(TinyAIWavReader *reader)
+{
+    if (!reader) {
+        return;
     }
-
-    /* Only PCM format is supported */
-    if (fmtHeader.audioFormat != 1) {
-        fclose(file);
-        return false;
+    if (reader->file) {
+        tinyaiCloseFile(reader->file);
     }
+    free(reader->chunk);
+    free(reader);
+}
 
-    /* Check if we support this format */
-    if (fmtHeader.numChannels > MAX_CHANNELS || fmtHeader.bitsPerSample > 32) {
-        fclose(file);
+/**
+ * Get the format of a WAV file as stored
+ * @param reader The reader to query
+ * @param format Output parameter for the format
+ * @return true on success, false on failure
+ */
+bool tinyaiWavReaderGetFormat(const TinyAIWavReader *reader, TinyAIAudioFormat *format)
+{
+    if (!reader || !format) {
         return false;
     }
+    *format = reader->format;
+    return true;
+}
 
-    /* Set audio format */
-    audio->format.sampleRate    = fmtHeader.sampleRate;
-    audio->format.channels      = fmtHeader.numChannels;
-    audio->format.bitsPerSample = fmtHeader.bitsPerSample;
+/**
+ * Get the number of frames of a WAV file
+ * @param reader The reader to query
+ * @return Number of frames, 0 if reader is NULL
+ */
+int64_t tinyaiWavReaderNumFrames(const TinyAIWavReader *reader)
+{
+    return reader ? reader->numFrames : 0;
+}
 
-    /* Calculate duration */
-    int bytesPerSample = fmtHeader.bitsPerSample / 8;
-    int numSamples     = dataHeader.chunkSize / (bytesPerSample * fmtHeader.numChannels);
-    audio->durationMs  = (numSamples * 1000) / fmtHeader.sampleRate;
+/**
+ * Read the next frames of a WAV file as mono floats
+ * @param reader The reader to read from
+ * @param output Output samples [maxFrames]
+ * @param maxFrames Most frames to read
+ * @return Number of frames read, 0 at the end of the data, negative on failure
+ */
+int tinyaiWavReaderRead(TinyAIWavReader *reader, float *output, int maxFrames)
+{
+    if (!reader || (!output && maxFrames > 0) || maxFrames < 0) {
+        return -1;
+    }
+
+    int done = 0;
+    while (done < maxFrames && reader->position < reader->numFrames) {
+        int64_t n = maxFrames - done < reader->chunkFrames ? maxFrames - done
+                                                           : reader->chunkFrames;
+        n         = reader->numFrames - reader->position < n ? reader->numFrames - reader->position
+                                                             : n;
+        int64_t bytes = tinyaiReadFile(reader->file, reader->chunk, (size_t)n * reader->frameBytes);
+        if (bytes < 0) {
+            return -1;
+        }
+
+        int frames = (int)(bytes / reader->frameBytes);
+        decodeWavFrames(reader, reader->chunk, frames, output + done);
+        done += frames;
+        reader->position += frames;
+
+        /* A file cut short ends at its last whole frame */
+        if (frames < n) {
+            reader->numFrames = reader->position;
+        }
+    }
+    return done;
+}
 
-    /* Read audio data */
-    size_t dataSize = dataHeader.chunkSize;
-    void  *data     = malloc(dataSize);
-    if (!data) {
-        fclose(file);
+/**
+ * Move a WAV reader to a frame
+ * @param reader The reader to move
+ * @param frame Index of the next frame to read
+ * @return true on success, false on failure
+ */
+bool tinyaiWavReaderSeek(TinyAIWavReader *reader, int64_t frame)
+{
+    if (!reader || frame < 0 || frame > reader->numFrames) {
         return false;
     }
-    if (fread(data, 1, dataSize, file) != dataSize) {
-        free(data);
-        fclose(file);
+    if (tinyaiSeekFile(reader->file, reader->dataOffset + frame * reader->frameBytes, 0) < 0) {
         return false;
     }
+    reader->position = frame;
+    return true;
+}
 
-    /* Convert to floating-point mono */
-    int    totalSamples = numSamples * fmtHeader.numChannels;
-    float *floatSamples = (float *)malloc(totalSamples * sizeof(float));
-    if (!floatSamples) {
-        free(data);
-        fclose(file);
+/**
+ * Load a whole WAV file as mono floats through a reader
+ */
+static bool loadWavFile(const char *path, TinyAIAudioData *audio)
+{
+    if (!path || !audio) {
         return false;
     }
-    if (!convertIntToFloat(data, floatSamples, totalSamples, fmtHeader.bitsPerSample)) {
-        free(data);
-        free(floatSamples);
-        fclose(file);
+
+    TinyAIWavReader *reader = tinyaiWavReaderOpen(path);
+    if (!reader) {
         return false;
     }
 
-    /* Convert to mono if necessary */
-    if (fmtHeader.numChannels > 1) {
-        float *monoSamples = (float *)malloc(numSamples * sizeof(float));
-        if (!monoSamples) {
-            free(data);
-            free(floatSamples);
-            fclose(file);
-            return false;
-        }
-        if (!convertToMono(floatSamples, monoSamples, numSamples, fmtHeader.numChannels)) {
-            free(data);
-            free(floatSamples);
-            free(monoSamples);
-            fclose(file);
-            return false;
-        }
-        free(floatSamples);
-        floatSamples           = monoSamples;
-        totalSamples           = numSamples;
-        audio->format.channels = 1; /* Now mono */
+    int64_t numFrames = reader->numFrames;
+    float  *samples   = numFrames > 0 && numFrames <= INT_MAX
+                            ? (float *)malloc((size_t)numFrames * sizeof(float))
+                            : NULL;
+    int     frames    = samples ? tinyaiWavReaderRead(reader, samples, (int)numFrames) : -1;
+    if (frames <= 0) {
+        free(samples);
+        tinyaiWavReaderClose(reader);
+        return false;
     }
 
-    /* Set audio data */
-    audio->data     = floatSamples;
-    audio->dataSize = totalSamples * sizeof(float);
-
-    /* Clean up */
-    free(data);
-    fclose(file);
+    /* The samples are now mono; bitsPerSample stays that of the file */
+    audio->format          = reader->format;
+    audio->format.channels = 1;
+    audio->durationMs      = (int)((int64_t)frames * 1000 / reader->format.sampleRate);
+    audio->data            = samples;
+    audio->dataSize        = (size_t)frames * sizeof(float);
 
+    tinyaiWavReaderClose(reader);
     return true;
 }
 
@@ -321,6 +434,318 @@ void tinyaiAudioDataFree(TinyAIAudioData *audio)
     audio->dataSize = 0;
 }
 
+/**
+ * Filter bank of one resampling ratio
+ *
+ * Phase p holds the taps of the outputs that fall p/up of an input sample
+ * after the input sample they are centred on, so every output is one dot
+ * product over a contiguous run of input.
+ */
+typedef struct {
+    int    up;           /* Reduced output rate */
+    int    down;         /* Reduced input rate */
+    int    taps;         /* Taps per phase, a multiple of 8 */
+    float *coefficients; /* Phases one after another [up x taps] */
+} ResamplerBank;
+
+static ResamplerBank *g_resamplerBanks[RESAMPLER_CACHE_SIZE];
+
+/**
+ * Streaming polyphase resampler
+ *
+ * The buffer starts half a filter before the next output's input time, so
+ * output n is the dot product of phase (time % up) with the taps of input
+ * starting at buffer[time / up].
+ */
+struct TinyAIAudioResampler {
+    const ResamplerBank *bank;
+    ResamplerBank       *ownBank; /* Bank of a ratio the cache had no room for */
+    float               *buffer;  /* Input window [taps + RESAMPLER_BLOCK] */
+    int                  capacity;
+    int                  filled;  /* Samples in buffer */
+    int64_t              time;    /* Next output, in 1/up input samples from buffer[0] */
+    int64_t              inputs;  /* Input samples of the stream so far */
+    int64_t              outputs; /* Output samples of the stream so far */
+};
+
+static int greatestCommonDivisor(int a, int b)
+{
+    while (b != 0) {
+        int r = a % b;
+        a     = b;
+        b     = r;
+    }
+    return a;
+}
+
+static void freeResamplerBank(ResamplerBank *bank)
+{
+    if (bank) {
+        free(bank->coefficients);
+        free(bank);
+    }
+}
+
+/**
+ * Compute the windowed-sinc filter bank of a reduced ratio
+ */
+static ResamplerBank *createResamplerBank(int up, int down)
+{
+    /* Downsampling narrows the passband, and the filter widens to match */
+    double cutoff = RESAMPLER_ROLLOFF * (up < down ? (double)up / down : 1.0);
+    int    half   = (int)ceil(RESAMPLER_ZERO_CROSSINGS / cutoff);
+    int    taps   = (2 * half + 7) & ~7;
+    half          = taps / 2;
+    if (taps > RESAMPLER_MAX_TAPS) {
+        return NULL;
+    }
+
+    ResamplerBank *bank = (ResamplerBank *)malloc(sizeof(ResamplerBank));
+    if (!bank) {
+        return NULL;
+    }
+    bank->up           = up;
+    bank->down         = down;
+    bank->taps         = taps;
+    bank->coefficients = (float *)malloc((size_t)up * taps * sizeof(float));
+    if (!bank->coefficients) {
+        free(bank);
+        return NULL;
+    }
+
+    const double pi = 3.14159265358979323846;
+    for (int p = 0; p < up; p++) {
+        float *phase = bank->coefficients + (size_t)p * taps;
+        double sum   = 0.0;
+        for (int j = 0; j < taps; j++) {
+            /* Distance from the output to input sample j of its window, in input samples */
+            double d      = (double)p / up + half - 1 - j;
+            double x      = pi * cutoff * d;
+            double sinc   = d == 0.0 ? 1.0 : sin(x) / x;
+            double w      = pi * d / half;
+            double window = 0.42 + 0.5 * cos(w) + 0.08 * cos(2.0 * w); /* Blackman */
+            phase[j]      = (float)(sinc * window);
+            sum += phase[j];
+        }
+
+        /* Unit gain at DC in every phase, so a constant input stays constant */
+        for (int j = 0; j < taps; j++) {
+            phase[j] = (float)(phase[j] / sum);
+        }
+    }
+
+    return bank;
+}
+
+/**
+ * Get the shared filter bank of a reduced ratio, computing it on first use
+ *
+ * Banks are never changed once published. When every slot of the cache
+ * holds another ratio, the bank is returned in ownBank for the caller to free.
+ */
+static const ResamplerBank *cachedResamplerBank(int up, int down, ResamplerBank **ownBank)
+{
+    ResamplerBank *bank = NULL;
+    *ownBank            = NULL;
+    for (int i = 0; i < RESAMPLER_CACHE_SIZE; i++) {
+        ResamplerBank *cached = __atomic_load_n(&g_resamplerBanks[i], __ATOMIC_ACQUIRE);
+        if (!cached) {
+            if (!bank && !(bank = createResamplerBank(up, down))) {
+                return NULL;
+            }
+            if (__atomic_compare_exchange_n(&g_resamplerBanks[i], &cached, bank, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return bank;
+            }
+        }
+
+        /* The slot is taken, possibly by a thread that just published this ratio */
+        if (cached->up == up && cached->down == down) {
+            freeResamplerBank(bank);
+            return cached;
+        }
+    }
+
+    if (!bank) {
+        bank = createResamplerBank(up, down);
+    }
+    *ownBank = bank;
+    return bank;
+}
+
+/**
+ * Create a streaming polyphase resampler
+ * @param inputRate Sample rate of the input in Hz
+ * @param outputRate Sample rate of the output in Hz
+ * @return Newly allocated resampler, or NULL on failure
+ */
+TinyAIAudioResampler *tinyaiAudioResamplerCreate(int inputRate, int outputRate)
+{
+    if (inputRate <= 0 || outputRate <= 0) {
+        return NULL;
+    }
+    int divisor = greatestCommonDivisor(inputRate, outputRate);
+    int up      = outputRate / divisor;
+    int down    = inputRate / divisor;
+    if (up > RESAMPLER_MAX_PHASES) {
+        return NULL;
+    }
+
+    TinyAIAudioResampler *resampler =
+        (TinyAIAudioResampler *)calloc(1, sizeof(TinyAIAudioResampler));
+    if (!resampler) {
+        return NULL;
+    }
+    resampler->bank = cachedResamplerBank(up, down, &resampler->ownBank);
+    if (!resampler->bank) {
+        free(resampler);
+        return NULL;
+    }
+    resampler->capacity = resampler->bank->taps + RESAMPLER_BLOCK;
+    resampler->buffer   = (float *)malloc(resampler->capacity * sizeof(float));
+    if (!resampler->buffer) {
+        tinyaiAudioResamplerFree(resampler);
+        return NULL;
+    }
+
+    tinyaiAudioResamplerReset(resampler);
+    return resampler;
+}
+
+/**
+ * Free a resampler
+ * @param resampler The resampler to free
+ */
+void tinyaiAudioResamplerFree(TinyAIAudioResampler *resampler)
+{
+    if (!resampler) {
+        return;
+    }
+    freeResamplerBank(resampler->ownBank);
+    free(resampler->buffer);
+    free(resampler);
+}
+
+/**
+ * Get the most output samples one call to tinyaiAudioResamplerProcess can produce
+ * @param resampler The resampler to query
+ * @param numInput Number of input samples of the call
+ * @return Most output samples, 0 if resampler is NULL
+ */
+int tinyaiAudioResamplerMaxOutput(const TinyAIAudioResampler *resampler, int numInput)
+{
+    if (!resampler || numInput < 0) {
+        return 0;
+    }
+    const ResamplerBank *bank = resampler->bank;
+    return (int)(((int64_t)numInput + bank->taps) * bank->up / bank->down + 1);
+}
+
+/**
+ * Produce every output whose window is buffered, up to limit, then drop the
+ * input no later output needs
+ */
+static int resamplerEmit(TinyAIAudioResampler *resampler, float *output, int64_t limit)
+{
+    const ResamplerBank *bank  = resampler->bank;
+    int                  count = 0;
+    while (count < limit && resampler->time / bank->up + bank->taps <= resampler->filled) {
+        const float *phase = bank->coefficients + (resampler->time % bank->up) * bank->taps;
+        output[count++]    = tinyaiSimdDot(phase, resampler->buffer + resampler->time / bank->up,
+                                           bank->taps);
+        resampler->time += bank->down;
+    }
+    resampler->outputs += count;
+
+    int shift = (int)(resampler->time / bank->up);
+    if (shift > 0) {
+        shift = shift < resampler->filled ? shift : resampler->filled;
+        memmove(resampler->buffer, resampler->buffer + shift,
+                (resampler->filled - shift) * sizeof(float));
+        resampler->filled -= shift;
+        resampler->time -= (int64_t)shift * bank->up;
+    }
+    return count;
+}
+
+/**
+ * Resample the next chunk of a stream
+ * @param resampler The resampler to run
+ * @param input Input samples, continuing the previous chunk
+ * @param numInput Number of input samples
+ * @param output Output samples, room for tinyaiAudioResamplerMaxOutput(numInput)
+ * @return Number of output samples, negative on failure
+ */
+int tinyaiAudioResamplerProcess(TinyAIAudioResampler *resampler, const float *input,
+                                int numInput, float *output)
+{
+    if (!resampler || (!input && numInput > 0) || numInput < 0 || !output) {
+        return -1;
+    }
+
+    /* Emitting leaves fewer than taps samples buffered, so every pass takes a block */
+    int produced = 0;
+    for (int consumed = 0; consumed < numInput;) {
+        int n = resampler->capacity - resampler->filled;
+        n     = numInput - consumed < n ? numInput - consumed : n;
+        memcpy(resampler->buffer + resampler->filled, input + consumed, n * sizeof(float));
+        resampler->filled += n;
+        consumed += n;
+        produced += resamplerEmit(resampler, output + produced, INT64_MAX);
+    }
+    resampler->inputs += numInput;
+
+    return produced;
+}
+
+/**
+ * Finish a stream and reset the resampler
+ * @param resampler The resampler to flush
+ * @param output Output samples, room for tinyaiAudioResamplerMaxOutput(0)
+ * @return Number of output samples, negative on failure
+ */
+int tinyaiAudioResamplerFlush(TinyAIAudioResampler *resampler, float *output)
+{
+    if (!resampler || !output) {
+        return -1;
+    }
+
+    /* Outputs up to the time of the last input need half a filter of zeros after it */
+    const ResamplerBank *bank = resampler->bank;
+    int64_t total     = (resampler->inputs * bank->up + bank->down - 1) / bank->down;
+    int     produced  = 0;
+    int     zeros     = bank->taps / 2;
+    while (zeros > 0 && resampler->outputs < total) {
+        int n = resampler->capacity - resampler->filled;
+        n     = zeros < n ? zeros : n;
+        memset(resampler->buffer + resampler->filled, 0, n * sizeof(float));
+        resampler->filled += n;
+        zeros -= n;
+        produced += resamplerEmit(resampler, output + produced, total - resampler->outputs);
+    }
+
+    tinyaiAudioResamplerReset(resampler);
+    return produced;
+}
+
+/**
+ * Drop a resampler's buffered input
+ * @param resampler The resampler to reset
+ */
+void tinyaiAudioResamplerReset(TinyAIAudioResampler *resampler)
+{
+    if (!resampler) {
+        return;
+    }
+
+    /* Silence before the first sample fills the first output's window */
+    resampler->filled = resampler->bank->taps / 2 - 1;
+    memset(resampler->buffer, 0, resampler->filled * sizeof(float));
+    resampler->time    = 0;
+    resampler->inputs  = 0;
+    resampler->outputs = 0;
+}
+
 /**
  * Resample audio data
  * @param input Input audio data
@@ -349,30 +774,46 @@ bool tinyaiAudioResample(const TinyAIAudioData *input, TinyAIAudioData *output,
         return true;
     }
 
-    /* Simple linear resampling for now */
     int    numSamples    = input->dataSize / sizeof(float);
     double ratio         = (double)targetSampleRate / (double)input->format.sampleRate;
     int    outputSamples = (int)(numSamples * ratio);
 
-    /* Allocate output buffer */
-    float *outputData = (float *)malloc(outputSamples * sizeof(float));
-    if (!outputData) {
-        return false;
+    const float          *inputData = (const float *)input->data;
+    TinyAIAudioResampler *resampler =
+        tinyaiAudioResamplerCreate(input->format.sampleRate, targetSampleRate);
+    float *outputData;
+    if (resampler) {
+        /* The stream ends on the output at or after the last input's time; keep the count above */
+        int capacity = tinyaiAudioResamplerMaxOutput(resampler, numSamples) +
+                       tinyaiAudioResamplerMaxOutput(resampler, 0);
+        outputData   = (float *)malloc(capacity * sizeof(float));
+        if (!outputData) {
+            tinyaiAudioResamplerFree(resampler);
+            return false;
+        }
+        int produced = tinyaiAudioResamplerProcess(resampler, inputData, numSamples, outputData);
+        produced += tinyaiAudioResamplerFlush(resampler, outputData + produced);
+        outputSamples = produced < outputSamples ? produced : outputSamples;
+        tinyaiAudioResamplerFree(resampler);
     }
-
-    /* Resample */
-    const float *inputData = (const float *)input->data;
-    for (int i = 0; i < outputSamples; i++) {
-        double inputIndex = i / ratio;
-        int    index1     = (int)inputIndex;
-        int    index2     = index1 + 1;
-        float  t          = (float)(inputIndex - index1);
-
-        if (index2 >= numSamples) {
-            outputData[i] = inputData[numSamples - 1];
+    else {
+        /* Ratios too fine for a filter bank are interpolated linearly */
+        outputData = (float *)malloc(outputSamples * sizeof(float));
+        if (!outputData) {
+            return false;
         }
-        else {
-            outputData[i] = (1.0f - t) * inputData[index1] + t * inputData[index2];
+        for (int i = 0; i < outputSamples; i++) {
+            double inputIndex = i / ratio;
+            int    index1     = (int)inputIndex;
+            int    index2     = index1 + 1;
+            float  t          = (float)(inputIndex - index1);
+
+            if (index2 >= numSamples) {
+                outputData[i] = inputData[numSamples - 1];
+            }
+            else {
+                outputData[i] = (1.0f - t) * inputData[index1] + t * inputData[index2];
+            }
         }
     }
 
@@ -1131,17 +1572,12 @@ bool tinyaiAudioCalculateZeroCrossingRate(const TinyAIAudioData *audio, int wind
         }
 
         /* Count zero crossings */
-        int crossings = 0;
-        for (int j = startSample + 1; j < endSample; j++) {
-            if ((samples[j - 1] >= 0.0f && samples[j] < 0.0f) ||
-                (samples[j - 1] < 0.0f && samples[j] >= 0.0f)) {
-                crossings++;
-            }
-        }
+        int numSamplesInWindow = endSample - startSample;
+        int crossings          = tinyaiSimdCountZeroCrossings(samples + startSample,
+                                                              numSamplesInWindow);
 
         /* Calculate rate */
-        int numSamplesInWindow = endSample - startSample;
-        rates[i]               = (float)crossings / (float)numSamplesInWindow;
+        rates[i] = (float)crossings / (float)numSamplesInWindow;
     }
 
     return true;
@@ -42,6 +42,16 @@ typedef struct TinyAIAudioPlayback TinyAIAudioPlayback;
  */
 typedef struct TinyAIAudioRecording TinyAIAudioRecording;
 
+/**
+ * Streaming sample rate converter
+ */
+typedef struct TinyAIAudioResampler TinyAIAudioResampler;
+
+/**
+ * Streaming reader of WAV files
+ */
+typedef struct TinyAIWavReader TinyAIWavReader;
+
 /**
  * Detect audio file format from file extension
  * @param filePath Path to audio file
@@ -81,6 +91,10 @@ bool tinyaiAudioConvertFormat(const TinyAIAudioData *input, TinyAIAudioData *out
 
 /**
  * Resample audio data
+ *
+ * Runs a polyphase resampler over float mono data whenever the ratio of the
+ * rates is one tinyaiAudioResamplerCreate accepts, and falls back to linear
+ * interpolation otherwise.
  * @param input Input audio data
  * @param output Output structure to receive resampled audio
  * @param targetSampleRate Target sample rate in Hz
@@ -89,6 +103,118 @@ bool tinyaiAudioConvertFormat(const TinyAIAudioData *input, TinyAIAudioData *out
 bool tinyaiAudioResample(const TinyAIAudioData *input, TinyAIAudioData *output,
                          int targetSampleRate);
 
+/**
+ * Create a streaming polyphase resampler
+ *
+ * The rates are reduced to a ratio up/down, and every output sample is a
+ * windowed-sinc FIR over the input, with its coefficients taken from one of
+ * the up phases of a filter bank. Banks are computed once per ratio and
+ * shared by every resampler of that ratio, including those of other
+ * threads. The cutoff sits below the lower of the two Nyquist frequencies,
+ * so downsampling does not alias. Output sample n lines up with input time
+ * n * down / up, as with linear interpolation.
+ * @param inputRate Sample rate of the input in Hz
+ * @param outputRate Sample rate of the output in Hz
+ * @return Newly allocated resampler, or NULL on failure or if the reduced
+ *         ratio needs more than 1024 phases
+ */
+TinyAIAudioResampler *tinyaiAudioResamplerCreate(int inputRate, int outputRate);
+
+/**
+ * Free a resampler
+ * @param resampler The resampler to free
+ */
+void tinyaiAudioResamplerFree(TinyAIAudioResampler *resampler);
+
+/**
+ * Get the most output samples one call to tinyaiAudioResamplerProcess can produce
+ * @param resampler The resampler to query
+ * @param numInput Number of input samples of the call
+ * @return Most output samples, 0 if resampler is NULL
+ */
+int tinyaiAudioResamplerMaxOutput(const TinyAIAudioResampler *resampler, int numInput);
+
+/**
+ * Resample the next chunk of a stream
+ *
+ * Chunks may have any length. The resampler keeps the input samples the
+ * filters of later outputs still need, so a stream resampled in chunks
+ * equals the stream resampled at once, without artifacts at chunk edges.
+ * Outputs lag the input by half a filter until tinyaiAudioResamplerFlush.
+ * @param resampler The resampler to run
+ * @param input Input samples, continuing the previous chunk
+ * @param numInput Number of input samples, all of which are consumed
+ * @param output Output samples, room for tinyaiAudioResamplerMaxOutput(numInput)
+ * @return Number of output samples, negative on failure
+ */
+int tinyaiAudioResamplerProcess(TinyAIAudioResampler *resampler, const float *input,
+                                int numInput, float *output);
+
+/**
+ * Finish a stream: produce the outputs still held back, up to the time of
+ * the last input sample, and reset the resampler for a new stream
+ * @param resampler The resampler to flush
+ * @param output Output samples, room for tinyaiAudioResamplerMaxOutput(0)
+ * @return Number of output samples, negative on failure
+ */
+int tinyaiAudioResamplerFlush(TinyAIAudioResampler *resampler, float *output);
+
+/**
+ * Drop a resampler's buffered input, to start a new stream
+ * @param resampler The resampler to reset
+ */
+void tinyaiAudioResamplerReset(TinyAIAudioResampler *resampler);
+
+/**
+ * Open a WAV file for streaming
+ *
+ * The reader decodes 8, 16, 24 and 32-bit integer PCM and 32-bit float
+ * files, including WAVE_FORMAT_EXTENSIBLE ones. Raw frames are read a chunk
+ * at a time and converted to mono floats in one pass, straight into the
+ * caller's buffer, so a recording of any length is read in constant memory.
+ * @param path Path to the WAV file
+ * @return Newly opened reader, or NULL on failure or for an unsupported encoding
+ */
+TinyAIWavReader *tinyaiWavReaderOpen(const char *path);
+
+/**
+ * Close a WAV reader
+ * @param reader The reader to close
+ */
+void tinyaiWavReaderClose(TinyAIWavReader *reader);
+
+/**
+ * Get the format of a WAV file as stored, before the downmix to mono
+ * @param reader The reader to query
+ * @param format Output parameter for the format
+ * @return true on success, false on failure
+ */
+bool tinyaiWavReaderGetFormat(const TinyAIWavReader *reader, TinyAIAudioFormat *format);
+
+/**
+ * Get the number of frames of a WAV file
+ * @param reader The reader to query
+ * @return Number of frames, 0 if reader is NULL; lower once a read finds the file cut short
+ */
+int64_t tinyaiWavReaderNumFrames(const TinyAIWavReader *reader);
+
+/**
+ * Read the next frames of a WAV file as mono floats, the average of the channels
+ * @param reader The reader to read from
+ * @param output Output samples [maxFrames]
+ * @param maxFrames Most frames to read
+ * @return Number of frames read, 0 at the end of the data, negative on failure
+ */
+int tinyaiWavReaderRead(TinyAIWavReader *reader, float *output, int maxFrames);
+
+/**
+ * Move a WAV reader to a frame
+ * @param reader The reader to move
+ * @param frame Index of the next frame to read, up to the number of frames
+ * @return true on success, false on failure
+ */
+bool tinyaiWavReaderSeek(TinyAIWavReader *reader, int64_t frame);
+
 /**
  * Apply gain to audio data
  * @param audio Audio data to modify
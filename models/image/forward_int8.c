@@ -0,0 +1,480 @@
+/**
+ * @file forward_int8.c
+ * @brief Forward pass of image models with int8 tensors between layers
+ *
+ * Every tensor a layer hands to the next is stored as int8 levels q with a
+ * per-layer scale s calibrated ahead of time, so a value is q * s. The
+ * convolution, depthwise and dense kernels multiply int8 activations by the
+ * 4-bit weights with exact int32 sums, and rescale, add the biases, apply
+ * the activation and requantize to the layer's output scale in one
+ * elementwise pass per row. Pooling layers move levels around without
+ * changing them, so they keep the scale of their input; flatten, input and
+ * dropout layers are skipped. Only the model input is quantized from floats, and only the last
+ * layer (a dense one) writes floats.
+ */
+
+#include "../../utils/cancel.h"
+#include "../../utils/simd_ops.h"
+#include "../../utils/thread_pool.h"
+#include "image_model_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Signed value of the i-th 4-bit weight of a layer
+ */
+static int weightValue(const uint8_t *weights, size_t i)
+{
+    uint8_t packed = weights[i / 2];
+    return (int)(i % 2 == 0 ? (packed & 0x0F) : (packed >> 4)) - 8;
+}
+
+bool tinyaiImageModelPrepareInt8(TinyAIImageModel *model)
+{
+    if (!model || model->loader) {
+        return false;
+    }
+
+    tinyaiImageModelReleaseInt8(model);
+
+    for (int l = 0; l < model->numLayers; l++) {
+        Layer *layer = &model->layers[l];
+        size_t taps  = (size_t)layer->kernelSize * layer->kernelSize;
+
+        switch (layer->type) {
+        case LAYER_TYPE_CONV: {
+            /*
+             * Rows of [kernel row][kernel column][input channel] per output
+             * channel, so one output pixel is a matrix-vector product with
+             * its input patch
+             */
+            size_t depth = taps * layer->inputChannels;
+            size_t bytes = (depth + 1) / 2;
+            if (!layer->weights || !layer->scales) {
+                break;
+            }
+            layer->int8Weights = (uint8_t *)calloc((size_t)layer->outputChannels, bytes);
+            if (!layer->int8Weights) {
+                break;
+            }
+            for (int oc = 0; oc < layer->outputChannels; oc++) {
+                uint8_t *row = layer->int8Weights + (size_t)oc * bytes;
+                for (size_t k = 0; k < depth; k++) {
+                    uint8_t nibble = (uint8_t)(weightValue(layer->weights,
+                                                           k * layer->outputChannels + oc) +
+                                               8);
+                    row[k / 2] |= (uint8_t)(k % 2 == 0 ? nibble : nibble << 4);
+                }
+            }
+            continue;
+        }
+
+        case LAYER_TYPE_DEPTHWISE: {
+            /* One signed byte per weight, [kernel row][kernel column][output channel] */
+            size_t count = taps * layer->outputChannels;
+            if (!layer->weights || !layer->scales) {
+                break;
+            }
+            layer->int8Weights = (uint8_t *)malloc(count);
+            if (!layer->int8Weights) {
+                break;
+            }
+            for (size_t i = 0; i < count; i++) {
+                ((int8_t *)layer->int8Weights)[i] = (int8_t)weightValue(layer->weights, i);
+            }
+            continue;
+        }
+
+        case LAYER_TYPE_DENSE:
+            /* The 4-bit rows are already what the int8 matrix-vector kernel reads */
+            if (layer->weights && layer->scales) {
+                continue;
+            }
+            break;
+
+        case LAYER_TYPE_POOLING:
+        case LAYER_TYPE_FLATTEN:
+        case LAYER_TYPE_INPUT:
+        case LAYER_TYPE_DROPOUT:
+            continue;
+
+        default:
+            break;
+        }
+
+        fprintf(stderr, "Layer %d (%s) cannot run with int8 activations\n", l, layer->name);
+        tinyaiImageModelReleaseInt8(model);
+        return false;
+    }
+
+    return true;
+}
+
+void tinyaiImageModelReleaseInt8(TinyAIImageModel *model)
+{
+    if (!model) {
+        return;
+    }
+
+    for (int l = 0; l < model->numLayers; l++) {
+        free(model->layers[l].int8Weights);
+        model->layers[l].int8Weights = NULL;
+    }
+}
+
+/**
+ * Rescaled sums of a row of output pixels to their activations and int8 levels
+ *
+ * Adds the biases, applies the activation and requantizes to the layer's
+ * output scale in one pass; without an int8 destination the floats are the
+ * result.
+ */
+static bool int8Epilogue(const Layer *layer, float *values, int rows, int8_t *levels)
+{
+    TinyAIElementwiseOp ops[3];
+    int                 numOps = tinyaiImageLayerEpilogue(layer, ops);
+    if (numOps < 0) {
+        return false;
+    }
+    if (levels) {
+        TinyAIElementwiseOp quantize = {TINYAI_SIMD_EW_QUANTIZE, 0, NULL, levels,
+                                        layer->outputScale, 1.0f / layer->outputScale};
+        ops[numOps++]                = quantize;
+    }
+
+    int cols = layer->type == LAYER_TYPE_DENSE ? layer->outputWidth : layer->outputChannels;
+    return tinyaiSimdElementwise(values, values, rows, cols, ops, numOps) == 0;
+}
+
+/**
+ * A band of output rows of an int8 convolution or depthwise layer, run as a thread pool task
+ */
+typedef struct {
+    const Layer  *layer;
+    const int8_t *input;
+    int8_t       *output;
+    float         inputScale;
+    bool          failed;
+} Int8ConvTask;
+
+/**
+ * Gather the zero-padded input patch of one output pixel, [kernel row][kernel column][channel]
+ */
+static void gatherPatch(const Layer *layer, const int8_t *input, int oy, int ox, int8_t *patch)
+{
+    int    channels = layer->inputChannels;
+    int    y0       = oy * layer->stride - layer->padding;
+    int    x0       = ox * layer->stride - layer->padding;
+    size_t span     = (size_t)layer->kernelSize * channels;
+
+    for (int ky = 0; ky < layer->kernelSize; ky++, patch += span) {
+        int y = y0 + ky;
+        if (y < 0 || y >= layer->inputHeight) {
+            memset(patch, 0, span);
+            continue;
+        }
+
+        /* Columns inside the input are one contiguous run */
+        int first = x0 < 0 ? -x0 : 0;
+        int last  = layer->inputWidth - x0;
+        if (first > layer->kernelSize) {
+            first = layer->kernelSize;
+        }
+        if (last > layer->kernelSize) {
+            last = layer->kernelSize;
+        }
+        memset(patch, 0, (size_t)first * channels);
+        if (last > first) {
+            memcpy(patch + (size_t)first * channels,
+                   input + ((size_t)y * layer->inputWidth + x0 + first) * channels,
+                   (size_t)(last - first) * channels);
+        }
+        else {
+            last = first;
+        }
+        memset(patch + (size_t)last * channels, 0, (size_t)(layer->kernelSize - last) * channels);
+    }
+}
+
+static void int8ConvRows(void *context, size_t begin, size_t end)
+{
+    Int8ConvTask *task   = (Int8ConvTask *)context;
+    const Layer  *layer  = task->layer;
+    int           depth  = layer->kernelSize * layer->kernelSize * layer->inputChannels;
+    size_t        rowLen = (size_t)layer->outputWidth * layer->outputChannels;
+
+    int8_t *patch = (int8_t *)malloc((size_t)depth);
+    float  *row   = (float *)malloc(rowLen * sizeof(float));
+    if (!patch || !row) {
+        task->failed = true;
+        goto cleanup;
+    }
+
+    for (size_t oy = begin; oy < end; oy++) {
+        for (int ox = 0; ox < layer->outputWidth; ox++) {
+            gatherPatch(layer, task->input, (int)oy, ox, patch);
+            tinyaiSimdMatMul4BitInt8(row + (size_t)ox * layer->outputChannels, layer->int8Weights,
+                                     patch, task->inputScale, layer->outputChannels, depth,
+                                     layer->scales);
+        }
+        if (!int8Epilogue(layer, row, layer->outputWidth, task->output + oy * rowLen)) {
+            task->failed = true;
+            break;
+        }
+    }
+
+cleanup:
+    free(patch);
+    free(row);
+}
+
+static void int8DepthwiseRows(void *context, size_t begin, size_t end)
+{
+    Int8ConvTask *task       = (Int8ConvTask *)context;
+    const Layer  *layer      = task->layer;
+    const int8_t *weights    = (const int8_t *)layer->int8Weights;
+    int           channels   = layer->outputChannels;
+    int           multiplier = channels / layer->inputChannels;
+    size_t        rowLen     = (size_t)layer->outputWidth * channels;
+
+    int32_t *sums = (int32_t *)malloc((size_t)channels * sizeof(int32_t));
+    float   *row  = (float *)malloc(rowLen * sizeof(float));
+    if (!sums || !row) {
+        task->failed = true;
+        goto cleanup;
+    }
+
+    for (size_t oy = begin; oy < end; oy++) {
+        for (int ox = 0; ox < layer->outputWidth; ox++) {
+            memset(sums, 0, (size_t)channels * sizeof(int32_t));
+            for (int ky = 0; ky < layer->kernelSize; ky++) {
+                int y = (int)oy * layer->stride - layer->padding + ky;
+                if (y < 0 || y >= layer->inputHeight) {
+                    continue;
+                }
+                for (int kx = 0; kx < layer->kernelSize; kx++) {
+                    int x = ox * layer->stride - layer->padding + kx;
+                    if (x < 0 || x >= layer->inputWidth) {
+                        continue;
+                    }
+                    const int8_t *in =
+                        task->input + ((size_t)y * layer->inputWidth + x) * layer->inputChannels;
+                    const int8_t *w = weights + (size_t)(ky * layer->kernelSize + kx) * channels;
+                    for (int oc = 0; oc < channels; oc++) {
+                        sums[oc] += (int32_t)w[oc] * in[oc / multiplier];
+                    }
+                }
+            }
+
+            float *out = row + (size_t)ox * channels;
+            for (int oc = 0; oc < channels; oc++) {
+                out[oc] = (float)sums[oc] * task->inputScale * layer->scales[oc];
+            }
+        }
+        if (!int8Epilogue(layer, row, layer->outputWidth, task->output + oy * rowLen)) {
+            task->failed = true;
+            break;
+        }
+    }
+
+cleanup:
+    free(sums);
+    free(row);
+}
+
+/**
+ * Int8 convolution or depthwise layer, in bands of output rows across the pool
+ */
+static bool int8Conv(const Layer *layer, const int8_t *input, int8_t *output, float inputScale)
+{
+    /* Multiply-adds of one output row */
+    size_t work = (size_t)layer->outputWidth * layer->outputChannels * layer->kernelSize *
+                  layer->kernelSize;
+    if (layer->type == LAYER_TYPE_CONV) {
+        work *= layer->inputChannels;
+    }
+
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    Int8ConvTask      task = {layer, input, output, inputScale, false};
+    tinyaiParallelFor(pool, (size_t)layer->outputHeight, tinyaiThreadPoolGrain(pool, work, 1),
+                      layer->type == LAYER_TYPE_CONV ? int8ConvRows : int8DepthwiseRows, &task);
+    return !task.failed;
+}
+
+/**
+ * A range of an int8 dense layer's output rows, run as a thread pool task
+ */
+typedef struct {
+    const Layer  *layer;
+    const int8_t *input;
+    float         inputScale;
+    float        *output;
+} Int8DenseTask;
+
+static void int8DenseRows(void *context, size_t begin, size_t end)
+{
+    Int8DenseTask *task  = (Int8DenseTask *)context;
+    const Layer   *layer = task->layer;
+    int            cols  = layer->inputWidth;
+
+    tinyaiSimdMatMul4BitInt8(task->output + begin,
+                             layer->weights + begin * (size_t)((cols + 1) / 2), task->input,
+                             task->inputScale, (int)(end - begin), cols, layer->scales + begin);
+}
+
+/**
+ * Int8 dense layer, into int8 levels or (for the last layer) floats
+ */
+static bool int8Dense(const Layer *layer, const int8_t *input, int8_t *output, float inputScale,
+                      float *values)
+{
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    Int8DenseTask     task = {layer, input, inputScale, values};
+    tinyaiParallelFor(pool, (size_t)layer->outputWidth,
+                      tinyaiThreadPoolGrain(pool, layer->inputWidth, 1), int8DenseRows, &task);
+    return int8Epilogue(layer, values, 1, output);
+}
+
+/**
+ * Int8 max pooling; the maximum of levels is the level of the maximum
+ */
+static void int8MaxPool(const Layer *layer, const int8_t *input, int8_t *output)
+{
+    int channels = layer->outputChannels;
+
+    for (int oy = 0; oy < layer->outputHeight; oy++) {
+        for (int ox = 0; ox < layer->outputWidth; ox++) {
+            int8_t *out = output + ((size_t)oy * layer->outputWidth + ox) * channels;
+            memset(out, -127, (size_t)channels);
+            for (int ky = 0; ky < layer->kernelSize; ky++) {
+                int y = oy * layer->stride - layer->padding + ky;
+                if (y < 0 || y >= layer->inputHeight) {
+                    continue;
+                }
+                for (int kx = 0; kx < layer->kernelSize; kx++) {
+                    int x = ox * layer->stride - layer->padding + kx;
+                    if (x < 0 || x >= layer->inputWidth) {
+                        continue;
+                    }
+                    const int8_t *in = input + ((size_t)y * layer->inputWidth + x) * channels;
+                    for (int c = 0; c < channels; c++) {
+                        out[c] = in[c] > out[c] ? in[c] : out[c];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Perform a forward pass for a batch with int8 tensors between layers
+ *
+ * The ping-pong buffers of the workspace hold int8 levels, a byte per value,
+ * and its scratch the model input rows being quantized and the float output
+ * of dense layers.
+ *
+ * @param model The image model to use
+ * @param inputs Input tensors, one after another
+ * @param batch Number of images
+ * @param outputs Output tensors, one after another
+ * @param workspace Workspace laid out for the batch
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardInt8(const TinyAIImageModel *model, const float *inputs, int batch,
+                                 float *outputs, float *workspace)
+{
+    size_t  stride  = model->activationFloats * sizeof(float);
+    int8_t *buffer1 = (int8_t *)workspace;
+    int8_t *buffer2 = (int8_t *)(workspace + batch * model->activationFloats);
+    float  *scratch = workspace + 2 * batch * model->activationFloats;
+
+    /* Quantize each input a row at a time, through the scratch */
+    int                 rowLen    = model->inputWidth * model->inputChannels;
+    size_t              inputSize = (size_t)rowLen * model->inputHeight;
+    TinyAIElementwiseOp quantize  = {TINYAI_SIMD_EW_QUANTIZE, 0, NULL, NULL,
+                                     model->inputScale, 1.0f / model->inputScale};
+    for (int n = 0; n < batch; n++) {
+        for (int y = 0; y < model->inputHeight; y++) {
+            quantize.quantized = buffer1 + n * stride + (size_t)y * rowLen;
+            tinyaiSimdElementwise(scratch, inputs + n * inputSize + (size_t)y * rowLen, 1, rowLen,
+                                  &quantize, 1);
+        }
+    }
+
+    int8_t *currentInput  = buffer1;
+    int8_t *currentOutput = buffer2;
+    float   scale         = model->inputScale;
+
+    for (int l = 0; l < model->numLayers; l++) {
+        const Layer *layer = &model->layers[l];
+        bool         last  = l == model->numLayers - 1;
+
+        /* Abandoned work stops at the next layer boundary */
+        if (tinyaiCancelled()) {
+            return false;
+        }
+
+        /* Flatten keeps the height-width-channel order; input and dropout pass levels through */
+        if (layer->type == LAYER_TYPE_FLATTEN || layer->type == LAYER_TYPE_INPUT ||
+            layer->type == LAYER_TYPE_DROPOUT) {
+            continue;
+        }
+
+        bool success = true;
+        for (int n = 0; n < batch && success; n++) {
+            const int8_t *input  = currentInput + n * stride;
+            int8_t       *output = currentOutput + n * stride;
+
+            switch (layer->type) {
+            case LAYER_TYPE_CONV:
+            case LAYER_TYPE_DEPTHWISE:
+                success = int8Conv(layer, input, output, scale);
+                break;
+
+            case LAYER_TYPE_DENSE:
+                /* The last layer's floats are the model output */
+                success = last ? int8Dense(layer, input, NULL, scale,
+                                           outputs + (size_t)n * layer->outputWidth)
+                               : int8Dense(layer, input, output, scale, scratch);
+                break;
+
+            default:
+                int8MaxPool(layer, input, output);
+                break;
+            }
+        }
+
+        if (!success) {
+            fprintf(stderr, "Int8 forward pass failed at layer %d (%s)\n", l, layer->name);
+            return false;
+        }
+
+        if (last && layer->type == LAYER_TYPE_DENSE) {
+            return !tinyaiCancelled();
+        }
+
+        if (layer->type != LAYER_TYPE_POOLING) {
+            scale = layer->outputScale;
+        }
+
+        int8_t *temp  = currentInput;
+        currentInput  = currentOutput;
+        currentOutput = temp;
+    }
+
+    /* Loops of the last layer skip their remaining ranges once cancelled */
+    if (tinyaiCancelled()) {
+        return false;
+    }
+
+    /* A model that does not end on a dense layer hands back the values of its levels */
+    const Layer *lastLayer = &model->layers[model->numLayers - 1];
+    for (int n = 0; n < batch; n++) {
+        for (int i = 0; i < lastLayer->outputWidth; i++) {
+            outputs[(size_t)n * lastLayer->outputWidth + i] = currentInput[n * stride + i] * scale;
+        }
+    }
+
+    return true;
+}
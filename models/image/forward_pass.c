@@ -4,7 +4,10 @@
  */
 
 #include "../../utils/cache_opt.h"
+#include "../../utils/cancel.h"
+#include "../../utils/quantize.h"
 #include "../../utils/simd_ops.h"
+#include "../../utils/thread_pool.h"
 #include "image_model_internal.h"
 #include <float.h>
 #include <math.h>
@@ -13,12 +16,240 @@
 #include <string.h>
 
 /* Forward pass functions declarations */
-static bool forwardConv(const Layer *layer, const float *input, float *output, bool useSIMD);
-static bool forwardDepthwise(const Layer *layer, const float *input, float *output, bool useSIMD);
+static bool forwardConv(const Layer *layer, const float *input, float *output, bool useSIMD,
+                        float *scratch);
+static bool forwardDepthwise(const Layer *layer, const float *input, float *output, bool useSIMD,
+                             float *scratch);
 static bool forwardPooling(const Layer *layer, const float *input, float *output, int poolType);
-static bool forwardDense(const Layer *layer, const float *input, float *output, bool useSIMD);
-static bool forwardFlatten(const Layer *layer, const float *input, float *output);
+static bool forwardDense(const Layer *layer, const float *input, float *output, bool useSIMD,
+                         int8_t *scratch);
 static bool forwardActivation(int activationType, float *data, int size, bool useSIMD);
+static bool forwardDenseBatch(const Layer *layer, float *input, float *output, int batch,
+                              size_t stride);
+static bool forwardBlocked(const Layer *layer, const Layer *pooling, const float *input,
+                           float *output);
+static bool simdActivationType(int activationType, int *simdType);
+
+/**
+ * Whether a layer runs on the channel-blocked layout
+ */
+static bool layerRunsBlocked(const TinyAIImageModel *model, const Layer *layer)
+{
+    return model->useSIMD && layer->blockedWeights &&
+           (layer->type == LAYER_TYPE_CONV || layer->type == LAYER_TYPE_DEPTHWISE);
+}
+
+/**
+ * Whether a dense layer adds its biases and applies its activation in one fused pass
+ */
+static bool denseRunsFused(const TinyAIImageModel *model, const Layer *layer)
+{
+    return model->useSIMD && layer->weights && layer->type == LAYER_TYPE_DENSE;
+}
+
+/**
+ * Largest activation of the model in floats, in either layout
+ */
+static size_t forwardBufferFloats(const TinyAIImageModel *model)
+{
+    size_t floats = (size_t)model->inputWidth * model->inputHeight * model->inputChannels;
+
+    for (int l = 0; l < model->numLayers; l++) {
+        const Layer *layer = &model->layers[l];
+        size_t sizes[4]    = {
+            (size_t)layer->inputWidth * layer->inputHeight * layer->inputChannels,
+            (size_t)layer->outputWidth * layer->outputHeight * layer->outputChannels,
+            tinyaiSimdBlockedSize(layer->inputWidth, layer->inputHeight, layer->inputChannels),
+            tinyaiSimdBlockedSize(layer->outputWidth, layer->outputHeight, layer->outputChannels)};
+        for (int i = 0; i < 4; i++) {
+            if (sizes[i] > floats) {
+                floats = sizes[i];
+            }
+        }
+    }
+
+    return floats;
+}
+
+/**
+ * Rows and columns of a layer's input once its padding is written out as zeros
+ *
+ * Enough rows and columns that every output position reads inside the
+ * padded input, so bands of output rows can run without padding.
+ */
+static void paddedInputSize(const Layer *layer, int *width, int *height)
+{
+    int span = layer->kernelSize - layer->stride;
+
+    *width  = layer->inputWidth + 2 * layer->padding;
+    *height = layer->inputHeight + 2 * layer->padding;
+    if ((layer->outputWidth * layer->stride + span) > *width) {
+        *width = layer->outputWidth * layer->stride + span;
+    }
+    if ((layer->outputHeight * layer->stride + span) > *height) {
+        *height = layer->outputHeight * layer->stride + span;
+    }
+}
+
+/**
+ * Scratch a forward pass needs in floats
+ *
+ * The scratch holds the int8 copy of a dense layer's input, or the
+ * zero-padded copy of a padded convolution's input for threaded passes, or
+ * the pooled channels and class scores of an early-exit head.
+ */
+static size_t forwardScratchFloats(const TinyAIImageModel *model)
+{
+    size_t floats = 0;
+
+    for (int l = 0; l < model->numLayers; l++) {
+        const Layer *layer = &model->layers[l];
+        size_t       need  = 0;
+        if (layer->type == LAYER_TYPE_DENSE) {
+            need = ((size_t)layer->inputWidth + sizeof(float) - 1) / sizeof(float);
+        }
+        else if ((layer->type == LAYER_TYPE_CONV || layer->type == LAYER_TYPE_DEPTHWISE) &&
+                 layer->padding > 0) {
+            int width, height;
+            paddedInputSize(layer, &width, &height);
+            need = (size_t)width * height * layer->inputChannels;
+        }
+        if (model->exits && model->exits->heads[l].weights &&
+            (size_t)layer->outputChannels + model->numClasses > need) {
+            need = (size_t)layer->outputChannels + model->numClasses;
+        }
+        if (need > floats) {
+            floats = need;
+        }
+    }
+
+    return floats;
+}
+
+/**
+ * Scratch an int8 forward pass needs in floats
+ *
+ * The scratch holds a dense layer's float output before it is quantized, or
+ * a row of the model input while it is quantized.
+ */
+static size_t int8ScratchFloats(const TinyAIImageModel *model)
+{
+    size_t floats = (size_t)model->inputWidth * model->inputChannels;
+
+    for (int l = 0; l < model->numLayers; l++) {
+        const Layer *layer = &model->layers[l];
+        if (layer->type == LAYER_TYPE_DENSE && (size_t)layer->outputWidth > floats) {
+            floats = layer->outputWidth;
+        }
+    }
+
+    return floats;
+}
+
+/**
+ * Floats of workspace a batch takes: two ping-pong buffers, then the layer scratch
+ */
+static size_t workspaceFloats(size_t activation, size_t scratch, int batch)
+{
+    return 2 * (size_t)batch * activation + scratch;
+}
+
+/**
+ * Size the forward pass workspace for the current layer shapes
+ *
+ * The workspace holds two ping-pong buffers with a slot per image of a batch,
+ * each slot as large as the largest activation and rounded to a cache line so
+ * every slot stays aligned, then the scratch of the layer needing the most. It
+ * only grows, so shapes that shrink (pruned filters) and smaller batches keep
+ * the existing allocation. With int8 activations a slot holds a byte per
+ * value, so it takes a quarter of the floats.
+ *
+ * @param model The image model
+ * @param batch Images the workspace must hold at once
+ * @return true on success, false if the workspace could not be allocated
+ */
+bool tinyaiImageModelPrepareWorkspace(TinyAIImageModel *model, int batch)
+{
+    if (!model || batch < 1) {
+        return false;
+    }
+
+    size_t activation = forwardBufferFloats(model);
+    size_t scratch    = forwardScratchFloats(model);
+    if (model->int8Activations) {
+        activation = (activation + sizeof(float) - 1) / sizeof(float);
+        scratch    = int8ScratchFloats(model);
+    }
+    activation = (activation + 15) & ~(size_t)15;
+    if (batch < model->workspaceBatch) {
+        batch = model->workspaceBatch;
+    }
+    size_t floats = workspaceFloats(activation, scratch, batch);
+
+    if (!model->workspace || model->workspaceFloats < floats) {
+        float *workspace = (float *)malloc(floats * sizeof(float));
+        if (!workspace) {
+            fprintf(stderr, "Failed to allocate forward pass workspace\n");
+            return false;
+        }
+        free(model->workspace);
+        model->workspace       = workspace;
+        model->workspaceFloats = floats;
+    }
+
+    model->activationFloats = activation;
+    model->scratchFloats    = scratch;
+    model->workspaceBatch   = batch;
+    return true;
+}
+
+/**
+ * Release anything a forward pass took from the arena
+ */
+static void releaseForwardBuffers(const TinyAIImageModel *model, TinyAIArenaMark mark)
+{
+    if (model->arena) {
+        tinyaiArenaEndScope(model->arena, mark);
+    }
+}
+
+/**
+ * Whether a dense layer runs over a whole batch as one matrix-matrix product
+ *
+ * The int8 activation path has no batched kernel and stays per image.
+ */
+static bool denseRunsBatched(const TinyAIImageModel *model, const Layer *layer, int batch)
+{
+    return batch > 1 && denseRunsFused(model, layer) &&
+           tinyaiGetActivationPrecision() != TINYAI_PRECISION_INT8;
+}
+
+/**
+ * Run one layer on one image
+ */
+static bool forwardLayer(const TinyAIImageModel *model, const Layer *layer, const Layer *pooling,
+                         bool fused, const float *input, float *output, float *scratch)
+{
+    switch (layer->type) {
+    case LAYER_TYPE_CONV:
+        return fused ? forwardBlocked(layer, pooling, input, output)
+                     : forwardConv(layer, input, output, model->useSIMD, scratch);
+
+    case LAYER_TYPE_DEPTHWISE:
+        return fused ? forwardBlocked(layer, pooling, input, output)
+                     : forwardDepthwise(layer, input, output, model->useSIMD, scratch);
+
+    case LAYER_TYPE_POOLING:
+        return forwardPooling(layer, input, output, 0); /* 0 = max pooling */
+
+    case LAYER_TYPE_DENSE:
+        return forwardDense(layer, input, output, model->useSIMD, (int8_t *)scratch);
+
+    default:
+        fprintf(stderr, "Unknown layer type: %d\n", layer->type);
+        return false;
+    }
+}
 
 /**
  * Perform forward pass through all layers of the model
@@ -30,122 +261,673 @@ static bool forwardActivation(int activationType, float *data, int size, bool us
  */
 bool tinyaiImageModelForwardPass(const TinyAIImageModel *model, const float *input, float *output)
 {
-    if (!model || !input || !output) {
-        fprintf(stderr, "Invalid parameters for forward pass\n");
-        return false;
-    }
+    return tinyaiImageModelForwardBatch(model, input, 1, output);
+}
 
-    /* Allocate two buffers for ping-pong computation */
-    float *buffer1 = (float *)malloc(model->inputWidth * model->inputHeight * model->inputChannels *
-                                     sizeof(float));
-    float *buffer2 = (float *)malloc(model->inputWidth * model->inputHeight * model->inputChannels *
-                                     sizeof(float));
+/**
+ * Run a layer's early-exit head on one image's output
+ *
+ * The channels pooled from the output, in whichever layout it is in, go to
+ * the start of scratch and the class scores right after them.
+ *
+ * @return Softmax confidence of the top class, which is written to best
+ */
+static float runExitHead(const TinyAIImageModel *model, const Layer *layer,
+                         const TinyAIImageExitHead *head, const float *activation, bool blocked,
+                         float *scratch, int *best)
+{
+    int    channels = layer->outputChannels;
+    size_t plane    = (size_t)layer->outputWidth * layer->outputHeight;
+    float *pooled   = scratch;
+    float *scores   = scratch + channels;
+
+    memset(pooled, 0, channels * sizeof(float));
+    if (blocked) {
+        for (int c = 0; c < channels; c++) {
+            const float *block = activation + (size_t)(c / TINYAI_SIMD_CHANNEL_BLOCK) * plane *
+                                                  TINYAI_SIMD_CHANNEL_BLOCK +
+                                 c % TINYAI_SIMD_CHANNEL_BLOCK;
+            for (size_t p = 0; p < plane; p++) {
+                pooled[c] += block[p * TINYAI_SIMD_CHANNEL_BLOCK];
+            }
+        }
+    }
+    else {
+        for (size_t p = 0; p < plane; p++) {
+            for (int c = 0; c < channels; c++) {
+                pooled[c] += activation[p * channels + c];
+            }
+        }
+    }
+    for (int c = 0; c < channels; c++) {
+        pooled[c] /= (float)plane;
+    }
 
-    if (!buffer1 || !buffer2) {
-        fprintf(stderr, "Failed to allocate forward pass buffers\n");
-        if (buffer1)
-            free(buffer1);
-        if (buffer2)
-            free(buffer2);
-        return false;
+    for (int k = 0; k < model->numClasses; k++) {
+        scores[k] = tinyaiSimdDot(head->weights + (size_t)k * channels, pooled, channels) +
+                    head->biases[k];
     }
+    *best = tinyaiSimdArgmax(scores, model->numClasses);
+    return expf(scores[*best] - tinyaiSimdLogSumExp(scores, model->numClasses));
+}
 
-    /* Copy input to first buffer */
-    memcpy(buffer1, input,
-           model->inputWidth * model->inputHeight * model->inputChannels * sizeof(float));
+/**
+ * Run a batch through every layer in floats, in a workspace laid out for the batch
+ *
+ * With ranges set, the largest magnitude each layer outputs is folded into
+ * ranges[layer]; a pooling layer fused into the layer before gets the same.
+ * With confidence set, a batch of one runs every layer and records each
+ * early-exit head's confidence and top class instead of stopping at it.
+ */
+static bool runBatch(const TinyAIImageModel *model, const float *inputs, int batch,
+                     float *outputs, float *workspace, float *ranges, float *confidence,
+                     int *classes)
+{
+    size_t stride  = model->activationFloats;
+    float *buffer1 = workspace;
+    float *buffer2 = workspace + batch * stride;
+    float *scratch = workspace + 2 * batch * stride;
+
+    /* Copy each input to its slot of the first buffer */
+    size_t inputSize = (size_t)model->inputWidth * model->inputHeight * model->inputChannels;
+    for (int n = 0; n < batch; n++) {
+        memcpy(buffer1 + n * stride, inputs + n * inputSize, inputSize * sizeof(float));
+    }
 
     /* Ping-pong buffers through the network */
     float *currentInput  = buffer1;
     float *currentOutput = buffer2;
 
+    /*
+     * Images that stop at an early exit leave the batch, and the last image
+     * still running moves into their slot; order maps slots back to images.
+     * Exits write the head's class scores as the image's results.
+     */
+    const Layer *last  = &model->layers[model->numLayers - 1];
+    bool         exits = model->exits && !ranges && batch <= TINYAI_IMAGE_MAX_BATCH &&
+                 last->outputWidth == model->numClasses;
+    int order[TINYAI_IMAGE_MAX_BATCH];
+    for (int n = 0; exits && n < batch; n++) {
+        order[n] = n;
+    }
+
+    /*
+     * Runs of layers with channel-blocked kernels keep their activations in
+     * that layout; it is converted only where such a run starts and ends,
+     * which for the MobileNet trunk is the model input and the pooling layer.
+     */
+    bool blocked = false;
+
     /* Process each layer */
     for (int l = 0; l < model->numLayers; l++) {
         const Layer *layer = &model->layers[l];
 
-        bool success = false;
+        /* Abandoned work stops at the next layer boundary */
+        if (tinyaiCancelled()) {
+            return false;
+        }
 
-        /* Process based on layer type */
-        switch (layer->type) {
-        case LAYER_TYPE_CONV:
-            success = forwardConv(layer, currentInput, currentOutput, model->useSIMD);
-            break;
+        /* A streamed layer runs on a copy pointing at its loaded weights */
+        Layer streamed;
+        bool  requested = model->loader && layer->weightBytes > 0;
+        if (requested) {
+            if (!tinyaiRequestLayer(model->loader, l)) {
+                fprintf(stderr, "Failed to load weights of layer %d (%s)\n", l, layer->name);
+                return false;
+            }
+            streamed         = *layer;
+            streamed.weights = (uint8_t *)tinyaiGetLoadedLayerWeights(model->loader, l);
+            layer            = &streamed;
+        }
 
-        case LAYER_TYPE_DEPTHWISE:
-            success = forwardDepthwise(layer, currentInput, currentOutput, model->useSIMD);
-            break;
+        /* Input and dropout layers pass data through in whatever layout it is in */
+        if (layer->type != LAYER_TYPE_INPUT && layer->type != LAYER_TYPE_DROPOUT &&
+            layerRunsBlocked(model, layer) != blocked) {
+            for (int n = 0; n < batch; n++) {
+                if (blocked) {
+                    tinyaiSimdFromChannelBlocked(currentOutput + n * stride,
+                                                 currentInput + n * stride, layer->inputWidth,
+                                                 layer->inputHeight, layer->inputChannels);
+                }
+                else {
+                    tinyaiSimdToChannelBlocked(currentOutput + n * stride,
+                                               currentInput + n * stride, layer->inputWidth,
+                                               layer->inputHeight, layer->inputChannels);
+                }
+            }
+            blocked       = !blocked;
+            float *temp   = currentInput;
+            currentInput  = currentOutput;
+            currentOutput = temp;
+        }
+
+        /*
+         * Input and dropout layers change nothing at inference, and flatten
+         * only renames the height-width-channel layout it now has, so the
+         * next layer reads their input where it is
+         */
+        if (layer->type == LAYER_TYPE_INPUT || layer->type == LAYER_TYPE_DROPOUT ||
+            layer->type == LAYER_TYPE_FLATTEN) {
+            continue;
+        }
+
+        size_t outputSize =
+            blocked ? tinyaiSimdBlockedSize(layer->outputWidth, layer->outputHeight,
+                                            layer->outputChannels)
+                    : (size_t)layer->outputWidth * layer->outputHeight * layer->outputChannels;
+
+        /* A blocked layer applies its own activation, and absorbs a pooling layer fused into it */
+        bool         fused   = blocked && layerRunsBlocked(model, layer);
+        const Layer *pooling = fused && layer->fusePooling ? &model->layers[l + 1] : NULL;
+
+        bool success = true;
+        if (denseRunsBatched(model, layer, batch)) {
+            success = forwardDenseBatch(layer, currentInput, currentOutput, batch, stride);
+        }
+        else {
+            for (int n = 0; n < batch && success; n++) {
+                success = forwardLayer(model, layer, pooling, fused, currentInput + n * stride,
+                                       currentOutput + n * stride, scratch);
+            }
+        }
+
+        if (requested) {
+            tinyaiReleaseLayer(model->loader, l);
+        }
+
+        if (!success) {
+            fprintf(stderr, "Forward pass failed at layer %d (%s)\n", l, layer->name);
+            return false;
+        }
+
+        if (pooling) {
+            l++;
+        }
+
+        /* Apply activation function if needed */
+        if (!fused && !denseRunsFused(model, layer) && layer->activation != ACTIVATION_NONE) {
+            for (int n = 0; n < batch; n++) {
+                if (!forwardActivation(layer->activation, currentOutput + n * stride,
+                                       (int)outputSize, model->useSIMD)) {
+                    fprintf(stderr, "Activation failed at layer %d (%s)\n", l, layer->name);
+                    return false;
+                }
+            }
+        }
+
+        if (ranges) {
+            for (int n = 0; n < batch; n++) {
+                float min = FLT_MAX, max = -FLT_MAX;
+                tinyaiSimdMinMax(currentOutput + n * stride, (int)outputSize, &min, &max);
+                float range = max > -min ? max : -min;
+                for (int i = pooling ? l - 1 : l; i <= l; i++) {
+                    ranges[i] = range > ranges[i] ? range : ranges[i];
+                }
+            }
+        }
+
+        /* A head made for another width (pruned filters) is skipped */
+        const Layer               *exitLayer = &model->layers[l];
+        const TinyAIImageExitHead *head      = exits ? &model->exits->heads[l] : NULL;
+        if (head && head->weights && head->channels == exitLayer->outputChannels) {
+            for (int n = 0; n < batch;) {
+                int   best;
+                float score = runExitHead(model, exitLayer, head, currentOutput + n * stride,
+                                          blocked, scratch, &best);
+                if (confidence) {
+                    confidence[l] = score;
+                    classes[l]    = best;
+                }
+                if (confidence || score < head->threshold) {
+                    n++;
+                    continue;
+                }
+
+                memcpy(outputs + (size_t)order[n] * model->numClasses,
+                       scratch + exitLayer->outputChannels, model->numClasses * sizeof(float));
+                model->exits->counts[l]++;
+                if (n < --batch) {
+                    memcpy(currentOutput + n * stride, currentOutput + batch * stride,
+                           outputSize * sizeof(float));
+                    order[n] = order[batch];
+                }
+            }
+            if (batch == 0) {
+                return true;
+            }
+        }
+
+        /* Swap buffers */
+        float *temp   = currentInput;
+        currentInput  = currentOutput;
+        currentOutput = temp;
+    }
+
+    /* Loops of the last layer skip their remaining ranges once cancelled */
+    if (tinyaiCancelled()) {
+        return false;
+    }
+
+    /* A model that ends on a blocked layer hands back its usual layout */
+    if (blocked) {
+        for (int n = 0; n < batch; n++) {
+            tinyaiSimdFromChannelBlocked(currentOutput + n * stride, currentInput + n * stride,
+                                         last->outputWidth, last->outputHeight,
+                                         last->outputChannels);
+        }
+        currentInput = currentOutput;
+    }
+
+    /* Copy final results to the outputs */
+    for (int n = 0; n < batch; n++) {
+        memcpy(outputs + (size_t)(exits ? order[n] : n) * last->outputWidth,
+               currentInput + n * stride, last->outputWidth * sizeof(float));
+    }
+
+    return true;
+}
+
+/**
+ * Take a batch's workspace and run the batch on the model's pool
+ */
+static bool forwardBatch(const TinyAIImageModel *model, const float *inputs, int batch,
+                         float *outputs, float *ranges, float *confidence, int *classes)
+{
+    if (!model || !inputs || !outputs || batch < 1) {
+        fprintf(stderr, "Invalid parameters for forward pass\n");
+        return false;
+    }
+    if (!model->arena && batch > model->workspaceBatch) {
+        fprintf(stderr, "Forward pass workspace holds %d images, not %d\n", model->workspaceBatch,
+                batch);
+        return false;
+    }
+
+    /*
+     * The ping-pong buffers and layer scratch live in the workspace sized
+     * ahead of time, so a pass allocates nothing. With an arena set, the same
+     * layout is taken from the arena instead and given back at the end.
+     */
+    TinyAIArenaMark mark      = tinyaiArenaBeginScope(model->arena);
+    float          *workspace = model->workspace;
+    if (model->arena) {
+        size_t floats = workspaceFloats(model->activationFloats, model->scratchFloats, batch);
+        workspace     = (float *)tinyaiArenaAlloc(model->arena, floats * sizeof(float));
+    }
+
+    bool success = workspace != NULL;
+    if (!success) {
+        fprintf(stderr, "Failed to allocate forward pass buffers\n");
+    }
+    else {
+        bool                  scoped = model->serial || model->threadPool;
+        TinyAIThreadPoolScope scope  = {NULL, false};
+        if (scoped) {
+            scope = tinyaiUseThreadPool(model->serial ? NULL : model->threadPool);
+        }
+
+        success = model->int8Activations && !ranges && !confidence
+                      ? tinyaiImageModelForwardInt8(model, inputs, batch, outputs, workspace)
+                      : runBatch(model, inputs, batch, outputs, workspace, ranges, confidence,
+                                 classes);
+
+        if (scoped) {
+            tinyaiRestoreThreadPool(scope);
+        }
+    }
+
+    releaseForwardBuffers(model, mark);
+    return success;
+}
+
+/**
+ * Perform forward pass through all layers of the model for a batch of images
+ *
+ * Each layer runs over every image before the next layer starts, so its
+ * weights are streamed in (or pulled through the cache) once per batch, and
+ * dense layers multiply the whole batch at once. The kernels run on the
+ * pool chosen with tinyaiImageModelSetThreading, and pass int8 tensors
+ * between layers once tinyaiImageModelEnableInt8Activations is on.
+ *
+ * @param model The image model to use
+ * @param inputs Input tensors, one after another
+ * @param batch Number of images
+ * @param outputs Output tensors, one after another
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardBatch(const TinyAIImageModel *model, const float *inputs, int batch,
+                                  float *outputs)
+{
+    return forwardBatch(model, inputs, batch, outputs, NULL, NULL, NULL);
+}
+
+/**
+ * Run one image through the model in floats, recording each layer's activation range
+ *
+ * Used to calibrate int8 activations, so it takes the float path even when
+ * int8 activations are enabled.
+ *
+ * @param model The image model to use
+ * @param input Input tensor
+ * @param output Output tensor
+ * @param ranges Largest magnitude output by each layer [numLayers], folded in with max
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardRanges(const TinyAIImageModel *model, const float *input,
+                                   float *output, float *ranges)
+{
+    return ranges && forwardBatch(model, input, 1, output, ranges, NULL, NULL);
+}
+
+/**
+ * Run one image through every layer in floats, probing each early-exit head
+ *
+ * Used to calibrate the heads' thresholds, so no head stops the image.
+ *
+ * @param model The image model to use
+ * @param input Input tensor
+ * @param output Output tensor
+ * @param confidence Softmax confidence of each layer's head [numLayers]
+ * @param classes Top class of each layer's head, -1 where none ran [numLayers]
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardExits(const TinyAIImageModel *model, const float *input,
+                                  float *output, float *confidence, int *classes)
+{
+    if (!model || !model->exits || !confidence || !classes) {
+        return false;
+    }
+
+    for (int l = 0; l < model->numLayers; l++) {
+        confidence[l] = 0.0f;
+        classes[l]    = -1;
+    }
+    return forwardBatch(model, input, 1, output, NULL, confidence, classes);
+}
+
+/**
+ * Attach an early-exit head after a layer, or remove it
+ * @param model The model to configure
+ * @param layerIndex Layer whose output the head reads
+ * @param weights Head weights [numClasses x layer output channels], or NULL to remove the head
+ * @param biases Head biases [numClasses] (can be NULL)
+ * @param threshold Softmax confidence that stops an image
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetExitHead(TinyAIImageModel *model, int layerIndex, const float *weights,
+                                 const float *biases, float threshold)
+{
+    if (!model || layerIndex < 0 || layerIndex >= model->numLayers || isnan(threshold)) {
+        return false;
+    }
+
+    const Layer *layer = &model->layers[layerIndex];
+    if (!weights) {
+        if (model->exits) {
+            TinyAIImageExitHead *head = &model->exits->heads[layerIndex];
+            free(head->weights);
+            free(head->biases);
+            memset(head, 0, sizeof(*head));
+        }
+        return true;
+    }
+
+    /* The head's scores stand in for the model's results */
+    if ((layer->type != LAYER_TYPE_CONV && layer->type != LAYER_TYPE_DEPTHWISE &&
+         layer->type != LAYER_TYPE_POOLING) ||
+        layerIndex == model->numLayers - 1 ||
+        model->layers[model->numLayers - 1].outputWidth != model->numClasses) {
+        fprintf(stderr, "Layer %d (%s) cannot take an early-exit head\n", layerIndex,
+                layer->name);
+        return false;
+    }
+
+    if (!model->exits) {
+        model->exits = (TinyAIImageExits *)calloc(1, sizeof(TinyAIImageExits));
+        if (!model->exits) {
+            return false;
+        }
+    }
+
+    size_t count       = (size_t)model->numClasses * layer->outputChannels;
+    float *headWeights = (float *)malloc(count * sizeof(float));
+    float *headBiases  = (float *)calloc(model->numClasses, sizeof(float));
+    if (!headWeights || !headBiases) {
+        fprintf(stderr, "Failed to allocate early-exit head\n");
+        free(headWeights);
+        free(headBiases);
+        return false;
+    }
+    memcpy(headWeights, weights, count * sizeof(float));
+    if (biases) {
+        memcpy(headBiases, biases, model->numClasses * sizeof(float));
+    }
+
+    TinyAIImageExitHead *head = &model->exits->heads[layerIndex];
+    free(head->weights);
+    free(head->biases);
+    head->weights   = headWeights;
+    head->biases    = headBiases;
+    head->channels  = layer->outputChannels;
+    head->threshold = threshold;
+
+    /* The head's pooled channels and scores take layer scratch */
+    return tinyaiImageModelPrepareWorkspace(model, 1);
+}
+
+/* Confidence of a head on one image and whether its top class matched the full model's */
+typedef struct {
+    float confidence;
+    bool  agrees;
+} ExitSample;
+
+static int compareExitSamples(const void *a, const void *b)
+{
+    float x = ((const ExitSample *)a)->confidence;
+    float y = ((const ExitSample *)b)->confidence;
+    return (x < y) - (x > y);
+}
+
+/**
+ * Set each early-exit head's threshold from probed confidences
+ *
+ * Sorts a head's samples by descending confidence; a threshold stops every
+ * image at or above it, so only the ends of runs of equal confidence count.
+ * A head that never ran gets a threshold above 1.
+ *
+ * @param model The model with exit heads attached
+ * @param confidence Head confidences of each image [numImages x numLayers]
+ * @param classes Head top classes of each image, -1 where none ran [numImages x numLayers]
+ * @param expected Full model's top class of each image [numImages]
+ * @param numImages Number of images
+ * @param agreement Fraction of exited images that must match the full model
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelFitExitThresholds(TinyAIImageModel *model, const float *confidence,
+                                       const int *classes, const int *expected, int numImages,
+                                       float agreement)
+{
+    ExitSample *samples = (ExitSample *)malloc(numImages * sizeof(ExitSample));
+    if (!model->exits || !samples) {
+        free(samples);
+        return false;
+    }
+
+    for (int l = 0; l < model->numLayers; l++) {
+        TinyAIImageExitHead *head = &model->exits->heads[l];
+        if (!head->weights) {
+            continue;
+        }
+
+        int count = 0;
+        for (int i = 0; i < numImages; i++) {
+            size_t index = (size_t)i * model->numLayers + l;
+            if (classes[index] >= 0) {
+                samples[count].confidence = confidence[index];
+                samples[count].agrees     = classes[index] == expected[i];
+                count++;
+            }
+        }
+        qsort(samples, count, sizeof(ExitSample), compareExitSamples);
+
+        float threshold = 2.0f;
+        int   agreed    = 0;
+        for (int n = 0; n < count; n++) {
+            agreed += samples[n].agrees;
+            if (n + 1 < count && samples[n + 1].confidence == samples[n].confidence) {
+                continue;
+            }
+            if ((float)agreed >= agreement * (float)(n + 1)) {
+                threshold = samples[n].confidence;
+            }
+        }
+        head->threshold = threshold;
+    }
+
+    free(samples);
+    return true;
+}
 
-        case LAYER_TYPE_POOLING:
-            success = forwardPooling(layer, currentInput, currentOutput, 0); /* 0 = max pooling */
-            break;
+/**
+ * Get how many images stopped at each layer's early-exit head
+ * @param model The model to query
+ * @param counts Receives one count per layer
+ * @param maxLayers Size of counts
+ * @return Number of counts written, negative on failure
+ */
+int tinyaiImageModelGetExitCounts(const TinyAIImageModel *model, uint64_t *counts, int maxLayers)
+{
+    if (!model || !counts || maxLayers < 0) {
+        return -1;
+    }
 
-        case LAYER_TYPE_DENSE:
-            success = forwardDense(layer, currentInput, currentOutput, model->useSIMD);
-            break;
+    int count = model->numLayers < maxLayers ? model->numLayers : maxLayers;
+    for (int l = 0; l < count; l++) {
+        counts[l] = model->exits ? model->exits->counts[l] : 0;
+    }
+    return count;
+}
 
-        case LAYER_TYPE_FLATTEN:
-            success = forwardFlatten(layer, currentInput, currentOutput);
-            break;
+/**
+ * Clear the early-exit counts of a model
+ * @param model The model
+ */
+void tinyaiImageModelResetExitCounts(TinyAIImageModel *model)
+{
+    if (model && model->exits) {
+        memset(model->exits->counts, 0, sizeof(model->exits->counts));
+    }
+}
 
-        case LAYER_TYPE_INPUT:
-            /* Input layer doesn't do any processing */
-            memcpy(currentOutput, currentInput,
-                   layer->outputWidth * layer->outputHeight * layer->outputChannels *
-                       sizeof(float));
-            success = true;
-            break;
+/**
+ * Free a model's early-exit heads
+ * @param model The model
+ */
+void tinyaiImageModelReleaseExits(TinyAIImageModel *model)
+{
+    if (!model || !model->exits) {
+        return;
+    }
 
-        case LAYER_TYPE_DROPOUT:
-            /* Dropout is not applied during inference */
-            memcpy(currentOutput, currentInput,
-                   layer->outputWidth * layer->outputHeight * layer->outputChannels *
-                       sizeof(float));
-            success = true;
-            break;
+    for (int l = 0; l < model->numLayers; l++) {
+        free(model->exits->heads[l].weights);
+        free(model->exits->heads[l].biases);
+    }
+    free(model->exits);
+    model->exits = NULL;
+}
 
-        default:
-            fprintf(stderr, "Unknown layer type: %d\n", layer->type);
-            success = false;
-        }
+/**
+ * One band of output rows of a convolution or depthwise layer, run as a thread pool task
+ *
+ * The input has no padding left to apply: either the layer has none, or it
+ * was written out as zeros, so a band only needs its own rows of input.
+ */
+typedef struct {
+    const Layer *layer;
+    const float *input;
+    float       *output;
+    int          inWidth;
+    int          inHeight;
+} ConvRowsTask;
+
+static void convRows(void *context, size_t begin, size_t end)
+{
+    ConvRowsTask *task   = (ConvRowsTask *)context;
+    const Layer  *layer  = task->layer;
+    int           rows   = (int)(end - begin);
+    int           first  = (int)begin * layer->stride;
+    int           inRows = (rows - 1) * layer->stride + layer->kernelSize;
+    if (first + inRows > task->inHeight) {
+        inRows = task->inHeight - first;
+    }
 
-        if (!success) {
-            fprintf(stderr, "Forward pass failed at layer %d (%s)\n", l, layer->name);
-            free(buffer1);
-            free(buffer2);
-            return false;
-        }
+    const float *input  = task->input + (size_t)first * task->inWidth * layer->inputChannels;
+    float       *output = task->output + begin * layer->outputWidth * layer->outputChannels;
 
-        /* Apply activation function if needed */
-        if (layer->activation != ACTIVATION_NONE) {
-            if (!forwardActivation(layer->activation, currentOutput,
-                                   layer->outputWidth * layer->outputHeight * layer->outputChannels,
-                                   model->useSIMD)) {
-                fprintf(stderr, "Activation failed at layer %d (%s)\n", l, layer->name);
-                free(buffer1);
-                free(buffer2);
-                return false;
-            }
-        }
+    if (layer->type == LAYER_TYPE_CONV) {
+        tinyaiSimdConv2d4Bit(output, input, layer->weights, layer->biases, layer->scales,
+                             task->inWidth, inRows, layer->inputChannels, layer->outputWidth,
+                             rows, layer->outputChannels, layer->kernelSize, layer->stride, 0);
+    }
+    else {
+        tinyaiSimdDepthwiseConv2d4Bit(output, input, layer->weights, layer->biases, layer->scales,
+                                      task->inWidth, inRows, layer->inputChannels,
+                                      layer->outputWidth, rows,
+                                      layer->outputChannels / layer->inputChannels,
+                                      layer->kernelSize, layer->stride, 0);
+    }
+}
 
-        /* Swap buffers */
-        float *temp   = currentInput;
-        currentInput  = currentOutput;
-        currentOutput = temp;
+/**
+ * Run a direct convolution or depthwise layer in bands of output rows across the pool
+ *
+ * Padded layers first copy their input into the scratch with the padding
+ * written out as zeros. Returns false, having done nothing, when the layer
+ * is too small to be worth splitting.
+ */
+static bool forwardConvRows(const Layer *layer, const float *input, float *output,
+                            float *scratch)
+{
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    if (tinyaiThreadPoolSize(pool) < 2) {
+        return false;
     }
 
-    /* Copy final result to output */
-    memcpy(output, currentInput, model->layers[model->numLayers - 1].outputWidth * sizeof(float));
+    /* Multiply-adds of one output row */
+    size_t work = (size_t)layer->outputWidth * layer->outputChannels * layer->kernelSize *
+                  layer->kernelSize;
+    if (layer->type == LAYER_TYPE_CONV) {
+        work *= layer->inputChannels;
+    }
+    size_t grain = tinyaiThreadPoolGrain(pool, work, 1);
+    if ((size_t)layer->outputHeight < 2 * grain) {
+        return false;
+    }
 
-    /* Free buffers */
-    free(buffer1);
-    free(buffer2);
+    ConvRowsTask task = {layer, input, output, layer->inputWidth, layer->inputHeight};
+    if (layer->padding > 0) {
+        int    channels = layer->inputChannels;
+        size_t row      = (size_t)layer->inputWidth * channels;
+        paddedInputSize(layer, &task.inWidth, &task.inHeight);
+        memset(scratch, 0, (size_t)task.inWidth * task.inHeight * channels * sizeof(float));
+        for (int y = 0; y < layer->inputHeight; y++) {
+            float *dst = scratch + ((size_t)(y + layer->padding) * task.inWidth + layer->padding) *
+                                       channels;
+            memcpy(dst, input + y * row, row * sizeof(float));
+        }
+        task.input = scratch;
+    }
 
+    tinyaiParallelFor(pool, (size_t)layer->outputHeight, grain, convRows, &task);
     return true;
 }
 
 /**
  * Forward pass for convolutional layer
  */
-static bool forwardConv(const Layer *layer, const float *input, float *output, bool useSIMD)
+static bool forwardConv(const Layer *layer, const float *input, float *output, bool useSIMD,
+                        float *scratch)
 {
     if (!layer || !input || !output) {
         return false;
@@ -153,6 +935,36 @@ static bool forwardConv(const Layer *layer, const float *input, float *output, b
 
     /* Check if we are using SIMD and quantized weights */
     if (useSIMD && layer->weights) {
+        /* Pruned layers skip their zero weights */
+        if (layer->sparseWeights) {
+            return tinyaiCSRMatrixConv2d(layer->sparseWeights, input, layer->biases, output,
+                                         layer->inputWidth, layer->inputHeight,
+                                         layer->inputChannels, layer->outputWidth,
+                                         layer->outputHeight, layer->kernelSize, layer->stride,
+                                         layer->padding);
+        }
+
+        /*
+         * The direct kernel is split here; the other algorithms split their
+         * own work. A band only has fewer output rows, which never moves the
+         * selection off the direct kernel.
+         */
+        bool direct = tinyaiSimdSelectConvAlgorithm(layer->inputChannels, layer->outputWidth,
+                                                    layer->outputHeight, layer->outputChannels,
+                                                    layer->kernelSize,
+                                                    layer->stride) == TINYAI_SIMD_CONV_DIRECT &&
+                      (!layer->convPlan ||
+                       tinyaiSimdConvPlanAlgorithm(layer->convPlan) == TINYAI_SIMD_CONV_DIRECT);
+        if (direct && forwardConvRows(layer, input, output, scratch)) {
+            return true;
+        }
+
+        /* Layers prepared at load time run their plan; its weights are already transformed */
+        if (layer->convPlan &&
+            tinyaiSimdRunConvPlan(layer->convPlan, output, input, layer->biases) == 0) {
+            return true;
+        }
+
         /* Use our newly implemented SIMD-accelerated convolution */
         tinyaiSimdConv2d4Bit(output,                /* Output feature map */
                              input,                 /* Input feature map */
@@ -186,7 +998,8 @@ static bool forwardConv(const Layer *layer, const float *input, float *output, b
 /**
  * Forward pass for depthwise convolution layer
  */
-static bool forwardDepthwise(const Layer *layer, const float *input, float *output, bool useSIMD)
+static bool forwardDepthwise(const Layer *layer, const float *input, float *output, bool useSIMD,
+                             float *scratch)
 {
     if (!layer || !input || !output) {
         return false;
@@ -197,6 +1010,10 @@ static bool forwardDepthwise(const Layer *layer, const float *input, float *outp
 
     /* Check if we are using SIMD and quantized weights */
     if (useSIMD && layer->weights) {
+        if (forwardConvRows(layer, input, output, scratch)) {
+            return true;
+        }
+
         /* Use our newly implemented SIMD-accelerated depthwise convolution */
         tinyaiSimdDepthwiseConv2d4Bit(output,         /* Output feature map */
                                       input,          /* Input feature map */
@@ -228,6 +1045,44 @@ static bool forwardDepthwise(const Layer *layer, const float *input, float *outp
     }
 }
 
+/**
+ * Forward pass for a convolution or depthwise layer on channel-blocked activations
+ */
+static bool forwardBlocked(const Layer *layer, const Layer *pooling, const float *input,
+                           float *output)
+{
+    if (!layer || !input || !output) {
+        return false;
+    }
+
+    /* The activation, and the pooling layer fused at load time, run on each row in cache */
+    TinyAIBlockedEpilogue epilogue = {TINYAI_SIMD_ACTIVATION_NONE, TINYAI_SIMD_POOL_NONE, 0, 0};
+    if (layer->activation != ACTIVATION_NONE &&
+        !simdActivationType(layer->activation, &epilogue.activation)) {
+        return false;
+    }
+    if (pooling) {
+        /* Same pooling as forwardPooling runs for LAYER_TYPE_POOLING */
+        epilogue.poolType   = TINYAI_SIMD_POOL_MAX;
+        epilogue.poolKernel = pooling->kernelSize;
+        epilogue.poolStride = pooling->stride;
+    }
+
+    if (layer->type == LAYER_TYPE_DEPTHWISE) {
+        return tinyaiSimdDepthwiseConv2dBlocked(
+                   output, input, layer->blockedWeights, layer->biases, layer->inputWidth,
+                   layer->inputHeight, layer->inputChannels, layer->outputWidth,
+                   layer->outputHeight, layer->kernelSize, layer->stride, layer->padding,
+                   &epilogue) == 0;
+    }
+
+    return tinyaiSimdConv2dBlocked(output, input, layer->blockedWeights, layer->biases,
+                                   layer->inputWidth, layer->inputHeight, layer->inputChannels,
+                                   layer->outputWidth, layer->outputHeight,
+                                   layer->outputChannels, layer->kernelSize, layer->stride,
+                                   layer->padding, &epilogue) == 0;
+}
+
 /**
  * Forward pass for pooling layer
  */
@@ -329,10 +1184,79 @@ static bool forwardPooling(const Layer *layer, const float *input, float *output
     return true;
 }
 
+/**
+ * Elementwise operations adding a layer's biases and applying its activation
+ *
+ * @param layer The layer
+ * @param ops Filled with up to two operations
+ * @return Number of operations, or -1 for an unknown activation
+ */
+int tinyaiImageLayerEpilogue(const Layer *layer, TinyAIElementwiseOp *ops)
+{
+    int numOps = 0;
+    if (layer->biases) {
+        ops[numOps++] =
+            (TinyAIElementwiseOp){TINYAI_SIMD_EW_BIAS, 0, layer->biases, NULL, 0.0f, 0.0f};
+    }
+    if (layer->activation != ACTIVATION_NONE) {
+        int simdType;
+        if (!simdActivationType(layer->activation, &simdType)) {
+            return -1;
+        }
+        ops[numOps++] =
+            (TinyAIElementwiseOp){TINYAI_SIMD_EW_ACTIVATION, simdType, NULL, NULL, 0.0f, 0.0f};
+    }
+    return numOps;
+}
+
+/**
+ * Add a dense layer's biases to one output and apply its activation, in one pass
+ */
+static bool denseEpilogue(const Layer *layer, float *output)
+{
+    TinyAIElementwiseOp ops[2];
+    int                 numOps = tinyaiImageLayerEpilogue(layer, ops);
+
+    return numOps >= 0 &&
+           tinyaiSimdElementwise(output, output, 1, layer->outputWidth, ops, numOps) == 0;
+}
+
+/**
+ * A range of a dense layer's output rows, run as a thread pool task
+ */
+typedef struct {
+    const Layer  *layer;
+    const float  *input;
+    const int8_t *quantized; /* Input quantized to int8, or NULL to multiply in floats */
+    float         inputScale;
+    float        *output;
+} DenseRowsTask;
+
+static void denseRows(void *context, size_t begin, size_t end)
+{
+    DenseRowsTask *task    = (DenseRowsTask *)context;
+    const Layer   *layer   = task->layer;
+    int            rows    = (int)(end - begin);
+    int            cols    = layer->inputWidth;
+    const uint8_t *weights = layer->weights + begin * (size_t)((cols + 1) / 2);
+
+    if (task->quantized) {
+        tinyaiSimdMatMul4BitInt8(task->output + begin, weights, task->quantized, task->inputScale,
+                                 rows, cols, layer->scales + begin);
+    }
+    else {
+        tinyaiSimdMatMul4Bit(task->output + begin, weights, task->input, rows, cols,
+                             layer->scales + begin);
+    }
+}
+
 /**
  * Forward pass for dense (fully connected) layer
+ *
+ * The SIMD path also applies the layer's activation (see denseRunsFused).
  */
-static bool forwardDense(const Layer *layer, const float *input, float *output, bool useSIMD)
+static bool forwardDense(const Layer *layer, const float *input, float *output, bool useSIMD,
+                         int8_t *scratch)
 {
     if (!layer || !input || !output) {
         return false;
@@ -344,25 +1268,19 @@ static bool forwardDense(const Layer *layer, const float *input, float *output,
 
     /* Check if we are using SIMD and quantized weights */
     if (useSIMD && layer->weights) {
-        /* Use SIMD-accelerated matrix-vector multiplication for 4-bit weights */
-        tinyaiSimdMatMul4Bit(output,         /* Output vector */
-                             layer->weights, /* 4-bit quantized weights */
-                             input,          /* Input vector */
-                             outputSize,     /* Number of rows (output size) */
-                             inputSize,      /* Number of columns (input size) */
-                             layer->scales   /* Scale factors for dequantizing weights */
-        );
-
-        /* Add biases */
-        if (layer->biases) {
-/* Use SIMD to add biases if vectorization is supported by compiler */
-#pragma omp simd
-            for (int i = 0; i < outputSize; i++) {
-                output[i] += layer->biases[i];
-            }
+        DenseRowsTask task = {layer, input, NULL, 0.0f, output};
+        if (tinyaiGetActivationPrecision() == TINYAI_PRECISION_INT8) {
+            /* Quantize the input once into the scratch, then use integer dot products */
+            task.inputScale = tinyaiSimdQuantizeInt8(scratch, input, inputSize);
+            task.quantized  = scratch;
         }
 
-        return true;
+        /* Output rows are independent, so ranges of them go to the pool's workers */
+        TinyAIThreadPool *pool = tinyaiGetThreadPool();
+        tinyaiParallelFor(pool, (size_t)outputSize, tinyaiThreadPoolGrain(pool, inputSize, 1),
+                          denseRows, &task);
+
+        return denseEpilogue(layer, output);
     }
     else if (layer->weights) {
         /* Non-SIMD implementation but with cache optimization */
@@ -418,27 +1336,63 @@ static bool forwardDense(const Layer *layer, const float *input, float *output,
 }
 
 /**
- * Forward pass for flatten layer
+ * Forward pass for a dense layer over a whole batch, as one matrix-matrix product
+ *
+ * The batch is gathered into an [inputSize x batch] matrix in the output
+ * buffer, multiplied into the input buffer (no longer needed by then), and
+ * scattered back to one image per slot of the output buffer. The weights
+ * are read once for the batch instead of once per image.
  */
-static bool forwardFlatten(const Layer *layer, const float *input, float *output)
+static bool forwardDenseBatch(const Layer *layer, float *input, float *output, int batch,
+                              size_t stride)
 {
-    if (!layer || !input || !output) {
-        return false;
+    int inputSize  = layer->inputWidth;
+    int outputSize = layer->outputWidth;
+
+    for (int n = 0; n < batch; n++) {
+        const float *image = input + n * stride;
+        for (int k = 0; k < inputSize; k++) {
+            output[(size_t)k * batch + n] = image[k];
+        }
     }
 
-    /* Flatten is a simple reshape operation - copy the data in the correct order */
-    int idx = 0;
-    for (int h = 0; h < layer->inputHeight; h++) {
-        for (int w = 0; w < layer->inputWidth; w++) {
-            for (int c = 0; c < layer->inputChannels; c++) {
-                output[idx++] = input[(h * layer->inputWidth + w) * layer->inputChannels + c];
-            }
+    tinyaiSimdMatMul4BitMM(input, layer->weights, output, outputSize, inputSize, batch,
+                           layer->scales);
+
+    for (int n = 0; n < batch; n++) {
+        float *image = output + n * stride;
+        for (int r = 0; r < outputSize; r++) {
+            image[r] = input[(size_t)r * batch + n];
+        }
+        if (!denseEpilogue(layer, image)) {
+            return false;
         }
     }
 
     return true;
 }
 
+/**
+ * Map an activation type to its TINYAI_SIMD_ACTIVATION_* equivalent
+ */
+static bool simdActivationType(int activationType, int *simdType)
+{
+    switch (activationType) {
+    case ACTIVATION_RELU:
+        *simdType = TINYAI_SIMD_ACTIVATION_RELU;
+        return true;
+    case ACTIVATION_SIGMOID:
+        *simdType = TINYAI_SIMD_ACTIVATION_SIGMOID;
+        return true;
+    case ACTIVATION_TANH:
+        *simdType = TINYAI_SIMD_ACTIVATION_TANH;
+        return true;
+    default:
+        /* Unknown activation type */
+        return false;
+    }
+}
+
 /**
  * Apply activation function
  */
@@ -450,27 +1404,13 @@ static bool forwardActivation(int activationType, float *data, int size, bool us
 
     if (useSIMD) {
         /* Map our activation types to SIMD activation types */
-        int simdActivationType;
-        switch (activationType) {
-        case ACTIVATION_RELU:
-            simdActivationType = 0; /* ReLU */
-            break;
-        case ACTIVATION_SIGMOID:
-            simdActivationType = 2; /* Sigmoid */
-            break;
-        case ACTIVATION_TANH:
-            /* SIMD activation doesn't have tanh directly, use reference implementation */
-            for (int i = 0; i < size; i++) {
-                data[i] = tanh(data[i]);
-            }
-            return true;
-        default:
-            /* Unknown activation type */
+        int simdType;
+        if (!simdActivationType(activationType, &simdType)) {
             return false;
         }
 
         /* Use SIMD-accelerated activation */
-        tinyaiSimdActivate(data, size, simdActivationType);
+        tinyaiSimdActivate(data, size, simdType);
         return true;
     }
     else {
@@ -494,3 +1434,339 @@ static bool forwardActivation(int activationType, float *data, int size, bool us
         return true;
     }
 }
+
+/* Rows or columns of a map, [begin, end), one entry per trunk layer and the input first */
+typedef struct {
+    int begin[51];
+    int end[51];
+} TiledSpan;
+
+/**
+ * Number of leading layers tiled inference runs
+ *
+ * The trunk is the run of convolution, depthwise and pooling layers the
+ * model starts with. It stops at the first layer that needs the whole map:
+ * flatten, dense, a global pooling layer, or a padded pooling layer, whose
+ * border windows skip the padding rather than read it as zeros.
+ */
+static int tiledTrunkLayers(const TinyAIImageModel *model)
+{
+    int count = 0;
+    for (; count < model->numLayers; count++) {
+        const Layer *layer   = &model->layers[count];
+        bool         pooling = layer->type == LAYER_TYPE_POOLING;
+        bool         global  = layer->kernelSize >= layer->inputWidth &&
+                      layer->kernelSize >= layer->inputHeight;
+        if (pooling ? global || layer->padding > 0
+                    : layer->type != LAYER_TYPE_CONV && layer->type != LAYER_TYPE_DEPTHWISE) {
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * Sizes of the trunk's maps along one axis of an input of the given size
+ */
+static bool tiledMapSizes(const TinyAIImageModel *model, int layers, int size, int *sizes)
+{
+    sizes[0] = size;
+    for (int i = 0; i < layers; i++) {
+        const Layer *layer = &model->layers[i];
+        int          span  = sizes[i] + 2 * layer->padding - layer->kernelSize;
+        if (span < 0) {
+            return false;
+        }
+        sizes[i + 1] = span / layer->stride + 1;
+    }
+    return true;
+}
+
+/**
+ * Span of every trunk map a tile needs to produce [begin, end) of the trunk output
+ *
+ * Walked back from the output, each layer reads its kernel's reach around
+ * its outputs, including the positions of its padding.
+ */
+static void tiledSpan(const TinyAIImageModel *model, int layers, int begin, int end,
+                      TiledSpan *span)
+{
+    span->begin[layers] = begin;
+    span->end[layers]   = end;
+    for (int i = layers - 1; i >= 0; i--) {
+        const Layer *layer = &model->layers[i];
+        span->begin[i]     = span->begin[i + 1] * layer->stride - layer->padding;
+        span->end[i] = (span->end[i + 1] - 1) * layer->stride - layer->padding + layer->kernelSize;
+    }
+}
+
+/**
+ * Floats of the largest map a tile of the given size holds
+ */
+static size_t tiledBufferFloats(const TinyAIImageModel *model, int layers, int tile)
+{
+    TiledSpan span;
+    tiledSpan(model, layers, 0, tile, &span);
+
+    size_t largest = 0;
+    for (int i = 0; i <= layers; i++) {
+        int    channels = i == 0 ? model->inputChannels : model->layers[i - 1].outputChannels;
+        size_t side     = (size_t)(span.end[i] - span.begin[i]);
+        size_t floats   = side * side * channels;
+        largest         = floats > largest ? floats : largest;
+    }
+    return largest;
+}
+
+/**
+ * Tiles of the trunk output, run as thread pool tasks
+ */
+typedef struct {
+    const TinyAIImageModel *model;
+    const float            *input;
+    float                  *output;
+    int                     layers;
+    int                     widths[51];  /* Map widths, input first */
+    int                     heights[51]; /* Map heights, input first */
+    int                     tile;        /* Side of a tile of the trunk output */
+    int                     tilesX;
+    size_t                  bufferFloats;
+    bool                    serial; /* Tiles run side by side, so their kernels run serially */
+    bool                    failed;
+} TiledTask;
+
+/**
+ * Zero the positions of a tile's map that lie outside the whole map
+ *
+ * Those positions stand for the next layer's padding, which reads zeros.
+ */
+static void tiledClearOutside(float *map, const TiledSpan *rows, const TiledSpan *cols, int index,
+                              int width, int height, int channels)
+{
+    int    tileWidth = cols->end[index] - cols->begin[index];
+    size_t pixel     = (size_t)channels;
+    for (int y = rows->begin[index]; y < rows->end[index]; y++) {
+        float *row = map + (size_t)(y - rows->begin[index]) * tileWidth * pixel;
+        if (y < 0 || y >= height) {
+            memset(row, 0, tileWidth * pixel * sizeof(float));
+            continue;
+        }
+        int left  = cols->begin[index] < 0 ? -cols->begin[index] : 0;
+        int right = cols->end[index] > width ? cols->end[index] - width : 0;
+        memset(row, 0, left * pixel * sizeof(float));
+        memset(row + (tileWidth - right) * pixel, 0, right * pixel * sizeof(float));
+    }
+}
+
+/**
+ * Run the trunk over one tile and write its part of the output
+ */
+static bool runTile(TiledTask *task, int index, float *current, float *next)
+{
+    const TinyAIImageModel *model  = task->model;
+    int                     layers = task->layers;
+    int                     x      = index % task->tilesX * task->tile;
+    int                     y      = index / task->tilesX * task->tile;
+    int outWidth  = task->widths[layers] - x < task->tile ? task->widths[layers] - x : task->tile;
+    int outHeight = task->heights[layers] - y < task->tile ? task->heights[layers] - y : task->tile;
+
+    TiledSpan rows, cols;
+    tiledSpan(model, layers, y, y + outHeight, &rows);
+    tiledSpan(model, layers, x, x + outWidth, &cols);
+
+    /* The input region, with zeros for the padding around the image */
+    int    channels = model->inputChannels;
+    int    width    = cols.end[0] - cols.begin[0];
+    int    left     = cols.begin[0] < 0 ? 0 : cols.begin[0];
+    int    right    = cols.end[0] > task->widths[0] ? task->widths[0] : cols.end[0];
+    size_t pixel    = (size_t)channels;
+    memset(current, 0, (size_t)(rows.end[0] - rows.begin[0]) * width * pixel * sizeof(float));
+    for (int row = rows.begin[0]; row < rows.end[0]; row++) {
+        if (row < 0 || row >= task->heights[0] || left >= right) {
+            continue;
+        }
+        memcpy(current + ((size_t)(row - rows.begin[0]) * width + left - cols.begin[0]) * pixel,
+               task->input + ((size_t)row * task->widths[0] + left) * pixel,
+               (right - left) * pixel * sizeof(float));
+    }
+
+    /*
+     * Each layer runs unpadded on the tile's region of its input, which
+     * already holds the padding as zeros, so its outputs match the whole
+     * image's exactly.
+     */
+    for (int i = 0; i < layers; i++) {
+        if (tinyaiCancelled()) {
+            return false;
+        }
+
+        Layer tile        = model->layers[i];
+        tile.inputWidth   = cols.end[i] - cols.begin[i];
+        tile.inputHeight  = rows.end[i] - rows.begin[i];
+        tile.outputWidth  = cols.end[i + 1] - cols.begin[i + 1];
+        tile.outputHeight = rows.end[i + 1] - rows.begin[i + 1];
+        tile.padding      = 0;
+        tile.convPlan     = NULL;
+        tile.fusePooling  = false;
+
+        int size = tile.outputWidth * tile.outputHeight * tile.outputChannels;
+        if (!forwardLayer(model, &tile, NULL, false, current, next, NULL) ||
+            (tile.activation != ACTIVATION_NONE &&
+             !forwardActivation(tile.activation, next, size, model->useSIMD))) {
+            return false;
+        }
+        if (i + 1 < layers) {
+            tiledClearOutside(next, &rows, &cols, i + 1, task->widths[i + 1],
+                              task->heights[i + 1], tile.outputChannels);
+        }
+
+        float *swap = current;
+        current     = next;
+        next        = swap;
+    }
+
+    size_t row = (size_t)outWidth * model->layers[layers - 1].outputChannels;
+    for (int r = 0; r < outHeight; r++) {
+        memcpy(task->output + ((size_t)(y + r) * task->widths[layers] + x) *
+                                  model->layers[layers - 1].outputChannels,
+               current + r * row, row * sizeof(float));
+    }
+    return true;
+}
+
+static void tiledRows(void *context, size_t begin, size_t end)
+{
+    TiledTask *task    = (TiledTask *)context;
+    float     *current = (float *)malloc(task->bufferFloats * sizeof(float));
+    float     *next    = (float *)malloc(task->bufferFloats * sizeof(float));
+
+    TinyAIThreadPoolScope scope = {NULL, false};
+    if (task->serial) {
+        scope = tinyaiUseThreadPool(NULL);
+    }
+
+    bool success = current && next;
+    for (size_t i = begin; success && i < end; i++) {
+        success = runTile(task, (int)i, current, next);
+    }
+    if (!success) {
+        task->failed = true;
+    }
+
+    if (task->serial) {
+        tinyaiRestoreThreadPool(scope);
+    }
+    free(current);
+    free(next);
+}
+
+/**
+ * Get the size of the feature map tiled inference produces
+ *
+ * @param model The image model to use
+ * @param width Input width in pixels
+ * @param height Input height in pixels
+ * @param outWidth Output parameter for the feature map width
+ * @param outHeight Output parameter for the feature map height
+ * @param outChannels Output parameter for the feature map channels
+ * @return true on success, false if the model has no trunk or the input is too small
+ */
+bool tinyaiImageModelGetTiledOutputSize(const TinyAIImageModel *model, int width, int height,
+                                        int *outWidth, int *outHeight, int *outChannels)
+{
+    if (!model || width < 1 || height < 1 || !outWidth || !outHeight || !outChannels) {
+        return false;
+    }
+
+    int layers = tiledTrunkLayers(model);
+    int widths[51], heights[51];
+    if (layers == 0 || !tiledMapSizes(model, layers, width, widths) ||
+        !tiledMapSizes(model, layers, height, heights)) {
+        return false;
+    }
+
+    *outWidth    = widths[layers];
+    *outHeight   = heights[layers];
+    *outChannels = model->layers[layers - 1].outputChannels;
+    return true;
+}
+
+/**
+ * Run the model's convolutional trunk over an input of any size, tile by tile
+ *
+ * @param model The image model to use
+ * @param input Preprocessed input, height x width x channels
+ * @param width Input width in pixels
+ * @param height Input height in pixels
+ * @param tileSize Side of a tile of the output feature map, or 0 to choose one
+ * @param output Feature map of the size tinyaiImageModelGetTiledOutputSize reports
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardTiled(const TinyAIImageModel *model, const float *input, int width,
+                                  int height, int tileSize, float *output)
+{
+    if (!model || !input || !output || tileSize < 0) {
+        fprintf(stderr, "Invalid parameters for tiled forward pass\n");
+        return false;
+    }
+    if (model->loader) {
+        fprintf(stderr, "Tiled forward pass needs the layer weights held by the model\n");
+        return false;
+    }
+
+    TiledTask task = {.model = model, .input = input, .output = output};
+    task.layers    = tiledTrunkLayers(model);
+    if (task.layers == 0 || !tiledMapSizes(model, task.layers, width, task.widths) ||
+        !tiledMapSizes(model, task.layers, height, task.heights)) {
+        fprintf(stderr, "Model has no convolutional trunk for a %dx%d input\n", width, height);
+        return false;
+    }
+
+    /*
+     * Without a tile size, tiles are as large as fit in the activation
+     * buffer the model uses for its own input size, so a tile takes about the
+     * memory of an ordinary forward pass however large the image.
+     */
+    int outWidth  = task.widths[task.layers];
+    int outHeight = task.heights[task.layers];
+    int largest   = outWidth > outHeight ? outWidth : outHeight;
+    task.tile     = tileSize > 0 && tileSize < largest ? tileSize : largest;
+    if (tileSize == 0) {
+        size_t budget = forwardBufferFloats(model);
+        while (task.tile > 1 && tiledBufferFloats(model, task.layers, task.tile) > budget) {
+            task.tile--;
+        }
+    }
+    task.tilesX       = (outWidth + task.tile - 1) / task.tile;
+    task.bufferFloats = tiledBufferFloats(model, task.layers, task.tile);
+    size_t tiles      = (size_t)task.tilesX * ((outHeight + task.tile - 1) / task.tile);
+
+    bool                  scoped = model->serial || model->threadPool;
+    TinyAIThreadPoolScope scope  = {NULL, false};
+    if (scoped) {
+        scope = tinyaiUseThreadPool(model->serial ? NULL : model->threadPool);
+    }
+
+    /* Several tiles run side by side; a single tile splits its layers across the pool instead */
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    task.serial            = tiles > 1 && tinyaiThreadPoolSize(pool) > 1;
+    if (task.serial) {
+        tinyaiParallelFor(pool, tiles, 1, tiledRows, &task);
+    }
+    else {
+        tiledRows(&task, 0, tiles);
+    }
+    if (tinyaiCancelled()) {
+        task.failed = true; /* Skipped tiles were never written */
+    }
+
+    if (scoped) {
+        tinyaiRestoreThreadPool(scope);
+    }
+
+    if (task.failed) {
+        fprintf(stderr, "Tiled forward pass failed\n");
+        return false;
+    }
+    return true;
+}
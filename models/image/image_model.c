@@ -5,6 +5,11 @@
 
 #include "image_model.h"
 #include "../../core/memory.h"
+#include "../../utils/energy.h"
+#include "../../utils/simd_ops.h"
+#include "../../utils/progressive_loader.h"
+#include "../../utils/sparse_ops.h"
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,6 +31,9 @@
 #define ACTIVATION_SIGMOID 2
 #define ACTIVATION_TANH 3
 
+/* Convolution layers with at least this fraction of zero weights run the sparse kernel */
+#define SPARSE_CONV_MIN_SPARSITY 0.7f
+
 /* Forward declaration of Layer struct for internal use */
 typedef struct Layer Layer;
 
@@ -49,6 +57,16 @@ struct Layer {
     float   *biases;  /* Biases for conv/dense layers */
     float   *scales;  /* Scale factors for quantized weights */
 
+    /* Convolution algorithm and transformed weights, prepared while SIMD is enabled */
+    TinyAIConvPlan  *convPlan;
+    float           *blockedWeights; /* Dequantized for the channel-blocked layout */
+    TinyAICSRMatrix *sparseWeights;  /* Pruned filters, CSR over the im2col K dimension */
+    bool             fusePooling;    /* The next (pooling) layer runs inside this one */
+
+    /* Int8 activation mode (see tinyaiImageModelEnableInt8Activations) */
+    uint8_t *int8Weights; /* Conv: 4-bit rows per output channel; depthwise: int8 [k * k][outC] */
+    float    outputScale; /* Calibrated scale of the layer's int8 output */
+
     /* Memory requirements */
     size_t weightBytes; /* Size of weights in bytes */
     size_t biasBytes;   /* Size of biases in bytes */
@@ -68,10 +86,33 @@ struct TinyAIImageModel {
     int   numLayers;
 
     /* Memory */
-    void *memoryPool;
-    bool  useExternalMemory;
-    bool  useSIMD;
-    bool  useQuantization;
+    void        *memoryPool;
+    bool         useExternalMemory;
+    bool         useSIMD;
+    bool         useQuantization;
+    TinyAIArena *arena; /* Forward pass temporaries, or NULL for the workspace */
+
+    /* Threading of the forward pass kernels */
+    bool              serial;     /* Run every kernel on the calling thread */
+    TinyAIThreadPool *threadPool; /* Pool the kernels use, or NULL for the shared pool */
+
+    /* Int8 activation mode */
+    bool  int8Activations; /* Layers pass int8 tensors instead of floats */
+    bool  calibrated;      /* Activation scales have been calibrated */
+    float inputScale;      /* Calibrated scale of the int8 model input */
+
+    /* Forward pass workspace: two ping-pong buffers with a slot per image, then layer scratch */
+    float *workspace;
+    size_t workspaceFloats;  /* Floats in the whole workspace */
+    size_t activationFloats; /* Floats in each image's slot of a ping-pong buffer */
+    size_t scratchFloats;    /* Floats of layer scratch */
+    int    workspaceBatch;   /* Images the workspace holds */
+
+    /* Source of layer weights (NULL: weights held by the layers) */
+    TinyAIProgressiveLoader *loader;
+
+    /* Early-exit heads (NULL: every image runs every layer) */
+    struct TinyAIImageExits *exits;
 
     /* Labels */
     char **labels;
@@ -83,6 +124,418 @@ struct TinyAIImageModel {
 
 /* Private functions */
 
+/* Implemented in forward_pass.c */
+bool tinyaiImageModelPrepareWorkspace(TinyAIImageModel *model, int batch);
+bool tinyaiImageModelForwardBatch(const TinyAIImageModel *model, const float *inputs, int batch,
+                                  float *outputs);
+bool tinyaiImageModelForwardRanges(const TinyAIImageModel *model, const float *input,
+                                   float *output, float *ranges);
+bool tinyaiImageModelForwardExits(const TinyAIImageModel *model, const float *input,
+                                  float *output, float *confidence, int *classes);
+bool tinyaiImageModelFitExitThresholds(TinyAIImageModel *model, const float *confidence,
+                                       const int *classes, const int *expected, int numImages,
+                                       float agreement);
+void tinyaiImageModelReleaseExits(TinyAIImageModel *model);
+
+/* Implemented in forward_int8.c */
+bool tinyaiImageModelPrepareInt8(TinyAIImageModel *model);
+void tinyaiImageModelReleaseInt8(TinyAIImageModel *model);
+
+/**
+ * Whether a layer has a trailing activation of its own to take over
+ */
+static bool takesActivation(const Layer *layer)
+{
+    return (layer->type == LAYER_TYPE_CONV || layer->type == LAYER_TYPE_DEPTHWISE ||
+            layer->type == LAYER_TYPE_DENSE) &&
+           layer->activation == ACTIVATION_NONE;
+}
+
+/**
+ * Simplify the layer graph once, when the model is created
+ *
+ * An activation layer folds into the convolution, depthwise or dense layer
+ * before it, which then applies it while its output is being written.
+ * Layers that are identities at inference (input, dropout, and pooling over
+ * single pixels) are removed. Flatten layers stay, since pruning follows
+ * channels through them, but the forward pass runs them without a copy.
+ * Weight files record the simplified layers, so they load back into any
+ * model created with the same parameters.
+ */
+static void optimizeGraph(TinyAIImageModel *model)
+{
+    int kept = 0;
+    for (int i = 0; i < model->numLayers; i++) {
+        Layer *layer    = &model->layers[i];
+        Layer *previous = kept > 0 ? &model->layers[kept - 1] : NULL;
+
+        bool identity = layer->type == LAYER_TYPE_INPUT || layer->type == LAYER_TYPE_DROPOUT ||
+                        (layer->type == LAYER_TYPE_POOLING && layer->kernelSize == 1 &&
+                         layer->stride == 1 && layer->padding == 0 &&
+                         layer->activation == ACTIVATION_NONE);
+        bool folded = layer->type == LAYER_TYPE_ACTIVATION && previous &&
+                      takesActivation(previous);
+        if (folded) {
+            previous->activation = layer->activation;
+        }
+
+        /* A model keeps at least its last layer */
+        if ((identity || folded) && (kept > 0 || i + 1 < model->numLayers)) {
+            continue;
+        }
+
+        if (kept != i) {
+            model->layers[kept] = *layer;
+        }
+        kept++;
+    }
+
+    memset(&model->layers[kept], 0, (size_t)(model->numLayers - kept) * sizeof(Layer));
+    model->numLayers = kept;
+}
+
+/**
+ * Fuse each pooling layer into the blocked layer before it
+ *
+ * The blocked kernels already apply their layer's activation to each row
+ * while it is in cache; an unpadded pooling layer that follows can run in
+ * the same pass, so the unpooled map is never stored.
+ */
+static void fuseLayers(TinyAIImageModel *model)
+{
+    for (int i = 0; i + 1 < model->numLayers; i++) {
+        Layer       *layer = &model->layers[i];
+        const Layer *next  = &model->layers[i + 1];
+
+        layer->fusePooling = layer->blockedWeights && next->type == LAYER_TYPE_POOLING &&
+                             next->padding == 0 && next->activation == ACTIVATION_NONE &&
+                             next->kernelSize <= layer->outputWidth &&
+                             next->kernelSize <= layer->outputHeight;
+    }
+}
+
+/* 4-bit weight at element index i of a packed array, low nibble first (8 is zero) */
+static int weightNibble(const uint8_t *weights, size_t i)
+{
+    return i % 2 == 0 ? weights[i / 2] & 0x0F : weights[i / 2] >> 4;
+}
+
+static void setWeightNibble(uint8_t *weights, size_t i, int nibble)
+{
+    if (i % 2 == 0) {
+        weights[i / 2] = (uint8_t)((weights[i / 2] & 0xF0) | nibble);
+    }
+    else {
+        weights[i / 2] = (uint8_t)((weights[i / 2] & 0x0F) | (nibble << 4));
+    }
+}
+
+/**
+ * Build CSR weights for a convolution layer pruned past SPARSE_CONV_MIN_SPARSITY
+ *
+ * Row oc holds filter oc dequantized, with columns in im2col order
+ * (kh, kw, ic); returns NULL for layers that are dense enough to run the
+ * regular kernels.
+ */
+static TinyAICSRMatrix *createSparseConvWeights(const Layer *layer)
+{
+    int    taps       = layer->kernelSize * layer->kernelSize;
+    int    patchSize  = taps * layer->inputChannels;
+    size_t numWeights = (size_t)patchSize * layer->outputChannels;
+    size_t zeros      = 0;
+
+    for (size_t i = 0; i < numWeights; i++) {
+        zeros += weightNibble(layer->weights, i) == 8;
+    }
+    if ((float)zeros < SPARSE_CONV_MIN_SPARSITY * (float)numWeights) {
+        return NULL;
+    }
+
+    /* Weights are stored [kh][kw][inChannel][outChannel] */
+    float *filters = (float *)malloc(numWeights * sizeof(float));
+    if (!filters) {
+        return NULL;
+    }
+    for (int k = 0; k < patchSize; k++) {
+        for (int oc = 0; oc < layer->outputChannels; oc++) {
+            size_t index = (size_t)k * layer->outputChannels + oc;
+            filters[(size_t)oc * patchSize + k] =
+                (float)(weightNibble(layer->weights, index) - 8) * layer->scales[oc];
+        }
+    }
+
+    TinyAICSRMatrix *csr =
+        tinyaiCreateCSRMatrixFromDense(filters, layer->outputChannels, patchSize, FLT_MIN);
+    free(filters);
+    return csr;
+}
+
+/**
+ * Prepare the SIMD kernels of every convolution layer with weights
+ *
+ * Convolution layers pruned past SPARSE_CONV_MIN_SPARSITY get CSR weights.
+ * Other convolution and depthwise (multiplier 1) layers get weights for the
+ * channel-blocked layout; a convolution layer that cannot be packed gets a
+ * plan for its algorithm instead.
+ */
+static void prepareSimdKernels(TinyAIImageModel *model)
+{
+    for (int i = 0; i < model->numLayers; i++) {
+        Layer *layer = &model->layers[i];
+        if (!layer->weights || !layer->scales || layer->blockedWeights || layer->convPlan ||
+            layer->sparseWeights) {
+            continue;
+        }
+
+        if (layer->type == LAYER_TYPE_CONV) {
+            layer->sparseWeights = createSparseConvWeights(layer);
+            if (layer->sparseWeights) {
+                continue;
+            }
+
+            layer->blockedWeights =
+                tinyaiSimdPackBlockedConvWeights(layer->weights, layer->scales,
+                                                 layer->inputChannels, layer->outputChannels,
+                                                 layer->kernelSize);
+            if (layer->blockedWeights) {
+                continue;
+            }
+
+            /* Without a plan the forward pass prepares the weights on every call */
+            layer->convPlan = tinyaiSimdCreateConvPlan(
+                layer->weights, layer->scales, layer->inputWidth, layer->inputHeight,
+                layer->inputChannels, layer->outputWidth, layer->outputHeight,
+                layer->outputChannels, layer->kernelSize, layer->stride, layer->padding,
+                TINYAI_SIMD_CONV_AUTO);
+        }
+        else if (layer->type == LAYER_TYPE_DEPTHWISE &&
+                 layer->outputChannels == layer->inputChannels) {
+            layer->blockedWeights = tinyaiSimdPackBlockedDepthwiseWeights(
+                layer->weights, layer->scales, layer->inputChannels, layer->kernelSize);
+        }
+    }
+
+    fuseLayers(model);
+}
+
+/**
+ * Free the prepared SIMD kernels of all layers
+ */
+static void releaseSimdKernels(TinyAIImageModel *model)
+{
+    for (int i = 0; i < model->numLayers; i++) {
+        tinyaiSimdDestroyConvPlan(model->layers[i].convPlan);
+        free(model->layers[i].blockedWeights);
+        tinyaiCSRMatrixFree(model->layers[i].sparseWeights);
+        model->layers[i].convPlan       = NULL;
+        model->layers[i].blockedWeights = NULL;
+        model->layers[i].sparseWeights  = NULL;
+        model->layers[i].fusePooling    = false;
+    }
+}
+
+/**
+ * Whether a channel with all-zero input still outputs zero after a layer's bias and activation
+ */
+static bool channelStaysZero(const Layer *layer, int channel)
+{
+    float bias = layer->biases ? layer->biases[channel] : 0.0f;
+
+    switch (layer->activation) {
+    case ACTIVATION_RELU:
+        return bias <= 0.0f;
+    case ACTIVATION_NONE:
+    case ACTIVATION_TANH:
+        return bias == 0.0f;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Find the layer that mixes the output channels of a convolution
+ *
+ * Pooling, dropout and depthwise (multiplier 1) layers in between keep the
+ * channels apart. Returns the index of the next convolution, or of the dense
+ * layer after a flatten, or -1 if the channels cannot be remapped.
+ */
+static int channelConsumer(const TinyAIImageModel *model, int index)
+{
+    for (int i = index + 1; i < model->numLayers; i++) {
+        const Layer *layer = &model->layers[i];
+
+        switch (layer->type) {
+        case LAYER_TYPE_POOLING:
+        case LAYER_TYPE_DROPOUT:
+            break;
+
+        case LAYER_TYPE_DEPTHWISE:
+            if (!layer->weights || !layer->scales ||
+                layer->outputChannels != layer->inputChannels) {
+                return -1;
+            }
+            break;
+
+        case LAYER_TYPE_CONV:
+            return layer->weights && layer->scales ? i : -1;
+
+        case LAYER_TYPE_FLATTEN:
+            for (int j = i + 1; j < model->numLayers; j++) {
+                if (model->layers[j].type != LAYER_TYPE_DROPOUT) {
+                    return model->layers[j].type == LAYER_TYPE_DENSE && model->layers[j].weights
+                               ? j
+                               : -1;
+                }
+            }
+            return -1;
+
+        default:
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Drop entries along one axis of a 4-bit [outer][axis][inner] array in place
+ *
+ * Rows of the outer dimension start every oldStride nibbles before and
+ * every newStride nibbles after. Entries only move towards the start, so
+ * each is read before its nibble can be overwritten.
+ */
+static void compactWeights(uint8_t *weights, size_t outer, size_t oldStride, size_t newStride,
+                           int axis, size_t inner, const bool *keep)
+{
+    for (size_t o = 0; o < outer; o++) {
+        size_t to = o * newStride;
+        for (int a = 0; a < axis; a++) {
+            if (!keep[a]) {
+                continue;
+            }
+            for (size_t i = 0; i < inner; i++) {
+                setWeightNibble(weights, to++,
+                                weightNibble(weights, o * oldStride + (size_t)a * inner + i));
+            }
+        }
+
+        /* A row padded to whole bytes pads with a zero weight */
+        if (to < (o + 1) * newStride) {
+            setWeightNibble(weights, to, 8);
+        }
+    }
+}
+
+/* Drop the entries of a per-channel array in place */
+static void compactChannels(float *values, int channels, const bool *keep)
+{
+    if (!values) {
+        return;
+    }
+
+    int kept = 0;
+    for (int c = 0; c < channels; c++) {
+        if (keep[c]) {
+            values[kept++] = values[c];
+        }
+    }
+}
+
+/* Set the channel count a layer outputs, and the memory it needs */
+static void setOutputChannels(Layer *layer, int channels)
+{
+    layer->outputChannels = channels;
+    layer->outputBytes =
+        (size_t)layer->outputWidth * layer->outputHeight * channels * sizeof(float);
+    if (layer->biases) {
+        layer->biasBytes = channels * sizeof(float);
+    }
+}
+
+/**
+ * Remove the output channels of convolution layer index that keep leaves out
+ *
+ * Every layer up to consumer shrinks with them, and consumer drops the
+ * matching input channels.
+ */
+static bool removeChannels(TinyAIImageModel *model, int index, int consumer, const bool *keep,
+                           int kept)
+{
+    Layer *conv     = &model->layers[index];
+    int    channels = conv->outputChannels;
+    size_t taps     = (size_t)conv->kernelSize * conv->kernelSize;
+
+    /* [kh][kw][inChannel][outChannel] loses output channels */
+    compactWeights(conv->weights, taps * conv->inputChannels, channels, kept, channels, 1, keep);
+    compactChannels(conv->biases, channels, keep);
+    compactChannels(conv->scales, channels, keep);
+    conv->weightBytes = (taps * conv->inputChannels * kept + 1) / 2;
+    setOutputChannels(conv, kept);
+
+    for (int i = index + 1; i <= consumer; i++) {
+        Layer *layer = &model->layers[i];
+        taps         = (size_t)layer->kernelSize * layer->kernelSize;
+
+        switch (layer->type) {
+        case LAYER_TYPE_POOLING:
+        case LAYER_TYPE_DROPOUT:
+            layer->inputChannels = kept;
+            setOutputChannels(layer, kept);
+            break;
+
+        case LAYER_TYPE_DEPTHWISE:
+            /* [kh][kw][channel] */
+            compactWeights(layer->weights, taps, channels, kept, channels, 1, keep);
+            compactChannels(layer->biases, channels, keep);
+            compactChannels(layer->scales, channels, keep);
+            layer->weightBytes   = (taps * kept + 1) / 2;
+            layer->inputChannels = kept;
+            setOutputChannels(layer, kept);
+            break;
+
+        case LAYER_TYPE_CONV:
+            /* [kh][kw][inChannel][outChannel] loses input channels */
+            compactWeights(layer->weights, taps, (size_t)channels * layer->outputChannels,
+                           (size_t)kept * layer->outputChannels, channels, layer->outputChannels,
+                           keep);
+            layer->weightBytes   = (taps * kept * layer->outputChannels + 1) / 2;
+            layer->inputChannels = kept;
+            return true;
+
+        case LAYER_TYPE_FLATTEN: {
+            /* The dense layer reads the flattened map at (h * width + w) * channels + c */
+            Layer *dense   = &model->layers[consumer];
+            int    oldCols = dense->inputWidth;
+            int    newCols = layer->inputWidth * layer->inputHeight * kept;
+            bool  *colKeep = (bool *)malloc(oldCols * sizeof(bool));
+            if (!colKeep) {
+                return false;
+            }
+            for (int col = 0; col < oldCols; col++) {
+                colKeep[col] = keep[col % channels];
+            }
+
+            /* Dense rows are padded to whole bytes */
+            compactWeights(dense->weights, dense->outputWidth, (size_t)(oldCols + 1) / 2 * 2,
+                           (size_t)(newCols + 1) / 2 * 2, oldCols, 1, colKeep);
+            free(colKeep);
+
+            dense->inputWidth  = newCols;
+            dense->weightBytes = ((size_t)newCols * dense->outputWidth + 1) / 2;
+            layer->inputChannels = kept;
+            layer->outputWidth   = newCols;
+            layer->outputBytes   = (size_t)newCols * sizeof(float);
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    return false;
+}
+
 /**
  * Initialize a convolutional layer
  */
@@ -690,12 +1143,16 @@ TinyAIImageModel *tinyaiImageModelCreate(const TinyAIImageModelParams *params)
         return NULL;
     }
 
+    TinyAIImageModel *model = NULL;
+
     switch (params->modelType) {
     case TINYAI_IMAGE_MODEL_MOBILENET:
-        return createMobileNetModel(params);
+        model = createMobileNetModel(params);
+        break;
 
     case TINYAI_IMAGE_MODEL_TINY_CNN:
-        return createTinyCNNModel(params);
+        model = createTinyCNNModel(params);
+        break;
 
     case TINYAI_IMAGE_MODEL_EFFICIENTNET:
         /* Not yet implemented */
@@ -711,6 +1168,18 @@ TinyAIImageModel *tinyaiImageModelCreate(const TinyAIImageModelParams *params)
         fprintf(stderr, "Unknown model type\n");
         return NULL;
     }
+
+    if (model) {
+        optimizeGraph(model);
+    }
+
+    /* Size the forward pass buffers once, for the largest activation of any layer */
+    if (model && !tinyaiImageModelPrepareWorkspace(model, 1)) {
+        tinyaiImageModelFree(model);
+        return NULL;
+    }
+
+    return model;
 }
 
 /**
@@ -733,6 +1202,11 @@ void tinyaiImageModelFree(TinyAIImageModel *model)
         free(model->labels);
     }
 
+    releaseSimdKernels(model);
+    tinyaiImageModelReleaseInt8(model);
+    tinyaiImageModelReleaseExits(model);
+    free(model->workspace);
+
     /* Free memory pool if we own it */
     if (model->memoryPool && !model->useExternalMemory) {
         tinyaiMemoryPoolFree(model->memoryPool);
@@ -743,78 +1217,26 @@ void tinyaiImageModelFree(TinyAIImageModel *model)
 }
 
 /**
- * Classify an image using the model
- * @param model The model to use for classification
- * @param image The image to classify
- * @param topK Number of top results to return
- * @param results Array to store results (must be pre-allocated for topK results)
- * @return Number of results on success, negative on failure
+ * Preprocess an image into the model's float input layout
  */
-int tinyaiImageModelClassify(TinyAIImageModel *model, const TinyAIImage *image, int topK,
-                             TinyAIImageClassResult *results)
+static bool imageToInput(const TinyAIImageModel *model, const TinyAIImage *image, float *input)
 {
-    if (!model || !image || !results || topK <= 0) {
-        return -1;
-    }
-
-    /* Convert image to float array compatible with model input */
-    float *imageData = (float *)malloc(model->inputWidth * model->inputHeight *
-                                       model->inputChannels * sizeof(float));
-    if (!imageData) {
-        fprintf(stderr, "Failed to allocate memory for image data\n");
-        return -1;
-    }
-
-    /* Preprocess image if needed */
-    TinyAIImage *preprocessedImage = tinyaiImagePreprocess(image, &model->preprocess);
-    if (!preprocessedImage) {
+    if (!tinyaiImagePreprocessToTensor(image, &model->preprocess, model->inputChannels, input)) {
         fprintf(stderr, "Failed to preprocess image\n");
-        free(imageData);
-        return -1;
-    }
-
-    /* Convert image to float array */
-    if (!tinyaiImageToFloatArray(preprocessedImage, imageData, true)) {
-        fprintf(stderr, "Failed to convert image to float array\n");
-        tinyaiImageFree(preprocessedImage);
-        free(imageData);
-        return -1;
-    }
-
-    /* If we created a new image for preprocessing, free it */
-    if (preprocessedImage != image) {
-        tinyaiImageFree(preprocessedImage);
-    }
-
-    /* Allocate memory for model output */
-    float *outputData = (float *)malloc(model->numClasses * sizeof(float));
-    if (!outputData) {
-        fprintf(stderr, "Failed to allocate memory for model output\n");
-        free(imageData);
-        return -1;
-    }
-
-    /* Run forward pass */
-    if (!tinyaiImageModelForwardPass(model, imageData, outputData)) {
-        fprintf(stderr, "Forward pass failed\n");
-        free(outputData);
-        free(imageData);
-        return -1;
-    }
-
-    /* Copy results to the provided array */
-    /* For now, we're just taking the raw output values as confidences */
-    /* In a real implementation, you might want to apply softmax here */
-
-    /* Create array of indices for sorting */
-    int *indices = (int *)malloc(model->numClasses * sizeof(int));
-    if (!indices) {
-        fprintf(stderr, "Failed to allocate memory for sorting indices\n");
-        free(outputData);
-        free(imageData);
-        return -1;
+        return false;
     }
+    return true;
+}
 
+/**
+ * Fill the top results of one image from its model output
+ *
+ * For now, the raw output values are taken as confidences; a real
+ * implementation might apply softmax first.
+ */
+static void fillTopResults(const TinyAIImageModel *model, const float *outputData, int *indices,
+                           int numResults, TinyAIImageClassResult *results)
+{
     /* Initialize indices */
     for (int i = 0; i < model->numClasses; i++) {
         indices[i] = i;
@@ -833,7 +1255,6 @@ int tinyaiImageModelClassify(TinyAIImageModel *model, const TinyAIImage *image,
     }
 
     /* Fill in results with top-K classes */
-    int numResults = (topK < model->numClasses) ? topK : model->numClasses;
     for (int i = 0; i < numResults; i++) {
         int classIdx          = indices[i];
         results[i].classId    = classIdx;
@@ -841,6 +1262,86 @@ int tinyaiImageModelClassify(TinyAIImageModel *model, const TinyAIImage *image,
         results[i].label =
             (model->labels && classIdx < model->numLabels) ? model->labels[classIdx] : NULL;
     }
+}
+
+/**
+ * Classify an image using the model
+ * @param model The model to use for classification
+ * @param image The image to classify
+ * @param topK Number of top results to return
+ * @param results Array to store results (must be pre-allocated for topK results)
+ * @return Number of results on success, negative on failure
+ */
+int tinyaiImageModelClassify(TinyAIImageModel *model, const TinyAIImage *image, int topK,
+                             TinyAIImageClassResult *results)
+{
+    if (!image) {
+        return -1;
+    }
+    return tinyaiImageModelClassifyBatch(model, &image, 1, topK, results);
+}
+
+/**
+ * Classify a batch of images using the model
+ * @param model The model to use for classification
+ * @param images The images to classify
+ * @param numImages Number of images
+ * @param topK Number of top results to return per image
+ * @param results Array of numImages * topK results; image i's start at results[i * topK]
+ * @return Number of results per image on success, negative on failure
+ */
+int tinyaiImageModelClassifyBatch(TinyAIImageModel *model, const TinyAIImage *const *images,
+                                  int numImages, int topK, TinyAIImageClassResult *results)
+{
+    if (!model || !images || numImages <= 0 || !results || topK <= 0) {
+        return -1;
+    }
+    for (int i = 0; i < numImages; i++) {
+        if (!images[i]) {
+            return -1;
+        }
+    }
+
+    /* Larger batches run in chunks, which bounds the workspace */
+    int chunk = numImages < TINYAI_IMAGE_MAX_BATCH ? numImages : TINYAI_IMAGE_MAX_BATCH;
+    if (!model->arena && !tinyaiImageModelPrepareWorkspace(model, chunk)) {
+        return -1;
+    }
+
+    size_t inputSize  = (size_t)model->inputWidth * model->inputHeight * model->inputChannels;
+    float *imageData  = (float *)malloc(chunk * inputSize * sizeof(float));
+    float *outputData = (float *)malloc((size_t)chunk * model->numClasses * sizeof(float));
+    int   *indices    = (int *)malloc(model->numClasses * sizeof(int));
+    if (!imageData || !outputData || !indices) {
+        fprintf(stderr, "Failed to allocate memory for classification\n");
+        free(indices);
+        free(outputData);
+        free(imageData);
+        return -1;
+    }
+
+    int numResults = (topK < model->numClasses) ? topK : model->numClasses;
+    for (int first = 0; first < numImages && numResults >= 0; first += chunk) {
+        int count = numImages - first < chunk ? numImages - first : chunk;
+
+        /* Convert each image to float array compatible with model input */
+        for (int n = 0; n < count && numResults >= 0; n++) {
+            if (!imageToInput(model, images[first + n], imageData + n * inputSize)) {
+                numResults = -1;
+            }
+        }
+
+        /* Run every layer over the whole chunk */
+        if (numResults >= 0 && !tinyaiImageModelForwardBatch(model, imageData, count, outputData)) {
+            fprintf(stderr, "Forward pass failed\n");
+            numResults = -1;
+        }
+
+        for (int n = 0; n < count && numResults >= 0; n++) {
+            fillTopResults(model, outputData + (size_t)n * model->numClasses, indices, numResults,
+                           results + (size_t)(first + n) * topK);
+        }
+    }
 
     /* Free allocated memory */
     free(indices);
@@ -873,6 +1374,236 @@ bool tinyaiImageModelSetMemoryPool(TinyAIImageModel *model, void *memoryPool)
     return true;
 }
 
+/**
+ * Set an arena for the temporaries of each forward pass
+ * @param model The model to configure
+ * @param arena Arena to use, or NULL to use the model's workspace again
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetArena(TinyAIImageModel *model, TinyAIArena *arena)
+{
+    if (!model) {
+        return false;
+    }
+
+    model->arena = arena;
+    return true;
+}
+
+/**
+ * Choose how the model's forward passes use threads
+ * @param model The model to configure
+ * @param enable Whether to use threads at all
+ * @param pool Pool to run on, or NULL for the shared pool
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetThreading(TinyAIImageModel *model, bool enable, TinyAIThreadPool *pool)
+{
+    if (!model) {
+        return false;
+    }
+
+    model->serial     = !enable;
+    model->threadPool = enable ? pool : NULL;
+    return true;
+}
+
+/**
+ * Calibrate the scales of int8 activations on representative images
+ * @param model The model to calibrate
+ * @param images Representative images
+ * @param numImages Number of images
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelCalibrateActivations(TinyAIImageModel *model,
+                                          const TinyAIImage *const *images, int numImages)
+{
+    if (!model || !images || numImages <= 0 || model->numLayers <= 0) {
+        return false;
+    }
+
+    /* Calibration passes run in floats, in a workspace sized for them */
+    bool int8              = model->int8Activations;
+    model->int8Activations = false;
+    bool success           = tinyaiImageModelPrepareWorkspace(model, 1);
+
+    size_t inputSize  = (size_t)model->inputWidth * model->inputHeight * model->inputChannels;
+    size_t outputSize = (size_t)model->layers[model->numLayers - 1].outputWidth;
+    float *input      = (float *)malloc(inputSize * sizeof(float));
+    float *output     = (float *)malloc(outputSize * sizeof(float));
+    float *ranges     = (float *)calloc(model->numLayers, sizeof(float));
+    if (!input || !output || !ranges) {
+        fprintf(stderr, "Failed to allocate memory for calibration\n");
+        success = false;
+    }
+
+    float inputRange = 0.0f;
+    for (int i = 0; i < numImages && success; i++) {
+        success = images[i] && imageToInput(model, images[i], input) &&
+                  tinyaiImageModelForwardRanges(model, input, output, ranges);
+        if (success) {
+            float min = FLT_MAX, max = -FLT_MAX;
+            tinyaiSimdMinMax(input, (int)inputSize, &min, &max);
+            inputRange = fmaxf(inputRange, fmaxf(max, -min));
+        }
+    }
+
+    if (success) {
+        /* A layer that only output zeros keeps a scale it can divide by */
+        model->inputScale = inputRange > 0.0f ? inputRange / 127.0f : 1.0f;
+        for (int l = 0; l < model->numLayers; l++) {
+            model->layers[l].outputScale = ranges[l] > 0.0f ? ranges[l] / 127.0f : 1.0f;
+        }
+        model->calibrated = true;
+    }
+
+    free(ranges);
+    free(output);
+    free(input);
+
+    /* Back in int8, the slots and scratch take the int8 layout again */
+    model->int8Activations = int8;
+    success                = tinyaiImageModelPrepareWorkspace(model, 1) && success;
+
+    /* The energy profile runs in int8 whenever the model can */
+    if (success && !int8 && tinyaiGetExecutionProfile() == TINYAI_PROFILE_ENERGY) {
+        tinyaiImageModelEnableInt8Activations(model, true);
+    }
+    return success;
+}
+
+/**
+ * Calibrate the thresholds of a model's early-exit heads on representative images
+ * @param model The model with exit heads attached
+ * @param images Representative images
+ * @param numImages Number of images
+ * @param agreement Fraction of exited images whose top class must match the full model
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelCalibrateExits(TinyAIImageModel *model, const TinyAIImage *const *images,
+                                    int numImages, float agreement)
+{
+    if (!model || !images || numImages <= 0 || !model->exits || model->numLayers <= 0 ||
+        !(agreement >= 0.0f && agreement <= 1.0f)) {
+        return false;
+    }
+
+    /* Probing passes run in floats, like activation calibration */
+    bool int8              = model->int8Activations;
+    model->int8Activations = false;
+    bool success           = tinyaiImageModelPrepareWorkspace(model, 1);
+
+    size_t inputSize  = (size_t)model->inputWidth * model->inputHeight * model->inputChannels;
+    size_t probes     = (size_t)numImages * model->numLayers;
+    float *input      = (float *)malloc(inputSize * sizeof(float));
+    float *output     = (float *)malloc(model->numClasses * sizeof(float));
+    float *confidence = (float *)malloc(probes * sizeof(float));
+    int   *classes    = (int *)malloc(probes * sizeof(int));
+    int   *expected   = (int *)malloc(numImages * sizeof(int));
+    if (!input || !output || !confidence || !classes || !expected) {
+        fprintf(stderr, "Failed to allocate memory for calibration\n");
+        success = false;
+    }
+
+    for (int i = 0; i < numImages && success; i++) {
+        size_t offset = (size_t)i * model->numLayers;
+        success       = images[i] && imageToInput(model, images[i], input) &&
+                  tinyaiImageModelForwardExits(model, input, output, confidence + offset,
+                                               classes + offset);
+        if (success) {
+            expected[i] = tinyaiSimdArgmax(output, model->numClasses);
+        }
+    }
+
+    if (success) {
+        success = tinyaiImageModelFitExitThresholds(model, confidence, classes, expected,
+                                                    numImages, agreement);
+    }
+
+    free(expected);
+    free(classes);
+    free(confidence);
+    free(output);
+    free(input);
+
+    model->int8Activations = int8;
+    return tinyaiImageModelPrepareWorkspace(model, 1) && success;
+}
+
+/**
+ * Pass int8 tensors between layers instead of floats
+ * @param model The model to configure
+ * @param enable Whether to use int8 activations
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelEnableInt8Activations(TinyAIImageModel *model, bool enable)
+{
+    if (!model) {
+        return false;
+    }
+
+    if (!enable) {
+        model->int8Activations = false;
+        tinyaiImageModelReleaseInt8(model);
+        return tinyaiImageModelPrepareWorkspace(model, 1);
+    }
+
+    if (!model->calibrated) {
+        fprintf(stderr, "Int8 activations need calibrated scales\n");
+        return false;
+    }
+    if (!tinyaiImageModelPrepareInt8(model)) {
+        return false;
+    }
+
+    /* The workspace only grows, so drop the float one to get the smaller int8 layout */
+    int batch              = model->workspaceBatch;
+    model->int8Activations = true;
+    free(model->workspace);
+    model->workspace       = NULL;
+    model->workspaceFloats = 0;
+    model->workspaceBatch  = 0;
+    if (!tinyaiImageModelPrepareWorkspace(model, batch)) {
+        tinyaiImageModelEnableInt8Activations(model, false);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Stream a model's layer weights through a progressive loader
+ * @param model The model to configure
+ * @param loader Loader with a layer of matching size for every layer with weights
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetProgressiveLoader(TinyAIImageModel *model, TinyAIProgressiveLoader *loader)
+{
+    if (!model || !loader) {
+        return false;
+    }
+
+    for (int i = 0; i < model->numLayers; i++) {
+        const Layer *layer = &model->layers[i];
+        if (layer->weightBytes > 0 && ((size_t)i >= loader->num_layers ||
+                                       loader->layers[i].memory_usage != layer->weightBytes)) {
+            return false;
+        }
+    }
+
+    /* Prepared kernels hold transformed copies of the weights */
+    releaseSimdKernels(model);
+    if (model->int8Activations) {
+        tinyaiImageModelEnableInt8Activations(model, false);
+    }
+    for (int i = 0; i < model->numLayers; i++) {
+        model->layers[i].weights = NULL;
+    }
+    model->loader = loader;
+
+    return true;
+}
+
 /**
  * Enable or disable SIMD acceleration
  * @param model The model to configure
@@ -887,6 +1618,14 @@ bool tinyaiImageModelEnableSIMD(TinyAIImageModel *model, bool enable)
 
     model->useSIMD = enable;
 
+    /* Prepared kernels only serve the SIMD path */
+    if (enable) {
+        prepareSimdKernels(model);
+    }
+    else {
+        releaseSimdKernels(model);
+    }
+
     /* If using our own memory pool, update it */
     if (model->memoryPool && !model->useExternalMemory) {
         tinyaiMemoryPoolUpdateSIMD(model->memoryPool, enable);
@@ -895,6 +1634,84 @@ bool tinyaiImageModelEnableSIMD(TinyAIImageModel *model, bool enable)
     return true;
 }
 
+/**
+ * Physically remove pruned filters from the model's convolution layers
+ */
+int tinyaiImageModelRemovePrunedFilters(TinyAIImageModel *model)
+{
+    if (!model) {
+        return -1;
+    }
+
+    /* Prepared kernels are rebuilt for the new shapes */
+    releaseSimdKernels(model);
+
+    int removed = 0;
+    for (int l = 0; l < model->numLayers && removed >= 0; l++) {
+        Layer *layer    = &model->layers[l];
+        int    consumer = layer->type == LAYER_TYPE_CONV && layer->weights && layer->scales
+                              ? channelConsumer(model, l)
+                              : -1;
+        if (consumer < 0) {
+            continue;
+        }
+
+        int    channels = layer->outputChannels;
+        size_t filter   = (size_t)layer->kernelSize * layer->kernelSize * layer->inputChannels;
+        bool  *keep     = (bool *)malloc(channels * sizeof(bool));
+        if (!keep) {
+            removed = -1;
+            break;
+        }
+
+        /* A filter goes if it outputs zero and every layer up to its reader keeps it zero */
+        int kept = 0;
+        for (int c = 0; c < channels; c++) {
+            bool zero = channelStaysZero(layer, c);
+            for (size_t k = 0; k < filter && zero; k++) {
+                zero = weightNibble(layer->weights, k * channels + c) == 8;
+            }
+            for (int i = l + 1; i < consumer && zero; i++) {
+                zero = model->layers[i].type != LAYER_TYPE_DEPTHWISE ||
+                       channelStaysZero(&model->layers[i], c);
+            }
+            keep[c] = !zero;
+            kept += keep[c];
+        }
+
+        /* A layer keeps at least one channel */
+        if (kept == 0) {
+            keep[0] = true;
+            kept    = 1;
+        }
+
+        if (kept < channels) {
+            if (removeChannels(model, l, consumer, keep, kept)) {
+                removed += channels - kept;
+            }
+            else {
+                removed = -1;
+            }
+        }
+        free(keep);
+    }
+
+    if (model->useSIMD) {
+        prepareSimdKernels(model);
+    }
+    if (model->int8Activations && !tinyaiImageModelPrepareInt8(model)) {
+        tinyaiImageModelEnableInt8Activations(model, false);
+        return -1;
+    }
+
+    /* The shapes changed; a workspace that already fits is kept */
+    if (!tinyaiImageModelPrepareWorkspace(model, 1)) {
+        return -1;
+    }
+
+    return removed;
+}
+
 /**
  * Get memory usage statistics
  * @param model The model to query
@@ -923,6 +1740,11 @@ bool tinyaiImageModelGetMemoryUsage(const TinyAIImageModel *model, size_t *weigh
         }
     }
 
+    /* Int8 activations take a byte per value */
+    if (model->int8Activations) {
+        maxActivationBytes /= sizeof(float);
+    }
+
     *weightMemory     = totalWeightBytes;
     *activationMemory = maxActivationBytes;
 
@@ -946,6 +1768,21 @@ bool tinyaiImageModelGetPreprocessParams(const TinyAIImageModel      *model,
     return true;
 }
 
+/**
+ * Get the label of a class
+ * @param model The model to query
+ * @param classId Class ID
+ * @return Class label, or NULL if the model has none for the class
+ */
+const char *tinyaiImageModelGetLabel(const TinyAIImageModel *model, int classId)
+{
+    if (!model || !model->labels || classId < 0 || classId >= model->numLabels) {
+        return NULL;
+    }
+
+    return model->labels[classId];
+}
+
 /**
  * Forward pass function declaration - implemented in forward_pass.c
  */
@@ -6,6 +6,8 @@
 #ifndef TINYAI_IMAGE_MODEL_H
 #define TINYAI_IMAGE_MODEL_H
 
+#include "../../utils/arena.h"
+#include "../../utils/thread_pool.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -14,6 +16,14 @@
 extern "C" {
 #endif
 
+/* Progressive loader from utils/progressive_loader.h, which models stream weights through */
+struct TinyAIProgressiveLoader;
+
+/**
+ * Most images a batched classification runs through the model at once
+ */
+#define TINYAI_IMAGE_MAX_BATCH 8
+
 /**
  * Image format enumeration
  */
@@ -106,6 +116,10 @@ void tinyaiImageModelFree(TinyAIImageModel *model);
 
 /**
  * Classify an image
+ *
+ * Fails before the next layer once the cancellation token installed on the
+ * calling thread (see cancel.h) fires; so do the batched, tiled and int8
+ * forward passes.
  * @param model The model to use for classification
  * @param image The image to classify
  * @param topK Number of top results to return
@@ -115,6 +129,24 @@ void tinyaiImageModelFree(TinyAIImageModel *model);
 int tinyaiImageModelClassify(TinyAIImageModel *model, const TinyAIImage *image, int topK,
                              TinyAIImageClassResult *results);
 
+/**
+ * Classify a batch of images
+ *
+ * Each layer runs over the whole batch before the next one, so its weights
+ * are loaded once per batch rather than once per image, and dense layers
+ * become one matrix-matrix product. Batches larger than
+ * TINYAI_IMAGE_MAX_BATCH run in chunks of that size.
+ *
+ * @param model The model to use for classification
+ * @param images The images to classify
+ * @param numImages Number of images
+ * @param topK Number of top results to return per image
+ * @param results Array of numImages * topK results; image i's start at results[i * topK]
+ * @return Number of results per image on success, negative on failure
+ */
+int tinyaiImageModelClassifyBatch(TinyAIImageModel *model, const TinyAIImage *const *images,
+                                  int numImages, int topK, TinyAIImageClassResult *results);
+
 /**
  * Set custom memory pool for model
  * @param model The model to set memory pool for
@@ -123,6 +155,168 @@ int tinyaiImageModelClassify(TinyAIImageModel *model, const TinyAIImage *image,
  */
 bool tinyaiImageModelSetMemoryPool(TinyAIImageModel *model, void *memoryPool);
 
+/**
+ * Set an arena for the temporaries of each forward pass
+ *
+ * By default every pass runs in a workspace the model sizes at creation, so
+ * one model runs one pass at a time. With an arena, each pass takes its
+ * activation buffers from a scope of the arena and releases them on return.
+ * @param model The model to configure
+ * @param arena Arena to use, or NULL to use the model's workspace again
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetArena(TinyAIImageModel *model, TinyAIArena *arena);
+
+/**
+ * Choose how the model's forward passes use threads
+ *
+ * Threaded passes split convolutions into bands of output rows and dense
+ * layers into ranges of output rows across the pool's workers; the blocked,
+ * Winograd, GEMM and sparse kernels split their own work the same way. By
+ * default the shared pool from tinyaiGetThreadPool is used, so the
+ * "system.threads" configuration key applies. Outputs do not depend on the
+ * number of threads.
+ * @param model The model to configure
+ * @param enable Whether to use threads at all
+ * @param pool Pool to run on, or NULL for the shared pool; must outlive its use
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetThreading(TinyAIImageModel *model, bool enable, TinyAIThreadPool *pool);
+
+/**
+ * Get the size of the feature map tiled inference produces for an input size
+ * @param model The model to query
+ * @param width Input width in pixels
+ * @param height Input height in pixels
+ * @param outWidth Output parameter for the feature map width
+ * @param outHeight Output parameter for the feature map height
+ * @param outChannels Output parameter for the feature map channels
+ * @return true on success, false if the model has no trunk or the input is too small
+ */
+bool tinyaiImageModelGetTiledOutputSize(const TinyAIImageModel *model, int width, int height,
+                                        int *outWidth, int *outHeight, int *outChannels);
+
+/**
+ * Run the model's convolutional trunk over an input of any size, tile by tile
+ *
+ * The trunk is the leading run of convolution, depthwise and pooling layers,
+ * up to the first flatten, dense or global pooling layer; the classifier
+ * behind it only fits the model's own input size. The output feature map is
+ * cut into square tiles, and each tile runs on just the region of the input
+ * its receptive field covers, so the result equals running the trunk on the
+ * whole image while a tile only needs memory for its own region. Tiles run
+ * side by side on the model's threads, each with its own buffers. Runs in
+ * floats even with int8 activations enabled.
+ * @param model The model to use
+ * @param input Preprocessed input, height x width x the model's input channels
+ * @param width Input width in pixels
+ * @param height Input height in pixels
+ * @param tileSize Side of an output tile, or 0 for the largest that fits the
+ *                 activation buffers of the model's own input size
+ * @param output Feature map of the size tinyaiImageModelGetTiledOutputSize reports
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardTiled(const TinyAIImageModel *model, const float *input, int width,
+                                  int height, int tileSize, float *output);
+
+/**
+ * Calibrate the scales of int8 activations on representative images
+ *
+ * Runs each image through the model in floats and records the largest
+ * magnitude every layer outputs; a layer's int8 scale maps that to 127.
+ * Calibrating again replaces the scales, including while int8 activations
+ * are enabled. Under the energy execution profile (see energy.h) a model
+ * that can run in int8 switches to int8 activations once calibrated.
+ * @param model The model to calibrate
+ * @param images Representative images
+ * @param numImages Number of images
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelCalibrateActivations(TinyAIImageModel *model,
+                                          const TinyAIImage *const *images, int numImages);
+
+/**
+ * Pass int8 tensors between layers instead of floats
+ *
+ * Convolution, depthwise and dense layers then multiply int8 activations by
+ * their 4-bit weights in integers and requantize their outputs to the
+ * calibrated scales, which quarters the activation memory and bandwidth at
+ * some cost in accuracy. Requires calibrated scales and weights held by the
+ * model (no progressive loader); only the last layer outputs floats.
+ * @param model The model to configure
+ * @param enable Whether to use int8 activations
+ * @return true on success, false if the model is not calibrated or cannot run in int8
+ */
+bool tinyaiImageModelEnableInt8Activations(TinyAIImageModel *model, bool enable);
+
+/**
+ * Stream a model's layer weights through a progressive loader
+ *
+ * Layer i of the loader holds the weights of model layer i. The forward
+ * pass requests each layer with weights before running it and releases it
+ * afterwards, so only the loader's memory budget of weights stays resident.
+ * The model stops using the weights it was given, and drops the SIMD
+ * kernels prepared from them; streamed layers run the 4-bit kernels. The
+ * loader must outlive the model, and serve one pass at a time.
+ * @param model The model to configure
+ * @param loader Loader with a layer of matching size for every layer with weights
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetProgressiveLoader(TinyAIImageModel               *model,
+                                          struct TinyAIProgressiveLoader *loader);
+
+/**
+ * Attach an early-exit head after a layer, or remove it
+ *
+ * The head averages the layer's output over its width and height and maps
+ * the channels to class scores with a dense layer. When the softmax of
+ * those scores reaches the threshold, the image stops there with the head's
+ * scores as its results, and the rest of its batch runs on. Heads attach to
+ * convolution, depthwise and pooling layers; a convolution whose pooling
+ * layer runs fused into it is checked after the pooling instead. Int8
+ * passes, activation calibration and the tiled pass run every layer, and a
+ * head whose layer changes width (pruned filters) is skipped.
+ * @param model The model to configure
+ * @param layerIndex Layer whose output the head reads
+ * @param weights Head weights [numClasses x layer output channels], copied; NULL removes the head
+ * @param biases Head biases [numClasses], copied (can be NULL)
+ * @param threshold Softmax confidence that stops an image (above 1: never)
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelSetExitHead(TinyAIImageModel *model, int layerIndex, const float *weights,
+                                 const float *biases, float threshold);
+
+/**
+ * Calibrate the thresholds of a model's early-exit heads on representative images
+ *
+ * Runs each image through every layer, recording each head's confidence
+ * and whether its top class matches the full model's. Each head then gets
+ * the lowest threshold at which the images it would have stopped agree at
+ * least the given fraction of the time, or a threshold above 1 if none does.
+ * @param model The model with exit heads attached
+ * @param images Representative images
+ * @param numImages Number of images
+ * @param agreement Fraction of exited images whose top class must match the full model (0 to 1)
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelCalibrateExits(TinyAIImageModel *model, const TinyAIImage *const *images,
+                                    int numImages, float agreement);
+
+/**
+ * Get how many images stopped at each layer's early-exit head
+ * @param model The model to query
+ * @param counts Receives one count per layer
+ * @param maxLayers Size of counts
+ * @return Number of counts written, negative on failure
+ */
+int tinyaiImageModelGetExitCounts(const TinyAIImageModel *model, uint64_t *counts, int maxLayers);
+
+/**
+ * Clear the early-exit counts of a model
+ * @param model The model
+ */
+void tinyaiImageModelResetExitCounts(TinyAIImageModel *model);
+
 /**
  * Enable or disable SIMD acceleration
  * @param model The model to configure
@@ -131,6 +325,20 @@ bool tinyaiImageModelSetMemoryPool(TinyAIImageModel *model, void *memoryPool);
  */
 bool tinyaiImageModelEnableSIMD(TinyAIImageModel *model, bool enable);
 
+/**
+ * Physically remove pruned filters from the model's convolution layers
+ *
+ * A filter whose weights are all zero, and whose output stays zero after
+ * its bias and activation, is dropped along with the matching input channel
+ * of the layer that reads it: the next convolution, or the dense layer after
+ * a flatten. Pooling, dropout and depthwise layers in between shrink with
+ * it. Call this after loading filter-pruned weights; outputs are unchanged.
+ *
+ * @param model The model to compact
+ * @return Number of filters removed, negative on failure
+ */
+int tinyaiImageModelRemovePrunedFilters(TinyAIImageModel *model);
+
 /**
  * Get memory usage statistics
  * @param model The model to query
@@ -150,6 +358,14 @@ bool tinyaiImageModelGetMemoryUsage(const TinyAIImageModel *model, size_t *weigh
 bool tinyaiImageModelGetPreprocessParams(const TinyAIImageModel      *model,
                                          TinyAIImagePreprocessParams *params);
 
+/**
+ * Get the label of a class
+ * @param model The model to query
+ * @param classId Class ID
+ * @return Class label, or NULL if the model has none for the class
+ */
+const char *tinyaiImageModelGetLabel(const TinyAIImageModel *model, int classId);
+
 /**
  * Print model summary
  * @param model The model to print summary for
@@ -9,6 +9,9 @@
 #ifndef TINYAI_IMAGE_MODEL_INTERNAL_H
 #define TINYAI_IMAGE_MODEL_INTERNAL_H
 
+#include "../../utils/progressive_loader.h"
+#include "../../utils/simd_ops.h"
+#include "../../utils/sparse_ops.h"
 #include "image_model.h"
 #include <float.h>
 #include <stdbool.h>
@@ -57,12 +60,40 @@ typedef struct Layer {
     float   *biases;  /* Biases for conv/dense layers */
     float   *scales;  /* Scale factors for quantized weights */
 
+    /* Convolution algorithm and transformed weights, prepared while SIMD is enabled */
+    TinyAIConvPlan  *convPlan;
+    float           *blockedWeights; /* Dequantized for the channel-blocked layout */
+    TinyAICSRMatrix *sparseWeights;  /* Pruned filters, CSR over the im2col K dimension */
+    bool             fusePooling;    /* The next (pooling) layer runs inside this one */
+
+    /* Int8 activation mode (see tinyaiImageModelEnableInt8Activations) */
+    uint8_t *int8Weights; /* Conv: 4-bit rows per output channel; depthwise: int8 [k * k][outC] */
+    float    outputScale; /* Calibrated scale of the layer's int8 output */
+
     /* Memory requirements */
     size_t weightBytes; /* Size of weights in bytes */
     size_t biasBytes;   /* Size of biases in bytes */
     size_t outputBytes; /* Size of output in bytes */
 } Layer;
 
+/**
+ * Early-exit head of a layer: global average pooling of its output, then a dense layer
+ */
+typedef struct {
+    float *weights;   /* [numClasses x channels], or NULL for no head */
+    float *biases;    /* [numClasses] */
+    int    channels;  /* Channels of the layer output the head was made for */
+    float  threshold; /* Softmax confidence that stops an image (above 1: never) */
+} TinyAIImageExitHead;
+
+/**
+ * Early-exit heads of a model, and how many images stopped at each
+ */
+typedef struct TinyAIImageExits {
+    TinyAIImageExitHead heads[50];
+    uint64_t            counts[50];
+} TinyAIImageExits;
+
 /**
  * Internal model structure - matches the definition in image_model.c
  */
@@ -78,10 +109,33 @@ struct TinyAIImageModel {
     int   numLayers;
 
     /* Memory */
-    void *memoryPool;
-    bool  useExternalMemory;
-    bool  useSIMD;
-    bool  useQuantization;
+    void        *memoryPool;
+    bool         useExternalMemory;
+    bool         useSIMD;
+    bool         useQuantization;
+    TinyAIArena *arena; /* Forward pass temporaries, or NULL for the workspace */
+
+    /* Threading of the forward pass kernels */
+    bool              serial;     /* Run every kernel on the calling thread */
+    TinyAIThreadPool *threadPool; /* Pool the kernels use, or NULL for the shared pool */
+
+    /* Int8 activation mode */
+    bool  int8Activations; /* Layers pass int8 tensors instead of floats */
+    bool  calibrated;      /* Activation scales have been calibrated */
+    float inputScale;      /* Calibrated scale of the int8 model input */
+
+    /* Forward pass workspace: two ping-pong buffers with a slot per image, then layer scratch */
+    float *workspace;
+    size_t workspaceFloats;  /* Floats in the whole workspace */
+    size_t activationFloats; /* Floats in each image's slot of a ping-pong buffer */
+    size_t scratchFloats;    /* Floats of layer scratch */
+    int    workspaceBatch;   /* Images the workspace holds */
+
+    /* Source of layer weights (NULL: weights held by the layers) */
+    TinyAIProgressiveLoader *loader;
+
+    /* Early-exit heads (NULL: every image runs every layer) */
+    TinyAIImageExits *exits;
 
     /* Labels */
     char **labels;
@@ -91,8 +145,20 @@ struct TinyAIImageModel {
     TinyAIImagePreprocessParams preprocess;
 };
 
+/**
+ * Size the model's forward pass workspace for its current layer shapes
+ * @param model The model to prepare
+ * @param batch Images the workspace must hold at once
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelPrepareWorkspace(TinyAIImageModel *model, int batch);
+
 /**
  * Forward pass function for image model
+ *
+ * Without an arena the pass runs in the model's workspace, so a model runs
+ * one forward pass at a time.
+ *
  * @param model The model to use
  * @param input Input data (preprocessed image data)
  * @param output Output buffer for classification results
@@ -100,6 +166,100 @@ struct TinyAIImageModel {
  */
 bool tinyaiImageModelForwardPass(const TinyAIImageModel *model, const float *input, float *output);
 
+/**
+ * Forward pass for a batch of images, one layer at a time over the whole batch
+ *
+ * Without an arena the workspace must have been prepared for the batch.
+ *
+ * @param model The model to use
+ * @param inputs Input data of each image, one after another
+ * @param batch Number of images
+ * @param outputs Output buffer for the results of each image, one after another
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardBatch(const TinyAIImageModel *model, const float *inputs, int batch,
+                                  float *outputs);
+
+/**
+ * Float forward pass of one image that records each layer's activation range
+ * @param model The model to use
+ * @param input Input data (preprocessed image data)
+ * @param output Output buffer for the results
+ * @param ranges Largest output magnitude of each layer, folded in with max [numLayers]
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardRanges(const TinyAIImageModel *model, const float *input,
+                                   float *output, float *ranges);
+
+/**
+ * Probe a model's early-exit heads on one image while it runs every layer
+ * @param model The model to use
+ * @param input Input data (preprocessed image data)
+ * @param output Output buffer for the results
+ * @param confidence Softmax confidence of each layer's head [numLayers]
+ * @param classes Most likely class of each layer's head, -1 where none ran [numLayers]
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardExits(const TinyAIImageModel *model, const float *input,
+                                  float *output, float *confidence, int *classes);
+
+/**
+ * Set each early-exit head's threshold from probed confidences
+ * @param model The model with exit heads attached
+ * @param confidence Head confidences of each image [numImages x numLayers]
+ * @param classes Head top classes of each image, -1 where none ran [numImages x numLayers]
+ * @param expected Full model's top class of each image [numImages]
+ * @param numImages Number of images
+ * @param agreement Fraction of exited images that must match the full model
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelFitExitThresholds(TinyAIImageModel *model, const float *confidence,
+                                       const int *classes, const int *expected, int numImages,
+                                       float agreement);
+
+/**
+ * Free a model's early-exit heads
+ * @param model The model
+ */
+void tinyaiImageModelReleaseExits(TinyAIImageModel *model);
+
+/**
+ * Elementwise operations adding a layer's biases and applying its activation
+ * @param layer The layer
+ * @param ops Filled with up to two operations
+ * @return Number of operations, or -1 for an unknown activation
+ */
+int tinyaiImageLayerEpilogue(const Layer *layer, TinyAIElementwiseOp *ops);
+
+/**
+ * Pack the weights the int8 activation kernels read
+ *
+ * Every layer must hold its weights (no progressive loader) and be of a
+ * type the int8 pass runs.
+ *
+ * @param model The model to prepare
+ * @return true on success, false on failure (nothing is left packed)
+ */
+bool tinyaiImageModelPrepareInt8(TinyAIImageModel *model);
+
+/**
+ * Free the weights packed by tinyaiImageModelPrepareInt8
+ * @param model The model
+ */
+void tinyaiImageModelReleaseInt8(TinyAIImageModel *model);
+
+/**
+ * Forward pass for a batch with int8 tensors between layers
+ * @param model The model to use, with calibrated scales and packed weights
+ * @param inputs Input data of each image, one after another
+ * @param batch Number of images
+ * @param outputs Output buffer for the results of each image, one after another
+ * @param workspace Workspace laid out for the batch
+ * @return true on success, false on failure
+ */
+bool tinyaiImageModelForwardInt8(const TinyAIImageModel *model, const float *inputs, int batch,
+                                 float *outputs, float *workspace);
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,6 +4,7 @@
  */
 
 #include "image_utils.h"
+#include "../../utils/simd_ops.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -494,3 +495,219 @@ TinyAIImage *tinyaiImagePreprocess(const TinyAIImage                 *image,
 
     return rgbImage;
 }
+
+/* Taps of one output row or column: source indices first..first+count-1 */
+typedef struct {
+    int first;
+    int count;
+} ResizeTaps;
+
+/**
+ * Resampling taps along one axis, weights summing to one per output
+ *
+ * Shrinking by two or more averages every source pixel the output covers
+ * (area resampling, so no source pixel is skipped); otherwise the output
+ * interpolates its two nearest source pixels, centers aligned.
+ */
+static void resizeTaps(int srcStart, int srcSize, int dstSize, ResizeTaps *taps, float *weights,
+                       int maxTaps)
+{
+    float scale = (float)srcSize / dstSize;
+
+    for (int i = 0; i < dstSize; i++) {
+        float *w = weights + (size_t)i * maxTaps;
+        if (scale >= 2.0f) {
+            float begin = i * scale, end = (i + 1) * scale;
+            int   first = (int)begin;
+            int   last  = (int)ceilf(end) - 1;
+            if (last >= srcSize) {
+                last = srcSize - 1;
+            }
+            taps[i].first = first;
+            taps[i].count = last - first + 1;
+            for (int t = 0; t < taps[i].count; t++) {
+                float lo = first + t > begin ? (float)(first + t) : begin;
+                float hi = first + t + 1 < end ? (float)(first + t + 1) : end;
+                w[t]     = (hi - lo) / scale;
+            }
+        }
+        else {
+            float center = (i + 0.5f) * scale - 0.5f;
+            if (center < 0.0f) {
+                center = 0.0f;
+            }
+            int   first = (int)center;
+            float frac  = center - first;
+            if (first >= srcSize - 1) {
+                first = srcSize - 1;
+                frac  = 0.0f;
+            }
+            taps[i].first = first;
+            taps[i].count = frac > 0.0f ? 2 : 1;
+            w[0]          = 1.0f - frac;
+            w[1]          = frac;
+        }
+        taps[i].first += srcStart;
+    }
+}
+
+/**
+ * Preprocess an image straight into a model's float input tensor
+ * @param image The image to preprocess
+ * @param params Preprocessing parameters
+ * @param channels Channels of the tensor (3 for RGB, 1 for luminance)
+ * @param output Tensor to fill (targetHeight x targetWidth x channels floats)
+ * @return true on success, false on failure
+ */
+bool tinyaiImagePreprocessToTensor(const TinyAIImage                 *image,
+                                   const TinyAIImagePreprocessParams *params, int channels,
+                                   float *output)
+{
+    if (!image || !image->data || !params || !output || params->targetWidth <= 0 ||
+        params->targetHeight <= 0 || (channels != 1 && channels != 3)) {
+        return false;
+    }
+
+    /* Offsets of R, G and B within a source pixel */
+    int srcChannels;
+    int rgb[3];
+    switch (image->format) {
+    case TINYAI_IMAGE_FORMAT_GRAYSCALE:
+        srcChannels = 1;
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        break;
+    case TINYAI_IMAGE_FORMAT_RGB:
+    case TINYAI_IMAGE_FORMAT_RGBA:
+        srcChannels = image->format == TINYAI_IMAGE_FORMAT_RGB ? 3 : 4;
+        rgb[0]      = 0;
+        rgb[1]      = 1;
+        rgb[2]      = 2;
+        break;
+    case TINYAI_IMAGE_FORMAT_BGR:
+        srcChannels = 3;
+        rgb[0]      = 2;
+        rgb[1]      = 1;
+        rgb[2]      = 0;
+        break;
+    default:
+        fprintf(stderr, "Unsupported image format for preprocessing\n");
+        return false;
+    }
+
+    /*
+     * out[c] = sum over source channels s of mix[c][s] * pixel[s] + offset[c],
+     * which reorders the channels (or takes the BT.601 luminance) and
+     * normalizes in one step. Resampling weights sum to one, so it commutes
+     * with resizing and is applied once per output pixel.
+     */
+    float mean[3] = {params->meanR, params->meanG, params->meanB};
+    float std[3]  = {params->stdR, params->stdG, params->stdB};
+    float mix[3][4];
+    float offset[3];
+    memset(mix, 0, sizeof(mix));
+    if (channels == 3) {
+        for (int c = 0; c < 3; c++) {
+            mix[c][rgb[c]] += 1.0f / std[c];
+            offset[c] = -mean[c] / std[c];
+        }
+    }
+    else {
+        static const float luma[3] = {0.299f, 0.587f, 0.114f};
+        float              m = 0.0f, s = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            m += luma[c] * mean[c];
+            s += luma[c] * std[c];
+        }
+        for (int c = 0; c < 3; c++) {
+            mix[0][rgb[c]] += luma[c] / s;
+        }
+        offset[0] = -m / s;
+    }
+
+    /* The crop is only a window of the source */
+    int cropX = 0, cropY = 0, cropWidth = image->width, cropHeight = image->height;
+    if (params->centerCrop) {
+        int w = (int)(image->width * params->cropRatio);
+        int h = (int)(image->height * params->cropRatio);
+        if (w > 0 && w <= image->width) {
+            cropWidth = w;
+        }
+        if (h > 0 && h <= image->height) {
+            cropHeight = h;
+        }
+        cropX = (image->width - cropWidth) / 2;
+        cropY = (image->height - cropHeight) / 2;
+    }
+
+    int outWidth  = params->targetWidth;
+    int outHeight = params->targetHeight;
+    int maxTapsX  = cropWidth >= 2 * outWidth ? (cropWidth + outWidth - 1) / outWidth + 1 : 2;
+    int maxTapsY  = cropHeight >= 2 * outHeight ? (cropHeight + outHeight - 1) / outHeight + 1 : 2;
+    size_t rowFloats = (size_t)outWidth * channels;
+
+    /*
+     * Tap tables, then a ring of source rows already resampled across. An
+     * output row reads at most maxTapsY consecutive source rows, which land
+     * in distinct slots, and rows shared with the next output row are kept.
+     */
+    int    slots    = maxTapsY;
+    size_t tapBytes = (size_t)(outWidth + outHeight) * sizeof(ResizeTaps) + slots * sizeof(int);
+    size_t floats   = (size_t)outWidth * maxTapsX + (size_t)outHeight * maxTapsY +
+                    (size_t)slots * rowFloats;
+    ResizeTaps *tapsX = (ResizeTaps *)malloc(tapBytes + floats * sizeof(float));
+    if (!tapsX) {
+        return false;
+    }
+    ResizeTaps *tapsY    = tapsX + outWidth;
+    int        *ring     = (int *)(tapsY + outHeight);
+    float      *weightsX = (float *)(ring + slots);
+    float      *weightsY = weightsX + (size_t)outWidth * maxTapsX;
+    float      *rows     = weightsY + (size_t)outHeight * maxTapsY;
+
+    resizeTaps(cropX, cropWidth, outWidth, tapsX, weightsX, maxTapsX);
+    resizeTaps(cropY, cropHeight, outHeight, tapsY, weightsY, maxTapsY);
+    for (int i = 0; i < slots; i++) {
+        ring[i] = -1;
+    }
+
+    for (int y = 0; y < outHeight; y++) {
+        const ResizeTaps *ty  = &tapsY[y];
+        float            *dst = output + (size_t)y * rowFloats;
+
+        memset(dst, 0, rowFloats * sizeof(float));
+        for (int t = 0; t < ty->count; t++) {
+            int    srcY = ty->first + t;
+            float *row  = rows + (size_t)(srcY % slots) * rowFloats;
+
+            /* Resample a source row across, then mix and normalize it */
+            if (ring[srcY % slots] != srcY) {
+                const uint8_t *src = image->data + (size_t)srcY * image->width * srcChannels;
+                for (int x = 0; x < outWidth; x++) {
+                    const ResizeTaps *tx = &tapsX[x];
+                    const float      *wx = weightsX + (size_t)x * maxTapsX;
+                    const uint8_t    *px = src + (size_t)tx->first * srcChannels;
+                    float             sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    for (int k = 0; k < tx->count; k++, px += srcChannels) {
+                        for (int s = 0; s < srcChannels; s++) {
+                            sum[s] += wx[k] * px[s];
+                        }
+                    }
+                    for (int c = 0; c < channels; c++) {
+                        float value = offset[c];
+                        for (int s = 0; s < srcChannels; s++) {
+                            value += mix[c][s] * sum[s];
+                        }
+                        row[(size_t)x * channels + c] = value;
+                    }
+                }
+                ring[srcY % slots] = srcY;
+            }
+
+            /* Blend the rows down */
+            tinyaiSimdVecScaleAdd(dst, row, weightsY[(size_t)y * maxTapsY + t], (int)rowFloats);
+        }
+    }
+
+    free(tapsX);
+    return true;
+}
@@ -88,6 +88,25 @@ void tinyaiImagePreprocessParamsDefault(TinyAIImagePreprocessParams *params);
 TinyAIImage *tinyaiImagePreprocess(const TinyAIImage                 *image,
                                    const TinyAIImagePreprocessParams *params);
 
+/**
+ * Preprocess an image straight into a model's float input tensor
+ *
+ * Crops, resizes, reorders the channels and normalizes in a single pass
+ * over the source pixels, with no intermediate images: each output value is
+ * (resampled source value - mean) / std. Shrinking by two or more averages
+ * the covered source area; smaller changes interpolate bilinearly. A
+ * single-channel tensor holds the BT.601 luminance, normalized with the
+ * same weighting of the three means and stds.
+ * @param image The image to preprocess, in any format
+ * @param params Preprocessing parameters
+ * @param channels Channels of the tensor (3 for RGB, 1 for luminance)
+ * @param output Tensor to fill (targetHeight x targetWidth x channels floats)
+ * @return true on success, false on failure
+ */
+bool tinyaiImagePreprocessToTensor(const TinyAIImage                 *image,
+                                   const TinyAIImagePreprocessParams *params, int channels,
+                                   float *output);
+
 /**
  * Load an image from a file
  * @param filepath Path to the image file
@@ -95,6 +114,35 @@ TinyAIImage *tinyaiImagePreprocess(const TinyAIImage                 *image,
  */
 TinyAIImage *tinyaiImageLoadFromFile(const char *filepath);
 
+/**
+ * Load an image from a file, shrunk while loading when it is much larger than needed
+ *
+ * Pixels are averaged over 2x2, 4x4 or 8x8 boxes, the largest that keeps the
+ * image at least targetWidth x targetHeight, so the result still needs
+ * resizing to the exact size. Saves memory and time for classification of
+ * large photos.
+ * @param filepath Path to the image file
+ * @param targetWidth Width the image is headed for (0 for full size)
+ * @param targetHeight Height the image is headed for (0 for full size)
+ * @return Newly allocated image, or NULL on failure
+ */
+TinyAIImage *tinyaiImageLoadFromFileScaled(const char *filepath, int targetWidth,
+                                           int targetHeight);
+
+/**
+ * Decode an image from an encoded file held in memory, shrunk like
+ * tinyaiImageLoadFromFileScaled
+ *
+ * Lets file reads and decoding run on different threads.
+ * @param buffer Encoded file contents (JPEG, PNG, BMP, ...)
+ * @param size Size of the buffer in bytes
+ * @param targetWidth Width the image is headed for (0 for full size)
+ * @param targetHeight Height the image is headed for (0 for full size)
+ * @return Newly allocated image, or NULL on failure
+ */
+TinyAIImage *tinyaiImageLoadFromMemoryScaled(const unsigned char *buffer, size_t size,
+                                             int targetWidth, int targetHeight);
+
 /**
  * Save an image to a file
  * @param image The image to save
@@ -4,6 +4,7 @@
  */
 
 #include "image_model.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,12 +15,144 @@
 
 #include "image_utils.h"
 
+/* Largest shrink applied while loading, as for the 1/8 DCT scaling of JPEG decoders */
+#define LOADER_MAX_SHRINK 8
+
+/**
+ * Image format of decoded pixels with the given number of channels
+ */
+static bool formatForChannels(int channels, TinyAIImageFormat *format)
+{
+    switch (channels) {
+    case 1:
+        *format = TINYAI_IMAGE_FORMAT_GRAYSCALE;
+        return true;
+    case 3:
+        *format = TINYAI_IMAGE_FORMAT_RGB;
+        return true;
+    case 4:
+        *format = TINYAI_IMAGE_FORMAT_RGBA;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Largest power-of-two shrink that keeps an image at least the target size
+ */
+static int shrinkFactor(int width, int height, int targetWidth, int targetHeight)
+{
+    int factor = 1;
+    if (targetWidth <= 0 || targetHeight <= 0) {
+        return factor;
+    }
+
+    while (factor < LOADER_MAX_SHRINK && width / (factor * 2) >= targetWidth &&
+           height / (factor * 2) >= targetHeight) {
+        factor *= 2;
+    }
+    return factor;
+}
+
+/**
+ * Average boxes of factor x factor decoded pixels into an image
+ *
+ * Boxes on the right and bottom edges may be partial and average the pixels
+ * they cover.
+ */
+static void boxShrink(const unsigned char *pixels, int width, int height, int channels,
+                      int factor, TinyAIImage *image)
+{
+    unsigned char *out = image->data;
+
+    for (int oy = 0; oy < image->height; oy++) {
+        int y0 = oy * factor;
+        int y1 = y0 + factor < height ? y0 + factor : height;
+        for (int ox = 0; ox < image->width; ox++, out += channels) {
+            int      x0      = ox * factor;
+            int      x1      = x0 + factor < width ? x0 + factor : width;
+            uint32_t sums[4] = {0, 0, 0, 0};
+
+            for (int y = y0; y < y1; y++) {
+                const unsigned char *pixel = pixels + ((size_t)y * width + x0) * channels;
+                for (int x = x0; x < x1; x++, pixel += channels) {
+                    for (int c = 0; c < channels; c++) {
+                        sums[c] += pixel[c];
+                    }
+                }
+            }
+
+            uint32_t count = (uint32_t)(y1 - y0) * (uint32_t)(x1 - x0);
+            for (int c = 0; c < channels; c++) {
+                out[c] = (unsigned char)((sums[c] + count / 2) / count);
+            }
+        }
+    }
+}
+
 /**
  * Load an image from a file using STB Image library
  * @param filepath Path to the image file
  * @return Newly allocated TinyAIImage, or NULL on failure
  */
 TinyAIImage *tinyaiImageLoadFromFile(const char *filepath)
+{
+    return tinyaiImageLoadFromFileScaled(filepath, 0, 0);
+}
+
+/**
+ * Build an image from pixels decoded by STB Image, shrinking it on the way
+ *
+ * stb_image always decodes at full resolution, so the shrink is applied to
+ * its buffer, straight into the returned image: the full-resolution copy
+ * that would otherwise be made is skipped, and every later step works on
+ * up to 64 times fewer pixels. Frees the decoded pixels.
+ */
+static TinyAIImage *imageFromDecoded(unsigned char *data, int width, int height, int channels,
+                                     int targetWidth, int targetHeight)
+{
+    /* Convert channels to our format enum */
+    TinyAIImageFormat format;
+    if (!formatForChannels(channels, &format)) {
+        fprintf(stderr, "Unsupported number of channels: %d\n", channels);
+        stbi_image_free(data);
+        return NULL;
+    }
+
+    /* Create our image structure, at the shrunk size */
+    int          factor = shrinkFactor(width, height, targetWidth, targetHeight);
+    TinyAIImage *image =
+        tinyaiImageCreate((width + factor - 1) / factor, (height + factor - 1) / factor, format);
+    if (!image) {
+        stbi_image_free(data);
+        return NULL;
+    }
+
+    /* Copy or shrink the data */
+    if (factor == 1) {
+        memcpy(image->data, data, (size_t)width * height * channels);
+    }
+    else {
+        boxShrink(data, width, height, channels, factor, image);
+    }
+
+    /* Free STB's image data */
+    stbi_image_free(data);
+
+    return image;
+}
+
+/**
+ * Load an image from a file, shrinking it on the way when it is much larger than needed
+ *
+ * @param filepath Path to the image file
+ * @param targetWidth Width the image is headed for (0 for full size)
+ * @param targetHeight Height the image is headed for (0 for full size)
+ * @return Newly allocated TinyAIImage, or NULL on failure
+ */
+TinyAIImage *tinyaiImageLoadFromFileScaled(const char *filepath, int targetWidth,
+                                           int targetHeight)
 {
     if (!filepath) {
         fprintf(stderr, "Error: NULL filepath provided to tinyaiImageLoadFromFile\n");
@@ -36,38 +169,37 @@ TinyAIImage *tinyaiImageLoadFromFile(const char *filepath)
         return NULL;
     }
 
-    /* Convert channels to our format enum */
-    TinyAIImageFormat format;
-    switch (channels) {
-    case 1:
-        format = TINYAI_IMAGE_FORMAT_GRAYSCALE;
-        break;
-    case 3:
-        format = TINYAI_IMAGE_FORMAT_RGB;
-        break;
-    case 4:
-        format = TINYAI_IMAGE_FORMAT_RGBA;
-        break;
-    default:
-        fprintf(stderr, "Unsupported number of channels: %d\n", channels);
-        stbi_image_free(data);
-        return NULL;
-    }
+    return imageFromDecoded(data, width, height, channels, targetWidth, targetHeight);
+}
 
-    /* Create our image structure */
-    TinyAIImage *image = tinyaiImageCreate(width, height, format);
-    if (!image) {
-        stbi_image_free(data);
+/**
+ * Decode an image from an encoded file held in memory
+ *
+ * @param buffer Encoded file contents (JPEG, PNG, BMP, ...)
+ * @param size Size of the buffer in bytes
+ * @param targetWidth Width the image is headed for (0 for full size)
+ * @param targetHeight Height the image is headed for (0 for full size)
+ * @return Newly allocated TinyAIImage, or NULL on failure
+ */
+TinyAIImage *tinyaiImageLoadFromMemoryScaled(const unsigned char *buffer, size_t size,
+                                             int targetWidth, int targetHeight)
+{
+    if (!buffer || size == 0 || size > INT_MAX) {
+        fprintf(stderr, "Error: Invalid buffer provided to tinyaiImageLoadFromMemoryScaled\n");
         return NULL;
     }
 
-    /* Copy the data */
-    memcpy(image->data, data, width * height * channels);
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(1); /* Same orientation as files */
 
-    /* Free STB's image data */
-    stbi_image_free(data);
+    unsigned char *data =
+        stbi_load_from_memory(buffer, (int)size, &width, &height, &channels, 0);
+    if (!data) {
+        fprintf(stderr, "Error decoding image: %s\n", stbi_failure_reason());
+        return NULL;
+    }
 
-    return image;
+    return imageFromDecoded(data, width, height, channels, targetWidth, targetHeight);
 }
 
 /**
@@ -183,8 +315,8 @@ TinyAIImage **tinyaiImageLoadDataset(const char **filepaths, int numImages, int
     /* Load each image */
     bool success = true;
     for (int i = 0; i < numImages; i++) {
-        /* Load the original image */
-        images[i] = tinyaiImageLoadFromFile(filepaths[i]);
+        /* Load the original image, shrunk toward the target size */
+        images[i] = tinyaiImageLoadFromFileScaled(filepaths[i], targetWidth, targetHeight);
         if (!images[i]) {
             success = false;
             break;
@@ -0,0 +1,516 @@
+/**
+ * @file duplicate_index.c
+ * @brief Implementation of the perceptual-hash duplicate index
+ */
+
+#include "duplicate_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Grid the hash averages brightness over: one more column than bits per row */
+#define HASH_COLUMNS 9
+#define HASH_ROWS 8
+
+/* Least brightness range over the grid, in 1024ths of a level, that gives an image a shape;
+   flatter images (solid colours, blank scans) hash to 0 */
+#define HASH_MIN_SPREAD (8 * 1024)
+
+/* Entry capacity of a new index */
+#define INITIAL_CAPACITY 64
+
+/* Longest index file path, leaving room for the temporary file's suffix */
+#define MAX_PATH_LENGTH 1024
+
+#ifdef _WIN32
+typedef SRWLOCK IndexLock;
+#else
+typedef pthread_mutex_t IndexLock;
+#endif
+
+/**
+ * Index file header
+ */
+typedef struct {
+    uint32_t magic;   /* TINYAI_DUPLICATE_INDEX_MAGIC */
+    uint32_t version; /* TINYAI_DUPLICATE_INDEX_VERSION */
+} FileHeader;
+
+/**
+ * Index file record, followed by the output
+ */
+typedef struct {
+    uint64_t hash;        /* Perceptual hash */
+    uint64_t encoderHash; /* Encoder that produced the output */
+    int32_t  size;        /* Number of floats in the output */
+    uint32_t reserved;
+} FileRecord;
+
+/*
+ * Hashes sit in their own array, so a lookup scans 8 bytes per entry and only
+ * reads the encoder and output of entries within the distance.
+ */
+struct TinyAIDuplicateIndex {
+    uint64_t *hashes;         /* Perceptual hash of each entry */
+    uint64_t *encoderHashes;  /* Encoder of each entry */
+    size_t   *offsets;        /* Start of each entry's output in outputs */
+    int      *sizes;          /* Floats in each entry's output */
+    int       numEntries;     /* Entries in the index */
+    int       capacity;       /* Entries the arrays above hold */
+    float    *outputs;        /* Outputs of every entry, in insertion order */
+    size_t    outputsUsed;    /* Floats used in outputs */
+    size_t    outputCapacity; /* Floats outputs holds */
+    FILE     *file;           /* Index file open for appending, or NULL */
+    IndexLock lock;           /* Guards everything above and the stats */
+
+    TinyAIDuplicateIndexStats stats;
+};
+
+static void lockIndex(const TinyAIDuplicateIndex *index)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive((PSRWLOCK)&index->lock);
+#else
+    pthread_mutex_lock((pthread_mutex_t *)&index->lock);
+#endif
+}
+
+static void unlockIndex(const TinyAIDuplicateIndex *index)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive((PSRWLOCK)&index->lock);
+#else
+    pthread_mutex_unlock((pthread_mutex_t *)&index->lock);
+#endif
+}
+
+static bool growEntries(TinyAIDuplicateIndex *index)
+{
+    int capacity = index->capacity ? index->capacity * 2 : INITIAL_CAPACITY;
+
+    /* Each array keeps its old block until every reallocation succeeded */
+    uint64_t *hashes = (uint64_t *)realloc(index->hashes, capacity * sizeof(uint64_t));
+    if (hashes) {
+        index->hashes = hashes;
+    }
+    uint64_t *encoderHashes =
+        (uint64_t *)realloc(index->encoderHashes, capacity * sizeof(uint64_t));
+    if (encoderHashes) {
+        index->encoderHashes = encoderHashes;
+    }
+    size_t *offsets = (size_t *)realloc(index->offsets, capacity * sizeof(size_t));
+    if (offsets) {
+        index->offsets = offsets;
+    }
+    int *sizes = (int *)realloc(index->sizes, capacity * sizeof(int));
+    if (sizes) {
+        index->sizes = sizes;
+    }
+
+    if (!hashes || !encoderHashes || !offsets || !sizes) {
+        return false;
+    }
+    index->capacity = capacity;
+    return true;
+}
+
+/* Add an entry to memory only */
+static int storeEntry(TinyAIDuplicateIndex *index, uint64_t hash, uint64_t encoderHash,
+                      const float *output, int size)
+{
+    if (index->numEntries == index->capacity && !growEntries(index)) {
+        fprintf(stderr, "Failed to grow duplicate index\n");
+        return -1;
+    }
+
+    if (index->outputsUsed + (size_t)size > index->outputCapacity) {
+        size_t capacity = index->outputCapacity ? index->outputCapacity * 2 : 1024;
+        while (capacity < index->outputsUsed + (size_t)size) {
+            capacity *= 2;
+        }
+        float *outputs = (float *)realloc(index->outputs, capacity * sizeof(float));
+        if (!outputs) {
+            fprintf(stderr, "Failed to grow duplicate index outputs\n");
+            return -1;
+        }
+        index->outputs        = outputs;
+        index->outputCapacity = capacity;
+    }
+
+    int entry                   = index->numEntries++;
+    index->hashes[entry]        = hash;
+    index->encoderHashes[entry] = encoderHash;
+    index->offsets[entry]       = index->outputsUsed;
+    index->sizes[entry]         = size;
+    memcpy(index->outputs + index->outputsUsed, output, (size_t)size * sizeof(float));
+    index->outputsUsed += (size_t)size;
+    index->stats.numEntries = index->numEntries;
+    return 0;
+}
+
+static bool writeRecord(FILE *file, uint64_t hash, uint64_t encoderHash, const float *output,
+                        int size)
+{
+    FileRecord record = {hash, encoderHash, (int32_t)size, 0};
+    return fwrite(&record, sizeof(record), 1, file) == 1 &&
+           fwrite(output, sizeof(float), (size_t)size, file) == (size_t)size;
+}
+
+/*
+ * Rewrite the index file from memory through a temporary file renamed into
+ * place. Used when the file is new, or when a crash left half a record at its
+ * end, which appending after would misalign.
+ */
+static bool rewriteFile(const TinyAIDuplicateIndex *index, const char *path)
+{
+    char tempPath[MAX_PATH_LENGTH];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) {
+        return false;
+    }
+
+    FileHeader header = {TINYAI_DUPLICATE_INDEX_MAGIC, TINYAI_DUPLICATE_INDEX_VERSION};
+    bool       ok     = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; i < index->numEntries && ok; i++) {
+        ok = writeRecord(file, index->hashes[i], index->encoderHashes[i],
+                         index->outputs + index->offsets[i], index->sizes[i]);
+    }
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Read every complete record of an index file into memory. Returns -1 if the
+ * file is not an index, 0 if it ended cleanly (or does not exist) and 1 if it
+ * needs rewriting.
+ */
+static int loadFile(TinyAIDuplicateIndex *index, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 1;
+    }
+
+    FileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        /* Empty, or cut short before the header was complete */
+        fclose(file);
+        return 1;
+    }
+    if (header.magic != TINYAI_DUPLICATE_INDEX_MAGIC ||
+        header.version != TINYAI_DUPLICATE_INDEX_VERSION) {
+        fclose(file);
+        return -1;
+    }
+
+    int    result   = 0;
+    float *output   = NULL;
+    int    capacity = 0;
+    for (;;) {
+        FileRecord record;
+        size_t     read = fread(&record, 1, sizeof(record), file);
+        if (read == 0) {
+            break;
+        }
+        if (read != sizeof(record) || record.size <= 0) {
+            result = 1;
+            break;
+        }
+
+        if (record.size > capacity) {
+            float *grown = (float *)realloc(output, (size_t)record.size * sizeof(float));
+            if (!grown) {
+                result = -1;
+                break;
+            }
+            output   = grown;
+            capacity = record.size;
+        }
+        if (fread(output, sizeof(float), (size_t)record.size, file) != (size_t)record.size) {
+            result = 1;
+            break;
+        }
+        if (storeEntry(index, record.hash, record.encoderHash, output, record.size) != 0) {
+            result = -1;
+            break;
+        }
+    }
+
+    free(output);
+    fclose(file);
+    return result;
+}
+
+/**
+ * Create a duplicate index
+ */
+TinyAIDuplicateIndex *tinyaiCreateDuplicateIndex(const char *path)
+{
+    TinyAIDuplicateIndex *index = (TinyAIDuplicateIndex *)calloc(1, sizeof(TinyAIDuplicateIndex));
+    if (!index) {
+        fprintf(stderr, "Failed to allocate duplicate index\n");
+        return NULL;
+    }
+#ifdef _WIN32
+    InitializeSRWLock(&index->lock);
+#else
+    pthread_mutex_init(&index->lock, NULL);
+#endif
+
+    if (!growEntries(index)) {
+        fprintf(stderr, "Failed to allocate duplicate index entries\n");
+        tinyaiDestroyDuplicateIndex(index);
+        return NULL;
+    }
+
+    if (path) {
+        if (strlen(path) + 8 > MAX_PATH_LENGTH) {
+            fprintf(stderr, "Duplicate index path too long: %s\n", path);
+            tinyaiDestroyDuplicateIndex(index);
+            return NULL;
+        }
+
+        int loaded = loadFile(index, path);
+        if (loaded < 0) {
+            fprintf(stderr, "Failed to load duplicate index from %s\n", path);
+            tinyaiDestroyDuplicateIndex(index);
+            return NULL;
+        }
+        if (loaded > 0 && !rewriteFile(index, path)) {
+            fprintf(stderr, "Failed to write duplicate index %s\n", path);
+            tinyaiDestroyDuplicateIndex(index);
+            return NULL;
+        }
+
+        index->file = fopen(path, "ab");
+        if (!index->file) {
+            fprintf(stderr, "Failed to open duplicate index %s\n", path);
+            tinyaiDestroyDuplicateIndex(index);
+            return NULL;
+        }
+    }
+
+    return index;
+}
+
+/**
+ * Free a duplicate index
+ */
+void tinyaiDestroyDuplicateIndex(TinyAIDuplicateIndex *index)
+{
+    if (!index) {
+        return;
+    }
+
+    if (index->file) {
+        fclose(index->file);
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&index->lock);
+#endif
+    free(index->hashes);
+    free(index->encoderHashes);
+    free(index->offsets);
+    free(index->sizes);
+    free(index->outputs);
+    free(index);
+}
+
+/**
+ * Compute the perceptual hash of an image
+ */
+uint64_t tinyaiDuplicateIndexHash(const TinyAIImage *image)
+{
+    if (!image || !image->data || image->width <= 0 || image->height <= 0) {
+        return 0;
+    }
+
+    int channels, red, blue;
+    switch (image->format) {
+    case TINYAI_IMAGE_FORMAT_GRAYSCALE:
+        channels = 1;
+        red = blue = 0;
+        break;
+    case TINYAI_IMAGE_FORMAT_BGR:
+        channels = 3;
+        red      = 2;
+        blue     = 0;
+        break;
+    case TINYAI_IMAGE_FORMAT_RGBA:
+        channels = 4;
+        red      = 0;
+        blue     = 2;
+        break;
+    default:
+        channels = 3;
+        red      = 0;
+        blue     = 2;
+        break;
+    }
+
+    /* Mean brightness of each box, with luma weights scaled to sum to 1024 */
+    uint32_t grid[HASH_ROWS][HASH_COLUMNS];
+    for (int row = 0; row < HASH_ROWS; row++) {
+        int y0 = row * image->height / HASH_ROWS;
+        int y1 = (row + 1) * image->height / HASH_ROWS;
+        if (y1 <= y0) {
+            y1 = y0 + 1;
+        }
+
+        for (int column = 0; column < HASH_COLUMNS; column++) {
+            int x0 = column * image->width / HASH_COLUMNS;
+            int x1 = (column + 1) * image->width / HASH_COLUMNS;
+            if (x1 <= x0) {
+                x1 = x0 + 1;
+            }
+
+            uint64_t sum = 0;
+            for (int y = y0; y < y1; y++) {
+                const uint8_t *pixel = image->data + ((size_t)y * image->width + x0) * channels;
+                for (int x = x0; x < x1; x++, pixel += channels) {
+                    sum += channels == 1
+                               ? 1024u * pixel[0]
+                               : 306u * pixel[red] + 601u * pixel[1] + 117u * pixel[blue];
+                }
+            }
+            grid[row][column] = (uint32_t)(sum / ((uint64_t)(y1 - y0) * (x1 - x0)));
+        }
+    }
+
+    /* The gradients of a nearly flat image are noise, and would match other flat images */
+    uint32_t darkest   = grid[0][0];
+    uint32_t brightest = grid[0][0];
+    for (int row = 0; row < HASH_ROWS; row++) {
+        for (int column = 0; column < HASH_COLUMNS; column++) {
+            darkest   = grid[row][column] < darkest ? grid[row][column] : darkest;
+            brightest = grid[row][column] > brightest ? grid[row][column] : brightest;
+        }
+    }
+    if (brightest - darkest < HASH_MIN_SPREAD) {
+        return 0;
+    }
+
+    uint64_t hash = 0;
+    for (int row = 0; row < HASH_ROWS; row++) {
+        for (int column = 0; column < HASH_COLUMNS - 1; column++) {
+            hash = (hash << 1) | (grid[row][column] < grid[row][column + 1]);
+        }
+    }
+    return hash;
+}
+
+/**
+ * Count the bits two perceptual hashes differ in
+ */
+int tinyaiDuplicateIndexDistance(uint64_t a, uint64_t b)
+{
+    uint64_t bits = a ^ b;
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+    bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+    bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int)((bits * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/**
+ * Look up the output stored for the nearest hash
+ */
+int tinyaiDuplicateIndexLookup(TinyAIDuplicateIndex *index, uint64_t hash, uint64_t encoderHash,
+                               int maxDistance, float *output, int size)
+{
+    if (!index || !output || size <= 0 || maxDistance < 0) {
+        return -1;
+    }
+
+    lockIndex(index);
+    if (hash == 0) {
+        index->stats.misses++; /* Featureless images are never duplicates of one another */
+        unlockIndex(index);
+        return -1;
+    }
+
+    int best         = -1;
+    int bestDistance = maxDistance + 1;
+    for (int i = 0; i < index->numEntries && bestDistance > 0; i++) {
+        int distance = tinyaiDuplicateIndexDistance(index->hashes[i], hash);
+        if (distance < bestDistance && index->encoderHashes[i] == encoderHash &&
+            index->sizes[i] == size) {
+            best         = i;
+            bestDistance = distance;
+        }
+    }
+
+    if (best < 0) {
+        index->stats.misses++;
+        unlockIndex(index);
+        return -1;
+    }
+
+    memcpy(output, index->outputs + index->offsets[best], (size_t)size * sizeof(float));
+    if (bestDistance == 0) {
+        index->stats.exactHits++;
+    }
+    else {
+        index->stats.nearHits++;
+    }
+    unlockIndex(index);
+    return bestDistance;
+}
+
+/**
+ * Store the output of a hash
+ */
+int tinyaiDuplicateIndexInsert(TinyAIDuplicateIndex *index, uint64_t hash, uint64_t encoderHash,
+                               const float *output, int size)
+{
+    if (!index || !output || size <= 0) {
+        return -1;
+    }
+    if (hash == 0) {
+        return 0; /* Never matched, so not worth storing */
+    }
+
+    lockIndex(index);
+    int result = storeEntry(index, hash, encoderHash, output, size);
+    if (result == 0 && index->file &&
+        (!writeRecord(index->file, hash, encoderHash, output, size) ||
+         fflush(index->file) != 0)) {
+        fprintf(stderr, "Failed to append to duplicate index\n");
+        result = -1;
+    }
+    unlockIndex(index);
+    return result;
+}
+
+/**
+ * Get the statistics of a duplicate index
+ */
+void tinyaiDuplicateIndexGetStats(const TinyAIDuplicateIndex *index,
+                                  TinyAIDuplicateIndexStats  *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!index) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    lockIndex(index);
+    *stats = index->stats;
+    unlockIndex(index);
+}
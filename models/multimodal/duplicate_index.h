@@ -0,0 +1,141 @@
+/**
+ * @file duplicate_index.h
+ * @brief Perceptual-hash index of previously processed images
+ *
+ * Finds images that were processed before in another form: resized,
+ * recompressed or slightly recoloured copies, which the content-addressed
+ * embedding cache misses because their pixels differ. Each image is reduced
+ * to a 64-bit difference hash (dHash) of its brightness gradients, and an
+ * entry stores the model output of an image under its hash. A lookup returns
+ * the stored output of the nearest hash within a Hamming distance, so near
+ * duplicates skip the model. An optional file keeps every entry, so the
+ * index outlives the process.
+ */
+
+#ifndef TINYAI_DUPLICATE_INDEX_H
+#define TINYAI_DUPLICATE_INDEX_H
+
+#include "../image/image_model.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Index file format
+ *
+ * A little-endian header of magic and version, then one record per entry in
+ * insertion order: hash, encoder hash, output size, then the output as
+ * floats. Records are appended as entries are inserted.
+ */
+#define TINYAI_DUPLICATE_INDEX_MAGIC 0x49444154 /* "TADI" in ASCII */
+#define TINYAI_DUPLICATE_INDEX_VERSION 1
+
+/**
+ * Default Hamming distance under which two hashes count as the same image
+ *
+ * Resizing and recompression flip a few of the 64 bits; unrelated images
+ * differ in about half of them.
+ */
+#define TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE 5
+
+/**
+ * Perceptual-hash index (opaque)
+ *
+ * Entries carry the hash of the encoder that produced them, so an index may
+ * be shared by several models. Every call takes the index's lock, so models
+ * running on different threads may share one index.
+ */
+typedef struct TinyAIDuplicateIndex TinyAIDuplicateIndex;
+
+/**
+ * Index statistics
+ */
+typedef struct {
+    uint64_t exactHits; /* Lookups that found the same hash */
+    uint64_t nearHits;  /* Lookups that found a hash within the distance */
+    uint64_t misses;    /* Lookups that found no entry */
+    int      numEntries;
+} TinyAIDuplicateIndexStats;
+
+/**
+ * Create a duplicate index
+ *
+ * @param path Index file to load and append to (created if missing), or
+ *             NULL for memory only
+ * @return New index or NULL on error (unreadable file or not an index)
+ */
+TinyAIDuplicateIndex *tinyaiCreateDuplicateIndex(const char *path);
+
+/**
+ * Free a duplicate index; the index file is kept
+ *
+ * @param index Duplicate index to free
+ */
+void tinyaiDestroyDuplicateIndex(TinyAIDuplicateIndex *index);
+
+/**
+ * Compute the perceptual hash of an image
+ *
+ * Averages the brightness of the image over a 9x8 grid of boxes and sets
+ * one bit per horizontally adjacent pair of boxes that gets brighter. Small
+ * images hash like large ones, so the hash may be taken from a downscaled
+ * decode. Images with too little brightness variation to have a shape (flat
+ * colours, blank scans) hash to 0, which is never looked up or stored.
+ *
+ * @param image Image to hash
+ * @return 64-bit perceptual hash
+ */
+uint64_t tinyaiDuplicateIndexHash(const TinyAIImage *image);
+
+/**
+ * Count the bits two perceptual hashes differ in
+ *
+ * @param a First hash
+ * @param b Second hash
+ * @return Hamming distance, 0 to 64
+ */
+int tinyaiDuplicateIndexDistance(uint64_t a, uint64_t b);
+
+/**
+ * Look up the output stored for the nearest hash
+ *
+ * @param index Duplicate index
+ * @param hash Perceptual hash from tinyaiDuplicateIndexHash
+ * @param encoderHash Hash of the encoder, from tinyaiEmbeddingCacheEncoderHash
+ * @param maxDistance Largest Hamming distance that counts as a match
+ * @param output Output of the matching entry (size floats)
+ * @param size Number of floats in the output
+ * @return Hamming distance of the match, or -1 on a miss, a hash of 0 or an error
+ */
+int tinyaiDuplicateIndexLookup(TinyAIDuplicateIndex *index, uint64_t hash, uint64_t encoderHash,
+                               int maxDistance, float *output, int size);
+
+/**
+ * Store the output of a hash, in memory and in the index file
+ *
+ * @param index Duplicate index
+ * @param hash Perceptual hash from tinyaiDuplicateIndexHash
+ * @param encoderHash Hash of the encoder, from tinyaiEmbeddingCacheEncoderHash
+ * @param output Output to store (size floats)
+ * @param size Number of floats in the output
+ * @return 0 on success (a hash of 0 is not stored), -1 on error
+ */
+int tinyaiDuplicateIndexInsert(TinyAIDuplicateIndex *index, uint64_t hash, uint64_t encoderHash,
+                               const float *output, int size);
+
+/**
+ * Get the statistics of a duplicate index
+ *
+ * @param index Duplicate index
+ * @param stats Output statistics
+ */
+void tinyaiDuplicateIndexGetStats(const TinyAIDuplicateIndex *index,
+                                  TinyAIDuplicateIndexStats  *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_DUPLICATE_INDEX_H */
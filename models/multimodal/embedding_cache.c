@@ -0,0 +1,514 @@
+/**
+ * @file embedding_cache.c
+ * @brief Implementation of the image embedding cache
+ */
+
+#include "embedding_cache.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* Bucket count of a new cache, as a power of two */
+#define INITIAL_BUCKETS 64
+
+/* Longest disk tier path: the directory, a separator, 16 hex digits and the extension */
+#define MAX_PATH_LENGTH 1024
+
+/* FNV-1a parameters */
+#define FNV_OFFSET 1469598103934665603ULL
+#define FNV_PRIME 1099511628211ULL
+
+#ifdef _WIN32
+typedef SRWLOCK CacheLock;
+#else
+typedef pthread_mutex_t CacheLock;
+#endif
+
+/**
+ * Cache entry, followed in the same allocation by its embedding
+ */
+typedef struct CacheEntry {
+    uint64_t           key;       /* Key of the embedding */
+    int                size;      /* Number of floats in the embedding */
+    struct CacheEntry *nextInBucket;
+    struct CacheEntry *newer; /* Toward the most recently used entry */
+    struct CacheEntry *older; /* Toward the least recently used entry */
+} CacheEntry;
+
+/**
+ * Disk tier file header
+ */
+typedef struct {
+    uint32_t magic;   /* TINYAI_EMBEDDING_CACHE_MAGIC */
+    uint32_t version; /* TINYAI_EMBEDDING_CACHE_VERSION */
+    int32_t  size;    /* Number of floats in the embedding */
+    uint32_t reserved;
+} DiskHeader;
+
+struct TinyAIEmbeddingCache {
+    CacheEntry **buckets;    /* Entries by key */
+    int          numBuckets; /* Power of two */
+    CacheEntry  *newest;     /* Most recently used entry */
+    CacheEntry  *oldest;     /* Least recently used entry, evicted first */
+    size_t       memoryLimit;
+    char        *diskPath; /* Disk tier directory, or NULL */
+    CacheLock    lock;     /* Guards everything above and the stats */
+
+    TinyAIEmbeddingCacheStats stats;
+};
+
+static void lockCache(const TinyAIEmbeddingCache *cache)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive((PSRWLOCK)&cache->lock);
+#else
+    pthread_mutex_lock((pthread_mutex_t *)&cache->lock);
+#endif
+}
+
+static void unlockCache(const TinyAIEmbeddingCache *cache)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive((PSRWLOCK)&cache->lock);
+#else
+    pthread_mutex_unlock((pthread_mutex_t *)&cache->lock);
+#endif
+}
+
+static float *entryEmbedding(CacheEntry *entry) { return (float *)(entry + 1); }
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t hashInt(uint64_t hash, int64_t value)
+{
+    for (int byte = 0; byte < 8; byte++) {
+        hash = (hash ^ (((uint64_t)value >> (byte * 8)) & 0xff)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Keys are already well mixed, so their low bits pick the bucket */
+static int bucketOf(const TinyAIEmbeddingCache *cache, uint64_t key)
+{
+    return (int)(key & (uint64_t)(cache->numBuckets - 1));
+}
+
+static CacheEntry *findEntry(const TinyAIEmbeddingCache *cache, uint64_t key)
+{
+    CacheEntry *entry = cache->buckets[bucketOf(cache, key)];
+    while (entry && entry->key != key) {
+        entry = entry->nextInBucket;
+    }
+    return entry;
+}
+
+static void unlinkLRU(TinyAIEmbeddingCache *cache, CacheEntry *entry)
+{
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    }
+    else {
+        cache->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    }
+    else {
+        cache->oldest = entry->newer;
+    }
+    entry->newer = entry->older = NULL;
+}
+
+static void pushNewest(TinyAIEmbeddingCache *cache, CacheEntry *entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest) {
+        cache->newest->newer = entry;
+    }
+    else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+static void removeEntry(TinyAIEmbeddingCache *cache, CacheEntry *entry)
+{
+    CacheEntry **link = &cache->buckets[bucketOf(cache, entry->key)];
+    while (*link != entry) {
+        link = &(*link)->nextInBucket;
+    }
+    *link = entry->nextInBucket;
+
+    unlinkLRU(cache, entry);
+    cache->stats.memoryUsed -= (size_t)entry->size * sizeof(float);
+    cache->stats.numEntries--;
+    free(entry);
+}
+
+/* Double the bucket count once entries outnumber buckets; a failed grow keeps longer chains */
+static void growBuckets(TinyAIEmbeddingCache *cache)
+{
+    if (cache->stats.numEntries < cache->numBuckets) {
+        return;
+    }
+
+    int          numBuckets = cache->numBuckets * 2;
+    CacheEntry **buckets    = (CacheEntry **)calloc((size_t)numBuckets, sizeof(CacheEntry *));
+    if (!buckets) {
+        return;
+    }
+
+    for (int i = 0; i < cache->numBuckets; i++) {
+        CacheEntry *entry = cache->buckets[i];
+        while (entry) {
+            CacheEntry *next    = entry->nextInBucket;
+            int         bucket  = (int)(entry->key & (uint64_t)(numBuckets - 1));
+            entry->nextInBucket = buckets[bucket];
+            buckets[bucket]     = entry;
+            entry               = next;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets    = buckets;
+    cache->numBuckets = numBuckets;
+}
+
+/* Evict least recently used entries down to a byte target; the caller holds the lock */
+static void evictTo(TinyAIEmbeddingCache *cache, size_t targetBytes)
+{
+    while (cache->oldest && cache->stats.memoryUsed > targetBytes) {
+        removeEntry(cache, cache->oldest);
+    }
+}
+
+/* Store an embedding in memory, evicting older entries to make room */
+static int storeInMemory(TinyAIEmbeddingCache *cache, uint64_t key, const float *embedding,
+                         int size)
+{
+    size_t bytes = (size_t)size * sizeof(float);
+    if (bytes > cache->memoryLimit) {
+        return -1;
+    }
+
+    CacheEntry *entry = findEntry(cache, key);
+    if (entry && entry->size == size) {
+        memcpy(entryEmbedding(entry), embedding, bytes);
+        unlinkLRU(cache, entry);
+        pushNewest(cache, entry);
+        return 0;
+    }
+    if (entry) {
+        removeEntry(cache, entry);
+    }
+
+    evictTo(cache, cache->memoryLimit - bytes);
+
+    entry = (CacheEntry *)malloc(sizeof(CacheEntry) + bytes);
+    if (!entry) {
+        return -1;
+    }
+    entry->key  = key;
+    entry->size = size;
+    memcpy(entryEmbedding(entry), embedding, bytes);
+
+    int bucket          = bucketOf(cache, key);
+    entry->nextInBucket = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    pushNewest(cache, entry);
+    cache->stats.memoryUsed += bytes;
+    cache->stats.numEntries++;
+
+    growBuckets(cache);
+    return 0;
+}
+
+static void diskFilePath(const TinyAIEmbeddingCache *cache, uint64_t key, const char *suffix,
+                         char *path)
+{
+    snprintf(path, MAX_PATH_LENGTH, "%s/%016" PRIx64 "%s%s", cache->diskPath, key,
+             TINYAI_EMBEDDING_CACHE_EXTENSION, suffix);
+}
+
+static int readFromDisk(const TinyAIEmbeddingCache *cache, uint64_t key, float *embedding,
+                        int size)
+{
+    char path[MAX_PATH_LENGTH];
+    diskFilePath(cache, key, "", path);
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    DiskHeader header;
+    int        ok = fread(&header, sizeof(header), 1, file) == 1 &&
+             header.magic == TINYAI_EMBEDDING_CACHE_MAGIC &&
+             header.version == TINYAI_EMBEDDING_CACHE_VERSION && header.size == size &&
+             fread(embedding, sizeof(float), (size_t)size, file) == (size_t)size;
+    fclose(file);
+
+    return ok ? 0 : -1;
+}
+
+/*
+ * Write an entry through a temporary file renamed into place, so readers in other
+ * processes never see half a file. Entries are content-addressed, so an existing
+ * file already holds the same embedding and is kept.
+ */
+static int writeToDisk(const TinyAIEmbeddingCache *cache, uint64_t key, const float *embedding,
+                       int size)
+{
+    char path[MAX_PATH_LENGTH];
+    char tempPath[MAX_PATH_LENGTH];
+    diskFilePath(cache, key, "", path);
+    diskFilePath(cache, key, ".tmp", tempPath);
+
+    FILE *existing = fopen(path, "rb");
+    if (existing) {
+        fclose(existing);
+        return 0;
+    }
+
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    DiskHeader header = {TINYAI_EMBEDDING_CACHE_MAGIC, TINYAI_EMBEDDING_CACHE_VERSION,
+                         (int32_t)size, 0};
+    int        ok     = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(embedding, sizeof(float), (size_t)size, file) == (size_t)size;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Create an embedding cache
+ */
+TinyAIEmbeddingCache *tinyaiCreateEmbeddingCache(size_t memoryLimit, const char *diskPath)
+{
+    TinyAIEmbeddingCache *cache = (TinyAIEmbeddingCache *)calloc(1, sizeof(TinyAIEmbeddingCache));
+    if (!cache) {
+        fprintf(stderr, "Failed to allocate embedding cache\n");
+        return NULL;
+    }
+#ifdef _WIN32
+    InitializeSRWLock(&cache->lock);
+#else
+    pthread_mutex_init(&cache->lock, NULL);
+#endif
+
+    cache->memoryLimit = memoryLimit;
+    cache->numBuckets  = INITIAL_BUCKETS;
+    cache->buckets     = (CacheEntry **)calloc(INITIAL_BUCKETS, sizeof(CacheEntry *));
+    if (!cache->buckets) {
+        fprintf(stderr, "Failed to allocate embedding cache buckets\n");
+        free(cache);
+        return NULL;
+    }
+
+    if (diskPath) {
+        size_t length = strlen(diskPath);
+        if (length + 32 > MAX_PATH_LENGTH) {
+            fprintf(stderr, "Embedding cache path too long: %s\n", diskPath);
+            tinyaiDestroyEmbeddingCache(cache);
+            return NULL;
+        }
+        cache->diskPath = (char *)malloc(length + 1);
+        if (!cache->diskPath) {
+            fprintf(stderr, "Failed to allocate embedding cache path\n");
+            tinyaiDestroyEmbeddingCache(cache);
+            return NULL;
+        }
+        memcpy(cache->diskPath, diskPath, length + 1);
+    }
+
+    return cache;
+}
+
+/**
+ * Free an embedding cache
+ */
+void tinyaiDestroyEmbeddingCache(TinyAIEmbeddingCache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    if (cache->buckets) {
+        tinyaiEmbeddingCacheClear(cache);
+        free(cache->buckets);
+    }
+#ifndef _WIN32
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    free(cache->diskPath);
+    free(cache);
+}
+
+/**
+ * Remove every entry from the memory tier
+ */
+void tinyaiEmbeddingCacheClear(TinyAIEmbeddingCache *cache)
+{
+    if (cache) {
+        tinyaiEmbeddingCacheTrim(cache, 0);
+    }
+}
+
+/**
+ * Hash an encoder's identity
+ */
+uint64_t tinyaiEmbeddingCacheEncoderHash(const char *name, const int *shape, int count)
+{
+    uint64_t hash = FNV_OFFSET;
+
+    if (name) {
+        hash = hashBytes(hash, name, strlen(name) + 1);
+    }
+    for (int i = 0; shape && i < count; i++) {
+        hash = hashInt(hash, shape[i]);
+    }
+    return hash;
+}
+
+/**
+ * Compute the key of an image under an encoder
+ */
+uint64_t tinyaiEmbeddingCacheKey(const TinyAIImage *image, uint64_t encoderHash)
+{
+    uint64_t hash = hashInt(FNV_OFFSET, (int64_t)encoderHash);
+    if (!image) {
+        return hash;
+    }
+
+    int channels;
+    switch (image->format) {
+    case TINYAI_IMAGE_FORMAT_GRAYSCALE:
+        channels = 1;
+        break;
+    case TINYAI_IMAGE_FORMAT_RGBA:
+        channels = 4;
+        break;
+    default:
+        channels = 3;
+        break;
+    }
+
+    hash = hashInt(hash, image->width);
+    hash = hashInt(hash, image->height);
+    hash = hashInt(hash, image->format);
+    if (image->data && image->width > 0 && image->height > 0) {
+        hash = hashBytes(hash, image->data, (size_t)image->width * image->height * channels);
+    }
+    return hash;
+}
+
+/**
+ * Look up the embedding stored under a key
+ */
+int tinyaiEmbeddingCacheLookup(TinyAIEmbeddingCache *cache, uint64_t key, float *embedding,
+                               int size)
+{
+    if (!cache || !embedding || size <= 0) {
+        return -1;
+    }
+
+    lockCache(cache);
+    CacheEntry *entry = findEntry(cache, key);
+    if (entry && entry->size == size) {
+        memcpy(embedding, entryEmbedding(entry), (size_t)size * sizeof(float));
+        unlinkLRU(cache, entry);
+        pushNewest(cache, entry);
+        cache->stats.memoryHits++;
+        unlockCache(cache);
+        return 0;
+    }
+
+    int result = -1;
+    if (cache->diskPath && readFromDisk(cache, key, embedding, size) == 0) {
+        storeInMemory(cache, key, embedding, size);
+        cache->stats.diskHits++;
+        result = 0;
+    }
+    else {
+        cache->stats.misses++;
+    }
+    unlockCache(cache);
+    return result;
+}
+
+/**
+ * Store the embedding of a key
+ */
+int tinyaiEmbeddingCacheInsert(TinyAIEmbeddingCache *cache, uint64_t key, const float *embedding,
+                               int size)
+{
+    if (!cache || !embedding || size <= 0) {
+        return -1;
+    }
+
+    lockCache(cache);
+    int result = storeInMemory(cache, key, embedding, size);
+    if (result == 0 && cache->diskPath && writeToDisk(cache, key, embedding, size) != 0) {
+        fprintf(stderr, "Failed to write embedding %016" PRIx64 " to %s\n", key, cache->diskPath);
+        result = -1;
+    }
+    unlockCache(cache);
+    return result;
+}
+
+/**
+ * Evict least recently used entries down to a byte target
+ */
+size_t tinyaiEmbeddingCacheTrim(TinyAIEmbeddingCache *cache, size_t targetBytes)
+{
+    if (!cache) {
+        return 0;
+    }
+
+    lockCache(cache);
+    size_t before = cache->stats.memoryUsed;
+    evictTo(cache, targetBytes);
+    size_t released = before - cache->stats.memoryUsed;
+    unlockCache(cache);
+    return released;
+}
+
+/**
+ * Get the statistics of an embedding cache
+ */
+void tinyaiEmbeddingCacheGetStats(const TinyAIEmbeddingCache *cache,
+                                  TinyAIEmbeddingCacheStats   *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!cache) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    lockCache(cache);
+    *stats = cache->stats;
+    unlockCache(cache);
+}
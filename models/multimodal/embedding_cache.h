@@ -0,0 +1,150 @@
+/**
+ * @file embedding_cache.h
+ * @brief Content-addressed cache of image encoder outputs
+ *
+ * Stores the embedding an image encoder produced for an image, keyed by a
+ * hash of the pixels and of the encoder, so later requests about the same
+ * image (follow-up questions, caption tokens, tags) skip the encoder. Recent
+ * entries are kept in memory under a byte limit with LRU eviction; an
+ * optional directory holds every entry as a file, so embeddings outlive the
+ * memory tier and the process.
+ */
+
+#ifndef TINYAI_EMBEDDING_CACHE_H
+#define TINYAI_EMBEDDING_CACHE_H
+
+#include "../image/image_model.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Disk tier file format
+ *
+ * One file per entry, named by the key in 16 hex digits with the extension
+ * below: a little-endian header of magic, version and embedding size, then
+ * the embedding as floats.
+ */
+#define TINYAI_EMBEDDING_CACHE_MAGIC 0x45454154 /* "TAEE" in ASCII */
+#define TINYAI_EMBEDDING_CACHE_VERSION 1
+#define TINYAI_EMBEDDING_CACHE_EXTENSION ".emb"
+
+/**
+ * Image embedding cache (opaque)
+ *
+ * A cache may be shared by several models: keys include the encoder, so
+ * entries of different encoders never collide. Every call takes the cache's
+ * lock, so encoders running on different threads may share one cache.
+ */
+typedef struct TinyAIEmbeddingCache TinyAIEmbeddingCache;
+
+/**
+ * Cache statistics
+ */
+typedef struct {
+    uint64_t memoryHits; /* Lookups served from memory */
+    uint64_t diskHits;   /* Lookups served from the disk tier */
+    uint64_t misses;     /* Lookups that found no entry */
+    size_t   memoryUsed; /* Bytes of embeddings in memory */
+    int      numEntries; /* Entries in memory */
+} TinyAIEmbeddingCacheStats;
+
+/**
+ * Create an embedding cache
+ *
+ * @param memoryLimit Maximum bytes of embeddings in memory; least recently
+ *                    used entries are evicted beyond it
+ * @param diskPath Existing directory for the disk tier, or NULL for memory only
+ * @return New embedding cache or NULL on error
+ */
+TinyAIEmbeddingCache *tinyaiCreateEmbeddingCache(size_t memoryLimit, const char *diskPath);
+
+/**
+ * Free an embedding cache; the disk tier is kept
+ *
+ * @param cache Embedding cache to free
+ */
+void tinyaiDestroyEmbeddingCache(TinyAIEmbeddingCache *cache);
+
+/**
+ * Remove every entry from the memory tier of an embedding cache
+ *
+ * @param cache Embedding cache to clear
+ */
+void tinyaiEmbeddingCacheClear(TinyAIEmbeddingCache *cache);
+
+/**
+ * Hash an encoder's identity: a name (such as its weights path) and its shape
+ *
+ * @param name Name of the encoder, or NULL
+ * @param shape Integers describing the encoder
+ * @param count Number of integers in shape
+ * @return Encoder hash, to pass to tinyaiEmbeddingCacheKey
+ */
+uint64_t tinyaiEmbeddingCacheEncoderHash(const char *name, const int *shape, int count);
+
+/**
+ * Compute the key of an image under an encoder
+ *
+ * Covers the image's size, format and every pixel, so any change to the
+ * image changes the key.
+ *
+ * @param image Image to key
+ * @param encoderHash Hash of the encoder, from tinyaiEmbeddingCacheEncoderHash
+ * @return Key of the image's embedding
+ */
+uint64_t tinyaiEmbeddingCacheKey(const TinyAIImage *image, uint64_t encoderHash);
+
+/**
+ * Look up the embedding stored under a key
+ *
+ * Tries memory, then the disk tier; an entry read from disk is kept in
+ * memory for the next lookup.
+ *
+ * @param cache Embedding cache
+ * @param key Key from tinyaiEmbeddingCacheKey
+ * @param embedding Output embedding (size floats)
+ * @param size Number of floats in the embedding
+ * @return 0 on a hit, -1 on a miss or error
+ */
+int tinyaiEmbeddingCacheLookup(TinyAIEmbeddingCache *cache, uint64_t key, float *embedding,
+                               int size);
+
+/**
+ * Store the embedding of a key, in memory and in the disk tier
+ *
+ * @param cache Embedding cache
+ * @param key Key from tinyaiEmbeddingCacheKey
+ * @param embedding Embedding to store (size floats)
+ * @param size Number of floats in the embedding
+ * @return 0 on success, -1 on error or if the entry exceeds the memory limit
+ */
+int tinyaiEmbeddingCacheInsert(TinyAIEmbeddingCache *cache, uint64_t key, const float *embedding,
+                               int size);
+
+/**
+ * Evict least recently used entries until at most targetBytes remain in memory
+ *
+ * @param cache Embedding cache
+ * @param targetBytes Bytes of embeddings to keep at most
+ * @return Bytes released
+ */
+size_t tinyaiEmbeddingCacheTrim(TinyAIEmbeddingCache *cache, size_t targetBytes);
+
+/**
+ * Get the statistics of an embedding cache
+ *
+ * @param cache Embedding cache
+ * @param stats Output statistics
+ */
+void tinyaiEmbeddingCacheGetStats(const TinyAIEmbeddingCache *cache,
+                                  TinyAIEmbeddingCacheStats   *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_EMBEDDING_CACHE_H */
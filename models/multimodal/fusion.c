@@ -4,13 +4,57 @@
  */
 
 #include "fusion.h"
+#include "../../utils/quantize.h"
 #include "../../utils/simd_ops.h"
+#include "../text/attention.h"
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* Queries per head when cross-attention spreads one modality's features over heads */
+#define CROSS_ATTENTION_HEAD_QUERIES 64
+
+/* Most heads cross-attention splits its queries into */
+#define CROSS_ATTENTION_MAX_HEADS 16
+
+/**
+ * Combine same-sized modality features elementwise in as few passes as possible
+ *
+ * fusedOutput = w[0] * outputs[0] + w[1] * outputs[1] + ... for
+ * TINYAI_SIMD_EW_RESIDUAL (weights NULL for all ones), or the product of the
+ * outputs for TINYAI_SIMD_EW_MULTIPLY. Each pass folds up to
+ * TINYAI_SIMD_ELEMENTWISE_MAX_OPS modalities into the output.
+ */
+static bool combineModalities(const float **outputs, const float *weights, int numModalities,
+                              float *fusedOutput, int fusedDim, int type)
+{
+    TinyAIElementwiseOp ops[TINYAI_SIMD_ELEMENTWISE_MAX_OPS];
+
+    /* The first pass starts from the first modality instead of a cleared output */
+    const float *in    = outputs[0];
+    int          first = 1;
+    int          count = 0;
+    if (type == TINYAI_SIMD_EW_RESIDUAL && weights) {
+        ops[count++] = (TinyAIElementwiseOp){TINYAI_SIMD_EW_SCALE, 0, NULL, NULL, weights[0], 0.0f};
+    }
+
+    do {
+        for (; first < numModalities && count < TINYAI_SIMD_ELEMENTWISE_MAX_OPS; first++) {
+            float weight = weights ? weights[first] : 1.0f;
+            ops[count++] = (TinyAIElementwiseOp){type, 0, outputs[first], NULL, weight, 0.0f};
+        }
+        if (tinyaiSimdElementwise(fusedOutput, in, 1, fusedDim, ops, count) != 0) {
+            return false;
+        }
+        in    = fusedOutput;
+        count = 0;
+    } while (first < numModalities);
+
+    return true;
+}
+
 /**
  * Concatenation-based fusion of multiple modality features
  *
@@ -49,8 +93,11 @@ bool tinyaiFusionConcat(const float **outputs, const int *outDims, int numModali
             return false;
         }
 
-        /* Copy this modality's features to the appropriate position in fusedOutput */
-        memcpy(fusedOutput + offset, outputs[i], outDims[i] * sizeof(float));
+        /* Copy this modality's features to the appropriate position in fusedOutput,
+           unless the encoder already wrote them there */
+        if (outputs[i] != fusedOutput + offset) {
+            memcpy(fusedOutput + offset, outputs[i], outDims[i] * sizeof(float));
+        }
         offset += outDims[i];
     }
 
@@ -89,17 +136,9 @@ bool tinyaiFusionAdd(const float **outputs, const int *outDims, int numModalitie
         }
     }
 
-    /* Initialize output with zeros */
-    memset(fusedOutput, 0, fusedDim * sizeof(float));
-
     /* Add all modality features */
-    for (int i = 0; i < numModalities; i++) {
-        for (int j = 0; j < fusedDim; j++) {
-            fusedOutput[j] += outputs[i][j];
-        }
-    }
-
-    return true;
+    return combineModalities(outputs, NULL, numModalities, fusedOutput, fusedDim,
+                             TINYAI_SIMD_EW_RESIDUAL);
 }
 
 /**
@@ -135,51 +174,9 @@ bool tinyaiFusionMultiply(const float **outputs, const int *outDims, int numModa
         }
     }
 
-    /* Initialize output with ones */
-    for (int j = 0; j < fusedDim; j++) {
-        fusedOutput[j] = 1.0f;
-    }
-
     /* Multiply all modality features */
-    for (int i = 0; i < numModalities; i++) {
-        for (int j = 0; j < fusedDim; j++) {
-            fusedOutput[j] *= outputs[i][j];
-        }
-    }
-
-    return true;
-}
-
-/**
- * Softmax function
- */
-static void softmax(float *input, int size)
-{
-    if (!input || size <= 0) {
-        return;
-    }
-
-    /* Find maximum for numerical stability */
-    float maxVal = input[0];
-    for (int i = 1; i < size; i++) {
-        if (input[i] > maxVal) {
-            maxVal = input[i];
-        }
-    }
-
-    /* Compute softmax */
-    float sum = 0.0f;
-    for (int i = 0; i < size; i++) {
-        input[i] = expf(input[i] - maxVal);
-        sum += input[i];
-    }
-
-    /* Normalize */
-    if (sum > 0.0f) {
-        for (int i = 0; i < size; i++) {
-            input[i] /= sum;
-        }
-    }
+    return combineModalities(outputs, NULL, numModalities, fusedOutput, fusedDim,
+                             TINYAI_SIMD_EW_MULTIPLY);
 }
 
 /**
@@ -221,15 +218,9 @@ bool tinyaiFusionAttention(const float **outputs, const int *outDims, int numMod
 
     /* If weights are provided, use them directly */
     if (weights) {
-        /* Initialize output with zeros */
-        memset(fusedOutput, 0, fusedDim * sizeof(float));
-
         /* Apply attention weights */
-        for (int i = 0; i < numModalities; i++) {
-            for (int j = 0; j < fusedDim; j++) {
-                fusedOutput[j] += weights[i] * outputs[i][j];
-            }
-        }
+        return combineModalities(outputs, weights, numModalities, fusedOutput, fusedDim,
+                                 TINYAI_SIMD_EW_RESIDUAL);
     }
     else {
         /* Compute attention weights based on feature magnitudes */
@@ -241,30 +232,73 @@ bool tinyaiFusionAttention(const float **outputs, const int *outDims, int numMod
 
         /* Compute squared magnitudes */
         for (int i = 0; i < numModalities; i++) {
-            float squaredMag = 0.0f;
-            for (int j = 0; j < outDims[i]; j++) {
-                squaredMag += outputs[i][j] * outputs[i][j];
-            }
-            attentionWeights[i] = squaredMag;
+            attentionWeights[i] = tinyaiSimdDot(outputs[i], outputs[i], outDims[i]);
         }
 
         /* Apply softmax to get attention weights */
-        softmax(attentionWeights, numModalities);
-
-        /* Initialize output with zeros */
-        memset(fusedOutput, 0, fusedDim * sizeof(float));
+        tinyaiSimdSoftmax(attentionWeights, numModalities);
 
         /* Apply attention weights */
-        for (int i = 0; i < numModalities; i++) {
-            for (int j = 0; j < fusedDim; j++) {
-                fusedOutput[j] += attentionWeights[i] * outputs[i][j];
-            }
-        }
+        bool success = combineModalities(outputs, attentionWeights, numModalities, fusedOutput,
+                                         fusedDim, TINYAI_SIMD_EW_RESIDUAL);
 
         free(attentionWeights);
+        return success;
     }
+}
 
-    return true;
+/**
+ * Attend each feature of one modality, as a one-dimensional query, over the features of another
+ *
+ * out[i] = sum_j softmax_j(query[i] * keys[j]) * keys[j], computed by the tiled attention
+ * kernel so the [queryDim x keyDim] score matrix is never stored. The queries are spread
+ * over heads that share a single key/value head, so the thread pool splits them.
+ */
+static bool attendFeatures(const float *query, int queryDim, const float *keys, int keyDim,
+                           float *out)
+{
+    uint32_t numHeads = (uint32_t)queryDim / CROSS_ATTENTION_HEAD_QUERIES;
+    if (numHeads < 1) {
+        numHeads = 1;
+    }
+    if (numHeads > CROSS_ATTENTION_MAX_HEADS) {
+        numHeads = CROSS_ATTENTION_MAX_HEADS;
+    }
+    uint32_t length = ((uint32_t)queryDim + numHeads - 1) / numHeads;
+
+    /* Queries and context as [length x numHeads]; head h holds features [h * length, ...) */
+    size_t size    = (size_t)length * numHeads;
+    float *queries = (float *)malloc(2 * size * sizeof(float));
+    if (!queries) {
+        fprintf(stderr, "Failed to allocate cross-attention queries\n");
+        return false;
+    }
+    float *context = queries + size;
+
+    for (size_t i = 0; i < size; i++) {
+        size_t position                     = i % length;
+        size_t head                         = i / length;
+        queries[position * numHeads + head] = i < (size_t)queryDim ? query[i] : 0.0f;
+    }
+
+    TinyAIAttentionParams params;
+    memset(&params, 0, sizeof(params));
+    params.batchSize   = 1;
+    params.seqLength   = (uint32_t)keyDim;
+    params.numHeads    = numHeads;
+    params.numKVHeads  = 1;
+    params.headDim     = 1;
+    params.hiddenDim   = numHeads;
+    params.scaleFactor = 1.0f;
+
+    bool success = tinyaiSimdAttentionTiled(&params, queries, keys, keys, context, length,
+                                            (uint32_t)keyDim, 0, 0, NULL) == 0;
+    for (int i = 0; success && i < queryDim; i++) {
+        out[i] = context[(size_t)(i % length) * numHeads + i / length];
+    }
+
+    free(queries);
+    return success;
 }
 
 /**
@@ -278,7 +312,7 @@ bool tinyaiFusionAttention(const float **outputs, const int *outDims, int numMod
  * @param dim2 Dimension of modality 2 features
  * @param fusedOutput Output buffer for fused features
  * @param fusedDim Dimension of the fused feature space
- * @param weights Attention weights (can be NULL for learned attention)
+ * @param weights Reserved for learned attention; ignored
  * @param useQuantization Whether to use 4-bit quantized weights
  * @param useSIMD Whether to use SIMD acceleration
  * @return true on success, false on failure
@@ -287,104 +321,23 @@ bool tinyaiFusionCrossAttention(const float *output1, int dim1, const float *out
                                 float *fusedOutput, int fusedDim, const float *weights,
                                 bool useQuantization, bool useSIMD)
 {
-    if (!output1 || !output2 || !fusedOutput || dim1 <= 0 || dim2 <= 0 || fusedDim <= 0) {
-        return false;
-    }
-
-    /* Compute attention matrix: dim1 x dim2 */
-    float *attentionMatrix = (float *)malloc(dim1 * dim2 * sizeof(float));
-    if (!attentionMatrix) {
-        fprintf(stderr, "Failed to allocate attention matrix\n");
-        return false;
-    }
-
-    /* Calculate dot products for attention scores */
-    for (int i = 0; i < dim1; i++) {
-        for (int j = 0; j < dim2; j++) {
-            attentionMatrix[i * dim2 + j] = output1[i] * output2[j];
-        }
-    }
-
-    /* Apply softmax row-wise */
-    for (int i = 0; i < dim1; i++) {
-        softmax(&attentionMatrix[i * dim2], dim2);
-    }
-
-    /* Compute attention-weighted features */
-    float *attended1 = (float *)malloc(dim1 * sizeof(float));
-    float *attended2 = (float *)malloc(dim2 * sizeof(float));
-    if (!attended1 || !attended2) {
-        fprintf(stderr, "Failed to allocate attended features\n");
-        free(attentionMatrix);
-        if (attended1)
-            free(attended1);
-        if (attended2)
-            free(attended2);
-        return false;
-    }
+    (void)weights;
+    (void)useQuantization;
+    (void)useSIMD;
 
-    /* Initialize to zeros */
-    memset(attended1, 0, dim1 * sizeof(float));
-    memset(attended2, 0, dim2 * sizeof(float));
-
-    /* Compute attended features */
-    for (int i = 0; i < dim1; i++) {
-        for (int j = 0; j < dim2; j++) {
-            attended1[i] += attentionMatrix[i * dim2 + j] * output2[j];
-        }
-    }
-
-    /* Compute attention from modality 2 to modality 1 */
-    float *attentionMatrix2 = (float *)malloc(dim2 * dim1 * sizeof(float));
-    if (!attentionMatrix2) {
-        fprintf(stderr, "Failed to allocate second attention matrix\n");
-        free(attentionMatrix);
-        free(attended1);
-        free(attended2);
+    if (!output1 || !output2 || !fusedOutput || dim1 <= 0 || dim2 <= 0 || fusedDim <= 0) {
         return false;
     }
 
-    /* Transpose the attention matrix */
-    for (int i = 0; i < dim2; i++) {
-        for (int j = 0; j < dim1; j++) {
-            attentionMatrix2[i * dim1 + j] = attentionMatrix[j * dim2 + i];
-        }
-    }
-
-    /* Apply softmax row-wise */
-    for (int i = 0; i < dim2; i++) {
-        softmax(&attentionMatrix2[i * dim1], dim1);
-    }
-
-    /* Compute attended features for modality 2 */
-    for (int i = 0; i < dim2; i++) {
-        for (int j = 0; j < dim1; j++) {
-            attended2[i] += attentionMatrix2[i * dim1 + j] * output1[j];
-        }
-    }
-
-    /* Concatenate the attended features */
-    if (fusedDim == dim1 + dim2) {
-        memcpy(fusedOutput, attended1, dim1 * sizeof(float));
-        memcpy(fusedOutput + dim1, attended2, dim2 * sizeof(float));
-    }
-    else {
+    if (fusedDim != dim1 + dim2) {
         fprintf(stderr, "Fusion dimension mismatch for cross-attention: %d, expected %d\n",
                 fusedDim, dim1 + dim2);
-        free(attentionMatrix);
-        free(attentionMatrix2);
-        free(attended1);
-        free(attended2);
         return false;
     }
 
-    /* Clean up */
-    free(attentionMatrix);
-    free(attentionMatrix2);
-    free(attended1);
-    free(attended2);
-
-    return true;
+    /* Each modality attends to the other; the attended features are concatenated */
+    return attendFeatures(output1, dim1, output2, dim2, fusedOutput) &&
+           attendFeatures(output2, dim2, output1, dim1, fusedOutput + dim1);
 }
 
 /**
@@ -403,74 +356,33 @@ bool tinyaiFusionCrossAttention(const float *output1, int dim1, const float *out
 bool tinyaiFusionProject(const float *input, int inputDim, float *output, int outputDim,
                          const void *weights, const float *bias, bool useQuantization, bool useSIMD)
 {
+    (void)useSIMD;
+
     if (!input || !output || !weights || inputDim <= 0 || outputDim <= 0) {
         return false;
     }
 
-    /* Initialize output to zeros */
-    memset(output, 0, outputDim * sizeof(float));
-
     if (useQuantization) {
-        /* Use 4-bit quantized weights */
-        const uint8_t *quantWeights = (const uint8_t *)weights;
-
-        /* Use SIMD if available */
-        if (useSIMD) {
-            /* Scale factors for dequantization should be passed as part of the weights */
-            const float *scaleFactors =
-                (const float *)(quantWeights + (inputDim * outputDim + 1) / 2);
-
-            /* Use SIMD acceleration for matrix-vector multiplication */
-            tinyaiSimdMatMul4Bit(output, quantWeights, input, outputDim, inputDim, scaleFactors);
-        }
-        else {
-            /* Reference implementation for 4-bit quantized weights */
-            const float *scaleFactors =
-                (const float *)(quantWeights + (inputDim * outputDim + 1) / 2);
-
-            for (int i = 0; i < outputDim; i++) {
-                float sum = 0.0f;
-                for (int j = 0; j < inputDim; j += 2) {
-                    int byteIdx = (i * inputDim + j) / 2;
-                    int blockIdx =
-                        (i * inputDim + j) / 32; /* Assuming 16 values per scale factor */
-
-                    /* Extract two 4-bit weights from one byte */
-                    uint8_t byte = quantWeights[byteIdx];
-                    int8_t  w1   = (int8_t)((byte & 0xF0) >> 4) - 8; /* Convert 4-bit to signed */
-
-                    /* Apply first weight */
-                    sum += (float)w1 * scaleFactors[blockIdx] * input[j];
-
-                    /* Apply second weight if we're not at the end */
-                    if (j + 1 < inputDim) {
-                        int8_t w2 = (int8_t)(byte & 0x0F) - 8; /* Convert 4-bit to signed */
-                        sum += (float)w2 * scaleFactors[blockIdx] * input[j + 1];
-                    }
-                }
-                output[i] = sum;
-            }
+        /* Packed 4-bit weights [inputDim x outputDim]: the shared GEMM adds the bias */
+        const TinyAIMatrix4bit *matrix = (const TinyAIMatrix4bit *)weights;
+        if (matrix->rows != (uint32_t)inputDim || matrix->cols != (uint32_t)outputDim) {
+            fprintf(stderr, "Projection weights are %ux%u, expected %dx%d\n", matrix->rows,
+                    matrix->cols, inputDim, outputDim);
+            return false;
         }
+        return tinyaiMatrix4bitVecMul(matrix, input, bias, output) == 0;
     }
-    else {
-        /* Use full-precision weights */
-        const float *floatWeights = (const float *)weights;
-
-        /* Perform matrix-vector multiplication */
-        for (int i = 0; i < outputDim; i++) {
-            float sum = 0.0f;
-            for (int j = 0; j < inputDim; j++) {
-                sum += floatWeights[i * inputDim + j] * input[j];
-            }
-            output[i] = sum;
-        }
+
+    /* Full-precision weights [outputDim x inputDim], one dot product per output */
+    const float *floatWeights = (const float *)weights;
+    for (int i = 0; i < outputDim; i++) {
+        output[i] = tinyaiSimdDot(floatWeights + (size_t)i * inputDim, input, inputDim);
     }
 
     /* Add bias if provided */
     if (bias) {
-        for (int i = 0; i < outputDim; i++) {
-            output[i] += bias[i];
-        }
+        TinyAIElementwiseOp addBias = {TINYAI_SIMD_EW_BIAS, 0, bias, NULL, 0.0f, 0.0f};
+        return tinyaiSimdElementwise(output, output, 1, outputDim, &addBias, 1) == 0;
     }
 
     return true;
@@ -19,6 +19,9 @@ extern "C" {
 /**
  * Concatenation-based fusion of multiple modality features
  *
+ * Features an encoder wrote straight into their place in fusedOutput are not
+ * copied again.
+ *
  * @param outputs Array of feature vectors from different modalities
  * @param outDims Array of feature dimensions from different modalities
  * @param numModalities Number of modalities to fuse
@@ -75,7 +78,9 @@ bool tinyaiFusionAttention(const float **outputs, const int *outDims, int numMod
 /**
  * Cross-attention between two modalities
  *
- * Performs cross-attention where each modality attends to the other's features
+ * Performs cross-attention where each modality attends to the other's features. Every feature
+ * acts as a one-dimensional query over the other modality's features through the tiled
+ * attention kernel; the two attended vectors are concatenated, so fusedDim must be dim1 + dim2.
  *
  * @param output1 Feature vector from modality 1
  * @param dim1 Dimension of modality 1 features
@@ -83,7 +88,7 @@ bool tinyaiFusionAttention(const float **outputs, const int *outDims, int numMod
  * @param dim2 Dimension of modality 2 features
  * @param fusedOutput Output buffer for fused features
  * @param fusedDim Dimension of the fused feature space
- * @param weights Attention weights (can be NULL for learned attention)
+ * @param weights Reserved for learned attention; ignored
  * @param useQuantization Whether to use 4-bit quantized weights
  * @param useSIMD Whether to use SIMD acceleration
  * @return true on success, false on failure
@@ -99,10 +104,11 @@ bool tinyaiFusionCrossAttention(const float *output1, int dim1, const float *out
  * @param inputDim Input feature dimension
  * @param output Output feature vector
  * @param outputDim Output feature dimension
- * @param weights Projection weights
+ * @param weights Projection weights: a float matrix [outputDim x inputDim], or a
+ *                TinyAIMatrix4bit [inputDim x outputDim] when useQuantization is set
  * @param bias Projection bias (can be NULL)
- * @param useQuantization Whether to use 4-bit quantized weights
- * @param useSIMD Whether to use SIMD acceleration
+ * @param useQuantization Whether weights is a 4-bit quantized matrix
+ * @param useSIMD Ignored; the SIMD kernels are selected at runtime
  * @return true on success, false on failure
  */
 bool tinyaiFusionProject(const float *input, int inputDim, float *output, int outputDim,
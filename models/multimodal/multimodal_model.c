@@ -5,11 +5,16 @@
 
 #include "multimodal_model.h"
 #include "../../core/memory.h"
+#include "../../utils/thread_pool.h"
 #include "fusion.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 /* Forward declaration of Layer struct for internal use */
 typedef struct Layer Layer;
@@ -66,6 +71,8 @@ typedef struct {
     size_t weightBytes; /* Size of weights in bytes */
     size_t biasBytes;   /* Size of biases in bytes */
     size_t outputBytes; /* Size of output in bytes */
+
+    uint64_t cacheHash; /* Encoder hash for embedding cache keys */
 } ModalityEncoder;
 
 /* Define the MultimodalModel structure */
@@ -87,10 +94,44 @@ struct TinyAIMultimodalModel {
     bool  useExternalMemory;
     bool  useSIMD;
     bool  useQuantization;
+
+    /* Cache of image encoder outputs (not owned) */
+    TinyAIEmbeddingCache *embeddingCache;
 };
 
+/**
+ * One modality encoder run, queued on the thread pool by tinyaiMultimodalModelProcess
+ */
+typedef struct {
+    TinyAIMultimodalModel *model;
+    const ModalityEncoder *encoder;
+    const void            *input;
+    int                    inputLength;
+    float                 *output;
+    bool                   success;
+    uint64_t               elapsedNs;
+} EncoderTask;
+
 /* Private functions */
 
+/* Get a monotonic time in nanoseconds */
+static uint64_t getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        count;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)((double)count.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 /**
  * Initialize a modality encoder
  */
@@ -307,6 +348,13 @@ TinyAIMultimodalModel *tinyaiMultimodalModelCreate(const TinyAIMultimodalModelPa
             free(model);
             return NULL;
         }
+
+        /* Identify the encoder by its weights and shape, so cached embeddings of other
+         * encoders never match */
+        ModalityEncoder *encoder = &model->modalityEncoders[i];
+        int shape[4] = {encoder->type, encoder->inputDim, encoder->outputDim,
+                        params->useQuantization};
+        encoder->cacheHash = tinyaiEmbeddingCacheEncoderHash(params->weightsFile, shape, 4);
     }
 
     /* Allocate fusion layers if needed */
@@ -458,6 +506,41 @@ static bool processModality(const ModalityEncoder *encoder, const void *input, i
     return true;
 }
 
+/**
+ * Encode one modality, serving images from the embedding cache when it holds them
+ */
+static bool encodeModality(TinyAIMultimodalModel *model, const ModalityEncoder *encoder,
+                           const void *input, int inputLength, float *output)
+{
+    if (encoder->type != TINYAI_MODALITY_IMAGE || !model->embeddingCache || !input) {
+        return processModality(encoder, input, inputLength, output, model->useSIMD);
+    }
+
+    uint64_t key = tinyaiEmbeddingCacheKey((const TinyAIImage *)input, encoder->cacheHash);
+    if (tinyaiEmbeddingCacheLookup(model->embeddingCache, key, output, encoder->outputDim) == 0) {
+        return true;
+    }
+
+    if (!processModality(encoder, input, inputLength, output, model->useSIMD)) {
+        return false;
+    }
+
+    /* A failed insert only costs a later re-encode */
+    tinyaiEmbeddingCacheInsert(model->embeddingCache, key, output, encoder->outputDim);
+    return true;
+}
+
+/* Task group entry point: encode one modality and time it */
+static void runEncoderTask(void *context)
+{
+    EncoderTask *task = (EncoderTask *)context;
+    uint64_t     start = getTimeNs();
+
+    task->success =
+        encodeModality(task->model, task->encoder, task->input, task->inputLength, task->output);
+    task->elapsedNs = getTimeNs() - start;
+}
+
 /**
  * Process multimodal input
  * @param model The model to use
@@ -491,12 +574,21 @@ bool tinyaiMultimodalModelProcess(TinyAIMultimodalModel *model, const TinyAIMult
         }
     }
 
-    /* Process each modality */
+    EncoderTask *tasks = (EncoderTask *)calloc(model->numModalities, sizeof(EncoderTask));
+    if (!tasks) {
+        fprintf(stderr, "Failed to allocate encoder tasks\n");
+        for (int i = 0; i < model->numModalities; i++) {
+            free(encoderOutputs[i]);
+        }
+        free(encoderOutputs);
+        return false;
+    }
+
+    /* Get the input of each modality */
     for (int i = 0; i < model->numModalities; i++) {
         const void *modalityInput = NULL;
         int         inputLength   = 0;
 
-        /* Get input for this modality */
         switch (model->modalityEncoders[i].type) {
         case TINYAI_MODALITY_TEXT:
             modalityInput = input->textInput;
@@ -515,6 +607,7 @@ bool tinyaiMultimodalModelProcess(TinyAIMultimodalModel *model, const TinyAIMult
 
         default:
             fprintf(stderr, "Unknown modality type: %d\n", model->modalityEncoders[i].type);
+            free(tasks);
             for (int j = 0; j < model->numModalities; j++) {
                 free(encoderOutputs[j]);
             }
@@ -522,16 +615,50 @@ bool tinyaiMultimodalModelProcess(TinyAIMultimodalModel *model, const TinyAIMult
             return false;
         }
 
-        /* Process this modality */
-        if (!processModality(&model->modalityEncoders[i], modalityInput, inputLength,
-                             encoderOutputs[i], model->useSIMD)) {
+        tasks[i].model       = model;
+        tasks[i].encoder     = &model->modalityEncoders[i];
+        tasks[i].input       = modalityInput;
+        tasks[i].inputLength = inputLength;
+        tasks[i].output      = encoderOutputs[i];
+    }
+
+    /* The encoders are independent until fusion: run them concurrently and join */
+    uint64_t         encodeStart = getTimeNs();
+    TinyAITaskGroup *group       = tinyaiCreateTaskGroup(tinyaiGetThreadPool());
+    for (int i = 0; i < model->numModalities; i++) {
+        if (group) {
+            tinyaiTaskGroupRun(group, runEncoderTask, &tasks[i], TINYAI_AFFINITY_ANY);
+        }
+        else {
+            runEncoderTask(&tasks[i]);
+        }
+    }
+    tinyaiDestroyTaskGroup(group);
+    uint64_t encodeEnd = getTimeNs();
+
+    memset(output->encoderMs, 0, sizeof(output->encoderMs));
+    output->encodeMs = (double)(encodeEnd - encodeStart) / 1e6;
+    output->fusionMs = 0.0;
+
+    bool encodeSuccess = true;
+    for (int i = 0; i < model->numModalities; i++) {
+        int type = tasks[i].encoder->type;
+        if (type >= 0 && type < TINYAI_MODALITY_COUNT) {
+            output->encoderMs[type] += (double)tasks[i].elapsedNs / 1e6;
+        }
+        if (!tasks[i].success) {
             fprintf(stderr, "Failed to process modality %d\n", i);
-            for (int j = 0; j < model->numModalities; j++) {
-                free(encoderOutputs[j]);
-            }
-            free(encoderOutputs);
-            return false;
+            encodeSuccess = false;
+        }
+    }
+    free(tasks);
+
+    if (!encodeSuccess) {
+        for (int i = 0; i < model->numModalities; i++) {
+            free(encoderOutputs[i]);
         }
+        free(encoderOutputs);
+        return false;
     }
 
     /* Initialize output structure */
@@ -580,7 +707,8 @@ bool tinyaiMultimodalModelProcess(TinyAIMultimodalModel *model, const TinyAIMult
     }
 
     /* Apply fusion method */
-    bool fusionSuccess = false;
+    uint64_t fusionStart   = getTimeNs();
+    bool     fusionSuccess = false;
     switch (model->fusionMethod) {
     case TINYAI_FUSION_CONCAT:
         fusionSuccess = tinyaiFusionConcat(fusionInputs, fusionDims, model->numModalities,
@@ -609,6 +737,7 @@ bool tinyaiMultimodalModelProcess(TinyAIMultimodalModel *model, const TinyAIMult
         fprintf(stderr, "Unknown fusion method: %d\n", model->fusionMethod);
         fusionSuccess = false;
     }
+    output->fusionMs = (double)(getTimeNs() - fusionStart) / 1e6;
 
     /* Clean up */
     free(fusionDims);
@@ -803,6 +932,23 @@ bool tinyaiMultimodalModelEnableSIMD(TinyAIMultimodalModel *model, bool enable)
     return true;
 }
 
+/**
+ * Attach an embedding cache to the image encoder
+ * @param model The model to configure
+ * @param cache Embedding cache to use, or NULL to encode every image
+ * @return true on success, false on failure
+ */
+bool tinyaiMultimodalModelSetEmbeddingCache(TinyAIMultimodalModel *model,
+                                            TinyAIEmbeddingCache  *cache)
+{
+    if (!model) {
+        return false;
+    }
+
+    model->embeddingCache = cache;
+    return true;
+}
+
 /**
  * Get memory usage statistics
  * @param model The model to query
@@ -12,6 +12,7 @@
 
 #include "../image/image_model.h"
 #include "../text/generate.h"
+#include "embedding_cache.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -45,7 +46,8 @@ typedef enum {
 typedef enum {
     TINYAI_MODALITY_TEXT,  /* Text modality */
     TINYAI_MODALITY_IMAGE, /* Image modality */
-    TINYAI_MODALITY_AUDIO  /* Audio modality (future support) */
+    TINYAI_MODALITY_AUDIO, /* Audio modality (future support) */
+    TINYAI_MODALITY_COUNT  /* Number of modality types */
 } TinyAIModality;
 
 /**
@@ -101,6 +103,11 @@ typedef struct {
 
     float *imageFeatures; /* Image features (if applicable) */
     int    numClasses;    /* Number of image classes (if applicable) */
+
+    /* Timing of the last tinyaiMultimodalModelProcess call, in milliseconds */
+    double encoderMs[TINYAI_MODALITY_COUNT]; /* Encoder time by modality (0 if absent) */
+    double encodeMs;                         /* Wall time of all encoders, run concurrently */
+    double fusionMs;                         /* Time spent fusing the encoder outputs */
 } TinyAIMultimodalOutput;
 
 /**
@@ -134,6 +141,12 @@ void tinyaiMultimodalModelFree(TinyAIMultimodalModel *model);
 
 /**
  * Process multimodal input
+ *
+ * The modality encoders are independent, so they run concurrently on the
+ * shared thread pool and are joined before fusion; the encoding latency is
+ * that of the slowest encoder rather than the sum. Per-modality encoder times
+ * are reported in the output.
+ *
  * @param model The model to use
  * @param input Multimodal input containing different modalities
  * @param output Output structure to store results (must be pre-allocated)
@@ -190,6 +203,19 @@ bool tinyaiMultimodalModelSetMemoryPool(TinyAIMultimodalModel *model, void *memo
  */
 bool tinyaiMultimodalModelEnableSIMD(TinyAIMultimodalModel *model, bool enable);
 
+/**
+ * Attach an embedding cache to the image encoder
+ *
+ * Processing an image the cache already holds skips the image encoder. The model does
+ * not own the cache, which may be shared by several models and must outlive them.
+ *
+ * @param model The model to configure
+ * @param cache Embedding cache to use, or NULL to encode every image
+ * @return true on success, false on failure
+ */
+bool tinyaiMultimodalModelSetEmbeddingCache(TinyAIMultimodalModel *model,
+                                            TinyAIEmbeddingCache  *cache);
+
 /**
  * Get memory usage statistics
  * @param model The model to query
@@ -8,6 +8,8 @@
 #include "attention.h"
 #include "../../core/memory.h"
 #include "../../utils/simd_ops.h"
+#include "../../utils/thread_pool.h"
+#include "../../utils/trace.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,11 +20,17 @@
 /* Windows/MSVC */
 #include <intrin.h>
 #define HAS_SSE2_SUPPORT 1
-#if (_MSC_VER >= 1600) /* Visual Studio 2010 and later */
-#define HAS_AVX_SUPPORT 1
-#endif
 #if (_MSC_VER >= 1700) /* Visual Studio 2012 and later */
+#include <immintrin.h>
 #define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2
+#endif
+#if (_MSC_VER >= 1920) /* Visual Studio 2019 and later */
+#include <immintrin.h>
+#define HAS_AVX512_SUPPORT 1
+#define HAS_AVX512VNNI_SUPPORT 1
+#define TINYAI_TARGET_AVX512
+#define TINYAI_TARGET_AVX512VNNI
 #endif
 #elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 /* GCC/Clang on x86 */
@@ -31,13 +39,34 @@
 #include <emmintrin.h>
 #define HAS_SSE2_SUPPORT 1
 #endif
-#if defined(__AVX__)
+/* AVX2 and AVX-512 kernels are compiled per function and picked at runtime */
+#if defined(__clang__) || __GNUC__ >= 5
 #include <immintrin.h>
-#define HAS_AVX_SUPPORT 1
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2 __attribute__((target("avx2,fma")))
 #endif
-#if defined(__AVX2__)
+#if defined(__clang__) || __GNUC__ >= 7
 #include <immintrin.h>
-#define HAS_AVX2_SUPPORT 1
+#define HAS_AVX512_SUPPORT 1
+#define TINYAI_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
+#if defined(__clang__) || __GNUC__ >= 8
+#define HAS_AVX512VNNI_SUPPORT 1
+#define TINYAI_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* AArch64: NEON is always present, the SDOT kernel has its own target and is picked at runtime */
+#include <arm_neon.h>
+#define HAS_NEON_SUPPORT 1
+#if defined(__ARM_FEATURE_DOTPROD)
+#define HAS_NEON_DOTPROD_SUPPORT 1
+#define TINYAI_TARGET_DOTPROD
+#elif defined(__linux__) && defined(__clang__)
+#define HAS_NEON_DOTPROD_SUPPORT 1
+#define TINYAI_TARGET_DOTPROD __attribute__((target("dotprod")))
+#elif defined(__linux__) && __GNUC__ >= 8
+#define HAS_NEON_DOTPROD_SUPPORT 1
+#define TINYAI_TARGET_DOTPROD __attribute__((target("arch=armv8.2-a+dotprod")))
 #endif
 #endif
 
@@ -47,17 +76,16 @@
 static size_t calculateScratchMemorySize(const TinyAIAttentionParams *params)
 {
     uint32_t hiddenDim = params->hiddenDim;
+    uint32_t kvDim     = params->numKVHeads * params->headDim;
     uint32_t seqLength = params->seqLength;
-    uint32_t numHeads  = params->numHeads;
-    uint32_t headDim   = params->headDim;
 
-    /* Calculate size for all temporary buffers */
-    size_t qkvSize     = 3 * seqLength * hiddenDim * sizeof(float);        /* Query, Key, Value */
-    size_t scoresSize  = numHeads * seqLength * seqLength * sizeof(float); /* Attention scores */
-    size_t softmaxSize = numHeads * seqLength * seqLength * sizeof(float); /* Softmax scores */
-    size_t contextSize = seqLength * hiddenDim * sizeof(float);            /* Context vectors */
+    /* Scores never leave the tiled kernel, so scratch grows linearly with the sequence */
+    size_t querySize   = (size_t)seqLength * hiddenDim * sizeof(float); /* Query */
+    size_t kvSize      = 2 * (size_t)seqLength * kvDim * sizeof(float); /* Key, Value */
+    size_t contextSize = (size_t)seqLength * hiddenDim * sizeof(float); /* Context vectors */
+    size_t accSize     = tinyaiAttentionAccumulatorSize(params) * sizeof(float); /* Per head */
 
-    return qkvSize + scoresSize + softmaxSize + contextSize;
+    return querySize + kvSize + contextSize + accSize;
 }
 
 /**
@@ -69,8 +97,15 @@ int tinyaiInitSelfAttention(TinyAISelfAttention *attention, const TinyAIAttentio
         return -1;
     }
 
+    /* Query heads split evenly into key/value groups; 0 key/value heads means one per query head */
+    uint32_t numKVHeads = params->numKVHeads ? params->numKVHeads : params->numHeads;
+    if (numKVHeads == 0 || params->numHeads % numKVHeads != 0) {
+        return -1;
+    }
+
     /* Copy parameters */
     memcpy(&attention->params, params, sizeof(TinyAIAttentionParams));
+    attention->params.numKVHeads = numKVHeads;
 
     /* Initialize weight matrices to zeros */
     memset(&attention->queryWeight, 0, sizeof(TinyAIMatrix4bit));
@@ -83,9 +118,10 @@ int tinyaiInitSelfAttention(TinyAISelfAttention *attention, const TinyAIAttentio
     attention->keyBias    = NULL;
     attention->valueBias  = NULL;
     attention->outputBias = NULL;
+    attention->deltas     = NULL;
 
     /* Allocate scratch memory */
-    size_t scratchSize       = calculateScratchMemorySize(params);
+    size_t scratchSize       = calculateScratchMemorySize(&attention->params);
     attention->scratchMemory = (float *)TINYAI_MALLOC(scratchSize);
     if (!attention->scratchMemory) {
         return -1;
@@ -104,18 +140,10 @@ void tinyaiDestroySelfAttention(TinyAISelfAttention *attention)
     }
 
     /* Free weight data if owned by this structure */
-    if (attention->queryWeight.data) {
-        TINYAI_FREE(attention->queryWeight.data);
-    }
-    if (attention->keyWeight.data) {
-        TINYAI_FREE(attention->keyWeight.data);
-    }
-    if (attention->valueWeight.data) {
-        TINYAI_FREE(attention->valueWeight.data);
-    }
-    if (attention->outputWeight.data) {
-        TINYAI_FREE(attention->outputWeight.data);
-    }
+    tinyaiReleaseMatrix4bit(&attention->queryWeight);
+    tinyaiReleaseMatrix4bit(&attention->keyWeight);
+    tinyaiReleaseMatrix4bit(&attention->valueWeight);
+    tinyaiReleaseMatrix4bit(&attention->outputWeight);
 
     /* Free biases if owned by this structure */
     if (attention->queryBias) {
@@ -140,6 +168,17 @@ void tinyaiDestroySelfAttention(TinyAISelfAttention *attention)
     memset(attention, 0, sizeof(TinyAISelfAttention));
 }
 
+/**
+ * Get the size of an attention structure's scratch memory
+ */
+size_t tinyaiSelfAttentionScratchSize(const TinyAISelfAttention *attention)
+{
+    if (!attention || !attention->scratchMemory) {
+        return 0;
+    }
+    return calculateScratchMemorySize(&attention->params);
+}
+
 /**
  * Set weights for self-attention
  */
@@ -154,68 +193,23 @@ int tinyaiSetAttentionWeights(TinyAISelfAttention *attention, const TinyAIMatrix
     }
 
     uint32_t hiddenDim = attention->params.hiddenDim;
-
-    /* Free existing weight data if needed */
-    if (attention->queryWeight.data) {
-        TINYAI_FREE(attention->queryWeight.data);
-    }
-    if (attention->keyWeight.data) {
-        TINYAI_FREE(attention->keyWeight.data);
-    }
-    if (attention->valueWeight.data) {
-        TINYAI_FREE(attention->valueWeight.data);
-    }
-    if (attention->outputWeight.data) {
-        TINYAI_FREE(attention->outputWeight.data);
-    }
-
-    /* Calculate the size of each matrix in bytes */
-    /* For 4-bit quantized weights, we use 2 values per byte */
-    size_t querySize  = (queryWeight->rows * queryWeight->cols + 1) / 2;
-    size_t keySize    = (keyWeight->rows * keyWeight->cols + 1) / 2;
-    size_t valueSize  = (valueWeight->rows * valueWeight->cols + 1) / 2;
-    size_t outputSize = (outputWeight->rows * outputWeight->cols + 1) / 2;
-
-    /* Allocate and copy weight data */
-    attention->queryWeight.data  = (uint8_t *)TINYAI_MALLOC(querySize);
-    attention->keyWeight.data    = (uint8_t *)TINYAI_MALLOC(keySize);
-    attention->valueWeight.data  = (uint8_t *)TINYAI_MALLOC(valueSize);
-    attention->outputWeight.data = (uint8_t *)TINYAI_MALLOC(outputSize);
-
-    if (!attention->queryWeight.data || !attention->keyWeight.data ||
-        !attention->valueWeight.data || !attention->outputWeight.data) {
+    uint32_t kvDim     = attention->params.numKVHeads * attention->params.headDim;
+
+    /* Replace existing weights with copies, per-group scales included */
+    tinyaiReleaseMatrix4bit(&attention->queryWeight);
+    tinyaiReleaseMatrix4bit(&attention->keyWeight);
+    tinyaiReleaseMatrix4bit(&attention->valueWeight);
+    tinyaiReleaseMatrix4bit(&attention->outputWeight);
+
+    if (tinyaiCopyMatrix4bit(&attention->queryWeight, queryWeight) != 0 ||
+        tinyaiCopyMatrix4bit(&attention->keyWeight, keyWeight) != 0 ||
+        tinyaiCopyMatrix4bit(&attention->valueWeight, valueWeight) != 0 ||
+        tinyaiCopyMatrix4bit(&attention->outputWeight, outputWeight) != 0) {
         /* Clean up on error */
         tinyaiDestroySelfAttention(attention);
         return -1;
     }
 
-    /* Copy weight data */
-    memcpy(attention->queryWeight.data, queryWeight->data, querySize);
-    memcpy(attention->keyWeight.data, keyWeight->data, keySize);
-    memcpy(attention->valueWeight.data, valueWeight->data, valueSize);
-    memcpy(attention->outputWeight.data, outputWeight->data, outputSize);
-
-    /* Copy matrix metadata */
-    attention->queryWeight.rows      = queryWeight->rows;
-    attention->queryWeight.cols      = queryWeight->cols;
-    attention->queryWeight.scale     = queryWeight->scale;
-    attention->queryWeight.zeroPoint = queryWeight->zeroPoint;
-
-    attention->keyWeight.rows      = keyWeight->rows;
-    attention->keyWeight.cols      = keyWeight->cols;
-    attention->keyWeight.scale     = keyWeight->scale;
-    attention->keyWeight.zeroPoint = keyWeight->zeroPoint;
-
-    attention->valueWeight.rows      = valueWeight->rows;
-    attention->valueWeight.cols      = valueWeight->cols;
-    attention->valueWeight.scale     = valueWeight->scale;
-    attention->valueWeight.zeroPoint = valueWeight->zeroPoint;
-
-    attention->outputWeight.rows      = outputWeight->rows;
-    attention->outputWeight.cols      = outputWeight->cols;
-    attention->outputWeight.scale     = outputWeight->scale;
-    attention->outputWeight.zeroPoint = outputWeight->zeroPoint;
-
     /* Free existing bias data if needed */
     if (attention->queryBias) {
         TINYAI_FREE(attention->queryBias);
@@ -241,21 +235,21 @@ int tinyaiSetAttentionWeights(TinyAISelfAttention *attention, const TinyAIMatrix
     }
 
     if (keyBias) {
-        attention->keyBias = (float *)TINYAI_MALLOC(hiddenDim * sizeof(float));
+        attention->keyBias = (float *)TINYAI_MALLOC(kvDim * sizeof(float));
         if (!attention->keyBias) {
             tinyaiDestroySelfAttention(attention);
             return -1;
         }
-        memcpy(attention->keyBias, keyBias, hiddenDim * sizeof(float));
+        memcpy(attention->keyBias, keyBias, kvDim * sizeof(float));
     }
 
     if (valueBias) {
-        attention->valueBias = (float *)TINYAI_MALLOC(hiddenDim * sizeof(float));
+        attention->valueBias = (float *)TINYAI_MALLOC(kvDim * sizeof(float));
         if (!attention->valueBias) {
             tinyaiDestroySelfAttention(attention);
             return -1;
         }
-        memcpy(attention->valueBias, valueBias, hiddenDim * sizeof(float));
+        memcpy(attention->valueBias, valueBias, kvDim * sizeof(float));
     }
 
     if (outputBias) {
@@ -274,310 +268,84 @@ int tinyaiSetAttentionWeights(TinyAISelfAttention *attention, const TinyAIMatrix
  * Calculate memory offsets for different components in scratch memory
  */
 static void getMemoryOffsets(const TinyAIAttentionParams *params, float **query, float **key,
-                             float **value, float **scores, float **softmaxScores, float **context,
+                             float **value, float **context, float **accumulators,
                              float *scratchMemory)
 {
-    uint32_t hiddenDim = params->hiddenDim;
-    uint32_t seqLength = params->seqLength;
-    uint32_t numHeads  = params->numHeads;
+    size_t rowsSize   = (size_t)params->seqLength * params->hiddenDim;
+    size_t kvRowsSize = (size_t)params->seqLength * params->numKVHeads * params->headDim;
 
     /* Calculate offsets for each component */
-    *query         = scratchMemory;
-    *key           = *query + seqLength * hiddenDim;
-    *value         = *key + seqLength * hiddenDim;
-    *scores        = *value + seqLength * hiddenDim;
-    *softmaxScores = *scores + numHeads * seqLength * seqLength;
-    *context       = *softmaxScores + numHeads * seqLength * seqLength;
-}
-
-/**
- * SIMD-accelerated query-key-value projection using AVX2
- */
-#if defined(HAS_AVX2_SUPPORT)
-static int tinyaiSimdQKVProjectionAVX2(const float *input, const TinyAIMatrix4bit *queryWeight,
-                                       const TinyAIMatrix4bit *keyWeight,
-                                       const TinyAIMatrix4bit *valueWeight, const float *queryBias,
-                                       const float *keyBias, const float *valueBias, float *query,
-                                       float *key, float *value, uint32_t seqLength,
-                                       uint32_t hiddenDim, uint32_t numHeads, uint32_t headDim)
-{
-    /* For each position in the sequence */
-    for (uint32_t i = 0; i < seqLength; i++) {
-        /* Get input vector for this position */
-        const float *inputVec = input + i * hiddenDim;
-
-        /* Output vectors for this position */
-        float *queryVec = query + i * hiddenDim;
-        float *keyVec   = key + i * hiddenDim;
-        float *valueVec = value + i * hiddenDim;
-
-        /* Perform matrix multiplication for query, key, value projections */
-        /* We'll use tinyaiSimdMatMul4Bit with AVX2 which will be automatically selected */
-        /* Query projection */
-        float queryScale = queryWeight->scale;
-        tinyaiSimdMatMul4Bit(queryVec, queryWeight->data, inputVec, hiddenDim, hiddenDim,
-                             &queryScale);
-
-        /* Key projection */
-        float keyScale = keyWeight->scale;
-        tinyaiSimdMatMul4Bit(keyVec, keyWeight->data, inputVec, hiddenDim, hiddenDim, &keyScale);
-
-        /* Value projection */
-        float valueScale = valueWeight->scale;
-        tinyaiSimdMatMul4Bit(valueVec, valueWeight->data, inputVec, hiddenDim, hiddenDim,
-                             &valueScale);
-
-        /* Add biases if provided */
-        if (queryBias) {
-            /* Use SIMD vector addition */
-            for (uint32_t j = 0; j < hiddenDim; j += 8) {
-                __m256 biasVec   = _mm256_loadu_ps(queryBias + j);
-                __m256 valVec    = _mm256_loadu_ps(queryVec + j);
-                __m256 resultVec = _mm256_add_ps(valVec, biasVec);
-                _mm256_storeu_ps(queryVec + j, resultVec);
-            }
-        }
-
-        if (keyBias) {
-            /* Use SIMD vector addition */
-            for (uint32_t j = 0; j < hiddenDim; j += 8) {
-                __m256 biasVec   = _mm256_loadu_ps(keyBias + j);
-                __m256 valVec    = _mm256_loadu_ps(keyVec + j);
-                __m256 resultVec = _mm256_add_ps(valVec, biasVec);
-                _mm256_storeu_ps(keyVec + j, resultVec);
-            }
-        }
-
-        if (valueBias) {
-            /* Use SIMD vector addition */
-            for (uint32_t j = 0; j < hiddenDim; j += 8) {
-                __m256 biasVec   = _mm256_loadu_ps(valueBias + j);
-                __m256 valVec    = _mm256_loadu_ps(valueVec + j);
-                __m256 resultVec = _mm256_add_ps(valVec, biasVec);
-                _mm256_storeu_ps(valueVec + j, resultVec);
-            }
-        }
-    }
-
-    return 0;
-}
-#endif
-
-/**
- * SIMD-accelerated query-key-value projection using SSE2
- */
-#if defined(HAS_SSE2_SUPPORT)
-static int tinyaiSimdQKVProjectionSSE2(const float *input, const TinyAIMatrix4bit *queryWeight,
-                                       const TinyAIMatrix4bit *keyWeight,
-                                       const TinyAIMatrix4bit *valueWeight, const float *queryBias,
-                                       const float *keyBias, const float *valueBias, float *query,
-                                       float *key, float *value, uint32_t seqLength,
-                                       uint32_t hiddenDim, uint32_t numHeads, uint32_t headDim)
-{
-    /* For each position in the sequence */
-    for (uint32_t i = 0; i < seqLength; i++) {
-        /* Get input vector for this position */
-        const float *inputVec = input + i * hiddenDim;
-
-        /* Output vectors for this position */
-        float *queryVec = query + i * hiddenDim;
-        float *keyVec   = key + i * hiddenDim;
-        float *valueVec = value + i * hiddenDim;
-
-        /* Perform matrix multiplication for query, key, value projections */
-        /* We'll use tinyaiSimdMatMul4Bit which will use SSE2 */
-        /* Query projection */
-        float queryScale = queryWeight->scale;
-        tinyaiSimdMatMul4Bit(queryVec, queryWeight->data, inputVec, hiddenDim, hiddenDim,
-                             &queryScale);
-
-        /* Key projection */
-        float keyScale = keyWeight->scale;
-        tinyaiSimdMatMul4Bit(keyVec, keyWeight->data, inputVec, hiddenDim, hiddenDim, &keyScale);
-
-        /* Value projection */
-        float valueScale = valueWeight->scale;
-        tinyaiSimdMatMul4Bit(valueVec, valueWeight->data, inputVec, hiddenDim, hiddenDim,
-                             &valueScale);
-
-        /* Add biases if provided */
-        if (queryBias) {
-            /* Use SIMD vector addition */
-            for (uint32_t j = 0; j < hiddenDim; j += 4) {
-                __m128 biasVec   = _mm_loadu_ps(queryBias + j);
-                __m128 valVec    = _mm_loadu_ps(queryVec + j);
-                __m128 resultVec = _mm_add_ps(valVec, biasVec);
-                _mm_storeu_ps(queryVec + j, resultVec);
-            }
-        }
-
-        if (keyBias) {
-            /* Use SIMD vector addition */
-            for (uint32_t j = 0; j < hiddenDim; j += 4) {
-                __m128 biasVec   = _mm_loadu_ps(keyBias + j);
-                __m128 valVec    = _mm_loadu_ps(keyVec + j);
-                __m128 resultVec = _mm_add_ps(valVec, biasVec);
-                _mm_storeu_ps(keyVec + j, resultVec);
-            }
-        }
-
-        if (valueBias) {
-            /* Use SIMD vector addition */
-            for (uint32_t j = 0; j < hiddenDim; j += 4) {
-                __m128 biasVec   = _mm_loadu_ps(valueBias + j);
-                __m128 valVec    = _mm_loadu_ps(valueVec + j);
-                __m128 resultVec = _mm_add_ps(valVec, biasVec);
-                _mm_storeu_ps(valueVec + j, resultVec);
-            }
-        }
-    }
-
-    return 0;
-}
-#endif
-
-/**
- * Reference implementation of query-key-value projection
- */
-static int tinyaiQKVProjectionReference(const float *input, const TinyAIMatrix4bit *queryWeight,
-                                        const TinyAIMatrix4bit *keyWeight,
-                                        const TinyAIMatrix4bit *valueWeight, const float *queryBias,
-                                        const float *keyBias, const float *valueBias, float *query,
-                                        float *key, float *value, uint32_t seqLength,
-                                        uint32_t hiddenDim, uint32_t numHeads, uint32_t headDim)
-{
-    /* For each position in the sequence */
-    for (uint32_t i = 0; i < seqLength; i++) {
-        /* Get input vector for this position */
-        const float *inputVec = input + i * hiddenDim;
-
-        /* Dequantize weight matrices */
-        TinyAIMatrixFP32 *queryWeightFP32 = tinyaiDequantize4bitToFP32(queryWeight);
-        TinyAIMatrixFP32 *keyWeightFP32   = tinyaiDequantize4bitToFP32(keyWeight);
-        TinyAIMatrixFP32 *valueWeightFP32 = tinyaiDequantize4bitToFP32(valueWeight);
-
-        if (!queryWeightFP32 || !keyWeightFP32 || !valueWeightFP32) {
-            if (queryWeightFP32)
-                tinyaiDestroyMatrixFP32(queryWeightFP32);
-            if (keyWeightFP32)
-                tinyaiDestroyMatrixFP32(keyWeightFP32);
-            if (valueWeightFP32)
-                tinyaiDestroyMatrixFP32(valueWeightFP32);
-            return -1;
-        }
-
-        /* Output vectors for this position */
-        float *queryVec = query + i * hiddenDim;
-        float *keyVec   = key + i * hiddenDim;
-        float *valueVec = value + i * hiddenDim;
-
-        /* Perform matrix multiplication for query projection */
-        for (uint32_t j = 0; j < hiddenDim; j++) {
-            float sum = queryBias ? queryBias[j] : 0.0f;
-            for (uint32_t k = 0; k < hiddenDim; k++) {
-                sum += inputVec[k] * queryWeightFP32->data[k * hiddenDim + j];
-            }
-            queryVec[j] = sum;
-        }
-
-        /* Perform matrix multiplication for key projection */
-        for (uint32_t j = 0; j < hiddenDim; j++) {
-            float sum = keyBias ? keyBias[j] : 0.0f;
-            for (uint32_t k = 0; k < hiddenDim; k++) {
-                sum += inputVec[k] * keyWeightFP32->data[k * hiddenDim + j];
-            }
-            keyVec[j] = sum;
-        }
-
-        /* Perform matrix multiplication for value projection */
-        for (uint32_t j = 0; j < hiddenDim; j++) {
-            float sum = valueBias ? valueBias[j] : 0.0f;
-            for (uint32_t k = 0; k < hiddenDim; k++) {
-                sum += inputVec[k] * valueWeightFP32->data[k * hiddenDim + j];
-            }
-            valueVec[j] = sum;
-        }
-
-        /* Clean up */
-        tinyaiDestroyMatrixFP32(queryWeightFP32);
-        tinyaiDestroyMatrixFP32(keyWeightFP32);
-        tinyaiDestroyMatrixFP32(valueWeightFP32);
-    }
-
-    return 0;
+    *query   = scratchMemory;
+    *key     = *query + rowsSize;
+    *value   = *key + kvRowsSize;
+    *context      = *value + kvRowsSize;
+    *accumulators = *context + rowsSize;
 }
 
 /**
  * SIMD-accelerated query-key-value projection (public API)
+ *
+ * Runs straight on the packed 4-bit weights as one grouped GEMM over every
+ * position, so the input is streamed once for all three projections and
+ * their columns share a single thread pool split.
  */
 int tinyaiSimdQKVProjection(const float *input, const TinyAIMatrix4bit *queryWeight,
                             const TinyAIMatrix4bit *keyWeight, const TinyAIMatrix4bit *valueWeight,
                             const float *queryBias, const float *keyBias, const float *valueBias,
                             float *query, float *key, float *value, uint32_t seqLength,
-                            uint32_t hiddenDim, uint32_t numHeads, uint32_t headDim)
+                            uint32_t hiddenDim, uint32_t numHeads, uint32_t numKVHeads,
+                            uint32_t headDim)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
-
-    /* Use the most advanced SIMD version available */
-#if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
-        return tinyaiSimdQKVProjectionAVX2(input, queryWeight, keyWeight, valueWeight, queryBias,
-                                           keyBias, valueBias, query, key, value, seqLength,
-                                           hiddenDim, numHeads, headDim);
-    }
-#endif
+    (void)numHeads;
 
-#if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
-        return tinyaiSimdQKVProjectionSSE2(input, queryWeight, keyWeight, valueWeight, queryBias,
-                                           keyBias, valueBias, query, key, value, seqLength,
-                                           hiddenDim, numHeads, headDim);
+    /* Queries are packed [seqLength x hiddenDim], keys and values [seqLength x numKVHeads*headDim] */
+    const TinyAIMatrix4bit *weights[3] = {queryWeight, keyWeight, valueWeight};
+    const uint32_t          cols[3]    = {hiddenDim, numKVHeads * headDim, numKVHeads * headDim};
+    for (int w = 0; w < 3; w++) {
+        if (!weights[w] || weights[w]->rows != hiddenDim || weights[w]->cols != cols[w]) {
+            return -1;
+        }
     }
-#endif
 
-    /* Fallback to reference implementation */
-    return tinyaiQKVProjectionReference(input, queryWeight, keyWeight, valueWeight, queryBias,
-                                        keyBias, valueBias, query, key, value, seqLength, hiddenDim,
-                                        numHeads, headDim);
+    /* Query, key and value projections with fused bias */
+    const float *biases[3]  = {queryBias, keyBias, valueBias};
+    float       *outputs[3] = {query, key, value};
+    return tinyaiMatrix4bitMatMulGroup(weights, biases, outputs, 3, input, seqLength);
 }
 
 /**
  * SIMD-accelerated attention score computation (Q*K^T) using AVX2
  */
 #if defined(HAS_AVX2_SUPPORT)
-static int tinyaiSimdAttentionScoresAVX2(const float *query, const float *key, float *scores,
-                                         uint32_t seqLength, uint32_t numHeads, uint32_t headDim,
-                                         float scaleFactor, bool useCausalMask)
+static TINYAI_TARGET_AVX2 int tinyaiSimdAttentionScoresAVX2(const float *query, const float *key,
+                                                            float *scores, uint32_t seqLength,
+                                                            uint32_t numHeads, uint32_t numKVHeads,
+                                                            uint32_t headDim, float scaleFactor,
+                                                            bool useCausalMask)
 {
     /* Process each attention head separately */
     for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one key head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
         /* Compute QK^T for this head */
-        for (uint32_t i = 0; i < seqLength; i++) {     /* Query sequence position */
-            for (uint32_t j = 0; j < seqLength; j++) { /* Key sequence position */
-                /* Skip future tokens for causal mask */
-                if (useCausalMask && j > i) {
-                    scores[h * seqLength * seqLength + i * seqLength + j] = -INFINITY;
-                    continue;
-                }
+        for (uint32_t i = 0; i < seqLength; i++) { /* Query sequence position */
+            float       *rowScores = scores + h * seqLength * seqLength + i * seqLength;
+            const float *queryVec  = query + i * numHeads * headDim + h * headDim;
 
-                /* Get query and key vectors for this head at positions i and j */
-                const float *queryVec = query + i * numHeads * headDim + h * headDim;
-                const float *keyVec   = key + j * numHeads * headDim + h * headDim;
+            /* A causal row stops at the diagonal */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
 
-                /* Compute dot product with AVX2 */
-                __m256 sumVec = _mm256_setzero_ps();
+            for (uint32_t j = 0; j < keys; j++) { /* Key sequence position */
+                const float *keyVec = key + j * numKVHeads * headDim + kvHead * headDim;
 
-                /* Process 8 elements at a time */
-                for (uint32_t k = 0; k < headDim; k += 8) {
+                /* Compute dot product with AVX2, 8 elements at a time */
+                __m256   sumVec = _mm256_setzero_ps();
+                uint32_t k      = 0;
+                for (; k + 8 <= headDim; k += 8) {
                     __m256 queryChunk = _mm256_loadu_ps(queryVec + k);
                     __m256 keyChunk   = _mm256_loadu_ps(keyVec + k);
-
-                    /* Multiply and accumulate */
-                    sumVec = _mm256_add_ps(sumVec, _mm256_mul_ps(queryChunk, keyChunk));
+                    sumVec            = _mm256_add_ps(sumVec, _mm256_mul_ps(queryChunk, keyChunk));
                 }
 
                 /* Horizontal sum */
@@ -587,12 +355,17 @@ static int tinyaiSimdAttentionScoresAVX2(const float *query, const float *key, f
                     sum[0] + sum[1] + sum[2] + sum[3] + sum[4] + sum[5] + sum[6] + sum[7];
 
                 /* Add remaining elements */
-                for (uint32_t k = (headDim / 8) * 8; k < headDim; k++) {
+                for (; k < headDim; k++) {
                     dotProduct += queryVec[k] * keyVec[k];
                 }
 
                 /* Scale and store */
-                scores[h * seqLength * seqLength + i * seqLength + j] = dotProduct * scaleFactor;
+                rowScores[j] = dotProduct * scaleFactor;
+            }
+
+            /* Future tokens are masked without computing their scores */
+            for (uint32_t j = keys; j < seqLength; j++) {
+                rowScores[j] = -INFINITY;
             }
         }
     }
@@ -606,34 +379,32 @@ static int tinyaiSimdAttentionScoresAVX2(const float *query, const float *key, f
  */
 #if defined(HAS_SSE2_SUPPORT)
 static int tinyaiSimdAttentionScoresSSE2(const float *query, const float *key, float *scores,
-                                         uint32_t seqLength, uint32_t numHeads, uint32_t headDim,
-                                         float scaleFactor, bool useCausalMask)
+                                         uint32_t seqLength, uint32_t numHeads, uint32_t numKVHeads,
+                                         uint32_t headDim, float scaleFactor, bool useCausalMask)
 {
     /* Process each attention head separately */
     for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one key head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
         /* Compute QK^T for this head */
-        for (uint32_t i = 0; i < seqLength; i++) {     /* Query sequence position */
-            for (uint32_t j = 0; j < seqLength; j++) { /* Key sequence position */
-                /* Skip future tokens for causal mask */
-                if (useCausalMask && j > i) {
-                    scores[h * seqLength * seqLength + i * seqLength + j] = -INFINITY;
-                    continue;
-                }
+        for (uint32_t i = 0; i < seqLength; i++) { /* Query sequence position */
+            float       *rowScores = scores + h * seqLength * seqLength + i * seqLength;
+            const float *queryVec  = query + i * numHeads * headDim + h * headDim;
 
-                /* Get query and key vectors for this head at positions i and j */
-                const float *queryVec = query + i * numHeads * headDim + h * headDim;
-                const float *keyVec   = key + j * numHeads * headDim + h * headDim;
+            /* A causal row stops at the diagonal */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
 
-                /* Compute dot product with SSE2 */
-                __m128 sumVec = _mm_setzero_ps();
+            for (uint32_t j = 0; j < keys; j++) { /* Key sequence position */
+                const float *keyVec = key + j * numKVHeads * headDim + kvHead * headDim;
 
-                /* Process 4 elements at a time */
-                for (uint32_t k = 0; k < headDim; k += 4) {
+                /* Compute dot product with SSE2, 4 elements at a time */
+                __m128   sumVec = _mm_setzero_ps();
+                uint32_t k      = 0;
+                for (; k + 4 <= headDim; k += 4) {
                     __m128 queryChunk = _mm_loadu_ps(queryVec + k);
                     __m128 keyChunk   = _mm_loadu_ps(keyVec + k);
-
-                    /* Multiply and accumulate */
-                    sumVec = _mm_add_ps(sumVec, _mm_mul_ps(queryChunk, keyChunk));
+                    sumVec            = _mm_add_ps(sumVec, _mm_mul_ps(queryChunk, keyChunk));
                 }
 
                 /* Horizontal sum */
@@ -642,12 +413,69 @@ static int tinyaiSimdAttentionScoresSSE2(const float *query, const float *key, f
                 float dotProduct = sum[0] + sum[1] + sum[2] + sum[3];
 
                 /* Add remaining elements */
-                for (uint32_t k = (headDim / 4) * 4; k < headDim; k++) {
+                for (; k < headDim; k++) {
+                    dotProduct += queryVec[k] * keyVec[k];
+                }
+
+                /* Scale and store */
+                rowScores[j] = dotProduct * scaleFactor;
+            }
+
+            /* Future tokens are masked without computing their scores */
+            for (uint32_t j = keys; j < seqLength; j++) {
+                rowScores[j] = -INFINITY;
+            }
+        }
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * SIMD-accelerated attention score computation (Q*K^T) using NEON
+ */
+#if defined(HAS_NEON_SUPPORT)
+static int tinyaiSimdAttentionScoresNEON(const float *query, const float *key, float *scores,
+                                         uint32_t seqLength, uint32_t numHeads, uint32_t numKVHeads,
+                                         uint32_t headDim, float scaleFactor, bool useCausalMask)
+{
+    /* Process each attention head separately */
+    for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one key head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
+        /* Compute QK^T for this head */
+        for (uint32_t i = 0; i < seqLength; i++) { /* Query sequence position */
+            float       *rowScores = scores + h * seqLength * seqLength + i * seqLength;
+            const float *queryVec  = query + i * numHeads * headDim + h * headDim;
+
+            /* A causal row stops at the diagonal */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
+
+            for (uint32_t j = 0; j < keys; j++) { /* Key sequence position */
+                const float *keyVec = key + j * numKVHeads * headDim + kvHead * headDim;
+
+                /* Compute dot product with NEON, 4 elements at a time */
+                float32x4_t sumVec = vdupq_n_f32(0.0f);
+                uint32_t    k      = 0;
+                for (; k + 4 <= headDim; k += 4) {
+                    sumVec = vfmaq_f32(sumVec, vld1q_f32(queryVec + k), vld1q_f32(keyVec + k));
+                }
+                float dotProduct = vaddvq_f32(sumVec);
+
+                /* Add remaining elements */
+                for (; k < headDim; k++) {
                     dotProduct += queryVec[k] * keyVec[k];
                 }
 
                 /* Scale and store */
-                scores[h * seqLength * seqLength + i * seqLength + j] = dotProduct * scaleFactor;
+                rowScores[j] = dotProduct * scaleFactor;
+            }
+
+            /* Future tokens are masked without computing their scores */
+            for (uint32_t j = keys; j < seqLength; j++) {
+                rowScores[j] = -INFINITY;
             }
         }
     }
@@ -660,33 +488,39 @@ static int tinyaiSimdAttentionScoresSSE2(const float *query, const float *key, f
  * Reference implementation of attention score computation
  */
 static int tinyaiAttentionScoresReference(const float *query, const float *key, float *scores,
-                                          uint32_t seqLength, uint32_t numHeads, uint32_t headDim,
-                                          float scaleFactor, bool useCausalMask)
+                                          uint32_t seqLength, uint32_t numHeads,
+                                          uint32_t numKVHeads, uint32_t headDim, float scaleFactor,
+                                          bool useCausalMask)
 {
     /* Process each attention head separately */
     for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one key head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
         /* Compute QK^T for this head */
-        for (uint32_t i = 0; i < seqLength; i++) {     /* Query sequence position */
-            for (uint32_t j = 0; j < seqLength; j++) { /* Key sequence position */
-                /* Skip future tokens for causal mask */
-                if (useCausalMask && j > i) {
-                    scores[h * seqLength * seqLength + i * seqLength + j] = -INFINITY;
-                    continue;
-                }
+        for (uint32_t i = 0; i < seqLength; i++) { /* Query sequence position */
+            float       *rowScores = scores + h * seqLength * seqLength + i * seqLength;
+            const float *queryVec  = query + i * numHeads * headDim + h * headDim;
+
+            /* A causal row stops at the diagonal */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
 
-                /* Get query and key vectors for this head at positions i and j */
-                const float *queryVec = query + i * numHeads * headDim + h * headDim;
-                const float *keyVec   = key + j * numHeads * headDim + h * headDim;
+            for (uint32_t j = 0; j < keys; j++) { /* Key sequence position */
+                const float *keyVec = key + j * numKVHeads * headDim + kvHead * headDim;
 
                 /* Compute dot product */
                 float dotProduct = 0.0f;
-
                 for (uint32_t k = 0; k < headDim; k++) {
                     dotProduct += queryVec[k] * keyVec[k];
                 }
 
                 /* Scale and store */
-                scores[h * seqLength * seqLength + i * seqLength + j] = dotProduct * scaleFactor;
+                rowScores[j] = dotProduct * scaleFactor;
+            }
+
+            /* Future tokens are masked without computing their scores */
+            for (uint32_t j = keys; j < seqLength; j++) {
+                rowScores[j] = -INFINITY;
             }
         }
     }
@@ -698,375 +532,1873 @@ static int tinyaiAttentionScoresReference(const float *query, const float *key,
  * SIMD-accelerated attention score computation (public API)
  */
 int tinyaiSimdAttentionScores(const float *query, const float *key, float *scores,
-                              uint32_t seqLength, uint32_t numHeads, uint32_t headDim,
-                              float scaleFactor, bool useCausalMask)
+                              uint32_t seqLength, uint32_t numHeads, uint32_t numKVHeads,
+                              uint32_t headDim, float scaleFactor, bool useCausalMask)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
+    if (numKVHeads == 0 || numHeads % numKVHeads != 0) {
+        return -1;
+    }
 
     /* Use the most advanced SIMD version available */
 #if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
-        return tinyaiSimdAttentionScoresAVX2(query, key, scores, seqLength, numHeads, headDim,
-                                             scaleFactor, useCausalMask);
+    if (tinyaiSimdHasAVX2()) {
+        return tinyaiSimdAttentionScoresAVX2(query, key, scores, seqLength, numHeads, numKVHeads,
+                                             headDim, scaleFactor, useCausalMask);
     }
 #endif
 
 #if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
-        return tinyaiSimdAttentionScoresSSE2(query, key, scores, seqLength, numHeads, headDim,
-                                             scaleFactor, useCausalMask);
+    if (tinyaiSimdAvailable()) {
+        return tinyaiSimdAttentionScoresSSE2(query, key, scores, seqLength, numHeads, numKVHeads,
+                                             headDim, scaleFactor, useCausalMask);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        return tinyaiSimdAttentionScoresNEON(query, key, scores, seqLength, numHeads, numKVHeads,
+                                             headDim, scaleFactor, useCausalMask);
     }
 #endif
 
     /* Fallback to reference implementation */
-    return tinyaiAttentionScoresReference(query, key, scores, seqLength, numHeads, headDim,
-                                          scaleFactor, useCausalMask);
+    return tinyaiAttentionScoresReference(query, key, scores, seqLength, numHeads, numKVHeads,
+                                          headDim, scaleFactor, useCausalMask);
 }
 
+/* ----------------- Tiled Attention ----------------- */
+
 /**
- * Implementation of the full self-attention forward pass (using the component functions above)
+ * Dot product of two float vectors
  */
-int tinyaiSelfAttentionForward(TinyAISelfAttention *attention, const float *input, float *output)
+static float attentionDot(const float *a, const float *b, uint32_t length)
 {
-    if (!attention || !input || !output) {
-        return -1;
+    float    sum = 0.0f;
+    uint32_t k   = 0;
+
+#if defined(HAS_SSE2_SUPPORT)
+    __m128 sumVec = _mm_setzero_ps();
+    for (; k + 4 <= length; k += 4) {
+        sumVec = _mm_add_ps(sumVec, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+    }
+    float partial[4];
+    _mm_storeu_ps(partial, sumVec);
+    sum = partial[0] + partial[1] + partial[2] + partial[3];
+#elif defined(HAS_NEON_SUPPORT)
+    float32x4_t sumVec = vdupq_n_f32(0.0f);
+    for (; k + 4 <= length; k += 4) {
+        sumVec = vfmaq_f32(sumVec, vld1q_f32(a + k), vld1q_f32(b + k));
     }
+    sum = vaddvq_f32(sumVec);
+#endif
 
-    /* Get attention parameters */
-    TinyAIAttentionParams *params    = &attention->params;
-    uint32_t               seqLength = params->seqLength;
-    uint32_t               hiddenDim = params->hiddenDim;
-    uint32_t               numHeads  = params->numHeads;
-    uint32_t               headDim   = params->headDim;
+    for (; k < length; k++) {
+        sum += a[k] * b[k];
+    }
 
-    /* Get memory areas from scratch memory for intermediate results */
-    float *query, *key, *value, *scores, *softmaxScores, *context;
-    getMemoryOffsets(params, &query, &key, &value, &scores, &softmaxScores, &context,
-                     attention->scratchMemory);
+    return sum;
+}
 
-    /* Perform QKV projection */
-    tinyaiSimdQKVProjection(input, &attention->queryWeight, &attention->keyWeight,
-                            &attention->valueWeight, attention->queryBias, attention->keyBias,
-                            attention->valueBias, query, key, value, seqLength, hiddenDim, numHeads,
-                            headDim);
+/**
+ * acc = acc * scale + weight * value
+ */
+static void attentionScaleAdd(float *acc, float scale, float weight, const float *value,
+                              uint32_t length)
+{
+    uint32_t k = 0;
 
-    /* Compute attention scores (Q * K^T / sqrt(headDim)) */
-    float scaleFactor = params->scaleFactor;
-    tinyaiSimdAttentionScores(query, key, scores, seqLength, numHeads, headDim, scaleFactor,
-                              params->useCausalMask);
+#if defined(HAS_SSE2_SUPPORT)
+    __m128 scaleVec  = _mm_set1_ps(scale);
+    __m128 weightVec = _mm_set1_ps(weight);
+    for (; k + 4 <= length; k += 4) {
+        __m128 scaled = _mm_mul_ps(_mm_loadu_ps(acc + k), scaleVec);
+        _mm_storeu_ps(acc + k, _mm_add_ps(scaled, _mm_mul_ps(_mm_loadu_ps(value + k), weightVec)));
+    }
+#elif defined(HAS_NEON_SUPPORT)
+    for (; k + 4 <= length; k += 4) {
+        float32x4_t scaled = vmulq_n_f32(vld1q_f32(acc + k), scale);
+        vst1q_f32(acc + k, vfmaq_n_f32(scaled, vld1q_f32(value + k), weight));
+    }
+#endif
 
-    /* Apply softmax to attention scores */
-    tinyaiSimdAttentionSoftmax(scores, softmaxScores, seqLength, numHeads);
+    for (; k < length; k++) {
+        acc[k] = acc[k] * scale + weight * value[k];
+    }
+}
 
-    /* Compute context vectors (softmax(QK^T) * V) */
-    tinyaiSimdAttentionContext(softmaxScores, value, context, seqLength, numHeads, headDim);
+#if defined(HAS_AVX2_SUPPORT)
+/**
+ * Dot product of two vectors with AVX2
+ */
+static TINYAI_TARGET_AVX2 float attentionDotAVX2(const float *a, const float *b, uint32_t length)
+{
+    __m256   sumVec = _mm256_setzero_ps();
+    uint32_t k      = 0;
+    for (; k + 8 <= length; k += 8) {
+        sumVec = _mm256_fmadd_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k), sumVec);
+    }
 
-    /* Final output projection */
-    tinyaiSimdOutputProjection(context, &attention->outputWeight, attention->outputBias, output,
-                               seqLength, hiddenDim);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sumVec), _mm256_extractf128_ps(sumVec, 1));
+    half        = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half        = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    float sum   = _mm_cvtss_f32(half);
 
-    return 0;
+    for (; k < length; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
 }
 
 /**
- * SIMD-accelerated softmax computation using AVX2
+ * acc = acc * scale + weight * value with AVX2
  */
-#if defined(HAS_AVX2_SUPPORT)
-static int tinyaiSimdAttentionSoftmaxAVX2(const float *scores, float *softmaxScores,
-                                          uint32_t seqLength, uint32_t numHeads)
+static TINYAI_TARGET_AVX2 void attentionScaleAddAVX2(float *acc, float scale, float weight,
+                                                     const float *value, uint32_t length)
 {
-    /* Process each attention head separately */
-    for (uint32_t h = 0; h < numHeads; h++) {
-        /* Process each query position */
-        for (uint32_t i = 0; i < seqLength; i++) {
-            /* Get pointer to scores for this head and query position */
-            const float *rowScores  = scores + h * seqLength * seqLength + i * seqLength;
-            float       *rowSoftmax = softmaxScores + h * seqLength * seqLength + i * seqLength;
+    __m256   scaleVec  = _mm256_set1_ps(scale);
+    __m256   weightVec = _mm256_set1_ps(weight);
+    uint32_t k         = 0;
+    for (; k + 8 <= length; k += 8) {
+        __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(acc + k), scaleVec);
+        _mm256_storeu_ps(acc + k, _mm256_fmadd_ps(_mm256_loadu_ps(value + k), weightVec, scaled));
+    }
+    for (; k < length; k++) {
+        acc[k] = acc[k] * scale + weight * value[k];
+    }
+}
+#endif
 
-            /* Find max score for numerical stability */
-            float maxScore = -INFINITY;
-            for (uint32_t j = 0; j < seqLength; j++) {
-                if (rowScores[j] > maxScore) {
-                    maxScore = rowScores[j];
-                }
-            }
+#if defined(HAS_AVX512_SUPPORT)
+/**
+ * Dot product of two vectors with AVX-512, the tail through a masked load
+ */
+static TINYAI_TARGET_AVX512 float attentionDotAVX512(const float *a, const float *b,
+                                                     uint32_t length)
+{
+    __m512   sumVec = _mm512_setzero_ps();
+    uint32_t k      = 0;
+    for (; k + 16 <= length; k += 16) {
+        sumVec = _mm512_fmadd_ps(_mm512_loadu_ps(a + k), _mm512_loadu_ps(b + k), sumVec);
+    }
+    if (k < length) {
+        __mmask16 mask = (__mmask16)((1u << (length - k)) - 1);
+        sumVec         = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + k),
+                                         _mm512_maskz_loadu_ps(mask, b + k), sumVec);
+    }
+    return _mm512_reduce_add_ps(sumVec);
+}
 
-            /* Compute exp(score - maxScore) and sum */
-            __m256 maxVec = _mm256_set1_ps(maxScore);
-            __m256 sumVec = _mm256_setzero_ps();
-
-            /* Process in chunks of 8 */
-            for (uint32_t j = 0; j < seqLength; j += 8) {
-                /* Clamp for last iteration if needed */
-                uint32_t remainingItems = seqLength - j;
-                uint32_t itemsToProcess = remainingItems < 8 ? remainingItems : 8;
-
-                if (itemsToProcess == 8) {
-                    /* Process full 8 elements */
-                    __m256 scoresVec = _mm256_loadu_ps(rowScores + j);
-                    __m256 expInput  = _mm256_sub_ps(scoresVec, maxVec);
-
-                    /* Compute exp(x) using AVX2 */
-                    /* We use the approximation exp(x) ≈ 2^(1.442695*x) */
-                    /* First, compute 1.442695*x (multiply by log2(e)) */
-                    __m256 log2eVec = _mm256_set1_ps(1.442695f);
-                    __m256 scaled   = _mm256_mul_ps(expInput, log2eVec);
-
-                    /* Use _mm256_exp_ps if available, otherwise approximate */
-                    /* For simplicity, we use exp(x) = exp2f(x * log2(e)) */
-                    __m256 expVec;
-
-                    /* This is a simple approximation, in practice you would use
-                     * a more accurate approximation or library function */
-                    float expResults[8];
-                    float scaledValues[8];
-                    _mm256_storeu_ps(scaledValues, scaled);
-
-                    /* Use scalar operations to compute exp */
-                    _mm256_storeu_ps(expResults, expInput);
-                    for (int k = 0; k < 8; k++) {
-                        expResults[k] = expf(expResults[k]);
-                    }
-                    expVec = _mm256_loadu_ps(expResults);
+/**
+ * acc = acc * scale + weight * value with AVX-512
+ */
+static TINYAI_TARGET_AVX512 void attentionScaleAddAVX512(float *acc, float scale, float weight,
+                                                         const float *value, uint32_t length)
+{
+    __m512   scaleVec  = _mm512_set1_ps(scale);
+    __m512   weightVec = _mm512_set1_ps(weight);
+    uint32_t k         = 0;
+    for (; k + 16 <= length; k += 16) {
+        __m512 scaled = _mm512_mul_ps(_mm512_loadu_ps(acc + k), scaleVec);
+        _mm512_storeu_ps(acc + k, _mm512_fmadd_ps(_mm512_loadu_ps(value + k), weightVec, scaled));
+    }
+    if (k < length) {
+        __mmask16 mask   = (__mmask16)((1u << (length - k)) - 1);
+        __m512    scaled = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, acc + k), scaleVec);
+        _mm512_mask_storeu_ps(acc + k, mask,
+                              _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, value + k), weightVec,
+                                              scaled));
+    }
+}
+#endif
 
-                    /* Store results and accumulate sum */
-                    _mm256_storeu_ps(rowSoftmax + j, expVec);
-                    sumVec = _mm256_add_ps(sumVec, expVec);
-                }
-                else {
-                    /* Process remaining items individually */
-                    for (uint32_t k = 0; k < itemsToProcess; k++) {
-                        float expValue    = expf(rowScores[j + k] - maxScore);
-                        rowSoftmax[j + k] = expValue;
-                        /* Use scalar addition for the sum */
-                        float sumArr[8];
-                        _mm256_storeu_ps(sumArr, sumVec);
-                        sumArr[0] += expValue;
-                        sumVec = _mm256_loadu_ps(sumArr);
-                    }
-                }
-            }
+#if defined(HAS_AVX512VNNI_SUPPORT)
+/**
+ * Dot product of two int8 vectors with AVX-512 VNNI
+ *
+ * vpdpbusd multiplies unsigned by signed bytes, so a enters as |a| and its
+ * signs move onto b. Neither vector may hold -128.
+ */
+static TINYAI_TARGET_AVX512VNNI int32_t attentionDotInt8VNNI(const int8_t *a, const int8_t *b,
+                                                             uint32_t length)
+{
+    __m512i zero = _mm512_setzero_si512();
+    __m512i sum  = zero;
+    for (uint32_t k = 0; k < length; k += 64) {
+        uint32_t  rest = length - k;
+        __mmask64 mask = rest >= 64 ? ~(__mmask64)0 : ((__mmask64)1 << rest) - 1;
+        __m512i   va   = _mm512_maskz_loadu_epi8(mask, a + k);
+        __m512i   vb   = _mm512_maskz_loadu_epi8(mask, b + k);
+
+        vb  = _mm512_mask_sub_epi8(vb, _mm512_movepi8_mask(va), zero, vb);
+        sum = _mm512_dpbusd_epi32(sum, _mm512_abs_epi8(va), vb);
+    }
+    return _mm512_reduce_add_epi32(sum);
+}
+#endif
 
-            /* Finalize sum */
-            float sumArr[8];
-            _mm256_storeu_ps(sumArr, sumVec);
-            float sum = sumArr[0] + sumArr[1] + sumArr[2] + sumArr[3] + sumArr[4] + sumArr[5] +
-                        sumArr[6] + sumArr[7];
-
-            /* Normalize by sum */
-            __m256 sumRecipVec = _mm256_set1_ps(1.0f / sum);
-
-            /* Normalize in chunks of 8 */
-            for (uint32_t j = 0; j < seqLength; j += 8) {
-                uint32_t remainingItems = seqLength - j;
-                uint32_t itemsToProcess = remainingItems < 8 ? remainingItems : 8;
-
-                if (itemsToProcess == 8) {
-                    /* Full vector processing */
-                    __m256 valuesVec     = _mm256_loadu_ps(rowSoftmax + j);
-                    __m256 normalizedVec = _mm256_mul_ps(valuesVec, sumRecipVec);
-                    _mm256_storeu_ps(rowSoftmax + j, normalizedVec);
-                }
-                else {
-                    /* Individual processing for remainder */
-                    for (uint32_t k = 0; k < itemsToProcess; k++) {
-                        rowSoftmax[j + k] /= sum;
-                    }
-                }
-            }
-        }
+#if defined(HAS_NEON_DOTPROD_SUPPORT)
+/**
+ * Dot product of two int8 vectors with NEON SDOT
+ */
+static TINYAI_TARGET_DOTPROD int32_t attentionDotInt8DotProd(const int8_t *a, const int8_t *b,
+                                                             uint32_t length)
+{
+    int32x4_t sum = vdupq_n_s32(0);
+    uint32_t  k   = 0;
+    for (; k + 16 <= length; k += 16) {
+        sum = vdotq_s32(sum, vld1q_s8(a + k), vld1q_s8(b + k));
     }
 
-    return 0;
+    int32_t total = vaddvq_s32(sum);
+    for (; k < length; k++) {
+        total += a[k] * b[k];
+    }
+    return total;
 }
 #endif
 
 /**
- * SIMD-accelerated softmax computation using SSE2
+ * Convert a float to IEEE half precision, rounding to nearest even
  */
-#if defined(HAS_SSE2_SUPPORT)
-static int tinyaiSimdAttentionSoftmaxSSE2(const float *scores, float *softmaxScores,
-                                          uint32_t seqLength, uint32_t numHeads)
+static uint16_t floatToHalf(float value)
 {
-    /* Process each attention head separately */
-    for (uint32_t h = 0; h < numHeads; h++) {
-        /* Process each query position */
-        for (uint32_t i = 0; i < seqLength; i++) {
-            /* Get pointer to scores for this head and query position */
-            const float *rowScores  = scores + h * seqLength * seqLength + i * seqLength;
-            float       *rowSoftmax = softmaxScores + h * seqLength * seqLength + i * seqLength;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign      = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7FFFFFFF;
 
-            /* Find max score for numerical stability */
-            float maxScore = -INFINITY;
-            for (uint32_t j = 0; j < seqLength; j++) {
-                if (rowScores[j] > maxScore) {
-                    maxScore = rowScores[j];
-                }
-            }
+    if (magnitude > 0x7F800000) {
+        return sign | 0x7E00; /* NaN */
+    }
+    if (magnitude >= 0x477FF000) {
+        return sign | 0x7C00; /* Rounds past the largest half: infinity */
+    }
+    if (magnitude < 0x38800000) {
+        /* Subnormal halves count units of 2^-24 */
+        float absValue;
+        memcpy(&absValue, &magnitude, sizeof(absValue));
+        return sign | (uint16_t)lrintf(absValue * 16777216.0f);
+    }
 
-            /* Compute exp(score - maxScore) and sum */
-            __m128 maxVec = _mm_set1_ps(maxScore);
-            __m128 sumVec = _mm_setzero_ps();
+    /* Rebias the exponent (127 to 15) and round the mantissa to 10 bits */
+    magnitude += 0xC8000FFF + ((magnitude >> 13) & 1);
+    return sign | (uint16_t)(magnitude >> 13);
+}
 
-            /* Process in chunks of 4 */
-            for (uint32_t j = 0; j < seqLength; j += 4) {
-                /* Clamp for last iteration if needed */
-                uint32_t remainingItems = seqLength - j;
-                uint32_t itemsToProcess = remainingItems < 4 ? remainingItems : 4;
+/**
+ * Convert an IEEE half-precision value to a float
+ */
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign     = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        /* Zero or subnormal */
+        float magnitude = (float)mantissa * 5.9604644775390625e-8f;
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
 
-                if (itemsToProcess == 4) {
-                    /* Process full 4 elements */
-                    __m128 scoresVec = _mm_loadu_ps(rowScores + j);
-                    __m128 expInput  = _mm_sub_ps(scoresVec, maxVec);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
 
-                    /* Compute exp using scalar operations for simplicity */
-                    float expInputArr[4];
-                    _mm_storeu_ps(expInputArr, expInput);
+/**
+ * Quantize one head to int8 with a symmetric scale, returning the scale
+ */
+static float quantizeHeadInt8(const float *head, uint32_t headDim, int8_t *bytes)
+{
+    float maxAbs = 0.0f;
+    for (uint32_t d = 0; d < headDim; d++) {
+        maxAbs = fmaxf(maxAbs, fabsf(head[d]));
+    }
 
-                    float expResults[4];
-                    for (int k = 0; k < 4; k++) {
-                        expResults[k] = expf(expInputArr[k]);
+    /* Symmetric scale mapping the largest magnitude of the head to 127 */
+    float scale    = maxAbs / 127.0f;
+    float invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+    for (uint32_t d = 0; d < headDim; d++) {
+        long q   = lrintf(head[d] * invScale);
+        q        = q > 127 ? 127 : (q < -127 ? -127 : q);
+        bytes[d] = (int8_t)q;
+    }
+    return scale;
+}
+
+/* Key and value rows of one tiled attention call, contiguous or spread over pool blocks */
+typedef struct {
+    const float           *key;         /* Contiguous key rows (NULL when paged) */
+    const float           *value;       /* Contiguous value rows (NULL when paged) */
+    uint32_t               numRows;     /* Rows positions wrap around (0 = keyLength) */
+    TinyAIKVCachePrecision precision;   /* Storage format of the rows */
+    uint32_t               rowSize;     /* Floats of storage per row */
+    float *const          *blocks;      /* Storage of each pool block (paged rows) */
+    const uint32_t        *blockTable;  /* Pool block of every TINYAI_KV_BLOCK_SIZE rows, or NULL */
+    size_t                 keyOffset;   /* Floats from the start of a block to its key rows */
+    size_t                 valueOffset; /* Floats from the start of a block to its value rows */
+} KVRows;
+
+/* Attention heads of one tiled attention call, run as a thread pool task */
+typedef struct {
+    const TinyAIAttentionParams *params;
+    const float                 *query;
+    float                       *context;
+    uint32_t                     queryLength;
+    uint32_t                     keyLength;
+    uint32_t                     queryStart;
+    uint32_t                     numKVHeads;
+    KVRows                       rows;
+    float                       *accumulators; /* Line-aligned, three rows per head, or NULL */
+    size_t                       accStride;
+    bool                         useAVX512;  /* AVX-512 dot and scale-add kernels */
+    bool                         useAVX2;    /* AVX2 dot and scale-add kernels */
+    bool                         useInt8Dot; /* VNNI or SDOT dots of int8 queries and keys */
+} TiledHeadsTask;
+
+/**
+ * Get the storage of one key or value row
+ */
+static const float *tiledRowBase(const KVRows *kv, const float *rows, size_t blockOffset,
+                                 uint32_t row)
+{
+    if (kv->blockTable) {
+        /* Paged rows: find the row's block, then the row within it */
+        const float *block = kv->blocks[kv->blockTable[row / TINYAI_KV_BLOCK_SIZE]];
+        return block + blockOffset + (size_t)(row % TINYAI_KV_BLOCK_SIZE) * kv->rowSize;
+    }
+    return rows + (size_t)row * kv->rowSize;
+}
+
+/**
+ * Get one head of a key or value row, decoding quantized rows into buffer
+ */
+static const float *tiledHeadRow(const TiledHeadsTask *task, const float *rows,
+                                 size_t blockOffset, uint32_t row, uint32_t kvHead, float *buffer)
+{
+    const KVRows *kv      = &task->rows;
+    uint32_t      headDim = task->params->headDim;
+    const float  *base    = tiledRowBase(kv, rows, blockOffset, row);
+
+    if (kv->precision == TINYAI_KV_CACHE_FP16) {
+        const uint16_t *halves = (const uint16_t *)base + (size_t)kvHead * headDim;
+        for (uint32_t d = 0; d < headDim; d++) {
+            buffer[d] = halfToFloat(halves[d]);
+        }
+        return buffer;
+    }
+    if (kv->precision == TINYAI_KV_CACHE_INT8) {
+        /* The row's per-head scales come before its bytes */
+        float         scale  = base[kvHead];
+        const int8_t *values = (const int8_t *)(base + task->numKVHeads) + (size_t)kvHead * headDim;
+        for (uint32_t d = 0; d < headDim; d++) {
+            buffer[d] = scale * values[d];
+        }
+        return buffer;
+    }
+
+    return base + (size_t)kvHead * headDim;
+}
+
+/**
+ * Dot product through the kernel selected for the task
+ */
+static float tiledDot(const TiledHeadsTask *task, const float *a, const float *b, uint32_t length)
+{
+#if defined(HAS_AVX512_SUPPORT)
+    if (task->useAVX512) {
+        return attentionDotAVX512(a, b, length);
+    }
+#endif
+#if defined(HAS_AVX2_SUPPORT)
+    if (task->useAVX2) {
+        return attentionDotAVX2(a, b, length);
+    }
+#endif
+    (void)task;
+    return attentionDot(a, b, length);
+}
+
+/**
+ * Integer dot product of a quantized query and key head
+ */
+static int32_t tiledDotInt8(const int8_t *a, const int8_t *b, uint32_t length)
+{
+#if defined(HAS_AVX512VNNI_SUPPORT)
+    return attentionDotInt8VNNI(a, b, length);
+#elif defined(HAS_NEON_DOTPROD_SUPPORT)
+    return attentionDotInt8DotProd(a, b, length);
+#else
+    int32_t sum = 0;
+    for (uint32_t k = 0; k < length; k++) {
+        sum += a[k] * b[k];
+    }
+    return sum;
+#endif
+}
+
+/**
+ * acc = acc * scale + weight * value through the kernel selected for the task
+ */
+static void tiledScaleAdd(const TiledHeadsTask *task, float *acc, float scale, float weight,
+                          const float *value, uint32_t length)
+{
+#if defined(HAS_AVX512_SUPPORT)
+    if (task->useAVX512) {
+        attentionScaleAddAVX512(acc, scale, weight, value, length);
+        return;
+    }
+#endif
+#if defined(HAS_AVX2_SUPPORT)
+    if (task->useAVX2) {
+        attentionScaleAddAVX2(acc, scale, weight, value, length);
+        return;
+    }
+#endif
+    attentionScaleAdd(acc, scale, weight, value, length);
+}
+
+/**
+ * Replace each score of a tile with its softmax weight exp(score - max), returning their sum
+ */
+static float tiledExpTile(float *tile, uint32_t count, float max)
+{
+    return tinyaiSimdExpSum(tile, tile, max, 1.0f, (int)count);
+}
+
+/**
+ * Attend each query of heads [begin, end) over its visible keys, one tile at a time
+ *
+ * A running maximum and sum (online softmax) let each tile's exponentials
+ * go straight into the context vector, so no score row is ever stored.
+ */
+static void attendTiledHeads(void *taskContext, size_t begin, size_t end)
+{
+    const TiledHeadsTask        *task      = (const TiledHeadsTask *)taskContext;
+    const TinyAIAttentionParams *params    = task->params;
+    const KVRows                *rows      = &task->rows;
+    uint32_t                     headDim   = params->headDim;
+    uint32_t                     hiddenDim = params->numHeads * headDim;
+    uint32_t                     groupSize = params->numHeads / task->numKVHeads;
+    float                        tile[TINYAI_ATTENTION_TILE];
+
+    for (uint32_t h = (uint32_t)begin; h < (uint32_t)end; h++) {
+        /* Query heads of a group share one key/value head */
+        uint32_t kvHead = h / groupSize;
+
+        for (uint32_t i = 0; i < task->queryLength; i++) {
+            const float *queryVec   = task->query + (size_t)i * hiddenDim + h * headDim;
+            float       *contextVec = task->context + (size_t)i * hiddenDim + h * headDim;
+            uint32_t     position   = task->queryStart + i;
+
+            /* Visible keys: [first, last), the causal prefix cut to the window */
+            uint32_t first = 0;
+            uint32_t last  = task->keyLength;
+            if (params->useCausalMask && position + 1 < last) {
+                last = position + 1;
+            }
+            if (params->windowSize > 0 && position + 1 > params->windowSize) {
+                first = position + 1 - params->windowSize;
+            }
+
+            /* The head's private rows keep the per-key updates off shared cache lines; the
+               second one receives decoded quantized keys and values */
+            float  *acc        = contextVec;
+            float  *decoded    = NULL;
+            int8_t *queryBytes = NULL;
+            float   queryScale = 0.0f;
+            if (task->accumulators) {
+                acc     = task->accumulators + 3 * h * task->accStride;
+                decoded = acc + task->accStride;
+            }
+            if (task->useInt8Dot) {
+                /* The third row holds the query quantized like the cached INT8 keys */
+                queryBytes = (int8_t *)(decoded + task->accStride);
+                queryScale = quantizeHeadInt8(queryVec, headDim, queryBytes) * params->scaleFactor;
+            }
+
+            float runningMax = -INFINITY;
+            float runningSum = 0.0f;
+            memset(acc, 0, headDim * sizeof(float));
+
+            for (uint32_t j0 = first; j0 < last; j0 += TINYAI_ATTENTION_TILE) {
+                uint32_t count = last - j0;
+                if (count > TINYAI_ATTENTION_TILE) {
+                    count = TINYAI_ATTENTION_TILE;
+                }
+
+                /* Positions wrap around ring buffers of numRows rows */
+                uint32_t firstRow = j0 % rows->numRows;
+
+                float    tileMax = -INFINITY;
+                uint32_t row     = firstRow;
+                for (uint32_t t = 0; t < count; t++) {
+                    if (queryBytes) {
+                        /* Integer dot product, scaled by the query's and the key's scales */
+                        const float  *base = tiledRowBase(rows, rows->key, rows->keyOffset, row);
+                        const int8_t *keyBytes =
+                            (const int8_t *)(base + task->numKVHeads) + (size_t)kvHead * headDim;
+                        tile[t] = (float)tiledDotInt8(queryBytes, keyBytes, headDim) *
+                                  (base[kvHead] * queryScale);
                     }
+                    else {
+                        const float *keyVec =
+                            tiledHeadRow(task, rows->key, rows->keyOffset, row, kvHead, decoded);
+                        tile[t] = tiledDot(task, queryVec, keyVec, headDim) * params->scaleFactor;
+                    }
+                    if (tile[t] > tileMax) {
+                        tileMax = tile[t];
+                    }
+                    if (++row == rows->numRows) {
+                        row = 0;
+                    }
+                }
+
+                /* Rescale what was accumulated under the old maximum */
+                float correction = 1.0f;
+                if (tileMax > runningMax) {
+                    correction = runningMax == -INFINITY ? 0.0f : expf(runningMax - tileMax);
+                    runningMax = tileMax;
+                    runningSum *= correction;
+                }
+
+                runningSum += tiledExpTile(tile, count, runningMax);
+                row = firstRow;
+                for (uint32_t t = 0; t < count; t++) {
+                    const float *valueVec =
+                        tiledHeadRow(task, rows->value, rows->valueOffset, row, kvHead, decoded);
+                    tiledScaleAdd(task, acc, t == 0 ? correction : 1.0f, tile[t], valueVec,
+                                  headDim);
+                    if (++row == rows->numRows) {
+                        row = 0;
+                    }
+                }
+            }
+
+            float invSum = runningSum > 0.0f ? 1.0f / runningSum : 0.0f;
+            for (uint32_t d = 0; d < headDim; d++) {
+                contextVec[d] = acc[d] * invSum;
+            }
+        }
+    }
+}
+
+/**
+ * Floats between the starts of two heads' accumulator rows
+ */
+static size_t accumulatorStride(uint32_t headDim)
+{
+    return ((size_t)headDim + TINYAI_ATTENTION_LINE_FLOATS - 1) / TINYAI_ATTENTION_LINE_FLOATS *
+           TINYAI_ATTENTION_LINE_FLOATS;
+}
+
+/**
+ * Tiled attention accumulator scratch size (public API)
+ */
+size_t tinyaiAttentionAccumulatorSize(const TinyAIAttentionParams *params)
+{
+    if (!params) {
+        return 0;
+    }
+    return 3 * params->numHeads * accumulatorStride(params->headDim) +
+           TINYAI_ATTENTION_LINE_FLOATS;
+}
+
+/**
+ * Fused, tiled attention over key/value rows of any cache storage format
+ *
+ * Quantized rows are decoded one head at a time into the second
+ * accumulator row of each head, so they need accumulators. With AVX-512
+ * VNNI or NEON SDOT, INT8 keys are instead scored against the query
+ * quantized into the third row.
+ */
+static int attentionTiled(const TinyAIAttentionParams *params, const float *query, float *context,
+                          uint32_t queryLength, uint32_t keyLength, uint32_t queryStart,
+                          const KVRows *rows, float *accumulators)
+{
+    if (!params || !query || !context || params->headDim == 0 ||
+        (!rows->blockTable && (!rows->key || !rows->value)) ||
+        (rows->precision != TINYAI_KV_CACHE_FP32 && !accumulators)) {
+        return -1;
+    }
+
+    uint32_t numKVHeads = params->numKVHeads ? params->numKVHeads : params->numHeads;
+    if (numKVHeads == 0 || params->numHeads % numKVHeads != 0) {
+        return -1;
+    }
+    if (queryLength == 0) {
+        return 0;
+    }
+
+    TiledHeadsTask task = {params,     query,      context, queryLength, keyLength,
+                           queryStart, numKVHeads, *rows,   NULL,        0,
+                           false,      false,      false};
+    if (task.rows.numRows == 0) {
+        task.rows.numRows = keyLength;
+    }
+    if (accumulators) {
+        /* Round up to a cache line inside the line of slack */
+        size_t    lineBytes = TINYAI_ATTENTION_LINE_FLOATS * sizeof(float);
+        uintptr_t address   = ((uintptr_t)accumulators + lineBytes - 1) / lineBytes * lineBytes;
+        task.accumulators   = (float *)address;
+        task.accStride      = accumulatorStride(params->headDim);
+    }
+
+    /* Kernels are chosen once per call, so hosts without AVX-512 run the same binary */
+    task.useAVX512  = tinyaiSimdHasAVX512();
+    task.useAVX2    = tinyaiSimdHasAVX2();
+    task.useInt8Dot = rows->precision == TINYAI_KV_CACHE_INT8 &&
+                      (tinyaiSimdHasAVX512VNNI() || tinyaiSimdHasNEONDotProd());
+
+    /* Heads are independent, so they split across the thread pool */
+    TinyAIThreadPool *pool    = tinyaiGetThreadPool();
+    uint32_t          visible = keyLength;
+    if (params->windowSize > 0 && params->windowSize < visible) {
+        visible = params->windowSize;
+    }
+    size_t workPerHead = (size_t)queryLength * visible * params->headDim * 2;
+    if (params->useCausalMask && queryStart + queryLength <= visible) {
+        /* Causal prefill only visits the lower triangle */
+        size_t keysPerQuery = queryStart + (queryLength + 1) / 2;
+        workPerHead         = (size_t)queryLength * keysPerQuery * params->headDim * 2;
+    }
+    tinyaiParallelFor(pool, params->numHeads, tinyaiThreadPoolGrain(pool, workPerHead, 1),
+                      attendTiledHeads, &task);
+
+    return 0;
+}
+
+/**
+ * Fused, tiled attention (public API)
+ */
+int tinyaiSimdAttentionTiled(const TinyAIAttentionParams *params, const float *query,
+                             const float *key, const float *value, float *context,
+                             uint32_t queryLength, uint32_t keyLength, uint32_t queryStart,
+                             uint32_t keyRows, float *accumulators)
+{
+    if (!params) {
+        return -1;
+    }
+
+    uint32_t numKVHeads = params->numKVHeads ? params->numKVHeads : params->numHeads;
+    uint32_t rowSize    = numKVHeads * params->headDim;
+    KVRows   rows       = {key, value, keyRows, TINYAI_KV_CACHE_FP32, rowSize, NULL, NULL, 0, 0};
+    return attentionTiled(params, query, context, queryLength, keyLength, queryStart, &rows,
+                          accumulators);
+}
+
+/**
+ * Add a low-rank update to projected rows (no-op without an update)
+ */
+static void applyLowRankDelta(const TinyAILowRankDelta *delta, const float *input, float *output,
+                              uint32_t rows, uint32_t inSize, uint32_t outSize)
+{
+    if (delta && delta->rank > 0) {
+        tinyaiSimdLowRankAdd(output, input, (int)rows, (int)inSize, (int)outSize, delta->down,
+                             delta->up, (int)delta->rank, delta->scale);
+    }
+}
+
+/**
+ * Add the adapter updates of the query, key and value projections
+ */
+static void applyQKVDeltas(const TinyAISelfAttention *attention, const float *input, float *query,
+                           float *key, float *value, uint32_t rows)
+{
+    const TinyAILowRankDelta *deltas    = attention->deltas;
+    uint32_t                  hiddenDim = attention->params.hiddenDim;
+    uint32_t kvDim = attention->params.numKVHeads * attention->params.headDim;
+    if (deltas) {
+        applyLowRankDelta(&deltas[0], input, query, rows, hiddenDim, hiddenDim);
+        applyLowRankDelta(&deltas[1], input, key, rows, hiddenDim, kvDim);
+        applyLowRankDelta(&deltas[2], input, value, rows, hiddenDim, kvDim);
+    }
+}
+
+/**
+ * Output projection followed by its adapter update
+ */
+static int outputProjection(const TinyAISelfAttention *attention, const float *context,
+                            float *output, uint32_t rows)
+{
+    uint32_t hiddenDim = attention->params.hiddenDim;
+    if (tinyaiSimdOutputProjection(context, &attention->outputWeight, attention->outputBias,
+                                   output, rows, hiddenDim) != 0) {
+        return -1;
+    }
+    if (attention->deltas) {
+        applyLowRankDelta(&attention->deltas[3], context, output, rows, hiddenDim, hiddenDim);
+    }
+    return 0;
+}
+
+/**
+ * Implementation of the full self-attention forward pass (using the component functions above)
+ */
+int tinyaiSelfAttentionForward(TinyAISelfAttention *attention, const float *input, float *output)
+{
+    if (!attention || !input || !output) {
+        return -1;
+    }
+
+    /* Get attention parameters */
+    TinyAIAttentionParams *params    = &attention->params;
+    uint32_t               seqLength  = params->seqLength;
+    uint32_t               hiddenDim  = params->hiddenDim;
+    uint32_t               numHeads   = params->numHeads;
+    uint32_t               numKVHeads = params->numKVHeads;
+    uint32_t               headDim    = params->headDim;
+
+    /* Get memory areas from scratch memory for intermediate results */
+    float *query, *key, *value, *context, *accumulators;
+    getMemoryOffsets(params, &query, &key, &value, &context, &accumulators,
+                     attention->scratchMemory);
+
+    /* Perform QKV projection */
+    uint64_t span = TINYAI_TRACE_BEGIN();
+    if (tinyaiSimdQKVProjection(input, &attention->queryWeight, &attention->keyWeight,
+                                &attention->valueWeight, attention->queryBias, attention->keyBias,
+                                attention->valueBias, query, key, value, seqLength, hiddenDim,
+                                numHeads, numKVHeads, headDim) != 0) {
+        return -1;
+    }
+    applyQKVDeltas(attention, input, query, key, value, seqLength);
+    TINYAI_TRACE_END_ARG(span, "attention.qkv", seqLength);
+
+    /* Scores, softmax and context in one tiled pass (softmax(Q * K^T * scale) * V) */
+    span = TINYAI_TRACE_BEGIN();
+    if (tinyaiSimdAttentionTiled(params, query, key, value, context, seqLength, seqLength, 0, 0,
+                                 accumulators) != 0) {
+        return -1;
+    }
+    TINYAI_TRACE_END_ARG(span, "attention.attend", seqLength);
+
+    /* Final output projection */
+    span       = TINYAI_TRACE_BEGIN();
+    int result = outputProjection(attention, context, output, seqLength);
+    TINYAI_TRACE_END_ARG(span, "attention.output", seqLength);
+    return result;
+}
+
+/* ----------------- Key/Value Cache ----------------- */
+
+/**
+ * Floats of storage per cached row of a precision
+ */
+static uint32_t kvCacheRowSize(TinyAIKVCachePrecision precision, uint32_t numHeads,
+                               uint32_t hiddenDim)
+{
+    switch (precision) {
+    case TINYAI_KV_CACHE_FP16:
+        return (hiddenDim + 1) / 2;
+    case TINYAI_KV_CACHE_INT8:
+        /* One scale per head, then the bytes */
+        return numHeads + (hiddenDim + 3) / 4;
+    default:
+        return hiddenDim;
+    }
+}
+
+/**
+ * Store one projected key or value row in the cache's precision
+ */
+static void storeKVRow(const TinyAIKVCache *cache, float *dst, const float *src)
+{
+    if (cache->precision == TINYAI_KV_CACHE_FP16) {
+        uint16_t *halves = (uint16_t *)dst;
+        for (uint32_t i = 0; i < cache->hiddenDim; i++) {
+            halves[i] = floatToHalf(src[i]);
+        }
+    }
+    else if (cache->precision == TINYAI_KV_CACHE_INT8) {
+        int8_t *bytes = (int8_t *)(dst + cache->numHeads);
+        for (uint32_t h = 0; h < cache->numHeads; h++) {
+            dst[h] = quantizeHeadInt8(src + h * cache->headDim, cache->headDim,
+                                      bytes + h * cache->headDim);
+        }
+    }
+    else {
+        memcpy(dst, src, cache->hiddenDim * sizeof(float));
+    }
+}
+
+/**
+ * Set the layout fields of a key/value cache, without storage
+ */
+static int initKVCacheLayout(TinyAIKVCache *cache, uint32_t numLayers,
+                             const TinyAIAttentionParams *params)
+{
+    if (numLayers == 0 || !params || params->seqLength == 0 || params->hiddenDim == 0 ||
+        params->kvCachePrecision > TINYAI_KV_CACHE_INT8) {
+        return -1;
+    }
+
+    /* Only the key/value heads are cached */
+    uint32_t numKVHeads = params->numKVHeads ? params->numKVHeads : params->numHeads;
+    uint32_t kvDim      = params->numKVHeads ? numKVHeads * params->headDim : params->hiddenDim;
+
+    /* A window shorter than the capacity only ever needs its last windowSize positions */
+    uint32_t windowSize = 0;
+    if (params->windowSize > 0 && params->windowSize < params->seqLength) {
+        windowSize = params->windowSize;
+    }
+
+    memset(cache, 0, sizeof(TinyAIKVCache));
+    cache->numLayers    = numLayers;
+    cache->maxSeqLength = windowSize ? windowSize : params->seqLength;
+    cache->windowSize   = windowSize;
+    cache->numHeads     = numKVHeads;
+    cache->headDim      = params->headDim;
+    cache->hiddenDim    = kvDim;
+    cache->precision    = params->kvCachePrecision;
+    cache->rowSize      = kvCacheRowSize(cache->precision, numKVHeads, kvDim);
+    return 0;
+}
+
+/**
+ * Create a key/value cache
+ */
+TinyAIKVCache *tinyaiCreateKVCache(uint32_t numLayers, const TinyAIAttentionParams *params)
+{
+    TinyAIKVCache layout;
+    if (initKVCacheLayout(&layout, numLayers, params) != 0) {
+        return NULL;
+    }
+
+    TinyAIKVCache *cache = (TinyAIKVCache *)TINYAI_MALLOC(sizeof(TinyAIKVCache));
+    if (!cache) {
+        return NULL;
+    }
+    *cache = layout;
+
+    size_t cacheSize = (size_t)numLayers * cache->maxSeqLength * cache->rowSize * sizeof(float);
+    cache->keys      = (float *)TINYAI_MALLOC(cacheSize);
+    cache->values    = (float *)TINYAI_MALLOC(cacheSize);
+
+    if (!cache->keys || !cache->values) {
+        tinyaiDestroyKVCache(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+/* ----------------- Paged Key/Value Cache ----------------- */
+
+/* Shared pool of key/value cache blocks */
+struct TinyAIKVBlockPool {
+    TinyAIKVCache             layout;      /* Layout of every cache drawing on the pool */
+    TinyAIAdvancedMemoryPool *memory;      /* Source of block storage (NULL = heap) */
+    size_t                    blockFloats; /* Keys then values of every layer for one block */
+    uint32_t                  maxBlocks;   /* Blocks the pool may hand out */
+    uint32_t                  numCreated;  /* Blocks given storage so far */
+    float                   **blocks;      /* Storage of each block [maxBlocks] */
+    uint32_t                 *refCounts;   /* Caches referencing each block (0 = free) */
+    uint32_t                 *freeList;    /* Created blocks no cache references */
+    uint32_t                  numFree;     /* Entries in freeList */
+};
+
+/**
+ * Number of block table entries of a paged cache
+ */
+static uint32_t kvBlockCount(const TinyAIKVCache *cache)
+{
+    return (cache->maxSeqLength + TINYAI_KV_BLOCK_SIZE - 1) / TINYAI_KV_BLOCK_SIZE;
+}
+
+/**
+ * Create a pool of key/value cache blocks
+ */
+TinyAIKVBlockPool *tinyaiCreateKVBlockPool(uint32_t numLayers, const TinyAIAttentionParams *params,
+                                           uint32_t maxBlocks, TinyAIAdvancedMemoryPool *memory)
+{
+    if (maxBlocks == 0 || maxBlocks == TINYAI_KV_NO_BLOCK) {
+        return NULL;
+    }
+
+    TinyAIKVBlockPool *pool = (TinyAIKVBlockPool *)TINYAI_MALLOC(sizeof(TinyAIKVBlockPool));
+    if (!pool) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(TinyAIKVBlockPool));
+
+    if (initKVCacheLayout(&pool->layout, numLayers, params) != 0) {
+        TINYAI_FREE(pool);
+        return NULL;
+    }
+
+    pool->memory      = memory;
+    pool->blockFloats = (size_t)2 * numLayers * TINYAI_KV_BLOCK_SIZE * pool->layout.rowSize;
+    pool->maxBlocks   = maxBlocks;
+    pool->blocks      = (float **)TINYAI_MALLOC(maxBlocks * sizeof(float *));
+    pool->refCounts   = (uint32_t *)TINYAI_MALLOC(maxBlocks * sizeof(uint32_t));
+    pool->freeList    = (uint32_t *)TINYAI_MALLOC(maxBlocks * sizeof(uint32_t));
+
+    if (!pool->blocks || !pool->refCounts || !pool->freeList) {
+        tinyaiDestroyKVBlockPool(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/**
+ * Give the storage of a block back to where it came from
+ */
+static void freeKVBlockStorage(TinyAIKVBlockPool *pool, uint32_t block)
+{
+    if (!pool->blocks[block]) {
+        return;
+    }
+    if (pool->memory) {
+        tinyaiAdvancedPoolFree(pool->memory, pool->blocks[block]);
+    }
+    else {
+        TINYAI_FREE(pool->blocks[block]);
+    }
+    pool->blocks[block] = NULL;
+}
+
+/**
+ * Allocate the storage of a block
+ */
+static float *allocKVBlockStorage(TinyAIKVBlockPool *pool)
+{
+    /* Blocks start on a cache line, like the accumulator rows */
+    size_t bytes     = pool->blockFloats * sizeof(float);
+    size_t alignment = TINYAI_ATTENTION_LINE_FLOATS * sizeof(float);
+    if (pool->memory) {
+        return (float *)tinyaiAdvancedPoolAlloc(pool->memory, bytes, alignment,
+                                                TINYAI_POOL_USAGE_KV_CACHE);
+    }
+    return (float *)TINYAI_MALLOC(bytes);
+}
+
+/**
+ * Free a key/value block pool
+ */
+void tinyaiDestroyKVBlockPool(TinyAIKVBlockPool *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    for (uint32_t b = 0; b < pool->numCreated; b++) {
+        freeKVBlockStorage(pool, b);
+    }
+
+    if (pool->blocks) {
+        TINYAI_FREE(pool->blocks);
+    }
+    if (pool->refCounts) {
+        TINYAI_FREE(pool->refCounts);
+    }
+    if (pool->freeList) {
+        TINYAI_FREE(pool->freeList);
+    }
+
+    TINYAI_FREE(pool);
+}
+
+/**
+ * Get the number of blocks a block pool can still hand out
+ */
+uint32_t tinyaiKVBlockPoolFreeBlocks(const TinyAIKVBlockPool *pool)
+{
+    return pool ? pool->numFree + (pool->maxBlocks - pool->numCreated) : 0;
+}
+
+/**
+ * Get the block storage a pool holds
+ */
+size_t tinyaiKVBlockPoolMemoryUsage(const TinyAIKVBlockPool *pool, size_t *peakBytes)
+{
+    if (peakBytes) {
+        *peakBytes = 0;
+    }
+    if (!pool) {
+        return 0;
+    }
+
+    /* New blocks are only created while every created block is referenced,
+       so numCreated is the most blocks ever held at once */
+    size_t blockBytes = pool->blockFloats * sizeof(float);
+    size_t stored     = 0;
+    for (uint32_t b = 0; b < pool->numCreated; b++) {
+        if (pool->blocks[b]) {
+            stored++;
+        }
+    }
+    if (peakBytes) {
+        *peakBytes = pool->numCreated * blockBytes;
+    }
+    return stored * blockBytes;
+}
+
+/**
+ * Free the storage of blocks no cache references
+ */
+size_t tinyaiKVBlockPoolTrim(TinyAIKVBlockPool *pool)
+{
+    if (!pool) {
+        return 0;
+    }
+
+    size_t released = 0;
+    for (uint32_t i = 0; i < pool->numFree; i++) {
+        if (pool->blocks[pool->freeList[i]]) {
+            freeKVBlockStorage(pool, pool->freeList[i]);
+            released += pool->blockFloats * sizeof(float);
+        }
+    }
+    return released;
+}
+
+/**
+ * Take an unreferenced block from a pool, or TINYAI_KV_NO_BLOCK if none is left
+ */
+static uint32_t takeKVBlock(TinyAIKVBlockPool *pool)
+{
+    uint32_t block;
+
+    if (pool->numFree > 0) {
+        /* Recycled blocks keep their storage unless the pool was trimmed */
+        block = pool->freeList[pool->numFree - 1];
+        if (!pool->blocks[block] && !(pool->blocks[block] = allocKVBlockStorage(pool))) {
+            return TINYAI_KV_NO_BLOCK;
+        }
+        pool->numFree--;
+    }
+    else if (pool->numCreated < pool->maxBlocks) {
+        float *storage = allocKVBlockStorage(pool);
+        if (!storage) {
+            return TINYAI_KV_NO_BLOCK;
+        }
+        block               = pool->numCreated++;
+        pool->blocks[block] = storage;
+    }
+    else {
+        return TINYAI_KV_NO_BLOCK;
+    }
+
+    pool->refCounts[block] = 1;
+    return block;
+}
+
+/**
+ * Drop one reference to a block, returning it to the pool with the last one
+ */
+static void releaseKVBlock(TinyAIKVBlockPool *pool, uint32_t block)
+{
+    if (--pool->refCounts[block] == 0) {
+        pool->freeList[pool->numFree++] = block;
+    }
+}
+
+/**
+ * Release the blocks of a paged cache from a block table entry on
+ */
+static void releaseKVBlocks(TinyAIKVCache *cache, uint32_t firstEntry)
+{
+    uint32_t numBlocks = kvBlockCount(cache);
+    for (uint32_t b = firstEntry; b < numBlocks; b++) {
+        if (cache->blockTable[b] != TINYAI_KV_NO_BLOCK) {
+            releaseKVBlock(cache->blockPool, cache->blockTable[b]);
+            cache->blockTable[b] = TINYAI_KV_NO_BLOCK;
+        }
+    }
+}
+
+/**
+ * Get the block of a paged cache holding a row, ready to be written to
+ *
+ * Rows without a block get a new one; a block shared with other caches is
+ * replaced by a private copy first.
+ */
+static float *writableKVBlock(TinyAIKVCache *cache, uint32_t row)
+{
+    TinyAIKVBlockPool *pool  = cache->blockPool;
+    uint32_t          *entry = &cache->blockTable[row / TINYAI_KV_BLOCK_SIZE];
+
+    if (*entry != TINYAI_KV_NO_BLOCK && pool->refCounts[*entry] == 1) {
+        return pool->blocks[*entry];
+    }
+
+    uint32_t block = takeKVBlock(pool);
+    if (block == TINYAI_KV_NO_BLOCK) {
+        return NULL;
+    }
+    if (*entry != TINYAI_KV_NO_BLOCK) {
+        memcpy(pool->blocks[block], pool->blocks[*entry], pool->blockFloats * sizeof(float));
+        releaseKVBlock(pool, *entry);
+    }
+
+    *entry = block;
+    return pool->blocks[block];
+}
+
+/**
+ * Create a paged key/value cache drawing on a block pool
+ */
+TinyAIKVCache *tinyaiCreatePagedKVCache(TinyAIKVBlockPool *pool)
+{
+    if (!pool) {
+        return NULL;
+    }
+
+    TinyAIKVCache *cache = (TinyAIKVCache *)TINYAI_MALLOC(sizeof(TinyAIKVCache));
+    if (!cache) {
+        return NULL;
+    }
+    *cache           = pool->layout;
+    cache->blockPool = pool;
+
+    uint32_t numBlocks = kvBlockCount(cache);
+    cache->blockTable  = (uint32_t *)TINYAI_MALLOC(numBlocks * sizeof(uint32_t));
+    if (!cache->blockTable) {
+        TINYAI_FREE(cache);
+        return NULL;
+    }
+    for (uint32_t b = 0; b < numBlocks; b++) {
+        cache->blockTable[b] = TINYAI_KV_NO_BLOCK;
+    }
+
+    return cache;
+}
+
+/**
+ * Floats from the start of a block to the key or value rows of a layer
+ */
+static size_t kvBlockOffset(const TinyAIKVCache *cache, uint32_t layer, bool value)
+{
+    /* Blocks hold keys then values, each [numLayers x TINYAI_KV_BLOCK_SIZE x rowSize] */
+    size_t layerIndex = (value ? cache->numLayers : 0) + layer;
+    return layerIndex * TINYAI_KV_BLOCK_SIZE * cache->rowSize;
+}
+
+/**
+ * Get the storage of one cached key or value row
+ *
+ * block is the paged cache's block holding the row, or NULL for a contiguous cache.
+ */
+static float *kvRowAddress(const TinyAIKVCache *cache, float *block, uint32_t layer,
+                           uint32_t row, bool value)
+{
+    if (!block) {
+        float *rows = value ? cache->values : cache->keys;
+        return rows + ((size_t)layer * cache->maxSeqLength + row) * cache->rowSize;
+    }
+    return block + kvBlockOffset(cache, layer, value) +
+           (size_t)(row % TINYAI_KV_BLOCK_SIZE) * cache->rowSize;
+}
+
+/**
+ * Rows from one up to the end of its block, at most remaining (all of them when contiguous)
+ */
+static uint32_t kvRowRun(const TinyAIKVCache *cache, uint32_t row, uint32_t remaining)
+{
+    uint32_t run = TINYAI_KV_BLOCK_SIZE - row % TINYAI_KV_BLOCK_SIZE;
+    return cache->blockTable && run < remaining ? run : remaining;
+}
+
+/**
+ * Describe the key and value rows of one cache layer for the tiled attention kernel
+ */
+static void layerKVRows(const TinyAIKVCache *cache, uint32_t layer, KVRows *rows)
+{
+    memset(rows, 0, sizeof(KVRows));
+    rows->numRows   = cache->maxSeqLength;
+    rows->precision = cache->precision;
+    rows->rowSize   = cache->rowSize;
+
+    if (cache->blockTable) {
+        rows->blocks      = cache->blockPool->blocks;
+        rows->blockTable  = cache->blockTable;
+        rows->keyOffset   = kvBlockOffset(cache, layer, false);
+        rows->valueOffset = kvBlockOffset(cache, layer, true);
+    }
+    else {
+        rows->key   = kvRowAddress(cache, NULL, layer, 0, false);
+        rows->value = kvRowAddress(cache, NULL, layer, 0, true);
+    }
+}
+
+/**
+ * Create a copy of a key/value cache
+ */
+TinyAIKVCache *tinyaiForkKVCache(const TinyAIKVCache *cache)
+{
+    if (!cache) {
+        return NULL;
+    }
+
+    TinyAIKVCache *fork;
+    if (cache->blockTable) {
+        fork = tinyaiCreatePagedKVCache(cache->blockPool);
+        if (!fork) {
+            return NULL;
+        }
+
+        /* Share every block; the first write to one gives the writer its own copy */
+        uint32_t numBlocks = kvBlockCount(cache);
+        for (uint32_t b = 0; b < numBlocks; b++) {
+            fork->blockTable[b] = cache->blockTable[b];
+            if (cache->blockTable[b] != TINYAI_KV_NO_BLOCK) {
+                cache->blockPool->refCounts[cache->blockTable[b]]++;
+            }
+        }
+    }
+    else {
+        fork = (TinyAIKVCache *)TINYAI_MALLOC(sizeof(TinyAIKVCache));
+        if (!fork) {
+            return NULL;
+        }
+        *fork           = *cache;
+        fork->stateSize = 0;
+        fork->state     = NULL;
+
+        size_t cacheSize =
+            (size_t)cache->numLayers * cache->maxSeqLength * cache->rowSize * sizeof(float);
+        fork->keys   = (float *)TINYAI_MALLOC(cacheSize);
+        fork->values = (float *)TINYAI_MALLOC(cacheSize);
+        if (!fork->keys || !fork->values) {
+            tinyaiDestroyKVCache(fork);
+            return NULL;
+        }
+        memcpy(fork->keys, cache->keys, cacheSize);
+        memcpy(fork->values, cache->values, cacheSize);
+    }
+
+    if (cache->state) {
+        if (tinyaiKVCacheAddState(fork, cache->stateSize) != 0) {
+            tinyaiDestroyKVCache(fork);
+            return NULL;
+        }
+        memcpy(fork->state, cache->state, cache->stateSize * sizeof(float));
+    }
+
+    fork->length = cache->length;
+    return fork;
+}
+
+/**
+ * Allocate recurrent hidden state in a key/value cache
+ */
+int tinyaiKVCacheAddState(TinyAIKVCache *cache, uint32_t stateSize)
+{
+    if (!cache || cache->state || stateSize == 0) {
+        return -1;
+    }
+
+    cache->state = (float *)TINYAI_MALLOC(stateSize * sizeof(float));
+    if (!cache->state) {
+        return -1;
+    }
+    cache->stateSize = stateSize;
+
+    memset(cache->state, 0, stateSize * sizeof(float));
+    return 0;
+}
+
+/**
+ * Reset a key/value cache
+ */
+void tinyaiResetKVCache(TinyAIKVCache *cache)
+{
+    if (cache) {
+        /* Stale entries are overwritten before they are read again; paged caches hand their
+           blocks back to the pool */
+        cache->length = 0;
+        if (cache->blockTable) {
+            releaseKVBlocks(cache, 0);
+        }
+
+        /* Recurrent layers start from a zero hidden state */
+        if (cache->state) {
+            memset(cache->state, 0, cache->stateSize * sizeof(float));
+        }
+    }
+}
+
+/**
+ * Free a key/value cache
+ */
+void tinyaiDestroyKVCache(TinyAIKVCache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    if (cache->keys) {
+        TINYAI_FREE(cache->keys);
+    }
+    if (cache->values) {
+        TINYAI_FREE(cache->values);
+    }
+    if (cache->blockTable) {
+        releaseKVBlocks(cache, 0);
+        TINYAI_FREE(cache->blockTable);
+    }
+    if (cache->state) {
+        TINYAI_FREE(cache->state);
+    }
+
+    TINYAI_FREE(cache);
+}
+
+/**
+ * Get the memory a key/value cache holds itself
+ */
+size_t tinyaiKVCacheMemoryUsage(const TinyAIKVCache *cache)
+{
+    if (!cache) {
+        return 0;
+    }
+
+    size_t bytes = sizeof(TinyAIKVCache);
+    if (cache->keys) {
+        bytes += 2 * (size_t)cache->numLayers * cache->maxSeqLength * cache->rowSize *
+                 sizeof(float);
+    }
+    if (cache->blockTable) {
+        bytes += kvBlockCount(cache) * sizeof(uint32_t);
+    }
+    if (cache->state) {
+        bytes += (size_t)cache->stateSize * sizeof(float);
+    }
+    return bytes;
+}
+
+/**
+ * Mark newly processed positions as cached
+ */
+int tinyaiKVCacheAdvance(TinyAIKVCache *cache, uint32_t count)
+{
+    if (!tinyaiKVCacheFits(cache, count)) {
+        return -1;
+    }
+
+    cache->length += count;
+    return 0;
+}
+
+/**
+ * Check whether more positions fit in a key/value cache
+ */
+bool tinyaiKVCacheFits(const TinyAIKVCache *cache, uint32_t count)
+{
+    if (!cache || (!cache->windowSize && cache->length + count > cache->maxSeqLength)) {
+        return false;
+    }
+    if (!cache->blockTable || count == 0) {
+        return true;
+    }
+
+    /* A paged cache needs a new block for every block the new rows touch that it has none
+       of or shares with another cache; a ring touches each of its blocks at most once */
+    uint32_t firstBlock = cache->length % cache->maxSeqLength / TINYAI_KV_BLOCK_SIZE;
+    uint32_t needed     = 0;
+    for (uint32_t r = 0; r < count;) {
+        uint32_t row   = (cache->length + r) % cache->maxSeqLength;
+        uint32_t entry = cache->blockTable[row / TINYAI_KV_BLOCK_SIZE];
+        if (r > 0 && row / TINYAI_KV_BLOCK_SIZE == firstBlock) {
+            break;
+        }
+        if (entry == TINYAI_KV_NO_BLOCK || cache->blockPool->refCounts[entry] > 1) {
+            needed++;
+        }
+
+        /* On to the next block, or back to the first row of the ring */
+        r += kvRowRun(cache, row, cache->maxSeqLength - row);
+    }
+
+    return needed <= tinyaiKVBlockPoolFreeBlocks(cache->blockPool);
+}
+
+/**
+ * Discard cached positions beyond a length
+ */
+int tinyaiKVCacheTruncate(TinyAIKVCache *cache, uint32_t length)
+{
+    if (!cache || length > cache->length || (cache->state && length != cache->length)) {
+        return -1;
+    }
+
+    /* A wrapped ring has overwritten positions the shorter sequence would need */
+    if (length != cache->length && cache->length > cache->maxSeqLength) {
+        return -1;
+    }
+
+    /* Blocks past the new length go back to the pool */
+    cache->length = length;
+    if (cache->blockTable) {
+        releaseKVBlocks(cache, (length + TINYAI_KV_BLOCK_SIZE - 1) / TINYAI_KV_BLOCK_SIZE);
+    }
+    return 0;
+}
+
+/**
+ * Discard a run of cached positions, moving the later ones down
+ */
+int tinyaiKVCacheDiscard(TinyAIKVCache *cache, uint32_t first, uint32_t count)
+{
+    if (!cache || first > cache->length || count > cache->length - first ||
+        cache->length > cache->maxSeqLength) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    uint32_t moved   = cache->length - first - count;
+    size_t   rowSize = cache->rowSize;
+
+    if (!cache->blockTable) {
+        for (uint32_t layer = 0; layer < cache->numLayers; layer++) {
+            float *keys   = kvRowAddress(cache, NULL, layer, first, false);
+            float *values = kvRowAddress(cache, NULL, layer, first, true);
+            memmove(keys, keys + count * rowSize, moved * rowSize * sizeof(float));
+            memmove(values, values + count * rowSize, moved * rowSize * sizeof(float));
+        }
+    }
+    else {
+        /* Blocks written to that other caches share are copied first; check the pool has
+           them all, so a failure leaves the cache untouched */
+        uint32_t needed = 0;
+        for (uint32_t b = first / TINYAI_KV_BLOCK_SIZE;
+             moved > 0 && b <= (first + moved - 1) / TINYAI_KV_BLOCK_SIZE; b++) {
+            needed += cache->blockPool->refCounts[cache->blockTable[b]] > 1;
+        }
+        if (needed > tinyaiKVBlockPoolFreeBlocks(cache->blockPool)) {
+            return -1;
+        }
 
-                    __m128 expVec = _mm_loadu_ps(expResults);
+        /* Move runs that stay within one block on both sides */
+        for (uint32_t r = 0; r < moved;) {
+            uint32_t dst = first + r;
+            uint32_t src = dst + count;
+            uint32_t run = kvRowRun(cache, dst, moved - r);
+            run          = kvRowRun(cache, src, run);
 
-                    /* Store results and accumulate sum */
-                    _mm_storeu_ps(rowSoftmax + j, expVec);
-                    sumVec = _mm_add_ps(sumVec, expVec);
-                }
-                else {
-                    /* Process remaining items individually */
-                    for (uint32_t k = 0; k < itemsToProcess; k++) {
-                        float expValue    = expf(rowScores[j + k] - maxScore);
-                        rowSoftmax[j + k] = expValue;
-                        /* Use scalar addition for the sum */
-                        float sumArr[4];
-                        _mm_storeu_ps(sumArr, sumVec);
-                        sumArr[0] += expValue;
-                        sumVec = _mm_loadu_ps(sumArr);
-                    }
-                }
+            float *dstBlock = writableKVBlock(cache, dst);
+            if (!dstBlock) {
+                return -1;
+            }
+            uint32_t srcEntry = cache->blockTable[src / TINYAI_KV_BLOCK_SIZE];
+            float   *srcBlock = cache->blockPool->blocks[srcEntry];
+            for (uint32_t layer = 0; layer < cache->numLayers; layer++) {
+                memmove(kvRowAddress(cache, dstBlock, layer, dst, false),
+                        kvRowAddress(cache, srcBlock, layer, src, false),
+                        run * rowSize * sizeof(float));
+                memmove(kvRowAddress(cache, dstBlock, layer, dst, true),
+                        kvRowAddress(cache, srcBlock, layer, src, true),
+                        run * rowSize * sizeof(float));
             }
+            r += run;
+        }
+    }
+
+    /* Blocks past the new length go back to the pool */
+    cache->length -= count;
+    if (cache->blockTable) {
+        releaseKVBlocks(cache, (cache->length + TINYAI_KV_BLOCK_SIZE - 1) / TINYAI_KV_BLOCK_SIZE);
+    }
+    return 0;
+}
+
+/**
+ * Write key and value rows of one layer in the cache's storage format
+ */
+int tinyaiKVCacheWriteRows(TinyAIKVCache *cache, uint32_t layer, uint32_t firstRow,
+                           uint32_t count, const float *keys, const float *values)
+{
+    if (!cache || !keys || !values || layer >= cache->numLayers ||
+        firstRow + count > cache->maxSeqLength) {
+        return -1;
+    }
 
-            /* Finalize sum */
-            float sumArr[4];
-            _mm_storeu_ps(sumArr, sumVec);
-            float sum = sumArr[0] + sumArr[1] + sumArr[2] + sumArr[3];
+    /* Rows stay contiguous up to the end of a block */
+    size_t rowSize = cache->rowSize;
+    for (uint32_t r = 0; r < count;) {
+        uint32_t row   = firstRow + r;
+        uint32_t run   = kvRowRun(cache, row, count - r);
+        float   *block = NULL;
+        if (cache->blockTable && !(block = writableKVBlock(cache, row))) {
+            return -1;
+        }
 
-            /* Normalize by sum */
-            __m128 sumRecipVec = _mm_set1_ps(1.0f / sum);
+        memcpy(kvRowAddress(cache, block, layer, row, false), keys + r * rowSize,
+               run * rowSize * sizeof(float));
+        memcpy(kvRowAddress(cache, block, layer, row, true), values + r * rowSize,
+               run * rowSize * sizeof(float));
+        r += run;
+    }
 
-            /* Normalize in chunks of 4 */
-            for (uint32_t j = 0; j < seqLength; j += 4) {
-                uint32_t remainingItems = seqLength - j;
-                uint32_t itemsToProcess = remainingItems < 4 ? remainingItems : 4;
+    return 0;
+}
 
-                if (itemsToProcess == 4) {
-                    /* Full vector processing */
-                    __m128 valuesVec     = _mm_loadu_ps(rowSoftmax + j);
-                    __m128 normalizedVec = _mm_mul_ps(valuesVec, sumRecipVec);
-                    _mm_storeu_ps(rowSoftmax + j, normalizedVec);
-                }
-                else {
-                    /* Individual processing for remainder */
-                    for (uint32_t k = 0; k < itemsToProcess; k++) {
-                        rowSoftmax[j + k] /= sum;
-                    }
-                }
+/**
+ * Read key and value rows of one layer in the cache's storage format
+ */
+int tinyaiKVCacheReadRows(const TinyAIKVCache *cache, uint32_t layer, uint32_t firstRow,
+                          uint32_t count, float *keys, float *values)
+{
+    if (!cache || !keys || !values || layer >= cache->numLayers ||
+        firstRow + count > cache->maxSeqLength) {
+        return -1;
+    }
+
+    size_t rowSize = cache->rowSize;
+    for (uint32_t r = 0; r < count;) {
+        uint32_t row   = firstRow + r;
+        uint32_t run   = kvRowRun(cache, row, count - r);
+        float   *block = NULL;
+        if (cache->blockTable) {
+            uint32_t entry = cache->blockTable[row / TINYAI_KV_BLOCK_SIZE];
+            if (entry == TINYAI_KV_NO_BLOCK) {
+                return -1;
             }
+            block = cache->blockPool->blocks[entry];
         }
+
+        memcpy(keys + r * rowSize, kvRowAddress(cache, block, layer, row, false),
+               run * rowSize * sizeof(float));
+        memcpy(values + r * rowSize, kvRowAddress(cache, block, layer, row, true),
+               run * rowSize * sizeof(float));
+        r += run;
     }
 
     return 0;
 }
-#endif
+
+/* Header of a saved key/value cache */
+typedef struct {
+    uint32_t magic;     /* KV_CACHE_MAGIC */
+    uint32_t numLayers; /* Attention layers */
+    uint32_t hiddenDim; /* Elements per cached key or value */
+    uint32_t precision; /* Storage format of the rows (TinyAIKVCachePrecision) */
+    uint32_t length;    /* Positions saved */
+    uint32_t stateSize; /* Floats of recurrent state saved */
+} KVCacheHeader;
+
+#define KV_CACHE_MAGIC 0x564B4954 /* "TIKV" */
 
 /**
- * Reference implementation of softmax computation for attention scores
+ * Rows per layer stored for a cached length (a wrapped ring stores every slot)
  */
-static int tinyaiAttentionSoftmaxReference(const float *scores, float *softmaxScores,
-                                           uint32_t seqLength, uint32_t numHeads)
+static uint32_t savedRows(const TinyAIKVCache *cache, uint32_t length)
 {
-    /* Process each attention head separately */
-    for (uint32_t h = 0; h < numHeads; h++) {
-        /* Process each query position */
-        for (uint32_t i = 0; i < seqLength; i++) {
-            /* Get pointers to scores for this head and query position */
-            const float *rowScores  = scores + h * seqLength * seqLength + i * seqLength;
-            float       *rowSoftmax = softmaxScores + h * seqLength * seqLength + i * seqLength;
+    return length < cache->maxSeqLength ? length : cache->maxSeqLength;
+}
 
-            /* Find max score for numerical stability */
-            float maxScore = -INFINITY;
-            for (uint32_t j = 0; j < seqLength; j++) {
-                if (rowScores[j] > maxScore) {
-                    maxScore = rowScores[j];
-                }
-            }
+/**
+ * Get the size of a saved key/value cache
+ */
+size_t tinyaiKVCacheSavedSize(const TinyAIKVCache *cache)
+{
+    if (!cache) {
+        return 0;
+    }
 
-            /* Compute exp(score - maxScore) and sum */
-            float sum = 0.0f;
-            for (uint32_t j = 0; j < seqLength; j++) {
-                float expValue = expf(rowScores[j] - maxScore);
-                rowSoftmax[j]  = expValue;
-                sum += expValue;
-            }
+    size_t rows = (size_t)2 * cache->numLayers * savedRows(cache, cache->length) * cache->rowSize;
+    return sizeof(KVCacheHeader) + (rows + cache->stateSize) * sizeof(float);
+}
+
+/**
+ * Save the state of a key/value cache to a buffer
+ */
+size_t tinyaiSaveKVCache(const TinyAIKVCache *cache, void *buffer, size_t bufferSize)
+{
+    size_t size = tinyaiKVCacheSavedSize(cache);
+    if (size == 0 || !buffer || bufferSize < size) {
+        return 0;
+    }
+
+    KVCacheHeader header = {KV_CACHE_MAGIC,   cache->numLayers, cache->hiddenDim,
+                            cache->precision, cache->length,    cache->stateSize};
+    memcpy(buffer, &header, sizeof(header));
+
+    /* Cached positions of each layer, keys then values, then the recurrent state */
+    float   *out  = (float *)((uint8_t *)buffer + sizeof(header));
+    uint32_t rows = savedRows(cache, cache->length);
+    size_t   used = (size_t)rows * cache->rowSize;
+    for (uint32_t l = 0; l < cache->numLayers; l++) {
+        if (tinyaiKVCacheReadRows(cache, l, 0, rows, out + l * used,
+                                  out + (cache->numLayers + l) * used) != 0) {
+            return 0;
+        }
+    }
+    out += 2 * cache->numLayers * used;
+    if (cache->stateSize > 0) {
+        memcpy(out, cache->state, cache->stateSize * sizeof(float));
+    }
+
+    return size;
+}
 
-            /* Normalize by sum */
-            if (sum > 0.0f) { /* Prevent division by zero */
-                float invSum = 1.0f / sum;
-                for (uint32_t j = 0; j < seqLength; j++) {
-                    rowSoftmax[j] *= invSum;
+/**
+ * Restore a key/value cache from a buffer written by tinyaiSaveKVCache
+ */
+int tinyaiRestoreKVCache(TinyAIKVCache *cache, const void *buffer, size_t bufferSize)
+{
+    KVCacheHeader header;
+    if (!cache || !buffer || bufferSize < sizeof(header)) {
+        return -1;
+    }
+
+    memcpy(&header, buffer, sizeof(header));
+    if (header.magic != KV_CACHE_MAGIC || header.numLayers != cache->numLayers ||
+        header.hiddenDim != cache->hiddenDim || header.precision != (uint32_t)cache->precision ||
+        header.stateSize != cache->stateSize ||
+        (header.length > cache->maxSeqLength && !cache->windowSize)) {
+        return -1;
+    }
+
+    uint32_t rows = savedRows(cache, header.length);
+    size_t   used = (size_t)rows * cache->rowSize;
+    size_t   size = (size_t)2 * cache->numLayers * used;
+    if (bufferSize != sizeof(header) + (size + cache->stateSize) * sizeof(float)) {
+        return -1;
+    }
+
+    /* Paged caches give up their old blocks and take fresh ones for the saved rows */
+    if (cache->blockTable) {
+        releaseKVBlocks(cache, 0);
+    }
+
+    const float *in = (const float *)((const uint8_t *)buffer + sizeof(header));
+    for (uint32_t l = 0; l < cache->numLayers; l++) {
+        if (tinyaiKVCacheWriteRows(cache, l, 0, rows, in + l * used,
+                                   in + (cache->numLayers + l) * used) != 0) {
+            tinyaiResetKVCache(cache);
+            return -1;
+        }
+    }
+    in += size;
+    if (cache->stateSize > 0) {
+        memcpy(cache->state, in, cache->stateSize * sizeof(float));
+    }
+
+    cache->length = header.length;
+    return 0;
+}
+
+/**
+ * Self-attention for new positions against a key/value cache
+ */
+int tinyaiSelfAttentionForwardCached(TinyAISelfAttention *attention, TinyAIKVCache *cache,
+                                     uint32_t layer, const float *input, uint32_t newLength,
+                                     float *output)
+{
+    if (!attention || !cache || !input || !output || newLength == 0 ||
+        layer >= cache->numLayers) {
+        return -1;
+    }
+
+    TinyAIAttentionParams *params     = &attention->params;
+    uint32_t               hiddenDim  = params->hiddenDim;
+    uint32_t               numHeads   = params->numHeads;
+    uint32_t               numKVHeads = params->numKVHeads;
+    uint32_t               headDim    = params->headDim;
+    uint32_t               kvDim      = numKVHeads * headDim;
+    uint32_t               start      = cache->length;
+    uint32_t               total      = start + newLength;
+
+    /* The cache holds the key/value heads only */
+    if (kvDim != cache->hiddenDim || numKVHeads != cache->numHeads || headDim != cache->headDim) {
+        return -1;
+    }
+
+    /* Scratch memory holds params->seqLength new positions; only a ring cache may wrap */
+    if (newLength > params->seqLength ||
+        (!cache->windowSize && total > cache->maxSeqLength) ||
+        (cache->windowSize && (params->windowSize == 0 || params->windowSize > cache->windowSize))) {
+        return -1;
+    }
+
+    float *query, *key, *value, *context, *accumulators;
+    getMemoryOffsets(params, &query, &key, &value, &context, &accumulators,
+                     attention->scratchMemory);
+
+    KVRows rows;
+    layerKVRows(cache, layer, &rows);
+
+    uint64_t span = TINYAI_TRACE_BEGIN();
+    if (!cache->windowSize && !cache->blockTable && cache->precision == TINYAI_KV_CACHE_FP32) {
+        /* Project the new positions, writing keys and values straight into the cache */
+        if (tinyaiSimdQKVProjection(input, &attention->queryWeight, &attention->keyWeight,
+                                    &attention->valueWeight, attention->queryBias,
+                                    attention->keyBias, attention->valueBias, query,
+                                    kvRowAddress(cache, NULL, layer, start, false),
+                                    kvRowAddress(cache, NULL, layer, start, true), newLength,
+                                    hiddenDim, numHeads, numKVHeads, headDim) != 0) {
+            return -1;
+        }
+        applyQKVDeltas(attention, input, query, kvRowAddress(cache, NULL, layer, start, false),
+                       kvRowAddress(cache, NULL, layer, start, true), newLength);
+        TINYAI_TRACE_END_ARG(span, "attention.qkv", newLength);
+
+        /* Attend each new query over the cached prefix plus the new positions */
+        span = TINYAI_TRACE_BEGIN();
+        if (attentionTiled(params, query, context, newLength, total, start, &rows,
+                           accumulators) != 0) {
+            return -1;
+        }
+        TINYAI_TRACE_END_ARG(span, "attention.attend", total);
+    }
+    else {
+        if (tinyaiSimdQKVProjection(input, &attention->queryWeight, &attention->keyWeight,
+                                    &attention->valueWeight, attention->queryBias,
+                                    attention->keyBias, attention->valueBias, query, key, value,
+                                    newLength, hiddenDim, numHeads, numKVHeads, headDim) != 0) {
+            return -1;
+        }
+        applyQKVDeltas(attention, input, query, key, value, newLength);
+        TINYAI_TRACE_END_ARG(span, "attention.qkv", newLength);
+
+        /* Each position of a ring overwrites the slot of the one leaving its window, so the
+           new positions enter the ring and attend one at a time; a linear cache stores them
+           all and attends once. Paged caches take or unshare the block of each slot first */
+        uint32_t slots = cache->maxSeqLength;
+        uint32_t batch = cache->windowSize ? 1 : newLength;
+        span           = TINYAI_TRACE_BEGIN();
+        for (uint32_t i = 0; i < newLength; i += batch) {
+            for (uint32_t b = i; b < i + batch; b++) {
+                uint32_t slot  = (start + b) % slots;
+                float   *block = NULL;
+                if (cache->blockTable && !(block = writableKVBlock(cache, slot))) {
+                    return -1;
                 }
+                storeKVRow(cache, kvRowAddress(cache, block, layer, slot, false),
+                           key + (size_t)b * kvDim);
+                storeKVRow(cache, kvRowAddress(cache, block, layer, slot, true),
+                           value + (size_t)b * kvDim);
+            }
+
+            if (attentionTiled(params, query + (size_t)i * hiddenDim,
+                               context + (size_t)i * hiddenDim, batch, start + i + batch,
+                               start + i, &rows, accumulators) != 0) {
+                return -1;
             }
         }
+        TINYAI_TRACE_END_ARG(span, "attention.attend", total);
+    }
+
+    /* Final output projection */
+    span       = TINYAI_TRACE_BEGIN();
+    int result = outputProjection(attention, context, output, newLength);
+    TINYAI_TRACE_END_ARG(span, "attention.output", newLength);
+    return result;
+}
+
+/**
+ * Store the keys and values of new positions without attending
+ */
+int tinyaiSelfAttentionStoreCached(TinyAISelfAttention *attention, TinyAIKVCache *cache,
+                                   uint32_t layer, const float *input, uint32_t newLength)
+{
+    if (!attention || !cache || !input || newLength == 0 || layer >= cache->numLayers) {
+        return -1;
+    }
+
+    TinyAIAttentionParams *params    = &attention->params;
+    uint32_t               hiddenDim = params->hiddenDim;
+    uint32_t               kvDim     = params->numKVHeads * params->headDim;
+    uint32_t               start     = cache->length;
+
+    /* Same layout and capacity checks as an attending pass */
+    if (kvDim != cache->hiddenDim || params->numKVHeads != cache->numHeads ||
+        params->headDim != cache->headDim || newLength > params->seqLength ||
+        (!cache->windowSize && start + newLength > cache->maxSeqLength) ||
+        (cache->windowSize &&
+         (params->windowSize == 0 || params->windowSize > cache->windowSize))) {
+        return -1;
+    }
+    if (attention->keyWeight.rows != hiddenDim || attention->keyWeight.cols != kvDim ||
+        attention->valueWeight.rows != hiddenDim || attention->valueWeight.cols != kvDim) {
+        return -1;
+    }
+
+    float *query, *key, *value, *context, *accumulators;
+    getMemoryOffsets(params, &query, &key, &value, &context, &accumulators,
+                     attention->scratchMemory);
+
+    const TinyAIMatrix4bit *weights[2] = {&attention->keyWeight, &attention->valueWeight};
+    const float            *biases[2]  = {attention->keyBias, attention->valueBias};
+    float                  *outputs[2] = {key, value};
+    if (tinyaiMatrix4bitMatMulGroup(weights, biases, outputs, 2, input, newLength) != 0) {
+        return -1;
+    }
+    if (attention->deltas) {
+        applyLowRankDelta(&attention->deltas[1], input, key, newLength, hiddenDim, kvDim);
+        applyLowRankDelta(&attention->deltas[2], input, value, newLength, hiddenDim, kvDim);
     }
 
+    for (uint32_t b = 0; b < newLength; b++) {
+        uint32_t slot  = (start + b) % cache->maxSeqLength;
+        float   *block = NULL;
+        if (cache->blockTable && !(block = writableKVBlock(cache, slot))) {
+            return -1;
+        }
+        storeKVRow(cache, kvRowAddress(cache, block, layer, slot, false), key + (size_t)b * kvDim);
+        storeKVRow(cache, kvRowAddress(cache, block, layer, slot, true), value + (size_t)b * kvDim);
+    }
     return 0;
 }
 
 /**
  * SIMD-accelerated softmax computation (public API)
+ *
+ * Each row goes through the shared softmax primitives of simd_ops, which pick
+ * the widest vector kernel available.
  */
 int tinyaiSimdAttentionSoftmax(const float *scores, float *softmaxScores, uint32_t seqLength,
-                               uint32_t numHeads)
+                               uint32_t numHeads, bool useCausalMask)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
+    /* Process each attention head separately */
+    for (uint32_t h = 0; h < numHeads; h++) {
+        /* Process each query position */
+        for (uint32_t i = 0; i < seqLength; i++) {
+            /* Get pointer to scores for this head and query position */
+            const float *rowScores  = scores + h * seqLength * seqLength + i * seqLength;
+            float       *rowSoftmax = softmaxScores + h * seqLength * seqLength + i * seqLength;
 
-    /* Use the most advanced SIMD version available */
-#if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
-        return tinyaiSimdAttentionSoftmaxAVX2(scores, softmaxScores, seqLength, numHeads);
-    }
-#endif
+            /* A causal row has weights only up to the diagonal */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
+            tinyaiSimdSoftmaxTemperature(rowSoftmax, rowScores, (int)keys, 1.0f);
 
-#if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
-        return tinyaiSimdAttentionSoftmaxSSE2(scores, softmaxScores, seqLength, numHeads);
+            /* Masked positions get no weight */
+            for (uint32_t j = keys; j < seqLength; j++) {
+                rowSoftmax[j] = 0.0f;
+            }
+        }
     }
-#endif
 
-    /* Fallback to reference implementation */
-    return tinyaiAttentionSoftmaxReference(scores, softmaxScores, seqLength, numHeads);
+    return 0;
 }
 
 /**
  * SIMD-accelerated attention context computation using AVX2
  */
 #if defined(HAS_AVX2_SUPPORT)
-static int tinyaiSimdAttentionContextAVX2(const float *softmaxScores, const float *value,
-                                          float *context, uint32_t seqLength, uint32_t numHeads,
-                                          uint32_t headDim)
+static TINYAI_TARGET_AVX2 int tinyaiSimdAttentionContextAVX2(const float *softmaxScores,
+                                                             const float *value, float *context,
+                                                             uint32_t seqLength, uint32_t numHeads,
+                                                             uint32_t numKVHeads, uint32_t headDim,
+                                                             bool useCausalMask)
 {
     /* Process each head */
     for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one value head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
         /* Process each query position */
         for (uint32_t i = 0; i < seqLength; i++) {
             /* Get softmax scores for this query position */
@@ -1074,31 +2406,29 @@ static int tinyaiSimdAttentionContextAVX2(const float *softmaxScores, const floa
 
             /* Initialize context vector for this position to zero */
             float *contextVec = context + i * numHeads * headDim + h * headDim;
-            for (uint32_t d = 0; d < headDim; d += 8) {
-                _mm256_storeu_ps(contextVec + d, _mm256_setzero_ps());
-            }
+            memset(contextVec, 0, headDim * sizeof(float));
+
+            /* Masked keys past the diagonal have zero weight, so a causal row stops there */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
 
             /* Compute weighted sum of value vectors */
-            for (uint32_t j = 0; j < seqLength; j++) {
+            for (uint32_t j = 0; j < keys; j++) {
                 /* Get value vector for this key position */
-                const float *valueVec = value + j * numHeads * headDim + h * headDim;
+                const float *valueVec = value + j * numKVHeads * headDim + kvHead * headDim;
 
                 /* Get attention weight */
-                float  weight    = scores[j];
-                __m256 weightVec = _mm256_set1_ps(weight);
+                float weight = scores[j];
 
                 /* Process in chunks of 8 */
-                for (uint32_t d = 0; d < headDim; d += 8) {
-                    /* Load current context and value vectors */
-                    __m256 contextChunk = _mm256_loadu_ps(contextVec + d);
-                    __m256 valueChunk   = _mm256_loadu_ps(valueVec + d);
-
-                    /* Multiply value by weight and add to context */
-                    __m256 weightedValue = _mm256_mul_ps(valueChunk, weightVec);
-                    contextChunk         = _mm256_add_ps(contextChunk, weightedValue);
-
-                    /* Store result back to context */
-                    _mm256_storeu_ps(contextVec + d, contextChunk);
+                __m256   weightVec = _mm256_set1_ps(weight);
+                uint32_t d         = 0;
+                for (; d + 8 <= headDim; d += 8) {
+                    __m256 weightedValue = _mm256_mul_ps(_mm256_loadu_ps(valueVec + d), weightVec);
+                    _mm256_storeu_ps(contextVec + d,
+                                     _mm256_add_ps(_mm256_loadu_ps(contextVec + d), weightedValue));
+                }
+                for (; d < headDim; d++) {
+                    contextVec[d] += weight * valueVec[d];
                 }
             }
         }
@@ -1114,10 +2444,13 @@ static int tinyaiSimdAttentionContextAVX2(const float *softmaxScores, const floa
 #if defined(HAS_SSE2_SUPPORT)
 static int tinyaiSimdAttentionContextSSE2(const float *softmaxScores, const float *value,
                                           float *context, uint32_t seqLength, uint32_t numHeads,
-                                          uint32_t headDim)
+                                          uint32_t numKVHeads, uint32_t headDim, bool useCausalMask)
 {
     /* Process each head */
     for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one value head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
         /* Process each query position */
         for (uint32_t i = 0; i < seqLength; i++) {
             /* Get softmax scores for this query position */
@@ -1125,31 +2458,79 @@ static int tinyaiSimdAttentionContextSSE2(const float *softmaxScores, const floa
 
             /* Initialize context vector for this position to zero */
             float *contextVec = context + i * numHeads * headDim + h * headDim;
-            for (uint32_t d = 0; d < headDim; d += 4) {
-                _mm_storeu_ps(contextVec + d, _mm_setzero_ps());
-            }
+            memset(contextVec, 0, headDim * sizeof(float));
+
+            /* Masked keys past the diagonal have zero weight, so a causal row stops there */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
 
             /* Compute weighted sum of value vectors */
-            for (uint32_t j = 0; j < seqLength; j++) {
+            for (uint32_t j = 0; j < keys; j++) {
                 /* Get value vector for this key position */
-                const float *valueVec = value + j * numHeads * headDim + h * headDim;
+                const float *valueVec = value + j * numKVHeads * headDim + kvHead * headDim;
 
                 /* Get attention weight */
-                float  weight    = scores[j];
-                __m128 weightVec = _mm_set1_ps(weight);
+                float weight = scores[j];
 
                 /* Process in chunks of 4 */
-                for (uint32_t d = 0; d < headDim; d += 4) {
-                    /* Load current context and value vectors */
-                    __m128 contextChunk = _mm_loadu_ps(contextVec + d);
-                    __m128 valueChunk   = _mm_loadu_ps(valueVec + d);
+                __m128   weightVec = _mm_set1_ps(weight);
+                uint32_t d         = 0;
+                for (; d + 4 <= headDim; d += 4) {
+                    __m128 weightedValue = _mm_mul_ps(_mm_loadu_ps(valueVec + d), weightVec);
+                    _mm_storeu_ps(contextVec + d,
+                                  _mm_add_ps(_mm_loadu_ps(contextVec + d), weightedValue));
+                }
+                for (; d < headDim; d++) {
+                    contextVec[d] += weight * valueVec[d];
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * SIMD-accelerated attention context computation using NEON
+ */
+#if defined(HAS_NEON_SUPPORT)
+static int tinyaiSimdAttentionContextNEON(const float *softmaxScores, const float *value,
+                                          float *context, uint32_t seqLength, uint32_t numHeads,
+                                          uint32_t numKVHeads, uint32_t headDim, bool useCausalMask)
+{
+    /* Process each head */
+    for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one value head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
+        /* Process each query position */
+        for (uint32_t i = 0; i < seqLength; i++) {
+            /* Get softmax scores for this query position */
+            const float *scores = softmaxScores + h * seqLength * seqLength + i * seqLength;
+
+            /* Initialize context vector for this position to zero */
+            float *contextVec = context + i * numHeads * headDim + h * headDim;
+            memset(contextVec, 0, headDim * sizeof(float));
+
+            /* Masked keys past the diagonal have zero weight, so a causal row stops there */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
+
+            /* Compute weighted sum of value vectors */
+            for (uint32_t j = 0; j < keys; j++) {
+                /* Get value vector for this key position */
+                const float *valueVec = value + j * numKVHeads * headDim + kvHead * headDim;
 
-                    /* Multiply value by weight and add to context */
-                    __m128 weightedValue = _mm_mul_ps(valueChunk, weightVec);
-                    contextChunk         = _mm_add_ps(contextChunk, weightedValue);
+                /* Get attention weight */
+                float weight = scores[j];
 
-                    /* Store result back to context */
-                    _mm_storeu_ps(contextVec + d, contextChunk);
+                /* Process in chunks of 4 */
+                uint32_t d = 0;
+                for (; d + 4 <= headDim; d += 4) {
+                    vst1q_f32(contextVec + d, vfmaq_n_f32(vld1q_f32(contextVec + d),
+                                                          vld1q_f32(valueVec + d), weight));
+                }
+                for (; d < headDim; d++) {
+                    contextVec[d] += weight * valueVec[d];
                 }
             }
         }
@@ -1164,10 +2545,14 @@ static int tinyaiSimdAttentionContextSSE2(const float *softmaxScores, const floa
  */
 static int tinyaiAttentionContextReference(const float *softmaxScores, const float *value,
                                            float *context, uint32_t seqLength, uint32_t numHeads,
-                                           uint32_t headDim)
+                                           uint32_t numKVHeads, uint32_t headDim,
+                                           bool useCausalMask)
 {
     /* Process each head */
     for (uint32_t h = 0; h < numHeads; h++) {
+        /* Query heads of a group share one value head */
+        uint32_t kvHead = h / (numHeads / numKVHeads);
+
         /* Process each query position */
         for (uint32_t i = 0; i < seqLength; i++) {
             /* Get softmax scores for this query position */
@@ -1175,14 +2560,15 @@ static int tinyaiAttentionContextReference(const float *softmaxScores, const flo
 
             /* Initialize context vector for this position to zero */
             float *contextVec = context + i * numHeads * headDim + h * headDim;
-            for (uint32_t d = 0; d < headDim; d++) {
-                contextVec[d] = 0.0f;
-            }
+            memset(contextVec, 0, headDim * sizeof(float));
+
+            /* Masked keys past the diagonal have zero weight, so a causal row stops there */
+            uint32_t keys = useCausalMask ? i + 1 : seqLength;
 
             /* Compute weighted sum of value vectors */
-            for (uint32_t j = 0; j < seqLength; j++) {
+            for (uint32_t j = 0; j < keys; j++) {
                 /* Get value vector for this key position */
-                const float *valueVec = value + j * numHeads * headDim + h * headDim;
+                const float *valueVec = value + j * numKVHeads * headDim + kvHead * headDim;
 
                 /* Get attention weight */
                 float weight = scores[j];
@@ -1202,158 +2588,38 @@ static int tinyaiAttentionContextReference(const float *softmaxScores, const flo
  * SIMD-accelerated attention context computation (public API)
  */
 int tinyaiSimdAttentionContext(const float *softmaxScores, const float *value, float *context,
-                               uint32_t seqLength, uint32_t numHeads, uint32_t headDim)
+                               uint32_t seqLength, uint32_t numHeads, uint32_t numKVHeads,
+                               uint32_t headDim, bool useCausalMask)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
+    if (numKVHeads == 0 || numHeads % numKVHeads != 0) {
+        return -1;
+    }
 
     /* Use the most advanced SIMD version available */
 #if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
+    if (tinyaiSimdHasAVX2()) {
         return tinyaiSimdAttentionContextAVX2(softmaxScores, value, context, seqLength, numHeads,
-                                              headDim);
+                                              numKVHeads, headDim, useCausalMask);
     }
 #endif
 
 #if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
+    if (tinyaiSimdAvailable()) {
         return tinyaiSimdAttentionContextSSE2(softmaxScores, value, context, seqLength, numHeads,
-                                              headDim);
-    }
-#endif
-
-    /* Fallback to reference implementation */
-    return tinyaiAttentionContextReference(softmaxScores, value, context, seqLength, numHeads,
-                                           headDim);
-}
-
-/**
- * SIMD-accelerated output projection using AVX2
- */
-#if defined(HAS_AVX2_SUPPORT)
-static int tinyaiSimdOutputProjectionAVX2(const float            *context,
-                                          const TinyAIMatrix4bit *outputWeight,
-                                          const float *outputBias, float *output,
-                                          uint32_t seqLength, uint32_t hiddenDim)
-{
-    /* Process each sequence position */
-    for (uint32_t i = 0; i < seqLength; i++) {
-        /* Get context vector for this position */
-        const float *contextVec = context + i * hiddenDim;
-
-        /* Get output vector for this position */
-        float *outputVec = output + i * hiddenDim;
-
-        /* Use SIMD matrix multiplication for projection */
-        float scale = outputWeight->scale;
-        tinyaiSimdMatMul4Bit(outputVec, outputWeight->data, contextVec, hiddenDim, hiddenDim,
-                             &scale);
-
-        /* Add bias if provided */
-        if (outputBias) {
-            /* Process in chunks of 8 */
-            for (uint32_t j = 0; j < hiddenDim; j += 8) {
-                /* Load bias and output vectors */
-                __m256 biasVec = _mm256_loadu_ps(outputBias + j);
-                __m256 outVec  = _mm256_loadu_ps(outputVec + j);
-
-                /* Add bias to output */
-                __m256 resultVec = _mm256_add_ps(outVec, biasVec);
-
-                /* Store result */
-                _mm256_storeu_ps(outputVec + j, resultVec);
-            }
-        }
+                                              numKVHeads, headDim, useCausalMask);
     }
-
-    return 0;
-}
 #endif
 
-/**
- * SIMD-accelerated output projection using SSE2
- */
-#if defined(HAS_SSE2_SUPPORT)
-static int tinyaiSimdOutputProjectionSSE2(const float            *context,
-                                          const TinyAIMatrix4bit *outputWeight,
-                                          const float *outputBias, float *output,
-                                          uint32_t seqLength, uint32_t hiddenDim)
-{
-    /* Process each sequence position */
-    for (uint32_t i = 0; i < seqLength; i++) {
-        /* Get context vector for this position */
-        const float *contextVec = context + i * hiddenDim;
-
-        /* Get output vector for this position */
-        float *outputVec = output + i * hiddenDim;
-
-        /* Use SIMD matrix multiplication for projection */
-        float scale = outputWeight->scale;
-        tinyaiSimdMatMul4Bit(outputVec, outputWeight->data, contextVec, hiddenDim, hiddenDim,
-                             &scale);
-
-        /* Add bias if provided */
-        if (outputBias) {
-            /* Process in chunks of 4 */
-            for (uint32_t j = 0; j < hiddenDim; j += 4) {
-                /* Load bias and output vectors */
-                __m128 biasVec = _mm_loadu_ps(outputBias + j);
-                __m128 outVec  = _mm_loadu_ps(outputVec + j);
-
-                /* Add bias to output */
-                __m128 resultVec = _mm_add_ps(outVec, biasVec);
-
-                /* Store result */
-                _mm_storeu_ps(outputVec + j, resultVec);
-            }
-        }
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        return tinyaiSimdAttentionContextNEON(softmaxScores, value, context, seqLength, numHeads,
+                                              numKVHeads, headDim, useCausalMask);
     }
-
-    return 0;
-}
 #endif
 
-/**
- * Reference implementation of output projection
- */
-static int tinyaiOutputProjectionReference(const float            *context,
-                                           const TinyAIMatrix4bit *outputWeight,
-                                           const float *outputBias, float *output,
-                                           uint32_t seqLength, uint32_t hiddenDim)
-{
-    /* Process each sequence position */
-    for (uint32_t i = 0; i < seqLength; i++) {
-        /* Get context vector for this position */
-        const float *contextVec = context + i * hiddenDim;
-
-        /* Get output vector for this position */
-        float *outputVec = output + i * hiddenDim;
-
-        /* Dequantize output weight matrix */
-        TinyAIMatrixFP32 *outputWeightFP32 = tinyaiDequantize4bitToFP32(outputWeight);
-        if (!outputWeightFP32) {
-            return -1;
-        }
-
-        /* Matrix multiplication */
-        for (uint32_t j = 0; j < hiddenDim; j++) {
-            float sum = outputBias ? outputBias[j] : 0.0f;
-
-            for (uint32_t k = 0; k < hiddenDim; k++) {
-                sum += contextVec[k] * outputWeightFP32->data[k * hiddenDim + j];
-            }
-
-            outputVec[j] = sum;
-        }
-
-        /* Clean up */
-        tinyaiDestroyMatrixFP32(outputWeightFP32);
-    }
-
-    return 0;
+    /* Fallback to reference implementation */
+    return tinyaiAttentionContextReference(softmaxScores, value, context, seqLength, numHeads,
+                                           numKVHeads, headDim, useCausalMask);
 }
 
 /**
@@ -1363,28 +2629,10 @@ int tinyaiSimdOutputProjection(const float *context, const TinyAIMatrix4bit *out
                                const float *outputBias, float *output, uint32_t seqLength,
                                uint32_t hiddenDim)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
-
-    /* Use the most advanced SIMD version available */
-#if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
-        return tinyaiSimdOutputProjectionAVX2(context, outputWeight, outputBias, output, seqLength,
-                                              hiddenDim);
-    }
-#endif
-
-#if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
-        return tinyaiSimdOutputProjectionSSE2(context, outputWeight, outputBias, output, seqLength,
-                                              hiddenDim);
+    if (!outputWeight || outputWeight->rows != hiddenDim || outputWeight->cols != hiddenDim) {
+        return -1;
     }
-#endif
 
-    /* Fallback to reference implementation */
-    return tinyaiOutputProjectionReference(context, outputWeight, outputBias, output, seqLength,
-                                           hiddenDim);
+    /* Every sequence position as one GEMM on the packed weights */
+    return tinyaiMatrix4bitMatMul(outputWeight, context, seqLength, outputBias, output);
 }
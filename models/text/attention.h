@@ -8,42 +8,137 @@
 #ifndef TINYAI_ATTENTION_H
 #define TINYAI_ATTENTION_H
 
+#include "../../utils/advanced_memory_pool.h"
 #include "../../utils/quantize.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/**
+ * Keys scored at a time by the tiled attention kernel
+ */
+#define TINYAI_ATTENTION_TILE 64
+
+/**
+ * Floats per cache line; each head's tiled-attention accumulator starts on its own line
+ */
+#define TINYAI_ATTENTION_LINE_FLOATS 16
+
+/**
+ * Positions per block of a paged key/value cache
+ */
+#define TINYAI_KV_BLOCK_SIZE 16
+
+/**
+ * Block table entry of positions that have no block yet
+ */
+#define TINYAI_KV_NO_BLOCK UINT32_MAX
+
+/**
+ * Storage format of cached keys and values
+ */
+typedef enum {
+    TINYAI_KV_CACHE_FP32 = 0, /* 32-bit floats */
+    TINYAI_KV_CACHE_FP16,     /* IEEE half-precision floats */
+    TINYAI_KV_CACHE_INT8      /* Symmetric 8-bit integers, one scale per head of each position */
+} TinyAIKVCachePrecision;
+
 /**
  * Attention parameters structure
  */
 typedef struct {
-    uint32_t batchSize;     /* Batch size (usually 1 for inference) */
-    uint32_t seqLength;     /* Sequence length */
-    uint32_t numHeads;      /* Number of attention heads */
-    uint32_t headDim;       /* Dimension of each head */
-    uint32_t hiddenDim;     /* Hidden dimension (numHeads * headDim) */
-    bool     useCausalMask; /* Whether to use causal masking */
-    float    scaleFactor;   /* Scale factor for QK^T product (usually 1/sqrt(headDim)) */
+    uint32_t               batchSize;        /* Batch size (usually 1 for inference) */
+    uint32_t               seqLength;        /* Sequence length */
+    uint32_t               numHeads;         /* Number of attention (query) heads */
+    uint32_t               numKVHeads;       /* Key/value heads, each shared by numHeads /
+                                                numKVHeads query heads (0 = numHeads) */
+    uint32_t               headDim;          /* Dimension of each head */
+    uint32_t               hiddenDim;        /* Hidden dimension (numHeads * headDim) */
+    uint32_t               windowSize;       /* Each query sees only the last windowSize
+                                                positions, itself included (0 = no window) */
+    bool                   useCausalMask;    /* Whether to use causal masking */
+    float                  scaleFactor;      /* Scale factor for QK^T product (usually
+                                                1/sqrt(headDim)) */
+    TinyAIKVCachePrecision kvCachePrecision; /* Storage format of key/value caches */
 } TinyAIAttentionParams;
 
+/**
+ * Low-rank update of a projection (LoRA): y += scale * (x * down^T) * up
+ */
+typedef struct {
+    const float *down;  /* Down-projection [rank x input size] */
+    const float *up;    /* Up-projection [rank x output size] */
+    uint32_t     rank;  /* Rank of the update */
+    float        scale; /* Scale of the update (alpha / rank) */
+} TinyAILowRankDelta;
+
 /**
  * Self-attention structure
  */
 typedef struct {
-    TinyAIAttentionParams params;        /* Attention parameters */
-    TinyAIMatrix4bit      queryWeight;   /* Query projection weights */
-    TinyAIMatrix4bit      keyWeight;     /* Key projection weights */
-    TinyAIMatrix4bit      valueWeight;   /* Value projection weights */
-    TinyAIMatrix4bit      outputWeight;  /* Output projection weights */
-    float                *queryBias;     /* Query projection bias */
-    float                *keyBias;       /* Key projection bias */
-    float                *valueBias;     /* Value projection bias */
-    float                *outputBias;    /* Output projection bias */
-    float                *scratchMemory; /* Scratch memory for intermediate results */
+    TinyAIAttentionParams     params;        /* Attention parameters */
+    TinyAIMatrix4bit          queryWeight;   /* Query projection weights */
+    TinyAIMatrix4bit          keyWeight;     /* Key projection weights */
+    TinyAIMatrix4bit          valueWeight;   /* Value projection weights */
+    TinyAIMatrix4bit          outputWeight;  /* Output projection weights */
+    float                    *queryBias;     /* Query projection bias */
+    float                    *keyBias;       /* Key projection bias */
+    float                    *valueBias;     /* Value projection bias */
+    float                    *outputBias;    /* Output projection bias */
+    float                    *scratchMemory; /* Scratch memory for intermediate results */
+    const TinyAILowRankDelta *deltas;        /* Query, key, value and output updates added
+                                                after the projections (NULL = none) */
 } TinyAISelfAttention;
 
+/**
+ * Shared pool of fixed-size key/value cache blocks (opaque)
+ */
+typedef struct TinyAIKVBlockPool TinyAIKVBlockPool;
+
+/**
+ * Key/value cache for incremental decoding
+ *
+ * Holds the projected keys and values of every position processed so far,
+ * for each attention layer of a model. Keys and values use the same
+ * [position x (numHeads*headDim)] layout as tinyaiSimdQKVProjection output;
+ * with grouped-query attention only the key/value heads are stored.
+ * Caches for sliding-window attention are ring buffers: position p lives in
+ * row p % maxSeqLength, and length keeps counting past maxSeqLength.
+ * Quantized caches pack each row into rowSize floats of storage: FP16 rows
+ * hold hiddenDim halves, INT8 rows numHeads float scales followed by
+ * hiddenDim signed bytes. The attention kernels read them in place.
+ * Paged caches keep no rows of their own: a block table maps every
+ * TINYAI_KV_BLOCK_SIZE rows to a block of a shared TinyAIKVBlockPool, which
+ * holds those rows of every layer, keys then values. Blocks are taken from
+ * the pool when their first row is written, so a short sequence only holds
+ * the blocks it uses.
+ * Models with recurrent layers also keep their hidden state here, so the
+ * cache is the complete decoding state of one sequence.
+ */
+typedef struct {
+    uint32_t               numLayers;    /* Number of attention layers cached */
+    uint32_t               maxSeqLength; /* Maximum number of cached positions (rows of a ring) */
+    uint32_t               windowSize;   /* Ring of the last windowSize positions (0 = linear) */
+    uint32_t               numHeads;     /* Number of key/value heads cached */
+    uint32_t               headDim;      /* Dimension of each head */
+    uint32_t               hiddenDim;    /* Key/value row width (numHeads * headDim) */
+    uint32_t               length;       /* Number of positions currently cached */
+    TinyAIKVCachePrecision precision;    /* Storage format of keys and values */
+    uint32_t               rowSize;      /* Floats of storage per row (hiddenDim for FP32) */
+    float                 *keys;         /* Cached keys [numLayers x maxSeqLength x rowSize] */
+    float                 *values;       /* Cached values [numLayers x maxSeqLength x rowSize] */
+    TinyAIKVBlockPool     *blockPool;    /* Pool holding the rows of a paged cache, or NULL */
+    uint32_t              *blockTable;   /* Pool block of every TINYAI_KV_BLOCK_SIZE rows */
+    uint32_t               stateSize;    /* Floats of recurrent state (0 = no recurrent layers) */
+    float                 *state;        /* Recurrent hidden state after the cached positions */
+} TinyAIKVCache;
+
 /**
  * Initialize self-attention structure
  *
+ * A zero params->numKVHeads is stored as numHeads (plain multi-head
+ * attention); numHeads must be a multiple of numKVHeads.
+ *
  * @param attention Attention structure to initialize
  * @param params Attention parameters
  * @return 0 on success, -1 on error
@@ -57,17 +152,25 @@ int tinyaiInitSelfAttention(TinyAISelfAttention *attention, const TinyAIAttentio
  */
 void tinyaiDestroySelfAttention(TinyAISelfAttention *attention);
 
+/**
+ * Get the size of an attention structure's scratch memory
+ *
+ * @param attention Attention structure
+ * @return Bytes of scratch memory (0 if none is allocated)
+ */
+size_t tinyaiSelfAttentionScratchSize(const TinyAISelfAttention *attention);
+
 /**
  * Set weights for self-attention
  *
  * @param attention Attention structure
  * @param queryWeight Query projection weights (4-bit quantized)
- * @param keyWeight Key projection weights (4-bit quantized)
- * @param valueWeight Value projection weights (4-bit quantized)
+ * @param keyWeight Key projection weights [hiddenDim x numKVHeads*headDim] (4-bit quantized)
+ * @param valueWeight Value projection weights [hiddenDim x numKVHeads*headDim] (4-bit quantized)
  * @param outputWeight Output projection weights (4-bit quantized)
  * @param queryBias Query projection bias
- * @param keyBias Key projection bias
- * @param valueBias Value projection bias
+ * @param keyBias Key projection bias [numKVHeads*headDim]
+ * @param valueBias Value projection bias [numKVHeads*headDim]
  * @param outputBias Output projection bias
  * @return 0 on success, -1 on error
  */
@@ -88,6 +191,289 @@ int tinyaiSetAttentionWeights(TinyAISelfAttention *attention, const TinyAIMatrix
  */
 int tinyaiSelfAttentionForward(TinyAISelfAttention *attention, const float *input, float *output);
 
+/**
+ * Create a key/value cache
+ *
+ * A windowSize shorter than seqLength makes a ring buffer of windowSize rows.
+ * params->kvCachePrecision selects the storage format: FP16 halves and INT8
+ * roughly quarters the memory of FP32, at the cost of rounding every cached
+ * key and value.
+ *
+ * @param numLayers Number of attention layers to cache
+ * @param params Attention parameters (seqLength is the cache capacity)
+ * @return New cache or NULL on error
+ */
+TinyAIKVCache *tinyaiCreateKVCache(uint32_t numLayers, const TinyAIAttentionParams *params);
+
+/**
+ * Allocate recurrent hidden state in a key/value cache
+ *
+ * The state starts at zero and is zeroed again on every reset.
+ *
+ * @param cache Cache without recurrent state
+ * @param stateSize Floats of hidden state over all recurrent layers
+ * @return 0 on success, -1 on error
+ */
+int tinyaiKVCacheAddState(TinyAIKVCache *cache, uint32_t stateSize);
+
+/**
+ * Reset a key/value cache to zero cached positions
+ *
+ * @param cache Cache to reset
+ */
+void tinyaiResetKVCache(TinyAIKVCache *cache);
+
+/**
+ * Free a key/value cache
+ *
+ * @param cache Cache to free
+ */
+void tinyaiDestroyKVCache(TinyAIKVCache *cache);
+
+/**
+ * Get the memory a key/value cache holds itself
+ *
+ * Counts the rows of a contiguous cache, or the block table of a paged one,
+ * and any recurrent state. The blocks of a paged cache belong to its pool.
+ *
+ * @param cache Cache to measure
+ * @return Bytes held by the cache
+ */
+size_t tinyaiKVCacheMemoryUsage(const TinyAIKVCache *cache);
+
+/**
+ * Create a pool of key/value cache blocks shared by paged caches
+ *
+ * Every paged cache drawing on the pool has the layout tinyaiCreateKVCache
+ * would give it for the same arguments. Block storage is taken from memory
+ * on first use and recycled when no cache references the block any more.
+ * A pool, and the caches drawing on it, must be used from one thread at a
+ * time.
+ *
+ * @param numLayers Number of attention layers to cache
+ * @param params Attention parameters (seqLength is the capacity of each cache)
+ * @param maxBlocks Blocks the pool may hand out over all its caches
+ * @param memory Memory pool for block storage (NULL = heap)
+ * @return New block pool or NULL on error
+ */
+TinyAIKVBlockPool *tinyaiCreateKVBlockPool(uint32_t numLayers, const TinyAIAttentionParams *params,
+                                           uint32_t maxBlocks, TinyAIAdvancedMemoryPool *memory);
+
+/**
+ * Free a key/value block pool
+ *
+ * Every cache drawing on the pool must be destroyed first.
+ *
+ * @param pool Block pool to free
+ */
+void tinyaiDestroyKVBlockPool(TinyAIKVBlockPool *pool);
+
+/**
+ * Get the number of blocks a block pool can still hand out
+ *
+ * @param pool Block pool
+ * @return Blocks not referenced by any cache
+ */
+uint32_t tinyaiKVBlockPoolFreeBlocks(const TinyAIKVBlockPool *pool);
+
+/**
+ * Get the block storage a pool holds
+ *
+ * @param pool Block pool
+ * @param peakBytes Receives the most block storage ever held at once (can be NULL)
+ * @return Bytes of block storage held now
+ */
+size_t tinyaiKVBlockPoolMemoryUsage(const TinyAIKVBlockPool *pool, size_t *peakBytes);
+
+/**
+ * Free the storage of blocks no cache references
+ *
+ * The blocks stay available and get new storage when next handed out.
+ *
+ * @param pool Block pool
+ * @return Bytes released
+ */
+size_t tinyaiKVBlockPoolTrim(TinyAIKVBlockPool *pool);
+
+/**
+ * Create a paged key/value cache drawing on a block pool
+ *
+ * The cache starts empty and holds no blocks.
+ *
+ * @param pool Block pool
+ * @return New cache or NULL on error
+ */
+TinyAIKVCache *tinyaiCreatePagedKVCache(TinyAIKVBlockPool *pool);
+
+/**
+ * Create a copy of a key/value cache
+ *
+ * A fork of a paged cache shares all of its blocks, so sequences that
+ * continue from a common prefix store it once; a shared block is copied
+ * only when one of the caches writes to it. Contiguous caches are copied.
+ *
+ * @param cache Cache to copy
+ * @return New cache with the same positions and state, or NULL on error
+ */
+TinyAIKVCache *tinyaiForkKVCache(const TinyAIKVCache *cache);
+
+/**
+ * Mark newly processed positions as cached
+ *
+ * Call once per forward step, after every attention layer has written its
+ * keys and values for the new positions.
+ *
+ * @param cache Cache to advance
+ * @param count Number of new positions
+ * @return 0 on success, -1 if the cache would overflow
+ */
+int tinyaiKVCacheAdvance(TinyAIKVCache *cache, uint32_t count);
+
+/**
+ * Check whether more positions fit in a key/value cache
+ *
+ * A paged cache also needs its pool to have blocks for the new rows.
+ *
+ * @param cache Cache to check
+ * @param count Number of new positions
+ * @return true if count positions can be added (always for contiguous ring buffers)
+ */
+bool tinyaiKVCacheFits(const TinyAIKVCache *cache, uint32_t count);
+
+/**
+ * Discard cached positions beyond a length
+ *
+ * Used to roll back positions that were processed speculatively; the
+ * discarded keys and values are overwritten by the next forward step.
+ * Recurrent state cannot be rewound, so caches holding it can only be
+ * truncated to their current length or reset; neither can a ring buffer
+ * that has wrapped.
+ *
+ * @param cache Cache to truncate
+ * @param length New number of cached positions (at most cache->length)
+ * @return 0 on success, -1 on error
+ */
+int tinyaiKVCacheTruncate(TinyAIKVCache *cache, uint32_t length);
+
+/**
+ * Discard a run of cached positions, moving the later ones down
+ *
+ * Lets a long sequence drop its oldest positions, or any run between ones
+ * it wants to keep such as a system prompt, and carry on without
+ * recomputing the rest. The positions kept retain their keys and values,
+ * which were computed with the discarded ones still in context; recurrent
+ * state cannot forget positions and is left as it is. A ring buffer that
+ * has wrapped cannot discard positions.
+ *
+ * @param cache Cache to edit
+ * @param first First position to discard
+ * @param count Number of positions to discard
+ * @return 0 on success, -1 on error or if a paged cache's pool runs out of blocks
+ */
+int tinyaiKVCacheDiscard(TinyAIKVCache *cache, uint32_t first, uint32_t count);
+
+/**
+ * Write key and value rows of one layer, in the cache's storage format
+ *
+ * Rows are the ring slots of the positions (position % maxSeqLength).
+ * Paged caches take a block for every row that has none and copy blocks
+ * they share before writing to them.
+ *
+ * @param cache Cache to write to
+ * @param layer Attention layer index
+ * @param firstRow First row to write
+ * @param count Number of rows
+ * @param keys Key rows [count x rowSize]
+ * @param values Value rows [count x rowSize]
+ * @return 0 on success, -1 on error or if the block pool is exhausted
+ */
+int tinyaiKVCacheWriteRows(TinyAIKVCache *cache, uint32_t layer, uint32_t firstRow,
+                           uint32_t count, const float *keys, const float *values);
+
+/**
+ * Read key and value rows of one layer, in the cache's storage format
+ *
+ * @param cache Cache to read from
+ * @param layer Attention layer index
+ * @param firstRow First row to read
+ * @param count Number of rows (all of them written before)
+ * @param keys Output key rows [count x rowSize]
+ * @param values Output value rows [count x rowSize]
+ * @return 0 on success, -1 on error
+ */
+int tinyaiKVCacheReadRows(const TinyAIKVCache *cache, uint32_t layer, uint32_t firstRow,
+                          uint32_t count, float *keys, float *values);
+
+/**
+ * Get the size of a saved key/value cache
+ *
+ * Only the cached positions and the recurrent state are saved, so
+ * suspending a short sequence is cheap.
+ *
+ * @param cache Cache to save
+ * @return Bytes tinyaiSaveKVCache writes, or 0 on error
+ */
+size_t tinyaiKVCacheSavedSize(const TinyAIKVCache *cache);
+
+/**
+ * Save the state of a key/value cache to a buffer
+ *
+ * @param cache Cache to save
+ * @param buffer Output buffer
+ * @param bufferSize Size of the buffer (at least tinyaiKVCacheSavedSize)
+ * @return Bytes written, or 0 on error
+ */
+size_t tinyaiSaveKVCache(const TinyAIKVCache *cache, void *buffer, size_t bufferSize);
+
+/**
+ * Restore a key/value cache from a buffer written by tinyaiSaveKVCache
+ *
+ * The cache must have the same layout as the saved one, for example
+ * another cache created for the same model.
+ *
+ * @param cache Cache to overwrite
+ * @param buffer Saved state
+ * @param bufferSize Size of the saved state
+ * @return 0 on success, -1 if the buffer does not match the cache
+ */
+int tinyaiRestoreKVCache(TinyAIKVCache *cache, const void *buffer, size_t bufferSize);
+
+/**
+ * Perform self-attention for new positions against a key/value cache
+ *
+ * Projects the new positions, appends their keys and values to the cache
+ * for the given layer at offset cache->length, and attends each new query
+ * over all cached positions up to and including itself.
+ *
+ * @param attention Attention structure
+ * @param cache Key/value cache
+ * @param layer Attention layer index within the cache
+ * @param input Input tensor for the new positions [newLength x hiddenDim]
+ * @param newLength Number of new positions
+ * @param output Output tensor [newLength x hiddenDim]
+ * @return 0 on success, -1 on error
+ */
+int tinyaiSelfAttentionForwardCached(TinyAISelfAttention *attention, TinyAIKVCache *cache,
+                                     uint32_t layer, const float *input, uint32_t newLength,
+                                     float *output);
+
+/**
+ * Store the keys and values of new positions in a cache without attending
+ *
+ * Projects and stores the positions exactly as tinyaiSelfAttentionForwardCached
+ * does, skipping the queries, the attention itself and the output projection.
+ * A forward pass that stops early fills the layers it skipped this way.
+ *
+ * @param attention Attention structure
+ * @param cache Key/value cache
+ * @param layer Attention layer index within the cache
+ * @param input Input tensor for the new positions [newLength x hiddenDim]
+ * @param newLength Number of new positions
+ * @return 0 on success, -1 on error
+ */
+int tinyaiSelfAttentionStoreCached(TinyAISelfAttention *attention, TinyAIKVCache *cache,
+                                   uint32_t layer, const float *input, uint32_t newLength);
+
 /**
  * SIMD-accelerated query-key-value projection
  *
@@ -99,11 +485,12 @@ int tinyaiSelfAttentionForward(TinyAISelfAttention *attention, const float *inpu
  * @param keyBias Key projection bias
  * @param valueBias Value projection bias
  * @param query Output query tensor [seqLength x (numHeads*headDim)]
- * @param key Output key tensor [seqLength x (numHeads*headDim)]
- * @param value Output value tensor [seqLength x (numHeads*headDim)]
+ * @param key Output key tensor [seqLength x (numKVHeads*headDim)]
+ * @param value Output value tensor [seqLength x (numKVHeads*headDim)]
  * @param seqLength Sequence length
  * @param hiddenDim Hidden dimension
  * @param numHeads Number of attention heads
+ * @param numKVHeads Number of key/value heads
  * @param headDim Dimension of each head
  * @return 0 on success, -1 on error
  */
@@ -111,50 +498,104 @@ int tinyaiSimdQKVProjection(const float *input, const TinyAIMatrix4bit *queryWei
                             const TinyAIMatrix4bit *keyWeight, const TinyAIMatrix4bit *valueWeight,
                             const float *queryBias, const float *keyBias, const float *valueBias,
                             float *query, float *key, float *value, uint32_t seqLength,
-                            uint32_t hiddenDim, uint32_t numHeads, uint32_t headDim);
+                            uint32_t hiddenDim, uint32_t numHeads, uint32_t numKVHeads,
+                            uint32_t headDim);
 
 /**
  * SIMD-accelerated attention score computation (Q*K^T)
  *
  * @param query Query tensor [seqLength x (numHeads*headDim)]
- * @param key Key tensor [seqLength x (numHeads*headDim)]
+ * @param key Key tensor [seqLength x (numKVHeads*headDim)]
  * @param scores Output scores tensor [numHeads x seqLength x seqLength]
  * @param seqLength Sequence length
  * @param numHeads Number of attention heads
+ * @param numKVHeads Number of key heads (a divisor of numHeads)
  * @param headDim Dimension of each head
  * @param scaleFactor Scale factor (usually 1/sqrt(headDim))
- * @param useCausalMask Whether to use causal masking
+ * @param useCausalMask Whether to use causal masking (scores past the diagonal are set to
+ *                      -INFINITY without being computed)
  * @return 0 on success, -1 on error
  */
 int tinyaiSimdAttentionScores(const float *query, const float *key, float *scores,
-                              uint32_t seqLength, uint32_t numHeads, uint32_t headDim,
-                              float scaleFactor, bool useCausalMask);
+                              uint32_t seqLength, uint32_t numHeads, uint32_t numKVHeads,
+                              uint32_t headDim, float scaleFactor, bool useCausalMask);
 
 /**
  * SIMD-accelerated softmax computation for attention scores
  *
+ * Rows of a causal mask are normalized only up to the diagonal, and the
+ * masked positions after it are set to zero without being exponentiated.
+ *
  * @param scores Attention scores [numHeads x seqLength x seqLength]
  * @param softmaxScores Output softmax scores [numHeads x seqLength x seqLength]
  * @param seqLength Sequence length
  * @param numHeads Number of attention heads
+ * @param useCausalMask Whether the scores use causal masking
  * @return 0 on success, -1 on error
  */
 int tinyaiSimdAttentionSoftmax(const float *scores, float *softmaxScores, uint32_t seqLength,
-                               uint32_t numHeads);
+                               uint32_t numHeads, bool useCausalMask);
 
 /**
  * SIMD-accelerated attention context computation (softmax(Q*K^T)*V)
  *
  * @param softmaxScores Softmax scores [numHeads x seqLength x seqLength]
- * @param value Value tensor [seqLength x (numHeads*headDim)]
+ * @param value Value tensor [seqLength x (numKVHeads*headDim)]
  * @param context Output context tensor [seqLength x (numHeads*headDim)]
  * @param seqLength Sequence length
  * @param numHeads Number of attention heads
+ * @param numKVHeads Number of value heads (a divisor of numHeads)
  * @param headDim Dimension of each head
+ * @param useCausalMask Whether to skip the masked keys after each query
  * @return 0 on success, -1 on error
  */
 int tinyaiSimdAttentionContext(const float *softmaxScores, const float *value, float *context,
-                               uint32_t seqLength, uint32_t numHeads, uint32_t headDim);
+                               uint32_t seqLength, uint32_t numHeads, uint32_t numKVHeads,
+                               uint32_t headDim, bool useCausalMask);
+
+/**
+ * Fused scores, softmax and context with an online-softmax accumulator
+ *
+ * Computes softmax(Q*K^T*scale)*V one TINYAI_ATTENTION_TILE block of keys
+ * at a time, keeping a running maximum and sum per query, so the
+ * [numHeads x queryLength x keyLength] score matrix is never stored. Query
+ * i sits at position queryStart + i; the causal mask and sliding window of
+ * params pick the keys it sees. Heads run on the shared thread pool, each
+ * accumulating into its own cache-line-aligned row of accumulators so
+ * workers never write to the same line until the finished context is
+ * stored.
+ *
+ * @param params Head layout, scale, causal mask and window
+ * @param query Query tensor [queryLength x (numHeads*headDim)]
+ * @param key Key tensor [keyRows x (numKVHeads*headDim)]
+ * @param value Value tensor [keyRows x (numKVHeads*headDim)]
+ * @param context Output context tensor [queryLength x (numHeads*headDim)]
+ * @param queryLength Number of queries
+ * @param keyLength Number of key positions
+ * @param queryStart Position of the first query among the keys
+ * @param keyRows Rows of key and value; position p is row p % keyRows (0 = keyLength)
+ * @param accumulators Scratch of tinyaiAttentionAccumulatorSize floats, or NULL to
+ *                     accumulate straight into context
+ * @return 0 on success, -1 on error
+ */
+int tinyaiSimdAttentionTiled(const TinyAIAttentionParams *params, const float *query,
+                             const float *key, const float *value, float *context,
+                             uint32_t queryLength, uint32_t keyLength, uint32_t queryStart,
+                             uint32_t keyRows, float *accumulators);
+
+/**
+ * Get the scratch size of the per-head accumulators of tinyaiSimdAttentionTiled
+ *
+ * Three rows of headDim floats per head, each padded to
+ * TINYAI_ATTENTION_LINE_FLOATS, plus one line of slack so the rows can be
+ * aligned inside any buffer. The second row receives decoded rows of
+ * quantized key/value caches, the third the int8 query scored against
+ * INT8 keys by the AVX-512 VNNI or NEON SDOT kernel.
+ *
+ * @param params Head layout
+ * @return Accumulator scratch size in floats
+ */
+size_t tinyaiAttentionAccumulatorSize(const TinyAIAttentionParams *params);
 
 /**
  * SIMD-accelerated output projection
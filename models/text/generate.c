@@ -7,8 +7,17 @@
 
 #include "generate.h"
 #include "../../core/config.h"
+#include "../../core/io.h"
 #include "../../core/memory.h"
+#include "../../utils/energy.h"
+#include "../../utils/mmap_loader.h"
+#include "../../utils/numa.h"
+#include "../../utils/prune.h"
 #include "../../utils/quantize.h"
+#include "../../utils/simd_ops.h"
+#include "../../utils/sparse_ops.h"
+#include "../../utils/thread_pool.h"
+#include "../../utils/trace.h"
 #include "tokenizer.h"
 #include <math.h>
 #include <stdio.h>
@@ -16,21 +25,50 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /* ----------------- Internal Constants and Definitions ----------------- */
 
 /* Block size for matrix multiplication */
 #define BLOCK_SIZE 32
 
-/* KV cache entry */
-typedef struct {
-    float *key;   /* Key vector */
-    float *value; /* Value vector */
-} KVCacheEntry;
+/* Relative cost per weight value of each format, for choosing without benchmarking */
+#define SPARSE_COST_DENSE 1.0f  /* Packed 4-bit weight */
+#define SPARSE_COST_BSR   2.0f  /* Value of a stored block */
+#define SPARSE_COST_CSR   8.0f  /* Non-zero of a 4-bit CSR row */
+
+/* Rows of the BSR blocks built for pruned layers */
+#define SPARSE_BSR_BLOCK_ROWS 4
+
+/* Timed repetitions of each candidate when benchmarking weight formats */
+#define SPARSE_BENCHMARK_RUNS 8
+
+/* Candidates an autotuned step can time: each weight format, pooled and serial */
+#define AUTOTUNE_MAX_CANDIDATES 6
+
+/* Rows a step widens from half-precision activations at a time */
+#define HALF_STAGE_ROWS 16
+
+/* Alignment of the data sections of a model snapshot */
+#define SNAPSHOT_ALIGNMENT 64
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
 
 /* ----------------- Static Variables ----------------- */
 
-/* Random number generator state */
-static unsigned int randState = 1;
+/* Random number generator state, per thread so concurrent generations stay reproducible */
+static THREAD_LOCAL unsigned int randState = 1;
 
 /* ----------------- Helper Functions ----------------- */
 
@@ -49,54 +87,161 @@ static float randomFloat()
 }
 
 /**
- * Apply temperature to logits
+ * Convert logits to probabilities using softmax at the given temperature
+ */
+static void softmax(float *probs, const float *logits, uint32_t size, float temperature)
+{
+    tinyaiSimdSoftmaxTemperature(probs, logits, (int)size, temperature);
+}
+
+/**
+ * Whether token a ranks before token b: higher probability first, lower id on ties
+ */
+static inline bool ranksBefore(const float *probs, uint32_t a, uint32_t b)
+{
+    return probs[a] > probs[b] || (probs[a] == probs[b] && a < b);
+}
+
+/**
+ * Restore the heap property below position i of a heap whose root ranks last
  */
-static void applyTemperature(float *logits, uint32_t size, float temperature)
+static void siftDown(const float *probs, uint32_t *heap, uint32_t count, uint32_t i)
 {
-    if (temperature <= 0.0f) {
-        temperature = 1.0f;
+    for (;;) {
+        uint32_t last  = i;
+        uint32_t left  = 2 * i + 1;
+        uint32_t right = left + 1;
+
+        if (left < count && ranksBefore(probs, heap[last], heap[left])) {
+            last = left;
+        }
+        if (right < count && ranksBefore(probs, heap[last], heap[right])) {
+            last = right;
+        }
+        if (last == i) {
+            return;
+        }
+
+        uint32_t temp = heap[i];
+        heap[i]       = heap[last];
+        heap[last]    = temp;
+        i             = last;
     }
+}
 
-    for (uint32_t i = 0; i < size; i++) {
-        logits[i] /= temperature;
+/**
+ * Arrange indices into a heap whose root ranks last
+ */
+static void buildHeap(const float *probs, uint32_t *heap, uint32_t count)
+{
+    for (uint32_t i = count / 2; i-- > 0;) {
+        siftDown(probs, heap, count, i);
     }
 }
 
 /**
- * Convert logits to probabilities using softmax
+ * Sort a heap built by buildHeap into rank order, highest probability first
  */
-static void softmax(float *logits, uint32_t size)
+static void sortHeap(const float *probs, uint32_t *heap, uint32_t count)
 {
-    /* Find max for numerical stability */
-    float maxLogit = logits[0];
-    for (uint32_t i = 1; i < size; i++) {
-        if (logits[i] > maxLogit) {
-            maxLogit = logits[i];
+    for (uint32_t n = count; n > 1; n--) {
+        /* Move the lowest-ranked entry to the end */
+        uint32_t temp = heap[0];
+        heap[0]       = heap[n - 1];
+        heap[n - 1]   = temp;
+        siftDown(probs, heap, n - 1, 0);
+    }
+}
+
+/**
+ * Find the indices of the K highest probabilities, highest first
+ *
+ * Keeps a K-entry heap of the best candidates seen so far, so selection costs
+ * O(size log K) rather than a pass over the vocabulary per selected token.
+ */
+static void selectTopK(const float *probs, uint32_t size, uint32_t k, uint32_t *topIndices)
+{
+    if (k == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < k; i++) {
+        topIndices[i] = i;
+    }
+    buildHeap(probs, topIndices, k);
+
+    /* Replace the worst kept candidate whenever a better token appears */
+    for (uint32_t i = k; i < size; i++) {
+        if (ranksBefore(probs, i, topIndices[0])) {
+            topIndices[0] = i;
+            siftDown(probs, topIndices, k, 0);
         }
     }
 
-    /* Compute softmax */
-    float sum = 0.0f;
+    sortHeap(probs, topIndices, k);
+}
+
+/**
+ * Find the top-P (nucleus) tokens, highest probability first
+ *
+ * Tokens below (1 - p) / size together hold less than 1 - p of the mass, so
+ * the nucleus lies within the tokens at or above that threshold; only those
+ * candidates are sorted.
+ *
+ * @return Number of leading indices in the nucleus
+ */
+static uint32_t selectTopP(const float *probs, uint32_t size, float p, uint32_t *indices)
+{
+    /* Prefilter candidates in one pass */
+    float    threshold = (1.0f - p) / (float)size;
+    float    kept      = 0.0f;
+    uint32_t count     = 0;
+
     for (uint32_t i = 0; i < size; i++) {
-        logits[i] = expf(logits[i] - maxLogit);
-        sum += logits[i];
+        if (probs[i] >= threshold) {
+            indices[count++] = i;
+            kept += probs[i];
+        }
     }
 
-    /* Normalize */
-    if (sum > 0.0f) {
+    if (kept < p) {
+        /* Rounding left the candidates short of p, consider every token */
+        count = size;
         for (uint32_t i = 0; i < size; i++) {
-            logits[i] /= sum;
+            indices[i] = i;
+        }
+    }
+
+    /* Sort candidates by probability (descending) */
+    buildHeap(probs, indices, count);
+    sortHeap(probs, indices, count);
+
+    /* Find cutoff index for top-P */
+    float    cumSum    = 0.0f;
+    uint32_t cutoffIdx = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        cumSum += probs[indices[i]];
+        if (cumSum >= p) {
+            cutoffIdx = i + 1;
+            break;
         }
     }
+
+    if (cutoffIdx == 0) {
+        cutoffIdx = count; /* Use all candidates if can't reach p */
+    }
+
+    return cutoffIdx;
 }
 
 /**
  * Perform top-K sampling
  */
-static int sampleTopK(const float *probs, uint32_t size, uint32_t k)
+static int sampleTopK(const float *probs, uint32_t size, uint32_t k, uint32_t *topIndices)
 {
-    if (k >= size) {
-        /* No need for top-K if K is greater than the vocab size */
+    if (k == 0 || k >= size) {
+        /* No need for top-K if K is unset or greater than the vocab size */
         float sum = 0.0f;
         for (uint32_t i = 0; i < size; i++) {
             sum += probs[i];
@@ -115,36 +260,8 @@ static int sampleTopK(const float *probs, uint32_t size, uint32_t k)
         return size - 1;
     }
 
-    /* Create a copy of probabilities */
-    float *probsCopy = (float *)TINYAI_MALLOC(size * sizeof(float));
-    if (!probsCopy) {
-        return 0; /* Error, return first token */
-    }
-
-    memcpy(probsCopy, probs, size * sizeof(float));
-
     /* Find top K indices */
-    uint32_t *topIndices = (uint32_t *)TINYAI_MALLOC(k * sizeof(uint32_t));
-    if (!topIndices) {
-        TINYAI_FREE(probsCopy);
-        return 0;
-    }
-
-    for (uint32_t i = 0; i < k; i++) {
-        /* Find max probability */
-        float    maxProb = -1.0f;
-        uint32_t maxIdx  = 0;
-
-        for (uint32_t j = 0; j < size; j++) {
-            if (probsCopy[j] > maxProb) {
-                maxProb = probsCopy[j];
-                maxIdx  = j;
-            }
-        }
-
-        topIndices[i]     = maxIdx;
-        probsCopy[maxIdx] = -1.0f; /* Mark as used */
-    }
+    selectTopK(probs, size, k, topIndices);
 
     /* Sample from top K */
     float sum = 0.0f;
@@ -165,17 +282,13 @@ static int sampleTopK(const float *probs, uint32_t size, uint32_t k)
         }
     }
 
-    /* Clean up */
-    TINYAI_FREE(probsCopy);
-    TINYAI_FREE(topIndices);
-
     return result;
 }
 
 /**
  * Perform top-P (nucleus) sampling
  */
-static int sampleTopP(const float *probs, uint32_t size, float p)
+static int sampleTopP(const float *probs, uint32_t size, float p, uint32_t *indices)
 {
     if (p >= 1.0f) {
         /* No need for top-P if P is greater than or equal to 1.0 */
@@ -197,70 +310,28 @@ static int sampleTopP(const float *probs, uint32_t size, float p)
         return size - 1;
     }
 
-    /* Create a copy of probabilities with indices */
-    struct ProbIndex {
-        float    prob;
-        uint32_t index;
-    } *probIndices = (struct ProbIndex *)TINYAI_MALLOC(size * sizeof(struct ProbIndex));
-
-    if (!probIndices) {
-        return 0; /* Error, return first token */
-    }
-
-    for (uint32_t i = 0; i < size; i++) {
-        probIndices[i].prob  = probs[i];
-        probIndices[i].index = i;
-    }
-
-    /* Sort by probability (descending) */
-    for (uint32_t i = 0; i < size - 1; i++) {
-        for (uint32_t j = i + 1; j < size; j++) {
-            if (probIndices[j].prob > probIndices[i].prob) {
-                struct ProbIndex temp = probIndices[i];
-                probIndices[i]        = probIndices[j];
-                probIndices[j]        = temp;
-            }
-        }
-    }
-
     /* Find cutoff index for top-P */
-    float    cumSum    = 0.0f;
-    uint32_t cutoffIdx = 0;
-
-    for (uint32_t i = 0; i < size; i++) {
-        cumSum += probIndices[i].prob;
-        if (cumSum >= p) {
-            cutoffIdx = i + 1;
-            break;
-        }
-    }
-
-    if (cutoffIdx == 0) {
-        cutoffIdx = size; /* Use all tokens if can't reach p */
-    }
+    uint32_t cutoffIdx = selectTopP(probs, size, p, indices);
 
     /* Sample from top-P */
     float sum = 0.0f;
     for (uint32_t i = 0; i < cutoffIdx; i++) {
-        sum += probIndices[i].prob;
+        sum += probs[indices[i]];
     }
 
-    float r = randomFloat() * sum;
-    cumSum  = 0.0f;
+    float r      = randomFloat() * sum;
+    float cumSum = 0.0f;
 
-    int result = probIndices[0].index; /* Default to highest probability token */
+    int result = indices[0]; /* Default to highest probability token */
 
     for (uint32_t i = 0; i < cutoffIdx; i++) {
-        cumSum += probIndices[i].prob;
+        cumSum += probs[indices[i]];
         if (r < cumSum) {
-            result = probIndices[i].index;
+            result = indices[i];
             break;
         }
     }
 
-    /* Clean up */
-    TINYAI_FREE(probIndices);
-
     return result;
 }
 
@@ -308,6 +379,13 @@ static int copyLayerWeights(TinyAILayer *layer, const float *weights, const floa
 
 /* ----------------- Model Implementation ----------------- */
 
+static void invalidateModelPlan(TinyAIModel *model);
+static uint64_t getTimeNs(void);
+static bool isSnapshotData(const TinyAIModel *model, const void *data);
+static void detachSnapshotAttention(const TinyAIModel *model, TinyAISelfAttention *attention);
+static void detachSnapshotLayer(const TinyAIModel *model, TinyAILayer *layer);
+static void unmapSnapshot(void *data, size_t size);
+
 /**
  * Create a new text generation model
  */
@@ -327,11 +405,26 @@ TinyAIModel *tinyaiCreateModel(uint32_t type, uint32_t hiddenSize, uint32_t cont
     model->type        = type;
     model->layerCount  = 0;
     model->layers      = NULL;
-    model->tokenizer   = tokenizer;
-    model->hiddenSize  = hiddenSize;
-    model->contextSize = contextSize;
+    model->tokenizer    = tokenizer;
+    model->hiddenSize   = hiddenSize;
+    model->contextSize  = contextSize;
+    model->scratchCache = NULL;
+    model->prefixCache  = NULL;
+    model->plan         = NULL;
+    model->shortlist       = NULL;
+    model->shortlistSize   = 0;
+    model->shortlistLogits = NULL;
+    model->profile         = NULL;
+    model->profileLayers   = 0;
+    model->profilePasses   = 0;
+    model->loader          = NULL;
+    model->snapshot        = NULL;
+    model->snapshotSize    = 0;
+    model->adapter         = NULL;
+    model->exitThresholds  = NULL;
 
     /* Allocate activation buffers */
+    model->activationPrecision = TINYAI_ACTIVATIONS_FP32;
     model->activations[0] = (float *)TINYAI_MALLOC(contextSize * hiddenSize * sizeof(float));
     model->activations[1] = (float *)TINYAI_MALLOC(contextSize * hiddenSize * sizeof(float));
 
@@ -358,19 +451,32 @@ void tinyaiDestroyModel(TinyAIModel *model)
         return;
     }
 
-    /* Free layers */
+    /* Free layers; weights held in a snapshot are unmapped with it */
     if (model->layers) {
         for (uint32_t i = 0; i < model->layerCount; i++) {
-            if (model->layers[i].weights.data) {
-                TINYAI_FREE(model->layers[i].weights.data);
-            }
+            detachSnapshotLayer(model, &model->layers[i]);
+            tinyaiReleaseMatrix4bit(&model->layers[i].weights);
             if (model->layers[i].biases) {
                 TINYAI_FREE(model->layers[i].biases);
             }
+            if (model->layers[i].attention) {
+                tinyaiDestroySelfAttention(model->layers[i].attention);
+                TINYAI_FREE(model->layers[i].attention);
+            }
         }
         TINYAI_FREE(model->layers);
     }
 
+    /* Free the execution plan, the shortlist, the private KV cache and the prefix cache */
+    invalidateModelPlan(model);
+    tinyaiSetOutputShortlist(model, NULL, 0);
+    tinyaiEnableModelProfiling(model, false);
+    if (model->exitThresholds) {
+        TINYAI_FREE(model->exitThresholds);
+    }
+    tinyaiDestroyKVCache(model->scratchCache);
+    tinyaiDestroyPrefixCache(model->prefixCache);
+
     /* Free activation buffers */
     if (model->activations[0]) {
         TINYAI_FREE(model->activations[0]);
@@ -379,7 +485,12 @@ void tinyaiDestroyModel(TinyAIModel *model)
         TINYAI_FREE(model->activations[1]);
     }
 
-    /* Note: We don't free the tokenizer as it might be used elsewhere */
+    /* Note: We don't free the tokenizer as it might be used elsewhere, unless it was loaded
+       from the model's snapshot along with the weights */
+    if (model->snapshot) {
+        tinyaiDestroyTokenizer(model->tokenizer);
+        unmapSnapshot(model->snapshot, model->snapshotSize);
+    }
 
     /* Free the model */
     TINYAI_FREE(model);
@@ -410,20 +521,65 @@ int tinyaiAddLayer(TinyAIModel *model, TinyAILayerType type, uint32_t inputSize,
 
     model->layers = newLayers;
 
+    /* The plan points into the old layers array */
+    invalidateModelPlan(model);
+
+    /* A new layer changes what the early exits skip and where their head starts */
+    if (model->exitThresholds) {
+        TINYAI_FREE(model->exitThresholds);
+        model->exitThresholds = NULL;
+    }
+
+    /* Profiling keeps one entry per layer */
+    if (model->profile) {
+        TinyAILayerProfile *profile = (TinyAILayerProfile *)TINYAI_MALLOC(
+            (model->layerCount + 1) * sizeof(TinyAILayerProfile));
+        if (!profile) {
+            return -1;
+        }
+        memcpy(profile, model->profile, model->layerCount * sizeof(TinyAILayerProfile));
+        memset(&profile[model->layerCount], 0, sizeof(TinyAILayerProfile));
+        profile[model->layerCount].type = type;
+        TINYAI_FREE(model->profile);
+        model->profile       = profile;
+        model->profileLayers = model->layerCount + 1;
+    }
+
     /* Initialize the new layer */
-    TinyAILayer *layer  = &model->layers[model->layerCount];
-    layer->type         = type;
-    layer->activation   = activation;
-    layer->inputSize    = inputSize;
-    layer->outputSize   = outputSize;
-    layer->weights.data = NULL;
-    layer->biases       = NULL;
+    TinyAILayer *layer = &model->layers[model->layerCount];
+    layer->type        = type;
+    layer->activation  = activation;
+    layer->inputSize   = inputSize;
+    layer->outputSize  = outputSize;
+    layer->biases      = NULL;
+    layer->attention   = NULL;
+    memset(&layer->weights, 0, sizeof(TinyAIMatrix4bit));
 
     model->layerCount++;
 
     return 0;
 }
 
+/**
+ * Read exactly size bytes of a file
+ */
+static bool readBytes(TinyAIFile *file, void *buffer, size_t size)
+{
+    return tinyaiReadFile(file, buffer, size) == (int64_t)size;
+}
+
+/**
+ * Read exactly the bytes of several buffers, in file order
+ */
+static bool readVector(TinyAIFile *file, const TinyAIIOVector *vectors, int count)
+{
+    int64_t size = 0;
+    for (int i = 0; i < count; i++) {
+        size += (int64_t)vectors[i].size;
+    }
+    return tinyaiReadFileVector(file, vectors, count) == size;
+}
+
 /**
  * Load model weights from a file
  */
@@ -433,21 +589,21 @@ int tinyaiLoadModelWeights(TinyAIModel *model, const char *path)
         return -1;
     }
 
-    FILE *file = fopen(path, "rb");
+    TinyAIFile *file = tinyaiOpenFile(path, TINYAI_FILE_READ | TINYAI_FILE_BINARY);
     if (!file) {
         return -1;
     }
 
     /* Read header */
     uint32_t magic, version, layerCount;
-    if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != 0x4D494E54) { /* "TINY" */
-        fclose(file);
+    if (!readBytes(file, &magic, sizeof(magic)) || magic != 0x4D494E54) { /* "TINY" */
+        tinyaiCloseFile(file);
         return -1;
     }
 
-    if (fread(&version, sizeof(version), 1, file) != 1 ||
-        fread(&layerCount, sizeof(layerCount), 1, file) != 1 || layerCount != model->layerCount) {
-        fclose(file);
+    if (!readBytes(file, &version, sizeof(version)) || version > TINYAI_WEIGHTS_VERSION ||
+        !readBytes(file, &layerCount, sizeof(layerCount)) || layerCount != model->layerCount) {
+        tinyaiCloseFile(file);
         return -1;
     }
 
@@ -457,54 +613,142 @@ int tinyaiLoadModelWeights(TinyAIModel *model, const char *path)
 
         /* Read layer type and sizes */
         uint32_t layerType, inputSize, outputSize;
-        if (fread(&layerType, sizeof(layerType), 1, file) != 1 ||
-            fread(&inputSize, sizeof(inputSize), 1, file) != 1 ||
-            fread(&outputSize, sizeof(outputSize), 1, file) != 1) {
-            fclose(file);
+        if (!readBytes(file, &layerType, sizeof(layerType)) ||
+            !readBytes(file, &inputSize, sizeof(inputSize)) ||
+            !readBytes(file, &outputSize, sizeof(outputSize))) {
+            tinyaiCloseFile(file);
             return -1;
         }
 
         /* Verify layer details */
         if (layerType != layer->type || inputSize != layer->inputSize ||
             outputSize != layer->outputSize) {
-            fclose(file);
+            tinyaiCloseFile(file);
+            return -1;
+        }
+
+        /* Recurrent layers multiply the input and the previous hidden state together */
+        uint32_t weightRows = layer->inputSize;
+        if (layer->type == TINYAI_LAYER_RNN) {
+            weightRows += layer->outputSize;
+        }
+
+        /* Allocate weight matrix, unless the model streams it from a loader */
+        size_t dataSize = (weightRows * layer->outputSize + 1) / 2; /* 4-bit, 2 values per byte */
+        if (model->loader) {
+            if (i >= model->loader->num_layers ||
+                model->loader->layers[i].memory_usage != dataSize) {
+                tinyaiCloseFile(file);
+                return -1;
+            }
+        }
+        else {
+            layer->weights.data = (uint8_t *)TINYAI_MALLOC(dataSize);
+            if (!layer->weights.data) {
+                tinyaiCloseFile(file);
+                return -1;
+            }
+        }
+
+        layer->weights.rows   = weightRows;
+        layer->weights.cols   = layer->outputSize;
+        layer->weights.layout = TINYAI_MATRIX4BIT_ROW_MAJOR;
+
+        /* Read the scale and zero point */
+        TinyAIIOVector quantization[2] = {
+            {&layer->weights.scale, sizeof(layer->weights.scale)},
+            {&layer->weights.zeroPoint, sizeof(layer->weights.zeroPoint)}};
+        if (!readVector(file, quantization, 2)) {
+            tinyaiCloseFile(file);
             return -1;
         }
 
-        /* Allocate weight matrix */
-        size_t dataSize =
-            (layer->inputSize * layer->outputSize + 1) / 2; /* 4-bit, 2 values per byte */
-        layer->weights.data = (uint8_t *)TINYAI_MALLOC(dataSize);
-        if (!layer->weights.data) {
-            fclose(file);
+        /* Version 2 adds a group size, then per-group scales and zero points if it is set */
+        uint32_t groupSize = 0;
+        if (version >= 2 && (!readBytes(file, &groupSize, sizeof(groupSize)) ||
+                             groupSize > layer->outputSize)) {
+            tinyaiCloseFile(file);
             return -1;
         }
 
+        if (groupSize > 0) {
+            layer->weights.groupSize  = groupSize;
+            size_t groups             = tinyaiMatrix4bitGroupCount(&layer->weights);
+            layer->weights.scales     = (float *)TINYAI_MALLOC(groups * sizeof(float));
+            layer->weights.zeroPoints = (float *)TINYAI_MALLOC(groups * sizeof(float));
+            TinyAIIOVector tables[2]  = {{layer->weights.scales, groups * sizeof(float)},
+                                         {layer->weights.zeroPoints, groups * sizeof(float)}};
+            if (!layer->weights.scales || !layer->weights.zeroPoints ||
+                !readVector(file, tables, 2)) {
+                tinyaiCloseFile(file);
+                return -1;
+            }
+        }
+
         /* Read weights */
-        if (fread(&layer->weights.scale, sizeof(layer->weights.scale), 1, file) != 1 ||
-            fread(&layer->weights.zeroPoint, sizeof(layer->weights.zeroPoint), 1, file) != 1 ||
-            fread(layer->weights.data, 1, dataSize, file) != dataSize) {
-            fclose(file);
+        if (model->loader ? tinyaiSeekFile(file, (int64_t)dataSize, 1) < 0
+                          : !readBytes(file, layer->weights.data, dataSize)) {
+            tinyaiCloseFile(file);
             return -1;
         }
 
-        layer->weights.rows = layer->inputSize;
-        layer->weights.cols = layer->outputSize;
-
         /* Allocate and read biases */
         layer->biases = (float *)TINYAI_MALLOC(layer->outputSize * sizeof(float));
         if (!layer->biases) {
-            fclose(file);
+            tinyaiCloseFile(file);
             return -1;
         }
 
-        if (fread(layer->biases, sizeof(float), layer->outputSize, file) != layer->outputSize) {
-            fclose(file);
+        if (!readBytes(file, layer->biases, layer->outputSize * sizeof(float))) {
+            tinyaiCloseFile(file);
+            return -1;
+        }
+    }
+
+    tinyaiCloseFile(file);
+
+    /* Cached prefixes were computed with the old weights */
+    tinyaiPrefixCacheClear(model->prefixCache);
+
+    /* Optionally repack the weights for the SIMD kernels once, here */
+    if (tinyaiConfigGetBool("model.prepack_weights", 0) && tinyaiPrepackModelWeights(model) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Repack a model's 4-bit weights into the panel layout
+ */
+int tinyaiPrepackModelWeights(TinyAIModel *model)
+{
+    if (!model) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        TinyAILayer *layer = &model->layers[i];
+
+        /* Embeddings are only gathered by row, which the row-major layout serves best */
+        if (layer->type != TINYAI_LAYER_EMBEDDING && layer->weights.data &&
+            !layer->weights.scales && tinyaiMatrix4bitPrepack(&layer->weights) != 0) {
             return -1;
         }
+
+        if (layer->attention) {
+            TinyAIMatrix4bit *weights[4] = {
+                &layer->attention->queryWeight, &layer->attention->keyWeight,
+                &layer->attention->valueWeight, &layer->attention->outputWeight};
+            for (int w = 0; w < 4; w++) {
+                if (weights[w]->data && !weights[w]->scales &&
+                    tinyaiMatrix4bitPrepack(weights[w]) != 0) {
+                    return -1;
+                }
+            }
+        }
     }
 
-    fclose(file);
     return 0;
 }
 
@@ -515,33 +759,33 @@ TinyAIModel *tinyaiLoadModel(const char *modelPath, const char *weightsPath,
                              const char *tokenizerPath)
 {
     /* Load model structure */
-    FILE *file = fopen(modelPath, "rb");
+    TinyAIFile *file = tinyaiOpenFile(modelPath, TINYAI_FILE_READ | TINYAI_FILE_BINARY);
     if (!file) {
         return NULL;
     }
 
     /* Read header */
     uint32_t magic, version, type, hiddenSize, contextSize, layerCount;
-    if (fread(&magic, sizeof(magic), 1, file) != 1 || magic != 0x4D494E54 || /* "TINY" */
-        fread(&version, sizeof(version), 1, file) != 1 ||
-        fread(&type, sizeof(type), 1, file) != 1 ||
-        fread(&hiddenSize, sizeof(hiddenSize), 1, file) != 1 ||
-        fread(&contextSize, sizeof(contextSize), 1, file) != 1 ||
-        fread(&layerCount, sizeof(layerCount), 1, file) != 1) {
-        fclose(file);
+    if (!readBytes(file, &magic, sizeof(magic)) || magic != 0x4D494E54 || /* "TINY" */
+        !readBytes(file, &version, sizeof(version)) ||
+        !readBytes(file, &type, sizeof(type)) ||
+        !readBytes(file, &hiddenSize, sizeof(hiddenSize)) ||
+        !readBytes(file, &contextSize, sizeof(contextSize)) ||
+        !readBytes(file, &layerCount, sizeof(layerCount))) {
+        tinyaiCloseFile(file);
         return NULL;
     }
 
     /* Load tokenizer */
     TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
     if (!tokenizer) {
-        fclose(file);
+        tinyaiCloseFile(file);
         return NULL;
     }
 
     if (tinyaiLoadVocabulary(tokenizer, tokenizerPath) != 0) {
         tinyaiDestroyTokenizer(tokenizer);
-        fclose(file);
+        tinyaiCloseFile(file);
         return NULL;
     }
 
@@ -549,19 +793,19 @@ TinyAIModel *tinyaiLoadModel(const char *modelPath, const char *weightsPath,
     TinyAIModel *model = tinyaiCreateModel(type, hiddenSize, contextSize, tokenizer);
     if (!model) {
         tinyaiDestroyTokenizer(tokenizer);
-        fclose(file);
+        tinyaiCloseFile(file);
         return NULL;
     }
 
     /* Read layer definitions */
     for (uint32_t i = 0; i < layerCount; i++) {
         uint32_t layerType, inputSize, outputSize, activation;
-        if (fread(&layerType, sizeof(layerType), 1, file) != 1 ||
-            fread(&inputSize, sizeof(inputSize), 1, file) != 1 ||
-            fread(&outputSize, sizeof(outputSize), 1, file) != 1 ||
-            fread(&activation, sizeof(activation), 1, file) != 1) {
+        if (!readBytes(file, &layerType, sizeof(layerType)) ||
+            !readBytes(file, &inputSize, sizeof(inputSize)) ||
+            !readBytes(file, &outputSize, sizeof(outputSize)) ||
+            !readBytes(file, &activation, sizeof(activation))) {
             tinyaiDestroyModel(model);
-            fclose(file);
+            tinyaiCloseFile(file);
             return NULL;
         }
 
@@ -569,10 +813,10 @@ TinyAIModel *tinyaiLoadModel(const char *modelPath, const char *weightsPath,
                        (TinyAIActivation)activation);
     }
 
-    fclose(file);
+    tinyaiCloseFile(file);
 
-    /* Load weights */
-    if (tinyaiLoadModelWeights(model, weightsPath) != 0) {
+    /* Load weights and compile the execution plan */
+    if (tinyaiLoadModelWeights(model, weightsPath) != 0 || tinyaiPrepareModel(model) != 0) {
         tinyaiDestroyModel(model);
         return NULL;
     }
@@ -580,601 +824,5598 @@ TinyAIModel *tinyaiLoadModel(const char *modelPath, const char *weightsPath,
     return model;
 }
 
-/* Include SIMD operations and cache optimizations */
-#include "../../utils/cache_opt.h"
-#include "../../utils/simd_ops.h"
+/* ----------------- Execution Plan ----------------- */
+
+/* Updates per layer of an adapter (the four projections of an attention layer) */
+#define ADAPTER_SLOTS 4
 
 /**
- * Cache-optimized matrix-vector multiplication using SIMD if available
+ * Low-rank updates of a model's projections
  */
-static void matrixVectorMultiplySIMD(const float *matrix, const float *vector, float *output,
-                                     int rows, int cols, bool useSIMD)
-{
-    if (useSIMD) {
-        /* Use SIMD implementation from simd_ops.h */
-        tinyai_simd_matmul_f32(matrix, vector, output, rows, cols, 1);
-    }
-    else {
-        /* Get cache optimization parameters */
-        TinyAICacheOptConfig config = tinyai_cache_opt_init_default();
-        tinyai_cache_opt_matrix_multiply(rows, 1, cols, &config);
-
-        /* Use cache-friendly blocking */
-        TINYAI_LOOP_TILING_2D(i, 0, rows, k, 0, cols, config.blockSizeX, config.blockSizeY, {
-            /* Inside the innermost loops, accumulate partial sums */
-            output[i] += matrix[i * cols + k] * vector[k];
-        });
-    }
-}
+struct TinyAIAdapter {
+    uint32_t            layerCount; /* Layers of the model the adapter was created for */
+    uint32_t            rank;       /* Rank of every update */
+    float               scale;      /* alpha / rank */
+    TinyAILowRankDelta *deltas;     /* ADAPTER_SLOTS per layer (rank 0: no update) */
+    uint32_t           *sizes;      /* Input and output size of each slot (0: not adaptable) */
+};
 
 /**
- * Perform a single forward pass through the model
+ * Update an adapter makes to one projection of a layer (NULL for none)
  */
-int tinyaiModelForward(TinyAIModel *model, const int *input, int inputLength, float *output)
+static const TinyAILowRankDelta *adapterDelta(const TinyAIAdapter *adapter, uint32_t layerIndex,
+                                              uint32_t projection)
 {
-    if (!model || !input || !output || inputLength <= 0) {
-        return -1;
-    }
-
-    /* Context limitation */
-    if (inputLength > model->contextSize) {
-        inputLength = model->contextSize;
+    if (!adapter || layerIndex >= adapter->layerCount) {
+        return NULL;
     }
 
-    /* Check if SIMD is available */
-    bool useSIMD =
-        tinyai_simd_detect_capabilities() > 0; /* Non-zero means some SIMD is available */
-
-    /* Process based on model type */
-    switch (model->type) {
-    case TINYAI_MODEL_TYPE_RNN:
-        /* Simple RNN implementation */
-        {
-            /* Embedding layer */
-            float *embeddings = model->activations[model->activeBuffer];
-            memset(embeddings, 0, model->hiddenSize * sizeof(float));
+    const TinyAILowRankDelta *delta = &adapter->deltas[layerIndex * ADAPTER_SLOTS + projection];
+    return delta->rank > 0 ? delta : NULL;
+}
 
-            /* Process only the last token for output */
-            int lastToken = input[inputLength - 1];
+/**
+ * Inputs of one walk through an execution plan
+ */
+typedef struct {
+    const int      *tokens;     /* Token of each row */
+    const float    *embeddings; /* Rows fed past the embedding step instead (or NULL) */
+    uint32_t        rows;       /* Rows entering the plan */
+    TinyAIKVCache  *cache;     /* Cache of the single sequence the rows extend */
+    TinyAIKVCache **rowCaches; /* Cache per row for batched decoding (or NULL) */
+    bool            allRows;   /* Keep every row through the output layer */
+    float          *logits;    /* Output logits ([rows x vocab] with allRows) */
+    const uint32_t *shortlist; /* Only logits computed by the final layer (or NULL) */
+    uint32_t        shortlistSize;
+    float          *shortlistLogits; /* Compact logits of the shortlist */
+    float          *pooled;    /* Pooled input rows of the final step, run instead of it */
+    int             pooling;   /* TINYAI_POOLING_* of pooled */
+    float          *exitConfidence; /* Head confidence at each early exit, recorded without
+                                       stopping (or NULL) */
+    int            *exitTokens;     /* Head's most likely token at each early exit */
+} TinyAIPlanRun;
+
+typedef struct TinyAIPlanStep TinyAIPlanStep;
+
+/* Kernel running one step over *rows rows; steps that drop rows update it */
+typedef int (*TinyAIPlanKernel)(const TinyAIPlanStep *step, const TinyAIPlanRun *run,
+                                uint32_t *rows);
 
-            /* Check token range */
-            if (lastToken < 0 || lastToken >= model->tokenizer->tokenCount) {
-                lastToken = TINYAI_TOKEN_UNKNOWN;
-            }
+/**
+ * One layer of an execution plan, with its kernel and buffers resolved
+ */
+struct TinyAIPlanStep {
+    TinyAIPlanKernel          kernel;         /* Kernel for the layer type */
+    int                       activation;     /* TINYAI_SIMD_ACTIVATION_* (NONE for linear) */
+    const TinyAILayer        *layer;          /* Layer weights and sizes */
+    uint32_t                  attentionIndex; /* KV cache slot (attention layers) */
+    uint32_t                  stateOffset;    /* Offset of the hidden state (recurrent layers) */
+    float                    *scratch;        /* [input; hidden] row (recurrent layers) */
+    float                    *input;          /* Activation buffer read by the step */
+    float                    *output;         /* Activation buffer written (NULL: logits) */
+    int                       weightFormat;   /* TINYAI_WEIGHT_FORMAT_* of dense and output steps */
+    bool                      serial;         /* Kernels run without the thread pool */
+    TinyAICSRMatrix4Bit      *csr;            /* [outputSize x inputSize] weights (CSR_4BIT) */
+    TinyAIBSRMatrix          *bsr;            /* [outputSize x inputSize] weights (BSR) */
+    float                    *sparseScratch;  /* Transposed rows of batched BSR products */
+    const void               *numaReplica;    /* Weights replicated across NUMA nodes by the plan */
+    const TinyAILowRankDelta *delta;          /* Update of the active adapter (or NULL) */
+    const uint16_t           *halfInput;      /* Half-precision rows staged into input */
+    uint16_t                 *halfOutput;     /* Half-precision rows output is stored to */
+    uint32_t                  stageRows;      /* Rows staged at a time (0: FP32 activations) */
+    bool                      bf16;           /* Half-precision rows are bfloat16 */
+};
 
-            /* Apply the model layers */
-            for (uint32_t i = 0; i < model->layerCount; i++) {
-                TinyAILayer *layer = &model->layers[i];
+/**
+ * Weight format and threads a step may run on
+ */
+typedef struct {
+    int      weightFormat; /* TINYAI_WEIGHT_FORMAT_* */
+    bool     serial;       /* Without the thread pool */
+    uint64_t timeNs;       /* Time over the autotuned passes */
+} TinyAIStepCandidate;
 
-                /* Flip activation buffers */
-                model->activeBuffer = 1 - model->activeBuffer;
-                float *input        = model->activations[1 - model->activeBuffer];
-                float *output       = model->activations[model->activeBuffer];
+/**
+ * Alternatives of one step timed while autotuning
+ */
+typedef struct {
+    TinyAIStepCandidate  candidates[AUTOTUNE_MAX_CANDIDATES];
+    uint32_t             numCandidates; /* 0 for steps that are not tuned */
+    TinyAICSRMatrix4Bit *csr;           /* CSR weights the step does not hold itself */
+    TinyAIBSRMatrix     *bsr;           /* BSR weights the step does not hold itself */
+} TinyAIStepTuning;
 
-                /* Apply layer based on type */
-                switch (layer->type) {
-                case TINYAI_LAYER_EMBEDDING:
-                    /* Copy embedding vector for the token */
-                    {
-                        TinyAIMatrixFP32 *matrix = tinyaiDequantize4bitToFP32(&layer->weights);
+/**
+ * Execution plan compiled from a model's layers
+ */
+struct TinyAIModelPlan {
+    TinyAIPlanStep   *steps;         /* One step per layer */
+    uint32_t          numSteps;      /* Number of steps */
+    uint32_t          vocabSize;     /* Vocabulary size the plan was built for */
+    uint32_t          maxRows;       /* Rows the activation buffers hold */
+    float            *buffers[2];    /* Ping-pong activation buffers (16-bit values under
+                                        half-precision activations) */
+    bool              ownsBuffers;   /* Buffers allocated by the plan, not the model */
+    float            *stage;         /* Float input and output rows of half-precision steps */
+    float            *scratch;       /* Input and hidden state row of recurrent steps */
+    uint32_t          stateSize;     /* Floats of recurrent state per sequence */
+    bool              directLogits;  /* Final step writes logits directly */
+    bool              usesAttention; /* Some step attends over a KV cache */
+    float            *sparseScratch; /* Input and output rows of batched BSR products */
+    size_t            scratchBytes;  /* Bytes of buffers and scratch the plan allocated */
+    TinyAIStepTuning *tuning;        /* Candidates of each step while autotuning (or NULL) */
+    uint32_t          tunePasses;    /* Forward passes left before the steps are locked in */
+    uint32_t          headStep;      /* First step of the early-exit head (trailing layer norms
+                                        and the output step) */
+    float            *exitHidden;    /* Hidden row an early exit hands to the head and the
+                                        skipped steps (NULL without direct logits) */
+};
 
-                        if (!matrix) {
-                            return -1;
-                        }
+/**
+ * Resolve an activation to its TINYAI_SIMD_ACTIVATION_* kernel (NONE for linear or unknown)
+ */
+static int resolveActivation(TinyAIActivation activation)
+{
+    switch (activation) {
+    case TINYAI_ACTIVATION_RELU:
+        return TINYAI_SIMD_ACTIVATION_RELU;
+    case TINYAI_ACTIVATION_SIGMOID:
+        return TINYAI_SIMD_ACTIVATION_SIGMOID;
+    case TINYAI_ACTIVATION_TANH:
+        return TINYAI_SIMD_ACTIVATION_TANH;
+    case TINYAI_ACTIVATION_GELU:
+        return TINYAI_SIMD_ACTIVATION_GELU;
+    case TINYAI_ACTIVATION_SILU:
+        return TINYAI_SIMD_ACTIVATION_SILU;
+    default:
+        /* No activation (linear) */
+        return TINYAI_SIMD_ACTIVATION_NONE;
+    }
+}
 
-                        /* Copy embedding for the token */
-                        memcpy(output, matrix->data + lastToken * layer->outputSize,
-                               layer->outputSize * sizeof(float));
+/**
+ * Embedding step: gather the rows' token embeddings
+ */
+static int embeddingStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    const TinyAILayer *layer = step->layer;
 
-                        tinyaiDestroyMatrixFP32(matrix);
-                    }
-                    break;
+    /* Rows given as embeddings skip the lookup */
+    if (run->embeddings) {
+        memcpy(step->output, run->embeddings, (size_t)*rows * layer->outputSize * sizeof(float));
+        return 0;
+    }
 
-                case TINYAI_LAYER_DENSE:
-                    /* Dense layer implementation */
-                    {
-                        TinyAIMatrixFP32 *matrix = tinyaiDequantize4bitToFP32(&layer->weights);
-
-                        if (!matrix) {
-                            return -1;
-                        }
-
-                        /* Matrix multiplication */
-                        for (uint32_t j = 0; j < layer->outputSize; j++) {
-                            float sum = 0.0f;
-                            for (uint32_t k = 0; k < layer->inputSize; k++) {
-                                sum += input[k] * matrix->data[k * layer->outputSize + j];
-                            }
-
-                            /* Add bias */
-                            if (layer->biases) {
-                                sum += layer->biases[j];
-                            }
-
-                            /* Store result */
-                            output[j] = sum;
-                        }
-
-                        tinyaiDestroyMatrixFP32(matrix);
-
-                        /* Apply activation function */
-                        switch (layer->activation) {
-                        case TINYAI_ACTIVATION_RELU:
-                            for (uint32_t j = 0; j < layer->outputSize; j++) {
-                                if (output[j] < 0.0f) {
-                                    output[j] = 0.0f;
-                                }
-                            }
-                            break;
-
-                        case TINYAI_ACTIVATION_SIGMOID:
-                            for (uint32_t j = 0; j < layer->outputSize; j++) {
-                                output[j] = 1.0f / (1.0f + expf(-output[j]));
-                            }
-                            break;
-
-                        case TINYAI_ACTIVATION_TANH:
-                            for (uint32_t j = 0; j < layer->outputSize; j++) {
-                                output[j] = tanhf(output[j]);
-                            }
-                            break;
-
-                        case TINYAI_ACTIVATION_GELU:
-                            for (uint32_t j = 0; j < layer->outputSize; j++) {
-                                float x   = output[j];
-                                output[j] = 0.5f * x *
-                                            (1.0f + tanhf(sqrtf(2.0f / 3.14159f) *
-                                                          (x + 0.044715f * x * x * x)));
-                            }
-                            break;
-
-                        default:
-                            /* No activation (linear) */
-                            break;
-                        }
-                    }
-                    break;
+    /* Gather all rows in one call; on an out-of-range id, embed token by token */
+    if (tinyaiMatrix4bitGatherRows(&layer->weights, run->tokens, *rows, step->output) == 0) {
+        return 0;
+    }
 
-                case TINYAI_LAYER_OUTPUT:
-                    /* Output layer */
-                    {
-                        TinyAIMatrixFP32 *matrix = tinyaiDequantize4bitToFP32(&layer->weights);
+    for (uint32_t j = 0; j < *rows; j++) {
+        int token = run->tokens[j];
+        if (token < 0 || token >= (int)layer->inputSize) {
+            token = TINYAI_TOKEN_UNKNOWN;
+        }
 
-                        if (!matrix) {
-                            return -1;
-                        }
+        if (tinyaiMatrix4bitGatherRows(&layer->weights, &token, 1,
+                                       step->output + j * layer->outputSize) != 0) {
+            return -1;
+        }
+    }
 
-                        /* Matrix multiplication */
-                        for (uint32_t j = 0; j < layer->outputSize; j++) {
-                            float sum = 0.0f;
-                            for (uint32_t k = 0; k < layer->inputSize; k++) {
-                                sum += input[k] * matrix->data[k * layer->outputSize + j];
-                            }
+    return 0;
+}
 
-                            /* Add bias */
-                            if (layer->biases) {
-                                sum += layer->biases[j];
-                            }
+/**
+ * Multiply rows by a step's weights in the format chosen for it, then add the
+ * bias and apply the activation
+ *
+ * Packed weights fuse the bias and activation into their GEMM. A BSR matrix
+ * multiplies a batch of rows at once on its transpose, and CSR rows multiply
+ * one input row at a time.
+ */
+static int stepMatMul(const TinyAIPlanStep *step, const float *input, uint32_t count,
+                      int activation, float *output)
+{
+    const TinyAILayer *layer      = step->layer;
+    uint32_t           inputSize  = layer->inputSize;
+    uint32_t           outputSize = layer->outputSize;
 
-                            /* Store result directly to output */
-                            output[j] = sum;
-                        }
+    if (step->weightFormat == TINYAI_WEIGHT_FORMAT_DENSE) {
+        return tinyaiMatrix4bitMatMulActivate(&layer->weights, input, count, layer->biases,
+                                              activation, output);
+    }
 
-                        tinyaiDestroyMatrixFP32(matrix);
-                    }
-                    break;
+    if (step->bsr && count > 1) {
+        float *xT = step->sparseScratch;
+        float *yT = xT + (size_t)count * inputSize;
 
-                default:
-                    /* Unsupported layer type */
-                    return -1;
-                }
+        for (uint32_t j = 0; j < count; j++) {
+            for (uint32_t k = 0; k < inputSize; k++) {
+                xT[(size_t)k * count + j] = input[(size_t)j * inputSize + k];
             }
-
-            /* Copy final activations to output */
-            memcpy(output, model->activations[model->activeBuffer],
-                   model->tokenizer->tokenCount * sizeof(float));
         }
-        break;
+        if (!tinyaiBSRMatrixDenseMatMul(step->bsr, xT, (int32_t)count, yT)) {
+            return -1;
+        }
+        for (uint32_t k = 0; k < outputSize; k++) {
+            for (uint32_t j = 0; j < count; j++) {
+                output[(size_t)j * outputSize + k] = yT[(size_t)k * count + j];
+            }
+        }
+    }
+    else {
+        for (uint32_t j = 0; j < count; j++) {
+            const float *x  = input + (size_t)j * inputSize;
+            float       *y  = output + (size_t)j * outputSize;
+            bool         ok = step->bsr ? tinyaiBSRMatrixVectorMul(step->bsr, x, y)
+                                        : tinyaiCSRMatrix4BitVectorMulParallel(step->csr, x, y);
+            if (!ok) {
+                return -1;
+            }
+        }
+    }
 
-    case TINYAI_MODEL_TYPE_TRANSFORMER:
-        /* Transformer implementation */
-        /* In a real implementation, we would need much more code for transformers */
-        /* This is a very simplified version for demonstration purposes */
+    /* Bias and activation in one pass over the rows */
+    TinyAIElementwiseOp ops[2];
+    int                 numOps = 0;
+    if (layer->biases) {
+        ops[numOps++] =
+            (TinyAIElementwiseOp){TINYAI_SIMD_EW_BIAS, 0, layer->biases, NULL, 0.0f, 0.0f};
+    }
+    if (activation != TINYAI_SIMD_ACTIVATION_NONE) {
+        ops[numOps++] =
+            (TinyAIElementwiseOp){TINYAI_SIMD_EW_ACTIVATION, activation, NULL, NULL, 0.0f, 0.0f};
+    }
+    return tinyaiSimdElementwise(output, output, (int)count, (int)outputSize, ops, numOps);
+}
+
+/**
+ * Dense step: one GEMM over every row, with the bias and activation fused
+ * into its epilogue
+ */
+static int denseStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    const TinyAILayer        *layer = step->layer;
+    const TinyAILowRankDelta *delta = step->delta;
+    (void)run;
+
+    if (!delta) {
+        return stepMatMul(step, step->input, *rows, step->activation, step->output);
+    }
+
+    /* The adapter's update goes in before the activation */
+    if (stepMatMul(step, step->input, *rows, TINYAI_SIMD_ACTIVATION_NONE, step->output) != 0) {
+        return -1;
+    }
+    tinyaiSimdLowRankAdd(step->output, step->input, (int)*rows, (int)layer->inputSize,
+                         (int)layer->outputSize, delta->down, delta->up, (int)delta->rank,
+                         delta->scale);
+    if (step->activation == TINYAI_SIMD_ACTIVATION_NONE) {
+        return 0;
+    }
+
+    TinyAIElementwiseOp op = {TINYAI_SIMD_EW_ACTIVATION, step->activation, NULL, NULL, 0.0f, 0.0f};
+    return tinyaiSimdElementwise(step->output, step->output, (int)*rows, (int)layer->outputSize,
+                                 &op, 1);
+}
+
+/**
+ * Attention step: attend the rows over the cached prefix plus themselves
+ *
+ * Rows of a batched decode each extend their own sequence's cache.
+ */
+static int attentionStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    const TinyAILayer *layer = step->layer;
+
+    if (run->rowCaches) {
+        for (uint32_t b = 0; b < *rows; b++) {
+            if (tinyaiSelfAttentionForwardCached(layer->attention, run->rowCaches[b],
+                                                 step->attentionIndex,
+                                                 step->input + b * layer->inputSize, 1,
+                                                 step->output + b * layer->outputSize) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    if (!run->cache) {
+        return -1;
+    }
+    return tinyaiSelfAttentionForwardCached(layer->attention, run->cache, step->attentionIndex,
+                                            step->input, *rows, step->output);
+}
+
+/**
+ * Recurrent step: h = act(W [x; h_prev] + b), one row after another
+ *
+ * The hidden state lives in the row's cache and carries over to the next
+ * row and the next call.
+ */
+static int recurrentStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    const TinyAILayer *layer      = step->layer;
+    uint32_t           inputSize  = layer->inputSize;
+    uint32_t           hiddenSize = layer->outputSize;
+
+    if (layer->weights.rows != inputSize + hiddenSize) {
+        return -1;
+    }
+
+    for (uint32_t j = 0; j < *rows; j++) {
+        TinyAIKVCache *cache = run->rowCaches ? run->rowCaches[j] : run->cache;
+        if (!cache || cache->stateSize < step->stateOffset + hiddenSize) {
+            return -1;
+        }
+
+        float *hidden = cache->state + step->stateOffset;
+        float *output = step->output + j * hiddenSize;
+
+        memcpy(step->scratch, step->input + j * inputSize, inputSize * sizeof(float));
+        memcpy(step->scratch + inputSize, hidden, hiddenSize * sizeof(float));
+        if (tinyaiMatrix4bitMatMulActivate(&layer->weights, step->scratch, 1, layer->biases,
+                                           step->activation, output) != 0) {
+            return -1;
+        }
+
+        memcpy(hidden, output, hiddenSize * sizeof(float));
+    }
+
+    return 0;
+}
+
+/**
+ * Pass-through step for attention layers without attached weights
+ */
+static int identityStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    (void)run;
+    memcpy(step->output, step->input, *rows * step->layer->outputSize * sizeof(float));
+    return 0;
+}
+
+/**
+ * Layer normalization step, applied to each row separately
+ */
+static int layerNormStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    const TinyAILayer *layer = step->layer;
+    (void)run;
+
+    /* Biases hold the scale followed by the shift */
+    const float *gamma = layer->biases;
+    const float *beta  = layer->biases ? layer->biases + layer->inputSize : NULL;
+
+    for (uint32_t j = 0; j < *rows; j++) {
+        tinyaiSimdLayerNorm(step->output + j * layer->inputSize,
+                            step->input + j * layer->inputSize, NULL, gamma, beta,
+                            (int)layer->inputSize, 1e-5f, -1);
+    }
+    return 0;
+}
+
+/**
+ * Add an adapter's update to the shortlisted logits of one row
+ */
+static void addShortlistDelta(const TinyAILowRankDelta *delta, const float *input,
+                              const TinyAILayer *layer, const TinyAIPlanRun *run)
+{
+    for (uint32_t r = 0; r < delta->rank; r++) {
+        const float *down = delta->down + (size_t)r * layer->inputSize;
+        const float *up   = delta->up + (size_t)r * layer->outputSize;
+        float        t    = delta->scale * tinyaiSimdDot(input, down, (int)layer->inputSize);
+        for (uint32_t k = 0; k < run->shortlistSize; k++) {
+            run->shortlistLogits[k] += t * up[run->shortlist[k]];
+        }
+    }
+}
+
+/**
+ * Output step: project every row, or only the last one, to vocabulary logits
+ */
+static int outputStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    const TinyAILayer *layer  = step->layer;
+    const float       *input  = step->input;
+    uint32_t           count  = *rows;
+    float             *output = step->output ? step->output : run->logits;
+
+    /* Without allRows, only the last position's logits are needed */
+    if (!run->allRows) {
+        input += (count - 1) * layer->inputSize;
+        count = 1;
+    }
+    *rows = count;
+
+    /* A shortlist computes only its own logits and masks the rest of the vocabulary */
+    if (!step->output && run->shortlist) {
+        for (uint32_t j = 0; j < count; j++) {
+            float *logits = output + j * layer->outputSize;
+            if (tinyaiMatrix4bitVecMulColumns(&layer->weights, input + j * layer->inputSize,
+                                              run->shortlist, run->shortlistSize, layer->biases,
+                                              run->shortlistLogits) != 0) {
+                return -1;
+            }
+            if (step->delta) {
+                addShortlistDelta(step->delta, input + j * layer->inputSize, layer, run);
+            }
+
+            for (uint32_t k = 0; k < layer->outputSize; k++) {
+                logits[k] = -INFINITY;
+            }
+            for (uint32_t k = 0; k < run->shortlistSize; k++) {
+                logits[run->shortlist[k]] = run->shortlistLogits[k];
+            }
+        }
+        return 0;
+    }
+
+    if (stepMatMul(step, input, count, TINYAI_SIMD_ACTIVATION_NONE, output) != 0) {
+        return -1;
+    }
+    if (step->delta) {
+        tinyaiSimdLowRankAdd(output, input, (int)count, (int)layer->inputSize,
+                             (int)layer->outputSize, step->delta->down, step->delta->up,
+                             (int)step->delta->rank, step->delta->scale);
+    }
+
+    return 0;
+}
+
+/**
+ * Free the candidates of an autotuning plan, which keeps the steps as they are
+ */
+static void endPlanTuning(TinyAIModelPlan *plan)
+{
+    if (!plan->tuning) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < plan->numSteps; i++) {
+        tinyaiCSRMatrix4BitFree(plan->tuning[i].csr);
+        tinyaiBSRMatrixFree(plan->tuning[i].bsr);
+    }
+    TINYAI_FREE(plan->tuning);
+    plan->tuning     = NULL;
+    plan->tunePasses = 0;
+}
+
+/**
+ * Free an execution plan
+ */
+static void destroyModelPlan(TinyAIModelPlan *plan)
+{
+    if (!plan) {
+        return;
+    }
+
+    endPlanTuning(plan);
+    if (plan->ownsBuffers) {
+        TINYAI_FREE(plan->buffers[0]);
+        TINYAI_FREE(plan->buffers[1]);
+    }
+    if (plan->scratch) {
+        TINYAI_FREE(plan->scratch);
+    }
+    if (plan->stage) {
+        TINYAI_FREE(plan->stage);
+    }
+    if (plan->sparseScratch) {
+        TINYAI_FREE(plan->sparseScratch);
+    }
+    if (plan->exitHidden) {
+        TINYAI_FREE(plan->exitHidden);
+    }
+    if (plan->steps) {
+        for (uint32_t i = 0; i < plan->numSteps; i++) {
+            tinyaiCSRMatrix4BitFree(plan->steps[i].csr);
+            tinyaiBSRMatrixFree(plan->steps[i].bsr);
+            tinyaiNumaRelease(plan->steps[i].numaReplica);
+        }
+        TINYAI_FREE(plan->steps);
+    }
+    TINYAI_FREE(plan);
+}
+
+/**
+ * Discard a model's plan after its layers change
+ */
+static void invalidateModelPlan(TinyAIModel *model)
+{
+    destroyModelPlan(model->plan);
+    model->plan = NULL;
+}
+
+/**
+ * Dequantize a layer's weights transposed to [outputSize x inputSize], the
+ * orientation of the sparse formats, with pruned weights set to exactly zero
+ *
+ * A pruned weight quantizes to the level nearest zero, which only
+ * dequantizes to within half a quantization step of it; *threshold receives
+ * that bound. Returns NULL for codebook weights, whose levels are not evenly
+ * spaced, or if the layer is less than minSparsity sparse.
+ */
+static float *sparseLayerWeights(const TinyAILayer *layer, float minSparsity, float *threshold)
+{
+    const TinyAIMatrix4bit *weights = &layer->weights;
+    uint32_t                rows    = weights->rows;
+    uint32_t                cols    = weights->cols;
+
+    if (!weights->data || weights->levels) {
+        return NULL;
+    }
+
+    /* Group-quantized weights are bounded by their coarsest group */
+    float step = weights->scales ? 0.0f : weights->scale;
+    if (weights->scales) {
+        size_t groups = tinyaiMatrix4bitGroupCount(weights);
+        for (size_t g = 0; g < groups; g++) {
+            step = fmaxf(step, weights->scales[g]);
+        }
+    }
+    *threshold = 0.5f * step;
+
+    TinyAIMatrixFP32 *dense = tinyaiDequantize4bitToFP32(weights);
+    if (!dense) {
+        return NULL;
+    }
+    if (tinyaiCalculateSparsity(dense->data, (int)rows, (int)cols, *threshold) < minSparsity) {
+        tinyaiDestroyMatrixFP32(dense);
+        return NULL;
+    }
+
+    float *transposed = (float *)TINYAI_MALLOC((size_t)rows * cols * sizeof(float));
+    if (transposed) {
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t c = 0; c < cols; c++) {
+                float value = dense->data[(size_t)r * cols + c];
+                transposed[(size_t)c * rows + r] = fabsf(value) < *threshold ? 0.0f : value;
+            }
+        }
+    }
+    tinyaiDestroyMatrixFP32(dense);
+    return transposed;
+}
+
+/**
+ * Time the single-row product of a step in its current weight format, in nanoseconds
+ */
+static uint64_t benchmarkStepFormat(const TinyAIPlanStep *step, const float *input,
+                                    float *output)
+{
+    uint64_t best = UINT64_MAX;
+
+    for (int i = 0; i < SPARSE_BENCHMARK_RUNS; i++) {
+        uint64_t start = getTimeNs();
+        if (stepMatMul(step, input, 1, TINYAI_SIMD_ACTIVATION_NONE, output) != 0) {
+            return UINT64_MAX;
+        }
+        uint64_t elapsed = getTimeNs() - start;
+        best             = elapsed < best ? elapsed : best;
+    }
+    return best;
+}
+
+/**
+ * Choose the weight format of a dense or output step
+ *
+ * Pruned layers get 4-bit CSR and BSR candidates; the fastest of those and
+ * the packed weights is kept, by timing them on this host when benchmark is
+ * set and by the SPARSE_COST_* estimates otherwise. The step stays dense if
+ * the layer is not sparse enough or a conversion fails.
+ */
+static void selectWeightFormat(TinyAIPlanStep *step, float minSparsity, bool benchmark)
+{
+    const TinyAILayer *layer = step->layer;
+    float              threshold;
+
+    step->weightFormat = TINYAI_WEIGHT_FORMAT_DENSE;
+
+    float *weights = sparseLayerWeights(layer, minSparsity, &threshold);
+    if (!weights) {
+        return;
+    }
+
+    int32_t              rows = (int32_t)layer->outputSize;
+    int32_t              cols = (int32_t)layer->inputSize;
+    TinyAICSRMatrix4Bit *csr  = tinyaiCreateCSRMatrix4BitFromDense(weights, rows, cols, threshold);
+    TinyAIBSRMatrix     *bsr =
+        tinyaiCreateBSRMatrixFromDense(weights, rows, cols, SPARSE_BSR_BLOCK_ROWS, threshold);
+    TINYAI_FREE(weights);
+
+    float  *input  = (float *)TINYAI_MALLOC((size_t)(cols + rows) * sizeof(float));
+    float  *output = input ? input + cols : NULL;
+    float   cost[3];
+    if (benchmark && input) {
+        for (int32_t k = 0; k < cols; k++) {
+            input[k] = cosf((float)k);
+        }
+        cost[TINYAI_WEIGHT_FORMAT_DENSE] = (float)benchmarkStepFormat(step, input, output);
+
+        step->weightFormat = TINYAI_WEIGHT_FORMAT_CSR_4BIT;
+        step->csr          = csr;
+        cost[TINYAI_WEIGHT_FORMAT_CSR_4BIT] =
+            csr ? (float)benchmarkStepFormat(step, input, output) : INFINITY;
+
+        step->weightFormat = TINYAI_WEIGHT_FORMAT_BSR;
+        step->csr          = NULL;
+        step->bsr          = bsr;
+        cost[TINYAI_WEIGHT_FORMAT_BSR] =
+            bsr ? (float)benchmarkStepFormat(step, input, output) : INFINITY;
+        step->bsr = NULL;
+    }
+    else {
+        cost[TINYAI_WEIGHT_FORMAT_DENSE]    = SPARSE_COST_DENSE * (float)rows * (float)cols;
+        cost[TINYAI_WEIGHT_FORMAT_CSR_4BIT] = csr ? SPARSE_COST_CSR * (float)csr->nnz : INFINITY;
+        cost[TINYAI_WEIGHT_FORMAT_BSR] =
+            bsr ? SPARSE_COST_BSR * (float)bsr->nnzBlocks * SPARSE_BSR_BLOCK_ROWS *
+                      TINYAI_BSR_BLOCK_COLS
+                : INFINITY;
+    }
+    if (input) {
+        TINYAI_FREE(input);
+    }
+
+    step->weightFormat = TINYAI_WEIGHT_FORMAT_DENSE;
+    for (int format = TINYAI_WEIGHT_FORMAT_CSR_4BIT; format <= TINYAI_WEIGHT_FORMAT_BSR;
+         format++) {
+        if (cost[format] < cost[step->weightFormat]) {
+            step->weightFormat = format;
+        }
+    }
+
+    /* Keep only the chosen matrix */
+    if (step->weightFormat == TINYAI_WEIGHT_FORMAT_CSR_4BIT) {
+        step->csr = csr;
+        csr       = NULL;
+    }
+    else if (step->weightFormat == TINYAI_WEIGHT_FORMAT_BSR) {
+        step->bsr = bsr;
+        bsr       = NULL;
+    }
+    tinyaiCSRMatrix4BitFree(csr);
+    tinyaiBSRMatrixFree(bsr);
+}
+
+/**
+ * Build the sparse copy of a dense or output step in a format chosen earlier
+ *
+ * The step stays dense if the layer has no zero weights to skip or the
+ * conversion fails.
+ */
+static void applyWeightFormat(TinyAIPlanStep *step, int format)
+{
+    const TinyAILayer *layer = step->layer;
+    float              threshold;
+
+    step->weightFormat = TINYAI_WEIGHT_FORMAT_DENSE;
+    if (format != TINYAI_WEIGHT_FORMAT_CSR_4BIT && format != TINYAI_WEIGHT_FORMAT_BSR) {
+        return;
+    }
+
+    float *weights = sparseLayerWeights(layer, 0.0f, &threshold);
+    if (!weights) {
+        return;
+    }
+
+    int32_t rows = (int32_t)layer->outputSize;
+    int32_t cols = (int32_t)layer->inputSize;
+    if (format == TINYAI_WEIGHT_FORMAT_CSR_4BIT) {
+        step->csr = tinyaiCreateCSRMatrix4BitFromDense(weights, rows, cols, threshold);
+    }
+    else {
+        step->bsr =
+            tinyaiCreateBSRMatrixFromDense(weights, rows, cols, SPARSE_BSR_BLOCK_ROWS, threshold);
+    }
+    TINYAI_FREE(weights);
+
+    if (step->csr || step->bsr) {
+        step->weightFormat = format;
+    }
+}
+
+/**
+ * List the candidates of a dense or output step to autotune
+ *
+ * The packed weights are always a candidate, and CSR and BSR copies of a
+ * layer at least minSparsity sparse are built for the formats the step does
+ * not already run on. With threaded set, each format is also tried serially.
+ */
+static void startStepTuning(const TinyAIPlanStep *step, TinyAIStepTuning *tuning,
+                            float minSparsity, bool sparseKernels, bool threaded)
+{
+    bool formats[3] = {true, step->csr != NULL, step->bsr != NULL};
+    memset(tuning, 0, sizeof(TinyAIStepTuning));
+
+    float  threshold;
+    float *weights = sparseKernels ? sparseLayerWeights(step->layer, minSparsity, &threshold)
+                                   : NULL;
+    if (weights) {
+        int32_t rows = (int32_t)step->layer->outputSize;
+        int32_t cols = (int32_t)step->layer->inputSize;
+        if (!step->csr) {
+            tuning->csr = tinyaiCreateCSRMatrix4BitFromDense(weights, rows, cols, threshold);
+            formats[TINYAI_WEIGHT_FORMAT_CSR_4BIT] = tuning->csr != NULL;
+        }
+        if (!step->bsr) {
+            tuning->bsr = tinyaiCreateBSRMatrixFromDense(weights, rows, cols,
+                                                         SPARSE_BSR_BLOCK_ROWS, threshold);
+            formats[TINYAI_WEIGHT_FORMAT_BSR] = tuning->bsr != NULL;
+        }
+        TINYAI_FREE(weights);
+    }
+
+    for (int format = TINYAI_WEIGHT_FORMAT_DENSE; format <= TINYAI_WEIGHT_FORMAT_BSR; format++) {
+        for (int serial = 0; formats[format] && serial <= (threaded ? 1 : 0); serial++) {
+            TinyAIStepCandidate *candidate = &tuning->candidates[tuning->numCandidates++];
+            candidate->weightFormat        = format;
+            candidate->serial              = serial != 0;
+        }
+    }
+
+    /* A lone candidate has nothing to compare against */
+    if (tuning->numCandidates < 2) {
+        tuning->numCandidates = 0;
+    }
+}
+
+/**
+ * Lock every autotuned step into its fastest candidate and free the others
+ */
+static void finishPlanTuning(TinyAIModelPlan *plan)
+{
+    for (uint32_t i = 0; i < plan->numSteps; i++) {
+        TinyAIPlanStep            *step   = &plan->steps[i];
+        TinyAIStepTuning          *tuning = &plan->tuning[i];
+        const TinyAIStepCandidate *best   = NULL;
+
+        for (uint32_t c = 0; c < tuning->numCandidates; c++) {
+            if (!best || tuning->candidates[c].timeNs < best->timeNs) {
+                best = &tuning->candidates[c];
+            }
+        }
+        if (!best) {
+            continue;
+        }
+
+        /* The step takes the chosen matrix; endPlanTuning frees what is left */
+        step->serial = best->serial;
+        if (best->weightFormat != step->weightFormat) {
+            if (step->csr) {
+                tuning->csr = step->csr;
+            }
+            if (step->bsr) {
+                tuning->bsr = step->bsr;
+            }
+            step->csr = NULL;
+            step->bsr = NULL;
+            if (best->weightFormat == TINYAI_WEIGHT_FORMAT_CSR_4BIT) {
+                step->csr   = tuning->csr;
+                tuning->csr = NULL;
+            }
+            else if (best->weightFormat == TINYAI_WEIGHT_FORMAT_BSR) {
+                step->bsr   = tuning->bsr;
+                tuning->bsr = NULL;
+            }
+            step->weightFormat = best->weightFormat;
+        }
+    }
+    endPlanTuning(plan);
+}
+
+/**
+ * Spread or copy the dense weights of a step across NUMA nodes
+ */
+static void placeStepWeights(TinyAIPlanStep *step, TinyAINumaMode mode)
+{
+    const TinyAIMatrix4bit *weights = &step->layer->weights;
+    if (step->weightFormat != TINYAI_WEIGHT_FORMAT_DENSE || !weights->data) {
+        return;
+    }
+
+    size_t size = tinyaiMatrix4bitDataSize(weights);
+    if (mode == TINYAI_NUMA_INTERLEAVE) {
+        tinyaiNumaPlace(weights->data, size, -1);
+    }
+    else if (mode == TINYAI_NUMA_REPLICATE && tinyaiNumaReplicate(weights->data, size)) {
+        step->numaReplica = weights->data;
+    }
+}
+
+/**
+ * Compile a model into an execution plan, with the weight format and threads
+ * of each layer measured, or taken from formats and threads when they are
+ * not NULL
+ */
+/**
+ * First layer of a model's early-exit head: the output layer and the layer
+ * norms right before it (layerCount if the model does not end in an output layer)
+ */
+static uint32_t exitHeadStart(const TinyAIModel *model)
+{
+    uint32_t head = model->layerCount;
+    if (head == 0 || model->layers[head - 1].type != TINYAI_LAYER_OUTPUT) {
+        return model->layerCount;
+    }
+
+    head--;
+    while (head > 0 && model->layers[head - 1].type == TINYAI_LAYER_LAYERNORM) {
+        head--;
+    }
+    return head;
+}
+
+/**
+ * Whether a forward pass can stop after a layer and hand its output to the exit head
+ *
+ * Skipped layers must be position-wise or attend over the cache, whose rows
+ * the exit fills; a skipped recurrent layer would lose its state.
+ */
+static bool canExitAfter(const TinyAIModel *model, uint32_t layerIndex)
+{
+    uint32_t head = exitHeadStart(model);
+    if (layerIndex + 1 >= head ||
+        model->layers[layerIndex].outputSize != model->layers[head].inputSize) {
+        return false;
+    }
+
+    for (uint32_t i = layerIndex + 1; i < head; i++) {
+        TinyAILayerType type = model->layers[i].type;
+        if (type != TINYAI_LAYER_ATTENTION && type != TINYAI_LAYER_DENSE &&
+            type != TINYAI_LAYER_LAYERNORM) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int prepareModel(TinyAIModel *model, const uint32_t *formats, const uint32_t *threads)
+{
+    if (!model || !model->tokenizer || model->layerCount == 0) {
+        return -1;
+    }
+
+    bool isRNN = model->type == TINYAI_MODEL_TYPE_RNN;
+    if (!isRNN && model->type != TINYAI_MODEL_TYPE_TRANSFORMER) {
+        /* Unsupported model type */
+        return -1;
+    }
+
+    TinyAIModelPlan *plan = (TinyAIModelPlan *)TINYAI_MALLOC(sizeof(TinyAIModelPlan));
+    if (!plan) {
+        return -1;
+    }
+    memset(plan, 0, sizeof(TinyAIModelPlan));
+
+    plan->steps = (TinyAIPlanStep *)TINYAI_MALLOC(model->layerCount * sizeof(TinyAIPlanStep));
+    if (!plan->steps) {
+        TINYAI_FREE(plan);
+        return -1;
+    }
+    memset(plan->steps, 0, model->layerCount * sizeof(TinyAIPlanStep));
+    plan->numSteps  = model->layerCount;
+    plan->vocabSize = model->tokenizer->tokenCount;
+    plan->maxRows   = model->contextSize;
+
+    /* Logits go straight to the caller when the last layer produces exactly the vocabulary */
+    const TinyAILayer *last = &model->layers[model->layerCount - 1];
+    plan->directLogits = last->type == TINYAI_LAYER_OUTPUT && last->outputSize == plan->vocabSize;
+    if (last->outputSize < plan->vocabSize) {
+        destroyModelPlan(plan);
+        return -1;
+    }
+
+    /* Pruned dense and output layers may run on sparse weights */
+    bool  energy        = tinyaiGetExecutionProfile() == TINYAI_PROFILE_ENERGY;
+    bool  sparseKernels = tinyaiConfigGetBool("model.sparse_kernels", 1);
+    bool  benchmark     = tinyaiConfigGetBool("model.sparse_benchmark", 0);
+    float minSparsity   = tinyaiConfigGetFloat("model.sparse_min_sparsity",
+                                             energy ? TINYAI_ENERGY_SPARSE_MIN_SPARSITY : 0.5f);
+
+    /* Dense and output steps may time their alternatives over the first forward passes */
+    int tunePasses = formats ? 0 : tinyaiConfigGetInt("model.autotune_passes", 0);
+    if (tunePasses > 0 && !model->loader) {
+        size_t tuningSize = model->layerCount * sizeof(TinyAIStepTuning);
+        plan->tuning      = (TinyAIStepTuning *)TINYAI_MALLOC(tuningSize);
+        if (!plan->tuning) {
+            destroyModelPlan(plan);
+            return -1;
+        }
+        memset(plan->tuning, 0, tuningSize);
+        plan->tunePasses = (uint32_t)tunePasses;
+    }
+    bool threaded = plan->tuning && tinyaiGetThreadPool() != NULL;
+
+    /* Read-only weights may be spread or copied across NUMA nodes */
+    TinyAINumaMode numaMode = tinyaiNumaGetMode();
+
+    /* Resolve kernels; the widest activation row sizes the buffers */
+    size_t   rowWidth       = model->hiddenSize;
+    uint32_t attentionIndex = 0;
+    uint32_t scratchSize    = 0;
+    size_t   sparseRowSize  = 0;
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        const TinyAILayer *layer = &model->layers[i];
+        TinyAIPlanStep    *step  = &plan->steps[i];
+
+        memset(step, 0, sizeof(TinyAIPlanStep));
+        step->layer = layer;
+
+        switch (layer->type) {
+        case TINYAI_LAYER_EMBEDDING:
+            step->kernel = embeddingStep;
+            break;
+
+        case TINYAI_LAYER_DENSE:
+            step->kernel     = denseStep;
+            step->activation = resolveActivation(layer->activation);
+            step->delta      = adapterDelta(model->adapter, i, TINYAI_ADAPTER_WEIGHTS);
+            break;
+
+        case TINYAI_LAYER_OUTPUT:
+            step->kernel = outputStep;
+            step->delta  = adapterDelta(model->adapter, i, TINYAI_ADAPTER_WEIGHTS);
+            break;
+
+        case TINYAI_LAYER_RNN:
+            if (isRNN) {
+                step->kernel      = recurrentStep;
+                step->activation  = resolveActivation(layer->activation);
+                step->stateOffset = plan->stateSize;
+                plan->stateSize += layer->outputSize;
+                if (layer->inputSize + layer->outputSize > scratchSize) {
+                    scratchSize = layer->inputSize + layer->outputSize;
+                }
+            }
+            break;
+
+        case TINYAI_LAYER_ATTENTION:
+            if (!isRNN && layer->attention) {
+                step->kernel         = attentionStep;
+                step->attentionIndex = attentionIndex++;
+                plan->usesAttention  = true;
+            }
+            else if (!isRNN) {
+                /* No attention weights attached, pass through */
+                step->kernel = identityStep;
+            }
+            break;
+
+        case TINYAI_LAYER_LAYERNORM:
+            if (!isRNN) {
+                step->kernel = layerNormStep;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if (!step->kernel) {
+            /* Layer type the model type cannot run */
+            destroyModelPlan(plan);
+            return -1;
+        }
+
+        /* Streamed weights are not resident to convert */
+        if (sparseKernels && !model->loader &&
+            (step->kernel == denseStep || step->kernel == outputStep)) {
+            if (formats) {
+                applyWeightFormat(step, (int)formats[i]);
+            }
+            else {
+                selectWeightFormat(step, minSparsity, benchmark);
+            }
+        }
+        if (threads) {
+            step->serial = threads[i] == TINYAI_LAYER_THREADS_SERIAL;
+        }
+        if (plan->tuning && (step->kernel == denseStep || step->kernel == outputStep)) {
+            startStepTuning(step, &plan->tuning[i], minSparsity, sparseKernels, threaded);
+        }
+        if ((step->bsr || (plan->tuning && plan->tuning[i].bsr)) &&
+            layer->inputSize + layer->outputSize > sparseRowSize) {
+            sparseRowSize = layer->inputSize + layer->outputSize;
+        }
+        if (numaMode != TINYAI_NUMA_OFF && !model->loader &&
+            (step->kernel == denseStep || step->kernel == outputStep)) {
+            placeStepWeights(step, numaMode);
+        }
+
+        if (layer->inputSize > rowWidth) {
+            rowWidth = layer->inputSize;
+        }
+        if (layer->outputSize > rowWidth && !(i == model->layerCount - 1 && plan->directLogits)) {
+            rowWidth = layer->outputSize;
+        }
+    }
+
+    /* The model's activation buffers suffice unless a layer is wider than the hidden size */
+    bool   half        = model->activationPrecision != TINYAI_ACTIVATIONS_FP32;
+    size_t elementSize = half ? sizeof(uint16_t) : sizeof(float);
+    if (rowWidth > model->hiddenSize) {
+        size_t bufferSize   = (size_t)plan->maxRows * rowWidth * elementSize;
+        plan->buffers[0]    = (float *)TINYAI_MALLOC(bufferSize);
+        plan->buffers[1]    = (float *)TINYAI_MALLOC(bufferSize);
+        plan->ownsBuffers   = true;
+        plan->scratchBytes += 2 * bufferSize;
+        if (!plan->buffers[0] || !plan->buffers[1]) {
+            destroyModelPlan(plan);
+            return -1;
+        }
+    }
+    else {
+        plan->buffers[0] = model->activations[0];
+        plan->buffers[1] = model->activations[1];
+    }
+
+    /* Half-precision steps run their kernels on a few float rows at a time */
+    uint32_t stageRows = plan->maxRows < HALF_STAGE_ROWS ? plan->maxRows : HALF_STAGE_ROWS;
+    if (half) {
+        size_t stageSize = 2 * (size_t)stageRows * rowWidth * sizeof(float);
+        plan->stage      = (float *)TINYAI_MALLOC(stageSize);
+        if (!plan->stage) {
+            destroyModelPlan(plan);
+            return -1;
+        }
+        plan->scratchBytes += stageSize;
+    }
+
+    if (scratchSize > 0) {
+        plan->scratch = (float *)TINYAI_MALLOC(scratchSize * sizeof(float));
+        if (!plan->scratch) {
+            destroyModelPlan(plan);
+            return -1;
+        }
+        plan->scratchBytes += scratchSize * sizeof(float);
+    }
+
+    /* Batched BSR products transpose their input and output rows */
+    if (sparseRowSize > 0) {
+        size_t sparseSize   = (size_t)plan->maxRows * sparseRowSize * sizeof(float);
+        plan->sparseScratch = (float *)TINYAI_MALLOC(sparseSize);
+        if (!plan->sparseScratch) {
+            destroyModelPlan(plan);
+            return -1;
+        }
+        plan->scratchBytes += sparseSize;
+    }
+
+    /* Early exits run the output layer and its layer norms on a saved hidden row */
+    plan->headStep = exitHeadStart(model);
+    if (plan->directLogits) {
+        plan->exitHidden = (float *)TINYAI_MALLOC(rowWidth * sizeof(float));
+        if (!plan->exitHidden) {
+            destroyModelPlan(plan);
+            return -1;
+        }
+        plan->scratchBytes += rowWidth * sizeof(float);
+    }
+
+    /* Static ping-pong layout: step i writes buffer i % 2 and reads the other; half-precision
+       steps stage the rows of those buffers through float ones */
+    for (uint32_t i = 0; i < plan->numSteps; i++) {
+        TinyAIPlanStep *step = &plan->steps[i];
+        step->input          = plan->buffers[(i + 1) % 2];
+        step->output         = plan->buffers[i % 2];
+        step->scratch        = plan->scratch;
+        step->sparseScratch  = plan->sparseScratch;
+        if (half) {
+            step->halfInput  = (const uint16_t *)step->input;
+            step->halfOutput = (uint16_t *)step->output;
+            step->input      = plan->stage;
+            step->output     = plan->stage + (size_t)stageRows * rowWidth;
+            step->stageRows  = stageRows;
+            step->bf16       = model->activationPrecision == TINYAI_ACTIVATIONS_BF16;
+        }
+    }
+    if (plan->directLogits) {
+        plan->steps[plan->numSteps - 1].output     = NULL;
+        plan->steps[plan->numSteps - 1].halfOutput = NULL;
+    }
+
+    invalidateModelPlan(model);
+    model->plan = plan;
+
+    return 0;
+}
+
+/**
+ * Compile a model into an execution plan
+ */
+int tinyaiPrepareModel(TinyAIModel *model) { return prepareModel(model, NULL, NULL); }
+
+/**
+ * Stream a model's layer weights through a progressive loader
+ */
+int tinyaiSetModelProgressiveLoader(TinyAIModel *model, TinyAIProgressiveLoader *loader)
+{
+    if (!model || !loader || loader->num_layers < model->layerCount) {
+        return -1;
+    }
+
+    /* Layers with weights must match the loader's layer sizes */
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        const TinyAIMatrix4bit *weights = &model->layers[i].weights;
+        if (weights->rows > 0 &&
+            loader->layers[i].memory_usage != tinyaiMatrix4bitDataSize(weights)) {
+            return -1;
+        }
+    }
+
+    /* The loader holds the data from now on */
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        if (model->layers[i].weights.data) {
+            if (!isSnapshotData(model, model->layers[i].weights.data)) {
+                TINYAI_FREE(model->layers[i].weights.data);
+            }
+            model->layers[i].weights.data = NULL;
+        }
+    }
+    model->loader = loader;
+
+    /* The plan may hold sparse copies of the freed weights */
+    invalidateModelPlan(model);
+
+    return 0;
+}
+
+/**
+ * Bytes of one activation value in a TINYAI_ACTIVATIONS_* storage
+ */
+static size_t activationElementSize(uint32_t precision)
+{
+    return precision == TINYAI_ACTIVATIONS_FP32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+/**
+ * Store the activations passed between a model's layers in half precision
+ */
+int tinyaiSetModelActivationPrecision(TinyAIModel *model, uint32_t precision)
+{
+    if (!model || precision > TINYAI_ACTIVATIONS_BF16) {
+        return -1;
+    }
+    if (precision == model->activationPrecision) {
+        return 0;
+    }
+
+    /* The ping-pong buffers take the new element size */
+    size_t size =
+        (size_t)model->contextSize * model->hiddenSize * activationElementSize(precision);
+    float *buffers[2] = {(float *)TINYAI_MALLOC(size), (float *)TINYAI_MALLOC(size)};
+    if (!buffers[0] || !buffers[1]) {
+        if (buffers[0]) {
+            TINYAI_FREE(buffers[0]);
+        }
+        if (buffers[1]) {
+            TINYAI_FREE(buffers[1]);
+        }
+        return -1;
+    }
+
+    /* The plan points into the old buffers */
+    invalidateModelPlan(model);
+    TINYAI_FREE(model->activations[0]);
+    TINYAI_FREE(model->activations[1]);
+    model->activations[0]      = buffers[0];
+    model->activations[1]      = buffers[1];
+    model->activationPrecision = precision;
+
+    return 0;
+}
+
+/**
+ * Get a model's execution plan, compiling it on first use
+ */
+static TinyAIModelPlan *modelPlan(TinyAIModel *model)
+{
+    /* A vocabulary change alters the logits layout */
+    if (model->plan && model->plan->vocabSize != model->tokenizer->tokenCount) {
+        invalidateModelPlan(model);
+    }
+    if (!model->plan && tinyaiPrepareModel(model) != 0) {
+        return NULL;
+    }
+    return model->plan;
+}
+
+/**
+ * Get the weight format a layer runs on in the model's execution plan
+ */
+int tinyaiGetLayerWeightFormat(TinyAIModel *model, uint32_t layerIndex)
+{
+    if (!model || layerIndex >= model->layerCount) {
+        return -1;
+    }
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan) {
+        return -1;
+    }
+    return plan->steps[layerIndex].weightFormat;
+}
+
+/**
+ * Get the threads a layer runs on in the model's execution plan
+ */
+int tinyaiGetLayerThreads(TinyAIModel *model, uint32_t layerIndex)
+{
+    if (!model || layerIndex >= model->layerCount) {
+        return -1;
+    }
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan) {
+        return -1;
+    }
+    return plan->steps[layerIndex].serial ? TINYAI_LAYER_THREADS_SERIAL
+                                          : TINYAI_LAYER_THREADS_POOL;
+}
+
+/**
+ * Get the forward passes left before a model's autotuned layers are locked in
+ */
+uint32_t tinyaiGetAutotunePassesLeft(const TinyAIModel *model)
+{
+    return (model && model->plan) ? model->plan->tunePasses : 0;
+}
+
+/* ----------------- Snapshots ----------------- */
+
+/**
+ * Header of a model snapshot
+ *
+ * Followed by one SnapshotLayer per layer, then the data sections, each on a
+ * SNAPSHOT_ALIGNMENT boundary, and last the binary vocabulary. Offsets are
+ * from the start of the file; 0 marks an absent section.
+ */
+typedef struct {
+    uint32_t magic;         /* TINYAI_SNAPSHOT_MAGIC */
+    uint32_t version;       /* TINYAI_SNAPSHOT_VERSION */
+    uint32_t type;          /* Model type */
+    uint32_t hiddenSize;    /* Hidden size */
+    uint32_t contextSize;   /* Maximum context size */
+    uint32_t layerCount;    /* Number of layer records */
+    uint32_t caseSensitive; /* Whether tokenization is case-sensitive */
+    uint32_t reserved;      /* 0 */
+    uint64_t vocabOffset;   /* Binary vocabulary, indexes included */
+    uint64_t vocabSize;     /* Size of the binary vocabulary in bytes */
+    uint64_t fileSize;      /* Size of the whole snapshot, to detect truncation */
+} SnapshotHeader;
+
+/**
+ * 4-bit matrix of a model snapshot
+ */
+typedef struct {
+    uint32_t rows;         /* Number of rows */
+    uint32_t cols;         /* Number of columns */
+    uint32_t layout;       /* TinyAIMatrix4bitLayout of the data */
+    uint32_t groupSize;    /* Columns per group (0 when not group-quantized) */
+    float    scale;        /* Scaling factor */
+    float    zeroPoint;    /* Zero point */
+    uint64_t dataOffset;   /* Packed data (0 when the matrix is empty) */
+    uint64_t scalesOffset; /* Per-group scales, followed by the zero points */
+    uint64_t levelsOffset; /* Codebook levels */
+} SnapshotMatrix;
+
+/**
+ * Layer of a model snapshot
+ */
+typedef struct {
+    uint32_t       type;                /* Layer type */
+    uint32_t       activation;          /* Activation function */
+    uint32_t       inputSize;           /* Input size */
+    uint32_t       outputSize;          /* Output size */
+    uint32_t       weightFormat;        /* TINYAI_WEIGHT_FORMAT_* the plan runs the layer on */
+    uint32_t       threads;             /* TINYAI_LAYER_THREADS_* the plan runs the layer on */
+    uint32_t       hasAttention;        /* Whether the attention fields are set */
+    uint32_t       reserved;            /* 0 */
+    SnapshotMatrix weights;             /* Layer weights */
+    uint64_t       biasesOffset;        /* outputSize biases */
+    uint32_t       batchSize;           /* Attention parameters */
+    uint32_t       seqLength;
+    uint32_t       numHeads;
+    uint32_t       numKVHeads;
+    uint32_t       headDim;
+    uint32_t       hiddenDim;
+    uint32_t       windowSize;
+    uint32_t       useCausalMask;
+    float          scaleFactor;
+    uint32_t       kvCachePrecision;
+    SnapshotMatrix projections[4];      /* Query, key, value and output weights */
+    uint64_t       projectionBiases[4]; /* Their biases */
+} SnapshotLayer;
+
+/**
+ * Check whether memory lies in a model's mapped snapshot
+ */
+static bool isSnapshotData(const TinyAIModel *model, const void *data)
+{
+    const char *base = (const char *)model->snapshot;
+    return base && data && (const char *)data >= base &&
+           (const char *)data < base + model->snapshotSize;
+}
+
+/**
+ * Forget a matrix's pointers into the snapshot, so releasing it frees only its own memory
+ */
+static void detachSnapshotMatrix(const TinyAIModel *model, TinyAIMatrix4bit *matrix)
+{
+    if (isSnapshotData(model, matrix->data)) {
+        matrix->data = NULL;
+    }
+    if (isSnapshotData(model, matrix->scales)) {
+        matrix->scales     = NULL;
+        matrix->zeroPoints = NULL;
+    }
+    if (isSnapshotData(model, matrix->levels)) {
+        matrix->levels = NULL;
+    }
+}
+
+/**
+ * Forget an attention structure's pointers into the snapshot
+ */
+static void detachSnapshotAttention(const TinyAIModel *model, TinyAISelfAttention *attention)
+{
+    TinyAIMatrix4bit *projections[4] = {&attention->queryWeight, &attention->keyWeight,
+                                        &attention->valueWeight, &attention->outputWeight};
+    float           **biases[4]      = {&attention->queryBias, &attention->keyBias,
+                                        &attention->valueBias, &attention->outputBias};
+    for (int p = 0; p < 4; p++) {
+        detachSnapshotMatrix(model, projections[p]);
+        if (isSnapshotData(model, *biases[p])) {
+            *biases[p] = NULL;
+        }
+    }
+}
+
+/**
+ * Forget a layer's pointers into the snapshot
+ */
+static void detachSnapshotLayer(const TinyAIModel *model, TinyAILayer *layer)
+{
+    detachSnapshotMatrix(model, &layer->weights);
+    if (isSnapshotData(model, layer->biases)) {
+        layer->biases = NULL;
+    }
+    if (layer->attention) {
+        detachSnapshotAttention(model, layer->attention);
+    }
+}
+
+/**
+ * Map a snapshot file read-only
+ */
+static void *mapSnapshot(const char *path, size_t *size)
+{
+    void *data = NULL;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        *size          = (size_t)fileSize.QuadPart;
+        HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(file, &st) == 0 && st.st_size > 0) {
+        /* Shared, so every process mapping the file reads the same physical pages */
+        *size = (size_t)st.st_size;
+        data  = mmap(NULL, *size, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+    close(file);
+#endif
+
+    return data;
+}
+
+/**
+ * Map a snapshot published in a shared memory segment read-only
+ */
+static void *mapSharedSnapshot(const char *name, size_t *size)
+{
+#ifdef _WIN32
+    (void)name;
+    (void)size;
+    return NULL;
+#else
+    int segment = shm_open(name, O_RDONLY, 0);
+    if (segment < 0) {
+        return NULL;
+    }
+
+    void       *data = NULL;
+    struct stat st;
+    if (fstat(segment, &st) == 0 && st.st_size > 0) {
+        *size = (size_t)st.st_size;
+        data  = mmap(NULL, *size, PROT_READ, MAP_SHARED, segment, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+    close(segment);
+    return data;
+#endif
+}
+
+/**
+ * Unmap a snapshot mapped by mapSnapshot or mapSharedSnapshot
+ */
+static void unmapSnapshot(void *data, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+/**
+ * Pad a snapshot being written to the next section boundary, returning the offset reached
+ */
+static uint64_t beginSnapshotSection(FILE *file, bool *ok)
+{
+    static const uint8_t padding[SNAPSHOT_ALIGNMENT] = {0};
+
+    long position = ftell(file);
+    if (position < 0) {
+        *ok = false;
+        return 0;
+    }
+    size_t pad = (SNAPSHOT_ALIGNMENT - (size_t)position % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT;
+    if (pad > 0 && fwrite(padding, 1, pad, file) != pad) {
+        *ok = false;
+    }
+    return (uint64_t)position + pad;
+}
+
+/**
+ * Write an aligned section of a snapshot, returning its offset (0 when there is no data)
+ */
+static uint64_t writeSnapshotSection(FILE *file, const void *data, size_t size, bool *ok)
+{
+    if (!data || size == 0 || !*ok) {
+        return 0;
+    }
+
+    uint64_t offset = beginSnapshotSection(file, ok);
+    if (*ok && fwrite(data, 1, size, file) != size) {
+        *ok = false;
+    }
+    return offset;
+}
+
+/**
+ * Write the sections of a matrix and fill in its record
+ */
+static void writeSnapshotMatrix(FILE *file, const TinyAIMatrix4bit *matrix,
+                                SnapshotMatrix *record, bool *ok)
+{
+    memset(record, 0, sizeof(SnapshotMatrix));
+    record->rows      = matrix->rows;
+    record->cols      = matrix->cols;
+    record->layout    = (uint32_t)matrix->layout;
+    record->groupSize = matrix->scales ? matrix->groupSize : 0;
+    record->scale     = matrix->scale;
+    record->zeroPoint = matrix->zeroPoint;
+
+    record->dataOffset =
+        writeSnapshotSection(file, matrix->data, tinyaiMatrix4bitDataSize(matrix), ok);
+    if (record->dataOffset == 0) {
+        return;
+    }
+
+    if (record->groupSize > 0) {
+        size_t groups = tinyaiMatrix4bitGroupCount(matrix);
+        record->scalesOffset =
+            writeSnapshotSection(file, matrix->scales, groups * sizeof(float), ok);
+        if (*ok && fwrite(matrix->zeroPoints, sizeof(float), groups, file) != groups) {
+            *ok = false;
+        }
+    }
+    record->levelsOffset = writeSnapshotSection(file, matrix->levels,
+                                                TINYAI_CODEBOOK_LEVELS * sizeof(float), ok);
+}
+
+/**
+ * Save a prepared model as a snapshot
+ */
+int tinyaiSaveModelSnapshot(TinyAIModel *model, const char *path)
+{
+    if (!model || !path || model->loader) {
+        return -1;
+    }
+
+    /* Weights are saved in the layout they run in, with the format the plan chose */
+    TinyAIModelPlan *plan = tinyaiPrepackModelWeights(model) == 0 ? modelPlan(model) : NULL;
+    if (!plan) {
+        return -1;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic         = TINYAI_SNAPSHOT_MAGIC;
+    header.version       = TINYAI_SNAPSHOT_VERSION;
+    header.type          = model->type;
+    header.hiddenSize    = model->hiddenSize;
+    header.contextSize   = model->contextSize;
+    header.layerCount    = model->layerCount;
+    header.caseSensitive = (uint32_t)model->tokenizer->caseSensitive;
+
+    SnapshotLayer *records =
+        (SnapshotLayer *)TINYAI_MALLOC(model->layerCount * sizeof(SnapshotLayer));
+    if (!records) {
+        return -1;
+    }
+    memset(records, 0, model->layerCount * sizeof(SnapshotLayer));
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        TINYAI_FREE(records);
+        return -1;
+    }
+
+    /* The header and records are written again once the section offsets are known */
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(records, sizeof(SnapshotLayer), model->layerCount, file) == model->layerCount;
+
+    for (uint32_t i = 0; ok && i < model->layerCount; i++) {
+        const TinyAILayer *layer  = &model->layers[i];
+        SnapshotLayer     *record = &records[i];
+
+        record->type         = layer->type;
+        record->activation   = layer->activation;
+        record->inputSize    = layer->inputSize;
+        record->outputSize   = layer->outputSize;
+        record->weightFormat = (uint32_t)plan->steps[i].weightFormat;
+        record->threads      = plan->steps[i].serial ? TINYAI_LAYER_THREADS_SERIAL
+                                                     : TINYAI_LAYER_THREADS_POOL;
+        writeSnapshotMatrix(file, &layer->weights, &record->weights, &ok);
+        record->biasesOffset =
+            writeSnapshotSection(file, layer->biases, layer->outputSize * sizeof(float), &ok);
+
+        if (!layer->attention) {
+            continue;
+        }
+
+        const TinyAISelfAttention   *attention = layer->attention;
+        const TinyAIAttentionParams *params    = &attention->params;
+        record->hasAttention                   = 1;
+        record->batchSize                      = params->batchSize;
+        record->seqLength                      = params->seqLength;
+        record->numHeads                       = params->numHeads;
+        record->numKVHeads                     = params->numKVHeads;
+        record->headDim                        = params->headDim;
+        record->hiddenDim                      = params->hiddenDim;
+        record->windowSize                     = params->windowSize;
+        record->useCausalMask                  = params->useCausalMask ? 1 : 0;
+        record->scaleFactor                    = params->scaleFactor;
+        record->kvCachePrecision               = (uint32_t)params->kvCachePrecision;
+
+        const TinyAIMatrix4bit *projections[4] = {&attention->queryWeight, &attention->keyWeight,
+                                                  &attention->valueWeight,
+                                                  &attention->outputWeight};
+        const float *biases[4]   = {attention->queryBias, attention->keyBias, attention->valueBias,
+                                    attention->outputBias};
+        uint32_t     kvDim       = params->numKVHeads * params->headDim;
+        uint32_t     biasSize[4] = {params->hiddenDim, kvDim, kvDim, params->hiddenDim};
+        for (int p = 0; p < 4; p++) {
+            writeSnapshotMatrix(file, projections[p], &record->projections[p], &ok);
+            record->projectionBiases[p] =
+                writeSnapshotSection(file, biases[p], biasSize[p] * sizeof(float), &ok);
+        }
+    }
+
+    /* The vocabulary goes last, with its hash indexes, to be used in place when loading */
+    if (ok) {
+        header.vocabOffset = beginSnapshotSection(file, &ok);
+        long end           = ok && tinyaiWriteBinaryVocabulary(model->tokenizer, file) == 0
+                                 ? ftell(file)
+                                 : -1;
+        ok                 = end > 0;
+        header.vocabSize   = ok ? (uint64_t)end - header.vocabOffset : 0;
+        header.fileSize    = ok ? (uint64_t)end : 0;
+    }
+
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(records, sizeof(SnapshotLayer), model->layerCount, file) == model->layerCount;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    TINYAI_FREE(records);
+
+    if (!ok) {
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Get a section of a model's mapped snapshot, or NULL if it does not lie inside the file
+ */
+static const void *snapshotSection(const TinyAIModel *model, uint64_t offset, size_t size)
+{
+    if (offset == 0 || offset % sizeof(float) != 0 || offset > model->snapshotSize ||
+        size > model->snapshotSize - offset) {
+        return NULL;
+    }
+    return (const char *)model->snapshot + offset;
+}
+
+/**
+ * Get count floats of a mapped snapshot (NULL when absent), clearing *ok if they are out of bounds
+ */
+static float *snapshotFloats(const TinyAIModel *model, uint64_t offset, size_t count, bool *ok)
+{
+    if (offset == 0) {
+        return NULL;
+    }
+
+    /* The mapping is read-only; nothing writes weights or biases in place */
+    float *floats = (float *)snapshotSection(model, offset, count * sizeof(float));
+    if (!floats) {
+        *ok = false;
+    }
+    return floats;
+}
+
+/**
+ * Point a matrix at its sections in a mapped snapshot
+ *
+ * Returns false if the matrix is not rows x cols or a section is out of bounds.
+ */
+static bool bindSnapshotMatrix(const TinyAIModel *model, const SnapshotMatrix *record,
+                               uint32_t rows, uint32_t cols, TinyAIMatrix4bit *matrix)
+{
+    memset(matrix, 0, sizeof(TinyAIMatrix4bit));
+    if (record->dataOffset == 0) {
+        return true;
+    }
+    if (record->rows != rows || record->cols != cols || rows == 0 || cols == 0 ||
+        record->layout > TINYAI_MATRIX4BIT_PANELS || record->groupSize > cols) {
+        return false;
+    }
+
+    matrix->rows      = rows;
+    matrix->cols      = cols;
+    matrix->layout    = (TinyAIMatrix4bitLayout)record->layout;
+    matrix->groupSize = record->groupSize;
+    matrix->scale     = record->scale;
+    matrix->zeroPoint = record->zeroPoint;
+
+    bool ok = true;
+    matrix->data =
+        (uint8_t *)snapshotSection(model, record->dataOffset, tinyaiMatrix4bitDataSize(matrix));
+    if (!matrix->data) {
+        return false;
+    }
+    if (matrix->groupSize > 0) {
+        size_t groups      = tinyaiMatrix4bitGroupCount(matrix);
+        matrix->scales     = snapshotFloats(model, record->scalesOffset, 2 * groups, &ok);
+        matrix->zeroPoints = matrix->scales ? matrix->scales + groups : NULL;
+        ok                 = ok && matrix->scales;
+    }
+    matrix->levels = snapshotFloats(model, record->levelsOffset, TINYAI_CODEBOOK_LEVELS, &ok);
+    return ok;
+}
+
+/**
+ * Attach the attention weights of a snapshot layer, in place
+ */
+static int loadSnapshotAttention(TinyAIModel *model, uint32_t layerIndex,
+                                 const SnapshotLayer *record)
+{
+    TinyAIAttentionParams params;
+    memset(&params, 0, sizeof(params));
+    params.batchSize        = record->batchSize;
+    params.seqLength        = record->seqLength;
+    params.numHeads         = record->numHeads;
+    params.numKVHeads       = record->numKVHeads;
+    params.headDim          = record->headDim;
+    params.hiddenDim        = record->hiddenDim;
+    params.windowSize       = record->windowSize;
+    params.useCausalMask    = record->useCausalMask != 0;
+    params.scaleFactor      = record->scaleFactor;
+    params.kvCachePrecision = (TinyAIKVCachePrecision)record->kvCachePrecision;
+
+    /* Checked before sizing the scratch memory from them */
+    if (params.hiddenDim != record->inputSize || params.seqLength < model->contextSize ||
+        (uint64_t)params.numHeads * params.headDim != params.hiddenDim) {
+        return -1;
+    }
+
+    TinyAISelfAttention *attention =
+        (TinyAISelfAttention *)TINYAI_MALLOC(sizeof(TinyAISelfAttention));
+    if (!attention) {
+        return -1;
+    }
+    if (tinyaiInitSelfAttention(attention, &params) != 0) {
+        TINYAI_FREE(attention);
+        return -1;
+    }
+
+    TinyAIMatrix4bit *projections[4] = {&attention->queryWeight, &attention->keyWeight,
+                                        &attention->valueWeight, &attention->outputWeight};
+    float           **biases[4]      = {&attention->queryBias, &attention->keyBias,
+                                        &attention->valueBias, &attention->outputBias};
+    uint32_t          hiddenDim      = attention->params.hiddenDim;
+    uint32_t          kvDim          = attention->params.numKVHeads * attention->params.headDim;
+    uint32_t          cols[4]        = {hiddenDim, kvDim, kvDim, hiddenDim};
+
+    bool ok = true;
+    for (int p = 0; ok && p < 4; p++) {
+        ok         = bindSnapshotMatrix(model, &record->projections[p], hiddenDim, cols[p],
+                                        projections[p]);
+        *biases[p] = snapshotFloats(model, record->projectionBiases[p], cols[p], &ok);
+    }
+
+    if (!ok || tinyaiSetLayerAttention(model, layerIndex, attention) != 0) {
+        detachSnapshotAttention(model, attention);
+        tinyaiDestroySelfAttention(attention);
+        TINYAI_FREE(attention);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Load a model from a mapped snapshot, using it in place; the model takes the mapping over
+ */
+static TinyAIModel *loadSnapshotMapping(void *data, size_t size)
+{
+    SnapshotHeader header;
+    if (size < sizeof(header)) {
+        unmapSnapshot(data, size);
+        return NULL;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != TINYAI_SNAPSHOT_MAGIC || header.version != TINYAI_SNAPSHOT_VERSION ||
+        header.fileSize != size || header.layerCount == 0 ||
+        header.layerCount > (size - sizeof(header)) / sizeof(SnapshotLayer) ||
+        header.vocabOffset % SNAPSHOT_ALIGNMENT != 0 || header.vocabOffset > size ||
+        header.vocabSize > size - header.vocabOffset) {
+        unmapSnapshot(data, size);
+        return NULL;
+    }
+
+    TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
+    if (!tokenizer || tinyaiAttachVocabulary(tokenizer, (const char *)data + header.vocabOffset,
+                                             (size_t)header.vocabSize) != 0) {
+        tinyaiDestroyTokenizer(tokenizer);
+        unmapSnapshot(data, size);
+        return NULL;
+    }
+    tokenizer->caseSensitive = (int)header.caseSensitive;
+
+    TinyAIModel *model =
+        tinyaiCreateModel(header.type, header.hiddenSize, header.contextSize, tokenizer);
+    if (!model) {
+        tinyaiDestroyTokenizer(tokenizer);
+        unmapSnapshot(data, size);
+        return NULL;
+    }
+
+    /* The model owns the mapping and the tokenizer from here on */
+    model->snapshot     = data;
+    model->snapshotSize = size;
+
+    const SnapshotLayer *records =
+        (const SnapshotLayer *)((const char *)data + sizeof(SnapshotHeader));
+    uint32_t *formats = (uint32_t *)TINYAI_MALLOC(2 * header.layerCount * sizeof(uint32_t));
+    uint32_t *threads = formats ? formats + header.layerCount : NULL;
+    bool      ok      = formats != NULL;
+
+    /* Sparse copies would be private to this process; shared weights run from the mapping */
+    bool sharedWeights = tinyaiConfigGetBool("model.shared_weights", 0);
+
+    for (uint32_t i = 0; ok && i < header.layerCount; i++) {
+        SnapshotLayer record;
+        memcpy(&record, &records[i], sizeof(record));
+
+        if (tinyaiAddLayer(model, record.type, record.inputSize, record.outputSize,
+                           record.activation) != 0) {
+            ok = false;
+            break;
+        }
+        formats[i] = sharedWeights ? TINYAI_WEIGHT_FORMAT_DENSE : record.weightFormat;
+        threads[i] = record.threads;
+
+        /* Recurrent layers multiply the input and the previous hidden state together */
+        TinyAILayer *layer      = &model->layers[i];
+        uint32_t     weightRows = record.inputSize;
+        if (record.type == TINYAI_LAYER_RNN) {
+            weightRows += record.outputSize;
+        }
+        ok = bindSnapshotMatrix(model, &record.weights, weightRows, record.outputSize,
+                                &layer->weights);
+        layer->biases = snapshotFloats(model, record.biasesOffset, record.outputSize, &ok);
+
+        if (ok && record.hasAttention) {
+            ok = loadSnapshotAttention(model, i, &record) == 0;
+        }
+    }
+
+    /* The recorded choices spare measuring, benchmarking or autotuning every layer again */
+    if (!ok || prepareModel(model, formats, threads) != 0) {
+        if (formats) {
+            TINYAI_FREE(formats);
+        }
+        tinyaiDestroyModel(model);
+        return NULL;
+    }
+    TINYAI_FREE(formats);
+
+    return model;
+}
+
+/**
+ * Load a model from a snapshot, using the mapped file in place
+ */
+TinyAIModel *tinyaiLoadModelSnapshot(const char *path)
+{
+    if (!path) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    void  *data = mapSnapshot(path, &size);
+    return data ? loadSnapshotMapping(data, size) : NULL;
+}
+
+/**
+ * Copy a snapshot into a named shared memory segment
+ */
+int tinyaiPublishModelSnapshot(const char *path, const char *name)
+{
+    if (!path || !name) {
+        return -1;
+    }
+
+#ifdef _WIN32
+    return -1;
+#else
+    size_t size     = 0;
+    void  *snapshot = mapSnapshot(path, &size);
+    if (!snapshot) {
+        return -1;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, snapshot, size < sizeof(header) ? size : sizeof(header));
+    if (size < sizeof(header) || header.magic != TINYAI_SNAPSHOT_MAGIC ||
+        header.fileSize != size) {
+        unmapSnapshot(snapshot, size);
+        return -1;
+    }
+
+    /* Workers still mapping an older segment keep it until they unmap it */
+    shm_unlink(name);
+    int segment = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (segment < 0) {
+        unmapSnapshot(snapshot, size);
+        return -1;
+    }
+
+    int   result = -1;
+    void *data   = MAP_FAILED;
+    if (ftruncate(segment, (off_t)size) == 0) {
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment, 0);
+    }
+    if (data != MAP_FAILED) {
+        memcpy(data, snapshot, size);
+        munmap(data, size);
+        result = 0;
+    }
+    close(segment);
+    unmapSnapshot(snapshot, size);
+
+    if (result != 0) {
+        shm_unlink(name);
+    }
+    return result;
+#endif
+}
+
+/**
+ * Remove a snapshot published by tinyaiPublishModelSnapshot
+ */
+int tinyaiUnpublishModelSnapshot(const char *name)
+{
+#ifdef _WIN32
+    (void)name;
+    return -1;
+#else
+    return (name && shm_unlink(name) == 0) ? 0 : -1;
+#endif
+}
+
+/**
+ * Load a model from a snapshot published in a shared memory segment
+ */
+TinyAIModel *tinyaiLoadSharedModelSnapshot(const char *name)
+{
+    if (!name) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    void  *data = mapSharedSnapshot(name, &size);
+    return data ? loadSnapshotMapping(data, size) : NULL;
+}
+
+/* ----------------- Profiling ----------------- */
+
+/**
+ * Get a monotonic timestamp in nanoseconds
+ */
+static uint64_t getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Bytes of a packed 4-bit matrix, with its per-group scales and zero points
+ */
+static uint64_t packedBytes(const TinyAIMatrix4bit *matrix)
+{
+    return (uint64_t)tinyaiMatrix4bitDataSize(matrix) +
+           (uint64_t)tinyaiMatrix4bitGroupCount(matrix) * 2 * sizeof(float);
+}
+
+/**
+ * Positions attended over by the rows of a step, summed over rows
+ *
+ * Causal: row j sees the cached prefix plus rows 0..j, cut to the window.
+ */
+static uint64_t attendedPositions(const TinyAIPlanRun *run, uint32_t rows, uint32_t windowSize)
+{
+    uint64_t total = 0;
+    for (uint32_t j = 0; j < rows; j++) {
+        uint64_t visible = run->rowCaches ? run->rowCaches[j]->length + 1
+                                          : (run->cache ? run->cache->length : 0) + j + 1;
+        if (windowSize > 0 && visible > windowSize) {
+            visible = windowSize;
+        }
+        total += visible;
+    }
+    return total;
+}
+
+/**
+ * FLOPs and weight bytes of multiplying rows by a step's weights in their format
+ */
+static void stepWeightCost(const TinyAIPlanStep *step, uint64_t rows, uint64_t *flops,
+                           uint64_t *bytes)
+{
+    const TinyAILayer *layer = step->layer;
+
+    if (step->csr) {
+        *flops = 2 * rows * (uint64_t)step->csr->nnz;
+        *bytes = tinyaiCSRMatrix4BitMemoryUsage(step->csr);
+    }
+    else if (step->bsr) {
+        *flops = 2 * rows * (uint64_t)step->bsr->nnzBlocks * step->bsr->blockRows *
+                 TINYAI_BSR_BLOCK_COLS;
+        *bytes = tinyaiBSRMatrixMemoryUsage(step->bsr);
+    }
+    else {
+        *flops = 2 * rows * layer->inputSize * layer->outputSize;
+        *bytes = packedBytes(&layer->weights);
+    }
+}
+
+/**
+ * Estimate the FLOPs and bytes read by one step from its shapes
+ */
+static void stepCost(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t rowsIn,
+                     uint32_t rowsOut, uint64_t *flops, uint64_t *bytes)
+{
+    const TinyAILayer *layer = step->layer;
+    uint64_t           in    = layer->inputSize;
+    uint64_t           out   = layer->outputSize;
+
+    *flops = 0;
+    *bytes = 0;
+
+    if (step->kernel == embeddingStep) {
+        /* One packed row per token */
+        *bytes = rowsIn * (out + 1) / 2;
+    }
+    else if (step->kernel == denseStep) {
+        stepWeightCost(step, rowsIn, flops, bytes);
+    }
+    else if (step->kernel == outputStep) {
+        if (!step->output && run->shortlist) {
+            /* Only the shortlisted columns are decoded */
+            *flops = 2 * rowsOut * in * run->shortlistSize;
+            *bytes = rowsOut * ((in * run->shortlistSize + 1) / 2);
+        }
+        else {
+            stepWeightCost(step, rowsOut, flops, bytes);
+        }
+    }
+    else if (step->kernel == attentionStep) {
+        const TinyAISelfAttention *attention = layer->attention;
+        uint64_t                   hidden    = attention->params.hiddenDim;
+        uint64_t kvDim     = (uint64_t)attention->params.numKVHeads * attention->params.headDim;
+        uint64_t positions = attendedPositions(run, rowsIn, attention->params.windowSize);
+        uint64_t                   weights   = packedBytes(&attention->queryWeight) +
+                             packedBytes(&attention->keyWeight) +
+                             packedBytes(&attention->valueWeight) +
+                             packedBytes(&attention->outputWeight);
+
+        /* Four projections, then scores and the weighted sum over cached keys and values */
+        *flops = 4 * rowsIn * hidden * (hidden + kvDim) + 4 * positions * hidden;
+        /* Cached rows are read in their storage format */
+        const TinyAIKVCache *cache    = run->rowCaches ? run->rowCaches[0] : run->cache;
+        uint64_t             rowBytes = (cache ? cache->rowSize : kvDim) * sizeof(float);
+        *bytes = (run->rowCaches ? rowsIn : 1) * weights + 2 * positions * rowBytes;
+    }
+    else if (step->kernel == recurrentStep) {
+        /* Rows run one at a time, each reading the whole matrix */
+        *flops = 2 * rowsIn * (in + out) * out;
+        *bytes = rowsIn * packedBytes(&layer->weights);
+    }
+    else if (step->kernel == layerNormStep) {
+        *flops = 8 * rowsIn * in;
+        *bytes = layer->biases ? 2 * in * sizeof(float) : 0;
+    }
+}
+
+/**
+ * Widen a step's half-precision activations into floats
+ */
+static void widenActivations(const TinyAIPlanStep *step, float *out, const uint16_t *in,
+                             size_t count)
+{
+    if (step->bf16) {
+        tinyaiSimdConvertBF16ToFP32(out, in, (int)count);
+    }
+    else {
+        tinyaiSimdConvertFP16ToFP32(out, in, (int)count);
+    }
+}
+
+/**
+ * Round floats to a step's half-precision activations
+ */
+static void narrowActivations(const TinyAIPlanStep *step, uint16_t *out, const float *in,
+                              size_t count)
+{
+    if (step->bf16) {
+        tinyaiSimdConvertFP32ToBF16(out, in, (int)count);
+    }
+    else {
+        tinyaiSimdConvertFP32ToFP16(out, in, (int)count);
+    }
+}
+
+/**
+ * Run a step's kernel
+ *
+ * With half-precision activations the kernel runs on chunks of stageRows
+ * rows: each chunk is widened into the float input rows, run as rows of its
+ * own, and its output rounded into the half-precision buffer. A chunk of an
+ * attention step attends as if the rows before it were already cached; an
+ * output step keeping only the last row runs on that row alone.
+ */
+static int callStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows)
+{
+    if (step->stageRows == 0) {
+        return step->kernel(step, run, rows);
+    }
+
+    const TinyAILayer *layer = step->layer;
+    uint32_t           total = *rows;
+    uint32_t           first = step->kernel == outputStep && !run->allRows ? total - 1 : 0;
+    uint32_t           kept  = 0;
+    for (uint32_t start = first; start < total; start += step->stageRows) {
+        uint32_t      count = total - start < step->stageRows ? total - start : step->stageRows;
+        TinyAIPlanRun chunk = *run;
+        chunk.tokens        = run->tokens ? run->tokens + start : NULL;
+        chunk.embeddings =
+            run->embeddings ? run->embeddings + (size_t)start * layer->outputSize : NULL;
+        chunk.rowCaches = run->rowCaches ? run->rowCaches + start : NULL;
+        if (run->allRows && !step->output) {
+            chunk.logits = run->logits + (size_t)start * layer->outputSize;
+        }
+
+        if (step->halfInput && step->kernel != embeddingStep) {
+            widenActivations(step, step->input, step->halfInput + (size_t)start * layer->inputSize,
+                             (size_t)count * layer->inputSize);
+        }
+
+        /* The cache advances past a pass's rows only once the pass succeeds */
+        bool shifted = step->kernel == attentionStep && !run->rowCaches && run->cache;
+        if (shifted) {
+            run->cache->length += start;
+        }
+        int result = step->kernel(step, &chunk, &count);
+        if (shifted) {
+            run->cache->length -= start;
+        }
+        if (result != 0) {
+            return -1;
+        }
+
+        if (step->halfOutput) {
+            narrowActivations(step, step->halfOutput + (size_t)kept * layer->outputSize,
+                              step->output, (size_t)count * layer->outputSize);
+        }
+        kept += count;
+    }
+
+    *rows = kept;
+    return 0;
+}
+
+/**
+ * Run one step, adding its costs to the layer's profile entry
+ */
+static int profileStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows,
+                       TinyAILayerProfile *entry)
+{
+    uint32_t rowsIn = *rows;
+    uint64_t flops, bytes;
+
+    /* Attention costs depend on the cache length before the step */
+    stepCost(step, run, rowsIn, rowsIn, &flops, &bytes);
+
+    size_t   allocations = tinyaiAllocCount();
+    uint64_t start       = getTimeNs();
+    int      result      = callStep(step, run, rows);
+    uint64_t elapsed     = getTimeNs() - start;
+
+    if (step->kernel == outputStep) {
+        /* The output step may drop every row but the last */
+        stepCost(step, run, rowsIn, *rows, &flops, &bytes);
+    }
+
+    entry->calls++;
+    entry->rows += rowsIn;
+    entry->timeMs += (double)elapsed / 1e6;
+    entry->flops += flops;
+    entry->weightBytes += bytes;
+    entry->allocations += tinyaiAllocCount() - allocations;
+
+    return result;
+}
+
+/**
+ * Run one step on the threads chosen for it, profiling it when entry is set
+ */
+static int runStep(const TinyAIPlanStep *step, const TinyAIPlanRun *run, uint32_t *rows,
+                   TinyAILayerProfile *entry)
+{
+    TinyAIThreadPoolScope scope = {NULL, false};
+    if (step->serial) {
+        scope = tinyaiUseThreadPool(NULL);
+    }
+
+    int result = entry ? profileStep(step, run, rows, entry) : callStep(step, run, rows);
+
+    if (step->serial) {
+        tinyaiRestoreThreadPool(scope);
+    }
+    return result;
+}
+
+/**
+ * Run one autotuned step on each of its candidates, adding up their times
+ *
+ * The alternatives run first, starting from a different one every pass so
+ * none always finds the caches cold; the candidate the step runs on goes
+ * last so its output is the one the next step reads.
+ */
+static int tuneStep(const TinyAIPlanStep *step, TinyAIStepTuning *tuning, uint32_t pass,
+                    const TinyAIPlanRun *run, uint32_t *rows, TinyAILayerProfile *entry)
+{
+    TinyAIStepCandidate *current = NULL;
+
+    for (uint32_t n = 0; n < tuning->numCandidates; n++) {
+        TinyAIStepCandidate *candidate = &tuning->candidates[(pass + n) % tuning->numCandidates];
+        if (candidate->weightFormat == step->weightFormat && candidate->serial == step->serial) {
+            current = candidate;
+            continue;
+        }
+
+        TinyAIPlanStep trial = *step;
+        trial.weightFormat   = candidate->weightFormat;
+        trial.serial         = candidate->serial;
+        trial.csr            = NULL;
+        trial.bsr            = NULL;
+        if (candidate->weightFormat == TINYAI_WEIGHT_FORMAT_CSR_4BIT) {
+            trial.csr = step->csr ? step->csr : tuning->csr;
+        }
+        else if (candidate->weightFormat == TINYAI_WEIGHT_FORMAT_BSR) {
+            trial.bsr = step->bsr ? step->bsr : tuning->bsr;
+        }
+
+        uint32_t trialRows = *rows;
+        uint64_t start     = getTimeNs();
+        if (runStep(&trial, run, &trialRows, NULL) != 0) {
+            return -1;
+        }
+        candidate->timeNs += getTimeNs() - start;
+    }
+
+    uint64_t start  = getTimeNs();
+    int      result = runStep(step, run, rows, entry);
+    if (current) {
+        current->timeNs += getTimeNs() - start;
+    }
+    return result;
+}
+
+/* Trace span names of the layer types */
+static const char *const k_layerSpanNames[] = {"layer.embedding", "layer.dense",
+                                               "layer.rnn",       "layer.attention",
+                                               "layer.layernorm", "layer.output"};
+
+/**
+ * Walk a model's execution plan
+ *
+ * Attention steps attend over the positions already held in the cache(s)
+ * plus the given rows; the caller advances the caches afterwards. With
+ * allRows, logits holds [rows x vocab] logits, one row per input row, and
+ * the plan must write its logits directly.
+ */
+/**
+ * Run the exit head on the hidden state after a step, stopping the pass if it is confident
+ *
+ * On a stop, the head's logits are the pass's result and every skipped
+ * attention step stores the position's keys and values, projected from the
+ * exit hidden state. Otherwise the hidden state is put back for the next
+ * step. Runs that record exits only note the head's confidence and token.
+ */
+static int earlyExit(TinyAIModel *model, const TinyAIModelPlan *plan, const TinyAIPlanRun *run,
+                     uint32_t index, bool *stop)
+{
+    const TinyAIPlanStep *exitStep = &plan->steps[index];
+    size_t                width    = exitStep->layer->outputSize * sizeof(float);
+
+    /* The head's steps may write over the buffer holding the hidden state; its first step
+       reads the other ping-pong buffer */
+    const TinyAIPlanStep *headStep = &plan->steps[plan->headStep];
+    if (exitStep->halfOutput) {
+        widenActivations(exitStep, plan->exitHidden, exitStep->halfOutput,
+                         exitStep->layer->outputSize);
+        narrowActivations(headStep, (uint16_t *)headStep->halfInput, plan->exitHidden,
+                          exitStep->layer->outputSize);
+    }
+    else {
+        memcpy(plan->exitHidden, exitStep->output, width);
+        memcpy(plan->buffers[(plan->headStep + 1) % 2], plan->exitHidden, width);
+    }
+
+    uint32_t rows = 1;
+    for (uint32_t s = plan->headStep; s < plan->numSteps; s++) {
+        if (runStep(&plan->steps[s], run, &rows, NULL) != 0) {
+            return -1;
+        }
+    }
+
+    /* Confidence is the softmax probability of the most likely token */
+    int   vocab      = (int)plan->vocabSize;
+    int   token      = tinyaiSimdArgmax(run->logits, vocab);
+    float confidence = expf(run->logits[token] - tinyaiSimdLogSumExp(run->logits, vocab));
+
+    if (run->exitConfidence) {
+        run->exitConfidence[index] = confidence;
+        run->exitTokens[index]     = token;
+    }
+    else if (confidence >= model->exitThresholds[index]) {
+        for (uint32_t s = index + 1; s < plan->headStep; s++) {
+            const TinyAIPlanStep *skipped = &plan->steps[s];
+            if (skipped->kernel == attentionStep &&
+                tinyaiSelfAttentionStoreCached(skipped->layer->attention, run->cache,
+                                               skipped->attentionIndex, plan->exitHidden,
+                                               1) != 0) {
+                return -1;
+            }
+        }
+        *stop = true;
+        return 0;
+    }
+
+    if (exitStep->halfOutput) {
+        narrowActivations(exitStep, exitStep->halfOutput, plan->exitHidden,
+                          exitStep->layer->outputSize);
+    }
+    else {
+        memcpy(exitStep->output, plan->exitHidden, width);
+    }
+    return 0;
+}
+
+/**
+ * Pool the input rows of a step into one
+ *
+ * Half-precision rows are widened one at a time into the step's input rows.
+ */
+static void poolRows(const TinyAIPlanStep *step, uint32_t rows, int pooling, float *output)
+{
+    uint32_t width = step->layer->inputSize;
+
+    if (pooling == TINYAI_POOLING_LAST) {
+        if (step->halfInput) {
+            widenActivations(step, output, step->halfInput + (size_t)(rows - 1) * width, width);
+        }
+        else {
+            memcpy(output, step->input + (size_t)(rows - 1) * width, width * sizeof(float));
+        }
+        return;
+    }
+
+    memset(output, 0, width * sizeof(float));
+    for (uint32_t j = 0; j < rows; j++) {
+        const float *row = step->input + (size_t)j * width;
+        if (step->halfInput) {
+            widenActivations(step, step->input, step->halfInput + (size_t)j * width, width);
+            row = step->input;
+        }
+        tinyaiSimdVecScaleAdd(output, row, 1.0f / (float)rows, (int)width);
+    }
+}
+
+static int runModelPlan(TinyAIModel *model, const TinyAIPlanRun *run)
+{
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan || run->rows == 0 || run->rows > plan->maxRows ||
+        (run->allRows && !plan->directLogits)) {
+        return -1;
+    }
+
+    /* The shortlist applies when the final layer writes the logits itself */
+    TinyAIPlanRun active = *run;
+    if (model->shortlist && plan->directLogits) {
+        active.shortlist       = model->shortlist;
+        active.shortlistSize   = model->shortlistSize;
+        active.shortlistLogits = model->shortlistLogits;
+    }
+
+    /* Pooling stops before the final step, whose input it reduces */
+    uint32_t numSteps = run->pooled ? plan->numSteps - 1 : plan->numSteps;
+    if (numSteps == 0) {
+        return -1;
+    }
+
+    /* Decoding steps of one sequence may stop at an early exit; autotuning times whole
+       passes, and streamed weights would have to be requested for the head */
+    bool exits = model->exitThresholds && plan->exitHidden && run->rows == 1 &&
+                 !run->rowCaches && !run->allRows && !run->pooled && !model->loader &&
+                 (!plan->tuning || run->exitConfidence);
+
+    uint64_t forwardSpan = TINYAI_TRACE_BEGIN();
+    uint32_t rows        = run->rows;
+    for (uint32_t i = 0; i < numSteps; i++) {
+        /* Abandoned work stops at the next layer boundary */
+        if (tinyaiCancelled()) {
+            return -1;
+        }
+
+        const TinyAIPlanStep *step      = &plan->steps[i];
+        uint64_t              layerSpan = TINYAI_TRACE_BEGIN();
+
+        /* A streamed step runs on a copy of its layer pointing at the loaded data */
+        TinyAIPlanStep streamed;
+        TinyAILayer    layer;
+        bool           requested = model->loader && step->layer->weights.rows > 0;
+        if (requested) {
+            if (!tinyaiRequestLayer(model->loader, i)) {
+                return -1;
+            }
+            layer              = *step->layer;
+            layer.weights.data = (uint8_t *)tinyaiGetLoadedLayerWeights(model->loader, i);
+            streamed           = *step;
+            streamed.layer     = &layer;
+            step               = &streamed;
+        }
+
+        int                 result = -1;
+        TinyAILayerProfile *entry  = model->profile ? &model->profile[i] : NULL;
+        if (requested && !layer.weights.data) {
+            /* A budget-only loader has no data to run on */
+        }
+        else if (plan->tuning && plan->tuning[i].numCandidates > 0) {
+            result = tuneStep(step, &plan->tuning[i], plan->tunePasses, &active, &rows, entry);
+        }
+        else {
+            result = runStep(step, &active, &rows, entry);
+        }
+
+        if (requested) {
+            tinyaiReleaseLayer(model->loader, i);
+        }
+        if (result != 0) {
+            return -1;
+        }
+        TINYAI_TRACE_END_ARG(layerSpan,
+                             step->layer->type <= TINYAI_LAYER_OUTPUT
+                                 ? k_layerSpanNames[step->layer->type]
+                                 : "layer",
+                             i);
+
+        /* An exit that can never stop only runs its head to record it */
+        float threshold = exits ? model->exitThresholds[i] : -1.0f;
+        if (threshold >= 0.0f && i + 1 < plan->headStep &&
+            (threshold <= 1.0f || run->exitConfidence)) {
+            bool stop = false;
+            if (earlyExit(model, plan, &active, i, &stop) != 0) {
+                return -1;
+            }
+            if (stop) {
+                if (model->profile) {
+                    model->profile[i].exits++;
+                }
+                break;
+            }
+        }
+    }
+
+    /* Loops of the last layer skip their remaining ranges once cancelled */
+    if (tinyaiCancelled()) {
+        return -1;
+    }
+    if (model->profile) {
+        model->profilePasses++;
+    }
+    if (plan->tuning && --plan->tunePasses == 0) {
+        finishPlanTuning(plan);
+    }
+
+    if (run->pooled) {
+        poolRows(&plan->steps[numSteps], rows, run->pooling, run->pooled);
+    }
+    else if (!plan->directLogits) {
+        /* Logits are the leading vocabulary entries of the last row's output */
+        const TinyAIPlanStep *step = &plan->steps[plan->numSteps - 1];
+        if (step->halfOutput) {
+            widenActivations(step, run->logits,
+                             step->halfOutput + (size_t)(rows - 1) * step->layer->outputSize,
+                             plan->vocabSize);
+        }
+        else {
+            memcpy(run->logits, step->output + (rows - 1) * step->layer->outputSize,
+                   plan->vocabSize * sizeof(float));
+        }
+    }
+
+    TINYAI_TRACE_END_ARG(forwardSpan, "forward", run->rows);
+    return 0;
+}
+
+/**
+ * Forward pass over the given tokens of one sequence
+ *
+ * RNN models without recurrent layers only run their position-wise layers,
+ * over the last token or, with allPositions, over every token independently.
+ * Recurrent layers consume every token, carrying their hidden state in the
+ * cache; transformer layers see every token, attending over the cache.
+ */
+static int sequenceForward(TinyAIModel *model, TinyAIKVCache *cache, const int *tokens,
+                           int inputLength, float *logits, bool allPositions)
+{
+    TinyAIPlanRun run;
+    memset(&run, 0, sizeof(run));
+    run.tokens  = tokens;
+    run.rows    = (uint32_t)inputLength;
+    run.cache   = cache;
+    run.allRows = allPositions;
+    run.logits  = logits;
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan) {
+        return -1;
+    }
+
+    if (model->type == TINYAI_MODEL_TYPE_RNN && plan->stateSize == 0 && !allPositions) {
+        /* Without recurrent layers, the RNN output depends only on the newest token */
+        run.tokens = tokens + inputLength - 1;
+        run.rows   = 1;
+    }
+
+    return runModelPlan(model, &run);
+}
+
+/**
+ * Whether a model can decode several sequences in one batched step
+ *
+ * The plan must write logits straight to the per-row output; every step of
+ * an RNN plan is position-wise or keeps its state in the row's own cache.
+ */
+static bool batchDecodeSupported(TinyAIModel *model)
+{
+    TinyAIModelPlan *plan = modelPlan(model);
+    return plan && plan->directLogits;
+}
+
+/**
+ * Decode one new token for each of several sequences in a single pass
+ *
+ * Row b of every activation belongs to the sequence cached in caches[b].
+ * Embedding, dense and output layers run as one 4-bit GEMM over all rows,
+ * so each layer's weights are streamed once per step rather than once per
+ * sequence; attention layers attend each row over its own cache. The caller
+ * advances the caches afterwards. At most model->contextSize rows fit the
+ * activation buffers.
+ */
+static int batchedDecodeStep(TinyAIModel *model, TinyAIKVCache **caches, const int *tokens,
+                             uint32_t count, float *logits)
+{
+    TinyAIPlanRun run;
+    memset(&run, 0, sizeof(run));
+    run.tokens    = tokens;
+    run.rows      = count;
+    run.rowCaches = caches;
+    run.allRows   = true;
+    run.logits    = logits;
+
+    return runModelPlan(model, &run);
+}
+
+/**
+ * Input and output sizes of each projection of a layer an adapter can update (0 if none)
+ */
+static void layerAdapterSizes(const TinyAILayer *layer, uint32_t sizes[ADAPTER_SLOTS * 2])
+{
+    memset(sizes, 0, ADAPTER_SLOTS * 2 * sizeof(uint32_t));
+
+    if (layer->type == TINYAI_LAYER_DENSE || layer->type == TINYAI_LAYER_OUTPUT) {
+        sizes[TINYAI_ADAPTER_WEIGHTS * 2]     = layer->inputSize;
+        sizes[TINYAI_ADAPTER_WEIGHTS * 2 + 1] = layer->outputSize;
+    }
+    else if (layer->type == TINYAI_LAYER_ATTENTION && layer->attention) {
+        const TinyAIAttentionParams *params    = &layer->attention->params;
+        uint32_t                     hiddenDim = params->hiddenDim;
+        uint32_t                     kvDim     = params->numKVHeads * params->headDim;
+        uint32_t outputs[ADAPTER_SLOTS] = {hiddenDim, kvDim, kvDim, hiddenDim};
+        for (uint32_t p = 0; p < ADAPTER_SLOTS; p++) {
+            sizes[p * 2]     = hiddenDim;
+            sizes[p * 2 + 1] = outputs[p];
+        }
+    }
+}
+
+/**
+ * Check that every update of an adapter fits the projection it targets in a model
+ */
+static bool adapterFitsModel(const TinyAIAdapter *adapter, const TinyAIModel *model)
+{
+    if (adapter->layerCount != model->layerCount) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        uint32_t        sizes[ADAPTER_SLOTS * 2];
+        const uint32_t *expected = adapter->sizes + (size_t)i * ADAPTER_SLOTS * 2;
+        layerAdapterSizes(&model->layers[i], sizes);
+        for (uint32_t p = 0; p < ADAPTER_SLOTS; p++) {
+            if (adapter->deltas[i * ADAPTER_SLOTS + p].rank > 0 &&
+                (sizes[p * 2] != expected[p * 2] || sizes[p * 2 + 1] != expected[p * 2 + 1])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Point the layers and plan steps of a model at the updates of its active adapter
+ */
+static void bindModelAdapter(TinyAIModel *model)
+{
+    const TinyAIAdapter *adapter = model->adapter;
+
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        TinyAILayer *layer = &model->layers[i];
+        if (layer->attention) {
+            layer->attention->deltas = adapter ? &adapter->deltas[i * ADAPTER_SLOTS] : NULL;
+        }
+        if (model->plan && i < model->plan->numSteps) {
+            model->plan->steps[i].delta = adapterDelta(adapter, i, TINYAI_ADAPTER_WEIGHTS);
+        }
+    }
+}
+
+/**
+ * Attach self-attention weights to an attention layer
+ */
+int tinyaiSetLayerAttention(TinyAIModel *model, uint32_t layerIndex,
+                            TinyAISelfAttention *attention)
+{
+    if (!model || !attention || layerIndex >= model->layerCount) {
+        return -1;
+    }
+
+    TinyAILayer *layer = &model->layers[layerIndex];
+    if (layer->type != TINYAI_LAYER_ATTENTION ||
+        attention->params.hiddenDim != layer->inputSize ||
+        attention->params.seqLength < model->contextSize) {
+        return -1;
+    }
+
+    if (layer->attention) {
+        detachSnapshotAttention(model, layer->attention);
+        tinyaiDestroySelfAttention(layer->attention);
+        TINYAI_FREE(layer->attention);
+    }
+    layer->attention = attention;
+
+    /* The active adapter carries over if the new weights keep its sizes */
+    if (model->adapter && !adapterFitsModel(model->adapter, model)) {
+        model->adapter = NULL;
+    }
+    bindModelAdapter(model);
+
+    /* The plan and the private cache layout depend on the attention layers */
+    invalidateModelPlan(model);
+    tinyaiDestroyKVCache(model->scratchCache);
+    model->scratchCache = NULL;
+
+    /* Cached prefixes were computed with the old weights */
+    tinyaiPrefixCacheClear(model->prefixCache);
+
+    return 0;
+}
+
+/**
+ * Create a low-rank adapter for a model
+ */
+TinyAIAdapter *tinyaiCreateAdapter(const TinyAIModel *model, uint32_t rank, float alpha)
+{
+    if (!model || model->layerCount == 0 || rank == 0) {
+        return NULL;
+    }
+
+    TinyAIAdapter *adapter = (TinyAIAdapter *)TINYAI_MALLOC(sizeof(TinyAIAdapter));
+    if (!adapter) {
+        return NULL;
+    }
+
+    size_t slots        = (size_t)model->layerCount * ADAPTER_SLOTS;
+    adapter->layerCount = model->layerCount;
+    adapter->rank       = rank;
+    adapter->scale      = alpha / (float)rank;
+    adapter->deltas     = (TinyAILowRankDelta *)TINYAI_MALLOC(slots * sizeof(TinyAILowRankDelta));
+    adapter->sizes      = (uint32_t *)TINYAI_MALLOC(slots * 2 * sizeof(uint32_t));
+    if (!adapter->deltas || !adapter->sizes) {
+        TINYAI_FREE(adapter->deltas);
+        TINYAI_FREE(adapter->sizes);
+        TINYAI_FREE(adapter);
+        return NULL;
+    }
+
+    memset(adapter->deltas, 0, slots * sizeof(TinyAILowRankDelta));
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        layerAdapterSizes(&model->layers[i], adapter->sizes + (size_t)i * ADAPTER_SLOTS * 2);
+    }
+    return adapter;
+}
+
+/**
+ * Set the update of one projection of an adapter
+ */
+int tinyaiSetAdapterWeights(TinyAIAdapter *adapter, uint32_t layerIndex, uint32_t projection,
+                            const float *down, const float *up)
+{
+    if (!adapter || !down || !up || layerIndex >= adapter->layerCount ||
+        projection >= ADAPTER_SLOTS) {
+        return -1;
+    }
+
+    size_t   slot       = (size_t)layerIndex * ADAPTER_SLOTS + projection;
+    uint32_t inputSize  = adapter->sizes[slot * 2];
+    uint32_t outputSize = adapter->sizes[slot * 2 + 1];
+    if (inputSize == 0 || outputSize == 0) {
+        /* Not a projection of this layer */
+        return -1;
+    }
+
+    /* Both factors in one block, A first */
+    size_t downSize = (size_t)adapter->rank * inputSize;
+    size_t upSize   = (size_t)adapter->rank * outputSize;
+    float *data     = (float *)TINYAI_MALLOC((downSize + upSize) * sizeof(float));
+    if (!data) {
+        return -1;
+    }
+    memcpy(data, down, downSize * sizeof(float));
+    memcpy(data + downSize, up, upSize * sizeof(float));
+
+    TinyAILowRankDelta *delta = &adapter->deltas[slot];
+    TINYAI_FREE((void *)delta->down);
+    delta->down  = data;
+    delta->up    = data + downSize;
+    delta->rank  = adapter->rank;
+    delta->scale = adapter->scale;
+    return 0;
+}
+
+/**
+ * Destroy an adapter
+ */
+void tinyaiDestroyAdapter(TinyAIAdapter *adapter)
+{
+    if (!adapter) {
+        return;
+    }
+
+    for (size_t i = 0; i < (size_t)adapter->layerCount * ADAPTER_SLOTS; i++) {
+        TINYAI_FREE((void *)adapter->deltas[i].down);
+    }
+    TINYAI_FREE(adapter->deltas);
+    TINYAI_FREE(adapter->sizes);
+    TINYAI_FREE(adapter);
+}
+
+/**
+ * Make an adapter the active one of a model
+ */
+int tinyaiSetModelAdapter(TinyAIModel *model, const TinyAIAdapter *adapter)
+{
+    if (!model || (adapter && !adapterFitsModel(adapter, model))) {
+        return -1;
+    }
+    if (adapter == model->adapter) {
+        return 0;
+    }
+
+    model->adapter = adapter;
+    bindModelAdapter(model);
+
+    /* Cached prefixes were computed with the previous weights */
+    tinyaiPrefixCacheClear(model->prefixCache);
+    return 0;
+}
+
+/**
+ * Get the key/value cache layout of a model
+ *
+ * One cache slot per attention layer, at least one to track the position.
+ */
+static void modelCacheLayout(const TinyAIModel *model, TinyAIAttentionParams *params,
+                             uint32_t *numLayers, uint32_t *stateSize)
+{
+    memset(params, 0, sizeof(TinyAIAttentionParams));
+    params->seqLength = model->contextSize;
+    params->numHeads  = 1;
+    params->headDim   = model->hiddenSize;
+    params->hiddenDim = model->hiddenSize;
+
+    *numLayers = 0;
+    *stateSize = 0;
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        const TinyAILayer *layer = &model->layers[i];
+        if (layer->type == TINYAI_LAYER_ATTENTION && layer->attention) {
+            params->numHeads         = layer->attention->params.numHeads;
+            params->numKVHeads       = layer->attention->params.numKVHeads;
+            params->windowSize       = layer->attention->params.windowSize;
+            params->kvCachePrecision = layer->attention->params.kvCachePrecision;
+            params->headDim          = layer->attention->params.headDim;
+            params->hiddenDim        = layer->attention->params.hiddenDim;
+            (*numLayers)++;
+        }
+        else if (layer->type == TINYAI_LAYER_RNN && model->type == TINYAI_MODEL_TYPE_RNN) {
+            *stateSize += layer->outputSize;
+        }
+    }
+    if (*numLayers == 0) {
+        *numLayers = 1;
+    }
+}
+
+/**
+ * Create a key/value cache sized for a model
+ */
+TinyAIKVCache *tinyaiCreateModelKVCache(const TinyAIModel *model)
+{
+    if (!model) {
+        return NULL;
+    }
+
+    TinyAIAttentionParams params;
+    uint32_t              numLayers, stateSize;
+    modelCacheLayout(model, &params, &numLayers, &stateSize);
+
+    TinyAIKVCache *cache = tinyaiCreateKVCache(numLayers, &params);
+    if (cache && stateSize > 0 && tinyaiKVCacheAddState(cache, stateSize) != 0) {
+        tinyaiDestroyKVCache(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+/**
+ * Create a pool of key/value cache blocks for a model's paged caches
+ */
+TinyAIKVBlockPool *tinyaiCreateModelKVBlockPool(const TinyAIModel *model, uint32_t maxBlocks,
+                                                TinyAIAdvancedMemoryPool *memory)
+{
+    if (!model) {
+        return NULL;
+    }
+
+    TinyAIAttentionParams params;
+    uint32_t              numLayers, stateSize;
+    modelCacheLayout(model, &params, &numLayers, &stateSize);
+
+    return tinyaiCreateKVBlockPool(numLayers, &params, maxBlocks, memory);
+}
+
+/**
+ * Create a paged key/value cache for a model
+ */
+TinyAIKVCache *tinyaiCreateModelPagedKVCache(const TinyAIModel *model, TinyAIKVBlockPool *pool)
+{
+    if (!model || !pool) {
+        return NULL;
+    }
+
+    TinyAIAttentionParams params;
+    uint32_t              numLayers, stateSize;
+    modelCacheLayout(model, &params, &numLayers, &stateSize);
+
+    TinyAIKVCache *cache = tinyaiCreatePagedKVCache(pool);
+    if (cache && (cache->numLayers != numLayers || cache->headDim != params.headDim ||
+                  cache->precision != params.kvCachePrecision ||
+                  (stateSize > 0 && tinyaiKVCacheAddState(cache, stateSize) != 0))) {
+        tinyaiDestroyKVCache(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+/**
+ * Reset the private cache of a one-shot pass, creating it on first use
+ *
+ * Attention and recurrent layers need a cache even for a one-shot pass.
+ */
+static int resetScratchCache(TinyAIModel *model, const TinyAIModelPlan *plan)
+{
+    if (!plan->usesAttention && plan->stateSize == 0) {
+        return 0;
+    }
+
+    if (!model->scratchCache) {
+        model->scratchCache = tinyaiCreateModelKVCache(model);
+        if (!model->scratchCache) {
+            return -1;
+        }
+    }
+    tinyaiResetKVCache(model->scratchCache);
+    return 0;
+}
+
+/**
+ * Perform a single forward pass through the model
+ */
+int tinyaiModelForward(TinyAIModel *model, const int *input, int inputLength, float *output)
+{
+    if (!model || !input || !output || inputLength <= 0) {
+        return -1;
+    }
+
+    /* Context limitation */
+    if ((uint32_t)inputLength > model->contextSize) {
+        inputLength = (int)model->contextSize;
+    }
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan || resetScratchCache(model, plan) != 0) {
+        return -1;
+    }
+
+    return sequenceForward(model, model->scratchCache, input, inputLength, output, false);
+}
+
+/**
+ * Get the size of a model's text embeddings
+ */
+uint32_t tinyaiGetModelEmbeddingSize(const TinyAIModel *model)
+{
+    if (!model || model->layerCount == 0) {
+        return 0;
+    }
+    return model->layers[model->layerCount - 1].inputSize;
+}
+
+/**
+ * Embed texts already tokenized into one packed array
+ */
+static int embedTokenizedTexts(TinyAIModel *model, TinyAIModelPlan *plan, const int *tokens,
+                               const int *offsets, uint32_t count, int pooling, bool normalize,
+                               float *embeddings)
+{
+    uint32_t size = tinyaiGetModelEmbeddingSize(model);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t length = (uint32_t)(offsets[i + 1] - offsets[i]);
+        float   *output = embeddings + (size_t)i * size;
+        if (length == 0 || resetScratchCache(model, plan) != 0) {
+            return -1;
+        }
+
+        TinyAIPlanRun run;
+        memset(&run, 0, sizeof(run));
+        run.tokens  = tokens + offsets[i];
+        run.rows    = length < model->contextSize ? length : model->contextSize;
+        run.cache   = model->scratchCache;
+        run.pooled  = output;
+        run.pooling = pooling;
+        if (runModelPlan(model, &run) != 0) {
+            return -1;
+        }
+
+        float norm = sqrtf(tinyaiSimdDot(output, output, (int)size));
+        if (normalize && norm > 0.0f) {
+            for (uint32_t k = 0; k < size; k++) {
+                output[k] /= norm;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Embed a batch of texts
+ */
+int tinyaiEmbedTextBatch(TinyAIModel *model, const char *const *texts, uint32_t count,
+                         int pooling, bool normalize, float *embeddings)
+{
+    if (!model || !texts || !embeddings || count == 0 || count > INT32_MAX - 1 ||
+        (pooling != TINYAI_POOLING_MEAN && pooling != TINYAI_POOLING_LAST)) {
+        return -1;
+    }
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan || plan->numSteps < 2) {
+        return -1;
+    }
+
+    /* BPE never yields more tokens than bytes */
+    size_t capacity = 1;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!texts[i]) {
+            return -1;
+        }
+        capacity += strlen(texts[i]) + 1;
+    }
+    if (capacity > INT32_MAX) {
+        return -1;
+    }
+
+    int *tokens  = (int *)TINYAI_MALLOC(capacity * sizeof(int));
+    int *offsets = (int *)TINYAI_MALLOC(((size_t)count + 1) * sizeof(int));
+    int  result  = -1;
+    if (tokens && offsets &&
+        tinyaiEncodeTextBatch(model->tokenizer, texts, (int)count, tokens, (int)capacity,
+                              offsets) >= 0) {
+        result = embedTokenizedTexts(model, plan, tokens, offsets, count, pooling, normalize,
+                                     embeddings);
+    }
+
+    TINYAI_FREE(tokens);
+    TINYAI_FREE(offsets);
+    return result;
+}
+
+/**
+ * Perform an incremental forward pass using a key/value cache
+ */
+int tinyaiModelForwardCached(TinyAIModel *model, TinyAIKVCache *cache, const int *input,
+                             int inputLength, float *output)
+{
+    if (!model || !cache || !input || !output || inputLength <= 0 ||
+        !tinyaiKVCacheFits(cache, (uint32_t)inputLength)) {
+        return -1;
+    }
+
+    /* Ring caches take inputs longer than the activation buffers in context-sized chunks */
+    while (inputLength > 0) {
+        int chunk  = inputLength < (int)model->contextSize ? inputLength : (int)model->contextSize;
+        int result = sequenceForward(model, cache, input, chunk, output, false);
+        if (result != 0) {
+            return result;
+        }
+        if (tinyaiKVCacheAdvance(cache, (uint32_t)chunk) != 0) {
+            return -1;
+        }
+        input += chunk;
+        inputLength -= chunk;
+    }
+
+    return 0;
+}
+
+/**
+ * Perform an incremental forward pass over embedding rows using a key/value cache
+ */
+int tinyaiModelForwardCachedEmbeddings(TinyAIModel *model, TinyAIKVCache *cache,
+                                       const float *embeddings, int count, float *output)
+{
+    if (!model || !cache || !embeddings || !output || count <= 0 ||
+        !tinyaiKVCacheFits(cache, (uint32_t)count)) {
+        return -1;
+    }
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan || plan->steps[0].kernel != embeddingStep) {
+        return -1;
+    }
+    uint32_t embedDim = plan->steps[0].layer->outputSize;
+
+    /* Same chunking as tinyaiModelForwardCached */
+    while (count > 0) {
+        int chunk = count < (int)model->contextSize ? count : (int)model->contextSize;
+
+        TinyAIPlanRun run;
+        memset(&run, 0, sizeof(run));
+        run.embeddings = embeddings;
+        run.rows       = (uint32_t)chunk;
+        run.cache      = cache;
+        run.logits     = output;
+
+        if (runModelPlan(model, &run) != 0 || tinyaiKVCacheAdvance(cache, (uint32_t)chunk) != 0) {
+            return -1;
+        }
+        embeddings += (size_t)chunk * embedDim;
+        count -= chunk;
+    }
+
+    return 0;
+}
+
+/**
+ * Sample the next token using caller-provided scratch buffers
+ *
+ * probs holds vocabSize floats, indices vocabSize entries.
+ */
+static int sampleTokenWithScratch(const float *output, int vocabSize,
+                                  const TinyAIGenerationParams *params, float *probs,
+                                  uint32_t *indices)
+{
+    /* Convert to probabilities using softmax at the sampling temperature */
+    softmax(probs, output, vocabSize, params->temperature);
+
+    /* Sample token based on method */
+    int token;
+
+    switch (params->samplingMethod) {
+    case TINYAI_SAMPLING_GREEDY:
+        /* Choose highest probability token */
+        token = tinyaiSimdArgmax(probs, vocabSize);
+        break;
+
+    case TINYAI_SAMPLING_TOP_K:
+        token = sampleTopK(probs, vocabSize, params->topK, indices);
+        break;
+
+    case TINYAI_SAMPLING_TOP_P:
+        token = sampleTopP(probs, vocabSize, params->topP, indices);
+        break;
+
+    case TINYAI_SAMPLING_TEMPERATURE:
+        /* Already applied temperature, sample directly */
         {
-            /* Embedding layer */
-            float *embeddings = model->activations[model->activeBuffer];
-            memset(embeddings, 0, inputLength * model->hiddenSize * sizeof(float));
-
-            /* Apply the model layers */
-            for (uint32_t i = 0; i < model->layerCount; i++) {
-                TinyAILayer *layer = &model->layers[i];
-
-                /* Flip activation buffers */
-                model->activeBuffer = 1 - model->activeBuffer;
-                float *input        = model->activations[1 - model->activeBuffer];
-                float *output       = model->activations[model->activeBuffer];
-
-                /* Apply layer based on type */
-                switch (layer->type) {
-                case TINYAI_LAYER_EMBEDDING:
-                    /* Apply token embeddings */
-                    {
-                        TinyAIMatrixFP32 *matrix = tinyaiDequantize4bitToFP32(&layer->weights);
-
-                        if (!matrix) {
-                            return -1;
-                        }
-
-                        /* Embed each token */
-                        for (int j = 0; j < inputLength; j++) {
-                            int token = input[j];
-
-                            /* Check token range */
-                            if (token < 0 || token >= model->tokenizer->tokenCount) {
-                                token = TINYAI_TOKEN_UNKNOWN;
-                            }
-
-                            /* Copy embedding for this token */
-                            memcpy(output + j * layer->outputSize,
-                                   matrix->data + token * layer->outputSize,
-                                   layer->outputSize * sizeof(float));
-                        }
-
-                        tinyaiDestroyMatrixFP32(matrix);
+            float r      = randomFloat();
+            float cumSum = 0.0f;
+
+            token = 0; /* Default */
+
+            for (int i = 0; i < vocabSize; i++) {
+                cumSum += probs[i];
+                if (r < cumSum) {
+                    token = i;
+                    break;
+                }
+            }
+        }
+        break;
+
+    default:
+        /* Unknown sampling method, use greedy */
+        token = tinyaiSimdArgmax(probs, vocabSize);
+        break;
+    }
+
+    return token;
+}
+
+static int compareTokenIds(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Sort the most recent tokens of a sequence held in two parts
+ *
+ * @return Number of tokens written to sorted, at most vocabSize
+ */
+static uint32_t sortTokenWindow(const int *prefix, int prefixLength, const int *tokens, int count,
+                                int window, uint32_t vocabSize, uint32_t *sorted)
+{
+    int total = prefixLength + count;
+    int take  = window > 0 && window < total ? window : total;
+    if (take > (int)vocabSize) {
+        take = (int)vocabSize;
+    }
+
+    uint32_t length = 0;
+    for (int i = total - take; i < total; i++) {
+        int token = i < prefixLength ? prefix[i] : tokens[i - prefixLength];
+        if (token >= 0 && (uint32_t)token < vocabSize) {
+            sorted[length++] = (uint32_t)token;
+        }
+    }
+    qsort(sorted, length, sizeof(uint32_t), compareTokenIds);
+    return length;
+}
+
+/**
+ * Apply the parameters' logit processors in place
+ *
+ * The sequence so far is prefix followed by tokens. Penalties visit each
+ * distinct token of their window once, from a sorted copy in scratch
+ * (vocabSize entries) shared by consecutive penalties over the same window,
+ * and biases and bans visit only their listed tokens, so no step scales
+ * with the vocabulary.
+ */
+static void applyLogitProcessors(const TinyAIGenerationParams *params, float *logits,
+                                 uint32_t vocabSize, const int *prefix, int prefixLength,
+                                 const int *tokens, int count, uint32_t *scratch)
+{
+    uint32_t sortedLength = 0;
+    int      sortedWindow = -1; /* Window held sorted in scratch (-1 for none) */
+
+    for (int p = 0; p < params->processorCount; p++) {
+        const TinyAILogitProcessor *processor = &params->processors[p];
+
+        if (processor->type == TINYAI_LOGIT_BIAS || processor->type == TINYAI_LOGIT_BAN) {
+            for (int i = 0; i < processor->tokenCount; i++) {
+                int token = processor->tokens[i];
+                if (token < 0 || (uint32_t)token >= vocabSize) {
+                    continue;
+                }
+                logits[token] = processor->type == TINYAI_LOGIT_BAN
+                                    ? -INFINITY
+                                    : logits[token] + processor->biases[i];
+            }
+            continue;
+        }
+        if (processor->type > TINYAI_LOGIT_FREQUENCY_PENALTY) {
+            continue; /* Unknown processor */
+        }
+
+        if (sortedWindow != processor->window) {
+            sortedLength = sortTokenWindow(prefix, prefixLength, tokens, count, processor->window,
+                                           vocabSize, scratch);
+            sortedWindow = processor->window;
+        }
+        for (uint32_t i = 0; i < sortedLength;) {
+            uint32_t token = scratch[i];
+            uint32_t run   = 1;
+            while (i + run < sortedLength && scratch[i + run] == token) {
+                run++;
+            }
+            i += run;
+
+            float *logit = &logits[token];
+            if (processor->type == TINYAI_LOGIT_REPETITION_PENALTY) {
+                *logit = *logit > 0.0f ? *logit / processor->value : *logit * processor->value;
+            }
+            else if (processor->type == TINYAI_LOGIT_PRESENCE_PENALTY) {
+                *logit -= processor->value;
+            }
+            else {
+                *logit -= processor->value * (float)run;
+            }
+        }
+    }
+}
+
+/**
+ * Sample from logits after processing and masking them in place
+ *
+ * The sequence so far is prefix followed by tokens; penalty processors
+ * look at it. Steps *grammarState past the sampled token. Should sampling
+ * land on a token the grammar excludes (rounding in a cumulative sum), the
+ * likeliest allowed token is taken instead; when the grammar allows
+ * nothing, generation ends.
+ */
+static int sampleProcessedToken(float *logits, int vocabSize, const TinyAIGenerationParams *params,
+                                const int *prefix, int prefixLength, const int *tokens, int count,
+                                uint32_t *grammarState, float *probs, uint32_t *indices)
+{
+    if (params->processors && params->processorCount > 0) {
+        applyLogitProcessors(params, logits, (uint32_t)vocabSize, prefix, prefixLength, tokens,
+                             count, indices);
+    }
+
+    const TinyAIGrammar *grammar = params->grammar;
+    if (!grammar) {
+        return sampleTokenWithScratch(logits, vocabSize, params, probs, indices);
+    }
+    if (tinyaiGrammarMaskLogits(grammar, *grammarState, logits, (uint32_t)vocabSize) == 0) {
+        return TINYAI_TOKEN_EOS;
+    }
+
+    int token = sampleTokenWithScratch(logits, vocabSize, params, probs, indices);
+    if (!tinyaiGrammarAllows(grammar, *grammarState, token)) {
+        token = tinyaiSimdArgmax(logits, vocabSize);
+    }
+    if (token != TINYAI_TOKEN_EOS) {
+        *grammarState = (uint32_t)tinyaiGrammarAdvance(grammar, *grammarState, token);
+    }
+    return token;
+}
+
+/**
+ * Sample the next token from output probabilities
+ */
+int tinyaiSampleToken(const float *output, int vocabSize, const TinyAIGenerationParams *params)
+{
+    return tinyaiSampleTokenConstrained(output, vocabSize, params,
+                                        params ? tinyaiGrammarStartState(params->grammar) : 0);
+}
+
+/**
+ * Sample the next token allowed by the parameters' grammar in a state
+ */
+int tinyaiSampleTokenConstrained(const float *output, int vocabSize,
+                                 const TinyAIGenerationParams *params, uint32_t grammarState)
+{
+    if (!output || !params || vocabSize <= 0) {
+        return 0; /* Default to first token on error */
+    }
+
+    /* Allocate all sampling scratch in one block, with a copy of the logits to modify */
+    bool   modified    = params->grammar || (params->processors && params->processorCount > 0);
+    size_t scratchSize = vocabSize * ((modified ? 2 : 1) * sizeof(float) + sizeof(uint32_t));
+    float *scratch     = (float *)TINYAI_MALLOC(scratchSize);
+    if (!scratch) {
+        return 0; /* Default to first token on error */
+    }
+
+    int token;
+    if (modified) {
+        float *logits = scratch + 2 * vocabSize;
+        memcpy(logits, output, vocabSize * sizeof(float));
+        token = sampleProcessedToken(logits, vocabSize, params, params->promptTokens,
+                                     params->promptTokens ? params->promptLength : 0, NULL, 0,
+                                     &grammarState, scratch, (uint32_t *)(scratch + vocabSize));
+    }
+    else {
+        token = sampleTokenWithScratch(output, vocabSize, params, scratch,
+                                       (uint32_t *)(scratch + vocabSize));
+    }
+
+    TINYAI_FREE(scratch);
+
+    return token;
+}
+
+/**
+ * Compute logits for the token following tokens[0..numTokens)
+ *
+ * With a cache, only the tokens not yet fed to the model are processed.
+ * When they would overflow the context window, the cache is rebuilt from
+ * the most recent half window so that rebuilds stay infrequent.
+ */
+static int nextTokenLogits(TinyAIModel *model, TinyAIKVCache *cache, const int *tokens,
+                           int numTokens, int *fedTokens, float *logits)
+{
+    if (!cache) {
+        /* Full recomputation over the trailing context window */
+        int contextSize = numTokens;
+        if (contextSize > (int)model->contextSize) {
+            contextSize = model->contextSize;
+        }
+        return tinyaiModelForward(model, tokens + numTokens - contextSize, contextSize, logits);
+    }
+
+    int pending = numTokens - *fedTokens;
+    if (!tinyaiKVCacheFits(cache, (uint32_t)pending)) {
+        int keep = pending > (int)cache->maxSeqLength ? (int)cache->maxSeqLength
+                                                       : (int)cache->maxSeqLength / 2;
+        if (keep < 1) {
+            keep = 1;
+        }
+
+        tinyaiResetKVCache(cache);
+        *fedTokens = numTokens - keep;
+        pending    = keep;
+    }
+
+    int result = tinyaiModelForwardCached(model, cache, tokens + *fedTokens, pending, logits);
+    if (result == 0) {
+        *fedTokens = numTokens;
+    }
+
+    return result;
+}
+
+/**
+ * Create a generation workspace sized for a model
+ */
+TinyAIGenerationWorkspace *tinyaiCreateGenerationWorkspace(const TinyAIModel *model)
+{
+    if (!model || !model->tokenizer || model->tokenizer->tokenCount <= 0) {
+        return NULL;
+    }
+
+    TinyAIGenerationWorkspace *workspace =
+        (TinyAIGenerationWorkspace *)TINYAI_MALLOC(sizeof(TinyAIGenerationWorkspace));
+    if (!workspace) {
+        return NULL;
+    }
+
+    uint32_t vocabSize     = model->tokenizer->tokenCount;
+    workspace->vocabSize   = vocabSize;
+    workspace->logits      = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    workspace->probs       = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    workspace->sortScratch = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    workspace->indices     = (uint32_t *)TINYAI_MALLOC(vocabSize * sizeof(uint32_t));
+
+    /* Without a cache, generation falls back to full recomputation */
+    workspace->cache = tinyaiCreateModelKVCache(model);
+
+    if (!workspace->logits || !workspace->probs || !workspace->sortScratch ||
+        !workspace->indices) {
+        tinyaiDestroyGenerationWorkspace(workspace);
+        return NULL;
+    }
+
+    return workspace;
+}
+
+/**
+ * Destroy a generation workspace
+ */
+void tinyaiDestroyGenerationWorkspace(TinyAIGenerationWorkspace *workspace)
+{
+    if (!workspace) {
+        return;
+    }
+
+    if (workspace->logits)
+        TINYAI_FREE(workspace->logits);
+    if (workspace->probs)
+        TINYAI_FREE(workspace->probs);
+    if (workspace->sortScratch)
+        TINYAI_FREE(workspace->sortScratch);
+    if (workspace->indices)
+        TINYAI_FREE(workspace->indices);
+    tinyaiDestroyKVCache(workspace->cache);
+
+    TINYAI_FREE(workspace);
+}
+
+/**
+ * Restrict the logits a model computes to a set of candidate tokens
+ */
+int tinyaiSetOutputShortlist(TinyAIModel *model, const int *tokens, uint32_t count)
+{
+    if (!model || (count > 0 && !tokens)) {
+        return -1;
+    }
+
+    uint32_t vocabSize = model->tokenizer->tokenCount;
+    uint32_t size      = 0;
+    uint8_t *keep      = NULL;
+
+    if (count > 0) {
+        /* Deduplicate and sort through a membership mask; EOS always stays reachable */
+        keep = (uint8_t *)TINYAI_MALLOC(vocabSize);
+        if (!keep || TINYAI_TOKEN_EOS >= vocabSize) {
+            TINYAI_FREE(keep);
+            return -1;
+        }
+        memset(keep, 0, vocabSize);
+        keep[TINYAI_TOKEN_EOS] = 1;
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (tokens[i] < 0 || (uint32_t)tokens[i] >= vocabSize) {
+                TINYAI_FREE(keep);
+                return -1;
+            }
+            keep[tokens[i]] = 1;
+        }
+        for (uint32_t t = 0; t < vocabSize; t++) {
+            size += keep[t];
+        }
+    }
+
+    uint32_t *shortlist = NULL;
+    float    *logits    = NULL;
+    if (size > 0) {
+        shortlist = (uint32_t *)TINYAI_MALLOC(size * sizeof(uint32_t));
+        logits    = (float *)TINYAI_MALLOC(size * sizeof(float));
+        if (!shortlist || !logits) {
+            TINYAI_FREE(shortlist);
+            TINYAI_FREE(logits);
+            TINYAI_FREE(keep);
+            return -1;
+        }
+
+        uint32_t n = 0;
+        for (uint32_t t = 0; t < vocabSize; t++) {
+            if (keep[t]) {
+                shortlist[n++] = t;
+            }
+        }
+        TINYAI_FREE(keep);
+    }
+
+    if (model->shortlist) {
+        TINYAI_FREE(model->shortlist);
+        TINYAI_FREE(model->shortlistLogits);
+    }
+    model->shortlist       = shortlist;
+    model->shortlistLogits = logits;
+    model->shortlistSize   = size;
+
+    /* Cached prefixes hold logits computed under the old shortlist */
+    tinyaiPrefixCacheClear(model->prefixCache);
+
+    return 0;
+}
+
+/**
+ * Restrict a model's logits to the most frequent tokens plus extra candidates
+ */
+int tinyaiSetFrequencyShortlist(TinyAIModel *model, uint32_t count, const int *extraTokens,
+                                uint32_t numExtra)
+{
+    if (!model || !model->tokenizer->frequencies || (numExtra > 0 && !extraTokens)) {
+        return -1;
+    }
+
+    uint32_t vocabSize = model->tokenizer->tokenCount;
+    if (count > vocabSize) {
+        count = vocabSize;
+    }
+
+    float *frequencies = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    int   *candidates  = (int *)TINYAI_MALLOC((count + numExtra + 1) * sizeof(int));
+    if (!frequencies || !candidates) {
+        TINYAI_FREE(frequencies);
+        TINYAI_FREE(candidates);
+        return -1;
+    }
+
+    /* Rank tokens with the top-K heap used for sampling */
+    for (uint32_t t = 0; t < vocabSize; t++) {
+        frequencies[t] = (float)model->tokenizer->frequencies[t];
+    }
+    selectTopK(frequencies, vocabSize, count, (uint32_t *)candidates);
+    if (numExtra > 0) {
+        memcpy(candidates + count, extraTokens, numExtra * sizeof(int));
+    }
+
+    int result = tinyaiSetOutputShortlist(model, candidates, count + numExtra);
+
+    TINYAI_FREE(frequencies);
+    TINYAI_FREE(candidates);
+    return result;
+}
+
+/**
+ * Set or remove the early exit after a layer
+ */
+int tinyaiSetModelEarlyExit(TinyAIModel *model, uint32_t layerIndex, float threshold)
+{
+    if (!model || layerIndex >= model->layerCount || isnan(threshold)) {
+        return -1;
+    }
+
+    if (threshold < 0.0f) {
+        if (!model->exitThresholds) {
+            return 0;
+        }
+        model->exitThresholds[layerIndex] = -1.0f;
+
+        /* Passes skip the exit checks entirely once no exit is left */
+        for (uint32_t i = 0; i < model->layerCount; i++) {
+            if (model->exitThresholds[i] >= 0.0f) {
+                return 0;
+            }
+        }
+        TINYAI_FREE(model->exitThresholds);
+        model->exitThresholds = NULL;
+        return 0;
+    }
+
+    if (!canExitAfter(model, layerIndex)) {
+        return -1;
+    }
+    if (!model->exitThresholds) {
+        model->exitThresholds = (float *)TINYAI_MALLOC(model->layerCount * sizeof(float));
+        if (!model->exitThresholds) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < model->layerCount; i++) {
+            model->exitThresholds[i] = -1.0f;
+        }
+    }
+    model->exitThresholds[layerIndex] = threshold;
+    return 0;
+}
+
+/* Head confidence at an exit and whether its token matched the full model's */
+typedef struct {
+    float confidence;
+    bool  agrees;
+} TinyAIExitSample;
+
+static int compareExitSamples(const void *a, const void *b)
+{
+    float x = ((const TinyAIExitSample *)a)->confidence;
+    float y = ((const TinyAIExitSample *)b)->confidence;
+    return (x < y) - (x > y);
+}
+
+/**
+ * Lowest threshold whose exited samples agree at least the given fraction of the time
+ *
+ * Sorts the samples by descending confidence; a threshold stops on every
+ * sample at or above it, so only the ends of runs of equal confidence count.
+ */
+static float exitThreshold(TinyAIExitSample *samples, int count, float agreement)
+{
+    qsort(samples, (size_t)count, sizeof(TinyAIExitSample), compareExitSamples);
+
+    float threshold = 2.0f;
+    int   agreed    = 0;
+    for (int n = 0; n < count; n++) {
+        agreed += samples[n].agrees;
+        if (n + 1 < count && samples[n + 1].confidence == samples[n].confidence) {
+            continue;
+        }
+        if ((float)agreed >= agreement * (float)(n + 1)) {
+            threshold = samples[n].confidence;
+        }
+    }
+    return threshold;
+}
+
+/**
+ * Calibrate the early-exit thresholds of a model on representative tokens
+ */
+int tinyaiCalibrateModelEarlyExit(TinyAIModel *model, const int *tokens, int count,
+                                  float agreement)
+{
+    if (!model || !tokens || count <= 0 || !model->exitThresholds || model->loader ||
+        !(agreement >= 0.0f && agreement <= 1.0f)) {
+        return -1;
+    }
+
+    TinyAIModelPlan *plan = modelPlan(model);
+    if (!plan || !plan->exitHidden) {
+        return -1;
+    }
+
+    uint32_t          layers     = model->layerCount;
+    TinyAIKVCache    *cache      = tinyaiCreateModelKVCache(model);
+    float            *logits     = (float *)TINYAI_MALLOC(plan->vocabSize * sizeof(float));
+    float            *confidence = (float *)TINYAI_MALLOC(layers * sizeof(float));
+    int              *exitTokens = (int *)TINYAI_MALLOC(layers * sizeof(int));
+    TinyAIExitSample *samples    = (TinyAIExitSample *)TINYAI_MALLOC((size_t)layers * count *
+                                                                    sizeof(TinyAIExitSample));
+    int               result     = -1;
+    if (!cache || !logits || !confidence || !exitTokens || !samples) {
+        goto cleanup;
+    }
+
+    /* Every pass runs every layer, probing each exit's head on the way */
+    for (int p = 0; p < count; p++) {
+        if (!tinyaiKVCacheFits(cache, 1)) {
+            tinyaiResetKVCache(cache);
+        }
+
+        TinyAIPlanRun run;
+        memset(&run, 0, sizeof(run));
+        run.tokens         = &tokens[p];
+        run.rows           = 1;
+        run.cache          = cache;
+        run.logits         = logits;
+        run.exitConfidence = confidence;
+        run.exitTokens     = exitTokens;
+        for (uint32_t l = 0; l < layers; l++) {
+            exitTokens[l] = -1;
+        }
+
+        if (runModelPlan(model, &run) != 0 || tinyaiKVCacheAdvance(cache, 1) != 0) {
+            goto cleanup;
+        }
+
+        int token = tinyaiSimdArgmax(logits, (int)plan->vocabSize);
+        for (uint32_t l = 0; l < layers; l++) {
+            samples[(size_t)l * count + p].confidence = confidence[l];
+            samples[(size_t)l * count + p].agrees     = exitTokens[l] == token;
+        }
+    }
+
+    for (uint32_t l = 0; l < layers; l++) {
+        if (model->exitThresholds[l] >= 0.0f) {
+            model->exitThresholds[l] =
+                exitThreshold(&samples[(size_t)l * count], count, agreement);
+        }
+    }
+    result = 0;
+
+cleanup:
+    tinyaiDestroyKVCache(cache);
+    TINYAI_FREE(logits);
+    TINYAI_FREE(confidence);
+    TINYAI_FREE(exitTokens);
+    TINYAI_FREE(samples);
+    return result;
+}
+
+/**
+ * Enable or disable per-layer profiling
+ */
+int tinyaiEnableModelProfiling(TinyAIModel *model, bool enable)
+{
+    if (!model) {
+        return -1;
+    }
+
+    if (model->profile) {
+        TINYAI_FREE(model->profile);
+        model->profile       = NULL;
+        model->profileLayers = 0;
+    }
+    model->profilePasses = 0;
+
+    if (!enable) {
+        return 0;
+    }
+    if (model->layerCount == 0) {
+        return -1;
+    }
+
+    model->profile =
+        (TinyAILayerProfile *)TINYAI_MALLOC(model->layerCount * sizeof(TinyAILayerProfile));
+    if (!model->profile) {
+        return -1;
+    }
+    model->profileLayers = model->layerCount;
+    tinyaiResetModelProfile(model);
+
+    return 0;
+}
+
+/**
+ * Get the per-layer profile
+ */
+const TinyAILayerProfile *tinyaiGetModelProfile(const TinyAIModel *model, uint32_t *layerCount)
+{
+    if (layerCount) {
+        *layerCount = (model && model->profile) ? model->profileLayers : 0;
+    }
+    return model ? model->profile : NULL;
+}
+
+/**
+ * Clear the per-layer profile
+ */
+void tinyaiResetModelProfile(TinyAIModel *model)
+{
+    if (!model || !model->profile) {
+        return;
+    }
+
+    memset(model->profile, 0, model->profileLayers * sizeof(TinyAILayerProfile));
+    for (uint32_t i = 0; i < model->profileLayers; i++) {
+        model->profile[i].type = model->layers[i].type;
+    }
+    model->profilePasses = 0;
+}
+
+/**
+ * Record the profile as a performance analysis' current metrics
+ */
+int tinyaiExportModelProfile(const TinyAIModel *model, TinyAIPerformanceAnalysis *analysis)
+{
+    if (!model || !model->profile || !analysis) {
+        return -1;
+    }
+
+    TinyAIPerformanceMetrics metrics = tinyaiGetPerformanceMetrics(analysis);
+    double                   timeMs  = 0.0;
+    uint64_t                 bytes   = 0;
+    for (uint32_t i = 0; i < model->profileLayers; i++) {
+        timeMs += model->profile[i].timeMs;
+        bytes += model->profile[i].weightBytes;
+    }
+
+    uint64_t passes        = model->profilePasses > 0 ? model->profilePasses : 1;
+    metrics.execution_time = timeMs / (double)passes;
+    metrics.memory_usage   = (size_t)(bytes / passes);
+    tinyaiRecordMetrics(analysis, &metrics);
+
+    return 0;
+}
+
+/**
+ * Write the per-layer profile as a table
+ */
+int tinyaiWriteModelProfile(const TinyAIModel *model, FILE *file)
+{
+    static const char *typeNames[] = {"embedding", "dense",     "rnn",
+                                      "attention", "layernorm", "output"};
+
+    if (!model || !model->profile || !file) {
+        return -1;
+    }
+
+    fprintf(file, "%-5s %-10s %8s %10s %12s %10s %14s %8s %8s\n", "layer", "type", "calls",
+            "rows", "time_ms", "GFLOP/s", "weight_bytes", "allocs", "exits");
+    for (uint32_t i = 0; i < model->profileLayers; i++) {
+        const TinyAILayerProfile *entry = &model->profile[i];
+        const char               *name  = "unknown";
+        double                    gflops = 0.0;
+
+        if ((uint32_t)entry->type < sizeof(typeNames) / sizeof(typeNames[0])) {
+            name = typeNames[entry->type];
+        }
+        if (entry->timeMs > 0.0) {
+            gflops = (double)entry->flops / (entry->timeMs * 1e6);
+        }
+
+        fprintf(file, "%-5u %-10s %8llu %10llu %12.3f %10.2f %14llu %8llu %8llu\n", i, name,
+                (unsigned long long)entry->calls, (unsigned long long)entry->rows, entry->timeMs,
+                gflops, (unsigned long long)entry->weightBytes,
+                (unsigned long long)entry->allocations, (unsigned long long)entry->exits);
+    }
+
+    return 0;
+}
+
+/**
+ * Enable or disable the shared prompt-prefix cache of a model
+ */
+int tinyaiEnablePrefixCache(TinyAIModel *model, size_t memoryLimit)
+{
+    if (!model) {
+        return -1;
+    }
+
+    tinyaiDestroyPrefixCache(model->prefixCache);
+    model->prefixCache = NULL;
+
+    if (memoryLimit == 0) {
+        return 0;
+    }
+
+    model->prefixCache = tinyaiCreatePrefixCache(memoryLimit);
+    return model->prefixCache ? 0 : -1;
+}
+
+/**
+ * Shed the prompt-prefix cache of a model
+ */
+static size_t shedPrefixCache(void *userData, TinyAIPressureLevel level)
+{
+    TinyAIPrefixCache *prefixCache = ((TinyAIModel *)userData)->prefixCache;
+    size_t             keep        = 0;
+    if (level == TINYAI_PRESSURE_MODERATE) {
+        keep = tinyaiPrefixCacheMemoryUsed(prefixCache) / 2;
+    }
+    return tinyaiPrefixCacheTrim(prefixCache, keep);
+}
+
+/**
+ * Shrink or drop the word cache of a model's tokenizer
+ */
+static size_t shedTokenizerCache(void *userData, TinyAIPressureLevel level)
+{
+    TinyAITokenizer     *tokenizer = ((TinyAIModel *)userData)->tokenizer;
+    TinyAIWordCacheStats before, after;
+    if (tinyaiGetWordCacheStats(tokenizer, &before) != 0 || before.capacity == 0) {
+        return 0;
+    }
+
+    uint32_t entries = level >= TINYAI_PRESSURE_CRITICAL ? 0 : before.capacity / 2;
+    tinyaiSetWordCacheSize(tokenizer, entries);
+    tinyaiGetWordCacheStats(tokenizer, &after);
+    return before.bytes > after.bytes ? before.bytes - after.bytes : 0;
+}
+
+/**
+ * Free the storage of idle key/value blocks
+ */
+static size_t shedKVBlocks(void *userData, TinyAIPressureLevel level)
+{
+    (void)level;
+    return tinyaiKVBlockPoolTrim((TinyAIKVBlockPool *)userData);
+}
+
+/**
+ * Let a memory governor shed a model's caches under pressure
+ */
+int tinyaiGovernModel(TinyAIMemoryGovernor *governor, TinyAIModel *model,
+                      TinyAIKVBlockPool *kvPool)
+{
+    if (!governor || !model) {
+        return -1;
+    }
+
+    if (tinyaiMemoryGovernorAddShedder(governor, TINYAI_SHED_PREFIX_CACHE, shedPrefixCache,
+                                       model) != 0 ||
+        tinyaiMemoryGovernorAddShedder(governor, TINYAI_SHED_TOKENIZER_CACHE,
+                                       shedTokenizerCache, model) != 0 ||
+        (kvPool && tinyaiMemoryGovernorAddShedder(governor, TINYAI_SHED_KV_CACHE, shedKVBlocks,
+                                                  kvPool) != 0)) {
+        tinyaiMemoryGovernorRemove(governor, model);
+        if (kvPool) {
+            tinyaiMemoryGovernorRemove(governor, kvPool);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Heap bytes of count floats, or 0 if they live in the model's snapshot
+ */
+static size_t heapFloatBytes(const TinyAIModel *model, const float *floats, size_t count)
+{
+    return floats && !isSnapshotData(model, floats) ? count * sizeof(float) : 0;
+}
+
+/**
+ * Heap bytes of a matrix's data, scales and codebook
+ */
+static size_t matrixHeapBytes(const TinyAIModel *model, const TinyAIMatrix4bit *matrix)
+{
+    size_t bytes = 0;
+    if (matrix->data && !isSnapshotData(model, matrix->data)) {
+        bytes += tinyaiMatrix4bitDataSize(matrix);
+    }
+    if (matrix->scales) {
+        bytes += heapFloatBytes(model, matrix->scales, 2 * tinyaiMatrix4bitGroupCount(matrix));
+    }
+    return bytes + heapFloatBytes(model, matrix->levels, TINYAI_CODEBOOK_LEVELS);
+}
+
+/**
+ * Get the memory of a model by subsystem
+ */
+int tinyaiGetModelMemoryUsage(const TinyAIModel *model, TinyAIModelMemoryUsage *usage)
+{
+    if (!model || !usage) {
+        return -1;
+    }
+    memset(usage, 0, sizeof(TinyAIModelMemoryUsage));
+
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        const TinyAILayer *layer = &model->layers[i];
+        usage->weights += matrixHeapBytes(model, &layer->weights);
+        usage->weights += heapFloatBytes(model, layer->biases, layer->outputSize);
+
+        const TinyAISelfAttention *attention = layer->attention;
+        if (attention) {
+            const TinyAIAttentionParams *params = &attention->params;
+            uint32_t                     kvDim  = params->numKVHeads * params->headDim;
+            usage->weights += matrixHeapBytes(model, &attention->queryWeight) +
+                              matrixHeapBytes(model, &attention->keyWeight) +
+                              matrixHeapBytes(model, &attention->valueWeight) +
+                              matrixHeapBytes(model, &attention->outputWeight);
+            usage->weights += heapFloatBytes(model, attention->queryBias, params->hiddenDim) +
+                              heapFloatBytes(model, attention->keyBias, kvDim) +
+                              heapFloatBytes(model, attention->valueBias, kvDim) +
+                              heapFloatBytes(model, attention->outputBias, params->hiddenDim);
+            usage->activations += tinyaiSelfAttentionScratchSize(attention);
+        }
+    }
+
+    /* Ping-pong buffers, then what the plan added: its own buffers and sparse weight copies */
+    usage->activations += 2 * (size_t)model->contextSize * model->hiddenSize *
+                          activationElementSize(model->activationPrecision);
+    usage->activations += 2 * (size_t)model->shortlistSize * sizeof(float);
+    const TinyAIModelPlan *plan = model->plan;
+    if (plan) {
+        usage->activations += plan->scratchBytes;
+        for (uint32_t i = 0; i < plan->numSteps; i++) {
+            if (plan->steps[i].csr) {
+                usage->weights += tinyaiCSRMatrix4BitMemoryUsage(plan->steps[i].csr);
+            }
+            if (plan->steps[i].bsr) {
+                usage->weights += tinyaiBSRMatrixMemoryUsage(plan->steps[i].bsr);
+            }
+        }
+    }
+
+    usage->kvCache   = tinyaiKVCacheMemoryUsage(model->scratchCache) +
+                       tinyaiPrefixCacheMemoryUsed(model->prefixCache);
+    usage->tokenizer = tinyaiTokenizerMemoryUsage(model->tokenizer);
+
+    /* A snapshot holds the vocabulary too; a separately mapped one is added */
+    if (model->snapshot) {
+        usage->mapped         = model->snapshotSize;
+        usage->mappedResident = tinyaiGetMappingResidentBytes(model->snapshot, model->snapshotSize);
+    }
+    const TinyAITokenizer *tokenizer = model->tokenizer;
+    if (tokenizer && tokenizer->mapping && !isSnapshotData(model, tokenizer->mapping)) {
+        usage->mapped += tokenizer->mappingSize;
+        usage->mappedResident +=
+            tinyaiGetMappingResidentBytes(tokenizer->mapping, tokenizer->mappingSize);
+    }
+
+    return 0;
+}
+
+/**
+ * Write the prompt, or a BOS token without one, to the start of outputTokens
+ *
+ * @return Number of tokens written, 0 if the prompt does not fit
+ */
+static int startSequence(const TinyAIGenerationParams *params, int *outputTokens,
+                         int maxOutputTokens)
+{
+    /* Check if prompt is provided */
+    if (!params->promptTokens || params->promptLength == 0) {
+        /* Start with BOS token */
+        outputTokens[0] = TINYAI_TOKEN_BOS;
+        return 1;
+    }
+
+    /* Start with prompt */
+    if (params->promptLength > maxOutputTokens) {
+        /* Prompt too long */
+        return 0;
+    }
+
+    /* Copy prompt */
+    memcpy(outputTokens, params->promptTokens, params->promptLength * sizeof(int));
+    return params->promptLength;
+}
+
+/**
+ * Install a generation's cancellation token on the calling thread
+ *
+ * Without one the thread's installed token stays in place. Returns the token
+ * to reinstall with tinyaiUseCancelToken when the generation ends.
+ */
+static TinyAICancelToken *useGenerationCancel(const TinyAIGenerationParams *params)
+{
+    return params->cancel ? tinyaiUseCancelToken(params->cancel) : tinyaiCurrentCancelToken();
+}
+
+/**
+ * Generation loop shared by the buffered and streaming entry points
+ *
+ * With a callback, each token is reported as soon as it is sampled, before
+ * the next forward pass; a false return stops generation after that token.
+ */
+static int generateWithWorkspace(TinyAIModel *model, const TinyAIGenerationParams *params,
+                                 TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                                 int maxOutputTokens, TinyAITokenCallback callback,
+                                 void *userData)
+{
+    if (!model || !params || !workspace || !outputTokens || maxOutputTokens <= 0 ||
+        workspace->vocabSize != (uint32_t)model->tokenizer->tokenCount) {
+        return 0;
+    }
+
+    /* Initialize random number generator */
+    seedRandom(params->seed);
+
+    int numTokens = startSequence(params, outputTokens, maxOutputTokens);
+    if (numTokens == 0) {
+        return 0;
+    }
+    TinyAICancelToken *previousCancel = useGenerationCancel(params);
+
+    /* Prefill runs once, then each step only processes the newest token.
+     * Without a cache every step recomputes the whole window. */
+    TinyAIKVCache *cache     = workspace->cache;
+    int            fedTokens = 0;
+    if (cache) {
+        tinyaiResetKVCache(cache);
+    }
+
+    /* Resume prefill after the longest prompt prefix seen before */
+    TinyAIPrefixCache *prefixCache  = cache ? model->prefixCache : NULL;
+    int                promptTokens = numTokens;
+    bool               promptCached = false;
+    if (prefixCache && (uint32_t)promptTokens <= cache->maxSeqLength) {
+        fedTokens    = tinyaiPrefixCacheLookup(prefixCache, outputTokens, promptTokens, cache,
+                                               workspace->logits, workspace->vocabSize);
+        promptCached = fedTokens == promptTokens;
+    }
+
+    /* Generate tokens; every buffer comes from the workspace */
+    bool     afterText    = false; /* Whether a streamed piece has produced text yet */
+    uint32_t grammarState = tinyaiGrammarStartState(params->grammar);
+    while (numTokens < maxOutputTokens && numTokens < params->maxTokens) {
+        /* Get logits for next token, unless the whole prompt was cached */
+        if (!promptCached || numTokens != promptTokens) {
+            int result = nextTokenLogits(model, cache, outputTokens, numTokens, &fedTokens,
+                                         workspace->logits);
+            if (result != 0) {
+                break;
+            }
+
+            /* Store a prefill that covered the whole prompt from position zero */
+            if (prefixCache && numTokens == promptTokens &&
+                cache->length == (uint32_t)promptTokens) {
+                tinyaiPrefixCacheInsert(prefixCache, outputTokens, promptTokens, cache,
+                                        workspace->logits, workspace->vocabSize);
+            }
+        }
+
+        /* Sample next token */
+        int nextToken = sampleProcessedToken(workspace->logits, workspace->vocabSize, params,
+                                             outputTokens, numTokens, NULL, 0, &grammarState,
+                                             workspace->probs, workspace->indices);
+
+        /* Check for EOS token */
+        if (nextToken == TINYAI_TOKEN_EOS) {
+            break;
+        }
+
+        /* Add token to output */
+        outputTokens[numTokens++] = nextToken;
+
+        /* Stream the token with the text it appends */
+        if (callback) {
+            char piece[TINYAI_MAX_TOKEN_LENGTH + 2];
+            int  pieceLength = tinyaiDecodeTokenPiece(model->tokenizer, nextToken, afterText,
+                                                      piece, (int)sizeof(piece));
+            afterText        = afterText || pieceLength > 0;
+
+            if (!callback(nextToken, piece, userData)) {
+                break;
+            }
+        }
+    }
+
+    tinyaiUseCancelToken(previousCancel);
+    return numTokens;
+}
+
+/**
+ * Generate text using a preallocated workspace
+ */
+int tinyaiGenerateTextWithWorkspace(TinyAIModel *model, const TinyAIGenerationParams *params,
+                                    TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                                    int maxOutputTokens)
+{
+    return generateWithWorkspace(model, params, workspace, outputTokens, maxOutputTokens, NULL,
+                                 NULL);
+}
+
+/**
+ * Generate text using a preallocated workspace, streaming each token to a callback
+ */
+int tinyaiGenerateTextWithWorkspaceCallback(TinyAIModel                  *model,
+                                            const TinyAIGenerationParams *params,
+                                            TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                                            int maxOutputTokens, TinyAITokenCallback callback,
+                                            void *userData)
+{
+    return generateWithWorkspace(model, params, workspace, outputTokens, maxOutputTokens, callback,
+                                 userData);
+}
+
+/**
+ * Continuation loop, run under the generation's cancellation token
+ */
+static int continueSequence(TinyAIModel *model, const TinyAIGenerationParams *params,
+                            TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                            int maxOutputTokens, TinyAITokenCallback callback, void *userData)
+{
+    if (!model || !params || !workspace || !workspace->cache || !outputTokens ||
+        !params->promptTokens || params->promptLength <= 0 ||
+        workspace->vocabSize != (uint32_t)model->tokenizer->tokenCount) {
+        return -1;
+    }
+
+    TinyAIKVCache *cache = workspace->cache;
+    seedRandom(params->seed);
+
+    /* Prefill only the new tokens, after the positions already cached */
+    if (tinyaiModelForwardCached(model, cache, params->promptTokens, params->promptLength,
+                                 workspace->logits) != 0) {
+        return -1;
+    }
+
+    int  limit     = params->maxTokens < maxOutputTokens ? params->maxTokens : maxOutputTokens;
+    int  numTokens = 0;
+    bool afterText = false; /* Whether a streamed piece has produced text yet */
+
+    /* Each call's tokens match the grammar on their own */
+    uint32_t grammarState = tinyaiGrammarStartState(params->grammar);
+    while (numTokens < limit && tinyaiKVCacheFits(cache, 1)) {
+        int nextToken = sampleProcessedToken(
+            workspace->logits, workspace->vocabSize, params, params->promptTokens,
+            params->promptLength, outputTokens, numTokens, &grammarState, workspace->probs,
+            workspace->indices);
+        if (nextToken == TINYAI_TOKEN_EOS) {
+            break;
+        }
+        outputTokens[numTokens++] = nextToken;
+
+        /* Stream the token before feeding it, so it arrives as soon as it is sampled */
+        bool keepGoing = true;
+        if (callback) {
+            char piece[TINYAI_MAX_TOKEN_LENGTH + 2];
+            int  pieceLength = tinyaiDecodeTokenPiece(model->tokenizer, nextToken, afterText,
+                                                      piece, (int)sizeof(piece));
+            afterText        = afterText || pieceLength > 0;
+            keepGoing        = callback(nextToken, piece, userData);
+        }
+
+        /* Every returned token is fed, so the next call continues after it */
+        if (tinyaiModelForwardCached(model, cache, &nextToken, 1, workspace->logits) != 0) {
+            return -1;
+        }
+        if (!keepGoing) {
+            break;
+        }
+    }
+
+    return numTokens;
+}
+
+/**
+ * Continue a sequence held in a workspace's key/value cache
+ */
+int tinyaiGenerateTextContinue(TinyAIModel *model, const TinyAIGenerationParams *params,
+                               TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                               int maxOutputTokens, TinyAITokenCallback callback,
+                               void *userData)
+{
+    if (!params) {
+        return -1;
+    }
+
+    TinyAICancelToken *previous = useGenerationCancel(params);
+    int                result   = continueSequence(model, params, workspace, outputTokens,
+                                                   maxOutputTokens, callback, userData);
+    tinyaiUseCancelToken(previous);
+    return result;
+}
+
+/**
+ * Generate text, streaming each token to a callback
+ */
+int tinyaiGenerateTextWithCallback(TinyAIModel *model, const TinyAIGenerationParams *params,
+                                   TinyAITokenCallback callback, void *userData)
+{
+    if (!model || !params || !callback) {
+        return 0;
+    }
+
+    /* Room for the prompt (or BOS) plus every generated token */
+    int capacity = params->maxTokens;
+    if (params->promptTokens && params->promptLength > capacity) {
+        capacity = params->promptLength;
+    }
+    if (capacity < 1) {
+        capacity = 1;
+    }
+
+    int                       *tokens    = (int *)TINYAI_MALLOC(capacity * sizeof(int));
+    TinyAIGenerationWorkspace *workspace = tinyaiCreateGenerationWorkspace(model);
+    if (!tokens || !workspace) {
+        if (tokens)
+            TINYAI_FREE(tokens);
+        tinyaiDestroyGenerationWorkspace(workspace);
+        return 0;
+    }
+
+    int numTokens =
+        generateWithWorkspace(model, params, workspace, tokens, capacity, callback, userData);
+
+    tinyaiDestroyGenerationWorkspace(workspace);
+    TINYAI_FREE(tokens);
+
+    return numTokens;
+}
+
+/**
+ * Generate text from a model
+ */
+int tinyaiGenerateText(TinyAIModel *model, const TinyAIGenerationParams *params, int *outputTokens,
+                       int maxOutputTokens)
+{
+    if (!model || !params || !outputTokens || maxOutputTokens <= 0) {
+        return 0;
+    }
+
+    TinyAIGenerationWorkspace *workspace = tinyaiCreateGenerationWorkspace(model);
+    if (!workspace) {
+        return 0;
+    }
+
+    int numTokens =
+        tinyaiGenerateTextWithWorkspace(model, params, workspace, outputTokens, maxOutputTokens);
+
+    tinyaiDestroyGenerationWorkspace(workspace);
+
+    return numTokens;
+}
+
+/**
+ * A token fed back to the model, or the unknown token if it is outside the vocabulary
+ */
+static int vocabularyToken(const TinyAIModel *model, int token)
+{
+    return token >= 0 && (uint32_t)token < model->tokenizer->tokenCount ? token
+                                                                         : TINYAI_TOKEN_UNKNOWN;
+}
+
+/**
+ * Generate text for several sequences at once
+ */
+int tinyaiGenerateTextBatch(TinyAIModel *model, const TinyAIGenerationParams *params,
+                            int batchSize, int **outputTokens, int maxOutputTokens,
+                            int *tokenCounts)
+{
+    if (!model || !params || batchSize <= 0 || !outputTokens || maxOutputTokens <= 0 ||
+        !tokenCounts) {
+        return -1;
+    }
+
+    uint32_t vocabSize = model->tokenizer->tokenCount;
+    uint32_t maxRows   = (uint32_t)batchSize < model->contextSize ? (uint32_t)batchSize
+                                                                  : model->contextSize;
+
+    /* Per-sequence state and per-step buffers */
+    TinyAIKVCache **caches =
+        (TinyAIKVCache **)TINYAI_MALLOC(batchSize * sizeof(TinyAIKVCache *));
+    TinyAIKVCache **rowCaches =
+        (TinyAIKVCache **)TINYAI_MALLOC(batchSize * sizeof(TinyAIKVCache *));
+    int          *fedTokens     = (int *)TINYAI_MALLOC(batchSize * sizeof(int));
+    unsigned int *rngStates     = (unsigned int *)TINYAI_MALLOC(batchSize * sizeof(unsigned int));
+    uint32_t     *grammarStates = (uint32_t *)TINYAI_MALLOC(batchSize * sizeof(uint32_t));
+    bool         *active        = (bool *)TINYAI_MALLOC(batchSize * sizeof(bool));
+    int          *rowSeq        = (int *)TINYAI_MALLOC(batchSize * sizeof(int));
+    int          *rowTokens     = (int *)TINYAI_MALLOC(batchSize * sizeof(int));
+    float        *logits        = (float *)TINYAI_MALLOC(batchSize * vocabSize * sizeof(float));
+    float        *stepLogits    = (float *)TINYAI_MALLOC(maxRows * vocabSize * sizeof(float));
+    float        *sampling      = (float *)TINYAI_MALLOC(
+        vocabSize * (sizeof(float) + sizeof(uint32_t))); /* Sampling scratch */
+
+    if (!caches || !rowCaches || !fedTokens || !rngStates || !grammarStates || !active ||
+        !rowSeq || !rowTokens || !logits || !stepLogits || !sampling) {
+        if (caches)
+            TINYAI_FREE(caches);
+        if (rowCaches)
+            TINYAI_FREE(rowCaches);
+        if (fedTokens)
+            TINYAI_FREE(fedTokens);
+        if (rngStates)
+            TINYAI_FREE(rngStates);
+        if (grammarStates)
+            TINYAI_FREE(grammarStates);
+        if (active)
+            TINYAI_FREE(active);
+        if (rowSeq)
+            TINYAI_FREE(rowSeq);
+        if (rowTokens)
+            TINYAI_FREE(rowTokens);
+        if (logits)
+            TINYAI_FREE(logits);
+        if (stepLogits)
+            TINYAI_FREE(stepLogits);
+        if (sampling)
+            TINYAI_FREE(sampling);
+        return -1;
+    }
+
+    /* Start each sequence exactly as tinyaiGenerateText would */
+    for (int b = 0; b < batchSize; b++) {
+        const TinyAIGenerationParams *p = &params[b];
+
+        caches[b]    = NULL;
+        fedTokens[b] = 0;
+        active[b]    = false;
+
+        if (!p->promptTokens || p->promptLength == 0) {
+            outputTokens[b][0] = TINYAI_TOKEN_BOS;
+            tokenCounts[b]     = 1;
+        }
+        else if (p->promptLength > maxOutputTokens) {
+            /* Prompt too long */
+            tokenCounts[b] = 0;
+            continue;
+        }
+        else {
+            memcpy(outputTokens[b], p->promptTokens, p->promptLength * sizeof(int));
+            tokenCounts[b] = p->promptLength;
+        }
+
+        /* Each sequence keeps its own random stream */
+        seedRandom(p->seed);
+        rngStates[b]     = randState;
+        grammarStates[b] = tinyaiGrammarStartState(p->grammar);
+        caches[b]        = tinyaiCreateModelKVCache(model);
+        active[b]        = true;
+    }
+
+    bool batchable = batchDecodeSupported(model);
+
+    for (;;) {
+        uint32_t rowCount  = 0;
+        bool     anyActive = false;
+
+        /* Decode steps with a single pending token are batched; prefill,
+         * context overflow and uncached sequences run on their own */
+        for (int b = 0; b < batchSize; b++) {
+            if (!active[b]) {
+                continue;
+            }
+            if (tokenCounts[b] >= maxOutputTokens || tokenCounts[b] >= params[b].maxTokens ||
+                tinyaiCancelRequested(params[b].cancel)) {
+                active[b] = false;
+                continue;
+            }
+            anyActive = true;
+
+            TinyAIKVCache *cache = caches[b];
+            if (batchable && cache && tokenCounts[b] - fedTokens[b] == 1 &&
+                tinyaiKVCacheFits(cache, 1)) {
+                int token = vocabularyToken(model, outputTokens[b][tokenCounts[b] - 1]);
+                rowSeq[rowCount]    = b;
+                rowTokens[rowCount] = token;
+                rowCount++;
+            }
+            else {
+                /* A sequence running on its own stops within a layer of its cancellation */
+                TinyAICancelToken *previous = useGenerationCancel(&params[b]);
+                if (nextTokenLogits(model, cache, outputTokens[b], tokenCounts[b], &fedTokens[b],
+                                    logits + b * vocabSize) != 0) {
+                    active[b] = false;
+                }
+                tinyaiUseCancelToken(previous);
+            }
+        }
+
+        if (!anyActive) {
+            break;
+        }
+
+        /* Run the batched rows in chunks that fit the activation buffers */
+        for (uint32_t start = 0; start < rowCount; start += maxRows) {
+            uint32_t chunk = rowCount - start < maxRows ? rowCount - start : maxRows;
+
+            for (uint32_t r = 0; r < chunk; r++) {
+                rowCaches[r] = caches[rowSeq[start + r]];
+            }
+
+            if (batchedDecodeStep(model, rowCaches, rowTokens + start, chunk, stepLogits) == 0) {
+                for (uint32_t r = 0; r < chunk; r++) {
+                    int seq = rowSeq[start + r];
+                    tinyaiKVCacheAdvance(caches[seq], 1);
+                    fedTokens[seq] = tokenCounts[seq];
+                    memcpy(logits + seq * vocabSize, stepLogits + r * vocabSize,
+                           vocabSize * sizeof(float));
+                }
+            }
+            else {
+                /* Fall back to one sequence at a time for this chunk */
+                for (uint32_t r = 0; r < chunk; r++) {
+                    int                seq      = rowSeq[start + r];
+                    TinyAICancelToken *previous = useGenerationCancel(&params[seq]);
+                    if (nextTokenLogits(model, caches[seq], outputTokens[seq], tokenCounts[seq],
+                                        &fedTokens[seq], logits + seq * vocabSize) != 0) {
+                        active[seq] = false;
                     }
-                    break;
+                    tinyaiUseCancelToken(previous);
+                }
+            }
+        }
+
+        /* Sample the next token of every sequence still running */
+        for (int b = 0; b < batchSize; b++) {
+            if (!active[b]) {
+                continue;
+            }
+
+            randState     = rngStates[b];
+            int nextToken = sampleProcessedToken(
+                logits + b * vocabSize, vocabSize, &params[b], outputTokens[b], tokenCounts[b],
+                NULL, 0, &grammarStates[b], sampling, (uint32_t *)(sampling + vocabSize));
+            rngStates[b]  = randState;
+
+            /* Check for EOS token */
+            if (nextToken == TINYAI_TOKEN_EOS) {
+                active[b] = false;
+                continue;
+            }
+
+            outputTokens[b][tokenCounts[b]++] = nextToken;
+        }
+    }
+
+    for (int b = 0; b < batchSize; b++) {
+        tinyaiDestroyKVCache(caches[b]);
+    }
+    TINYAI_FREE(caches);
+    TINYAI_FREE(rowCaches);
+    TINYAI_FREE(fedTokens);
+    TINYAI_FREE(rngStates);
+    TINYAI_FREE(grammarStates);
+    TINYAI_FREE(active);
+    TINYAI_FREE(rowSeq);
+    TINYAI_FREE(rowTokens);
+    TINYAI_FREE(logits);
+    TINYAI_FREE(stepLogits);
+    TINYAI_FREE(sampling);
+
+    return 0;
+}
+
+/**
+ * Sequence occupying a slot of a continuous generation batch
+ */
+typedef struct {
+    bool                   running;      /* Still generating */
+    TinyAIGenerationParams params;       /* Parameters, the prompt copied into tokens */
+    int                   *tokens;      /* Sequence so far, prompt included */
+    int                    capacity;     /* Size of tokens */
+    int                    count;        /* Tokens in the sequence */
+    int                    fed;          /* Tokens fed to the model */
+    TinyAIKVCache         *cache;        /* Cache of the fed tokens (NULL to recompute) */
+    int                    prompt;       /* Tokens of the prompt (or BOS) */
+    unsigned int           rngState;     /* The sequence's own random stream */
+    uint32_t               grammarState; /* State of the parameters' grammar */
+    bool                   afterText;    /* Whether a streamed piece has produced text yet */
+    TinyAITokenCallback    callback;     /* Receives each sampled token */
+    void                  *userData;     /* Passed to the callback */
+} BatchSequence;
+
+/**
+ * Continuous generation batch
+ */
+struct TinyAIGenerationBatch {
+    TinyAIModel       *model;        /* Model generating */
+    TinyAIKVBlockPool *pool;         /* Pool of the sequences' paged caches, or NULL */
+    BatchSequence     *sequences;    /* One per slot */
+    int                maxSequences; /* Number of slots */
+    int                prefillChunk; /* Prompt tokens fed per step (0 for all) */
+    uint32_t           vocabSize;    /* Vocabulary size of the logits */
+    uint32_t           maxRows;      /* Rows of one batched decode step */
+    TinyAIKVCache    **rowCaches;    /* Cache of every row of a decode step */
+    int               *rowSeq;       /* Slot of every row of a decode step */
+    int               *rowTokens;    /* Token of every row of a decode step */
+    bool              *ready;        /* Slots with logits to sample this step */
+    float             *logits;       /* Next-token logits of every slot */
+    float             *stepLogits;   /* Logits of a batched decode step */
+    float             *sampling;     /* Sampling scratch */
+};
+
+/**
+ * Create a continuous batch of generated sequences
+ */
+TinyAIGenerationBatch *tinyaiCreateGenerationBatch(TinyAIModel *model, int maxSequences,
+                                                   int prefillChunk, TinyAIKVBlockPool *pool)
+{
+    if (!model || !model->tokenizer || model->tokenizer->tokenCount <= 0 || maxSequences <= 0 ||
+        prefillChunk < 0) {
+        return NULL;
+    }
+
+    TinyAIGenerationBatch *batch =
+        (TinyAIGenerationBatch *)TINYAI_MALLOC(sizeof(TinyAIGenerationBatch));
+    if (!batch) {
+        return NULL;
+    }
+    memset(batch, 0, sizeof(TinyAIGenerationBatch));
+
+    uint32_t vocabSize  = model->tokenizer->tokenCount;
+    batch->model        = model;
+    batch->pool         = pool;
+    batch->maxSequences = maxSequences;
+    batch->prefillChunk = prefillChunk;
+    batch->vocabSize    = vocabSize;
+    batch->maxRows      = (uint32_t)maxSequences < model->contextSize ? (uint32_t)maxSequences
+                                                                     : model->contextSize;
+    batch->sequences =
+        (BatchSequence *)TINYAI_MALLOC(maxSequences * sizeof(BatchSequence));
+    batch->rowCaches =
+        (TinyAIKVCache **)TINYAI_MALLOC(maxSequences * sizeof(TinyAIKVCache *));
+    batch->rowSeq     = (int *)TINYAI_MALLOC(maxSequences * sizeof(int));
+    batch->rowTokens  = (int *)TINYAI_MALLOC(maxSequences * sizeof(int));
+    batch->ready      = (bool *)TINYAI_MALLOC(maxSequences * sizeof(bool));
+    batch->logits     = (float *)TINYAI_MALLOC(maxSequences * vocabSize * sizeof(float));
+    batch->stepLogits = (float *)TINYAI_MALLOC(batch->maxRows * vocabSize * sizeof(float));
+    batch->sampling   = (float *)TINYAI_MALLOC(vocabSize * (sizeof(float) + sizeof(uint32_t)));
+
+    if (batch->sequences) {
+        memset(batch->sequences, 0, maxSequences * sizeof(BatchSequence));
+    }
+    if (!batch->sequences || !batch->rowCaches || !batch->rowSeq || !batch->rowTokens ||
+        !batch->ready || !batch->logits || !batch->stepLogits || !batch->sampling) {
+        tinyaiDestroyGenerationBatch(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+/**
+ * Destroy a generation batch
+ */
+void tinyaiDestroyGenerationBatch(TinyAIGenerationBatch *batch)
+{
+    if (!batch) {
+        return;
+    }
+
+    if (batch->sequences) {
+        for (int i = 0; i < batch->maxSequences; i++) {
+            tinyaiGenerationBatchRemove(batch, i);
+        }
+        TINYAI_FREE(batch->sequences);
+    }
+    if (batch->rowCaches)
+        TINYAI_FREE(batch->rowCaches);
+    if (batch->rowSeq)
+        TINYAI_FREE(batch->rowSeq);
+    if (batch->rowTokens)
+        TINYAI_FREE(batch->rowTokens);
+    if (batch->ready)
+        TINYAI_FREE(batch->ready);
+    if (batch->logits)
+        TINYAI_FREE(batch->logits);
+    if (batch->stepLogits)
+        TINYAI_FREE(batch->stepLogits);
+    if (batch->sampling)
+        TINYAI_FREE(batch->sampling);
+
+    TINYAI_FREE(batch);
+}
+
+/**
+ * Add a sequence to a generation batch
+ */
+int tinyaiGenerationBatchAdd(TinyAIGenerationBatch *batch, const TinyAIGenerationParams *params,
+                             TinyAITokenCallback callback, void *userData)
+{
+    if (!batch || !params || params->promptLength < 0 ||
+        batch->vocabSize != (uint32_t)batch->model->tokenizer->tokenCount) {
+        return -1;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < batch->maxSequences; i++) {
+        if (!batch->sequences[i].running) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return -1;
+    }
+
+    /* Room for the prompt (or BOS) plus every generated token */
+    int capacity = params->maxTokens;
+    if (params->promptTokens && params->promptLength > capacity) {
+        capacity = params->promptLength;
+    }
+    if (capacity < 1) {
+        capacity = 1;
+    }
+
+    BatchSequence *seq = &batch->sequences[slot];
+    tinyaiGenerationBatchRemove(batch, slot);
+    seq->tokens = (int *)TINYAI_MALLOC(capacity * sizeof(int));
+    seq->cache  = batch->pool ? tinyaiCreateModelPagedKVCache(batch->model, batch->pool)
+                              : tinyaiCreateModelKVCache(batch->model);
+    if (!seq->tokens) {
+        tinyaiGenerationBatchRemove(batch, slot);
+        return -1;
+    }
+
+    seq->params              = *params;
+    seq->params.promptTokens = NULL; /* The prompt now lives in tokens */
+    seq->capacity            = capacity;
+    seq->count               = startSequence(params, seq->tokens, capacity);
+    seq->prompt              = seq->count;
+    seq->fed                 = 0;
+    seq->afterText           = false;
+    seq->callback            = callback;
+    seq->userData            = userData;
+
+    /* Each sequence keeps its own random stream */
+    unsigned int savedState = randState;
+    seedRandom(params->seed);
+    seq->rngState     = randState;
+    seq->grammarState = tinyaiGrammarStartState(params->grammar);
+    randState         = savedState;
+
+    if (seq->count == 0) {
+        tinyaiGenerationBatchRemove(batch, slot);
+        return -1;
+    }
+    seq->running = true;
+    return slot;
+}
+
+/**
+ * Remove a sequence from a generation batch
+ */
+void tinyaiGenerationBatchRemove(TinyAIGenerationBatch *batch, int slot)
+{
+    if (!batch || slot < 0 || slot >= batch->maxSequences) {
+        return;
+    }
+
+    BatchSequence *seq = &batch->sequences[slot];
+    if (seq->tokens) {
+        TINYAI_FREE(seq->tokens);
+    }
+    tinyaiDestroyKVCache(seq->cache);
+    memset(seq, 0, sizeof(BatchSequence));
+}
+
+/**
+ * End a sequence of a generation batch, keeping its token count
+ */
+static void finishBatchSequence(BatchSequence *seq)
+{
+    seq->running = false;
+    if (seq->tokens) {
+        TINYAI_FREE(seq->tokens);
+        seq->tokens = NULL;
+    }
+    tinyaiDestroyKVCache(seq->cache);
+    seq->cache = NULL;
+}
+
+/**
+ * Store a batch sequence's prompt in the prefix cache once it is prefilled
+ *
+ * Only a prefill that covered the whole prompt from position zero is kept.
+ */
+static void storeBatchPrefix(TinyAIModel *model, const BatchSequence *seq, const float *logits,
+                             uint32_t vocabSize)
+{
+    if (model->prefixCache && seq->cache && seq->count == seq->prompt &&
+        seq->cache->length == (uint32_t)seq->prompt) {
+        tinyaiPrefixCacheInsert(model->prefixCache, seq->tokens, seq->prompt, seq->cache, logits,
+                                vocabSize);
+    }
+}
+
+/**
+ * Advance every running sequence of a generation batch by one token
+ */
+int tinyaiGenerationBatchStep(TinyAIGenerationBatch *batch)
+{
+    if (!batch) {
+        return -1;
+    }
+
+    TinyAIModel *model     = batch->model;
+    uint32_t     vocabSize = batch->vocabSize;
+    uint32_t     rowCount  = 0;
+    bool         batchable = batchDecodeSupported(model);
+
+    /* Decode steps with a single pending token are batched; prefill chunks,
+     * context overflow and uncached sequences run on their own */
+    for (int b = 0; b < batch->maxSequences; b++) {
+        BatchSequence *seq = &batch->sequences[b];
+        batch->ready[b]    = false;
+        if (!seq->running) {
+            continue;
+        }
+        if (seq->count >= seq->capacity || seq->count >= seq->params.maxTokens ||
+            tinyaiCancelRequested(seq->params.cancel)) {
+            finishBatchSequence(seq);
+            continue;
+        }
+
+        if (batchable && seq->cache && seq->count - seq->fed == 1 &&
+            tinyaiKVCacheFits(seq->cache, 1)) {
+            int token = vocabularyToken(model, seq->tokens[seq->count - 1]);
+            batch->rowSeq[rowCount]    = b;
+            batch->rowTokens[rowCount] = token;
+            rowCount++;
+            continue;
+        }
+
+        /* Resume prefill after the longest prompt prefix seen before */
+        TinyAIPrefixCache *prefixCache = seq->cache ? model->prefixCache : NULL;
+        float             *logits      = batch->logits + b * vocabSize;
+        if (prefixCache && seq->fed == 0 && seq->count == seq->prompt &&
+            (uint32_t)seq->prompt <= seq->cache->maxSeqLength) {
+            seq->fed = tinyaiPrefixCacheLookup(prefixCache, seq->tokens, seq->prompt,
+                                               seq->cache, logits, vocabSize);
+            if (seq->fed == seq->prompt) {
+                batch->ready[b] = true;
+                continue;
+            }
+        }
+
+        /* A long prompt is fed a chunk per step, sampling once all of it is in */
+        int feedTo = seq->count;
+        if (seq->cache && batch->prefillChunk > 0 && feedTo - seq->fed > batch->prefillChunk) {
+            feedTo = seq->fed + batch->prefillChunk;
+        }
+        TinyAICancelToken *previous = useGenerationCancel(&seq->params);
+        int                result =
+            nextTokenLogits(model, seq->cache, seq->tokens, feedTo, &seq->fed, logits);
+        tinyaiUseCancelToken(previous);
+        if (result != 0) {
+            finishBatchSequence(seq);
+            continue;
+        }
+        batch->ready[b] = feedTo == seq->count;
+        if (batch->ready[b]) {
+            storeBatchPrefix(model, seq, logits, vocabSize);
+        }
+    }
+
+    /* Run the batched rows in chunks that fit the activation buffers */
+    for (uint32_t start = 0; start < rowCount; start += batch->maxRows) {
+        uint32_t chunk =
+            rowCount - start < batch->maxRows ? rowCount - start : batch->maxRows;
+
+        for (uint32_t r = 0; r < chunk; r++) {
+            batch->rowCaches[r] = batch->sequences[batch->rowSeq[start + r]].cache;
+        }
+
+        /* Should the batched step fail, fall back to one sequence at a time */
+        bool batched = batchedDecodeStep(model, batch->rowCaches, batch->rowTokens + start,
+                                         chunk, batch->stepLogits) == 0;
+        for (uint32_t r = 0; r < chunk; r++) {
+            int            b   = batch->rowSeq[start + r];
+            BatchSequence *seq = &batch->sequences[b];
+            if (batched) {
+                tinyaiKVCacheAdvance(seq->cache, 1);
+                seq->fed = seq->count;
+                memcpy(batch->logits + b * vocabSize, batch->stepLogits + r * vocabSize,
+                       vocabSize * sizeof(float));
+            }
+            else {
+                TinyAICancelToken *previous = useGenerationCancel(&seq->params);
+                int                result   = nextTokenLogits(model, seq->cache, seq->tokens,
+                                                              seq->count, &seq->fed,
+                                                              batch->logits + b * vocabSize);
+                tinyaiUseCancelToken(previous);
+                if (result != 0) {
+                    finishBatchSequence(seq);
+                    continue;
+                }
+            }
+            batch->ready[b] = true;
+            storeBatchPrefix(model, seq, batch->logits + b * vocabSize, vocabSize);
+        }
+    }
+
+    /* Sample the next token of every sequence with fresh logits */
+    unsigned int savedState = randState;
+    int          running    = 0;
+    for (int b = 0; b < batch->maxSequences; b++) {
+        BatchSequence *seq = &batch->sequences[b];
+        if (!seq->running) {
+            continue;
+        }
+        if (!batch->ready[b]) {
+            running++;
+            continue;
+        }
+
+        randState     = seq->rngState;
+        int nextToken = sampleProcessedToken(batch->logits + b * vocabSize, vocabSize,
+                                             &seq->params, seq->tokens, seq->count, NULL, 0,
+                                             &seq->grammarState, batch->sampling,
+                                             (uint32_t *)(batch->sampling + vocabSize));
+        seq->rngState = randState;
+
+        if (nextToken == TINYAI_TOKEN_EOS) {
+            finishBatchSequence(seq);
+            continue;
+        }
+        seq->tokens[seq->count++] = nextToken;
+
+        if (seq->callback) {
+            char piece[TINYAI_MAX_TOKEN_LENGTH + 2];
+            int  pieceLength = tinyaiDecodeTokenPiece(model->tokenizer, nextToken,
+                                                      seq->afterText, piece, (int)sizeof(piece));
+            seq->afterText   = seq->afterText || pieceLength > 0;
+
+            if (!seq->callback(nextToken, piece, seq->userData)) {
+                finishBatchSequence(seq);
+                continue;
+            }
+        }
+
+        /* Finished sequences leave at once, freeing their slots */
+        if (seq->count >= seq->capacity || seq->count >= seq->params.maxTokens) {
+            finishBatchSequence(seq);
+            continue;
+        }
+        running++;
+    }
+    randState = savedState;
+
+    return running;
+}
+
+/**
+ * Check whether a slot of a generation batch holds a running sequence
+ */
+bool tinyaiGenerationBatchRunning(const TinyAIGenerationBatch *batch, int slot, int *tokenCount)
+{
+    if (!batch || slot < 0 || slot >= batch->maxSequences) {
+        return false;
+    }
 
-                case TINYAI_LAYER_ATTENTION:
-                    /* Simplified self-attention layer */
-                    /* A real implementation would be much more complex */
-                    {
-                        /* For this simplified version, just pass through */
-                        memcpy(output, input, inputLength * layer->outputSize * sizeof(float));
-                    }
-                    break;
+    const BatchSequence *seq = &batch->sequences[slot];
+    if (tokenCount) {
+        *tokenCount = seq->count;
+    }
+    return seq->running;
+}
 
-                case TINYAI_LAYER_DENSE:
-                    /* Dense layer for each position */
-                    {
-                        for (int j = 0; j < inputLength; j++) {
-                            TinyAIMatrixFP32 *matrix = tinyaiDequantize4bitToFP32(&layer->weights);
-
-                            if (!matrix) {
-                                return -1;
-                            }
-
-                            /* Matrix multiplication for this position */
-                            for (uint32_t k = 0; k < layer->outputSize; k++) {
-                                float sum = 0.0f;
-                                for (uint32_t l = 0; l < layer->inputSize; l++) {
-                                    sum += input[j * layer->inputSize + l] *
-                                           matrix->data[l * layer->outputSize + k];
-                                }
-
-                                /* Add bias */
-                                if (layer->biases) {
-                                    sum += layer->biases[k];
-                                }
-
-                                /* Store result */
-                                output[j * layer->outputSize + k] = sum;
-                            }
-
-                            tinyaiDestroyMatrixFP32(matrix);
-
-                            /* Apply activation function */
-                            switch (layer->activation) {
-                            case TINYAI_ACTIVATION_RELU:
-                                for (uint32_t k = 0; k < layer->outputSize; k++) {
-                                    float *val = &output[j * layer->outputSize + k];
-                                    if (*val < 0.0f)
-                                        *val = 0.0f;
-                                }
-                                break;
-
-                            case TINYAI_ACTIVATION_SIGMOID:
-                                for (uint32_t k = 0; k < layer->outputSize; k++) {
-                                    float *val = &output[j * layer->outputSize + k];
-                                    *val       = 1.0f / (1.0f + expf(-*val));
-                                }
-                                break;
-
-                            case TINYAI_ACTIVATION_TANH:
-                                for (uint32_t k = 0; k < layer->outputSize; k++) {
-                                    float *val = &output[j * layer->outputSize + k];
-                                    *val       = tanhf(*val);
-                                }
-                                break;
-
-                            case TINYAI_ACTIVATION_GELU:
-                                for (uint32_t k = 0; k < layer->outputSize; k++) {
-                                    float *val = &output[j * layer->outputSize + k];
-                                    float  x   = *val;
-                                    *val       = 0.5f * x *
-                                           (1.0f + tanhf(sqrtf(2.0f / 3.14159f) *
-                                                         (x + 0.044715f * x * x * x)));
-                                }
-                                break;
-
-                            default:
-                                /* No activation (linear) */
-                                break;
-                            }
-                        }
-                    }
-                    break;
+/**
+ * Expansion of a beam by one token
+ */
+typedef struct {
+    float score;  /* Log probability of the hypothesis with the token */
+    int   parent; /* Beam the token extends */
+    int   token;  /* Appended token */
+} BeamCandidate;
 
-                case TINYAI_LAYER_LAYERNORM:
-                    /* Layer normalization */
-                    /* Apply to each position separately */
-                    for (int j = 0; j < inputLength; j++) {
-                        /* Calculate mean */
-                        float mean = 0.0f;
-                        for (uint32_t k = 0; k < layer->inputSize; k++) {
-                            mean += input[j * layer->inputSize + k];
-                        }
-                        mean /= layer->inputSize;
-
-                        /* Calculate variance */
-                        float variance = 0.0f;
-                        for (uint32_t k = 0; k < layer->inputSize; k++) {
-                            float diff = input[j * layer->inputSize + k] - mean;
-                            variance += diff * diff;
-                        }
-                        variance /= layer->inputSize;
-
-                        /* Normalize */
-                        for (uint32_t k = 0; k < layer->inputSize; k++) {
-                            float val =
-                                (input[j * layer->inputSize + k] - mean) / sqrtf(variance + 1e-5f);
-
-                            /* Scale and shift (using weights and biases) */
-                            if (layer->biases) {
-                                val = val * layer->biases[k] + layer->biases[layer->inputSize + k];
-                            }
-
-                            output[j * layer->inputSize + k] = val;
-                        }
-                    }
-                    break;
+/* Order candidates best first; ties go to the lower beam, then the lower token */
+static int compareBeamCandidates(const void *a, const void *b)
+{
+    const BeamCandidate *x = (const BeamCandidate *)a;
+    const BeamCandidate *y = (const BeamCandidate *)b;
+    if (x->score != y->score) {
+        return x->score > y->score ? -1 : 1;
+    }
+    if (x->parent != y->parent) {
+        return x->parent - y->parent;
+    }
+    return x->token - y->token;
+}
+
+/**
+ * Append a beam's best count continuations to a candidate list
+ *
+ * Scores are log probabilities, so only the log-sum-exp of the logits is
+ * needed rather than a full softmax. Equal logits keep the lower token, as
+ * greedy sampling does.
+ */
+static void expandBeam(const float *logits, int vocabSize, int count, float score, int parent,
+                       BeamCandidate *out)
+{
+    float maxLogit = logits[0];
+    for (int t = 1; t < vocabSize; t++) {
+        if (logits[t] > maxLogit) {
+            maxLogit = logits[t];
+        }
+    }
+    float sum = 0.0f;
+    for (int t = 0; t < vocabSize; t++) {
+        sum += expf(logits[t] - maxLogit);
+    }
+    float logSum = maxLogit + logf(sum);
 
-                case TINYAI_LAYER_OUTPUT:
-                    /* Output layer */
-                    /* For transformers, use only the last position */
-                    {
-                        TinyAIMatrixFP32 *matrix = tinyaiDequantize4bitToFP32(&layer->weights);
+    /* Insertion into a list of count, which is small */
+    int found = 0;
+    for (int t = 0; t < vocabSize; t++) {
+        if (found == count && logits[t] <= logits[out[count - 1].token]) {
+            continue;
+        }
+        int i = found < count ? found++ : count - 1;
+        while (i > 0 && logits[t] > logits[out[i - 1].token]) {
+            out[i] = out[i - 1];
+            i--;
+        }
+        out[i].token = t;
+    }
+    for (int i = 0; i < found; i++) {
+        out[i].score  = score + logits[out[i].token] - logSum;
+        out[i].parent = parent;
+    }
+    for (int i = found; i < count; i++) {
+        out[i].score  = -INFINITY;
+        out[i].parent = parent;
+        out[i].token  = TINYAI_TOKEN_EOS;
+    }
+}
 
-                        if (!matrix) {
-                            return -1;
-                        }
+/* Score of a hypothesis normalized for its length */
+static float normalizedBeamScore(float score, int length, float lengthPenalty)
+{
+    if (lengthPenalty == 0.0f || length <= 1) {
+        return score;
+    }
+    return score / powf((float)length, lengthPenalty);
+}
 
-                        /* For the output layer, we use only the last token's representation */
-                        float *lastTokenRep = input + (inputLength - 1) * layer->inputSize;
+/**
+ * Beam search loop, run under the generation's cancellation token
+ */
+static int generateBeam(TinyAIModel *model, const TinyAIGenerationParams *params,
+                        const TinyAIBeamSearchParams *beam, int *outputTokens, int maxOutputTokens)
+{
+    if (!model || !params || !outputTokens || maxOutputTokens <= 0 || !model->tokenizer) {
+        return 0;
+    }
+    int   width         = beam && beam->beamWidth > 1 ? beam->beamWidth : 1;
+    float lengthPenalty = beam ? beam->lengthPenalty : 0.0f;
+    int   vocabSize     = model->tokenizer->tokenCount;
+    if (width > vocabSize) {
+        width = vocabSize;
+    }
 
-                        /* Matrix multiplication */
-                        for (uint32_t j = 0; j < layer->outputSize; j++) {
-                            float sum = 0.0f;
-                            for (uint32_t k = 0; k < layer->inputSize; k++) {
-                                sum += lastTokenRep[k] * matrix->data[k * layer->outputSize + j];
-                            }
+    /* Start from the prompt exactly as tinyaiGenerateText would */
+    int promptLength;
+    if (!params->promptTokens || params->promptLength == 0) {
+        outputTokens[0] = TINYAI_TOKEN_BOS;
+        promptLength    = 1;
+    }
+    else if (params->promptLength > maxOutputTokens) {
+        return 0;
+    }
+    else {
+        memcpy(outputTokens, params->promptTokens, params->promptLength * sizeof(int));
+        promptLength = params->promptLength;
+    }
 
-                            /* Add bias */
-                            if (layer->biases) {
-                                sum += layer->biases[j];
-                            }
+    int limit    = maxOutputTokens < params->maxTokens ? maxOutputTokens : params->maxTokens;
+    int capacity = limit - promptLength; /* Most tokens a hypothesis may add */
+    if (capacity <= 0) {
+        return promptLength;
+    }
 
-                            /* Store result */
-                            output[j] = sum;
-                        }
+    /* Every beam can hold a private copy of each block, plus one fork in flight */
+    uint32_t blocksPerSequence =
+        (model->contextSize + TINYAI_KV_BLOCK_SIZE - 1) / TINYAI_KV_BLOCK_SIZE;
+    TinyAIKVBlockPool *pool =
+        tinyaiCreateModelKVBlockPool(model, blocksPerSequence * (2 * width + 1), NULL);
+    TinyAIKVCache *root = pool ? tinyaiCreateModelPagedKVCache(model, pool) : NULL;
+
+    TinyAIKVCache **caches     = (TinyAIKVCache **)TINYAI_MALLOC(width * sizeof(TinyAIKVCache *));
+    TinyAIKVCache **nextCaches = (TinyAIKVCache **)TINYAI_MALLOC(width * sizeof(TinyAIKVCache *));
+    int           *beamTokens  = (int *)TINYAI_MALLOC(width * capacity * sizeof(int));
+    int           *nextTokens  = (int *)TINYAI_MALLOC(width * capacity * sizeof(int));
+    int           *bestTokens  = (int *)TINYAI_MALLOC(capacity * sizeof(int));
+    int           *lastTokens  = (int *)TINYAI_MALLOC(width * sizeof(int));
+    int           *parents     = (int *)TINYAI_MALLOC(width * sizeof(int));
+    float         *scores      = (float *)TINYAI_MALLOC(width * sizeof(float));
+    bool          *taken       = (bool *)TINYAI_MALLOC(width * sizeof(bool));
+    float         *logits      = (float *)TINYAI_MALLOC((size_t)width * vocabSize * sizeof(float));
+    uint32_t      *states      = (uint32_t *)TINYAI_MALLOC(width * sizeof(uint32_t));
+    uint32_t      *nextStates  = (uint32_t *)TINYAI_MALLOC(width * sizeof(uint32_t));
+    BeamCandidate *candidates =
+        (BeamCandidate *)TINYAI_MALLOC(width * width * sizeof(BeamCandidate));
+    bool      processed = params->processors && params->processorCount > 0;
+    uint32_t *window    = NULL; /* Sorted recent tokens for the penalty processors */
+    if (processed) {
+        window = (uint32_t *)TINYAI_MALLOC(vocabSize * sizeof(uint32_t));
+    }
 
-                        tinyaiDestroyMatrixFP32(matrix);
-                    }
-                    break;
+    int numBeams = 0;
+    if (root && caches && nextCaches && beamTokens && nextTokens && bestTokens && lastTokens &&
+        parents && scores && taken && logits && states && nextStates && candidates &&
+        (window || !processed)) {
+        /* The prefix and prompt are cached once; every beam forks from them */
+        bool prefilled = true;
+        if (beam && beam->prefixEmbeddings && beam->prefixRows > 0) {
+            prefilled = tinyaiModelForwardCachedEmbeddings(model, root, beam->prefixEmbeddings,
+                                                           beam->prefixRows, logits) == 0;
+        }
+        if (prefilled &&
+            tinyaiModelForwardCached(model, root, outputTokens, promptLength, logits) == 0) {
+            caches[0] = root;
+            scores[0] = 0.0f;
+            states[0] = tinyaiGrammarStartState(params->grammar);
+            numBeams  = 1;
+            root      = NULL;
+        }
+    }
 
-                default:
-                    /* Unsupported layer type */
-                    return -1;
+    int   bestLength = 0;
+    float bestScore  = -INFINITY; /* Normalized score of the best finished hypothesis */
+    int   finished   = 0;
+    int   length     = 0; /* Tokens every live beam has added */
+
+    while (numBeams > 0) {
+        /* Best continuations of every beam, then the best of those overall */
+        for (int b = 0; b < numBeams; b++) {
+            float *beamLogits = logits + (size_t)b * vocabSize;
+            if (processed) {
+                applyLogitProcessors(params, beamLogits, (uint32_t)vocabSize, outputTokens,
+                                     promptLength, beamTokens + b * capacity, length, window);
+            }
+            if (params->grammar && tinyaiGrammarMaskLogits(params->grammar, states[b], beamLogits,
+                                                           (uint32_t)vocabSize) == 0) {
+                /* The grammar allows nothing: the hypothesis can only end */
+                for (int t = 0; t < vocabSize; t++) {
+                    beamLogits[t] = t == TINYAI_TOKEN_EOS ? 0.0f : -INFINITY;
                 }
             }
+            expandBeam(beamLogits, vocabSize, width, scores[b], b, candidates + b * width);
+        }
+        qsort(candidates, numBeams * width, sizeof(BeamCandidate), compareBeamCandidates);
 
-            /* Copy final logits to output */
-            if (model->tokenizer->tokenCount <= model->layerCount) {
-                /* Vocabulary too small, there's a problem */
-                return -1;
+        /* End-of-sequence finishes a hypothesis; other tokens fill the next beams */
+        int nextBeams = 0;
+        for (int c = 0; c < numBeams * width && nextBeams < width; c++) {
+            const BeamCandidate *candidate = &candidates[c];
+            if (candidate->score == -INFINITY) {
+                break;
+            }
+            if (candidate->token == TINYAI_TOKEN_EOS) {
+                float score = normalizedBeamScore(candidate->score, length, lengthPenalty);
+                if (score > bestScore) {
+                    bestScore  = score;
+                    bestLength = length;
+                    memcpy(bestTokens, beamTokens + candidate->parent * capacity,
+                           length * sizeof(int));
+                }
+                finished++;
+                continue;
+            }
+            memcpy(nextTokens + nextBeams * capacity, beamTokens + candidate->parent * capacity,
+                   length * sizeof(int));
+            nextTokens[nextBeams * capacity + length] = candidate->token;
+            scores[nextBeams]                         = candidate->score;
+            parents[nextBeams]                        = candidate->parent;
+            nextStates[nextBeams]                     = states[candidate->parent];
+            if (params->grammar) {
+                nextStates[nextBeams] = (uint32_t)tinyaiGrammarAdvance(
+                    params->grammar, states[candidate->parent], candidate->token);
+            }
+            nextBeams++;
+        }
+
+        /* A beam's first survivor takes its cache; later ones fork it, sharing its blocks
+         * until they write to them */
+        memset(taken, 0, width * sizeof(bool));
+        for (int i = 0; i < nextBeams; i++) {
+            int parent = parents[i];
+            if (!taken[parent]) {
+                taken[parent] = true;
+                nextCaches[i] = caches[parent];
+            }
+            else {
+                nextCaches[i] = tinyaiForkKVCache(caches[parent]);
+            }
+        }
+        for (int b = 0; b < numBeams; b++) {
+            if (!taken[b]) {
+                tinyaiDestroyKVCache(caches[b]);
             }
+        }
 
-            /* Get the final output layer's values */
-            float *finalOutput = model->activations[model->activeBuffer];
-            memcpy(output, finalOutput, model->tokenizer->tokenCount * sizeof(float));
+        /* Drop beams whose fork failed */
+        int kept = 0;
+        for (int i = 0; i < nextBeams; i++) {
+            if (!nextCaches[i]) {
+                continue;
+            }
+            nextCaches[kept] = nextCaches[i];
+            scores[kept]     = scores[i];
+            nextStates[kept] = nextStates[i];
+            memmove(nextTokens + kept * capacity, nextTokens + i * capacity,
+                    (length + 1) * sizeof(int));
+            kept++;
         }
-        break;
 
-    default:
-        /* Unsupported model type */
-        return -1;
+        TinyAIKVCache **swapCaches = caches;
+        caches                     = nextCaches;
+        nextCaches                 = swapCaches;
+        int *swapTokens            = beamTokens;
+        beamTokens                 = nextTokens;
+        nextTokens                 = swapTokens;
+        uint32_t *swapStates       = states;
+        states                     = nextStates;
+        nextStates                 = swapStates;
+        numBeams                   = kept;
+        length++;
+
+        if (finished >= width || length >= capacity || numBeams == 0) {
+            break;
+        }
+
+        /* Advance every beam by its newest token in one batched forward pass */
+        bool fits = true;
+        for (int b = 0; b < numBeams; b++) {
+            lastTokens[b] = beamTokens[b * capacity + length - 1];
+            fits          = fits && tinyaiKVCacheFits(caches[b], 1);
+        }
+        if (!fits) {
+            break;
+        }
+
+        bool stepped = false;
+        if (batchDecodeSupported(model) && (uint32_t)numBeams <= model->contextSize &&
+            batchedDecodeStep(model, caches, lastTokens, (uint32_t)numBeams, logits) == 0) {
+            stepped = true;
+            for (int b = 0; b < numBeams; b++) {
+                stepped = stepped && tinyaiKVCacheAdvance(caches[b], 1) == 0;
+            }
+        }
+        else {
+            stepped = true;
+            for (int b = 0; b < numBeams && stepped; b++) {
+                stepped = tinyaiModelForwardCached(model, caches[b], &lastTokens[b], 1,
+                                                   logits + (size_t)b * vocabSize) == 0;
+            }
+        }
+        if (!stepped) {
+            break;
+        }
     }
 
-    return 0;
+    /* Live beams compete with the finished hypotheses; under a grammar, one cut off
+     * mid-match only stands in when no hypothesis matches */
+    bool matchOnly = params->grammar && finished > 0;
+    for (int b = 0; b < numBeams && params->grammar && !matchOnly; b++) {
+        matchOnly = tinyaiGrammarAccepts(params->grammar, states[b]);
+    }
+    for (int b = 0; b < numBeams; b++) {
+        if (matchOnly && !tinyaiGrammarAccepts(params->grammar, states[b])) {
+            continue;
+        }
+        float score = normalizedBeamScore(scores[b], length, lengthPenalty);
+        if (score > bestScore) {
+            bestScore  = score;
+            bestLength = length;
+            memcpy(bestTokens, beamTokens + b * capacity, length * sizeof(int));
+        }
+    }
+    if (bestTokens && bestLength > 0) {
+        memcpy(outputTokens + promptLength, bestTokens, bestLength * sizeof(int));
+    }
+
+    for (int b = 0; b < numBeams; b++) {
+        tinyaiDestroyKVCache(caches[b]);
+    }
+    tinyaiDestroyKVCache(root);
+    tinyaiDestroyKVBlockPool(pool);
+    if (caches)
+        TINYAI_FREE(caches);
+    if (nextCaches)
+        TINYAI_FREE(nextCaches);
+    if (beamTokens)
+        TINYAI_FREE(beamTokens);
+    if (nextTokens)
+        TINYAI_FREE(nextTokens);
+    if (bestTokens)
+        TINYAI_FREE(bestTokens);
+    if (lastTokens)
+        TINYAI_FREE(lastTokens);
+    if (parents)
+        TINYAI_FREE(parents);
+    if (scores)
+        TINYAI_FREE(scores);
+    if (taken)
+        TINYAI_FREE(taken);
+    if (logits)
+        TINYAI_FREE(logits);
+    if (states)
+        TINYAI_FREE(states);
+    if (nextStates)
+        TINYAI_FREE(nextStates);
+    if (candidates)
+        TINYAI_FREE(candidates);
+    if (window)
+        TINYAI_FREE(window);
+
+    return promptLength + bestLength;
 }
 
 /**
- * Sample the next token from output probabilities
+ * Generate text with beam search
  */
-int tinyaiSampleToken(const float *output, int vocabSize, const TinyAIGenerationParams *params)
+int tinyaiGenerateTextBeam(TinyAIModel *model, const TinyAIGenerationParams *params,
+                           const TinyAIBeamSearchParams *beam, int *outputTokens,
+                           int maxOutputTokens)
 {
-    if (!output || !params) {
-        return 0; /* Default to first token on error */
-    }
-
-    /* Allocate buffer for probabilities */
-    float *probs = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
-    if (!probs) {
-        return 0; /* Default to first token on error */
+    if (!params) {
+        return 0;
     }
 
-    /* Copy and apply temperature */
-    memcpy(probs, output, vocabSize * sizeof(float));
-    applyTemperature(probs, vocabSize, params->temperature);
+    TinyAICancelToken *previous = useGenerationCancel(params);
+    int                result   = generateBeam(model, params, beam, outputTokens, maxOutputTokens);
+    tinyaiUseCancelToken(previous);
+    return result;
+}
 
-    /* Convert to probabilities using softmax */
-    softmax(probs, vocabSize);
+/**
+ * Zero every probability except those of the first count indices
+ */
+static void keepCandidates(float *probs, uint32_t size, const uint32_t *indices, uint32_t count,
+                           float *scratch)
+{
+    memset(scratch, 0, size * sizeof(float));
+    for (uint32_t i = 0; i < count; i++) {
+        scratch[indices[i]] = probs[indices[i]];
+    }
+    memcpy(probs, scratch, size * sizeof(float));
+}
 
-    /* Sample token based on method */
-    int token;
+/**
+ * Compute the distribution a sampling method draws from
+ *
+ * Tokens excluded by the method get probability zero: greedy keeps only the
+ * first highest-probability token, top-K and top-P keep their candidate
+ * sets. The result is renormalised to sum to one. probs and sortScratch hold
+ * vocabSize floats, indices vocabSize entries.
+ */
+static void samplingDistribution(const float *logits, uint32_t vocabSize,
+                                 const TinyAIGenerationParams *params, float *probs,
+                                 float *sortScratch, uint32_t *indices)
+{
+    /* Same temperature and softmax as sampleTokenWithScratch */
+    softmax(probs, logits, vocabSize, params->temperature);
 
     switch (params->samplingMethod) {
-    case TINYAI_SAMPLING_GREEDY:
-        /* Choose highest probability token */
-        token = 0;
-        for (int i = 1; i < vocabSize; i++) {
-            if (probs[i] > probs[token]) {
-                token = i;
-            }
-        }
+    case TINYAI_SAMPLING_TEMPERATURE:
         break;
 
     case TINYAI_SAMPLING_TOP_K:
-        token = sampleTopK(probs, vocabSize, params->topK);
+        if (params->topK > 0 && params->topK < vocabSize) {
+            selectTopK(probs, vocabSize, params->topK, indices);
+            keepCandidates(probs, vocabSize, indices, params->topK, sortScratch);
+        }
         break;
 
     case TINYAI_SAMPLING_TOP_P:
-        token = sampleTopP(probs, vocabSize, params->topP);
+        if (params->topP < 1.0f) {
+            uint32_t cutoffIdx = selectTopP(probs, vocabSize, params->topP, indices);
+            keepCandidates(probs, vocabSize, indices, cutoffIdx, sortScratch);
+        }
         break;
 
-    case TINYAI_SAMPLING_TEMPERATURE:
-        /* Already applied temperature, sample directly */
+    default:
+        /* Greedy and unknown methods: all mass on the first maximum */
         {
-            float r      = randomFloat();
-            float cumSum = 0.0f;
+            int token = tinyaiSimdArgmax(probs, (int)vocabSize);
+            memset(probs, 0, vocabSize * sizeof(float));
+            probs[token] = 1.0f;
+        }
+        return;
+    }
 
-            token = 0; /* Default */
+    /* Renormalise the kept tokens */
+    float sum = tinyaiSimdReduceSum(probs, (int)vocabSize);
+    if (sum > 0.0f) {
+        for (uint32_t i = 0; i < vocabSize; i++) {
+            probs[i] /= sum;
+        }
+    }
+}
 
-            for (int i = 0; i < vocabSize; i++) {
-                cumSum += probs[i];
-                if (r < cumSum) {
-                    token = i;
-                    break;
-                }
-            }
+/**
+ * Draw a token from unnormalised probabilities summing to total
+ */
+static int sampleFromDistribution(const float *probs, uint32_t size, float total)
+{
+    float r      = randomFloat() * total;
+    float cumSum = 0.0f;
+    int   result = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        if (probs[i] <= 0.0f) {
+            continue;
         }
-        break;
 
-    default:
-        /* Unknown sampling method, use greedy */
-        token = 0;
-        for (int i = 1; i < vocabSize; i++) {
-            if (probs[i] > probs[token]) {
-                token = i;
-            }
+        cumSum += probs[i];
+        result = (int)i; /* Last candidate absorbs rounding error */
+        if (r < cumSum) {
+            break;
         }
-        break;
     }
 
-    /* Clean up */
-    TINYAI_FREE(probs);
+    return result;
+}
 
-    return token;
+/**
+ * Roll a cache back so it holds only the first validTokens tokens
+ *
+ * When the positions to drop predate the cache window, the cache is reset
+ * and the next step refeeds from the trailing window.
+ */
+static void rollbackCache(TinyAIKVCache *cache, int *fedTokens, int validTokens)
+{
+    if (!cache || *fedTokens <= validTokens) {
+        return;
+    }
+
+    /* Recurrent state cannot be truncated and is rebuilt from the start */
+    uint32_t drop = (uint32_t)(*fedTokens - validTokens);
+    if (drop > cache->length || tinyaiKVCacheTruncate(cache, cache->length - drop) != 0) {
+        tinyaiResetKVCache(cache);
+        *fedTokens = 0;
+        return;
+    }
+
+    *fedTokens = validTokens;
 }
 
 /**
- * Generate text from a model
+ * Compute logits after each of the last rows tokens in one forward pass
+ *
+ * Row r of allLogits holds the logits for the token following
+ * tokens[0..numTokens-rows+r]. Earlier tokens not yet in the cache are fed
+ * first; scratchLogits (vocab size) receives their unused logits.
  */
-int tinyaiGenerateText(TinyAIModel *model, const TinyAIGenerationParams *params, int *outputTokens,
-                       int maxOutputTokens)
+static int verifyLogits(TinyAIModel *model, TinyAIKVCache *cache, const int *tokens,
+                        int numTokens, int *fedTokens, int rows, float *scratchLogits,
+                        float *allLogits)
+{
+    if (numTokens - *fedTokens < rows) {
+        rollbackCache(cache, fedTokens, numTokens - rows);
+    }
+
+    int pending = numTokens - *fedTokens;
+    if (!tinyaiKVCacheFits(cache, (uint32_t)pending)) {
+        /* Same rebuild policy as nextTokenLogits, keeping at least the rows */
+        int keep = (int)cache->maxSeqLength / 2;
+        if (keep < rows) {
+            keep = rows;
+        }
+        if (keep > numTokens) {
+            keep = numTokens;
+        }
+
+        tinyaiResetKVCache(cache);
+        *fedTokens = numTokens - keep;
+        pending    = keep;
+    }
+
+    /* Feed the prefix up to the first verified position */
+    if (pending > rows) {
+        if (tinyaiModelForwardCached(model, cache, tokens + *fedTokens, pending - rows,
+                                     scratchLogits) != 0) {
+            return -1;
+        }
+        *fedTokens += pending - rows;
+    }
+
+    const int *rowTokens = tokens + *fedTokens;
+    uint32_t   vocabSize = model->tokenizer->tokenCount;
+    int        result;
+
+    if (model->type == TINYAI_MODEL_TYPE_TRANSFORMER || batchDecodeSupported(model)) {
+        result = sequenceForward(model, cache, rowTokens, rows, allLogits, true);
+    }
+    else {
+        /* One token per pass, each extending the recurrent state */
+        result = 0;
+        for (int r = 0; r < rows && result == 0; r++) {
+            result =
+                sequenceForward(model, cache, rowTokens + r, 1, allLogits + r * vocabSize, false);
+        }
+    }
+
+    if (result != 0 || tinyaiKVCacheAdvance(cache, (uint32_t)rows) != 0) {
+        return -1;
+    }
+
+    *fedTokens = numTokens;
+    return 0;
+}
+
+/**
+ * Speculative decoding loop, run under the generation's cancellation token
+ */
+static int generateSpeculative(TinyAIModel *model, TinyAIModel *draftModel, int draftLength,
+                               const TinyAIGenerationParams *params, int *outputTokens,
+                               int maxOutputTokens)
 {
     if (!model || !params || !outputTokens || maxOutputTokens <= 0) {
         return 0;
     }
 
+    /* Verification needs room for the drafts plus the bonus row */
+    int k = draftLength;
+    if (k > (int)model->contextSize - 1) {
+        k = (int)model->contextSize - 1;
+    }
+
+    /* Acceptance sampling would need the grammar's mask and the logit processors
+     * applied to both models' distributions at every drafted position, so such
+     * runs decode plainly */
+    if (!draftModel || k <= 0 || !draftModel->tokenizer || params->grammar ||
+        params->processorCount > 0 ||
+        draftModel->tokenizer->tokenCount != model->tokenizer->tokenCount) {
+        return tinyaiGenerateText(model, params, outputTokens, maxOutputTokens);
+    }
+
+    uint32_t                   vocabSize = model->tokenizer->tokenCount;
+    TinyAIGenerationWorkspace *target    = tinyaiCreateGenerationWorkspace(model);
+    TinyAIGenerationWorkspace *draft     = tinyaiCreateGenerationWorkspace(draftModel);
+    float *allLogits  = (float *)TINYAI_MALLOC((k + 1) * vocabSize * sizeof(float));
+    float *draftProbs = (float *)TINYAI_MALLOC(k * vocabSize * sizeof(float));
+
+    if (!target || !draft || !target->cache || !allLogits || !draftProbs) {
+        tinyaiDestroyGenerationWorkspace(target);
+        tinyaiDestroyGenerationWorkspace(draft);
+        if (allLogits)
+            TINYAI_FREE(allLogits);
+        if (draftProbs)
+            TINYAI_FREE(draftProbs);
+        return tinyaiGenerateText(model, params, outputTokens, maxOutputTokens);
+    }
+
     /* Initialize random number generator */
     seedRandom(params->seed);
 
-    /* Check if prompt is provided */
-    if (!params->promptTokens || params->promptLength == 0) {
-        /* Start with BOS token */
-        outputTokens[0] = TINYAI_TOKEN_BOS;
+    int numTokens = startSequence(params, outputTokens, maxOutputTokens);
+    int limit     = maxOutputTokens < params->maxTokens ? maxOutputTokens : params->maxTokens;
+    int targetFed = 0;
+    int draftFed  = 0;
 
-        int numTokens = 1;
+    if (draft->cache) {
+        tinyaiResetKVCache(draft->cache);
+    }
+    tinyaiResetKVCache(target->cache);
 
-        /* Generate tokens */
-        while (numTokens < maxOutputTokens && numTokens < params->maxTokens) {
-            /* Forward pass */
-            float *logits = (float *)TINYAI_MALLOC(model->tokenizer->tokenCount * sizeof(float));
-            if (!logits) {
-                /* Memory allocation failed */
-                break;
-            }
+    while (numTokens > 0 && numTokens < limit) {
+        int numBefore = numTokens;
+        int drafted   = 0;
 
-            /* Get logits for next token */
-            int result = tinyaiModelForward(model, outputTokens, numTokens, logits);
-            if (result != 0) {
-                TINYAI_FREE(logits);
+        /* Draft up to k tokens, stopping early at EOS */
+        while (drafted < k && numTokens < limit) {
+            if (nextTokenLogits(draftModel, draft->cache, outputTokens, numTokens, &draftFed,
+                                draft->logits) != 0) {
                 break;
             }
 
-            /* Sample next token */
-            int nextToken = tinyaiSampleToken(logits, model->tokenizer->tokenCount, params);
-            TINYAI_FREE(logits);
+            float *q = draftProbs + drafted * vocabSize;
+            samplingDistribution(draft->logits, vocabSize, params, q, draft->sortScratch,
+                                 draft->indices);
+            int token = sampleFromDistribution(q, vocabSize, 1.0f);
 
-            /* Check for EOS token */
-            if (nextToken == TINYAI_TOKEN_EOS) {
+            outputTokens[numTokens++] = token;
+            drafted++;
+
+            if (token == TINYAI_TOKEN_EOS) {
                 break;
             }
-
-            /* Add token to output */
-            outputTokens[numTokens++] = nextToken;
         }
 
-        return numTokens;
-    }
-    else {
-        /* Start with prompt */
-        if (params->promptLength > maxOutputTokens) {
-            /* Prompt too long */
-            return 0;
+        /* Target logits after the last committed token and after each draft */
+        if (verifyLogits(model, target->cache, outputTokens, numTokens, &targetFed, drafted + 1,
+                         target->logits, allLogits) != 0) {
+            numTokens = numBefore;
+            break;
         }
 
-        /* Copy prompt */
-        memcpy(outputTokens, params->promptTokens, params->promptLength * sizeof(int));
-        int numTokens = params->promptLength;
-
-        /* Generate tokens */
-        while (numTokens < maxOutputTokens && numTokens < params->maxTokens) {
-            /* Forward pass */
-            float *logits = (float *)TINYAI_MALLOC(model->tokenizer->tokenCount * sizeof(float));
-            if (!logits) {
-                /* Memory allocation failed */
+        /* Accept each draft with probability min(1, p/q) */
+        int  accepted = 0;
+        int  nextToken;
+        bool done = false;
+
+        for (;;) {
+            float *p = target->probs;
+            samplingDistribution(allLogits + accepted * vocabSize, vocabSize, params, p,
+                                 target->sortScratch, target->indices);
+
+            if (accepted == drafted) {
+                /* Every draft accepted: the last row yields a bonus token */
+                nextToken = sampleFromDistribution(p, vocabSize, 1.0f);
                 break;
             }
 
-            /* Get logits for next token */
-            int contextSize = numTokens;
-            if (contextSize > model->contextSize) {
-                contextSize = model->contextSize;
-            }
+            const float *q     = draftProbs + accepted * vocabSize;
+            int          token = outputTokens[numBefore + accepted];
 
-            int result = tinyaiModelForward(model, outputTokens + numTokens - contextSize,
-                                            contextSize, logits);
-            if (result != 0) {
-                TINYAI_FREE(logits);
-                break;
+            if (p[token] >= q[token] || randomFloat() * q[token] < p[token]) {
+                accepted++;
+                if (token == TINYAI_TOKEN_EOS) {
+                    done = true;
+                    break;
+                }
+                continue;
             }
 
-            /* Sample next token */
-            int nextToken = tinyaiSampleToken(logits, model->tokenizer->tokenCount, params);
-            TINYAI_FREE(logits);
+            /* Rejected: resample from the residual max(0, p - q) */
+            float residual = 0.0f;
+            for (uint32_t i = 0; i < vocabSize; i++) {
+                float diff = p[i] - q[i];
+                p[i]       = diff > 0.0f ? diff : 0.0f;
+                residual += p[i];
+            }
 
-            /* Check for EOS token */
-            if (nextToken == TINYAI_TOKEN_EOS) {
-                break;
+            if (residual > 0.0f) {
+                nextToken = sampleFromDistribution(p, vocabSize, residual);
+            }
+            else {
+                samplingDistribution(allLogits + accepted * vocabSize, vocabSize, params, p,
+                                     target->sortScratch, target->indices);
+                nextToken = sampleFromDistribution(p, vocabSize, 1.0f);
             }
+            break;
+        }
 
-            /* Add token to output */
-            outputTokens[numTokens++] = nextToken;
+        /* Keep the accepted drafts; an accepted EOS ends the text */
+        numTokens = numBefore + accepted;
+        if (done) {
+            numTokens--;
         }
 
-        return numTokens;
+        rollbackCache(target->cache, &targetFed, numTokens);
+        rollbackCache(draft->cache, &draftFed, numTokens);
+
+        if (done || numTokens >= limit || nextToken == TINYAI_TOKEN_EOS) {
+            break;
+        }
+
+        outputTokens[numTokens++] = nextToken;
+    }
+
+    tinyaiDestroyGenerationWorkspace(target);
+    tinyaiDestroyGenerationWorkspace(draft);
+    TINYAI_FREE(allLogits);
+    TINYAI_FREE(draftProbs);
+
+    return numTokens;
+}
+
+/**
+ * Generate text with a draft model proposing tokens for the target to verify
+ */
+int tinyaiGenerateTextSpeculative(TinyAIModel *model, TinyAIModel *draftModel, int draftLength,
+                                  const TinyAIGenerationParams *params, int *outputTokens,
+                                  int maxOutputTokens)
+{
+    if (!params) {
+        return 0;
     }
+
+    TinyAICancelToken *previous = useGenerationCancel(params);
+    int                result   = generateSpeculative(model, draftModel, draftLength, params,
+                                                      outputTokens, maxOutputTokens);
+    tinyaiUseCancelToken(previous);
+    return result;
 }
 
 /**
@@ -1186,6 +6427,9 @@ int tinyaiQuantizeModel(TinyAIModel *model)
         return -1;
     }
 
+    /* Weights change format, so the plan is rebuilt on the next pass */
+    invalidateModelPlan(model);
+
     /* Each layer is already 4-bit quantized during loading */
     /* This function is a placeholder for higher-precision models that need conversion */
 
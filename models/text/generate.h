@@ -8,9 +8,18 @@
 #ifndef TINYAI_GENERATE_H
 #define TINYAI_GENERATE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "tokenizer.h"
+#include "attention.h"
+#include "grammar.h"
+#include "prefix_cache.h"
+#include "../../utils/cancel.h"
+#include "../../utils/memory_governor.h"
+#include "../../utils/performance_impact.h"
+#include "../../utils/progressive_loader.h"
 #include "../../utils/quantize.h"
+#include <stdio.h>
 
 /* ----------------- Constants ----------------- */
 
@@ -32,6 +41,7 @@
 #define TINYAI_ACTIVATION_SIGMOID     2
 #define TINYAI_ACTIVATION_TANH        3
 #define TINYAI_ACTIVATION_GELU        4
+#define TINYAI_ACTIVATION_SILU        5
 
 /* Sampling method constants */
 #define TINYAI_SAMPLING_GREEDY        0
@@ -39,6 +49,45 @@
 #define TINYAI_SAMPLING_TOP_K         2
 #define TINYAI_SAMPLING_TOP_P         3
 
+/* Logit processors, applied in order before temperature and sampling */
+#define TINYAI_LOGIT_REPETITION_PENALTY 0 /* Push logits of seen tokens down by a factor */
+#define TINYAI_LOGIT_PRESENCE_PENALTY   1 /* Subtract value from the logit of every seen token */
+#define TINYAI_LOGIT_FREQUENCY_PENALTY  2 /* Subtract value per occurrence of a seen token */
+#define TINYAI_LOGIT_BIAS               3 /* Add biases[i] to the logit of tokens[i] */
+#define TINYAI_LOGIT_BAN                4 /* Exclude tokens[i] from sampling */
+
+/* Pooling of the final hidden states into a text embedding */
+#define TINYAI_POOLING_MEAN           0 /* Average over every position */
+#define TINYAI_POOLING_LAST           1 /* Last position, the only one a causal model fully sees */
+
+/* Weight formats a dense or output layer can run on */
+#define TINYAI_WEIGHT_FORMAT_DENSE    0 /* Packed 4-bit weights */
+#define TINYAI_WEIGHT_FORMAT_CSR_4BIT 1 /* 4-bit CSR rows (unstructured sparsity) */
+#define TINYAI_WEIGHT_FORMAT_BSR      2 /* Block-sparse rows of 4 x 8 blocks */
+
+/* Storage of the activations passed between layers */
+#define TINYAI_ACTIVATIONS_FP32       0 /* 32-bit floats */
+#define TINYAI_ACTIVATIONS_FP16       1 /* IEEE half precision */
+#define TINYAI_ACTIVATIONS_BF16       2 /* bfloat16: the float range with an 8-bit mantissa */
+
+/* Threads a layer's kernels run on */
+#define TINYAI_LAYER_THREADS_POOL     0 /* The kernel thread pool of the calling thread */
+#define TINYAI_LAYER_THREADS_SERIAL   1 /* The calling thread alone */
+
+/* Projections of a layer a low-rank adapter can update */
+#define TINYAI_ADAPTER_WEIGHTS        0 /* Weights of a dense or output layer */
+#define TINYAI_ADAPTER_QUERY          0 /* Query projection of an attention layer */
+#define TINYAI_ADAPTER_KEY            1 /* Key projection of an attention layer */
+#define TINYAI_ADAPTER_VALUE          2 /* Value projection of an attention layer */
+#define TINYAI_ADAPTER_OUTPUT         3 /* Output projection of an attention layer */
+
+/* Model weight file version (2 adds per-group scales for 4-bit weights) */
+#define TINYAI_WEIGHTS_VERSION        2
+
+/* Prepared model snapshot format */
+#define TINYAI_SNAPSHOT_MAGIC         0x504E5354 /* "TSNP" */
+#define TINYAI_SNAPSHOT_VERSION       2 /* 2 records the threads of each layer */
+
 /* ----------------- Types ----------------- */
 
 /**
@@ -59,10 +108,36 @@ typedef struct {
     TinyAIActivation activation;   /* Activation function */
     uint32_t inputSize;            /* Input size */
     uint32_t outputSize;           /* Output size */
-    TinyAIMatrix4bit weights;      /* Layer weights (4-bit quantized) */
+    TinyAIMatrix4bit weights;      /* Layer weights (4-bit quantized; recurrent layers have
+                                      (inputSize + outputSize) rows for [input; hidden]) */
     float *biases;                 /* Layer biases */
+    TinyAISelfAttention *attention; /* Attention weights (attention layers only, owned) */
 } TinyAILayer;
 
+/**
+ * Costs of one layer, aggregated over profiled forward passes
+ */
+typedef struct {
+    TinyAILayerType type;          /* Layer type */
+    uint64_t calls;                /* Forward passes that ran the layer */
+    uint64_t rows;                 /* Positions processed */
+    double timeMs;                 /* Wall time in milliseconds */
+    uint64_t flops;                /* Floating-point operations (a multiply-add counts 2) */
+    uint64_t weightBytes;          /* Bytes of weights and caches read */
+    uint64_t allocations;          /* Heap allocations made by the layer */
+    uint64_t exits;                /* Forward passes that stopped early after the layer */
+} TinyAILayerProfile;
+
+/**
+ * Compiled execution plan of a model (opaque)
+ */
+typedef struct TinyAIModelPlan TinyAIModelPlan;
+
+/**
+ * Low-rank adapter of a model's dense, output and attention layers (opaque)
+ */
+typedef struct TinyAIAdapter TinyAIAdapter;
+
 /**
  * Model structure
  */
@@ -73,10 +148,44 @@ typedef struct {
     TinyAITokenizer *tokenizer;    /* Tokenizer */
     uint32_t hiddenSize;           /* Hidden size */
     uint32_t contextSize;          /* Maximum context size */
-    float *activations[2];         /* Ping-pong activation buffers */
+    float *activations[2];         /* Ping-pong activation buffers (16-bit values, despite the
+                                      type, under half-precision activations) */
+    uint32_t activationPrecision;  /* Storage of the activations (TINYAI_ACTIVATIONS_*) */
     int activeBuffer;              /* Active buffer index */
+    TinyAIKVCache *scratchCache;   /* Private KV cache for uncached forward passes */
+    TinyAIPrefixCache *prefixCache; /* Shared prompt-prefix cache (NULL if disabled) */
+    TinyAIModelPlan *plan;         /* Compiled execution plan (NULL until prepared) */
+    uint32_t *shortlist;           /* Sorted tokens whose logits are computed (NULL for all) */
+    uint32_t shortlistSize;        /* Number of shortlisted tokens */
+    float *shortlistLogits;        /* Scratch logits of the shortlisted tokens */
+    TinyAILayerProfile *profile;   /* Per-layer costs (NULL when profiling is off) */
+    uint32_t profileLayers;        /* Entries in profile */
+    uint64_t profilePasses;        /* Forward passes profiled */
+    TinyAIProgressiveLoader *loader; /* Source of layer weight data (NULL: held in memory) */
+    void *snapshot;                /* Mapped snapshot the weights and vocabulary live in
+                                      (NULL if not loaded from one) */
+    size_t snapshotSize;           /* Size of the snapshot mapping in bytes */
+    const TinyAIAdapter *adapter;  /* Active low-rank adapter (NULL: base weights) */
+    float *exitThresholds;         /* Confidence to stop after each layer, negative for no exit
+                                      (NULL: every pass runs every layer) */
 } TinyAIModel;
 
+/**
+ * Logit processor
+ *
+ * Every processor touches only the tokens it names or the tokens seen in
+ * its window, so its cost does not grow with the vocabulary.
+ */
+typedef struct {
+    uint32_t type;                 /* Processor type (TINYAI_LOGIT_*) */
+    float value;                   /* Penalty: a factor above 1 for repetition, else an offset */
+    int window;                    /* Most recent tokens a penalty looks at (0 for all, at most
+                                      the vocabulary size) */
+    const int *tokens;             /* Tokens biased or banned */
+    const float *biases;           /* Bias of each token (TINYAI_LOGIT_BIAS) */
+    int tokenCount;                /* Number of tokens */
+} TinyAILogitProcessor;
+
 /**
  * Generation parameters structure
  */
@@ -89,8 +198,72 @@ typedef struct {
     uint32_t seed;                 /* Random seed (0 for random) */
     int *promptTokens;             /* Prompt tokens (can be NULL) */
     int promptLength;              /* Prompt length */
+    const TinyAIGrammar *grammar;  /* Constraint on the generated text (NULL for none) */
+    const TinyAILogitProcessor *processors; /* Logit processors, applied in order (can be NULL;
+                                               must outlive generation) */
+    int processorCount;            /* Number of logit processors */
+    TinyAICancelToken *cancel;     /* Stops generation within one layer once cancelled or past
+                                      its deadline (NULL keeps the thread's installed token) */
 } TinyAIGenerationParams;
 
+/**
+ * Beam search parameters structure
+ */
+typedef struct {
+    int beamWidth;                 /* Hypotheses kept per step (1 = greedy) */
+    float lengthPenalty;           /* Scores are divided by length^lengthPenalty (0 = none) */
+    const float *prefixEmbeddings; /* Rows fed before the prompt, e.g. image features
+                                      [prefixRows x embedding size] (can be NULL) */
+    int prefixRows;                /* Number of prefix rows */
+} TinyAIBeamSearchParams;
+
+/**
+ * Callback receiving each generated token as soon as it is sampled
+ *
+ * @param token Generated token ID
+ * @param piece Text the token appends to the decoded output (may be empty)
+ * @param userData User-provided data pointer
+ * @return true to continue generation, false to stop after this token
+ */
+typedef bool (*TinyAITokenCallback)(int token, const char *piece, void *userData);
+
+/**
+ * Generation workspace structure
+ *
+ * Buffers sized once from a model and reused for every decode step, so
+ * steady-state generation performs no heap allocations. A workspace must be
+ * recreated if the model's vocabulary or attention layers change.
+ */
+typedef struct {
+    uint32_t vocabSize;            /* Vocabulary size the buffers hold */
+    float *logits;                 /* Next-token logits */
+    float *probs;                  /* Sampling probabilities */
+    float *sortScratch;            /* Sampling scratch values */
+    uint32_t *indices;             /* Sampling scratch indices */
+    TinyAIKVCache *cache;          /* KV cache for the sequence (NULL to recompute) */
+} TinyAIGenerationWorkspace;
+
+/**
+ * Memory of a model by subsystem
+ *
+ * Heap bytes are split by what they hold. Weights and vocabulary read in
+ * place from a mapped snapshot or vocabulary file are counted under mapped
+ * instead, and mappedResident tells how much of that is paged in.
+ */
+typedef struct {
+    size_t weights;        /* Heap weights and biases, with sparse copies made by the plan */
+    size_t kvCache;        /* Private KV cache and prompt-prefix cache */
+    size_t activations;    /* Activation buffers, plan and attention scratch, shortlist */
+    size_t tokenizer;      /* Heap vocabulary, indexes, merge rules and word cache */
+    size_t mapped;         /* Bytes of mapped snapshot and vocabulary files */
+    size_t mappedResident; /* Mapped bytes resident in memory */
+} TinyAIModelMemoryUsage;
+
+/**
+ * Continuously batched generation of independent sequences (opaque)
+ */
+typedef struct TinyAIGenerationBatch TinyAIGenerationBatch;
+
 /* ----------------- API Functions ----------------- */
 
 /**
@@ -129,12 +302,30 @@ int tinyaiAddLayer(TinyAIModel *model, TinyAILayerType type,
 /**
  * Load model weights from a file
  * 
+ * Each layer's 4-bit weights are stored as scale and zero point, then (from
+ * version 2) a group size followed, when non-zero, by the per-group scales
+ * and zero points, then the packed data.
+ * 
  * @param model Model to load into
  * @param path File path
  * @return 0 on success, non-zero on error
  */
 int tinyaiLoadModelWeights(TinyAIModel *model, const char *path);
 
+/**
+ * Repack a model's 4-bit weights into the panel layout
+ * 
+ * Each dense, output and recurrent layer's weights, and each attention
+ * layer's projections, are repacked once with tinyaiMatrix4bitPrepack;
+ * embeddings and group-quantized weights stay row-major. The layout is
+ * recorded in each matrix, so calling this again does nothing. Setting the
+ * "model.prepack_weights" config option makes tinyaiLoadModelWeights do it.
+ * 
+ * @param model Model whose weights to repack
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiPrepackModelWeights(TinyAIModel *model);
+
 /**
  * Load a complete model from files
  * 
@@ -146,9 +337,149 @@ int tinyaiLoadModelWeights(TinyAIModel *model, const char *path);
 TinyAIModel* tinyaiLoadModel(const char *modelPath, const char *weightsPath, 
                            const char *tokenizerPath);
 
+/**
+ * Save a prepared model as a snapshot
+ * 
+ * Writes everything a model needs to start generating in one file: the
+ * weights repacked for the SIMD kernels (the model's own weights are
+ * prepacked first, as tinyaiPrepackModelWeights does), the attention
+ * weights, the vocabulary with its hash indexes in the binary vocabulary
+ * format, and the weight format and threads the execution plan chose for
+ * each layer.
+ * Every data section is 64-byte aligned so it can be used straight from a
+ * mapping. Models streaming their weights from a progressive loader cannot
+ * be saved.
+ * 
+ * @param model Model to save
+ * @param path Snapshot file path
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSaveModelSnapshot(TinyAIModel *model, const char *path);
+
+/**
+ * Load a model from a snapshot written by tinyaiSaveModelSnapshot
+ * 
+ * The file is mapped read-only and its weights, biases and vocabulary are
+ * used in place, so loading costs little more than validating the file and
+ * rebuilding the sparse copies of the layers whose recorded format is CSR or
+ * BSR; no layer's sparsity is measured, benchmarked or autotuned again. The
+ * model owns the mapping and its tokenizer, and tinyaiDestroyModel releases
+ * both.
+ * 
+ * The mapping is shared, so worker processes loading the same snapshot all
+ * read one copy of the weights from the page cache. Layers recorded as CSR
+ * or BSR still get sparse copies of their own in every process unless the
+ * "model.shared_weights" config option is set, which runs them on the shared
+ * dense weights instead so each process holds no weights of its own.
+ * 
+ * @param path Snapshot file path
+ * @return Prepared model, or NULL if the file is missing, truncated or corrupt
+ */
+TinyAIModel* tinyaiLoadModelSnapshot(const char *path);
+
+/**
+ * Copy a snapshot into a named shared memory segment
+ * 
+ * For hosts where worker processes cannot share a snapshot file, for
+ * example when it lives on a network filesystem. Workers then load it with
+ * tinyaiLoadSharedModelSnapshot and all map the one segment read-only. A
+ * segment already published under the name is replaced; workers that have it
+ * mapped keep using the old one until they destroy their models. POSIX only
+ * (shm_open); on Windows, share the snapshot file itself.
+ * 
+ * @param path Snapshot file path
+ * @param name Segment name, starting with '/' (e.g. "/tinyai-model")
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiPublishModelSnapshot(const char *path, const char *name);
+
+/**
+ * Remove a snapshot segment published by tinyaiPublishModelSnapshot
+ * 
+ * Workers that have it mapped keep using it; its memory is freed once the
+ * last of them destroys its model.
+ * 
+ * @param name Segment name
+ * @return 0 on success, non-zero if there is no such segment
+ */
+int tinyaiUnpublishModelSnapshot(const char *name);
+
+/**
+ * Load a model from a snapshot published in a shared memory segment
+ * 
+ * Behaves as tinyaiLoadModelSnapshot on the segment's contents.
+ * 
+ * @param name Segment name given to tinyaiPublishModelSnapshot
+ * @return Prepared model, or NULL if there is no such segment or it is corrupt
+ */
+TinyAIModel* tinyaiLoadSharedModelSnapshot(const char *name);
+
+/**
+ * Compile a model into an execution plan
+ *
+ * Resolves the kernel and activation of every layer and lays out the
+ * activation buffers once, so forward passes just walk the plan.
+ * tinyaiLoadModel prepares the model; models built layer by layer are
+ * prepared on their first forward pass, and again after their layers or
+ * attention weights change.
+ *
+ * @param model Model to prepare
+ * @return 0 on success, -1 if a layer cannot run in this model type
+ */
+int tinyaiPrepareModel(TinyAIModel *model);
+
+/**
+ * Get the weight format a layer runs on in the model's execution plan
+ *
+ * Preparing a model measures the sparsity of each dense and output layer,
+ * counting weights within half a quantization step of zero as pruned. A layer
+ * at least "model.sparse_min_sparsity" sparse (0.5 by default, 0.3 under the
+ * energy execution profile) is converted to 4-bit CSR or BSR when that is
+ * estimated to be faster than its packed 4-bit weights; with
+ * "model.sparse_benchmark" set, the candidates are timed on this
+ * host instead and the fastest one kept. Setting "model.sparse_kernels" to
+ * false keeps every layer dense. The sparse copies belong to the plan; the
+ * layer's own weights are left untouched.
+ *
+ * @param model Model to query (prepared first if needed)
+ * @param layerIndex Layer index
+ * @return TINYAI_WEIGHT_FORMAT_*, or -1 on error
+ */
+int tinyaiGetLayerWeightFormat(TinyAIModel *model, uint32_t layerIndex);
+
+/**
+ * Get the threads a layer runs on in the model's execution plan
+ *
+ * Layers run on the kernel thread pool unless autotuning found them faster
+ * on the calling thread alone. With "model.autotune_passes" set to K,
+ * preparing a model starts autotuning its dense and output layers: during
+ * the next K forward passes each layer also runs every alternative it has,
+ * its packed weights and the sparse formats of a layer sparse enough for
+ * them, each on the thread pool and serially when there is a pool, and adds
+ * up their times over the same rows. After the K-th pass every layer keeps
+ * its fastest candidate and drops the others. Snapshots record the result.
+ *
+ * @param model Model to query (prepared first if needed)
+ * @param layerIndex Layer index
+ * @return TINYAI_LAYER_THREADS_*, or -1 on error
+ */
+int tinyaiGetLayerThreads(TinyAIModel *model, uint32_t layerIndex);
+
+/**
+ * Check whether a model is still autotuning its layers
+ *
+ * @param model Model to query
+ * @return Forward passes left before the layers are locked in (0 when done or off)
+ */
+uint32_t tinyaiGetAutotunePassesLeft(const TinyAIModel *model);
+
 /**
  * Perform a single forward pass through the model
  * 
+ * Stateless: recurrent layers start from a zero hidden state and consume
+ * every input token. Fails before the next layer once the cancellation
+ * token installed on the calling thread (see cancel.h) fires.
+ * 
  * @param model Model to use
  * @param input Input token IDs
  * @param inputLength Number of input tokens
@@ -158,9 +489,380 @@ TinyAIModel* tinyaiLoadModel(const char *modelPath, const char *weightsPath,
 int tinyaiModelForward(TinyAIModel *model, const int *input, 
                      int inputLength, float *output);
 
+/**
+ * Get the size of a model's text embeddings
+ *
+ * @param model Model to query
+ * @return Input size of the final layer, or 0 on error
+ */
+uint32_t tinyaiGetModelEmbeddingSize(const TinyAIModel *model);
+
+/**
+ * Embed a batch of texts
+ *
+ * Texts are tokenized in parallel, then each runs through every layer but
+ * the final one in a single pass over all its positions; the hidden states
+ * entering the final layer are pooled into the text's embedding. Texts
+ * longer than the context keep their first model->contextSize tokens.
+ * Stateless, like tinyaiModelForward.
+ *
+ * @param model Model to use
+ * @param texts Texts to embed
+ * @param count Number of texts
+ * @param pooling TINYAI_POOLING_*
+ * @param normalize Scale each embedding to unit length (for cosine search)
+ * @param embeddings Output [count x tinyaiGetModelEmbeddingSize(model)]
+ * @return 0 on success, non-zero on error (including a text with no tokens)
+ */
+int tinyaiEmbedTextBatch(TinyAIModel *model, const char *const *texts, uint32_t count,
+                         int pooling, bool normalize, float *embeddings);
+
+/**
+ * Attach self-attention weights to an attention layer
+ *
+ * Attention layers without attached weights pass their input through.
+ *
+ * @param model Model to modify
+ * @param layerIndex Index of a TINYAI_LAYER_ATTENTION layer
+ * @param attention Initialized attention structure (ownership transferred)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSetLayerAttention(TinyAIModel *model, uint32_t layerIndex,
+                          TinyAISelfAttention *attention);
+
+/**
+ * Create a low-rank adapter for a model
+ *
+ * An adapter holds a rank-r update W + (alpha / r) * B * A of the weights of
+ * any of the model's dense, output and attention projections (LoRA), where A
+ * is [r x input size] and B is [r x output size] in 32-bit floats. Updates
+ * run as two thin products next to the 4-bit kernel of the projection, so
+ * the quantized base weights stay shared by every adapter of the model and
+ * each adapter costs only r * (input + output) floats per projection. The
+ * adapter starts with no updates.
+ *
+ * @param model Model whose layer sizes the adapter follows
+ * @param rank Rank r of the updates
+ * @param alpha Scale numerator; updates are scaled by alpha / rank
+ * @return New adapter or NULL on error
+ */
+TinyAIAdapter* tinyaiCreateAdapter(const TinyAIModel *model, uint32_t rank, float alpha);
+
+/**
+ * Set the update of one projection of an adapter
+ *
+ * @param adapter Adapter to modify
+ * @param layerIndex Index of a dense, output or attention layer
+ * @param projection TINYAI_ADAPTER_WEIGHTS for dense and output layers,
+ *                   TINYAI_ADAPTER_QUERY/KEY/VALUE/OUTPUT for attention layers
+ * @param down A, [rank x input size] (copied)
+ * @param up B, [rank x output size] (copied)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSetAdapterWeights(TinyAIAdapter *adapter, uint32_t layerIndex, uint32_t projection,
+                            const float *down, const float *up);
+
+/**
+ * Destroy an adapter
+ *
+ * The adapter must not be active on any model.
+ *
+ * @param adapter Adapter to destroy
+ */
+void tinyaiDestroyAdapter(TinyAIAdapter *adapter);
+
+/**
+ * Make an adapter the active one of a model
+ *
+ * Switching only repoints the model's layers at the adapter's updates, so a
+ * server can select a different fine-tune for each request on one copy of
+ * the base weights. Cached prompt prefixes are dropped, as they were
+ * computed with the previous weights; key/value caches of sequences started
+ * under another adapter should not be continued. The adapter is not owned
+ * by the model and must outlive its use.
+ *
+ * @param model Model to modify
+ * @param adapter Adapter created for the model, or NULL for the base weights
+ * @return 0 on success, non-zero on error (the active adapter is unchanged)
+ */
+int tinyaiSetModelAdapter(TinyAIModel *model, const TinyAIAdapter *adapter);
+
+/**
+ * Create a key/value cache sized for a model
+ *
+ * The cache holds one sequence of up to model->contextSize positions,
+ * including the hidden state of the recurrent layers of RNN models. Save
+ * it with tinyaiSaveKVCache to suspend the sequence.
+ *
+ * @param model Model the cache will be used with
+ * @return New cache or NULL on error
+ */
+TinyAIKVCache* tinyaiCreateModelKVCache(const TinyAIModel *model);
+
+/**
+ * Create a pool of key/value cache blocks for a model
+ *
+ * Paged caches created from the pool with tinyaiCreateModelPagedKVCache
+ * only hold blocks for the positions they use, so many short sequences
+ * can share the memory of a few long ones.
+ *
+ * @param model Model the caches will be used with
+ * @param maxBlocks Blocks of TINYAI_KV_BLOCK_SIZE positions over all caches
+ * @param memory Memory pool for block storage (NULL = heap)
+ * @return New block pool or NULL on error
+ */
+TinyAIKVBlockPool* tinyaiCreateModelKVBlockPool(const TinyAIModel *model, uint32_t maxBlocks,
+                                                TinyAIAdvancedMemoryPool *memory);
+
+/**
+ * Create a paged key/value cache for a model
+ *
+ * @param model Model the cache will be used with
+ * @param pool Block pool created for the same model
+ * @return New cache or NULL on error
+ */
+TinyAIKVCache* tinyaiCreateModelPagedKVCache(const TinyAIModel *model, TinyAIKVBlockPool *pool);
+
+/**
+ * Perform an incremental forward pass using a key/value cache
+ *
+ * Processes only the new tokens, which are appended after the
+ * cache->length positions already cached, and advances the cache.
+ * Recurrent layers continue from the hidden state in the cache, so each
+ * decode step costs the same however long the sequence is.
+ *
+ * @param model Model to use
+ * @param cache Key/value cache for this sequence
+ * @param input New token IDs
+ * @param inputLength Number of new tokens
+ * @param output Output logits for the last new token (at least vocab size)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiModelForwardCached(TinyAIModel *model, TinyAIKVCache *cache,
+                           const int *input, int inputLength, float *output);
+
+/**
+ * Perform an incremental forward pass over embedding rows using a key/value cache
+ *
+ * Like tinyaiModelForwardCached, but the rows enter the model after its
+ * embedding layer, so features from another encoder (an image, audio) can
+ * condition the tokens that follow them in the cache.
+ *
+ * @param model Model to use (its first layer must be an embedding layer)
+ * @param cache Key/value cache for this sequence
+ * @param embeddings Input rows [count x embedding layer output size]
+ * @param count Number of rows
+ * @param output Output logits for the last row (at least vocab size)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiModelForwardCachedEmbeddings(TinyAIModel *model, TinyAIKVCache *cache,
+                                       const float *embeddings, int count, float *output);
+
+/**
+ * Restrict the logits a model computes to a set of candidate tokens
+ *
+ * The final output layer then computes only the shortlisted columns of its
+ * weights and sets every other logit to -INFINITY, so sampling never picks
+ * them. This cuts the output projection, usually the largest matrix of a
+ * model with a big vocabulary, to the size of the shortlist. EOS is always
+ * kept so generation can end.
+ *
+ * @param model Model to configure
+ * @param tokens Candidate token IDs, duplicates allowed (NULL with count 0)
+ * @param count Number of candidates (0 computes the full vocabulary again)
+ * @return 0 on success, non-zero on error (including an out-of-range token)
+ */
+int tinyaiSetOutputShortlist(TinyAIModel *model, const int *tokens, uint32_t count);
+
+/**
+ * Restrict a model's logits to its most frequent tokens plus extra candidates
+ *
+ * Ranks tokens by the tokenizer's frequencies; extraTokens typically holds
+ * the prompt, whose tokens are likely to be repeated.
+ *
+ * @param model Model to configure
+ * @param count Number of most frequent tokens to keep
+ * @param extraTokens Additional candidates (can be NULL)
+ * @param numExtra Number of additional candidates
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSetFrequencyShortlist(TinyAIModel *model, uint32_t count, const int *extraTokens,
+                                uint32_t numExtra);
+
+/**
+ * Let single-token forward passes stop early after a layer
+ *
+ * After the layer, the model's trailing layer norms and output layer run on
+ * its hidden state as an exit head. When the head's most likely token has
+ * a softmax probability of at least the threshold, its logits are the
+ * pass's result and the remaining layers are skipped. Skipped attention
+ * layers still project the exit hidden state to the position's keys and
+ * values, so later tokens find every layer of the KV cache filled.
+ *
+ * Only decoding steps exit: cached passes over one token of one sequence.
+ * Prompts, batched steps, streamed weights and autotuning passes run every
+ * layer. Exits need the model to end in an output layer, no recurrent layer
+ * between the exit and the head, and the layer's output the width of the
+ * head's input. Adding a layer clears every exit.
+ *
+ * @param model Model to configure
+ * @param layerIndex Layer after which a pass may stop
+ * @param threshold Confidence needed to stop (above 1 never stops; negative removes the exit)
+ * @return 0 on success, non-zero if the model cannot exit after the layer
+ */
+int tinyaiSetModelEarlyExit(TinyAIModel *model, uint32_t layerIndex, float threshold);
+
+/**
+ * Calibrate the thresholds of a model's early exits on representative text
+ *
+ * Decodes the tokens one at a time through every layer, recording at each
+ * exit the head's confidence and whether its most likely token matches the
+ * full model's. Each exit then gets the lowest threshold at which the
+ * tokens it would have stopped on agree at least the given fraction of the
+ * time, or a threshold above 1 if none does. The KV cache restarts when the
+ * tokens outgrow the context.
+ *
+ * @param model Model with early exits set
+ * @param tokens Representative token sequence
+ * @param count Number of tokens
+ * @param agreement Fraction of exited tokens that must match the full model (0 to 1)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiCalibrateModelEarlyExit(TinyAIModel *model, const int *tokens, int count,
+                                  float agreement);
+
+/**
+ * Enable or disable per-layer profiling of a model's forward passes
+ *
+ * While enabled, every forward pass adds each layer's wall time, FLOPs,
+ * bytes of weights read and allocations to the model's profile, and passes
+ * that stop at an early exit count at their exit layer. Disabled profiling
+ * costs one branch per layer. Enabling again clears the profile.
+ *
+ * @param model Model to configure
+ * @param enable Whether to profile
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiEnableModelProfiling(TinyAIModel *model, bool enable);
+
+/**
+ * Get the per-layer profile of a model
+ *
+ * @param model Model with profiling enabled
+ * @param layerCount Receives the number of entries (can be NULL)
+ * @return One entry per layer, or NULL when profiling is off
+ */
+const TinyAILayerProfile* tinyaiGetModelProfile(const TinyAIModel *model, uint32_t *layerCount);
+
+/**
+ * Clear the per-layer profile of a model
+ *
+ * @param model Model with profiling enabled
+ */
+void tinyaiResetModelProfile(TinyAIModel *model);
+
+/**
+ * Record a model's profile as the current metrics of a performance analysis
+ *
+ * execution_time is the mean wall time of a forward pass and memory_usage
+ * the mean bytes of weights read per pass.
+ *
+ * @param model Model with profiling enabled
+ * @param analysis Performance analysis to update
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiExportModelProfile(const TinyAIModel *model, TinyAIPerformanceAnalysis *analysis);
+
+/**
+ * Write a per-layer table of a model's profile
+ *
+ * @param model Model with profiling enabled
+ * @param file Output stream
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiWriteModelProfile(const TinyAIModel *model, FILE *file);
+
+/**
+ * Stream a model's layer weights through a progressive loader
+ *
+ * Layer i of the loader holds the packed 4-bit data of model layer i, in
+ * the layout of the model's matrix. Each step of a forward pass requests its
+ * layer before running and releases it afterwards, so only the loader's
+ * memory budget of layer data stays resident. The data layers already hold
+ * is freed, and tinyaiLoadModelWeights then skips it; shapes, scales, biases
+ * and attention weights stay in memory, and sparse weight formats are not
+ * used. The loader must outlive the model, and serve one pass at a time.
+ *
+ * @param model Model to configure
+ * @param loader Loader with a layer of matching size for every model layer
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSetModelProgressiveLoader(TinyAIModel *model, TinyAIProgressiveLoader *loader);
+
+/**
+ * Store the activations passed between a model's layers in half precision
+ *
+ * FP16 and BF16 halve the activation buffers and the traffic between
+ * layers. Each layer widens its input rows into floats a few rows at a
+ * time, computes and accumulates in floats as before, and rounds its output
+ * rows back to 16 bits, so only those buffers and the rounding between
+ * layers change. BF16 keeps the float range; FP16 keeps three more mantissa
+ * bits but overflows past 65504. The key/value caches keep their own
+ * precision (see TinyAIAttentionParams.kvCachePrecision).
+ *
+ * @param model Model to configure
+ * @param precision TINYAI_ACTIVATIONS_* storage
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSetModelActivationPrecision(TinyAIModel *model, uint32_t precision);
+
+/**
+ * Enable or disable the shared prompt-prefix cache of a model
+ *
+ * With the cache enabled, generation from a workspace skips the prefill of
+ * the longest prompt prefix already seen and stores each new prompt's
+ * prefill state. The cache is cleared whenever the model's weights change.
+ *
+ * @param model Model to configure
+ * @param memoryLimit Maximum bytes of cached state (0 disables the cache)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiEnablePrefixCache(TinyAIModel *model, size_t memoryLimit);
+
+/**
+ * Let a memory governor shed a model's caches under pressure
+ *
+ * Registers the model's prefix cache (halved under moderate pressure,
+ * emptied above), its tokenizer's word cache (halved under high pressure,
+ * dropped under critical) and the idle blocks of a key/value block pool.
+ * Call tinyaiMemoryGovernorRemove with the model and the pool before
+ * destroying either. Poll the governor only between generation calls.
+ *
+ * @param governor Governor to register with
+ * @param model Model whose caches may be shed
+ * @param kvPool Block pool of the model's paged caches (NULL if none)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiGovernModel(TinyAIMemoryGovernor *governor, TinyAIModel *model,
+                      TinyAIKVBlockPool *kvPool);
+
+/**
+ * Get the memory of a model by subsystem
+ *
+ * Caches and workspaces the caller created are not part of the model;
+ * measure them with tinyaiKVCacheMemoryUsage and tinyaiKVBlockPoolMemoryUsage.
+ *
+ * @param model Model to measure
+ * @param usage Receives the memory usage
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiGetModelMemoryUsage(const TinyAIModel *model, TinyAIModelMemoryUsage *usage);
+
 /**
  * Sample the next token from output probabilities
  * 
+ * Penalty processors treat params->promptTokens as the sequence so far.
+ * 
  * @param output Output logits from model
  * @param vocabSize Vocabulary size
  * @param params Generation parameters
@@ -169,9 +871,27 @@ int tinyaiModelForward(TinyAIModel *model, const int *input,
 int tinyaiSampleToken(const float *output, int vocabSize, 
                     const TinyAIGenerationParams *params);
 
+/**
+ * Sample the next token allowed by the parameters' grammar in a state
+ *
+ * Logits of tokens the grammar does not allow are excluded before
+ * sampling. tinyaiSampleToken samples from the grammar's start state.
+ *
+ * @param output Output logits from model
+ * @param vocabSize Vocabulary size
+ * @param params Generation parameters (grammar may be NULL)
+ * @param grammarState Current grammar state (ignored without a grammar)
+ * @return Sampled token ID (TINYAI_TOKEN_EOS if the grammar allows no token)
+ */
+int tinyaiSampleTokenConstrained(const float *output, int vocabSize,
+                                 const TinyAIGenerationParams *params, uint32_t grammarState);
+
 /**
  * Generate text from a model
  * 
+ * Once params->cancel fires, the forward pass in flight stops before its
+ * next layer and the tokens generated so far are returned.
+ * 
  * @param model Model to use
  * @param params Generation parameters
  * @param outputTokens Output token buffer (must be allocated)
@@ -181,6 +901,250 @@ int tinyaiSampleToken(const float *output, int vocabSize,
 int tinyaiGenerateText(TinyAIModel *model, const TinyAIGenerationParams *params,
                      int *outputTokens, int maxOutputTokens);
 
+/**
+ * Generate text from a model, streaming each token to a callback
+ * 
+ * Behaves like tinyaiGenerateText, but reports every generated token (not
+ * the prompt) with its decoded piece as soon as it is sampled, so the first
+ * token arrives after the prefill instead of after the whole sequence.
+ * 
+ * @param model Model to use
+ * @param params Generation parameters
+ * @param callback Token callback; returning false stops generation
+ * @param userData User data passed to the callback
+ * @return Number of tokens in the sequence, prompt included
+ */
+int tinyaiGenerateTextWithCallback(TinyAIModel *model, const TinyAIGenerationParams *params,
+                                 TinyAITokenCallback callback, void *userData);
+
+/**
+ * Create a generation workspace sized for a model
+ * 
+ * @param model Model the workspace will be used with
+ * @return New workspace or NULL on error
+ */
+TinyAIGenerationWorkspace* tinyaiCreateGenerationWorkspace(const TinyAIModel *model);
+
+/**
+ * Destroy a generation workspace
+ * 
+ * @param workspace Workspace to destroy
+ */
+void tinyaiDestroyGenerationWorkspace(TinyAIGenerationWorkspace *workspace);
+
+/**
+ * Generate text from a model using a preallocated workspace
+ * 
+ * Same as tinyaiGenerateText, but all per-step buffers come from the
+ * workspace, which can be reused across calls.
+ * 
+ * @param model Model to use
+ * @param params Generation parameters
+ * @param workspace Workspace created for this model
+ * @param outputTokens Output token buffer (must be allocated)
+ * @param maxOutputTokens Maximum output tokens
+ * @return Number of tokens generated
+ */
+int tinyaiGenerateTextWithWorkspace(TinyAIModel *model, const TinyAIGenerationParams *params,
+                                  TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                                  int maxOutputTokens);
+
+/**
+ * Generate text using a preallocated workspace, streaming each token to a callback
+ * 
+ * Same as tinyaiGenerateTextWithWorkspace, calling the callback as in
+ * tinyaiGenerateTextWithCallback. Between tokens the model holds no state
+ * outside the workspace, so a callback may let other threads run the model
+ * (each with its own workspace) before it returns.
+ * 
+ * @param model Model to use
+ * @param params Generation parameters
+ * @param workspace Workspace created for this model
+ * @param outputTokens Output token buffer (must be allocated)
+ * @param maxOutputTokens Maximum output tokens
+ * @param callback Callback for each generated token (NULL for none); return false to stop
+ * @param userData User data passed to the callback
+ * @return Number of tokens in the sequence, prompt included
+ */
+int tinyaiGenerateTextWithWorkspaceCallback(TinyAIModel                  *model,
+                                            const TinyAIGenerationParams *params,
+                                            TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                                            int maxOutputTokens, TinyAITokenCallback callback,
+                                            void *userData);
+
+/**
+ * Continue a sequence held in a workspace's key/value cache
+ *
+ * The prompt tokens are appended after the positions already in
+ * workspace->cache rather than prefilled from scratch, so a conversation
+ * only pays for what each turn adds. Unlike the other entry points,
+ * params->maxTokens counts generated tokens only and the output holds only
+ * them. On return the cache holds the prompt and every returned token,
+ * ready for the next call; a sampled EOS is not fed. Keeping the sequence
+ * within the cache is up to the caller (see tinyaiKVCacheDiscard):
+ * generation stops early when the next token would not fit. A grammar
+ * applies to each call's tokens alone, from its start state, and penalties
+ * see the new prompt tokens and the tokens generated since.
+ *
+ * @param model Model to use
+ * @param params Generation parameters (promptTokens holds the new tokens, at least one)
+ * @param workspace Workspace created for this model, its cache holding the sequence so far
+ * @param outputTokens Output buffer for the generated tokens
+ * @param maxOutputTokens Size of the output buffer
+ * @param callback Callback streaming each generated token (NULL for none)
+ * @param userData User data passed to the callback
+ * @return Number of tokens generated, or -1 if the new tokens could not be processed
+ *         (including once params->cancel fires)
+ */
+int tinyaiGenerateTextContinue(TinyAIModel *model, const TinyAIGenerationParams *params,
+                               TinyAIGenerationWorkspace *workspace, int *outputTokens,
+                               int maxOutputTokens, TinyAITokenCallback callback,
+                               void *userData);
+
+/**
+ * Generate text for several independent sequences at once
+ * 
+ * Every decode step advances all unfinished sequences together in one
+ * batched forward pass, so each layer's weights are read once per step for
+ * the whole batch. Sequence b uses params[b] (prompt, sampling method, seed
+ * and maxTokens) and stops on its own; its tokens match what
+ * tinyaiGenerateText produces with the same parameters.
+ * 
+ * @param model Model to use
+ * @param params Generation parameters, one per sequence
+ * @param batchSize Number of sequences
+ * @param outputTokens Output token buffers, one per sequence (must be allocated)
+ * @param maxOutputTokens Capacity of each output buffer
+ * @param tokenCounts Output token count of each sequence (prompt included)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiGenerateTextBatch(TinyAIModel *model, const TinyAIGenerationParams *params,
+                          int batchSize, int **outputTokens, int maxOutputTokens,
+                          int *tokenCounts);
+
+/**
+ * Create a continuous batch of generated sequences
+ * 
+ * Unlike tinyaiGenerateTextBatch, sequences join and leave between steps:
+ * each tinyaiGenerationBatchStep advances every running sequence by one
+ * token, decoding them in one batched forward pass, so a server can admit
+ * new requests as soon as a slot frees up. Prompts are prefilled in chunks
+ * of at most prefillChunk tokens per step, so a long prompt does not stall
+ * the sequences already decoding. Prompts resume from the model's prefix
+ * cache, when enabled, as in tinyaiGenerateText. With a block pool,
+ * sequence caches are paged and only hold the positions they use.
+ * 
+ * @param model Model to use
+ * @param maxSequences Largest number of sequences running at once
+ * @param prefillChunk Prompt tokens a sequence prefills per step (0 for no limit)
+ * @param pool Block pool created for the model (NULL for contiguous caches)
+ * @return New batch or NULL on error
+ */
+TinyAIGenerationBatch* tinyaiCreateGenerationBatch(TinyAIModel *model, int maxSequences,
+                                                   int prefillChunk, TinyAIKVBlockPool *pool);
+
+/**
+ * Destroy a generation batch, dropping any sequences still running
+ * 
+ * @param batch Batch to destroy
+ */
+void tinyaiDestroyGenerationBatch(TinyAIGenerationBatch *batch);
+
+/**
+ * Add a sequence to a generation batch
+ * 
+ * The sequence starts at the next step. Its tokens match what
+ * tinyaiGenerateTextWithCallback produces with the same parameters as long
+ * as the sequence fits its cache. Each sampled token is passed to the
+ * callback; a false return ends the sequence after that token. Once
+ * params->cancel fires the sequence ends at the next step, its own prefill
+ * stopping within one layer.
+ * 
+ * @param batch Batch to add to
+ * @param params Generation parameters (the prompt is copied)
+ * @param callback Callback for each generated token (NULL for none)
+ * @param userData User data passed to the callback
+ * @return Slot of the sequence, or -1 if the batch is full or on error
+ */
+int tinyaiGenerationBatchAdd(TinyAIGenerationBatch *batch, const TinyAIGenerationParams *params,
+                             TinyAITokenCallback callback, void *userData);
+
+/**
+ * Remove a sequence from a generation batch, freeing its slot
+ * 
+ * @param batch Batch holding the sequence
+ * @param slot Slot returned by tinyaiGenerationBatchAdd
+ */
+void tinyaiGenerationBatchRemove(TinyAIGenerationBatch *batch, int slot);
+
+/**
+ * Advance every running sequence of a generation batch by one token
+ * 
+ * Sequences still prefilling feed their next prompt chunk instead.
+ * Sequences that reach EOS, their token limit or a false callback return
+ * finish, and their slots are free for the next tinyaiGenerationBatchAdd.
+ * 
+ * @param batch Batch to advance
+ * @return Number of sequences still running, or -1 on error
+ */
+int tinyaiGenerationBatchStep(TinyAIGenerationBatch *batch);
+
+/**
+ * Check whether a slot of a generation batch holds a running sequence
+ * 
+ * @param batch Batch to check
+ * @param slot Slot returned by tinyaiGenerationBatchAdd
+ * @param tokenCount Set to the tokens in the sequence so far, prompt included (may be NULL)
+ * @return true if the sequence has not finished
+ */
+bool tinyaiGenerationBatchRunning(const TinyAIGenerationBatch *batch, int slot, int *tokenCount);
+
+/**
+ * Generate text with beam search
+ *
+ * Keeps the beamWidth most probable hypotheses and advances all of them in
+ * one batched forward pass per step. The prefix embeddings and the prompt
+ * are cached once in a paged key/value cache that every beam forks from;
+ * forks share blocks until they write to them, so beams only store the
+ * tokens they add. Hypotheses end at EOS; the one with the best
+ * length-normalized log probability is returned. Sampling settings in
+ * params are ignored, and generation stops when the context is full. A
+ * width of 1 produces the same tokens as greedy tinyaiGenerateText within
+ * the context.
+ *
+ * @param model Model to use
+ * @param params Generation parameters (prompt and maxTokens)
+ * @param beam Beam search parameters (NULL = greedy without a prefix)
+ * @param outputTokens Output token buffer (must be allocated)
+ * @param maxOutputTokens Maximum output tokens
+ * @return Number of tokens in the output (prompt included), 0 on error
+ */
+int tinyaiGenerateTextBeam(TinyAIModel *model, const TinyAIGenerationParams *params,
+                         const TinyAIBeamSearchParams *beam, int *outputTokens,
+                         int maxOutputTokens);
+
+/**
+ * Generate text using speculative decoding with a draft model
+ *
+ * The draft model proposes up to draftLength tokens, which the target model
+ * verifies in a single batched forward pass. Drafts are accepted or
+ * resampled so the output follows the target model's sampling distribution;
+ * with greedy sampling it matches tinyaiGenerateText on the target model.
+ * Falls back to tinyaiGenerateText when no usable draft model is given or
+ * the parameters carry a grammar or logit processors.
+ *
+ * @param model Target model
+ * @param draftModel Draft model sharing the target's vocabulary
+ * @param draftLength Maximum tokens drafted per verification step
+ * @param params Generation parameters
+ * @param outputTokens Output token buffer (must be allocated)
+ * @param maxOutputTokens Maximum output tokens
+ * @return Number of tokens generated
+ */
+int tinyaiGenerateTextSpeculative(TinyAIModel *model, TinyAIModel *draftModel, int draftLength,
+                                const TinyAIGenerationParams *params, int *outputTokens,
+                                int maxOutputTokens);
+
 /**
  * Convert a model to 4-bit quantization
  * 
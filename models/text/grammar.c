@@ -0,0 +1,1693 @@
+/**
+ * @file grammar.c
+ * @brief Grammar-constrained decoding
+ *
+ * Patterns are parsed into a syntax tree, built into a Thompson NFA and
+ * determinized by subset construction over byte classes (bytes that no part
+ * of the pattern tells apart share one column of the transition table).
+ * States that cannot reach a match are cut, so every allowed token keeps
+ * the text completable. Token masks come from a depth-first walk, from each
+ * state, of a trie of the vocabulary's decoded pieces: shared prefixes are
+ * walked once and a branch stops as soon as the automaton rejects it.
+ */
+
+#include "grammar.h"
+#include "../../core/memory.h"
+#include "../../utils/simd_ops.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Most NFA states a pattern may build */
+#define MAX_NFA_STATES (1u << 20)
+
+/* Deepest nesting of pattern groups */
+#define MAX_GROUP_DEPTH 1024
+
+/* Deepest nesting of schema objects read */
+#define MAX_SCHEMA_DEPTH 32
+
+/* Pieces of the patterns JSON schemas compile to */
+#define JSON_WS " ?"
+#define JSON_CHAR "([^\"\\\\\\x00-\\x1f]|\\\\[\"\\\\/bfnrt]|\\\\u[0-9a-fA-F]{4})"
+#define JSON_STRING "\"" JSON_CHAR "*\""
+#define JSON_INTEGER "-?(0|[1-9][0-9]*)"
+#define JSON_NUMBER JSON_INTEGER "(\\.[0-9]+)?([eE][+-]?[0-9]+)?"
+#define JSON_SCALAR JSON_STRING "|" JSON_NUMBER "|true|false|null"
+
+/* ----------------- Pattern Parsing ----------------- */
+
+/**
+ * Set of bytes, one bit each
+ */
+typedef struct {
+    uint32_t bits[8];
+} ByteSet;
+
+/**
+ * Node types of a pattern's syntax tree
+ */
+typedef enum { REGEX_EMPTY, REGEX_SET, REGEX_CONCAT, REGEX_ALT, REGEX_REPEAT } RegexType;
+
+/**
+ * Syntax tree node
+ */
+typedef struct {
+    RegexType type;
+    int32_t   left;  /* Operand; first operand of a concatenation or alternation */
+    int32_t   right; /* Second operand of a concatenation or alternation */
+    int32_t   min;   /* Fewest repetitions */
+    int32_t   max;   /* Most repetitions (-1 = unbounded) */
+    uint32_t  set;   /* Byte set of a set node */
+} RegexNode;
+
+/**
+ * Recursive-descent pattern parser
+ */
+typedef struct {
+    const char *p;            /* Next pattern character */
+    RegexNode  *nodes;        /* Syntax tree nodes */
+    uint32_t    nodeCount;    /* Nodes in use */
+    uint32_t    nodeCapacity; /* Nodes allocated */
+    ByteSet    *sets;         /* Byte sets of the set nodes */
+    uint32_t    setCount;     /* Sets in use */
+    uint32_t    setCapacity;  /* Sets allocated */
+    int         depth;        /* Open groups */
+    bool        failed;       /* Syntax error or allocation failure */
+} RegexParser;
+
+static inline void setAdd(ByteSet *set, unsigned char byte)
+{
+    set->bits[byte >> 5] |= 1u << (byte & 31);
+}
+
+static inline bool setHas(const ByteSet *set, unsigned char byte)
+{
+    return (set->bits[byte >> 5] >> (byte & 31)) & 1u;
+}
+
+static void setAddRange(ByteSet *set, unsigned char first, unsigned char last)
+{
+    for (unsigned int b = first; b <= last; b++) {
+        setAdd(set, (unsigned char)b);
+    }
+}
+
+/**
+ * Make room for count + 1 elements of an array
+ */
+static bool reserveArray(void **array, uint32_t *capacity, uint32_t count, size_t elementSize)
+{
+    if (count < *capacity) {
+        return true;
+    }
+    uint32_t newCapacity = *capacity ? *capacity * 2 : 64;
+    void    *grown       = TINYAI_REALLOC(*array, (size_t)newCapacity * elementSize);
+    if (!grown) {
+        return false;
+    }
+    *array    = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+static int32_t addNode(RegexParser *parser, RegexType type, int32_t left, int32_t right)
+{
+    if (parser->failed || !reserveArray((void **)&parser->nodes, &parser->nodeCapacity,
+                                        parser->nodeCount, sizeof(RegexNode))) {
+        parser->failed = true;
+        return -1;
+    }
+    RegexNode *node = &parser->nodes[parser->nodeCount];
+    node->type      = type;
+    node->left      = left;
+    node->right     = right;
+    node->min       = 0;
+    node->max       = 0;
+    node->set       = 0;
+    return (int32_t)parser->nodeCount++;
+}
+
+static int32_t addSetNode(RegexParser *parser, const ByteSet *set)
+{
+    if (parser->failed || !reserveArray((void **)&parser->sets, &parser->setCapacity,
+                                        parser->setCount, sizeof(ByteSet))) {
+        parser->failed = true;
+        return -1;
+    }
+    int32_t node = addNode(parser, REGEX_SET, -1, -1);
+    if (node < 0) {
+        return -1;
+    }
+    parser->sets[parser->setCount] = *set;
+    parser->nodes[node].set        = parser->setCount++;
+    return node;
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Parse the escape after a backslash into a byte set
+ *
+ * @return The escaped byte, -2 for a class such as \d, or -1 on error
+ */
+static int parseEscape(RegexParser *parser, ByteSet *set)
+{
+    char c = *parser->p++;
+    switch (c) {
+    case '\0':
+        parser->p--;
+        return -1;
+    case 'd':
+    case 'D':
+    case 'w':
+    case 'W':
+    case 's':
+    case 'S': {
+        ByteSet class;
+        memset(&class, 0, sizeof(class));
+        if (c == 'd' || c == 'D') {
+            setAddRange(&class, '0', '9');
+        }
+        else if (c == 'w' || c == 'W') {
+            setAddRange(&class, '0', '9');
+            setAddRange(&class, 'a', 'z');
+            setAddRange(&class, 'A', 'Z');
+            setAdd(&class, '_');
+        }
+        else {
+            setAddRange(&class, '\t', '\r');
+            setAdd(&class, ' ');
+        }
+        bool negate = c == 'D' || c == 'W' || c == 'S';
+        for (int i = 0; i < 8; i++) {
+            set->bits[i] |= negate ? ~class.bits[i] : class.bits[i];
+        }
+        return -2;
+    }
+    case 'n':
+        setAdd(set, '\n');
+        return '\n';
+    case 't':
+        setAdd(set, '\t');
+        return '\t';
+    case 'r':
+        setAdd(set, '\r');
+        return '\r';
+    case 'f':
+        setAdd(set, '\f');
+        return '\f';
+    case 'v':
+        setAdd(set, '\v');
+        return '\v';
+    case 'x': {
+        int high = hexValue(parser->p[0]);
+        int low  = high >= 0 ? hexValue(parser->p[1]) : -1;
+        if (low < 0) {
+            return -1;
+        }
+        parser->p += 2;
+        setAdd(set, (unsigned char)(high * 16 + low));
+        return high * 16 + low;
+    }
+    default:
+        setAdd(set, (unsigned char)c);
+        return (unsigned char)c;
+    }
+}
+
+/**
+ * Parse a bracketed class after its '['
+ */
+static int32_t parseClass(RegexParser *parser)
+{
+    ByteSet set;
+    memset(&set, 0, sizeof(set));
+
+    bool negate = *parser->p == '^';
+    if (negate) {
+        parser->p++;
+    }
+
+    bool first = true;
+    while (*parser->p && (*parser->p != ']' || first)) {
+        first = false;
+
+        /* One byte or class; a byte may start a range */
+        int low;
+        if (*parser->p == '\\') {
+            parser->p++;
+            low = parseEscape(parser, &set);
+            if (low == -1) {
+                parser->failed = true;
+                return -1;
+            }
+        }
+        else {
+            low = (unsigned char)*parser->p++;
+            setAdd(&set, (unsigned char)low);
+        }
+
+        if (low < 0 || parser->p[0] != '-' || parser->p[1] == ']' || parser->p[1] == '\0') {
+            continue;
+        }
+        parser->p++;
+
+        ByteSet ignored;
+        memset(&ignored, 0, sizeof(ignored));
+        int high;
+        if (*parser->p == '\\') {
+            parser->p++;
+            high = parseEscape(parser, &ignored);
+        }
+        else {
+            high = (unsigned char)*parser->p++;
+        }
+        if (high < low) {
+            parser->failed = true;
+            return -1;
+        }
+        setAddRange(&set, (unsigned char)low, (unsigned char)high);
+    }
+    if (*parser->p != ']') {
+        parser->failed = true;
+        return -1;
+    }
+    parser->p++;
+
+    if (negate) {
+        for (int i = 0; i < 8; i++) {
+            set.bits[i] = ~set.bits[i];
+        }
+    }
+    return addSetNode(parser, &set);
+}
+
+static int32_t parseAlternation(RegexParser *parser);
+
+static int32_t parseAtom(RegexParser *parser)
+{
+    ByteSet set;
+    memset(&set, 0, sizeof(set));
+
+    char c = *parser->p++;
+    switch (c) {
+    case '(': {
+        if (parser->p[0] == '?' && parser->p[1] == ':') {
+            parser->p += 2;
+        }
+        if (++parser->depth > MAX_GROUP_DEPTH) {
+            parser->failed = true;
+            return -1;
+        }
+        int32_t group = parseAlternation(parser);
+        parser->depth--;
+        if (*parser->p != ')') {
+            parser->failed = true;
+            return -1;
+        }
+        parser->p++;
+        return group;
+    }
+    case '[':
+        return parseClass(parser);
+    case '.':
+        memset(&set, 0xff, sizeof(set));
+        set.bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+        return addSetNode(parser, &set);
+    case '\\':
+        if (parseEscape(parser, &set) == -1) {
+            parser->failed = true;
+            return -1;
+        }
+        return addSetNode(parser, &set);
+    case '*':
+    case '+':
+    case '?':
+    case '{':
+        /* A quantifier with nothing to repeat */
+        parser->failed = true;
+        return -1;
+    default:
+        setAdd(&set, (unsigned char)c);
+        return addSetNode(parser, &set);
+    }
+}
+
+/**
+ * Parse a decimal repetition bound
+ */
+static int parseBound(RegexParser *parser)
+{
+    int value  = 0;
+    int digits = 0;
+    while (*parser->p >= '0' && *parser->p <= '9') {
+        value = value * 10 + (*parser->p++ - '0');
+        if (value > TINYAI_GRAMMAR_MAX_REPEAT) {
+            return -1;
+        }
+        digits++;
+    }
+    return digits > 0 ? value : -1;
+}
+
+static int32_t parseRepeat(RegexParser *parser)
+{
+    int32_t atom = parseAtom(parser);
+    while (!parser->failed) {
+        int min, max;
+        char c = *parser->p;
+        if (c == '*') {
+            min = 0;
+            max = -1;
+        }
+        else if (c == '+') {
+            min = 1;
+            max = -1;
+        }
+        else if (c == '?') {
+            min = 0;
+            max = 1;
+        }
+        else if (c == '{') {
+            parser->p++;
+            min = parseBound(parser);
+            max = min;
+            if (*parser->p == ',') {
+                parser->p++;
+                max = *parser->p == '}' ? -1 : parseBound(parser);
+                if (max == -1 && *parser->p != '}') {
+                    min = -1;
+                }
+            }
+            if (min < 0 || *parser->p != '}' || (max >= 0 && max < min)) {
+                parser->failed = true;
+                return -1;
+            }
+        }
+        else {
+            break;
+        }
+        parser->p++;
+
+        int32_t repeat = addNode(parser, REGEX_REPEAT, atom, -1);
+        if (repeat < 0) {
+            return -1;
+        }
+        parser->nodes[repeat].min = min;
+        parser->nodes[repeat].max = max;
+        atom                      = repeat;
+    }
+    return atom;
+}
+
+static int32_t parseConcatenation(RegexParser *parser)
+{
+    int32_t result = -1;
+    while (!parser->failed && *parser->p && *parser->p != '|' && *parser->p != ')') {
+        int32_t item = parseRepeat(parser);
+        result       = result < 0 ? item : addNode(parser, REGEX_CONCAT, result, item);
+    }
+    return result < 0 ? addNode(parser, REGEX_EMPTY, -1, -1) : result;
+}
+
+static int32_t parseAlternation(RegexParser *parser)
+{
+    int32_t left = parseConcatenation(parser);
+    while (!parser->failed && *parser->p == '|') {
+        parser->p++;
+        int32_t right = parseConcatenation(parser);
+        left          = addNode(parser, REGEX_ALT, left, right);
+    }
+    return left;
+}
+
+/* ----------------- NFA Construction ----------------- */
+
+typedef enum { NFA_SET, NFA_SPLIT, NFA_EPSILON, NFA_MATCH } NfaType;
+
+/**
+ * NFA state: a byte-set transition, an epsilon fork or link, or the match
+ */
+typedef struct {
+    NfaType  type;
+    uint32_t set;  /* Byte set of a set transition */
+    int32_t  out;  /* Next state (-1 until patched) */
+    int32_t  out1; /* Second branch of a split */
+} NfaState;
+
+typedef struct {
+    NfaState *states;
+    uint32_t  count;
+    uint32_t  capacity;
+    bool      failed;
+} Nfa;
+
+/**
+ * Piece of an NFA entered at start and left through the epsilon state end
+ */
+typedef struct {
+    int32_t start;
+    int32_t end;
+} NfaFragment;
+
+static int32_t addNfaState(Nfa *nfa, NfaType type, uint32_t set, int32_t out, int32_t out1)
+{
+    if (nfa->failed || nfa->count >= MAX_NFA_STATES ||
+        !reserveArray((void **)&nfa->states, &nfa->capacity, nfa->count, sizeof(NfaState))) {
+        nfa->failed = true;
+        return -1;
+    }
+    NfaState *state = &nfa->states[nfa->count];
+    state->type     = type;
+    state->set      = set;
+    state->out      = out;
+    state->out1     = out1;
+    return (int32_t)nfa->count++;
+}
+
+static NfaFragment compileNode(Nfa *nfa, const RegexParser *parser, int32_t index);
+
+static NfaFragment compileRepeat(Nfa *nfa, const RegexParser *parser, const RegexNode *node)
+{
+    NfaFragment failed = {-1, -1};
+    int32_t     start  = addNfaState(nfa, NFA_EPSILON, 0, -1, -1);
+    int32_t     end    = start;
+    if (start < 0) {
+        return failed;
+    }
+
+    /* Required copies, then a loop or a chain of optional ones */
+    for (int i = 0; i < node->min; i++) {
+        NfaFragment copy = compileNode(nfa, parser, node->left);
+        if (copy.start < 0) {
+            return failed;
+        }
+        nfa->states[end].out = copy.start;
+        end                  = copy.end;
+    }
+    if (node->max < 0) {
+        NfaFragment copy  = compileNode(nfa, parser, node->left);
+        int32_t     exit  = addNfaState(nfa, NFA_EPSILON, 0, -1, -1);
+        int32_t     split = addNfaState(nfa, NFA_SPLIT, 0, copy.start, exit);
+        if (copy.start < 0 || split < 0) {
+            return failed;
+        }
+        nfa->states[copy.end].out = split;
+        nfa->states[end].out      = split;
+        end                       = exit;
+    }
+    for (int i = node->min; i < node->max; i++) {
+        NfaFragment copy  = compileNode(nfa, parser, node->left);
+        int32_t     exit  = addNfaState(nfa, NFA_EPSILON, 0, -1, -1);
+        int32_t     split = addNfaState(nfa, NFA_SPLIT, 0, copy.start, exit);
+        if (copy.start < 0 || split < 0) {
+            return failed;
+        }
+        nfa->states[copy.end].out = exit;
+        nfa->states[end].out      = split;
+        end                       = exit;
+    }
+
+    NfaFragment fragment = {start, end};
+    return fragment;
+}
+
+static NfaFragment compileNode(Nfa *nfa, const RegexParser *parser, int32_t index)
+{
+    NfaFragment      failed = {-1, -1};
+    const RegexNode *node   = &parser->nodes[index];
+    NfaFragment      fragment;
+
+    switch (node->type) {
+    case REGEX_SET:
+        fragment.end   = addNfaState(nfa, NFA_EPSILON, 0, -1, -1);
+        fragment.start = addNfaState(nfa, NFA_SET, node->set, fragment.end, -1);
+        break;
+    case REGEX_CONCAT: {
+        NfaFragment left  = compileNode(nfa, parser, node->left);
+        NfaFragment right = left.start >= 0 ? compileNode(nfa, parser, node->right) : failed;
+        if (right.start < 0) {
+            return failed;
+        }
+        nfa->states[left.end].out = right.start;
+        fragment.start            = left.start;
+        fragment.end              = right.end;
+        break;
+    }
+    case REGEX_ALT: {
+        NfaFragment left  = compileNode(nfa, parser, node->left);
+        NfaFragment right = left.start >= 0 ? compileNode(nfa, parser, node->right) : failed;
+        fragment.end      = addNfaState(nfa, NFA_EPSILON, 0, -1, -1);
+        fragment.start    = addNfaState(nfa, NFA_SPLIT, 0, left.start, right.start);
+        if (right.start < 0 || fragment.start < 0) {
+            return failed;
+        }
+        nfa->states[left.end].out  = fragment.end;
+        nfa->states[right.end].out = fragment.end;
+        break;
+    }
+    case REGEX_REPEAT:
+        return compileRepeat(nfa, parser, node);
+    default:
+        fragment.start = addNfaState(nfa, NFA_EPSILON, 0, -1, -1);
+        fragment.end   = fragment.start;
+        break;
+    }
+
+    return fragment.start < 0 || fragment.end < 0 ? failed : fragment;
+}
+
+/* ----------------- Determinization ----------------- */
+
+/**
+ * Split the bytes into classes that every set contains all or none of
+ *
+ * @return Number of classes
+ */
+static uint32_t computeByteClasses(const ByteSet *sets, uint32_t setCount, uint8_t *classOf)
+{
+    uint32_t count = 1;
+    memset(classOf, 0, 256);
+    for (uint32_t s = 0; s < setCount; s++) {
+        int16_t  remap[512];
+        uint32_t newCount = 0;
+        memset(remap, -1, sizeof(remap));
+        for (int b = 0; b < 256; b++) {
+            int key = classOf[b] * 2 + (setHas(&sets[s], (unsigned char)b) ? 1 : 0);
+            if (remap[key] < 0) {
+                remap[key] = (int16_t)newCount++;
+            }
+            classOf[b] = (uint8_t)remap[key];
+        }
+        count = newCount;
+    }
+    return count;
+}
+
+/**
+ * Subset construction state
+ */
+typedef struct {
+    const Nfa     *nfa;
+    const ByteSet *sets;
+    uint32_t      *pool;         /* NFA states of every DFA state, back to back */
+    uint32_t       poolLength;   /* Entries of pool in use */
+    uint32_t       poolCapacity; /* Entries of pool allocated */
+    uint32_t      *offsets;      /* Start of each DFA state's entries in pool, plus the end */
+    uint32_t       stateCount;   /* DFA states found */
+    int32_t       *table;        /* Hash of DFA states by their NFA states (-1 = empty) */
+    uint32_t      *marks;        /* Closure visit marks per NFA state */
+    uint32_t       epoch;        /* Current closure's mark */
+    int32_t       *stack;        /* Closure stack */
+    uint32_t      *members;      /* Closure being built */
+} Determinizer;
+
+static int compareStates(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Collect the set and match states reachable by epsilon moves from seeds
+ *
+ * @return Number of states written to members, sorted
+ */
+static uint32_t epsilonClosure(Determinizer *d, const int32_t *seeds, uint32_t seedCount)
+{
+    const NfaState *states = d->nfa->states;
+    uint32_t        top    = 0;
+    uint32_t        count  = 0;
+
+    d->epoch++;
+    for (uint32_t i = 0; i < seedCount; i++) {
+        if (seeds[i] >= 0 && d->marks[seeds[i]] != d->epoch) {
+            d->marks[seeds[i]] = d->epoch;
+            d->stack[top++]    = seeds[i];
+        }
+    }
+    while (top > 0) {
+        int32_t         id    = d->stack[--top];
+        const NfaState *state = &states[id];
+        if (state->type == NFA_SET || state->type == NFA_MATCH) {
+            d->members[count++] = (uint32_t)id;
+            continue;
+        }
+        int32_t next[2] = {state->out, state->type == NFA_SPLIT ? state->out1 : -1};
+        for (int i = 0; i < 2; i++) {
+            if (next[i] >= 0 && d->marks[next[i]] != d->epoch) {
+                d->marks[next[i]] = d->epoch;
+                d->stack[top++]   = next[i];
+            }
+        }
+    }
+
+    qsort(d->members, count, sizeof(uint32_t), compareStates);
+    return count;
+}
+
+static uint32_t hashMembers(const uint32_t *members, uint32_t count)
+{
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < count; i++) {
+        hash = (hash ^ members[i]) * 16777619u;
+    }
+    return hash ^ count;
+}
+
+/**
+ * Find or add the DFA state of the closure in d->members
+ *
+ * @return DFA state, or -1 if there are too many states or on allocation failure
+ */
+static int32_t internState(Determinizer *d, uint32_t count)
+{
+    const uint32_t slots = 2 * TINYAI_GRAMMAR_MAX_STATES;
+    uint32_t       slot  = hashMembers(d->members, count) & (slots - 1);
+    while (d->table[slot] >= 0) {
+        uint32_t state = (uint32_t)d->table[slot];
+        uint32_t start = d->offsets[state];
+        if (d->offsets[state + 1] - start == count &&
+            memcmp(d->pool + start, d->members, count * sizeof(uint32_t)) == 0) {
+            return (int32_t)state;
+        }
+        slot = (slot + 1) & (slots - 1);
+    }
+
+    if (d->stateCount >= TINYAI_GRAMMAR_MAX_STATES) {
+        return -1;
+    }
+    while (d->poolLength + count > d->poolCapacity) {
+        uint32_t  capacity = d->poolCapacity ? d->poolCapacity * 2 : 1024;
+        uint32_t *grown    = (uint32_t *)TINYAI_REALLOC(d->pool, capacity * sizeof(uint32_t));
+        if (!grown) {
+            return -1;
+        }
+        d->pool         = grown;
+        d->poolCapacity = capacity;
+    }
+    memcpy(d->pool + d->poolLength, d->members, count * sizeof(uint32_t));
+    d->poolLength += count;
+    d->offsets[++d->stateCount] = d->poolLength;
+    d->table[slot]               = (int32_t)(d->stateCount - 1);
+    return (int32_t)(d->stateCount - 1);
+}
+
+/* ----------------- Grammar ----------------- */
+
+/**
+ * Compiled grammar
+ *
+ * States 0 to dfaStates - 1 follow the automaton after some text; state
+ * dfaStates is the automaton's start before any text, where the first
+ * piece is decoded without a separating space.
+ */
+struct TinyAIGrammar {
+    const TinyAITokenizer *tokenizer;     /* Tokenizer the masks were built for */
+    uint32_t               vocabSize;     /* Tokens per mask */
+    uint32_t               dfaStates;     /* Automaton states */
+    uint32_t               dfaStart;      /* Automaton start state */
+    uint32_t               classCount;    /* Byte classes */
+    uint8_t                classOf[256];  /* Byte class of each byte */
+    int32_t               *transitions;   /* [dfaStates x classCount], -1 = no match possible */
+    bool                  *accepting;     /* Whether each automaton state is a full match */
+    uint32_t               maskWords;     /* 32-bit words per mask */
+    uint32_t              *masks;         /* [(dfaStates + 1) x maskWords] allowed tokens */
+    uint32_t              *allowedCounts; /* Tokens allowed in each state */
+};
+
+/**
+ * Trie of decoded token pieces
+ */
+typedef struct {
+    int32_t child;   /* First child (-1 = none) */
+    int32_t sibling; /* Next sibling (-1 = none) */
+    int32_t token;   /* First token whose piece ends here (-1 = none) */
+    uint8_t byte;    /* Byte on the edge from the parent */
+} TrieNode;
+
+typedef struct {
+    TrieNode *nodes;
+    uint32_t  count;
+    uint32_t  capacity;
+    int32_t  *tokenNext; /* Next token ending at the same node (-1 = none) */
+} TokenTrie;
+
+static bool trieInsert(TokenTrie *trie, const char *piece, int length, int token)
+{
+    int32_t node = 0;
+    for (int i = 0; i < length; i++) {
+        uint8_t byte  = (uint8_t)piece[i];
+        int32_t child = trie->nodes[node].child;
+        while (child >= 0 && trie->nodes[child].byte != byte) {
+            child = trie->nodes[child].sibling;
+        }
+        if (child < 0) {
+            if (!reserveArray((void **)&trie->nodes, &trie->capacity, trie->count,
+                              sizeof(TrieNode))) {
+                return false;
+            }
+            child                      = (int32_t)trie->count++;
+            trie->nodes[child].child   = -1;
+            trie->nodes[child].sibling = trie->nodes[node].child;
+            trie->nodes[child].token   = -1;
+            trie->nodes[child].byte    = byte;
+            trie->nodes[node].child    = child;
+        }
+        node = child;
+    }
+    trie->tokenNext[token]  = trie->nodes[node].token;
+    trie->nodes[node].token = token;
+    return true;
+}
+
+/**
+ * Build a trie of every token's piece, decoded after text or at the start
+ */
+static bool buildTokenTrie(TokenTrie *trie, const TinyAITokenizer *tokenizer, uint32_t vocabSize,
+                           int afterText)
+{
+    trie->nodes     = NULL;
+    trie->count     = 0;
+    trie->capacity  = 0;
+    trie->tokenNext = (int32_t *)TINYAI_MALLOC(vocabSize * sizeof(int32_t));
+    if (!trie->tokenNext || !reserveArray((void **)&trie->nodes, &trie->capacity, 0,
+                                          sizeof(TrieNode))) {
+        return false;
+    }
+    trie->nodes[0].child   = -1;
+    trie->nodes[0].sibling = -1;
+    trie->nodes[0].token   = -1;
+    trie->nodes[0].byte    = 0;
+    trie->count            = 1;
+
+    char piece[TINYAI_MAX_TOKEN_LENGTH + 2];
+    for (uint32_t t = 0; t < vocabSize; t++) {
+        int length =
+            tinyaiDecodeTokenPiece(tokenizer, (int)t, afterText, piece, (int)sizeof(piece));
+        trie->tokenNext[t] = -1;
+        if (length > 0 && !trieInsert(trie, piece, length, (int)t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void freeTokenTrie(TokenTrie *trie)
+{
+    if (trie->nodes)
+        TINYAI_FREE(trie->nodes);
+    if (trie->tokenNext)
+        TINYAI_FREE(trie->tokenNext);
+}
+
+/**
+ * Mark the tokens whose pieces the automaton accepts from a state
+ *
+ * stack holds two entries per trie node.
+ */
+static uint32_t buildStateMask(const TinyAIGrammar *grammar, const TokenTrie *trie,
+                               uint32_t dfaState, uint32_t *mask, int32_t *stack)
+{
+    uint32_t allowed = 0;
+    uint32_t top     = 0;
+    stack[top++]     = 0;
+    stack[top++]     = (int32_t)dfaState;
+    while (top > 0) {
+        int32_t state = stack[--top];
+        int32_t node  = stack[--top];
+        for (int32_t t = trie->nodes[node].token; t >= 0; t = trie->tokenNext[t]) {
+            mask[t >> 5] |= 1u << (t & 31);
+            allowed++;
+        }
+        const int32_t *row = grammar->transitions + (size_t)state * grammar->classCount;
+        for (int32_t c = trie->nodes[node].child; c >= 0; c = trie->nodes[c].sibling) {
+            int32_t next = row[grammar->classOf[trie->nodes[c].byte]];
+            if (next >= 0) {
+                stack[top++] = c;
+                stack[top++] = next;
+            }
+        }
+    }
+    return allowed;
+}
+
+/**
+ * Build every state's token mask
+ */
+static bool buildMasks(TinyAIGrammar *grammar)
+{
+    uint32_t states    = grammar->dfaStates + 1;
+    grammar->maskWords = (grammar->vocabSize + 31) / 32;
+    grammar->masks =
+        (uint32_t *)TINYAI_CALLOC((size_t)states * grammar->maskWords, sizeof(uint32_t));
+    grammar->allowedCounts = (uint32_t *)TINYAI_MALLOC(states * sizeof(uint32_t));
+    if (!grammar->masks || !grammar->allowedCounts) {
+        return false;
+    }
+
+    TokenTrie after, start;
+    bool      ok = buildTokenTrie(&after, grammar->tokenizer, grammar->vocabSize, 1);
+    ok = buildTokenTrie(&start, grammar->tokenizer, grammar->vocabSize, 0) && ok;
+
+    uint32_t stackSize = after.count > start.count ? after.count : start.count;
+    int32_t *stack     = ok ? (int32_t *)TINYAI_MALLOC(2 * stackSize * sizeof(int32_t)) : NULL;
+    if (stack) {
+        for (uint32_t s = 0; s < states; s++) {
+            bool      initial = s == grammar->dfaStates;
+            uint32_t  state   = initial ? grammar->dfaStart : s;
+            uint32_t *mask    = grammar->masks + (size_t)s * grammar->maskWords;
+
+            grammar->allowedCounts[s] =
+                buildStateMask(grammar, initial ? &start : &after, state, mask, stack);
+            if (grammar->accepting[state] && TINYAI_TOKEN_EOS < grammar->vocabSize) {
+                mask[TINYAI_TOKEN_EOS >> 5] |= 1u << (TINYAI_TOKEN_EOS & 31);
+                grammar->allowedCounts[s]++;
+            }
+        }
+        TINYAI_FREE(stack);
+    }
+
+    freeTokenTrie(&after);
+    freeTokenTrie(&start);
+    return stack != NULL;
+}
+
+/**
+ * Determinize an NFA into the grammar's automaton, keeping only states
+ * from which a match is still reachable
+ */
+static bool buildAutomaton(TinyAIGrammar *grammar, const Nfa *nfa, int32_t nfaStart,
+                           const ByteSet *sets, uint32_t setCount)
+{
+    grammar->classCount = computeByteClasses(sets, setCount, grammar->classOf);
+    uint8_t  classByte[256];
+    uint32_t classes = grammar->classCount;
+    for (int b = 255; b >= 0; b--) {
+        classByte[grammar->classOf[b]] = (uint8_t)b;
+    }
+
+    Determinizer d;
+    memset(&d, 0, sizeof(d));
+    d.nfa     = nfa;
+    d.sets    = sets;
+    d.offsets = (uint32_t *)TINYAI_MALLOC((TINYAI_GRAMMAR_MAX_STATES + 1) * sizeof(uint32_t));
+    d.table   = (int32_t *)TINYAI_MALLOC(2 * TINYAI_GRAMMAR_MAX_STATES * sizeof(int32_t));
+    d.marks   = (uint32_t *)TINYAI_CALLOC(nfa->count, sizeof(uint32_t));
+    d.stack   = (int32_t *)TINYAI_MALLOC(nfa->count * sizeof(int32_t));
+    d.members = (uint32_t *)TINYAI_MALLOC(nfa->count * sizeof(uint32_t));
+    int32_t *seeds = (int32_t *)TINYAI_MALLOC(nfa->count * sizeof(int32_t));
+    int32_t *table = (int32_t *)TINYAI_MALLOC((size_t)TINYAI_GRAMMAR_MAX_STATES * classes *
+                                              sizeof(int32_t));
+    bool     ok    = d.offsets && d.table && d.marks && d.stack && d.members && seeds && table;
+
+    if (ok) {
+        memset(d.table, -1, 2 * TINYAI_GRAMMAR_MAX_STATES * sizeof(int32_t));
+        d.offsets[0] = 0;
+        ok           = internState(&d, epsilonClosure(&d, &nfaStart, 1)) == 0;
+    }
+
+    /* States are numbered as found, so this visits each once */
+    for (uint32_t s = 0; ok && s < d.stateCount; s++) {
+        for (uint32_t c = 0; ok && c < classes; c++) {
+            uint32_t seedCount = 0;
+            for (uint32_t i = d.offsets[s]; i < d.offsets[s + 1]; i++) {
+                const NfaState *state = &nfa->states[d.pool[i]];
+                if (state->type == NFA_SET && setHas(&sets[state->set], classByte[c])) {
+                    seeds[seedCount++] = state->out;
+                }
+            }
+            int32_t next = -1;
+            if (seedCount > 0) {
+                uint32_t count = epsilonClosure(&d, seeds, seedCount);
+                next           = count > 0 ? internState(&d, count) : -1;
+                ok             = count == 0 || next >= 0;
+            }
+            table[(size_t)s * classes + c] = next;
+        }
+    }
+
+    /* Live states reach a match; the others are cut */
+    bool     *live  = ok ? (bool *)TINYAI_CALLOC(d.stateCount, sizeof(bool)) : NULL;
+    int32_t  *remap = ok ? (int32_t *)TINYAI_MALLOC(d.stateCount * sizeof(int32_t)) : NULL;
+    uint32_t *order = ok ? (uint32_t *)TINYAI_MALLOC(d.stateCount * sizeof(uint32_t)) : NULL;
+    ok              = live && remap && order;
+    for (uint32_t s = 0; ok && s < d.stateCount; s++) {
+        for (uint32_t i = d.offsets[s]; i < d.offsets[s + 1]; i++) {
+            live[s] = live[s] || nfa->states[d.pool[i]].type == NFA_MATCH;
+        }
+    }
+    for (bool changed = ok; changed;) {
+        changed = false;
+        for (uint32_t s = 0; s < d.stateCount; s++) {
+            for (uint32_t c = 0; !live[s] && c < classes; c++) {
+                int32_t next = table[(size_t)s * classes + c];
+                if (next >= 0 && live[next]) {
+                    live[s] = changed = true;
+                }
+            }
+        }
+    }
+    ok = ok && live[0];
+
+    /* Renumber the live states reachable from the start, in breadth-first order */
+    uint32_t count = 0;
+    if (ok) {
+        for (uint32_t s = 0; s < d.stateCount; s++) {
+            remap[s] = -1;
+        }
+        remap[0]       = 0;
+        order[count++] = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint32_t c = 0; c < classes; c++) {
+                int32_t next = table[(size_t)order[i] * classes + c];
+                if (next >= 0 && live[next] && remap[next] < 0) {
+                    remap[next]    = (int32_t)count;
+                    order[count++] = (uint32_t)next;
+                }
+            }
+        }
+
+        grammar->dfaStates   = count;
+        grammar->dfaStart    = 0;
+        grammar->transitions = (int32_t *)TINYAI_MALLOC((size_t)count * classes * sizeof(int32_t));
+        grammar->accepting   = (bool *)TINYAI_CALLOC(count, sizeof(bool));
+        ok                   = grammar->transitions && grammar->accepting;
+        for (uint32_t i = 0; ok && i < count; i++) {
+            uint32_t s = order[i];
+            for (uint32_t c = 0; c < classes; c++) {
+                int32_t next = table[(size_t)s * classes + c];
+                grammar->transitions[(size_t)i * classes + c] =
+                    next >= 0 && live[next] ? remap[next] : -1;
+            }
+            for (uint32_t m = d.offsets[s]; m < d.offsets[s + 1]; m++) {
+                grammar->accepting[i] = grammar->accepting[i] ||
+                                        nfa->states[d.pool[m]].type == NFA_MATCH;
+            }
+        }
+    }
+
+    if (live)
+        TINYAI_FREE(live);
+    if (remap)
+        TINYAI_FREE(remap);
+    if (order)
+        TINYAI_FREE(order);
+    if (table)
+        TINYAI_FREE(table);
+    if (seeds)
+        TINYAI_FREE(seeds);
+    if (d.pool)
+        TINYAI_FREE(d.pool);
+    if (d.offsets)
+        TINYAI_FREE(d.offsets);
+    if (d.table)
+        TINYAI_FREE(d.table);
+    if (d.marks)
+        TINYAI_FREE(d.marks);
+    if (d.stack)
+        TINYAI_FREE(d.stack);
+    if (d.members)
+        TINYAI_FREE(d.members);
+    return ok;
+}
+
+/**
+ * Compile a regular expression into a grammar over a tokenizer's vocabulary
+ */
+TinyAIGrammar *tinyaiCompileGrammar(const char *pattern, const TinyAITokenizer *tokenizer)
+{
+    if (!pattern || !tokenizer || tokenizer->tokenCount == 0) {
+        return NULL;
+    }
+
+    RegexParser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.p     = pattern;
+    int32_t root = parseAlternation(&parser);
+    if (*parser.p != '\0') {
+        parser.failed = true; /* An unmatched ')' */
+    }
+
+    Nfa nfa;
+    memset(&nfa, 0, sizeof(nfa));
+    NfaFragment fragment = {-1, -1};
+    int32_t     match    = -1;
+    if (!parser.failed && root >= 0) {
+        fragment = compileNode(&nfa, &parser, root);
+        match    = addNfaState(&nfa, NFA_MATCH, 0, -1, -1);
+        if (fragment.end >= 0 && match >= 0) {
+            nfa.states[fragment.end].out = match;
+        }
+    }
+
+    TinyAIGrammar *grammar = NULL;
+    if (fragment.start >= 0 && match >= 0) {
+        grammar = (TinyAIGrammar *)TINYAI_CALLOC(1, sizeof(TinyAIGrammar));
+    }
+    if (grammar) {
+        grammar->tokenizer = tokenizer;
+        grammar->vocabSize = tokenizer->tokenCount;
+        if (!buildAutomaton(grammar, &nfa, fragment.start, parser.sets, parser.setCount) ||
+            !buildMasks(grammar)) {
+            tinyaiDestroyGrammar(grammar);
+            grammar = NULL;
+        }
+    }
+
+    if (nfa.states)
+        TINYAI_FREE(nfa.states);
+    if (parser.nodes)
+        TINYAI_FREE(parser.nodes);
+    if (parser.sets)
+        TINYAI_FREE(parser.sets);
+    return grammar;
+}
+
+/**
+ * Free a grammar
+ */
+void tinyaiDestroyGrammar(TinyAIGrammar *grammar)
+{
+    if (!grammar) {
+        return;
+    }
+    if (grammar->transitions)
+        TINYAI_FREE(grammar->transitions);
+    if (grammar->accepting)
+        TINYAI_FREE(grammar->accepting);
+    if (grammar->masks)
+        TINYAI_FREE(grammar->masks);
+    if (grammar->allowedCounts)
+        TINYAI_FREE(grammar->allowedCounts);
+    TINYAI_FREE(grammar);
+}
+
+/**
+ * Get the state a grammar starts generation in
+ */
+uint32_t tinyaiGrammarStartState(const TinyAIGrammar *grammar)
+{
+    return grammar ? grammar->dfaStates : 0;
+}
+
+/**
+ * Check whether a grammar allows a token in a state
+ */
+bool tinyaiGrammarAllows(const TinyAIGrammar *grammar, uint32_t state, int token)
+{
+    if (!grammar || state > grammar->dfaStates || token < 0 ||
+        (uint32_t)token >= grammar->vocabSize) {
+        return false;
+    }
+    const uint32_t *mask = grammar->masks + (size_t)state * grammar->maskWords;
+    return (mask[token >> 5] >> (token & 31)) & 1u;
+}
+
+/**
+ * Step a grammar's state past a generated token
+ */
+int64_t tinyaiGrammarAdvance(const TinyAIGrammar *grammar, uint32_t state, int token)
+{
+    if (token == TINYAI_TOKEN_EOS || !tinyaiGrammarAllows(grammar, state, token)) {
+        return -1;
+    }
+
+    /* The mask vouches for the piece, so the walk never leaves the automaton */
+    bool    initial = state == grammar->dfaStates;
+    int32_t current = (int32_t)(initial ? grammar->dfaStart : state);
+    char    piece[TINYAI_MAX_TOKEN_LENGTH + 2];
+    int     length  = tinyaiDecodeTokenPiece(grammar->tokenizer, token, initial ? 0 : 1, piece,
+                                             (int)sizeof(piece));
+    for (int i = 0; i < length && current >= 0; i++) {
+        current = grammar->transitions[(size_t)current * grammar->classCount +
+                                       grammar->classOf[(uint8_t)piece[i]]];
+    }
+    return current;
+}
+
+/**
+ * Check whether the text leading to a state fully matches a grammar
+ */
+bool tinyaiGrammarAccepts(const TinyAIGrammar *grammar, uint32_t state)
+{
+    if (!grammar || state > grammar->dfaStates) {
+        return false;
+    }
+    return grammar->accepting[state == grammar->dfaStates ? grammar->dfaStart : state];
+}
+
+/**
+ * Exclude the logits of every token a grammar does not allow in a state
+ */
+uint32_t tinyaiGrammarMaskLogits(const TinyAIGrammar *grammar, uint32_t state, float *logits,
+                                 uint32_t vocabSize)
+{
+    if (!grammar || !logits || vocabSize != grammar->vocabSize || state > grammar->dfaStates) {
+        return 0;
+    }
+    tinyaiSimdMaskLogits(logits, grammar->masks + (size_t)state * grammar->maskWords,
+                         (int)vocabSize);
+    return grammar->allowedCounts[state];
+}
+
+/**
+ * Get the number of states of a grammar
+ */
+uint32_t tinyaiGrammarStateCount(const TinyAIGrammar *grammar)
+{
+    return grammar ? grammar->dfaStates + 1 : 0;
+}
+
+/* ----------------- JSON Schemas ----------------- */
+
+/**
+ * Growable pattern text
+ */
+typedef struct {
+    char  *data;
+    size_t length;
+    size_t capacity;
+    bool   failed;
+} PatternBuffer;
+
+static void appendBytes(PatternBuffer *out, const char *text, size_t length)
+{
+    if (out->failed) {
+        return;
+    }
+    if (out->length + length + 1 > out->capacity) {
+        size_t capacity = out->capacity ? out->capacity : 256;
+        while (out->length + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *grown = (char *)TINYAI_REALLOC(out->data, capacity);
+        if (!grown) {
+            out->failed = true;
+            return;
+        }
+        out->data     = grown;
+        out->capacity = capacity;
+    }
+    memcpy(out->data + out->length, text, length);
+    out->length += length;
+    out->data[out->length] = '\0';
+}
+
+static void append(PatternBuffer *out, const char *text)
+{
+    appendBytes(out, text, strlen(text));
+}
+
+/**
+ * Append text matched literally
+ */
+static void appendLiteral(PatternBuffer *out, const char *text, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        char          escaped[5];
+        if (c < 0x20 || c >= 0x7f) {
+            snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+            append(out, escaped);
+        }
+        else if (strchr("\\.[](){}*+?|^$", c)) {
+            escaped[0] = '\\';
+            escaped[1] = (char)c;
+            appendBytes(out, escaped, 2);
+        }
+        else {
+            appendBytes(out, (const char *)&c, 1);
+        }
+    }
+}
+
+/**
+ * Append a repetition of at least min and at most max (-1 = unbounded)
+ */
+static void appendQuantifier(PatternBuffer *out, long min, long max)
+{
+    char quantifier[48];
+    if (min <= 0 && max < 0) {
+        append(out, "*");
+        return;
+    }
+    if (max < 0) {
+        snprintf(quantifier, sizeof(quantifier), "{%ld,}", min);
+    }
+    else if (min == max) {
+        snprintf(quantifier, sizeof(quantifier), "{%ld}", min);
+    }
+    else {
+        snprintf(quantifier, sizeof(quantifier), "{%ld,%ld}", min < 0 ? 0 : min, max);
+    }
+    append(out, quantifier);
+}
+
+static const char *skipSpace(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * End of the JSON string whose opening quote is at p, or NULL
+ */
+static const char *skipString(const char *p)
+{
+    for (p++; *p && *p != '"'; p++) {
+        if (*p == '\\' && *++p == '\0') {
+            return NULL;
+        }
+    }
+    return *p == '"' ? p + 1 : NULL;
+}
+
+/**
+ * End of the JSON value at p, or NULL if it is malformed
+ */
+static const char *skipValue(const char *p, int depth)
+{
+    p = skipSpace(p);
+    if (*p == '"') {
+        return skipString(p);
+    }
+    if (*p == '{' || *p == '[') {
+        char close = *p == '{' ? '}' : ']';
+        p          = skipSpace(p + 1);
+        if (*p == close) {
+            return p + 1;
+        }
+        if (depth >= MAX_SCHEMA_DEPTH) {
+            return NULL;
+        }
+        for (;;) {
+            if (close == '}') {
+                p = *p == '"' ? skipString(p) : NULL;
+                p = p ? skipSpace(p) : NULL;
+                if (!p || *p != ':') {
+                    return NULL;
+                }
+                p++;
+            }
+            p = skipValue(p, depth + 1);
+            if (!p) {
+                return NULL;
+            }
+            p = skipSpace(p);
+            if (*p != ',') {
+                return *p == close ? p + 1 : NULL;
+            }
+            p = skipSpace(p + 1);
+        }
+    }
+
+    const char *start = p;
+    while (*p && strchr("+-.0123456789eEtrufalsn", *p)) {
+        p++;
+    }
+    return p > start ? p : NULL;
+}
+
+/**
+ * Whether the JSON string at p is exactly text
+ */
+static bool stringIs(const char *p, const char *text)
+{
+    size_t length = strlen(text);
+    return *p == '"' && strncmp(p + 1, text, length) == 0 && p[length + 1] == '"';
+}
+
+/**
+ * Value of an object's member, or NULL
+ */
+static const char *findMember(const char *object, const char *key)
+{
+    const char *p = skipSpace(object);
+    if (*p != '{') {
+        return NULL;
+    }
+    p = skipSpace(p + 1);
+    while (*p == '"') {
+        const char *name = p;
+        p                = skipString(p);
+        p                = p ? skipSpace(p) : NULL;
+        if (!p || *p != ':') {
+            return NULL;
+        }
+        const char *value = skipSpace(p + 1);
+        if (stringIs(name, key)) {
+            return value;
+        }
+        p = skipValue(value, 0);
+        if (!p) {
+            return NULL;
+        }
+        p = skipSpace(p);
+        if (*p != ',') {
+            break;
+        }
+        p = skipSpace(p + 1);
+    }
+    return NULL;
+}
+
+/**
+ * First element of an array, or NULL if it is empty or not an array
+ */
+static const char *firstElement(const char *array)
+{
+    const char *p = skipSpace(array);
+    if (*p != '[') {
+        return NULL;
+    }
+    p = skipSpace(p + 1);
+    return *p == ']' ? NULL : p;
+}
+
+/**
+ * Element after the one at p, or NULL after the last
+ */
+static const char *nextElement(const char *p)
+{
+    p = skipValue(p, 0);
+    p = p ? skipSpace(p) : NULL;
+    return p && *p == ',' ? skipSpace(p + 1) : NULL;
+}
+
+static long integerMember(const char *schema, const char *key, long fallback)
+{
+    const char *value = findMember(schema, key);
+    return value && *value >= '0' && *value <= '9' ? strtol(value, NULL, 10) : fallback;
+}
+
+static bool appendSchema(PatternBuffer *out, const char *schema, int depth);
+
+static void appendAnyValue(PatternBuffer *out, int depth);
+
+/**
+ * Append any JSON array whose elements nest up to depth deep
+ */
+static void appendAnyArray(PatternBuffer *out, int depth)
+{
+    append(out, "\\[" JSON_WS "(");
+    appendAnyValue(out, depth);
+    append(out, "(" JSON_WS "," JSON_WS);
+    appendAnyValue(out, depth);
+    append(out, ")*)?" JSON_WS "\\]");
+}
+
+/**
+ * Append any JSON object whose values nest up to depth deep
+ */
+static void appendAnyObject(PatternBuffer *out, int depth)
+{
+    append(out, "\\{" JSON_WS "(" JSON_STRING JSON_WS ":" JSON_WS);
+    appendAnyValue(out, depth);
+    append(out, "(" JSON_WS "," JSON_WS JSON_STRING JSON_WS ":" JSON_WS);
+    appendAnyValue(out, depth);
+    append(out, ")*)?" JSON_WS "\\}");
+}
+
+/**
+ * Append any JSON value with arrays and objects nested up to depth deep
+ */
+static void appendAnyValue(PatternBuffer *out, int depth)
+{
+    append(out, "(" JSON_SCALAR);
+    if (depth > 0) {
+        append(out, "|");
+        appendAnyArray(out, depth - 1);
+        append(out, "|");
+        appendAnyObject(out, depth - 1);
+    }
+    append(out, ")");
+}
+
+/**
+ * Append the contents of a JSON string with its escapes resolved
+ */
+static bool appendUnescaped(PatternBuffer *out, const char *string, const char *end)
+{
+    for (const char *p = string + 1; p < end - 1; p++) {
+        char c = *p;
+        if (c == '\\') {
+            const char *from = "\"\\/bfnrt";
+            const char *to   = "\"\\/\b\f\n\r\t";
+            const char *kind = strchr(from, *++p);
+            if (*p == '\0' || !kind) {
+                return false; /* \u escapes are not supported in patterns */
+            }
+            c = to[kind - from];
+        }
+        appendBytes(out, &c, 1);
+    }
+    return true;
+}
+
+/**
+ * Append the values of one type of a schema
+ */
+static bool appendType(PatternBuffer *out, const char *schema, const char *type, int depth)
+{
+    if (stringIs(type, "string")) {
+        const char *pattern = findMember(schema, "pattern");
+        if (pattern) {
+            const char *end = *pattern == '"' ? skipString(pattern) : NULL;
+            if (!end) {
+                return false;
+            }
+            append(out, "\"(");
+            if (!appendUnescaped(out, pattern, end)) {
+                return false;
+            }
+            append(out, ")\"");
+            return true;
+        }
+        append(out, "\"" JSON_CHAR);
+        appendQuantifier(out, integerMember(schema, "minLength", 0),
+                         integerMember(schema, "maxLength", -1));
+        append(out, "\"");
+    }
+    else if (stringIs(type, "integer")) {
+        append(out, JSON_INTEGER);
+    }
+    else if (stringIs(type, "number")) {
+        append(out, JSON_NUMBER);
+    }
+    else if (stringIs(type, "boolean")) {
+        append(out, "(true|false)");
+    }
+    else if (stringIs(type, "null")) {
+        append(out, "null");
+    }
+    else if (stringIs(type, "array")) {
+        const char *items = findMember(schema, "items");
+        long        min   = integerMember(schema, "minItems", 0);
+        long        max   = integerMember(schema, "maxItems", -1);
+        if (max >= 0 && max < min) {
+            return false;
+        }
+
+        append(out, "\\[" JSON_WS);
+        for (int copy = 0; max != 0 && copy < 2; copy++) {
+            if (copy == 0) {
+                append(out, min == 0 ? "((" : "(");
+            }
+            else {
+                append(out, "(" JSON_WS "," JSON_WS "(");
+            }
+            if (items) {
+                if (!appendSchema(out, items, depth + 1)) {
+                    return false;
+                }
+            }
+            else {
+                appendAnyValue(out, TINYAI_GRAMMAR_JSON_DEPTH - 1);
+            }
+            append(out, copy == 0 ? ")" : "))");
+        }
+        if (max != 0) {
+            appendQuantifier(out, min > 0 ? min - 1 : 0, max < 0 ? -1 : max - 1);
+            append(out, min == 0 ? ")?" : ")");
+        }
+        append(out, JSON_WS "\\]");
+    }
+    else if (stringIs(type, "object")) {
+        const char *properties = findMember(schema, "properties");
+        const char *name       = properties ? skipSpace(skipSpace(properties) + 1) : NULL;
+        if (!name || *name != '"') {
+            appendAnyObject(out, TINYAI_GRAMMAR_JSON_DEPTH - 1);
+            return true;
+        }
+
+        /* Every property, in the order the schema lists them */
+        append(out, "\\{" JSON_WS);
+        for (bool first = true; name && *name == '"'; first = false) {
+            const char *end   = skipString(name);
+            const char *colon = end ? skipSpace(end) : NULL;
+            if (!colon || *colon != ':') {
+                return false;
+            }
+            const char *value = skipSpace(colon + 1);
+            if (!first) {
+                append(out, JSON_WS "," JSON_WS);
+            }
+            appendLiteral(out, name, (size_t)(end - name));
+            append(out, JSON_WS ":" JSON_WS);
+            if (!appendSchema(out, value, depth + 1)) {
+                return false;
+            }
+
+            const char *next = skipValue(value, 0);
+            next             = next ? skipSpace(next) : NULL;
+            if (!next) {
+                return false;
+            }
+            name = *next == ',' ? skipSpace(next + 1) : NULL;
+        }
+        append(out, JSON_WS "\\}");
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Append the values a schema accepts, as one group
+ */
+static bool appendSchema(PatternBuffer *out, const char *schema, int depth)
+{
+    schema = skipSpace(schema);
+    if (depth > MAX_SCHEMA_DEPTH || strncmp(schema, "false", 5) == 0) {
+        return false;
+    }
+    if (strncmp(schema, "true", 4) == 0) {
+        appendAnyValue(out, TINYAI_GRAMMAR_JSON_DEPTH);
+        return true;
+    }
+    if (*schema != '{') {
+        return false;
+    }
+
+    append(out, "(");
+    const char *values = findMember(schema, "enum");
+    const char *value  = findMember(schema, "const");
+    const char *type   = findMember(schema, "type");
+    const char *anyOf  = findMember(schema, "anyOf");
+    if (!anyOf) {
+        anyOf = findMember(schema, "oneOf");
+    }
+
+    if (values || value) {
+        /* Each listed value exactly as the schema writes it */
+        const char *item = values ? firstElement(values) : value;
+        for (bool first = true; item; first = false) {
+            const char *end = skipValue(item, 0);
+            if (!end) {
+                return false;
+            }
+            if (!first) {
+                append(out, "|");
+            }
+            appendLiteral(out, item, (size_t)(end - item));
+            item = values ? nextElement(item) : NULL;
+        }
+    }
+    else if (anyOf) {
+        const char *option = firstElement(anyOf);
+        for (bool first = true; option; first = false, option = nextElement(option)) {
+            if (!first) {
+                append(out, "|");
+            }
+            if (!appendSchema(out, option, depth + 1)) {
+                return false;
+            }
+        }
+    }
+    else if (type && *type == '[') {
+        const char *name = firstElement(type);
+        for (bool first = true; name; first = false, name = nextElement(name)) {
+            if (!first) {
+                append(out, "|");
+            }
+            if (!appendType(out, schema, name, depth)) {
+                return false;
+            }
+        }
+    }
+    else if (type) {
+        if (!appendType(out, schema, type, depth)) {
+            return false;
+        }
+    }
+    else {
+        appendAnyValue(out, TINYAI_GRAMMAR_JSON_DEPTH);
+    }
+    append(out, ")");
+    return !out->failed;
+}
+
+/**
+ * Build the pattern of a JSON schema
+ */
+static bool schemaPattern(const char *schema, PatternBuffer *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!schema) {
+        appendAnyValue(out, TINYAI_GRAMMAR_JSON_DEPTH);
+        return !out->failed;
+    }
+
+    const char *end = skipValue(schema, 0);
+    return end && *skipSpace(end) == '\0' && appendSchema(out, schema, 0);
+}
+
+/**
+ * Convert a JSON schema to the regular expression tinyaiCompileJsonSchema compiles
+ */
+int tinyaiJsonSchemaToPattern(const char *schema, char *pattern, size_t size)
+{
+    if (!pattern || size == 0) {
+        return -1;
+    }
+
+    PatternBuffer out;
+    int           length = -1;
+    if (schemaPattern(schema, &out) && out.length < size) {
+        memcpy(pattern, out.data, out.length + 1);
+        length = (int)out.length;
+    }
+    if (out.data)
+        TINYAI_FREE(out.data);
+    return length;
+}
+
+/**
+ * Compile a JSON schema into a grammar over a tokenizer's vocabulary
+ */
+TinyAIGrammar *tinyaiCompileJsonSchema(const char *schema, const TinyAITokenizer *tokenizer)
+{
+    PatternBuffer  out;
+    TinyAIGrammar *grammar = NULL;
+    if (schemaPattern(schema, &out)) {
+        grammar = tinyaiCompileGrammar(out.data, tokenizer);
+    }
+    if (out.data)
+        TINYAI_FREE(out.data);
+    return grammar;
+}
@@ -0,0 +1,148 @@
+/**
+ * TinyAI Grammar-Constrained Decoding Header
+ *
+ * A grammar restricts generated text to the strings a pattern matches. The
+ * pattern (a regular expression, or one derived from a JSON schema) is
+ * compiled once into a deterministic automaton over bytes, then walked with
+ * every token of the vocabulary from every automaton state, so each state
+ * carries a bitmask of the tokens that keep the text matchable. Decoding
+ * masks the logits with the current state's bitmask before sampling and
+ * steps the state with the sampled token, both a constant cost per token.
+ *
+ * Text is matched as tinyaiDecodeTokens renders the generated tokens alone,
+ * separating spaces included. End-of-sequence is allowed exactly where the
+ * text so far is a full match.
+ */
+
+#ifndef TINYAI_GRAMMAR_H
+#define TINYAI_GRAMMAR_H
+
+#include "tokenizer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ----------------- Constants ----------------- */
+
+/* Most automaton states a grammar may compile to */
+#define TINYAI_GRAMMAR_MAX_STATES 4096
+
+/* Largest bound of a {n,m} repetition */
+#define TINYAI_GRAMMAR_MAX_REPEAT 256
+
+/* Nesting depth of arrays and objects a schema without a type allows */
+#define TINYAI_GRAMMAR_JSON_DEPTH 2
+
+/* ----------------- Types ----------------- */
+
+/**
+ * Compiled grammar with its token masks (opaque, read-only once compiled)
+ */
+typedef struct TinyAIGrammar TinyAIGrammar;
+
+/* ----------------- API Functions ----------------- */
+
+/**
+ * Compile a regular expression into a grammar over a tokenizer's vocabulary
+ *
+ * The whole generated text must match. Supported syntax: literals, '.',
+ * escapes (\d \w \s \n \t \r \xHH and escaped metacharacters), classes
+ * such as [a-z] and [^"], groups, '|' and the quantifiers * + ? {n} {n,}
+ * and {n,m}.
+ *
+ * @param pattern Regular expression
+ * @param tokenizer Tokenizer whose tokens are masked (must outlive the grammar)
+ * @return New grammar, or NULL if the pattern is invalid or needs too many states
+ */
+TinyAIGrammar *tinyaiCompileGrammar(const char *pattern, const TinyAITokenizer *tokenizer);
+
+/**
+ * Compile a JSON schema into a grammar over a tokenizer's vocabulary
+ *
+ * Supported keywords: type (string, number, integer, boolean, null, array,
+ * object, or a list of them), properties (every property is emitted, in
+ * order), items, minItems, maxItems, minLength, maxLength, pattern (of a
+ * string's contents), enum, const, anyOf and oneOf. A schema without a type
+ * accepts any JSON value nested up to TINYAI_GRAMMAR_JSON_DEPTH deep.
+ *
+ * @param schema JSON schema text (NULL for any JSON value)
+ * @param tokenizer Tokenizer whose tokens are masked (must outlive the grammar)
+ * @return New grammar, or NULL if the schema is invalid or needs too many states
+ */
+TinyAIGrammar *tinyaiCompileJsonSchema(const char *schema, const TinyAITokenizer *tokenizer);
+
+/**
+ * Convert a JSON schema to the regular expression tinyaiCompileJsonSchema compiles
+ *
+ * @param schema JSON schema text (NULL for any JSON value)
+ * @param pattern Output buffer
+ * @param size Size of the output buffer
+ * @return Length of the pattern, or -1 if the schema is invalid or the buffer too small
+ */
+int tinyaiJsonSchemaToPattern(const char *schema, char *pattern, size_t size);
+
+/**
+ * Free a grammar
+ *
+ * @param grammar Grammar to free
+ */
+void tinyaiDestroyGrammar(TinyAIGrammar *grammar);
+
+/**
+ * Get the state a grammar starts generation in
+ *
+ * @param grammar Grammar to query
+ * @return Initial state
+ */
+uint32_t tinyaiGrammarStartState(const TinyAIGrammar *grammar);
+
+/**
+ * Check whether a grammar allows a token in a state
+ *
+ * @param grammar Grammar to query
+ * @param state Current state
+ * @param token Token ID (TINYAI_TOKEN_EOS where the text so far is a full match)
+ * @return true if the token may be generated next
+ */
+bool tinyaiGrammarAllows(const TinyAIGrammar *grammar, uint32_t state, int token);
+
+/**
+ * Step a grammar's state past a generated token
+ *
+ * @param grammar Grammar to step
+ * @param state Current state
+ * @param token Generated token
+ * @return Next state, or -1 if the grammar does not allow the token
+ */
+int64_t tinyaiGrammarAdvance(const TinyAIGrammar *grammar, uint32_t state, int token);
+
+/**
+ * Check whether the text leading to a state fully matches a grammar
+ *
+ * @param grammar Grammar to query
+ * @param state Current state
+ * @return true if generation may end in the state
+ */
+bool tinyaiGrammarAccepts(const TinyAIGrammar *grammar, uint32_t state);
+
+/**
+ * Exclude the logits of every token a grammar does not allow in a state
+ *
+ * @param grammar Grammar to apply
+ * @param state Current state
+ * @param logits Logits to mask in place
+ * @param vocabSize Number of logits (the grammar's tokenizer's vocabulary size)
+ * @return Number of tokens still allowed (0 on a vocabulary size mismatch)
+ */
+uint32_t tinyaiGrammarMaskLogits(const TinyAIGrammar *grammar, uint32_t state, float *logits,
+                                 uint32_t vocabSize);
+
+/**
+ * Get the number of states of a grammar
+ *
+ * @param grammar Grammar to query
+ * @return Number of states (0 for NULL)
+ */
+uint32_t tinyaiGrammarStateCount(const TinyAIGrammar *grammar);
+
+#endif /* TINYAI_GRAMMAR_H */
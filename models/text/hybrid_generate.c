@@ -9,6 +9,31 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* Weight of the newest measurement in the moving averages */
+#define ROUTE_EWMA_WEIGHT 0.2
+
+/* Hedging defaults */
+#define DEFAULT_HEDGE_LEAD_TOKENS 8
+#define DEFAULT_HEDGE_BUDGET 0.1
+
+/* Local generations running in any hybrid context (they share the CPU) */
+static volatile long g_localInFlight = 0;
+
+/**
+ * @brief Decayed least-squares fit of remote time = round trip + tokens * cost
+ */
+typedef struct {
+    double weight;       /* Decayed number of samples */
+    double sumTokens;    /* Decayed sums over the samples */
+    double sumTimeMs;
+    double sumTokens2;
+    double sumTokensTime;
+} RemoteTimingFit;
+
 /**
  * @brief Context structure for hybrid text generation
  */
@@ -23,43 +48,63 @@ struct TinyAIHybridGenerate {
     int              lastTokenCount;       /* Number of tokens generated in last operation */
     double           lastGenerationTimeMs; /* Total time for last generation (ms) */
     char             lastError[256];       /* Last error message */
+
+    /* Routing measurements */
+    double          latencyTargetMs;      /* Target completion time (0 for none) */
+    double          localTokensPerSecond; /* Moving average of local throughput (0 if unmeasured) */
+    RemoteTimingFit remoteFit;            /* Remote timing samples */
+
+    /* Hedged generation */
+    TinyAIHybridHedgeConfig hedgeConfig; /* Hedging settings */
+    double                  hedgeCredit; /* Hedges available under the budget */
+    TinyAIHybridHedgeStats  hedgeStats;  /* Hedging statistics */
 };
 
+/**
+ * @brief Side producing the output of a hedged request
+ */
+typedef enum { HEDGE_UNDECIDED, HEDGE_LOCAL, HEDGE_REMOTE } HedgeWinner;
+
+/**
+ * @brief State of a hedged request, shared with the local token callback
+ */
+typedef struct {
+    TinyAIMcpAsyncCall *remote;      /* Remote call (NULL once cancelled or if not started) */
+    HedgeWinner         winner;      /* Side producing the output */
+    int                 leadTokens;  /* Local tokens that decide the race */
+    int                *tokens;      /* Output tokens */
+    int                 capacity;    /* Output capacity */
+    int                 count;       /* Local tokens generated */
+    int                 streamed;    /* Tokens passed to the callback */
+    char               *pieces;      /* Text of the held-back local tokens, concatenated */
+    size_t              piecesSize;  /* Bytes used in pieces */
+    size_t              piecesCap;   /* Bytes allocated for pieces */
+    size_t             *pieceEnds;   /* End of each token's text in pieces */
+    TinyAITokenCallback callback;    /* Caller's callback (NULL for none) */
+    void               *userData;    /* Caller's callback data */
+    bool                stopped;     /* Caller's callback asked to stop */
+} HedgeState;
+
 /* Helper function to get current time in milliseconds */
 static double getCurrentTimeMs()
 {
+    /* A monotonic clock keeps the small values that resolve sub-microsecond intervals */
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart * 1000.0 / frequency.QuadPart;
+#else
     struct timespec now;
-    timespec_get(&now, TIME_UTC);
+    clock_gettime(CLOCK_MONOTONIC, &now);
     return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
 }
 
-/* Helper function to decide if remote execution should be used */
-static bool shouldUseRemote(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params)
+/* Decide from the execution preference alone, before both sides are measured */
+static bool preferRemote(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                         TinyAIMcpExecutionPreference pref)
 {
-    /* If no MCP client, always use local */
-    if (!ctx->mcpClient) {
-        return false;
-    }
-
-    /* If force local, use local */
-    if (ctx->forceLocal) {
-        return false;
-    }
-
-    /* If force remote, try to use remote */
-    if (ctx->forceRemote) {
-        return true;
-    }
-
-    /* If MCP is not available, use local */
-    if (!tinyaiMcpIsAvailable(ctx->mcpClient)) {
-        return false;
-    }
-
-    /* Get execution preference */
-    TinyAIMcpExecutionPreference pref = tinyaiMcpGetExecutionPreference(ctx->mcpClient);
-
-    /* Based on preference, decide execution environment */
     switch (pref) {
     case TINYAI_EXEC_ALWAYS_LOCAL:
         return false;
@@ -103,19 +148,149 @@ static bool shouldUseRemote(TinyAIHybridGenerate *ctx, const TinyAIGenerationPar
     }
 }
 
-/* Helper function to execute remote generation via MCP */
-static int executeRemoteGeneration(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
-                                   int *outputTokens, int maxTokens)
+/* Add to the number of local generations running; returns the new count */
+static long addLocalInFlight(long delta)
 {
-    if (!ctx || !params || !outputTokens || maxTokens <= 0) {
-        return -1;
+#ifdef _WIN32
+    return InterlockedExchangeAdd(&g_localInFlight, delta) + delta;
+#else
+    return __atomic_add_fetch(&g_localInFlight, delta, __ATOMIC_RELAXED);
+#endif
+}
+
+/* Fold a local generation into the throughput average */
+static void recordLocalTiming(TinyAIHybridGenerate *ctx, int tokens, double elapsedMs,
+                              long concurrency)
+{
+    if (tokens <= 0 || elapsedMs <= 0) {
+        return;
     }
 
-    double startTime = getCurrentTimeMs();
+    /* Generations running alongside slowed this one down; record the rate of one alone */
+    double rate = tokens * 1000.0 / elapsedMs * (concurrency > 1 ? concurrency : 1);
+    ctx->localTokensPerSecond =
+        ctx->localTokensPerSecond > 0
+            ? (1.0 - ROUTE_EWMA_WEIGHT) * ctx->localTokensPerSecond + ROUTE_EWMA_WEIGHT * rate
+            : rate;
+}
 
-    /* Prepare arguments as JSON */
-    char argsJson[1024];
-    snprintf(argsJson, sizeof(argsJson) - 1,
+/* Fold a remote generation into the timing fit */
+static void recordRemoteTiming(TinyAIHybridGenerate *ctx, int tokens, double elapsedMs)
+{
+    RemoteTimingFit *fit   = &ctx->remoteFit;
+    double           decay = 1.0 - ROUTE_EWMA_WEIGHT;
+
+    fit->weight        = fit->weight * decay + 1.0;
+    fit->sumTokens     = fit->sumTokens * decay + tokens;
+    fit->sumTimeMs     = fit->sumTimeMs * decay + elapsedMs;
+    fit->sumTokens2    = fit->sumTokens2 * decay + (double)tokens * tokens;
+    fit->sumTokensTime = fit->sumTokensTime * decay + tokens * elapsedMs;
+}
+
+/* Split remote time into round trip and per-token cost */
+static void fitRemoteTiming(const RemoteTimingFit *fit, double *roundTripMs, double *msPerToken)
+{
+    double meanTokens = fit->sumTokens / fit->weight;
+    double meanTimeMs = fit->sumTimeMs / fit->weight;
+    double variance   = fit->sumTokens2 / fit->weight - meanTokens * meanTokens;
+    double covariance = fit->sumTokensTime / fit->weight - meanTokens * meanTimeMs;
+
+    /* Separating the two takes requests of different lengths; until then, charge per token */
+    double slope = variance > 1e-6 * (meanTokens * meanTokens + 1.0) ? covariance / variance : -1;
+    if (slope < 0 || slope * meanTokens > meanTimeMs) {
+        slope = meanTokens > 0 ? meanTimeMs / meanTokens : 0;
+    }
+
+    *msPerToken  = slope;
+    *roundTripMs = meanTimeMs - slope * meanTokens;
+}
+
+/* Predict completion times and decide where a request goes */
+static void estimateRoute(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                          TinyAIHybridRouteEstimate *estimate)
+{
+    memset(estimate, 0, sizeof(TinyAIHybridRouteEstimate));
+    int tokens = params->maxTokens > 0 ? params->maxTokens : 1;
+
+    estimate->localQueueDepth = (int)addLocalInFlight(0);
+    if (ctx->localModel && ctx->localTokensPerSecond > 0) {
+        estimate->localMeasured        = true;
+        estimate->localTokensPerSecond = ctx->localTokensPerSecond;
+        estimate->predictedLocalMs =
+            (estimate->localQueueDepth + 1) * tokens * 1000.0 / ctx->localTokensPerSecond;
+    }
+
+    if (ctx->mcpClient && ctx->remoteFit.weight > 0) {
+        double msPerToken;
+        fitRemoteTiming(&ctx->remoteFit, &estimate->remoteRoundTripMs, &msPerToken);
+        estimate->remoteMeasured        = true;
+        estimate->remoteTokensPerSecond = msPerToken > 0 ? 1000.0 / msPerToken : 0;
+        estimate->predictedRemoteMs     = estimate->remoteRoundTripMs + tokens * msPerToken;
+    }
+
+    /* No MCP client, or forced to one side */
+    if (!ctx->mcpClient || ctx->forceLocal) {
+        return;
+    }
+    if (ctx->forceRemote) {
+        estimate->useRemote = true;
+        return;
+    }
+
+    /* If MCP is not available, use local */
+    if (!tinyaiMcpIsAvailable(ctx->mcpClient)) {
+        return;
+    }
+
+    TinyAIMcpExecutionPreference pref = tinyaiMcpGetExecutionPreference(ctx->mcpClient);
+    if (pref == TINYAI_EXEC_ALWAYS_LOCAL) {
+        return;
+    }
+    if (!ctx->localModel) {
+        estimate->useRemote = true;
+        return;
+    }
+
+    double target = ctx->latencyTargetMs;
+    if (estimate->localMeasured && estimate->remoteMeasured) {
+        /* The preferred side keeps requests it can finish in time; otherwise the faster one */
+        if (target > 0) {
+            double preferredMs = pref == TINYAI_EXEC_PREFER_MCP ? estimate->predictedRemoteMs
+                                                                : estimate->predictedLocalMs;
+            if (preferredMs <= target) {
+                estimate->useRemote = pref == TINYAI_EXEC_PREFER_MCP;
+                return;
+            }
+        }
+        estimate->useRemote = estimate->predictedRemoteMs < estimate->predictedLocalMs;
+        return;
+    }
+
+    /* Measure the other side once the measured one misses the target */
+    if (target > 0 && estimate->localMeasured && estimate->predictedLocalMs > target) {
+        estimate->useRemote = true;
+    }
+    else if (target > 0 && estimate->remoteMeasured && estimate->predictedRemoteMs > target) {
+        estimate->useRemote = false;
+    }
+    else {
+        estimate->useRemote = preferRemote(ctx, params, pref);
+    }
+}
+
+/* Helper function to decide if remote execution should be used */
+static bool shouldUseRemote(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params)
+{
+    TinyAIHybridRouteEstimate estimate;
+    estimateRoute(ctx, params, &estimate);
+    return estimate.useRemote;
+}
+
+/* Build the arguments of a generate_text call as JSON */
+static void buildRemoteArguments(const TinyAIGenerationParams *params, char *argsJson,
+                                 size_t argsSize)
+{
+    snprintf(argsJson, argsSize - 1,
              "{"
              "  \"prompt\": [%d",
              params->promptTokens[0]);
@@ -124,7 +299,7 @@ static int executeRemoteGeneration(TinyAIHybridGenerate *ctx, const TinyAIGenera
     for (int i = 1; i < params->promptLength; i++) {
         char tokenStr[16];
         snprintf(tokenStr, sizeof(tokenStr) - 1, ", %d", params->promptTokens[i]);
-        strncat(argsJson, tokenStr, sizeof(argsJson) - strlen(argsJson) - 1);
+        strncat(argsJson, tokenStr, argsSize - strlen(argsJson) - 1);
     }
 
     /* Add generation parameters */
@@ -145,18 +320,14 @@ static int executeRemoteGeneration(TinyAIHybridGenerate *ctx, const TinyAIGenera
                                            : "temperature",
              params->topK, params->topP, params->seed);
 
-    strncat(argsJson, paramStr, sizeof(argsJson) - strlen(argsJson) - 1);
-
-    /* Call MCP tool for text generation */
-    char resultJson[8192];
-    int  resultCode = tinyaiMcpCallTool(ctx->mcpClient, "generate_text", argsJson, resultJson,
-                                        sizeof(resultJson));
+    strncat(argsJson, paramStr, argsSize - strlen(argsJson) - 1);
+}
 
-    if (resultCode < 0) {
-        snprintf(ctx->lastError, sizeof(ctx->lastError) - 1, "MCP remote generation failed: %s",
-                 resultJson);
-        return -1;
-    }
+/* Extract the generated tokens from a generate_text result */
+static int parseRemoteTokens(const TinyAIGenerationParams *params, const char *resultJson,
+                             int *outputTokens, int maxTokens)
+{
+    (void)resultJson;
 
     /* Parse result JSON to extract generated tokens */
     /*
@@ -171,16 +342,65 @@ static int executeRemoteGeneration(TinyAIHybridGenerate *ctx, const TinyAIGenera
 
     /* Simulate tokens for demonstration purposes */
     int generatedTokens = params->maxTokens > 10 ? 10 : params->maxTokens;
+    if (generatedTokens > maxTokens) {
+        generatedTokens = maxTokens;
+    }
     for (int i = 0; i < generatedTokens; i++) {
         outputTokens[i] = i + 100; /* Placeholder token IDs */
     }
+    return generatedTokens;
+}
 
-    double endTime            = getCurrentTimeMs();
-    ctx->lastRemoteTimeMs     = endTime - startTime;
+/* Record a finished remote generation */
+static void finishRemoteGeneration(TinyAIHybridGenerate *ctx, int tokens, double elapsedMs)
+{
+    ctx->lastRemoteTimeMs     = elapsedMs;
     ctx->lastLocalTimeMs      = 0;
-    ctx->lastGenerationTimeMs = ctx->lastRemoteTimeMs;
-    ctx->lastTokenCount       = generatedTokens;
+    ctx->lastGenerationTimeMs = elapsedMs;
+    ctx->lastTokenCount       = tokens;
     ctx->usedRemoteExecution  = true;
+    recordRemoteTiming(ctx, tokens, elapsedMs);
+}
+
+/* Record a finished local generation */
+static void finishLocalGeneration(TinyAIHybridGenerate *ctx, int tokens, double elapsedMs,
+                                  long concurrency)
+{
+    ctx->lastLocalTimeMs      = elapsedMs;
+    ctx->lastRemoteTimeMs     = 0;
+    ctx->lastGenerationTimeMs = elapsedMs;
+    ctx->lastTokenCount       = tokens > 0 ? tokens : 0;
+    ctx->usedRemoteExecution  = false;
+    recordLocalTiming(ctx, tokens, elapsedMs, concurrency);
+}
+
+/* Helper function to execute remote generation via MCP */
+static int executeRemoteGeneration(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                                   int *outputTokens, int maxTokens)
+{
+    if (!ctx || !params || !outputTokens || maxTokens <= 0) {
+        return -1;
+    }
+
+    double startTime = getCurrentTimeMs();
+
+    /* Prepare arguments as JSON */
+    char argsJson[1024];
+    buildRemoteArguments(params, argsJson, sizeof(argsJson));
+
+    /* Call MCP tool for text generation */
+    char resultJson[8192];
+    int  resultCode = tinyaiMcpCallTool(ctx->mcpClient, "generate_text", argsJson, resultJson,
+                                        sizeof(resultJson));
+
+    if (resultCode < 0) {
+        snprintf(ctx->lastError, sizeof(ctx->lastError) - 1, "MCP remote generation failed: %s",
+                 resultJson);
+        return -1;
+    }
+
+    int generatedTokens = parseRemoteTokens(params, resultJson, outputTokens, maxTokens);
+    finishRemoteGeneration(ctx, generatedTokens, getCurrentTimeMs() - startTime);
 
     return generatedTokens;
 }
@@ -193,21 +413,129 @@ static int executeLocalGeneration(TinyAIHybridGenerate *ctx, const TinyAIGenerat
         return -1;
     }
 
-    double startTime = getCurrentTimeMs();
+    double startTime   = getCurrentTimeMs();
+    long   concurrency = addLocalInFlight(1);
 
     /* Call the local model's generation function */
     int result = tinyaiGenerateText(ctx->localModel, params, outputTokens, maxTokens);
 
-    double endTime            = getCurrentTimeMs();
-    ctx->lastLocalTimeMs      = endTime - startTime;
-    ctx->lastRemoteTimeMs     = 0;
-    ctx->lastGenerationTimeMs = ctx->lastLocalTimeMs;
-    ctx->lastTokenCount       = result > 0 ? result : 0;
-    ctx->usedRemoteExecution  = false;
+    addLocalInFlight(-1);
+    finishLocalGeneration(ctx, result, getCurrentTimeMs() - startTime, concurrency);
 
     return result;
 }
 
+/* Pass the local tokens not yet streamed to the caller */
+static void streamLocalTokens(HedgeState *state)
+{
+    while (state->streamed < state->count && !state->stopped) {
+        size_t start = state->streamed > 0 ? state->pieceEnds[state->streamed - 1] : 0;
+        size_t end   = state->pieceEnds[state->streamed];
+        char   saved = state->pieces[end];
+
+        state->pieces[end] = '\0';
+        if (state->callback && !state->callback(state->tokens[state->streamed],
+                                                state->pieces + start, state->userData)) {
+            state->stopped = true;
+        }
+        state->pieces[end] = saved;
+        state->streamed++;
+    }
+}
+
+/* Record a local token and settle the race once one side is clearly ahead */
+static bool hedgeTokenCallback(int token, const char *piece, void *userData)
+{
+    HedgeState *state = (HedgeState *)userData;
+    if (state->winner == HEDGE_REMOTE || state->stopped || state->count >= state->capacity) {
+        return false;
+    }
+
+    /* Keep the token and its text (held back until local wins) */
+    size_t length = piece ? strlen(piece) : 0;
+    if (state->piecesSize + length + 1 > state->piecesCap) {
+        size_t capacity = (state->piecesSize + length + 1) * 2;
+        char  *pieces   = (char *)realloc(state->pieces, capacity);
+        if (!pieces) {
+            return false;
+        }
+        state->pieces    = pieces;
+        state->piecesCap = capacity;
+    }
+    memcpy(state->pieces + state->piecesSize, piece ? piece : "", length);
+    state->piecesSize += length;
+    state->pieces[state->piecesSize]    = '\0';
+    state->tokens[state->count]         = token;
+    state->pieceEnds[state->count]      = state->piecesSize;
+    state->count++;
+
+    if (state->winner == HEDGE_UNDECIDED) {
+        if (tinyaiMcpAsyncCallWait(state->remote, 0)) {
+            /* A complete remote reply beats a partial local one; a failed one loses */
+            if (tinyaiMcpAsyncCallResult(state->remote, NULL) >= 0) {
+                state->winner = HEDGE_REMOTE;
+                return false;
+            }
+            state->winner = HEDGE_LOCAL;
+        }
+        else if (state->count >= state->leadTokens) {
+            state->winner = HEDGE_LOCAL;
+            tinyaiMcpAsyncCallCancel(state->remote);
+        }
+    }
+
+    if (state->winner == HEDGE_LOCAL) {
+        streamLocalTokens(state);
+    }
+    return !state->stopped && state->count < state->capacity;
+}
+
+/* Run on one side, as routing decides, and stream the result */
+static int generateStreamed(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                            int *outputTokens, int maxTokens, TinyAITokenCallback callback,
+                            void *userData)
+{
+    HedgeState state;
+    memset(&state, 0, sizeof(state));
+    state.winner   = HEDGE_LOCAL;
+    state.tokens   = outputTokens;
+    state.capacity = maxTokens;
+    state.callback = callback;
+    state.userData = userData;
+
+    bool useRemote = shouldUseRemote(ctx, params);
+    ctx->forceLocal  = false;
+    ctx->forceRemote = false;
+
+    int result = useRemote ? executeRemoteGeneration(ctx, params, outputTokens, maxTokens) : -1;
+    if (result >= 0) {
+        for (int i = 0; i < result && callback; i++) {
+            if (!callback(outputTokens[i], "", userData)) {
+                break;
+            }
+        }
+        return result;
+    }
+    if (!ctx->localModel) {
+        return -1;
+    }
+
+    state.pieceEnds = (size_t *)malloc((size_t)maxTokens * sizeof(size_t));
+    if (!state.pieceEnds) {
+        return -1;
+    }
+
+    double startTime   = getCurrentTimeMs();
+    long   concurrency = addLocalInFlight(1);
+    tinyaiGenerateTextWithCallback(ctx->localModel, params, hedgeTokenCallback, &state);
+    addLocalInFlight(-1);
+    finishLocalGeneration(ctx, state.count, getCurrentTimeMs() - startTime, concurrency);
+
+    free(state.pieces);
+    free(state.pieceEnds);
+    return state.count;
+}
+
 TinyAIHybridGenerate *tinyaiCreateHybridGenerate(TinyAIModel     *localModel,
                                                  TinyAIMcpClient *mcpClient)
 {
@@ -218,6 +546,7 @@ TinyAIHybridGenerate *tinyaiCreateHybridGenerate(TinyAIModel     *localModel,
     memset(ctx, 0, sizeof(TinyAIHybridGenerate));
     ctx->localModel = localModel;
     ctx->mcpClient  = mcpClient;
+    tinyaiHybridGenerateSetHedgeConfig(ctx, NULL);
 
     return ctx;
 }
@@ -272,7 +601,8 @@ bool tinyaiHybridGenerateUsedRemote(TinyAIHybridGenerate *ctx)
 }
 
 void tinyaiHybridGenerateGetStats(TinyAIHybridGenerate *ctx, double *localTimeMs,
-                                  double *remoteTimeMs, double *tokensPerSecond)
+                                  double *remoteTimeMs, double *tokensPerSecond,
+                                  double *cacheHitRate)
 {
     if (!ctx)
         return;
@@ -291,6 +621,15 @@ void tinyaiHybridGenerateGetStats(TinyAIHybridGenerate *ctx, double *localTimeMs
             *tokensPerSecond = 0;
         }
     }
+
+    if (cacheHitRate) {
+        TinyAIMcpCacheStats cache;
+        int                 lookups = 0;
+        if (ctx->mcpClient && tinyaiMcpGetCacheStats(ctx->mcpClient, &cache)) {
+            lookups = cache.hits + cache.staleHits + cache.misses;
+        }
+        *cacheHitRate = lookups > 0 ? (double)(cache.hits + cache.staleHits) / lookups : 0.0;
+    }
 }
 
 bool tinyaiHybridGenerateForceMode(TinyAIHybridGenerate *ctx, bool forceRemote)
@@ -334,3 +673,131 @@ bool tinyaiHybridGenerateWouldUseRemote(TinyAIHybridGenerate         *ctx,
         return false;
     return shouldUseRemote(ctx, params);
 }
+
+void tinyaiHybridGenerateSetLatencyTarget(TinyAIHybridGenerate *ctx, double targetMs)
+{
+    if (!ctx)
+        return;
+    ctx->latencyTargetMs = targetMs > 0 ? targetMs : 0;
+}
+
+bool tinyaiHybridGenerateEstimate(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                                  TinyAIHybridRouteEstimate *estimate)
+{
+    if (!ctx || !params || !estimate)
+        return false;
+    estimateRoute(ctx, params, estimate);
+    return true;
+}
+
+void tinyaiHybridGenerateSetHedgeConfig(TinyAIHybridGenerate          *ctx,
+                                        const TinyAIHybridHedgeConfig *config)
+{
+    if (!ctx)
+        return;
+
+    ctx->hedgeConfig.leadTokens =
+        config && config->leadTokens > 0 ? config->leadTokens : DEFAULT_HEDGE_LEAD_TOKENS;
+    ctx->hedgeConfig.budget = config && config->budget > 0 ? config->budget : DEFAULT_HEDGE_BUDGET;
+    if (ctx->hedgeConfig.budget > 1.0) {
+        ctx->hedgeConfig.budget = 1.0;
+    }
+
+    /* The first request may always hedge */
+    ctx->hedgeCredit = 1.0;
+}
+
+int tinyaiHybridGenerateHedged(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                               int *outputTokens, int maxTokens, TinyAITokenCallback callback,
+                               void *userData)
+{
+    if (!ctx || !params || !outputTokens || maxTokens <= 0) {
+        return -1;
+    }
+
+    /* Each request earns a share of a hedge; a hedge spends a whole one */
+    ctx->hedgeStats.requests++;
+    ctx->hedgeCredit += ctx->hedgeConfig.budget;
+    if (ctx->hedgeCredit > 1.0 + ctx->hedgeConfig.budget) {
+        ctx->hedgeCredit = 1.0 + ctx->hedgeConfig.budget;
+    }
+
+    bool canHedge = ctx->localModel && ctx->mcpClient && !ctx->forceLocal && !ctx->forceRemote &&
+                    tinyaiMcpIsAvailable(ctx->mcpClient) &&
+                    tinyaiMcpGetExecutionPreference(ctx->mcpClient) != TINYAI_EXEC_ALWAYS_LOCAL &&
+                    ctx->hedgeCredit >= 1.0;
+
+    HedgeState state;
+    memset(&state, 0, sizeof(state));
+    if (canHedge) {
+        char argsJson[1024];
+        buildRemoteArguments(params, argsJson, sizeof(argsJson));
+        state.remote = tinyaiMcpCallToolAsync(ctx->mcpClient, "generate_text", argsJson, NULL);
+        state.pieceEnds = (size_t *)malloc((size_t)maxTokens * sizeof(size_t));
+    }
+    if (!state.remote || !state.pieceEnds) {
+        tinyaiMcpAsyncCallRelease(state.remote);
+        free(state.pieceEnds);
+        return generateStreamed(ctx, params, outputTokens, maxTokens, callback, userData);
+    }
+
+    ctx->hedgeCredit -= 1.0;
+    ctx->hedgeStats.hedged++;
+    state.winner     = HEDGE_UNDECIDED;
+    state.leadTokens = ctx->hedgeConfig.leadTokens;
+    state.tokens     = outputTokens;
+    state.capacity   = maxTokens;
+    state.callback   = callback;
+    state.userData   = userData;
+
+    /* Generate locally while the remote call runs */
+    double startTime   = getCurrentTimeMs();
+    long   concurrency = addLocalInFlight(1);
+    tinyaiGenerateTextWithCallback(ctx->localModel, params, hedgeTokenCallback, &state);
+    addLocalInFlight(-1);
+    double localEndTime = getCurrentTimeMs();
+
+    /* Local finished before either side pulled ahead: a complete output wins */
+    if (state.winner == HEDGE_UNDECIDED) {
+        state.winner = state.count > 0 ? HEDGE_LOCAL : HEDGE_REMOTE;
+    }
+
+    int result = -1;
+    if (state.winner == HEDGE_REMOTE) {
+        const char *resultJson = NULL;
+        if (tinyaiMcpAsyncCallWait(state.remote, -1) &&
+            tinyaiMcpAsyncCallResult(state.remote, &resultJson) >= 0) {
+            result = parseRemoteTokens(params, resultJson, outputTokens, maxTokens);
+            finishRemoteGeneration(ctx, result, getCurrentTimeMs() - startTime);
+            ctx->hedgeStats.remoteWins++;
+            for (int i = 0; i < result && callback; i++) {
+                if (!callback(outputTokens[i], "", userData)) {
+                    break;
+                }
+            }
+        }
+        else {
+            snprintf(ctx->lastError, sizeof(ctx->lastError), "MCP remote generation failed");
+        }
+    }
+    else {
+        streamLocalTokens(&state);
+        finishLocalGeneration(ctx, state.count, localEndTime - startTime, concurrency);
+        ctx->hedgeStats.localWins++;
+        result = state.count;
+    }
+
+    /* Releasing cancels the remote call if it is still running */
+    tinyaiMcpAsyncCallRelease(state.remote);
+    free(state.pieces);
+    free(state.pieceEnds);
+    return result;
+}
+
+bool tinyaiHybridGenerateGetHedgeStats(TinyAIHybridGenerate *ctx, TinyAIHybridHedgeStats *stats)
+{
+    if (!ctx || !stats)
+        return false;
+    *stats = ctx->hedgeStats;
+    return true;
+}
@@ -5,6 +5,11 @@
  * This file defines the interface for text generation that can
  * transparently switch between local and remote execution based
  * on MCP client availability and configuration.
+ *
+ * Once both sides have been measured, each request goes wherever its
+ * predicted completion time is lowest: local time from a moving average
+ * of local throughput scaled by the local generations already running,
+ * remote time from a fitted round trip plus per-token cost.
  */
 
 #ifndef TINYAI_HYBRID_GENERATE_H
@@ -22,6 +27,39 @@ extern "C" {
  */
 typedef struct TinyAIHybridGenerate TinyAIHybridGenerate;
 
+/**
+ * @brief Predicted completion times used to route a request
+ */
+typedef struct {
+    bool   localMeasured;          /**< Local throughput has been measured */
+    bool   remoteMeasured;         /**< Remote timing has been measured */
+    double localTokensPerSecond;   /**< Moving average of local throughput */
+    int    localQueueDepth;        /**< Local generations currently running */
+    double remoteRoundTripMs;      /**< Fixed cost of a remote request in milliseconds */
+    double remoteTokensPerSecond;  /**< Remote throughput after the round trip */
+    double predictedLocalMs;       /**< Predicted local completion time (0 if not measured) */
+    double predictedRemoteMs;      /**< Predicted remote completion time (0 if not measured) */
+    bool   useRemote;              /**< Routing decision for the request */
+} TinyAIHybridRouteEstimate;
+
+/**
+ * @brief Settings for hedged generation
+ */
+typedef struct {
+    int    leadTokens; /**< Local tokens produced before remote is cancelled (0 for 8) */
+    double budget;     /**< Fraction of requests allowed to run on both sides (0 for 0.1) */
+} TinyAIHybridHedgeConfig;
+
+/**
+ * @brief Hedged generation statistics
+ */
+typedef struct {
+    int requests;   /**< Calls to tinyaiHybridGenerateHedged */
+    int hedged;     /**< Requests started on both sides */
+    int localWins;  /**< Hedged requests answered by the local model */
+    int remoteWins; /**< Hedged requests answered by the remote server */
+} TinyAIHybridHedgeStats;
+
 /**
  * @brief Create a hybrid generation context
  *
@@ -54,6 +92,49 @@ void tinyaiDestroyHybridGenerate(TinyAIHybridGenerate *ctx);
 int tinyaiHybridGenerateText(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
                              int *outputTokens, int maxTokens);
 
+/**
+ * @brief Generate text by racing local and remote execution
+ *
+ * For latency-critical requests: starts local generation at once and the
+ * remote MCP call in parallel. Local tokens are held back until one side
+ * is clearly ahead: if the remote reply arrives first, local generation
+ * stops and the remote tokens are streamed; once local has produced
+ * leadTokens tokens first, the remote call is cancelled and local tokens
+ * stream as they are generated. Requests beyond the hedging budget, or
+ * without both sides available, run on the side routing picks and are
+ * streamed the same way.
+ *
+ * @param ctx Hybrid generation context
+ * @param params Generation parameters
+ * @param outputTokens Buffer to store output tokens
+ * @param maxTokens Maximum number of tokens to generate
+ * @param callback Callback receiving each token as it is streamed (can be NULL)
+ * @param userData User data passed to the callback
+ * @return int Number of tokens generated or negative value on error
+ */
+int tinyaiHybridGenerateHedged(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                               int *outputTokens, int maxTokens, TinyAITokenCallback callback,
+                               void *userData);
+
+/**
+ * @brief Configure hedged generation
+ *
+ * @param ctx Hybrid generation context
+ * @param config Hedging settings (NULL for defaults)
+ */
+void tinyaiHybridGenerateSetHedgeConfig(TinyAIHybridGenerate          *ctx,
+                                        const TinyAIHybridHedgeConfig *config);
+
+/**
+ * @brief Get hedged generation statistics
+ *
+ * @param ctx Hybrid generation context
+ * @param stats Output statistics
+ * @return true if statistics were retrieved
+ * @return false on invalid arguments
+ */
+bool tinyaiHybridGenerateGetHedgeStats(TinyAIHybridGenerate *ctx, TinyAIHybridHedgeStats *stats);
+
 /**
  * @brief Check if hybrid generation used remote execution for the last generation
  *
@@ -70,9 +151,12 @@ bool tinyaiHybridGenerateUsedRemote(TinyAIHybridGenerate *ctx);
  * @param localTimeMs Output parameter for local execution time in milliseconds
  * @param remoteTimeMs Output parameter for remote execution time in milliseconds
  * @param tokensPerSecond Output parameter for tokens per second
+ * @param cacheHitRate Output parameter for the fraction of remote calls answered by the MCP
+ *                     client's response cache (0 if it is disabled; can be NULL)
  */
 void tinyaiHybridGenerateGetStats(TinyAIHybridGenerate *ctx, double *localTimeMs,
-                                  double *remoteTimeMs, double *tokensPerSecond);
+                                  double *remoteTimeMs, double *tokensPerSecond,
+                                  double *cacheHitRate);
 
 /**
  * @brief Force a specific execution mode for the next generation
@@ -84,6 +168,34 @@ void tinyaiHybridGenerateGetStats(TinyAIHybridGenerate *ctx, double *localTimeMs
  */
 bool tinyaiHybridGenerateForceMode(TinyAIHybridGenerate *ctx, bool forceRemote);
 
+/**
+ * @brief Set the latency target for subsequent generations
+ *
+ * With a target, a request stays on the side the MCP execution preference
+ * favors (local for TINYAI_EXEC_PREFER_LOCAL and TINYAI_EXEC_CUSTOM_POLICY,
+ * remote for TINYAI_EXEC_PREFER_MCP) while that side is predicted to meet
+ * the target, and otherwise goes to the faster side. Before remote has been
+ * measured, a local prediction that misses the target sends the request
+ * remote to measure it (and likewise for an unmeasured local model). Without
+ * a target, requests always go to the faster side once both are measured.
+ *
+ * @param ctx Hybrid generation context
+ * @param targetMs Target completion time in milliseconds (0 for none)
+ */
+void tinyaiHybridGenerateSetLatencyTarget(TinyAIHybridGenerate *ctx, double targetMs);
+
+/**
+ * @brief Predict where and how fast a request would run
+ *
+ * @param ctx Hybrid generation context
+ * @param params Generation parameters
+ * @param estimate Output estimate
+ * @return true if the estimate was filled in
+ * @return false on invalid arguments
+ */
+bool tinyaiHybridGenerateEstimate(TinyAIHybridGenerate *ctx, const TinyAIGenerationParams *params,
+                                  TinyAIHybridRouteEstimate *estimate);
+
 /**
  * @brief Check if MCP remote generation is available
  *
@@ -98,6 +210,8 @@ bool tinyaiHybridGenerateHasRemote(TinyAIHybridGenerate *ctx);
  *
  * This function can be used to determine whether the generation would
  * use local or remote execution without actually performing the generation.
+ * Until both sides have been measured, the decision follows the MCP
+ * execution preference and the prompt and output lengths.
  *
  * @param ctx Hybrid generation context
  * @param params Generation parameters
@@ -0,0 +1,533 @@
+/**
+ * @file prefix_cache.c
+ * @brief Shared prompt-prefix cache for text generation
+ *
+ * Prompts are stored in a radix tree whose edges carry runs of token ids.
+ * A node where a cached prompt ends holds a snapshot of the KV cache and the
+ * next-token logits. Because attention is causal, the first positions of any
+ * snapshot below a matched point are valid for every prompt sharing them,
+ * so a lookup restores the longest shared prefix even when no prompt of
+ * exactly that length was stored.
+ */
+
+#include "prefix_cache.h"
+#include "../../core/memory.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Radix tree node
+ */
+typedef struct TinyAIPrefixNode {
+    int                     *tokens;     /* Edge label from the parent */
+    uint32_t                 tokenCount; /* Number of tokens on the edge */
+    uint32_t                 depth;      /* Tokens from the root to the end of this node */
+    struct TinyAIPrefixNode *parent;     /* Parent node */
+    struct TinyAIPrefixNode *children;   /* First child */
+    struct TinyAIPrefixNode *next;       /* Next sibling */
+    float                   *state;      /* Keys, values and logits (NULL if no entry) */
+    size_t                   stateBytes; /* Size of state */
+    uint64_t                 lastUsed;   /* Clock value of the last store or lookup */
+} TinyAIPrefixNode;
+
+/**
+ * Prefix cache structure
+ */
+struct TinyAIPrefixCache {
+    TinyAIPrefixNode       root;        /* Empty-prefix root, never holds an entry */
+    size_t                 memoryLimit; /* Maximum bytes of cached state */
+    size_t                 memoryUsed;  /* Bytes of cached state */
+    uint64_t               clock;       /* Recency counter */
+    uint32_t               numLayers;   /* KV cache layers of every entry */
+    uint32_t               hiddenDim;   /* KV cache hidden dimension of every entry */
+    TinyAIKVCachePrecision precision;   /* KV cache storage format of every entry */
+    uint32_t               rowSize;     /* Floats of storage per key or value row */
+    uint32_t               vocabSize;   /* Logits per entry */
+    TinyAIPrefixCacheStats stats;       /* Lookup counters */
+};
+
+/**
+ * Create a node and link it as the first child of parent
+ */
+static TinyAIPrefixNode *createNode(TinyAIPrefixNode *parent, const int *tokens,
+                                    uint32_t tokenCount)
+{
+    TinyAIPrefixNode *node = (TinyAIPrefixNode *)TINYAI_MALLOC(sizeof(TinyAIPrefixNode));
+    if (!node) {
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(TinyAIPrefixNode));
+    node->tokens = (int *)TINYAI_MALLOC(tokenCount * sizeof(int));
+    if (!node->tokens) {
+        TINYAI_FREE(node);
+        return NULL;
+    }
+
+    memcpy(node->tokens, tokens, tokenCount * sizeof(int));
+    node->tokenCount = tokenCount;
+    node->depth      = parent->depth + tokenCount;
+    node->parent     = parent;
+    node->next       = parent->children;
+    parent->children = node;
+
+    return node;
+}
+
+/**
+ * Free a node, its entry and all of its descendants
+ */
+static void freeSubtree(TinyAIPrefixCache *prefixCache, TinyAIPrefixNode *node)
+{
+    TinyAIPrefixNode *child = node->children;
+    while (child) {
+        TinyAIPrefixNode *next = child->next;
+        freeSubtree(prefixCache, child);
+        child = next;
+    }
+
+    if (node->state) {
+        prefixCache->memoryUsed -= node->stateBytes;
+        TINYAI_FREE(node->state);
+    }
+    TINYAI_FREE(node->tokens);
+    TINYAI_FREE(node);
+}
+
+/**
+ * Find the child whose edge starts with token
+ */
+static TinyAIPrefixNode *findChild(const TinyAIPrefixNode *node, int token)
+{
+    for (TinyAIPrefixNode *child = node->children; child; child = child->next) {
+        if (child->tokens[0] == token) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Replace child in its parent's child list (remove it when replacement is NULL)
+ */
+static void replaceChild(TinyAIPrefixNode *child, TinyAIPrefixNode *replacement)
+{
+    TinyAIPrefixNode **link = &child->parent->children;
+    while (*link != child) {
+        link = &(*link)->next;
+    }
+
+    if (replacement) {
+        replacement->next = child->next;
+        *link             = replacement;
+    }
+    else {
+        *link = child->next;
+    }
+}
+
+/**
+ * Number of leading tokens an edge shares with a token run
+ */
+static uint32_t commonLength(const TinyAIPrefixNode *node, const int *tokens, uint32_t count)
+{
+    uint32_t n = node->tokenCount < count ? node->tokenCount : count;
+    uint32_t i = 0;
+    while (i < n && node->tokens[i] == tokens[i]) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Find the node where exactly the given tokens end, if any
+ */
+static TinyAIPrefixNode *findExact(TinyAIPrefixNode *node, const int *tokens, uint32_t count)
+{
+    uint32_t pos = 0;
+
+    while (pos < count) {
+        TinyAIPrefixNode *child = findChild(node, tokens[pos]);
+        if (!child || child->tokenCount > count - pos ||
+            commonLength(child, tokens + pos, count - pos) < child->tokenCount) {
+            return NULL;
+        }
+        node = child;
+        pos += child->tokenCount;
+    }
+
+    return node;
+}
+
+/**
+ * Split a node's edge after length tokens, returning the new upper node
+ */
+static TinyAIPrefixNode *splitNode(TinyAIPrefixNode *node, uint32_t length)
+{
+    TinyAIPrefixNode *upper = (TinyAIPrefixNode *)TINYAI_MALLOC(sizeof(TinyAIPrefixNode));
+    if (!upper) {
+        return NULL;
+    }
+
+    memset(upper, 0, sizeof(TinyAIPrefixNode));
+    upper->tokens = (int *)TINYAI_MALLOC(length * sizeof(int));
+    if (!upper->tokens) {
+        TINYAI_FREE(upper);
+        return NULL;
+    }
+
+    memcpy(upper->tokens, node->tokens, length * sizeof(int));
+    upper->tokenCount = length;
+    upper->depth      = node->depth - (node->tokenCount - length);
+    upper->parent     = node->parent;
+    replaceChild(node, upper);
+
+    /* The original node keeps the rest of its edge below the split */
+    memmove(node->tokens, node->tokens + length, (node->tokenCount - length) * sizeof(int));
+    node->tokenCount -= length;
+    node->parent      = upper;
+    node->next        = NULL;
+    upper->children   = node;
+
+    return upper;
+}
+
+/**
+ * Remove nodes made redundant by a dropped entry
+ *
+ * Entry-less leaves are freed and entry-less nodes with a single child are
+ * merged into it, so every leaf holds an entry.
+ */
+static void pruneNode(TinyAIPrefixCache *prefixCache, TinyAIPrefixNode *node)
+{
+    while (node != &prefixCache->root && !node->state) {
+        TinyAIPrefixNode *parent = node->parent;
+
+        if (!node->children) {
+            replaceChild(node, NULL);
+            freeSubtree(prefixCache, node);
+            node = parent;
+            continue;
+        }
+
+        if (!node->children->next) {
+            /* Fold this edge into the only child's edge */
+            TinyAIPrefixNode *child = node->children;
+            uint32_t          count = node->tokenCount + child->tokenCount;
+            int              *merged = (int *)TINYAI_MALLOC(count * sizeof(int));
+            if (merged) {
+                memcpy(merged, node->tokens, node->tokenCount * sizeof(int));
+                memcpy(merged + node->tokenCount, child->tokens, child->tokenCount * sizeof(int));
+                TINYAI_FREE(child->tokens);
+                child->tokens     = merged;
+                child->tokenCount = count;
+                child->parent     = parent;
+                replaceChild(node, child);
+                node->children = NULL;
+                freeSubtree(prefixCache, node);
+            }
+        }
+        break;
+    }
+}
+
+/**
+ * Find the least (or most) recently used entry in a subtree
+ */
+static TinyAIPrefixNode *findEntry(TinyAIPrefixNode *node, bool mostRecent)
+{
+    TinyAIPrefixNode *best = node->state ? node : NULL;
+
+    for (TinyAIPrefixNode *child = node->children; child; child = child->next) {
+        TinyAIPrefixNode *candidate = findEntry(child, mostRecent);
+        if (candidate && (!best || (mostRecent ? candidate->lastUsed > best->lastUsed
+                                               : candidate->lastUsed < best->lastUsed))) {
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Evict least recently used entries until at most keepBytes remain
+ */
+static void evictEntries(TinyAIPrefixCache *prefixCache, size_t keepBytes)
+{
+    while (prefixCache->memoryUsed > keepBytes) {
+        TinyAIPrefixNode *victim = findEntry(&prefixCache->root, false);
+        if (!victim) {
+            break;
+        }
+
+        prefixCache->memoryUsed -= victim->stateBytes;
+        TINYAI_FREE(victim->state);
+        victim->state      = NULL;
+        victim->stateBytes = 0;
+        pruneNode(prefixCache, victim);
+    }
+}
+
+/**
+ * Create a prefix cache
+ */
+TinyAIPrefixCache *tinyaiCreatePrefixCache(size_t memoryLimit)
+{
+    TinyAIPrefixCache *prefixCache = (TinyAIPrefixCache *)TINYAI_MALLOC(sizeof(TinyAIPrefixCache));
+    if (!prefixCache) {
+        return NULL;
+    }
+
+    memset(prefixCache, 0, sizeof(TinyAIPrefixCache));
+    prefixCache->memoryLimit = memoryLimit;
+
+    return prefixCache;
+}
+
+/**
+ * Free a prefix cache
+ */
+void tinyaiDestroyPrefixCache(TinyAIPrefixCache *prefixCache)
+{
+    if (!prefixCache) {
+        return;
+    }
+
+    tinyaiPrefixCacheClear(prefixCache);
+    TINYAI_FREE(prefixCache);
+}
+
+/**
+ * Remove every entry from a prefix cache
+ */
+void tinyaiPrefixCacheClear(TinyAIPrefixCache *prefixCache)
+{
+    if (!prefixCache) {
+        return;
+    }
+
+    TinyAIPrefixNode *child = prefixCache->root.children;
+    while (child) {
+        TinyAIPrefixNode *next = child->next;
+        freeSubtree(prefixCache, child);
+        child = next;
+    }
+
+    prefixCache->root.children = NULL;
+    prefixCache->memoryUsed    = 0;
+}
+
+/**
+ * Restore the longest cached prefix of a token sequence
+ */
+int tinyaiPrefixCacheLookup(TinyAIPrefixCache *prefixCache, const int *tokens, int numTokens,
+                            TinyAIKVCache *cache, float *logits, uint32_t vocabSize)
+{
+    if (!prefixCache || !tokens || numTokens <= 0) {
+        return 0;
+    }
+    prefixCache->stats.lookups++;
+    prefixCache->stats.tokensLookedUp += (uint64_t)numTokens;
+
+    /* Entries hold no recurrent state or ring layout, so such caches are never served */
+    if (!cache || !logits || cache->state ||
+        cache->windowSize || !prefixCache->root.children ||
+        cache->numLayers != prefixCache->numLayers || cache->hiddenDim != prefixCache->hiddenDim ||
+        cache->precision != prefixCache->precision || vocabSize != prefixCache->vocabSize) {
+        return 0;
+    }
+
+    /* Walk down as far as the tokens match */
+    TinyAIPrefixNode *node    = &prefixCache->root;
+    TinyAIPrefixNode *partial = NULL; /* Node whose edge the match ends inside */
+    uint32_t          matched = 0;
+
+    while (matched < (uint32_t)numTokens) {
+        TinyAIPrefixNode *child = findChild(node, tokens[matched]);
+        if (!child) {
+            break;
+        }
+
+        uint32_t common = commonLength(child, tokens + matched, numTokens - matched);
+        matched += common;
+        if (common < child->tokenCount) {
+            partial = child;
+            break;
+        }
+        node = child;
+    }
+
+    TinyAIPrefixNode *entry;
+    uint32_t          restored;
+
+    if (!partial && matched == (uint32_t)numTokens && node->state) {
+        /* Exact entry, logits included */
+        entry    = node;
+        restored = matched;
+        memcpy(logits, entry->state + 2 * (size_t)prefixCache->numLayers * entry->depth *
+                                          prefixCache->rowSize,
+               vocabSize * sizeof(float));
+    }
+    else {
+        /* Any entry below the match point shares its first matched positions */
+        entry    = findEntry(partial ? partial : node, true);
+        restored = matched < (uint32_t)numTokens ? matched : matched - 1;
+    }
+
+    if (!entry || restored == 0 || restored > cache->maxSeqLength) {
+        return 0;
+    }
+
+    /* Copy each layer's keys and values for the restored positions */
+    size_t       rowSize = cache->rowSize;
+    const float *keys    = entry->state;
+    const float *values  = entry->state + (size_t)prefixCache->numLayers * entry->depth * rowSize;
+
+    for (uint32_t l = 0; l < cache->numLayers; l++) {
+        if (tinyaiKVCacheWriteRows(cache, l, 0, restored, keys + l * entry->depth * rowSize,
+                                   values + l * entry->depth * rowSize) != 0) {
+            /* A paged cache ran out of blocks; treat it as a miss */
+            tinyaiResetKVCache(cache);
+            return 0;
+        }
+    }
+
+    cache->length   = restored;
+    entry->lastUsed = ++prefixCache->clock;
+    prefixCache->stats.hits++;
+    prefixCache->stats.tokensRestored += restored;
+
+    return (int)restored;
+}
+
+/**
+ * Store the state reached after prefilling a token sequence
+ */
+int tinyaiPrefixCacheInsert(TinyAIPrefixCache *prefixCache, const int *tokens, int numTokens,
+                            const TinyAIKVCache *cache, const float *logits, uint32_t vocabSize)
+{
+    if (!prefixCache || !tokens || numTokens <= 0 || !cache || !logits || cache->state ||
+        cache->windowSize || cache->length != (uint32_t)numTokens) {
+        return -1;
+    }
+
+    /* Every entry has the shape of the first one */
+    if (!prefixCache->root.children) {
+        prefixCache->numLayers = cache->numLayers;
+        prefixCache->hiddenDim = cache->hiddenDim;
+        prefixCache->precision = cache->precision;
+        prefixCache->rowSize   = cache->rowSize;
+        prefixCache->vocabSize = vocabSize;
+    }
+    else if (cache->numLayers != prefixCache->numLayers ||
+             cache->hiddenDim != prefixCache->hiddenDim ||
+             cache->precision != prefixCache->precision || vocabSize != prefixCache->vocabSize) {
+        return -1;
+    }
+
+    size_t rowsSize = (size_t)cache->numLayers * numTokens * cache->rowSize;
+    size_t bytes    = (2 * rowsSize + vocabSize) * sizeof(float);
+    if (bytes > prefixCache->memoryLimit) {
+        return -1;
+    }
+
+    TinyAIPrefixNode *existing = findExact(&prefixCache->root, tokens, numTokens);
+    if (existing && existing->state) {
+        /* Already cached; the state for a given prefix never changes */
+        existing->lastUsed = ++prefixCache->clock;
+        return 0;
+    }
+
+    /* Make room before touching the tree, so eviction cannot prune the new node */
+    evictEntries(prefixCache, prefixCache->memoryLimit - bytes);
+
+    float *state = (float *)TINYAI_MALLOC(bytes);
+    if (!state) {
+        return -1;
+    }
+
+    /* Find or create the node where the sequence ends */
+    TinyAIPrefixNode *node = &prefixCache->root;
+    uint32_t          pos  = 0;
+
+    while (pos < (uint32_t)numTokens) {
+        TinyAIPrefixNode *child = findChild(node, tokens[pos]);
+        if (!child) {
+            child = createNode(node, tokens + pos, numTokens - pos);
+            if (!child) {
+                TINYAI_FREE(state);
+                pruneNode(prefixCache, node);
+                return -1;
+            }
+            node = child;
+            break;
+        }
+
+        uint32_t common = commonLength(child, tokens + pos, numTokens - pos);
+        if (common < child->tokenCount) {
+            child = splitNode(child, common);
+            if (!child) {
+                TINYAI_FREE(state);
+                return -1;
+            }
+        }
+
+        node = child;
+        pos += common;
+    }
+
+    /* Snapshot layout: keys and values [numLayers x numTokens x rowSize], then logits */
+    size_t rowSize = cache->rowSize;
+    for (uint32_t l = 0; l < cache->numLayers; l++) {
+        tinyaiKVCacheReadRows(cache, l, 0, numTokens, state + l * numTokens * rowSize,
+                              state + rowsSize + l * numTokens * rowSize);
+    }
+    memcpy(state + 2 * rowsSize, logits, vocabSize * sizeof(float));
+
+    node->state      = state;
+    node->stateBytes = bytes;
+    node->lastUsed   = ++prefixCache->clock;
+    prefixCache->memoryUsed += bytes;
+
+    return 0;
+}
+
+/**
+ * Evict least recently used entries down to a size
+ */
+size_t tinyaiPrefixCacheTrim(TinyAIPrefixCache *prefixCache, size_t targetBytes)
+{
+    if (!prefixCache) {
+        return 0;
+    }
+
+    size_t before = prefixCache->memoryUsed;
+    evictEntries(prefixCache, targetBytes);
+    return before - prefixCache->memoryUsed;
+}
+
+/**
+ * Get the number of bytes currently used by cached entries
+ */
+size_t tinyaiPrefixCacheMemoryUsed(const TinyAIPrefixCache *prefixCache)
+{
+    return prefixCache ? prefixCache->memoryUsed : 0;
+}
+
+/**
+ * Get the lookup statistics of a prefix cache
+ */
+void tinyaiPrefixCacheGetStats(const TinyAIPrefixCache *prefixCache,
+                               TinyAIPrefixCacheStats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!prefixCache) {
+        memset(stats, 0, sizeof(TinyAIPrefixCacheStats));
+        return;
+    }
+
+    *stats            = prefixCache->stats;
+    stats->memoryUsed = prefixCache->memoryUsed;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file prefix_cache.h
+ * @brief Shared prompt-prefix cache for text generation
+ *
+ * Stores the key/value state and next-token logits reached after prefilling
+ * a prompt, indexed by a radix tree over token ids, so later prompts that
+ * share a prefix resume prefill at their first unmatched token.
+ */
+
+#ifndef TINYAI_PREFIX_CACHE_H
+#define TINYAI_PREFIX_CACHE_H
+
+#include "attention.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Prompt-prefix cache (opaque)
+ *
+ * Entries are only valid for the model they were computed with; a cache must
+ * not be shared between models or kept across weight changes.
+ */
+typedef struct TinyAIPrefixCache TinyAIPrefixCache;
+
+/**
+ * Prefix cache statistics
+ */
+typedef struct {
+    uint64_t lookups;        /* Lookups of a token sequence */
+    uint64_t hits;           /* Lookups that restored at least one position */
+    uint64_t tokensLookedUp; /* Tokens of the looked-up sequences */
+    uint64_t tokensRestored; /* Positions restored instead of prefilled */
+    size_t   memoryUsed;     /* Bytes of cached state */
+} TinyAIPrefixCacheStats;
+
+/**
+ * Create a prefix cache
+ *
+ * @param memoryLimit Maximum bytes of cached state; least recently used
+ *                    entries are evicted beyond it
+ * @return New prefix cache or NULL on error
+ */
+TinyAIPrefixCache *tinyaiCreatePrefixCache(size_t memoryLimit);
+
+/**
+ * Free a prefix cache and all of its entries
+ *
+ * @param prefixCache Prefix cache to free
+ */
+void tinyaiDestroyPrefixCache(TinyAIPrefixCache *prefixCache);
+
+/**
+ * Remove every entry from a prefix cache
+ *
+ * @param prefixCache Prefix cache to clear
+ */
+void tinyaiPrefixCacheClear(TinyAIPrefixCache *prefixCache);
+
+/**
+ * Restore the longest cached prefix of a token sequence
+ *
+ * Copies the cached keys and values of the matched positions into the
+ * (reset) KV cache and sets its length. When the whole sequence is cached,
+ * its next-token logits are copied too; otherwise at most numTokens - 1
+ * positions are restored so the caller still feeds the last token.
+ *
+ * @param prefixCache Prefix cache
+ * @param tokens Token sequence
+ * @param numTokens Number of tokens
+ * @param cache KV cache to restore into
+ * @param logits Output logits for the token after the sequence (vocabSize)
+ * @param vocabSize Vocabulary size
+ * @return Number of positions restored (numTokens when logits were written)
+ */
+int tinyaiPrefixCacheLookup(TinyAIPrefixCache *prefixCache, const int *tokens, int numTokens,
+                            TinyAIKVCache *cache, float *logits, uint32_t vocabSize);
+
+/**
+ * Store the state reached after prefilling a token sequence
+ *
+ * @param prefixCache Prefix cache
+ * @param tokens Token sequence
+ * @param numTokens Number of tokens (must equal cache->length)
+ * @param cache KV cache holding exactly the sequence's positions
+ * @param logits Logits for the token after the sequence (vocabSize)
+ * @param vocabSize Vocabulary size
+ * @return 0 on success, -1 on error or if the entry exceeds the memory limit
+ */
+int tinyaiPrefixCacheInsert(TinyAIPrefixCache *prefixCache, const int *tokens, int numTokens,
+                            const TinyAIKVCache *cache, const float *logits, uint32_t vocabSize);
+
+/**
+ * Evict least recently used entries until at most targetBytes remain
+ *
+ * @param prefixCache Prefix cache
+ * @param targetBytes Bytes of cached state to keep at most
+ * @return Bytes released
+ */
+size_t tinyaiPrefixCacheTrim(TinyAIPrefixCache *prefixCache, size_t targetBytes);
+
+/**
+ * Get the number of bytes currently used by cached entries
+ *
+ * @param prefixCache Prefix cache
+ * @return Bytes used
+ */
+size_t tinyaiPrefixCacheMemoryUsed(const TinyAIPrefixCache *prefixCache);
+
+/**
+ * Get the lookup statistics of a prefix cache
+ *
+ * @param prefixCache Prefix cache
+ * @param stats Output statistics (zeroed when prefixCache is NULL)
+ */
+void tinyaiPrefixCacheGetStats(const TinyAIPrefixCache *prefixCache,
+                               TinyAIPrefixCacheStats *stats);
+
+#endif /* TINYAI_PREFIX_CACHE_H */
@@ -8,9 +8,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "tokenizer.h"
+#include "vocab_trainer.h"
+#include "../../core/io.h"
 #include "../../core/memory.h"
 #include "../../utils/quantize.h"
+#include "../../utils/simd_ops.h"
+#include "../../utils/thread_pool.h"
+#include "../../utils/trace.h"
 
 /* ----------------- Internal Definitions ----------------- */
 
@@ -23,14 +38,27 @@ typedef struct TrieNode {
 } TrieNode;
 
 /**
- * BPE merge structure for encoding
+ * BPE merge structure for encoding: a candidate merge of two adjacent symbols
  */
 typedef struct {
-    char *pair;       /* Pair of tokens to merge */
+    int left;         /* Index of the left symbol */
+    int right;        /* Index of the right symbol */
+    int length;       /* Combined span length when queued, to spot stale candidates */
     int tokenId;      /* Resulting token ID */
     uint32_t priority; /* Merge priority (lower = higher priority) */
 } BPEMerge;
 
+/**
+ * Symbol of a word being encoded: a span of the word in a doubly linked list
+ */
+typedef struct {
+    int start;        /* Offset of the span in the word */
+    int length;       /* Span length, 0 once merged into the symbol before it */
+    int id;           /* Token ID of the span */
+    int prev;         /* Previous symbol, or -1 */
+    int next;         /* Next symbol, or -1 */
+} BPESymbol;
+
 /* ----------------- Static Variables ----------------- */
 
 /* Special token strings */
@@ -116,376 +144,1519 @@ static int findTokenInTrie(TrieNode *root, const char *token) {
 }
 
 /**
- * Simple string hash function for lookup
+ * Simple string hash function for lookup, over length bytes
  */
-static uint32_t hashString(const char *str) {
+static uint32_t hashString(const char *str, size_t length) {
     uint32_t hash = 5381;
-    int c;
     
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;  /* hash * 33 + c */
+    for (size_t i = 0; i < length; i++) {
+        hash = ((hash << 5) + hash) + str[i];  /* hash * 33 + c */
     }
     
     return hash;
 }
 
 /**
- * Compare function for BPE merges (used for qsort)
+ * Hash a token of length bytes as it compares case-insensitively
  */
-static int compareBPEMerges(const void *a, const void *b) {
-    const BPEMerge *mergeA = (const BPEMerge *)a;
-    const BPEMerge *mergeB = (const BPEMerge *)b;
+static uint32_t hashFoldedString(const char *str, size_t length) {
+    uint32_t hash = 5381;
     
-    return mergeA->priority - mergeB->priority;
+    for (size_t i = 0; i < length; i++) {
+        hash = ((hash << 5) + hash) + tolower((unsigned char)str[i]);  /* hash * 33 + c */
+    }
+    
+    return hash;
 }
 
-/* ----------------- Tokenizer Implementation ----------------- */
+/**
+ * Whether a vocabulary entry equals the length bytes of a token, optionally ignoring case
+ */
+static int matchesToken(const char *entry, const char *token, size_t length, int folded) {
+#ifdef _WIN32
+    int order = folded ? _strnicmp(entry, token, length) : strncmp(entry, token, length);
+#else
+    int order = folded ? strncasecmp(entry, token, length) : strncmp(entry, token, length);
+#endif
+    return order == 0 && entry[length] == '\0';
+}
 
 /**
- * Create a new tokenizer
+ * Whether memory lies inside the mapped binary vocabulary (and must not be freed or written)
  */
-TinyAITokenizer* tinyaiCreateTokenizer() {
-    TinyAITokenizer *tokenizer = (TinyAITokenizer *)TINYAI_MALLOC(sizeof(TinyAITokenizer));
-    if (!tokenizer) {
-        return NULL;
+static int isMapped(const TinyAITokenizer *tokenizer, const void *ptr) {
+    const char *base = (const char *)tokenizer->mapping;
+    const char *p = (const char *)ptr;
+    
+    return base && p >= base && p < base + tokenizer->mappingSize;
+}
+
+/**
+ * Free heap memory of the tokenizer, leaving mapped memory alone
+ */
+static void freeUnmapped(const TinyAITokenizer *tokenizer, void *ptr) {
+    if (ptr && !isMapped(tokenizer, ptr)) {
+        TINYAI_FREE(ptr);
     }
+}
+
+/**
+ * Get the string of a token ID below tokenCount
+ */
+static const char *tokenText(const TinyAITokenizer *tokenizer, uint32_t id) {
+    if (id < tokenizer->mappedCount) {
+        return tokenizer->arena + tokenizer->offsets[id];
+    }
+    return tokenizer->tokens[id - tokenizer->mappedCount];
+}
+
+/**
+ * Find the index slot holding a token, or the empty slot where it belongs
+ *
+ * The hash is spread over the slots by Fibonacci hashing, since the low
+ * bits of hashString alone cluster for short tokens.
+ */
+static uint32_t findIndexSlot(const TinyAITokenizer *tokenizer, const int32_t *index,
+                              int folded, const char *token, size_t length) {
+    uint32_t hash = folded ? hashFoldedString(token, length) : hashString(token, length);
+    uint32_t mask = (1u << tokenizer->indexBits) - 1;
+    uint32_t slot = (hash * 2654435769u) >> (32 - tokenizer->indexBits);
     
-    /* Initialize the tokenizer */
-    memset(tokenizer->tokens, 0, sizeof(tokenizer->tokens));
-    tokenizer->tokenCount = 0;
-    tokenizer->frequencies = (uint32_t *)TINYAI_MALLOC(TINYAI_MAX_VOCAB_SIZE * sizeof(uint32_t));
-    if (!tokenizer->frequencies) {
-        TINYAI_FREE(tokenizer);
-        return NULL;
+    while (index[slot] >= 0) {
+        const char *candidate = tokenText(tokenizer, (uint32_t)index[slot]);
+        if (matchesToken(candidate, token, length, folded)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
     }
     
-    memset(tokenizer->frequencies, 0, TINYAI_MAX_VOCAB_SIZE * sizeof(uint32_t));
-    tokenizer->caseSensitive = 0;
+    return slot;
+}
+
+/**
+ * Add a vocabulary entry to both hash indexes
+ */
+static void indexToken(TinyAITokenizer *tokenizer, int id) {
+    const char *token = tokenText(tokenizer, (uint32_t)id);
     
-    /* Add special tokens */
-    for (int i = 0; i < 4; i++) {
-        tinyaiAddToken(tokenizer, SPECIAL_TOKENS[i], 0);
-    }
+    size_t length = strlen(token);
+    uint32_t slot = findIndexSlot(tokenizer, tokenizer->tokenIndex, 0, token, length);
+    tokenizer->tokenIndex[slot] = id;
     
-    return tokenizer;
+    /* The first token of a folded key keeps it, as the linear scan used to find it first */
+    slot = findIndexSlot(tokenizer, tokenizer->foldedIndex, 1, token, length);
+    if (tokenizer->foldedIndex[slot] < 0) {
+        tokenizer->foldedIndex[slot] = id;
+    }
 }
 
 /**
- * Destroy a tokenizer
+ * Rebuild both hash indexes over the vocabulary with room for minTokens at
+ * most half full
  */
-void tinyaiDestroyTokenizer(TinyAITokenizer *tokenizer) {
-    if (!tokenizer) {
-        return;
+static int rebuildTokenIndex(TinyAITokenizer *tokenizer, uint32_t minTokens) {
+    uint32_t bits = TINYAI_TOKEN_INDEX_MIN_BITS;
+    while ((1u << bits) < 2 * minTokens) {
+        bits++;
     }
     
-    /* Free token strings */
-    for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
-        if (tokenizer->tokens[i]) {
-            TINYAI_FREE(tokenizer->tokens[i]);
-        }
+    size_t size = ((size_t)1 << bits) * sizeof(int32_t);
+    int32_t *tokenIndex = (int32_t *)TINYAI_MALLOC(size);
+    int32_t *foldedIndex = (int32_t *)TINYAI_MALLOC(size);
+    if (!tokenIndex || !foldedIndex) {
+        TINYAI_FREE(tokenIndex);
+        TINYAI_FREE(foldedIndex);
+        return -1;
     }
     
-    /* Free frequencies */
-    if (tokenizer->frequencies) {
-        TINYAI_FREE(tokenizer->frequencies);
+    /* All bits set reads as -1, an empty slot */
+    memset(tokenIndex, 0xFF, size);
+    memset(foldedIndex, 0xFF, size);
+    
+    freeUnmapped(tokenizer, tokenizer->tokenIndex);
+    freeUnmapped(tokenizer, tokenizer->foldedIndex);
+    tokenizer->tokenIndex = tokenIndex;
+    tokenizer->foldedIndex = foldedIndex;
+    tokenizer->indexBits = bits;
+    
+    for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
+        indexToken(tokenizer, (int)i);
     }
     
-    /* Free the tokenizer */
-    TINYAI_FREE(tokenizer);
+    return 0;
 }
 
 /**
- * Load a vocabulary from a file
+ * Compare function for BPE merges (used for qsort)
  */
-int tinyaiLoadVocabulary(TinyAITokenizer *tokenizer, const char *path) {
-    if (!tokenizer || !path) {
-        return -1;
-    }
+static int compareBPEMerges(const void *a, const void *b) {
+    const BPEMerge *mergeA = (const BPEMerge *)a;
+    const BPEMerge *mergeB = (const BPEMerge *)b;
     
-    FILE *file = fopen(path, "r");
-    if (!file) {
-        return -1;
+    if (mergeA->priority != mergeB->priority) {
+        return mergeA->priority < mergeB->priority ? -1 : 1;
     }
     
-    /* Clear existing vocabulary (except special tokens) */
-    for (uint32_t i = 4; i < tokenizer->tokenCount; i++) {
-        if (tokenizer->tokens[i]) {
-            TINYAI_FREE(tokenizer->tokens[i]);
-            tokenizer->tokens[i] = NULL;
-        }
+    /* Equal priorities merge leftmost first */
+    return mergeA->left - mergeB->left;
+}
+
+/**
+ * Push a candidate merge onto a min-heap ordered by compareBPEMerges
+ */
+static void pushBPEMerge(BPEMerge *heap, int *size, const BPEMerge *merge) {
+    int i = (*size)++;
+    
+    while (i > 0 && compareBPEMerges(merge, &heap[(i - 1) / 2]) < 0) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
-    tokenizer->tokenCount = 4;  /* Keep special tokens */
+    heap[i] = *merge;
+}
+
+/**
+ * Pop the first candidate merge off a min-heap
+ */
+static BPEMerge popBPEMerge(BPEMerge *heap, int *size) {
+    BPEMerge top = heap[0];
+    BPEMerge last = heap[--(*size)];
+    int i = 0;
     
-    /* Parse the vocabulary file */
-    char line[TINYAI_MAX_TOKEN_LENGTH * 2];
-    while (fgets(line, sizeof(line), file)) {
-        /* Remove trailing newline */
-        size_t len = strlen(line);
-        if (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
-            line[--len] = '\0';
-        }
-        if (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
-            line[--len] = '\0';
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= *size) {
+            break;
         }
-        
-        /* Skip empty lines and comments */
-        if (len == 0 || line[0] == '#') {
-            continue;
+        if (child + 1 < *size && compareBPEMerges(&heap[child + 1], &heap[child]) < 0) {
+            child++;
         }
-        
-        /* Parse token and frequency (if provided) */
-        char token[TINYAI_MAX_TOKEN_LENGTH];
-        uint32_t frequency = 0;
-        
-        if (sscanf(line, "%s %u", token, &frequency) >= 1) {
-            tinyaiAddToken(tokenizer, token, frequency);
+        if (compareBPEMerges(&heap[child], &last) >= 0) {
+            break;
         }
+        heap[i] = heap[child];
+        i = child;
     }
+    heap[i] = last;
     
-    fclose(file);
-    return 0;
+    return top;
 }
 
 /**
- * Add a token to the vocabulary
+ * Find the merge index slot of a token pair, or the empty slot where it belongs
  */
-int tinyaiAddToken(TinyAITokenizer *tokenizer, const char *token, uint32_t frequency) {
-    if (!tokenizer || !token || tokenizer->tokenCount >= TINYAI_MAX_VOCAB_SIZE) {
-        return -1;
-    }
+static uint32_t findMergeSlot(const TinyAITokenizer *tokenizer, int32_t left, int32_t right) {
+    uint32_t hash = ((uint32_t)left * 0x9E3779B1u) ^ (uint32_t)right;
+    uint32_t mask = (1u << tokenizer->mergeBits) - 1;
+    uint32_t slot = (hash * 2654435769u) >> (32 - tokenizer->mergeBits);
     
-    /* Check if token already exists */
-    for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
-        if (tokenizer->tokens[i] && strcmp(tokenizer->tokens[i], token) == 0) {
-            /* Update frequency if higher */
-            if (frequency > tokenizer->frequencies[i]) {
-                tokenizer->frequencies[i] = frequency;
-            }
-            return i;
+    while (tokenizer->mergeIndex[slot] >= 0) {
+        const TinyAIBPEMerge *merge = &tokenizer->merges[tokenizer->mergeIndex[slot]];
+        if (merge->left == left && merge->right == right) {
+            return slot;
         }
+        slot = (slot + 1) & mask;
     }
     
-    /* Add new token */
-    int id = tokenizer->tokenCount++;
-    tokenizer->tokens[id] = _strdup(token);
-    if (!tokenizer->tokens[id]) {
-        tokenizer->tokenCount--;
+    return slot;
+}
+
+/**
+ * Double the merge index and the merge array, which holds half as many rules
+ */
+static int growMergeIndex(TinyAITokenizer *tokenizer) {
+    uint32_t bits = tokenizer->mergeBits ? tokenizer->mergeBits + 1 : TINYAI_TOKEN_INDEX_MIN_BITS;
+    size_t slots = (size_t)1 << bits;
+    
+    TinyAIBPEMerge *merges = (TinyAIBPEMerge *)TINYAI_MALLOC(slots / 2 * sizeof(TinyAIBPEMerge));
+    int32_t *mergeIndex = (int32_t *)TINYAI_MALLOC(slots * sizeof(int32_t));
+    if (!merges || !mergeIndex) {
+        TINYAI_FREE(merges);
+        TINYAI_FREE(mergeIndex);
         return -1;
     }
     
-    tokenizer->frequencies[id] = frequency;
+    if (tokenizer->mergeCount > 0) {
+        memcpy(merges, tokenizer->merges, tokenizer->mergeCount * sizeof(TinyAIBPEMerge));
+    }
+    memset(mergeIndex, 0xFF, slots * sizeof(int32_t));
     
-    return id;
+    freeUnmapped(tokenizer, tokenizer->merges);
+    freeUnmapped(tokenizer, tokenizer->mergeIndex);
+    tokenizer->merges = merges;
+    tokenizer->mergeIndex = mergeIndex;
+    tokenizer->mergeBits = bits;
+    
+    for (uint32_t rank = 0; rank < tokenizer->mergeCount; rank++) {
+        const TinyAIBPEMerge *merge = &merges[rank];
+        mergeIndex[findMergeSlot(tokenizer, merge->left, merge->right)] = (int32_t)rank;
+    }
+    
+    return 0;
 }
 
 /**
- * Get a token ID by string
+ * Drop every merge rule
  */
-int tinyaiGetTokenId(const TinyAITokenizer *tokenizer, const char *token) {
-    if (!tokenizer || !token) {
-        return TINYAI_TOKEN_UNKNOWN;
+static void clearMerges(TinyAITokenizer *tokenizer) {
+    freeUnmapped(tokenizer, tokenizer->merges);
+    freeUnmapped(tokenizer, tokenizer->mergeIndex);
+    tokenizer->merges = NULL;
+    tokenizer->mergeIndex = NULL;
+    tokenizer->mergeCount = 0;
+    tokenizer->mergeBits = 0;
+}
+
+/* ----------------- Word Cache ----------------- */
+
+/* Entries per set of the word cache, replaced least recently used first */
+#define WORD_CACHE_WAYS 4
+
+/* Lock stripes of the word cache; set s is guarded by stripe s % WORD_CACHE_STRIPES */
+#define WORD_CACHE_STRIPES 16
+
+/* Most tokens a cached word may encode to */
+#define WORD_CACHE_MAX_TOKENS 8
+
+#ifdef _WIN32
+typedef SRWLOCK WordCacheLock;
+#else
+typedef pthread_mutex_t WordCacheLock;
+#endif
+
+/**
+ * Cached encoding of one word, sized to a 64-byte cache line
+ */
+typedef struct {
+    uint32_t hash;                          /* hashString of the word */
+    uint32_t stamp;                         /* Last use, for replacement (0 = empty) */
+    uint8_t length;                         /* Bytes of the word */
+    uint8_t count;                          /* Tokens the word encodes to */
+    uint8_t caseSensitive;                  /* Case mode the word was encoded in */
+    uint8_t reserved;
+    char word[TINYAI_WORD_CACHE_MAX_WORD];  /* Word bytes, not NUL-terminated */
+    int32_t tokens[WORD_CACHE_MAX_TOKENS];
+} WordCacheEntry;
+
+/**
+ * Lock and counters shared by a stripe of sets
+ */
+typedef struct {
+    WordCacheLock lock;
+    uint32_t clock;                         /* Source of entry stamps */
+    uint64_t hits;
+    uint64_t misses;
+} WordCacheStripe;
+
+/**
+ * Bounded, set-associative cache of word encodings
+ */
+struct TinyAIWordCache {
+    WordCacheEntry *entries;                /* setCount * WORD_CACHE_WAYS entries */
+    uint32_t setCount;                      /* Number of sets, a power of two */
+    int populated;                          /* Whether any entry may be in use */
+    WordCacheStripe stripes[WORD_CACHE_STRIPES];
+};
+
+static void lockWordCache(WordCacheStripe *stripe) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&stripe->lock);
+#else
+    pthread_mutex_lock(&stripe->lock);
+#endif
+}
+
+static void unlockWordCache(WordCacheStripe *stripe) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&stripe->lock);
+#else
+    pthread_mutex_unlock(&stripe->lock);
+#endif
+}
+
+/**
+ * Create a word cache holding at least the given number of entries
+ */
+static TinyAIWordCache *createWordCache(uint32_t entries) {
+    TinyAIWordCache *cache = (TinyAIWordCache *)TINYAI_MALLOC(sizeof(TinyAIWordCache));
+    if (!cache) {
+        return NULL;
     }
+    memset(cache, 0, sizeof(TinyAIWordCache));
     
-    /* Check if token exists */
-    for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
-        if (tokenizer->tokens[i]) {
-            if (tokenizer->caseSensitive) {
-                if (strcmp(tokenizer->tokens[i], token) == 0) {
-                    return i;
-                }
-            } else {
+    cache->setCount = 1;
+    while (cache->setCount * WORD_CACHE_WAYS < entries) {
+        cache->setCount *= 2;
+    }
+    size_t size = (size_t)cache->setCount * WORD_CACHE_WAYS * sizeof(WordCacheEntry);
+    cache->entries = (WordCacheEntry *)TINYAI_MALLOC(size);
+    if (!cache->entries) {
+        TINYAI_FREE(cache);
+        return NULL;
+    }
+    memset(cache->entries, 0, size);
+    
+    for (int i = 0; i < WORD_CACHE_STRIPES; i++) {
 #ifdef _WIN32
-                if (_stricmp(tokenizer->tokens[i], token) == 0) { // Use _stricmp on Windows
+        InitializeSRWLock(&cache->stripes[i].lock);
 #else
-                if (strcasecmp(tokenizer->tokens[i], token) == 0) { // Use strcasecmp elsewhere
+        pthread_mutex_init(&cache->stripes[i].lock, NULL);
 #endif
-                    return i;
-                }
-            }
-        }
     }
     
-    return TINYAI_TOKEN_UNKNOWN;
+    return cache;
 }
 
 /**
- * Get a token string by ID
+ * Free a word cache
  */
-const char* tinyaiGetTokenString(const TinyAITokenizer *tokenizer, int id) {
-    if (!tokenizer || id < 0 || id >= (int)tokenizer->tokenCount) {
-        return NULL;
+static void destroyWordCache(TinyAIWordCache *cache) {
+    if (!cache) {
+        return;
     }
     
-    return tokenizer->tokens[id];
+#ifndef _WIN32
+    for (int i = 0; i < WORD_CACHE_STRIPES; i++) {
+        pthread_mutex_destroy(&cache->stripes[i].lock);
+    }
+#endif
+    TINYAI_FREE(cache->entries);
+    TINYAI_FREE(cache);
 }
 
 /**
- * Tokenize a single word into subwords using BPE
+ * Drop every cached encoding, after the vocabulary or merge rules change
  */
-static int tokenizeWord(const TinyAITokenizer *tokenizer, const char *word, 
-                      int *tokens, int maxTokens, int *numTokens) {
-    if (!tokenizer || !word || !tokens || !numTokens) {
-        return -1;
+static void clearWordCache(TinyAIWordCache *cache) {
+    if (!cache || !cache->populated) {
+        return;
     }
     
-    *numTokens = 0;
-    
-    /* Check if the word is already a token */
-    int id = tinyaiGetTokenId(tokenizer, word);
-    if (id != TINYAI_TOKEN_UNKNOWN) {
-        if (*numTokens < maxTokens) {
-            tokens[(*numTokens)++] = id;
-        }
-        return 0;
+    for (int i = 0; i < WORD_CACHE_STRIPES; i++) {
+        lockWordCache(&cache->stripes[i]);
     }
+    memset(cache->entries, 0,
+           (size_t)cache->setCount * WORD_CACHE_WAYS * sizeof(WordCacheEntry));
+    cache->populated = 0;
+    for (int i = WORD_CACHE_STRIPES - 1; i >= 0; i--) {
+        unlockWordCache(&cache->stripes[i]);
+    }
+}
+
+/**
+ * Look up a word, copying its tokens out on a hit
+ */
+static int lookupWordCache(TinyAIWordCache *cache, const char *word, int length, uint32_t hash,
+                           int caseSensitive, int *tokens, int *count) {
+    uint32_t set = hash & (cache->setCount - 1);
+    WordCacheStripe *stripe = &cache->stripes[set % WORD_CACHE_STRIPES];
+    WordCacheEntry *entries = &cache->entries[(size_t)set * WORD_CACHE_WAYS];
+    int hit = 0;
     
-    /* Split into characters */
-    size_t wordLen = strlen(word);
-    char *chars[TINYAI_MAX_TOKEN_LENGTH];
-    int numChars = 0;
-    
-    for (size_t i = 0; i < wordLen && numChars < TINYAI_MAX_TOKEN_LENGTH - 1; i++) {
-        chars[numChars] = (char*)TINYAI_MALLOC(2);
-        if (!chars[numChars]) {
-            /* Clean up */
-            for (int j = 0; j < numChars; j++) {
-                TINYAI_FREE(chars[j]);
-            }
-            return -1;
+    lockWordCache(stripe);
+    for (int way = 0; way < WORD_CACHE_WAYS; way++) {
+        WordCacheEntry *entry = &entries[way];
+        if (entry->stamp != 0 && entry->hash == hash && entry->length == length &&
+            entry->caseSensitive == caseSensitive && memcmp(entry->word, word, length) == 0) {
+            memcpy(tokens, entry->tokens, entry->count * sizeof(int32_t));
+            *count = entry->count;
+            entry->stamp = ++stripe->clock ? stripe->clock : ++stripe->clock;
+            hit = 1;
+            break;
         }
-        
-        chars[numChars][0] = word[i];
-        chars[numChars][1] = '\0';
-        numChars++;
     }
+    if (hit) {
+        stripe->hits++;
+    } else {
+        stripe->misses++;
+    }
+    unlockWordCache(stripe);
     
-    /* Merge pairs according to BPE rules */
-    /* For simplicity, we use a naive approach here */
-    int changed;
-    do {
-        changed = 0;
-        
-        for (int i = 0; i < numChars - 1; i++) {
-            /* Try to merge the pair */
-            char merged[TINYAI_MAX_TOKEN_LENGTH];
-            snprintf(merged, sizeof(merged), "%s%s", chars[i], chars[i+1]);
-            
-            id = tinyaiGetTokenId(tokenizer, merged);
-            if (id != TINYAI_TOKEN_UNKNOWN) {
-                /* Merge the pair */
-                TINYAI_FREE(chars[i]);
-                TINYAI_FREE(chars[i+1]);
-                
-                chars[i] = _strdup(merged);
-                
-                /* Shift the remaining characters */
-                for (int j = i + 1; j < numChars - 1; j++) {
-                    chars[j] = chars[j+1];
-                }
-                
-                numChars--;
-                changed = 1;
-                break;
-            }
-        }
-    } while (changed && numChars > 1);
+    return hit;
+}
+
+/**
+ * Store a word's tokens in place of the least recently used entry of its set
+ */
+static void insertWordCache(TinyAIWordCache *cache, const char *word, int length, uint32_t hash,
+                            int caseSensitive, const int *tokens, int count) {
+    uint32_t set = hash & (cache->setCount - 1);
+    WordCacheStripe *stripe = &cache->stripes[set % WORD_CACHE_STRIPES];
+    WordCacheEntry *entries = &cache->entries[(size_t)set * WORD_CACHE_WAYS];
     
-    /* Add the resulting tokens */
-    for (int i = 0; i < numChars && *numTokens < maxTokens; i++) {
-        id = tinyaiGetTokenId(tokenizer, chars[i]);
-        if (id == TINYAI_TOKEN_UNKNOWN) {
-            tokens[(*numTokens)++] = TINYAI_TOKEN_UNKNOWN;
-        } else {
-            tokens[(*numTokens)++] = id;
+    lockWordCache(stripe);
+    WordCacheEntry *entry = &entries[0];
+    for (int way = 0; way < WORD_CACHE_WAYS; way++) {
+        /* Another reader may have stored the same word since the lookup missed */
+        if (entries[way].stamp != 0 && entries[way].hash == hash &&
+            entries[way].length == length && entries[way].caseSensitive == caseSensitive &&
+            memcmp(entries[way].word, word, length) == 0) {
+            entry = &entries[way];
+            break;
+        }
+        if (entries[way].stamp < entry->stamp) {
+            entry = &entries[way];
         }
     }
     
-    /* Clean up */
-    for (int i = 0; i < numChars; i++) {
-        TINYAI_FREE(chars[i]);
-    }
-    
-    return 0;
+    entry->hash = hash;
+    entry->stamp = ++stripe->clock ? stripe->clock : ++stripe->clock;
+    entry->length = (uint8_t)length;
+    entry->count = (uint8_t)count;
+    entry->caseSensitive = (uint8_t)caseSensitive;
+    memcpy(entry->word, word, length);
+    memcpy(entry->tokens, tokens, count * sizeof(int32_t));
+    cache->populated = 1;
+    unlockWordCache(stripe);
 }
 
+/* ----------------- Vocabulary Storage ----------------- */
+
 /**
- * Encode a text string into token IDs
+ * Make room for count tokens in writable storage
+ *
+ * Mapped frequencies are copied to the heap on the first write, so a
+ * mapped vocabulary stays shared until it is modified.
  */
-int tinyaiEncodeText(const TinyAITokenizer *tokenizer, const char *text, 
-                   int *tokens, int maxTokens) {
-    if (!tokenizer || !text || !tokens || maxTokens <= 0) {
+static int reserveTokens(TinyAITokenizer *tokenizer, uint32_t count) {
+    if (count <= tokenizer->tokenCapacity && !isMapped(tokenizer, tokenizer->frequencies)) {
         return 0;
     }
     
-    int numTokens = 0;
+    uint32_t capacity = tokenizer->tokenCapacity > 16 ? tokenizer->tokenCapacity : 16;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    if (capacity > TINYAI_MAX_VOCAB_SIZE) {
+        capacity = TINYAI_MAX_VOCAB_SIZE;
+    }
+    if (capacity < count) {
+        return -1;
+    }
     
-    /* Tokenize the text */
-    const char *p = text;
-    char word[TINYAI_MAX_TOKEN_LENGTH];
-    int wordLen = 0;
-    
-    while (*p && numTokens < maxTokens) {
-        if (isalnum((unsigned char)*p) || *p == '\'' || *p == '-') {
-            /* Part of a word */
-            if (wordLen < TINYAI_MAX_TOKEN_LENGTH - 1) {
-                word[wordLen++] = *p;
-            }
-        } else {
-            /* End of a word */
-            if (wordLen > 0) {
-                word[wordLen] = '\0';
-                
-                int subtokens[TINYAI_MAX_TOKEN_LENGTH];
-                int numSubtokens = 0;
-                
-                tokenizeWord(tokenizer, word, subtokens, TINYAI_MAX_TOKEN_LENGTH, &numSubtokens);
-                
-                for (int i = 0; i < numSubtokens && numTokens < maxTokens; i++) {
-                    tokens[numTokens++] = subtokens[i];
-                }
-                
-                wordLen = 0;
-            }
-            
-            /* Handle the separator */
-            if (!isspace((unsigned char)*p)) {
-                /* Treat as a separate token */
-                char separator[2] = {*p, '\0'};
-                int id = tinyaiGetTokenId(tokenizer, separator);
-                
-                if (id != TINYAI_TOKEN_UNKNOWN) {
-                    tokens[numTokens++] = id;
-                } else {
-                    tokens[numTokens++] = TINYAI_TOKEN_UNKNOWN;
-                }
-            }
-        }
-        
-        p++;
+    /* Heap strings hold only the tokens past the mapped ones */
+    uint32_t heapCount = tokenizer->tokenCount - tokenizer->mappedCount;
+    uint32_t heapCapacity = capacity - tokenizer->mappedCount;
+    char **tokens = (char **)TINYAI_MALLOC((heapCapacity > 0 ? heapCapacity : 1) * sizeof(char *));
+    uint32_t *frequencies = (uint32_t *)TINYAI_MALLOC(capacity * sizeof(uint32_t));
+    if (!tokens || !frequencies) {
+        TINYAI_FREE(tokens);
+        TINYAI_FREE(frequencies);
+        return -1;
     }
     
-    /* Handle the last word */
-    if (wordLen > 0 && numTokens < maxTokens) {
-        word[wordLen] = '\0';
-        
-        int subtokens[TINYAI_MAX_TOKEN_LENGTH];
-        int numSubtokens = 0;
-        
-        tokenizeWord(tokenizer, word, subtokens, TINYAI_MAX_TOKEN_LENGTH, &numSubtokens);
-        
-        for (int i = 0; i < numSubtokens && numTokens < maxTokens; i++) {
-            tokens[numTokens++] = subtokens[i];
-        }
+    if (heapCount > 0) {
+        memcpy(tokens, tokenizer->tokens, heapCount * sizeof(char *));
+    }
+    if (tokenizer->tokenCount > 0) {
+        memcpy(frequencies, tokenizer->frequencies, tokenizer->tokenCount * sizeof(uint32_t));
     }
     
-    return numTokens;
+    TINYAI_FREE(tokenizer->tokens);
+    freeUnmapped(tokenizer, tokenizer->frequencies);
+    tokenizer->tokens = tokens;
+    tokenizer->frequencies = frequencies;
+    tokenizer->tokenCapacity = capacity;
+    
+    return 0;
 }
 
 /**
- * Decode token IDs into a text string
+ * Release the vocabulary, its indexes and merge rules, and any mapping
  */
-int tinyaiDecodeTokens(const TinyAITokenizer *tokenizer, const int *tokens, 
-                     int tokenCount, char *text, int maxLength) {
+static void releaseVocabulary(TinyAITokenizer *tokenizer) {
+    /* Free token strings */
+    for (uint32_t i = tokenizer->mappedCount; i < tokenizer->tokenCount; i++) {
+        TINYAI_FREE(tokenizer->tokens[i - tokenizer->mappedCount]);
+    }
+    TINYAI_FREE(tokenizer->tokens);
+    
+    /* Free frequencies, the hash indexes and merge rules */
+    freeUnmapped(tokenizer, tokenizer->frequencies);
+    freeUnmapped(tokenizer, tokenizer->tokenIndex);
+    freeUnmapped(tokenizer, tokenizer->foldedIndex);
+    clearMerges(tokenizer);
+    clearWordCache(tokenizer->wordCache);
+    
+    if (tokenizer->mapping && tokenizer->ownsMapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(tokenizer->mapping);
+#else
+        munmap(tokenizer->mapping, tokenizer->mappingSize);
+#endif
+    }
+    
+    tokenizer->tokens = NULL;
+    tokenizer->tokenCount = 0;
+    tokenizer->tokenCapacity = 0;
+    tokenizer->frequencies = NULL;
+    tokenizer->tokenIndex = NULL;
+    tokenizer->foldedIndex = NULL;
+    tokenizer->indexBits = 0;
+    tokenizer->arena = NULL;
+    tokenizer->offsets = NULL;
+    tokenizer->mappedCount = 0;
+    tokenizer->mapping = NULL;
+    tokenizer->mappingSize = 0;
+    tokenizer->ownsMapping = 0;
+}
+
+/**
+ * Replace the vocabulary with just the special tokens
+ */
+static int resetVocabulary(TinyAITokenizer *tokenizer) {
+    releaseVocabulary(tokenizer);
+    
+    if (reserveTokens(tokenizer, 4) != 0 || rebuildTokenIndex(tokenizer, 4) != 0) {
+        return -1;
+    }
+    
+    /* Add special tokens */
+    for (int i = 0; i < 4; i++) {
+        if (tinyaiAddToken(tokenizer, SPECIAL_TOKENS[i], 0) != i) {
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+/* ----------------- Binary Vocabulary Format ----------------- */
+
+/**
+ * Header of a binary vocabulary file
+ *
+ * The header is followed by the sections below, in order, all in host byte
+ * order and 4-byte aligned:
+ *   offsets      uint32[tokenCount + 1]  Start of each token in the arena, then its size
+ *   frequencies  uint32[tokenCount]
+ *   tokenIndex   int32[1 << indexBits]   Exact-case hash index
+ *   foldedIndex  int32[1 << indexBits]   Lowercase hash index
+ *   merges       TinyAIBPEMerge[mergeCount]
+ *   mergeIndex   int32[1 << mergeBits]   Absent when mergeCount is 0
+ *   arena        char[arenaSize]         NUL-terminated token strings
+ */
+typedef struct {
+    uint32_t magic;       /* TINYAI_VOCAB_MAGIC */
+    uint32_t version;     /* TINYAI_VOCAB_VERSION */
+    uint32_t tokenCount;
+    uint32_t indexBits;
+    uint32_t mergeCount;
+    uint32_t mergeBits;
+    uint32_t arenaSize;
+    uint32_t reserved;    /* 0 */
+} VocabHeader;
+
+/**
+ * Size of a binary vocabulary with the given header, or 0 if it is malformed
+ */
+static size_t binaryVocabularySize(const VocabHeader *header) {
+    if (header->tokenCount < 4 || header->tokenCount > TINYAI_MAX_VOCAB_SIZE ||
+        header->indexBits < TINYAI_TOKEN_INDEX_MIN_BITS || header->indexBits > 24 ||
+        (header->mergeCount > 0 && (header->mergeBits < TINYAI_TOKEN_INDEX_MIN_BITS ||
+                                    header->mergeBits > 24)) ||
+        (size_t)header->tokenCount * 2 > ((size_t)1 << header->indexBits) ||
+        (header->mergeCount > 0 &&
+         (size_t)header->mergeCount * 2 > ((size_t)1 << header->mergeBits))) {
+        return 0;
+    }
+    
+    size_t indexSlots = (size_t)1 << header->indexBits;
+    size_t mergeSlots = header->mergeCount > 0 ? (size_t)1 << header->mergeBits : 0;
+    size_t arenaSize = ((size_t)header->arenaSize + 3) / 4 * 4;
+    
+    return sizeof(VocabHeader) + (2 * (size_t)header->tokenCount + 1) * sizeof(uint32_t) +
+           (2 * indexSlots + mergeSlots) * sizeof(int32_t) +
+           header->mergeCount * sizeof(TinyAIBPEMerge) + arenaSize;
+}
+
+/**
+ * Check that every ID stored in a mapped index is a token
+ */
+static int validIndex(const int32_t *index, size_t slots, uint32_t count) {
+    for (size_t i = 0; i < slots; i++) {
+        if (index[i] < -1 || index[i] >= (int32_t)count) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Point the tokenizer at a mapped binary vocabulary after checking its bounds
+ */
+static int attachBinaryVocabulary(TinyAITokenizer *tokenizer, void *data, size_t size) {
+    const VocabHeader *header = (const VocabHeader *)data;
+    if (size < sizeof(VocabHeader) || header->magic != TINYAI_VOCAB_MAGIC ||
+        header->version != TINYAI_VOCAB_VERSION || binaryVocabularySize(header) != size) {
+        return -1;
+    }
+    
+    uint32_t count = header->tokenCount;
+    size_t indexSlots = (size_t)1 << header->indexBits;
+    size_t mergeSlots = header->mergeCount > 0 ? (size_t)1 << header->mergeBits : 0;
+    
+    const uint32_t *offsets = (const uint32_t *)(header + 1);
+    uint32_t *frequencies = (uint32_t *)(offsets + count + 1);
+    int32_t *tokenIndex = (int32_t *)(frequencies + count);
+    int32_t *foldedIndex = tokenIndex + indexSlots;
+    TinyAIBPEMerge *merges = (TinyAIBPEMerge *)(foldedIndex + indexSlots);
+    int32_t *mergeIndex = (int32_t *)(merges + header->mergeCount);
+    const char *arena = (const char *)(mergeIndex + mergeSlots);
+    
+    /* Every token must end inside the arena, and every stored ID must be in range, so lookups
+       need no further checks */
+    if (offsets[count] != header->arenaSize) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (offsets[i] >= offsets[i + 1] || offsets[i + 1] > header->arenaSize ||
+            arena[offsets[i + 1] - 1] != '\0') {
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        if (strcmp(arena + offsets[i], SPECIAL_TOKENS[i]) != 0) {
+            return -1;
+        }
+    }
+    if (!validIndex(tokenIndex, indexSlots, count) || !validIndex(foldedIndex, indexSlots, count) ||
+        !validIndex(mergeIndex, mergeSlots, header->mergeCount)) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < header->mergeCount; i++) {
+        if ((uint32_t)merges[i].left >= count || (uint32_t)merges[i].right >= count ||
+            (uint32_t)merges[i].result >= count) {
+            return -1;
+        }
+    }
+    
+    releaseVocabulary(tokenizer);
+    tokenizer->mapping = data;
+    tokenizer->mappingSize = size;
+    tokenizer->arena = arena;
+    tokenizer->offsets = offsets;
+    tokenizer->mappedCount = count;
+    tokenizer->tokenCount = count;
+    tokenizer->frequencies = frequencies;
+    tokenizer->tokenIndex = tokenIndex;
+    tokenizer->foldedIndex = foldedIndex;
+    tokenizer->indexBits = header->indexBits;
+    if (header->mergeCount > 0) {
+        tokenizer->merges = merges;
+        tokenizer->mergeIndex = mergeIndex;
+        tokenizer->mergeCount = header->mergeCount;
+        tokenizer->mergeBits = header->mergeBits;
+    }
+    
+    return 0;
+}
+
+/**
+ * Map a binary vocabulary file into the tokenizer
+ */
+static int mapBinaryVocabulary(TinyAITokenizer *tokenizer, const char *path) {
+    void *data = NULL;
+    size_t size = 0;
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        size = (size_t)fileSize.QuadPart;
+        HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(file, &st) == 0 && st.st_size > 0) {
+        size = (size_t)st.st_size;
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+    close(file);
+#endif
+    
+    if (!data) {
+        return -1;
+    }
+    if (attachBinaryVocabulary(tokenizer, data, size) != 0) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(data, size);
+#endif
+        return -1;
+    }
+    tokenizer->ownsMapping = 1;
+    
+    return 0;
+}
+
+/**
+ * Write the vocabulary in the binary format at the current position of a file
+ */
+static int writeBinaryVocabulary(const TinyAITokenizer *tokenizer, FILE *file) {
+    VocabHeader header = {0};
+    header.magic = TINYAI_VOCAB_MAGIC;
+    header.version = TINYAI_VOCAB_VERSION;
+    header.tokenCount = tokenizer->tokenCount;
+    header.indexBits = tokenizer->indexBits;
+    header.mergeCount = tokenizer->mergeCount;
+    header.mergeBits = tokenizer->mergeCount > 0 ? tokenizer->mergeBits : 0;
+    
+    /* Token offsets into the arena */
+    uint32_t *offsets = (uint32_t *)TINYAI_MALLOC((tokenizer->tokenCount + 1) * sizeof(uint32_t));
+    if (!offsets) {
+        return -1;
+    }
+    size_t arenaSize = 0;
+    for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
+        offsets[i] = (uint32_t)arenaSize;
+        arenaSize += strlen(tokenText(tokenizer, i)) + 1;
+    }
+    offsets[tokenizer->tokenCount] = (uint32_t)arenaSize;
+    header.arenaSize = (uint32_t)arenaSize;
+    
+    size_t indexSlots = (size_t)1 << tokenizer->indexBits;
+    size_t mergeSlots = tokenizer->mergeCount > 0 ? (size_t)1 << tokenizer->mergeBits : 0;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(offsets, sizeof(uint32_t), tokenizer->tokenCount + 1, file) ==
+                 tokenizer->tokenCount + 1 &&
+             fwrite(tokenizer->frequencies, sizeof(uint32_t), tokenizer->tokenCount, file) ==
+                 tokenizer->tokenCount &&
+             fwrite(tokenizer->tokenIndex, sizeof(int32_t), indexSlots, file) == indexSlots &&
+             fwrite(tokenizer->foldedIndex, sizeof(int32_t), indexSlots, file) == indexSlots &&
+             (tokenizer->mergeCount == 0 ||
+              fwrite(tokenizer->merges, sizeof(TinyAIBPEMerge), tokenizer->mergeCount, file) ==
+                  tokenizer->mergeCount) &&
+             (tokenizer->mergeCount == 0 ||
+              fwrite(tokenizer->mergeIndex, sizeof(int32_t), mergeSlots, file) == mergeSlots);
+    TINYAI_FREE(offsets);
+    
+    /* The arena, padded to keep the file a multiple of 4 bytes */
+    for (uint32_t i = 0; ok && i < tokenizer->tokenCount; i++) {
+        const char *token = tokenText(tokenizer, i);
+        ok = fwrite(token, 1, strlen(token) + 1, file) == strlen(token) + 1;
+    }
+    static const char padding[3] = {0};
+    if (ok && arenaSize % 4 != 0) {
+        ok = fwrite(padding, 1, 4 - arenaSize % 4, file) == 4 - arenaSize % 4;
+    }
+    
+    return ok ? 0 : -1;
+}
+
+/**
+ * Write the vocabulary in the binary format to a new file
+ */
+static int saveBinaryVocabulary(const TinyAITokenizer *tokenizer, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return -1;
+    }
+    
+    int result = writeBinaryVocabulary(tokenizer, file);
+    if (fclose(file) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+/* ----------------- Tokenizer Implementation ----------------- */
+
+/**
+ * Create a new tokenizer
+ */
+TinyAITokenizer* tinyaiCreateTokenizer() {
+    TinyAITokenizer *tokenizer = (TinyAITokenizer *)TINYAI_MALLOC(sizeof(TinyAITokenizer));
+    if (!tokenizer) {
+        return NULL;
+    }
+    
+    /* Initialize the tokenizer, with storage growing as tokens are added */
+    memset(tokenizer, 0, sizeof(TinyAITokenizer));
+    tokenizer->caseSensitive = 0;
+    
+    /* Add special tokens */
+    if (resetVocabulary(tokenizer) != 0) {
+        tinyaiDestroyTokenizer(tokenizer);
+        return NULL;
+    }
+    
+    return tokenizer;
+}
+
+/**
+ * Destroy a tokenizer
+ */
+void tinyaiDestroyTokenizer(TinyAITokenizer *tokenizer) {
+    if (!tokenizer) {
+        return;
+    }
+    
+    releaseVocabulary(tokenizer);
+    destroyWordCache(tokenizer->wordCache);
+    
+    /* Free the tokenizer */
+    TINYAI_FREE(tokenizer);
+}
+
+/**
+ * Load a vocabulary from a file
+ */
+int tinyaiLoadVocabulary(TinyAITokenizer *tokenizer, const char *path) {
+    if (!tokenizer || !path) {
+        return -1;
+    }
+    
+    TinyAIFile *file = tinyaiOpenFile(path, TINYAI_FILE_READ | TINYAI_FILE_BINARY);
+    if (!file) {
+        return -1;
+    }
+    
+    /* Binary vocabularies are mapped rather than parsed */
+    uint32_t magic = 0;
+    int binary = tinyaiReadFile(file, &magic, sizeof(magic)) == sizeof(magic) &&
+                 magic == TINYAI_VOCAB_MAGIC;
+    if (binary) {
+        tinyaiCloseFile(file);
+        return mapBinaryVocabulary(tokenizer, path);
+    }
+    
+    /* Clear existing vocabulary (except special tokens) */
+    if (tinyaiSeekFile(file, 0, 0) < 0 || resetVocabulary(tokenizer) != 0) {
+        tinyaiCloseFile(file);
+        return -1;
+    }
+    
+    /* Parse the vocabulary file; lines come without their line ending */
+    char line[TINYAI_MAX_TOKEN_LENGTH * 2];
+    int inMerges = 0;
+    int len;
+    while ((len = tinyaiReadLine(file, line, sizeof(line))) >= 0) {
+        /* Merge rules follow the tokens */
+        if (strcmp(line, "#merges") == 0) {
+            inMerges = 1;
+            continue;
+        }
+        
+        /* Skip empty lines and comments */
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+        
+        char token[TINYAI_MAX_TOKEN_LENGTH];
+        if (inMerges) {
+            /* Parse a merge rule */
+            char right[TINYAI_MAX_TOKEN_LENGTH];
+            if (sscanf(line, "%255s %255s", token, right) == 2) {
+                tinyaiAddMerge(tokenizer, token, right);
+            }
+            continue;
+        }
+        
+        /* Parse token and frequency (if provided) */
+        uint32_t frequency = 0;
+        
+        if (sscanf(line, "%s %u", token, &frequency) >= 1) {
+            tinyaiAddToken(tokenizer, token, frequency);
+        }
+    }
+    
+    tinyaiCloseFile(file);
+    return len == TINYAI_IO_EOF ? 0 : -1;
+}
+
+/**
+ * Add a token to the vocabulary
+ */
+int tinyaiAddToken(TinyAITokenizer *tokenizer, const char *token, uint32_t frequency) {
+    if (!tokenizer || !token) {
+        return -1;
+    }
+    
+    /* Check if token already exists */
+    int existing = tokenizer->tokenIndex[findIndexSlot(tokenizer, tokenizer->tokenIndex, 0, token,
+                                                       strlen(token))];
+    if (existing >= 0) {
+        /* Update frequency if higher */
+        if (frequency > tokenizer->frequencies[existing]) {
+            if (reserveTokens(tokenizer, tokenizer->tokenCount) != 0) {
+                return -1;
+            }
+            tokenizer->frequencies[existing] = frequency;
+        }
+        return existing;
+    }
+    
+    /* Grow the storage, and the indexes before they pass half full (or leave the mapping) */
+    if (tokenizer->tokenCount >= TINYAI_MAX_VOCAB_SIZE ||
+        reserveTokens(tokenizer, tokenizer->tokenCount + 1) != 0) {
+        return -1;
+    }
+    if (((tokenizer->tokenCount + 1) * 2 > (1u << tokenizer->indexBits) ||
+         isMapped(tokenizer, tokenizer->tokenIndex)) &&
+        rebuildTokenIndex(tokenizer, (tokenizer->tokenCount + 1) * 2) != 0) {
+        return -1;
+    }
+    
+    /* Add new token */
+    char *copy = _strdup(token);
+    if (!copy) {
+        return -1;
+    }
+    
+    int id = tokenizer->tokenCount++;
+    tokenizer->tokens[id - tokenizer->mappedCount] = copy;
+    tokenizer->frequencies[id] = frequency;
+    indexToken(tokenizer, id);
+    
+    /* Words may now encode differently */
+    clearWordCache(tokenizer->wordCache);
+    
+    return id;
+}
+
+/**
+ * Add a BPE merge rule with the next rank
+ */
+int tinyaiAddMerge(TinyAITokenizer *tokenizer, const char *left, const char *right) {
+    if (!tokenizer || !left || !right) {
+        return -1;
+    }
+    
+    /* Both sides must already be tokens */
+    size_t leftLen = strlen(left);
+    size_t rightLen = strlen(right);
+    int leftId = tokenizer->tokenIndex[findIndexSlot(tokenizer, tokenizer->tokenIndex, 0, left,
+                                                     leftLen)];
+    int rightId = tokenizer->tokenIndex[findIndexSlot(tokenizer, tokenizer->tokenIndex, 0, right,
+                                                      rightLen)];
+    if (leftId < 0 || rightId < 0 || leftLen + rightLen >= TINYAI_MAX_TOKEN_LENGTH) {
+        return -1;
+    }
+    
+    /* A repeated rule keeps its first rank */
+    if (tokenizer->mergeIndex) {
+        int32_t rank = tokenizer->mergeIndex[findMergeSlot(tokenizer, leftId, rightId)];
+        if (rank >= 0) {
+            return rank;
+        }
+    }
+    
+    char merged[TINYAI_MAX_TOKEN_LENGTH];
+    memcpy(merged, left, leftLen);
+    memcpy(merged + leftLen, right, rightLen + 1);
+    int resultId = tinyaiAddToken(tokenizer, merged, 0);
+    if (resultId < 0) {
+        return -1;
+    }
+    
+    /* Grow the index before it passes half full (or leave the mapping) */
+    if (((tokenizer->mergeCount + 1) * 2 > (1u << tokenizer->mergeBits) ||
+         isMapped(tokenizer, tokenizer->mergeIndex)) &&
+        growMergeIndex(tokenizer) != 0) {
+        return -1;
+    }
+    
+    int rank = (int)tokenizer->mergeCount++;
+    tokenizer->merges[rank].left = leftId;
+    tokenizer->merges[rank].right = rightId;
+    tokenizer->merges[rank].result = resultId;
+    tokenizer->mergeIndex[findMergeSlot(tokenizer, leftId, rightId)] = rank;
+    clearWordCache(tokenizer->wordCache);
+    
+    return rank;
+}
+
+/**
+ * Get the ID of the token spelled by length bytes of text
+ */
+static int findTokenId(const TinyAITokenizer *tokenizer, const char *token, size_t length) {
+    /* Case-insensitive lookups go through the lowercase-keyed index */
+    int folded = !tokenizer->caseSensitive;
+    const int32_t *index = folded ? tokenizer->foldedIndex : tokenizer->tokenIndex;
+    int id = index[findIndexSlot(tokenizer, index, folded, token, length)];
+    
+    return id >= 0 ? id : TINYAI_TOKEN_UNKNOWN;
+}
+
+/**
+ * Get a token ID by string
+ */
+int tinyaiGetTokenId(const TinyAITokenizer *tokenizer, const char *token) {
+    if (!tokenizer || !token) {
+        return TINYAI_TOKEN_UNKNOWN;
+    }
+    
+    return findTokenId(tokenizer, token, strlen(token));
+}
+
+/**
+ * Get a token string by ID
+ */
+const char* tinyaiGetTokenString(const TinyAITokenizer *tokenizer, int id) {
+    if (!tokenizer || id < 0 || id >= (int)tokenizer->tokenCount) {
+        return NULL;
+    }
+    
+    return tokenText(tokenizer, (uint32_t)id);
+}
+
+/**
+ * Queue the merge of a symbol with the one after it, if the pair can merge
+ *
+ * With merge rules the pair's rank orders it; without them any pair whose
+ * text is a token merges, earlier tokens first.
+ */
+static void queueBPEMerge(const TinyAITokenizer *tokenizer, const char *word,
+                          const BPESymbol *symbols, int left, BPEMerge *heap, int *heapSize) {
+    const BPESymbol *first = &symbols[left];
+    if (first->next < 0) {
+        return;
+    }
+    const BPESymbol *second = &symbols[first->next];
+    
+    BPEMerge merge;
+    merge.left = left;
+    merge.right = first->next;
+    merge.length = first->length + second->length;
+    
+    if (tokenizer->mergeCount > 0) {
+        if (first->id == TINYAI_TOKEN_UNKNOWN || second->id == TINYAI_TOKEN_UNKNOWN) {
+            return;
+        }
+        int32_t rank = tokenizer->mergeIndex[findMergeSlot(tokenizer, first->id, second->id)];
+        if (rank < 0) {
+            return;
+        }
+        merge.tokenId = tokenizer->merges[rank].result;
+        merge.priority = (uint32_t)rank;
+    } else {
+        merge.tokenId = findTokenId(tokenizer, word + first->start, (size_t)merge.length);
+        if (merge.tokenId == TINYAI_TOKEN_UNKNOWN) {
+            return;
+        }
+        merge.priority = (uint32_t)merge.tokenId;
+    }
+    
+    pushBPEMerge(heap, heapSize, &merge);
+}
+
+/**
+ * Tokenize a single word of length bytes into subwords using BPE
+ */
+static int tokenizeWord(const TinyAITokenizer *tokenizer, const char *word, int length,
+                      int *tokens, int maxTokens, int *numTokens) {
+    if (!tokenizer || !word || !tokens || !numTokens) {
+        return -1;
+    }
+    
+    *numTokens = 0;
+    
+    /* Check if the word is already a token (merge rules alone decide when there are any) */
+    int id = tokenizer->mergeCount == 0 ? findTokenId(tokenizer, word, (size_t)length)
+                                        : TINYAI_TOKEN_UNKNOWN;
+    if (id != TINYAI_TOKEN_UNKNOWN) {
+        if (*numTokens < maxTokens) {
+            tokens[(*numTokens)++] = id;
+        }
+        return 0;
+    }
+    
+    /* One symbol per character, linked in word order */
+    BPESymbol symbols[TINYAI_MAX_TOKEN_LENGTH];
+    int numSymbols = 0;
+    
+    for (int i = 0; i < length && numSymbols < TINYAI_MAX_TOKEN_LENGTH - 1; i++) {
+        BPESymbol *symbol = &symbols[numSymbols];
+        symbol->start = i;
+        symbol->length = 1;
+        symbol->id = findTokenId(tokenizer, word + i, 1);
+        symbol->prev = numSymbols - 1;
+        symbol->next = -1;
+        if (numSymbols > 0) {
+            symbols[numSymbols - 1].next = numSymbols;
+        }
+        numSymbols++;
+    }
+    
+    /* Queue every adjacent pair that can merge; each merge queues at most two more */
+    BPEMerge heap[3 * TINYAI_MAX_TOKEN_LENGTH];
+    int heapSize = 0;
+    
+    for (int i = 0; i + 1 < numSymbols; i++) {
+        queueBPEMerge(tokenizer, word, symbols, i, heap, &heapSize);
+    }
+    
+    /* Merge the lowest-ranked pair until none is left */
+    while (heapSize > 0) {
+        BPEMerge merge = popBPEMerge(heap, &heapSize);
+        BPESymbol *left = &symbols[merge.left];
+        BPESymbol *right = &symbols[merge.right];
+        
+        /* Skip candidates whose symbols were merged since they were queued */
+        if (left->length == 0 || left->next != merge.right ||
+            left->length + right->length != merge.length) {
+            continue;
+        }
+        
+        left->length += right->length;
+        left->id = merge.tokenId;
+        left->next = right->next;
+        if (right->next >= 0) {
+            symbols[right->next].prev = merge.left;
+        }
+        right->length = 0;
+        
+        /* The merged symbol pairs anew with both neighbours */
+        if (left->prev >= 0) {
+            queueBPEMerge(tokenizer, word, symbols, left->prev, heap, &heapSize);
+        }
+        queueBPEMerge(tokenizer, word, symbols, merge.left, heap, &heapSize);
+    }
+    
+    /* Add the resulting tokens */
+    for (int i = numSymbols > 0 ? 0 : -1; i >= 0 && *numTokens < maxTokens; i = symbols[i].next) {
+        tokens[(*numTokens)++] = symbols[i].id;
+    }
+    
+    return 0;
+}
+
+/**
+ * Tokenize a word of length bytes, through the word cache when it is short enough
+ */
+static void encodeWord(const TinyAITokenizer *tokenizer, const char *word, int length,
+                       int *tokens, int *numTokens) {
+    TinyAIWordCache *cache = tokenizer->wordCache;
+    if (!cache || length > TINYAI_WORD_CACHE_MAX_WORD) {
+        tokenizeWord(tokenizer, word, length, tokens, TINYAI_MAX_TOKEN_LENGTH, numTokens);
+        return;
+    }
+    
+    uint32_t hash = hashString(word, (size_t)length);
+    int caseSensitive = tokenizer->caseSensitive != 0;
+    if (lookupWordCache(cache, word, length, hash, caseSensitive, tokens, numTokens)) {
+        return;
+    }
+    
+    tokenizeWord(tokenizer, word, length, tokens, TINYAI_MAX_TOKEN_LENGTH, numTokens);
+    if (*numTokens <= WORD_CACHE_MAX_TOKENS) {
+        insertWordCache(cache, word, length, hash, caseSensitive, tokens, *numTokens);
+    }
+}
+
+/**
+ * Attach a word cache of the given size, replacing any existing one
+ */
+int tinyaiSetWordCacheSize(TinyAITokenizer *tokenizer, uint32_t entries) {
+    if (!tokenizer) {
+        return -1;
+    }
+    
+    destroyWordCache(tokenizer->wordCache);
+    tokenizer->wordCache = NULL;
+    if (entries == 0) {
+        return 0;
+    }
+    
+    tokenizer->wordCache = createWordCache(entries);
+    return tokenizer->wordCache ? 0 : -1;
+}
+
+/**
+ * Get the size and hit counts of the word cache
+ */
+int tinyaiGetWordCacheStats(const TinyAITokenizer *tokenizer, TinyAIWordCacheStats *stats) {
+    if (!tokenizer || !stats) {
+        return -1;
+    }
+    
+    memset(stats, 0, sizeof(TinyAIWordCacheStats));
+    TinyAIWordCache *cache = tokenizer->wordCache;
+    if (!cache) {
+        return 0;
+    }
+    
+    stats->capacity = cache->setCount * WORD_CACHE_WAYS;
+    stats->bytes = sizeof(TinyAIWordCache) + (size_t)stats->capacity * sizeof(WordCacheEntry);
+    for (uint32_t set = 0; set < cache->setCount; set++) {
+        WordCacheStripe *stripe = &cache->stripes[set % WORD_CACHE_STRIPES];
+        lockWordCache(stripe);
+        for (int way = 0; way < WORD_CACHE_WAYS; way++) {
+            if (cache->entries[(size_t)set * WORD_CACHE_WAYS + way].stamp != 0) {
+                stats->entries++;
+            }
+        }
+        unlockWordCache(stripe);
+    }
+    for (int i = 0; i < WORD_CACHE_STRIPES; i++) {
+        lockWordCache(&cache->stripes[i]);
+        stats->hits += cache->stripes[i].hits;
+        stats->misses += cache->stripes[i].misses;
+        unlockWordCache(&cache->stripes[i]);
+    }
+    
+    return 0;
+}
+
+/**
+ * Get the heap memory of a tokenizer
+ */
+size_t tinyaiTokenizerMemoryUsage(const TinyAITokenizer *tokenizer) {
+    if (!tokenizer) {
+        return 0;
+    }
+    
+    size_t bytes = sizeof(TinyAITokenizer);
+    
+    /* Token strings and the arrays that outgrew a mapped vocabulary */
+    if (tokenizer->tokens) {
+        uint32_t heapCapacity = tokenizer->tokenCapacity > tokenizer->mappedCount
+                                    ? tokenizer->tokenCapacity - tokenizer->mappedCount : 1;
+        bytes += (size_t)heapCapacity * sizeof(char *);
+    }
+    for (uint32_t i = tokenizer->mappedCount; i < tokenizer->tokenCount; i++) {
+        bytes += strlen(tokenizer->tokens[i - tokenizer->mappedCount]) + 1;
+    }
+    if (tokenizer->frequencies && !isMapped(tokenizer, tokenizer->frequencies)) {
+        bytes += (size_t)tokenizer->tokenCapacity * sizeof(uint32_t);
+    }
+    
+    /* Hash indexes and merge rules */
+    size_t indexSlots = tokenizer->indexBits ? (size_t)1 << tokenizer->indexBits : 0;
+    if (tokenizer->tokenIndex && !isMapped(tokenizer, tokenizer->tokenIndex)) {
+        bytes += indexSlots * sizeof(int32_t);
+    }
+    if (tokenizer->foldedIndex && !isMapped(tokenizer, tokenizer->foldedIndex)) {
+        bytes += indexSlots * sizeof(int32_t);
+    }
+    if (tokenizer->mergeIndex && !isMapped(tokenizer, tokenizer->mergeIndex)) {
+        size_t mergeSlots = (size_t)1 << tokenizer->mergeBits;
+        bytes += mergeSlots * sizeof(int32_t) + mergeSlots / 2 * sizeof(TinyAIBPEMerge);
+    }
+    
+    TinyAIWordCacheStats stats;
+    if (tinyaiGetWordCacheStats(tokenizer, &stats) == 0) {
+        bytes += stats.bytes;
+    }
+    
+    return bytes;
+}
+
+/**
+ * Encode the first length bytes of a text
+ *
+ * Words are runs of ASCII letters, digits, apostrophes and hyphens, found
+ * a vector of bytes at a time and encoded in place from the text; a word
+ * longer than a token keeps its first TINYAI_MAX_TOKEN_LENGTH - 1 bytes.
+ * Whitespace separates words, and every other byte, including each byte
+ * of a multi-byte UTF-8 character, is a token of its own.
+ */
+static int encodeSpan(const TinyAITokenizer *tokenizer, const char *text, size_t length,
+                      int *tokens, int maxTokens) {
+    int numTokens = 0;
+    const char *p = text;
+    const char *end = text + length;
+    
+    while (p < end && *p && numTokens < maxTokens) {
+        size_t run = tinyaiSimdByteRunLength(p, (size_t)(end - p), TINYAI_SIMD_BYTES_WORD);
+        if (run > 0) {
+            int wordLen = run < TINYAI_MAX_TOKEN_LENGTH - 1 ? (int)run
+                                                             : TINYAI_MAX_TOKEN_LENGTH - 1;
+            int subtokens[TINYAI_MAX_TOKEN_LENGTH];
+            int numSubtokens = 0;
+            
+            encodeWord(tokenizer, p, wordLen, subtokens, &numSubtokens);
+            
+            for (int i = 0; i < numSubtokens && numTokens < maxTokens; i++) {
+                tokens[numTokens++] = subtokens[i];
+            }
+            p += run;
+            continue;
+        }
+        
+        run = tinyaiSimdByteRunLength(p, (size_t)(end - p), TINYAI_SIMD_BYTES_SPACE);
+        if (run > 0) {
+            p += run;
+            continue;
+        }
+        
+        /* Treat the separator as a separate token */
+        tokens[numTokens++] = findTokenId(tokenizer, p, 1);
+        p++;
+    }
+    
+    return numTokens;
+}
+
+/**
+ * Encode a text string into token IDs
+ */
+int tinyaiEncodeText(const TinyAITokenizer *tokenizer, const char *text, 
+                   int *tokens, int maxTokens) {
+    if (!tokenizer || !text || !tokens || maxTokens <= 0) {
+        return 0;
+    }
+    
+    uint64_t span = TINYAI_TRACE_BEGIN();
+    int count = encodeSpan(tokenizer, text, strlen(text), tokens, maxTokens);
+    TINYAI_TRACE_END_ARG(span, "tokenize", count);
+    return count;
+}
+
+/* One unit of batch encoding: a whole document, or a whitespace-bounded chunk of a large one */
+typedef struct {
+    const char *text;
+    size_t length;
+    size_t scratch;     /* First scratch slot; a span encodes to at most one token per byte */
+    int document;       /* Index of the document the span belongs to */
+    int count;          /* Tokens encoded */
+} EncodeSpan;
+
+/* Batch encoding, run as a thread pool task over spans */
+typedef struct {
+    const TinyAITokenizer *tokenizer;
+    EncodeSpan *spans;
+    int *scratch;
+} EncodeBatchTask;
+
+/**
+ * Encode a range of spans into their scratch slots
+ */
+static void encodeBatchSpans(void *context, size_t begin, size_t end) {
+    EncodeBatchTask *task = (EncodeBatchTask *)context;
+    
+    for (size_t i = begin; i < end; i++) {
+        EncodeSpan *span = &task->spans[i];
+        int maxTokens = span->length < INT_MAX ? (int)span->length : INT_MAX;
+        uint64_t trace = TINYAI_TRACE_BEGIN();
+        span->count = encodeSpan(task->tokenizer, span->text, span->length,
+                                 task->scratch + span->scratch, maxTokens);
+        TINYAI_TRACE_END_ARG(trace, "tokenize.chunk", span->count);
+    }
+}
+
+/**
+ * Encode a batch of texts in parallel into one packed token array
+ */
+int tinyaiEncodeTextBatch(const TinyAITokenizer *tokenizer, const char *const *texts, int count,
+                          int *tokens, int maxTokens, int *offsets) {
+    if (!tokenizer || !texts || count < 0 || !tokens || maxTokens < 0 || !offsets) {
+        return -1;
+    }
+    
+    /* Every chunk but the last of a document holds at least TINYAI_ENCODE_CHUNK_SIZE bytes */
+    size_t maxSpans = 0;
+    size_t totalLength = 0;
+    for (int d = 0; d < count; d++) {
+        if (!texts[d]) {
+            return -1;
+        }
+        size_t length = strlen(texts[d]);
+        maxSpans += length / TINYAI_ENCODE_CHUNK_SIZE + 1;
+        totalLength += length;
+    }
+    
+    EncodeSpan *spans = (EncodeSpan *)TINYAI_MALLOC(maxSpans * sizeof(EncodeSpan) + 1);
+    int *scratch = (int *)TINYAI_MALLOC(totalLength * sizeof(int) + 1);
+    if (!spans || !scratch) {
+        TINYAI_FREE(spans);
+        TINYAI_FREE(scratch);
+        return -1;
+    }
+    
+    /* Split large documents at whitespace, which ends a word and encodes to nothing, so the
+       chunks encode exactly as the whole document would */
+    size_t numSpans = 0;
+    size_t position = 0;
+    for (int d = 0; d < count; d++) {
+        const char *text = texts[d];
+        size_t length = strlen(text);
+        size_t start = 0;
+        while (start < length) {
+            size_t end = length;
+            if (length - start > TINYAI_ENCODE_CHUNK_SIZE) {
+                end = start + TINYAI_ENCODE_CHUNK_SIZE;
+                while (end < length && !isspace((unsigned char)text[end])) {
+                    end++;
+                }
+            }
+            
+            EncodeSpan *span = &spans[numSpans++];
+            span->text = text + start;
+            span->length = end - start;
+            span->scratch = position + start;
+            span->document = d;
+            span->count = 0;
+            start = end;
+        }
+        position += length;
+    }
+    
+    EncodeBatchTask task = {tokenizer, spans, scratch};
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    size_t bytesPerSpan = numSpans > 0 ? totalLength / numSpans + 1 : 1;
+    tinyaiParallelFor(pool, numSpans, tinyaiThreadPoolGrain(pool, bytesPerSpan, 1),
+                      encodeBatchSpans, &task);
+    
+    /* Pack the spans in document order */
+    int total = 0;
+    size_t s = 0;
+    for (int d = 0; d < count; d++) {
+        offsets[d] = total;
+        for (; s < numSpans && spans[s].document == d; s++) {
+            if (spans[s].count > maxTokens - total) {
+                total = -1;
+                break;
+            }
+            memcpy(tokens + total, scratch + spans[s].scratch, spans[s].count * sizeof(int));
+            total += spans[s].count;
+        }
+        if (total < 0) {
+            break;
+        }
+    }
+    if (total >= 0) {
+        offsets[count] = total;
+    }
+    
+    TINYAI_FREE(spans);
+    TINYAI_FREE(scratch);
+    return total;
+}
+
+/**
+ * Whether a token is preceded by a space when it follows other text
+ */
+static int needsSeparator(const char *token) {
+    /* Simple heuristic for natural spacing: no space before punctuation, or inside a UTF-8
+       character continued from the previous token */
+    return token[0] != '\0' && token[0] != '\'' && token[0] != '.' && token[0] != ',' &&
+           token[0] != '!' && token[0] != '?' && token[0] != ':' && token[0] != ';' &&
+           ((unsigned char)token[0] & 0xC0) != 0x80;
+}
+
+/**
+ * Decode token IDs into a text string
+ */
+int tinyaiDecodeTokens(const TinyAITokenizer *tokenizer, const int *tokens, 
+                     int tokenCount, char *text, int maxLength) {
     if (!tokenizer || !tokens || !text || maxLength <= 0) {
         return 0;
     }
@@ -508,18 +1679,11 @@ int tinyaiDecodeTokens(const TinyAITokenizer *tokenizer, const int *tokens,
         size_t tokenLen = strlen(token);
         
         /* Check if we need a separator */
-        if (textLen > 0 && tokenLen > 0) {
-            /* Simple heuristic for natural spacing */
-            if (token[0] == '\'' || token[0] == '.' || token[0] == ',' || 
-                token[0] == '!' || token[0] == '?' || token[0] == ':' || 
-                token[0] == ';') {
-                /* No space before punctuation */
-            } else {
-                /* Add a space */
-                if (textLen < maxLength - 1) {
-                    text[textLen++] = ' ';
-                    text[textLen] = '\0';
-                }
+        if (textLen > 0 && needsSeparator(token)) {
+            /* Add a space */
+            if (textLen < maxLength - 1) {
+                text[textLen++] = ' ';
+                text[textLen] = '\0';
             }
         }
         
@@ -535,6 +1699,164 @@ int tinyaiDecodeTokens(const TinyAITokenizer *tokenizer, const int *tokens,
     return textLen;
 }
 
+/**
+ * Decode a single token into the text it appends to a decoded string
+ */
+int tinyaiDecodeTokenPiece(const TinyAITokenizer *tokenizer, int token, int afterText,
+                         char *piece, int maxLength) {
+    if (!tokenizer || !piece || maxLength <= 0) {
+        return 0;
+    }
+
+    piece[0] = '\0';
+
+    /* Special tokens produce no text */
+    if (token <= TINYAI_TOKEN_PAD) {
+        return 0;
+    }
+
+    const char *text = tinyaiGetTokenString(tokenizer, token);
+    if (!text) {
+        /* Unknown token */
+        text = SPECIAL_TOKENS[TINYAI_TOKEN_UNKNOWN];
+    }
+
+    int length = 0;
+    if (afterText && needsSeparator(text) && length < maxLength - 1) {
+        piece[length++] = ' ';
+    }
+
+    int tokenLen = (int)strlen(text);
+    if (length + tokenLen >= maxLength) {
+        tokenLen = maxLength - 1 - length;
+    }
+    memcpy(piece + length, text, tokenLen);
+    length += tokenLen;
+    piece[length] = '\0';
+
+    return length;
+}
+
+/**
+ * Start a streaming detokenizer
+ */
+int tinyaiDetokenizerInit(TinyAIDetokenizer *detokenizer, const TinyAITokenizer *tokenizer,
+                          char *buffer, size_t capacity) {
+    if (!detokenizer || !tokenizer || (!buffer && capacity > 0)) {
+        return -1;
+    }
+    
+    detokenizer->tokenizer = tokenizer;
+    detokenizer->text = buffer;
+    detokenizer->capacity = buffer ? capacity : 0;
+    tinyaiDetokenizerReset(detokenizer);
+    
+    return 0;
+}
+
+/**
+ * Clear the decoded text, keeping the buffer
+ */
+void tinyaiDetokenizerReset(TinyAIDetokenizer *detokenizer) {
+    if (!detokenizer) {
+        return;
+    }
+    
+    detokenizer->length = 0;
+    detokenizer->emitted = 0;
+    if (detokenizer->capacity > 0) {
+        detokenizer->text[0] = '\0';
+    }
+}
+
+/**
+ * Length of text up to its last complete UTF-8 character
+ *
+ * Only a trailing lead byte still missing continuation bytes is held back;
+ * malformed bytes pass through, as there is nothing to wait for.
+ */
+static size_t completeUTF8Length(const char *text, size_t start, size_t length) {
+    /* A character is at most 4 bytes, so its lead byte is among the last 4 */
+    size_t lead = length;
+    while (lead > start && length - lead < 4) {
+        lead--;
+        unsigned char c = (unsigned char)text[lead];
+        if ((c & 0xC0) != 0x80) {
+            size_t needed = (c & 0xE0) == 0xC0 ? 2 :
+                            (c & 0xF0) == 0xE0 ? 3 :
+                            (c & 0xF8) == 0xF0 ? 4 : 1;
+            return length - lead < needed ? lead : length;
+        }
+    }
+    
+    return length;
+}
+
+/**
+ * Append a token's text and return the text that became complete
+ */
+int tinyaiDetokenizerAppend(TinyAIDetokenizer *detokenizer, int token, const char **piece) {
+    if (!detokenizer || !detokenizer->tokenizer) {
+        return -1;
+    }
+    
+    /* Decode the piece the way tinyaiDecodeTokens appends it */
+    char decoded[TINYAI_MAX_TOKEN_LENGTH + 2];
+    int pieceLength = tinyaiDecodeTokenPiece(detokenizer->tokenizer, token,
+                                             detokenizer->length > 0, decoded,
+                                             (int)sizeof(decoded));
+    
+    /* Grow the buffer by doubling, keeping room for the terminator */
+    size_t needed = detokenizer->length + (size_t)pieceLength + 1;
+    if (needed > detokenizer->capacity) {
+        size_t capacity = detokenizer->capacity > 64 ? detokenizer->capacity : 64;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        
+        char *text = (char *)TINYAI_MALLOC(capacity);
+        if (!text) {
+            return -1;
+        }
+        if (detokenizer->length > 0) {
+            memcpy(text, detokenizer->text, detokenizer->length);
+        }
+        TINYAI_FREE(detokenizer->text);
+        detokenizer->text = text;
+        detokenizer->capacity = capacity;
+    }
+    
+    memcpy(detokenizer->text + detokenizer->length, decoded, (size_t)pieceLength);
+    detokenizer->length += (size_t)pieceLength;
+    detokenizer->text[detokenizer->length] = '\0';
+    
+    /* Hand out everything up to the last complete character */
+    size_t start = detokenizer->emitted;
+    detokenizer->emitted = completeUTF8Length(detokenizer->text, start, detokenizer->length);
+    if (piece) {
+        *piece = detokenizer->text + start;
+    }
+    
+    return (int)(detokenizer->emitted - start);
+}
+
+/**
+ * Return the held-back bytes of an unfinished UTF-8 character
+ */
+int tinyaiDetokenizerFlush(TinyAIDetokenizer *detokenizer, const char **piece) {
+    if (!detokenizer) {
+        return -1;
+    }
+    
+    size_t start = detokenizer->emitted;
+    detokenizer->emitted = detokenizer->length;
+    if (piece) {
+        *piece = detokenizer->text ? detokenizer->text + start : "";
+    }
+    
+    return (int)(detokenizer->length - start);
+}
+
 /**
  * Create a minimal BPE tokenizer vocabulary from text corpus
  */
@@ -545,140 +1867,73 @@ int tinyaiCreateMinimalVocabulary(TinyAITokenizer *tokenizer,
     }
     
     /* Reset the tokenizer to just special tokens */
-    for (uint32_t i = 4; i < tokenizer->tokenCount; i++) {
-        if (tokenizer->tokens[i]) {
-            TINYAI_FREE(tokenizer->tokens[i]);
-            tokenizer->tokens[i] = NULL;
-        }
-    }
-    tokenizer->tokenCount = 4;  /* Keep special tokens */
-    
-    /* Step 1: Collect word frequencies */
-    /* For simplicity, we'll use a naive approach */
-    struct {
-        char *word;
-        uint32_t count;
-    } words[10000]; /* Limit to 10000 words for this simplified implementation */
-    int wordCount = 0;
-    
-    const char *p = corpus;
-    char word[TINYAI_MAX_TOKEN_LENGTH];
-    int wordLen = 0;
-    
-    while (*p) {
-        if (isalnum((unsigned char)*p) || *p == '\'' || *p == '-') {
-            /* Part of a word */
-            if (wordLen < TINYAI_MAX_TOKEN_LENGTH - 1) {
-                word[wordLen++] = *p;
-            }
-        } else {
-            /* End of a word */
-            if (wordLen > 0) {
-                word[wordLen] = '\0';
-                
-                /* Check if word already exists */
-                int found = 0;
-                for (int i = 0; i < wordCount; i++) {
-                    if (strcmp(words[i].word, word) == 0) {
-                        words[i].count++;
-                        found = 1;
-                        break;
-                    }
-                }
-                
-                /* Add new word */
-                if (!found && wordCount < 10000) {
-                    words[wordCount].word = _strdup(word);
-                    words[wordCount].count = 1;
-                    wordCount++;
-                }
-                
-                wordLen = 0;
-            }
-            
-            /* Add punctuation as single-character tokens */
-            if (!isspace((unsigned char)*p)) {
-                char separator[2] = {*p, '\0'};
-                
-                /* Check if token already exists */
-                int found = 0;
-                for (int i = 0; i < wordCount; i++) {
-                    if (strcmp(words[i].word, separator) == 0) {
-                        words[i].count++;
-                        found = 1;
-                        break;
-                    }
-                }
-                
-                /* Add new token */
-                if (!found && wordCount < 10000) {
-                    words[wordCount].word = _strdup(separator);
-                    words[wordCount].count = 1;
-                    wordCount++;
-                }
-            }
-        }
-        
-        p++;
+    if (resetVocabulary(tokenizer) != 0) {
+        return -1;
     }
     
-    /* Handle the last word */
-    if (wordLen > 0) {
-        word[wordLen] = '\0';
-        
-        /* Check if word already exists */
-        int found = 0;
-        for (int i = 0; i < wordCount; i++) {
-            if (strcmp(words[i].word, word) == 0) {
-                words[i].count++;
-                found = 1;
-                break;
-            }
-        }
-        
-        /* Add new word */
-        if (!found && wordCount < 10000) {
-            words[wordCount].word = _strdup(word);
-            words[wordCount].count = 1;
-            wordCount++;
-        }
-    }
-    
-    /* Step 2: Add single characters to the vocabulary */
-    for (int i = 32; i < 127; i++) {
-        if (isalnum(i) || ispunct(i)) {
-            char c[2] = {(char)i, '\0'};
-            tinyaiAddToken(tokenizer, c, 0);
-        }
-    }
-    
-    /* Step 3: Add most frequent words to the vocabulary */
-    /* Sort words by frequency */
-    for (int i = 0; i < wordCount - 1; i++) {
-        for (int j = i + 1; j < wordCount; j++) {
-            if (words[j].count > words[i].count) {
-                /* Swap */
-                char *tempWord = words[i].word;
-                uint32_t tempCount = words[i].count;
-                words[i].word = words[j].word;
-                words[i].count = words[j].count;
-                words[j].word = tempWord;
-                words[j].count = tempCount;
-            }
-        }
+    TinyAIVocabTrainer *trainer = tinyaiCreateVocabTrainer();
+    if (!trainer) {
+        return -1;
+    }
+    
+    int result = tinyaiVocabTrainerAddText(trainer, corpus, strlen(corpus));
+    if (result == 0) {
+        result = tinyaiVocabTrainerBuild(trainer, tokenizer, maxVocabSize);
     }
     
-    /* Add words until we reach maxVocabSize */
-    for (int i = 0; i < wordCount && tokenizer->tokenCount < maxVocabSize; i++) {
-        tinyaiAddToken(tokenizer, words[i].word, words[i].count);
+    tinyaiDestroyVocabTrainer(trainer);
+    return result;
+}
+
+/**
+ * Train a BPE vocabulary on a corpus file streamed from disk
+ */
+int tinyaiCreateVocabularyFromFile(TinyAITokenizer *tokenizer, const char *path,
+                                   int maxVocabSize) {
+    if (!tokenizer || !path || maxVocabSize <= 0) {
+        return -1;
     }
     
-    /* Clean up */
-    for (int i = 0; i < wordCount; i++) {
-        free(words[i].word);
+    /* Reset the tokenizer to just special tokens */
+    if (resetVocabulary(tokenizer) != 0) {
+        return -1;
     }
     
-    return 0;
+    TinyAIVocabTrainer *trainer = tinyaiCreateVocabTrainer();
+    if (!trainer) {
+        return -1;
+    }
+    
+    int result = tinyaiVocabTrainerAddFile(trainer, path);
+    if (result == 0) {
+        result = tinyaiVocabTrainerBuild(trainer, tokenizer, maxVocabSize);
+    }
+    
+    tinyaiDestroyVocabTrainer(trainer);
+    return result;
+}
+
+/**
+ * Save a vocabulary to a file
+ */
+int tinyaiWriteBinaryVocabulary(const TinyAITokenizer *tokenizer, FILE *file) {
+    if (!tokenizer || !file) {
+        return -1;
+    }
+    
+    return writeBinaryVocabulary(tokenizer, file);
+}
+
+/**
+ * Use a binary vocabulary held in memory in place
+ */
+int tinyaiAttachVocabulary(TinyAITokenizer *tokenizer, const void *data, size_t size) {
+    if (!tokenizer || !data || (uintptr_t)data % sizeof(uint32_t) != 0) {
+        return -1;
+    }
+    
+    /* Mapped sections are never written, only copied to the heap first */
+    return attachBinaryVocabulary(tokenizer, (void *)data, size);
 }
 
 /**
@@ -689,6 +1944,13 @@ int tinyaiSaveVocabulary(const TinyAITokenizer *tokenizer, const char *path) {
         return -1;
     }
     
+    /* Binary vocabularies are chosen by extension */
+    size_t pathLen = strlen(path);
+    size_t extLen = strlen(TINYAI_VOCAB_BINARY_EXTENSION);
+    if (pathLen >= extLen && strcmp(path + pathLen - extLen, TINYAI_VOCAB_BINARY_EXTENSION) == 0) {
+        return saveBinaryVocabulary(tokenizer, path);
+    }
+    
     FILE *file = fopen(path, "w");
     if (!file) {
         return -1;
@@ -699,8 +1961,16 @@ int tinyaiSaveVocabulary(const TinyAITokenizer *tokenizer, const char *path) {
     fprintf(file, "# Format: token frequency\n\n");
     
     for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
-        if (tokenizer->tokens[i]) {
-            fprintf(file, "%s %u\n", tokenizer->tokens[i], tokenizer->frequencies[i]);
+        fprintf(file, "%s %u\n", tokenText(tokenizer, i), tokenizer->frequencies[i]);
+    }
+    
+    /* Write the merge rules in rank order */
+    if (tokenizer->mergeCount > 0) {
+        fprintf(file, "\n#merges\n");
+        for (uint32_t rank = 0; rank < tokenizer->mergeCount; rank++) {
+            const TinyAIBPEMerge *merge = &tokenizer->merges[rank];
+            fprintf(file, "%s %s\n", tokenText(tokenizer, (uint32_t)merge->left),
+                    tokenText(tokenizer, (uint32_t)merge->right));
         }
     }
     
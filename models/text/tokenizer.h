@@ -7,7 +7,9 @@
 #ifndef TINYAI_TOKENIZER_H
 #define TINYAI_TOKENIZER_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /* ----------------- Constants ----------------- */
 
@@ -17,6 +19,20 @@
 /* Maximum token length */
 #define TINYAI_MAX_TOKEN_LENGTH 256
 
+/* Smallest slot count of the token hash indexes, as a power of two */
+#define TINYAI_TOKEN_INDEX_MIN_BITS 6
+
+/* Documents longer than this many bytes are split for tinyaiEncodeTextBatch */
+#define TINYAI_ENCODE_CHUNK_SIZE 16384
+
+/* Longest word, in bytes, that the word cache holds */
+#define TINYAI_WORD_CACHE_MAX_WORD 20
+
+/* Binary vocabulary files: magic ("TVOC" read as a little-endian word), version and extension */
+#define TINYAI_VOCAB_MAGIC 0x434F5654u
+#define TINYAI_VOCAB_VERSION 1
+#define TINYAI_VOCAB_BINARY_EXTENSION ".tvocab"
+
 /* Special token IDs */
 #define TINYAI_TOKEN_UNKNOWN 0
 #define TINYAI_TOKEN_BOS     1
@@ -25,16 +41,73 @@
 
 /* ----------------- Types ----------------- */
 
+/**
+ * BPE merge rule: adjacent tokens left and right merge into result
+ */
+typedef struct {
+    int32_t left;                           /* Token ID of the left symbol */
+    int32_t right;                          /* Token ID of the right symbol */
+    int32_t result;                         /* Token ID of the merged symbol */
+} TinyAIBPEMerge;
+
+/**
+ * Word cache (opaque)
+ */
+typedef struct TinyAIWordCache TinyAIWordCache;
+
+/**
+ * Word cache statistics
+ */
+typedef struct {
+    uint64_t hits;                          /* Words encoded from the cache */
+    uint64_t misses;                        /* Cacheable words encoded by BPE */
+    uint32_t entries;                       /* Words currently cached */
+    uint32_t capacity;                      /* Most words the cache holds */
+    size_t bytes;                           /* Memory the cache takes */
+} TinyAIWordCacheStats;
+
 /**
  * Tokenizer structure
  */
 typedef struct {
-    char *tokens[TINYAI_MAX_VOCAB_SIZE];    /* Token strings */
+    char **tokens;                          /* Heap strings of the tokens from mappedCount on */
     uint32_t tokenCount;                    /* Number of tokens in vocabulary */
+    uint32_t tokenCapacity;                 /* Tokens that fit before tokens/frequencies grow */
     uint32_t *frequencies;                  /* Token frequencies (for training) */
     int caseSensitive;                      /* Whether tokenization is case-sensitive */
+    int32_t *tokenIndex;                    /* Open-addressing hash of token IDs (-1 = empty) */
+    int32_t *foldedIndex;                   /* Same, keyed by lowercase token, lowest ID first */
+    uint32_t indexBits;                     /* log2 of the slot count of both indexes */
+    TinyAIBPEMerge *merges;                 /* Merge rules, by rank (lowest merges first) */
+    uint32_t mergeCount;                    /* Number of merge rules */
+    int32_t *mergeIndex;                    /* Hash of merge ranks by token pair (-1 = empty) */
+    uint32_t mergeBits;                     /* log2 of the slot count of mergeIndex */
+    const char *arena;                      /* Mapped NUL-terminated token strings */
+    const uint32_t *offsets;                /* Arena offset of each mapped token */
+    uint32_t mappedCount;                   /* Tokens whose strings live in the arena */
+    void *mapping;                          /* Mapped binary vocabulary file (NULL if none) */
+    size_t mappingSize;                     /* Size of the mapping in bytes */
+    int ownsMapping;                        /* Whether the tokenizer unmaps the mapping */
+    TinyAIWordCache *wordCache;             /* Cache of word encodings (NULL = disabled) */
 } TinyAITokenizer;
 
+/**
+ * Streaming detokenizer
+ *
+ * Accumulates decoded text one token at a time, handing out only the bytes
+ * each token completes, so a UTF-8 character split across tokens is emitted
+ * once whole. The text buffer belongs to the caller: it is allocated with
+ * TINYAI_MALLOC, replaced as it grows, and freed with TINYAI_FREE when the
+ * caller is done with it.
+ */
+typedef struct {
+    const TinyAITokenizer *tokenizer;       /* Tokenizer to decode with */
+    char *text;                             /* Decoded text so far, NUL-terminated */
+    size_t length;                          /* Bytes of decoded text */
+    size_t capacity;                        /* Size of the text buffer */
+    size_t emitted;                         /* Bytes already handed out */
+} TinyAIDetokenizer;
+
 /* ----------------- API Functions ----------------- */
 
 /**
@@ -54,6 +127,12 @@ void tinyaiDestroyTokenizer(TinyAITokenizer *tokenizer);
 /**
  * Load a vocabulary from a file
  * 
+ * Each line holds a token and an optional frequency. Lines after a
+ * "#merges" line hold BPE merge rules instead, "left right" in rank order.
+ * A binary vocabulary (see tinyaiSaveVocabulary) is memory-mapped and used
+ * in place, without parsing; it is copied to the heap piece by piece only
+ * as tokens or merges are added.
+ * 
  * @param tokenizer Tokenizer to load into
  * @param path File path
  * @return 0 on success, non-zero on error
@@ -70,6 +149,21 @@ int tinyaiLoadVocabulary(TinyAITokenizer *tokenizer, const char *path);
  */
 int tinyaiAddToken(TinyAITokenizer *tokenizer, const char *token, uint32_t frequency);
 
+/**
+ * Add a BPE merge rule with the next rank
+ * 
+ * Words are encoded by repeatedly merging the adjacent pair with the lowest
+ * rank. Without merge rules, any adjacent pair whose text is a token merges,
+ * lower token IDs first. The merged token is added to the vocabulary if
+ * missing.
+ * 
+ * @param tokenizer Tokenizer to add to
+ * @param left Left token string (must be in the vocabulary)
+ * @param right Right token string (must be in the vocabulary)
+ * @return Rank of the rule or -1 on error
+ */
+int tinyaiAddMerge(TinyAITokenizer *tokenizer, const char *left, const char *right);
+
 /**
  * Get a token ID by string
  * 
@@ -100,6 +194,63 @@ const char* tinyaiGetTokenString(const TinyAITokenizer *tokenizer, int id);
 int tinyaiEncodeText(const TinyAITokenizer *tokenizer, const char *text, 
                    int *tokens, int maxTokens);
 
+/**
+ * Encode a batch of texts into one packed token array
+ * 
+ * Documents are encoded in parallel on the shared thread pool, and documents
+ * longer than TINYAI_ENCODE_CHUNK_SIZE bytes are split at whitespace into
+ * chunks encoded concurrently. Each document encodes to the same tokens as
+ * tinyaiEncodeText would give it. Uses one int of scratch memory per input
+ * byte.
+ * 
+ * @param tokenizer Tokenizer to use
+ * @param texts Input texts
+ * @param count Number of texts
+ * @param tokens Output token array, documents packed in order
+ * @param maxTokens Capacity of tokens
+ * @param offsets Output array of count + 1 entries: document i is tokens[offsets[i]] up to
+ *                tokens[offsets[i + 1]]
+ * @return Total number of tokens, or -1 on error or if they do not fit in maxTokens
+ */
+int tinyaiEncodeTextBatch(const TinyAITokenizer *tokenizer, const char *const *texts, int count,
+                          int *tokens, int maxTokens, int *offsets);
+
+/**
+ * Enable, resize or disable the word cache
+ * 
+ * The cache maps words of up to TINYAI_WORD_CACHE_MAX_WORD bytes to the
+ * tokens BPE encodes them to, evicting the least recently used word of a
+ * small set when full. It is striped across several locks, so threads
+ * encoding with the same tokenizer (as tinyaiEncodeTextBatch does) share it
+ * safely. Adding tokens or merge rules, or loading a vocabulary, empties it.
+ * Resizing drops the cached words and the statistics.
+ * 
+ * @param tokenizer Tokenizer to configure
+ * @param entries Most words to cache, rounded up to a power of two (0 = disable)
+ * @return 0 on success, -1 on error (the cache is then disabled)
+ */
+int tinyaiSetWordCacheSize(TinyAITokenizer *tokenizer, uint32_t entries);
+
+/**
+ * Get word cache statistics
+ * 
+ * @param tokenizer Tokenizer to query
+ * @param stats Output statistics (all zero when the cache is disabled)
+ * @return 0 on success, -1 on error
+ */
+int tinyaiGetWordCacheStats(const TinyAITokenizer *tokenizer, TinyAIWordCacheStats *stats);
+
+/**
+ * Get the heap memory of a tokenizer
+ * 
+ * Covers heap token strings, frequencies, hash indexes, merge rules and the
+ * word cache. A mapped vocabulary is used in place and not counted.
+ * 
+ * @param tokenizer Tokenizer to query
+ * @return Bytes held on the heap
+ */
+size_t tinyaiTokenizerMemoryUsage(const TinyAITokenizer *tokenizer);
+
 /**
  * Decode token IDs into a text string
  * 
@@ -113,9 +264,73 @@ int tinyaiEncodeText(const TinyAITokenizer *tokenizer, const char *text,
 int tinyaiDecodeTokens(const TinyAITokenizer *tokenizer, const int *tokens, 
                      int tokenCount, char *text, int maxLength);
 
+/**
+ * Decode a single token the way tinyaiDecodeTokens renders it
+ * 
+ * Produces the text the token appends to a decoded string, including the
+ * separating space when it follows earlier text, so streamed pieces
+ * concatenate to the same text as decoding all tokens at once.
+ * 
+ * @param tokenizer Tokenizer to use
+ * @param token Token ID
+ * @param afterText Non-zero if text has already been decoded before this token
+ * @param piece Output text buffer
+ * @param maxLength Maximum output length
+ * @return Length of the piece (0 for special tokens)
+ */
+int tinyaiDecodeTokenPiece(const TinyAITokenizer *tokenizer, int token, int afterText,
+                         char *piece, int maxLength);
+
+/**
+ * Start a streaming detokenizer
+ * 
+ * @param detokenizer Detokenizer to initialize
+ * @param tokenizer Tokenizer to decode with
+ * @param buffer Initial text buffer from TINYAI_MALLOC, or NULL to allocate on first use
+ * @param capacity Size of buffer
+ * @return 0 on success, -1 on error
+ */
+int tinyaiDetokenizerInit(TinyAIDetokenizer *detokenizer, const TinyAITokenizer *tokenizer,
+                          char *buffer, size_t capacity);
+
+/**
+ * Clear the decoded text, keeping its buffer for reuse
+ * 
+ * @param detokenizer Detokenizer to reset
+ */
+void tinyaiDetokenizerReset(TinyAIDetokenizer *detokenizer);
+
+/**
+ * Append one token to the decoded text
+ * 
+ * Costs time proportional to the token's text, whatever has come before, and
+ * gives the same text as tinyaiDecodeTokens over all appended tokens. The
+ * bytes handed out are those now known to end on a whole UTF-8 character.
+ * 
+ * @param detokenizer Detokenizer to append to
+ * @param token Token ID
+ * @param piece Set to the new complete text, valid until the next append (may be NULL)
+ * @return Length of the new complete text, or -1 on error
+ */
+int tinyaiDetokenizerAppend(TinyAIDetokenizer *detokenizer, int token, const char **piece);
+
+/**
+ * Hand out any bytes held back as an unfinished UTF-8 character
+ * 
+ * Called once the stream ends, so a truncated character is not lost.
+ * 
+ * @param detokenizer Detokenizer to flush
+ * @param piece Set to the held-back bytes (may be NULL)
+ * @return Number of held-back bytes, or -1 on error
+ */
+int tinyaiDetokenizerFlush(TinyAIDetokenizer *detokenizer, const char **piece);
+
 /**
  * Create a minimal BPE tokenizer vocabulary from text corpus
  * 
+ * Replaces the vocabulary with the special tokens, the byte tokens and BPE
+ * merge rules learned from the corpus (see tinyaiVocabTrainerBuild).
+ * 
  * @param tokenizer Tokenizer to use
  * @param corpus Input text corpus
  * @param maxVocabSize Maximum vocabulary size
@@ -124,13 +339,59 @@ int tinyaiDecodeTokens(const TinyAITokenizer *tokenizer, const int *tokens,
 int tinyaiCreateMinimalVocabulary(TinyAITokenizer *tokenizer, 
                                 const char *corpus, int maxVocabSize);
 
+/**
+ * Create a BPE vocabulary from a corpus file
+ * 
+ * Like tinyaiCreateMinimalVocabulary, but streams the file in blocks rather
+ * than holding it in memory, counting each block in parallel.
+ * 
+ * @param tokenizer Tokenizer to use
+ * @param path Corpus file path
+ * @param maxVocabSize Maximum vocabulary size
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiCreateVocabularyFromFile(TinyAITokenizer *tokenizer, const char *path,
+                                   int maxVocabSize);
+
 /**
  * Save a vocabulary to a file
  * 
+ * Paths ending in TINYAI_VOCAB_BINARY_EXTENSION get the binary format: a
+ * string arena with token offsets, the prebuilt hash indexes and the merge
+ * ranks, laid out for tinyaiLoadVocabulary to map directly. The format uses
+ * host byte order. Other paths get the text format.
+ * 
  * @param tokenizer Tokenizer to save
  * @param path File path
  * @return 0 on success, non-zero on error
  */
 int tinyaiSaveVocabulary(const TinyAITokenizer *tokenizer, const char *path);
 
+/**
+ * Write a vocabulary in the binary format to an open file
+ * 
+ * Writes the same bytes as tinyaiSaveVocabulary with a binary path, at the
+ * current position, so the vocabulary can be embedded in a larger file.
+ * 
+ * @param tokenizer Tokenizer to save
+ * @param file File open for binary writing
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiWriteBinaryVocabulary(const TinyAITokenizer *tokenizer, FILE *file);
+
+/**
+ * Use a binary vocabulary held in memory in place
+ * 
+ * Like loading a binary vocabulary file, but from memory the caller keeps
+ * alive and unchanged for as long as the tokenizer uses it, for example a
+ * section of a larger mapped file. Nothing is copied until tokens or merges
+ * are added.
+ * 
+ * @param tokenizer Tokenizer to load into
+ * @param data Binary vocabulary, 4-byte aligned
+ * @param size Exact size of the binary vocabulary in bytes
+ * @return 0 on success, non-zero if the data is not a valid binary vocabulary
+ */
+int tinyaiAttachVocabulary(TinyAITokenizer *tokenizer, const void *data, size_t size);
+
 #endif /* TINYAI_TOKENIZER_H */
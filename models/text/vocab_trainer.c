@@ -0,0 +1,982 @@
+/**
+ * @file vocab_trainer.c
+ * @brief Streaming BPE vocabulary trainer
+ *
+ * Words are counted into an open-addressing hash table keyed by their bytes.
+ * Large blocks are split at word boundaries into shards that worker threads
+ * count into private tables, merged into the trainer's table afterwards.
+ *
+ * Training keeps each distinct word as a sequence of token ids, a count for
+ * every adjacent pair, and for every pair the words it may occur in. A merge
+ * rewrites only the words on the merged pair's list and adjusts the counts
+ * of the pairs in them; a max-heap with lazy deletion picks the next pair
+ * (stale entries are re-queued at their current count when they surface).
+ */
+
+#include "vocab_trainer.h"
+#include "../../core/io.h"
+#include "../../core/memory.h"
+#include "../../utils/thread_pool.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest word kept, as tinyaiEncodeText truncates words */
+#define MAX_WORD_LENGTH (TINYAI_MAX_TOKEN_LENGTH - 1)
+
+/* Smallest shard worth counting on its own thread */
+#define SHARD_MIN_BYTES 65536
+
+/* Read size of tinyaiVocabTrainerAddFile */
+#define FILE_BLOCK_BYTES ((size_t)16 << 20)
+
+/* Initial slot count of hash tables, as a power of two */
+#define TABLE_MIN_BITS 10
+
+/**
+ * Distinct word and its count
+ */
+typedef struct {
+    uint64_t count;  /* Occurrences (0 = empty slot) */
+    size_t   offset; /* Start of the word in the arena */
+    uint32_t hash;   /* hashWord of the word */
+    uint32_t length; /* Bytes of the word */
+} WordEntry;
+
+/**
+ * Open-addressing table of word counts
+ */
+typedef struct {
+    WordEntry *slots;         /* 1 << bits slots, at most half full */
+    uint32_t   bits;          /* log2 of the slot count */
+    uint32_t   size;          /* Distinct words */
+    char      *arena;         /* Word bytes, not NUL-terminated */
+    size_t     arenaUsed;     /* Bytes of arena in use */
+    size_t     arenaCapacity; /* Size of arena */
+} WordTable;
+
+/**
+ * Vocabulary trainer structure
+ */
+struct TinyAIVocabTrainer {
+    WordTable table;                            /* Counts of every word */
+    uint64_t  separators[256];                  /* Counts of separator bytes */
+    char      carry[TINYAI_MAX_TOKEN_LENGTH];   /* Word running past the last block */
+    uint32_t  carryLength;                      /* Bytes kept of it (0 = none) */
+};
+
+/**
+ * Private counts of one shard of a block
+ */
+typedef struct {
+    WordTable table;
+    uint64_t  separators[256];
+    int       failed;
+} ShardCounts;
+
+/* Shard counting, run as a thread pool task */
+typedef struct {
+    const char  *text;
+    const size_t *bounds; /* Shard s is text[bounds[s]] up to text[bounds[s + 1]] */
+    ShardCounts *shards;
+} CountTask;
+
+/**
+ * Adjacent token pair and where it may occur
+ */
+typedef struct {
+    int32_t   left;         /* Left token id */
+    int32_t   right;        /* Right token id */
+    uint64_t  count;        /* Weighted occurrences */
+    uint32_t *words;        /* Words that may hold the pair (a superset) */
+    uint32_t  wordCount;    /* Entries in words */
+    uint32_t  wordCapacity; /* Size of words */
+    uint32_t  touched;      /* Last merge that queued the pair */
+} PairEntry;
+
+/**
+ * Heap entry: a pair with its count when queued
+ */
+typedef struct {
+    uint64_t count;
+    uint32_t pair;
+} PairHeapEntry;
+
+/**
+ * Pair counts with their hash index and selection heap
+ */
+typedef struct {
+    PairEntry     *pairs;        /* Every pair seen */
+    uint32_t       pairCount;    /* Entries in pairs */
+    uint32_t       pairCapacity; /* Size of pairs */
+    int32_t       *index;        /* Open-addressing index into pairs (-1 = empty) */
+    uint32_t       bits;         /* log2 of the slot count of index */
+    PairHeapEntry *heap;         /* Max-heap by count, then by token ids */
+    size_t         heapSize;     /* Entries in heap */
+    size_t         heapCapacity; /* Size of heap */
+    uint32_t      *pending;      /* Pairs gaining occurrences in the current merge */
+    uint32_t       pendingCount; /* Entries in pending */
+    uint32_t       pendingSize;  /* Size of pending */
+} PairTable;
+
+/* ----------------- Word Counting ----------------- */
+
+/**
+ * Whether a byte belongs to a word, as tinyaiEncodeText decides
+ */
+static int isWordByte(char c)
+{
+    return isalnum((unsigned char)c) || c == '\'' || c == '-';
+}
+
+/**
+ * djb2 hash of a word
+ */
+static uint32_t hashWord(const char *word, uint32_t length)
+{
+    uint32_t hash = 5381;
+    for (uint32_t i = 0; i < length; i++) {
+        hash = ((hash << 5) + hash) + (unsigned char)word[i];
+    }
+    return hash;
+}
+
+static int wordTableInit(WordTable *table)
+{
+    memset(table, 0, sizeof(WordTable));
+    table->bits  = TABLE_MIN_BITS;
+    table->slots = (WordEntry *)TINYAI_MALLOC(((size_t)1 << table->bits) * sizeof(WordEntry));
+    if (!table->slots) {
+        return -1;
+    }
+    memset(table->slots, 0, ((size_t)1 << table->bits) * sizeof(WordEntry));
+    return 0;
+}
+
+static void wordTableFree(WordTable *table)
+{
+    TINYAI_FREE(table->slots);
+    TINYAI_FREE(table->arena);
+    memset(table, 0, sizeof(WordTable));
+}
+
+/**
+ * Find the slot of a word, or the empty slot where it belongs
+ */
+static WordEntry *findWordSlot(const WordTable *table, const char *word, uint32_t length,
+                               uint32_t hash)
+{
+    uint32_t mask = (1u << table->bits) - 1;
+    uint32_t slot = (hash * 2654435769u) >> (32 - table->bits);
+
+    while (table->slots[slot].count > 0) {
+        const WordEntry *entry = &table->slots[slot];
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(table->arena + entry->offset, word, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return &table->slots[slot];
+}
+
+/**
+ * Double the slot count of a word table
+ */
+static int growWordTable(WordTable *table)
+{
+    WordTable grown  = *table;
+    size_t    slots  = (size_t)1 << (table->bits + 1);
+    grown.bits       = table->bits + 1;
+    grown.slots      = (WordEntry *)TINYAI_MALLOC(slots * sizeof(WordEntry));
+    if (!grown.slots) {
+        return -1;
+    }
+    memset(grown.slots, 0, slots * sizeof(WordEntry));
+
+    for (size_t i = 0; i < ((size_t)1 << table->bits); i++) {
+        const WordEntry *entry = &table->slots[i];
+        if (entry->count > 0) {
+            *findWordSlot(&grown, table->arena + entry->offset, entry->length, entry->hash) =
+                *entry;
+        }
+    }
+
+    TINYAI_FREE(table->slots);
+    *table = grown;
+    return 0;
+}
+
+/**
+ * Add occurrences of a word to a table
+ */
+static int wordTableAdd(WordTable *table, const char *word, uint32_t length, uint32_t hash,
+                        uint64_t count)
+{
+    WordEntry *entry = findWordSlot(table, word, length, hash);
+    if (entry->count > 0) {
+        entry->count += count;
+        return 0;
+    }
+
+    /* Grow before the table passes half full, then find the word's new slot */
+    if ((table->size + 1) * 2 > (1u << table->bits)) {
+        if (growWordTable(table) != 0) {
+            return -1;
+        }
+        entry = findWordSlot(table, word, length, hash);
+    }
+
+    if (table->arenaUsed + length > table->arenaCapacity) {
+        size_t capacity = table->arenaCapacity > 4096 ? table->arenaCapacity : 4096;
+        while (capacity < table->arenaUsed + length) {
+            capacity *= 2;
+        }
+        char *arena = (char *)TINYAI_MALLOC(capacity);
+        if (!arena) {
+            return -1;
+        }
+        if (table->arenaUsed > 0) {
+            memcpy(arena, table->arena, table->arenaUsed);
+        }
+        TINYAI_FREE(table->arena);
+        table->arena         = arena;
+        table->arenaCapacity = capacity;
+    }
+
+    memcpy(table->arena + table->arenaUsed, word, length);
+    entry->count  = count;
+    entry->offset = table->arenaUsed;
+    entry->hash   = hash;
+    entry->length = length;
+    table->arenaUsed += length;
+    table->size++;
+
+    return 0;
+}
+
+/**
+ * Count the words and separators of text made of whole words
+ */
+static int countWords(WordTable *table, uint64_t *separators, const char *text, size_t length)
+{
+    size_t i = 0;
+    while (i < length) {
+        if (isWordByte(text[i])) {
+            size_t start = i;
+            while (i < length && isWordByte(text[i])) {
+                i++;
+            }
+            uint32_t wordLength = (uint32_t)(i - start < MAX_WORD_LENGTH ? i - start
+                                                                          : MAX_WORD_LENGTH);
+            if (wordTableAdd(table, text + start, wordLength, hashWord(text + start, wordLength),
+                             1) != 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        /* Whitespace (and NUL, which ends text for the encoder) produces no token */
+        if (text[i] != '\0' && !isspace((unsigned char)text[i])) {
+            separators[(unsigned char)text[i]]++;
+        }
+        i++;
+    }
+
+    return 0;
+}
+
+/**
+ * Count a range of shards into their private tables
+ */
+static void countShards(void *context, size_t begin, size_t end)
+{
+    CountTask *task = (CountTask *)context;
+
+    for (size_t s = begin; s < end; s++) {
+        ShardCounts *shard = &task->shards[s];
+        memset(shard->separators, 0, sizeof(shard->separators));
+        shard->failed =
+            wordTableInit(&shard->table) != 0 ||
+            countWords(&shard->table, shard->separators, task->text + task->bounds[s],
+                       task->bounds[s + 1] - task->bounds[s]) != 0;
+    }
+}
+
+/**
+ * Count text made of whole words, in parallel shards when it is large
+ */
+static int countBlock(TinyAIVocabTrainer *trainer, const char *text, size_t length)
+{
+    TinyAIThreadPool *pool      = tinyaiGetThreadPool();
+    size_t            numShards = length / SHARD_MIN_BYTES;
+    int               threads   = tinyaiThreadPoolSize(pool);
+    size_t            maxShards = threads > 1 ? (size_t)threads * 4 : 1;
+    if (numShards > maxShards) {
+        numShards = maxShards;
+    }
+    if (numShards < 2) {
+        return countWords(&trainer->table, trainer->separators, text, length);
+    }
+
+    size_t      *bounds = (size_t *)TINYAI_MALLOC((numShards + 1) * sizeof(size_t));
+    ShardCounts *shards = (ShardCounts *)TINYAI_MALLOC(numShards * sizeof(ShardCounts));
+    if (!bounds || !shards) {
+        TINYAI_FREE(bounds);
+        TINYAI_FREE(shards);
+        return -1;
+    }
+
+    /* Shards end before a byte outside any word, so no word is split */
+    bounds[0] = 0;
+    for (size_t s = 1; s < numShards; s++) {
+        size_t bound = length / numShards * s;
+        if (bound < bounds[s - 1]) {
+            bound = bounds[s - 1];
+        }
+        while (bound < length && isWordByte(text[bound])) {
+            bound++;
+        }
+        bounds[s] = bound;
+    }
+    bounds[numShards] = length;
+
+    CountTask task = {text, bounds, shards};
+    tinyaiParallelFor(pool, numShards, 1, countShards, &task);
+
+    /* Merge the shards in order */
+    int result = 0;
+    for (size_t s = 0; s < numShards; s++) {
+        const WordTable *table = &shards[s].table;
+        result = result != 0 || shards[s].failed ? -1 : 0;
+        for (size_t i = 0; result == 0 && i < ((size_t)1 << table->bits); i++) {
+            const WordEntry *entry = &table->slots[i];
+            if (entry->count > 0 &&
+                wordTableAdd(&trainer->table, table->arena + entry->offset, entry->length,
+                             entry->hash, entry->count) != 0) {
+                result = -1;
+            }
+        }
+        for (int c = 0; c < 256; c++) {
+            trainer->separators[c] += shards[s].separators[c];
+        }
+        wordTableFree(&shards[s].table);
+    }
+
+    TINYAI_FREE(bounds);
+    TINYAI_FREE(shards);
+    return result;
+}
+
+/**
+ * Count the word carried over from the previous block
+ */
+static int flushCarry(TinyAIVocabTrainer *trainer)
+{
+    if (trainer->carryLength == 0) {
+        return 0;
+    }
+
+    uint32_t length      = trainer->carryLength;
+    trainer->carryLength = 0;
+    return wordTableAdd(&trainer->table, trainer->carry, length,
+                        hashWord(trainer->carry, length), 1);
+}
+
+/**
+ * Create a vocabulary trainer
+ */
+TinyAIVocabTrainer *tinyaiCreateVocabTrainer(void)
+{
+    TinyAIVocabTrainer *trainer = (TinyAIVocabTrainer *)TINYAI_MALLOC(sizeof(TinyAIVocabTrainer));
+    if (!trainer) {
+        return NULL;
+    }
+
+    memset(trainer, 0, sizeof(TinyAIVocabTrainer));
+    if (wordTableInit(&trainer->table) != 0) {
+        TINYAI_FREE(trainer);
+        return NULL;
+    }
+
+    return trainer;
+}
+
+/**
+ * Free a vocabulary trainer
+ */
+void tinyaiDestroyVocabTrainer(TinyAIVocabTrainer *trainer)
+{
+    if (!trainer) {
+        return;
+    }
+
+    wordTableFree(&trainer->table);
+    TINYAI_FREE(trainer);
+}
+
+/**
+ * Count the words of the next block of a corpus
+ */
+int tinyaiVocabTrainerAddText(TinyAIVocabTrainer *trainer, const char *text, size_t length)
+{
+    if (!trainer || (!text && length > 0)) {
+        return -1;
+    }
+
+    /* Finish the word the last block ended in */
+    size_t start = 0;
+    if (trainer->carryLength > 0) {
+        while (start < length && isWordByte(text[start])) {
+            if (trainer->carryLength < MAX_WORD_LENGTH) {
+                trainer->carry[trainer->carryLength++] = text[start];
+            }
+            start++;
+        }
+        if (start == length) {
+            return 0;
+        }
+        if (flushCarry(trainer) != 0) {
+            return -1;
+        }
+    }
+
+    /* Hold back a word that may continue into the next block */
+    size_t end = length;
+    while (end > start && isWordByte(text[end - 1])) {
+        end--;
+    }
+
+    if (countBlock(trainer, text + start, end - start) != 0) {
+        return -1;
+    }
+
+    size_t carryLength = length - end < MAX_WORD_LENGTH ? length - end : MAX_WORD_LENGTH;
+    memcpy(trainer->carry, text + end, carryLength);
+    trainer->carryLength = (uint32_t)carryLength;
+
+    return 0;
+}
+
+/**
+ * Count the words of a corpus file
+ */
+int tinyaiVocabTrainerAddFile(TinyAIVocabTrainer *trainer, const char *path)
+{
+    if (!trainer || !path) {
+        return -1;
+    }
+
+    TinyAIFile *file = tinyaiOpenFile(path, TINYAI_FILE_READ | TINYAI_FILE_BINARY);
+    if (!file) {
+        return -1;
+    }
+
+    char *block = (char *)TINYAI_MALLOC(FILE_BLOCK_BYTES);
+    if (!block) {
+        tinyaiCloseFile(file);
+        return -1;
+    }
+
+    int     result = 0;
+    int64_t bytesRead = 0;
+    while (result == 0 && (bytesRead = tinyaiReadFile(file, block, FILE_BLOCK_BYTES)) > 0) {
+        result = tinyaiVocabTrainerAddText(trainer, block, (size_t)bytesRead);
+    }
+    if (bytesRead < 0) {
+        result = -1;
+    }
+
+    TINYAI_FREE(block);
+    tinyaiCloseFile(file);
+    return result;
+}
+
+/* ----------------- Pair Counting ----------------- */
+
+/**
+ * Find a pair, adding it with no occurrences when create is set
+ *
+ * @return Index of the pair, or -1 if it is missing (or cannot be added)
+ */
+static int32_t findPair(PairTable *table, int32_t left, int32_t right, int create)
+{
+    uint32_t hash = ((uint32_t)left * 0x9E3779B1u) ^ (uint32_t)right;
+    uint32_t mask = (1u << table->bits) - 1;
+    uint32_t slot = (hash * 2654435769u) >> (32 - table->bits);
+
+    while (table->index[slot] >= 0) {
+        const PairEntry *pair = &table->pairs[table->index[slot]];
+        if (pair->left == left && pair->right == right) {
+            return table->index[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (!create) {
+        return -1;
+    }
+
+    /* Grow the entries, and the index before it passes half full */
+    if (table->pairCount == table->pairCapacity) {
+        uint32_t   capacity = table->pairCapacity * 2;
+        PairEntry *pairs    = (PairEntry *)TINYAI_MALLOC(capacity * sizeof(PairEntry));
+        if (!pairs) {
+            return -1;
+        }
+        memcpy(pairs, table->pairs, table->pairCount * sizeof(PairEntry));
+        TINYAI_FREE(table->pairs);
+        table->pairs        = pairs;
+        table->pairCapacity = capacity;
+    }
+    if ((table->pairCount + 1) * 2 > (1u << table->bits)) {
+        size_t   slots = (size_t)1 << (table->bits + 1);
+        int32_t *index = (int32_t *)TINYAI_MALLOC(slots * sizeof(int32_t));
+        if (!index) {
+            return -1;
+        }
+        memset(index, 0xFF, slots * sizeof(int32_t));
+        TINYAI_FREE(table->index);
+        table->index = index;
+        table->bits++;
+        for (uint32_t i = 0; i < table->pairCount; i++) {
+            const PairEntry *pair = &table->pairs[i];
+            uint32_t h = ((uint32_t)pair->left * 0x9E3779B1u) ^ (uint32_t)pair->right;
+            uint32_t s = (h * 2654435769u) >> (32 - table->bits);
+            while (index[s] >= 0) {
+                s = (s + 1) & ((1u << table->bits) - 1);
+            }
+            index[s] = (int32_t)i;
+        }
+        return findPair(table, left, right, create);
+    }
+
+    int32_t    id   = (int32_t)table->pairCount++;
+    PairEntry *pair = &table->pairs[id];
+    memset(pair, 0, sizeof(PairEntry));
+    pair->left          = left;
+    pair->right         = right;
+    table->index[slot]  = id;
+    return id;
+}
+
+/**
+ * Record that a word may hold a pair
+ */
+static int addPairWord(PairEntry *pair, uint32_t word)
+{
+    if (pair->wordCount > 0 && pair->words[pair->wordCount - 1] == word) {
+        return 0;
+    }
+
+    if (pair->wordCount == pair->wordCapacity) {
+        uint32_t  capacity = pair->wordCapacity > 0 ? pair->wordCapacity * 2 : 4;
+        uint32_t *words    = (uint32_t *)TINYAI_MALLOC(capacity * sizeof(uint32_t));
+        if (!words) {
+            return -1;
+        }
+        if (pair->wordCount > 0) {
+            memcpy(words, pair->words, pair->wordCount * sizeof(uint32_t));
+        }
+        TINYAI_FREE(pair->words);
+        pair->words        = words;
+        pair->wordCapacity = capacity;
+    }
+
+    pair->words[pair->wordCount++] = word;
+    return 0;
+}
+
+/**
+ * Whether heap entry a should be merged before b
+ */
+static int pairBefore(const PairTable *table, const PairHeapEntry *a, const PairHeapEntry *b)
+{
+    if (a->count != b->count) {
+        return a->count > b->count;
+    }
+
+    /* Ties go to the lower token ids, so training is deterministic */
+    const PairEntry *pa = &table->pairs[a->pair];
+    const PairEntry *pb = &table->pairs[b->pair];
+    return pa->left != pb->left ? pa->left < pb->left : pa->right < pb->right;
+}
+
+static int pushPair(PairTable *table, uint32_t pair)
+{
+    if (table->heapSize == table->heapCapacity) {
+        size_t         capacity = table->heapCapacity > 0 ? table->heapCapacity * 2 : 1024;
+        PairHeapEntry *heap = (PairHeapEntry *)TINYAI_MALLOC(capacity * sizeof(PairHeapEntry));
+        if (!heap) {
+            return -1;
+        }
+        if (table->heapSize > 0) {
+            memcpy(heap, table->heap, table->heapSize * sizeof(PairHeapEntry));
+        }
+        TINYAI_FREE(table->heap);
+        table->heap         = heap;
+        table->heapCapacity = capacity;
+    }
+
+    PairHeapEntry entry = {table->pairs[pair].count, pair};
+    size_t        i     = table->heapSize++;
+    while (i > 0 && pairBefore(table, &entry, &table->heap[(i - 1) / 2])) {
+        table->heap[i] = table->heap[(i - 1) / 2];
+        i              = (i - 1) / 2;
+    }
+    table->heap[i] = entry;
+
+    return 0;
+}
+
+static PairHeapEntry popPair(PairTable *table)
+{
+    PairHeapEntry top  = table->heap[0];
+    PairHeapEntry last = table->heap[--table->heapSize];
+    size_t        i    = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= table->heapSize) {
+            break;
+        }
+        if (child + 1 < table->heapSize &&
+            pairBefore(table, &table->heap[child + 1], &table->heap[child])) {
+            child++;
+        }
+        if (!pairBefore(table, &table->heap[child], &last)) {
+            break;
+        }
+        table->heap[i] = table->heap[child];
+        i              = child;
+    }
+    if (table->heapSize > 0) {
+        table->heap[i] = last;
+    }
+
+    return top;
+}
+
+static void freePairTable(PairTable *table)
+{
+    for (uint32_t i = 0; i < table->pairCount; i++) {
+        TINYAI_FREE(table->pairs[i].words);
+    }
+    TINYAI_FREE(table->pairs);
+    TINYAI_FREE(table->index);
+    TINYAI_FREE(table->heap);
+    TINYAI_FREE(table->pending);
+}
+
+/* ----------------- Training ----------------- */
+
+/**
+ * Words as token sequences, rewritten in place as merges apply
+ */
+typedef struct {
+    uint32_t  count;      /* Distinct words */
+    uint64_t *weights;    /* Occurrences of each word */
+    size_t   *starts;     /* Start of each word in symbols */
+    uint32_t *lengths;    /* Current tokens in each word */
+    uint32_t *lastMerge;  /* Last merge that rewrote each word, plus one */
+    int32_t  *symbols;    /* Token ids of every word */
+} TrainingWords;
+
+static void freeTrainingWords(TrainingWords *words)
+{
+    TINYAI_FREE(words->weights);
+    TINYAI_FREE(words->starts);
+    TINYAI_FREE(words->lengths);
+    TINYAI_FREE(words->lastMerge);
+    TINYAI_FREE(words->symbols);
+}
+
+/**
+ * Add the pairs of a word, recording it on the lists of pairs holding token
+ * (every pair when token is negative)
+ */
+static int addWordPairs(PairTable *pairs, const TrainingWords *words, uint32_t w, int32_t token,
+                        uint32_t merge)
+{
+    const int32_t *symbols = words->symbols + words->starts[w];
+    for (uint32_t i = 0; i + 1 < words->lengths[w]; i++) {
+        if (symbols[i] == TINYAI_TOKEN_UNKNOWN || symbols[i + 1] == TINYAI_TOKEN_UNKNOWN) {
+            continue;
+        }
+        int32_t id = findPair(pairs, symbols[i], symbols[i + 1], 1);
+        if (id < 0) {
+            return -1;
+        }
+        PairEntry *pair = &pairs->pairs[id];
+        pair->count += words->weights[w];
+        if (token < 0 || symbols[i] == token || symbols[i + 1] == token) {
+            if (addPairWord(pair, w) != 0) {
+                return -1;
+            }
+
+            /* Pairs gaining occurrences are queued once the merge has counted them in full */
+            if (token >= 0 && pair->touched != merge) {
+                pair->touched = merge;
+                if (pairs->pendingCount == pairs->pendingSize) {
+                    uint32_t  size    = pairs->pendingSize > 0 ? pairs->pendingSize * 2 : 256;
+                    uint32_t *pending = (uint32_t *)TINYAI_MALLOC(size * sizeof(uint32_t));
+                    if (!pending) {
+                        return -1;
+                    }
+                    if (pairs->pendingCount > 0) {
+                        memcpy(pending, pairs->pending, pairs->pendingCount * sizeof(uint32_t));
+                    }
+                    TINYAI_FREE(pairs->pending);
+                    pairs->pending     = pending;
+                    pairs->pendingSize = size;
+                }
+                pairs->pending[pairs->pendingCount++] = (uint32_t)id;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Add a single-byte token with its corpus frequency
+ */
+static int addByteToken(TinyAITokenizer *tokenizer, int byte, uint64_t frequency)
+{
+    char token[2] = {(char)byte, '\0'};
+    return tinyaiAddToken(tokenizer, token, frequency > UINT32_MAX ? UINT32_MAX
+                                                                   : (uint32_t)frequency) < 0
+               ? -1
+               : 0;
+}
+
+/**
+ * Add the byte tokens, then merge rules until the vocabulary is full
+ */
+static int trainMerges(const TinyAIVocabTrainer *trainer, TinyAITokenizer *tokenizer,
+                       int maxVocabSize, TrainingWords *words, PairTable *pairs)
+{
+    const WordTable *table = &trainer->table;
+
+    /* Byte frequencies over words and separators */
+    uint64_t bytes[256];
+    memcpy(bytes, trainer->separators, sizeof(bytes));
+    size_t totalSymbols = 0;
+    for (size_t i = 0; i < ((size_t)1 << table->bits); i++) {
+        const WordEntry *entry = &table->slots[i];
+        for (uint32_t j = 0; entry->count > 0 && j < entry->length; j++) {
+            bytes[(unsigned char)table->arena[entry->offset + j]] += entry->count;
+        }
+        totalSymbols += entry->count > 0 ? entry->length : 0;
+    }
+
+    /* Every printable ASCII character, then any other byte seen, most frequent first. Capitals
+       come after the rest, so case-insensitive lookups (which find the first of a folded key)
+       give lowercase tokens, and the merges learned spell words in lowercase */
+    for (int pass = 0; pass < 2; pass++) {
+        for (int c = 32; c < 127 && (int)tokenizer->tokenCount < maxVocabSize; c++) {
+            if ((isalnum(c) || ispunct(c)) && (isupper(c) != 0) == (pass == 1) &&
+                addByteToken(tokenizer, c, bytes[c]) != 0) {
+                return -1;
+            }
+        }
+    }
+    for (;;) {
+        int best = -1;
+        for (int c = 0; c < 256; c++) {
+            if (bytes[c] > 0 && !(c >= 32 && c < 127) && (best < 0 || bytes[c] > bytes[best])) {
+                best = c;
+            }
+        }
+        if (best < 0 || (int)tokenizer->tokenCount >= maxVocabSize) {
+            break;
+        }
+        if (addByteToken(tokenizer, best, bytes[best]) != 0) {
+            return -1;
+        }
+        bytes[best] = 0;
+    }
+
+    /* Split every word into its byte tokens */
+    words->count     = table->size;
+    words->weights   = (uint64_t *)TINYAI_MALLOC(table->size * sizeof(uint64_t) + 1);
+    words->starts    = (size_t *)TINYAI_MALLOC(table->size * sizeof(size_t) + 1);
+    words->lengths   = (uint32_t *)TINYAI_MALLOC(table->size * sizeof(uint32_t) + 1);
+    words->lastMerge = (uint32_t *)TINYAI_MALLOC(table->size * sizeof(uint32_t) + 1);
+    words->symbols   = (int32_t *)TINYAI_MALLOC(totalSymbols * sizeof(int32_t) + 1);
+    if (!words->weights || !words->starts || !words->lengths || !words->lastMerge ||
+        !words->symbols) {
+        return -1;
+    }
+
+    int32_t byteTokens[256];
+    for (int c = 0; c < 256; c++) {
+        char token[2] = {(char)c, '\0'};
+        byteTokens[c] = c == 0 ? TINYAI_TOKEN_UNKNOWN : tinyaiGetTokenId(tokenizer, token);
+    }
+
+    uint32_t w     = 0;
+    size_t   start = 0;
+    for (size_t i = 0; i < ((size_t)1 << table->bits); i++) {
+        const WordEntry *entry = &table->slots[i];
+        if (entry->count == 0) {
+            continue;
+        }
+        words->weights[w]   = entry->count;
+        words->starts[w]    = start;
+        words->lengths[w]   = entry->length;
+        words->lastMerge[w] = 0;
+        for (uint32_t j = 0; j < entry->length; j++) {
+            words->symbols[start + j] =
+                byteTokens[(unsigned char)table->arena[entry->offset + j]];
+        }
+        start += entry->length;
+        w++;
+    }
+
+    /* Count every pair and queue them all */
+    pairs->pairCapacity = 1024;
+    pairs->pairs        = (PairEntry *)TINYAI_MALLOC(pairs->pairCapacity * sizeof(PairEntry));
+    pairs->bits         = TABLE_MIN_BITS;
+    pairs->index        = (int32_t *)TINYAI_MALLOC(((size_t)1 << pairs->bits) * sizeof(int32_t));
+    if (!pairs->pairs || !pairs->index) {
+        return -1;
+    }
+    memset(pairs->index, 0xFF, ((size_t)1 << pairs->bits) * sizeof(int32_t));
+
+    for (w = 0; w < words->count; w++) {
+        if (addWordPairs(pairs, words, w, -1, 0) != 0) {
+            return -1;
+        }
+    }
+    for (uint32_t p = 0; p < pairs->pairCount; p++) {
+        if (pushPair(pairs, p) != 0) {
+            return -1;
+        }
+    }
+
+    /* Merge the most frequent pair until the vocabulary is full */
+    uint32_t merge = 0;
+    while ((int)tokenizer->tokenCount < maxVocabSize && pairs->heapSize > 0) {
+        PairHeapEntry top  = popPair(pairs);
+        PairEntry    *best = &pairs->pairs[top.pair];
+
+        /* Counts only fall once queued, so a stale entry is re-queued at its current count */
+        if (top.count != best->count) {
+            if (best->count > 0 && pushPair(pairs, top.pair) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (best->count < 2) {
+            break;
+        }
+
+        int32_t     left       = best->left;
+        int32_t     right      = best->right;
+        uint64_t    count      = best->count;
+        const char *leftText   = tinyaiGetTokenString(tokenizer, left);
+        const char *rightText  = tinyaiGetTokenString(tokenizer, right);
+        uint32_t    mergeCount = tokenizer->mergeCount;
+        if (strlen(leftText) + strlen(rightText) >= TINYAI_MAX_TOKEN_LENGTH) {
+            best->count = 0;
+            continue;
+        }
+        int rank = tinyaiAddMerge(tokenizer, leftText, rightText);
+        if (rank < 0) {
+            return -1;
+        }
+        if ((uint32_t)rank < mergeCount) {
+            /* Another pair already spells the same rule */
+            best->count = 0;
+            continue;
+        }
+        int32_t result = tokenizer->merges[rank].result;
+        if (tinyaiAddToken(tokenizer, tinyaiGetTokenString(tokenizer, result),
+                           count > UINT32_MAX ? UINT32_MAX : (uint32_t)count) < 0) {
+            return -1;
+        }
+        merge++;
+
+        /* Rewrite the words holding the pair; the list may grow, so walk it by index */
+        uint32_t listed = best->wordCount;
+        for (uint32_t k = 0; k < listed; k++) {
+            uint32_t word = pairs->pairs[top.pair].words[k];
+            if (words->lastMerge[word] == merge) {
+                continue;
+            }
+            words->lastMerge[word] = merge;
+
+            int32_t *symbols = words->symbols + words->starts[word];
+            uint32_t length  = words->lengths[word];
+            uint32_t i       = 0;
+            while (i + 1 < length && !(symbols[i] == left && symbols[i + 1] == right)) {
+                i++;
+            }
+            if (i + 1 >= length) {
+                continue;
+            }
+
+            /* Take out the word's old pairs, merge left to right, and count the new ones */
+            for (i = 0; i + 1 < length; i++) {
+                int32_t id = findPair(pairs, symbols[i], symbols[i + 1], 0);
+                if (id >= 0) {
+                    pairs->pairs[id].count -= words->weights[word];
+                }
+            }
+            uint32_t merged = 0;
+            for (i = 0; i < length; merged++) {
+                if (i + 1 < length && symbols[i] == left && symbols[i + 1] == right) {
+                    symbols[merged] = result;
+                    i += 2;
+                } else {
+                    symbols[merged] = symbols[i++];
+                }
+            }
+            words->lengths[word] = merged;
+            if (addWordPairs(pairs, words, word, result, merge) != 0) {
+                return -1;
+            }
+        }
+
+        for (uint32_t i = 0; i < pairs->pendingCount; i++) {
+            if (pushPair(pairs, pairs->pending[i]) != 0) {
+                return -1;
+            }
+        }
+        pairs->pendingCount = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * Learn a vocabulary from the counted text
+ */
+int tinyaiVocabTrainerBuild(TinyAIVocabTrainer *trainer, TinyAITokenizer *tokenizer,
+                            int maxVocabSize)
+{
+    if (!trainer || !tokenizer || maxVocabSize <= 0) {
+        return -1;
+    }
+    if (maxVocabSize > TINYAI_MAX_VOCAB_SIZE) {
+        maxVocabSize = TINYAI_MAX_VOCAB_SIZE;
+    }
+
+    /* The corpus ends any word still open */
+    if (flushCarry(trainer) != 0) {
+        return -1;
+    }
+
+    TrainingWords words;
+    PairTable     pairs;
+    memset(&words, 0, sizeof(words));
+    memset(&pairs, 0, sizeof(pairs));
+
+    int result = trainMerges(trainer, tokenizer, maxVocabSize, &words, &pairs);
+
+    freePairTable(&pairs);
+    freeTrainingWords(&words);
+    return result;
+}
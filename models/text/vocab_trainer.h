@@ -0,0 +1,79 @@
+/**
+ * @file vocab_trainer.h
+ * @brief Streaming BPE vocabulary trainer
+ *
+ * Counts the words of a corpus as it is streamed in, in parallel across
+ * shards of each block, then learns byte-pair merge rules from the word
+ * counts. Only the distinct words are kept, never the corpus itself, so
+ * corpora far larger than memory can be trained on.
+ */
+
+#ifndef TINYAI_VOCAB_TRAINER_H
+#define TINYAI_VOCAB_TRAINER_H
+
+#include "tokenizer.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Vocabulary trainer (opaque)
+ */
+typedef struct TinyAIVocabTrainer TinyAIVocabTrainer;
+
+/**
+ * Create a vocabulary trainer with no text counted
+ *
+ * @return New trainer or NULL on error
+ */
+TinyAIVocabTrainer *tinyaiCreateVocabTrainer(void);
+
+/**
+ * Free a vocabulary trainer
+ *
+ * @param trainer Trainer to free
+ */
+void tinyaiDestroyVocabTrainer(TinyAIVocabTrainer *trainer);
+
+/**
+ * Count the words of the next block of a corpus
+ *
+ * Blocks are treated as one continuous text, so a word may run across the
+ * end of one block into the next. Words and separators are split exactly
+ * as tinyaiEncodeText splits them. Large blocks are counted in parallel on
+ * the shared thread pool.
+ *
+ * @param trainer Trainer to count into
+ * @param text Block of corpus text
+ * @param length Bytes in the block
+ * @return 0 on success, -1 on error
+ */
+int tinyaiVocabTrainerAddText(TinyAIVocabTrainer *trainer, const char *text, size_t length);
+
+/**
+ * Count the words of a corpus file, streamed in fixed-size blocks
+ *
+ * @param trainer Trainer to count into
+ * @param path Corpus file path
+ * @return 0 on success, -1 on error
+ */
+int tinyaiVocabTrainerAddFile(TinyAIVocabTrainer *trainer, const char *path);
+
+/**
+ * Learn a vocabulary from the counted text
+ *
+ * Adds every printable ASCII character and any other separator byte seen,
+ * then merge rules for the most frequent adjacent token pairs in rank order
+ * (tinyaiAddMerge), until the vocabulary holds maxVocabSize tokens or no
+ * pair occurs twice. Pair counts are updated only in the words each merge
+ * touches. Tokens get their corpus frequency. The tokenizer normally holds
+ * just its special tokens beforehand.
+ *
+ * @param trainer Trainer holding the word counts
+ * @param tokenizer Tokenizer to add tokens and merge rules to
+ * @param maxVocabSize Vocabulary size to stop at
+ * @return 0 on success, -1 on error
+ */
+int tinyaiVocabTrainerBuild(TinyAIVocabTrainer *trainer, TinyAITokenizer *tokenizer,
+                            int maxVocabSize);
+
+#endif /* TINYAI_VOCAB_TRAINER_H */
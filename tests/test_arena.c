@@ -0,0 +1,100 @@
+/**
+ * TinyAI Arena Tests
+ */
+
+#include "../utils/arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+static void test_arena_alignment_and_scopes()
+{
+    printf("  Testing arena alignment and scopes...\n");
+
+    TinyAIArena *arena = tinyaiArenaCreate(4096);
+    ASSERT(arena != NULL, "Arena should be created");
+
+    // Odd sizes still leave every allocation SIMD-aligned and disjoint
+    char *a = (char *)tinyaiArenaAlloc(arena, 3);
+    char *b = (char *)tinyaiArenaAlloc(arena, 100);
+    ASSERT(a && b, "Allocations should succeed");
+    ASSERT((uintptr_t)a % TINYAI_ARENA_ALIGNMENT == 0, "Allocation should be aligned");
+    ASSERT((uintptr_t)b % TINYAI_ARENA_ALIGNMENT == 0, "Allocation should be aligned");
+    ASSERT(b >= a + 3, "Allocations should not overlap");
+    memset(a, 1, 3);
+    memset(b, 2, 100);
+
+    // Ending a scope hands its memory to the next allocation, and keeps older memory
+    TinyAIArenaMark mark  = tinyaiArenaBeginScope(arena);
+    char           *inner = (char *)tinyaiArenaAlloc(arena, 256);
+    ASSERT(inner != NULL, "Scoped allocation should succeed");
+    tinyaiArenaEndScope(arena, mark);
+    ASSERT(tinyaiArenaAlloc(arena, 256) == inner, "Scope end should rewind the arena");
+    ASSERT(a[0] == 1 && b[99] == 2, "Memory outside the scope should be untouched");
+
+    // A reset starts over from the first allocation
+    tinyaiArenaReset(arena);
+    ASSERT(tinyaiArenaAlloc(arena, 8) == a, "Reset should rewind to the start");
+
+    tinyaiArenaDestroy(arena);
+    printf("    PASS\n");
+}
+
+static void test_arena_growth()
+{
+    printf("  Testing arena growth...\n");
+
+    TinyAIArena *arena = tinyaiArenaCreate(1024);
+    ASSERT(arena != NULL, "Arena should be created");
+
+    // Overflow the first chunk several times; earlier blocks must stay intact
+    unsigned char *blocks[6];
+    for (int i = 0; i < 6; i++) {
+        blocks[i] = (unsigned char *)tinyaiArenaAlloc(arena, 1000);
+        ASSERT(blocks[i] != NULL, "Allocation beyond the first chunk should grow the arena");
+        ASSERT((uintptr_t)blocks[i] % TINYAI_ARENA_ALIGNMENT == 0, "Allocation should be aligned");
+        memset(blocks[i], i + 1, 1000);
+    }
+    for (int i = 0; i < 6; i++) {
+        ASSERT(blocks[i][0] == i + 1 && blocks[i][999] == i + 1, "Blocks should not overlap");
+    }
+    ASSERT(tinyaiArenaPeakUsage(arena) >= 6000, "Peak usage should cover all blocks");
+
+    // After a reset the same workload fits in one contiguous chunk
+    tinyaiArenaReset(arena);
+    char *first = (char *)tinyaiArenaAlloc(arena, 1000);
+    char *prev  = first;
+    for (int i = 1; i < 6; i++) {
+        char *next = (char *)tinyaiArenaAlloc(arena, 1000);
+        ASSERT(next == prev + 1024, "Reset arena should serve the workload from one chunk");
+        prev = next;
+    }
+
+    // An allocation larger than the whole arena still succeeds
+    tinyaiArenaReset(arena);
+    ASSERT(tinyaiArenaAlloc(arena, 64 * 1024) != NULL,
+           "Oversized allocation should grow the arena");
+
+    tinyaiArenaDestroy(arena);
+    printf("    PASS\n");
+}
+
+void run_arena_tests()
+{
+    printf("--- Running Arena Tests ---\n");
+
+    test_arena_alignment_and_scopes();
+    test_arena_growth();
+
+    printf("--- Arena Tests Finished ---\n");
+}
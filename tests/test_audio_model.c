@@ -3,9 +3,13 @@
  * @brief Test program for audio model functionality in TinyAI
  */
 
+#include "../models/audio/audio_feature_store.h"
 #include "../models/audio/audio_features.h"
 #include "../models/audio/audio_model.h"
+#include "../models/audio/audio_pipeline.h"
 #include "../models/audio/audio_utils.h"
+#include "../utils/quantize.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -114,6 +118,611 @@ static bool testAudioFeatures()
     return true;
 }
 
+/**
+ * Test the FFT against a direct DFT
+ * @return true on success, false on failure
+ */
+static bool testFFT()
+{
+    printf("Testing FFT...\n");
+
+    int    sizes[] = {1, 2, 4, 8, 16, 64, 512};
+    bool   passed  = true;
+    float *samples = (float *)malloc(512 * sizeof(float));
+    float *real    = (float *)malloc(512 * sizeof(float));
+    float *imag    = (float *)malloc(512 * sizeof(float));
+    if (!samples || !real || !imag) {
+        free(samples);
+        free(real);
+        free(imag);
+        return false;
+    }
+    for (int i = 0; i < 512; i++) {
+        samples[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])) && passed; s++) {
+        int size = sizes[s];
+
+        /* A full frame, and a shorter one that is zero padded */
+        int lengths[] = {size, size > 2 ? size - 3 : size};
+        for (int l = 0; l < 2 && passed; l++) {
+            int numSamples = lengths[l];
+            if (!tinyaiAudioComputeFFT(samples, numSamples, size, real, imag)) {
+                fprintf(stderr, "FFT of size %d failed\n", size);
+                passed = false;
+                break;
+            }
+            for (int k = 0; k < size; k++) {
+                double re = 0.0, im = 0.0;
+                for (int n = 0; n < numSamples; n++) {
+                    double angle = -2.0 * 3.14159265358979323846 * k * n / size;
+                    re += samples[n] * cos(angle);
+                    im += samples[n] * sin(angle);
+                }
+                if (fabs(real[k] - re) > 1e-4 * size || fabs(imag[k] - im) > 1e-4 * size) {
+                    fprintf(stderr, "FFT of size %d differs at bin %d\n", size, k);
+                    passed = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (tinyaiAudioComputeFFT(samples, 12, 12, real, imag)) {
+        fprintf(stderr, "FFT of a size that is not a power of 2 should fail\n");
+        passed = false;
+    }
+
+    free(samples);
+    free(real);
+    free(imag);
+
+    if (passed) {
+        printf("FFT test passed!\n");
+    }
+    return passed;
+}
+
+/**
+ * Test the sparse mel filter bank and MFCC DCT against direct computation
+ * @return true on success, false on failure
+ */
+static bool testMelFilterBank()
+{
+    printf("Testing mel filter banks...\n");
+
+    enum { FFT_SIZE = 512, BINS = FFT_SIZE / 2 + 1, FILTERS = 26, COEFFS = 13 };
+    float *dense    = (float *)malloc(FILTERS * BINS * sizeof(float));
+    float  spectrum[BINS], denseEnergies[FILTERS], sparseEnergies[FILTERS], mfcc[COEFFS];
+    TinyAISparseMelFilterBank *sparse =
+        tinyaiAudioCreateSparseMelFilterBank(FILTERS, FFT_SIZE, 16000, 0.0f, 8000.0f);
+    bool passed = dense && sparse &&
+                  tinyaiAudioCreateMelFilterBank(FILTERS, FFT_SIZE, 16000, 0.0f, 8000.0f, dense);
+
+    for (int i = 0; i < BINS; i++) {
+        spectrum[i] = (float)rand() / RAND_MAX;
+    }
+    passed = passed &&
+             tinyaiAudioApplyMelFilterBank(spectrum, BINS, dense, FILTERS, denseEnergies) &&
+             tinyaiAudioApplySparseMelFilterBank(sparse, spectrum, sparseEnergies);
+    for (int i = 0; i < FILTERS && passed; i++) {
+        passed = fabsf(denseEnergies[i] - sparseEnergies[i]) <= 1e-4f * (1.0f + denseEnergies[i]);
+    }
+
+    /* Cosine transform of the log energies, without liftering */
+    passed = passed && tinyaiAudioComputeMFCC(denseEnergies, FILTERS, COEFFS, mfcc, 0.0f);
+    for (int k = 0; k < COEFFS && passed; k++) {
+        double sum = 0.0;
+        for (int n = 0; n < FILTERS; n++) {
+            sum += 2.0 * log(denseEnergies[n]) *
+                   cos(3.14159265358979323846 * k * (2 * n + 1) / FILTERS);
+        }
+        passed = fabs(mfcc[k] - sum) <= 1e-3 * (1.0 + fabs(sum));
+    }
+
+    if (!passed) {
+        fprintf(stderr, "Mel filter bank or MFCC results differ from direct computation\n");
+    }
+    tinyaiAudioFreeSparseMelFilterBank(sparse);
+    free(dense);
+
+    if (passed) {
+        printf("Mel filter bank test passed!\n");
+    }
+    return passed;
+}
+
+/**
+ * Test that a feature stream fed in uneven chunks matches whole-clip extraction
+ * @return true on success, false on failure
+ */
+static bool testFeatureStream()
+{
+    printf("Testing streaming feature extraction...\n");
+
+    int    numSamples = 8000;
+    float *samples    = (float *)malloc(numSamples * sizeof(float));
+    if (!samples) {
+        return false;
+    }
+    for (int i = 0; i < numSamples; i++) {
+        samples[i] = 0.5f * sinf(0.07f * i) + 0.1f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+
+    TinyAIAudioData audio;
+    memset(&audio, 0, sizeof(audio));
+    audio.data                 = samples;
+    audio.dataSize             = numSamples * sizeof(float);
+    audio.format.sampleRate    = 16000;
+    audio.format.channels      = 1;
+    audio.format.bitsPerSample = 32;
+
+    TinyAIAudioFeaturesConfig config;
+    memset(&config, 0, sizeof(config));
+    config.type            = TINYAI_AUDIO_FEATURES_MFCC;
+    config.frameLength     = 400;
+    config.frameShift      = 160;
+    config.numFilters      = 26;
+    config.numCoefficients = 13;
+    config.preEmphasis     = 0.97f;
+
+    TinyAIAudioFeatures features;
+    if (!tinyaiAudioExtractMFCC(&audio, &config, NULL, &features)) {
+        fprintf(stderr, "Failed to extract MFCC features\n");
+        free(samples);
+        return false;
+    }
+
+    /* A stream holding only two frames forces pushes to stop and resume */
+    TinyAIAudioFeatureStream *stream = tinyaiAudioFeatureStreamCreate(&config, NULL, 16000, 2);
+    bool                      passed = stream != NULL;
+    int                       frames = 0;
+    float                     frame[2 * 13];
+    for (int offset = 0, chunk = 1; passed && offset < numSamples; chunk = chunk * 3 % 997) {
+        int length   = offset + chunk < numSamples ? chunk : numSamples - offset;
+        int consumed = tinyaiAudioFeatureStreamPush(stream, samples + offset, length);
+        passed       = consumed >= 0;
+        offset += consumed;
+
+        int popped;
+        while (passed && (popped = tinyaiAudioFeatureStreamPop(stream, frame, 2)) > 0) {
+            for (int i = 0; i < popped * 13 && passed; i++) {
+                float expected = features.data[(frames + i / 13) * features.numFeatures + i % 13];
+                passed         = frames + i / 13 < features.numFrames &&
+                         fabsf(frame[i] - expected) <= 1e-3f * (1.0f + fabsf(expected));
+            }
+            frames += popped;
+        }
+    }
+    if (passed && frames != features.numFrames) {
+        passed = false;
+    }
+    if (!passed) {
+        fprintf(stderr, "Streamed features differ from whole-clip features\n");
+    }
+
+    tinyaiAudioFeatureStreamFree(stream);
+    tinyaiAudioFeaturesFree(&features);
+    free(samples);
+
+    if (passed) {
+        printf("Streaming feature extraction test passed!\n");
+    }
+    return passed;
+}
+
+/**
+ * Test the polyphase resampler: chunked streams, passband and aliasing
+ * @return true on success, false on failure
+ */
+static bool testResampler()
+{
+    printf("Testing resampler...\n");
+
+    const int rates[3][2] = {{44100, 16000}, {48000, 16000}, {8000, 16000}};
+    bool      passed      = true;
+    for (int r = 0; r < 3 && passed; r++) {
+        int inputRate  = rates[r][0];
+        int outputRate = rates[r][1];
+        int numSamples = inputRate / 4;
+
+        /* A 1 kHz tone, which passes, plus one above the output's Nyquist rate, which must not */
+        float  high    = inputRate > outputRate ? 0.4f * inputRate : 0.0f;
+        float *samples = (float *)malloc(numSamples * sizeof(float));
+        if (!samples) {
+            return false;
+        }
+        for (int i = 0; i < numSamples; i++) {
+            samples[i] = 0.5f * sinf(2.0f * 3.14159265f * 1000.0f * i / inputRate) +
+                         0.5f * sinf(2.0f * 3.14159265f * high * i / inputRate);
+        }
+
+        TinyAIAudioData audio;
+        memset(&audio, 0, sizeof(audio));
+        audio.data                 = samples;
+        audio.dataSize             = numSamples * sizeof(float);
+        audio.format.sampleRate    = inputRate;
+        audio.format.channels      = 1;
+        audio.format.bitsPerSample = 32;
+
+        TinyAIAudioData resampled;
+        memset(&resampled, 0, sizeof(resampled));
+        passed             = tinyaiAudioResample(&audio, &resampled, outputRate);
+        int          count = passed ? (int)(resampled.dataSize / sizeof(float)) : 0;
+        const float *whole = (const float *)resampled.data;
+        passed = passed && count == (int)(numSamples * ((double)outputRate / inputRate));
+
+        /* Away from the edges, the output is the 1 kHz tone alone */
+        for (int i = count / 8; i < count - count / 8 && passed; i++) {
+            float expected = 0.5f * sinf(2.0f * 3.14159265f * 1000.0f * i / outputRate);
+            passed         = fabsf(whole[i] - expected) < 0.02f;
+        }
+
+        /* Chunks of uneven length resample to the same stream */
+        TinyAIAudioResampler *resampler = tinyaiAudioResamplerCreate(inputRate, outputRate);
+        float *chunked = (float *)malloc((count + 2 * tinyaiAudioResamplerMaxOutput(resampler, 0) +
+                                          tinyaiAudioResamplerMaxOutput(resampler, 997)) *
+                                         sizeof(float));
+        passed         = passed && resampler && chunked;
+        int produced   = 0;
+        for (int offset = 0, chunk = 1; passed && offset < numSamples; chunk = chunk * 7 % 997) {
+            int length = offset + chunk < numSamples ? chunk : numSamples - offset;
+            int n = tinyaiAudioResamplerProcess(resampler, samples + offset, length,
+                                                chunked + produced);
+            passed = n >= 0;
+            produced += n;
+            offset += length;
+        }
+        produced += passed ? tinyaiAudioResamplerFlush(resampler, chunked + produced) : 0;
+        passed = passed && produced >= count && produced <= count + 1;
+        for (int i = 0; i < count && passed; i++) {
+            passed = fabsf(chunked[i] - whole[i]) <= 1e-5f;
+        }
+
+        tinyaiAudioResamplerFree(resampler);
+        free(chunked);
+        free(resampled.data);
+        free(samples);
+        if (!passed) {
+            fprintf(stderr, "Resampling from %d Hz to %d Hz failed\n", inputRate, outputRate);
+        }
+    }
+
+    if (passed) {
+        printf("Resampler test passed!\n");
+    }
+    return passed;
+}
+
+/**
+ * Test batch extraction into a feature store against streaming each file
+ * @return true on success, false on failure
+ */
+static bool testFeatureStore()
+{
+    printf("Testing batch feature extraction...\n");
+
+    /* Three recordings of different lengths, and one that does not exist */
+    const char *paths[4]     = {"test_store_0.wav", "test_store_1.wav", "missing.wav",
+                                "test_store_2.wav"};
+    const int   durations[4] = {700, 1300, 0, 20};
+    for (int i = 0; i < 4; i++) {
+        if (durations[i] > 0 && !createSampleAudio(paths[i], durations[i], 300.0f + 200.0f * i)) {
+            fprintf(stderr, "Failed to create sample audio\n");
+            return false;
+        }
+    }
+
+    TinyAIAudioFeaturesConfig config;
+    memset(&config, 0, sizeof(config));
+    config.type            = TINYAI_AUDIO_FEATURES_MFCC;
+    config.frameLength     = 400;
+    config.frameShift      = 160;
+    config.numFilters      = 26;
+    config.numCoefficients = 13;
+
+    /* Two recordings in flight, so the batch runs in groups */
+    const char *storePath = "test_features.store";
+    int stored = tinyaiAudioBuildFeatureStore(paths, 4, &config, NULL, 16000, 2, storePath);
+    TinyAIAudioFeatureStore *store  = stored == 3 ? tinyaiAudioFeatureStoreOpen(storePath) : NULL;
+    bool                     passed = store != NULL &&
+                  tinyaiAudioFeatureStoreNumRecordings(store) == 4 &&
+                  tinyaiAudioFeatureStoreFeatureSize(store) == 13;
+
+    TinyAIAudioFeatureStream *stream = tinyaiAudioFeatureStreamCreate(&config, NULL, 16000, 1);
+    passed                           = passed && stream != NULL;
+    for (int i = 0; passed && i < 4; i++) {
+        const float *frames;
+        int          numFrames;
+        bool         found = tinyaiAudioFeatureStoreGetRecording(store, i, &frames, &numFrames);
+        if (durations[i] == 0) {
+            passed = !found;
+            continue;
+        }
+
+        /* Each frame of the store matches the frame streamed from the loaded file */
+        TinyAIAudioData audio;
+        passed = found && tinyaiAudioDataLoad(paths[i], &audio);
+        if (!passed) {
+            break;
+        }
+        const float *samples    = (const float *)audio.data;
+        int          numSamples = (int)(audio.dataSize / sizeof(float));
+        int          expected   = numSamples >= 400 ? (numSamples - 400) / 160 + 1 : 0;
+        passed                  = numFrames == expected;
+
+        float frame[13];
+        int   pushed = 0;
+        tinyaiAudioFeatureStreamReset(stream);
+        for (int f = 0; passed && f < numFrames; f++) {
+            while (tinyaiAudioFeatureStreamPop(stream, frame, 1) == 0) {
+                pushed += tinyaiAudioFeatureStreamPush(stream, samples + pushed,
+                                                       numSamples - pushed);
+            }
+            for (int c = 0; c < 13 && passed; c++) {
+                passed = fabsf(frames[f * 13 + c] - frame[c]) <= 1e-5f * (1.0f + fabsf(frame[c]));
+            }
+        }
+        tinyaiAudioDataFree(&audio);
+    }
+    tinyaiAudioFeatureStreamFree(stream);
+    tinyaiAudioFeatureStoreClose(store);
+
+    /* Resampling to half the rate halves the frames per second */
+    if (passed) {
+        stored = tinyaiAudioBuildFeatureStore(paths, 2, &config, NULL, 8000, 0, storePath);
+        store  = stored == 2 ? tinyaiAudioFeatureStoreOpen(storePath) : NULL;
+        const float *frames;
+        int          numFrames;
+        passed = store != NULL && tinyaiAudioFeatureStoreGetRecording(store, 1, &frames,
+                                                                      &numFrames) &&
+                 numFrames == (1300 * 8 - 400) / 160 + 1;
+        tinyaiAudioFeatureStoreClose(store);
+    }
+    if (!passed) {
+        fprintf(stderr, "Feature store differs from streamed features\n");
+    }
+
+    remove(storePath);
+    for (int i = 0; i < 4; i++) {
+        if (durations[i] > 0) {
+            remove(paths[i]);
+        }
+    }
+
+    if (passed) {
+        printf("Batch feature extraction test passed!\n");
+    }
+    return passed;
+}
+
+/* Write a little-endian integer of the given number of bytes */
+static void writeLE(FILE *fp, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        fputc((int)((value >> (8 * i)) & 0xFF), fp);
+    }
+}
+
+/**
+ * Write a PCM WAV file with an odd-sized chunk ahead of the format
+ * @return true on success, false on failure
+ */
+static bool writeTestWav(const char *filename, int channels, int bits, const uint8_t *data,
+                         uint32_t size)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        return false;
+    }
+    fwrite("RIFF", 1, 4, fp);
+    writeLE(fp, 4 + 12 + 24 + 8 + size, 4);
+    fwrite("WAVE", 1, 4, fp);
+    fwrite("LIST", 1, 4, fp);
+    writeLE(fp, 3, 4);
+    fwrite("abc\0", 1, 4, fp); /* Three bytes and the pad byte */
+    fwrite("fmt ", 1, 4, fp);
+    writeLE(fp, 16, 4);
+    writeLE(fp, 1, 2);
+    writeLE(fp, (uint32_t)channels, 2);
+    writeLE(fp, 16000, 4);
+    writeLE(fp, 16000u * channels * bits / 8, 4);
+    writeLE(fp, (uint32_t)(channels * bits / 8), 2);
+    writeLE(fp, (uint32_t)bits, 2);
+    fwrite("data", 1, 4, fp);
+    writeLE(fp, size, 4);
+    bool ok = fwrite(data, 1, size, fp) == size;
+    return fclose(fp) == 0 && ok;
+}
+
+/**
+ * Test streaming WAV reading
+ * @return true on success, false on failure
+ */
+static bool testWavReader()
+{
+    printf("Testing WAV reader...\n");
+
+    /* Stereo 16-bit and mono 24-bit files of the same ramp */
+    enum { FRAMES = 1000 };
+    int16_t stereo[FRAMES * 2];
+    uint8_t packed[FRAMES * 3];
+    float   expected16[FRAMES];
+    float   expected24[FRAMES];
+    for (int i = 0; i < FRAMES; i++) {
+        stereo[2 * i]     = (int16_t)(i * 61 - 30000);
+        stereo[2 * i + 1] = (int16_t)(20000 - i * 37);
+        expected16[i]     = ((float)stereo[2 * i] + stereo[2 * i + 1]) / 65536.0f;
+
+        int32_t value     = (i * 16001) - 8000000;
+        packed[3 * i]     = (uint8_t)(value & 0xFF);
+        packed[3 * i + 1] = (uint8_t)((value >> 8) & 0xFF);
+        packed[3 * i + 2] = (uint8_t)((value >> 16) & 0xFF);
+        expected24[i]     = (float)value / 8388608.0f;
+    }
+
+    const char  *paths[2]    = {"test_reader_16.wav", "test_reader_24.wav"};
+    const float *expected[2] = {expected16, expected24};
+    bool passed = writeTestWav(paths[0], 2, 16, (const uint8_t *)stereo, sizeof(stereo)) &&
+                  writeTestWav(paths[1], 1, 24, packed, sizeof(packed));
+
+    for (int f = 0; passed && f < 2; f++) {
+        TinyAIWavReader  *reader = tinyaiWavReaderOpen(paths[f]);
+        TinyAIAudioFormat format;
+        passed = reader != NULL && tinyaiWavReaderGetFormat(reader, &format) &&
+                 format.channels == 2 - f && format.bitsPerSample == 16 + 8 * f &&
+                 tinyaiWavReaderNumFrames(reader) == FRAMES;
+
+        /* Reads of odd sizes decode to the averaged channels */
+        float samples[FRAMES];
+        int   total = 0;
+        int   n;
+        while (passed && (n = tinyaiWavReaderRead(reader, samples + total, 7)) > 0) {
+            total += n;
+        }
+        passed = passed && total == FRAMES;
+        for (int i = 0; passed && i < FRAMES; i++) {
+            passed = fabsf(samples[i] - expected[f][i]) <= 1e-6f;
+        }
+
+        /* Seeking rereads the same frames */
+        float again[3];
+        passed = passed && tinyaiWavReaderSeek(reader, 500) &&
+                 tinyaiWavReaderRead(reader, again, 3) == 3 &&
+                 memcmp(again, samples + 500, sizeof(again)) == 0;
+        tinyaiWavReaderClose(reader);
+
+        /* Whole-file loading goes through the same decoder */
+        TinyAIAudioData audio;
+        passed = passed && tinyaiAudioDataLoad(paths[f], &audio);
+        if (passed) {
+            passed = audio.format.channels == 1 && audio.dataSize == sizeof(samples) &&
+                     memcmp(audio.data, samples, sizeof(samples)) == 0;
+            tinyaiAudioDataFree(&audio);
+        }
+    }
+    if (!passed) {
+        fprintf(stderr, "WAV reader output differs from the expected samples\n");
+    }
+
+    remove(paths[0]);
+    remove(paths[1]);
+
+    if (passed) {
+        printf("WAV reader test passed!\n");
+    }
+    return passed;
+}
+
+/* Pipeline stage that records what it receives */
+typedef struct {
+    float *samples;   /* Received samples */
+    int    received;  /* Number of received samples */
+    int    capacity;  /* Samples the buffer holds */
+    int    segments;  /* Segments ended */
+    int    holdUntil; /* Samples to receive before passing them on */
+} PipelineSink;
+
+static bool pipelineSinkProcess(void *context, const float *samples, int numSamples)
+{
+    PipelineSink *sink = (PipelineSink *)context;
+    if (sink->received + numSamples <= sink->capacity) {
+        memcpy(sink->samples + sink->received, samples, numSamples * sizeof(float));
+    }
+    sink->received += numSamples;
+    return sink->received > sink->holdUntil;
+}
+
+static void pipelineSinkEndSegment(void *context)
+{
+    ((PipelineSink *)context)->segments++;
+}
+
+/**
+ * Test the VAD-gated pipeline
+ * @return true on success, false on failure
+ */
+static bool testAudioPipeline()
+{
+    printf("Testing VAD-gated pipeline...\n");
+
+    /* Quiet noise with tones from 1.0-1.5 s and 2.5-2.8 s, in 10 ms frames */
+    enum { RATE = 16000, TOTAL = RATE * 33 / 10 };
+    float *signal = (float *)malloc(TOTAL * sizeof(float));
+    float *first  = (float *)malloc(TOTAL * sizeof(float));
+    float *second = (float *)malloc(TOTAL * sizeof(float));
+    if (!signal || !first || !second) {
+        free(signal);
+        free(first);
+        free(second);
+        return false;
+    }
+    for (int i = 0; i < TOTAL; i++) {
+        bool tone = (i >= RATE && i < RATE * 3 / 2) || (i >= RATE * 5 / 2 && i < RATE * 28 / 10);
+        signal[i] = tone ? 0.3f * sinf(2.0f * 3.14159265f * 300.0f * i / RATE)
+                         : 0.001f * ((float)rand() / RAND_MAX * 2.0f - 1.0f);
+    }
+
+    /* Frame by frame, then in bursts that do not divide the segments */
+    bool passed = true;
+    for (int burstMs = 0; passed && burstMs <= 70; burstMs += 70) {
+        TinyAIAudioPipelineConfig config;
+        tinyaiAudioPipelineInitConfig(&config);
+        config.burstMs                = burstMs;
+        TinyAIAudioPipeline *pipeline = tinyaiAudioPipelineCreate(&config);
+
+        /* The first stage holds back its first segment from the second */
+        PipelineSink sinks[2] = {{first, 0, TOTAL, 0, 16000}, {second, 0, TOTAL, 0, 0}};
+        TinyAIAudioPipelineStage stages[2];
+        for (int i = 0; i < 2; i++) {
+            stages[i].process    = pipelineSinkProcess;
+            stages[i].endSegment = pipelineSinkEndSegment;
+            stages[i].context    = &sinks[i];
+        }
+        passed = pipeline != NULL && tinyaiAudioPipelineAddStage(pipeline, &stages[0]) &&
+                 tinyaiAudioPipelineAddStage(pipeline, &stages[1]);
+
+        /* Pushes of odd sizes, cutting across frames */
+        int pushedOn = 0;
+        for (int i = 0; passed && i < TOTAL; i += 777) {
+            int n = TOTAL - i < 777 ? TOTAL - i : 777;
+            int m = tinyaiAudioPipelinePush(pipeline, signal + i, n);
+            passed = m >= 0;
+            pushedOn += m;
+        }
+        passed = passed && tinyaiAudioPipelineFlush(pipeline) == 0;
+
+        /*
+         * Each segment is 20 frames of pre-roll, the tone, and 30 frames of
+         * hangover: frames 80-179 and 230-309, passed on as contiguous audio
+         */
+        int64_t framesTotal  = 0;
+        int64_t framesPassed = 0;
+        passed = passed && tinyaiAudioPipelineGetStats(pipeline, &framesTotal, &framesPassed) &&
+                 framesTotal == 330 && framesPassed == 180 && pushedOn == 180 * 160 &&
+                 sinks[0].received == 180 * 160 && sinks[0].segments == 2 &&
+                 sinks[1].received == 80 * 160 && sinks[1].segments == 2 &&
+                 memcmp(first, signal + 80 * 160, 100 * 160 * sizeof(float)) == 0 &&
+                 memcmp(first + 100 * 160, signal + 230 * 160, 80 * 160 * sizeof(float)) == 0 &&
+                 memcmp(second, signal + 230 * 160, 80 * 160 * sizeof(float)) == 0;
+        if (!passed) {
+            fprintf(stderr, "Pipeline with %d ms bursts passed on %d samples in %d segments\n",
+                    burstMs, sinks[0].received, sinks[0].segments);
+        }
+
+        tinyaiAudioPipelineFree(pipeline);
+    }
+    free(signal);
+    free(first);
+    free(second);
+
+    if (passed) {
+        printf("VAD-gated pipeline test passed!\n");
+    }
+    return passed;
+}
+
 /**
  * Test audio model creation and processing
  * @return true on success, false on failure
@@ -216,6 +825,120 @@ static bool testAudioModel()
     return true;
 }
 
+/**
+ * Check that a batch matches processing its clips one at a time
+ * @param config Model configuration
+ * @param clips Audio clips
+ * @param count Number of clips
+ * @return true on success, false on failure
+ */
+static bool checkModelBatch(const TinyAIAudioModelConfig *config, const TinyAIAudioData *clips,
+                            int count)
+{
+    TinyAIAudioModel *model = tinyaiAudioModelCreate(config);
+    if (!model) {
+        fprintf(stderr, "Failed to create audio model\n");
+        return false;
+    }
+
+    TinyAIAudioModelOutput batch[3];
+    TinyAIAudioModelOutput single;
+    memset(batch, 0, sizeof(batch));
+    memset(&single, 0, sizeof(single));
+
+    bool passed = tinyaiAudioModelProcessBatch(model, clips, count, batch);
+    for (int i = 0; passed && i < count; i++) {
+        float sum = 0.0f;
+        for (int c = 0; c < config->numClasses; c++) {
+            sum += batch[i].probabilities[c];
+        }
+
+        passed = tinyaiAudioModelProcess(model, &clips[i], &single) &&
+                 fabsf(sum - 1.0f) < 1e-4f && single.predictedClass == batch[i].predictedClass &&
+                 memcmp(single.probabilities, batch[i].probabilities,
+                        config->numClasses * sizeof(float)) == 0;
+        if (!passed) {
+            fprintf(stderr, "Batch clip %d differs from processing it alone\n", i);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        tinyaiAudioModelOutputFree(&batch[i]);
+    }
+    tinyaiAudioModelOutputFree(&single);
+    tinyaiAudioModelFree(model);
+    return passed;
+}
+
+/**
+ * Test batched audio model processing against single clips
+ * @return true on success, false on failure
+ */
+static bool testAudioModelBatch()
+{
+    printf("Testing batched audio model processing...\n");
+
+    /* Clips of different lengths, one spanning several chunks of frames */
+    const int         lengths[3] = {3200, 16000, 8800};
+    TinyAIAudioData   clips[3];
+    TinyAIAudioFormat format;
+    format.sampleRate    = 16000;
+    format.channels      = 1;
+    format.bitsPerSample = 32; /* Float samples */
+
+    memset(clips, 0, sizeof(clips));
+    bool passed = true;
+    for (int i = 0; passed && i < 3; i++) {
+        float *samples = (float *)malloc(lengths[i] * sizeof(float));
+        if (!samples) {
+            passed = false;
+            break;
+        }
+        for (int s = 0; s < lengths[i]; s++) {
+            samples[s] = 0.4f * sinf(2.0f * 3.14159f * (300.0f + 250.0f * i) * s / 16000.0f);
+        }
+        passed = tinyaiAudioCreateFromSamples(samples, lengths[i], &format, &clips[i]);
+        free(samples);
+    }
+
+    TinyAIAudioModelConfig config;
+    memset(&config, 0, sizeof(config));
+    config.featuresConfig.type            = TINYAI_AUDIO_FEATURES_MFCC;
+    config.featuresConfig.frameLength     = 400;
+    config.featuresConfig.frameShift      = 160;
+    config.featuresConfig.numFilters      = 26;
+    config.featuresConfig.numCoefficients = 13;
+    config.featuresConfig.includeDelta    = true;
+    config.hiddenSize                     = 48;
+    config.numLayers                      = 3;
+    config.numClasses                     = 10;
+    config.useSIMD                        = true;
+
+    /* Float weights, 4-bit weights, then 4-bit weights with int8 activations */
+    if (passed) {
+        config.use4BitQuantization = false;
+        passed                     = checkModelBatch(&config, clips, 3);
+    }
+    if (passed) {
+        config.use4BitQuantization = true;
+        passed                     = checkModelBatch(&config, clips, 3);
+    }
+    if (passed) {
+        tinyaiSetActivationPrecision(TINYAI_PRECISION_INT8);
+        passed = checkModelBatch(&config, clips, 3);
+        tinyaiSetActivationPrecision(TINYAI_PRECISION_FP32);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        tinyaiAudioDataFree(&clips[i]);
+    }
+
+    if (passed) {
+        printf("Batched audio model test passed!\n");
+    }
+    return passed;
+}
+
 /**
  * Main test function
  */
@@ -228,13 +951,32 @@ int main(int argc, char *argv[])
     srand((unsigned int)time(NULL));
 
     /* Run tests */
+    bool fftResult      = testFFT();
+    bool melResult      = testMelFilterBank();
+    bool streamResult   = testFeatureStream();
+    bool resampleResult = testResampler();
+    bool storeResult    = testFeatureStore();
+    bool readerResult   = testWavReader();
+    bool pipelineResult = testAudioPipeline();
     bool featuresResult = testAudioFeatures();
     bool modelResult    = testAudioModel();
+    bool batchResult    = testAudioModelBatch();
 
     /* Print overall result */
     printf("\nTest Results:\n");
+    printf("  FFT: %s\n", fftResult ? "PASSED" : "FAILED");
+    printf("  Mel Filter Bank: %s\n", melResult ? "PASSED" : "FAILED");
+    printf("  Feature Stream: %s\n", streamResult ? "PASSED" : "FAILED");
+    printf("  Resampler: %s\n", resampleResult ? "PASSED" : "FAILED");
+    printf("  Feature Store: %s\n", storeResult ? "PASSED" : "FAILED");
+    printf("  WAV Reader: %s\n", readerResult ? "PASSED" : "FAILED");
+    printf("  Pipeline: %s\n", pipelineResult ? "PASSED" : "FAILED");
     printf("  Audio Features: %s\n", featuresResult ? "PASSED" : "FAILED");
     printf("  Audio Model: %s\n", modelResult ? "PASSED" : "FAILED");
+    printf("  Model Batch: %s\n", batchResult ? "PASSED" : "FAILED");
 
-    return (featuresResult && modelResult) ? 0 : 1;
+    return (fftResult && melResult && streamResult && resampleResult && storeResult &&
+            readerResult && pipelineResult && featuresResult && modelResult && batchResult)
+               ? 0
+               : 1;
 }
@@ -318,6 +318,114 @@ void test_cache_info(void)
     }
 }
 
+/**
+ * Test autotuning and the tuning file
+ * @return 0 on success, 1 on failure
+ */
+int test_autotune(void)
+{
+    printf("\n=== Testing Cache Optimization Autotuning ===\n");
+
+    const char *path = "test_cache_tuning.txt";
+    char        cpu[128];
+    int         failures = 0;
+
+    tinyai_get_cpu_model(cpu, sizeof(cpu));
+    printf("CPU model: %s\n", cpu);
+
+    /* Another host type's entry in the file must survive, and not be loaded here */
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fprintf(fp, "Other_CPU_Model matmul 96 80 64 8 8 0 1\n");
+        fclose(fp);
+    }
+
+    TinyAICacheOptConfig matmul, conv;
+    if (!tinyai_cache_opt_autotune_matrix_multiply(96, 80, 64, &matmul) ||
+        !tinyai_cache_opt_autotune_convolution(20, 18, 4, 3, 24, &conv)) {
+        printf("FAIL: Autotuning failed\n");
+        return 1;
+    }
+    printf("Tuned matmul: %zux%zu blocks, prefetch %d, tiling %s\n", matmul.blockSizeX,
+           matmul.blockSizeY, matmul.prefetchDistance, matmul.enableTiling ? "on" : "off");
+    printf("Tuned conv: %zux%zu blocks, prefetch %d, tiling %s\n", conv.blockSizeX,
+           conv.blockSizeY, conv.prefetchDistance, conv.enableTiling ? "on" : "off");
+    if (matmul.enableTiling && (matmul.blockSizeX > 96 || matmul.blockSizeY > 80)) {
+        printf("FAIL: Matrix blocks exceed the shape\n");
+        failures++;
+    }
+    if (conv.enableTiling && (conv.blockSizeX > 18 || conv.blockSizeY > 16)) {
+        printf("FAIL: Convolution blocks exceed the output\n");
+        failures++;
+    }
+
+    /* Tuned shapes are used by the regular lookups */
+    TinyAICacheOptConfig lookup = tinyai_cache_opt_init_default();
+    tinyai_cache_opt_matrix_multiply(96, 80, 64, &lookup);
+    if (lookup.blockSizeX != matmul.blockSizeX || lookup.blockSizeY != matmul.blockSizeY ||
+        lookup.prefetchDistance != matmul.prefetchDistance) {
+        printf("FAIL: Lookup ignores the tuned matrix shape\n");
+        failures++;
+    }
+
+    /* The streaming prefetch distance is tuned once per CPU and cached */
+    int stream = -1;
+    if (!tinyai_cache_opt_autotune_stream_prefetch(&stream) || stream < 0) {
+        printf("FAIL: Stream prefetch autotuning failed\n");
+        failures++;
+    }
+    printf("Tuned stream prefetch: %d bytes\n", stream);
+    if (tinyai_cache_opt_stream_prefetch() != stream) {
+        printf("FAIL: Lookup ignores the tuned stream prefetch\n");
+        failures++;
+    }
+
+    /* Saved and reloaded shapes match, and other CPUs' entries are kept */
+    if (!tinyai_cache_opt_save_tuning(path)) {
+        printf("FAIL: Tuning file not saved\n");
+        failures++;
+    }
+    tinyai_cache_opt_clear_tuning();
+    int loaded = tinyai_cache_opt_load_tuning(path);
+    if (loaded != 3) {
+        printf("FAIL: Loaded %d tuned shapes, expected 3\n", loaded);
+        failures++;
+    }
+    if (tinyai_cache_opt_stream_prefetch() != stream) {
+        printf("FAIL: Reloaded stream prefetch differs\n");
+        failures++;
+    }
+    lookup = tinyai_cache_opt_init_default();
+    tinyai_cache_opt_convolution(20, 18, 4, 3, 24, &lookup);
+    if (lookup.blockSizeX != conv.blockSizeX || lookup.blockSizeY != conv.blockSizeY ||
+        lookup.prefetchDistance != conv.prefetchDistance ||
+        lookup.enableTiling != conv.enableTiling) {
+        printf("FAIL: Reloaded convolution shape differs\n");
+        failures++;
+    }
+
+    char line[256];
+    bool otherKept = false;
+    fp             = fopen(path, "r");
+    while (fp && fgets(line, sizeof(line), fp)) {
+        otherKept = otherKept || strncmp(line, "Other_CPU_Model ", 16) == 0;
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    if (!otherKept) {
+        printf("FAIL: Other CPU entries were dropped\n");
+        failures++;
+    }
+
+    remove(path);
+    tinyai_cache_opt_clear_tuning();
+    if (failures == 0) {
+        printf("PASS: Autotuned shapes are measured, saved and reloaded\n");
+    }
+    return failures ? 1 : 0;
+}
+
 /**
  * Main function
  */
@@ -334,7 +442,10 @@ int main(void)
     /* Test transpose */
     test_transpose();
 
+    /* Test autotuning */
+    int failed = test_autotune();
+
     printf("\nAll cache optimization tests completed.\n");
 
-    return 0;
+    return failed;
 }
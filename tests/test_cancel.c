@@ -0,0 +1,133 @@
+/**
+ * TinyAI Cancellation Token Tests
+ */
+
+#include "../utils/cancel.h"
+#include "../utils/thread_pool.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TEST_COUNT 64
+
+// Token each iteration saw installed, and whether it ran
+typedef struct {
+    TinyAICancelToken *seen[TEST_COUNT];
+    bool               ran[TEST_COUNT];
+} RangeLog;
+
+static void log_range(void *context, size_t begin, size_t end)
+{
+    RangeLog *log = (RangeLog *)context;
+    for (size_t i = begin; i < end; i++) {
+        log->seen[i] = tinyaiCurrentCancelToken();
+        log->ran[i]  = true;
+    }
+}
+
+static void log_group_task(void *context)
+{
+    log_range(context, 0, 1);
+}
+
+// Test cancelling, deadlines, resets and the thread's installed token
+static void test_token_state()
+{
+    printf("  Testing cancellation token state...\n");
+
+    TinyAICancelToken *token = tinyaiCreateCancelToken();
+    ASSERT(token != NULL, "Token should be created");
+    ASSERT(!tinyaiCancelRequested(token), "A new token should not be cancelled");
+    ASSERT(!tinyaiCancelRequested(NULL), "A missing token should never be cancelled");
+
+    tinyaiCancel(token);
+    ASSERT(tinyaiCancelRequested(token), "A cancelled token should report it");
+    tinyaiResetCancelToken(token);
+    ASSERT(!tinyaiCancelRequested(token), "A reset token should run again");
+
+    tinyaiCancelAfter(token, 60000);
+    ASSERT(!tinyaiCancelRequested(token), "A distant deadline should not have passed");
+    tinyaiCancelAfter(token, 0);
+    tinyaiCancelAfter(token, 1);
+    for (int spin = 0; !tinyaiCancelRequested(token); spin++) {
+        ASSERT(spin < 100000000, "A near deadline should pass");
+    }
+    tinyaiCancelAfter(token, 0);
+    ASSERT(!tinyaiCancelRequested(token), "Removing the deadline should uncancel the token");
+
+    // Tokens nest on a thread and restore in reverse
+    TinyAICancelToken *inner = tinyaiCreateCancelToken();
+    ASSERT(inner != NULL, "Token should be created");
+    ASSERT(tinyaiCurrentCancelToken() == NULL && !tinyaiCancelled(), "No token should be set");
+    TinyAICancelToken *outer = tinyaiUseCancelToken(token);
+    TinyAICancelToken *saved = tinyaiUseCancelToken(inner);
+    ASSERT(saved == token && tinyaiCurrentCancelToken() == inner, "Tokens should nest");
+    tinyaiCancel(inner);
+    ASSERT(tinyaiCancelled(), "The installed token should be checked");
+    tinyaiUseCancelToken(saved);
+    ASSERT(!tinyaiCancelled(), "The outer token should be back");
+    tinyaiUseCancelToken(outer);
+    ASSERT(tinyaiCurrentCancelToken() == NULL, "No token should be left installed");
+
+    tinyaiDestroyCancelToken(inner);
+    tinyaiDestroyCancelToken(token);
+    tinyaiDestroyCancelToken(NULL);
+    printf("  Cancellation token state passed.\n");
+}
+
+// Test that parallel loops carry the token to workers and skip ranges once cancelled
+static void test_parallel_cancel()
+{
+    printf("  Testing cancelled parallel loops...\n");
+
+    TinyAIThreadPool  *pool  = tinyaiCreateThreadPool(4, 1);
+    TinyAICancelToken *token = tinyaiCreateCancelToken();
+    ASSERT(pool != NULL && token != NULL, "Pool and token should be created");
+
+    RangeLog log;
+    memset(&log, 0, sizeof(log));
+    TinyAICancelToken *previous = tinyaiUseCancelToken(token);
+    tinyaiParallelFor(pool, TEST_COUNT, 1, log_range, &log);
+    for (int i = 0; i < TEST_COUNT; i++) {
+        ASSERT(log.ran[i] && log.seen[i] == token, "Every range should run under the token");
+    }
+
+    // The caller's own range runs; the queued ones are skipped
+    memset(&log, 0, sizeof(log));
+    tinyaiCancel(token);
+    tinyaiParallelFor(pool, TEST_COUNT, 1, log_range, &log);
+    ASSERT(log.ran[0], "The caller's range should run");
+    ASSERT(!log.ran[TEST_COUNT - 1], "Queued ranges of a cancelled loop should be skipped");
+
+    // Group tasks still run, under the token of the thread that queued them
+    memset(&log, 0, sizeof(log));
+    TinyAITaskGroup *group = tinyaiCreateTaskGroup(pool);
+    ASSERT(group != NULL, "Task group should be created");
+    tinyaiTaskGroupRun(group, log_group_task, &log, TINYAI_AFFINITY_ANY);
+    tinyaiTaskGroupWait(group);
+    tinyaiDestroyTaskGroup(group);
+    ASSERT(log.ran[0] && log.seen[0] == token, "A group task should run under the token");
+    tinyaiUseCancelToken(previous);
+
+    tinyaiDestroyCancelToken(token);
+    tinyaiDestroyThreadPool(pool);
+    printf("  Cancelled parallel loops passed.\n");
+}
+
+void run_cancel_tests()
+{
+    printf("--- Running Cancellation Tests ---\n");
+    test_token_state();
+    test_parallel_cancel();
+    printf("--- Cancellation Tests Finished ---\n");
+}
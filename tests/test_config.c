@@ -0,0 +1,124 @@
+/**
+ * TinyAI Configuration Tests
+ */
+
+#include "../core/config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+static void test_config_store()
+{
+    printf("  Testing config store...\n");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config should initialize");
+
+    // Typed values convert on read
+    ASSERT(tinyaiConfigSetInt("a.int", 42) == 0, "Int should be set");
+    ASSERT(tinyaiConfigSetFloat("a.float", 2.5f) == 0, "Float should be set");
+    ASSERT(tinyaiConfigSetBool("a.bool", 1) == 0, "Bool should be set");
+    ASSERT(tinyaiConfigSetString("a.string", "17") == 0, "String should be set");
+    ASSERT(tinyaiConfigGetInt("a.int", 0) == 42, "Int should read back");
+    ASSERT(tinyaiConfigGetInt("a.float", 0) == 2, "Float should read as int");
+    ASSERT(tinyaiConfigGetFloat("a.string", 0.0f) == 17.0f, "String should read as float");
+    ASSERT(strcmp(tinyaiConfigGetString("a.bool", ""), "true") == 0, "Bool should read as string");
+    ASSERT(tinyaiConfigGetInt("a.missing", -1) == -1, "Missing keys give the default");
+
+    // Changing a string key to another type and back
+    ASSERT(tinyaiConfigSetInt("a.string", 5) == 0, "String key should take an int");
+    ASSERT(tinyaiConfigGetInt("a.string", 0) == 5, "Key should have the new type");
+    ASSERT(tinyaiConfigSetString("a.int", "text") == 0, "Int key should take a string");
+    ASSERT(strcmp(tinyaiConfigGetString("a.int", ""), "text") == 0, "Key should hold the string");
+
+    // Fill all 256 entries
+    char key[32];
+    for (int k = 0; k < 252; k++) {
+        snprintf(key, sizeof(key), "fill.%d", k);
+        ASSERT(tinyaiConfigSetInt(key, k) == 0, "Fill key should be set");
+    }
+    ASSERT(tinyaiConfigSetInt("over.limit", 1) != 0, "The store should be full");
+    for (int k = 0; k < 252; k++) {
+        snprintf(key, sizeof(key), "fill.%d", k);
+        ASSERT(tinyaiConfigGetInt(key, -1) == k, "Fill key should keep its value");
+    }
+
+    // Removed entries leave their chains and are reused
+    ASSERT(tinyaiConfigRemoveKey("fill.7") == 1, "Key should be removed");
+    ASSERT(tinyaiConfigRemoveKey("fill.7") == 0, "Key should be gone");
+    ASSERT(!tinyaiConfigHasKey("fill.7"), "Removed key should not be found");
+    ASSERT(tinyaiConfigSetInt("over.limit", 9) == 0, "A freed entry should be reused");
+    ASSERT(tinyaiConfigGetInt("over.limit", 0) == 9, "Reused entry should hold its value");
+    ASSERT(tinyaiConfigGetInt("fill.8", -1) == 8, "Neighbouring keys should be unaffected");
+
+    tinyaiConfigCleanup();
+    printf("    PASS\n");
+}
+
+static void test_config_snapshot()
+{
+    printf("  Testing config snapshots...\n");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config should initialize");
+    tinyaiConfigSetInt("server.threads", 8);
+    tinyaiConfigSetFloat("model.top_p", 0.5f);
+    tinyaiConfigSetString("model.path", "model.bin");
+    tinyaiConfigSetString("flag", "yes");
+
+    // Values are resolved to every type
+    const TinyAIConfigSnapshot *first = tinyaiConfigSnapshot();
+    ASSERT(first != NULL, "Snapshot should be built");
+    ASSERT(tinyaiConfigSnapshot() == first, "Unchanged config should reuse the snapshot");
+    ASSERT(tinyaiConfigSnapshotGetInt(first, "server.threads", 0) == 8, "Int should resolve");
+    ASSERT(tinyaiConfigSnapshotGetFloat(first, "server.threads", 0.0f) == 8.0f,
+           "Int should resolve as float");
+    ASSERT(tinyaiConfigSnapshotGetFloat(first, "model.top_p", 0.0f) == 0.5f,
+           "Float should resolve");
+    ASSERT(strcmp(tinyaiConfigSnapshotGetString(first, "server.threads", ""), "8") == 0,
+           "Int should resolve as string");
+    ASSERT(strcmp(tinyaiConfigSnapshotGetString(first, "model.path", ""), "model.bin") == 0,
+           "String should resolve");
+    ASSERT(tinyaiConfigSnapshotGetBool(first, "flag", 0) == 1, "String should resolve as bool");
+    ASSERT(tinyaiConfigSnapshotGetInt(first, "missing", -3) == -3, "Missing keys give the default");
+    ASSERT(tinyaiConfigSnapshotHasKey(first, "model.path"), "Snapshot should have the key");
+    ASSERT(tinyaiConfigSnapshotGetInt(NULL, "server.threads", 4) == 4,
+           "A missing snapshot gives the default");
+
+    // Changes publish a new snapshot; the old one stays readable and unchanged
+    tinyaiConfigSetInt("server.threads", 2);
+    tinyaiConfigRemoveKey("model.path");
+    const TinyAIConfigSnapshot *second = tinyaiConfigSnapshot();
+    ASSERT(second != NULL && second != first, "Changed config should give a new snapshot");
+    ASSERT(tinyaiConfigSnapshotGetInt(second, "server.threads", 0) == 2, "New value should show");
+    ASSERT(!tinyaiConfigSnapshotHasKey(second, "model.path"), "Removed key should be gone");
+    ASSERT(tinyaiConfigSnapshotGetInt(first, "server.threads", 0) == 8,
+           "Old snapshot is immutable");
+    ASSERT(strcmp(tinyaiConfigSnapshotGetString(first, "model.path", ""), "model.bin") == 0,
+           "Old snapshot keeps its strings");
+
+    // Explicit publishing is what readers then see
+    tinyaiConfigSetBool("flag", 0);
+    ASSERT(tinyaiConfigPublish() == 0, "Snapshot should publish");
+    const TinyAIConfigSnapshot *third = tinyaiConfigSnapshot();
+    ASSERT(tinyaiConfigSnapshotGetBool(third, "flag", 1) == 0, "Published value should show");
+    ASSERT(tinyaiConfigSnapshot() == third, "Published snapshot should be current");
+
+    tinyaiConfigCleanup();
+    printf("    PASS\n");
+}
+
+void run_config_tests()
+{
+    printf("\n--- Running Config Tests ---\n");
+    test_config_store();
+    test_config_snapshot();
+    printf("--- Config Tests Finished ---\n");
+}
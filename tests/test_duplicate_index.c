@@ -0,0 +1,266 @@
+/**
+ * TinyAI Duplicate Index Tests
+ */
+
+#include "../models/multimodal/duplicate_index.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TEST_SIZE 8
+#define TEST_PATH "test_duplicate_index.tdi"
+
+// Draw a scene of blobs, scaled to any image size, as RGB
+static void draw_scene(uint8_t *pixels, int width, int height, int seed)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float    u     = (float)x / width;
+            float    v     = (float)y / height;
+            float    value = 128.0f + 100.0f * u * (seed % 2 ? -1.0f : 1.0f);
+            uint8_t *pixel = pixels + ((size_t)y * width + x) * 3;
+
+            for (int blob = 0; blob < 4; blob++) {
+                float cx = (float)((seed * 37 + blob * 53) % 100) / 100.0f;
+                float cy = (float)((seed * 71 + blob * 29) % 100) / 100.0f;
+                if ((u - cx) * (u - cx) + (v - cy) * (v - cy) < 0.02f) {
+                    value = blob % 2 ? 20.0f : 235.0f;
+                }
+            }
+            pixel[0] = (uint8_t)value;
+            pixel[1] = (uint8_t)(value * 0.8f);
+            pixel[2] = (uint8_t)(255.0f - value);
+        }
+    }
+}
+
+static void fill_output(float *output, int seed)
+{
+    for (int i = 0; i < TEST_SIZE; i++) {
+        output[i] = (float)(seed * 10 + i);
+    }
+}
+
+// Test that resized and recoloured copies hash close together and other images far apart
+static void test_hash()
+{
+    printf("  Testing perceptual hash...\n");
+
+    uint8_t    *large = (uint8_t *)malloc(200 * 150 * 3);
+    uint8_t    *small = (uint8_t *)malloc(64 * 48 * 3);
+    uint8_t    *other = (uint8_t *)malloc(64 * 48 * 3);
+    TinyAIImage largeImage = {200, 150, TINYAI_IMAGE_FORMAT_RGB, large, false};
+    TinyAIImage smallImage = {64, 48, TINYAI_IMAGE_FORMAT_RGB, small, false};
+    TinyAIImage otherImage = {64, 48, TINYAI_IMAGE_FORMAT_RGB, other, false};
+    ASSERT(large && small && other, "Images should be allocated");
+
+    draw_scene(large, 200, 150, 3);
+    draw_scene(small, 64, 48, 3);
+    draw_scene(other, 64, 48, 4);
+
+    uint64_t hash = tinyaiDuplicateIndexHash(&largeImage);
+    ASSERT(hash == tinyaiDuplicateIndexHash(&largeImage), "Hashes should be deterministic");
+    ASSERT(hash != 0, "A scene with gradients should not hash to 0");
+    ASSERT(tinyaiDuplicateIndexDistance(hash, tinyaiDuplicateIndexHash(&smallImage)) <=
+               TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE,
+           "A resized copy should be within the default distance");
+    ASSERT(tinyaiDuplicateIndexDistance(hash, tinyaiDuplicateIndexHash(&otherImage)) >
+               TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE * 2,
+           "A different scene should be far away");
+
+    // The same pixels stored in another channel order hash alike
+    uint64_t smallHash = tinyaiDuplicateIndexHash(&smallImage);
+    for (int i = 0; i < 64 * 48; i++) {
+        uint8_t red      = small[i * 3];
+        small[i * 3]     = small[i * 3 + 2];
+        small[i * 3 + 2] = red;
+    }
+    smallImage.format = TINYAI_IMAGE_FORMAT_BGR;
+    ASSERT(tinyaiDuplicateIndexHash(&smallImage) == smallHash, "Channel order should not matter");
+
+    // Brightening every pixel keeps the gradients
+    for (int i = 0; i < 64 * 48 * 3; i++) {
+        small[i] = (uint8_t)(small[i] * 7 / 8 + 16);
+    }
+    ASSERT(tinyaiDuplicateIndexDistance(smallHash, tinyaiDuplicateIndexHash(&smallImage)) <=
+               TINYAI_DUPLICATE_INDEX_DEFAULT_DISTANCE,
+           "A recoloured copy should be within the default distance");
+
+    ASSERT(tinyaiDuplicateIndexDistance(0, ~0ULL) == 64, "Distance should count every bit");
+    ASSERT(tinyaiDuplicateIndexDistance(0x10, 0x13) == 2, "Distance should count differing bits");
+
+    free(large);
+    free(small);
+    free(other);
+    printf("  Perceptual hash passed.\n");
+}
+
+// Test that flat images of different colours are not taken for duplicates
+static void test_flat_images()
+{
+    printf("  Testing flat images...\n");
+
+    uint8_t    *black = (uint8_t *)malloc(64 * 64 * 3);
+    uint8_t    *white = (uint8_t *)malloc(64 * 64 * 3);
+    TinyAIImage blackImage = {64, 64, TINYAI_IMAGE_FORMAT_RGB, black, false};
+    TinyAIImage whiteImage = {64, 64, TINYAI_IMAGE_FORMAT_RGB, white, false};
+    ASSERT(black && white, "Images should be allocated");
+    memset(black, 0, 64 * 64 * 3);
+    memset(white, 255, 64 * 64 * 3);
+
+    // Faint noise gives a flat image gradients, but not enough spread for a shape
+    for (int i = 0; i < 64 * 64 * 3; i++) {
+        white[i] = (uint8_t)(255 - (i * 7919) % 5);
+    }
+    ASSERT(tinyaiDuplicateIndexHash(&blackImage) == 0, "A flat image should hash to 0");
+    ASSERT(tinyaiDuplicateIndexHash(&whiteImage) == 0, "A nearly flat image should hash to 0");
+
+    TinyAIDuplicateIndex *index = tinyaiCreateDuplicateIndex(NULL);
+    ASSERT(index != NULL, "Index should be created");
+    float output[TEST_SIZE];
+    float result[TEST_SIZE];
+    fill_output(output, 1);
+    ASSERT(tinyaiDuplicateIndexInsert(index, tinyaiDuplicateIndexHash(&blackImage), 7, output,
+                                      TEST_SIZE) == 0,
+           "Inserting a flat image should succeed");
+    ASSERT(tinyaiDuplicateIndexLookup(index, tinyaiDuplicateIndexHash(&whiteImage), 7, 5, result,
+                                      TEST_SIZE) < 0,
+           "Flat images of different colours should not match");
+
+    TinyAIDuplicateIndexStats stats;
+    tinyaiDuplicateIndexGetStats(index, &stats);
+    ASSERT(stats.numEntries == 0, "Flat images should not be stored");
+
+    tinyaiDestroyDuplicateIndex(index);
+    free(black);
+    free(white);
+    printf("  Flat images passed.\n");
+}
+
+// Test nearest matches, the distance limit and encoder separation
+static void test_lookup()
+{
+    printf("  Testing duplicate index lookup...\n");
+
+    TinyAIDuplicateIndex *index = tinyaiCreateDuplicateIndex(NULL);
+    ASSERT(index != NULL, "Index should be created");
+
+    float output[TEST_SIZE];
+    float result[TEST_SIZE];
+    fill_output(output, 1);
+    ASSERT(tinyaiDuplicateIndexInsert(index, 0xff00, 7, output, TEST_SIZE) == 0,
+           "Insert should succeed");
+    fill_output(output, 2);
+    ASSERT(tinyaiDuplicateIndexInsert(index, 0xff0f, 7, output, TEST_SIZE) == 0,
+           "Insert should succeed");
+
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0xff00, 7, 5, result, TEST_SIZE) == 0,
+           "The same hash should match at distance 0");
+    fill_output(output, 1);
+    ASSERT(memcmp(result, output, sizeof(result)) == 0, "A hit should return the output");
+
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0xff0e, 7, 5, result, TEST_SIZE) == 1,
+           "The nearest hash should match");
+    fill_output(output, 2);
+    ASSERT(memcmp(result, output, sizeof(result)) == 0, "The nearest entry should be returned");
+
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0x00ff, 7, 5, result, TEST_SIZE) < 0,
+           "Hashes beyond the distance should miss");
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0xff00, 8, 5, result, TEST_SIZE) < 0,
+           "Another encoder should miss");
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0xff00, 7, 5, result, TEST_SIZE - 1) < 0,
+           "Another size should miss");
+
+    TinyAIDuplicateIndexStats stats;
+    tinyaiDuplicateIndexGetStats(index, &stats);
+    ASSERT(stats.exactHits == 1 && stats.nearHits == 1 && stats.misses == 3,
+           "Hits and misses should be counted");
+    ASSERT(stats.numEntries == 2, "Entries should be counted");
+
+    // Enough entries to grow the arrays
+    for (int i = 0; i < 300; i++) {
+        fill_output(output, i);
+        ASSERT(tinyaiDuplicateIndexInsert(index, (uint64_t)i << 32, 9, output, TEST_SIZE) == 0,
+               "Insert should succeed");
+    }
+    ASSERT(tinyaiDuplicateIndexLookup(index, (uint64_t)299 << 32, 9, 0, result, TEST_SIZE) == 0,
+           "Every entry should survive growth");
+    fill_output(output, 299);
+    ASSERT(memcmp(result, output, sizeof(result)) == 0, "Grown entries should keep their output");
+
+    tinyaiDestroyDuplicateIndex(index);
+    printf("  Duplicate index lookup passed.\n");
+}
+
+// Test that entries outlive the index through its file, even after a torn append
+static void test_file()
+{
+    printf("  Testing duplicate index file...\n");
+
+    float output[TEST_SIZE];
+    float result[TEST_SIZE];
+    remove(TEST_PATH);
+
+    TinyAIDuplicateIndex *index = tinyaiCreateDuplicateIndex(TEST_PATH);
+    ASSERT(index != NULL, "Index should be created");
+    fill_output(output, 5);
+    ASSERT(tinyaiDuplicateIndexInsert(index, 0x1234, 3, output, TEST_SIZE) == 0,
+           "Insert should succeed");
+    tinyaiDestroyDuplicateIndex(index);
+
+    // Half a record at the end, as a crash during an append leaves it
+    FILE *file = fopen(TEST_PATH, "ab");
+    ASSERT(file != NULL, "Index file should exist");
+    fwrite(output, 1, 12, file);
+    fclose(file);
+
+    index = tinyaiCreateDuplicateIndex(TEST_PATH);
+    ASSERT(index != NULL, "A torn index should load");
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0x1235, 3, 2, result, TEST_SIZE) == 1,
+           "Loaded entries should match");
+    ASSERT(memcmp(result, output, sizeof(result)) == 0, "Loaded entries should keep their output");
+    fill_output(output, 6);
+    ASSERT(tinyaiDuplicateIndexInsert(index, 0x5678, 3, output, TEST_SIZE) == 0,
+           "Insert should succeed");
+    tinyaiDestroyDuplicateIndex(index);
+
+    index = tinyaiCreateDuplicateIndex(TEST_PATH);
+    ASSERT(index != NULL, "Index should load");
+    TinyAIDuplicateIndexStats stats;
+    tinyaiDuplicateIndexGetStats(index, &stats);
+    ASSERT(stats.numEntries == 2, "Appends after a torn record should load");
+    ASSERT(tinyaiDuplicateIndexLookup(index, 0x5678, 3, 0, result, TEST_SIZE) == 0 &&
+               memcmp(result, output, sizeof(result)) == 0,
+           "The appended entry should match");
+    tinyaiDestroyDuplicateIndex(index);
+
+    // Files that are not an index are left alone
+    file = fopen(TEST_PATH, "wb");
+    ASSERT(file != NULL, "File should be created");
+    fputs("not an index", file);
+    fclose(file);
+    ASSERT(tinyaiCreateDuplicateIndex(TEST_PATH) == NULL, "Other files should be rejected");
+
+    ASSERT(remove(TEST_PATH) == 0, "Index file should exist");
+    printf("  Duplicate index file passed.\n");
+}
+
+void run_duplicate_index_tests()
+{
+    printf("--- Running Duplicate Index Tests ---\n");
+    test_hash();
+    test_flat_images();
+    test_lookup();
+    test_file();
+    printf("--- Duplicate Index Tests Finished ---\n");
+}
@@ -0,0 +1,235 @@
+/**
+ * TinyAI Image Embedding Cache Tests
+ */
+
+#include "../models/multimodal/embedding_cache.h"
+#include "../utils/thread_pool.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TEST_DIM 16
+
+// Fill an embedding with values derived from a seed
+static void fill_embedding(float *embedding, int seed)
+{
+    for (int i = 0; i < TEST_DIM; i++) {
+        embedding[i] = (float)(seed * 100 + i);
+    }
+}
+
+// Test that keys follow the pixels, size, format and encoder of an image
+static void test_keys()
+{
+    printf("  Testing embedding cache keys...\n");
+
+    uint8_t     pixels[4 * 4 * 3];
+    TinyAIImage image = {4, 4, TINYAI_IMAGE_FORMAT_RGB, pixels, false};
+    for (size_t i = 0; i < sizeof(pixels); i++) {
+        pixels[i] = (uint8_t)(i * 7);
+    }
+
+    int      shape[2]   = {4, TEST_DIM};
+    uint64_t encoder    = tinyaiEmbeddingCacheEncoderHash("encoder.bin", shape, 2);
+    uint64_t key        = tinyaiEmbeddingCacheKey(&image, encoder);
+    uint64_t otherModel = tinyaiEmbeddingCacheEncoderHash("other.bin", shape, 2);
+
+    ASSERT(key == tinyaiEmbeddingCacheKey(&image, encoder), "Keys should be deterministic");
+    ASSERT(key != tinyaiEmbeddingCacheKey(&image, otherModel), "Encoders should change the key");
+
+    pixels[sizeof(pixels) - 1] ^= 1;
+    ASSERT(key != tinyaiEmbeddingCacheKey(&image, encoder), "Pixels should change the key");
+    pixels[sizeof(pixels) - 1] ^= 1;
+
+    image.format = TINYAI_IMAGE_FORMAT_BGR;
+    ASSERT(key != tinyaiEmbeddingCacheKey(&image, encoder), "Format should change the key");
+
+    printf("  Embedding cache keys passed.\n");
+}
+
+// Test memory hits, misses and least recently used eviction
+static void test_memory_lru()
+{
+    printf("  Testing embedding cache LRU eviction...\n");
+
+    size_t                entryBytes = TEST_DIM * sizeof(float);
+    TinyAIEmbeddingCache *cache      = tinyaiCreateEmbeddingCache(3 * entryBytes, NULL);
+    ASSERT(cache != NULL, "Cache should be created");
+
+    float embedding[TEST_DIM];
+    float result[TEST_DIM];
+    for (int key = 1; key <= 3; key++) {
+        fill_embedding(embedding, key);
+        ASSERT(tinyaiEmbeddingCacheInsert(cache, (uint64_t)key, embedding, TEST_DIM) == 0,
+               "Insert should succeed");
+    }
+
+    // Touch key 1 so key 2 becomes the least recently used
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, 1, result, TEST_DIM) == 0, "Key 1 should hit");
+    fill_embedding(embedding, 1);
+    ASSERT(memcmp(result, embedding, sizeof(result)) == 0, "Hit should return the embedding");
+
+    fill_embedding(embedding, 4);
+    ASSERT(tinyaiEmbeddingCacheInsert(cache, 4, embedding, TEST_DIM) == 0, "Insert should succeed");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, 2, result, TEST_DIM) != 0, "Key 2 should be evicted");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, 3, result, TEST_DIM) == 0, "Key 3 should remain");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, 1, result, TEST_DIM) == 0, "Key 1 should remain");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, 1, result, TEST_DIM / 2) != 0,
+           "A different size should miss");
+
+    TinyAIEmbeddingCacheStats stats;
+    tinyaiEmbeddingCacheGetStats(cache, &stats);
+    ASSERT(stats.memoryHits == 3 && stats.misses == 2, "Hits and misses should be counted");
+    ASSERT(stats.numEntries == 3 && stats.memoryUsed == 3 * entryBytes,
+           "Memory use should stay within the limit");
+
+    ASSERT(tinyaiEmbeddingCacheTrim(cache, entryBytes) == 2 * entryBytes,
+           "Trim should release two entries");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, 1, result, TEST_DIM) == 0,
+           "Trim should keep the most recent entry");
+
+    // Enough entries to grow the bucket table
+    TinyAIEmbeddingCache *large = tinyaiCreateEmbeddingCache(1000 * entryBytes, NULL);
+    ASSERT(large != NULL, "Cache should be created");
+    for (int key = 0; key < 500; key++) {
+        fill_embedding(embedding, key);
+        ASSERT(tinyaiEmbeddingCacheInsert(large, (uint64_t)key << 40, embedding, TEST_DIM) == 0,
+               "Insert should succeed");
+    }
+    for (int key = 0; key < 500; key++) {
+        fill_embedding(embedding, key);
+        ASSERT(tinyaiEmbeddingCacheLookup(large, (uint64_t)key << 40, result, TEST_DIM) == 0 &&
+                   memcmp(result, embedding, sizeof(result)) == 0,
+               "Every entry should survive growth");
+    }
+
+    tinyaiDestroyEmbeddingCache(large);
+    tinyaiDestroyEmbeddingCache(cache);
+    printf("  Embedding cache LRU eviction passed.\n");
+}
+
+// Test that the disk tier serves entries after the memory tier drops them
+static void test_disk_tier()
+{
+    printf("  Testing embedding cache disk tier...\n");
+
+    const char *directory = ".";
+    uint64_t    key       = 0x7a11ab1e5eedULL;
+    float       embedding[TEST_DIM];
+    float       result[TEST_DIM];
+    fill_embedding(embedding, 9);
+
+    TinyAIEmbeddingCache *cache = tinyaiCreateEmbeddingCache(4 * sizeof(embedding), directory);
+    ASSERT(cache != NULL, "Cache should be created");
+    ASSERT(tinyaiEmbeddingCacheInsert(cache, key, embedding, TEST_DIM) == 0,
+           "Insert should succeed");
+    tinyaiDestroyEmbeddingCache(cache);
+
+    // A new cache starts with an empty memory tier
+    cache = tinyaiCreateEmbeddingCache(4 * sizeof(embedding), directory);
+    ASSERT(cache != NULL, "Cache should be created");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, key, result, TEST_DIM) == 0, "Disk should hit");
+    ASSERT(memcmp(result, embedding, sizeof(result)) == 0, "Disk should return the embedding");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, key, result, TEST_DIM) == 0, "Memory should hit");
+    ASSERT(tinyaiEmbeddingCacheLookup(cache, key, result, TEST_DIM - 1) != 0,
+           "A different size should miss on disk");
+
+    TinyAIEmbeddingCacheStats stats;
+    tinyaiEmbeddingCacheGetStats(cache, &stats);
+    ASSERT(stats.diskHits == 1 && stats.memoryHits == 1 && stats.misses == 1,
+           "Disk hits should be counted");
+    tinyaiDestroyEmbeddingCache(cache);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/%016llx%s", directory, (unsigned long long)key,
+             TINYAI_EMBEDDING_CACHE_EXTENSION);
+    ASSERT(remove(path) == 0, "Disk tier file should exist");
+
+    printf("  Embedding cache disk tier passed.\n");
+}
+
+#define CONCURRENT_TASKS 8
+#define CONCURRENT_KEYS 64
+
+typedef struct {
+    TinyAIEmbeddingCache *cache;
+    int                   seed;
+    int                   mismatches;
+} ConcurrentTask;
+
+// Insert and look up overlapping keys from one task
+static void run_concurrent_task(void *context)
+{
+    ConcurrentTask *task = (ConcurrentTask *)context;
+    float           embedding[TEST_DIM];
+    float           result[TEST_DIM];
+
+    for (int round = 0; round < 50; round++) {
+        int key = (task->seed * 7 + round) % CONCURRENT_KEYS;
+        fill_embedding(embedding, key);
+        if (tinyaiEmbeddingCacheLookup(task->cache, (uint64_t)key, result, TEST_DIM) == 0) {
+            task->mismatches += memcmp(result, embedding, sizeof(result)) != 0;
+        }
+        else {
+            tinyaiEmbeddingCacheInsert(task->cache, (uint64_t)key, embedding, TEST_DIM);
+        }
+        if (round % 16 == 15) {
+            tinyaiEmbeddingCacheTrim(task->cache, 8 * sizeof(embedding));
+        }
+    }
+}
+
+// Test that encoders on different threads can share one cache
+static void test_concurrent_access()
+{
+    printf("  Testing concurrent embedding cache access...\n");
+
+    TinyAIThreadPool     *pool  = tinyaiCreateThreadPool(4, 1);
+    TinyAIEmbeddingCache *cache = tinyaiCreateEmbeddingCache(16 * TEST_DIM * sizeof(float), NULL);
+    ASSERT(pool != NULL && cache != NULL, "Pool and cache should be created");
+
+    ConcurrentTask   tasks[CONCURRENT_TASKS];
+    TinyAITaskGroup *group = tinyaiCreateTaskGroup(pool);
+    ASSERT(group != NULL, "Task group should be created");
+    for (int i = 0; i < CONCURRENT_TASKS; i++) {
+        tasks[i].cache      = cache;
+        tasks[i].seed       = i;
+        tasks[i].mismatches = 0;
+        tinyaiTaskGroupRun(group, run_concurrent_task, &tasks[i], TINYAI_AFFINITY_ANY);
+    }
+    tinyaiDestroyTaskGroup(group);
+
+    for (int i = 0; i < CONCURRENT_TASKS; i++) {
+        ASSERT(tasks[i].mismatches == 0, "Hits should return the stored embedding");
+    }
+
+    TinyAIEmbeddingCacheStats stats;
+    tinyaiEmbeddingCacheGetStats(cache, &stats);
+    ASSERT(stats.memoryHits + stats.misses == CONCURRENT_TASKS * 50,
+           "Every lookup should be counted");
+    ASSERT(stats.memoryUsed <= 16 * TEST_DIM * sizeof(float), "Memory use should stay bounded");
+
+    tinyaiDestroyEmbeddingCache(cache);
+    tinyaiDestroyThreadPool(pool);
+    printf("  Concurrent embedding cache access passed.\n");
+}
+
+void run_embedding_cache_tests()
+{
+    printf("--- Running Embedding Cache Tests ---\n");
+    test_keys();
+    test_memory_lru();
+    test_disk_tier();
+    test_concurrent_access();
+    printf("--- Embedding Cache Tests Finished ---\n");
+}
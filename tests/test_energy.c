@@ -0,0 +1,111 @@
+/**
+ * TinyAI Energy Profile Tests
+ */
+
+#include "../core/config.h"
+#include "../utils/energy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define COUNTER_DIR "test_energy_counter"
+#define COUNTER_FILE COUNTER_DIR "/energy_uj"
+#define RANGE_FILE COUNTER_DIR "/max_energy_range_uj"
+
+static void write_value(const char *path, unsigned long long value)
+{
+    FILE *file = fopen(path, "w");
+    ASSERT(file != NULL, "Counter file should open");
+    fprintf(file, "%llu\n", value);
+    fclose(file);
+}
+
+static void test_profile_selection()
+{
+    printf("  Testing profile selection...\n");
+
+    tinyaiConfigRemoveKey("system.profile");
+    tinyaiConfigRemoveKey("system.energy_threads");
+    ASSERT(tinyaiGetExecutionProfile() == TINYAI_PROFILE_PERFORMANCE,
+           "The performance profile should be the default");
+    ASSERT(tinyaiProfileThreads(0) == 0 && tinyaiProfileThreads(16) == 16,
+           "The performance profile should not limit threads");
+
+    tinyaiConfigSetString("system.profile", "energy");
+    ASSERT(tinyaiGetExecutionProfile() == TINYAI_PROFILE_ENERGY, "Energy profile should be read");
+    ASSERT(tinyaiProfileThreads(0) == TINYAI_ENERGY_THREADS &&
+               tinyaiProfileThreads(16) == TINYAI_ENERGY_THREADS && tinyaiProfileThreads(1) == 1,
+           "The energy profile should cap threads");
+
+    tinyaiConfigSetInt("system.energy_threads", 3);
+    ASSERT(tinyaiProfileThreads(0) == 3 && tinyaiProfileThreads(2) == 2,
+           "The energy thread cap should be configurable");
+
+    tinyaiConfigSetString("system.profile", "turbo");
+    ASSERT(tinyaiGetExecutionProfile() == TINYAI_PROFILE_PERFORMANCE,
+           "An unknown profile should fall back to performance");
+
+    tinyaiConfigRemoveKey("system.profile");
+    tinyaiConfigRemoveKey("system.energy_threads");
+    printf("  Profile selection passed.\n");
+}
+
+static void test_energy_meter()
+{
+    printf("  Testing energy meter...\n");
+
+    TinyAIEnergyMeter meter;
+    double            seconds = -1.0;
+
+    /* No counter at the configured path means no estimate */
+    tinyaiConfigSetString("system.energy_counter", COUNTER_DIR "/missing");
+    ASSERT(!tinyaiEnergyMeterStart(&meter), "A missing counter should not start");
+    ASSERT(tinyaiEnergyMeterRead(&meter, &seconds) < 0.0 && seconds >= 0.0,
+           "A meter without a counter should report no estimate but the elapsed time");
+
+#ifdef _WIN32
+    system("mkdir " COUNTER_DIR);
+#else
+    system("mkdir -p " COUNTER_DIR);
+#endif
+    tinyaiConfigSetString("system.energy_counter", COUNTER_FILE);
+
+    /* Without a range file a wrap cannot be measured */
+    remove(RANGE_FILE);
+    write_value(COUNTER_FILE, 5000000);
+    ASSERT(tinyaiEnergyMeterStart(&meter), "The counter should be read");
+    write_value(COUNTER_FILE, 7500000);
+    ASSERT(tinyaiEnergyMeterRead(&meter, NULL) == 2.5, "Energy should be the counter difference");
+    write_value(COUNTER_FILE, 1000000);
+    ASSERT(tinyaiEnergyMeterRead(&meter, NULL) < 0.0, "An unknown wrap should give no estimate");
+
+    /* With it the wrap is undone */
+    write_value(RANGE_FILE, 8000000);
+    ASSERT(tinyaiEnergyMeterStart(&meter), "The counter should be read");
+    write_value(COUNTER_FILE, 500000);
+    ASSERT(tinyaiEnergyMeterRead(&meter, NULL) == 7.5, "A wrapped counter should be undone");
+
+    remove(COUNTER_FILE);
+    remove(RANGE_FILE);
+    remove(COUNTER_DIR);
+    tinyaiConfigRemoveKey("system.energy_counter");
+    printf("  Energy meter passed.\n");
+}
+
+void run_energy_tests()
+{
+    printf("--- Running Energy Profile Tests ---\n");
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    test_profile_selection();
+    test_energy_meter();
+    printf("--- Energy Profile Tests Finished ---\n");
+}
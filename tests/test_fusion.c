@@ -0,0 +1,205 @@
+/**
+ * TinyAI Multimodal Fusion Kernel Tests
+ */
+
+#include "../models/multimodal/fusion.h"
+#include "../utils/quantize.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TEST_TOLERANCE 1e-4f
+
+// Fill a vector with deterministic values in [-1, 1)
+static void fill_features(float *features, int size, int seed)
+{
+    for (int i = 0; i < size; i++) {
+        features[i] = (float)((i * 37 + seed * 11) % 64) / 32.0f - 1.0f;
+    }
+}
+
+static float max_difference(const float *a, const float *b, int size)
+{
+    float maxDiff = 0.0f;
+    for (int i = 0; i < size; i++) {
+        float diff = fabsf(a[i] - b[i]);
+        if (diff > maxDiff) {
+            maxDiff = diff;
+        }
+    }
+    return maxDiff;
+}
+
+// Scalar reference: out[i] = sum_j softmax_j(query[i] * keys[j]) * keys[j]
+static void reference_attend(const float *query, int queryDim, const float *keys, int keyDim,
+                             float *out)
+{
+    for (int i = 0; i < queryDim; i++) {
+        float maxScore = -INFINITY;
+        for (int j = 0; j < keyDim; j++) {
+            float score = query[i] * keys[j];
+            if (score > maxScore) {
+                maxScore = score;
+            }
+        }
+        float sum = 0.0f, weighted = 0.0f;
+        for (int j = 0; j < keyDim; j++) {
+            float weight = expf(query[i] * keys[j] - maxScore);
+            sum += weight;
+            weighted += weight * keys[j];
+        }
+        out[i] = weighted / sum;
+    }
+}
+
+// Test cross-attention against the scalar reference, including multi-head splits
+static void test_cross_attention()
+{
+    printf("  Testing fusion cross-attention...\n");
+
+    const int dims[][2] = {{3, 5}, {64, 17}, {200, 130}, {1500, 40}};
+    for (size_t t = 0; t < sizeof(dims) / sizeof(dims[0]); t++) {
+        int    dim1     = dims[t][0];
+        int    dim2     = dims[t][1];
+        float *a        = (float *)malloc(dim1 * sizeof(float));
+        float *b        = (float *)malloc(dim2 * sizeof(float));
+        float *fused    = (float *)malloc((dim1 + dim2) * sizeof(float));
+        float *expected = (float *)malloc((dim1 + dim2) * sizeof(float));
+        ASSERT(a && b && fused && expected, "Allocation should succeed");
+
+        fill_features(a, dim1, 1);
+        fill_features(b, dim2, 2);
+        reference_attend(a, dim1, b, dim2, expected);
+        reference_attend(b, dim2, a, dim1, expected + dim1);
+
+        ASSERT(tinyaiFusionCrossAttention(a, dim1, b, dim2, fused, dim1 + dim2, NULL, false, true),
+               "Cross-attention should succeed");
+        ASSERT(max_difference(fused, expected, dim1 + dim2) < TEST_TOLERANCE,
+               "Cross-attention should match the reference");
+
+        free(a);
+        free(b);
+        free(fused);
+        free(expected);
+    }
+
+    float a[4], b[4], fused[8];
+    fill_features(a, 4, 1);
+    fill_features(b, 4, 2);
+    ASSERT(!tinyaiFusionCrossAttention(a, 4, b, 4, fused, 6, NULL, false, true),
+           "A fused dimension other than dim1 + dim2 should fail");
+
+    printf("  Fusion cross-attention passed.\n");
+}
+
+// Test float and 4-bit projections against a scalar matrix-vector product
+static void test_project()
+{
+    printf("  Testing fusion projection...\n");
+
+    const int inputDim  = 48;
+    const int outputDim = 20;
+    float     input[48], bias[20], output[20], expected[20];
+    float     weights[20 * 48]; // [outputDim x inputDim]
+    fill_features(input, inputDim, 3);
+    fill_features(bias, outputDim, 4);
+    fill_features(weights, outputDim * inputDim, 5);
+
+    for (int i = 0; i < outputDim; i++) {
+        expected[i] = bias[i];
+        for (int j = 0; j < inputDim; j++) {
+            expected[i] += weights[i * inputDim + j] * input[j];
+        }
+    }
+
+    ASSERT(tinyaiFusionProject(input, inputDim, output, outputDim, weights, bias, false, true),
+           "Float projection should succeed");
+    ASSERT(max_difference(output, expected, outputDim) < TEST_TOLERANCE,
+           "Float projection should match the reference");
+
+    // Quantize the transposed weights [inputDim x outputDim] and compare with their dequantized
+    // values so only the kernel, not the quantization error, is measured
+    float transposed[48 * 20];
+    for (int i = 0; i < outputDim; i++) {
+        for (int j = 0; j < inputDim; j++) {
+            transposed[j * outputDim + i] = weights[i * inputDim + j];
+        }
+    }
+    TinyAIMatrixFP32  source    = {transposed, (uint32_t)inputDim, (uint32_t)outputDim};
+    TinyAIMatrix4bit *quantized = tinyaiQuantizeFP32To4bit(&source);
+    ASSERT(quantized != NULL, "Quantization should succeed");
+    TinyAIMatrixFP32 *dequantized = tinyaiDequantize4bitToFP32(quantized);
+    ASSERT(dequantized != NULL, "Dequantization should succeed");
+
+    for (int i = 0; i < outputDim; i++) {
+        expected[i] = bias[i];
+        for (int j = 0; j < inputDim; j++) {
+            expected[i] += dequantized->data[j * outputDim + i] * input[j];
+        }
+    }
+
+    ASSERT(tinyaiFusionProject(input, inputDim, output, outputDim, quantized, bias, true, true),
+           "4-bit projection should succeed");
+    ASSERT(max_difference(output, expected, outputDim) < 1e-3f,
+           "4-bit projection should match the dequantized reference");
+    ASSERT(!tinyaiFusionProject(input, inputDim - 1, output, outputDim, quantized, bias, true,
+                                true),
+           "Mismatched 4-bit weights should fail");
+
+    tinyaiDestroyMatrixFP32(dequantized);
+    tinyaiDestroyMatrix4bit(quantized);
+    printf("  Fusion projection passed.\n");
+}
+
+// Test magnitude-weighted attention fusion against a scalar softmax
+static void test_attention_fusion()
+{
+    printf("  Testing fusion attention weighting...\n");
+
+    float        a[8], b[8], fused[8], expected[8];
+    const float *outputs[2] = {a, b};
+    int          dims[2]    = {8, 8};
+    fill_features(a, 8, 6);
+    fill_features(b, 8, 7);
+    for (int i = 0; i < 8; i++) {
+        b[i] *= 0.5f;
+    }
+
+    float magnitudes[2] = {0.0f, 0.0f};
+    for (int i = 0; i < 8; i++) {
+        magnitudes[0] += a[i] * a[i];
+        magnitudes[1] += b[i] * b[i];
+    }
+    float maxMagnitude = fmaxf(magnitudes[0], magnitudes[1]);
+    float weightA      = expf(magnitudes[0] - maxMagnitude);
+    float weightB      = expf(magnitudes[1] - maxMagnitude);
+    for (int i = 0; i < 8; i++) {
+        expected[i] = (weightA * a[i] + weightB * b[i]) / (weightA + weightB);
+    }
+
+    ASSERT(tinyaiFusionAttention(outputs, dims, 2, NULL, fused, 8, false, true),
+           "Attention fusion should succeed");
+    ASSERT(max_difference(fused, expected, 8) < TEST_TOLERANCE,
+           "Attention fusion should match the reference");
+
+    printf("  Fusion attention weighting passed.\n");
+}
+
+void run_fusion_tests()
+{
+    printf("--- Running Multimodal Fusion Tests ---\n");
+    test_cross_attention();
+    test_project();
+    test_attention_fusion();
+    printf("--- Multimodal Fusion Tests Finished ---\n");
+}
@@ -2,10 +2,17 @@
  * TinyAI Text Generation Tests
  */
 
+#include "../core/config.h"           // For thread pool configuration
 #include "../core/memory.h"           // For memory functions
 #include "../models/text/generate.h"  // Include the generation module being tested
 #include "../models/text/tokenizer.h" // For tokenization
+#include "../utils/mmap_loader.h"     // For tensor containers
+#include "../utils/progressive_loader.h" // For streamed layer weights
+#include "../utils/prune.h"           // For pruned layer weights
 #include "../utils/quantize.h"        // For matrix quantization helpers
+#include "../utils/simd_ops.h"        // For AVX-512 kernel selection
+#include "../utils/thread_pool.h"     // For the shared thread pool
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -220,6 +227,7 @@ void test_softmax_temperature()
 
     // Test various temperatures using the sampleToken function
     TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
     params.maxTokens      = 10;
     params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
     params.seed           = 42; // Fixed for reproducibility
@@ -255,6 +263,7 @@ void test_top_k_sampling()
     float logits_copy[5];
 
     TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
     params.maxTokens      = 10;
     params.samplingMethod = TINYAI_SAMPLING_TOP_K;
     params.seed           = 42; // Fixed for reproducibility
@@ -291,6 +300,7 @@ void test_top_p_sampling()
     float logits_copy[5];
 
     TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
     params.maxTokens      = 10;
     params.samplingMethod = TINYAI_SAMPLING_TOP_P;
     params.seed           = 42; // Fixed for reproducibility
@@ -327,6 +337,7 @@ void test_greedy_sampling()
     float logits_copy[5];
 
     TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
     params.maxTokens      = 10;
     params.samplingMethod = TINYAI_SAMPLING_GREEDY;
     params.seed           = 42;   // Not used for greedy
@@ -340,6 +351,88 @@ void test_greedy_sampling()
     printf("    PASS\n");
 }
 
+// Test that top-K and top-P only ever sample from their exact candidate sets
+void test_sampling_candidate_sets()
+{
+    printf("  Testing top-K/top-P candidate selection on a large vocabulary...\n");
+
+    enum { VOCAB = 500 };
+    float    logits[VOCAB];
+    float    probs[VOCAB];
+    uint32_t order[VOCAB];
+    unsigned state = 12345;
+    for (int i = 0; i < VOCAB; i++) {
+        state     = state * 1103515245u + 12345u;
+        logits[i] = (float)((state >> 8) % 2000) / 200.0f; // Repeated values create ties
+        order[i]  = i;
+    }
+
+    // Brute-force rank: softmax, then sort by probability with lower ids first on ties
+    float maxLogit = logits[0];
+    for (int i = 1; i < VOCAB; i++)
+        if (logits[i] > maxLogit)
+            maxLogit = logits[i];
+    float sum = 0.0f;
+    for (int i = 0; i < VOCAB; i++) {
+        probs[i] = expf(logits[i] - maxLogit);
+        sum += probs[i];
+    }
+    for (int i = 0; i < VOCAB; i++)
+        probs[i] /= sum;
+    for (int i = 1; i < VOCAB; i++) {
+        uint32_t v = order[i];
+        int      j = i - 1;
+        while (j >= 0 && probs[order[j]] < probs[v]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = v;
+    }
+
+    int rank[VOCAB];
+    for (int i = 0; i < VOCAB; i++)
+        rank[order[i]] = i;
+
+    // Size of the nucleus for p = 0.5 (allow one extra token for rounding at the boundary)
+    float cumSum  = 0.0f;
+    int   nucleus = 0;
+    while (nucleus < VOCAB && cumSum < 0.5f)
+        cumSum += probs[order[nucleus++]];
+
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.temperature = 1.0f;
+    params.topK        = 7;
+    params.topP        = 0.5f;
+
+    for (uint32_t seed = 1; seed <= 200; seed++) {
+        params.seed           = seed;
+        params.samplingMethod = TINYAI_SAMPLING_TOP_K;
+        int token             = tinyaiSampleToken(logits, VOCAB, &params);
+        ASSERT(token >= 0 && token < VOCAB && rank[token] < 7,
+               "Top-K should only sample from the K most likely tokens");
+
+        params.samplingMethod = TINYAI_SAMPLING_TOP_P;
+        token                 = tinyaiSampleToken(logits, VOCAB, &params);
+        ASSERT(token >= 0 && token < VOCAB && rank[token] <= nucleus,
+               "Top-P should only sample from the nucleus");
+    }
+
+    // With every logit equal, ties go to the lowest token ids
+    float flat[VOCAB];
+    for (int i = 0; i < VOCAB; i++)
+        flat[i] = 1.0f;
+    params.samplingMethod = TINYAI_SAMPLING_TOP_K;
+    params.topK           = 3;
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        params.seed = seed;
+        int token   = tinyaiSampleToken(flat, VOCAB, &params);
+        ASSERT(token >= 0 && token < 3, "Tied top-K candidates should be the lowest ids");
+    }
+
+    printf("    PASS\n");
+}
+
 // Test simplified text generation
 void test_text_generation()
 {
@@ -369,6 +462,7 @@ void test_text_generation()
 
     // Set up generation parameters
     TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
     params.maxTokens      = 5;    // Generate up to 5 tokens
     params.promptTokens   = NULL; // No prompt - will start with BOS token
     params.promptLength   = 0;
@@ -419,6 +513,3823 @@ void test_text_generation()
     printf("    PASS\n");
 }
 
+// Helper to build a small transformer with embedding, dense and output layers
+TinyAIModel *create_test_transformer(TinyAITokenizer *tokenizer, uint32_t hiddenSize,
+                                     uint32_t contextSize)
+{
+    TinyAIModel *model =
+        tinyaiCreateModel(TINYAI_MODEL_TYPE_TRANSFORMER, hiddenSize, contextSize, tokenizer);
+    if (!model)
+        return NULL;
+
+    tinyaiAddLayer(model, TINYAI_LAYER_EMBEDDING, tokenizer->tokenCount, hiddenSize,
+                   TINYAI_ACTIVATION_NONE);
+    tinyaiAddLayer(model, TINYAI_LAYER_DENSE, hiddenSize, hiddenSize, TINYAI_ACTIVATION_RELU);
+    tinyaiAddLayer(model, TINYAI_LAYER_OUTPUT, hiddenSize, tokenizer->tokenCount,
+                   TINYAI_ACTIVATION_NONE);
+
+    uint32_t sizes[3][2] = {{tokenizer->tokenCount, hiddenSize},
+                            {hiddenSize, hiddenSize},
+                            {hiddenSize, tokenizer->tokenCount}};
+    for (int i = 0; i < 3; i++) {
+        TinyAIMatrixFP32 *fp32      = create_mock_matrix(sizes[i][0], sizes[i][1]);
+        TinyAIMatrix4bit *quantized = tinyaiQuantizeFP32To4bit(fp32);
+        model->layers[i].weights    = *quantized; // Copy the struct, model owns the data
+        TINYAI_FREE(quantized);
+        free_mock_matrix(fp32);
+    }
+
+    return model;
+}
+
+// Test gathering embedding rows from a 4-bit table without dequantizing it
+void test_embedding_gather()
+{
+    printf("  Testing 4-bit embedding row gather...\n");
+
+    // An odd column count makes every other row start on a low nibble
+    TinyAIMatrixFP32 *fp32      = create_mock_matrix(7, 21);
+    TinyAIMatrix4bit *quantized = tinyaiQuantizeFP32To4bit(fp32);
+    TinyAIMatrixFP32 *full      = tinyaiDequantize4bitToFP32(quantized);
+    ASSERT(quantized && full, "Should quantize and dequantize mock table");
+
+    int   rows[4] = {3, 0, 6, 3};
+    float gathered[4 * 21];
+    ASSERT(tinyaiMatrix4bitGatherRows(quantized, rows, 4, gathered) == 0,
+           "Gathering valid rows should succeed");
+
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 21; j++) {
+            ASSERT(fabsf(gathered[i * 21 + j] - full->data[rows[i] * 21 + j]) < 1e-6f,
+                   "Gathered row should match full dequantization");
+        }
+    }
+
+    int badRow = 7;
+    ASSERT(tinyaiMatrix4bitGatherRows(quantized, &badRow, 1, gathered) != 0,
+           "Gathering an out-of-range row should fail");
+
+    tinyaiDestroyMatrixFP32(full);
+    tinyaiDestroyMatrix4bit(quantized);
+    free_mock_matrix(fp32);
+    printf("    PASS\n");
+}
+
+// Helper to compare a 4-bit matrix product with the product of its dequantized weights
+static bool matches_dequantized_product(const TinyAIMatrix4bit *matrix, const float *input,
+                                        uint32_t count, const float *output)
+{
+    TinyAIMatrixFP32 *full  = tinyaiDequantize4bitToFP32(matrix);
+    bool              match = full != NULL;
+    for (uint32_t b = 0; match && b < count; b++) {
+        for (uint32_t j = 0; j < matrix->cols; j++) {
+            float expected = 0.0f;
+            for (uint32_t k = 0; k < matrix->rows; k++) {
+                expected += input[b * matrix->rows + k] * full->data[k * matrix->cols + j];
+            }
+            if (fabsf(output[b * matrix->cols + j] - expected) > 1e-3f * (1.0f + fabsf(expected))) {
+                match = false;
+            }
+        }
+    }
+    tinyaiDestroyMatrixFP32(full);
+    return match;
+}
+
+// Test group-quantized 4-bit weights: accuracy, kernels, threading and file formats
+void test_group_quantization()
+{
+    printf("  Testing group-quantized 4-bit weights...\n");
+
+    // Even shapes take the SIMD path, an odd group size the unaligned fallback
+    const uint32_t shapes[2][3] = {{32, 40, 16}, {13, 21, 5}};
+
+    for (int s = 0; s < 2; s++) {
+        uint32_t          rows = shapes[s][0], cols = shapes[s][1], groupSize = shapes[s][2];
+        TinyAIMatrixFP32 *fp32 = tinyaiCreateMatrixFP32(rows, cols);
+        ASSERT(fp32 != NULL, "Should create FP32 weights");
+        for (uint32_t i = 0; i < rows * cols; i++) {
+            fp32->data[i] = sinf((float)i * 0.37f) * (1.0f + (float)(i % cols) / cols);
+        }
+        fp32->data[3] = 40.0f; // An outlier that ruins a single global scale
+
+        TinyAIMatrix4bit *global  = tinyaiQuantizeFP32To4bit(fp32);
+        TinyAIMatrix4bit *grouped = tinyaiQuantizeFP32To4bitGrouped(fp32, groupSize);
+        ASSERT(global && grouped && grouped->groupSize == groupSize,
+               "Should quantize globally and by group");
+        ASSERT(tinyaiMatrix4bitGroupCount(grouped) == rows * ((cols + groupSize - 1) / groupSize),
+               "Each row should have one scale per group");
+
+        // Per-group ranges keep the error of the other groups small
+        TinyAIMatrixFP32 *globalFull  = tinyaiDequantize4bitToFP32(global);
+        TinyAIMatrixFP32 *groupedFull = tinyaiDequantize4bitToFP32(grouped);
+        float             globalError = 0.0f, groupedError = 0.0f;
+        for (uint32_t i = 0; i < rows * cols; i++) {
+            globalError += fabsf(globalFull->data[i] - fp32->data[i]);
+            groupedError += fabsf(groupedFull->data[i] - fp32->data[i]);
+        }
+        ASSERT(groupedError * 4.0f < globalError, "Group scales should cut quantization error");
+
+        // Products, serial and split across threads, match the dequantized weights
+        const uint32_t count = 5;
+        float          input[5 * 32], serial[5 * 40], threaded[5 * 40];
+        for (uint32_t i = 0; i < count * rows; i++) {
+            input[i] = cosf((float)i * 0.21f);
+        }
+        input[2] = 0.0f; // Zero inputs still contribute to the zero point terms
+
+        ASSERT(tinyaiMatrix4bitMatMul(grouped, input, count, NULL, serial) == 0,
+               "Grouped matrix multiplication should succeed");
+        ASSERT(matches_dequantized_product(grouped, input, count, serial),
+               "Grouped product should match the dequantized weights");
+
+        ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+        tinyaiConfigSetInt("system.threads", 4);
+        tinyaiConfigSetInt("system.parallel_min_work", 1);
+        tinyaiShutdownThreadPool();
+        ASSERT(tinyaiMatrix4bitMatMul(grouped, input, count, NULL, threaded) == 0,
+               "Threaded grouped matrix multiplication should succeed");
+        tinyaiConfigRemoveKey("system.threads");
+        tinyaiConfigRemoveKey("system.parallel_min_work");
+        tinyaiShutdownThreadPool();
+        ASSERT(memcmp(serial, threaded, count * cols * sizeof(float)) == 0,
+               "Threaded grouped product should match the serial result exactly");
+
+        // Selected columns and gathered rows use the same scales
+        uint32_t columns[3] = {cols - 1, 0, groupSize};
+        float    selected[3];
+        ASSERT(tinyaiMatrix4bitVecMulColumns(grouped, input, columns, 3, NULL, selected) == 0,
+               "Grouped column selection should succeed");
+        for (int j = 0; j < 3; j++) {
+            float expected = serial[columns[j]];
+            ASSERT(fabsf(selected[j] - expected) < 1e-3f * (1.0f + fabsf(expected)),
+                   "Selected columns should match the full product");
+        }
+
+        int   rowIndices[2] = {(int)rows - 1, 0};
+        float gathered[2 * 40];
+        ASSERT(tinyaiMatrix4bitGatherRows(grouped, rowIndices, 2, gathered) == 0,
+               "Gathering grouped rows should succeed");
+        ASSERT(memcmp(gathered, groupedFull->data + (rows - 1) * cols, cols * sizeof(float)) == 0 &&
+                   memcmp(gathered + cols, groupedFull->data, cols * sizeof(float)) == 0,
+               "Gathered rows should match full dequantization");
+
+        // Quantized matrix files keep the groups
+        const char *matrixPath = "test_grouped_matrix.bin";
+        ASSERT(tinyaiSaveQuantizedMatrix(grouped, matrixPath, TINYAI_PRECISION_INT4) == 0,
+               "Saving a grouped matrix should succeed");
+        TinyAIMatrix4bit *loaded =
+            (TinyAIMatrix4bit *)tinyaiLoadQuantizedMatrix(matrixPath, TINYAI_PRECISION_INT4);
+        remove(matrixPath);
+        ASSERT(loaded && loaded->groupSize == groupSize &&
+                   memcmp(loaded->scales, grouped->scales,
+                          tinyaiMatrix4bitGroupCount(grouped) * sizeof(float)) == 0 &&
+                   memcmp(loaded->data, grouped->data, (rows * cols + 1) / 2) == 0,
+               "Loaded grouped matrix should match the saved one");
+
+        tinyaiDestroyMatrix4bit(loaded);
+        tinyaiDestroyMatrixFP32(globalFull);
+        tinyaiDestroyMatrixFP32(groupedFull);
+        tinyaiDestroyMatrix4bit(global);
+        tinyaiDestroyMatrix4bit(grouped);
+        tinyaiDestroyMatrixFP32(fp32);
+    }
+
+    // One group per row by default
+    TinyAIMatrixFP32 *fp32   = create_mock_matrix(4, 6);
+    TinyAIMatrix4bit *perRow = tinyaiQuantizeFP32To4bitGrouped(fp32, 0);
+    ASSERT(perRow && perRow->groupSize == 6 && tinyaiMatrix4bitGroupCount(perRow) == 4,
+           "Group size 0 should give one scale per row");
+
+    // Version 2 weight files carry the groups; a group size of 0 keeps one scale
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model = tinyaiCreateModel(TINYAI_MODEL_TYPE_TRANSFORMER, 6, 8, tokenizer);
+    ASSERT(model != NULL, "Should create model");
+    tinyaiAddLayer(model, TINYAI_LAYER_DENSE, 4, 6, TINYAI_ACTIVATION_NONE);
+    tinyaiAddLayer(model, TINYAI_LAYER_DENSE, 4, 6, TINYAI_ACTIVATION_NONE);
+
+    const char *weightsPath = "test_grouped_weights.bin";
+    FILE       *file        = fopen(weightsPath, "wb");
+    ASSERT(file != NULL, "Should create weights file");
+    uint32_t header[3] = {0x4D494E54, TINYAI_WEIGHTS_VERSION, 2};
+    fwrite(header, sizeof(uint32_t), 3, file);
+    for (uint32_t i = 0; i < 2; i++) {
+        uint32_t layerHeader[4] = {TINYAI_LAYER_DENSE, 4, 6, i == 0 ? perRow->groupSize : 0};
+        float    biases[6]      = {0};
+        fwrite(layerHeader, sizeof(uint32_t), 3, file);
+        fwrite(&perRow->scale, sizeof(float), 1, file);
+        fwrite(&perRow->zeroPoint, sizeof(float), 1, file);
+        fwrite(&layerHeader[3], sizeof(uint32_t), 1, file);
+        if (i == 0) {
+            fwrite(perRow->scales, sizeof(float), 4, file);
+            fwrite(perRow->zeroPoints, sizeof(float), 4, file);
+        }
+        fwrite(perRow->data, 1, 12, file);
+        fwrite(biases, sizeof(float), 6, file);
+    }
+    fclose(file);
+
+    ASSERT(tinyaiLoadModelWeights(model, weightsPath) == 0, "Version 2 weights should load");
+    remove(weightsPath);
+    const TinyAIMatrix4bit *weights = &model->layers[0].weights;
+    ASSERT(weights->groupSize == 6 && weights->scales &&
+               memcmp(weights->scales, perRow->scales, 4 * sizeof(float)) == 0 &&
+               memcmp(weights->zeroPoints, perRow->zeroPoints, 4 * sizeof(float)) == 0,
+           "Loaded layer should keep its group scales");
+    ASSERT(model->layers[1].weights.scales == NULL, "Group size 0 should keep one scale");
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    tinyaiDestroyMatrix4bit(perRow);
+    free_mock_matrix(fp32);
+    printf("    PASS\n");
+}
+
+// Test that quantizing matrices on the thread pool matches the scalar formulas
+void test_parallel_quantization()
+{
+    printf("  Testing parallel matrix quantization...\n");
+
+    // Odd sizes cover kernel tails and bytes shared across rows and groups
+    const uint32_t    rows = 301, cols = 127;
+    TinyAIMatrixFP32 *fp32 = tinyaiCreateMatrixFP32(rows, cols);
+    ASSERT(fp32 != NULL, "Should create FP32 matrix");
+    for (uint32_t i = 0; i < rows * cols; i++) {
+        fp32->data[i] = sinf((float)i * 0.013f) * (float)(i % 17);
+    }
+
+    float min = 0.0f, max = 0.0f, refMin = FLT_MAX, refMax = -FLT_MAX;
+    tinyaiFindMinMax(fp32->data, rows * cols, &min, &max);
+    for (uint32_t i = 0; i < rows * cols; i++) {
+        refMin = fminf(refMin, fp32->data[i]);
+        refMax = fmaxf(refMax, fp32->data[i]);
+    }
+    ASSERT(min == refMin && max == refMax, "Min/max should match a scalar reduction");
+
+    TinyAIMatrix4bit *serial4 = tinyaiQuantizeFP32To4bit(fp32);
+    TinyAIMatrix8bit *serial8 = tinyaiQuantizeFP32To8bit(fp32);
+    TinyAIMatrix4bit *serialG = tinyaiQuantizeFP32To4bitGrouped(fp32, 9);
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+    float threadedMin = 0.0f, threadedMax = 0.0f;
+    tinyaiFindMinMax(fp32->data, rows * cols, &threadedMin, &threadedMax);
+    TinyAIMatrix4bit *threaded4 = tinyaiQuantizeFP32To4bit(fp32);
+    TinyAIMatrix8bit *threaded8 = tinyaiQuantizeFP32To8bit(fp32);
+    TinyAIMatrix4bit *threadedG = tinyaiQuantizeFP32To4bitGrouped(fp32, 9);
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+
+    ASSERT(serial4 && serial8 && serialG && threaded4 && threaded8 && threadedG,
+           "Should quantize serially and on the thread pool");
+    ASSERT(threadedMin == min && threadedMax == max, "Threaded min/max should match serial");
+
+    // Every value follows (x - min) / scale rounded half up, clamped to the level range
+    bool match = serial4->zeroPoint == min && serial8->zeroPoint == min;
+    for (uint32_t i = 0; i < rows * cols; i++) {
+        int q4 = (int)((fp32->data[i] - min) / serial4->scale + 0.5f);
+        int q8 = (int)((fp32->data[i] - min) / serial8->scale + 0.5f);
+        q4     = q4 > 15 ? 15 : q4;
+        q8     = q8 > 127 ? 127 : q8;
+        int packed = (i % 2 == 0) ? serial4->data[i / 2] >> 4 : serial4->data[i / 2] & 0x0F;
+        match      = match && packed == q4 && serial8->data[i] == q8;
+    }
+    ASSERT(match, "Quantized values should match the scalar formula");
+
+    size_t bytes4 = (rows * cols + 1) / 2;
+    ASSERT(memcmp(serial4->data, threaded4->data, bytes4) == 0 &&
+               memcmp(serial8->data, threaded8->data, rows * cols) == 0 &&
+               memcmp(serialG->data, threadedG->data, bytes4) == 0,
+           "Threaded quantization should match serial exactly");
+
+    // Grouped values stay within half a level of their group's range
+    TinyAIMatrixFP32 *groupedFull = tinyaiDequantize4bitToFP32(serialG);
+    ASSERT(groupedFull != NULL, "Should dequantize grouped matrix");
+    float worst = 0.0f;
+    for (uint32_t i = 0; i < rows * cols; i++) {
+        size_t g = (size_t)(i / cols) * ((cols + 8) / 9) + (i % cols) / 9;
+        worst    = fmaxf(worst, fabsf(groupedFull->data[i] - fp32->data[i]) / serialG->scales[g]);
+    }
+    ASSERT(worst <= 0.5001f, "Grouped quantization error should be at most half a level");
+
+    tinyaiDestroyMatrixFP32(groupedFull);
+    tinyaiDestroyMatrix4bit(serial4);
+    tinyaiDestroyMatrix4bit(threaded4);
+    tinyaiDestroyMatrix8bit(serial8);
+    tinyaiDestroyMatrix8bit(threaded8);
+    tinyaiDestroyMatrix4bit(serialG);
+    tinyaiDestroyMatrix4bit(threadedG);
+    tinyaiDestroyMatrixFP32(fp32);
+    printf("    PASS\n");
+}
+
+// Largest difference between two arrays, relative to the largest magnitude in the first
+static float relative_max_error(const float *expected, const float *actual, size_t size)
+{
+    float maxError = 0.0f, maxValue = 0.0f;
+    for (size_t i = 0; i < size; i++) {
+        maxError = fmaxf(maxError, fabsf(actual[i] - expected[i]));
+        maxValue = fmaxf(maxValue, fabsf(expected[i]));
+    }
+    return maxValue > 0.0f ? maxError / maxValue : maxError;
+}
+
+// Test codebook (NF4-style) 4-bit weights: accuracy, kernels, threading and file formats
+void test_codebook_quantization()
+{
+    printf("  Testing codebook 4-bit weights...\n");
+
+    // Normally distributed weights, the case NF4's levels are spaced for; in groups this large
+    // the range is set by outliers, which evenly spaced levels handle poorly
+    const uint32_t    rows = 32, cols = 128, groupSize = 128;
+    TinyAIMatrixFP32 *fp32 = tinyaiCreateMatrixFP32(rows, cols);
+    ASSERT(fp32 != NULL, "Should create FP32 weights");
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < rows * cols; i += 2) {
+        float u[2];
+        for (int k = 0; k < 2; k++) {
+            seed = seed * 1664525u + 1013904223u;
+            u[k] = ((seed >> 8) + 0.5f) / 16777216.0f;
+        }
+        float radius     = sqrtf(-2.0f * logf(u[0]));
+        fp32->data[i]     = radius * cosf(6.2831853f * u[1]);
+        fp32->data[i + 1] = radius * sinf(6.2831853f * u[1]);
+    }
+
+    TinyAIMatrix4bit *grouped = tinyaiQuantizeFP32To4bitGrouped(fp32, groupSize);
+    TinyAIMatrix4bit *nf4     = tinyaiQuantizeFP32To4bitCodebook(fp32, NULL, groupSize);
+    ASSERT(grouped && nf4 && nf4->levels && nf4->groupSize == groupSize,
+           "Should quantize with uniform and NF4 levels");
+
+    // Levels dense near zero fit normal weights better than evenly spaced ones
+    TinyAIMatrixFP32 *groupedFull = tinyaiDequantize4bitToFP32(grouped);
+    TinyAIMatrixFP32 *nf4Full     = tinyaiDequantize4bitToFP32(nf4);
+    float             groupedError = 0.0f, nf4Error = 0.0f;
+    for (uint32_t i = 0; i < rows * cols; i++) {
+        float d = groupedFull->data[i] - fp32->data[i];
+        float e = nf4Full->data[i] - fp32->data[i];
+        groupedError += d * d;
+        nf4Error += e * e;
+    }
+    ASSERT(nf4Error < groupedError, "NF4 levels should cut the error on normal weights");
+
+    // Products, serial and split across threads, match the dequantized weights
+    const uint32_t count = 3;
+    float          input[3 * 32], serial[3 * 128], threaded[3 * 128];
+    for (uint32_t i = 0; i < count * rows; i++) {
+        input[i] = cosf((float)i * 0.21f);
+    }
+    input[2] = 0.0f;
+
+    ASSERT(tinyaiMatrix4bitMatMul(nf4, input, count, NULL, serial) == 0,
+           "Codebook matrix multiplication should succeed");
+    ASSERT(matches_dequantized_product(nf4, input, count, serial),
+           "Codebook product should match the dequantized weights");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+    ASSERT(tinyaiMatrix4bitMatMul(nf4, input, count, NULL, threaded) == 0,
+           "Threaded codebook matrix multiplication should succeed");
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    ASSERT(memcmp(serial, threaded, sizeof(serial)) == 0,
+           "Threaded codebook product should match the serial result exactly");
+
+    uint32_t columns[3] = {cols - 1, 0, cols / 2};
+    float    selected[3];
+    ASSERT(tinyaiMatrix4bitVecMulColumns(nf4, input, columns, 3, NULL, selected) == 0,
+           "Codebook column selection should succeed");
+    for (int j = 0; j < 3; j++) {
+        float expected = serial[columns[j]];
+        ASSERT(fabsf(selected[j] - expected) < 1e-3f * (1.0f + fabsf(expected)),
+               "Selected columns should match the full product");
+    }
+
+    // A codebook of the plain levels 0..15 reproduces group quantization
+    float linear[TINYAI_CODEBOOK_LEVELS];
+    for (int i = 0; i < TINYAI_CODEBOOK_LEVELS; i++) {
+        linear[i] = (float)i;
+    }
+    TinyAIMatrix4bit *uniform = tinyaiQuantizeFP32To4bitCodebook(fp32, linear, groupSize);
+    ASSERT(uniform && memcmp(uniform->data, grouped->data, rows * cols / 2) == 0,
+           "A linear codebook should pick the same levels as group quantization");
+
+    // Levels must be increasing
+    linear[3] = linear[4];
+    ASSERT(tinyaiQuantizeFP32To4bitCodebook(fp32, linear, groupSize) == NULL,
+           "Unsorted codebooks should be rejected");
+
+    // Copies and quantized matrix files keep the codebook
+    TinyAIMatrix4bit copy = {0};
+    ASSERT(tinyaiCopyMatrix4bit(&copy, nf4) == 0 && copy.levels != nf4->levels &&
+               memcmp(copy.levels, nf4->levels, sizeof(linear)) == 0,
+           "Copies should own the same codebook");
+    tinyaiReleaseMatrix4bit(&copy);
+
+    const char *matrixPath = "test_codebook_matrix.bin";
+    ASSERT(tinyaiSaveQuantizedMatrix(nf4, matrixPath, TINYAI_PRECISION_INT4) == 0,
+           "Saving a codebook matrix should succeed");
+    TinyAIMatrix4bit *loaded =
+        (TinyAIMatrix4bit *)tinyaiLoadQuantizedMatrix(matrixPath, TINYAI_PRECISION_INT4);
+    remove(matrixPath);
+    ASSERT(loaded && loaded->levels && memcmp(loaded->levels, nf4->levels, sizeof(linear)) == 0 &&
+               memcmp(loaded->scales, nf4->scales,
+                      tinyaiMatrix4bitGroupCount(nf4) * sizeof(float)) == 0 &&
+               memcmp(loaded->data, nf4->data, rows * cols / 2) == 0,
+           "Loaded codebook matrix should match the saved one");
+
+    tinyaiDestroyMatrix4bit(loaded);
+    tinyaiDestroyMatrix4bit(uniform);
+    tinyaiDestroyMatrixFP32(groupedFull);
+    tinyaiDestroyMatrixFP32(nf4Full);
+    tinyaiDestroyMatrix4bit(grouped);
+    tinyaiDestroyMatrix4bit(nf4);
+    tinyaiDestroyMatrixFP32(fp32);
+    printf("    PASS\n");
+}
+
+// Test int8 activation quantization in 4-bit and 8-bit weight products
+void test_int8_activations()
+{
+    printf("  Testing int8 activation quantization...\n");
+
+    ASSERT(tinyaiGetActivationPrecision() == TINYAI_PRECISION_FP32,
+           "Activations should default to FP32");
+    ASSERT(tinyaiSetActivationPrecision(TINYAI_PRECISION_INT4) != 0,
+           "Only FP32 and INT8 activations should be accepted");
+
+    const uint32_t    rows = 48, cols = 40, count = 5;
+    TinyAIMatrixFP32 *fp32 = tinyaiCreateMatrixFP32(rows, cols);
+    TinyAIMatrixFP32 *A    = tinyaiCreateMatrixFP32(count, rows);
+    TinyAIMatrixFP32 *C    = tinyaiCreateMatrixFP32(count, cols);
+    ASSERT(fp32 && A && C, "Should create FP32 matrices");
+    for (uint32_t i = 0; i < rows * cols; i++) {
+        fp32->data[i] = sinf((float)i * 0.37f);
+    }
+    for (uint32_t i = 0; i < count * rows; i++) {
+        A->data[i] = cosf((float)i * 0.21f) * (1.0f + (float)(i % 7));
+    }
+
+    TinyAIMatrix4bit *weights4 = tinyaiQuantizeFP32To4bit(fp32);
+    TinyAIMatrix4bit *grouped  = tinyaiQuantizeFP32To4bitGrouped(fp32, 16);
+    TinyAIMatrix8bit *weights8 = tinyaiQuantizeFP32To8bit(fp32);
+    ASSERT(weights4 && grouped && weights8, "Should quantize weights");
+
+    // FP32 activations as the baseline
+    float exact[5 * 40], exactGrouped[5 * 40], serial[5 * 40], threaded[5 * 40];
+    ASSERT(tinyaiMatrix4bitMatMul(weights4, A->data, count, NULL, exact) == 0 &&
+               tinyaiMatrix4bitMatMul(grouped, A->data, count, NULL, exactGrouped) == 0,
+           "FP32 activation products should succeed");
+
+    // Int8 activations stay close to FP32 and do not depend on the thread split
+    ASSERT(tinyaiSetActivationPrecision(TINYAI_PRECISION_INT8) == 0,
+           "Should select int8 activations");
+    ASSERT(tinyaiMatrix4bitMatMul(weights4, A->data, count, NULL, serial) == 0,
+           "Int8 activation product should succeed");
+    ASSERT(relative_max_error(exact, serial, count * cols) < 0.02f,
+           "Int8 activations should stay close to the FP32 product");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+    ASSERT(tinyaiMatrix4bitMatMul(weights4, A->data, count, NULL, threaded) == 0,
+           "Threaded int8 activation product should succeed");
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    ASSERT(memcmp(serial, threaded, sizeof(serial)) == 0,
+           "Threaded int8 activation product should match the serial result exactly");
+
+    // Group-quantized weights keep FP32 activations
+    ASSERT(tinyaiMatrix4bitMatMul(grouped, A->data, count, NULL, threaded) == 0 &&
+               memcmp(exactGrouped, threaded, sizeof(threaded)) == 0,
+           "Grouped weights should ignore the activation precision");
+    ASSERT(tinyaiSetActivationPrecision(TINYAI_PRECISION_FP32) == 0,
+           "Should restore FP32 activations");
+
+    // The matrix multiply precisions select int8 activations per call
+    ASSERT(tinyaiMatrixMultiply(A, weights4, C, TINYAI_PRECISION_INT4_A8) == 0 &&
+               memcmp(C->data, serial, sizeof(serial)) == 0,
+           "INT4_A8 multiply should match the int8 activation product");
+
+    TinyAIMatrixFP32 *full8 = tinyaiDequantize8bitToFP32(weights8);
+    TinyAIMatrixFP32 *ref8  = tinyaiCreateMatrixFP32(count, cols);
+    ASSERT(full8 && ref8 && tinyaiMatrixMultiply(A, full8, ref8, TINYAI_PRECISION_FP32) == 0,
+           "FP32 product of 8-bit weights should succeed");
+    ASSERT(tinyaiMatrixMultiply(A, weights8, C, TINYAI_PRECISION_INT8_A8) == 0,
+           "INT8_A8 multiply should succeed");
+    ASSERT(relative_max_error(ref8->data, C->data, count * cols) < 0.02f,
+           "INT8_A8 multiply should stay close to the FP32 product");
+    ASSERT(tinyaiMatrixMultiply(A, weights8, A, TINYAI_PRECISION_INT8_A8) != 0,
+           "Mismatched output dimensions should be rejected");
+
+    tinyaiDestroyMatrixFP32(full8);
+    tinyaiDestroyMatrixFP32(ref8);
+    tinyaiDestroyMatrix8bit(weights8);
+    tinyaiDestroyMatrix4bit(grouped);
+    tinyaiDestroyMatrix4bit(weights4);
+    tinyaiDestroyMatrixFP32(C);
+    tinyaiDestroyMatrixFP32(A);
+    tinyaiDestroyMatrixFP32(fp32);
+    printf("    PASS\n");
+}
+
+// Test repacking 4-bit weights into SIMD panels, for matrices and whole models
+void test_prepacked_weights()
+{
+    printf("  Testing prepacked 4-bit weights...\n");
+
+    // Whole panels, and a last panel padded past an odd column count
+    const uint32_t shapes[2][2] = {{48, 64}, {13, 21}};
+
+    for (int s = 0; s < 2; s++) {
+        uint32_t          rows = shapes[s][0], cols = shapes[s][1];
+        TinyAIMatrixFP32 *fp32 = create_mock_matrix(rows, cols);
+        TinyAIMatrix4bit *plain  = tinyaiQuantizeFP32To4bit(fp32);
+        TinyAIMatrix4bit  packed = {0};
+        ASSERT(plain && tinyaiCopyMatrix4bit(&packed, plain) == 0, "Should quantize and copy");
+        ASSERT(plain->layout == TINYAI_MATRIX4BIT_ROW_MAJOR, "Matrices should start row-major");
+
+        ASSERT(tinyaiMatrix4bitPrepack(&packed) == 0 && packed.layout == TINYAI_MATRIX4BIT_PANELS,
+               "Prepacking should record the panel layout");
+        ASSERT(tinyaiMatrix4bitDataSize(&packed) == (cols + 15) / 16 * rows * 8,
+               "Panels should hold 8 bytes per row");
+        ASSERT(tinyaiMatrix4bitPrepack(&packed) == 0, "Prepacking twice should do nothing");
+
+        // Dequantization and gathered rows are unchanged by the layout
+        TinyAIMatrixFP32 *plainFull  = tinyaiDequantize4bitToFP32(plain);
+        TinyAIMatrixFP32 *packedFull = tinyaiDequantize4bitToFP32(&packed);
+        ASSERT(plainFull && packedFull &&
+                   memcmp(plainFull->data, packedFull->data, rows * cols * sizeof(float)) == 0,
+               "Prepacked weights should dequantize to the same values");
+        int   gatherRows[2] = {(int)rows - 1, 1};
+        float gathered[2 * 64];
+        ASSERT(tinyaiMatrix4bitGatherRows(&packed, gatherRows, 2, gathered) == 0 &&
+                   memcmp(gathered, plainFull->data + (rows - 1) * cols, cols * sizeof(float)) == 0,
+               "Gathered rows should match the row-major matrix");
+
+        // Products match the row-major kernels, serial and threaded alike
+        const uint32_t count = 5;
+        float          input[5 * 48], expected[5 * 64], serial[5 * 64], threaded[5 * 64];
+        for (uint32_t i = 0; i < count * rows; i++) {
+            input[i] = cosf((float)i * 0.21f);
+        }
+        ASSERT(tinyaiMatrix4bitMatMul(plain, input, count, NULL, expected) == 0 &&
+                   tinyaiMatrix4bitMatMul(&packed, input, count, NULL, serial) == 0,
+               "Products should succeed in both layouts");
+        ASSERT(relative_max_error(expected, serial, count * cols) < 1e-5f,
+               "Prepacked product should match the row-major product");
+
+        ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+        tinyaiConfigSetInt("system.threads", 4);
+        tinyaiConfigSetInt("system.parallel_min_work", 1);
+        tinyaiShutdownThreadPool();
+        ASSERT(tinyaiMatrix4bitMatMul(&packed, input, count, NULL, threaded) == 0,
+               "Threaded prepacked product should succeed");
+        tinyaiConfigRemoveKey("system.threads");
+        tinyaiConfigRemoveKey("system.parallel_min_work");
+        tinyaiShutdownThreadPool();
+        ASSERT(memcmp(serial, threaded, count * cols * sizeof(float)) == 0,
+               "Threaded prepacked product should match the serial result exactly");
+
+        uint32_t columns[3] = {cols - 1, 0, 17};
+        float    selected[3];
+        ASSERT(tinyaiMatrix4bitVecMulColumns(&packed, input, columns, 3, NULL, selected) == 0,
+               "Prepacked column selection should succeed");
+        for (int j = 0; j < 3; j++) {
+            float full = serial[columns[j]];
+            ASSERT(fabsf(selected[j] - full) < 1e-3f * (1.0f + fabsf(full)),
+                   "Selected columns should match the full product");
+        }
+
+        // Unpacking restores the original bytes
+        ASSERT(tinyaiMatrix4bitUnpack(&packed) == 0 &&
+                   packed.layout == TINYAI_MATRIX4BIT_ROW_MAJOR &&
+                   memcmp(packed.data, plain->data, tinyaiMatrix4bitDataSize(plain)) == 0,
+               "Unpacking should restore the row-major data");
+
+        tinyaiReleaseMatrix4bit(&packed);
+        tinyaiDestroyMatrixFP32(plainFull);
+        tinyaiDestroyMatrixFP32(packedFull);
+        tinyaiDestroyMatrix4bit(plain);
+        free_mock_matrix(fp32);
+    }
+
+    // Group-quantized matrices stay row-major
+    TinyAIMatrixFP32 *fp32    = create_mock_matrix(8, 32);
+    TinyAIMatrix4bit *grouped = tinyaiQuantizeFP32To4bitGrouped(fp32, 16);
+    ASSERT(grouped && tinyaiMatrix4bitPrepack(grouped) != 0 &&
+               grouped->layout == TINYAI_MATRIX4BIT_ROW_MAJOR,
+           "Grouped matrices should not be prepacked");
+    tinyaiDestroyMatrix4bit(grouped);
+    free_mock_matrix(fp32);
+
+    // A prepacked model produces the same logits
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_transformer(tokenizer, 4, 8);
+    int              tokens[3] = {TINYAI_TOKEN_BOS, 5, 7};
+    float           *before    = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    float           *after     = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    ASSERT(model && before && after, "Should create model and logits");
+    ASSERT(tinyaiModelForward(model, tokens, 3, before) == 0, "Forward pass should succeed");
+    ASSERT(tinyaiPrepackModelWeights(model) == 0, "Prepacking the model should succeed");
+    ASSERT(model->layers[0].weights.layout == TINYAI_MATRIX4BIT_ROW_MAJOR &&
+               model->layers[1].weights.layout == TINYAI_MATRIX4BIT_PANELS &&
+               model->layers[2].weights.layout == TINYAI_MATRIX4BIT_PANELS,
+           "Embeddings should stay row-major and projections be prepacked");
+    ASSERT(tinyaiModelForward(model, tokens, 3, after) == 0, "Forward pass should succeed");
+    ASSERT(relative_max_error(before, after, tokenizer->tokenCount) < 1e-5f,
+           "Prepacked model should produce the same logits");
+
+    TINYAI_FREE(before);
+    TINYAI_FREE(after);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test incremental decoding with a KV cache against full recomputation
+void test_kv_cache_incremental()
+{
+    printf("  Testing incremental decoding with KV cache...\n");
+
+    TinyAITokenizer *tokenizer   = create_test_tokenizer();
+    uint32_t         contextSize = 8;
+    TinyAIModel     *model       = create_test_transformer(tokenizer, 4, contextSize);
+    ASSERT(model != NULL, "Should create test transformer");
+
+    TinyAIKVCache *cache = tinyaiCreateModelKVCache(model);
+    ASSERT(cache != NULL, "tinyaiCreateModelKVCache() should return non-NULL");
+    ASSERT(cache->maxSeqLength == contextSize, "Cache should hold a full context window");
+    ASSERT(cache->length == 0, "New cache should be empty");
+
+    int    tokens[8]    = {TINYAI_TOKEN_BOS, 5, 7, 4, 9, 6, 8, 10};
+    float *cachedLogits = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    float *fullLogits   = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    ASSERT(cachedLogits && fullLogits, "Should allocate logits");
+
+    // Prefill two tokens at once, then decode one token per step
+    int result = tinyaiModelForwardCached(model, cache, tokens, 2, cachedLogits);
+    ASSERT(result == 0, "Cached prefill should succeed");
+    ASSERT(cache->length == 2, "Cache should hold the prefilled positions");
+
+    for (int n = 2; n <= 8; n++) {
+        if (n > 2) {
+            result = tinyaiModelForwardCached(model, cache, tokens + n - 1, 1, cachedLogits);
+            ASSERT(result == 0, "Cached decode step should succeed");
+        }
+        ASSERT(tinyaiModelForward(model, tokens, n, fullLogits) == 0,
+               "Full forward pass should succeed");
+
+        for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
+            ASSERT(fabsf(cachedLogits[i] - fullLogits[i]) < 1e-5f,
+                   "Cached logits should match full recomputation");
+        }
+    }
+
+    // A full cache rejects further positions until it is reset
+    ASSERT(tinyaiModelForwardCached(model, cache, tokens, 1, cachedLogits) != 0,
+           "Forward past the cache capacity should fail");
+    tinyaiResetKVCache(cache);
+    ASSERT(cache->length == 0, "Reset cache should be empty");
+    ASSERT(tinyaiModelForwardCached(model, cache, tokens, 1, cachedLogits) == 0,
+           "Forward after reset should succeed");
+
+    TINYAI_FREE(cachedLogits);
+    TINYAI_FREE(fullLogits);
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test cached self-attention against the full-sequence attention path
+void test_kv_cache_attention()
+{
+    printf("  Testing cached self-attention against full attention...\n");
+
+    TinyAIAttentionParams params = {0};
+    params.batchSize             = 1;
+    params.seqLength             = 4;
+    params.numHeads              = 2;
+    params.headDim               = 4;
+    params.hiddenDim             = 8;
+    params.useCausalMask         = true;
+    params.scaleFactor           = 0.5f;
+
+    TinyAISelfAttention attention;
+    ASSERT(tinyaiInitSelfAttention(&attention, &params) == 0, "Should init self-attention");
+
+    TinyAIMatrix4bit *weights[4];
+    for (int i = 0; i < 4; i++) {
+        TinyAIMatrixFP32 *fp32 = create_mock_matrix(params.hiddenDim, params.hiddenDim);
+        for (uint32_t j = 0; j < params.hiddenDim * params.hiddenDim; j++) {
+            fp32->data[j] = (float)((j * (i + 3)) % 11) / 11.0f - 0.5f;
+        }
+        weights[i] = tinyaiQuantizeFP32To4bit(fp32);
+        ASSERT(weights[i] != NULL, "Should quantize attention weights");
+        free_mock_matrix(fp32);
+    }
+    float bias[8] = {0.1f, -0.2f, 0.05f, 0.0f, 0.3f, -0.1f, 0.2f, -0.05f};
+    ASSERT(tinyaiSetAttentionWeights(&attention, weights[0], weights[1], weights[2], weights[3],
+                                     bias, bias, bias, bias) == 0,
+           "Should set attention weights");
+
+    float input[32], fullOutput[32], cachedOutput[32];
+    for (int i = 0; i < 32; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+    ASSERT(tinyaiSelfAttentionForward(&attention, input, fullOutput) == 0,
+           "Full attention should succeed");
+
+    // Prefill one position, then feed the remaining positions as one chunk
+    TinyAIKVCache *cache = tinyaiCreateKVCache(1, &params);
+    ASSERT(cache != NULL, "Should create KV cache");
+    ASSERT(tinyaiSelfAttentionForwardCached(&attention, cache, 0, input, 1, cachedOutput) == 0,
+           "Cached prefill should succeed");
+    ASSERT(tinyaiKVCacheAdvance(cache, 1) == 0, "Cache should advance");
+    ASSERT(tinyaiSelfAttentionForwardCached(&attention, cache, 0, input + 8, 3,
+                                            cachedOutput + 8) == 0,
+           "Cached step should succeed");
+
+    for (int i = 0; i < 32; i++) {
+        ASSERT(fabsf(cachedOutput[i] - fullOutput[i]) < 1e-4f,
+               "Cached attention should match full attention");
+    }
+
+    for (int i = 0; i < 4; i++) {
+        tinyaiDestroyMatrix4bit(weights[i]);
+    }
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroySelfAttention(&attention);
+    printf("    PASS\n");
+}
+
+// Test that causal three-pass kernels stop at the diagonal and match a naive evaluation
+void test_causal_attention_kernels()
+{
+    printf("  Testing causal three-pass attention kernels...\n");
+
+    // A head size off both SIMD widths exercises the scalar tails
+    const uint32_t seqLength = 19;
+    const uint32_t numHeads  = 2;
+    const uint32_t headDim   = 13;
+    const uint32_t hidden    = numHeads * headDim;
+    const float    scale     = 0.3f;
+
+    size_t rowsSize   = (size_t)seqLength * hidden;
+    size_t scoresSize = (size_t)numHeads * seqLength * seqLength;
+    float *query      = (float *)TINYAI_MALLOC(3 * rowsSize * sizeof(float));
+    float *context    = (float *)TINYAI_MALLOC(rowsSize * sizeof(float));
+    float *scores     = (float *)TINYAI_MALLOC(2 * scoresSize * sizeof(float));
+    ASSERT(query && context && scores, "Should allocate attention buffers");
+    float *key     = query + rowsSize;
+    float *value   = key + rowsSize;
+    float *weights = scores + scoresSize;
+
+    for (size_t i = 0; i < 3 * rowsSize; i++) {
+        query[i] = (float)((i * 53) % 97) / 30.0f - 1.5f;
+    }
+
+    ASSERT(tinyaiSimdAttentionScores(query, key, scores, seqLength, numHeads, numHeads, headDim,
+                                     scale, true) == 0,
+           "Causal scores should succeed");
+    ASSERT(tinyaiSimdAttentionSoftmax(scores, weights, seqLength, numHeads, true) == 0,
+           "Causal softmax should succeed");
+    ASSERT(tinyaiSimdAttentionContext(weights, value, context, seqLength, numHeads, numHeads,
+                                      headDim, true) == 0,
+           "Causal context should succeed");
+
+    for (uint32_t h = 0; h < numHeads; h++) {
+        for (uint32_t i = 0; i < seqLength; i++) {
+            const float *row       = scores + ((size_t)h * seqLength + i) * seqLength;
+            const float *weightRow = weights + ((size_t)h * seqLength + i) * seqLength;
+            float        logits[19];
+            float        maxLogit = -INFINITY;
+            float        sum      = 0.0f;
+
+            for (uint32_t j = 0; j <= i; j++) {
+                logits[j] = 0.0f;
+                for (uint32_t d = 0; d < headDim; d++) {
+                    logits[j] += query[i * hidden + h * headDim + d] *
+                                 key[j * hidden + h * headDim + d];
+                }
+                logits[j] *= scale;
+                ASSERT(fabsf(row[j] - logits[j]) < 1e-4f, "Visible scores should match");
+                maxLogit = fmaxf(maxLogit, logits[j]);
+            }
+            for (uint32_t j = i + 1; j < seqLength; j++) {
+                ASSERT(row[j] == -INFINITY, "Future scores should be masked");
+                ASSERT(weightRow[j] == 0.0f, "Future positions should get no weight");
+            }
+
+            for (uint32_t j = 0; j <= i; j++) {
+                logits[j] = expf(logits[j] - maxLogit);
+                sum += logits[j];
+            }
+            for (uint32_t d = 0; d < headDim; d++) {
+                float expected = 0.0f;
+                for (uint32_t j = 0; j <= i; j++) {
+                    expected += logits[j] / sum * value[j * hidden + h * headDim + d];
+                }
+                ASSERT(fabsf(context[i * hidden + h * headDim + d] - expected) < 1e-4f,
+                       "Causal context should match the naive result");
+            }
+        }
+    }
+
+    TINYAI_FREE(query);
+    TINYAI_FREE(context);
+    TINYAI_FREE(scores);
+    printf("    PASS\n");
+}
+
+// Test the tiled online-softmax kernel against separate scores, softmax and context passes
+void test_tiled_attention()
+{
+    printf("  Testing tiled attention against the three-pass kernels...\n");
+
+    // Longer than two tiles, ending in a partial one, with pairs of heads sharing keys
+    const uint32_t seqLength  = 2 * TINYAI_ATTENTION_TILE + 22;
+    const uint32_t numHeads   = 4;
+    const uint32_t numKVHeads = 2;
+    const uint32_t headDim    = 8;
+    const uint32_t hidden     = numHeads * headDim;
+
+    size_t rowsSize   = (size_t)seqLength * hidden;
+    size_t kvRowsSize = (size_t)seqLength * numKVHeads * headDim;
+    size_t scoresSize = (size_t)numHeads * seqLength * seqLength;
+    float *query      = (float *)TINYAI_MALLOC((rowsSize + 2 * kvRowsSize) * sizeof(float));
+    float *expected   = (float *)TINYAI_MALLOC(rowsSize * sizeof(float));
+    float *tiled      = (float *)TINYAI_MALLOC(rowsSize * sizeof(float));
+    float *scores     = (float *)TINYAI_MALLOC(2 * scoresSize * sizeof(float));
+    ASSERT(query && expected && tiled && scores, "Should allocate attention buffers");
+    float *key   = query + rowsSize;
+    float *value = key + kvRowsSize;
+
+    for (size_t i = 0; i < rowsSize + 2 * kvRowsSize; i++) {
+        query[i] = (float)((i * 37) % 101) / 25.0f - 2.0f;
+    }
+
+    TinyAIAttentionParams params = {0};
+    params.seqLength             = seqLength;
+    params.numHeads              = numHeads;
+    params.numKVHeads            = numKVHeads;
+    params.headDim               = headDim;
+    params.hiddenDim             = hidden;
+    params.scaleFactor           = 0.35f;
+
+    for (int causal = 0; causal < 2; causal++) {
+        tinyaiSimdAttentionScores(query, key, scores, seqLength, numHeads, numKVHeads, headDim,
+                                  0.35f, causal != 0);
+        tinyaiSimdAttentionSoftmax(scores, scores + scoresSize, seqLength, numHeads, causal != 0);
+        tinyaiSimdAttentionContext(scores + scoresSize, value, expected, seqLength, numHeads,
+                                   numKVHeads, headDim, causal != 0);
+
+        params.useCausalMask = causal != 0;
+        ASSERT(tinyaiSimdAttentionTiled(&params, query, key, value, tiled, seqLength, seqLength, 0,
+                                        0, NULL) == 0,
+               "Tiled attention should succeed");
+        for (size_t i = 0; i < rowsSize; i++) {
+            ASSERT(fabsf(tiled[i] - expected[i]) < 1e-4f,
+                   "Tiled attention should match the three-pass result");
+        }
+
+        // Heads fanned out over worker threads, each in its own accumulator row (deliberately
+        // misaligned here), give the same result
+        float *accumulators = (float *)TINYAI_MALLOC(
+            (tinyaiAttentionAccumulatorSize(&params) + 1) * sizeof(float));
+        ASSERT(accumulators != NULL, "Should allocate accumulators");
+        ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+        tinyaiConfigSetInt("system.threads", 4);
+        tinyaiConfigSetInt("system.parallel_min_work", 1);
+        tinyaiShutdownThreadPool();
+        ASSERT(tinyaiThreadPoolSize(tinyaiGetThreadPool()) == 4, "Heads should get 4 threads");
+        ASSERT(tinyaiSimdAttentionTiled(&params, query, key, value, expected, seqLength,
+                                        seqLength, 0, 0, accumulators + 1) == 0,
+               "Threaded tiled attention should succeed");
+        tinyaiConfigRemoveKey("system.threads");
+        tinyaiConfigRemoveKey("system.parallel_min_work");
+        tinyaiShutdownThreadPool();
+        ASSERT(memcmp(expected, tiled, rowsSize * sizeof(float)) == 0,
+               "Threaded heads should match the serial result exactly");
+        TINYAI_FREE(accumulators);
+    }
+
+    // The last queries alone, positioned after the earlier keys, see the same keys
+    const uint32_t tail = 5;
+    ASSERT(tinyaiSimdAttentionTiled(&params, query + (seqLength - tail) * hidden, key, value, tiled,
+                                    tail, seqLength, seqLength - tail, 0, NULL) == 0,
+           "Offset tiled attention should succeed");
+    for (size_t i = 0; i < tail * hidden; i++) {
+        ASSERT(fabsf(tiled[i] - expected[(seqLength - tail) * hidden + i]) < 1e-4f,
+               "Offset queries should match the full causal result");
+    }
+
+    // A window spanning a tile boundary sees only its own keys, also when they sit in a ring
+    const uint32_t window = TINYAI_ATTENTION_TILE + 3;
+    const uint32_t last   = seqLength - 1;
+    const uint32_t kvDim  = numKVHeads * headDim;
+    params.windowSize     = window;
+    ASSERT(tinyaiSimdAttentionTiled(&params, query, key, value, tiled, seqLength, seqLength, 0,
+                                    0, NULL) == 0,
+           "Windowed tiled attention should succeed");
+
+    params.windowSize = 0;
+    size_t first      = (size_t)(last + 1 - window) * kvDim;
+    ASSERT(tinyaiSimdAttentionTiled(&params, query + last * hidden, key + first, value + first,
+                                    expected, 1, window, window - 1, 0, NULL) == 0,
+           "Tiled attention over the window's keys should succeed");
+    for (uint32_t i = 0; i < hidden; i++) {
+        ASSERT(fabsf(tiled[last * hidden + i] - expected[i]) < 1e-5f,
+               "Windowed attention should only see the window's keys");
+    }
+
+    float *ring = (float *)TINYAI_MALLOC(2 * window * kvDim * sizeof(float));
+    ASSERT(ring != NULL, "Should allocate ring buffer");
+    for (uint32_t position = last + 1 - window; position <= last; position++) {
+        memcpy(ring + (position % window) * kvDim, key + position * kvDim, kvDim * sizeof(float));
+        memcpy(ring + (window + position % window) * kvDim, value + position * kvDim,
+               kvDim * sizeof(float));
+    }
+    params.windowSize = window;
+    ASSERT(tinyaiSimdAttentionTiled(&params, query + last * hidden, ring, ring + window * kvDim,
+                                    tiled, 1, last + 1, last, window, NULL) == 0,
+           "Ring-buffer tiled attention should succeed");
+    for (uint32_t i = 0; i < hidden; i++) {
+        ASSERT(fabsf(tiled[i] - expected[i]) < 1e-5f,
+               "Ring-buffer attention should match the contiguous window");
+    }
+
+    TINYAI_FREE(ring);
+    TINYAI_FREE(query);
+    TINYAI_FREE(expected);
+    TINYAI_FREE(tiled);
+    TINYAI_FREE(scores);
+    printf("    PASS\n");
+}
+
+// Test grouped-query attention against multi-head attention with the key/value heads repeated
+void test_grouped_query_attention()
+{
+    printf("  Testing grouped-query attention...\n");
+
+    // Four query heads share two key/value heads
+    TinyAIAttentionParams params = {0};
+    params.batchSize             = 1;
+    params.seqLength             = 5;
+    params.numHeads              = 4;
+    params.numKVHeads            = 2;
+    params.headDim               = 2;
+    params.hiddenDim             = 8;
+    params.useCausalMask         = true;
+    params.scaleFactor           = 0.7f;
+
+    TinyAIAttentionParams fullParams = params;
+    fullParams.numKVHeads            = 0;
+
+    TinyAISelfAttention grouped, full;
+    ASSERT(tinyaiInitSelfAttention(&grouped, &params) == 0, "Should init grouped attention");
+    ASSERT(tinyaiInitSelfAttention(&full, &fullParams) == 0, "Should init multi-head attention");
+    ASSERT(full.params.numKVHeads == 4, "Zero key/value heads should mean one per query head");
+
+    TinyAIAttentionParams uneven = params;
+    uneven.numKVHeads            = 3;
+    TinyAISelfAttention rejected;
+    ASSERT(tinyaiInitSelfAttention(&rejected, &uneven) != 0,
+           "Query heads should split evenly into groups");
+
+    // Key/value projections are [8 x 4]; the multi-head copy repeats each head for its group
+    TinyAIMatrix4bit *weights[4], *repeated[2];
+    for (int i = 0; i < 4; i++) {
+        uint32_t          cols = (i == 1 || i == 2) ? 4 : 8;
+        TinyAIMatrixFP32 *fp32 = create_mock_matrix(8, cols);
+        for (uint32_t j = 0; j < 8 * cols; j++) {
+            fp32->data[j] = (float)((j * (i + 3)) % 11) / 11.0f - 0.5f;
+        }
+        weights[i] = tinyaiQuantizeFP32To4bit(fp32);
+        ASSERT(weights[i] != NULL, "Should quantize attention weights");
+
+        if (cols == 4) {
+            TinyAIMatrixFP32 *wide = create_mock_matrix(8, 8);
+            for (uint32_t r = 0; r < 8; r++) {
+                for (uint32_t c = 0; c < 8; c++) {
+                    uint32_t head       = c / 2;
+                    wide->data[r * 8 + c] = fp32->data[r * 4 + (head / 2) * 2 + c % 2];
+                }
+            }
+            repeated[i - 1] = tinyaiQuantizeFP32To4bit(wide);
+            free_mock_matrix(wide);
+        }
+        free_mock_matrix(fp32);
+    }
+    ASSERT(tinyaiSetAttentionWeights(&grouped, weights[0], weights[1], weights[2], weights[3], NULL,
+                                     NULL, NULL, NULL) == 0,
+           "Should set grouped attention weights");
+    ASSERT(tinyaiSetAttentionWeights(&full, weights[0], repeated[0], repeated[1], weights[3], NULL,
+                                     NULL, NULL, NULL) == 0,
+           "Should set multi-head attention weights");
+
+    float input[40], groupedOutput[40], fullOutput[40], cachedOutput[40];
+    for (int i = 0; i < 40; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+    ASSERT(tinyaiSelfAttentionForward(&grouped, input, groupedOutput) == 0,
+           "Grouped attention should succeed");
+    ASSERT(tinyaiSelfAttentionForward(&full, input, fullOutput) == 0,
+           "Multi-head attention should succeed");
+    for (int i = 0; i < 40; i++) {
+        ASSERT(fabsf(groupedOutput[i] - fullOutput[i]) < 1e-5f,
+               "Grouped attention should match multi-head attention with repeated heads");
+    }
+
+    // The cache stores only the key/value heads
+    TinyAIKVCache *cache = tinyaiCreateKVCache(1, &grouped.params);
+    ASSERT(cache != NULL && cache->numHeads == 2 && cache->hiddenDim == 4,
+           "Cache rows should hold the key/value heads only");
+    ASSERT(tinyaiSelfAttentionForwardCached(&grouped, cache, 0, input, 2, cachedOutput) == 0,
+           "Cached prefill should succeed");
+    ASSERT(tinyaiKVCacheAdvance(cache, 2) == 0, "Cache should advance");
+    ASSERT(tinyaiSelfAttentionForwardCached(&grouped, cache, 0, input + 16, 3,
+                                            cachedOutput + 16) == 0,
+           "Cached step should succeed");
+    for (int i = 0; i < 40; i++) {
+        ASSERT(fabsf(cachedOutput[i] - groupedOutput[i]) < 1e-4f,
+               "Cached grouped attention should match the full pass");
+    }
+
+    TinyAIKVCache *fullCache = tinyaiCreateKVCache(1, &full.params);
+    ASSERT(tinyaiSelfAttentionForwardCached(&grouped, fullCache, 0, input, 1, cachedOutput) != 0,
+           "A multi-head cache should not fit grouped attention");
+
+    for (int i = 0; i < 4; i++) {
+        tinyaiDestroyMatrix4bit(weights[i]);
+    }
+    tinyaiDestroyMatrix4bit(repeated[0]);
+    tinyaiDestroyMatrix4bit(repeated[1]);
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroyKVCache(fullCache);
+    tinyaiDestroySelfAttention(&grouped);
+    tinyaiDestroySelfAttention(&full);
+    printf("    PASS\n");
+}
+
+// Helper to create heap-allocated attention weights for a model layer
+TinyAISelfAttention *create_test_attention(uint32_t hiddenDim, uint32_t seqLength,
+                                           uint32_t numHeads)
+{
+    TinyAIAttentionParams params = {0};
+    params.batchSize             = 1;
+    params.seqLength             = seqLength;
+    params.numHeads              = numHeads;
+    params.headDim               = hiddenDim / numHeads;
+    params.hiddenDim             = hiddenDim;
+    params.useCausalMask         = true;
+    params.scaleFactor           = 1.0f / sqrtf((float)params.headDim);
+
+    TinyAISelfAttention *attention =
+        (TinyAISelfAttention *)TINYAI_MALLOC(sizeof(TinyAISelfAttention));
+    if (!attention || tinyaiInitSelfAttention(attention, &params) != 0)
+        return NULL;
+
+    TinyAIMatrix4bit *weights[4];
+    for (int i = 0; i < 4; i++) {
+        TinyAIMatrixFP32 *fp32 = create_mock_matrix(hiddenDim, hiddenDim);
+        for (uint32_t j = 0; j < hiddenDim * hiddenDim; j++) {
+            fp32->data[j] = (float)((j * (i + 5)) % 9) / 9.0f - 0.45f;
+        }
+        weights[i] = tinyaiQuantizeFP32To4bit(fp32);
+        free_mock_matrix(fp32);
+    }
+    tinyaiSetAttentionWeights(attention, weights[0], weights[1], weights[2], weights[3], NULL,
+                              NULL, NULL, NULL);
+    for (int i = 0; i < 4; i++) {
+        tinyaiDestroyMatrix4bit(weights[i]);
+    }
+
+    return attention;
+}
+
+// Helper to create a transformer with an attention layer and dense weights
+TinyAIModel *create_test_attention_model(TinyAITokenizer *tokenizer, uint32_t hiddenSize,
+                                         uint32_t contextSize)
+{
+    TinyAIModel *model =
+        tinyaiCreateModel(TINYAI_MODEL_TYPE_TRANSFORMER, hiddenSize, contextSize, tokenizer);
+    if (!model)
+        return NULL;
+
+    tinyaiAddLayer(model, TINYAI_LAYER_EMBEDDING, tokenizer->tokenCount, hiddenSize,
+                   TINYAI_ACTIVATION_NONE);
+    tinyaiAddLayer(model, TINYAI_LAYER_ATTENTION, hiddenSize, hiddenSize, TINYAI_ACTIVATION_NONE);
+    tinyaiAddLayer(model, TINYAI_LAYER_DENSE, hiddenSize, hiddenSize, TINYAI_ACTIVATION_GELU);
+    tinyaiAddLayer(model, TINYAI_LAYER_OUTPUT, hiddenSize, tokenizer->tokenCount,
+                   TINYAI_ACTIVATION_NONE);
+
+    uint32_t sizes[4][2] = {{tokenizer->tokenCount, hiddenSize},
+                            {0, 0},
+                            {hiddenSize, hiddenSize},
+                            {hiddenSize, tokenizer->tokenCount}};
+    for (int i = 0; i < 4; i++) {
+        if (sizes[i][0] == 0)
+            continue;
+        TinyAIMatrixFP32 *fp32 = create_mock_matrix(sizes[i][0], sizes[i][1]);
+        for (uint32_t j = 0; j < sizes[i][0] * sizes[i][1]; j++) {
+            fp32->data[j] = (float)((j * 7 + i) % 13) / 13.0f - 0.3f;
+        }
+        TinyAIMatrix4bit *quantized = tinyaiQuantizeFP32To4bit(fp32);
+        model->layers[i].weights    = *quantized; // Copy the struct, model owns the data
+        TINYAI_FREE(quantized);
+        free_mock_matrix(fp32);
+    }
+    if (tinyaiSetLayerAttention(model, 1, create_test_attention(hiddenSize, contextSize, 2)) !=
+        0) {
+        tinyaiDestroyModel(model);
+        return NULL;
+    }
+
+    return model;
+}
+
+// Test sliding-window attention over a ring-buffer KV cache, alone and in a model
+void test_sliding_window_attention()
+{
+    printf("  Testing sliding-window attention...\n");
+
+    // One attention layer with a window of 3 positions and room for 8 new ones per call
+    TinyAISelfAttention *attention = create_test_attention(8, 8, 2);
+    ASSERT(attention != NULL, "Should create attention");
+    attention->params.windowSize = 3;
+
+    float input[28 * 8], full[8 * 8], cached[8 * 8];
+    for (int i = 0; i < 28 * 8; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+    ASSERT(tinyaiSelfAttentionForward(attention, input, full) == 0,
+           "Windowed full attention should succeed");
+
+    TinyAIKVCache *cache = tinyaiCreateKVCache(1, &attention->params);
+    ASSERT(cache != NULL && cache->windowSize == 3 && cache->maxSeqLength == 3,
+           "A short window should make a ring cache of window rows");
+
+    // Chunks of 2, 1 and 5 positions wrap the ring mid-chunk
+    const uint32_t chunks[3] = {2, 1, 5};
+    uint32_t       position  = 0;
+    for (int c = 0; c < 3; c++) {
+        ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input + position * 8, chunks[c],
+                                                cached + position * 8) == 0,
+               "Cached windowed attention should succeed");
+        ASSERT(tinyaiKVCacheAdvance(cache, chunks[c]) == 0, "Ring cache should advance");
+        position += chunks[c];
+    }
+    for (int i = 0; i < 8 * 8; i++) {
+        ASSERT(fabsf(cached[i] - full[i]) < 1e-4f,
+               "Ring-cache attention should match windowed full attention");
+    }
+
+    // The ring keeps going past its capacity; the newest position sees the last three inputs
+    for (; position < 28; position++) {
+        ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input + position * 8, 1,
+                                                cached) == 0,
+               "Streaming past the cache capacity should succeed");
+        ASSERT(tinyaiKVCacheAdvance(cache, 1) == 0, "Ring cache should keep advancing");
+    }
+    ASSERT(cache->length == 28 && tinyaiKVCacheFits(cache, 100), "Ring caches never fill up");
+    ASSERT(tinyaiSelfAttentionForward(attention, input + 20 * 8, full) == 0,
+           "Windowed full attention should succeed");
+    for (int i = 0; i < 8; i++) {
+        ASSERT(fabsf(cached[i] - full[7 * 8 + i]) < 1e-4f,
+               "Streamed attention should only see the window");
+    }
+
+    // A wrapped ring cannot be rewound, but saves and restores whole
+    ASSERT(tinyaiKVCacheTruncate(cache, 27) != 0, "A wrapped ring should not truncate");
+    size_t size   = tinyaiKVCacheSavedSize(cache);
+    void  *buffer = TINYAI_MALLOC(size);
+    ASSERT(buffer && tinyaiSaveKVCache(cache, buffer, size) == size, "Ring cache should save");
+    tinyaiResetKVCache(cache);
+    ASSERT(tinyaiRestoreKVCache(cache, buffer, size) == 0 && cache->length == 28,
+           "Ring cache should restore");
+    ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input, 1, full) == 0,
+           "Restored ring should keep streaming");
+    TINYAI_FREE(buffer);
+    tinyaiDestroyKVCache(cache);
+
+    // A model with a windowed layer streams prompts longer than its context
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 8);
+    ASSERT(model != NULL, "Should create model");
+    model->layers[1].attention->params.windowSize = 4;
+
+    int tokens[20];
+    for (int i = 0; i < 20; i++) {
+        tokens[i] = 4 + (i * 5) % 6;
+    }
+    float         *streamed    = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    float         *recent      = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    TinyAIKVCache *modelCache  = tinyaiCreateModelKVCache(model);
+    ASSERT(streamed && recent && modelCache && modelCache->windowSize == 4,
+           "Model cache should be a ring of the window");
+    ASSERT(tinyaiModelForwardCached(model, modelCache, tokens, 20, streamed) == 0,
+           "Cached forward should stream past the context size");
+    ASSERT(tinyaiModelForward(model, tokens + 12, 8, recent) == 0, "Forward pass should succeed");
+    for (uint32_t t = 0; t < tokenizer->tokenCount; t++) {
+        ASSERT(fabsf(streamed[t] - recent[t]) < 1e-4f,
+               "Streamed logits should depend only on the window");
+    }
+
+    TINYAI_FREE(streamed);
+    TINYAI_FREE(recent);
+    tinyaiDestroyKVCache(modelCache);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    tinyaiDestroySelfAttention(attention);
+    TINYAI_FREE(attention);
+    printf("    PASS\n");
+}
+
+// Test FP16 and INT8 key/value caches against full-precision attention
+void test_quantized_kv_cache()
+{
+    printf("  Testing quantized key/value caches...\n");
+
+    // Heads of 16 elements over 12 positions
+    TinyAISelfAttention *attention = create_test_attention(32, 12, 2);
+    ASSERT(attention != NULL, "Should create attention");
+
+    float input[12 * 32], full[12 * 32], cached[12 * 32];
+    for (int i = 0; i < 12 * 32; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+    ASSERT(tinyaiSelfAttentionForward(attention, input, full) == 0,
+           "Full attention should succeed");
+
+    const TinyAIKVCachePrecision precisions[3] = {TINYAI_KV_CACHE_FP32, TINYAI_KV_CACHE_FP16,
+                                                  TINYAI_KV_CACHE_INT8};
+    const uint32_t               rowSizes[3]   = {32, 16, 2 + 8};
+    const float                  tolerance[3]  = {1e-4f, 2e-3f, 3e-2f};
+
+    for (int p = 0; p < 3; p++) {
+        TinyAIAttentionParams params = attention->params;
+        params.kvCachePrecision      = precisions[p];
+        TinyAIKVCache *cache         = tinyaiCreateKVCache(1, &params);
+        ASSERT(cache != NULL && cache->precision == precisions[p], "Should create KV cache");
+        ASSERT(cache->rowSize == rowSizes[p], "Quantized rows should shrink the cache");
+
+        // Prefill most of the prompt, then decode the rest one position at a time
+        ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input, 7, cached) == 0,
+               "Cached prefill should succeed");
+        ASSERT(tinyaiKVCacheAdvance(cache, 7) == 0, "Cache should advance");
+        for (uint32_t position = 7; position < 12; position++) {
+            ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input + position * 32, 1,
+                                                    cached + position * 32) == 0,
+                   "Cached step should succeed");
+            ASSERT(tinyaiKVCacheAdvance(cache, 1) == 0, "Cache should advance");
+        }
+        for (int i = 0; i < 12 * 32; i++) {
+            ASSERT(fabsf(cached[i] - full[i]) < tolerance[p],
+                   "Quantized-cache attention should stay close to full precision");
+        }
+
+        // Saved caches restore only into caches of the same precision
+        size_t size   = tinyaiKVCacheSavedSize(cache);
+        void  *buffer = TINYAI_MALLOC(size);
+        ASSERT(buffer && tinyaiSaveKVCache(cache, buffer, size) == size, "Cache should save");
+        ASSERT(tinyaiKVCacheTruncate(cache, 11) == 0, "Cache should truncate");
+        float again[32];
+        ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input + 11 * 32, 1, again) ==
+                   0,
+               "Replayed step should succeed");
+        ASSERT(memcmp(again, cached + 11 * 32, sizeof(again)) == 0,
+               "Replaying a position should reproduce it exactly");
+        tinyaiResetKVCache(cache);
+        ASSERT(tinyaiRestoreKVCache(cache, buffer, size) == 0 && cache->length == 12,
+               "Cache should restore");
+
+        TinyAIAttentionParams otherParams = params;
+        otherParams.kvCachePrecision      = precisions[(p + 1) % 3];
+        TinyAIKVCache *other              = tinyaiCreateKVCache(1, &otherParams);
+        ASSERT(other && tinyaiRestoreKVCache(other, buffer, size) != 0,
+               "A cache should not restore another precision");
+        tinyaiDestroyKVCache(other);
+        TINYAI_FREE(buffer);
+        tinyaiDestroyKVCache(cache);
+    }
+
+    // A quantized ring cache streams the window like a full-precision one
+    attention->params.windowSize = 3;
+    ASSERT(tinyaiSelfAttentionForward(attention, input, full) == 0,
+           "Windowed full attention should succeed");
+    attention->params.kvCachePrecision = TINYAI_KV_CACHE_INT8;
+    TinyAIKVCache *ring                = tinyaiCreateKVCache(1, &attention->params);
+    ASSERT(ring != NULL && ring->windowSize == 3, "Should create a quantized ring cache");
+    ASSERT(tinyaiSelfAttentionForwardCached(attention, ring, 0, input, 12, cached) == 0,
+           "Quantized ring attention should succeed");
+    for (int i = 0; i < 12 * 32; i++) {
+        ASSERT(fabsf(cached[i] - full[i]) < tolerance[2],
+               "Quantized ring attention should stay close to full precision");
+    }
+    tinyaiDestroyKVCache(ring);
+
+    // Models cache their layers in each layer's precision
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 8);
+    ASSERT(model != NULL, "Should create model");
+    model->layers[1].attention->params.kvCachePrecision = TINYAI_KV_CACHE_FP16;
+    TinyAIKVCache *modelCache = tinyaiCreateModelKVCache(model);
+    ASSERT(modelCache && modelCache->precision == TINYAI_KV_CACHE_FP16,
+           "Model cache should use the layer's precision");
+
+    int    tokens[6] = {4, 7, 5, 9, 6, 8};
+    float *logits    = (float *)TINYAI_MALLOC(2 * tokenizer->tokenCount * sizeof(float));
+    ASSERT(logits != NULL, "Should allocate logits");
+    ASSERT(tinyaiModelForwardCached(model, modelCache, tokens, 6, logits) == 0 &&
+               tinyaiModelForward(model, tokens, 6, logits + tokenizer->tokenCount) == 0,
+           "Model forward passes should succeed");
+    for (uint32_t t = 0; t < tokenizer->tokenCount; t++) {
+        ASSERT(fabsf(logits[t] - logits[tokenizer->tokenCount + t]) < tolerance[1],
+               "FP16-cached logits should stay close to full precision");
+    }
+
+    TINYAI_FREE(logits);
+    tinyaiDestroyKVCache(modelCache);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    tinyaiDestroySelfAttention(attention);
+    TINYAI_FREE(attention);
+    printf("    PASS\n");
+}
+
+// Feed positions through both layers of a two-layer cache and advance it
+static int feed_two_layers(TinyAISelfAttention *attention, TinyAIKVCache *cache,
+                           const float *input, uint32_t count, float *output)
+{
+    for (uint32_t layer = 0; layer < 2; layer++) {
+        if (tinyaiSelfAttentionForwardCached(attention, cache, layer, input, count, output) != 0) {
+            return -1;
+        }
+    }
+    return tinyaiKVCacheAdvance(cache, count);
+}
+
+// Test paged key/value caches drawing on a shared block pool
+void test_paged_kv_cache()
+{
+    printf("  Testing paged key/value caches...\n");
+
+    // Two layers of 32-wide rows make 8 KB blocks, served by a key/value cache memory pool
+    TinyAISelfAttention *attention = create_test_attention(32, 40, 2);
+    ASSERT(attention != NULL, "Should create attention");
+
+    TinyAIAdvancedPoolConfig config;
+    tinyaiAdvancedPoolGetDefaultConfig(&config);
+    memset(config.initialCapacity, 0, sizeof(config.initialCapacity));
+    memset(config.maxCapacity, 0, sizeof(config.maxCapacity));
+    config.initialCapacity[TINYAI_POOL_USAGE_KV_CACHE][TINYAI_POOL_SIZE_XLARGE] = 256 * 1024;
+    config.maxCapacity[TINYAI_POOL_USAGE_KV_CACHE][TINYAI_POOL_SIZE_XLARGE]     = 256 * 1024;
+    TinyAIAdvancedMemoryPool *memory = tinyaiAdvancedPoolCreate(&config);
+    TinyAIKVBlockPool        *pool   = tinyaiCreateKVBlockPool(2, &attention->params, 6, memory);
+    ASSERT(memory && pool && tinyaiKVBlockPoolFreeBlocks(pool) == 6, "Should create block pool");
+
+    float input[40 * 32], other[32], expected[40 * 32], paged[40 * 32];
+    for (int i = 0; i < 40 * 32; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+    for (int i = 0; i < 32; i++) {
+        other[i] = (float)((i * 5) % 11) / 11.0f - 0.5f;
+    }
+
+    // Prefill 20 positions, then decode up to 24; paged rows give bit-identical attention
+    TinyAIKVCache *contiguous = tinyaiCreateKVCache(2, &attention->params);
+    TinyAIKVCache *cache      = tinyaiCreatePagedKVCache(pool);
+    ASSERT(contiguous && cache && cache->blockTable && !cache->keys, "Should create caches");
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 6, "New paged caches should hold no blocks");
+    ASSERT(feed_two_layers(attention, contiguous, input, 20, expected) == 0 &&
+               feed_two_layers(attention, cache, input, 20, paged) == 0,
+           "Cached prefill should succeed");
+    for (uint32_t position = 20; position < 24; position++) {
+        ASSERT(feed_two_layers(attention, contiguous, input + position * 32, 1,
+                               expected + position * 32) == 0 &&
+                   feed_two_layers(attention, cache, input + position * 32, 1,
+                                   paged + position * 32) == 0,
+               "Cached steps should succeed");
+    }
+    ASSERT(memcmp(paged, expected, 24 * 32 * sizeof(float)) == 0,
+           "Paged attention should match contiguous attention exactly");
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 4, "24 positions should hold two blocks");
+
+    // Paged and contiguous caches save the same state
+    size_t size     = tinyaiKVCacheSavedSize(cache);
+    void  *buffer   = TINYAI_MALLOC(size);
+    void  *expSaved = TINYAI_MALLOC(size);
+    ASSERT(buffer && expSaved && tinyaiSaveKVCache(cache, buffer, size) == size &&
+               tinyaiSaveKVCache(contiguous, expSaved, size) == size,
+           "Caches should save");
+    ASSERT(memcmp(buffer, expSaved, size) == 0, "Saved paged state should match contiguous state");
+
+    // A fork shares every block until it diverges inside the second one
+    TinyAIKVCache *fork         = tinyaiForkKVCache(cache);
+    TinyAIKVCache *forkExpected = tinyaiForkKVCache(contiguous);
+    ASSERT(fork && forkExpected && fork->length == 24, "Caches should fork");
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 4, "A fork should share its blocks");
+    ASSERT(tinyaiKVCacheTruncate(fork, 20) == 0 && tinyaiKVCacheTruncate(forkExpected, 20) == 0,
+           "Forks should truncate");
+    ASSERT(feed_two_layers(attention, fork, other, 1, paged) == 0 &&
+               feed_two_layers(attention, forkExpected, other, 1, expected) == 0,
+           "Diverging steps should succeed");
+    ASSERT(memcmp(paged, expected, 32 * sizeof(float)) == 0,
+           "A diverged fork should attend over its own rows");
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 3, "Writing a shared block should copy it");
+
+    // The original still sees its own rows
+    ASSERT(feed_two_layers(attention, cache, input + 24 * 32, 1, paged) == 0 &&
+               feed_two_layers(attention, contiguous, input + 24 * 32, 1, expected) == 0,
+           "Steps after the fork should succeed");
+    ASSERT(memcmp(paged, expected, 32 * sizeof(float)) == 0,
+           "Copy-on-write should leave the original's rows untouched");
+
+    // Running the pool dry makes caches report that new positions do not fit
+    TinyAIKVCache *filler = tinyaiCreatePagedKVCache(pool);
+    ASSERT(filler && tinyaiKVCacheFits(filler, 40) && !tinyaiKVCacheFits(filler, 41),
+           "Three free blocks should fit a full sequence");
+    ASSERT(feed_two_layers(attention, filler, input, 40, paged) == 0,
+           "Filling the pool should succeed");
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 0 && !tinyaiKVCacheFits(fork, 12) &&
+               tinyaiKVCacheFits(fork, 11),
+           "Positions without a block should not fit an exhausted pool");
+    ASSERT(tinyaiSelfAttentionForwardCached(attention, fork, 0, input, 12, paged) != 0,
+           "Attention needing a block from an exhausted pool should fail");
+    tinyaiResetKVCache(filler);
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 3, "Reset should hand blocks back");
+
+    // Saved state restores into a paged cache, taking fresh blocks
+    ASSERT(tinyaiRestoreKVCache(filler, buffer, size) == 0 && filler->length == 24,
+           "Paged cache should restore");
+    ASSERT(feed_two_layers(attention, filler, input + 24 * 32, 1, paged) == 0,
+           "Restored paged cache should keep decoding");
+    ASSERT(memcmp(paged, expected, 32 * sizeof(float)) == 0,
+           "Restored paged cache should match the saved one");
+    ASSERT(tinyaiKVCacheTruncate(filler, 10) == 0 && tinyaiKVBlockPoolFreeBlocks(pool) == 2,
+           "Truncating should release whole blocks past the length");
+
+    TINYAI_FREE(buffer);
+    TINYAI_FREE(expSaved);
+    tinyaiDestroyKVCache(filler);
+    tinyaiDestroyKVCache(fork);
+    tinyaiDestroyKVCache(forkExpected);
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroyKVCache(contiguous);
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 6, "Destroyed caches should release their blocks");
+    tinyaiDestroyKVBlockPool(pool);
+    tinyaiAdvancedPoolDestroy(memory);
+
+    // Model caches page from a pool built for the model
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 8);
+    ASSERT(model != NULL, "Should create model");
+    TinyAIKVBlockPool *modelPool  = tinyaiCreateModelKVBlockPool(model, 4, NULL);
+    TinyAIKVCache     *modelCache = tinyaiCreateModelPagedKVCache(model, modelPool);
+    TinyAIKVCache     *reference  = tinyaiCreateModelKVCache(model);
+    ASSERT(modelCache && reference, "Should create model caches");
+
+    int    tokens[6] = {4, 7, 5, 9, 6, 8};
+    float *logits    = (float *)TINYAI_MALLOC(2 * tokenizer->tokenCount * sizeof(float));
+    ASSERT(logits != NULL, "Should allocate logits");
+    ASSERT(tinyaiModelForwardCached(model, modelCache, tokens, 6, logits) == 0 &&
+               tinyaiModelForwardCached(model, reference, tokens, 6,
+                                        logits + tokenizer->tokenCount) == 0,
+           "Model forward passes should succeed");
+    ASSERT(memcmp(logits, logits + tokenizer->tokenCount, tokenizer->tokenCount * sizeof(float)) ==
+               0,
+           "Paged model cache should give the same logits");
+
+    TINYAI_FREE(logits);
+    tinyaiDestroyKVCache(modelCache);
+    tinyaiDestroyKVCache(reference);
+    tinyaiDestroyKVBlockPool(modelPool);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    tinyaiDestroySelfAttention(attention);
+    TINYAI_FREE(attention);
+    printf("    PASS\n");
+}
+
+// Test discarding a run of cached positions from contiguous and paged caches
+void test_kv_cache_discard()
+{
+    printf("  Testing key/value cache position discards...\n");
+
+    TinyAISelfAttention *attention = create_test_attention(32, 40, 2);
+    TinyAIKVBlockPool   *pool      = tinyaiCreateKVBlockPool(2, &attention->params, 6, NULL);
+    ASSERT(attention && pool, "Should create attention and block pool");
+
+    float input[25 * 32], expected[25 * 32], actual[25 * 32];
+    for (int i = 0; i < 25 * 32; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+
+    // Keys and values only depend on their own position, so discarding positions 4 to 13
+    // leaves the cache a prefill of the other positions would have built
+    TinyAIKVCache *cache     = tinyaiCreateKVCache(2, &attention->params);
+    TinyAIKVCache *paged     = tinyaiCreatePagedKVCache(pool);
+    TinyAIKVCache *reference = tinyaiCreateKVCache(2, &attention->params);
+    ASSERT(cache && paged && reference, "Should create caches");
+    ASSERT(feed_two_layers(attention, cache, input, 24, actual) == 0 &&
+               feed_two_layers(attention, paged, input, 24, actual) == 0 &&
+               feed_two_layers(attention, reference, input, 4, expected) == 0 &&
+               feed_two_layers(attention, reference, input + 14 * 32, 10, expected) == 0,
+           "Prefills should succeed");
+
+    // The paged cache shares its blocks with a fork, so the move copies the first one
+    TinyAIKVCache *fork = tinyaiForkKVCache(paged);
+    ASSERT(fork && tinyaiKVBlockPoolFreeBlocks(pool) == 4, "A fork should share its blocks");
+    ASSERT(tinyaiKVCacheDiscard(cache, 4, 10) == 0 && tinyaiKVCacheDiscard(paged, 4, 10) == 0,
+           "Discards should succeed");
+    ASSERT(cache->length == 14 && paged->length == 14, "Discards should shorten the caches");
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 3,
+           "Moving rows into a shared block should copy it, and the emptied block is released");
+
+    ASSERT(feed_two_layers(attention, reference, input + 24 * 32, 1, expected) == 0 &&
+               feed_two_layers(attention, cache, input + 24 * 32, 1, actual) == 0,
+           "Steps after the discard should succeed");
+    ASSERT(memcmp(actual, expected, 32 * sizeof(float)) == 0,
+           "A contiguous cache should attend as if the positions were never fed");
+    ASSERT(feed_two_layers(attention, paged, input + 24 * 32, 1, actual) == 0,
+           "Paged steps after the discard should succeed");
+    ASSERT(memcmp(actual, expected, 32 * sizeof(float)) == 0,
+           "A paged cache should attend as if the positions were never fed");
+
+    // The fork keeps all 24 positions
+    tinyaiResetKVCache(reference);
+    ASSERT(feed_two_layers(attention, reference, input, 25, expected) == 0 &&
+               feed_two_layers(attention, fork, input + 24 * 32, 1, actual) == 0,
+           "Fork steps should succeed");
+    ASSERT(memcmp(actual, expected + 24 * 32, 32 * sizeof(float)) == 0,
+           "Discarding from a cache should leave its forks untouched");
+
+    // Discarding up to the end truncates, and out-of-range runs are rejected
+    ASSERT(tinyaiKVCacheDiscard(cache, 5, 0) == 0 && cache->length == 15,
+           "Discarding nothing should succeed");
+    ASSERT(tinyaiKVCacheDiscard(cache, 10, 6) != 0 && tinyaiKVCacheDiscard(cache, 16, 0) != 0,
+           "Discarding past the length should fail");
+    ASSERT(tinyaiKVCacheDiscard(cache, 10, 5) == 0 && cache->length == 10,
+           "Discarding the newest positions should succeed");
+
+    tinyaiDestroyKVCache(fork);
+    tinyaiDestroyKVCache(paged);
+    ASSERT(tinyaiKVBlockPoolFreeBlocks(pool) == 6, "Destroyed caches should release their blocks");
+    tinyaiDestroyKVCache(reference);
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroyKVBlockPool(pool);
+    tinyaiDestroySelfAttention(attention);
+    TINYAI_FREE(attention);
+    printf("    PASS\n");
+}
+
+// Test the AVX-512 and VNNI attention kernels against the narrower kernels they replace
+void test_avx512_attention()
+{
+    printf("  Testing AVX-512 attention kernels...\n");
+
+    if (!tinyaiSimdHasAVX512()) {
+        printf("    SKIP - AVX-512 not available\n");
+        return;
+    }
+
+    // Heads of 72 elements end in a partial 16-float vector and a partial 64-byte block, over
+    // more than two tiles of keys
+    const uint32_t       seqLength = 2 * TINYAI_ATTENTION_TILE + 5;
+    const uint32_t       hidden    = 144;
+    TinyAISelfAttention *attention = create_test_attention(hidden, seqLength, 2);
+    ASSERT(attention != NULL, "Should create attention");
+
+    size_t rowsSize = (size_t)seqLength * hidden;
+    float *input    = (float *)TINYAI_MALLOC(3 * rowsSize * sizeof(float));
+    ASSERT(input != NULL, "Should allocate attention buffers");
+    float *narrow = input + rowsSize;
+    float *wide   = narrow + rowsSize;
+    for (size_t i = 0; i < rowsSize; i++) {
+        input[i] = (float)((i * 7) % 13) / 13.0f - 0.4f;
+    }
+
+    // INT8 keys are scored against an int8 query by VNNI, which adds the query's rounding
+    const TinyAIKVCachePrecision precisions[2] = {TINYAI_KV_CACHE_FP32, TINYAI_KV_CACHE_INT8};
+    const float                  tolerance[2]  = {1e-4f, 1e-2f};
+
+    for (int p = 0; p < 2; p++) {
+        attention->params.kvCachePrecision = precisions[p];
+        for (int enabled = 0; enabled < 2; enabled++) {
+            tinyaiSimdSetAVX512Enabled(enabled != 0);
+            TinyAIKVCache *cache = tinyaiCreateKVCache(1, &attention->params);
+            ASSERT(cache != NULL, "Should create KV cache");
+            ASSERT(tinyaiSelfAttentionForwardCached(attention, cache, 0, input, seqLength,
+                                                    enabled ? wide : narrow) == 0,
+                   "Cached attention should succeed");
+            tinyaiDestroyKVCache(cache);
+        }
+        for (size_t i = 0; i < rowsSize; i++) {
+            ASSERT(fabsf(wide[i] - narrow[i]) < tolerance[p],
+                   "AVX-512 attention should match the narrower kernels");
+        }
+    }
+
+    // Turning the kernels off also turns off VNNI
+    tinyaiSimdSetAVX512Enabled(false);
+    ASSERT(!tinyaiSimdHasAVX512() && !tinyaiSimdHasAVX512VNNI(),
+           "Disabled AVX-512 kernels should not be selected");
+    tinyaiSimdSetAVX512Enabled(true);
+
+    TINYAI_FREE(input);
+    tinyaiDestroySelfAttention(attention);
+    TINYAI_FREE(attention);
+    printf("    PASS\n");
+}
+
+// Test compiling models into execution plans
+void test_model_prepare()
+{
+    printf("  Testing model execution plans...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_transformer(tokenizer, 4, 8);
+    ASSERT(model != NULL, "Should create test transformer");
+    ASSERT(model->plan == NULL, "Models built layer by layer should start unprepared");
+
+    int    tokens[3] = {TINYAI_TOKEN_BOS, 5, 7};
+    float *lazy      = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    float *prepared  = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    ASSERT(lazy && prepared, "Should allocate logits");
+
+    // The first forward pass prepares the model
+    ASSERT(tinyaiModelForward(model, tokens, 3, lazy) == 0, "Forward pass should succeed");
+    ASSERT(model->plan != NULL, "Forward pass should prepare the model");
+
+    ASSERT(tinyaiPrepareModel(model) == 0, "Preparing a transformer should succeed");
+    ASSERT(tinyaiModelForward(model, tokens, 3, prepared) == 0, "Forward pass should succeed");
+    ASSERT(memcmp(lazy, prepared, tokenizer->tokenCount * sizeof(float)) == 0,
+           "Re-preparing should not change the logits");
+
+    tinyaiDestroyModel(model);
+
+    // RNN models only run position-wise layers
+    model = tinyaiCreateModel(TINYAI_MODEL_TYPE_RNN, 4, 8, tokenizer);
+    tinyaiAddLayer(model, TINYAI_LAYER_EMBEDDING, tokenizer->tokenCount, 4,
+                   TINYAI_ACTIVATION_NONE);
+    tinyaiAddLayer(model, TINYAI_LAYER_OUTPUT, 4, tokenizer->tokenCount, TINYAI_ACTIVATION_NONE);
+    ASSERT(tinyaiPrepareModel(model) == 0, "Preparing an RNN should succeed");
+
+    // Changing the layers discards the plan
+    tinyaiAddLayer(model, TINYAI_LAYER_ATTENTION, 4, 4, TINYAI_ACTIVATION_NONE);
+    ASSERT(model->plan == NULL, "Adding a layer should discard the plan");
+    ASSERT(tinyaiPrepareModel(model) != 0, "RNN models should reject attention layers");
+    ASSERT(tinyaiModelForward(model, tokens, 3, lazy) != 0,
+           "Forward pass of an unpreparable model should fail");
+
+    TINYAI_FREE(lazy);
+    TINYAI_FREE(prepared);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Replace a model layer's weights with pruned levels of -1 + 0.2 q, so that
+// pruned weights quantize to exactly zero
+static void set_pruned_weights(TinyAIModel *model, uint32_t index, bool blocks, float rate)
+{
+    TinyAILayer      *layer = &model->layers[index];
+    TinyAIMatrixFP32 *fp32  = create_mock_matrix(layer->inputSize, layer->outputSize);
+    int               rows = (int)layer->inputSize, cols = (int)layer->outputSize;
+
+    for (int i = 0; i < rows * cols; i++) {
+        fp32->data[i] = -1.0f + 0.2f * (float)(rand() % 16);
+    }
+    if (blocks) {
+        // 8 x 4 blocks of the [input x output] weights are 4 x 8 blocks of the transpose
+        tinyaiPruneMatrixBlocks(fp32->data, rows, cols, 8, 4, rate);
+    }
+    else {
+        tinyaiPruneMatrixRandom(fp32->data, rows, cols, rate);
+    }
+    fp32->data[0] = -1.0f;
+    fp32->data[1] = 2.0f;
+
+    TinyAIMatrix4bit *quantized = tinyaiQuantizeFP32To4bit(fp32);
+    tinyaiReleaseMatrix4bit(&layer->weights);
+    layer->weights = *quantized; // Copy the struct, model owns the data
+    TINYAI_FREE(quantized);
+    free_mock_matrix(fp32);
+}
+
+// Test choosing sparse weight formats for pruned layers when preparing a model
+void test_sparse_weight_formats()
+{
+    printf("  Testing sparse weight format selection...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_transformer(tokenizer, 32, 8);
+    ASSERT(model != NULL, "Should create test transformer");
+
+    uint32_t vocabSize = tokenizer->tokenCount;
+    int      tokens[5] = {TINYAI_TOKEN_BOS, 5, 7, 4, 9};
+    float   *dense     = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *sparse    = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(dense && sparse, "Should allocate logits");
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+
+    // Unpruned layers stay dense
+    ASSERT(tinyaiGetLayerWeightFormat(model, 1) == TINYAI_WEIGHT_FORMAT_DENSE &&
+               tinyaiGetLayerWeightFormat(model, 2) == TINYAI_WEIGHT_FORMAT_DENSE,
+           "Unpruned layers should keep their packed weights");
+    ASSERT(tinyaiGetLayerWeightFormat(model, 3) == -1, "Out-of-range layers should fail");
+
+    // Block-pruned weights run on BSR, scattered ones on CSR, with the same logits
+    const bool  blocks[2]   = {true, false};
+    const float rates[2]    = {0.75f, 0.97f};
+    const int   expected[2] = {TINYAI_WEIGHT_FORMAT_BSR, TINYAI_WEIGHT_FORMAT_CSR_4BIT};
+    for (int c = 0; c < 2; c++) {
+        set_pruned_weights(model, 1, blocks[c], rates[c]);
+
+        tinyaiConfigSetBool("model.sparse_kernels", 0);
+        ASSERT(tinyaiPrepareModel(model) == 0 &&
+                   tinyaiGetLayerWeightFormat(model, 1) == TINYAI_WEIGHT_FORMAT_DENSE,
+               "Disabling sparse kernels should keep pruned layers dense");
+        ASSERT(tinyaiModelForward(model, tokens, 5, dense) == 0, "Forward pass should succeed");
+
+        tinyaiConfigRemoveKey("model.sparse_kernels");
+        ASSERT(tinyaiPrepareModel(model) == 0 &&
+                   tinyaiGetLayerWeightFormat(model, 1) == expected[c],
+               "Pruned layers should get the format suited to their pattern");
+        ASSERT(tinyaiModelForward(model, tokens, 5, sparse) == 0, "Forward pass should succeed");
+        ASSERT(relative_max_error(dense, sparse, vocabSize) < 1e-4f,
+               "Sparse weights should produce the same logits");
+
+        // Timing the candidates picks one that computes the same logits
+        tinyaiConfigSetBool("model.sparse_benchmark", 1);
+        ASSERT(tinyaiPrepareModel(model) == 0 && tinyaiGetLayerWeightFormat(model, 1) >= 0,
+               "Benchmarking the formats should succeed");
+        ASSERT(tinyaiModelForward(model, tokens, 5, sparse) == 0, "Forward pass should succeed");
+        ASSERT(relative_max_error(dense, sparse, vocabSize) < 1e-4f,
+               "The benchmarked format should produce the same logits");
+        tinyaiConfigRemoveKey("model.sparse_benchmark");
+    }
+
+    TINYAI_FREE(dense);
+    TINYAI_FREE(sparse);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test autotuning the weight format and threads of each layer over the first forward passes
+void test_autotune_layers()
+{
+    printf("  Testing layer autotuning...\n");
+
+    const char      *path      = "test_autotune_layers.tsnp";
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_transformer(tokenizer, 32, 8);
+    ASSERT(model != NULL, "Should create test transformer");
+    set_pruned_weights(model, 1, true, 0.75f);
+
+    uint32_t vocabSize = tokenizer->tokenCount;
+    int      tokens[5] = {TINYAI_TOKEN_BOS, 5, 7, 4, 9};
+    float   *expected  = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *tuned     = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(expected && tuned, "Should allocate logits");
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+
+    tinyaiConfigSetBool("model.sparse_kernels", 0);
+    ASSERT(tinyaiPrepareModel(model) == 0 && tinyaiModelForward(model, tokens, 5, expected) == 0,
+           "Dense forward pass should succeed");
+    tinyaiConfigRemoveKey("model.sparse_kernels");
+    ASSERT(tinyaiGetAutotunePassesLeft(model) == 0, "Autotuning should be off by default");
+    ASSERT(tinyaiGetLayerThreads(model, 1) == TINYAI_LAYER_THREADS_POOL,
+           "Layers should run on the thread pool by default");
+    ASSERT(tinyaiGetLayerThreads(model, 3) == -1, "Out-of-range layers should fail");
+
+    // Every pass of the tuning window and after it computes the same logits
+    tinyaiConfigSetInt("system.threads", 2);
+    tinyaiShutdownThreadPool();
+    tinyaiConfigSetInt("model.autotune_passes", 3);
+    ASSERT(tinyaiPrepareModel(model) == 0 && tinyaiGetAutotunePassesLeft(model) == 3,
+           "Preparing should start autotuning");
+    for (uint32_t pass = 0; pass < 4; pass++) {
+        ASSERT(tinyaiModelForward(model, tokens, 5 - pass, tuned) == 0,
+               "Autotuned forward pass should succeed");
+        ASSERT(tinyaiModelForward(model, tokens, 5, tuned) == 0 &&
+                   relative_max_error(expected, tuned, vocabSize) < 1e-4f,
+               "Autotuning should not change the logits");
+    }
+    ASSERT(tinyaiGetAutotunePassesLeft(model) == 0, "Autotuning should end after its passes");
+    int format  = tinyaiGetLayerWeightFormat(model, 1);
+    int threads = tinyaiGetLayerThreads(model, 1);
+    ASSERT(format >= 0 && threads >= 0, "Autotuned layers should keep a candidate");
+
+    // Snapshots keep the tuned choices instead of tuning again
+    ASSERT(tinyaiSaveModelSnapshot(model, path) == 0, "Should save the tuned model");
+    TinyAIModel *loaded = tinyaiLoadModelSnapshot(path);
+    ASSERT(loaded != NULL && tinyaiGetAutotunePassesLeft(loaded) == 0,
+           "Loading a snapshot should not autotune again");
+    ASSERT(tinyaiGetLayerWeightFormat(loaded, 1) == format &&
+               tinyaiGetLayerThreads(loaded, 1) == threads,
+           "The loaded model should run the recorded format and threads");
+    ASSERT(tinyaiModelForward(loaded, tokens, 5, tuned) == 0 &&
+               relative_max_error(expected, tuned, vocabSize) < 1e-4f,
+           "The tuned snapshot should compute the same logits");
+
+    tinyaiConfigRemoveKey("model.autotune_passes");
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiShutdownThreadPool();
+
+    TINYAI_FREE(expected);
+    TINYAI_FREE(tuned);
+    tinyaiDestroyModel(loaded);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    remove(path);
+    printf("    PASS\n");
+}
+
+// Test that recurrent layers carry their hidden state between cached calls
+void test_rnn_state()
+{
+    printf("  Testing recurrent state between calls...\n");
+
+    TinyAITokenizer *tokenizer  = create_test_tokenizer();
+    uint32_t         hiddenSize = 4;
+    TinyAIModel *model = tinyaiCreateModel(TINYAI_MODEL_TYPE_RNN, hiddenSize, 8, tokenizer);
+
+    tinyaiAddLayer(model, TINYAI_LAYER_EMBEDDING, tokenizer->tokenCount, hiddenSize,
+                   TINYAI_ACTIVATION_NONE);
+    tinyaiAddLayer(model, TINYAI_LAYER_RNN, hiddenSize, hiddenSize, TINYAI_ACTIVATION_TANH);
+    tinyaiAddLayer(model, TINYAI_LAYER_OUTPUT, hiddenSize, tokenizer->tokenCount,
+                   TINYAI_ACTIVATION_NONE);
+
+    // The recurrent layer multiplies [input; hidden]
+    uint32_t sizes[3][2] = {{tokenizer->tokenCount, hiddenSize},
+                            {2 * hiddenSize, hiddenSize},
+                            {hiddenSize, tokenizer->tokenCount}};
+    for (int i = 0; i < 3; i++) {
+        TinyAIMatrixFP32 *fp32 = create_mock_matrix(sizes[i][0], sizes[i][1]);
+        for (uint32_t j = 0; j < sizes[i][0] * sizes[i][1]; j++) {
+            fp32->data[j] = ((float)rand() / RAND_MAX) - 0.5f;
+        }
+        TinyAIMatrix4bit *quantized = tinyaiQuantizeFP32To4bit(fp32);
+        model->layers[i].weights    = *quantized; // Copy the struct, model owns the data
+        TINYAI_FREE(quantized);
+        free_mock_matrix(fp32);
+    }
+
+    TinyAIKVCache *cache = tinyaiCreateModelKVCache(model);
+    ASSERT(cache != NULL && cache->stateSize == hiddenSize,
+           "Cache should hold the recurrent hidden state");
+
+    uint32_t vocabSize = tokenizer->tokenCount;
+    int      tokens[6] = {TINYAI_TOKEN_BOS, 5, 7, 4, 9, 6};
+    float   *stepped   = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *full      = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *resumed   = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(stepped && full && resumed, "Should allocate logits");
+
+    // One token per call matches a stateless pass over the whole sequence
+    for (int n = 1; n <= 6; n++) {
+        ASSERT(tinyaiModelForwardCached(model, cache, tokens + n - 1, 1, stepped) == 0,
+               "Cached decode step should succeed");
+        ASSERT(tinyaiModelForward(model, tokens, n, full) == 0, "Full forward pass should succeed");
+        for (uint32_t i = 0; i < vocabSize; i++) {
+            ASSERT(fabsf(stepped[i] - full[i]) < 1e-5f,
+                   "Stepped logits should match full recomputation");
+        }
+    }
+
+    // Earlier tokens now influence the logits
+    ASSERT(tinyaiModelForward(model, tokens + 5, 1, full) == 0, "Forward pass should succeed");
+    ASSERT(memcmp(stepped, full, vocabSize * sizeof(float)) != 0,
+           "Logits should depend on earlier tokens");
+
+    // The hidden state cannot be rewound
+    ASSERT(tinyaiKVCacheTruncate(cache, 3) != 0, "Recurrent state should not be truncated");
+
+    // Suspend the session, continue it, then resume a copy from the saved state
+    size_t   savedSize = tinyaiKVCacheSavedSize(cache);
+    uint8_t *saved     = (uint8_t *)TINYAI_MALLOC(savedSize);
+    ASSERT(saved != NULL, "Should allocate saved state");
+    ASSERT(tinyaiSaveKVCache(cache, saved, savedSize) == savedSize, "Saving should succeed");
+
+    int next = 8;
+    ASSERT(tinyaiModelForwardCached(model, cache, &next, 1, stepped) == 0,
+           "Decode step should succeed");
+
+    TinyAIKVCache *restored = tinyaiCreateModelKVCache(model);
+    ASSERT(restored != NULL, "Should create second cache");
+    ASSERT(tinyaiRestoreKVCache(restored, saved, savedSize - 1) != 0,
+           "Restoring a truncated buffer should fail");
+    ASSERT(tinyaiRestoreKVCache(restored, saved, savedSize) == 0, "Restoring should succeed");
+    ASSERT(restored->length == 6, "Restored cache should hold the saved positions");
+    ASSERT(tinyaiModelForwardCached(model, restored, &next, 1, resumed) == 0,
+           "Decode step after restoring should succeed");
+    ASSERT(memcmp(stepped, resumed, vocabSize * sizeof(float)) == 0,
+           "Resumed session should continue exactly where it was saved");
+
+    TINYAI_FREE(saved);
+    TINYAI_FREE(stepped);
+    TINYAI_FREE(full);
+    TINYAI_FREE(resumed);
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroyKVCache(restored);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test that prefilling a long prompt in one pass matches decoding it token by token
+void test_batched_prefill()
+{
+    printf("  Testing batched prompt prefill...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    // Long enough for the prompt GEMMs to be tiled over positions
+    const int    promptLength = 80;
+    TinyAIModel *model        = create_test_attention_model(tokenizer, 64, promptLength);
+    ASSERT(model != NULL, "Should create model");
+
+    TinyAIKVCache *batchCache = tinyaiCreateModelKVCache(model);
+    TinyAIKVCache *stepCache  = tinyaiCreateModelKVCache(model);
+    ASSERT(batchCache && stepCache, "Should create KV caches");
+
+    int tokens[80];
+    for (int i = 0; i < promptLength; i++) {
+        tokens[i] = 4 + (i * 5) % (int)(tokenizer->tokenCount - 4);
+    }
+
+    float *batchLogits = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    float *stepLogits  = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    ASSERT(batchLogits && stepLogits, "Should allocate logits");
+
+    ASSERT(tinyaiModelForwardCached(model, batchCache, tokens, promptLength, batchLogits) == 0,
+           "Batched prefill should succeed");
+    for (int i = 0; i < promptLength; i++) {
+        ASSERT(tinyaiModelForwardCached(model, stepCache, tokens + i, 1, stepLogits) == 0,
+               "Token-by-token prefill should succeed");
+    }
+
+    // Every position's GEMM row is computed exactly as the single-position product
+    ASSERT(memcmp(batchLogits, stepLogits, tokenizer->tokenCount * sizeof(float)) == 0,
+           "Batched prefill logits should match token-by-token decoding");
+    ASSERT(memcmp(batchCache->keys, stepCache->keys,
+                  (size_t)promptLength * batchCache->hiddenDim * sizeof(float)) == 0,
+           "Batched prefill should cache the same keys");
+
+    TINYAI_FREE(batchLogits);
+    TINYAI_FREE(stepLogits);
+    tinyaiDestroyKVCache(batchCache);
+    tinyaiDestroyKVCache(stepCache);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test batched generation against generating each sequence on its own
+void test_generate_text_batch()
+{
+    printf("  Testing batched text generation...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    // Small context so long sequences overflow the cache
+    TinyAIModel *model = create_test_attention_model(tokenizer, 8, 6);
+    ASSERT(model != NULL, "Should create model");
+
+    // Different prompts, sampling settings, seeds and limits per sequence
+    int                    promptA[3] = {TINYAI_TOKEN_BOS, 5, 9};
+    int                    promptB[1] = {7};
+    TinyAIGenerationParams params[3];
+    memset(params, 0, sizeof(params));
+    params[0].maxTokens      = 12;
+    params[0].samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params[0].temperature    = 1.5f;
+    params[0].seed           = 7;
+    params[0].promptTokens   = promptA;
+    params[0].promptLength   = 3;
+    params[1].maxTokens      = 5;
+    params[1].samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params[1].temperature    = 1.0f;
+    params[1].seed           = 1;
+    params[2].maxTokens      = 10;
+    params[2].samplingMethod = TINYAI_SAMPLING_TOP_K;
+    params[2].temperature    = 1.0f;
+    params[2].topK           = 4;
+    params[2].seed           = 99;
+    params[2].promptTokens   = promptB;
+    params[2].promptLength   = 1;
+
+    int  batchTokens[3][16];
+    int *batchOutputs[3] = {batchTokens[0], batchTokens[1], batchTokens[2]};
+    int  batchCounts[3];
+    ASSERT(tinyaiGenerateTextBatch(model, params, 3, batchOutputs, 16, batchCounts) == 0,
+           "Batched generation should succeed");
+
+    for (int b = 0; b < 3; b++) {
+        int singleTokens[16];
+        int singleCount = tinyaiGenerateText(model, &params[b], singleTokens, 16);
+
+        ASSERT(batchCounts[b] == singleCount,
+               "Batched sequence should have the same length as its single run");
+        for (int i = 0; i < singleCount; i++) {
+            ASSERT(batchTokens[b][i] == singleTokens[i],
+                   "Batched sequence should match its single run");
+        }
+    }
+
+    ASSERT(tinyaiGenerateTextBatch(model, params, 0, batchOutputs, 16, batchCounts) != 0,
+           "Empty batch should be rejected");
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Logits after a whole sequence, computed in a fresh contiguous cache
+static void sequence_logits(TinyAIModel *model, const int *tokens, int count, float *logits)
+{
+    TinyAIKVCache *cache = tinyaiCreateModelKVCache(model);
+    ASSERT(cache != NULL && tinyaiModelForwardCached(model, cache, tokens, count, logits) == 0,
+           "Reference forward pass should succeed");
+    tinyaiDestroyKVCache(cache);
+}
+
+// Reference beam search: every hypothesis is rescored from scratch each step
+static int reference_beam_search(TinyAIModel *model, const int *prompt, int promptLength,
+                                 int width, int maxTokens, int *output)
+{
+    enum { MAX_WIDTH = 4, MAX_TOKENS = 16 };
+    int   vocabSize = (int)model->tokenizer->tokenCount;
+    int   beams[MAX_WIDTH][MAX_TOKENS], next[MAX_WIDTH][MAX_TOKENS];
+    float scores[MAX_WIDTH], nextScores[MAX_WIDTH];
+    int   numBeams = 1, length = 0, finished = 0, bestLength = 0;
+    float bestScore = -INFINITY;
+    int   best[MAX_TOKENS];
+    float logits[64];
+    ASSERT(vocabSize <= 64 && width <= MAX_WIDTH && maxTokens <= MAX_TOKENS,
+           "Reference beam search limits");
+
+    memcpy(beams[0], prompt, promptLength * sizeof(int));
+    scores[0] = 0.0f;
+    while (numBeams > 0) {
+        // Score every continuation of every beam, best first
+        float candScore[MAX_WIDTH * 64];
+        int   candParent[MAX_WIDTH * 64], candToken[MAX_WIDTH * 64], numCand = 0;
+        for (int b = 0; b < numBeams; b++) {
+            sequence_logits(model, beams[b], promptLength + length, logits);
+            float maxLogit = logits[0], sum = 0.0f;
+            for (int t = 1; t < vocabSize; t++) {
+                maxLogit = logits[t] > maxLogit ? logits[t] : maxLogit;
+            }
+            for (int t = 0; t < vocabSize; t++) {
+                sum += expf(logits[t] - maxLogit);
+            }
+            float logSum = maxLogit + logf(sum);
+            for (int t = 0; t < vocabSize; t++) {
+                candScore[numCand]  = scores[b] + logits[t] - logSum;
+                candParent[numCand] = b;
+                candToken[numCand]  = t;
+                numCand++;
+            }
+        }
+
+        int nextBeams = 0;
+        for (int taken = 0; taken < numCand && nextBeams < width; taken++) {
+            int top = -1;
+            for (int c = 0; c < numCand; c++) {
+                if (candParent[c] >= 0 && (top < 0 || candScore[c] > candScore[top])) {
+                    top = c;
+                }
+            }
+            int parent = candParent[top];
+            candParent[top] = -1;
+            if (candToken[top] == TINYAI_TOKEN_EOS) {
+                if (candScore[top] > bestScore) {
+                    bestScore  = candScore[top];
+                    bestLength = length;
+                    memcpy(best, beams[parent] + promptLength, length * sizeof(int));
+                }
+                finished++;
+                continue;
+            }
+            memcpy(next[nextBeams], beams[parent], (promptLength + length) * sizeof(int));
+            next[nextBeams][promptLength + length] = candToken[top];
+            nextScores[nextBeams++]                = candScore[top];
+        }
+
+        memcpy(beams, next, sizeof(beams));
+        memcpy(scores, nextScores, sizeof(scores));
+        numBeams = nextBeams;
+        length++;
+        if (finished >= width || promptLength + length >= maxTokens) {
+            break;
+        }
+    }
+
+    for (int b = 0; b < numBeams; b++) {
+        if (scores[b] > bestScore) {
+            bestScore  = scores[b];
+            bestLength = length;
+            memcpy(best, beams[b] + promptLength, length * sizeof(int));
+        }
+    }
+    memcpy(output, prompt, promptLength * sizeof(int));
+    memcpy(output + promptLength, best, bestLength * sizeof(int));
+    return promptLength + bestLength;
+}
+
+// Test beam search against greedy decoding, a from-scratch reference and an embedding prefix
+void test_generate_text_beam()
+{
+    printf("  Testing beam search generation...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL, "Should create model");
+
+    int                    prompt[3] = {TINYAI_TOKEN_BOS, 5, 9};
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 12;
+    params.samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params.temperature    = 1.0f;
+    params.promptTokens   = prompt;
+    params.promptLength   = 3;
+
+    // A single beam is greedy decoding
+    int                    greedy[16], beamTokens[16], expected[16];
+    TinyAIBeamSearchParams beam;
+    memset(&beam, 0, sizeof(beam));
+    beam.beamWidth  = 1;
+    int greedyCount = tinyaiGenerateText(model, &params, greedy, 16);
+    int beamCount   = tinyaiGenerateTextBeam(model, &params, &beam, beamTokens, 16);
+    ASSERT(beamCount == greedyCount && memcmp(beamTokens, greedy, beamCount * sizeof(int)) == 0,
+           "Width 1 should match greedy generation");
+
+    // Batched steps over forked paged caches match rescoring every hypothesis from scratch
+    for (int width = 2; width <= 4; width++) {
+        beam.beamWidth    = width;
+        beamCount         = tinyaiGenerateTextBeam(model, &params, &beam, beamTokens, 16);
+        int expectedCount = reference_beam_search(model, prompt, 3, width, 12, expected);
+        ASSERT(beamCount == expectedCount &&
+                   memcmp(beamTokens, expected, beamCount * sizeof(int)) == 0,
+               "Beam search should match the reference");
+    }
+
+    // Embeddings of the first prompt tokens fed as a prefix give the same logits and beams
+    uint32_t vocabSize = tokenizer->tokenCount;
+    float    prefix[2 * 8];
+    float   *logits = (float *)TINYAI_MALLOC(2 * vocabSize * sizeof(float));
+    ASSERT(logits != NULL, "Should allocate logits");
+    ASSERT(tinyaiMatrix4bitGatherRows(&model->layers[0].weights, prompt, 2, prefix) == 0,
+           "Should gather prefix embeddings");
+
+    TinyAIKVCache *embedded = tinyaiCreateModelKVCache(model);
+    TinyAIKVCache *tokens   = tinyaiCreateModelKVCache(model);
+    ASSERT(embedded && tokens, "Should create KV caches");
+    ASSERT(tinyaiModelForwardCachedEmbeddings(model, embedded, prefix, 2, logits) == 0 &&
+               tinyaiModelForwardCached(model, embedded, prompt + 2, 1, logits) == 0 &&
+               tinyaiModelForwardCached(model, tokens, prompt, 3, logits + vocabSize) == 0,
+           "Forward passes should succeed");
+    ASSERT(embedded->length == 3 &&
+               memcmp(logits, logits + vocabSize, vocabSize * sizeof(float)) == 0,
+           "Embedding rows should act as the tokens they embed");
+
+    beam.beamWidth        = 3;
+    beam.prefixEmbeddings = prefix;
+    beam.prefixRows       = 2;
+    params.promptTokens   = prompt + 2;
+    params.promptLength   = 1;
+    params.maxTokens      = 10;
+    int prefixed          = tinyaiGenerateTextBeam(model, &params, &beam, beamTokens, 16);
+    int expectedCount     = reference_beam_search(model, prompt, 3, 3, 12, expected);
+    ASSERT(prefixed == expectedCount - 2 &&
+               memcmp(beamTokens, expected + 2, prefixed * sizeof(int)) == 0,
+           "A prefix of embeddings should behave like the tokens it embeds");
+
+    TINYAI_FREE(logits);
+    tinyaiDestroyKVCache(embedded);
+    tinyaiDestroyKVCache(tokens);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test reusing a generation workspace across calls
+void test_generation_workspace()
+{
+    printf("  Testing generation with a reusable workspace...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_transformer(tokenizer, 4, 8);
+    ASSERT(model != NULL, "Should create test transformer");
+
+    TinyAIGenerationWorkspace *workspace = tinyaiCreateGenerationWorkspace(model);
+    ASSERT(workspace != NULL, "tinyaiCreateGenerationWorkspace() should return non-NULL");
+    ASSERT(workspace->vocabSize == (uint32_t)tokenizer->tokenCount,
+           "Workspace should be sized for the vocabulary");
+
+    int                    prompt[2] = {TINYAI_TOKEN_BOS, 6};
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 12; // Longer than the context, so the cache is rebuilt
+    params.samplingMethod = TINYAI_SAMPLING_TOP_P;
+    params.temperature    = 1.2f;
+    params.topP           = 0.8f;
+    params.seed           = 3;
+    params.promptTokens   = prompt;
+    params.promptLength   = 2;
+
+    int expected[16];
+    int expectedCount = tinyaiGenerateText(model, &params, expected, 16);
+
+    // Repeated runs on one workspace must not depend on its previous contents
+    for (int run = 0; run < 2; run++) {
+        int tokens[16];
+        int count = tinyaiGenerateTextWithWorkspace(model, &params, workspace, tokens, 16);
+        ASSERT(count == expectedCount, "Workspace generation should match tinyaiGenerateText");
+        for (int i = 0; i < count; i++) {
+            ASSERT(tokens[i] == expected[i], "Workspace tokens should match tinyaiGenerateText");
+        }
+    }
+
+    tinyaiDestroyGenerationWorkspace(workspace);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test speculative decoding against plain generation on the target model
+void test_generate_text_speculative()
+{
+    printf("  Testing speculative decoding with a draft model...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *target    = create_test_attention_model(tokenizer, 8, 12);
+    TinyAIModel     *draft     = create_test_transformer(tokenizer, 4, 12);
+    ASSERT(target && draft, "Should create target and draft models");
+
+    int                    prompt[2] = {TINYAI_TOKEN_BOS, 5};
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 12; // Within the context, so both paths see the same window
+    params.samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params.temperature    = 1.0f;
+    params.seed           = 5;
+    params.promptTokens   = prompt;
+    params.promptLength   = 2;
+
+    int expected[16];
+    int expectedCount = tinyaiGenerateText(target, &params, expected, 16);
+
+    // Greedy acceptance must reproduce the target exactly, whatever the draft proposes;
+    // the target drafting for itself has every multi-token verification accepted
+    TinyAIModel *drafts[2] = {draft, target};
+    for (int run = 0; run < 4; run++) {
+        int tokens[16];
+        int count = tinyaiGenerateTextSpeculative(target, drafts[run / 2], 1 + (run % 2) * 3,
+                                                  &params, tokens, 16);
+        ASSERT(count == expectedCount, "Greedy speculative length should match the target");
+        for (int i = 0; i < count; i++) {
+            ASSERT(tokens[i] == expected[i], "Greedy speculative tokens should match the target");
+        }
+    }
+
+    // Sampled output stays within the limits and the vocabulary
+    params.samplingMethod = TINYAI_SAMPLING_TOP_K;
+    params.temperature    = 1.3f;
+    params.topK           = 5;
+    params.maxTokens      = 30; // Longer than the context, so the caches are rebuilt
+    int tokens[32];
+    int count = tinyaiGenerateTextSpeculative(target, target, 3, &params, tokens, 32);
+    ASSERT(count >= 2 && count <= 30, "Sampled speculative output should respect maxTokens");
+    ASSERT(tokens[0] == TINYAI_TOKEN_BOS && tokens[1] == 5, "Output should start with the prompt");
+    for (int i = 2; i < count; i++) {
+        ASSERT(tokens[i] >= 0 && (uint32_t)tokens[i] < tokenizer->tokenCount &&
+                   tokens[i] != TINYAI_TOKEN_EOS,
+               "Sampled tokens should be valid non-EOS tokens");
+    }
+
+    // Without a draft model, generation falls back to the target alone
+    count = tinyaiGenerateTextSpeculative(target, NULL, 4, &params, tokens, 32);
+    int plain[32];
+    ASSERT(count == tinyaiGenerateText(target, &params, plain, 32),
+           "Fallback should match tinyaiGenerateText");
+
+    tinyaiDestroyModel(draft);
+    tinyaiDestroyModel(target);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test the shared prompt-prefix cache against uncached generation
+void test_prefix_cache()
+{
+    printf("  Testing shared prompt-prefix cache...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 12);
+    ASSERT(model != NULL, "Should create model");
+
+    int promptA[5] = {TINYAI_TOKEN_BOS, 5, 9, 7, 6};
+    int promptB[4] = {TINYAI_TOKEN_BOS, 5, 9, 8}; // Shares three tokens with promptA
+    int promptC[6] = {TINYAI_TOKEN_BOS, 5, 9, 7, 6, 5}; // Extends promptA
+    int *prompts[4] = {promptA, promptB, promptA, promptC};
+    int  lengths[4] = {5, 4, 5, 6};
+
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 10;
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = 1.0f;
+    params.seed           = 11;
+
+    // Reference outputs without a prefix cache
+    int expected[4][16];
+    int expectedCounts[4];
+    for (int i = 0; i < 4; i++) {
+        params.promptTokens = prompts[i];
+        params.promptLength = lengths[i];
+        expectedCounts[i]   = tinyaiGenerateText(model, &params, expected[i], 16);
+    }
+
+    ASSERT(tinyaiEnablePrefixCache(model, 1 << 20) == 0, "Should enable the prefix cache");
+
+    // New, partially shared, repeated and extended prompts must generate the same text
+    for (int i = 0; i < 4; i++) {
+        int tokens[16];
+        params.promptTokens = prompts[i];
+        params.promptLength = lengths[i];
+        int count           = tinyaiGenerateText(model, &params, tokens, 16);
+        ASSERT(count == expectedCounts[i], "Prefix-cached length should match uncached");
+        for (int j = 0; j < count; j++) {
+            ASSERT(tokens[j] == expected[i][j], "Prefix-cached tokens should match uncached");
+        }
+    }
+    ASSERT(tinyaiPrefixCacheMemoryUsed(model->prefixCache) > 0, "Prefills should be cached");
+
+    // Lookups restore the longest shared prefix
+    TinyAIPrefixCacheStats before, after;
+    tinyaiPrefixCacheGetStats(model->prefixCache, &before);
+    ASSERT(before.lookups == 4 && before.hits == 3, "Every prompt after the first should hit");
+    TinyAIKVCache *cache = tinyaiCreateModelKVCache(model);
+    float          logits[32];
+    int            unseen[3] = {TINYAI_TOKEN_BOS, 8, 8};
+    ASSERT(tinyaiPrefixCacheLookup(model->prefixCache, promptA, 5, cache, logits,
+                                   tokenizer->tokenCount) == 5,
+           "Exact prompt should be fully restored");
+    ASSERT(cache->length == 5, "Restore should set the cache length");
+    tinyaiResetKVCache(cache);
+    int shared[4] = {TINYAI_TOKEN_BOS, 5, 9, 6};
+    ASSERT(tinyaiPrefixCacheLookup(model->prefixCache, shared, 4, cache, logits,
+                                   tokenizer->tokenCount) == 3,
+           "Shared prefix should be restored");
+    tinyaiResetKVCache(cache);
+    ASSERT(tinyaiPrefixCacheLookup(model->prefixCache, unseen, 3, cache, logits,
+                                   tokenizer->tokenCount) == 1,
+           "Only the BOS token should match an unseen prompt");
+
+    tinyaiPrefixCacheGetStats(model->prefixCache, &after);
+    ASSERT(after.lookups == before.lookups + 3 && after.hits == before.hits + 3 &&
+               after.tokensLookedUp == before.tokensLookedUp + 12 &&
+               after.tokensRestored == before.tokensRestored + 9,
+           "Stats should count every lookup and restored position");
+    ASSERT(after.memoryUsed == tinyaiPrefixCacheMemoryUsed(model->prefixCache),
+           "Stats should report the memory used");
+
+    tinyaiDestroyKVCache(cache);
+
+    // A cap that fits a single entry evicts the least recently used one
+    int tokens[16];
+    params.promptTokens = promptA;
+    params.promptLength = 5;
+    ASSERT(tinyaiEnablePrefixCache(model, 1 << 20) == 0, "Should recreate the prefix cache");
+    tinyaiGenerateText(model, &params, tokens, 16);
+    size_t entrySize = tinyaiPrefixCacheMemoryUsed(model->prefixCache);
+    ASSERT(entrySize > 0, "First prompt should be cached");
+
+    int promptD[5] = {TINYAI_TOKEN_BOS, 5, 9, 7, 8}; // Same length, different last token
+    ASSERT(tinyaiEnablePrefixCache(model, entrySize) == 0, "Should recreate the prefix cache");
+    tinyaiGenerateText(model, &params, tokens, 16);
+    params.promptTokens = promptD;
+    tinyaiGenerateText(model, &params, tokens, 16);
+    ASSERT(tinyaiPrefixCacheMemoryUsed(model->prefixCache) == entrySize,
+           "Cache should stay within its memory limit");
+
+    cache = tinyaiCreateModelKVCache(model);
+    ASSERT(tinyaiPrefixCacheLookup(model->prefixCache, promptD, 5, cache, logits,
+                                   tokenizer->tokenCount) == 5,
+           "Most recent prompt should be cached");
+    tinyaiResetKVCache(cache);
+    ASSERT(tinyaiPrefixCacheLookup(model->prefixCache, promptA, 5, cache, logits,
+                                   tokenizer->tokenCount) == 4,
+           "Evicted prompt should only share the surviving prefix");
+    tinyaiDestroyKVCache(cache);
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test restricting the output layer to a vocabulary shortlist
+void test_output_shortlist()
+{
+    printf("  Testing vocabulary-shortlist output projection...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 8);
+    ASSERT(model != NULL, "Should create model");
+
+    uint32_t vocabSize = tokenizer->tokenCount;
+    int      tokens[3] = {TINYAI_TOKEN_BOS, 5, 7};
+    float   *full      = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *listed    = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(full && listed, "Should allocate logits");
+    ASSERT(tinyaiModelForward(model, tokens, 3, full) == 0, "Forward pass should succeed");
+
+    // Duplicates are merged and EOS is always kept
+    int candidates[4] = {9, 5, 9, 7};
+    ASSERT(tinyaiSetOutputShortlist(model, candidates, 4) == 0, "Setting a shortlist should succeed");
+    ASSERT(model->shortlistSize == 4, "Shortlist should hold the unique candidates and EOS");
+    ASSERT(tinyaiModelForward(model, tokens, 3, listed) == 0, "Shortlisted forward should succeed");
+
+    for (uint32_t t = 0; t < vocabSize; t++) {
+        bool kept = t == 5 || t == 7 || t == 9 || t == TINYAI_TOKEN_EOS;
+        if (kept) {
+            ASSERT(fabsf(listed[t] - full[t]) < 1e-4f, "Shortlisted logits should match");
+        }
+        else {
+            ASSERT(isinf(listed[t]) && listed[t] < 0.0f, "Other logits should be masked");
+        }
+    }
+
+    // Sampling never leaves the shortlist
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 6;
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = 2.0f;
+    params.seed           = 3;
+    params.promptTokens   = tokens;
+    params.promptLength   = 3;
+
+    int outputTokens[12];
+    int outputLength = tinyaiGenerateText(model, &params, outputTokens, 12);
+    ASSERT(outputLength > 3, "Shortlisted generation should produce tokens");
+    for (int i = 3; i < outputLength; i++) {
+        int t = outputTokens[i];
+        ASSERT(t == 5 || t == 7 || t == 9 || t == TINYAI_TOKEN_EOS,
+               "Generated tokens should come from the shortlist");
+    }
+
+    ASSERT(tinyaiSetOutputShortlist(model, (int[]){(int)vocabSize}, 1) != 0,
+           "Out-of-range candidates should be rejected");
+
+    // The most frequent tokens plus the prompt
+    uint32_t mostFrequent = 0;
+    for (uint32_t t = 1; t < vocabSize; t++) {
+        if (tokenizer->frequencies[t] > tokenizer->frequencies[mostFrequent]) {
+            mostFrequent = t;
+        }
+    }
+    ASSERT(tinyaiSetFrequencyShortlist(model, 1, tokens + 1, 2) == 0,
+           "Setting a frequency shortlist should succeed");
+    ASSERT(model->shortlistSize == 4 && model->shortlist[0] == TINYAI_TOKEN_EOS,
+           "Frequency shortlist should hold EOS, the top token and the extras");
+    ASSERT(model->shortlist[1] == mostFrequent || model->shortlist[2] == mostFrequent ||
+               model->shortlist[3] == mostFrequent,
+           "Frequency shortlist should hold the most frequent token");
+
+    // An empty shortlist computes the full vocabulary again
+    ASSERT(tinyaiSetOutputShortlist(model, NULL, 0) == 0, "Clearing the shortlist should succeed");
+    ASSERT(tinyaiModelForward(model, tokens, 3, listed) == 0, "Forward pass should succeed");
+    ASSERT(memcmp(listed, full, vocabSize * sizeof(float)) == 0,
+           "Clearing the shortlist should restore the full logits");
+
+    TINYAI_FREE(full);
+    TINYAI_FREE(listed);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test per-layer profiling of forward passes
+void test_model_profiling()
+{
+    printf("  Testing per-layer model profiling...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 8);
+    ASSERT(model != NULL, "Should create model");
+
+    uint32_t layerCount = 1;
+    ASSERT(tinyaiGetModelProfile(model, &layerCount) == NULL && layerCount == 0,
+           "Profiling should be off by default");
+    ASSERT(tinyaiEnableModelProfiling(model, true) == 0, "Enabling profiling should succeed");
+
+    int    tokens[3] = {TINYAI_TOKEN_BOS, 5, 7};
+    float *logits    = (float *)TINYAI_MALLOC(tokenizer->tokenCount * sizeof(float));
+    ASSERT(logits != NULL, "Should allocate logits");
+    for (int pass = 0; pass < 2; pass++) {
+        ASSERT(tinyaiModelForward(model, tokens, 3, logits) == 0, "Forward pass should succeed");
+    }
+
+    const TinyAILayerProfile *profile = tinyaiGetModelProfile(model, &layerCount);
+    ASSERT(profile != NULL && layerCount == model->layerCount, "Profile should cover every layer");
+    double totalMs = 0.0;
+    for (uint32_t i = 0; i < layerCount; i++) {
+        ASSERT(profile[i].type == model->layers[i].type, "Entries should record the layer type");
+        ASSERT(profile[i].calls == 2 && profile[i].rows == 6, "Entries should count calls and rows");
+        ASSERT(profile[i].weightBytes > 0, "Every layer should read weights");
+        totalMs += profile[i].timeMs;
+    }
+    ASSERT(profile[0].flops == 0, "Embedding lookups should cost no FLOPs");
+    ASSERT(profile[2].flops == 2 * 2 * 3 * 8 * 8, "Dense FLOPs should follow the layer shape");
+    ASSERT(profile[3].flops == 2 * 2 * 1 * 8 * (uint64_t)tokenizer->tokenCount,
+           "Output FLOPs should cover only the last row");
+    ASSERT(profile[1].flops > profile[2].flops, "Attention should cost more than the dense layer");
+
+    // Export as the current metrics of a performance analysis
+    TinyAIPerformanceAnalysis *analysis = tinyaiCreatePerformanceAnalysis(NULL);
+    ASSERT(analysis != NULL, "Should create performance analysis");
+    ASSERT(tinyaiExportModelProfile(model, analysis) == 0, "Exporting the profile should succeed");
+    TinyAIPerformanceMetrics metrics = tinyaiGetPerformanceMetrics(analysis);
+    ASSERT(fabs(metrics.execution_time - totalMs / 2.0) < 1e-9,
+           "Execution time should be the mean per pass");
+    ASSERT(metrics.memory_usage > 0, "Memory usage should hold the bytes read per pass");
+    tinyaiFreePerformanceAnalysis(analysis);
+
+    // Layers added later get their own entry
+    ASSERT(tinyaiAddLayer(model, TINYAI_LAYER_LAYERNORM, 8, 8, TINYAI_ACTIVATION_NONE) == 0,
+           "Adding a layer should succeed");
+    profile = tinyaiGetModelProfile(model, &layerCount);
+    ASSERT(layerCount == 5 && profile[4].calls == 0 && profile[4].type == TINYAI_LAYER_LAYERNORM,
+           "New layers should start with an empty entry");
+    ASSERT(profile[0].calls == 2, "Existing entries should survive adding a layer");
+
+    tinyaiResetModelProfile(model);
+    ASSERT(profile[0].calls == 0 && profile[1].timeMs == 0.0, "Reset should clear the profile");
+    ASSERT(tinyaiEnableModelProfiling(model, false) == 0, "Disabling profiling should succeed");
+    ASSERT(tinyaiGetModelProfile(model, NULL) == NULL, "Disabling should drop the profile");
+    ASSERT(tinyaiExportModelProfile(model, NULL) != 0, "Export should fail without a profile");
+
+    TINYAI_FREE(logits);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Collects streamed tokens and pieces, stopping after a limit
+typedef struct {
+    int  tokens[32];
+    int  count;
+    int  stopAfter;
+    char text[512];
+} StreamCapture;
+
+static bool capture_token(int token, const char *piece, void *userData)
+{
+    StreamCapture *capture = (StreamCapture *)userData;
+    capture->tokens[capture->count++] = token;
+    strcat(capture->text, piece);
+    return capture->count != capture->stopAfter;
+}
+
+// Test streaming generation against buffered generation
+void test_generate_text_streaming()
+{
+    printf("  Testing streaming generation callback...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL, "Should create model");
+
+    int                    prompt[2] = {TINYAI_TOKEN_BOS, 5};
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 12;
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = 1.0f;
+    params.seed           = 21;
+    params.promptTokens   = prompt;
+    params.promptLength   = 2;
+
+    int expected[16];
+    int expectedCount = tinyaiGenerateText(model, &params, expected, 16);
+
+    // Every generated token is streamed, and the pieces decode to the same text
+    StreamCapture capture;
+    memset(&capture, 0, sizeof(capture));
+    int count = tinyaiGenerateTextWithCallback(model, &params, capture_token, &capture);
+    ASSERT(count == expectedCount, "Streaming should generate the same number of tokens");
+    ASSERT(capture.count == count - 2, "Each generated token should be streamed once");
+    for (int i = 0; i < capture.count; i++) {
+        ASSERT(capture.tokens[i] == expected[i + 2], "Streamed tokens should match");
+    }
+
+    char decoded[512];
+    tinyaiDecodeTokens(tokenizer, expected + 2, expectedCount - 2, decoded, sizeof(decoded));
+    ASSERT(strcmp(capture.text, decoded) == 0, "Streamed pieces should concatenate to the text");
+
+    // Returning false cancels generation after that token
+    memset(&capture, 0, sizeof(capture));
+    capture.stopAfter = 2;
+    count             = tinyaiGenerateTextWithCallback(model, &params, capture_token, &capture);
+    ASSERT(capture.count == 2 && count == 4, "Callback should be able to stop generation");
+
+    ASSERT(tinyaiGenerateTextWithCallback(model, &params, NULL, NULL) == 0,
+           "A callback is required");
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test continuous batching against generating each sequence on its own
+void test_generation_batch()
+{
+    printf("  Testing continuous batched generation...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL, "Should create model");
+
+    int                    promptA[5] = {TINYAI_TOKEN_BOS, 5, 9, 4, 7};
+    int                    promptB[1] = {7};
+    TinyAIGenerationParams params[3];
+    memset(params, 0, sizeof(params));
+    params[0].maxTokens      = 12;
+    params[0].samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params[0].temperature    = 1.5f;
+    params[0].seed           = 7;
+    params[0].promptTokens   = promptA;
+    params[0].promptLength   = 5;
+    params[1].maxTokens      = 6;
+    params[1].samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params[1].temperature    = 1.0f;
+    params[1].seed           = 1;
+    params[2].maxTokens      = 10;
+    params[2].samplingMethod = TINYAI_SAMPLING_TOP_K;
+    params[2].temperature    = 1.0f;
+    params[2].topK           = 4;
+    params[2].seed           = 99;
+    params[2].promptTokens   = promptB;
+    params[2].promptLength   = 1;
+
+    StreamCapture expected[3];
+    memset(expected, 0, sizeof(expected));
+    for (int b = 0; b < 3; b++) {
+        tinyaiGenerateTextWithCallback(model, &params[b], capture_token, &expected[b]);
+    }
+
+    // Paged and contiguous caches, with the prompt prefilled in chunks
+    TinyAIKVBlockPool *pool = tinyaiCreateModelKVBlockPool(model, 8, NULL);
+    ASSERT(pool != NULL, "Should create block pool");
+    for (int paged = 0; paged < 2; paged++) {
+        TinyAIGenerationBatch *batch =
+            tinyaiCreateGenerationBatch(model, 2, 2, paged ? pool : NULL);
+        ASSERT(batch != NULL, "Should create generation batch");
+
+        StreamCapture capture[3];
+        memset(capture, 0, sizeof(capture));
+        int slots[3];
+        slots[0] = tinyaiGenerationBatchAdd(batch, &params[0], capture_token, &capture[0]);
+        slots[1] = tinyaiGenerationBatchAdd(batch, &params[1], capture_token, &capture[1]);
+        ASSERT(slots[0] >= 0 && slots[1] >= 0 && slots[0] != slots[1],
+               "Sequences should take free slots");
+        ASSERT(tinyaiGenerationBatchAdd(batch, &params[2], capture_token, &capture[2]) < 0,
+               "A full batch should reject new sequences");
+
+        // The third sequence joins as soon as a slot frees up
+        slots[2]    = -1;
+        int steps   = 0;
+        int running = 2;
+        while (running > 0) {
+            running = tinyaiGenerationBatchStep(batch);
+            ASSERT(running >= 0, "Batch step should succeed");
+            ASSERT(++steps < 64, "Batch should finish");
+            if (slots[2] < 0) {
+                slots[2] = tinyaiGenerationBatchAdd(batch, &params[2], capture_token, &capture[2]);
+                running += slots[2] >= 0;
+            }
+        }
+        ASSERT(steps > 2, "Joining sequence should wait for a free slot");
+
+        for (int b = 0; b < 3; b++) {
+            ASSERT(capture[b].count == expected[b].count,
+                   "Batched sequence should have the same length as its single run");
+            for (int i = 0; i < expected[b].count; i++) {
+                ASSERT(capture[b].tokens[i] == expected[b].tokens[i],
+                       "Batched sequence should match its single run");
+            }
+        }
+
+        int tokenCount = 0;
+        ASSERT(!tinyaiGenerationBatchRunning(batch, slots[2], &tokenCount) &&
+                   tokenCount == 1 + expected[2].count,
+               "Finished sequence should report its length");
+        tinyaiDestroyGenerationBatch(batch);
+    }
+
+    // Prompts resume from the model's prefix cache
+    ASSERT(tinyaiEnablePrefixCache(model, 1 << 20) == 0, "Should enable the prefix cache");
+    for (int round = 0; round < 2; round++) {
+        TinyAIGenerationBatch *cached = tinyaiCreateGenerationBatch(model, 1, 2, NULL);
+        StreamCapture          capture;
+        memset(&capture, 0, sizeof(capture));
+        ASSERT(tinyaiGenerationBatchAdd(cached, &params[0], capture_token, &capture) >= 0,
+               "Should add a sequence");
+        while (tinyaiGenerationBatchStep(cached) > 0) {
+        }
+        ASSERT(capture.count == expected[0].count &&
+                   memcmp(capture.tokens, expected[0].tokens, capture.count * sizeof(int)) == 0,
+               "Prefix-cached batch sequence should match its single run");
+        tinyaiDestroyGenerationBatch(cached);
+    }
+    TinyAIPrefixCacheStats prefixStats;
+    tinyaiPrefixCacheGetStats(model->prefixCache, &prefixStats);
+    ASSERT(prefixStats.hits == 1 && prefixStats.tokensRestored == 5,
+           "Repeated prompt should be restored from the prefix cache");
+    tinyaiEnablePrefixCache(model, 0);
+
+    // A false callback return ends the sequence after that token
+    TinyAIGenerationBatch *batch = tinyaiCreateGenerationBatch(model, 1, 0, NULL);
+    StreamCapture          stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.stopAfter = 2;
+    int slot       = tinyaiGenerationBatchAdd(batch, &params[0], capture_token, &stop);
+    while (tinyaiGenerationBatchStep(batch) > 0) {
+    }
+    ASSERT(slot >= 0 && stop.count == 2, "Stopped sequence should end after the callback");
+    tinyaiDestroyGenerationBatch(batch);
+
+    tinyaiDestroyKVBlockPool(pool);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test continuing a cached sequence across calls, as a chat does turn by turn
+void test_generate_text_continue()
+{
+    printf("  Testing generation continuing a cached sequence...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL, "Should create model");
+    TinyAIGenerationWorkspace *workspace = tinyaiCreateGenerationWorkspace(model);
+    ASSERT(workspace && workspace->cache, "Should create a workspace with a cache");
+
+    int                    sequence[16] = {TINYAI_TOKEN_BOS, 5};
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params.temperature    = 1.0f;
+    params.seed           = 9;
+
+    // The first turn matches generating from the prompt, counting only new tokens
+    int expected[16], tokens[16];
+    params.promptTokens = sequence;
+    params.promptLength = 2;
+    params.maxTokens    = 5;
+    int expectedCount   = tinyaiGenerateText(model, &params, expected, 16) - 2;
+    params.maxTokens    = 3;
+    int count = tinyaiGenerateTextContinue(model, &params, workspace, tokens, 16, NULL, NULL);
+    ASSERT(count == expectedCount, "The first turn should match tinyaiGenerateText");
+    for (int i = 0; i < count; i++) {
+        ASSERT(tokens[i] == expected[i + 2], "First turn tokens should match");
+    }
+    ASSERT(workspace->cache->length == (uint32_t)(2 + count),
+           "The cache should hold the prompt and every returned token");
+
+    // The next turn only feeds its own tokens, and matches generating from the whole history
+    int length = 2 + count;
+    memcpy(sequence + 2, tokens, count * sizeof(int));
+    int turn[2]          = {7, 9};
+    sequence[length]     = turn[0];
+    sequence[length + 1] = turn[1];
+    length += 2;
+    params.promptTokens = sequence;
+    params.promptLength = length;
+    params.maxTokens    = length + 3;
+    expectedCount       = tinyaiGenerateText(model, &params, expected, 16) - length;
+
+    StreamCapture capture;
+    memset(&capture, 0, sizeof(capture));
+    params.promptTokens = turn;
+    params.promptLength = 2;
+    params.maxTokens    = 3;
+    count = tinyaiGenerateTextContinue(model, &params, workspace, tokens, 16, capture_token,
+                                       &capture);
+    ASSERT(count == expectedCount && capture.count == count,
+           "The next turn should match generating from the whole history");
+    for (int i = 0; i < count; i++) {
+        ASSERT(tokens[i] == expected[length + i] && capture.tokens[i] == tokens[i],
+               "Next turn tokens should match and be streamed");
+    }
+    ASSERT(workspace->cache->length == (uint32_t)(length + count),
+           "The cache should grow by the turn and its response");
+
+    // Generation stops when the cache is full, and new tokens that do not fit fail
+    int filler[16] = {5, 6, 7, 8, 9, 10, 5, 6, 7, 8, 9, 10, 5, 6, 7, 8};
+    int room       = 16 - (int)workspace->cache->length;
+    params.promptTokens = filler;
+    params.promptLength = room - 1;
+    params.maxTokens    = 8;
+    count = tinyaiGenerateTextContinue(model, &params, workspace, tokens, 16, NULL, NULL);
+    ASSERT(count >= 0 && count <= 1 && workspace->cache->length <= 16,
+           "Generation should stop at the end of the cache");
+    params.promptLength = 2;
+    ASSERT(tinyaiGenerateTextContinue(model, &params, workspace, tokens, 16, NULL, NULL) == -1,
+           "New tokens that do not fit should fail");
+
+    // Discarding old positions makes room to carry on
+    ASSERT(tinyaiKVCacheDiscard(workspace->cache, 2, 8) == 0, "Discard should succeed");
+    count = tinyaiGenerateTextContinue(model, &params, workspace, tokens, 16, NULL, NULL);
+    ASSERT(count >= 0, "Generation should continue after a discard");
+
+    params.promptLength = 0;
+    ASSERT(tinyaiGenerateTextContinue(model, &params, workspace, tokens, 16, NULL, NULL) == -1,
+           "At least one new token is required");
+
+    tinyaiDestroyGenerationWorkspace(workspace);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test a forward pass that streams its layer weights through a progressive loader
+void test_progressive_loading()
+{
+    printf("  Testing progressive loading...\n");
+
+    const char      *path      = "test_progressive_model.tqtc";
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 16, 8);
+    ASSERT(model != NULL, "Should create attention model");
+
+    int   tokens[3] = {1, 4, 2};
+    float expected[32], streamed[32];
+    ASSERT(tinyaiModelForward(model, tokens, 3, expected) == 0, "In-memory forward should work");
+
+    // One tensor per layer; the attention layer has no packed weights, so it gets a stand-in
+    TinyAIMatrix4bit     *standIn = tinyaiCreateMatrix4bit(1, 2);
+    TinyAIContainerTensor tensors[4];
+    char                  names[4][16];
+    size_t                largest = 0;
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        const TinyAIMatrix4bit *weights = &model->layers[i].weights;
+        snprintf(names[i], sizeof(names[i]), "layer.%u", i);
+        tensors[i].name        = names[i];
+        tensors[i].matrix      = weights->rows > 0 ? weights : standIn;
+        tensors[i].precision   = TINYAI_PRECISION_INT4;
+        tensors[i].compression = TINYAI_COMPRESSION_NONE;
+        if (tinyaiMatrix4bitDataSize(weights) > largest) {
+            largest = tinyaiMatrix4bitDataSize(weights);
+        }
+    }
+    ASSERT(standIn && tinyaiWriteTensorContainer(path, tensors, model->layerCount, false),
+           "Should write the layer container");
+    tinyaiDestroyMatrix4bit(standIn);
+
+    // A budget of the largest layer keeps one layer resident at a time
+    TinyAIProgressiveConfig config;
+    memset(&config, 0, sizeof(config));
+    config.max_memory        = largest;
+    config.enable_prefetch   = true;
+    config.prefetch_distance = 1;
+
+    TinyAIProgressiveLoader *loader = tinyaiCreateProgressiveLoader(path, &config);
+    ASSERT(loader != NULL, "Should create the loader");
+    ASSERT(tinyaiSetModelProgressiveLoader(model, loader) == 0, "Should attach the loader");
+    ASSERT(model->layers[0].weights.data == NULL, "Resident weight data should be freed");
+
+    for (int pass = 0; pass < 2; pass++) {
+        ASSERT(tinyaiModelForward(model, tokens, 3, streamed) == 0,
+               "Streamed forward should work");
+        for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
+            ASSERT(streamed[i] == expected[i], "Streamed logits should match in-memory logits");
+        }
+    }
+    ASSERT(tinyaiGetPeakMemoryUsage(loader) <= largest, "Streaming should stay within budget");
+
+    // A loader whose layers do not match the model is refused
+    TinyAIModel *other = create_test_attention_model(tokenizer, 8, 8);
+    ASSERT(other && tinyaiSetModelProgressiveLoader(other, loader) != 0,
+           "Mismatched layer sizes should be rejected");
+
+    tinyaiDestroyModel(other);
+    tinyaiDestroyModel(model);
+    tinyaiFreeProgressiveLoader(loader);
+    tinyaiDestroyTokenizer(tokenizer);
+    remove(path);
+    printf("    PASS\n");
+}
+
+// Test saving a prepared model as a snapshot and running it straight from the mapped file
+void test_model_snapshot()
+{
+    printf("  Testing model snapshots...\n");
+
+    const char      *path      = "test_model_snapshot.tsnp";
+    const char      *truncated = "test_model_snapshot_truncated.tsnp";
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 16, 8);
+    ASSERT(model != NULL, "Should create attention model");
+
+    ASSERT(tinyaiSaveModelSnapshot(model, path) == 0, "Should save the snapshot");
+    ASSERT(model->layers[2].weights.layout == TINYAI_MATRIX4BIT_PANELS,
+           "Saving should prepack the model's weights");
+
+    TinyAIModel *loaded = tinyaiLoadModelSnapshot(path);
+    ASSERT(loaded != NULL && loaded->snapshot != NULL, "Should load the snapshot");
+    ASSERT(loaded->layerCount == model->layerCount && loaded->plan != NULL,
+           "The loaded model should be prepared");
+    ASSERT(loaded->layers[2].weights.data != model->layers[2].weights.data &&
+               memcmp(loaded->layers[2].weights.data, model->layers[2].weights.data,
+                      tinyaiMatrix4bitDataSize(&model->layers[2].weights)) == 0,
+           "Weights should be used in place with the same packed data");
+
+    // The vocabulary and its hash index come from the snapshot too
+    ASSERT(loaded->tokenizer != tokenizer &&
+               loaded->tokenizer->tokenCount == tokenizer->tokenCount,
+           "The vocabulary should be restored");
+    for (uint32_t i = 0; i < tokenizer->tokenCount; i++) {
+        const char *token = tinyaiGetTokenString(tokenizer, (int)i);
+        ASSERT(tinyaiGetTokenId(loaded->tokenizer, token) == tinyaiGetTokenId(tokenizer, token),
+               "Token lookups should match");
+    }
+
+    int   tokens[3] = {1, 4, 2};
+    float expected[32], restored[32];
+    ASSERT(tinyaiModelForward(model, tokens, 3, expected) == 0 &&
+               tinyaiModelForward(loaded, tokens, 3, restored) == 0,
+           "Forward passes should succeed");
+    ASSERT(memcmp(expected, restored, tokenizer->tokenCount * sizeof(float)) == 0,
+           "Snapshot logits should match the original model exactly");
+    tinyaiDestroyModel(loaded);
+    tinyaiDestroyModel(model);
+
+    // A pruned layer keeps the sparse format the plan chose for it
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    model = create_test_transformer(tokenizer, 32, 8);
+    ASSERT(model != NULL, "Should create test transformer");
+    set_pruned_weights(model, 1, true, 0.75f);
+    int format = tinyaiGetLayerWeightFormat(model, 1);
+    ASSERT(format == TINYAI_WEIGHT_FORMAT_BSR, "Block-pruned layer should run on BSR");
+    ASSERT(tinyaiSaveModelSnapshot(model, path) == 0, "Should save the pruned model");
+
+    loaded = tinyaiLoadModelSnapshot(path);
+    ASSERT(loaded != NULL && tinyaiGetLayerWeightFormat(loaded, 1) == format,
+           "The loaded model should run the recorded weight format");
+    uint32_t vocabSize = tokenizer->tokenCount;
+    float   *dense     = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *sparse    = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(dense && sparse, "Should allocate logits");
+    ASSERT(tinyaiModelForward(model, tokens, 3, dense) == 0 &&
+               tinyaiModelForward(loaded, tokens, 3, sparse) == 0,
+           "Forward passes should succeed");
+    ASSERT(memcmp(dense, sparse, vocabSize * sizeof(float)) == 0,
+           "Pruned snapshot logits should match the original model exactly");
+    TINYAI_FREE(dense);
+    TINYAI_FREE(sparse);
+    tinyaiDestroyModel(loaded);
+    tinyaiDestroyModel(model);
+
+    // Truncated and corrupt snapshots are rejected
+    FILE *file = fopen(path, "rb");
+    ASSERT(file != NULL, "Should open the snapshot");
+    fseek(file, 0, SEEK_END);
+    long  size  = ftell(file);
+    char *bytes = (char *)TINYAI_MALLOC((size_t)size);
+    ASSERT(bytes != NULL, "Should allocate the snapshot copy");
+    rewind(file);
+    ASSERT(fread(bytes, 1, (size_t)size, file) == (size_t)size, "Should read the snapshot");
+    fclose(file);
+
+    file = fopen(truncated, "wb");
+    ASSERT(file != NULL && fwrite(bytes, 1, (size_t)size - 16, file) == (size_t)size - 16,
+           "Should write the truncated snapshot");
+    fclose(file);
+    ASSERT(tinyaiLoadModelSnapshot(truncated) == NULL, "Truncated snapshots should be rejected");
+
+    bytes[0] ^= 0xFF;
+    file = fopen(truncated, "wb");
+    ASSERT(file != NULL && fwrite(bytes, 1, (size_t)size, file) == (size_t)size,
+           "Should write the corrupt snapshot");
+    fclose(file);
+    ASSERT(tinyaiLoadModelSnapshot(truncated) == NULL, "Corrupt snapshots should be rejected");
+    ASSERT(tinyaiLoadModelSnapshot("missing_snapshot.tsnp") == NULL,
+           "Missing snapshots should fail");
+
+    TINYAI_FREE(bytes);
+    tinyaiDestroyTokenizer(tokenizer);
+    remove(path);
+    remove(truncated);
+    printf("    PASS\n");
+}
+
+// Test sharing one snapshot between worker processes
+void test_shared_model_snapshot()
+{
+    printf("  Testing shared model snapshots...\n");
+
+    const char      *path      = "test_shared_snapshot.tsnp";
+    const char      *name      = "/tinyai_test_shared_snapshot";
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    TinyAIModel *model = create_test_transformer(tokenizer, 32, 8);
+    ASSERT(model != NULL, "Should create test transformer");
+    set_pruned_weights(model, 1, true, 0.75f);
+    ASSERT(tinyaiGetLayerWeightFormat(model, 1) == TINYAI_WEIGHT_FORMAT_BSR,
+           "Block-pruned layer should run on BSR");
+    ASSERT(tinyaiSaveModelSnapshot(model, path) == 0, "Should save the snapshot");
+
+    int      tokens[3] = {1, 4, 2};
+    uint32_t vocabSize = tokenizer->tokenCount;
+    float   *expected  = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *logits    = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(expected && logits && tinyaiModelForward(model, tokens, 3, expected) == 0,
+           "Forward pass should succeed");
+
+    // Shared weights run sparse layers on the mapped dense weights, holding no weights of their own
+    tinyaiConfigSetBool("model.shared_weights", 1);
+    TinyAIModel *loaded = tinyaiLoadModelSnapshot(path);
+    ASSERT(loaded != NULL &&
+               tinyaiGetLayerWeightFormat(loaded, 1) == TINYAI_WEIGHT_FORMAT_DENSE,
+           "Shared weights should keep layers dense");
+    TinyAIModelMemoryUsage usage;
+    ASSERT(tinyaiGetModelMemoryUsage(loaded, &usage) == 0 && usage.weights == 0,
+           "No weights should be private to the process");
+    ASSERT(tinyaiModelForward(loaded, tokens, 3, logits) == 0 &&
+               relative_max_error(expected, logits, vocabSize) < 1e-4f,
+           "Shared weights should give the same logits up to rounding");
+    tinyaiDestroyModel(loaded);
+    tinyaiConfigRemoveKey("model.shared_weights");
+
+#ifndef _WIN32
+    // Workers load a published segment as they would the file
+    ASSERT(tinyaiPublishModelSnapshot(path, name) == 0, "Should publish the snapshot");
+    loaded = tinyaiLoadSharedModelSnapshot(name);
+    ASSERT(loaded != NULL && tinyaiGetLayerWeightFormat(loaded, 1) == TINYAI_WEIGHT_FORMAT_BSR,
+           "Should load the published snapshot with its recorded formats");
+    ASSERT(tinyaiPublishModelSnapshot(path, name) == 0, "Should replace the published snapshot");
+    ASSERT(tinyaiUnpublishModelSnapshot(name) == 0, "Should remove the published snapshot");
+    ASSERT(tinyaiLoadSharedModelSnapshot(name) == NULL && tinyaiUnpublishModelSnapshot(name) != 0,
+           "A removed snapshot should be gone");
+    ASSERT(tinyaiModelForward(loaded, tokens, 3, logits) == 0 &&
+               memcmp(expected, logits, vocabSize * sizeof(float)) == 0,
+           "A mapped segment should outlive its name");
+    tinyaiDestroyModel(loaded);
+#endif
+    ASSERT(tinyaiPublishModelSnapshot("missing_snapshot.tsnp", name) != 0,
+           "Missing snapshots should not be published");
+
+    TINYAI_FREE(expected);
+    TINYAI_FREE(logits);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    remove(path);
+    printf("    PASS\n");
+}
+
+// Fill an adapter factor with a deterministic pattern
+static void fill_adapter_factor(float *data, size_t count, uint32_t seed)
+{
+    for (size_t i = 0; i < count; i++) {
+        data[i] = (float)((i * 5 + seed) % 11) / 11.0f - 0.45f;
+    }
+}
+
+void test_low_rank_adapter()
+{
+    printf("  Testing low-rank adapters...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 16, 8);
+    ASSERT(model != NULL && tinyaiPrepareModel(model) == 0, "Should create attention model");
+
+    int      tokens[3] = {1, 4, 2};
+    uint32_t vocabSize = tokenizer->tokenCount;
+    float   *base      = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *adapted   = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    float   *logits    = (float *)TINYAI_MALLOC(vocabSize * sizeof(float));
+    ASSERT(base && adapted && logits && tinyaiModelForward(model, tokens, 3, base) == 0,
+           "Forward pass should succeed");
+
+    // Rank-2 updates of every projection of the attention, dense and output layers
+    float          down[2 * 16], up[2 * 64];
+    TinyAIAdapter *adapter = tinyaiCreateAdapter(model, 2, 4.0f);
+    ASSERT(adapter != NULL, "Should create an adapter");
+    fill_adapter_factor(down, 2 * 16, 1);
+    fill_adapter_factor(up, 2 * 16, 2);
+    for (uint32_t p = TINYAI_ADAPTER_QUERY; p <= TINYAI_ADAPTER_OUTPUT; p++) {
+        ASSERT(tinyaiSetAdapterWeights(adapter, 1, p, down, up) == 0,
+               "Should set attention updates");
+    }
+    ASSERT(tinyaiSetAdapterWeights(adapter, 2, TINYAI_ADAPTER_WEIGHTS, down, up) == 0,
+           "Should set the dense update");
+    fill_adapter_factor(up, 2 * vocabSize, 3);
+    ASSERT(tinyaiSetAdapterWeights(adapter, 3, TINYAI_ADAPTER_WEIGHTS, down, up) == 0,
+           "Should set the output update");
+    ASSERT(tinyaiSetAdapterWeights(adapter, 0, TINYAI_ADAPTER_WEIGHTS, down, up) != 0 &&
+               tinyaiSetAdapterWeights(adapter, 2, TINYAI_ADAPTER_KEY, down, up) != 0,
+           "Embeddings and missing projections should not be adapted");
+
+    ASSERT(tinyaiSetModelAdapter(model, adapter) == 0 && model->adapter == adapter,
+           "Should activate the adapter");
+    ASSERT(tinyaiModelForward(model, tokens, 3, adapted) == 0 &&
+               relative_max_error(base, adapted, vocabSize) > 1e-3f,
+           "The adapter should change the logits");
+
+    // Incremental decoding sees the same updates, including those written into the cache
+    TinyAIKVCache *cache = tinyaiCreateModelKVCache(model);
+    ASSERT(cache && tinyaiModelForwardCached(model, cache, tokens, 2, logits) == 0 &&
+               tinyaiModelForwardCached(model, cache, tokens + 2, 1, logits) == 0 &&
+               relative_max_error(adapted, logits, vocabSize) < 1e-4f,
+           "Cached decoding should match the full pass");
+    tinyaiDestroyKVCache(cache);
+
+    // A shortlist computes the same adapted logits for its tokens
+    int shortlist[3] = {2, 4, 5};
+    ASSERT(tinyaiSetOutputShortlist(model, shortlist, 3) == 0 &&
+               tinyaiModelForward(model, tokens, 3, logits) == 0,
+           "Shortlisted forward pass should succeed");
+    for (int i = 0; i < 3; i++) {
+        ASSERT(fabsf(logits[shortlist[i]] - adapted[shortlist[i]]) <=
+                   1e-4f * (1.0f + fabsf(adapted[shortlist[i]])),
+               "Shortlisted logits should include the output update");
+    }
+    ASSERT(tinyaiSetOutputShortlist(model, NULL, 0) == 0, "Should clear the shortlist");
+
+    // Switching is a pointer swap that restores either set of weights exactly
+    ASSERT(tinyaiSetModelAdapter(model, NULL) == 0 &&
+               tinyaiModelForward(model, tokens, 3, logits) == 0 &&
+               memcmp(base, logits, vocabSize * sizeof(float)) == 0,
+           "Without an adapter the base logits should come back");
+    ASSERT(tinyaiSetModelAdapter(model, adapter) == 0 &&
+               tinyaiModelForward(model, tokens, 3, logits) == 0 &&
+               memcmp(adapted, logits, vocabSize * sizeof(float)) == 0,
+           "Reactivating the adapter should give its logits again");
+
+    // A rank-1 output update onto one token moves that logit only
+    TinyAIAdapter *single = tinyaiCreateAdapter(model, 1, 1.0f);
+    memset(up, 0, vocabSize * sizeof(float));
+    up[3] = 1.0f;
+    ASSERT(single && tinyaiSetAdapterWeights(single, 3, TINYAI_ADAPTER_WEIGHTS, down, up) == 0 &&
+               tinyaiSetModelAdapter(model, single) == 0 &&
+               tinyaiModelForward(model, tokens, 3, logits) == 0,
+           "Should run with a second adapter");
+    for (uint32_t k = 0; k < vocabSize; k++) {
+        ASSERT(k == 3 ? logits[k] != base[k] : logits[k] == base[k],
+               "Only the updated token's logit should move");
+    }
+
+    // Adapters only fit the layer sizes they were created for
+    TinyAIModel   *other        = create_test_attention_model(tokenizer, 8, 8);
+    TinyAIAdapter *otherAdapter = other ? tinyaiCreateAdapter(other, 2, 1.0f) : NULL;
+    ASSERT(otherAdapter &&
+               tinyaiSetAdapterWeights(otherAdapter, 2, TINYAI_ADAPTER_WEIGHTS, down, up) == 0 &&
+               tinyaiSetModelAdapter(model, otherAdapter) != 0 && model->adapter == single,
+           "A mismatched adapter should be rejected");
+    ASSERT(tinyaiCreateAdapter(model, 0, 1.0f) == NULL, "Rank 0 should be rejected");
+
+    ASSERT(tinyaiSetModelAdapter(model, NULL) == 0, "Should return to the base weights");
+    tinyaiDestroyAdapter(otherAdapter);
+    tinyaiDestroyAdapter(single);
+    tinyaiDestroyAdapter(adapter);
+    tinyaiDestroyModel(other);
+    TINYAI_FREE(base);
+    TINYAI_FREE(adapted);
+    TINYAI_FREE(logits);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+void test_model_memory_usage()
+{
+    printf("  Testing model memory attribution...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 16, 8);
+    ASSERT(model != NULL && tinyaiPrepareModel(model) == 0, "Should create attention model");
+
+    TinyAIModelMemoryUsage usage;
+    ASSERT(tinyaiGetModelMemoryUsage(model, &usage) == 0, "Should measure the model");
+    ASSERT(usage.weights >= tinyaiMatrix4bitDataSize(&model->layers[2].weights) * 2,
+           "Heap weights should be counted");
+    ASSERT(usage.activations >= 2 * 8 * 16 * sizeof(float), "Activation buffers should be counted");
+    ASSERT(usage.tokenizer == tinyaiTokenizerMemoryUsage(tokenizer) && usage.tokenizer > 0,
+           "The vocabulary should be counted");
+    ASSERT(usage.mapped == 0 && usage.mappedResident == 0, "Nothing should be mapped");
+    ASSERT(tinyaiGetModelMemoryUsage(NULL, &usage) != 0, "A missing model should fail");
+
+    // A paged cache takes pool blocks as it grows; the pool remembers its high-water mark
+    TinyAIKVBlockPool *pool  = tinyaiCreateModelKVBlockPool(model, 4, NULL);
+    TinyAIKVCache     *cache = pool ? tinyaiCreateModelPagedKVCache(model, pool) : NULL;
+    size_t             peak;
+    ASSERT(cache != NULL && tinyaiKVBlockPoolMemoryUsage(pool, &peak) == 0 && peak == 0,
+           "A new pool should hold no blocks");
+    int   tokens[3] = {1, 4, 2};
+    float logits[32];
+    ASSERT(tinyaiModelForwardCached(model, cache, tokens, 3, logits) == 0,
+           "Forward pass should succeed");
+    size_t held = tinyaiKVBlockPoolMemoryUsage(pool, &peak);
+    ASSERT(held > 0 && held == peak, "The cache's block should be held");
+    ASSERT(tinyaiKVCacheMemoryUsage(cache) > sizeof(TinyAIKVCache),
+           "The block table should be counted");
+    tinyaiDestroyKVCache(cache);
+    tinyaiKVBlockPoolTrim(pool);
+    ASSERT(tinyaiKVBlockPoolMemoryUsage(pool, &peak) == 0 && peak == held,
+           "Trimming should free the storage but keep the high-water mark");
+    tinyaiDestroyKVBlockPool(pool);
+
+    cache = tinyaiCreateModelKVCache(model);
+    ASSERT(cache && tinyaiKVCacheMemoryUsage(cache) >= 2 * 8 * 16 * sizeof(float),
+           "Contiguous rows should be counted");
+    tinyaiDestroyKVCache(cache);
+
+    // Weights of a snapshot are mapped, not heap
+    const char *path = "test_model_memory.tsnp";
+    ASSERT(tinyaiSaveModelSnapshot(model, path) == 0, "Should save the snapshot");
+    TinyAIModel *loaded = tinyaiLoadModelSnapshot(path);
+    ASSERT(loaded != NULL, "Should load the snapshot");
+    ASSERT(tinyaiModelForward(loaded, tokens, 3, logits) == 0, "Forward pass should succeed");
+    ASSERT(tinyaiGetModelMemoryUsage(loaded, &usage) == 0, "Should measure the loaded model");
+    ASSERT(usage.weights == 0, "Mapped weights should not count as heap");
+    ASSERT(usage.mapped == loaded->snapshotSize, "The snapshot should count as mapped");
+#ifndef _WIN32
+    ASSERT(usage.mappedResident > 0, "Touched snapshot pages should be resident");
+#endif
+
+    tinyaiDestroyModel(loaded);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    remove(path);
+    printf("    PASS\n");
+}
+
+// Test batched text embeddings against one text at a time
+void test_text_embeddings()
+{
+    printf("  Testing text embeddings...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 16, 8);
+    ASSERT(model != NULL && tinyaiPrepareModel(model) == 0, "Should create attention model");
+    ASSERT(tinyaiGetModelEmbeddingSize(model) == 16, "Embeddings should be the hidden size");
+
+    const char *texts[3] = {"the quick brown fox", "lazy dog .",
+                            "the quick brown fox jumps over the lazy dog ."};
+    float       batch[3 * 16], single[16], last[16];
+    ASSERT(tinyaiEmbedTextBatch(model, texts, 3, TINYAI_POOLING_MEAN, true, batch) == 0,
+           "Batch embedding should succeed");
+    for (int t = 0; t < 3; t++) {
+        ASSERT(tinyaiEmbedTextBatch(model, &texts[t], 1, TINYAI_POOLING_MEAN, true, single) == 0,
+               "Single embedding should succeed");
+        float norm = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            ASSERT(fabsf(batch[t * 16 + i] - single[i]) < 1e-5f,
+                   "A text should embed the same alone and in a batch");
+            norm += single[i] * single[i];
+        }
+        ASSERT(fabsf(norm - 1.0f) < 1e-4f, "Normalized embeddings should have unit length");
+    }
+
+    // The longest text is truncated to the context, and pooling picks the rows
+    ASSERT(tinyaiEmbedTextBatch(model, &texts[0], 1, TINYAI_POOLING_LAST, false, last) == 0,
+           "Last-token pooling should succeed");
+    bool differs = false;
+    for (int i = 0; i < 16; i++) {
+        differs = differs || fabsf(last[i] - batch[i]) > 1e-4f;
+    }
+    ASSERT(differs, "Mean and last-token pooling should differ");
+
+    const char *empty[2] = {"the fox", ""};
+    ASSERT(tinyaiEmbedTextBatch(model, empty, 2, TINYAI_POOLING_MEAN, false, batch) != 0,
+           "A text with no tokens should fail");
+    ASSERT(tinyaiEmbedTextBatch(model, texts, 1, 7, false, batch) != 0,
+           "An unknown pooling should fail");
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test FP16 and BF16 activation storage against FP32 activations
+void test_half_activations()
+{
+    printf("  Testing half-precision activations...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 16, 64);
+    ASSERT(model != NULL, "Should create attention model");
+
+    // More rows than one staged chunk, so the layers run in several chunks
+    int      vocabSize = (int)tokenizer->tokenCount;
+    int      tokens[21];
+    uint32_t count = 20;
+    for (uint32_t i = 0; i < 21; i++) {
+        tokens[i] = (int)((i * 5 + 1) % (uint32_t)vocabSize);
+    }
+
+    const char *text = "the quick brown fox jumps over the lazy dog .";
+    float      *exact      = (float *)TINYAI_MALLOC(2 * vocabSize * sizeof(float));
+    float      *half       = (float *)TINYAI_MALLOC(2 * vocabSize * sizeof(float));
+    float       exactEmbedding[16], halfEmbedding[16];
+    ASSERT(exact && half, "Should allocate logits");
+
+    TinyAIModelMemoryUsage fullUsage, halfUsage;
+    TinyAIKVCache         *cache = tinyaiCreateModelKVCache(model);
+    ASSERT(cache != NULL, "Should create the cache");
+    ASSERT(tinyaiModelForward(model, tokens, count, exact) == 0, "Forward pass should succeed");
+    ASSERT(tinyaiModelForwardCached(model, cache, tokens, count, exact + vocabSize) == 0 &&
+               tinyaiModelForwardCached(model, cache, tokens + count, 1, exact + vocabSize) == 0,
+           "Cached decoding should succeed");
+    ASSERT(tinyaiEmbedTextBatch(model, &text, 1, TINYAI_POOLING_MEAN, false, exactEmbedding) == 0,
+           "Embedding should succeed");
+    ASSERT(tinyaiGetModelMemoryUsage(model, &fullUsage) == 0, "Should measure the model");
+
+    uint32_t precisions[2] = {TINYAI_ACTIVATIONS_FP16, TINYAI_ACTIVATIONS_BF16};
+    float    tolerances[2] = {0.01f, 0.05f};
+    for (int p = 0; p < 2; p++) {
+        ASSERT(tinyaiSetModelActivationPrecision(model, precisions[p]) == 0,
+               "Should set the activation precision");
+        ASSERT(tinyaiModelForward(model, tokens, count, half) == 0, "Forward pass should succeed");
+        ASSERT(relative_max_error(exact, half, vocabSize) < tolerances[p],
+               "Half activations should stay close to FP32");
+
+        tinyaiResetKVCache(cache);
+        ASSERT(tinyaiModelForwardCached(model, cache, tokens, count, half + vocabSize) == 0 &&
+                   tinyaiModelForwardCached(model, cache, tokens + count, 1, half + vocabSize) ==
+                       0,
+               "Cached decoding should succeed");
+        ASSERT(relative_max_error(exact + vocabSize, half + vocabSize, vocabSize) < tolerances[p],
+               "Half activations should decode close to FP32");
+
+        ASSERT(tinyaiEmbedTextBatch(model, &text, 1, TINYAI_POOLING_MEAN, false, halfEmbedding) ==
+                   0,
+               "Embedding should succeed");
+        ASSERT(relative_max_error(exactEmbedding, halfEmbedding, 16) < tolerances[p],
+               "Half activations should embed close to FP32");
+
+        ASSERT(tinyaiGetModelMemoryUsage(model, &halfUsage) == 0, "Should measure the model");
+        ASSERT(halfUsage.activations < fullUsage.activations,
+               "Half activations should use less memory");
+    }
+
+    ASSERT(tinyaiSetModelActivationPrecision(model, 7) != 0, "An unknown precision should fail");
+    ASSERT(tinyaiSetModelActivationPrecision(model, TINYAI_ACTIVATIONS_FP32) == 0,
+           "Should restore FP32 activations");
+    ASSERT(tinyaiModelForward(model, tokens, count, half) == 0, "Forward pass should succeed");
+    ASSERT(relative_max_error(exact, half, vocabSize) < 1e-6f,
+           "FP32 activations should be restored exactly");
+
+    tinyaiDestroyKVCache(cache);
+    TINYAI_FREE(exact);
+    TINYAI_FREE(half);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Whether the tokens after a prompt walk a grammar to a full match
+static bool matches_grammar(const TinyAIGrammar *grammar, const int *tokens, int count)
+{
+    uint32_t state = tinyaiGrammarStartState(grammar);
+    for (int i = 0; i < count; i++) {
+        int64_t next = tinyaiGrammarAdvance(grammar, state, tokens[i]);
+        if (next < 0) {
+            return false;
+        }
+        state = (uint32_t)next;
+    }
+    return tinyaiGrammarAccepts(grammar, state);
+}
+
+// Test that every decoding path keeps its output inside a grammar
+void test_constrained_generation()
+{
+    printf("  Testing grammar-constrained generation...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL, "Should create model");
+    TinyAIGrammar *grammar = tinyaiCompileGrammar("the (quick|lazy) (fox|dog)\\.", tokenizer);
+    ASSERT(grammar != NULL, "Should compile grammar");
+
+    // Only "the" can start the text, however likely another token is
+    float logits[16];
+    int   favored = tinyaiGetTokenId(tokenizer, "quick");
+    for (uint32_t t = 0; t < tokenizer->tokenCount; t++) {
+        logits[t] = (int)t == favored ? 10.0f : 0.0f;
+    }
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 12;
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = 1.5f;
+    params.grammar        = grammar;
+    ASSERT(tinyaiSampleToken(logits, tokenizer->tokenCount, &params) ==
+               tinyaiGetTokenId(tokenizer, "the"),
+           "Sampling should keep to the grammar");
+
+    int                        output[16];
+    TinyAIGenerationWorkspace *workspace = tinyaiCreateGenerationWorkspace(model);
+    ASSERT(workspace != NULL, "Should create workspace");
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        params.seed = seed;
+        int count   = tinyaiGenerateTextWithWorkspace(model, &params, workspace, output, 16);
+        ASSERT(count == 5 && matches_grammar(grammar, output + 1, count - 1),
+               "Sampled text should match the grammar");
+    }
+
+    // Batched and beam decoding follow the same constraint
+    TinyAIGenerationParams batchParams[3] = {params, params, params};
+    batchParams[1].samplingMethod         = TINYAI_SAMPLING_GREEDY;
+    batchParams[2].samplingMethod         = TINYAI_SAMPLING_TOP_K;
+    batchParams[2].topK                   = 3;
+    int  batchTokens[3][16];
+    int *batchOutputs[3] = {batchTokens[0], batchTokens[1], batchTokens[2]};
+    int  batchCounts[3];
+    ASSERT(tinyaiGenerateTextBatch(model, batchParams, 3, batchOutputs, 16, batchCounts) == 0,
+           "Batched generation should succeed");
+    for (int b = 0; b < 3; b++) {
+        ASSERT(matches_grammar(grammar, batchTokens[b] + 1, batchCounts[b] - 1),
+               "Batched text should match the grammar");
+    }
+
+    TinyAIGenerationBatch *batch = tinyaiCreateGenerationBatch(model, 2, 0, NULL);
+    StreamCapture          capture[2];
+    memset(capture, 0, sizeof(capture));
+    ASSERT(tinyaiGenerationBatchAdd(batch, &batchParams[0], capture_token, &capture[0]) >= 0 &&
+               tinyaiGenerationBatchAdd(batch, &batchParams[2], capture_token, &capture[1]) >= 0,
+           "Should add sequences");
+    while (tinyaiGenerationBatchStep(batch) > 0) {
+    }
+    for (int b = 0; b < 2; b++) {
+        ASSERT(matches_grammar(grammar, capture[b].tokens, capture[b].count),
+               "Continuously batched text should match the grammar");
+    }
+    tinyaiDestroyGenerationBatch(batch);
+
+    TinyAIBeamSearchParams beam = {3, 0.0f, NULL, 0};
+    int                    count = tinyaiGenerateTextBeam(model, &params, &beam, output, 16);
+    ASSERT(count == 5 && matches_grammar(grammar, output + 1, count - 1),
+           "Beam search text should match the grammar");
+
+    int plain[16];
+    ASSERT(tinyaiGenerateTextSpeculative(model, model, 3, &params, output, 16) ==
+                   tinyaiGenerateText(model, &params, plain, 16) &&
+               matches_grammar(grammar, output + 1, 4),
+           "Speculative decoding should fall back to constrained generation");
+
+    tinyaiDestroyGenerationWorkspace(workspace);
+    tinyaiDestroyGrammar(grammar);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test penalties, biases and bans applied to the logits before sampling
+void test_logit_processors()
+{
+    printf("  Testing logit processors...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    int              vocab     = (int)tokenizer->tokenCount;
+    int              the       = tinyaiGetTokenId(tokenizer, "the");
+    int              fox       = tinyaiGetTokenId(tokenizer, "fox");
+    int              dog       = tinyaiGetTokenId(tokenizer, "dog");
+
+    // "the" leads "fox" by 1.0, and the prompt has seen "the" twice, then "fox"
+    float logits[16];
+    for (int t = 0; t < vocab; t++) {
+        logits[t] = 0.0f;
+    }
+    logits[the] = 3.0f;
+    logits[fox] = 2.0f;
+    int                  seen[3] = {the, the, fox};
+    TinyAILogitProcessor processor;
+    memset(&processor, 0, sizeof(processor));
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params.promptTokens   = seen;
+    params.promptLength   = 3;
+    params.processors     = &processor;
+    params.processorCount = 1;
+
+    processor.type  = TINYAI_LOGIT_PRESENCE_PENALTY;
+    processor.value = 1.5f;
+    ASSERT(tinyaiSampleToken(logits, vocab, &params) == the,
+           "A presence penalty should count each token once");
+    processor.type = TINYAI_LOGIT_FREQUENCY_PENALTY;
+    ASSERT(tinyaiSampleToken(logits, vocab, &params) == fox,
+           "A frequency penalty should count every occurrence");
+    processor.window = 1;
+    ASSERT(tinyaiSampleToken(logits, vocab, &params) == the,
+           "A penalty window should see only the latest tokens");
+    processor.type   = TINYAI_LOGIT_REPETITION_PENALTY;
+    processor.value  = 2.0f;
+    processor.window = 0;
+    ASSERT(tinyaiSampleToken(logits, vocab, &params) == the,
+           "A repetition penalty should scale every seen token alike");
+    ASSERT(logits[the] == 3.0f, "Processors should leave the caller's logits untouched");
+
+    int   favored[2]     = {dog, the};
+    float biases[2]      = {5.0f, -1.0f};
+    processor.type       = TINYAI_LOGIT_BIAS;
+    processor.tokens     = favored;
+    processor.biases     = biases;
+    processor.tokenCount = 2;
+    ASSERT(tinyaiSampleToken(logits, vocab, &params) == dog, "A bias should shift its token");
+
+    // Generation never emits a banned token, whichever decoding path runs
+    TinyAIModel *model = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL, "Should create model");
+    int banned[16];
+    int count = 0;
+    for (int t = 0; t < vocab; t++) {
+        if (t != fox && t != dog) {
+            banned[count++] = t;
+        }
+    }
+    processor.type        = TINYAI_LOGIT_BAN;
+    processor.tokens      = banned;
+    processor.tokenCount  = count;
+    params.promptTokens   = NULL;
+    params.promptLength   = 0;
+    params.maxTokens      = 10;
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = 1.0f;
+
+    int output[16];
+    for (uint32_t seed = 1; seed <= 4; seed++) {
+        params.seed = seed;
+        int length  = tinyaiGenerateText(model, &params, output, 16);
+        ASSERT(length > 1, "Generation should produce tokens");
+        for (int i = 1; i < length; i++) {
+            ASSERT(output[i] == fox || output[i] == dog, "Generation should skip banned tokens");
+        }
+    }
+    TinyAIBeamSearchParams beam   = {2, 0.0f, NULL, 0};
+    int                    length = tinyaiGenerateTextBeam(model, &params, &beam, output, 16);
+    for (int i = 1; i < length; i++) {
+        ASSERT(output[i] == fox || output[i] == dog, "Beam search should skip banned tokens");
+    }
+
+    // A frequency penalty keeps greedy decoding from repeating one token forever
+    TinyAILogitProcessor penalty = {TINYAI_LOGIT_FREQUENCY_PENALTY, 100.0f, 0, NULL, NULL, 0};
+    params.processors     = &penalty;
+    params.samplingMethod = TINYAI_SAMPLING_GREEDY;
+    length                = tinyaiGenerateText(model, &params, output, 16);
+    for (int i = 2; i < length; i++) {
+        for (int j = 1; j < i; j++) {
+            ASSERT(output[i] != output[j], "A strong frequency penalty should avoid repeats");
+        }
+    }
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test early exits: stopping, KV copy-through, profiling and calibration
+void test_early_exit()
+{
+    printf("  Testing early exit...\n");
+
+    TinyAITokenizer *tokenizer = create_test_tokenizer();
+    TinyAIModel     *model     = create_test_attention_model(tokenizer, 8, 16);
+    TinyAIModel     *reference = create_test_attention_model(tokenizer, 8, 16);
+    ASSERT(model != NULL && reference != NULL, "Should create models");
+    int vocab = (int)tokenizer->tokenCount;
+
+    // Exits need layers to skip before the output layer
+    ASSERT(tinyaiSetModelEarlyExit(model, 2, 0.5f) != 0, "No exit should precede the head");
+    ASSERT(tinyaiSetModelEarlyExit(model, 3, 0.5f) != 0, "The output layer cannot exit");
+    ASSERT(tinyaiSetModelEarlyExit(model, 9, 0.5f) != 0, "A missing layer should be rejected");
+    ASSERT(tinyaiSetModelEarlyExit(model, 0, NAN) != 0, "A NaN threshold should be rejected");
+    ASSERT(tinyaiSetModelEarlyExit(model, 0, -1.0f) == 0, "Removing no exit should succeed");
+    ASSERT(model->exitThresholds == NULL, "Removing no exit should allocate nothing");
+
+    // An exit that never stops leaves the logits of every pass unchanged
+    ASSERT(tinyaiSetModelEarlyExit(model, 1, 2.0f) == 0, "Exit after attention should be set");
+    ASSERT(tinyaiEnableModelProfiling(model, true) == 0, "Profiling should enable");
+    TinyAIKVCache *cache    = tinyaiCreateModelKVCache(model);
+    TinyAIKVCache *refCache = tinyaiCreateModelKVCache(reference);
+    ASSERT(cache != NULL && refCache != NULL, "Caches should be created");
+
+    int   tokens[6] = {4, 5, 6, 7, 4, 5};
+    float logits[16], expected[16];
+    for (int p = 0; p < 6; p++) {
+        ASSERT(tinyaiModelForwardCached(model, cache, &tokens[p], 1, logits) == 0 &&
+                   tinyaiModelForwardCached(reference, refCache, &tokens[p], 1, expected) == 0,
+               "Cached passes should succeed");
+        for (int t = 0; t < vocab; t++) {
+            ASSERT(fabsf(logits[t] - expected[t]) < 1e-5f, "A silent exit should change nothing");
+        }
+    }
+    const TinyAILayerProfile *profile = tinyaiGetModelProfile(model, NULL);
+    ASSERT(profile[1].exits == 0 && profile[2].calls == 6, "No pass should have stopped");
+
+    // Exiting after the embedding fills the attention layer's cache rows by copy-through,
+    // so a later full pass sees the same keys and values as the full model
+    ASSERT(tinyaiSetModelEarlyExit(model, 1, -1.0f) == 0, "Removing an exit should succeed");
+    ASSERT(tinyaiSetModelEarlyExit(model, 0, 0.0f) == 0, "Exit after embedding should be set");
+    tinyaiResetKVCache(cache);
+    tinyaiResetKVCache(refCache);
+    tinyaiResetModelProfile(model);
+    for (int p = 0; p < 5; p++) {
+        ASSERT(tinyaiModelForwardCached(model, cache, &tokens[p], 1, logits) == 0 &&
+                   tinyaiModelForwardCached(reference, refCache, &tokens[p], 1, expected) == 0,
+               "Exiting passes should succeed");
+    }
+    ASSERT(profile[0].exits == 5 && profile[1].calls == 0 && profile[3].calls == 0,
+           "Every pass should stop after the embedding");
+    ASSERT(cache->length == refCache->length, "Exited passes should still fill the cache");
+
+    ASSERT(tinyaiSetModelEarlyExit(model, 0, -1.0f) == 0 && model->exitThresholds == NULL,
+           "Removing the last exit should drop the thresholds");
+    ASSERT(tinyaiModelForwardCached(model, cache, &tokens[5], 1, logits) == 0 &&
+               tinyaiModelForwardCached(reference, refCache, &tokens[5], 1, expected) == 0,
+           "Full passes should succeed");
+    for (int t = 0; t < vocab; t++) {
+        ASSERT(fabsf(logits[t] - expected[t]) < 1e-4f,
+               "Copied-through cache rows should match the full model's");
+    }
+
+    // Prompts run every layer
+    tinyaiSetModelEarlyExit(model, 0, 0.0f);
+    tinyaiResetKVCache(cache);
+    tinyaiResetModelProfile(model);
+    ASSERT(tinyaiModelForwardCached(model, cache, tokens, 4, logits) == 0,
+           "A prompt pass should succeed");
+    ASSERT(profile[0].exits == 0 && profile[3].calls == 1, "A prompt should not exit");
+
+    // Calibration with full agreement required picks a threshold the exit meets no
+    // more often than it agrees; with none required, every decoding step stops
+    int calibration[24];
+    for (int i = 0; i < 24; i++) {
+        calibration[i] = 4 + (i * 5) % (vocab - 4);
+    }
+    ASSERT(tinyaiCalibrateModelEarlyExit(model, calibration, 24, 0.0f) == 0,
+           "Calibration should succeed");
+    ASSERT(model->exitThresholds[0] >= 0.0f && model->exitThresholds[0] <= 1.0f,
+           "Zero agreement should give a reachable threshold");
+    ASSERT(tinyaiCalibrateModelEarlyExit(model, calibration, 24, 1.0f) == 0,
+           "Calibration should succeed");
+    ASSERT(model->exitThresholds[0] >= 0.0f, "Calibration should keep the exit");
+    ASSERT(tinyaiCalibrateModelEarlyExit(model, calibration, 24, 1.5f) != 0,
+           "An agreement above 1 should be rejected");
+
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.samplingMethod = TINYAI_SAMPLING_GREEDY;
+    params.maxTokens      = 8;
+    int output[16];
+    tinyaiSetModelEarlyExit(model, 0, 0.0f);
+    tinyaiResetModelProfile(model);
+    int length = tinyaiGenerateText(model, &params, output, 16);
+    ASSERT(length > 1, "Generation with early exits should produce tokens");
+    ASSERT(profile[0].exits > 0, "Decoding steps should exit");
+
+    // Adding a layer clears every exit
+    tinyaiAddLayer(model, TINYAI_LAYER_LAYERNORM, 8, 8, TINYAI_ACTIVATION_NONE);
+    ASSERT(model->exitThresholds == NULL, "Adding a layer should clear the exits");
+
+    tinyaiDestroyKVCache(cache);
+    tinyaiDestroyKVCache(refCache);
+    tinyaiDestroyModel(reference);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Token callback that cancels generation after a number of tokens
+typedef struct {
+    TinyAICancelToken *token;
+    int                after; // Tokens to let through before cancelling
+    int                count;
+} CancelAfter;
+
+static bool cancel_after_token(int token, const char *piece, void *userData)
+{
+    CancelAfter *cancel = (CancelAfter *)userData;
+    (void)token;
+    (void)piece;
+    if (++cancel->count == cancel->after) {
+        tinyaiCancel(cancel->token);
+    }
+    return true;
+}
+
+// Test that cancelled and expired tokens stop forward passes and generation
+void test_cancellation()
+{
+    printf("  Testing cancellation...\n");
+
+    TinyAITokenizer   *tokenizer = create_test_tokenizer();
+    TinyAIModel       *model     = create_test_attention_model(tokenizer, 8, 16);
+    TinyAICancelToken *token     = tinyaiCreateCancelToken();
+    ASSERT(model != NULL && token != NULL, "Should create model and token");
+
+    // A cancelled pass stops before its first layer
+    int   input[3] = {TINYAI_TOKEN_BOS, 5, 6};
+    float logits[16];
+    ASSERT(tinyaiEnableModelProfiling(model, true) == 0, "Profiling should enable");
+    tinyaiCancel(token);
+    TinyAICancelToken *previous = tinyaiUseCancelToken(token);
+    ASSERT(previous == NULL, "No token should be installed");
+    ASSERT(tinyaiModelForward(model, input, 3, logits) != 0, "A cancelled pass should fail");
+    tinyaiUseCancelToken(previous);
+    const TinyAILayerProfile *profile = tinyaiGetModelProfile(model, NULL);
+    ASSERT(profile[0].calls == 0, "A cancelled pass should run no layer");
+    ASSERT(tinyaiModelForward(model, input, 3, logits) == 0,
+           "Passes outside the token's scope should run");
+    ASSERT(tinyaiEnableModelProfiling(model, false) == 0, "Profiling should disable");
+
+    // A deadline expires on its own, and a reset token runs again
+    tinyaiResetCancelToken(token);
+    tinyaiCancelAfter(token, 1);
+    for (int spin = 0; !tinyaiCancelRequested(token); spin++) {
+        ASSERT(spin < 100000000, "The deadline should pass");
+    }
+    previous = tinyaiUseCancelToken(token);
+    ASSERT(tinyaiModelForward(model, input, 3, logits) != 0, "An expired pass should fail");
+    tinyaiResetCancelToken(token);
+    ASSERT(tinyaiModelForward(model, input, 3, logits) == 0, "A reset token should run");
+    tinyaiUseCancelToken(previous);
+
+    // Generation keeps the tokens sampled before the cancellation
+    int                    prompt[2] = {TINYAI_TOKEN_BOS, 5};
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    params.maxTokens      = 12;
+    params.samplingMethod = TINYAI_SAMPLING_TEMPERATURE;
+    params.temperature    = 1.0f;
+    params.seed           = 21;
+    params.promptTokens   = prompt;
+    params.promptLength   = 2;
+
+    int expected[16], output[16];
+    int expectedCount = tinyaiGenerateText(model, &params, expected, 16);
+    ASSERT(expectedCount > 5, "Uncancelled generation should run on");
+
+    params.cancel      = token;
+    CancelAfter cancel = {token, 2, 0};
+    int count = tinyaiGenerateTextWithCallback(model, &params, cancel_after_token, &cancel);
+    ASSERT(count == 4 && cancel.count == 2, "Generation should stop at the cancellation");
+    ASSERT(tinyaiCurrentCancelToken() == NULL, "Generation should restore the thread's token");
+    ASSERT(tinyaiGenerateText(model, &params, output, 16) == 2,
+           "A cancelled generation should only hold its prompt");
+
+    // Only the cancelled sequence of a batch stops
+    TinyAIGenerationParams batchParams[2] = {params, params};
+    batchParams[0].cancel = NULL;
+    int  batchOutput[2][16];
+    int *outputs[2] = {batchOutput[0], batchOutput[1]};
+    int  tokenCounts[2];
+    ASSERT(tinyaiGenerateTextBatch(model, batchParams, 2, outputs, 16, tokenCounts) == 0,
+           "Batch generation should succeed");
+    ASSERT(tokenCounts[0] == expectedCount && tokenCounts[1] == 2,
+           "The cancelled sequence should stop while the other runs on");
+
+    TinyAIGenerationBatch *batch = tinyaiCreateGenerationBatch(model, 2, 0, NULL);
+    ASSERT(batch != NULL, "Should create generation batch");
+    tinyaiResetCancelToken(token);
+    int slots[2];
+    slots[0] = tinyaiGenerationBatchAdd(batch, &batchParams[0], NULL, NULL);
+    slots[1] = tinyaiGenerationBatchAdd(batch, &batchParams[1], NULL, NULL);
+    ASSERT(slots[0] >= 0 && slots[1] >= 0, "Sequences should join the batch");
+    ASSERT(tinyaiGenerationBatchStep(batch) == 2, "Both sequences should run");
+    tinyaiCancel(token);
+    ASSERT(tinyaiGenerationBatchStep(batch) == 1, "The cancelled sequence should leave");
+    int tokenCount = 0;
+    ASSERT(!tinyaiGenerationBatchRunning(batch, slots[1], &tokenCount) && tokenCount == 3,
+           "The cancelled sequence should keep its tokens");
+    ASSERT(tinyaiGenerationBatchRunning(batch, slots[0], NULL),
+           "The other sequence should run on");
+    tinyaiDestroyGenerationBatch(batch);
+
+    tinyaiDestroyCancelToken(token);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
 // Stub for model loading test (requires actual model files)
 void test_model_loading()
 {
@@ -439,7 +4350,50 @@ void run_generate_tests()
     test_top_k_sampling();
     test_top_p_sampling();
     test_greedy_sampling();
+    test_sampling_candidate_sets();
     test_text_generation();
+    test_embedding_gather();
+    test_group_quantization();
+    test_codebook_quantization();
+    test_int8_activations();
+    test_prepacked_weights();
+    test_parallel_quantization();
+    test_kv_cache_incremental();
+    test_kv_cache_attention();
+    test_causal_attention_kernels();
+    test_tiled_attention();
+    test_grouped_query_attention();
+    test_sliding_window_attention();
+    test_quantized_kv_cache();
+    test_paged_kv_cache();
+    test_kv_cache_discard();
+    test_avx512_attention();
+    test_model_prepare();
+    test_sparse_weight_formats();
+    test_autotune_layers();
+    test_rnn_state();
+    test_batched_prefill();
+    test_generate_text_batch();
+    test_generate_text_beam();
+    test_generation_workspace();
+    test_generate_text_speculative();
+    test_prefix_cache();
+    test_generate_text_streaming();
+    test_generation_batch();
+    test_generate_text_continue();
+    test_output_shortlist();
+    test_model_profiling();
+    test_progressive_loading();
+    test_model_snapshot();
+    test_shared_model_snapshot();
+    test_low_rank_adapter();
+    test_text_embeddings();
+    test_half_activations();
+    test_constrained_generation();
+    test_logit_processors();
+    test_early_exit();
+    test_cancellation();
+    test_model_memory_usage();
     test_model_loading();
 
     printf("--- Text Generation Tests Finished ---\n");
@@ -0,0 +1,231 @@
+/**
+ * TinyAI Grammar-Constrained Decoding Tests
+ */
+
+#include "../models/text/grammar.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define MAX_WALK_TOKENS 4
+
+// Every string the pattern "(ab|a c) ?[12]" matches
+static const char *const matches[] = {"ab1",  "ab 1",  "ab2",  "ab 2",
+                                      "a c1", "a c 1", "a c2", "a c 2"};
+
+static TinyAITokenizer *create_tokenizer(const char *const *tokens, int count)
+{
+    TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
+    ASSERT(tokenizer != NULL, "Tokenizer should be created");
+    for (int i = 0; i < count; i++) {
+        ASSERT(tinyaiAddToken(tokenizer, tokens[i], 100) >= 0, "Token should be added");
+    }
+    return tokenizer;
+}
+
+static int count_matches_with_prefix(const char *text, int length, int exact)
+{
+    int count = 0;
+    for (size_t i = 0; i < sizeof(matches) / sizeof(matches[0]); i++) {
+        if (strncmp(matches[i], text, (size_t)length) == 0 &&
+            (!exact || (int)strlen(matches[i]) == length)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Check every token's mask bit against the rendered text of each sequence
+static void check_walk(const TinyAIGrammar *grammar, const TinyAITokenizer *tokenizer,
+                       uint32_t state, int *tokens, int depth)
+{
+    char text[256];
+    int  length = tinyaiDecodeTokens(tokenizer, tokens, depth, text, sizeof(text));
+
+    ASSERT(tinyaiGrammarAccepts(grammar, state) ==
+               (count_matches_with_prefix(text, length, 1) > 0),
+           "A state should accept exactly the matched texts");
+    ASSERT(tinyaiGrammarAllows(grammar, state, TINYAI_TOKEN_EOS) ==
+               tinyaiGrammarAccepts(grammar, state),
+           "End-of-sequence should be allowed exactly on a match");
+    if (depth == MAX_WALK_TOKENS) {
+        return;
+    }
+
+    for (int t = TINYAI_TOKEN_PAD + 1; t < (int)tokenizer->tokenCount; t++) {
+        tokens[depth] = t;
+        length        = tinyaiDecodeTokens(tokenizer, tokens, depth + 1, text, sizeof(text));
+        bool viable   = count_matches_with_prefix(text, length, 0) > 0;
+        ASSERT(tinyaiGrammarAllows(grammar, state, t) == viable,
+               "A token should be allowed exactly when the text stays completable");
+
+        int64_t next = tinyaiGrammarAdvance(grammar, state, t);
+        ASSERT((next >= 0) == viable, "Advance should follow the mask");
+        if (next >= 0) {
+            check_walk(grammar, tokenizer, (uint32_t)next, tokens, depth + 1);
+        }
+    }
+}
+
+// Test token masks of a regular expression against brute-force rendering
+static void test_regex_masks()
+{
+    printf("  Testing regular expression token masks...\n");
+
+    const char *const words[] = {"a", "b", "ab", "c", "1", "2", "c1", ".", "12", "a c"};
+    TinyAITokenizer  *tokenizer = create_tokenizer(words, sizeof(words) / sizeof(words[0]));
+
+    TinyAIGrammar *grammar = tinyaiCompileGrammar("(ab|a c) ?[12]", tokenizer);
+    ASSERT(grammar != NULL, "Pattern should compile");
+    ASSERT(tinyaiGrammarStateCount(grammar) > 1, "Grammar should have states");
+
+    int tokens[MAX_WALK_TOKENS];
+    check_walk(grammar, tokenizer, tinyaiGrammarStartState(grammar), tokens, 0);
+
+    // Masked logits keep exactly the allowed tokens
+    uint32_t start  = tinyaiGrammarStartState(grammar);
+    float   *logits = (float *)malloc(tokenizer->tokenCount * sizeof(float));
+    ASSERT(logits != NULL, "Logits should be allocated");
+    for (uint32_t t = 0; t < tokenizer->tokenCount; t++) {
+        logits[t] = 1.0f;
+    }
+    uint32_t allowed = tinyaiGrammarMaskLogits(grammar, start, logits, tokenizer->tokenCount);
+    uint32_t kept    = 0;
+    for (uint32_t t = 0; t < tokenizer->tokenCount; t++) {
+        bool isAllowed = tinyaiGrammarAllows(grammar, start, (int)t);
+        ASSERT(isAllowed ? logits[t] == 1.0f : isinf(logits[t]) && logits[t] < 0.0f,
+               "Disallowed logits should be negative infinity");
+        kept += isAllowed;
+    }
+    ASSERT(allowed == kept && allowed == 3, "Only 'a', 'ab' and 'a c' should start a match");
+    ASSERT(tinyaiGrammarMaskLogits(grammar, start, logits, tokenizer->tokenCount - 1) == 0,
+           "A vocabulary size mismatch should be rejected");
+
+    free(logits);
+    tinyaiDestroyGrammar(grammar);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("  Regular expression token masks passed.\n");
+}
+
+// Walk a token sequence, checking it ends in a full match
+static bool walk_tokens(const TinyAIGrammar *grammar, const TinyAITokenizer *tokenizer,
+                        const char *const *pieces, int count)
+{
+    uint32_t state = tinyaiGrammarStartState(grammar);
+    for (int i = 0; i < count; i++) {
+        if (tinyaiGrammarAllows(grammar, state, TINYAI_TOKEN_EOS)) {
+            return false; // Only the complete sequence should match
+        }
+        int64_t next =
+            tinyaiGrammarAdvance(grammar, state, tinyaiGetTokenId(tokenizer, pieces[i]));
+        if (next < 0) {
+            return false;
+        }
+        state = (uint32_t)next;
+    }
+    return tinyaiGrammarAllows(grammar, state, TINYAI_TOKEN_EOS);
+}
+
+// Test JSON schema conversion and compiled schema grammars
+static void test_json_schema()
+{
+    printf("  Testing JSON schema grammars...\n");
+
+    char pattern[4096];
+    ASSERT(tinyaiJsonSchemaToPattern("{\"type\": \"integer\"}", pattern, sizeof(pattern)) > 0,
+           "Integer schema should convert");
+    ASSERT(strcmp(pattern, "(-?(0|[1-9][0-9]*))") == 0, "Integer pattern should be exact");
+    ASSERT(tinyaiJsonSchemaToPattern("{\"enum\": [\"red\", 2, null]}", pattern,
+                                     sizeof(pattern)) > 0,
+           "Enum schema should convert");
+    ASSERT(strcmp(pattern, "(\"red\"|2|null)") == 0, "Enum pattern should list the values");
+    ASSERT(tinyaiJsonSchemaToPattern("{\"type\": \"wat\"}", pattern, sizeof(pattern)) == -1,
+           "An unknown type should be rejected");
+    ASSERT(tinyaiJsonSchemaToPattern("{\"type\": ", pattern, sizeof(pattern)) == -1,
+           "Truncated JSON should be rejected");
+    ASSERT(tinyaiJsonSchemaToPattern(NULL, pattern, 8) == -1,
+           "A small buffer should be rejected");
+
+    const char *const words[] = {"{", "}", "[", "]", ":", ",", "\"name\"", "\"age\"", "\"nom\"",
+                                 "\"bob\"", "42", "-", "7", "true", "null"};
+    TinyAITokenizer  *tokenizer = create_tokenizer(words, sizeof(words) / sizeof(words[0]));
+
+    const char *schema = "{\"type\": \"object\", \"properties\": {"
+                         "\"name\": {\"type\": \"string\", \"maxLength\": 8},"
+                         "\"age\": {\"type\": \"integer\"}}}";
+    TinyAIGrammar *grammar = tinyaiCompileJsonSchema(schema, tokenizer);
+    ASSERT(grammar != NULL, "Object schema should compile");
+
+    const char *const person[] = {"{", "\"name\"", ":", "\"bob\"", ",", "\"age\"", ":", "-",
+                                  "42", "}"};
+    ASSERT(!walk_tokens(grammar, tokenizer, person, 10), "'- 42' should not be an integer");
+    const char *const valid[] = {"{", "\"name\"", ":", "\"bob\"", ",", "\"age\"", ":", "42",
+                                 "}"};
+    ASSERT(walk_tokens(grammar, tokenizer, valid, 9), "Matching object should be accepted");
+    const char *const renamed[] = {"{", "\"nom\"", ":", "\"bob\"", ",", "\"age\"", ":", "42",
+                                   "}"};
+    ASSERT(!walk_tokens(grammar, tokenizer, renamed, 9), "Unknown property should be rejected");
+    tinyaiDestroyGrammar(grammar);
+
+    // Any JSON value, nested
+    grammar = tinyaiCompileJsonSchema(NULL, tokenizer);
+    ASSERT(grammar != NULL, "Any-value grammar should compile");
+    ASSERT(tinyaiGrammarStateCount(grammar) <= TINYAI_GRAMMAR_MAX_STATES + 1,
+           "State count should be bounded");
+    const char *const nested[] = {"[", "{", "\"age\"", ":", "7", "}", ",", "[", "true", "]",
+                                  ",", "null", "]"};
+    ASSERT(walk_tokens(grammar, tokenizer, nested, 13), "Nested value should be accepted");
+    const char *const unclosed[] = {"[", "7", ","};
+    ASSERT(!walk_tokens(grammar, tokenizer, unclosed, 3), "Unclosed array should not match");
+    tinyaiDestroyGrammar(grammar);
+
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("  JSON schema grammars passed.\n");
+}
+
+// Test that malformed and empty patterns are rejected
+static void test_invalid_patterns()
+{
+    printf("  Testing invalid grammar patterns...\n");
+
+    const char *const words[] = {"a", "b"};
+    TinyAITokenizer  *tokenizer = create_tokenizer(words, 2);
+
+    const char *const invalid[] = {"(ab", "ab)", "a{3,1}", "[z-a]", "*a", "a{999}", "[ab", "\\"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        ASSERT(tinyaiCompileGrammar(invalid[i], tokenizer) == NULL,
+               "Malformed pattern should be rejected");
+    }
+    ASSERT(tinyaiCompileGrammar("[^\\x00-\\xff]", tokenizer) == NULL,
+           "A pattern matching nothing should be rejected");
+    ASSERT(tinyaiCompileGrammar("a", NULL) == NULL, "A missing tokenizer should be rejected");
+
+    TinyAIGrammar *grammar = tinyaiCompileGrammar("(a|b){2,3}", tokenizer);
+    ASSERT(grammar != NULL, "Bounded repetition should compile");
+    ASSERT(tinyaiGrammarAdvance(grammar, tinyaiGrammarStartState(grammar), TINYAI_TOKEN_EOS) ==
+               -1,
+           "End-of-sequence should not advance");
+    tinyaiDestroyGrammar(grammar);
+
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("  Invalid grammar patterns passed.\n");
+}
+
+void run_grammar_tests()
+{
+    printf("--- Running Grammar Tests ---\n");
+    test_regex_masks();
+    test_json_schema();
+    test_invalid_patterns();
+    printf("--- Grammar Tests Finished ---\n");
+}
@@ -9,6 +9,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 /* Mock model for local generation testing */
 TinyAIModel mockModel = {
@@ -21,10 +26,30 @@ TinyAIModel mockModel = {
     .activations  = {NULL, NULL},
     .activeBuffer = 0};
 
+/* Time the mock local generation takes, in milliseconds */
+static int mockLocalDelayMs = 0;
+
+/* Time the mock streaming generation takes per token, in milliseconds */
+static int mockTokenDelayMs = 0;
+
+static void sleepMs(int milliseconds)
+{
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    struct timespec delay = {milliseconds / 1000, (milliseconds % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+#endif
+}
+
 /* Mock generate function for testing */
 int tinyaiGenerateText(TinyAIModel *model, const TinyAIGenerationParams *params, int *outputTokens,
                        int maxTokens)
 {
+    if (mockLocalDelayMs > 0) {
+        sleepMs(mockLocalDelayMs);
+    }
+
     /* Generate some dummy tokens */
     int count = params->maxTokens < 5 ? params->maxTokens : 5;
     for (int i = 0; i < count; i++) {
@@ -33,6 +58,40 @@ int tinyaiGenerateText(TinyAIModel *model, const TinyAIGenerationParams *params,
     return count;
 }
 
+/* Mock streaming generate function for testing */
+int tinyaiGenerateTextWithCallback(TinyAIModel *model, const TinyAIGenerationParams *params,
+                                   TinyAITokenCallback callback, void *userData)
+{
+    int count = 0;
+    while (count < params->maxTokens) {
+        if (mockTokenDelayMs > 0) {
+            sleepMs(mockTokenDelayMs);
+        }
+        count++;
+        if (!callback(count + 9, "t", userData)) {
+            break;
+        }
+    }
+    return params->promptLength + count;
+}
+
+/* Tokens streamed to a hedged generation callback */
+typedef struct {
+    int  tokens[64];
+    char text[256];
+    int  count;
+} StreamedTokens;
+
+static bool collectToken(int token, const char *piece, void *userData)
+{
+    StreamedTokens *streamed = (StreamedTokens *)userData;
+    if (streamed->count < 64) {
+        streamed->tokens[streamed->count++] = token;
+        strncat(streamed->text, piece, sizeof(streamed->text) - strlen(streamed->text) - 1);
+    }
+    return true;
+}
+
 /* Test hybrid generation with local-only setup */
 void testLocalOnlyGeneration()
 {
@@ -45,6 +104,7 @@ void testLocalOnlyGeneration()
     /* Create generation parameters */
     TinyAIGenerationParams params;
     int                    promptTokens[2] = {1, 2};
+    memset(&params, 0, sizeof(params));
     params.promptTokens                    = promptTokens;
     params.promptLength                    = 2;
     params.maxTokens                       = 5;
@@ -63,8 +123,8 @@ void testLocalOnlyGeneration()
     assert(!tinyaiHybridGenerateUsedRemote(hybrid));
 
     /* Get generation stats */
-    double localTime, remoteTime, tokensPerSec;
-    tinyaiHybridGenerateGetStats(hybrid, &localTime, &remoteTime, &tokensPerSec);
+    double localTime, remoteTime, tokensPerSec, cacheHitRate;
+    tinyaiHybridGenerateGetStats(hybrid, &localTime, &remoteTime, &tokensPerSec, &cacheHitRate);
 
     printf("  Local time: %.2f ms\n", localTime);
     printf("  Remote time: %.2f ms\n", remoteTime);
@@ -72,6 +132,7 @@ void testLocalOnlyGeneration()
 
     assert(localTime > 0.0);
     assert(remoteTime == 0.0);
+    assert(cacheHitRate == 0.0);
 
     /* Clean up */
     tinyaiDestroyHybridGenerate(hybrid);
@@ -102,6 +163,7 @@ void testHybridGeneration()
     /* Create generation parameters that should trigger remote execution */
     TinyAIGenerationParams params;
     int                    promptTokens[200];
+    memset(&params, 0, sizeof(params));
     for (int i = 0; i < 200; i++) {
         promptTokens[i] = i;
     }
@@ -131,7 +193,7 @@ void testHybridGeneration()
 
     /* Get generation stats */
     double localTime, remoteTime, tokensPerSec;
-    tinyaiHybridGenerateGetStats(hybrid, &localTime, &remoteTime, &tokensPerSec);
+    tinyaiHybridGenerateGetStats(hybrid, &localTime, &remoteTime, &tokensPerSec, NULL);
 
     printf("  Local time: %.2f ms\n", localTime);
     printf("  Remote time: %.2f ms\n", remoteTime);
@@ -172,6 +234,147 @@ void testHybridGeneration()
     printf("Hybrid generation test passed!\n\n");
 }
 
+/* Test that measured completion times and the latency target drive routing */
+void testLatencyRouting()
+{
+    printf("Testing latency-aware routing...\n");
+
+    TinyAIMcpClient *mcpClient = tinyaiMcpCreateClient(NULL);
+    assert(mcpClient != NULL);
+    assert(tinyaiMcpConnect(mcpClient, "mock://localhost:8080"));
+    tinyaiMcpSetExecutionPreference(mcpClient, TINYAI_EXEC_PREFER_LOCAL);
+
+    TinyAIHybridGenerate *hybrid = tinyaiCreateHybridGenerate(&mockModel, mcpClient);
+    assert(hybrid != NULL);
+
+    TinyAIGenerationParams params;
+    int                    promptTokens[4] = {1, 2, 3, 4};
+    memset(&params, 0, sizeof(params));
+    params.promptTokens = promptTokens;
+    params.promptLength = 4;
+    params.maxTokens    = 5;
+
+    /* Nothing measured yet: the preference keeps a short request local */
+    TinyAIHybridRouteEstimate estimate;
+    assert(tinyaiHybridGenerateEstimate(hybrid, &params, &estimate));
+    assert(!estimate.localMeasured && !estimate.remoteMeasured);
+    assert(!estimate.useRemote);
+
+    int outputTokens[16];
+    mockLocalDelayMs = 20;
+    assert(tinyaiHybridGenerateText(hybrid, &params, outputTokens, 16) == 5);
+    assert(!tinyaiHybridGenerateUsedRemote(hybrid));
+
+    /* A slow local side that misses the target sends the next request remote to measure it */
+    tinyaiHybridGenerateSetLatencyTarget(hybrid, 5.0);
+    assert(tinyaiHybridGenerateEstimate(hybrid, &params, &estimate));
+    assert(estimate.localMeasured && estimate.predictedLocalMs >= 15.0);
+    assert(estimate.localQueueDepth == 0);
+    assert(estimate.useRemote);
+    assert(tinyaiHybridGenerateText(hybrid, &params, outputTokens, 16) > 0);
+    assert(tinyaiHybridGenerateUsedRemote(hybrid));
+
+    /* Both measured: the faster remote side wins while local misses the target */
+    assert(tinyaiHybridGenerateEstimate(hybrid, &params, &estimate));
+    assert(estimate.remoteMeasured);
+    assert(estimate.predictedRemoteMs < estimate.predictedLocalMs);
+    assert(estimate.useRemote);
+    printf("  Predicted local: %.2f ms, remote: %.2f ms\n", estimate.predictedLocalMs,
+           estimate.predictedRemoteMs);
+
+    /* A target local can meet keeps requests on the preferred local side */
+    tinyaiHybridGenerateSetLatencyTarget(hybrid, 10000.0);
+    assert(!tinyaiHybridGenerateWouldUseRemote(hybrid, &params));
+
+    /* Without a target, requests go to the faster side */
+    tinyaiHybridGenerateSetLatencyTarget(hybrid, 0);
+    assert(tinyaiHybridGenerateWouldUseRemote(hybrid, &params));
+
+    /* Always-local still wins over measurements */
+    tinyaiMcpSetExecutionPreference(mcpClient, TINYAI_EXEC_ALWAYS_LOCAL);
+    assert(!tinyaiHybridGenerateWouldUseRemote(hybrid, &params));
+
+    mockLocalDelayMs = 0;
+    tinyaiDestroyHybridGenerate(hybrid);
+    tinyaiMcpDestroyClient(mcpClient);
+    printf("Latency-aware routing test passed!\n\n");
+}
+
+/* Test racing local and remote generation */
+void testHedgedGeneration()
+{
+    printf("Testing hedged generation...\n");
+
+    TinyAIMcpClient *mcpClient = tinyaiMcpCreateClient(NULL);
+    assert(mcpClient != NULL);
+    assert(tinyaiMcpConnect(mcpClient, "mock://localhost:8080"));
+
+    TinyAIHybridGenerate *hybrid = tinyaiCreateHybridGenerate(&mockModel, mcpClient);
+    assert(hybrid != NULL);
+    TinyAIHybridHedgeConfig config = {4, 1.0};
+    tinyaiHybridGenerateSetHedgeConfig(hybrid, &config);
+
+    TinyAIGenerationParams params;
+    int                    promptTokens[4] = {1, 2, 3, 4};
+    memset(&params, 0, sizeof(params));
+    params.promptTokens = promptTokens;
+    params.promptLength = 4;
+    params.maxTokens    = 12;
+
+    /* A slow local model loses to the remote reply, and none of its tokens are streamed */
+    StreamedTokens streamed;
+    int            outputTokens[64];
+    memset(&streamed, 0, sizeof(streamed));
+    mockTokenDelayMs = 20;
+    int count = tinyaiHybridGenerateHedged(hybrid, &params, outputTokens, 64, collectToken,
+                                           &streamed);
+    assert(count == 10);
+    assert(tinyaiHybridGenerateUsedRemote(hybrid));
+    assert(streamed.count == count);
+    for (int i = 0; i < count; i++) {
+        assert(streamed.tokens[i] == outputTokens[i] && outputTokens[i] == 100 + i);
+    }
+
+    /* Whichever side wins, the stream matches the output and comes from one side only */
+    mockTokenDelayMs = 0;
+    memset(&streamed, 0, sizeof(streamed));
+    count = tinyaiHybridGenerateHedged(hybrid, &params, outputTokens, 64, collectToken, &streamed);
+    assert(count > 0 && streamed.count == count);
+    int first = tinyaiHybridGenerateUsedRemote(hybrid) ? 100 : 10;
+    for (int i = 0; i < count; i++) {
+        assert(streamed.tokens[i] == outputTokens[i] && outputTokens[i] == first + i);
+    }
+    if (first == 10) {
+        assert(count == 12 && strlen(streamed.text) == 12);
+    }
+
+    TinyAIHybridHedgeStats stats;
+    assert(tinyaiHybridGenerateGetHedgeStats(hybrid, &stats));
+    assert(stats.requests == 2 && stats.hedged == 2);
+    assert(stats.remoteWins >= 1 && stats.localWins + stats.remoteWins == 2);
+
+    /* The budget limits how many requests hedge: the first, then one in four */
+    config.budget = 0.25;
+    tinyaiHybridGenerateSetHedgeConfig(hybrid, &config);
+    for (int i = 0; i < 9; i++) {
+        assert(tinyaiHybridGenerateHedged(hybrid, &params, outputTokens, 64, NULL, NULL) > 0);
+    }
+    assert(tinyaiHybridGenerateGetHedgeStats(hybrid, &stats));
+    assert(stats.requests == 11 && stats.hedged == 2 + 3);
+
+    /* Without remote, hedged generation streams local tokens as they come */
+    TinyAIHybridGenerate *local = tinyaiCreateHybridGenerate(&mockModel, NULL);
+    memset(&streamed, 0, sizeof(streamed));
+    count = tinyaiHybridGenerateHedged(local, &params, outputTokens, 5, collectToken, &streamed);
+    assert(count == 5 && streamed.count == 5 && outputTokens[4] == 14);
+    assert(strcmp(streamed.text, "ttttt") == 0);
+    tinyaiDestroyHybridGenerate(local);
+
+    tinyaiDestroyHybridGenerate(hybrid);
+    tinyaiMcpDestroyClient(mcpClient);
+    printf("Hedged generation test passed!\n\n");
+}
+
 /* Test hybrid generation with no model and no MCP client */
 void testNoModelsGeneration()
 {
@@ -184,6 +387,7 @@ void testNoModelsGeneration()
     /* Try to generate text - should fail */
     TinyAIGenerationParams params;
     int                    promptTokens[2] = {1, 2};
+    memset(&params, 0, sizeof(params));
     params.promptTokens                    = promptTokens;
     params.promptLength                    = 2;
     params.maxTokens                       = 5;
@@ -209,6 +413,8 @@ int testHybridMain()
     /* Run tests */
     testLocalOnlyGeneration();
     testHybridGeneration();
+    testLatencyRouting();
+    testHedgedGeneration();
     testNoModelsGeneration();
 
     printf("=== All Hybrid Generation Tests Passed! ===\n\n");
@@ -5,6 +5,7 @@
 #include "../models/image/image_model.h"
 #include "../utils/benchmark.h"
 #include "../utils/model_loader.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -264,6 +265,66 @@ void test_image_creation()
     printf("    PASS\n");
 }
 
+// Test preprocessing straight into a float tensor
+void test_preprocess_to_tensor()
+{
+    printf("  Testing fused image preprocessing...\n");
+
+    TinyAIImagePreprocessParams params;
+    tinyaiImagePreprocessParamsDefault(&params);
+    params.targetWidth  = 16;
+    params.targetHeight = 12;
+
+    // A solid color comes out as its normalized value, whatever the source format
+    const uint8_t color[3] = {200, 100, 50};
+    TinyAIImage  *rgb      = tinyaiImageCreate(40, 30, TINYAI_IMAGE_FORMAT_RGB);
+    TinyAIImage  *bgr      = tinyaiImageCreate(40, 30, TINYAI_IMAGE_FORMAT_BGR);
+    ASSERT(rgb != NULL && bgr != NULL, "Image creation should succeed");
+    for (int i = 0; i < 40 * 30; i++) {
+        for (int c = 0; c < 3; c++) {
+            rgb->data[i * 3 + c]     = color[c];
+            bgr->data[i * 3 + 2 - c] = color[c];
+        }
+    }
+
+    float fromRgb[16 * 12 * 3], fromBgr[16 * 12 * 3];
+    ASSERT(tinyaiImagePreprocessToTensor(rgb, &params, 3, fromRgb),
+           "RGB preprocessing should succeed");
+    ASSERT(tinyaiImagePreprocessToTensor(bgr, &params, 3, fromBgr),
+           "BGR preprocessing should succeed");
+    for (int i = 0; i < 16 * 12; i++) {
+        for (int c = 0; c < 3; c++) {
+            float expected = (color[c] - 127.5f) / 127.5f;
+            ASSERT(fabsf(fromRgb[i * 3 + c] - expected) < 1e-5f,
+                   "RGB values should be normalized");
+            ASSERT(fabsf(fromBgr[i * 3 + c] - expected) < 1e-5f,
+                   "BGR channels should be reordered");
+        }
+    }
+
+    // Shrinking a pattern of alternating pixels by two averages each pair
+    TinyAIImage *stripes = tinyaiImageCreate(32, 24, TINYAI_IMAGE_FORMAT_GRAYSCALE);
+    ASSERT(stripes != NULL, "Image creation should succeed");
+    for (int i = 0; i < 32 * 24; i++) {
+        stripes->data[i] = (i % 2) ? 255 : 0;
+    }
+    float gray[16 * 12];
+    ASSERT(tinyaiImagePreprocessToTensor(stripes, &params, 1, gray),
+           "Grayscale preprocessing should succeed");
+    for (int i = 0; i < 16 * 12; i++) {
+        ASSERT(fabsf(gray[i]) < 1e-5f, "Area resampling should average the covered pixels");
+    }
+
+    ASSERT(!tinyaiImagePreprocessToTensor(rgb, &params, 2, fromRgb),
+           "Unsupported channel counts should fail");
+
+    tinyaiImageFree(rgb);
+    tinyaiImageFree(bgr);
+    tinyaiImageFree(stripes);
+
+    printf("    PASS\n");
+}
+
 // Test model inference with a synthetic image
 void test_model_inference()
 {
@@ -317,6 +378,324 @@ void test_model_inference()
     printf("    PASS\n");
 }
 
+// Test that a batch classifies each image as it would be classified alone
+void test_batch_inference()
+{
+    printf("  Testing batched model inference...\n");
+
+    TinyAIImageModelParams params = {.modelType       = TINYAI_IMAGE_MODEL_TINY_CNN,
+                                     .inputWidth      = 64,
+                                     .inputHeight     = 64,
+                                     .inputChannels   = 3,
+                                     .numClasses      = 10,
+                                     .weightsFile     = NULL,
+                                     .labelsFile      = NULL,
+                                     .useQuantization = true,
+                                     .useSIMD         = true,
+                                     .customParams    = NULL};
+
+    TinyAIImageModel *model = tinyaiImageModelCreate(&params);
+    ASSERT(model != NULL, "Model creation should succeed");
+
+    // More images than one chunk, so the batch is split
+    enum { NUM_IMAGES = TINYAI_IMAGE_MAX_BATCH + 3, TOP_K = 3 };
+    TinyAIImage *images[NUM_IMAGES];
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        images[i] = create_test_image(64 + i, 64, TINYAI_IMAGE_FORMAT_RGB);
+        ASSERT(images[i] != NULL, "Test image creation should succeed");
+    }
+
+    TinyAIImageClassResult batchResults[NUM_IMAGES * TOP_K];
+    int numResults = tinyaiImageModelClassifyBatch(model, (const TinyAIImage *const *)images,
+                                                   NUM_IMAGES, TOP_K, batchResults);
+    ASSERT(numResults == TOP_K, "Batch classification should return topK results per image");
+
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        TinyAIImageClassResult single[TOP_K];
+        ASSERT(tinyaiImageModelClassify(model, images[i], TOP_K, single) == TOP_K,
+               "Single classification should succeed");
+        for (int k = 0; k < TOP_K; k++) {
+            ASSERT(fabsf(single[k].confidence - batchResults[i * TOP_K + k].confidence) < 1e-4f,
+                   "Batched confidence should match the single-image confidence");
+        }
+    }
+
+    ASSERT(tinyaiImageModelClassifyBatch(model, NULL, 1, TOP_K, batchResults) < 0,
+           "A missing image list should fail");
+
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        tinyaiImageFree(images[i]);
+    }
+    tinyaiImageModelFree(model);
+
+    printf("    PASS\n");
+}
+
+// Test that threaded inference matches serial inference
+void test_threaded_inference()
+{
+    printf("  Testing threaded model inference...\n");
+
+    TinyAIImageModelParams params = {.modelType       = TINYAI_IMAGE_MODEL_MOBILENET,
+                                     .inputWidth      = 96,
+                                     .inputHeight     = 96,
+                                     .inputChannels   = 3,
+                                     .numClasses      = 10,
+                                     .weightsFile     = NULL,
+                                     .labelsFile      = NULL,
+                                     .useQuantization = true,
+                                     .useSIMD         = true,
+                                     .customParams    = NULL};
+
+    TinyAIImageModel *model = tinyaiImageModelCreate(&params);
+    ASSERT(model != NULL, "Model creation should succeed");
+
+    TinyAIImage *image = create_test_image(96, 96, TINYAI_IMAGE_FORMAT_RGB);
+    ASSERT(image != NULL, "Test image creation should succeed");
+
+    enum { TOP_K = 3 };
+    TinyAIImageClassResult serial[TOP_K], threaded[TOP_K];
+    ASSERT(tinyaiImageModelSetThreading(model, false, NULL), "Disabling threads should succeed");
+    ASSERT(tinyaiImageModelClassify(model, image, TOP_K, serial) == TOP_K,
+           "Serial classification should succeed");
+
+    // A pool that splits even small layers
+    TinyAIThreadPool *pool = tinyaiCreateThreadPool(4, 1);
+    ASSERT(pool != NULL, "Thread pool creation should succeed");
+    ASSERT(tinyaiImageModelSetThreading(model, true, pool), "Setting a pool should succeed");
+    ASSERT(tinyaiImageModelClassify(model, image, TOP_K, threaded) == TOP_K,
+           "Threaded classification should succeed");
+
+    for (int k = 0; k < TOP_K; k++) {
+        ASSERT(threaded[k].classId == serial[k].classId,
+               "Threaded classes should match the serial classes");
+        ASSERT(fabsf(threaded[k].confidence - serial[k].confidence) < 1e-5f,
+               "Threaded confidence should match the serial confidence");
+    }
+
+    ASSERT(!tinyaiImageModelSetThreading(NULL, true, NULL), "A missing model should fail");
+
+    tinyaiImageFree(image);
+    tinyaiImageModelFree(model);
+    tinyaiDestroyThreadPool(pool);
+
+    printf("    PASS\n");
+}
+
+// Test calibrating int8 activations and the checks on enabling them
+void test_int8_activations()
+{
+    printf("  Testing int8 activation calibration...\n");
+
+    TinyAIImageModelParams params = {.modelType       = TINYAI_IMAGE_MODEL_TINY_CNN,
+                                     .inputWidth      = 64,
+                                     .inputHeight     = 64,
+                                     .inputChannels   = 3,
+                                     .numClasses      = 10,
+                                     .weightsFile     = NULL,
+                                     .labelsFile      = NULL,
+                                     .useQuantization = true,
+                                     .useSIMD         = true,
+                                     .customParams    = NULL};
+
+    TinyAIImageModel *model = tinyaiImageModelCreate(&params);
+    ASSERT(model != NULL, "Model creation should succeed");
+
+    enum { NUM_IMAGES = 3, TOP_K = 3 };
+    TinyAIImage *images[NUM_IMAGES];
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        images[i] = create_test_image(64 + 8 * i, 64, TINYAI_IMAGE_FORMAT_RGB);
+        ASSERT(images[i] != NULL, "Test image creation should succeed");
+    }
+
+    ASSERT(!tinyaiImageModelEnableInt8Activations(model, true),
+           "Int8 activations should need calibration");
+    ASSERT(tinyaiImageModelCalibrateActivations(model, (const TinyAIImage *const *)images,
+                                                NUM_IMAGES),
+           "Calibration should succeed");
+    ASSERT(!tinyaiImageModelCalibrateActivations(model, NULL, NUM_IMAGES),
+           "Calibration without images should fail");
+
+    // Layers without weights have no int8 kernel; the model stays in floats
+    size_t weightMemory, activationMemory, int8ActivationMemory;
+    ASSERT(tinyaiImageModelGetMemoryUsage(model, &weightMemory, &activationMemory),
+           "Memory usage should be available");
+    ASSERT(!tinyaiImageModelEnableInt8Activations(model, true),
+           "Int8 activations should need the layer weights");
+    ASSERT(tinyaiImageModelGetMemoryUsage(model, &weightMemory, &int8ActivationMemory),
+           "Memory usage should be available");
+    ASSERT(int8ActivationMemory == activationMemory, "A failed enable should keep float tensors");
+
+    TinyAIImageClassResult results[TOP_K];
+    ASSERT(tinyaiImageModelClassify(model, images[0], TOP_K, results) == TOP_K,
+           "Classification should still succeed");
+    ASSERT(tinyaiImageModelEnableInt8Activations(model, false),
+           "Disabling int8 activations should succeed");
+
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        tinyaiImageFree(images[i]);
+    }
+    tinyaiImageModelFree(model);
+
+    printf("    PASS\n");
+}
+
+// Test early-exit heads: stopping, compacting the batch, counts and calibration
+void test_image_early_exit()
+{
+    printf("  Testing early-exit heads...\n");
+
+    TinyAIImageModelParams params = {.modelType       = TINYAI_IMAGE_MODEL_TINY_CNN,
+                                     .inputWidth      = 64,
+                                     .inputHeight     = 64,
+                                     .inputChannels   = 3,
+                                     .numClasses      = 10,
+                                     .weightsFile     = NULL,
+                                     .labelsFile      = NULL,
+                                     .useQuantization = true,
+                                     .useSIMD         = true,
+                                     .customParams    = NULL};
+
+    TinyAIImageModel *model = tinyaiImageModelCreate(&params);
+    ASSERT(model != NULL, "Model creation should succeed");
+
+    enum { NUM_IMAGES = 5, TOP_K = 3, POOL_LAYER = 1, CHANNELS = 16 };
+    TinyAIImage *images[NUM_IMAGES];
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        images[i] = create_test_image(64 + 8 * i, 64, TINYAI_IMAGE_FORMAT_RGB);
+        ASSERT(images[i] != NULL, "Test image creation should succeed");
+    }
+
+    TinyAIImageClassResult full[NUM_IMAGES * TOP_K], exited[NUM_IMAGES * TOP_K];
+    ASSERT(tinyaiImageModelClassifyBatch(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                         TOP_K, full) == TOP_K,
+           "Classification should succeed");
+
+    // A head after the first pooling layer that always favors class 3
+    float weights[10 * CHANNELS], biases[10];
+    for (int i = 0; i < 10 * CHANNELS; i++) {
+        weights[i] = (float)(i % 7) * 0.001f;
+    }
+    for (int k = 0; k < 10; k++) {
+        biases[k] = k == 3 ? 50.0f : 0.0f;
+    }
+    ASSERT(!tinyaiImageModelSetExitHead(model, 4, weights, biases, 0.5f),
+           "A flatten layer should not take a head");
+    ASSERT(!tinyaiImageModelSetExitHead(model, 6, weights, biases, 0.5f),
+           "The last layer should not take a head");
+
+    // A head that never stops changes nothing
+    ASSERT(tinyaiImageModelSetExitHead(model, POOL_LAYER, weights, biases, 2.0f),
+           "Attaching a head should succeed");
+    ASSERT(tinyaiImageModelClassifyBatch(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                         TOP_K, exited) == TOP_K,
+           "Classification with a head should succeed");
+    for (int i = 0; i < NUM_IMAGES * TOP_K; i++) {
+        ASSERT(exited[i].classId == full[i].classId &&
+                   fabsf(exited[i].confidence - full[i].confidence) < 1e-5f,
+               "A head that never stops should leave the results unchanged");
+    }
+
+    // A confident head stops every image of the batch
+    ASSERT(tinyaiImageModelSetExitHead(model, POOL_LAYER, weights, biases, 0.9f),
+           "Replacing a head should succeed");
+    ASSERT(tinyaiImageModelClassifyBatch(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                         TOP_K, exited) == TOP_K,
+           "Classification with a head should succeed");
+    uint64_t counts[8];
+    ASSERT(tinyaiImageModelGetExitCounts(model, counts, 8) == 7, "Every layer should be counted");
+    ASSERT(counts[POOL_LAYER] == NUM_IMAGES && counts[0] == 0, "Every image should exit");
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        ASSERT(exited[i * TOP_K].classId == 3, "Exited images should take the head's class");
+    }
+    tinyaiImageModelResetExitCounts(model);
+    ASSERT(tinyaiImageModelGetExitCounts(model, counts, 8) == 7 && counts[POOL_LAYER] == 0,
+           "Reset should clear the counts");
+
+    // With nothing required to agree, calibration keeps the head reachable
+    ASSERT(tinyaiImageModelCalibrateExits(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                          0.0f),
+           "Calibration should succeed");
+    ASSERT(tinyaiImageModelClassifyBatch(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                         TOP_K, exited) == TOP_K,
+           "Classification after calibration should succeed");
+    ASSERT(tinyaiImageModelGetExitCounts(model, counts, 8) == 7 && counts[POOL_LAYER] > 0,
+           "A calibrated head should stop the most confident images");
+    ASSERT(!tinyaiImageModelCalibrateExits(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                           1.5f),
+           "An agreement above 1 should be rejected");
+
+    // Removing the head runs every layer again
+    ASSERT(tinyaiImageModelSetExitHead(model, POOL_LAYER, NULL, NULL, 0.0f),
+           "Removing a head should succeed");
+    ASSERT(tinyaiImageModelClassifyBatch(model, (const TinyAIImage *const *)images, NUM_IMAGES,
+                                         TOP_K, exited) == TOP_K,
+           "Classification should succeed");
+    ASSERT(exited[0].classId == full[0].classId, "Removing a head should restore the results");
+
+    for (int i = 0; i < NUM_IMAGES; i++) {
+        tinyaiImageFree(images[i]);
+    }
+    tinyaiImageModelFree(model);
+
+    printf("    PASS\n");
+}
+
+// Test running the convolutional trunk over an image larger than the model input
+void test_tiled_inference()
+{
+    printf("  Testing tiled inference...\n");
+
+    TinyAIImageModelParams params = {.modelType       = TINYAI_IMAGE_MODEL_TINY_CNN,
+                                     .inputWidth      = 64,
+                                     .inputHeight     = 64,
+                                     .inputChannels   = 3,
+                                     .numClasses      = 10,
+                                     .weightsFile     = NULL,
+                                     .labelsFile      = NULL,
+                                     .useQuantization = true,
+                                     .useSIMD         = true,
+                                     .customParams    = NULL};
+
+    TinyAIImageModel *model = tinyaiImageModelCreate(&params);
+    ASSERT(model != NULL, "Model creation should succeed");
+
+    // Two padded 3x3 convolutions, each followed by 2x2 pooling
+    int width, height, channels;
+    ASSERT(tinyaiImageModelGetTiledOutputSize(model, 100, 80, &width, &height, &channels),
+           "Tiled output size should be available");
+    ASSERT(width == 25 && height == 20 && channels == 32, "Trunk should stop before flatten");
+    ASSERT(!tinyaiImageModelGetTiledOutputSize(model, 1, 1, &width, &height, &channels),
+           "Input smaller than a pooling window should fail");
+
+    float *input  = (float *)calloc(100 * 80 * 3, sizeof(float));
+    float *output = (float *)malloc(25 * 20 * 32 * sizeof(float));
+    ASSERT(input != NULL && output != NULL, "Buffer allocation should succeed");
+
+    // Layers without weights output zeros; every position must be written
+    int tileSizes[] = {4, 7, 0};
+    for (int t = 0; t < 3; t++) {
+        for (int i = 0; i < 25 * 20 * 32; i++) {
+            output[i] = 1.0f;
+        }
+        ASSERT(tinyaiImageModelForwardTiled(model, input, 100, 80, tileSizes[t], output),
+               "Tiled forward pass should succeed");
+        bool written = true;
+        for (int i = 0; i < 25 * 20 * 32; i++) {
+            written = written && output[i] == 0.0f;
+        }
+        ASSERT(written, "Tiles should cover the whole feature map");
+    }
+    ASSERT(!tinyaiImageModelForwardTiled(model, input, 100, 80, -1, output),
+           "Negative tile size should fail");
+
+    free(input);
+    free(output);
+    tinyaiImageModelFree(model);
+
+    printf("    PASS\n");
+}
+
 // Test saving and loading model weights
 void test_model_weight_save_load()
 {
@@ -382,7 +761,13 @@ void run_image_model_tests()
     test_different_architectures();
     test_quantization_options();
     test_image_creation();
+    test_preprocess_to_tensor();
     test_model_inference();
+    test_batch_inference();
+    test_threaded_inference();
+    test_int8_activations();
+    test_image_early_exit();
+    test_tiled_inference();
     test_model_weight_save_load();
 
     printf("--- Image Model Tests Finished ---\n");
@@ -117,6 +117,76 @@ void test_file_modes() {
     printf("    PASS\n");
 }
 
+void test_buffered_reads() {
+    printf("  Testing buffered, vectored and direct reads...\n");
+    const char* testFileName = "tinyai_test_buffered_temp.bin";
+
+    // Header fields followed by a payload larger than the buffer
+    uint32_t header[3] = {0x4D494E54, 2, 3};
+    float scales[2] = {0.5f, -1.25f};
+    unsigned char payload[5000];
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (unsigned char)(i * 31 + 7);
+    }
+    TinyAIFile* f = tinyaiOpenFile(testFileName, TINYAI_FILE_WRITE | TINYAI_FILE_BINARY);
+    ASSERT(f != NULL, "Should open for binary write.");
+    tinyaiWriteFile(f, header, sizeof(header));
+    tinyaiWriteFile(f, scales, sizeof(scales));
+    tinyaiWriteFile(f, payload, sizeof(payload));
+    tinyaiWriteFile(f, "tail line\r\nlast", 15);
+    tinyaiCloseFile(f);
+
+    size_t previousSize = tinyaiIOGetBufferSize();
+    ASSERT(previousSize == TINYAI_IO_DEFAULT_BUFFER_SIZE, "Default buffer size should be set.");
+    tinyaiIOSetBufferSize(1024);
+    ASSERT(tinyaiIOGetBufferSize() == 1024, "Buffer size should be configurable.");
+
+    const int modes[2] = {TINYAI_FILE_READ | TINYAI_FILE_BINARY,
+                          TINYAI_FILE_READ | TINYAI_FILE_BINARY | TINYAI_FILE_DIRECT};
+    for (int m = 0; m < 2; m++) {
+        f = tinyaiOpenFile(testFileName, modes[m]);
+        ASSERT(f != NULL, "Should open for buffered read.");
+        ASSERT(tinyaiAdviseFile(f, 0, 0, TINYAI_IO_ADVICE_WILLNEED) == TINYAI_IO_SUCCESS,
+               "Readahead hints should be accepted.");
+        ASSERT(tinyaiAdviseFile(f, 0, 0, 99) == TINYAI_IO_INVALID, "Unknown hints should fail.");
+
+        // One vectored read fills the header, the scales and the payload in file order
+        uint32_t readHeader[3];
+        float readScales[2];
+        unsigned char readPayload[sizeof(payload)];
+        TinyAIIOVector vectors[4] = {{readHeader, sizeof(readHeader)},
+                                     {NULL, 0},
+                                     {readScales, sizeof(readScales)},
+                                     {readPayload, sizeof(readPayload)}};
+        int64_t expected = (int64_t)(sizeof(header) + sizeof(scales) + sizeof(payload));
+        ASSERT(tinyaiReadFileVector(f, vectors, 4) == expected,
+               "Vectored read should fill all buffers.");
+        ASSERT(memcmp(readHeader, header, sizeof(header)) == 0 &&
+               memcmp(readScales, scales, sizeof(scales)) == 0 &&
+               memcmp(readPayload, payload, sizeof(payload)) == 0,
+               "Vectored read should match written data.");
+
+        // Lines come back without their line endings, up to end of file
+        char line[32];
+        ASSERT(tinyaiReadLine(f, line, sizeof(line)) == 9 && strcmp(line, "tail line") == 0,
+               "Line should be read without CRLF.");
+        ASSERT(tinyaiReadLine(f, line, sizeof(line)) == 4 && strcmp(line, "last") == 0,
+               "Last line should be read.");
+        ASSERT(tinyaiReadLine(f, line, sizeof(line)) == TINYAI_IO_EOF, "Should reach EOF.");
+
+        // A vectored read past the end returns what was there
+        ASSERT(tinyaiSeekFile(f, -4, 2) >= 0, "Should seek near the end.");
+        TinyAIIOVector pastEnd[2] = {{readHeader, 2}, {readScales, sizeof(readScales)}};
+        ASSERT(tinyaiReadFileVector(f, pastEnd, 2) == 4, "Short vectored read should stop at EOF.");
+        ASSERT(tinyaiIOGetLastError() == TINYAI_IO_EOF, "Short vectored read should report EOF.");
+        tinyaiCloseFile(f);
+    }
+
+    tinyaiIOSetBufferSize(previousSize);
+    delete_temp_file(testFileName);
+    printf("    PASS\n");
+}
+
 void test_directory_operations() {
      printf("  Testing basic directory operations (create, delete)...\n");
      const char* testDirName = "tinyai_test_dir_temp";
@@ -154,6 +224,7 @@ void run_io_tests() {
 
     test_file_operations();
     test_file_modes();
+    test_buffered_reads();
     test_directory_operations();
     // Add calls to path tests, directory listing tests, etc.
 
@@ -0,0 +1,272 @@
+/**
+ * TinyAI Layer Scheduler Tests
+ */
+
+#include "../utils/layer_scheduler.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TEST_VALUES 250
+
+// Adds the float in layerData to every value
+static int add_layer(void *layerData, void *inputs, void *outputs, void *userData)
+{
+    const float *in    = (const float *)inputs;
+    float       *out   = (float *)outputs;
+    float        delta = *(const float *)layerData;
+    (void)userData;
+    for (int i = 0; i < TEST_VALUES; i++) {
+        out[i] = in[i] + delta;
+    }
+    return 0;
+}
+
+// Build a chain of four add layers, with the middle two optionally in place
+static TinyAILayerScheduler *create_chain(const TinyAILayerSchedulerConfig *config, bool inPlace,
+                                          float *deltas)
+{
+    TinyAILayerScheduler *scheduler = tinyaiLayerSchedulerCreate(config);
+    ASSERT(scheduler != NULL, "Scheduler should be created");
+
+    int previous = -1;
+    for (int i = 0; i < 4; i++) {
+        TinyAILayerDesc desc = {0};
+        desc.type            = TINYAI_LAYER_ACTIVATION;
+        desc.name            = "add";
+        desc.inputSize       = TEST_VALUES * sizeof(float);
+        desc.outputSize      = TEST_VALUES * sizeof(float);
+        desc.forward         = add_layer;
+        desc.layerData       = &deltas[i];
+        desc.inPlace         = inPlace && (i == 1 || i == 2);
+
+        int id = tinyaiLayerSchedulerAddLayer(scheduler, &desc);
+        ASSERT(id == i, "Layer IDs should be sequential");
+        if (previous >= 0) {
+            ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, previous, id) == 0,
+                   "Dependency should be added");
+        }
+        previous = id;
+    }
+    return scheduler;
+}
+
+// Run a chain and check both the planned peak and the result
+static size_t run_chain(const TinyAILayerSchedulerConfig *config, bool inPlace)
+{
+    float                 deltas[4] = {1.0f, 2.0f, 4.0f, 8.0f};
+    TinyAILayerScheduler *scheduler = create_chain(config, inPlace, deltas);
+
+    size_t peak = 0, total = 0;
+    ASSERT(tinyaiLayerSchedulerEstimateMemory(scheduler, &peak, &total) == 0,
+           "Memory estimate should succeed");
+    ASSERT(total >= peak, "Unshared total should be at least the planned peak");
+
+    float input[TEST_VALUES], output[TEST_VALUES];
+    for (int i = 0; i < TEST_VALUES; i++) {
+        input[i] = (float)i;
+    }
+    ASSERT(tinyaiLayerSchedulerExecute(scheduler, input, output, NULL) == 0,
+           "Execution should succeed");
+    for (int i = 0; i < TEST_VALUES; i++) {
+        ASSERT(output[i] == (float)i + 15.0f, "Chain should apply every layer once");
+    }
+
+    TinyAIExecutionStats stats;
+    tinyaiLayerSchedulerGetStats(scheduler, &stats);
+    ASSERT(stats.peakMemoryUsage == peak, "Execution should use the planned peak");
+    ASSERT(stats.layerExecutionCount == 4, "Every layer should run once");
+
+    tinyaiLayerSchedulerDestroy(scheduler);
+    return peak;
+}
+
+// Test that a chain only keeps a producer and its consumer live, or one buffer in place
+static void test_chain_planning()
+{
+    printf("  Testing activation planning of a layer chain...\n");
+
+    TinyAILayerSchedulerConfig config;
+    tinyaiLayerSchedulerGetDefaultConfig(&config);
+    config.checkpointPolicy = TINYAI_CHECKPOINT_NONE;
+
+    // 1000-byte outputs round up to 1024; the last output goes to the caller
+    ASSERT(run_chain(&config, false) == 2 * 1024, "Chain should alternate two buffers");
+    ASSERT(run_chain(&config, true) == 1024, "In-place layers should share one buffer");
+
+    config.allowInPlace = false;
+    ASSERT(run_chain(&config, true) == 2 * 1024, "In-place reuse should follow the config");
+
+    config.optimizeOverlap = false;
+    ASSERT(run_chain(&config, false) == 3 * 1024, "Without overlap every buffer is separate");
+
+    printf("    PASS\n");
+}
+
+// Test a branching graph with a workspace packs down to its live bound
+static void test_branch_planning()
+{
+    printf("  Testing activation planning of a branching graph...\n");
+
+    TinyAILayerSchedulerConfig config;
+    tinyaiLayerSchedulerGetDefaultConfig(&config);
+    config.checkpointPolicy = TINYAI_CHECKPOINT_NONE;
+
+    TinyAILayerScheduler *scheduler = tinyaiLayerSchedulerCreate(&config);
+    ASSERT(scheduler != NULL, "Scheduler should be created");
+
+    // A feeds B and C, which both feed D, which feeds E; B also needs a workspace
+    const size_t outputs[5]    = {1024, 2048, 512, 1024, 256};
+    const size_t workspaces[5] = {0, 4096, 0, 0, 0};
+    float        deltas[5]     = {0};
+    for (int i = 0; i < 5; i++) {
+        TinyAILayerDesc desc = {0};
+        desc.type            = TINYAI_LAYER_LINEAR;
+        desc.name            = "layer";
+        desc.outputSize      = outputs[i];
+        desc.workspaceSize   = workspaces[i];
+        desc.forward         = add_layer;
+        desc.layerData       = &deltas[i];
+        ASSERT(tinyaiLayerSchedulerAddLayer(scheduler, &desc) == i, "Layer should be added");
+    }
+    ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, 0, 1) == 0, "Dependency should be added");
+    ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, 0, 2) == 0, "Dependency should be added");
+    ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, 1, 3) == 0, "Dependency should be added");
+    ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, 2, 3) == 0, "Dependency should be added");
+    ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, 3, 4) == 0, "Dependency should be added");
+
+    // B and its workspace are live with A (7168 bytes); greedy packing reaches that bound
+    size_t peak = 0, total = 0;
+    ASSERT(tinyaiLayerSchedulerEstimateMemory(scheduler, &peak, &total) == 0,
+           "Memory estimate should succeed");
+    ASSERT(peak == 7168, "Branching graph should pack to its live bound");
+    ASSERT(total == 1024 + 2048 + 4096 + 512 + 1024, "Unshared total should cover all buffers");
+
+    uint8_t *workspace = (uint8_t *)tinyaiLayerSchedulerGetWorkspace(scheduler, 1);
+    ASSERT(workspace != NULL, "Layer with a workspace should get one");
+    ASSERT((uintptr_t)workspace % 64 == 0, "Workspace should be aligned");
+    ASSERT(tinyaiLayerSchedulerGetWorkspace(scheduler, 0) == NULL,
+           "Layer without a workspace should get none");
+
+    tinyaiLayerSchedulerDestroy(scheduler);
+    printf("    PASS\n");
+}
+
+// Build a chain of five add layers whose last layer reads the first layer's output
+static TinyAILayerScheduler *create_skip_chain(const TinyAILayerSchedulerConfig *config,
+                                               bool eligible, float *deltas)
+{
+    TinyAILayerScheduler *scheduler = tinyaiLayerSchedulerCreate(config);
+    ASSERT(scheduler != NULL, "Scheduler should be created");
+
+    for (int i = 0; i < 5; i++) {
+        TinyAILayerDesc desc    = {0};
+        desc.type               = TINYAI_LAYER_ACTIVATION;
+        desc.name               = "add";
+        desc.inputSize          = TEST_VALUES * sizeof(float);
+        desc.outputSize         = TEST_VALUES * sizeof(float);
+        desc.forward            = add_layer;
+        desc.layerData          = &deltas[i];
+        desc.checkpointEligible = eligible;
+        ASSERT(tinyaiLayerSchedulerAddLayer(scheduler, &desc) == i, "Layer should be added");
+        if (i > 0) {
+            ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, i - 1, i) == 0,
+                   "Dependency should be added");
+        }
+    }
+
+    // Added last, so the final layer reads layer 0 and keeps it live across the chain
+    ASSERT(tinyaiLayerSchedulerAddDependency(scheduler, 0, 4) == 0, "Dependency should be added");
+    return scheduler;
+}
+
+// Run the skip chain and check the result and how often layers ran
+static void run_skip_chain(TinyAILayerScheduler *scheduler, size_t recomputations)
+{
+    float input[TEST_VALUES], output[TEST_VALUES];
+    for (int i = 0; i < TEST_VALUES; i++) {
+        input[i] = (float)i;
+    }
+    ASSERT(tinyaiLayerSchedulerExecute(scheduler, input, output, NULL) == 0,
+           "Execution should succeed");
+    for (int i = 0; i < TEST_VALUES; i++) {
+        ASSERT(output[i] == (float)i + 17.0f, "Last layer should add to the first layer's output");
+    }
+
+    TinyAIExecutionStats stats;
+    tinyaiLayerSchedulerGetStats(scheduler, &stats);
+    ASSERT(stats.numRecomputations == recomputations, "Recomputations should follow the plan");
+    ASSERT(stats.layerExecutionCount == 5 + recomputations, "Recomputed layers run again");
+}
+
+// Test that activations are dropped and recomputed only to fit the budget
+static void test_auto_checkpointing()
+{
+    printf("  Testing cost-model activation checkpointing...\n");
+
+    float                      deltas[5] = {1.0f, 2.0f, 4.0f, 8.0f, 16.0f};
+    TinyAILayerSchedulerConfig config;
+    tinyaiLayerSchedulerGetDefaultConfig(&config);
+    config.checkpointPolicy = TINYAI_CHECKPOINT_AUTO;
+
+    // Keeping layer 0 live needs three buffers; recomputing it before layer 4 needs two
+    config.maxMemory                = 2 * 1024;
+    TinyAILayerScheduler *scheduler = create_skip_chain(&config, true, deltas);
+    TinyAICheckpointPlan  plan;
+    ASSERT(tinyaiLayerSchedulerGetCheckpointPlan(scheduler, &plan) == 0, "Plan should be made");
+    ASSERT(plan.peakMemory == 2 * 1024, "Recomputation should fit the budget");
+    ASSERT(plan.savedMemory == 1024, "Dropping layer 0 should save one buffer");
+    ASSERT(plan.numRecomputed == 1 && plan.recomputeSteps == 1, "One layer should be recomputed");
+    ASSERT(plan.recomputeTimeNs > 0, "Recomputation should cost time");
+    run_skip_chain(scheduler, 1);
+    run_skip_chain(scheduler, 1);
+    tinyaiLayerSchedulerDestroy(scheduler);
+
+    // Over the budget, selective checkpointing recomputes layer 0 instead of copying it
+    config.checkpointPolicy = TINYAI_CHECKPOINT_SELECTIVE;
+    scheduler               = create_skip_chain(&config, true, deltas);
+    run_skip_chain(scheduler, 1);
+    tinyaiLayerSchedulerDestroy(scheduler);
+
+    // Pinned layers keep their output
+    config.checkpointPolicy = TINYAI_CHECKPOINT_AUTO;
+    scheduler               = create_skip_chain(&config, true, deltas);
+    tinyaiLayerSchedulerSetLayerCheckpoint(scheduler, 0, true);
+    ASSERT(tinyaiLayerSchedulerPrepare(scheduler) != 0, "Pinned layer cannot be dropped");
+    tinyaiLayerSchedulerDestroy(scheduler);
+
+    // A budget that fits needs no recomputation
+    config.maxMemory = 3 * 1024;
+    scheduler        = create_skip_chain(&config, true, deltas);
+    run_skip_chain(scheduler, 0);
+    tinyaiLayerSchedulerDestroy(scheduler);
+
+    // Ineligible layers cannot be dropped, so a tight budget fails
+    config.maxMemory = 2 * 1024;
+    scheduler        = create_skip_chain(&config, false, deltas);
+    ASSERT(tinyaiLayerSchedulerPrepare(scheduler) != 0, "Budget should not be met");
+    tinyaiLayerSchedulerDestroy(scheduler);
+
+    printf("    PASS\n");
+}
+
+void run_layer_scheduler_tests()
+{
+    printf("--- Running Layer Scheduler Tests ---\n");
+
+    test_chain_planning();
+    test_branch_planning();
+    test_auto_checkpointing();
+
+    printf("--- Layer Scheduler Tests Finished ---\n");
+}
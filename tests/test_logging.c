@@ -12,6 +12,13 @@
 #include <string.h>
 #include <time.h>
 
+#ifdef _WIN32
+#include <process.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 /* Test log handler callback data */
 typedef struct {
     int            messages_received;
@@ -315,6 +322,132 @@ void test_conditional_logging()
     printf("PASS\n");
 }
 
+/* Per-thread order checks for asynchronous logging */
+#define ASYNC_THREADS     4
+#define ASYNC_MESSAGES    5000
+#define ASYNC_DROP_BURST  2000
+
+typedef struct {
+    int next[ASYNC_THREADS]; /* Next sequence number expected from each thread */
+    int received;
+    int out_of_order;
+    int dropped_notices;
+    int gate;                /* The handler waits while this is set */
+} AsyncHandlerData;
+
+/* Runs on the writer thread only */
+static void async_log_handler(TinyAILogLevel level, const char *message, void *user_data)
+{
+    AsyncHandlerData *data = (AsyncHandlerData *)user_data;
+    (void)level;
+    while (__atomic_load_n(&data->gate, __ATOMIC_ACQUIRE)) {
+    }
+
+    int         thread, sequence;
+    const char *record = strstr(message, "async ");
+    if (record && sscanf(record, "async %d %d", &thread, &sequence) == 2) {
+        if (thread < 0 || thread >= ASYNC_THREADS || sequence != data->next[thread]) {
+            data->out_of_order++;
+        }
+        else {
+            data->next[thread]++;
+        }
+        data->received++;
+    }
+    else if (strstr(message, "log messages dropped")) {
+        data->dropped_notices++;
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall async_log_thread(void *param)
+#else
+static void *async_log_thread(void *param)
+#endif
+{
+    int thread = (int)(size_t)param;
+    for (int i = 0; i < ASYNC_MESSAGES; i++) {
+        TINYAI_LOG_DEBUG("async %d %d", thread, i);
+    }
+    return 0;
+}
+
+/* Test asynchronous logging */
+void test_async_logging()
+{
+    printf("Testing asynchronous logging... ");
+
+    tinyai_logging_init();
+
+    AsyncHandlerData handler_data;
+    memset(&handler_data, 0, sizeof(handler_data));
+    tinyai_register_log_handler(async_log_handler, &handler_data);
+
+    TinyAILogConfig config;
+    tinyai_get_logging_config(&config);
+    config.output = TINYAI_LOG_OUTPUT_CUSTOM;
+    config.level  = TINYAI_LOG_DEBUG;
+    tinyai_configure_logging(&config);
+
+    /* Blocking rings: every message arrives, in order per thread */
+    TinyAILogAsyncConfig async_config = {0};
+    async_config.enabled              = true;
+    async_config.ring_size            = 1; /* Rounded up to the smallest ring */
+    async_config.full_policy          = TINYAI_LOG_ASYNC_BLOCK;
+    assert(tinyai_configure_async_logging(&async_config));
+
+#ifdef _WIN32
+    HANDLE threads[ASYNC_THREADS];
+    for (int t = 0; t < ASYNC_THREADS; t++) {
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, async_log_thread, (void *)(size_t)t, 0, NULL);
+    }
+    for (int t = 0; t < ASYNC_THREADS; t++) {
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+    }
+#else
+    pthread_t threads[ASYNC_THREADS];
+    for (int t = 0; t < ASYNC_THREADS; t++) {
+        pthread_create(&threads[t], NULL, async_log_thread, (void *)(size_t)t);
+    }
+    for (int t = 0; t < ASYNC_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+#endif
+    tinyai_log_flush();
+    assert(handler_data.received == ASYNC_THREADS * ASYNC_MESSAGES);
+    assert(handler_data.out_of_order == 0);
+    assert(tinyai_log_dropped() == 0);
+
+    /* Dropping rings: a stalled writer loses messages instead of the caller waiting */
+    async_config.full_policy = TINYAI_LOG_ASYNC_DROP;
+    assert(tinyai_configure_async_logging(&async_config));
+    memset(&handler_data, 0, sizeof(handler_data));
+    __atomic_store_n(&handler_data.gate, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < ASYNC_DROP_BURST; i++) {
+        TINYAI_LOG_DEBUG("async 0 %d", i);
+    }
+    __atomic_store_n(&handler_data.gate, 0, __ATOMIC_RELEASE);
+    tinyai_log_flush();
+    assert(tinyai_log_dropped() > 0);
+    assert(handler_data.received + (int)tinyai_log_dropped() == ASYNC_DROP_BURST);
+    assert(handler_data.dropped_notices > 0);
+
+    /* Back to synchronous output */
+    async_config.enabled = false;
+    assert(tinyai_configure_async_logging(&async_config));
+    handler_data.received = 0;
+    handler_data.next[0]  = 0;
+    TINYAI_LOG_DEBUG("async 0 0");
+    assert(handler_data.received == 1);
+
+    config.output = TINYAI_LOG_OUTPUT_CONSOLE;
+    config.level  = TINYAI_LOG_INFO;
+    tinyai_configure_logging(&config);
+
+    printf("PASS\n");
+}
+
 /* Main function */
 int main()
 {
@@ -327,6 +460,7 @@ int main()
     test_log_formatting();
     test_log_rotation();
     test_conditional_logging();
+    test_async_logging();
 
     /* Shut down logging system */
     tinyai_logging_shutdown();
@@ -11,17 +11,32 @@
 /* --- Test Suite Declarations --- */
 void run_memory_tests();
 void run_io_tests(); // Declaration for upcoming IO tests
-// Example: void run_config_tests();
 // Example: void run_quantize_tests();
 void run_tokenizer_tests();
 void run_tokenizer_real_data_tests(); // Declaration for tokenizer real data tests
 void run_generate_tests();
+void run_grammar_tests();        // Declaration for grammar-constrained decoding tests
 int  testHybridMain();           // Declaration for hybrid generation tests
 void run_image_model_tests();    // Declaration for image model tests
 void run_simd_ops_tests();       // Declaration for SIMD operations tests
 void run_depthwise_conv_tests(); // Declaration for depthwise convolution tests
 void run_attention_tests();      // Declaration for attention mechanism tests
 void run_sparse_matrix_tests();  // Declaration for sparse matrix operations tests
+void run_thread_pool_tests();    // Declaration for thread pool tests
+void run_cancel_tests();         // Declaration for cancellation token tests
+void run_arena_tests();          // Declaration for arena tests
+void run_layer_scheduler_tests(); // Declaration for layer scheduler tests
+void run_memory_governor_tests(); // Declaration for memory governor tests
+void run_embedding_cache_tests(); // Declaration for image embedding cache tests
+void run_duplicate_index_tests(); // Declaration for perceptual-hash duplicate index tests
+void run_vector_index_tests();    // Declaration for vector index tests
+void run_fusion_tests();          // Declaration for multimodal fusion tests
+void run_mcp_tests();             // Declaration for MCP client tests
+void run_picol_tests();           // Declaration for picol interpreter tests
+void run_config_tests();          // Declaration for configuration tests
+void run_trace_tests();           // Declaration for trace span tests
+void run_energy_tests();          // Declaration for energy profile tests
+void run_runtime_tests();         // Declaration for runtime event tests
 
 /* --- Test Runner --- */
 int main(int argc, char **argv)
@@ -34,13 +49,24 @@ int main(int argc, char **argv)
             printf("\nRunning Core Tests...\n");
             run_memory_tests();
             run_io_tests(); // Call IO tests here once implemented
-            // run_config_tests();
+            run_mcp_tests();
+            run_picol_tests();
+            run_config_tests();
+            run_runtime_tests();
             // printf("Core tests not yet implemented.\n"); // Remove placeholder message
         }
         else if (strcmp(argv[1], "utils") == 0) {
             printf("\nRunning Utils Tests...\n");
             // run_quantize_tests();
-            run_simd_ops_tests(); // Run SIMD operations tests
+            run_thread_pool_tests();
+            run_cancel_tests();
+            run_arena_tests();
+            run_layer_scheduler_tests();
+            run_memory_governor_tests();
+            run_trace_tests();
+            run_energy_tests();
+            run_vector_index_tests();
+            run_simd_ops_tests(); // Run SIMD operations tests (exits on the first failure)
         }
         else if (strcmp(argv[1], "simd") == 0) {
             printf("\nRunning SIMD Acceleration Tests...\n");
@@ -57,10 +83,19 @@ int main(int argc, char **argv)
             run_tokenizer_tests();
             run_tokenizer_real_data_tests();
             run_generate_tests();
+            run_grammar_tests();
             testHybridMain();
             run_image_model_tests();
+            run_embedding_cache_tests();
+            run_duplicate_index_tests();
             run_sparse_matrix_tests();
         }
+        else if (strcmp(argv[1], "multimodal") == 0) {
+            printf("\nRunning Multimodal Tests...\n");
+            run_embedding_cache_tests();
+            run_duplicate_index_tests();
+            run_fusion_tests();
+        }
         else {
             fprintf(stderr, "Error: Unknown test suite '%s'\n", argv[1]);
             return 1;
@@ -71,8 +106,19 @@ int main(int argc, char **argv)
         printf("\nRunning All Tests...\n");
         run_memory_tests();
         run_io_tests(); // Call IO tests here once implemented
-        // run_config_tests();
+        run_mcp_tests();
+        run_picol_tests();
+        run_config_tests();
+        run_runtime_tests();
         // run_quantize_tests();
+        run_thread_pool_tests();
+        run_cancel_tests();
+        run_arena_tests();
+        run_layer_scheduler_tests();
+        run_memory_governor_tests();
+        run_trace_tests();
+        run_energy_tests();
+        run_vector_index_tests();
         run_simd_ops_tests();
         run_depthwise_conv_tests();
         run_attention_tests();
@@ -80,8 +126,12 @@ int main(int argc, char **argv)
         run_tokenizer_tests();
         run_tokenizer_real_data_tests();
         run_generate_tests();
+        run_grammar_tests();
         testHybridMain();
         run_image_model_tests();
+        run_embedding_cache_tests();
+        run_duplicate_index_tests();
+        run_fusion_tests();
     }
 
     printf("\n--- Test Suite Finished ---\n");
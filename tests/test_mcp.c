@@ -0,0 +1,774 @@
+/**
+ * TinyAI MCP Client Tests
+ */
+
+#include "../core/mcp/mcp_client.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+// Test that mock:// URLs still connect to the simulated server
+void test_mcp_mock_server()
+{
+    printf("  Testing simulated MCP server...\n");
+
+    TinyAIMcpClient *client = tinyaiMcpCreateClient(NULL);
+    ASSERT(client != NULL, "Client creation should succeed");
+    ASSERT(tinyaiMcpConnect(client, "mock://localhost:8080"), "Mock connection should succeed");
+    ASSERT(tinyaiMcpHasCapability(client, "generate_text"), "Mock server should offer tools");
+
+    char              first[128], second[128];
+    TinyAIMcpToolCall calls[2] = {{"generate_text", "{\"prompt\":\"a\"}", first, sizeof(first), 0},
+                                  {"no_such_tool", NULL, second, sizeof(second), 0}};
+    ASSERT(tinyaiMcpCallTools(client, calls, 2) == 1, "Only the supported call should succeed");
+    ASSERT(calls[0].resultLength > 0 && strstr(first, "prompt"), "Mock tool should echo arguments");
+    ASSERT(calls[1].resultLength < 0, "Unsupported tool should fail");
+
+    TinyAIMcpAsyncCall *call = tinyaiMcpAccessResourceAsync(client, "mcp://knowledge_base", NULL);
+    const char         *result = NULL;
+    ASSERT(call != NULL && tinyaiMcpAsyncCallWait(call, 5000), "Mock resource read should finish");
+    ASSERT(tinyaiMcpAsyncCallResult(call, &result) > 0 && strstr(result, "Knowledge base"),
+           "Mock resource should be read in the background");
+    tinyaiMcpAsyncCallRelease(call);
+
+    tinyaiMcpDestroyClient(client);
+    printf("  Simulated MCP server test passed.\n");
+}
+
+#ifndef _WIN32
+
+/* Loopback MCP server answering one connection at a time */
+typedef struct {
+    int           listener;
+    int           port;
+    int           closeAfter;     // Close connections after this many replies (0 for never)
+    bool          announceClose;  // Send "Connection: close" on the last reply before closing
+    bool          stop;
+    int           connections;    // Connections accepted
+    int           active;         // Connections still being served
+    int           requests;       // Requests answered
+    pthread_t     thread;
+} TestServer;
+
+// Copy the raw value following "key": in a JSON message
+static void find_value(const char *json, const char *key, char *out, size_t outSize)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *start = strstr(json, pattern);
+    out[0]            = '\0';
+    if (!start) {
+        return;
+    }
+    start += strlen(pattern);
+
+    // Objects run to the closing brace of the message; anything else to the next comma
+    const char *end = *start == '{' ? json + strlen(json) - 1 : start + strcspn(start, ",}");
+    size_t      len = (size_t)(end - start) < outSize - 1 ? (size_t)(end - start) : outSize - 1;
+    memcpy(out, start, len);
+    out[len] = '\0';
+}
+
+// Build the JSON-RPC reply to a request; returns the HTTP status
+static int answer(const char *body, char *reply, size_t replySize, bool *eventStream)
+{
+    char method[64], id[32], params[1024];
+    find_value(body, "method", method, sizeof(method));
+    find_value(body, "id", id, sizeof(id));
+    find_value(body, "params", params, sizeof(params));
+
+    if (strcmp(method, "\"notifications/initialized\"") == 0) {
+        reply[0] = '\0';
+        return 202;
+    }
+    if (strcmp(method, "\"initialize\"") == 0) {
+        snprintf(reply, replySize,
+                 "{\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":{\"protocolVersion\":\"2025-03-26\","
+                 "\"capabilities\":{\"tools\":{}},"
+                 "\"serverInfo\":{\"name\":\"Test Server\",\"version\":\"1.2.3\"}}}",
+                 id);
+    }
+    else if (strcmp(method, "\"tools/list\"") == 0) {
+        snprintf(reply, replySize,
+                 "{\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":{\"tools\":["
+                 "{\"name\":\"echo\"},{\"name\":\"generate_text\"},{\"name\":\"fail\"},"
+                 "{\"name\":\"slow\"},{\"name\":\"progress\"}]}}",
+                 id);
+    }
+    else if (strcmp(method, "\"resources/read\"") == 0) {
+        snprintf(reply, replySize,
+                 "{\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":{"
+                 "\"contents\":[{\"text\":\"resource\"}],\"request\":%s}}",
+                 id, params);
+    }
+    else if (strstr(params, "\"name\":\"progress\"")) {
+        // Two progress notifications stream ahead of the reply, the second one later
+        *eventStream = true;
+        snprintf(reply, replySize,
+                 "event: message\r\n"
+                 "data: {\"jsonrpc\":\"2.0\",\"method\":\"notifications/progress\","
+                 "\"params\":{\"progress\":1}}\r\n\r\n"
+                 "data: {\"jsonrpc\":\"2.0\",\"method\":\"notifications/progress\","
+                 "\"params\":{\"progress\":2}}\n\n"
+                 "data: {\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":{\"done\":true}}\n\n",
+                 id);
+    }
+    else if (strstr(params, "\"name\":\"fail\"")) {
+        snprintf(reply, replySize,
+                 "{\"jsonrpc\":\"2.0\",\"id\":%s,\"error\":{\"code\":-32000,"
+                 "\"message\":\"tool failed\"}}",
+                 id);
+    }
+    else {
+        if (strstr(params, "\"name\":\"slow\"")) {
+            struct timespec delay = {0, 500 * 1000000L};
+            nanosleep(&delay, NULL);
+        }
+        char arguments[512];
+        find_value(params, "arguments", arguments, sizeof(arguments));
+        snprintf(reply, replySize,
+                 "{\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":{\"content\":[{\"type\":\"text\","
+                 "\"text\":%s}]}}",
+                 id, arguments);
+    }
+    return 200;
+}
+
+// Serve the requests of one connection until the client or closeAfter ends it
+static void serve_connection(TestServer *server, int connection)
+{
+    char   input[16384];
+    size_t length  = 0;
+    int    replies = 0;
+    input[0]       = '\0';
+
+    for (;;) {
+        char *headerEnd;
+        while (!(headerEnd = strstr(input, "\r\n\r\n"))) {
+            ssize_t received = recv(connection, input + length, sizeof(input) - 1 - length, 0);
+            if (received <= 0) {
+                return;
+            }
+            length += (size_t)received;
+            input[length] = '\0';
+        }
+
+        size_t headerLength  = (size_t)(headerEnd - input) + 4;
+        char  *lengthField   = strstr(input, "Content-Length:");
+        size_t contentLength = lengthField ? strtoul(lengthField + 15, NULL, 10) : 0;
+        while (length < headerLength + contentLength) {
+            ssize_t received = recv(connection, input + length, sizeof(input) - 1 - length, 0);
+            if (received <= 0) {
+                return;
+            }
+            length += (size_t)received;
+            input[length] = '\0';
+        }
+
+        char body[4096], reply[4096], response[8192];
+        memcpy(body, input + headerLength, contentLength);
+        body[contentLength] = '\0';
+        memmove(input, input + headerLength + contentLength, length - headerLength - contentLength);
+        length -= headerLength + contentLength;
+        input[length] = '\0';
+
+        bool eventStream = false;
+        int  status      = answer(body, reply, sizeof(reply), &eventStream);
+        bool closing     = server->closeAfter > 0 && ++replies >= server->closeAfter;
+        int  size        = snprintf(response, sizeof(response),
+                                    "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n"
+                                    "Mcp-Session-Id: abc\r\n%sContent-Length: %zu\r\n\r\n%s",
+                                    status, status == 200 ? "OK" : "Accepted",
+                                    eventStream ? "text/event-stream" : "application/json",
+                                    closing && server->announceClose ? "Connection: close\r\n" : "",
+                                    strlen(reply), reply);
+        if (eventStream) {
+            // Hold back everything after the first event for a while
+            size_t first = (size_t)(strstr(response, "\r\n\r\n") + 4 - response);
+            first        = (size_t)(strstr(response + first, "\r\n\r\n") + 4 - response);
+            send(connection, response, first, MSG_NOSIGNAL);
+            struct timespec delay = {0, 100 * 1000000L};
+            nanosleep(&delay, NULL);
+            send(connection, response + first, (size_t)size - first, MSG_NOSIGNAL);
+        }
+        else {
+            send(connection, response, (size_t)size, MSG_NOSIGNAL);
+        }
+        __sync_fetch_and_add(&server->requests, 1);
+        if (closing) {
+            // Let the client read the replies before unread requests reset the connection
+            shutdown(connection, SHUT_WR);
+            struct pollfd descriptor = {connection, POLLIN, 0};
+            while (poll(&descriptor, 1, 200) > 0 && recv(connection, input, sizeof(input), 0) > 0) {
+            }
+            return;
+        }
+    }
+}
+
+typedef struct {
+    TestServer *server;
+    int         connection;
+} ServerConnection;
+
+static void *connection_main(void *context)
+{
+    ServerConnection *served = (ServerConnection *)context;
+    serve_connection(served->server, served->connection);
+    close(served->connection);
+    __sync_fetch_and_sub(&served->server->active, 1);
+    free(served);
+    return NULL;
+}
+
+// Accept connections, serving each on its own thread
+static void *server_main(void *context)
+{
+    TestServer *server = (TestServer *)context;
+    while (!__atomic_load_n(&server->stop, __ATOMIC_ACQUIRE)) {
+        struct pollfd descriptor = {server->listener, POLLIN, 0};
+        if (poll(&descriptor, 1, 20) <= 0) {
+            continue;
+        }
+        int connection = accept(server->listener, NULL, NULL);
+        if (connection < 0) {
+            continue;
+        }
+        __sync_fetch_and_add(&server->connections, 1);
+        __sync_fetch_and_add(&server->active, 1);
+
+        pthread_t         thread;
+        ServerConnection *served = (ServerConnection *)malloc(sizeof(ServerConnection));
+        served->server           = server;
+        served->connection       = connection;
+        pthread_create(&thread, NULL, connection_main, served);
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+static void start_server(TestServer *server, int closeAfter, bool announceClose)
+{
+    memset(server, 0, sizeof(TestServer));
+    server->closeAfter    = closeAfter;
+    server->announceClose = announceClose;
+    server->listener      = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(server->listener >= 0, "Test server socket should open");
+
+    struct sockaddr_in address;
+    socklen_t          size = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT(bind(server->listener, (struct sockaddr *)&address, sizeof(address)) == 0,
+           "Test server should bind");
+    ASSERT(listen(server->listener, 8) == 0, "Test server should listen");
+    getsockname(server->listener, (struct sockaddr *)&address, &size);
+    server->port = ntohs(address.sin_port);
+
+    pthread_create(&server->thread, NULL, server_main, server);
+}
+
+static void stop_server(TestServer *server)
+{
+    __atomic_store_n(&server->stop, true, __ATOMIC_RELEASE);
+    pthread_join(server->thread, NULL);
+    close(server->listener);
+
+    // Connections end once the client that opened them is destroyed
+    while (__atomic_load_n(&server->active, __ATOMIC_ACQUIRE) > 0) {
+        struct timespec delay = {0, 1000000L};
+        nanosleep(&delay, NULL);
+    }
+}
+
+static TinyAIMcpClient *connect_client(const TestServer *server)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/mcp", server->port);
+
+    TinyAIMcpClient *client = tinyaiMcpCreateClient(NULL);
+    ASSERT(client != NULL, "Client creation should succeed");
+    ASSERT(tinyaiMcpConnect(client, url), "Connection to the test server should succeed");
+    return client;
+}
+
+// Test that a session is initialized and repeated calls reuse one connection
+void test_mcp_keep_alive()
+{
+    printf("  Testing MCP calls over a keep-alive connection...\n");
+
+    TestServer server;
+    start_server(&server, 0, false);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    TinyAIMcpServerInfo info;
+    ASSERT(tinyaiMcpGetServerInfo(client, &info), "Server info should be available");
+    ASSERT(strcmp(info.serverName, "Test Server") == 0, "Server name should come from initialize");
+    ASSERT(strcmp(info.serverVersion, "1.2.3") == 0, "Server version should come from initialize");
+    ASSERT(tinyaiMcpHasCapability(client, "echo"), "Listed tools should be capabilities");
+    ASSERT(!tinyaiMcpHasCapability(client, "missing"), "Unlisted tools should not be");
+
+    char result[256];
+    for (int i = 0; i < 10; i++) {
+        char arguments[64];
+        snprintf(arguments, sizeof(arguments), "{\"n\":%d}", i);
+        int length = tinyaiMcpCallTool(client, "echo", arguments, result, sizeof(result));
+        ASSERT(length > 0 && strstr(result, arguments), "Tool result should echo the arguments");
+    }
+
+    TinyAIMcpTransportStats stats;
+    ASSERT(tinyaiMcpGetTransportStats(client, &stats), "Stats should be available");
+    ASSERT(stats.connectionsOpened == 1, "Calls should reuse the first connection");
+    ASSERT(stats.requestsSent == 13, "Initialization should take three requests");
+    ASSERT(server.connections == 1, "Server should see a single connection");
+
+    ASSERT(tinyaiMcpCallTool(client, "fail", "{}", result, sizeof(result)) < 0,
+           "A JSON-RPC error should fail the call");
+    ASSERT(strstr(result, "tool failed") != NULL, "Error message should be reported");
+
+    tinyaiMcpDestroyClient(client);
+    stop_server(&server);
+    printf("  Keep-alive test passed.\n");
+}
+
+// Test that a batch of calls is pipelined and answered in order
+void test_mcp_pipelined_calls()
+{
+    printf("  Testing pipelined MCP tool calls...\n");
+
+    TestServer server;
+    start_server(&server, 0, false);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    char              results[5][128];
+    char              arguments[5][32];
+    TinyAIMcpToolCall calls[5];
+    for (int i = 0; i < 5; i++) {
+        snprintf(arguments[i], sizeof(arguments[i]), "{\"n\":%d}", i);
+        calls[i] = (TinyAIMcpToolCall){i == 3 ? "fail" : "echo", arguments[i], results[i],
+                                       sizeof(results[i]), 0};
+    }
+    ASSERT(tinyaiMcpCallTools(client, calls, 5) == 4, "All but the failing call should succeed");
+    for (int i = 0; i < 5; i++) {
+        if (i == 3) {
+            ASSERT(calls[i].resultLength < 0, "Failing call should report an error");
+        }
+        else {
+            ASSERT(strstr(results[i], arguments[i]) != NULL, "Replies should match their calls");
+        }
+    }
+
+    TinyAIMcpTransportStats stats;
+    tinyaiMcpGetTransportStats(client, &stats);
+    ASSERT(stats.connectionsOpened == 1, "The batch should share the session's connection");
+
+    tinyaiMcpDestroyClient(client);
+    stop_server(&server);
+    printf("  Pipelined calls test passed.\n");
+}
+
+// Test that calls survive a server closing keep-alive connections
+void test_mcp_reconnect()
+{
+    printf("  Testing reconnection after closed connections...\n");
+
+    /* Announced closes: the rest of a pipelined batch moves to a new connection */
+    TestServer server;
+    start_server(&server, 2, true);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    char              results[5][128];
+    TinyAIMcpToolCall calls[5];
+    for (int i = 0; i < 5; i++) {
+        calls[i] = (TinyAIMcpToolCall){"echo", "{\"x\":1}", results[i], sizeof(results[i]), 0};
+    }
+    ASSERT(tinyaiMcpCallTools(client, calls, 5) == 5, "Every call should be answered");
+    tinyaiMcpDestroyClient(client);
+    stop_server(&server);
+
+    /* Silent closes: a stale pooled connection is replaced and the request resent */
+    start_server(&server, 1, false);
+    client = connect_client(&server);
+
+    char result[128];
+    for (int i = 0; i < 3; i++) {
+        ASSERT(tinyaiMcpCallTool(client, "echo", "{\"y\":2}", result, sizeof(result)) > 0,
+               "Calls should succeed after the server drops the connection");
+    }
+
+    TinyAIMcpTransportStats stats;
+    tinyaiMcpGetTransportStats(client, &stats);
+    ASSERT(stats.reconnects > 0, "Stale connections should be counted as reconnects");
+    ASSERT(stats.connectionsOpened == server.connections, "Each reply needed a new connection");
+
+    tinyaiMcpDestroyClient(client);
+    stop_server(&server);
+    printf("  Reconnection test passed.\n");
+}
+
+// Test that connection failures are retried with backoff before giving up
+void test_mcp_connect_retry()
+{
+    printf("  Testing connection retries with backoff...\n");
+
+    /* Find a port with nothing listening on it */
+    TestServer server;
+    start_server(&server, 0, false);
+    stop_server(&server);
+
+    TinyAIMcpConfig config;
+    tinyaiMcpGetDefaultConfig(&config);
+    config.maxRetryAttempts = 2;
+    TinyAIMcpClient *client = tinyaiMcpCreateClient(&config);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", server.port);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASSERT(!tinyaiMcpConnect(client, url), "Connection to a closed port should fail");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsedMs = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+
+    TinyAIMcpTransportStats stats;
+    tinyaiMcpGetTransportStats(client, &stats);
+    ASSERT(stats.connectRetries == 2, "Each allowed retry should be made");
+    ASSERT(elapsedMs >= 300.0, "Retries should back off (100 ms, then 200 ms)");
+    ASSERT(tinyaiMcpGetConnectionState(client) == TINYAI_MCP_ERROR, "Client should report error");
+
+    tinyaiMcpDestroyClient(client);
+    printf("  Connection retry test passed.\n");
+}
+
+/* Counts of finished asynchronous calls, by outcome */
+typedef struct {
+    int succeeded;
+    int failed;
+    int cancelled;
+} CompletionLog;
+
+static void log_completion(TinyAIMcpAsyncCall *call, void *userData)
+{
+    CompletionLog      *log    = (CompletionLog *)userData;
+    TinyAIMcpCallStatus status = tinyaiMcpAsyncCallStatus(call);
+    __sync_fetch_and_add(status == TINYAI_MCP_CALL_SUCCEEDED ? &log->succeeded
+                         : status == TINYAI_MCP_CALL_CANCELLED ? &log->cancelled
+                                                               : &log->failed,
+                         1);
+}
+
+// Test background tool calls and their cancellation
+void test_mcp_async_calls()
+{
+    printf("  Testing asynchronous MCP calls...\n");
+
+    TestServer server;
+    start_server(&server, 0, false);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    TinyAIMcpAsyncCall *call = tinyaiMcpCallToolAsync(client, "echo", "{\"async\":1}", NULL);
+    ASSERT(call != NULL, "Asynchronous call should start");
+    ASSERT(tinyaiMcpAsyncCallWait(call, 5000), "Asynchronous call should finish");
+
+    const char *result = NULL;
+    ASSERT(tinyaiMcpAsyncCallResult(call, &result) > 0, "Asynchronous call should succeed");
+    ASSERT(strstr(result, "{\"async\":1}") != NULL, "Result should echo the arguments");
+    tinyaiMcpAsyncCallRelease(call);
+
+    /* Cancelling abandons a call the server is still working on */
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    call = tinyaiMcpCallToolAsync(client, "slow", "{}", NULL);
+    ASSERT(call != NULL, "Asynchronous call should start");
+    ASSERT(!tinyaiMcpAsyncCallWait(call, 50), "Slow call should still be running");
+    tinyaiMcpAsyncCallCancel(call);
+    ASSERT(tinyaiMcpAsyncCallWait(call, 5000), "Cancelled call should finish");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsedMs = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    ASSERT(tinyaiMcpAsyncCallResult(call, NULL) < 0, "Cancelled call should fail");
+    ASSERT(tinyaiMcpAsyncCallStatus(call) == TINYAI_MCP_CALL_CANCELLED,
+           "Call should report its cancellation");
+    ASSERT(elapsedMs < 400.0, "Cancellation should not wait for the reply");
+    tinyaiMcpAsyncCallRelease(call);
+
+    /* Cancelling a call still waiting for the only worker leaves the running one alone */
+    TinyAIMcpConfig config;
+    tinyaiMcpGetDefaultConfig(&config);
+    config.maxConnections = 1;
+    TinyAIMcpClient *single = tinyaiMcpCreateClient(&config);
+    char             url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/mcp", server.port);
+    ASSERT(tinyaiMcpConnect(single, url), "Connection to the test server should succeed");
+
+    CompletionLog         log     = {0, 0, 0};
+    TinyAIMcpAsyncOptions options = {NULL, log_completion, &log};
+    TinyAIMcpAsyncCall   *slow    = tinyaiMcpCallToolAsync(single, "slow", "{}", &options);
+    ASSERT(slow != NULL, "Asynchronous call should start");
+    struct timespec delay = {0, 50 * 1000000L};
+    nanosleep(&delay, NULL);
+    ASSERT(tinyaiMcpAsyncCallStatus(slow) == TINYAI_MCP_CALL_RUNNING, "Slow call should run");
+
+    call = tinyaiMcpCallToolAsync(single, "echo", "{}", &options);
+    ASSERT(tinyaiMcpAsyncCallStatus(call) == TINYAI_MCP_CALL_QUEUED,
+           "Call should wait for the busy worker");
+    tinyaiMcpAsyncCallCancel(call);
+    ASSERT(tinyaiMcpAsyncCallStatus(call) == TINYAI_MCP_CALL_CANCELLED,
+           "Queued call should be cancelled at once");
+    ASSERT(__atomic_load_n(&log.cancelled, __ATOMIC_ACQUIRE) == 1,
+           "Cancellation should run the completion callback");
+    tinyaiMcpAsyncCallRelease(call);
+
+    ASSERT(tinyaiMcpAsyncCallWait(slow, 5000), "Slow call should finish");
+    ASSERT(tinyaiMcpAsyncCallStatus(slow) == TINYAI_MCP_CALL_SUCCEEDED, "Slow call should succeed");
+    tinyaiMcpAsyncCallRelease(slow);
+    tinyaiMcpDestroyClient(single);
+    ASSERT(log.succeeded == 1 && log.cancelled == 1, "Completion callbacks should run once");
+
+    /* Released while running: destroying the client waits for it */
+    call = tinyaiMcpCallToolAsync(client, "slow", "{}", NULL);
+    ASSERT(call != NULL, "Asynchronous call should start");
+    tinyaiMcpAsyncCallRelease(call);
+
+    tinyaiMcpDestroyClient(client);
+    stop_server(&server);
+    printf("  Asynchronous calls test passed.\n");
+}
+
+// Test that one thread keeps many calls in flight over a few connections
+void test_mcp_async_many_calls()
+{
+    printf("  Testing many asynchronous MCP calls in flight...\n");
+
+    TestServer server;
+    start_server(&server, 0, false);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    enum { CALLS = 40 };
+    CompletionLog         log     = {0, 0, 0};
+    TinyAIMcpAsyncOptions options = {NULL, log_completion, &log};
+    TinyAIMcpAsyncCall   *calls[CALLS];
+    for (int i = 0; i < CALLS; i++) {
+        char arguments[32];
+        snprintf(arguments, sizeof(arguments), "{\"n\":%d}", i);
+        calls[i] = tinyaiMcpCallToolAsync(client, i == 7 ? "fail" : "echo", arguments, &options);
+        ASSERT(calls[i] != NULL, "Asynchronous call should be submitted");
+    }
+
+    TinyAIMcpAsyncCall *resource = tinyaiMcpAccessResourceAsync(client, "kb://doc", NULL);
+    ASSERT(resource != NULL, "Resource read should be submitted");
+
+    for (int i = 0; i < CALLS; i++) {
+        char arguments[32];
+        snprintf(arguments, sizeof(arguments), "{\"n\":%d}", i);
+        ASSERT(tinyaiMcpAsyncCallWait(calls[i], 5000), "Asynchronous call should finish");
+
+        const char *result = NULL;
+        int         length = tinyaiMcpAsyncCallResult(calls[i], &result);
+        if (i == 7) {
+            ASSERT(length < 0 && strstr(result, "tool failed"), "Failing call should report it");
+        }
+        else {
+            ASSERT(length > 0 && strstr(result, arguments), "Result should match its call");
+        }
+        tinyaiMcpAsyncCallRelease(calls[i]);
+    }
+
+    const char *result = NULL;
+    ASSERT(tinyaiMcpAsyncCallWait(resource, 5000), "Resource read should finish");
+    ASSERT(tinyaiMcpAsyncCallResult(resource, &result) > 0 && strstr(result, "kb://doc"),
+           "Resource read should return the resource");
+    tinyaiMcpAsyncCallRelease(resource);
+
+    TinyAIMcpTransportStats stats;
+    tinyaiMcpGetTransportStats(client, &stats);
+    ASSERT(stats.connectionsOpened <= 4, "Calls should share the workers' connections");
+
+    // Callbacks may still be running after a wait; destroying the client waits for them
+    tinyaiMcpDestroyClient(client);
+    ASSERT(log.succeeded == CALLS - 1, "Every successful call should report its completion");
+    ASSERT(log.failed == 1, "The failing call should report its completion");
+    stop_server(&server);
+    printf("  Many asynchronous calls test passed.\n");
+}
+
+/* Progress notifications seen by a call */
+typedef struct {
+    int             partials;
+    bool            runningAtPartial;
+    struct timespec firstPartial;
+    struct timespec completed;
+} ProgressLog;
+
+static void log_partial(TinyAIMcpAsyncCall *call, const char *data, int length, void *userData)
+{
+    ProgressLog *log = (ProgressLog *)userData;
+    if (log->partials++ == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &log->firstPartial);
+    }
+    log->runningAtPartial = tinyaiMcpAsyncCallStatus(call) == TINYAI_MCP_CALL_RUNNING &&
+                            length > 0 && strstr(data, "notifications/progress") != NULL;
+}
+
+static void log_progress_completion(TinyAIMcpAsyncCall *call, void *userData)
+{
+    (void)call;
+    clock_gettime(CLOCK_MONOTONIC, &((ProgressLog *)userData)->completed);
+}
+
+// Test that notifications streamed ahead of a reply are passed on as they arrive
+void test_mcp_async_partial_results()
+{
+    printf("  Testing streamed partial results...\n");
+
+    TestServer server;
+    start_server(&server, 0, false);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    ProgressLog           log;
+    TinyAIMcpAsyncOptions options = {log_partial, log_progress_completion, &log};
+    memset(&log, 0, sizeof(log));
+    TinyAIMcpAsyncCall *call = tinyaiMcpCallToolAsync(client, "progress", "{}", &options);
+    ASSERT(call != NULL, "Asynchronous call should be submitted");
+    ASSERT(tinyaiMcpAsyncCallWait(call, 5000), "Streamed call should finish");
+
+    const char *result = NULL;
+    ASSERT(tinyaiMcpAsyncCallResult(call, &result) > 0 && strstr(result, "\"done\":true"),
+           "The reply event should become the result");
+    tinyaiMcpAsyncCallRelease(call);
+
+    /* The synchronous API takes the reply out of the stream too */
+    char buffer[128];
+    ASSERT(tinyaiMcpCallTool(client, "progress", "{}", buffer, sizeof(buffer)) > 0 &&
+               strcmp(buffer, "{\"done\":true}") == 0,
+           "Synchronous call should skip the notifications");
+
+    tinyaiMcpDestroyClient(client);
+    ASSERT(log.partials == 2, "Both notifications should be passed on");
+    ASSERT(log.runningAtPartial, "Notifications should arrive while the call runs");
+    double gapMs = (log.completed.tv_sec - log.firstPartial.tv_sec) * 1000.0 +
+                   (log.completed.tv_nsec - log.firstPartial.tv_nsec) / 1e6;
+    ASSERT(gapMs >= 50.0, "The first notification should not wait for the rest of the stream");
+    stop_server(&server);
+    printf("  Streamed partial results test passed.\n");
+}
+
+// Test that repeated calls are answered from the response cache
+void test_mcp_response_cache()
+{
+    printf("  Testing the MCP response cache...\n");
+
+    TestServer server;
+    start_server(&server, 0, false);
+    TinyAIMcpClient *client = connect_client(&server);
+
+    TinyAIMcpCacheConfig config = {3, 0, 150, 5000};
+    ASSERT(tinyaiMcpSetCacheConfig(client, &config), "Cache should be enabled");
+
+    char result[256], cached[256];
+    ASSERT(tinyaiMcpCallTool(client, "echo", "{\"a\":1,\"b\":[1, 2]}", result,
+                             sizeof(result)) > 0,
+           "First call should succeed");
+    int requests = __atomic_load_n(&server.requests, __ATOMIC_ACQUIRE);
+    ASSERT(tinyaiMcpCallTool(client, "echo", " { \"b\": [1,2], \"a\": 1 } ", cached,
+                             sizeof(cached)) > 0,
+           "Repeated call should succeed");
+    ASSERT(strcmp(result, cached) == 0, "Repeated call should get the cached result");
+    ASSERT(__atomic_load_n(&server.requests, __ATOMIC_ACQUIRE) == requests,
+           "Equivalent arguments should be answered without a request");
+
+    /* Asynchronous calls finish at once on a hit; failures are never cached */
+    TinyAIMcpAsyncCall *call =
+        tinyaiMcpCallToolAsync(client, "echo", "{\"b\":[1,2],\"a\":1}", NULL);
+    ASSERT(call && tinyaiMcpAsyncCallStatus(call) == TINYAI_MCP_CALL_SUCCEEDED,
+           "Cached asynchronous call should finish when submitted");
+    tinyaiMcpAsyncCallRelease(call);
+    tinyaiMcpCallTool(client, "fail", "{}", result, sizeof(result));
+    tinyaiMcpCallTool(client, "fail", "{}", result, sizeof(result));
+    ASSERT(__atomic_load_n(&server.requests, __ATOMIC_ACQUIRE) == requests + 2,
+           "Failed calls should not be cached");
+
+    ASSERT(tinyaiMcpAccessResource(client, "kb://a", result, sizeof(result)) > 0 &&
+               tinyaiMcpAccessResource(client, "kb://a", cached, sizeof(cached)) > 0 &&
+               strcmp(result, cached) == 0,
+           "Resource reads should be cached");
+    ASSERT(__atomic_load_n(&server.requests, __ATOMIC_ACQUIRE) == requests + 3,
+           "Repeated resource read should need no request");
+
+    /* A stale result is served while a background call refreshes it */
+    struct timespec delay = {0, 200 * 1000000L};
+    nanosleep(&delay, NULL);
+    requests = __atomic_load_n(&server.requests, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < 2; i++) {
+        ASSERT(tinyaiMcpCallTool(client, "echo", "{\"a\":1,\"b\":[1,2]}", result,
+                                 sizeof(result)) > 0,
+               "Stale result should be served");
+    }
+    for (int i = 0; i < 200 && __atomic_load_n(&server.requests, __ATOMIC_ACQUIRE) == requests;
+         i++) {
+        struct timespec poll = {0, 10 * 1000000L};
+        nanosleep(&poll, NULL);
+    }
+
+    TinyAIMcpCacheStats stats;
+    ASSERT(tinyaiMcpGetCacheStats(client, &stats), "Cache stats should be available");
+    ASSERT(stats.staleHits == 2 && stats.revalidations == 1, "One refresh should be started");
+    ASSERT(__atomic_load_n(&server.requests, __ATOMIC_ACQUIRE) == requests + 1,
+           "The refresh should reach the server");
+    ASSERT(stats.hits == 3, "Fresh hits should be counted");
+
+    /* The least recently used result makes way beyond maxEntries */
+    for (int i = 0; i < 3; i++) {
+        char arguments[32];
+        snprintf(arguments, sizeof(arguments), "{\"n\":%d}", i);
+        tinyaiMcpCallTool(client, "echo", arguments, result, sizeof(result));
+    }
+    tinyaiMcpGetCacheStats(client, &stats);
+    ASSERT(stats.entries == 3 && stats.evictions == 2, "Cache should stay within its bounds");
+
+    tinyaiMcpDestroyClient(client);
+    stop_server(&server);
+    printf("  Response cache test passed.\n");
+}
+
+#endif
+
+// Run all MCP client tests
+void run_mcp_tests()
+{
+    printf("Running MCP client tests...\n");
+
+    test_mcp_mock_server();
+#ifndef _WIN32
+    test_mcp_keep_alive();
+    test_mcp_pipelined_calls();
+    test_mcp_reconnect();
+    test_mcp_connect_retry();
+    test_mcp_async_calls();
+    test_mcp_async_many_calls();
+    test_mcp_async_partial_results();
+    test_mcp_response_cache();
+#endif
+
+    printf("All MCP client tests passed!\n");
+}
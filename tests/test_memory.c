@@ -106,6 +106,64 @@ void test_realloc() {
     printf("    PASS\n");
 }
 
+void test_tracking() {
+    printf("  Testing allocation tracking...\n");
+    size_t allocs0, bytes0, frees0, freeBytes0;
+    size_t allocs, bytes, frees, freeBytes;
+    ASSERT(tinyaiMemTrackInit() == 0, "tinyaiMemTrackInit should succeed");
+    tinyaiMemTrackStats(&allocs0, &bytes0, &frees0, &freeBytes0);
+
+    // Every allocation is tracked once, even through the macros
+    void *blocks[64];
+    int firstLine = __LINE__ + 2;
+    for (int i = 0; i < 64; i++) {
+        blocks[i] = tinyaiMemTrackedAlloc(100, __FILE__, firstLine);
+        ASSERT(blocks[i] != NULL, "Tracked allocation should succeed");
+    }
+    void *grown = tinyaiMemTrackedRealloc(blocks[0], 300, __FILE__, firstLine + 1);
+    ASSERT(grown != NULL, "Tracked realloc should succeed");
+    blocks[0] = grown;
+
+    tinyaiMemTrackStats(&allocs, &bytes, &frees, &freeBytes);
+    ASSERT(allocs - allocs0 == 65, "Each allocation and the realloc should be tracked once");
+    ASSERT(frees - frees0 == 1 && freeBytes - freeBytes0 == 100,
+           "Realloc should retire the old block");
+
+    // Call sites aggregate their live blocks
+    TinyAIMemTrackSite sites[16];
+    size_t numSites = tinyaiMemTrackGetSites(sites, 16);
+    int found = 0;
+    for (size_t i = 0; i < numSites && i < 16; i++) {
+        if (sites[i].line == firstLine && strcmp(sites[i].file, __FILE__) == 0) {
+            ASSERT(sites[i].liveCount == 63 && sites[i].liveBytes == 6300,
+                   "Site should count its live blocks");
+            found = 1;
+        }
+    }
+    ASSERT(found, "Allocation site should be reported");
+
+    for (int i = 0; i < 64; i++) {
+        tinyaiMemTrackedFree(blocks[i]);
+    }
+    tinyaiMemTrackStats(&allocs, &bytes, &frees, &freeBytes);
+    ASSERT(frees - frees0 == 65 && freeBytes - freeBytes0 == bytes - bytes0,
+           "Every tracked byte should be freed");
+
+    // With sampling only 1 in N allocations is tracked
+    ASSERT(tinyaiMemTrackSetSampleRate(0) != 0, "A sample rate of 0 should be rejected");
+    ASSERT(tinyaiMemTrackSetSampleRate(4) == 0, "Sample rate should be set");
+    tinyaiMemTrackStats(&allocs0, NULL, NULL, NULL);
+    for (int i = 0; i < 64; i++) {
+        blocks[i] = tinyaiMemTrackedAlloc(16, __FILE__, __LINE__);
+    }
+    tinyaiMemTrackStats(&allocs, NULL, NULL, NULL);
+    for (int i = 0; i < 64; i++) {
+        tinyaiMemTrackedFree(blocks[i]);
+    }
+    tinyaiMemTrackSetSampleRate(1);
+    ASSERT(allocs - allocs0 == 16, "One in four allocations should be tracked");
+    printf("    PASS\n");
+}
 
 // Function to be called by test_main.c
 void run_memory_tests() {
@@ -113,6 +171,7 @@ void run_memory_tests() {
     test_basic_alloc_free();
     test_calloc();
     test_realloc();
+    test_tracking();
     // Add calls to pool tests and tracking tests later
     printf("--- Memory Tests Finished ---\n");
 }
@@ -1,5 +1,7 @@
 #include "memory_analysis.h"
 #include <assert.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -202,6 +204,124 @@ static void test_configuration()
     tinyaiFreeMemoryAnalysis(analysis);
 }
 
+// Record count allocations of size bytes at consecutive fake addresses from base
+static void record_site(TinyAIMemoryAnalysis *analysis, uintptr_t base, int count, size_t size,
+                        int line)
+{
+    for (int i = 0; i < count; i++) {
+        tinyaiRecordAllocation(analysis, (void *)(base + (uintptr_t)i * size), size, __FILE__,
+                               line, __func__);
+    }
+}
+
+static void free_site(TinyAIMemoryAnalysis *analysis, uintptr_t base, int count, size_t size)
+{
+    for (int i = 0; i < count; i++) {
+        tinyaiRecordDeallocation(analysis, (void *)(base + (uintptr_t)i * size));
+    }
+}
+
+// Test sampling estimates
+static void test_sampling()
+{
+    TinyAIMemoryAnalysisConfig config = {.track_allocations       = true,
+                                         .track_deallocations     = true,
+                                         .track_peak_usage        = true,
+                                         .analyze_patterns        = true,
+                                         .sample_interval_ms      = 100,
+                                         .analysis_window_ms      = 1000,
+                                         .sampling_interval_bytes = 4096};
+
+    TinyAIMemoryAnalysis *analysis = tinyaiCreateMemoryAnalysis(&config);
+    assert(analysis != NULL);
+
+    // Many small allocations at one site, few large ones at another
+    const uintptr_t small_base = 0x10000000, large_base = 0x40000000;
+    record_site(analysis, small_base, 10000, 256, 1);
+    record_site(analysis, large_base, 100, 65536, 2);
+
+    // Every allocation is counted, only a fraction recorded
+    TinyAIMemoryPattern pattern = tinyaiGetMemoryPattern(analysis);
+    assert(pattern.total_allocations == 10100);
+    assert(analysis->num_allocations > 0 && analysis->num_allocations < 3000);
+
+    // Usage is estimated within a few percent
+    double total = 10000.0 * 256 + 100.0 * 65536;
+    assert(fabs(pattern.current_usage - total) < total * 0.1);
+
+    // The large allocations are the top hotspot, with about their count
+    TinyAIMemoryAllocation *hotspots;
+    size_t                  num_hotspots;
+    tinyaiGetAllocationHotspots(analysis, &hotspots, &num_hotspots);
+    assert(num_hotspots == 2);
+    assert(hotspots[0].line == 2 && fabs(hotspots[0].weight - 100.0) < 10.0);
+    assert(hotspots[1].line == 1 && fabs(hotspots[1].weight - 10000.0) < 1500.0);
+    free(hotspots);
+
+    // Freeing the large allocations leaves samples of the small ones only
+    free_site(analysis, large_base, 100, 65536);
+    TinyAIMemoryAllocation *leaks;
+    size_t                  num_leaks;
+    tinyaiGetMemoryLeakCandidates(analysis, &leaks, &num_leaks);
+    assert(num_leaks > 0);
+    double leaked = 0.0;
+    for (size_t i = 0; i < num_leaks; i++) {
+        assert(leaks[i].line == 1);
+        leaked += leaks[i].size * leaks[i].weight;
+    }
+    assert(fabs(leaked - 10000.0 * 256) < 10000.0 * 256 * 0.15);
+    free(leaks);
+
+    // Freeing everything leaves no candidates
+    free_site(analysis, small_base, 10000, 256);
+    tinyaiGetMemoryLeakCandidates(analysis, &leaks, &num_leaks);
+    assert(num_leaks == 0);
+    assert(tinyaiGetMemoryPattern(analysis).total_freed == 10100);
+    assert(tinyaiGetMemoryPattern(analysis).current_usage < 1024);
+    free(leaks);
+
+    tinyaiFreeMemoryAnalysis(analysis);
+}
+
+// Test periodic snapshots with stacks
+static void test_snapshots()
+{
+    TinyAIMemoryAnalysisConfig config = {.track_allocations       = true,
+                                         .track_deallocations     = true,
+                                         .sampling_interval_bytes = 4096,
+                                         .stack_depth             = 8,
+                                         .snapshot_prefix         = "memory_snapshot_test",
+                                         .snapshot_interval_ms    = 0};
+
+    TinyAIMemoryAnalysis *analysis = tinyaiCreateMemoryAnalysis(&config);
+    assert(analysis != NULL);
+
+    // Allocations far above the interval are always sampled, each taking a snapshot
+    record_site(analysis, 0x10000000, 3, 1 << 20, __LINE__);
+    tinyaiTakeMemorySample(analysis);
+    assert(analysis->snapshot_count == 4);
+#if defined(__GLIBC__) || defined(__APPLE__)
+    assert(analysis->allocations[0].stack_depth > 0);
+#endif
+
+    FILE *file = fopen("memory_snapshot_test_3.json", "r");
+    assert(file != NULL);
+    char   content[8192];
+    size_t length   = fread(content, 1, sizeof(content) - 1, file);
+    content[length] = '\0';
+    fclose(file);
+    assert(strstr(content, "\"total_allocations\": 3") != NULL);
+    assert(strstr(content, "\"hotspots\": [") != NULL);
+    assert(strstr(content, "record_site") != NULL);
+
+    char filename[64];
+    for (unsigned i = 0; i < analysis->snapshot_count; i++) {
+        snprintf(filename, sizeof(filename), "memory_snapshot_test_%u.json", i);
+        remove(filename);
+    }
+    tinyaiFreeMemoryAnalysis(analysis);
+}
+
 int main()
 {
     printf("Testing memory analysis tools...\n");
@@ -224,6 +344,12 @@ int main()
     test_configuration();
     printf("Configuration test passed\n");
 
+    test_sampling();
+    printf("Sampling test passed\n");
+
+    test_snapshots();
+    printf("Snapshot test passed\n");
+
     printf("All memory analysis tests passed successfully!\n");
     return 0;
 }
\ No newline at end of file
@@ -123,6 +123,154 @@ static void test_streaming_operations()
     tinyaiFreeMemoryEfficientTensor(tensor2);
 }
 
+// Elementwise operation for the parallel and file-backed streaming tests
+static void scale_add_operation(void *dest, const void *src, size_t count)
+{
+    float       *d = (float *)dest;
+    const float *s = (const float *)src;
+    for (size_t i = 0; i < count; i++) {
+        d[i] = d[i] * 2.0f + s[i];
+    }
+}
+
+// Test parallel and file-backed streaming operations
+static void test_parallel_streaming()
+{
+    // Enough elements for several chunks and a short last one
+    size_t            dims[] = {1000, 101};
+    TinyAITensorShape shape  = {.dims = dims, .num_dims = 2, .total_size = 101000};
+
+    TinyAIMemoryEfficientTensor *tensor1 =
+        tinyaiCreateMemoryEfficientTensor(&shape, TINYAI_TENSOR_FLOAT32, TINYAI_MEMORY_STATIC);
+    TinyAIMemoryEfficientTensor *tensor2 =
+        tinyaiCreateMemoryEfficientTensor(&shape, TINYAI_TENSOR_FLOAT32, TINYAI_MEMORY_STATIC);
+    assert(tensor1 != NULL && tensor2 != NULL);
+
+    float *data = (float *)tinyaiGetTensorData(tensor1);
+    float *src  = (float *)tinyaiGetTensorData(tensor2);
+    for (size_t i = 0; i < shape.total_size; i++) {
+        data[i] = (float)(i % 97);
+        src[i]  = (float)(i % 13);
+    }
+
+    // Elementwise operation on tensors in memory
+    assert(tinyaiTensorStreamOperationParallel(tensor1, tensor2, scale_add_operation, 4096));
+    for (size_t i = 0; i < shape.total_size; i++) {
+        assert(data[i] == (float)(i % 97) * 2.0f + (float)(i % 13));
+    }
+
+    // The same operation streamed from a file, serially and in parallel
+    const char *path = "test_stream_tensor.bin";
+    FILE       *file = fopen(path, "wb");
+    assert(file != NULL);
+    assert(fwrite("head", 1, 4, file) == 4);
+    for (size_t i = 0; i < shape.total_size; i++) {
+        float value = (float)(i % 97);
+        assert(fwrite(&value, sizeof(value), 1, file) == 1);
+    }
+    fclose(file);
+
+    TinyAIMemoryEfficientTensor *streamed =
+        tinyaiCreateMemoryEfficientTensor(&shape, TINYAI_TENSOR_FLOAT32, TINYAI_MEMORY_STREAM);
+    assert(streamed != NULL);
+    assert(!tinyaiSetTensorFile(tensor1, path, 4));
+    assert(tinyaiSetTensorFile(streamed, path, 4));
+    assert(tinyaiTensorStreamOperation(streamed, tensor2, scale_add_operation, 3000));
+    assert(tinyaiTensorStreamOperationParallel(streamed, tensor2, scale_add_operation, 7000));
+
+    file = fopen(path, "rb");
+    assert(file != NULL);
+    char header[4];
+    assert(fread(header, 1, 4, file) == 4 && memcmp(header, "head", 4) == 0);
+    for (size_t i = 0; i < shape.total_size; i++) {
+        float value;
+        float once = (float)(i % 97) * 2.0f + (float)(i % 13);
+        assert(fread(&value, sizeof(value), 1, file) == 1);
+        assert(value == once * 2.0f + (float)(i % 13));
+    }
+    fclose(file);
+
+    // A file too short for the tensor fails the operation
+    assert(tinyaiSetTensorFile(streamed, path, 8));
+    assert(!tinyaiTensorStreamOperationParallel(streamed, tensor2, scale_add_operation, 7000));
+    remove(path);
+
+    tinyaiFreeMemoryEfficientTensor(streamed);
+    tinyaiFreeMemoryEfficientTensor(tensor1);
+    tinyaiFreeMemoryEfficientTensor(tensor2);
+}
+
+// Test strided views
+static void test_tensor_views()
+{
+    // A [seq=3, heads=2, head_dim=4] tensor holding its own element indices
+    size_t            dims[] = {3, 2, 4};
+    TinyAITensorShape shape  = {.dims = dims, .num_dims = 3, .total_size = 24};
+
+    TinyAIMemoryEfficientTensor *tensor =
+        tinyaiCreateMemoryEfficientTensor(&shape, TINYAI_TENSOR_FLOAT32, TINYAI_MEMORY_STATIC);
+    assert(tensor != NULL);
+    float *data = (float *)tinyaiGetTensorData(tensor);
+    for (int i = 0; i < 24; i++) {
+        data[i] = (float)i;
+    }
+
+    // Head 1 of every position is a strided slice sharing the data
+    TinyAIMemoryEfficientTensor *head = tinyaiSliceTensor(tensor, 1, 1, 1);
+    assert(head != NULL && head->is_view && !head->is_contiguous);
+    assert(head->shape.total_size == 12 && tinyaiGetTensorMemoryUsage(head) == 0);
+    assert(tinyaiGetTensorData(head) == data + 4);
+
+    // Heads first; adding through the view updates the tensor
+    size_t                       order[] = {1, 0, 2};
+    TinyAIMemoryEfficientTensor *heads   = tinyaiPermuteTensor(tensor, order);
+    assert(heads != NULL && heads->shape.dims[0] == 2 && heads->shape.dims[1] == 3);
+    TinyAIMemoryEfficientTensor *first   = tinyaiSliceTensor(heads, 0, 0, 1);
+    TinyAIMemoryEfficientTensor *second  = tinyaiSliceTensor(heads, 0, 1, 1);
+    assert(first != NULL && second != NULL);
+    assert(tinyaiTensorAddInPlace(first, second));
+    for (int p = 0; p < 3; p++) {
+        for (int d = 0; d < 4; d++) {
+            assert(data[p * 8 + d] == (float)(p * 8 + d) * 2.0f + 4.0f);
+            assert(data[p * 8 + 4 + d] == (float)(p * 8 + 4 + d));
+        }
+    }
+    assert(tinyaiTensorMulInPlace(second, second));
+    assert(data[12] == 144.0f);
+
+    // Reshapes need row-major elements
+    size_t                       flat_dims[] = {6, 4};
+    TinyAITensorShape            flat_shape  = {.dims = flat_dims, .num_dims = 2, .total_size = 24};
+    TinyAIMemoryEfficientTensor *flat        = tinyaiReshapeTensor(tensor, &flat_shape);
+    assert(flat != NULL && flat->is_contiguous && tinyaiGetTensorData(flat) == data);
+    assert(tinyaiReshapeTensor(heads, &flat_shape) == NULL);
+
+    // Views may not reach past the data they share
+    size_t            window_dims[] = {2, 4};
+    TinyAITensorShape window        = {.dims = window_dims, .num_dims = 2, .total_size = 8};
+    TinyAIMemoryEfficientTensor *last = tinyaiCreateTensorView(flat, 16, &window, NULL);
+    assert(last != NULL && ((float *)tinyaiGetTensorData(last))[0] == data[16]);
+    tinyaiFreeMemoryEfficientTensor(last);
+    assert(tinyaiCreateTensorView(flat, 17, &window, NULL) == NULL);
+    assert(tinyaiSliceTensor(tensor, 0, 2, 2) == NULL);
+
+    // Setting data scatters it, and making a view contiguous detaches it
+    float values[4] = {-1.0f, -2.0f, -3.0f, -4.0f};
+    assert(tinyaiSetTensorData(head, values, sizeof(values)));
+    assert(data[4] == -1.0f && data[7] == -4.0f && data[12] == 144.0f);
+    assert(tinyaiMakeTensorContiguous(head));
+    assert(!head->is_view && head->is_contiguous && tinyaiGetTensorData(head) != data + 4);
+    float *copy = (float *)tinyaiGetTensorData(head);
+    assert(copy[0] == -1.0f && copy[4] == data[12] && copy[11] == data[23]);
+
+    tinyaiFreeMemoryEfficientTensor(head);
+    tinyaiFreeMemoryEfficientTensor(first);
+    tinyaiFreeMemoryEfficientTensor(second);
+    tinyaiFreeMemoryEfficientTensor(heads);
+    tinyaiFreeMemoryEfficientTensor(flat);
+    tinyaiFreeMemoryEfficientTensor(tensor);
+}
+
 // Test memory pool operations
 static void test_memory_pool()
 {
@@ -186,6 +334,12 @@ int main()
     test_streaming_operations();
     printf("Streaming operations test passed\n");
 
+    test_parallel_streaming();
+    printf("Parallel streaming test passed\n");
+
+    test_tensor_views();
+    printf("Tensor views test passed\n");
+
     test_memory_pool();
     printf("Memory pool test passed\n");
 
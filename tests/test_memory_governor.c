@@ -0,0 +1,164 @@
+/**
+ * TinyAI Memory Governor Tests
+ */
+
+#include "../utils/memory_governor.h"
+#include "../utils/memory_pool.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+// Records the order stages ran in and the level they saw
+typedef struct {
+    int                 order[TINYAI_SHED_STAGE_COUNT];
+    int                 count;
+    TinyAIPressureLevel level;
+    size_t              release;
+} ShedLog;
+
+typedef struct {
+    ShedLog        *log;
+    TinyAIShedStage stage;
+} FakeShedder;
+
+static size_t fake_shed(void *userData, TinyAIPressureLevel level)
+{
+    FakeShedder *shedder = (FakeShedder *)userData;
+    shedder->log->order[shedder->log->count++] = shedder->stage;
+    shedder->log->level = level;
+    return shedder->log->release;
+}
+
+// Register one fake shedder per stage, in reverse to check the governor orders them
+static void add_fake_shedders(TinyAIMemoryGovernor *governor, FakeShedder *shedders, ShedLog *log)
+{
+    for (int stage = TINYAI_SHED_STAGE_COUNT - 1; stage >= 0; stage--) {
+        shedders[stage].log   = log;
+        shedders[stage].stage = (TinyAIShedStage)stage;
+        ASSERT(tinyaiMemoryGovernorAddShedder(governor, (TinyAIShedStage)stage, fake_shed,
+                                              &shedders[stage]) == 0,
+               "Shedder should be added");
+    }
+}
+
+// Test that pressure runs the stages its level allows, in order
+static void test_shedding_levels()
+{
+    printf("  Testing shedding order and pressure levels...\n");
+
+    size_t resident = tinyaiGetResidentMemory();
+    if (resident == 0) {
+        printf("    SKIP (resident memory not measurable)\n");
+        return;
+    }
+
+    TinyAIMemoryGovernorConfig config;
+    tinyaiMemoryGovernorGetDefaultConfig(&config);
+    ASSERT(config.moderatePercent < config.highPercent &&
+               config.highPercent < config.criticalPercent,
+           "Default thresholds should rise");
+
+    // A limit far below the resident set is critical and runs every stage in order
+    ShedLog     log = {{0}, 0, TINYAI_PRESSURE_NONE, 0};
+    FakeShedder shedders[TINYAI_SHED_STAGE_COUNT];
+    config.memoryLimit             = resident / 4;
+    TinyAIMemoryGovernor *governor = tinyaiCreateMemoryGovernor(&config);
+    ASSERT(governor != NULL, "Governor should be created");
+    add_fake_shedders(governor, shedders, &log);
+
+    ASSERT(tinyaiMemoryGovernorPoll(governor) == TINYAI_PRESSURE_CRITICAL,
+           "Usage over the limit should be critical");
+    ASSERT(log.count == TINYAI_SHED_STAGE_COUNT, "Critical pressure should run every stage");
+    for (int i = 0; i < log.count; i++) {
+        ASSERT(log.order[i] == i, "Stages should run cheapest first");
+    }
+    ASSERT(log.level == TINYAI_PRESSURE_CRITICAL, "Shedders should see the level");
+
+    // Releasing enough in the first stage stops shedding there
+    log.count   = 0;
+    log.release = resident;
+    tinyaiMemoryGovernorPoll(governor);
+    ASSERT(log.count == 1, "Shedding should stop once usage is low again");
+
+    TinyAIMemoryGovernorStats stats;
+    tinyaiMemoryGovernorGetStats(governor, &stats);
+    ASSERT(stats.polls == 2, "Polls should be counted");
+    ASSERT(stats.sheds[TINYAI_SHED_MAPPED_WEIGHTS] == 2, "First stage ran on both polls");
+    ASSERT(stats.sheds[TINYAI_SHED_POOLS] == 1, "Last stage ran on the first poll only");
+    ASSERT(stats.bytesShed[TINYAI_SHED_MAPPED_WEIGHTS] == resident, "Released bytes are summed");
+
+    // Removed shedders no longer run
+    for (int stage = 0; stage < TINYAI_SHED_STAGE_COUNT; stage++) {
+        tinyaiMemoryGovernorRemove(governor, &shedders[stage]);
+    }
+    log.count   = 0;
+    log.release = 0;
+    tinyaiMemoryGovernorPoll(governor);
+    ASSERT(log.count == 0, "Removed shedders should not run");
+    tinyaiDestroyMemoryGovernor(governor);
+
+    // A limit far above the resident set sheds nothing
+    config.memoryLimit = resident * 4;
+    governor           = tinyaiCreateMemoryGovernor(&config);
+    ASSERT(governor != NULL, "Governor should be created");
+    add_fake_shedders(governor, shedders, &log);
+    ASSERT(tinyaiMemoryGovernorPoll(governor) == TINYAI_PRESSURE_NONE,
+           "Usage well under the limit should be no pressure");
+    ASSERT(log.count == 0, "No pressure should shed nothing");
+    tinyaiDestroyMemoryGovernor(governor);
+
+    printf("    PASS\n");
+}
+
+// Test that trimming a pool gives back grown regions once they are free
+static void test_pool_trim()
+{
+    printf("  Testing pool trimming...\n");
+
+    TinyAIMemoryPoolConfig config;
+    tinyaiMemoryPoolGetDefaultConfig(&config);
+    config.initialCapacity = 64 * 1024;
+    config.maxCapacity     = 1024 * 1024;
+    config.allowGrowth     = true;
+
+    TinyAIMemoryPool *pool = tinyaiMemoryPoolCreate(&config);
+    ASSERT(pool != NULL, "Pool should be created");
+
+    // Outgrow the initial region, then free everything
+    void *blocks[8];
+    for (int i = 0; i < 8; i++) {
+        blocks[i] = tinyaiMemoryPoolAlloc(pool, 32 * 1024, 16);
+        ASSERT(blocks[i] != NULL, "Allocation should grow the pool");
+    }
+    ASSERT(tinyaiMemoryPoolTrim(pool) == 0, "Regions in use should be kept");
+    for (int i = 0; i < 8; i++) {
+        tinyaiMemoryPoolFree(pool, blocks[i]);
+    }
+
+    ASSERT(tinyaiMemoryPoolTrim(pool) > 0, "Free grown regions should be released");
+    ASSERT(tinyaiMemoryPoolTrim(pool) == 0, "Trimming twice should release nothing more");
+    ASSERT(tinyaiMemoryPoolAlloc(pool, 1024, 16) != NULL, "Trimmed pool should still allocate");
+
+    tinyaiMemoryPoolDestroy(pool);
+    printf("    PASS\n");
+}
+
+void run_memory_governor_tests()
+{
+    printf("--- Running Memory Governor Tests ---\n");
+
+    test_shedding_levels();
+    test_pool_trim();
+
+    printf("--- Memory Governor Tests Finished ---\n");
+}
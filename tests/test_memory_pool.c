@@ -3,7 +3,10 @@
  * @brief Tests for enhanced memory pool system
  */
 
+#include "../utils/advanced_memory_pool.h"
 #include "../utils/memory_pool.h"
+#include "../utils/numa.h"
+#include "../utils/thread_pool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -464,6 +467,423 @@ static int testLargeModelSimulation()
     return 1;
 }
 
+/* Blocks each task of the thread cache test keeps live */
+#define THREAD_CACHE_BLOCKS 256
+
+/* Shared state of the thread cache test */
+typedef struct {
+    TinyAIAdvancedMemoryPool *pool;
+    unsigned char            *blocks[4][THREAD_CACHE_BLOCKS];
+    size_t                    sizes[4][THREAD_CACHE_BLOCKS];
+    int                       failures[4];
+} ThreadCacheTest;
+
+/* Allocate and churn blocks, leaving one set live per task */
+static void threadCacheAllocTask(void *context, size_t begin, size_t end)
+{
+    ThreadCacheTest *test = (ThreadCacheTest *)context;
+    for (size_t t = begin; t < end; t++) {
+        for (int round = 0; round < 8; round++) {
+            for (int i = 0; i < THREAD_CACHE_BLOCKS; i++) {
+                size_t size = 16 + (size_t)((i * 37 + round * 11) % 4000);
+                unsigned char *block = (unsigned char *)tinyaiAdvancedPoolAlloc(
+                    test->pool, size, 16, (TinyAIPoolUsagePattern)(i % 3));
+                if (!block) {
+                    test->failures[t]++;
+                    continue;
+                }
+                memset(block, (int)(t * 64 + i % 64), size);
+                test->blocks[t][i] = block;
+                test->sizes[t][i]  = size;
+            }
+            if (round == 7) {
+                break;
+            }
+            for (int i = 0; i < THREAD_CACHE_BLOCKS; i++) {
+                tinyaiAdvancedPoolFree(test->pool, test->blocks[t][i]);
+                test->blocks[t][i] = NULL;
+            }
+        }
+    }
+}
+
+/* Check and free the blocks left live by another task */
+static void threadCacheFreeTask(void *context, size_t begin, size_t end)
+{
+    ThreadCacheTest *test = (ThreadCacheTest *)context;
+    for (size_t t = begin; t < end; t++) {
+        size_t owner = (t + 1) % 4;
+        for (int i = 0; i < THREAD_CACHE_BLOCKS; i++) {
+            unsigned char *block = test->blocks[owner][i];
+            if (!block) {
+                continue;
+            }
+            for (size_t j = 0; j < test->sizes[owner][i]; j++) {
+                if (block[j] != (unsigned char)(owner * 64 + i % 64)) {
+                    test->failures[t]++;
+                    break;
+                }
+            }
+            tinyaiAdvancedPoolFree(test->pool, block);
+        }
+    }
+}
+
+/* Test the per-thread caches of the advanced pool */
+static int testAdvancedPoolThreadCaches()
+{
+    printf("Running test: Advanced Pool Thread Caches\n");
+
+    TinyAIAdvancedPoolConfig config;
+    tinyaiAdvancedPoolGetDefaultConfig(&config);
+
+    TinyAIAdvancedMemoryPool *pool = tinyaiAdvancedPoolCreate(&config);
+    if (!pool) {
+        printf("ERROR: Failed to create advanced memory pool\n");
+        return 0;
+    }
+
+    /* A freed block is handed straight back to the next request of its class */
+    void *first = tinyaiAdvancedPoolAlloc(pool, 200, 16, TINYAI_POOL_USAGE_ACTIVATIONS);
+    tinyaiAdvancedPoolFree(pool, first);
+    void *second = tinyaiAdvancedPoolAlloc(pool, 180, 16, TINYAI_POOL_USAGE_ACTIVATIONS);
+    if (!first || second != first) {
+        printf("ERROR: Freed block was not reused by the thread cache\n");
+        tinyaiAdvancedPoolDestroy(pool);
+        return 0;
+    }
+
+    /* Growing within the size class keeps the block */
+    if (tinyaiAdvancedPoolRealloc(pool, second, 256, 16, TINYAI_POOL_USAGE_ACTIVATIONS) !=
+        second) {
+        printf("ERROR: Realloc within the size class moved the block\n");
+        tinyaiAdvancedPoolDestroy(pool);
+        return 0;
+    }
+    tinyaiAdvancedPoolFree(pool, second);
+
+    /* Churn from several threads, then free every block on a different thread */
+    ThreadCacheTest   test;
+    TinyAIThreadPool *threads = tinyaiCreateThreadPool(4, 0);
+    memset(&test, 0, sizeof(test));
+    test.pool = pool;
+    tinyaiParallelFor(threads, 4, 1, threadCacheAllocTask, &test);
+    tinyaiParallelFor(threads, 4, 1, threadCacheFreeTask, &test);
+    tinyaiDestroyThreadPool(threads);
+
+    TinyAIAdvancedPoolStats stats;
+    tinyaiAdvancedPoolGetStats(pool, &stats);
+    printf("  Cache hits: %zu, misses: %zu (hit rate %.2f)\n", stats.cacheHits,
+           stats.cacheMisses, stats.cacheHitRate);
+
+    int failures = test.failures[0] + test.failures[1] + test.failures[2] + test.failures[3];
+    tinyaiAdvancedPoolDestroy(pool);
+
+    if (failures > 0) {
+        printf("ERROR: %d blocks were lost or corrupted\n", failures);
+        return 0;
+    }
+    if (stats.cacheHits <= stats.cacheMisses) {
+        printf("ERROR: Thread caches served too few allocations\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Test huge-page backed pools and their fallback */
+static int testHugePages()
+{
+    printf("Running test: Huge Page Backed Pools\n");
+
+    TinyAIMemoryPoolConfig config;
+    tinyaiMemoryPoolGetDefaultConfig(&config);
+    config.initialCapacity = TEST_INITIAL_CAPACITY;
+    config.useHugePages    = true;
+
+    /* Whatever backs the region, huge pages or the fallback, must be usable end to end */
+    TinyAIMemoryPool *pool = tinyaiMemoryPoolCreate(&config);
+    if (!pool) {
+        printf("ERROR: Failed to create huge page pool\n");
+        return 0;
+    }
+    size_t   size = TEST_INITIAL_CAPACITY / 2;
+    uint8_t *data = (uint8_t *)tinyaiMemoryPoolAlloc(pool, size, 64);
+    if (!data) {
+        printf("ERROR: Failed to allocate from huge page pool\n");
+        tinyaiMemoryPoolDestroy(pool);
+        return 0;
+    }
+    memset(data, 0x5A, size);
+
+    TinyAIMemoryPoolStats stats;
+    tinyaiMemoryPoolGetStats(pool, &stats);
+    printf("  Huge pages: %zu bytes, advised: %zu bytes\n", stats.hugePageBytes,
+           stats.hugePageAdvisedBytes);
+    int ok = data[0] == 0x5A && data[size - 1] == 0x5A &&
+             stats.hugePageBytes + stats.hugePageAdvisedBytes <= stats.totalAllocated * 2;
+    tinyaiMemoryPoolFree(pool, data);
+    tinyaiMemoryPoolDestroy(pool);
+    if (!ok) {
+        printf("ERROR: Huge page pool data or statistics are wrong\n");
+        return 0;
+    }
+
+    /* Regions smaller than a huge page stay on the heap */
+    config.initialCapacity = 64 * 1024;
+    pool                   = tinyaiMemoryPoolCreate(&config);
+    if (!pool) {
+        printf("ERROR: Failed to create small pool\n");
+        return 0;
+    }
+    tinyaiMemoryPoolGetStats(pool, &stats);
+    tinyaiMemoryPoolDestroy(pool);
+    if (stats.hugePageBytes != 0 || stats.hugePageAdvisedBytes != 0) {
+        printf("ERROR: Small region was put on huge pages\n");
+        return 0;
+    }
+
+    /* The advanced pool only asks for huge pages for weights and key/value caches */
+    TinyAIAdvancedPoolConfig advConfig;
+    tinyaiAdvancedPoolGetDefaultConfig(&advConfig);
+    advConfig.hugePages = true;
+
+    TinyAIAdvancedMemoryPool *advPool = tinyaiAdvancedPoolCreate(&advConfig);
+    if (!advPool) {
+        printf("ERROR: Failed to create advanced pool with huge pages\n");
+        return 0;
+    }
+    float *weights = (float *)tinyaiAdvancedPoolAlloc(advPool, 1024 * 1024 * sizeof(float), 64,
+                                                      TINYAI_POOL_USAGE_WEIGHTS);
+    if (weights) {
+        weights[0]           = 1.0f;
+        weights[1024 * 1023] = 2.0f;
+    }
+
+    TinyAIAdvancedPoolStats advStats;
+    tinyaiAdvancedPoolGetStats(advPool, &advStats);
+    size_t activationHuge = 0;
+    for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
+        activationHuge += advStats.poolStats[TINYAI_POOL_USAGE_ACTIVATIONS][size].hugePageBytes +
+                          advStats.poolStats[TINYAI_POOL_USAGE_ACTIVATIONS][size]
+                              .hugePageAdvisedBytes;
+    }
+    printf("  Advanced pool huge pages: %zu bytes, advised: %zu bytes\n", advStats.hugePageBytes,
+           advStats.hugePageAdvisedBytes);
+    if (weights) {
+        tinyaiAdvancedPoolFree(advPool, weights);
+    }
+    tinyaiAdvancedPoolDestroy(advPool);
+
+    if (!weights || activationHuge != 0) {
+        printf("ERROR: Advanced pool huge page allocation failed\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* Test NUMA placement, weight replicas and per-node arenas (on one node here or many) */
+static int testNumaPlacement()
+{
+    printf("Running test: NUMA Placement\n");
+
+    int nodes = tinyaiNumaNodeCount();
+    printf("  NUMA nodes: %d, current node: %d\n", nodes, tinyaiNumaCurrentNode());
+    if (nodes < 1 || tinyaiNumaCurrentNode() < 0 || tinyaiNumaCurrentNode() >= nodes) {
+        printf("ERROR: Invalid NUMA topology\n");
+        return 0;
+    }
+
+    /* Node memory is usable on every node, and interleaved */
+    size_t size = 256 * 1024;
+    for (int node = -1; node < nodes; node++) {
+        uint8_t *data = (uint8_t *)tinyaiNumaAlloc(size, node);
+        if (!data) {
+            printf("ERROR: Failed to allocate on node %d\n", node);
+            return 0;
+        }
+        memset(data, 0x3C, size);
+        int ok = data[size - 1] == 0x3C;
+        tinyaiNumaFree(data, size);
+        if (!ok) {
+            printf("ERROR: Node %d memory is not usable\n", node);
+            return 0;
+        }
+    }
+
+    /* Replicas hold the same bytes and go away on release */
+    uint8_t *weights = (uint8_t *)malloc(size);
+    if (!weights) {
+        return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+        weights[i] = (uint8_t)(i * 7);
+    }
+    if (tinyaiNumaLocal(weights) != weights || !tinyaiNumaReplicate(weights, size)) {
+        printf("ERROR: Failed to replicate weights\n");
+        free(weights);
+        return 0;
+    }
+    const uint8_t *local = (const uint8_t *)tinyaiNumaLocal(weights);
+    int            ok    = local != weights && memcmp(local, weights, size) == 0;
+    tinyaiNumaRelease(weights);
+    ok = ok && tinyaiNumaLocal(weights) == weights;
+    free(weights);
+    if (!ok) {
+        printf("ERROR: Weight replica is wrong\n");
+        return 0;
+    }
+
+    /* A pool with per-node arenas behaves like one pool */
+    TinyAIAdvancedPoolConfig config;
+    tinyaiAdvancedPoolGetDefaultConfig(&config);
+    config.numaArenas = true;
+
+    TinyAIAdvancedMemoryPool *pool = tinyaiAdvancedPoolCreate(&config);
+    if (!pool) {
+        printf("ERROR: Failed to create pool with NUMA arenas\n");
+        return 0;
+    }
+    float *a = (float *)tinyaiAdvancedPoolAlloc(pool, 4096, 64, TINYAI_POOL_USAGE_WEIGHTS);
+    float *b = (float *)tinyaiAdvancedPoolAlloc(pool, 256, 16, TINYAI_POOL_USAGE_ACTIVATIONS);
+    if (a && b) {
+        a[0] = 1.0f;
+        b[0] = 2.0f;
+        b    = (float *)tinyaiAdvancedPoolRealloc(pool, b, 8192, 16, TINYAI_POOL_USAGE_ACTIVATIONS);
+    }
+    ok = a && b && a[0] == 1.0f && b[0] == 2.0f;
+    if (a) {
+        tinyaiAdvancedPoolFree(pool, a);
+    }
+    if (b) {
+        tinyaiAdvancedPoolFree(pool, b);
+    }
+    tinyaiAdvancedPoolDestroy(pool);
+    if (!ok) {
+        printf("ERROR: NUMA arena allocation failed\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+static int testIncrementalCompaction()
+{
+    printf("Running test: Incremental Compaction\n");
+
+    TinyAIMemoryPoolConfig config;
+    tinyaiMemoryPoolGetDefaultConfig(&config);
+    config.initialCapacity = 1024 * 1024;
+    config.allowGrowth     = false;
+
+    TinyAIMemoryPool *pool = tinyaiMemoryPoolCreate(&config);
+    if (!pool) {
+        printf("ERROR: Failed to create pool\n");
+        return 0;
+    }
+
+    /* Interleave fixed and movable buffers, then free every other movable one */
+    enum { COUNT = 16, SIZE = 8192 };
+    TinyAIPoolHandle handles[COUNT];
+    for (int i = 0; i < COUNT; i++) {
+        handles[i] = tinyaiMemoryPoolAllocMovable(pool, SIZE, 64);
+        if (handles[i] == TINYAI_POOL_NULL_HANDLE) {
+            printf("ERROR: Failed to allocate movable buffer %d\n", i);
+            tinyaiMemoryPoolDestroy(pool);
+            return 0;
+        }
+        uint8_t *data = (uint8_t *)tinyaiMemoryPoolPin(pool, handles[i]);
+        memset(data, i + 1, SIZE);
+        tinyaiMemoryPoolUnpin(pool, handles[i]);
+    }
+    void *fixed = tinyaiMemoryPoolAlloc(pool, 1024, 16);
+    for (int i = 0; i < COUNT; i += 2) {
+        tinyaiMemoryPoolFreeMovable(pool, handles[i]);
+        handles[i] = TINYAI_POOL_NULL_HANDLE;
+    }
+
+    /* Keep one buffer pinned; it must not move */
+    uint8_t *pinned = (uint8_t *)tinyaiMemoryPoolPin(pool, handles[COUNT - 1]);
+
+    TinyAIMemoryPoolStats before, after;
+    tinyaiMemoryPoolGetStats(pool, &before);
+
+    /* Bounded steps make progress a slice at a time, then run out of work */
+    size_t moved = 0, step;
+    int    steps = 0;
+    while ((step = tinyaiMemoryPoolCompactStep(pool, SIZE)) > 0) {
+        moved += step;
+        if (++steps > COUNT) {
+            break;
+        }
+    }
+    tinyaiMemoryPoolGetStats(pool, &after);
+
+    int ok = moved > 0 && steps > 1 && steps <= COUNT;
+    ok     = ok && after.freeBlocks < before.freeBlocks;
+    ok     = ok && tinyaiMemoryPoolPin(pool, handles[COUNT - 1]) == pinned;
+    tinyaiMemoryPoolUnpin(pool, handles[COUNT - 1]);
+    tinyaiMemoryPoolUnpin(pool, handles[COUNT - 1]);
+
+    for (int i = 1; i < COUNT && ok; i += 2) {
+        uint8_t *data = (uint8_t *)tinyaiMemoryPoolPin(pool, handles[i]);
+        ok = data && ((uintptr_t)data & 63) == 0 && data[0] == i + 1 && data[SIZE - 1] == i + 1;
+        tinyaiMemoryPoolUnpin(pool, handles[i]);
+    }
+    printf("  Moved %zu bytes in %d steps, free blocks %zu -> %zu\n", moved, steps,
+           before.freeBlocks, after.freeBlocks);
+
+    for (int i = 1; i < COUNT; i += 2) {
+        tinyaiMemoryPoolFreeMovable(pool, handles[i]);
+    }
+    tinyaiMemoryPoolFree(pool, fixed);
+    tinyaiMemoryPoolDestroy(pool);
+    if (!ok) {
+        printf("ERROR: Compaction lost or misplaced data\n");
+        return 0;
+    }
+
+    /* The background compactor of an advanced pool keeps movable data intact */
+    TinyAIAdvancedPoolConfig advConfig;
+    tinyaiAdvancedPoolGetDefaultConfig(&advConfig);
+    advConfig.compactThreshold = 0;
+
+    TinyAIAdvancedMemoryPool *advPool = tinyaiAdvancedPoolCreate(&advConfig);
+    if (!advPool || !tinyaiAdvancedPoolStartCompactor(advPool, 1, 0.5)) {
+        printf("ERROR: Failed to start the compactor\n");
+        tinyaiAdvancedPoolDestroy(advPool);
+        return 0;
+    }
+    for (int round = 0; round < 50 && ok; round++) {
+        for (int i = 0; i < COUNT; i++) {
+            handles[i] = tinyaiAdvancedPoolAllocMovable(advPool, 1024 + 64 * i, 32);
+            float *data = (float *)tinyaiAdvancedPoolPin(advPool, handles[i]);
+            ok          = ok && data;
+            if (data) {
+                data[0] = (float)(round * COUNT + i);
+            }
+            tinyaiAdvancedPoolUnpin(advPool, handles[i]);
+        }
+        for (int i = 0; i < COUNT; i++) {
+            float *data = (float *)tinyaiAdvancedPoolPin(advPool, handles[i]);
+            ok          = ok && data && data[0] == (float)(round * COUNT + i);
+            tinyaiAdvancedPoolUnpin(advPool, handles[i]);
+            if (i % 3 != 0) {
+                tinyaiAdvancedPoolFreeMovable(advPool, handles[i]);
+            }
+        }
+    }
+    tinyaiAdvancedPoolCompactStep(advPool, 5.0);
+    tinyaiAdvancedPoolDestroy(advPool);
+    if (!ok) {
+        printf("ERROR: Background compaction corrupted movable data\n");
+        return 0;
+    }
+
+    return 1;
+}
+
 /* Run a series of allocation performance tests */
 static void runPerformanceTests()
 {
@@ -547,6 +967,42 @@ int main()
         failCount++;
     }
 
+    if (testAdvancedPoolThreadCaches()) {
+        printf("✓ Advanced pool thread cache test passed\n\n");
+        passCount++;
+    }
+    else {
+        printf("✗ Advanced pool thread cache test failed\n\n");
+        failCount++;
+    }
+
+    if (testHugePages()) {
+        printf("✓ Huge page test passed\n\n");
+        passCount++;
+    }
+    else {
+        printf("✗ Huge page test failed\n\n");
+        failCount++;
+    }
+
+    if (testNumaPlacement()) {
+        printf("✓ NUMA placement test passed\n\n");
+        passCount++;
+    }
+    else {
+        printf("✗ NUMA placement test failed\n\n");
+        failCount++;
+    }
+
+    if (testIncrementalCompaction()) {
+        printf("✓ Incremental compaction test passed\n\n");
+        passCount++;
+    }
+    else {
+        printf("✗ Incremental compaction test failed\n\n");
+        failCount++;
+    }
+
     /* Performance tests */
     runPerformanceTests();
 
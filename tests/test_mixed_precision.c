@@ -3,8 +3,11 @@
  * @brief Mixed precision quantization tests for TinyAI
  */
 
+#include "../core/config.h"
+#include "../utils/quant_aware_training.h"
 #include "../utils/quantize_mixed.h"
 #include "../utils/simd_ops.h"
+#include "../utils/thread_pool.h"
 #include <float.h>
 #include <math.h>
 #include <stdio.h>
@@ -362,6 +365,267 @@ static void test_mixed_precision_operations()
     printf("  PASS: Mixed precision matrix operations tests\n");
 }
 
+/**
+ * Test FP16 and INT2 weights multiplied in packed form against the dequantized weights
+ */
+static void test_mixed_precision_native_kernels()
+{
+    printf("Testing native mixed precision matrix multiplication...\n");
+
+    const int m = 4, k = 40, n = 36;
+    float    *a_data = create_test_matrix(m, k, 0);
+    float    *b_data = create_test_matrix(k, n, 1);
+    float    *a_float = (float *)malloc(m * k * sizeof(float));
+    float    *b_float = (float *)malloc(k * n * sizeof(float));
+
+    const char *names[5] = {"FP32", "FP16", "INT8", "INT4", "INT2"};
+    TinyAIMixedPrecType activations[2] = {TINYAI_MIXED_PREC_FP32, TINYAI_MIXED_PREC_INT8};
+
+    for (int w = TINYAI_MIXED_PREC_FP32; w <= TINYAI_MIXED_PREC_INT2; w++) {
+        TinyAIMixedPrecMatrix *b =
+            tinyaiCreateMixedPrecMatrix(b_data, k, n, (TinyAIMixedPrecType)w, 0.0f);
+        ASSERT(b != NULL, "Failed to create B matrix");
+        ASSERT(tinyaiMixedPrecToFloat(b, b_float), "Failed to dequantize B matrix");
+
+        for (int p = 0; p < 2; p++) {
+            TinyAIMixedPrecMatrix *a =
+                tinyaiCreateMixedPrecMatrix(a_data, m, k, activations[p], 0.0f);
+            ASSERT(a != NULL, "Failed to create A matrix");
+            ASSERT(tinyaiMixedPrecToFloat(a, a_float), "Failed to dequantize A matrix");
+
+            TinyAIMixedPrecMatrix c = {0};
+            c.rows                  = m;
+            c.cols                  = n;
+            c.precision             = TINYAI_MIXED_PREC_FP32;
+            c.dataSize              = m * n * sizeof(float);
+            c.data                  = malloc(c.dataSize);
+            ASSERT(tinyaiMixedPrecMatMul(a, b, &c), "Mixed precision matrix multiplication failed");
+
+            // The native product must match the product of the dequantized matrices
+            float  max_error = 0.0f, max_value = 0.0f;
+            float *c_data    = (float *)c.data;
+            for (int i = 0; i < m; i++) {
+                for (int j = 0; j < n; j++) {
+                    float sum = 0.0f;
+                    for (int l = 0; l < k; l++) {
+                        sum += a_float[i * k + l] * b_float[l * n + j];
+                    }
+                    max_error = fmaxf(max_error, fabsf(c_data[i * n + j] - sum));
+                    max_value = fmaxf(max_value, fabsf(sum));
+                }
+            }
+            printf("  %s x %s max error vs dequantized: %.6f\n", names[w], names[activations[p]],
+                   max_error);
+
+            // Integer kernels requantize the activations to symmetric int8 rows
+            bool  int8_kernel = activations[p] == TINYAI_MIXED_PREC_INT8 &&
+                               (w == TINYAI_MIXED_PREC_INT8 || w == TINYAI_MIXED_PREC_INT4);
+            float tolerance   = int8_kernel ? 0.02f * max_value : 1e-4f * (1.0f + max_value);
+            ASSERT(max_error <= tolerance, "Native product should match dequantized matrices");
+
+            free(c.data);
+            tinyaiFreeMixedPrecMatrix(a);
+        }
+
+        tinyaiFreeMixedPrecMatrix(b);
+    }
+
+    free(a_float);
+    free(b_float);
+    free(a_data);
+    free(b_data);
+
+    printf("  PASS: Native mixed precision matrix multiplication\n");
+}
+
+/**
+ * Test calibrated per-layer precision selection
+ */
+static void test_calibrated_precision()
+{
+    printf("Testing calibrated mixed precision selection...\n");
+
+    // Three layers; the middle one has a large outlier that coarsens its quantization steps
+    const int samples  = 40; // Not a multiple of the evaluation chunk
+    const int sizes[4] = {32, 48, 48, 16};
+    const int acts[3]  = {TINYAI_SIMD_ACTIVATION_RELU, -1, TINYAI_SIMD_ACTIVATION_SIGMOID};
+
+    TinyAICalibrationLayer layers[3];
+    float                 *weights[3];
+    float                 *biases[3];
+    for (int l = 0; l < 3; l++) {
+        int n      = sizes[l] * sizes[l + 1];
+        weights[l] = (float *)malloc(n * sizeof(float));
+        biases[l]  = (float *)malloc(sizes[l + 1] * sizeof(float));
+        for (int i = 0; i < n; i++) {
+            weights[l][i] = ((float)rand() / RAND_MAX - 0.5f) * 0.4f;
+        }
+        for (int i = 0; i < sizes[l + 1]; i++) {
+            biases[l][i] = ((float)rand() / RAND_MAX - 0.5f) * 0.1f;
+        }
+        layers[l].weights    = weights[l];
+        layers[l].biases     = biases[l];
+        layers[l].inputSize  = sizes[l];
+        layers[l].outputSize = sizes[l + 1];
+        layers[l].activation = acts[l];
+    }
+    weights[1][5] = 20.0f;
+
+    float *data = create_test_matrix(samples, sizes[0], 0);
+
+    TinyAIMixedPrecConfig *config = tinyaiCreateDefaultMixedPrecConfig(3);
+    ASSERT(config != NULL, "Failed to create mixed precision config");
+
+    // Any error fits an unlimited budget, none fits a zero budget
+    ASSERT(tinyaiCalibrateMixedPrecision(layers, 3, data, samples, FLT_MAX, config),
+           "Calibration should succeed");
+    for (int l = 0; l < 3; l++) {
+        ASSERT(config->layerConfigs[l].weightPrecision == TINYAI_MIXED_PREC_INT2,
+               "An unlimited budget should select INT2");
+    }
+    ASSERT(tinyaiCalibrateMixedPrecision(layers, 3, data, samples, 0.0f, config),
+           "Calibration should succeed");
+    for (int l = 0; l < 3; l++) {
+        ASSERT(config->layerConfigs[l].weightPrecision == TINYAI_MIXED_PREC_FP32,
+               "A zero budget should keep FP32");
+    }
+
+    // The outlier layer needs more bits than the others for the same budget
+    ASSERT(tinyaiCalibrateMixedPrecision(layers, 3, data, samples, 1e-3f, config),
+           "Calibration should succeed");
+    TinyAIMixedPrecType serial[3];
+    for (int l = 0; l < 3; l++) {
+        serial[l] = config->layerConfigs[l].weightPrecision;
+        printf("    Layer %d: %d bits\n", l, tinyaiGetPrecisionBits(serial[l]));
+    }
+    ASSERT(tinyaiGetPrecisionBits(serial[1]) > tinyaiGetPrecisionBits(serial[0]),
+           "The outlier layer should get more bits");
+    ASSERT(serial[0] != TINYAI_MIXED_PREC_FP32 && serial[2] != TINYAI_MIXED_PREC_FP32,
+           "Well-conditioned layers should be quantized");
+
+    // Evaluating the candidates concurrently gives the same selection
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+    ASSERT(tinyaiCalibrateMixedPrecision(layers, 3, data, samples, 1e-3f, config),
+           "Threaded calibration should succeed");
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    for (int l = 0; l < 3; l++) {
+        ASSERT(config->layerConfigs[l].weightPrecision == serial[l],
+               "Threaded calibration should match the serial selection");
+    }
+
+    // Mismatched layer sizes are rejected
+    layers[2].inputSize = 47;
+    ASSERT(!tinyaiCalibrateMixedPrecision(layers, 3, data, samples, 1e-3f, config),
+           "Mismatched layer sizes should fail");
+
+    for (int l = 0; l < 3; l++) {
+        free(weights[l]);
+        free(biases[l]);
+    }
+    free(data);
+    tinyaiFreeMixedPrecConfig(config);
+
+    printf("  PASS: Calibrated mixed precision selection\n");
+}
+
+/**
+ * Train two layers with 8-bit fake quantization and check the loss falls
+ */
+static float train_quant_aware(float *weights[2], float *biases[2], const float *inputs,
+                               const float *targets, int samples, int epochs, int freeze)
+{
+    TinyAIQuantAwareLayer layers[2] = {
+        {weights[0], biases[0], 8, 16, TINYAI_SIMD_ACTIVATION_TANH},
+        {weights[1], biases[1], 16, 4, -1},
+    };
+
+    TinyAIQuantAwareTrainingConfig *config = tinyaiCreateDefaultQuantAwareTrainingConfig();
+    ASSERT(config != NULL, "Failed to create training config");
+    config->learningRate      = 0.05f;
+    config->batchSize         = 12; // Does not divide the sample count
+    config->numEpochs         = epochs;
+    config->useNoiseInjection = false;
+
+    float loss = -1.0f;
+    ASSERT(tinyaiQuantAwareTrainLayers(layers, 2, freeze, inputs, targets, samples, config, &loss),
+           "Quantization-aware training should succeed");
+    free(config);
+    return loss;
+}
+
+static void test_quant_aware_training()
+{
+    printf("Testing mini-batched quantization-aware training...\n");
+
+    const int samples = 64;
+    float    *inputs  = (float *)malloc(samples * 8 * sizeof(float));
+    float    *targets = (float *)malloc(samples * 4 * sizeof(float));
+    for (int i = 0; i < samples * 8; i++) {
+        inputs[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+    }
+    for (int i = 0; i < samples; i++) {
+        for (int j = 0; j < 4; j++) {
+            targets[i * 4 + j] = 0.5f * inputs[i * 8 + j] - 0.25f * inputs[i * 8 + j + 4];
+        }
+    }
+
+    // Two copies of the same initial weights: serial and threaded runs
+    float *weights[2][2], *biases[2][2];
+    for (int run = 0; run < 2; run++) {
+        weights[run][0] = (float *)malloc(8 * 16 * sizeof(float));
+        weights[run][1] = (float *)malloc(16 * 4 * sizeof(float));
+        biases[run][0]  = (float *)calloc(16, sizeof(float));
+        biases[run][1]  = (float *)calloc(4, sizeof(float));
+    }
+    for (int i = 0; i < 8 * 16; i++) {
+        weights[0][0][i] = weights[1][0][i] = ((float)rand() / RAND_MAX - 0.5f) * 0.5f;
+    }
+    for (int i = 0; i < 16 * 4; i++) {
+        weights[0][1][i] = weights[1][1][i] = ((float)rand() / RAND_MAX - 0.5f) * 0.5f;
+    }
+
+    float first = train_quant_aware(weights[0], biases[0], inputs, targets, samples, 1, 0);
+    float final = train_quant_aware(weights[0], biases[0], inputs, targets, samples, 300, 0);
+    printf("    Loss after 1 epoch: %.6f, after 301 epochs: %.6f\n", first, final);
+    ASSERT(final < 0.25f * first, "Training should reduce the loss");
+
+    // Per-thread gradient buffers only change the summation order
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+    train_quant_aware(weights[1], biases[1], inputs, targets, samples, 1, 0);
+    float threaded = train_quant_aware(weights[1], biases[1], inputs, targets, samples, 300, 0);
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    printf("    Threaded loss: %.6f\n", threaded);
+    ASSERT(fabsf(threaded - final) <= 0.05f * final + 1e-6f,
+           "Threaded training should match the serial loss");
+
+    // Frozen layers keep their weights
+    float frozen[8 * 16];
+    memcpy(frozen, weights[0][0], sizeof(frozen));
+    train_quant_aware(weights[0], biases[0], inputs, targets, samples, 5, 1);
+    ASSERT(memcmp(frozen, weights[0][0], sizeof(frozen)) == 0, "Frozen layers should not change");
+
+    for (int run = 0; run < 2; run++) {
+        for (int l = 0; l < 2; l++) {
+            free(weights[run][l]);
+            free(biases[run][l]);
+        }
+    }
+    free(inputs);
+    free(targets);
+
+    printf("  PASS: Mini-batched quantization-aware training\n");
+}
+
 /**
  * Run all mixed precision tests
  */
@@ -376,6 +640,9 @@ int main()
     test_precision_quantization();
     test_per_layer_mixed_precision();
     test_mixed_precision_operations();
+    test_mixed_precision_native_kernels();
+    test_calibrated_precision();
+    test_quant_aware_training();
 
     printf("All Mixed Precision Quantization Tests PASSED\n");
     return 0;
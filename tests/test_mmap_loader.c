@@ -3,8 +3,10 @@
  * @brief Tests for memory-mapped model loading and forward pass scheduling
  */
 
+#include "../utils/compress.h"
 #include "../utils/forward_scheduler.h"
 #include "../utils/mmap_loader.h"
+#include "../utils/progressive_loader.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +15,12 @@
 /* Test model file path */
 #define TEST_MODEL_FILE "data/test_model.tmai"
 
+/* Test batch size cache path */
+#define TEST_BATCH_CACHE_FILE "data/test_batch_cache.txt"
+
+/* Test tensor container path */
+#define TEST_CONTAINER_FILE "data/test_container.tqtc"
+
 /* Test model dimensions */
 #define TEST_MODEL_LAYERS 10
 #define TEST_LAYER_SIZE (1024 * 1024) /* 1MB per layer */
@@ -165,6 +173,493 @@ static bool testMmapLoading()
     return true;
 }
 
+/* Test that zero-copy layers point into the mapping, and copies are made without it */
+static bool testZeroCopyWeights()
+{
+    printf("Testing zero-copy layer weights...\n");
+
+    TinyAIMmapConfig config = tinyaiCreateDefaultMmapConfig();
+    config.prefetchEnabled  = false;
+    config.maxCacheSize     = 2 * TEST_LAYER_SIZE;
+    bool ok                 = true;
+
+    for (int zeroCopy = 1; ok && zeroCopy >= 0; zeroCopy--) {
+        config.zeroCopy          = zeroCopy != 0;
+        TinyAIMappedModel *model = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+        if (!model) {
+            printf("Failed to open model\n");
+            return false;
+        }
+
+        /* Layers are stored back to back, so in-place pointers are one layer apart */
+        unsigned char *first  = (unsigned char *)tinyaiGetLayerWeights(model, 0);
+        unsigned char *second = (unsigned char *)tinyaiGetLayerWeights(model, 1);
+
+        ok = first && second && first[TEST_LAYER_SIZE - 1] == 0 && second[0] == 1;
+        if (ok && (second - first == TEST_LAYER_SIZE) != config.zeroCopy) {
+            printf("Layer weights were %s\n", config.zeroCopy ? "copied" : "not copied");
+            ok = false;
+        }
+
+        /* Pinned layers count against the cache, and layers past it are still served */
+        ok = ok && tinyaiGetMappedModelMemoryUsage(model) == 2 * TEST_LAYER_SIZE;
+
+        unsigned char *third = (unsigned char *)tinyaiGetLayerWeights(model, 2);
+        ok                   = ok && third && third[0] == 2 &&
+             tinyaiGetMappedModelMemoryUsage(model) <= 2 * TEST_LAYER_SIZE;
+
+        /* Released layers come back intact */
+        for (int i = 0; i < TEST_MODEL_LAYERS; i++) {
+            tinyaiReleaseLayerWeights(model, i);
+        }
+        ok     = ok && tinyaiGetMappedModelMemoryUsage(model) == 0;
+        second = (unsigned char *)tinyaiGetLayerWeights(model, 1);
+        ok     = ok && second && second[0] == 1 && second[TEST_LAYER_SIZE - 1] == 1;
+        if (!ok) {
+            printf("Layer weights are wrong with zero-copy %s\n", config.zeroCopy ? "on" : "off");
+        }
+
+        tinyaiCloseMappedModel(model);
+    }
+
+    if (ok) {
+        printf("Zero-copy layer weights test passed\n");
+    }
+    return ok;
+}
+
+/* Test that touching zero-copy weights makes their pages resident */
+static bool testMappingResidency()
+{
+    printf("Testing mapping residency...\n");
+
+    TinyAIMmapConfig config = tinyaiCreateDefaultMmapConfig();
+    config.prefetchEnabled  = false;
+    config.zeroCopy         = true;
+    TinyAIMappedModel *model = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+    if (!model) {
+        printf("Failed to open model\n");
+        return false;
+    }
+
+    const unsigned char *weights = (const unsigned char *)tinyaiGetLayerWeights(model, 3);
+    unsigned int         sum     = 0;
+    for (size_t i = 0; weights && i < TEST_LAYER_SIZE; i++) {
+        sum += weights[i];
+    }
+
+    /* Every page was read; partly covered pages at the ends count whole */
+    size_t resident = tinyaiGetMappingResidentBytes(weights, TEST_LAYER_SIZE);
+    bool   ok       = weights && sum == 3u * TEST_LAYER_SIZE &&
+               (resident == 0 || /* Not measurable here */
+                (resident >= TEST_LAYER_SIZE && resident <= TEST_LAYER_SIZE + 2 * 65536));
+    ok = ok && tinyaiGetMappingResidentBytes(NULL, TEST_LAYER_SIZE) == 0 &&
+         tinyaiGetMappingResidentBytes(weights, 0) == 0;
+
+    tinyaiCloseMappedModel(model);
+    if (ok) {
+        printf("Mapping residency test passed\n");
+    }
+    else {
+        printf("Mapped weights report %zu resident bytes\n", resident);
+    }
+    return ok;
+}
+
+/* Test that a progressive loader keeps a layer-by-layer pass within its budget */
+static bool testProgressiveLoading()
+{
+    printf("Testing progressive loading...\n");
+
+    TinyAIProgressiveConfig config;
+    memset(&config, 0, sizeof(config));
+    config.max_memory        = 3 * TEST_LAYER_SIZE;
+    config.enable_prefetch   = true;
+    config.prefetch_distance = 2;
+
+    TinyAIProgressiveLoader *loader = tinyaiCreateProgressiveLoader(TEST_MODEL_FILE, &config);
+    if (!loader || loader->num_layers != TEST_MODEL_LAYERS) {
+        printf("Failed to create progressive loader\n");
+        tinyaiFreeProgressiveLoader(loader);
+        return false;
+    }
+
+    /* Two passes request and release each layer in turn */
+    bool ok = true;
+    for (int pass = 0; ok && pass < 2; pass++) {
+        for (size_t i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+            ok = tinyaiRequestLayer(loader, i);
+            const unsigned char *weights =
+                (const unsigned char *)tinyaiGetLoadedLayerWeights(loader, i);
+            ok = ok && weights && weights[0] == i && weights[TEST_LAYER_SIZE - 1] == i &&
+                 tinyaiGetMemoryUsage(loader) <= config.max_memory;
+            tinyaiReleaseLayer(loader, i);
+        }
+    }
+    if (!ok || tinyaiGetPeakMemoryUsage(loader) != config.max_memory) {
+        printf("Pass exceeded the budget or read wrong weights\n");
+        ok = false;
+    }
+
+    /* The least recently used layers were evicted */
+    for (size_t i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+        bool loaded = tinyaiGetLayerState(loader, i) == TINYAI_LAYER_STATE_LOADED;
+        if (loaded != (i >= TEST_MODEL_LAYERS - 3)) {
+            printf("Layer %zu was %s\n", i, loaded ? "kept" : "evicted");
+            ok = false;
+        }
+    }
+
+    /* A higher priority layer outlives more recently used ones */
+    ok = ok && tinyaiUpdateLayerPriority(loader, 0, TINYAI_LAYER_PRIORITY_HIGH) &&
+         tinyaiRequestLayer(loader, 0);
+    tinyaiReleaseLayer(loader, 0);
+    for (size_t i = 1; ok && i < TEST_MODEL_LAYERS; i++) {
+        ok = tinyaiRequestLayer(loader, i);
+        tinyaiReleaseLayer(loader, i);
+    }
+    if (ok && tinyaiGetLayerState(loader, 0) != TINYAI_LAYER_STATE_LOADED) {
+        printf("High priority layer was evicted\n");
+        ok = false;
+    }
+
+    /* Requested layers are never evicted */
+    ok = ok && tinyaiRequestLayer(loader, 1) && tinyaiRequestLayer(loader, 2) &&
+         tinyaiRequestLayer(loader, 3);
+    if (ok && (tinyaiRequestLayer(loader, 4) || tinyaiUnloadLayer(loader, 2))) {
+        printf("Loader evicted a requested layer\n");
+        ok = false;
+    }
+    tinyaiReleaseLayer(loader, 1);
+    ok = ok && tinyaiRequestLayer(loader, 4) &&
+         tinyaiGetLayerState(loader, 1) == TINYAI_LAYER_STATE_UNLOADED &&
+         tinyaiGetLayerState(loader, 2) == TINYAI_LAYER_STATE_LOADED;
+    for (size_t i = 2; i <= 4; i++) {
+        tinyaiReleaseLayer(loader, i);
+    }
+
+    /* A smaller budget evicts down to it */
+    TinyAIProgressiveConfig smaller = config;
+    smaller.max_memory              = TEST_LAYER_SIZE;
+    ok = ok && tinyaiSetLoaderConfig(loader, &smaller) &&
+         tinyaiGetMemoryUsage(loader) <= TEST_LAYER_SIZE;
+
+    tinyaiFreeProgressiveLoader(loader);
+    if (ok) {
+        printf("Progressive loading test passed\n");
+    }
+    return ok;
+}
+
+/* Test that the scheduler prefetches layers ahead of execution on several threads */
+static bool testScheduledPrefetch()
+{
+    printf("Testing scheduled prefetching...\n");
+
+    TinyAIMmapConfig config  = tinyaiCreateDefaultMmapConfig();
+    config.prefetchThreads   = 4;
+    TinyAIMappedModel *model = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+    if (!model) {
+        printf("Failed to open model\n");
+        return false;
+    }
+
+    TinyAIForwardScheduler *scheduler =
+        tinyaiCreateForwardScheduler(model, TINYAI_EXEC_MEMORY_OPT, TEST_MEMORY_LIMIT);
+    bool ok = scheduler && tinyaiSetSchedulerPrefetchDistance(scheduler, 3);
+    for (int i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+        ok = tinyaiAddLayerToSchedule(scheduler, i, i - 1,
+                                      i > 0 ? TINYAI_DEP_SEQUENTIAL : TINYAI_DEP_NONE, 1024);
+    }
+    ok = ok && tinyaiPrepareForwardPass(scheduler);
+
+    int executed = 0;
+    while (ok && tinyaiExecuteNextLayer(scheduler, NULL, NULL, NULL)) {
+        executed++;
+    }
+
+    /* Only the first layer is looked up unannounced; each later one was requested once */
+    TinyAIPrefetchStats stats;
+    ok = ok && executed == TEST_MODEL_LAYERS && tinyaiGetPrefetchStats(model, &stats) &&
+         stats.misses == 1 && stats.requested == TEST_MODEL_LAYERS - 1 && stats.dropped == 0 &&
+         stats.hits + stats.late == TEST_MODEL_LAYERS - 1;
+    if (ok) {
+        printf("Prefetch hits %llu, late %llu\n", (unsigned long long)stats.hits,
+               (unsigned long long)stats.late);
+    }
+    else {
+        printf("Scheduled prefetching did not cover the execution order\n");
+    }
+
+    tinyaiDestroyForwardScheduler(scheduler);
+    tinyaiCloseMappedModel(model);
+    return ok;
+}
+
+/* Values in each activation of the parallel forward pass test */
+#define BRANCH_VALUES 4096
+
+/* Adds the layer index to every value, counting the calls of each layer */
+static bool addLayerIndex(void *userData, int layerIndex, const void *input, void *output)
+{
+    const float *in  = (const float *)input;
+    float       *out = (float *)output;
+    if (!in || !out) {
+        return false;
+    }
+    for (int i = 0; i < BRANCH_VALUES; i++) {
+        out[i] = in[i] + (float)layerIndex;
+    }
+    ((int *)userData)[layerIndex]++;
+    return true;
+}
+
+/* Run a four-branch schedule: 0 feeds 1-4, each feeds one of 5-8, and 9 follows 8 */
+static bool runBranchingPass(TinyAIMappedModel *model, TinyAIThreadPool *pool, size_t maxMemory,
+                             float *output)
+{
+    const size_t            outputSize = BRANCH_VALUES * sizeof(float);
+    TinyAIForwardScheduler *scheduler =
+        tinyaiCreateForwardScheduler(model, TINYAI_EXEC_MEMORY_OPT, maxMemory);
+    int  calls[TEST_MODEL_LAYERS] = {0};
+    bool ok = scheduler && tinyaiSetLayerExecuteFunction(scheduler, addLayerIndex, calls) &&
+              tinyaiAddLayerToSchedule(scheduler, 0, -1, TINYAI_DEP_NONE, outputSize);
+    for (int i = 1; ok && i < TEST_MODEL_LAYERS; i++) {
+        int dependsOn = i <= 4 ? 0 : i <= 8 ? i - 4 : 8;
+        ok = tinyaiAddLayerToSchedule(scheduler, i, dependsOn, TINYAI_DEP_RESIDUAL, outputSize);
+    }
+
+    float input[BRANCH_VALUES];
+    for (int i = 0; i < BRANCH_VALUES; i++) {
+        input[i] = (float)i;
+    }
+    ok = ok && tinyaiPrepareForwardPass(scheduler) &&
+         tinyaiExecuteForwardPass(scheduler, pool, input, output);
+
+    /* Only the final output is still held once the pass is done */
+    ok = ok && tinyaiGetSchedulerMemoryUsage(scheduler) <= outputSize;
+    for (int i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+        ok = tinyaiIsLayerExecuted(scheduler, i) && calls[i] == 1;
+    }
+
+    tinyaiDestroyForwardScheduler(scheduler);
+    return ok;
+}
+
+/* Test that independent layers run in parallel with the same result as a serial pass */
+static bool testParallelForwardPass()
+{
+    printf("Testing parallel forward pass...\n");
+
+    TinyAIMmapConfig   config = tinyaiCreateDefaultMmapConfig();
+    TinyAIMappedModel *model  = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+    TinyAIThreadPool  *pool   = tinyaiCreateThreadPool(4, 1);
+    if (!model || !pool) {
+        printf("Failed to open model or create thread pool\n");
+        tinyaiCloseMappedModel(model);
+        tinyaiDestroyThreadPool(pool);
+        return false;
+    }
+
+    float *serial   = (float *)malloc(BRANCH_VALUES * sizeof(float));
+    float *parallel = (float *)malloc(BRANCH_VALUES * sizeof(float));
+    float *limited  = (float *)malloc(BRANCH_VALUES * sizeof(float));
+
+    /* A limit of two activations still finishes, running over it one layer at a time */
+    bool ok = serial && parallel && limited && runBranchingPass(model, NULL, 0, serial) &&
+              runBranchingPass(model, pool, 0, parallel) &&
+              runBranchingPass(model, pool, 2 * BRANCH_VALUES * sizeof(float), limited);
+    for (int i = 0; ok && i < BRANCH_VALUES; i++) {
+        /* The final layer sees layers 0, 4 and 8 of its branch */
+        ok = serial[i] == (float)i + 0.0f + 4.0f + 8.0f + 9.0f && parallel[i] == serial[i] &&
+             limited[i] == serial[i];
+    }
+    if (!ok) {
+        printf("Parallel forward pass did not match the serial pass\n");
+    }
+
+    free(serial);
+    free(parallel);
+    free(limited);
+    tinyaiDestroyThreadPool(pool);
+    tinyaiCloseMappedModel(model);
+    return ok;
+}
+
+/* Test that a streamed batch goes through a pipeline of stages with the serial result */
+static bool testStreamingPass()
+{
+    printf("Testing streaming pipeline...\n");
+
+    TinyAIMmapConfig   config = tinyaiCreateDefaultMmapConfig();
+    TinyAIMappedModel *model  = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+    if (!model) {
+        printf("Failed to open model\n");
+        return false;
+    }
+
+    const size_t            items      = 32;
+    const size_t            outputSize = BRANCH_VALUES * sizeof(float);
+    TinyAIForwardScheduler *scheduler =
+        tinyaiCreateForwardScheduler(model, TINYAI_EXEC_STREAMING, 0);
+    int  calls[TEST_MODEL_LAYERS] = {0};
+    bool ok = scheduler && tinyaiSetLayerExecuteFunction(scheduler, addLayerIndex, calls);
+    for (int i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+        ok = tinyaiAddLayerToSchedule(scheduler, i, i - 1,
+                                      i > 0 ? TINYAI_DEP_SEQUENTIAL : TINYAI_DEP_NONE, outputSize);
+    }
+
+    float       *data    = (float *)malloc(2 * items * outputSize);
+    const void **inputs  = (const void **)malloc(items * sizeof(void *));
+    void       **outputs = (void **)malloc(items * sizeof(void *));
+    ok                   = ok && data && inputs && outputs;
+    for (size_t item = 0; ok && item < items; item++) {
+        float *input  = data + item * BRANCH_VALUES;
+        inputs[item]  = input;
+        outputs[item] = data + (items + item) * BRANCH_VALUES;
+        for (int i = 0; i < BRANCH_VALUES; i++) {
+            input[i] = (float)(i + item);
+        }
+    }
+
+    /* Three stages over ten layers; every layer sees every item once, in order */
+    ok = ok && tinyaiExecuteStream(scheduler, 3, inputs, outputs, items);
+    for (int i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+        ok = calls[i] == (int)items;
+    }
+    for (size_t item = 0; ok && item < items; item++) {
+        const float *output = (const float *)outputs[item];
+        for (int i = 0; ok && i < BRANCH_VALUES; i++) {
+            ok = output[i] == (float)(i + item) + 45.0f;
+        }
+    }
+    if (!ok) {
+        printf("Streamed outputs did not match the layer chain\n");
+    }
+
+    /* A layer that skips back to an earlier one cannot be pipelined */
+    ok = ok && tinyaiAddLayerToSchedule(scheduler, 0, 3, TINYAI_DEP_RESIDUAL, outputSize) &&
+         !tinyaiExecuteStream(scheduler, 3, inputs, outputs, items);
+
+    free(data);
+    free(inputs);
+    free(outputs);
+    tinyaiDestroyForwardScheduler(scheduler);
+    tinyaiCloseMappedModel(model);
+    return ok;
+}
+
+/* Batch cost of the calibration test: 2ms plus 0.25ms per sample, spent spinning */
+static bool runModeledBatch(void *userData, int batchSize)
+{
+    int    *runs = (int *)userData;
+    clock_t end  = clock() + (clock_t)((2.0 + 0.25 * batchSize) * CLOCKS_PER_SEC / 1000.0);
+    while (clock() < end) {
+    }
+    (*runs)++;
+    return true;
+}
+
+/* Test that calibration picks the throughput knee under the SLO and caches it */
+static bool testBatchCalibration()
+{
+    printf("Testing batch size calibration...\n");
+
+    TinyAIMmapConfig   config = tinyaiCreateDefaultMmapConfig();
+    TinyAIMappedModel *model  = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+    if (!model) {
+        printf("Failed to open model\n");
+        return false;
+    }
+
+    TinyAIBatchCalibrationConfig calibration;
+    tinyaiGetDefaultBatchCalibrationConfig(&calibration);
+    calibration.maxBatchSize = 64;
+    calibration.latencySloNs = 7000000;
+    calibration.cachePath    = TEST_BATCH_CACHE_FILE;
+    remove(TEST_BATCH_CACHE_FILE);
+
+    /* 32 samples take 10ms; of the rest, 16 is within 90% of the best throughput */
+    TinyAIForwardScheduler *scheduler = tinyaiCreateForwardScheduler(model, TINYAI_EXEC_NORMAL, 0);
+    TinyAIBatchCalibration  result    = {0};
+    int                     runs      = 0;
+    bool ok = scheduler && tinyaiCalibrateBatchSize(scheduler, &calibration, runModeledBatch,
+                                                    &runs, &result);
+    ok      = ok && result.batchSize == 16 && !result.cached && runs > 0;
+    ok      = ok && tinyaiCalculateOptimalBatchSize(scheduler, 1024, 1024, 64) == 16;
+    ok      = ok && tinyaiCalculateOptimalBatchSize(scheduler, 1024, 1024, 4) == 4;
+    tinyaiDestroyForwardScheduler(scheduler);
+    if (!ok) {
+        printf("Calibration chose batch size %d\n", result.batchSize);
+    }
+
+    /* The same model on the same host reuses the cached result */
+    scheduler = tinyaiCreateForwardScheduler(model, TINYAI_EXEC_NORMAL, 0);
+    runs      = 0;
+    ok        = ok && scheduler &&
+         tinyaiCalibrateBatchSize(scheduler, &calibration, runModeledBatch, &runs, &result) &&
+         result.cached && result.batchSize == 16 && runs == 0 &&
+         tinyaiCalculateOptimalBatchSize(scheduler, 1024, 1024, 64) == 16;
+
+    /* An SLO below one sample serves unbatched */
+    calibration.latencySloNs = 1000000;
+    ok = ok && tinyaiCalibrateBatchSize(scheduler, &calibration, runModeledBatch, &runs, &result) &&
+         result.batchSize == 1 && !result.cached;
+    tinyaiDestroyForwardScheduler(scheduler);
+
+    remove(TEST_BATCH_CACHE_FILE);
+    tinyaiCloseMappedModel(model);
+    return ok;
+}
+
+/* Test reading layers with the read backend, on demand and through the prefetch threads */
+static bool testReadBackend()
+{
+    printf("Testing read backend...\n");
+
+    TinyAIMmapConfig config  = tinyaiCreateDefaultMmapConfig();
+    config.backend           = TINYAI_WEIGHTS_READ;
+    config.prefetchThreads   = 2;
+    config.maxCacheSize      = 4 * TEST_LAYER_SIZE;
+    config.hugePages         = true;
+    TinyAIMappedModel *model = tinyaiOpenMappedModel(TEST_MODEL_FILE, &config);
+    if (!model || tinyaiGetMappedLayerCount(model) != TEST_MODEL_LAYERS) {
+        printf("Failed to open model for reading\n");
+        tinyaiCloseMappedModel(model);
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; ok && i < TEST_MODEL_LAYERS; i++) {
+        /* Request the next layer, as the scheduler would */
+        if (i + 1 < TEST_MODEL_LAYERS) {
+            tinyaiRequestLayerPrefetch(model, i + 1);
+        }
+
+        unsigned char *weights = (unsigned char *)tinyaiGetLayerWeights(model, i);
+        ok = weights && (uintptr_t)weights % TINYAI_CONTAINER_ALIGNMENT == 0 && weights[0] == i &&
+             weights[TEST_LAYER_SIZE - 1] == i;
+        tinyaiReleaseLayerWeights(model, i);
+    }
+
+    /* Layer buffers come from huge pages where the system has them, else the fallback */
+    TinyAIPrefetchStats stats;
+    size_t              hugePageBytes, advisedBytes;
+    ok = ok && tinyaiGetPrefetchStats(model, &stats) && stats.misses == 1 &&
+         stats.hits + stats.late == TEST_MODEL_LAYERS - 1 &&
+         tinyaiGetMappedModelMemoryUsage(model) <= config.maxCacheSize &&
+         tinyaiGetMappedModelHugePages(model, &hugePageBytes, &advisedBytes);
+    if (!ok) {
+        printf("Read layers are wrong\n");
+    }
+
+    tinyaiCloseMappedModel(model);
+    if (ok) {
+        printf("Read backend test passed\n");
+    }
+    return ok;
+}
+
 /* Test forward pass scheduling */
 static bool testForwardScheduling()
 {
@@ -250,6 +745,302 @@ static bool testForwardScheduling()
     return true;
 }
 
+/* Fill a 4-bit matrix with a deterministic pattern */
+static void fillMatrix4bit(TinyAIMatrix4bit *matrix)
+{
+    size_t size = tinyaiMatrix4bitDataSize(matrix);
+    for (size_t i = 0; i < size; i++) {
+        matrix->data[i] = (uint8_t)(i * 37 + 11);
+    }
+    matrix->scale     = 0.05f;
+    matrix->zeroPoint = -0.4f;
+
+    size_t groups = tinyaiMatrix4bitGroupCount(matrix);
+    for (size_t g = 0; g < groups; g++) {
+        matrix->scales[g]     = 0.01f * (float)(g % 7 + 1);
+        matrix->zeroPoints[g] = -0.02f * (float)(g % 5);
+    }
+}
+
+/* Multiply a mapped 4-bit tensor and compare against the original matrix */
+static bool compareMappedMatMul(TinyAIMappedModel *model, const char *name,
+                                const TinyAIMatrix4bit *original)
+{
+    TinyAIMatrix4bit mapped;
+    int              index = tinyaiFindMappedTensor(model, name);
+    if (index < 0 || !tinyaiGetMappedMatrix4bit(model, index, &mapped)) {
+        printf("Tensor %s not found\n", name);
+        return false;
+    }
+    if (((uintptr_t)mapped.data % TINYAI_CONTAINER_ALIGNMENT) != 0 ||
+        mapped.layout != original->layout) {
+        printf("Tensor %s is misaligned or lost its layout\n", name);
+        return false;
+    }
+
+    const uint32_t count    = 3;
+    float         *input    = (float *)malloc(count * original->rows * sizeof(float));
+    float         *expected = (float *)malloc(count * original->cols * sizeof(float));
+    float         *actual   = (float *)malloc(count * original->cols * sizeof(float));
+    bool           ok       = input && expected && actual;
+    for (uint32_t i = 0; ok && i < count * original->rows; i++) {
+        input[i] = (float)((int)(i % 13) - 6) * 0.25f;
+    }
+
+    ok = ok && tinyaiMatrix4bitMatMul(original, input, count, NULL, expected) == 0 &&
+         tinyaiMatrix4bitMatMul(&mapped, input, count, NULL, actual) == 0 &&
+         memcmp(expected, actual, count * original->cols * sizeof(float)) == 0;
+    if (!ok) {
+        printf("Mapped tensor %s does not match the original\n", name);
+    }
+
+    free(input);
+    free(expected);
+    free(actual);
+    return ok;
+}
+
+/* Test writing and mapping a quantized tensor container */
+static bool testTensorContainer()
+{
+    printf("Testing quantized tensor container...\n");
+
+    TinyAIMatrix4bit *grouped = tinyaiCreateMatrix4bitGrouped(24, 40, 16);
+    TinyAIMatrix4bit *packed  = tinyaiCreateMatrix4bit(64, 48);
+    float             fp32Data[6] = {1.0f, -2.0f, 3.5f, 0.0f, 0.25f, -8.0f};
+    int8_t            int8Data[6] = {-128, -1, 0, 1, 64, 127};
+    TinyAIMatrixFP32  fp32        = {fp32Data, 2, 3};
+    TinyAIMatrix8bit  int8        = {int8Data, 3, 2, 0.5f, 1.0f};
+    if (!grouped || !packed) {
+        printf("Failed to create test matrices\n");
+        tinyaiDestroyMatrix4bit(grouped);
+        tinyaiDestroyMatrix4bit(packed);
+        return false;
+    }
+    fillMatrix4bit(grouped);
+    fillMatrix4bit(packed);
+    tinyaiMatrix4bitPrepack(packed);
+
+    TinyAIContainerTensor tensors[] = {
+        {"embed", &fp32, TINYAI_PRECISION_FP32, TINYAI_COMPRESSION_NONE},
+        {"attn.grouped", grouped, TINYAI_PRECISION_INT4, TINYAI_COMPRESSION_NONE},
+        {"ffn.packed", packed, TINYAI_PRECISION_INT4, TINYAI_COMPRESSION_NONE},
+        {"head", &int8, TINYAI_PRECISION_INT8, TINYAI_COMPRESSION_NONE},
+    };
+
+    bool ok = tinyaiWriteTensorContainer(TEST_CONTAINER_FILE, tensors, 4, true);
+    if (!ok) {
+        printf("Failed to write tensor container\n");
+    }
+
+    /* Duplicate names are rejected */
+    TinyAIContainerTensor duplicate[] = {tensors[0], tensors[0]};
+    if (ok && tinyaiWriteTensorContainer(TEST_CONTAINER_FILE ".dup", duplicate, 2, false)) {
+        printf("Duplicate tensor names were accepted\n");
+        ok = false;
+    }
+
+    TinyAIMmapConfig config = tinyaiCreateDefaultMmapConfig();
+    config.prefetchEnabled  = false;
+    TinyAIMappedModel *model = ok ? tinyaiOpenMappedModel(TEST_CONTAINER_FILE, &config) : NULL;
+    if (ok && (!model || tinyaiGetMappedLayerCount(model) != 4)) {
+        printf("Failed to map tensor container\n");
+        ok = false;
+    }
+
+    TinyAIMappedTensor tensor;
+    if (ok && (!tinyaiGetMappedTensor(model, tinyaiFindMappedTensor(model, "embed"), &tensor) ||
+               tensor.precision != TINYAI_PRECISION_FP32 || tensor.rows != 2 ||
+               memcmp(tensor.data, fp32Data, sizeof(fp32Data)) != 0)) {
+        printf("FP32 tensor does not round-trip\n");
+        ok = false;
+    }
+    if (ok && (!tinyaiGetMappedTensor(model, tinyaiFindMappedTensor(model, "head"), &tensor) ||
+               tensor.precision != TINYAI_PRECISION_INT8 || tensor.scale != 0.5f ||
+               memcmp(tensor.data, int8Data, sizeof(int8Data)) != 0)) {
+        printf("INT8 tensor does not round-trip\n");
+        ok = false;
+    }
+    if (ok && tinyaiFindMappedTensor(model, "missing") != -1) {
+        printf("Found a missing tensor\n");
+        ok = false;
+    }
+
+    ok = ok && compareMappedMatMul(model, "attn.grouped", grouped) &&
+         compareMappedMatMul(model, "ffn.packed", packed);
+
+    for (int i = 0; ok && i < 4; i++) {
+        if (!tinyaiVerifyMappedTensor(model, i)) {
+            printf("Checksum mismatch in tensor %d\n", i);
+            ok = false;
+        }
+    }
+    tinyaiCloseMappedModel(model);
+
+    /* The read backend serves a container's tensors as layers, but has no views into it */
+    if (ok) {
+        config.backend = TINYAI_WEIGHTS_READ;
+        model          = tinyaiOpenMappedModel(TEST_CONTAINER_FILE, &config);
+        int   index    = model ? tinyaiFindMappedTensor(model, "embed") : -1;
+        void *weights  = index >= 0 ? tinyaiGetLayerWeights(model, index) : NULL;
+        if (!weights || memcmp(weights, fp32Data, sizeof(fp32Data)) != 0 ||
+            tinyaiGetMappedTensor(model, index, &tensor)) {
+            printf("Read container tensor does not round-trip\n");
+            ok = false;
+        }
+        tinyaiCloseMappedModel(model);
+        config.backend = TINYAI_WEIGHTS_MMAP;
+    }
+
+    /* Corrupt one byte of the grouped tensor's scales and verify again */
+    if (ok) {
+        model = tinyaiOpenMappedModel(TEST_CONTAINER_FILE, &config);
+        int index = tinyaiFindMappedTensor(model, "attn.grouped");
+        ok        = index >= 0 && tinyaiGetMappedTensor(model, index, &tensor);
+        long scalesOffset =
+            ok ? (long)((const uint8_t *)tensor.scales - (const uint8_t *)tensor.data) : 0;
+        long dataOffset = 0;
+        if (ok) {
+            const TinyAILayerDescriptor *layer = tinyaiGetLayerDescriptor(model, index);
+            dataOffset                         = (long)layer->offset;
+        }
+        tinyaiCloseMappedModel(model);
+
+        FILE *fp = ok ? fopen(TEST_CONTAINER_FILE, "r+b") : NULL;
+        ok       = fp && fseek(fp, dataOffset + scalesOffset, SEEK_SET) == 0 &&
+             fputc(0x5A, fp) != EOF;
+        if (fp) {
+            fclose(fp);
+        }
+
+        model = ok ? tinyaiOpenMappedModel(TEST_CONTAINER_FILE, &config) : NULL;
+        if (!model || tinyaiVerifyMappedTensor(model, index) ||
+            !tinyaiVerifyMappedTensor(model, tinyaiFindMappedTensor(model, "ffn.packed"))) {
+            printf("Corrupted tensor passed verification\n");
+            ok = false;
+        }
+        tinyaiCloseMappedModel(model);
+    }
+
+    remove(TEST_CONTAINER_FILE);
+    tinyaiDestroyMatrix4bit(grouped);
+    tinyaiDestroyMatrix4bit(packed);
+    if (ok) {
+        printf("Quantized tensor container test passed\n");
+    }
+    return ok;
+}
+
+/* Test the block codecs and a container with compressed tensors */
+static bool testCompressedContainer()
+{
+    printf("Testing compressed tensor container...\n");
+
+    /* Weights with long runs and repeats, like pruned or clustered ones, over several chunks */
+    const uint32_t rows = 320, cols = 512;
+    float         *weights = (float *)malloc((size_t)rows * cols * sizeof(float));
+    size_t         rawSize = (size_t)rows * cols * sizeof(float);
+    uint8_t       *packed  = (uint8_t *)malloc(tinyaiCompressBound(TINYAI_COMPRESSION_LZ4, rawSize));
+    uint8_t       *round   = (uint8_t *)malloc(rawSize);
+    bool           ok      = weights && packed && round;
+    for (size_t i = 0; ok && i < (size_t)rows * cols; i++) {
+        weights[i] = (i / 7) % 5 == 0 ? 0.0f : (float)((i * 2654435761u >> 20) % 16) * 0.125f;
+    }
+
+    /* Every block size round-trips through LZ4, and damaged blocks are rejected */
+    static const size_t sizes[] = {0, 1, 12, 13, 100, 65536 + 17, 512 * 1024};
+    for (size_t i = 0; ok && i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t n = sizes[i] < rawSize ? sizes[i] : rawSize;
+        size_t c = tinyaiCompressBlock(TINYAI_COMPRESSION_LZ4, weights, n, packed,
+                                       tinyaiCompressBound(TINYAI_COMPRESSION_LZ4, n));
+        ok = c > 0 && tinyaiDecompressBlock(TINYAI_COMPRESSION_LZ4, packed, c, round, n) &&
+             memcmp(round, weights, n) == 0;
+        if (ok && n > 100) {
+            ok = c < n / 2 &&
+                 !tinyaiDecompressBlock(TINYAI_COMPRESSION_LZ4, packed, c / 2, round, n) &&
+                 !tinyaiDecompressBlock(TINYAI_COMPRESSION_LZ4, packed, c, round, n - 1);
+        }
+        if (!ok) {
+            printf("LZ4 block of %zu bytes does not round-trip\n", n);
+        }
+    }
+
+    TinyAIMatrix4bit *grouped = ok ? tinyaiCreateMatrix4bitGrouped(24, 40, 16) : NULL;
+    TinyAIMatrixFP32  fp32    = {weights, rows, cols};
+    ok                        = ok && grouped;
+    if (ok) {
+        fillMatrix4bit(grouped);
+    }
+
+    TinyAICompression codec = tinyaiCompressionAvailable(TINYAI_COMPRESSION_ZSTD)
+                                  ? TINYAI_COMPRESSION_ZSTD
+                                  : TINYAI_COMPRESSION_LZ4;
+    TinyAIContainerTensor tensors[] = {
+        {"embed", &fp32, TINYAI_PRECISION_FP32, TINYAI_COMPRESSION_LZ4},
+        {"attn.grouped", grouped, TINYAI_PRECISION_INT4, codec},
+        {"head", &fp32, TINYAI_PRECISION_FP32, TINYAI_COMPRESSION_NONE},
+    };
+    ok = ok && tinyaiWriteTensorContainer(TEST_CONTAINER_FILE, tensors, 3, true);
+    if (!ok) {
+        printf("Failed to write compressed tensor container\n");
+    }
+
+    /* Compressed tensors are decompressed into the cache; the rest stay mapped in place */
+    TinyAIMmapConfig config = tinyaiCreateDefaultMmapConfig();
+    for (int pass = 0; ok && pass < 2; pass++) {
+        config.backend           = pass == 0 ? TINYAI_WEIGHTS_MMAP : TINYAI_WEIGHTS_READ;
+        TinyAIMappedModel *model = tinyaiOpenMappedModel(TEST_CONTAINER_FILE, &config);
+        ok                       = model != NULL;
+
+        TinyAIMappedTensor tensor;
+        TinyAIMatrix4bit   view;
+        if (ok && pass == 0) {
+            ok = tinyaiGetMappedTensor(model, 0, &tensor) && tensor.data == NULL &&
+                 tensor.compression == TINYAI_COMPRESSION_LZ4 && tensor.dataSize == rawSize &&
+                 tinyaiGetMappedTensor(model, 2, &tensor) && tensor.data != NULL &&
+                 !tinyaiGetMappedMatrix4bit(model, 1, &view);
+            for (int i = 0; ok && i < 3; i++) {
+                ok = tinyaiVerifyMappedTensor(model, i);
+            }
+        }
+
+        /* Once through a prefetch thread, once on lookup */
+        tinyaiRequestLayerPrefetch(model, 0);
+        const void *embed = ok ? tinyaiGetLayerWeights(model, 0) : NULL;
+        tinyaiReleaseLayerWeights(model, 0);
+        const void *again = ok ? tinyaiGetLayerWeights(model, 0) : NULL;
+        const void *data4 = ok ? tinyaiGetLayerWeights(model, 1) : NULL;
+        ok = embed && again && memcmp(again, weights, rawSize) == 0 && data4 &&
+             memcmp(data4, grouped->data, tinyaiMatrix4bitDataSize(grouped)) == 0;
+        if (!ok) {
+            printf("Compressed tensors do not round-trip with the %s backend\n",
+                   pass == 0 ? "mmap" : "read");
+        }
+        tinyaiCloseMappedModel(model);
+    }
+
+    /* The compressed sections take less space than the raw data */
+    FILE *fp   = ok ? fopen(TEST_CONTAINER_FILE, "rb") : NULL;
+    long  size = fp && fseek(fp, 0, SEEK_END) == 0 ? ftell(fp) : -1;
+    if (fp) {
+        fclose(fp);
+    }
+    if (ok && (size < 0 || (size_t)size > rawSize + rawSize / 2)) {
+        printf("Compressed container is not smaller than its raw data (%ld bytes)\n", size);
+        ok = false;
+    }
+
+    remove(TEST_CONTAINER_FILE);
+    tinyaiDestroyMatrix4bit(grouped);
+    free(weights);
+    free(packed);
+    free(round);
+    if (ok) {
+        printf("Compressed tensor container test passed\n");
+    }
+    return ok;
+}
+
 /* Main test function */
 int main()
 {
@@ -265,12 +1056,72 @@ int main()
         return 1;
     }
 
+    /* Test zero-copy layer weights */
+    if (!testZeroCopyWeights()) {
+        printf("Zero-copy layer weights test failed\n");
+        return 1;
+    }
+
+    /* Test mapping residency */
+    if (!testMappingResidency()) {
+        printf("Mapping residency test failed\n");
+        return 1;
+    }
+
     /* Test forward pass scheduling */
     if (!testForwardScheduling()) {
         printf("Forward pass scheduling test failed\n");
         return 1;
     }
 
+    /* Test parallel forward passes */
+    if (!testParallelForwardPass()) {
+        printf("Parallel forward pass test failed\n");
+        return 1;
+    }
+
+    /* Test streaming pipelines */
+    if (!testStreamingPass()) {
+        printf("Streaming pipeline test failed\n");
+        return 1;
+    }
+
+    /* Test batch size calibration */
+    if (!testBatchCalibration()) {
+        printf("Batch size calibration test failed\n");
+        return 1;
+    }
+
+    /* Test the read backend */
+    if (!testReadBackend()) {
+        printf("Read backend test failed\n");
+        return 1;
+    }
+
+    /* Test scheduled prefetching */
+    if (!testScheduledPrefetch()) {
+        printf("Scheduled prefetching test failed\n");
+        return 1;
+    }
+
+    /* Test progressive loading */
+    if (!testProgressiveLoading()) {
+        printf("Progressive loading test failed\n");
+        return 1;
+    }
+
+    /* Test quantized tensor containers */
+    if (!testTensorContainer()) {
+        printf("Quantized tensor container test failed\n");
+        return 1;
+    }
+
+    /* Test compressed tensor containers */
+    if (!testCompressedContainer()) {
+        printf("Compressed tensor container test failed\n");
+        return 1;
+    }
+
     printf("All tests passed!\n");
     return 0;
 }
@@ -0,0 +1,164 @@
+/**
+ * TinyAI Picol Interpreter Tests
+ */
+
+#include "../core/picol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+// Evaluate a script and check its return code and result
+static void expect_eval(picolInterp *interp, const char *script, int retcode, const char *result)
+{
+    char buffer[PICOL_MAX_STR];
+    snprintf(buffer, sizeof(buffer), "%s", script);
+    int got = picolEval(interp, buffer);
+    if (got != retcode || strcmp(interp->resultString, result) != 0) {
+        fprintf(stderr, "Script: %s\nExpected [%d] '%s', got [%d] '%s'\n", script, retcode, result,
+                got, interp->resultString);
+    }
+    ASSERT(got == retcode, "Script should return the expected code");
+    ASSERT(strcmp(interp->resultString, result) == 0, "Script should produce the expected result");
+}
+
+static int count_calls(picolInterp *i, int argc, char **argv, void *pd)
+{
+    (void)argc;
+    (void)argv;
+    (*(int *)pd)++;
+    picolSetResult(i, "");
+    return PICOL_OK;
+}
+
+static void test_picol_evaluation()
+{
+    printf("  Testing picol evaluation...\n");
+
+    picolInterp *interp = picolCreateInterp();
+    ASSERT(interp != NULL, "Interpreter should be created");
+    picolRegisterCoreCommands(interp);
+
+    // Substitution, interpolation and nested commands
+    expect_eval(interp, "set x 4", PICOL_OK, "4");
+    expect_eval(interp, "set y \"a$x-[+ $x 1]\"", PICOL_OK, "a4-5");
+    expect_eval(interp, "set z {$x [not run]}", PICOL_OK, "$x [not run]");
+    expect_eval(interp, "* [+ $x 1] [- 10 [+ 1 2]]", PICOL_OK, "35");
+    expect_eval(interp, "set a 1; set b 2\n# comment\n+ $a $b", PICOL_OK, "3");
+    expect_eval(interp, "", PICOL_OK, "");
+
+    // Errors stop the script where they happen
+    expect_eval(interp, "set q 1; set r $missing; set q 2", PICOL_ERR,
+                "No such variable 'missing'");
+    expect_eval(interp, "set q", PICOL_ERR, "Wrong number of args for set");
+    expect_eval(interp, "nosuch 1 2", PICOL_ERR, "No such command 'nosuch'");
+    ASSERT(strcmp(picolGetVar(interp, "q"), "1") == 0, "Commands after an error should not run");
+
+    // Loops re-run their cached bodies
+    expect_eval(interp,
+                "set i 0; set sum 0; while {< $i 5000} {set sum [+ $sum $i]; set i [+ $i 1]}; "
+                "set sum $sum",
+                PICOL_OK, "12497500");
+    expect_eval(interp,
+                "set i 0; while {< $i 10} {set i [+ $i 1]; if {== $i 3} {break}}; set i $i",
+                PICOL_OK, "3");
+
+    picolFreeInterp(interp);
+    printf("    PASS\n");
+}
+
+static void test_picol_procs()
+{
+    printf("  Testing picol procs...\n");
+
+    picolInterp *interp = picolCreateInterp();
+    ASSERT(interp != NULL, "Interpreter should be created");
+    picolRegisterCoreCommands(interp);
+
+    expect_eval(interp, "proc add {a b} {return [+ $a $b]}", PICOL_OK, "");
+    expect_eval(interp, "add 2 3", PICOL_OK, "5");
+    expect_eval(interp, "add 2", PICOL_ERR, "Proc 'add' called with wrong arg num");
+    expect_eval(interp, "proc add {a} {return $a}", PICOL_ERR, "Command 'add' already defined");
+
+    // Recursion gives every call its own frame
+    expect_eval(interp,
+                "proc fib {n} {if {< $n 2} {return $n}; "
+                "return [+ [fib [- $n 1]] [fib [- $n 2]]]}",
+                PICOL_OK, "");
+    expect_eval(interp, "fib 15", PICOL_OK, "610");
+
+    // Locals stay in their frame
+    expect_eval(interp, "set v outer; proc shadow {v} {set w $v}; shadow inner; set v $v", PICOL_OK,
+                "outer");
+    ASSERT(picolGetVar(interp, "w") == NULL, "Proc locals should not leak to the caller");
+
+    // A proc can be replaced once unregistered
+    ASSERT(picolUnregisterCommand(interp, "add") == PICOL_OK, "Proc should unregister");
+    expect_eval(interp, "proc add {a} {return $a}", PICOL_OK, "");
+    expect_eval(interp, "add 7", PICOL_OK, "7");
+
+    picolFreeInterp(interp);
+    printf("    PASS\n");
+}
+
+static void test_picol_tables()
+{
+    printf("  Testing picol hash tables and script cache...\n");
+
+    picolInterp *interp = picolCreateInterp();
+    ASSERT(interp != NULL, "Interpreter should be created");
+    picolRegisterCoreCommands(interp);
+
+    // Many variables and commands, so both tables grow several times
+    char name[32], value[32];
+    int  calls[300] = {0};
+    for (int k = 0; k < 300; k++) {
+        snprintf(name, sizeof(name), "var%d", k);
+        snprintf(value, sizeof(value), "%d", k * 7);
+        ASSERT(picolSetVar(interp, name, value) == PICOL_OK, "Variable should be set");
+        snprintf(name, sizeof(name), "cmd%d", k);
+        ASSERT(picolRegisterCommand(interp, name, count_calls, &calls[k]) == PICOL_OK,
+               "Command should register");
+    }
+    for (int k = 0; k < 300; k++) {
+        snprintf(name, sizeof(name), "var%d", k);
+        snprintf(value, sizeof(value), "%d", k * 7);
+        ASSERT(picolGetVar(interp, name) && strcmp(picolGetVar(interp, name), value) == 0,
+               "Variable should keep its value");
+        snprintf(name, sizeof(name), "cmd%d", k);
+        expect_eval(interp, name, PICOL_OK, "");
+        ASSERT(calls[k] == 1, "Each command should run its own handler");
+    }
+    ASSERT(picolUnregisterCommand(interp, "cmd17") == PICOL_OK, "Command should unregister");
+    ASSERT(picolUnregisterCommand(interp, "cmd17") == PICOL_ERR, "Command should be gone");
+    expect_eval(interp, "cmd17", PICOL_ERR, "No such command 'cmd17'");
+    expect_eval(interp, "cmd18", PICOL_OK, "");
+
+    // More distinct scripts than the cache holds still evaluate correctly
+    char script[64], expected[32];
+    for (int k = 0; k < PICOL_SCRIPT_CACHE * 2 + 5; k++) {
+        snprintf(script, sizeof(script), "+ $var%d %d", k % 300, k);
+        snprintf(expected, sizeof(expected), "%d", (k % 300) * 7 + k);
+        expect_eval(interp, script, PICOL_OK, expected);
+    }
+
+    picolFreeInterp(interp);
+    printf("    PASS\n");
+}
+
+void run_picol_tests()
+{
+    printf("\n--- Running Picol Tests ---\n");
+    test_picol_evaluation();
+    test_picol_procs();
+    test_picol_tables();
+    printf("--- Picol Tests Finished ---\n");
+}
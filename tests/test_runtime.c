@@ -0,0 +1,184 @@
+/**
+ * TinyAI Runtime Event Tests
+ */
+
+#include "../core/runtime.h"
+#include "../utils/thread_pool.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define EVENT_THREADS 4
+#define EVENT_TRIGGERS 20000
+
+// Handlers append their tag to a trace of calls
+static char g_order[32];
+static int  g_calls;
+
+static int record_a(void *data)
+{
+    (void)data;
+    strcat(g_order, "a");
+    return 0;
+}
+
+static int record_b(void *data)
+{
+    (void)data;
+    strcat(g_order, "b");
+    return 0;
+}
+
+static int record_c(void *data)
+{
+    (void)data;
+    strcat(g_order, "c");
+    return 0;
+}
+
+static int stop_here(void *data)
+{
+    (void)data;
+    strcat(g_order, "!");
+    return 1;
+}
+
+static int count_call(void *data)
+{
+    __atomic_add_fetch((int *)data, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void test_event_dispatch()
+{
+    printf("  Testing event registration and dispatch...\n");
+
+    int id = tinyaiRegisterEvent("test.order");
+    ASSERT(id >= 0, "Event should register");
+    ASSERT(tinyaiRegisterEvent("test.order") == id, "Registering again should return the same ID");
+    ASSERT(tinyaiFindEvent("test.order") == id, "Event should be found by name");
+    ASSERT(tinyaiFindEvent("test.missing") == -1, "Unknown events should not be found");
+    ASSERT(!tinyaiEventHasHandlers(id), "A new event should have no handlers");
+    ASSERT(tinyaiTriggerEventId(id, NULL) == 1, "An event without handlers should trigger");
+    ASSERT(tinyaiTriggerEventId(-1, NULL) == 0, "An invalid ID should not trigger");
+    ASSERT(tinyaiTriggerEvent("test.missing", NULL) == 0, "An unknown name should not trigger");
+
+    // Higher priorities first; equal priorities in registration order
+    ASSERT(tinyaiRegisterEventHandlerId(id, 1, record_b, NULL), "Handler should register");
+    ASSERT(tinyaiRegisterEventHandlerId(id, 5, record_a, NULL), "Handler should register");
+    ASSERT(tinyaiRegisterEventHandler("test.order", 1, record_c, NULL), "Handler should register");
+    ASSERT(tinyaiEventHasHandlers(id), "The event should have handlers");
+    g_order[0] = '\0';
+    ASSERT(tinyaiTriggerEvent("test.order", NULL) == 1, "Event should trigger by name");
+    ASSERT(strcmp(g_order, "abc") == 0, "Handlers should run by priority");
+
+    // A handler returning non-zero stops the lower priority ones
+    ASSERT(tinyaiRegisterEventHandlerId(id, 3, stop_here, NULL), "Handler should register");
+    g_order[0] = '\0';
+    ASSERT(tinyaiTriggerEventId(id, NULL) == 1, "Event should trigger by ID");
+    ASSERT(strcmp(g_order, "a!") == 0, "Propagation should stop at the handler");
+
+    // Registering a handler also registers its event
+    ASSERT(tinyaiRegisterEventHandler("test.implicit", 0, count_call, NULL),
+           "Handler should register");
+    ASSERT(tinyaiFindEvent("test.implicit") >= 0, "The event should be registered with it");
+
+    printf("    PASS\n");
+}
+
+typedef struct {
+    int id;
+    int counter;
+} TriggerContext;
+
+static void *trigger_often(void *arg)
+{
+    TriggerContext *context = (TriggerContext *)arg;
+    for (int i = 0; i < EVENT_TRIGGERS; i++) {
+        tinyaiTriggerEventId(context->id, &context->counter);
+    }
+    return NULL;
+}
+
+static void test_event_concurrency()
+{
+    printf("  Testing triggers concurrent with registration...\n");
+
+    TriggerContext context = {tinyaiRegisterEvent("test.concurrent"), 0};
+    ASSERT(context.id >= 0, "Event should register");
+    ASSERT(tinyaiRegisterEventHandlerId(context.id, 0, count_call, NULL), "Handler should register");
+
+    pthread_t threads[EVENT_THREADS];
+    for (int t = 0; t < EVENT_THREADS; t++) {
+        ASSERT(pthread_create(&threads[t], NULL, trigger_often, &context) == 0,
+               "Thread should start");
+    }
+    // Handlers added while triggers run; every trigger sees a whole list
+    for (int h = 1; h < 16; h++) {
+        ASSERT(tinyaiRegisterEventHandlerId(context.id, h % 3, count_call, NULL),
+               "Handler should register");
+    }
+    for (int t = 0; t < EVENT_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    ASSERT(context.counter >= EVENT_THREADS * EVENT_TRIGGERS, "Every trigger should run handlers");
+    ASSERT(context.counter <= EVENT_THREADS * EVENT_TRIGGERS * 16, "No handler should run twice");
+
+    // Once registration is done every trigger runs all of them
+    context.counter = 0;
+    tinyaiTriggerEventId(context.id, &context.counter);
+    ASSERT(context.counter == 16, "Every handler should run");
+
+    printf("    PASS\n");
+}
+
+static void test_event_async()
+{
+    printf("  Testing asynchronous dispatch...\n");
+
+    TinyAIThreadPool     *pool  = tinyaiCreateThreadPool(4, 0);
+    TinyAIThreadPoolScope scope = tinyaiUseThreadPool(pool);
+
+    int id = tinyaiRegisterEvent("test.async");
+    ASSERT(tinyaiRegisterEventHandlerId(id, 0, count_call, NULL), "Handler should register");
+    ASSERT(tinyaiRegisterEventHandlerId(id, 0, count_call, NULL), "Handler should register");
+
+    int counter = 0;
+    for (int i = 0; i < 1000; i++) {
+        ASSERT(tinyaiTriggerEventAsync(id, &counter) == 1, "Event should be queued");
+    }
+    tinyaiWaitForEvents();
+    ASSERT(__atomic_load_n(&counter, __ATOMIC_RELAXED) == 2000, "Every queued event should run");
+    ASSERT(tinyaiTriggerEventAsync(-1, &counter) == 0, "An invalid ID should not be queued");
+
+    // Cleanup waits for queued events and drops every event
+    for (int i = 0; i < 100; i++) {
+        tinyaiTriggerEventAsync(id, &counter);
+    }
+    tinyaiRuntimeCleanup(NULL);
+    ASSERT(counter == 2200, "Cleanup should wait for queued events");
+    ASSERT(tinyaiFindEvent("test.async") == -1, "Cleanup should drop events");
+
+    tinyaiRestoreThreadPool(scope);
+    tinyaiDestroyThreadPool(pool);
+    printf("    PASS\n");
+}
+
+void run_runtime_tests()
+{
+    printf("\n--- Running Runtime Tests ---\n");
+    test_event_dispatch();
+    test_event_concurrency();
+    test_event_async();
+    printf("--- Runtime Tests Finished ---\n");
+}
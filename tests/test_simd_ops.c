@@ -2,7 +2,10 @@
  * TinyAI SIMD Operations Tests
  */
 
+#include "../core/config.h"
 #include "../utils/simd_ops.h"
+#include "../utils/thread_pool.h"
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -84,7 +87,9 @@ void test_matrix_vector_multiplication()
     // Quantize the matrix
     quantize_matrix(matrix, quantized_matrix, rows * cols, scale_factors);
 
-    // Compute reference result (naive implementation)
+    // Compute reference result from the dequantized weights, so the comparison checks the kernel
+    // rather than 4-bit rounding error (which alone exceeds the tolerance over 256 columns)
+    tinyaiSimdDequantize4Bit(matrix, quantized_matrix, rows * cols, scale_factors);
     for (int r = 0; r < rows; r++) {
         result_ref[r] = 0.0f;
         for (int c = 0; c < cols; c++) {
@@ -112,6 +117,1341 @@ void test_matrix_vector_multiplication()
     printf("    PASS\n");
 }
 
+// Test that the kernels picked at runtime match the scalar formulas exactly enough
+void test_runtime_kernel_selection()
+{
+    printf("  Testing runtime-selected 4-bit kernels...\n");
+    printf("    AVX: %s, AVX2: %s, AVX-512: %s\n", tinyaiSimdHasAVX() ? "YES" : "NO",
+           tinyaiSimdHasAVX2() ? "YES" : "NO", tinyaiSimdHasAVX512() ? "YES" : "NO");
+    ASSERT(!tinyaiSimdHasAVX2() || tinyaiSimdHasAVX(), "AVX2 kernels should imply AVX support");
+
+    // Odd sizes cover the vector bodies and the scalar tails
+    const int rows = 5;
+    const int cols = 77;
+    const int bytesPerRow = (cols + 1) / 2;
+    uint8_t   weights[5 * 39];
+    float     input[77], scales[5], out[5];
+    for (int i = 0; i < rows * bytesPerRow; i++) {
+        weights[i] = (uint8_t)(i * 73 + 5);
+    }
+    for (int c = 0; c < cols; c++) {
+        input[c] = (float)(c % 11 - 5) * 0.3f;
+    }
+    for (int r = 0; r < rows; r++) {
+        scales[r] = 0.1f * (float)(r + 1);
+    }
+
+    tinyaiSimdMatMul4Bit(out, weights, input, rows, cols, scales);
+    for (int r = 0; r < rows; r++) {
+        float expected = 0.0f;
+        for (int c = 0; c < cols; c++) {
+            uint8_t packed = weights[r * bytesPerRow + c / 2];
+            int     q      = (c % 2 == 0 ? packed & 0x0F : packed >> 4) - 8;
+            expected += (float)q * scales[r] * input[c];
+        }
+        ASSERT(fabsf(out[r] - expected) <= 1e-4f * (1.0f + fabsf(expected)),
+               "Runtime-selected 4-bit matrix-vector product should match the scalar formula");
+    }
+
+    // Blocks of an odd size start on odd elements, inside a packed byte
+    const int size      = 61;
+    const int blockSize = 9;
+    float     values[61], blockScales[7];
+    uint8_t   packed[31] = {0};
+    for (int i = 0; i < size; i++) {
+        values[i] = sinf((float)i * 1.7f) * (float)(i % 5 + 1);
+    }
+    tinyaiSimdQuantize4Bit(packed, values, size, blockScales, blockSize);
+    for (int i = 0; i < size; i++) {
+        float scale = blockScales[i / blockSize];
+        int   q     = (i % 2 == 0 ? packed[i / 2] & 0x0F : packed[i / 2] >> 4) - 8;
+        ASSERT(fabsf((float)q * scale - values[i]) <= 0.5f * scale + 1e-5f,
+               "Runtime-selected 4-bit quantization should round to the nearest level");
+    }
+
+    printf("    PASS\n");
+}
+
+// Test vector-matrix multiplication on affine 4-bit (TinyAIMatrix4bit layout) weights
+void test_affine_vector_matrix_multiplication()
+{
+    printf("  Testing vector-matrix multiplication with affine 4-bit weights...\n");
+
+    // Even column count exercises the SIMD path, odd the unaligned fallback
+    const int shapes[2][2] = {{48, 40}, {13, 33}};
+
+    for (int s = 0; s < 2; s++) {
+        const int rows = shapes[s][0];
+        const int cols = shapes[s][1];
+        const float scale     = 0.125f;
+        const float zeroPoint = -0.9f;
+
+        uint8_t *packed     = (uint8_t *)malloc((rows * cols + 1) / 2);
+        float   *vector     = (float *)malloc(rows * sizeof(float));
+        float   *result_ref = (float *)malloc(cols * sizeof(float));
+        float   *result     = (float *)malloc(cols * sizeof(float));
+
+        for (int i = 0; i < (rows * cols + 1) / 2; i++) {
+            packed[i] = (uint8_t)(rand() & 0xFF);
+        }
+        init_random_matrix(vector, rows);
+        vector[1] = 0.0f; // Zero inputs still contribute to the zero point term
+
+        // Reference: dequantize each weight (high nibble first) and accumulate
+        for (int c = 0; c < cols; c++) {
+            result_ref[c] = 0.0f;
+            for (int r = 0; r < rows; r++) {
+                int idx = r * cols + c;
+                int q   = (idx % 2 == 0) ? (packed[idx / 2] >> 4) : (packed[idx / 2] & 0x0F);
+                result_ref[c] += vector[r] * (q * scale + zeroPoint);
+            }
+        }
+
+        tinyaiSimdVecMatMul4BitAffine(result, packed, vector, rows, cols, scale, zeroPoint);
+        bool match = compare_float_arrays(result_ref, result, cols, 1e-3f);
+
+        free(packed);
+        free(vector);
+        free(result_ref);
+        free(result);
+
+        ASSERT(match, "Affine 4-bit vector-matrix multiplication should match dequantized reference");
+    }
+    printf("    PASS\n");
+}
+
+// Test matrix multiplication on 4-bit weights prepacked into 16-column panels
+void test_prepacked_matrix_multiplication()
+{
+    printf("  Testing matrix multiplication with prepacked 4-bit weights...\n");
+
+    // Whole panels, and a padded last panel
+    const int shapes[2][2] = {{24, 48}, {9, 37}};
+    const int count        = 5;
+
+    for (int s = 0; s < 2; s++) {
+        const int   rows = shapes[s][0];
+        const int   cols = shapes[s][1];
+        const int   numPanels = (cols + 15) / 16;
+        const float scale = 0.125f, zeroPoint = -0.9f;
+
+        uint8_t *panels     = (uint8_t *)calloc(numPanels * rows * 8, 1);
+        int     *values     = (int *)malloc(rows * cols * sizeof(int));
+        float   *input      = (float *)malloc(count * rows * sizeof(float));
+        float   *result_ref = (float *)malloc(count * cols * sizeof(float));
+        float   *result     = (float *)malloc(count * cols * sizeof(float));
+        float   *split      = (float *)malloc(count * cols * sizeof(float));
+
+        // Byte i of a panel row: column i in the low nibble, column 8 + i in the high nibble
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < cols; c++) {
+                int      q    = rand() % 16;
+                int      i    = c % 16;
+                uint8_t *byte = panels + ((c / 16) * rows + r) * 8 + i % 8;
+                values[r * cols + c] = q;
+                *byte |= (uint8_t)(i < 8 ? q : q << 4);
+            }
+        }
+        init_random_matrix(input, count * rows);
+
+        for (int b = 0; b < count; b++) {
+            for (int c = 0; c < cols; c++) {
+                float sum = 0.0f;
+                for (int r = 0; r < rows; r++) {
+                    sum += input[b * rows + r] * (values[r * cols + c] * scale + zeroPoint);
+                }
+                result_ref[b * cols + c] = sum;
+            }
+        }
+
+        tinyaiSimdMatMul4BitPanelsColumns(result, panels, input, count, rows, cols, 0, cols, scale,
+                                          zeroPoint);
+        bool match = compare_float_arrays(result_ref, result, count * cols, 1e-3f);
+
+        // Ranges that cut panels give the same results
+        for (int c = 0; c < cols; c += 12) {
+            int end = c + 12 < cols ? c + 12 : cols;
+            tinyaiSimdMatMul4BitPanelsColumns(split, panels, input, count, rows, cols, c, end,
+                                              scale, zeroPoint);
+        }
+        bool exact = memcmp(result, split, count * cols * sizeof(float)) == 0;
+
+        free(panels);
+        free(values);
+        free(input);
+        free(result_ref);
+        free(result);
+        free(split);
+
+        ASSERT(match, "Prepacked 4-bit matrix multiplication should match dequantized reference");
+        ASSERT(exact, "Column ranges should match the full prepacked product exactly");
+    }
+    printf("    PASS\n");
+}
+
+// Test matrix multiplication on group-quantized 4-bit weights, whole and in column ranges
+void test_grouped_matrix_multiplication()
+{
+    printf("  Testing matrix multiplication with group-quantized 4-bit weights...\n");
+
+    // Even shapes exercise the SIMD path, an odd group size the unaligned fallback
+    const int shapes[2][3] = {{24, 56, 24}, {9, 30, 7}};
+    const int count        = 3;
+
+    for (int s = 0; s < 2; s++) {
+        const int rows = shapes[s][0];
+        const int cols = shapes[s][1];
+        const int size = shapes[s][2];
+        const int groups = (cols + size - 1) / size;
+
+        uint8_t *packed     = (uint8_t *)malloc((rows * cols + 1) / 2);
+        float   *scales     = (float *)malloc(rows * groups * sizeof(float));
+        float   *zeroPoints = (float *)malloc(rows * groups * sizeof(float));
+        float   *input      = (float *)malloc(count * rows * sizeof(float));
+        float   *result_ref = (float *)malloc(count * cols * sizeof(float));
+        float   *result     = (float *)malloc(count * cols * sizeof(float));
+        float   *split      = (float *)malloc(count * cols * sizeof(float));
+
+        for (int i = 0; i < (rows * cols + 1) / 2; i++) {
+            packed[i] = (uint8_t)(rand() & 0xFF);
+        }
+        for (int i = 0; i < rows * groups; i++) {
+            scales[i]     = 0.01f + (float)rand() / RAND_MAX * 0.2f;
+            zeroPoints[i] = (float)rand() / RAND_MAX - 0.5f;
+        }
+        init_random_matrix(input, count * rows);
+        input[1] = 0.0f; // Zero inputs still contribute to the zero point terms
+
+        // Reference: dequantize each weight with its group's scale and accumulate
+        for (int b = 0; b < count; b++) {
+            for (int c = 0; c < cols; c++) {
+                float sum = 0.0f;
+                for (int r = 0; r < rows; r++) {
+                    int idx = r * cols + c;
+                    int q   = (idx % 2 == 0) ? (packed[idx / 2] >> 4) : (packed[idx / 2] & 0x0F);
+                    int g   = r * groups + c / size;
+                    sum += input[b * rows + r] * (q * scales[g] + zeroPoints[g]);
+                }
+                result_ref[b * cols + c] = sum;
+            }
+        }
+
+        tinyaiSimdMatMul4BitGroupedColumns(result, packed, input, count, rows, cols, 0, cols,
+                                           scales, zeroPoints, size);
+        bool match = compare_float_arrays(result_ref, result, count * cols, 1e-3f);
+
+        // Ranges that cut through groups give the same results
+        for (int c = 0; c < cols; c += 16) {
+            int end = c + 16 < cols ? c + 16 : cols;
+            tinyaiSimdMatMul4BitGroupedColumns(split, packed, input, count, rows, cols, c, end,
+                                               scales, zeroPoints, size);
+        }
+        bool exact = memcmp(result, split, count * cols * sizeof(float)) == 0;
+
+        free(packed);
+        free(scales);
+        free(zeroPoints);
+        free(input);
+        free(result_ref);
+        free(result);
+        free(split);
+
+        ASSERT(match, "Grouped 4-bit matrix multiplication should match dequantized reference");
+        ASSERT(exact, "Column ranges should match the full grouped product exactly");
+    }
+    printf("    PASS\n");
+}
+
+// Test matrix multiplication and dequantization with codebook 4-bit weights
+void test_codebook_matrix_multiplication()
+{
+    printf("  Testing matrix multiplication with codebook 4-bit weights...\n");
+
+    // Non-uniform levels in no particular order; the kernels only look them up
+    float levels[16];
+    for (int i = 0; i < 16; i++) {
+        levels[i] = sinf((float)i * 1.7f) * (1.0f + (float)i * 0.1f);
+    }
+
+    // Even shapes exercise the SIMD paths (a group of 20 leaves partial vectors), an odd group
+    // size the unaligned fallback; through the AVX-512 kernel (where available) and the others
+    const int shapes[3][3] = {{24, 56, 24}, {11, 60, 20}, {9, 30, 7}};
+    const int count        = 3;
+
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        for (int s = 0; s < 3; s++) {
+            const int rows   = shapes[s][0];
+            const int cols   = shapes[s][1];
+            const int size   = shapes[s][2];
+            const int groups = (cols + size - 1) / size;
+
+            uint8_t *packed     = (uint8_t *)malloc((rows * cols + 1) / 2);
+            float   *scales     = (float *)malloc(rows * groups * sizeof(float));
+            float   *zeroPoints = (float *)malloc(rows * groups * sizeof(float));
+            float   *input      = (float *)malloc(count * rows * sizeof(float));
+            float   *result_ref = (float *)malloc(count * cols * sizeof(float));
+            float   *result     = (float *)malloc(count * cols * sizeof(float));
+            float   *split      = (float *)malloc(count * cols * sizeof(float));
+
+            for (int i = 0; i < (rows * cols + 1) / 2; i++) {
+                packed[i] = (uint8_t)(rand() & 0xFF);
+            }
+            for (int i = 0; i < rows * groups; i++) {
+                scales[i]     = 0.01f + (float)rand() / RAND_MAX * 0.2f;
+                zeroPoints[i] = (float)rand() / RAND_MAX - 0.5f;
+            }
+            init_random_matrix(input, count * rows);
+            input[1] = 0.0f; // Zero inputs still contribute to the zero point terms
+
+            // Reference: dequantize each weight through the codebook and accumulate
+            for (int b = 0; b < count; b++) {
+                for (int c = 0; c < cols; c++) {
+                    float sum = 0.0f;
+                    for (int r = 0; r < rows; r++) {
+                        int idx = r * cols + c;
+                        int q = (idx % 2 == 0) ? (packed[idx / 2] >> 4) : (packed[idx / 2] & 0x0F);
+                        int g = r * groups + c / size;
+                        sum += input[b * rows + r] * (levels[q] * scales[g] + zeroPoints[g]);
+                    }
+                    result_ref[b * cols + c] = sum;
+                }
+            }
+
+            tinyaiSimdMatMul4BitCodebookColumns(result, packed, input, count, rows, cols, 0, cols,
+                                                levels, scales, zeroPoints, size);
+            bool match = compare_float_arrays(result_ref, result, count * cols, 1e-3f);
+
+            // Ranges that cut through groups give the same results
+            for (int c = 0; c < cols; c += 16) {
+                int end = c + 16 < cols ? c + 16 : cols;
+                tinyaiSimdMatMul4BitCodebookColumns(split, packed, input, count, rows, cols, c,
+                                                    end, levels, scales, zeroPoints, size);
+            }
+            bool exact = memcmp(result, split, count * cols * sizeof(float)) == 0;
+
+            free(packed);
+            free(scales);
+            free(zeroPoints);
+            free(input);
+            free(result_ref);
+            free(result);
+            free(split);
+
+            ASSERT(match, "Codebook 4-bit matrix multiplication should match dequantized reference");
+            ASSERT(exact, "Column ranges should match the full codebook product exactly");
+        }
+    }
+    tinyaiSimdSetAVX512Enabled(true);
+
+    // Dequantization, with a tail after the 16-value blocks
+    uint8_t bytes[23];
+    float   values[45];
+    for (int i = 0; i < 23; i++) {
+        bytes[i] = (uint8_t)(rand() & 0xFF);
+    }
+    tinyaiSimdDequantize4BitCodebook(values, bytes, 45, levels, 0.5f, 0.25f);
+    for (int i = 0; i < 45; i++) {
+        int q = (i % 2 == 0) ? (bytes[i / 2] >> 4) : (bytes[i / 2] & 0x0F);
+        ASSERT(fabsf(values[i] - (levels[q] * 0.5f + 0.25f)) < 1e-6f,
+               "Codebook 4-bit dequantization should match reference");
+    }
+    printf("    PASS\n");
+}
+
+// Test products of int8-quantized activations with 4-bit and 8-bit weights
+void test_int8_activation_matrix_multiplication()
+{
+    printf("  Testing matrix multiplication with int8 activations...\n");
+
+    // Odd rows pair the last row with zero; 70 columns leave SIMD tails
+    const int rows  = 37;
+    const int cols  = 70;
+    const int count = 3;
+
+    int8_t   x[3 * 37];
+    float    xScales[3];
+    float    input[3 * 37];
+    uint8_t  packed[(37 * 70 + 1) / 2];
+    int8_t   bytes[37 * 70];
+    float    expected[3 * 70];
+    float    result[3 * 70];
+    float    split[3 * 70];
+    float    narrow[3 * 70];
+    bool     match = true;
+
+    init_random_matrix(input, count * rows);
+    input[5] = 0.0f;
+    for (int b = 0; b < count; b++) {
+        xScales[b] = tinyaiSimdQuantizeInt8(x + b * rows, input + b * rows, rows);
+        for (int k = 0; k < rows; k++) {
+            match = match && fabsf(x[b * rows + k] * xScales[b] - input[b * rows + k]) <=
+                                 xScales[b] * 0.5f + 1e-6f;
+        }
+    }
+    ASSERT(match, "Int8 quantization should round to the nearest step");
+
+    for (int i = 0; i < (rows * cols + 1) / 2; i++) {
+        packed[i] = (uint8_t)(rand() & 0xFF);
+    }
+    for (int i = 0; i < rows * cols; i++) {
+        bytes[i] = (int8_t)(rand() % 255 - 127);
+    }
+
+    const float scale     = 0.05f;
+    const float zeroPoint = -0.4f;
+    for (int bits = 4; bits <= 8; bits += 4) {
+        // Reference: exact integer sums, rescaled with the kernel's formula
+        for (int b = 0; b < count; b++) {
+            int xsum = 0;
+            for (int k = 0; k < rows; k++) {
+                xsum += x[b * rows + k];
+            }
+            for (int j = 0; j < cols; j++) {
+                int acc = 0;
+                for (int k = 0; k < rows; k++) {
+                    int idx = k * cols + j;
+                    int q   = bits == 8 ? bytes[idx]
+                              : (idx % 2 == 0) ? (packed[idx / 2] >> 4) : (packed[idx / 2] & 0x0F);
+                    acc += x[b * rows + k] * q;
+                }
+                expected[b * cols + j] =
+                    (float)acc * (xScales[b] * scale) + xScales[b] * (float)xsum * zeroPoint;
+            }
+        }
+
+        for (int wide = 1; wide >= 0; wide--) {
+            tinyaiSimdSetAVX512Enabled(wide != 0);
+            float *dst = wide ? result : narrow;
+            if (bits == 4) {
+                tinyaiSimdMatMul4BitInt8Columns(dst, packed, x, xScales, count, rows, cols, 0, cols,
+                                                scale, zeroPoint);
+            }
+            else {
+                tinyaiSimdMatMul8BitInt8Columns(dst, bytes, x, xScales, count, rows, cols, 0, cols,
+                                                scale, zeroPoint);
+            }
+        }
+        tinyaiSimdSetAVX512Enabled(true);
+
+        // Ranges of 16 columns split the wide kernel's 32-column blocks into masked ones
+        for (int c = 0; c < cols; c += 16) {
+            int end = c + 16 < cols ? c + 16 : cols;
+            if (bits == 4) {
+                tinyaiSimdMatMul4BitInt8Columns(split, packed, x, xScales, count, rows, cols, c,
+                                                end, scale, zeroPoint);
+            }
+            else {
+                tinyaiSimdMatMul8BitInt8Columns(split, bytes, x, xScales, count, rows, cols, c, end,
+                                                scale, zeroPoint);
+            }
+        }
+
+        ASSERT(compare_float_arrays(expected, result, count * cols, 1e-4f),
+               "Int8 activation product should match the integer reference");
+        ASSERT(compare_float_arrays(expected, narrow, count * cols, 1e-4f),
+               "Int8 activation product without AVX-512 should match the integer reference");
+        ASSERT(memcmp(result, split, sizeof(result)) == 0,
+               "Column ranges should match the full int8 activation product exactly");
+    }
+
+    // Symmetric rows (image model layout) against the float kernel on dequantized inputs
+    float rowScales[37];
+    float dequantized[70];
+    for (int i = 0; i < rows; i++) {
+        rowScales[i] = 0.01f + (float)rand() / RAND_MAX * 0.1f;
+    }
+    int8_t xRow[70];
+    float  rowInput[70];
+    init_random_matrix(rowInput, cols);
+    float  xRowScale = tinyaiSimdQuantizeInt8(xRow, rowInput, cols);
+    for (int i = 0; i < cols; i++) {
+        dequantized[i] = xRow[i] * xRowScale;
+    }
+    tinyaiSimdMatMul4Bit(expected, packed, dequantized, rows, cols, rowScales);
+    tinyaiSimdMatMul4BitInt8(result, packed, xRow, xRowScale, rows, cols, rowScales);
+    ASSERT(compare_float_arrays(expected, result, rows, 1e-4f),
+           "Int8 symmetric 4-bit product should match the float kernel");
+
+    printf("    PASS\n");
+}
+
+// Test FP16 and BF16 conversion and the FP16 and 2-bit weight kernels
+void test_fp16_and_2bit_matrix_multiplication()
+{
+    printf("  Testing FP16, 8-bit and 2-bit weight matrix multiplication...\n");
+
+    // Exact values, round to nearest even, subnormals and overflow
+    const float    values[8] = {1.0f, -2.5f, 65504.0f, 1e6f, 5.9604645e-8f, 1.0f + 1.0f / 2048.0f,
+                                1.0f + 3.0f / 2048.0f, 0.0f};
+    const uint16_t halves[8] = {0x3C00, 0xC100, 0x7BFF, 0x7C00, 0x0001, 0x3C00, 0x3C02, 0x0000};
+    uint16_t       converted[8];
+    float          widened[8];
+    tinyaiSimdConvertFP32ToFP16(converted, values, 8);
+    tinyaiSimdConvertFP16ToFP32(widened, halves, 8);
+    ASSERT(memcmp(converted, halves, sizeof(halves)) == 0,
+           "FP32 to FP16 conversion should round to nearest even");
+    ASSERT(widened[1] == -2.5f && widened[4] == 5.9604645e-8f && isinf(widened[3]),
+           "FP16 to FP32 conversion should be exact");
+
+    // BF16: ties to even, quiet NaNs, and enough values for the SIMD paths and a tail
+    const uint32_t bf16Bits[6]  = {0x3F800000, 0x3F808000, 0x3F818000,
+                                   0x3F808001, 0xC0200000, 0x7F800001};
+    const uint16_t bf16Halves[6] = {0x3F80, 0x3F80, 0x3F82, 0x3F81, 0xC020, 0x7FC0};
+    float          bf16Values[19];
+    uint16_t       bf16Converted[19];
+    float          bf16Widened[19];
+    for (int i = 0; i < 19; i++) {
+        memcpy(&bf16Values[i], &bf16Bits[i % 6], sizeof(float));
+    }
+    tinyaiSimdConvertFP32ToBF16(bf16Converted, bf16Values, 19);
+    tinyaiSimdConvertBF16ToFP32(bf16Widened, bf16Converted, 19);
+    for (int i = 0; i < 19; i++) {
+        ASSERT(bf16Converted[i] == bf16Halves[i % 6],
+               "FP32 to BF16 conversion should round to nearest even");
+        uint32_t bits;
+        memcpy(&bits, &bf16Widened[i], sizeof(bits));
+        ASSERT(bits == (uint32_t)bf16Halves[i % 6] << 16, "BF16 to FP32 conversion should be exact");
+    }
+
+    // Multiples of 4 columns exercise the SIMD paths, odd sizes the fallbacks and tails
+    const int shapes[2][2] = {{20, 52}, {7, 29}};
+    const int count        = 3;
+
+    for (int s = 0; s < 2; s++) {
+        const int rows = shapes[s][0];
+        const int cols = shapes[s][1];
+        const float scale = 0.125f, zeroPoint = 0.25f;
+
+        uint16_t *fp16       = (uint16_t *)malloc(rows * cols * sizeof(uint16_t));
+        uint8_t  *packed     = (uint8_t *)calloc((rows * cols + 3) / 4, 1);
+        int8_t   *int8       = (int8_t *)malloc(rows * cols);
+        float    *weights    = (float *)malloc(rows * cols * sizeof(float));
+        float    *input      = (float *)malloc(count * rows * sizeof(float));
+        float    *result_ref = (float *)malloc(count * cols * sizeof(float));
+        float    *result     = (float *)malloc(count * cols * sizeof(float));
+        float    *split      = (float *)malloc(count * cols * sizeof(float));
+
+        init_random_matrix(weights, rows * cols);
+        init_random_matrix(input, count * rows);
+        input[1] = 0.0f; // Zero inputs still contribute to the zero point terms
+
+        // FP16 weights: reference on the widened values
+        tinyaiSimdConvertFP32ToFP16(fp16, weights, rows * cols);
+        tinyaiSimdConvertFP16ToFP32(weights, fp16, rows * cols);
+        for (int b = 0; b < count; b++) {
+            for (int c = 0; c < cols; c++) {
+                float sum = 0.0f;
+                for (int r = 0; r < rows; r++) {
+                    sum += input[b * rows + r] * weights[r * cols + c];
+                }
+                result_ref[b * cols + c] = sum;
+            }
+        }
+
+        tinyaiSimdMatMulFP16Columns(result, fp16, input, count, rows, cols, 0, cols);
+        bool fp16Match = compare_float_arrays(result_ref, result, count * cols, 1e-4f);
+        for (int c = 0; c < cols; c += 16) {
+            int end = c + 16 < cols ? c + 16 : cols;
+            tinyaiSimdMatMulFP16Columns(split, fp16, input, count, rows, cols, c, end);
+        }
+        bool fp16Exact = memcmp(result, split, count * cols * sizeof(float)) == 0;
+
+        // 2-bit weights in [-2, 1], four per byte with the first in the low bits
+        for (int i = 0; i < rows * cols; i++) {
+            int q = rand() % 4 - 2;
+            packed[i / 4] |= (uint8_t)((q & 0x03) << (2 * (i % 4)));
+            weights[i] = q * scale + zeroPoint;
+        }
+        for (int b = 0; b < count; b++) {
+            for (int c = 0; c < cols; c++) {
+                float sum = 0.0f;
+                for (int r = 0; r < rows; r++) {
+                    sum += input[b * rows + r] * weights[r * cols + c];
+                }
+                result_ref[b * cols + c] = sum;
+            }
+        }
+
+        tinyaiSimdMatMul2BitColumns(result, packed, input, count, rows, cols, 0, cols, scale,
+                                    zeroPoint);
+        bool int2Match = compare_float_arrays(result_ref, result, count * cols, 1e-4f);
+        for (int c = 0; c < cols; c += 16) {
+            int end = c + 16 < cols ? c + 16 : cols;
+            tinyaiSimdMatMul2BitColumns(split, packed, input, count, rows, cols, c, end, scale,
+                                        zeroPoint);
+        }
+        bool int2Exact = memcmp(result, split, count * cols * sizeof(float)) == 0;
+
+        // Signed 8-bit weights with the same affine mapping
+        for (int i = 0; i < rows * cols; i++) {
+            int8[i]    = (int8_t)(rand() % 256 - 128);
+            weights[i] = int8[i] * scale + zeroPoint;
+        }
+        for (int b = 0; b < count; b++) {
+            for (int c = 0; c < cols; c++) {
+                float sum = 0.0f;
+                for (int r = 0; r < rows; r++) {
+                    sum += input[b * rows + r] * weights[r * cols + c];
+                }
+                result_ref[b * cols + c] = sum;
+            }
+        }
+
+        tinyaiSimdMatMul8BitAffineColumns(result, int8, input, count, rows, cols, 0, cols, scale,
+                                          zeroPoint);
+        bool int8Match = compare_float_arrays(result_ref, result, count * cols, 1e-3f);
+        for (int c = 0; c < cols; c += 16) {
+            int end = c + 16 < cols ? c + 16 : cols;
+            tinyaiSimdMatMul8BitAffineColumns(split, int8, input, count, rows, cols, c, end, scale,
+                                              zeroPoint);
+        }
+        bool int8Exact = memcmp(result, split, count * cols * sizeof(float)) == 0;
+
+        free(fp16);
+        free(packed);
+        free(int8);
+        free(weights);
+        free(input);
+        free(result_ref);
+        free(result);
+        free(split);
+
+        ASSERT(fp16Match, "FP16 weight matrix multiplication should match widened reference");
+        ASSERT(fp16Exact, "Column ranges should match the full FP16 product exactly");
+        ASSERT(int2Match, "2-bit weight matrix multiplication should match dequantized reference");
+        ASSERT(int2Exact, "Column ranges should match the full 2-bit product exactly");
+        ASSERT(int8Match, "8-bit weight matrix multiplication should match dequantized reference");
+        ASSERT(int8Exact, "Column ranges should match the full 8-bit product exactly");
+    }
+    printf("    PASS\n");
+}
+
+// Test the blocked 4-bit matrix-matrix product against the scalar formula
+void test_blocked_matrix_multiplication()
+{
+    printf("  Testing blocked 4-bit matrix-matrix multiplication...\n");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+
+    // Shapes cover partial microkernel tiles, several depth blocks and a single column
+    const int shapes[][3] = {{1, 1, 2},     {7, 5, 3},     {13, 33, 17},
+                             {6, 16, 16},   {50, 700, 37}, {9, 40, 1}};
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        int rowsA = shapes[s][0], colsA = shapes[s][1], colsB = shapes[s][2];
+        int bytesPerRow = (colsA + 1) / 2;
+
+        uint8_t *a        = (uint8_t *)malloc((size_t)rowsA * bytesPerRow);
+        float   *b        = (float *)malloc((size_t)colsA * colsB * sizeof(float));
+        float   *scales   = (float *)malloc((size_t)rowsA * sizeof(float));
+        float   *serial   = (float *)malloc((size_t)rowsA * colsB * sizeof(float));
+        float   *threaded = (float *)malloc((size_t)rowsA * colsB * sizeof(float));
+        ASSERT(a && b && scales && serial && threaded, "Memory allocation failed");
+
+        for (int i = 0; i < rowsA * bytesPerRow; i++) {
+            a[i] = (uint8_t)(i * 37 + 11);
+        }
+        init_random_matrix(b, colsA * colsB);
+        for (int r = 0; r < rowsA; r++) {
+            scales[r] = 0.02f * (float)(r % 7 + 1);
+        }
+
+        tinyaiSimdMatMul4BitMM(serial, a, b, rowsA, colsA, colsB, scales);
+        for (int r = 0; r < rowsA; r++) {
+            for (int c = 0; c < colsB; c++) {
+                float expected = 0.0f;
+                for (int k = 0; k < colsA; k++) {
+                    uint8_t packed = a[r * bytesPerRow + k / 2];
+                    int     q      = (k % 2 == 0 ? packed & 0x0F : packed >> 4) - 8;
+                    expected += (float)q * scales[r] * b[k * colsB + c];
+                }
+                ASSERT(fabsf(serial[r * colsB + c] - expected) <= 1e-4f * (1.0f + fabsf(expected)),
+                       "Blocked product should match the scalar formula");
+            }
+        }
+
+        tinyaiConfigSetInt("system.threads", 4);
+        tinyaiConfigSetInt("system.parallel_min_work", 1);
+        tinyaiShutdownThreadPool();
+        tinyaiSimdMatMul4BitMM(threaded, a, b, rowsA, colsA, colsB, scales);
+        tinyaiConfigRemoveKey("system.threads");
+        tinyaiConfigRemoveKey("system.parallel_min_work");
+        tinyaiShutdownThreadPool();
+        ASSERT(memcmp(serial, threaded, (size_t)rowsA * colsB * sizeof(float)) == 0,
+               "Threaded blocked product should match the serial result exactly");
+
+        free(a);
+        free(b);
+        free(scales);
+        free(serial);
+        free(threaded);
+    }
+    printf("    PASS\n");
+}
+
+// Scalar 4-bit convolution, HWC feature maps and [kh][kw][ic][oc] weights
+static void conv_reference(float *output, const float *input, const uint8_t *weights,
+                           const float *biases, const float *scales, int inWidth, int inHeight,
+                           int inChannels, int outWidth, int outHeight, int outChannels,
+                           int kernelSize, int stride, int padding)
+{
+    for (int oh = 0; oh < outHeight; oh++) {
+        for (int ow = 0; ow < outWidth; ow++) {
+            for (int oc = 0; oc < outChannels; oc++) {
+                float sum = biases[oc];
+                for (int kh = 0; kh < kernelSize; kh++) {
+                    for (int kw = 0; kw < kernelSize; kw++) {
+                        int inH = oh * stride - padding + kh;
+                        int inW = ow * stride - padding + kw;
+                        if (inH < 0 || inH >= inHeight || inW < 0 || inW >= inWidth) {
+                            continue;
+                        }
+                        for (int ic = 0; ic < inChannels; ic++) {
+                            int index = ((kh * kernelSize + kw) * inChannels + ic) * outChannels + oc;
+                            int q     = (index % 2 == 0 ? weights[index / 2] & 0x0F
+                                                        : weights[index / 2] >> 4) - 8;
+                            float x   = input[(inH * inWidth + inW) * inChannels + ic];
+                            sum += x * (float)q * scales[oc];
+                        }
+                    }
+                }
+                output[(oh * outWidth + ow) * outChannels + oc] = sum;
+            }
+        }
+    }
+}
+
+// Test the direct, im2col + GEMM and Winograd convolution paths against the scalar formula
+void test_convolution_algorithms()
+{
+    printf("  Testing convolution algorithms...\n");
+
+    // {width, height, inChannels, outChannels, kernelSize, stride, padding, expected algorithm}
+    const int shapes[][8] = {
+        {10, 9, 16, 16, 3, 1, 1, TINYAI_SIMD_CONV_WINOGRAD_F4},
+        {5, 6, 16, 24, 3, 1, 1, TINYAI_SIMD_CONV_WINOGRAD_F2},
+        {8, 8, 12, 16, 3, 1, 1, TINYAI_SIMD_CONV_IM2COL_GEMM},
+        {9, 9, 3, 32, 3, 2, 1, TINYAI_SIMD_CONV_IM2COL_GEMM},
+        {7, 7, 24, 20, 1, 1, 0, TINYAI_SIMD_CONV_IM2COL_GEMM},
+        {6, 6, 2, 3, 3, 1, 1, TINYAI_SIMD_CONV_DIRECT},
+    };
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        int inWidth = shapes[s][0], inHeight = shapes[s][1], inChannels = shapes[s][2];
+        int outChannels = shapes[s][3], kernelSize = shapes[s][4], stride = shapes[s][5];
+        int padding   = shapes[s][6];
+        int outWidth  = (inWidth + 2 * padding - kernelSize) / stride + 1;
+        int outHeight = (inHeight + 2 * padding - kernelSize) / stride + 1;
+        int outSize   = outWidth * outHeight * outChannels;
+        int numWeights = kernelSize * kernelSize * inChannels * outChannels;
+
+        float   *input    = (float *)malloc(inWidth * inHeight * inChannels * sizeof(float));
+        uint8_t *weights  = (uint8_t *)malloc((numWeights + 1) / 2);
+        float   *biases   = (float *)malloc(outChannels * sizeof(float));
+        float   *scales   = (float *)malloc(outChannels * sizeof(float));
+        float   *expected = (float *)malloc(outSize * sizeof(float));
+        float   *output   = (float *)malloc(outSize * sizeof(float));
+        ASSERT(input && weights && biases && scales && expected && output,
+               "Memory allocation failed");
+
+        init_random_matrix(input, inWidth * inHeight * inChannels);
+        for (int i = 0; i < (numWeights + 1) / 2; i++) {
+            weights[i] = (uint8_t)(rand() & 0xFF);
+        }
+        for (int oc = 0; oc < outChannels; oc++) {
+            biases[oc] = 0.1f * (float)(oc % 5) - 0.2f;
+            scales[oc] = 0.01f + 0.002f * (float)oc;
+        }
+        conv_reference(expected, input, weights, biases, scales, inWidth, inHeight, inChannels,
+                       outWidth, outHeight, outChannels, kernelSize, stride, padding);
+
+        ASSERT(tinyaiSimdSelectConvAlgorithm(inChannels, outWidth, outHeight, outChannels,
+                                             kernelSize, stride) == shapes[s][7],
+               "Layer shape should select the expected convolution algorithm");
+
+        for (int algorithm = TINYAI_SIMD_CONV_AUTO; algorithm <= TINYAI_SIMD_CONV_WINOGRAD_F4;
+             algorithm++) {
+            bool winograd = algorithm == TINYAI_SIMD_CONV_WINOGRAD_F2 ||
+                            algorithm == TINYAI_SIMD_CONV_WINOGRAD_F4;
+            TinyAIConvPlan *plan = tinyaiSimdCreateConvPlan(
+                weights, scales, inWidth, inHeight, inChannels, outWidth, outHeight, outChannels,
+                kernelSize, stride, padding, algorithm);
+            if (winograd && (kernelSize != 3 || stride != 1)) {
+                ASSERT(plan == NULL, "Winograd should refuse layers that are not 3x3 stride-1");
+                continue;
+            }
+            ASSERT(plan != NULL, "Convolution plan creation should succeed");
+            ASSERT(tinyaiSimdConvPlanAlgorithm(plan) ==
+                       (algorithm == TINYAI_SIMD_CONV_AUTO ? shapes[s][7] : algorithm),
+                   "Plan should run the requested algorithm");
+
+            memset(output, 0, outSize * sizeof(float));
+            ASSERT(tinyaiSimdRunConvPlan(plan, output, input, biases) == 0,
+                   "Convolution plan should run");
+            float tolerance = winograd ? 1e-3f : 1e-4f;
+            for (int i = 0; i < outSize; i++) {
+                ASSERT(fabsf(output[i] - expected[i]) <= tolerance * (1.0f + fabsf(expected[i])),
+                       "Convolution plan should match the scalar formula");
+            }
+            tinyaiSimdDestroyConvPlan(plan);
+        }
+
+        tinyaiSimdConv2d4Bit(output, input, weights, biases, scales, inWidth, inHeight, inChannels,
+                             outWidth, outHeight, outChannels, kernelSize, stride, padding);
+        for (int i = 0; i < outSize; i++) {
+            ASSERT(fabsf(output[i] - expected[i]) <= 1e-3f * (1.0f + fabsf(expected[i])),
+                   "Convolution should match the scalar formula");
+        }
+
+        free(input);
+        free(weights);
+        free(biases);
+        free(scales);
+        free(expected);
+        free(output);
+    }
+    printf("    PASS\n");
+}
+
+// Test the channel-blocked layout conversions, its convolution kernels and their fused epilogues
+void test_channel_blocked_convolution()
+{
+    printf("  Testing channel-blocked convolution...\n");
+
+    // {width, height, inChannels, outChannels, kernelSize, stride, padding}
+    const int shapes[][7] = {
+        {9, 7, 3, 20, 3, 2, 1},
+        {6, 5, 16, 16, 3, 1, 1},
+        {11, 4, 13, 24, 1, 1, 0},
+    };
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        int inWidth = shapes[s][0], inHeight = shapes[s][1], inChannels = shapes[s][2];
+        int outChannels = shapes[s][3], kernelSize = shapes[s][4], stride = shapes[s][5];
+        int padding    = shapes[s][6];
+        int outWidth   = (inWidth + 2 * padding - kernelSize) / stride + 1;
+        int outHeight  = (inHeight + 2 * padding - kernelSize) / stride + 1;
+        int inSize     = inWidth * inHeight * inChannels;
+        int outSize    = outWidth * outHeight * outChannels;
+        int numWeights = kernelSize * kernelSize * inChannels * outChannels;
+        int dwWeights  = kernelSize * kernelSize * inChannels;
+        int dwSize     = outWidth * outHeight * inChannels;
+
+        ASSERT(tinyaiSimdBlockedSize(inWidth, inHeight, inChannels) ==
+                   (size_t)inWidth * inHeight * ((inChannels + 7) / 8) * 8,
+               "Blocked size should pad the channels to whole blocks");
+
+        size_t   blockedIn  = tinyaiSimdBlockedSize(inWidth, inHeight, inChannels);
+        size_t   blockedOut = tinyaiSimdBlockedSize(outWidth, outHeight, outChannels);
+        size_t   blockedDw  = tinyaiSimdBlockedSize(outWidth, outHeight, inChannels);
+        float   *input      = (float *)malloc(inSize * sizeof(float));
+        float   *roundTrip  = (float *)malloc(inSize * sizeof(float));
+        uint8_t *weights    = (uint8_t *)malloc((numWeights + 1) / 2);
+        uint8_t *dwPacked   = (uint8_t *)malloc((dwWeights + 1) / 2);
+        float   *biases     = (float *)malloc(outChannels * sizeof(float));
+        float   *scales     = (float *)malloc(outChannels * sizeof(float));
+        float   *expected   = (float *)malloc((outSize > dwSize ? outSize : dwSize) * sizeof(float));
+        float   *output     = (float *)malloc((outSize > dwSize ? outSize : dwSize) * sizeof(float));
+        float   *blocked    = (float *)malloc(blockedIn * sizeof(float));
+        float   *blockedRes = (float *)malloc(
+            (blockedOut > blockedDw ? blockedOut : blockedDw) * sizeof(float));
+        ASSERT(input && roundTrip && weights && dwPacked && biases && scales && expected &&
+                   output && blocked && blockedRes,
+               "Memory allocation failed");
+
+        init_random_matrix(input, inSize);
+        for (int i = 0; i < (numWeights + 1) / 2; i++) {
+            weights[i] = (uint8_t)(rand() & 0xFF);
+        }
+        for (int i = 0; i < (dwWeights + 1) / 2; i++) {
+            dwPacked[i] = (uint8_t)(rand() & 0xFF);
+        }
+        for (int oc = 0; oc < outChannels; oc++) {
+            biases[oc] = 0.1f * (float)(oc % 5) - 0.2f;
+            scales[oc] = 0.01f + 0.002f * (float)oc;
+        }
+
+        // Round trip, with the padded channels zeroed
+        tinyaiSimdToChannelBlocked(blocked, input, inWidth, inHeight, inChannels);
+        tinyaiSimdFromChannelBlocked(roundTrip, blocked, inWidth, inHeight, inChannels);
+        ASSERT(memcmp(roundTrip, input, inSize * sizeof(float)) == 0,
+               "Channel-blocked layout should round trip");
+        if (inChannels % 8 != 0) {
+            ASSERT(blocked[blockedIn - 1] == 0.0f, "Padded channels should be zero");
+        }
+
+        // Regular convolution
+        conv_reference(expected, input, weights, biases, scales, inWidth, inHeight, inChannels,
+                       outWidth, outHeight, outChannels, kernelSize, stride, padding);
+        float *packed =
+            tinyaiSimdPackBlockedConvWeights(weights, scales, inChannels, outChannels, kernelSize);
+        ASSERT(packed != NULL, "Packing convolution weights should succeed");
+        ASSERT(tinyaiSimdConv2dBlocked(blockedRes, blocked, packed, biases, inWidth, inHeight,
+                                       inChannels, outWidth, outHeight, outChannels, kernelSize,
+                                       stride, padding, NULL) == 0,
+               "Blocked convolution should run");
+        tinyaiSimdFromChannelBlocked(output, blockedRes, outWidth, outHeight, outChannels);
+        for (int i = 0; i < outSize; i++) {
+            ASSERT(fabsf(output[i] - expected[i]) <= 1e-4f * (1.0f + fabsf(expected[i])),
+                   "Blocked convolution should match the scalar formula");
+        }
+        if (outChannels % 8 != 0) {
+            ASSERT(blockedRes[blockedOut - 1] == 0.0f, "Padded output channels should be zero");
+        }
+
+        // Activation and pooling fused into the convolution, against separate passes
+        const TinyAIBlockedEpilogue epilogues[3] = {
+            {TINYAI_SIMD_ACTIVATION_RELU, TINYAI_SIMD_POOL_NONE, 0, 0},
+            {TINYAI_SIMD_ACTIVATION_RELU, TINYAI_SIMD_POOL_MAX, 2, 2},
+            {TINYAI_SIMD_ACTIVATION_SIGMOID, TINYAI_SIMD_POOL_AVERAGE, outHeight, 1},
+        };
+        float *fused = (float *)malloc(blockedOut * sizeof(float));
+        float *pool  = (float *)malloc(outSize * sizeof(float));
+        ASSERT(fused && pool, "Memory allocation failed");
+        for (int e = 0; e < 3; e++) {
+            const TinyAIBlockedEpilogue *epilogue = &epilogues[e];
+            int kernel = epilogue->poolType == TINYAI_SIMD_POOL_NONE ? 1 : epilogue->poolKernel;
+            int step   = epilogue->poolType == TINYAI_SIMD_POOL_NONE ? 1 : epilogue->poolStride;
+            int pooledWidth  = (outWidth - kernel) / step + 1;
+            int pooledHeight = (outHeight - kernel) / step + 1;
+
+            // Separate passes: convolution, activation, then pooling of the unpadded map
+            memcpy(pool, expected, outSize * sizeof(float));
+            tinyaiSimdActivate(pool, outSize, epilogue->activation);
+            ASSERT(tinyaiSimdConv2dBlocked(fused, blocked, packed, biases, inWidth, inHeight,
+                                           inChannels, outWidth, outHeight, outChannels,
+                                           kernelSize, stride, padding, epilogue) == 0,
+                   "Fused blocked convolution should run");
+            tinyaiSimdFromChannelBlocked(output, fused, pooledWidth, pooledHeight, outChannels);
+
+            for (int ph = 0; ph < pooledHeight; ph++) {
+                for (int pw = 0; pw < pooledWidth; pw++) {
+                    for (int oc = 0; oc < outChannels; oc++) {
+                        float value = epilogue->poolType == TINYAI_SIMD_POOL_MAX ? -1e30f : 0.0f;
+                        for (int kh = 0; kh < kernel; kh++) {
+                            for (int kw = 0; kw < kernel; kw++) {
+                                float x = pool[((ph * step + kh) * outWidth + pw * step + kw) *
+                                                   outChannels + oc];
+                                value   = epilogue->poolType == TINYAI_SIMD_POOL_MAX
+                                              ? (x > value ? x : value)
+                                              : value + x;
+                            }
+                        }
+                        if (epilogue->poolType != TINYAI_SIMD_POOL_MAX) {
+                            value /= (float)(kernel * kernel);
+                        }
+                        float got = output[(ph * pooledWidth + pw) * outChannels + oc];
+                        ASSERT(fabsf(got - value) <= 1e-4f * (1.0f + fabsf(value)),
+                               "Fused epilogue should match separate passes");
+                    }
+                }
+            }
+        }
+        free(fused);
+        free(pool);
+        free(packed);
+
+        // Depthwise convolution against the existing kernel
+        tinyaiSimdDepthwiseConv2d4Bit(expected, input, dwPacked, biases, scales, inWidth,
+                                      inHeight, inChannels, outWidth, outHeight, 1, kernelSize,
+                                      stride, padding);
+        packed = tinyaiSimdPackBlockedDepthwiseWeights(dwPacked, scales, inChannels, kernelSize);
+        ASSERT(packed != NULL, "Packing depthwise weights should succeed");
+        ASSERT(tinyaiSimdDepthwiseConv2dBlocked(blockedRes, blocked, packed, biases, inWidth,
+                                                inHeight, inChannels, outWidth, outHeight,
+                                                kernelSize, stride, padding, NULL) == 0,
+               "Blocked depthwise convolution should run");
+        tinyaiSimdFromChannelBlocked(output, blockedRes, outWidth, outHeight, inChannels);
+        for (int i = 0; i < dwSize; i++) {
+            ASSERT(fabsf(output[i] - expected[i]) <= 1e-4f * (1.0f + fabsf(expected[i])),
+                   "Blocked depthwise convolution should match the existing kernel");
+        }
+        free(packed);
+
+        free(input);
+        free(roundTrip);
+        free(weights);
+        free(dwPacked);
+        free(biases);
+        free(scales);
+        free(expected);
+        free(output);
+        free(blocked);
+        free(blockedRes);
+    }
+    printf("    PASS\n");
+}
+
+// Test min/max and affine quantization kernels against the scalar formulas
+void test_affine_quantization_kernels()
+{
+    printf("  Testing min/max and affine quantization kernels...\n");
+
+    // Odd sizes cover the vector tails
+    const int sizes[3] = {1, 37, 1000};
+    for (int s = 0; s < 3; s++) {
+        const int size   = sizes[s];
+        float    *input  = (float *)malloc(size * sizeof(float));
+        uint8_t  *out4   = (uint8_t *)malloc((size + 1) / 2);
+        int8_t   *out8   = (int8_t *)malloc(size);
+        int8_t   *outSym = (int8_t *)malloc(size);
+        init_random_matrix(input, size);
+        input[size / 2] = NAN; // NaNs are skipped by min/max
+
+        float min = FLT_MAX, max = -FLT_MAX, refMin = FLT_MAX, refMax = -FLT_MAX;
+        tinyaiSimdMinMax(input, size, &min, &max);
+        for (int i = 0; i < size; i++) {
+            if (input[i] < refMin) refMin = input[i];
+            if (input[i] > refMax) refMax = input[i];
+        }
+        ASSERT(min == refMin && max == refMax, "SIMD min/max should match scalar reduction");
+
+        // Values outside [min, max] exercise the clamps
+        input[size / 2] = 3.0f;
+        input[0]        = -3.0f;
+        const float scale = 0.13f, zeroPoint = -1.0f;
+        tinyaiSimdQuantize4BitAffine(out4, input, size, scale, zeroPoint);
+        tinyaiSimdQuantize8BitAffine(out8, input, size, scale / 16.0f, zeroPoint);
+        float symScale = tinyaiSimdQuantizeInt8(outSym, input, size);
+
+        bool match = fabsf(symScale - 3.0f / 127.0f) < 1e-7f;
+        for (int i = 0; i < size; i++) {
+            int q4 = (int)((input[i] - zeroPoint) / scale + 0.5f);
+            int q8 = (int)((input[i] - zeroPoint) / (scale / 16.0f) + 0.5f);
+            long qs = lrintf(input[i] * (1.0f / symScale));
+            q4      = q4 < 0 ? 0 : (q4 > 15 ? 15 : q4);
+            q8      = q8 < -127 ? -127 : (q8 > 127 ? 127 : q8);
+            qs      = qs < -127 ? -127 : (qs > 127 ? 127 : qs);
+            int packed = (i % 2 == 0) ? out4[i / 2] >> 4 : out4[i / 2] & 0x0F;
+            match      = match && packed == q4 && out8[i] == q8 && outSym[i] == qs;
+        }
+        if (size % 2 == 1) {
+            match = match && (out4[size / 2] & 0x0F) == 0;
+        }
+
+        free(input);
+        free(out4);
+        free(out8);
+        free(outSym);
+
+        ASSERT(match, "SIMD quantization should match the scalar formulas exactly");
+    }
+    printf("    PASS\n");
+}
+
+// Test dequantization of affine 4-bit (TinyAIMatrix4bit layout) values
+void test_affine_dequantization()
+{
+    printf("  Testing affine 4-bit dequantization...\n");
+
+    const int   size      = 45; // Not a multiple of the 16-value SIMD block
+    const float scale     = 0.25f;
+    const float zeroPoint = -1.5f;
+
+    uint8_t packed[23];
+    float   result[45];
+    for (int i = 0; i < 23; i++) {
+        packed[i] = (uint8_t)(rand() & 0xFF);
+    }
+
+    tinyaiSimdDequantize4BitAffine(result, packed, size, scale, zeroPoint);
+
+    for (int i = 0; i < size; i++) {
+        int q = (i % 2 == 0) ? (packed[i / 2] >> 4) : (packed[i / 2] & 0x0F);
+        ASSERT(fabsf(result[i] - (q * scale + zeroPoint)) < 1e-6f,
+               "Affine 4-bit dequantization should match reference");
+    }
+    printf("    PASS\n");
+}
+
+// Test softmax against a scalar reference
+void test_softmax()
+{
+    printf("  Testing softmax...\n");
+
+    // Sizes around the 4- and 16-wide SIMD blocks, with a wide spread of logits, through the
+    // AVX-512 kernel (where available) and the narrower ones
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        int sizes[4] = {1, 5, 37, 1000};
+        for (int t = 0; t < 4; t++) {
+            int    size     = sizes[t];
+            float *values   = (float *)malloc(size * sizeof(float));
+            float *expected = (float *)malloc(size * sizeof(float));
+
+            float maxValue = -1e30f;
+            for (int i = 0; i < size; i++) {
+                values[i] = ((float)rand() / RAND_MAX) * 60.0f - 40.0f;
+                if (values[i] > maxValue)
+                    maxValue = values[i];
+            }
+
+            double sum = 0.0;
+            for (int i = 0; i < size; i++) {
+                expected[i] = expf(values[i] - maxValue);
+                sum += expected[i];
+            }
+
+            tinyaiSimdSoftmax(values, size);
+
+            float total = 0.0f;
+            for (int i = 0; i < size; i++) {
+                float ref = (float)(expected[i] / sum);
+                ASSERT(fabsf(values[i] - ref) <= 1e-5f * ref + 1e-12f,
+                       "Softmax should match the scalar reference");
+                total += values[i];
+            }
+            ASSERT(fabsf(total - 1.0f) < 1e-4f, "Softmax should sum to one");
+
+            free(values);
+            free(expected);
+        }
+    }
+    printf("    PASS\n");
+}
+
+// Test fused elementwise chains against the same operations applied one pass at a time
+void test_elementwise_fusion()
+{
+    printf("  Testing fused elementwise chains...\n");
+
+    // Invalid chains are rejected
+    float               one       = 1.0f;
+    TinyAIElementwiseOp noOperand = {TINYAI_SIMD_EW_RESIDUAL, 0, NULL, NULL, 1.0f, 0.0f};
+    TinyAIElementwiseOp badScale  = {TINYAI_SIMD_EW_QUANTIZE, 0, NULL, NULL, 0.0f, 0.0f};
+    ASSERT(tinyaiSimdElementwise(&one, &one, 1, 1, &noOperand, 1) == -1,
+           "A residual without an operand should be rejected");
+    ASSERT(tinyaiSimdElementwise(&one, &one, 1, 1, &badScale, 1) == -1,
+           "Quantization with a zero scale should be rejected");
+
+    // Column counts around the 4-, 8- and 16-wide SIMD blocks
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        int colCounts[5] = {1, 5, 8, 37, 100};
+        for (int t = 0; t < 5; t++) {
+            int    rows = 3, cols = colCounts[t], size = rows * cols;
+            float *in       = (float *)malloc(size * sizeof(float));
+            float *residual = (float *)malloc(size * sizeof(float));
+            float *gate     = (float *)malloc(size * sizeof(float));
+            float *bias     = (float *)malloc(cols * sizeof(float));
+            float *expected = (float *)malloc(size * sizeof(float));
+            float *fused    = (float *)malloc(size * sizeof(float));
+            int8_t *levels  = (int8_t *)malloc(size);
+
+            for (int i = 0; i < size; i++) {
+                in[i]       = ((float)rand() / RAND_MAX) * 8.0f - 4.0f;
+                residual[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+                gate[i]     = ((float)rand() / RAND_MAX) * 2.0f;
+            }
+            for (int c = 0; c < cols; c++) {
+                bias[c] = ((float)rand() / RAND_MAX) - 0.5f;
+            }
+
+            // bias, residual, gate, scale, GELU and clamp one pass at a time
+            for (int r = 0; r < rows; r++) {
+                for (int c = 0; c < cols; c++) {
+                    int i       = r * cols + c;
+                    expected[i] = ((in[i] + bias[c] + 0.5f * residual[i]) * gate[i]) * 1.5f - 0.25f;
+                }
+            }
+            tinyaiSimdActivate(expected, size, TINYAI_SIMD_ACTIVATION_GELU);
+            for (int i = 0; i < size; i++) {
+                expected[i] = expected[i] < -0.1f ? -0.1f : (expected[i] > 3.0f ? 3.0f : expected[i]);
+            }
+
+            TinyAIElementwiseOp ops[6] = {
+                {TINYAI_SIMD_EW_BIAS, 0, bias, NULL, 0.0f, 0.0f},
+                {TINYAI_SIMD_EW_RESIDUAL, 0, residual, NULL, 0.5f, 0.0f},
+                {TINYAI_SIMD_EW_MULTIPLY, 0, gate, NULL, 0.0f, 0.0f},
+                {TINYAI_SIMD_EW_SCALE, 0, NULL, NULL, 1.5f, -0.25f},
+                {TINYAI_SIMD_EW_ACTIVATION, TINYAI_SIMD_ACTIVATION_GELU, NULL, NULL, 0.0f, 0.0f},
+                {TINYAI_SIMD_EW_CLAMP, 0, NULL, NULL, -0.1f, 3.0f},
+            };
+            ASSERT(tinyaiSimdElementwise(fused, in, rows, cols, ops, 6) == 0,
+                   "Fused chain should succeed");
+            for (int i = 0; i < size; i++) {
+                ASSERT(fabsf(fused[i] - expected[i]) <= 1e-5f * (1.0f + fabsf(expected[i])),
+                       "Fused chain should match separate passes");
+            }
+
+            // In place, ending on a quantization step whose levels are written out
+            float               scale    = 3.0f / 127.0f;
+            TinyAIElementwiseOp quant[2] = {
+                {TINYAI_SIMD_EW_ACTIVATION, TINYAI_SIMD_ACTIVATION_RELU, NULL, NULL, 0.0f, 0.0f},
+                {TINYAI_SIMD_EW_QUANTIZE, 0, NULL, levels, scale, 0.0f},
+            };
+            memcpy(fused, in, size * sizeof(float));
+            ASSERT(tinyaiSimdElementwise(fused, fused, rows, cols, quant, 2) == 0,
+                   "In-place fused chain should succeed");
+            for (int i = 0; i < size; i++) {
+                float relu = in[i] > 0.0f ? in[i] : 0.0f;
+                long  q    = lrintf(fminf(relu / scale, 127.0f));
+                ASSERT(abs(levels[i] - (int)q) <= 1, "Quantized levels should round the input");
+                ASSERT(fused[i] == levels[i] * scale, "Quantized values should sit on the grid");
+            }
+
+            free(in);
+            free(residual);
+            free(gate);
+            free(bias);
+            free(expected);
+            free(fused);
+            free(levels);
+        }
+    }
+    printf("    PASS\n");
+}
+
+// Test the reductions, argmax, log-sum-exp and temperature softmax shared with the models
+void test_softmax_primitives()
+{
+    printf("  Testing softmax primitives...\n");
+
+    ASSERT(tinyaiSimdArgmax(NULL, 0) == -1, "Argmax of an empty vector should be -1");
+    ASSERT(tinyaiSimdReduceMax(NULL, 0) == -INFINITY, "Max of an empty vector should be -inf");
+
+    // Sizes around the 4-, 8- and 16-wide SIMD blocks
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        int sizes[6] = {1, 3, 8, 17, 37, 1000};
+        for (int t = 0; t < 6; t++) {
+            int    size   = sizes[t];
+            float *values = (float *)malloc(size * sizeof(float));
+            float *probs  = (float *)malloc(size * sizeof(float));
+
+            int arg = 0;
+            for (int i = 0; i < size; i++) {
+                values[i] = ((float)rand() / RAND_MAX) * 60.0f - 40.0f;
+                if (values[i] > values[arg])
+                    arg = i;
+            }
+
+            // A tie after the maximum must not move the argmax
+            if (arg + 1 < size)
+                values[size - 1] = values[arg];
+
+            double sum = 0.0;
+            for (int i = 0; i < size; i++)
+                sum += values[i];
+
+            ASSERT(tinyaiSimdReduceMax(values, size) == values[arg],
+                   "Max reduction should find the largest element");
+            ASSERT(fabs(tinyaiSimdReduceSum(values, size) - sum) < 1e-3 * (1.0 + fabs(sum)),
+                   "Sum reduction should match the scalar sum");
+
+            // Dot product of the values with a reversed copy of themselves
+            double dot = 0.0, dotScale = 0.0;
+            for (int i = 0; i < size; i++) {
+                probs[i] = values[size - 1 - i];
+                dot += (double)values[i] * probs[i];
+                dotScale += fabs((double)values[i] * probs[i]);
+            }
+            ASSERT(fabs(tinyaiSimdDot(values, probs, size) - dot) < 1e-5 * (1.0 + dotScale),
+                   "Dot product should match the scalar dot product");
+            ASSERT(tinyaiSimdArgmax(values, size) == arg, "Argmax should find the first maximum");
+
+            // log-sum-exp against a double-precision reference
+            double expSum = 0.0;
+            for (int i = 0; i < size; i++)
+                expSum += exp((double)values[i] - values[arg]);
+            double lse = values[arg] + log(expSum);
+            ASSERT(fabs(tinyaiSimdLogSumExp(values, size) - lse) < 1e-4 * (1.0 + fabs(lse)),
+                   "Log-sum-exp should match the reference");
+
+            // Temperature softmax out of place equals softmax of the scaled logits
+            float temperatures[3] = {0.5f, 1.0f, 2.5f};
+            for (int k = 0; k < 3; k++) {
+                float temperature = temperatures[k];
+                tinyaiSimdSoftmaxTemperature(probs, values, size, temperature);
+
+                double total = 0.0;
+                for (int i = 0; i < size; i++)
+                    total += exp(((double)values[i] - values[arg]) / temperature);
+                for (int i = 0; i < size; i++) {
+                    float ref = (float)(exp(((double)values[i] - values[arg]) / temperature) / total);
+                    ASSERT(fabsf(probs[i] - ref) <= 1e-5f * ref + 1e-12f,
+                           "Temperature softmax should match the reference");
+                }
+            }
+
+            free(values);
+            free(probs);
+        }
+    }
+    printf("    PASS\n");
+}
+
+// Test layer normalization with residual add and fused activation
+void test_layer_norm()
+{
+    printf("  Testing layer normalization...\n");
+
+    // Sizes around the 4- and 8-wide SIMD blocks, with a large offset to stress the variance
+    int sizes[5] = {1, 7, 8, 37, 768};
+    for (int t = 0; t < 5; t++) {
+        int    size     = sizes[t];
+        float *input    = (float *)malloc(size * sizeof(float));
+        float *residual = (float *)malloc(size * sizeof(float));
+        float *gamma    = (float *)malloc(size * sizeof(float));
+        float *beta     = (float *)malloc(size * sizeof(float));
+        float *output   = (float *)malloc(size * sizeof(float));
+        float *expected = (float *)malloc(size * sizeof(float));
+
+        for (int i = 0; i < size; i++) {
+            input[i]    = 100.0f + ((float)rand() / RAND_MAX) * 4.0f - 2.0f;
+            residual[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+            gamma[i]    = ((float)rand() / RAND_MAX) + 0.5f;
+            beta[i]     = ((float)rand() / RAND_MAX) - 0.5f;
+        }
+
+        // Two-pass reference in double precision
+        double mean = 0.0, variance = 0.0;
+        for (int i = 0; i < size; i++) {
+            mean += (double)input[i] + residual[i];
+        }
+        mean /= size;
+        for (int i = 0; i < size; i++) {
+            double diff = (double)input[i] + residual[i] - mean;
+            variance += diff * diff;
+        }
+        variance /= size;
+        for (int i = 0; i < size; i++) {
+            double x    = ((double)input[i] + residual[i] - mean) / sqrt(variance + 1e-5);
+            expected[i] = (float)(x * gamma[i] + beta[i]);
+        }
+
+        tinyaiSimdLayerNorm(output, input, residual, gamma, beta, size, 1e-5f, -1);
+        ASSERT(compare_float_arrays(output, expected, size, 1e-3f),
+               "Layer norm should match the two-pass reference");
+
+        // Fused ReLU, written in place over the input
+        tinyaiSimdLayerNorm(input, input, residual, gamma, beta, size, 1e-5f, 0);
+        for (int i = 0; i < size; i++) {
+            expected[i] = expected[i] > 0.0f ? expected[i] : 0.0f;
+        }
+        ASSERT(compare_float_arrays(input, expected, size, 1e-3f),
+               "Layer norm with fused ReLU should match the reference");
+
+        // Without scale, shift or residual the output has zero mean and unit variance
+        if (size > 1) {
+            tinyaiSimdLayerNorm(output, residual, NULL, NULL, NULL, size, 0.0f, -1);
+            double sum = 0.0, sumSq = 0.0;
+            for (int i = 0; i < size; i++) {
+                sum += output[i];
+                sumSq += (double)output[i] * output[i];
+            }
+            ASSERT(fabs(sum / size) < 1e-4 && fabs(sumSq / size - 1.0) < 1e-3,
+                   "Normalized output should have zero mean and unit variance");
+        }
+
+        free(input);
+        free(residual);
+        free(gamma);
+        free(beta);
+        free(output);
+        free(expected);
+    }
+    printf("    PASS\n");
+}
+
 // Test vector addition
 void test_vector_addition()
 {
@@ -150,7 +1490,150 @@ void test_vector_addition()
     printf("    PASS\n");
 }
 
+// Test scaled accumulation with tails, through the AVX-512 kernel (where available) and the others
+void test_vector_scale_add()
+{
+    printf("  Testing scaled vector accumulation...\n");
+
+    float x[37], out[37], expected[37];
+    bool  match = true;
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        for (int size = 1; size <= 37; size += 6) {
+            for (int i = 0; i < size; i++) {
+                x[i]        = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+                out[i]      = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+                expected[i] = out[i] - 0.75f * x[i];
+            }
+            tinyaiSimdVecScaleAdd(out, x, -0.75f, size);
+            match = match && compare_float_arrays(expected, out, size, 1e-6f);
+        }
+    }
+    tinyaiSimdSetAVX512Enabled(true);
+
+    ASSERT(match, "Scaled accumulation should match reference implementation");
+    printf("    PASS\n");
+}
+
+// Test int8 dot products across every tail length of the vector loops
+void test_int8_dot_product()
+{
+    printf("  Testing int8 dot products...\n");
+
+    int8_t a[71], b[71];
+    bool   match = true;
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        for (int size = 0; size <= 71; size++) {
+            int32_t expected = 0;
+            for (int i = 0; i < size; i++) {
+                a[i] = (int8_t)(rand() % 255 - 127);
+                b[i] = (int8_t)(rand() % 255 - 127);
+                expected += (int32_t)a[i] * b[i];
+            }
+            if (size > 0) {
+                a[0]     = -127;
+                b[0]     = -127;
+                expected = 0;
+                for (int i = 0; i < size; i++) {
+                    expected += (int32_t)a[i] * b[i];
+                }
+            }
+            match = match && tinyaiSimdDotInt8(a, b, size) == expected;
+        }
+    }
+    tinyaiSimdSetAVX512Enabled(true);
+
+    ASSERT(match, "Int8 dot products should match reference implementation");
+    printf("    PASS\n");
+}
+
+// Test logit masking, with tails after the vector loops
+void test_mask_logits()
+{
+    printf("  Testing logit masking...\n");
+
+    float    logits[70];
+    uint32_t mask[3];
+    bool     match = true;
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        for (int size = 1; size <= 70; size++) {
+            for (int i = 0; i < 3; i++) {
+                mask[i] = (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+            }
+            for (int i = 0; i < size; i++) {
+                logits[i] = (float)(rand() % 200 - 100) / 10.0f;
+            }
+            float original[70];
+            memcpy(original, logits, sizeof(logits));
+
+            tinyaiSimdMaskLogits(logits, mask, size);
+            for (int i = 0; i < size; i++) {
+                bool kept = (mask[i >> 5] >> (i & 31)) & 1u;
+                match     = match && (kept ? logits[i] == original[i]
+                                           : isinf(logits[i]) && logits[i] < 0.0f);
+            }
+        }
+    }
+    tinyaiSimdSetAVX512Enabled(true);
+
+    ASSERT(match, "Masked logits should be kept or set to negative infinity");
+    printf("    PASS\n");
+}
+
 // Test activation functions
+// Test 16-bit PCM conversion with downmixing, with tails after the vector loops
+void test_pcm16_to_mono()
+{
+    printf("  Testing 16-bit PCM to mono conversion...\n");
+
+    const int frames = 37;
+    int16_t   input[37 * 3];
+    float     output[37];
+    for (int i = 0; i < frames * 3; i++) {
+        input[i] = (int16_t)(rand() % 65536 - 32768);
+    }
+    input[0] = -32768;
+
+    for (int channels = 1; channels <= 3; channels++) {
+        tinyaiSimdPCM16ToMono(input, channels, frames, output);
+        bool match = true;
+        for (int i = 0; i < frames; i++) {
+            double sum = 0.0;
+            for (int c = 0; c < channels; c++) {
+                sum += input[i * channels + c];
+            }
+            match = match && output[i] == (float)(sum / (32768.0 * channels));
+        }
+        ASSERT(match, "PCM conversion should average the channels of every frame");
+    }
+    printf("    PASS\n");
+}
+
+void test_zero_crossings()
+{
+    printf("  Testing zero-crossing count...\n");
+
+    float x[45];
+    for (int i = 0; i < 45; i++) {
+        x[i] = (float)(rand() % 7 - 3);
+    }
+    x[5] = -0.0f;
+
+    /* Every length exercises a different split between vector steps and tail */
+    bool match = true;
+    for (int size = 0; size <= 45; size++) {
+        int expected = 0;
+        for (int i = 1; i < size; i++) {
+            expected += (x[i - 1] < 0.0f) != (x[i] < 0.0f);
+        }
+        match = match && tinyaiSimdCountZeroCrossings(x, size) == expected;
+    }
+    ASSERT(match, "Zero-crossing count should match the scalar count for every length");
+    printf("    PASS\n");
+}
+
 void test_activation_functions()
 {
     printf("  Testing activation functions...\n");
@@ -220,6 +1703,82 @@ void test_activation_functions()
     printf("    PASS\n");
 }
 
+// Test every activation type against libm, including tails and saturating inputs
+void test_vectorized_activations()
+{
+    printf("  Testing vectorized activations...\n");
+
+    // 37 values leave a partial vector after every SIMD width
+    const int size = 37;
+    float     input[37];
+    float     values[37];
+    for (int i = 0; i < size; i++) {
+        input[i] = ((float)rand() / RAND_MAX) * 16.0f - 8.0f;
+    }
+    input[0] = 0.0f;
+    input[1] = -100.0f;
+    input[2] = 100.0f;
+    input[3] = 1e-4f;
+    input[4] = -0.1f;
+    input[5] = 88.0f;  // exp close to FLT_MAX
+    input[6] = -95.0f; // exp denormal
+
+    bool match = true;
+    for (int wide = 0; wide < 2; wide++) {
+        tinyaiSimdSetAVX512Enabled(wide != 0);
+        for (int type = TINYAI_SIMD_ACTIVATION_RELU; type <= TINYAI_SIMD_ACTIVATION_EXP; type++) {
+            memcpy(values, input, sizeof(values));
+            tinyaiSimdActivate(values, size, type);
+
+            for (int i = 0; i < size; i++) {
+                float  x = input[i];
+                double expected;
+                switch (type) {
+                case TINYAI_SIMD_ACTIVATION_RELU:
+                    expected = x > 0.0f ? x : 0.0f;
+                    break;
+                case TINYAI_SIMD_ACTIVATION_GELU:
+                    expected = 0.5 * x * (1.0 + tanh(0.7978845608 * (x + 0.044715 * x * x * x)));
+                    break;
+                case TINYAI_SIMD_ACTIVATION_SIGMOID:
+                    expected = 1.0 / (1.0 + exp(-x));
+                    break;
+                case TINYAI_SIMD_ACTIVATION_TANH:
+                    expected = tanh(x);
+                    break;
+                case TINYAI_SIMD_ACTIVATION_SILU:
+                    expected = x / (1.0 + exp(-x));
+                    break;
+                default:
+                    expected = exp(x);
+                    break;
+                }
+
+                // Relative bound for large results, absolute near zero; rounded to float first
+                // so results past FLT_MAX compare as infinity
+                expected     = (float)expected;
+                double error = isinf(expected) ? (values[i] == expected ? 0.0 : INFINITY)
+                                               : fabs((double)values[i] - expected);
+                if (!(error <= 2e-6 * fabs(expected) + 1e-6)) {
+                    printf("    Mismatch: type %d x=%g got %g expected %g\n", type, x, values[i],
+                           expected);
+                    match = false;
+                }
+            }
+        }
+    }
+    tinyaiSimdSetAVX512Enabled(true);
+
+    // Unknown types leave the data alone
+    memcpy(values, input, sizeof(values));
+    tinyaiSimdActivate(values, size, 99);
+    bool unchanged = memcmp(values, input, sizeof(values)) == 0;
+
+    ASSERT(match, "Vectorized activations should stay within 2e-6 of libm");
+    ASSERT(unchanged, "Unknown activation types should leave the vector unchanged");
+    printf("    PASS\n");
+}
+
 // Test quantization and dequantization
 void test_quantization()
 {
@@ -346,8 +1905,30 @@ void run_simd_ops_tests()
 
     test_simd_availability();
     test_matrix_vector_multiplication();
+    test_runtime_kernel_selection();
+    test_affine_vector_matrix_multiplication();
+    test_prepacked_matrix_multiplication();
+    test_grouped_matrix_multiplication();
+    test_codebook_matrix_multiplication();
+    test_int8_activation_matrix_multiplication();
+    test_fp16_and_2bit_matrix_multiplication();
+    test_blocked_matrix_multiplication();
+    test_convolution_algorithms();
+    test_channel_blocked_convolution();
+    test_affine_quantization_kernels();
+    test_affine_dequantization();
+    test_softmax();
+    test_softmax_primitives();
+    test_elementwise_fusion();
+    test_layer_norm();
     test_vector_addition();
+    test_vector_scale_add();
+    test_int8_dot_product();
+    test_mask_logits();
+    test_pcm16_to_mono();
+    test_zero_crossings();
     test_activation_functions();
+    test_vectorized_activations();
     test_quantization();
     test_performance_benchmarking();
 
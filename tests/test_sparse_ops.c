@@ -3,10 +3,14 @@
  * @brief Test for sparse matrix operations
  */
 
+#include "../core/config.h"
+#include "../utils/prune.h"
 #include "../utils/sparse_ops.h"
+#include "../utils/thread_pool.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #define TEST_ROWS 100
@@ -478,6 +482,639 @@ static bool test4BitCSRMatrixVectorMul()
     return success;
 }
 
+/* Test BSR matrix conversion for every supported block height */
+static bool testBSRMatrixConversion()
+{
+    printf("Testing BSR matrix conversion...\n");
+
+    float *dense  = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+    float *dense2 = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+    if (!dense || !dense2) {
+        printf("Memory allocation failed\n");
+        free(dense);
+        free(dense2);
+        return false;
+    }
+
+    generateRandomSparseMatrix(dense, TEST_ROWS, TEST_COLS, SPARSITY);
+
+    const int32_t blockRows[] = {1, 4, 8};
+    bool          success     = true;
+
+    for (int b = 0; b < 3 && success; b++) {
+        TinyAIBSRMatrix *bsr =
+            tinyaiCreateBSRMatrixFromDense(dense, TEST_ROWS, TEST_COLS, blockRows[b], THRESHOLD);
+        if (!bsr || !tinyaiBSRMatrixToDense(bsr, dense2)) {
+            printf("Failed to create or convert %dx8 BSR matrix\n", blockRows[b]);
+            tinyaiBSRMatrixFree(bsr);
+            success = false;
+            break;
+        }
+
+        for (int i = 0; i < TEST_ROWS * TEST_COLS; i++) {
+            float expected = fabsf(dense[i]) >= THRESHOLD ? dense[i] : 0.0f;
+            if (dense2[i] != expected) {
+                printf("Mismatch at index %d: original = %f, %dx8 BSR = %f\n", i, expected,
+                       blockRows[b], dense2[i]);
+                success = false;
+                break;
+            }
+        }
+
+        printf("%dx8 BSR blocks: %d, compression ratio: %.2f\n", blockRows[b], bsr->nnzBlocks,
+               tinyaiBSRMatrixCompressionRatio(bsr));
+        tinyaiBSRMatrixFree(bsr);
+    }
+
+    /* Unsupported block shapes are rejected */
+    if (tinyaiCreateBSRMatrixFromDense(dense, TEST_ROWS, TEST_COLS, 3, THRESHOLD) != NULL) {
+        printf("3x8 BSR matrix should have been rejected\n");
+        success = false;
+    }
+
+    free(dense2);
+    free(dense);
+
+    return success;
+}
+
+/* Test BSR matrix-vector multiplication on block-pruned matrices */
+static bool testBSRMatrixVectorMul()
+{
+    printf("Testing BSR matrix-vector multiplication...\n");
+
+    float *dense = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+    float *x     = (float *)malloc(TEST_COLS * sizeof(float));
+    float *y1    = (float *)malloc(TEST_ROWS * sizeof(float));
+    float *y2    = (float *)malloc(TEST_ROWS * sizeof(float));
+    if (!dense || !x || !y1 || !y2) {
+        printf("Memory allocation failed\n");
+        free(dense);
+        free(x);
+        free(y1);
+        free(y2);
+        return false;
+    }
+
+    generateRandomVector(x, TEST_COLS);
+
+    const int32_t blockRows[] = {1, 4, 8};
+    bool          success     = true;
+
+    for (int b = 0; b < 3 && success; b++) {
+        /* Moderately sparse matrix pruned in whole blocks */
+        generateRandomSparseMatrix(dense, TEST_ROWS, TEST_COLS, THRESHOLD);
+        if (!tinyaiPruneMatrixBlocks(dense, TEST_ROWS, TEST_COLS, blockRows[b],
+                                     TINYAI_BSR_BLOCK_COLS, 0.7f)) {
+            printf("Failed to block prune matrix\n");
+            success = false;
+            break;
+        }
+
+        /* Reference result using dense matrix multiplication */
+        for (int i = 0; i < TEST_ROWS; i++) {
+            y1[i] = 0.0f;
+            for (int j = 0; j < TEST_COLS; j++) {
+                y1[i] += dense[i * TEST_COLS + j] * x[j];
+            }
+        }
+
+        TinyAIBSRMatrix *bsr =
+            tinyaiCreateBSRMatrixFromDense(dense, TEST_ROWS, TEST_COLS, blockRows[b], THRESHOLD);
+        if (!bsr || !tinyaiBSRMatrixVectorMul(bsr, x, y2)) {
+            printf("Failed to perform %dx8 BSR matrix-vector multiplication\n", blockRows[b]);
+            tinyaiBSRMatrixFree(bsr);
+            success = false;
+            break;
+        }
+
+        int32_t blockCount = ((TEST_ROWS + blockRows[b] - 1) / blockRows[b]) *
+                             ((TEST_COLS + TINYAI_BSR_BLOCK_COLS - 1) / TINYAI_BSR_BLOCK_COLS);
+        if (bsr->nnzBlocks > blockCount - (int32_t)(0.7f * blockCount)) {
+            printf("%dx8 BSR matrix stores %d blocks after pruning\n", blockRows[b],
+                   bsr->nnzBlocks);
+            success = false;
+        }
+
+        for (int i = 0; i < TEST_ROWS && success; i++) {
+            if (!floatEqual(y1[i], y2[i], 1e-4f)) {
+                printf("Mismatch at index %d: reference = %f, %dx8 BSR = %f\n", i, y1[i],
+                       blockRows[b], y2[i]);
+                success = false;
+            }
+        }
+        tinyaiBSRMatrixFree(bsr);
+
+        /* 4-bit variant, within the quantization error of each block */
+        TinyAIBSRMatrix4Bit *bsr4 = tinyaiCreateBSRMatrix4BitFromDense(
+            dense, TEST_ROWS, TEST_COLS, blockRows[b], THRESHOLD);
+        if (!bsr4 || !tinyaiBSRMatrix4BitVectorMul(bsr4, x, y2)) {
+            printf("Failed to perform 4-bit %dx8 BSR matrix-vector multiplication\n",
+                   blockRows[b]);
+            tinyaiBSRMatrix4BitFree(bsr4);
+            success = false;
+            break;
+        }
+
+        float mse = 0.0f;
+        for (int i = 0; i < TEST_ROWS; i++) {
+            float error = y1[i] - y2[i];
+            mse += error * error;
+        }
+        mse /= TEST_ROWS;
+        printf("Mean squared error (4-bit %dx8 BSR): %g\n", blockRows[b], mse);
+
+        /* Each weight is off by at most half a step of 2/15 and |x| <= 1 */
+        float errorTolerance = (1.0f / 15.0f) * TEST_COLS * 0.3f;
+        for (int i = 0; i < TEST_ROWS && success; i++) {
+            if (fabsf(y1[i] - y2[i]) > errorTolerance) {
+                printf("Mismatch at index %d: reference = %f, 4-bit %dx8 BSR = %f\n", i, y1[i],
+                       blockRows[b], y2[i]);
+                success = false;
+            }
+        }
+
+        /* Pruned blocks dequantize to exact zeros */
+        float *dense2 = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+        if (dense2 && tinyaiBSRMatrix4BitToDense(bsr4, dense2)) {
+            for (int i = 0; i < TEST_ROWS * TEST_COLS && success; i++) {
+                if (dense[i] == 0.0f && dense2[i] != 0.0f) {
+                    printf("Pruned value at index %d dequantized to %f\n", i, dense2[i]);
+                    success = false;
+                }
+            }
+        }
+        free(dense2);
+        tinyaiBSRMatrix4BitFree(bsr4);
+    }
+
+    free(y2);
+    free(y1);
+    free(x);
+    free(dense);
+
+    return success;
+}
+
+/* Test N:M structured sparsity: pruning, conversion and matrix products */
+static bool testNMMatrix()
+{
+    printf("Testing N:M structured sparse matrices...\n");
+
+    const int batch  = 5;
+    float    *dense  = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+    float    *dense2 = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+    float    *x      = (float *)malloc(batch * TEST_COLS * sizeof(float));
+    float    *y1     = (float *)malloc(batch * TEST_ROWS * sizeof(float));
+    float    *y2     = (float *)malloc(batch * TEST_ROWS * sizeof(float));
+    if (!dense || !dense2 || !x || !y1 || !y2) {
+        printf("Memory allocation failed\n");
+        free(dense);
+        free(dense2);
+        free(x);
+        free(y1);
+        free(y2);
+        return false;
+    }
+
+    generateRandomVector(x, batch * TEST_COLS);
+
+    const int32_t patterns[][2] = {{2, 4}, {1, 4}, {3, 4}, {1, 2}};
+    bool          success       = true;
+
+    for (int p = 0; p < 4 && success; p++) {
+        int32_t n = patterns[p][0];
+        int32_t m = patterns[p][1];
+
+        generateRandomSparseMatrix(dense, TEST_ROWS, TEST_COLS, THRESHOLD);
+        if (!tinyaiPruneMatrixNM(dense, TEST_ROWS, TEST_COLS, n, m)) {
+            printf("Failed to apply %d:%d pruning\n", n, m);
+            success = false;
+            break;
+        }
+
+        /* Every full group keeps exactly n non-zeros */
+        float expectedSparsity = 1.0f - (float)n / (float)m;
+        float sparsity         = tinyaiCalculateSparsity(dense, TEST_ROWS, TEST_COLS, THRESHOLD);
+        if (fabsf(sparsity - expectedSparsity) > 0.02f) {
+            printf("%d:%d pruning gave sparsity %f\n", n, m, sparsity);
+            success = false;
+        }
+
+        TinyAINMMatrix *nm = tinyaiCreateNMMatrixFromDense(dense, TEST_ROWS, TEST_COLS, n, m);
+        if (!nm || !tinyaiNMMatrixToDense(nm, dense2)) {
+            printf("Failed to create or convert %d:%d matrix\n", n, m);
+            tinyaiNMMatrixFree(nm);
+            success = false;
+            break;
+        }
+
+        for (int i = 0; i < TEST_ROWS * TEST_COLS && success; i++) {
+            if (dense2[i] != dense[i]) {
+                printf("Mismatch at index %d: original = %f, %d:%d = %f\n", i, dense[i], n, m,
+                       dense2[i]);
+                success = false;
+            }
+        }
+
+        /* Reference result using dense matrix multiplication */
+        for (int b = 0; b < batch; b++) {
+            for (int i = 0; i < TEST_ROWS; i++) {
+                y1[b * TEST_ROWS + i] = 0.0f;
+                for (int j = 0; j < TEST_COLS; j++) {
+                    y1[b * TEST_ROWS + i] += dense[i * TEST_COLS + j] * x[b * TEST_COLS + j];
+                }
+            }
+        }
+
+        if (!tinyaiNMMatrixVectorMul(nm, x, y2)) {
+            printf("Failed to perform %d:%d matrix-vector multiplication\n", n, m);
+            success = false;
+        }
+        for (int i = 0; i < TEST_ROWS && success; i++) {
+            if (!floatEqual(y1[i], y2[i], 1e-4f)) {
+                printf("Mismatch at index %d: reference = %f, %d:%d = %f\n", i, y1[i], n, m,
+                       y2[i]);
+                success = false;
+            }
+        }
+
+        if (!tinyaiNMMatrixMatMul(nm, x, batch, y2)) {
+            printf("Failed to perform %d:%d matrix multiplication\n", n, m);
+            success = false;
+        }
+        for (int i = 0; i < batch * TEST_ROWS && success; i++) {
+            if (!floatEqual(y1[i], y2[i], 1e-4f)) {
+                printf("Batched mismatch at index %d: reference = %f, %d:%d = %f\n", i, y1[i],
+                       n, m, y2[i]);
+                success = false;
+            }
+        }
+
+        printf("%d:%d compression ratio: %.2f\n", n, m, tinyaiNMMatrixCompressionRatio(nm));
+        tinyaiNMMatrixFree(nm);
+    }
+
+    /* Groups wider than the 2-bit positions can address are rejected */
+    if (tinyaiCreateNMMatrixFromDense(dense, TEST_ROWS, TEST_COLS, 2, 8) != NULL) {
+        printf("2:8 matrix should have been rejected\n");
+        success = false;
+    }
+
+    free(y2);
+    free(y1);
+    free(x);
+    free(dense2);
+    free(dense);
+
+    return success;
+}
+
+/* Test sparse x dense matrix products against repeated matrix-vector products */
+static bool testSparseDenseMatMul()
+{
+    printf("Testing sparse x dense matrix multiplication...\n");
+
+    /* Wide enough to exercise the full register tiles and the scalar tail */
+    const int batch  = 45;
+    float    *dense  = (float *)malloc(TEST_ROWS * TEST_COLS * sizeof(float));
+    float    *x      = (float *)malloc(TEST_COLS * batch * sizeof(float));
+    float    *column = (float *)malloc(TEST_COLS * sizeof(float));
+    float    *yRef   = (float *)malloc(TEST_ROWS * sizeof(float));
+    float    *y      = (float *)malloc(TEST_ROWS * batch * sizeof(float));
+    float    *yPar   = (float *)malloc(TEST_ROWS * batch * sizeof(float));
+    if (!dense || !x || !column || !yRef || !y || !yPar) {
+        printf("Memory allocation failed\n");
+        free(dense);
+        free(x);
+        free(column);
+        free(yRef);
+        free(y);
+        free(yPar);
+        return false;
+    }
+
+    generateRandomSparseMatrix(dense, TEST_ROWS, TEST_COLS, 0.7f);
+    generateRandomVector(x, TEST_COLS * batch);
+
+    TinyAICSRMatrix *csr = tinyaiCreateCSRMatrixFromDense(dense, TEST_ROWS, TEST_COLS, THRESHOLD);
+    TinyAIBSRMatrix *bsr =
+        tinyaiCreateBSRMatrixFromDense(dense, TEST_ROWS, TEST_COLS, 4, THRESHOLD);
+    bool success = csr && bsr;
+
+    for (int format = 0; format < 2 && success; format++) {
+        const char *name = format == 0 ? "CSR" : "BSR";
+
+        success = format == 0 ? tinyaiCSRMatrixDenseMatMul(csr, x, batch, y)
+                              : tinyaiBSRMatrixDenseMatMul(bsr, x, batch, y);
+
+        /* Every output column matches the matrix-vector product of its input column */
+        for (int b = 0; b < batch && success; b++) {
+            for (int j = 0; j < TEST_COLS; j++) {
+                column[j] = x[j * batch + b];
+            }
+            if (format == 0) {
+                tinyaiCSRMatrixVectorMul(csr, column, yRef);
+            }
+            else {
+                tinyaiBSRMatrixVectorMul(bsr, column, yRef);
+            }
+
+            for (int i = 0; i < TEST_ROWS; i++) {
+                if (!floatEqual(yRef[i], y[i * batch + b], 1e-4f)) {
+                    printf("%s mismatch at row %d, column %d: reference = %f, SpMM = %f\n", name,
+                           i, b, yRef[i], y[i * batch + b]);
+                    success = false;
+                    break;
+                }
+            }
+        }
+
+        /* Splitting rows across threads gives bit-identical results */
+        if (success && tinyaiConfigInit() == 0) {
+            tinyaiConfigSetInt("system.threads", 4);
+            tinyaiConfigSetInt("system.parallel_min_work", 1);
+            tinyaiShutdownThreadPool();
+            success = format == 0 ? tinyaiCSRMatrixDenseMatMul(csr, x, batch, yPar)
+                                  : tinyaiBSRMatrixDenseMatMul(bsr, x, batch, yPar);
+            tinyaiConfigRemoveKey("system.threads");
+            tinyaiConfigRemoveKey("system.parallel_min_work");
+            tinyaiShutdownThreadPool();
+
+            if (!success || memcmp(y, yPar, TEST_ROWS * batch * sizeof(float)) != 0) {
+                printf("Threaded %s SpMM differs from the serial result\n", name);
+                success = false;
+            }
+        }
+    }
+
+    tinyaiBSRMatrixFree(bsr);
+    tinyaiCSRMatrixFree(csr);
+    free(yPar);
+    free(y);
+    free(yRef);
+    free(column);
+    free(x);
+    free(dense);
+
+    return success;
+}
+
+/* Test delta-encoded column indices of 4-bit CSR matrices, including escaped gaps */
+static bool test4BitCSRIndexCompression()
+{
+    printf("Testing 4-bit CSR column index compression...\n");
+
+    /* Rows wide enough for one-byte, 16-bit and absolute-column gaps */
+    const int rows = 6;
+    const int cols = 70000;
+    float    *dense     = (float *)calloc((size_t)rows * cols, sizeof(float));
+    float    *denseCopy = (float *)malloc((size_t)rows * cols * sizeof(float));
+    float    *x         = (float *)malloc(cols * sizeof(float));
+    if (!dense || !denseCopy || !x) {
+        printf("Memory allocation failed\n");
+        free(dense);
+        free(denseCopy);
+        free(x);
+        return false;
+    }
+
+    for (int i = 0; i < rows; i++) {
+        float *row = &dense[(size_t)i * cols];
+        /* Dense runs, runs with gaps of up to 300 columns, and isolated far columns */
+        for (int j = i; j < 64 + 3 * i; j++) {
+            row[j] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+        }
+        for (int j = 100 + i; j < 20000; j += 1 + rand() % 300) {
+            row[j] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+        }
+        row[cols - 1 - i] = 0.5f;
+    }
+    /* A row starting past the one-byte range, and one with a gap past the 16-bit range */
+    memset(&dense[4 * (size_t)cols], 0, 300 * sizeof(float));
+    memset(&dense[5 * (size_t)cols], 0, cols * sizeof(float));
+    dense[5 * (size_t)cols + 1]        = -0.75f;
+    dense[5 * (size_t)cols + cols - 1] = 0.5f;
+    generateRandomVector(x, cols);
+
+    TinyAICSRMatrix4Bit *csr = tinyaiCreateCSRMatrix4BitFromDense(dense, rows, cols, THRESHOLD);
+    if (!csr || !tinyaiCSRMatrix4BitToDense(csr, denseCopy)) {
+        printf("Failed to convert the 4-bit CSR matrix\n");
+        tinyaiCSRMatrix4BitFree(csr);
+        free(dense);
+        free(denseCopy);
+        free(x);
+        return false;
+    }
+
+    /* Every value lands back in its column */
+    bool success = true;
+    for (size_t k = 0; k < (size_t)rows * cols && success; k++) {
+        if ((dense[k] == 0.0f) != (denseCopy[k] == 0.0f) ||
+            fabsf(dense[k] - denseCopy[k]) > csr->scale) {
+            printf("Mismatch at %zu: original = %f, copy = %f\n", k, dense[k], denseCopy[k]);
+            success = false;
+        }
+    }
+
+    /* Both products decode the same columns */
+    float y1[6], y2[6], expected[6];
+    tinyaiCSRMatrix4BitVectorMul(csr, x, y1);
+    tinyaiCSRMatrix4BitVectorMulSIMD(csr, x, y2);
+    for (int i = 0; i < rows; i++) {
+        double sum = 0.0;
+        for (int j = 0; j < cols; j++) {
+            sum += (double)denseCopy[(size_t)i * cols + j] * x[j];
+        }
+        expected[i] = (float)sum;
+        if (!floatEqual(y1[i], expected[i], 1e-3f) || !floatEqual(y2[i], expected[i], 1e-3f)) {
+            printf("Row %d: expected %f, got %f (scalar) and %f (SIMD)\n", i, expected[i], y1[i],
+                   y2[i]);
+            success = false;
+        }
+    }
+
+    /* Indices cost about one byte per value instead of four */
+    size_t indexBytes = csr->deltaBytes;
+    printf("Column indices: %zu bytes for %d values (%.2f bytes each)\n", indexBytes, csr->nnz,
+           (float)indexBytes / (float)csr->nnz);
+    if (indexBytes >= (size_t)csr->nnz * 2 ||
+        tinyaiCSRMatrix4BitMemoryUsage(csr) >= (size_t)csr->nnz * sizeof(int32_t)) {
+        printf("Column indices are not compressed\n");
+        success = false;
+    }
+
+    tinyaiCSRMatrix4BitFree(csr);
+    free(dense);
+    free(denseCopy);
+    free(x);
+
+    return success;
+}
+
+/* Test load-balanced parallel SpMV on rows with very uneven nonzero counts */
+static bool testCSRMatrixVectorMulParallel()
+{
+    printf("Testing parallel CSR matrix-vector multiplication...\n");
+
+    float *dense = (float *)calloc(TEST_ROWS * TEST_COLS, sizeof(float));
+    float *x     = (float *)malloc(TEST_COLS * sizeof(float));
+    float *y     = (float *)malloc(TEST_ROWS * sizeof(float));
+    float *yPar  = (float *)malloc(TEST_ROWS * sizeof(float));
+    if (!dense || !x || !y || !yPar) {
+        printf("Memory allocation failed\n");
+        free(dense);
+        free(x);
+        free(y);
+        free(yPar);
+        return false;
+    }
+
+    /* A handful of full rows, a few empty ones, and the rest about 5% dense */
+    for (int i = 0; i < TEST_ROWS; i++) {
+        float density = i % 37 == 0 ? 1.0f : (i % 11 == 0 ? 0.0f : 0.05f);
+        for (int j = 0; j < TEST_COLS; j++) {
+            if ((float)rand() / RAND_MAX < density) {
+                dense[i * TEST_COLS + j] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f + 0.01f;
+            }
+        }
+    }
+    generateRandomVector(x, TEST_COLS);
+
+    TinyAICSRMatrix *csr = tinyaiCreateCSRMatrixFromDense(dense, TEST_ROWS, TEST_COLS, THRESHOLD);
+    TinyAICSRMatrix4Bit *csr4 =
+        tinyaiCreateCSRMatrix4BitFromDense(dense, TEST_ROWS, TEST_COLS, THRESHOLD);
+    bool success = csr && csr4;
+
+    for (int format = 0; format < 2 && success; format++) {
+        const char *name = format == 0 ? "CSR" : "4-bit CSR";
+
+        success = format == 0 ? tinyaiCSRMatrixVectorMulSIMD(csr, x, y)
+                              : tinyaiCSRMatrix4BitVectorMulSIMD(csr4, x, y);
+
+        /* Without a pool the parallel variant runs serially */
+        memset(yPar, 0xFF, TEST_ROWS * sizeof(float));
+        success = success && (format == 0 ? tinyaiCSRMatrixVectorMulParallel(csr, x, yPar)
+                                          : tinyaiCSRMatrix4BitVectorMulParallel(csr4, x, yPar));
+        if (!success || memcmp(y, yPar, TEST_ROWS * sizeof(float)) != 0) {
+            printf("Serial %s parallel SpMV differs from the SIMD result\n", name);
+            success = false;
+        }
+
+        /* Splitting rows by nonzeros across threads gives bit-identical results */
+        if (success && tinyaiConfigInit() == 0) {
+            tinyaiConfigSetInt("system.threads", 4);
+            tinyaiConfigSetInt("system.parallel_min_work", 1);
+            tinyaiShutdownThreadPool();
+            memset(yPar, 0xFF, TEST_ROWS * sizeof(float));
+            success = format == 0 ? tinyaiCSRMatrixVectorMulParallel(csr, x, yPar)
+                                  : tinyaiCSRMatrix4BitVectorMulParallel(csr4, x, yPar);
+            tinyaiConfigRemoveKey("system.threads");
+            tinyaiConfigRemoveKey("system.parallel_min_work");
+            tinyaiShutdownThreadPool();
+
+            if (!success || memcmp(y, yPar, TEST_ROWS * sizeof(float)) != 0) {
+                printf("Threaded %s SpMV differs from the serial result\n", name);
+                success = false;
+            }
+        }
+    }
+
+    tinyaiCSRMatrix4BitFree(csr4);
+    tinyaiCSRMatrixFree(csr);
+    free(yPar);
+    free(y);
+    free(x);
+    free(dense);
+
+    return success;
+}
+
+/* Test sparse convolution against a direct convolution with the same filters */
+static bool testCSRMatrixConv2d()
+{
+    printf("Testing sparse convolution...\n");
+
+    /* {inWidth, inHeight, inChannels, outChannels, kernelSize, stride, padding} */
+    const int shapes[3][7] = {
+        {9, 7, 5, 12, 3, 1, 1}, {10, 10, 6, 8, 3, 2, 1}, {6, 5, 16, 20, 1, 1, 0}};
+    bool success = true;
+
+    for (int s = 0; s < 3 && success; s++) {
+        int inW = shapes[s][0], inH = shapes[s][1], inC = shapes[s][2], outC = shapes[s][3];
+        int k = shapes[s][4], stride = shapes[s][5], pad = shapes[s][6];
+        int outW = (inW + 2 * pad - k) / stride + 1;
+        int outH = (inH + 2 * pad - k) / stride + 1;
+        int K    = k * k * inC;
+
+        float *filters  = (float *)malloc((size_t)outC * K * sizeof(float));
+        float *input    = (float *)malloc((size_t)inW * inH * inC * sizeof(float));
+        float *biases   = (float *)malloc(outC * sizeof(float));
+        float *output   = (float *)malloc((size_t)outW * outH * outC * sizeof(float));
+        float *expected = (float *)malloc((size_t)outW * outH * outC * sizeof(float));
+        if (!filters || !input || !biases || !output || !expected) {
+            printf("Memory allocation failed\n");
+            free(filters);
+            free(input);
+            free(biases);
+            free(output);
+            free(expected);
+            return false;
+        }
+
+        /* 80% unstructured sparsity, with one input channel pruned from every filter */
+        generateRandomSparseMatrix(filters, outC, K, 0.8f);
+        for (int oc = 0; oc < outC; oc++) {
+            for (int tap = 0; tap < k * k; tap++) {
+                filters[(size_t)oc * K + tap * inC + 1] = 0.0f;
+            }
+        }
+        generateRandomVector(input, inW * inH * inC);
+        generateRandomVector(biases, outC);
+
+        for (int oy = 0; oy < outH; oy++) {
+            for (int ox = 0; ox < outW; ox++) {
+                for (int oc = 0; oc < outC; oc++) {
+                    float sum = biases[oc];
+                    for (int kh = 0; kh < k; kh++) {
+                        for (int kw = 0; kw < k; kw++) {
+                            int iy = oy * stride - pad + kh, ix = ox * stride - pad + kw;
+                            if (iy < 0 || iy >= inH || ix < 0 || ix >= inW) {
+                                continue;
+                            }
+                            for (int ic = 0; ic < inC; ic++) {
+                                sum += filters[(size_t)oc * K + (kh * k + kw) * inC + ic] *
+                                       input[((size_t)iy * inW + ix) * inC + ic];
+                            }
+                        }
+                    }
+                    expected[((size_t)oy * outW + ox) * outC + oc] = sum;
+                }
+            }
+        }
+
+        TinyAICSRMatrix *csr = tinyaiCreateCSRMatrixFromDense(filters, outC, K, THRESHOLD);
+        success = csr && tinyaiCSRMatrixConv2d(csr, input, biases, output, inW, inH, inC, outW,
+                                               outH, k, stride, pad);
+        for (int i = 0; i < outW * outH * outC && success; i++) {
+            if (!floatEqual(output[i], expected[i], 1e-4f)) {
+                printf("Shape %d mismatch at %d: expected %f, got %f\n", s, i, expected[i],
+                       output[i]);
+                success = false;
+            }
+        }
+
+        tinyaiCSRMatrixFree(csr);
+        free(filters);
+        free(input);
+        free(biases);
+        free(output);
+        free(expected);
+    }
+
+    return success;
+}
+
 int main(int argc, char **argv)
 {
     /* Seed random number generator */
@@ -520,6 +1157,62 @@ int main(int argc, char **argv)
         printf("4-bit quantized CSR matrix-vector multiplication test passed\n");
     }
 
+    if (!test4BitCSRIndexCompression()) {
+        printf("4-bit CSR column index compression test failed\n");
+        success = false;
+    }
+    else {
+        printf("4-bit CSR column index compression test passed\n");
+    }
+
+    if (!testCSRMatrixVectorMulParallel()) {
+        printf("Parallel CSR matrix-vector multiplication test failed\n");
+        success = false;
+    }
+    else {
+        printf("Parallel CSR matrix-vector multiplication test passed\n");
+    }
+
+    if (!testCSRMatrixConv2d()) {
+        printf("Sparse convolution test failed\n");
+        success = false;
+    }
+    else {
+        printf("Sparse convolution test passed\n");
+    }
+
+    if (!testBSRMatrixConversion()) {
+        printf("BSR matrix conversion test failed\n");
+        success = false;
+    }
+    else {
+        printf("BSR matrix conversion test passed\n");
+    }
+
+    if (!testBSRMatrixVectorMul()) {
+        printf("BSR matrix-vector multiplication test failed\n");
+        success = false;
+    }
+    else {
+        printf("BSR matrix-vector multiplication test passed\n");
+    }
+
+    if (!testNMMatrix()) {
+        printf("N:M structured sparse matrix test failed\n");
+        success = false;
+    }
+    else {
+        printf("N:M structured sparse matrix test passed\n");
+    }
+
+    if (!testSparseDenseMatMul()) {
+        printf("Sparse x dense matrix multiplication test failed\n");
+        success = false;
+    }
+    else {
+        printf("Sparse x dense matrix multiplication test passed\n");
+    }
+
     if (success) {
         printf("All sparse matrix operation tests passed!\n");
         return 0;
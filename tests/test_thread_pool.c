@@ -0,0 +1,481 @@
+/**
+ * TinyAI Thread Pool Tests
+ */
+
+#include "../core/config.h"
+#include "../utils/quantize.h"
+#include "../utils/simd_ops.h"
+#include "../utils/thread_pool.h"
+#include "../utils/trace.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+// Per-iteration visit counts written by mark_range
+typedef struct {
+    int *visits; // Times each iteration ran
+    int *starts; // Times a range started at each iteration
+} VisitLog;
+
+// Tasks touch only their own range, so no locking is needed
+static void mark_range(void *context, size_t begin, size_t end)
+{
+    VisitLog *log = (VisitLog *)context;
+    for (size_t i = begin; i < end; i++) {
+        log->visits[i]++;
+    }
+    log->starts[begin]++;
+}
+
+// Count the ranges of the last calls and check they start on grain boundaries
+static int count_ranges(const VisitLog *log, size_t count, size_t grain, bool *aligned)
+{
+    int ranges = 0;
+    *aligned   = true;
+    for (size_t i = 0; i < count; i++) {
+        if (log->starts[i] > 0) {
+            ranges++;
+            if (i % grain != 0) {
+                *aligned = false;
+            }
+        }
+    }
+    return ranges;
+}
+
+// Test that every iteration runs exactly once, in grain-aligned ranges
+void test_parallel_for_coverage()
+{
+    printf("  Testing parallel-for iteration coverage...\n");
+
+    TinyAIThreadPool *pool = tinyaiCreateThreadPool(4, 1);
+    ASSERT(pool != NULL, "Thread pool creation should succeed");
+    ASSERT(tinyaiThreadPoolSize(pool) == 4, "Thread pool should report its thread count");
+
+    const size_t count = 1003;
+    const size_t grain = 7;
+    VisitLog     log   = {(int *)calloc(count, sizeof(int)), (int *)calloc(count, sizeof(int))};
+    bool         aligned;
+
+    for (int run = 0; run < 50; run++) {
+        tinyaiParallelFor(pool, count, grain, mark_range, &log);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ASSERT(log.visits[i] == 50, "Every iteration should run exactly once per call");
+    }
+    int ranges = count_ranges(&log, count, grain, &aligned);
+    ASSERT(ranges > 1 && ranges <= 4, "Work should be split into at most one range per thread");
+    ASSERT(aligned, "Ranges should start on grain boundaries");
+
+    // Less than two grains of work stays in one serial call
+    memset(log.starts, 0, count * sizeof(int));
+    tinyaiParallelFor(pool, 13, grain, mark_range, &log);
+    ASSERT(count_ranges(&log, count, grain, &aligned) == 1, "Small loops should run as one task");
+
+    // A NULL pool runs serially too
+    memset(log.starts, 0, count * sizeof(int));
+    tinyaiParallelFor(NULL, count, 1, mark_range, &log);
+    ASSERT(count_ranges(&log, count, 1, &aligned) == 1, "NULL pool should run serially");
+
+    ASSERT(tinyaiThreadPoolGrain(pool, 10, 16) == 16, "Grain should round up to the alignment");
+    ASSERT(tinyaiThreadPoolGrain(NULL, 1, 16) % 16 == 0 &&
+               tinyaiThreadPoolGrain(NULL, 1, 16) >= TINYAI_PARALLEL_MIN_WORK,
+           "Grain should cover the minimum work");
+
+    free(log.visits);
+    free(log.starts);
+    tinyaiDestroyThreadPool(pool);
+    printf("    PASS\n");
+}
+
+// One task of a group: marks its slice with a nested parallel loop, and splits itself in two
+// until slices are small
+typedef struct {
+    TinyAITaskGroup  *group;
+    TinyAIThreadPool *pool;
+    VisitLog         *log;
+    size_t            begin;
+    size_t            end;
+    bool              owned; // Allocated by the task that queued it
+} SliceTask;
+
+// Marks iterations offset by the slice start
+static void mark_slice_range(void *context, size_t begin, size_t end)
+{
+    SliceTask *slice = (SliceTask *)context;
+    for (size_t i = slice->begin + begin; i < slice->begin + end; i++) {
+        slice->log->visits[i]++;
+    }
+}
+
+static void run_slice(void *context)
+{
+    SliceTask *slice = (SliceTask *)context;
+    size_t     size  = slice->end - slice->begin;
+
+    if (size > 256) {
+        // Tasks may queue more tasks in their own group; each half frees itself
+        for (int half = 0; half < 2; half++) {
+            SliceTask *child = (SliceTask *)malloc(sizeof(SliceTask));
+            ASSERT(child != NULL, "Slice allocation should succeed");
+            *child       = *slice;
+            child->owned = true;
+            if (half == 0) {
+                child->end = slice->begin + size / 2;
+            }
+            else {
+                child->begin = slice->begin + size / 2;
+            }
+            int node = half == 0 ? TINYAI_AFFINITY_ANY : 0;
+            tinyaiTaskGroupRun(slice->group, run_slice, child, node);
+        }
+    }
+    else {
+        tinyaiParallelFor(slice->pool, size, 16, mark_slice_range, slice);
+    }
+
+    if (slice->owned) {
+        free(slice);
+    }
+}
+
+// Test task groups with tasks spawning tasks and nested parallel loops
+void test_task_groups()
+{
+    printf("  Testing task groups and nested parallel loops...\n");
+
+    TinyAIThreadPool *pool = tinyaiCreateThreadPool(4, 1);
+    ASSERT(pool != NULL, "Thread pool creation should succeed");
+
+    const size_t count = 4099;
+    VisitLog     log   = {(int *)calloc(count, sizeof(int)), (int *)calloc(count, sizeof(int))};
+
+    for (int run = 0; run < 20; run++) {
+        TinyAITaskGroup *group = tinyaiCreateTaskGroup(pool);
+        ASSERT(group != NULL, "Task group creation should succeed");
+
+        SliceTask root = {group, pool, &log, 0, count, false};
+        tinyaiTaskGroupRun(group, run_slice, &root, TINYAI_AFFINITY_ANY);
+        tinyaiTaskGroupWait(group);
+        tinyaiDestroyTaskGroup(group);
+    }
+    for (size_t i = 0; i < count; i++) {
+        ASSERT(log.visits[i] == 20, "Every iteration should run once per group");
+    }
+
+    // Without a pool, tasks run as they are queued
+    memset(log.visits, 0, count * sizeof(int));
+    TinyAITaskGroup *group = tinyaiCreateTaskGroup(NULL);
+    SliceTask        root  = {group, NULL, &log, 0, 200, false};
+    tinyaiTaskGroupRun(group, run_slice, &root, TINYAI_AFFINITY_ANY);
+    ASSERT(log.visits[0] == 1 && log.visits[199] == 1, "Tasks without a pool should run inline");
+    tinyaiDestroyTaskGroup(group);
+
+    free(log.visits);
+    free(log.starts);
+    tinyaiDestroyThreadPool(pool);
+    printf("    PASS\n");
+}
+
+// Spins for a while per iteration, so tasks take measurable time
+static void spin_range(void *context, size_t begin, size_t end)
+{
+    volatile float *sink = (volatile float *)context;
+    for (size_t i = begin; i < end; i++) {
+        for (int k = 0; k < 20000; k++) {
+            *sink = *sink * 0.5f + 1.0f;
+        }
+    }
+}
+
+// Test per-thread busy time tracking
+void test_busy_time()
+{
+    printf("  Testing per-thread busy time...\n");
+
+    TinyAIThreadPool *pool = tinyaiCreateThreadPool(4, 1);
+    ASSERT(pool != NULL, "Thread pool creation should succeed");
+
+    uint64_t busy[8];
+    float    sink = 0.0f;
+    tinyaiParallelFor(pool, 64, 1, spin_range, &sink);
+    ASSERT(tinyaiThreadPoolGetBusyTime(pool, busy, 8) == 4, "Every thread should have an entry");
+    for (int t = 0; t < 4; t++) {
+        ASSERT(busy[t] == 0, "Nothing should be counted before tracking starts");
+    }
+
+    tinyaiThreadPoolTrackBusyTime(pool, true);
+    uint64_t start = tinyaiTraceNow();
+    for (int run = 0; run < 10; run++) {
+        tinyaiParallelFor(pool, 64, 1, spin_range, &sink);
+    }
+    uint64_t wall = tinyaiTraceNow() - start;
+    tinyaiThreadPoolTrackBusyTime(pool, false);
+
+    ASSERT(tinyaiThreadPoolGetBusyTime(pool, busy, 8) == 4, "Every thread should have an entry");
+    uint64_t total = 0;
+    for (int t = 0; t < 4; t++) {
+        ASSERT(busy[t] <= wall, "No thread should be busy for longer than the loops took");
+        total += busy[t];
+    }
+    ASSERT(busy[3] > 0, "The caller runs a share of every loop");
+    ASSERT(total >= wall / 2, "The loops should be counted as busy time");
+
+    // Counts stop with tracking and restart from zero
+    tinyaiParallelFor(pool, 64, 1, spin_range, &sink);
+    uint64_t after[8];
+    tinyaiThreadPoolGetBusyTime(pool, after, 8);
+    ASSERT(memcmp(busy, after, 4 * sizeof(uint64_t)) == 0, "Stopped tracking should not count");
+    tinyaiThreadPoolTrackBusyTime(pool, true);
+    tinyaiThreadPoolGetBusyTime(pool, after, 8);
+    ASSERT(after[0] == 0 && after[3] == 0, "Starting again should reset the counts");
+    ASSERT(tinyaiThreadPoolGetBusyTime(pool, after, 2) == 2, "Entries should fit the capacity");
+
+    tinyaiDestroyThreadPool(pool);
+    printf("    PASS\n");
+}
+
+// Multiply with the shared pool configured for a given thread count
+static void matmul_with_threads(int threads, const TinyAIMatrix4bit *matrix, const float *input,
+                                uint32_t count, const float *bias, float *output)
+{
+    tinyaiConfigSetInt("system.threads", threads);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+
+    int result = tinyaiMatrix4bitMatMul(matrix, input, count, bias, output);
+    ASSERT(result == 0, "4-bit matrix multiplication should succeed");
+}
+
+// Test that threaded, tiled 4-bit matrix multiplication matches the serial result exactly
+void test_threaded_matmul_matches_serial()
+{
+    printf("  Testing threaded 4-bit matrix multiplication...\n");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+
+    // Column counts off the 16-wide SIMD block, an odd one for the fallback path, and a
+    // batch large enough to be tiled over inputs and columns
+    const uint32_t shapes[3][3] = {{37, 200, 3}, {64, 512, 40}, {13, 33, 3}};
+
+    for (int s = 0; s < 3; s++) {
+        const uint32_t   count = shapes[s][2];
+        TinyAIMatrix4bit matrix = {0};
+        matrix.rows      = shapes[s][0];
+        matrix.cols      = shapes[s][1];
+        matrix.scale     = 0.07f;
+        matrix.zeroPoint = -0.5f;
+
+        size_t packedSize = ((size_t)matrix.rows * matrix.cols + 1) / 2;
+        matrix.data       = (uint8_t *)malloc(packedSize);
+        float *input      = (float *)malloc(count * matrix.rows * sizeof(float));
+        float *bias       = (float *)malloc(matrix.cols * sizeof(float));
+        float *serial     = (float *)malloc(count * matrix.cols * sizeof(float));
+        float *threaded   = (float *)malloc(count * matrix.cols * sizeof(float));
+        float *single     = (float *)malloc(count * matrix.cols * sizeof(float));
+
+        for (size_t i = 0; i < packedSize; i++) {
+            matrix.data[i] = (uint8_t)(rand() & 0xFF);
+        }
+        for (uint32_t i = 0; i < count * matrix.rows; i++) {
+            input[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+        }
+        for (uint32_t i = 0; i < matrix.cols; i++) {
+            bias[i] = ((float)rand() / RAND_MAX) - 0.5f;
+        }
+
+        matmul_with_threads(1, &matrix, input, count, bias, serial);
+        ASSERT(tinyaiGetThreadPool() == NULL, "One thread should not create a pool");
+
+        matmul_with_threads(4, &matrix, input, count, bias, threaded);
+        ASSERT(tinyaiThreadPoolSize(tinyaiGetThreadPool()) == 4,
+               "Shared pool should use the configured thread count");
+
+        // One vector at a time is never tiled
+        for (uint32_t i = 0; i < count; i++) {
+            tinyaiMatrix4bitVecMul(&matrix, input + i * matrix.rows, bias, single + i * matrix.cols);
+        }
+
+        bool match = memcmp(serial, threaded, count * matrix.cols * sizeof(float)) == 0;
+        bool tiled = memcmp(serial, single, count * matrix.cols * sizeof(float)) == 0;
+
+        free(matrix.data);
+        free(input);
+        free(bias);
+        free(serial);
+        free(threaded);
+        free(single);
+
+        ASSERT(match, "Threaded output should be bit-identical to serial output");
+        ASSERT(tiled, "Tiled output should be bit-identical to per-vector output");
+    }
+
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    printf("    PASS\n");
+}
+
+// Test that a grouped 4-bit multiplication matches separate multiplications exactly
+void test_grouped_matmul_matches_separate()
+{
+    printf("  Testing grouped 4-bit matrix multiplication...\n");
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+
+    // Query-, key- and value-shaped matrices with their own scales, one off the 16-wide block,
+    // over a batch large enough to be tiled
+    const uint32_t   rows       = 64;
+    const uint32_t   count      = 40;
+    const uint32_t   cols[3]    = {64, 16, 22};
+    TinyAIMatrix4bit matrices[3] = {{0}};
+    float           *biases[3];
+    float           *grouped[3];
+    float           *separate[3];
+    float           *input = (float *)malloc(count * rows * sizeof(float));
+
+    for (uint32_t i = 0; i < count * rows; i++) {
+        input[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+    }
+    for (int m = 0; m < 3; m++) {
+        matrices[m].rows      = rows;
+        matrices[m].cols      = cols[m];
+        matrices[m].scale     = 0.05f * (m + 1);
+        matrices[m].zeroPoint = -0.2f * m;
+
+        size_t packedSize = ((size_t)rows * cols[m] + 1) / 2;
+        matrices[m].data  = (uint8_t *)malloc(packedSize);
+        biases[m]         = (float *)malloc(cols[m] * sizeof(float));
+        grouped[m]        = (float *)malloc(count * cols[m] * sizeof(float));
+        separate[m]       = (float *)malloc(count * cols[m] * sizeof(float));
+        for (size_t i = 0; i < packedSize; i++) {
+            matrices[m].data[i] = (uint8_t)(rand() & 0xFF);
+        }
+        for (uint32_t i = 0; i < cols[m]; i++) {
+            biases[m][i] = ((float)rand() / RAND_MAX) - 0.5f;
+        }
+
+        int result = tinyaiMatrix4bitMatMul(&matrices[m], input, count, biases[m], separate[m]);
+        ASSERT(result == 0, "Separate multiplication should succeed");
+    }
+
+    const TinyAIMatrix4bit *group[3]     = {&matrices[0], &matrices[1], &matrices[2]};
+    const float            *groupBias[3] = {biases[0], biases[1], biases[2]};
+    float                  *groupOut[3]  = {grouped[0], grouped[1], grouped[2]};
+    ASSERT(tinyaiMatrix4bitMatMulGroup(group, groupBias, groupOut, 3, input, count) == 0,
+           "Grouped multiplication should succeed");
+    for (int m = 0; m < 3; m++) {
+        ASSERT(memcmp(grouped[m], separate[m], count * cols[m] * sizeof(float)) == 0,
+               "Grouped output should be bit-identical to separate multiplications");
+    }
+
+    // Every matrix must share the input's row count
+    matrices[1].rows = rows - 1;
+    ASSERT(tinyaiMatrix4bitMatMulGroup(group, groupBias, groupOut, 3, input, count) != 0,
+           "Mismatched row counts should fail");
+
+    for (int m = 0; m < 3; m++) {
+        free(matrices[m].data);
+        free(biases[m]);
+        free(grouped[m]);
+        free(separate[m]);
+    }
+    free(input);
+
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    printf("    PASS\n");
+}
+
+// Test that the AVX-512 4-bit kernel matches the SSE2 one on full and partial column ranges
+void test_avx512_matmul_matches_narrow()
+{
+    printf("  Testing AVX-512 4-bit matrix multiplication...\n");
+
+    if (!tinyaiSimdHasAVX512()) {
+        printf("    SKIP - AVX-512 not available\n");
+        return;
+    }
+
+    // Ranges over whole 32-column chunks, one ending in a 16-lane vector, one with an odd end,
+    // and an odd start that falls back to the reference kernel
+    const int rows         = 48;
+    const int cols         = 200;
+    const int count        = 5;
+    const int ranges[5][2] = {{0, 200}, {0, 64}, {16, 90}, {32, 47}, {3, 40}};
+
+    uint8_t *weights = (uint8_t *)malloc(rows * cols / 2);
+    float   *input   = (float *)malloc(count * rows * sizeof(float));
+    float   *narrow  = (float *)malloc(count * cols * sizeof(float));
+    float   *wide    = (float *)malloc(count * cols * sizeof(float));
+    for (int i = 0; i < rows * cols / 2; i++) {
+        weights[i] = (uint8_t)(rand() & 0xFF);
+    }
+    for (int i = 0; i < count * rows; i++) {
+        input[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+    }
+    input[rows + 7] = 0.0f; // Skipped inputs
+
+    for (int r = 0; r < 5; r++) {
+        int c0 = ranges[r][0];
+        int c1 = ranges[r][1];
+        for (int i = 0; i < count * cols; i++) {
+            narrow[i] = wide[i] = -1.0f;
+        }
+
+        tinyaiSimdSetAVX512Enabled(false);
+        tinyaiSimdMatMul4BitAffineColumns(narrow, weights, input, count, rows, cols, c0, c1, 0.07f,
+                                          -0.5f);
+        tinyaiSimdSetAVX512Enabled(true);
+        tinyaiSimdMatMul4BitAffineColumns(wide, weights, input, count, rows, cols, c0, c1, 0.07f,
+                                          -0.5f);
+
+        // Fused multiply-adds round once instead of twice
+        for (int i = 0; i < count * cols; i++) {
+            ASSERT(fabsf(wide[i] - narrow[i]) <= 1e-5f * (1.0f + fabsf(narrow[i])),
+                   "AVX-512 output should match the SSE2 output");
+            int column = i % cols;
+            if (column < c0 || column >= c1) {
+                ASSERT(wide[i] == -1.0f, "Columns outside the range should not be written");
+            }
+        }
+    }
+
+    free(weights);
+    free(input);
+    free(narrow);
+    free(wide);
+    printf("    PASS\n");
+}
+
+void run_thread_pool_tests()
+{
+    printf("--- Running Thread Pool Tests ---\n");
+
+    srand(42);
+
+    test_parallel_for_coverage();
+    test_task_groups();
+    test_busy_time();
+    test_threaded_matmul_matches_serial();
+    test_grouped_matmul_matches_separate();
+    test_avx512_matmul_matches_narrow();
+
+    printf("--- Thread Pool Tests Finished ---\n");
+}
@@ -3,10 +3,18 @@
  */
 
 #include "../models/text/tokenizer.h" // Include the tokenizer being tested
+#include "../models/text/vocab_trainer.h"
+#include "../core/config.h"
+#include "../core/memory.h"
+#include "../utils/simd_ops.h"
+#include "../utils/thread_pool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Shard size of the vocabulary trainer's parallel counting
+#define SHARD_TEST_BYTES 65536
+
 // Basic assertion helper (consistent with other test files)
 #define ASSERT(condition, message)                                                                 \
     do {                                                                                           \
@@ -144,6 +152,55 @@ void test_encode_decode_unknown()
     printf("    PASS\n");
 }
 
+// Test splitting text into words, whitespace and single-byte separators
+void test_pre_tokenization()
+{
+    printf("  Testing pre-tokenization...\n");
+
+    // Runs cross the 16- and 32-byte vector steps and stop at the length
+    char text[80];
+    memset(text, 'a', sizeof(text));
+    memcpy(text + 37, "-'9Z \t\n\v\f\r\xc3", 11);
+    ASSERT(tinyaiSimdByteRunLength(text, sizeof(text), TINYAI_SIMD_BYTES_WORD) == 41,
+           "A word should run through letters, digits, hyphens and apostrophes");
+    ASSERT(tinyaiSimdByteRunLength(text, 20, TINYAI_SIMD_BYTES_WORD) == 20,
+           "A run should stop at the length");
+    ASSERT(tinyaiSimdByteRunLength(text + 41, sizeof(text) - 41, TINYAI_SIMD_BYTES_SPACE) == 6,
+           "Whitespace should run through every space character");
+    ASSERT(tinyaiSimdByteRunLength(text + 47, sizeof(text) - 47, TINYAI_SIMD_BYTES_WORD) == 0 &&
+               tinyaiSimdByteRunLength(text + 47, sizeof(text) - 47, TINYAI_SIMD_BYTES_SPACE) == 0,
+           "UTF-8 bytes should belong to neither class");
+
+    TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
+    const char      *words[8]  = {"don't", "well-known", ",", "caf", "\xc3", "\xa9", "!", "a"};
+    for (int i = 0; i < 8; i++) {
+        tinyaiAddToken(tokenizer, words[i], 100);
+    }
+
+    // Each byte of a multi-byte character is a separator of its own
+    int tokens[300];
+    int count = tinyaiEncodeText(tokenizer, "don't\t\r\nwell-known, caf\xc3\xa9!", tokens, 300);
+    ASSERT(count == 7, "Text should split into five words and separators");
+    for (int i = 0; i < 7; i++) {
+        ASSERT(tokens[i] == tinyaiGetTokenId(tokenizer, words[i]),
+               "Words and separators should encode in order");
+    }
+
+    // A word longer than a token keeps its first bytes
+    char longWord[301];
+    memset(longWord, 'a', 300);
+    longWord[300] = '\0';
+    count         = tinyaiEncodeText(tokenizer, longWord, tokens, 300);
+    ASSERT(count == TINYAI_MAX_TOKEN_LENGTH - 1, "A long word should be truncated to a token");
+
+    // A separator after a full buffer is dropped
+    ASSERT(tinyaiEncodeText(tokenizer, "don't,", tokens, 1) == 1,
+           "Encoding should not write past the buffer");
+
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
 // Test encoding with limited buffer
 void test_encoding_buffer_limits()
 {
@@ -215,6 +272,294 @@ void test_save_load_vocabulary()
     printf("    PASS\n");
 }
 
+// Test hash-indexed lookups across index growth, case folding and vocabulary reloads
+void test_token_index()
+{
+    printf("  Testing hash-indexed token lookup...\n");
+
+    const char      *testVocabPath = "test_index_vocab.txt";
+    TinyAITokenizer *tokenizer     = tinyaiCreateTokenizer();
+    char             token[32];
+
+    // Enough tokens to grow the index several times
+    for (int i = 0; i < 5000; i++) {
+        snprintf(token, sizeof(token), "tok%d", i);
+        ASSERT(tinyaiAddToken(tokenizer, token, i) == 4 + i, "New tokens should get the next ID");
+    }
+    ASSERT(tinyaiAddToken(tokenizer, "tok17", 1) == 21, "Re-adding a token should return its ID");
+    for (int i = 0; i < 5000; i++) {
+        snprintf(token, sizeof(token), "tok%d", i);
+        ASSERT(tinyaiGetTokenId(tokenizer, token) == 4 + i, "Every token should be found");
+    }
+    ASSERT(tinyaiGetTokenId(tokenizer, "tok5000") == TINYAI_TOKEN_UNKNOWN,
+           "Missing tokens should return UNKNOWN");
+    ASSERT(tinyaiGetTokenId(tokenizer, "<eos>") == TINYAI_TOKEN_EOS,
+           "Special tokens should be indexed");
+
+    // Case-insensitive lookups find the first token of a folded key
+    int upper = tinyaiAddToken(tokenizer, "Apple", 0);
+    int lower = tinyaiAddToken(tokenizer, "apple", 0);
+    ASSERT(upper >= 0 && lower == upper + 1, "Tokens differing in case should both be added");
+    ASSERT(tinyaiGetTokenId(tokenizer, "APPLE") == upper &&
+               tinyaiGetTokenId(tokenizer, "apple") == upper &&
+               tinyaiGetTokenId(tokenizer, "TOK9") == 13,
+           "Case-insensitive lookup should return the first match");
+    tokenizer->caseSensitive = 1;
+    ASSERT(tinyaiGetTokenId(tokenizer, "apple") == lower &&
+               tinyaiGetTokenId(tokenizer, "APPLE") == TINYAI_TOKEN_UNKNOWN,
+           "Case-sensitive lookup should match exactly");
+    tokenizer->caseSensitive = 0;
+
+    // Reloading drops the old tokens from the index
+    FILE *file = fopen(testVocabPath, "w");
+    ASSERT(file != NULL, "Should create vocabulary file");
+    fprintf(file, "pear 3\nplum 2\n");
+    fclose(file);
+    ASSERT(tinyaiLoadVocabulary(tokenizer, testVocabPath) == 0,
+           "Loading vocabulary should succeed");
+    remove(testVocabPath);
+    ASSERT(tinyaiGetTokenId(tokenizer, "tok1") == TINYAI_TOKEN_UNKNOWN &&
+               tinyaiGetTokenId(tokenizer, "apple") == TINYAI_TOKEN_UNKNOWN,
+           "Reloaded vocabulary should forget old tokens");
+    ASSERT(tinyaiGetTokenId(tokenizer, "pear") == 4 && tinyaiGetTokenId(tokenizer, "Plum") == 5,
+           "Reloaded tokens should be found");
+
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test rank-ordered BPE merging, with and without merge rules
+void test_bpe_merges()
+{
+    printf("  Testing BPE merge ranks...\n");
+
+    const char      *testVocabPath = "test_merge_vocab.txt";
+    TinyAITokenizer *tokenizer     = tinyaiCreateTokenizer();
+    int              tokens[128];
+    const char      *letters[5] = {"l", "o", "w", "e", "r"};
+    for (int i = 0; i < 5; i++) {
+        tinyaiAddToken(tokenizer, letters[i], 0);
+    }
+
+    // Without rules the earlier token wins, wherever its pair sits in the word
+    int ow = tinyaiAddToken(tokenizer, "ow", 0);
+    int lo = tinyaiAddToken(tokenizer, "lo", 0);
+    ASSERT(tinyaiEncodeText(tokenizer, "low", tokens, 128) == 2 &&
+               tokens[0] == tinyaiGetTokenId(tokenizer, "l") && tokens[1] == ow,
+           "Earlier tokens should merge first");
+
+    // A long word merges pair by pair
+    char word[201];
+    for (int i = 0; i < 200; i++) {
+        word[i] = "lo"[i % 2];
+    }
+    word[200] = '\0';
+    ASSERT(tinyaiEncodeText(tokenizer, word, tokens, 128) == 100, "Long words should merge");
+    for (int i = 0; i < 100; i++) {
+        ASSERT(tokens[i] == lo, "Every pair of a long word should merge");
+    }
+
+    // Rules merge by rank, into tokens added on demand
+    ASSERT(tinyaiAddMerge(tokenizer, "l", "o") == 0, "First rule should get rank 0");
+    ASSERT(tinyaiAddMerge(tokenizer, "lo", "w") == 1, "Rules should get the next rank");
+    ASSERT(tinyaiAddMerge(tokenizer, "e", "r") == 2 && tinyaiAddMerge(tokenizer, "low", "er") == 3,
+           "Rules should be added");
+    ASSERT(tinyaiAddMerge(tokenizer, "l", "o") == 0, "Repeated rules should keep their rank");
+    ASSERT(tinyaiAddMerge(tokenizer, "x", "o") < 0, "Rules need both sides in the vocabulary");
+    int lower = tinyaiGetTokenId(tokenizer, "lower");
+    ASSERT(lower != TINYAI_TOKEN_UNKNOWN, "Merged tokens should be added");
+    ASSERT(tinyaiEncodeText(tokenizer, "lower", tokens, 128) == 1 && tokens[0] == lower,
+           "Rules should merge the whole word");
+    ASSERT(tinyaiEncodeText(tokenizer, "owe", tokens, 128) == 3,
+           "Pairs without a rule should not merge");
+
+    // Rules survive a save and load
+    ASSERT(tinyaiSaveVocabulary(tokenizer, testVocabPath) == 0, "Saving vocabulary should succeed");
+    TinyAITokenizer *loaded = tinyaiCreateTokenizer();
+    ASSERT(tinyaiLoadVocabulary(loaded, testVocabPath) == 0, "Loading vocabulary should succeed");
+    remove(testVocabPath);
+    ASSERT(loaded->mergeCount == 4, "Loaded vocabulary should keep its rules");
+    ASSERT(tinyaiEncodeText(loaded, "lower", tokens, 128) == 1 &&
+               tokens[0] == tinyaiGetTokenId(loaded, "lower"),
+           "Loaded rules should merge the same way");
+
+    tinyaiDestroyTokenizer(loaded);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test the mapped binary vocabulary format: lookups and merges in place, then copy on write
+void test_binary_vocabulary()
+{
+    printf("  Testing binary vocabulary...\n");
+
+    const char      *binaryPath = "test_vocab.tvocab";
+    const char      *textPath   = "test_binary_vocab.txt";
+    TinyAITokenizer *tokenizer  = tinyaiCreateTokenizer();
+    int              tokens[128];
+    char             token[32];
+
+    for (int i = 0; i < 300; i++) {
+        snprintf(token, sizeof(token), "Word%d", i);
+        tinyaiAddToken(tokenizer, token, 1000 - i);
+    }
+    const char *letters[5] = {"l", "o", "w", "e", "r"};
+    for (int i = 0; i < 5; i++) {
+        tinyaiAddToken(tokenizer, letters[i], 0);
+    }
+    tinyaiAddMerge(tokenizer, "l", "o");
+    tinyaiAddMerge(tokenizer, "lo", "w");
+    tinyaiAddMerge(tokenizer, "e", "r");
+    tinyaiAddMerge(tokenizer, "low", "er");
+    uint32_t count = tokenizer->tokenCount;
+    ASSERT(tinyaiSaveVocabulary(tokenizer, binaryPath) == 0, "Saving binary should succeed");
+
+    // The loaded vocabulary is used straight from the mapping
+    TinyAITokenizer *loaded = tinyaiCreateTokenizer();
+    ASSERT(tinyaiLoadVocabulary(loaded, binaryPath) == 0, "Loading binary should succeed");
+    ASSERT(loaded->mapping != NULL && loaded->mappedCount == count, "Binary should be mapped");
+    ASSERT(loaded->tokenCount == count && loaded->mergeCount == 4,
+           "Binary should keep every entry");
+    for (uint32_t i = 0; i < count; i++) {
+        const char *text = tinyaiGetTokenString(tokenizer, (int)i);
+        ASSERT(strcmp(tinyaiGetTokenString(loaded, (int)i), text) == 0, "Strings should match");
+        ASSERT(loaded->frequencies[i] == tokenizer->frequencies[i], "Frequencies should match");
+    }
+    ASSERT(tinyaiGetTokenId(loaded, "word42") == tinyaiGetTokenId(tokenizer, "Word42"),
+           "Mapped folded index should find tokens");
+    loaded->caseSensitive = 1;
+    ASSERT(tinyaiGetTokenId(loaded, "word42") == TINYAI_TOKEN_UNKNOWN &&
+               tinyaiGetTokenId(loaded, "Word42") == tinyaiGetTokenId(tokenizer, "Word42"),
+           "Mapped exact index should find tokens");
+    loaded->caseSensitive = 0;
+    int lower = tinyaiGetTokenId(loaded, "lower");
+    ASSERT(tinyaiEncodeText(loaded, "lower", tokens, 128) == 1 && tokens[0] == lower,
+           "Mapped merge ranks should merge");
+
+    // Writes copy out of the mapping, leaving the file intact
+    ASSERT(tinyaiAddToken(loaded, "Word7", 5000) == tinyaiGetTokenId(tokenizer, "Word7") &&
+               loaded->frequencies[tinyaiGetTokenId(loaded, "Word7")] == 5000,
+           "Mapped frequencies should be writable");
+    ASSERT(tinyaiAddToken(loaded, "fresh", 3) == (int)count,
+           "New tokens should follow mapped ones");
+    ASSERT(tinyaiAddMerge(loaded, "lower", "lower") == 4, "New rules should follow mapped ones");
+    ASSERT(tinyaiGetTokenId(loaded, "fresh") == (int)count &&
+               tinyaiGetTokenId(loaded, "Word299") == tinyaiGetTokenId(tokenizer, "Word299"),
+           "Lookups should see mapped and new tokens");
+    ASSERT(tinyaiEncodeText(loaded, "lowerlower lower", tokens, 128) == 2 &&
+               tokens[0] == tinyaiGetTokenId(loaded, "lowerlower") && tokens[1] == lower,
+           "Mapped and new rules should both merge");
+    ASSERT(tinyaiSaveVocabulary(loaded, textPath) == 0, "Saving text should succeed");
+
+    TinyAITokenizer *reloaded = tinyaiCreateTokenizer();
+    ASSERT(tinyaiLoadVocabulary(reloaded, binaryPath) == 0, "Reloading binary should succeed");
+    ASSERT(reloaded->tokenCount == count && tinyaiGetTokenId(reloaded, "fresh") == 0 &&
+               reloaded->frequencies[tinyaiGetTokenId(reloaded, "Word7")] != 5000,
+           "Writes should not reach the file");
+
+    // Loading text over a mapping replaces it
+    ASSERT(tinyaiLoadVocabulary(loaded, textPath) == 0, "Loading text should succeed");
+    ASSERT(loaded->mapping == NULL && loaded->tokenCount == count + 2 &&
+               loaded->mergeCount == 5,
+           "Text should replace the mapped vocabulary");
+
+    // Damaged files are rejected and leave the vocabulary alone
+    FILE *file = fopen(binaryPath, "r+b");
+    ASSERT(file != NULL, "Binary should reopen");
+    fseek(file, 40, SEEK_SET);
+    uint32_t badOffset = 0xFFFFFFF0u;
+    fwrite(&badOffset, sizeof(badOffset), 1, file);
+    fclose(file);
+    ASSERT(tinyaiLoadVocabulary(loaded, binaryPath) != 0, "Bad offsets should be rejected");
+    ASSERT(loaded->tokenCount == count + 2 && tinyaiGetTokenId(loaded, "fresh") == (int)count,
+           "A rejected file should keep the old vocabulary");
+
+    file = fopen(binaryPath, "wb");
+    ASSERT(file != NULL, "Binary should be rewritten");
+    uint32_t header[4] = {TINYAI_VOCAB_MAGIC, TINYAI_VOCAB_VERSION, 100, 8};
+    fwrite(header, sizeof(header), 1, file);
+    fclose(file);
+    ASSERT(tinyaiLoadVocabulary(loaded, binaryPath) != 0, "Truncated files should be rejected");
+
+    tinyaiDestroyTokenizer(reloaded);
+    tinyaiDestroyTokenizer(loaded);
+    tinyaiDestroyTokenizer(tokenizer);
+    remove(binaryPath);
+    remove(textPath);
+    printf("    PASS\n");
+}
+
+// Test the streaming detokenizer: UTF-8 split across tokens, buffer growth and flushing
+void test_streaming_detokenizer()
+{
+    printf("  Testing streaming detokenizer...\n");
+
+    TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
+    int              caf       = tinyaiAddToken(tokenizer, "caf", 0);
+    int              e1        = tinyaiAddToken(tokenizer, "\xC3", 0);
+    int              e2        = tinyaiAddToken(tokenizer, "\xA9", 0);
+    int              euro1     = tinyaiAddToken(tokenizer, "\xE2\x82", 0);
+    int              euro2     = tinyaiAddToken(tokenizer, "\xAC", 0);
+    int              ok        = tinyaiAddToken(tokenizer, "ok", 0);
+    int              dot       = tinyaiAddToken(tokenizer, ".", 0);
+
+    // Each append hands out just the bytes that finish whole characters
+    TinyAIDetokenizer detokenizer;
+    ASSERT(tinyaiDetokenizerInit(&detokenizer, tokenizer, NULL, 0) == 0,
+           "Detokenizer should initialize");
+    const int   sequence[8] = {caf, e1, e2, TINYAI_TOKEN_BOS, euro1, euro2, ok, dot};
+    const char *expected[8] = {"caf", " ", "\xC3\xA9", "", " ", "\xE2\x82\xAC", " ok", "."};
+    const char *piece       = NULL;
+    for (int i = 0; i < 8; i++) {
+        int length = tinyaiDetokenizerAppend(&detokenizer, sequence[i], &piece);
+        ASSERT(length == (int)strlen(expected[i]) && memcmp(piece, expected[i], length) == 0,
+               "Each token should hand out its completed text");
+    }
+
+    char decoded[64];
+    tinyaiDecodeTokens(tokenizer, sequence, 8, decoded, sizeof(decoded));
+    ASSERT(strcmp(detokenizer.text, decoded) == 0 &&
+               strcmp(decoded, "caf \xC3\xA9 \xE2\x82\xAC ok.") == 0,
+           "Streamed text should match whole decoding");
+
+    // An unfinished character waits for the flush
+    ASSERT(tinyaiDetokenizerAppend(&detokenizer, euro1, &piece) == 1 && piece[0] == ' ',
+           "A partial character should be held back");
+    ASSERT(tinyaiDetokenizerFlush(&detokenizer, &piece) == 2 && memcmp(piece, "\xE2\x82", 2) == 0,
+           "Flushing should hand out held-back bytes");
+    ASSERT(tinyaiDetokenizerFlush(&detokenizer, &piece) == 0, "A second flush has nothing left");
+
+    // A small caller buffer grows, and a reset keeps it
+    char *buffer = (char *)TINYAI_MALLOC(4);
+    ASSERT(buffer != NULL, "Should allocate the initial buffer");
+    TINYAI_FREE(detokenizer.text);
+    ASSERT(tinyaiDetokenizerInit(&detokenizer, tokenizer, buffer, 4) == 0,
+           "Detokenizer should take a caller buffer");
+    int tokens[1000];
+    int streamed = 0;
+    for (int i = 0; i < 1000; i++) {
+        tokens[i] = i % 3 == 0 ? caf : ok;
+        streamed += tinyaiDetokenizerAppend(&detokenizer, tokens[i], NULL);
+    }
+    char *whole = (char *)TINYAI_MALLOC(4096);
+    ASSERT(whole != NULL, "Should allocate the decode buffer");
+    int wholeLength = tinyaiDecodeTokens(tokenizer, tokens, 1000, whole, 4096);
+    ASSERT(streamed == wholeLength && detokenizer.length == (size_t)wholeLength &&
+               strcmp(detokenizer.text, whole) == 0,
+           "Long streams should match whole decoding");
+    ASSERT(detokenizer.capacity > 4, "The buffer should grow");
+    size_t capacity = detokenizer.capacity;
+    tinyaiDetokenizerReset(&detokenizer);
+    ASSERT(detokenizer.length == 0 && detokenizer.capacity == capacity &&
+               detokenizer.text[0] == '\0',
+           "Reset should empty the text and keep the buffer");
+
+    TINYAI_FREE(whole);
+    TINYAI_FREE(detokenizer.text);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
 // Helper function to create a simple test corpus
 const char *get_test_corpus()
 {
@@ -263,6 +608,253 @@ void test_minimal_vocabulary()
     printf("    PASS\n");
 }
 
+// Test batch encoding against one-at-a-time encoding, serially and on worker threads
+void test_encode_batch()
+{
+    printf("  Testing batch encoding...\n");
+
+    TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
+    const char      *corpus    = get_test_corpus();
+    ASSERT(tinyaiCreateMinimalVocabulary(tokenizer, corpus, 100) == 0,
+           "Creating minimal vocabulary should succeed");
+
+    // A document long enough to split into several chunks, with a run of text that has no
+    // whitespace across a chunk boundary
+    size_t corpusLen = strlen(corpus);
+    size_t largeLen  = 5 * TINYAI_ENCODE_CHUNK_SIZE;
+    char  *large     = (char *)TINYAI_MALLOC(largeLen + 1);
+    ASSERT(large != NULL, "Should allocate the large document");
+    for (size_t i = 0; i < largeLen; i++) {
+        large[i] = corpus[i % corpusLen];
+    }
+    memset(large + TINYAI_ENCODE_CHUNK_SIZE - 100, 'x', 300);
+    large[largeLen] = '\0';
+
+    const char *texts[5] = {"Hello world!", "", large, "The quick brown fox.", corpus};
+    int         maxTokens = (int)largeLen + 1024;
+    int        *expected  = (int *)TINYAI_MALLOC(maxTokens * sizeof(int));
+    int        *tokens    = (int *)TINYAI_MALLOC(maxTokens * sizeof(int));
+    ASSERT(expected != NULL && tokens != NULL, "Should allocate token buffers");
+    int expectedOffsets[6] = {0};
+    for (int d = 0; d < 5; d++) {
+        int *documentTokens    = expected + expectedOffsets[d];
+        int  documentMax       = maxTokens - expectedOffsets[d];
+        expectedOffsets[d + 1] = expectedOffsets[d] + tinyaiEncodeText(tokenizer, texts[d],
+                                                                       documentTokens, documentMax);
+    }
+    int total = expectedOffsets[5];
+
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    for (int threads = 1; threads <= 4; threads += 3) {
+        tinyaiConfigSetInt("system.threads", threads);
+        tinyaiConfigSetInt("system.parallel_min_work", 1);
+        tinyaiShutdownThreadPool();
+
+        int offsets[6];
+        ASSERT(tinyaiEncodeTextBatch(tokenizer, texts, 5, tokens, maxTokens, offsets) == total,
+               "Batch encoding should count every token");
+        ASSERT(memcmp(offsets, expectedOffsets, sizeof(offsets)) == 0,
+               "Batch offsets should match one-at-a-time encoding");
+        ASSERT(memcmp(tokens, expected, total * sizeof(int)) == 0,
+               "Batch tokens should match one-at-a-time encoding");
+    }
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+
+    int offsets[6];
+    ASSERT(tinyaiEncodeTextBatch(tokenizer, texts, 5, tokens, total - 1, offsets) == -1,
+           "Batches that do not fit should fail");
+    ASSERT(tinyaiEncodeTextBatch(tokenizer, texts, 0, tokens, 0, offsets) == 0 && offsets[0] == 0,
+           "Empty batches should encode nothing");
+
+    TINYAI_FREE(tokens);
+    TINYAI_FREE(expected);
+    TINYAI_FREE(large);
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Test the word cache: same encodings as BPE, hit counting, eviction and invalidation
+void test_word_cache()
+{
+    printf("  Testing word cache...\n");
+
+    TinyAITokenizer *tokenizer = tinyaiCreateTokenizer();
+    const char      *corpus    = get_test_corpus();
+    ASSERT(tinyaiCreateMinimalVocabulary(tokenizer, corpus, 100) == 0,
+           "Creating minimal vocabulary should succeed");
+
+    int expected[1000];
+    int tokens[1000];
+    int expectedCount = tinyaiEncodeText(tokenizer, corpus, expected, 1000);
+
+    // A cache far smaller than the corpus vocabulary evicts constantly, yet never changes a result
+    TinyAIWordCacheStats stats;
+    for (uint32_t size = 4; size <= 4096; size *= 1024) {
+        ASSERT(tinyaiSetWordCacheSize(tokenizer, size) == 0, "Enabling the cache should succeed");
+        for (int pass = 0; pass < 3; pass++) {
+            ASSERT(tinyaiEncodeText(tokenizer, corpus, tokens, 1000) == expectedCount &&
+                       memcmp(tokens, expected, expectedCount * sizeof(int)) == 0,
+                   "Cached encoding should match BPE");
+        }
+        ASSERT(tinyaiGetWordCacheStats(tokenizer, &stats) == 0 && stats.capacity >= size &&
+                   stats.entries > 0 && stats.entries <= stats.capacity && stats.misses > 0,
+               "Cache statistics should count misses and entries");
+    }
+    uint64_t lookups = stats.hits + stats.misses;
+    ASSERT(stats.hits * 2 > lookups, "Repeat passes should mostly hit a large cache");
+    ASSERT(stats.entries < stats.capacity, "A large cache should hold the whole corpus");
+
+    // Case modes are cached apart
+    int upper[8];
+    int lower[8];
+    int upperCount = tinyaiEncodeText(tokenizer, "The", upper, 8);
+    tokenizer->caseSensitive = 1;
+    int sensitiveCount = tinyaiEncodeText(tokenizer, "The", lower, 8);
+    tinyaiSetWordCacheSize(tokenizer, 0);
+    ASSERT(sensitiveCount == tinyaiEncodeText(tokenizer, "The", tokens, 8) &&
+               memcmp(lower, tokens, sensitiveCount * sizeof(int)) == 0,
+           "Case-sensitive encoding should not reuse folded entries");
+    tokenizer->caseSensitive = 0;
+    ASSERT(upperCount == tinyaiEncodeText(tokenizer, "The", tokens, 8) &&
+               memcmp(upper, tokens, upperCount * sizeof(int)) == 0,
+           "Case-insensitive encoding should match BPE");
+
+    // New merge rules empty the cache
+    ASSERT(tinyaiSetWordCacheSize(tokenizer, 256) == 0, "Enabling the cache should succeed");
+    ASSERT(tinyaiEncodeText(tokenizer, "zq", tokens, 8) == 2, "Unmerged words should split");
+    int rank = tinyaiAddMerge(tokenizer, "z", "q");
+    ASSERT(rank >= 0, "Adding a rule should succeed");
+    ASSERT(tinyaiEncodeText(tokenizer, "zq", tokens, 8) == 1 &&
+               tokens[0] == tokenizer->merges[rank].result,
+           "Cached words should re-encode after the rules change");
+    ASSERT(tinyaiGetWordCacheStats(tokenizer, &stats) == 0 && stats.entries == 1,
+           "Adding a rule should drop cached words");
+
+    // Worker threads share the cache
+    const char *texts[4] = {corpus, corpus, corpus, corpus};
+    int         batch[4000];
+    int         offsets[5];
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiConfigSetInt("system.parallel_min_work", 1);
+    tinyaiShutdownThreadPool();
+    ASSERT(tinyaiEncodeTextBatch(tokenizer, texts, 4, batch, 4000, offsets) == 4 * expectedCount,
+           "Batch encoding should succeed");
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiConfigRemoveKey("system.parallel_min_work");
+    tinyaiShutdownThreadPool();
+    for (int d = 0; d < 4; d++) {
+        ASSERT(memcmp(batch + offsets[d], expected, expectedCount * sizeof(int)) == 0,
+               "Threads sharing the cache should match BPE");
+    }
+
+    ASSERT(tinyaiSetWordCacheSize(tokenizer, 0) == 0 &&
+               tinyaiGetWordCacheStats(tokenizer, &stats) == 0 && stats.capacity == 0,
+           "Disabling the cache should free it");
+    tinyaiDestroyTokenizer(tokenizer);
+    printf("    PASS\n");
+}
+
+// Whether two tokenizers hold the same tokens and merge rules
+static int same_vocabulary(const TinyAITokenizer *a, const TinyAITokenizer *b)
+{
+    if (a->tokenCount != b->tokenCount || a->mergeCount != b->mergeCount) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < a->tokenCount; i++) {
+        if (strcmp(tinyaiGetTokenString(a, (int)i), tinyaiGetTokenString(b, (int)i)) != 0 ||
+            a->frequencies[i] != b->frequencies[i]) {
+            return 0;
+        }
+    }
+    return memcmp(a->merges, b->merges, a->mergeCount * sizeof(TinyAIBPEMerge)) == 0;
+}
+
+// Test BPE vocabulary training: merge order, streamed blocks, shards and files
+void test_vocab_trainer()
+{
+    printf("  Testing vocabulary training...\n");
+
+    // The most frequent pair merges first, ties going to the lower token ids
+    TinyAITokenizer *small = tinyaiCreateTokenizer();
+    ASSERT(tinyaiCreateMinimalVocabulary(small, "low low low lower lower newest newest", 200) == 0,
+           "Training should succeed");
+    ASSERT(small->mergeCount >= 3, "Training should learn merge rules");
+    ASSERT(strcmp(tinyaiGetTokenString(small, small->merges[0].result), "lo") == 0 &&
+               strcmp(tinyaiGetTokenString(small, small->merges[1].result), "low") == 0,
+           "Merges should follow pair counts");
+    ASSERT(small->frequencies[small->merges[1].result] == 5,
+           "Merged tokens should get their pair count");
+    int tokens[16];
+    ASSERT(tinyaiEncodeText(small, "low", tokens, 16) == 1 &&
+               tokens[0] == small->merges[1].result,
+           "Frequent words should encode to one token");
+    ASSERT(tinyaiCreateMinimalVocabulary(small, "low low low", 100) == 0 &&
+               small->tokenCount <= 100,
+           "Training should stop at the vocabulary size");
+    tinyaiDestroyTokenizer(small);
+
+    // A corpus large enough to count in shards, with words that are not all alike
+    const char *corpus    = get_test_corpus();
+    size_t      corpusLen = strlen(corpus);
+    size_t      largeLen  = 40 * SHARD_TEST_BYTES;
+    char       *large     = (char *)TINYAI_MALLOC(largeLen + 1);
+    ASSERT(large != NULL, "Should allocate the corpus");
+    size_t n = 0;
+    for (int copy = 0; n + corpusLen + 16 < largeLen; copy++) {
+        n += (size_t)snprintf(large + n, largeLen + 1 - n, "%s word%d ", corpus, copy % 997);
+    }
+    large[n] = '\0';
+
+    TinyAITokenizer *expected = tinyaiCreateTokenizer();
+    ASSERT(tinyaiCreateMinimalVocabulary(expected, large, 500) == 0, "Training should succeed");
+    ASSERT(expected->tokenCount == 500, "A varied corpus should fill the vocabulary");
+
+    // Blocks of any size count the same as the whole text, words running across them
+    TinyAIVocabTrainer *trainer = tinyaiCreateVocabTrainer();
+    ASSERT(trainer != NULL, "Should create a trainer");
+    for (size_t start = 0; start < n; start += 7) {
+        size_t length = n - start < 7 ? n - start : 7;
+        ASSERT(tinyaiVocabTrainerAddText(trainer, large + start, length) == 0,
+               "Counting a block should succeed");
+    }
+    TinyAITokenizer *streamed = tinyaiCreateTokenizer();
+    ASSERT(tinyaiVocabTrainerBuild(trainer, streamed, 500) == 0, "Building should succeed");
+    ASSERT(same_vocabulary(expected, streamed), "Streamed blocks should train the same vocabulary");
+    tinyaiDestroyVocabTrainer(trainer);
+    tinyaiDestroyTokenizer(streamed);
+
+    // Shards counted on worker threads, and files streamed from disk, train the same vocabulary
+    ASSERT(tinyaiConfigInit() == 0, "Config initialization should succeed");
+    tinyaiConfigSetInt("system.threads", 4);
+    tinyaiShutdownThreadPool();
+    TinyAITokenizer *threaded = tinyaiCreateTokenizer();
+    ASSERT(tinyaiCreateMinimalVocabulary(threaded, large, 500) == 0, "Training should succeed");
+    ASSERT(same_vocabulary(expected, threaded), "Shards should train the same vocabulary");
+
+    const char *corpusPath = "test_trainer_corpus.txt";
+    FILE       *file       = fopen(corpusPath, "wb");
+    ASSERT(file != NULL && fwrite(large, 1, n, file) == n, "Should write the corpus file");
+    fclose(file);
+    TinyAITokenizer *fromFile = tinyaiCreateTokenizer();
+    ASSERT(tinyaiCreateVocabularyFromFile(fromFile, corpusPath, 500) == 0,
+           "Training from a file should succeed");
+    ASSERT(same_vocabulary(expected, fromFile), "Files should train the same vocabulary");
+    ASSERT(tinyaiCreateVocabularyFromFile(fromFile, "missing_corpus.txt", 500) != 0,
+           "Missing files should fail");
+    remove(corpusPath);
+    tinyaiConfigRemoveKey("system.threads");
+    tinyaiShutdownThreadPool();
+
+    tinyaiDestroyTokenizer(fromFile);
+    tinyaiDestroyTokenizer(threaded);
+    tinyaiDestroyTokenizer(expected);
+    TINYAI_FREE(large);
+    printf("    PASS\n");
+}
+
 // Function to be called by test_main.c
 void run_tokenizer_tests()
 {
@@ -273,8 +865,16 @@ void run_tokenizer_tests()
     test_encode_decode_simple();
     test_encode_decode_unknown();
     test_encoding_buffer_limits();
+    test_pre_tokenization();
     test_save_load_vocabulary();
+    test_token_index();
+    test_bpe_merges();
+    test_binary_vocabulary();
+    test_streaming_detokenizer();
     test_minimal_vocabulary();
+    test_encode_batch();
+    test_word_cache();
+    test_vocab_trainer();
 
     printf("--- Tokenizer Tests Finished ---\n");
 }
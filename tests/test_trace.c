@@ -0,0 +1,154 @@
+/**
+ * TinyAI Trace Span Tests
+ */
+
+#include "../utils/trace.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TRACE_THREADS 4
+#define TRACE_SPANS 1000
+
+static void *record_spans(void *arg)
+{
+    (void)arg;
+    tinyaiTraceSetThreadName("worker");
+    for (int i = 0; i < TRACE_SPANS; i++) {
+        uint64_t outer = TINYAI_TRACE_BEGIN();
+        uint64_t inner = TINYAI_TRACE_BEGIN();
+        TINYAI_TRACE_END_ARG(inner, "test.inner", i);
+        TINYAI_TRACE_END(outer, "test.outer");
+    }
+    return NULL;
+}
+
+// Read a whole file into a NUL-terminated string
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    ASSERT(file != NULL, "Trace file should exist");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = (char *)malloc((size_t)size + 1);
+    ASSERT(text != NULL, "Trace file should be read");
+    ASSERT(fread(text, 1, (size_t)size, file) == (size_t)size, "Trace file should be read");
+    text[size] = '\0';
+    fclose(file);
+    return text;
+}
+
+static int count_matches(const char *text, const char *pattern)
+{
+    int count = 0;
+    for (const char *p = strstr(text, pattern); p; p = strstr(p + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+static void test_trace_disabled()
+{
+    printf("  Testing trace spans while disabled...\n");
+
+    uint64_t span = TINYAI_TRACE_BEGIN();
+    ASSERT(span == 0, "A span should not start while tracing is off");
+    TINYAI_TRACE_END(span, "test.ignored");
+
+    TinyAITraceStats stats;
+    tinyaiTraceGetStats(&stats);
+    ASSERT(stats.spans == 0, "No spans should be recorded while tracing is off");
+
+    printf("    PASS\n");
+}
+
+static void test_trace_threads()
+{
+    printf("  Testing trace spans across threads...\n");
+
+    pthread_t threads[TRACE_THREADS];
+    ASSERT(tinyaiTraceStart(0), "Tracing should start");
+    for (int t = 0; t < TRACE_THREADS; t++) {
+        ASSERT(pthread_create(&threads[t], NULL, record_spans, NULL) == 0,
+               "Thread should start");
+    }
+    for (int t = 0; t < TRACE_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    tinyaiTraceStop();
+
+    TinyAITraceStats stats;
+    tinyaiTraceGetStats(&stats);
+    ASSERT(stats.spans == (size_t)TRACE_THREADS * TRACE_SPANS * 2, "Every span should be kept");
+    ASSERT(stats.threads == TRACE_THREADS, "Every thread should have its spans");
+    ASSERT(stats.dropped == 0, "No span should be dropped");
+
+    // Spans after the stop are not recorded
+    record_spans(NULL);
+    tinyaiTraceGetStats(&stats);
+    ASSERT(stats.spans == (size_t)TRACE_THREADS * TRACE_SPANS * 2,
+           "Spans should not be recorded after the stop");
+
+    const char *path = "test_trace.json";
+    ASSERT(tinyaiTraceWrite(path), "Trace should be written");
+    char *text = read_file(path);
+    ASSERT(strncmp(text, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 38) == 0,
+           "Trace should be Chrome trace JSON");
+    ASSERT(count_matches(text, "\"name\":\"test.outer\",\"ph\":\"X\"") ==
+               TRACE_THREADS * TRACE_SPANS,
+           "Every outer span should be written");
+    ASSERT(count_matches(text, "\"name\":\"test.inner\",\"ph\":\"X\"") ==
+               TRACE_THREADS * TRACE_SPANS,
+           "Every inner span should be written");
+    ASSERT(count_matches(text, "\"args\":{\"value\":999}") == TRACE_THREADS,
+           "Span arguments should be written");
+    ASSERT(count_matches(text, "\"args\":{\"name\":\"worker\"}") == TRACE_THREADS,
+           "Thread names should be written");
+    ASSERT(strstr(text, "\n]}\n") != NULL, "Trace should be complete");
+    free(text);
+    remove(path);
+
+    printf("    PASS\n");
+}
+
+static void test_trace_restart()
+{
+    printf("  Testing trace restart and full buffers...\n");
+
+    // A new trace discards the old spans and buffers at its own size
+    ASSERT(tinyaiTraceStart(10), "Tracing should start");
+    for (int i = 0; i < 25; i++) {
+        uint64_t span = TINYAI_TRACE_BEGIN();
+        ASSERT(span != 0, "A span should start while tracing is on");
+        TINYAI_TRACE_END(span, "test.small");
+    }
+    tinyaiTraceStop();
+
+    TinyAITraceStats stats;
+    tinyaiTraceGetStats(&stats);
+    ASSERT(stats.spans == 10, "A full buffer should keep its first spans");
+    ASSERT(stats.dropped == 15, "Spans past a full buffer should be counted as dropped");
+    ASSERT(stats.threads == 1, "Spans of the earlier trace should be discarded");
+
+    printf("    PASS\n");
+}
+
+void run_trace_tests()
+{
+    printf("\n--- Running Trace Tests ---\n");
+    test_trace_disabled();
+    test_trace_threads();
+    test_trace_restart();
+    printf("--- Trace Tests Finished ---\n");
+}
@@ -0,0 +1,273 @@
+/**
+ * TinyAI Vector Index Tests
+ */
+
+#include "../utils/vector_index.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Basic assertion helper (consistent with other test files)
+#define ASSERT(condition, message)                                                                 \
+    do {                                                                                           \
+        if (!(condition)) {                                                                        \
+            fprintf(stderr, "Assertion Failed: %s (%s:%d)\n", message, __FILE__, __LINE__);        \
+            exit(1);                                                                               \
+        }                                                                                          \
+    } while (0)
+
+#define TEST_DIM 32
+#define TEST_COUNT 2000
+#define TEST_QUERIES 50
+#define TEST_K 10
+
+// Fill vectors with values from a fixed linear congruential sequence
+static void fill_vectors(float *vectors, uint32_t count, uint32_t seed)
+{
+    uint32_t state = seed;
+    for (uint32_t i = 0; i < count * TEST_DIM; i++) {
+        state      = state * 1664525u + 1013904223u;
+        vectors[i] = (float)(state >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+    }
+}
+
+// Cosine distance computed in float
+static float cosine_distance(const float *a, const float *b)
+{
+    float dot = 0.0f, normA = 0.0f, normB = 0.0f;
+    for (int i = 0; i < TEST_DIM; i++) {
+        dot += a[i] * b[i];
+        normA += a[i] * a[i];
+        normB += b[i] * b[i];
+    }
+    return 1.0f - dot / sqrtf(normA * normB);
+}
+
+// Ids of the k nearest vectors by brute force
+static void exact_neighbors(const float *vectors, uint32_t count, const float *query, uint64_t *ids)
+{
+    float best[TEST_K];
+    for (int i = 0; i < TEST_K; i++) {
+        best[i] = INFINITY;
+        ids[i]  = UINT64_MAX;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        float distance = cosine_distance(&vectors[i * TEST_DIM], query);
+        int   slot     = TEST_K;
+        while (slot > 0 && distance < best[slot - 1]) {
+            slot--;
+        }
+        if (slot == TEST_K) {
+            continue;
+        }
+        memmove(&best[slot + 1], &best[slot], (TEST_K - 1 - slot) * sizeof(float));
+        memmove(&ids[slot + 1], &ids[slot], (TEST_K - 1 - slot) * sizeof(uint64_t));
+        best[slot] = distance;
+        ids[slot]  = i;
+    }
+}
+
+// Fraction of the exact neighbors found by the index
+static float measure_recall(const TinyAIVectorIndex *index, const float *vectors,
+                            const float *queries)
+{
+    int found = 0;
+    for (int q = 0; q < TEST_QUERIES; q++) {
+        uint64_t          exact[TEST_K];
+        TinyAIVectorMatch matches[TEST_K];
+        exact_neighbors(vectors, TEST_COUNT, &queries[q * TEST_DIM], exact);
+        int n = tinyaiVectorIndexSearch(index, &queries[q * TEST_DIM], TEST_K, 0, matches);
+        ASSERT(n == TEST_K, "Search should fill every match");
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < TEST_K; j++) {
+                found += matches[i].id == exact[j];
+            }
+        }
+    }
+    return (float)found / (TEST_QUERIES * TEST_K);
+}
+
+// Test that searches find most of the exact neighbors, closest first
+static void test_recall()
+{
+    printf("  Testing vector index recall...\n");
+
+    float *vectors = (float *)malloc(TEST_COUNT * TEST_DIM * sizeof(float));
+    float *queries = (float *)malloc(TEST_QUERIES * TEST_DIM * sizeof(float));
+    ASSERT(vectors != NULL && queries != NULL, "Test vectors should be allocated");
+    fill_vectors(vectors, TEST_COUNT, 1);
+    fill_vectors(queries, TEST_QUERIES, 2);
+
+    uint64_t *ids = (uint64_t *)malloc(TEST_COUNT * sizeof(uint64_t));
+    ASSERT(ids != NULL, "Ids should be allocated");
+    for (uint32_t i = 0; i < TEST_COUNT; i++) {
+        ids[i] = i;
+    }
+
+    TinyAIVectorIndexParams params = {TEST_DIM, TINYAI_VECTOR_COSINE, 0, 0, 0, 7};
+    TinyAIVectorIndex      *index  = tinyaiCreateVectorIndex(&params);
+    ASSERT(index != NULL, "Index should be created");
+    ASSERT(tinyaiVectorIndexAddBatch(index, ids, vectors, TEST_COUNT) == 0,
+           "Batch insert should succeed");
+    ASSERT(tinyaiVectorIndexSize(index) == TEST_COUNT, "Every vector should be counted");
+
+    float recall = measure_recall(index, vectors, queries);
+    printf("    Recall@%d: %.3f\n", TEST_K, recall);
+    ASSERT(recall >= 0.85f, "Search should find most exact neighbors");
+
+    TinyAIVectorMatch matches[TEST_K];
+    int               n = tinyaiVectorIndexSearch(index, queries, TEST_K, 200, matches);
+    ASSERT(n == TEST_K, "Search should fill every match");
+    for (int i = 1; i < n; i++) {
+        ASSERT(matches[i - 1].distance <= matches[i].distance, "Matches should be sorted");
+    }
+    float expected = cosine_distance(&vectors[matches[0].id * TEST_DIM], queries);
+    ASSERT(fabsf(matches[0].distance - expected) < 0.05f,
+           "Distances should approximate the float distance");
+
+    tinyaiDestroyVectorIndex(index);
+    free(ids);
+    free(queries);
+    free(vectors);
+    printf("  Vector index recall passed.\n");
+}
+
+// Test squared L2 search, incremental inserts and invalid arguments
+static void test_incremental_l2()
+{
+    printf("  Testing incremental L2 vector index...\n");
+
+    float vectors[200 * TEST_DIM];
+    fill_vectors(vectors, 200, 3);
+
+    TinyAIVectorIndexParams params = {TEST_DIM, TINYAI_VECTOR_L2, 8, 40, 32, 11};
+    TinyAIVectorIndex      *index  = tinyaiCreateVectorIndex(&params);
+    ASSERT(index != NULL, "Index should be created");
+
+    TinyAIVectorMatch matches[4];
+    ASSERT(tinyaiVectorIndexSearch(index, vectors, 4, 0, matches) == 0,
+           "An empty index should find nothing");
+
+    for (uint32_t i = 0; i < 200; i++) {
+        ASSERT(tinyaiVectorIndexAdd(index, 1000 + i, &vectors[i * TEST_DIM]) == 0,
+               "Insert should succeed");
+        // Every insert is searchable right away
+        int n = tinyaiVectorIndexSearch(index, &vectors[i * TEST_DIM], 1, 0, matches);
+        ASSERT(n == 1 && matches[0].id == 1000 + i, "A vector should find itself first");
+        ASSERT(matches[0].distance < 0.01f, "A vector should be close to itself");
+    }
+
+    ASSERT(tinyaiVectorIndexSearch(index, vectors, 4, 0, matches) == 4,
+           "Search should fill every match");
+
+    TinyAIVectorIndexParams bad = {0, TINYAI_VECTOR_L2, 0, 0, 0, 0};
+    ASSERT(tinyaiCreateVectorIndex(&bad) == NULL, "A zero dimension should be rejected");
+    bad.dimension = TEST_DIM;
+    bad.neighbors = 1;
+    ASSERT(tinyaiCreateVectorIndex(&bad) == NULL, "Too few neighbors should be rejected");
+    ASSERT(tinyaiVectorIndexAdd(index, 0, NULL) != 0, "A NULL vector should be rejected");
+    ASSERT(tinyaiVectorIndexSearch(index, NULL, 4, 0, matches) == -1,
+           "A NULL query should be rejected");
+
+    tinyaiDestroyVectorIndex(index);
+    printf("  Incremental L2 vector index passed.\n");
+}
+
+// Test that a saved index maps back with the same results and rejects damage
+static void test_save_load()
+{
+    printf("  Testing vector index save and load...\n");
+
+    const char *path = "test_vector_index.vidx";
+    float       vectors[300 * TEST_DIM];
+    float       extra[TEST_DIM];
+    fill_vectors(vectors, 300, 4);
+    fill_vectors(extra, 1, 5);
+
+    TinyAIVectorIndexParams params = {TEST_DIM, TINYAI_VECTOR_DOT, 0, 0, 0, 13};
+    TinyAIVectorIndex      *index  = tinyaiCreateVectorIndex(&params);
+    ASSERT(index != NULL, "Index should be created");
+    for (uint32_t i = 0; i < 300; i++) {
+        ASSERT(tinyaiVectorIndexAdd(index, i * 3, &vectors[i * TEST_DIM]) == 0,
+               "Insert should succeed");
+    }
+    ASSERT(tinyaiSaveVectorIndex(index, path) == 0, "Save should succeed");
+
+    TinyAIVectorIndex *loaded = tinyaiLoadVectorIndex(path);
+    ASSERT(loaded != NULL, "Load should succeed");
+    ASSERT(tinyaiVectorIndexSize(loaded) == 300, "Loaded index should keep every vector");
+    for (int q = 0; q < 20; q++) {
+        TinyAIVectorMatch expected[TEST_K], actual[TEST_K];
+        int n = tinyaiVectorIndexSearch(index, &vectors[q * TEST_DIM], TEST_K, 0, expected);
+        int m = tinyaiVectorIndexSearch(loaded, &vectors[q * TEST_DIM], TEST_K, 0, actual);
+        ASSERT(n == m && memcmp(expected, actual, n * sizeof(TinyAIVectorMatch)) == 0,
+               "Loaded index should return the same matches");
+    }
+
+    // Inserting copies the mapping and leaves the file untouched
+    FILE *file = fopen(path, "rb");
+    ASSERT(file != NULL, "Index file should exist");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    ASSERT(size > 64, "Index file should hold the vectors");
+    unsigned char *bytes = (unsigned char *)malloc((size_t)size);
+    ASSERT(bytes != NULL, "File buffer should be allocated");
+    fseek(file, 0, SEEK_SET);
+    ASSERT(fread(bytes, 1, (size_t)size, file) == (size_t)size, "Index file should be read");
+    fclose(file);
+
+    ASSERT(tinyaiVectorIndexAdd(loaded, 9999, extra) == 0, "Insert after load should succeed");
+    TinyAIVectorMatch match;
+    ASSERT(tinyaiVectorIndexSearch(loaded, extra, 1, 0, &match) == 1 && match.id == 9999,
+           "Insert after load should be searchable");
+    tinyaiDestroyVectorIndex(loaded);
+
+    loaded = tinyaiLoadVectorIndex(path);
+    ASSERT(loaded != NULL && tinyaiVectorIndexSize(loaded) == 300,
+           "Insert after load should not change the file");
+    tinyaiDestroyVectorIndex(loaded);
+
+    // A truncated file and a corrupt link are rejected
+    file = fopen(path, "wb");
+    ASSERT(file != NULL, "Index file should be writable");
+    fwrite(bytes, 1, (size_t)size / 2, file);
+    fclose(file);
+    ASSERT(tinyaiLoadVectorIndex(path) == NULL, "A truncated file should be rejected");
+
+    memset(bytes + size - 64, 0xff, 64);
+    file = fopen(path, "wb");
+    ASSERT(file != NULL, "Index file should be writable");
+    fwrite(bytes, 1, (size_t)size, file);
+    fclose(file);
+    loaded = tinyaiLoadVectorIndex(path);
+    if (loaded != NULL) {
+        // The damaged bytes may be padding; the index must still be searchable
+        TinyAIVectorMatch matches[TEST_K];
+        ASSERT(tinyaiVectorIndexSearch(loaded, vectors, TEST_K, 0, matches) >= 0,
+               "A loaded index should be searchable");
+        tinyaiDestroyVectorIndex(loaded);
+    }
+
+    memset(bytes, 0, 4);
+    file = fopen(path, "wb");
+    ASSERT(file != NULL, "Index file should be writable");
+    fwrite(bytes, 1, (size_t)size, file);
+    fclose(file);
+    ASSERT(tinyaiLoadVectorIndex(path) == NULL, "A bad magic number should be rejected");
+
+    free(bytes);
+    remove(path);
+    tinyaiDestroyVectorIndex(index);
+    printf("  Vector index save and load passed.\n");
+}
+
+void run_vector_index_tests()
+{
+    printf("--- Running Vector Index Tests ---\n");
+    test_recall();
+    test_incremental_l2();
+    test_save_load();
+    printf("--- Vector Index Tests Finished ---\n");
+}
@@ -13,6 +13,11 @@
 #if defined(__APPLE__)
 #include <mach/mach.h>
 #endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 #endif
 
 // Current version of TinyAI framework
@@ -30,6 +35,7 @@ void tinyai_init_benchmark_config(TinyAIBenchmarkConfig *config)
     config->num_iterations    = 10;
     config->warmup_iterations = 3;
     config->measure_memory    = true;
+    config->hw_counters       = false;
     config->verbose           = false;
 
     // Set default model options
@@ -74,6 +80,7 @@ void tinyai_init_benchmark_result(TinyAIBenchmarkResult *result)
     // Initialize performance metrics
     result->samples_processed  = 0;
     result->samples_per_second = 0.0;
+    memset(&result->hw_counters, 0, sizeof(result->hw_counters));
 
     // Initialize framework identification
     strcpy(result->framework_name, "TinyAI");
@@ -82,14 +89,165 @@ void tinyai_init_benchmark_result(TinyAIBenchmarkResult *result)
     memset(result->device_name, 0, sizeof(result->device_name));
 
     // Initialize modality-specific metrics to zero
+    result->modality = TINYAI_BENCHMARK_UNKNOWN;
     memset(&result->modality_metrics, 0, sizeof(result->modality_metrics));
 }
 
+// Hardware counters, indexed like the TINYAI_HW_* bits
+#define HW_NUM_EVENTS 5
+
+// Timers that can be running at once while counters are enabled
+#define HW_TIMER_SLOTS 8
+
+// Counter snapshot taken when a timer started
+typedef struct {
+    const struct timespec *timer; // Timer the snapshot belongs to (NULL = free)
+    uint64_t               counts[HW_NUM_EVENTS];
+} HwTimerSlot;
+
+static unsigned    g_hw_events;                 // TINYAI_HW_* bits of the open counters
+static uint64_t    g_hw_totals[HW_NUM_EVENTS];  // Counts summed over stopped timers
+static HwTimerSlot g_hw_slots[HW_TIMER_SLOTS];
+static unsigned    g_hw_next_evict; // Slot reused when all are taken
+
+#if defined(__linux__)
+static int g_hw_fds[HW_NUM_EVENTS] = {-1, -1, -1, -1, -1};
+
+// Open one counting event for this process and the threads it starts from now on
+static int hw_open_event(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.inherit        = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Read the open counters, scaled up for the time they were multiplexed out
+static void hw_read(uint64_t counts[HW_NUM_EVENTS])
+{
+    for (int i = 0; i < HW_NUM_EVENTS; i++) {
+        uint64_t value[3] = {0, 0, 0}; // Count, time enabled, time running
+        counts[i]         = 0;
+        if (g_hw_fds[i] < 0 || read(g_hw_fds[i], value, sizeof(value)) != sizeof(value))
+            continue;
+        if (value[2] > 0 && value[2] < value[1])
+            counts[i] = (uint64_t)((double)value[0] * value[1] / value[2]);
+        else
+            counts[i] = value[0];
+    }
+}
+
+bool tinyai_enable_hardware_counters(void)
+{
+    if (g_hw_events)
+        return true;
+
+    const uint64_t dtlb_read_miss = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    g_hw_fds[0] = hw_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    g_hw_fds[1] = hw_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    g_hw_fds[2] = hw_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    g_hw_fds[3] = hw_open_event(PERF_TYPE_HW_CACHE, dtlb_read_miss);
+    g_hw_fds[4] = hw_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+
+    // Events the CPU or the hypervisor does not expose are left out
+    for (int i = 0; i < HW_NUM_EVENTS; i++) {
+        if (g_hw_fds[i] >= 0)
+            g_hw_events |= 1u << i;
+    }
+    tinyai_reset_hardware_counters();
+    return g_hw_events != 0;
+}
+
+void tinyai_disable_hardware_counters(void)
+{
+    for (int i = 0; i < HW_NUM_EVENTS; i++) {
+        if (g_hw_fds[i] >= 0)
+            close(g_hw_fds[i]);
+        g_hw_fds[i] = -1;
+    }
+    g_hw_events = 0;
+    memset(g_hw_slots, 0, sizeof(g_hw_slots));
+}
+#else
+static void hw_read(uint64_t counts[HW_NUM_EVENTS])
+{
+    memset(counts, 0, HW_NUM_EVENTS * sizeof(uint64_t));
+}
+
+bool tinyai_enable_hardware_counters(void)
+{
+    return false;
+}
+
+void tinyai_disable_hardware_counters(void) {}
+#endif
+
+void tinyai_get_hardware_counters(TinyAIHardwareCounters *counters)
+{
+    if (!counters)
+        return;
+    counters->events        = g_hw_events;
+    counters->cycles        = g_hw_totals[0];
+    counters->instructions  = g_hw_totals[1];
+    counters->llc_misses    = g_hw_totals[2];
+    counters->dtlb_misses   = g_hw_totals[3];
+    counters->branch_misses = g_hw_totals[4];
+}
+
+void tinyai_reset_hardware_counters(void)
+{
+    memset(g_hw_totals, 0, sizeof(g_hw_totals));
+}
+
+// Snapshot the counters for a starting timer; a restarted timer reuses its slot
+static void hw_timer_start(const struct timespec *timer)
+{
+    HwTimerSlot *slot = NULL;
+    for (int i = 0; i < HW_TIMER_SLOTS && !slot; i++) {
+        if (g_hw_slots[i].timer == timer)
+            slot = &g_hw_slots[i];
+    }
+    for (int i = 0; i < HW_TIMER_SLOTS && !slot; i++) {
+        if (!g_hw_slots[i].timer)
+            slot = &g_hw_slots[i];
+    }
+    if (!slot) // Timers that were never stopped hold the slots; reuse the oldest
+        slot = &g_hw_slots[g_hw_next_evict++ % HW_TIMER_SLOTS];
+    slot->timer = timer;
+    hw_read(slot->counts);
+}
+
+// Add the counts since the timer started to the totals
+static void hw_timer_stop(const struct timespec *timer)
+{
+    for (int i = 0; i < HW_TIMER_SLOTS; i++) {
+        if (g_hw_slots[i].timer != timer)
+            continue;
+        uint64_t now[HW_NUM_EVENTS];
+        hw_read(now);
+        for (int e = 0; e < HW_NUM_EVENTS; e++) {
+            if (now[e] > g_hw_slots[i].counts[e])
+                g_hw_totals[e] += now[e] - g_hw_slots[i].counts[e];
+        }
+        g_hw_slots[i].timer = NULL;
+        return;
+    }
+}
+
 // Start benchmark timing
 void tinyai_benchmark_start_timer(struct timespec *start_time)
 {
     if (!start_time)
         return;
+    if (g_hw_events)
+        hw_timer_start(start_time);
 #ifdef _WIN32
     LARGE_INTEGER li;
     QueryPerformanceCounter(&li);
@@ -115,18 +273,64 @@ double tinyai_benchmark_stop_timer(struct timespec *start_time)
 #else
     clock_gettime(CLOCK_MONOTONIC, &end_time);
 #endif
+    if (g_hw_events)
+        hw_timer_stop(start_time);
 
     double elapsed_sec  = (end_time.tv_sec - start_time->tv_sec);
     double elapsed_nsec = (end_time.tv_nsec - start_time->tv_nsec) / 1000000000.0;
     return (elapsed_sec + elapsed_nsec) * 1000.0; // Convert to milliseconds
 }
 
+// Instructions per cycle of collected counters
+static double hw_ipc(const TinyAIHardwareCounters *hw)
+{
+    return hw->cycles > 0 ? (double)hw->instructions / hw->cycles : 0.0;
+}
+
+// Events per thousand instructions, 0 when instructions were not counted
+static double hw_mpki(const TinyAIHardwareCounters *hw, uint64_t count)
+{
+    if (!(hw->events & TINYAI_HW_INSTRUCTIONS) || hw->instructions == 0)
+        return 0.0;
+    return count * 1000.0 / hw->instructions;
+}
+
+// Write one counter as a JSON member, null when the event was not collected
+static void write_hw_json(FILE *file, const char *in, const char *name,
+                          const TinyAIHardwareCounters *hw, unsigned event, uint64_t count,
+                          bool last)
+{
+    if (hw->events & event)
+        fprintf(file, "%s    \"%s\": %llu%s\n", in, name, (unsigned long long)count,
+                last ? "" : ",");
+    else
+        fprintf(file, "%s    \"%s\": null%s\n", in, name, last ? "" : ",");
+}
+
+// Modality of a result, guessed from the model name when not set
+static TinyAIBenchmarkModality result_modality(const TinyAIBenchmarkResult *result)
+{
+    if (result->modality != TINYAI_BENCHMARK_UNKNOWN)
+        return result->modality;
+    if (strstr(result->model_name, "text") || strstr(result->model_name, "Text"))
+        return TINYAI_BENCHMARK_TEXT;
+    if (strstr(result->model_name, "image") || strstr(result->model_name, "Image"))
+        return TINYAI_BENCHMARK_IMAGE;
+    if (strstr(result->model_name, "audio") || strstr(result->model_name, "Audio"))
+        return TINYAI_BENCHMARK_AUDIO;
+    if (strstr(result->model_name, "multimodal") || strstr(result->model_name, "Multimodal"))
+        return TINYAI_BENCHMARK_MULTIMODAL;
+    return TINYAI_BENCHMARK_UNKNOWN;
+}
+
 // Export benchmark results to CSV
 bool tinyai_export_benchmark_csv(const TinyAIBenchmarkResult *result, const char *filepath)
 {
     if (!result || !filepath)
         return false;
 
+    TinyAIBenchmarkModality modality = result_modality(result);
+
     FILE *file = fopen(filepath, "w");
     if (!file)
         return false;
@@ -147,7 +351,7 @@ bool tinyai_export_benchmark_csv(const TinyAIBenchmarkResult *result, const char
     fprintf(file, "Model Size (bytes),%zu\n", result->model_size_bytes);
 
     // Write hardware utilization
-    fprintf(file, "CPU Utilization (%%),%%.2f\n", result->cpu_utilization);
+    fprintf(file, "CPU Utilization (%%),%.2f\n", result->cpu_utilization);
     fprintf(file, "Threads Used,%d\n", result->threads_used);
     fprintf(file, "SIMD Used,%s\n", result->simd_used ? "true" : "false");
     fprintf(file, "SIMD Type,%s\n", result->simd_type);
@@ -156,28 +360,66 @@ bool tinyai_export_benchmark_csv(const TinyAIBenchmarkResult *result, const char
     fprintf(file, "Samples Processed,%d\n", result->samples_processed);
     fprintf(file, "Samples Per Second,%.2f\n", result->samples_per_second);
 
+    // Write hardware counters that were collected
+    const TinyAIHardwareCounters *hw = &result->hw_counters;
+    if (hw->events & TINYAI_HW_CYCLES)
+        fprintf(file, "Cycles,%llu\n", (unsigned long long)hw->cycles);
+    if (hw->events & TINYAI_HW_INSTRUCTIONS)
+        fprintf(file, "Instructions,%llu\n", (unsigned long long)hw->instructions);
+    if ((hw->events & TINYAI_HW_CYCLES) && (hw->events & TINYAI_HW_INSTRUCTIONS))
+        fprintf(file, "Instructions Per Cycle,%.3f\n", hw_ipc(hw));
+    if (hw->events & TINYAI_HW_LLC_MISSES) {
+        fprintf(file, "LLC Misses,%llu\n", (unsigned long long)hw->llc_misses);
+        fprintf(file, "LLC Misses Per 1K Instructions,%.3f\n", hw_mpki(hw, hw->llc_misses));
+    }
+    if (hw->events & TINYAI_HW_DTLB_MISSES) {
+        fprintf(file, "dTLB Misses,%llu\n", (unsigned long long)hw->dtlb_misses);
+        fprintf(file, "dTLB Misses Per 1K Instructions,%.3f\n", hw_mpki(hw, hw->dtlb_misses));
+    }
+    if (hw->events & TINYAI_HW_BRANCH_MISSES) {
+        fprintf(file, "Branch Misses,%llu\n", (unsigned long long)hw->branch_misses);
+        fprintf(file, "Branch Misses Per 1K Instructions,%.3f\n",
+                hw_mpki(hw, hw->branch_misses));
+    }
+
     // Write framework identification
     fprintf(file, "Framework,%s\n", result->framework_name);
     fprintf(file, "Framework Version,%s\n", result->framework_version);
     fprintf(file, "Model,%s\n", result->model_name);
     fprintf(file, "Device,%s\n", result->device_name);
 
-    // Write modality-specific metrics based on framework name
-    if (strstr(result->model_name, "text") || strstr(result->model_name, "Text")) {
+    // Write modality-specific metrics
+    if (modality == TINYAI_BENCHMARK_TEXT) {
         fprintf(file, "Tokens Per Second,%.2f\n", result->modality_metrics.text.tokens_per_second);
         fprintf(file, "Context Length,%d\n", result->modality_metrics.text.context_length);
+        fprintf(file, "Prompt Tokens,%d\n", result->modality_metrics.text.prompt_tokens);
+        fprintf(file, "Batch Size,%d\n", result->modality_metrics.text.batch_size);
+        fprintf(file, "Prefill Tokens Per Second,%.2f\n",
+                result->modality_metrics.text.prefill_tokens_per_second);
+        fprintf(file, "Decode Tokens Per Second,%.2f\n",
+                result->modality_metrics.text.decode_tokens_per_second);
+        fprintf(file, "Time To First Token p50 (ms),%.3f\n",
+                result->modality_metrics.text.ttft_p50_ms);
+        fprintf(file, "Time To First Token p99 (ms),%.3f\n",
+                result->modality_metrics.text.ttft_p99_ms);
+        fprintf(file, "Inter-Token Latency p50 (ms),%.3f\n",
+                result->modality_metrics.text.itl_p50_ms);
+        fprintf(file, "Inter-Token Latency p90 (ms),%.3f\n",
+                result->modality_metrics.text.itl_p90_ms);
+        fprintf(file, "Inter-Token Latency p99 (ms),%.3f\n",
+                result->modality_metrics.text.itl_p99_ms);
     }
-    else if (strstr(result->model_name, "image") || strstr(result->model_name, "Image")) {
+    else if (modality == TINYAI_BENCHMARK_IMAGE) {
         fprintf(file, "Image Width,%d\n", result->modality_metrics.image.image_width);
         fprintf(file, "Image Height,%d\n", result->modality_metrics.image.image_height);
         fprintf(file, "FPS,%.2f\n", result->modality_metrics.image.fps);
     }
-    else if (strstr(result->model_name, "audio") || strstr(result->model_name, "Audio")) {
+    else if (modality == TINYAI_BENCHMARK_AUDIO) {
         fprintf(file, "Sample Rate,%d\n", result->modality_metrics.audio.sample_rate);
         fprintf(file, "Audio Length (s),%.2f\n", result->modality_metrics.audio.audio_length_sec);
         fprintf(file, "Real-Time Factor,%.2f\n", result->modality_metrics.audio.real_time_factor);
     }
-    else if (strstr(result->model_name, "multimodal") || strstr(result->model_name, "Multimodal")) {
+    else if (modality == TINYAI_BENCHMARK_MULTIMODAL) {
         fprintf(file, "Number of Modalities,%d\n",
                 result->modality_metrics.multimodal.num_modalities);
         fprintf(file, "Fusion Time (ms),%.2f\n",
@@ -188,98 +430,158 @@ bool tinyai_export_benchmark_csv(const TinyAIBenchmarkResult *result, const char
     return true;
 }
 
-// Export benchmark results to JSON
-bool tinyai_export_benchmark_json(const TinyAIBenchmarkResult *result, const char *filepath)
+// Write one result as a JSON object, every line after the first starting with indent
+static void write_benchmark_json(FILE *file, const TinyAIBenchmarkResult *result,
+                                 const char *indent)
 {
-    if (!result || !filepath)
-        return false;
+    const char             *in       = indent;
+    TinyAIBenchmarkModality modality = result_modality(result);
 
-    FILE *file = fopen(filepath, "w");
-    if (!file)
-        return false;
-
-    // Write JSON header
     fprintf(file, "{\n");
 
     // Write timing metrics
-    fprintf(file, "  \"timing\": {\n");
-    fprintf(file, "    \"total_time_ms\": %.2f,\n", result->total_time_ms);
-    fprintf(file, "    \"avg_inference_time_ms\": %.2f,\n", result->avg_inference_time_ms);
-    fprintf(file, "    \"std_dev_time_ms\": %.2f,\n", result->std_dev_time_ms);
-    fprintf(file, "    \"min_time_ms\": %.2f,\n", result->min_time_ms);
-    fprintf(file, "    \"max_time_ms\": %.2f\n", result->max_time_ms);
-    fprintf(file, "  },\n");
+    fprintf(file, "%s  \"timing\": {\n", in);
+    fprintf(file, "%s    \"total_time_ms\": %.2f,\n", in, result->total_time_ms);
+    fprintf(file, "%s    \"avg_inference_time_ms\": %.2f,\n", in, result->avg_inference_time_ms);
+    fprintf(file, "%s    \"std_dev_time_ms\": %.2f,\n", in, result->std_dev_time_ms);
+    fprintf(file, "%s    \"min_time_ms\": %.2f,\n", in, result->min_time_ms);
+    fprintf(file, "%s    \"max_time_ms\": %.2f\n", in, result->max_time_ms);
+    fprintf(file, "%s  },\n", in);
 
     // Write memory metrics
-    fprintf(file, "  \"memory\": {\n");
-    fprintf(file, "    \"peak_memory_bytes\": %zu,\n", result->peak_memory_bytes);
-    fprintf(file, "    \"avg_memory_bytes\": %zu,\n", result->avg_memory_bytes);
-    fprintf(file, "    \"model_size_bytes\": %zu\n", result->model_size_bytes);
-    fprintf(file, "  },\n");
+    fprintf(file, "%s  \"memory\": {\n", in);
+    fprintf(file, "%s    \"peak_memory_bytes\": %zu,\n", in, result->peak_memory_bytes);
+    fprintf(file, "%s    \"avg_memory_bytes\": %zu,\n", in, result->avg_memory_bytes);
+    fprintf(file, "%s    \"model_size_bytes\": %zu\n", in, result->model_size_bytes);
+    fprintf(file, "%s  },\n", in);
 
     // Write hardware utilization
-    fprintf(file, "  \"hardware\": {\n");
-    fprintf(file, "    \"cpu_utilization\": %.2f,\n", result->cpu_utilization);
-    fprintf(file, "    \"threads_used\": %d,\n", result->threads_used);
-    fprintf(file, "    \"simd_used\": %s,\n", result->simd_used ? "true" : "false");
-    fprintf(file, "    \"simd_type\": \"%s\"\n", result->simd_type);
-    fprintf(file, "  },\n");
+    fprintf(file, "%s  \"hardware\": {\n", in);
+    fprintf(file, "%s    \"cpu_utilization\": %.2f,\n", in, result->cpu_utilization);
+    fprintf(file, "%s    \"threads_used\": %d,\n", in, result->threads_used);
+    fprintf(file, "%s    \"simd_used\": %s,\n", in, result->simd_used ? "true" : "false");
+    fprintf(file, "%s    \"simd_type\": \"%s\"\n", in, result->simd_type);
+    fprintf(file, "%s  },\n", in);
 
     // Write performance metrics
-    fprintf(file, "  \"performance\": {\n");
-    fprintf(file, "    \"samples_processed\": %d,\n", result->samples_processed);
-    fprintf(file, "    \"samples_per_second\": %.2f\n", result->samples_per_second);
-    fprintf(file, "  },\n");
+    fprintf(file, "%s  \"performance\": {\n", in);
+    fprintf(file, "%s    \"samples_processed\": %d,\n", in, result->samples_processed);
+    fprintf(file, "%s    \"samples_per_second\": %.2f\n", in, result->samples_per_second);
+    fprintf(file, "%s  },\n", in);
+
+    // Write hardware counters, null for events that were not collected
+    const TinyAIHardwareCounters *hw = &result->hw_counters;
+    fprintf(file, "%s  \"hardware_counters\": {\n", in);
+    fprintf(file, "%s    \"available\": %s,\n", in, hw->events ? "true" : "false");
+    write_hw_json(file, in, "cycles", hw, TINYAI_HW_CYCLES, hw->cycles, false);
+    write_hw_json(file, in, "instructions", hw, TINYAI_HW_INSTRUCTIONS, hw->instructions, false);
+    write_hw_json(file, in, "llc_misses", hw, TINYAI_HW_LLC_MISSES, hw->llc_misses, false);
+    write_hw_json(file, in, "dtlb_misses", hw, TINYAI_HW_DTLB_MISSES, hw->dtlb_misses, false);
+    write_hw_json(file, in, "branch_misses", hw, TINYAI_HW_BRANCH_MISSES, hw->branch_misses,
+                  true);
+    fprintf(file, "%s  },\n", in);
 
     // Write framework identification
-    fprintf(file, "  \"framework\": {\n");
-    fprintf(file, "    \"name\": \"%s\",\n", result->framework_name);
-    fprintf(file, "    \"version\": \"%s\",\n", result->framework_version);
-    fprintf(file, "    \"model\": \"%s\",\n", result->model_name);
-    fprintf(file, "    \"device\": \"%s\"\n", result->device_name);
-    fprintf(file, "  }");
-
-    // Write modality-specific metrics based on framework name
-    if (strstr(result->model_name, "text") || strstr(result->model_name, "Text")) {
-        fprintf(file, ",\n  \"text_metrics\": {\n");
-        fprintf(file, "    \"tokens_per_second\": %.2f,\n",
+    fprintf(file, "%s  \"framework\": {\n", in);
+    fprintf(file, "%s    \"name\": \"%s\",\n", in, result->framework_name);
+    fprintf(file, "%s    \"version\": \"%s\",\n", in, result->framework_version);
+    fprintf(file, "%s    \"model\": \"%s\",\n", in, result->model_name);
+    fprintf(file, "%s    \"device\": \"%s\"\n", in, result->device_name);
+    fprintf(file, "%s  }", in);
+
+    // Write modality-specific metrics
+    if (modality == TINYAI_BENCHMARK_TEXT) {
+        fprintf(file, ",\n%s  \"text_metrics\": {\n", in);
+        fprintf(file, "%s    \"tokens_per_second\": %.2f,\n", in,
                 result->modality_metrics.text.tokens_per_second);
-        fprintf(file, "    \"context_length\": %d\n", result->modality_metrics.text.context_length);
-        fprintf(file, "  }\n");
-    }
-    else if (strstr(result->model_name, "image") || strstr(result->model_name, "Image")) {
-        fprintf(file, ",\n  \"image_metrics\": {\n");
-        fprintf(file, "    \"image_width\": %d,\n", result->modality_metrics.image.image_width);
-        fprintf(file, "    \"image_height\": %d,\n", result->modality_metrics.image.image_height);
-        fprintf(file, "    \"fps\": %.2f\n", result->modality_metrics.image.fps);
-        fprintf(file, "  }\n");
-    }
-    else if (strstr(result->model_name, "audio") || strstr(result->model_name, "Audio")) {
-        fprintf(file, ",\n  \"audio_metrics\": {\n");
-        fprintf(file, "    \"sample_rate\": %d,\n", result->modality_metrics.audio.sample_rate);
-        fprintf(file, "    \"audio_length_sec\": %.2f,\n",
+        fprintf(file, "%s    \"context_length\": %d,\n", in,
+                result->modality_metrics.text.context_length);
+        fprintf(file, "%s    \"prompt_tokens\": %d,\n", in,
+                result->modality_metrics.text.prompt_tokens);
+        fprintf(file, "%s    \"batch_size\": %d,\n", in, result->modality_metrics.text.batch_size);
+        fprintf(file, "%s    \"prefill_tokens_per_second\": %.2f,\n", in,
+                result->modality_metrics.text.prefill_tokens_per_second);
+        fprintf(file, "%s    \"decode_tokens_per_second\": %.2f,\n", in,
+                result->modality_metrics.text.decode_tokens_per_second);
+        fprintf(file, "%s    \"ttft_p50_ms\": %.3f,\n", in, result->modality_metrics.text.ttft_p50_ms);
+        fprintf(file, "%s    \"ttft_p99_ms\": %.3f,\n", in, result->modality_metrics.text.ttft_p99_ms);
+        fprintf(file, "%s    \"itl_p50_ms\": %.3f,\n", in, result->modality_metrics.text.itl_p50_ms);
+        fprintf(file, "%s    \"itl_p90_ms\": %.3f,\n", in, result->modality_metrics.text.itl_p90_ms);
+        fprintf(file, "%s    \"itl_p99_ms\": %.3f\n", in, result->modality_metrics.text.itl_p99_ms);
+        fprintf(file, "%s  }\n", in);
+    }
+    else if (modality == TINYAI_BENCHMARK_IMAGE) {
+        fprintf(file, ",\n%s  \"image_metrics\": {\n", in);
+        fprintf(file, "%s    \"image_width\": %d,\n", in,
+                result->modality_metrics.image.image_width);
+        fprintf(file, "%s    \"image_height\": %d,\n", in,
+                result->modality_metrics.image.image_height);
+        fprintf(file, "%s    \"fps\": %.2f\n", in, result->modality_metrics.image.fps);
+        fprintf(file, "%s  }\n", in);
+    }
+    else if (modality == TINYAI_BENCHMARK_AUDIO) {
+        fprintf(file, ",\n%s  \"audio_metrics\": {\n", in);
+        fprintf(file, "%s    \"sample_rate\": %d,\n", in,
+                result->modality_metrics.audio.sample_rate);
+        fprintf(file, "%s    \"audio_length_sec\": %.2f,\n", in,
                 result->modality_metrics.audio.audio_length_sec);
-        fprintf(file, "    \"real_time_factor\": %.2f\n",
+        fprintf(file, "%s    \"real_time_factor\": %.2f\n", in,
                 result->modality_metrics.audio.real_time_factor);
-        fprintf(file, "  }\n");
+        fprintf(file, "%s  }\n", in);
     }
-    else if (strstr(result->model_name, "multimodal") || strstr(result->model_name, "Multimodal")) {
-        fprintf(file, ",\n  \"multimodal_metrics\": {\n");
-        fprintf(file, "    \"num_modalities\": %d,\n",
+    else if (modality == TINYAI_BENCHMARK_MULTIMODAL) {
+        fprintf(file, ",\n%s  \"multimodal_metrics\": {\n", in);
+        fprintf(file, "%s    \"num_modalities\": %d,\n", in,
                 result->modality_metrics.multimodal.num_modalities);
-        fprintf(file, "    \"fusion_time_ms\": %.2f\n",
+        fprintf(file, "%s    \"fusion_time_ms\": %.2f\n", in,
                 result->modality_metrics.multimodal.fusion_time_ms);
-        fprintf(file, "  }\n");
+        fprintf(file, "%s  }\n", in);
     }
     else {
         fprintf(file, "\n");
     }
 
     // Close JSON object
-    fprintf(file, "}\n");
+    fprintf(file, "%s}", in);
+}
 
-    fclose(file);
-    return true;
+// Export benchmark results to JSON
+bool tinyai_export_benchmark_json(const TinyAIBenchmarkResult *result, const char *filepath)
+{
+    if (!result || !filepath)
+        return false;
+
+    FILE *file = fopen(filepath, "w");
+    if (!file)
+        return false;
+
+    write_benchmark_json(file, result, "");
+    fprintf(file, "\n");
+
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
+
+// Export the results of several runs as a JSON array
+bool tinyai_export_benchmark_json_runs(const TinyAIBenchmarkResult *results, int num_results,
+                                       const char *filepath)
+{
+    if (!results || num_results < 0 || !filepath)
+        return false;
+
+    FILE *file = fopen(filepath, "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "[");
+    for (int i = 0; i < num_results; i++) {
+        fprintf(file, i > 0 ? ",\n  " : "\n  ");
+        write_benchmark_json(file, &results[i], "  ");
+    }
+    fprintf(file, "\n]\n");
+
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
 }
 
 // Print benchmark results to console
@@ -288,6 +590,8 @@ void tinyai_print_benchmark_results(const TinyAIBenchmarkResult *result)
     if (!result)
         return;
 
+    TinyAIBenchmarkModality modality = result_modality(result);
+
     printf("\n===== BENCHMARK RESULTS =====\n");
     printf("Model: %s\n", result->model_name);
     printf("Framework: %s v%s\n", result->framework_name, result->framework_version);
@@ -317,19 +621,50 @@ void tinyai_print_benchmark_results(const TinyAIBenchmarkResult *result)
     printf("Samples Processed: %d\n", result->samples_processed);
     printf("Samples Per Second: %.2f\n", result->samples_per_second);
 
+    const TinyAIHardwareCounters *hw = &result->hw_counters;
+    if (hw->events) {
+        printf("\n-- Hardware Counters --\n");
+        if (hw->events & TINYAI_HW_CYCLES)
+            printf("Cycles: %llu\n", (unsigned long long)hw->cycles);
+        if (hw->events & TINYAI_HW_INSTRUCTIONS)
+            printf("Instructions: %llu\n", (unsigned long long)hw->instructions);
+        if ((hw->events & TINYAI_HW_CYCLES) && (hw->events & TINYAI_HW_INSTRUCTIONS))
+            printf("IPC: %.3f\n", hw_ipc(hw));
+        if (hw->events & TINYAI_HW_LLC_MISSES)
+            printf("LLC Misses: %llu (%.3f per 1K instructions)\n",
+                   (unsigned long long)hw->llc_misses, hw_mpki(hw, hw->llc_misses));
+        if (hw->events & TINYAI_HW_DTLB_MISSES)
+            printf("dTLB Misses: %llu (%.3f per 1K instructions)\n",
+                   (unsigned long long)hw->dtlb_misses, hw_mpki(hw, hw->dtlb_misses));
+        if (hw->events & TINYAI_HW_BRANCH_MISSES)
+            printf("Branch Misses: %llu (%.3f per 1K instructions)\n",
+                   (unsigned long long)hw->branch_misses, hw_mpki(hw, hw->branch_misses));
+    }
+
     // Print modality-specific metrics
-    if (strstr(result->model_name, "text") || strstr(result->model_name, "Text")) {
+    if (modality == TINYAI_BENCHMARK_TEXT) {
         printf("\n-- Text-Specific Metrics --\n");
         printf("Tokens Per Second: %.2f\n", result->modality_metrics.text.tokens_per_second);
         printf("Context Length: %d\n", result->modality_metrics.text.context_length);
+        printf("Prompt Tokens: %d (batch of %d)\n", result->modality_metrics.text.prompt_tokens,
+               result->modality_metrics.text.batch_size);
+        printf("Prefill / Decode: %.2f / %.2f tokens/sec\n",
+               result->modality_metrics.text.prefill_tokens_per_second,
+               result->modality_metrics.text.decode_tokens_per_second);
+        printf("Time To First Token p50/p99: %.3f / %.3f ms\n",
+               result->modality_metrics.text.ttft_p50_ms,
+               result->modality_metrics.text.ttft_p99_ms);
+        printf("Inter-Token Latency p50/p90/p99: %.3f / %.3f / %.3f ms\n",
+               result->modality_metrics.text.itl_p50_ms, result->modality_metrics.text.itl_p90_ms,
+               result->modality_metrics.text.itl_p99_ms);
     }
-    else if (strstr(result->model_name, "image") || strstr(result->model_name, "Image")) {
+    else if (modality == TINYAI_BENCHMARK_IMAGE) {
         printf("\n-- Image-Specific Metrics --\n");
         printf("Resolution: %dx%d\n", result->modality_metrics.image.image_width,
                result->modality_metrics.image.image_height);
         printf("FPS: %.2f\n", result->modality_metrics.image.fps);
     }
-    else if (strstr(result->model_name, "audio") || strstr(result->model_name, "Audio")) {
+    else if (modality == TINYAI_BENCHMARK_AUDIO) {
         printf("\n-- Audio-Specific Metrics --\n");
         printf("Sample Rate: %d Hz\n", result->modality_metrics.audio.sample_rate);
         printf("Audio Length: %.2f seconds\n", result->modality_metrics.audio.audio_length_sec);
@@ -337,7 +672,7 @@ void tinyai_print_benchmark_results(const TinyAIBenchmarkResult *result)
                result->modality_metrics.audio.real_time_factor < 1.0 ? " (faster than real-time)"
                                                                      : "");
     }
-    else if (strstr(result->model_name, "multimodal") || strstr(result->model_name, "Multimodal")) {
+    else if (modality == TINYAI_BENCHMARK_MULTIMODAL) {
         printf("\n-- Multimodal-Specific Metrics --\n");
         printf("Number of Modalities: %d\n", result->modality_metrics.multimodal.num_modalities);
         printf("Fusion Time: %.2f ms\n", result->modality_metrics.multimodal.fusion_time_ms);
@@ -466,6 +801,24 @@ size_t tinyai_measure_peak_memory_usage(void)
 #endif
 }
 
+bool tinyai_reset_peak_memory_usage(void)
+{
+#if defined(_WIN32) || defined(__APPLE__)
+    return false;
+#else
+    // Linux: writing 5 to clear_refs resets VmHWM to the current RSS
+    FILE *file = fopen("/proc/self/clear_refs", "w");
+    if (file == NULL) {
+        return false;
+    }
+    bool reset = fputs("5", file) >= 0;
+    if (fclose(file) != 0) {
+        reset = false;
+    }
+    return reset;
+#endif
+}
+
 // Function to detect and return the available SIMD capabilities
 const char *tinyai_detect_simd_capabilities(void)
 {
@@ -486,6 +839,31 @@ const char *tinyai_detect_simd_capabilities(void)
 #endif
 }
 
+static int compare_samples(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Compute a percentile of samples, interpolating between the two closest ranks
+double tinyai_percentile(double *samples, int count, double percentile)
+{
+    if (!samples || count <= 0)
+        return 0.0;
+
+    qsort(samples, count, sizeof(double), compare_samples);
+    double rank = percentile / 100.0 * (count - 1);
+    if (rank <= 0.0)
+        return samples[0];
+    if (rank >= count - 1)
+        return samples[count - 1];
+
+    int    lower    = (int)rank;
+    double fraction = rank - lower;
+    return samples[lower] + (samples[lower + 1] - samples[lower]) * fraction;
+}
+
 // Function to determine the optimal number of threads
 int tinyai_determine_optimal_threads(void)
 {
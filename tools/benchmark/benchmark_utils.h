@@ -8,6 +8,34 @@
 #include <string.h>
 #include <time.h>
 
+// Modality of a benchmark result, selecting its modality-specific metrics
+typedef enum {
+    TINYAI_BENCHMARK_UNKNOWN, // Guessed from the model name
+    TINYAI_BENCHMARK_TEXT,
+    TINYAI_BENCHMARK_IMAGE,
+    TINYAI_BENCHMARK_AUDIO,
+    TINYAI_BENCHMARK_MULTIMODAL
+} TinyAIBenchmarkModality;
+
+// Hardware events, as bits of TinyAIHardwareCounters.events
+enum {
+    TINYAI_HW_CYCLES        = 1 << 0,
+    TINYAI_HW_INSTRUCTIONS  = 1 << 1,
+    TINYAI_HW_LLC_MISSES    = 1 << 2,
+    TINYAI_HW_DTLB_MISSES   = 1 << 3,
+    TINYAI_HW_BRANCH_MISSES = 1 << 4
+};
+
+// Hardware event counts summed over timed intervals, all threads included
+typedef struct {
+    unsigned events;        // TINYAI_HW_* bits of the counts below that were collected (0 = none)
+    uint64_t cycles;        // CPU cycles
+    uint64_t instructions;  // Instructions retired
+    uint64_t llc_misses;    // Last-level cache misses
+    uint64_t dtlb_misses;   // Data TLB load misses
+    uint64_t branch_misses; // Mispredicted branches
+} TinyAIHardwareCounters;
+
 // Define benchmark result structure
 typedef struct {
     // Timing metrics
@@ -32,18 +60,32 @@ typedef struct {
     int    samples_processed;  // Number of samples processed
     double samples_per_second; // Samples processed per second
 
+    // Hardware counters over the measured runs (events == 0 when not collected)
+    TinyAIHardwareCounters hw_counters;
+
     // Framework identification
     char framework_name[32];    // Name of the framework (TinyAI, TFLite, etc.)
     char framework_version[16]; // Version of the framework
     char model_name[64];        // Name of the model
     char device_name[64];       // Name of the device
 
+    TinyAIBenchmarkModality modality; // Modality of the metrics below
+
     // Additional metrics specific to modality
     union {
         // Text-specific metrics
         struct {
-            double tokens_per_second; // Tokens processed per second
-            int    context_length;    // Context length used
+            double tokens_per_second;         // Tokens processed per second
+            int    context_length;            // Context length used
+            int    prompt_tokens;             // Prompt length of each sequence
+            int    batch_size;                // Sequences generated together
+            double prefill_tokens_per_second; // Prompt tokens processed per second
+            double decode_tokens_per_second;  // Tokens generated per second after the first
+            double ttft_p50_ms;               // Time to first token, median
+            double ttft_p99_ms;               // Time to first token, 99th percentile
+            double itl_p50_ms;                // Inter-token latency, median
+            double itl_p90_ms;                // Inter-token latency, 90th percentile
+            double itl_p99_ms;                // Inter-token latency, 99th percentile
         } text;
 
         // Image-specific metrics
@@ -76,6 +118,7 @@ typedef struct {
     int  num_iterations;    // Number of iterations to run
     int  warmup_iterations; // Number of warmup iterations
     bool measure_memory;    // Whether to measure memory usage
+    bool hw_counters;       // Whether to collect hardware counters
     bool verbose;           // Whether to print verbose output
 
     // Model options
@@ -105,12 +148,32 @@ void tinyai_benchmark_start_timer(struct timespec *start_time);
 // Function to stop benchmark timing and calculate elapsed time in ms
 double tinyai_benchmark_stop_timer(struct timespec *start_time);
 
+// Open hardware counters for this process and the threads it starts afterwards
+// (perf_event_open on Linux). While open, every start_timer/stop_timer pair also
+// counts hardware events, summed into the totals read by
+// tinyai_get_hardware_counters; each start and stop then costs a counter read.
+// Returns false where no counter can be opened.
+bool tinyai_enable_hardware_counters(void);
+
+// Close the hardware counters
+void tinyai_disable_hardware_counters(void);
+
+// Read the hardware event totals of the timed intervals since the last reset
+void tinyai_get_hardware_counters(TinyAIHardwareCounters *counters);
+
+// Clear the hardware event totals
+void tinyai_reset_hardware_counters(void);
+
 // Function to export benchmark results to CSV
 bool tinyai_export_benchmark_csv(const TinyAIBenchmarkResult *result, const char *filepath);
 
 // Function to export benchmark results to JSON
 bool tinyai_export_benchmark_json(const TinyAIBenchmarkResult *result, const char *filepath);
 
+// Function to export the results of several runs (e.g. a parameter sweep) as a JSON array
+bool tinyai_export_benchmark_json_runs(const TinyAIBenchmarkResult *results, int num_results,
+                                       const char *filepath);
+
 // Function to print benchmark results to console
 void tinyai_print_benchmark_results(const TinyAIBenchmarkResult *result);
 
@@ -122,10 +185,16 @@ void tinyai_compare_benchmark_results(const TinyAIBenchmarkResult *tinyai_result
 // Platform-specific memory measurement functions
 size_t tinyai_measure_current_memory_usage(void);
 size_t tinyai_measure_peak_memory_usage(void);
+// Restart peak memory measurement from the current usage; false where the
+// platform cannot, in which case the peak covers the whole process
+bool tinyai_reset_peak_memory_usage(void);
 
 // Function to detect and return the available SIMD capabilities
 const char *tinyai_detect_simd_capabilities(void);
 
+// Function to compute a percentile (0-100) of samples, sorting them in place
+double tinyai_percentile(double *samples, int count, double percentile);
+
 // Function to determine the optimal number of threads
 int tinyai_determine_optimal_threads(void);
 
@@ -0,0 +1,1082 @@
+// Cross-framework comparison benchmark
+//
+// Runs the same workloads (task, model, input, thread count, iterations) on
+// TinyAI and on external runtimes and prints them side by side: latency,
+// throughput and peak memory. Every runtime, TinyAI included, runs as a child
+// process speaking the driver protocol below, so all of them are measured the
+// same way: the driver reports its run times and the harness takes the peak
+// resident memory of the child from the operating system.
+//
+// Driver protocol. A runtime is a command that the harness starts as
+//   <command> -task <text|image> -model <path> -threads <n> -iterations <n>
+//             -warmup <n> -prompt_length <n> -decode <n> -input <file> -image_size <n>
+// and whose standard output holds key=value lines:
+//   version=<text>     Runtime version (optional)
+//   run_ms=<ms>        Time of one timed run; one line per iteration
+//   prefill_ms=<ms>    Text: prompt processing part of a run (optional)
+//   decode_ms=<ms>     Text: token generation part of a run (optional)
+//   error=<text>       Why the workload cannot run
+// Other lines are ignored. TinyAI's driver is this program started with
+// -driver; the drivers of ONNX Runtime, TensorFlow Lite and llama.cpp are the
+// Python scripts in drivers/. More runtimes are added, or the commands of
+// these replaced, with [runtime <name>] sections in the workload file.
+//
+// Workload file: INI sections, '#' starts a comment.
+//   [workload mobilenet-224]
+//   task = image            # text or image
+//   threads = 4
+//   iterations = 20         # Timed runs (default 10)
+//   warmup = 3              # Untimed runs first (default 2)
+//   image_size = 224        # image: input width and height (default 224)
+//   prompt_length = 128     # text: prompt tokens (default 128)
+//   decode = 32             # text: generated tokens (default 32)
+//   tinyai = builtin        # One model per runtime; runtimes without one are skipped
+//   onnxruntime = models/external/mobilenet_v2.onnx
+//
+//   [runtime mnn]
+//   command = /opt/mnn/bin/tinyai_driver
+//
+// Text inputs match in token counts only, since each runtime's model has its
+// own vocabulary; image inputs are the same pixels for every runtime. The
+// TinyAI text model is a snapshot, or "model,weights,tokenizer" paths; the
+// image model is MobileNet with the given weights file, or "builtin" for its
+// initial weights. Peak memory of the Python drivers includes the interpreter.
+
+#include "../benchmark_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <psapi.h>
+#include <windows.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// TinyAI includes
+#include "../../../models/image/image_model.h"
+#include "../../../models/image/image_utils.h"
+#include "../../../models/text/attention.h"
+#include "../../../models/text/generate.h"
+#include "../../../models/text/tokenizer.h"
+#include "../../../utils/thread_pool.h"
+
+// Version reported by the TinyAI driver
+#define TINYAI_VERSION "0.1.0"
+
+// Default configuration values
+#define DEFAULT_WORKLOADS_PATH "tools/benchmark/compare/workloads.ini"
+#define DEFAULT_DRIVERS_PATH "tools/benchmark/compare/drivers"
+#define DEFAULT_EXPORT_PATH "./benchmark_results"
+#ifdef _WIN32
+#define DEFAULT_PYTHON "python"
+#else
+#define DEFAULT_PYTHON "python3"
+#endif
+
+#define DEFAULT_ITERATIONS 10
+#define DEFAULT_WARMUP 2
+#define DEFAULT_PROMPT_LENGTH 128
+#define DEFAULT_DECODE_TOKENS 32
+#define DEFAULT_IMAGE_SIZE 224
+
+#define MAX_RUNTIMES 8
+#define MAX_WORKLOADS 32
+#define MAX_RUNS 1000
+#define MAX_DRIVER_ARGS 48
+
+typedef struct {
+    char workloads_path[256];
+    char drivers_path[256];
+    char python[64];
+    char runtimes[128]; // Comma-separated runtimes to run, or "all"
+    char filter[64];    // Only workloads whose name contains this
+    char export_path[256];
+    bool verbose;
+} CompareConfig;
+
+// A runtime and the command of its driver
+typedef struct {
+    char name[32];
+    char command[512]; // Split at spaces; empty for this program's TinyAI driver
+} Runtime;
+
+// One workload, run identically on every runtime that has a model for it
+typedef struct {
+    char name[64];
+    char task[16];
+    int  threads;
+    int  iterations;
+    int  warmup;
+    int  prompt_length;
+    int  decode_tokens;
+    int  image_size;
+    char models[MAX_RUNTIMES][256]; // Model per runtime, indexed like the runtimes
+} CompareWorkload;
+
+// What one runtime measured on one workload
+typedef struct {
+    bool   ran;    // The driver was started
+    bool   ok;     // It reported timed runs
+    char   status[128];
+    char   version[64];
+    int    runs;
+    double p50_ms;
+    double p90_ms;
+    double prefill_ms; // Median prompt part of a text run (0 when not reported)
+    double decode_ms;  // Median generation part of a text run
+    double throughput; // Units (tokens or images) per second at the median run
+    size_t peak_memory_bytes;
+} Measurement;
+
+static Runtime         runtimes[MAX_RUNTIMES];
+static int             num_runtimes;
+static CompareWorkload workloads[MAX_WORKLOADS];
+static int             num_workloads;
+
+void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -workloads <path>       Workload file (default: %s)\n", DEFAULT_WORKLOADS_PATH);
+    printf("  -drivers <path>         Directory of the Python drivers (default: %s)\n",
+           DEFAULT_DRIVERS_PATH);
+    printf("  -python <command>       Python interpreter for the drivers (default: %s)\n",
+           DEFAULT_PYTHON);
+    printf("  -runtimes <list>        Runtimes to run, e.g. tinyai,onnxruntime (default: all)\n");
+    printf("  -filter <text>          Only workloads whose name contains the text\n");
+    printf("  -export <path>          Export results path (default: %s)\n", DEFAULT_EXPORT_PATH);
+    printf("  -v                      Verbose output\n");
+    printf("  -h                      Display this help message\n");
+    printf("\n");
+    printf("Run as the TinyAI driver of the comparison:\n");
+    printf("  %s -driver -task <text|image> -model <path> -threads <n> -iterations <n>\n",
+           program_name);
+    printf("      -warmup <n> -prompt_length <n> -decode <n> -input <file> -image_size <n>\n");
+    printf("\n");
+}
+
+// Parse command line arguments and set configuration
+void parse_args(int argc, char **argv, CompareConfig *config)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-workloads") == 0 && i + 1 < argc) {
+            strncpy(config->workloads_path, argv[++i], sizeof(config->workloads_path) - 1);
+        }
+        else if (strcmp(argv[i], "-drivers") == 0 && i + 1 < argc) {
+            strncpy(config->drivers_path, argv[++i], sizeof(config->drivers_path) - 1);
+        }
+        else if (strcmp(argv[i], "-python") == 0 && i + 1 < argc) {
+            strncpy(config->python, argv[++i], sizeof(config->python) - 1);
+        }
+        else if (strcmp(argv[i], "-runtimes") == 0 && i + 1 < argc) {
+            strncpy(config->runtimes, argv[++i], sizeof(config->runtimes) - 1);
+        }
+        else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc) {
+            strncpy(config->filter, argv[++i], sizeof(config->filter) - 1);
+        }
+        else if (strcmp(argv[i], "-export") == 0 && i + 1 < argc) {
+            strncpy(config->export_path, argv[++i], sizeof(config->export_path) - 1);
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            config->verbose = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static bool runtime_selected(const CompareConfig *config, const char *name)
+{
+    if (strcmp(config->runtimes, "all") == 0) {
+        return true;
+    }
+    // Match whole entries of the comma-separated list
+    size_t      length = strlen(name);
+    const char *entry  = config->runtimes;
+    while (entry && *entry) {
+        if (strncmp(entry, name, length) == 0 && (entry[length] == ',' || !entry[length])) {
+            return true;
+        }
+        entry = strchr(entry, ',');
+        entry = entry ? entry + 1 : NULL;
+    }
+    return false;
+}
+
+static double now_ms(void)
+{
+    struct timespec now;
+    tinyai_benchmark_start_timer(&now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+// ----- TinyAI driver -----
+
+typedef struct {
+    char task[16];
+    char model[256];
+    char input[256];
+    int  threads;
+    int  iterations;
+    int  warmup;
+    int  prompt_length;
+    int  decode_tokens;
+    int  image_size;
+} DriverArgs;
+
+// Greedy choice of the next token
+static int argmax_token(const float *logits, int vocab_size)
+{
+    int best = 0;
+    for (int t = 1; t < vocab_size; t++) {
+        if (logits[t] > logits[best]) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// Load a snapshot, or the model, weights and tokenizer of a "model,weights,tokenizer" list
+static TinyAIModel *load_text_model(const char *spec)
+{
+    char        paths[3][256] = {{0}};
+    const char *part          = spec;
+    int         count         = 0;
+    while (part && count < 3) {
+        const char *comma  = strchr(part, ',');
+        size_t      length = comma ? (size_t)(comma - part) : strlen(part);
+        if (length >= sizeof(paths[0])) {
+            return NULL;
+        }
+        memcpy(paths[count++], part, length);
+        part = comma ? comma + 1 : NULL;
+    }
+    if (count == 1) {
+        return tinyaiLoadModelSnapshot(paths[0]);
+    }
+    return count == 3 ? tinyaiLoadModel(paths[0], paths[1], paths[2]) : NULL;
+}
+
+// Prefill a prompt, then decode greedily; prompt tokens are the first vocabulary ids in turn
+static int driver_text(const DriverArgs *args)
+{
+    TinyAIModel *model = load_text_model(args->model);
+    if (!model || tinyaiPrepareModel(model) != 0) {
+        printf("error=failed to load %s\n", args->model);
+        tinyaiDestroyModel(model);
+        return 1;
+    }
+    TinyAITokenizer *tokenizer = model->snapshot ? NULL : model->tokenizer;
+
+    int context = (int)model->contextSize;
+    int vocab   = (int)model->tokenizer->tokenCount;
+    if (args->prompt_length + args->decode_tokens > context) {
+        printf("error=%d prompt and %d decode tokens exceed the %d-token context\n",
+               args->prompt_length, args->decode_tokens, context);
+        tinyaiDestroyModel(model);
+        tinyaiDestroyTokenizer(tokenizer);
+        return 1;
+    }
+
+    int            total  = args->prompt_length + args->decode_tokens;
+    TinyAIKVCache *cache  = tinyaiCreateModelKVCache(model);
+    float         *logits = (float *)malloc((size_t)vocab * sizeof(float));
+    int           *tokens = (int *)malloc((size_t)total * sizeof(int));
+    bool           ok     = cache && logits && tokens;
+    for (int i = 0; ok && i < args->prompt_length; i++) {
+        tokens[i] = 1 + i % (vocab > 1 ? vocab - 1 : 1);
+    }
+
+    printf("version=%s\n", TINYAI_VERSION);
+    for (int i = 0; ok && i < args->warmup + args->iterations; i++) {
+        tinyaiResetKVCache(cache);
+        double start = now_ms();
+        ok           = tinyaiModelForwardCached(model, cache, tokens, args->prompt_length,
+                                                logits) == 0;
+        double prefilled = now_ms();
+        for (int t = 0; ok && t < args->decode_tokens; t++) {
+            int *token = &tokens[args->prompt_length + t];
+            *token     = argmax_token(logits, vocab);
+            ok         = tinyaiModelForwardCached(model, cache, token, 1, logits) == 0;
+        }
+        double end = now_ms();
+        if (ok && i >= args->warmup) {
+            printf("prefill_ms=%.4f\n", prefilled - start);
+            printf("decode_ms=%.4f\n", end - prefilled);
+            printf("run_ms=%.4f\n", end - start);
+        }
+    }
+    if (!ok) {
+        printf("error=forward pass failed\n");
+    }
+
+    tinyaiDestroyKVCache(cache);
+    free(logits);
+    free(tokens);
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    return ok ? 0 : 1;
+}
+
+// Classify the input image with MobileNet
+static int driver_image(const DriverArgs *args)
+{
+    int          size  = args->image_size;
+    TinyAIImage *image = tinyaiImageCreate(size, size, TINYAI_IMAGE_FORMAT_RGB);
+    FILE        *file  = fopen(args->input, "rb");
+    bool         ok    = image && file &&
+                fread(image->data, 1, (size_t)size * size * 3, file) == (size_t)size * size * 3;
+    if (file) {
+        fclose(file);
+    }
+    if (!ok) {
+        printf("error=failed to read %s\n", args->input);
+        tinyaiImageFree(image);
+        return 1;
+    }
+
+    bool                   builtin = strcmp(args->model, "builtin") == 0;
+    TinyAIImageModelParams params  = {.modelType       = TINYAI_IMAGE_MODEL_MOBILENET,
+                                      .inputWidth      = size,
+                                      .inputHeight     = size,
+                                      .inputChannels   = 3,
+                                      .numClasses      = 1000,
+                                      .weightsFile     = builtin ? NULL : args->model,
+                                      .labelsFile      = NULL,
+                                      .useQuantization = true,
+                                      .useSIMD         = true,
+                                      .customParams    = NULL};
+    TinyAIImageModel      *model   = tinyaiImageModelCreate(&params);
+    if (!model) {
+        printf("error=failed to create the model\n");
+        tinyaiImageFree(image);
+        return 1;
+    }
+
+    printf("version=%s\n", TINYAI_VERSION);
+    for (int i = 0; ok && i < args->warmup + args->iterations; i++) {
+        TinyAIImageClassResult results[5];
+        double                 start = now_ms();
+        ok = tinyaiImageModelClassify(model, image, 5, results) >= 0;
+        if (ok && i >= args->warmup) {
+            printf("run_ms=%.4f\n", now_ms() - start);
+        }
+    }
+    if (!ok) {
+        printf("error=classification failed\n");
+    }
+
+    tinyaiImageModelFree(model);
+    tinyaiImageFree(image);
+    return ok ? 0 : 1;
+}
+
+// Run one workload on TinyAI and report it in the driver protocol
+static int run_driver_mode(int argc, char **argv)
+{
+    DriverArgs args;
+    memset(&args, 0, sizeof(args));
+    args.threads       = 1;
+    args.iterations    = DEFAULT_ITERATIONS;
+    args.warmup        = DEFAULT_WARMUP;
+    args.prompt_length = DEFAULT_PROMPT_LENGTH;
+    args.decode_tokens = DEFAULT_DECODE_TOKENS;
+    args.image_size    = DEFAULT_IMAGE_SIZE;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "-task") == 0) {
+            strncpy(args.task, value, sizeof(args.task) - 1);
+        }
+        else if (strcmp(argv[i], "-model") == 0) {
+            strncpy(args.model, value, sizeof(args.model) - 1);
+        }
+        else if (strcmp(argv[i], "-input") == 0) {
+            strncpy(args.input, value, sizeof(args.input) - 1);
+        }
+        else if (strcmp(argv[i], "-threads") == 0) {
+            args.threads = atoi(value);
+        }
+        else if (strcmp(argv[i], "-iterations") == 0) {
+            args.iterations = atoi(value);
+        }
+        else if (strcmp(argv[i], "-warmup") == 0) {
+            args.warmup = atoi(value);
+        }
+        else if (strcmp(argv[i], "-prompt_length") == 0) {
+            args.prompt_length = atoi(value);
+        }
+        else if (strcmp(argv[i], "-decode") == 0) {
+            args.decode_tokens = atoi(value);
+        }
+        else if (strcmp(argv[i], "-image_size") == 0) {
+            args.image_size = atoi(value);
+        }
+    }
+
+    // Threads other than 1 run the kernels on their own pool
+    TinyAIThreadPool *pool = args.threads > 1 ? tinyaiCreateThreadPool(args.threads, 0) : NULL;
+    if (args.threads > 1 && !pool) {
+        printf("error=failed to create a pool of %d threads\n", args.threads);
+        return 1;
+    }
+    TinyAIThreadPoolScope scope = tinyaiUseThreadPool(pool);
+
+    int result;
+    if (strcmp(args.task, "text") == 0) {
+        result = driver_text(&args);
+    }
+    else if (strcmp(args.task, "image") == 0) {
+        result = driver_image(&args);
+    }
+    else {
+        printf("error=unsupported task '%s'\n", args.task);
+        result = 1;
+    }
+
+    tinyaiRestoreThreadPool(scope);
+    tinyaiDestroyThreadPool(pool);
+    return result;
+}
+
+// ----- Workload file -----
+
+static int find_runtime(const char *name)
+{
+    for (int r = 0; r < num_runtimes; r++) {
+        if (strcmp(runtimes[r].name, name) == 0) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+static int add_runtime(const char *name, const char *command)
+{
+    int r = find_runtime(name);
+    if (r < 0) {
+        if (num_runtimes == MAX_RUNTIMES) {
+            printf("Warning: Runtime %s ignored; at most %d runtimes\n", name, MAX_RUNTIMES);
+            return -1;
+        }
+        r = num_runtimes++;
+        memset(&runtimes[r], 0, sizeof(runtimes[r]));
+        strncpy(runtimes[r].name, name, sizeof(runtimes[r].name) - 1);
+    }
+    strncpy(runtimes[r].command, command, sizeof(runtimes[r].command) - 1);
+    return r;
+}
+
+// TinyAI and the runtimes with a driver in the drivers directory
+static void add_default_runtimes(const CompareConfig *config)
+{
+    static const char *const drivers[][2] = {
+        {"onnxruntime", "onnxruntime_driver.py"},
+        {"tflite", "tflite_driver.py"},
+        {"llama.cpp", "llamacpp_driver.py"},
+    };
+
+    add_runtime("tinyai", "");
+    for (size_t d = 0; d < sizeof(drivers) / sizeof(drivers[0]); d++) {
+        char command[512];
+        snprintf(command, sizeof(command), "%s %s/%s", config->python, config->drivers_path,
+                 drivers[d][1]);
+        add_runtime(drivers[d][0], command);
+    }
+}
+
+// Strip a comment and surrounding blanks in place
+static char *trim(char *text)
+{
+    char *comment = strchr(text, '#');
+    if (comment) {
+        *comment = '\0';
+    }
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    size_t length = strlen(text);
+    while (length > 0 && strchr(" \t\r\n", text[length - 1])) {
+        text[--length] = '\0';
+    }
+    return text;
+}
+
+static bool load_workloads(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        printf("Error: Failed to open workload file %s\n", path);
+        return false;
+    }
+
+    CompareWorkload *workload = NULL;
+    int              runtime  = -1; // Runtime section being read
+    char             buffer[1024];
+    int              line_number = 0;
+    bool             ok          = true;
+    while (ok && fgets(buffer, sizeof(buffer), file)) {
+        line_number++;
+        char *line = trim(buffer);
+        if (!*line) {
+            continue;
+        }
+
+        char name[64];
+        if (sscanf(line, "[workload %63[^]]]", name) == 1) {
+            if (num_workloads == MAX_WORKLOADS) {
+                printf("Error: More than %d workloads in %s\n", MAX_WORKLOADS, path);
+                ok = false;
+                break;
+            }
+            workload = &workloads[num_workloads++];
+            memset(workload, 0, sizeof(*workload));
+            strncpy(workload->name, trim(name), sizeof(workload->name) - 1);
+            workload->threads       = 1;
+            workload->iterations    = DEFAULT_ITERATIONS;
+            workload->warmup        = DEFAULT_WARMUP;
+            workload->prompt_length = DEFAULT_PROMPT_LENGTH;
+            workload->decode_tokens = DEFAULT_DECODE_TOKENS;
+            workload->image_size    = DEFAULT_IMAGE_SIZE;
+            runtime                 = -1;
+            continue;
+        }
+        if (sscanf(line, "[runtime %63[^]]]", name) == 1) {
+            runtime  = add_runtime(trim(name), "");
+            workload = NULL;
+            continue;
+        }
+
+        char *equals = strchr(line, '=');
+        if (!equals || (!workload && runtime < 0)) {
+            printf("Error: %s:%d: expected key = value inside a section\n", path, line_number);
+            ok = false;
+            break;
+        }
+        *equals           = '\0';
+        const char *key   = trim(line);
+        const char *value = trim(equals + 1);
+
+        if (!workload) {
+            if (strcmp(key, "command") == 0) {
+                strncpy(runtimes[runtime].command, value, sizeof(runtimes[runtime].command) - 1);
+            }
+            else {
+                printf("Error: %s:%d: unknown runtime key '%s'\n", path, line_number, key);
+                ok = false;
+            }
+        }
+        else if (strcmp(key, "task") == 0) {
+            strncpy(workload->task, value, sizeof(workload->task) - 1);
+        }
+        else if (strcmp(key, "threads") == 0) {
+            workload->threads = atoi(value);
+        }
+        else if (strcmp(key, "iterations") == 0) {
+            workload->iterations = atoi(value);
+        }
+        else if (strcmp(key, "warmup") == 0) {
+            workload->warmup = atoi(value);
+        }
+        else if (strcmp(key, "prompt_length") == 0) {
+            workload->prompt_length = atoi(value);
+        }
+        else if (strcmp(key, "decode") == 0) {
+            workload->decode_tokens = atoi(value);
+        }
+        else if (strcmp(key, "image_size") == 0) {
+            workload->image_size = atoi(value);
+        }
+        else {
+            // Any other key names a runtime and its model for this workload
+            int r = find_runtime(key);
+            if (r < 0) {
+                printf("Error: %s:%d: unknown key or runtime '%s'\n", path, line_number, key);
+                ok = false;
+            }
+            else {
+                strncpy(workload->models[r], value, sizeof(workload->models[r]) - 1);
+            }
+        }
+    }
+    fclose(file);
+
+    for (int w = 0; ok && w < num_workloads; w++) {
+        CompareWorkload *check = &workloads[w];
+        if (strcmp(check->task, "text") != 0 && strcmp(check->task, "image") != 0) {
+            printf("Error: Workload %s: task must be text or image\n", check->name);
+            ok = false;
+        }
+        if (check->threads < 1 || check->iterations < 1 || check->iterations > MAX_RUNS ||
+            check->warmup < 0 || check->prompt_length < 1 || check->decode_tokens < 0 ||
+            check->image_size < 1) {
+            printf("Error: Workload %s: settings out of range\n", check->name);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// ----- Driver processes -----
+
+// Run a driver with its standard output sent to output_path; false when it cannot be
+// started. exit_code and the peak resident memory of the process tree are set otherwise.
+static bool run_process(char *const *argv, const char *output_path, int *exit_code,
+                        size_t *peak_memory)
+{
+#ifdef _WIN32
+    char   command_line[4096];
+    size_t used = 0;
+    for (int i = 0; argv[i]; i++) {
+        int written = snprintf(command_line + used, sizeof(command_line) - used, "%s\"%s\"",
+                               i ? " " : "", argv[i]);
+        if (written < 0 || (size_t)written >= sizeof(command_line) - used) {
+            return false;
+        }
+        used += (size_t)written;
+    }
+
+    SECURITY_ATTRIBUTES inherit = {sizeof(inherit), NULL, TRUE};
+    HANDLE output = CreateFileA(output_path, GENERIC_WRITE, FILE_SHARE_READ, &inherit,
+                                CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (output == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    STARTUPINFOA        startup;
+    PROCESS_INFORMATION process;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb         = sizeof(startup);
+    startup.dwFlags    = STARTF_USESTDHANDLES;
+    startup.hStdOutput = output;
+    startup.hStdError  = GetStdHandle(STD_ERROR_HANDLE);
+    startup.hStdInput  = GetStdHandle(STD_INPUT_HANDLE);
+    BOOL started = CreateProcessA(NULL, command_line, NULL, NULL, TRUE, 0, NULL, NULL, &startup,
+                                  &process);
+    CloseHandle(output);
+    if (!started) {
+        return false;
+    }
+
+    WaitForSingleObject(process.hProcess, INFINITE);
+    DWORD                   code = 1;
+    PROCESS_MEMORY_COUNTERS counters;
+    GetExitCodeProcess(process.hProcess, &code);
+    *exit_code   = (int)code;
+    *peak_memory = GetProcessMemoryInfo(process.hProcess, &counters, sizeof(counters))
+                       ? counters.PeakWorkingSetSize
+                       : 0;
+    CloseHandle(process.hThread);
+    CloseHandle(process.hProcess);
+    return true;
+#else
+    int output = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output < 0) {
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(output, STDOUT_FILENO);
+        close(output);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(output);
+    if (pid < 0) {
+        return false;
+    }
+
+    // The usage of a waited-for child covers the children it waited for itself
+    int           status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        return false;
+    }
+    *exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128;
+#if defined(__APPLE__)
+    *peak_memory = (size_t)usage.ru_maxrss; // Bytes on macOS
+#else
+    *peak_memory = (size_t)usage.ru_maxrss * 1024; // Kilobytes elsewhere
+#endif
+    return *exit_code != 127;
+#endif
+}
+
+// Read the driver protocol lines of a finished driver
+static void parse_driver_output(const char *output_path, const CompareWorkload *workload,
+                                Measurement *measurement)
+{
+    FILE *file = fopen(output_path, "r");
+    if (!file) {
+        snprintf(measurement->status, sizeof(measurement->status), "no driver output");
+        return;
+    }
+
+    static double run_ms[MAX_RUNS], prefill_ms[MAX_RUNS], decode_ms[MAX_RUNS];
+    int           runs = 0, prefills = 0, decodes = 0;
+    char          line[512];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strncmp(line, "run_ms=", 7) == 0 && runs < MAX_RUNS) {
+            run_ms[runs++] = atof(line + 7);
+        }
+        else if (strncmp(line, "prefill_ms=", 11) == 0 && prefills < MAX_RUNS) {
+            prefill_ms[prefills++] = atof(line + 11);
+        }
+        else if (strncmp(line, "decode_ms=", 10) == 0 && decodes < MAX_RUNS) {
+            decode_ms[decodes++] = atof(line + 10);
+        }
+        else if (strncmp(line, "version=", 8) == 0) {
+            strncpy(measurement->version, line + 8, sizeof(measurement->version) - 1);
+        }
+        else if (strncmp(line, "error=", 6) == 0) {
+            strncpy(measurement->status, line + 6, sizeof(measurement->status) - 1);
+        }
+    }
+    fclose(file);
+
+    if (runs == 0) {
+        if (!measurement->status[0]) {
+            snprintf(measurement->status, sizeof(measurement->status), "no timed runs reported");
+        }
+        return;
+    }
+
+    measurement->ok         = true;
+    measurement->runs       = runs;
+    measurement->p50_ms     = tinyai_percentile(run_ms, runs, 50.0);
+    measurement->p90_ms     = tinyai_percentile(run_ms, runs, 90.0);
+    measurement->prefill_ms = prefills ? tinyai_percentile(prefill_ms, prefills, 50.0) : 0.0;
+    measurement->decode_ms  = decodes ? tinyai_percentile(decode_ms, decodes, 50.0) : 0.0;
+
+    double units = strcmp(workload->task, "text") == 0
+                       ? (double)workload->prompt_length + workload->decode_tokens
+                       : 1.0;
+    measurement->throughput = measurement->p50_ms > 0.0 ? units * 1000.0 / measurement->p50_ms
+                                                        : 0.0;
+    if (!measurement->status[0]) {
+        snprintf(measurement->status, sizeof(measurement->status), "ok");
+    }
+}
+
+// Run one workload on one runtime
+static void measure(const char *self, const Runtime *runtime, const CompareWorkload *workload,
+                    const char *model, const char *input_path, const char *output_path,
+                    Measurement *measurement)
+{
+    char  command[512];
+    char *argv[MAX_DRIVER_ARGS];
+    int   argc = 0;
+
+    strncpy(command, runtime->command, sizeof(command) - 1);
+    command[sizeof(command) - 1] = '\0';
+    if (!command[0]) {
+        argv[argc++] = (char *)self;
+        argv[argc++] = "-driver";
+    }
+    for (char *part = strtok(command, " "); part && argc < MAX_DRIVER_ARGS - 21;
+         part       = strtok(NULL, " ")) {
+        argv[argc++] = part;
+    }
+
+    char threads[16], iterations[16], warmup[16], prompt_length[16], decode[16], size[16];
+    snprintf(threads, sizeof(threads), "%d", workload->threads);
+    snprintf(iterations, sizeof(iterations), "%d", workload->iterations);
+    snprintf(warmup, sizeof(warmup), "%d", workload->warmup);
+    snprintf(prompt_length, sizeof(prompt_length), "%d", workload->prompt_length);
+    snprintf(decode, sizeof(decode), "%d", workload->decode_tokens);
+    snprintf(size, sizeof(size), "%d", workload->image_size);
+
+    char *const options[][2] = {
+        {"-task", (char *)workload->task},
+        {"-model", (char *)model},
+        {"-threads", threads},
+        {"-iterations", iterations},
+        {"-warmup", warmup},
+        {"-prompt_length", prompt_length},
+        {"-decode", decode},
+        {"-input", (char *)input_path},
+        {"-image_size", size},
+    };
+    for (size_t o = 0; o < sizeof(options) / sizeof(options[0]); o++) {
+        argv[argc++] = options[o][0];
+        argv[argc++] = options[o][1];
+    }
+    argv[argc] = NULL;
+
+    memset(measurement, 0, sizeof(*measurement));
+    int exit_code = 0;
+    if (!run_process(argv, output_path, &exit_code, &measurement->peak_memory_bytes)) {
+        snprintf(measurement->status, sizeof(measurement->status), "failed to start %s",
+                 argv[0]);
+        return;
+    }
+    measurement->ran = true;
+    parse_driver_output(output_path, workload, measurement);
+    if (measurement->ok && exit_code != 0) {
+        measurement->ok = false;
+        snprintf(measurement->status, sizeof(measurement->status), "driver exited with %d",
+                 exit_code);
+    }
+}
+
+// Input image shared by every runtime: a smooth RGB gradient, rows top to bottom
+static bool write_image_input(const char *path, int size)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = true;
+    for (int y = 0; ok && y < size; y++) {
+        for (int x = 0; ok && x < size; x++) {
+            unsigned char pixel[3] = {(unsigned char)(x * 255 / size),
+                                      (unsigned char)(y * 255 / size),
+                                      (unsigned char)((x + y) * 255 / (2 * size))};
+            ok                     = fwrite(pixel, 1, 3, file) == 3;
+        }
+    }
+    return fclose(file) == 0 && ok;
+}
+
+// ----- Report -----
+
+static void print_workload(const CompareWorkload *workload, const Measurement *measurements)
+{
+    bool        text = strcmp(workload->task, "text") == 0;
+    const char *unit = text ? "tok/s" : "img/s";
+
+    printf("\n== %s (%s, %d threads, %d runs", workload->name, workload->task, workload->threads,
+           workload->iterations);
+    if (text) {
+        printf(", %d prompt + %d decode tokens", workload->prompt_length, workload->decode_tokens);
+    }
+    else {
+        printf(", %dx%d input", workload->image_size, workload->image_size);
+    }
+    printf(") ==\n");
+    printf("%-12s %-14s %10s %10s %16s %12s %8s\n", "Runtime", "Version", "p50 (ms)", "p90 (ms)",
+           "Throughput", "Peak (MB)", "Speed");
+    printf("--------------------------------------------"
+           "--------------------------------------------\n");
+
+    int           tinyai = find_runtime("tinyai");
+    const double *base   = tinyai >= 0 && measurements[tinyai].ok ? &measurements[tinyai].p50_ms
+                                                                   : NULL;
+    int           fastest = -1, smallest = -1;
+    for (int r = 0; r < num_runtimes; r++) {
+        const Measurement *m = &measurements[r];
+        if (!workload->models[r][0]) {
+            continue;
+        }
+        if (!m->ok) {
+            printf("%-12s %-14s %s\n", runtimes[r].name, m->version[0] ? m->version : "-",
+                   m->status[0] ? m->status : "not run");
+            continue;
+        }
+        char throughput[32], speed[16];
+        snprintf(throughput, sizeof(throughput), "%.1f %s", m->throughput, unit);
+        snprintf(speed, sizeof(speed), base ? "%.2fx" : "-", base ? *base / m->p50_ms : 0.0);
+        printf("%-12s %-14s %10.2f %10.2f %16s %12.1f %8s\n", runtimes[r].name,
+               m->version[0] ? m->version : "-", m->p50_ms, m->p90_ms, throughput,
+               m->peak_memory_bytes / (1024.0 * 1024.0), speed);
+        if (text && m->prefill_ms > 0.0 && m->decode_ms > 0.0) {
+            printf("%-12s   prefill %.1f tok/s, decode %.1f tok/s\n", "",
+                   workload->prompt_length * 1000.0 / m->prefill_ms,
+                   workload->decode_tokens * 1000.0 / m->decode_ms);
+        }
+        if (fastest < 0 || m->p50_ms < measurements[fastest].p50_ms) {
+            fastest = r;
+        }
+        if (smallest < 0 || m->peak_memory_bytes < measurements[smallest].peak_memory_bytes) {
+            smallest = r;
+        }
+    }
+    if (fastest >= 0) {
+        printf("Fastest: %s; smallest peak memory: %s\n", runtimes[fastest].name,
+               runtimes[smallest].name);
+    }
+    printf("Speed is TinyAI's median latency over the runtime's (above 1 = faster than TinyAI)\n");
+}
+
+// One result per runtime and workload, in the shared benchmark result format
+static void fill_result(const CompareWorkload *workload, const Runtime *runtime,
+                        const Measurement *m, TinyAIBenchmarkResult *result)
+{
+    tinyai_init_benchmark_result(result);
+    strncpy(result->framework_name, runtime->name, sizeof(result->framework_name) - 1);
+    strncpy(result->framework_version, m->version, sizeof(result->framework_version) - 1);
+    strncpy(result->model_name, workload->name, sizeof(result->model_name) - 1);
+    strncpy(result->simd_type, tinyai_detect_simd_capabilities(), sizeof(result->simd_type) - 1);
+    result->threads_used          = workload->threads;
+    result->avg_inference_time_ms = m->p50_ms;
+    result->total_time_ms         = m->p50_ms * m->runs;
+    result->peak_memory_bytes     = m->peak_memory_bytes;
+    result->samples_processed     = m->runs;
+    result->samples_per_second    = m->p50_ms > 0.0 ? 1000.0 / m->p50_ms : 0.0;
+
+    if (strcmp(workload->task, "text") == 0) {
+        result->modality                                = TINYAI_BENCHMARK_TEXT;
+        result->modality_metrics.text.prompt_tokens     = workload->prompt_length;
+        result->modality_metrics.text.batch_size        = 1;
+        result->modality_metrics.text.tokens_per_second = m->throughput;
+        result->modality_metrics.text.prefill_tokens_per_second =
+            m->prefill_ms > 0.0 ? workload->prompt_length * 1000.0 / m->prefill_ms : 0.0;
+        result->modality_metrics.text.decode_tokens_per_second =
+            m->decode_ms > 0.0 ? workload->decode_tokens * 1000.0 / m->decode_ms : 0.0;
+    }
+    else {
+        result->modality                           = TINYAI_BENCHMARK_IMAGE;
+        result->modality_metrics.image.image_width  = workload->image_size;
+        result->modality_metrics.image.image_height = workload->image_size;
+        result->modality_metrics.image.fps          = m->throughput;
+    }
+}
+
+static bool export_csv(const char *path, const Measurement (*measurements)[MAX_RUNTIMES])
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "Workload,Task,Threads,Runtime,Version,Status,p50 (ms),p90 (ms),Throughput,"
+                  "Unit,Peak Memory (bytes)\n");
+    for (int w = 0; w < num_workloads; w++) {
+        const CompareWorkload *workload = &workloads[w];
+        for (int r = 0; r < num_runtimes; r++) {
+            const Measurement *m = &measurements[w][r];
+            if (!m->ran) {
+                continue;
+            }
+            fprintf(file, "%s,%s,%d,%s,%s,\"%s\",%.4f,%.4f,%.2f,%s,%zu\n", workload->name,
+                    workload->task, workload->threads, runtimes[r].name, m->version, m->status,
+                    m->p50_ms, m->p90_ms, m->throughput,
+                    strcmp(workload->task, "text") == 0 ? "tokens/s" : "images/s",
+                    m->peak_memory_bytes);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "-driver") == 0) {
+        return run_driver_mode(argc, argv);
+    }
+
+    CompareConfig config;
+    memset(&config, 0, sizeof(config));
+    strncpy(config.workloads_path, DEFAULT_WORKLOADS_PATH, sizeof(config.workloads_path) - 1);
+    strncpy(config.drivers_path, DEFAULT_DRIVERS_PATH, sizeof(config.drivers_path) - 1);
+    strncpy(config.python, DEFAULT_PYTHON, sizeof(config.python) - 1);
+    strncpy(config.runtimes, "all", sizeof(config.runtimes) - 1);
+    strncpy(config.export_path, DEFAULT_EXPORT_PATH, sizeof(config.export_path) - 1);
+
+    parse_args(argc, argv, &config);
+
+    add_default_runtimes(&config);
+    if (!load_workloads(config.workloads_path)) {
+        return 1;
+    }
+
+    // Ensure the export directory exists
+    mkdir(config.export_path, 0755);
+
+    printf("\n===== TinyAI Cross-Framework Comparison =====\n");
+    printf("Workloads: %s (%d)\n", config.workloads_path, num_workloads);
+    printf("Runtimes: %s\n", config.runtimes);
+    printf("SIMD: %s\n", tinyai_detect_simd_capabilities());
+    printf("Export Path: %s\n", config.export_path);
+    printf("=============================================\n");
+
+    static Measurement    measurements[MAX_WORKLOADS][MAX_RUNTIMES];
+    TinyAIBenchmarkResult results[MAX_WORKLOADS * MAX_RUNTIMES];
+    int                   count = 0;
+
+    char output_path[512];
+    snprintf(output_path, sizeof(output_path), "%s/compare_driver_output.txt",
+             config.export_path);
+
+    for (int w = 0; w < num_workloads; w++) {
+        const CompareWorkload *workload = &workloads[w];
+        if (config.filter[0] && !strstr(workload->name, config.filter)) {
+            continue;
+        }
+
+        char input_path[512] = "-";
+        if (strcmp(workload->task, "image") == 0) {
+            snprintf(input_path, sizeof(input_path), "%s/compare_input_%d.rgb", config.export_path,
+                     workload->image_size);
+            if (!write_image_input(input_path, workload->image_size)) {
+                printf("Error: Failed to write the input image %s\n", input_path);
+                continue;
+            }
+        }
+
+        for (int r = 0; r < num_runtimes; r++) {
+            if (!workload->models[r][0] || !runtime_selected(&config, runtimes[r].name)) {
+                continue;
+            }
+            if (config.verbose) {
+                printf("Running %s on %s...\n", workload->name, runtimes[r].name);
+            }
+            double start = now_ms();
+            measure(argv[0], &runtimes[r], workload, workload->models[r], input_path, output_path,
+                    &measurements[w][r]);
+            if (config.verbose) {
+                printf("  %s in %.1f s\n", measurements[w][r].status, (now_ms() - start) / 1000.0);
+            }
+            if (measurements[w][r].ok) {
+                fill_result(workload, &runtimes[r], &measurements[w][r], &results[count++]);
+            }
+        }
+        print_workload(workload, measurements[w]);
+    }
+    remove(output_path);
+
+    if (count == 0) {
+        printf("\nError: No runtime completed a workload\n");
+        return 1;
+    }
+
+    // Export results
+    char csv_name[256], json_name[256];
+    char csv_path[1024], json_path[1024];
+    tinyai_create_timestamped_filename(csv_name, sizeof(csv_name), "tinyai_compare", "csv");
+    tinyai_create_timestamped_filename(json_name, sizeof(json_name), "tinyai_compare", "json");
+    snprintf(csv_path, sizeof(csv_path), "%s/%s", config.export_path, csv_name);
+    snprintf(json_path, sizeof(json_path), "%s/%s", config.export_path, json_name);
+
+    printf("\nExporting results...\n");
+    if (export_csv(csv_path, (const Measurement(*)[MAX_RUNTIMES])measurements)) {
+        printf("CSV results exported to: %s\n", csv_path);
+    }
+    else {
+        printf("Failed to export CSV results\n");
+    }
+    if (tinyai_export_benchmark_json_runs(results, count, json_path)) {
+        printf("JSON results exported to: %s\n", json_path);
+    }
+    else {
+        printf("Failed to export JSON results\n");
+    }
+
+    printf("\nComparison complete.\n");
+    return 0;
+}
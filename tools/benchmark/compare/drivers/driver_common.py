@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Shared parts of the comparison drivers
+
+A driver runs one workload of tinyai_compare_bench on one runtime and reports
+it on standard output as key=value lines (see compare_benchmark.c):
+version=, run_ms= (one per timed run), prefill_ms=, decode_ms= and error=.
+"""
+
+import argparse
+import sys
+import time
+from typing import List, Optional
+
+
+def parse_args(description: str) -> argparse.Namespace:
+    """Parse the arguments the harness passes to every driver."""
+    parser = argparse.ArgumentParser(description=description)
+    parser.add_argument('-task', required=True, choices=['text', 'image'])
+    parser.add_argument('-model', required=True)
+    parser.add_argument('-threads', type=int, default=1)
+    parser.add_argument('-iterations', type=int, default=10)
+    parser.add_argument('-warmup', type=int, default=2)
+    parser.add_argument('-prompt_length', type=int, default=128)
+    parser.add_argument('-decode', type=int, default=32)
+    parser.add_argument('-input', default='-')
+    parser.add_argument('-image_size', type=int, default=224)
+    return parser.parse_args()
+
+
+def report(key: str, value) -> None:
+    """Write one protocol line."""
+    print(f"{key}={value}", flush=True)
+
+
+def fail(message: str) -> None:
+    """Report why the workload cannot run and exit."""
+    report('error', message)
+    sys.exit(1)
+
+
+def read_image(path: str, size: int):
+    """Read the harness's input image as a size x size x 3 uint8 array."""
+    import numpy as np
+    pixels = np.fromfile(path, dtype=np.uint8)
+    if pixels.size != size * size * 3:
+        fail(f"{path} holds {pixels.size} bytes, expected {size * size * 3}")
+    return pixels.reshape(size, size, 3)
+
+
+def image_tensor(pixels, shape: List[Optional[int]], dtype):
+    """
+    Lay the input image out for a model input.
+
+    Args:
+        pixels: size x size x 3 uint8 image
+        shape: Model input shape; unknown dimensions may be None or names
+        dtype: NumPy type of the input; floats get pixels scaled to [0, 1],
+               int8 gets them centred on 0
+
+    Returns:
+        Batch-of-one tensor in NCHW layout when the second dimension is 3,
+        NHWC otherwise
+    """
+    import numpy as np
+    tensor = pixels.astype(np.float32) / 255.0 if np.issubdtype(dtype, np.floating) else pixels
+    if np.dtype(dtype) == np.int8:
+        tensor = (pixels.astype(np.int16) - 128).astype(np.int8)
+    if len(shape) == 4 and shape[1] == 3:
+        tensor = tensor.transpose(2, 0, 1)
+    return np.ascontiguousarray(tensor[np.newaxis].astype(dtype))
+
+
+def time_runs(run, warmup: int, iterations: int) -> None:
+    """Run untimed warmup runs, then report the time of each timed run."""
+    for _ in range(warmup):
+        run()
+    for _ in range(iterations):
+        start = time.perf_counter()
+        run()
+        report('run_ms', f"{(time.perf_counter() - start) * 1000.0:.4f}")
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""
+llama.cpp driver for tinyai_compare_bench
+
+Runs text workloads with llama-bench (LLAMA_BENCH names the binary when it is
+not on the PATH): a prompt-processing test of prompt_length tokens and a
+generation test of decode tokens, each repeated iterations times on the
+workload's thread count. llama-bench warms up on its own, so the warmup count
+is not passed on. Its generation test starts from an empty context rather
+than after the prompt, so decode times are slightly optimistic for long
+prompts. Each reported run is one prompt sample plus one generation sample.
+"""
+
+import json
+import os
+import subprocess
+
+import driver_common as common
+
+
+def samples_ms(test: dict, iterations: int):
+    """Per-repetition times of a llama-bench test, in milliseconds."""
+    samples = test.get('samples_ns') or [test['avg_ns']] * iterations
+    return [ns / 1e6 for ns in samples]
+
+
+def main() -> None:
+    args = common.parse_args('Run a tinyai_compare_bench workload on llama.cpp')
+    if args.task != 'text':
+        common.fail('only text workloads are supported by this driver')
+
+    binary = os.environ.get('LLAMA_BENCH', 'llama-bench')
+    command = [binary, '-m', args.model, '-p', str(args.prompt_length), '-n', str(args.decode),
+               '-t', str(args.threads), '-r', str(args.iterations), '-o', 'json']
+    try:
+        completed = subprocess.run(command, stdout=subprocess.PIPE, check=True)
+        tests = json.loads(completed.stdout)
+    except FileNotFoundError:
+        common.fail(f"{binary} not found; set LLAMA_BENCH")
+    except (subprocess.CalledProcessError, ValueError) as error:
+        common.fail(f"llama-bench failed: {error}")
+
+    prefill = next((t for t in tests if t.get('n_prompt', 0) > 0 and t.get('n_gen', 0) == 0),
+                   None)
+    decode = next((t for t in tests if t.get('n_gen', 0) > 0 and t.get('n_prompt', 0) == 0),
+                  None)
+    if prefill is None or (decode is None and args.decode > 0):
+        common.fail('llama-bench reported no prompt or generation test')
+
+    prefill_ms = samples_ms(prefill, args.iterations)
+    decode_ms = samples_ms(decode, args.iterations) if decode else [0.0] * len(prefill_ms)
+    common.report('version', prefill.get('build_commit', 'unknown'))
+    for p, d in zip(prefill_ms, decode_ms):
+        common.report('prefill_ms', f"{p:.4f}")
+        common.report('decode_ms', f"{d:.4f}")
+        common.report('run_ms', f"{p + d:.4f}")
+
+
+if __name__ == '__main__':
+    main()
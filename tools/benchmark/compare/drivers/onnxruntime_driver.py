@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""
+ONNX Runtime driver for tinyai_compare_bench
+
+Runs image workloads on the CPU execution provider with intra-op threads set
+to the workload's thread count and sequential execution, matching a single
+TinyAI thread pool. Text generation needs a model-specific KV-cache loop and
+is reported as unsupported.
+"""
+
+import driver_common as common
+
+
+def main() -> None:
+    args = common.parse_args('Run a tinyai_compare_bench workload on ONNX Runtime')
+    try:
+        import numpy as np
+        import onnxruntime as ort
+    except ImportError as error:
+        common.fail(f"onnxruntime is not installed ({error})")
+    if args.task != 'image':
+        common.fail('text generation is not supported by this driver')
+
+    options = ort.SessionOptions()
+    options.intra_op_num_threads = args.threads
+    options.inter_op_num_threads = 1
+    options.execution_mode = ort.ExecutionMode.ORT_SEQUENTIAL
+    try:
+        session = ort.InferenceSession(args.model, options, providers=['CPUExecutionProvider'])
+    except Exception as error:
+        common.fail(f"failed to load {args.model}: {error}")
+
+    model_input = session.get_inputs()[0]
+    dtypes = {'tensor(float)': np.float32, 'tensor(float16)': np.float16,
+              'tensor(uint8)': np.uint8, 'tensor(int8)': np.int8}
+    if model_input.type not in dtypes:
+        common.fail(f"unsupported input type {model_input.type}")
+    pixels = common.read_image(args.input, args.image_size)
+    feed = {model_input.name: common.image_tensor(pixels, model_input.shape,
+                                                  dtypes[model_input.type])}
+
+    common.report('version', ort.__version__)
+    common.time_runs(lambda: session.run(None, feed), args.warmup, args.iterations)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+"""
+TensorFlow Lite driver for tinyai_compare_bench
+
+Runs image workloads with the interpreter's thread count set to the
+workload's. Uses tflite_runtime when installed, TensorFlow otherwise.
+Quantized models take the pixels as they are (uint8) or centred on 0 (int8).
+"""
+
+import driver_common as common
+
+
+def load_interpreter(model: str, threads: int):
+    """Create an interpreter from tflite_runtime, or from TensorFlow without it."""
+    try:
+        from tflite_runtime.interpreter import Interpreter
+        import tflite_runtime
+        version = getattr(tflite_runtime, '__version__', 'tflite_runtime')
+    except ImportError:
+        try:
+            import tensorflow as tf
+        except ImportError:
+            common.fail('neither tflite_runtime nor tensorflow is installed')
+        Interpreter = tf.lite.Interpreter
+        version = tf.__version__
+    try:
+        return Interpreter(model_path=model, num_threads=threads), version
+    except Exception as error:
+        common.fail(f"failed to load {model}: {error}")
+
+
+def main() -> None:
+    args = common.parse_args('Run a tinyai_compare_bench workload on TensorFlow Lite')
+    if args.task != 'image':
+        common.fail('text generation is not supported by this driver')
+
+    interpreter, version = load_interpreter(args.model, args.threads)
+    details = interpreter.get_input_details()[0]
+    shape = [int(d) for d in details['shape']]
+    if len(shape) == 4 and shape[1] != 3 and (shape[1], shape[2]) != (args.image_size,) * 2:
+        interpreter.resize_tensor_input(details['index'], [1, args.image_size,
+                                                           args.image_size, shape[3]])
+        shape = [1, args.image_size, args.image_size, shape[3]]
+    interpreter.allocate_tensors()
+
+    pixels = common.read_image(args.input, args.image_size)
+    interpreter.set_tensor(details['index'], common.image_tensor(pixels, shape, details['dtype']))
+
+    common.report('version', version)
+    common.time_runs(interpreter.invoke, args.warmup, args.iterations)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,638 @@
+// Kernel microbenchmarks with regression gating
+//
+// Times a fixed set of kernel shapes and compares them with the checked-in
+// baseline of the CPU family, failing when a kernel slowed down by more than
+// the tolerance. Each time is divided by a calibration loop timed in the same
+// run, so baselines carry over between machines of one family that differ in
+// clock speed. Kernels run on a one-thread pool so results do not depend on
+// the core count.
+//
+// Exit status: 0 when every kernel is within tolerance, 1 on a regression or
+// error, 77 (skipped, for CTest) when the CPU family has no baseline yet.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// TinyAI includes
+#include "../../../models/audio/audio_features.h"
+#include "../../../models/text/attention.h"
+#include "../../../utils/simd_ops.h"
+#include "../../../utils/sparse_ops.h"
+#include "../../../utils/thread_pool.h"
+#include "../../../utils/trace.h"
+
+// Default configuration values
+#define DEFAULT_BASELINE_DIR "tools/benchmark/kernels/baselines"
+#define DEFAULT_TOLERANCE 25.0
+#define DEFAULT_SAMPLES 7
+#define MIN_SAMPLE_NS 2000000.0 // Each sample repeats a kernel for at least this long
+#define CALIBRATION_STEPS (1 << 20)
+#define EXIT_SKIPPED 77
+#define MAX_KERNELS 32
+
+typedef struct {
+    char   baseline_dir[256];
+    char   output_path[256]; // Also write this run's results here when set
+    char   filter[64];       // Run only kernels whose name contains this
+    double tolerance;        // Slowdown in percent that fails a kernel
+    int    samples;          // Timed samples per kernel; the fastest is kept
+    bool   update;           // Write the results as the family's baseline instead of gating
+    bool   verbose;
+} KernelBenchmarkConfig;
+
+// Operands of one kernel case, released by release_data
+typedef struct {
+    float   *in;
+    float   *out;
+    float   *aux[3];
+    uint8_t *weights;
+    float   *scales;
+    void    *plan; // Prepared form, freed by the case
+} KernelData;
+
+typedef struct {
+    const char *name;
+    int         shape[4];
+    bool (*setup)(KernelData *data, const int *shape);
+    void (*run)(KernelData *data, const int *shape);
+    void (*free_plan)(void *plan);
+} KernelCase;
+
+// Timing of one kernel, and its baseline when there is one
+typedef struct {
+    char   name[64];
+    double ns;       // Fastest time per call
+    double relative; // ns divided by the calibration time
+    double baseline_relative;
+    bool   has_baseline;
+} KernelTiming;
+
+static uint32_t g_seed = 12345u;
+
+static float random_float(void)
+{
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return (float)(g_seed >> 8) / 16777216.0f * 2.0f - 1.0f;
+}
+
+static float *random_floats(size_t count)
+{
+    float *values = (float *)malloc(count * sizeof(float));
+    if (values) {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = random_float();
+        }
+    }
+    return values;
+}
+
+static uint8_t *random_nibbles(size_t count)
+{
+    size_t   bytes  = (count + 1) / 2;
+    uint8_t *values = (uint8_t *)malloc(bytes);
+    if (values) {
+        for (size_t i = 0; i < bytes; i++) {
+            g_seed    = g_seed * 1664525u + 1013904223u;
+            values[i] = (uint8_t)(g_seed >> 24);
+        }
+    }
+    return values;
+}
+
+static float *scale_factors(int count)
+{
+    float *scales = (float *)malloc((size_t)count * sizeof(float));
+    if (scales) {
+        for (int i = 0; i < count; i++) {
+            scales[i] = 0.01f + 0.001f * (float)(i % 7);
+        }
+    }
+    return scales;
+}
+
+// ----- Kernel cases -----
+
+// 4-bit GEMV: shape = {rows, cols}
+static bool setup_gemv4(KernelData *data, const int *shape)
+{
+    data->in      = random_floats((size_t)shape[0]);
+    data->out     = (float *)malloc((size_t)shape[1] * sizeof(float));
+    data->weights = random_nibbles((size_t)shape[0] * shape[1]);
+    return data->in && data->out && data->weights;
+}
+
+static void run_gemv4(KernelData *data, const int *shape)
+{
+    tinyaiSimdVecMatMul4BitAffine(data->out, data->weights, data->in, shape[0], shape[1], 0.01f,
+                                  -0.08f);
+}
+
+// 4-bit GEMM: shape = {rowsA, colsA, colsB}
+static bool setup_gemm4(KernelData *data, const int *shape)
+{
+    data->in      = random_floats((size_t)shape[1] * shape[2]);
+    data->out     = (float *)malloc((size_t)shape[0] * shape[2] * sizeof(float));
+    data->weights = random_nibbles((size_t)shape[0] * (shape[1] + 1));
+    data->scales  = scale_factors(shape[0]);
+    return data->in && data->out && data->weights && data->scales;
+}
+
+static void run_gemm4(KernelData *data, const int *shape)
+{
+    tinyaiSimdMatMul4BitMM(data->out, data->weights, data->in, shape[0], shape[1], shape[2],
+                           data->scales);
+}
+
+// 3x3 convolution, padded to the same size: shape = {size, inChannels, outChannels}
+static bool setup_conv(KernelData *data, const int *shape)
+{
+    int size      = shape[0];
+    data->in      = random_floats((size_t)size * size * shape[1]);
+    data->out     = (float *)malloc((size_t)size * size * shape[2] * sizeof(float));
+    data->weights = random_nibbles((size_t)9 * shape[1] * shape[2]);
+    data->scales  = scale_factors(shape[2]);
+    if (!data->in || !data->out || !data->weights || !data->scales) {
+        return false;
+    }
+    data->plan = tinyaiSimdCreateConvPlan(data->weights, data->scales, size, size, shape[1], size,
+                                          size, shape[2], 3, 1, 1, TINYAI_SIMD_CONV_AUTO);
+    return data->plan != NULL;
+}
+
+static void run_conv(KernelData *data, const int *shape)
+{
+    (void)shape;
+    tinyaiSimdRunConvPlan((const TinyAIConvPlan *)data->plan, data->out, data->in, NULL);
+}
+
+static void free_conv_plan(void *plan)
+{
+    tinyaiSimdDestroyConvPlan((TinyAIConvPlan *)plan);
+}
+
+// 3x3 depthwise convolution, padded to the same size: shape = {size, channels}
+static bool setup_depthwise(KernelData *data, const int *shape)
+{
+    int size      = shape[0];
+    data->in      = random_floats((size_t)size * size * shape[1]);
+    data->out     = (float *)malloc((size_t)size * size * shape[1] * sizeof(float));
+    data->weights = random_nibbles((size_t)9 * shape[1]);
+    data->scales  = scale_factors(shape[1]);
+    data->aux[0]  = random_floats((size_t)shape[1]);
+    return data->in && data->out && data->weights && data->scales && data->aux[0];
+}
+
+static void run_depthwise(KernelData *data, const int *shape)
+{
+    tinyaiSimdDepthwiseConv2d4Bit(data->out, data->in, data->weights, data->aux[0], data->scales,
+                                  shape[0], shape[0], shape[1], shape[0], shape[0], 1, 3, 1, 1);
+}
+
+// Causal tiled attention: shape = {queries, keys, heads, headDim}
+static TinyAIAttentionParams attention_params(const int *shape)
+{
+    TinyAIAttentionParams params;
+    memset(&params, 0, sizeof(params));
+    params.batchSize     = 1;
+    params.seqLength     = (uint32_t)shape[1];
+    params.numHeads      = (uint32_t)shape[2];
+    params.numKVHeads    = (uint32_t)shape[2];
+    params.headDim       = (uint32_t)shape[3];
+    params.hiddenDim     = (uint32_t)(shape[2] * shape[3]);
+    params.useCausalMask = true;
+    params.scaleFactor   = 1.0f / sqrtf((float)shape[3]);
+    return params;
+}
+
+static bool setup_attention(KernelData *data, const int *shape)
+{
+    TinyAIAttentionParams params = attention_params(shape);
+    size_t                width  = (size_t)shape[2] * shape[3];
+    data->in                     = random_floats((size_t)shape[0] * width);
+    data->out                    = (float *)malloc((size_t)shape[0] * width * sizeof(float));
+    data->aux[0]                 = random_floats((size_t)shape[1] * width);
+    data->aux[1]                 = random_floats((size_t)shape[1] * width);
+    data->aux[2] = (float *)malloc(tinyaiAttentionAccumulatorSize(&params) * sizeof(float));
+    return data->in && data->out && data->aux[0] && data->aux[1] && data->aux[2];
+}
+
+static void run_attention(KernelData *data, const int *shape)
+{
+    TinyAIAttentionParams params = attention_params(shape);
+    tinyaiSimdAttentionTiled(&params, data->in, data->aux[0], data->aux[1], data->out,
+                             (uint32_t)shape[0], (uint32_t)shape[1],
+                             (uint32_t)(shape[1] - shape[0]), 0, data->aux[2]);
+}
+
+// Softmax over a vocabulary: shape = {size}
+static bool setup_softmax(KernelData *data, const int *shape)
+{
+    data->in  = random_floats((size_t)shape[0]);
+    data->out = (float *)malloc((size_t)shape[0] * sizeof(float));
+    return data->in && data->out;
+}
+
+static void run_softmax(KernelData *data, const int *shape)
+{
+    memcpy(data->out, data->in, (size_t)shape[0] * sizeof(float));
+    tinyaiSimdSoftmax(data->out, shape[0]);
+}
+
+// CSR matrix-vector product: shape = {rows, cols, percent of zeros}
+static bool setup_spmv(KernelData *data, const int *shape)
+{
+    size_t count = (size_t)shape[0] * shape[1];
+    float *dense = random_floats(count);
+    if (!dense) {
+        return false;
+    }
+    // Uniform values in [-1, 1): zero the ones below the threshold
+    float threshold = (float)shape[2] / 100.0f;
+    for (size_t i = 0; i < count; i++) {
+        if (fabsf(dense[i]) < threshold) {
+            dense[i] = 0.0f;
+        }
+    }
+    data->plan = tinyaiCreateCSRMatrixFromDense(dense, shape[0], shape[1], 0.0f);
+    free(dense);
+    data->in  = random_floats((size_t)shape[1]);
+    data->out = (float *)malloc((size_t)shape[0] * sizeof(float));
+    return data->plan && data->in && data->out;
+}
+
+static void run_spmv(KernelData *data, const int *shape)
+{
+    (void)shape;
+    tinyaiCSRMatrixVectorMulSIMD((const TinyAICSRMatrix *)data->plan, data->in, data->out);
+}
+
+static void free_csr(void *plan)
+{
+    tinyaiCSRMatrixFree((TinyAICSRMatrix *)plan);
+}
+
+// Real FFT of one frame: shape = {size}
+static bool setup_fft(KernelData *data, const int *shape)
+{
+    data->plan   = tinyaiAudioCreateFFTPlan(shape[0]);
+    data->in     = random_floats((size_t)shape[0]);
+    data->out    = (float *)malloc((size_t)shape[0] * sizeof(float));
+    data->aux[0] = (float *)malloc((size_t)shape[0] * sizeof(float));
+    return data->plan && data->in && data->out && data->aux[0];
+}
+
+static void run_fft(KernelData *data, const int *shape)
+{
+    tinyaiAudioExecuteFFTPlan((const TinyAIFFTPlan *)data->plan, data->in, shape[0], data->out,
+                              data->aux[0]);
+}
+
+static void free_fft_plan(void *plan)
+{
+    tinyaiAudioFreeFFTPlan((TinyAIFFTPlan *)plan);
+}
+
+// The fixed matrix of shapes; renaming or reshaping a case starts a new baseline entry
+static const KernelCase kernel_cases[] = {
+    {"gemv4_1024x1024", {1024, 1024}, setup_gemv4, run_gemv4, NULL},
+    {"gemv4_4096x1024", {4096, 1024}, setup_gemv4, run_gemv4, NULL},
+    {"gemm4_256x1024x64", {256, 1024, 64}, setup_gemm4, run_gemm4, NULL},
+    {"conv3x3_28x28_64to64", {28, 64, 64}, setup_conv, run_conv, free_conv_plan},
+    {"depthwise3x3_56x56_128", {56, 128}, setup_depthwise, run_depthwise, NULL},
+    {"attention_prefill_256x256_8x64", {256, 256, 8, 64}, setup_attention, run_attention, NULL},
+    {"attention_decode_1x1024_8x64", {1, 1024, 8, 64}, setup_attention, run_attention, NULL},
+    {"softmax_32000", {32000}, setup_softmax, run_softmax, NULL},
+    {"spmv_csr_4096x4096_90", {4096, 4096, 90}, setup_spmv, run_spmv, free_csr},
+    {"fft_512", {512}, setup_fft, run_fft, free_fft_plan},
+};
+
+#define NUM_KERNEL_CASES ((int)(sizeof(kernel_cases) / sizeof(kernel_cases[0])))
+
+static void release_data(const KernelCase *kernel, KernelData *data)
+{
+    if (data->plan && kernel->free_plan) {
+        kernel->free_plan(data->plan);
+    }
+    free(data->in);
+    free(data->out);
+    for (int i = 0; i < 3; i++) {
+        free(data->aux[i]);
+    }
+    free(data->weights);
+    free(data->scales);
+    memset(data, 0, sizeof(*data));
+}
+
+// ----- Timing -----
+
+static volatile uint32_t g_calibration_sink;
+
+// A serial chain of integer multiply-adds, which tracks the core clock
+static void run_calibration(KernelData *data, const int *shape)
+{
+    (void)data;
+    (void)shape;
+    uint32_t x = g_calibration_sink;
+    for (int i = 0; i < CALIBRATION_STEPS; i++) {
+        x = x * 1664525u + 1013904223u;
+    }
+    g_calibration_sink = x;
+}
+
+// Fastest time per call in nanoseconds over the samples; slower samples only add noise
+static double time_kernel(void (*run)(KernelData *, const int *), KernelData *data,
+                          const int *shape, int samples)
+{
+    // Warm up, then repeat enough calls that a sample outlasts timer noise
+    run(data, shape);
+    int      repeats = 1;
+    uint64_t start   = tinyaiTraceNow();
+    run(data, shape);
+    double once = (double)(tinyaiTraceNow() - start);
+    if (once < MIN_SAMPLE_NS) {
+        repeats = (int)(MIN_SAMPLE_NS / (once > 1.0 ? once : 1.0)) + 1;
+    }
+
+    double fastest = 0.0;
+    for (int s = 0; s < samples; s++) {
+        start = tinyaiTraceNow();
+        for (int r = 0; r < repeats; r++) {
+            run(data, shape);
+        }
+        double ns = (double)(tinyaiTraceNow() - start) / repeats;
+        if (s == 0 || ns < fastest) {
+            fastest = ns;
+        }
+    }
+    return fastest;
+}
+
+// Set up, time and release one case; -1 when it cannot be set up
+static double time_case(const KernelCase *kernel, int samples)
+{
+    KernelData data;
+    memset(&data, 0, sizeof(data));
+    double ns = -1.0;
+    if (kernel->setup(&data, kernel->shape)) {
+        ns = time_kernel(kernel->run, &data, kernel->shape, samples);
+    }
+    release_data(kernel, &data);
+    return ns;
+}
+
+// ----- Baselines -----
+
+// Name of the CPU family whose baseline applies: architecture and widest SIMD in use
+static const char *cpu_family(void)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    if (tinyaiSimdHasAVX512()) {
+        return "x86_64-avx512";
+    }
+    if (tinyaiSimdHasAVX2()) {
+        return "x86_64-avx2";
+    }
+    return "x86_64-sse2";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    return tinyaiSimdHasNEONDotProd() ? "aarch64-dotprod" : "aarch64-neon";
+#else
+    return "generic";
+#endif
+}
+
+// Read the entries of a baseline into the matching timings; false when there is no file
+static bool read_baseline(const char *path, KernelTiming *timings, int count)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    // One kernel per line, as write_results writes them
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        char   name[64];
+        double ns;
+        double relative;
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"ns\": %lf, \"relative\": %lf", name, &ns,
+                   &relative) != 3) {
+            continue;
+        }
+        for (int k = 0; k < count; k++) {
+            if (strcmp(timings[k].name, name) == 0) {
+                timings[k].baseline_relative = relative;
+                timings[k].has_baseline      = true;
+            }
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static bool write_results(const char *path, const char *family, double calibration_ns,
+                          const KernelTiming *timings, int count)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Error: Failed to write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"family\": \"%s\",\n", family);
+    fprintf(file, "  \"calibration_ns\": %.1f,\n", calibration_ns);
+    fprintf(file, "  \"kernels\": [\n");
+    for (int k = 0; k < count; k++) {
+        fprintf(file, "    {\"name\": \"%s\", \"ns\": %.1f, \"relative\": %.6f}%s\n",
+                timings[k].name, timings[k].ns, timings[k].relative, k + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+// ----- Driver -----
+
+void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -baseline_dir <dir>     Directory of <family>.json baselines (default: %s)\n",
+           DEFAULT_BASELINE_DIR);
+    printf("  -tolerance <percent>    Slowdown that fails a kernel (default: %.0f)\n",
+           DEFAULT_TOLERANCE);
+    printf("  -samples <n>            Timed samples per kernel (default: %d)\n", DEFAULT_SAMPLES);
+    printf("  -filter <text>          Run only kernels whose name contains the text\n");
+    printf("  -output <path>          Also write this run's results as JSON\n");
+    printf("  -update                 Write the results as the baseline of this CPU family\n");
+    printf("  -v                      Verbose output\n");
+    printf("  -h                      Display this help message\n");
+    printf("\n");
+}
+
+// Parse command line arguments and set configuration
+void parse_args(int argc, char **argv, KernelBenchmarkConfig *config)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-baseline_dir") == 0 && i + 1 < argc) {
+            strncpy(config->baseline_dir, argv[++i], sizeof(config->baseline_dir) - 1);
+        }
+        else if (strcmp(argv[i], "-tolerance") == 0 && i + 1 < argc) {
+            config->tolerance = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-samples") == 0 && i + 1 < argc) {
+            config->samples = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc) {
+            strncpy(config->filter, argv[++i], sizeof(config->filter) - 1);
+        }
+        else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc) {
+            strncpy(config->output_path, argv[++i], sizeof(config->output_path) - 1);
+        }
+        else if (strcmp(argv[i], "-update") == 0) {
+            config->update = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            config->verbose = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (config->samples < 1) {
+        config->samples = 1;
+    }
+    if (config->tolerance < 0.0) {
+        config->tolerance = 0.0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    KernelBenchmarkConfig config;
+    memset(&config, 0, sizeof(config));
+    strncpy(config.baseline_dir, DEFAULT_BASELINE_DIR, sizeof(config.baseline_dir) - 1);
+    config.tolerance = DEFAULT_TOLERANCE;
+    config.samples   = DEFAULT_SAMPLES;
+
+    parse_args(argc, argv, &config);
+
+    const char *family = cpu_family();
+    char        baseline_path[512];
+    snprintf(baseline_path, sizeof(baseline_path), "%s/%s.json", config.baseline_dir, family);
+
+    printf("\n===== TinyAI Kernel Benchmark =====\n");
+    printf("CPU Family: %s\n", family);
+    printf("Baseline: %s\n", baseline_path);
+    printf("Tolerance: %.1f%%\n", config.tolerance);
+    printf("===================================\n\n");
+
+    // One worker keeps timings independent of the core count
+    TinyAIThreadPool     *pool  = tinyaiCreateThreadPool(1, 0);
+    TinyAIThreadPoolScope scope = tinyaiUseThreadPool(pool);
+
+    KernelData data;
+    memset(&data, 0, sizeof(data));
+    double calibration_ns = time_kernel(run_calibration, &data, NULL, config.samples);
+
+    const KernelCase *timed[MAX_KERNELS];
+    KernelTiming      timings[MAX_KERNELS];
+    int               count  = 0;
+    bool              failed = false;
+    for (int k = 0; k < NUM_KERNEL_CASES && count < MAX_KERNELS; k++) {
+        const KernelCase *kernel = &kernel_cases[k];
+        if (config.filter[0] && !strstr(kernel->name, config.filter)) {
+            continue;
+        }
+        if (config.verbose) {
+            printf("Timing %s...\n", kernel->name);
+        }
+
+        double ns = time_case(kernel, config.samples);
+        if (ns < 0.0) {
+            printf("Error: Failed to set up %s\n", kernel->name);
+            failed = true;
+            continue;
+        }
+        KernelTiming *timing = &timings[count];
+        timed[count++]       = kernel;
+        memset(timing, 0, sizeof(*timing));
+        strncpy(timing->name, kernel->name, sizeof(timing->name) - 1);
+        timing->ns       = ns;
+        timing->relative = ns / calibration_ns;
+    }
+
+    bool has_baseline = !config.update && read_baseline(baseline_path, timings, count);
+
+    // A kernel over the tolerance is timed once more, so one noisy run does not fail the gate
+    for (int k = 0; k < count; k++) {
+        KernelTiming *timing = &timings[k];
+        if (!timing->has_baseline ||
+            timing->relative <= timing->baseline_relative * (1.0 + config.tolerance / 100.0)) {
+            continue;
+        }
+        if (config.verbose) {
+            printf("Timing %s again...\n", timing->name);
+        }
+        double ns = time_case(timed[k], config.samples);
+        if (ns >= 0.0 && ns < timing->ns) {
+            timing->ns       = ns;
+            timing->relative = ns / calibration_ns;
+        }
+    }
+
+    tinyaiRestoreThreadPool(scope);
+    tinyaiDestroyThreadPool(pool);
+
+    if (config.output_path[0]) {
+        write_results(config.output_path, family, calibration_ns, timings, count);
+    }
+    if (config.update) {
+        if (!write_results(baseline_path, family, calibration_ns, timings, count)) {
+            return 1;
+        }
+        printf("Baseline written to: %s\n", baseline_path);
+        return failed ? 1 : 0;
+    }
+
+    printf("%-32s %12s %10s %10s %9s  %s\n", "Kernel", "Time us", "Relative", "Baseline",
+           "Change", "Status");
+    int regressions = 0;
+    for (int k = 0; k < count; k++) {
+        const KernelTiming *timing = &timings[k];
+        if (!timing->has_baseline) {
+            printf("%-32s %12.2f %10.4f %10s %9s  %s\n", timing->name, timing->ns / 1000.0,
+                   timing->relative, "-", "-", "new");
+            continue;
+        }
+        double change = (timing->relative / timing->baseline_relative - 1.0) * 100.0;
+        bool   slower = change > config.tolerance;
+        regressions += slower;
+        printf("%-32s %12.2f %10.4f %10.4f %+8.1f%%  %s\n", timing->name, timing->ns / 1000.0,
+               timing->relative, timing->baseline_relative, change,
+               slower ? "REGRESSION" : "ok");
+    }
+    printf("Calibration: %.1f us\n", calibration_ns / 1000.0);
+
+    if (failed) {
+        return 1;
+    }
+    if (!has_baseline) {
+        printf("\nNo baseline for %s; record one with -update\n", family);
+        return EXIT_SKIPPED;
+    }
+    if (regressions > 0) {
+        printf("\n%d kernel(s) slowed down by more than %.1f%%\n", regressions, config.tolerance);
+        return 1;
+    }
+    printf("\nAll kernels within %.1f%% of the baseline\n", config.tolerance);
+    return 0;
+}
@@ -1,150 +1,486 @@
-#include "../utils/benchmark.h"
-#include "../utils/memory_optimizer.h"
-#include "../utils/progressive_loader.h"
+#include "../benchmark_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
-// Benchmark configuration
-#define BENCHMARK_ITERATIONS 100
-#define BENCHMARK_MODEL_PATH "data/benchmark_model.bin"
-#define BENCHMARK_MEMORY_BUDGET (1000 * 1024 * 1024) // 1GB
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
 
-// Memory usage tracking structure
+// TinyAI includes
+#include "../../../models/text/attention.h"
+#include "../../../models/text/generate.h"
+#include "../../../models/text/tokenizer.h"
+
+// Default configuration values
+#define DEFAULT_MODEL_PATH "models/pretrained/text_small.tmai"
+#define DEFAULT_PROMPT "TinyAI is"
+#define DEFAULT_PROMPT_LENGTH 128
+#define DEFAULT_DECODE_TOKENS 64
+#define DEFAULT_EXPORT_PATH "./benchmark_results"
+
+#define MB (1024.0 * 1024.0)
+
+// Phases of a model's life, in the order they run
+typedef enum {
+    PHASE_LOAD,     // Model files read or mapped
+    PHASE_PREPARE,  // Plan compiled, KV cache and logits allocated
+    PHASE_PREFILL,  // Prompt run through the model in one pass
+    PHASE_DECODE,   // Tokens generated one at a time
+    PHASE_TEARDOWN, // Everything freed again
+    PHASE_COUNT
+} MemoryPhase;
+
+static const char *const phase_names[PHASE_COUNT] = {"load", "prepare", "prefill", "decode",
+                                                     "teardown"};
+
+typedef struct {
+    char model_path[256];
+    char weights_path[256];   // Defaults to the model path
+    char tokenizer_path[256]; // Required unless loading a snapshot
+    char snapshot_path[256];  // Model snapshot, used instead of the model files when set
+    char prompt[256];
+    int  prompt_length; // Prompt tokens, repeating the encoded prompt text
+    int  decode_tokens; // Tokens generated after the prompt
+    char export_path[256];
+    bool verbose;
+} MemoryBenchmarkConfig;
+
+// Memory at the end of one phase; peaks cover the phase alone where the platform allows
 typedef struct {
-    size_t peak_memory;
-    size_t average_memory;
-    size_t total_allocations;
-    size_t total_frees;
-    double allocation_time;
-    double free_time;
-} MemoryBenchmarkStats;
-
-// Run memory benchmark for a specific configuration
-static MemoryBenchmarkStats run_memory_benchmark(const char *model_path, size_t memory_budget,
-                                                 bool  enable_checkpointing,
-                                                 float memory_speed_tradeoff)
-{
-    MemoryBenchmarkStats stats = {0};
-    clock_t              start_time, end_time;
-
-    // Create memory optimizer
-    TinyAIMemoryOptimizerConfig config = {.max_memory_budget     = memory_budget,
-                                          .enable_checkpointing  = enable_checkpointing,
-                                          .memory_speed_tradeoff = memory_speed_tradeoff,
-                                          .recompute_activations = true,
-                                          .max_activation_memory = memory_budget / 2};
-
-    TinyAIMemoryOptimizer *optimizer = tinyaiCreateMemoryOptimizer(&config);
-    if (!optimizer) {
-        fprintf(stderr, "Failed to create memory optimizer\n");
-        return stats;
-    }
-
-    // Create progressive loader
-    TinyAIProgressiveLoaderConfig loader_config = {.max_memory_budget      = memory_budget,
-                                                   .enable_layer_unloading = true,
-                                                   .priority_strategy =
-                                                       TINYAI_PRIORITY_ACCESS_PATTERN,
-                                                   .prefetch_threshold = 0.7f};
-
-    TinyAIProgressiveLoader *loader = tinyaiCreateProgressiveLoader(model_path, &loader_config);
-    if (!loader) {
-        fprintf(stderr, "Failed to create progressive loader\n");
-        tinyaiFreeMemoryOptimizer(optimizer);
-        return stats;
-    }
-
-    // Run benchmark iterations
-    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
-        // Measure allocation time
-        start_time = clock();
-
-        // Load model layers
-        for (int layer = 0; layer < loader->layer_count; layer++) {
-            if (!tinyaiLoadModelLayer(loader, layer)) {
-                fprintf(stderr, "Failed to load layer %d\n", layer);
-                continue;
-            }
-        }
-
-        end_time = clock();
-        stats.allocation_time += (double)(end_time - start_time) / CLOCKS_PER_SEC;
-
-        // Get memory stats
-        TinyAIMemoryStats memory_stats = tinyaiGetProgressiveLoaderMemoryStats(loader);
-        stats.peak_memory              = (memory_stats.peak_allocated > stats.peak_memory)
-                                             ? memory_stats.peak_allocated
-                                             : stats.peak_memory;
-        stats.average_memory += memory_stats.total_allocated;
-        stats.total_allocations += memory_stats.allocation_count;
-        stats.total_frees += memory_stats.free_count;
-
-        // Measure free time
-        start_time = clock();
-
-        // Unload model layers
-        for (int layer = 0; layer < loader->layer_count; layer++) {
-            if (!tinyaiUnloadModelLayer(loader, layer)) {
-                fprintf(stderr, "Failed to unload layer %d\n", layer);
-                continue;
-            }
-        }
-
-        end_time = clock();
-        stats.free_time += (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    }
-
-    // Calculate averages
-    stats.average_memory /= BENCHMARK_ITERATIONS;
-    stats.allocation_time /= BENCHMARK_ITERATIONS;
-    stats.free_time /= BENCHMARK_ITERATIONS;
-
-    // Cleanup
-    tinyaiFreeProgressiveLoader(loader);
-    tinyaiFreeMemoryOptimizer(optimizer);
-
-    return stats;
-}
-
-// Print benchmark results
-static void print_benchmark_results(const char *config_name, const MemoryBenchmarkStats *stats)
-{
-    printf("\nBenchmark Results for %s:\n", config_name);
-    printf("  Peak Memory Usage: %.2f MB\n", stats->peak_memory / (1024.0 * 1024.0));
-    printf("  Average Memory Usage: %.2f MB\n", stats->average_memory / (1024.0 * 1024.0));
-    printf("  Total Allocations: %zu\n", stats->total_allocations);
-    printf("  Total Frees: %zu\n", stats->total_frees);
-    printf("  Average Allocation Time: %.4f seconds\n", stats->allocation_time);
-    printf("  Average Free Time: %.4f seconds\n", stats->free_time);
-    printf("  Memory Operations per Second: %.2f\n",
-           (stats->total_allocations + stats->total_frees) /
-               (stats->allocation_time + stats->free_time));
-}
-
-int main(int argc, char *argv[])
-{
-    printf("Starting Memory Benchmark...\n");
-
-    // Test different configurations
-    struct {
-        const char *name;
-        size_t      memory_budget;
-        bool        enable_checkpointing;
-        float       memory_speed_tradeoff;
-    } configs[] = {{"Default", BENCHMARK_MEMORY_BUDGET, true, 0.5f},
-                   {"Memory-Optimized", BENCHMARK_MEMORY_BUDGET, true, 0.8f},
-                   {"Speed-Optimized", BENCHMARK_MEMORY_BUDGET, false, 0.2f},
-                   {"Minimal Memory", BENCHMARK_MEMORY_BUDGET / 2, true, 1.0f}};
+    double time_ms;
+    size_t rss_bytes;          // Resident set when the phase ended
+    size_t rss_peak_bytes;     // Highest resident set during the phase
+    size_t kv_pool_bytes;      // KV block storage when the phase ended
+    size_t kv_pool_peak_bytes; // Most KV block storage held at once so far
+    size_t weights_bytes;      // Heap weights
+    size_t kv_cache_bytes;     // Sequence cache, its blocks, and the model's own caches
+    size_t activation_bytes;   // Activation buffers, scratch and logits
+    size_t tokenizer_bytes;    // Heap vocabulary and caches
+    size_t mapped_bytes;       // Mapped snapshot and vocabulary files
+    size_t mapped_resident_bytes;
+} PhaseMemory;
+
+// State that lives from load to teardown
+typedef struct {
+    TinyAIModel       *model;
+    TinyAITokenizer   *tokenizer; // Owned by the benchmark unless the model came from a snapshot
+    TinyAIKVBlockPool *kv_pool;
+    TinyAIKVCache     *cache;
+    float             *logits;
+    int               *tokens; // Prompt, then the generated tokens
+    int                prompt_length;
+    int                decode_tokens;
+} MemoryRun;
+
+void print_usage(const char *program_name)
+{
+    printf("Usage: %s [options]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -model <path>           Path to TinyAI model file (default: %s)\n",
+           DEFAULT_MODEL_PATH);
+    printf("  -weights <path>         Path to the weights file (default: the model file)\n");
+    printf("  -tokenizer <path>       Path to the vocabulary file\n");
+    printf("  -snapshot <path>        Load a model snapshot instead of the model files\n");
+    printf("  -prompt <text>          Prompt text, repeated to the prompt length\n");
+    printf("                          (default: \"%s\")\n", DEFAULT_PROMPT);
+    printf("  -prompt_length <n>      Prompt length in tokens (default: %d)\n",
+           DEFAULT_PROMPT_LENGTH);
+    printf("  -decode <n>             Tokens to generate (default: %d)\n", DEFAULT_DECODE_TOKENS);
+    printf("  -export <path>          Export results path (default: %s)\n", DEFAULT_EXPORT_PATH);
+    printf("  -v                      Verbose output\n");
+    printf("  -h                      Display this help message\n");
+    printf("\n");
+}
+
+// Parse command line arguments and set configuration
+void parse_args(int argc, char **argv, MemoryBenchmarkConfig *config)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-model") == 0 && i + 1 < argc) {
+            strncpy(config->model_path, argv[++i], sizeof(config->model_path) - 1);
+        }
+        else if (strcmp(argv[i], "-weights") == 0 && i + 1 < argc) {
+            strncpy(config->weights_path, argv[++i], sizeof(config->weights_path) - 1);
+        }
+        else if (strcmp(argv[i], "-tokenizer") == 0 && i + 1 < argc) {
+            strncpy(config->tokenizer_path, argv[++i], sizeof(config->tokenizer_path) - 1);
+        }
+        else if (strcmp(argv[i], "-snapshot") == 0 && i + 1 < argc) {
+            strncpy(config->snapshot_path, argv[++i], sizeof(config->snapshot_path) - 1);
+        }
+        else if (strcmp(argv[i], "-prompt") == 0 && i + 1 < argc) {
+            strncpy(config->prompt, argv[++i], sizeof(config->prompt) - 1);
+        }
+        else if (strcmp(argv[i], "-prompt_length") == 0 && i + 1 < argc) {
+            config->prompt_length = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-decode") == 0 && i + 1 < argc) {
+            config->decode_tokens = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-export") == 0 && i + 1 < argc) {
+            strncpy(config->export_path, argv[++i], sizeof(config->export_path) - 1);
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            config->verbose = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (config->prompt_length < 1) {
+        config->prompt_length = 1;
+    }
+    if (config->decode_tokens < 0) {
+        config->decode_tokens = 0;
+    }
+}
+
+static double now_ms(void)
+{
+    struct timespec now;
+    tinyai_benchmark_start_timer(&now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+// Greedy choice of the next token
+static int argmax_token(const float *logits, int vocab_size)
+{
+    int best = 0;
+    for (int t = 1; t < vocab_size; t++) {
+        if (logits[t] > logits[best]) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// Build the prompt by repeating the encoded prompt text
+static void build_prompt(const TinyAIModel *model, const char *text, int *tokens, int length)
+{
+    int encoded = model->tokenizer ? tinyaiEncodeText(model->tokenizer, text, tokens, length) : 0;
+    if (encoded <= 0) {
+        tokens[0] = 1; // An unknown-text fallback that still exercises the model
+        encoded   = 1;
+    }
+    for (int i = encoded; i < length; i++) {
+        tokens[i] = tokens[i % encoded];
+    }
+}
+
+static bool load_phase(const MemoryBenchmarkConfig *config, MemoryRun *run)
+{
+    if (config->snapshot_path[0]) {
+        run->model = tinyaiLoadModelSnapshot(config->snapshot_path);
+    }
+    else {
+        run->model = tinyaiLoadModel(config->model_path,
+                                     config->weights_path[0] ? config->weights_path
+                                                             : config->model_path,
+                                     config->tokenizer_path);
+    }
+    if (!run->model) {
+        printf("Error: Failed to load model: %s\n",
+               config->snapshot_path[0] ? config->snapshot_path : config->model_path);
+        return false;
+    }
+    run->tokenizer = run->model->snapshot ? NULL : run->model->tokenizer;
+    return true;
+}
+
+static bool prepare_phase(const MemoryBenchmarkConfig *config, MemoryRun *run)
+{
+    TinyAIModel *model = run->model;
+    if (tinyaiPrepareModel(model) != 0) {
+        printf("Error: Failed to prepare the model\n");
+        return false;
+    }
+
+    // The sequence has to fit the context; decoding gives way to the prompt
+    int context        = (int)model->contextSize;
+    run->prompt_length = config->prompt_length < context ? config->prompt_length : context;
+    run->decode_tokens = config->decode_tokens;
+    if (run->prompt_length + run->decode_tokens > context) {
+        run->decode_tokens = context - run->prompt_length;
+    }
+
+    // A paged cache takes blocks as the sequence grows, so the pool shows the KV high-water mark
+    uint32_t max_blocks = (model->contextSize + TINYAI_KV_BLOCK_SIZE - 1) / TINYAI_KV_BLOCK_SIZE;
+    run->kv_pool        = tinyaiCreateModelKVBlockPool(model, max_blocks, NULL);
+    run->cache          = run->kv_pool ? tinyaiCreateModelPagedKVCache(model, run->kv_pool) : NULL;
+    run->logits         = (float *)malloc((size_t)model->tokenizer->tokenCount * sizeof(float));
+    run->tokens = (int *)malloc((size_t)(run->prompt_length + run->decode_tokens) * sizeof(int));
+    if (!run->cache || !run->logits || !run->tokens) {
+        printf("Error: Failed to allocate the KV cache and buffers\n");
+        return false;
+    }
+    build_prompt(model, config->prompt, run->tokens, run->prompt_length);
+    return true;
+}
+
+static bool prefill_phase(MemoryRun *run)
+{
+    if (tinyaiModelForwardCached(run->model, run->cache, run->tokens, run->prompt_length,
+                                 run->logits) != 0) {
+        printf("Error: Prefill failed\n");
+        return false;
+    }
+    return true;
+}
+
+static bool decode_phase(MemoryRun *run)
+{
+    int vocab_size = (int)run->model->tokenizer->tokenCount;
+    for (int i = 0; i < run->decode_tokens; i++) {
+        int *token = &run->tokens[run->prompt_length + i];
+        *token     = argmax_token(run->logits, vocab_size);
+        if (tinyaiModelForwardCached(run->model, run->cache, token, 1, run->logits) != 0) {
+            printf("Error: Decode step %d failed\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void teardown_phase(MemoryRun *run)
+{
+    tinyaiDestroyKVCache(run->cache);
+    tinyaiDestroyKVBlockPool(run->kv_pool);
+    free(run->logits);
+    free(run->tokens);
+    tinyaiDestroyModel(run->model);
+    tinyaiDestroyTokenizer(run->tokenizer);
+    memset(run, 0, sizeof(*run));
+}
+
+// Record the memory left by a phase and attribute it to subsystems
+static void measure_phase(const MemoryRun *run, double start_ms, PhaseMemory *phase)
+{
+    phase->time_ms        = now_ms() - start_ms;
+    phase->rss_bytes      = tinyai_measure_current_memory_usage();
+    phase->rss_peak_bytes = tinyai_measure_peak_memory_usage();
+    phase->kv_pool_bytes  = tinyaiKVBlockPoolMemoryUsage(run->kv_pool, &phase->kv_pool_peak_bytes);
+
+    TinyAIModelMemoryUsage usage;
+    if (tinyaiGetModelMemoryUsage(run->model, &usage) != 0) {
+        return;
+    }
+    phase->weights_bytes    = usage.weights;
+    phase->kv_cache_bytes   = usage.kvCache + tinyaiKVCacheMemoryUsage(run->cache) +
+                              phase->kv_pool_bytes;
+    phase->activation_bytes = usage.activations;
+    if (run->logits) {
+        phase->activation_bytes += run->model->tokenizer->tokenCount * sizeof(float);
+    }
+    phase->tokenizer_bytes       = usage.tokenizer;
+    phase->mapped_bytes          = usage.mapped;
+    phase->mapped_resident_bytes = usage.mappedResident;
+}
+
+// Run every phase, stopping at a failed one; returns how many phases were measured
+static int run_phases(const MemoryBenchmarkConfig *config, PhaseMemory *phases,
+                      size_t *baseline_rss, bool *peaks_per_phase, int *prompt_tokens,
+                      int *decode_tokens)
+{
+    MemoryRun run;
+    memset(&run, 0, sizeof(run));
+    memset(phases, 0, PHASE_COUNT * sizeof(PhaseMemory));
+    *baseline_rss = tinyai_measure_current_memory_usage();
+
+    int measured = 0;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        *peaks_per_phase = tinyai_reset_peak_memory_usage();
+        if (config->verbose) {
+            printf("Running %s phase...\n", phase_names[p]);
+        }
+
+        double start = now_ms();
+        bool   ok    = true;
+        switch (p) {
+        case PHASE_LOAD:
+            ok = load_phase(config, &run);
+            break;
+        case PHASE_PREPARE:
+            ok = prepare_phase(config, &run);
+            break;
+        case PHASE_PREFILL:
+            ok = prefill_phase(&run);
+            break;
+        case PHASE_DECODE:
+            ok = decode_phase(&run);
+            break;
+        default:
+            teardown_phase(&run);
+            break;
+        }
+        if (!ok) {
+            teardown_phase(&run);
+            return measured;
+        }
+        if (p == PHASE_PREPARE) {
+            // The lengths actually run, which the context size may have cut
+            *prompt_tokens = run.prompt_length;
+            *decode_tokens = run.decode_tokens;
+        }
+        measure_phase(&run, start, &phases[p]);
+        measured++;
+    }
+    return measured;
+}
+
+static void print_phases(const PhaseMemory *phases, int count, size_t baseline_rss,
+                         bool peaks_per_phase)
+{
+    printf("\n===== Memory by Phase (MB) =====\n");
+    printf("Baseline RSS: %.2f MB\n", baseline_rss / MB);
+    if (!peaks_per_phase) {
+        printf("Peak RSS covers the whole process: this platform cannot reset it per phase\n");
+    }
+    printf("%-9s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "Phase", "Time ms", "RSS",
+           "Peak RSS", "KV pool", "KV peak", "Weights", "KV cache", "Activ.", "Tokenizer",
+           "Mapped");
+    for (int p = 0; p < count; p++) {
+        const PhaseMemory *phase = &phases[p];
+        printf("%-9s %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+               phase_names[p], phase->time_ms, phase->rss_bytes / MB, phase->rss_peak_bytes / MB,
+               phase->kv_pool_bytes / MB, phase->kv_pool_peak_bytes / MB,
+               phase->weights_bytes / MB, phase->kv_cache_bytes / MB,
+               phase->activation_bytes / MB, phase->tokenizer_bytes / MB,
+               phase->mapped_resident_bytes / MB);
+    }
+    printf("Subsystems count the heap they allocated, whether or not it was touched yet;\n");
+    printf("Mapped counts only the resident pages of the mapped files.\n");
+}
+
+static bool export_csv(const PhaseMemory *phases, int count, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "phase,time_ms,rss_bytes,rss_peak_bytes,kv_pool_bytes,kv_pool_peak_bytes,"
+                  "weights_bytes,kv_cache_bytes,activation_bytes,tokenizer_bytes,mapped_bytes,"
+                  "mapped_resident_bytes\n");
+    for (int p = 0; p < count; p++) {
+        const PhaseMemory *phase = &phases[p];
+        fprintf(file, "%s,%.3f,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu\n", phase_names[p],
+                phase->time_ms, phase->rss_bytes, phase->rss_peak_bytes, phase->kv_pool_bytes,
+                phase->kv_pool_peak_bytes, phase->weights_bytes, phase->kv_cache_bytes,
+                phase->activation_bytes, phase->tokenizer_bytes, phase->mapped_bytes,
+                phase->mapped_resident_bytes);
+    }
+    return fclose(file) == 0;
+}
+
+static bool export_json(const MemoryBenchmarkConfig *config, int prompt_tokens,
+                        int decode_tokens, const PhaseMemory *phases, int count,
+                        size_t baseline_rss, bool peaks_per_phase, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    const char *model = config->snapshot_path[0] ? config->snapshot_path : config->model_path;
+    fprintf(file, "{\n");
+    fprintf(file, "  \"model\": \"%s\",\n", model);
+    fprintf(file, "  \"prompt_tokens\": %d,\n", prompt_tokens);
+    fprintf(file, "  \"decode_tokens\": %d,\n", decode_tokens);
+    fprintf(file, "  \"baseline_rss_bytes\": %zu,\n", baseline_rss);
+    fprintf(file, "  \"peaks_per_phase\": %s,\n", peaks_per_phase ? "true" : "false");
+    fprintf(file, "  \"phases\": [\n");
+    for (int p = 0; p < count; p++) {
+        const PhaseMemory *phase = &phases[p];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"phase\": \"%s\",\n", phase_names[p]);
+        fprintf(file, "      \"time_ms\": %.3f,\n", phase->time_ms);
+        fprintf(file, "      \"rss_bytes\": %zu,\n", phase->rss_bytes);
+        fprintf(file, "      \"rss_peak_bytes\": %zu,\n", phase->rss_peak_bytes);
+        fprintf(file, "      \"kv_pool_bytes\": %zu,\n", phase->kv_pool_bytes);
+        fprintf(file, "      \"kv_pool_peak_bytes\": %zu,\n", phase->kv_pool_peak_bytes);
+        fprintf(file, "      \"weights_bytes\": %zu,\n", phase->weights_bytes);
+        fprintf(file, "      \"kv_cache_bytes\": %zu,\n", phase->kv_cache_bytes);
+        fprintf(file, "      \"activation_bytes\": %zu,\n", phase->activation_bytes);
+        fprintf(file, "      \"tokenizer_bytes\": %zu,\n", phase->tokenizer_bytes);
+        fprintf(file, "      \"mapped_bytes\": %zu,\n", phase->mapped_bytes);
+        fprintf(file, "      \"mapped_resident_bytes\": %zu\n", phase->mapped_resident_bytes);
+        fprintf(file, "    }%s\n", p + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
 
-    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
-        MemoryBenchmarkStats stats =
-            run_memory_benchmark(BENCHMARK_MODEL_PATH, configs[i].memory_budget,
-                                 configs[i].enable_checkpointing, configs[i].memory_speed_tradeoff);
-        print_benchmark_results(configs[i].name, &stats);
-    }
-
-    printf("\nMemory Benchmark Completed!\n");
-    return 0;
-}
\ No newline at end of file
+int main(int argc, char **argv)
+{
+    MemoryBenchmarkConfig config;
+    memset(&config, 0, sizeof(config));
+    strncpy(config.model_path, DEFAULT_MODEL_PATH, sizeof(config.model_path) - 1);
+    strncpy(config.prompt, DEFAULT_PROMPT, sizeof(config.prompt) - 1);
+    strncpy(config.export_path, DEFAULT_EXPORT_PATH, sizeof(config.export_path) - 1);
+    config.prompt_length = DEFAULT_PROMPT_LENGTH;
+    config.decode_tokens = DEFAULT_DECODE_TOKENS;
+
+    parse_args(argc, argv, &config);
+
+    // Ensure the export directory exists
+    mkdir(config.export_path, 0755);
+
+    printf("\n===== TinyAI Memory Benchmark =====\n");
+    printf("Model: %s\n", config.snapshot_path[0] ? config.snapshot_path : config.model_path);
+    printf("Prompt Length: %d tokens\n", config.prompt_length);
+    printf("Decode Tokens: %d\n", config.decode_tokens);
+    printf("Export Path: %s\n", config.export_path);
+    printf("===================================\n");
+
+    PhaseMemory phases[PHASE_COUNT];
+    size_t      baseline_rss    = 0;
+    bool        peaks_per_phase = false;
+    int         prompt_tokens   = 0;
+    int         decode_tokens   = 0;
+    int         count = run_phases(&config, phases, &baseline_rss, &peaks_per_phase,
+                                   &prompt_tokens, &decode_tokens);
+    if (count == 0) {
+        printf("Error: No phase completed\n");
+        return 1;
+    }
+    print_phases(phases, count, baseline_rss, peaks_per_phase);
+
+    char csv_name[256];
+    char json_name[256];
+    char csv_path[1024];
+    char json_path[1024];
+    tinyai_create_timestamped_filename(csv_name, sizeof(csv_name), "tinyai_memory_benchmark",
+                                       "csv");
+    tinyai_create_timestamped_filename(json_name, sizeof(json_name), "tinyai_memory_benchmark",
+                                       "json");
+    snprintf(csv_path, sizeof(csv_path), "%s/%s", config.export_path, csv_name);
+    snprintf(json_path, sizeof(json_path), "%s/%s", config.export_path, json_name);
+
+    printf("\nExporting results...\n");
+    if (export_csv(phases, count, csv_path)) {
+        printf("CSV results exported to: %s\n", csv_path);
+    }
+    else {
+        printf("Failed to export CSV results\n");
+    }
+    if (export_json(&config, prompt_tokens, decode_tokens, phases, count, baseline_rss,
+                    peaks_per_phase, json_path)) {
+        printf("JSON results exported to: %s\n", json_path);
+    }
+    else {
+        printf("Failed to export JSON results\n");
+    }
+
+    return count == PHASE_COUNT ? 0 : 1;
+}
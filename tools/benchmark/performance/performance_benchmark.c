@@ -1,258 +1,791 @@
-#include "tinyai.h"
-#include "utils/layer_scheduler.h"
-#include "utils/memory_optimizer.h"
-#include "utils/progressive_loader.h"
-#include <math.h>
+// Thread-scaling benchmark
+//
+// Runs each model type on thread pools of 1..N threads and reports the
+// speedup over one thread, the parallel efficiency (speedup per thread) and
+// the imbalance between the threads (busiest thread's task time over the
+// mean), then checks the thread count tinyai_determine_optimal_threads picks
+// against the fastest one measured.
+
+#include "../benchmark_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 
-// Benchmark configuration
-#define BENCHMARK_DURATION_SECONDS 60
-#define SAMPLE_INTERVAL_MS 100
-#define WARMUP_ITERATIONS 10
-#define MAX_BATCH_SIZES 5
-#define MAX_PROMPT_LENGTH 1024
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
+
+// TinyAI includes
+#include "../../../models/audio/audio_model.h"
+#include "../../../models/image/image_model.h"
+#include "../../../models/image/image_utils.h"
+#include "../../../models/text/attention.h"
+#include "../../../models/text/generate.h"
+#include "../../../models/text/tokenizer.h"
+#include "../../../utils/thread_pool.h"
+
+// Default configuration values
+#define DEFAULT_MODEL_PATH "models/pretrained/text_small.tmai"
+#define DEFAULT_PROMPT "TinyAI is"
+#define DEFAULT_PROMPT_LENGTH 128
+#define DEFAULT_DECODE_TOKENS 32
+#define DEFAULT_REPEATS 3
+#define DEFAULT_EXPORT_PATH "./benchmark_results"
+
+#define MAX_THREADS 64
+#define IMAGE_SIZE 224
+#define AUDIO_CLIPS 8
+#define AUDIO_SAMPLE_RATE 16000
+#define PLOT_WIDTH 40
+
+// A thread count within this fraction of the fastest is as good as the fastest
+#define NEAR_BEST 0.05
 
-// Performance metrics structure
 typedef struct {
-    double inference_time;
-    double throughput;
-    double memory_usage;
-    double cpu_usage;
-    double cache_hit_rate;
-    size_t memory_operations;
-    size_t tensor_reuses;
-} PerformanceMetrics;
-
-// Benchmark configuration
+    char model_path[256];
+    char weights_path[256];   // Defaults to the model path
+    char tokenizer_path[256]; // Required unless loading a snapshot
+    char snapshot_path[256];  // Model snapshot, used instead of the model files when set
+    char prompt[256];
+    int  prompt_length;
+    int  decode_tokens;
+    char models[64];  // Comma-separated model types to run, or "all"
+    int  max_threads; // Largest pool swept (0 = the determined optimum)
+    int  repeats;     // Timed runs per thread count; the median is kept
+    char export_path[256];
+    bool verbose;
+} PerformanceBenchmarkConfig;
+
+// Models and inputs shared by the workloads
 typedef struct {
-    const char *model_path;
-    const char *prompt;
-    size_t      max_length;
-    float       temperature;
-    int         batch_sizes[MAX_BATCH_SIZES];
-    int         num_batch_sizes;
-    bool        enable_simd;
-    bool        enable_cache_opt;
-    bool        enable_memory_opt;
-} BenchmarkConfig;
-
-// Benchmark results
+    TinyAIModel      *text_model;
+    TinyAITokenizer  *tokenizer; // Owned by the benchmark unless the model came from a snapshot
+    TinyAIKVCache    *cache;
+    float            *logits;
+    int              *tokens;
+    int               prompt_length;
+    int               decode_tokens;
+    TinyAIImageModel *image_model;
+    TinyAIImage      *image;
+    TinyAIAudioModel *audio_model;
+    TinyAIAudioData   clips[AUDIO_CLIPS];
+    TinyAIAudioModelOutput outputs[AUDIO_CLIPS];
+    bool                   outputs_ready;
+} Workloads;
+
+// One measured operation; run returns its time in milliseconds, or -1 on failure
 typedef struct {
-    PerformanceMetrics metrics[MAX_BATCH_SIZES];
-    double             total_duration;
-    size_t             total_samples;
-    size_t             total_tokens;
-} BenchmarkResults;
+    const char *name;
+    const char *model; // Model type selected by -models
+    const char *unit;  // What one run produces
+    bool (*ready)(const Workloads *workloads);
+    double (*run)(Workloads *workloads);
+    int (*units)(const Workloads *workloads);
+} Workload;
+
+// Timing of one workload on one pool size
+typedef struct {
+    int    threads;
+    double time_ms;
+    double speedup;
+    double efficiency;
+    double imbalance; // Busiest thread's task time over the mean (1 = even)
+} ScalingPoint;
 
-// Initialize benchmark configuration
-static void init_benchmark_config(BenchmarkConfig *config)
+typedef struct {
+    const Workload *workload;
+    ScalingPoint    points[MAX_THREADS];
+    int             count;
+    int             best_threads;   // Fastest thread count measured
+    int             chosen_threads; // tinyai_determine_optimal_threads, capped to the sweep
+    double          chosen_loss;    // How much slower the chosen count is than the best
+} ScalingResult;
+
+void print_usage(const char *program_name)
 {
-    config->model_path  = "models/example.tinyai";
-    config->prompt      = "The quick brown fox jumps over the lazy dog.";
-    config->max_length  = 100;
-    config->temperature = 0.7f;
+    printf("Usage: %s [options]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -model <path>           Path to TinyAI text model file (default: %s)\n",
+           DEFAULT_MODEL_PATH);
+    printf("  -weights <path>         Path to the weights file (default: the model file)\n");
+    printf("  -tokenizer <path>       Path to the vocabulary file\n");
+    printf("  -snapshot <path>        Load a text model snapshot instead of the model files\n");
+    printf("  -prompt <text>          Prompt text, repeated to the prompt length\n");
+    printf("                          (default: \"%s\")\n", DEFAULT_PROMPT);
+    printf("  -prompt_length <n>      Prompt length in tokens (default: %d)\n",
+           DEFAULT_PROMPT_LENGTH);
+    printf("  -decode <n>             Tokens generated per decode run (default: %d)\n",
+           DEFAULT_DECODE_TOKENS);
+    printf("  -models <list>          Model types to run: text,image,audio (default: all)\n");
+    printf("  -threads <n>            Largest thread count swept (default: the determined\n");
+    printf("                          optimal thread count)\n");
+    printf("  -repeats <n>            Timed runs per thread count (default: %d)\n",
+           DEFAULT_REPEATS);
+    printf("  -export <path>          Export results path (default: %s)\n", DEFAULT_EXPORT_PATH);
+    printf("  -v                      Verbose output\n");
+    printf("  -h                      Display this help message\n");
+    printf("\n");
+}
 
-    // Test different batch sizes
-    config->batch_sizes[0]  = 1;
-    config->batch_sizes[1]  = 4;
-    config->batch_sizes[2]  = 8;
-    config->batch_sizes[3]  = 16;
-    config->batch_sizes[4]  = 32;
-    config->num_batch_sizes = 5;
+// Parse command line arguments and set configuration
+void parse_args(int argc, char **argv, PerformanceBenchmarkConfig *config)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-model") == 0 && i + 1 < argc) {
+            strncpy(config->model_path, argv[++i], sizeof(config->model_path) - 1);
+        }
+        else if (strcmp(argv[i], "-weights") == 0 && i + 1 < argc) {
+            strncpy(config->weights_path, argv[++i], sizeof(config->weights_path) - 1);
+        }
+        else if (strcmp(argv[i], "-tokenizer") == 0 && i + 1 < argc) {
+            strncpy(config->tokenizer_path, argv[++i], sizeof(config->tokenizer_path) - 1);
+        }
+        else if (strcmp(argv[i], "-snapshot") == 0 && i + 1 < argc) {
+            strncpy(config->snapshot_path, argv[++i], sizeof(config->snapshot_path) - 1);
+        }
+        else if (strcmp(argv[i], "-prompt") == 0 && i + 1 < argc) {
+            strncpy(config->prompt, argv[++i], sizeof(config->prompt) - 1);
+        }
+        else if (strcmp(argv[i], "-prompt_length") == 0 && i + 1 < argc) {
+            config->prompt_length = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-decode") == 0 && i + 1 < argc) {
+            config->decode_tokens = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-models") == 0 && i + 1 < argc) {
+            strncpy(config->models, argv[++i], sizeof(config->models) - 1);
+        }
+        else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
+            config->max_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-repeats") == 0 && i + 1 < argc) {
+            config->repeats = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-export") == 0 && i + 1 < argc) {
+            strncpy(config->export_path, argv[++i], sizeof(config->export_path) - 1);
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            config->verbose = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    config->enable_simd       = true;
-    config->enable_cache_opt  = true;
-    config->enable_memory_opt = true;
+    if (config->prompt_length < 1) {
+        config->prompt_length = 1;
+    }
+    if (config->decode_tokens < 1) {
+        config->decode_tokens = 1;
+    }
+    if (config->repeats < 1) {
+        config->repeats = 1;
+    }
+    if (config->max_threads < 0) {
+        config->max_threads = 0;
+    }
+    if (config->max_threads > MAX_THREADS) {
+        config->max_threads = MAX_THREADS;
+    }
+}
+
+static bool model_selected(const PerformanceBenchmarkConfig *config, const char *model)
+{
+    if (strcmp(config->models, "all") == 0) {
+        return true;
+    }
+    // Match whole entries of the comma-separated list
+    size_t      length = strlen(model);
+    const char *entry  = config->models;
+    while (entry && *entry) {
+        if (strncmp(entry, model, length) == 0 && (entry[length] == ',' || !entry[length])) {
+            return true;
+        }
+        entry = strchr(entry, ',');
+        entry = entry ? entry + 1 : NULL;
+    }
+    return false;
 }
 
-// Run warmup iterations
-static void run_warmup(TinyAIModel *model, const char *prompt,
-                       const TinyAIGenerationConfig *gen_config)
+static double now_ms(void)
 {
-    printf("Running warmup iterations...\n");
-    char output[MAX_PROMPT_LENGTH];
+    struct timespec now;
+    tinyai_benchmark_start_timer(&now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+// ----- Text -----
 
-    for (int i = 0; i < WARMUP_ITERATIONS; i++) {
-        tinyaiGenerateText(model, prompt, gen_config, output);
+// Greedy choice of the next token
+static int argmax_token(const float *logits, int vocab_size)
+{
+    int best = 0;
+    for (int t = 1; t < vocab_size; t++) {
+        if (logits[t] > logits[best]) {
+            best = t;
+        }
     }
+    return best;
 }
 
-// Collect performance metrics
-static void collect_metrics(TinyAIModel *model, PerformanceMetrics *metrics)
+// Build the prompt by repeating the encoded prompt text
+static void build_prompt(const TinyAIModel *model, const char *text, int *tokens, int length)
 {
-    // Get inference time and throughput
-    TinyAIPerformanceMetrics perf_metrics = tinyaiGetPerformanceMetrics(model);
-    metrics->inference_time               = perf_metrics.inference_time;
-    metrics->throughput                   = perf_metrics.throughput;
+    int encoded = model->tokenizer ? tinyaiEncodeText(model->tokenizer, text, tokens, length) : 0;
+    if (encoded <= 0) {
+        tokens[0] = 1; // An unknown-text fallback that still exercises the model
+        encoded   = 1;
+    }
+    for (int i = encoded; i < length; i++) {
+        tokens[i] = tokens[i % encoded];
+    }
+}
 
-    // Get memory usage
-    TinyAIResourceUsage usage = tinyaiGetResourceUsage(model);
-    metrics->memory_usage     = usage.memory_usage;
-    metrics->cpu_usage        = usage.cpu_usage;
+static bool setup_text(const PerformanceBenchmarkConfig *config, Workloads *workloads)
+{
+    TinyAIModel *model;
+    if (config->snapshot_path[0]) {
+        model = tinyaiLoadModelSnapshot(config->snapshot_path);
+    }
+    else {
+        model = tinyaiLoadModel(config->model_path,
+                                config->weights_path[0] ? config->weights_path
+                                                        : config->model_path,
+                                config->tokenizer_path);
+    }
+    if (!model) {
+        printf("Skipping text: failed to load %s\n",
+               config->snapshot_path[0] ? config->snapshot_path : config->model_path);
+        return false;
+    }
+    workloads->text_model = model;
+    workloads->tokenizer  = model->snapshot ? NULL : model->tokenizer;
+    if (tinyaiPrepareModel(model) != 0) {
+        printf("Skipping text: failed to prepare the model\n");
+        return false;
+    }
 
-    // Get cache statistics
-    TinyAICacheStats cache_stats = tinyaiGetCacheStats(model);
-    metrics->cache_hit_rate      = cache_stats.hit_rate;
+    // The sequence has to fit the context; decoding gives way to the prompt
+    int context              = (int)model->contextSize;
+    workloads->prompt_length = config->prompt_length < context ? config->prompt_length : context;
+    workloads->decode_tokens = config->decode_tokens;
+    if (workloads->prompt_length + workloads->decode_tokens > context) {
+        workloads->decode_tokens = context - workloads->prompt_length;
+    }
 
-    // Get memory optimizer statistics
-    TinyAIMemoryOptimizer *optimizer = tinyaiGetMemoryOptimizer(model);
-    if (optimizer) {
-        TinyAIMemoryStats mem_stats = tinyaiGetMemoryOptimizerStats(optimizer);
-        metrics->memory_operations  = mem_stats.operations;
-        metrics->tensor_reuses      = mem_stats.tensor_reuses;
+    int total         = workloads->prompt_length + workloads->decode_tokens;
+    workloads->cache  = tinyaiCreateModelKVCache(model);
+    workloads->logits = (float *)malloc((size_t)model->tokenizer->tokenCount * sizeof(float));
+    workloads->tokens = (int *)malloc((size_t)total * sizeof(int));
+    if (!workloads->cache || !workloads->logits || !workloads->tokens) {
+        printf("Skipping text: failed to allocate the KV cache and buffers\n");
+        return false;
     }
+    build_prompt(model, config->prompt, workloads->tokens, workloads->prompt_length);
+    return true;
+}
+
+static bool text_ready(const Workloads *workloads)
+{
+    return workloads->tokens != NULL;
 }
 
-// Run benchmark for a specific batch size
-static void run_benchmark_batch(TinyAIModel *model, const BenchmarkConfig *config, int batch_size,
-                                PerformanceMetrics *metrics)
+static bool text_decode_ready(const Workloads *workloads)
 {
-    // Configure generation
-    TinyAIGenerationConfig gen_config = {.max_length  = config->max_length,
-                                         .temperature = config->temperature,
-                                         .batch_size  = batch_size};
+    return workloads->tokens != NULL && workloads->decode_tokens > 0;
+}
 
-    // Run warmup
-    run_warmup(model, config->prompt, &gen_config);
+static bool prefill(Workloads *workloads)
+{
+    tinyaiResetKVCache(workloads->cache);
+    return tinyaiModelForwardCached(workloads->text_model, workloads->cache, workloads->tokens,
+                                    workloads->prompt_length, workloads->logits) == 0;
+}
 
-    // Initialize metrics
-    memset(metrics, 0, sizeof(PerformanceMetrics));
-    size_t total_samples = 0;
-    size_t total_tokens  = 0;
+static double run_text_prefill(Workloads *workloads)
+{
+    double start = now_ms();
+    return prefill(workloads) ? now_ms() - start : -1.0;
+}
 
-    // Run benchmark
-    clock_t start_time = clock();
-    char    output[MAX_PROMPT_LENGTH];
+// Decode after an untimed prefill, so only the single-token steps count
+static double run_text_decode(Workloads *workloads)
+{
+    if (!prefill(workloads)) {
+        return -1.0;
+    }
 
-    while ((clock() - start_time) / CLOCKS_PER_SEC < BENCHMARK_DURATION_SECONDS) {
-        // Generate text
-        tinyaiGenerateText(model, config->prompt, &gen_config, output);
+    int    vocab_size = (int)workloads->text_model->tokenizer->tokenCount;
+    double start      = now_ms();
+    for (int i = 0; i < workloads->decode_tokens; i++) {
+        int *token = &workloads->tokens[workloads->prompt_length + i];
+        *token     = argmax_token(workloads->logits, vocab_size);
+        if (tinyaiModelForwardCached(workloads->text_model, workloads->cache, token, 1,
+                                     workloads->logits) != 0) {
+            return -1.0;
+        }
+    }
+    return now_ms() - start;
+}
 
-        // Collect metrics
-        PerformanceMetrics sample;
-        collect_metrics(model, &sample);
+static int prompt_units(const Workloads *workloads)
+{
+    return workloads->prompt_length;
+}
+
+static int decode_units(const Workloads *workloads)
+{
+    return workloads->decode_tokens;
+}
 
-        // Accumulate metrics
-        metrics->inference_time += sample.inference_time;
-        metrics->throughput += sample.throughput;
-        metrics->memory_usage += sample.memory_usage;
-        metrics->cpu_usage += sample.cpu_usage;
-        metrics->cache_hit_rate += sample.cache_hit_rate;
-        metrics->memory_operations += sample.memory_operations;
-        metrics->tensor_reuses += sample.tensor_reuses;
+// ----- Image -----
 
-        total_samples++;
-        total_tokens += strlen(output);
+static bool setup_image(Workloads *workloads)
+{
+    TinyAIImageModelParams params = {.modelType       = TINYAI_IMAGE_MODEL_MOBILENET,
+                                     .inputWidth      = IMAGE_SIZE,
+                                     .inputHeight     = IMAGE_SIZE,
+                                     .inputChannels   = 3,
+                                     .numClasses      = 1000,
+                                     .weightsFile     = NULL,
+                                     .labelsFile      = NULL,
+                                     .useQuantization = true,
+                                     .useSIMD         = true,
+                                     .customParams    = NULL};
+    workloads->image_model = tinyaiImageModelCreate(&params);
+    workloads->image       = tinyaiImageCreate(IMAGE_SIZE, IMAGE_SIZE, TINYAI_IMAGE_FORMAT_RGB);
+    if (!workloads->image_model || !workloads->image) {
+        printf("Skipping image: failed to create the model\n");
+        return false;
+    }
 
-        // Sleep for sample interval
-        struct timespec ts = {0, SAMPLE_INTERVAL_MS * 1000000};
-        nanosleep(&ts, NULL);
+    // A smooth gradient keeps activations in a realistic range
+    uint8_t *pixels = workloads->image->data;
+    for (int y = 0; y < IMAGE_SIZE; y++) {
+        for (int x = 0; x < IMAGE_SIZE; x++) {
+            uint8_t *pixel = &pixels[(y * IMAGE_SIZE + x) * 3];
+            pixel[0]       = (uint8_t)x;
+            pixel[1]       = (uint8_t)y;
+            pixel[2]       = (uint8_t)((x + y) / 2);
+        }
     }
+    return true;
+}
+
+static bool image_ready(const Workloads *workloads)
+{
+    return workloads->image != NULL && workloads->image_model != NULL;
+}
 
-    // Calculate averages
-    if (total_samples > 0) {
-        metrics->inference_time /= total_samples;
-        metrics->throughput /= total_samples;
-        metrics->memory_usage /= total_samples;
-        metrics->cpu_usage /= total_samples;
-        metrics->cache_hit_rate /= total_samples;
+static double run_image(Workloads *workloads)
+{
+    TinyAIImageClassResult results[5];
+    double                 start = now_ms();
+    if (tinyaiImageModelClassify(workloads->image_model, workloads->image, 5, results) < 0) {
+        return -1.0;
     }
+    return now_ms() - start;
 }
 
-// Print benchmark results
-static void print_results(const BenchmarkConfig *config, const BenchmarkResults *results)
+static int image_units(const Workloads *workloads)
 {
-    printf("\nPerformance Benchmark Results\n");
-    printf("============================\n\n");
+    (void)workloads;
+    return 1;
+}
 
-    printf("Model: %s\n", config->model_path);
-    printf("Prompt: %s\n", config->prompt);
-    printf("Duration: %.2f seconds\n", results->total_duration);
-    printf("Total Samples: %zu\n", results->total_samples);
-    printf("Total Tokens: %zu\n\n", results->total_tokens);
+// ----- Audio -----
 
-    printf("Batch Size Analysis\n");
-    printf("------------------\n");
-    for (int i = 0; i < config->num_batch_sizes; i++) {
-        const PerformanceMetrics *metrics = &results->metrics[i];
-        printf("\nBatch Size: %d\n", config->batch_sizes[i]);
-        printf("  Inference Time: %.2f ms\n", metrics->inference_time);
-        printf("  Throughput: %.2f tokens/s\n", metrics->throughput);
-        printf("  Memory Usage: %.2f%%\n", metrics->memory_usage);
-        printf("  CPU Usage: %.2f%%\n", metrics->cpu_usage);
-        printf("  Cache Hit Rate: %.2f%%\n", metrics->cache_hit_rate * 100);
-        printf("  Memory Operations: %zu\n", metrics->memory_operations);
-        printf("  Tensor Reuses: %zu\n", metrics->tensor_reuses);
+static bool setup_audio(Workloads *workloads)
+{
+    TinyAIAudioModelConfig config;
+    memset(&config, 0, sizeof(config));
+    config.featuresConfig.type            = TINYAI_AUDIO_FEATURES_MFCC;
+    config.featuresConfig.frameLength     = 400; // 25ms at 16kHz
+    config.featuresConfig.frameShift      = 160; // 10ms at 16kHz
+    config.featuresConfig.numFilters      = 26;
+    config.featuresConfig.numCoefficients = 13;
+    config.featuresConfig.includeDelta    = true;
+    config.hiddenSize                     = 256;
+    config.numLayers                      = 4;
+    config.numClasses                     = 32;
+    config.use4BitQuantization            = true;
+    config.useSIMD                        = true;
+    config.weightsFile                    = NULL; // Random weights
+
+    workloads->audio_model = tinyaiAudioModelCreate(&config);
+    if (!workloads->audio_model) {
+        printf("Skipping audio: failed to create the model\n");
+        return false;
+    }
+
+    // One-second clips of tones at different pitches
+    for (int c = 0; c < AUDIO_CLIPS; c++) {
+        int16_t *samples = (int16_t *)malloc(AUDIO_SAMPLE_RATE * sizeof(int16_t));
+        if (!samples || !tinyaiAudioModelOutputInit(&workloads->outputs[c], config.numClasses)) {
+            free(samples);
+            printf("Skipping audio: failed to allocate the clips\n");
+            return false;
+        }
+        int period = 20 + 7 * c;
+        for (int i = 0; i < AUDIO_SAMPLE_RATE; i++) {
+            samples[i] = (int16_t)((i % period) * 2000 / period - 1000);
+        }
+        TinyAIAudioData *clip      = &workloads->clips[c];
+        clip->data                 = samples;
+        clip->dataSize             = AUDIO_SAMPLE_RATE * sizeof(int16_t);
+        clip->format.sampleRate    = AUDIO_SAMPLE_RATE;
+        clip->format.channels      = 1;
+        clip->format.bitsPerSample = 16;
+        clip->durationMs           = 1000;
     }
+    workloads->outputs_ready = true;
+    return true;
 }
 
-// Main benchmark function
-int main(int argc, char **argv)
+static bool audio_ready(const Workloads *workloads)
 {
-    // Initialize benchmark configuration
-    BenchmarkConfig config;
-    init_benchmark_config(&config);
+    return workloads->outputs_ready;
+}
 
-    // Initialize memory system
-    TinyAIMemoryConfig mem_config = {.initial_pool_size   = 1024 * 1024 * 1024,
-                                     .max_pool_size       = 2 * 1024 * 1024 * 1024,
-                                     .track_allocations   = true,
-                                     .enable_optimization = true};
-    tinyaiInitMemory(&mem_config);
+static double run_audio(Workloads *workloads)
+{
+    double start = now_ms();
+    if (!tinyaiAudioModelProcessBatch(workloads->audio_model, workloads->clips, AUDIO_CLIPS,
+                                      workloads->outputs)) {
+        return -1.0;
+    }
+    return now_ms() - start;
+}
 
-    // Load model
-    TinyAIModel *model = tinyaiLoadModel(config.model_path);
-    if (!model) {
-        fprintf(stderr, "Failed to load model: %s\n", config.model_path);
-        return 1;
+static int audio_units(const Workloads *workloads)
+{
+    (void)workloads;
+    return AUDIO_CLIPS;
+}
+
+static void release_workloads(Workloads *workloads)
+{
+    tinyaiDestroyKVCache(workloads->cache);
+    free(workloads->logits);
+    free(workloads->tokens);
+    tinyaiDestroyModel(workloads->text_model);
+    tinyaiDestroyTokenizer(workloads->tokenizer);
+    tinyaiImageModelFree(workloads->image_model);
+    tinyaiImageFree(workloads->image);
+    tinyaiAudioModelFree(workloads->audio_model);
+    for (int c = 0; c < AUDIO_CLIPS; c++) {
+        free(workloads->clips[c].data);
+        if (workloads->outputs_ready) {
+            tinyaiAudioModelOutputFree(&workloads->outputs[c]);
+        }
     }
+    memset(workloads, 0, sizeof(*workloads));
+}
 
-    // Configure optimizations
-    if (config.enable_simd) {
-        tinyaiEnableSIMD(model, TINYAI_SIMD_OP_MATRIX_MUL, true);
-        tinyaiEnableSIMD(model, TINYAI_SIMD_OP_CONV, true);
-        tinyaiSetSIMDOptimizationLevel(model, 3);
+static const Workload workloads_table[] = {
+    {"text-prefill", "text", "tokens", text_ready, run_text_prefill, prompt_units},
+    {"text-decode", "text", "tokens", text_decode_ready, run_text_decode, decode_units},
+    {"image-mobilenet", "image", "images", image_ready, run_image, image_units},
+    {"audio-batch", "audio", "clips", audio_ready, run_audio, audio_units},
+};
+
+#define NUM_WORKLOADS ((int)(sizeof(workloads_table) / sizeof(workloads_table[0])))
+
+// ----- Sweep -----
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Time a workload on a pool; false when a run fails
+static bool measure_point(const Workload *workload, Workloads *workloads, int threads,
+                          int repeats, ScalingPoint *point)
+{
+    TinyAIThreadPool *pool = tinyaiCreateThreadPool(threads, 0);
+    if (!pool) {
+        return false;
+    }
+    TinyAIThreadPoolScope scope = tinyaiUseThreadPool(pool);
+
+    // The untimed first run warms caches and lets workers reach their first tasks
+    bool   ok = workload->run(workloads) >= 0.0;
+    double times[64];
+    repeats = repeats < 64 ? repeats : 64;
+    tinyaiThreadPoolTrackBusyTime(pool, true);
+    for (int r = 0; ok && r < repeats; r++) {
+        times[r] = workload->run(workloads);
+        ok       = times[r] >= 0.0;
+    }
+    tinyaiThreadPoolTrackBusyTime(pool, false);
+
+    // Threads that ran no task count as idle, which is part of the imbalance
+    uint64_t busy[MAX_THREADS];
+    int      count = tinyaiThreadPoolGetBusyTime(pool, busy, MAX_THREADS);
+    double   total = 0.0;
+    double   most  = 0.0;
+    for (int t = 0; t < count; t++) {
+        total += (double)busy[t];
+        most = (double)busy[t] > most ? (double)busy[t] : most;
     }
 
-    if (config.enable_cache_opt) {
-        TinyAICacheConfig cache_config = {.block_size        = 64,
-                                          .cache_line_size   = 64,
-                                          .enable_prefetch   = true,
-                                          .prefetch_distance = 2};
-        tinyaiConfigureCacheOptimization(model, &cache_config);
+    tinyaiRestoreThreadPool(scope);
+    tinyaiDestroyThreadPool(pool);
+    if (!ok) {
+        return false;
     }
 
-    if (config.enable_memory_opt) {
-        TinyAIMemoryOptimizerConfig opt_config = {.enable_tensor_reuse   = true,
-                                                  .enable_in_place_ops   = true,
-                                                  .memory_speed_tradeoff = 0.7f,
-                                                  .max_memory_budget     = 768 * 1024 * 1024};
-        TinyAIMemoryOptimizer      *optimizer  = tinyaiCreateMemoryOptimizer(&opt_config);
-        tinyaiSetMemoryOptimizer(model, optimizer);
+    qsort(times, (size_t)repeats, sizeof(double), compare_doubles);
+    point->threads   = threads;
+    point->time_ms   = times[repeats / 2];
+    point->imbalance = total > 0.0 ? most / (total / count) : 1.0;
+    return true;
+}
+
+static bool sweep_workload(const Workload *workload, Workloads *workloads, int max_threads,
+                           int optimal_threads, const PerformanceBenchmarkConfig *config,
+                           ScalingResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->workload = workload;
+    for (int threads = 1; threads <= max_threads; threads++) {
+        if (config->verbose) {
+            printf("Running %s on %d thread(s)...\n", workload->name, threads);
+        }
+        ScalingPoint *point = &result->points[result->count];
+        if (!measure_point(workload, workloads, threads, config->repeats, point)) {
+            printf("Error: %s failed on %d thread(s)\n", workload->name, threads);
+            return result->count > 0;
+        }
+        result->count++;
     }
 
-    // Run benchmarks
-    BenchmarkResults results;
-    memset(&results, 0, sizeof(BenchmarkResults));
+    double serial_ms = result->points[0].time_ms;
+    int    best      = 0;
+    for (int i = 0; i < result->count; i++) {
+        ScalingPoint *point = &result->points[i];
+        point->speedup      = point->time_ms > 0.0 ? serial_ms / point->time_ms : 0.0;
+        point->efficiency   = point->speedup / point->threads;
+        if (point->time_ms < result->points[best].time_ms) {
+            best = i;
+        }
+    }
+    result->best_threads = result->points[best].threads;
+
+    // The determined count is validated against the sweep, which may stop short of it
+    int chosen             = optimal_threads < result->count ? optimal_threads : result->count;
+    result->chosen_threads = chosen;
+    result->chosen_loss =
+        result->points[chosen - 1].time_ms / result->points[best].time_ms - 1.0;
+    return true;
+}
 
-    clock_t start_time = clock();
+// ----- Report -----
 
-    for (int i = 0; i < config.num_batch_sizes; i++) {
-        printf("Running benchmark for batch size %d...\n", config.batch_sizes[i]);
-        run_benchmark_batch(model, &config, config.batch_sizes[i], &results.metrics[i]);
+// Speedup as a bar on a scale of max_threads, with the ideal (linear) speedup marked
+static void plot_speedup(const ScalingPoint *point, int max_threads)
+{
+    int achieved = (int)(point->speedup / max_threads * PLOT_WIDTH + 0.5);
+    int ideal    = (int)((double)point->threads / max_threads * PLOT_WIDTH + 0.5);
+    printf(" |");
+    for (int i = 1; i <= PLOT_WIDTH; i++) {
+        putchar(i <= achieved ? '#' : i == ideal ? '|' : ' ');
     }
+    printf("|");
+}
 
-    results.total_duration = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+static void print_result(const ScalingResult *result, const Workloads *workloads,
+                         int max_threads)
+{
+    const Workload *workload = result->workload;
+    int             units    = workload->units(workloads);
+
+    printf("\n----- %s (%d %s per run) -----\n", workload->name, units, workload->unit);
+    printf("%7s %10s %12s %8s %10s %9s  %s\n", "Threads", "Time ms", "Per second", "Speedup",
+           "Efficiency", "Imbalance", "Speedup (| = linear)");
+    for (int i = 0; i < result->count; i++) {
+        const ScalingPoint *point = &result->points[i];
+        printf("%7d %10.2f %12.2f %7.2fx %9.1f%% %9.2f", point->threads, point->time_ms,
+               point->time_ms > 0.0 ? units * 1000.0 / point->time_ms : 0.0, point->speedup,
+               point->efficiency * 100.0, point->imbalance);
+        plot_speedup(point, max_threads);
+        printf("\n");
+    }
+}
 
-    // Print results
-    print_results(&config, &results);
+static void print_validation(const ScalingResult *results, int count, int optimal_threads,
+                             int max_threads)
+{
+    printf("\n===== Thread Count Validation =====\n");
+    printf("tinyai_determine_optimal_threads: %d\n", optimal_threads);
+    if (optimal_threads > max_threads) {
+        printf("The sweep stops at %d threads, so that count is checked instead\n", max_threads);
+    }
+    printf("%-16s %8s %8s %10s  %s\n", "Workload", "Chosen", "Fastest", "Chosen is", "Verdict");
+    for (int r = 0; r < count; r++) {
+        const ScalingResult *result = &results[r];
+        printf("%-16s %8d %8d %9.1f%%  %s\n", result->workload->name, result->chosen_threads,
+               result->best_threads, result->chosen_loss * 100.0,
+               result->chosen_loss <= NEAR_BEST ? "ok" : "slower than the fastest count");
+    }
+    printf("\"Chosen is\" is how much longer a run takes on the chosen thread count than on\n");
+    printf("the fastest one; within %.0f%% counts as ok.\n", NEAR_BEST * 100.0);
+}
+
+static bool export_csv(const ScalingResult *results, int count, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
 
-    // Cleanup
-    tinyaiFreeModel(model);
-    tinyaiFreeMemory();
+    fprintf(file, "workload,threads,time_ms,speedup,efficiency,imbalance\n");
+    for (int r = 0; r < count; r++) {
+        for (int i = 0; i < results[r].count; i++) {
+            const ScalingPoint *point = &results[r].points[i];
+            fprintf(file, "%s,%d,%.3f,%.4f,%.4f,%.4f\n", results[r].workload->name,
+                    point->threads, point->time_ms, point->speedup, point->efficiency,
+                    point->imbalance);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+static bool export_json(const ScalingResult *results, int count, int optimal_threads,
+                        const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"simd\": \"%s\",\n", tinyai_detect_simd_capabilities());
+    fprintf(file, "  \"optimal_threads\": %d,\n", optimal_threads);
+    fprintf(file, "  \"workloads\": [\n");
+    for (int r = 0; r < count; r++) {
+        const ScalingResult *result = &results[r];
+        fprintf(file, "    {\n");
+        fprintf(file, "      \"name\": \"%s\",\n", result->workload->name);
+        fprintf(file, "      \"chosen_threads\": %d,\n", result->chosen_threads);
+        fprintf(file, "      \"fastest_threads\": %d,\n", result->best_threads);
+        fprintf(file, "      \"chosen_loss\": %.4f,\n", result->chosen_loss);
+        fprintf(file, "      \"points\": [\n");
+        for (int i = 0; i < result->count; i++) {
+            const ScalingPoint *point = &result->points[i];
+            fprintf(file,
+                    "        {\"threads\": %d, \"time_ms\": %.3f, \"speedup\": %.4f, "
+                    "\"efficiency\": %.4f, \"imbalance\": %.4f}%s\n",
+                    point->threads, point->time_ms, point->speedup, point->efficiency,
+                    point->imbalance, i + 1 < result->count ? "," : "");
+        }
+        fprintf(file, "      ]\n");
+        fprintf(file, "    }%s\n", r + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    PerformanceBenchmarkConfig config;
+    memset(&config, 0, sizeof(config));
+    strncpy(config.model_path, DEFAULT_MODEL_PATH, sizeof(config.model_path) - 1);
+    strncpy(config.prompt, DEFAULT_PROMPT, sizeof(config.prompt) - 1);
+    strncpy(config.models, "all", sizeof(config.models) - 1);
+    strncpy(config.export_path, DEFAULT_EXPORT_PATH, sizeof(config.export_path) - 1);
+    config.prompt_length = DEFAULT_PROMPT_LENGTH;
+    config.decode_tokens = DEFAULT_DECODE_TOKENS;
+    config.repeats       = DEFAULT_REPEATS;
+
+    parse_args(argc, argv, &config);
+
+    int optimal_threads = tinyai_determine_optimal_threads();
+    if (optimal_threads < 1) {
+        optimal_threads = 1;
+    }
+    int max_threads = config.max_threads > 0 ? config.max_threads : optimal_threads;
+    max_threads     = max_threads < MAX_THREADS ? max_threads : MAX_THREADS;
+
+    // Ensure the export directory exists
+    mkdir(config.export_path, 0755);
+
+    printf("\n===== TinyAI Thread Scaling Benchmark =====\n");
+    printf("Models: %s\n", config.models);
+    printf("SIMD: %s\n", tinyai_detect_simd_capabilities());
+    printf("Threads: 1..%d (determined optimum: %d)\n", max_threads, optimal_threads);
+    printf("Repeats: %d\n", config.repeats);
+    printf("Export Path: %s\n", config.export_path);
+    printf("===========================================\n\n");
+
+    Workloads workloads;
+    memset(&workloads, 0, sizeof(workloads));
+    if (model_selected(&config, "text")) {
+        setup_text(&config, &workloads);
+    }
+    if (model_selected(&config, "image")) {
+        setup_image(&workloads);
+    }
+    if (model_selected(&config, "audio")) {
+        setup_audio(&workloads);
+    }
+
+    ScalingResult results[NUM_WORKLOADS];
+    int           count = 0;
+    for (int w = 0; w < NUM_WORKLOADS; w++) {
+        const Workload *workload = &workloads_table[w];
+        if (!model_selected(&config, workload->model) || !workload->ready(&workloads)) {
+            continue;
+        }
+        if (sweep_workload(workload, &workloads, max_threads, optimal_threads, &config,
+                           &results[count])) {
+            print_result(&results[count], &workloads, max_threads);
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        printf("Error: No workload ran\n");
+        release_workloads(&workloads);
+        return 1;
+    }
+    print_validation(results, count, optimal_threads, max_threads);
+    release_workloads(&workloads);
+
+    char csv_name[256];
+    char json_name[256];
+    char csv_path[1024];
+    char json_path[1024];
+    tinyai_create_timestamped_filename(csv_name, sizeof(csv_name), "tinyai_thread_scaling", "csv");
+    tinyai_create_timestamped_filename(json_name, sizeof(json_name), "tinyai_thread_scaling",
+                                       "json");
+    snprintf(csv_path, sizeof(csv_path), "%s/%s", config.export_path, csv_name);
+    snprintf(json_path, sizeof(json_path), "%s/%s", config.export_path, json_name);
+
+    printf("\nExporting results...\n");
+    if (export_csv(results, count, csv_path)) {
+        printf("CSV results exported to: %s\n", csv_path);
+    }
+    else {
+        printf("Failed to export CSV results\n");
+    }
+    if (export_json(results, count, optimal_threads, json_path)) {
+        printf("JSON results exported to: %s\n", json_path);
+    }
+    else {
+        printf("Failed to export JSON results\n");
+    }
 
     return 0;
-}
\ No newline at end of file
+}
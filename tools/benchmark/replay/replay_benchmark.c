@@ -0,0 +1,918 @@
+// Traffic replay load generator for the HTTP API
+//
+// Replays a capture of /api/generate requests against a running server and
+// reports time to first token, request and token throughput, and latency
+// histograms with their tail percentiles. Scheduler and batching changes are
+// then measured on the prompt lengths, arrival bursts and sampling settings
+// of real traffic rather than on a synthetic benchmark.
+//
+// Captures are written by the web server when server.capture_file is set:
+// one JSON object per line, in arrival order, with the fields
+//   time_ms        Arrival time in milliseconds (only differences are used)
+//   prompt_tokens  Tokens of the prompt
+//   max_tokens, temperature, top_k, top_p, seed
+//                  Generation parameters, sent as they were
+//   priority       "high", "normal" or "low"
+//   prompt         Prompt text; absent when the capture is redacted
+// A redacted prompt is replaced by prompt_tokens repetitions of a common
+// word, which vocabularies encode as one token each, so prompt lengths match
+// the original approximately.
+//
+// The load is open-loop: every request is sent at its capture time divided
+// by the speed-up, whether or not earlier ones have been answered, so a slow
+// server meets the same arrivals a real one would instead of slowing the
+// load down. Requests that could not be sent on time (every connection slot
+// in use) are reported as late. Every request streams its reply, whatever
+// the original did, since the first token is only visible in a stream.
+// Priority classes are reproduced when the API keys of the high and low
+// classes are given; other requests run as normal.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET ReplaySocket;
+#define REPLAY_INVALID_SOCKET INVALID_SOCKET
+#define poll WSAPoll
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+typedef int ReplaySocket;
+#define REPLAY_INVALID_SOCKET (-1)
+#endif
+
+// Keep a closed server from raising SIGPIPE where the platform allows it
+#ifdef MSG_NOSIGNAL
+#define REPLAY_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define REPLAY_SEND_FLAGS 0
+#endif
+
+// Default configuration values
+#define DEFAULT_HOST "127.0.0.1"
+#define DEFAULT_PORT "8080"
+#define DEFAULT_SPEEDUP 1.0
+#define DEFAULT_TIMEOUT_S 300.0
+#define DEFAULT_MAX_INFLIGHT 512
+#define POLL_INTERVAL_MS 100
+#define RESPONSE_BUFFER 8192
+#define SYNTHETIC_WORD "the "
+
+// Histogram bounds in seconds, the same as the server's /metrics histograms
+#define LATENCY_BUCKETS 12
+static const double k_latency_bounds[LATENCY_BUCKETS] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25,
+                                                         0.5,   1.0,  2.5,   5.0,  10.0, 30.0};
+
+enum { PRIORITY_HIGH, PRIORITY_NORMAL, PRIORITY_LOW };
+
+typedef enum {
+    OUTCOME_PENDING,   // Not sent or not answered yet
+    OUTCOME_COMPLETED, // Streamed to its "done" event
+    OUTCOME_REJECTED,  // Turned away by admission control (429 or 503)
+    OUTCOME_FAILED,    // Another status, an "error" event or a broken connection
+    OUTCOME_TIMED_OUT  // Not answered within the timeout
+} ReplayOutcome;
+
+static const char *const k_outcome_names[] = {"pending", "completed", "rejected", "failed",
+                                              "timed_out"};
+
+typedef struct {
+    char   capture_path[256];
+    char   host[128];
+    char   port[16];
+    char   output_path[256]; // Also write every request's timings here as CSV when set
+    char   key_high[128];    // API key of the high priority class
+    char   key_low[128];     // API key of the low priority class
+    double speedup;          // Capture time is divided by this
+    double max_gap_s;        // Idle gaps longer than this are shortened to it (0 keeps them)
+    double timeout_s;        // Longest a request may take
+    int    limit;            // Replay only the first requests (0 for all)
+    int    max_inflight;     // Most requests in flight at once
+    bool   verbose;
+} ReplayConfig;
+
+// A captured request, and what happened to it in the replay
+typedef struct {
+    double        send_ms;  // When it is due, from the start of the replay
+    int           priority; // Priority class
+    int           prompt_tokens;
+    char         *body;     // JSON body to send
+    ReplayOutcome outcome;
+    int           status;   // HTTP status, 0 when none arrived
+    int           tokens;   // Tokens streamed
+    double        start_ms; // When it was sent
+    double        first_ms; // When its first token arrived, or -1
+    double        end_ms;   // When it was answered, failed or timed out
+} ReplayRequest;
+
+// A request in flight on a connection of its own
+typedef struct {
+    ReplaySocket   socket;
+    ReplayRequest *request;
+    char          *out;     // Request bytes
+    size_t         out_length;
+    size_t         out_sent;
+    char           in[RESPONSE_BUFFER]; // Response bytes not parsed yet
+    size_t         in_length;
+    bool           connected;
+    bool           headers_done;
+} Connection;
+
+// Monotonic time in milliseconds
+static double now_ms(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart * 1000.0 / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+// ----- Capture -----
+
+// Read one line of any length; returns NULL at the end of the file
+static char *read_line(FILE *file)
+{
+    size_t capacity = 1024;
+    size_t length   = 0;
+    char  *line     = (char *)malloc(capacity);
+    while (line && fgets(line + length, (int)(capacity - length), file)) {
+        length += strlen(line + length);
+        if (length > 0 && line[length - 1] == '\n') {
+            return line;
+        }
+        char *grown = (char *)realloc(line, capacity * 2);
+        if (!grown) {
+            break;
+        }
+        line = grown;
+        capacity *= 2;
+    }
+    if (line && length > 0) {
+        return line; // Last line without a newline
+    }
+    free(line);
+    return NULL;
+}
+
+// Start of the value of a field of a capture line, or NULL. The server writes
+// flat objects and escapes the quotes of prompt text, so the first match of
+// the quoted key followed by a colon is the field.
+static const char *capture_field(const char *line, const char *key)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *found = strstr(line, pattern);
+    return found ? found + strlen(pattern) : NULL;
+}
+
+static double capture_number(const char *line, const char *key, double fallback)
+{
+    const char *value = capture_field(line, key);
+    return value ? strtod(value, NULL) : fallback;
+}
+
+// Length of the still-escaped prompt string of a capture line, or -1 without one
+static long capture_prompt(const char *line, const char **prompt)
+{
+    const char *value = capture_field(line, "prompt");
+    if (!value || *value != '"') {
+        return -1;
+    }
+    const char *end = ++value;
+    while (*end && *end != '"') {
+        end += end[0] == '\\' && end[1] ? 2 : 1;
+    }
+    *prompt = value;
+    return *end == '"' ? (long)(end - value) : -1;
+}
+
+// JSON body of a captured request; the prompt is sent still escaped as captured
+static char *request_body(const char *line, int prompt_tokens)
+{
+    const char *prompt    = NULL;
+    long        length    = capture_prompt(line, &prompt);
+    size_t      synthetic = (size_t)prompt_tokens * strlen(SYNTHETIC_WORD);
+    size_t      text      = length >= 0 ? (size_t)length : synthetic;
+    char       *body      = (char *)malloc(text + 256);
+    if (!body) {
+        return NULL;
+    }
+
+    size_t used = (size_t)sprintf(body, "{\"prompt\":\"");
+    if (length >= 0) {
+        memcpy(body + used, prompt, text);
+        used += text;
+    }
+    else {
+        for (int i = 0; i < prompt_tokens; i++) {
+            memcpy(body + used, SYNTHETIC_WORD, strlen(SYNTHETIC_WORD));
+            used += strlen(SYNTHETIC_WORD);
+        }
+        used--; // No trailing space
+    }
+    sprintf(body + used,
+            "\",\"stream\":true,\"max_tokens\":%d,\"temperature\":%.3f,\"top_k\":%d,"
+            "\"top_p\":%.3f,\"seed\":%d}",
+            (int)capture_number(line, "max_tokens", 128), capture_number(line, "temperature", 0.7),
+            (int)capture_number(line, "top_k", 40), capture_number(line, "top_p", 0.9),
+            (int)capture_number(line, "seed", 0));
+    return body;
+}
+
+static int capture_priority(const char *line)
+{
+    const char *value = capture_field(line, "priority");
+    if (value && strncmp(value, "\"high\"", 6) == 0) {
+        return PRIORITY_HIGH;
+    }
+    if (value && strncmp(value, "\"low\"", 5) == 0) {
+        return PRIORITY_LOW;
+    }
+    return PRIORITY_NORMAL;
+}
+
+static void free_requests(ReplayRequest *requests, int count)
+{
+    for (int i = 0; requests && i < count; i++) {
+        free(requests[i].body);
+    }
+    free(requests);
+}
+
+// Load a capture as a schedule of requests; returns the request count or -1
+static int load_capture(const ReplayConfig *config, ReplayRequest **requests_out)
+{
+    FILE *file = fopen(config->capture_path, "r");
+    if (!file) {
+        printf("Error: Cannot open capture %s\n", config->capture_path);
+        return -1;
+    }
+
+    ReplayRequest *requests = NULL;
+    int            count    = 0;
+    int            capacity = 0;
+    double         previous = 0.0; // Capture time of the previous request
+    double         elapsed  = 0.0; // Capture time since the first, with gaps shortened
+    char          *line;
+    while ((config->limit <= 0 || count < config->limit) && (line = read_line(file)) != NULL) {
+        double time = capture_number(line, "time_ms", -1.0);
+        if (time < 0.0) {
+            free(line); // Blank or not a request
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            ReplayRequest *grown =
+                (ReplayRequest *)realloc(requests, (size_t)capacity * sizeof(ReplayRequest));
+            if (!grown) {
+                free(line);
+                break;
+            }
+            requests = grown;
+        }
+
+        // Gaps between appended runs, or a wall clock set back, do not stall the replay
+        double gap = count > 0 ? time - previous : 0.0;
+        if (gap < 0.0) {
+            gap = 0.0;
+        }
+        if (config->max_gap_s > 0.0 && gap > config->max_gap_s * 1000.0) {
+            gap = config->max_gap_s * 1000.0;
+        }
+        elapsed += gap;
+        previous = time;
+
+        ReplayRequest *request = &requests[count];
+        memset(request, 0, sizeof(*request));
+        request->send_ms       = elapsed / config->speedup;
+        request->priority      = capture_priority(line);
+        request->prompt_tokens = (int)capture_number(line, "prompt_tokens", 1);
+        if (request->prompt_tokens < 1) {
+            request->prompt_tokens = 1;
+        }
+        request->body          = request_body(line, request->prompt_tokens);
+        request->first_ms      = -1.0;
+        free(line);
+        if (!request->body) {
+            break;
+        }
+        count++;
+    }
+    fclose(file);
+
+    *requests_out = requests;
+    return count;
+}
+
+// ----- Connections -----
+
+static void close_socket(ReplaySocket socket)
+{
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+static bool socket_would_block(void)
+{
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS;
+#else
+    return errno == EINPROGRESS || errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+// Start connecting a request's socket without blocking; false if it cannot be opened
+static bool open_connection(Connection *conn, const struct addrinfo *address,
+                            const ReplayConfig *config, ReplayRequest *request)
+{
+    const char *key = request->priority == PRIORITY_HIGH  ? config->key_high
+                      : request->priority == PRIORITY_LOW ? config->key_low
+                                                          : "";
+    size_t body_length = strlen(request->body);
+    size_t size        = body_length + strlen(key) + 512;
+
+    memset(conn, 0, sizeof(*conn));
+    conn->socket  = REPLAY_INVALID_SOCKET;
+    conn->request = request;
+    conn->out     = (char *)malloc(size);
+    if (!conn->out) {
+        return false;
+    }
+    conn->out_length = (size_t)snprintf(
+        conn->out, size,
+        "POST /api/generate HTTP/1.1\r\nHost: %s:%s\r\nContent-Type: application/json\r\n"
+        "Accept: text/event-stream\r\n%s%s%sContent-Length: %lu\r\n\r\n%s",
+        config->host, config->port, key[0] ? "X-API-Key: " : "", key, key[0] ? "\r\n" : "",
+        (unsigned long)body_length, request->body);
+
+    conn->socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (conn->socket == REPLAY_INVALID_SOCKET) {
+        return false;
+    }
+#ifdef _WIN32
+    u_long non_blocking = 1;
+    ioctlsocket(conn->socket, FIONBIO, &non_blocking);
+#else
+    fcntl(conn->socket, F_SETFL, fcntl(conn->socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    int on = 1;
+    setsockopt(conn->socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(conn->socket, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&on, sizeof(on));
+#endif
+
+    if (connect(conn->socket, address->ai_addr, (int)address->ai_addrlen) == 0) {
+        conn->connected = true;
+    }
+    else if (!socket_would_block()) {
+        return false;
+    }
+    return true;
+}
+
+// End a request and free its connection
+static void close_connection(Connection *conn, ReplayOutcome outcome, double now)
+{
+    ReplayRequest *request = conn->request;
+    if (request) {
+        request->outcome = outcome;
+        request->end_ms  = now;
+    }
+    if (conn->socket != REPLAY_INVALID_SOCKET) {
+        close_socket(conn->socket);
+    }
+    free(conn->out);
+    memset(conn, 0, sizeof(*conn));
+    conn->socket = REPLAY_INVALID_SOCKET;
+}
+
+// Parse the response bytes received so far; returns the request's outcome
+// once it is known, or OUTCOME_PENDING
+static ReplayOutcome parse_response(Connection *conn, double now)
+{
+    ReplayRequest *request = conn->request;
+
+    if (!conn->headers_done) {
+        char *end = NULL;
+        for (size_t i = 0; i + 3 < conn->in_length && !end; i++) {
+            if (memcmp(conn->in + i, "\r\n\r\n", 4) == 0) {
+                end = conn->in + i + 4;
+            }
+        }
+        if (!end) {
+            return conn->in_length == sizeof(conn->in) ? OUTCOME_FAILED : OUTCOME_PENDING;
+        }
+        int status = 0;
+        if (sscanf(conn->in, "HTTP/%*d.%*d %d", &status) != 1) {
+            return OUTCOME_FAILED;
+        }
+        request->status = status;
+        if (status != 200) {
+            return status == 429 || status == 503 ? OUTCOME_REJECTED : OUTCOME_FAILED;
+        }
+        conn->headers_done = true;
+        conn->in_length -= (size_t)(end - conn->in);
+        memmove(conn->in, end, conn->in_length);
+    }
+
+    // Server-Sent Events end with a blank line; a token event is
+    // data: {"token":<id>,...}, and the flush of held-back bytes has id -1
+    size_t start = 0;
+    for (size_t i = 0; i + 1 < conn->in_length; i++) {
+        if (conn->in[i] != '\n' || conn->in[i + 1] != '\n') {
+            continue;
+        }
+        const char *event = conn->in + start;
+        size_t      size  = i - start;
+        start             = i + 2;
+        if (size >= 11 && memcmp(event, "event: done", 11) == 0) {
+            return OUTCOME_COMPLETED;
+        }
+        if (size >= 12 && memcmp(event, "event: error", 12) == 0) {
+            return OUTCOME_FAILED;
+        }
+        if (size >= 16 && memcmp(event, "data: {\"token\":", 15) == 0 && event[15] != '-') {
+            if (request->tokens++ == 0) {
+                request->first_ms = now;
+            }
+        }
+    }
+    conn->in_length -= start;
+    memmove(conn->in, conn->in + start, conn->in_length);
+
+    // An event too large for the buffer is skipped, as its text is not needed
+    if (conn->in_length == sizeof(conn->in)) {
+        conn->in_length = 0;
+    }
+    return OUTCOME_PENDING;
+}
+
+// Advance a connection whose socket is ready; returns the outcome once known
+static ReplayOutcome service_connection(Connection *conn, short revents, double now)
+{
+    if (!conn->connected) {
+        int       error  = 0;
+        socklen_t length = sizeof(error);
+        if (getsockopt(conn->socket, SOL_SOCKET, SO_ERROR, (char *)&error, &length) != 0 ||
+            error != 0) {
+            return OUTCOME_FAILED;
+        }
+        conn->connected = true;
+    }
+
+    while (conn->out_sent < conn->out_length) {
+        int sent = (int)send(conn->socket, conn->out + conn->out_sent,
+                             (int)(conn->out_length - conn->out_sent), REPLAY_SEND_FLAGS);
+        if (sent <= 0) {
+            return sent < 0 && socket_would_block() ? OUTCOME_PENDING : OUTCOME_FAILED;
+        }
+        conn->out_sent += (size_t)sent;
+    }
+
+    if (!(revents & (POLLIN | POLLHUP | POLLERR))) {
+        return OUTCOME_PENDING;
+    }
+    for (;;) {
+        int received = (int)recv(conn->socket, conn->in + conn->in_length,
+                                 (int)(sizeof(conn->in) - conn->in_length), 0);
+        if (received == 0) {
+            return OUTCOME_FAILED; // Closed before the end of the reply
+        }
+        if (received < 0) {
+            return socket_would_block() ? OUTCOME_PENDING : OUTCOME_FAILED;
+        }
+        conn->in_length += (size_t)received;
+        ReplayOutcome outcome = parse_response(conn, now);
+        if (outcome != OUTCOME_PENDING) {
+            return outcome;
+        }
+    }
+}
+
+// ----- Replay -----
+
+// Send every request on its schedule and wait for all of them; returns the
+// replay's duration in milliseconds
+static double replay(const ReplayConfig *config, const struct addrinfo *address,
+                     ReplayRequest *requests, int count)
+{
+    Connection    *conns = (Connection *)calloc((size_t)config->max_inflight, sizeof(Connection));
+    struct pollfd *fds   = (struct pollfd *)calloc((size_t)config->max_inflight,
+                                                   sizeof(struct pollfd));
+    int           *slots = (int *)calloc((size_t)config->max_inflight, sizeof(int));
+    if (!conns || !fds || !slots) {
+        free(conns);
+        free(fds);
+        free(slots);
+        return -1.0;
+    }
+    for (int i = 0; i < config->max_inflight; i++) {
+        conns[i].socket = REPLAY_INVALID_SOCKET;
+    }
+
+    double start    = now_ms();
+    int    next     = 0; // Next request to send
+    int    inflight = 0;
+    int    free_slot = 0;
+    while (next < count || inflight > 0) {
+        double now = now_ms() - start;
+
+        // Send everything due; without a free slot the rest go out late
+        while (next < count && requests[next].send_ms <= now && inflight < config->max_inflight) {
+            while (conns[free_slot].request) {
+                free_slot = (free_slot + 1) % config->max_inflight;
+            }
+            Connection    *conn    = &conns[free_slot];
+            ReplayRequest *request = &requests[next++];
+            request->start_ms      = now;
+            if (!open_connection(conn, address, config, request)) {
+                close_connection(conn, OUTCOME_FAILED, now);
+                continue;
+            }
+            inflight++;
+            if (config->verbose) {
+                printf("[%9.1f ms] Request %d sent (%d prompt tokens)\n", now,
+                       (int)(request - requests), request->prompt_tokens);
+            }
+        }
+
+        // Wait for the sockets, or until the next request is due
+        int polled = 0;
+        for (int i = 0; i < config->max_inflight; i++) {
+            if (!conns[i].request) {
+                continue;
+            }
+            fds[polled].fd      = conns[i].socket;
+            fds[polled].events  = conns[i].connected && conns[i].out_sent == conns[i].out_length
+                                      ? POLLIN
+                                      : POLLOUT;
+            fds[polled].revents = 0;
+            slots[polled++]     = i;
+        }
+        double wait = POLL_INTERVAL_MS;
+        if (next < count && inflight < config->max_inflight) {
+            wait = requests[next].send_ms - now;
+            wait = wait < 0.0 ? 0.0 : wait > POLL_INTERVAL_MS ? POLL_INTERVAL_MS : wait;
+        }
+        if (polled > 0) {
+            poll(fds, (unsigned long)polled, (int)ceil(wait));
+        }
+        else if (wait >= 1.0) {
+#ifdef _WIN32
+            Sleep((DWORD)wait);
+#else
+            struct timespec pause = {0, (long)(wait * 1000000.0)};
+            nanosleep(&pause, NULL);
+#endif
+        }
+
+        now = now_ms() - start;
+        for (int p = 0; p < polled; p++) {
+            Connection   *conn    = &conns[slots[p]];
+            ReplayOutcome outcome = OUTCOME_PENDING;
+            if (fds[p].revents) {
+                outcome = service_connection(conn, fds[p].revents, now);
+            }
+            if (outcome == OUTCOME_PENDING &&
+                now - conn->request->start_ms > config->timeout_s * 1000.0) {
+                outcome = OUTCOME_TIMED_OUT;
+            }
+            if (outcome != OUTCOME_PENDING) {
+                if (config->verbose) {
+                    printf("[%9.1f ms] Request %d %s (%d tokens)\n", now,
+                           (int)(conn->request - requests), k_outcome_names[outcome],
+                           conn->request->tokens);
+                }
+                close_connection(conn, outcome, now);
+                inflight--;
+            }
+        }
+    }
+
+    free(conns);
+    free(fds);
+    free(slots);
+    return now_ms() - start;
+}
+
+// ----- Report -----
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, int count, double p)
+{
+    int rank = (int)ceil(p / 100.0 * count);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Percentiles and a histogram of latencies in milliseconds
+static void print_distribution(const char *name, double *values, int count)
+{
+    if (count == 0) {
+        printf("\n%s: no samples\n", name);
+        return;
+    }
+    qsort(values, (size_t)count, sizeof(double), compare_doubles);
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    printf("\n%s (%d samples, ms)\n", name, count);
+    printf("  mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", sum / count,
+           percentile(values, count, 50.0), percentile(values, count, 90.0),
+           percentile(values, count, 99.0), percentile(values, count, 99.9), values[count - 1]);
+
+    int buckets[LATENCY_BUCKETS + 1] = {0};
+    int largest                      = 0;
+    for (int i = 0; i < count; i++) {
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS && values[i] / 1000.0 > k_latency_bounds[bucket]) {
+            bucket++;
+        }
+        buckets[bucket]++;
+    }
+    for (int b = 0; b <= LATENCY_BUCKETS; b++) {
+        largest = buckets[b] > largest ? buckets[b] : largest;
+    }
+    for (int b = 0; b <= LATENCY_BUCKETS; b++) {
+        char bound[32];
+        if (b < LATENCY_BUCKETS) {
+            snprintf(bound, sizeof(bound), "<= %g s", k_latency_bounds[b]);
+        }
+        else {
+            snprintf(bound, sizeof(bound), "> %g s", k_latency_bounds[LATENCY_BUCKETS - 1]);
+        }
+        int width = largest > 0 ? (buckets[b] * 40 + largest - 1) / largest : 0;
+        printf("  %-10s %7d %6.1f%%%s%.*s\n", bound, buckets[b], 100.0 * buckets[b] / count,
+               width ? " " : "", width, "########################################");
+    }
+}
+
+static void print_report(const ReplayRequest *requests, int count, double duration_ms)
+{
+    int     outcomes[OUTCOME_TIMED_OUT + 1] = {0};
+    int     late                            = 0;
+    double  max_lag                         = 0.0;
+    long    tokens                          = 0;
+    double *ttft    = (double *)malloc((size_t)(count > 0 ? count : 1) * sizeof(double));
+    double *latency = (double *)malloc((size_t)(count > 0 ? count : 1) * sizeof(double));
+    double *tpot    = (double *)malloc((size_t)(count > 0 ? count : 1) * sizeof(double));
+    int     num_ttft    = 0;
+    int     num_latency = 0;
+    int     num_tpot    = 0;
+    if (!ttft || !latency || !tpot) {
+        free(ttft);
+        free(latency);
+        free(tpot);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const ReplayRequest *request = &requests[i];
+        double               lag     = request->start_ms - request->send_ms;
+        outcomes[request->outcome]++;
+        tokens += request->tokens;
+        late += lag > 1.0;
+        max_lag = lag > max_lag ? lag : max_lag;
+        if (request->first_ms >= 0.0) {
+            ttft[num_ttft++] = request->first_ms - request->start_ms;
+        }
+        if (request->outcome == OUTCOME_COMPLETED) {
+            latency[num_latency++] = request->end_ms - request->start_ms;
+            if (request->tokens > 1) {
+                tpot[num_tpot++] =
+                    (request->end_ms - request->first_ms) / (double)(request->tokens - 1);
+            }
+        }
+    }
+
+    double span    = count > 0 ? requests[count - 1].send_ms / 1000.0 : 0.0;
+    double seconds = duration_ms / 1000.0;
+    printf("\n===== Replay Results =====\n");
+    printf("Requests:    %d sent over %.1f s (%.2f/s offered)\n", count, span,
+           span > 0.0 ? count / span : 0.0);
+    printf("Completed:   %d\n", outcomes[OUTCOME_COMPLETED]);
+    printf("Rejected:    %d (429/503)\n", outcomes[OUTCOME_REJECTED]);
+    printf("Failed:      %d\n", outcomes[OUTCOME_FAILED]);
+    printf("Timed out:   %d\n", outcomes[OUTCOME_TIMED_OUT]);
+    printf("Sent late:   %d (max %.1f ms behind schedule)\n", late, max_lag);
+    printf("Duration:    %.2f s\n", seconds);
+    printf("Throughput:  %.2f requests/s, %.1f tokens/s\n",
+           seconds > 0.0 ? outcomes[OUTCOME_COMPLETED] / seconds : 0.0,
+           seconds > 0.0 ? tokens / seconds : 0.0);
+
+    print_distribution("Time to first token", ttft, num_ttft);
+    print_distribution("Request latency", latency, num_latency);
+    print_distribution("Time per output token", tpot, num_tpot);
+
+    free(ttft);
+    free(latency);
+    free(tpot);
+}
+
+// Every request's timings as CSV, times in milliseconds from the start
+static bool write_results(const char *path, const ReplayRequest *requests, int count)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        printf("Error: Cannot write %s\n", path);
+        return false;
+    }
+    fprintf(file, "request,priority,prompt_tokens,due_ms,sent_ms,outcome,status,tokens,"
+                  "ttft_ms,latency_ms\n");
+    for (int i = 0; i < count; i++) {
+        const ReplayRequest *request = &requests[i];
+        fprintf(file, "%d,%d,%d,%.3f,%.3f,%s,%d,%d,%.3f,%.3f\n", i, request->priority,
+                request->prompt_tokens, request->send_ms, request->start_ms,
+                k_outcome_names[request->outcome], request->status, request->tokens,
+                request->first_ms >= 0.0 ? request->first_ms - request->start_ms : -1.0,
+                request->end_ms - request->start_ms);
+    }
+    return fclose(file) == 0;
+}
+
+// ----- Driver -----
+
+void print_usage(const char *program_name)
+{
+    printf("Usage: %s -capture <file> [options]\n\n", program_name);
+    printf("Options:\n");
+    printf("  -capture <file>         Capture written by the server's server.capture_file\n");
+    printf("  -host <host>            Server host (default: %s)\n", DEFAULT_HOST);
+    printf("  -port <port>            Server port (default: %s)\n", DEFAULT_PORT);
+    printf("  -speedup <x>            Replay x times faster than captured (default: %.1f)\n",
+           DEFAULT_SPEEDUP);
+    printf("  -max_gap <s>            Shorten idle gaps in the capture to s seconds\n");
+    printf("  -limit <n>              Replay only the first n requests\n");
+    printf("  -max_inflight <n>       Most requests in flight at once (default: %d)\n",
+           DEFAULT_MAX_INFLIGHT);
+    printf("  -timeout <s>            Longest a request may take (default: %.0f)\n",
+           DEFAULT_TIMEOUT_S);
+    printf("  -key_high <key>         API key to send high priority requests with\n");
+    printf("  -key_low <key>          API key to send low priority requests with\n");
+    printf("  -output <path>          Also write every request's timings as CSV\n");
+    printf("  -v                      Verbose output\n");
+    printf("  -h                      Display this help message\n");
+    printf("\n");
+}
+
+// Parse command line arguments and set configuration
+void parse_args(int argc, char **argv, ReplayConfig *config)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-capture") == 0 && i + 1 < argc) {
+            strncpy(config->capture_path, argv[++i], sizeof(config->capture_path) - 1);
+        }
+        else if (strcmp(argv[i], "-host") == 0 && i + 1 < argc) {
+            strncpy(config->host, argv[++i], sizeof(config->host) - 1);
+        }
+        else if (strcmp(argv[i], "-port") == 0 && i + 1 < argc) {
+            strncpy(config->port, argv[++i], sizeof(config->port) - 1);
+        }
+        else if (strcmp(argv[i], "-speedup") == 0 && i + 1 < argc) {
+            config->speedup = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-max_gap") == 0 && i + 1 < argc) {
+            config->max_gap_s = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-limit") == 0 && i + 1 < argc) {
+            config->limit = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-max_inflight") == 0 && i + 1 < argc) {
+            config->max_inflight = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-timeout") == 0 && i + 1 < argc) {
+            config->timeout_s = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-key_high") == 0 && i + 1 < argc) {
+            strncpy(config->key_high, argv[++i], sizeof(config->key_high) - 1);
+        }
+        else if (strcmp(argv[i], "-key_low") == 0 && i + 1 < argc) {
+            strncpy(config->key_low, argv[++i], sizeof(config->key_low) - 1);
+        }
+        else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc) {
+            strncpy(config->output_path, argv[++i], sizeof(config->output_path) - 1);
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            config->verbose = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!config->capture_path[0]) {
+        printf("Error: No capture given\n");
+        print_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (config->speedup <= 0.0) {
+        config->speedup = DEFAULT_SPEEDUP;
+    }
+    if (config->max_inflight < 1) {
+        config->max_inflight = 1;
+    }
+    if (config->timeout_s <= 0.0) {
+        config->timeout_s = DEFAULT_TIMEOUT_S;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ReplayConfig config;
+    memset(&config, 0, sizeof(config));
+    strncpy(config.host, DEFAULT_HOST, sizeof(config.host) - 1);
+    strncpy(config.port, DEFAULT_PORT, sizeof(config.port) - 1);
+    config.speedup      = DEFAULT_SPEEDUP;
+    config.timeout_s    = DEFAULT_TIMEOUT_S;
+    config.max_inflight = DEFAULT_MAX_INFLIGHT;
+
+    parse_args(argc, argv, &config);
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        printf("Error: Cannot initialize sockets\n");
+        return 1;
+    }
+#endif
+
+    ReplayRequest *requests = NULL;
+    int            count    = load_capture(&config, &requests);
+    if (count <= 0) {
+        if (count == 0) {
+            printf("Error: No requests in %s\n", config.capture_path);
+        }
+        free_requests(requests, count);
+        return 1;
+    }
+
+    struct addrinfo  hints;
+    struct addrinfo *address = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(config.host, config.port, &hints, &address) != 0 || !address) {
+        printf("Error: Cannot resolve %s:%s\n", config.host, config.port);
+        free_requests(requests, count);
+        return 1;
+    }
+
+    printf("\n===== TinyAI Traffic Replay =====\n");
+    printf("Capture: %s (%d requests)\n", config.capture_path, count);
+    printf("Server: %s:%s\n", config.host, config.port);
+    printf("Speed-up: %.2fx\n", config.speedup);
+    printf("=================================\n");
+
+    double duration = replay(&config, address, requests, count);
+    freeaddrinfo(address);
+    if (duration < 0.0) {
+        printf("Error: Out of memory\n");
+        free_requests(requests, count);
+        return 1;
+    }
+
+    print_report(requests, count, duration);
+    bool written = !config.output_path[0] || write_results(config.output_path, requests, count);
+    free_requests(requests, count);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return written ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include "../benchmark_utils.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,22 +13,11 @@
 #include <unistd.h> // For gethostname
 #endif
 
-// Text generation parameters structure (this would normally be defined in models/text/generate.h)
-typedef struct {
-    float temperature; // Temperature for token sampling
-    int   top_k;       // Top-k for token sampling
-    float top_p;       // Top-p (nucleus) for token sampling
-    int   max_tokens;  // Maximum tokens to generate
-    int   num_threads; // Number of threads to use
-    bool  use_simd;    // Whether to use SIMD acceleration
-} TextGenerationParams;
-
 // TinyAI includes
 #include "../../../core/config.h"
 #include "../../../models/text/generate.h"
-#include "../../../utils/forward_scheduler.h"
-#include "../../../utils/mmap_loader.h"
-#include "../../../utils/model_loader.h"
+#include "../../../models/text/tokenizer.h"
+#include "../../../utils/thread_pool.h"
 
 // Default configuration values
 #define DEFAULT_ITERATIONS 5
@@ -37,53 +27,105 @@ typedef struct {
 #define DEFAULT_TEMPERATURE 0.7
 #define DEFAULT_SIMD_ENABLED 1
 #define DEFAULT_NUM_THREADS 0 // Auto-detect
-#define DEFAULT_MEMORY_MAPPING 1
-#define DEFAULT_MEMORY_LIMIT (200 * 1024 * 1024) // 200MB
 #define DEFAULT_EXPORT_PATH "./benchmark_results"
 #define DEFAULT_MODEL_PATH "models/pretrained/text_small.tmai"
 #define DEFAULT_COMPARE_FRAMEWORKS 0
 
+// Most values one sweep option takes
+#define MAX_SWEEP 16
+
 typedef struct {
-    char   prompt[256];
-    int    max_tokens;
-    float  temperature;
-    int    top_k;
-    float  top_p;
-    int    context_size;
-    int    use_mmap;
-    size_t memory_limit;
+    char  prompt[256];
+    int   max_tokens;
+    float temperature;
+    int   top_k;
+    float top_p;
+    char  weights_path[256];   // Defaults to the model path
+    char  tokenizer_path[256]; // Required unless loading a snapshot
+    char  snapshot_path[256];  // Model snapshot, used instead of the model files when set
+
+    // Sweep: every combination of these is measured
+    int prompt_lengths[MAX_SWEEP]; // Prompt tokens (0 = the prompt as encoded)
+    int num_prompt_lengths;
+    int batch_sizes[MAX_SWEEP]; // Sequences generated together
+    int num_batch_sizes;
+    int thread_counts[MAX_SWEEP]; // Threads (0 = one per online CPU)
+    int num_thread_counts;
 } TextBenchmarkConfig;
 
+// Timing of one sequence of a run, updated by its token callback
+typedef struct {
+    double  start_ms;      // When the run started
+    double  first_ms;      // When the first token arrived
+    double  last_ms;       // When the latest token arrived
+    int     tokens;        // Tokens generated
+    double *itl;           // Inter-token latency samples (NULL while warming up)
+    int    *itl_count;     // Samples in itl
+    int     itl_capacity;  // Room in itl
+} SequenceTiming;
+
 void print_usage(const char *program_name)
 {
     printf("Usage: %s [options]\n\n", program_name);
     printf("Options:\n");
     printf("  -model <path>           Path to TinyAI model file (default: %s)\n",
            DEFAULT_MODEL_PATH);
+    printf("  -weights <path>         Path to the weights file (default: the model file)\n");
+    printf("  -tokenizer <path>       Path to the vocabulary file\n");
+    printf("  -snapshot <path>        Load a model snapshot instead of the model files\n");
     printf("  -prompt <text>          Prompt text (default: \"%s\")\n", DEFAULT_PROMPT);
+    printf("  -prompt_lengths <list>  Prompt lengths in tokens to sweep, e.g. 16,128,512\n");
+    printf("                          (default: the prompt as encoded)\n");
+    printf("  -batch <list>           Batch sizes to sweep, e.g. 1,4,8 (default: 1)\n");
     printf("  -max_tokens <n>         Maximum tokens to generate (default: %d)\n",
            DEFAULT_MAX_TOKENS);
     printf("  -temp <t>               Temperature (default: %.2f)\n", DEFAULT_TEMPERATURE);
     printf("  -top_k <k>              Top-k sampling parameter (default: 40)\n");
     printf("  -top_p <p>              Top-p sampling parameter (default: 0.95)\n");
     printf("  -iter <n>               Number of iterations (default: %d)\n", DEFAULT_ITERATIONS);
-    printf("  -warmup <n>             Number of warmup iterations (default: %d)\n",
+    printf("  -warmup <n>             Warmup iterations per configuration (default: %d)\n",
            DEFAULT_WARMUP_ITERATIONS);
     printf("  -simd <0|1>             Enable/disable SIMD (default: %d)\n", DEFAULT_SIMD_ENABLED);
-    printf("  -threads <n>            Number of threads (0 for auto) (default: %d)\n",
+    printf("  -threads <list>         Thread counts to sweep (0 for auto) (default: %d)\n",
            DEFAULT_NUM_THREADS);
-    printf("  -mmap <0|1>             Enable/disable memory mapping (default: %d)\n",
-           DEFAULT_MEMORY_MAPPING);
-    printf("  -memory <n>             Memory limit in MB (default: %d)\n",
-           DEFAULT_MEMORY_LIMIT / (1024 * 1024));
     printf("  -export <path>          Export results path (default: %s)\n", DEFAULT_EXPORT_PATH);
     printf("  -compare <0|1>          Compare with other frameworks (default: %d)\n",
            DEFAULT_COMPARE_FRAMEWORKS);
+    printf("  -counters               Collect hardware counters over the measured runs\n");
     printf("  -v                      Verbose output\n");
     printf("  -h                      Display this help message\n");
     printf("\n");
 }
 
+// Parse a comma-separated list of non-negative integers, returning how many were read
+static int parse_list(const char *text, int *values, int max_values)
+{
+    int count = 0;
+    while (*text && count < max_values) {
+        char *end;
+        long  value = strtol(text, &end, 10);
+        if (end == text || value < 0) {
+            return 0;
+        }
+        values[count++] = (int)value;
+        text            = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return 0;
+        }
+    }
+    return count;
+}
+
+static void parse_list_option(const char *option, const char *text, int *values, int *count)
+{
+    int parsed = parse_list(text, values, MAX_SWEEP);
+    if (parsed == 0) {
+        printf("Invalid list for %s: %s\n", option, text);
+        exit(EXIT_FAILURE);
+    }
+    *count = parsed;
+}
+
 // Parse command line arguments and set configuration
 void parse_args(int argc, char **argv, TinyAIBenchmarkConfig *config,
                 TextBenchmarkConfig *text_config)
@@ -92,9 +134,30 @@ void parse_args(int argc, char **argv, TinyAIBenchmarkConfig *config,
         if (strcmp(argv[i], "-model") == 0 && i + 1 < argc) {
             strncpy(config->model_path, argv[++i], sizeof(config->model_path) - 1);
         }
+        else if (strcmp(argv[i], "-weights") == 0 && i + 1 < argc) {
+            strncpy(text_config->weights_path, argv[++i], sizeof(text_config->weights_path) - 1);
+        }
+        else if (strcmp(argv[i], "-tokenizer") == 0 && i + 1 < argc) {
+            strncpy(text_config->tokenizer_path, argv[++i],
+                    sizeof(text_config->tokenizer_path) - 1);
+        }
+        else if (strcmp(argv[i], "-snapshot") == 0 && i + 1 < argc) {
+            strncpy(text_config->snapshot_path, argv[++i],
+                    sizeof(text_config->snapshot_path) - 1);
+        }
         else if (strcmp(argv[i], "-prompt") == 0 && i + 1 < argc) {
             strncpy(text_config->prompt, argv[++i], sizeof(text_config->prompt) - 1);
         }
+        else if (strcmp(argv[i], "-prompt_lengths") == 0 && i + 1 < argc) {
+            parse_list_option(argv[i], argv[i + 1], text_config->prompt_lengths,
+                              &text_config->num_prompt_lengths);
+            i++;
+        }
+        else if (strcmp(argv[i], "-batch") == 0 && i + 1 < argc) {
+            parse_list_option(argv[i], argv[i + 1], text_config->batch_sizes,
+                              &text_config->num_batch_sizes);
+            i++;
+        }
         else if (strcmp(argv[i], "-max_tokens") == 0 && i + 1 < argc) {
             text_config->max_tokens = atoi(argv[++i]);
         }
@@ -117,15 +180,10 @@ void parse_args(int argc, char **argv, TinyAIBenchmarkConfig *config,
             config->use_simd = atoi(argv[++i]) != 0;
         }
         else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc) {
-            config->num_threads = atoi(argv[++i]);
-        }
-        else if (strcmp(argv[i], "-mmap") == 0 && i + 1 < argc) {
-            text_config->use_mmap      = atoi(argv[++i]) != 0;
-            config->use_memory_mapping = text_config->use_mmap;
-        }
-        else if (strcmp(argv[i], "-memory") == 0 && i + 1 < argc) {
-            text_config->memory_limit =
-                (size_t)atoi(argv[++i]) * 1024 * 1024; // Convert MB to bytes
+            parse_list_option(argv[i], argv[i + 1], text_config->thread_counts,
+                              &text_config->num_thread_counts);
+            config->num_threads = text_config->thread_counts[0];
+            i++;
         }
         else if (strcmp(argv[i], "-export") == 0 && i + 1 < argc) {
             strncpy(config->export_path, argv[++i], sizeof(config->export_path) - 1);
@@ -133,6 +191,9 @@ void parse_args(int argc, char **argv, TinyAIBenchmarkConfig *config,
         else if (strcmp(argv[i], "-compare") == 0 && i + 1 < argc) {
             config->compare_frameworks = atoi(argv[++i]) != 0;
         }
+        else if (strcmp(argv[i], "-counters") == 0) {
+            config->hw_counters = true;
+        }
         else if (strcmp(argv[i], "-v") == 0) {
             config->verbose = true;
         }
@@ -146,213 +207,360 @@ void parse_args(int argc, char **argv, TinyAIBenchmarkConfig *config,
             exit(EXIT_FAILURE);
         }
     }
-}
-
-// Function to benchmark TinyAI text model
-void benchmark_tinyai_text(TinyAIBenchmarkConfig *config, TextBenchmarkConfig *text_config,
-                           TinyAIBenchmarkResult *result)
-{
-    // Initialize result
-    tinyai_init_benchmark_result(result);
-
-    // Set model name
-    strncpy(result->model_name, config->model_path, sizeof(result->model_name) - 1);
 
-    // Get device name (hostname)
-    char hostname[64] = "unknown";
-#ifdef _WIN32
-    DWORD size = sizeof(hostname);
-    GetComputerNameA(hostname, &size);
-#else
-    gethostname(hostname, sizeof(hostname));
-#endif
-    strncpy(result->device_name, hostname, sizeof(result->device_name) - 1);
-
-    // Detect SIMD capabilities
-    result->simd_used = config->use_simd;
-    strncpy(result->simd_type, tinyai_detect_simd_capabilities(), sizeof(result->simd_type) - 1);
-
-    // Set number of threads
-    result->threads_used =
-        config->num_threads > 0 ? config->num_threads : tinyai_determine_optimal_threads();
-
-    // Load model
-    void                   *model      = NULL;
-    TinyAIMappedModel      *mmap_model = NULL;
-    TinyAIForwardScheduler *scheduler  = NULL;
-
-    if (text_config->use_mmap) {
-        // Use memory mapping for model loading
-        TinyAIMmapConfig mmap_config = tinyaiCreateDefaultMmapConfig();
-        mmap_config.maxCacheSize     = config->cache_size_bytes;
-        mmap_config.prefetchEnabled  = true;
-
-        mmap_model = tinyaiOpenMappedModel(config->model_path, &mmap_config);
-        if (!mmap_model) {
-            printf("Error: Failed to load memory-mapped model: %s\n", config->model_path);
-            exit(EXIT_FAILURE);
-        }
-
-        // Create forward scheduler
-        scheduler = tinyaiCreateForwardScheduler(mmap_model, TINYAI_EXEC_MEMORY_OPT,
-                                                 text_config->memory_limit);
-        if (!scheduler) {
-            printf("Error: Failed to create forward scheduler\n");
-            tinyaiCloseMappedModel(mmap_model);
-            exit(EXIT_FAILURE);
-        }
+    if (config->num_iterations < 1) {
+        config->num_iterations = 1;
     }
-    else {
-        // Load model normally
-        model = tinyai_load_model(config->model_path);
-        if (!model) {
-            printf("Error: Failed to load model: %s\n", config->model_path);
+    if (config->warmup_iterations < 0) {
+        config->warmup_iterations = 0;
+    }
+    if (text_config->max_tokens < 1) {
+        text_config->max_tokens = 1;
+    }
+    for (int i = 0; i < text_config->num_batch_sizes; i++) {
+        if (text_config->batch_sizes[i] < 1) {
+            printf("Batch sizes must be at least 1\n");
             exit(EXIT_FAILURE);
         }
     }
+}
 
-    // Get model size
-    result->model_size_bytes = 0; // TODO: Implement model size calculation
-
-    // Prepare text generation parameters
-    TextGenerationParams params;
-    params.temperature = text_config->temperature;
-    params.top_k       = text_config->top_k;
-    params.top_p       = text_config->top_p;
-    params.max_tokens  = text_config->max_tokens;
-    params.num_threads = result->threads_used;
-    params.use_simd    = result->simd_used;
+static double now_ms(void)
+{
+    struct timespec now;
+    tinyai_benchmark_start_timer(&now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
 
-    // Arrays to store timing results
-    double *inference_times = (double *)malloc(config->num_iterations * sizeof(double));
-    size_t *memory_usages   = (size_t *)malloc(config->num_iterations * sizeof(size_t));
+// Token callback: time to first token, then the gap since the previous token
+static bool record_token(int token, const char *piece, void *user_data)
+{
+    SequenceTiming *timing = (SequenceTiming *)user_data;
+    double          now    = now_ms();
+    (void)token;
+    (void)piece;
 
-    // Perform warmup iterations
-    if (config->verbose) {
-        printf("Performing %d warmup iterations...\n", config->warmup_iterations);
+    if (timing->tokens == 0) {
+        timing->first_ms = now;
     }
+    else if (timing->itl && *timing->itl_count < timing->itl_capacity) {
+        timing->itl[(*timing->itl_count)++] = now - timing->last_ms;
+    }
+    timing->last_ms = now;
+    timing->tokens++;
+    return true;
+}
 
-    for (int i = 0; i < config->warmup_iterations; i++) {
-        char output[1024] = {0};
-
-        if (text_config->use_mmap) {
-            // TODO: Generate text with memory-mapped model and scheduler
-        }
-        else {
-            // Generate text with regular model
-            // In a real implementation, we would call the text generation function here
-            // tinyai_generate_text(model, text_config->prompt, output, sizeof(output), &params);
-        }
-
-        if (config->verbose) {
-            printf("Warmup %d: Generated %zu characters\n", i + 1, strlen(output));
+// Measurements of one run of a batch
+typedef struct {
+    double total_ms;       // Whole run
+    double prefill_ms;     // Until every sequence had its first token
+    double decode_ms;      // After that
+    int    decode_tokens;  // Tokens generated after each sequence's first
+    int    tokens;         // Tokens generated
+} RunTiming;
+
+// Generate every sequence of a batch to completion
+static bool run_batch(TinyAIGenerationBatch *batch, const TinyAIGenerationParams *params,
+                      int batch_size, SequenceTiming *sequences, RunTiming *run)
+{
+    double start = now_ms();
+    for (int b = 0; b < batch_size; b++) {
+        TinyAIGenerationParams sequence_params = *params;
+        sequence_params.seed                   = params->seed + (uint32_t)b;
+
+        sequences[b].start_ms = start;
+        sequences[b].first_ms = 0.0;
+        sequences[b].last_ms  = 0.0;
+        sequences[b].tokens   = 0;
+        if (tinyaiGenerationBatchAdd(batch, &sequence_params, record_token, &sequences[b]) < 0) {
+            printf("Error: Failed to add a sequence to the batch\n");
+            return false;
         }
     }
 
-    // Perform benchmark iterations
-    if (config->verbose) {
-        printf("Performing %d benchmark iterations...\n", config->num_iterations);
+    int running;
+    do {
+        running = tinyaiGenerationBatchStep(batch);
+    } while (running > 0);
+    double end = now_ms();
+    if (running < 0) {
+        printf("Error: Generation step failed\n");
+        return false;
     }
 
-    // Total tokens generated (for calculating tokens per second)
-    int total_tokens_generated = 0;
-
-    for (int i = 0; i < config->num_iterations; i++) {
-        char            output[1024] = {0};
-        struct timespec start_time;
+    double prefill_end = start;
+    memset(run, 0, sizeof(*run));
+    for (int b = 0; b < batch_size; b++) {
+        if (sequences[b].tokens > 0) {
+            prefill_end = sequences[b].first_ms > prefill_end ? sequences[b].first_ms : prefill_end;
+            run->decode_tokens += sequences[b].tokens - 1;
+            run->tokens += sequences[b].tokens;
+        }
+    }
+    run->total_ms   = end - start;
+    run->prefill_ms = prefill_end - start;
+    run->decode_ms  = end - prefill_end;
+    return true;
+}
 
-        // Measure memory before generation
-        size_t mem_before = tinyai_measure_current_memory_usage();
+// Build a prompt of the requested length by repeating the encoded prompt text
+static int build_prompt(const TinyAIModel *model, const char *text, int length, int *tokens,
+                        int capacity)
+{
+    int encoded = model->tokenizer ? tinyaiEncodeText(model->tokenizer, text, tokens, capacity) : 0;
+    if (encoded <= 0) {
+        tokens[0] = 1; // An unknown-text fallback that still exercises the model
+        encoded   = 1;
+    }
+    if (length <= 0) {
+        return encoded;
+    }
 
-        // Start timer
-        tinyai_benchmark_start_timer(&start_time);
+    length = length < capacity ? length : capacity;
+    for (int i = encoded; i < length; i++) {
+        tokens[i] = tokens[i % encoded];
+    }
+    return length;
+}
 
-        if (text_config->use_mmap) {
-            // TODO: Generate text with memory-mapped model and scheduler
-            // In a real implementation, we would use the memory-mapped model and scheduler here
+// Measure one combination of prompt length, batch size and thread count
+static bool benchmark_point(TinyAIModel *model, TinyAIBenchmarkConfig *config,
+                            TextBenchmarkConfig *text_config, int prompt_length, int batch_size,
+                            int threads, TinyAIBenchmarkResult *result)
+{
+    // Threads other than 1 run the kernels on their own pool
+    TinyAIThreadPool *pool = threads != 1 ? tinyaiCreateThreadPool(threads, 0) : NULL;
+    if (threads != 1 && !pool) {
+        printf("Error: Failed to create a pool of %d threads\n", threads);
+        return false;
+    }
+    TinyAIThreadPoolScope scope = tinyaiUseThreadPool(pool);
+    result->threads_used        = tinyaiThreadPoolSize(pool);
+
+    int  context = (int)model->contextSize;
+    int *prompt  = (int *)malloc((size_t)context * sizeof(int));
+    TinyAIGenerationBatch *batch = tinyaiCreateGenerationBatch(model, batch_size, 0, NULL);
+
+    // Every sequence may generate max_tokens; each iteration adds one TTFT per sequence
+    int             samples_per_run = batch_size * text_config->max_tokens;
+    int             itl_capacity    = config->num_iterations * samples_per_run;
+    double         *itl             = (double *)malloc((size_t)itl_capacity * sizeof(double));
+    double         *ttft = (double *)malloc((size_t)config->num_iterations * batch_size *
+                                            sizeof(double));
+    double         *run_times = (double *)malloc((size_t)config->num_iterations * sizeof(double));
+    SequenceTiming *sequences = (SequenceTiming *)calloc((size_t)batch_size,
+                                                         sizeof(SequenceTiming));
+    bool            ok        = prompt && batch && itl && ttft && run_times && sequences;
+    int             itl_count = 0, ttft_count = 0;
+
+    TinyAIGenerationParams params;
+    memset(&params, 0, sizeof(params));
+    if (ok) {
+        int length = build_prompt(model, text_config->prompt, prompt_length, prompt,
+                                  context - text_config->max_tokens);
+        params.promptTokens   = prompt;
+        params.promptLength   = length;
+        params.maxTokens      = length + text_config->max_tokens;
+        params.samplingMethod = text_config->temperature > 0.0f ? TINYAI_SAMPLING_TOP_P
+                                                                : TINYAI_SAMPLING_GREEDY;
+        params.temperature    = text_config->temperature;
+        params.topK           = (uint32_t)text_config->top_k;
+        params.topP           = text_config->top_p;
+        params.seed           = 42;
+        result->modality_metrics.text.prompt_tokens = length;
+        if (prompt_length > 0 && length < prompt_length) {
+            printf("Warning: Prompt of %d tokens cut to %d to fit the %d-token context\n",
+                   prompt_length, length, context);
         }
-        else {
-            // Generate text with regular model
-            // In a real implementation, we would call the text generation function here
-            // tinyai_generate_text(model, text_config->prompt, output, sizeof(output), &params);
+    }
+
+    // Warmup runs fill caches and fault in weights; their timings are dropped
+    for (int i = 0; ok && i < config->warmup_iterations; i++) {
+        RunTiming run;
+        for (int b = 0; b < batch_size; b++) {
+            sequences[b].itl = NULL;
         }
+        ok = run_batch(batch, &params, batch_size, sequences, &run);
+    }
 
-        // Stop timer
-        inference_times[i] = tinyai_benchmark_stop_timer(&start_time);
+    double prefill_ms = 0.0, decode_ms = 0.0;
+    long   decode_tokens = 0, tokens = 0;
+    size_t memory_total  = 0;
+    tinyai_reset_hardware_counters();
+    for (int i = 0; ok && i < config->num_iterations; i++) {
+        RunTiming run;
+        for (int b = 0; b < batch_size; b++) {
+            sequences[b].itl          = itl;
+            sequences[b].itl_count    = &itl_count;
+            sequences[b].itl_capacity = itl_capacity;
+        }
 
-        // Measure memory after generation
+        // Hardware counters, when enabled, cover the runs themselves
+        struct timespec counted;
+        size_t          mem_before = tinyai_measure_current_memory_usage();
+        tinyai_benchmark_start_timer(&counted);
+        ok = run_batch(batch, &params, batch_size, sequences, &run);
+        tinyai_benchmark_stop_timer(&counted);
         size_t mem_after = tinyai_measure_current_memory_usage();
-        memory_usages[i] = mem_after > mem_before ? mem_after - mem_before : 0;
-
-        // Count tokens generated (in a real implementation this would be the actual token count)
-        int tokens_generated = text_config->max_tokens;
-        total_tokens_generated += tokens_generated;
+        memory_total += mem_after > mem_before ? mem_after - mem_before : 0;
 
-        if (config->verbose) {
-            printf("Iteration %d: Generated %zu characters in %.2f ms\n", i + 1, strlen(output),
-                   inference_times[i]);
-            printf("Output: %s\n\n", output);
+        for (int b = 0; b < batch_size; b++) {
+            if (sequences[b].tokens > 0) {
+                ttft[ttft_count++] = sequences[b].first_ms - sequences[b].start_ms;
+            }
+        }
+        run_times[i] = run.total_ms;
+        prefill_ms += run.prefill_ms;
+        decode_ms += run.decode_ms;
+        decode_tokens += run.decode_tokens;
+        tokens += run.tokens;
+
+        if (config->verbose && ok) {
+            printf("  Iteration %d: %d tokens in %.2f ms (prefill %.2f ms)\n", i + 1, run.tokens,
+                   run.total_ms, run.prefill_ms);
         }
     }
 
-    // Calculate statistics
-    result->total_time_ms = 0.0;
-    result->min_time_ms   = inference_times[0];
-    result->max_time_ms   = inference_times[0];
-
-    for (int i = 0; i < config->num_iterations; i++) {
-        result->total_time_ms += inference_times[i];
-        if (inference_times[i] < result->min_time_ms)
-            result->min_time_ms = inference_times[i];
-        if (inference_times[i] > result->max_time_ms)
-            result->max_time_ms = inference_times[i];
-    }
-
-    result->avg_inference_time_ms = result->total_time_ms / config->num_iterations;
-
-    // Calculate standard deviation
-    double variance = 0.0;
-    for (int i = 0; i < config->num_iterations; i++) {
-        double diff = inference_times[i] - result->avg_inference_time_ms;
-        variance += diff * diff;
-    }
-    variance /= config->num_iterations;
-    result->std_dev_time_ms = sqrt(variance);
+    if (ok) {
+        int iterations = config->num_iterations;
 
-    // Calculate memory statistics
-    result->peak_memory_bytes = tinyai_measure_peak_memory_usage();
+        result->total_time_ms = 0.0;
+        result->min_time_ms   = run_times[0];
+        result->max_time_ms   = run_times[0];
+        for (int i = 0; i < iterations; i++) {
+            result->total_time_ms += run_times[i];
+            result->min_time_ms = fmin(result->min_time_ms, run_times[i]);
+            result->max_time_ms = fmax(result->max_time_ms, run_times[i]);
+        }
+        result->avg_inference_time_ms = result->total_time_ms / iterations;
 
-    result->avg_memory_bytes = 0;
-    for (int i = 0; i < config->num_iterations; i++) {
-        result->avg_memory_bytes += memory_usages[i];
+        double variance = 0.0;
+        for (int i = 0; i < iterations; i++) {
+            double diff = run_times[i] - result->avg_inference_time_ms;
+            variance += diff * diff;
+        }
+        result->std_dev_time_ms = sqrt(variance / iterations);
+
+        result->peak_memory_bytes  = tinyai_measure_peak_memory_usage();
+        result->avg_memory_bytes   = memory_total / iterations;
+        tinyai_get_hardware_counters(&result->hw_counters);
+        result->samples_processed  = iterations * batch_size;
+        result->samples_per_second = result->total_time_ms > 0.0
+                                         ? result->samples_processed * 1000.0 / result->total_time_ms
+                                         : 0.0;
+
+        result->modality_metrics.text.batch_size = batch_size;
+        result->modality_metrics.text.tokens_per_second =
+            result->total_time_ms > 0.0 ? tokens * 1000.0 / result->total_time_ms : 0.0;
+        result->modality_metrics.text.prefill_tokens_per_second =
+            prefill_ms > 0.0 ? (double)params.promptLength * result->samples_processed * 1000.0 /
+                                   prefill_ms
+                             : 0.0;
+        result->modality_metrics.text.decode_tokens_per_second =
+            decode_ms > 0.0 ? decode_tokens * 1000.0 / decode_ms : 0.0;
+        result->modality_metrics.text.ttft_p50_ms = tinyai_percentile(ttft, ttft_count, 50.0);
+        result->modality_metrics.text.ttft_p99_ms = tinyai_percentile(ttft, ttft_count, 99.0);
+        result->modality_metrics.text.itl_p50_ms  = tinyai_percentile(itl, itl_count, 50.0);
+        result->modality_metrics.text.itl_p90_ms  = tinyai_percentile(itl, itl_count, 90.0);
+        result->modality_metrics.text.itl_p99_ms  = tinyai_percentile(itl, itl_count, 99.0);
     }
-    result->avg_memory_bytes /= config->num_iterations;
-
-    // Calculate performance metrics
-    result->samples_processed  = config->num_iterations;
-    result->samples_per_second = (config->num_iterations * 1000.0) / result->total_time_ms;
 
-    // Set text-specific metrics
-    result->modality_metrics.text.tokens_per_second =
-        (total_tokens_generated * 1000.0) / result->total_time_ms;
-    result->modality_metrics.text.context_length = text_config->context_size;
+    tinyaiDestroyGenerationBatch(batch);
+    free(sequences);
+    free(run_times);
+    free(ttft);
+    free(itl);
+    free(prompt);
+    tinyaiRestoreThreadPool(scope);
+    tinyaiDestroyThreadPool(pool);
+    return ok;
+}
 
-    // Clean up
-    free(inference_times);
-    free(memory_usages);
+// Function to benchmark TinyAI text model over every configuration of the sweep
+int benchmark_tinyai_text(TinyAIBenchmarkConfig *config, TextBenchmarkConfig *text_config,
+                          TinyAIBenchmarkResult *results)
+{
+    // Get device name (hostname)
+    char hostname[64] = "unknown";
+#ifdef _WIN32
+    DWORD size = sizeof(hostname);
+    GetComputerNameA(hostname, &size);
+#else
+    gethostname(hostname, sizeof(hostname));
+#endif
 
-    if (text_config->use_mmap) {
-        if (scheduler)
-            tinyaiDestroyForwardScheduler(scheduler);
-        if (mmap_model)
-            tinyaiCloseMappedModel(mmap_model);
+    // Load model
+    TinyAIModel *model;
+    if (text_config->snapshot_path[0]) {
+        model = tinyaiLoadModelSnapshot(text_config->snapshot_path);
     }
     else {
-        if (model) {
-            // TODO: Free model in real implementation
-            // tinyai_free_model(model);
+        model = tinyaiLoadModel(config->model_path,
+                                text_config->weights_path[0] ? text_config->weights_path
+                                                             : config->model_path,
+                                text_config->tokenizer_path);
+    }
+    if (!model) {
+        printf("Error: Failed to load model: %s\n",
+               text_config->snapshot_path[0] ? text_config->snapshot_path : config->model_path);
+        exit(EXIT_FAILURE);
+    }
+    TinyAITokenizer *tokenizer = model->snapshot ? NULL : model->tokenizer;
+
+    int count = 0;
+    for (int p = 0; p < text_config->num_prompt_lengths; p++) {
+        for (int b = 0; b < text_config->num_batch_sizes; b++) {
+            for (int t = 0; t < text_config->num_thread_counts; t++) {
+                TinyAIBenchmarkResult *result = &results[count];
+                tinyai_init_benchmark_result(result);
+                result->modality = TINYAI_BENCHMARK_TEXT;
+                strncpy(result->model_name,
+                        text_config->snapshot_path[0] ? text_config->snapshot_path
+                                                      : config->model_path,
+                        sizeof(result->model_name) - 1);
+                strncpy(result->device_name, hostname, sizeof(result->device_name) - 1);
+                result->simd_used = config->use_simd;
+                strncpy(result->simd_type, tinyai_detect_simd_capabilities(),
+                        sizeof(result->simd_type) - 1);
+                result->model_size_bytes                     = model->snapshotSize;
+                result->modality_metrics.text.context_length = (int)model->contextSize;
+
+                if (config->verbose) {
+                    printf("Prompt %d tokens, batch %d, threads %d...\n",
+                           text_config->prompt_lengths[p], text_config->batch_sizes[b],
+                           text_config->thread_counts[t]);
+                }
+                if (benchmark_point(model, config, text_config, text_config->prompt_lengths[p],
+                                    text_config->batch_sizes[b], text_config->thread_counts[t],
+                                    result)) {
+                    count++;
+                }
+            }
         }
     }
+
+    tinyaiDestroyModel(model);
+    tinyaiDestroyTokenizer(tokenizer);
+    return count;
+}
+
+// Print one line per configuration of the sweep
+static void print_sweep_summary(const TinyAIBenchmarkResult *results, int count)
+{
+    printf("\n===== SWEEP SUMMARY =====\n");
+    printf("%7s %6s %8s %12s %12s %10s %10s %10s %10s\n", "Prompt", "Batch", "Threads",
+           "Prefill t/s", "Decode t/s", "TTFT p50", "ITL p50", "ITL p90", "ITL p99");
+    for (int i = 0; i < count; i++) {
+        const TinyAIBenchmarkResult *r = &results[i];
+        printf("%7d %6d %8d %12.1f %12.1f %10.3f %10.3f %10.3f %10.3f\n",
+               r->modality_metrics.text.prompt_tokens, r->modality_metrics.text.batch_size,
+               r->threads_used, r->modality_metrics.text.prefill_tokens_per_second,
+               r->modality_metrics.text.decode_tokens_per_second,
+               r->modality_metrics.text.ttft_p50_ms, r->modality_metrics.text.itl_p50_ms,
+               r->modality_metrics.text.itl_p90_ms, r->modality_metrics.text.itl_p99_ms);
+    }
+    printf("(latencies in ms)\n\n");
 }
 
 // Function to compare with other frameworks
@@ -403,16 +611,22 @@ int main(int argc, char **argv)
     TextBenchmarkConfig   text_config;
 
     tinyai_init_benchmark_config(&config);
+    config.num_iterations    = DEFAULT_ITERATIONS;
+    config.warmup_iterations = DEFAULT_WARMUP_ITERATIONS;
+    strncpy(config.model_path, DEFAULT_MODEL_PATH, sizeof(config.model_path) - 1);
 
     // Set default text generation parameters
+    memset(&text_config, 0, sizeof(text_config));
     strncpy(text_config.prompt, DEFAULT_PROMPT, sizeof(text_config.prompt) - 1);
-    text_config.max_tokens   = DEFAULT_MAX_TOKENS;
-    text_config.temperature  = DEFAULT_TEMPERATURE;
-    text_config.top_k        = 40;
-    text_config.top_p        = 0.95f;
-    text_config.context_size = 512;
-    text_config.use_mmap     = DEFAULT_MEMORY_MAPPING;
-    text_config.memory_limit = DEFAULT_MEMORY_LIMIT;
+    text_config.max_tokens         = DEFAULT_MAX_TOKENS;
+    text_config.temperature        = DEFAULT_TEMPERATURE;
+    text_config.top_k              = 40;
+    text_config.top_p              = 0.95f;
+    text_config.num_prompt_lengths = 1; // prompt_lengths[0] = 0: the prompt as encoded
+    text_config.batch_sizes[0]     = 1;
+    text_config.num_batch_sizes    = 1;
+    text_config.thread_counts[0]   = DEFAULT_NUM_THREADS;
+    text_config.num_thread_counts  = 1;
 
     // Parse command line arguments
     parse_args(argc, argv, &config, &text_config);
@@ -426,34 +640,57 @@ int main(int argc, char **argv)
 
     // Print benchmark settings
     printf("\n===== TinyAI Text Model Benchmark =====\n");
-    printf("Model: %s\n", config.model_path);
+    printf("Model: %s\n", text_config.snapshot_path[0] ? text_config.snapshot_path
+                                                       : config.model_path);
     printf("Prompt: \"%s\"\n", text_config.prompt);
     printf("Max Tokens: %d\n", text_config.max_tokens);
     printf("Temperature: %.2f\n", text_config.temperature);
     printf("Top-k: %d\n", text_config.top_k);
     printf("Top-p: %.2f\n", text_config.top_p);
-    printf("Context Size: %d tokens\n", text_config.context_size);
-    printf("Iterations: %d (%d warmup)\n", config.num_iterations, config.warmup_iterations);
+    printf("Configurations: %d prompt lengths x %d batch sizes x %d thread counts\n",
+           text_config.num_prompt_lengths, text_config.num_batch_sizes,
+           text_config.num_thread_counts);
+    printf("Iterations: %d (%d warmup per configuration)\n", config.num_iterations,
+           config.warmup_iterations);
     printf("SIMD: %s\n", config.use_simd ? "Enabled" : "Disabled");
-    printf("Threads: %d\n",
-           config.num_threads > 0 ? config.num_threads : tinyai_determine_optimal_threads());
-    printf("Memory Mapping: %s\n", text_config.use_mmap ? "Enabled" : "Disabled");
-    printf("Memory Limit: %.2f MB\n", text_config.memory_limit / (1024.0 * 1024.0));
     printf("Export Path: %s\n", config.export_path);
     printf("Compare Frameworks: %s\n", config.compare_frameworks ? "Yes" : "No");
     printf("Verbose: %s\n", config.verbose ? "Yes" : "No");
     printf("=========================================\n\n");
 
+    // Counters are opened before the benchmark starts its thread pools, which inherit them
+    if (config.hw_counters && !tinyai_enable_hardware_counters()) {
+        printf("Warning: Hardware counters are not available here (perf_event_open failed);\n"
+               "         check /proc/sys/kernel/perf_event_paranoid or run on bare metal\n");
+    }
+
     // Run benchmark
     printf("Running TinyAI text model benchmark...\n");
 
-    TinyAIBenchmarkResult result;
-    benchmark_tinyai_text(&config, &text_config, &result);
+    int num_points = text_config.num_prompt_lengths * text_config.num_batch_sizes *
+                     text_config.num_thread_counts;
+    TinyAIBenchmarkResult *results =
+        (TinyAIBenchmarkResult *)calloc((size_t)num_points, sizeof(TinyAIBenchmarkResult));
+    if (!results) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
+    int count = benchmark_tinyai_text(&config, &text_config, results);
+    if (count == 0) {
+        printf("Error: No configuration completed\n");
+        free(results);
+        return 1;
+    }
 
     // Print results
-    tinyai_print_benchmark_results(&result);
+    if (count == 1) {
+        tinyai_print_benchmark_results(&results[0]);
+    }
+    else {
+        print_sweep_summary(results, count);
+    }
 
-    // Export results
+    // Export results: one file, holding every configuration of a sweep
     char csv_path[512];
     char json_path[512];
 
@@ -468,14 +705,18 @@ int main(int argc, char **argv)
     snprintf(full_json_path, sizeof(full_json_path), "%s/%s", config.export_path, json_path);
 
     printf("Exporting results...\n");
-    if (tinyai_export_benchmark_csv(&result, full_csv_path)) {
-        printf("CSV results exported to: %s\n", full_csv_path);
-    }
-    else {
-        printf("Failed to export CSV results\n");
+    if (count == 1) {
+        if (tinyai_export_benchmark_csv(&results[0], full_csv_path)) {
+            printf("CSV results exported to: %s\n", full_csv_path);
+        }
+        else {
+            printf("Failed to export CSV results\n");
+        }
     }
 
-    if (tinyai_export_benchmark_json(&result, full_json_path)) {
+    bool exported = count == 1 ? tinyai_export_benchmark_json(&results[0], full_json_path)
+                               : tinyai_export_benchmark_json_runs(results, count, full_json_path);
+    if (exported) {
         printf("JSON results exported to: %s\n", full_json_path);
     }
     else {
@@ -485,9 +726,11 @@ int main(int argc, char **argv)
     // Compare with other frameworks if requested
     if (config.compare_frameworks) {
         printf("\nComparing with other frameworks...\n");
-        compare_with_other_frameworks(&result, config.export_path);
+        compare_with_other_frameworks(&results[0], config.export_path);
     }
 
+    tinyai_disable_hardware_counters();
+    free(results);
     printf("\nBenchmark complete.\n");
     return 0;
 }
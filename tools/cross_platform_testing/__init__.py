@@ -4,16 +4,22 @@ TinyAI Cross-Platform Testing Framework
 This package provides utilities for testing the TinyAI framework across multiple platforms:
 - Run tests on various operating systems (Windows, Linux, macOS)
 - Test on embedded platforms (Raspberry Pi, Arduino, etc.)
+- Keep per-platform performance baselines and compare them across commits
 - Generate cross-platform compatibility reports
 """
 
-from .run_tests import detect_platform, find_project_root, run_platform_tests, generate_report
+from .run_tests import (detect_platform, find_project_root, run_platform_tests, generate_report,
+                        run_benchmarks, record_baseline, compare_runs, performance_trend)
 
 __all__ = [
     'detect_platform',
     'find_project_root',
     'run_platform_tests',
     'generate_report',
+    'run_benchmarks',
+    'record_baseline',
+    'compare_runs',
+    'performance_trend',
 ]
 
 # Version information
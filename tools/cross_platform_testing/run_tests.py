@@ -6,6 +6,7 @@ This script automates testing across multiple platforms:
 - Detects the current platform
 - Runs platform-specific test scripts
 - Collects and analyzes test results
+- Runs the benchmark suite and keeps per-platform performance baselines
 - Generates compatibility reports
 
 Usage:
@@ -16,16 +17,38 @@ Options:
     --tests TESTS           Comma-separated list of tests to run (all if not provided)
     --report FORMAT         Output report format (text, html, json) (default: text)
     --verbose               Show detailed output
+    --benchmarks            Also run the benchmark suite and record a baseline
+    --benchmarks-only       Run the benchmark suite without the platform tests
+    --build-dir DIR         CMake build directory holding the benchmarks (default: build)
+    --compiler NAME         Compiler of the build (read from the CMake cache if not provided)
+    --history-dir DIR       Per-platform baseline histories (default: test_reports/baselines)
+    --perf-tolerance PCT    Slowdown against the previous commit reported as a regression
+                            (default: 10)
+    --fail-on-regression    Exit with an error when a benchmark regressed
     --help                  Show this help message
+
+Performance baselines:
+    Each benchmark run is stored under the platform configuration it ran on,
+    <platform>-<compiler>-<cpu family> (for example windows-msvc-x86_64-avx2 or
+    linux-gcc-aarch64-neon), in <history-dir>/<config>.json, one entry per
+    commit. Kernel times are compared as multiples of the calibration loop the
+    kernel benchmark times in the same run, so machines of one configuration
+    that differ in clock speed can share a history. The report shows every
+    configuration's change from one commit to the next side by side, so a
+    slowdown confined to one configuration (an MSVC codegen regression, say)
+    stands out against the others.
 """
 
 import os
 import sys
+import glob
+import math
 import platform
 import subprocess
 import json
 import time
 import argparse
+import tempfile
 from datetime import datetime
 
 # Platform identifiers
@@ -49,6 +72,24 @@ TEST_CATEGORIES = [
     "edge_cases"    # Edge case tests (low memory, error handling, etc.)
 ]
 
+# Benchmark suite run per platform configuration
+BENCHMARK_SUITE = "tinyai_kernel_bench"
+
+# Runs kept in each configuration's baseline history
+HISTORY_LIMIT = 100
+
+# Commits shown in the cross-commit performance table
+TREND_COMMITS = 6
+
+# Compiler IDs reported by CMake, as they appear in configuration names
+COMPILER_NAMES = {
+    "GNU": "gcc",
+    "Clang": "clang",
+    "AppleClang": "clang",
+    "MSVC": "msvc",
+    "IntelLLVM": "icx",
+}
+
 def detect_platform():
     """Detect the current platform."""
     system = platform.system().lower()
@@ -158,7 +199,234 @@ def run_platform_tests(platform_name, test_categories=None, verbose=False):
         print(f"Error running platform tests: {e}")
         return False, {}
 
-def generate_report(results, format="text"):
+def find_build_file(build_dir, name):
+    """Find a built executable, including the per-configuration folders of MSVC builds."""
+    executable = name + ".exe" if platform.system().lower() == "windows" else name
+    for subdir in ["", "Release", "RelWithDebInfo", "Debug", "bin"]:
+        path = os.path.join(build_dir, subdir, executable)
+        if os.path.isfile(path):
+            return path
+    return None
+
+def detect_compiler(build_dir):
+    """Detect the C compiler of a CMake build directory."""
+    for path in glob.glob(os.path.join(build_dir, "CMakeFiles", "*", "CMakeCCompiler.cmake")):
+        with open(path, "r") as f:
+            for line in f:
+                if line.startswith("set(CMAKE_C_COMPILER_ID "):
+                    compiler_id = line.split('"')[1]
+                    return COMPILER_NAMES.get(compiler_id, compiler_id.lower() or "unknown")
+
+    # Fall back to the compiler's file name
+    cache = os.path.join(build_dir, "CMakeCache.txt")
+    if os.path.isfile(cache):
+        with open(cache, "r") as f:
+            for line in f:
+                if line.startswith("CMAKE_C_COMPILER:"):
+                    name = os.path.basename(line.split("=", 1)[1].strip()).lower()
+                    for known in ["clang", "gcc", "cl"]:
+                        if known in name:
+                            return "msvc" if known == "cl" else known
+    return "unknown"
+
+def get_commit(project_root):
+    """Get the current commit and its date, or None outside a git checkout."""
+    try:
+        result = subprocess.run(
+            ["git", "log", "-1", "--format=%h %cI"],
+            capture_output=True,
+            text=True,
+            cwd=project_root
+        )
+    except OSError:
+        return None, None
+    if result.returncode != 0 or not result.stdout.strip():
+        return None, None
+    commit, date = result.stdout.split()
+    return commit, date
+
+def run_benchmarks(platform_name, build_dir, compiler=None, verbose=False):
+    """Run the benchmark suite and return its results keyed by platform configuration."""
+    benchmark = find_build_file(build_dir, BENCHMARK_SUITE)
+    if not benchmark:
+        print(f"Error: {BENCHMARK_SUITE} not found in {build_dir}; build the project first")
+        return None
+
+    # The kernel benchmark writes its timings as JSON; its exit status gates its own baseline
+    fd, output_path = tempfile.mkstemp(suffix=".json")
+    os.close(fd)
+    try:
+        result = subprocess.run(
+            [benchmark, "-output", output_path],
+            capture_output=True,
+            text=True,
+            cwd=find_project_root()
+        )
+        if verbose:
+            print(result.stdout)
+        try:
+            with open(output_path, "r") as f:
+                suite = json.load(f)
+        except (OSError, json.JSONDecodeError):
+            print(f"Error: {BENCHMARK_SUITE} produced no results (exit code {result.returncode})")
+            print(f"Error output: {result.stderr}")
+            return None
+    finally:
+        os.remove(output_path)
+
+    family = suite.get("family", "generic")
+    compiler = compiler or detect_compiler(build_dir)
+    commit, commit_date = get_commit(find_project_root())
+    return {
+        "config": f"{platform_name}-{compiler}-{family}",
+        "platform": platform_name,
+        "compiler": compiler,
+        "family": family,
+        "commit": commit or "uncommitted",
+        "commit_date": commit_date,
+        "timestamp": datetime.now().isoformat(timespec="seconds"),
+        "calibration_ns": suite.get("calibration_ns"),
+        "kernels": {k["name"]: {"ns": k["ns"], "relative": k["relative"]}
+                    for k in suite.get("kernels", [])}
+    }
+
+def load_history(history_dir, config):
+    """Load the baseline history of a platform configuration, oldest run first."""
+    path = os.path.join(history_dir, f"{config}.json")
+    if not os.path.isfile(path):
+        return []
+    try:
+        with open(path, "r") as f:
+            return json.load(f).get("runs", [])
+    except (OSError, json.JSONDecodeError):
+        print(f"Warning: Ignoring unreadable baseline history {path}")
+        return []
+
+def record_baseline(history_dir, run):
+    """Add a run to its configuration's history, returning the run of the previous commit."""
+    runs = load_history(history_dir, run["config"])
+
+    # A rerun on the same commit replaces the earlier one
+    runs = [r for r in runs if r.get("commit") != run["commit"]]
+    previous = runs[-1] if runs else None
+    runs = (runs + [run])[-HISTORY_LIMIT:]
+
+    os.makedirs(history_dir, exist_ok=True)
+    with open(os.path.join(history_dir, f"{run['config']}.json"), "w") as f:
+        json.dump({"config": run["config"], "runs": runs}, f, indent=2)
+    return previous
+
+def compare_runs(current, previous, tolerance):
+    """Compare each kernel of a run with the previous commit's run."""
+    rows = []
+    for name, timing in current["kernels"].items():
+        row = {"name": name, "relative": timing["relative"], "previous": None,
+               "change_pct": None, "status": "new"}
+        before = (previous or {}).get("kernels", {}).get(name)
+        if before and before["relative"] > 0:
+            change = (timing["relative"] / before["relative"] - 1.0) * 100.0
+            row["previous"] = before["relative"]
+            row["change_pct"] = round(change, 2)
+            if change > tolerance:
+                row["status"] = "regression"
+            elif change < -tolerance:
+                row["status"] = "improvement"
+            else:
+                row["status"] = "ok"
+        rows.append(row)
+    return rows
+
+def run_change(run, previous):
+    """Geometric mean change of the kernels two runs share, in percent."""
+    ratios = []
+    for name, timing in run["kernels"].items():
+        before = previous["kernels"].get(name)
+        if before and before["relative"] > 0 and timing["relative"] > 0:
+            ratios.append(math.log(timing["relative"] / before["relative"]))
+    if not ratios:
+        return None
+    return (math.exp(sum(ratios) / len(ratios)) - 1.0) * 100.0
+
+def performance_trend(history_dir, commits=TREND_COMMITS):
+    """Change of every recorded configuration from each commit to the next.
+
+    Returns the most recent commits, oldest first, and for each configuration
+    its change at each of them (None where it has no run or no earlier run).
+    """
+    changes = {}
+    dates = {}
+    for path in sorted(glob.glob(os.path.join(history_dir, "*.json"))):
+        config = os.path.splitext(os.path.basename(path))[0]
+        runs = load_history(history_dir, config)
+        changes[config] = {}
+        for previous, run in zip(runs, runs[1:]):
+            changes[config][run["commit"]] = run_change(run, previous)
+        for run in runs:
+            dates.setdefault(run["commit"], run.get("commit_date") or run.get("timestamp") or "")
+
+    recent = sorted(dates, key=lambda commit: dates[commit])[-commits:]
+    return recent, {config: [by_commit.get(commit) for commit in recent]
+                    for config, by_commit in changes.items()}
+
+def write_performance_text(f, performance):
+    """Write the performance section of a text report."""
+    f.write("Performance:\n")
+    f.write("------------\n\n")
+
+    commits, trend = performance["trend"]
+    if commits:
+        f.write("Change from the previous commit (geometric mean over kernels):\n\n")
+        f.write(f"{'Configuration':<36}" + "".join(f"{c:>12}" for c in commits) + "\n")
+        for config, values in trend.items():
+            cells = "".join(f"{'-':>12}" if v is None else f"{v:>+11.1f}%" for v in values)
+            f.write(f"{config:<36}{cells}\n")
+        f.write("\n")
+
+    for run in performance["runs"]:
+        f.write(f"Configuration: {run['config']} at {run['commit']}")
+        f.write(f" (previous: {run['previous_commit'] or 'none'})\n")
+        f.write(f"{'Kernel':<36}{'Relative':>12}{'Previous':>12}{'Change':>10}  Status\n")
+        for row in run["comparison"]:
+            previous = "-" if row["previous"] is None else f"{row['previous']:.4f}"
+            change = "-" if row["change_pct"] is None else f"{row['change_pct']:+.1f}%"
+            f.write(f"{row['name']:<36}{row['relative']:>12.4f}{previous:>12}{change:>10}")
+            f.write(f"  {row['status']}\n")
+        f.write("\n")
+
+def write_performance_html(f, performance):
+    """Write the performance section of an HTML report."""
+    f.write("<h2>Performance</h2>")
+
+    commits, trend = performance["trend"]
+    if commits:
+        f.write("<p>Change from the previous commit (geometric mean over kernels)</p>")
+        f.write("<table><tr><th>Configuration</th>")
+        f.write("".join(f"<th>{c}</th>" for c in commits) + "</tr>")
+        for config, values in trend.items():
+            f.write(f"<tr><td>{config}</td>")
+            for v in values:
+                if v is None:
+                    f.write("<td>-</td>")
+                else:
+                    status_class = "fail" if v > performance["tolerance"] else "pass"
+                    f.write(f"<td class='{status_class}'>{v:+.1f}%</td>")
+            f.write("</tr>")
+        f.write("</table>")
+
+    for run in performance["runs"]:
+        f.write(f"<h3>{run['config']} at {run['commit']}</h3>")
+        f.write("<table><tr><th>Kernel</th><th>Relative</th><th>Previous</th>")
+        f.write("<th>Change</th><th>Status</th></tr>")
+        for row in run["comparison"]:
+            previous = "-" if row["previous"] is None else f"{row['previous']:.4f}"
+            change = "-" if row["change_pct"] is None else f"{row['change_pct']:+.1f}%"
+            status_class = "fail" if row["status"] == "regression" else "pass"
+            f.write(f"<tr><td>{row['name']}</td><td>{row['relative']:.4f}</td>")
+            f.write(f"<td>{previous}</td><td>{change}</td>")
+            f.write(f"<td class='{status_class}'>{row['status']}</td></tr>")
+        f.write("</table>")
+
+def generate_report(results, format="text", performance=None):
     """Generate a test report in the specified format."""
     report_dir = os.path.join(find_project_root(), "test_reports")
     os.makedirs(report_dir, exist_ok=True)
@@ -168,8 +436,16 @@ def generate_report(results, format="text"):
     
     if format == "json":
         report_path = os.path.join(report_dir, f"{report_filename}.json")
+        report = dict(results)
+        if performance:
+            commits, trend = performance["trend"]
+            report["performance"] = {
+                "tolerance_pct": performance["tolerance"],
+                "runs": performance["runs"],
+                "trend": {"commits": commits, "change_pct": trend}
+            }
         with open(report_path, "w") as f:
-            json.dump(results, f, indent=2)
+            json.dump(report, f, indent=2)
     
     elif format == "html":
         report_path = os.path.join(report_dir, f"{report_filename}.html")
@@ -227,6 +503,9 @@ def generate_report(results, format="text"):
                 else:
                     f.write("<p>No detailed test results available.</p>")
             
+            if performance:
+                write_performance_html(f, performance)
+            
             f.write("</body></html>")
     
     else:  # Default to text format
@@ -281,6 +560,9 @@ def generate_report(results, format="text"):
                         f.write("\n")
                 else:
                     f.write("No detailed test results available.\n\n")
+            
+            if performance:
+                write_performance_text(f, performance)
     
     print(f"Report generated: {report_path}")
     return report_path
@@ -291,6 +573,17 @@ def main():
     parser.add_argument("--tests", help="Comma-separated list of tests to run (all if not provided)")
     parser.add_argument("--report", default="text", choices=["text", "html", "json"], help="Output report format")
     parser.add_argument("--verbose", action="store_true", help="Show detailed output")
+    parser.add_argument("--benchmarks", action="store_true",
+                        help="Also run the benchmark suite and record a baseline")
+    parser.add_argument("--benchmarks-only", action="store_true",
+                        help="Run the benchmark suite without the platform tests")
+    parser.add_argument("--build-dir", default="build", help="CMake build directory")
+    parser.add_argument("--compiler", help="Compiler of the build (read from the CMake cache)")
+    parser.add_argument("--history-dir", help="Per-platform baseline histories")
+    parser.add_argument("--perf-tolerance", type=float, default=10.0,
+                        help="Slowdown in percent reported as a regression")
+    parser.add_argument("--fail-on-regression", action="store_true",
+                        help="Exit with an error when a benchmark regressed")
     args = parser.parse_args()
     
     # Detect platform if not specified
@@ -305,7 +598,7 @@ def main():
     
     # Run tests
     results = {}
-    if platform_name:
+    if platform_name and not args.benchmarks_only:
         print(f"Starting tests for {platform_name}...")
         success, platform_results = run_platform_tests(platform_name, test_categories, args.verbose)
         
@@ -333,15 +626,45 @@ def main():
         print(f"Tests completed for {platform_name}")
         print(f"Tests passed: {tests_passed}")
         print(f"Tests failed: {tests_failed}")
-    else:
+    elif not platform_name:
         print("Error: Could not determine platform")
     
+    # Run the benchmark suite and compare it with the previous commit on this configuration
+    performance = None
+    regressions = 0
+    benchmarks_failed = False
+    if platform_name and (args.benchmarks or args.benchmarks_only):
+        project_root = find_project_root()
+        build_dir = os.path.join(project_root, args.build_dir)
+        history_dir = args.history_dir or os.path.join(project_root, "test_reports", "baselines")
+        
+        print(f"Running benchmark suite for {platform_name}...")
+        run = run_benchmarks(platform_name, build_dir, args.compiler, args.verbose)
+        performance = {"tolerance": args.perf_tolerance, "runs": [], "trend": ([], {})}
+        if run:
+            previous = record_baseline(history_dir, run)
+            comparison = compare_runs(run, previous, args.perf_tolerance)
+            regressions = sum(1 for row in comparison if row["status"] == "regression")
+            performance["runs"].append({
+                "config": run["config"],
+                "commit": run["commit"],
+                "previous_commit": previous["commit"] if previous else None,
+                "comparison": comparison
+            })
+            print(f"Baseline recorded for {run['config']} at {run['commit']}")
+            print(f"Benchmark regressions: {regressions}")
+        else:
+            benchmarks_failed = True
+        performance["trend"] = performance_trend(history_dir)
+    
     # Generate report
-    report_path = generate_report(results, args.report)
+    report_path = generate_report(results, args.report, performance)
     
     # Exit with appropriate code
     if any(platform_data.get("status") == "fail" for platform_data in results.values()):
         sys.exit(1)
+    if benchmarks_failed or (args.fail_on_regression and regressions > 0):
+        sys.exit(1)
     
     sys.exit(0)
 
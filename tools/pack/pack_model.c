@@ -0,0 +1,408 @@
+// Ahead-of-time model packing (tinyai-pack)
+//
+// Takes a converted text model (structure, 4-bit weights and vocabulary
+// files) and does once, at build time, the work every runtime start would
+// otherwise repeat:
+//
+//   - group quantization of the weights (from FP32 weights when given)
+//   - magnitude or block pruning of dense and output layers, whose sparse
+//     weight formats the execution plan then measures, or benchmarks
+//   - repacking the weights into the SIMD panel layout
+//   - converting the vocabulary to the binary format with its hash indexes
+//
+// The result is a model snapshot: one 64-byte aligned file that
+// tinyaiLoadModelSnapshot maps and runs in place. With -compress, the
+// packed layer weights are also written compressed to a tensor container
+// that a progressive loader can stream them from on hosts short of memory.
+// The snapshot is loaded back and checked against the packed model before
+// the tool reports success.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// TinyAI includes
+#include "../../core/config.h"
+#include "../../core/memory.h"
+#include "../../models/text/generate.h"
+#include "../../models/text/tokenizer.h"
+#include "../../utils/compress.h"
+#include "../../utils/mmap_loader.h"
+#include "../../utils/prune.h"
+#include "../../utils/quantize.h"
+
+// Default configuration values
+#define DEFAULT_MIN_SPARSITY 0.5f
+#define VERIFY_TOKENS 4
+
+// [input x output] blocks that are the BSR blocks of the transposed weights
+#define PRUNE_BLOCK_ROWS 8
+#define PRUNE_BLOCK_COLS 4
+
+typedef struct {
+    char              model_path[256];
+    char              weights_path[256]; // Defaults to the model path
+    char              tokenizer_path[256];
+    char              fp32_path[256]; // Container of FP32 layer weights to quantize from
+    char              output_path[256];
+    uint32_t          group_size;   // Columns per quantization group (0 keeps the weights')
+    float             prune_rate;   // Fraction of dense and output weights to remove
+    bool              prune_blocks; // Remove whole BSR blocks instead of single weights
+    float             min_sparsity; // Sparsity from which a layer may run sparse
+    bool              benchmark;    // Time the weight formats instead of estimating them
+    TinyAICompression compression;  // Codec of the streaming container (NONE: not written)
+    bool              checksums;    // Store CRC-32s in the streaming container
+    bool              verbose;
+} PackConfig;
+
+static const char *const k_layer_names[] = {"embedding", "dense",     "rnn",
+                                            "attention", "layernorm", "output"};
+static const char *const k_format_names[] = {"dense", "csr4", "bsr"};
+
+static long file_size(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// ----- Weight transforms -----
+
+// FP32 weights of a layer: from the container when there is one, else dequantized
+static TinyAIMatrixFP32 *layer_fp32_weights(const TinyAILayer *layer, TinyAIMappedModel *fp32,
+                                            uint32_t index)
+{
+    if (!fp32) {
+        return tinyaiDequantize4bitToFP32(&layer->weights);
+    }
+
+    TinyAIMappedTensor tensor;
+    if (!tinyaiGetMappedTensor(fp32, (int)index, &tensor) ||
+        tensor.precision != TINYAI_PRECISION_FP32 || tensor.rows != layer->weights.rows ||
+        tensor.cols != layer->weights.cols) {
+        printf("Error: Tensor %u of the FP32 weights does not match layer %u (%u x %u)\n", index,
+               index, layer->weights.rows, layer->weights.cols);
+        return NULL;
+    }
+
+    // Compressed tensors are decompressed into the layer cache
+    const float *data = tensor.data ? (const float *)tensor.data
+                                    : (const float *)tinyaiGetLayerWeights(fp32, (int)index);
+    TinyAIMatrixFP32 *matrix = tinyaiCreateMatrixFP32(tensor.rows, tensor.cols);
+    if (!data || !matrix) {
+        tinyaiDestroyMatrixFP32(matrix);
+        return NULL;
+    }
+    memcpy(matrix->data, data, (size_t)tensor.rows * tensor.cols * sizeof(float));
+    return matrix;
+}
+
+// Prune and requantize the weights of one layer in place
+static bool pack_layer_weights(TinyAILayer *layer, uint32_t index, TinyAIMappedModel *fp32,
+                               const PackConfig *config)
+{
+    bool prunable = layer->type == TINYAI_LAYER_DENSE || layer->type == TINYAI_LAYER_OUTPUT;
+    bool prune    = prunable && config->prune_rate > 0.0f;
+    if (!fp32 && !prune && config->group_size == 0) {
+        return true;
+    }
+
+    TinyAIMatrixFP32 *weights = layer_fp32_weights(layer, fp32, index);
+    if (!weights) {
+        return false;
+    }
+
+    int  rows = (int)weights->rows;
+    int  cols = (int)weights->cols;
+    bool ok   = true;
+    if (prune) {
+        ok = config->prune_blocks
+                 ? tinyaiPruneMatrixBlocks(weights->data, rows, cols, PRUNE_BLOCK_ROWS,
+                                           PRUNE_BLOCK_COLS, config->prune_rate)
+                 : tinyaiPruneMatrixByMagnitude(weights->data, rows, cols, config->prune_rate);
+    }
+
+    // Without a new group size the layer keeps the grouping it was converted with
+    uint32_t          group_size = config->group_size ? config->group_size
+                                                      : layer->weights.groupSize;
+    TinyAIMatrix4bit *quantized  = NULL;
+    if (ok) {
+        quantized = group_size > 0 ? tinyaiQuantizeFP32To4bitGrouped(weights, group_size)
+                                   : tinyaiQuantizeFP32To4bit(weights);
+    }
+    tinyaiDestroyMatrixFP32(weights);
+    if (!quantized) {
+        printf("Error: Failed to quantize layer %u\n", index);
+        return false;
+    }
+
+    tinyaiReleaseMatrix4bit(&layer->weights);
+    layer->weights = *quantized; // The layer owns the data from here on
+    TINYAI_FREE(quantized);
+    return true;
+}
+
+// ----- Verification -----
+
+// Check that the snapshot loads and computes exactly the logits of the packed model
+static bool verify_snapshot(TinyAIModel *model, const char *path)
+{
+    TinyAIModel *loaded = tinyaiLoadModelSnapshot(path);
+    if (!loaded) {
+        printf("Error: The snapshot %s does not load\n", path);
+        return false;
+    }
+
+    uint32_t vocab_size = model->tokenizer->tokenCount;
+    int      tokens[VERIFY_TOKENS];
+    for (int i = 0; i < VERIFY_TOKENS; i++) {
+        tokens[i] = (int)((uint32_t)(i * 7 + 1) % vocab_size);
+    }
+
+    float *expected = (float *)malloc(vocab_size * sizeof(float));
+    float *actual   = (float *)malloc(vocab_size * sizeof(float));
+    bool   ok       = expected && actual &&
+              tinyaiModelForward(model, tokens, VERIFY_TOKENS, expected) == 0 &&
+              tinyaiModelForward(loaded, tokens, VERIFY_TOKENS, actual) == 0 &&
+              memcmp(expected, actual, vocab_size * sizeof(float)) == 0;
+    if (!ok) {
+        printf("Error: The snapshot's logits differ from the packed model's\n");
+    }
+
+    free(expected);
+    free(actual);
+    tinyaiDestroyModel(loaded);
+    return ok;
+}
+
+// ----- Streaming container -----
+
+// Write the packed layer weights as a compressed tensor container, one tensor per layer
+static bool write_stream_container(const TinyAIModel *model, const char *path,
+                                   const PackConfig *config)
+{
+    TinyAIContainerTensor *tensors =
+        (TinyAIContainerTensor *)calloc(model->layerCount, sizeof(TinyAIContainerTensor));
+    char (*names)[TINYAI_CONTAINER_NAME_SIZE] =
+        calloc(model->layerCount, TINYAI_CONTAINER_NAME_SIZE);
+
+    // Layers without packed weights (attention, layer norm) get a stand-in
+    TinyAIMatrix4bit *stand_in = tinyaiCreateMatrix4bit(1, 2);
+    bool              ok       = tensors && names && stand_in;
+    for (uint32_t i = 0; ok && i < model->layerCount; i++) {
+        const TinyAIMatrix4bit *weights = &model->layers[i].weights;
+        snprintf(names[i], TINYAI_CONTAINER_NAME_SIZE, "layer.%u", i);
+        tensors[i].name        = names[i];
+        tensors[i].matrix      = weights->rows > 0 ? weights : stand_in;
+        tensors[i].precision   = TINYAI_PRECISION_INT4;
+        tensors[i].compression = config->compression;
+    }
+    ok = ok && tinyaiWriteTensorContainer(path, tensors, model->layerCount, config->checksums);
+    if (!ok) {
+        printf("Error: Failed to write the streaming container %s\n", path);
+    }
+
+    tinyaiDestroyMatrix4bit(stand_in);
+    free(names);
+    free(tensors);
+    return ok;
+}
+
+// ----- Driver -----
+
+void print_usage(const char *program_name)
+{
+    printf("Usage: %s -model <file> -tokenizer <file> -output <file> [options]\n\n",
+           program_name);
+    printf("Options:\n");
+    printf("  -model <file>           Model structure file\n");
+    printf("  -weights <file>         Model weights file (default: the model file)\n");
+    printf("  -tokenizer <file>       Vocabulary file\n");
+    printf("  -output <file>          Snapshot to write\n");
+    printf("  -fp32 <file>            Tensor container of FP32 layer weights to quantize from\n");
+    printf("  -group_size <n>         Quantize each group of n columns on its own scale\n");
+    printf("  -prune <rate>           Remove this fraction of the dense and output weights\n");
+    printf("  -prune_blocks           Remove whole BSR blocks instead of single weights\n");
+    printf("  -min_sparsity <s>       Sparsity from which layers may run sparse (default: %.2f)\n",
+           DEFAULT_MIN_SPARSITY);
+    printf("  -benchmark              Time the weight formats on this host\n");
+    printf("  -compress <codec>       Also write the weights compressed (lz4, zstd) to\n");
+    printf("                          <output>.tqtc for streaming\n");
+    printf("  -checksums              Store CRC-32 checksums in the streaming container\n");
+    printf("  -v                      Verbose output\n");
+    printf("  -h                      Show this help message\n");
+}
+
+void parse_args(int argc, char **argv, PackConfig *config)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-model") == 0 && i + 1 < argc) {
+            strncpy(config->model_path, argv[++i], sizeof(config->model_path) - 1);
+        }
+        else if (strcmp(argv[i], "-weights") == 0 && i + 1 < argc) {
+            strncpy(config->weights_path, argv[++i], sizeof(config->weights_path) - 1);
+        }
+        else if (strcmp(argv[i], "-tokenizer") == 0 && i + 1 < argc) {
+            strncpy(config->tokenizer_path, argv[++i], sizeof(config->tokenizer_path) - 1);
+        }
+        else if (strcmp(argv[i], "-output") == 0 && i + 1 < argc) {
+            strncpy(config->output_path, argv[++i], sizeof(config->output_path) - 1);
+        }
+        else if (strcmp(argv[i], "-fp32") == 0 && i + 1 < argc) {
+            strncpy(config->fp32_path, argv[++i], sizeof(config->fp32_path) - 1);
+        }
+        else if (strcmp(argv[i], "-group_size") == 0 && i + 1 < argc) {
+            config->group_size = (uint32_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-prune") == 0 && i + 1 < argc) {
+            config->prune_rate = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-prune_blocks") == 0) {
+            config->prune_blocks = true;
+        }
+        else if (strcmp(argv[i], "-min_sparsity") == 0 && i + 1 < argc) {
+            config->min_sparsity = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-benchmark") == 0) {
+            config->benchmark = true;
+        }
+        else if (strcmp(argv[i], "-compress") == 0 && i + 1 < argc) {
+            const char *codec = argv[++i];
+            if (strcmp(codec, "lz4") == 0) {
+                config->compression = TINYAI_COMPRESSION_LZ4;
+            }
+            else if (strcmp(codec, "zstd") == 0) {
+                config->compression = TINYAI_COMPRESSION_ZSTD;
+            }
+            else {
+                printf("Unknown codec: %s\n", codec);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-checksums") == 0) {
+            config->checksums = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0) {
+            config->verbose = true;
+        }
+        else if (strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            exit(0);
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    PackConfig config;
+    memset(&config, 0, sizeof(config));
+    config.min_sparsity = DEFAULT_MIN_SPARSITY;
+
+    parse_args(argc, argv, &config);
+    if (!config.model_path[0] || !config.tokenizer_path[0] || !config.output_path[0]) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (config.prune_rate < 0.0f || config.prune_rate >= 1.0f) {
+        printf("Error: The prune rate must be in [0, 1)\n");
+        return 1;
+    }
+    // Requantizing 4-bit weights into groups would only compound their rounding
+    if (config.group_size > 0 && !config.fp32_path[0]) {
+        printf("Error: Group quantization needs the FP32 weights (-fp32)\n");
+        return 1;
+    }
+    if (config.compression != TINYAI_COMPRESSION_NONE &&
+        !tinyaiCompressionAvailable(config.compression)) {
+        printf("Error: The codec was not built in\n");
+        return 1;
+    }
+
+    // The execution plan reads its sparse-format settings from the configuration
+    if (tinyaiConfigInit() != 0) {
+        printf("Error: Failed to initialize the configuration\n");
+        return 1;
+    }
+    tinyaiConfigSetFloat("model.sparse_min_sparsity", config.min_sparsity);
+    tinyaiConfigSetBool("model.sparse_benchmark", config.benchmark);
+
+    TinyAIModel *model =
+        tinyaiLoadModel(config.model_path,
+                        config.weights_path[0] ? config.weights_path : config.model_path,
+                        config.tokenizer_path);
+    if (!model) {
+        printf("Error: Failed to load the model %s\n", config.model_path);
+        return 1;
+    }
+
+    TinyAIMappedModel *fp32 = NULL;
+    if (config.fp32_path[0]) {
+        TinyAIMmapConfig mmap_config = tinyaiCreateDefaultMmapConfig();
+        fp32                         = tinyaiOpenMappedModel(config.fp32_path, &mmap_config);
+        if (!fp32 || tinyaiGetMappedLayerCount(fp32) < (int)model->layerCount) {
+            printf("Error: %s does not hold a tensor per layer\n", config.fp32_path);
+            tinyaiCloseMappedModel(fp32);
+            tinyaiDestroyModel(model);
+            return 1;
+        }
+    }
+
+    // Quantize and prune every layer with weights, then compile the plan that picks their formats
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < model->layerCount; i++) {
+        if (model->layers[i].weights.rows > 0) {
+            ok = pack_layer_weights(&model->layers[i], i, fp32, &config);
+        }
+    }
+    tinyaiCloseMappedModel(fp32);
+    if (!ok || tinyaiPrepareModel(model) != 0) {
+        printf("Error: Failed to prepare the packed model\n");
+        tinyaiDestroyModel(model);
+        return 1;
+    }
+
+    // The snapshot prepacks the weights into panels and embeds the binary vocabulary
+    if (tinyaiSaveModelSnapshot(model, config.output_path) != 0) {
+        printf("Error: Failed to write the snapshot %s\n", config.output_path);
+        tinyaiDestroyModel(model);
+        return 1;
+    }
+
+    char stream_path[272] = "";
+    if (config.compression != TINYAI_COMPRESSION_NONE) {
+        snprintf(stream_path, sizeof(stream_path), "%s.tqtc", config.output_path);
+        ok = write_stream_container(model, stream_path, &config);
+    }
+    ok = ok && verify_snapshot(model, config.output_path);
+
+    printf("%-5s %-10s %12s %8s %8s\n", "Layer", "Type", "Weights", "Groups", "Format");
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        const TinyAILayer *layer  = &model->layers[i];
+        int                format = tinyaiGetLayerWeightFormat(model, i);
+        if (layer->weights.rows == 0 && !config.verbose) {
+            continue;
+        }
+        printf("%-5u %-10s %5u x %-5u %8u %8s\n", i,
+               layer->type <= TINYAI_LAYER_OUTPUT ? k_layer_names[layer->type] : "unknown",
+               layer->weights.rows, layer->weights.cols, layer->weights.groupSize,
+               format >= 0 && format <= TINYAI_WEIGHT_FORMAT_BSR ? k_format_names[format] : "-");
+    }
+    printf("Snapshot: %s (%ld bytes)\n", config.output_path, file_size(config.output_path));
+    if (stream_path[0]) {
+        printf("Streaming container: %s (%ld bytes)\n", stream_path, file_size(stream_path));
+    }
+
+    tinyaiDestroyModel(model);
+    return ok ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 
 #include "advanced_memory_pool.h"
 #include "../core/logging.h"
+#include "numa.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,6 +14,9 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
 #endif
 
 /* Default configuration values */
@@ -20,6 +24,11 @@
 #define DEFAULT_OPTIMIZE_FOR_TENSOR_OPS true
 #define DEFAULT_ENABLE_AUTO_RESIZE true
 #define DEFAULT_AGGRESSIVE_DEFRAG false
+#define DEFAULT_HUGE_PAGES false
+#define DEFAULT_COMPACT_THRESHOLD 30
+
+/* Data moved per compaction step, which bounds how long the lock is held */
+#define COMPACT_CHUNK_BYTES (256 * 1024)
 
 /* Size class limits in bytes */
 #define SIZE_TINY_LIMIT 64
@@ -53,12 +62,25 @@
 #define GENERAL_XLARGE_CAPACITY (8 * 1024 * 1024) /* 8 MB */
 #define GENERAL_HUGE_CAPACITY (32 * 1024 * 1024)  /* 32 MB */
 
+/* Default pool capacities for key/value cache blocks (only large blocks get their own pools) */
+#define KV_CACHE_XLARGE_CAPACITY (8 * 1024 * 1024) /* 8 MB */
+#define KV_CACHE_HUGE_CAPACITY (64 * 1024 * 1024)  /* 64 MB */
+
 /* Maximum capacity multipliers */
 #define MAX_CAPACITY_MULTIPLIER 4
 
 /* Allocation cache */
 #define ALLOCATION_CACHE_SIZE 64
 
+/* Thread caches: magazines of same-class blocks, swapped with a central depot in batches */
+#define MAGAZINE_ROUNDS 32             /* Blocks per magazine */
+#define MAGAZINE_BATCH 16              /* Blocks fetched from the pools per refill */
+#define MAGAZINE_DEPOT_LIMIT 8         /* Full magazines kept per usage/size class */
+#define MAGAZINE_MAX_CLASS TINYAI_POOL_SIZE_LARGE /* Largest size class served by magazines */
+#define MAGAZINE_ALIGNMENT 32          /* Alignment of magazine blocks */
+#define MAGAZINE_HEADER_SIZE 32        /* Tag in front of each magazine block */
+#define MAGAZINE_MAGIC 0x4D41475AU     /* "MAGZ" */
+
 /* Memory pressure thresholds */
 #define MEMORY_PRESSURE_LOW 30
 #define MEMORY_PRESSURE_MEDIUM 60
@@ -78,6 +100,41 @@ typedef struct {
     TinyAIPoolSizeClass    sizeClass;
 } AllocationCacheEntry;
 
+/* Tag stored in front of every block handed out through the thread caches */
+typedef struct {
+    uint32_t          magic;
+    uint8_t           usage;     /* Usage pattern the block is cached under */
+    uint8_t           sizeClass; /* Size class; the block holds its full class limit */
+    TinyAIMemoryPool *source;    /* Pool the block was carved from */
+    void             *user;      /* Pointer handed to the caller, for validation */
+} MagazineTag;
+
+/* Fixed-capacity stack of free blocks of one usage/size class */
+typedef struct Magazine {
+    struct Magazine *next; /* Link in the depot lists */
+    int              count;
+    void            *rounds[MAGAZINE_ROUNDS];
+} Magazine;
+
+/* A thread's pair of magazines for one usage/size class */
+typedef struct {
+    Magazine *loaded;   /* Serves allocations and frees */
+    Magazine *previous; /* Swapped in when loaded runs empty or full */
+} MagazineSlot;
+
+/* Per-thread cache of one advanced pool; only the owning thread touches it */
+typedef struct ThreadCache {
+    struct TinyAIAdvancedMemoryPool *pool;
+    MagazineSlot                     slots[TINYAI_POOL_USAGE_COUNT][MAGAZINE_MAX_CLASS + 1];
+    struct ThreadCache              *next; /* Link in the pool's list of caches */
+
+    /* Statistics not yet folded into the pool */
+    size_t allocCount;
+    size_t freeCount;
+    size_t cacheHits;
+    size_t cacheMisses;
+} ThreadCache;
+
 /* Tensor operation descriptor */
 typedef struct {
     int    opType;
@@ -93,6 +150,10 @@ struct TinyAIAdvancedMemoryPool {
     /* The actual memory pools organized by usage and size */
     TinyAIMemoryPool *pools[TINYAI_POOL_USAGE_COUNT][TINYAI_POOL_SIZE_COUNT];
 
+    /* Per-node arenas; when there are any, this pool has no pools of its own and routes */
+    struct TinyAIAdvancedMemoryPool *arenas[TINYAI_NUMA_MAX_NODES];
+    int                              numArenas;
+
     /* Configuration */
     TinyAIAdvancedPoolConfig config;
 
@@ -117,12 +178,45 @@ struct TinyAIAdvancedMemoryPool {
     void (*pressureCallback)(void *userData, uint8_t pressureLevel);
     void *pressureCallbackUserData;
 
-    /* Thread safety control */
+    /* Thread safety control; the lock guards everything but the thread caches */
     bool threadSafetyEnabled;
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+    DWORD            cacheKey;
+#else
+    pthread_mutex_t lock;
+    pthread_key_t   cacheKey;
+#endif
+    bool lockCreated;
+    bool cacheKeyCreated;
+
+    /* Thread caches and their depot */
+    ThreadCache *threadCaches;
+    Magazine    *fullMagazines[TINYAI_POOL_USAGE_COUNT][MAGAZINE_MAX_CLASS + 1];
+    int          fullMagazineCount[TINYAI_POOL_USAGE_COUNT][MAGAZINE_MAX_CLASS + 1];
+    Magazine    *emptyMagazines;
 
     /* Tensor operation optimization */
     TensorOpDescriptor tensorOps[MAX_TENSOR_OPS];
     int                numTensorOps;
+
+    /* Movable allocations, in a pool of their own created on first use */
+    TinyAIMemoryPool *movable;
+
+    /* Background compaction */
+    bool     compactorRunning;
+    bool     compactorStop;
+    uint32_t compactInterval; /* Milliseconds between slices */
+    double   compactSlice;    /* Milliseconds per slice */
+#ifdef _WIN32
+    HANDLE             compactor;
+    CRITICAL_SECTION   compactorLock;
+    CONDITION_VARIABLE compactorWake;
+#else
+    pthread_t       compactor;
+    pthread_mutex_t compactorLock;
+    pthread_cond_t  compactorWake;
+#endif
 };
 
 /* Helper functions prototypes */
@@ -136,6 +230,14 @@ static void                  addToCache(TinyAIAdvancedMemoryPool *pool, void *pt
 static AllocationCacheEntry *findInCache(TinyAIAdvancedMemoryPool *pool, void *ptr);
 static void                  removeFromCache(TinyAIAdvancedMemoryPool *pool, void *ptr);
 static double                getCurrentTimeMs();
+static void                  freeThreadCaches(TinyAIAdvancedMemoryPool *pool);
+static TinyAIAdvancedMemoryPool *localArena(TinyAIAdvancedMemoryPool *pool);
+static TinyAIAdvancedMemoryPool *arenaOf(TinyAIAdvancedMemoryPool *pool, const void *ptr);
+#ifdef _WIN32
+static VOID WINAPI releaseThreadCache(PVOID value);
+#else
+static void releaseThreadCache(void *value);
+#endif
 
 /**
  * Get default advanced memory pool configuration
@@ -203,6 +305,12 @@ void tinyaiAdvancedPoolGetDefaultConfig(TinyAIAdvancedPoolConfig *config)
     config->initialCapacity[TINYAI_POOL_USAGE_GENERAL][TINYAI_POOL_SIZE_HUGE] =
         GENERAL_HUGE_CAPACITY;
 
+    /* Key/value cache pools; smaller requests fall back to the general pools */
+    config->initialCapacity[TINYAI_POOL_USAGE_KV_CACHE][TINYAI_POOL_SIZE_XLARGE] =
+        KV_CACHE_XLARGE_CAPACITY;
+    config->initialCapacity[TINYAI_POOL_USAGE_KV_CACHE][TINYAI_POOL_SIZE_HUGE] =
+        KV_CACHE_HUGE_CAPACITY;
+
     /* Set max capacities (for now, just multiply initial by MAX_CAPACITY_MULTIPLIER) */
     for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
         for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
@@ -216,6 +324,9 @@ void tinyaiAdvancedPoolGetDefaultConfig(TinyAIAdvancedPoolConfig *config)
     config->optimizeForTensorOps = DEFAULT_OPTIMIZE_FOR_TENSOR_OPS;
     config->enableAutoResize     = DEFAULT_ENABLE_AUTO_RESIZE;
     config->aggressiveDefrag     = DEFAULT_AGGRESSIVE_DEFRAG;
+    config->hugePages            = DEFAULT_HUGE_PAGES;
+    config->numaArenas           = tinyaiNumaGetMode() != TINYAI_NUMA_OFF;
+    config->compactThreshold     = DEFAULT_COMPACT_THRESHOLD;
 }
 
 /**
@@ -240,6 +351,39 @@ TinyAIAdvancedMemoryPool *tinyaiAdvancedPoolCreate(const TinyAIAdvancedPoolConfi
     /* Copy configuration */
     memcpy(&advPool->config, config, sizeof(TinyAIAdvancedPoolConfig));
 
+    /* Set up the shared lock and the key of the per-thread caches */
+#ifdef _WIN32
+    InitializeCriticalSection(&advPool->lock);
+    advPool->lockCreated     = true;
+    advPool->cacheKey        = FlsAlloc(releaseThreadCache);
+    advPool->cacheKeyCreated = advPool->cacheKey != FLS_OUT_OF_INDEXES;
+#else
+    advPool->lockCreated     = pthread_mutex_init(&advPool->lock, NULL) == 0;
+    advPool->cacheKeyCreated = pthread_key_create(&advPool->cacheKey, releaseThreadCache) == 0;
+#endif
+    if (!advPool->lockCreated || !advPool->cacheKeyCreated) {
+        tinyaiAdvancedPoolDestroy(advPool);
+        return NULL;
+    }
+    advPool->threadSafetyEnabled = config->threadSafe;
+
+    /* With per-node arenas this pool only routes requests to them */
+    int numNodes = config->numaArenas ? tinyaiNumaNodeCount() : 1;
+    if (numNodes > 1) {
+        TinyAIAdvancedPoolConfig arenaConfig = *config;
+        arenaConfig.numaArenas               = false;
+        for (int node = 0; node < numNodes; node++) {
+            arenaConfig.baseConfig.numaNode = node;
+            advPool->arenas[node]           = tinyaiAdvancedPoolCreate(&arenaConfig);
+            if (!advPool->arenas[node]) {
+                tinyaiAdvancedPoolDestroy(advPool);
+                return NULL;
+            }
+            advPool->numArenas++;
+        }
+        return advPool;
+    }
+
     /* Create individual pools for each usage/size combination */
     for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
         for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
@@ -254,6 +398,12 @@ TinyAIAdvancedMemoryPool *tinyaiAdvancedPoolCreate(const TinyAIAdvancedPoolConfi
             poolConfig.initialCapacity        = config->initialCapacity[usage][size];
             poolConfig.maxCapacity            = config->maxCapacity[usage][size];
 
+            /* Weights and key/value caches are large, long-lived and read end to end */
+            if (config->hugePages && (usage == TINYAI_POOL_USAGE_WEIGHTS ||
+                                      usage == TINYAI_POOL_USAGE_KV_CACHE)) {
+                poolConfig.useHugePages = true;
+            }
+
             /* Adjust block size based on size class for efficiency */
             switch (size) {
             case TINYAI_POOL_SIZE_TINY:
@@ -287,7 +437,6 @@ TinyAIAdvancedMemoryPool *tinyaiAdvancedPoolCreate(const TinyAIAdvancedPoolConfi
     }
 
     /* Initialize other properties */
-    advPool->threadSafetyEnabled      = config->threadSafe;
     advPool->cacheSize                = 0;
     advPool->currentPressure          = 0;
     advPool->outOfMemoryEventOccurred = false;
@@ -306,6 +455,22 @@ void tinyaiAdvancedPoolDestroy(TinyAIAdvancedMemoryPool *pool)
         return;
     }
 
+    tinyaiAdvancedPoolStopCompactor(pool);
+
+    /* Drop the thread caches; on Windows freeing the key releases them through the pool */
+    if (pool->cacheKeyCreated) {
+#ifdef _WIN32
+        FlsFree(pool->cacheKey);
+#else
+        pthread_key_delete(pool->cacheKey);
+#endif
+    }
+    freeThreadCaches(pool);
+
+    for (int node = 0; node < pool->numArenas; node++) {
+        tinyaiAdvancedPoolDestroy(pool->arenas[node]);
+    }
+
     /* Destroy all individual pools */
     for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
         for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
@@ -315,6 +480,15 @@ void tinyaiAdvancedPoolDestroy(TinyAIAdvancedMemoryPool *pool)
             }
         }
     }
+    tinyaiMemoryPoolDestroy(pool->movable);
+
+    if (pool->lockCreated) {
+#ifdef _WIN32
+        DeleteCriticalSection(&pool->lock);
+#else
+        pthread_mutex_destroy(&pool->lock);
+#endif
+    }
 
     /* Free the advanced pool structure */
     free(pool);
@@ -472,15 +646,437 @@ static void updateMemoryPressure(TinyAIAdvancedMemoryPool *pool)
 }
 
 /**
- * Allocate memory from the appropriate pool based on size and usage pattern
+ * Lock the shared pool state when thread safety is enabled
  */
-void *tinyaiAdvancedPoolAlloc(TinyAIAdvancedMemoryPool *pool, size_t size, size_t alignment,
-                              TinyAIPoolUsagePattern usage)
+static void lockPool(TinyAIAdvancedMemoryPool *pool)
 {
-    if (!pool || size == 0 || usage >= TINYAI_POOL_USAGE_COUNT) {
+    if (pool->threadSafetyEnabled) {
+#ifdef _WIN32
+        EnterCriticalSection(&pool->lock);
+#else
+        pthread_mutex_lock(&pool->lock);
+#endif
+    }
+}
+
+/**
+ * Unlock the shared pool state
+ */
+static void unlockPool(TinyAIAdvancedMemoryPool *pool)
+{
+    if (pool->threadSafetyEnabled) {
+#ifdef _WIN32
+        LeaveCriticalSection(&pool->lock);
+#else
+        pthread_mutex_unlock(&pool->lock);
+#endif
+    }
+}
+
+/**
+ * Get the calling thread's cache of a pool, optionally creating it
+ */
+static ThreadCache *getThreadCache(TinyAIAdvancedMemoryPool *pool, bool create)
+{
+#ifdef _WIN32
+    ThreadCache *cache = (ThreadCache *)FlsGetValue(pool->cacheKey);
+#else
+    ThreadCache *cache = (ThreadCache *)pthread_getspecific(pool->cacheKey);
+#endif
+    if (cache || !create) {
+        return cache;
+    }
+
+    cache = (ThreadCache *)malloc(sizeof(ThreadCache));
+    if (!cache) {
+        return NULL;
+    }
+    memset(cache, 0, sizeof(ThreadCache));
+    cache->pool = pool;
+
+#ifdef _WIN32
+    if (!FlsSetValue(pool->cacheKey, cache)) {
+#else
+    if (pthread_setspecific(pool->cacheKey, cache) != 0) {
+#endif
+        free(cache);
+        return NULL;
+    }
+
+    lockPool(pool);
+    cache->next        = pool->threadCaches;
+    pool->threadCaches = cache;
+    unlockPool(pool);
+
+    return cache;
+}
+
+/**
+ * Fold a thread cache's statistics into the pool (lock held)
+ */
+static void flushThreadCacheStats(TinyAIAdvancedMemoryPool *pool, ThreadCache *cache)
+{
+    pool->allocCount += cache->allocCount;
+    pool->freeCount += cache->freeCount;
+    pool->cacheHits += cache->cacheHits;
+    pool->cacheMisses += cache->cacheMisses;
+
+    cache->allocCount  = 0;
+    cache->freeCount   = 0;
+    cache->cacheHits   = 0;
+    cache->cacheMisses = 0;
+}
+
+/**
+ * Get the tag of a block handed out through the thread caches, or NULL for other blocks
+ */
+static MagazineTag *magazineTag(void *ptr)
+{
+    if (((uintptr_t)ptr & (MAGAZINE_ALIGNMENT - 1)) != 0) {
+        return NULL;
+    }
+
+    MagazineTag *tag = (MagazineTag *)((char *)ptr - MAGAZINE_HEADER_SIZE);
+    return (tag->magic == MAGAZINE_MAGIC && tag->user == ptr) ? tag : NULL;
+}
+
+/**
+ * Carve a tagged block holding a whole size class from the pools (lock held)
+ */
+static void *allocMagazineBlock(TinyAIAdvancedMemoryPool *pool, TinyAIPoolUsagePattern usage,
+                                TinyAIPoolSizeClass sizeClass)
+{
+    size_t            size   = MAGAZINE_HEADER_SIZE + pool->config.sizeClassLimits[sizeClass];
+    TinyAIMemoryPool *source = pool->pools[usage][sizeClass];
+    void             *block  = source ? tinyaiMemoryPoolAlloc(source, size, MAGAZINE_ALIGNMENT)
+                                      : NULL;
+
+    /* Fall back to the general pool, as uncached allocations do */
+    if (!block && usage != TINYAI_POOL_USAGE_GENERAL) {
+        if (source) {
+            pool->outOfMemoryEventOccurred = true;
+        }
+        source = pool->pools[TINYAI_POOL_USAGE_GENERAL][sizeClass];
+        block  = source ? tinyaiMemoryPoolAlloc(source, size, MAGAZINE_ALIGNMENT) : NULL;
+        if (block) {
+            pool->poolSwitches++;
+        }
+    }
+    if (!block) {
+        pool->outOfMemoryEventOccurred = true;
         return NULL;
     }
 
+    MagazineTag *tag = (MagazineTag *)block;
+    tag->magic       = MAGAZINE_MAGIC;
+    tag->usage       = (uint8_t)usage;
+    tag->sizeClass   = (uint8_t)sizeClass;
+    tag->source      = source;
+    tag->user        = (char *)block + MAGAZINE_HEADER_SIZE;
+
+    return tag->user;
+}
+
+/**
+ * Return the blocks of a magazine to their pools (lock held)
+ */
+static void releaseMagazineBlocks(Magazine *magazine)
+{
+    for (int i = 0; i < magazine->count; i++) {
+        MagazineTag *tag = (MagazineTag *)((char *)magazine->rounds[i] - MAGAZINE_HEADER_SIZE);
+        tag->magic       = 0;
+        tinyaiMemoryPoolFree(tag->source, tag);
+    }
+    magazine->count = 0;
+}
+
+/**
+ * Take an empty magazine from the depot, or allocate one (lock held)
+ */
+static Magazine *takeEmptyMagazine(TinyAIAdvancedMemoryPool *pool)
+{
+    Magazine *magazine = pool->emptyMagazines;
+    if (magazine) {
+        pool->emptyMagazines = magazine->next;
+    }
+    else {
+        magazine = (Magazine *)malloc(sizeof(Magazine));
+        if (!magazine) {
+            return NULL;
+        }
+    }
+
+    magazine->next  = NULL;
+    magazine->count = 0;
+    return magazine;
+}
+
+/**
+ * Hand a magazine back to the depot, releasing its blocks if the depot is full (lock held)
+ */
+static void depositMagazine(TinyAIAdvancedMemoryPool *pool, TinyAIPoolUsagePattern usage,
+                            TinyAIPoolSizeClass sizeClass, Magazine *magazine)
+{
+    if (!magazine) {
+        return;
+    }
+
+    if (magazine->count > 0 && pool->fullMagazineCount[usage][sizeClass] < MAGAZINE_DEPOT_LIMIT) {
+        magazine->next                        = pool->fullMagazines[usage][sizeClass];
+        pool->fullMagazines[usage][sizeClass] = magazine;
+        pool->fullMagazineCount[usage][sizeClass]++;
+        return;
+    }
+
+    releaseMagazineBlocks(magazine);
+    magazine->next       = pool->emptyMagazines;
+    pool->emptyMagazines = magazine;
+}
+
+/**
+ * Load a slot whose magazines are both empty, from the depot or the pools (lock held)
+ */
+static bool refillMagazine(TinyAIAdvancedMemoryPool *pool, MagazineSlot *slot,
+                           TinyAIPoolUsagePattern usage, TinyAIPoolSizeClass sizeClass)
+{
+    /* Prefer a full magazine freed by another thread */
+    Magazine *full = pool->fullMagazines[usage][sizeClass];
+    if (full) {
+        pool->fullMagazines[usage][sizeClass] = full->next;
+        pool->fullMagazineCount[usage][sizeClass]--;
+
+        if (slot->previous) {
+            slot->previous->next = pool->emptyMagazines;
+            pool->emptyMagazines = slot->previous;
+        }
+        slot->previous = slot->loaded;
+        slot->loaded   = full;
+        return true;
+    }
+
+    /* Otherwise carve a batch of blocks from the pools */
+    if (!slot->loaded) {
+        slot->loaded = takeEmptyMagazine(pool);
+        if (!slot->loaded) {
+            return false;
+        }
+    }
+    while (slot->loaded->count < MAGAZINE_BATCH) {
+        void *block = allocMagazineBlock(pool, usage, sizeClass);
+        if (!block) {
+            break;
+        }
+        slot->loaded->rounds[slot->loaded->count++] = block;
+    }
+
+    if (slot->loaded->count == 0) {
+        return false;
+    }
+    updateMemoryPressure(pool);
+    return true;
+}
+
+/**
+ * Allocate a block from the calling thread's cache
+ */
+static void *cacheAlloc(TinyAIAdvancedMemoryPool *pool, ThreadCache *cache,
+                        TinyAIPoolUsagePattern usage, TinyAIPoolSizeClass sizeClass)
+{
+    MagazineSlot *slot = &cache->slots[usage][sizeClass];
+
+    if (slot->loaded && slot->loaded->count > 0) {
+        cache->cacheHits++;
+    }
+    else if (slot->previous && slot->previous->count > 0) {
+        /* The previous magazine is full, swap it in */
+        Magazine *magazine = slot->loaded;
+        slot->loaded       = slot->previous;
+        slot->previous     = magazine;
+        cache->cacheHits++;
+    }
+    else {
+        /* Both magazines are empty, go to the depot */
+        cache->cacheMisses++;
+
+        lockPool(pool);
+        bool loaded = refillMagazine(pool, slot, usage, sizeClass);
+        flushThreadCacheStats(pool, cache);
+        unlockPool(pool);
+
+        if (!loaded) {
+            return NULL;
+        }
+    }
+
+    cache->allocCount++;
+    return slot->loaded->rounds[--slot->loaded->count];
+}
+
+/**
+ * Free a tagged block into the calling thread's cache
+ */
+static void cacheFree(TinyAIAdvancedMemoryPool *pool, ThreadCache *cache, void *ptr,
+                      MagazineTag *tag)
+{
+    MagazineSlot *slot = &cache->slots[tag->usage][tag->sizeClass];
+
+    if (!slot->loaded || slot->loaded->count == MAGAZINE_ROUNDS) {
+        if (slot->loaded && slot->previous && slot->previous->count == 0) {
+            /* The previous magazine is empty, swap it in */
+            Magazine *magazine = slot->loaded;
+            slot->loaded       = slot->previous;
+            slot->previous     = magazine;
+        }
+        else {
+            /* Both magazines are full, hand one to the depot */
+            lockPool(pool);
+            if (slot->loaded) {
+                depositMagazine(pool, (TinyAIPoolUsagePattern)tag->usage,
+                                (TinyAIPoolSizeClass)tag->sizeClass, slot->previous);
+                slot->previous = slot->loaded;
+            }
+            slot->loaded = takeEmptyMagazine(pool);
+            if (!slot->loaded) {
+                tag->magic = 0;
+                tinyaiMemoryPoolFree(tag->source, tag);
+                pool->freeCount++;
+            }
+            flushThreadCacheStats(pool, cache);
+            unlockPool(pool);
+
+            if (!slot->loaded) {
+                return;
+            }
+        }
+    }
+
+    cache->freeCount++;
+    slot->loaded->rounds[slot->loaded->count++] = ptr;
+}
+
+/**
+ * Move a thread cache's blocks to the depot and unlink it from the pool (lock held)
+ */
+static void detachThreadCache(TinyAIAdvancedMemoryPool *pool, ThreadCache *cache)
+{
+    for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+        for (int size = 0; size <= MAGAZINE_MAX_CLASS; size++) {
+            MagazineSlot *slot = &cache->slots[usage][size];
+            depositMagazine(pool, (TinyAIPoolUsagePattern)usage, (TinyAIPoolSizeClass)size,
+                            slot->loaded);
+            depositMagazine(pool, (TinyAIPoolUsagePattern)usage, (TinyAIPoolSizeClass)size,
+                            slot->previous);
+            slot->loaded   = NULL;
+            slot->previous = NULL;
+        }
+    }
+    flushThreadCacheStats(pool, cache);
+
+    ThreadCache **link = &pool->threadCaches;
+    while (*link && *link != cache) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = cache->next;
+    }
+}
+
+/**
+ * Release a thread's cache when the thread exits
+ */
+#ifdef _WIN32
+static VOID WINAPI releaseThreadCache(PVOID value)
+#else
+static void releaseThreadCache(void *value)
+#endif
+{
+    ThreadCache              *cache = (ThreadCache *)value;
+    TinyAIAdvancedMemoryPool *pool  = cache->pool;
+
+    lockPool(pool);
+    detachThreadCache(pool, cache);
+    unlockPool(pool);
+
+    free(cache);
+}
+
+/**
+ * Free a list of magazines
+ */
+static void freeMagazines(Magazine *magazine)
+{
+    while (magazine) {
+        Magazine *next = magazine->next;
+        free(magazine);
+        magazine = next;
+    }
+}
+
+/**
+ * Free all thread caches and the depot when the pool is destroyed
+ */
+static void freeThreadCaches(TinyAIAdvancedMemoryPool *pool)
+{
+    while (pool->threadCaches) {
+        ThreadCache *cache = pool->threadCaches;
+        pool->threadCaches = cache->next;
+
+        for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+            for (int size = 0; size <= MAGAZINE_MAX_CLASS; size++) {
+                if (cache->slots[usage][size].loaded) {
+                    free(cache->slots[usage][size].loaded);
+                }
+                if (cache->slots[usage][size].previous) {
+                    free(cache->slots[usage][size].previous);
+                }
+            }
+        }
+        free(cache);
+    }
+
+    for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+        for (int size = 0; size <= MAGAZINE_MAX_CLASS; size++) {
+            freeMagazines(pool->fullMagazines[usage][size]);
+            pool->fullMagazines[usage][size] = NULL;
+        }
+    }
+    freeMagazines(pool->emptyMagazines);
+    pool->emptyMagazines = NULL;
+}
+
+/**
+ * Get the arena of the node the calling thread runs on
+ */
+static TinyAIAdvancedMemoryPool *localArena(TinyAIAdvancedMemoryPool *pool)
+{
+    int node = tinyaiNumaCurrentNode();
+    return pool->arenas[node < pool->numArenas ? node : 0];
+}
+
+/**
+ * Get the arena whose pools a block was carved from, or NULL
+ */
+static TinyAIAdvancedMemoryPool *arenaOf(TinyAIAdvancedMemoryPool *pool, const void *ptr)
+{
+    for (int node = 0; node < pool->numArenas; node++) {
+        TinyAIAdvancedMemoryPool *arena = pool->arenas[node];
+        for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+            for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
+                if (tinyaiMemoryPoolOwns(arena->pools[usage][size], ptr)) {
+                    return arena;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Allocate from the pools themselves, bypassing the thread caches (lock held)
+ */
+static void *centralAlloc(TinyAIAdvancedMemoryPool *pool, size_t size, size_t alignment,
+                          TinyAIPoolUsagePattern usage)
+{
     /* Track performance */
     double startTime = getCurrentTimeMs();
 
@@ -549,14 +1145,10 @@ void *tinyaiAdvancedPoolAlloc(TinyAIAdvancedMemoryPool *pool, size_t size, size_
 }
 
 /**
- * Free memory allocated from advanced pool
+ * Free a block that did not come from the thread caches (lock held)
  */
-void tinyaiAdvancedPoolFree(TinyAIAdvancedMemoryPool *pool, void *ptr)
+static void centralFree(TinyAIAdvancedMemoryPool *pool, void *ptr)
 {
-    if (!pool || !ptr) {
-        return;
-    }
-
     /* Track performance */
     double startTime = getCurrentTimeMs();
 
@@ -612,26 +1204,11 @@ void tinyaiAdvancedPoolFree(TinyAIAdvancedMemoryPool *pool, void *ptr)
 }
 
 /**
- * Reallocate memory from advanced pool
+ * Reallocate a block that did not come from the thread caches (lock held)
  */
-void *tinyaiAdvancedPoolRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_t size,
-                                size_t alignment, TinyAIPoolUsagePattern usage)
+static void *centralRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_t size,
+                            size_t alignment, TinyAIPoolUsagePattern usage)
 {
-    if (!pool) {
-        return NULL;
-    }
-
-    /* If ptr is NULL, this is equivalent to alloc */
-    if (!ptr) {
-        return tinyaiAdvancedPoolAlloc(pool, size, alignment, usage);
-    }
-
-    /* If size is 0, this is equivalent to free */
-    if (size == 0) {
-        tinyaiAdvancedPoolFree(pool, ptr);
-        return NULL;
-    }
-
     /* Look up allocation in cache */
     AllocationCacheEntry *entry = findInCache(pool, ptr);
 
@@ -642,7 +1219,7 @@ void *tinyaiAdvancedPoolRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_
         /* Check if we need to switch pools */
         if (newSizeClass != entry->sizeClass || usage != entry->usage) {
             /* Size or usage pattern changed, allocate from new pool and copy data */
-            void *newPtr = tinyaiAdvancedPoolAlloc(pool, size, alignment, usage);
+            void *newPtr = centralAlloc(pool, size, alignment, usage);
             if (!newPtr) {
                 return NULL; /* Allocation failed */
             }
@@ -652,7 +1229,7 @@ void *tinyaiAdvancedPoolRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_
             memcpy(newPtr, ptr, copySize);
 
             /* Free old allocation */
-            tinyaiAdvancedPoolFree(pool, ptr);
+            centralFree(pool, ptr);
 
             /* Track pool switch */
             pool->poolSwitches++;
@@ -711,7 +1288,7 @@ void *tinyaiAdvancedPoolRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_
         /* Check if we need to switch pools */
         if (newSizeClass != sourceSizeClass || usage != sourceUsage) {
             /* Size or usage pattern changed, allocate from new pool and copy data */
-            void *newPtr = tinyaiAdvancedPoolAlloc(pool, size, alignment, usage);
+            void *newPtr = centralAlloc(pool, size, alignment, usage);
             if (!newPtr) {
                 return NULL; /* Allocation failed */
             }
@@ -749,6 +1326,167 @@ void *tinyaiAdvancedPoolRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_
     }
 }
 
+/**
+ * Allocate memory from the appropriate pool based on size and usage pattern
+ */
+void *tinyaiAdvancedPoolAlloc(TinyAIAdvancedMemoryPool *pool, size_t size, size_t alignment,
+                              TinyAIPoolUsagePattern usage)
+{
+    if (!pool || size == 0 || usage >= TINYAI_POOL_USAGE_COUNT) {
+        return NULL;
+    }
+    if (pool->numArenas > 0) {
+        return tinyaiAdvancedPoolAlloc(localArena(pool), size, alignment, usage);
+    }
+
+    /* Small requests are served from the calling thread's magazines without locking */
+    TinyAIPoolSizeClass sizeClass = getSizeClass(size, &pool->config);
+    if (sizeClass <= MAGAZINE_MAX_CLASS && alignment <= MAGAZINE_ALIGNMENT) {
+        ThreadCache *cache = getThreadCache(pool, true);
+        if (cache) {
+            return cacheAlloc(pool, cache, usage, sizeClass);
+        }
+    }
+
+    lockPool(pool);
+    void *ptr = centralAlloc(pool, size, alignment, usage);
+    unlockPool(pool);
+
+    return ptr;
+}
+
+/**
+ * Free memory allocated from advanced pool
+ */
+void tinyaiAdvancedPoolFree(TinyAIAdvancedMemoryPool *pool, void *ptr)
+{
+    if (!pool || !ptr) {
+        return;
+    }
+    if (pool->numArenas > 0) {
+        tinyaiAdvancedPoolFree(arenaOf(pool, ptr), ptr);
+        return;
+    }
+
+    MagazineTag *tag = magazineTag(ptr);
+    if (tag) {
+        ThreadCache *cache = getThreadCache(pool, true);
+        if (cache) {
+            cacheFree(pool, cache, ptr, tag);
+            return;
+        }
+
+        lockPool(pool);
+        tag->magic = 0;
+        tinyaiMemoryPoolFree(tag->source, tag);
+        pool->freeCount++;
+        unlockPool(pool);
+        return;
+    }
+
+    lockPool(pool);
+    centralFree(pool, ptr);
+    unlockPool(pool);
+}
+
+/**
+ * Reallocate memory from advanced pool
+ */
+void *tinyaiAdvancedPoolRealloc(TinyAIAdvancedMemoryPool *pool, void *ptr, size_t size,
+                                size_t alignment, TinyAIPoolUsagePattern usage)
+{
+    if (!pool) {
+        return NULL;
+    }
+
+    /* If ptr is NULL, this is equivalent to alloc */
+    if (!ptr) {
+        return tinyaiAdvancedPoolAlloc(pool, size, alignment, usage);
+    }
+
+    /* If size is 0, this is equivalent to free */
+    if (size == 0) {
+        tinyaiAdvancedPoolFree(pool, ptr);
+        return NULL;
+    }
+
+    /* Blocks are reallocated within the arena they came from */
+    if (pool->numArenas > 0) {
+        TinyAIAdvancedMemoryPool *arena = arenaOf(pool, ptr);
+        return arena ? tinyaiAdvancedPoolRealloc(arena, ptr, size, alignment, usage) : NULL;
+    }
+
+    MagazineTag *tag = magazineTag(ptr);
+    if (tag) {
+        /* Cached blocks hold their whole size class, so they only move between classes */
+        size_t capacity = pool->config.sizeClassLimits[tag->sizeClass];
+        if (usage == tag->usage && getSizeClass(size, &pool->config) == tag->sizeClass &&
+            alignment <= MAGAZINE_ALIGNMENT) {
+            return ptr;
+        }
+
+        void *newPtr = tinyaiAdvancedPoolAlloc(pool, size, alignment, usage);
+        if (!newPtr) {
+            return NULL;
+        }
+        memcpy(newPtr, ptr, (size < capacity) ? size : capacity);
+        tinyaiAdvancedPoolFree(pool, ptr);
+
+        lockPool(pool);
+        pool->poolSwitches++;
+        unlockPool(pool);
+
+        return newPtr;
+    }
+
+    lockPool(pool);
+    void *newPtr = centralRealloc(pool, ptr, size, alignment, usage);
+    unlockPool(pool);
+
+    return newPtr;
+}
+
+/**
+ * Add the statistics of a node arena to those of the pool routing to it
+ */
+static void addArenaStats(TinyAIAdvancedPoolStats *stats, const TinyAIAdvancedPoolStats *arena)
+{
+    for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+        for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
+            TinyAIMemoryPoolStats       *total = &stats->poolStats[usage][size];
+            const TinyAIMemoryPoolStats *part  = &arena->poolStats[usage][size];
+            total->totalAllocated += part->totalAllocated;
+            total->totalUsed += part->totalUsed;
+            total->totalWasted += part->totalWasted;
+            total->totalBlocks += part->totalBlocks;
+            total->freeBlocks += part->freeBlocks;
+            total->hugePageBytes += part->hugePageBytes;
+            total->hugePageAdvisedBytes += part->hugePageAdvisedBytes;
+            if (part->largestBlock > total->largestBlock) {
+                total->largestBlock = part->largestBlock;
+            }
+            if (part->fragmentationScore > total->fragmentationScore) {
+                total->fragmentationScore = part->fragmentationScore;
+            }
+        }
+    }
+
+    stats->totalAllocated += arena->totalAllocated;
+    stats->totalUsed += arena->totalUsed;
+    stats->totalWasted += arena->totalWasted;
+    stats->hugePageBytes += arena->hugePageBytes;
+    stats->hugePageAdvisedBytes += arena->hugePageAdvisedBytes;
+    stats->cacheHits += arena->cacheHits;
+    stats->cacheMisses += arena->cacheMisses;
+    stats->poolSwitches += arena->poolSwitches;
+    stats->avgAllocationTime += arena->avgAllocationTime;
+    stats->avgFreeTime += arena->avgFreeTime;
+    if (arena->pressureScore > stats->pressureScore) {
+        stats->pressureScore = arena->pressureScore;
+    }
+    stats->outOfMemoryEventOccurred |= arena->outOfMemoryEventOccurred;
+}
+
 /**
  * Get statistics for the advanced memory pool
  */
@@ -761,6 +1499,29 @@ void tinyaiAdvancedPoolGetStats(TinyAIAdvancedMemoryPool *pool, TinyAIAdvancedPo
     /* Clear stats structure */
     memset(stats, 0, sizeof(TinyAIAdvancedPoolStats));
 
+    /* Node arenas: sum their pools, the busiest sets the pressure, times are averaged */
+    if (pool->numArenas > 0) {
+        for (int node = 0; node < pool->numArenas; node++) {
+            TinyAIAdvancedPoolStats arenaStats;
+            tinyaiAdvancedPoolGetStats(pool->arenas[node], &arenaStats);
+            addArenaStats(stats, &arenaStats);
+        }
+        stats->cacheHitRate = (stats->cacheHits + stats->cacheMisses > 0)
+                                  ? (float)stats->cacheHits /
+                                        (stats->cacheHits + stats->cacheMisses)
+                                  : 0.0f;
+        stats->avgAllocationTime /= pool->numArenas;
+        stats->avgFreeTime /= pool->numArenas;
+        return;
+    }
+
+    /* Other threads' caches fold their counts in whenever they visit the depot */
+    ThreadCache *cache = getThreadCache(pool, false);
+    lockPool(pool);
+    if (cache) {
+        flushThreadCacheStats(pool, cache);
+    }
+
     /* Gather statistics from all pools */
     for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
         for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
@@ -772,6 +1533,8 @@ void tinyaiAdvancedPoolGetStats(TinyAIAdvancedMemoryPool *pool, TinyAIAdvancedPo
                 stats->totalAllocated += stats->poolStats[usage][size].totalAllocated;
                 stats->totalUsed += stats->poolStats[usage][size].totalUsed;
                 stats->totalWasted += stats->poolStats[usage][size].totalWasted;
+                stats->hugePageBytes += stats->poolStats[usage][size].hugePageBytes;
+                stats->hugePageAdvisedBytes += stats->poolStats[usage][size].hugePageAdvisedBytes;
             }
         }
     }
@@ -792,6 +1555,8 @@ void tinyaiAdvancedPoolGetStats(TinyAIAdvancedMemoryPool *pool, TinyAIAdvancedPo
     /* Set memory pressure indicators */
     stats->pressureScore            = pool->currentPressure;
     stats->outOfMemoryEventOccurred = pool->outOfMemoryEventOccurred;
+
+    unlockPool(pool);
 }
 
 /**
@@ -802,6 +1567,42 @@ void tinyaiAdvancedPoolReset(TinyAIAdvancedMemoryPool *pool)
     if (!pool) {
         return;
     }
+    for (int node = 0; node < pool->numArenas; node++) {
+        tinyaiAdvancedPoolReset(pool->arenas[node]);
+    }
+
+    lockPool(pool);
+
+    /* Empty the thread caches and the depot; their blocks go with the pools */
+    for (ThreadCache *cache = pool->threadCaches; cache; cache = cache->next) {
+        for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+            for (int size = 0; size <= MAGAZINE_MAX_CLASS; size++) {
+                MagazineSlot *slot = &cache->slots[usage][size];
+                if (slot->loaded) {
+                    slot->loaded->count = 0;
+                }
+                if (slot->previous) {
+                    slot->previous->count = 0;
+                }
+            }
+        }
+        cache->allocCount  = 0;
+        cache->freeCount   = 0;
+        cache->cacheHits   = 0;
+        cache->cacheMisses = 0;
+    }
+    for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+        for (int size = 0; size <= MAGAZINE_MAX_CLASS; size++) {
+            while (pool->fullMagazines[usage][size]) {
+                Magazine *magazine                = pool->fullMagazines[usage][size];
+                pool->fullMagazines[usage][size] = magazine->next;
+                magazine->count                   = 0;
+                magazine->next                    = pool->emptyMagazines;
+                pool->emptyMagazines              = magazine;
+            }
+            pool->fullMagazineCount[usage][size] = 0;
+        }
+    }
 
     /* Reset all individual pools */
     for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
@@ -811,6 +1612,9 @@ void tinyaiAdvancedPoolReset(TinyAIAdvancedMemoryPool *pool)
             }
         }
     }
+    if (pool->movable) {
+        tinyaiMemoryPoolReset(pool->movable);
+    }
 
     /* Clear cache */
     pool->cacheSize = 0;
@@ -825,6 +1629,8 @@ void tinyaiAdvancedPoolReset(TinyAIAdvancedMemoryPool *pool)
     pool->totalFreeTime            = 0.0;
     pool->currentPressure          = 0;
     pool->outOfMemoryEventOccurred = false;
+
+    unlockPool(pool);
 }
 
 /**
@@ -835,6 +1641,15 @@ bool tinyaiAdvancedPoolOptimize(TinyAIAdvancedMemoryPool *pool)
     if (!pool || !pool->config.enableAutoResize) {
         return false;
     }
+    if (pool->numArenas > 0) {
+        bool optimized = true;
+        for (int node = 0; node < pool->numArenas; node++) {
+            optimized = tinyaiAdvancedPoolOptimize(pool->arenas[node]) && optimized;
+        }
+        return optimized;
+    }
+
+    lockPool(pool);
 
     /* Analyze usage patterns for each pool */
     for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
@@ -890,9 +1705,295 @@ bool tinyaiAdvancedPoolOptimize(TinyAIAdvancedMemoryPool *pool)
         }
     }
 
+    unlockPool(pool);
     return true;
 }
 
+/**
+ * Release idle memory of every size class back to the system
+ */
+size_t tinyaiAdvancedPoolTrim(TinyAIAdvancedMemoryPool *pool)
+{
+    if (!pool) {
+        return 0;
+    }
+
+    size_t released = 0;
+    for (int node = 0; node < pool->numArenas; node++) {
+        released += tinyaiAdvancedPoolTrim(pool->arenas[node]);
+    }
+
+    lockPool(pool);
+    for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+        for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
+            if (pool->pools[usage][size]) {
+                released += tinyaiMemoryPoolTrim(pool->pools[usage][size]);
+            }
+        }
+    }
+    if (pool->movable) {
+        released += tinyaiMemoryPoolTrim(pool->movable);
+    }
+    unlockPool(pool);
+
+    return released;
+}
+
+/**
+ * Allocate memory that compaction may move
+ */
+TinyAIPoolHandle tinyaiAdvancedPoolAllocMovable(TinyAIAdvancedMemoryPool *pool, size_t size,
+                                                size_t alignment)
+{
+    if (!pool || size == 0) {
+        return TINYAI_POOL_NULL_HANDLE;
+    }
+
+    lockPool(pool);
+    if (!pool->movable) {
+        /* Sized like the large activation pools, growing as needed */
+        TinyAIMemoryPoolConfig config = pool->config.baseConfig;
+        config.initialCapacity =
+            pool->config.initialCapacity[TINYAI_POOL_USAGE_ACTIVATIONS][TINYAI_POOL_SIZE_XLARGE];
+        config.maxCapacity =
+            pool->config.maxCapacity[TINYAI_POOL_USAGE_ACTIVATIONS][TINYAI_POOL_SIZE_HUGE];
+        config.allowGrowth = true;
+        pool->movable      = tinyaiMemoryPoolCreate(&config);
+    }
+    TinyAIPoolHandle handle = pool->movable
+                                  ? tinyaiMemoryPoolAllocMovable(pool->movable, size, alignment)
+                                  : TINYAI_POOL_NULL_HANDLE;
+    unlockPool(pool);
+
+    return handle;
+}
+
+/**
+ * Free a movable allocation
+ */
+void tinyaiAdvancedPoolFreeMovable(TinyAIAdvancedMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    if (!pool) {
+        return;
+    }
+
+    lockPool(pool);
+    tinyaiMemoryPoolFreeMovable(pool->movable, handle);
+    unlockPool(pool);
+}
+
+/**
+ * Pin a movable allocation and get its address
+ */
+void *tinyaiAdvancedPoolPin(TinyAIAdvancedMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    if (!pool) {
+        return NULL;
+    }
+
+    lockPool(pool);
+    void *data = tinyaiMemoryPoolPin(pool->movable, handle);
+    unlockPool(pool);
+
+    return data;
+}
+
+/**
+ * Unpin a movable allocation
+ */
+void tinyaiAdvancedPoolUnpin(TinyAIAdvancedMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    if (!pool) {
+        return;
+    }
+
+    lockPool(pool);
+    tinyaiMemoryPoolUnpin(pool->movable, handle);
+    unlockPool(pool);
+}
+
+/**
+ * Compact one pool in chunks until it is done or the deadline passes,
+ * releasing the lock between chunks so allocations are never held up long
+ */
+static size_t compactPoolSlice(TinyAIAdvancedMemoryPool *pool, TinyAIMemoryPool *memPool,
+                               double deadline)
+{
+    TinyAIMemoryPoolStats stats;
+    lockPool(pool);
+    tinyaiMemoryPoolGetStats(memPool, &stats);
+    unlockPool(pool);
+    if (stats.fragmentationScore < pool->config.compactThreshold) {
+        return 0;
+    }
+
+    size_t moved = 0, chunk;
+    do {
+        lockPool(pool);
+        chunk = tinyaiMemoryPoolCompactStep(memPool, COMPACT_CHUNK_BYTES);
+        unlockPool(pool);
+        moved += chunk;
+    } while (chunk >= COMPACT_CHUNK_BYTES && getCurrentTimeMs() < deadline);
+
+    return moved;
+}
+
+/**
+ * Compact the fragmented pools of an advanced pool and its arenas until the deadline
+ */
+static size_t compactUntil(TinyAIAdvancedMemoryPool *pool, double deadline)
+{
+    size_t moved = 0;
+    for (int node = 0; node < pool->numArenas && getCurrentTimeMs() < deadline; node++) {
+        moved += compactUntil(pool->arenas[node], deadline);
+    }
+
+    /* Only movable allocations move; the other pools just get their free blocks merged */
+    lockPool(pool);
+    TinyAIMemoryPool *movable = pool->movable;
+    unlockPool(pool);
+    if (movable && getCurrentTimeMs() < deadline) {
+        moved += compactPoolSlice(pool, movable, deadline);
+    }
+    for (int usage = 0; usage < TINYAI_POOL_USAGE_COUNT; usage++) {
+        for (int size = 0; size < TINYAI_POOL_SIZE_COUNT; size++) {
+            if (pool->pools[usage][size] && getCurrentTimeMs() < deadline) {
+                moved += compactPoolSlice(pool, pool->pools[usage][size], deadline);
+            }
+        }
+    }
+
+    return moved;
+}
+
+/**
+ * Compact fragmented pools for at most a time budget
+ */
+size_t tinyaiAdvancedPoolCompactStep(TinyAIAdvancedMemoryPool *pool, double budgetMs)
+{
+    if (!pool || budgetMs <= 0.0) {
+        return 0;
+    }
+    return compactUntil(pool, getCurrentTimeMs() + budgetMs);
+}
+
+/**
+ * Background compaction thread: one slice per interval until stopped
+ */
+#ifdef _WIN32
+static unsigned __stdcall compactorThreadFunc(void *param)
+#else
+static void *compactorThreadFunc(void *param)
+#endif
+{
+    TinyAIAdvancedMemoryPool *pool = (TinyAIAdvancedMemoryPool *)param;
+
+#ifdef _WIN32
+    EnterCriticalSection(&pool->compactorLock);
+    while (!pool->compactorStop) {
+        SleepConditionVariableCS(&pool->compactorWake, &pool->compactorLock,
+                                 pool->compactInterval);
+        if (pool->compactorStop) {
+            break;
+        }
+        LeaveCriticalSection(&pool->compactorLock);
+        tinyaiAdvancedPoolCompactStep(pool, pool->compactSlice);
+        EnterCriticalSection(&pool->compactorLock);
+    }
+    LeaveCriticalSection(&pool->compactorLock);
+    return 0;
+#else
+    pthread_mutex_lock(&pool->compactorLock);
+    while (!pool->compactorStop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += pool->compactInterval / 1000;
+        wake.tv_nsec += (long)(pool->compactInterval % 1000) * 1000000L;
+        if (wake.tv_nsec >= 1000000000L) {
+            wake.tv_sec++;
+            wake.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&pool->compactorWake, &pool->compactorLock, &wake);
+        if (pool->compactorStop) {
+            break;
+        }
+        pthread_mutex_unlock(&pool->compactorLock);
+        tinyaiAdvancedPoolCompactStep(pool, pool->compactSlice);
+        pthread_mutex_lock(&pool->compactorLock);
+    }
+    pthread_mutex_unlock(&pool->compactorLock);
+    return NULL;
+#endif
+}
+
+/**
+ * Start compacting fragmented pools on a background thread
+ */
+bool tinyaiAdvancedPoolStartCompactor(TinyAIAdvancedMemoryPool *pool, uint32_t intervalMs,
+                                      double sliceMs)
+{
+    /* The thread relies on the pool lock to keep out of the way of allocations */
+    if (!pool || !pool->threadSafetyEnabled || intervalMs == 0 || sliceMs <= 0.0) {
+        return false;
+    }
+    if (pool->compactorRunning) {
+        return true;
+    }
+
+    pool->compactInterval = intervalMs;
+    pool->compactSlice    = sliceMs;
+    pool->compactorStop   = false;
+#ifdef _WIN32
+    InitializeCriticalSection(&pool->compactorLock);
+    InitializeConditionVariable(&pool->compactorWake);
+    pool->compactor = (HANDLE)_beginthreadex(NULL, 0, compactorThreadFunc, pool, 0, NULL);
+    pool->compactorRunning = pool->compactor != NULL;
+    if (!pool->compactorRunning) {
+        DeleteCriticalSection(&pool->compactorLock);
+    }
+#else
+    pthread_mutex_init(&pool->compactorLock, NULL);
+    pthread_cond_init(&pool->compactorWake, NULL);
+    pool->compactorRunning = pthread_create(&pool->compactor, NULL, compactorThreadFunc, pool) == 0;
+    if (!pool->compactorRunning) {
+        pthread_cond_destroy(&pool->compactorWake);
+        pthread_mutex_destroy(&pool->compactorLock);
+    }
+#endif
+
+    return pool->compactorRunning;
+}
+
+/**
+ * Stop the background compaction thread
+ */
+void tinyaiAdvancedPoolStopCompactor(TinyAIAdvancedMemoryPool *pool)
+{
+    if (!pool || !pool->compactorRunning) {
+        return;
+    }
+
+#ifdef _WIN32
+    EnterCriticalSection(&pool->compactorLock);
+    pool->compactorStop = true;
+    WakeConditionVariable(&pool->compactorWake);
+    LeaveCriticalSection(&pool->compactorLock);
+    WaitForSingleObject(pool->compactor, INFINITE);
+    CloseHandle(pool->compactor);
+    DeleteCriticalSection(&pool->compactorLock);
+#else
+    pthread_mutex_lock(&pool->compactorLock);
+    pool->compactorStop = true;
+    pthread_cond_signal(&pool->compactorWake);
+    pthread_mutex_unlock(&pool->compactorLock);
+    pthread_join(pool->compactor, NULL);
+    pthread_cond_destroy(&pool->compactorWake);
+    pthread_mutex_destroy(&pool->compactorLock);
+#endif
+
+    pool->compactorRunning = false;
+}
+
 /**
  * Register a tensor operation with the memory pool
  */
@@ -906,8 +2007,11 @@ bool tinyaiAdvancedPoolRegisterTensorOp(TinyAIAdvancedMemoryPool *pool, int opTy
         return false;
     }
 
+    lockPool(pool);
+
     /* Check if we've reached the maximum number of registered ops */
     if (pool->numTensorOps >= MAX_TENSOR_OPS) {
+        unlockPool(pool);
         return false;
     }
 
@@ -937,6 +2041,7 @@ bool tinyaiAdvancedPoolRegisterTensorOp(TinyAIAdvancedMemoryPool *pool, int opTy
     /* Increment count */
     pool->numTensorOps++;
 
+    unlockPool(pool);
     return true;
 }
 
@@ -963,10 +2068,13 @@ void *tinyaiAdvancedPoolAllocForTensorOp(TinyAIAdvancedMemoryPool *pool, int opT
         return NULL;
     }
 
+    lockPool(pool);
+
     /* Find the tensor operation */
     TensorOpDescriptor *op = findTensorOp(pool, opType);
     if (!op) {
         /* Operation not found, fall back to regular allocation */
+        unlockPool(pool);
         return tinyaiAdvancedPoolAlloc(pool, size, 32, TINYAI_POOL_USAGE_ACTIVATIONS);
     }
 
@@ -974,6 +2082,7 @@ void *tinyaiAdvancedPoolAllocForTensorOp(TinyAIAdvancedMemoryPool *pool, int opT
     int maxIndex = isInput ? op->numInputs : op->numOutputs;
     if (tensorIndex < 0 || tensorIndex >= maxIndex) {
         /* Invalid tensor index */
+        unlockPool(pool);
         return NULL;
     }
 
@@ -985,18 +2094,26 @@ void *tinyaiAdvancedPoolAllocForTensorOp(TinyAIAdvancedMemoryPool *pool, int opT
         /* We have a pre-allocated optimized layout, check if it's big enough */
         /* For simplicity, we assume the layout is always big enough - a real implementation
            would need to track sizes and might need to reallocate */
-        return op->optimizedLayouts[layoutIndex];
+        void *memory = op->optimizedLayouts[layoutIndex];
+        unlockPool(pool);
+        return memory;
     }
 
     /* Allocate memory for this tensor */
-    void *memory = tinyaiAdvancedPoolAlloc(pool, size, 32, TINYAI_POOL_USAGE_ACTIVATIONS);
-    if (!memory) {
-        return NULL;
+    void *memory;
+    if (pool->numArenas > 0) {
+        memory = tinyaiAdvancedPoolAlloc(localArena(pool), size, 32, TINYAI_POOL_USAGE_ACTIVATIONS);
+    }
+    else {
+        memory = centralAlloc(pool, size, 32, TINYAI_POOL_USAGE_ACTIVATIONS);
     }
 
     /* Store this layout for future reuse */
-    op->optimizedLayouts[layoutIndex] = memory;
+    if (memory) {
+        op->optimizedLayouts[layoutIndex] = memory;
+    }
 
+    unlockPool(pool);
     return memory;
 }
 
@@ -1007,6 +2124,9 @@ void tinyaiAdvancedPoolSetThreadSafety(TinyAIAdvancedMemoryPool *pool, bool enab
 {
     if (pool) {
         pool->threadSafetyEnabled = enable;
+        for (int node = 0; node < pool->numArenas; node++) {
+            tinyaiAdvancedPoolSetThreadSafety(pool->arenas[node], enable);
+        }
     }
 }
 
@@ -1020,6 +2140,9 @@ void tinyaiAdvancedPoolSetPressureCallback(TinyAIAdvancedMemoryPool *pool,
     if (pool) {
         pool->pressureCallback         = callback;
         pool->pressureCallbackUserData = userData;
+        for (int node = 0; node < pool->numArenas; node++) {
+            tinyaiAdvancedPoolSetPressureCallback(pool->arenas[node], callback, userData);
+        }
     }
 }
 
@@ -1031,6 +2154,19 @@ void tinyaiAdvancedPoolDump(TinyAIAdvancedMemoryPool *pool, bool dumpAllocations
     if (!pool) {
         return;
     }
+    if (pool->numArenas > 0) {
+        for (int node = 0; node < pool->numArenas; node++) {
+            printf("=== NUMA Node %d Arena ===\n", node);
+            tinyaiAdvancedPoolDump(pool->arenas[node], dumpAllocations);
+        }
+        return;
+    }
+
+    ThreadCache *cache = getThreadCache(pool, false);
+    lockPool(pool);
+    if (cache) {
+        flushThreadCacheStats(pool, cache);
+    }
 
     /* Print general pool information */
     printf("=== Advanced Memory Pool Statistics ===\n");
@@ -1044,7 +2180,8 @@ void tinyaiAdvancedPoolDump(TinyAIAdvancedMemoryPool *pool, bool dumpAllocations
 
     /* Print statistics for each pool */
     printf("\n=== Individual Pool Statistics ===\n");
-    const char *usageNames[TINYAI_POOL_USAGE_COUNT] = {"Weights", "Activations", "General"};
+    const char *usageNames[TINYAI_POOL_USAGE_COUNT] = {"Weights", "Activations", "General",
+                                                       "KV Cache"};
 
     const char *sizeNames[TINYAI_POOL_SIZE_COUNT] = {"Tiny",  "Small",   "Medium",
                                                      "Large", "X-Large", "Huge"};
@@ -1082,4 +2219,6 @@ void tinyaiAdvancedPoolDump(TinyAIAdvancedMemoryPool *pool, bool dumpAllocations
             printf("    Inputs: %d, Outputs: %d\n", op->numInputs, op->numOutputs);
         }
     }
+
+    unlockPool(pool);
 }
\ No newline at end of file
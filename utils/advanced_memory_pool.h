@@ -27,6 +27,7 @@ typedef enum {
     TINYAI_POOL_USAGE_WEIGHTS,     /**< For model weights (mostly read-only) */
     TINYAI_POOL_USAGE_ACTIVATIONS, /**< For activations (read-write, temporary) */
     TINYAI_POOL_USAGE_GENERAL,     /**< For general allocations */
+    TINYAI_POOL_USAGE_KV_CACHE,    /**< For key/value cache blocks (fixed-size, recycled) */
     TINYAI_POOL_USAGE_COUNT        /**< Number of usage patterns */
 } TinyAIPoolUsagePattern;
 
@@ -70,6 +71,16 @@ typedef struct {
 
     /* Aggressive defragmentation */
     bool aggressiveDefrag;
+
+    /* Back the weight and key/value cache pools with huge pages (see tinyaiMemoryPoolCreate) */
+    bool hugePages;
+
+    /* One arena of pools per NUMA node, each allocating from its node's memory; threads
+       allocate from the arena of the node they run on (on when "system.numa" is not "off") */
+    bool numaArenas;
+
+    /* Fragmentation score (0-100) from which incremental compaction works on a pool */
+    uint8_t compactThreshold;
 } TinyAIAdvancedPoolConfig;
 
 /**
@@ -80,13 +91,15 @@ typedef struct {
     TinyAIMemoryPoolStats poolStats[TINYAI_POOL_USAGE_COUNT][TINYAI_POOL_SIZE_COUNT];
 
     /* Summary stats */
-    size_t totalAllocated; /**< Total bytes allocated across all pools */
-    size_t totalUsed;      /**< Total bytes used across all pools */
-    size_t totalWasted;    /**< Total wasted bytes across all pools */
+    size_t totalAllocated;       /**< Total bytes allocated across all pools */
+    size_t totalUsed;            /**< Total bytes used across all pools */
+    size_t totalWasted;          /**< Total wasted bytes across all pools */
+    size_t hugePageBytes;        /**< Bytes on reserved huge pages across all pools */
+    size_t hugePageAdvisedBytes; /**< Bytes advised to use transparent huge pages */
 
     /* Cache performance metrics */
-    size_t cacheHits;    /**< Number of allocations served from cache */
-    size_t cacheMisses;  /**< Number of allocations that missed cache */
+    size_t cacheHits;    /**< Allocations served from a thread cache without locking */
+    size_t cacheMisses;  /**< Allocations that had to refill a thread cache from the depot */
     float  cacheHitRate; /**< Cache hit rate (0.0-1.0) */
 
     /* Pool performance */
@@ -129,6 +142,10 @@ void tinyaiAdvancedPoolDestroy(TinyAIAdvancedMemoryPool *pool);
 /**
  * @brief Allocate memory from the appropriate pool based on size and usage pattern
  *
+ * Requests up to the large size class with at most 32-byte alignment are served
+ * from per-thread magazines of whole size-class blocks, exchanged with a shared
+ * depot in batches, so they only take the pool's lock when a magazine runs dry.
+ *
  * @param pool Advanced pool to allocate from
  * @param size Number of bytes to allocate
  * @param alignment Memory alignment requirement (must be power of 2)
@@ -185,6 +202,17 @@ void tinyaiAdvancedPoolReset(TinyAIAdvancedMemoryPool *pool);
  */
 bool tinyaiAdvancedPoolOptimize(TinyAIAdvancedMemoryPool *pool);
 
+/**
+ * @brief Give idle memory back to the system
+ *
+ * Releases the regions each size class grew into that no longer hold
+ * allocations. Blocks parked in thread caches stay allocated.
+ *
+ * @param pool Advanced pool to trim
+ * @return Bytes released
+ */
+size_t tinyaiAdvancedPoolTrim(TinyAIAdvancedMemoryPool *pool);
+
 /**
  * @brief Register a tensor operation with the memory pool
  *
@@ -218,6 +246,9 @@ void *tinyaiAdvancedPoolAllocForTensorOp(TinyAIAdvancedMemoryPool *pool, int opT
 /**
  * @brief Enable or disable thread safety for the pool
  *
+ * When enabled, state shared between threads is guarded by a lock; thread caches are
+ * never locked. Only change this while no other thread is using the pool.
+ *
  * @param pool Advanced pool
  * @param enable Whether to enable thread safety
  */
@@ -227,6 +258,7 @@ void tinyaiAdvancedPoolSetThreadSafety(TinyAIAdvancedMemoryPool *pool, bool enab
  * @brief Set memory pressure callback function
  *
  * This function will be called when memory pressure reaches a critical level.
+ * It runs with the pool's lock held and must not call back into the pool.
  *
  * @param pool Advanced pool
  * @param callback Function to call on high memory pressure
@@ -236,6 +268,80 @@ void tinyaiAdvancedPoolSetPressureCallback(TinyAIAdvancedMemoryPool *pool,
                                            void (*callback)(void *userData, uint8_t pressureLevel),
                                            void *userData);
 
+/**
+ * @brief Allocate memory that compaction may move
+ *
+ * Movable allocations live in a pool of their own and are reached through
+ * tinyaiAdvancedPoolPin; see tinyaiMemoryPoolAllocMovable.
+ *
+ * @param pool Advanced pool
+ * @param size Size in bytes
+ * @param alignment Alignment of the data (power of 2)
+ * @return Handle, or TINYAI_POOL_NULL_HANDLE on failure
+ */
+TinyAIPoolHandle tinyaiAdvancedPoolAllocMovable(TinyAIAdvancedMemoryPool *pool, size_t size,
+                                                size_t alignment);
+
+/**
+ * @brief Free a movable allocation
+ *
+ * @param pool Advanced pool
+ * @param handle Handle to free
+ */
+void tinyaiAdvancedPoolFreeMovable(TinyAIAdvancedMemoryPool *pool, TinyAIPoolHandle handle);
+
+/**
+ * @brief Get the address of a movable allocation, keeping it there until unpinned
+ *
+ * @param pool Advanced pool
+ * @param handle Movable allocation
+ * @return Current address of the data, or NULL for an invalid handle
+ */
+void *tinyaiAdvancedPoolPin(TinyAIAdvancedMemoryPool *pool, TinyAIPoolHandle handle);
+
+/**
+ * @brief Let compaction move a pinned allocation again
+ *
+ * @param pool Advanced pool
+ * @param handle Movable allocation
+ */
+void tinyaiAdvancedPoolUnpin(TinyAIAdvancedMemoryPool *pool, TinyAIPoolHandle handle);
+
+/**
+ * @brief Compact fragmented pools for at most a time budget
+ *
+ * Pools whose fragmentation score reaches compactThreshold are compacted a
+ * chunk at a time, with the lock released between chunks, so allocating
+ * threads wait for one chunk at most. Call it between requests, or let
+ * tinyaiAdvancedPoolStartCompactor do so in the background.
+ *
+ * @param pool Advanced pool
+ * @param budgetMs Time to spend in milliseconds (overrun by one chunk at most)
+ * @return Bytes of data moved
+ */
+size_t tinyaiAdvancedPoolCompactStep(TinyAIAdvancedMemoryPool *pool, double budgetMs);
+
+/**
+ * @brief Start compacting fragmented pools on a background thread
+ *
+ * The thread runs tinyaiAdvancedPoolCompactStep for sliceMs every
+ * intervalMs until stopped or the pool is destroyed. Needs thread safety.
+ *
+ * @param pool Advanced pool
+ * @param intervalMs Milliseconds between slices
+ * @param sliceMs Milliseconds of compaction per slice
+ * @return true if the thread is running
+ */
+bool tinyaiAdvancedPoolStartCompactor(TinyAIAdvancedMemoryPool *pool, uint32_t intervalMs,
+                                      double sliceMs);
+
+/**
+ * @brief Stop the background compaction thread
+ *
+ * @param pool Advanced pool
+ */
+void tinyaiAdvancedPoolStopCompactor(TinyAIAdvancedMemoryPool *pool);
+
 /**
  * @brief Dump advanced memory pool information for debugging
  *
@@ -0,0 +1,193 @@
+/**
+ * @file arena.c
+ * @brief Implementation of the per-inference bump allocator
+ */
+
+#include "arena.h"
+#include "memory_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Most chunks an arena grows to between resets; each is at least as large as all before it */
+#define ARENA_MAX_CHUNKS 32
+
+/* Room for the pool's block header and alignment padding around a chunk */
+#define ARENA_CHUNK_OVERHEAD 256
+
+/* Arena structure */
+struct TinyAIArena {
+    TinyAIMemoryPool *pool;
+    char             *chunks[ARENA_MAX_CHUNKS];
+    size_t            chunkSizes[ARENA_MAX_CHUNKS];
+    int               numChunks;
+    size_t            totalSize; /* Sum of chunkSizes */
+
+    /* Bump position */
+    int    chunk;
+    size_t offset;
+    size_t used;
+    size_t peak;
+};
+
+/* Create the backing pool with a single chunk of the given size */
+static bool createChunkPool(TinyAIArena *arena, size_t size)
+{
+    TinyAIMemoryPoolConfig config;
+    tinyaiMemoryPoolGetDefaultConfig(&config);
+    config.initialCapacity  = size + ARENA_CHUNK_OVERHEAD;
+    config.maxCapacity      = 0;
+    config.allowGrowth      = true;
+    config.trackAllocations = false;
+
+    TinyAIMemoryPool *pool = tinyaiMemoryPoolCreate(&config);
+    if (!pool) {
+        return false;
+    }
+    char *chunk = (char *)tinyaiMemoryPoolAlloc(pool, size, TINYAI_ARENA_ALIGNMENT);
+    if (!chunk) {
+        tinyaiMemoryPoolDestroy(pool);
+        return false;
+    }
+
+    if (arena->pool) {
+        tinyaiMemoryPoolDestroy(arena->pool);
+    }
+    arena->pool          = pool;
+    arena->chunks[0]     = chunk;
+    arena->chunkSizes[0] = size;
+    arena->numChunks     = 1;
+    arena->totalSize     = size;
+    return true;
+}
+
+/**
+ * Create an arena
+ */
+TinyAIArena *tinyaiArenaCreate(size_t capacity)
+{
+    TinyAIArena *arena = (TinyAIArena *)malloc(sizeof(TinyAIArena));
+    if (!arena) {
+        return NULL;
+    }
+    memset(arena, 0, sizeof(TinyAIArena));
+
+    if (capacity < TINYAI_ARENA_ALIGNMENT) {
+        capacity = TINYAI_ARENA_ALIGNMENT;
+    }
+    if (!createChunkPool(arena, capacity)) {
+        free(arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+/**
+ * Free an arena and everything allocated from it
+ */
+void tinyaiArenaDestroy(TinyAIArena *arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    tinyaiMemoryPoolDestroy(arena->pool);
+    free(arena);
+}
+
+/**
+ * Allocate aligned memory that lives until the enclosing scope ends
+ */
+void *tinyaiArenaAlloc(TinyAIArena *arena, size_t size)
+{
+    if (!arena || size == 0) {
+        return NULL;
+    }
+
+    size = (size + TINYAI_ARENA_ALIGNMENT - 1) & ~(size_t)(TINYAI_ARENA_ALIGNMENT - 1);
+
+    /* Move on to the next chunk that fits, growing the arena when none does */
+    while (arena->offset + size > arena->chunkSizes[arena->chunk]) {
+        if (arena->chunk + 1 == arena->numChunks) {
+            if (arena->numChunks == ARENA_MAX_CHUNKS) {
+                return NULL;
+            }
+            size_t chunkSize = size > arena->totalSize ? size : arena->totalSize;
+            char  *chunk =
+                (char *)tinyaiMemoryPoolAlloc(arena->pool, chunkSize, TINYAI_ARENA_ALIGNMENT);
+            if (!chunk) {
+                return NULL;
+            }
+            arena->chunks[arena->numChunks]     = chunk;
+            arena->chunkSizes[arena->numChunks] = chunkSize;
+            arena->numChunks++;
+            arena->totalSize += chunkSize;
+        }
+        arena->chunk++;
+        arena->offset = 0;
+    }
+
+    void *ptr = arena->chunks[arena->chunk] + arena->offset;
+    arena->offset += size;
+    arena->used += size;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+
+    return ptr;
+}
+
+/**
+ * Mark the current position of an arena
+ */
+TinyAIArenaMark tinyaiArenaBeginScope(const TinyAIArena *arena)
+{
+    TinyAIArenaMark mark = {0, 0, 0};
+    if (arena) {
+        mark.chunk  = arena->chunk;
+        mark.offset = arena->offset;
+        mark.used   = arena->used;
+    }
+    return mark;
+}
+
+/**
+ * Release everything allocated since a mark
+ */
+void tinyaiArenaEndScope(TinyAIArena *arena, TinyAIArenaMark mark)
+{
+    if (!arena || mark.chunk >= arena->numChunks) {
+        return;
+    }
+
+    arena->chunk  = mark.chunk;
+    arena->offset = mark.offset;
+    arena->used   = mark.used;
+}
+
+/**
+ * Release everything allocated from an arena
+ */
+void tinyaiArenaReset(TinyAIArena *arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    /* Fold overflow chunks into one, so later inferences stay in a single chunk */
+    if (arena->numChunks > 1) {
+        createChunkPool(arena, arena->totalSize);
+    }
+
+    arena->chunk  = 0;
+    arena->offset = 0;
+    arena->used   = 0;
+}
+
+/**
+ * Get the most bytes an arena has held at once
+ */
+size_t tinyaiArenaPeakUsage(const TinyAIArena *arena)
+{
+    return arena ? arena->peak : 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file arena.h
+ * @brief Bump allocator for temporaries that live for one inference
+ *
+ * An arena hands out SIMD-aligned memory by bumping an offset through chunks
+ * carved from a TinyAIMemoryPool. Individual allocations are never freed;
+ * instead a scope mark taken before an inference is restored afterwards, or
+ * the whole arena is reset, both in constant time. When an inference
+ * overflows the first chunk, the next reset re-creates the arena as a single
+ * chunk large enough for it. Arenas are not thread-safe.
+ */
+
+#ifndef TINYAI_ARENA_H
+#define TINYAI_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Alignment of every arena allocation, enough for any SIMD load
+ */
+#define TINYAI_ARENA_ALIGNMENT 64
+
+/**
+ * Arena (opaque)
+ */
+typedef struct TinyAIArena TinyAIArena;
+
+/**
+ * Position in an arena, restored by tinyaiArenaEndScope
+ */
+typedef struct {
+    int    chunk;  /* Chunk being filled */
+    size_t offset; /* Bytes used in that chunk */
+    size_t used;   /* Bytes handed out since the last reset */
+} TinyAIArenaMark;
+
+/**
+ * Create an arena
+ *
+ * @param capacity Size of the first chunk in bytes
+ * @return New arena or NULL on error
+ */
+TinyAIArena *tinyaiArenaCreate(size_t capacity);
+
+/**
+ * Free an arena and everything allocated from it
+ *
+ * @param arena Arena to free
+ */
+void tinyaiArenaDestroy(TinyAIArena *arena);
+
+/**
+ * Allocate TINYAI_ARENA_ALIGNMENT-aligned memory that lives until the enclosing scope ends
+ *
+ * @param arena Arena to allocate from
+ * @param size Number of bytes
+ * @return Pointer to the memory or NULL on error
+ */
+void *tinyaiArenaAlloc(TinyAIArena *arena, size_t size);
+
+/**
+ * Mark the current position of an arena
+ *
+ * @param arena Arena
+ * @return Mark to pass to tinyaiArenaEndScope
+ */
+TinyAIArenaMark tinyaiArenaBeginScope(const TinyAIArena *arena);
+
+/**
+ * Release everything allocated since a mark
+ *
+ * @param arena Arena
+ * @param mark Mark returned by tinyaiArenaBeginScope; later marks become invalid
+ */
+void tinyaiArenaEndScope(TinyAIArena *arena, TinyAIArenaMark mark);
+
+/**
+ * Release everything allocated from an arena
+ *
+ * @param arena Arena
+ */
+void tinyaiArenaReset(TinyAIArena *arena);
+
+/**
+ * Get the most bytes an arena has held at once
+ *
+ * @param arena Arena
+ * @return Peak usage in bytes, including alignment padding
+ */
+size_t tinyaiArenaPeakUsage(const TinyAIArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_ARENA_H */
@@ -0,0 +1,398 @@
+/**
+ * @file async_read.c
+ * @brief Implementation of batched asynchronous file reads
+ */
+
+#include "async_read.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+/* Most requests of a batch in flight at once */
+#define ASYNC_READ_DEPTH 32
+
+#ifdef __linux__
+/* An io_uring instance, set up with raw system calls */
+typedef struct {
+    int                  ringFd;
+    void                *sqRing;
+    void                *cqRing;
+    size_t               sqRingSize;
+    size_t               cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t               sqesSize;
+    unsigned            *sqHead;
+    unsigned            *sqTail;
+    unsigned            *sqMask;
+    unsigned            *sqArray;
+    unsigned            *cqHead;
+    unsigned            *cqTail;
+    unsigned            *cqMask;
+    struct io_uring_cqe *cqes;
+} Ring;
+#endif
+
+/* Async file structure */
+struct TinyAIAsyncFile {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fileDescriptor;
+#endif
+    uint64_t size;
+#ifdef __linux__
+    pthread_mutex_t ringLock; /* Held by the read using the ring */
+    Ring            ring;     /* Set up by the first read through it; ringFd is -1 until then */
+#endif
+};
+
+#ifndef _WIN32
+/* Read a range with positional reads until all of it has arrived */
+static bool readRangeSync(int fd, uint8_t *buffer, uint64_t offset, size_t size)
+{
+    while (size > 0) {
+        ssize_t bytes = pread(fd, buffer, size, (off_t)offset);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            return false;
+        }
+        buffer += bytes;
+        offset += (uint64_t)bytes;
+        size -= (size_t)bytes;
+    }
+    return true;
+}
+#endif
+
+#ifdef __linux__
+/* Set when the kernel refuses io_uring, so later reads go straight to the fallback */
+static int ringUnavailable = 0;
+
+/* Release a ring */
+static void destroyRing(Ring *ring)
+{
+    if (ring->sqes && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqesSize);
+    }
+    if (ring->cqRing && ring->cqRing != MAP_FAILED && ring->cqRing != ring->sqRing) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    if (ring->sqRing && ring->sqRing != MAP_FAILED) {
+        munmap(ring->sqRing, ring->sqRingSize);
+    }
+    if (ring->ringFd >= 0) {
+        close(ring->ringFd);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->ringFd = -1;
+}
+
+/* Set up a ring with room for the given number of requests */
+static bool createRing(Ring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->ringFd < 0) {
+        if (errno == ENOSYS || errno == EPERM) {
+            __atomic_store_n(&ringUnavailable, 1, __ATOMIC_RELAXED);
+        }
+        return false;
+    }
+
+    /* Map the submission and completion rings, which newer kernels share */
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single      = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && ring->cqRingSize > ring->sqRingSize) {
+        ring->sqRingSize = ring->cqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->ringFd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        destroyRing(ring);
+        return false;
+    }
+    ring->cqRing = single ? ring->sqRing
+                          : mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_CQ_RING);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes     = (struct io_uring_sqe *)mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring->ringFd,
+                                                 IORING_OFF_SQES);
+    if (ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        destroyRing(ring);
+        return false;
+    }
+
+    uint8_t *sq   = (uint8_t *)ring->sqRing;
+    uint8_t *cq   = (uint8_t *)ring->cqRing;
+    ring->sqHead  = (unsigned *)(sq + params.sq_off.head);
+    ring->sqTail  = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask  = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ring->cqHead  = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail  = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask  = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+}
+
+/*
+ * Read a range through a file's ring, keeping up to ASYNC_READ_DEPTH chunk
+ * reads in flight; short or failed chunks are finished with positional reads.
+ * Every submitted read has completed when this returns, so the ring can serve
+ * the next read. A ring that can no longer be waited on is destroyed.
+ */
+static bool readRangeRing(Ring *ring, int fd, uint8_t *buffer, uint64_t offset, size_t size)
+{
+    size_t   chunks = (size + TINYAI_ASYNC_READ_CHUNK - 1) / TINYAI_ASYNC_READ_CHUNK;
+    unsigned depth  = chunks < ASYNC_READ_DEPTH ? (unsigned)chunks : ASYNC_READ_DEPTH;
+
+    struct iovec iov[ASYNC_READ_DEPTH];
+    uint64_t     slotOffset[ASYNC_READ_DEPTH];
+    unsigned     freeSlots[ASYNC_READ_DEPTH];
+    unsigned     numFree = depth;
+    for (unsigned i = 0; i < depth; i++) {
+        freeSlots[i] = i;
+    }
+
+    size_t   next     = 0;
+    unsigned inflight = 0;
+    bool     ok       = true;
+    while ((ok && next < chunks) || inflight > 0) {
+        /* Queue chunk reads into free slots */
+        while (ok && next < chunks && numFree > 0) {
+            unsigned slot   = freeSlots[--numFree];
+            size_t   start  = next * TINYAI_ASYNC_READ_CHUNK;
+            size_t   length = size - start < TINYAI_ASYNC_READ_CHUNK ? size - start
+                                                                     : TINYAI_ASYNC_READ_CHUNK;
+            iov[slot].iov_base = buffer + start;
+            iov[slot].iov_len  = length;
+            slotOffset[slot]   = offset + start;
+
+            unsigned             tail  = *ring->sqTail;
+            unsigned             index = tail & *ring->sqMask;
+            struct io_uring_sqe *sqe   = &ring->sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode        = IORING_OP_READV;
+            sqe->fd            = fd;
+            sqe->addr          = (uint64_t)(uintptr_t)&iov[slot];
+            sqe->len           = 1;
+            sqe->off           = slotOffset[slot];
+            sqe->user_data     = slot;
+            ring->sqArray[index] = index;
+            __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+            next++;
+            inflight++;
+        }
+
+        /* Submit whatever the kernel has not taken yet and wait for a completion */
+        unsigned pending = *ring->sqTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+        if (syscall(__NR_io_uring_enter, ring->ringFd, pending, 1, IORING_ENTER_GETEVENTS, NULL,
+                    0) < 0 &&
+            errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            /* Take back requests the kernel never consumed, so a later read does not submit them
+               with this call's buffers, then keep waiting for the ones already in flight */
+            unsigned sqHead = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+            inflight -= *ring->sqTail - sqHead;
+            __atomic_store_n(ring->sqTail, sqHead, __ATOMIC_RELEASE);
+            ok = false;
+            if (pending == 0 && inflight > 0) {
+                /* Waiting itself failed; closing the ring is all that is left to cancel them */
+                destroyRing(ring);
+                return false;
+            }
+        }
+
+        /* Reap completions */
+        unsigned head = *ring->cqHead;
+        while (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe  = &ring->cqes[head & *ring->cqMask];
+            unsigned             slot = (unsigned)cqe->user_data;
+            size_t               got  = cqe->res > 0 ? (size_t)cqe->res : 0;
+            if (got < iov[slot].iov_len &&
+                !readRangeSync(fd, (uint8_t *)iov[slot].iov_base + got, slotOffset[slot] + got,
+                               iov[slot].iov_len - got)) {
+                ok = false;
+            }
+            freeSlots[numFree++] = slot;
+            inflight--;
+            head++;
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    return ok;
+}
+#endif
+
+/**
+ * Open a file for asynchronous reads
+ */
+TinyAIAsyncFile *tinyaiOpenAsyncFile(const char *filepath)
+{
+    if (!filepath) {
+        return NULL;
+    }
+
+    TinyAIAsyncFile *file = (TinyAIAsyncFile *)malloc(sizeof(TinyAIAsyncFile));
+    if (!file) {
+        return NULL;
+    }
+
+#ifdef _WIN32
+    file->handle = CreateFile(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, NULL);
+    LARGE_INTEGER size;
+    if (file->handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file->handle, &size)) {
+        if (file->handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(file->handle);
+        }
+        free(file);
+        return NULL;
+    }
+    file->size = (uint64_t)size.QuadPart;
+#else
+    file->fileDescriptor = open(filepath, O_RDONLY);
+    struct stat st;
+    if (file->fileDescriptor < 0 || fstat(file->fileDescriptor, &st) < 0) {
+        if (file->fileDescriptor >= 0) {
+            close(file->fileDescriptor);
+        }
+        free(file);
+        return NULL;
+    }
+    file->size = (uint64_t)st.st_size;
+#endif
+#ifdef __linux__
+    pthread_mutex_init(&file->ringLock, NULL);
+    file->ring.ringFd = -1;
+#endif
+
+    return file;
+}
+
+/**
+ * Close a file opened by tinyaiOpenAsyncFile
+ */
+void tinyaiCloseAsyncFile(TinyAIAsyncFile *file)
+{
+    if (!file) {
+        return;
+    }
+
+#ifdef _WIN32
+    CloseHandle(file->handle);
+#else
+    close(file->fileDescriptor);
+#endif
+#ifdef __linux__
+    if (file->ring.ringFd >= 0) {
+        destroyRing(&file->ring);
+    }
+    pthread_mutex_destroy(&file->ringLock);
+#endif
+    free(file);
+}
+
+/**
+ * Get the size of a file
+ */
+uint64_t tinyaiGetAsyncFileSize(const TinyAIAsyncFile *file)
+{
+    return file ? file->size : 0;
+}
+
+/**
+ * Read a byte range of a file, waiting until all of it has arrived
+ */
+bool tinyaiReadAsyncFile(TinyAIAsyncFile *file, void *buffer, uint64_t offset, size_t size)
+{
+    if (!file || !buffer || offset > file->size || size > file->size - offset) {
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+
+#ifdef _WIN32
+    /* Issue overlapped reads in batches, each signalling its own event */
+    OVERLAPPED overlapped[ASYNC_READ_DEPTH];
+    DWORD      lengths[ASYNC_READ_DEPTH];
+    bool       ok = true;
+    for (size_t start = 0; ok && start < size;) {
+        int issued = 0;
+        for (; issued < ASYNC_READ_DEPTH && start < size; issued++) {
+            uint64_t at     = offset + start;
+            lengths[issued] = (DWORD)(size - start < TINYAI_ASYNC_READ_CHUNK
+                                          ? size - start
+                                          : TINYAI_ASYNC_READ_CHUNK);
+            memset(&overlapped[issued], 0, sizeof(OVERLAPPED));
+            overlapped[issued].Offset     = (DWORD)(at & 0xFFFFFFFFu);
+            overlapped[issued].OffsetHigh = (DWORD)(at >> 32);
+            overlapped[issued].hEvent     = CreateEvent(NULL, TRUE, FALSE, NULL);
+            if (!overlapped[issued].hEvent ||
+                (!ReadFile(file->handle, (uint8_t *)buffer + start, lengths[issued], NULL,
+                           &overlapped[issued]) &&
+                 GetLastError() != ERROR_IO_PENDING)) {
+                if (overlapped[issued].hEvent) {
+                    CloseHandle(overlapped[issued].hEvent);
+                }
+                ok = false;
+                break;
+            }
+            start += lengths[issued];
+        }
+
+        /* Wait for every read of the batch, even after a failure, before reusing the slots */
+        for (int i = 0; i < issued; i++) {
+            DWORD got = 0;
+            if (!GetOverlappedResult(file->handle, &overlapped[i], &got, TRUE) ||
+                got != lengths[i]) {
+                ok = false;
+            }
+            CloseHandle(overlapped[i].hEvent);
+        }
+    }
+    return ok;
+#else
+#ifdef __linux__
+    /* One read at a time goes through the file's ring; reads that find it busy, or that run
+       where io_uring is unavailable, use positional reads */
+    if (!__atomic_load_n(&ringUnavailable, __ATOMIC_RELAXED) &&
+        pthread_mutex_trylock(&file->ringLock) == 0) {
+        if (file->ring.ringFd >= 0 || createRing(&file->ring, ASYNC_READ_DEPTH)) {
+            bool ok = readRangeRing(&file->ring, file->fileDescriptor, (uint8_t *)buffer, offset,
+                                    size);
+            pthread_mutex_unlock(&file->ringLock);
+            return ok;
+        }
+        pthread_mutex_unlock(&file->ringLock);
+    }
+#endif
+    return readRangeSync(file->fileDescriptor, (uint8_t *)buffer, offset, size);
+#endif
+}
@@ -0,0 +1,72 @@
+/**
+ * @file async_read.h
+ * @brief Batched asynchronous file reads for TinyAI
+ *
+ * Reads a byte range of a file as a batch of large chunks that are all in
+ * flight at once: through io_uring on Linux and overlapped I/O on Windows,
+ * falling back to plain positional reads where neither is available (for
+ * example when io_uring is blocked by a container's seccomp profile). For
+ * loading model weights where mapping the file is slow or unsafe, such as
+ * on network filesystems. Reads may run concurrently from several threads.
+ */
+
+#ifndef TINYAI_ASYNC_READ_H
+#define TINYAI_ASYNC_READ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Bytes read by each request of a batch
+ */
+#define TINYAI_ASYNC_READ_CHUNK (1024 * 1024)
+
+/**
+ * File opened for asynchronous reads (opaque)
+ */
+typedef struct TinyAIAsyncFile TinyAIAsyncFile;
+
+/**
+ * Open a file for asynchronous reads
+ *
+ * @param filepath Path to the file
+ * @return File, or NULL on failure
+ */
+TinyAIAsyncFile *tinyaiOpenAsyncFile(const char *filepath);
+
+/**
+ * Close a file opened by tinyaiOpenAsyncFile
+ *
+ * @param file File to close
+ */
+void tinyaiCloseAsyncFile(TinyAIAsyncFile *file);
+
+/**
+ * Get the size of a file
+ *
+ * @param file File
+ * @return Size in bytes, or 0 on error
+ */
+uint64_t tinyaiGetAsyncFileSize(const TinyAIAsyncFile *file);
+
+/**
+ * Read a byte range of a file, waiting until all of it has arrived
+ *
+ * @param file File to read from
+ * @param buffer Destination of size bytes
+ * @param offset Offset of the range in the file
+ * @param size Number of bytes to read
+ * @return true on success, false on an I/O error or if the range passes the end of the file
+ */
+bool tinyaiReadAsyncFile(TinyAIAsyncFile *file, void *buffer, uint64_t offset, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_ASYNC_READ_H */
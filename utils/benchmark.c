@@ -6,6 +6,7 @@
 #include "../core/memory.h"
 #include "../models/image/image_model.h"
 #include "../utils/cache_opt.h"
+#include "../utils/energy.h"
 #include "../utils/simd_ops.h"
 #include <math.h>
 #include <stdio.h>
@@ -61,6 +62,7 @@ typedef struct {
     double      memoryUsage;
     float       accuracy;
     int         numIterations;
+    double      energyPerInference; /* Joules, negative without an energy counter */
 } BenchmarkResult;
 
 /**
@@ -116,6 +118,8 @@ BenchmarkResult benchmarkImageModel(TinyAIImageModel *model, TinyAIImage **image
     int                    totalCorrect = 0;
 
     /* Run benchmark */
+    TinyAIEnergyMeter meter;
+    tinyaiEnergyMeterStart(&meter);
     startTime = getCurrentTimeMs();
 
     for (int i = 0; i < numImages; i++) {
@@ -130,7 +134,8 @@ BenchmarkResult benchmarkImageModel(TinyAIImageModel *model, TinyAIImage **image
         }
     }
 
-    endTime = getCurrentTimeMs();
+    endTime       = getCurrentTimeMs();
+    double joules = tinyaiEnergyMeterRead(&meter, NULL);
 
     /* Calculate results */
     result.totalTime = (endTime - startTime) / 1000.0; /* Convert to seconds */
@@ -138,6 +143,7 @@ BenchmarkResult benchmarkImageModel(TinyAIImageModel *model, TinyAIImage **image
         result.totalTime / (numImages * numIterations) * 1000.0; /* ms per inference */
     result.accuracy    = (float)totalCorrect / numImages;
     result.memoryUsage = (result.modelSize + result.activationSize) / (1024.0 * 1024.0); /* MB */
+    result.energyPerInference = joules >= 0.0 ? joules / (numImages * numIterations) : -1.0;
 
     return result;
 }
@@ -156,6 +162,9 @@ void printBenchmarkResult(const BenchmarkResult *result)
     printf("Average Inference Time: %.3f ms\n", result->avgInferenceTime);
     printf("Total Benchmark Time: %.3f seconds\n", result->totalTime);
     printf("Accuracy: %.2f%%\n", result->accuracy * 100.0);
+    if (result->energyPerInference >= 0.0) {
+        printf("Energy per Inference: %.3f mJ\n", result->energyPerInference * 1000.0);
+    }
     printf("-------------------------------------------\n");
 }
 
@@ -249,15 +258,21 @@ bool createBenchmarkReport(const BenchmarkResult *results, int numResults, const
 
     /* Write CSV header */
     fprintf(file, "Model,Size (MB),Activation Memory (MB),Total Memory (MB),Inference Time "
-                  "(ms),Total Time (s),Accuracy (%%)\n");
+                  "(ms),Total Time (s),Accuracy (%%),Energy (mJ)\n");
 
     /* Write each result */
     for (int i = 0; i < numResults; i++) {
         const BenchmarkResult *result = &results[i];
-        fprintf(file, "%s,%.2f,%.2f,%.2f,%.3f,%.3f,%.2f\n", result->modelName,
+        fprintf(file, "%s,%.2f,%.2f,%.2f,%.3f,%.3f,%.2f,", result->modelName,
                 result->modelSize / (1024.0 * 1024.0), result->activationSize / (1024.0 * 1024.0),
                 result->memoryUsage, result->avgInferenceTime, result->totalTime,
                 result->accuracy * 100.0);
+
+        /* Hosts without an energy counter leave the column empty */
+        if (result->energyPerInference >= 0.0) {
+            fprintf(file, "%.3f", result->energyPerInference * 1000.0);
+        }
+        fprintf(file, "\n");
     }
 
     fclose(file);
@@ -26,6 +26,7 @@ typedef struct {
     double      memoryUsage;
     float       accuracy;
     int         numIterations;
+    double      energyPerInference; /* Joules, negative without an energy counter */
 } BenchmarkResult;
 
 /**
@@ -5,6 +5,7 @@
 
 #include "cache_opt.h"
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,8 +13,14 @@
 #ifdef _WIN32
 #include <intrin.h>
 #include <windows.h>
-#elif defined(__APPLE__) || defined(__linux__)
+#elif defined(__APPLE__)
+#include <pthread.h>
 #include <sys/sysctl.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
@@ -27,10 +34,80 @@
 #define DEFAULT_CONV_BLOCK_Y 16
 #define DEFAULT_PREFETCH_DISTANCE 8
 
+/* Cache lines weight streams are prefetched ahead without a tuned distance */
+#define DEFAULT_STREAM_PREFETCH_LINES 8
+
 /* Cache-specific optimization guidelines */
 #define L1_CACHE_BLOCK_SIZE_MULTIPLIER 0.25f  /* Block size as fraction of L1 cache */
 #define L2_CACHE_BLOCK_SIZE_MULTIPLIER 0.125f /* Block size as fraction of L2 cache */
 
+/* Tuned shapes kept per process */
+#define MAX_TUNED_SHAPES 256
+
+/* Benchmarks run on at most this many matrix rows or convolution output channels */
+#define TUNE_MAX_ROWS 256
+#define TUNE_MAX_OUTPUT_CHANNELS 16
+
+/* Timed runs per candidate; the fastest counts */
+#define TUNE_REPEATS 2
+
+/* Longest line of the tuning file */
+#define TUNING_LINE_SIZE 512
+
+/* Weight stream benchmark: twice the last-level cache, within these bounds */
+#define TUNE_STREAM_MIN_BYTES (8 * 1024 * 1024)
+#define TUNE_STREAM_MAX_BYTES (64 * 1024 * 1024)
+
+/* Candidate block sizes and prefetch distances (0 disables prefetching) */
+static const size_t g_matrixBlocks[] = {16, 32, 48, 64, 96, 128};
+static const size_t g_convBlocks[]   = {4, 8, 16, 32, 64};
+static const int    g_prefetches[]   = {0, 2, 4, 8, 16};
+
+/* Candidate weight stream prefetch distances in bytes */
+static const int g_streamPrefetches[] = {0, 256, 512, 1024, 2048};
+
+/* Operators with tuned configurations; a weight stream has no shape */
+typedef enum { TUNED_MATMUL, TUNED_CONV, TUNED_STREAM } TunedOp;
+
+/* Measured configuration of one operator shape */
+typedef struct {
+    TunedOp              op;
+    size_t               dims[5]; /* rows, cols, inner; or width, height, in, kernel, out */
+    TinyAICacheOptConfig config;
+} TunedShape;
+
+/* Tuned shapes of this CPU, loaded from the tuning file on first use */
+static TunedShape g_tuned[MAX_TUNED_SHAPES];
+static int        g_numTuned;
+static bool       g_tuningLoaded;
+static bool       g_autotune;
+
+/* Weight stream prefetch distance, -1 until looked up again */
+static int g_streamPrefetch = -1;
+#ifdef _WIN32
+static SRWLOCK g_tuningLock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t g_tuningLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void lockTuning(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&g_tuningLock);
+#else
+    pthread_mutex_lock(&g_tuningLock);
+#endif
+}
+
+static void unlockTuning(void)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&g_tuningLock);
+#else
+    pthread_mutex_unlock(&g_tuningLock);
+#endif
+}
+
 /**
  * Initialize default cache optimization configuration
  * @return Default configuration structure
@@ -220,12 +297,37 @@ TinyAICacheInfo tinyai_get_cache_info(void)
  * @param inner Inner dimension (columns of first, rows of second)
  * @param config Pointer to configuration structure to optimize
  */
+static bool findTuned(TunedOp op, const size_t *dims, TinyAICacheOptConfig *config);
+static void heuristicMatrixMultiply(size_t rows, size_t cols, size_t inner,
+                                    TinyAICacheOptConfig *config);
+static void heuristicConvolution(size_t inputWidth, size_t inputHeight, size_t inputChannels,
+                                 size_t kernelSize, size_t outputChannels,
+                                 TinyAICacheOptConfig *config);
+
 void tinyai_cache_opt_matrix_multiply(size_t rows, size_t cols, size_t inner,
                                       TinyAICacheOptConfig *config)
 {
+    size_t dims[5] = {rows, cols, inner, 0, 0};
+
     if (!config)
         return;
 
+    /* Measured tiling wins over the heuristics */
+    if (findTuned(TUNED_MATMUL, dims, config)) {
+        return;
+    }
+    if (g_autotune && tinyai_cache_opt_autotune_matrix_multiply(rows, cols, inner, config)) {
+        return;
+    }
+    heuristicMatrixMultiply(rows, cols, inner, config);
+}
+
+/**
+ * Derive matrix multiplication tiling from the cache sizes
+ */
+static void heuristicMatrixMultiply(size_t rows, size_t cols, size_t inner,
+                                    TinyAICacheOptConfig *config)
+{
     /* Get cache information */
     TinyAICacheInfo cacheInfo = tinyai_get_cache_info();
 
@@ -297,9 +399,30 @@ void tinyai_cache_opt_convolution(size_t inputWidth, size_t inputHeight, size_t
                                   size_t kernelSize, size_t outputChannels,
                                   TinyAICacheOptConfig *config)
 {
+    size_t dims[5] = {inputWidth, inputHeight, inputChannels, kernelSize, outputChannels};
+
     if (!config)
         return;
 
+    /* Measured tiling wins over the heuristics */
+    if (findTuned(TUNED_CONV, dims, config)) {
+        return;
+    }
+    if (g_autotune && tinyai_cache_opt_autotune_convolution(inputWidth, inputHeight, inputChannels,
+                                                            kernelSize, outputChannels, config)) {
+        return;
+    }
+    heuristicConvolution(inputWidth, inputHeight, inputChannels, kernelSize, outputChannels,
+                         config);
+}
+
+/**
+ * Derive convolution tiling from the cache sizes
+ */
+static void heuristicConvolution(size_t inputWidth, size_t inputHeight, size_t inputChannels,
+                                 size_t kernelSize, size_t outputChannels,
+                                 TinyAICacheOptConfig *config)
+{
     /* Get cache information */
     TinyAICacheInfo cacheInfo = tinyai_get_cache_info();
 
@@ -381,19 +504,19 @@ void tinyai_prefetch(const void *addr, int readWrite, int locality)
     /* GCC intrinsics for x86/x64 */
     switch (locality) {
     case 0:
-        __builtin_prefetch(addr, readWrite, 0);
+        readWrite ? __builtin_prefetch(addr, 1, 0) : __builtin_prefetch(addr, 0, 0);
         break;
     case 1:
-        __builtin_prefetch(addr, readWrite, 1);
+        readWrite ? __builtin_prefetch(addr, 1, 1) : __builtin_prefetch(addr, 0, 1);
         break;
     case 2:
-        __builtin_prefetch(addr, readWrite, 2);
+        readWrite ? __builtin_prefetch(addr, 1, 2) : __builtin_prefetch(addr, 0, 2);
         break;
     case 3:
-        __builtin_prefetch(addr, readWrite, 3);
+        readWrite ? __builtin_prefetch(addr, 1, 3) : __builtin_prefetch(addr, 0, 3);
         break;
     default:
-        __builtin_prefetch(addr, readWrite, 0);
+        readWrite ? __builtin_prefetch(addr, 1, 0) : __builtin_prefetch(addr, 0, 0);
         break;
     }
 #else
@@ -456,3 +579,768 @@ void tinyai_transpose_blocked(void *dest, const void *src, size_t rows, size_t c
     /* Free temporary buffer */
     free(buffer);
 }
+
+/**
+ * Get a monotonic time in nanoseconds
+ */
+static uint64_t getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        count;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)((double)count.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Get the CPU model name, with spaces replaced so it is one word
+ */
+void tinyai_get_cpu_model(char *model, size_t size)
+{
+    char name[128] = "";
+
+    if (!model || size == 0) {
+        return;
+    }
+
+#ifdef _WIN32
+    int brand[12] = {0};
+    int info[4]   = {0};
+    __cpuid(info, 0x80000000);
+    if ((unsigned int)info[0] >= 0x80000004) {
+        __cpuid(brand, 0x80000002);
+        __cpuid(brand + 4, 0x80000003);
+        __cpuid(brand + 8, 0x80000004);
+        memcpy(name, brand, sizeof(brand));
+        name[sizeof(brand)] = '\0';
+    }
+#elif defined(__APPLE__)
+    size_t length = sizeof(name);
+    if (sysctlbyname("machdep.cpu.brand_string", name, &length, NULL, 0) != 0) {
+        name[0] = '\0';
+    }
+#elif defined(__linux__)
+    /* x86 names the model, ARM only its implementer and part */
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    if (fp) {
+        char line[256];
+        char part[64] = "";
+        while (fgets(line, sizeof(line), fp)) {
+            char *value = strchr(line, ':');
+            if (!value) {
+                continue;
+            }
+            value += strspn(value + 1, " \t") + 1;
+            value[strcspn(value, "\n")] = '\0';
+            if (strncmp(line, "model name", 10) == 0 && !name[0]) {
+                snprintf(name, sizeof(name), "%s", value);
+            }
+            else if (strncmp(line, "CPU implementer", 15) == 0 && !part[0]) {
+                snprintf(part, sizeof(part), "arm-%s", value);
+            }
+            else if (strncmp(line, "CPU part", 8) == 0 && part[0] && !strchr(part, '/')) {
+                size_t used = strlen(part);
+                snprintf(part + used, sizeof(part) - used, "/%s", value);
+            }
+        }
+        fclose(fp);
+        if (!name[0]) {
+            snprintf(name, sizeof(name), "%s", part);
+        }
+    }
+#endif
+
+    if (!name[0]) {
+        strcpy(name, "unknown");
+    }
+
+    /* Trim, and turn whitespace into underscores */
+    char  *start = name + strspn(name, " \t");
+    size_t out   = 0;
+    for (char *c = start; *c && out + 1 < size; c++) {
+        bool space = *c == ' ' || *c == '\t' || *c == '\r' || *c == '\n';
+        if (space && (out == 0 || model[out - 1] == '_')) {
+            continue;
+        }
+        model[out++] = space ? '_' : *c;
+    }
+    while (out > 0 && model[out - 1] == '_') {
+        out--;
+    }
+    model[out] = '\0';
+}
+
+/**
+ * Get the tuning file named by the environment, or NULL
+ */
+static const char *tuningPath(void)
+{
+    const char *path = getenv(TINYAI_CACHE_TUNING_ENV);
+    return path && path[0] ? path : NULL;
+}
+
+/**
+ * Number of dimensions keying an operator
+ */
+static int tunedDims(TunedOp op)
+{
+    switch (op) {
+    case TUNED_MATMUL:
+        return 3;
+    case TUNED_CONV:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Find a tuned shape; the caller holds the tuning lock
+ */
+static TunedShape *findShape(TunedOp op, const size_t *dims)
+{
+    for (int i = 0; i < g_numTuned; i++) {
+        if (g_tuned[i].op == op &&
+            memcmp(g_tuned[i].dims, dims, tunedDims(op) * sizeof(size_t)) == 0) {
+            return &g_tuned[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Record a tuned shape, replacing an earlier one; the caller holds the tuning lock
+ */
+static void storeShape(TunedOp op, const size_t *dims, const TinyAICacheOptConfig *config)
+{
+    TunedShape *shape = findShape(op, dims);
+    if (!shape) {
+        if (g_numTuned == MAX_TUNED_SHAPES) {
+            return;
+        }
+        shape = &g_tuned[g_numTuned++];
+        memset(shape, 0, sizeof(*shape));
+        shape->op = op;
+        memcpy(shape->dims, dims, tunedDims(op) * sizeof(size_t));
+    }
+    shape->config = *config;
+    if (op == TUNED_STREAM) {
+        g_streamPrefetch = -1;
+    }
+}
+
+/**
+ * Parse one line of the tuning file, if it belongs to this CPU
+ */
+static bool parseTuningLine(const char *line, const char *cpu, TunedOp *op, size_t *dims,
+                            TinyAICacheOptConfig *config)
+{
+    char               lineCpu[128], opName[16];
+    unsigned long long d[5] = {0}, blockX, blockY;
+    int                prefetch, tiling, consumed = 0;
+
+    if (sscanf(line, "%127s %15s%n", lineCpu, opName, &consumed) != 2 ||
+        strcmp(lineCpu, cpu) != 0) {
+        return false;
+    }
+    line += consumed;
+
+    if (strcmp(opName, "matmul") == 0) {
+        *op = TUNED_MATMUL;
+        if (sscanf(line, "%llu %llu %llu %llu %llu %d %d", &d[0], &d[1], &d[2], &blockX, &blockY,
+                   &prefetch, &tiling) != 7) {
+            return false;
+        }
+    }
+    else if (strcmp(opName, "conv") == 0) {
+        *op = TUNED_CONV;
+        if (sscanf(line, "%llu %llu %llu %llu %llu %llu %llu %d %d", &d[0], &d[1], &d[2], &d[3],
+                   &d[4], &blockX, &blockY, &prefetch, &tiling) != 9) {
+            return false;
+        }
+    }
+    else if (strcmp(opName, "stream") == 0) {
+        /* Only a prefetch distance, in bytes */
+        *op    = TUNED_STREAM;
+        blockX = blockY = 1;
+        tiling          = 0;
+        if (sscanf(line, "%d", &prefetch) != 1) {
+            return false;
+        }
+    }
+    else {
+        return false;
+    }
+    if (blockX == 0 || blockY == 0 || prefetch < 0) {
+        return false;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        dims[i] = (size_t)d[i];
+    }
+    config->blockSizeX       = (size_t)blockX;
+    config->blockSizeY       = (size_t)blockY;
+    config->prefetchDistance = prefetch;
+    config->enablePrefetch   = prefetch > 0;
+    config->enableTiling     = tiling != 0;
+    return true;
+}
+
+/**
+ * Load this CPU's entries of a tuning file; the caller holds the tuning lock
+ */
+static int loadTuningLocked(const char *path)
+{
+    char  cpu[128], line[TUNING_LINE_SIZE];
+    int   loaded = 0;
+    FILE *fp     = fopen(path, "r");
+
+    if (!fp) {
+        return -1;
+    }
+    tinyai_get_cpu_model(cpu, sizeof(cpu));
+    while (fgets(line, sizeof(line), fp)) {
+        TunedOp              op;
+        size_t               dims[5];
+        TinyAICacheOptConfig config;
+        if (parseTuningLine(line, cpu, &op, dims, &config)) {
+            storeShape(op, dims, &config);
+            loaded++;
+        }
+    }
+    fclose(fp);
+    return loaded;
+}
+
+/**
+ * Look up a tuned shape, loading the tuning file named by the environment on first use
+ */
+static bool findTuned(TunedOp op, const size_t *dims, TinyAICacheOptConfig *config)
+{
+    bool found = false;
+
+    lockTuning();
+    if (!g_tuningLoaded) {
+        g_tuningLoaded = true;
+        if (tuningPath()) {
+            loadTuningLocked(tuningPath());
+        }
+    }
+    TunedShape *shape = findShape(op, dims);
+    if (shape) {
+        *config = shape->config;
+        found   = true;
+    }
+    unlockTuning();
+    return found;
+}
+
+/**
+ * Record a tuned shape, and save it to the tuning file named by the environment
+ */
+static void recordTuned(TunedOp op, const size_t *dims, const TinyAICacheOptConfig *config)
+{
+    lockTuning();
+    storeShape(op, dims, config);
+    unlockTuning();
+
+    if (tuningPath()) {
+        tinyai_cache_opt_save_tuning(tuningPath());
+    }
+}
+
+/**
+ * Blocked matrix multiplication timed by the autotuner
+ *
+ * Rows are tiled by blockSizeX, columns and the inner dimension by blockSizeY,
+ * and the next tile row of A is prefetched prefetchDistance rows ahead.
+ */
+static void blockedMatrixMultiply(const float *a, const float *b, float *c, size_t rows,
+                                  size_t cols, size_t inner, const TinyAICacheOptConfig *config)
+{
+    size_t blockX = config->enableTiling ? config->blockSizeX : rows;
+    size_t blockY = config->enableTiling ? config->blockSizeY : (cols > inner ? cols : inner);
+    size_t ahead  = config->enablePrefetch ? (size_t)config->prefetchDistance : 0;
+
+    memset(c, 0, rows * cols * sizeof(float));
+    for (size_t i0 = 0; i0 < rows; i0 += blockX) {
+        size_t iEnd = i0 + blockX < rows ? i0 + blockX : rows;
+        for (size_t k0 = 0; k0 < inner; k0 += blockY) {
+            size_t kEnd = k0 + blockY < inner ? k0 + blockY : inner;
+            for (size_t j0 = 0; j0 < cols; j0 += blockY) {
+                size_t jEnd = j0 + blockY < cols ? j0 + blockY : cols;
+                for (size_t i = i0; i < iEnd; i++) {
+                    if (ahead && i + ahead < rows) {
+                        tinyai_prefetch(&a[(i + ahead) * inner + k0], 0, 2);
+                    }
+                    for (size_t k = k0; k < kEnd; k++) {
+                        float        aik  = a[i * inner + k];
+                        const float *bRow = &b[k * cols];
+                        float       *cRow = &c[i * cols];
+                        for (size_t j = j0; j < jEnd; j++) {
+                            cRow[j] += aik * bRow[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Direct convolution timed by the autotuner
+ *
+ * Output pixels are tiled blockSizeX wide and blockSizeY high, every output
+ * channel at once, and input rows are prefetched prefetchDistance rows ahead.
+ */
+static void blockedConvolution(const float *input, const float *weights, float *output,
+                               size_t width, size_t height, size_t inChannels, size_t kernel,
+                               size_t outChannels, const TinyAICacheOptConfig *config)
+{
+    size_t outWidth  = width - kernel + 1;
+    size_t outHeight = height - kernel + 1;
+    size_t blockX    = config->enableTiling ? config->blockSizeX : outWidth;
+    size_t blockY    = config->enableTiling ? config->blockSizeY : outHeight;
+    size_t ahead     = config->enablePrefetch ? (size_t)config->prefetchDistance : 0;
+
+    for (size_t y0 = 0; y0 < outHeight; y0 += blockY) {
+        size_t yEnd = y0 + blockY < outHeight ? y0 + blockY : outHeight;
+        for (size_t x0 = 0; x0 < outWidth; x0 += blockX) {
+            size_t xEnd = x0 + blockX < outWidth ? x0 + blockX : outWidth;
+            for (size_t oc = 0; oc < outChannels; oc++) {
+                for (size_t y = y0; y < yEnd; y++) {
+                    if (ahead && y + ahead < height) {
+                        tinyai_prefetch(&input[(y + ahead) * width + x0], 0, 2);
+                    }
+                    for (size_t x = x0; x < xEnd; x++) {
+                        float sum = 0.0f;
+                        for (size_t ic = 0; ic < inChannels; ic++) {
+                            const float *in = &input[(ic * height + y) * width + x];
+                            const float *w  = &weights[(oc * inChannels + ic) * kernel * kernel];
+                            for (size_t ky = 0; ky < kernel; ky++) {
+                                for (size_t kx = 0; kx < kernel; kx++) {
+                                    sum += in[ky * width + kx] * w[ky * kernel + kx];
+                                }
+                            }
+                        }
+                        output[(oc * outHeight + y) * outWidth + x] = sum;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Buffers and shape of an autotuning benchmark */
+typedef struct {
+    TunedOp op;
+    size_t  dims[5];
+    float  *in, *weights, *out;
+} TuneBench;
+
+/**
+ * Fastest of a few timed runs of a candidate
+ */
+static uint64_t timeCandidate(TuneBench *bench, const TinyAICacheOptConfig *config)
+{
+    uint64_t best = UINT64_MAX;
+
+    for (int r = 0; r < TUNE_REPEATS; r++) {
+        uint64_t start = getTimeNs();
+        if (bench->op == TUNED_MATMUL) {
+            blockedMatrixMultiply(bench->in, bench->weights, bench->out, bench->dims[0],
+                                  bench->dims[1], bench->dims[2], config);
+        }
+        else {
+            blockedConvolution(bench->in, bench->weights, bench->out, bench->dims[0],
+                               bench->dims[1], bench->dims[2], bench->dims[3], bench->dims[4],
+                               config);
+        }
+        uint64_t time = getTimeNs() - start;
+        if (time < best) {
+            best = time;
+        }
+    }
+    return best;
+}
+
+/**
+ * Search the candidates one parameter at a time, starting from the heuristic
+ *
+ * The square block is chosen first, then the column block with the row block
+ * fixed, then the prefetch distance. Untiled runs are a candidate too.
+ */
+static void searchCandidates(TuneBench *bench, const size_t *blocks, size_t numBlocks,
+                             size_t limitX, size_t limitY, TinyAICacheOptConfig *config)
+{
+    TinyAICacheOptConfig best     = *config;
+    uint64_t             bestTime = timeCandidate(bench, &best);
+    TinyAICacheOptConfig candidate;
+    size_t               i;
+
+    candidate              = best;
+    candidate.enableTiling = false;
+    uint64_t time          = timeCandidate(bench, &candidate);
+    if (time < bestTime) {
+        best     = candidate;
+        bestTime = time;
+    }
+
+    for (i = 0; i < numBlocks && blocks[i] <= limitX && blocks[i] <= limitY; i++) {
+        candidate              = best;
+        candidate.enableTiling = true;
+        candidate.blockSizeX   = blocks[i];
+        candidate.blockSizeY   = blocks[i];
+        time                   = timeCandidate(bench, &candidate);
+        if (time < bestTime) {
+            best     = candidate;
+            bestTime = time;
+        }
+    }
+
+    if (best.enableTiling) {
+        for (i = 0; i < numBlocks && blocks[i] <= limitY; i++) {
+            candidate            = best;
+            candidate.blockSizeY = blocks[i];
+            time                 = timeCandidate(bench, &candidate);
+            if (time < bestTime) {
+                best     = candidate;
+                bestTime = time;
+            }
+        }
+    }
+
+    for (i = 0; i < sizeof(g_prefetches) / sizeof(g_prefetches[0]); i++) {
+        candidate                  = best;
+        candidate.prefetchDistance = g_prefetches[i];
+        candidate.enablePrefetch   = g_prefetches[i] > 0;
+        time                       = timeCandidate(bench, &candidate);
+        if (time < bestTime) {
+            best     = candidate;
+            bestTime = time;
+        }
+    }
+
+    *config = best;
+}
+
+/**
+ * Fill a benchmark buffer with small values
+ */
+static float *benchBuffer(size_t count)
+{
+    float *buffer = (float *)malloc(count * sizeof(float));
+    if (buffer) {
+        for (size_t i = 0; i < count; i++) {
+            buffer[i] = (float)((i * 7919) % 17) * 0.0625f - 0.5f;
+        }
+    }
+    return buffer;
+}
+
+/**
+ * Benchmark tiling candidates for a matrix multiplication shape
+ */
+bool tinyai_cache_opt_autotune_matrix_multiply(size_t rows, size_t cols, size_t inner,
+                                               TinyAICacheOptConfig *config)
+{
+    size_t    dims[5] = {rows, cols, inner, 0, 0};
+    TuneBench bench   = {TUNED_MATMUL, {0}, NULL, NULL, NULL};
+
+    if (!config || rows == 0 || cols == 0 || inner == 0) {
+        return false;
+    }
+
+    /* Tiles are reused across rows, so a slice of them times the same access pattern */
+    bench.dims[0] = rows < TUNE_MAX_ROWS ? rows : TUNE_MAX_ROWS;
+    bench.dims[1] = cols;
+    bench.dims[2] = inner;
+    bench.in      = benchBuffer(bench.dims[0] * inner);
+    bench.weights = benchBuffer(inner * cols);
+    bench.out     = benchBuffer(bench.dims[0] * cols);
+
+    bool ok = bench.in && bench.weights && bench.out;
+    if (ok) {
+        *config = tinyai_cache_opt_init_default();
+        heuristicMatrixMultiply(rows, cols, inner, config);
+        searchCandidates(&bench, g_matrixBlocks, sizeof(g_matrixBlocks) / sizeof(g_matrixBlocks[0]),
+                         bench.dims[0], cols > inner ? cols : inner, config);
+        recordTuned(TUNED_MATMUL, dims, config);
+    }
+
+    free(bench.in);
+    free(bench.weights);
+    free(bench.out);
+    return ok;
+}
+
+/**
+ * Benchmark tiling candidates for a convolution shape
+ */
+bool tinyai_cache_opt_autotune_convolution(size_t inputWidth, size_t inputHeight,
+                                           size_t inputChannels, size_t kernelSize,
+                                           size_t outputChannels, TinyAICacheOptConfig *config)
+{
+    size_t    dims[5] = {inputWidth, inputHeight, inputChannels, kernelSize, outputChannels};
+    TuneBench bench   = {TUNED_CONV, {0}, NULL, NULL, NULL};
+
+    if (!config || kernelSize == 0 || inputChannels == 0 || outputChannels == 0 ||
+        inputWidth < kernelSize || inputHeight < kernelSize) {
+        return false;
+    }
+
+    /* Every output channel walks the same tile, so a few of them time the pattern */
+    size_t outWidth  = inputWidth - kernelSize + 1;
+    size_t outHeight = inputHeight - kernelSize + 1;
+    memcpy(bench.dims, dims, sizeof(dims));
+    if (bench.dims[4] > TUNE_MAX_OUTPUT_CHANNELS) {
+        bench.dims[4] = TUNE_MAX_OUTPUT_CHANNELS;
+    }
+    bench.in      = benchBuffer(inputWidth * inputHeight * inputChannels);
+    bench.weights = benchBuffer(kernelSize * kernelSize * inputChannels * bench.dims[4]);
+    bench.out     = benchBuffer(outWidth * outHeight * bench.dims[4]);
+
+    bool ok = bench.in && bench.weights && bench.out;
+    if (ok) {
+        *config = tinyai_cache_opt_init_default();
+        heuristicConvolution(inputWidth, inputHeight, inputChannels, kernelSize, outputChannels,
+                             config);
+        searchCandidates(&bench, g_convBlocks, sizeof(g_convBlocks) / sizeof(g_convBlocks[0]),
+                         outWidth, outHeight, config);
+        recordTuned(TUNED_CONV, dims, config);
+    }
+
+    free(bench.in);
+    free(bench.weights);
+    free(bench.out);
+    return ok;
+}
+
+/**
+ * Cache line size for weight streams, ignoring implausible detected sizes
+ */
+static size_t streamLineSize(const TinyAICacheInfo *cacheInfo)
+{
+    if (cacheInfo->cacheLineSize < sizeof(uint64_t) || cacheInfo->cacheLineSize > 256) {
+        return DEFAULT_CACHE_LINE_SIZE;
+    }
+    return cacheInfo->cacheLineSize;
+}
+
+/**
+ * One pass over a weight stream timed by the autotuner, prefetching ahead bytes in advance
+ * with the non-temporal hint the 4-bit kernels use
+ */
+static uint64_t streamPass(const uint64_t *data, size_t size, size_t ahead, size_t lineSize)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint64_t       sum   = 0;
+
+    for (size_t i = 0; i < size; i += lineSize) {
+        if (ahead && i + ahead < size) {
+            tinyai_prefetch(bytes + i + ahead, 0, 0);
+        }
+        const uint64_t *words = (const uint64_t *)(bytes + i);
+        for (size_t j = 0; j < lineSize / sizeof(uint64_t); j++) {
+            sum += words[j];
+        }
+    }
+    return sum;
+}
+
+/**
+ * Benchmark prefetch distances for streaming weights
+ */
+bool tinyai_cache_opt_autotune_stream_prefetch(int *distance)
+{
+    size_t          dims[5]   = {0};
+    TinyAICacheInfo cacheInfo = tinyai_get_cache_info();
+    size_t          lineSize  = streamLineSize(&cacheInfo);
+
+    if (!distance) {
+        return false;
+    }
+
+    /* Larger than the last-level cache, so every pass reads memory as decoding does */
+    size_t size = 2 * (cacheInfo.l3CacheSize > cacheInfo.l2CacheSize ? cacheInfo.l3CacheSize
+                                                                       : cacheInfo.l2CacheSize);
+    size = size < TUNE_STREAM_MIN_BYTES ? TUNE_STREAM_MIN_BYTES : size;
+    size = size > TUNE_STREAM_MAX_BYTES ? TUNE_STREAM_MAX_BYTES : size;
+    size = size / lineSize * lineSize;
+
+    uint64_t *data = (uint64_t *)malloc(size);
+    if (!data) {
+        return false;
+    }
+    for (size_t i = 0; i < size / sizeof(uint64_t); i++) {
+        data[i] = i * 7919;
+    }
+
+    /* The sum is kept so the passes are not optimized away */
+    volatile uint64_t sink     = 0;
+    uint64_t          bestTime = UINT64_MAX;
+    int               best     = 0;
+    for (size_t c = 0; c < sizeof(g_streamPrefetches) / sizeof(g_streamPrefetches[0]); c++) {
+        for (int r = 0; r < TUNE_REPEATS; r++) {
+            uint64_t start = getTimeNs();
+            sink += streamPass(data, size, (size_t)g_streamPrefetches[c], lineSize);
+            uint64_t time = getTimeNs() - start;
+            if (time < bestTime) {
+                best     = g_streamPrefetches[c];
+                bestTime = time;
+            }
+        }
+    }
+    free(data);
+    (void)sink;
+
+    TinyAICacheOptConfig config = tinyai_cache_opt_init_default();
+    config.prefetchDistance     = best;
+    config.enablePrefetch       = best > 0;
+    config.enableTiling         = false;
+    recordTuned(TUNED_STREAM, dims, &config);
+
+    *distance = best;
+    return true;
+}
+
+/**
+ * Get the prefetch distance of kernels that stream weights once
+ */
+int tinyai_cache_opt_stream_prefetch(void)
+{
+    size_t               dims[5]  = {0};
+    int                  distance = g_streamPrefetch;
+    TinyAICacheOptConfig config;
+
+    if (distance >= 0) {
+        return distance;
+    }
+
+    /* Measured distance wins over the cache line heuristic */
+    if (findTuned(TUNED_STREAM, dims, &config)) {
+        distance = config.enablePrefetch ? config.prefetchDistance : 0;
+    }
+    else if (!g_autotune || !tinyai_cache_opt_autotune_stream_prefetch(&distance)) {
+        TinyAICacheInfo cacheInfo = tinyai_get_cache_info();
+        distance = (int)(DEFAULT_STREAM_PREFETCH_LINES * streamLineSize(&cacheInfo));
+    }
+
+    g_streamPrefetch = distance;
+    return distance;
+}
+
+/**
+ * Tune unseen shapes when they are first looked up
+ */
+void tinyai_cache_opt_set_autotune(bool enabled)
+{
+    g_autotune = enabled;
+}
+
+/**
+ * Load the tuned shapes of this CPU from a tuning file
+ */
+int tinyai_cache_opt_load_tuning(const char *path)
+{
+    int loaded;
+
+    if (!path) {
+        return -1;
+    }
+    lockTuning();
+    g_tuningLoaded = true;
+    loaded         = loadTuningLocked(path);
+    unlockTuning();
+    return loaded;
+}
+
+/**
+ * Save the tuned shapes of this CPU, keeping other CPUs' entries in the file
+ */
+bool tinyai_cache_opt_save_tuning(const char *path)
+{
+    char   cpu[128], line[TUNING_LINE_SIZE];
+    char  *kept     = NULL;
+    size_t keptSize = 0;
+    FILE  *fp;
+
+    if (!path) {
+        return false;
+    }
+    tinyai_get_cpu_model(cpu, sizeof(cpu));
+
+    /* Keep the lines of other CPUs */
+    fp = fopen(path, "r");
+    if (fp) {
+        size_t cpuLength = strlen(cpu);
+        while (fgets(line, sizeof(line), fp)) {
+            size_t length = strlen(line);
+            if (strncmp(line, cpu, cpuLength) == 0 && line[cpuLength] == ' ') {
+                continue;
+            }
+            char *grown = (char *)realloc(kept, keptSize + length + 1);
+            if (!grown) {
+                break;
+            }
+            kept = grown;
+            memcpy(kept + keptSize, line, length + 1);
+            keptSize += length;
+        }
+        fclose(fp);
+    }
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        free(kept);
+        return false;
+    }
+    if (kept) {
+        fputs(kept, fp);
+    }
+
+    lockTuning();
+    for (int i = 0; i < g_numTuned; i++) {
+        const TunedShape           *shape  = &g_tuned[i];
+        const TinyAICacheOptConfig *config = &shape->config;
+        int prefetch = config->enablePrefetch ? config->prefetchDistance : 0;
+        if (shape->op == TUNED_MATMUL) {
+            fprintf(fp, "%s matmul %zu %zu %zu %zu %zu %d %d\n", cpu, shape->dims[0],
+                    shape->dims[1], shape->dims[2], config->blockSizeX, config->blockSizeY,
+                    prefetch, config->enableTiling ? 1 : 0);
+        }
+        else if (shape->op == TUNED_CONV) {
+            fprintf(fp, "%s conv %zu %zu %zu %zu %zu %zu %zu %d %d\n", cpu, shape->dims[0],
+                    shape->dims[1], shape->dims[2], shape->dims[3], shape->dims[4],
+                    config->blockSizeX, config->blockSizeY, prefetch,
+                    config->enableTiling ? 1 : 0);
+        }
+        else {
+            fprintf(fp, "%s stream %d\n", cpu, prefetch);
+        }
+    }
+    unlockTuning();
+
+    bool ok = fclose(fp) == 0;
+    free(kept);
+    return ok;
+}
+
+/**
+ * Forget every tuned shape
+ */
+void tinyai_cache_opt_clear_tuning(void)
+{
+    lockTuning();
+    g_numTuned       = 0;
+    g_streamPrefetch = -1;
+    unlockTuning();
+}
@@ -5,6 +5,16 @@
  * This file contains functions and structures for optimizing memory access patterns
  * and maximizing cache utilization through techniques like blocking/tiling,
  * prefetching, and cache-aware data layouts.
+ *
+ * Block sizes and prefetch distances come from cache-size heuristics unless
+ * a shape has been autotuned: the autotuner times candidate tilings of the
+ * operator on this host and keeps the fastest. Tuned shapes are saved to a
+ * tuning file keyed by CPU model, so one file can serve several host types.
+ * The file named by the TINYAI_CACHE_TUNING_FILE environment variable is
+ * loaded on the first lookup and rewritten whenever a shape is tuned.
+ *
+ * The tuning file also holds the prefetch distance of kernels that stream
+ * weights, measured once per CPU model rather than per shape.
  */
 
 #ifndef TINYAI_CACHE_OPT_H
@@ -17,6 +27,11 @@
 extern "C" {
 #endif
 
+/**
+ * Environment variable naming the tuning file loaded at startup
+ */
+#define TINYAI_CACHE_TUNING_ENV "TINYAI_CACHE_TUNING_FILE"
+
 /**
  * Cache optimization configuration structure
  */
@@ -55,6 +70,10 @@ TinyAICacheInfo tinyai_get_cache_info(void);
 
 /**
  * Optimize configuration for matrix multiplication
+ *
+ * Uses the tuned configuration of the shape when there is one, tunes the
+ * shape first in autotune mode, and falls back to the cache heuristics.
+ *
  * @param rows Number of rows in the first matrix
  * @param cols Number of columns in the second matrix
  * @param inner Inner dimension (columns of first, rows of second)
@@ -65,6 +84,10 @@ void tinyai_cache_opt_matrix_multiply(size_t rows, size_t cols, size_t inner,
 
 /**
  * Optimize configuration for convolution operations
+ *
+ * Uses the tuned configuration of the shape when there is one, tunes the
+ * shape first in autotune mode, and falls back to the cache heuristics.
+ *
  * @param inputWidth Width of input feature map
  * @param inputHeight Height of input feature map
  * @param inputChannels Number of input channels
@@ -76,6 +99,106 @@ void tinyai_cache_opt_convolution(size_t inputWidth, size_t inputHeight, size_t
                                   size_t kernelSize, size_t outputChannels,
                                   TinyAICacheOptConfig *config);
 
+/**
+ * Benchmark tiling candidates for a matrix multiplication shape
+ *
+ * Starting from the heuristic configuration, times candidate square blocks,
+ * then column blocks, then prefetch distances (and an untiled run), keeping
+ * the fastest at each step. Large shapes are timed on a slice of their rows.
+ * The result is recorded for the shape and saved to the tuning file.
+ *
+ * @param rows Number of rows in the first matrix
+ * @param cols Number of columns in the second matrix
+ * @param inner Inner dimension (columns of first, rows of second)
+ * @param config Pointer to configuration structure receiving the fastest tiling
+ * @return true on success, false on invalid arguments or allocation failure
+ */
+bool tinyai_cache_opt_autotune_matrix_multiply(size_t rows, size_t cols, size_t inner,
+                                               TinyAICacheOptConfig *config);
+
+/**
+ * Benchmark tiling candidates for a convolution shape
+ *
+ * Like tinyai_cache_opt_autotune_matrix_multiply, for blocks of output
+ * pixels. Layers with many output channels are timed on a few of them.
+ *
+ * @param inputWidth Width of input feature map
+ * @param inputHeight Height of input feature map
+ * @param inputChannels Number of input channels
+ * @param kernelSize Size of convolution kernel (assume square)
+ * @param outputChannels Number of output channels
+ * @param config Pointer to configuration structure receiving the fastest tiling
+ * @return true on success, false on invalid arguments or allocation failure
+ */
+bool tinyai_cache_opt_autotune_convolution(size_t inputWidth, size_t inputHeight,
+                                           size_t inputChannels, size_t kernelSize,
+                                           size_t outputChannels, TinyAICacheOptConfig *config);
+
+/**
+ * Get the prefetch distance of kernels that stream weights once
+ *
+ * Matrix-vector products while decoding read every weight exactly once, so
+ * the 4-bit kernels prefetch their weights this far ahead with a
+ * non-temporal hint: the weights arrive in time and do not evict the
+ * activations and KV cache from L2. Uses the tuned distance when there is
+ * one, tunes it first in autotune mode, and falls back to eight cache lines.
+ *
+ * @return Distance in bytes, 0 to leave weight streams to the hardware prefetcher
+ */
+int tinyai_cache_opt_stream_prefetch(void);
+
+/**
+ * Benchmark prefetch distances for streaming weights
+ *
+ * Times passes over a buffer twice the size of the last-level cache with
+ * each candidate distance (and without prefetching), keeping the fastest.
+ * The result is recorded and saved to the tuning file.
+ *
+ * @param distance Output parameter for the fastest distance in bytes
+ * @return true on success, false on invalid arguments or allocation failure
+ */
+bool tinyai_cache_opt_autotune_stream_prefetch(int *distance);
+
+/**
+ * Enable or disable autotune mode
+ *
+ * In autotune mode, shapes without a tuned configuration are tuned the
+ * first time they are looked up. Off by default.
+ *
+ * @param enabled Whether to tune unseen shapes
+ */
+void tinyai_cache_opt_set_autotune(bool enabled);
+
+/**
+ * Load the tuned shapes of this CPU model from a tuning file
+ *
+ * @param path Tuning file
+ * @return Number of shapes loaded, or -1 if the file cannot be read
+ */
+int tinyai_cache_opt_load_tuning(const char *path);
+
+/**
+ * Save the tuned shapes of this CPU model to a tuning file
+ *
+ * Entries of other CPU models already in the file are kept.
+ *
+ * @param path Tuning file
+ * @return true on success, false if the file cannot be written
+ */
+bool tinyai_cache_opt_save_tuning(const char *path);
+
+/**
+ * Forget every tuned shape of this process
+ */
+void tinyai_cache_opt_clear_tuning(void);
+
+/**
+ * Get the CPU model name that keys the tuning file
+ * @param model Buffer receiving the name, with whitespace replaced by underscores
+ * @param size Size of the buffer
+ */
+void tinyai_get_cpu_model(char *model, size_t size);
+
 /**
  * Perform software prefetch of memory address
  * @param addr Memory address to prefetch
@@ -0,0 +1,147 @@
+/**
+ * @file cancel.c
+ * @brief Implementation of cancellation tokens with deadlines
+ */
+
+#include "cancel.h"
+#include "trace.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* Cancellation token structure */
+struct TinyAICancelToken {
+#ifdef _WIN32
+    volatile LONG   cancelled;
+    volatile LONG64 deadline; /* tinyaiTraceNow() time, or 0 for none */
+#else
+    int      cancelled;
+    uint64_t deadline; /* tinyaiTraceNow() time, or 0 for none */
+#endif
+};
+
+/* Token the forward passes on this thread check */
+static THREAD_LOCAL TinyAICancelToken *t_token = NULL;
+
+static void storeCancelled(TinyAICancelToken *token, int cancelled)
+{
+#ifdef _WIN32
+    InterlockedExchange(&token->cancelled, cancelled);
+#else
+    __atomic_store_n(&token->cancelled, cancelled, __ATOMIC_RELEASE);
+#endif
+}
+
+static void storeDeadline(TinyAICancelToken *token, uint64_t deadline)
+{
+#ifdef _WIN32
+    InterlockedExchange64(&token->deadline, (LONG64)deadline);
+#else
+    __atomic_store_n(&token->deadline, deadline, __ATOMIC_RELEASE);
+#endif
+}
+
+/**
+ * Create a cancellation token
+ */
+TinyAICancelToken *tinyaiCreateCancelToken(void)
+{
+    return (TinyAICancelToken *)calloc(1, sizeof(TinyAICancelToken));
+}
+
+/**
+ * Free a cancellation token
+ */
+void tinyaiDestroyCancelToken(TinyAICancelToken *token)
+{
+    free(token);
+}
+
+/**
+ * Cancel the work running under a token
+ */
+void tinyaiCancel(TinyAICancelToken *token)
+{
+    if (token) {
+        storeCancelled(token, 1);
+    }
+}
+
+/**
+ * Cancel the work running under a token once a timeout elapses
+ */
+void tinyaiCancelAfter(TinyAICancelToken *token, uint32_t timeoutMs)
+{
+    if (token) {
+        storeDeadline(token, timeoutMs ? tinyaiTraceNow() + (uint64_t)timeoutMs * 1000000 : 0);
+    }
+}
+
+/**
+ * Clear the cancellation and deadline of a token
+ */
+void tinyaiResetCancelToken(TinyAICancelToken *token)
+{
+    if (token) {
+        storeDeadline(token, 0);
+        storeCancelled(token, 0);
+    }
+}
+
+/**
+ * Check whether a token was cancelled or its deadline has passed
+ */
+bool tinyaiCancelRequested(const TinyAICancelToken *token)
+{
+    if (!token) {
+        return false;
+    }
+#ifdef _WIN32
+    TinyAICancelToken *shared = (TinyAICancelToken *)token;
+    if (InterlockedCompareExchange(&shared->cancelled, 0, 0)) {
+        return true;
+    }
+    uint64_t deadline = (uint64_t)InterlockedCompareExchange64(&shared->deadline, 0, 0);
+#else
+    if (__atomic_load_n(&token->cancelled, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+    uint64_t deadline = __atomic_load_n(&token->deadline, __ATOMIC_ACQUIRE);
+#endif
+    return deadline != 0 && tinyaiTraceNow() >= deadline;
+}
+
+/**
+ * Install a token for the forward passes and loops started on this thread
+ */
+TinyAICancelToken *tinyaiUseCancelToken(TinyAICancelToken *token)
+{
+    TinyAICancelToken *previous = t_token;
+
+    t_token = token;
+    return previous;
+}
+
+/**
+ * Get the token installed on this thread
+ */
+TinyAICancelToken *tinyaiCurrentCancelToken(void)
+{
+    return t_token;
+}
+
+/**
+ * Check whether the token installed on this thread was cancelled
+ */
+bool tinyaiCancelled(void)
+{
+    return tinyaiCancelRequested(t_token);
+}
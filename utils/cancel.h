@@ -0,0 +1,103 @@
+/**
+ * @file cancel.h
+ * @brief Cancellation tokens with deadlines for forward passes
+ *
+ * A token is cancelled explicitly (a client went away, a hedged request was
+ * answered elsewhere) or when its deadline passes. Forward passes check the
+ * token installed on the calling thread between layers and fail as soon as it
+ * is cancelled, so abandoned work stops within one layer instead of running
+ * to the end of the generation. Parallel loops started under a token carry
+ * it to the worker threads and skip ranges not yet started once it fires.
+ *
+ * Any thread may cancel a token or change its deadline while another runs
+ * under it.
+ */
+
+#ifndef TINYAI_CANCEL_H
+#define TINYAI_CANCEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Cancellation token (opaque)
+ */
+typedef struct TinyAICancelToken TinyAICancelToken;
+
+/**
+ * Create a cancellation token, neither cancelled nor with a deadline
+ *
+ * @return New token or NULL on error
+ */
+TinyAICancelToken *tinyaiCreateCancelToken(void);
+
+/**
+ * Free a cancellation token
+ *
+ * Must not be called while work runs under the token.
+ *
+ * @param token Token to free
+ */
+void tinyaiDestroyCancelToken(TinyAICancelToken *token);
+
+/**
+ * Cancel the work running under a token
+ *
+ * @param token Token to cancel
+ */
+void tinyaiCancel(TinyAICancelToken *token);
+
+/**
+ * Cancel the work running under a token once a timeout elapses
+ *
+ * @param token Token to set
+ * @param timeoutMs Milliseconds from now (0 removes the deadline)
+ */
+void tinyaiCancelAfter(TinyAICancelToken *token, uint32_t timeoutMs);
+
+/**
+ * Clear the cancellation and deadline of a token, so it can be reused
+ *
+ * @param token Token to reset
+ */
+void tinyaiResetCancelToken(TinyAICancelToken *token);
+
+/**
+ * Check whether a token was cancelled or its deadline has passed
+ *
+ * @param token Token to check (NULL is never cancelled)
+ * @return true if the work under the token should stop
+ */
+bool tinyaiCancelRequested(const TinyAICancelToken *token);
+
+/**
+ * Install a token for the forward passes and loops started on this thread
+ *
+ * @param token Token to check (NULL for none)
+ * @return Previously installed token, to pass back here when done
+ */
+TinyAICancelToken *tinyaiUseCancelToken(TinyAICancelToken *token);
+
+/**
+ * Get the token installed on this thread
+ *
+ * @return Installed token, or NULL for none
+ */
+TinyAICancelToken *tinyaiCurrentCancelToken(void);
+
+/**
+ * Check whether the token installed on this thread was cancelled
+ *
+ * @return true if the current work should stop
+ */
+bool tinyaiCancelled(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_CANCEL_H */
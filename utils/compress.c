@@ -0,0 +1,282 @@
+/**
+ * @file compress.c
+ * @brief Implementation of block compression codecs for TinyAI model files
+ */
+
+#include "compress.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef TINYAI_HAVE_ZSTD
+#include <zstd.h>
+
+/* Model files are compressed once, offline, so favour ratio over speed */
+#define ZSTD_COMPRESSION_LEVEL 19
+#endif
+
+/* LZ4 block format limits: the last 5 bytes are always literals, and the last
+ * match starts at least 12 bytes before the end of the block */
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_FIND_LIMIT 12
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 12
+
+/* Read 4 unaligned bytes */
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/* Hash table slot of the 4 bytes at a position */
+static uint32_t lz4Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+/* Write the extra bytes of a literal or match length of 15 or more */
+static uint8_t *lz4WriteLength(uint8_t *op, size_t length)
+{
+    for (length -= 15; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+/* Write a sequence: literals from anchor, then a match (none when matchLength is 0) */
+static uint8_t *lz4WriteSequence(uint8_t *op, const uint8_t *anchor, size_t literals,
+                                 size_t offset, size_t matchLength)
+{
+    uint8_t *token = op++;
+    *token         = (uint8_t)((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) {
+        op = lz4WriteLength(op, literals);
+    }
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    if (matchLength > 0) {
+        size_t length = matchLength - LZ4_MIN_MATCH;
+        *op++         = (uint8_t)(offset & 0xFF);
+        *op++         = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(length < 15 ? length : 15);
+        if (length >= 15) {
+            op = lz4WriteLength(op, length);
+        }
+    }
+    return op;
+}
+
+/* Greedy single-pass LZ4 compression; dst holds at least the compress bound */
+static size_t lz4Compress(const uint8_t *src, size_t srcSize, uint8_t *dst)
+{
+    uint32_t       table[1 << LZ4_HASH_BITS] = {0};
+    const uint8_t *ip                        = src;
+    const uint8_t *anchor                    = src;
+    const uint8_t *end                       = src + srcSize;
+    uint8_t       *op                        = dst;
+
+    if (srcSize > LZ4_MATCH_FIND_LIMIT) {
+        const uint8_t *matchLimit = end - LZ4_LAST_LITERALS;
+        const uint8_t *findLimit  = end - LZ4_MATCH_FIND_LIMIT;
+
+        while (ip <= findLimit) {
+            uint32_t       sequence = read32(ip);
+            uint32_t       slot     = lz4Hash(sequence);
+            const uint8_t *ref      = src + table[slot];
+            table[slot]             = (uint32_t)(ip - src);
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || read32(ref) != sequence) {
+                ip++;
+                continue;
+            }
+
+            /* Extend the match backwards into pending literals, then forwards */
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *matchEnd = ip + LZ4_MIN_MATCH;
+            const uint8_t *refEnd   = ref + LZ4_MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *refEnd) {
+                matchEnd++;
+                refEnd++;
+            }
+
+            op     = lz4WriteSequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - ref),
+                                      (size_t)(matchEnd - ip));
+            ip     = matchEnd;
+            anchor = matchEnd;
+        }
+    }
+
+    /* The block ends with the remaining literals */
+    op = lz4WriteSequence(op, anchor, (size_t)(end - anchor), 0, 0);
+    return (size_t)(op - dst);
+}
+
+/* Read the extra bytes of a literal or match length */
+static bool lz4ReadLength(const uint8_t **ip, const uint8_t *end, size_t *length)
+{
+    uint8_t byte;
+    do {
+        if (*ip >= end) {
+            return false;
+        }
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/* Bounds-checked LZ4 block decompression */
+static bool lz4Decompress(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t dstSize)
+{
+    const uint8_t *ip   = src;
+    const uint8_t *iend = src + srcSize;
+    uint8_t       *op   = dst;
+    uint8_t       *oend = dst + dstSize;
+
+    while (ip < iend) {
+        unsigned token  = *ip++;
+        size_t   length = token >> 4;
+        if (length == 15 && !lz4ReadLength(&ip, iend, &length)) {
+            return false;
+        }
+        if (length > (size_t)(iend - ip) || length > (size_t)(oend - op)) {
+            return false;
+        }
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+
+        /* The last sequence has no match */
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return false;
+        }
+
+        length = token & 15;
+        if (length == 15 && !lz4ReadLength(&ip, iend, &length)) {
+            return false;
+        }
+        length += LZ4_MIN_MATCH;
+        if (length > (size_t)(oend - op)) {
+            return false;
+        }
+
+        /* A match closer than its length repeats bytes it is still writing */
+        const uint8_t *match = op - offset;
+        if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        }
+        else {
+            while (length-- > 0) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == oend;
+}
+
+bool tinyaiCompressionAvailable(TinyAICompression codec)
+{
+    switch (codec) {
+    case TINYAI_COMPRESSION_NONE:
+    case TINYAI_COMPRESSION_LZ4:
+        return true;
+#ifdef TINYAI_HAVE_ZSTD
+    case TINYAI_COMPRESSION_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+size_t tinyaiCompressBound(TinyAICompression codec, size_t size)
+{
+    switch (codec) {
+    case TINYAI_COMPRESSION_NONE:
+        return size;
+    case TINYAI_COMPRESSION_LZ4:
+        return size + size / 255 + 16;
+#ifdef TINYAI_HAVE_ZSTD
+    case TINYAI_COMPRESSION_ZSTD:
+        return ZSTD_compressBound(size);
+#endif
+    default:
+        return 0;
+    }
+}
+
+size_t tinyaiCompressBlock(TinyAICompression codec, const void *src, size_t srcSize, void *dst,
+                           size_t dstCapacity)
+{
+    if ((!src && srcSize > 0) || !dst || !tinyaiCompressionAvailable(codec)) {
+        return 0;
+    }
+
+    switch (codec) {
+    case TINYAI_COMPRESSION_NONE:
+        if (dstCapacity < srcSize) {
+            return 0;
+        }
+        memcpy(dst, src, srcSize);
+        return srcSize;
+    case TINYAI_COMPRESSION_LZ4:
+        /* Compressing straight into the destination needs room for the worst case */
+        if (dstCapacity < tinyaiCompressBound(codec, srcSize)) {
+            return 0;
+        }
+        return lz4Compress((const uint8_t *)src, srcSize, (uint8_t *)dst);
+#ifdef TINYAI_HAVE_ZSTD
+    case TINYAI_COMPRESSION_ZSTD: {
+        size_t size = ZSTD_compress(dst, dstCapacity, src, srcSize, ZSTD_COMPRESSION_LEVEL);
+        return ZSTD_isError(size) ? 0 : size;
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+bool tinyaiDecompressBlock(TinyAICompression codec, const void *src, size_t srcSize, void *dst,
+                           size_t dstSize)
+{
+    if ((!src && srcSize > 0) || (!dst && dstSize > 0)) {
+        return false;
+    }
+
+    switch (codec) {
+    case TINYAI_COMPRESSION_NONE:
+        if (srcSize != dstSize) {
+            return false;
+        }
+        memcpy(dst, src, srcSize);
+        return true;
+    case TINYAI_COMPRESSION_LZ4:
+        return lz4Decompress((const uint8_t *)src, srcSize, (uint8_t *)dst, dstSize);
+#ifdef TINYAI_HAVE_ZSTD
+    case TINYAI_COMPRESSION_ZSTD: {
+        size_t size = ZSTD_decompress(dst, dstSize, src, srcSize);
+        return !ZSTD_isError(size) && size == dstSize;
+    }
+#endif
+    default:
+        return false;
+    }
+}
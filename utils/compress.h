@@ -0,0 +1,80 @@
+/**
+ * @file compress.h
+ * @brief Block compression codecs for TinyAI model files
+ *
+ * LZ4 (raw block format, built in) for fast decompression and zstd (when
+ * built with TINYAI_HAVE_ZSTD) for a better ratio. Each call compresses or
+ * decompresses one independent block, so a large section split into blocks
+ * can be decompressed on several threads at once.
+ */
+
+#ifndef TINYAI_COMPRESS_H
+#define TINYAI_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compression codec
+ */
+typedef enum {
+    TINYAI_COMPRESSION_NONE, /* Stored as is */
+    TINYAI_COMPRESSION_LZ4,  /* LZ4 block format */
+    TINYAI_COMPRESSION_ZSTD  /* Zstandard frame, one per block */
+} TinyAICompression;
+
+/**
+ * Check whether a codec was built in
+ *
+ * @param codec Codec
+ * @return true if blocks can be compressed and decompressed with it
+ */
+bool tinyaiCompressionAvailable(TinyAICompression codec);
+
+/**
+ * Get the largest compressed size of a block
+ *
+ * @param codec Codec
+ * @param size Uncompressed size in bytes
+ * @return Capacity tinyaiCompressBlock needs for any input of that size, or 0
+ *         if the codec is not available
+ */
+size_t tinyaiCompressBound(TinyAICompression codec, size_t size);
+
+/**
+ * Compress one block
+ *
+ * @param codec Codec
+ * @param src Data to compress
+ * @param srcSize Size of the data in bytes
+ * @param dst Destination of dstCapacity bytes
+ * @param dstCapacity Size of the destination
+ * @return Compressed size in bytes, or 0 on failure
+ */
+size_t tinyaiCompressBlock(TinyAICompression codec, const void *src, size_t srcSize, void *dst,
+                           size_t dstCapacity);
+
+/**
+ * Decompress one block
+ *
+ * Corrupt input is detected rather than read or written out of bounds.
+ *
+ * @param codec Codec the block was compressed with
+ * @param src Compressed block
+ * @param srcSize Size of the compressed block in bytes
+ * @param dst Destination of the uncompressed block
+ * @param dstSize Exact uncompressed size in bytes
+ * @return true if the block decompressed to exactly dstSize bytes
+ */
+bool tinyaiDecompressBlock(TinyAICompression codec, const void *src, size_t srcSize, void *dst,
+                           size_t dstSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_COMPRESS_H */
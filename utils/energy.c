@@ -0,0 +1,101 @@
+/**
+ * @file energy.c
+ * @brief Implementation of the energy-aware execution profile and energy counters
+ */
+
+#include "energy.h"
+#include "../core/config.h"
+#include "trace.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Package energy counter of the Linux powercap interface */
+#define RAPL_PACKAGE_COUNTER "/sys/class/powercap/intel-rapl:0/energy_uj"
+
+/* File next to a powercap counter holding the value it wraps at */
+#define RAPL_RANGE_FILE "max_energy_range_uj"
+
+TinyAIExecutionProfile tinyaiGetExecutionProfile(void)
+{
+    const char *profile = tinyaiConfigGetString("system.profile", "performance");
+    if (profile && strcmp(profile, "energy") == 0) {
+        return TINYAI_PROFILE_ENERGY;
+    }
+    return TINYAI_PROFILE_PERFORMANCE;
+}
+
+int tinyaiProfileThreads(int numThreads)
+{
+    if (tinyaiGetExecutionProfile() != TINYAI_PROFILE_ENERGY) {
+        return numThreads;
+    }
+
+    int cap = tinyaiConfigGetInt("system.energy_threads", TINYAI_ENERGY_THREADS);
+    if (cap <= 0) {
+        return numThreads;
+    }
+    return numThreads == 0 || numThreads > cap ? cap : numThreads;
+}
+
+/* Read a counter file holding one decimal value */
+static bool readCounter(const char *path, uint64_t *value)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    bool read = fscanf(file, "%" SCNu64, value) == 1;
+    fclose(file);
+    return read;
+}
+
+bool tinyaiEnergyMeterStart(TinyAIEnergyMeter *meter)
+{
+    if (!meter) {
+        return false;
+    }
+
+    memset(meter, 0, sizeof(TinyAIEnergyMeter));
+    meter->startTime = tinyaiTraceNow();
+
+    const char *counter = tinyaiConfigGetString("system.energy_counter", RAPL_PACKAGE_COUNTER);
+    if (!counter || strlen(counter) >= TINYAI_ENERGY_PATH_MAX ||
+        !readCounter(counter, &meter->startMicrojoules)) {
+        return false;
+    }
+    strcpy(meter->counter, counter);
+
+    /* The wrap value sits next to the counter; without it a wrap cannot be undone */
+    char        range[TINYAI_ENERGY_PATH_MAX + sizeof(RAPL_RANGE_FILE)];
+    const char *slash  = strrchr(counter, '/');
+    size_t      prefix = slash ? (size_t)(slash - counter) + 1 : 0;
+    memcpy(range, counter, prefix);
+    strcpy(range + prefix, RAPL_RANGE_FILE);
+    if (!readCounter(range, &meter->rangeMicrojoules)) {
+        meter->rangeMicrojoules = 0;
+    }
+    return true;
+}
+
+double tinyaiEnergyMeterRead(const TinyAIEnergyMeter *meter, double *seconds)
+{
+    if (seconds) {
+        *seconds = meter ? (double)(tinyaiTraceNow() - meter->startTime) / 1e9 : 0.0;
+    }
+
+    uint64_t now;
+    if (!meter || meter->counter[0] == '\0' || !readCounter(meter->counter, &now)) {
+        return -1.0;
+    }
+
+    /* The counter wrapped at most once if it is read more often than it wraps */
+    uint64_t used = now - meter->startMicrojoules;
+    if (now < meter->startMicrojoules) {
+        if (meter->rangeMicrojoules == 0) {
+            return -1.0;
+        }
+        used = meter->rangeMicrojoules - meter->startMicrojoules + now;
+    }
+    return (double)used / 1e6;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file energy.h
+ * @brief Energy-aware execution profile and energy counters for TinyAI
+ *
+ * On battery devices joules per inference matter more than latency. The
+ * "system.profile" configuration key picks how work trades one for the
+ * other: "performance" (the default) runs as fast as it can, while "energy"
+ * caps the shared thread pool at "system.energy_threads" workers, hands them
+ * larger parallel ranges so fewer cores wake for each loop, lets pruned text
+ * layers take sparse kernels at a lower sparsity, switches image models to
+ * int8 activations once they are calibrated, and has audio pipelines pass
+ * speech on in bursts instead of every frame, so cores idle in between.
+ * The profile is read when the shared pool, a generation plan or a pipeline
+ * configuration is created.
+ *
+ * An energy meter measures the effect. It reads the package counter of the
+ * Linux powercap interface (Intel RAPL, and AMD RAPL on recent kernels), or
+ * the microjoule counter file named by the "system.energy_counter" key.
+ * Where no counter is readable the meter reports no estimate.
+ */
+
+#ifndef TINYAI_ENERGY_H
+#define TINYAI_ENERGY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Default worker cap of the energy profile
+ */
+#define TINYAI_ENERGY_THREADS 2
+
+/**
+ * Factor the energy profile scales the minimum parallel work by
+ */
+#define TINYAI_ENERGY_WORK_SCALE 4
+
+/**
+ * Default minimum sparsity of sparse text kernels under the energy profile
+ */
+#define TINYAI_ENERGY_SPARSE_MIN_SPARSITY 0.3f
+
+/**
+ * Default audio pipeline burst under the energy profile, in milliseconds
+ */
+#define TINYAI_ENERGY_AUDIO_BURST_MS 200
+
+/**
+ * Longest counter path an energy meter holds
+ */
+#define TINYAI_ENERGY_PATH_MAX 256
+
+/**
+ * Execution profile
+ */
+typedef enum {
+    TINYAI_PROFILE_PERFORMANCE, /* Fastest execution */
+    TINYAI_PROFILE_ENERGY       /* Fewest joules per inference */
+} TinyAIExecutionProfile;
+
+/**
+ * Energy consumed since a start point
+ */
+typedef struct {
+    char     counter[TINYAI_ENERGY_PATH_MAX]; /* Counter file, empty when none is readable */
+    uint64_t startMicrojoules;                /* Counter value at the start */
+    uint64_t rangeMicrojoules;                /* Value the counter wraps at (0 = unknown) */
+    uint64_t startTime;                       /* tinyaiTraceNow() at the start */
+} TinyAIEnergyMeter;
+
+/**
+ * Get the profile from the "system.profile" configuration key
+ *
+ * @return Configured profile, TINYAI_PROFILE_PERFORMANCE when unset or unknown
+ */
+TinyAIExecutionProfile tinyaiGetExecutionProfile(void);
+
+/**
+ * Limit a thread count to the profile's worker cap
+ *
+ * @param numThreads Requested threads (0 = one per online CPU)
+ * @return Threads to create, with the same meaning
+ */
+int tinyaiProfileThreads(int numThreads);
+
+/**
+ * Start measuring energy
+ *
+ * @param meter Meter to start
+ * @return true if a counter was read, false if no estimate will be available
+ */
+bool tinyaiEnergyMeterStart(TinyAIEnergyMeter *meter);
+
+/**
+ * Get the energy consumed since a meter was started
+ *
+ * The counter covers the whole package, so it includes other work running
+ * at the same time.
+ *
+ * @param meter Started meter
+ * @param seconds Output parameter for the elapsed time in seconds (may be NULL)
+ * @return Joules consumed, negative when no counter is readable
+ */
+double tinyaiEnergyMeterRead(const TinyAIEnergyMeter *meter, double *seconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_ENERGY_H */
@@ -5,13 +5,42 @@
  */
 
 #include "forward_scheduler.h"
+#include "numa.h"
 #include <float.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <process.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 /* Maximum number of layers in a model */
 #define MAX_EXEC_LAYERS 256
 
+/* Layers requested ahead of the one being executed, by default */
+#define DEFAULT_PREFETCH_DISTANCE 2
+
+/* Activations buffered between two pipeline stages (a power of two) */
+#define STREAM_QUEUE_DEPTH 4
+
+/* Keeps the indices of a stream queue on separate cache lines */
+#define CACHE_LINE_SIZE 64
+
+/* Batch size calibration defaults */
+#define CALIBRATION_ITERATIONS 3
+#define CALIBRATION_MAX_ITERATIONS 16
+#define CALIBRATION_KNEE 0.9f
+
+/* Longest line of the batch size cache */
+#define CALIBRATION_LINE_SIZE 256
+
 /* Forward scheduler structure definition */
 struct TinyAIForwardScheduler {
     /* Model reference */
@@ -30,18 +59,64 @@ struct TinyAIForwardScheduler {
     size_t currentMemoryUsage;
     size_t peakMemoryUsage;
 
+    /* Layers whose weights are prefetched ahead of execution */
+    int prefetchDistance;
+
     /* Layer execution callback function and user data */
-    bool (*executeLayerFunc)(void *userData, int layerIndex, const void *input, void *output);
-    void *userData;
+    TinyAILayerExecuteFn executeLayerFunc;
+    void                *userData;
+
+    /* Batch size measured by tinyaiCalibrateBatchSize (0 before calibration) */
+    int calibratedBatchSize;
+};
+
+/* One layer queued by a parallel forward pass */
+typedef struct ForwardPass ForwardPass;
+typedef struct {
+    ForwardPass *pass;
+    int          layer;
+} LayerTask;
+
+/* State of a parallel forward pass */
+struct ForwardPass {
+    TinyAIForwardScheduler *scheduler;
+    TinyAITaskGroup        *group;
+    const void             *input;
+    void                   *output;
+    int                     running; /* Layers dispatched but not finished */
+    bool                    failed;
+    bool                    dispatched[MAX_EXEC_LAYERS];
+    LayerTask               tasks[MAX_EXEC_LAYERS];
+
+    /* Guards the scheduler's layers and memory counters during the pass */
+#ifdef _WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
 };
 
-/* Find the next executable layer based on dependencies */
-static int findNextExecutableLayer(TinyAIForwardScheduler *scheduler)
+/* Get the layer whose output a layer consumes, or -1 for the pass input */
+static int layerDependency(const TinyAIForwardScheduler *scheduler, int layer)
+{
+    switch (scheduler->layers[layer].depType) {
+    case TINYAI_DEP_SEQUENTIAL:
+        return layer - 1;
+    case TINYAI_DEP_RESIDUAL:
+    case TINYAI_DEP_ATTENTION:
+        return scheduler->layers[layer].dependsOnLayer;
+    default:
+        return -1;
+    }
+}
+
+/* Find the next executable layer based on dependencies, given which layers have executed */
+static int findNextExecutableLayer(const TinyAIForwardScheduler *scheduler, const bool *executed)
 {
     /* First pass: find all layers that have all dependencies satisfied */
     for (int i = 0; i < scheduler->layerCount; i++) {
         /* Skip already executed layers */
-        if (scheduler->layers[i].executed) {
+        if (executed[i]) {
             continue;
         }
 
@@ -53,7 +128,7 @@ static int findNextExecutableLayer(TinyAIForwardScheduler *scheduler)
 
         case TINYAI_DEP_SEQUENTIAL:
             /* Must execute after previous layer */
-            if (i == 0 || scheduler->layers[i - 1].executed) {
+            if (i == 0 || executed[i - 1]) {
                 return i;
             }
             break;
@@ -62,7 +137,7 @@ static int findNextExecutableLayer(TinyAIForwardScheduler *scheduler)
         case TINYAI_DEP_ATTENTION:
             /* Depends on specific layer */
             if (scheduler->layers[i].dependsOnLayer < 0 ||
-                scheduler->layers[scheduler->layers[i].dependsOnLayer].executed) {
+                executed[scheduler->layers[i].dependsOnLayer]) {
                 return i;
             }
             break;
@@ -73,6 +148,20 @@ static int findNextExecutableLayer(TinyAIForwardScheduler *scheduler)
     return -1;
 }
 
+/* Request the weights of the layers that will execute after the given one */
+static void prefetchUpcomingLayers(TinyAIForwardScheduler *scheduler, bool *executed, int layer)
+{
+    executed[layer] = true;
+    for (int d = 0; d < scheduler->prefetchDistance; d++) {
+        int next = findNextExecutableLayer(scheduler, executed);
+        if (next < 0) {
+            break;
+        }
+        tinyaiRequestLayerPrefetch(scheduler->model, scheduler->layers[next].layerIndex);
+        executed[next] = true;
+    }
+}
+
 /* Check if a layer's output is needed by any future layers */
 static bool isOutputNeededByFutureLayers(TinyAIForwardScheduler *scheduler, int layerIndex)
 {
@@ -90,8 +179,7 @@ static bool isOutputNeededByFutureLayers(TinyAIForwardScheduler *scheduler, int
         }
 
         /* For sequential dependencies, check if it's the next layer */
-        if (scheduler->layers[i].depType == TINYAI_DEP_SEQUENTIAL && i > 0 && i - 1 == layerIndex &&
-            !scheduler->layers[i - 1].executed) {
+        if (scheduler->layers[i].depType == TINYAI_DEP_SEQUENTIAL && i > 0 && i - 1 == layerIndex) {
             return true;
         }
     }
@@ -149,6 +237,7 @@ TinyAIForwardScheduler *tinyaiCreateForwardScheduler(TinyAIMappedModel  *model,
     scheduler->currentLayer       = -1;
     scheduler->currentMemoryUsage = 0;
     scheduler->peakMemoryUsage    = 0;
+    scheduler->prefetchDistance   = DEFAULT_PREFETCH_DISTANCE;
 
     return scheduler;
 }
@@ -233,7 +322,11 @@ bool tinyaiExecuteNextLayer(TinyAIForwardScheduler *scheduler, const void *input
     }
 
     /* Find next executable layer */
-    int nextLayer = findNextExecutableLayer(scheduler);
+    bool executed[MAX_EXEC_LAYERS];
+    for (int i = 0; i < scheduler->layerCount; i++) {
+        executed[i] = scheduler->layers[i].executed;
+    }
+    int nextLayer = findNextExecutableLayer(scheduler, executed);
     if (nextLayer < 0) {
         /* No more layers to execute */
         return false;
@@ -253,6 +346,9 @@ bool tinyaiExecuteNextLayer(TinyAIForwardScheduler *scheduler, const void *input
         if (!weights) {
             return false;
         }
+
+        /* Read the next layers' weights while this one computes */
+        prefetchUpcomingLayers(scheduler, executed, nextLayer);
     }
 
     /* Allocate output buffer if needed */
@@ -269,9 +365,25 @@ bool tinyaiExecuteNextLayer(TinyAIForwardScheduler *scheduler, const void *input
         }
     }
 
+    /* Compute the layer from its dependency's output */
+    if (scheduler->executeLayerFunc) {
+        int         dependency = layerDependency(scheduler, nextLayer);
+        const void *layerInput =
+            dependency >= 0 ? scheduler->layers[dependency].outputPtr : input;
+        if (!scheduler->executeLayerFunc(scheduler->userData, layer->layerIndex, layerInput,
+                                         layer->outputPtr)) {
+            return false;
+        }
+    }
+
     /* Mark as executed */
     layer->executed = true;
 
+    /* For final layer, copy output if provided, before it can be freed */
+    if (output && nextLayer == scheduler->layerCount - 1 && layer->outputPtr) {
+        memcpy(output, layer->outputPtr, layer->outputSize);
+    }
+
     /* Free memory for outputs that are no longer needed */
     if (scheduler->mode == TINYAI_EXEC_MEMORY_OPT || scheduler->mode == TINYAI_EXEC_ADAPTIVE) {
         freeUnneededOutputs(scheduler);
@@ -287,22 +399,184 @@ bool tinyaiExecuteNextLayer(TinyAIForwardScheduler *scheduler, const void *input
         *layerIndex = layer->layerIndex;
     }
 
-    /* For final layer, copy output if provided */
-    if (output && nextLayer == scheduler->layerCount - 1 && layer->outputPtr) {
-        memcpy(output, layer->outputPtr, layer->outputSize);
+    return true;
+}
+
+bool tinyaiSetLayerExecuteFunction(TinyAIForwardScheduler *scheduler, TinyAILayerExecuteFn execute,
+                                   void *userData)
+{
+    if (!scheduler) {
+        return false;
     }
 
+    scheduler->executeLayerFunc = execute;
+    scheduler->userData         = userData;
     return true;
 }
 
-int tinyaiCalculateOptimalBatchSize(TinyAIForwardScheduler *scheduler, size_t inputSize,
-                                    size_t outputSize, int maxBatchSize)
+static void lockPass(ForwardPass *pass)
 {
+#ifdef _WIN32
+    EnterCriticalSection(&pass->lock);
+#else
+    pthread_mutex_lock(&pass->lock);
+#endif
+}
 
-    if (!scheduler || maxBatchSize <= 0) {
-        return 1;
+static void unlockPass(ForwardPass *pass)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&pass->lock);
+#else
+    pthread_mutex_unlock(&pass->lock);
+#endif
+}
+
+static void runLayerTask(void *context);
+
+/* Dispatch every layer whose dependency has finished and whose output fits the memory limit */
+static void dispatchReadyLayers(ForwardPass *pass)
+{
+    TinyAIForwardScheduler *scheduler = pass->scheduler;
+    int                     ready[MAX_EXEC_LAYERS];
+    int                     numReady = 0;
+
+    lockPass(pass);
+    for (int i = 0; i < scheduler->layerCount && !pass->failed; i++) {
+        TinyAIExecLayer *layer      = &scheduler->layers[i];
+        int              dependency = layerDependency(scheduler, i);
+        if (pass->dispatched[i] || layer->executed ||
+            (dependency >= 0 && !scheduler->layers[dependency].executed)) {
+            continue;
+        }
+
+        /* Over the limit, wait for running layers to free their inputs */
+        size_t size = layer->outputPtr ? 0 : layer->outputSize;
+        bool overLimit = scheduler->maxMemory > 0 &&
+                         scheduler->currentMemoryUsage + size > scheduler->maxMemory;
+        if (overLimit && pass->running + numReady > 0) {
+            continue;
+        }
+
+        if (size > 0) {
+            layer->outputPtr = malloc(size);
+            if (!layer->outputPtr) {
+                pass->failed = true;
+                break;
+            }
+            scheduler->currentMemoryUsage += size;
+            if (scheduler->currentMemoryUsage > scheduler->peakMemoryUsage) {
+                scheduler->peakMemoryUsage = scheduler->currentMemoryUsage;
+            }
+        }
+
+        pass->dispatched[i] = true;
+        ready[numReady++]   = i;
+    }
+    pass->running += numReady;
+    unlockPass(pass);
+
+    /* Queue outside the lock, since a task may run before this returns */
+    for (int i = 0; i < numReady; i++) {
+        tinyaiTaskGroupRun(pass->group, runLayerTask, &pass->tasks[ready[i]], TINYAI_AFFINITY_ANY);
+    }
+}
+
+/* Run one layer, then dispatch the layers it unblocked */
+static void runLayerTask(void *context)
+{
+    LayerTask              *task      = (LayerTask *)context;
+    ForwardPass            *pass      = task->pass;
+    TinyAIForwardScheduler *scheduler = pass->scheduler;
+    TinyAIExecLayer        *layer     = &scheduler->layers[task->layer];
+    bool                    memoryOpt =
+        scheduler->mode == TINYAI_EXEC_MEMORY_OPT || scheduler->mode == TINYAI_EXEC_ADAPTIVE;
+
+    /* The dependency has finished and stays needed until this layer has, so it is stable */
+    int         dependency = layerDependency(scheduler, task->layer);
+    const void *input = dependency >= 0 ? scheduler->layers[dependency].outputPtr : pass->input;
+
+    bool ok = !memoryOpt || tinyaiGetLayerWeights(scheduler->model, layer->layerIndex) != NULL;
+    if (ok && scheduler->executeLayerFunc) {
+        ok = scheduler->executeLayerFunc(scheduler->userData, layer->layerIndex, input,
+                                         layer->outputPtr);
+    }
+    if (scheduler->mode == TINYAI_EXEC_MEMORY_OPT) {
+        tinyaiReleaseLayerWeights(scheduler->model, layer->layerIndex);
     }
 
+    lockPass(pass);
+    pass->running--;
+    if (!ok) {
+        pass->failed = true;
+    }
+    else {
+        layer->executed         = true;
+        scheduler->currentLayer = task->layer;
+        if (pass->output && task->layer == scheduler->layerCount - 1 && layer->outputPtr) {
+            memcpy(pass->output, layer->outputPtr, layer->outputSize);
+        }
+        if (memoryOpt) {
+            freeUnneededOutputs(scheduler);
+        }
+    }
+    unlockPass(pass);
+
+    dispatchReadyLayers(pass);
+}
+
+bool tinyaiExecuteForwardPass(TinyAIForwardScheduler *scheduler, TinyAIThreadPool *pool,
+                              const void *input, void *output)
+{
+    if (!scheduler) {
+        return false;
+    }
+
+    ForwardPass *pass = (ForwardPass *)malloc(sizeof(ForwardPass));
+    if (!pass) {
+        return false;
+    }
+    memset(pass, 0, sizeof(ForwardPass));
+    pass->scheduler = scheduler;
+    pass->input     = input;
+    pass->output    = output;
+    pass->group     = tinyaiCreateTaskGroup(pool);
+    if (!pass->group) {
+        free(pass);
+        return false;
+    }
+    for (int i = 0; i < scheduler->layerCount; i++) {
+        pass->tasks[i].pass  = pass;
+        pass->tasks[i].layer = i;
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&pass->lock);
+#else
+    pthread_mutex_init(&pass->lock, NULL);
+#endif
+
+    /* Each finished layer dispatches the ones it unblocks, until none are left */
+    dispatchReadyLayers(pass);
+    tinyaiDestroyTaskGroup(pass->group);
+
+    bool complete = !pass->failed;
+    for (int i = 0; i < scheduler->layerCount; i++) {
+        complete = complete && scheduler->layers[i].executed;
+    }
+
+#ifdef _WIN32
+    DeleteCriticalSection(&pass->lock);
+#else
+    pthread_mutex_destroy(&pass->lock);
+#endif
+    free(pass);
+    return complete;
+}
+
+/* Largest batch the memory limit leaves room for, from the static per-sample formula */
+static int memoryBatchLimit(const TinyAIForwardScheduler *scheduler, size_t inputSize,
+                            size_t outputSize, int maxBatchSize)
+{
     /* If no memory limit, return maximum batch size */
     if (scheduler->maxMemory == 0) {
         return maxBatchSize;
@@ -310,6 +584,9 @@ int tinyaiCalculateOptimalBatchSize(TinyAIForwardScheduler *scheduler, size_t in
 
     /* Calculate per-sample memory usage */
     size_t perSampleMemory = inputSize + outputSize;
+    if (perSampleMemory == 0) {
+        return maxBatchSize;
+    }
 
     /* Estimate intermediate activations based on layer outputs */
     size_t intermediateMemory = 0;
@@ -342,6 +619,274 @@ int tinyaiCalculateOptimalBatchSize(TinyAIForwardScheduler *scheduler, size_t in
     return batchSize;
 }
 
+int tinyaiCalculateOptimalBatchSize(TinyAIForwardScheduler *scheduler, size_t inputSize,
+                                    size_t outputSize, int maxBatchSize)
+{
+    if (!scheduler || maxBatchSize <= 0) {
+        return 1;
+    }
+
+    /* A measured batch size wins whenever memory allows it */
+    int batchSize = memoryBatchLimit(scheduler, inputSize, outputSize, maxBatchSize);
+    if (scheduler->calibratedBatchSize > 0 && scheduler->calibratedBatchSize < batchSize) {
+        batchSize = scheduler->calibratedBatchSize;
+    }
+    return batchSize;
+}
+
+/* Get a monotonic time in nanoseconds */
+static uint64_t getTimeNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        count;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&count);
+    return (uint64_t)((double)count.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* Hash the layer sizes and precisions, which identify a model across runs */
+static uint64_t modelKey(const TinyAIForwardScheduler *scheduler)
+{
+    uint64_t hash = 1469598103934665603ULL; /* FNV-1a */
+    int      count = tinyaiGetMappedLayerCount(scheduler->model);
+
+    for (int i = -1; i < count; i++) {
+        const TinyAILayerDescriptor *layer = i >= 0 ? tinyaiGetLayerDescriptor(scheduler->model, i)
+                                                    : NULL;
+        uint64_t values[2] = {layer ? layer->size : (uint64_t)count,
+                              layer ? (uint64_t)layer->precision : 0};
+        for (int v = 0; v < 2; v++) {
+            for (int byte = 0; byte < 8; byte++) {
+                hash = (hash ^ ((values[v] >> (byte * 8)) & 0xff)) * 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}
+
+/* Name the host by its name and processor count */
+static void hostKey(char *key, size_t size)
+{
+    char name[64] = "host";
+    int  cpus;
+
+#ifdef _WIN32
+    DWORD       length = (DWORD)sizeof(name);
+    SYSTEM_INFO info;
+    GetComputerNameA(name, &length);
+    GetSystemInfo(&info);
+    cpus = (int)info.dwNumberOfProcessors;
+#else
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (gethostname(name, sizeof(name)) != 0) {
+        strcpy(name, "host");
+    }
+    name[sizeof(name) - 1] = '\0';
+    cpus                   = online > 0 ? (int)online : 1;
+#endif
+
+    /* The key is one word of the cache file */
+    for (char *c = name; *c; c++) {
+        if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {
+            *c = '_';
+        }
+    }
+    snprintf(key, size, "%s/%dcpu/%dnode", name, cpus, tinyaiNumaNodeCount());
+}
+
+/* Look up a calibration in the cache file */
+static bool readCalibration(const char *path, const char *key, TinyAIBatchCalibration *result)
+{
+    char   line[CALIBRATION_LINE_SIZE];
+    size_t keyLength = strlen(key);
+    bool   found     = false;
+    FILE  *file      = fopen(path, "r");
+
+    if (!file) {
+        return false;
+    }
+    while (!found && fgets(line, sizeof(line), file)) {
+        unsigned long long latency;
+        if (strncmp(line, key, keyLength) == 0 && line[keyLength] == ' ' &&
+            sscanf(line + keyLength, "%d %llu %lf", &result->batchSize, &latency,
+                   &result->throughput) == 3 &&
+            result->batchSize > 0) {
+            result->latencyNs = latency;
+            found             = true;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+/* Store a calibration in the cache file, replacing the one with the same key */
+static void writeCalibration(const char *path, const char *key,
+                             const TinyAIBatchCalibration *result)
+{
+    char   line[CALIBRATION_LINE_SIZE];
+    size_t keyLength = strlen(key);
+    char  *kept      = NULL;
+    size_t keptSize  = 0;
+    FILE  *file      = fopen(path, "r");
+
+    /* Keep the entries of other models, hosts and limits */
+    if (file) {
+        while (fgets(line, sizeof(line), file)) {
+            size_t length = strlen(line);
+            if (strncmp(line, key, keyLength) == 0 && line[keyLength] == ' ') {
+                continue;
+            }
+            char *grown = (char *)realloc(kept, keptSize + length + 1);
+            if (!grown) {
+                break;
+            }
+            kept = grown;
+            memcpy(kept + keptSize, line, length + 1);
+            keptSize += length;
+        }
+        fclose(file);
+    }
+
+    file = fopen(path, "w");
+    if (file) {
+        if (kept) {
+            fputs(kept, file);
+        }
+        fprintf(file, "%s %d %llu %.3f\n", key, result->batchSize,
+                (unsigned long long)result->latencyNs, result->throughput);
+        fclose(file);
+    }
+    free(kept);
+}
+
+/* Median time of timed runs of one batch, or 0 if a run failed */
+static uint64_t measureBatch(TinyAIBatchRunFn run, void *userData, int batchSize, int iterations)
+{
+    uint64_t times[CALIBRATION_MAX_ITERATIONS];
+
+    /* One untimed run warms caches and loads weights */
+    if (!run(userData, batchSize)) {
+        return 0;
+    }
+    for (int i = 0; i < iterations; i++) {
+        uint64_t start = getTimeNs();
+        if (!run(userData, batchSize)) {
+            return 0;
+        }
+        uint64_t time = getTimeNs() - start;
+
+        /* Insertion sort, the run count is small */
+        int j = i;
+        while (j > 0 && times[j - 1] > time) {
+            times[j] = times[j - 1];
+            j--;
+        }
+        times[j] = time > 0 ? time : 1;
+    }
+    return times[iterations / 2];
+}
+
+void tinyaiGetDefaultBatchCalibrationConfig(TinyAIBatchCalibrationConfig *config)
+{
+    if (!config) {
+        return;
+    }
+
+    memset(config, 0, sizeof(*config));
+    config->maxBatchSize = 32;
+    config->iterations   = CALIBRATION_ITERATIONS;
+    config->kneeFraction = CALIBRATION_KNEE;
+}
+
+bool tinyaiCalibrateBatchSize(TinyAIForwardScheduler             *scheduler,
+                              const TinyAIBatchCalibrationConfig *config, TinyAIBatchRunFn run,
+                              void *userData, TinyAIBatchCalibration *result)
+{
+    TinyAIBatchCalibration best = {0};
+    char                   host[96];
+    char                   key[192];
+
+    if (!scheduler || !config || !run || !result || config->maxBatchSize <= 0) {
+        return false;
+    }
+    memset(result, 0, sizeof(*result));
+
+    /* Only sizes that fit the memory limit are tried */
+    int memoryCap  = memoryBatchLimit(scheduler, config->inputSize, config->outputSize,
+                                      config->maxBatchSize);
+    int iterations = config->iterations;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+    if (iterations > CALIBRATION_MAX_ITERATIONS) {
+        iterations = CALIBRATION_MAX_ITERATIONS;
+    }
+
+    /* The answer depends on the model, the host and the limits asked for */
+    hostKey(host, sizeof(host));
+    snprintf(key, sizeof(key), "%016llx %s %llu %d", (unsigned long long)modelKey(scheduler), host,
+             (unsigned long long)config->latencySloNs, memoryCap);
+    if (config->cachePath && readCalibration(config->cachePath, key, result) &&
+        result->batchSize <= memoryCap) {
+        result->cached                 = true;
+        scheduler->calibratedBatchSize = result->batchSize;
+        return true;
+    }
+
+    /* Sweep powers of two up to the cap, stopping at the first batch over the SLO */
+    TinyAIBatchCalibration measured[32];
+    int                    count = 0;
+    for (int batch = 1; count < 32; batch = batch < memoryCap / 2 ? batch * 2 : memoryCap) {
+        uint64_t latency = measureBatch(run, userData, batch, iterations);
+        if (latency == 0) {
+            return false;
+        }
+
+        /* Even one sample missing the SLO is kept: requests are then served unbatched */
+        bool overSlo = config->latencySloNs > 0 && latency > config->latencySloNs;
+        if (overSlo && count > 0) {
+            break;
+        }
+
+        measured[count].batchSize  = batch;
+        measured[count].latencyNs  = latency;
+        measured[count].throughput = (double)batch * 1e9 / (double)latency;
+        measured[count].cached     = false;
+        if (measured[count].throughput > best.throughput) {
+            best = measured[count];
+        }
+        count++;
+        if (overSlo || batch == memoryCap) {
+            break;
+        }
+    }
+
+    /* The knee: the smallest batch within reach of the best throughput */
+    float knee = config->kneeFraction > 0.0f && config->kneeFraction <= 1.0f ? config->kneeFraction
+                                                                             : CALIBRATION_KNEE;
+    for (int i = 0; i < count; i++) {
+        if (measured[i].throughput >= best.throughput * knee) {
+            best = measured[i];
+            break;
+        }
+    }
+
+    *result                        = best;
+    scheduler->calibratedBatchSize = best.batchSize;
+    if (config->cachePath) {
+        writeCalibration(config->cachePath, key, result);
+    }
+    return true;
+}
+
 size_t tinyaiGetSchedulerMemoryUsage(const TinyAIForwardScheduler *scheduler)
 {
     if (!scheduler) {
@@ -417,3 +962,358 @@ void tinyaiMarkLayerOutputUnneeded(TinyAIForwardScheduler *scheduler, int layerI
     /* Mark as unneeded */
     layer->outputNeeded = false;
 }
+
+bool tinyaiSetSchedulerPrefetchDistance(TinyAIForwardScheduler *scheduler, int distance)
+{
+    if (!scheduler || distance < 0) {
+        return false;
+    }
+
+    scheduler->prefetchDistance = distance;
+    return true;
+}
+
+/* Queue positions, only ever advanced by one side */
+#ifdef _WIN32
+typedef volatile LONG StreamIndex;
+#else
+typedef unsigned long StreamIndex;
+#endif
+
+/* Bounded single-producer single-consumer queue of activation buffers */
+typedef struct {
+    void       *slots[STREAM_QUEUE_DEPTH];
+    char        pad0[CACHE_LINE_SIZE];
+    StreamIndex head; /* Next slot to read, advanced by the consumer */
+    char        pad1[CACHE_LINE_SIZE];
+    StreamIndex tail; /* Next slot to write, advanced by the producer */
+    char        pad2[CACHE_LINE_SIZE];
+} StreamQueue;
+
+/* Buffers passed from one stage to the next: filled ones forward, empty ones back */
+typedef struct {
+    StreamQueue full;
+    StreamQueue empty;
+    void       *buffers[STREAM_QUEUE_DEPTH]; /* Every buffer, wherever it is, for freeing */
+} StreamBoundary;
+
+typedef struct StreamPass StreamPass;
+
+/* One pipeline stage and the layers it runs */
+typedef struct {
+    StreamPass *pass;
+    int         stage;
+    int         firstLayer;
+    int         lastLayer;
+    void       *scratch[2]; /* Activations between the stage's own layers */
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} StreamStage;
+
+/* State of a streaming pass */
+struct StreamPass {
+    TinyAIForwardScheduler *scheduler;
+    const void *const      *inputs;
+    void *const            *outputs;
+    size_t                  count;
+    int                     numStages;
+    StreamStage            *stages;
+    StreamBoundary         *boundaries; /* numStages - 1 boundaries */
+    StreamIndex             failed;
+};
+
+static unsigned long loadIndex(StreamIndex *index)
+{
+#ifdef _WIN32
+    return (unsigned long)InterlockedCompareExchange(index, 0, 0);
+#else
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void storeIndex(StreamIndex *index, unsigned long value)
+{
+#ifdef _WIN32
+    InterlockedExchange(index, (LONG)value);
+#else
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static void yieldThread(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+/* Add a buffer; the queue never holds more buffers than exist, so it cannot be full */
+static void pushStream(StreamQueue *queue, void *buffer)
+{
+    unsigned long tail                              = loadIndex(&queue->tail);
+    queue->slots[tail & (STREAM_QUEUE_DEPTH - 1)] = buffer;
+    storeIndex(&queue->tail, tail + 1);
+}
+
+/* Take the oldest buffer, waiting for one; NULL once another stage has failed */
+static void *popStream(StreamPass *pass, StreamQueue *queue)
+{
+    unsigned long head = loadIndex(&queue->head);
+    while (loadIndex(&queue->tail) == head) {
+        if (loadIndex(&pass->failed)) {
+            return NULL;
+        }
+        yieldThread();
+    }
+
+    void *buffer = queue->slots[head & (STREAM_QUEUE_DEPTH - 1)];
+    storeIndex(&queue->head, head + 1);
+    return buffer;
+}
+
+/* Run every item through one stage's layers */
+static bool runStreamStage(StreamStage *stage)
+{
+    StreamPass             *pass      = stage->pass;
+    TinyAIForwardScheduler *scheduler = pass->scheduler;
+    bool                    first     = stage->stage == 0;
+    bool                    last      = stage->stage == pass->numStages - 1;
+
+    /* Each stage owns its layers' weights for the whole stream */
+    for (int l = stage->firstLayer; l <= stage->lastLayer; l++) {
+        if (!tinyaiGetLayerWeights(scheduler->model, scheduler->layers[l].layerIndex)) {
+            return false;
+        }
+    }
+
+    for (size_t item = 0; item < pass->count; item++) {
+        void *received = first ? NULL : popStream(pass, &pass->boundaries[stage->stage - 1].full);
+        const void *input = first ? pass->inputs[item] : received;
+        if (!input && !first) {
+            return false;
+        }
+
+        for (int l = stage->firstLayer; l <= stage->lastLayer; l++) {
+            void *output = stage->scratch[(l - stage->firstLayer) & 1];
+            if (l == stage->lastLayer && !last) {
+                output = popStream(pass, &pass->boundaries[stage->stage].empty);
+                if (!output) {
+                    return false;
+                }
+            }
+            else if (l == stage->lastLayer && pass->outputs) {
+                output = pass->outputs[item];
+            }
+
+            if (scheduler->executeLayerFunc &&
+                !scheduler->executeLayerFunc(scheduler->userData, scheduler->layers[l].layerIndex,
+                                             input, output)) {
+                return false;
+            }
+
+            /* The received activation has been consumed; hand it back for reuse */
+            if (l == stage->firstLayer && received) {
+                pushStream(&pass->boundaries[stage->stage - 1].empty, received);
+            }
+            input = output;
+        }
+
+        if (!last) {
+            pushStream(&pass->boundaries[stage->stage].full, (void *)input);
+        }
+    }
+
+    if (scheduler->mode == TINYAI_EXEC_MEMORY_OPT) {
+        for (int l = stage->firstLayer; l <= stage->lastLayer; l++) {
+            tinyaiReleaseLayerWeights(scheduler->model, scheduler->layers[l].layerIndex);
+        }
+    }
+    return true;
+}
+
+/* Stage thread: pin to the stage's CPU, run, and stop the others on failure */
+#ifdef _WIN32
+static unsigned __stdcall streamStageThread(void *param)
+#else
+static void *streamStageThread(void *param)
+#endif
+{
+    StreamStage *stage = (StreamStage *)param;
+
+    tinyaiNumaBindThreadToCpu(stage->stage);
+    if (!runStreamStage(stage)) {
+        storeIndex(&stage->pass->failed, 1);
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/* Split the chain into stages of contiguous layers with about equal weight sizes */
+static void assignStreamStages(StreamPass *pass)
+{
+    TinyAIForwardScheduler *scheduler = pass->scheduler;
+    size_t                  weights[MAX_EXEC_LAYERS];
+    size_t                  total = 0;
+
+    for (int l = 0; l < scheduler->layerCount; l++) {
+        const TinyAILayerDescriptor *desc =
+            tinyaiGetLayerDescriptor(scheduler->model, scheduler->layers[l].layerIndex);
+        weights[l] = desc && desc->size > 0 ? desc->size : 1;
+        total += weights[l];
+    }
+
+    int    layer = 0;
+    size_t done  = 0;
+    for (int s = 0; s < pass->numStages; s++) {
+        int stagesLeft              = pass->numStages - s;
+        pass->stages[s].firstLayer = layer;
+
+        /* Take layers up to this stage's share, leaving one for each later stage */
+        size_t target = total / pass->numStages * (size_t)(s + 1);
+        do {
+            done += weights[layer++];
+        } while (layer < scheduler->layerCount - (stagesLeft - 1) &&
+                 (s == pass->numStages - 1 || done + weights[layer] / 2 <= target));
+        pass->stages[s].lastLayer = layer - 1;
+    }
+}
+
+/* Free the buffers of a streaming pass */
+static void freeStreamPass(StreamPass *pass)
+{
+    for (int s = 0; s < pass->numStages; s++) {
+        free(pass->stages[s].scratch[0]);
+        free(pass->stages[s].scratch[1]);
+        for (int i = 0; i < STREAM_QUEUE_DEPTH; i++) {
+            free(pass->boundaries[s].buffers[i]);
+        }
+    }
+    free(pass->stages);
+    free(pass->boundaries);
+}
+
+/* Allocate a stage's scratch buffers and the buffers it hands to the next stage */
+static bool allocStreamBuffers(StreamPass *pass, size_t *bytes)
+{
+    TinyAIForwardScheduler *scheduler = pass->scheduler;
+
+    for (int s = 0; s < pass->numStages; s++) {
+        StreamStage *stage = &pass->stages[s];
+        bool         last  = s == pass->numStages - 1;
+
+        /* The last layer writes to the next stage's buffers or the caller's outputs */
+        size_t scratch = 0;
+        for (int l = stage->firstLayer; l <= stage->lastLayer; l++) {
+            bool direct = l == stage->lastLayer && (!last || pass->outputs);
+            if (!direct && scheduler->layers[l].outputSize > scratch) {
+                scratch = scheduler->layers[l].outputSize;
+            }
+        }
+        if (scratch > 0) {
+            stage->scratch[0] = malloc(scratch);
+            stage->scratch[1] = malloc(scratch);
+            if (!stage->scratch[0] || !stage->scratch[1]) {
+                return false;
+            }
+            *bytes += 2 * scratch;
+        }
+
+        if (!last) {
+            size_t size = scheduler->layers[stage->lastLayer].outputSize;
+            for (int i = 0; i < STREAM_QUEUE_DEPTH; i++) {
+                void *buffer                  = malloc(size > 0 ? size : 1);
+                pass->boundaries[s].buffers[i] = buffer;
+                if (!buffer) {
+                    return false;
+                }
+                pushStream(&pass->boundaries[s].empty, buffer);
+                *bytes += size;
+            }
+        }
+    }
+    return true;
+}
+
+bool tinyaiExecuteStream(TinyAIForwardScheduler *scheduler, int numStages,
+                         const void *const *inputs, void *const *outputs, size_t count)
+{
+    if (!scheduler || !inputs || numStages < 1 || scheduler->layerCount == 0) {
+        return false;
+    }
+
+    /* Pipelining needs a chain: every layer reads the output of the one before */
+    for (int l = 0; l < scheduler->layerCount; l++) {
+        if (layerDependency(scheduler, l) != l - 1) {
+            return false;
+        }
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    StreamPass pass;
+    memset(&pass, 0, sizeof(StreamPass));
+    pass.scheduler  = scheduler;
+    pass.inputs     = inputs;
+    pass.outputs    = outputs;
+    pass.count      = count;
+    pass.numStages  = numStages < scheduler->layerCount ? numStages : scheduler->layerCount;
+    pass.stages     = (StreamStage *)calloc((size_t)pass.numStages, sizeof(StreamStage));
+    pass.boundaries = (StreamBoundary *)calloc((size_t)pass.numStages, sizeof(StreamBoundary));
+
+    size_t bytes = 0;
+    if (!pass.stages || !pass.boundaries) {
+        free(pass.stages);
+        free(pass.boundaries);
+        return false;
+    }
+    assignStreamStages(&pass);
+    if (!allocStreamBuffers(&pass, &bytes)) {
+        freeStreamPass(&pass);
+        return false;
+    }
+    if (scheduler->currentMemoryUsage + bytes > scheduler->peakMemoryUsage) {
+        scheduler->peakMemoryUsage = scheduler->currentMemoryUsage + bytes;
+    }
+
+    int started = 0;
+    for (int s = 0; s < pass.numStages; s++) {
+        pass.stages[s].pass  = &pass;
+        pass.stages[s].stage = s;
+#ifdef _WIN32
+        pass.stages[s].thread =
+            (HANDLE)_beginthreadex(NULL, 0, streamStageThread, &pass.stages[s], 0, NULL);
+        bool ok = pass.stages[s].thread != NULL;
+#else
+        bool ok = pthread_create(&pass.stages[s].thread, NULL, streamStageThread,
+                                 &pass.stages[s]) == 0;
+#endif
+        if (!ok) {
+            storeIndex(&pass.failed, 1);
+            break;
+        }
+        started++;
+    }
+
+    for (int s = 0; s < started; s++) {
+#ifdef _WIN32
+        WaitForSingleObject(pass.stages[s].thread, INFINITE);
+        CloseHandle(pass.stages[s].thread);
+#else
+        pthread_join(pass.stages[s].thread, NULL);
+#endif
+    }
+
+    bool ok = !loadIndex(&pass.failed);
+    freeStreamPass(&pass);
+    return ok;
+}
@@ -10,6 +10,7 @@
 #define TINYAI_FORWARD_SCHEDULER_H
 
 #include "mmap_loader.h"
+#include "thread_pool.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -52,6 +53,18 @@ typedef struct {
     size_t               outputSize;     /* Size of output activation in bytes */
 } TinyAIExecLayer;
 
+/**
+ * Function computing one layer
+ *
+ * @param userData User data given with the function
+ * @param layerIndex Index of the layer in the model
+ * @param input Output of the layer it depends on, or the pass input for layers without one
+ * @param output Buffer of the layer's output size (NULL when the size is 0)
+ * @return true on success, false to stop the forward pass
+ */
+typedef bool (*TinyAILayerExecuteFn)(void *userData, int layerIndex, const void *input,
+                                     void *output);
+
 /**
  * Forward pass scheduler structure
  */
@@ -108,9 +121,67 @@ bool tinyaiPrepareForwardPass(TinyAIForwardScheduler *scheduler);
 bool tinyaiExecuteNextLayer(TinyAIForwardScheduler *scheduler, const void *input, void *output,
                             int *layerIndex);
 
+/**
+ * Set the function that computes each layer
+ *
+ * Without one, execution only manages weights and activation buffers.
+ *
+ * @param scheduler Scheduler to configure
+ * @param execute Layer function (NULL for none)
+ * @param userData User data passed to the function
+ * @return true on success, false on invalid arguments
+ */
+bool tinyaiSetLayerExecuteFunction(TinyAIForwardScheduler *scheduler, TinyAILayerExecuteFn execute,
+                                   void *userData);
+
+/**
+ * Execute every remaining layer, running independent layers in parallel
+ *
+ * Layers are dispatched onto the pool as soon as the layer they depend on
+ * has finished, so the branches of a multi-branch model run side by side.
+ * A layer whose output would take the scheduler over its memory limit waits
+ * until running layers finish and their unneeded outputs are freed; it only
+ * runs over the limit when nothing else is running. The layer function may
+ * be called from several threads at once.
+ *
+ * @param scheduler Scheduler prepared with tinyaiPrepareForwardPass
+ * @param pool Thread pool (NULL runs the layers one at a time on the caller)
+ * @param input Input of the layers without a dependency, or NULL
+ * @param output Buffer receiving the final layer's output, or NULL
+ * @return true if every layer ran, false on error or when a layer failed
+ */
+bool tinyaiExecuteForwardPass(TinyAIForwardScheduler *scheduler, TinyAIThreadPool *pool,
+                              const void *input, void *output);
+
+/**
+ * Stream a batch of items through the layers as a pipeline
+ *
+ * The executor behind TINYAI_EXEC_STREAMING. The layers, which must form a
+ * chain, are split into stages of contiguous layers with roughly equal
+ * weight sizes. Each stage runs on its own thread pinned to its own CPU, so
+ * only its layers' weights pass through that core's caches. Stages hand
+ * activations to the next one through bounded lock-free queues, so while
+ * one stage works on item i the stage before it works on item i + 1. The
+ * layer function is called from several threads at once, but never twice
+ * at once for the same layer.
+ *
+ * @param scheduler Scheduler whose layers each depend on the one before
+ * @param numStages Pipeline stages (clamped to the layer count)
+ * @param inputs Input of the first layer for each item
+ * @param outputs Buffers receiving the final layer's output for each item, or NULL
+ * @param count Number of items
+ * @return true if every item went through every layer, false on error
+ */
+bool tinyaiExecuteStream(TinyAIForwardScheduler *scheduler, int numStages,
+                         const void *const *inputs, void *const *outputs, size_t count);
+
 /**
  * Calculate the optimal batch size based on available memory
  *
+ * Without calibration the batch size is the most samples the memory limit
+ * leaves room for. After tinyaiCalibrateBatchSize, the measured batch size
+ * is used instead, unless the memory limit allows less.
+ *
  * @param scheduler Scheduler to calculate for
  * @param inputSize Size of a single input in bytes
  * @param outputSize Size of a single output in bytes
@@ -120,6 +191,72 @@ bool tinyaiExecuteNextLayer(TinyAIForwardScheduler *scheduler, const void *input
 int tinyaiCalculateOptimalBatchSize(TinyAIForwardScheduler *scheduler, size_t inputSize,
                                     size_t outputSize, int maxBatchSize);
 
+/**
+ * Run one batch of a calibration
+ *
+ * @param userData User data given with the function
+ * @param batchSize Number of samples in the batch
+ * @return true on success, false to stop the calibration
+ */
+typedef bool (*TinyAIBatchRunFn)(void *userData, int batchSize);
+
+/**
+ * Batch size calibration settings
+ */
+typedef struct {
+    int         maxBatchSize; /* Largest batch to try */
+    uint64_t    latencySloNs; /* Longest a batch may take, in nanoseconds (0 for no limit) */
+    size_t      inputSize;    /* Size of a single input, for the memory limit */
+    size_t      outputSize;   /* Size of a single output, for the memory limit */
+    int         iterations;   /* Timed runs per batch size (the median is used) */
+    float       kneeFraction; /* Share of the best throughput that is good enough */
+    const char *cachePath;    /* File caching results per model and host (NULL for none) */
+} TinyAIBatchCalibrationConfig;
+
+/**
+ * Batch size chosen by a calibration
+ */
+typedef struct {
+    int      batchSize;  /* Chosen batch size */
+    uint64_t latencyNs;  /* Measured time of one batch of that size */
+    double   throughput; /* Measured samples per second */
+    bool     cached;     /* Whether the result came from the cache file */
+} TinyAIBatchCalibration;
+
+/**
+ * Get the default batch size calibration settings
+ *
+ * @param config Settings to fill
+ */
+void tinyaiGetDefaultBatchCalibrationConfig(TinyAIBatchCalibrationConfig *config);
+
+/**
+ * Measure the batch size to serve with on this host
+ *
+ * Runs batches of 1, 2, 4, ... samples up to the largest the memory limit
+ * allows, timing each after one warm-up run, and stops at the first size
+ * whose median time exceeds the latency SLO. Of the sizes within the SLO it
+ * picks the knee of the throughput curve: the smallest batch reaching
+ * kneeFraction of the best throughput measured, since larger batches only
+ * add latency past that point. When even one sample misses the SLO the
+ * batch size is 1.
+ *
+ * The result is kept by the scheduler for tinyaiCalculateOptimalBatchSize.
+ * With a cache path it is also stored under a key of the model's layer
+ * sizes, the host name, processor and NUMA node counts, the SLO and the
+ * memory cap, so later runs on the same host and model skip the sweep.
+ *
+ * @param scheduler Scheduler of the model to calibrate
+ * @param config Calibration settings
+ * @param run Function running one batch of the model
+ * @param userData User data passed to run
+ * @param result Chosen batch size and its measurements
+ * @return true on success, false on invalid arguments or when a run failed
+ */
+bool tinyaiCalibrateBatchSize(TinyAIForwardScheduler             *scheduler,
+                              const TinyAIBatchCalibrationConfig *config, TinyAIBatchRunFn run,
+                              void *userData, TinyAIBatchCalibration *result);
+
 /**
  * Get the current memory usage of the scheduler
  *
@@ -169,6 +306,19 @@ void *tinyaiGetLayerOutput(const TinyAIForwardScheduler *scheduler, int layerInd
  */
 void tinyaiMarkLayerOutputUnneeded(TinyAIForwardScheduler *scheduler, int layerIndex);
 
+/**
+ * Set how many layers ahead of execution the scheduler prefetches weights
+ *
+ * In memory optimized and adaptive modes, executing a layer asks the mapped
+ * model's prefetch threads for the weights of the next layers in execution
+ * order, so their disk reads overlap the layer's compute. The default is 2.
+ *
+ * @param scheduler Scheduler to configure
+ * @param distance Number of layers to prefetch, 0 to disable
+ * @return true on success, false on invalid arguments
+ */
+bool tinyaiSetSchedulerPrefetchDistance(TinyAIForwardScheduler *scheduler, int distance);
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,12 @@
 /* Typical checkpoint overhead factor */
 #define CHECKPOINT_OVERHEAD_FACTOR 1.1f
 
+/* Alignment of every activation buffer in the arena */
+#define PLAN_ALIGNMENT 64
+
+/* Rate assumed for layers never timed, when no layer has been timed yet */
+#define ESTIMATED_BYTES_PER_NS 4
+
 /* States for topological sorting */
 typedef enum {
     TINYAI_NODE_NOT_VISITED = 0,
@@ -45,6 +51,24 @@ typedef struct {
     bool   isActive;
 } Checkpoint;
 
+/* Activation buffer with the execution positions it is live over, inclusive */
+typedef struct {
+    size_t size;
+    size_t offset;
+    int    start;
+    int    end;
+} PlannedBuffer;
+
+/* One layer execution in the plan; a recomputation rebuilds an activation dropped earlier */
+typedef struct {
+    int  layerId;
+    int  inputStep;       /* Step whose output is the input, -1 for the execution input */
+    int  lastUse;         /* Last step reading the output */
+    int  outputBuffer;    /* Planned buffer of the output, -1 for none */
+    int  workspaceBuffer; /* Planned buffer of the workspace, -1 for none */
+    bool recompute;
+} PlanStep;
+
 /* Layer execution record */
 typedef struct {
     int   layerId;
@@ -66,6 +90,11 @@ typedef struct {
     int             checkpointId;
     bool            visited;
     NodeVisitState  visitState;
+    int             outputBuffer;       /* Planned buffer of the output, -1 for none */
+    int             workspaceBuffer;    /* Planned buffer of the workspace, -1 for none */
+    int             checkpointOverride; /* Set by the user: -1 policy decides, 0 no, 1 yes */
+    bool            recompute;          /* Drop the output after its reader, recompute it later */
+    uint64_t        timeNs;             /* Last measured forward time, 0 if never run */
 } Layer;
 
 /* Layer scheduler structure */
@@ -83,9 +112,25 @@ struct TinyAILayerScheduler {
     Checkpoint checkpoints[MAX_CHECKPOINTS];
     int        numCheckpoints;
 
-    /* Memory management */
-    void  *workspace;
-    size_t workspaceSize;
+    /* Memory management: every activation lives at a planned offset in one arena */
+    void          *workspace;
+    size_t         workspaceSize;
+    uint8_t       *arena;
+    PlannedBuffer *buffers;
+    int            numBuffers;
+    size_t         arenaSize;
+    size_t         liveBound; /* Most bytes live at once, a lower bound on any packing */
+
+    /* Plan steps: the execution order plus recomputations of dropped activations */
+    PlanStep *steps;
+    int       numSteps;
+    int       stepCapacity;
+    int       currentStep; /* Step being executed, -1 outside execution */
+    size_t    keptPeak;    /* Planned peak with every activation kept */
+
+    /* Time and bytes of every timed layer, to estimate the ones never run */
+    uint64_t measuredNs;
+    uint64_t measuredBytes;
 
     /* Execution statistics */
     TinyAIExecutionStats stats;
@@ -182,6 +227,7 @@ TinyAILayerScheduler *tinyaiLayerSchedulerCreate(const TinyAILayerSchedulerConfi
     scheduler->isPrepared           = false;
     scheduler->executionRecords     = NULL;
     scheduler->numExecutionRecords  = 0;
+    scheduler->currentStep          = -1;
 
     return scheduler;
 }
@@ -222,6 +268,8 @@ void tinyaiLayerSchedulerDestroy(TinyAILayerScheduler *scheduler)
         free(scheduler->workspace);
         scheduler->workspace = NULL;
     }
+    free(scheduler->buffers);
+    free(scheduler->steps);
 
     /* Free scheduler */
     free(scheduler);
@@ -257,6 +305,11 @@ int tinyaiLayerSchedulerAddLayer(TinyAILayerScheduler *scheduler, const TinyAILa
     newLayer->checkpointId     = -1;
     newLayer->visited          = false;
     newLayer->visitState       = TINYAI_NODE_NOT_VISITED;
+    newLayer->outputBuffer       = -1;
+    newLayer->workspaceBuffer    = -1;
+    newLayer->checkpointOverride = -1;
+    newLayer->recompute          = false;
+    newLayer->timeNs             = 0;
 
     /* Increment layer count */
     scheduler->numLayers++;
@@ -428,7 +481,8 @@ static void determineCheckpoints(TinyAILayerScheduler *scheduler)
     /* Apply checkpoint policy */
     switch (scheduler->config.checkpointPolicy) {
     case TINYAI_CHECKPOINT_NONE:
-        /* No checkpoints */
+    case TINYAI_CHECKPOINT_AUTO:
+        /* No copies; the cost model keeps activations in the arena instead */
         break;
 
     case TINYAI_CHECKPOINT_ALL:
@@ -462,121 +516,438 @@ static void determineCheckpoints(TinyAILayerScheduler *scheduler)
         break;
     }
 
-    /* Override with per-layer settings */
+    /* Override with per-layer settings; under the cost model they only mark layers to keep */
+    if (scheduler->config.checkpointPolicy != TINYAI_CHECKPOINT_AUTO) {
+        for (i = 0; i < scheduler->numLayers; i++) {
+            if (scheduler->layers[i].checkpointOverride >= 0) {
+                scheduler->layers[i].shouldCheckpoint = scheduler->layers[i].checkpointOverride > 0;
+            }
+        }
+    }
+}
+
+/**
+ * Round a buffer size up to the arena alignment
+ */
+static size_t alignPlanned(size_t size)
+{
+    return (size + PLAN_ALIGNMENT - 1) & ~(size_t)(PLAN_ALIGNMENT - 1);
+}
+
+/**
+ * Add a buffer live from start to end to the plan
+ */
+static int addPlannedBuffer(TinyAILayerScheduler *scheduler, size_t size, int start, int end)
+{
+    PlannedBuffer *buffer = &scheduler->buffers[scheduler->numBuffers];
+    buffer->size          = alignPlanned(size);
+    buffer->offset        = 0;
+    buffer->start         = start;
+    buffer->end           = end;
+    return scheduler->numBuffers++;
+}
+
+/**
+ * Order buffers largest first, then by first use
+ */
+static int compareBufferSize(const void *a, const void *b)
+{
+    const PlannedBuffer *x = *(const PlannedBuffer *const *)a;
+    const PlannedBuffer *y = *(const PlannedBuffer *const *)b;
+    if (x->size != y->size) {
+        return x->size > y->size ? -1 : 1;
+    }
+    return x->start - y->start;
+}
+
+/**
+ * Append a step running a layer, which reads the output of inputStep
+ */
+static int appendStep(TinyAILayerScheduler *scheduler, int *latest, int layerId, int inputStep,
+                      bool recompute)
+{
+    if (scheduler->numSteps == scheduler->stepCapacity) {
+        int       capacity = scheduler->stepCapacity * 2;
+        PlanStep *steps = (PlanStep *)realloc(scheduler->steps, capacity * sizeof(PlanStep));
+        if (!steps) {
+            return -1;
+        }
+        scheduler->steps        = steps;
+        scheduler->stepCapacity = capacity;
+    }
+
+    PlanStep *step        = &scheduler->steps[scheduler->numSteps];
+    step->layerId         = layerId;
+    step->inputStep       = inputStep;
+    step->lastUse         = scheduler->numSteps;
+    step->outputBuffer    = -1;
+    step->workspaceBuffer = -1;
+    step->recompute       = recompute;
+    if (inputStep >= 0) {
+        scheduler->steps[inputStep].lastUse = scheduler->numSteps;
+    }
+    latest[layerId] = scheduler->numSteps;
+    return scheduler->numSteps++;
+}
+
+/**
+ * Get the step holding a layer's output for the next step, recomputing it if it was dropped
+ *
+ * A dropped activation survives only while nothing has run since its last reader;
+ * otherwise it is rebuilt from its own input, which may in turn be rebuilt.
+ */
+static int ensureOutput(TinyAILayerScheduler *scheduler, int *latest, int layerId)
+{
+    Layer *layer = &scheduler->layers[layerId];
+    int    step  = latest[layerId];
+    int    input = -1;
+
+    if (step >= 0 &&
+        (!layer->recompute || scheduler->steps[step].lastUse >= scheduler->numSteps - 1)) {
+        return step;
+    }
+    if (layer->numDependencies > 0) {
+        input = ensureOutput(scheduler, latest,
+                             layer->dependencies[layer->numDependencies - 1]);
+        if (input < 0) {
+            return -1;
+        }
+    }
+    return appendStep(scheduler, latest, layerId, input, true);
+}
+
+/**
+ * Lay out the execution order as steps, adding recomputations of dropped activations
+ *
+ * Every dependency counts as a reader of a kept activation. A dropped one is only
+ * rebuilt for the layer that takes it as input.
+ */
+static int buildPlanSteps(TinyAILayerScheduler *scheduler)
+{
+    int  count = scheduler->executionOrderLength;
+    int *latest;
+    int  i, j;
+
+    if (!scheduler->steps) {
+        scheduler->stepCapacity = count > 0 ? count : 1;
+        scheduler->steps = (PlanStep *)malloc(scheduler->stepCapacity * sizeof(PlanStep));
+        if (!scheduler->steps) {
+            scheduler->stepCapacity = 0;
+            return -1;
+        }
+    }
+    scheduler->numSteps = 0;
+
+    latest = (int *)malloc((scheduler->numLayers + 1) * sizeof(int));
+    if (!latest) {
+        return -1;
+    }
     for (i = 0; i < scheduler->numLayers; i++) {
-        if (scheduler->layers[i].checkpointId >= 0) {
-            scheduler->layers[i].shouldCheckpoint = true;
+        latest[i] = -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        int    layerId = scheduler->executionOrder[i];
+        Layer *layer   = &scheduler->layers[layerId];
+        int    input   = -1;
+
+        if (layer->numDependencies > 0) {
+            input = ensureOutput(scheduler, latest,
+                                 layer->dependencies[layer->numDependencies - 1]);
+            if (input < 0) {
+                free(latest);
+                return -1;
+            }
+        }
+        for (j = 0; j < layer->numDependencies - 1; j++) {
+            if (!scheduler->layers[layer->dependencies[j]].recompute) {
+                scheduler->steps[latest[layer->dependencies[j]]].lastUse = scheduler->numSteps;
+            }
+        }
+        if (appendStep(scheduler, latest, layerId, input, false) < 0) {
+            free(latest);
+            return -1;
+        }
+    }
+
+    free(latest);
+    return 0;
+}
+
+/**
+ * Compute the lifetime of every activation and workspace, then pack them into one arena
+ *
+ * A layer's output is live from its step to its last reader, and its workspace
+ * only while it runs. An in-place layer takes over its input's buffer when it is that
+ * buffer's last reader. Buffers are placed largest first at the lowest offset not
+ * used by a buffer live at the same time (greedy-by-size); with optimizeOverlap off
+ * every buffer gets its own space. The output of the last layer goes to the caller's
+ * buffer and is not planned.
+ */
+static int planActivationMemory(TinyAILayerScheduler *scheduler)
+{
+    PlannedBuffer **sorted, **placed;
+    int             count, i, j;
+
+    if (buildPlanSteps(scheduler) != 0) {
+        return -1;
+    }
+    count = scheduler->numSteps;
+
+    free(scheduler->buffers);
+    scheduler->buffers    = (PlannedBuffer *)malloc((2 * count + 1) * sizeof(PlannedBuffer));
+    scheduler->numBuffers = 0;
+    scheduler->arenaSize  = 0;
+    scheduler->liveBound  = 0;
+    if (!scheduler->buffers) {
+        return -1;
+    }
+
+    /* Lifetimes, in step order so in-place layers can inherit their input's buffer */
+    for (i = 0; i < count; i++) {
+        PlanStep *step  = &scheduler->steps[i];
+        Layer    *layer = &scheduler->layers[step->layerId];
+
+        if (i < count - 1 && layer->desc.outputSize > 0) {
+            int inputBuffer =
+                step->inputStep >= 0 ? scheduler->steps[step->inputStep].outputBuffer : -1;
+            if (scheduler->config.allowInPlace && layer->desc.inPlace && inputBuffer >= 0 &&
+                scheduler->buffers[inputBuffer].end == i) {
+                PlannedBuffer *buffer = &scheduler->buffers[inputBuffer];
+                size_t         size   = alignPlanned(layer->desc.outputSize);
+                buffer->size          = size > buffer->size ? size : buffer->size;
+                buffer->end           = step->lastUse;
+                step->outputBuffer    = inputBuffer;
+            }
+            else {
+                step->outputBuffer =
+                    addPlannedBuffer(scheduler, layer->desc.outputSize, i, step->lastUse);
+            }
         }
+        if (layer->desc.workspaceSize > 0) {
+            step->workspaceBuffer = addPlannedBuffer(scheduler, layer->desc.workspaceSize, i, i);
+        }
+
+        /* A layer's own buffers are those of its first run */
+        if (!step->recompute) {
+            layer->outputBuffer    = step->outputBuffer;
+            layer->workspaceBuffer = step->workspaceBuffer;
+        }
+    }
+
+    /* Bytes live at each step bound any packing from below */
+    for (i = 0; i < count; i++) {
+        size_t live = 0;
+        for (j = 0; j < scheduler->numBuffers; j++) {
+            if (scheduler->buffers[j].start <= i && i <= scheduler->buffers[j].end) {
+                live += scheduler->buffers[j].size;
+            }
+        }
+        if (live > scheduler->liveBound) {
+            scheduler->liveBound = live;
+        }
+    }
+
+    sorted = (PlannedBuffer **)malloc((scheduler->numBuffers + 1) * sizeof(PlannedBuffer *));
+    placed = (PlannedBuffer **)malloc((scheduler->numBuffers + 1) * sizeof(PlannedBuffer *));
+    if (!sorted || !placed) {
+        free(sorted);
+        free(placed);
+        return -1;
     }
+    for (i = 0; i < scheduler->numBuffers; i++) {
+        sorted[i] = &scheduler->buffers[i];
+    }
+    qsort(sorted, scheduler->numBuffers, sizeof(PlannedBuffer *), compareBufferSize);
+
+    for (i = 0; i < scheduler->numBuffers; i++) {
+        PlannedBuffer *buffer    = sorted[i];
+        int            numPlaced = 0;
+
+        if (!scheduler->config.optimizeOverlap) {
+            buffer->offset = scheduler->arenaSize;
+            scheduler->arenaSize += buffer->size;
+            continue;
+        }
+
+        /* Buffers already placed that are live at the same time, by offset */
+        for (j = 0; j < i; j++) {
+            PlannedBuffer *other = sorted[j];
+            int            k;
+            if (other->end < buffer->start || buffer->end < other->start) {
+                continue;
+            }
+            for (k = numPlaced; k > 0 && placed[k - 1]->offset > other->offset; k--) {
+                placed[k] = placed[k - 1];
+            }
+            placed[k] = other;
+            numPlaced++;
+        }
+
+        /* Lowest gap that fits */
+        buffer->offset = 0;
+        for (j = 0; j < numPlaced; j++) {
+            if (placed[j]->offset >= buffer->offset + buffer->size) {
+                break;
+            }
+            if (placed[j]->offset + placed[j]->size > buffer->offset) {
+                buffer->offset = placed[j]->offset + placed[j]->size;
+            }
+        }
+        if (buffer->offset + buffer->size > scheduler->arenaSize) {
+            scheduler->arenaSize = buffer->offset + buffer->size;
+        }
+    }
+
+    free(sorted);
+    free(placed);
+    return 0;
 }
 
 /**
- * Estimate memory requirements for execution
+ * Estimate memory requirements for execution from the activation plan
  */
 static void estimateMemoryRequirements(TinyAILayerScheduler *scheduler, size_t *peakMemory,
                                        size_t *totalMemory)
 {
-    int    i, j, layerId;
-    size_t currentMemory    = 0;
-    size_t peak             = 0;
-    size_t total            = 0;
+    size_t unshared         = 0;
     size_t checkpointMemory = 0;
-    Layer *layer;
-    bool  *outputInUse;
+    int    i;
 
     if (!scheduler || !peakMemory || !totalMemory) {
         return;
     }
 
-    /* Allocate output usage tracking array */
-    outputInUse = (bool *)calloc(scheduler->numLayers, sizeof(bool));
-    if (!outputInUse) {
-        *peakMemory  = 0;
-        *totalMemory = 0;
-        return;
+    for (i = 0; i < scheduler->numBuffers; i++) {
+        unshared += scheduler->buffers[i].size;
+    }
+    for (i = 0; i < scheduler->numLayers; i++) {
+        if (scheduler->layers[i].shouldCheckpoint) {
+            checkpointMemory +=
+                (size_t)(scheduler->layers[i].desc.outputSize * CHECKPOINT_OVERHEAD_FACTOR);
+        }
     }
 
-    /* Initialize memory counters */
-    currentMemory    = 0;
-    peak             = 0;
-    total            = 0;
-    checkpointMemory = 0;
-
-    /* Simulate execution to estimate memory usage */
-    for (i = 0; i < scheduler->executionOrderLength; i++) {
-        layerId = scheduler->executionOrder[i];
-        layer   = &scheduler->layers[layerId];
+    /* Checkpoints are copies kept beside the arena */
+    *peakMemory  = scheduler->arenaSize + checkpointMemory;
+    *totalMemory = unshared + checkpointMemory;
+}
 
-        /* Add input memory if not already counted */
-        if (!outputInUse[layerId]) {
-            currentMemory += layer->desc.inputSize;
-            total += layer->desc.inputSize;
-        }
+/**
+ * Estimate the forward time of a layer
+ *
+ * Layers that ran use their last measured time. The others are scaled by the
+ * bytes they touch, at the rate measured over timed layers or a default rate.
+ */
+static uint64_t estimateLayerTimeNs(const TinyAILayerScheduler *scheduler, const Layer *layer)
+{
+    uint64_t bytes = layer->desc.inputSize + layer->desc.outputSize + layer->desc.workspaceSize;
 
-        /* Add output memory */
-        currentMemory += layer->desc.outputSize;
-        total += layer->desc.outputSize;
+    if (layer->timeNs > 0) {
+        return layer->timeNs;
+    }
+    if (scheduler->measuredNs > 0 && scheduler->measuredBytes > 0) {
+        return (uint64_t)((double)bytes * scheduler->measuredNs / scheduler->measuredBytes) + 1;
+    }
+    return bytes / ESTIMATED_BYTES_PER_NS + 1;
+}
 
-        /* Add workspace memory */
-        currentMemory += layer->desc.workspaceSize;
+/**
+ * Estimate the time of the plan's forward and recompute steps
+ */
+static void estimatePlanTime(const TinyAILayerScheduler *scheduler, uint64_t *forwardNs,
+                             uint64_t *recomputeNs)
+{
+    int i;
 
-        /* Track peak memory */
-        if (currentMemory > peak) {
-            peak = currentMemory;
+    *forwardNs   = 0;
+    *recomputeNs = 0;
+    for (i = 0; i < scheduler->numSteps; i++) {
+        const PlanStep *step = &scheduler->steps[i];
+        uint64_t        time = estimateLayerTimeNs(scheduler, &scheduler->layers[step->layerId]);
+        if (step->recompute) {
+            *recomputeNs += time;
         }
+        else {
+            *forwardNs += time;
+        }
+    }
+}
+
+/**
+ * Choose activations to drop and recompute, cheapest recompute time per byte saved first
+ *
+ * Each round tries dropping every eligible activation still kept, re-plans, and
+ * takes the one saving the most peak bytes per nanosecond of added recompute
+ * time. A dropped activation needs no checkpoint copy either. Rounds stop once the peak fits maxMemory, or, under the minimum-memory
+ * strategy, once no drop lowers the peak any more.
+ */
+static int chooseRecomputations(TinyAILayerScheduler *scheduler)
+{
+    bool     minimize = scheduler->config.memoryStrategy == TINYAI_MEM_STRATEGY_MIN_MEMORY;
+    size_t   budget   = scheduler->config.maxMemory;
+    size_t   peak, total;
+    uint64_t forwardNs, recomputeNs;
+    int      finalLayer, i;
 
-        /* Release workspace memory */
-        currentMemory -= layer->desc.workspaceSize;
+    if (scheduler->executionOrderLength == 0) {
+        return 0;
+    }
+    finalLayer = scheduler->executionOrder[scheduler->executionOrderLength - 1];
+    estimateMemoryRequirements(scheduler, &peak, &total);
+    estimatePlanTime(scheduler, &forwardNs, &recomputeNs);
 
-        /* Add checkpoint memory if needed */
-        if (layer->shouldCheckpoint) {
-            checkpointMemory += (size_t)(layer->desc.outputSize * CHECKPOINT_OVERHEAD_FACTOR);
-        }
+    while (minimize || (budget > 0 && peak > budget)) {
+        int      best      = -1;
+        double   bestScore = 0.0;
+        size_t   bestPeak  = peak;
+        uint64_t bestNs    = recomputeNs;
 
-        /* Mark this layer's output as in use */
-        outputInUse[layerId] = true;
-
-        /* Check dependents to see if any outputs can be freed */
-        for (j = 0; j < layer->numDependents; j++) {
-            int  depId       = layer->dependents[j];
-            bool stillNeeded = false;
-            int  k;
-
-            /* Check if this output is still needed by any remaining layer */
-            for (k = i + 1; k < scheduler->executionOrderLength; k++) {
-                int    remainingLayerId = scheduler->executionOrder[k];
-                Layer *remainingLayer   = &scheduler->layers[remainingLayerId];
-                int    d;
-
-                for (d = 0; d < remainingLayer->numDependencies; d++) {
-                    if (remainingLayer->dependencies[d] == layerId) {
-                        stillNeeded = true;
-                        break;
-                    }
-                }
+        for (i = 0; i < scheduler->numLayers; i++) {
+            Layer   *layer  = &scheduler->layers[i];
+            bool     copied = layer->shouldCheckpoint;
+            size_t   candidatePeak;
+            uint64_t candidateNs;
+
+            if (!layer->desc.checkpointEligible || layer->recompute ||
+                layer->checkpointOverride > 0 || i == finalLayer || layer->outputBuffer < 0) {
+                continue;
+            }
 
-                if (stillNeeded) {
-                    break;
+            layer->recompute        = true;
+            layer->shouldCheckpoint = false;
+            if (planActivationMemory(scheduler) != 0) {
+                layer->recompute        = false;
+                layer->shouldCheckpoint = copied;
+                return -1;
+            }
+            estimateMemoryRequirements(scheduler, &candidatePeak, &total);
+            estimatePlanTime(scheduler, &forwardNs, &candidateNs);
+            layer->recompute        = false;
+            layer->shouldCheckpoint = copied;
+
+            if (candidatePeak < peak) {
+                double score =
+                    (double)(peak - candidatePeak) / (double)(candidateNs - recomputeNs + 1);
+                if (score > bestScore) {
+                    best      = i;
+                    bestScore = score;
+                    bestPeak  = candidatePeak;
+                    bestNs    = candidateNs;
                 }
             }
+        }
 
-            /* Free output memory if no longer needed */
-            if (!stillNeeded && !layer->shouldCheckpoint) {
-                currentMemory -= layer->desc.outputSize;
-            }
+        if (best < 0) {
+            break;
         }
+        scheduler->layers[best].recompute        = true;
+        scheduler->layers[best].shouldCheckpoint = false;
+        peak                                     = bestPeak;
+        recomputeNs                              = bestNs;
     }
 
-    /* Add checkpoint memory to the peak */
-    peak += checkpointMemory;
-    total += checkpointMemory;
-
-    /* Free output usage tracking array */
-    free(outputInUse);
-
-    /* Return estimates */
-    *peakMemory  = peak;
-    *totalMemory = total;
+    return planActivationMemory(scheduler);
 }
 
 /**
@@ -584,9 +955,8 @@ static void estimateMemoryRequirements(TinyAILayerScheduler *scheduler, size_t *
  */
 static int prepareExecutionRecords(TinyAILayerScheduler *scheduler)
 {
-    int    i, layerId;
-    int    recordCount = 0;
-    Layer *layer;
+    int i, layerId;
+    int recordCount = 0;
 
     if (!scheduler) {
         return -1;
@@ -598,21 +968,19 @@ static int prepareExecutionRecords(TinyAILayerScheduler *scheduler)
         scheduler->executionRecords = NULL;
     }
 
-    /* Allocate memory for execution records */
+    /* Allocate memory for execution records, one per plan step */
     scheduler->executionRecords =
-        (ExecutionRecord *)malloc(scheduler->executionOrderLength * sizeof(ExecutionRecord));
+        (ExecutionRecord *)malloc((scheduler->numSteps + 1) * sizeof(ExecutionRecord));
     if (!scheduler->executionRecords) {
         return -1;
     }
 
     /* Initialize execution records */
-    memset(scheduler->executionRecords, 0,
-           scheduler->executionOrderLength * sizeof(ExecutionRecord));
+    memset(scheduler->executionRecords, 0, scheduler->numSteps * sizeof(ExecutionRecord));
 
     /* Create execution records */
-    for (i = 0; i < scheduler->executionOrderLength; i++) {
-        layerId = scheduler->executionOrder[i];
-        layer   = &scheduler->layers[layerId];
+    for (i = 0; i < scheduler->numSteps; i++) {
+        layerId = scheduler->steps[i].layerId;
 
         /* Set layer ID */
         scheduler->executionRecords[recordCount].layerId = layerId;
@@ -637,7 +1005,7 @@ static int prepareExecutionRecords(TinyAILayerScheduler *scheduler)
 int tinyaiLayerSchedulerPrepare(TinyAILayerScheduler *scheduler)
 {
     size_t peakMemory, totalMemory;
-    int    ret;
+    int    i, ret;
 
     if (!scheduler) {
         return -1;
@@ -651,34 +1019,45 @@ int tinyaiLayerSchedulerPrepare(TinyAILayerScheduler *scheduler)
 
     /* Determine which layers should be checkpointed */
     determineCheckpoints(scheduler);
+    for (i = 0; i < scheduler->numLayers; i++) {
+        scheduler->layers[i].recompute = false;
+    }
 
-    /* Estimate memory requirements */
+    /* Plan activation offsets and estimate memory requirements from them */
+    if (planActivationMemory(scheduler) != 0) {
+        return -1;
+    }
     estimateMemoryRequirements(scheduler, &peakMemory, &totalMemory);
+    scheduler->keptPeak = peakMemory;
 
-    /* Validate memory requirements against constraints */
-    if (scheduler->config.maxMemory > 0 && peakMemory > scheduler->config.maxMemory) {
-        /* Memory requirement exceeds budget */
-        /* Try more aggressive checkpointing to reduce memory usage */
-        scheduler->config.checkpointPolicy = TINYAI_CHECKPOINT_ALL;
-        determineCheckpoints(scheduler);
-        estimateMemoryRequirements(scheduler, &peakMemory, &totalMemory);
-
-        /* Still exceeds budget? */
-        if (peakMemory > scheduler->config.maxMemory) {
+    /* Over the budget (or always, under the cost model), drop activations to recompute */
+    if (scheduler->config.checkpointPolicy == TINYAI_CHECKPOINT_AUTO ||
+        (scheduler->config.checkpointPolicy != TINYAI_CHECKPOINT_NONE &&
+         scheduler->config.maxMemory > 0 && peakMemory > scheduler->config.maxMemory)) {
+        if (chooseRecomputations(scheduler) != 0) {
             return -1;
         }
+        estimateMemoryRequirements(scheduler, &peakMemory, &totalMemory);
     }
 
-    /* Allocate workspace */
+    /* Still exceeds budget? */
+    if (scheduler->config.maxMemory > 0 && peakMemory > scheduler->config.maxMemory) {
+        return -1;
+    }
+
+    /* Allocate the activation arena, aligned for the planned offsets */
     if (scheduler->workspace) {
         free(scheduler->workspace);
     }
 
-    scheduler->workspaceSize = scheduler->config.preferredWorkspaceSize;
+    scheduler->workspaceSize = scheduler->arenaSize + PLAN_ALIGNMENT;
     scheduler->workspace     = malloc(scheduler->workspaceSize);
     if (!scheduler->workspace) {
+        scheduler->workspaceSize = 0;
         return -1;
     }
+    scheduler->arena = (uint8_t *)(((uintptr_t)scheduler->workspace + PLAN_ALIGNMENT - 1) &
+                                   ~(uintptr_t)(PLAN_ALIGNMENT - 1));
 
     /* Prepare execution records */
     ret = prepareExecutionRecords(scheduler);
@@ -743,7 +1122,7 @@ static int findOrCreateCheckpoint(TinyAILayerScheduler *scheduler, int layerId,
  * Execute a layer
  */
 static int executeLayer(TinyAILayerScheduler *scheduler, int layerId, void *inputData,
-                        void *outputData)
+                        void *outputData, bool recompute)
 {
     Layer   *layer;
     uint64_t startTime, endTime;
@@ -767,10 +1146,18 @@ static int executeLayer(TinyAILayerScheduler *scheduler, int layerId, void *inpu
     /* Execute layer */
     ret = layer->desc.forward(layer->desc.layerData, inputData, outputData, NULL);
 
-    /* Update execution time */
+    /* Update execution time, and the timings the recompute cost model uses */
     endTime = getTimeNs();
     scheduler->stats.totalExecutionTimeNs += (endTime - startTime);
     scheduler->stats.layerExecutionCount++;
+    if (recompute) {
+        scheduler->stats.numRecomputations++;
+        scheduler->stats.recomputeTimeNs += endTime - startTime;
+    }
+    layer->timeNs = endTime - startTime > 0 ? endTime - startTime : 1;
+    scheduler->measuredNs += layer->timeNs;
+    scheduler->measuredBytes +=
+        layer->desc.inputSize + layer->desc.outputSize + layer->desc.workspaceSize;
 
     return ret;
 }
@@ -819,10 +1206,11 @@ static int createCheckpoint(TinyAILayerScheduler *scheduler, int layerId, void *
 int tinyaiLayerSchedulerExecute(TinyAILayerScheduler *scheduler, void *inputData, void *outputData,
                                 void *userData)
 {
-    int    i, j, layerId, dependencyId, checkpointId;
-    Layer *layer, *dependencyLayer;
-    void  *layerInput, *layerOutput;
-    int    ret;
+    int       i, j, layerId, dependencyId, checkpointId;
+    Layer    *layer;
+    PlanStep *step, *inputStep;
+    void     *layerInput, *layerOutput;
+    int       ret;
 
     if (!scheduler || !inputData || !outputData) {
         return -1;
@@ -846,74 +1234,50 @@ int tinyaiLayerSchedulerExecute(TinyAILayerScheduler *scheduler, void *inputData
 
     /* Execute layers in order */
     for (i = 0; i < scheduler->numExecutionRecords; i++) {
-        layerId = scheduler->executionRecords[i].layerId;
+        step    = &scheduler->steps[i];
+        layerId = step->layerId;
         layer   = &scheduler->layers[layerId];
 
-        /* Determine input and output pointers */
-        if (i == 0) {
-            /* First layer uses provided input */
-            layerInput = inputData;
-        }
-        else {
-            /* Get input from previous layer or checkpoint */
-            layerInput = NULL;
-
-            /* Check dependencies */
-            for (j = 0; j < layer->numDependencies; j++) {
-                dependencyId    = layer->dependencies[j];
-                dependencyLayer = &scheduler->layers[dependencyId];
-
-                /* Check if this dependency was checkpointed */
-                checkpointId = -1;
-                for (int k = 0; k < scheduler->numCheckpoints; k++) {
-                    if (scheduler->checkpoints[k].layerId == dependencyId &&
-                        scheduler->checkpoints[k].isActive) {
-                        checkpointId = k;
-                        break;
-                    }
+        /* The input is the output (or checkpoint) of the last dependency */
+        layerInput = inputData;
+        if (layer->numDependencies > 0) {
+            dependencyId = layer->dependencies[layer->numDependencies - 1];
+            inputStep    = &scheduler->steps[step->inputStep];
+
+            /* Check if this dependency was checkpointed */
+            checkpointId = -1;
+            for (j = 0; j < scheduler->numCheckpoints; j++) {
+                if (scheduler->checkpoints[j].layerId == dependencyId &&
+                    scheduler->checkpoints[j].isActive) {
+                    checkpointId = j;
+                    break;
                 }
+            }
 
-                if (checkpointId >= 0) {
-                    /* Use checkpoint as input */
-                    layerInput = scheduler->checkpoints[checkpointId].data;
-                    scheduler->executionRecords[i].inputIsCheckpoint = true;
-                    scheduler->executionRecords[i].checkpointId      = checkpointId;
-                }
-                else {
-                    /* Need to recompute input */
-                    int depIndex = -1;
-
-                    /* Find the execution record for this dependency */
-                    for (int k = 0; k < i; k++) {
-                        if (scheduler->executionRecords[k].layerId == dependencyId) {
-                            depIndex = k;
-                            break;
-                        }
-                    }
-
-                    if (depIndex >= 0) {
-                        layerInput = scheduler->executionRecords[depIndex].output;
-                    }
-                    else {
-                        /* Dependency not found, should not happen */
-                        return -1;
-                    }
-                }
+            if (checkpointId >= 0) {
+                /* Use checkpoint as input */
+                layerInput = scheduler->checkpoints[checkpointId].data;
+                scheduler->executionRecords[i].inputIsCheckpoint = true;
+                scheduler->executionRecords[i].checkpointId      = checkpointId;
+            }
+            else if (inputStep->outputBuffer >= 0) {
+                layerInput = scheduler->arena + scheduler->buffers[inputStep->outputBuffer].offset;
+            }
+            else {
+                /* Dependency produces no output */
+                layerInput = NULL;
             }
         }
 
+        /* The last layer writes the caller's buffer, the rest their planned buffers */
         if (i == scheduler->numExecutionRecords - 1) {
-            /* Last layer uses provided output */
             layerOutput = outputData;
         }
+        else if (step->outputBuffer >= 0) {
+            layerOutput = scheduler->arena + scheduler->buffers[step->outputBuffer].offset;
+        }
         else {
-            /* Allocate output from workspace */
-            if (layer->desc.outputSize > scheduler->workspaceSize) {
-                /* Not enough workspace memory */
-                return -1;
-            }
-
-            layerOutput = scheduler->workspace;
+            layerOutput = NULL;
         }
 
         /* Record input and output */
@@ -921,13 +1285,15 @@ int tinyaiLayerSchedulerExecute(TinyAILayerScheduler *scheduler, void *inputData
         scheduler->executionRecords[i].output = layerOutput;
 
         /* Execute layer */
-        ret = executeLayer(scheduler, layerId, layerInput, layerOutput);
+        scheduler->currentStep = i;
+        ret = executeLayer(scheduler, layerId, layerInput, layerOutput, step->recompute);
+        scheduler->currentStep = -1;
         if (ret != 0) {
             return -1;
         }
 
         /* Create checkpoint if needed */
-        if (layer->shouldCheckpoint) {
+        if (layer->shouldCheckpoint && !step->recompute) {
             checkpointId = createCheckpoint(scheduler, layerId, layerOutput);
             if (checkpointId < 0) {
                 return -1;
@@ -935,9 +1301,12 @@ int tinyaiLayerSchedulerExecute(TinyAILayerScheduler *scheduler, void *inputData
         }
     }
 
-    /* Update statistics */
-    scheduler->stats.peakMemoryUsage      = 0; /* Not tracked yet */
-    scheduler->stats.totalMemoryAllocated = 0; /* Not tracked yet */
+    /* Update statistics: the arena is allocated once, checkpoints beside it */
+    scheduler->stats.peakMemoryUsage = scheduler->arenaSize;
+    for (i = 0; i < scheduler->numCheckpoints; i++) {
+        scheduler->stats.peakMemoryUsage += scheduler->checkpoints[i].size;
+    }
+    scheduler->stats.totalMemoryAllocated = scheduler->stats.peakMemoryUsage;
 
     return 0;
 }
@@ -957,8 +1326,9 @@ int tinyaiLayerSchedulerSetLayerCheckpoint(TinyAILayerScheduler *scheduler, int
         return -1;
     }
 
-    /* Set checkpoint flag */
-    scheduler->layers[layerId].shouldCheckpoint = shouldCheckpoint;
+    /* Set checkpoint flag, and keep it over the policy's choice */
+    scheduler->layers[layerId].shouldCheckpoint   = shouldCheckpoint;
+    scheduler->layers[layerId].checkpointOverride = shouldCheckpoint ? 1 : 0;
 
     /* Mark as not prepared */
     scheduler->isPrepared = false;
@@ -1063,6 +1433,63 @@ void tinyaiLayerSchedulerSetCheckpointPolicy(TinyAILayerScheduler  *scheduler,
     scheduler->isPrepared = false;
 }
 
+/**
+ * Get the planned workspace of a layer
+ */
+void *tinyaiLayerSchedulerGetWorkspace(TinyAILayerScheduler *scheduler, int layerId)
+{
+    if (!scheduler || !scheduler->isPrepared || layerId < 0 || layerId >= scheduler->numLayers) {
+        return NULL;
+    }
+
+    /* A recomputation has its own workspace, live while it runs */
+    int buffer = scheduler->layers[layerId].workspaceBuffer;
+    if (scheduler->currentStep >= 0 && scheduler->steps[scheduler->currentStep].layerId == layerId) {
+        buffer = scheduler->steps[scheduler->currentStep].workspaceBuffer;
+    }
+    return buffer >= 0 ? scheduler->arena + scheduler->buffers[buffer].offset : NULL;
+}
+
+/**
+ * Get the recomputation plan
+ */
+int tinyaiLayerSchedulerGetCheckpointPlan(TinyAILayerScheduler *scheduler,
+                                          TinyAICheckpointPlan *plan)
+{
+    size_t   peakMemory, totalMemory;
+    uint64_t forwardNs;
+    int      i;
+
+    if (!scheduler || !plan) {
+        return -1;
+    }
+
+    /* Check if scheduler is prepared */
+    if (!scheduler->isPrepared && tinyaiLayerSchedulerPrepare(scheduler) != 0) {
+        return -1;
+    }
+
+    memset(plan, 0, sizeof(*plan));
+    estimateMemoryRequirements(scheduler, &peakMemory, &totalMemory);
+    estimatePlanTime(scheduler, &forwardNs, &plan->recomputeTimeNs);
+
+    plan->peakMemory  = peakMemory;
+    plan->savedMemory = scheduler->keptPeak > peakMemory ? scheduler->keptPeak - peakMemory : 0;
+    for (i = 0; i < scheduler->numLayers; i++) {
+        if (scheduler->layers[i].recompute) {
+            plan->numRecomputed++;
+        }
+    }
+    for (i = 0; i < scheduler->numSteps; i++) {
+        if (scheduler->steps[i].recompute) {
+            plan->recomputeSteps++;
+        }
+    }
+    plan->recomputeOverhead = forwardNs > 0 ? (float)plan->recomputeTimeNs / forwardNs : 0.0f;
+
+    return 0;
+}
+
 /**
  * Dump scheduler information for debugging
  */
@@ -1080,6 +1507,8 @@ void tinyaiLayerSchedulerDump(TinyAILayerScheduler *scheduler)
     printf("  Execution Order Length: %d\n", scheduler->executionOrderLength);
     printf("  Checkpoints: %d\n", scheduler->numCheckpoints);
     printf("  Workspace Size: %zu bytes\n", scheduler->workspaceSize);
+    printf("  Activation Arena: %zu bytes in %d buffers (live bound %zu bytes)\n",
+           scheduler->arenaSize, scheduler->numBuffers, scheduler->liveBound);
     printf("  Prepared: %s\n", scheduler->isPrepared ? "Yes" : "No");
 
     /* Print configuration */
@@ -1098,6 +1527,7 @@ void tinyaiLayerSchedulerDump(TinyAILayerScheduler *scheduler)
     printf("    Total Memory Allocated: %zu bytes\n", scheduler->stats.totalMemoryAllocated);
     printf("    Checkpoints: %zu\n", scheduler->stats.numCheckpoints);
     printf("    Recomputations: %zu\n", scheduler->stats.numRecomputations);
+    printf("    Recompute Time: %lu ns\n", scheduler->stats.recomputeTimeNs);
     printf("    Layer Executions: %zu\n", scheduler->stats.layerExecutionCount);
     printf("    Total Execution Time: %lu ns\n", scheduler->stats.totalExecutionTimeNs);
 
@@ -1110,6 +1540,7 @@ void tinyaiLayerSchedulerDump(TinyAILayerScheduler *scheduler)
         printf("      Output Size: %zu bytes\n", layer->desc.outputSize);
         printf("      Workspace Size: %zu bytes\n", layer->desc.workspaceSize);
         printf("      Checkpoint: %s\n", layer->shouldCheckpoint ? "Yes" : "No");
+        printf("      Recompute: %s\n", layer->recompute ? "Yes" : "No");
 
         /* Print dependencies */
         if (layer->numDependencies > 0) {
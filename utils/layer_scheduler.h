@@ -48,7 +48,8 @@ typedef enum {
 typedef enum {
     TINYAI_CHECKPOINT_NONE,      /**< No checkpointing */
     TINYAI_CHECKPOINT_SELECTIVE, /**< Checkpoint selected layers */
-    TINYAI_CHECKPOINT_ALL        /**< Checkpoint all eligible layers */
+    TINYAI_CHECKPOINT_ALL,       /**< Checkpoint all eligible layers */
+    TINYAI_CHECKPOINT_AUTO       /**< Recompute eligible layers chosen by a cost model */
 } TinyAICheckpointPolicy;
 
 /**
@@ -85,8 +86,8 @@ typedef struct {
     TinyAICheckpointPolicy checkpointPolicy; /**< Checkpoint policy */
     size_t                 maxMemory; /**< Maximum memory budget in bytes (0 for unlimited) */
     size_t                 preferredWorkspaceSize; /**< Preferred workspace size in bytes */
-    bool                   allowInPlace;           /**< Whether to allow in-place operations */
-    bool                   optimizeOverlap; /**< Whether to optimize tensor lifetime overlap */
+    bool                   allowInPlace; /**< Let in-place layers reuse their input buffer */
+    bool                   optimizeOverlap; /**< Share memory between disjoint lifetimes */
     bool                   verbose;         /**< Whether to print verbose information */
 } TinyAILayerSchedulerConfig;
 
@@ -105,8 +106,21 @@ typedef struct {
     size_t   numRecomputations;    /**< Number of layer recomputations */
     size_t   layerExecutionCount;  /**< Total number of layer executions */
     uint64_t totalExecutionTimeNs; /**< Total execution time in nanoseconds */
+    uint64_t recomputeTimeNs;      /**< Part of the execution time spent recomputing */
 } TinyAIExecutionStats;
 
+/**
+ * @brief Activation recomputation chosen by tinyaiLayerSchedulerPrepare
+ */
+typedef struct {
+    size_t   peakMemory;        /**< Planned peak with the recomputations */
+    size_t   savedMemory;       /**< Peak bytes saved over keeping every activation */
+    int      numRecomputed;     /**< Layers whose output is dropped and recomputed */
+    int      recomputeSteps;    /**< Extra layer runs per execution */
+    uint64_t recomputeTimeNs;   /**< Estimated time of the extra runs */
+    float    recomputeOverhead; /**< Estimated recompute time over forward time */
+} TinyAICheckpointPlan;
+
 /**
  * @brief Get default scheduler configuration
  *
@@ -153,7 +167,21 @@ int tinyaiLayerSchedulerAddDependency(TinyAILayerScheduler *scheduler, int sourc
  * @brief Prepare the scheduler for execution
  *
  * This function analyzes the layer graph, determines execution order, and
- * allocates required memory.
+ * allocates required memory. Every intermediate output and workspace gets a
+ * fixed offset in one arena: lifetimes run from the producing layer to its
+ * last dependent, and buffers are packed largest first into the lowest free
+ * offset among those live at the same time. Each layer reads the output of
+ * its last dependency, or the execution input when it has none.
+ *
+ * When the peak exceeds maxMemory (or always, under TINYAI_CHECKPOINT_AUTO),
+ * outputs of checkpoint-eligible layers are dropped after their first reader
+ * and recomputed from their inputs before later readers. Drops are chosen
+ * greedily by peak bytes saved per nanosecond of recompute time, using the
+ * layer times measured by earlier executions or a size-based estimate.
+ * Under TINYAI_MEM_STRATEGY_MIN_MEMORY, AUTO keeps dropping while the peak
+ * falls; otherwise it stops once the peak fits. Layers pinned with
+ * tinyaiLayerSchedulerSetLayerCheckpoint(..., true) are never dropped. Fails
+ * if the peak cannot be brought under maxMemory.
  *
  * @param scheduler Target scheduler
  * @return 0 on success, non-zero on failure
@@ -204,13 +232,27 @@ void tinyaiLayerSchedulerReset(TinyAILayerScheduler *scheduler);
  * @brief Estimate memory requirements
  *
  * @param scheduler Target scheduler
- * @param peakMemory Pointer to store peak memory estimate
- * @param totalMemory Pointer to store total memory estimate
+ * @param peakMemory Pointer to store the planned arena size plus checkpoints
+ * @param totalMemory Pointer to store the size of all activations without sharing
  * @return 0 on success, non-zero on failure
  */
 int tinyaiLayerSchedulerEstimateMemory(TinyAILayerScheduler *scheduler, size_t *peakMemory,
                                        size_t *totalMemory);
 
+/**
+ * @brief Get the planned workspace of a layer
+ *
+ * The arena is allocated once by tinyaiLayerSchedulerPrepare, so the address
+ * stays valid for every execution until the graph changes and is re-prepared.
+ * Called from a layer's forward function while the layer is being recomputed,
+ * it returns the recomputation's workspace.
+ *
+ * @param scheduler Prepared scheduler
+ * @param layerId Layer ID
+ * @return workspaceSize bytes for the layer, or NULL if it has none
+ */
+void *tinyaiLayerSchedulerGetWorkspace(TinyAILayerScheduler *scheduler, int layerId);
+
 /**
  * @brief Set memory strategy
  *
@@ -229,6 +271,16 @@ void tinyaiLayerSchedulerSetMemoryStrategy(TinyAILayerScheduler *scheduler,
 void tinyaiLayerSchedulerSetCheckpointPolicy(TinyAILayerScheduler  *scheduler,
                                              TinyAICheckpointPolicy policy);
 
+/**
+ * @brief Get the recomputation plan
+ *
+ * @param scheduler Target scheduler, prepared if needed
+ * @param plan Pointer to plan struct to fill
+ * @return 0 on success, non-zero on failure
+ */
+int tinyaiLayerSchedulerGetCheckpointPlan(TinyAILayerScheduler *scheduler,
+                                          TinyAICheckpointPlan *plan);
+
 /**
  * @brief Dump scheduler information for debugging
  *
@@ -5,13 +5,38 @@
 #include <string.h>
 #include <time.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define HAVE_BACKTRACE 1
+#endif
+
+// Hotspots reported
+#define MAX_HOTSPOTS 10
+
+// Stack capture skips a fixed number of frames, so it must stay a frame of its own
+#if defined(_MSC_VER)
+#define NOINLINE __declspec(noinline)
+#elif defined(__GNUC__)
+#define NOINLINE __attribute__((noinline))
+#else
+#define NOINLINE
+#endif
+
 // Default configuration
 static const TinyAIMemoryAnalysisConfig DEFAULT_CONFIG = {.track_allocations   = true,
                                                           .track_deallocations = true,
                                                           .track_peak_usage    = true,
                                                           .analyze_patterns    = true,
                                                           .sample_interval_ms  = 100,
-                                                          .analysis_window_ms  = 1000};
+                                                          .analysis_window_ms  = 1000,
+                                                          .sampling_interval_bytes = 0,
+                                                          .stack_depth             = 0,
+                                                          .snapshot_prefix         = NULL,
+                                                          .snapshot_interval_ms    = 0};
+
+static int compare_allocations(const TinyAIMemoryAllocation *a, const TinyAIMemoryAllocation *b);
 
 // Get current timestamp in milliseconds
 static uint64_t get_timestamp_ms()
@@ -21,6 +46,167 @@ static uint64_t get_timestamp_ms()
     return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
 }
 
+static bool is_sampling(const TinyAIMemoryAnalysis *analysis)
+{
+    return analysis->config.sampling_interval_bytes > 0;
+}
+
+// Bytes to the next sampled allocation: exponentially distributed around the interval
+static int64_t next_sample_interval(TinyAIMemoryAnalysis *analysis)
+{
+    // xorshift64*, uniform in [0, 1)
+    uint64_t x = analysis->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    analysis->random_state = x;
+    double uniform         = ((x * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+    double interval = -log(1.0 - uniform) * (double)analysis->config.sampling_interval_bytes;
+    return (int64_t)interval + 1;
+}
+
+// Capture the caller's call stack, skipping the analysis's own frames
+static NOINLINE int capture_stack(void **stack, int depth)
+{
+    if (depth <= 0)
+        return 0;
+    if (depth > TINYAI_MEMORY_STACK_DEPTH)
+        depth = TINYAI_MEMORY_STACK_DEPTH;
+#if defined(_WIN32)
+    return (int)CaptureStackBackTrace(2, (DWORD)depth, stack, NULL);
+#elif defined(HAVE_BACKTRACE)
+    void *frames[TINYAI_MEMORY_STACK_DEPTH + 2];
+    int   count = backtrace(frames, depth + 2) - 2;
+    if (count <= 0)
+        return 0;
+    memcpy(stack, frames + 2, (size_t)count * sizeof(void *));
+    return count;
+#else
+    (void)stack;
+    return 0;
+#endif
+}
+
+// ----- Live sample index: open addressing on the address, entries hold index + 1 -----
+
+static size_t hash_address(const void *address, size_t capacity)
+{
+    uint64_t h = (uint64_t)(uintptr_t)address * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & (capacity - 1);
+}
+
+static size_t *find_live_slot(const TinyAIMemoryAnalysis *analysis, const void *address)
+{
+    if (!analysis->live_index)
+        return NULL;
+    size_t mask = analysis->live_index_capacity - 1;
+    for (size_t slot = hash_address(address, analysis->live_index_capacity);;
+         slot        = (slot + 1) & mask) {
+        size_t entry = analysis->live_index[slot];
+        if (entry == 0)
+            return NULL;
+        if (analysis->allocations[entry - 1].address == address)
+            return &analysis->live_index[slot];
+    }
+}
+
+static void insert_live(TinyAIMemoryAnalysis *analysis, size_t index)
+{
+    size_t mask = analysis->live_index_capacity - 1;
+    size_t slot = hash_address(analysis->allocations[index].address,
+                               analysis->live_index_capacity);
+    while (analysis->live_index[slot] != 0)
+        slot = (slot + 1) & mask;
+    analysis->live_index[slot] = index + 1;
+}
+
+// Keep the index at most half full
+static bool reserve_live_index(TinyAIMemoryAnalysis *analysis, size_t count)
+{
+    if (count * 2 <= analysis->live_index_capacity)
+        return true;
+
+    size_t capacity = analysis->live_index_capacity ? analysis->live_index_capacity * 2 : 256;
+    while (count * 2 > capacity)
+        capacity *= 2;
+    size_t *index = calloc(capacity, sizeof(size_t));
+    if (!index)
+        return false;
+    free(analysis->live_index);
+    analysis->live_index          = index;
+    analysis->live_index_capacity = capacity;
+    for (size_t i = 0; i < analysis->num_allocations; i++)
+        insert_live(analysis, i);
+    return true;
+}
+
+// Empty a slot, shifting back the entries that probed past it
+static void remove_live_slot(TinyAIMemoryAnalysis *analysis, size_t *entry)
+{
+    size_t mask = analysis->live_index_capacity - 1;
+    size_t hole = (size_t)(entry - analysis->live_index);
+    size_t slot = hole;
+    analysis->live_index[hole] = 0;
+    for (;;) {
+        slot = (slot + 1) & mask;
+        size_t moved = analysis->live_index[slot];
+        if (moved == 0)
+            return;
+        size_t home = hash_address(analysis->allocations[moved - 1].address,
+                                   analysis->live_index_capacity);
+        // Move the entry when its home is not between the hole and its slot
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            analysis->live_index[hole] = moved;
+            analysis->live_index[slot] = 0;
+            hole                       = slot;
+        }
+    }
+}
+
+// Add a sample's estimated bytes to the total of its call site and stack
+static void add_to_site(TinyAIMemoryAnalysis *analysis, const TinyAIMemoryAllocation *sample)
+{
+    for (size_t i = 0; i < analysis->num_sites; i++) {
+        TinyAIMemoryAllocation *site = &analysis->sites[i];
+        if (site->file == sample->file && site->line == sample->line &&
+            site->function == sample->function && site->stack_depth == sample->stack_depth &&
+            memcmp(site->stack, sample->stack, (size_t)sample->stack_depth * sizeof(void *)) == 0) {
+            site->size += (size_t)(sample->size * sample->weight);
+            site->weight += sample->weight;
+            return;
+        }
+    }
+
+    if (analysis->num_sites >= analysis->max_sites) {
+        size_t                  new_size = analysis->max_sites ? analysis->max_sites * 2 : 64;
+        TinyAIMemoryAllocation *new_sites =
+            realloc(analysis->sites, sizeof(TinyAIMemoryAllocation) * new_size);
+        if (!new_sites)
+            return;
+        analysis->sites     = new_sites;
+        analysis->max_sites = new_size;
+    }
+    TinyAIMemoryAllocation *site = &analysis->sites[analysis->num_sites++];
+    *site                        = *sample;
+    site->address                = NULL;
+    site->size                   = (size_t)(sample->size * sample->weight);
+}
+
+// Write a periodic snapshot when one is due
+static void maybe_export_snapshot(TinyAIMemoryAnalysis *analysis, uint64_t now)
+{
+    if (!analysis->config.snapshot_prefix ||
+        now - analysis->last_snapshot_time < analysis->config.snapshot_interval_ms)
+        return;
+
+    char filename[512];
+    snprintf(filename, sizeof(filename), "%s_%u.json", analysis->config.snapshot_prefix,
+             analysis->snapshot_count);
+    analysis->last_snapshot_time = now;
+    if (tinyaiExportMemorySnapshot(analysis, filename))
+        analysis->snapshot_count++;
+}
+
 // Create memory analysis context
 TinyAIMemoryAnalysis *tinyaiCreateMemoryAnalysis(const TinyAIMemoryAnalysisConfig *config)
 {
@@ -50,6 +236,18 @@ TinyAIMemoryAnalysis *tinyaiCreateMemoryAnalysis(const TinyAIMemoryAnalysisConfi
     analysis->start_time       = get_timestamp_ms();
     analysis->last_sample_time = analysis->start_time;
 
+    // Initialize sampling
+    analysis->random_state        = 0x9E3779B97F4A7C15ULL;
+    analysis->live_bytes          = 0.0;
+    analysis->live_index          = NULL;
+    analysis->live_index_capacity = 0;
+    analysis->sites               = NULL;
+    analysis->num_sites           = 0;
+    analysis->max_sites           = 0;
+    analysis->last_snapshot_time  = analysis->start_time;
+    analysis->snapshot_count      = 0;
+    analysis->bytes_until_sample  = is_sampling(analysis) ? next_sample_interval(analysis) : 0;
+
     return analysis;
 }
 
@@ -59,6 +257,8 @@ void tinyaiFreeMemoryAnalysis(TinyAIMemoryAnalysis *analysis)
     if (!analysis)
         return;
     free(analysis->allocations);
+    free(analysis->live_index);
+    free(analysis->sites);
     free(analysis);
 }
 
@@ -69,6 +269,23 @@ void tinyaiRecordAllocation(TinyAIMemoryAnalysis *analysis, void *address, size_
     if (!analysis || !analysis->config.track_allocations)
         return;
 
+    // Sampling: most allocations only count down to the next sample
+    double weight = 1.0;
+    if (is_sampling(analysis)) {
+        analysis->pattern.total_allocations++;
+        analysis->bytes_until_sample -= (int64_t)size;
+        if (analysis->bytes_until_sample > 0)
+            return;
+        analysis->bytes_until_sample = next_sample_interval(analysis);
+
+        // An allocation of size bytes is sampled with probability 1 - exp(-size / interval)
+        double interval = (double)analysis->config.sampling_interval_bytes;
+        double sampled  = 1.0 - exp(-(double)(size ? size : 1) / interval);
+        weight          = 1.0 / sampled;
+        if (!reserve_live_index(analysis, analysis->num_allocations + 1))
+            return;
+    }
+
     // Check if we need to resize the allocations array
     if (analysis->num_allocations >= analysis->max_allocations) {
         size_t                  new_size = analysis->max_allocations * 2;
@@ -89,6 +306,21 @@ void tinyaiRecordAllocation(TinyAIMemoryAnalysis *analysis, void *address, size_
     alloc->function               = function;
     alloc->timestamp              = get_timestamp_ms();
     alloc->is_freed               = false;
+    alloc->weight                 = weight;
+    alloc->stack_depth            = capture_stack(alloc->stack, analysis->config.stack_depth);
+
+    if (is_sampling(analysis)) {
+        // Usage is estimated from the live samples
+        insert_live(analysis, analysis->num_allocations - 1);
+        add_to_site(analysis, alloc);
+        analysis->live_bytes += size * weight;
+        analysis->pattern.current_usage = (size_t)analysis->live_bytes;
+        if (analysis->pattern.current_usage > analysis->pattern.peak_usage) {
+            analysis->pattern.peak_usage = analysis->pattern.current_usage;
+        }
+        maybe_export_snapshot(analysis, alloc->timestamp);
+        return;
+    }
 
     // Update pattern statistics
     analysis->pattern.total_allocations++;
@@ -104,6 +336,31 @@ void tinyaiRecordDeallocation(TinyAIMemoryAnalysis *analysis, void *address)
     if (!analysis || !analysis->config.track_deallocations)
         return;
 
+    // Sampling: drop the sample if the allocation was one; the last sample takes its place
+    if (is_sampling(analysis)) {
+        analysis->pattern.total_freed++;
+        size_t *entry = find_live_slot(analysis, address);
+        if (!entry)
+            return;
+        size_t                  index = *entry - 1;
+        TinyAIMemoryAllocation *alloc = &analysis->allocations[index];
+        analysis->live_bytes -= alloc->size * alloc->weight;
+        if (analysis->live_bytes < 0.0)
+            analysis->live_bytes = 0.0;
+        analysis->pattern.current_usage = (size_t)analysis->live_bytes;
+        remove_live_slot(analysis, entry);
+
+        size_t last = analysis->num_allocations - 1;
+        if (index != last) {
+            size_t *moved = find_live_slot(analysis, analysis->allocations[last].address);
+            analysis->allocations[index] = analysis->allocations[last];
+            if (moved)
+                *moved = index + 1;
+        }
+        analysis->num_allocations--;
+        return;
+    }
+
     // Find the allocation
     for (size_t i = 0; i < analysis->num_allocations; i++) {
         TinyAIMemoryAllocation *alloc = &analysis->allocations[i];
@@ -146,6 +403,7 @@ void tinyaiTakeMemorySample(TinyAIMemoryAnalysis *analysis)
 
         analysis->last_sample_time = current_time;
     }
+    maybe_export_snapshot(analysis, current_time);
 }
 
 // Get current memory pattern
@@ -198,7 +456,7 @@ void tinyaiGenerateMemoryReport(const TinyAIMemoryAnalysis *analysis, const char
     fprintf(file, "Total Freed: %zu\n", analysis->pattern.total_freed);
     fprintf(file, "Current Usage: %zu bytes\n", analysis->pattern.current_usage);
     fprintf(file, "Peak Usage: %zu bytes\n", analysis->pattern.peak_usage);
-    fprintf(file, "Fragmentation: %.2f%%\n", analysis->pattern.fragmentation);
+    fprintf(file, "Fragmentation: %zu%%\n", analysis->pattern.fragmentation);
     fprintf(file, "Allocation Rate: %.2f/s\n", analysis->pattern.allocation_rate);
     fprintf(file, "Deallocation Rate: %.2f/s\n", analysis->pattern.deallocation_rate);
     fprintf(file, "Average Lifetime: %.2f ms\n", analysis->pattern.average_lifetime);
@@ -258,6 +516,20 @@ void tinyaiGetAllocationHotspots(const TinyAIMemoryAnalysis *analysis,
     if (!analysis || !hotspots || !num_hotspots)
         return;
 
+    // Sampling: the call sites with the most estimated bytes
+    if (is_sampling(analysis)) {
+        TinyAIMemoryAllocation *sorted =
+            malloc(sizeof(TinyAIMemoryAllocation) * (analysis->num_sites + 1));
+        if (!sorted)
+            return;
+        memcpy(sorted, analysis->sites, sizeof(TinyAIMemoryAllocation) * analysis->num_sites);
+        qsort(sorted, analysis->num_sites, sizeof(TinyAIMemoryAllocation),
+              (int (*)(const void *, const void *))compare_allocations);
+        *num_hotspots = analysis->num_sites > MAX_HOTSPOTS ? MAX_HOTSPOTS : analysis->num_sites;
+        *hotspots     = sorted;
+        return;
+    }
+
     // Sort allocations by size
     TinyAIMemoryAllocation *sorted =
         malloc(sizeof(TinyAIMemoryAllocation) * analysis->num_allocations);
@@ -269,8 +541,9 @@ void tinyaiGetAllocationHotspots(const TinyAIMemoryAnalysis *analysis,
     qsort(sorted, analysis->num_allocations, sizeof(TinyAIMemoryAllocation),
           (int (*)(const void *, const void *))compare_allocations);
 
-    // Return top 10 hotspots
-    *num_hotspots = (analysis->num_allocations > 10) ? 10 : analysis->num_allocations;
+    // Return top hotspots
+    *num_hotspots = (analysis->num_allocations > MAX_HOTSPOTS) ? MAX_HOTSPOTS
+                                                               : analysis->num_allocations;
     *hotspots     = malloc(sizeof(TinyAIMemoryAllocation) * (*num_hotspots));
     if (*hotspots) {
         memcpy(*hotspots, sorted, sizeof(TinyAIMemoryAllocation) * (*num_hotspots));
@@ -315,6 +588,13 @@ void tinyaiResetMemoryAnalysis(TinyAIMemoryAnalysis *analysis)
     memset(&analysis->pattern, 0, sizeof(TinyAIMemoryPattern));
     analysis->start_time       = get_timestamp_ms();
     analysis->last_sample_time = analysis->start_time;
+
+    analysis->live_bytes         = 0.0;
+    analysis->num_sites          = 0;
+    analysis->last_snapshot_time = analysis->start_time;
+    analysis->bytes_until_sample = is_sampling(analysis) ? next_sample_interval(analysis) : 0;
+    if (analysis->live_index)
+        memset(analysis->live_index, 0, analysis->live_index_capacity * sizeof(size_t));
 }
 
 // Enable/disable memory analysis
@@ -332,7 +612,102 @@ void tinyaiSetMemoryAnalysisConfig(TinyAIMemoryAnalysis             *analysis,
 {
     if (!analysis || !config)
         return;
+    bool resample    = config->sampling_interval_bytes != analysis->config.sampling_interval_bytes;
     analysis->config = *config;
+    if (resample)
+        tinyaiResetMemoryAnalysis(analysis);
+}
+
+// Write a string as a JSON string literal
+static void write_json_string(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for (const char *c = text ? text : ""; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            fprintf(file, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(file, "\\u%04x", *c);
+        else
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+// Write allocation records as a JSON array; sizes and counts are estimates when sampling
+static void write_json_records(FILE *file, const TinyAIMemoryAllocation *records, size_t count,
+                               uint64_t now)
+{
+    fprintf(file, "[");
+    for (size_t i = 0; i < count; i++) {
+        const TinyAIMemoryAllocation *record = &records[i];
+        fprintf(file, "%s\n    {\"size\": %zu, \"weight\": %.2f, \"age_ms\": %llu, ",
+                i ? "," : "", record->size, record->weight,
+                (unsigned long long)(now - record->timestamp));
+        fprintf(file, "\"function\": ");
+        write_json_string(file, record->function);
+        fprintf(file, ", \"file\": ");
+        write_json_string(file, record->file);
+        fprintf(file, ", \"line\": %d, \"stack\": [", record->line);
+#if defined(HAVE_BACKTRACE)
+        char **symbols = record->stack_depth > 0
+                             ? backtrace_symbols((void *const *)record->stack, record->stack_depth)
+                             : NULL;
+#endif
+        for (int f = 0; f < record->stack_depth; f++) {
+            if (f)
+                fprintf(file, ", ");
+#if defined(HAVE_BACKTRACE)
+            if (symbols) {
+                write_json_string(file, symbols[f]);
+                continue;
+            }
+#endif
+            fprintf(file, "\"%p\"", record->stack[f]);
+        }
+#if defined(HAVE_BACKTRACE)
+        free(symbols);
+#endif
+        fprintf(file, "]}");
+    }
+    fprintf(file, "%s]", count ? "\n  " : "");
+}
+
+// Export a snapshot of the analysis as JSON
+bool tinyaiExportMemorySnapshot(const TinyAIMemoryAnalysis *analysis, const char *filename)
+{
+    if (!analysis || !filename)
+        return false;
+
+    TinyAIMemoryAllocation *hotspots = NULL, *leaks = NULL;
+    size_t                  num_hotspots = 0, num_leaks = 0;
+    tinyaiGetAllocationHotspots(analysis, &hotspots, &num_hotspots);
+    tinyaiGetMemoryLeakCandidates(analysis, &leaks, &num_leaks);
+
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        free(hotspots);
+        free(leaks);
+        return false;
+    }
+
+    uint64_t now = get_timestamp_ms();
+    fprintf(file, "{\n");
+    fprintf(file, "  \"uptime_ms\": %llu,\n", (unsigned long long)(now - analysis->start_time));
+    fprintf(file, "  \"sampling_interval_bytes\": %zu,\n",
+            analysis->config.sampling_interval_bytes);
+    fprintf(file, "  \"total_allocations\": %zu,\n", analysis->pattern.total_allocations);
+    fprintf(file, "  \"total_freed\": %zu,\n", analysis->pattern.total_freed);
+    fprintf(file, "  \"current_usage\": %zu,\n", analysis->pattern.current_usage);
+    fprintf(file, "  \"peak_usage\": %zu,\n", analysis->pattern.peak_usage);
+    fprintf(file, "  \"hotspots\": ");
+    write_json_records(file, hotspots, hotspots ? num_hotspots : 0, now);
+    fprintf(file, ",\n  \"leak_candidates\": ");
+    write_json_records(file, leaks, leaks ? num_leaks : 0, now);
+    fprintf(file, "\n}\n");
+
+    free(hotspots);
+    free(leaks);
+    return fclose(file) == 0;
 }
 
 // Comparison function for sorting allocations
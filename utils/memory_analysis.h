@@ -1,29 +1,50 @@
 #ifndef TINYAI_MEMORY_ANALYSIS_H
 #define TINYAI_MEMORY_ANALYSIS_H
 
-#include "tinyai.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+// Most return addresses kept per recorded allocation
+#define TINYAI_MEMORY_STACK_DEPTH 16
 
 // Memory analysis configuration
+//
+// With sampling_interval_bytes set, allocations are sampled the way tcmalloc
+// does it: after every allocation the bytes allocated are counted down, and
+// an allocation is recorded when the count runs out, the next count being
+// drawn from an exponential distribution of that mean (so sampling is a
+// Poisson process over allocated bytes, unbiased for any size mix). Each
+// sample carries the number of allocations it stands for, and hotspots, leak
+// candidates and usage are estimated from the samples. Unsampled allocations
+// only update counters, and frees look up a hash of the live samples, which
+// makes the analysis cheap enough to leave on in production.
 typedef struct {
-    bool   track_allocations;   // Enable allocation tracking
-    bool   track_deallocations; // Enable deallocation tracking
-    bool   track_peak_usage;    // Track peak memory usage
-    bool   analyze_patterns;    // Analyze memory usage patterns
-    size_t sample_interval_ms;  // Sampling interval in milliseconds
-    size_t analysis_window_ms;  // Analysis window in milliseconds
+    bool        track_allocations;       // Enable allocation tracking
+    bool        track_deallocations;     // Enable deallocation tracking
+    bool        track_peak_usage;        // Track peak memory usage
+    bool        analyze_patterns;        // Analyze memory usage patterns
+    size_t      sample_interval_ms;      // Sampling interval in milliseconds
+    size_t      analysis_window_ms;      // Analysis window in milliseconds
+    size_t      sampling_interval_bytes; // Mean bytes between sampled allocations (0 = all)
+    int         stack_depth;             // Return addresses captured per recorded allocation
+    const char *snapshot_prefix;         // Periodic snapshots go to <prefix>_<n>.json (NULL = off)
+    size_t      snapshot_interval_ms;    // Time between periodic snapshots
 } TinyAIMemoryAnalysisConfig;
 
 // Memory allocation record
 typedef struct {
-    void       *address;   // Allocated memory address
-    size_t      size;      // Allocation size
-    const char *file;      // Source file
-    int         line;      // Source line
-    const char *function;  // Function name
-    uint64_t    timestamp; // Allocation timestamp
-    bool        is_freed;  // Whether the allocation was freed
+    void       *address;     // Allocated memory address
+    size_t      size;        // Allocation size
+    const char *file;        // Source file
+    int         line;        // Source line
+    const char *function;    // Function name
+    uint64_t    timestamp;   // Allocation timestamp
+    bool        is_freed;    // Whether the allocation was freed
+    double      weight;      // Allocations the record stands for (1 unless sampled)
+    int         stack_depth; // Return addresses in stack
+    // Call stack of the allocation, innermost first
+    void *stack[TINYAI_MEMORY_STACK_DEPTH];
 } TinyAIMemoryAllocation;
 
 // Memory usage pattern
@@ -47,6 +68,20 @@ typedef struct {
     TinyAIMemoryPattern        pattern;
     uint64_t                   start_time;
     uint64_t                   last_sample_time;
+
+    // Sampling mode: allocations holds the live samples only
+    int64_t                 bytes_until_sample; // Countdown to the next sampled allocation
+    uint64_t                random_state;       // Draws the sampling intervals
+    double                  live_bytes;         // Estimated bytes in live allocations
+    size_t                 *live_index;         // Hash of live sample addresses: index + 1
+    size_t                  live_index_capacity;
+    TinyAIMemoryAllocation *sites; // Per call site and stack: estimated bytes as size and
+                                   // estimated allocations as weight
+    size_t                  num_sites;
+    size_t                  max_sites;
+
+    uint64_t last_snapshot_time;
+    unsigned snapshot_count;
 } TinyAIMemoryAnalysis;
 
 // Create memory analysis context
@@ -80,11 +115,13 @@ double tinyaiGetMemoryFragmentation(const TinyAIMemoryAnalysis *analysis);
 // Get memory usage trend
 double tinyaiGetMemoryUsageTrend(const TinyAIMemoryAnalysis *analysis);
 
-// Get allocation hotspots
+// Get allocation hotspots: the largest allocations, or when sampling, the call sites
+// with the most estimated bytes allocated (size) and their estimated allocations (weight)
 void tinyaiGetAllocationHotspots(const TinyAIMemoryAnalysis *analysis,
                                  TinyAIMemoryAllocation **hotspots, size_t *num_hotspots);
 
-// Get memory leak candidates
+// Get memory leak candidates: unfreed allocations, or when sampling, the live samples,
+// each standing for weight allocations
 void tinyaiGetMemoryLeakCandidates(const TinyAIMemoryAnalysis *analysis,
                                    TinyAIMemoryAllocation **leaks, size_t *num_leaks);
 
@@ -94,8 +131,12 @@ void tinyaiResetMemoryAnalysis(TinyAIMemoryAnalysis *analysis);
 // Enable/disable memory analysis
 void tinyaiEnableMemoryAnalysis(TinyAIMemoryAnalysis *analysis, bool enable);
 
-// Set memory analysis configuration
+// Set memory analysis configuration; a new sampling interval resets the analysis
 void tinyaiSetMemoryAnalysisConfig(TinyAIMemoryAnalysis             *analysis,
                                    const TinyAIMemoryAnalysisConfig *config);
 
+// Write usage, hotspots and leak candidates, with symbolized stacks where the platform
+// allows, as JSON. Taken periodically when the configuration names a snapshot prefix.
+bool tinyaiExportMemorySnapshot(const TinyAIMemoryAnalysis *analysis, const char *filename);
+
 #endif // TINYAI_MEMORY_ANALYSIS_H
\ No newline at end of file
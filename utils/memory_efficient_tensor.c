@@ -1,8 +1,21 @@
 #include "memory_efficient_tensor.h"
+#include "../core/io.h"
+#include "simd_ops.h"
+#include "thread_pool.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+// Chunk buffers of each file-backed operand of a stream operation
+#define STREAM_SLOTS 2
+
 // Get size of tensor type in bytes
 static size_t get_type_size(TinyAITensorType type)
 {
@@ -22,6 +35,85 @@ static size_t get_type_size(TinyAITensorType type)
     }
 }
 
+// Fill in the strides of a row-major layout
+static void set_row_major_strides(size_t *strides, const size_t *dims, size_t num_dims)
+{
+    size_t stride = 1;
+    for (size_t i = num_dims; i-- > 0;) {
+        strides[i] = stride;
+        stride *= dims[i];
+    }
+}
+
+// Check whether a tensor's elements are laid out row-major without gaps
+static bool has_row_major_strides(const TinyAIMemoryEfficientTensor *tensor)
+{
+    size_t stride = 1;
+    for (size_t i = tensor->shape.num_dims; i-- > 0;) {
+        if (tensor->shape.dims[i] != 1 && tensor->strides[i] != stride) {
+            return false;
+        }
+        stride *= tensor->shape.dims[i];
+    }
+    return true;
+}
+
+// Elements from a tensor's data pointer to one past the furthest element it reaches
+static size_t get_tensor_extent(const TinyAIMemoryEfficientTensor *tensor)
+{
+    size_t extent = 1;
+    for (size_t i = 0; i < tensor->shape.num_dims; i++) {
+        if (tensor->shape.dims[i] == 0) {
+            return 0;
+        }
+        extent += (tensor->shape.dims[i] - 1) * tensor->strides[i];
+    }
+    return extent;
+}
+
+// Offset in elements of the start of a run along the last dimension
+static size_t get_run_offset(const TinyAIMemoryEfficientTensor *tensor, size_t run)
+{
+    size_t offset = 0;
+    for (size_t i = tensor->shape.num_dims - 1; i-- > 0;) {
+        offset += (run % tensor->shape.dims[i]) * tensor->strides[i];
+        run /= tensor->shape.dims[i];
+    }
+    return offset;
+}
+
+// Copy the first count elements of a tensor, in row-major order, to or from a packed buffer
+static void copy_strided(const TinyAIMemoryEfficientTensor *tensor, char *buffer, size_t count,
+                         bool to_tensor)
+{
+    size_t type_size = get_type_size(tensor->type);
+    if (has_row_major_strides(tensor)) {
+        if (to_tensor) {
+            memcpy(tensor->data, buffer, count * type_size);
+        }
+        else {
+            memcpy(buffer, tensor->data, count * type_size);
+        }
+        return;
+    }
+
+    size_t cols   = tensor->shape.dims[tensor->shape.num_dims - 1];
+    size_t stride = tensor->strides[tensor->shape.num_dims - 1] * type_size;
+    for (size_t run = 0; count > 0; run++) {
+        char  *element = (char *)tensor->data + get_run_offset(tensor, run) * type_size;
+        size_t n       = count < cols ? count : cols;
+        for (size_t j = 0; j < n; j++, element += stride, buffer += type_size) {
+            if (to_tensor) {
+                memcpy(element, buffer, type_size);
+            }
+            else {
+                memcpy(buffer, element, type_size);
+            }
+        }
+        count -= n;
+    }
+}
+
 // Create a memory-efficient tensor
 TinyAIMemoryEfficientTensor *tinyaiCreateMemoryEfficientTensor(const TinyAITensorShape *shape,
                                                                TinyAITensorType         type,
@@ -54,12 +146,23 @@ TinyAIMemoryEfficientTensor *tinyaiCreateMemoryEfficientTensor(const TinyAITenso
     tensor->shape.num_dims   = shape->num_dims;
     tensor->shape.total_size = shape->total_size;
 
+    tensor->strides = malloc(shape->num_dims * sizeof(size_t));
+    if (!tensor->strides) {
+        free(tensor->shape.dims);
+        free(tensor);
+        return NULL;
+    }
+    set_row_major_strides(tensor->strides, shape->dims, shape->num_dims);
+
     // Initialize other fields
     tensor->type          = type;
     tensor->strategy      = strategy;
     tensor->is_contiguous = true;
+    tensor->is_view       = false;
     tensor->memory_pool   = NULL;
     tensor->pool_size     = 0;
+    tensor->file_path     = NULL;
+    tensor->file_offset   = 0;
 
     // Allocate memory based on strategy
     size_t total_bytes   = shape->total_size * type_size;
@@ -69,6 +172,7 @@ TinyAIMemoryEfficientTensor *tinyaiCreateMemoryEfficientTensor(const TinyAITenso
     case TINYAI_MEMORY_STATIC:
         tensor->data = malloc(total_bytes);
         if (!tensor->data) {
+            free(tensor->strides);
             free(tensor->shape.dims);
             free(tensor);
             return NULL;
@@ -78,6 +182,7 @@ TinyAIMemoryEfficientTensor *tinyaiCreateMemoryEfficientTensor(const TinyAITenso
     case TINYAI_MEMORY_POOLED:
         tensor->memory_pool = malloc(total_bytes);
         if (!tensor->memory_pool) {
+            free(tensor->strides);
             free(tensor->shape.dims);
             free(tensor);
             return NULL;
@@ -92,6 +197,7 @@ TinyAIMemoryEfficientTensor *tinyaiCreateMemoryEfficientTensor(const TinyAITenso
         break;
 
     default:
+        free(tensor->strides);
         free(tensor->shape.dims);
         free(tensor);
         return NULL;
@@ -110,6 +216,14 @@ void tinyaiFreeMemoryEfficientTensor(TinyAIMemoryEfficientTensor *tensor)
     if (tensor->shape.dims) {
         free(tensor->shape.dims);
     }
+    free(tensor->strides);
+    free(tensor->file_path);
+
+    // Views share the data of another tensor
+    if (tensor->is_view) {
+        free(tensor);
+        return;
+    }
 
     switch (tensor->strategy) {
     case TINYAI_MEMORY_STATIC:
@@ -134,167 +248,224 @@ void tinyaiFreeMemoryEfficientTensor(TinyAIMemoryEfficientTensor *tensor)
     free(tensor);
 }
 
-// Perform in-place tensor addition
-bool tinyaiTensorAddInPlace(TinyAIMemoryEfficientTensor       *dest,
-                            const TinyAIMemoryEfficientTensor *src)
+// Create a view of part of a tensor's data
+TinyAIMemoryEfficientTensor *tinyaiCreateTensorView(const TinyAIMemoryEfficientTensor *tensor,
+                                                    size_t offset, const TinyAITensorShape *shape,
+                                                    const size_t *strides)
 {
-    if (!dest || !src || dest->type != src->type ||
-        dest->shape.total_size != src->shape.total_size) {
-        return false;
+    if (!tensor || !tensor->data || !shape || !shape->dims || shape->num_dims == 0) {
+        return NULL;
     }
 
-    size_t type_size   = get_type_size(dest->type);
-    size_t total_bytes = dest->shape.total_size * type_size;
+    TinyAIMemoryEfficientTensor *view = calloc(1, sizeof(TinyAIMemoryEfficientTensor));
+    if (!view) {
+        return NULL;
+    }
+    view->shape.dims = malloc(shape->num_dims * sizeof(size_t));
+    view->strides    = malloc(shape->num_dims * sizeof(size_t));
+    if (!view->shape.dims || !view->strides) {
+        tinyaiFreeMemoryEfficientTensor(view);
+        return NULL;
+    }
 
-    // Ensure tensors are contiguous
-    if (!dest->is_contiguous) {
-        if (!tinyaiMakeTensorContiguous(dest)) {
-            return false;
-        }
+    memcpy(view->shape.dims, shape->dims, shape->num_dims * sizeof(size_t));
+    view->shape.num_dims   = shape->num_dims;
+    view->shape.total_size = 1;
+    for (size_t i = 0; i < shape->num_dims; i++) {
+        view->shape.total_size *= shape->dims[i];
+    }
+    if (strides) {
+        memcpy(view->strides, strides, shape->num_dims * sizeof(size_t));
+    }
+    else {
+        set_row_major_strides(view->strides, shape->dims, shape->num_dims);
     }
 
-    if (!src->is_contiguous) {
-        TinyAIMemoryEfficientTensor *temp =
-            tinyaiCreateMemoryEfficientTensor(&src->shape, src->type, TINYAI_MEMORY_STATIC);
-        if (!temp) {
-            return false;
-        }
-        memcpy(temp->data, src->data, total_bytes);
-        tinyaiMakeTensorContiguous(temp);
-
-        // Perform addition
-        for (size_t i = 0; i < dest->shape.total_size; i++) {
-            switch (dest->type) {
-            case TINYAI_TENSOR_FLOAT32:
-                ((float *)dest->data)[i] += ((float *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_FLOAT16:
-                ((uint16_t *)dest->data)[i] += ((uint16_t *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_INT8:
-                ((int8_t *)dest->data)[i] += ((int8_t *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_INT16:
-                ((int16_t *)dest->data)[i] += ((int16_t *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_INT32:
-                ((int32_t *)dest->data)[i] += ((int32_t *)temp->data)[i];
-                break;
-            }
-        }
+    view->is_view  = true;
+    view->type     = tensor->type;
+    view->strategy = TINYAI_MEMORY_STATIC;
+    view->data     = (char *)tensor->data + offset * get_type_size(tensor->type);
 
-        tinyaiFreeMemoryEfficientTensor(temp);
+    // The view must stay within the elements the tensor reaches
+    size_t extent = get_tensor_extent(view);
+    if (extent > 0 && offset + extent > get_tensor_extent(tensor)) {
+        tinyaiFreeMemoryEfficientTensor(view);
+        return NULL;
     }
-    else {
-        // Perform addition directly
-        for (size_t i = 0; i < dest->shape.total_size; i++) {
-            switch (dest->type) {
-            case TINYAI_TENSOR_FLOAT32:
-                ((float *)dest->data)[i] += ((float *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_FLOAT16:
-                ((uint16_t *)dest->data)[i] += ((uint16_t *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_INT8:
-                ((int8_t *)dest->data)[i] += ((int8_t *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_INT16:
-                ((int16_t *)dest->data)[i] += ((int16_t *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_INT32:
-                ((int32_t *)dest->data)[i] += ((int32_t *)src->data)[i];
-                break;
-            }
-        }
+    view->is_contiguous = has_row_major_strides(view);
+
+    return view;
+}
+
+// Create a view of a range of indices along one dimension
+TinyAIMemoryEfficientTensor *tinyaiSliceTensor(const TinyAIMemoryEfficientTensor *tensor,
+                                               size_t dim, size_t start, size_t length)
+{
+    if (!tensor || dim >= tensor->shape.num_dims || start > tensor->shape.dims[dim] ||
+        length > tensor->shape.dims[dim] - start) {
+        return NULL;
     }
 
-    return true;
+    size_t *dims = malloc(tensor->shape.num_dims * sizeof(size_t));
+    if (!dims) {
+        return NULL;
+    }
+    memcpy(dims, tensor->shape.dims, tensor->shape.num_dims * sizeof(size_t));
+    dims[dim] = length;
+
+    TinyAITensorShape            shape = {dims, tensor->shape.num_dims, 0};
+    TinyAIMemoryEfficientTensor *view =
+        tinyaiCreateTensorView(tensor, start * tensor->strides[dim], &shape, tensor->strides);
+    free(dims);
+    return view;
 }
 
-// Perform in-place tensor multiplication
-bool tinyaiTensorMulInPlace(TinyAIMemoryEfficientTensor       *dest,
-                            const TinyAIMemoryEfficientTensor *src)
+// Create a view of a contiguous tensor with another shape
+TinyAIMemoryEfficientTensor *tinyaiReshapeTensor(const TinyAIMemoryEfficientTensor *tensor,
+                                                 const TinyAITensorShape           *shape)
 {
-    if (!dest || !src || dest->type != src->type ||
-        dest->shape.total_size != src->shape.total_size) {
-        return false;
+    if (!tensor || !shape || !shape->dims || !has_row_major_strides(tensor)) {
+        return NULL;
     }
 
-    // Ensure tensors are contiguous
-    if (!dest->is_contiguous) {
-        if (!tinyaiMakeTensorContiguous(dest)) {
-            return false;
+    size_t total_size = 1;
+    for (size_t i = 0; i < shape->num_dims; i++) {
+        total_size *= shape->dims[i];
+    }
+    if (total_size != tensor->shape.total_size) {
+        return NULL;
+    }
+
+    return tinyaiCreateTensorView(tensor, 0, shape, NULL);
+}
+
+// Create a view with the dimensions reordered
+TinyAIMemoryEfficientTensor *tinyaiPermuteTensor(const TinyAIMemoryEfficientTensor *tensor,
+                                                 const size_t                      *order)
+{
+    if (!tensor || !order) {
+        return NULL;
+    }
+
+    size_t  num_dims = tensor->shape.num_dims;
+    size_t *dims     = malloc(2 * num_dims * sizeof(size_t));
+    if (!dims) {
+        return NULL;
+    }
+
+    // Each dimension must appear exactly once
+    size_t *strides = dims + num_dims;
+    size_t  seen    = 0;
+    for (size_t i = 0; i < num_dims; i++) {
+        if (order[i] >= num_dims || order[i] >= 8 * sizeof(seen) || (seen >> order[i]) & 1) {
+            free(dims);
+            return NULL;
         }
+        seen |= (size_t)1 << order[i];
+        dims[i]    = tensor->shape.dims[order[i]];
+        strides[i] = tensor->strides[order[i]];
     }
 
-    if (!src->is_contiguous) {
-        TinyAIMemoryEfficientTensor *temp =
-            tinyaiCreateMemoryEfficientTensor(&src->shape, src->type, TINYAI_MEMORY_STATIC);
-        if (!temp) {
-            return false;
+    TinyAITensorShape            shape = {dims, num_dims, 0};
+    TinyAIMemoryEfficientTensor *view  = tinyaiCreateTensorView(tensor, 0, &shape, strides);
+    free(dims);
+    return view;
+}
+
+// Apply dest[i] += src[i] or dest[i] *= src[i] to n elements a stride apart
+static void binary_run(TinyAITensorType type, char *dest, size_t dest_stride, const char *src,
+                       size_t src_stride, size_t n, bool multiply)
+{
+    // Float runs contiguous in both tensors go to the SIMD kernels
+    if (type == TINYAI_TENSOR_FLOAT32 && dest_stride == 1 && src_stride == 1 && n <= INT32_MAX) {
+        if (multiply) {
+            TinyAIElementwiseOp op = {TINYAI_SIMD_EW_MULTIPLY, 0, (const float *)src, NULL, 0, 0};
+            tinyaiSimdElementwise((float *)dest, (const float *)dest, 1, (int)n, &op, 1);
         }
-        memcpy(temp->data, src->data, src->shape.total_size * get_type_size(src->type));
-        tinyaiMakeTensorContiguous(temp);
-
-        // Perform multiplication
-        for (size_t i = 0; i < dest->shape.total_size; i++) {
-            switch (dest->type) {
-            case TINYAI_TENSOR_FLOAT32:
-                ((float *)dest->data)[i] *= ((float *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_FLOAT16:
-                ((uint16_t *)dest->data)[i] *= ((uint16_t *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_INT8:
-                ((int8_t *)dest->data)[i] *= ((int8_t *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_INT16:
-                ((int16_t *)dest->data)[i] *= ((int16_t *)temp->data)[i];
-                break;
-            case TINYAI_TENSOR_INT32:
-                ((int32_t *)dest->data)[i] *= ((int32_t *)temp->data)[i];
-                break;
-            }
+        else {
+            tinyaiSimdVecAdd((float *)dest, (const float *)dest, (const float *)src, (int)n);
         }
+        return;
+    }
 
-        tinyaiFreeMemoryEfficientTensor(temp);
+#define BINARY_RUN(T)                                                                              \
+    for (size_t i = 0; i < n; i++) {                                                               \
+        T       *d = (T *)dest + i * dest_stride;                                                  \
+        const T *s = (const T *)src + i * src_stride;                                              \
+        *d         = multiply ? (T)(*d * *s) : (T)(*d + *s);                                       \
     }
-    else {
-        // Perform multiplication directly
-        for (size_t i = 0; i < dest->shape.total_size; i++) {
-            switch (dest->type) {
-            case TINYAI_TENSOR_FLOAT32:
-                ((float *)dest->data)[i] *= ((float *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_FLOAT16:
-                ((uint16_t *)dest->data)[i] *= ((uint16_t *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_INT8:
-                ((int8_t *)dest->data)[i] *= ((int8_t *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_INT16:
-                ((int16_t *)dest->data)[i] *= ((int16_t *)src->data)[i];
-                break;
-            case TINYAI_TENSOR_INT32:
-                ((int32_t *)dest->data)[i] *= ((int32_t *)src->data)[i];
-                break;
-            }
-        }
+    switch (type) {
+    case TINYAI_TENSOR_FLOAT32:
+        BINARY_RUN(float)
+        break;
+    case TINYAI_TENSOR_FLOAT16:
+        BINARY_RUN(uint16_t)
+        break;
+    case TINYAI_TENSOR_INT8:
+        BINARY_RUN(int8_t)
+        break;
+    case TINYAI_TENSOR_INT16:
+        BINARY_RUN(int16_t)
+        break;
+    case TINYAI_TENSOR_INT32:
+        BINARY_RUN(int32_t)
+        break;
     }
-
-    return true;
+#undef BINARY_RUN
 }
 
-// Perform streaming tensor operation
-bool tinyaiTensorStreamOperation(TinyAIMemoryEfficientTensor       *dest,
-                                 const TinyAIMemoryEfficientTensor *src,
-                                 void (*operation)(void *, const void *, size_t), size_t chunk_size)
+// Apply an elementwise binary operation in place, run by run along the last dimension
+static bool binary_in_place(TinyAIMemoryEfficientTensor       *dest,
+                            const TinyAIMemoryEfficientTensor *src, bool multiply)
 {
-    if (!dest || !src || !operation || chunk_size == 0 || dest->type != src->type ||
+    if (!dest || !src || !dest->data || !src->data || dest->type != src->type ||
         dest->shape.total_size != src->shape.total_size) {
         return false;
     }
 
+    size_t type_size = get_type_size(dest->type);
+    if (has_row_major_strides(dest) && has_row_major_strides(src)) {
+        binary_run(dest->type, dest->data, 1, src->data, 1, dest->shape.total_size, multiply);
+        return true;
+    }
+
+    // Strided views are walked together, so their shapes must match
+    if (dest->shape.num_dims != src->shape.num_dims ||
+        memcmp(dest->shape.dims, src->shape.dims, dest->shape.num_dims * sizeof(size_t)) != 0) {
+        return false;
+    }
+
+    size_t last = dest->shape.num_dims - 1;
+    size_t cols = dest->shape.dims[last];
+    size_t runs = cols ? dest->shape.total_size / cols : 0;
+    for (size_t run = 0; run < runs; run++) {
+        binary_run(dest->type, (char *)dest->data + get_run_offset(dest, run) * type_size,
+                   dest->strides[last],
+                   (const char *)src->data + get_run_offset(src, run) * type_size,
+                   src->strides[last], cols, multiply);
+    }
+    return true;
+}
+
+// Perform in-place tensor addition
+bool tinyaiTensorAddInPlace(TinyAIMemoryEfficientTensor       *dest,
+                            const TinyAIMemoryEfficientTensor *src)
+{
+    return binary_in_place(dest, src, false);
+}
+
+// Perform in-place tensor multiplication
+bool tinyaiTensorMulInPlace(TinyAIMemoryEfficientTensor       *dest,
+                            const TinyAIMemoryEfficientTensor *src)
+{
+    return binary_in_place(dest, src, true);
+}
+
+// Operate on tensors in memory chunk by chunk, in order
+static bool stream_in_memory(TinyAIMemoryEfficientTensor       *dest,
+                             const TinyAIMemoryEfficientTensor *src,
+                             void (*operation)(void *, const void *, size_t), size_t chunk_size)
+{
     size_t type_size   = get_type_size(dest->type);
     size_t total_bytes = dest->shape.total_size * type_size;
     size_t chunk_bytes = chunk_size * type_size;
@@ -329,6 +500,377 @@ bool tinyaiTensorStreamOperation(TinyAIMemoryEfficientTensor       *dest,
     return true;
 }
 
+
+// Backing file or data of one operand of a stream operation
+typedef struct {
+    TinyAIFile *file;                  // Backing file, or NULL for a tensor in memory
+    uint64_t    offset;                // Byte offset of the first element in the file
+    char       *data;                  // Data of a tensor in memory
+    char       *buffers[STREAM_SLOTS]; // Chunk buffers of a file-backed tensor
+} StreamOperand;
+
+// Chunks passed between the I/O thread and the operating thread
+typedef struct {
+    StreamOperand dest;
+    StreamOperand src;
+    void (*operation)(void *, const void *, size_t);
+    bool   elementwise;
+    size_t type_size;
+    size_t total_bytes;
+    size_t chunk_bytes;
+    size_t num_chunks;
+    size_t loaded;   // Chunks read into their slot
+    size_t operated; // Chunks operated on
+    bool   failed;
+#ifdef _WIN32
+    CRITICAL_SECTION   lock;
+    CONDITION_VARIABLE changed;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;
+#endif
+} StreamPipeline;
+
+// Range of elements of one chunk, for the thread pool
+typedef struct {
+    void (*operation)(void *, const void *, size_t);
+    char       *dest;
+    const char *src;
+    size_t      type_size;
+    size_t      chunk_size; // Elements per call of the operation
+} StreamSlice;
+
+static void lock_pipeline(StreamPipeline *pipeline)
+{
+#ifdef _WIN32
+    EnterCriticalSection(&pipeline->lock);
+#else
+    pthread_mutex_lock(&pipeline->lock);
+#endif
+}
+
+static void unlock_pipeline(StreamPipeline *pipeline)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(&pipeline->lock);
+#else
+    pthread_mutex_unlock(&pipeline->lock);
+#endif
+}
+
+static void wait_pipeline(StreamPipeline *pipeline)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&pipeline->changed, &pipeline->lock, INFINITE);
+#else
+    pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+#endif
+}
+
+static void signal_pipeline(StreamPipeline *pipeline)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(&pipeline->changed);
+#else
+    pthread_cond_broadcast(&pipeline->changed);
+#endif
+}
+
+// Apply the operation to elements [begin, end) of a slice, at most chunk_size at a time
+static void stream_slice_task(void *context, size_t begin, size_t end)
+{
+    const StreamSlice *slice = (const StreamSlice *)context;
+    for (size_t i = begin; i < end; i += slice->chunk_size) {
+        size_t count = end - i < slice->chunk_size ? end - i : slice->chunk_size;
+        slice->operation(slice->dest + i * slice->type_size, slice->src + i * slice->type_size,
+                         count);
+    }
+}
+
+// Apply an operation to count elements, split over the thread pool if it is elementwise
+static void stream_apply(void (*operation)(void *, const void *, size_t), bool elementwise,
+                         void *dest, const void *src, size_t count, size_t type_size,
+                         size_t chunk_size)
+{
+    if (!elementwise) {
+        operation(dest, src, count);
+        return;
+    }
+
+    StreamSlice       slice = {operation, (char *)dest, (const char *)src, type_size, chunk_size};
+    TinyAIThreadPool *pool  = tinyaiGetThreadPool();
+    size_t            grain = tinyaiThreadPoolGrain(pool, 1, 1);
+    tinyaiParallelFor(pool, count, grain, stream_slice_task, &slice);
+}
+
+// Chunk of an operand as the operation sees it
+static char *stream_chunk(const StreamOperand *operand, const StreamPipeline *pipeline,
+                          size_t chunk)
+{
+    return operand->file ? operand->buffers[chunk % STREAM_SLOTS]
+                         : operand->data + chunk * pipeline->chunk_bytes;
+}
+
+// Bytes in a chunk; the last one may be short
+static size_t stream_chunk_bytes(const StreamPipeline *pipeline, size_t chunk)
+{
+    size_t offset = chunk * pipeline->chunk_bytes;
+    return pipeline->total_bytes - offset < pipeline->chunk_bytes ? pipeline->total_bytes - offset
+                                                                  : pipeline->chunk_bytes;
+}
+
+// Read or write one chunk of a file-backed operand
+static bool stream_transfer(StreamOperand *operand, const StreamPipeline *pipeline, size_t chunk,
+                            bool write)
+{
+    if (!operand->file) {
+        return true;
+    }
+
+    size_t  bytes  = stream_chunk_bytes(pipeline, chunk);
+    char   *buffer = operand->buffers[chunk % STREAM_SLOTS];
+    int64_t offset = (int64_t)(operand->offset + chunk * pipeline->chunk_bytes);
+    if (tinyaiSeekFile(operand->file, offset, 0) < 0) {
+        return false;
+    }
+    int64_t done = write ? tinyaiWriteFile(operand->file, buffer, bytes)
+                         : tinyaiReadFile(operand->file, buffer, bytes);
+    return done == (int64_t)bytes;
+}
+
+// I/O thread: write each operated chunk back and read the chunk after the next one into its slot
+#ifdef _WIN32
+static unsigned __stdcall stream_io_thread(void *param)
+{
+#else
+static void *stream_io_thread(void *param)
+{
+#endif
+    StreamPipeline *pipeline = (StreamPipeline *)param;
+    bool            ok       = true;
+
+    for (size_t chunk = 0; ok && chunk <= pipeline->num_chunks + STREAM_SLOTS - 1; chunk++) {
+        // Wait until the chunk that last used this slot has been operated on
+        lock_pipeline(pipeline);
+        while (!pipeline->failed && pipeline->operated + STREAM_SLOTS <= chunk) {
+            wait_pipeline(pipeline);
+        }
+        ok = !pipeline->failed;
+        unlock_pipeline(pipeline);
+
+        if (ok && chunk >= STREAM_SLOTS && chunk - STREAM_SLOTS < pipeline->num_chunks) {
+            ok = stream_transfer(&pipeline->dest, pipeline, chunk - STREAM_SLOTS, true);
+        }
+        if (ok && chunk < pipeline->num_chunks) {
+            ok = stream_transfer(&pipeline->dest, pipeline, chunk, false) &&
+                 stream_transfer(&pipeline->src, pipeline, chunk, false);
+        }
+
+        lock_pipeline(pipeline);
+        if (!ok) {
+            pipeline->failed = true;
+        }
+        else if (chunk < pipeline->num_chunks) {
+            pipeline->loaded = chunk + 1;
+        }
+        signal_pipeline(pipeline);
+        unlock_pipeline(pipeline);
+    }
+
+    if (ok && pipeline->dest.file && tinyaiFlushFile(pipeline->dest.file) != 0) {
+        lock_pipeline(pipeline);
+        pipeline->failed = true;
+        unlock_pipeline(pipeline);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+// Open the backing file and chunk buffers of an operand
+static bool open_stream_operand(StreamOperand *operand, const TinyAIMemoryEfficientTensor *tensor,
+                                size_t chunk_bytes, bool write)
+{
+    memset(operand, 0, sizeof(*operand));
+    if (!tensor->file_path) {
+        operand->data = (char *)tensor->data;
+        return true;
+    }
+
+    int mode      = TINYAI_FILE_READ | TINYAI_FILE_BINARY | (write ? TINYAI_FILE_WRITE : 0);
+    operand->file = tinyaiOpenFile(tensor->file_path, mode);
+    if (!operand->file) {
+        return false;
+    }
+    operand->offset = tensor->file_offset;
+    for (int i = 0; i < STREAM_SLOTS; i++) {
+        operand->buffers[i] = malloc(chunk_bytes);
+        if (!operand->buffers[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void close_stream_operand(StreamOperand *operand)
+{
+    if (operand->file) {
+        tinyaiCloseFile(operand->file);
+    }
+    for (int i = 0; i < STREAM_SLOTS; i++) {
+        free(operand->buffers[i]);
+    }
+}
+
+// Operate on chunks as the I/O thread delivers them
+static bool stream_from_file(TinyAIMemoryEfficientTensor       *dest,
+                             const TinyAIMemoryEfficientTensor *src,
+                             void (*operation)(void *, const void *, size_t), size_t chunk_size,
+                             bool elementwise)
+{
+    StreamPipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.operation   = operation;
+    pipeline.elementwise = elementwise;
+    pipeline.type_size   = get_type_size(dest->type);
+    pipeline.total_bytes = dest->shape.total_size * pipeline.type_size;
+    pipeline.chunk_bytes = chunk_size * pipeline.type_size;
+    pipeline.num_chunks  = (pipeline.total_bytes + pipeline.chunk_bytes - 1) / pipeline.chunk_bytes;
+
+    bool ok = open_stream_operand(&pipeline.dest, dest, pipeline.chunk_bytes, true) &&
+              open_stream_operand(&pipeline.src, src, pipeline.chunk_bytes, false);
+    if (!ok) {
+        close_stream_operand(&pipeline.dest);
+        close_stream_operand(&pipeline.src);
+        return false;
+    }
+
+#ifdef _WIN32
+    InitializeCriticalSection(&pipeline.lock);
+    InitializeConditionVariable(&pipeline.changed);
+    HANDLE io_thread = (HANDLE)_beginthreadex(NULL, 0, stream_io_thread, &pipeline, 0, NULL);
+    bool   started   = io_thread != NULL;
+#else
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.changed, NULL);
+    pthread_t io_thread;
+    bool      started = pthread_create(&io_thread, NULL, stream_io_thread, &pipeline) == 0;
+#endif
+
+    ok = started;
+    for (size_t chunk = 0; ok && chunk < pipeline.num_chunks; chunk++) {
+        lock_pipeline(&pipeline);
+        while (!pipeline.failed && pipeline.loaded <= chunk) {
+            wait_pipeline(&pipeline);
+        }
+        ok = !pipeline.failed;
+        unlock_pipeline(&pipeline);
+        if (!ok) {
+            break;
+        }
+
+        stream_apply(operation, elementwise, stream_chunk(&pipeline.dest, &pipeline, chunk),
+                     stream_chunk(&pipeline.src, &pipeline, chunk),
+                     stream_chunk_bytes(&pipeline, chunk) / pipeline.type_size,
+                     pipeline.type_size, chunk_size);
+
+        lock_pipeline(&pipeline);
+        pipeline.operated = chunk + 1;
+        signal_pipeline(&pipeline);
+        unlock_pipeline(&pipeline);
+    }
+
+#ifdef _WIN32
+    if (started) {
+        WaitForSingleObject(io_thread, INFINITE);
+        CloseHandle(io_thread);
+    }
+    DeleteCriticalSection(&pipeline.lock);
+#else
+    if (started) {
+        pthread_join(io_thread, NULL);
+    }
+    pthread_cond_destroy(&pipeline.changed);
+    pthread_mutex_destroy(&pipeline.lock);
+#endif
+
+    ok = ok && !pipeline.failed;
+    close_stream_operand(&pipeline.dest);
+    close_stream_operand(&pipeline.src);
+    return ok;
+}
+
+// Check the operands of a stream operation and pick how to run it
+static bool stream_operation(TinyAIMemoryEfficientTensor       *dest,
+                             const TinyAIMemoryEfficientTensor *src,
+                             void (*operation)(void *, const void *, size_t), size_t chunk_size,
+                             bool elementwise)
+{
+    if (!dest || !src || !operation || chunk_size == 0 || dest->type != src->type ||
+        dest->shape.total_size != src->shape.total_size || (!dest->data && !dest->file_path) ||
+        (!src->data && !src->file_path)) {
+        return false;
+    }
+
+    // Chunks of tensors in memory are taken straight from their data
+    if ((!dest->file_path && !has_row_major_strides(dest)) ||
+        (!src->file_path && !has_row_major_strides(src))) {
+        return false;
+    }
+
+    if (dest->file_path || src->file_path) {
+        return stream_from_file(dest, src, operation, chunk_size, elementwise);
+    }
+
+    if (elementwise) {
+        // Elementwise operations need no copies, and chunks may run on any thread
+        size_t type_size = get_type_size(dest->type);
+        stream_apply(operation, true, dest->data, src->data, dest->shape.total_size, type_size,
+                     chunk_size);
+        return true;
+    }
+
+    return stream_in_memory(dest, src, operation, chunk_size);
+}
+
+// Perform streaming tensor operation
+bool tinyaiTensorStreamOperation(TinyAIMemoryEfficientTensor       *dest,
+                                 const TinyAIMemoryEfficientTensor *src,
+                                 void (*operation)(void *, const void *, size_t), size_t chunk_size)
+{
+    return stream_operation(dest, src, operation, chunk_size, false);
+}
+
+// Perform an elementwise streaming tensor operation in parallel
+bool tinyaiTensorStreamOperationParallel(TinyAIMemoryEfficientTensor       *dest,
+                                         const TinyAIMemoryEfficientTensor *src,
+                                         void (*operation)(void *, const void *, size_t),
+                                         size_t chunk_size)
+{
+    return stream_operation(dest, src, operation, chunk_size, true);
+}
+
+// Back a streaming tensor with a file
+bool tinyaiSetTensorFile(TinyAIMemoryEfficientTensor *tensor, const char *path, uint64_t offset)
+{
+    if (!tensor || !path || tensor->strategy != TINYAI_MEMORY_STREAM) {
+        return false;
+    }
+
+    char *copy = malloc(strlen(path) + 1);
+    if (!copy) {
+        return false;
+    }
+    strcpy(copy, path);
+
+    free(tensor->file_path);
+    tensor->file_path   = copy;
+    tensor->file_offset = offset;
+    return true;
+}
+
 // Allocate memory from pool
 void *tinyaiTensorPoolAlloc(TinyAIMemoryEfficientTensor *tensor, size_t size)
 {
@@ -405,28 +947,36 @@ bool tinyaiOptimizeTensorMemory(TinyAIMemoryEfficientTensor *tensor)
 // Convert tensor to contiguous memory layout
 bool tinyaiMakeTensorContiguous(TinyAIMemoryEfficientTensor *tensor)
 {
-    if (!tensor || tensor->is_contiguous) {
+    if (!tensor) {
+        return true;
+    }
+
+    // Row-major elements need no copy, whatever the flag says
+    if (!tensor->data || has_row_major_strides(tensor)) {
+        tensor->is_contiguous = true;
         return true;
     }
 
     size_t type_size   = get_type_size(tensor->type);
     size_t total_bytes = tensor->shape.total_size * type_size;
 
-    // Allocate new contiguous memory
-    void *new_data = malloc(total_bytes);
+    // Gather the elements into memory of the tensor's own
+    void *new_data = malloc(total_bytes ? total_bytes : 1);
     if (!new_data) {
         return false;
     }
-
-    // Copy data to new memory
-    memcpy(new_data, tensor->data, total_bytes);
+    copy_strided(tensor, new_data, tensor->shape.total_size, false);
 
     // Update tensor
-    if (tensor->strategy == TINYAI_MEMORY_STATIC) {
+    if (tensor->strategy == TINYAI_MEMORY_STATIC && !tensor->is_view) {
         free(tensor->data);
     }
     tensor->data          = new_data;
+    tensor->strategy      = TINYAI_MEMORY_STATIC;
+    tensor->memory_usage  = total_bytes;
+    tensor->is_view       = false;
     tensor->is_contiguous = true;
+    set_row_major_strides(tensor->strides, tensor->shape.dims, tensor->shape.num_dims);
 
     return true;
 }
@@ -470,7 +1020,7 @@ TinyAITensorShape tinyaiGetTensorShape(const TinyAIMemoryEfficientTensor *tensor
 // Set tensor data
 bool tinyaiSetTensorData(TinyAIMemoryEfficientTensor *tensor, const void *data, size_t size)
 {
-    if (!tensor || !data || size == 0) {
+    if (!tensor || !tensor->data || !data || size == 0) {
         return false;
     }
 
@@ -481,14 +1031,15 @@ bool tinyaiSetTensorData(TinyAIMemoryEfficientTensor *tensor, const void *data,
         return false;
     }
 
-    // Ensure tensor is contiguous
-    if (!tensor->is_contiguous) {
-        if (!tinyaiMakeTensorContiguous(tensor)) {
-            return false;
-        }
+    if (has_row_major_strides(tensor)) {
+        memcpy(tensor->data, data, size);
+        return true;
     }
 
-    // Copy data
-    memcpy(tensor->data, data, size);
+    // Scatter whole elements over a strided view
+    if (size % type_size != 0) {
+        return false;
+    }
+    copy_strided(tensor, (char *)data, size / type_size, true);
     return true;
-}
\ No newline at end of file
+}
@@ -49,16 +49,25 @@ typedef struct {
 
 /**
  * @brief Memory-efficient tensor
+ *
+ * Element (i0, i1, ...) is at data[i0 * strides[0] + i1 * strides[1] + ...].
+ * Tensors own their data and are laid out row-major; views (see
+ * tinyaiCreateTensorView) share the data of another tensor with their own
+ * offset, shape and strides.
  */
 typedef struct {
     void                *data;          // Pointer to tensor data
     TinyAITensorType     type;          // Data type
     TinyAITensorShape    shape;         // Shape information
+    size_t              *strides;       // Elements between neighbours along each dimension
     TinyAIMemoryStrategy strategy;      // Memory allocation strategy
     size_t               memory_usage;  // Current memory usage
     bool                 is_contiguous; // Whether data is contiguous
+    bool                 is_view;       // Whether data belongs to another tensor
     void                *memory_pool;   // Memory pool for pooled strategy
     size_t               pool_size;     // Size of memory pool
+    char                *file_path;     // Backing file of a streaming tensor, or NULL
+    uint64_t             file_offset;   // Byte offset of the first element in the file
 } TinyAIMemoryEfficientTensor;
 
 /**
@@ -80,9 +89,67 @@ TinyAIMemoryEfficientTensor *tinyaiCreateMemoryEfficientTensor(const TinyAITenso
  */
 void tinyaiFreeMemoryEfficientTensor(TinyAIMemoryEfficientTensor *tensor);
 
+/**
+ * @brief Create a view of part of a tensor's data
+ *
+ * The view shares the data of tensor, so nothing is copied, and writes
+ * through either are seen by both. It must be freed with
+ * tinyaiFreeMemoryEfficientTensor before tensor is.
+ *
+ * @param tensor Tensor (or view) whose data to share
+ * @param offset Elements from the start of tensor's data to the first element of the view
+ * @param shape Shape of the view; its total_size is computed from the dims
+ * @param strides Elements between neighbours along each dimension (NULL = row-major)
+ * @return View, or NULL if it reaches outside tensor's data or on failure
+ */
+TinyAIMemoryEfficientTensor *tinyaiCreateTensorView(const TinyAIMemoryEfficientTensor *tensor,
+                                                    size_t offset, const TinyAITensorShape *shape,
+                                                    const size_t *strides);
+
+/**
+ * @brief Create a view of a range of indices along one dimension
+ *
+ * Slices out heads, sequence windows or batch items without copying.
+ *
+ * @param tensor Tensor to slice
+ * @param dim Dimension to slice
+ * @param start First index kept
+ * @param length Number of indices kept
+ * @return View, or NULL on failure
+ */
+TinyAIMemoryEfficientTensor *tinyaiSliceTensor(const TinyAIMemoryEfficientTensor *tensor,
+                                               size_t dim, size_t start, size_t length);
+
+/**
+ * @brief Create a view of a contiguous tensor with another shape
+ *
+ * @param tensor Contiguous tensor to reshape
+ * @param shape New shape, with the same number of elements
+ * @return View, or NULL if tensor is not contiguous or on failure
+ */
+TinyAIMemoryEfficientTensor *tinyaiReshapeTensor(const TinyAIMemoryEfficientTensor *tensor,
+                                                 const TinyAITensorShape           *shape);
+
+/**
+ * @brief Create a view with the dimensions reordered
+ *
+ * Dimension i of the view is dimension order[i] of tensor, so
+ * [seq, heads, head_dim] viewed with order {1, 0, 2} is [heads, seq, head_dim].
+ *
+ * @param tensor Tensor to permute
+ * @param order Permutation of 0 .. num_dims - 1
+ * @return View, or NULL on failure
+ */
+TinyAIMemoryEfficientTensor *tinyaiPermuteTensor(const TinyAIMemoryEfficientTensor *tensor,
+                                                 const size_t                      *order);
+
 /**
  * @brief Perform in-place tensor addition
  *
+ * Either tensor may be a strided view, as long as both have the same shape;
+ * runs along the last dimension that are contiguous in both go to the SIMD
+ * kernels directly.
+ *
  * @param dest Destination tensor
  * @param src Source tensor
  * @return true if successful, false on failure
@@ -93,6 +160,8 @@ bool tinyaiTensorAddInPlace(TinyAIMemoryEfficientTensor       *dest,
 /**
  * @brief Perform in-place tensor multiplication
  *
+ * Takes strided views like tinyaiTensorAddInPlace.
+ *
  * @param dest Destination tensor
  * @param src Source tensor
  * @return true if successful, false on failure
@@ -100,9 +169,29 @@ bool tinyaiTensorAddInPlace(TinyAIMemoryEfficientTensor       *dest,
 bool tinyaiTensorMulInPlace(TinyAIMemoryEfficientTensor       *dest,
                             const TinyAIMemoryEfficientTensor *src);
 
+/**
+ * @brief Back a streaming tensor with a file
+ *
+ * The elements of the tensor are stored contiguously in the file from offset
+ * on, and stream operations read and write them chunk by chunk, so the tensor
+ * never has to fit in memory. A tensor whose data points into a mapped file
+ * needs no backing file: the operations run on the mapping directly.
+ *
+ * @param tensor Tensor created with TINYAI_MEMORY_STREAM
+ * @param path Path to the file, which must already hold the elements
+ * @param offset Byte offset of the first element in the file
+ * @return true if successful, false on failure
+ */
+bool tinyaiSetTensorFile(TinyAIMemoryEfficientTensor *tensor, const char *path, uint64_t offset);
+
 /**
  * @brief Perform streaming tensor operation
  *
+ * Chunks are operated on one at a time, in order. When either tensor is
+ * backed by a file, chunks are double-buffered: a separate thread writes the
+ * previous chunk back and reads the next one while the current one is
+ * operated on. Tensors in memory must be contiguous.
+ *
  * @param dest Destination tensor
  * @param src Source tensor
  * @param operation Operation to perform
@@ -114,6 +203,27 @@ bool tinyaiTensorStreamOperation(TinyAIMemoryEfficientTensor       *dest,
                                  void (*operation)(void *, const void *, size_t),
                                  size_t chunk_size);
 
+/**
+ * @brief Perform an elementwise streaming tensor operation in parallel
+ *
+ * Like tinyaiTensorStreamOperation, for operations where each destination
+ * element depends only on itself and the source element at the same index.
+ * Such operations may be applied to any split of the elements in any order,
+ * so tensors in memory are operated on in place with the chunks spread over
+ * the kernel thread pool (see thread_pool.h), and each chunk of a file-backed
+ * tensor is split over the pool once it has been read.
+ *
+ * @param dest Destination tensor
+ * @param src Source tensor
+ * @param operation Elementwise operation to perform
+ * @param chunk_size Size of chunks for streaming
+ * @return true if successful, false on failure
+ */
+bool tinyaiTensorStreamOperationParallel(TinyAIMemoryEfficientTensor       *dest,
+                                         const TinyAIMemoryEfficientTensor *src,
+                                         void (*operation)(void *, const void *, size_t),
+                                         size_t chunk_size);
+
 /**
  * @brief Allocate memory from pool
  *
@@ -150,6 +260,9 @@ bool tinyaiOptimizeTensorMemory(TinyAIMemoryEfficientTensor *tensor);
 /**
  * @brief Convert tensor to contiguous memory layout
  *
+ * Only copies when the elements are not already row-major; a view that is
+ * copied gets data of its own and stops sharing its tensor's.
+ *
  * @param tensor Tensor to convert
  * @return true if successful, false on failure
  */
@@ -183,6 +296,8 @@ TinyAITensorShape tinyaiGetTensorShape(const TinyAIMemoryEfficientTensor *tensor
 /**
  * @brief Set tensor data
  *
+ * Data is in row-major order; views scatter it to their elements.
+ *
  * @param tensor Tensor to set data for
  * @param data Data to set
  * @param size Size of data in bytes
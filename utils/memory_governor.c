@@ -0,0 +1,349 @@
+/**
+ * @file memory_governor.c
+ * @brief Implementation of memory-pressure driven eviction across TinyAI caches
+ */
+
+#include "memory_governor.h"
+#include "../core/config.h"
+#include "../core/memory.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+/* Default thresholds, as a share of the limit */
+#define GOVERNOR_MODERATE_PERCENT 75
+#define GOVERNOR_HIGH_PERCENT 85
+#define GOVERNOR_CRITICAL_PERCENT 95
+
+/* Pool pressure (used share of capacity) mapped to levels */
+#define POOL_PRESSURE_HIGH 80
+#define POOL_PRESSURE_CRITICAL 90
+
+/* Lowest level each stage runs at */
+static const TinyAIPressureLevel g_stageLevel[TINYAI_SHED_STAGE_COUNT] = {
+    TINYAI_PRESSURE_MODERATE, /* Mapped weights */
+    TINYAI_PRESSURE_MODERATE, /* Prefix caches */
+    TINYAI_PRESSURE_HIGH,     /* Key/value caches */
+    TINYAI_PRESSURE_HIGH,     /* Tokenizer caches */
+    TINYAI_PRESSURE_CRITICAL  /* Pools */
+};
+
+/* One registered shedder */
+typedef struct {
+    TinyAIShedStage stage;
+    TinyAIShedFn    shed;
+    void           *userData;
+    bool            pool; /* userData is a watched pool */
+} Shedder;
+
+struct TinyAIMemoryGovernor {
+    TinyAIMemoryGovernorConfig config;
+    Shedder                    shedders[TINYAI_GOVERNOR_MAX_SHEDDERS];
+    int                        numShedders;
+#ifdef _WIN32
+    volatile LONG poolPressure; /* Highest pool pressure since the last poll */
+#else
+    uint32_t poolPressure;
+#endif
+    TinyAIMemoryGovernorStats stats;
+};
+
+size_t tinyaiGetResidentMemory(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    /* statm holds the total and resident sizes in pages */
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long pages = 0, resident = 0;
+    int           read  = fscanf(file, "%lu %lu", &pages, &resident);
+    fclose(file);
+    return read == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+/* Physical memory of the machine, or 0 when unknown */
+static size_t physicalMemory(void)
+{
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? (size_t)status.ullTotalPhys : 0;
+#elif defined(_SC_PHYS_PAGES)
+    long pages    = sysconf(_SC_PHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pages > 0 && pageSize > 0 ? (size_t)pages * (size_t)pageSize : 0;
+#else
+    return 0;
+#endif
+}
+
+void tinyaiMemoryGovernorGetDefaultConfig(TinyAIMemoryGovernorConfig *config)
+{
+    if (!config) {
+        return;
+    }
+
+    int limitMb = tinyaiConfigGetInt("system.memory_limit_mb", 0);
+
+    config->memoryLimit     = limitMb > 0 ? (size_t)limitMb << 20 : physicalMemory();
+    config->moderatePercent = GOVERNOR_MODERATE_PERCENT;
+    config->highPercent     = GOVERNOR_HIGH_PERCENT;
+    config->criticalPercent = GOVERNOR_CRITICAL_PERCENT;
+}
+
+TinyAIMemoryGovernor *tinyaiCreateMemoryGovernor(const TinyAIMemoryGovernorConfig *config)
+{
+    TinyAIMemoryGovernor *governor = (TinyAIMemoryGovernor *)TINYAI_MALLOC(sizeof(*governor));
+    if (!governor) {
+        return NULL;
+    }
+    memset(governor, 0, sizeof(*governor));
+
+    if (config) {
+        governor->config = *config;
+    }
+    else {
+        tinyaiMemoryGovernorGetDefaultConfig(&governor->config);
+    }
+    return governor;
+}
+
+void tinyaiDestroyMemoryGovernor(TinyAIMemoryGovernor *governor)
+{
+    if (!governor) {
+        return;
+    }
+
+    for (int i = 0; i < governor->numShedders; i++) {
+        if (governor->shedders[i].pool) {
+            tinyaiAdvancedPoolSetPressureCallback(governor->shedders[i].userData, NULL, NULL);
+        }
+    }
+    TINYAI_FREE(governor);
+}
+
+/* Add a shedder, marking whether it belongs to a watched pool */
+static int addShedder(TinyAIMemoryGovernor *governor, TinyAIShedStage stage, TinyAIShedFn shed,
+                      void *userData, bool pool)
+{
+    if (!governor || !shed || stage < 0 || stage >= TINYAI_SHED_STAGE_COUNT ||
+        governor->numShedders >= TINYAI_GOVERNOR_MAX_SHEDDERS) {
+        return -1;
+    }
+
+    Shedder *shedder  = &governor->shedders[governor->numShedders++];
+    shedder->stage    = stage;
+    shedder->shed     = shed;
+    shedder->userData = userData;
+    shedder->pool     = pool;
+    return 0;
+}
+
+int tinyaiMemoryGovernorAddShedder(TinyAIMemoryGovernor *governor, TinyAIShedStage stage,
+                                   TinyAIShedFn shed, void *userData)
+{
+    return addShedder(governor, stage, shed, userData, false);
+}
+
+/* Release every cached layer of a mapped model */
+static size_t shedMappedModel(void *userData, TinyAIPressureLevel level)
+{
+    TinyAIMappedModel *model  = (TinyAIMappedModel *)userData;
+    size_t             before = tinyaiGetMappedModelMemoryUsage(model);
+    (void)level;
+
+    int layers = tinyaiGetMappedLayerCount(model);
+    for (int i = 0; i < layers; i++) {
+        tinyaiReleaseLayerWeights(model, i);
+    }
+
+    size_t after = tinyaiGetMappedModelMemoryUsage(model);
+    return before > after ? before - after : 0;
+}
+
+int tinyaiMemoryGovernorAddMappedModel(TinyAIMemoryGovernor *governor, TinyAIMappedModel *model)
+{
+    if (!model) {
+        return -1;
+    }
+    return addShedder(governor, TINYAI_SHED_MAPPED_WEIGHTS, shedMappedModel, model, false);
+}
+
+/* Return grown pool regions to the system */
+static size_t shedPool(void *userData, TinyAIPressureLevel level)
+{
+    (void)level;
+    return tinyaiAdvancedPoolTrim((TinyAIAdvancedMemoryPool *)userData);
+}
+
+/* Pool pressure callback: remember the highest level until the next poll */
+static void recordPoolPressure(void *userData, uint8_t pressureLevel)
+{
+    TinyAIMemoryGovernor *governor = (TinyAIMemoryGovernor *)userData;
+#ifdef _WIN32
+    LONG seen = governor->poolPressure;
+    while (pressureLevel > seen) {
+        LONG previous = InterlockedCompareExchange(&governor->poolPressure, pressureLevel, seen);
+        if (previous == seen) {
+            break;
+        }
+        seen = previous;
+    }
+#else
+    uint32_t seen = __atomic_load_n(&governor->poolPressure, __ATOMIC_RELAXED);
+    while (pressureLevel > seen &&
+           !__atomic_compare_exchange_n(&governor->poolPressure, &seen, pressureLevel, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+#endif
+}
+
+/* Take the highest pool pressure since the last poll */
+static uint32_t takePoolPressure(TinyAIMemoryGovernor *governor)
+{
+#ifdef _WIN32
+    return (uint32_t)InterlockedExchange(&governor->poolPressure, 0);
+#else
+    return __atomic_exchange_n(&governor->poolPressure, 0, __ATOMIC_RELAXED);
+#endif
+}
+
+int tinyaiMemoryGovernorWatchPool(TinyAIMemoryGovernor *governor, TinyAIAdvancedMemoryPool *pool)
+{
+    if (!pool || addShedder(governor, TINYAI_SHED_POOLS, shedPool, pool, true) != 0) {
+        return -1;
+    }
+    tinyaiAdvancedPoolSetPressureCallback(pool, recordPoolPressure, governor);
+    return 0;
+}
+
+void tinyaiMemoryGovernorRemove(TinyAIMemoryGovernor *governor, void *userData)
+{
+    if (!governor) {
+        return;
+    }
+
+    int kept = 0;
+    for (int i = 0; i < governor->numShedders; i++) {
+        Shedder *shedder = &governor->shedders[i];
+        if (shedder->userData != userData) {
+            governor->shedders[kept++] = *shedder;
+        }
+        else if (shedder->pool) {
+            tinyaiAdvancedPoolSetPressureCallback(userData, NULL, NULL);
+        }
+    }
+    governor->numShedders = kept;
+}
+
+/* Level of resident memory against the configured thresholds */
+static TinyAIPressureLevel residentLevel(const TinyAIMemoryGovernorConfig *config,
+                                         size_t resident)
+{
+    if (config->memoryLimit == 0) {
+        return TINYAI_PRESSURE_NONE;
+    }
+
+    /* Divide by hundredths of the limit, so large sizes cannot overflow */
+    size_t hundredth = config->memoryLimit / 100;
+    size_t percent   = hundredth ? resident / hundredth : resident * 100 / config->memoryLimit;
+    if (percent >= config->criticalPercent) {
+        return TINYAI_PRESSURE_CRITICAL;
+    }
+    if (percent >= config->highPercent) {
+        return TINYAI_PRESSURE_HIGH;
+    }
+    if (percent >= config->moderatePercent) {
+        return TINYAI_PRESSURE_MODERATE;
+    }
+    return TINYAI_PRESSURE_NONE;
+}
+
+/* Level of the pressure reported by pools */
+static TinyAIPressureLevel poolLevel(uint32_t pressure)
+{
+    if (pressure >= POOL_PRESSURE_CRITICAL) {
+        return TINYAI_PRESSURE_CRITICAL;
+    }
+    if (pressure >= POOL_PRESSURE_HIGH) {
+        return TINYAI_PRESSURE_HIGH;
+    }
+    return TINYAI_PRESSURE_NONE;
+}
+
+TinyAIPressureLevel tinyaiMemoryGovernorPoll(TinyAIMemoryGovernor *governor)
+{
+    if (!governor) {
+        return TINYAI_PRESSURE_NONE;
+    }
+
+    size_t              resident = tinyaiGetResidentMemory();
+    TinyAIPressureLevel memory   = residentLevel(&governor->config, resident);
+    TinyAIPressureLevel pools    = poolLevel(takePoolPressure(governor));
+    TinyAIPressureLevel level    = memory > pools ? memory : pools;
+
+    governor->stats.polls++;
+    governor->stats.lastLevel    = level;
+    governor->stats.lastResident = resident;
+
+    /* Each stage runs while its level is reached and usage is still high. Pool
+     * pressure is only relieved by compaction, so it keeps every stage its
+     * level allows running; freed bytes only lower the resident estimate. */
+    size_t freed = 0;
+    for (int stage = 0; stage < TINYAI_SHED_STAGE_COUNT && level != TINYAI_PRESSURE_NONE;
+         stage++) {
+        if (level < g_stageLevel[stage]) {
+            break;
+        }
+
+        size_t stageFreed = 0;
+        bool   ran        = false;
+        for (int i = 0; i < governor->numShedders; i++) {
+            if (governor->shedders[i].stage == (TinyAIShedStage)stage) {
+                stageFreed += governor->shedders[i].shed(governor->shedders[i].userData, level);
+                ran = true;
+            }
+        }
+        if (ran) {
+            governor->stats.sheds[stage]++;
+            governor->stats.bytesShed[stage] += stageFreed;
+        }
+
+        freed += stageFreed;
+        memory = residentLevel(&governor->config, resident > freed ? resident - freed : 0);
+        if (memory == TINYAI_PRESSURE_NONE && pools == TINYAI_PRESSURE_NONE) {
+            break;
+        }
+    }
+
+    return level;
+}
+
+void tinyaiMemoryGovernorGetStats(const TinyAIMemoryGovernor *governor,
+                                  TinyAIMemoryGovernorStats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (!governor) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = governor->stats;
+}
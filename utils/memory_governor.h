@@ -0,0 +1,189 @@
+/**
+ * @file memory_governor.h
+ * @brief Memory-pressure driven eviction across TinyAI caches and pools
+ *
+ * A governor watches the process resident set against a memory limit and the
+ * pressure reported by advanced memory pools. When polled under pressure it
+ * sheds memory stage by stage, cheapest to rebuild first: cached layers of
+ * mapped models, then prompt-prefix caches, idle key/value cache blocks,
+ * tokenizer caches, and finally pool compaction. Higher pressure runs more
+ * stages, and shedding stops as soon as usage is back under the moderate
+ * threshold.
+ *
+ * Shedders free memory that other code may be using, so polling happens at
+ * safe points chosen by the caller (between requests or decode steps) rather
+ * than on a background thread. Pool pressure callbacks only record the level.
+ *
+ * The limit comes from the "system.memory_limit_mb" configuration key, and
+ * defaults to the physical memory of the machine.
+ */
+
+#ifndef TINYAI_MEMORY_GOVERNOR_H
+#define TINYAI_MEMORY_GOVERNOR_H
+
+#include "advanced_memory_pool.h"
+#include "mmap_loader.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Most shedders a governor holds
+ */
+#define TINYAI_GOVERNOR_MAX_SHEDDERS 64
+
+/**
+ * Memory pressure levels
+ */
+typedef enum {
+    TINYAI_PRESSURE_NONE,     /* Below the moderate threshold */
+    TINYAI_PRESSURE_MODERATE, /* Drop what is cheapest to rebuild */
+    TINYAI_PRESSURE_HIGH,     /* Also trim caches that cost recomputation */
+    TINYAI_PRESSURE_CRITICAL  /* Shed everything, including pool compaction */
+} TinyAIPressureLevel;
+
+/**
+ * Shedding stages, in the order they run
+ */
+typedef enum {
+    TINYAI_SHED_MAPPED_WEIGHTS,  /* Cached layers of mapped models (moderate) */
+    TINYAI_SHED_PREFIX_CACHE,    /* Prompt-prefix caches (moderate) */
+    TINYAI_SHED_KV_CACHE,        /* Idle key/value cache blocks (high) */
+    TINYAI_SHED_TOKENIZER_CACHE, /* Tokenizer word caches (high) */
+    TINYAI_SHED_POOLS,           /* Memory pool compaction (critical) */
+    TINYAI_SHED_STAGE_COUNT
+} TinyAIShedStage;
+
+/**
+ * Free memory held by a cache
+ *
+ * @param userData Object registered with the shedder
+ * @param level Current pressure, for shedders that scale their effort
+ * @return Bytes released (an estimate is fine)
+ */
+typedef size_t (*TinyAIShedFn)(void *userData, TinyAIPressureLevel level);
+
+/**
+ * Governor configuration
+ */
+typedef struct {
+    size_t  memoryLimit;      /* Resident bytes the process may use (0 = unlimited) */
+    uint8_t moderatePercent;  /* Share of the limit where shedding starts */
+    uint8_t highPercent;      /* Share of the limit for high pressure */
+    uint8_t criticalPercent;  /* Share of the limit for critical pressure */
+} TinyAIMemoryGovernorConfig;
+
+/**
+ * Governor statistics
+ */
+typedef struct {
+    uint64_t            polls;                                 /* Calls to poll */
+    uint64_t            sheds[TINYAI_SHED_STAGE_COUNT];        /* Times each stage ran */
+    size_t              bytesShed[TINYAI_SHED_STAGE_COUNT];    /* Bytes each stage released */
+    TinyAIPressureLevel lastLevel;                             /* Level at the last poll */
+    size_t              lastResident;                          /* Resident bytes at last poll */
+} TinyAIMemoryGovernorStats;
+
+/**
+ * Memory governor (opaque)
+ */
+typedef struct TinyAIMemoryGovernor TinyAIMemoryGovernor;
+
+/**
+ * Get the default governor configuration
+ *
+ * @param config Configuration to fill
+ */
+void tinyaiMemoryGovernorGetDefaultConfig(TinyAIMemoryGovernorConfig *config);
+
+/**
+ * Create a memory governor
+ *
+ * @param config Configuration (NULL for the default)
+ * @return New governor or NULL on error
+ */
+TinyAIMemoryGovernor *tinyaiCreateMemoryGovernor(const TinyAIMemoryGovernorConfig *config);
+
+/**
+ * Destroy a memory governor, detaching it from the pools it watches
+ *
+ * @param governor Governor to destroy
+ */
+void tinyaiDestroyMemoryGovernor(TinyAIMemoryGovernor *governor);
+
+/**
+ * Register a shedder for a stage
+ *
+ * @param governor Governor
+ * @param stage Stage the shedder runs in
+ * @param shed Function releasing memory
+ * @param userData Object passed to shed, also the key for tinyaiMemoryGovernorRemove
+ * @return 0 on success, -1 on error or when the governor is full
+ */
+int tinyaiMemoryGovernorAddShedder(TinyAIMemoryGovernor *governor, TinyAIShedStage stage,
+                                   TinyAIShedFn shed, void *userData);
+
+/**
+ * Release the cached layers of a mapped model under pressure
+ *
+ * @param governor Governor
+ * @param model Mapped model
+ * @return 0 on success, -1 on error
+ */
+int tinyaiMemoryGovernorAddMappedModel(TinyAIMemoryGovernor *governor, TinyAIMappedModel *model);
+
+/**
+ * Watch the pressure of an advanced pool, and compact it under critical pressure
+ *
+ * Replaces the pool's pressure callback.
+ *
+ * @param governor Governor
+ * @param pool Advanced pool
+ * @return 0 on success, -1 on error
+ */
+int tinyaiMemoryGovernorWatchPool(TinyAIMemoryGovernor *governor, TinyAIAdvancedMemoryPool *pool);
+
+/**
+ * Remove every shedder registered with an object
+ *
+ * Must be called before the object is destroyed. A watched pool also loses
+ * its pressure callback.
+ *
+ * @param governor Governor
+ * @param userData Object the shedders were registered with
+ */
+void tinyaiMemoryGovernorRemove(TinyAIMemoryGovernor *governor, void *userData);
+
+/**
+ * Measure pressure and shed memory if needed
+ *
+ * @param governor Governor
+ * @return Pressure level measured before shedding
+ */
+TinyAIPressureLevel tinyaiMemoryGovernorPoll(TinyAIMemoryGovernor *governor);
+
+/**
+ * Get governor statistics
+ *
+ * @param governor Governor
+ * @param stats Statistics to fill
+ */
+void tinyaiMemoryGovernorGetStats(const TinyAIMemoryGovernor *governor,
+                                  TinyAIMemoryGovernorStats *stats);
+
+/**
+ * Get the resident memory of the process
+ *
+ * @return Resident bytes, or 0 where it cannot be measured
+ */
+size_t tinyaiGetResidentMemory(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_MEMORY_GOVERNOR_H */
@@ -4,11 +4,18 @@
  */
 
 #include "memory_pool.h"
+#include "numa.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
 /* Alignment helpers */
 #define ALIGN_UP(x, alignment) (((x) + (alignment - 1)) & ~(alignment - 1))
 #define IS_ALIGNED(x, alignment) (((uintptr_t)(x) & (alignment - 1)) == 0)
@@ -19,6 +26,11 @@
 #define DEFAULT_BLOCK_SIZE 64
 #define DEFAULT_ALLOW_GROWTH true
 #define DEFAULT_TRACK_ALLOCS true
+#define DEFAULT_USE_HUGE_PAGES false
+#define DEFAULT_NUMA_NODE -1
+
+/* Huge page size; smaller regions stay on the heap even with useHugePages */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
 /* Constants for allocation tracking */
 #define MAX_ALLOCATION_RECORDS 10000
@@ -39,13 +51,35 @@ typedef struct MemoryBlock {
     uint32_t            magic;     /* Magic number for validation */
     const char         *allocFile; /* Source file of allocation (for debugging) */
     int                 allocLine; /* Source line of allocation (for debugging) */
+    TinyAIPoolHandle    handle;    /* Handle of a movable allocation, or TINYAI_POOL_NULL_HANDLE */
 } MemoryBlock;
 
+/* Slot of the handle table; the data of unpinned movable allocations may move */
+typedef struct {
+    MemoryBlock *block;     /* Block holding the data (NULL when the slot is free) */
+    void        *data;      /* Current address of the data */
+    size_t       size;      /* Requested size */
+    size_t       alignment; /* Requested alignment */
+    uint32_t     pins;      /* Outstanding tinyaiMemoryPoolPin calls */
+    uint32_t     nextFree;  /* Handle of the next free slot */
+} MovableSlot;
+
+/* How a region's memory was obtained */
+typedef enum {
+    REGION_HEAP,        /* Allocated with the region header */
+    REGION_MAPPED,      /* Anonymous mapping, transparent huge pages refused */
+    REGION_TRANSPARENT, /* Anonymous mapping advised to use transparent huge pages */
+    REGION_HUGE_PAGES,  /* Reserved huge pages */
+    REGION_NODE         /* Pages placed on a NUMA node by tinyaiNumaAlloc */
+} RegionBacking;
+
 /* Memory region representing a continuous allocation from the system */
 typedef struct MemoryRegion {
-    void                *memory; /* The actual memory */
-    size_t               size;   /* Size of the memory region */
-    struct MemoryRegion *next;   /* Next region in the chain */
+    void                *memory;     /* The actual memory */
+    size_t               size;       /* Size of the memory region */
+    size_t               mappedSize; /* Length of the mapping, a multiple of the page size */
+    RegionBacking        backing;    /* Where the memory came from */
+    struct MemoryRegion *next;       /* Next region in the chain */
 } MemoryRegion;
 
 /* Memory pool structure */
@@ -58,6 +92,14 @@ struct TinyAIMemoryPool {
     size_t        maxCapacity;      /* Maximum capacity (0 for unlimited) */
     bool          allowGrowth;      /* Whether to allow growth */
     bool          trackAllocations; /* Whether to track allocations */
+    bool          useHugePages;     /* Whether to back large regions with huge pages */
+    int           numaNode;         /* NUMA node of the regions, or -1 */
+
+    /* Movable allocations */
+    MovableSlot     *handles;     /* Handle table; handle h lives in slot h - 1 */
+    uint32_t         numHandles;  /* Slots in use or on the free list */
+    uint32_t         maxHandles;  /* Slots allocated */
+    TinyAIPoolHandle freeHandles; /* First free slot */
 
     /* Statistics */
     size_t numAllocations; /* Number of active allocations */
@@ -74,6 +116,8 @@ void tinyaiMemoryPoolGetDefaultConfig(TinyAIMemoryPoolConfig *config)
         config->blockSize        = DEFAULT_BLOCK_SIZE;
         config->allowGrowth      = DEFAULT_ALLOW_GROWTH;
         config->trackAllocations = DEFAULT_TRACK_ALLOCS;
+        config->useHugePages     = DEFAULT_USE_HUGE_PAGES;
+        config->numaNode         = DEFAULT_NUMA_NODE;
     }
 }
 
@@ -91,13 +135,117 @@ static MemoryBlock *createMemoryBlock(void *address, size_t size, bool isFree)
     block->magic     = ALLOCATION_MAGIC;
     block->allocFile = NULL;
     block->allocLine = 0;
+    block->handle    = TINYAI_POOL_NULL_HANDLE;
 
     return block;
 }
 
+/*
+ * Map memory on huge pages: reserved ones first, then 2MB-aligned memory
+ * advised to use transparent huge pages. Returns NULL where neither works.
+ */
+static void *mapHugePages(size_t size, size_t *mappedSize, RegionBacking *backing)
+{
+    size_t length = ALIGN_UP(size, (size_t)HUGE_PAGE_SIZE);
+
+#ifdef _WIN32
+    /* Large pages need SeLockMemoryPrivilege; without it the allocation fails */
+    SIZE_T largePage = GetLargePageMinimum();
+    if (largePage == 0) {
+        return NULL;
+    }
+    length       = ALIGN_UP(size, (size_t)largePage);
+    void *memory = VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                PAGE_READWRITE);
+    if (!memory) {
+        return NULL;
+    }
+    *mappedSize = length;
+    *backing    = REGION_HUGE_PAGES;
+    return memory;
+#else
+#ifdef MAP_HUGETLB
+    void *memory = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+        *mappedSize = length;
+        *backing    = REGION_HUGE_PAGES;
+        return memory;
+    }
+#endif
+
+#ifdef MADV_HUGEPAGE
+    /* Over-map by a huge page and trim both ends so the region starts on a 2MB boundary */
+    size_t span = length + HUGE_PAGE_SIZE;
+    char  *base = (char *)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                               -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    char  *start = (char *)ALIGN_UP((uintptr_t)base, (uintptr_t)HUGE_PAGE_SIZE);
+    size_t head  = (size_t)(start - base);
+    if (head > 0) {
+        munmap(base, head);
+    }
+    if (span - head > length) {
+        munmap(start + length, span - head - length);
+    }
+
+    *mappedSize = length;
+    *backing    = madvise(start, length, MADV_HUGEPAGE) == 0 ? REGION_TRANSPARENT : REGION_MAPPED;
+    return start;
+#else
+    (void)length;
+    (void)mappedSize;
+    (void)backing;
+    return NULL;
+#endif
+#endif
+}
+
+/* Release the memory of a region and the region itself */
+static void releaseMemoryRegion(MemoryRegion *region)
+{
+    if (region->backing == REGION_NODE) {
+        tinyaiNumaFree(region->memory, region->mappedSize);
+    }
+    else if (region->backing != REGION_HEAP) {
+#ifdef _WIN32
+        VirtualFree(region->memory, 0, MEM_RELEASE);
+#else
+        munmap(region->memory, region->mappedSize);
+#endif
+    }
+    free(region);
+}
+
 /* Initialize a memory region */
-static MemoryRegion *createMemoryRegion(size_t size)
+static MemoryRegion *createMemoryRegion(const TinyAIMemoryPool *pool, size_t size)
 {
+    if ((pool->useHugePages && size >= HUGE_PAGE_SIZE) || pool->numaNode >= 0) {
+        MemoryRegion *region = (MemoryRegion *)malloc(sizeof(MemoryRegion));
+        if (region) {
+            region->memory = NULL;
+            if (pool->useHugePages && size >= HUGE_PAGE_SIZE) {
+                region->memory = mapHugePages(size, &region->mappedSize, &region->backing);
+                if (region->memory && pool->numaNode >= 0) {
+                    tinyaiNumaPlace(region->memory, region->mappedSize, pool->numaNode);
+                }
+            }
+            if (!region->memory && pool->numaNode >= 0) {
+                region->memory     = tinyaiNumaAlloc(size, pool->numaNode);
+                region->mappedSize = size;
+                region->backing    = REGION_NODE;
+            }
+            if (region->memory) {
+                region->size = size;
+                region->next = NULL;
+                return region;
+            }
+            free(region);
+        }
+    }
+
     /* Allocate region structure and memory in one go */
     size_t totalSize = sizeof(MemoryRegion) + size;
     void  *memory    = malloc(totalSize);
@@ -109,6 +257,8 @@ static MemoryRegion *createMemoryRegion(size_t size)
     MemoryRegion *region = (MemoryRegion *)memory;
     region->memory       = (char *)memory + sizeof(MemoryRegion);
     region->size         = size;
+    region->mappedSize   = 0;
+    region->backing      = REGION_HEAP;
     region->next         = NULL;
 
     return region;
@@ -191,7 +341,7 @@ static bool addMemoryRegion(TinyAIMemoryPool *pool, size_t size)
     }
 
     /* Create a new region */
-    MemoryRegion *region = createMemoryRegion(size);
+    MemoryRegion *region = createMemoryRegion(pool, size);
     if (!region) {
         return false;
     }
@@ -272,6 +422,8 @@ TinyAIMemoryPool *tinyaiMemoryPoolCreate(const TinyAIMemoryPoolConfig *config)
     pool->maxCapacity      = config->maxCapacity;
     pool->allowGrowth      = config->allowGrowth;
     pool->trackAllocations = config->trackAllocations;
+    pool->useHugePages     = config->useHugePages;
+    pool->numaNode         = config->numaNode;
 
     /* Allocate initial memory region */
     if (!addMemoryRegion(pool, config->initialCapacity)) {
@@ -293,21 +445,19 @@ void tinyaiMemoryPoolDestroy(TinyAIMemoryPool *pool)
     MemoryRegion *region = pool->regions;
     while (region) {
         MemoryRegion *next = region->next;
-        free(region);
+        releaseMemoryRegion(region);
         region = next;
     }
 
     /* Free the pool structure */
+    free(pool->handles);
     free(pool);
 }
 
-/* Allocate memory from pool */
-void *tinyaiMemoryPoolAlloc(TinyAIMemoryPool *pool, size_t size, size_t alignment)
+/* Allocate memory from pool, returning the block holding it */
+static void *allocBlock(TinyAIMemoryPool *pool, size_t size, size_t alignment,
+                        MemoryBlock **blockOut)
 {
-    if (!pool || size == 0) {
-        return NULL;
-    }
-
     /* Ensure alignment is at least DEFAULT_ALIGNMENT and a power of 2 */
     if (alignment < DEFAULT_ALIGNMENT) {
         alignment = DEFAULT_ALIGNMENT;
@@ -330,10 +480,14 @@ void *tinyaiMemoryPoolAlloc(TinyAIMemoryPool *pool, size_t size, size_t alignmen
             return NULL;
         }
 
-        /* Calculate growth size - double the current size or enough for this allocation */
+        /*
+         * Calculate growth size - double the current size or enough for this allocation,
+         * counting the aligned header findFreeBlock places in front of it
+         */
+        size_t neededSize = sizeof(MemoryBlock) + (alignment - 1) + totalSize;
         size_t growthSize = pool->totalSize;
-        if (growthSize < totalSize) {
-            growthSize = totalSize;
+        if (growthSize < neededSize) {
+            growthSize = neededSize;
         }
 
         /* Add a new region */
@@ -360,6 +514,7 @@ void *tinyaiMemoryPoolAlloc(TinyAIMemoryPool *pool, size_t size, size_t alignmen
     /* Mark the block as used */
     block->isFree   = false;
     block->usedSize = usedSize;
+    block->handle   = TINYAI_POOL_NULL_HANDLE;
 
     /* Update statistics */
     pool->numFreeBlocks--;
@@ -370,9 +525,21 @@ void *tinyaiMemoryPoolAlloc(TinyAIMemoryPool *pool, size_t size, size_t alignmen
         pool->peakUsage = pool->usedSize;
     }
 
+    *blockOut = block;
     return alignedAddr;
 }
 
+/* Allocate memory from pool */
+void *tinyaiMemoryPoolAlloc(TinyAIMemoryPool *pool, size_t size, size_t alignment)
+{
+    if (!pool || size == 0) {
+        return NULL;
+    }
+
+    MemoryBlock *block;
+    return allocBlock(pool, size, alignment, &block);
+}
+
 /* Free memory allocated from pool */
 void tinyaiMemoryPoolFree(TinyAIMemoryPool *pool, void *ptr)
 {
@@ -398,14 +565,15 @@ void tinyaiMemoryPoolFree(TinyAIMemoryPool *pool, void *ptr)
                 return;
             }
 
-            /* Mark the block as free */
-            block->isFree   = true;
-            block->usedSize = 0;
-
             /* Update statistics */
             pool->numFreeBlocks++;
             pool->numAllocations--;
-            pool->usedSize -= block->size;
+            pool->usedSize -= block->usedSize;
+
+            /* Mark the block as free */
+            block->isFree   = true;
+            block->usedSize = 0;
+            block->handle   = TINYAI_POOL_NULL_HANDLE;
 
             /* Try to merge adjacent free blocks */
             mergeAdjacentFreeBlocks(pool);
@@ -431,9 +599,14 @@ void tinyaiMemoryPoolReset(TinyAIMemoryPool *pool)
     while (block) {
         block->isFree   = true;
         block->usedSize = 0;
+        block->handle   = TINYAI_POOL_NULL_HANDLE;
         block           = block->next;
     }
 
+    /* Every handle is gone with its allocation */
+    pool->numHandles  = 0;
+    pool->freeHandles = TINYAI_POOL_NULL_HANDLE;
+
     /* Reset statistics */
     pool->numAllocations = 0;
     pool->numFreeBlocks  = 0;
@@ -477,6 +650,18 @@ void tinyaiMemoryPoolGetStats(TinyAIMemoryPool *pool, TinyAIMemoryPoolStats *sta
     }
     stats->largestBlock = largestBlock;
 
+    /* Count the regions that got huge pages */
+    stats->hugePageBytes        = 0;
+    stats->hugePageAdvisedBytes = 0;
+    for (MemoryRegion *region = pool->regions; region; region = region->next) {
+        if (region->backing == REGION_HUGE_PAGES) {
+            stats->hugePageBytes += region->mappedSize;
+        }
+        else if (region->backing == REGION_TRANSPARENT) {
+            stats->hugePageAdvisedBytes += region->mappedSize;
+        }
+    }
+
     /* Calculate fragmentation score (0-100) */
     if (pool->totalSize > 0) {
         /* Consider both the number of free blocks and the largest block size */
@@ -522,6 +707,23 @@ bool tinyaiMemoryPoolContains(TinyAIMemoryPool *pool, const void *ptr)
     return false;
 }
 
+/* Check if a pointer lies in one of the pool's regions */
+bool tinyaiMemoryPoolOwns(const TinyAIMemoryPool *pool, const void *ptr)
+{
+    if (!pool || !ptr) {
+        return false;
+    }
+
+    for (const MemoryRegion *region = pool->regions; region; region = region->next) {
+        if ((const char *)ptr >= (const char *)region->memory &&
+            (const char *)ptr < (const char *)region->memory + region->size) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /* Specialized 4-bit weight allocation */
 uint8_t *tinyaiMemoryPoolAllocWeights4Bit(TinyAIMemoryPool *pool, size_t rows, size_t cols,
                                           bool requiresSIMD)
@@ -620,12 +822,254 @@ bool tinyaiMemoryPoolCompact(TinyAIMemoryPool *pool)
         return false;
     }
 
-    /* First merge adjacent free blocks */
+    /* Slide every unpinned movable allocation down as far as it goes */
+    tinyaiMemoryPoolCompactStep(pool, (size_t)-1);
+    return true;
+}
+
+/* Get the slot of a live handle, or NULL */
+static MovableSlot *movableSlot(TinyAIMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    if (handle == TINYAI_POOL_NULL_HANDLE || handle > pool->numHandles ||
+        !pool->handles[handle - 1].block) {
+        return NULL;
+    }
+    return &pool->handles[handle - 1];
+}
+
+/* Allocate memory the pool may move while it is not pinned */
+TinyAIPoolHandle tinyaiMemoryPoolAllocMovable(TinyAIMemoryPool *pool, size_t size,
+                                              size_t alignment)
+{
+    if (!pool || size == 0) {
+        return TINYAI_POOL_NULL_HANDLE;
+    }
+    if (alignment < DEFAULT_ALIGNMENT) {
+        alignment = DEFAULT_ALIGNMENT;
+    }
+
+    MemoryBlock *block;
+    void        *data = allocBlock(pool, size, alignment, &block);
+    if (!data) {
+        return TINYAI_POOL_NULL_HANDLE;
+    }
+
+    /* Take a free slot, or add one */
+    TinyAIPoolHandle handle = pool->freeHandles;
+    if (handle != TINYAI_POOL_NULL_HANDLE) {
+        pool->freeHandles = pool->handles[handle - 1].nextFree;
+    }
+    else {
+        if (pool->numHandles == pool->maxHandles) {
+            uint32_t     maxHandles = pool->maxHandles ? pool->maxHandles * 2 : 64;
+            MovableSlot *handles =
+                (MovableSlot *)realloc(pool->handles, maxHandles * sizeof(MovableSlot));
+            if (!handles) {
+                tinyaiMemoryPoolFree(pool, data);
+                return TINYAI_POOL_NULL_HANDLE;
+            }
+            pool->handles    = handles;
+            pool->maxHandles = maxHandles;
+        }
+        handle = ++pool->numHandles;
+    }
+
+    MovableSlot *slot = &pool->handles[handle - 1];
+    slot->block       = block;
+    slot->data        = data;
+    slot->size        = size;
+    slot->alignment   = alignment;
+    slot->pins        = 0;
+    slot->nextFree    = TINYAI_POOL_NULL_HANDLE;
+    block->handle     = handle;
+    return handle;
+}
+
+/* Free a movable allocation */
+void tinyaiMemoryPoolFreeMovable(TinyAIMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    MovableSlot *slot = pool ? movableSlot(pool, handle) : NULL;
+    if (!slot) {
+        return;
+    }
+
+    tinyaiMemoryPoolFree(pool, slot->data);
+    slot->block       = NULL;
+    slot->data        = NULL;
+    slot->nextFree    = pool->freeHandles;
+    pool->freeHandles = handle;
+}
+
+/* Get the address of a movable allocation and keep it there until unpinned */
+void *tinyaiMemoryPoolPin(TinyAIMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    MovableSlot *slot = pool ? movableSlot(pool, handle) : NULL;
+    if (!slot) {
+        return NULL;
+    }
+
+    slot->pins++;
+    return slot->data;
+}
+
+/* Let a movable allocation move again */
+void tinyaiMemoryPoolUnpin(TinyAIMemoryPool *pool, TinyAIPoolHandle handle)
+{
+    MovableSlot *slot = pool ? movableSlot(pool, handle) : NULL;
+    if (slot && slot->pins > 0) {
+        slot->pins--;
+    }
+}
+
+/*
+ * Move a movable block down into the free gap in front of it. Returns the
+ * block to continue scanning from, or NULL when the block cannot move.
+ */
+static MemoryBlock *slideBlock(TinyAIMemoryPool *pool, MemoryBlock *gap, MemoryBlock *block)
+{
+    TinyAIPoolHandle handle   = block->handle;
+    MovableSlot     *slot     = &pool->handles[handle - 1];
+    char            *start    = (char *)gap->address;
+    size_t           span     = gap->size + block->size;
+    char            *data     = (char *)ALIGN_UP((uintptr_t)(start + sizeof(MemoryBlock)),
+                                                 slot->alignment);
+    size_t           usedSize = (size_t)(data - start) + slot->size;
+    if (data >= (char *)slot->data || usedSize > span) {
+        return NULL;
+    }
+
+    /* Both headers are overwritten below, so keep what is needed */
+    MemoryBlock *prev      = gap->prev;
+    MemoryBlock *after     = block->next;
+    size_t       oldUsed   = block->usedSize;
+    const char  *allocFile = block->allocFile;
+    int          allocLine = block->allocLine;
+
+    memmove(data, slot->data, slot->size);
+
+    MemoryBlock *moved = createMemoryBlock(start, usedSize, false);
+    moved->allocFile   = allocFile;
+    moved->allocLine   = allocLine;
+    moved->handle      = handle;
+
+    /* The rest of the span becomes free space, unless it is too small for a block */
+    MemoryBlock *space = NULL;
+    size_t       rest  = span - usedSize;
+    if (rest >= pool->blockSize + sizeof(MemoryBlock)) {
+        space       = createMemoryBlock(start + usedSize, rest, true);
+        space->prev = moved;
+        space->next = after;
+        moved->next = space;
+    }
+    else {
+        moved->size = span;
+        moved->next = after;
+        pool->numFreeBlocks--;
+    }
+
+    moved->prev = prev;
+    if (prev) {
+        prev->next = moved;
+    }
+    else {
+        pool->blocks = moved;
+    }
+    if (after) {
+        after->prev = space ? space : moved;
+    }
+
+    pool->usedSize += usedSize - oldUsed;
+    slot->block = moved;
+    slot->data  = data;
+
+    /* Join the free space with a free block behind it */
+    while (space && space->next && space->next->isFree &&
+           (char *)space->address + space->size == (char *)space->next->address) {
+        MemoryBlock *next = space->next;
+        space->size += next->size;
+        space->next = next->next;
+        if (next->next) {
+            next->next->prev = space;
+        }
+        pool->numFreeBlocks--;
+    }
+
+    return space ? space : moved;
+}
+
+/* Move unpinned movable allocations down over free space, up to maxBytes of data */
+size_t tinyaiMemoryPoolCompactStep(TinyAIMemoryPool *pool, size_t maxBytes)
+{
+    if (!pool) {
+        return 0;
+    }
+
     mergeAdjacentFreeBlocks(pool);
 
-    /* TODO: Implement more advanced compaction if needed */
+    size_t       movedBytes = 0;
+    MemoryBlock *block      = pool->blocks;
+    while (block && movedBytes < maxBytes) {
+        MemoryBlock *next = block->next;
+        if (block->isFree && next && !next->isFree && next->handle != TINYAI_POOL_NULL_HANDLE &&
+            pool->handles[next->handle - 1].pins == 0 &&
+            (char *)block->address + block->size == (char *)next->address) {
+            size_t       size = pool->handles[next->handle - 1].size;
+            MemoryBlock *from = slideBlock(pool, block, next);
+            if (from) {
+                movedBytes += size;
+                block = from;
+                continue;
+            }
+        }
+        block = next;
+    }
 
-    return true;
+    return movedBytes;
+}
+
+/* Release regions the pool grew into that hold no allocations */
+size_t tinyaiMemoryPoolTrim(TinyAIMemoryPool *pool)
+{
+    if (!pool) {
+        return 0;
+    }
+
+    mergeAdjacentFreeBlocks(pool);
+
+    /* Regions are prepended as the pool grows, so the last one is the initial region */
+    size_t         released = 0;
+    MemoryRegion **link     = &pool->regions;
+    while (*link && (*link)->next) {
+        MemoryRegion *region = *link;
+
+        /* An idle region is covered by exactly one free block */
+        MemoryBlock *block = pool->blocks;
+        while (block && block->address != region->memory) {
+            block = block->next;
+        }
+        if (!block || !block->isFree || block->size != region->size) {
+            link = &region->next;
+            continue;
+        }
+
+        if (block->prev) {
+            block->prev->next = block->next;
+        }
+        else {
+            pool->blocks = block->next;
+        }
+        if (block->next) {
+            block->next->prev = block->prev;
+        }
+        pool->numFreeBlocks--;
+        pool->totalSize -= region->size;
+        released += region->size;
+
+        *link = region->next;
+        releaseMemoryRegion(region);
+    }
+
+    return released;
 }
 
 /* Dump memory pool information for debugging */
@@ -27,6 +27,8 @@ typedef struct {
     size_t blockSize;        /**< Minimum allocation block size */
     bool   allowGrowth;      /**< Whether the pool can grow beyond initial capacity */
     bool   trackAllocations; /**< Whether to track individual allocations (for debugging) */
+    bool   useHugePages;     /**< Back regions of 2MB or more with huge pages where available */
+    int    numaNode;         /**< NUMA node to place regions on (-1 for no preference) */
 } TinyAIMemoryPoolConfig;
 
 /**
@@ -34,17 +36,26 @@ typedef struct {
  */
 typedef struct TinyAIMemoryPool TinyAIMemoryPool;
 
+/**
+ * @brief Handle of a movable allocation, valid until freed (0 is never a handle)
+ */
+typedef uint32_t TinyAIPoolHandle;
+
+#define TINYAI_POOL_NULL_HANDLE 0
+
 /**
  * @brief Memory usage statistics
  */
 typedef struct {
-    size_t totalAllocated;     /**< Total bytes allocated */
-    size_t totalUsed;          /**< Total bytes actually used */
-    size_t totalWasted;        /**< Wasted bytes due to alignment and fragmentation */
-    size_t largestBlock;       /**< Size of largest free block */
-    size_t totalBlocks;        /**< Total number of allocated blocks */
-    size_t freeBlocks;         /**< Number of free blocks */
-    size_t fragmentationScore; /**< Fragmentation score (0-100, lower is better) */
+    size_t totalAllocated;       /**< Total bytes allocated */
+    size_t totalUsed;            /**< Total bytes actually used */
+    size_t totalWasted;          /**< Wasted bytes due to alignment and fragmentation */
+    size_t largestBlock;         /**< Size of largest free block */
+    size_t totalBlocks;          /**< Total number of allocated blocks */
+    size_t freeBlocks;           /**< Number of free blocks */
+    size_t fragmentationScore;   /**< Fragmentation score (0-100, lower is better) */
+    size_t hugePageBytes;        /**< Bytes on reserved huge pages (MAP_HUGETLB, large pages) */
+    size_t hugePageAdvisedBytes; /**< Bytes advised to use transparent huge pages */
 } TinyAIMemoryPoolStats;
 
 /**
@@ -57,6 +68,12 @@ void tinyaiMemoryPoolGetDefaultConfig(TinyAIMemoryPoolConfig *config);
 /**
  * @brief Create a new memory pool
  *
+ * With useHugePages, regions of at least 2MB are mapped on reserved huge pages
+ * (MAP_HUGETLB, or large pages on Windows, which need the lock-pages privilege).
+ * Where none are available they fall back to 2MB-aligned memory advised to use
+ * transparent huge pages, and then to the heap. With a numaNode, regions are
+ * mapped on that node's memory (see tinyaiNumaAlloc).
+ *
  * @param config Pool configuration
  * @return Pointer to new memory pool or NULL on failure
  */
@@ -125,6 +142,18 @@ void tinyaiMemoryPoolGetStats(TinyAIMemoryPool *pool, TinyAIMemoryPoolStats *sta
  */
 bool tinyaiMemoryPoolContains(TinyAIMemoryPool *pool, const void *ptr);
 
+/**
+ * @brief Check if a pointer lies in the memory of the given pool
+ *
+ * Unlike tinyaiMemoryPoolContains this only compares against the pool's
+ * regions, so it is cheap, but it does not tell whether the block is in use.
+ *
+ * @param pool Pool to check
+ * @param ptr Pointer to check
+ * @return true if the pointer is inside one of the pool's regions
+ */
+bool tinyaiMemoryPoolOwns(const TinyAIMemoryPool *pool, const void *ptr);
+
 /**
  * @brief Specialized 4-bit weight allocation for models
  *
@@ -156,11 +185,81 @@ float *tinyaiMemoryPoolAllocActivations(TinyAIMemoryPool *pool, size_t size, boo
 /**
  * @brief Compact pool memory to reduce fragmentation
  *
+ * Merges free blocks and moves every unpinned movable allocation down over
+ * the free space in front of it, all in one go.
+ *
  * @param pool Pool to compact
  * @return true if compaction was successful
  */
 bool tinyaiMemoryPoolCompact(TinyAIMemoryPool *pool);
 
+/**
+ * @brief Compact a pool incrementally
+ *
+ * Does the work of tinyaiMemoryPoolCompact in slices: stops once maxBytes of
+ * data have been moved, so the time spent per call stays bounded. Calling it
+ * until it returns less than maxBytes compacts the pool fully.
+ *
+ * @param pool Pool to compact
+ * @param maxBytes Most bytes of data to move
+ * @return Bytes of data moved
+ */
+size_t tinyaiMemoryPoolCompactStep(TinyAIMemoryPool *pool, size_t maxBytes);
+
+/**
+ * @brief Allocate memory that compaction may move
+ *
+ * The data is only reachable through tinyaiMemoryPoolPin, and stays put
+ * while pinned. Meant for buffers such as activations that live across
+ * requests but are only touched now and then.
+ *
+ * @param pool Pool to allocate from
+ * @param size Size in bytes
+ * @param alignment Alignment of the data (power of 2)
+ * @return Handle, or TINYAI_POOL_NULL_HANDLE on failure
+ */
+TinyAIPoolHandle tinyaiMemoryPoolAllocMovable(TinyAIMemoryPool *pool, size_t size,
+                                              size_t alignment);
+
+/**
+ * @brief Free a movable allocation
+ *
+ * @param pool Pool the handle came from
+ * @param handle Handle to free
+ */
+void tinyaiMemoryPoolFreeMovable(TinyAIMemoryPool *pool, TinyAIPoolHandle handle);
+
+/**
+ * @brief Get the address of a movable allocation, keeping it there until unpinned
+ *
+ * Pins nest; each must be matched by tinyaiMemoryPoolUnpin.
+ *
+ * @param pool Pool the handle came from
+ * @param handle Movable allocation
+ * @return Current address of the data, or NULL for an invalid handle
+ */
+void *tinyaiMemoryPoolPin(TinyAIMemoryPool *pool, TinyAIPoolHandle handle);
+
+/**
+ * @brief Let compaction move a pinned allocation again
+ *
+ * Addresses from tinyaiMemoryPoolPin are invalid once the last pin is released.
+ *
+ * @param pool Pool the handle came from
+ * @param handle Movable allocation
+ */
+void tinyaiMemoryPoolUnpin(TinyAIMemoryPool *pool, TinyAIPoolHandle handle);
+
+/**
+ * @brief Give back the memory of regions added by growth that hold no allocations
+ *
+ * The initial region is always kept.
+ *
+ * @param pool Pool to trim
+ * @return Bytes released
+ */
+size_t tinyaiMemoryPoolTrim(TinyAIMemoryPool *pool);
+
 /**
  * @brief Dump memory pool information for debugging
  *
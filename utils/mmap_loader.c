@@ -4,6 +4,10 @@
  */
 
 #include "mmap_loader.h"
+#include "async_read.h"
+#include "memory_pool.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include <fcntl.h>
 #include <float.h>
 #include <stdio.h>
@@ -15,6 +19,7 @@
 #ifdef _WIN32
 #include <io.h>
 #include <windows.h>
+#include <psapi.h>
 #else
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -36,6 +41,69 @@ typedef pthread_t ThreadHandle;
 /* Maximum number of layers in a model */
 #define MAX_LAYERS 256
 
+/* Pending prefetch requests; further requests are dropped until the threads catch up */
+#define PREFETCH_QUEUE_SIZE 32
+
+/* Stride at which prefetch threads touch a layer to fault it in, at most one page */
+#define PREFETCH_TOUCH_STRIDE 4096
+
+/* Prefetch state of a layer */
+enum { PREFETCH_NONE, PREFETCH_QUEUED, PREFETCH_LOADING, PREFETCH_READY };
+
+/* Container file header; the index follows at indexOffset */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t tensorCount;
+    uint32_t flags; /* CONTAINER_FLAG_* */
+    uint64_t indexOffset;
+    uint64_t fileSize;
+    uint8_t  reserved[32];
+} ContainerHeader;
+
+/* Index entry of one container tensor (128 bytes) */
+typedef struct {
+    char     name[TINYAI_CONTAINER_NAME_SIZE];
+    uint32_t precision; /* TinyAIPrecision */
+    uint32_t layout;    /* TinyAIMatrix4bitLayout */
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t groupSize;
+    uint32_t hasLevels;
+    float    scale;
+    float    zeroPoint;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    uint64_t scalesOffset;   /* Scales, zero points and levels (0 when not group-quantized) */
+    uint64_t scalesSize;
+    uint32_t dataChecksum;   /* CRC-32 of the data */
+    uint32_t scalesChecksum; /* CRC-32 of the scale arrays */
+    uint32_t compression;    /* TinyAICompression of the data (version 2) */
+    uint32_t chunkSize;      /* Uncompressed bytes per chunk of compressed data */
+} ContainerEntry;
+
+/* Sections carry CRC-32 checksums */
+#define CONTAINER_FLAG_CHECKSUMS 1u
+
+/* In-memory sections of a tensor being written */
+typedef struct {
+    const void  *data;
+    const float *scales;
+    const float *zeroPoints;
+    const float *levels;
+    uint8_t     *stored;     /* Chunk table and chunks of compressed data (NULL if stored as is) */
+    size_t       storedSize; /* Size of the compressed section in bytes */
+} ContainerSource;
+
+/* Chunks of a tensor being compressed or decompressed in parallel */
+typedef struct {
+    const ContainerEntry *entry;
+    const uint8_t        *input;  /* Data to compress, or the compressed section */
+    uint8_t              *output; /* Compressed chunks stride bytes apart, or the data */
+    size_t                stride;
+    size_t               *sizes; /* Per chunk: compressed size, or nonzero if decompressed */
+} ContainerChunkTask;
+
 /* Memory-mapped model structure */
 struct TinyAIMappedModel {
     /* File mapping info */
@@ -45,8 +113,17 @@ struct TinyAIMappedModel {
 #else
     int fileDescriptor;
 #endif
-    void  *mappedData;
+    void  *mappedData; /* Whole file, or only its header and index with the read backend */
     size_t mappedSize;
+    size_t fileSize;
+    size_t hugePageAdvisedSize; /* Bytes of the mapping advised to use transparent huge pages */
+
+    /* Read backend (NULL when the file is mapped) */
+    TinyAIAsyncFile  *file;
+    TinyAIMemoryPool *weightPool; /* Aligned buffers of cached layers */
+
+    /* Container index (NULL for layer files) */
+    const ContainerEntry *entries;
 
     /* Model metadata */
     char     modelName[64];
@@ -60,10 +137,22 @@ struct TinyAIMappedModel {
     TinyAIMmapConfig config;
     size_t           currentCacheSize;
 
-    /* Prefetching */
-    ThreadHandle prefetchThread;
-    bool         prefetchRunning;
-    int          nextPrefetchLayer;
+    /* Prefetching: I/O threads serving a bounded ring of layer requests */
+    ThreadHandle        prefetchThreads[TINYAI_MAX_PREFETCH_THREADS];
+    int                 numPrefetchThreads;
+    bool                prefetchRunning;
+    int                 prefetchQueue[PREFETCH_QUEUE_SIZE];
+    int                 prefetchHead;
+    int                 prefetchCount;
+    uint8_t             prefetchState[MAX_LAYERS]; /* PREFETCH_* */
+    TinyAIPrefetchStats prefetchStats;
+#ifdef _WIN32
+    CONDITION_VARIABLE prefetchReady;
+    CONDITION_VARIABLE prefetchDone;
+#else
+    pthread_cond_t prefetchReady;
+    pthread_cond_t prefetchDone;
+#endif
 
     /* Lock for thread safety */
 #ifdef _WIN32
@@ -139,6 +228,79 @@ static int findLayerToEvict(TinyAIMappedModel *model)
     return worstLayerIndex;
 }
 
+/* Whether a layer pointer points into the mapping rather than to a heap copy */
+static bool isMappedWeights(const TinyAIMappedModel *model, const void *weights)
+{
+    const uint8_t *base = (const uint8_t *)model->mappedData;
+    return (const uint8_t *)weights >= base && (const uint8_t *)weights < base + model->mappedSize;
+}
+
+/* Whether a layer is a container tensor stored compressed */
+static bool isCompressedLayer(const TinyAIMappedModel *model, int layerIndex)
+{
+    return model->entries && model->entries[layerIndex].compression != TINYAI_COMPRESSION_NONE;
+}
+
+/* Allocate a buffer for a layer's weights, from the weight pool when there is one */
+static void *allocLayerBuffer(TinyAIMappedModel *model, size_t size)
+{
+    return model->weightPool
+               ? tinyaiMemoryPoolAlloc(model->weightPool, size, TINYAI_CONTAINER_ALIGNMENT)
+               : malloc(size);
+}
+
+/* Free a buffer from allocLayerBuffer */
+static void freeLayerBuffer(TinyAIMappedModel *model, void *buffer)
+{
+    if (model->weightPool) {
+        tinyaiMemoryPoolFree(model->weightPool, buffer);
+    }
+    else {
+        free(buffer);
+    }
+}
+
+/* Whether a layer can be handed out in place: in range and aligned for its elements */
+static bool canMapLayer(const TinyAIMappedModel *model, const TinyAILayerDescriptor *layer)
+{
+    return model->config.zeroCopy && !model->file &&
+           !isCompressedLayer(model, layer->layerIndex) && layer->size > 0 &&
+           layer->offset % sizeof(float) == 0 &&
+           layer->offset <= model->mappedSize && layer->size <= model->mappedSize - layer->offset;
+}
+
+/*
+ * Pin or unpin the pages of a layer handed out in place. Pinning asks the OS
+ * to read them ahead; unpinning drops the pages that lie wholly inside the
+ * layer, which the read-only mapping faults back in from the file on demand.
+ */
+static void adviseLayerPages(const TinyAIMappedModel *model, const TinyAILayerDescriptor *layer,
+                             bool pin)
+{
+#ifdef _WIN32
+    /* Views are paged in on demand and trimmed by the working set manager */
+    (void)model;
+    (void)layer;
+    (void)pin;
+#else
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start    = (uintptr_t)model->mappedData + layer->offset;
+    uintptr_t end      = start + layer->size;
+
+    if (pin) {
+        start &= ~(pageSize - 1);
+        madvise((void *)start, end - start, MADV_WILLNEED);
+    }
+    else {
+        start = (start + pageSize - 1) & ~(pageSize - 1);
+        end &= ~(pageSize - 1);
+        if (end > start) {
+            madvise((void *)start, end - start, MADV_DONTNEED);
+        }
+    }
+#endif
+}
+
 /* Free memory allocated for a layer's cached weights */
 static void freeLayerCache(TinyAIMappedModel *model, int layerIndex)
 {
@@ -148,7 +310,12 @@ static void freeLayerCache(TinyAIMappedModel *model, int layerIndex)
 
     TinyAILayerDescriptor *layer = &model->layers[layerIndex];
     if (layer->cachedWeights) {
-        free(layer->cachedWeights);
+        if (isMappedWeights(model, layer->cachedWeights)) {
+            adviseLayerPages(model, layer, false);
+        }
+        else {
+            freeLayerBuffer(model, layer->cachedWeights);
+        }
         layer->cachedWeights = NULL;
         model->currentCacheSize -= layer->size;
         layer->isActive = false;
@@ -177,11 +344,18 @@ static bool ensureCacheSpace(TinyAIMappedModel *model, size_t requiredSize)
     return true;
 }
 
-/* Load a layer's weights into memory */
-static bool loadLayerWeights(TinyAIMappedModel *model, int layerIndex)
+static bool readLayerData(const TinyAIMappedModel *model, const TinyAILayerDescriptor *layer,
+                          void *buffer);
+
+/*
+ * Load a layer's weights into memory. In zero-copy mode the weights are
+ * pinned in the mapping instead of copied; a layer that does not fit the
+ * cache is then still returned, just left to the page cache unpinned.
+ */
+static void *loadLayerWeights(TinyAIMappedModel *model, int layerIndex)
 {
     if (layerIndex < 0 || layerIndex >= model->layerCount) {
-        return false;
+        return NULL;
     }
 
     TinyAILayerDescriptor *layer = &model->layers[layerIndex];
@@ -192,22 +366,38 @@ static bool loadLayerWeights(TinyAIMappedModel *model, int layerIndex)
         layer->lastAccessed = model->timestamp;
         layer->accessCount++;
         layer->isActive = true;
-        return true;
+        return layer->cachedWeights;
     }
 
+    bool  mapped        = canMapLayer(model, layer);
+    void *mappedWeights = mapped ? (uint8_t *)model->mappedData + layer->offset : NULL;
+
     /* Make space in the cache */
     if (!ensureCacheSpace(model, layer->size)) {
-        return false;
+        if (mapped) {
+            layer->lastAccessed = model->timestamp;
+            layer->accessCount++;
+        }
+        return mappedWeights;
     }
 
-    /* Allocate memory for cached weights */
-    layer->cachedWeights = malloc(layer->size);
-    if (!layer->cachedWeights) {
-        return false;
+    if (mapped) {
+        /* Pin the layer in place */
+        adviseLayerPages(model, layer, true);
+        layer->cachedWeights = mappedWeights;
+    }
+    else {
+        /* Read, decompress or copy the layer into a buffer of its own */
+        void *buffer = allocLayerBuffer(model, layer->size);
+        if (!buffer) {
+            return NULL;
+        }
+        if (!readLayerData(model, layer, buffer)) {
+            freeLayerBuffer(model, buffer);
+            return NULL;
+        }
+        layer->cachedWeights = buffer;
     }
-
-    /* Copy from memory-mapped file */
-    memcpy(layer->cachedWeights, (uint8_t *)model->mappedData + layer->offset, layer->size);
 
     /* Update cache size and access statistics */
     model->currentCacheSize += layer->size;
@@ -215,7 +405,22 @@ static bool loadLayerWeights(TinyAIMappedModel *model, int layerIndex)
     layer->accessCount++;
     layer->isActive = true;
 
-    return true;
+    return layer->cachedWeights;
+}
+
+/* Fault a layer's pages in from the mapping */
+static void touchLayerPages(const TinyAIMappedModel *model, const TinyAILayerDescriptor *layer)
+{
+    if (layer->size == 0 || layer->offset >= model->mappedSize ||
+        layer->size > model->mappedSize - layer->offset) {
+        return;
+    }
+
+    const volatile uint8_t *data = (const volatile uint8_t *)model->mappedData + layer->offset;
+    for (size_t i = 0; i < layer->size; i += PREFETCH_TOUCH_STRIDE) {
+        (void)data[i];
+    }
+    (void)data[layer->size - 1];
 }
 
 /* Thread function for prefetching layers */
@@ -227,42 +432,88 @@ static void *prefetchThreadFunc(void *param)
 {
 #endif
     TinyAIMappedModel *model = (TinyAIMappedModel *)param;
+    tinyaiTraceSetThreadName("prefetch");
 
-    while (model->prefetchRunning) {
-        /* Lock the model */
-        lockModel(model);
-
-        /* Find the next layer to prefetch */
-        int layerToPrefetch = model->nextPrefetchLayer;
-
-        /* If we've prefetched all layers, start over */
-        if (layerToPrefetch >= model->layerCount) {
-            layerToPrefetch = 0;
+    lockModel(model);
+    while (true) {
+        /* Wait for a request */
+        while (model->prefetchRunning && model->prefetchCount == 0) {
+#ifdef _WIN32
+            SleepConditionVariableCS(&model->prefetchReady, &model->lock, INFINITE);
+#else
+            pthread_cond_wait(&model->prefetchReady, &model->lock);
+#endif
+        }
+        if (!model->prefetchRunning) {
+            break;
         }
 
-        model->nextPrefetchLayer = layerToPrefetch + 1;
+        int layerIndex      = model->prefetchQueue[model->prefetchHead];
+        model->prefetchHead = (model->prefetchHead + 1) % PREFETCH_QUEUE_SIZE;
+        model->prefetchCount--;
 
-        /* Skip if already cached */
-        bool shouldPrefetch = !model->layers[layerToPrefetch].cachedWeights;
+        /* Skip requests a lookup has already consumed */
+        if (model->prefetchState[layerIndex] != PREFETCH_QUEUED) {
+            continue;
+        }
+        model->prefetchState[layerIndex] = PREFETCH_LOADING;
+
+        /*
+         * Cache the layer only in free space: evicting could take away the
+         * weights of the layer being computed. The read backend reserves its
+         * buffer and the cache space now; a mapped layer left out of the
+         * cache still has its pages in the page cache.
+         */
+        TinyAILayerDescriptor *layer = &model->layers[layerIndex];
+
+        bool  buffered = model->file || isCompressedLayer(model, layerIndex);
+        bool  room     = !layer->cachedWeights &&
+                        model->currentCacheSize + layer->size <= model->config.maxCacheSize;
+        void *buffer   = buffered && room ? allocLayerBuffer(model, layer->size) : NULL;
+        if (buffer) {
+            model->currentCacheSize += layer->size;
+        }
 
-        /* Unlock before potentially long operation */
+        /* Read or decompress without holding the lock, so lookups and other threads go on */
         unlockModel(model);
+        uint64_t span   = TINYAI_TRACE_BEGIN();
+        bool     loaded = true;
+        if (buffered) {
+            loaded = buffer && readLayerData(model, layer, buffer);
+        }
+        else {
+            touchLayerPages(model, layer);
+        }
+        TINYAI_TRACE_END_ARG(span, "prefetch.layer", layerIndex);
+        lockModel(model);
 
-        /* Prefetch the layer if needed */
-        if (shouldPrefetch) {
-            /* Try to load, but don't force eviction of higher priority layers */
-            lockModel(model);
-            loadLayerWeights(model, layerToPrefetch);
-            unlockModel(model);
+        if (buffer) {
+            if (loaded && !layer->cachedWeights) {
+                layer->cachedWeights = buffer;
+                layer->lastAccessed  = model->timestamp;
+                layer->isActive      = true;
+            }
+            else {
+                freeLayerBuffer(model, buffer);
+                model->currentCacheSize -= layer->size;
+            }
+        }
+        else if (!buffered && !layer->cachedWeights &&
+                 model->currentCacheSize + layer->size <= model->config.maxCacheSize) {
+            loadLayerWeights(model, layerIndex);
         }
 
-        /* Sleep a bit to avoid hogging resources */
+        /* A buffered layer that is not cached is no further along than before */
+        model->prefetchState[layerIndex] =
+            buffered && !layer->cachedWeights ? PREFETCH_NONE : PREFETCH_READY;
+        model->prefetchStats.completed++;
 #ifdef _WIN32
-        Sleep(10);
+        WakeAllConditionVariable(&model->prefetchDone);
 #else
-        usleep(10000);
+        pthread_cond_broadcast(&model->prefetchDone);
 #endif
     }
+    unlockModel(model);
 
 #ifdef _WIN32
     _endthreadex(0);
@@ -272,75 +523,433 @@ static void *prefetchThreadFunc(void *param)
 #endif
 }
 
-/* Start the prefetch thread */
-static bool startPrefetchThread(TinyAIMappedModel *model)
+/* Start the prefetch threads */
+static bool startPrefetchThreads(TinyAIMappedModel *model)
 {
     if (!model->config.prefetchEnabled) {
         return true;
     }
 
-    model->prefetchRunning   = true;
-    model->nextPrefetchLayer = 0;
+    int threads = model->config.prefetchThreads;
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > TINYAI_MAX_PREFETCH_THREADS) {
+        threads = TINYAI_MAX_PREFETCH_THREADS;
+    }
 
+    model->prefetchRunning = true;
+    for (int i = 0; i < threads; i++) {
 #ifdef _WIN32
-    model->prefetchThread = (HANDLE)_beginthreadex(NULL, 0, prefetchThreadFunc, model, 0, NULL);
-    return model->prefetchThread != NULL;
+        model->prefetchThreads[i] =
+            (HANDLE)_beginthreadex(NULL, 0, prefetchThreadFunc, model, 0, NULL);
+        bool started = model->prefetchThreads[i] != NULL;
 #else
-    return pthread_create(&model->prefetchThread, NULL, prefetchThreadFunc, model) == 0;
+        bool started =
+            pthread_create(&model->prefetchThreads[i], NULL, prefetchThreadFunc, model) == 0;
 #endif
+        if (!started) {
+            return false;
+        }
+        model->numPrefetchThreads++;
+    }
+    return true;
 }
 
-/* Stop the prefetch thread */
-static void stopPrefetchThread(TinyAIMappedModel *model)
+/* Stop the prefetch threads */
+static void stopPrefetchThreads(TinyAIMappedModel *model)
 {
-    if (!model->prefetchRunning) {
-        return;
-    }
-
+    lockModel(model);
     model->prefetchRunning = false;
+#ifdef _WIN32
+    WakeAllConditionVariable(&model->prefetchReady);
+#else
+    pthread_cond_broadcast(&model->prefetchReady);
+#endif
+    unlockModel(model);
 
+    for (int i = 0; i < model->numPrefetchThreads; i++) {
 #ifdef _WIN32
-    WaitForSingleObject(model->prefetchThread, INFINITE);
-    CloseHandle(model->prefetchThread);
+        WaitForSingleObject(model->prefetchThreads[i], INFINITE);
+        CloseHandle(model->prefetchThreads[i]);
 #else
-    pthread_join(model->prefetchThread, NULL);
+        pthread_join(model->prefetchThreads[i], NULL);
 #endif
+    }
+    model->numPrefetchThreads = 0;
 }
 
-/* Implementation of public API */
+/* Continue a CRC-32 (IEEE 802.3, reflected) over more bytes; start from 0 */
+static uint32_t containerChecksum(uint32_t crc, const void *data, size_t size)
+{
+    uint32_t table[256];
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
 
-TinyAIMappedModel *tinyaiOpenMappedModel(const char *filepath, const TinyAIMmapConfig *config)
+    const uint8_t *bytes = (const uint8_t *)data;
+    crc ^= 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/* Round a file offset up to the container alignment */
+static uint64_t alignContainerOffset(uint64_t offset)
 {
-    if (!filepath) {
-        return NULL;
+    return (offset + TINYAI_CONTAINER_ALIGNMENT - 1) & ~(uint64_t)(TINYAI_CONTAINER_ALIGNMENT - 1);
+}
+
+/* Payload size of a tensor's data for its precision, layout and shape */
+static uint64_t containerDataSize(uint32_t precision, uint32_t layout, uint32_t rows,
+                                  uint32_t cols)
+{
+    switch (precision) {
+    case TINYAI_PRECISION_FP32:
+        return (uint64_t)rows * cols * sizeof(float);
+    case TINYAI_PRECISION_INT8:
+        return (uint64_t)rows * cols;
+    case TINYAI_PRECISION_INT4: {
+        TinyAIMatrix4bit shape = {0};
+        shape.rows             = rows;
+        shape.cols             = cols;
+        shape.layout           = (TinyAIMatrix4bitLayout)layout;
+        return tinyaiMatrix4bitDataSize(&shape);
     }
+    default:
+        return 0;
+    }
+}
 
-    /* Allocate model structure */
-    TinyAIMappedModel *model = (TinyAIMappedModel *)malloc(sizeof(TinyAIMappedModel));
-    if (!model) {
-        return NULL;
+/* Size of the scale arrays (and codebook levels) of a group-quantized tensor */
+static uint64_t containerScalesSize(const ContainerEntry *entry)
+{
+    if (entry->groupSize == 0) {
+        return 0;
     }
-    memset(model, 0, sizeof(TinyAIMappedModel));
+    uint64_t groups = (uint64_t)entry->rows * ((entry->cols + entry->groupSize - 1) /
+                                                 entry->groupSize);
+    return (2 * groups + (entry->hasLevels ? TINYAI_CODEBOOK_LEVELS : 0)) * sizeof(float);
+}
 
-    /* Copy configuration */
-    if (config) {
-        model->config = *config;
+/* Number of chunks of a compressed tensor's data */
+static size_t containerChunkCount(const ContainerEntry *entry)
+{
+    return (size_t)((entry->dataSize + entry->chunkSize - 1) / entry->chunkSize);
+}
+
+/* Uncompressed offset and size of a chunk */
+static size_t containerChunkSpan(const ContainerEntry *entry, size_t chunk, size_t *size)
+{
+    size_t begin = chunk * entry->chunkSize;
+    size_t end   = begin + entry->chunkSize;
+    *size        = (end < entry->dataSize ? end : (size_t)entry->dataSize) - begin;
+    return begin;
+}
+
+/* Compress a range of chunks, each into its own stride of the output */
+static void compressContainerChunks(void *context, size_t begin, size_t end)
+{
+    ContainerChunkTask *task = (ContainerChunkTask *)context;
+    for (size_t c = begin; c < end; c++) {
+        size_t size;
+        size_t offset = containerChunkSpan(task->entry, c, &size);
+        task->sizes[c] = tinyaiCompressBlock((TinyAICompression)task->entry->compression,
+                                             task->input + offset, size,
+                                             task->output + c * task->stride, task->stride);
     }
-    else {
-        model->config = tinyaiCreateDefaultMmapConfig();
+}
+
+/* Decompress a range of chunks straight into their place in the data */
+static void decompressContainerChunks(void *context, size_t begin, size_t end)
+{
+    ContainerChunkTask *task    = (ContainerChunkTask *)context;
+    const uint64_t     *offsets = (const uint64_t *)task->input;
+    for (size_t c = begin; c < end; c++) {
+        size_t size;
+        size_t offset  = containerChunkSpan(task->entry, c, &size);
+        task->sizes[c] = tinyaiDecompressBlock((TinyAICompression)task->entry->compression,
+                                               task->input + offsets[c],
+                                               (size_t)(offsets[c + 1] - offsets[c]),
+                                               task->output + offset, size);
     }
+}
 
-#ifdef _WIN32
-    /* Initialize critical section */
-    InitializeCriticalSection(&model->lock);
+/*
+ * Compress a tensor's data for writing: a table of chunkCount + 1 offsets
+ * from the start of the section, then the chunks, compressed in parallel
+ */
+static bool compressContainerData(const ContainerEntry *entry, ContainerSource *source)
+{
+    size_t   chunks  = containerChunkCount(entry);
+    size_t   table   = (chunks + 1) * sizeof(uint64_t);
+    size_t   stride  = tinyaiCompressBound((TinyAICompression)entry->compression, entry->chunkSize);
+    size_t  *sizes   = (size_t *)calloc(chunks, sizeof(size_t));
+    uint8_t *scratch = (uint8_t *)malloc(chunks * stride);
+    uint8_t *stored  = (uint8_t *)malloc(table + chunks * stride);
+    bool     ok      = sizes && scratch && stored;
+
+    if (ok) {
+        ContainerChunkTask task = {entry, (const uint8_t *)source->data, scratch, stride, sizes};
+        tinyaiParallelFor(tinyaiGetThreadPool(), chunks, 1, compressContainerChunks, &task);
+
+        /* Pack the chunks behind their offset table */
+        uint64_t *offsets = (uint64_t *)stored;
+        offsets[0]        = table;
+        for (size_t c = 0; ok && c < chunks; c++) {
+            ok = sizes[c] > 0;
+            memcpy(stored + offsets[c], scratch + c * stride, sizes[c]);
+            offsets[c + 1] = offsets[c] + sizes[c];
+        }
+        source->storedSize = (size_t)offsets[chunks];
+    }
+
+    free(sizes);
+    free(scratch);
+    if (!ok) {
+        free(stored);
+        return false;
+    }
+    source->stored = stored;
+    return true;
+}
 
+/*
+ * Decompress a tensor's data into a buffer of dataSize bytes. The mapping
+ * is decompressed in place; the read backend first reads the section into
+ * a temporary buffer. The offset table is checked against the file, and
+ * every chunk against its bounds, so a corrupt section fails cleanly.
+ */
+static bool decompressContainerData(const TinyAIMappedModel *model, const ContainerEntry *entry,
+                                    void *buffer)
+{
+    size_t   chunks    = containerChunkCount(entry);
+    size_t   table     = (chunks + 1) * sizeof(uint64_t);
+    uint64_t available = model->fileSize - entry->dataOffset;
+
+    const uint8_t *section = (const uint8_t *)model->mappedData + entry->dataOffset;
+    uint8_t       *stored  = NULL;
+    if (model->file) {
+        stored = (uint8_t *)malloc(table);
+        if (!stored || !tinyaiReadAsyncFile(model->file, stored, entry->dataOffset, table)) {
+            free(stored);
+            return false;
+        }
+        section = stored;
+    }
+
+    const uint64_t *offsets = (const uint64_t *)section;
+    bool            ok      = offsets[0] == table && offsets[chunks] <= available;
+    for (size_t c = 0; ok && c < chunks; c++) {
+        ok = offsets[c] <= offsets[c + 1];
+    }
+
+    if (ok && model->file) {
+        uint8_t *grown = (uint8_t *)realloc(stored, (size_t)offsets[chunks]);
+        ok             = grown != NULL;
+        if (ok) {
+            stored  = grown;
+            section = grown;
+            offsets = (const uint64_t *)grown;
+            ok = tinyaiReadAsyncFile(model->file, grown + table, entry->dataOffset + table,
+                                     (size_t)offsets[chunks] - table);
+        }
+    }
+
+    size_t *sizes = ok ? (size_t *)calloc(chunks, sizeof(size_t)) : NULL;
+    if (sizes) {
+        ContainerChunkTask task = {entry, section, (uint8_t *)buffer, 0, sizes};
+        tinyaiParallelFor(tinyaiGetThreadPool(), chunks, 1, decompressContainerChunks, &task);
+        for (size_t c = 0; c < chunks; c++) {
+            ok = ok && sizes[c];
+        }
+    }
+    ok = ok && sizes;
+
+    free(sizes);
+    free(stored);
+    return ok;
+}
+
+/* Fill a buffer with a layer's weights: decompressed, read from disk or copied from the mapping */
+static bool readLayerData(const TinyAIMappedModel *model, const TinyAILayerDescriptor *layer,
+                          void *buffer)
+{
+    if (isCompressedLayer(model, layer->layerIndex)) {
+        return decompressContainerData(model, &model->entries[layer->layerIndex], buffer);
+    }
+    if (model->file) {
+        return tinyaiReadAsyncFile(model->file, buffer, layer->offset, layer->size);
+    }
+    memcpy(buffer, (const uint8_t *)model->mappedData + layer->offset, layer->size);
+    return true;
+}
+
+/* Fill the index entry of a tensor (offsets excluded) */
+static bool describeContainerTensor(const TinyAIContainerTensor *tensor, ContainerEntry *entry,
+                                    ContainerSource *source)
+{
+    if (!tensor->name || !tensor->matrix ||
+        strlen(tensor->name) >= TINYAI_CONTAINER_NAME_SIZE) {
+        return false;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    strcpy(entry->name, tensor->name);
+    entry->precision = tensor->precision;
+    memset(source, 0, sizeof(*source));
+
+    switch (tensor->precision) {
+    case TINYAI_PRECISION_FP32: {
+        const TinyAIMatrixFP32 *matrix = (const TinyAIMatrixFP32 *)tensor->matrix;
+        entry->rows                    = matrix->rows;
+        entry->cols                    = matrix->cols;
+        source->data                   = matrix->data;
+        break;
+    }
+    case TINYAI_PRECISION_INT8: {
+        const TinyAIMatrix8bit *matrix = (const TinyAIMatrix8bit *)tensor->matrix;
+        entry->rows                    = matrix->rows;
+        entry->cols                    = matrix->cols;
+        entry->scale                   = matrix->scale;
+        entry->zeroPoint               = matrix->zeroPoint;
+        source->data                   = matrix->data;
+        break;
+    }
+    case TINYAI_PRECISION_INT4: {
+        const TinyAIMatrix4bit *matrix = (const TinyAIMatrix4bit *)tensor->matrix;
+        entry->layout                  = matrix->layout;
+        entry->rows                    = matrix->rows;
+        entry->cols                    = matrix->cols;
+        entry->scale                   = matrix->scale;
+        entry->zeroPoint               = matrix->zeroPoint;
+        source->data                   = matrix->data;
+        if (matrix->scales) {
+            entry->groupSize   = matrix->groupSize;
+            entry->hasLevels   = matrix->levels != NULL;
+            source->scales     = matrix->scales;
+            source->zeroPoints = matrix->zeroPoints;
+            source->levels     = matrix->levels;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    entry->dataSize   = containerDataSize(entry->precision, entry->layout, entry->rows,
+                                          entry->cols);
+    entry->scalesSize = containerScalesSize(entry);
+    return source->data != NULL && entry->dataSize > 0;
+}
+
+/* Write zero bytes up to a file offset */
+static bool padContainerFile(FILE *fp, uint64_t *position, uint64_t offset)
+{
+    static const uint8_t zeros[TINYAI_CONTAINER_ALIGNMENT] = {0};
+    while (*position < offset) {
+        size_t n = (size_t)(offset - *position < sizeof(zeros) ? offset - *position
+                                                                : sizeof(zeros));
+        if (fwrite(zeros, 1, n, fp) != n) {
+            return false;
+        }
+        *position += n;
+    }
+    return true;
+}
+
+/* Create the pool of layer buffers, sized for a full cache */
+static TinyAIMemoryPool *createWeightPool(const TinyAIMappedModel *model)
+{
+    TinyAIMemoryPoolConfig poolConfig;
+    tinyaiMemoryPoolGetDefaultConfig(&poolConfig);
+    poolConfig.initialCapacity =
+        model->config.maxCacheSize < model->fileSize ? model->config.maxCacheSize : model->fileSize;
+    poolConfig.maxCapacity      = 0;
+    poolConfig.allowGrowth      = true;
+    poolConfig.trackAllocations = false;
+    poolConfig.useHugePages     = model->config.hugePages;
+    return tinyaiMemoryPoolCreate(&poolConfig);
+}
+
+/* Validate a container's index against the mapped file and expose its tensors as layers */
+static bool openContainer(TinyAIMappedModel *model)
+{
+    const uint8_t         *base   = (const uint8_t *)model->mappedData;
+    const ContainerHeader *header = (const ContainerHeader *)base;
+    if (model->mappedSize < sizeof(ContainerHeader) || header->version < 1 ||
+        header->version > TINYAI_CONTAINER_VERSION ||
+        header->tensorCount > MAX_LAYERS || header->fileSize != model->fileSize ||
+        header->indexOffset % TINYAI_CONTAINER_ALIGNMENT != 0 ||
+        header->indexOffset > model->mappedSize ||
+        (model->mappedSize - header->indexOffset) / sizeof(ContainerEntry) < header->tensorCount) {
+        return false;
+    }
+
+    const ContainerEntry *entries    = (const ContainerEntry *)(base + header->indexOffset);
+    bool                  compressed = false;
+    for (uint32_t i = 0; i < header->tensorCount; i++) {
+        /* Compressed data is checked against the file when it is decompressed */
+        const ContainerEntry *entry = &entries[i];
+        uint64_t              stored = entry->dataSize;
+        if (entry->compression != TINYAI_COMPRESSION_NONE) {
+            if (!tinyaiCompressionAvailable((TinyAICompression)entry->compression) ||
+                entry->chunkSize == 0) {
+                return false;
+            }
+            stored     = (containerChunkCount(entry) + 1) * sizeof(uint64_t);
+            compressed = true;
+        }
+
+        if (memchr(entry->name, '\0', TINYAI_CONTAINER_NAME_SIZE) == NULL ||
+            entry->dataSize == 0 ||
+            entry->dataSize != containerDataSize(entry->precision, entry->layout, entry->rows,
+                                                 entry->cols) ||
+            entry->scalesSize != containerScalesSize(entry) ||
+            entry->dataOffset % TINYAI_CONTAINER_ALIGNMENT != 0 ||
+            entry->dataOffset > model->fileSize || stored > model->fileSize - entry->dataOffset ||
+            (entry->scalesSize > 0 &&
+             (entry->scalesOffset % TINYAI_CONTAINER_ALIGNMENT != 0 ||
+              entry->scalesOffset > model->fileSize ||
+              entry->scalesSize > model->fileSize - entry->scalesOffset))) {
+            return false;
+        }
+
+        static const int bits[] = {32, 8, 4};
+        model->layers[i].offset    = (size_t)entry->dataOffset;
+        model->layers[i].size      = (size_t)entry->dataSize;
+        model->layers[i].precision = bits[entry->precision];
+    }
+
+    /* Decompressed layers are cached in buffers from the weight pool */
+    if (compressed && !model->weightPool) {
+        model->weightPool = createWeightPool(model);
+        if (!model->weightPool) {
+            return false;
+        }
+    }
+
+    model->entries    = entries;
+    model->version    = header->version;
+    model->layerCount = header->tensorCount;
+    return true;
+}
+
+/* Map a model file into memory */
+static bool mapModelFile(TinyAIMappedModel *model, const char *filepath)
+{
+#ifdef _WIN32
     /* Open the file */
     model->fileHandle = CreateFile(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
                                    FILE_ATTRIBUTE_NORMAL, NULL);
 
     if (model->fileHandle == INVALID_HANDLE_VALUE) {
-        free(model);
-        return NULL;
+        return false;
     }
 
     /* Get file size */
@@ -354,8 +963,7 @@ TinyAIMappedModel *tinyaiOpenMappedModel(const char *filepath, const TinyAIMmapC
 
     if (!model->mappingHandle) {
         CloseHandle(model->fileHandle);
-        free(model);
-        return NULL;
+        return false;
     }
 
     /* Map the file into memory */
@@ -366,26 +974,20 @@ TinyAIMappedModel *tinyaiOpenMappedModel(const char *filepath, const TinyAIMmapC
     if (!model->mappedData) {
         CloseHandle(model->mappingHandle);
         CloseHandle(model->fileHandle);
-        free(model);
-        return NULL;
+        return false;
     }
 #else
-    /* Initialize mutex */
-    pthread_mutex_init(&model->lock, NULL);
-
     /* Open the file */
     model->fileDescriptor = open(filepath, O_RDONLY);
     if (model->fileDescriptor < 0) {
-        free(model);
-        return NULL;
+        return false;
     }
 
     /* Get file size */
     struct stat st;
     if (fstat(model->fileDescriptor, &st) < 0) {
         close(model->fileDescriptor);
-        free(model);
-        return NULL;
+        return false;
     }
     model->mappedSize = st.st_size;
 
@@ -395,57 +997,289 @@ TinyAIMappedModel *tinyaiOpenMappedModel(const char *filepath, const TinyAIMmapC
 
     if (model->mappedData == MAP_FAILED) {
         close(model->fileDescriptor);
-        free(model);
-        return NULL;
+        return false;
     }
+
+#ifdef MADV_HUGEPAGE
+    /* File-backed transparent huge pages depend on the filesystem; the advice may be refused */
+    if (model->config.hugePages &&
+        madvise(model->mappedData, model->mappedSize, MADV_HUGEPAGE) == 0) {
+        model->hugePageAdvisedSize = model->mappedSize;
+    }
+#endif
 #endif
 
-    /* Read model header and verify magic number */
-    uint32_t *header = (uint32_t *)model->mappedData;
-    if (header[0] != TINYAI_MODEL_MAGIC) {
-        /* Not a valid TinyAI model file */
-        tinyaiCloseMappedModel(model);
+    model->fileSize = model->mappedSize;
+    return true;
+
+}
+
+/*
+ * Open a model file for the read backend: read the header and the layer
+ * table or container index into memory, where the rest of the loader finds
+ * them as if mapped, and leave the weights on disk
+ */
+static bool openReadBackend(TinyAIMappedModel *model, const char *filepath)
+{
+#ifdef _WIN32
+    model->fileHandle = INVALID_HANDLE_VALUE;
+#else
+    model->fileDescriptor = -1;
+#endif
+
+    model->file = tinyaiOpenAsyncFile(filepath);
+    if (!model->file) {
+        return false;
+    }
+    model->fileSize = (size_t)tinyaiGetAsyncFileSize(model->file);
+
+    /* The header says how much follows it: the layer table or the container index */
+    uint32_t header[64] = {0};
+    size_t   size       = model->fileSize < sizeof(header) ? model->fileSize : sizeof(header);
+    if (!tinyaiReadAsyncFile(model->file, header, 0, size)) {
+        tinyaiCloseAsyncFile(model->file);
+        return false;
+    }
+    if (header[0] == TINYAI_MODEL_MAGIC && size == sizeof(header) && header[2] <= MAX_LAYERS) {
+        size = 256 + (size_t)header[2] * 32;
+    }
+    else if (header[0] == TINYAI_CONTAINER_MAGIC && size >= sizeof(ContainerHeader)) {
+        const ContainerHeader *container = (const ContainerHeader *)header;
+        if (container->tensorCount <= MAX_LAYERS && container->indexOffset <= model->fileSize) {
+            size = (size_t)container->indexOffset +
+                   (size_t)container->tensorCount * sizeof(ContainerEntry);
+        }
+    }
+    if (size > model->fileSize) {
+        /* Truncated */
+        tinyaiCloseAsyncFile(model->file);
+        return false;
+    }
+
+    model->mappedData = malloc(size);
+    model->mappedSize = size;
+    model->weightPool = createWeightPool(model);
+    if (!model->mappedData || !model->weightPool ||
+        !tinyaiReadAsyncFile(model->file, model->mappedData, 0, size)) {
+        free(model->mappedData);
+        tinyaiMemoryPoolDestroy(model->weightPool);
+        tinyaiCloseAsyncFile(model->file);
+        return false;
+    }
+    return true;
+}
+
+/* Implementation of public API */
+
+bool tinyaiWriteTensorContainer(const char *filepath, const TinyAIContainerTensor *tensors,
+                                uint32_t count, bool checksums)
+{
+    if (!filepath || (!tensors && count > 0) || count > MAX_LAYERS) {
+        return false;
+    }
+
+    ContainerEntry  *entries = (ContainerEntry *)calloc(count ? count : 1, sizeof(ContainerEntry));
+    ContainerSource *sources = (ContainerSource *)calloc(count ? count : 1, sizeof(ContainerSource));
+    if (!entries || !sources) {
+        free(entries);
+        free(sources);
+        return false;
+    }
+
+    /* Lay out the sections after the index */
+    ContainerHeader header = {0};
+    header.magic           = TINYAI_CONTAINER_MAGIC;
+    header.version         = TINYAI_CONTAINER_VERSION;
+    header.tensorCount     = count;
+    header.flags           = checksums ? CONTAINER_FLAG_CHECKSUMS : 0;
+    header.indexOffset     = alignContainerOffset(sizeof(ContainerHeader));
+
+    bool     ok     = true;
+    uint64_t offset = header.indexOffset + (uint64_t)count * sizeof(ContainerEntry);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        ContainerEntry *entry = &entries[i];
+        ok = describeContainerTensor(&tensors[i], entry, &sources[i]);
+        for (uint32_t j = 0; ok && j < i; j++) {
+            ok = strcmp(entries[j].name, entry->name) != 0;
+        }
+        if (ok && tensors[i].compression != TINYAI_COMPRESSION_NONE) {
+            entry->compression = tensors[i].compression;
+            entry->chunkSize   = TINYAI_CONTAINER_CHUNK_SIZE;
+            ok = tinyaiCompressionAvailable(tensors[i].compression) &&
+                 compressContainerData(entry, &sources[i]);
+        }
+        if (!ok) {
+            break;
+        }
+
+        entry->dataOffset = alignContainerOffset(offset);
+        offset = entry->dataOffset + (sources[i].stored ? sources[i].storedSize : entry->dataSize);
+        if (entry->scalesSize > 0) {
+            entry->scalesOffset = alignContainerOffset(offset);
+            offset              = entry->scalesOffset + entry->scalesSize;
+        }
+    }
+    header.fileSize = offset;
+
+    FILE *fp = ok ? fopen(filepath, "wb") : NULL;
+    ok       = fp != NULL;
+
+    /* Sections first, so the index can carry their checksums */
+    uint64_t position = 0;
+    uint64_t start    = header.indexOffset + (uint64_t)count * sizeof(ContainerEntry);
+    ok = ok && padContainerFile(fp, &position, start);
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const ContainerSource *source     = &sources[i];
+        ContainerEntry        *entry      = &entries[i];
+        const void            *stored     = source->stored ? source->stored : source->data;
+        size_t                 storedSize = source->stored ? source->storedSize
+                                                           : (size_t)entry->dataSize;
+        ok = padContainerFile(fp, &position, entry->dataOffset) &&
+             fwrite(stored, 1, storedSize, fp) == storedSize;
+        position += storedSize;
+        if (checksums) {
+            entry->dataChecksum = containerChecksum(0, source->data, (size_t)entry->dataSize);
+        }
+
+        if (ok && entry->scalesSize > 0) {
+            /* Scales, zero points and levels are contiguous in the file */
+            size_t groups = (size_t)entry->rows *
+                            ((entry->cols + entry->groupSize - 1) / entry->groupSize);
+            size_t levels = entry->hasLevels ? TINYAI_CODEBOOK_LEVELS : 0;
+            ok = padContainerFile(fp, &position, entry->scalesOffset) &&
+                 fwrite(source->scales, sizeof(float), groups, fp) == groups &&
+                 fwrite(source->zeroPoints, sizeof(float), groups, fp) == groups &&
+                 (levels == 0 || fwrite(source->levels, sizeof(float), levels, fp) == levels);
+            position += entry->scalesSize;
+            if (checksums) {
+                uint32_t crc = containerChecksum(0, source->scales, groups * sizeof(float));
+                crc = containerChecksum(crc, source->zeroPoints, groups * sizeof(float));
+                entry->scalesChecksum =
+                    levels ? containerChecksum(crc, source->levels, levels * sizeof(float)) : crc;
+            }
+        }
+    }
+
+    /* Then the header and the index */
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, fp) == 1 &&
+         fseek(fp, (long)header.indexOffset, SEEK_SET) == 0 &&
+         (count == 0 || fwrite(entries, sizeof(ContainerEntry), count, fp) == count);
+
+    if (fp && fclose(fp) != 0) {
+        ok = false;
+    }
+    if (fp && !ok) {
+        remove(filepath);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        free(sources[i].stored);
+    }
+    free(entries);
+    free(sources);
+    return ok;
+}
+
+
+TinyAIMappedModel *tinyaiOpenMappedModel(const char *filepath, const TinyAIMmapConfig *config)
+{
+    if (!filepath) {
         return NULL;
     }
 
-    /* Extract model metadata */
-    model->version    = header[1];
-    model->layerCount = header[2];
-    if (model->layerCount > MAX_LAYERS) {
-        /* Too many layers */
-        tinyaiCloseMappedModel(model);
+    /* Allocate model structure */
+    TinyAIMappedModel *model = (TinyAIMappedModel *)malloc(sizeof(TinyAIMappedModel));
+    if (!model) {
         return NULL;
     }
+    memset(model, 0, sizeof(TinyAIMappedModel));
 
-    /* Copy model name */
-    strncpy(model->modelName, (char *)(header + 4), 64);
-    model->modelName[63] = '\0';
+    /* Copy configuration */
+    if (config) {
+        model->config = *config;
+    }
+    else {
+        model->config = tinyaiCreateDefaultMmapConfig();
+    }
+
+#ifdef _WIN32
+    /* Initialize critical section */
+    InitializeCriticalSection(&model->lock);
+    InitializeConditionVariable(&model->prefetchReady);
+    InitializeConditionVariable(&model->prefetchDone);
+#else
+    /* Initialize mutex */
+    pthread_mutex_init(&model->lock, NULL);
+    pthread_cond_init(&model->prefetchReady, NULL);
+    pthread_cond_init(&model->prefetchDone, NULL);
+#endif
+
+    /* Map the file, or with the read backend read only its header and index */
+    bool opened = model->config.backend == TINYAI_WEIGHTS_READ ? openReadBackend(model, filepath)
+                                                               : mapModelFile(model, filepath);
+    if (!opened) {
+        free(model);
+        return NULL;
+    }
+
+    /* Quantized tensor containers carry their own index */
+    uint32_t *header = (uint32_t *)model->mappedData;
+    if (model->mappedSize >= sizeof(uint32_t) && header[0] == TINYAI_CONTAINER_MAGIC) {
+        if (!openContainer(model)) {
+            tinyaiCloseMappedModel(model);
+            return NULL;
+        }
+        strncpy(model->modelName, "container", sizeof(model->modelName));
+    }
+    else {
+        if (model->mappedSize < 256 || header[0] != TINYAI_MODEL_MAGIC) {
+            /* Not a valid TinyAI model file */
+            tinyaiCloseMappedModel(model);
+            return NULL;
+        }
+
+        /* Extract model metadata */
+        model->version    = header[1];
+        model->layerCount = header[2];
+        if (model->layerCount > MAX_LAYERS) {
+            /* Too many layers */
+            tinyaiCloseMappedModel(model);
+            return NULL;
+        }
+
+        /* Copy model name */
+        strncpy(model->modelName, (char *)(header + 4), 64);
+        model->modelName[63] = '\0';
+
+        /* Read layer descriptors */
+        uint8_t *ptr = (uint8_t *)model->mappedData + 256; /* Header size */
+        for (uint32_t i = 0; i < model->layerCount; i++) {
+            uint32_t *layerHeader      = (uint32_t *)ptr;
+            model->layers[i].offset    = layerHeader[0];
+            model->layers[i].size      = layerHeader[1];
+            model->layers[i].precision = layerHeader[2];
+            ptr += 32; /* Layer descriptor size */
+        }
+    }
 
-    /* Read layer descriptors */
-    uint8_t *ptr = (uint8_t *)model->mappedData + 256; /* Header size */
     for (uint32_t i = 0; i < model->layerCount; i++) {
-        uint32_t *layerHeader          = (uint32_t *)ptr;
-        model->layers[i].offset        = layerHeader[0];
-        model->layers[i].size          = layerHeader[1];
         model->layers[i].layerIndex    = i;
-        model->layers[i].precision     = layerHeader[2];
         model->layers[i].cachedWeights = NULL;
         model->layers[i].isActive      = false;
         model->layers[i].priority      = 1.0f;
         model->layers[i].lastAccessed  = 0;
         model->layers[i].accessCount   = 0;
-
-        ptr += 32; /* Layer descriptor size */
     }
 
     /* Initialize cache */
     model->currentCacheSize = 0;
     model->timestamp        = getCurrentTimestamp();
 
-    /* Start prefetch thread if enabled */
+    /* Start prefetch threads if enabled */
     if (model->config.prefetchEnabled) {
-        if (!startPrefetchThread(model)) {
-            /* Failed to start prefetch thread */
+        if (!startPrefetchThreads(model)) {
+            /* Failed to start prefetch threads */
             tinyaiCloseMappedModel(model);
             return NULL;
         }
@@ -460,17 +1294,26 @@ void tinyaiCloseMappedModel(TinyAIMappedModel *model)
         return;
     }
 
-    /* Stop prefetch thread */
+    /* Stop prefetch threads */
     if (model->prefetchRunning) {
-        stopPrefetchThread(model);
+        stopPrefetchThreads(model);
     }
 
     /* Free cached layer weights */
     for (uint32_t i = 0; i < model->layerCount; i++) {
-        if (model->layers[i].cachedWeights) {
+        if (model->layers[i].cachedWeights && !model->weightPool &&
+            !isMappedWeights(model, model->layers[i].cachedWeights)) {
             free(model->layers[i].cachedWeights);
-            model->layers[i].cachedWeights = NULL;
         }
+        model->layers[i].cachedWeights = NULL;
+    }
+
+    /* Release the read backend; layer buffers all live in the weight pool */
+    tinyaiMemoryPoolDestroy(model->weightPool);
+    if (model->file) {
+        tinyaiCloseAsyncFile(model->file);
+        free(model->mappedData);
+        model->mappedData = NULL;
     }
 
 #ifdef _WIN32
@@ -498,6 +1341,8 @@ void tinyaiCloseMappedModel(TinyAIMappedModel *model)
 
     /* Destroy mutex */
     pthread_mutex_destroy(&model->lock);
+    pthread_cond_destroy(&model->prefetchReady);
+    pthread_cond_destroy(&model->prefetchDone);
 #endif
 
     /* Free model structure */
@@ -529,17 +1374,42 @@ void *tinyaiGetLayerWeights(TinyAIMappedModel *model, int layerIndex)
         return NULL;
     }
 
+    /* Lock for thread safety */
+    lockModel(model);
+
     /* Update timestamp */
     model->timestamp = getCurrentTimestamp();
 
-    /* Lock for thread safety */
-    lockModel(model);
+    /* Wait for a prefetch thread that is reading the layer rather than read it twice */
+    bool waited = false;
+    while (model->prefetchState[layerIndex] == PREFETCH_LOADING) {
+        waited = true;
+#ifdef _WIN32
+        SleepConditionVariableCS(&model->prefetchDone, &model->lock, INFINITE);
+#else
+        pthread_cond_wait(&model->prefetchDone, &model->lock);
+#endif
+    }
 
-    /* Load layer weights if needed */
-    bool success = loadLayerWeights(model, layerIndex);
+    /* Count whether a prefetch got the layer in ahead of this lookup */
+    switch (waited ? PREFETCH_LOADING : model->prefetchState[layerIndex]) {
+    case PREFETCH_READY:
+        model->prefetchStats.hits++;
+        break;
+    case PREFETCH_QUEUED:
+    case PREFETCH_LOADING:
+        model->prefetchStats.late++;
+        break;
+    default:
+        if (!model->layers[layerIndex].cachedWeights) {
+            model->prefetchStats.misses++;
+        }
+        break;
+    }
+    model->prefetchState[layerIndex] = PREFETCH_NONE;
 
-    /* Get the cached weights */
-    void *weights = success ? model->layers[layerIndex].cachedWeights : NULL;
+    /* Load layer weights if needed */
+    void *weights = loadLayerWeights(model, layerIndex);
 
     /* Unlock */
     unlockModel(model);
@@ -557,7 +1427,7 @@ bool tinyaiPrefetchLayerWeights(TinyAIMappedModel *model, int layerIndex)
     lockModel(model);
 
     /* Try to load the layer */
-    bool success = loadLayerWeights(model, layerIndex);
+    bool success = loadLayerWeights(model, layerIndex) != NULL;
 
     /* Unlock */
     unlockModel(model);
@@ -565,6 +1435,78 @@ bool tinyaiPrefetchLayerWeights(TinyAIMappedModel *model, int layerIndex)
     return success;
 }
 
+bool tinyaiRequestLayerPrefetch(TinyAIMappedModel *model, int layerIndex)
+{
+    if (!model || layerIndex < 0 || layerIndex >= model->layerCount) {
+        return false;
+    }
+
+    /* Lock for thread safety */
+    lockModel(model);
+
+    bool queued = true;
+    if (model->numPrefetchThreads == 0) {
+        queued = false;
+    }
+    else if (model->layers[layerIndex].cachedWeights ||
+             model->prefetchState[layerIndex] != PREFETCH_NONE) {
+        /* Already resident or on its way */
+    }
+    else if (model->prefetchCount == PREFETCH_QUEUE_SIZE) {
+        model->prefetchStats.dropped++;
+        queued = false;
+    }
+    else {
+        int tail = (model->prefetchHead + model->prefetchCount) % PREFETCH_QUEUE_SIZE;
+        model->prefetchQueue[tail]       = layerIndex;
+        model->prefetchState[layerIndex] = PREFETCH_QUEUED;
+        model->prefetchCount++;
+        model->prefetchStats.requested++;
+#ifdef _WIN32
+        WakeConditionVariable(&model->prefetchReady);
+#else
+        pthread_cond_signal(&model->prefetchReady);
+#endif
+    }
+
+    /* Unlock */
+    unlockModel(model);
+
+    return queued;
+}
+
+bool tinyaiGetPrefetchStats(TinyAIMappedModel *model, TinyAIPrefetchStats *stats)
+{
+    if (!model || !stats) {
+        return false;
+    }
+
+    lockModel(model);
+    *stats = model->prefetchStats;
+    unlockModel(model);
+    return true;
+}
+
+bool tinyaiGetMappedModelHugePages(TinyAIMappedModel *model, size_t *hugePageBytes,
+                                   size_t *advisedBytes)
+{
+    if (!model || !hugePageBytes || !advisedBytes) {
+        return false;
+    }
+
+    lockModel(model);
+    *hugePageBytes = 0;
+    *advisedBytes  = model->hugePageAdvisedSize;
+    if (model->weightPool) {
+        TinyAIMemoryPoolStats stats;
+        tinyaiMemoryPoolGetStats(model->weightPool, &stats);
+        *hugePageBytes = stats.hugePageBytes;
+        *advisedBytes += stats.hugePageAdvisedBytes;
+    }
+    unlockModel(model);
+    return true;
+}
+
 void tinyaiReleaseLayerWeights(TinyAIMappedModel *model, int layerIndex)
 {
     if (!model || layerIndex < 0 || layerIndex >= model->layerCount) {
@@ -581,6 +1523,109 @@ void tinyaiReleaseLayerWeights(TinyAIMappedModel *model, int layerIndex)
     unlockModel(model);
 }
 
+int tinyaiFindMappedTensor(const TinyAIMappedModel *model, const char *name)
+{
+    if (!model || !model->entries || !name) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < model->layerCount; i++) {
+        if (strcmp(model->entries[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+bool tinyaiGetMappedTensor(const TinyAIMappedModel *model, int index, TinyAIMappedTensor *tensor)
+{
+    if (!model || !model->entries || model->file || !tensor || index < 0 ||
+        index >= (int)model->layerCount) {
+        return false;
+    }
+
+    const ContainerEntry *entry = &model->entries[index];
+    const uint8_t        *base  = (const uint8_t *)model->mappedData;
+
+    memset(tensor, 0, sizeof(*tensor));
+    tensor->name        = entry->name;
+    tensor->precision   = (TinyAIPrecision)entry->precision;
+    tensor->layout      = (TinyAIMatrix4bitLayout)entry->layout;
+    tensor->rows        = entry->rows;
+    tensor->cols        = entry->cols;
+    tensor->compression = (TinyAICompression)entry->compression;
+    tensor->data        = entry->compression == TINYAI_COMPRESSION_NONE ? base + entry->dataOffset
+                                                                        : NULL;
+    tensor->dataSize    = (size_t)entry->dataSize;
+    tensor->scale       = entry->scale;
+    tensor->zeroPoint   = entry->zeroPoint;
+
+    if (entry->scalesSize > 0) {
+        size_t groups =
+            (size_t)entry->rows * ((entry->cols + entry->groupSize - 1) / entry->groupSize);
+        tensor->groupSize  = entry->groupSize;
+        tensor->scales     = (const float *)(base + entry->scalesOffset);
+        tensor->zeroPoints = tensor->scales + groups;
+        tensor->levels     = entry->hasLevels ? tensor->zeroPoints + groups : NULL;
+    }
+    return true;
+}
+
+bool tinyaiGetMappedMatrix4bit(const TinyAIMappedModel *model, int index,
+                               TinyAIMatrix4bit *matrix)
+{
+    TinyAIMappedTensor tensor;
+    if (!matrix || !tinyaiGetMappedTensor(model, index, &tensor) ||
+        tensor.precision != TINYAI_PRECISION_INT4 || !tensor.data) {
+        return false;
+    }
+
+    /* The kernels only read through these pointers */
+    matrix->data       = (uint8_t *)tensor.data;
+    matrix->rows       = tensor.rows;
+    matrix->cols       = tensor.cols;
+    matrix->scale      = tensor.scale;
+    matrix->zeroPoint  = tensor.zeroPoint;
+    matrix->scales     = (float *)tensor.scales;
+    matrix->zeroPoints = (float *)tensor.zeroPoints;
+    matrix->groupSize  = tensor.groupSize;
+    matrix->levels     = (float *)tensor.levels;
+    matrix->layout     = tensor.layout;
+    return true;
+}
+
+bool tinyaiVerifyMappedTensor(const TinyAIMappedModel *model, int index)
+{
+    if (!model || !model->entries || model->file || index < 0 ||
+        index >= (int)model->layerCount) {
+        return false;
+    }
+
+    const ContainerHeader *header = (const ContainerHeader *)model->mappedData;
+    if (!(header->flags & CONTAINER_FLAG_CHECKSUMS)) {
+        return true;
+    }
+
+    const ContainerEntry *entry = &model->entries[index];
+    const uint8_t        *base  = (const uint8_t *)model->mappedData;
+    if (entry->compression != TINYAI_COMPRESSION_NONE) {
+        void *data = malloc((size_t)entry->dataSize);
+        bool  ok   = data && decompressContainerData(model, entry, data) &&
+                  containerChecksum(0, data, (size_t)entry->dataSize) == entry->dataChecksum;
+        free(data);
+        if (!ok) {
+            return false;
+        }
+    }
+    else if (containerChecksum(0, base + entry->dataOffset, (size_t)entry->dataSize) !=
+             entry->dataChecksum) {
+        return false;
+    }
+    return entry->scalesSize == 0 ||
+           containerChecksum(0, base + entry->scalesOffset, (size_t)entry->scalesSize) ==
+               entry->scalesChecksum;
+}
+
 TinyAIMmapConfig tinyaiCreateDefaultMmapConfig(void)
 {
     TinyAIMmapConfig config;
@@ -600,6 +1645,15 @@ TinyAIMmapConfig tinyaiCreateDefaultMmapConfig(void)
     /* Minimum 4KB per layer cache */
     config.minLayerCacheSize = 4 * 1024;
 
+    /* Hand out weights in place in the mapping */
+    config.zeroCopy = true;
+
+    /* Map the file */
+    config.backend = TINYAI_WEIGHTS_MMAP;
+
+    /* Use the system's page size */
+    config.hugePages = false;
+
     return config;
 }
 
@@ -612,6 +1666,64 @@ size_t tinyaiGetMappedModelMemoryUsage(const TinyAIMappedModel *model)
     return model->currentCacheSize;
 }
 
+size_t tinyaiGetMappingResidentBytes(const void *address, size_t size)
+{
+    if (!address || size == 0) {
+        return 0;
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t    pageSize = info.dwPageSize;
+    uintptr_t start    = (uintptr_t)address & ~(uintptr_t)(pageSize - 1);
+    size_t    pages    = ((uintptr_t)address + size - start + pageSize - 1) / pageSize;
+
+    /* Ask for the working-set state of the pages a batch at a time */
+    PSAPI_WORKING_SET_EX_INFORMATION batch[256];
+    size_t                           resident = 0;
+    for (size_t first = 0; first < pages; first += 256) {
+        size_t count = pages - first < 256 ? pages - first : 256;
+        for (size_t i = 0; i < count; i++) {
+            batch[i].VirtualAddress = (PVOID)(start + (first + i) * pageSize);
+        }
+        if (!K32QueryWorkingSetEx(GetCurrentProcess(), batch, (DWORD)(count * sizeof(batch[0])))) {
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            resident += batch[i].VirtualAttributes.Valid ? pageSize : 0;
+        }
+    }
+    return resident;
+#elif defined(__linux__) || defined(__APPLE__)
+    size_t    pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start    = (uintptr_t)address & ~(uintptr_t)(pageSize - 1);
+    size_t    length   = (uintptr_t)address + size - start;
+    size_t    pages    = (length + pageSize - 1) / pageSize;
+
+#ifdef __APPLE__
+    char *vector = (char *)malloc(pages);
+#else
+    unsigned char *vector = (unsigned char *)malloc(pages);
+#endif
+    if (!vector) {
+        return 0;
+    }
+
+    size_t resident = 0;
+    if (mincore((void *)start, length, vector) == 0) {
+        for (size_t i = 0; i < pages; i++) {
+            resident += (vector[i] & 1) ? pageSize : 0;
+        }
+    }
+    free(vector);
+    return resident;
+#else
+    (void)address;
+    return 0;
+#endif
+}
+
 void tinyaiSetLayerPriority(TinyAIMappedModel *model, int layerIndex, float priority)
 {
     if (!model || layerIndex < 0 || layerIndex >= model->layerCount) {
@@ -9,6 +9,8 @@
 #ifndef TINYAI_MMAP_LOADER_H
 #define TINYAI_MMAP_LOADER_H
 
+#include "compress.h"
+#include "quantize.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -37,20 +39,130 @@ typedef struct {
     uint64_t accessCount;   /* Number of times this layer has been accessed */
 } TinyAILayerDescriptor;
 
+/**
+ * Most prefetch threads a mapped model runs
+ */
+#define TINYAI_MAX_PREFETCH_THREADS 8
+
+/**
+ * How a model's weights are brought into memory
+ */
+typedef enum {
+    TINYAI_WEIGHTS_MMAP, /* Map the file; the page cache backs every layer */
+    TINYAI_WEIGHTS_READ  /* Read layers into aligned buffers with batched asynchronous I/O */
+} TinyAIWeightBackend;
+
 /**
  * Memory-mapped model configuration
  */
 typedef struct {
-    size_t maxCacheSize;      /* Maximum size of in-memory cache in bytes */
-    bool   prefetchEnabled;   /* Whether to enable weight prefetching */
-    int    prefetchThreads;   /* Number of threads to use for prefetching */
-    bool   adaptiveCaching;   /* Whether to use adaptive caching based on access patterns */
-    size_t minLayerCacheSize; /* Minimum cache size per layer in bytes */
+    size_t              maxCacheSize;      /* Maximum size of in-memory cache in bytes */
+    bool                prefetchEnabled;   /* Whether to enable weight prefetching */
+    int                 prefetchThreads;   /* Prefetch threads, up to TINYAI_MAX_PREFETCH_THREADS */
+    bool                adaptiveCaching;   /* Whether to adapt caching to access patterns */
+    size_t              minLayerCacheSize; /* Minimum cache size per layer in bytes */
+    bool                zeroCopy;          /* Return weights in place in the mapping, not copied */
+    TinyAIWeightBackend backend;           /* Map the file, or read it where mapping is slow */
+    bool                hugePages;         /* Ask for 2MB pages for the mapping and layer cache */
 } TinyAIMmapConfig;
 
+/**
+ * Prefetch statistics of a mapped model
+ *
+ * Every weight lookup of a layer that was requested for prefetch counts as
+ * a hit or as late; lookups that have to read a layer neither cached nor
+ * requested count as misses.
+ */
+typedef struct {
+    uint64_t requested; /* Requests queued */
+    uint64_t dropped;   /* Requests dropped because the queue was full */
+    uint64_t completed; /* Requests the prefetch threads finished */
+    uint64_t hits;      /* Lookups of a layer whose prefetch had finished */
+    uint64_t late;      /* Lookups that found the layer still queued, or waited for its read */
+    uint64_t misses;    /* Lookups that read a layer from disk unannounced */
+} TinyAIPrefetchStats;
+
+/**
+ * Quantized tensor container
+ *
+ * A versioned file of named tensors: a 64-byte header, an index with one
+ * 128-byte entry per tensor (name, precision, layout, shape, scale and zero
+ * point, offsets of the data and of the per-group scale arrays), then every
+ * tensor's sections at TINYAI_CONTAINER_ALIGNMENT-byte offsets. Sections
+ * may carry CRC-32 checksums, checked on request by tinyaiVerifyMappedTensor
+ * so that opening a file never touches its payload.
+ *
+ * Since version 2 a tensor's data may be stored compressed, as independent
+ * chunks of TINYAI_CONTAINER_CHUNK_SIZE bytes behind a table of their
+ * offsets. Compressed tensors are decompressed into the layer cache by
+ * tinyaiGetLayerWeights, their chunks in parallel on the shared thread pool;
+ * uncompressed tensors are still mapped in place.
+ */
+#define TINYAI_CONTAINER_MAGIC 0x43545154 /* "TQTC" in ASCII */
+#define TINYAI_CONTAINER_VERSION 2
+#define TINYAI_CONTAINER_ALIGNMENT 64
+#define TINYAI_CONTAINER_NAME_SIZE 48
+#define TINYAI_CONTAINER_CHUNK_SIZE (256 * 1024)
+
+/**
+ * Tensor written by tinyaiWriteTensorContainer
+ */
+typedef struct {
+    const char       *name;        /* Unique name, shorter than TINYAI_CONTAINER_NAME_SIZE */
+    const void       *matrix;      /* TinyAIMatrixFP32, TinyAIMatrix8bit or TinyAIMatrix4bit */
+    TinyAIPrecision   precision;   /* TINYAI_PRECISION_FP32, _INT8 or _INT4 */
+    TinyAICompression compression; /* Codec of the stored data (NONE: mappable in place) */
+} TinyAIContainerTensor;
+
+/**
+ * Tensor of a mapped container, pointing into the read-only mapping
+ *
+ * The data of a compressed tensor is not in the mapping: it is obtained
+ * from tinyaiGetLayerWeights with the tensor's index.
+ */
+typedef struct {
+    const char            *name;        /* Tensor name */
+    TinyAIPrecision        precision;   /* TINYAI_PRECISION_FP32, _INT8 or _INT4 */
+    TinyAIMatrix4bitLayout layout;      /* Layout of 4-bit data */
+    uint32_t               rows;        /* Number of rows */
+    uint32_t               cols;        /* Number of columns */
+    TinyAICompression      compression; /* Codec of the stored data */
+    const void            *data;        /* Payload, aligned (NULL when compressed) */
+    size_t                 dataSize;    /* Payload size in bytes, uncompressed */
+    float                  scale;       /* Scale (INT8 and INT4) */
+    float                  zeroPoint;   /* Zero point (INT8 and INT4) */
+    uint32_t               groupSize;   /* Columns per group (0 when not group-quantized) */
+    const float           *scales;      /* Per-group scales (NULL when not group-quantized) */
+    const float           *zeroPoints;  /* Per-group zero points */
+    const float           *levels;      /* Codebook levels (NULL for linear levels) */
+} TinyAIMappedTensor;
+
+/**
+ * Write tensors to a quantized tensor container
+ *
+ * 4-bit matrices keep their layout, so prepacked panels are mapped back
+ * ready for the panel kernels. Compressed tensors keep their scale arrays
+ * uncompressed.
+ *
+ * @param filepath Path of the container to create
+ * @param tensors Tensors to write
+ * @param count Number of tensors (at most 256)
+ * @param checksums Whether to store a CRC-32 of every section (of compressed data, uncompressed)
+ * @return true on success, false on failure or if a codec is not available
+ */
+bool tinyaiWriteTensorContainer(const char *filepath, const TinyAIContainerTensor *tensors,
+                                uint32_t count, bool checksums);
+
 /**
  * Open a memory-mapped model file
  *
+ * Accepts both the layer file format and quantized tensor containers; the
+ * tensors of a container are also its layers, in index order. With the
+ * TINYAI_WEIGHTS_READ backend only the header and index stay in memory:
+ * layers are read on demand into TINYAI_CONTAINER_ALIGNMENT-aligned buffers
+ * from a memory pool, through io_uring on Linux and overlapped I/O on
+ * Windows, and tensor views of a container are unavailable.
+ *
  * @param filepath Path to the model file
  * @param config Memory-mapped loading configuration
  * @return Pointer to the memory-mapped model structure, or NULL on failure
@@ -85,6 +197,11 @@ const TinyAILayerDescriptor *tinyaiGetLayerDescriptor(const TinyAIMappedModel *m
 /**
  * Get pointer to a layer's weights, loading from disk if necessary
  *
+ * With zeroCopy set, a layer whose offset is aligned for its elements is
+ * returned in place: the pointer is into the read-only mapping, valid until
+ * the model is closed and must not be written. Caching then pins the layer's
+ * pages rather than copying them, and releasing it lets the OS drop them.
+ *
  * @param model Pointer to the memory-mapped model
  * @param layerIndex Index of the layer to load
  * @return Pointer to the layer weights, or NULL on error
@@ -100,6 +217,44 @@ void *tinyaiGetLayerWeights(TinyAIMappedModel *model, int layerIndex);
  */
 bool tinyaiPrefetchLayerWeights(TinyAIMappedModel *model, int layerIndex);
 
+/**
+ * Ask the prefetch threads to read a layer's weights in the background
+ *
+ * Returns at once. The threads fault the layer's pages in and cache it when
+ * the cache has room, without evicting anything.
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param layerIndex Index of the layer to prefetch
+ * @return true if the layer is queued, cached or already being read; false
+ *         if prefetching is disabled or the queue is full
+ */
+bool tinyaiRequestLayerPrefetch(TinyAIMappedModel *model, int layerIndex);
+
+/**
+ * Get the prefetch statistics of a mapped model
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param stats Output statistics
+ * @return true on success, false on error
+ */
+bool tinyaiGetPrefetchStats(TinyAIMappedModel *model, TinyAIPrefetchStats *stats);
+
+/**
+ * Get how much of a mapped model ended up on huge pages
+ *
+ * With hugePages set, the layer cache is allocated as by tinyaiMemoryPoolCreate
+ * with useHugePages, and the file mapping is advised to use transparent huge
+ * pages, which the kernel honours only for filesystems that support them.
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param hugePageBytes Output bytes of the layer cache on reserved huge pages
+ * @param advisedBytes Output bytes of the mapping and layer cache advised to use
+ *                     transparent huge pages
+ * @return true on success, false on error
+ */
+bool tinyaiGetMappedModelHugePages(TinyAIMappedModel *model, size_t *hugePageBytes,
+                                   size_t *advisedBytes);
+
 /**
  * Release a layer's weights from memory to free up space
  *
@@ -108,6 +263,53 @@ bool tinyaiPrefetchLayerWeights(TinyAIMappedModel *model, int layerIndex);
  */
 void tinyaiReleaseLayerWeights(TinyAIMappedModel *model, int layerIndex);
 
+/**
+ * Find a tensor of a mapped container by name
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param name Tensor name
+ * @return Tensor (and layer) index, or -1 if absent or not a container
+ */
+int tinyaiFindMappedTensor(const TinyAIMappedModel *model, const char *name);
+
+/**
+ * Describe a tensor of a mapped container
+ *
+ * The pointers stay valid until the model is closed.
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param index Tensor index
+ * @param tensor Output tensor description
+ * @return true on success, false on error
+ */
+bool tinyaiGetMappedTensor(const TinyAIMappedModel *model, int index, TinyAIMappedTensor *tensor);
+
+/**
+ * View a mapped 4-bit tensor as a matrix for the 4-bit kernels
+ *
+ * No data is copied: the matrix points into the read-only mapping, so it is
+ * valid until the model is closed and must not be modified, prepacked or
+ * released.
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param index Tensor index
+ * @param matrix Output matrix
+ * @return true on success, false if the tensor is not 4-bit or is compressed
+ */
+bool tinyaiGetMappedMatrix4bit(const TinyAIMappedModel *model, int index,
+                               TinyAIMatrix4bit *matrix);
+
+/**
+ * Check a mapped tensor's sections against their stored checksums
+ *
+ * Compressed data is decompressed into a temporary buffer to be checked.
+ *
+ * @param model Pointer to the memory-mapped model
+ * @param index Tensor index
+ * @return true if the checksums match or none were stored, false otherwise
+ */
+bool tinyaiVerifyMappedTensor(const TinyAIMappedModel *model, int index);
+
 /**
  * Create a default memory-mapped model configuration
  *
@@ -123,6 +325,18 @@ TinyAIMmapConfig tinyaiCreateDefaultMmapConfig(void);
  */
 size_t tinyaiGetMappedModelMemoryUsage(const TinyAIMappedModel *model);
 
+/**
+ * Get how much of a mapped range is resident in physical memory
+ *
+ * Works on any mapping, such as the zero-copy weights of a mapped model or
+ * a model snapshot. Pages the range only partly covers count whole.
+ *
+ * @param address Start of the range
+ * @param size Size of the range in bytes
+ * @return Resident bytes, or 0 where residency cannot be measured
+ */
+size_t tinyaiGetMappingResidentBytes(const void *address, size_t size);
+
 /**
  * Set layer access priority for caching
  *
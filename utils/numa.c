@@ -0,0 +1,519 @@
+/**
+ * @file numa.c
+ * @brief Implementation of NUMA topology, memory placement and weight replicas
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* sched_getcpu, CPU_SET */
+#endif
+
+#include "numa.h"
+#include "../core/config.h"
+#include "../core/memory.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+
+/* Memory policies of the mbind system call, from linux/mempolicy.h */
+#define MPOL_BIND 2
+#define MPOL_INTERLEAVE 3
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+/* Initial slots of the replica table; it doubles when half full */
+#define REPLICA_TABLE_MIN 64
+
+/* Node topology, discovered once */
+typedef struct {
+    int nodeCount;
+#ifdef _WIN32
+    GROUP_AFFINITY affinity[TINYAI_NUMA_MAX_NODES];
+#elif defined(__linux__)
+    cpu_set_t cpus[TINYAI_NUMA_MAX_NODES];
+    int8_t    cpuNode[CPU_SETSIZE]; /* Node of each CPU */
+#endif
+} NumaTopology;
+
+/* Copies of one replicated region, keyed by the original */
+typedef struct {
+    const void *data;
+    size_t      size;
+    void       *copies[TINYAI_NUMA_MAX_NODES];
+} NumaReplica;
+
+static NumaTopology g_topology;
+#ifdef _WIN32
+static INIT_ONCE g_topologyOnce = INIT_ONCE_STATIC_INIT;
+static SRWLOCK   g_replicaLock  = SRWLOCK_INIT;
+static volatile LONG g_replicaCount;
+#else
+static pthread_once_t   g_topologyOnce = PTHREAD_ONCE_INIT;
+static pthread_rwlock_t g_replicaLock  = PTHREAD_RWLOCK_INITIALIZER;
+static size_t           g_replicaCount;
+#endif
+
+/* Open-addressed table of replicas, guarded by g_replicaLock */
+static NumaReplica *g_replicas;
+static size_t       g_replicaSlots;
+
+#ifdef __linux__
+/* Parse a sysfs CPU list such as "0-3,8-11" into a set */
+static void parseCpuList(const char *list, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+    while (*list) {
+        char *end;
+        long  first = strtol(list, &end, 10);
+        if (end == list) {
+            break;
+        }
+        long last = first;
+        if (*end == '-') {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET((int)cpu, cpus);
+        }
+        list = *end == ',' ? end + 1 : end;
+    }
+}
+#endif
+
+/* Discover the nodes and their CPUs */
+#ifdef _WIN32
+static BOOL CALLBACK discoverTopology(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+    (void)once;
+    (void)param;
+    (void)context;
+
+    ULONG highest = 0;
+    g_topology.nodeCount = 1;
+    if (GetNumaHighestNodeNumber(&highest)) {
+        g_topology.nodeCount =
+            (int)(highest + 1 < TINYAI_NUMA_MAX_NODES ? highest + 1 : TINYAI_NUMA_MAX_NODES);
+    }
+    for (int node = 0; node < g_topology.nodeCount; node++) {
+        GetNumaNodeProcessorMaskEx((USHORT)node, &g_topology.affinity[node]);
+    }
+    return TRUE;
+}
+#else
+static void discoverTopology(void)
+{
+    g_topology.nodeCount = 1;
+
+#ifdef __linux__
+    memset(g_topology.cpuNode, 0, sizeof(g_topology.cpuNode));
+    for (int node = 0; node < TINYAI_NUMA_MAX_NODES; node++) {
+        char path[64];
+        char list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+        FILE *fp = fopen(path, "r");
+        if (!fp) {
+            continue;
+        }
+        size_t length = fread(list, 1, sizeof(list) - 1, fp);
+        fclose(fp);
+        list[length] = '\0';
+
+        parseCpuList(list, &g_topology.cpus[node]);
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &g_topology.cpus[node])) {
+                g_topology.cpuNode[cpu] = (int8_t)node;
+            }
+        }
+        g_topology.nodeCount = node + 1;
+    }
+#endif
+}
+#endif
+
+/* Get the topology, discovering it on first use */
+static const NumaTopology *topology(void)
+{
+#ifdef _WIN32
+    InitOnceExecuteOnce(&g_topologyOnce, discoverTopology, NULL, NULL);
+#else
+    pthread_once(&g_topologyOnce, discoverTopology);
+#endif
+    return &g_topology;
+}
+
+#ifdef __linux__
+/* Set the memory policy of a page-aligned range */
+static bool bindPages(void *start, size_t length, int node, unsigned flags)
+{
+    const NumaTopology *topo = topology();
+    unsigned long       mask = 0;
+    int                 mode = MPOL_BIND;
+
+    if (node < 0) {
+        mode = MPOL_INTERLEAVE;
+        for (int i = 0; i < topo->nodeCount; i++) {
+            mask |= 1UL << i;
+        }
+    }
+    else {
+        mask = 1UL << node;
+    }
+    return syscall(SYS_mbind, start, length, mode, &mask, sizeof(mask) * 8 + 1, flags) == 0;
+}
+#endif
+
+TinyAINumaMode tinyaiNumaGetMode(void)
+{
+    if (tinyaiNumaNodeCount() < 2) {
+        return TINYAI_NUMA_OFF;
+    }
+
+    const char *mode = tinyaiConfigGetString("system.numa", "off");
+    if (strcmp(mode, "interleave") == 0) {
+        return TINYAI_NUMA_INTERLEAVE;
+    }
+    if (strcmp(mode, "replicate") == 0) {
+        return TINYAI_NUMA_REPLICATE;
+    }
+    return TINYAI_NUMA_OFF;
+}
+
+int tinyaiNumaNodeCount(void) { return topology()->nodeCount; }
+
+int tinyaiNumaCurrentNode(void)
+{
+    const NumaTopology *topo = topology();
+    if (topo->nodeCount < 2) {
+        return 0;
+    }
+
+#ifdef _WIN32
+    PROCESSOR_NUMBER processor;
+    USHORT           node = 0;
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node) || node >= topo->nodeCount) {
+        return 0;
+    }
+    return (int)node;
+#elif defined(__linux__)
+    int cpu = sched_getcpu();
+    return cpu >= 0 && cpu < CPU_SETSIZE ? topo->cpuNode[cpu] : 0;
+#else
+    return 0;
+#endif
+}
+
+bool tinyaiNumaBindThread(int node)
+{
+    const NumaTopology *topo = topology();
+    if (node < 0 || node >= topo->nodeCount) {
+        return false;
+    }
+
+#ifdef _WIN32
+    return topo->affinity[node].Mask != 0 &&
+           SetThreadGroupAffinity(GetCurrentThread(), &topo->affinity[node], NULL);
+#elif defined(__linux__)
+    return CPU_COUNT(&topo->cpus[node]) > 0 &&
+           sched_setaffinity(0, sizeof(cpu_set_t), &topo->cpus[node]) == 0;
+#else
+    return false;
+#endif
+}
+
+bool tinyaiNumaBindThreadToCpu(int cpu)
+{
+    if (cpu < 0) {
+        return false;
+    }
+
+#ifdef _WIN32
+    return cpu < (int)(8 * sizeof(DWORD_PTR)) &&
+           SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return sched_setaffinity(0, sizeof(cpu_set_t), &cpus) == 0;
+#else
+    return false;
+#endif
+}
+
+void *tinyaiNumaAlloc(size_t size, int node)
+{
+    if (size == 0 || node >= tinyaiNumaNodeCount()) {
+        return NULL;
+    }
+
+#ifdef _WIN32
+    if (node < 0) {
+        return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+    return VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT,
+                              PAGE_READWRITE, (DWORD)node);
+#else
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+#ifdef __linux__
+    /* No pages exist yet, so the policy places every one as it is first touched */
+    if (tinyaiNumaNodeCount() > 1) {
+        bindPages(memory, size, node, 0);
+    }
+#endif
+    return memory;
+#endif
+}
+
+void tinyaiNumaFree(void *ptr, size_t size)
+{
+    if (!ptr) {
+        return;
+    }
+
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+bool tinyaiNumaPlace(void *data, size_t size, int node)
+{
+    if (!data || size == 0 || node >= tinyaiNumaNodeCount()) {
+        return false;
+    }
+
+#ifdef __linux__
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start    = ((uintptr_t)data + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t end      = ((uintptr_t)data + size) & ~(pageSize - 1);
+    if (end <= start) {
+        return false;
+    }
+    return bindPages((void *)start, end - start, node, MPOL_MF_MOVE);
+#else
+    /* Existing pages cannot be moved between nodes here */
+    return false;
+#endif
+}
+
+/* Lock the replica table for lookups */
+static void lockReplicasShared(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockShared(&g_replicaLock);
+#else
+    pthread_rwlock_rdlock(&g_replicaLock);
+#endif
+}
+
+/* Unlock the replica table after lookups */
+static void unlockReplicasShared(void)
+{
+#ifdef _WIN32
+    ReleaseSRWLockShared(&g_replicaLock);
+#else
+    pthread_rwlock_unlock(&g_replicaLock);
+#endif
+}
+
+/* Lock the replica table for changes */
+static void lockReplicas(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&g_replicaLock);
+#else
+    pthread_rwlock_wrlock(&g_replicaLock);
+#endif
+}
+
+/* Unlock the replica table after changes */
+static void unlockReplicas(void)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&g_replicaLock);
+#else
+    pthread_rwlock_unlock(&g_replicaLock);
+#endif
+}
+
+/* Number of replicated regions, read without the lock so kernels skip the lookup when zero */
+static size_t replicaCount(void)
+{
+#ifdef _WIN32
+    return (size_t)InterlockedCompareExchange(&g_replicaCount, 0, 0);
+#else
+    return __atomic_load_n(&g_replicaCount, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/* Update the replica count (table lock held) */
+static void setReplicaCount(size_t count)
+{
+#ifdef _WIN32
+    InterlockedExchange(&g_replicaCount, (LONG)count);
+#else
+    __atomic_store_n(&g_replicaCount, count, __ATOMIC_RELEASE);
+#endif
+}
+
+/* Home slot of an address in the replica table */
+static size_t replicaHash(const void *data)
+{
+    uint64_t key = (uint64_t)(uintptr_t)data;
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (size_t)key & (g_replicaSlots - 1);
+}
+
+/* Find the slot of an address, or the empty slot where it would go (table lock held) */
+static NumaReplica *findReplica(const void *data)
+{
+    size_t slot = replicaHash(data);
+    while (g_replicas[slot].data && g_replicas[slot].data != data) {
+        slot = (slot + 1) & (g_replicaSlots - 1);
+    }
+    return &g_replicas[slot];
+}
+
+/* Grow the replica table so it stays at most half full (table lock held) */
+static bool reserveReplicaSlot(void)
+{
+    size_t count = replicaCount();
+    if (g_replicas && (count + 1) * 2 <= g_replicaSlots) {
+        return true;
+    }
+
+    size_t       slots    = g_replicaSlots ? g_replicaSlots * 2 : REPLICA_TABLE_MIN;
+    NumaReplica *replicas = (NumaReplica *)TINYAI_MALLOC(slots * sizeof(NumaReplica));
+    if (!replicas) {
+        return false;
+    }
+    memset(replicas, 0, slots * sizeof(NumaReplica));
+
+    NumaReplica *old      = g_replicas;
+    size_t       oldSlots = g_replicaSlots;
+    g_replicas            = replicas;
+    g_replicaSlots        = slots;
+    for (size_t i = 0; i < oldSlots; i++) {
+        if (old[i].data) {
+            *findReplica(old[i].data) = old[i];
+        }
+    }
+    if (old) {
+        TINYAI_FREE(old);
+    }
+    return true;
+}
+
+/* Free the copies of a replica */
+static void freeReplicaCopies(NumaReplica *replica)
+{
+    for (int node = 0; node < TINYAI_NUMA_MAX_NODES; node++) {
+        tinyaiNumaFree(replica->copies[node], replica->size);
+    }
+}
+
+bool tinyaiNumaReplicate(const void *data, size_t size)
+{
+    if (!data || size == 0) {
+        return false;
+    }
+
+    /* Copy outside the lock; kernels keep using the original meanwhile */
+    NumaReplica replica;
+    memset(&replica, 0, sizeof(replica));
+    replica.data = data;
+    replica.size = size;
+    for (int node = 0; node < tinyaiNumaNodeCount(); node++) {
+        replica.copies[node] = tinyaiNumaAlloc(size, node);
+        if (!replica.copies[node]) {
+            freeReplicaCopies(&replica);
+            return false;
+        }
+        memcpy(replica.copies[node], data, size);
+    }
+
+    lockReplicas();
+    bool ok = reserveReplicaSlot();
+    if (ok) {
+        NumaReplica *slot = findReplica(data);
+        if (slot->data) {
+            /* Already replicated */
+            freeReplicaCopies(&replica);
+        }
+        else {
+            *slot = replica;
+            setReplicaCount(replicaCount() + 1);
+        }
+    }
+    else {
+        freeReplicaCopies(&replica);
+    }
+    unlockReplicas();
+    return ok;
+}
+
+const void *tinyaiNumaLocal(const void *data)
+{
+    if (!data || replicaCount() == 0) {
+        return data;
+    }
+
+    int         node  = tinyaiNumaCurrentNode();
+    const void *local = data;
+    lockReplicasShared();
+    NumaReplica *replica = findReplica(data);
+    if (replica->data && replica->copies[node]) {
+        local = replica->copies[node];
+    }
+    unlockReplicasShared();
+    return local;
+}
+
+void tinyaiNumaRelease(const void *data)
+{
+    if (!data || replicaCount() == 0) {
+        return;
+    }
+
+    lockReplicas();
+    NumaReplica *replica = findReplica(data);
+    if (replica->data) {
+        freeReplicaCopies(replica);
+        memset(replica, 0, sizeof(*replica));
+        setReplicaCount(replicaCount() - 1);
+
+        /* Re-insert the rest of the probe run so lookups do not stop at the hole */
+        size_t slot = (size_t)(replica - g_replicas);
+        for (slot = (slot + 1) & (g_replicaSlots - 1); g_replicas[slot].data;
+             slot = (slot + 1) & (g_replicaSlots - 1)) {
+            NumaReplica moved = g_replicas[slot];
+            memset(&g_replicas[slot], 0, sizeof(NumaReplica));
+            *findReplica(moved.data) = moved;
+        }
+    }
+    unlockReplicas();
+}
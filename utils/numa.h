@@ -0,0 +1,142 @@
+/**
+ * @file numa.h
+ * @brief NUMA topology, memory placement and weight replicas for TinyAI
+ *
+ * On multi-socket hosts a thread streaming weights from another node's
+ * memory pays for every byte twice over the interconnect. The
+ * "system.numa" configuration key picks how read-only weights are placed:
+ * "off" (the default) leaves them where they were allocated, "interleave"
+ * spreads their pages across all nodes, and "replicate" keeps one copy per
+ * node, which kernels find with tinyaiNumaLocal. In either mode the shared
+ * thread pool pins its workers to nodes round-robin.
+ *
+ * Topology is read from sysfs on Linux and from the NUMA API on Windows,
+ * without libnuma. Elsewhere, or on a single node, everything here degrades
+ * to a no-op on one node.
+ */
+
+#ifndef TINYAI_NUMA_H
+#define TINYAI_NUMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Most NUMA nodes handled; nodes beyond this are ignored
+ */
+#define TINYAI_NUMA_MAX_NODES 16
+
+/**
+ * Placement of read-only weights
+ */
+typedef enum {
+    TINYAI_NUMA_OFF,        /* Leave weights where they were allocated */
+    TINYAI_NUMA_INTERLEAVE, /* Spread weight pages across all nodes */
+    TINYAI_NUMA_REPLICATE   /* Keep a copy of the weights on every node */
+} TinyAINumaMode;
+
+/**
+ * Get the placement mode from the "system.numa" configuration key
+ *
+ * @return Configured mode, or TINYAI_NUMA_OFF on a single node
+ */
+TinyAINumaMode tinyaiNumaGetMode(void);
+
+/**
+ * Get the number of NUMA nodes
+ *
+ * @return Node count, at least 1
+ */
+int tinyaiNumaNodeCount(void);
+
+/**
+ * Get the node of the CPU the calling thread is running on
+ *
+ * @return Node index, 0 when unknown
+ */
+int tinyaiNumaCurrentNode(void);
+
+/**
+ * Restrict the calling thread to the CPUs of a node
+ *
+ * @param node Node index
+ * @return true if the thread was pinned
+ */
+bool tinyaiNumaBindThread(int node);
+
+/**
+ * Restrict the calling thread to a single CPU
+ *
+ * @param cpu CPU index
+ * @return true if the thread was pinned
+ */
+bool tinyaiNumaBindThreadToCpu(int cpu);
+
+/**
+ * Allocate page-aligned memory placed on a node
+ *
+ * @param size Size in bytes
+ * @param node Node index, or -1 to interleave the pages across all nodes
+ * @return Memory to release with tinyaiNumaFree, or NULL on failure
+ */
+void *tinyaiNumaAlloc(size_t size, int node);
+
+/**
+ * Free memory from tinyaiNumaAlloc
+ *
+ * @param ptr Memory to free
+ * @param size Size passed to tinyaiNumaAlloc
+ */
+void tinyaiNumaFree(void *ptr, size_t size);
+
+/**
+ * Move the whole pages of existing memory to a node
+ *
+ * Pages not yet touched are placed there when first faulted in. Only the
+ * pages lying wholly inside the range move, so neighbouring allocations
+ * are left alone.
+ *
+ * @param data Start of the range
+ * @param size Size in bytes
+ * @param node Node index, or -1 to interleave the pages across all nodes
+ * @return true if the pages were moved (false where unsupported, e.g. Windows)
+ */
+bool tinyaiNumaPlace(void *data, size_t size, int node);
+
+/**
+ * Copy read-only data to every node
+ *
+ * The copies are looked up by the address of the original with
+ * tinyaiNumaLocal until tinyaiNumaRelease. The original must not change or
+ * be freed while replicated.
+ *
+ * @param data Data to replicate
+ * @param size Size in bytes
+ * @return true if every node has a copy (or the data was already replicated)
+ */
+bool tinyaiNumaReplicate(const void *data, size_t size);
+
+/**
+ * Get the copy of replicated data on the calling thread's node
+ *
+ * @param data Address of the original
+ * @return Local copy, or data itself when it is not replicated
+ */
+const void *tinyaiNumaLocal(const void *data);
+
+/**
+ * Free the copies of replicated data
+ *
+ * @param data Address of the original (ignored when not replicated)
+ */
+void tinyaiNumaRelease(const void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_NUMA_H */
@@ -1,9 +1,9 @@
 #ifndef TINYAI_PERFORMANCE_IMPACT_H
 #define TINYAI_PERFORMANCE_IMPACT_H
 
-#include "tinyai.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // Performance impact configuration
 typedef struct {
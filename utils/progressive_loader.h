@@ -5,6 +5,12 @@
  * This header provides utilities for progressively loading model weights,
  * allowing large models to be utilized with a minimal memory footprint by
  * loading and unloading layers on demand.
+ *
+ * A forward pass requests each layer before running it and releases it
+ * afterwards. Released layers stay resident until the memory budget needs
+ * their space; the loader then evicts unused layers of the lowest priority,
+ * least recently accessed first, and reads ahead up to prefetch_distance
+ * layers past each request.
  */
 
 #ifndef TINYAI_PROGRESSIVE_LOADER_H
@@ -51,6 +57,8 @@ typedef struct {
     uint64_t            last_access_time; // Timestamp of last access
     size_t             *dependencies;     // Array of dependent layer IDs
     size_t              num_dependencies; // Number of dependencies
+    void               *weights;          // Mapped weights while loaded (NULL without a model)
+    size_t              use_count;        // Requests not yet released
 } TinyAILayerInfo;
 
 /**
@@ -69,7 +77,7 @@ typedef struct {
 /**
  * @brief Progressive loader context
  */
-typedef struct {
+typedef struct TinyAIProgressiveLoader {
     TinyAIProgressiveConfig config;
     TinyAILayerInfo        *layers;
     size_t                  num_layers;
@@ -77,6 +85,9 @@ typedef struct {
     size_t                  peak_memory;
     uint64_t                start_time;
     bool                    is_initialized;
+    TinyAIMappedModel      *mapped_model;      // Source of layer weights (NULL: budget only)
+    bool                    owns_mapped_model; // Whether the loader closes the mapped model
+    uint64_t                access_clock;      // Orders layer accesses
 } TinyAIProgressiveLoader;
 
 /**
@@ -92,6 +103,11 @@ TinyAIProgressiveLoader *tinyaiCreateProgressiveLoader(const char
 /**
  * @brief Create a progressive loader from an existing memory mapped model
  *
+ * Layer i of the loader is layer i of the mapped model. Weights handed out
+ * by a read-backend model live in its cache, so its maxCacheSize must cover
+ * max_memory plus prefetch_distance layers; tinyaiCreateProgressiveLoader
+ * sizes the cache of the model it opens that way.
+ *
  * @param mapped_model Pointer to an already opened memory mapped model
  * @param config Configuration settings
  * @return Pointer to the created loader or NULL on failure
@@ -125,15 +141,41 @@ bool tinyaiInitLayerInfo(TinyAIProgressiveLoader *loader, size_t layer_id, size_
 /**
  * @brief Request layer loading
  *
+ * Loads the layer and its dependencies if needed, evicting unused layers
+ * to stay within max_memory, and keeps it loaded until a matching
+ * tinyaiReleaseLayer. With prefetching enabled, the next prefetch_distance
+ * layers of the mapped model are queued for its prefetch threads.
+ *
  * @param loader Pointer to the progressive loader
  * @param layer_id Unique identifier for the layer
  * @return true if successful, false on failure
  */
 bool tinyaiRequestLayer(TinyAIProgressiveLoader *loader, size_t layer_id);
 
+/**
+ * @brief Release a layer requested with tinyaiRequestLayer
+ *
+ * The layer stays loaded, but may be evicted once no request holds it.
+ *
+ * @param loader Pointer to the progressive loader
+ * @param layer_id Unique identifier for the layer
+ */
+void tinyaiReleaseLayer(TinyAIProgressiveLoader *loader, size_t layer_id);
+
+/**
+ * @brief Get the weights of a loaded layer
+ *
+ * @param loader Pointer to the progressive loader
+ * @param layer_id Unique identifier for the layer
+ * @return Weights of the layer, valid until it is unloaded; NULL if it is not loaded
+ */
+const void *tinyaiGetLoadedLayerWeights(const TinyAIProgressiveLoader *loader, size_t layer_id);
+
 /**
  * @brief Unload layer
  *
+ * Fails while the layer is requested, or while a requested layer depends on it.
+ *
  * @param loader Pointer to the progressive loader
  * @param layer_id Unique identifier for the layer
  * @return true if successful, false on failure
@@ -310,6 +310,110 @@ bool tinyaiPruneMatrixStructured(float *weights, int rows, int cols, float prune
     return true;
 }
 
+bool tinyaiPruneMatrixBlocks(float *weights, int rows, int cols, int blockRows, int blockCols,
+                             float pruneRate)
+{
+    if (!weights || rows <= 0 || cols <= 0 || blockRows <= 0 || blockCols <= 0 ||
+        pruneRate < 0.0f || pruneRate > 1.0f) {
+        return false;
+    }
+
+    int blockRowCount = (rows + blockRows - 1) / blockRows;
+    int blockColCount = (cols + blockCols - 1) / blockCols;
+    int numBlocks     = blockRowCount * blockColCount;
+    int numPrune      = (int)(pruneRate * numBlocks);
+
+    if (numPrune <= 0) {
+        /* No pruning */
+        return true;
+    }
+
+    /* Calculate L2 norm for each block */
+    float *blockNorms  = (float *)malloc(numBlocks * sizeof(float));
+    float *sortedNorms = (float *)malloc(numBlocks * sizeof(float));
+    if (!blockNorms || !sortedNorms) {
+        free(blockNorms);
+        free(sortedNorms);
+        return false;
+    }
+
+    for (int br = 0; br < blockRowCount; br++) {
+        for (int bc = 0; bc < blockColCount; bc++) {
+            float norm = 0.0f;
+            for (int i = br * blockRows; i < (br + 1) * blockRows && i < rows; i++) {
+                for (int j = bc * blockCols; j < (bc + 1) * blockCols && j < cols; j++) {
+                    norm += weights[i * cols + j] * weights[i * cols + j];
+                }
+            }
+            blockNorms[br * blockColCount + bc] = sqrtf(norm);
+        }
+    }
+
+    /* The numPrune smallest norms sit at the end of the descending sort */
+    memcpy(sortedNorms, blockNorms, numBlocks * sizeof(float));
+    qsort(sortedNorms, numBlocks, sizeof(float), compareAbsFloat);
+    float threshold = sortedNorms[numBlocks - numPrune];
+
+    /* Zero blocks below the threshold, then blocks tied with it until numPrune are gone */
+    int pruned = 0;
+    for (int b = 0; b < 2 * numBlocks && pruned < numPrune; b++) {
+        bool  tiePass = b >= numBlocks;
+        float norm    = blockNorms[b % numBlocks];
+        if (tiePass ? norm != threshold : norm >= threshold) {
+            continue;
+        }
+
+        int br = (b % numBlocks) / blockColCount;
+        int bc = (b % numBlocks) % blockColCount;
+        for (int i = br * blockRows; i < (br + 1) * blockRows && i < rows; i++) {
+            for (int j = bc * blockCols; j < (bc + 1) * blockCols && j < cols; j++) {
+                weights[i * cols + j] = 0.0f;
+            }
+        }
+        pruned++;
+    }
+
+    free(sortedNorms);
+    free(blockNorms);
+    return true;
+}
+
+bool tinyaiPruneMatrixNM(float *weights, int rows, int cols, int n, int m)
+{
+    if (!weights || rows <= 0 || cols <= 0 || m <= 0 || n < 0 || n > m) {
+        return false;
+    }
+
+    bool *keep = (bool *)malloc(m * sizeof(bool));
+    if (!keep) {
+        return false;
+    }
+
+    for (int r = 0; r < rows; r++) {
+        for (int g = 0; g < cols; g += m) {
+            float *group     = &weights[r * cols + g];
+            int    groupSize = g + m <= cols ? m : cols - g;
+
+            /* Keep the n largest magnitudes; ties keep the earlier weight */
+            memset(keep, 0, m * sizeof(bool));
+            for (int kept = 0; kept < n && kept < groupSize; kept++) {
+                int largest = -1;
+                for (int j = 0; j < groupSize; j++) {
+                    if (!keep[j] && (largest < 0 || fabsf(group[j]) > fabsf(group[largest]))) {
+                        largest = j;
+                    }
+                }
+                keep[largest] = true;
+            }
+
+            applyPruningMask(group, keep, groupSize);
+        }
+    }
+
+    free(keep);
+    return true;
+}
+
 bool tinyaiPruneMatrixRandom(float *weights, int rows, int cols, float pruneRate)
 {
     if (!weights || rows <= 0 || cols <= 0 || pruneRate < 0.0f || pruneRate > 1.0f) {
@@ -404,6 +508,8 @@ TinyAIPruneConfig *tinyaiCreateDefaultPruneConfig(void)
     config->retrainAfterPrune   = true;  /* Do fine-tuning after pruning */
     config->numRetrainSteps     = 1000;  /* Number of fine-tuning steps */
     config->retrainLearningRate = 1e-5f; /* Small learning rate for fine-tuning */
+    config->nmKeep              = 2;     /* 2:4 pattern for N_M pruning */
+    config->nmGroup             = 4;
 
     return config;
 }
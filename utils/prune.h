@@ -25,7 +25,8 @@ typedef enum {
     TINYAI_PRUNE_MAGNITUDE,  /* Prune by absolute magnitude (remove smallest weights) */
     TINYAI_PRUNE_THRESHOLD,  /* Prune by threshold (remove weights below threshold) */
     TINYAI_PRUNE_STRUCTURED, /* Structured pruning (remove entire filters/channels) */
-    TINYAI_PRUNE_RANDOM      /* Random pruning (for baseline comparison) */
+    TINYAI_PRUNE_RANDOM,     /* Random pruning (for baseline comparison) */
+    TINYAI_PRUNE_N_M         /* N:M structured sparsity (keep nmKeep of every nmGroup weights) */
 } TinyAIPruneMethod;
 
 /**
@@ -39,6 +40,8 @@ typedef struct {
     bool              retrainAfterPrune;   /* Whether to do fine-tuning after pruning */
     int               numRetrainSteps;     /* Number of retraining steps after pruning */
     float             retrainLearningRate; /* Learning rate for retraining */
+    int               nmKeep;              /* Weights kept per group for N_M method (N) */
+    int               nmGroup;             /* Group size for N_M method (M) */
 } TinyAIPruneConfig;
 
 /**
@@ -88,6 +91,41 @@ bool tinyaiPruneMatrixByThreshold(float *weights, int rows, int cols, float thre
 bool tinyaiPruneMatrixStructured(float *weights, int rows, int cols, float pruneRate,
                                  bool isConvFilter, const int *filterShape);
 
+/**
+ * Apply block pruning to a weight matrix (remove entire blockRows x blockCols tiles)
+ *
+ * Blocks with the smallest L2 norm are zeroed until the target fraction of
+ * blocks is removed. With blocks matching a BSR layout (e.g. 4x8) the pruned
+ * matrix converts to TinyAIBSRMatrix without storing any empty blocks.
+ *
+ * @param weights Pointer to weight matrix (will be modified in-place)
+ * @param rows Number of rows in weight matrix
+ * @param cols Number of columns in weight matrix
+ * @param blockRows Rows per block
+ * @param blockCols Columns per block
+ * @param pruneRate Target block sparsity (0.0-1.0)
+ * @return true on success, false on failure
+ */
+bool tinyaiPruneMatrixBlocks(float *weights, int rows, int cols, int blockRows, int blockCols,
+                             float pruneRate);
+
+/**
+ * Apply N:M structured pruning to a weight matrix
+ *
+ * Every run of m consecutive weights along a row keeps its n largest
+ * magnitudes, giving exactly n/m density in a pattern that
+ * TinyAINMMatrix stores without per-value column indices (2:4 halves
+ * the weight bandwidth).
+ *
+ * @param weights Pointer to weight matrix (will be modified in-place)
+ * @param rows Number of rows in weight matrix
+ * @param cols Number of columns in weight matrix
+ * @param n Weights kept per group
+ * @param m Group size
+ * @return true on success, false on failure
+ */
+bool tinyaiPruneMatrixNM(float *weights, int rows, int cols, int n, int m);
+
 /**
  * Apply random pruning to a weight matrix
  *
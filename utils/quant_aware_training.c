@@ -7,6 +7,8 @@
 #include "memory_pool.h"
 #include "quantize.h"
 #include "quantize_mixed.h"
+#include "simd_ops.h"
+#include "thread_pool.h"
 #include <float.h>
 #include <math.h>
 #include <stdio.h>
@@ -101,6 +103,329 @@ bool tinyaiTrainWithQuantAwareness(const char *modelPath, const char *outputMode
     return true;
 }
 
+/* Gradient buffer and one sample's activations of a thread working on a mini-batch */
+typedef struct {
+    float *gradients;   /* Weight then bias gradients of every trained layer */
+    float *activations; /* Input and output of every layer */
+    float *deltas[2];   /* Ping-pong gradients of the widest layer's activations */
+    double loss;        /* Summed squared error of the shard's samples */
+} QatShard;
+
+/* Mini-batch split into contiguous shards of samples, one per pool thread */
+typedef struct {
+    const TinyAIQuantAwareLayer *layers;
+    int                          numLayers;
+    int                          freezeLayers;
+    float *const                *forwardWeights;    /* Fake-quantized weights of each layer */
+    const size_t                *gradientOffsets;   /* Each trained layer's weight gradients */
+    const size_t                *activationOffsets; /* Each layer's input, then the output */
+    size_t                       gradientSize;
+    const float                 *inputs;
+    const float                 *targets;
+    int                          batchBegin;
+    int                          batchSize;
+    int                          numShards;
+    QatShard                    *shards;
+} QatBatch;
+
+/* Gradients of the shards summed pairwise into shard 0 over a range of gradient elements */
+typedef struct {
+    QatShard *shards;
+    int       numShards;
+} QatReduction;
+
+static bool isTrainableActivation(int activation)
+{
+    return activation < 0 || activation == TINYAI_SIMD_ACTIVATION_RELU ||
+           activation == TINYAI_SIMD_ACTIVATION_SIGMOID ||
+           activation == TINYAI_SIMD_ACTIVATION_TANH;
+}
+
+/* Multiply a gradient by the activation's derivative, computed from the activation's output */
+static void activationBackward(float *delta, const float *output, int size, int activation)
+{
+    switch (activation) {
+    case TINYAI_SIMD_ACTIVATION_RELU:
+        for (int i = 0; i < size; i++) {
+            delta[i] = output[i] > 0.0f ? delta[i] : 0.0f;
+        }
+        break;
+    case TINYAI_SIMD_ACTIVATION_SIGMOID:
+        for (int i = 0; i < size; i++) {
+            delta[i] *= output[i] * (1.0f - output[i]);
+        }
+        break;
+    case TINYAI_SIMD_ACTIVATION_TANH:
+        for (int i = 0; i < size; i++) {
+            delta[i] *= 1.0f - output[i] * output[i];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Forward and backward pass of one sample, accumulating into the shard's gradients */
+static void trainSample(const QatBatch *batch, QatShard *shard, const float *input,
+                        const float *target)
+{
+    const TinyAIQuantAwareLayer *layers = batch->layers;
+    int                          last   = batch->numLayers - 1;
+
+    memcpy(shard->activations, input, (size_t)layers[0].inputSize * sizeof(float));
+    for (int l = 0; l <= last; l++) {
+        const TinyAIQuantAwareLayer *layer   = &layers[l];
+        const float                 *weights = batch->forwardWeights[l];
+        const float                 *in      = shard->activations + batch->activationOffsets[l];
+        float                       *out     = shard->activations + batch->activationOffsets[l + 1];
+
+        if (layer->biases) {
+            memcpy(out, layer->biases, (size_t)layer->outputSize * sizeof(float));
+        }
+        else {
+            memset(out, 0, (size_t)layer->outputSize * sizeof(float));
+        }
+        for (int k = 0; k < layer->inputSize; k++) {
+            if (in[k] != 0.0f) {
+                tinyaiSimdVecScaleAdd(out, weights + (size_t)k * layer->outputSize, in[k],
+                                      layer->outputSize);
+            }
+        }
+        if (layer->activation >= 0) {
+            tinyaiSimdActivate(out, layer->outputSize, layer->activation);
+        }
+    }
+
+    /* Mean squared error over the batch and the outputs */
+    const float *output = shard->activations + batch->activationOffsets[last + 1];
+    int          size   = layers[last].outputSize;
+    float        norm   = 2.0f / ((float)batch->batchSize * size);
+    float       *delta  = shard->deltas[0];
+    for (int j = 0; j < size; j++) {
+        float diff = output[j] - target[j];
+        shard->loss += (double)diff * diff;
+        delta[j] = norm * diff;
+    }
+
+    /* Straight-through estimator: gradients through the fake-quantized weights go to the
+       FP32 masters unchanged */
+    for (int l = last; l >= batch->freezeLayers; l--) {
+        const TinyAIQuantAwareLayer *layer       = &layers[l];
+        const float                 *in          = shard->activations + batch->activationOffsets[l];
+        const float                 *out         = shard->activations + batch->activationOffsets[l + 1];
+        float                       *gradWeights = shard->gradients + batch->gradientOffsets[l];
+        float *gradBiases = gradWeights + (size_t)layer->inputSize * layer->outputSize;
+
+        activationBackward(delta, out, layer->outputSize, layer->activation);
+        for (int k = 0; k < layer->inputSize; k++) {
+            if (in[k] != 0.0f) {
+                tinyaiSimdVecScaleAdd(gradWeights + (size_t)k * layer->outputSize, delta, in[k],
+                                      layer->outputSize);
+            }
+        }
+        if (layer->biases) {
+            tinyaiSimdVecAdd(gradBiases, gradBiases, delta, layer->outputSize);
+        }
+
+        if (l > batch->freezeLayers) {
+            const float *weights   = batch->forwardWeights[l];
+            float       *prevDelta = shard->deltas[delta == shard->deltas[0] ? 1 : 0];
+            for (int k = 0; k < layer->inputSize; k++) {
+                const float *row = weights + (size_t)k * layer->outputSize;
+                float        sum = 0.0f;
+                for (int j = 0; j < layer->outputSize; j++) {
+                    sum += row[j] * delta[j];
+                }
+                prevDelta[k] = sum;
+            }
+            delta = prevDelta;
+        }
+    }
+}
+
+static void trainShards(void *context, size_t begin, size_t end)
+{
+    const QatBatch *batch   = (const QatBatch *)context;
+    int             inSize  = batch->layers[0].inputSize;
+    int             outSize = batch->layers[batch->numLayers - 1].outputSize;
+
+    for (size_t s = begin; s < end; s++) {
+        QatShard *shard = &batch->shards[s];
+        int       first = batch->batchBegin + (int)(batch->batchSize * s / batch->numShards);
+        int       stop  = batch->batchBegin + (int)(batch->batchSize * (s + 1) / batch->numShards);
+
+        memset(shard->gradients, 0, batch->gradientSize * sizeof(float));
+        for (int i = first; i < stop; i++) {
+            trainSample(batch, shard, batch->inputs + (size_t)i * inSize,
+                        batch->targets + (size_t)i * outSize);
+        }
+    }
+}
+
+static void reduceGradients(void *context, size_t begin, size_t end)
+{
+    const QatReduction *reduction = (const QatReduction *)context;
+    int                 size      = (int)(end - begin);
+
+    for (int stride = 1; stride < reduction->numShards; stride *= 2) {
+        for (int s = 0; s + stride < reduction->numShards; s += 2 * stride) {
+            float *sum = reduction->shards[s].gradients + begin;
+            tinyaiSimdVecAdd(sum, sum, reduction->shards[s + stride].gradients + begin, size);
+        }
+    }
+}
+
+/* Weights seen by the forward pass: fake-quantized and/or with simulated quantization noise */
+static bool prepareForwardWeights(const TinyAIQuantAwareLayer        *layer,
+                                  const TinyAIQuantAwareTrainingConfig *config, float *out)
+{
+    int count = layer->inputSize * layer->outputSize;
+    if (config->enableStraightThroughEstimator) {
+        if (!tinyaiQuantizeForForwardPass(layer->weights, count, config->weightPrecision, out)) {
+            return false;
+        }
+    }
+    else {
+        memcpy(out, layer->weights, (size_t)count * sizeof(float));
+    }
+    if (config->useNoiseInjection && config->noiseStrength > 0.0f) {
+        return tinyaiSimulateQuantizationNoise(out, count, config->weightPrecision,
+                                               config->noiseStrength);
+    }
+    return true;
+}
+
+bool tinyaiQuantAwareTrainLayers(TinyAIQuantAwareLayer *layers, int numLayers, int freezeLayers,
+                                 const float *inputs, const float *targets, int numSamples,
+                                 const TinyAIQuantAwareTrainingConfig *config, float *loss)
+{
+    if (!layers || numLayers <= 0 || freezeLayers < 0 || freezeLayers >= numLayers || !inputs ||
+        !targets || numSamples <= 0 || !config || config->batchSize <= 0 ||
+        config->numEpochs <= 0 || config->learningRate <= 0.0f) {
+        return false;
+    }
+
+    /* Lay out the activations of a sample and the gradients of the trained layers */
+    size_t *activationOffsets = (size_t *)malloc(((size_t)numLayers + 1) * sizeof(size_t));
+    size_t *gradientOffsets   = (size_t *)calloc((size_t)numLayers, sizeof(size_t));
+    float **forwardWeights    = (float **)calloc((size_t)numLayers, sizeof(float *));
+    if (!activationOffsets || !gradientOffsets || !forwardWeights) {
+        free(activationOffsets);
+        free(gradientOffsets);
+        free(forwardWeights);
+        return false;
+    }
+
+    bool   ok             = true;
+    size_t activationSize = (size_t)layers[0].inputSize;
+    size_t gradientSize   = 0;
+    int    widest         = layers[0].inputSize;
+    activationOffsets[0]  = 0;
+    for (int l = 0; l < numLayers; l++) {
+        const TinyAIQuantAwareLayer *layer = &layers[l];
+        if (!layer->weights || layer->inputSize <= 0 || layer->outputSize <= 0 ||
+            (l > 0 && layer->inputSize != layers[l - 1].outputSize) ||
+            !isTrainableActivation(layer->activation)) {
+            ok = false;
+            break;
+        }
+
+        activationOffsets[l + 1] = activationSize;
+        activationSize += (size_t)layer->outputSize;
+        if (layer->outputSize > widest) {
+            widest = layer->outputSize;
+        }
+        if (l >= freezeLayers) {
+            gradientOffsets[l] = gradientSize;
+            gradientSize += (size_t)(layer->inputSize + 1) * layer->outputSize;
+        }
+
+        forwardWeights[l] =
+            (float *)malloc((size_t)layer->inputSize * layer->outputSize * sizeof(float));
+        ok = forwardWeights[l] && prepareForwardWeights(layer, config, forwardWeights[l]);
+        if (!ok) {
+            break;
+        }
+    }
+
+    /* One gradient buffer per thread, never more than there are samples in a batch */
+    TinyAIThreadPool *pool      = tinyaiGetThreadPool();
+    int               batchSize = config->batchSize < numSamples ? config->batchSize : numSamples;
+    int               numShards = tinyaiThreadPoolSize(pool);
+    if (numShards > batchSize) {
+        numShards = batchSize;
+    }
+    QatShard *shards = ok ? (QatShard *)calloc((size_t)numShards, sizeof(QatShard)) : NULL;
+    ok               = ok && shards;
+    for (int s = 0; ok && s < numShards; s++) {
+        shards[s].gradients   = (float *)malloc(gradientSize * sizeof(float));
+        shards[s].activations = (float *)malloc(activationSize * sizeof(float));
+        shards[s].deltas[0]   = (float *)malloc((size_t)widest * sizeof(float));
+        shards[s].deltas[1]   = (float *)malloc((size_t)widest * sizeof(float));
+        ok = shards[s].gradients && shards[s].activations && shards[s].deltas[0] &&
+             shards[s].deltas[1];
+    }
+
+    QatBatch     batch     = {layers,       numLayers, freezeLayers, forwardWeights,
+                              gradientOffsets, activationOffsets, gradientSize, inputs,
+                              targets,      0,         0,            numShards,
+                              shards};
+    QatReduction reduction = {shards, numShards};
+    double       epochLoss = 0.0;
+    for (int epoch = 0; ok && epoch < config->numEpochs; epoch++) {
+        epochLoss = 0.0;
+        for (int begin = 0; ok && begin < numSamples; begin += batchSize) {
+            batch.batchBegin = begin;
+            batch.batchSize  = numSamples - begin < batchSize ? numSamples - begin : batchSize;
+            batch.numShards  = batch.batchSize < numShards ? batch.batchSize : numShards;
+            for (int s = 0; s < batch.numShards; s++) {
+                shards[s].loss = 0.0;
+            }
+
+            tinyaiParallelFor(pool, (size_t)batch.numShards, 1, trainShards, &batch);
+            reduction.numShards = batch.numShards;
+            tinyaiParallelFor(pool, gradientSize,
+                              tinyaiThreadPoolGrain(pool, (size_t)batch.numShards, 16),
+                              reduceGradients, &reduction);
+            for (int s = 0; s < batch.numShards; s++) {
+                epochLoss += shards[s].loss;
+            }
+
+            /* SGD step on the FP32 masters, then the next batch's forward weights */
+            for (int l = freezeLayers; ok && l < numLayers; l++) {
+                TinyAIQuantAwareLayer *layer       = &layers[l];
+                int                    count       = layer->inputSize * layer->outputSize;
+                const float           *gradWeights = shards[0].gradients + gradientOffsets[l];
+                tinyaiSimdVecScaleAdd(layer->weights, gradWeights, -config->learningRate, count);
+                if (layer->biases) {
+                    tinyaiSimdVecScaleAdd(layer->biases, gradWeights + count,
+                                          -config->learningRate, layer->outputSize);
+                }
+                ok = prepareForwardWeights(layer, config, forwardWeights[l]);
+            }
+        }
+    }
+
+    if (ok && loss) {
+        *loss = (float)(epochLoss / ((double)numSamples * layers[numLayers - 1].outputSize));
+    }
+
+    for (int s = 0; shards && s < numShards; s++) {
+        free(shards[s].gradients);
+        free(shards[s].activations);
+        free(shards[s].deltas[0]);
+        free(shards[s].deltas[1]);
+    }
+    free(shards);
+    for (int l = 0; l < numLayers; l++) {
+        free(forwardWeights[l]);
+    }
+    free(forwardWeights);
+    free(gradientOffsets);
+    free(activationOffsets);
+    return ok;
+}
+
 float tinyaiStraightThroughEstimator(float realValue, float quantizedValue,
                                      TinyAIMixedPrecType precision)
 {
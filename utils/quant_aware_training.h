@@ -23,8 +23,8 @@ extern "C" {
  * Configuration for quantization-aware training
  */
 typedef struct {
-    TinyAIPrecisionType weightPrecision;           /* Precision for weights during training */
-    TinyAIPrecisionType activationPrecision;       /* Precision for activations during training */
+    TinyAIMixedPrecType weightPrecision;           /* Precision for weights during training */
+    TinyAIMixedPrecType activationPrecision;       /* Precision for activations during training */
     bool                useSymmetricQuantization;  /* Whether to use symmetric quantization */
     bool                usePerChannelQuantization; /* Whether to use per-channel quantization */
     float               learningRate;              /* Learning rate for training */
@@ -37,6 +37,20 @@ typedef struct {
     float               noiseStrength;     /* Strength of injected noise (0.0-1.0) */
 } TinyAIQuantAwareTrainingConfig;
 
+/**
+ * Dense layer trained by tinyaiQuantAwareTrainLayers
+ *
+ * Computes act(x * weights + biases). The weights and biases are the FP32
+ * master copies and are updated in place.
+ */
+typedef struct {
+    float *weights;    /* Weights [inputSize x outputSize], row-major */
+    float *biases;     /* Biases [outputSize] (NULL for none) */
+    int    inputSize;  /* Input size (the previous layer's outputSize) */
+    int    outputSize; /* Output size */
+    int    activation; /* TINYAI_SIMD_ACTIVATION_RELU, _SIGMOID or _TANH (-1 for none) */
+} TinyAIQuantAwareLayer;
+
 /**
  * Initialize a model for quantization-aware training
  *
@@ -58,6 +72,32 @@ bool tinyaiInitQuantAwareTraining(const char                           *modelPat
 bool tinyaiTrainWithQuantAwareness(const char *modelPath, const char *outputModelPath,
                                    const TinyAIQuantAwareTrainingConfig *config);
 
+/**
+ * Train dense layers with quantization awareness on in-memory data
+ *
+ * Minimizes the mean squared error between the last layer's output and the
+ * targets with mini-batch SGD. Each batch first fake-quantizes the weights
+ * to config->weightPrecision (when enableStraightThroughEstimator is set)
+ * and adds quantization noise (when useNoiseInjection is set); gradients
+ * computed through those weights update the FP32 masters directly, the
+ * straight-through estimator. The samples of a batch are split across the
+ * shared thread pool, each thread accumulating into its own gradient
+ * buffer, and the buffers are summed with a tree reduction.
+ *
+ * @param layers Layers applied in order, updated in place
+ * @param numLayers Number of layers
+ * @param freezeLayers Number of leading layers left untrained (less than numLayers)
+ * @param inputs Training inputs [numSamples x layers[0].inputSize]
+ * @param targets Training targets [numSamples x layers[numLayers - 1].outputSize]
+ * @param numSamples Number of samples
+ * @param config Training configuration (batchSize, numEpochs, learningRate, precision, noise)
+ * @param loss Output mean squared error of the last epoch (can be NULL)
+ * @return true on success, false on invalid arguments or allocation failure
+ */
+bool tinyaiQuantAwareTrainLayers(TinyAIQuantAwareLayer *layers, int numLayers, int freezeLayers,
+                                 const float *inputs, const float *targets, int numSamples,
+                                 const TinyAIQuantAwareTrainingConfig *config, float *loss);
+
 /**
  * Create a straight-through estimator for a quantization operation
  * (Used for backpropagating through non-differentiable quantization)
@@ -68,7 +108,7 @@ bool tinyaiTrainWithQuantAwareness(const char *modelPath, const char *outputMode
  * @return Gradient for backpropagation
  */
 float tinyaiStraightThroughEstimator(float realValue, float quantizedValue,
-                                     TinyAIPrecisionType precision);
+                                     TinyAIMixedPrecType precision);
 
 /**
  * Simulate quantization effects during training by adding controlled noise
@@ -79,7 +119,7 @@ float tinyaiStraightThroughEstimator(float realValue, float quantizedValue,
  * @param strength Noise strength (0.0-1.0)
  * @return true on success, false on failure
  */
-bool tinyaiSimulateQuantizationNoise(float *weights, int numElements, TinyAIPrecisionType precision,
+bool tinyaiSimulateQuantizationNoise(float *weights, int numElements, TinyAIMixedPrecType precision,
                                      float strength);
 
 /**
@@ -91,7 +131,7 @@ bool tinyaiSimulateQuantizationNoise(float *weights, int numElements, TinyAIPrec
  * @param outQuantized Output buffer for quantized weights (can be same as weights)
  * @return true on success, false on failure
  */
-bool tinyaiQuantizeForForwardPass(float *weights, int numElements, TinyAIPrecisionType precision,
+bool tinyaiQuantizeForForwardPass(float *weights, int numElements, TinyAIMixedPrecType precision,
                                   float *outQuantized);
 
 /**
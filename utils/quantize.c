@@ -12,19 +12,20 @@
 #include "../core/memory.h"
 #include "../core/io.h"
 #include "quantize.h"
+#include "cache_opt.h"
+#include "numa.h"
+#include "simd_ops.h"
+#include "thread_pool.h"
 
 /* ----------------- Internal Constants and Variables ----------------- */
 
-/* Activation function lookup tables */
-#define ACTIVATION_TABLE_SIZE 8192
-static float *activationTableReLU = NULL;
-static float *activationTableSigmoid = NULL;
-static float *activationTableTanh = NULL;
-static float *activationTableGELU = NULL;
+/* Activations of quantized-weight layers (FP32 or INT8) */
+static TinyAIPrecision activationPrecision = TINYAI_PRECISION_FP32;
 
-/* Activation range for lookup tables */
-#define ACTIVATION_MIN -8.0f
-#define ACTIVATION_MAX 8.0f
+/* Quantized matrix file magic numbers; group-quantized 4-bit matrices get their own */
+#define QUANTIZED_MATRIX_MAGIC         0x4D51544E /* "TQNM" - TinyAI Quantized Matrix */
+#define QUANTIZED_MATRIX_GROUPED_MAGIC 0x4751544E /* "TQNG" - grouped 4-bit matrix */
+#define QUANTIZED_MATRIX_CODEBOOK_MAGIC 0x4351544E /* "TQNC" - codebook 4-bit matrix */
 
 /* ----------------- Matrix Creation and Destruction ----------------- */
 
@@ -52,6 +53,11 @@ TinyAIMatrix4bit* tinyaiCreateMatrix4bit(uint32_t rows, uint32_t cols) {
     matrix->cols = cols;
     matrix->scale = 1.0f;
     matrix->zeroPoint = 0.0f;
+    matrix->scales = NULL;
+    matrix->zeroPoints = NULL;
+    matrix->groupSize = 0;
+    matrix->levels = NULL;
+    matrix->layout = TINYAI_MATRIX4BIT_ROW_MAJOR;
     
     return matrix;
 }
@@ -64,11 +70,239 @@ void tinyaiDestroyMatrix4bit(TinyAIMatrix4bit *matrix) {
         return;
     }
     
+    tinyaiReleaseMatrix4bit(matrix);
+    TINYAI_FREE(matrix);
+}
+
+/* Groups in each row of a group-quantized 4-bit matrix */
+static uint32_t groupsPerRow(const TinyAIMatrix4bit *matrix) {
+    return (matrix->cols + matrix->groupSize - 1) / matrix->groupSize;
+}
+
+/* Columns of a panel of the prepacked layout, and bytes each row takes in one */
+#define PANEL_COLS      16
+#define PANEL_ROW_BYTES (PANEL_COLS / 2)
+
+/* Value at (row, col) of a 4-bit matrix in either layout */
+static int matrix4bitValue(const TinyAIMatrix4bit *matrix, uint32_t row, uint32_t col) {
+    if (matrix->layout == TINYAI_MATRIX4BIT_PANELS) {
+        uint32_t i = col % PANEL_COLS;
+        uint8_t  packed = matrix->data[((size_t)(col / PANEL_COLS) * matrix->rows + row) *
+                                           PANEL_ROW_BYTES + i % PANEL_ROW_BYTES];
+        return i < PANEL_ROW_BYTES ? (packed & 0x0F) : (packed >> 4);
+    }
+    
+    size_t  idx    = (size_t)row * matrix->cols + col;
+    uint8_t packed = matrix->data[idx / 2];
+    return (idx & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+}
+
+/**
+ * Create a group-quantized 4-bit matrix
+ */
+TinyAIMatrix4bit* tinyaiCreateMatrix4bitGrouped(uint32_t rows, uint32_t cols, uint32_t groupSize) {
+    if (cols == 0) {
+        return NULL;
+    }
+    if (groupSize == 0 || groupSize > cols) {
+        groupSize = cols;
+    }
+    
+    TinyAIMatrix4bit *matrix = tinyaiCreateMatrix4bit(rows, cols);
+    if (!matrix) {
+        return NULL;
+    }
+    
+    matrix->groupSize = groupSize;
+    size_t groups = tinyaiMatrix4bitGroupCount(matrix);
+    matrix->scales = (float*)TINYAI_MALLOC(groups * sizeof(float));
+    matrix->zeroPoints = (float*)TINYAI_MALLOC(groups * sizeof(float));
+    if (!matrix->scales || !matrix->zeroPoints) {
+        tinyaiDestroyMatrix4bit(matrix);
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < groups; i++) {
+        matrix->scales[i] = 1.0f;
+        matrix->zeroPoints[i] = 0.0f;
+    }
+    
+    return matrix;
+}
+
+/**
+ * Number of per-group scales of a 4-bit matrix
+ */
+size_t tinyaiMatrix4bitGroupCount(const TinyAIMatrix4bit *matrix) {
+    if (!matrix || matrix->groupSize == 0) {
+        return 0;
+    }
+    
+    return (size_t)matrix->rows * groupsPerRow(matrix);
+}
+
+/**
+ * Deep-copy a 4-bit matrix into a matrix held by value
+ */
+int tinyaiCopyMatrix4bit(TinyAIMatrix4bit *dst, const TinyAIMatrix4bit *src) {
+    if (!dst || !src || !src->data) {
+        return -1;
+    }
+    
+    size_t dataSize = tinyaiMatrix4bitDataSize(src);
+    size_t groups = src->scales ? tinyaiMatrix4bitGroupCount(src) : 0;
+    
+    memset(dst, 0, sizeof(TinyAIMatrix4bit));
+    dst->data = (uint8_t*)TINYAI_MALLOC(dataSize);
+    if (!dst->data) {
+        return -1;
+    }
+    memcpy(dst->data, src->data, dataSize);
+    
+    if (groups > 0) {
+        dst->scales = (float*)TINYAI_MALLOC(groups * sizeof(float));
+        dst->zeroPoints = (float*)TINYAI_MALLOC(groups * sizeof(float));
+        if (!dst->scales || !dst->zeroPoints) {
+            tinyaiReleaseMatrix4bit(dst);
+            return -1;
+        }
+        memcpy(dst->scales, src->scales, groups * sizeof(float));
+        memcpy(dst->zeroPoints, src->zeroPoints, groups * sizeof(float));
+        dst->groupSize = src->groupSize;
+    }
+    
+    if (src->levels) {
+        dst->levels = (float*)TINYAI_MALLOC(TINYAI_CODEBOOK_LEVELS * sizeof(float));
+        if (!dst->levels) {
+            tinyaiReleaseMatrix4bit(dst);
+            return -1;
+        }
+        memcpy(dst->levels, src->levels, TINYAI_CODEBOOK_LEVELS * sizeof(float));
+    }
+    
+    dst->rows = src->rows;
+    dst->cols = src->cols;
+    dst->scale = src->scale;
+    dst->zeroPoint = src->zeroPoint;
+    dst->layout = src->layout;
+    
+    return 0;
+}
+
+/**
+ * Bytes of a 4-bit matrix's data in its current layout
+ */
+size_t tinyaiMatrix4bitDataSize(const TinyAIMatrix4bit *matrix) {
+    if (!matrix) {
+        return 0;
+    }
+    
+    if (matrix->layout == TINYAI_MATRIX4BIT_PANELS) {
+        size_t panels = (matrix->cols + PANEL_COLS - 1) / PANEL_COLS;
+        return panels * matrix->rows * PANEL_ROW_BYTES;
+    }
+    return ((size_t)matrix->rows * matrix->cols + 1) / 2;
+}
+
+/**
+ * Repack a row-major 4-bit matrix into panels for the SIMD kernels
+ */
+int tinyaiMatrix4bitPrepack(TinyAIMatrix4bit *matrix) {
+    if (!matrix || !matrix->data) {
+        return -1;
+    }
+    if (matrix->layout == TINYAI_MATRIX4BIT_PANELS) {
+        return 0;
+    }
+    
+    /* Per-group scales vary along a row, which the panel kernels do not handle */
+    if (matrix->scales) {
+        return -1;
+    }
+    
+    TinyAIMatrix4bit packed = *matrix;
+    packed.layout = TINYAI_MATRIX4BIT_PANELS;
+    
+    /* Padding columns of the last panel stay zero */
+    size_t dataSize = tinyaiMatrix4bitDataSize(&packed);
+    packed.data = (uint8_t*)TINYAI_MALLOC(dataSize);
+    if (!packed.data) {
+        return -1;
+    }
+    memset(packed.data, 0, dataSize);
+    
+    for (uint32_t k = 0; k < matrix->rows; k++) {
+        for (uint32_t j = 0; j < matrix->cols; j++) {
+            uint32_t i = j % PANEL_COLS;
+            uint8_t *dst = packed.data + ((size_t)(j / PANEL_COLS) * matrix->rows + k) *
+                                             PANEL_ROW_BYTES + i % PANEL_ROW_BYTES;
+            int q = matrix4bitValue(matrix, k, j);
+            *dst |= (uint8_t)(i < PANEL_ROW_BYTES ? q : q << 4);
+        }
+    }
+    
+    TINYAI_FREE(matrix->data);
+    *matrix = packed;
+    return 0;
+}
+
+/**
+ * Convert a 4-bit matrix back to the row-major layout
+ */
+int tinyaiMatrix4bitUnpack(TinyAIMatrix4bit *matrix) {
+    if (!matrix || !matrix->data) {
+        return -1;
+    }
+    if (matrix->layout == TINYAI_MATRIX4BIT_ROW_MAJOR) {
+        return 0;
+    }
+    
+    TinyAIMatrix4bit unpacked = *matrix;
+    unpacked.layout = TINYAI_MATRIX4BIT_ROW_MAJOR;
+    
+    size_t dataSize = tinyaiMatrix4bitDataSize(&unpacked);
+    unpacked.data = (uint8_t*)TINYAI_MALLOC(dataSize);
+    if (!unpacked.data) {
+        return -1;
+    }
+    memset(unpacked.data, 0, dataSize);
+    
+    for (uint32_t k = 0; k < matrix->rows; k++) {
+        for (uint32_t j = 0; j < matrix->cols; j++) {
+            size_t idx = (size_t)k * matrix->cols + j;
+            int    q   = matrix4bitValue(matrix, k, j);
+            unpacked.data[idx / 2] |= (uint8_t)((idx & 1) ? q : q << 4);
+        }
+    }
+    
+    TINYAI_FREE(matrix->data);
+    *matrix = unpacked;
+    return 0;
+}
+
+/**
+ * Free the storage of a 4-bit matrix held by value and clear it
+ */
+void tinyaiReleaseMatrix4bit(TinyAIMatrix4bit *matrix) {
+    if (!matrix) {
+        return;
+    }
+    
     if (matrix->data) {
+        tinyaiNumaRelease(matrix->data);
         TINYAI_FREE(matrix->data);
     }
+    if (matrix->scales) {
+        TINYAI_FREE(matrix->scales);
+    }
+    if (matrix->zeroPoints) {
+        TINYAI_FREE(matrix->zeroPoints);
+    }
+    if (matrix->levels) {
+        TINYAI_FREE(matrix->levels);
+    }
     
-    TINYAI_FREE(matrix);
+    memset(matrix, 0, sizeof(TinyAIMatrix4bit));
 }
 
 /**
@@ -151,6 +385,92 @@ void tinyaiDestroyMatrixFP32(TinyAIMatrixFP32 *matrix) {
 
 /* ----------------- Quantization and Dequantization ----------------- */
 
+/* Values per task of the parallel min/max and quantization passes */
+#define QUANTIZE_CHUNK 16384
+
+/* Min/max of one chunk per iteration, run as a thread pool task */
+typedef struct {
+    const float *data;
+    size_t       size;
+    float       *mins;
+    float       *maxs;
+} MinMaxTask;
+
+static void minMaxChunks(void *context, size_t begin, size_t end) {
+    const MinMaxTask *task = (const MinMaxTask *)context;
+    
+    for (size_t c = begin; c < end; c++) {
+        size_t start = c * QUANTIZE_CHUNK;
+        size_t n = task->size - start < QUANTIZE_CHUNK ? task->size - start : QUANTIZE_CHUNK;
+        task->mins[c] = FLT_MAX;
+        task->maxs[c] = -FLT_MAX;
+        tinyaiSimdMinMax(task->data + start, (int)n, &task->mins[c], &task->maxs[c]);
+    }
+}
+
+/* Min/max of an array, reduced per chunk on the shared thread pool (NaNs are skipped) */
+static void findMinMax(const float *data, size_t size, float *min, float *max) {
+    size_t chunks = (size + QUANTIZE_CHUNK - 1) / QUANTIZE_CHUNK;
+    float stack[2 * 64];
+    float *partials = chunks <= 64 ? stack : (float *)TINYAI_MALLOC(2 * chunks * sizeof(float));
+    
+    *min = FLT_MAX;
+    *max = -FLT_MAX;
+    if (!partials) {
+        /* Fall back to a single serial pass */
+        for (size_t i = 0; i < size; i += QUANTIZE_CHUNK) {
+            size_t n = size - i < QUANTIZE_CHUNK ? size - i : QUANTIZE_CHUNK;
+            tinyaiSimdMinMax(data + i, (int)n, min, max);
+        }
+        return;
+    }
+    
+    MinMaxTask task = {data, size, partials, partials + chunks};
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    tinyaiParallelFor(pool, chunks, tinyaiThreadPoolGrain(pool, QUANTIZE_CHUNK, 1), minMaxChunks,
+                      &task);
+    
+    tinyaiSimdMinMax(task.mins, (int)chunks, min, max);
+    tinyaiSimdMinMax(task.maxs, (int)chunks, min, max);
+    
+    if (partials != stack) {
+        TINYAI_FREE(partials);
+    }
+}
+
+/* Element range of an affine 4-bit or 8-bit quantization, run as a thread pool task */
+typedef struct {
+    const float *input;
+    void        *output;
+    int          bits;
+    float        scale;
+    float        zeroPoint;
+} QuantizeTask;
+
+static void quantizeRange(void *context, size_t begin, size_t end) {
+    const QuantizeTask *task = (const QuantizeTask *)context;
+    
+    /* Ranges start at multiples of 16, so 4-bit ranges own whole bytes */
+    for (size_t i = begin; i < end; i += QUANTIZE_CHUNK) {
+        int n = (int)(end - i < QUANTIZE_CHUNK ? end - i : QUANTIZE_CHUNK);
+        if (task->bits == 4) {
+            tinyaiSimdQuantize4BitAffine((uint8_t *)task->output + i / 2, task->input + i, n,
+                                         task->scale, task->zeroPoint);
+        } else {
+            tinyaiSimdQuantize8BitAffine((int8_t *)task->output + i, task->input + i, n,
+                                         task->scale, task->zeroPoint);
+        }
+    }
+}
+
+/* Quantize size values with one scale and zero point, split across the shared thread pool */
+static void quantizeAffine(const float *input, void *output, size_t size, int bits, float scale,
+                           float zeroPoint) {
+    QuantizeTask task = {input, output, bits, scale, zeroPoint};
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    tinyaiParallelFor(pool, size, tinyaiThreadPoolGrain(pool, 1, 16), quantizeRange, &task);
+}
+
 /**
  * Quantize a FP32 matrix to 4-bit
  */
@@ -165,14 +485,9 @@ TinyAIMatrix4bit* tinyaiQuantizeFP32To4bit(const TinyAIMatrixFP32 *input) {
     }
     
     /* Find min and max values */
-    float minVal = FLT_MAX;
-    float maxVal = -FLT_MAX;
-    
-    size_t size = input->rows * input->cols;
-    for (size_t i = 0; i < size; i++) {
-        if (input->data[i] < minVal) minVal = input->data[i];
-        if (input->data[i] > maxVal) maxVal = input->data[i];
-    }
+    float minVal, maxVal;
+    size_t size = (size_t)input->rows * input->cols;
+    findMinMax(input->data, size, &minVal, &maxVal);
     
     /* Compute scale and zero point */
     output->zeroPoint = minVal;
@@ -183,25 +498,192 @@ TinyAIMatrix4bit* tinyaiQuantizeFP32To4bit(const TinyAIMatrixFP32 *input) {
         output->scale = 1.0f;
     }
     
-    /* Quantize the values */
-    for (size_t i = 0; i < size; i += 2) {
-        /* Quantize first value */
-        int val1 = (int)((input->data[i] - output->zeroPoint) / output->scale + 0.5f);
-        if (val1 < 0) val1 = 0;
-        if (val1 > 15) val1 = 15;
+    /* Quantize the values, packing two per byte with the high nibble first */
+    quantizeAffine(input->data, output->data, size, 4, output->scale, output->zeroPoint);
+    
+    return output;
+}
+
+/* 4-bit level of one value: (value - minVal) / scale rounded half up, clamped to [0, 15] */
+static int quantize4bitValue(float value, float scale, float minVal) {
+    int val = (int)((value - minVal) / scale + 0.5f);
+    if (val < 0) val = 0;
+    if (val > 15) val = 15;
+    return val;
+}
+
+/* Row range of a group-wise 4-bit quantization, run as a thread pool task */
+typedef struct {
+    const TinyAIMatrixFP32 *input;
+    TinyAIMatrix4bit       *output;
+} QuantizeGroupedTask;
+
+static void quantizeGroupedRows(void *context, size_t begin, size_t end) {
+    const QuantizeGroupedTask *task = (const QuantizeGroupedTask *)context;
+    TinyAIMatrix4bit *output = task->output;
+    uint32_t cols = task->input->cols;
+    uint32_t groups = groupsPerRow(output);
+    
+    for (size_t r = begin; r < end; r++) {
+        const float *values = task->input->data + r * cols;
         
-        /* Quantize second value (or use 0 if at the end) */
-        int val2 = 0;
-        if (i + 1 < size) {
-            val2 = (int)((input->data[i + 1] - output->zeroPoint) / output->scale + 0.5f);
-            if (val2 < 0) val2 = 0;
-            if (val2 > 15) val2 = 15;
+        for (uint32_t g = 0; g < groups; g++) {
+            uint32_t start = g * output->groupSize;
+            uint32_t stop = cols - start < output->groupSize ? cols : start + output->groupSize;
+            
+            /* Each group maps its own min/max onto the 16 levels */
+            float minVal = FLT_MAX;
+            float maxVal = -FLT_MAX;
+            tinyaiSimdMinMax(values + start, (int)(stop - start), &minVal, &maxVal);
+            
+            float scale = (maxVal - minVal) / 15.0f;
+            if (scale == 0) {
+                /* All values are the same */
+                scale = 1.0f;
+            }
+            output->scales[r * groups + g] = scale;
+            output->zeroPoints[r * groups + g] = minVal;
+            
+            /* Values sharing a byte with a neighbouring group are merged in one at a time; the
+               whole bytes in between are packed by the SIMD kernel */
+            size_t first = r * cols + start;
+            size_t last = r * cols + stop;
+            uint32_t j = start;
+            if (first & 1) {
+                output->data[first / 2] |= (uint8_t)quantize4bitValue(values[j++], scale, minVal);
+            }
+            uint32_t pairs = (stop - j) / 2 * 2;
+            tinyaiSimdQuantize4BitAffine(output->data + (r * cols + j) / 2, values + j, (int)pairs,
+                                         scale, minVal);
+            if (j + pairs < stop) {
+                output->data[(last - 1) / 2] |=
+                    (uint8_t)(quantize4bitValue(values[stop - 1], scale, minVal) << 4);
+            }
         }
+    }
+}
+
+/**
+ * Quantize a FP32 matrix to 4-bit with a scale and zero point per group
+ */
+TinyAIMatrix4bit* tinyaiQuantizeFP32To4bitGrouped(const TinyAIMatrixFP32 *input,
+                                                  uint32_t groupSize) {
+    if (!input || !input->data) {
+        return NULL;
+    }
+    
+    TinyAIMatrix4bit *output = tinyaiCreateMatrix4bitGrouped(input->rows, input->cols, groupSize);
+    if (!output) {
+        return NULL;
+    }
+    
+    /* Rows share no bytes when the column count is even, so they can be split across threads */
+    QuantizeGroupedTask task = {input, output};
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    size_t grain = input->cols % 2 == 0 ? tinyaiThreadPoolGrain(pool, input->cols, 1)
+                                        : input->rows;
+    tinyaiParallelFor(pool, input->rows, grain, quantizeGroupedRows, &task);
+    
+    return output;
+}
+
+/* NF4 levels: quantiles of a standard normal distribution scaled to [-1, 1], with an exact 0 */
+static const float nf4Levels[TINYAI_CODEBOOK_LEVELS] = {
+    -1.0f,         -0.69619280f, -0.52507305f, -0.39491749f, -0.28444138f, -0.18477343f,
+    -0.09105004f,  0.0f,         0.07958030f,  0.16093020f,  0.24611230f,  0.33791524f,
+    0.44070983f,   0.56261700f,  0.72295684f,  1.0f};
+
+/* Row range of a codebook 4-bit quantization, run as a thread pool task */
+typedef struct {
+    const TinyAIMatrixFP32 *input;
+    TinyAIMatrix4bit       *output;
+    float                   bounds[TINYAI_CODEBOOK_LEVELS - 1]; /* Midpoints between levels */
+} QuantizeCodebookTask;
+
+static void quantizeCodebookRows(void *context, size_t begin, size_t end) {
+    const QuantizeCodebookTask *task = (const QuantizeCodebookTask *)context;
+    TinyAIMatrix4bit *output = task->output;
+    const float *levels = output->levels;
+    uint32_t cols = task->input->cols;
+    uint32_t groups = groupsPerRow(output);
+    
+    for (size_t r = begin; r < end; r++) {
+        const float *values = task->input->data + r * cols;
         
-        /* Pack two 4-bit values into one byte */
-        output->data[i / 2] = (val1 << 4) | val2;
+        for (uint32_t g = 0; g < groups; g++) {
+            uint32_t start = g * output->groupSize;
+            uint32_t stop = cols - start < output->groupSize ? cols : start + output->groupSize;
+            
+            /* Each group maps the codebook's range onto its own min/max */
+            float minVal = FLT_MAX;
+            float maxVal = -FLT_MAX;
+            tinyaiSimdMinMax(values + start, (int)(stop - start), &minVal, &maxVal);
+            
+            float scale = (maxVal - minVal) / (levels[TINYAI_CODEBOOK_LEVELS - 1] - levels[0]);
+            if (scale == 0) {
+                /* All values are the same */
+                scale = 1.0f;
+            }
+            float zeroPoint = minVal - levels[0] * scale;
+            output->scales[r * groups + g] = scale;
+            output->zeroPoints[r * groups + g] = zeroPoint;
+            
+            /* The nearest level is the number of midpoints below the value */
+            for (uint32_t j = start; j < stop; j++) {
+                float t = (values[j] - zeroPoint) / scale;
+                int q = 0;
+                for (int i = 0; i < TINYAI_CODEBOOK_LEVELS - 1; i++) {
+                    q += t > task->bounds[i];
+                }
+                
+                size_t idx = r * cols + j;
+                output->data[idx / 2] |= (uint8_t)((idx & 1) ? q : q << 4);
+            }
+        }
+    }
+}
+
+/**
+ * Quantize a FP32 matrix to 4-bit codebook indices with a scale and zero point per group
+ */
+TinyAIMatrix4bit* tinyaiQuantizeFP32To4bitCodebook(const TinyAIMatrixFP32 *input,
+                                                   const float *levels, uint32_t groupSize) {
+    if (!input || !input->data) {
+        return NULL;
+    }
+    if (!levels) {
+        levels = nf4Levels;
     }
     
+    /* Levels must be strictly increasing for the nearest-level search */
+    QuantizeCodebookTask task;
+    for (int i = 0; i < TINYAI_CODEBOOK_LEVELS - 1; i++) {
+        if (!(levels[i] < levels[i + 1])) {
+            return NULL;
+        }
+        task.bounds[i] = 0.5f * (levels[i] + levels[i + 1]);
+    }
+    
+    TinyAIMatrix4bit *output = tinyaiCreateMatrix4bitGrouped(input->rows, input->cols, groupSize);
+    if (!output) {
+        return NULL;
+    }
+    
+    output->levels = (float*)TINYAI_MALLOC(TINYAI_CODEBOOK_LEVELS * sizeof(float));
+    if (!output->levels) {
+        tinyaiDestroyMatrix4bit(output);
+        return NULL;
+    }
+    memcpy(output->levels, levels, TINYAI_CODEBOOK_LEVELS * sizeof(float));
+    
+    /* Rows share no bytes when the column count is even, so they can be split across threads */
+    task.input = input;
+    task.output = output;
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    size_t grain = input->cols % 2 == 0 ? tinyaiThreadPoolGrain(pool, input->cols, 1)
+                                        : input->rows;
+    tinyaiParallelFor(pool, input->rows, grain, quantizeCodebookRows, &task);
+    
     return output;
 }
 
@@ -219,14 +701,9 @@ TinyAIMatrix8bit* tinyaiQuantizeFP32To8bit(const TinyAIMatrixFP32 *input) {
     }
     
     /* Find min and max values */
-    float minVal = FLT_MAX;
-    float maxVal = -FLT_MAX;
-    
-    size_t size = input->rows * input->cols;
-    for (size_t i = 0; i < size; i++) {
-        if (input->data[i] < minVal) minVal = input->data[i];
-        if (input->data[i] > maxVal) maxVal = input->data[i];
-    }
+    float minVal, maxVal;
+    size_t size = (size_t)input->rows * input->cols;
+    findMinMax(input->data, size, &minVal, &maxVal);
     
     /* Compute scale and zero point */
     output->zeroPoint = minVal;
@@ -238,17 +715,66 @@ TinyAIMatrix8bit* tinyaiQuantizeFP32To8bit(const TinyAIMatrixFP32 *input) {
     }
     
     /* Quantize the values */
-    for (size_t i = 0; i < size; i++) {
-        int val = (int)((input->data[i] - output->zeroPoint) / output->scale + 0.5f);
-        if (val < -127) val = -127;
-        if (val > 127) val = 127;
-        
-        output->data[i] = (int8_t)val;
-    }
+    quantizeAffine(input->data, output->data, size, 8, output->scale, output->zeroPoint);
     
     return output;
 }
 
+/* Dequantize n consecutive values of a 4-bit matrix that share a scale and zero point, through
+   the codebook if levels is set */
+static void dequantize4bitSpan(const uint8_t *data, size_t start, uint32_t n,
+                               const float *levels, float scale, float zeroPoint, float *dst) {
+    const uint8_t *src = data + start / 2;
+    
+    /* A span starting on a low nibble: unpack it so the rest is byte aligned */
+    if ((start & 1) && n > 0) {
+        int q = *src++ & 0x0F;
+        *dst++ = (levels ? levels[q] : q) * scale + zeroPoint;
+        n--;
+    }
+    
+    if (levels) {
+        tinyaiSimdDequantize4BitCodebook(dst, src, (int)n, levels, scale, zeroPoint);
+    } else {
+        tinyaiSimdDequantize4BitAffine(dst, src, (int)n, scale, zeroPoint);
+    }
+}
+
+/* Dequantize one row of a 4-bit matrix, group by group if it is group-quantized */
+static void dequantize4bitRow(const TinyAIMatrix4bit *matrix, uint32_t row, float *dst) {
+    size_t start = (size_t)row * matrix->cols;
+    
+    /* A prepacked row is 8 bytes in each panel: first the low nibbles, then the high ones */
+    if (matrix->layout == TINYAI_MATRIX4BIT_PANELS) {
+        for (uint32_t j = 0; j < matrix->cols; j += PANEL_COLS) {
+            const uint8_t *bytes = matrix->data + ((size_t)(j / PANEL_COLS) * matrix->rows + row) *
+                                                      PANEL_ROW_BYTES;
+            uint32_t n = matrix->cols - j < PANEL_COLS ? matrix->cols - j : PANEL_COLS;
+            for (uint32_t i = 0; i < n; i++) {
+                int q = i < PANEL_ROW_BYTES ? (bytes[i] & 0x0F) : (bytes[i - PANEL_ROW_BYTES] >> 4);
+                dst[j + i] = q * matrix->scale + matrix->zeroPoint;
+            }
+        }
+        return;
+    }
+    
+    if (!matrix->scales) {
+        dequantize4bitSpan(matrix->data, start, matrix->cols, NULL, matrix->scale,
+                           matrix->zeroPoint, dst);
+        return;
+    }
+    
+    uint32_t groups = groupsPerRow(matrix);
+    for (uint32_t g = 0; g < groups; g++) {
+        uint32_t first = g * matrix->groupSize;
+        uint32_t n = matrix->cols - first < matrix->groupSize ? matrix->cols - first
+                                                               : matrix->groupSize;
+        size_t index = (size_t)row * groups + g;
+        dequantize4bitSpan(matrix->data, start + first, n, matrix->levels,
+                           matrix->scales[index], matrix->zeroPoints[index], dst + first);
+    }
+}
+
 /**
  * Dequantize a 4-bit matrix to FP32
  */
@@ -262,6 +788,13 @@ TinyAIMatrixFP32* tinyaiDequantize4bitToFP32(const TinyAIMatrix4bit *input) {
         return NULL;
     }
     
+    if (input->scales || input->layout == TINYAI_MATRIX4BIT_PANELS) {
+        for (uint32_t r = 0; r < input->rows; r++) {
+            dequantize4bitRow(input, r, output->data + (size_t)r * input->cols);
+        }
+        return output;
+    }
+    
     size_t size = input->rows * input->cols;
     for (size_t i = 0; i < size; i += 2) {
         /* Unpack first value */
@@ -301,6 +834,9 @@ TinyAIMatrixFP32* tinyaiDequantize8bitToFP32(const TinyAIMatrix8bit *input) {
 
 /* ----------------- Matrix Operations ----------------- */
 
+static int matMulInt8Activations(const TinyAIMatrixFP32 *A, const void *b,
+                                 TinyAIPrecision precision, TinyAIMatrixFP32 *C);
+
 /**
  * Matrix multiplication: C = A * B
  */
@@ -405,8 +941,11 @@ int tinyaiMatrixMultiply(const void *a, const void *b, void *c, TinyAIPrecision
             /* Compute in FP32 */
             tinyaiMatrixMultiply(Afp32, Bfp32, Cfp32, TINYAI_PRECISION_FP32);
             
-            /* Requantize */
-            TinyAIMatrix4bit *Cnew = tinyaiQuantizeFP32To4bit(Cfp32);
+            /* Requantize, keeping C's groups and codebook if it has them */
+            TinyAIMatrix4bit *Cnew =
+                C->levels   ? tinyaiQuantizeFP32To4bitCodebook(Cfp32, C->levels, C->groupSize)
+                : C->scales ? tinyaiQuantizeFP32To4bitGrouped(Cfp32, C->groupSize)
+                            : tinyaiQuantizeFP32To4bit(Cfp32);
             if (!Cnew) {
                 tinyaiDestroyMatrixFP32(Afp32);
                 tinyaiDestroyMatrixFP32(Bfp32);
@@ -414,11 +953,22 @@ int tinyaiMatrixMultiply(const void *a, const void *b, void *c, TinyAIPrecision
                 return -1;
             }
             
-            /* Copy results back to C */
-            size_t dataSize = (C->rows * C->cols + 1) / 2;
-            memcpy(C->data, Cnew->data, dataSize);
+            /* Copy results back to C in its layout */
+            if (C->layout == TINYAI_MATRIX4BIT_PANELS && tinyaiMatrix4bitPrepack(Cnew) != 0) {
+                tinyaiDestroyMatrixFP32(Afp32);
+                tinyaiDestroyMatrixFP32(Bfp32);
+                tinyaiDestroyMatrixFP32(Cfp32);
+                tinyaiDestroyMatrix4bit(Cnew);
+                return -1;
+            }
+            memcpy(C->data, Cnew->data, tinyaiMatrix4bitDataSize(C));
             C->scale = Cnew->scale;
             C->zeroPoint = Cnew->zeroPoint;
+            if (C->scales) {
+                size_t groups = tinyaiMatrix4bitGroupCount(C);
+                memcpy(C->scales, Cnew->scales, groups * sizeof(float));
+                memcpy(C->zeroPoints, Cnew->zeroPoints, groups * sizeof(float));
+            }
             
             /* Clean up */
             tinyaiDestroyMatrixFP32(Afp32);
@@ -429,6 +979,11 @@ int tinyaiMatrixMultiply(const void *a, const void *b, void *c, TinyAIPrecision
             return 0;
         }
         
+        case TINYAI_PRECISION_INT4_A8:
+        case TINYAI_PRECISION_INT8_A8:
+            return matMulInt8Activations((const TinyAIMatrixFP32 *)a, b, precision,
+                                         (TinyAIMatrixFP32 *)c);
+        
         default:
             return -1;  /* Unknown precision */
     }
@@ -489,41 +1044,39 @@ int tinyaiMatrixActivation(const void *input, void *output, int activation, Tiny
                 return -1;  /* Incompatible dimensions */
             }
             
-            /* Apply activation function */
+            /* Map matrix activation codes onto the vectorized kernels */
             size_t size = in->rows * in->cols;
+            int simdActivation;
             switch (activation) {
                 case 0:  /* None */
-                    memcpy(out->data, in->data, size * sizeof(float));
+                    simdActivation = -1;
                     break;
-                
-                case 1:  /* ReLU */
-                    for (size_t i = 0; i < size; i++) {
-                        out->data[i] = tinyaiActivationReLU(in->data[i]);
-                    }
+                case 1:
+                    simdActivation = TINYAI_SIMD_ACTIVATION_RELU;
                     break;
-                
-                case 2:  /* Sigmoid */
-                    for (size_t i = 0; i < size; i++) {
-                        out->data[i] = tinyaiActivationSigmoid(in->data[i]);
-                    }
+                case 2:
+                    simdActivation = TINYAI_SIMD_ACTIVATION_SIGMOID;
                     break;
-                
-                case 3:  /* Tanh */
-                    for (size_t i = 0; i < size; i++) {
-                        out->data[i] = tinyaiActivationTanh(in->data[i]);
-                    }
+                case 3:
+                    simdActivation = TINYAI_SIMD_ACTIVATION_TANH;
                     break;
-                
-                case 4:  /* GELU */
-                    for (size_t i = 0; i < size; i++) {
-                        out->data[i] = tinyaiActivationGELU(in->data[i]);
-                    }
+                case 4:
+                    simdActivation = TINYAI_SIMD_ACTIVATION_GELU;
+                    break;
+                case 5:
+                    simdActivation = TINYAI_SIMD_ACTIVATION_SILU;
                     break;
-                
                 default:
                     return -1;  /* Unknown activation */
             }
             
+            if (out->data != in->data) {
+                memcpy(out->data, in->data, size * sizeof(float));
+            }
+            if (simdActivation >= 0) {
+                tinyaiSimdActivate(out->data, (int)size, simdActivation);
+            }
+            
             return 0;
         }
         
@@ -535,6 +1088,470 @@ int tinyaiMatrixActivation(const void *input, void *output, int activation, Tiny
     }
 }
 
+/**
+ * Set the precision of activations in quantized-weight layers
+ */
+int tinyaiSetActivationPrecision(TinyAIPrecision precision) {
+    if (precision != TINYAI_PRECISION_FP32 && precision != TINYAI_PRECISION_INT8) {
+        return -1;
+    }
+    activationPrecision = precision;
+    return 0;
+}
+
+/**
+ * Get the precision of activations in quantized-weight layers
+ */
+TinyAIPrecision tinyaiGetActivationPrecision(void) {
+    return activationPrecision;
+}
+
+/* Int8 inputs of a matrix multiplication up to this size live on the stack */
+#define MATMUL_INT8_SCRATCH_BYTES 8192
+
+/* Quantize count input vectors to int8 with one scale each, stored as [count scales][bytes] in
+   scratch when it is large enough and on the heap otherwise; returns the scales */
+static float *quantizeInputsInt8(const float *input, uint32_t count, uint32_t rows,
+                                 float *scratch, size_t scratchBytes) {
+    size_t bytes  = (size_t)count * (sizeof(float) + rows);
+    float *scales = bytes <= scratchBytes ? scratch : (float *)TINYAI_MALLOC(bytes);
+    if (!scales) {
+        return NULL;
+    }
+    
+    int8_t *data = (int8_t *)(scales + count);
+    for (uint32_t b = 0; b < count; b++) {
+        scales[b] = tinyaiSimdQuantizeInt8(data + (size_t)b * rows, input + (size_t)b * rows,
+                                           (int)rows);
+    }
+    return scales;
+}
+
+/**
+ * Vector-matrix multiplication on packed 4-bit weights
+ */
+int tinyaiMatrix4bitVecMul(const TinyAIMatrix4bit *matrix, const float *input,
+                           const float *bias, float *output) {
+    return tinyaiMatrix4bitMatMul(matrix, input, 1, bias, output);
+}
+
+/* Input vectors below which a 4-bit matrix multiplication runs untiled */
+#define MATMUL_TILE_MIN_COUNT 32
+
+/* Output column range of a group of 4-bit matrix multiplications, run as a thread pool task */
+typedef struct {
+    const TinyAIMatrix4bit *const *matrices;
+    const float *const            *biases;
+    float *const                  *outputs;
+    uint32_t                       numMatrices;
+    const float                   *input;
+    uint32_t                       count;
+    uint32_t colStart[TINYAI_MATMUL_GROUP_MAX + 1]; /* First column of each matrix in the group */
+    uint32_t tileCount;                             /* Input vectors per tile */
+    uint32_t tileCols;                              /* Output columns per tile (multiple of 16) */
+    const int8_t *inputInt8;                        /* Int8 copy of input, or NULL to use FP32 */
+    const float  *inputScales;                      /* Scale of each int8 input vector */
+    int           activation;                       /* TINYAI_SIMD_ACTIVATION_* after the bias */
+} MatMul4bitTask;
+
+static void matMul4bitColumns(void *context, size_t begin, size_t end) {
+    const MatMul4bitTask *task = (const MatMul4bitTask *)context;
+    uint32_t              rows = task->matrices[0]->rows;
+    
+    /* Each input tile is loaded once for every matrix whose columns fall in the range */
+    for (uint32_t b = 0; b < task->count; b += task->tileCount) {
+        uint32_t     n     = task->count - b < task->tileCount ? task->count - b : task->tileCount;
+        const float *input = task->input + (size_t)b * rows;
+        const int8_t *inputInt8 = task->inputInt8 ? task->inputInt8 + (size_t)b * rows : NULL;
+        
+        for (uint32_t m = 0; m < task->numMatrices; m++) {
+            size_t first = begin > task->colStart[m] ? begin : task->colStart[m];
+            size_t last  = end < task->colStart[m + 1] ? end : task->colStart[m + 1];
+            if (first >= last) {
+                continue;
+            }
+            
+            /* Columns of this matrix within the range */
+            const TinyAIMatrix4bit *matrix = task->matrices[m];
+            float                  *output = task->outputs[m] + (size_t)b * matrix->cols;
+            size_t                  c0     = first - task->colStart[m];
+            size_t                  c1     = last - task->colStart[m];
+            
+            /* Weights replicated across NUMA nodes are read from this thread's node */
+            const uint8_t *data = (const uint8_t *)tinyaiNumaLocal(matrix->data);
+            
+            /* Each tile accumulates into an output block small enough to stay in cache */
+            for (size_t c = c0; c < c1; c += task->tileCols) {
+                size_t cEnd = c + task->tileCols < c1 ? c + task->tileCols : c1;
+                if (inputInt8) {
+                    tinyaiSimdMatMul4BitInt8Columns(
+                        output, data, inputInt8, task->inputScales + b, (int)n,
+                        (int)matrix->rows, (int)matrix->cols, (int)c, (int)cEnd, matrix->scale,
+                        matrix->zeroPoint);
+                    continue;
+                }
+                if (matrix->layout == TINYAI_MATRIX4BIT_PANELS) {
+                    tinyaiSimdMatMul4BitPanelsColumns(output, data, input, (int)n,
+                                                      (int)matrix->rows, (int)matrix->cols,
+                                                      (int)c, (int)cEnd, matrix->scale,
+                                                      matrix->zeroPoint);
+                    continue;
+                }
+                if (matrix->levels) {
+                    tinyaiSimdMatMul4BitCodebookColumns(
+                        output, data, input, (int)n, (int)matrix->rows,
+                        (int)matrix->cols, (int)c, (int)cEnd, matrix->levels, matrix->scales,
+                        matrix->zeroPoints, (int)matrix->groupSize);
+                    continue;
+                }
+                if (matrix->scales) {
+                    tinyaiSimdMatMul4BitGroupedColumns(
+                        output, data, input, (int)n, (int)matrix->rows,
+                        (int)matrix->cols, (int)c, (int)cEnd, matrix->scales,
+                        matrix->zeroPoints, (int)matrix->groupSize);
+                    continue;
+                }
+                tinyaiSimdMatMul4BitAffineColumns(output, data, input, (int)n,
+                                                  (int)matrix->rows, (int)matrix->cols, (int)c,
+                                                  (int)cEnd, matrix->scale, matrix->zeroPoint);
+            }
+            
+            /* Bias and activation in one pass while the block is still in cache */
+            TinyAIElementwiseOp epilogue[2];
+            int                 numOps = 0;
+            if (task->biases && task->biases[m]) {
+                epilogue[numOps++] = (TinyAIElementwiseOp){TINYAI_SIMD_EW_BIAS, 0,
+                                                           task->biases[m] + c0, NULL, 0.0f, 0.0f};
+            }
+            if (task->activation != TINYAI_SIMD_ACTIVATION_NONE) {
+                epilogue[numOps++] = (TinyAIElementwiseOp){TINYAI_SIMD_EW_ACTIVATION,
+                                                           task->activation, NULL, NULL, 0.0f,
+                                                           0.0f};
+            }
+            if (numOps > 0) {
+                for (uint32_t i = 0; i < n; i++) {
+                    float *row = output + (size_t)i * matrix->cols + c0;
+                    tinyaiSimdElementwise(row, row, 1, (int)(c1 - c0), epilogue, numOps);
+                }
+            }
+        }
+    }
+}
+
+/* Pick the tile of a 4-bit matrix multiplication from the cache-blocking heuristics */
+static void matMul4bitTileSize(MatMul4bitTask *task) {
+    uint32_t rows = task->matrices[0]->rows;
+    uint32_t cols = task->colStart[task->numMatrices];
+    
+    task->tileCount = task->count > 0 ? task->count : 1;
+    task->tileCols  = cols;
+    if (task->count <= MATMUL_TILE_MIN_COUNT) {
+        return;
+    }
+    
+    TinyAICacheOptConfig config;
+    memset(&config, 0, sizeof(config));
+    tinyai_cache_opt_matrix_multiply(task->count, cols, rows, &config);
+    if (!config.enableTiling || config.blockSizeX == 0) {
+        return;
+    }
+    
+    /* Rows of the block, and as many columns as keep it within half of L1 */
+    TinyAICacheInfo cacheInfo = tinyai_get_cache_info();
+    size_t          tileCols  = cacheInfo.l1dCacheSize / 2 / (config.blockSizeX * sizeof(float));
+    tileCols                  = tileCols / 16 * 16;
+    
+    task->tileCount = (uint32_t)config.blockSizeX;
+    if (tileCols >= 16 && tileCols < cols) {
+        task->tileCols = (uint32_t)tileCols;
+    }
+}
+
+/**
+ * Matrix multiplication on packed 4-bit weights
+ */
+int tinyaiMatrix4bitMatMul(const TinyAIMatrix4bit *matrix, const float *input, uint32_t count,
+                           const float *bias, float *output) {
+    return tinyaiMatrix4bitMatMulGroup(&matrix, &bias, &output, 1, input, count);
+}
+
+/**
+ * Grouped matrix multiplication on packed 4-bit weights sharing one input
+ * 
+ * The matrices' output columns form one index space that is split across the
+ * shared thread pool in multiples of 16, the SIMD kernel's block width, and
+ * large batches (prompt prefill) are tiled over inputs and columns; each
+ * output row matches the untiled serial product bit for bit. With int8
+ * activations the input is quantized once up front for all matrices.
+ */
+static int matMul4bitGroup(const TinyAIMatrix4bit *const *matrices, const float *const *biases,
+                           float *const *outputs, uint32_t numMatrices, const float *input,
+                           uint32_t count, int int8Activations, int activation) {
+    if (!matrices || !outputs || !input || numMatrices == 0 ||
+        numMatrices > TINYAI_MATMUL_GROUP_MAX) {
+        return -1;
+    }
+    
+    MatMul4bitTask task = {matrices, biases, outputs, numMatrices, input, count, {0}, 0, 0,
+                           NULL, NULL, activation};
+    for (uint32_t m = 0; m < numMatrices; m++) {
+        if (!matrices[m] || !matrices[m]->data || !outputs[m] ||
+            matrices[m]->rows != matrices[0]->rows) {
+            return -1;
+        }
+        task.colStart[m + 1] = task.colStart[m] + matrices[m]->cols;
+        
+        /* Per-group scales vary along a row, so they cannot be applied after an integer sum;
+           prepacked matrices have float kernels only */
+        if (matrices[m]->scales || matrices[m]->layout == TINYAI_MATRIX4BIT_PANELS) {
+            int8Activations = 0;
+        }
+    }
+    matMul4bitTileSize(&task);
+    
+    float scratch[MATMUL_INT8_SCRATCH_BYTES / sizeof(float)];
+    if (int8Activations) {
+        float *scales = quantizeInputsInt8(input, count, matrices[0]->rows, scratch,
+                                           sizeof(scratch));
+        if (!scales) {
+            return -1;
+        }
+        task.inputScales = scales;
+        task.inputInt8   = (const int8_t *)(scales + count);
+    }
+    
+    TinyAIThreadPool *pool  = tinyaiGetThreadPool();
+    size_t            grain = tinyaiThreadPoolGrain(
+        pool, (size_t)matrices[0]->rows * (count > 0 ? count : 1), 16);
+    
+    tinyaiParallelFor(pool, task.colStart[numMatrices], grain, matMul4bitColumns, &task);
+    
+    if (task.inputScales && task.inputScales != scratch) {
+        TINYAI_FREE((void *)task.inputScales);
+    }
+    return 0;
+}
+
+/**
+ * Grouped matrix multiplication on packed 4-bit weights sharing one input
+ */
+int tinyaiMatrix4bitMatMulGroup(const TinyAIMatrix4bit *const *matrices,
+                                const float *const *biases, float *const *outputs,
+                                uint32_t numMatrices, const float *input, uint32_t count) {
+    return matMul4bitGroup(matrices, biases, outputs, numMatrices, input, count,
+                           activationPrecision == TINYAI_PRECISION_INT8,
+                           TINYAI_SIMD_ACTIVATION_NONE);
+}
+
+/**
+ * Matrix multiplication on packed 4-bit weights followed by an activation
+ */
+int tinyaiMatrix4bitMatMulActivate(const TinyAIMatrix4bit *matrix, const float *input,
+                                   uint32_t count, const float *bias, int activation,
+                                   float *output) {
+    return matMul4bitGroup(&matrix, &bias, &output, 1, input, count,
+                           activationPrecision == TINYAI_PRECISION_INT8, activation);
+}
+
+/* Output column range of an 8-bit product with int8 activations, run as a thread pool task */
+typedef struct {
+    const TinyAIMatrix8bit *matrix;
+    const int8_t           *input;
+    const float            *inputScales;
+    uint32_t                count;
+    float                  *output;
+} MatMul8bitInt8Task;
+
+static void matMul8bitInt8Columns(void *context, size_t begin, size_t end) {
+    const MatMul8bitInt8Task *task   = (const MatMul8bitInt8Task *)context;
+    const TinyAIMatrix8bit   *matrix = task->matrix;
+    
+    tinyaiSimdMatMul8BitInt8Columns(task->output, matrix->data, task->input, task->inputScales,
+                                    (int)task->count, (int)matrix->rows, (int)matrix->cols,
+                                    (int)begin, (int)end, matrix->scale, matrix->zeroPoint);
+}
+
+/**
+ * FP32 activations times 4-bit or 8-bit weights with int8 activations
+ */
+static int matMulInt8Activations(const TinyAIMatrixFP32 *A, const void *b,
+                                 TinyAIPrecision precision, TinyAIMatrixFP32 *C) {
+    if (!A || !b || !C || !A->data || !C->data || C->rows != A->rows) {
+        return -1;
+    }
+    
+    if (precision == TINYAI_PRECISION_INT4_A8) {
+        const TinyAIMatrix4bit *B = (const TinyAIMatrix4bit *)b;
+        if (!B->data || A->cols != B->rows || C->cols != B->cols) {
+            return -1;  /* Incompatible dimensions */
+        }
+        return matMul4bitGroup(&B, NULL, &C->data, 1, A->data, A->rows, 1,
+                               TINYAI_SIMD_ACTIVATION_NONE);
+    }
+    
+    const TinyAIMatrix8bit *B = (const TinyAIMatrix8bit *)b;
+    if (!B->data || A->cols != B->rows || C->cols != B->cols) {
+        return -1;  /* Incompatible dimensions */
+    }
+    
+    float  scratch[MATMUL_INT8_SCRATCH_BYTES / sizeof(float)];
+    float *scales = quantizeInputsInt8(A->data, A->rows, A->cols, scratch, sizeof(scratch));
+    if (!scales) {
+        return -1;
+    }
+    
+    MatMul8bitInt8Task task = {B, (const int8_t *)(scales + A->rows), scales, A->rows, C->data};
+    TinyAIThreadPool  *pool = tinyaiGetThreadPool();
+    size_t grain = tinyaiThreadPoolGrain(pool, (size_t)B->rows * (A->rows > 0 ? A->rows : 1), 16);
+    tinyaiParallelFor(pool, B->cols, grain, matMul8bitInt8Columns, &task);
+    
+    if (scales != scratch) {
+        TINYAI_FREE(scales);
+    }
+    return 0;
+}
+
+/* Selected output columns of a 4-bit vector-matrix product, run as a thread pool task */
+typedef struct {
+    const TinyAIMatrix4bit *matrix;
+    const float            *input;
+    float                   inputSum;
+    const uint32_t         *columns;
+    const float            *bias;
+    float                  *output;
+} VecMulColumnsTask;
+
+/* Selected columns of a group-quantized or codebook matrix: each weight is dequantized as it is
+   read */
+static void vecMul4bitSelectedColumnsGrouped(const VecMulColumnsTask *task, size_t begin,
+                                             size_t end) {
+    const TinyAIMatrix4bit *matrix = task->matrix;
+    float                  *acc    = task->output;
+    uint32_t                groups = groupsPerRow(matrix);
+    
+    for (size_t j = begin; j < end; j++) {
+        acc[j] = 0.0f;
+    }
+    
+    for (uint32_t k = 0; k < matrix->rows; k++) {
+        float x = task->input[k];
+        if (x == 0.0f) {
+            continue;
+        }
+        
+        size_t       base       = (size_t)k * matrix->cols;
+        const float *rowScales  = matrix->scales + (size_t)k * groups;
+        const float *rowOffsets = matrix->zeroPoints + (size_t)k * groups;
+        for (size_t j = begin; j < end; j++) {
+            uint32_t col    = task->columns[j];
+            uint32_t g      = col / matrix->groupSize;
+            size_t   idx    = base + col;
+            uint8_t  packed = matrix->data[idx / 2];
+            int      q      = (idx & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+            float    level  = matrix->levels ? matrix->levels[q] : (float)q;
+            acc[j] += x * (level * rowScales[g] + rowOffsets[g]);
+        }
+    }
+    
+    if (task->bias) {
+        for (size_t j = begin; j < end; j++) {
+            acc[j] += task->bias[task->columns[j]];
+        }
+    }
+}
+
+static void vecMul4bitSelectedColumns(void *context, size_t begin, size_t end) {
+    /* Weights replicated across NUMA nodes are read from this thread's node */
+    VecMulColumnsTask local       = *(const VecMulColumnsTask *)context;
+    TinyAIMatrix4bit  localMatrix = *local.matrix;
+    localMatrix.data              = (uint8_t *)tinyaiNumaLocal(localMatrix.data);
+    local.matrix                  = &localMatrix;
+    
+    const VecMulColumnsTask *task   = &local;
+    const TinyAIMatrix4bit  *matrix = task->matrix;
+    float                   *acc    = task->output;
+    
+    if (matrix->scales) {
+        vecMul4bitSelectedColumnsGrouped(task, begin, end);
+        return;
+    }
+    
+    for (size_t j = begin; j < end; j++) {
+        acc[j] = 0.0f;
+    }
+    
+    /* Row by row, so sorted columns sweep each packed row front to back */
+    for (uint32_t k = 0; k < matrix->rows; k++) {
+        float x = task->input[k];
+        if (x == 0.0f) {
+            continue;
+        }
+        
+        for (size_t j = begin; j < end; j++) {
+            acc[j] += x * matrix4bitValue(matrix, k, task->columns[j]);
+        }
+    }
+    
+    /* Apply scale and zero point once per output */
+    for (size_t j = begin; j < end; j++) {
+        acc[j] = acc[j] * matrix->scale + task->inputSum * matrix->zeroPoint;
+        if (task->bias) {
+            acc[j] += task->bias[task->columns[j]];
+        }
+    }
+}
+
+/**
+ * Vector-matrix multiplication for selected output columns of packed 4-bit weights
+ */
+int tinyaiMatrix4bitVecMulColumns(const TinyAIMatrix4bit *matrix, const float *input,
+                                  const uint32_t *columns, uint32_t count, const float *bias,
+                                  float *output) {
+    if (!matrix || !matrix->data || !input || !columns || !output) {
+        return -1;
+    }
+    
+    for (uint32_t j = 0; j < count; j++) {
+        if (columns[j] >= matrix->cols) {
+            return -1;
+        }
+    }
+    
+    float inputSum = 0.0f;
+    for (uint32_t k = 0; k < matrix->rows; k++) {
+        inputSum += input[k];
+    }
+    
+    VecMulColumnsTask task = {matrix, input, inputSum, columns, bias, output};
+    
+    TinyAIThreadPool *pool  = tinyaiGetThreadPool();
+    size_t            grain = tinyaiThreadPoolGrain(pool, matrix->rows, 1);
+    tinyaiParallelFor(pool, count, grain, vecMul4bitSelectedColumns, &task);
+    
+    return 0;
+}
+
+/**
+ * Dequantize selected rows of a 4-bit matrix
+ */
+int tinyaiMatrix4bitGatherRows(const TinyAIMatrix4bit *matrix, const int *rowIndices,
+                               uint32_t count, float *output) {
+    if (!matrix || !matrix->data || !rowIndices || !output) {
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        int row = rowIndices[i];
+        if (row < 0 || (uint32_t)row >= matrix->rows) {
+            return -1;
+        }
+        
+        dequantize4bitRow(matrix, (uint32_t)row, output + (size_t)i * matrix->cols);
+    }
+    
+    return 0;
+}
+
 /* ----------------- Vector Operations ----------------- */
 
 /**
@@ -645,19 +1662,6 @@ float tinyaiActivationReLU(float x) {
  * Sigmoid activation function
  */
 float tinyaiActivationSigmoid(float x) {
-    /* Check for lookup table */
-    if (activationTableSigmoid) {
-        /* Convert x to table index */
-        int index = (int)((x - ACTIVATION_MIN) / (ACTIVATION_MAX - ACTIVATION_MIN) * ACTIVATION_TABLE_SIZE);
-        if (index < 0) index = 0;
-        if (index >= ACTIVATION_TABLE_SIZE) index = ACTIVATION_TABLE_SIZE - 1;
-        
-        return activationTableSigmoid[index];
-    }
-    
-    /* Compute directly */
-    if (x < -10.0f) return 0.0f;
-    if (x > 10.0f) return 1.0f;
     return 1.0f / (1.0f + expf(-x));
 }
 
@@ -665,79 +1669,23 @@ float tinyaiActivationSigmoid(float x) {
  * Tanh activation function
  */
 float tinyaiActivationTanh(float x) {
-    /* Check for lookup table */
-    if (activationTableTanh) {
-        /* Convert x to table index */
-        int index = (int)((x - ACTIVATION_MIN) / (ACTIVATION_MAX - ACTIVATION_MIN) * ACTIVATION_TABLE_SIZE);
-        if (index < 0) index = 0;
-        if (index >= ACTIVATION_TABLE_SIZE) index = ACTIVATION_TABLE_SIZE - 1;
-        
-        return activationTableTanh[index];
-    }
-    
-    /* Compute directly */
-    if (x < -5.0f) return -1.0f;
-    if (x > 5.0f) return 1.0f;
-    float ex = expf(x);
-    float enx = expf(-x);
-    return (ex - enx) / (ex + enx);
+    return tanhf(x);
 }
 
 /**
- * GELU activation function
+ * GELU activation function (tanh approximation)
  */
 float tinyaiActivationGELU(float x) {
-    /* Check for lookup table */
-    if (activationTableGELU) {
-        /* Convert x to table index */
-        int index = (int)((x - ACTIVATION_MIN) / (ACTIVATION_MAX - ACTIVATION_MIN) * ACTIVATION_TABLE_SIZE);
-        if (index < 0) index = 0;
-        if (index >= ACTIVATION_TABLE_SIZE) index = ACTIVATION_TABLE_SIZE - 1;
-        
-        return activationTableGELU[index];
-    }
-    
-    /* Compute directly (approximate) */
-    return 0.5f * x * (1.0f + tinyaiActivationTanh(0.7978845608f * (x + 0.044715f * x * x * x)));
+    return 0.5f * x * (1.0f + tanhf(0.7978845608f * (x + 0.044715f * x * x * x)));
 }
 
 /**
  * Initialize activation function lookup tables
+ *
+ * Activations are computed by vectorized polynomial kernels now, so there
+ * is nothing to build; kept so existing callers still link.
  */
 int tinyaiInitActivationTables() {
-    /* Allocate tables */
-    activationTableReLU = (float*)TINYAI_MALLOC(ACTIVATION_TABLE_SIZE * sizeof(float));
-    activationTableSigmoid = (float*)TINYAI_MALLOC(ACTIVATION_TABLE_SIZE * sizeof(float));
-    activationTableTanh = (float*)TINYAI_MALLOC(ACTIVATION_TABLE_SIZE * sizeof(float));
-    activationTableGELU = (float*)TINYAI_MALLOC(ACTIVATION_TABLE_SIZE * sizeof(float));
-    
-    if (!activationTableReLU || !activationTableSigmoid ||
-        !activationTableTanh || !activationTableGELU) {
-        tinyaiCleanupActivationTables();
-        return -1;
-    }
-    
-    /* Fill tables */
-    for (int i = 0; i < ACTIVATION_TABLE_SIZE; i++) {
-        float x = ACTIVATION_MIN + (ACTIVATION_MAX - ACTIVATION_MIN) * i / ACTIVATION_TABLE_SIZE;
-        
-        /* ReLU */
-        activationTableReLU[i] = x > 0.0f ? x : 0.0f;
-        
-        /* Sigmoid */
-        activationTableSigmoid[i] = 1.0f / (1.0f + expf(-x));
-        
-        /* Tanh */
-        {
-            float ex = expf(x);
-            float enx = expf(-x);
-            activationTableTanh[i] = (ex - enx) / (ex + enx);
-        }
-        
-        /* GELU (approximate) */
-        activationTableGELU[i] = 0.5f * x * (1.0f + activationTableTanh[i]); 
-    }
-    
     return 0;
 }
 
@@ -745,25 +1693,6 @@ int tinyaiInitActivationTables() {
  * Clean up activation function lookup tables
  */
 void tinyaiCleanupActivationTables() {
-    if (activationTableReLU) {
-        TINYAI_FREE(activationTableReLU);
-        activationTableReLU = NULL;
-    }
-    
-    if (activationTableSigmoid) {
-        TINYAI_FREE(activationTableSigmoid);
-        activationTableSigmoid = NULL;
-    }
-    
-    if (activationTableTanh) {
-        TINYAI_FREE(activationTableTanh);
-        activationTableTanh = NULL;
-    }
-    
-    if (activationTableGELU) {
-        TINYAI_FREE(activationTableGELU);
-        activationTableGELU = NULL;
-    }
 }
 
 /* ----------------- Utility Functions ----------------- */
@@ -776,16 +1705,7 @@ void tinyaiFindMinMax(const float *data, size_t size, float *min, float *max) {
         return;
     }
     
-    float minVal = FLT_MAX;
-    float maxVal = -FLT_MAX;
-    
-    for (size_t i = 0; i < size; i++) {
-        if (data[i] < minVal) minVal = data[i];
-        if (data[i] > maxVal) maxVal = data[i];
-    }
-    
-    *min = minVal;
-    *max = maxVal;
+    findMinMax(data, size, min, max);
 }
 
 /**
@@ -796,13 +1716,31 @@ int tinyaiSaveQuantizedMatrix(const void *matrix, const char *path, TinyAIPrecis
         return -1;
     }
     
+    /* Files hold row-major data; a prepacked matrix is saved from a row-major copy */
+    if (precision == TINYAI_PRECISION_INT4 &&
+        ((const TinyAIMatrix4bit *)matrix)->layout == TINYAI_MATRIX4BIT_PANELS) {
+        TinyAIMatrix4bit rowMajor = {0};
+        if (tinyaiCopyMatrix4bit(&rowMajor, (const TinyAIMatrix4bit *)matrix) != 0 ||
+            tinyaiMatrix4bitUnpack(&rowMajor) != 0) {
+            tinyaiReleaseMatrix4bit(&rowMajor);
+            return -1;
+        }
+        int result = tinyaiSaveQuantizedMatrix(&rowMajor, path, precision);
+        tinyaiReleaseMatrix4bit(&rowMajor);
+        return result;
+    }
+    
     TinyAIFile *file = tinyaiOpenFile(path, TINYAI_FILE_WRITE | TINYAI_FILE_BINARY | TINYAI_FILE_CREATE);
     if (!file) {
         return -1;
     }
     
     /* Write header with magic number, precision, and dimensions */
-    uint32_t magic = 0x4D51544E; /* "TQNM" - TinyAI Quantized Matrix */
+    uint32_t magic = QUANTIZED_MATRIX_MAGIC;
+    if (precision == TINYAI_PRECISION_INT4 && ((const TinyAIMatrix4bit *)matrix)->scales) {
+        magic = ((const TinyAIMatrix4bit *)matrix)->levels ? QUANTIZED_MATRIX_CODEBOOK_MAGIC
+                                                           : QUANTIZED_MATRIX_GROUPED_MAGIC;
+    }
     tinyaiWriteFile(file, &magic, sizeof(magic));
     tinyaiWriteFile(file, &precision, sizeof(precision));
     
@@ -838,6 +1776,19 @@ int tinyaiSaveQuantizedMatrix(const void *matrix, const char *path, TinyAIPrecis
             tinyaiWriteFile(file, &mat->scale, sizeof(mat->scale));
             tinyaiWriteFile(file, &mat->zeroPoint, sizeof(mat->zeroPoint));
             
+            /* Group-quantized matrices follow with their group size and per-group scales */
+            if (mat->scales) {
+                size_t groups = tinyaiMatrix4bitGroupCount(mat);
+                tinyaiWriteFile(file, &mat->groupSize, sizeof(mat->groupSize));
+                tinyaiWriteFile(file, mat->scales, groups * sizeof(float));
+                tinyaiWriteFile(file, mat->zeroPoints, groups * sizeof(float));
+                
+                /* ...and codebook matrices with their levels */
+                if (mat->levels) {
+                    tinyaiWriteFile(file, mat->levels, TINYAI_CODEBOOK_LEVELS * sizeof(float));
+                }
+            }
+            
             /* Write the data (4-bit packed, 2 values per byte) */
             size_t dataSize = (mat->rows * mat->cols + 1) / 2;
             tinyaiWriteFile(file, mat->data, dataSize);
@@ -871,7 +1822,9 @@ void* tinyaiLoadQuantizedMatrix(const char *path, TinyAIPrecision precision) {
     TinyAIPrecision filePrecision;
     
     if (tinyaiReadFile(file, &magic, sizeof(magic)) != sizeof(magic) ||
-        magic != 0x4D51544E) {
+        (magic != QUANTIZED_MATRIX_MAGIC &&
+         ((magic != QUANTIZED_MATRIX_GROUPED_MAGIC && magic != QUANTIZED_MATRIX_CODEBOOK_MAGIC) ||
+          precision != TINYAI_PRECISION_INT4))) {
         tinyaiCloseFile(file);
         return NULL;  /* Invalid magic number */
     }
@@ -903,7 +1856,7 @@ void* tinyaiLoadQuantizedMatrix(const char *path, TinyAIPrecision precision) {
             
             /* Read the data */
             size_t dataSize = rows * cols * sizeof(float);
-            if (tinyaiReadFile(file, mat->data, dataSize) != dataSize) {
+            if (tinyaiReadFile(file, mat->data, dataSize) != (int64_t)dataSize) {
                 tinyaiDestroyMatrixFP32(mat);
                 tinyaiCloseFile(file);
                 return NULL;
@@ -936,7 +1889,7 @@ void* tinyaiLoadQuantizedMatrix(const char *path, TinyAIPrecision precision) {
             
             /* Read the data */
             size_t dataSize = rows * cols;
-            if (tinyaiReadFile(file, mat->data, dataSize) != dataSize) {
+            if (tinyaiReadFile(file, mat->data, dataSize) != (int64_t)dataSize) {
                 tinyaiDestroyMatrix8bit(mat);
                 tinyaiCloseFile(file);
                 return NULL;
@@ -958,7 +1911,16 @@ void* tinyaiLoadQuantizedMatrix(const char *path, TinyAIPrecision precision) {
                 return NULL;
             }
             
-            TinyAIMatrix4bit *mat = tinyaiCreateMatrix4bit(rows, cols);
+            uint32_t groupSize = 0;
+            if (magic != QUANTIZED_MATRIX_MAGIC &&
+                (tinyaiReadFile(file, &groupSize, sizeof(groupSize)) != sizeof(groupSize) ||
+                 groupSize == 0 || groupSize > cols)) {
+                tinyaiCloseFile(file);
+                return NULL;
+            }
+            
+            TinyAIMatrix4bit *mat = groupSize ? tinyaiCreateMatrix4bitGrouped(rows, cols, groupSize)
+                                              : tinyaiCreateMatrix4bit(rows, cols);
             if (!mat) {
                 tinyaiCloseFile(file);
                 return NULL;
@@ -967,9 +1929,31 @@ void* tinyaiLoadQuantizedMatrix(const char *path, TinyAIPrecision precision) {
             mat->scale = scale;
             mat->zeroPoint = zeroPoint;
             
+            /* Read the per-group scales */
+            size_t groupBytes = tinyaiMatrix4bitGroupCount(mat) * sizeof(float);
+            if (groupBytes > 0 &&
+                (tinyaiReadFile(file, mat->scales, groupBytes) != (int64_t)groupBytes ||
+                 tinyaiReadFile(file, mat->zeroPoints, groupBytes) != (int64_t)groupBytes)) {
+                tinyaiDestroyMatrix4bit(mat);
+                tinyaiCloseFile(file);
+                return NULL;
+            }
+            
+            /* Read the codebook */
+            if (magic == QUANTIZED_MATRIX_CODEBOOK_MAGIC) {
+                size_t levelBytes = TINYAI_CODEBOOK_LEVELS * sizeof(float);
+                mat->levels = (float*)TINYAI_MALLOC(levelBytes);
+                if (!mat->levels ||
+                    tinyaiReadFile(file, mat->levels, levelBytes) != (int64_t)levelBytes) {
+                    tinyaiDestroyMatrix4bit(mat);
+                    tinyaiCloseFile(file);
+                    return NULL;
+                }
+            }
+            
             /* Read the data */
             size_t dataSize = (rows * cols + 1) / 2;
-            if (tinyaiReadFile(file, mat->data, dataSize) != dataSize) {
+            if (tinyaiReadFile(file, mat->data, dataSize) != (int64_t)dataSize) {
                 tinyaiDestroyMatrix4bit(mat);
                 tinyaiCloseFile(file);
                 return NULL;
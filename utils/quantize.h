@@ -15,15 +15,49 @@
 
 /**
  * Precision enumeration
+ * 
+ * The _A8 precisions multiply FP32 activations by quantized weights with
+ * the activations quantized to int8 on the fly (one symmetric scale per
+ * row) and the products summed in integers.
  */
 typedef enum {
     TINYAI_PRECISION_FP32,
     TINYAI_PRECISION_INT8,
-    TINYAI_PRECISION_INT4
+    TINYAI_PRECISION_INT4,
+    TINYAI_PRECISION_INT4_A8,   /* 4-bit weights, int8 activations */
+    TINYAI_PRECISION_INT8_A8    /* 8-bit weights, int8 activations */
 } TinyAIPrecision;
 
+/**
+ * Storage layout of 4-bit matrix data
+ * 
+ * Row-major data packs the values in order, two per byte, high nibble first.
+ * Panel data holds 16-column panels, each covering every row with 8 bytes
+ * per row (byte i: column i in the low nibble, column 8 + i in the high
+ * nibble), so the SIMD kernels unpack them without shuffles and keep a whole
+ * panel of sums in registers (see tinyaiSimdMatMul4BitPanelsColumns).
+ */
+typedef enum {
+    TINYAI_MATRIX4BIT_ROW_MAJOR,
+    TINYAI_MATRIX4BIT_PANELS
+} TinyAIMatrix4bitLayout;
+
+/**
+ * Number of levels in the codebook of a 4-bit matrix
+ */
+#define TINYAI_CODEBOOK_LEVELS 16
+
 /**
  * 4-bit quantized matrix structure
+ * 
+ * Values dequantize to q * scale + zeroPoint. A group-quantized matrix
+ * instead has its own scale and zero point for every groupSize consecutive
+ * columns of each row (the last group of a row may be shorter), stored row
+ * by row in scales and zeroPoints; groupSize == cols gives one per row.
+ * A codebook matrix is group-quantized with non-uniform levels: values
+ * dequantize to levels[q] * scale + zeroPoint of their group (e.g. NF4).
+ * Matrices are created row-major; tinyaiMatrix4bitPrepack repacks one into
+ * panels once, and every operation here accepts either layout.
  */
 typedef struct {
     uint8_t *data;       /* Matrix data (4-bit packed, 2 values per byte) */
@@ -31,6 +65,11 @@ typedef struct {
     uint32_t cols;       /* Number of columns */
     float scale;         /* Scaling factor for quantization */
     float zeroPoint;     /* Zero point for quantization */
+    float *scales;       /* Per-group scaling factors, or NULL to use scale */
+    float *zeroPoints;   /* Per-group zero points (set when scales is) */
+    uint32_t groupSize;  /* Columns per group (0 when not group-quantized) */
+    float *levels;       /* Codebook of TINYAI_CODEBOOK_LEVELS levels, or NULL for q itself */
+    TinyAIMatrix4bitLayout layout; /* Layout of data */
 } TinyAIMatrix4bit;
 
 /**
@@ -71,6 +110,69 @@ TinyAIMatrix4bit* tinyaiCreateMatrix4bit(uint32_t rows, uint32_t cols);
  */
 void tinyaiDestroyMatrix4bit(TinyAIMatrix4bit *matrix);
 
+/**
+ * Create a group-quantized 4-bit matrix
+ * 
+ * Scales start at 1 and zero points at 0.
+ * 
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param groupSize Columns per group (0 or more than cols for one group per row)
+ * @return New matrix or NULL on error
+ */
+TinyAIMatrix4bit* tinyaiCreateMatrix4bitGrouped(uint32_t rows, uint32_t cols, uint32_t groupSize);
+
+/**
+ * Number of per-group scales of a 4-bit matrix
+ * 
+ * @param matrix 4-bit matrix
+ * @return rows x groups per row, or 0 if the matrix has a single scale
+ */
+size_t tinyaiMatrix4bitGroupCount(const TinyAIMatrix4bit *matrix);
+
+/**
+ * Deep-copy a 4-bit matrix into a matrix held by value
+ * 
+ * @param dst Destination; its previous contents are not freed
+ * @param src Matrix to copy
+ * @return 0 on success, non-zero on error (dst is left empty)
+ */
+int tinyaiCopyMatrix4bit(TinyAIMatrix4bit *dst, const TinyAIMatrix4bit *src);
+
+/**
+ * Bytes of a 4-bit matrix's data in its current layout
+ * 
+ * @param matrix 4-bit matrix
+ * @return Size of matrix->data in bytes
+ */
+size_t tinyaiMatrix4bitDataSize(const TinyAIMatrix4bit *matrix);
+
+/**
+ * Repack a row-major 4-bit matrix into panels for the SIMD kernels
+ * 
+ * Done once, typically at load time; the layout is recorded in the matrix
+ * and later calls return at once. Group-quantized matrices stay row-major.
+ * 
+ * @param matrix Matrix to repack in place
+ * @return 0 on success (or if already packed), non-zero on error or if grouped
+ */
+int tinyaiMatrix4bitPrepack(TinyAIMatrix4bit *matrix);
+
+/**
+ * Convert a 4-bit matrix back to the row-major layout
+ * 
+ * @param matrix Matrix to convert in place
+ * @return 0 on success (or if already row-major), non-zero on error
+ */
+int tinyaiMatrix4bitUnpack(TinyAIMatrix4bit *matrix);
+
+/**
+ * Free the storage of a 4-bit matrix held by value and clear it
+ * 
+ * @param matrix Matrix whose data and scales to free
+ */
+void tinyaiReleaseMatrix4bit(TinyAIMatrix4bit *matrix);
+
 /**
  * Create an 8-bit quantized matrix
  * 
@@ -111,6 +213,36 @@ void tinyaiDestroyMatrixFP32(TinyAIMatrixFP32 *matrix);
  */
 TinyAIMatrix4bit* tinyaiQuantizeFP32To4bit(const TinyAIMatrixFP32 *input);
 
+/**
+ * Quantize a FP32 matrix to 4-bit with a scale and zero point per group
+ * 
+ * Each group of groupSize consecutive columns of a row is mapped from its
+ * own min/max, so outliers only cost precision within their group.
+ * 
+ * @param input Input FP32 matrix
+ * @param groupSize Columns per group (0 or more than cols for one group per row)
+ * @return Group-quantized 4-bit matrix or NULL on error
+ */
+TinyAIMatrix4bit* tinyaiQuantizeFP32To4bitGrouped(const TinyAIMatrixFP32 *input,
+                                                  uint32_t groupSize);
+
+/**
+ * Quantize a FP32 matrix to 4-bit codebook indices with a scale and zero point per group
+ * 
+ * Each group maps the codebook's range onto its own min/max and stores the
+ * index of the nearest level, so non-uniform levels (such as NF4's normal
+ * quantiles) spend precision where weights cluster. The SIMD kernels look
+ * the levels up in registers, so codebook matrices multiply as fast as
+ * group-quantized ones.
+ * 
+ * @param input Input FP32 matrix
+ * @param levels TINYAI_CODEBOOK_LEVELS strictly increasing levels, or NULL for NF4
+ * @param groupSize Columns per group (0 or more than cols for one group per row)
+ * @return Codebook 4-bit matrix or NULL on error (including unsorted levels)
+ */
+TinyAIMatrix4bit* tinyaiQuantizeFP32To4bitCodebook(const TinyAIMatrixFP32 *input,
+                                                   const float *levels, uint32_t groupSize);
+
 /**
  * Quantize a FP32 matrix to 8-bit
  * 
@@ -138,6 +270,11 @@ TinyAIMatrixFP32* tinyaiDequantize8bitToFP32(const TinyAIMatrix8bit *input);
 /**
  * Matrix multiplication: C = A * B
  * 
+ * For TINYAI_PRECISION_INT4_A8 and TINYAI_PRECISION_INT8_A8, A and C are
+ * FP32 matrices and B is a TinyAIMatrix4bit or TinyAIMatrix8bit; each row
+ * of A is quantized to int8 once and multiplied with integer dot products.
+ * Group-quantized and prepacked 4-bit weights keep FP32 activations.
+ * 
  * @param a Matrix A
  * @param b Matrix B
  * @param c Output matrix C
@@ -146,6 +283,141 @@ TinyAIMatrixFP32* tinyaiDequantize8bitToFP32(const TinyAIMatrix8bit *input);
  */
 int tinyaiMatrixMultiply(const void *a, const void *b, void *c, TinyAIPrecision precision);
 
+/**
+ * Set the precision of activations in quantized-weight layers
+ * 
+ * With TINYAI_PRECISION_INT8, tinyaiMatrix4bitMatMul and
+ * tinyaiMatrix4bitMatMulGroup (and so the text model's projections) and
+ * the image model's dense layers quantize each input vector to int8 once
+ * and use integer dot products, trading a small accuracy loss for speed.
+ * Group-quantized and prepacked matrices always keep FP32 activations. The
+ * default is TINYAI_PRECISION_FP32. Set it before running models, not while
+ * they run.
+ * 
+ * @param precision TINYAI_PRECISION_FP32 or TINYAI_PRECISION_INT8
+ * @return 0 on success, non-zero for any other precision
+ */
+int tinyaiSetActivationPrecision(TinyAIPrecision precision);
+
+/**
+ * Get the precision of activations in quantized-weight layers
+ * 
+ * @return TINYAI_PRECISION_FP32 or TINYAI_PRECISION_INT8
+ */
+TinyAIPrecision tinyaiGetActivationPrecision(void);
+
+/**
+ * Vector-matrix multiplication on packed 4-bit weights: output = input * W + bias
+ * 
+ * Operates directly on the packed representation without dequantizing.
+ * 
+ * @param matrix 4-bit weight matrix [rows x cols]
+ * @param input Input vector (rows elements)
+ * @param bias Bias vector (cols elements, can be NULL)
+ * @param output Output vector (cols elements, must not alias input)
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiMatrix4bitVecMul(const TinyAIMatrix4bit *matrix, const float *input,
+                           const float *bias, float *output);
+
+/**
+ * Matrix multiplication on packed 4-bit weights: output = input * W + bias
+ * 
+ * Multiplies several input vectors by the same weights in one pass, so the
+ * packed weights are streamed once for the whole batch.
+ * 
+ * @param matrix 4-bit weight matrix [rows x cols]
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param bias Bias vector (cols elements, can be NULL)
+ * @param output Output matrix [count x cols], must not alias input
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiMatrix4bitMatMul(const TinyAIMatrix4bit *matrix, const float *input, uint32_t count,
+                           const float *bias, float *output);
+
+/**
+ * Matrix multiplication on packed 4-bit weights with a fused activation:
+ * output = act(input * W + bias)
+ * 
+ * The bias and activation run as one elementwise pass over each output block
+ * while it is still in cache, instead of a separate pass over the whole output.
+ * 
+ * @param matrix 4-bit weight matrix [rows x cols]
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param bias Bias vector (cols elements, can be NULL)
+ * @param activation TINYAI_SIMD_ACTIVATION_* (TINYAI_SIMD_ACTIVATION_NONE for none)
+ * @param output Output matrix [count x cols], must not alias input
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiMatrix4bitMatMulActivate(const TinyAIMatrix4bit *matrix, const float *input,
+                                   uint32_t count, const float *bias, int activation,
+                                   float *output);
+
+/**
+ * Maximum number of matrices in one tinyaiMatrix4bitMatMulGroup call
+ */
+#define TINYAI_MATMUL_GROUP_MAX 4
+
+/**
+ * Multiply one input by several 4-bit matrices of the same row count in one pass
+ * 
+ * output[m] = input * W[m] + bias[m] for every matrix, as if the matrices
+ * were concatenated column-wise but keeping each one's own scale and zero
+ * point. Each input tile is read once for all matrices, and all of their
+ * columns share a single split across the thread pool, so small matrices
+ * (such as grouped-query key/value projections) do not run as separate,
+ * poorly balanced launches. Results match separate tinyaiMatrix4bitMatMul
+ * calls bit for bit.
+ * 
+ * @param matrices 4-bit weight matrices [rows x cols[m]]
+ * @param biases Bias vectors (cols[m] elements each); the array or any entry can be NULL
+ * @param outputs Output matrices [count x cols[m]], must not alias input
+ * @param numMatrices Number of matrices (1 to TINYAI_MATMUL_GROUP_MAX)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiMatrix4bitMatMulGroup(const TinyAIMatrix4bit *const *matrices,
+                                const float *const *biases, float *const *outputs,
+                                uint32_t numMatrices, const float *input, uint32_t count);
+
+/**
+ * Vector-matrix multiplication for selected output columns of packed 4-bit weights
+ * 
+ * output[j] = input * W[:, columns[j]] + bias[columns[j]]. Costs rows x count
+ * multiply-adds instead of rows x cols, so a short candidate list (e.g. a
+ * vocabulary shortlist) skips most of a large output projection. Sorted
+ * columns read the packed weights in order.
+ * 
+ * @param matrix 4-bit weight matrix [rows x cols]
+ * @param input Input vector (rows elements)
+ * @param columns Output columns to compute
+ * @param count Number of columns
+ * @param bias Bias vector (cols elements, can be NULL)
+ * @param output Output vector (count elements, must not alias input)
+ * @return 0 on success, non-zero on error (including an out-of-range column)
+ */
+int tinyaiMatrix4bitVecMulColumns(const TinyAIMatrix4bit *matrix, const float *input,
+                                  const uint32_t *columns, uint32_t count, const float *bias,
+                                  float *output);
+
+/**
+ * Dequantize selected rows of a 4-bit matrix
+ * 
+ * Only the requested rows are unpacked, so a lookup into a large table
+ * (e.g. token embeddings) never materializes the whole matrix.
+ * 
+ * @param matrix 4-bit matrix [rows x cols]
+ * @param rowIndices Indices of the rows to gather
+ * @param count Number of rows to gather
+ * @param output Output buffer [count x cols]
+ * @return 0 on success, non-zero on error (including an out-of-range index)
+ */
+int tinyaiMatrix4bitGatherRows(const TinyAIMatrix4bit *matrix, const int *rowIndices,
+                               uint32_t count, float *output);
+
 /**
  * Matrix addition: C = A + B
  * 
@@ -160,9 +432,11 @@ int tinyaiMatrixAdd(const void *a, const void *b, void *c, TinyAIPrecision preci
 /**
  * Apply activation function to matrix
  * 
+ * Runs the vectorized tinyaiSimdActivate kernels; output may alias input.
+ * 
  * @param input Input matrix
  * @param output Output matrix
- * @param activation Activation function ID (0 = none, 1 = ReLU, 2 = sigmoid, 3 = tanh)
+ * @param activation Activation function ID (0 = none, 1 = ReLU, 2 = sigmoid, 3 = tanh, 4 = GELU, 5 = SiLU)
  * @param precision Precision to use for computation
  * @return 0 on success, non-zero on error
  */
@@ -239,12 +513,14 @@ float tinyaiActivationGELU(float x);
 /**
  * Initialize activation function lookup tables
  * 
+ * No-op kept for compatibility: activations no longer use lookup tables.
+ * 
  * @return 0 on success, non-zero on error
  */
 int tinyaiInitActivationTables();
 
 /**
- * Clean up activation function lookup tables
+ * Clean up activation function lookup tables (no-op, see tinyaiInitActivationTables)
  */
 void tinyaiCleanupActivationTables();
 
@@ -263,6 +539,10 @@ void tinyaiFindMinMax(const float *data, size_t size, float *min, float *max);
 /**
  * Save a quantized matrix to a file
  * 
+ * Group-quantized 4-bit matrices are saved with their per-group scales
+ * (and codebook matrices with their levels), under magic numbers older
+ * readers reject.
+ * 
  * @param matrix Matrix to save
  * @param path File path
  * @param precision Precision of the matrix
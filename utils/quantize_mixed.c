@@ -6,6 +6,7 @@
 #include "quantize_mixed.h"
 #include "memory_pool.h"
 #include "simd_ops.h"
+#include "thread_pool.h"
 #include <float.h>
 #include <math.h>
 #include <stdlib.h>
@@ -48,8 +49,9 @@ static void getPrecisionMinMax(TinyAIMixedPrecType precision, float *min, float
         *max = 127.0f;
         break;
     case TINYAI_MIXED_PREC_INT4:
-        *min = -8.0f;
-        *max = 7.0f;
+        /* Unsigned levels, as in TinyAIMatrix4bit, so the 4-bit kernels apply */
+        *min = 0.0f;
+        *max = 15.0f;
         break;
     case TINYAI_MIXED_PREC_INT2:
         *min = -2.0f;
@@ -103,47 +105,16 @@ static void quantizeToTarget(const float *src, void *dst, int size, TinyAIMixedP
         break;
 
     case TINYAI_MIXED_PREC_FP16: {
-        /* Quantize to FP16 (simple version, not full IEEE 754 compliant) */
+        /* Round to the nearest FP16 value, clamped to the finite range */
         uint16_t *dstFp16 = (uint16_t *)dst;
-        for (int i = 0; i < size; i++) {
-            /* Simple conversion to FP16 using truncation */
-            float value = src[i];
-            /* Clamp to FP16 range */
-            if (value > max)
-                value = max;
-            if (value < min)
-                value = min;
-
-            /* Convert to FP16 (simplified) */
-            uint16_t sign     = (value < 0) ? 0x8000 : 0;
-            float    absValue = fabsf(value);
-
-            /* Handle special cases */
-            if (absValue < 6.1e-5f) {
-                /* Flush to zero for very small values */
-                dstFp16[i] = sign;
-            }
-            else if (absValue > max) {
-                /* Infinity */
-                dstFp16[i] = sign | 0x7C00;
-            }
-            else {
-                /* Normal case */
-                int   exponent = (int)floor(log2f(absValue));
-                float mantissa = absValue / powf(2.0f, exponent) - 1.0f;
-
-                /* Adjust for FP16 bias and range */
-                exponent += 15; /* FP16 bias */
-                if (exponent < 1)
-                    exponent = 1; /* Denormal */
-                if (exponent > 30)
-                    exponent = 30; /* Max exponent */
-
-                uint16_t expBits = (uint16_t)(exponent << 10);
-                uint16_t manBits = (uint16_t)(mantissa * 1024.0f);
-
-                dstFp16[i] = sign | expBits | manBits;
+        float     block[256];
+        for (int i = 0; i < size; i += 256) {
+            int n = size - i < 256 ? size - i : 256;
+            for (int j = 0; j < n; j++) {
+                float value = src[i + j];
+                block[j]    = value > max ? max : (value < min ? min : value);
             }
+            tinyaiSimdConvertFP32ToFP16(dstFp16 + i, block, n);
         }
         break;
     }
@@ -164,7 +135,7 @@ static void quantizeToTarget(const float *src, void *dst, int size, TinyAIMixedP
     }
 
     case TINYAI_MIXED_PREC_INT4: {
-        /* Quantize to INT4 (packed, 2 values per byte) */
+        /* Quantize to INT4 (packed, 2 values per byte, high nibble first) */
         uint8_t *dstInt4 = (uint8_t *)dst;
         for (int i = 0; i < size; i += 2) {
             float value1 = src[i] / scale + zeroPoint;
@@ -173,20 +144,20 @@ static void quantizeToTarget(const float *src, void *dst, int size, TinyAIMixedP
                 value1 = max;
             if (value1 < min)
                 value1 = min;
-            int8_t quantized1 = (int8_t)roundf(value1);
+            uint8_t quantized1 = (uint8_t)roundf(value1);
 
-            int8_t quantized2 = 0;
+            uint8_t quantized2 = 0;
             if (i + 1 < size) {
                 float value2 = src[i + 1] / scale + zeroPoint;
                 if (value2 > max)
                     value2 = max;
                 if (value2 < min)
                     value2 = min;
-                quantized2 = (int8_t)roundf(value2);
+                quantized2 = (uint8_t)roundf(value2);
             }
 
             /* Pack two 4-bit values into one byte */
-            dstInt4[i / 2] = (quantized1 & 0x0F) | ((quantized2 & 0x0F) << 4);
+            dstInt4[i / 2] = (uint8_t)((quantized1 << 4) | quantized2);
         }
         break;
     }
@@ -231,44 +202,10 @@ static void dequantizeToFloat(const void *src, float *dst, int size, TinyAIMixed
         memcpy(dst, src, size * sizeof(float));
         break;
 
-    case TINYAI_MIXED_PREC_FP16: {
+    case TINYAI_MIXED_PREC_FP16:
         /* Dequantize from FP16 */
-        const uint16_t *srcFp16 = (const uint16_t *)src;
-        for (int i = 0; i < size; i++) {
-            uint16_t value    = srcFp16[i];
-            uint16_t sign     = value & 0x8000;
-            uint16_t exp      = (value & 0x7C00) >> 10;
-            uint16_t mantissa = value & 0x03FF;
-
-            float result;
-            if (exp == 0) {
-                /* Zero or denormal */
-                if (mantissa == 0) {
-                    result = 0.0f;
-                }
-                else {
-                    /* Denormal */
-                    result = mantissa / 1024.0f * powf(2.0f, -14);
-                }
-            }
-            else if (exp == 31) {
-                /* Infinity or NaN */
-                if (mantissa == 0) {
-                    result = INFINITY;
-                }
-                else {
-                    result = NAN;
-                }
-            }
-            else {
-                /* Normal number */
-                result = (1.0f + mantissa / 1024.0f) * powf(2.0f, exp - 15);
-            }
-
-            dst[i] = sign ? -result : result;
-        }
+        tinyaiSimdConvertFP16ToFP32(dst, (const uint16_t *)src, size);
         break;
-    }
 
     case TINYAI_MIXED_PREC_INT8: {
         /* Dequantize from INT8 */
@@ -279,29 +216,10 @@ static void dequantizeToFloat(const void *src, float *dst, int size, TinyAIMixed
         break;
     }
 
-    case TINYAI_MIXED_PREC_INT4: {
-        /* Dequantize from INT4 (packed, 2 values per byte) */
-        const uint8_t *srcInt4 = (const uint8_t *)src;
-        for (int i = 0; i < size; i += 2) {
-            uint8_t packedByte = srcInt4[i / 2];
-
-            /* Extract first 4-bit value (lower nibble) */
-            int8_t value1 = (int8_t)(packedByte & 0x0F);
-            /* Sign extend if negative (when highest bit in nibble is set) */
-            if (value1 & 0x08)
-                value1 |= 0xF0;
-            dst[i] = ((float)value1 - zeroPoint) * scale;
-
-            /* Extract second 4-bit value (upper nibble) if within bounds */
-            if (i + 1 < size) {
-                int8_t value2 = (int8_t)((packedByte >> 4) & 0x0F);
-                if (value2 & 0x08)
-                    value2 |= 0xF0;
-                dst[i + 1] = ((float)value2 - zeroPoint) * scale;
-            }
-        }
+    case TINYAI_MIXED_PREC_INT4:
+        /* Dequantize from INT4: (q - zeroPoint) * scale is q * scale - zeroPoint * scale */
+        tinyaiSimdDequantize4BitAffine(dst, (const uint8_t *)src, size, scale, -zeroPoint * scale);
         break;
-    }
 
     case TINYAI_MIXED_PREC_INT2: {
         /* Dequantize from INT2 (packed, 4 values per byte) */
@@ -506,6 +424,132 @@ bool tinyaiQuantizeModelMixedPrecision(const char *srcModelPath, const char *dst
     return true;
 }
 
+typedef struct MixedPrecMatMulTask MixedPrecMatMulTask;
+
+/* Kernel computing output columns [c0, c1) of a mixed precision product */
+typedef void (*MixedPrecKernel)(const MixedPrecMatMulTask *task, int c0, int c1);
+
+/* Operands of a mixed precision product; columns are split across the shared thread pool */
+struct MixedPrecMatMulTask {
+    MixedPrecKernel              kernel;
+    const TinyAIMixedPrecMatrix *weights;
+    const float                 *input;       /* Activations as floats [count x rows] */
+    const int8_t                *inputInt8;   /* Symmetric int8 activations, if the kernel uses them */
+    const float                 *inputScales; /* Scale of each int8 activation row */
+    int                          count;
+    float                       *output;
+};
+
+/* Affine zero point of a (q - zeroPoint) * scale matrix, as used by the SIMD kernels */
+static float affineZeroPoint(const TinyAIMixedPrecMatrix *matrix)
+{
+    return -matrix->zeroPoint * matrix->scale;
+}
+
+static void matMulKernelFP32(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b       = task->weights;
+    const float                 *weights = (const float *)b->data;
+
+    for (int i = 0; i < task->count; i++) {
+        const float *x   = task->input + (size_t)i * b->rows;
+        float       *dst = task->output + (size_t)i * b->cols;
+        memset(dst + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+        for (int k = 0; k < b->rows; k++) {
+            const float *row = weights + (size_t)k * b->cols;
+            for (int j = c0; j < c1; j++) {
+                dst[j] += x[k] * row[j];
+            }
+        }
+    }
+}
+
+static void matMulKernelFP16(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b = task->weights;
+    tinyaiSimdMatMulFP16Columns(task->output, (const uint16_t *)b->data, task->input, task->count,
+                                b->rows, b->cols, c0, c1);
+}
+
+static void matMulKernelInt8(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b = task->weights;
+    tinyaiSimdMatMul8BitAffineColumns(task->output, (const int8_t *)b->data, task->input,
+                                      task->count, b->rows, b->cols, c0, c1, b->scale,
+                                      affineZeroPoint(b));
+}
+
+static void matMulKernelInt8Int8(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b = task->weights;
+    tinyaiSimdMatMul8BitInt8Columns(task->output, (const int8_t *)b->data, task->inputInt8,
+                                    task->inputScales, task->count, b->rows, b->cols, c0, c1,
+                                    b->scale, affineZeroPoint(b));
+}
+
+static void matMulKernelInt4(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b = task->weights;
+    tinyaiSimdMatMul4BitAffineColumns(task->output, (const uint8_t *)b->data, task->input,
+                                      task->count, b->rows, b->cols, c0, c1, b->scale,
+                                      affineZeroPoint(b));
+}
+
+static void matMulKernelInt4Int8(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b = task->weights;
+    tinyaiSimdMatMul4BitInt8Columns(task->output, (const uint8_t *)b->data, task->inputInt8,
+                                    task->inputScales, task->count, b->rows, b->cols, c0, c1,
+                                    b->scale, affineZeroPoint(b));
+}
+
+static void matMulKernelInt2(const MixedPrecMatMulTask *task, int c0, int c1)
+{
+    const TinyAIMixedPrecMatrix *b = task->weights;
+    tinyaiSimdMatMul2BitColumns(task->output, (const uint8_t *)b->data, task->input, task->count,
+                                b->rows, b->cols, c0, c1, b->scale, affineZeroPoint(b));
+}
+
+/* Kernel for each (weight precision, activation precision) pair; activations are either floats
+   (FP32, FP16) or integers (INT8, INT4, INT2), which are requantized to symmetric int8 rows when
+   the weights have an integer kernel and widened to floats otherwise */
+typedef struct {
+    MixedPrecKernel floatActivations;
+    MixedPrecKernel intActivations;
+    bool            int8Input; /* intActivations takes int8 rows */
+} MixedPrecKernelEntry;
+
+static const MixedPrecKernelEntry mixedPrecKernels[] = {
+    [TINYAI_MIXED_PREC_FP32] = {matMulKernelFP32, matMulKernelFP32, false},
+    [TINYAI_MIXED_PREC_FP16] = {matMulKernelFP16, matMulKernelFP16, false},
+    [TINYAI_MIXED_PREC_INT8] = {matMulKernelInt8, matMulKernelInt8Int8, true},
+    [TINYAI_MIXED_PREC_INT4] = {matMulKernelInt4, matMulKernelInt4Int8, true},
+    [TINYAI_MIXED_PREC_INT2] = {matMulKernelInt2, matMulKernelInt2, false},
+};
+
+/* Select the kernel for a weight and activation precision (NULL if unsupported) */
+static MixedPrecKernel selectMixedPrecKernel(TinyAIMixedPrecType weights,
+                                             TinyAIMixedPrecType activations, bool *int8Input)
+{
+    if ((unsigned)weights > TINYAI_MIXED_PREC_INT2 || (unsigned)activations > TINYAI_MIXED_PREC_INT2) {
+        return NULL;
+    }
+
+    const MixedPrecKernelEntry *entry = &mixedPrecKernels[weights];
+    if (activations == TINYAI_MIXED_PREC_FP32 || activations == TINYAI_MIXED_PREC_FP16) {
+        *int8Input = false;
+        return entry->floatActivations;
+    }
+    *int8Input = entry->int8Input;
+    return entry->intActivations;
+}
+
+static void mixedPrecMatMulColumns(void *context, size_t begin, size_t end)
+{
+    const MixedPrecMatMulTask *task = (const MixedPrecMatMulTask *)context;
+    task->kernel(task, (int)begin, (int)end);
+}
+
 bool tinyaiMixedPrecMatMul(const TinyAIMixedPrecMatrix *a, const TinyAIMixedPrecMatrix *b,
                            TinyAIMixedPrecMatrix *output)
 {
@@ -514,44 +558,43 @@ bool tinyaiMixedPrecMatMul(const TinyAIMixedPrecMatrix *a, const TinyAIMixedPrec
         return false;
     }
 
-    /* Convert inputs to float for simplicity */
-    size_t aElements = (size_t)a->rows * a->cols;
-    size_t bElements = (size_t)b->rows * b->cols;
-    float *aFloat    = (float *)malloc(aElements * sizeof(float));
-    float *bFloat    = (float *)malloc(bElements * sizeof(float));
-
-    if (!aFloat || !bFloat) {
-        if (aFloat)
-            free(aFloat);
-        if (bFloat)
-            free(bFloat);
+    bool            int8Input = false;
+    MixedPrecKernel kernel    = selectMixedPrecKernel(b->precision, a->precision, &int8Input);
+    if (!kernel) {
         return false;
     }
 
-    /* Dequantize input matrices */
-    dequantizeToFloat(a->data, aFloat, aElements, a->precision, a->scale, a->zeroPoint);
-    dequantizeToFloat(b->data, bFloat, bElements, b->precision, b->scale, b->zeroPoint);
-
-    /* Perform matrix multiplication in floating point */
+    /* Activations are widened to floats (and requantized to int8 rows for integer kernels);
+       the weights stay in their stored precision */
+    size_t aElements   = (size_t)a->rows * a->cols;
     size_t outputSize  = (size_t)output->rows * output->cols;
+    float *aFloat      = (float *)malloc(aElements * sizeof(float));
     float *resultFloat = (float *)malloc(outputSize * sizeof(float));
-    if (!resultFloat) {
+    float *aScales     = int8Input ? (float *)malloc((size_t)a->rows * sizeof(float)) : NULL;
+    int8_t *aInt8      = int8Input ? (int8_t *)malloc(aElements) : NULL;
+
+    if (!aFloat || !resultFloat || (int8Input && (!aScales || !aInt8))) {
         free(aFloat);
-        free(bFloat);
+        free(resultFloat);
+        free(aScales);
+        free(aInt8);
         return false;
     }
 
-    /* Simple naive matrix multiply */
-    for (int i = 0; i < a->rows; i++) {
-        for (int j = 0; j < b->cols; j++) {
-            float sum = 0.0f;
-            for (int k = 0; k < a->cols; k++) {
-                sum += aFloat[i * a->cols + k] * bFloat[k * b->cols + j];
-            }
-            resultFloat[i * output->cols + j] = sum;
+    dequantizeToFloat(a->data, aFloat, aElements, a->precision, a->scale, a->zeroPoint);
+    if (int8Input) {
+        for (int i = 0; i < a->rows; i++) {
+            aScales[i] = tinyaiSimdQuantizeInt8(aInt8 + (size_t)i * a->cols,
+                                                aFloat + (size_t)i * a->cols, a->cols);
         }
     }
 
+    /* Output columns are split across the shared thread pool in multiples of 16 */
+    MixedPrecMatMulTask task = {kernel, b, aFloat, aInt8, aScales, a->rows, resultFloat};
+    TinyAIThreadPool   *pool = tinyaiGetThreadPool();
+    size_t grain = tinyaiThreadPoolGrain(pool, (size_t)b->rows * (size_t)a->rows, 16);
+    tinyaiParallelFor(pool, (size_t)b->cols, grain, mixedPrecMatMulColumns, &task);
+
     /* Quantize result to output precision */
     float min, max;
     getPrecisionMinMax(output->precision, &min, &max);
@@ -561,12 +604,200 @@ bool tinyaiMixedPrecMatMul(const TinyAIMixedPrecMatrix *a, const TinyAIMixedPrec
 
     /* Clean up */
     free(aFloat);
-    free(bFloat);
     free(resultFloat);
+    free(aScales);
+    free(aInt8);
 
     return true;
 }
 
+/* Candidate weight precisions, fewest bits first; FP32 always meets the budget */
+static const TinyAIMixedPrecType calibrationCandidates[] = {
+    TINYAI_MIXED_PREC_INT2, TINYAI_MIXED_PREC_INT4, TINYAI_MIXED_PREC_INT8, TINYAI_MIXED_PREC_FP16};
+#define CALIBRATION_CANDIDATES (int)(sizeof(calibrationCandidates) / sizeof(calibrationCandidates[0]))
+
+/* Calibration samples multiplied between checks of the error budget */
+#define CALIBRATION_CHUNK 16
+
+/* Cached FP32 activations shared by every (layer, candidate) evaluation */
+typedef struct {
+    const TinyAICalibrationLayer *layers;
+    float                       **references; /* Input of each layer, then the final output */
+    const double                 *energies;   /* Sum of squares of each layer's reference output */
+    int                           calibrationSize;
+    float                         errorBudget;
+    float                        *errors; /* Relative error per (layer, candidate) */
+} CalibrationTask;
+
+/* View FP32 layer weights as a mixed precision matrix without copying them */
+static TinyAIMixedPrecMatrix calibrationWeightsFP32(const TinyAICalibrationLayer *layer)
+{
+    TinyAIMixedPrecMatrix matrix = {0};
+    matrix.data      = (void *)layer->weights;
+    matrix.dataSize  = (size_t)layer->inputSize * layer->outputSize * sizeof(float);
+    matrix.rows      = layer->inputSize;
+    matrix.cols      = layer->outputSize;
+    matrix.precision = TINYAI_MIXED_PREC_FP32;
+    matrix.scale     = 1.0f;
+    return matrix;
+}
+
+/* Add the bias and apply the activation to rows of layer output */
+static void finishCalibrationRows(const TinyAICalibrationLayer *layer, float *rows, int count)
+{
+    for (int i = 0; i < count; i++) {
+        float *row = rows + (size_t)i * layer->outputSize;
+        if (layer->biases) {
+            tinyaiSimdVecAdd(row, row, layer->biases, layer->outputSize);
+        }
+        if (layer->activation >= 0) {
+            tinyaiSimdActivate(row, layer->outputSize, layer->activation);
+        }
+    }
+}
+
+/* Relative squared error of a layer with quantized weights against its cached FP32 output;
+   INFINITY once the error exceeds the budget (the remaining samples are skipped) */
+static float evaluateCalibrationCandidate(const CalibrationTask *task, int layerIndex,
+                                          TinyAIMixedPrecType precision)
+{
+    const TinyAICalibrationLayer *layer     = &task->layers[layerIndex];
+    const float                  *input     = task->references[layerIndex];
+    const float                  *reference = task->references[layerIndex + 1];
+    double                        energy    = task->energies[layerIndex] > 0.0
+                                                  ? task->energies[layerIndex]
+                                                  : 1.0;
+    double                        limit     = (double)task->errorBudget * energy;
+
+    TinyAIMixedPrecMatrix *weights = tinyaiCreateMixedPrecMatrix(
+        layer->weights, layer->inputSize, layer->outputSize, precision, 0.0f);
+    float *output = (float *)malloc((size_t)CALIBRATION_CHUNK * layer->outputSize * sizeof(float));
+    bool   int8Input;
+    MixedPrecKernel kernel = selectMixedPrecKernel(precision, TINYAI_MIXED_PREC_FP32, &int8Input);
+    if (!weights || !output || !kernel) {
+        tinyaiFreeMixedPrecMatrix(weights);
+        free(output);
+        return INFINITY;
+    }
+
+    /* Kernels called directly: evaluations already run one per pool thread */
+    double error = 0.0;
+    for (int i = 0; i < task->calibrationSize && error <= limit; i += CALIBRATION_CHUNK) {
+        int count = task->calibrationSize - i < CALIBRATION_CHUNK ? task->calibrationSize - i
+                                                                  : CALIBRATION_CHUNK;
+        MixedPrecMatMulTask chunk = {
+            kernel, weights, input + (size_t)i * layer->inputSize, NULL, NULL, count, output};
+        kernel(&chunk, 0, layer->outputSize);
+        finishCalibrationRows(layer, output, count);
+
+        const float *expected = reference + (size_t)i * layer->outputSize;
+        for (size_t j = 0; j < (size_t)count * layer->outputSize; j++) {
+            double diff = (double)output[j] - expected[j];
+            error += diff * diff;
+        }
+    }
+
+    tinyaiFreeMixedPrecMatrix(weights);
+    free(output);
+    return error <= limit ? (float)(error / energy) : INFINITY;
+}
+
+static void calibrateCandidates(void *context, size_t begin, size_t end)
+{
+    const CalibrationTask *task = (const CalibrationTask *)context;
+    for (size_t t = begin; t < end; t++) {
+        int layerIndex  = (int)(t / CALIBRATION_CANDIDATES);
+        int candidate   = (int)(t % CALIBRATION_CANDIDATES);
+        task->errors[t] = evaluateCalibrationCandidate(task, layerIndex,
+                                                       calibrationCandidates[candidate]);
+    }
+}
+
+bool tinyaiCalibrateMixedPrecision(const TinyAICalibrationLayer *layers, int numLayers,
+                                   const float *calibrationData, int calibrationSize,
+                                   float errorBudget, TinyAIMixedPrecConfig *config)
+{
+    if (!layers || numLayers <= 0 || !calibrationData || calibrationSize <= 0 ||
+        errorBudget < 0.0f || !config || !config->layerConfigs || config->numLayers != numLayers) {
+        return false;
+    }
+    for (int l = 0; l < numLayers; l++) {
+        if (!layers[l].weights || layers[l].inputSize <= 0 || layers[l].outputSize <= 0 ||
+            (l > 0 && layers[l].inputSize != layers[l - 1].outputSize)) {
+            return false;
+        }
+    }
+
+    size_t  candidates = (size_t)numLayers * CALIBRATION_CANDIDATES;
+    float **references = (float **)calloc((size_t)numLayers + 1, sizeof(float *));
+    double *energies   = (double *)calloc((size_t)numLayers, sizeof(double));
+    float  *errors     = (float *)malloc(candidates * sizeof(float));
+    bool    ok         = references && energies && errors;
+
+    /* FP32 reference activations are computed once, layer by layer, with the columns of each
+       product split across the pool; every candidate then starts from the same cached input */
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    if (ok) {
+        references[0] = (float *)calibrationData;
+    }
+    for (int l = 0; ok && l < numLayers; l++) {
+        const TinyAICalibrationLayer *layer = &layers[l];
+        size_t size       = (size_t)calibrationSize * layer->outputSize;
+        references[l + 1] = (float *)malloc(size * sizeof(float));
+        if (!references[l + 1]) {
+            ok = false;
+            break;
+        }
+
+        TinyAIMixedPrecMatrix weights = calibrationWeightsFP32(layer);
+        MixedPrecMatMulTask   task    = {matMulKernelFP32, &weights, references[l], NULL, NULL,
+                                         calibrationSize,  references[l + 1]};
+        size_t grain = tinyaiThreadPoolGrain(pool, (size_t)layer->inputSize * calibrationSize, 16);
+        tinyaiParallelFor(pool, (size_t)layer->outputSize, grain, mixedPrecMatMulColumns, &task);
+        finishCalibrationRows(layer, references[l + 1], calibrationSize);
+
+        for (size_t j = 0; j < size; j++) {
+            energies[l] += (double)references[l + 1][j] * references[l + 1][j];
+        }
+    }
+
+    /* Every (layer, candidate) pair is independent, so they all run concurrently */
+    if (ok) {
+        CalibrationTask task = {layers, references, energies, calibrationSize, errorBudget,
+                                errors};
+        tinyaiParallelFor(pool, candidates, 1, calibrateCandidates, &task);
+
+        /* Each layer takes the fewest bits within the budget */
+        for (int l = 0; l < numLayers; l++) {
+            TinyAIMixedPrecType precision = TINYAI_MIXED_PREC_FP32;
+            for (int c = 0; c < CALIBRATION_CANDIDATES; c++) {
+                if (errors[(size_t)l * CALIBRATION_CANDIDATES + c] <= errorBudget) {
+                    precision = calibrationCandidates[c];
+                    break;
+                }
+            }
+
+            /* Biases and activations were not quantized during calibration */
+            config->layerConfigs[l].weightPrecision = precision;
+            config->layerConfigs[l].biasPrecision   = TINYAI_MIXED_PREC_FP32;
+            config->layerConfigs[l].activPrecision  = TINYAI_MIXED_PREC_FP32;
+            config->layerConfigs[l].weightThreshold = 0.0f;
+            config->layerConfigs[l].biasThreshold   = 0.0f;
+            config->layerConfigs[l].activThreshold  = 0.0f;
+        }
+    }
+
+    if (references) {
+        for (int l = 1; l <= numLayers; l++) {
+            free(references[l]);
+        }
+    }
+    free(references);
+    free(energies);
+    free(errors);
+    return ok;
+}
+
 void tinyaiFreeMixedPrecConfig(TinyAIMixedPrecConfig *config)
 {
     if (config) {
@@ -97,9 +97,26 @@ void tinyaiFreeMixedPrecMatrix(TinyAIMixedPrecMatrix *matrix);
  */
 bool tinyaiMixedPrecToFloat(const TinyAIMixedPrecMatrix *matrix, float *output);
 
+/**
+ * Float layer evaluated by tinyaiCalibrateMixedPrecision
+ *
+ * Computes act(x * weights + biases) for a row x of inputSize values.
+ */
+typedef struct {
+    const float *weights;    /* Weights [inputSize x outputSize], row-major */
+    const float *biases;     /* Biases [outputSize] (NULL for none) */
+    int          inputSize;  /* Input size (the previous layer's outputSize) */
+    int          outputSize; /* Output size */
+    int          activation; /* TINYAI_SIMD_ACTIVATION_* type (-1 for none) */
+} TinyAICalibrationLayer;
+
 /**
  * Determine optimal precision for each layer using sensitivity analysis
  *
+ * Model files hold already-quantized weights, so this assigns a fixed
+ * heuristic (8-bit first and last layers, 4-bit inner layers); use
+ * tinyaiCalibrateMixedPrecision when the float weights are available.
+ *
  * @param modelPath Path to original model file
  * @param calibrationData Representative input data for calibration
  * @param calibrationSize Number of calibration samples
@@ -109,6 +126,30 @@ bool tinyaiMixedPrecToFloat(const TinyAIMixedPrecMatrix *matrix, float *output);
 bool tinyaiDetermineOptimalPrecision(const char *modelPath, const float *calibrationData,
                                      int calibrationSize, TinyAIMixedPrecConfig *config);
 
+/**
+ * Choose each layer's weight precision by calibration
+ *
+ * Runs the calibration samples through the float layers once, caching every
+ * layer's FP32 input and output, then measures each layer with INT2, INT4,
+ * INT8 and FP16 weights against its cached output. All (layer, precision)
+ * pairs are evaluated concurrently on the shared thread pool, and an
+ * evaluation stops as soon as its error exceeds the budget. Each layer gets
+ * the fewest bits whose relative squared error sum((y - y_ref)^2) /
+ * sum(y_ref^2) stays within errorBudget, or FP32 if none does; biases and
+ * activations are set to FP32.
+ *
+ * @param layers Layers applied in order
+ * @param numLayers Number of layers (must match config->numLayers)
+ * @param calibrationData Calibration samples [calibrationSize x layers[0].inputSize]
+ * @param calibrationSize Number of calibration samples
+ * @param errorBudget Largest relative squared error allowed per layer
+ * @param config Configuration receiving the chosen precisions
+ * @return true on success, false on invalid arguments or allocation failure
+ */
+bool tinyaiCalibrateMixedPrecision(const TinyAICalibrationLayer *layers, int numLayers,
+                                   const float *calibrationData, int calibrationSize,
+                                   float errorBudget, TinyAIMixedPrecConfig *config);
+
 /**
  * Apply mixed precision quantization to a model
  *
@@ -123,6 +164,12 @@ bool tinyaiQuantizeModelMixedPrecision(const char *srcModelPath, const char *dst
 /**
  * Matrix multiplication with mixed precision matrices
  *
+ * The matrix b is never converted to float: a kernel is chosen by the pair
+ * (b precision, a precision) and reads b in its stored form. Activations a
+ * in INT8, INT4 or INT2 are requantized to int8 rows when b is INT8 or INT4,
+ * so the product runs on integer dot products; otherwise a is widened to
+ * float. FP32 and FP16 activations always use the float kernels.
+ *
  * @param a First matrix
  * @param b Second matrix
  * @param output Output matrix (must be pre-allocated)
@@ -4,6 +4,7 @@
  */
 
 #include "simd_ops.h"
+#include "cache_opt.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,24 +14,95 @@
 /* Windows/MSVC */
 #include <intrin.h>
 #define HAS_SSE2_SUPPORT 1
+#define HAS_SSSE3_SUPPORT 1
+#define TINYAI_TARGET_SSSE3
 #if (_MSC_VER >= 1600) /* Visual Studio 2010 and later */
 #define HAS_AVX_SUPPORT 1
+#define TINYAI_TARGET_AVX
+#endif
+#if (_MSC_VER >= 1700) /* Visual Studio 2012 and later */
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2
+#endif
+#if (_MSC_VER >= 1920) /* Visual Studio 2019 and later */
+#include <immintrin.h>
+#define HAS_AVX512_SUPPORT 1
+#define HAS_AVX512VNNI_SUPPORT 1
+#define HAS_F16C_SUPPORT 1
+#define TINYAI_TARGET_AVX512
+#define TINYAI_TARGET_AVX512VNNI
+#define TINYAI_TARGET_F16C
 #endif
 #elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 /* GCC/Clang on x86 */
 #include <cpuid.h>
 #include <x86intrin.h>
 #define HAS_SSE2_SUPPORT 1
-#if defined(__AVX__)
+/* Kernels beyond SSE2 are compiled per function and picked at runtime, so one binary built
+   without -mavx runs on every x86-64 host and still uses the widest unit it finds */
+#if defined(__clang__) || __GNUC__ >= 5
+#define HAS_SSSE3_SUPPORT 1
+#define TINYAI_TARGET_SSSE3 __attribute__((target("ssse3")))
 #define HAS_AVX_SUPPORT 1
+#define TINYAI_TARGET_AVX __attribute__((target("avx")))
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#if defined(__clang__) || __GNUC__ >= 7
+#define HAS_AVX512_SUPPORT 1
+#define TINYAI_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
+#if defined(__clang__) || __GNUC__ >= 8
+#define HAS_AVX512VNNI_SUPPORT 1
+#define TINYAI_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#endif
+#if defined(__clang__) || __GNUC__ >= 10
+#define HAS_AVX512BF16_SUPPORT 1
+#define TINYAI_TARGET_AVX512BF16 __attribute__((target("avx512f,avx512bw,avx512bf16")))
+#endif
+#if defined(__clang__) || __GNUC__ >= 5
+#define HAS_F16C_SUPPORT 1
+#define TINYAI_TARGET_F16C __attribute__((target("avx,f16c")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* AArch64: NEON is part of the base architecture, the SDOT kernels are compiled per function and
+   picked at runtime like the x86 ones */
+#include <arm_neon.h>
+#define HAS_NEON_SUPPORT 1
+#if defined(__ARM_FEATURE_DOTPROD)
+#define HAS_NEON_DOTPROD_SUPPORT 1
+#define TINYAI_TARGET_DOTPROD
+#elif defined(__linux__) && defined(__clang__)
+#include <sys/auxv.h>
+#define HAS_NEON_DOTPROD_SUPPORT 1
+#define TINYAI_TARGET_DOTPROD __attribute__((target("dotprod")))
+#elif defined(__linux__) && __GNUC__ >= 8
+#include <sys/auxv.h>
+#define HAS_NEON_DOTPROD_SUPPORT 1
+#define TINYAI_TARGET_DOTPROD __attribute__((target("arch=armv8.2-a+dotprod")))
 #endif
 #endif
 
 /* SIMD capability flags */
 static bool g_simdInitialized = false;
 static bool g_hasSSE2         = false;
-static bool g_hasAVX          = false;
-static bool g_hasAVX2         = false;
+static bool g_hasSSSE3        = false;
+static bool g_hasAVX          = false; /* AVX with OS support for AVX state */
+static bool g_hasAVX2         = false; /* AVX2 and FMA with OS support for AVX state */
+static bool g_hasAVX512       = false; /* AVX-512F and AVX-512BW with OS support */
+static bool g_hasAVX512VNNI   = false;
+static bool g_hasAVX512BF16   = false; /* VCVTNEPS2BF16 and friends */
+static bool g_hasF16C         = false; /* F16C with OS support for AVX state */
+static bool g_hasNEON         = false; /* AArch64 Advanced SIMD */
+static bool g_hasNEONDotProd  = false; /* SDOT/UDOT (Armv8.2 dot product extension) */
+static bool g_avx512Enabled   = true;
+
+/* XCR0 bits the OS sets when it saves SSE, AVX and AVX-512 (opmask, ZMM) state */
+#define TINYAI_XCR0_AVX_STATE    0x06
+#define TINYAI_XCR0_AVX512_STATE 0xE6
+
+/* AT_HWCAP bit Linux sets on AArch64 when the dot product instructions are present */
+#define TINYAI_HWCAP_ASIMDDP (1UL << 20)
 
 /* Detect CPU SIMD capabilities */
 static void detectSimdCapabilities()
@@ -45,12 +117,30 @@ static void detectSimdCapabilities()
     __cpuid(cpuInfo, 1);
     g_hasSSE2 = (cpuInfo[3] & (1 << 26)) != 0;
 
-    /* Check AVX support */
-    g_hasAVX = (cpuInfo[2] & (1 << 28)) != 0;
+    /* Check SSSE3 support */
+    g_hasSSSE3 = (cpuInfo[2] & (1 << 9)) != 0;
+
+    /* The OS must save the AVX and AVX-512 registers before they may be used */
+    bool osAVX    = false;
+    bool osAVX512 = false;
+    if ((cpuInfo[2] & (1 << 27)) != 0) {
+        unsigned long long xcr0 = _xgetbv(0);
+        osAVX                   = (xcr0 & TINYAI_XCR0_AVX_STATE) == TINYAI_XCR0_AVX_STATE;
+        osAVX512                = (xcr0 & TINYAI_XCR0_AVX512_STATE) == TINYAI_XCR0_AVX512_STATE;
+    }
+
+    /* Check AVX, FMA and F16C support */
+    g_hasAVX    = osAVX && (cpuInfo[2] & (1 << 28)) != 0;
+    bool hasFMA = g_hasAVX && (cpuInfo[2] & (1 << 12)) != 0;
+    g_hasF16C   = g_hasAVX && (cpuInfo[2] & (1 << 29)) != 0;
 
     /* Check AVX2 support */
     __cpuid(cpuInfo, 7);
-    g_hasAVX2 = (cpuInfo[1] & (1 << 5)) != 0;
+    g_hasAVX2 = hasFMA && (cpuInfo[1] & (1 << 5)) != 0;
+
+    /* Check AVX-512F, AVX-512BW and VNNI support */
+    g_hasAVX512     = osAVX512 && (cpuInfo[1] & (1 << 16)) != 0 && (cpuInfo[1] & (1 << 30)) != 0;
+    g_hasAVX512VNNI = g_hasAVX512 && (cpuInfo[2] & (1 << 11)) != 0;
 
 #elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
     unsigned int eax, ebx, ecx, edx;
@@ -59,14 +149,47 @@ static void detectSimdCapabilities()
     __get_cpuid(1, &eax, &ebx, &ecx, &edx);
     g_hasSSE2 = (edx & (1 << 26)) != 0;
 
-    /* Check AVX support */
-    g_hasAVX = (ecx & (1 << 28)) != 0;
+    /* Check SSSE3 support */
+    g_hasSSSE3 = (ecx & (1 << 9)) != 0;
+
+    /* The OS must save the AVX and AVX-512 registers before they may be used */
+    bool osAVX    = false;
+    bool osAVX512 = false;
+    if ((ecx & (1 << 27)) != 0) {
+        unsigned int xcr0, xcr0High;
+        __asm__ volatile("xgetbv" : "=a"(xcr0), "=d"(xcr0High) : "c"(0));
+        osAVX    = (xcr0 & TINYAI_XCR0_AVX_STATE) == TINYAI_XCR0_AVX_STATE;
+        osAVX512 = (xcr0 & TINYAI_XCR0_AVX512_STATE) == TINYAI_XCR0_AVX512_STATE;
+    }
+
+    /* Check AVX, FMA and F16C support */
+    g_hasAVX    = osAVX && (ecx & (1 << 28)) != 0;
+    bool hasFMA = g_hasAVX && (ecx & (1 << 12)) != 0;
+    g_hasF16C   = g_hasAVX && (ecx & (1 << 29)) != 0;
 
     /* Check AVX2 support */
     if (__get_cpuid_max(0, NULL) >= 7) {
         __cpuid_count(7, 0, eax, ebx, ecx, edx);
-        g_hasAVX2 = (ebx & (1 << 5)) != 0;
+        g_hasAVX2 = hasFMA && (ebx & (1 << 5)) != 0;
+
+        /* Check AVX-512F, AVX-512BW and VNNI support */
+        g_hasAVX512     = osAVX512 && (ebx & (1u << 16)) != 0 && (ebx & (1u << 30)) != 0;
+        g_hasAVX512VNNI = g_hasAVX512 && (ecx & (1 << 11)) != 0;
+
+        /* AVX512_BF16 sits in subleaf 1 */
+        if (eax >= 1) {
+            __cpuid_count(7, 1, eax, ebx, ecx, edx);
+            g_hasAVX512BF16 = g_hasAVX512 && (eax & (1 << 5)) != 0;
+        }
     }
+
+#elif defined(HAS_NEON_SUPPORT)
+    g_hasNEON = true;
+#if defined(__ARM_FEATURE_DOTPROD)
+    g_hasNEONDotProd = true;
+#elif defined(HAS_NEON_DOTPROD_SUPPORT)
+    g_hasNEONDotProd = (getauxval(AT_HWCAP) & TINYAI_HWCAP_ASIMDDP) != 0;
+#endif
 #endif
 
     g_simdInitialized = true;
@@ -77,7 +200,72 @@ bool tinyaiSimdAvailable(void)
     if (!g_simdInitialized) {
         detectSimdCapabilities();
     }
-    return g_hasSSE2 || g_hasAVX || g_hasAVX2;
+    return g_hasSSE2 || g_hasAVX || g_hasAVX2 || g_hasNEON;
+}
+
+bool tinyaiSimdHasAVX(void)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+#if defined(HAS_AVX_SUPPORT)
+    return g_hasAVX;
+#else
+    return false;
+#endif
+}
+
+bool tinyaiSimdHasAVX2(void)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+#if defined(HAS_AVX2_SUPPORT)
+    return g_hasAVX2;
+#else
+    return false;
+#endif
+}
+
+bool tinyaiSimdHasAVX512(void)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+#if defined(HAS_AVX512_SUPPORT)
+    return g_hasAVX512 && g_avx512Enabled;
+#else
+    return false;
+#endif
+}
+
+bool tinyaiSimdHasAVX512VNNI(void) { return tinyaiSimdHasAVX512() && g_hasAVX512VNNI; }
+
+bool tinyaiSimdHasAVX512BF16(void)
+{
+#if defined(HAS_AVX512BF16_SUPPORT)
+    return tinyaiSimdHasAVX512() && g_hasAVX512BF16;
+#else
+    return false;
+#endif
+}
+
+void tinyaiSimdSetAVX512Enabled(bool enabled) { g_avx512Enabled = enabled; }
+
+bool tinyaiSimdHasNEON(void)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+    return g_hasNEON;
+}
+
+bool tinyaiSimdHasNEONDotProd(void)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+    return g_hasNEONDotProd;
 }
 
 /* Reference implementation for 4-bit matrix-vector multiplication */
@@ -194,8 +382,9 @@ static void matMul4BitSSE2(float *out, const uint8_t *weights, const float *inpu
 
 #if defined(HAS_AVX_SUPPORT)
 /* AVX implementation for 4-bit matrix-vector multiplication */
-static void matMul4BitAVX(float *out, const uint8_t *weights, const float *input, int rows,
-                          int cols, const float *scaleFactors)
+static TINYAI_TARGET_AVX void matMul4BitAVX(float *out, const uint8_t *weights,
+                                             const float *input, int rows, int cols,
+                                             const float *scaleFactors)
 {
     /* Calculate how many complete 16-element chunks we have */
     int bytesPerRow = (cols + 1) / 2;
@@ -275,6 +464,83 @@ static void matMul4BitAVX(float *out, const uint8_t *weights, const float *input
 }
 #endif
 
+#if defined(HAS_NEON_SUPPORT)
+/* Widen 16 signed bytes to four vectors of floats */
+static inline void widenInt8NEON(int8x16_t v, float32x4_t w[4])
+{
+    int16x8_t lo = vmovl_s8(vget_low_s8(v));
+    int16x8_t hi = vmovl_high_s8(v);
+    w[0]         = vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo)));
+    w[1]         = vcvtq_f32_s32(vmovl_high_s16(lo));
+    w[2]         = vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi)));
+    w[3]         = vcvtq_f32_s32(vmovl_high_s16(hi));
+}
+
+/* Unpack 16 packed bytes (32 weights, low nibble first) to signed weights in column order */
+static inline void unpackNibblesInt8NEON(const uint8_t *src, int8x16_t *first, int8x16_t *second)
+{
+    const uint8x16_t mask   = vdupq_n_u8(0x0F);
+    const int8x16_t  offset = vdupq_n_s8(8);
+
+    uint8x16_t packed = vld1q_u8(src);
+    uint8x16_t lo     = vandq_u8(packed, mask);
+    uint8x16_t hi     = vshrq_n_u8(packed, 4);
+
+    /* Interleave back into column order and recenter 0..15 to -8..7 */
+    *first  = vsubq_s8(vreinterpretq_s8_u8(vzip1q_u8(lo, hi)), offset);
+    *second = vsubq_s8(vreinterpretq_s8_u8(vzip2q_u8(lo, hi)), offset);
+}
+
+/* NEON implementation for 4-bit matrix-vector multiplication */
+static void matMul4BitNEON(float *out, const uint8_t *weights, const float *input, int rows,
+                           int cols, const float *scaleFactors)
+{
+    int bytesPerRow = (cols + 1) / 2;
+    int tail        = cols / 32 * 32;
+
+    for (int row = 0; row < rows; row++) {
+        const uint8_t *rowData = weights + (size_t)row * bytesPerRow;
+
+        /* 32 weights (16 bytes) per step into four FMA accumulators */
+        float32x4_t sum[4] = {vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f),
+                              vdupq_n_f32(0.0f)};
+        for (int col = 0; col < tail; col += 32) {
+            const float *x = input + col;
+            int8x16_t    first, second;
+            float32x4_t  w[4];
+            unpackNibblesInt8NEON(rowData + col / 2, &first, &second);
+
+            widenInt8NEON(first, w);
+            for (int v = 0; v < 4; v++) {
+                sum[v] = vfmaq_f32(sum[v], w[v], vld1q_f32(x + 4 * v));
+            }
+            widenInt8NEON(second, w);
+            for (int v = 0; v < 4; v++) {
+                sum[v] = vfmaq_f32(sum[v], w[v], vld1q_f32(x + 16 + 4 * v));
+            }
+        }
+        float rowSum = vaddvq_f32(vaddq_f32(vaddq_f32(sum[0], sum[1]), vaddq_f32(sum[2], sum[3])));
+
+        /* Handle remaining columns */
+        for (int col = tail; col < cols; col++) {
+            uint8_t packed = rowData[col / 2];
+            uint8_t nibble = (col % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+            rowSum += (float)((int)nibble - 8) * input[col];
+        }
+
+        /* The row's scale factor is applied once to the finished sum */
+        out[row] = rowSum * scaleFactors[row];
+    }
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+/* AVX2 kernels from simd_ops_avx2.c */
+void matMul4BitAVX2(float *out, const uint8_t *weights, const float *input, int rows, int cols,
+                    const float *scaleFactors, int prefetch);
+void quantize4BitAVX2(uint8_t *out, const float *in, int size, float *scaleFactors, int blockSize);
+#endif
+
 /* Public API implementation that selects the appropriate SIMD version */
 void tinyaiSimdMatMul4Bit(float *out, const uint8_t *weights, const float *input, int rows,
                           int cols, const float *scaleFactors)
@@ -286,7 +552,8 @@ void tinyaiSimdMatMul4Bit(float *out, const uint8_t *weights, const float *input
     /* Use the most advanced SIMD version available */
 #if defined(HAS_AVX2_SUPPORT)
     if (g_hasAVX2) {
-        matMul4BitAVX2(out, weights, input, rows, cols, scaleFactors);
+        matMul4BitAVX2(out, weights, input, rows, cols, scaleFactors,
+                       tinyai_cache_opt_stream_prefetch());
         return;
     }
 #endif
@@ -305,285 +572,4967 @@ void tinyaiSimdMatMul4Bit(float *out, const uint8_t *weights, const float *input
     }
 #endif
 
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        matMul4BitNEON(out, weights, input, rows, cols, scaleFactors);
+        return;
+    }
+#endif
+
     /* Fallback to reference implementation if SIMD not available */
     matMul4BitReference(out, weights, input, rows, cols, scaleFactors);
 }
 
-/* Reference implementation for vector addition */
-static void vecAddReference(float *out, const float *a, const float *b, int size)
+/* Reference implementation for affine 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitAffineReference(float *out, const uint8_t *weights, const float *input,
+                                      int count, int rows, int cols, int c0, int c1, float scale,
+                                      float zeroPoint)
 {
-    for (int i = 0; i < size; i++) {
-        out[i] = a[i] + b[i];
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    /* Accumulate input[b][k] * q[k][j] row by row, skipping zero inputs */
+    for (int k = 0; k < rows; k++) {
+        size_t base = (size_t)k * cols;
+        for (int b = 0; b < count; b++) {
+            float x = input[(size_t)b * rows + k];
+            if (x == 0.0f) {
+                continue;
+            }
+
+            float *dst = out + (size_t)b * cols;
+            for (int j = c0; j < c1; j++) {
+                size_t  idx    = base + j;
+                uint8_t packed = weights[idx / 2];
+                int     q      = (idx & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+                dst[j] += x * q;
+            }
+        }
+    }
+
+    /* Apply scale and zero point once per output */
+    for (int b = 0; b < count; b++) {
+        const float *x        = input + (size_t)b * rows;
+        float       *dst      = out + (size_t)b * cols;
+        float        inputSum = 0.0f;
+        for (int k = 0; k < rows; k++) {
+            inputSum += x[k];
+        }
+        for (int j = c0; j < c1; j++) {
+            dst[j] = dst[j] * scale + inputSum * zeroPoint;
+        }
     }
 }
 
 #if defined(HAS_SSE2_SUPPORT)
-/* SSE2 implementation for vector addition */
-static void vecAddSSE2(float *out, const float *a, const float *b, int size)
+/* Unpack 8 bytes (16 values, high nibble first) into four vectors of floats */
+static inline void unpackNibblesSSE2(const uint8_t *src, __m128 q[4])
 {
-    int chunks = size / 4;
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
 
-    /* Process 4 elements at a time */
-    for (int i = 0; i < chunks; i++) {
-        __m128 va  = _mm_loadu_ps(a + i * 4);
-        __m128 vb  = _mm_loadu_ps(b + i * 4);
-        __m128 sum = _mm_add_ps(va, vb);
-        _mm_storeu_ps(out + i * 4, sum);
+    /* Split nibbles and interleave so element order matches memory order */
+    __m128i packed = _mm_loadl_epi64((const __m128i *)src);
+    __m128i hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    __m128i lo     = _mm_and_si128(packed, mask);
+    __m128i nib    = _mm_unpacklo_epi8(hi, lo);
+
+    /* Widen to 32-bit integers and convert to floats */
+    __m128i n16a = _mm_unpacklo_epi8(nib, zero);
+    __m128i n16b = _mm_unpackhi_epi8(nib, zero);
+    q[0]         = _mm_cvtepi32_ps(_mm_unpacklo_epi16(n16a, zero));
+    q[1]         = _mm_cvtepi32_ps(_mm_unpackhi_epi16(n16a, zero));
+    q[2]         = _mm_cvtepi32_ps(_mm_unpacklo_epi16(n16b, zero));
+    q[3]         = _mm_cvtepi32_ps(_mm_unpackhi_epi16(n16b, zero));
+}
+
+/* SSE2 implementation for affine 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitAffineSSE2(float *out, const uint8_t *weights, const float *input,
+                                 int count, int rows, int cols, int c0, int c1, float scale,
+                                 float zeroPoint)
+{
+    /* Rows and the column range must start on a byte boundary for the vector loads */
+    if ((cols & 1) || (c0 & 1)) {
+        matMul4BitAffineReference(out, weights, input, count, rows, cols, c0, c1, scale,
+                                  zeroPoint);
+        return;
     }
 
-    /* Handle remaining elements */
-    for (int i = chunks * 4; i < size; i++) {
-        out[i] = a[i] + b[i];
+    int chunks = (c1 - c0) / 16;
+    int tail   = c0 + chunks * 16;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const uint8_t *row = weights + (size_t)k * (cols / 2);
+
+        /* Process 16 weights (8 bytes) at a time, unpacked once for all inputs */
+        for (int c = 0; c < chunks; c++) {
+            int    j0 = c0 + c * 16;
+            __m128 q[4];
+            unpackNibblesSSE2(row + j0 / 2, q);
+
+            for (int b = 0; b < count; b++) {
+                float x = input[(size_t)b * rows + k];
+                if (x == 0.0f) {
+                    continue;
+                }
+
+                float *dst = out + (size_t)b * cols + j0;
+                __m128 vx  = _mm_set1_ps(x);
+                _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(vx, q[0])));
+                _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(vx, q[1])));
+                _mm_storeu_ps(dst + 8, _mm_add_ps(_mm_loadu_ps(dst + 8), _mm_mul_ps(vx, q[2])));
+                _mm_storeu_ps(dst + 12,
+                              _mm_add_ps(_mm_loadu_ps(dst + 12), _mm_mul_ps(vx, q[3])));
+            }
+        }
+
+        /* Handle remaining column pairs */
+        for (int j = tail; j < c1; j += 2) {
+            uint8_t packed = row[j / 2];
+            for (int b = 0; b < count; b++) {
+                float  x   = input[(size_t)b * rows + k];
+                float *dst = out + (size_t)b * cols;
+                dst[j] += x * ((packed >> 4) & 0x0F);
+                if (j + 1 < c1) {
+                    dst[j + 1] += x * (packed & 0x0F);
+                }
+            }
+        }
+    }
+
+    /* Apply scale and zero point once per output */
+    __m128 vscale = _mm_set1_ps(scale);
+    for (int b = 0; b < count; b++) {
+        const float *x        = input + (size_t)b * rows;
+        float       *dst      = out + (size_t)b * cols;
+        float        inputSum = 0.0f;
+        for (int k = 0; k < rows; k++) {
+            inputSum += x[k];
+        }
+
+        __m128 voffset = _mm_set1_ps(inputSum * zeroPoint);
+        int    j       = c0;
+        for (; j + 4 <= c1; j += 4) {
+            __m128 v = _mm_loadu_ps(dst + j);
+            _mm_storeu_ps(dst + j, _mm_add_ps(_mm_mul_ps(v, vscale), voffset));
+        }
+        for (; j < c1; j++) {
+            dst[j] = dst[j] * scale + inputSum * zeroPoint;
+        }
     }
 }
 #endif
 
-#if defined(HAS_AVX_SUPPORT)
-/* AVX implementation for vector addition */
-static void vecAddAVX(float *out, const float *a, const float *b, int size)
+#if defined(HAS_AVX512_SUPPORT)
+/* Unpack 16 bytes (32 values, high nibble first) into two vectors of floats */
+static inline TINYAI_TARGET_AVX512 void unpackNibblesAVX512(const uint8_t *src, __m512 q[2])
 {
-    int chunks = size / 8;
+    const __m128i mask = _mm_set1_epi8(0x0F);
 
-    /* Process 8 elements at a time */
-    for (int i = 0; i < chunks; i++) {
-        __m256 va  = _mm256_loadu_ps(a + i * 8);
-        __m256 vb  = _mm256_loadu_ps(b + i * 8);
-        __m256 sum = _mm256_add_ps(va, vb);
-        _mm256_storeu_ps(out + i * 8, sum);
+    /* Split nibbles and interleave so element order matches memory order */
+    __m128i packed = _mm_loadu_si128((const __m128i *)src);
+    __m128i hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    __m128i lo     = _mm_and_si128(packed, mask);
+
+    /* Widen each half to sixteen 32-bit integers and convert to floats */
+    q[0] = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_unpacklo_epi8(hi, lo)));
+    q[1] = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_unpackhi_epi8(hi, lo)));
+}
+
+/* AVX-512 implementation for affine 4-bit matrix multiplication (columns [c0, c1)) */
+static TINYAI_TARGET_AVX512 void matMul4BitAffineAVX512(float *out, const uint8_t *weights,
+                                                        const float *input, int count, int rows,
+                                                        int cols, int c0, int c1, float scale,
+                                                        float zeroPoint)
+{
+    /* Rows and the column range must start on a byte boundary for the vector loads */
+    if ((cols & 1) || (c0 & 1)) {
+        matMul4BitAffineReference(out, weights, input, count, rows, cols, c0, c1, scale,
+                                  zeroPoint);
+        return;
     }
 
-    /* Handle remaining elements */
-    for (int i = chunks * 8; i < size; i++) {
-        out[i] = a[i] + b[i];
+    int chunks = (c1 - c0) / 32;
+    int tail   = c0 + chunks * 32;
+    int rest   = c1 - tail;
+
+    /* Lanes of the two vectors of the last, partial chunk */
+    __mmask16 restMask[2];
+    restMask[0] = (__mmask16)((1u << (rest < 16 ? rest : 16)) - 1);
+    restMask[1] = (__mmask16)(rest > 16 ? (1u << (rest - 16)) - 1 : 0);
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
     }
-}
-#endif
 
-/* AVX2 implementation forward declarations */
-#if defined(HAS_AVX2_SUPPORT)
-/* Forward declarations from simd_ops_avx2.c */
-void matMul4BitAVX2(float *out, const uint8_t *weights, const float *input, int rows, int cols,
-                    const float *scaleFactors);
-void quantize4BitAVX2(uint8_t *out, const float *in, int size, float *scaleFactors, int blockSize);
-void geluActivateAVX2(float *inout, int size);
-void sigmoidActivateAVX2(float *inout, int size);
+    for (int k = 0; k < rows; k++) {
+        const uint8_t *row = weights + (size_t)k * (cols / 2);
+
+        /* Process 32 weights (16 bytes) at a time, unpacked once for all inputs */
+        for (int c = 0; c < chunks; c++) {
+            int    j0 = c0 + c * 32;
+            __m512 q[2];
+            unpackNibblesAVX512(row + j0 / 2, q);
+
+            for (int b = 0; b < count; b++) {
+                float x = input[(size_t)b * rows + k];
+                if (x == 0.0f) {
+                    continue;
+                }
+
+                float *dst = out + (size_t)b * cols + j0;
+                __m512 vx  = _mm512_set1_ps(x);
+                _mm512_storeu_ps(dst, _mm512_fmadd_ps(vx, q[0], _mm512_loadu_ps(dst)));
+                _mm512_storeu_ps(dst + 16, _mm512_fmadd_ps(vx, q[1], _mm512_loadu_ps(dst + 16)));
+            }
+        }
+
+        /* The partial chunk is staged in a copy so no load reads past the row */
+        if (rest > 0) {
+            uint8_t bytes[16] = {0};
+            __m512  q[2];
+            memcpy(bytes, row + tail / 2, (size_t)(rest + 1) / 2);
+            unpackNibblesAVX512(bytes, q);
+
+            for (int b = 0; b < count; b++) {
+                float x = input[(size_t)b * rows + k];
+                if (x == 0.0f) {
+                    continue;
+                }
+
+                float *dst = out + (size_t)b * cols + tail;
+                __m512 vx  = _mm512_set1_ps(x);
+                __m512 acc = _mm512_maskz_loadu_ps(restMask[0], dst);
+                _mm512_mask_storeu_ps(dst, restMask[0], _mm512_fmadd_ps(vx, q[0], acc));
+                if (rest > 16) {
+                    acc = _mm512_maskz_loadu_ps(restMask[1], dst + 16);
+                    _mm512_mask_storeu_ps(dst + 16, restMask[1], _mm512_fmadd_ps(vx, q[1], acc));
+                }
+            }
+        }
+    }
+
+    /* Apply scale and zero point once per output */
+    __m512 vscale = _mm512_set1_ps(scale);
+    for (int b = 0; b < count; b++) {
+        const float *x        = input + (size_t)b * rows;
+        float       *dst      = out + (size_t)b * cols;
+        float        inputSum = 0.0f;
+        for (int k = 0; k < rows; k++) {
+            inputSum += x[k];
+        }
+
+        __m512 voffset = _mm512_set1_ps(inputSum * zeroPoint);
+        int    j       = c0;
+        for (; j + 16 <= c1; j += 16) {
+            _mm512_storeu_ps(dst + j, _mm512_fmadd_ps(_mm512_loadu_ps(dst + j), vscale, voffset));
+        }
+        if (j < c1) {
+            __mmask16 mask = (__mmask16)((1u << (c1 - j)) - 1);
+            __m512    v    = _mm512_maskz_loadu_ps(mask, dst + j);
+            _mm512_mask_storeu_ps(dst + j, mask, _mm512_fmadd_ps(v, vscale, voffset));
+        }
+    }
+}
 #endif
 
-/* Public API for vector addition */
-void tinyaiSimdVecAdd(float *out, const float *a, const float *b, int size)
+/* Public API for affine 4-bit matrix multiplication over a column range */
+void tinyaiSimdMatMul4BitAffineColumns(float *out, const uint8_t *weights, const float *input,
+                                       int count, int rows, int cols, int colBegin, int colEnd,
+                                       float scale, float zeroPoint)
 {
     if (!g_simdInitialized) {
         detectSimdCapabilities();
     }
 
-#if defined(HAS_AVX_SUPPORT)
-    if (g_hasAVX) {
-        vecAddAVX(out, a, b, size);
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd) {
+        return;
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        matMul4BitAffineAVX512(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                               zeroPoint);
         return;
     }
 #endif
 
 #if defined(HAS_SSE2_SUPPORT)
     if (g_hasSSE2) {
-        vecAddSSE2(out, a, b, size);
+        matMul4BitAffineSSE2(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                             zeroPoint);
         return;
     }
 #endif
 
-    vecAddReference(out, a, b, size);
+    matMul4BitAffineReference(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                              zeroPoint);
 }
 
-/* Reference implementations for activation functions */
-static float reluReference(float x) { return x > 0.0f ? x : 0.0f; }
+/* Public API for affine 4-bit matrix multiplication */
+void tinyaiSimdMatMul4BitAffine(float *out, const uint8_t *weights, const float *input, int count,
+                                int rows, int cols, float scale, float zeroPoint)
+{
+    tinyaiSimdMatMul4BitAffineColumns(out, weights, input, count, rows, cols, 0, cols, scale,
+                                      zeroPoint);
+}
 
-static float geluReference(float x)
+/* Public API for affine 4-bit vector-matrix multiplication */
+void tinyaiSimdVecMatMul4BitAffine(float *out, const uint8_t *weights, const float *input,
+                                   int rows, int cols, float scale, float zeroPoint)
 {
-    /* Approximate GELU: 0.5 * x * (1 + tanh(sqrt(2/π) * (x + 0.044715 * x^3))) */
-    const float sqrt2_over_pi = 0.7978845608f;
-    float       x3            = x * x * x;
-    float       inner         = sqrt2_over_pi * (x + 0.044715f * x3);
-    return 0.5f * x * (1.0f + tanhf(inner));
+    tinyaiSimdMatMul4BitAffine(out, weights, input, 1, rows, cols, scale, zeroPoint);
 }
 
-static float sigmoidReference(float x) { return 1.0f / (1.0f + expf(-x)); }
+/* Columns of a panel of the prepacked 4-bit layout (also its width in the SIMD kernels) */
+#define PANEL_COLS 16
 
-static void activateReference(float *inout, int size, int activationType)
+/* Store columns [c0, c1) of a finished panel starting at column p0 with scale and zero point */
+static inline void storePanel(float *dst, const float acc[PANEL_COLS], int p0, int c0, int c1,
+                              float scale, float offset)
 {
-    for (int i = 0; i < size; i++) {
-        float x = inout[i];
-        switch (activationType) {
-        case 0: /* ReLU */
-            inout[i] = reluReference(x);
-            break;
-        case 1: /* GELU */
-            inout[i] = geluReference(x);
-            break;
-        case 2: /* Sigmoid */
-            inout[i] = sigmoidReference(x);
-            break;
-        default:
-            /* No change for unknown activation type */
-            break;
-        }
+    int first = c0 > p0 ? c0 : p0;
+    int last  = c1 < p0 + PANEL_COLS ? c1 : p0 + PANEL_COLS;
+    for (int j = first; j < last; j++) {
+        dst[j] = acc[j - p0] * scale + offset;
     }
 }
 
-#if defined(HAS_SSE2_SUPPORT)
-/* SSE2 implementation for activation functions */
-static void activateSSE2(float *inout, int size, int activationType)
+/* Sum of an input vector, for the zero point term of the affine 4-bit kernels */
+static inline float inputSum(const float *x, int rows)
 {
-    int chunks = size / 4;
-
-    switch (activationType) {
-    case 0: { /* ReLU */
-        __m128 zeros = _mm_setzero_ps();
-        for (int i = 0; i < chunks; i++) {
-            __m128 x      = _mm_loadu_ps(inout + i * 4);
-            __m128 result = _mm_max_ps(x, zeros);
-            _mm_storeu_ps(inout + i * 4, result);
-        }
-        break;
-    }
-    case 1: /* GELU - fallback to reference for complex functions */
-    case 2: /* Sigmoid - fallback to reference for complex functions */
-        activateReference(inout, size, activationType);
-        return;
+    float sum = 0.0f;
+    for (int k = 0; k < rows; k++) {
+        sum += x[k];
     }
+    return sum;
+}
 
-    /* Handle remaining elements */
-    for (int i = chunks * 4; i < size; i++) {
-        float x = inout[i];
-        switch (activationType) {
-        case 0: /* ReLU */
-            inout[i] = reluReference(x);
-            break;
-        case 1: /* GELU */
-            inout[i] = geluReference(x);
-            break;
-        case 2: /* Sigmoid */
-            inout[i] = sigmoidReference(x);
-            break;
+/* Reference implementation for prepacked 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitPanelsReference(float *out, const uint8_t *panels, const float *input,
+                                      int count, int rows, int cols, int c0, int c1, float scale,
+                                      float zeroPoint)
+{
+    for (int p = c0 / PANEL_COLS; p * PANEL_COLS < c1; p++) {
+        const uint8_t *panel = panels + (size_t)p * rows * (PANEL_COLS / 2);
+
+        for (int b = 0; b < count; b++) {
+            const float *x              = input + (size_t)b * rows;
+            float        acc[PANEL_COLS] = {0};
+
+            /* The whole panel accumulates over every row before anything is stored */
+            for (int k = 0; k < rows; k++) {
+                const uint8_t *bytes = panel + (size_t)k * (PANEL_COLS / 2);
+                for (int i = 0; i < PANEL_COLS / 2; i++) {
+                    acc[i] += x[k] * (bytes[i] & 0x0F);
+                    acc[i + PANEL_COLS / 2] += x[k] * (bytes[i] >> 4);
+                }
+            }
+
+            storePanel(out + (size_t)b * cols, acc, p * PANEL_COLS, c0, c1, scale,
+                       inputSum(x, rows) * zeroPoint);
         }
     }
 }
-#endif
 
-#if defined(HAS_AVX_SUPPORT)
-/* AVX implementation for activation functions */
-static void activateAVX(float *inout, int size, int activationType)
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for prepacked 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitPanelsSSE2(float *out, const uint8_t *panels, const float *input,
+                                 int count, int rows, int cols, int c0, int c1, float scale,
+                                 float zeroPoint, int prefetch)
 {
-    int chunks = size / 8;
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i zero = _mm_setzero_si128();
 
-    switch (activationType) {
-    case 0: { /* ReLU */
-        __m256 zeros = _mm256_setzero_ps();
-        for (int i = 0; i < chunks; i++) {
-            __m256 x      = _mm256_loadu_ps(inout + i * 8);
-            __m256 result = _mm256_max_ps(x, zeros);
-            _mm256_storeu_ps(inout + i * 8, result);
-        }
+    /* A panel read for a single input is not read again, so it bypasses L2 */
+    size_t ahead = count == 1 ? (size_t)prefetch : 0;
+
+    for (int p = c0 / PANEL_COLS; p * PANEL_COLS < c1; p++) {
+        const uint8_t *panel = panels + (size_t)p * rows * (PANEL_COLS / 2);
+        int            p0    = p * PANEL_COLS;
+
+        for (int b = 0; b < count; b++) {
+            const float *x   = input + (size_t)b * rows;
+            __m128       acc[4];
+            acc[0] = acc[1] = acc[2] = acc[3] = _mm_setzero_ps();
+
+            for (int k = 0; k < rows; k++) {
+                /* One prefetch per 64-byte line; prefetches past the end never fault */
+                if (ahead && (k & 7) == 0) {
+                    _mm_prefetch((const char *)(panel + (size_t)k * 8 + ahead), _MM_HINT_NTA);
+                }
+
+                /* Low nibbles are the first 8 columns and high nibbles the last 8 */
+                __m128i packed = _mm_loadl_epi64((const __m128i *)(panel + (size_t)k * 8));
+                __m128i nib    = _mm_unpacklo_epi64(_mm_and_si128(packed, mask),
+                                                    _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+                __m128i n16a   = _mm_unpacklo_epi8(nib, zero);
+                __m128i n16b   = _mm_unpackhi_epi8(nib, zero);
+                __m128  vx     = _mm_set1_ps(x[k]);
+
+                acc[0] = _mm_add_ps(acc[0],
+                                    _mm_mul_ps(vx, _mm_cvtepi32_ps(_mm_unpacklo_epi16(n16a, zero))));
+                acc[1] = _mm_add_ps(acc[1],
+                                    _mm_mul_ps(vx, _mm_cvtepi32_ps(_mm_unpackhi_epi16(n16a, zero))));
+                acc[2] = _mm_add_ps(acc[2],
+                                    _mm_mul_ps(vx, _mm_cvtepi32_ps(_mm_unpacklo_epi16(n16b, zero))));
+                acc[3] = _mm_add_ps(acc[3],
+                                    _mm_mul_ps(vx, _mm_cvtepi32_ps(_mm_unpackhi_epi16(n16b, zero))));
+            }
+
+            float *dst    = out + (size_t)b * cols;
+            float  offset = inputSum(x, rows) * zeroPoint;
+            if (p0 >= c0 && p0 + PANEL_COLS <= c1) {
+                __m128 vscale  = _mm_set1_ps(scale);
+                __m128 voffset = _mm_set1_ps(offset);
+                for (int i = 0; i < 4; i++) {
+                    _mm_storeu_ps(dst + p0 + i * 4,
+                                  _mm_add_ps(_mm_mul_ps(acc[i], vscale), voffset));
+                }
+                continue;
+            }
+
+            /* A panel cut by the range or the last column */
+            float sums[PANEL_COLS];
+            for (int i = 0; i < 4; i++) {
+                _mm_storeu_ps(sums + i * 4, acc[i]);
+            }
+            storePanel(dst, sums, p0, c0, c1, scale, offset);
+        }
+    }
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+/* Unpack one row of a panel (8 bytes) into 16 floats in column order: the bytes are widened
+   twice, and the second copy shifted down to its high nibbles */
+static inline TINYAI_TARGET_AVX512 __m512 unpackPanelRowAVX512(const uint8_t *src, __m512i shift,
+                                                               __m512i mask)
+{
+    __m128i bytes = _mm_castpd_si128(_mm_loaddup_pd((const double *)src));
+    __m512i q     = _mm512_srlv_epi32(_mm512_cvtepu8_epi32(bytes), shift);
+    return _mm512_cvtepi32_ps(_mm512_and_si512(q, mask));
+}
+
+/* Issue non-temporal prefetches for rows [k, k + 8) of four panels, one line each */
+static inline void prefetchPanelsAVX512(const uint8_t *const panel[4], int k, size_t ahead)
+{
+    for (int i = 0; i < 4; i++) {
+        _mm_prefetch((const char *)(panel[i] + (size_t)k * 8 + ahead), _MM_HINT_NTA);
+    }
+}
+
+/* Sums of four panels for one or two inputs: up to eight independent chains, each column still
+   summed row by row in the same order whatever the grouping. Weights are prefetched ahead bytes
+   in advance when it is nonzero. */
+static inline TINYAI_TARGET_AVX512 void panelSumsAVX512(__m512 acc[2][4],
+                                                        const uint8_t *const panel[4],
+                                                        const float *x0, const float *x1, int rows,
+                                                        size_t ahead)
+{
+    const __m512i shift = _mm512_set_epi32(4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m512i mask  = _mm512_set1_epi32(0x0F);
+    const uint8_t *p0 = panel[0], *p1 = panel[1], *p2 = panel[2], *p3 = panel[3];
+
+    __m512 a0 = _mm512_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+    __m512 b0 = a0, b1 = a0, b2 = a0, b3 = a0;
+
+    if (x1) {
+        for (int k = 0; k < rows; k++) {
+            if (ahead && (k & 7) == 0) {
+                prefetchPanelsAVX512(panel, k, ahead);
+            }
+            __m512 vx0 = _mm512_set1_ps(x0[k]);
+            __m512 vx1 = _mm512_set1_ps(x1[k]);
+            __m512 q0  = unpackPanelRowAVX512(p0 + (size_t)k * 8, shift, mask);
+            __m512 q1  = unpackPanelRowAVX512(p1 + (size_t)k * 8, shift, mask);
+            __m512 q2  = unpackPanelRowAVX512(p2 + (size_t)k * 8, shift, mask);
+            __m512 q3  = unpackPanelRowAVX512(p3 + (size_t)k * 8, shift, mask);
+            a0         = _mm512_fmadd_ps(vx0, q0, a0);
+            a1         = _mm512_fmadd_ps(vx0, q1, a1);
+            a2         = _mm512_fmadd_ps(vx0, q2, a2);
+            a3         = _mm512_fmadd_ps(vx0, q3, a3);
+            b0         = _mm512_fmadd_ps(vx1, q0, b0);
+            b1         = _mm512_fmadd_ps(vx1, q1, b1);
+            b2         = _mm512_fmadd_ps(vx1, q2, b2);
+            b3         = _mm512_fmadd_ps(vx1, q3, b3);
+        }
+    }
+    else {
+        for (int k = 0; k < rows; k++) {
+            if (ahead && (k & 7) == 0) {
+                prefetchPanelsAVX512(panel, k, ahead);
+            }
+            __m512 vx0 = _mm512_set1_ps(x0[k]);
+            a0 = _mm512_fmadd_ps(vx0, unpackPanelRowAVX512(p0 + (size_t)k * 8, shift, mask), a0);
+            a1 = _mm512_fmadd_ps(vx0, unpackPanelRowAVX512(p1 + (size_t)k * 8, shift, mask), a1);
+            a2 = _mm512_fmadd_ps(vx0, unpackPanelRowAVX512(p2 + (size_t)k * 8, shift, mask), a2);
+            a3 = _mm512_fmadd_ps(vx0, unpackPanelRowAVX512(p3 + (size_t)k * 8, shift, mask), a3);
+        }
+    }
+
+    acc[0][0] = a0;
+    acc[0][1] = a1;
+    acc[0][2] = a2;
+    acc[0][3] = a3;
+    acc[1][0] = b0;
+    acc[1][1] = b1;
+    acc[1][2] = b2;
+    acc[1][3] = b3;
+}
+
+/* AVX-512 implementation for prepacked 4-bit matrix multiplication (columns [c0, c1)) */
+static TINYAI_TARGET_AVX512 void matMul4BitPanelsAVX512(float *out, const uint8_t *panels,
+                                                        const float *input, int count, int rows,
+                                                        int cols, int c0, int c1, float scale,
+                                                        float zeroPoint, int prefetch)
+{
+    const size_t stride = (size_t)rows * (PANEL_COLS / 2);
+    int          pEnd   = (c1 + PANEL_COLS - 1) / PANEL_COLS;
+
+    /* Panels read in one pass over the inputs are not read again, so they bypass L2 */
+    size_t ahead = count <= 2 ? (size_t)prefetch : 0;
+
+    /* Four panels at a time; missing panels repeat the last one and are not stored */
+    for (int p = c0 / PANEL_COLS; p < pEnd; p += 4) {
+        const uint8_t *panel[4];
+        for (int i = 0; i < 4; i++) {
+            panel[i] = panels + (size_t)(p + i < pEnd ? p + i : pEnd - 1) * stride;
+        }
+
+        for (int b = 0; b < count; b += 2) {
+            const float *x[2] = {input + (size_t)b * rows, input + (size_t)(b + 1) * rows};
+            __m512       acc[2][4];
+            panelSumsAVX512(acc, panel, x[0], b + 1 < count ? x[1] : NULL, rows, ahead);
+
+            for (int v = 0; v < 2 && b + v < count; v++) {
+                float *dst    = out + (size_t)(b + v) * cols;
+                float  offset = inputSum(x[v], rows) * zeroPoint;
+                for (int i = 0; i < 4 && p + i < pEnd; i++) {
+                    int p0 = (p + i) * PANEL_COLS;
+                    if (p0 >= c0 && p0 + PANEL_COLS <= c1) {
+                        _mm512_storeu_ps(dst + p0, _mm512_fmadd_ps(acc[v][i], _mm512_set1_ps(scale),
+                                                                   _mm512_set1_ps(offset)));
+                        continue;
+                    }
+
+                    /* A panel cut by the range or the last column */
+                    float sums[PANEL_COLS];
+                    _mm512_storeu_ps(sums, acc[v][i]);
+                    storePanel(dst, sums, p0, c0, c1, scale, offset);
+                }
+            }
+        }
+    }
+}
+#endif
+
+/* Public API for prepacked 4-bit matrix multiplication over a column range */
+void tinyaiSimdMatMul4BitPanelsColumns(float *out, const uint8_t *panels, const float *input,
+                                       int count, int rows, int cols, int colBegin, int colEnd,
+                                       float scale, float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd) {
+        return;
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        matMul4BitPanelsAVX512(out, panels, input, count, rows, cols, colBegin, colEnd, scale,
+                               zeroPoint, tinyai_cache_opt_stream_prefetch());
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        matMul4BitPanelsSSE2(out, panels, input, count, rows, cols, colBegin, colEnd, scale,
+                             zeroPoint, tinyai_cache_opt_stream_prefetch());
+        return;
+    }
+#endif
+
+    matMul4BitPanelsReference(out, panels, input, count, rows, cols, colBegin, colEnd, scale,
+                              zeroPoint);
+}
+
+/* Add the zero point terms of group-quantized 4-bit weights (columns [c0, c1)) */
+static void addGroupedZeroPoints(float *out, const float *input, int count, int rows, int cols,
+                                 int c0, int c1, const float *zeroPoints, int groupSize)
+{
+    int groups = (cols + groupSize - 1) / groupSize;
+
+    /* Every column of a group gets the same sum over rows of x[k] * zeroPoint[k][g] */
+    for (int b = 0; b < count; b++) {
+        const float *x   = input + (size_t)b * rows;
+        float       *dst = out + (size_t)b * cols;
+
+        for (int g = c0 / groupSize; g * groupSize < c1; g++) {
+            float offset = 0.0f;
+            for (int k = 0; k < rows; k++) {
+                offset += x[k] * zeroPoints[(size_t)k * groups + g];
+            }
+
+            int j0 = g * groupSize > c0 ? g * groupSize : c0;
+            int j1 = (g + 1) * groupSize < c1 ? (g + 1) * groupSize : c1;
+            for (int j = j0; j < j1; j++) {
+                dst[j] += offset;
+            }
+        }
+    }
+}
+
+/* Reference implementation for group-quantized 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitGroupedReference(float *out, const uint8_t *weights, const float *input,
+                                       int count, int rows, int cols, int c0, int c1,
+                                       const float *scales, const float *zeroPoints,
+                                       int groupSize)
+{
+    int groups = (cols + groupSize - 1) / groupSize;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    /* Accumulate input[b][k] * scale[k][g] * q[k][j] row by row, skipping zero inputs */
+    for (int k = 0; k < rows; k++) {
+        size_t       base      = (size_t)k * cols;
+        const float *rowScales = scales + (size_t)k * groups;
+        for (int b = 0; b < count; b++) {
+            float x = input[(size_t)b * rows + k];
+            if (x == 0.0f) {
+                continue;
+            }
+
+            float *dst = out + (size_t)b * cols;
+            for (int j = c0; j < c1; j++) {
+                size_t  idx    = base + j;
+                uint8_t packed = weights[idx / 2];
+                int     q      = (idx & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+                dst[j] += x * rowScales[j / groupSize] * q;
+            }
+        }
+    }
+
+    addGroupedZeroPoints(out, input, count, rows, cols, c0, c1, zeroPoints, groupSize);
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for group-quantized 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitGroupedSSE2(float *out, const uint8_t *weights, const float *input,
+                                  int count, int rows, int cols, int c0, int c1,
+                                  const float *scales, const float *zeroPoints, int groupSize)
+{
+    /* Rows and every group must start on a byte boundary for the vector loads */
+    if ((cols & 1) || (c0 & 1) || (groupSize & 1)) {
+        matMul4BitGroupedReference(out, weights, input, count, rows, cols, c0, c1, scales,
+                                   zeroPoints, groupSize);
+        return;
+    }
+
+    int groups = (cols + groupSize - 1) / groupSize;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const uint8_t *row       = weights + (size_t)k * (cols / 2);
+        const float   *rowScales = scales + (size_t)k * groups;
+
+        /* The group's scale is folded into each input value */
+        for (int g = c0 / groupSize; g * groupSize < c1; g++) {
+            int   j0    = g * groupSize > c0 ? g * groupSize : c0;
+            int   j1    = (g + 1) * groupSize < c1 ? (g + 1) * groupSize : c1;
+            int   tail  = j0 + (j1 - j0) / 16 * 16;
+            float scale = rowScales[g];
+
+            /* Process 16 weights (8 bytes) at a time, unpacked once for all inputs */
+            for (int j = j0; j < tail; j += 16) {
+                __m128 q[4];
+                unpackNibblesSSE2(row + j / 2, q);
+
+                for (int b = 0; b < count; b++) {
+                    float x = input[(size_t)b * rows + k];
+                    if (x == 0.0f) {
+                        continue;
+                    }
+
+                    float *dst = out + (size_t)b * cols + j;
+                    __m128 vx  = _mm_set1_ps(x * scale);
+                    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(vx, q[0])));
+                    _mm_storeu_ps(dst + 4,
+                                  _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(vx, q[1])));
+                    _mm_storeu_ps(dst + 8,
+                                  _mm_add_ps(_mm_loadu_ps(dst + 8), _mm_mul_ps(vx, q[2])));
+                    _mm_storeu_ps(dst + 12,
+                                  _mm_add_ps(_mm_loadu_ps(dst + 12), _mm_mul_ps(vx, q[3])));
+                }
+            }
+
+            /* Handle remaining column pairs of the group */
+            for (int j = tail; j < j1; j += 2) {
+                uint8_t packed = row[j / 2];
+                for (int b = 0; b < count; b++) {
+                    float  x   = input[(size_t)b * rows + k] * scale;
+                    float *dst = out + (size_t)b * cols;
+                    dst[j] += x * ((packed >> 4) & 0x0F);
+                    if (j + 1 < j1) {
+                        dst[j + 1] += x * (packed & 0x0F);
+                    }
+                }
+            }
+        }
+    }
+
+    addGroupedZeroPoints(out, input, count, rows, cols, c0, c1, zeroPoints, groupSize);
+}
+#endif
+
+/* Public API for group-quantized 4-bit matrix multiplication over a column range */
+void tinyaiSimdMatMul4BitGroupedColumns(float *out, const uint8_t *weights, const float *input,
+                                        int count, int rows, int cols, int colBegin, int colEnd,
+                                        const float *scales, const float *zeroPoints,
+                                        int groupSize)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd || groupSize <= 0) {
+        return;
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        matMul4BitGroupedSSE2(out, weights, input, count, rows, cols, colBegin, colEnd, scales,
+                              zeroPoints, groupSize);
+        return;
+    }
+#endif
+
+    matMul4BitGroupedReference(out, weights, input, count, rows, cols, colBegin, colEnd, scales,
+                               zeroPoints, groupSize);
+}
+
+/* Reference implementation for codebook 4-bit matrix multiplication (columns [c0, c1)) */
+static void matMul4BitCodebookReference(float *out, const uint8_t *weights, const float *input,
+                                        int count, int rows, int cols, int c0, int c1,
+                                        const float *levels, const float *scales,
+                                        const float *zeroPoints, int groupSize)
+{
+    int groups = (cols + groupSize - 1) / groupSize;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    /* Accumulate input[b][k] * scale[k][g] * levels[q[k][j]] row by row, skipping zero inputs */
+    for (int k = 0; k < rows; k++) {
+        size_t       base      = (size_t)k * cols;
+        const float *rowScales = scales + (size_t)k * groups;
+        for (int b = 0; b < count; b++) {
+            float x = input[(size_t)b * rows + k];
+            if (x == 0.0f) {
+                continue;
+            }
+
+            float *dst = out + (size_t)b * cols;
+            for (int j = c0; j < c1; j++) {
+                size_t  idx    = base + j;
+                uint8_t packed = weights[idx / 2];
+                int     q      = (idx & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+                dst[j] += x * rowScales[j / groupSize] * levels[q];
+            }
+        }
+    }
+
+    addGroupedZeroPoints(out, input, count, rows, cols, c0, c1, zeroPoints, groupSize);
+}
+
+#if defined(HAS_SSSE3_SUPPORT)
+/* Split the 16 levels of a codebook into four tables of their bytes, one per byte position */
+static void codebookBytePlanes(const float *levels, __m128i planes[4])
+{
+    uint8_t bytes[4][16];
+    for (int q = 0; q < 16; q++) {
+        uint32_t bits;
+        memcpy(&bits, &levels[q], sizeof(bits));
+        for (int i = 0; i < 4; i++) {
+            bytes[i][q] = (uint8_t)(bits >> (8 * i));
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        planes[i] = _mm_loadu_si128((const __m128i *)bytes[i]);
+    }
+}
+
+/* Look up 8 bytes (16 values, high nibble first) in a codebook: one pshufb per byte plane gives
+   each byte of the 16 levels, and interleaving the planes rebuilds four vectors of floats */
+static inline TINYAI_TARGET_SSSE3 void lookupNibblesSSSE3(const uint8_t *src,
+                                                          const __m128i planes[4], __m128 q[4])
+{
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    /* Split nibbles and interleave so element order matches memory order */
+    __m128i packed = _mm_loadl_epi64((const __m128i *)src);
+    __m128i hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+    __m128i lo     = _mm_and_si128(packed, mask);
+    __m128i nib    = _mm_unpacklo_epi8(hi, lo);
+
+    __m128i b0 = _mm_shuffle_epi8(planes[0], nib);
+    __m128i b1 = _mm_shuffle_epi8(planes[1], nib);
+    __m128i b2 = _mm_shuffle_epi8(planes[2], nib);
+    __m128i b3 = _mm_shuffle_epi8(planes[3], nib);
+
+    /* Bytes 0-1 and 2-3 of each level, then whole levels */
+    __m128i low01  = _mm_unpacklo_epi8(b0, b1);
+    __m128i high01 = _mm_unpackhi_epi8(b0, b1);
+    __m128i low23  = _mm_unpacklo_epi8(b2, b3);
+    __m128i high23 = _mm_unpackhi_epi8(b2, b3);
+    q[0]           = _mm_castsi128_ps(_mm_unpacklo_epi16(low01, low23));
+    q[1]           = _mm_castsi128_ps(_mm_unpackhi_epi16(low01, low23));
+    q[2]           = _mm_castsi128_ps(_mm_unpacklo_epi16(high01, high23));
+    q[3]           = _mm_castsi128_ps(_mm_unpackhi_epi16(high01, high23));
+}
+
+/* SSSE3 implementation for codebook 4-bit matrix multiplication (columns [c0, c1)) */
+static TINYAI_TARGET_SSSE3 void matMul4BitCodebookSSSE3(float *out, const uint8_t *weights,
+                                                        const float *input, int count, int rows,
+                                                        int cols, int c0, int c1,
+                                                        const float *levels, const float *scales,
+                                                        const float *zeroPoints, int groupSize)
+{
+    /* Rows and every group must start on a byte boundary for the vector loads */
+    if ((cols & 1) || (c0 & 1) || (groupSize & 1)) {
+        matMul4BitCodebookReference(out, weights, input, count, rows, cols, c0, c1, levels,
+                                    scales, zeroPoints, groupSize);
+        return;
+    }
+
+    int     groups = (cols + groupSize - 1) / groupSize;
+    __m128i planes[4];
+    codebookBytePlanes(levels, planes);
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const uint8_t *row       = weights + (size_t)k * (cols / 2);
+        const float   *rowScales = scales + (size_t)k * groups;
+
+        /* The group's scale is folded into each input value */
+        for (int g = c0 / groupSize; g * groupSize < c1; g++) {
+            int   j0    = g * groupSize > c0 ? g * groupSize : c0;
+            int   j1    = (g + 1) * groupSize < c1 ? (g + 1) * groupSize : c1;
+            int   tail  = j0 + (j1 - j0) / 16 * 16;
+            float scale = rowScales[g];
+
+            /* Look up 16 weights (8 bytes) at a time, once for all inputs */
+            for (int j = j0; j < tail; j += 16) {
+                __m128 q[4];
+                lookupNibblesSSSE3(row + j / 2, planes, q);
+
+                for (int b = 0; b < count; b++) {
+                    float x = input[(size_t)b * rows + k];
+                    if (x == 0.0f) {
+                        continue;
+                    }
+
+                    float *dst = out + (size_t)b * cols + j;
+                    __m128 vx  = _mm_set1_ps(x * scale);
+                    _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(vx, q[0])));
+                    _mm_storeu_ps(dst + 4,
+                                  _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(vx, q[1])));
+                    _mm_storeu_ps(dst + 8,
+                                  _mm_add_ps(_mm_loadu_ps(dst + 8), _mm_mul_ps(vx, q[2])));
+                    _mm_storeu_ps(dst + 12,
+                                  _mm_add_ps(_mm_loadu_ps(dst + 12), _mm_mul_ps(vx, q[3])));
+                }
+            }
+
+            /* Handle remaining column pairs of the group */
+            for (int j = tail; j < j1; j += 2) {
+                uint8_t packed = row[j / 2];
+                for (int b = 0; b < count; b++) {
+                    float  x   = input[(size_t)b * rows + k] * scale;
+                    float *dst = out + (size_t)b * cols;
+                    dst[j] += x * levels[(packed >> 4) & 0x0F];
+                    if (j + 1 < j1) {
+                        dst[j + 1] += x * levels[packed & 0x0F];
+                    }
+                }
+            }
+        }
+    }
+
+    addGroupedZeroPoints(out, input, count, rows, cols, c0, c1, zeroPoints, groupSize);
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+/* Look up 8 bytes (16 values, high nibble first) in a codebook held in one register. vpermps
+   only reads the low 4 bits of each index, so the nibbles need no masking */
+static inline TINYAI_TARGET_AVX512 __m512 lookupNibblesAVX512(const uint8_t *src, __m512 levels)
+{
+    __m128i packed = _mm_loadl_epi64((const __m128i *)src);
+    __m128i nib    = _mm_unpacklo_epi8(_mm_srli_epi16(packed, 4), packed);
+    return _mm512_permutexvar_ps(_mm512_cvtepu8_epi32(nib), levels);
+}
+
+/* AVX-512 implementation for codebook 4-bit matrix multiplication (columns [c0, c1)) */
+static TINYAI_TARGET_AVX512 void matMul4BitCodebookAVX512(float *out, const uint8_t *weights,
+                                                          const float *input, int count,
+                                                          int rows, int cols, int c0, int c1,
+                                                          const float *levels,
+                                                          const float *scales,
+                                                          const float *zeroPoints, int groupSize)
+{
+    /* Rows and every group must start on a byte boundary for the vector loads */
+    if ((cols & 1) || (c0 & 1) || (groupSize & 1)) {
+        matMul4BitCodebookReference(out, weights, input, count, rows, cols, c0, c1, levels,
+                                    scales, zeroPoints, groupSize);
+        return;
+    }
+
+    int    groups = (cols + groupSize - 1) / groupSize;
+    __m512 vlevel = _mm512_loadu_ps(levels);
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const uint8_t *row       = weights + (size_t)k * (cols / 2);
+        const float   *rowScales = scales + (size_t)k * groups;
+
+        /* The group's scale is folded into each input value */
+        for (int g = c0 / groupSize; g * groupSize < c1; g++) {
+            int   j0    = g * groupSize > c0 ? g * groupSize : c0;
+            int   j1    = (g + 1) * groupSize < c1 ? (g + 1) * groupSize : c1;
+            float scale = rowScales[g];
+
+            /* Look up 16 weights (8 bytes) at a time, once for all inputs; a partial chunk is
+               staged in a copy so no load reads past the row */
+            for (int j = j0; j < j1; j += 16) {
+                int       n    = j1 - j < 16 ? j1 - j : 16;
+                __mmask16 mask = (__mmask16)((1u << n) - 1);
+                __m512    q;
+                if (n == 16) {
+                    q = lookupNibblesAVX512(row + j / 2, vlevel);
+                } else {
+                    uint8_t bytes[8] = {0};
+                    memcpy(bytes, row + j / 2, (size_t)(n + 1) / 2);
+                    q = lookupNibblesAVX512(bytes, vlevel);
+                }
+
+                for (int b = 0; b < count; b++) {
+                    float x = input[(size_t)b * rows + k];
+                    if (x == 0.0f) {
+                        continue;
+                    }
+
+                    float *dst = out + (size_t)b * cols + j;
+                    __m512 vx  = _mm512_set1_ps(x * scale);
+                    __m512 acc = _mm512_maskz_loadu_ps(mask, dst);
+                    _mm512_mask_storeu_ps(dst, mask, _mm512_fmadd_ps(vx, q, acc));
+                }
+            }
+        }
+    }
+
+    addGroupedZeroPoints(out, input, count, rows, cols, c0, c1, zeroPoints, groupSize);
+}
+#endif
+
+/* Public API for codebook 4-bit matrix multiplication over a column range */
+void tinyaiSimdMatMul4BitCodebookColumns(float *out, const uint8_t *weights, const float *input,
+                                         int count, int rows, int cols, int colBegin,
+                                         int colEnd, const float *levels, const float *scales,
+                                         const float *zeroPoints, int groupSize)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd || groupSize <= 0) {
+        return;
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        matMul4BitCodebookAVX512(out, weights, input, count, rows, cols, colBegin, colEnd,
+                                 levels, scales, zeroPoints, groupSize);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSSE3_SUPPORT)
+    if (g_hasSSSE3) {
+        matMul4BitCodebookSSSE3(out, weights, input, count, rows, cols, colBegin, colEnd, levels,
+                                scales, zeroPoints, groupSize);
+        return;
+    }
+#endif
+
+    matMul4BitCodebookReference(out, weights, input, count, rows, cols, colBegin, colEnd, levels,
+                                scales, zeroPoints, groupSize);
+}
+
+/* Reference implementation for the minimum and maximum of an array (NaNs are skipped) */
+static void minMaxReference(const float *in, int size, float *min, float *max)
+{
+    for (int i = 0; i < size; i++) {
+        if (in[i] < *min)
+            *min = in[i];
+        if (in[i] > *max)
+            *max = in[i];
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* Reduce the four lanes of a minimum and a maximum vector into *min and *max */
+static inline void reduceMinMaxSSE2(__m128 vmin, __m128 vmax, float *min, float *max)
+{
+    float lanesMin[4], lanesMax[4];
+    _mm_storeu_ps(lanesMin, vmin);
+    _mm_storeu_ps(lanesMax, vmax);
+    for (int i = 0; i < 4; i++) {
+        if (lanesMin[i] < *min)
+            *min = lanesMin[i];
+        if (lanesMax[i] > *max)
+            *max = lanesMax[i];
+    }
+}
+
+/* SSE2 implementation for the minimum and maximum of an array */
+static void minMaxSSE2(const float *in, int size, float *min, float *max)
+{
+    /* minps/maxps return the second operand when either is NaN, so NaN inputs are skipped */
+    __m128 vmin = _mm_set1_ps(*min);
+    __m128 vmax = _mm_set1_ps(*max);
+    int    i    = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128 v = _mm_loadu_ps(in + i);
+        vmin     = _mm_min_ps(v, vmin);
+        vmax     = _mm_max_ps(v, vmax);
+    }
+    reduceMinMaxSSE2(vmin, vmax, min, max);
+    minMaxReference(in + i, size - i, min, max);
+}
+#endif
+
+#if defined(HAS_AVX_SUPPORT)
+/* AVX implementation for the minimum and maximum of an array */
+static TINYAI_TARGET_AVX void minMaxAVX(const float *in, int size, float *min, float *max)
+{
+    /* Two accumulators per bound hide the latency of the compares */
+    __m256 vmin0 = _mm256_set1_ps(*min), vmin1 = vmin0;
+    __m256 vmax0 = _mm256_set1_ps(*max), vmax1 = vmax0;
+    int    i     = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256 v0 = _mm256_loadu_ps(in + i);
+        __m256 v1 = _mm256_loadu_ps(in + i + 8);
+        vmin0     = _mm256_min_ps(v0, vmin0);
+        vmin1     = _mm256_min_ps(v1, vmin1);
+        vmax0     = _mm256_max_ps(v0, vmax0);
+        vmax1     = _mm256_max_ps(v1, vmax1);
+    }
+    vmin0 = _mm256_min_ps(vmin0, vmin1);
+    vmax0 = _mm256_max_ps(vmax0, vmax1);
+    reduceMinMaxSSE2(_mm_min_ps(_mm256_castps256_ps128(vmin0), _mm256_extractf128_ps(vmin0, 1)),
+                     _mm_max_ps(_mm256_castps256_ps128(vmax0), _mm256_extractf128_ps(vmax0, 1)),
+                     min, max);
+    minMaxReference(in + i, size - i, min, max);
+}
+#endif
+
+/* Public API for the minimum and maximum of an array */
+void tinyaiSimdMinMax(const float *in, int size, float *min, float *max)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX_SUPPORT)
+    if (g_hasAVX) {
+        minMaxAVX(in, size, min, max);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        minMaxSSE2(in, size, min, max);
+        return;
+    }
+#endif
+
+    minMaxReference(in, size, min, max);
+}
+
+/* Affine 4-bit level of a value: (in - zeroPoint) / scale rounded half up, clamped to [0, 15] */
+static inline int quantize4BitAffineValue(float in, float scale, float zeroPoint)
+{
+    int q = (int)((in - zeroPoint) / scale + 0.5f);
+    return q < 0 ? 0 : (q > 15 ? 15 : q);
+}
+
+/* Reference implementation for affine 4-bit quantization */
+static void quantize4BitAffineReference(uint8_t *out, const float *in, int size, float scale,
+                                        float zeroPoint)
+{
+    for (int i = 0; i < size; i += 2) {
+        int hi = quantize4BitAffineValue(in[i], scale, zeroPoint);
+        int lo = i + 1 < size ? quantize4BitAffineValue(in[i + 1], scale, zeroPoint) : 0;
+        out[i / 2] = (uint8_t)((hi << 4) | lo);
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* Truncate ((in - zeroPoint) / scale + 0.5) for 4 values, as the scalar cast does */
+static inline __m128i quantizeAffineSSE2(const float *in, __m128 vzero, __m128 vscale)
+{
+    __m128 v = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(in), vzero), vscale);
+    return _mm_cvttps_epi32(_mm_add_ps(v, _mm_set1_ps(0.5f)));
+}
+
+/* SSE2 implementation for affine 4-bit quantization */
+static void quantize4BitAffineSSE2(uint8_t *out, const float *in, int size, float scale,
+                                   float zeroPoint)
+{
+    const __m128  vscale = _mm_set1_ps(scale);
+    const __m128  vzero  = _mm_set1_ps(zeroPoint);
+    const __m128i max    = _mm_set1_epi8(15);
+    const __m128i lowMask = _mm_set1_epi16(0x00FF);
+    int           chunks = size / 16;
+
+    /* 16 values to 8 bytes: saturating packs clamp below at 0, then pairs merge high first */
+    for (int c = 0; c < chunks; c++) {
+        const float *src = in + c * 16;
+        __m128i      q01 = _mm_packs_epi32(quantizeAffineSSE2(src, vzero, vscale),
+                                           quantizeAffineSSE2(src + 4, vzero, vscale));
+        __m128i      q23 = _mm_packs_epi32(quantizeAffineSSE2(src + 8, vzero, vscale),
+                                           quantizeAffineSSE2(src + 12, vzero, vscale));
+        __m128i      q   = _mm_min_epu8(_mm_packus_epi16(q01, q23), max);
+        __m128i      packed =
+            _mm_or_si128(_mm_slli_epi16(_mm_and_si128(q, lowMask), 4), _mm_srli_epi16(q, 8));
+        _mm_storel_epi64((__m128i *)(out + c * 8), _mm_packus_epi16(packed, packed));
+    }
+
+    /* Handle remaining values */
+    quantize4BitAffineReference(out + chunks * 8, in + chunks * 16, size - chunks * 16, scale,
+                                zeroPoint);
+}
+#endif
+
+/* Public API for affine 4-bit quantization */
+void tinyaiSimdQuantize4BitAffine(uint8_t *out, const float *in, int size, float scale,
+                                  float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        quantize4BitAffineSSE2(out, in, size, scale, zeroPoint);
+        return;
+    }
+#endif
+
+    quantize4BitAffineReference(out, in, size, scale, zeroPoint);
+}
+
+/* Reference implementation for affine 8-bit quantization */
+static void quantize8BitAffineReference(int8_t *out, const float *in, int size, float scale,
+                                        float zeroPoint)
+{
+    for (int i = 0; i < size; i++) {
+        int q  = (int)((in[i] - zeroPoint) / scale + 0.5f);
+        out[i] = (int8_t)(q < -127 ? -127 : (q > 127 ? 127 : q));
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for affine 8-bit quantization */
+static void quantize8BitAffineSSE2(int8_t *out, const float *in, int size, float scale,
+                                   float zeroPoint)
+{
+    const __m128  vscale = _mm_set1_ps(scale);
+    const __m128  vzero  = _mm_set1_ps(zeroPoint);
+    const __m128i floor  = _mm_set1_epi8(-128);
+    const __m128i one    = _mm_set1_epi8(1);
+    int           chunks = size / 16;
+
+    /* Saturating packs clamp to [-128, 127]; SSE2 has no signed byte max, so -128 is raised to
+       -127 by setting its low bit */
+    for (int c = 0; c < chunks; c++) {
+        const float *src = in + c * 16;
+        __m128i      q01 = _mm_packs_epi32(quantizeAffineSSE2(src, vzero, vscale),
+                                           quantizeAffineSSE2(src + 4, vzero, vscale));
+        __m128i      q23 = _mm_packs_epi32(quantizeAffineSSE2(src + 8, vzero, vscale),
+                                           quantizeAffineSSE2(src + 12, vzero, vscale));
+        __m128i      q   = _mm_packs_epi16(q01, q23);
+        q                = _mm_or_si128(q, _mm_and_si128(_mm_cmpeq_epi8(q, floor), one));
+        _mm_storeu_si128((__m128i *)(out + c * 16), q);
+    }
+
+    /* Handle remaining values */
+    quantize8BitAffineReference(out + chunks * 16, in + chunks * 16, size - chunks * 16, scale,
+                                zeroPoint);
+}
+#endif
+
+/* Public API for affine 8-bit quantization */
+void tinyaiSimdQuantize8BitAffine(int8_t *out, const float *in, int size, float scale,
+                                  float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        quantize8BitAffineSSE2(out, in, size, scale, zeroPoint);
+        return;
+    }
+#endif
+
+    quantize8BitAffineReference(out, in, size, scale, zeroPoint);
+}
+
+/* Reference implementation for symmetric int8 quantization */
+static void quantizeInt8Reference(int8_t *out, const float *in, int size, float invScale)
+{
+    for (int i = 0; i < size; i++) {
+        long q = lrintf(in[i] * invScale);
+        q      = q > 127 ? 127 : (q < -127 ? -127 : q);
+        out[i] = (int8_t)q;
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for the largest magnitude of a vector */
+static float maxAbsSSE2(const float *in, int size)
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128       vmax     = _mm_setzero_ps();
+    int          i        = 0;
+    for (; i + 4 <= size; i += 4) {
+        vmax = _mm_max_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(in + i)), vmax);
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, vmax);
+    float maxAbs = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+    for (; i < size; i++) {
+        maxAbs = fmaxf(maxAbs, fabsf(in[i]));
+    }
+    return maxAbs;
+}
+
+/* SSE2 implementation for symmetric int8 quantization (cvtps2dq rounds like lrintf) */
+static void quantizeInt8SSE2(int8_t *out, const float *in, int size, float invScale)
+{
+    const __m128  vinv   = _mm_set1_ps(invScale);
+    const __m128i floor  = _mm_set1_epi8(-128);
+    const __m128i one    = _mm_set1_epi8(1);
+    int           chunks = size / 16;
+
+    for (int c = 0; c < chunks; c++) {
+        const float *src = in + c * 16;
+        __m128i      q0  = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src), vinv));
+        __m128i      q1  = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + 4), vinv));
+        __m128i      q2  = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + 8), vinv));
+        __m128i      q3  = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + 12), vinv));
+        __m128i      q = _mm_packs_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+        q              = _mm_or_si128(q, _mm_and_si128(_mm_cmpeq_epi8(q, floor), one));
+        _mm_storeu_si128((__m128i *)(out + c * 16), q);
+    }
+
+    quantizeInt8Reference(out + chunks * 16, in + chunks * 16, size - chunks * 16, invScale);
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+/* NEON implementation for the largest magnitude of a vector */
+static float maxAbsNEON(const float *in, int size)
+{
+    float32x4_t vmax = vdupq_n_f32(0.0f);
+    int         i    = 0;
+    for (; i + 4 <= size; i += 4) {
+        vmax = vmaxq_f32(vabsq_f32(vld1q_f32(in + i)), vmax);
+    }
+
+    float maxAbs = vmaxvq_f32(vmax);
+    for (; i < size; i++) {
+        maxAbs = fmaxf(maxAbs, fabsf(in[i]));
+    }
+    return maxAbs;
+}
+
+/* NEON implementation for symmetric int8 quantization (fcvtns rounds like lrintf) */
+static void quantizeInt8NEON(int8_t *out, const float *in, int size, float invScale)
+{
+    const float32x4_t vinv   = vdupq_n_f32(invScale);
+    const int8x16_t   floor  = vdupq_n_s8(-127);
+    int               chunks = size / 16;
+
+    for (int c = 0; c < chunks; c++) {
+        const float *src = in + c * 16;
+        int32x4_t    q0  = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src), vinv));
+        int32x4_t    q1  = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + 4), vinv));
+        int32x4_t    q2  = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + 8), vinv));
+        int32x4_t    q3  = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(src + 12), vinv));
+        int16x8_t    lo  = vcombine_s16(vqmovn_s32(q0), vqmovn_s32(q1));
+        int16x8_t    hi  = vcombine_s16(vqmovn_s32(q2), vqmovn_s32(q3));
+        int8x16_t    q   = vcombine_s8(vqmovn_s16(lo), vqmovn_s16(hi));
+        vst1q_s8(out + c * 16, vmaxq_s8(q, floor));
+    }
+
+    quantizeInt8Reference(out + chunks * 16, in + chunks * 16, size - chunks * 16, invScale);
+}
+#endif
+
+/* Public API for symmetric int8 quantization of a vector */
+float tinyaiSimdQuantizeInt8(int8_t *out, const float *in, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    float maxAbs = 0.0f;
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        maxAbs = maxAbsSSE2(in, size);
+    }
+    else
+#endif
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        maxAbs = maxAbsNEON(in, size);
+    }
+    else
+#endif
+    {
+        for (int i = 0; i < size; i++) {
+            maxAbs = fmaxf(maxAbs, fabsf(in[i]));
+        }
+    }
+
+    /* Symmetric scale mapping the largest magnitude to 127 */
+    float scale    = maxAbs / 127.0f;
+    float invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        quantizeInt8SSE2(out, in, size, invScale);
+        return scale;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        quantizeInt8NEON(out, in, size, invScale);
+        return scale;
+    }
+#endif
+
+    quantizeInt8Reference(out, in, size, invScale);
+    return scale;
+}
+
+/* Columns per block of the int8-activation kernels (the int32 sums of a block stay in registers) */
+#define INT8_BLOCK_COLS 16
+
+/* Weight at element idx of a 4-bit (unsigned, high nibble first) or 8-bit (signed) matrix */
+static inline int int8KernelWeight(const void *weights, int weightBits, size_t idx)
+{
+    if (weightBits == 4) {
+        uint8_t packed = ((const uint8_t *)weights)[idx / 2];
+        return (idx & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+    }
+    return ((const int8_t *)weights)[idx];
+}
+
+/* Terms turning the int32 sums of one input vector into outputs: out = sum * rescale + offset */
+static void int8KernelRescale(const int8_t *x, int rows, float inputScale, float scale,
+                              float zeroPoint, float *rescale, float *offset)
+{
+    int32_t inputSum = 0;
+    for (int k = 0; k < rows; k++) {
+        inputSum += x[k];
+    }
+    *rescale = inputScale * scale;
+    *offset  = inputScale * (float)inputSum * zeroPoint;
+}
+
+/* Reference implementation for int8 activations times 4-bit or 8-bit weights (columns [c0, c1)) */
+static void matMulInt8Reference(float *out, const void *weights, int weightBits,
+                                const int8_t *input, const float *inputScales, int count,
+                                int rows, int cols, int c0, int c1, float scale, float zeroPoint)
+{
+    for (int b = 0; b < count; b++) {
+        const int8_t *x   = input + (size_t)b * rows;
+        float        *dst = out + (size_t)b * cols;
+        float         rescale, offset;
+        int8KernelRescale(x, rows, inputScales[b], scale, zeroPoint, &rescale, &offset);
+
+        /* Sum a block of columns exactly in int32 over all rows, skipping zero inputs */
+        for (int j0 = c0; j0 < c1; j0 += INT8_BLOCK_COLS) {
+            int     n                    = c1 - j0 < INT8_BLOCK_COLS ? c1 - j0 : INT8_BLOCK_COLS;
+            int32_t acc[INT8_BLOCK_COLS] = {0};
+            for (int k = 0; k < rows; k++) {
+                if (x[k] == 0) {
+                    continue;
+                }
+                size_t base = (size_t)k * cols + j0;
+                for (int i = 0; i < n; i++) {
+                    acc[i] += x[k] * int8KernelWeight(weights, weightBits, base + i);
+                }
+            }
+            for (int i = 0; i < n; i++) {
+                dst[j0 + i] = (float)acc[i] * rescale + offset;
+            }
+        }
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* Widen 16 weights of a 4-bit (high nibble first) or 8-bit row to two vectors of int16 */
+static inline void int8KernelWeightsSSE2(const void *weights, int weightBits, size_t idx,
+                                         __m128i w[2])
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    if (weightBits == 4) {
+        const __m128i  mask   = _mm_set1_epi8(0x0F);
+        const uint8_t *bytes  = (const uint8_t *)weights + idx / 2;
+        __m128i        packed = _mm_loadl_epi64((const __m128i *)bytes);
+        __m128i        hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+        __m128i        nib    = _mm_unpacklo_epi8(hi, _mm_and_si128(packed, mask));
+        w[0]                  = _mm_unpacklo_epi8(nib, zero);
+        w[1]                  = _mm_unpackhi_epi8(nib, zero);
+        return;
+    }
+
+    /* Sign-extend each byte by moving it into the high half of a 16-bit lane */
+    __m128i bytes = _mm_loadu_si128((const __m128i *)((const int8_t *)weights + idx));
+    w[0]          = _mm_srai_epi16(_mm_unpacklo_epi8(zero, bytes), 8);
+    w[1]          = _mm_srai_epi16(_mm_unpackhi_epi8(zero, bytes), 8);
+}
+
+/* SSE2 implementation for int8 activations times 4-bit or 8-bit weights (columns [c0, c1)) */
+static void matMulInt8SSE2(float *out, const void *weights, int weightBits, const int8_t *input,
+                           const float *inputScales, int count, int rows, int cols, int c0, int c1,
+                           float scale, float zeroPoint)
+{
+    /* 4-bit rows and the column range must start on a byte boundary for the vector loads */
+    if (weightBits == 4 && ((cols & 1) || (c0 & 1))) {
+        matMulInt8Reference(out, weights, weightBits, input, inputScales, count, rows, cols, c0,
+                            c1, scale, zeroPoint);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    int           tail = c0 + (c1 - c0) / INT8_BLOCK_COLS * INT8_BLOCK_COLS;
+
+    for (int b = 0; b < count; b++) {
+        const int8_t *x   = input + (size_t)b * rows;
+        float        *dst = out + (size_t)b * cols;
+        float         rescale, offset;
+        int8KernelRescale(x, rows, inputScales[b], scale, zeroPoint, &rescale, &offset);
+
+        for (int j0 = c0; j0 < tail; j0 += INT8_BLOCK_COLS) {
+            __m128i acc[4] = {zero, zero, zero, zero};
+
+            /* Rows in pairs: pmaddwd adds x[k] * w[k][j] + x[k + 1] * w[k + 1][j] per column */
+            for (int k = 0; k < rows; k += 2) {
+                int16_t x0 = x[k];
+                int16_t x1 = k + 1 < rows ? x[k + 1] : 0;
+                if (x0 == 0 && x1 == 0) {
+                    continue;
+                }
+
+                __m128i w0[2], w1[2] = {zero, zero};
+                int8KernelWeightsSSE2(weights, weightBits, (size_t)k * cols + j0, w0);
+                if (k + 1 < rows) {
+                    int8KernelWeightsSSE2(weights, weightBits, (size_t)(k + 1) * cols + j0, w1);
+                }
+
+                __m128i vx = _mm_set_epi16(x1, x0, x1, x0, x1, x0, x1, x0);
+                for (int h = 0; h < 2; h++) {
+                    __m128i lo     = _mm_madd_epi16(_mm_unpacklo_epi16(w0[h], w1[h]), vx);
+                    __m128i hi     = _mm_madd_epi16(_mm_unpackhi_epi16(w0[h], w1[h]), vx);
+                    acc[2 * h]     = _mm_add_epi32(acc[2 * h], lo);
+                    acc[2 * h + 1] = _mm_add_epi32(acc[2 * h + 1], hi);
+                }
+            }
+
+            __m128 vrescale = _mm_set1_ps(rescale);
+            __m128 voffset  = _mm_set1_ps(offset);
+            for (int i = 0; i < 4; i++) {
+                __m128 sums = _mm_cvtepi32_ps(acc[i]);
+                _mm_storeu_ps(dst + j0 + 4 * i, _mm_add_ps(_mm_mul_ps(sums, vrescale), voffset));
+            }
+        }
+    }
+
+    /* Remaining columns of the range */
+    if (tail < c1) {
+        matMulInt8Reference(out, weights, weightBits, input, inputScales, count, rows, cols, tail,
+                            c1, scale, zeroPoint);
+    }
+}
+#endif
+
+#if defined(HAS_AVX512VNNI_SUPPORT)
+/* Widen n <= 32 weights of a 4-bit (high nibble first) or 8-bit row to a vector of int16, zeroing
+   the lanes past n without reading past the row */
+static inline TINYAI_TARGET_AVX512VNNI __m512i int8KernelWeightsAVX512(const void *weights,
+                                                                       int weightBits, size_t idx,
+                                                                       int n)
+{
+    if (weightBits == 4) {
+        const __m128i  mask   = _mm_set1_epi8(0x0F);
+        const uint8_t *bytes  = (const uint8_t *)weights + idx / 2;
+        __mmask64      load   = (__mmask64)(((uint64_t)1 << ((n + 1) / 2)) - 1);
+        __m128i        packed = _mm512_castsi512_si128(_mm512_maskz_loadu_epi8(load, bytes));
+        __m128i        hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+        __m128i        lo     = _mm_and_si128(packed, mask);
+        __m256i        nib    = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_unpacklo_epi8(hi, lo)), _mm_unpackhi_epi8(hi, lo), 1);
+        return _mm512_cvtepu8_epi16(nib);
+    }
+
+    const int8_t *bytes = (const int8_t *)weights + idx;
+    __mmask64     load  = (__mmask64)(((uint64_t)1 << n) - 1);
+    return _mm512_cvtepi8_epi16(_mm512_castsi512_si256(_mm512_maskz_loadu_epi8(load, bytes)));
+}
+
+/* AVX-512 VNNI implementation for int8 activations times 4-bit or 8-bit weights */
+static TINYAI_TARGET_AVX512VNNI void matMulInt8VNNI(float *out, const void *weights,
+                                                    int weightBits, const int8_t *input,
+                                                    const float *inputScales, int count, int rows,
+                                                    int cols, int c0, int c1, float scale,
+                                                    float zeroPoint)
+{
+    /* 4-bit rows and the column range must start on a byte boundary for the vector loads */
+    if (weightBits == 4 && ((cols & 1) || (c0 & 1))) {
+        matMulInt8Reference(out, weights, weightBits, input, inputScales, count, rows, cols, c0,
+                            c1, scale, zeroPoint);
+        return;
+    }
+
+    /* Unpacking works within 128-bit lanes, so lane L of the low sums holds columns 8L..8L+3
+       and of the high sums 8L+4..8L+7; these indices put both back in column order */
+    const __m512i order0 = _mm512_set_epi32(23, 22, 21, 20, 7, 6, 5, 4, 19, 18, 17, 16, 3, 2, 1, 0);
+    const __m512i order1 =
+        _mm512_set_epi32(31, 30, 29, 28, 15, 14, 13, 12, 27, 26, 25, 24, 11, 10, 9, 8);
+    const __m512i zero = _mm512_setzero_si512();
+
+    for (int b = 0; b < count; b++) {
+        const int8_t *x   = input + (size_t)b * rows;
+        float        *dst = out + (size_t)b * cols;
+        float         rescale, offset;
+        int8KernelRescale(x, rows, inputScales[b], scale, zeroPoint, &rescale, &offset);
+
+        /* Blocks of 32 columns; the last one is masked */
+        for (int j0 = c0; j0 < c1; j0 += 32) {
+            int     n     = c1 - j0 < 32 ? c1 - j0 : 32;
+            __m512i accLo = zero;
+            __m512i accHi = zero;
+
+            /* Rows in pairs: vpdpwssd adds x[k] * w[k][j] + x[k + 1] * w[k + 1][j] per column */
+            for (int k = 0; k < rows; k += 2) {
+                int16_t x0 = x[k];
+                int16_t x1 = k + 1 < rows ? x[k + 1] : 0;
+                if (x0 == 0 && x1 == 0) {
+                    continue;
+                }
+
+                size_t  idx = (size_t)k * cols + j0;
+                __m512i w0  = int8KernelWeightsAVX512(weights, weightBits, idx, n);
+                __m512i w1  = k + 1 < rows
+                                  ? int8KernelWeightsAVX512(weights, weightBits, idx + cols, n)
+                                  : zero;
+
+                __m512i vx = _mm512_broadcast_i32x4(_mm_set_epi16(x1, x0, x1, x0, x1, x0, x1, x0));
+                accLo      = _mm512_dpwssd_epi32(accLo, _mm512_unpacklo_epi16(w0, w1), vx);
+                accHi      = _mm512_dpwssd_epi32(accHi, _mm512_unpackhi_epi16(w0, w1), vx);
+            }
+
+            __m512    vrescale = _mm512_set1_ps(rescale);
+            __m512    voffset  = _mm512_set1_ps(offset);
+            __m512    sums0 = _mm512_cvtepi32_ps(_mm512_permutex2var_epi32(accLo, order0, accHi));
+            __m512    sums1 = _mm512_cvtepi32_ps(_mm512_permutex2var_epi32(accLo, order1, accHi));
+            __mmask16 mask0 = (__mmask16)(n >= 16 ? 0xFFFF : (1u << n) - 1);
+            __mmask16 mask1 = (__mmask16)(n >= 32 ? 0xFFFF : n > 16 ? (1u << (n - 16)) - 1 : 0);
+            _mm512_mask_storeu_ps(dst + j0, mask0, _mm512_fmadd_ps(sums0, vrescale, voffset));
+            _mm512_mask_storeu_ps(dst + j0 + 16, mask1, _mm512_fmadd_ps(sums1, vrescale, voffset));
+        }
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+/* Widen 16 weights of a 4-bit (high nibble first) or 8-bit row to two vectors of int16 */
+static inline void int8KernelWeightsNEON(const void *weights, int weightBits, size_t idx,
+                                         int16x8_t w[2])
+{
+    if (weightBits == 4) {
+        uint8x8_t packed = vld1_u8((const uint8_t *)weights + idx / 2);
+        uint8x8_t hi     = vshr_n_u8(packed, 4);
+        uint8x8_t lo     = vand_u8(packed, vdup_n_u8(0x0F));
+        w[0]             = vreinterpretq_s16_u16(vmovl_u8(vzip1_u8(hi, lo)));
+        w[1]             = vreinterpretq_s16_u16(vmovl_u8(vzip2_u8(hi, lo)));
+        return;
+    }
+
+    int8x16_t bytes = vld1q_s8((const int8_t *)weights + idx);
+    w[0]            = vmovl_s8(vget_low_s8(bytes));
+    w[1]            = vmovl_high_s8(bytes);
+}
+
+/* NEON implementation for int8 activations times 4-bit or 8-bit weights (columns [c0, c1)) */
+static void matMulInt8NEON(float *out, const void *weights, int weightBits, const int8_t *input,
+                           const float *inputScales, int count, int rows, int cols, int c0, int c1,
+                           float scale, float zeroPoint)
+{
+    /* 4-bit rows and the column range must start on a byte boundary for the vector loads */
+    if (weightBits == 4 && ((cols & 1) || (c0 & 1))) {
+        matMulInt8Reference(out, weights, weightBits, input, inputScales, count, rows, cols, c0,
+                            c1, scale, zeroPoint);
+        return;
+    }
+
+    int tail = c0 + (c1 - c0) / INT8_BLOCK_COLS * INT8_BLOCK_COLS;
+
+    for (int b = 0; b < count; b++) {
+        const int8_t *x   = input + (size_t)b * rows;
+        float        *dst = out + (size_t)b * cols;
+        float         rescale, offset;
+        int8KernelRescale(x, rows, inputScales[b], scale, zeroPoint, &rescale, &offset);
+
+        for (int j0 = c0; j0 < tail; j0 += INT8_BLOCK_COLS) {
+            int32x4_t acc[4] = {vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0)};
+
+            /* smlal adds x[k] * w[k][j] to the int32 sum of each column */
+            for (int k = 0; k < rows; k++) {
+                if (x[k] == 0) {
+                    continue;
+                }
+
+                int16x8_t w[2];
+                int8KernelWeightsNEON(weights, weightBits, (size_t)k * cols + j0, w);
+                acc[0] = vmlal_n_s16(acc[0], vget_low_s16(w[0]), x[k]);
+                acc[1] = vmlal_high_n_s16(acc[1], w[0], x[k]);
+                acc[2] = vmlal_n_s16(acc[2], vget_low_s16(w[1]), x[k]);
+                acc[3] = vmlal_high_n_s16(acc[3], w[1], x[k]);
+            }
+
+            float32x4_t vrescale = vdupq_n_f32(rescale);
+            float32x4_t voffset  = vdupq_n_f32(offset);
+            for (int i = 0; i < 4; i++) {
+                float32x4_t sums = vcvtq_f32_s32(acc[i]);
+                vst1q_f32(dst + j0 + 4 * i, vaddq_f32(vmulq_f32(sums, vrescale), voffset));
+            }
+        }
+    }
+
+    /* Remaining columns of the range */
+    if (tail < c1) {
+        matMulInt8Reference(out, weights, weightBits, input, inputScales, count, rows, cols, tail,
+                            c1, scale, zeroPoint);
+    }
+}
+#endif
+
+/* Select the int8-activation kernel for the host */
+static void matMulInt8Columns(float *out, const void *weights, int weightBits,
+                              const int8_t *input, const float *inputScales, int count, int rows,
+                              int cols, int colBegin, int colEnd, float scale, float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd) {
+        return;
+    }
+
+#if defined(HAS_AVX512VNNI_SUPPORT)
+    if (g_hasAVX512VNNI && g_avx512Enabled) {
+        matMulInt8VNNI(out, weights, weightBits, input, inputScales, count, rows, cols, colBegin,
+                       colEnd, scale, zeroPoint);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        matMulInt8SSE2(out, weights, weightBits, input, inputScales, count, rows, cols, colBegin,
+                       colEnd, scale, zeroPoint);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        matMulInt8NEON(out, weights, weightBits, input, inputScales, count, rows, cols, colBegin,
+                       colEnd, scale, zeroPoint);
+        return;
+    }
+#endif
+
+    matMulInt8Reference(out, weights, weightBits, input, inputScales, count, rows, cols, colBegin,
+                        colEnd, scale, zeroPoint);
+}
+
+/* Public API for int8 activations times affine 4-bit weights over a column range */
+void tinyaiSimdMatMul4BitInt8Columns(float *out, const uint8_t *weights, const int8_t *input,
+                                     const float *inputScales, int count, int rows, int cols,
+                                     int colBegin, int colEnd, float scale, float zeroPoint)
+{
+    matMulInt8Columns(out, weights, 4, input, inputScales, count, rows, cols, colBegin, colEnd,
+                      scale, zeroPoint);
+}
+
+/* Public API for int8 activations times affine 8-bit weights over a column range */
+void tinyaiSimdMatMul8BitInt8Columns(float *out, const int8_t *weights, const int8_t *input,
+                                     const float *inputScales, int count, int rows, int cols,
+                                     int colBegin, int colEnd, float scale, float zeroPoint)
+{
+    matMulInt8Columns(out, weights, 8, input, inputScales, count, rows, cols, colBegin, colEnd,
+                      scale, zeroPoint);
+}
+
+/* Reference implementation for int8 activations times symmetric 4-bit rows */
+static void matMul4BitInt8Reference(float *out, const uint8_t *weights, const int8_t *input,
+                                    float inputScale, int rows, int cols,
+                                    const float *scaleFactors)
+{
+    int bytesPerRow = (cols + 1) / 2;
+
+    for (int row = 0; row < rows; row++) {
+        const uint8_t *rowData = weights + (size_t)row * bytesPerRow;
+        int32_t        sum     = 0;
+        for (int col = 0; col < cols; col++) {
+            uint8_t packed = rowData[col / 2];
+            int     nibble = (col % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+            sum += (nibble - 8) * input[col];
+        }
+        out[row] = (float)sum * (inputScale * scaleFactors[row]);
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for int8 activations times symmetric 4-bit rows */
+static void matMul4BitInt8SSE2(float *out, const uint8_t *weights, const int8_t *input,
+                               float inputScale, int rows, int cols, const float *scaleFactors)
+{
+    const __m128i mask  = _mm_set1_epi8(0x0F);
+    const __m128i eight = _mm_set1_epi16(8);
+    const __m128i zero  = _mm_setzero_si128();
+    int           bytesPerRow = (cols + 1) / 2;
+    int           tail        = cols / 16 * 16;
+
+    for (int row = 0; row < rows; row++) {
+        const uint8_t *rowData = weights + (size_t)row * bytesPerRow;
+        __m128i        acc     = zero;
+
+        /* 16 weights (8 bytes, low nibble first) and inputs per step, in pairs via pmaddwd */
+        for (int col = 0; col < tail; col += 16) {
+            __m128i packed = _mm_loadl_epi64((const __m128i *)(rowData + col / 2));
+            __m128i lo     = _mm_and_si128(packed, mask);
+            __m128i hi     = _mm_and_si128(_mm_srli_epi16(packed, 4), mask);
+            __m128i nib    = _mm_unpacklo_epi8(lo, hi);
+            __m128i w0     = _mm_sub_epi16(_mm_unpacklo_epi8(nib, zero), eight);
+            __m128i w1     = _mm_sub_epi16(_mm_unpackhi_epi8(nib, zero), eight);
+
+            __m128i bytes = _mm_loadu_si128((const __m128i *)(input + col));
+            __m128i x0    = _mm_srai_epi16(_mm_unpacklo_epi8(zero, bytes), 8);
+            __m128i x1    = _mm_srai_epi16(_mm_unpackhi_epi8(zero, bytes), 8);
+
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(w0, x0));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(w1, x1));
+        }
+
+        /* Horizontal sum, then the remaining columns */
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        int32_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        for (int col = tail; col < cols; col++) {
+            uint8_t packed = rowData[col / 2];
+            int     nibble = (col % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+            sum += (nibble - 8) * input[col];
+        }
+        out[row] = (float)sum * (inputScale * scaleFactors[row]);
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+/* Sum of one row's remaining columns past tail, as in the reference */
+static inline int32_t matMul4BitInt8Tail(const uint8_t *rowData, const int8_t *input, int tail,
+                                         int cols)
+{
+    int32_t sum = 0;
+    for (int col = tail; col < cols; col++) {
+        uint8_t packed = rowData[col / 2];
+        int     nibble = (col % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+        sum += (nibble - 8) * input[col];
+    }
+    return sum;
+}
+
+/* NEON implementation for int8 activations times symmetric 4-bit rows */
+static void matMul4BitInt8NEON(float *out, const uint8_t *weights, const int8_t *input,
+                               float inputScale, int rows, int cols, const float *scaleFactors)
+{
+    int bytesPerRow = (cols + 1) / 2;
+    int tail        = cols / 32 * 32;
+
+    for (int row = 0; row < rows; row++) {
+        const uint8_t *rowData = weights + (size_t)row * bytesPerRow;
+        int32x4_t      acc     = vdupq_n_s32(0);
+
+        /* 32 weights and inputs per step; |w * x| <= 1024 fits the int16 products */
+        for (int col = 0; col < tail; col += 32) {
+            int8x16_t w0, w1;
+            unpackNibblesInt8NEON(rowData + col / 2, &w0, &w1);
+            int8x16_t x0 = vld1q_s8(input + col);
+            int8x16_t x1 = vld1q_s8(input + col + 16);
+
+            acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(w0), vget_low_s8(x0)));
+            acc = vpadalq_s16(acc, vmull_high_s8(w0, x0));
+            acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(w1), vget_low_s8(x1)));
+            acc = vpadalq_s16(acc, vmull_high_s8(w1, x1));
+        }
+
+        int32_t sum = vaddvq_s32(acc) + matMul4BitInt8Tail(rowData, input, tail, cols);
+        out[row]    = (float)sum * (inputScale * scaleFactors[row]);
+    }
+}
+#endif
+
+#if defined(HAS_NEON_DOTPROD_SUPPORT)
+/* NEON SDOT implementation for int8 activations times symmetric 4-bit rows */
+static TINYAI_TARGET_DOTPROD void matMul4BitInt8DotProd(float *out, const uint8_t *weights,
+                                                        const int8_t *input, float inputScale,
+                                                        int rows, int cols,
+                                                        const float *scaleFactors)
+{
+    int bytesPerRow = (cols + 1) / 2;
+    int tail        = cols / 32 * 32;
+
+    for (int row = 0; row < rows; row++) {
+        const uint8_t *rowData = weights + (size_t)row * bytesPerRow;
+        int32x4_t      acc[2]  = {vdupq_n_s32(0), vdupq_n_s32(0)};
+
+        /* sdot adds four byte products into each int32 lane */
+        for (int col = 0; col < tail; col += 32) {
+            int8x16_t w0, w1;
+            unpackNibblesInt8NEON(rowData + col / 2, &w0, &w1);
+            acc[0] = vdotq_s32(acc[0], w0, vld1q_s8(input + col));
+            acc[1] = vdotq_s32(acc[1], w1, vld1q_s8(input + col + 16));
+        }
+
+        int32_t sum = vaddvq_s32(vaddq_s32(acc[0], acc[1])) +
+                      matMul4BitInt8Tail(rowData, input, tail, cols);
+        out[row] = (float)sum * (inputScale * scaleFactors[row]);
+    }
+}
+#endif
+
+/* Public API for int8 activations times symmetric 4-bit rows */
+void tinyaiSimdMatMul4BitInt8(float *out, const uint8_t *weights, const int8_t *input,
+                              float inputScale, int rows, int cols, const float *scaleFactors)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        matMul4BitInt8SSE2(out, weights, input, inputScale, rows, cols, scaleFactors);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_DOTPROD_SUPPORT)
+    if (g_hasNEONDotProd) {
+        matMul4BitInt8DotProd(out, weights, input, inputScale, rows, cols, scaleFactors);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        matMul4BitInt8NEON(out, weights, input, inputScale, rows, cols, scaleFactors);
+        return;
+    }
+#endif
+
+    matMul4BitInt8Reference(out, weights, input, inputScale, rows, cols, scaleFactors);
+}
+
+/* Reference implementation for affine 4-bit dequantization */
+static void dequantize4BitAffineReference(float *out, const uint8_t *in, int size, float scale,
+                                          float zeroPoint)
+{
+    for (int i = 0; i < size; i++) {
+        uint8_t packed = in[i / 2];
+        int     q      = (i & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+        out[i]         = q * scale + zeroPoint;
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for affine 4-bit dequantization */
+static void dequantize4BitAffineSSE2(float *out, const uint8_t *in, int size, float scale,
+                                     float zeroPoint)
+{
+    __m128 vscale  = _mm_set1_ps(scale);
+    __m128 voffset = _mm_set1_ps(zeroPoint);
+    int    chunks  = size / 16;
+
+    /* Process 16 values (8 bytes) at a time */
+    for (int c = 0; c < chunks; c++) {
+        __m128 q[4];
+        unpackNibblesSSE2(in + c * 8, q);
+
+        for (int v = 0; v < 4; v++) {
+            _mm_storeu_ps(out + c * 16 + v * 4, _mm_add_ps(_mm_mul_ps(q[v], vscale), voffset));
+        }
+    }
+
+    /* Handle remaining values */
+    dequantize4BitAffineReference(out + chunks * 16, in + chunks * 8, size - chunks * 16, scale,
+                                  zeroPoint);
+}
+#endif
+
+/* Public API for affine 4-bit dequantization */
+void tinyaiSimdDequantize4BitAffine(float *out, const uint8_t *in, int size, float scale,
+                                    float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        dequantize4BitAffineSSE2(out, in, size, scale, zeroPoint);
+        return;
+    }
+#endif
+
+    dequantize4BitAffineReference(out, in, size, scale, zeroPoint);
+}
+
+/* Reference implementation for codebook 4-bit dequantization */
+static void dequantize4BitCodebookReference(float *out, const uint8_t *in, int size,
+                                            const float *levels, float scale, float zeroPoint)
+{
+    for (int i = 0; i < size; i++) {
+        uint8_t packed = in[i / 2];
+        int     q      = (i & 1) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+        out[i]         = levels[q] * scale + zeroPoint;
+    }
+}
+
+#if defined(HAS_SSSE3_SUPPORT)
+/* SSSE3 implementation for codebook 4-bit dequantization */
+static TINYAI_TARGET_SSSE3 void dequantize4BitCodebookSSSE3(float *out, const uint8_t *in,
+                                                            int size, const float *levels,
+                                                            float scale, float zeroPoint)
+{
+    __m128  vscale  = _mm_set1_ps(scale);
+    __m128  voffset = _mm_set1_ps(zeroPoint);
+    int     chunks  = size / 16;
+    __m128i planes[4];
+    codebookBytePlanes(levels, planes);
+
+    /* Process 16 values (8 bytes) at a time */
+    for (int c = 0; c < chunks; c++) {
+        __m128 q[4];
+        lookupNibblesSSSE3(in + c * 8, planes, q);
+
+        for (int v = 0; v < 4; v++) {
+            _mm_storeu_ps(out + c * 16 + v * 4, _mm_add_ps(_mm_mul_ps(q[v], vscale), voffset));
+        }
+    }
+
+    /* Handle remaining values */
+    dequantize4BitCodebookReference(out + chunks * 16, in + chunks * 8, size - chunks * 16,
+                                    levels, scale, zeroPoint);
+}
+#endif
+
+/* Public API for codebook 4-bit dequantization */
+void tinyaiSimdDequantize4BitCodebook(float *out, const uint8_t *in, int size,
+                                      const float *levels, float scale, float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_SSSE3_SUPPORT)
+    if (g_hasSSSE3) {
+        dequantize4BitCodebookSSSE3(out, in, size, levels, scale, zeroPoint);
+        return;
+    }
+#endif
+
+    dequantize4BitCodebookReference(out, in, size, levels, scale, zeroPoint);
+}
+
+/* Round a float to the nearest IEEE 754 half precision value (ties to even) */
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign    = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t absBits = bits & 0x7FFFFFFF;
+
+    /* Infinity and NaN keep their class; values that round past 65504 overflow to infinity */
+    if (absBits >= 0x7F800000) {
+        return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x0200 : 0);
+    }
+    if (absBits >= 0x477FF000) {
+        return sign | 0x7C00;
+    }
+
+    /* Below 2^-14 the result is a multiple of 2^-24 (subnormal or zero) */
+    if (absBits < 0x38800000) {
+        int shift = 126 - (int)(absBits >> 23);
+        if (shift > 24) {
+            return sign;
+        }
+        uint32_t mantissa = (absBits & 0x007FFFFF) | 0x00800000;
+        uint32_t half     = mantissa >> shift;
+        uint32_t rest     = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1))) {
+            half++;
+        }
+        return sign | (uint16_t)half;
+    }
+
+    /* Rebias the exponent and round away the low 13 mantissa bits; a carry bumps the exponent */
+    uint32_t half = (absBits - 0x38000000) >> 13;
+    uint32_t rest = absBits & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return sign | (uint16_t)half;
+}
+
+/* Widen an IEEE 754 half precision value to a float (exact) */
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign     = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x03FF;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        /* Zero or subnormal: mantissa * 2^-24 */
+        float value = (float)mantissa * 5.9604644775390625e-8f;
+        return sign ? -value : value;
+    }
+    if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    }
+    else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#if defined(HAS_F16C_SUPPORT)
+/* F16C implementation for float to half precision conversion */
+static TINYAI_TARGET_F16C void convertFP32ToFP16F16C(uint16_t *out, const float *in, int size)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)(out + i), half);
+    }
+    for (; i < size; i++) {
+        out[i] = floatToHalf(in[i]);
+    }
+}
+
+/* F16C implementation for half precision to float conversion */
+static TINYAI_TARGET_F16C void convertFP16ToFP32F16C(float *out, const uint16_t *in, int size)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(in + i))));
+    }
+    for (; i < size; i++) {
+        out[i] = halfToFloat(in[i]);
+    }
+}
+#endif
+
+/* Public API for float to half precision conversion */
+void tinyaiSimdConvertFP32ToFP16(uint16_t *out, const float *in, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_F16C_SUPPORT)
+    if (g_hasF16C) {
+        convertFP32ToFP16F16C(out, in, size);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < size; i++) {
+        out[i] = floatToHalf(in[i]);
+    }
+}
+
+/* Public API for half precision to float conversion */
+void tinyaiSimdConvertFP16ToFP32(float *out, const uint16_t *in, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_F16C_SUPPORT)
+    if (g_hasF16C) {
+        convertFP16ToFP32F16C(out, in, size);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < size; i++) {
+        out[i] = halfToFloat(in[i]);
+    }
+}
+
+/* Round a float to bfloat16 (nearest even), keeping NaNs quiet */
+static uint16_t floatToBF16(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+        return (uint16_t)((bits >> 16) | 0x0040);
+    }
+    return (uint16_t)((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+}
+
+/* Widen a bfloat16 value to a float (exact) */
+static float bf16ToFloat(uint16_t bf16)
+{
+    uint32_t bits = (uint32_t)bf16 << 16;
+    float    value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#if defined(HAS_AVX512BF16_SUPPORT)
+/* AVX-512 BF16 implementation for float to bfloat16 conversion */
+static TINYAI_TARGET_AVX512BF16 void convertFP32ToBF16AVX512(uint16_t *out, const float *in,
+                                                             int size)
+{
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256bh packed = _mm512_cvtneps_pbh(_mm512_loadu_ps(in + i));
+        _mm256_storeu_si256((__m256i *)(out + i), (__m256i)packed);
+    }
+    for (; i < size; i++) {
+        out[i] = floatToBF16(in[i]);
+    }
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+/* AVX2 implementation for float to bfloat16 conversion */
+static TINYAI_TARGET_AVX2 void convertFP32ToBF16AVX2(uint16_t *out, const float *in, int size)
+{
+    const __m256i one   = _mm256_set1_epi32(1);
+    const __m256i bias  = _mm256_set1_epi32(0x7FFF);
+    const __m256i quiet = _mm256_set1_epi32(0x0040);
+
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256  x    = _mm256_loadu_ps(in + i);
+        __m256i bits = _mm256_castps_si256(x);
+
+        /* Add half an ulp of the result, plus one for an odd result, and truncate */
+        __m256i odd     = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+        __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(bias, odd));
+        __m256i nan     = _mm256_or_si256(_mm256_srli_epi32(bits, 16), quiet);
+        __m256i isNaN   = _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+        rounded         = _mm256_blendv_epi8(_mm256_srli_epi32(rounded, 16), nan, isNaN);
+
+        __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(rounded),
+                                          _mm256_extracti128_si256(rounded, 1));
+        _mm_storeu_si128((__m128i *)(out + i), packed);
+    }
+    for (; i < size; i++) {
+        out[i] = floatToBF16(in[i]);
+    }
+}
+
+/* AVX2 implementation for bfloat16 to float conversion */
+static TINYAI_TARGET_AVX2 void convertBF16ToFP32AVX2(float *out, const uint16_t *in, int size)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16)));
+    }
+    for (; i < size; i++) {
+        out[i] = bf16ToFloat(in[i]);
+    }
+}
+#endif
+
+/* Public API for float to bfloat16 conversion */
+void tinyaiSimdConvertFP32ToBF16(uint16_t *out, const float *in, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512BF16_SUPPORT)
+    if (g_hasAVX512BF16 && g_avx512Enabled) {
+        convertFP32ToBF16AVX512(out, in, size);
+        return;
+    }
+#endif
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        convertFP32ToBF16AVX2(out, in, size);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < size; i++) {
+        out[i] = floatToBF16(in[i]);
+    }
+}
+
+/* Public API for bfloat16 to float conversion */
+void tinyaiSimdConvertBF16ToFP32(float *out, const uint16_t *in, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        convertBF16ToFP32AVX2(out, in, size);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < size; i++) {
+        out[i] = bf16ToFloat(in[i]);
+    }
+}
+
+/* Reference implementation for half precision weight matrix multiplication (columns [c0, c1)) */
+static void matMulFP16Reference(float *out, const uint16_t *weights, const float *input,
+                                int count, int rows, int cols, int c0, int c1)
+{
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    /* Each weight is widened once and applied to every input */
+    for (int k = 0; k < rows; k++) {
+        const uint16_t *row = weights + (size_t)k * cols;
+        for (int j = c0; j < c1; j++) {
+            float w = halfToFloat(row[j]);
+            for (int b = 0; b < count; b++) {
+                out[(size_t)b * cols + j] += input[(size_t)b * rows + k] * w;
+            }
+        }
+    }
+}
+
+#if defined(HAS_F16C_SUPPORT)
+/* F16C implementation for half precision weight matrix multiplication (columns [c0, c1)) */
+static TINYAI_TARGET_F16C void matMulFP16F16C(float *out, const uint16_t *weights,
+                                              const float *input, int count, int rows, int cols,
+                                              int c0, int c1)
+{
+    int chunks = (c1 - c0) / 8;
+    int tail   = c0 + chunks * 8;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const uint16_t *row = weights + (size_t)k * cols;
+
+        /* Widen 8 weights at a time, once for all inputs */
+        for (int c = 0; c < chunks; c++) {
+            int    j0 = c0 + c * 8;
+            __m256 w  = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(row + j0)));
+
+            for (int b = 0; b < count; b++) {
+                float x = input[(size_t)b * rows + k];
+                if (x == 0.0f) {
+                    continue;
+                }
+
+                float *dst = out + (size_t)b * cols + j0;
+                _mm256_storeu_ps(dst, _mm256_add_ps(_mm256_loadu_ps(dst),
+                                                    _mm256_mul_ps(_mm256_set1_ps(x), w)));
+            }
+        }
+
+        /* Handle remaining columns */
+        for (int j = tail; j < c1; j++) {
+            float w = halfToFloat(row[j]);
+            for (int b = 0; b < count; b++) {
+                out[(size_t)b * cols + j] += input[(size_t)b * rows + k] * w;
+            }
+        }
+    }
+}
+#endif
+
+/* Public API for half precision weight matrix multiplication over a column range */
+void tinyaiSimdMatMulFP16Columns(float *out, const uint16_t *weights, const float *input,
+                                 int count, int rows, int cols, int colBegin, int colEnd)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd) {
+        return;
+    }
+
+#if defined(HAS_F16C_SUPPORT)
+    if (g_hasF16C) {
+        matMulFP16F16C(out, weights, input, count, rows, cols, colBegin, colEnd);
+        return;
+    }
+#endif
+
+    matMulFP16Reference(out, weights, input, count, rows, cols, colBegin, colEnd);
+}
+
+/* Signed 2-bit weight at element idx (four per byte, first value in the low bits) */
+static inline int weight2Bit(const uint8_t *weights, size_t idx)
+{
+    return (int8_t)(weights[idx / 4] << (6 - 2 * (idx & 3))) >> 6;
+}
+
+/* Apply scale and zero point to the raw sums of a column range */
+static void applyAffineColumns(float *out, const float *input, int count, int rows, int cols,
+                               int c0, int c1, float scale, float zeroPoint)
+{
+    for (int b = 0; b < count; b++) {
+        const float *x        = input + (size_t)b * rows;
+        float       *dst      = out + (size_t)b * cols;
+        float        inputSum = 0.0f;
+        for (int k = 0; k < rows; k++) {
+            inputSum += x[k];
+        }
+        for (int j = c0; j < c1; j++) {
+            dst[j] = dst[j] * scale + inputSum * zeroPoint;
+        }
+    }
+}
+
+/* Reference implementation for affine 2-bit matrix multiplication (columns [c0, c1)) */
+static void matMul2BitReference(float *out, const uint8_t *weights, const float *input,
+                                int count, int rows, int cols, int c0, int c1, float scale,
+                                float zeroPoint)
+{
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    /* Accumulate input[b][k] * q[k][j] row by row, skipping zero inputs */
+    for (int k = 0; k < rows; k++) {
+        size_t base = (size_t)k * cols;
+        for (int b = 0; b < count; b++) {
+            float x = input[(size_t)b * rows + k];
+            if (x == 0.0f) {
+                continue;
+            }
+
+            float *dst = out + (size_t)b * cols;
+            for (int j = c0; j < c1; j++) {
+                dst[j] += x * weight2Bit(weights, base + j);
+            }
+        }
+    }
+
+    applyAffineColumns(out, input, count, rows, cols, c0, c1, scale, zeroPoint);
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* Unpack 4 bytes (16 signed 2-bit values, low bits first) into four vectors of floats */
+static inline void unpack2BitSSE2(const uint8_t *src, __m128 q[4])
+{
+    /* Multiplying moves each value to the top of its 16-bit lane for an arithmetic shift */
+    const __m128i shifts = _mm_set_epi16(1 << 8, 1 << 10, 1 << 12, 1 << 14, 1 << 8, 1 << 10,
+                                         1 << 12, 1 << 14);
+    const __m128i zero   = _mm_setzero_si128();
+
+    int32_t word;
+    memcpy(&word, src, sizeof(word));
+    __m128i bytes = _mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero);
+    __m128i pairs = _mm_unpacklo_epi16(bytes, bytes);
+    __m128i v01   = _mm_unpacklo_epi32(pairs, pairs); /* Bytes 0 and 1, four lanes each */
+    __m128i v23   = _mm_unpackhi_epi32(pairs, pairs); /* Bytes 2 and 3 */
+    v01           = _mm_srai_epi16(_mm_mullo_epi16(v01, shifts), 14);
+    v23           = _mm_srai_epi16(_mm_mullo_epi16(v23, shifts), 14);
+
+    /* Sign-extend to 32-bit integers and convert to floats */
+    q[0] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, v01), 16));
+    q[1] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, v01), 16));
+    q[2] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, v23), 16));
+    q[3] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, v23), 16));
+}
+
+/* SSE2 implementation for affine 2-bit matrix multiplication (columns [c0, c1)) */
+static void matMul2BitSSE2(float *out, const uint8_t *weights, const float *input, int count,
+                           int rows, int cols, int c0, int c1, float scale, float zeroPoint)
+{
+    /* Rows and the column range must start on a byte boundary for the vector loads */
+    if ((cols & 3) || (c0 & 3)) {
+        matMul2BitReference(out, weights, input, count, rows, cols, c0, c1, scale, zeroPoint);
+        return;
+    }
+
+    int chunks = (c1 - c0) / 16;
+    int tail   = c0 + chunks * 16;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const uint8_t *row = weights + (size_t)k * (cols / 4);
+
+        /* Process 16 weights (4 bytes) at a time, unpacked once for all inputs */
+        for (int c = 0; c < chunks; c++) {
+            int    j0 = c0 + c * 16;
+            __m128 q[4];
+            unpack2BitSSE2(row + j0 / 4, q);
+
+            for (int b = 0; b < count; b++) {
+                float x = input[(size_t)b * rows + k];
+                if (x == 0.0f) {
+                    continue;
+                }
+
+                float *dst = out + (size_t)b * cols + j0;
+                __m128 vx  = _mm_set1_ps(x);
+                _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(vx, q[0])));
+                _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(vx, q[1])));
+                _mm_storeu_ps(dst + 8, _mm_add_ps(_mm_loadu_ps(dst + 8), _mm_mul_ps(vx, q[2])));
+                _mm_storeu_ps(dst + 12,
+                              _mm_add_ps(_mm_loadu_ps(dst + 12), _mm_mul_ps(vx, q[3])));
+            }
+        }
+
+        /* Handle remaining columns */
+        for (int j = tail; j < c1; j++) {
+            int q = weight2Bit(row, (size_t)j);
+            for (int b = 0; b < count; b++) {
+                out[(size_t)b * cols + j] += input[(size_t)b * rows + k] * q;
+            }
+        }
+    }
+
+    applyAffineColumns(out, input, count, rows, cols, c0, c1, scale, zeroPoint);
+}
+#endif
+
+/* Public API for affine 2-bit matrix multiplication over a column range */
+void tinyaiSimdMatMul2BitColumns(float *out, const uint8_t *weights, const float *input,
+                                 int count, int rows, int cols, int colBegin, int colEnd,
+                                 float scale, float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd) {
+        return;
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        matMul2BitSSE2(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                       zeroPoint);
+        return;
+    }
+#endif
+
+    matMul2BitReference(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                        zeroPoint);
+}
+
+/* Reference implementation for affine 8-bit matrix multiplication (columns [c0, c1)) */
+static void matMul8BitAffineReference(float *out, const int8_t *weights, const float *input,
+                                      int count, int rows, int cols, int c0, int c1, float scale,
+                                      float zeroPoint)
+{
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    /* Accumulate input[b][k] * q[k][j] row by row, skipping zero inputs */
+    for (int k = 0; k < rows; k++) {
+        const int8_t *row = weights + (size_t)k * cols;
+        for (int b = 0; b < count; b++) {
+            float x = input[(size_t)b * rows + k];
+            if (x == 0.0f) {
+                continue;
+            }
+
+            float *dst = out + (size_t)b * cols;
+            for (int j = c0; j < c1; j++) {
+                dst[j] += x * row[j];
+            }
+        }
+    }
+
+    applyAffineColumns(out, input, count, rows, cols, c0, c1, scale, zeroPoint);
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* Widen 16 signed bytes into four vectors of floats */
+static inline void unpackInt8SSE2(const int8_t *src, __m128 q[4])
+{
+    const __m128i zero  = _mm_setzero_si128();
+    __m128i       bytes = _mm_loadu_si128((const __m128i *)src);
+
+    /* Bytes go to the top of 16-bit lanes, then arithmetic shifts sign-extend them */
+    __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(zero, bytes), 8);
+    __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(zero, bytes), 8);
+    q[0]       = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, lo), 16));
+    q[1]       = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, lo), 16));
+    q[2]       = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(zero, hi), 16));
+    q[3]       = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(zero, hi), 16));
+}
+
+/* SSE2 implementation for affine 8-bit matrix multiplication (columns [c0, c1)) */
+static void matMul8BitAffineSSE2(float *out, const int8_t *weights, const float *input,
+                                 int count, int rows, int cols, int c0, int c1, float scale,
+                                 float zeroPoint)
+{
+    int chunks = (c1 - c0) / 16;
+    int tail   = c0 + chunks * 16;
+
+    for (int b = 0; b < count; b++) {
+        memset(out + (size_t)b * cols + c0, 0, (size_t)(c1 - c0) * sizeof(float));
+    }
+
+    for (int k = 0; k < rows; k++) {
+        const int8_t *row = weights + (size_t)k * cols;
+
+        /* Process 16 weights at a time, widened once for all inputs */
+        for (int c = 0; c < chunks; c++) {
+            int    j0 = c0 + c * 16;
+            __m128 q[4];
+            unpackInt8SSE2(row + j0, q);
+
+            for (int b = 0; b < count; b++) {
+                float x = input[(size_t)b * rows + k];
+                if (x == 0.0f) {
+                    continue;
+                }
+
+                float *dst = out + (size_t)b * cols + j0;
+                __m128 vx  = _mm_set1_ps(x);
+                _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_mul_ps(vx, q[0])));
+                _mm_storeu_ps(dst + 4, _mm_add_ps(_mm_loadu_ps(dst + 4), _mm_mul_ps(vx, q[1])));
+                _mm_storeu_ps(dst + 8, _mm_add_ps(_mm_loadu_ps(dst + 8), _mm_mul_ps(vx, q[2])));
+                _mm_storeu_ps(dst + 12,
+                              _mm_add_ps(_mm_loadu_ps(dst + 12), _mm_mul_ps(vx, q[3])));
+            }
+        }
+
+        /* Handle remaining columns */
+        for (int j = tail; j < c1; j++) {
+            for (int b = 0; b < count; b++) {
+                out[(size_t)b * cols + j] += input[(size_t)b * rows + k] * row[j];
+            }
+        }
+    }
+
+    applyAffineColumns(out, input, count, rows, cols, c0, c1, scale, zeroPoint);
+}
+#endif
+
+/* Public API for affine 8-bit matrix multiplication over a column range */
+void tinyaiSimdMatMul8BitAffineColumns(float *out, const int8_t *weights, const float *input,
+                                       int count, int rows, int cols, int colBegin, int colEnd,
+                                       float scale, float zeroPoint)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    if (colBegin < 0 || colEnd > cols || colBegin >= colEnd) {
+        return;
+    }
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        matMul8BitAffineSSE2(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                             zeroPoint);
+        return;
+    }
+#endif
+
+    matMul8BitAffineReference(out, weights, input, count, rows, cols, colBegin, colEnd, scale,
+                              zeroPoint);
+}
+
+/* Reference implementation for vector addition */
+static void vecAddReference(float *out, const float *a, const float *b, int size)
+{
+    for (int i = 0; i < size; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for vector addition */
+static void vecAddSSE2(float *out, const float *a, const float *b, int size)
+{
+    int chunks = size / 4;
+
+    /* Process 4 elements at a time */
+    for (int i = 0; i < chunks; i++) {
+        __m128 va  = _mm_loadu_ps(a + i * 4);
+        __m128 vb  = _mm_loadu_ps(b + i * 4);
+        __m128 sum = _mm_add_ps(va, vb);
+        _mm_storeu_ps(out + i * 4, sum);
+    }
+
+    /* Handle remaining elements */
+    for (int i = chunks * 4; i < size; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+#endif
+
+#if defined(HAS_AVX_SUPPORT)
+/* AVX implementation for vector addition */
+static TINYAI_TARGET_AVX void vecAddAVX(float *out, const float *a, const float *b, int size)
+{
+    int chunks = size / 8;
+
+    /* Process 8 elements at a time */
+    for (int i = 0; i < chunks; i++) {
+        __m256 va  = _mm256_loadu_ps(a + i * 8);
+        __m256 vb  = _mm256_loadu_ps(b + i * 8);
+        __m256 sum = _mm256_add_ps(va, vb);
+        _mm256_storeu_ps(out + i * 8, sum);
+    }
+
+    /* Handle remaining elements */
+    for (int i = chunks * 8; i < size; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+#endif
+
+/* Public API for vector addition */
+void tinyaiSimdVecAdd(float *out, const float *a, const float *b, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX_SUPPORT)
+    if (g_hasAVX) {
+        vecAddAVX(out, a, b, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        vecAddSSE2(out, a, b, size);
+        return;
+    }
+#endif
+
+    vecAddReference(out, a, b, size);
+}
+
+/* Reference implementation for scaled vector accumulation */
+static void vecScaleAddReference(float *out, const float *x, float alpha, int size)
+{
+    for (int i = 0; i < size; i++) {
+        out[i] += alpha * x[i];
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for scaled vector accumulation */
+static void vecScaleAddSSE2(float *out, const float *x, float alpha, int size)
+{
+    __m128 va = _mm_set1_ps(alpha);
+    int    i  = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(va, vx)));
+    }
+
+    for (; i < size; i++) {
+        out[i] += alpha * x[i];
+    }
+}
+#endif
+
+#if defined(HAS_AVX_SUPPORT)
+/* AVX implementation for scaled vector accumulation */
+static TINYAI_TARGET_AVX void vecScaleAddAVX(float *out, const float *x, float alpha, int size)
+{
+    __m256 va = _mm256_set1_ps(alpha);
+    int    i  = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(va, vx)));
+    }
+
+    for (; i < size; i++) {
+        out[i] += alpha * x[i];
+    }
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+/* AVX-512 implementation for scaled vector accumulation, the tail through masked loads */
+static TINYAI_TARGET_AVX512 void vecScaleAddAVX512(float *out, const float *x, float alpha,
+                                                   int size)
+{
+    __m512 va = _mm512_set1_ps(alpha);
+    int    i  = 0;
+    for (; i + 16 <= size; i += 16) {
+        _mm512_storeu_ps(out + i,
+                         _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(out + i)));
+    }
+
+    if (i < size) {
+        __mmask16 tail = (__mmask16)((1u << (size - i)) - 1);
+        __m512    vo   = _mm512_maskz_loadu_ps(tail, out + i);
+        __m512    vx   = _mm512_maskz_loadu_ps(tail, x + i);
+        _mm512_mask_storeu_ps(out + i, tail, _mm512_fmadd_ps(va, vx, vo));
+    }
+}
+#endif
+
+/* Public API for scaled vector accumulation */
+void tinyaiSimdVecScaleAdd(float *out, const float *x, float alpha, int size)
+{
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        vecScaleAddAVX512(out, x, alpha, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_AVX_SUPPORT)
+    if (g_hasAVX) {
+        vecScaleAddAVX(out, x, alpha, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        vecScaleAddSSE2(out, x, alpha, size);
+        return;
+    }
+#endif
+
+    vecScaleAddReference(out, x, alpha, size);
+}
+
+/* Reference implementations for activation functions */
+static float reluReference(float x) { return x > 0.0f ? x : 0.0f; }
+
+static float geluReference(float x)
+{
+    /* Approximate GELU: 0.5 * x * (1 + tanh(sqrt(2/π) * (x + 0.044715 * x^3))) */
+    const float sqrt2_over_pi = 0.7978845608f;
+    float       x3            = x * x * x;
+    float       inner         = sqrt2_over_pi * (x + 0.044715f * x3);
+    return 0.5f * x * (1.0f + tanhf(inner));
+}
+
+static float sigmoidReference(float x) { return 1.0f / (1.0f + expf(-x)); }
+
+static void activateReference(float *inout, int size, int activationType)
+{
+    for (int i = 0; i < size; i++) {
+        float x = inout[i];
+        switch (activationType) {
+        case TINYAI_SIMD_ACTIVATION_RELU:
+            inout[i] = reluReference(x);
+            break;
+        case TINYAI_SIMD_ACTIVATION_GELU:
+            inout[i] = geluReference(x);
+            break;
+        case TINYAI_SIMD_ACTIVATION_SIGMOID:
+            inout[i] = sigmoidReference(x);
+            break;
+        case TINYAI_SIMD_ACTIVATION_TANH:
+            inout[i] = tanhf(x);
+            break;
+        case TINYAI_SIMD_ACTIVATION_SILU:
+            inout[i] = x * sigmoidReference(x);
+            break;
+        case TINYAI_SIMD_ACTIVATION_EXP:
+            inout[i] = expf(x);
+            break;
+        default:
+            /* No change for unknown activation type */
+            break;
+        }
+    }
+}
+
+/* The vector activations share one formulation: exp(x) = 2^n * 2^f with n = round(x * log2(e))
+   and f in [-0.5, 0.5], where 2^f is a degree-6 Taylor polynomial (relative error ~2e-7);
+   sigmoid(x) = 1 / (1 + exp(-x)) evaluated through exp(-|x|) so it never overflows; tanh(x) =
+   2 * sigmoid(2x) - 1 (an odd polynomial near 0, where that cancels); GELU(x) =
+   x * sigmoid(2 * sqrt(2/π) * (x + 0.044715 * x^3)), the tanh form rewritten; and SiLU(x) =
+   x * sigmoid(x). Every result is within a few ulp-scale units (~1e-6 relative, or absolute
+   near zero) of the libm reference */
+#define ACT_EXP_MIN  -104.0f /* exp underflows to zero below this */
+#define ACT_EXP_MAX  89.0f   /* ...and overflows to infinity above this */
+#define ACT_LOG2E    1.44269504088896341f
+#define ACT_GELU_K   1.5957691216f /* 2 * sqrt(2/π) */
+#define ACT_TANH_LIN 0.125f        /* Below this |x| tanh uses its Taylor series */
+
+#if defined(HAS_SSE2_SUPPORT)
+/* 2^f for f in [-0.5, 0.5] */
+static inline __m128 exp2FractionSSE2(__m128 f)
+{
+    __m128 poly = _mm_set1_ps(1.5403530e-4f);
+    poly        = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(1.3333558e-3f));
+    poly        = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(9.6181291e-3f));
+    poly        = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(5.5504109e-2f));
+    poly        = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(2.4022651e-1f));
+    poly        = _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(6.9314718e-1f));
+    return _mm_add_ps(_mm_mul_ps(poly, f), _mm_set1_ps(1.0f));
+}
+
+/* exp(x) using SSE2. 2^n is applied in two halves, each a normal float, so results overflow to
+   infinity and underflow through the subnormals like expf */
+static inline __m128 expSSE2(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(ACT_EXP_MIN)), _mm_set1_ps(ACT_EXP_MAX));
+
+    __m128  tx = _mm_mul_ps(x, _mm_set1_ps(ACT_LOG2E));
+    __m128i n  = _mm_cvtps_epi32(tx);
+    __m128  f  = _mm_sub_ps(tx, _mm_cvtepi32_ps(n));
+
+    __m128i half  = _mm_srai_epi32(n, 1);
+    __m128i bias  = _mm_set1_epi32(127);
+    __m128  pow2a = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(half, bias), 23));
+    __m128  pow2b = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(n, half), bias), 23));
+    return _mm_mul_ps(_mm_mul_ps(exp2FractionSSE2(f), pow2a), pow2b);
+}
+
+/* sigmoid(x) using SSE2: 1 / (1 + e) for x >= 0 and e / (1 + e) below, with e = exp(-|x|) */
+static inline __m128 sigmoidSSE2(__m128 x)
+{
+    __m128 e   = expSSE2(_mm_or_ps(x, _mm_set1_ps(-0.0f)));
+    __m128 r   = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(1.0f), e));
+    __m128 neg = _mm_cmplt_ps(x, _mm_setzero_ps());
+    return _mm_or_ps(_mm_andnot_ps(neg, r), _mm_and_ps(neg, _mm_mul_ps(e, r)));
+}
+
+/* tanh(x) using SSE2 */
+static inline __m128 tanhSSE2(__m128 x)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 one  = _mm_set1_ps(1.0f);
+    __m128       ax   = _mm_andnot_ps(sign, x);
+
+    /* (1 - e) / (1 + e) with e = exp(-2|x|), and the sign of x put back */
+    __m128 e = expSSE2(_mm_mul_ps(ax, _mm_set1_ps(-2.0f)));
+    __m128 t = _mm_or_ps(_mm_div_ps(_mm_sub_ps(one, e), _mm_add_ps(one, e)), _mm_and_ps(x, sign));
+
+    /* x - x^3/3 + 2x^5/15 - 17x^7/315 + 62x^9/2835 near zero */
+    __m128 x2   = _mm_mul_ps(x, x);
+    __m128 poly = _mm_set1_ps(62.0f / 2835.0f);
+    poly        = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-17.0f / 315.0f));
+    poly        = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(2.0f / 15.0f));
+    poly        = _mm_add_ps(_mm_mul_ps(poly, x2), _mm_set1_ps(-1.0f / 3.0f));
+    poly        = _mm_mul_ps(_mm_mul_ps(poly, x2), x);
+    __m128 lin  = _mm_cmplt_ps(ax, _mm_set1_ps(ACT_TANH_LIN));
+    return _mm_or_ps(_mm_andnot_ps(lin, t), _mm_and_ps(lin, _mm_add_ps(x, poly)));
+}
+
+/* One vector of an activation using SSE2 */
+static inline __m128 activateVectorSSE2(__m128 x, int activationType)
+{
+    switch (activationType) {
+    case TINYAI_SIMD_ACTIVATION_RELU:
+        return _mm_max_ps(x, _mm_setzero_ps());
+    case TINYAI_SIMD_ACTIVATION_GELU: {
+        __m128 x3 = _mm_mul_ps(_mm_mul_ps(x, x), x);
+        __m128 u  = _mm_add_ps(x, _mm_mul_ps(x3, _mm_set1_ps(0.044715f)));
+        return _mm_mul_ps(x, sigmoidSSE2(_mm_mul_ps(u, _mm_set1_ps(ACT_GELU_K))));
+    }
+    case TINYAI_SIMD_ACTIVATION_SIGMOID:
+        return sigmoidSSE2(x);
+    case TINYAI_SIMD_ACTIVATION_TANH:
+        return tanhSSE2(x);
+    case TINYAI_SIMD_ACTIVATION_SILU:
+        return _mm_mul_ps(x, sigmoidSSE2(x));
+    case TINYAI_SIMD_ACTIVATION_EXP:
+        return expSSE2(x);
+    default:
+        /* No change for unknown activation type */
+        return x;
+    }
+}
+
+/* SSE2 implementation for activation functions */
+static void activateSSE2(float *inout, int size, int activationType)
+{
+    int i = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(inout + i, activateVectorSSE2(_mm_loadu_ps(inout + i), activationType));
+    }
+
+    /* The tail goes through a padded copy, so every element gets the same approximation */
+    if (i < size) {
+        float rest[4] = {0};
+        memcpy(rest, inout + i, (size_t)(size - i) * sizeof(float));
+        _mm_storeu_ps(rest, activateVectorSSE2(_mm_loadu_ps(rest), activationType));
+        memcpy(inout + i, rest, (size_t)(size - i) * sizeof(float));
+    }
+}
+#endif
+
+#if defined(HAS_AVX_SUPPORT)
+/* AVX implementation for activation functions */
+static TINYAI_TARGET_AVX void activateAVX(float *inout, int size, int activationType)
+{
+    /* Only ReLU has an AVX kernel; the others need integer vectors AVX lacks */
+    if (activationType != TINYAI_SIMD_ACTIVATION_RELU) {
+        activateSSE2(inout, size, activationType);
+        return;
+    }
+
+    int    chunks = size / 8;
+    __m256 zeros  = _mm256_setzero_ps();
+    for (int i = 0; i < chunks; i++) {
+        __m256 x      = _mm256_loadu_ps(inout + i * 8);
+        __m256 result = _mm256_max_ps(x, zeros);
+        _mm256_storeu_ps(inout + i * 8, result);
+    }
+
+    /* Handle remaining elements */
+    for (int i = chunks * 8; i < size; i++) {
+        inout[i] = reluReference(inout[i]);
+    }
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+/* 2^f for f in [-0.5, 0.5], the polynomial of exp2FractionSSE2 */
+static inline TINYAI_TARGET_AVX2 __m256 exp2FractionAVX2(__m256 f)
+{
+    __m256 poly = _mm256_set1_ps(1.5403530e-4f);
+    poly        = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(1.3333558e-3f));
+    poly        = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(9.6181291e-3f));
+    poly        = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(5.5504109e-2f));
+    poly        = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(2.4022651e-1f));
+    poly        = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(6.9314718e-1f));
+    return _mm256_fmadd_ps(poly, f, _mm256_set1_ps(1.0f));
+}
+
+/* exp(x) using AVX2, 2^n applied in two halves as in expSSE2 */
+static inline TINYAI_TARGET_AVX2 __m256 expAVX2(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(ACT_EXP_MIN)), _mm256_set1_ps(ACT_EXP_MAX));
+
+    __m256  tx = _mm256_mul_ps(x, _mm256_set1_ps(ACT_LOG2E));
+    __m256i n  = _mm256_cvtps_epi32(tx);
+    __m256  f  = _mm256_sub_ps(tx, _mm256_cvtepi32_ps(n));
+
+    __m256i half  = _mm256_srai_epi32(n, 1);
+    __m256i bias  = _mm256_set1_epi32(127);
+    __m256  pow2a = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(half, bias), 23));
+    __m256  pow2b = _mm256_castsi256_ps(
+        _mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(n, half), bias), 23));
+    return _mm256_mul_ps(_mm256_mul_ps(exp2FractionAVX2(f), pow2a), pow2b);
+}
+
+/* sigmoid(x) using AVX2, as sigmoidSSE2 */
+static inline TINYAI_TARGET_AVX2 __m256 sigmoidAVX2(__m256 x)
+{
+    __m256 e   = expAVX2(_mm256_or_ps(x, _mm256_set1_ps(-0.0f)));
+    __m256 r   = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+    __m256 neg = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ);
+    return _mm256_blendv_ps(r, _mm256_mul_ps(e, r), neg);
+}
+
+/* tanh(x) using AVX2, as tanhSSE2 */
+static inline TINYAI_TARGET_AVX2 __m256 tanhAVX2(__m256 x)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 one  = _mm256_set1_ps(1.0f);
+    __m256       ax   = _mm256_andnot_ps(sign, x);
+
+    __m256 e = expAVX2(_mm256_mul_ps(ax, _mm256_set1_ps(-2.0f)));
+    __m256 t = _mm256_or_ps(_mm256_div_ps(_mm256_sub_ps(one, e), _mm256_add_ps(one, e)),
+                            _mm256_and_ps(x, sign));
+
+    __m256 x2   = _mm256_mul_ps(x, x);
+    __m256 poly = _mm256_set1_ps(62.0f / 2835.0f);
+    poly        = _mm256_fmadd_ps(poly, x2, _mm256_set1_ps(-17.0f / 315.0f));
+    poly        = _mm256_fmadd_ps(poly, x2, _mm256_set1_ps(2.0f / 15.0f));
+    poly        = _mm256_fmadd_ps(poly, x2, _mm256_set1_ps(-1.0f / 3.0f));
+    __m256 lin  = _mm256_cmp_ps(ax, _mm256_set1_ps(ACT_TANH_LIN), _CMP_LT_OQ);
+    return _mm256_blendv_ps(t, _mm256_fmadd_ps(_mm256_mul_ps(poly, x2), x, x), lin);
+}
+
+/* One vector of an activation using AVX2 */
+static inline TINYAI_TARGET_AVX2 __m256 activateVectorAVX2(__m256 x, int activationType)
+{
+    switch (activationType) {
+    case TINYAI_SIMD_ACTIVATION_RELU:
+        return _mm256_max_ps(x, _mm256_setzero_ps());
+    case TINYAI_SIMD_ACTIVATION_GELU: {
+        __m256 x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+        __m256 u  = _mm256_fmadd_ps(x3, _mm256_set1_ps(0.044715f), x);
+        return _mm256_mul_ps(x, sigmoidAVX2(_mm256_mul_ps(u, _mm256_set1_ps(ACT_GELU_K))));
+    }
+    case TINYAI_SIMD_ACTIVATION_SIGMOID:
+        return sigmoidAVX2(x);
+    case TINYAI_SIMD_ACTIVATION_TANH:
+        return tanhAVX2(x);
+    case TINYAI_SIMD_ACTIVATION_SILU:
+        return _mm256_mul_ps(x, sigmoidAVX2(x));
+    case TINYAI_SIMD_ACTIVATION_EXP:
+        return expAVX2(x);
+    default:
+        /* No change for unknown activation type */
+        return x;
+    }
+}
+
+/* AVX2 implementation for activation functions, the tail through masked loads and stores */
+static TINYAI_TARGET_AVX2 void activateAVX2(float *inout, int size, int activationType)
+{
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(inout + i, activateVectorAVX2(_mm256_loadu_ps(inout + i), activationType));
+    }
+
+    if (i < size) {
+        __m256i tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(size - i),
+                                          _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        __m256  x    = _mm256_maskload_ps(inout + i, tail);
+        _mm256_maskstore_ps(inout + i, tail, activateVectorAVX2(x, activationType));
+    }
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+/* 2^f for f in [-0.5, 0.5], the polynomial of exp2FractionSSE2 */
+static inline TINYAI_TARGET_AVX512 __m512 exp2FractionAVX512(__m512 f)
+{
+    __m512 poly = _mm512_set1_ps(1.5403530e-4f);
+    poly        = _mm512_fmadd_ps(poly, f, _mm512_set1_ps(1.3333558e-3f));
+    poly        = _mm512_fmadd_ps(poly, f, _mm512_set1_ps(9.6181291e-3f));
+    poly        = _mm512_fmadd_ps(poly, f, _mm512_set1_ps(5.5504109e-2f));
+    poly        = _mm512_fmadd_ps(poly, f, _mm512_set1_ps(2.4022651e-1f));
+    poly        = _mm512_fmadd_ps(poly, f, _mm512_set1_ps(6.9314718e-1f));
+    return _mm512_fmadd_ps(poly, f, _mm512_set1_ps(1.0f));
+}
+
+/* exp(x) using AVX-512; vscalefps applies 2^n with the overflow and underflow of expf */
+static inline TINYAI_TARGET_AVX512 __m512 expAVX512(__m512 x)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(ACT_EXP_MIN)), _mm512_set1_ps(ACT_EXP_MAX));
+
+    __m512 tx = _mm512_mul_ps(x, _mm512_set1_ps(ACT_LOG2E));
+    __m512 n  = _mm512_roundscale_ps(tx, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    return _mm512_scalef_ps(exp2FractionAVX512(_mm512_sub_ps(tx, n)), n);
+}
+
+/* sigmoid(x) using AVX-512: 1 / (1 + e) for x >= 0 and e / (1 + e) below, with e = exp(-|x|) */
+static inline TINYAI_TARGET_AVX512 __m512 sigmoidAVX512(__m512 x)
+{
+    __m512    e   = expAVX512(_mm512_castsi512_ps(
+        _mm512_or_si512(_mm512_castps_si512(x), _mm512_set1_epi32((int)0x80000000u))));
+    __m512    r   = _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_add_ps(_mm512_set1_ps(1.0f), e));
+    __mmask16 neg = _mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ);
+    return _mm512_mask_mul_ps(r, neg, e, r);
+}
+
+/* tanh(x) using AVX-512, as tanhSSE2 */
+static inline TINYAI_TARGET_AVX512 __m512 tanhAVX512(__m512 x)
+{
+    const __m512i sign = _mm512_set1_epi32((int)0x80000000u);
+    const __m512  one  = _mm512_set1_ps(1.0f);
+    __m512        ax   = _mm512_abs_ps(x);
+
+    __m512 e = expAVX512(_mm512_mul_ps(ax, _mm512_set1_ps(-2.0f)));
+    __m512 t = _mm512_div_ps(_mm512_sub_ps(one, e), _mm512_add_ps(one, e));
+    t        = _mm512_castsi512_ps(_mm512_or_si512(
+        _mm512_castps_si512(t), _mm512_and_si512(_mm512_castps_si512(x), sign)));
+
+    __m512 x2   = _mm512_mul_ps(x, x);
+    __m512 poly = _mm512_set1_ps(62.0f / 2835.0f);
+    poly        = _mm512_fmadd_ps(poly, x2, _mm512_set1_ps(-17.0f / 315.0f));
+    poly        = _mm512_fmadd_ps(poly, x2, _mm512_set1_ps(2.0f / 15.0f));
+    poly        = _mm512_fmadd_ps(poly, x2, _mm512_set1_ps(-1.0f / 3.0f));
+    __mmask16 lin = _mm512_cmp_ps_mask(ax, _mm512_set1_ps(ACT_TANH_LIN), _CMP_LT_OQ);
+    return _mm512_mask_blend_ps(lin, t, _mm512_fmadd_ps(_mm512_mul_ps(poly, x2), x, x));
+}
+
+/* One vector of an activation using AVX-512 */
+static inline TINYAI_TARGET_AVX512 __m512 activateVectorAVX512(__m512 x, int activationType)
+{
+    switch (activationType) {
+    case TINYAI_SIMD_ACTIVATION_RELU:
+        return _mm512_max_ps(x, _mm512_setzero_ps());
+    case TINYAI_SIMD_ACTIVATION_GELU: {
+        __m512 x3 = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+        __m512 u  = _mm512_fmadd_ps(x3, _mm512_set1_ps(0.044715f), x);
+        return _mm512_mul_ps(x, sigmoidAVX512(_mm512_mul_ps(u, _mm512_set1_ps(ACT_GELU_K))));
+    }
+    case TINYAI_SIMD_ACTIVATION_SIGMOID:
+        return sigmoidAVX512(x);
+    case TINYAI_SIMD_ACTIVATION_TANH:
+        return tanhAVX512(x);
+    case TINYAI_SIMD_ACTIVATION_SILU:
+        return _mm512_mul_ps(x, sigmoidAVX512(x));
+    case TINYAI_SIMD_ACTIVATION_EXP:
+        return expAVX512(x);
+    default:
+        /* No change for unknown activation type */
+        return x;
+    }
+}
+
+/* AVX-512 implementation for activation functions, the tail through masked loads and stores */
+static TINYAI_TARGET_AVX512 void activateAVX512(float *inout, int size, int activationType)
+{
+    int i = 0;
+    for (; i + 16 <= size; i += 16) {
+        _mm512_storeu_ps(inout + i,
+                         activateVectorAVX512(_mm512_loadu_ps(inout + i), activationType));
+    }
+
+    if (i < size) {
+        __mmask16 tail = (__mmask16)((1u << (size - i)) - 1);
+        __m512    x    = _mm512_maskz_loadu_ps(tail, inout + i);
+        _mm512_mask_storeu_ps(inout + i, tail, activateVectorAVX512(x, activationType));
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+/* 2^f for f in [-0.5, 0.5], the polynomial of exp2FractionSSE2 */
+static inline float32x4_t exp2FractionNEON(float32x4_t f)
+{
+    float32x4_t poly = vdupq_n_f32(1.5403530e-4f);
+    poly             = vfmaq_f32(vdupq_n_f32(1.3333558e-3f), poly, f);
+    poly             = vfmaq_f32(vdupq_n_f32(9.6181291e-3f), poly, f);
+    poly             = vfmaq_f32(vdupq_n_f32(5.5504109e-2f), poly, f);
+    poly             = vfmaq_f32(vdupq_n_f32(2.4022651e-1f), poly, f);
+    poly             = vfmaq_f32(vdupq_n_f32(6.9314718e-1f), poly, f);
+    return vfmaq_f32(vdupq_n_f32(1.0f), poly, f);
+}
+
+/* exp(x) using NEON, 2^n applied in two halves as in expSSE2 */
+static inline float32x4_t expNEON(float32x4_t x)
+{
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(ACT_EXP_MIN)), vdupq_n_f32(ACT_EXP_MAX));
+
+    float32x4_t tx = vmulq_f32(x, vdupq_n_f32(ACT_LOG2E));
+    int32x4_t   n  = vcvtnq_s32_f32(tx);
+    float32x4_t f  = vsubq_f32(tx, vcvtq_f32_s32(n));
+
+    int32x4_t   half  = vshrq_n_s32(n, 1);
+    int32x4_t   bias  = vdupq_n_s32(127);
+    float32x4_t pow2a = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(half, bias), 23));
+    float32x4_t pow2b = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(vsubq_s32(n, half), bias), 23));
+    return vmulq_f32(vmulq_f32(exp2FractionNEON(f), pow2a), pow2b);
+}
+
+/* sigmoid(x) using NEON, as sigmoidSSE2 */
+static inline float32x4_t sigmoidNEON(float32x4_t x)
+{
+    float32x4_t e   = expNEON(vnegq_f32(vabsq_f32(x)));
+    float32x4_t r   = vdivq_f32(vdupq_n_f32(1.0f), vaddq_f32(vdupq_n_f32(1.0f), e));
+    uint32x4_t  neg = vcltq_f32(x, vdupq_n_f32(0.0f));
+    return vbslq_f32(neg, vmulq_f32(e, r), r);
+}
+
+/* tanh(x) using NEON, as tanhSSE2 */
+static inline float32x4_t tanhNEON(float32x4_t x)
+{
+    const uint32x4_t  sign = vdupq_n_u32(0x80000000u);
+    const float32x4_t one  = vdupq_n_f32(1.0f);
+    float32x4_t       ax   = vabsq_f32(x);
+
+    float32x4_t e = expNEON(vmulq_f32(ax, vdupq_n_f32(-2.0f)));
+    float32x4_t t = vbslq_f32(sign, x, vdivq_f32(vsubq_f32(one, e), vaddq_f32(one, e)));
+
+    float32x4_t x2   = vmulq_f32(x, x);
+    float32x4_t poly = vdupq_n_f32(62.0f / 2835.0f);
+    poly             = vfmaq_f32(vdupq_n_f32(-17.0f / 315.0f), poly, x2);
+    poly             = vfmaq_f32(vdupq_n_f32(2.0f / 15.0f), poly, x2);
+    poly             = vfmaq_f32(vdupq_n_f32(-1.0f / 3.0f), poly, x2);
+    uint32x4_t lin   = vcltq_f32(ax, vdupq_n_f32(ACT_TANH_LIN));
+    return vbslq_f32(lin, vfmaq_f32(x, vmulq_f32(poly, x2), x), t);
+}
+
+/* One vector of an activation using NEON */
+static inline float32x4_t activateVectorNEON(float32x4_t x, int activationType)
+{
+    switch (activationType) {
+    case TINYAI_SIMD_ACTIVATION_RELU:
+        return vmaxq_f32(x, vdupq_n_f32(0.0f));
+    case TINYAI_SIMD_ACTIVATION_GELU: {
+        float32x4_t x3 = vmulq_f32(vmulq_f32(x, x), x);
+        float32x4_t u  = vfmaq_f32(x, x3, vdupq_n_f32(0.044715f));
+        return vmulq_f32(x, sigmoidNEON(vmulq_f32(u, vdupq_n_f32(ACT_GELU_K))));
+    }
+    case TINYAI_SIMD_ACTIVATION_SIGMOID:
+        return sigmoidNEON(x);
+    case TINYAI_SIMD_ACTIVATION_TANH:
+        return tanhNEON(x);
+    case TINYAI_SIMD_ACTIVATION_SILU:
+        return vmulq_f32(x, sigmoidNEON(x));
+    case TINYAI_SIMD_ACTIVATION_EXP:
+        return expNEON(x);
+    default:
+        /* No change for unknown activation type */
+        return x;
+    }
+}
+
+/* NEON implementation for activation functions, the tail through a padded copy as in SSE2 */
+static void activateNEON(float *inout, int size, int activationType)
+{
+    int i = 0;
+    for (; i + 4 <= size; i += 4) {
+        vst1q_f32(inout + i, activateVectorNEON(vld1q_f32(inout + i), activationType));
+    }
+
+    if (i < size) {
+        float rest[4] = {0};
+        memcpy(rest, inout + i, (size_t)(size - i) * sizeof(float));
+        vst1q_f32(rest, activateVectorNEON(vld1q_f32(rest), activationType));
+        memcpy(inout + i, rest, (size_t)(size - i) * sizeof(float));
+    }
+}
+#endif
+
+/* Public API for vector activation */
+void tinyaiSimdActivate(float *inout, int size, int activationType)
+{
+    if (!inout || size <= 0) {
+        return;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        activateAVX512(inout, size, activationType);
+        return;
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        activateAVX2(inout, size, activationType);
+        return;
+    }
+#endif
+
+#if defined(HAS_AVX_SUPPORT)
+    if (g_hasAVX) {
+        activateAVX(inout, size, activationType);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        activateSSE2(inout, size, activationType);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        activateNEON(inout, size, activationType);
+        return;
+    }
+#endif
+
+    activateReference(inout, size, activationType);
+}
+
+/*
+ * Fused elementwise chains. Each row of the operation list is resolved into
+ * steps with row-relative operand pointers, and every vector of the row is
+ * loaded once, run through all steps in registers and stored once. Tails go
+ * through padded copies, so every element gets the vector approximations.
+ */
+
+/* One operation of a chain, resolved for the current row */
+typedef struct {
+    int          type;       /* TINYAI_SIMD_EW_*; BIAS is resolved to RESIDUAL */
+    int          activation; /* TINYAI_SIMD_ACTIVATION_* */
+    const float *src;        /* Operand of RESIDUAL and MULTIPLY at the row start */
+    int8_t      *dst;        /* Levels of QUANTIZE at the row start, or NULL */
+    float        alpha;      /* RESIDUAL factor, SCALE factor, CLAMP minimum, QUANTIZE scale */
+    float        beta;       /* SCALE offset, CLAMP maximum, QUANTIZE inverse scale */
+} ElementwiseStep;
+
+/* Kernel running a chain over count elements of a row, a multiple of its vector width */
+typedef void (*ElementwiseRowFn)(float *out, const float *in, const ElementwiseStep *steps,
+                                 int numSteps, int count);
+
+/* Largest vector width of the elementwise kernels, in floats */
+#define ELEMENTWISE_MAX_WIDTH 16
+
+static void elementwiseRowReference(float *out, const float *in, const ElementwiseStep *steps,
+                                    int numSteps, int count)
+{
+    for (int i = 0; i < count; i++) {
+        float x = in[i];
+        for (int s = 0; s < numSteps; s++) {
+            const ElementwiseStep *step = &steps[s];
+            switch (step->type) {
+            case TINYAI_SIMD_EW_RESIDUAL:
+                x += step->alpha * step->src[i];
+                break;
+            case TINYAI_SIMD_EW_MULTIPLY:
+                x *= step->src[i];
+                break;
+            case TINYAI_SIMD_EW_SCALE:
+                x = x * step->alpha + step->beta;
+                break;
+            case TINYAI_SIMD_EW_ACTIVATION:
+                activateReference(&x, 1, step->activation);
+                break;
+            case TINYAI_SIMD_EW_CLAMP:
+                x = x < step->alpha ? step->alpha : (x > step->beta ? step->beta : x);
+                break;
+            case TINYAI_SIMD_EW_QUANTIZE: {
+                float level = x * step->beta;
+                level       = level < -127.0f ? -127.0f : (level > 127.0f ? 127.0f : level);
+                long q      = lrintf(level);
+                x           = (float)q * step->alpha;
+                if (step->dst) {
+                    step->dst[i] = (int8_t)q;
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        out[i] = x;
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+static void elementwiseRowSSE2(float *out, const float *in, const ElementwiseStep *steps,
+                               int numSteps, int count)
+{
+    for (int i = 0; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        for (int s = 0; s < numSteps; s++) {
+            const ElementwiseStep *step = &steps[s];
+            switch (step->type) {
+            case TINYAI_SIMD_EW_RESIDUAL:
+                x = _mm_add_ps(x, _mm_mul_ps(_mm_set1_ps(step->alpha), _mm_loadu_ps(step->src + i)));
+                break;
+            case TINYAI_SIMD_EW_MULTIPLY:
+                x = _mm_mul_ps(x, _mm_loadu_ps(step->src + i));
+                break;
+            case TINYAI_SIMD_EW_SCALE:
+                x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(step->alpha)), _mm_set1_ps(step->beta));
+                break;
+            case TINYAI_SIMD_EW_ACTIVATION:
+                x = activateVectorSSE2(x, step->activation);
+                break;
+            case TINYAI_SIMD_EW_CLAMP:
+                x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(step->alpha)), _mm_set1_ps(step->beta));
+                break;
+            case TINYAI_SIMD_EW_QUANTIZE: {
+                __m128 level = _mm_mul_ps(x, _mm_set1_ps(step->beta));
+                level = _mm_min_ps(_mm_max_ps(level, _mm_set1_ps(-127.0f)), _mm_set1_ps(127.0f));
+                __m128i q = _mm_cvtps_epi32(level);
+                x         = _mm_mul_ps(_mm_cvtepi32_ps(q), _mm_set1_ps(step->alpha));
+                if (step->dst) {
+                    __m128i packed = _mm_packs_epi32(q, q);
+                    int32_t bytes  = _mm_cvtsi128_si32(_mm_packs_epi16(packed, packed));
+                    memcpy(step->dst + i, &bytes, sizeof(bytes));
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        _mm_storeu_ps(out + i, x);
+    }
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+static TINYAI_TARGET_AVX2 void elementwiseRowAVX2(float *out, const float *in,
+                                                  const ElementwiseStep *steps, int numSteps,
+                                                  int count)
+{
+    for (int i = 0; i < count; i += 8) {
+        __m256 x = _mm256_loadu_ps(in + i);
+        for (int s = 0; s < numSteps; s++) {
+            const ElementwiseStep *step = &steps[s];
+            switch (step->type) {
+            case TINYAI_SIMD_EW_RESIDUAL:
+                x = _mm256_fmadd_ps(_mm256_set1_ps(step->alpha), _mm256_loadu_ps(step->src + i), x);
+                break;
+            case TINYAI_SIMD_EW_MULTIPLY:
+                x = _mm256_mul_ps(x, _mm256_loadu_ps(step->src + i));
+                break;
+            case TINYAI_SIMD_EW_SCALE:
+                x = _mm256_fmadd_ps(x, _mm256_set1_ps(step->alpha), _mm256_set1_ps(step->beta));
+                break;
+            case TINYAI_SIMD_EW_ACTIVATION:
+                x = activateVectorAVX2(x, step->activation);
+                break;
+            case TINYAI_SIMD_EW_CLAMP:
+                x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(step->alpha)),
+                                  _mm256_set1_ps(step->beta));
+                break;
+            case TINYAI_SIMD_EW_QUANTIZE: {
+                __m256 level = _mm256_mul_ps(x, _mm256_set1_ps(step->beta));
+                level        = _mm256_min_ps(_mm256_max_ps(level, _mm256_set1_ps(-127.0f)),
+                                             _mm256_set1_ps(127.0f));
+                __m256i q    = _mm256_cvtps_epi32(level);
+                x            = _mm256_mul_ps(_mm256_cvtepi32_ps(q), _mm256_set1_ps(step->alpha));
+                if (step->dst) {
+                    __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(q),
+                                                     _mm256_extracti128_si256(q, 1));
+                    _mm_storel_epi64((__m128i *)(step->dst + i), _mm_packs_epi16(packed, packed));
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        _mm256_storeu_ps(out + i, x);
+    }
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+static TINYAI_TARGET_AVX512 void elementwiseRowAVX512(float *out, const float *in,
+                                                      const ElementwiseStep *steps, int numSteps,
+                                                      int count)
+{
+    for (int i = 0; i < count; i += 16) {
+        __m512 x = _mm512_loadu_ps(in + i);
+        for (int s = 0; s < numSteps; s++) {
+            const ElementwiseStep *step = &steps[s];
+            switch (step->type) {
+            case TINYAI_SIMD_EW_RESIDUAL:
+                x = _mm512_fmadd_ps(_mm512_set1_ps(step->alpha), _mm512_loadu_ps(step->src + i), x);
+                break;
+            case TINYAI_SIMD_EW_MULTIPLY:
+                x = _mm512_mul_ps(x, _mm512_loadu_ps(step->src + i));
+                break;
+            case TINYAI_SIMD_EW_SCALE:
+                x = _mm512_fmadd_ps(x, _mm512_set1_ps(step->alpha), _mm512_set1_ps(step->beta));
+                break;
+            case TINYAI_SIMD_EW_ACTIVATION:
+                x = activateVectorAVX512(x, step->activation);
+                break;
+            case TINYAI_SIMD_EW_CLAMP:
+                x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(step->alpha)),
+                                  _mm512_set1_ps(step->beta));
+                break;
+            case TINYAI_SIMD_EW_QUANTIZE: {
+                __m512 level = _mm512_mul_ps(x, _mm512_set1_ps(step->beta));
+                level        = _mm512_min_ps(_mm512_max_ps(level, _mm512_set1_ps(-127.0f)),
+                                             _mm512_set1_ps(127.0f));
+                __m512i q    = _mm512_cvtps_epi32(level);
+                x            = _mm512_mul_ps(_mm512_cvtepi32_ps(q), _mm512_set1_ps(step->alpha));
+                if (step->dst) {
+                    _mm_storeu_si128((__m128i *)(step->dst + i), _mm512_cvtepi32_epi8(q));
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        _mm512_storeu_ps(out + i, x);
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static void elementwiseRowNEON(float *out, const float *in, const ElementwiseStep *steps,
+                               int numSteps, int count)
+{
+    for (int i = 0; i < count; i += 4) {
+        float32x4_t x = vld1q_f32(in + i);
+        for (int s = 0; s < numSteps; s++) {
+            const ElementwiseStep *step = &steps[s];
+            switch (step->type) {
+            case TINYAI_SIMD_EW_RESIDUAL:
+                x = vfmaq_f32(x, vdupq_n_f32(step->alpha), vld1q_f32(step->src + i));
+                break;
+            case TINYAI_SIMD_EW_MULTIPLY:
+                x = vmulq_f32(x, vld1q_f32(step->src + i));
+                break;
+            case TINYAI_SIMD_EW_SCALE:
+                x = vfmaq_f32(vdupq_n_f32(step->beta), x, vdupq_n_f32(step->alpha));
+                break;
+            case TINYAI_SIMD_EW_ACTIVATION:
+                x = activateVectorNEON(x, step->activation);
+                break;
+            case TINYAI_SIMD_EW_CLAMP:
+                x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(step->alpha)), vdupq_n_f32(step->beta));
+                break;
+            case TINYAI_SIMD_EW_QUANTIZE: {
+                float32x4_t level = vmulq_f32(x, vdupq_n_f32(step->beta));
+                level = vminq_f32(vmaxq_f32(level, vdupq_n_f32(-127.0f)), vdupq_n_f32(127.0f));
+                int32x4_t q = vcvtnq_s32_f32(level);
+                x           = vmulq_f32(vcvtq_f32_s32(q), vdupq_n_f32(step->alpha));
+                if (step->dst) {
+                    int16x4_t narrow = vqmovn_s32(q);
+                    int8_t    bytes[8];
+                    vst1_s8(bytes, vqmovn_s16(vcombine_s16(narrow, narrow)));
+                    memcpy(step->dst + i, bytes, 4);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        vst1q_f32(out + i, x);
+    }
+}
+#endif
+
+/* Run the last count (< width) elements of a row through a padded copy */
+static void elementwiseTail(ElementwiseRowFn row, int width, float *out, const float *in,
+                            const ElementwiseStep *steps, int numSteps, int count)
+{
+    float           x[ELEMENTWISE_MAX_WIDTH] = {0};
+    float           operands[TINYAI_SIMD_ELEMENTWISE_MAX_OPS][ELEMENTWISE_MAX_WIDTH];
+    int8_t          levels[TINYAI_SIMD_ELEMENTWISE_MAX_OPS][ELEMENTWISE_MAX_WIDTH];
+    ElementwiseStep padded[TINYAI_SIMD_ELEMENTWISE_MAX_OPS];
+
+    memcpy(x, in, (size_t)count * sizeof(float));
+    for (int s = 0; s < numSteps; s++) {
+        padded[s] = steps[s];
+        if (steps[s].src) {
+            memset(operands[s], 0, sizeof(operands[s]));
+            memcpy(operands[s], steps[s].src, (size_t)count * sizeof(float));
+            padded[s].src = operands[s];
+        }
+        if (steps[s].dst) {
+            padded[s].dst = levels[s];
+        }
+    }
+
+    row(x, x, padded, numSteps, width);
+
+    memcpy(out, x, (size_t)count * sizeof(float));
+    for (int s = 0; s < numSteps; s++) {
+        if (steps[s].dst) {
+            memcpy(steps[s].dst, levels[s], (size_t)count);
+        }
+    }
+}
+
+/* Pick the widest elementwise kernel, returning its vector width */
+static int elementwiseKernel(ElementwiseRowFn *row)
+{
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        *row = elementwiseRowAVX512;
+        return 16;
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        *row = elementwiseRowAVX2;
+        return 8;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        *row = elementwiseRowSSE2;
+        return 4;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        *row = elementwiseRowNEON;
+        return 4;
+    }
+#endif
+
+    *row = elementwiseRowReference;
+    return 1;
+}
+
+/* Resolve an operation for the row starting at element offset */
+static void elementwiseStep(ElementwiseStep *step, const TinyAIElementwiseOp *op, size_t offset)
+{
+    step->type       = op->type;
+    step->activation = op->activation;
+    step->src        = NULL;
+    step->dst        = NULL;
+    step->alpha      = op->alpha;
+    step->beta       = op->beta;
+
+    switch (op->type) {
+    case TINYAI_SIMD_EW_BIAS:
+        /* A bias is indexed by column, the same for every row */
+        step->type  = TINYAI_SIMD_EW_RESIDUAL;
+        step->src   = op->operand;
+        step->alpha = 1.0f;
+        break;
+    case TINYAI_SIMD_EW_RESIDUAL:
+    case TINYAI_SIMD_EW_MULTIPLY:
+        step->src = op->operand + offset;
+        break;
+    case TINYAI_SIMD_EW_QUANTIZE:
+        step->dst  = op->quantized ? op->quantized + offset : NULL;
+        step->beta = 1.0f / op->alpha;
         break;
+    default:
+        break;
+    }
+}
+
+/* Public API for fused elementwise chains */
+int tinyaiSimdElementwise(float *out, const float *in, int rows, int cols,
+                          const TinyAIElementwiseOp *ops, int numOps)
+{
+    if (!out || !in || rows < 0 || cols < 0 || numOps < 0 ||
+        numOps > TINYAI_SIMD_ELEMENTWISE_MAX_OPS || (numOps > 0 && !ops)) {
+        return -1;
+    }
+
+    for (int s = 0; s < numOps; s++) {
+        switch (ops[s].type) {
+        case TINYAI_SIMD_EW_BIAS:
+        case TINYAI_SIMD_EW_RESIDUAL:
+        case TINYAI_SIMD_EW_MULTIPLY:
+            if (!ops[s].operand) {
+                return -1;
+            }
+            break;
+        case TINYAI_SIMD_EW_QUANTIZE:
+            if (!(ops[s].alpha > 0.0f)) {
+                return -1;
+            }
+            break;
+        case TINYAI_SIMD_EW_SCALE:
+        case TINYAI_SIMD_EW_ACTIVATION:
+        case TINYAI_SIMD_EW_CLAMP:
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+    ElementwiseRowFn row;
+    int              width = elementwiseKernel(&row);
+    int              full  = cols / width * width;
+
+    ElementwiseStep steps[TINYAI_SIMD_ELEMENTWISE_MAX_OPS];
+    for (int r = 0; r < rows; r++) {
+        size_t offset = (size_t)r * cols;
+        for (int s = 0; s < numOps; s++) {
+            elementwiseStep(&steps[s], &ops[s], offset);
+        }
+
+        row(out + offset, in + offset, steps, numOps, full);
+        if (full < cols) {
+            for (int s = 0; s < numOps; s++) {
+                steps[s].src = steps[s].src ? steps[s].src + full : NULL;
+                steps[s].dst = steps[s].dst ? steps[s].dst + full : NULL;
+            }
+            elementwiseTail(row, width, out + offset + full, in + offset + full, steps, numOps,
+                            cols - full);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Softmax family: max and sum reductions, shifted exponentials, argmax,
+ * log-sum-exp and softmax. Each vector width has one kernel per primitive and
+ * every softmax-shaped consumer in the tree is built from the public entry
+ * points, so a faster exp or reduction reaches all of them at once.
+ */
+
+/* Reference kernels for the softmax family */
+static float reduceMaxReference(const float *x, int size)
+{
+    float maxValue = x[0];
+    for (int i = 1; i < size; i++) {
+        if (x[i] > maxValue) {
+            maxValue = x[i];
+        }
+    }
+    return maxValue;
+}
+
+static float reduceSumReference(const float *x, int size)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+static float dotReference(const float *a, const float *b, int size)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/* out[i] = exp((x[i] - shift) * scale) when out is not NULL; returns the sum */
+static float expSumReference(float *out, const float *x, float shift, float scale, int size)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < size; i++) {
+        float e = expf((x[i] - shift) * scale);
+        if (out) {
+            out[i] = e;
+        }
+        sum += e;
+    }
+    return sum;
+}
+
+static void scaleReference(float *inout, float alpha, int size)
+{
+    for (int i = 0; i < size; i++) {
+        inout[i] *= alpha;
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* Approximation of exp(x) for x <= 0 using SSE2 */
+static inline __m128 expNonPositiveSSE2(__m128 x)
+{
+    /* Below -87 the result is flushed to zero (so masked -INFINITY logits get no mass);
+       clamping keeps 2^n representable */
+    __m128 inRange = _mm_cmpgt_ps(x, _mm_set1_ps(-87.0f));
+    x              = _mm_max_ps(x, _mm_set1_ps(-87.0f));
+
+    /* exp(x) = 2^n * 2^f with n = round(x * log2(e)) and f in [-0.5, 0.5] */
+    __m128  tx = _mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f));
+    __m128i n  = _mm_cvtps_epi32(tx);
+    __m128  f  = _mm_sub_ps(tx, _mm_cvtepi32_ps(n));
+
+    /* Degree-6 Taylor polynomial of 2^f, relative error ~1e-7 */
+    __m128 poly = exp2FractionSSE2(f);
+
+    /* Scale by 2^n through the exponent bits */
+    __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+
+    return _mm_and_ps(_mm_mul_ps(pow2n, poly), inRange);
+}
+
+static float reduceMaxSSE2(const float *x, int size)
+{
+    int   i        = 0;
+    float maxValue = x[0];
+    if (size >= 4) {
+        __m128 maxVec = _mm_loadu_ps(x);
+        for (i = 4; i + 4 <= size; i += 4) {
+            maxVec = _mm_max_ps(maxVec, _mm_loadu_ps(x + i));
+        }
+        maxVec   = _mm_max_ps(maxVec, _mm_shuffle_ps(maxVec, maxVec, _MM_SHUFFLE(1, 0, 3, 2)));
+        maxVec   = _mm_max_ps(maxVec, _mm_shuffle_ps(maxVec, maxVec, _MM_SHUFFLE(2, 3, 0, 1)));
+        maxValue = _mm_cvtss_f32(maxVec);
+    }
+    for (; i < size; i++) {
+        if (x[i] > maxValue) {
+            maxValue = x[i];
+        }
+    }
+    return maxValue;
+}
+
+static float reduceSumSSE2(const float *x, int size)
+{
+    __m128 sumVec = _mm_setzero_ps();
+    int    i      = 0;
+    for (; i + 4 <= size; i += 4) {
+        sumVec = _mm_add_ps(sumVec, _mm_loadu_ps(x + i));
+    }
+
+    float sumArr[4];
+    _mm_storeu_ps(sumArr, sumVec);
+    float sum = sumArr[0] + sumArr[1] + sumArr[2] + sumArr[3];
+    for (; i < size; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+static float dotSSE2(const float *a, const float *b, int size)
+{
+    __m128 sumVec = _mm_setzero_ps();
+    int    i      = 0;
+    for (; i + 4 <= size; i += 4) {
+        sumVec = _mm_add_ps(sumVec, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+
+    float sumArr[4];
+    _mm_storeu_ps(sumArr, sumVec);
+    return sumArr[0] + sumArr[1] + sumArr[2] + sumArr[3] + dotReference(a + i, b + i, size - i);
+}
+
+static float expSumSSE2(float *out, const float *x, float shift, float scale, int size)
+{
+    __m128 shiftVec = _mm_set1_ps(shift);
+    __m128 scaleVec = _mm_set1_ps(scale);
+    __m128 sumVec   = _mm_setzero_ps();
+    int    i        = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128 e =
+            expNonPositiveSSE2(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), shiftVec), scaleVec));
+        if (out) {
+            _mm_storeu_ps(out + i, e);
+        }
+        sumVec = _mm_add_ps(sumVec, e);
+    }
+
+    float sumArr[4];
+    _mm_storeu_ps(sumArr, sumVec);
+    float sum = sumArr[0] + sumArr[1] + sumArr[2] + sumArr[3];
+    return sum + expSumReference(out ? out + i : NULL, x + i, shift, scale, size - i);
+}
+
+static void scaleSSE2(float *inout, float alpha, int size)
+{
+    __m128 alphaVec = _mm_set1_ps(alpha);
+    int    i        = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm_storeu_ps(inout + i, _mm_mul_ps(_mm_loadu_ps(inout + i), alphaVec));
+    }
+    scaleReference(inout + i, alpha, size - i);
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+/* Approximation of exp(x) for x <= 0 using AVX2, as expNonPositiveSSE2 */
+static inline TINYAI_TARGET_AVX2 __m256 expNonPositiveAVX2(__m256 x)
+{
+    __m256 inRange = _mm256_cmp_ps(x, _mm256_set1_ps(-87.0f), _CMP_GT_OQ);
+    x              = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+
+    __m256  tx = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f));
+    __m256i n  = _mm256_cvtps_epi32(tx);
+    __m256  f  = _mm256_sub_ps(tx, _mm256_cvtepi32_ps(n));
+
+    __m256 pow2n =
+        _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23));
+
+    return _mm256_and_ps(_mm256_mul_ps(pow2n, exp2FractionAVX2(f)), inRange);
+}
+
+/* Horizontal sum and maximum of an 8-float vector */
+static inline TINYAI_TARGET_AVX2 float horizontalSumAVX2(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s        = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s        = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(s);
+}
+
+static inline TINYAI_TARGET_AVX2 float horizontalMaxAVX2(__m256 v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m        = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m        = _mm_max_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(m);
+}
+
+static TINYAI_TARGET_AVX2 float reduceMaxAVX2(const float *x, int size)
+{
+    int   i        = 0;
+    float maxValue = x[0];
+    if (size >= 8) {
+        __m256 maxVec = _mm256_loadu_ps(x);
+        for (i = 8; i + 8 <= size; i += 8) {
+            maxVec = _mm256_max_ps(maxVec, _mm256_loadu_ps(x + i));
+        }
+        maxValue = horizontalMaxAVX2(maxVec);
+    }
+    for (; i < size; i++) {
+        if (x[i] > maxValue) {
+            maxValue = x[i];
+        }
+    }
+    return maxValue;
+}
+
+static TINYAI_TARGET_AVX2 float reduceSumAVX2(const float *x, int size)
+{
+    /* Two accumulators hide the latency of the adds */
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int    i    = 0;
+    for (; i + 16 <= size; i += 16) {
+        sum0 = _mm256_add_ps(sum0, _mm256_loadu_ps(x + i));
+        sum1 = _mm256_add_ps(sum1, _mm256_loadu_ps(x + i + 8));
+    }
+    if (i + 8 <= size) {
+        sum0 = _mm256_add_ps(sum0, _mm256_loadu_ps(x + i));
+        i += 8;
+    }
+    return horizontalSumAVX2(_mm256_add_ps(sum0, sum1)) + reduceSumReference(x + i, size - i);
+}
+
+static TINYAI_TARGET_AVX2 float dotAVX2(const float *a, const float *b, int size)
+{
+    /* Two accumulators hide the latency of the fused multiply-adds */
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int    i    = 0;
+    for (; i + 16 <= size; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    if (i + 8 <= size) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        i += 8;
+    }
+    return horizontalSumAVX2(_mm256_add_ps(sum0, sum1)) + dotReference(a + i, b + i, size - i);
+}
+
+static TINYAI_TARGET_AVX2 float expSumAVX2(float *out, const float *x, float shift, float scale,
+                                           int size)
+{
+    __m256 shiftVec = _mm256_set1_ps(shift);
+    __m256 scaleVec = _mm256_set1_ps(scale);
+    __m256 sumVec   = _mm256_setzero_ps();
+    int    i        = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256 e = expNonPositiveAVX2(
+            _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), shiftVec), scaleVec));
+        if (out) {
+            _mm256_storeu_ps(out + i, e);
+        }
+        sumVec = _mm256_add_ps(sumVec, e);
+    }
+    return horizontalSumAVX2(sumVec) +
+           expSumReference(out ? out + i : NULL, x + i, shift, scale, size - i);
+}
+
+static TINYAI_TARGET_AVX2 void scaleAVX2(float *inout, float alpha, int size)
+{
+    __m256 alphaVec = _mm256_set1_ps(alpha);
+    int    i        = 0;
+    for (; i + 8 <= size; i += 8) {
+        _mm256_storeu_ps(inout + i, _mm256_mul_ps(_mm256_loadu_ps(inout + i), alphaVec));
+    }
+    scaleReference(inout + i, alpha, size - i);
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+/* Approximation of exp(x) for x <= 0 using AVX-512, the polynomial of expNonPositiveSSE2 */
+static inline TINYAI_TARGET_AVX512 __m512 expNonPositiveAVX512(__m512 x)
+{
+    /* Below -87 the result is flushed to zero; clamping keeps 2^n representable */
+    __mmask16 inRange = _mm512_cmp_ps_mask(x, _mm512_set1_ps(-87.0f), _CMP_GT_OQ);
+    x                 = _mm512_max_ps(x, _mm512_set1_ps(-87.0f));
+
+    /* exp(x) = 2^n * 2^f with n = round(x * log2(e)) and f in [-0.5, 0.5] */
+    __m512  tx = _mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f));
+    __m512i n  = _mm512_cvtps_epi32(tx);
+    __m512  f  = _mm512_sub_ps(tx, _mm512_cvtepi32_ps(n));
+
+    __m512 poly = exp2FractionAVX512(f);
+
+    /* Scale by 2^n through the exponent bits */
+    __m512 pow2n =
+        _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(n, _mm512_set1_epi32(127)), 23));
+
+    return _mm512_maskz_mul_ps(inRange, pow2n, poly);
+}
+
+/* AVX-512 kernels take their tails through masked loads and stores */
+static inline __mmask16 tailMaskAVX512(int size, int full)
+{
+    return (__mmask16)((1u << (size - full)) - 1);
+}
+
+static TINYAI_TARGET_AVX512 float reduceMaxAVX512(const float *x, int size)
+{
+    int       i      = 0;
+    int       full   = size / 16 * 16;
+    __mmask16 tail   = tailMaskAVX512(size, full);
+    __m512    maxVec = _mm512_set1_ps(-INFINITY);
+    for (; i < full; i += 16) {
+        maxVec = _mm512_max_ps(maxVec, _mm512_loadu_ps(x + i));
+    }
+    if (tail) {
+        maxVec = _mm512_mask_max_ps(maxVec, tail, maxVec, _mm512_maskz_loadu_ps(tail, x + i));
+    }
+    return _mm512_reduce_max_ps(maxVec);
+}
+
+static TINYAI_TARGET_AVX512 float reduceSumAVX512(const float *x, int size)
+{
+    int       i      = 0;
+    int       full   = size / 16 * 16;
+    __mmask16 tail   = tailMaskAVX512(size, full);
+    __m512    sumVec = _mm512_setzero_ps();
+    for (; i < full; i += 16) {
+        sumVec = _mm512_add_ps(sumVec, _mm512_loadu_ps(x + i));
+    }
+    if (tail) {
+        sumVec = _mm512_add_ps(sumVec, _mm512_maskz_loadu_ps(tail, x + i));
+    }
+    return _mm512_reduce_add_ps(sumVec);
+}
+
+static TINYAI_TARGET_AVX512 float dotAVX512(const float *a, const float *b, int size)
+{
+    int       i      = 0;
+    int       full   = size / 16 * 16;
+    __mmask16 tail   = tailMaskAVX512(size, full);
+    __m512    sumVec = _mm512_setzero_ps();
+    for (; i < full; i += 16) {
+        sumVec = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sumVec);
+    }
+    if (tail) {
+        sumVec = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, a + i),
+                                 _mm512_maskz_loadu_ps(tail, b + i), sumVec);
+    }
+    return _mm512_reduce_add_ps(sumVec);
+}
+
+static TINYAI_TARGET_AVX512 float expSumAVX512(float *out, const float *x, float shift,
+                                               float scale, int size)
+{
+    int       i        = 0;
+    int       full     = size / 16 * 16;
+    __mmask16 tail     = tailMaskAVX512(size, full);
+    __m512    shiftVec = _mm512_set1_ps(shift);
+    __m512    scaleVec = _mm512_set1_ps(scale);
+    __m512    sumVec   = _mm512_setzero_ps();
+    for (; i < full; i += 16) {
+        __m512 e = expNonPositiveAVX512(
+            _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(x + i), shiftVec), scaleVec));
+        if (out) {
+            _mm512_storeu_ps(out + i, e);
+        }
+        sumVec = _mm512_add_ps(sumVec, e);
+    }
+    if (tail) {
+        __m512 v = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, x + i), shiftVec);
+        __m512 e = expNonPositiveAVX512(_mm512_mul_ps(v, scaleVec));
+        if (out) {
+            _mm512_mask_storeu_ps(out + i, tail, e);
+        }
+        sumVec = _mm512_mask_add_ps(sumVec, tail, sumVec, e);
+    }
+    return _mm512_reduce_add_ps(sumVec);
+}
+
+static TINYAI_TARGET_AVX512 void scaleAVX512(float *inout, float alpha, int size)
+{
+    int       i        = 0;
+    int       full     = size / 16 * 16;
+    __mmask16 tail     = tailMaskAVX512(size, full);
+    __m512    alphaVec = _mm512_set1_ps(alpha);
+    for (; i < full; i += 16) {
+        _mm512_storeu_ps(inout + i, _mm512_mul_ps(_mm512_loadu_ps(inout + i), alphaVec));
+    }
+    if (tail) {
+        __m512 v = _mm512_maskz_loadu_ps(tail, inout + i);
+        _mm512_mask_storeu_ps(inout + i, tail, _mm512_mul_ps(v, alphaVec));
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+/* Approximation of exp(x) for x <= 0 using NEON, as expNonPositiveSSE2 */
+static inline float32x4_t expNonPositiveNEON(float32x4_t x)
+{
+    uint32x4_t inRange = vcgtq_f32(x, vdupq_n_f32(-87.0f));
+    x                  = vmaxq_f32(x, vdupq_n_f32(-87.0f));
+
+    float32x4_t tx = vmulq_f32(x, vdupq_n_f32(1.44269504088896341f));
+    int32x4_t   n  = vcvtnq_s32_f32(tx);
+    float32x4_t f  = vsubq_f32(tx, vcvtq_f32_s32(n));
+
+    float32x4_t pow2n = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23));
+    return vbslq_f32(inRange, vmulq_f32(pow2n, exp2FractionNEON(f)), vdupq_n_f32(0.0f));
+}
+
+static float reduceMaxNEON(const float *x, int size)
+{
+    int   i        = 0;
+    float maxValue = x[0];
+    if (size >= 4) {
+        float32x4_t maxVec = vld1q_f32(x);
+        for (i = 4; i + 4 <= size; i += 4) {
+            maxVec = vmaxq_f32(maxVec, vld1q_f32(x + i));
+        }
+        maxValue = vmaxvq_f32(maxVec);
+    }
+    for (; i < size; i++) {
+        if (x[i] > maxValue) {
+            maxValue = x[i];
+        }
+    }
+    return maxValue;
+}
+
+static float reduceSumNEON(const float *x, int size)
+{
+    float32x4_t sumVec = vdupq_n_f32(0.0f);
+    int         i      = 0;
+    for (; i + 4 <= size; i += 4) {
+        sumVec = vaddq_f32(sumVec, vld1q_f32(x + i));
+    }
+    return vaddvq_f32(sumVec) + reduceSumReference(x + i, size - i);
+}
+
+static float dotNEON(const float *a, const float *b, int size)
+{
+    float32x4_t sumVec = vdupq_n_f32(0.0f);
+    int         i      = 0;
+    for (; i + 4 <= size; i += 4) {
+        sumVec = vmlaq_f32(sumVec, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    return vaddvq_f32(sumVec) + dotReference(a + i, b + i, size - i);
+}
+
+static float expSumNEON(float *out, const float *x, float shift, float scale, int size)
+{
+    float32x4_t shiftVec = vdupq_n_f32(shift);
+    float32x4_t scaleVec = vdupq_n_f32(scale);
+    float32x4_t sumVec   = vdupq_n_f32(0.0f);
+    int         i        = 0;
+    for (; i + 4 <= size; i += 4) {
+        float32x4_t e =
+            expNonPositiveNEON(vmulq_f32(vsubq_f32(vld1q_f32(x + i), shiftVec), scaleVec));
+        if (out) {
+            vst1q_f32(out + i, e);
+        }
+        sumVec = vaddq_f32(sumVec, e);
+    }
+    return vaddvq_f32(sumVec) +
+           expSumReference(out ? out + i : NULL, x + i, shift, scale, size - i);
+}
+
+static void scaleNEON(float *inout, float alpha, int size)
+{
+    int i = 0;
+    for (; i + 4 <= size; i += 4) {
+        vst1q_f32(inout + i, vmulq_n_f32(vld1q_f32(inout + i), alpha));
+    }
+    scaleReference(inout + i, alpha, size - i);
+}
+#endif
+
+/* Public API for the maximum reduction */
+float tinyaiSimdReduceMax(const float *x, int size)
+{
+    if (size <= 0) {
+        return -INFINITY;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        return reduceMaxAVX512(x, size);
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return reduceMaxAVX2(x, size);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return reduceMaxSSE2(x, size);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return reduceMaxNEON(x, size);
+    }
+#endif
+
+    return reduceMaxReference(x, size);
+}
+
+/* Public API for the sum reduction */
+float tinyaiSimdReduceSum(const float *x, int size)
+{
+    if (size <= 0) {
+        return 0.0f;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        return reduceSumAVX512(x, size);
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return reduceSumAVX2(x, size);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return reduceSumSSE2(x, size);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return reduceSumNEON(x, size);
+    }
+#endif
+
+    return reduceSumReference(x, size);
+}
+
+/* Public API for the dot product */
+float tinyaiSimdDot(const float *a, const float *b, int size)
+{
+    if (size <= 0) {
+        return 0.0f;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        return dotAVX512(a, b, size);
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return dotAVX2(a, b, size);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return dotSSE2(a, b, size);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return dotNEON(a, b, size);
+    }
+#endif
+
+    return dotReference(a, b, size);
+}
+
+static int32_t dotInt8Reference(const int8_t *a, const int8_t *b, int size)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < size; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+/* 16 values per step, sign-extended to int16 and summed in pairs by pmaddwd */
+static int32_t dotInt8SSE2(const int8_t *a, const int8_t *b, int size)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc  = zero;
+    int     i    = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i a0 = _mm_srai_epi16(_mm_unpacklo_epi8(zero, va), 8);
+        __m128i a1 = _mm_srai_epi16(_mm_unpackhi_epi8(zero, va), 8);
+        __m128i b0 = _mm_srai_epi16(_mm_unpacklo_epi8(zero, vb), 8);
+        __m128i b1 = _mm_srai_epi16(_mm_unpackhi_epi8(zero, vb), 8);
+        acc        = _mm_add_epi32(acc, _mm_madd_epi16(a0, b0));
+        acc        = _mm_add_epi32(acc, _mm_madd_epi16(a1, b1));
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dotInt8Reference(a + i, b + i, size - i);
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+static TINYAI_TARGET_AVX2 int32_t dotInt8AVX2(const int8_t *a, const int8_t *b, int size)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int     i   = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(b + i)));
+        acc        = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s         = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s         = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s) + dotInt8Reference(a + i, b + i, size - i);
+}
+#endif
+
+#if defined(HAS_AVX512VNNI_SUPPORT)
+/* vpdpbusd multiplies unsigned by signed bytes, so a enters as |a| and its signs move onto b */
+static TINYAI_TARGET_AVX512VNNI int32_t dotInt8VNNI(const int8_t *a, const int8_t *b, int size)
+{
+    __m512i zero = _mm512_setzero_si512();
+    __m512i sum  = zero;
+    for (int i = 0; i < size; i += 64) {
+        int       rest = size - i;
+        __mmask64 mask = rest >= 64 ? ~(__mmask64)0 : ((__mmask64)1 << rest) - 1;
+        __m512i   va   = _mm512_maskz_loadu_epi8(mask, a + i);
+        __m512i   vb   = _mm512_maskz_loadu_epi8(mask, b + i);
+
+        vb  = _mm512_mask_sub_epi8(vb, _mm512_movepi8_mask(va), zero, vb);
+        sum = _mm512_dpbusd_epi32(sum, _mm512_abs_epi8(va), vb);
+    }
+    return _mm512_reduce_add_epi32(sum);
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static int32_t dotInt8NEON(const int8_t *a, const int8_t *b, int size)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    int       i   = 0;
+    for (; i + 16 <= size; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc          = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc          = vpadalq_s16(acc, vmull_high_s8(va, vb));
+    }
+    return vaddvq_s32(acc) + dotInt8Reference(a + i, b + i, size - i);
+}
+#endif
+
+#if defined(HAS_NEON_DOTPROD_SUPPORT)
+static TINYAI_TARGET_DOTPROD int32_t dotInt8DotProd(const int8_t *a, const int8_t *b, int size)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    int       i   = 0;
+    for (; i + 16 <= size; i += 16) {
+        acc = vdotq_s32(acc, vld1q_s8(a + i), vld1q_s8(b + i));
+    }
+    return vaddvq_s32(acc) + dotInt8Reference(a + i, b + i, size - i);
+}
+#endif
+
+/* Public API for the int8 dot product */
+int32_t tinyaiSimdDotInt8(const int8_t *a, const int8_t *b, int size)
+{
+    if (size <= 0) {
+        return 0;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512VNNI_SUPPORT)
+    if (g_hasAVX512VNNI && g_avx512Enabled) {
+        return dotInt8VNNI(a, b, size);
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return dotInt8AVX2(a, b, size);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return dotInt8SSE2(a, b, size);
+    }
+#endif
+
+#if defined(HAS_NEON_DOTPROD_SUPPORT)
+    if (g_hasNEONDotProd) {
+        return dotInt8DotProd(a, b, size);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return dotInt8NEON(a, b, size);
+    }
+#endif
+
+    return dotInt8Reference(a, b, size);
+}
+
+static void maskLogitsReference(float *logits, const uint32_t *mask, int start, int size)
+{
+    for (int i = start; i < size; i++) {
+        if (!((mask[i >> 5] >> (i & 31)) & 1u)) {
+            logits[i] = -INFINITY;
+        }
+    }
+}
+
+#if defined(HAS_AVX2_SUPPORT)
+/* Eight mask bits per step, spread over the lanes by comparing against each lane's bit */
+static TINYAI_TARGET_AVX2 void maskLogitsAVX2(float *logits, const uint32_t *mask, int size)
+{
+    const __m256i lanes  = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256  negInf = _mm256_set1_ps(-INFINITY);
+    int           i      = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint32_t bits = (mask[i >> 5] >> (i & 31)) & 0xFFu;
+        if (bits == 0xFFu) {
+            continue;
+        }
+        __m256i set  = _mm256_and_si256(_mm256_set1_epi32((int)bits), lanes);
+        __m256  keep = _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, lanes));
+        _mm256_storeu_ps(logits + i, _mm256_blendv_ps(negInf, _mm256_loadu_ps(logits + i), keep));
+    }
+    maskLogitsReference(logits, mask, i, size);
+}
+#endif
+
+#if defined(HAS_AVX512_SUPPORT)
+/* Sixteen mask bits are an AVX-512 lane mask as they are */
+static TINYAI_TARGET_AVX512 void maskLogitsAVX512(float *logits, const uint32_t *mask, int size)
+{
+    const __m512 negInf = _mm512_set1_ps(-INFINITY);
+    for (int i = 0; i < size; i += 16) {
+        __mmask16 bits = (__mmask16)(mask[i >> 5] >> (i & 31));
+        __mmask16 live = size - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+        if ((bits & live) == live) {
+            continue;
+        }
+        __m512 v = _mm512_mask_blend_ps(bits, negInf, _mm512_maskz_loadu_ps(live, logits + i));
+        _mm512_mask_storeu_ps(logits + i, live, v);
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static void maskLogitsNEON(float *logits, const uint32_t *mask, int size)
+{
+    static const uint32_t laneBits[4] = {1, 2, 4, 8};
+    const uint32x4_t      lanes       = vld1q_u32(laneBits);
+    const float32x4_t     negInf      = vdupq_n_f32(-INFINITY);
+    int                   i           = 0;
+    for (; i + 4 <= size; i += 4) {
+        uint32_t bits = (mask[i >> 5] >> (i & 31)) & 0xFu;
+        if (bits == 0xFu) {
+            continue;
+        }
+        uint32x4_t keep = vtstq_u32(vdupq_n_u32(bits), lanes);
+        vst1q_f32(logits + i, vbslq_f32(keep, vld1q_f32(logits + i), negInf));
+    }
+    maskLogitsReference(logits, mask, i, size);
+}
+#endif
+
+/* Public API for logit masking */
+void tinyaiSimdMaskLogits(float *logits, const uint32_t *mask, int size)
+{
+    if (size <= 0) {
+        return;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        maskLogitsAVX512(logits, mask, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        maskLogitsAVX2(logits, mask, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        maskLogitsNEON(logits, mask, size);
+        return;
+    }
+#endif
+
+    maskLogitsReference(logits, mask, 0, size);
+}
+
+/* Public API for low-rank row updates */
+void tinyaiSimdLowRankAdd(float *out, const float *in, int rows, int inSize, int outSize,
+                          const float *down, const float *up, int rank, float scale)
+{
+    for (int j = 0; j < rows; j++) {
+        const float *x = in + (size_t)j * inSize;
+        float       *y = out + (size_t)j * outSize;
+        for (int k = 0; k < rank; k++) {
+            float t = tinyaiSimdDot(x, down + (size_t)k * inSize, inSize);
+            tinyaiSimdVecScaleAdd(y, up + (size_t)k * outSize, scale * t, outSize);
+        }
+    }
+}
+
+/* Public API for argmax: one vector pass for the maximum, then the first match */
+int tinyaiSimdArgmax(const float *x, int size)
+{
+    if (size <= 0) {
+        return -1;
+    }
+
+    float maxValue = tinyaiSimdReduceMax(x, size);
+    for (int i = 0; i < size; i++) {
+        if (x[i] == maxValue) {
+            return i;
+        }
+    }
+
+    /* Only reachable when the maximum is NaN */
+    return 0;
+}
+
+/* Public API for shifted exponentials and their sum */
+float tinyaiSimdExpSum(float *out, const float *x, float shift, float scale, int size)
+{
+    if (size <= 0) {
+        return 0.0f;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        return expSumAVX512(out, x, shift, scale, size);
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return expSumAVX2(out, x, shift, scale, size);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return expSumSSE2(out, x, shift, scale, size);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return expSumNEON(out, x, shift, scale, size);
+    }
+#endif
+
+    return expSumReference(out, x, shift, scale, size);
+}
+
+/* Multiply a vector in place by a scalar through the widest kernel */
+static void scaleInPlace(float *inout, float alpha, int size)
+{
+#if defined(HAS_AVX512_SUPPORT)
+    if (g_hasAVX512 && g_avx512Enabled) {
+        scaleAVX512(inout, alpha, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        scaleAVX2(inout, alpha, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        scaleSSE2(inout, alpha, size);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        scaleNEON(inout, alpha, size);
+        return;
+    }
+#endif
+
+    scaleReference(inout, alpha, size);
+}
+
+/* Public API for log-sum-exp */
+float tinyaiSimdLogSumExp(const float *x, int size)
+{
+    float maxValue = tinyaiSimdReduceMax(x, size);
+    if (maxValue == -INFINITY) {
+        return -INFINITY;
+    }
+    return maxValue + logf(tinyaiSimdExpSum(NULL, x, maxValue, 1.0f, size));
+}
+
+/* Public API for softmax with temperature */
+void tinyaiSimdSoftmaxTemperature(float *out, const float *in, int size, float temperature)
+{
+    if (size <= 0) {
+        return;
+    }
+
+    if (temperature <= 0.0f) {
+        temperature = 1.0f;
+    }
+
+    /* softmax(x / T) = exp((x - max) / T) / sum, so the temperature folds into the exp pass */
+    float maxValue = tinyaiSimdReduceMax(in, size);
+    float sum      = tinyaiSimdExpSum(out, in, maxValue, 1.0f / temperature, size);
+    if (sum > 0.0f) {
+        scaleInPlace(out, 1.0f / sum, size);
+    }
+}
+
+/* Public API for softmax */
+void tinyaiSimdSoftmax(float *inout, int size)
+{
+    tinyaiSimdSoftmaxTemperature(inout, inout, size, 1.0f);
+}
+
+/* Fold one Welford accumulator (count, mean, m2) into another (Chan et al.) */
+static void mergeWelford(float *count, float *mean, float *m2, float otherCount, float otherMean,
+                         float otherM2)
+{
+    if (otherCount == 0.0f) {
+        return;
+    }
+
+    float total = *count + otherCount;
+    float delta = otherMean - *mean;
+    *mean += delta * (otherCount / total);
+    *m2 += otherM2 + delta * delta * (*count * otherCount / total);
+    *count = total;
+}
+
+/* Reference implementation for layer normalization */
+static void layerNormReference(float *out, const float *input, const float *residual,
+                               const float *gamma, const float *beta, int size, float epsilon,
+                               int activationType)
+{
+    /* Single Welford pass over the residual-added input, which is staged in out */
+    float mean = 0.0f, m2 = 0.0f;
+    for (int i = 0; i < size; i++) {
+        float x     = residual ? input[i] + residual[i] : input[i];
+        float delta = x - mean;
+        out[i]      = x;
+        mean += delta / (float)(i + 1);
+        m2 += delta * (x - mean);
     }
-    case 1: /* GELU - fallback to reference for complex functions */
-    case 2: /* Sigmoid - fallback to reference for complex functions */
-        activateReference(inout, size, activationType);
-        return;
+
+    float invStd = 1.0f / sqrtf(m2 / size + epsilon);
+    for (int i = 0; i < size; i++) {
+        float v = (out[i] - mean) * invStd;
+        if (gamma) {
+            v *= gamma[i];
+        }
+        if (beta) {
+            v += beta[i];
+        }
+        out[i] = activationType == 0 ? reluReference(v) : v;
     }
+}
 
-    /* Handle remaining elements */
-    for (int i = chunks * 8; i < size; i++) {
-        float x = inout[i];
-        switch (activationType) {
-        case 0: /* ReLU */
-            inout[i] = reluReference(x);
-            break;
-        case 1: /* GELU */
-            inout[i] = geluReference(x);
-            break;
-        case 2: /* Sigmoid */
-            inout[i] = sigmoidReference(x);
-            break;
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 implementation for layer normalization */
+static void layerNormSSE2(float *out, const float *input, const float *residual,
+                          const float *gamma, const float *beta, int size, float epsilon,
+                          int activationType)
+{
+    int i = 0;
+
+    /* Welford per lane over the residual-added input, which is staged in out */
+    __m128 meanVec = _mm_setzero_ps();
+    __m128 m2Vec   = _mm_setzero_ps();
+    float  lane    = 0.0f;
+    for (; i + 4 <= size; i += 4) {
+        __m128 x = _mm_loadu_ps(input + i);
+        if (residual) {
+            x = _mm_add_ps(x, _mm_loadu_ps(residual + i));
+        }
+        _mm_storeu_ps(out + i, x);
+
+        lane += 1.0f;
+        __m128 delta = _mm_sub_ps(x, meanVec);
+        meanVec      = _mm_add_ps(meanVec, _mm_mul_ps(delta, _mm_set1_ps(1.0f / lane)));
+        m2Vec        = _mm_add_ps(m2Vec, _mm_mul_ps(delta, _mm_sub_ps(x, meanVec)));
+    }
+
+    /* Merge the lanes, then fold in the remaining elements */
+    float means[4], m2s[4];
+    _mm_storeu_ps(means, meanVec);
+    _mm_storeu_ps(m2s, m2Vec);
+
+    float count = 0.0f, mean = 0.0f, m2 = 0.0f;
+    for (int l = 0; l < 4; l++) {
+        mergeWelford(&count, &mean, &m2, lane, means[l], m2s[l]);
+    }
+    for (; i < size; i++) {
+        float x     = residual ? input[i] + residual[i] : input[i];
+        float delta = x - mean;
+        out[i]      = x;
+        count += 1.0f;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    /* Normalize, scale, shift and optionally clamp in one more pass */
+    float  invStd  = 1.0f / sqrtf(m2 / size + epsilon);
+    __m128 meanB   = _mm_set1_ps(mean);
+    __m128 invStdB = _mm_set1_ps(invStd);
+    __m128 zeros   = _mm_setzero_ps();
+    for (i = 0; i + 4 <= size; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(out + i), meanB), invStdB);
+        if (gamma) {
+            v = _mm_mul_ps(v, _mm_loadu_ps(gamma + i));
+        }
+        if (beta) {
+            v = _mm_add_ps(v, _mm_loadu_ps(beta + i));
+        }
+        if (activationType == 0) {
+            v = _mm_max_ps(v, zeros);
+        }
+        _mm_storeu_ps(out + i, v);
+    }
+    for (; i < size; i++) {
+        float v = (out[i] - mean) * invStd;
+        if (gamma) {
+            v *= gamma[i];
+        }
+        if (beta) {
+            v += beta[i];
         }
+        out[i] = activationType == 0 ? reluReference(v) : v;
     }
 }
 #endif
 
-/* Public API for vector activation */
-void tinyaiSimdActivate(float *inout, int size, int activationType)
+#if defined(HAS_AVX_SUPPORT)
+/* AVX implementation for layer normalization */
+static TINYAI_TARGET_AVX void layerNormAVX(float *out, const float *input,
+                                            const float *residual, const float *gamma,
+                                            const float *beta, int size, float epsilon,
+                                            int activationType)
 {
-    if (!g_simdInitialized) {
-        detectSimdCapabilities();
+    int i = 0;
+
+    /* Welford per lane over the residual-added input, which is staged in out */
+    __m256 meanVec = _mm256_setzero_ps();
+    __m256 m2Vec   = _mm256_setzero_ps();
+    float  lane    = 0.0f;
+    for (; i + 8 <= size; i += 8) {
+        __m256 x = _mm256_loadu_ps(input + i);
+        if (residual) {
+            x = _mm256_add_ps(x, _mm256_loadu_ps(residual + i));
+        }
+        _mm256_storeu_ps(out + i, x);
+
+        lane += 1.0f;
+        __m256 delta = _mm256_sub_ps(x, meanVec);
+        meanVec      = _mm256_add_ps(meanVec, _mm256_mul_ps(delta, _mm256_set1_ps(1.0f / lane)));
+        m2Vec        = _mm256_add_ps(m2Vec, _mm256_mul_ps(delta, _mm256_sub_ps(x, meanVec)));
     }
 
-#if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
-        /* For AVX2, we have optimized implementations for all activation types */
-        switch (activationType) {
-        case 1: /* GELU */
-            geluActivateAVX2(inout, size);
-            break;
-        case 2: /* Sigmoid */
-            sigmoidActivateAVX2(inout, size);
-            break;
-        default: /* ReLU and others */
-            /* For ReLU, the AVX implementation is sufficient */
-            activateAVX(inout, size, activationType);
-            break;
+    /* Merge the lanes, then fold in the remaining elements */
+    float means[8], m2s[8];
+    _mm256_storeu_ps(means, meanVec);
+    _mm256_storeu_ps(m2s, m2Vec);
+
+    float count = 0.0f, mean = 0.0f, m2 = 0.0f;
+    for (int l = 0; l < 8; l++) {
+        mergeWelford(&count, &mean, &m2, lane, means[l], m2s[l]);
+    }
+    for (; i < size; i++) {
+        float x     = residual ? input[i] + residual[i] : input[i];
+        float delta = x - mean;
+        out[i]      = x;
+        count += 1.0f;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    /* Normalize, scale, shift and optionally clamp in one more pass */
+    float  invStd  = 1.0f / sqrtf(m2 / size + epsilon);
+    __m256 meanB   = _mm256_set1_ps(mean);
+    __m256 invStdB = _mm256_set1_ps(invStd);
+    __m256 zeros   = _mm256_setzero_ps();
+    for (i = 0; i + 8 <= size; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(out + i), meanB), invStdB);
+        if (gamma) {
+            v = _mm256_mul_ps(v, _mm256_loadu_ps(gamma + i));
         }
-        return;
+        if (beta) {
+            v = _mm256_add_ps(v, _mm256_loadu_ps(beta + i));
+        }
+        if (activationType == 0) {
+            v = _mm256_max_ps(v, zeros);
+        }
+        _mm256_storeu_ps(out + i, v);
+    }
+    for (; i < size; i++) {
+        float v = (out[i] - mean) * invStd;
+        if (gamma) {
+            v *= gamma[i];
+        }
+        if (beta) {
+            v += beta[i];
+        }
+        out[i] = activationType == 0 ? reluReference(v) : v;
     }
+}
 #endif
 
+/* Run the best available layer normalization kernel */
+static void layerNormDispatch(float *out, const float *input, const float *residual,
+                              const float *gamma, const float *beta, int size, float epsilon,
+                              int activationType)
+{
 #if defined(HAS_AVX_SUPPORT)
     if (g_hasAVX) {
-        activateAVX(inout, size, activationType);
+        layerNormAVX(out, input, residual, gamma, beta, size, epsilon, activationType);
         return;
     }
 #endif
 
 #if defined(HAS_SSE2_SUPPORT)
     if (g_hasSSE2) {
-        activateSSE2(inout, size, activationType);
+        layerNormSSE2(out, input, residual, gamma, beta, size, epsilon, activationType);
         return;
     }
 #endif
 
-    activateReference(inout, size, activationType);
+    layerNormReference(out, input, residual, gamma, beta, size, epsilon, activationType);
 }
 
-/* Implement simplified versions of remaining functions */
-
-void tinyaiSimdMatMul4BitMM(float *out, const uint8_t *a, const float *b, int rowsA, int colsA,
-                            int colsB, const float *scaleFactors)
+/* Public API for layer normalization */
+void tinyaiSimdLayerNorm(float *out, const float *input, const float *residual, const float *gamma,
+                         const float *beta, int size, float epsilon, int activationType)
 {
-    /* Simplified implementation that calls matrix-vector multiply for each column of B */
-    float *temp   = (float *)malloc(rowsA * sizeof(float));
-    float *column = (float *)malloc(colsA * sizeof(float));
+    if (size <= 0) {
+        return;
+    }
 
-    if (temp && column) {
-        for (int colB = 0; colB < colsB; colB++) {
-            /* Extract column from B */
-            for (int i = 0; i < colsA; i++) {
-                column[i] = b[i * colsB + colB];
-            }
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
 
-            /* Multiply A by this column */
-            tinyaiSimdMatMul4Bit(temp, a, column, rowsA, colsA, scaleFactors);
+    layerNormDispatch(out, input, residual, gamma, beta, size, epsilon, activationType);
 
-            /* Store results in output */
-            for (int rowA = 0; rowA < rowsA; rowA++) {
-                out[rowA * colsB + colB] = temp[rowA];
-            }
-        }
+    /* ReLU is fused into the kernels; other activations run while the row is still in cache */
+    if (activationType > 0) {
+        tinyaiSimdActivate(out, size, activationType);
     }
-
-    /* Free dynamically allocated memory */
-    if (column)
-        free(column);
-    if (temp)
-        free(temp);
 }
 
+/* Implement simplified versions of remaining functions */
+
 void tinyaiSimdDequantize4Bit(float *out, const uint8_t *in, int size, const float *scaleFactors)
 {
     int bytesPerBlock = (size + 1) / 2;
@@ -672,3 +5621,410 @@ void tinyaiSimdQuantize4Bit(uint8_t *out, const float *in, int size, float *scal
         }
     }
 }
+
+/*
+ * Interleaved 16-bit PCM to mono floats. Channels are summed as integers,
+ * which is exact, and divided once, so every path gives the same result.
+ */
+
+static void pcm16ToMonoReference(const int16_t *input, int channels, int frames, float *output)
+{
+    float divisor = 32768.0f * channels;
+    for (int i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += input[i * channels + c];
+        }
+        output[i] = (float)sum / divisor;
+    }
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+static void pcm16ToMonoSSE2(const int16_t *input, int channels, int frames, float *output)
+{
+    int i = 0;
+    if (channels == 1) {
+        __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+        for (; i + 8 <= frames; i += 8) {
+            /* Sign-extend by duplicating each sample into a 32-bit lane and shifting */
+            __m128i x  = _mm_loadu_si128((const __m128i *)(input + i));
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+    }
+    else if (channels == 2) {
+        /* madd with ones adds the left and right sample of each frame */
+        __m128  scale = _mm_set1_ps(1.0f / 65536.0f);
+        __m128i ones  = _mm_set1_epi16(1);
+        for (; i + 4 <= frames; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(input + 2 * i));
+            _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_madd_epi16(x, ones)), scale));
+        }
+    }
+    pcm16ToMonoReference(input + (size_t)i * channels, channels, frames - i, output + i);
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+static TINYAI_TARGET_AVX2 void pcm16ToMonoAVX2(const int16_t *input, int channels, int frames,
+                                               float *output)
+{
+    int i = 0;
+    if (channels == 1) {
+        __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+        for (; i + 16 <= frames; i += 16) {
+            __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(input + i)));
+            __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(input + i + 8)));
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+            _mm256_storeu_ps(output + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+        }
+    }
+    else if (channels == 2) {
+        __m256  scale = _mm256_set1_ps(1.0f / 65536.0f);
+        __m256i ones  = _mm256_set1_epi16(1);
+        for (; i + 8 <= frames; i += 8) {
+            __m256i x   = _mm256_loadu_si256((const __m256i *)(input + 2 * i));
+            __m256  sum = _mm256_cvtepi32_ps(_mm256_madd_epi16(x, ones));
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(sum, scale));
+        }
+    }
+    pcm16ToMonoReference(input + (size_t)i * channels, channels, frames - i, output + i);
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static void pcm16ToMonoNEON(const int16_t *input, int channels, int frames, float *output)
+{
+    int i = 0;
+    if (channels == 1) {
+        for (; i + 8 <= frames; i += 8) {
+            int16x8_t x = vld1q_s16(input + i);
+            vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))),
+                                              1.0f / 32768.0f));
+            vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))),
+                                                  1.0f / 32768.0f));
+        }
+    }
+    else if (channels == 2) {
+        /* Pairwise widening add sums the left and right sample of each frame */
+        for (; i + 4 <= frames; i += 4) {
+            int32x4_t sum = vpaddlq_s16(vld1q_s16(input + 2 * i));
+            vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(sum), 1.0f / 65536.0f));
+        }
+    }
+    pcm16ToMonoReference(input + (size_t)i * channels, channels, frames - i, output + i);
+}
+#endif
+
+/* Public API for 16-bit PCM to mono float conversion */
+void tinyaiSimdPCM16ToMono(const int16_t *input, int channels, int frames, float *output)
+{
+    if (!input || !output || channels <= 0 || frames <= 0) {
+        return;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        pcm16ToMonoAVX2(input, channels, frames, output);
+        return;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        pcm16ToMonoSSE2(input, channels, frames, output);
+        return;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        pcm16ToMonoNEON(input, channels, frames, output);
+        return;
+    }
+#endif
+
+    pcm16ToMonoReference(input, channels, frames, output);
+}
+
+/*
+ * Zero crossings: a sample crosses when its sign, taken as x < 0, differs
+ * from the previous sample's. Each vector step compares samples i..i+w-1
+ * with i+1..i+w and subtracts the all-ones masks of the crossings from
+ * integer lane counters.
+ */
+
+static int countZeroCrossingsReference(const float *x, int size)
+{
+    int crossings = 0;
+    for (int i = 1; i < size; i++) {
+        crossings += (x[i - 1] < 0.0f) != (x[i] < 0.0f);
+    }
+    return crossings;
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+static int countZeroCrossingsSSE2(const float *x, int size)
+{
+    __m128  zero = _mm_setzero_ps();
+    __m128i acc  = _mm_setzero_si128();
+    int     i    = 0;
+    for (; i + 5 <= size; i += 4) {
+        __m128 a = _mm_cmplt_ps(_mm_loadu_ps(x + i), zero);
+        __m128 b = _mm_cmplt_ps(_mm_loadu_ps(x + i + 1), zero);
+        acc      = _mm_sub_epi32(acc, _mm_castps_si128(_mm_xor_ps(a, b)));
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+           countZeroCrossingsReference(x + i, size - i);
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+static TINYAI_TARGET_AVX2 int countZeroCrossingsAVX2(const float *x, int size)
+{
+    __m256  zero = _mm256_setzero_ps();
+    __m256i acc  = _mm256_setzero_si256();
+    int     i    = 0;
+    for (; i + 9 <= size; i += 8) {
+        __m256 a = _mm256_cmp_ps(_mm256_loadu_ps(x + i), zero, _CMP_LT_OQ);
+        __m256 b = _mm256_cmp_ps(_mm256_loadu_ps(x + i + 1), zero, _CMP_LT_OQ);
+        acc      = _mm256_sub_epi32(acc, _mm256_castps_si256(_mm256_xor_ps(a, b)));
+    }
+
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    int crossings = 0;
+    for (int l = 0; l < 8; l++) {
+        crossings += lanes[l];
+    }
+    return crossings + countZeroCrossingsReference(x + i, size - i);
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static int countZeroCrossingsNEON(const float *x, int size)
+{
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    uint32x4_t  acc  = vdupq_n_u32(0);
+    int         i    = 0;
+    for (; i + 5 <= size; i += 4) {
+        uint32x4_t a = vcltq_f32(vld1q_f32(x + i), zero);
+        uint32x4_t b = vcltq_f32(vld1q_f32(x + i + 1), zero);
+        acc          = vsubq_u32(acc, veorq_u32(a, b));
+    }
+    return (int)vaddvq_u32(acc) + countZeroCrossingsReference(x + i, size - i);
+}
+#endif
+
+/* Public API for counting zero crossings */
+int tinyaiSimdCountZeroCrossings(const float *x, int size)
+{
+    if (!x || size <= 1) {
+        return 0;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return countZeroCrossingsAVX2(x, size);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return countZeroCrossingsSSE2(x, size);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return countZeroCrossingsNEON(x, size);
+    }
+#endif
+
+    return countZeroCrossingsReference(x, size);
+}
+
+/*
+ * Byte runs: a vector step marks the bytes of the class, turns the marks
+ * into a bit mask and counts its trailing ones. Range checks subtract the
+ * low end and compare unsigned, via min(b - lo, count - 1) == b - lo.
+ */
+
+static bool isRunByte(unsigned char c, int byteClass)
+{
+    if (byteClass == TINYAI_SIMD_BYTES_SPACE) {
+        return c == ' ' || (unsigned char)(c - '\t') < 5;
+    }
+    return (unsigned char)(c - '0') < 10 || (unsigned char)((c | 0x20) - 'a') < 26 ||
+           c == '\'' || c == '-';
+}
+
+static size_t byteRunLengthReference(const char *text, size_t length, int byteClass)
+{
+    size_t i = 0;
+    while (i < length && isRunByte((unsigned char)text[i], byteClass)) {
+        i++;
+    }
+    return i;
+}
+
+/* Index of the lowest set bit of a non-zero mask */
+static int lowestSetBit(uint64_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+#if defined(HAS_SSE2_SUPPORT)
+static __m128i byteRangeSSE2(__m128i bytes, char low, char count)
+{
+    __m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8(low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8((char)(count - 1))), offset);
+}
+
+static size_t byteRunLengthSSE2(const char *text, size_t length, int byteClass)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i marks;
+        if (byteClass == TINYAI_SIMD_BYTES_SPACE) {
+            marks = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')),
+                                 byteRangeSSE2(bytes, '\t', 5));
+        }
+        else {
+            __m128i letters = byteRangeSSE2(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 26);
+            marks           = _mm_or_si128(_mm_or_si128(byteRangeSSE2(bytes, '0', 10), letters),
+                                           _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\'')),
+                                                        _mm_cmpeq_epi8(bytes, _mm_set1_epi8('-'))));
+        }
+        uint32_t bits = (uint32_t)_mm_movemask_epi8(marks);
+        if (bits != 0xFFFF) {
+            return i + (size_t)lowestSetBit(~bits);
+        }
+    }
+    return i + byteRunLengthReference(text + i, length - i, byteClass);
+}
+#endif
+
+#if defined(HAS_AVX2_SUPPORT)
+static TINYAI_TARGET_AVX2 __m256i byteRangeAVX2(__m256i bytes, char low, char count)
+{
+    __m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(low));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8((char)(count - 1))),
+                             offset);
+}
+
+static TINYAI_TARGET_AVX2 size_t byteRunLengthAVX2(const char *text, size_t length,
+                                                   int byteClass)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i marks;
+        if (byteClass == TINYAI_SIMD_BYTES_SPACE) {
+            marks = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                                    byteRangeAVX2(bytes, '\t', 5));
+        }
+        else {
+            __m256i folded  = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+            __m256i symbols = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\'')),
+                                              _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('-')));
+            marks = _mm256_or_si256(_mm256_or_si256(byteRangeAVX2(bytes, '0', 10),
+                                                    byteRangeAVX2(folded, 'a', 26)),
+                                    symbols);
+        }
+        uint32_t bits = (uint32_t)_mm256_movemask_epi8(marks);
+        if (bits != 0xFFFFFFFFu) {
+            return i + (size_t)lowestSetBit(~bits);
+        }
+    }
+    return i + byteRunLengthSSE2(text + i, length - i, byteClass);
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static uint8x16_t byteRangeNEON(uint8x16_t bytes, uint8_t low, uint8_t count)
+{
+    return vcltq_u8(vsubq_u8(bytes, vdupq_n_u8(low)), vdupq_n_u8(count));
+}
+
+static size_t byteRunLengthNEON(const char *text, size_t length, int byteClass)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t bytes = vld1q_u8((const uint8_t *)(text + i));
+        uint8x16_t marks;
+        if (byteClass == TINYAI_SIMD_BYTES_SPACE) {
+            marks = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(' ')), byteRangeNEON(bytes, '\t', 5));
+        }
+        else {
+            uint8x16_t letters = byteRangeNEON(vorrq_u8(bytes, vdupq_n_u8(0x20)), 'a', 26);
+            marks              = vorrq_u8(vorrq_u8(byteRangeNEON(bytes, '0', 10), letters),
+                                          vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\'')),
+                                                   vceqq_u8(bytes, vdupq_n_u8('-'))));
+        }
+
+        /* Narrowing keeps four bits of each byte's mark */
+        uint64_t bits =
+            vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(marks), 4)), 0);
+        if (bits != UINT64_MAX) {
+            return i + (size_t)(lowestSetBit(~bits) / 4);
+        }
+    }
+    return i + byteRunLengthReference(text + i, length - i, byteClass);
+}
+#endif
+
+/* Public API for the length of a byte run */
+size_t tinyaiSimdByteRunLength(const char *text, size_t length, int byteClass)
+{
+    if (!text || length == 0) {
+        return 0;
+    }
+
+    if (!g_simdInitialized) {
+        detectSimdCapabilities();
+    }
+
+#if defined(HAS_AVX2_SUPPORT)
+    if (g_hasAVX2) {
+        return byteRunLengthAVX2(text, length, byteClass);
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (g_hasSSE2) {
+        return byteRunLengthSSE2(text, length, byteClass);
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (g_hasNEON) {
+        return byteRunLengthNEON(text, length, byteClass);
+    }
+#endif
+
+    return byteRunLengthReference(text, length, byteClass);
+}
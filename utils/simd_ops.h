@@ -10,6 +10,7 @@
 #define TINYAI_SIMD_OPS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -22,6 +23,76 @@ extern "C" {
  */
 bool tinyaiSimdAvailable(void);
 
+/**
+ * @brief Check if the AVX kernels are in use
+ *
+ * Kernels beyond SSE2 are built per function and chosen at runtime from one
+ * CPUID probe, so the library needs no -mavx flags to use them.
+ *
+ * @return true if the CPU and operating system support AVX
+ */
+bool tinyaiSimdHasAVX(void);
+
+/**
+ * @brief Check if the AVX2 kernels are in use
+ * @return true if the CPU and operating system support AVX2 and FMA
+ */
+bool tinyaiSimdHasAVX2(void);
+
+/**
+ * @brief Check if the AVX-512F/BW kernels are in use
+ *
+ * True when the CPU and operating system support AVX-512F and AVX-512BW,
+ * the build can generate them, and tinyaiSimdSetAVX512Enabled has not
+ * turned them off.
+ *
+ * @return true if AVX-512 kernels are selected
+ */
+bool tinyaiSimdHasAVX512(void);
+
+/**
+ * @brief Check if the AVX-512 VNNI int8 dot-product kernels are in use
+ * @return true if tinyaiSimdHasAVX512 holds and the CPU has AVX512_VNNI
+ */
+bool tinyaiSimdHasAVX512VNNI(void);
+
+/**
+ * @brief Check if the AVX-512 BF16 conversion kernels are in use
+ * @return true if tinyaiSimdHasAVX512 holds and the CPU has AVX512_BF16
+ */
+bool tinyaiSimdHasAVX512BF16(void);
+
+/**
+ * @brief Allow or forbid the AVX-512 kernels
+ *
+ * Enabled by default where supported. Turning them off falls back to the
+ * AVX2/SSE2 kernels, to compare results or to avoid AVX-512 frequency
+ * drops on hosts where they cost more than they gain.
+ *
+ * @param enabled false to use the narrower kernels only
+ */
+void tinyaiSimdSetAVX512Enabled(bool enabled);
+
+/**
+ * @brief Check if the NEON kernels are in use
+ *
+ * NEON is part of the AArch64 base architecture, so this holds on every
+ * 64-bit Arm build and is false elsewhere.
+ *
+ * @return true if the NEON kernels are selected
+ */
+bool tinyaiSimdHasNEON(void);
+
+/**
+ * @brief Check if the NEON SDOT int8 dot-product kernels are in use
+ *
+ * The kernels are compiled with their own target, so a plain Armv8.0
+ * build still uses them when the CPU reports the dot product extension.
+ *
+ * @return true if tinyaiSimdHasNEON holds and the CPU has SDOT
+ */
+bool tinyaiSimdHasNEONDotProd(void);
+
 /**
  * @brief SIMD-accelerated matrix-vector multiplication for 4-bit weights
  *
@@ -38,6 +109,403 @@ bool tinyaiSimdAvailable(void);
 void tinyaiSimdMatMul4Bit(float *out, const uint8_t *weights, const float *input, int rows,
                           int cols, const float *scaleFactors);
 
+/**
+ * @brief SIMD-accelerated vector-matrix multiplication for affine 4-bit weights
+ *
+ * Computes out = input * W for a row-major [rows x cols] matrix packed two
+ * values per byte, high nibble first, where each weight dequantizes to
+ * q * scale + zeroPoint (the TinyAIMatrix4bit layout). The weights are
+ * never expanded to floats.
+ *
+ * @param out Output vector (cols elements)
+ * @param weights 4-bit quantized weight matrix (packed)
+ * @param input Input vector (rows elements)
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdVecMatMul4BitAffine(float *out, const uint8_t *weights, const float *input,
+                                   int rows, int cols, float scale, float zeroPoint);
+
+/**
+ * @brief SIMD-accelerated matrix multiplication for affine 4-bit weights
+ *
+ * Batched form of tinyaiSimdVecMatMul4BitAffine: multiplies count input
+ * vectors by the same weight matrix, reading and unpacking each weight once
+ * for the whole batch. Row b of the result is bit-identical to calling
+ * tinyaiSimdVecMatMul4BitAffine on row b of the input.
+ *
+ * @param out Output matrix [count x cols]
+ * @param weights 4-bit quantized weight matrix (packed)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul4BitAffine(float *out, const uint8_t *weights, const float *input, int count,
+                                int rows, int cols, float scale, float zeroPoint);
+
+/**
+ * @brief Column range of tinyaiSimdMatMul4BitAffine
+ *
+ * Computes only output columns [colBegin, colEnd) of every output row, so
+ * disjoint column ranges can be computed on different threads. When colBegin
+ * is a multiple of 16 the results are bit-identical to the full product.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 4-bit quantized weight matrix (packed)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul4BitAffineColumns(float *out, const uint8_t *weights, const float *input,
+                                       int count, int rows, int cols, int colBegin, int colEnd,
+                                       float scale, float zeroPoint);
+
+/**
+ * @brief Column range of a matrix multiplication for prepacked 4-bit weights
+ *
+ * Like tinyaiSimdMatMul4BitAffineColumns, for weights repacked into panels
+ * of 16 columns: panel p holds columns [16p, 16p + 16) for every row, 8
+ * bytes per row, where byte i carries column 16p + i in its low nibble and
+ * column 16p + 8 + i in its high nibble (columns past cols are padding).
+ * Each panel is accumulated in registers over all rows and stored once.
+ * The results do not depend on how the columns are split into ranges.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param panels 4-bit quantized weights in panels ((cols + 15) / 16 * rows * 8 bytes)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul4BitPanelsColumns(float *out, const uint8_t *panels, const float *input,
+                                       int count, int rows, int cols, int colBegin, int colEnd,
+                                       float scale, float zeroPoint);
+
+/**
+ * @brief Column range of a matrix multiplication for group-quantized 4-bit weights
+ *
+ * Like tinyaiSimdMatMul4BitAffineColumns, but each run of groupSize
+ * consecutive columns of a weight row has its own scale and zero point,
+ * stored row by row with (cols + groupSize - 1) / groupSize entries per
+ * row. The results do not depend on how the columns are split into ranges.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 4-bit quantized weight matrix (packed)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scales Dequantization scales per group
+ * @param zeroPoints Dequantization zero points per group
+ * @param groupSize Columns per group
+ */
+void tinyaiSimdMatMul4BitGroupedColumns(float *out, const uint8_t *weights, const float *input,
+                                        int count, int rows, int cols, int colBegin, int colEnd,
+                                        const float *scales, const float *zeroPoints,
+                                        int groupSize);
+
+/**
+ * @brief Column range of a matrix multiplication for codebook 4-bit weights
+ *
+ * Like tinyaiSimdMatMul4BitGroupedColumns, but a weight dequantizes to
+ * levels[q] * scale + zeroPoint for an arbitrary table of 16 levels rather
+ * than q * scale + zeroPoint. The table is held in registers and looked up
+ * with shuffles (pshufb, or vpermps with AVX-512), so it costs no more than
+ * converting the nibbles to floats. The results do not depend on how the
+ * columns are split into ranges.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 4-bit codebook indices (packed)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param levels Codebook of 16 levels
+ * @param scales Dequantization scales per group
+ * @param zeroPoints Dequantization zero points per group
+ * @param groupSize Columns per group
+ */
+void tinyaiSimdMatMul4BitCodebookColumns(float *out, const uint8_t *weights, const float *input,
+                                         int count, int rows, int cols, int colBegin,
+                                         int colEnd, const float *levels, const float *scales,
+                                         const float *zeroPoints, int groupSize);
+
+/**
+ * @brief Symmetric int8 quantization of a vector
+ *
+ * Maps in[i] to round(in[i] / scale) clamped to [-127, 127], where scale
+ * maps the largest magnitude to 127 (all zeros for an all-zero vector).
+ *
+ * @param out Output int8 array
+ * @param in Input float array
+ * @param size Number of values
+ * @return Scale such that in[i] is about out[i] * scale
+ */
+float tinyaiSimdQuantizeInt8(int8_t *out, const float *in, int size);
+
+/**
+ * @brief Fold the minimum and maximum of an array into *min and *max
+ *
+ * NaN values are skipped. Start from FLT_MAX and -FLT_MAX for a fresh
+ * reduction, or pass earlier results to continue one.
+ *
+ * @param in Input float array
+ * @param size Number of values
+ * @param min Running minimum (updated)
+ * @param max Running maximum (updated)
+ */
+void tinyaiSimdMinMax(const float *in, int size, float *min, float *max);
+
+/**
+ * @brief Affine 4-bit quantization in the TinyAIMatrix4bit layout
+ *
+ * Stores (int)((in[i] - zeroPoint) / scale + 0.5) clamped to [0, 15], two per
+ * byte with the high nibble first; an odd last value leaves the low nibble 0.
+ *
+ * @param out Output array of (size + 1) / 2 bytes
+ * @param in Input float array
+ * @param size Number of values
+ * @param scale Quantization scale
+ * @param zeroPoint Value mapped to level 0
+ */
+void tinyaiSimdQuantize4BitAffine(uint8_t *out, const float *in, int size, float scale,
+                                  float zeroPoint);
+
+/**
+ * @brief Affine 8-bit quantization in the TinyAIMatrix8bit layout
+ *
+ * Stores (int)((in[i] - zeroPoint) / scale + 0.5) clamped to [-127, 127].
+ *
+ * @param out Output int8 array
+ * @param in Input float array
+ * @param size Number of values
+ * @param scale Quantization scale
+ * @param zeroPoint Value mapped to level 0
+ */
+void tinyaiSimdQuantize8BitAffine(int8_t *out, const float *in, int size, float scale,
+                                  float zeroPoint);
+
+/**
+ * @brief Column range of a product of int8 activations and affine 4-bit weights
+ *
+ * Computes out[b][j] = inputScales[b] * sum_k x[b][k] * (q[k][j] * scale + zeroPoint)
+ * for j in [colBegin, colEnd), where x is the int8 input (see
+ * tinyaiSimdQuantizeInt8) and q the unsigned 4-bit weights in the
+ * TinyAIMatrix4bit layout. The sums over k are exact in int32 and are only
+ * rescaled at the end. The results do not depend on how the columns are
+ * split into ranges starting at multiples of 16.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 4-bit quantized weight matrix (packed)
+ * @param input Int8 input matrix [count x rows]
+ * @param inputScales Scale of each input vector [count]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul4BitInt8Columns(float *out, const uint8_t *weights, const int8_t *input,
+                                     const float *inputScales, int count, int rows, int cols,
+                                     int colBegin, int colEnd, float scale, float zeroPoint);
+
+/**
+ * @brief Column range of a product of int8 activations and affine 8-bit weights
+ *
+ * Like tinyaiSimdMatMul4BitInt8Columns, for signed 8-bit weights stored
+ * row-major (the TinyAIMatrix8bit layout).
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 8-bit quantized weight matrix
+ * @param input Int8 input matrix [count x rows]
+ * @param inputScales Scale of each input vector [count]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul8BitInt8Columns(float *out, const int8_t *weights, const int8_t *input,
+                                     const float *inputScales, int count, int rows, int cols,
+                                     int colBegin, int colEnd, float scale, float zeroPoint);
+
+/**
+ * @brief Product of symmetric 4-bit rows and an int8 vector
+ *
+ * The int8 counterpart of tinyaiSimdMatMul4Bit: out[row] =
+ * inputScale * scaleFactors[row] * sum_col (nibble - 8) * input[col],
+ * with the sums exact in int32.
+ *
+ * @param out Output vector [rows]
+ * @param weights 4-bit weights, low nibble first, (cols + 1) / 2 bytes per row
+ * @param input Int8 input vector [cols]
+ * @param inputScale Scale of the input vector
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param scaleFactors Scale factor of each row
+ */
+void tinyaiSimdMatMul4BitInt8(float *out, const uint8_t *weights, const int8_t *input,
+                              float inputScale, int rows, int cols, const float *scaleFactors);
+
+/**
+ * @brief SIMD-accelerated dequantization of affine 4-bit values
+ *
+ * Unpacks values packed two per byte, high nibble first, to q * scale + zeroPoint
+ * (the TinyAIMatrix4bit layout). The first value is the high nibble of in[0].
+ *
+ * @param out Output float array
+ * @param in Input 4-bit packed array
+ * @param size Number of values to unpack
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdDequantize4BitAffine(float *out, const uint8_t *in, int size, float scale,
+                                    float zeroPoint);
+
+/**
+ * @brief SIMD-accelerated dequantization of codebook 4-bit values
+ *
+ * Like tinyaiSimdDequantize4BitAffine, but unpacks to
+ * levels[q] * scale + zeroPoint, looking the levels up with pshufb.
+ *
+ * @param out Output float array
+ * @param in Input 4-bit packed array
+ * @param size Number of values to unpack
+ * @param levels Codebook of 16 levels
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdDequantize4BitCodebook(float *out, const uint8_t *in, int size,
+                                      const float *levels, float scale, float zeroPoint);
+
+/**
+ * @brief Convert floats to IEEE 754 half precision
+ *
+ * Rounds to nearest even; values beyond the half range become infinity and
+ * tiny values become subnormals. Uses F16C when available.
+ *
+ * @param out Output half precision bit patterns
+ * @param in Input float array
+ * @param size Number of values
+ */
+void tinyaiSimdConvertFP32ToFP16(uint16_t *out, const float *in, int size);
+
+/**
+ * @brief Convert IEEE 754 half precision values to floats (exact)
+ *
+ * @param out Output float array
+ * @param in Input half precision bit patterns
+ * @param size Number of values
+ */
+void tinyaiSimdConvertFP16ToFP32(float *out, const uint16_t *in, int size);
+
+/**
+ * @brief Convert floats to bfloat16
+ *
+ * Keeps the float exponent range and rounds the mantissa to 8 bits, nearest
+ * even; NaNs stay NaN. Uses AVX-512 BF16 or AVX2 when available.
+ *
+ * @param out Output bfloat16 bit patterns
+ * @param in Input float array
+ * @param size Number of values
+ */
+void tinyaiSimdConvertFP32ToBF16(uint16_t *out, const float *in, int size);
+
+/**
+ * @brief Convert bfloat16 values to floats (exact)
+ *
+ * @param out Output float array
+ * @param in Input bfloat16 bit patterns
+ * @param size Number of values
+ */
+void tinyaiSimdConvertBF16ToFP32(float *out, const uint16_t *in, int size);
+
+/**
+ * @brief Column range of a product of FP32 inputs and half precision weights
+ *
+ * Computes out[b][j] = sum_k input[b][k] * w[k][j] for j in [colBegin, colEnd),
+ * with the weights stored row-major as half precision and widened in
+ * registers (F16C) rather than converted to a float copy of the matrix.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights Half precision weight matrix [rows x cols]
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ */
+void tinyaiSimdMatMulFP16Columns(float *out, const uint16_t *weights, const float *input,
+                                 int count, int rows, int cols, int colBegin, int colEnd);
+
+/**
+ * @brief Column range of a product of FP32 inputs and affine 2-bit weights
+ *
+ * Computes out[b][j] = sum_k input[b][k] * (q[k][j] * scale + zeroPoint)
+ * for j in [colBegin, colEnd), where q in [-2, 1] is stored as two-bit two's
+ * complement, four per byte with the first value in the low bits, row-major
+ * over the whole matrix. The weights are unpacked in registers only.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 2-bit quantized weight matrix (packed)
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul2BitColumns(float *out, const uint8_t *weights, const float *input,
+                                 int count, int rows, int cols, int colBegin, int colEnd,
+                                 float scale, float zeroPoint);
+
+/**
+ * @brief Column range of a product of FP32 inputs and affine 8-bit weights
+ *
+ * Computes out[b][j] = sum_k input[b][k] * (q[k][j] * scale + zeroPoint)
+ * for j in [colBegin, colEnd), with signed 8-bit q stored row-major (the
+ * TinyAIMatrix8bit layout) and widened in registers only.
+ *
+ * @param out Output matrix [count x cols] (only the range is written)
+ * @param weights 8-bit quantized weight matrix
+ * @param input Input matrix [count x rows]
+ * @param count Number of input vectors
+ * @param rows Number of rows in the weight matrix
+ * @param cols Number of columns in the weight matrix
+ * @param colBegin First output column to compute
+ * @param colEnd One past the last output column to compute
+ * @param scale Dequantization scale
+ * @param zeroPoint Dequantization zero point
+ */
+void tinyaiSimdMatMul8BitAffineColumns(float *out, const int8_t *weights, const float *input,
+                                       int count, int rows, int cols, int colBegin, int colEnd,
+                                       float scale, float zeroPoint);
+
 /**
  * @brief SIMD-accelerated vector addition
  *
@@ -50,27 +518,301 @@ void tinyaiSimdMatMul4Bit(float *out, const uint8_t *weights, const float *input
  */
 void tinyaiSimdVecAdd(float *out, const float *a, const float *b, int size);
 
+/**
+ * @brief SIMD-accelerated scaled vector accumulation
+ *
+ * Computes out += alpha * x using SIMD instructions
+ *
+ * @param out Accumulated vector
+ * @param x Vector to scale
+ * @param alpha Scale factor
+ * @param size Vector size
+ */
+void tinyaiSimdVecScaleAdd(float *out, const float *x, float alpha, int size);
+
+/* Activation types accepted by tinyaiSimdActivate */
+#define TINYAI_SIMD_ACTIVATION_NONE -1 /* Only for fused epilogues; tinyaiSimdActivate ignores it */
+#define TINYAI_SIMD_ACTIVATION_RELU 0
+#define TINYAI_SIMD_ACTIVATION_GELU 1
+#define TINYAI_SIMD_ACTIVATION_SIGMOID 2
+#define TINYAI_SIMD_ACTIVATION_TANH 3
+#define TINYAI_SIMD_ACTIVATION_SILU 4
+#define TINYAI_SIMD_ACTIVATION_EXP 5
+
 /**
  * @brief SIMD-accelerated vector activation function
  *
- * Applies an activation function to a vector using SIMD instructions
+ * Applies an activation function to a vector using SIMD instructions. The
+ * vector paths evaluate exp with a range-reduced degree-6 polynomial
+ * (relative error ~2e-7) and build sigmoid, tanh, SiLU and the tanh form of
+ * GELU on top of it, so results stay within ~1e-6 of libm; exp saturates to
+ * zero and infinity outside its float range. Unknown types leave inout
+ * unchanged.
  *
  * @param inout Input/output vector
  * @param size Vector size
- * @param activationType Type of activation (0=ReLU, 1=GELU, 2=Sigmoid)
+ * @param activationType One of TINYAI_SIMD_ACTIVATION_*
  */
 void tinyaiSimdActivate(float *inout, int size, int activationType);
 
+/* Operations of a fused elementwise chain (TinyAIElementwiseOp.type) */
+#define TINYAI_SIMD_EW_BIAS 0       /* x += operand[col] */
+#define TINYAI_SIMD_EW_RESIDUAL 1   /* x += alpha * operand[row * cols + col] */
+#define TINYAI_SIMD_EW_MULTIPLY 2   /* x *= operand[row * cols + col] */
+#define TINYAI_SIMD_EW_SCALE 3      /* x = x * alpha + beta */
+#define TINYAI_SIMD_EW_ACTIVATION 4 /* x = activation(x), as tinyaiSimdActivate */
+#define TINYAI_SIMD_EW_CLAMP 5      /* x = min(max(x, alpha), beta) */
+#define TINYAI_SIMD_EW_QUANTIZE 6   /* x = q * alpha with q = round(x / alpha) in [-127, 127] */
+
+/* Longest chain accepted by tinyaiSimdElementwise */
+#define TINYAI_SIMD_ELEMENTWISE_MAX_OPS 8
+
+/**
+ * One operation of a fused elementwise chain
+ */
+typedef struct {
+    int          type;       /* TINYAI_SIMD_EW_* */
+    int          activation; /* TINYAI_SIMD_ACTIVATION_* for TINYAI_SIMD_EW_ACTIVATION */
+    const float *operand;    /* Bias [cols], or residual / multiplier [rows x cols] */
+    int8_t      *quantized;  /* Levels q of TINYAI_SIMD_EW_QUANTIZE [rows x cols], or NULL */
+    float        alpha;
+    float        beta;
+} TinyAIElementwiseOp;
+
+/**
+ * @brief Apply a chain of elementwise operations in a single pass
+ *
+ * Each vector of the input is loaded once, run through every operation in
+ * order while it stays in registers, and stored once, instead of one pass
+ * over memory per operation. Results match running the operations one after
+ * another with the other tinyaiSimd* kernels.
+ *
+ * @param out Output matrix [rows x cols] (can be same as in)
+ * @param in Input matrix [rows x cols]
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param ops Operations, applied in order
+ * @param numOps Number of operations (0 to TINYAI_SIMD_ELEMENTWISE_MAX_OPS)
+ * @return 0 on success, -1 on invalid arguments
+ */
+int tinyaiSimdElementwise(float *out, const float *in, int rows, int cols,
+                          const TinyAIElementwiseOp *ops, int numOps);
+
+/**
+ * @brief SIMD-accelerated softmax
+ *
+ * Converts a vector of logits to probabilities in place, subtracting the
+ * maximum first for numerical stability
+ *
+ * @param inout Input logits / output probabilities
+ * @param size Vector size
+ */
+void tinyaiSimdSoftmax(float *inout, int size);
+
+/**
+ * @brief SIMD-accelerated softmax with temperature
+ *
+ * Computes out = softmax(in / temperature). The temperature is folded into
+ * the exponential pass, so scaling the logits first is unnecessary.
+ * Non-positive temperatures are treated as 1.
+ *
+ * @param out Output probabilities (can be same as in)
+ * @param in Input logits
+ * @param size Vector size
+ * @param temperature Softmax temperature
+ */
+void tinyaiSimdSoftmaxTemperature(float *out, const float *in, int size, float temperature);
+
+/**
+ * @brief SIMD-accelerated maximum reduction
+ *
+ * @param x Input vector
+ * @param size Vector size
+ * @return Largest element, or -INFINITY for an empty vector
+ */
+float tinyaiSimdReduceMax(const float *x, int size);
+
+/**
+ * @brief SIMD-accelerated sum reduction
+ *
+ * @param x Input vector
+ * @param size Vector size
+ * @return Sum of the elements (summation order depends on the vector width)
+ */
+float tinyaiSimdReduceSum(const float *x, int size);
+
+/**
+ * @brief SIMD-accelerated dot product
+ *
+ * @param a First vector
+ * @param b Second vector
+ * @param size Vector size
+ * @return Sum of the elementwise products (summation order depends on the vector width)
+ */
+float tinyaiSimdDot(const float *a, const float *b, int size);
+
+/**
+ * @brief Dot product of two int8 vectors
+ *
+ * Exact in 32-bit integers for vectors of up to 2^17 values in [-127, 127],
+ * as tinyaiSimdQuantizeInt8 produces; neither vector may hold -128.
+ *
+ * @param a First vector
+ * @param b Second vector
+ * @param size Number of values
+ * @return Sum of a[i] * b[i]
+ */
+int32_t tinyaiSimdDotInt8(const int8_t *a, const int8_t *b, int size);
+
+/**
+ * @brief Exclude the logits of tokens a bitmask does not allow
+ *
+ * Bit i % 32 of word i / 32 of the mask keeps logits[i]; every logit whose
+ * bit is clear becomes -INFINITY, so softmax gives it no probability.
+ *
+ * @param logits Logits to mask in place
+ * @param mask Allowed tokens, one bit each ((size + 31) / 32 words)
+ * @param size Number of logits
+ */
+void tinyaiSimdMaskLogits(float *logits, const uint32_t *mask, int size);
+
+/**
+ * @brief Low-rank update of a batch of rows
+ *
+ * Computes out += scale * (in * down^T) * up one row at a time, as rank dot
+ * products against the rows of down and rank scaled additions of the rows of
+ * up, so it costs rank * (inSize + outSize) per row next to the full
+ * inSize * outSize of the product it corrects (LoRA adapters).
+ *
+ * @param out Output rows [rows x outSize], updated in place
+ * @param in Input rows [rows x inSize]
+ * @param rows Number of rows
+ * @param inSize Input size
+ * @param outSize Output size
+ * @param down Down-projection [rank x inSize]
+ * @param up Up-projection [rank x outSize]
+ * @param rank Rank of the update
+ * @param scale Scale of the update
+ */
+void tinyaiSimdLowRankAdd(float *out, const float *in, int rows, int inSize, int outSize,
+                          const float *down, const float *up, int rank, float scale);
+
+/**
+ * @brief SIMD-accelerated conversion of interleaved 16-bit PCM to mono floats
+ *
+ * Each output sample is the average of one frame's channels, scaled to
+ * [-1, 1), so multichannel audio is downmixed in the same pass. Mono and
+ * stereo have vector paths.
+ *
+ * @param input Interleaved samples [frames x channels]
+ * @param channels Channels per frame
+ * @param frames Number of frames
+ * @param output Mono samples [frames]
+ */
+void tinyaiSimdPCM16ToMono(const int16_t *input, int channels, int frames, float *output);
+
+/**
+ * @brief SIMD-accelerated zero-crossing count
+ *
+ * Counts the adjacent pairs of samples on opposite sides of zero, taking
+ * x < 0 as the sign, so the count is exact on every path.
+ *
+ * @param x Input samples
+ * @param size Number of samples
+ * @return Number of zero crossings, 0 for fewer than two samples
+ */
+int tinyaiSimdCountZeroCrossings(const float *x, int size);
+
+/* Byte classes accepted by tinyaiSimdByteRunLength */
+#define TINYAI_SIMD_BYTES_WORD 0  /* ASCII letters and digits, apostrophe and hyphen */
+#define TINYAI_SIMD_BYTES_SPACE 1 /* Space, tab, newline, vertical tab, form feed, return */
+
+/**
+ * @brief SIMD-accelerated length of a run of bytes of one class
+ *
+ * Classifies 16 or 32 bytes per step, so a pre-tokenizer finds the end of
+ * a word or of the whitespace after it without a branch per byte. Bytes
+ * of 0x80 and above, the bytes of multi-byte UTF-8 characters, belong to
+ * neither class, and neither does NUL.
+ *
+ * @param text Text to scan
+ * @param length Bytes of text to scan at most
+ * @param byteClass One of TINYAI_SIMD_BYTES_*
+ * @return Number of leading bytes in the class
+ */
+size_t tinyaiSimdByteRunLength(const char *text, size_t length, int byteClass);
+
+/**
+ * @brief SIMD-accelerated argmax
+ *
+ * @param x Input vector
+ * @param size Vector size
+ * @return Index of the first largest element, or -1 for an empty vector
+ */
+int tinyaiSimdArgmax(const float *x, int size);
+
+/**
+ * @brief SIMD-accelerated shifted exponentials and their sum
+ *
+ * Computes out[i] = exp((x[i] - shift) * scale) and returns the sum of the
+ * results. This is the inner pass of softmax and log-sum-exp; the vector paths
+ * assume (x[i] - shift) * scale <= 0, as with shift = max(x) and a positive
+ * scale, and flush results below exp(-87) to zero.
+ *
+ * @param out Output exponentials (can be same as x, or NULL to only sum)
+ * @param x Input vector
+ * @param shift Value subtracted before scaling
+ * @param scale Factor applied after the shift
+ * @param size Vector size
+ * @return Sum of the exponentials
+ */
+float tinyaiSimdExpSum(float *out, const float *x, float shift, float scale, int size);
+
+/**
+ * @brief SIMD-accelerated log-sum-exp
+ *
+ * Computes log(sum(exp(x))) without overflow by shifting by the maximum.
+ *
+ * @param x Input vector
+ * @param size Vector size
+ * @return log-sum-exp of x, or -INFINITY for an empty or all -INFINITY vector
+ */
+float tinyaiSimdLogSumExp(const float *x, int size);
+
+/**
+ * @brief SIMD-accelerated layer normalization with optional residual add and activation
+ *
+ * Normalizes x = input + residual to zero mean and unit variance, computing
+ * both statistics in a single Welford pass, then applies
+ * out = act(x_hat * gamma + beta). out may alias input or residual.
+ *
+ * @param out Output vector
+ * @param input Input vector
+ * @param residual Residual added to the input before normalizing (NULL for none)
+ * @param gamma Per-element scale (NULL for 1)
+ * @param beta Per-element shift (NULL for 0)
+ * @param size Vector size
+ * @param epsilon Added to the variance before the square root
+ * @param activationType Activation as in tinyaiSimdActivate (-1 for none)
+ */
+void tinyaiSimdLayerNorm(float *out, const float *input, const float *residual, const float *gamma,
+                         const float *beta, int size, float epsilon, int activationType);
+
 /**
  * @brief SIMD-accelerated matrix-matrix multiplication for 4-bit weights
  *
- * @param out Output matrix
- * @param a 4-bit quantized matrix (packed)
- * @param b Input matrix
+ * Computes out = dequant(A) * B as a cache-blocked GEMM: panels of A and B
+ * are packed per block and multiplied by a register-blocked microkernel,
+ * and the output tiles are split across the shared thread pool. The result
+ * does not depend on the number of threads.
+ *
+ * @param out Output matrix [rowsA x colsB], row-major
+ * @param a 4-bit quantized matrix (packed), low nibble first, (colsA + 1) / 2 bytes per row
+ * @param b Input matrix [colsA x colsB], row-major
  * @param rowsA Number of rows in matrix A
  * @param colsA Number of columns in matrix A
  * @param colsB Number of columns in matrix B
- * @param scaleFactors Scale factors for dequantizing weights
+ * @param scaleFactors Scale factor of each row of A
  */
 void tinyaiSimdMatMul4BitMM(float *out, const uint8_t *a, const float *b, int rowsA, int colsA,
                             int colsB, const float *scaleFactors);
@@ -97,9 +839,99 @@ void tinyaiSimdDequantize4Bit(float *out, const uint8_t *in, int size, const flo
 void tinyaiSimdQuantize4Bit(uint8_t *out, const float *in, int size, float *scaleFactors,
                             int blockSize);
 
+/* Convolution algorithms for tinyaiSimdCreateConvPlan */
+#define TINYAI_SIMD_CONV_AUTO -1        /* Pick by layer shape with tinyaiSimdSelectConvAlgorithm */
+#define TINYAI_SIMD_CONV_DIRECT 0       /* Direct loops over the kernel window */
+#define TINYAI_SIMD_CONV_IM2COL_GEMM 1  /* Patches unrolled into a matrix for the blocked GEMM */
+#define TINYAI_SIMD_CONV_WINOGRAD_F2 2  /* Winograd F(2x2, 3x3), 3x3 stride-1 kernels only */
+#define TINYAI_SIMD_CONV_WINOGRAD_F4 3  /* Winograd F(4x4, 3x3), 3x3 stride-1 kernels only */
+
+/**
+ * Convolution layer with its algorithm chosen and weights transformed (opaque)
+ */
+typedef struct TinyAIConvPlan TinyAIConvPlan;
+
+/**
+ * @brief Pick the convolution algorithm for a layer shape
+ *
+ * 3x3 stride-1 layers with at least 16 input and output channels use
+ * Winograd, F(4x4, 3x3) when it needs fewer transformed-domain products
+ * than F(2x2, 3x3) after rounding the output up to whole tiles. Other
+ * layers with 16 or more output channels and positions use im2col with the
+ * blocked GEMM, and the rest the direct loops.
+ *
+ * @param inChannels Number of input channels
+ * @param outWidth Width of output feature map
+ * @param outHeight Height of output feature map
+ * @param outChannels Number of output channels
+ * @param kernelSize Size of the convolution kernel
+ * @param stride Stride of the convolution
+ * @return One of TINYAI_SIMD_CONV_DIRECT, _IM2COL_GEMM, _WINOGRAD_F2 or _WINOGRAD_F4
+ */
+int tinyaiSimdSelectConvAlgorithm(int inChannels, int outWidth, int outHeight, int outChannels,
+                                  int kernelSize, int stride);
+
+/**
+ * @brief Prepare a 4-bit convolution layer for repeated use
+ *
+ * Chooses the algorithm and transforms the weights once: im2col regroups
+ * them as one 4-bit row per output channel, and Winograd expands them to
+ * floats in the transformed domain ((tile + 2)^2 floats per input and
+ * output channel pair). The plan keeps its own copy of everything it needs.
+ *
+ * @param weights 4-bit quantized weights (kernelSize x kernelSize x inChannels x outChannels)
+ * @param scaleFactors Scale factor of each output channel
+ * @param inWidth Width of input feature map
+ * @param inHeight Height of input feature map
+ * @param inChannels Number of input channels
+ * @param outWidth Width of output feature map
+ * @param outHeight Height of output feature map
+ * @param outChannels Number of output channels
+ * @param kernelSize Size of the convolution kernel (assuming square kernel)
+ * @param stride Stride of the convolution
+ * @param padding Padding size
+ * @param algorithm One of TINYAI_SIMD_CONV_*, or TINYAI_SIMD_CONV_AUTO
+ * @return Plan (free with tinyaiSimdDestroyConvPlan), or NULL on error or when Winograd is
+ *         requested for a layer that is not 3x3 stride-1
+ */
+TinyAIConvPlan *tinyaiSimdCreateConvPlan(const uint8_t *weights, const float *scaleFactors,
+                                         int inWidth, int inHeight, int inChannels, int outWidth,
+                                         int outHeight, int outChannels, int kernelSize,
+                                         int stride, int padding, int algorithm);
+
+/**
+ * @brief Run a prepared convolution layer
+ *
+ * @param plan Plan from tinyaiSimdCreateConvPlan
+ * @param output Output feature map (outHeight x outWidth x outChannels)
+ * @param input Input feature map (inHeight x inWidth x inChannels)
+ * @param biases Bias values for each output channel (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int tinyaiSimdRunConvPlan(const TinyAIConvPlan *plan, float *output, const float *input,
+                          const float *biases);
+
+/**
+ * @brief Get the algorithm a plan runs
+ *
+ * @param plan Plan from tinyaiSimdCreateConvPlan
+ * @return One of TINYAI_SIMD_CONV_DIRECT, _IM2COL_GEMM, _WINOGRAD_F2 or _WINOGRAD_F4
+ */
+int tinyaiSimdConvPlanAlgorithm(const TinyAIConvPlan *plan);
+
+/**
+ * @brief Free a convolution plan
+ *
+ * @param plan Plan to free (may be NULL)
+ */
+void tinyaiSimdDestroyConvPlan(TinyAIConvPlan *plan);
+
 /**
  * @brief SIMD-accelerated 2D convolution with 4-bit quantized weights
  *
+ * Runs the algorithm tinyaiSimdSelectConvAlgorithm picks, preparing its
+ * weights on every call.
+ *
  * @param output Output feature map (outHeight x outWidth x outChannels)
  * @param input Input feature map (inHeight x inWidth x inChannels)
  * @param weights 4-bit quantized weights (kernelSize x kernelSize x inChannels x outChannels)
@@ -143,6 +975,141 @@ void tinyaiSimdDepthwiseConv2d4Bit(float *output, const float *input, const uint
                                    int inHeight, int inChannels, int outWidth, int outHeight,
                                    int multiplier, int kernelSize, int stride, int padding);
 
+/* Channels per block in the channel-blocked (NCHWc) activation layout */
+#define TINYAI_SIMD_CHANNEL_BLOCK 8
+
+/**
+ * @brief Number of floats a feature map takes in the channel-blocked layout
+ *
+ * The layout stores ceil(channels / TINYAI_SIMD_CHANNEL_BLOCK) blocks, each
+ * a height x width plane of TINYAI_SIMD_CHANNEL_BLOCK consecutive channels;
+ * channels past the last real one are padding.
+ *
+ * @param width Width of the feature map
+ * @param height Height of the feature map
+ * @param channels Number of channels
+ * @return Number of floats, padding included
+ */
+size_t tinyaiSimdBlockedSize(int width, int height, int channels);
+
+/**
+ * @brief Convert a feature map from height x width x channels to the channel-blocked layout
+ *
+ * @param dst Output (tinyaiSimdBlockedSize floats); padded channels are set to zero
+ * @param src Input feature map (height x width x channels)
+ * @param width Width of the feature map
+ * @param height Height of the feature map
+ * @param channels Number of channels
+ */
+void tinyaiSimdToChannelBlocked(float *dst, const float *src, int width, int height, int channels);
+
+/**
+ * @brief Convert a feature map from the channel-blocked layout to height x width x channels
+ *
+ * @param dst Output feature map (height x width x channels)
+ * @param src Input in the channel-blocked layout; padded channels are ignored
+ * @param width Width of the feature map
+ * @param height Height of the feature map
+ * @param channels Number of channels
+ */
+void tinyaiSimdFromChannelBlocked(float *dst, const float *src, int width, int height,
+                                  int channels);
+
+/**
+ * @brief Dequantize convolution weights for tinyaiSimdConv2dBlocked
+ *
+ * @param weights 4-bit quantized weights (kernelSize x kernelSize x inChannels x outChannels)
+ * @param scaleFactors Scale factor of each output channel
+ * @param inChannels Number of input channels
+ * @param outChannels Number of output channels
+ * @param kernelSize Size of the convolution kernel
+ * @return Packed weights (free with free()), or NULL on error
+ */
+float *tinyaiSimdPackBlockedConvWeights(const uint8_t *weights, const float *scaleFactors,
+                                        int inChannels, int outChannels, int kernelSize);
+
+/**
+ * @brief Dequantize depthwise weights (multiplier 1) for tinyaiSimdDepthwiseConv2dBlocked
+ *
+ * @param weights 4-bit quantized weights (kernelSize x kernelSize x channels)
+ * @param scaleFactors Scale factor of each channel
+ * @param channels Number of channels
+ * @param kernelSize Size of the convolution kernel
+ * @return Packed weights (free with free()), or NULL on error
+ */
+float *tinyaiSimdPackBlockedDepthwiseWeights(const uint8_t *weights, const float *scaleFactors,
+                                             int channels, int kernelSize);
+
+/* Pooling fused after a channel-blocked convolution */
+#define TINYAI_SIMD_POOL_NONE 0
+#define TINYAI_SIMD_POOL_MAX 1
+#define TINYAI_SIMD_POOL_AVERAGE 2
+
+/**
+ * Work applied to the output of a channel-blocked convolution before it is
+ * stored: an activation, then optionally pooling over unpadded
+ * poolKernel x poolKernel windows. Each row is finished while it is still
+ * in cache, and with pooling the unpooled map is never written out.
+ */
+typedef struct {
+    int activation; /* TINYAI_SIMD_ACTIVATION_*, or TINYAI_SIMD_ACTIVATION_NONE */
+    int poolType;   /* TINYAI_SIMD_POOL_NONE, _MAX or _AVERAGE */
+    int poolKernel; /* Pooling window size */
+    int poolStride; /* Pooling stride */
+} TinyAIBlockedEpilogue;
+
+/**
+ * @brief 2D convolution on channel-blocked feature maps
+ *
+ * Every multiply-add works on a full block of output channels. Padded
+ * output channels are written as zero before the epilogue.
+ *
+ * @param output Output feature map in the channel-blocked layout, pooled if the epilogue pools
+ * @param input Input feature map in the channel-blocked layout
+ * @param packedWeights Weights from tinyaiSimdPackBlockedConvWeights
+ * @param biases Bias values for each output channel (may be NULL)
+ * @param inWidth Width of input feature map
+ * @param inHeight Height of input feature map
+ * @param inChannels Number of input channels
+ * @param outWidth Width of output feature map
+ * @param outHeight Height of output feature map
+ * @param outChannels Number of output channels
+ * @param kernelSize Size of the convolution kernel (assuming square kernel)
+ * @param stride Stride of the convolution
+ * @param padding Padding size
+ * @param epilogue Activation and pooling to fuse (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int tinyaiSimdConv2dBlocked(float *output, const float *input, const float *packedWeights,
+                            const float *biases, int inWidth, int inHeight, int inChannels,
+                            int outWidth, int outHeight, int outChannels, int kernelSize,
+                            int stride, int padding, const TinyAIBlockedEpilogue *epilogue);
+
+/**
+ * @brief Depthwise convolution (multiplier 1) on channel-blocked feature maps
+ *
+ * Every multiply-add works on a full block of channels.
+ *
+ * @param output Output feature map in the channel-blocked layout, pooled if the epilogue pools
+ * @param input Input feature map in the channel-blocked layout
+ * @param packedWeights Weights from tinyaiSimdPackBlockedDepthwiseWeights
+ * @param biases Bias values for each channel (may be NULL)
+ * @param inWidth Width of input feature map
+ * @param inHeight Height of input feature map
+ * @param channels Number of channels
+ * @param outWidth Width of output feature map
+ * @param outHeight Height of output feature map
+ * @param kernelSize Size of the convolution kernel (assuming square kernel)
+ * @param stride Stride of the convolution
+ * @param padding Padding size
+ * @param epilogue Activation and pooling to fuse (may be NULL)
+ * @return 0 on success, -1 on error
+ */
+int tinyaiSimdDepthwiseConv2dBlocked(float *output, const float *input, const float *packedWeights,
+                                     const float *biases, int inWidth, int inHeight, int channels,
+                                     int outWidth, int outHeight, int kernelSize, int stride,
+                                     int padding, const TinyAIBlockedEpilogue *epilogue);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,794 @@
+/**
+ * @file simd_ops_blocked.c
+ * @brief Convolution kernels for the channel-blocked (NCHWc) activation layout
+ *
+ * A feature map in this layout is a sequence of channel blocks, each an
+ * H x W plane of TINYAI_SIMD_CHANNEL_BLOCK consecutive channels, with the
+ * last block padded by zeros. One pixel of a block is exactly one vector
+ * (an AVX2 register, or two SSE2/NEON registers), so the depthwise kernel
+ * multiplies whole vectors of channels by a vector of weights, and the
+ * regular kernel broadcasts an input value against a vector of output
+ * channels. Weights are dequantized once into matching blocks.
+ *
+ * Both kernels run an epilogue on each output row while it is in cache:
+ * the activation, and optionally pooling, for which a task computes the
+ * rows under one row of pooling windows into a scratch buffer and writes
+ * only the pooled values.
+ */
+
+#include "simd_ops.h"
+#include "thread_pool.h"
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* SIMD detection and platform-specific includes */
+#if defined(_MSC_VER)
+/* Windows/MSVC */
+#include <intrin.h>
+#define HAS_SSE2_SUPPORT 1
+#if (_MSC_VER >= 1700) /* Visual Studio 2012 and later */
+#include <immintrin.h>
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2
+#endif
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/* GCC/Clang on x86 */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAS_SSE2_SUPPORT 1
+#endif
+/* The AVX2 kernels are compiled with their own target and picked at runtime */
+#if defined(__clang__) || __GNUC__ >= 5
+#include <immintrin.h>
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* AArch64: NEON is part of the base architecture */
+#include <arm_neon.h>
+#define HAS_NEON_SUPPORT 1
+#endif
+
+#define CB TINYAI_SIMD_CHANNEL_BLOCK
+
+/* Output pixels of one row computed together by the regular convolution */
+#define BLOCKED_CONV_PIXELS 4
+#define BLOCKED_CONV_PIXELS_AVX2 8
+
+/* Input read for pixels that fall into the padding */
+static const float g_zeroBlock[CB] = {0.0f};
+
+static int channelBlocks(int channels) { return (channels + CB - 1) / CB; }
+
+size_t tinyaiSimdBlockedSize(int width, int height, int channels)
+{
+    return (size_t)channelBlocks(channels) * width * height * CB;
+}
+
+void tinyaiSimdToChannelBlocked(float *dst, const float *src, int width, int height, int channels)
+{
+    int    blocks = channelBlocks(channels);
+    size_t pixels = (size_t)width * height;
+
+    for (int b = 0; b < blocks; b++) {
+        int    first = b * CB;
+        int    count = channels - first < CB ? channels - first : CB;
+        float *plane = dst + (size_t)b * pixels * CB;
+
+        for (size_t p = 0; p < pixels; p++) {
+            const float *pixel = src + p * channels + first;
+            for (int c = 0; c < count; c++) {
+                plane[p * CB + c] = pixel[c];
+            }
+            for (int c = count; c < CB; c++) {
+                plane[p * CB + c] = 0.0f;
+            }
+        }
+    }
+}
+
+void tinyaiSimdFromChannelBlocked(float *dst, const float *src, int width, int height,
+                                  int channels)
+{
+    int    blocks = channelBlocks(channels);
+    size_t pixels = (size_t)width * height;
+
+    for (int b = 0; b < blocks; b++) {
+        int          first = b * CB;
+        int          count = channels - first < CB ? channels - first : CB;
+        const float *plane = src + (size_t)b * pixels * CB;
+
+        for (size_t p = 0; p < pixels; p++) {
+            float *pixel = dst + p * channels + first;
+            for (int c = 0; c < count; c++) {
+                pixel[c] = plane[p * CB + c];
+            }
+        }
+    }
+}
+
+/* Dequantize one 4-bit weight of the (kernel x kernel x inChannels x outChannels) layout */
+static float blockedWeight(const uint8_t *weights, size_t index, float scale)
+{
+    uint8_t packed = weights[index / 2];
+    int     q      = (index % 2 == 0 ? packed & 0x0F : packed >> 4) - 8;
+    return (float)q * scale;
+}
+
+float *tinyaiSimdPackBlockedConvWeights(const uint8_t *weights, const float *scaleFactors,
+                                        int inChannels, int outChannels, int kernelSize)
+{
+    if (!weights || !scaleFactors || inChannels <= 0 || outChannels <= 0 || kernelSize <= 0) {
+        return NULL;
+    }
+
+    /* [outBlock][kh][kw][inChannel padded to whole blocks][CB] */
+    int    inPadded = channelBlocks(inChannels) * CB;
+    int    taps     = kernelSize * kernelSize;
+    size_t count    = (size_t)channelBlocks(outChannels) * taps * inPadded * CB;
+    float *packed   = (float *)calloc(count, sizeof(float));
+    if (!packed) {
+        return NULL;
+    }
+
+    for (int oc = 0; oc < outChannels; oc++) {
+        float *block = packed + (size_t)(oc / CB) * taps * inPadded * CB + oc % CB;
+        for (int t = 0; t < taps; t++) {
+            for (int ic = 0; ic < inChannels; ic++) {
+                size_t index = ((size_t)t * inChannels + ic) * outChannels + oc;
+                block[((size_t)t * inPadded + ic) * CB] =
+                    blockedWeight(weights, index, scaleFactors[oc]);
+            }
+        }
+    }
+
+    return packed;
+}
+
+float *tinyaiSimdPackBlockedDepthwiseWeights(const uint8_t *weights, const float *scaleFactors,
+                                             int channels, int kernelSize)
+{
+    if (!weights || !scaleFactors || channels <= 0 || kernelSize <= 0) {
+        return NULL;
+    }
+
+    /* [block][kh][kw][CB] */
+    int    taps   = kernelSize * kernelSize;
+    float *packed = (float *)calloc((size_t)channelBlocks(channels) * taps * CB, sizeof(float));
+    if (!packed) {
+        return NULL;
+    }
+
+    for (int c = 0; c < channels; c++) {
+        float *block = packed + (size_t)(c / CB) * taps * CB + c % CB;
+        for (int t = 0; t < taps; t++) {
+            block[t * CB] = blockedWeight(weights, (size_t)t * channels + c, scaleFactors[c]);
+        }
+    }
+
+    return packed;
+}
+
+/* Shape and operands of one blocked convolution, shared by its row tasks */
+typedef struct BlockedConvTask {
+    float       *output;
+    const float *input;
+    const float *weights;
+    const float *biases;
+    int          inWidth;
+    int          inHeight;
+    int          inChannels;
+    int          outWidth;
+    int          outHeight;
+    int          outChannels;
+    int          kernelSize;
+    int          stride;
+    int          padding;
+
+    /* Epilogue applied to every row while it is still in cache */
+    int          activation;
+    int          poolType;
+    int          poolKernel;
+    int          poolStride;
+    int          pooledWidth;
+    int          pooledHeight;
+    bool         failed;
+
+    /* Computes one output row of a channel block */
+    void (*row)(const struct BlockedConvTask *task, int block, int oh, float *out);
+} BlockedConvTask;
+
+/* Bias of the output channel block, zero on the padded channels */
+static void blockedBias(float bias[CB], const float *biases, int block, int channels)
+{
+    for (int c = 0; c < CB; c++) {
+        int channel = block * CB + c;
+        bias[c]     = biases && channel < channels ? biases[channel] : 0.0f;
+    }
+}
+
+/*
+ * Point every pixel of a row tile at its input for kernel column kw, or at
+ * the zero block when it falls into the padding (which then does not
+ * advance from one input channel block to the next).
+ */
+static void blockedTapInputs(const BlockedConvTask *task, const float *row, int ow, int kw,
+                             int pixels, const float **inputs, size_t *steps)
+{
+    size_t plane = (size_t)task->inWidth * task->inHeight * CB;
+
+    for (int j = 0; j < pixels; j++) {
+        int iw = (ow + j) * task->stride - task->padding + kw;
+        if (ow + j < task->outWidth && iw >= 0 && iw < task->inWidth) {
+            inputs[j] = row + (size_t)iw * CB;
+            steps[j]  = plane;
+        }
+        else {
+            inputs[j] = g_zeroBlock;
+            steps[j]  = 0;
+        }
+    }
+}
+
+static void blockedConvRowReference(const BlockedConvTask *task, int ob, int oh, float *out)
+{
+    int          inBlocks = channelBlocks(task->inChannels);
+    int          taps     = task->kernelSize * task->kernelSize;
+    const float *weights  = task->weights + (size_t)ob * taps * inBlocks * CB * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, ob, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow++) {
+        float sum[CB];
+        memcpy(sum, bias, sizeof(sum));
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                int iw = ow * task->stride - task->padding + kw;
+                if (iw < 0 || iw >= task->inWidth) {
+                    continue;
+                }
+
+                const float *w  = weights + (size_t)(kh * task->kernelSize + kw) * inBlocks * CB * CB;
+                const float *in = task->input + ((size_t)ih * task->inWidth + iw) * CB;
+                for (int ib = 0; ib < inBlocks; ib++) {
+                    for (int i = 0; i < CB; i++, w += CB) {
+                        for (int c = 0; c < CB; c++) {
+                            sum[c] += in[i] * w[c];
+                        }
+                    }
+                    in += (size_t)task->inWidth * task->inHeight * CB;
+                }
+            }
+        }
+
+        memcpy(out + (size_t)ow * CB, sum, sizeof(sum));
+    }
+}
+
+#if defined(HAS_AVX2_SUPPORT)
+TINYAI_TARGET_AVX2 static void blockedConvRowAVX2(const BlockedConvTask *task, int ob, int oh,
+                                                  float *out)
+{
+    int          inBlocks = channelBlocks(task->inChannels);
+    int          taps     = task->kernelSize * task->kernelSize;
+    const float *weights  = task->weights + (size_t)ob * taps * inBlocks * CB * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, ob, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow += BLOCKED_CONV_PIXELS_AVX2) {
+        /* One accumulator per pixel of the tile, named so they stay in registers */
+        __m256 s0 = _mm256_loadu_ps(bias), s1 = s0, s2 = s0, s3 = s0;
+        __m256 s4 = s0, s5 = s0, s6 = s0, s7 = s0;
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            const float *row = task->input + (size_t)ih * task->inWidth * CB;
+
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                const float *in[BLOCKED_CONV_PIXELS_AVX2];
+                size_t       step[BLOCKED_CONV_PIXELS_AVX2];
+                blockedTapInputs(task, row, ow, kw, BLOCKED_CONV_PIXELS_AVX2, in, step);
+
+                const float *w = weights + (size_t)(kh * task->kernelSize + kw) * inBlocks * CB * CB;
+                for (int ib = 0; ib < inBlocks; ib++) {
+                    for (int i = 0; i < CB; i++, w += CB) {
+                        __m256 wv = _mm256_loadu_ps(w);
+                        s0        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[0] + i), wv, s0);
+                        s1        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[1] + i), wv, s1);
+                        s2        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[2] + i), wv, s2);
+                        s3        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[3] + i), wv, s3);
+                        s4        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[4] + i), wv, s4);
+                        s5        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[5] + i), wv, s5);
+                        s6        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[6] + i), wv, s6);
+                        s7        = _mm256_fmadd_ps(_mm256_broadcast_ss(in[7] + i), wv, s7);
+                    }
+                    for (int j = 0; j < BLOCKED_CONV_PIXELS_AVX2; j++) {
+                        in[j] += step[j];
+                    }
+                }
+            }
+        }
+
+        __m256 sum[BLOCKED_CONV_PIXELS_AVX2] = {s0, s1, s2, s3, s4, s5, s6, s7};
+        int    count = task->outWidth - ow < BLOCKED_CONV_PIXELS_AVX2 ? task->outWidth - ow
+                                                                      : BLOCKED_CONV_PIXELS_AVX2;
+        for (int j = 0; j < count; j++) {
+            _mm256_storeu_ps(out + (size_t)(ow + j) * CB, sum[j]);
+        }
+    }
+}
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+static void blockedConvRowSSE2(const BlockedConvTask *task, int ob, int oh, float *out)
+{
+    int          inBlocks = channelBlocks(task->inChannels);
+    int          taps     = task->kernelSize * task->kernelSize;
+    const float *weights  = task->weights + (size_t)ob * taps * inBlocks * CB * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, ob, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow += BLOCKED_CONV_PIXELS) {
+        /* Channels 0-3 and 4-7 of every pixel of the tile */
+        __m128 l0 = _mm_loadu_ps(bias), l1 = l0, l2 = l0, l3 = l0;
+        __m128 h0 = _mm_loadu_ps(bias + 4), h1 = h0, h2 = h0, h3 = h0;
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            const float *row = task->input + (size_t)ih * task->inWidth * CB;
+
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                const float *in[BLOCKED_CONV_PIXELS];
+                size_t       step[BLOCKED_CONV_PIXELS];
+                blockedTapInputs(task, row, ow, kw, BLOCKED_CONV_PIXELS, in, step);
+
+                const float *w = weights + (size_t)(kh * task->kernelSize + kw) * inBlocks * CB * CB;
+                for (int ib = 0; ib < inBlocks; ib++) {
+                    for (int i = 0; i < CB; i++, w += CB) {
+                        __m128 wLo = _mm_loadu_ps(w);
+                        __m128 wHi = _mm_loadu_ps(w + 4);
+                        __m128 x0 = _mm_set1_ps(in[0][i]), x1 = _mm_set1_ps(in[1][i]);
+                        __m128 x2 = _mm_set1_ps(in[2][i]), x3 = _mm_set1_ps(in[3][i]);
+                        l0         = _mm_add_ps(l0, _mm_mul_ps(x0, wLo));
+                        h0         = _mm_add_ps(h0, _mm_mul_ps(x0, wHi));
+                        l1         = _mm_add_ps(l1, _mm_mul_ps(x1, wLo));
+                        h1         = _mm_add_ps(h1, _mm_mul_ps(x1, wHi));
+                        l2         = _mm_add_ps(l2, _mm_mul_ps(x2, wLo));
+                        h2         = _mm_add_ps(h2, _mm_mul_ps(x2, wHi));
+                        l3         = _mm_add_ps(l3, _mm_mul_ps(x3, wLo));
+                        h3         = _mm_add_ps(h3, _mm_mul_ps(x3, wHi));
+                    }
+                    for (int j = 0; j < BLOCKED_CONV_PIXELS; j++) {
+                        in[j] += step[j];
+                    }
+                }
+            }
+        }
+
+        __m128 lo[BLOCKED_CONV_PIXELS] = {l0, l1, l2, l3};
+        __m128 hi[BLOCKED_CONV_PIXELS] = {h0, h1, h2, h3};
+        int    count =
+            task->outWidth - ow < BLOCKED_CONV_PIXELS ? task->outWidth - ow : BLOCKED_CONV_PIXELS;
+        for (int j = 0; j < count; j++) {
+            _mm_storeu_ps(out + (size_t)(ow + j) * CB, lo[j]);
+            _mm_storeu_ps(out + (size_t)(ow + j) * CB + 4, hi[j]);
+        }
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static void blockedConvRowNEON(const BlockedConvTask *task, int ob, int oh, float *out)
+{
+    int          inBlocks = channelBlocks(task->inChannels);
+    int          taps     = task->kernelSize * task->kernelSize;
+    const float *weights  = task->weights + (size_t)ob * taps * inBlocks * CB * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, ob, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow += BLOCKED_CONV_PIXELS) {
+        /* Channels 0-3 and 4-7 of every pixel of the tile */
+        float32x4_t l0 = vld1q_f32(bias), l1 = l0, l2 = l0, l3 = l0;
+        float32x4_t h0 = vld1q_f32(bias + 4), h1 = h0, h2 = h0, h3 = h0;
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            const float *row = task->input + (size_t)ih * task->inWidth * CB;
+
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                const float *in[BLOCKED_CONV_PIXELS];
+                size_t       step[BLOCKED_CONV_PIXELS];
+                blockedTapInputs(task, row, ow, kw, BLOCKED_CONV_PIXELS, in, step);
+
+                const float *w = weights + (size_t)(kh * task->kernelSize + kw) * inBlocks * CB * CB;
+                for (int ib = 0; ib < inBlocks; ib++) {
+                    for (int i = 0; i < CB; i++, w += CB) {
+                        float32x4_t wLo = vld1q_f32(w);
+                        float32x4_t wHi = vld1q_f32(w + 4);
+                        l0              = vfmaq_n_f32(l0, wLo, in[0][i]);
+                        h0              = vfmaq_n_f32(h0, wHi, in[0][i]);
+                        l1              = vfmaq_n_f32(l1, wLo, in[1][i]);
+                        h1              = vfmaq_n_f32(h1, wHi, in[1][i]);
+                        l2              = vfmaq_n_f32(l2, wLo, in[2][i]);
+                        h2              = vfmaq_n_f32(h2, wHi, in[2][i]);
+                        l3              = vfmaq_n_f32(l3, wLo, in[3][i]);
+                        h3              = vfmaq_n_f32(h3, wHi, in[3][i]);
+                    }
+                    for (int j = 0; j < BLOCKED_CONV_PIXELS; j++) {
+                        in[j] += step[j];
+                    }
+                }
+            }
+        }
+
+        float32x4_t lo[BLOCKED_CONV_PIXELS] = {l0, l1, l2, l3};
+        float32x4_t hi[BLOCKED_CONV_PIXELS] = {h0, h1, h2, h3};
+        int         count =
+            task->outWidth - ow < BLOCKED_CONV_PIXELS ? task->outWidth - ow : BLOCKED_CONV_PIXELS;
+        for (int j = 0; j < count; j++) {
+            vst1q_f32(out + (size_t)(ow + j) * CB, lo[j]);
+            vst1q_f32(out + (size_t)(ow + j) * CB + 4, hi[j]);
+        }
+    }
+}
+#endif
+
+static void blockedConvRow(const BlockedConvTask *task, int ob, int oh, float *out)
+{
+#if defined(HAS_AVX2_SUPPORT)
+    if (tinyaiSimdHasAVX2()) {
+        blockedConvRowAVX2(task, ob, oh, out);
+        return;
+    }
+#endif
+#if defined(HAS_SSE2_SUPPORT)
+    if (tinyaiSimdAvailable()) {
+        blockedConvRowSSE2(task, ob, oh, out);
+        return;
+    }
+#endif
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        blockedConvRowNEON(task, ob, oh, out);
+        return;
+    }
+#endif
+    blockedConvRowReference(task, ob, oh, out);
+}
+
+static void blockedDepthwiseRowReference(const BlockedConvTask *task, int b, int oh, float *out)
+{
+    size_t       plane   = (size_t)task->inWidth * task->inHeight * CB;
+    const float *input   = task->input + b * plane;
+    const float *weights = task->weights + (size_t)b * task->kernelSize * task->kernelSize * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, b, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow++) {
+        float sum[CB];
+        memcpy(sum, bias, sizeof(sum));
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                int iw = ow * task->stride - task->padding + kw;
+                if (iw < 0 || iw >= task->inWidth) {
+                    continue;
+                }
+                const float *in = input + ((size_t)ih * task->inWidth + iw) * CB;
+                const float *w  = weights + (size_t)(kh * task->kernelSize + kw) * CB;
+                for (int c = 0; c < CB; c++) {
+                    sum[c] += in[c] * w[c];
+                }
+            }
+        }
+
+        memcpy(out + (size_t)ow * CB, sum, sizeof(sum));
+    }
+}
+
+#if defined(HAS_AVX2_SUPPORT)
+TINYAI_TARGET_AVX2 static void blockedDepthwiseRowAVX2(const BlockedConvTask *task, int b, int oh,
+                                                       float *out)
+{
+    size_t       plane   = (size_t)task->inWidth * task->inHeight * CB;
+    const float *input   = task->input + b * plane;
+    const float *weights = task->weights + (size_t)b * task->kernelSize * task->kernelSize * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, b, task->outChannels);
+    __m256 biasVec = _mm256_loadu_ps(bias);
+
+    for (int ow = 0; ow < task->outWidth; ow++) {
+        __m256 sum = biasVec;
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                int iw = ow * task->stride - task->padding + kw;
+                if (iw < 0 || iw >= task->inWidth) {
+                    continue;
+                }
+                const float *in = input + ((size_t)ih * task->inWidth + iw) * CB;
+                const float *w  = weights + (size_t)(kh * task->kernelSize + kw) * CB;
+                sum = _mm256_fmadd_ps(_mm256_loadu_ps(in), _mm256_loadu_ps(w), sum);
+            }
+        }
+
+        _mm256_storeu_ps(out + (size_t)ow * CB, sum);
+    }
+}
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+static void blockedDepthwiseRowSSE2(const BlockedConvTask *task, int b, int oh, float *out)
+{
+    size_t       plane   = (size_t)task->inWidth * task->inHeight * CB;
+    const float *input   = task->input + b * plane;
+    const float *weights = task->weights + (size_t)b * task->kernelSize * task->kernelSize * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, b, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow++) {
+        __m128 lo = _mm_loadu_ps(bias);
+        __m128 hi = _mm_loadu_ps(bias + 4);
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                int iw = ow * task->stride - task->padding + kw;
+                if (iw < 0 || iw >= task->inWidth) {
+                    continue;
+                }
+                const float *in = input + ((size_t)ih * task->inWidth + iw) * CB;
+                const float *w  = weights + (size_t)(kh * task->kernelSize + kw) * CB;
+                lo = _mm_add_ps(lo, _mm_mul_ps(_mm_loadu_ps(in), _mm_loadu_ps(w)));
+                hi = _mm_add_ps(hi, _mm_mul_ps(_mm_loadu_ps(in + 4), _mm_loadu_ps(w + 4)));
+            }
+        }
+
+        _mm_storeu_ps(out + (size_t)ow * CB, lo);
+        _mm_storeu_ps(out + (size_t)ow * CB + 4, hi);
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+static void blockedDepthwiseRowNEON(const BlockedConvTask *task, int b, int oh, float *out)
+{
+    size_t       plane   = (size_t)task->inWidth * task->inHeight * CB;
+    const float *input   = task->input + b * plane;
+    const float *weights = task->weights + (size_t)b * task->kernelSize * task->kernelSize * CB;
+    float        bias[CB];
+    blockedBias(bias, task->biases, b, task->outChannels);
+
+    for (int ow = 0; ow < task->outWidth; ow++) {
+        float32x4_t lo = vld1q_f32(bias);
+        float32x4_t hi = vld1q_f32(bias + 4);
+
+        for (int kh = 0; kh < task->kernelSize; kh++) {
+            int ih = oh * task->stride - task->padding + kh;
+            if (ih < 0 || ih >= task->inHeight) {
+                continue;
+            }
+            for (int kw = 0; kw < task->kernelSize; kw++) {
+                int iw = ow * task->stride - task->padding + kw;
+                if (iw < 0 || iw >= task->inWidth) {
+                    continue;
+                }
+                const float *in = input + ((size_t)ih * task->inWidth + iw) * CB;
+                const float *w  = weights + (size_t)(kh * task->kernelSize + kw) * CB;
+                lo              = vfmaq_f32(lo, vld1q_f32(in), vld1q_f32(w));
+                hi              = vfmaq_f32(hi, vld1q_f32(in + 4), vld1q_f32(w + 4));
+            }
+        }
+
+        vst1q_f32(out + (size_t)ow * CB, lo);
+        vst1q_f32(out + (size_t)ow * CB + 4, hi);
+    }
+}
+#endif
+
+static void blockedDepthwiseRow(const BlockedConvTask *task, int b, int oh, float *out)
+{
+#if defined(HAS_AVX2_SUPPORT)
+    if (tinyaiSimdHasAVX2()) {
+        blockedDepthwiseRowAVX2(task, b, oh, out);
+        return;
+    }
+#endif
+#if defined(HAS_SSE2_SUPPORT)
+    if (tinyaiSimdAvailable()) {
+        blockedDepthwiseRowSSE2(task, b, oh, out);
+        return;
+    }
+#endif
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        blockedDepthwiseRowNEON(task, b, oh, out);
+        return;
+    }
+#endif
+    blockedDepthwiseRowReference(task, b, oh, out);
+}
+
+/* Compute one row of an output channel block and apply the activation while it is in cache */
+static void blockedRowWithActivation(const BlockedConvTask *task, int block, int oh, float *out)
+{
+    task->row(task, block, oh, out);
+    if (task->activation != TINYAI_SIMD_ACTIVATION_NONE) {
+        tinyaiSimdActivate(out, task->outWidth * CB, task->activation);
+    }
+}
+
+static void blockedRows(void *context, size_t begin, size_t end)
+{
+    BlockedConvTask *task   = (BlockedConvTask *)context;
+    size_t           rowLen = (size_t)task->outWidth * CB;
+
+    if (task->poolType == TINYAI_SIMD_POOL_NONE) {
+        for (size_t r = begin; r < end; r++) {
+            int block = (int)(r / task->outHeight);
+            int oh    = (int)(r % task->outHeight);
+            blockedRowWithActivation(task, block, oh, task->output + r * rowLen);
+        }
+        return;
+    }
+
+    /* The convolution rows under one row of pooling windows; they never reach the output */
+    float *window = (float *)malloc(task->poolKernel * rowLen * sizeof(float));
+    if (!window) {
+        task->failed = true;
+        return;
+    }
+
+    float area = (float)(task->poolKernel * task->poolKernel);
+    for (size_t r = begin; r < end; r++) {
+        int    block = (int)(r / task->pooledHeight);
+        int    ph    = (int)(r % task->pooledHeight);
+        float *out   = task->output + r * task->pooledWidth * CB;
+
+        for (int k = 0; k < task->poolKernel; k++) {
+            blockedRowWithActivation(task, block, ph * task->poolStride + k, window + k * rowLen);
+        }
+
+        for (int pw = 0; pw < task->pooledWidth; pw++) {
+            const float *corner = window + (size_t)pw * task->poolStride * CB;
+            float        pooled[CB];
+            memcpy(pooled, corner, sizeof(pooled));
+
+            /* Whole blocks at a time; the loops over CB channels vectorize */
+            for (int k = 0; k < task->poolKernel; k++) {
+                const float *in = corner + k * rowLen;
+                for (int i = k == 0 ? 1 : 0; i < task->poolKernel; i++) {
+                    if (task->poolType == TINYAI_SIMD_POOL_MAX) {
+                        for (int c = 0; c < CB; c++) {
+                            pooled[c] = in[i * CB + c] > pooled[c] ? in[i * CB + c] : pooled[c];
+                        }
+                    }
+                    else {
+                        for (int c = 0; c < CB; c++) {
+                            pooled[c] += in[i * CB + c];
+                        }
+                    }
+                }
+            }
+            for (int c = 0; c < CB; c++) {
+                out[pw * CB + c] =
+                    task->poolType == TINYAI_SIMD_POOL_MAX ? pooled[c] : pooled[c] / area;
+            }
+        }
+    }
+
+    free(window);
+}
+
+/* Set up the epilogue of a task and run its rows, or its rows of pooling windows, in parallel */
+static int runBlockedTask(BlockedConvTask *task, size_t workPerRow,
+                          const TinyAIBlockedEpilogue *epilogue)
+{
+    task->activation = epilogue ? epilogue->activation : TINYAI_SIMD_ACTIVATION_NONE;
+    task->poolType   = epilogue ? epilogue->poolType : TINYAI_SIMD_POOL_NONE;
+    task->failed     = false;
+
+    size_t rows = (size_t)channelBlocks(task->outChannels) * task->outHeight;
+    if (task->poolType != TINYAI_SIMD_POOL_NONE) {
+        task->poolKernel = epilogue->poolKernel;
+        task->poolStride = epilogue->poolStride;
+        if (task->poolKernel <= 0 || task->poolStride <= 0 || task->poolKernel > task->outWidth ||
+            task->poolKernel > task->outHeight) {
+            return -1;
+        }
+        task->pooledWidth  = (task->outWidth - task->poolKernel) / task->poolStride + 1;
+        task->pooledHeight = (task->outHeight - task->poolKernel) / task->poolStride + 1;
+
+        /* A row of pooling windows computes poolKernel rows of the convolution */
+        rows = (size_t)channelBlocks(task->outChannels) * task->pooledHeight;
+        workPerRow *= task->poolKernel;
+    }
+
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+    tinyaiParallelFor(pool, rows, tinyaiThreadPoolGrain(pool, workPerRow, 1), blockedRows, task);
+
+    return task->failed ? -1 : 0;
+}
+
+int tinyaiSimdConv2dBlocked(float *output, const float *input, const float *packedWeights,
+                            const float *biases, int inWidth, int inHeight, int inChannels,
+                            int outWidth, int outHeight, int outChannels, int kernelSize,
+                            int stride, int padding, const TinyAIBlockedEpilogue *epilogue)
+{
+    if (!output || !input || !packedWeights) {
+        return -1;
+    }
+
+    BlockedConvTask task = {.output      = output,
+                            .input       = input,
+                            .weights     = packedWeights,
+                            .biases      = biases,
+                            .inWidth     = inWidth,
+                            .inHeight    = inHeight,
+                            .inChannels  = inChannels,
+                            .outWidth    = outWidth,
+                            .outHeight   = outHeight,
+                            .outChannels = outChannels,
+                            .kernelSize  = kernelSize,
+                            .stride      = stride,
+                            .padding     = padding,
+                            .row         = blockedConvRow};
+
+    size_t workPerRow =
+        (size_t)outWidth * kernelSize * kernelSize * channelBlocks(inChannels) * CB * CB;
+    return runBlockedTask(&task, workPerRow, epilogue);
+}
+
+int tinyaiSimdDepthwiseConv2dBlocked(float *output, const float *input, const float *packedWeights,
+                                     const float *biases, int inWidth, int inHeight, int channels,
+                                     int outWidth, int outHeight, int kernelSize, int stride,
+                                     int padding, const TinyAIBlockedEpilogue *epilogue)
+{
+    if (!output || !input || !packedWeights) {
+        return -1;
+    }
+
+    BlockedConvTask task = {.output      = output,
+                            .input       = input,
+                            .weights     = packedWeights,
+                            .biases      = biases,
+                            .inWidth     = inWidth,
+                            .inHeight    = inHeight,
+                            .inChannels  = channels,
+                            .outWidth    = outWidth,
+                            .outHeight   = outHeight,
+                            .outChannels = channels,
+                            .kernelSize  = kernelSize,
+                            .stride      = stride,
+                            .padding     = padding,
+                            .row         = blockedDepthwiseRow};
+
+    size_t workPerRow = (size_t)outWidth * kernelSize * kernelSize * CB;
+    return runBlockedTask(&task, workPerRow, epilogue);
+}
@@ -7,6 +7,7 @@
  */
 
 #include "simd_ops.h"
+#include "thread_pool.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,10 +18,11 @@
 #include <intrin.h>
 #define HAS_SSE2_SUPPORT 1
 #if (_MSC_VER >= 1600) /* Visual Studio 2010 and later */
-#define HAS_AVX_SUPPORT 1
 #endif
 #if (_MSC_VER >= 1700) /* Visual Studio 2012 and later */
+#include <immintrin.h>
 #define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2
 #endif
 #elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 /* GCC/Clang on x86 */
@@ -29,14 +31,16 @@
 #include <emmintrin.h>
 #define HAS_SSE2_SUPPORT 1
 #endif
-#if defined(__AVX__)
-#include <immintrin.h>
-#define HAS_AVX_SUPPORT 1
-#endif
-#if defined(__AVX2__)
+/* The AVX2 kernel is compiled with its own target and picked at runtime */
+#if defined(__clang__) || __GNUC__ >= 5
 #include <immintrin.h>
 #define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2 __attribute__((target("avx2,fma")))
 #endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* AArch64: NEON is part of the base architecture */
+#include <arm_neon.h>
+#define HAS_NEON_SUPPORT 1
 #endif
 
 /**
@@ -218,8 +222,12 @@ void tinyaiConv2d4BitSSE2(float *output, const float *input, const uint8_t *weig
                     }
                 }
 
-                /* Store the results */
-                _mm_storeu_ps(&output[(oh * outWidth + ow) * outChannels + oc], sumVec);
+                /* Store the results; adjacent positions are outChannels apart */
+                float sums[4];
+                _mm_storeu_ps(sums, sumVec);
+                for (int i = 0; i < 4; i++) {
+                    output[(oh * outWidth + ow + i) * outChannels + oc] = sums[i];
+                }
             }
 
             /* Handle remaining columns */
@@ -285,10 +293,12 @@ void tinyaiConv2d4BitSSE2(float *output, const float *input, const uint8_t *weig
 /**
  * AVX2-optimized implementation of 2D convolution with 4-bit quantized weights
  */
-void tinyaiConv2d4BitAVX2(float *output, const float *input, const uint8_t *weights,
-                          const float *biases, const float *scaleFactors, int inWidth, int inHeight,
-                          int inChannels, int outWidth, int outHeight, int outChannels,
-                          int kernelSize, int stride, int padding)
+TINYAI_TARGET_AVX2 void tinyaiConv2d4BitAVX2(float *output, const float *input,
+                                             const uint8_t *weights, const float *biases,
+                                             const float *scaleFactors, int inWidth, int inHeight,
+                                             int inChannels, int outWidth, int outHeight,
+                                             int outChannels, int kernelSize, int stride,
+                                             int padding)
 {
     /* Process each output channel */
     for (int oc = 0; oc < outChannels; oc++) {
@@ -360,20 +370,18 @@ void tinyaiConv2d4BitAVX2(float *output, const float *input, const uint8_t *weig
                             /* Load input values as vector */
                             __m256 inVec = _mm256_loadu_ps(inVals);
 
-/* Multiply and accumulate */
-#if defined(__FMA__)
-                            /* Use FMA if available */
+                            /* Multiply and accumulate */
                             sumVec = _mm256_fmadd_ps(inVec, weightVec, sumVec);
-#else
-                            /* Regular multiply and add */
-                            sumVec = _mm256_add_ps(sumVec, _mm256_mul_ps(inVec, weightVec));
-#endif
                         }
                     }
                 }
 
-                /* Store the results */
-                _mm256_storeu_ps(&output[(oh * outWidth + ow) * outChannels + oc], sumVec);
+                /* Store the results; adjacent positions are outChannels apart */
+                float sums[8];
+                _mm256_storeu_ps(sums, sumVec);
+                for (int i = 0; i < 8; i++) {
+                    output[(oh * outWidth + ow + i) * outChannels + oc] = sums[i];
+                }
             }
 
             /* Handle remaining columns */
@@ -435,24 +443,122 @@ void tinyaiConv2d4BitAVX2(float *output, const float *input, const uint8_t *weig
 }
 #endif
 
+#if defined(HAS_NEON_SUPPORT)
+/* Sixteen 4-bit weights (8 bytes, low nibble first) as four vectors of floats */
+static inline void convWeightsNEON(const uint8_t *src, float32x4_t w[4])
+{
+    uint8x8_t  packed = vld1_u8(src);
+    uint8x8_t  lo     = vand_u8(packed, vdup_n_u8(0x0F));
+    uint8x8_t  hi     = vshr_n_u8(packed, 4);
+    uint8x16_t nib    = vcombine_u8(vzip1_u8(lo, hi), vzip2_u8(lo, hi));
+    int8x16_t  q      = vsubq_s8(vreinterpretq_s8_u8(nib), vdupq_n_s8(8));
+
+    int16x8_t q0 = vmovl_s8(vget_low_s8(q));
+    int16x8_t q1 = vmovl_high_s8(q);
+    w[0]         = vcvtq_f32_s32(vmovl_s16(vget_low_s16(q0)));
+    w[1]         = vcvtq_f32_s32(vmovl_high_s16(q0));
+    w[2]         = vcvtq_f32_s32(vmovl_s16(vget_low_s16(q1)));
+    w[3]         = vcvtq_f32_s32(vmovl_high_s16(q1));
+}
+
 /**
- * Public API for 2D convolution with 4-bit quantized weights
- * Automatically selects the most optimized implementation available
+ * NEON-optimized implementation of 2D convolution with 4-bit quantized weights
+ *
+ * Vectors run across 16 output channels: their weights are adjacent nibbles,
+ * starting on a byte boundary when outChannels is even, and each input value
+ * is broadcast against them. Odd channel counts and the last channels of a
+ * position are computed one at a time.
  */
-void tinyaiSimdConv2d4Bit(float *output, const float *input, const uint8_t *weights,
+void tinyaiConv2d4BitNEON(float *output, const float *input, const uint8_t *weights,
                           const float *biases, const float *scaleFactors, int inWidth, int inHeight,
                           int inChannels, int outWidth, int outHeight, int outChannels,
                           int kernelSize, int stride, int padding)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
+    int ocTail = (outChannels % 2 == 0) ? outChannels / 16 * 16 : 0;
+
+    for (int oh = 0; oh < outHeight; oh++) {
+        for (int ow = 0; ow < outWidth; ow++) {
+            int    inStartH = oh * stride - padding;
+            int    inStartW = ow * stride - padding;
+            float *dst      = output + (oh * outWidth + ow) * outChannels;
+
+            for (int oc = 0; oc < ocTail; oc += 16) {
+                float32x4_t acc[4] = {vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f),
+                                      vdupq_n_f32(0.0f)};
+
+                for (int kh = 0; kh < kernelSize; kh++) {
+                    int inH = inStartH + kh;
+                    if (inH < 0 || inH >= inHeight)
+                        continue;
+
+                    for (int kw = 0; kw < kernelSize; kw++) {
+                        int inW = inStartW + kw;
+                        if (inW < 0 || inW >= inWidth)
+                            continue;
 
+                        const float *in = input + (inH * inWidth + inW) * inChannels;
+                        for (int ic = 0; ic < inChannels; ic++) {
+                            int weightBase =
+                                ((kh * kernelSize + kw) * inChannels + ic) * outChannels + oc;
+
+                            float32x4_t w[4];
+                            convWeightsNEON(weights + weightBase / 2, w);
+                            for (int v = 0; v < 4; v++) {
+                                acc[v] = vfmaq_n_f32(acc[v], w[v], in[ic]);
+                            }
+                        }
+                    }
+                }
+
+                /* Per-channel scale and bias */
+                for (int v = 0; v < 4; v++) {
+                    float32x4_t bias =
+                        biases ? vld1q_f32(biases + oc + 4 * v) : vdupq_n_f32(0.0f);
+                    vst1q_f32(dst + oc + 4 * v,
+                              vfmaq_f32(bias, acc[v], vld1q_f32(scaleFactors + oc + 4 * v)));
+                }
+            }
+
+            /* Remaining output channels */
+            for (int oc = ocTail; oc < outChannels; oc++) {
+                float sum = 0.0f;
+                for (int kh = 0; kh < kernelSize; kh++) {
+                    int inH = inStartH + kh;
+                    if (inH < 0 || inH >= inHeight)
+                        continue;
+
+                    for (int kw = 0; kw < kernelSize; kw++) {
+                        int inW = inStartW + kw;
+                        if (inW < 0 || inW >= inWidth)
+                            continue;
+
+                        const float *in = input + (inH * inWidth + inW) * inChannels;
+                        for (int ic = 0; ic < inChannels; ic++) {
+                            int weightIdx =
+                                ((kh * kernelSize + kw) * inChannels + ic) * outChannels + oc;
+                            uint8_t packed = weights[weightIdx / 2];
+                            uint8_t nibble =
+                                (weightIdx % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+                            sum += in[ic] * (float)((int)nibble - 8);
+                        }
+                    }
+                }
+                dst[oc] = (biases ? biases[oc] : 0.0f) + sum * scaleFactors[oc];
+            }
+        }
+    }
+}
+#endif
+
+/* Direct convolution with the most optimized implementation available */
+static void conv2d4BitDirect(float *output, const float *input, const uint8_t *weights,
+                             const float *biases, const float *scaleFactors, int inWidth,
+                             int inHeight, int inChannels, int outWidth, int outHeight,
+                             int outChannels, int kernelSize, int stride, int padding)
+{
     /* Use the most advanced SIMD version available */
 #if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
+    if (tinyaiSimdHasAVX2()) {
         tinyaiConv2d4BitAVX2(output, input, weights, biases, scaleFactors, inWidth, inHeight,
                              inChannels, outWidth, outHeight, outChannels, kernelSize, stride,
                              padding);
@@ -461,7 +567,7 @@ void tinyaiSimdConv2d4Bit(float *output, const float *input, const uint8_t *weig
 #endif
 
 #if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
+    if (tinyaiSimdAvailable()) {
         tinyaiConv2d4BitSSE2(output, input, weights, biases, scaleFactors, inWidth, inHeight,
                              inChannels, outWidth, outHeight, outChannels, kernelSize, stride,
                              padding);
@@ -469,12 +575,561 @@ void tinyaiSimdConv2d4Bit(float *output, const float *input, const uint8_t *weig
     }
 #endif
 
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        tinyaiConv2d4BitNEON(output, input, weights, biases, scaleFactors, inWidth, inHeight,
+                             inChannels, outWidth, outHeight, outChannels, kernelSize, stride,
+                             padding);
+        return;
+    }
+#endif
+
     /* Fallback to reference implementation */
     tinyaiConv2d4BitReference(output, input, weights, biases, scaleFactors, inWidth, inHeight,
                               inChannels, outWidth, outHeight, outChannels, kernelSize, stride,
                               padding);
 }
 
+/* Convolution plans: im2col + GEMM and Winograd F(m x m, 3 x 3) */
+
+/* Output positions unrolled per im2col chunk are capped so the patch matrix stays within this */
+#define CONV_IM2COL_CHUNK_BYTES (1024 * 1024)
+
+/* Winograd tiles transformed together, sharing each row of transformed weights */
+#define CONV_WINOGRAD_TILE_BLOCK 8
+
+struct TinyAIConvPlan {
+    int algorithm;
+    int inWidth;
+    int inHeight;
+    int inChannels;
+    int outWidth;
+    int outHeight;
+    int outChannels;
+    int kernelSize;
+    int stride;
+    int padding;
+
+    uint8_t *weights;         /* Direct: copy of the 4-bit weights */
+    float   *scaleFactors;    /* Direct and im2col: scale of each output channel */
+    uint8_t *gemmWeights;     /* im2col: 4-bit [outChannels x kernelSize^2 * inChannels] */
+    float   *winogradWeights; /* Winograd: [alpha^2][inChannels][outChannels], scale folded in */
+};
+
+int tinyaiSimdSelectConvAlgorithm(int inChannels, int outWidth, int outHeight, int outChannels,
+                                  int kernelSize, int stride)
+{
+    /* Winograd pays for its transforms once both channel counts fill a few vectors. The larger
+       tile does less work per output, unless rounding the output up to whole tiles eats that */
+    if (kernelSize == 3 && stride == 1 && inChannels >= 16 && outChannels >= 16) {
+        int workF2 = ((outWidth + 1) / 2) * ((outHeight + 1) / 2) * 16;
+        int workF4 = ((outWidth + 3) / 4) * ((outHeight + 3) / 4) * 36;
+        return workF4 < workF2 ? TINYAI_SIMD_CONV_WINOGRAD_F4 : TINYAI_SIMD_CONV_WINOGRAD_F2;
+    }
+
+    /* The GEMM needs a microkernel's worth of output channels and positions */
+    if (outChannels >= 16 && outWidth * outHeight >= 16 &&
+        kernelSize * kernelSize * inChannels >= 16) {
+        return TINYAI_SIMD_CONV_IM2COL_GEMM;
+    }
+
+    return TINYAI_SIMD_CONV_DIRECT;
+}
+
+/* Signed 4-bit weight at element index i of a packed array, low nibble first */
+static inline int convWeight4Bit(const uint8_t *weights, size_t i)
+{
+    uint8_t packed = weights[i / 2];
+    return (int)(i % 2 == 0 ? (packed & 0x0F) : (packed >> 4)) - 8;
+}
+
+/* Weight transform of one kernel column or row, u = G g */
+static void winogradWeightTransform(const float *g, int gStride, float *u, int uStride, int tile)
+{
+    float g0 = g[0], g1 = g[gStride], g2 = g[2 * gStride];
+
+    if (tile == 2) {
+        u[0]           = g0;
+        u[uStride]     = 0.5f * (g0 + g1 + g2);
+        u[2 * uStride] = 0.5f * (g0 - g1 + g2);
+        u[3 * uStride] = g2;
+        return;
+    }
+
+    u[0]           = g0 / 4.0f;
+    u[uStride]     = -(g0 + g1 + g2) / 6.0f;
+    u[2 * uStride] = -(g0 - g1 + g2) / 6.0f;
+    u[3 * uStride] = g0 / 24.0f + g1 / 12.0f + g2 / 6.0f;
+    u[4 * uStride] = g0 / 24.0f - g1 / 12.0f + g2 / 6.0f;
+    u[5 * uStride] = g2;
+}
+
+/* Input transform, v = B^T d, applied to alpha channel vectors d[i * dStride] at once */
+static void winogradInputTransform(const float *d, size_t dStride, float *v, size_t vStride,
+                                   int channels, int tile)
+{
+    const float *d0 = d, *d1 = d + dStride, *d2 = d + 2 * dStride, *d3 = d + 3 * dStride;
+    float       *v0 = v, *v1 = v + vStride, *v2 = v + 2 * vStride, *v3 = v + 3 * vStride;
+
+    if (tile == 2) {
+        for (int c = 0; c < channels; c++) {
+            v0[c] = d0[c] - d2[c];
+            v1[c] = d1[c] + d2[c];
+            v2[c] = d2[c] - d1[c];
+            v3[c] = d1[c] - d3[c];
+        }
+        return;
+    }
+
+    const float *d4 = d + 4 * dStride, *d5 = d + 5 * dStride;
+    float       *v4 = v + 4 * vStride, *v5 = v + 5 * vStride;
+    for (int c = 0; c < channels; c++) {
+        v0[c] = 4.0f * d0[c] - 5.0f * d2[c] + d4[c];
+        v1[c] = -4.0f * (d1[c] + d2[c]) + d3[c] + d4[c];
+        v2[c] = 4.0f * (d1[c] - d2[c]) - d3[c] + d4[c];
+        v3[c] = 2.0f * (d3[c] - d1[c]) - d2[c] + d4[c];
+        v4[c] = 2.0f * (d1[c] - d3[c]) - d2[c] + d4[c];
+        v5[c] = 4.0f * d1[c] - 5.0f * d3[c] + d5[c];
+    }
+}
+
+/* Output transform, y = A^T m, applied to alpha channel vectors m[i * mStride] at once */
+static void winogradOutputTransform(const float *m, size_t mStride, float *y, size_t yStride,
+                                    int channels, int tile)
+{
+    const float *m0 = m, *m1 = m + mStride, *m2 = m + 2 * mStride, *m3 = m + 3 * mStride;
+    float       *y0 = y, *y1 = y + yStride;
+
+    if (tile == 2) {
+        for (int c = 0; c < channels; c++) {
+            y0[c] = m0[c] + m1[c] + m2[c];
+            y1[c] = m1[c] - m2[c] - m3[c];
+        }
+        return;
+    }
+
+    const float *m4 = m + 4 * mStride, *m5 = m + 5 * mStride;
+    float       *y2 = y + 2 * yStride, *y3 = y + 3 * yStride;
+    for (int c = 0; c < channels; c++) {
+        float sum12 = m1[c] + m2[c], diff12 = m1[c] - m2[c];
+        float sum34 = m3[c] + m4[c], diff34 = m3[c] - m4[c];
+        y0[c]       = m0[c] + sum12 + sum34;
+        y1[c]       = diff12 + 2.0f * diff34;
+        y2[c]       = sum12 + 4.0f * sum34;
+        y3[c]       = diff12 + 8.0f * diff34 + m5[c];
+    }
+}
+
+static int winogradTileSize(const TinyAIConvPlan *plan)
+{
+    return plan->algorithm == TINYAI_SIMD_CONV_WINOGRAD_F2 ? 2 : 4;
+}
+
+/* Transform every 3 x 3 kernel into the Winograd domain, U = G g G^T, with its scale folded in */
+static bool prepareWinogradWeights(TinyAIConvPlan *plan, const uint8_t *weights,
+                                   const float *scaleFactors)
+{
+    int    tile     = winogradTileSize(plan);
+    int    alpha    = tile + 2;
+    int    inCh     = plan->inChannels;
+    int    outCh    = plan->outChannels;
+    size_t perPoint = (size_t)inCh * outCh;
+
+    plan->winogradWeights = (float *)malloc((size_t)alpha * alpha * perPoint * sizeof(float));
+    if (!plan->winogradWeights) {
+        return false;
+    }
+
+    for (int ic = 0; ic < inCh; ic++) {
+        for (int oc = 0; oc < outCh; oc++) {
+            float g[9], gu[6 * 3], u[6 * 6];
+            for (int k = 0; k < 9; k++) {
+                size_t index = ((size_t)k * inCh + ic) * outCh + oc;
+                g[k]         = (float)convWeight4Bit(weights, index) * scaleFactors[oc];
+            }
+
+            /* Columns of g, then rows of the result */
+            for (int kw = 0; kw < 3; kw++) {
+                winogradWeightTransform(g + kw, 3, gu + kw, 3, tile);
+            }
+            for (int i = 0; i < alpha; i++) {
+                winogradWeightTransform(gu + i * 3, 1, u + i * alpha, 1, tile);
+            }
+
+            for (int xi = 0; xi < alpha * alpha; xi++) {
+                plan->winogradWeights[xi * perPoint + (size_t)ic * outCh + oc] = u[xi];
+            }
+        }
+    }
+    return true;
+}
+
+/* Regroup the weights as one 4-bit row per output channel for the GEMM */
+static bool prepareGemmWeights(TinyAIConvPlan *plan, const uint8_t *weights)
+{
+    int    depth       = plan->kernelSize * plan->kernelSize * plan->inChannels;
+    size_t bytesPerRow = (size_t)(depth + 1) / 2;
+
+    plan->gemmWeights = (uint8_t *)calloc((size_t)plan->outChannels, bytesPerRow);
+    if (!plan->gemmWeights) {
+        return false;
+    }
+
+    for (int oc = 0; oc < plan->outChannels; oc++) {
+        uint8_t *row = plan->gemmWeights + (size_t)oc * bytesPerRow;
+        for (int k = 0; k < depth; k++) {
+            uint8_t nibble =
+                (uint8_t)(convWeight4Bit(weights, (size_t)k * plan->outChannels + oc) + 8);
+            row[k / 2] |= (uint8_t)(k % 2 == 0 ? nibble : nibble << 4);
+        }
+    }
+    return true;
+}
+
+TinyAIConvPlan *tinyaiSimdCreateConvPlan(const uint8_t *weights, const float *scaleFactors,
+                                         int inWidth, int inHeight, int inChannels, int outWidth,
+                                         int outHeight, int outChannels, int kernelSize,
+                                         int stride, int padding, int algorithm)
+{
+    if (!weights || !scaleFactors || inChannels <= 0 || outChannels <= 0 || kernelSize <= 0 ||
+        stride <= 0) {
+        return NULL;
+    }
+
+    if (algorithm == TINYAI_SIMD_CONV_AUTO) {
+        algorithm = tinyaiSimdSelectConvAlgorithm(inChannels, outWidth, outHeight, outChannels,
+                                                  kernelSize, stride);
+    }
+    if ((algorithm == TINYAI_SIMD_CONV_WINOGRAD_F2 || algorithm == TINYAI_SIMD_CONV_WINOGRAD_F4) &&
+        (kernelSize != 3 || stride != 1)) {
+        return NULL;
+    }
+
+    TinyAIConvPlan *plan = (TinyAIConvPlan *)calloc(1, sizeof(TinyAIConvPlan));
+    if (!plan) {
+        return NULL;
+    }
+    plan->algorithm   = algorithm;
+    plan->inWidth     = inWidth;
+    plan->inHeight    = inHeight;
+    plan->inChannels  = inChannels;
+    plan->outWidth    = outWidth;
+    plan->outHeight   = outHeight;
+    plan->outChannels = outChannels;
+    plan->kernelSize  = kernelSize;
+    plan->stride      = stride;
+    plan->padding     = padding;
+
+    bool ok = false;
+    switch (algorithm) {
+    case TINYAI_SIMD_CONV_DIRECT: {
+        size_t weightBytes =
+            ((size_t)kernelSize * kernelSize * inChannels * outChannels + 1) / 2;
+        plan->weights      = (uint8_t *)malloc(weightBytes);
+        plan->scaleFactors = (float *)malloc((size_t)outChannels * sizeof(float));
+        ok                 = plan->weights && plan->scaleFactors;
+        if (ok) {
+            memcpy(plan->weights, weights, weightBytes);
+            memcpy(plan->scaleFactors, scaleFactors, (size_t)outChannels * sizeof(float));
+        }
+        break;
+    }
+    case TINYAI_SIMD_CONV_IM2COL_GEMM:
+        plan->scaleFactors = (float *)malloc((size_t)outChannels * sizeof(float));
+        ok                 = plan->scaleFactors && prepareGemmWeights(plan, weights);
+        if (ok) {
+            memcpy(plan->scaleFactors, scaleFactors, (size_t)outChannels * sizeof(float));
+        }
+        break;
+    case TINYAI_SIMD_CONV_WINOGRAD_F2:
+    case TINYAI_SIMD_CONV_WINOGRAD_F4:
+        ok = prepareWinogradWeights(plan, weights, scaleFactors);
+        break;
+    default:
+        break;
+    }
+
+    if (!ok) {
+        tinyaiSimdDestroyConvPlan(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void tinyaiSimdDestroyConvPlan(TinyAIConvPlan *plan)
+{
+    if (!plan) {
+        return;
+    }
+    free(plan->weights);
+    free(plan->scaleFactors);
+    free(plan->gemmWeights);
+    free(plan->winogradWeights);
+    free(plan);
+}
+
+int tinyaiSimdConvPlanAlgorithm(const TinyAIConvPlan *plan)
+{
+    return plan ? plan->algorithm : TINYAI_SIMD_CONV_DIRECT;
+}
+
+/* im2col + GEMM: unroll the patches of a chunk of output positions into the columns of a
+   [kernelSize^2 * inChannels x positions] matrix and multiply by the regrouped weights */
+static int runConvPlanGemm(const TinyAIConvPlan *plan, float *output, const float *input,
+                           const float *biases)
+{
+    int depth     = plan->kernelSize * plan->kernelSize * plan->inChannels;
+    int positions = plan->outWidth * plan->outHeight;
+    int chunk     = (int)(CONV_IM2COL_CHUNK_BYTES / ((size_t)depth * sizeof(float)));
+    chunk         = chunk / 16 * 16;
+    if (chunk < 16) {
+        chunk = 16;
+    }
+    if (chunk > positions) {
+        chunk = positions;
+    }
+
+    float *patches = (float *)malloc((size_t)depth * chunk * sizeof(float));
+    float *product = (float *)malloc((size_t)plan->outChannels * chunk * sizeof(float));
+    if (!patches || !product) {
+        free(patches);
+        free(product);
+        return -1;
+    }
+
+    for (int p0 = 0; p0 < positions; p0 += chunk) {
+        int count = positions - p0 < chunk ? positions - p0 : chunk;
+
+        /* Column p of the patch matrix is the zero-padded window of output position p0 + p */
+        for (int p = 0; p < count; p++) {
+            int oh = (p0 + p) / plan->outWidth;
+            int ow = (p0 + p) % plan->outWidth;
+            int k  = 0;
+            for (int kh = 0; kh < plan->kernelSize; kh++) {
+                int inH = oh * plan->stride - plan->padding + kh;
+                for (int kw = 0; kw < plan->kernelSize; kw++) {
+                    int          inW    = ow * plan->stride - plan->padding + kw;
+                    bool         inside = inH >= 0 && inH < plan->inHeight && inW >= 0 &&
+                                  inW < plan->inWidth;
+                    const float *src =
+                        input + ((size_t)inH * plan->inWidth + inW) * plan->inChannels;
+                    for (int ic = 0; ic < plan->inChannels; ic++, k++) {
+                        patches[(size_t)k * count + p] = inside ? src[ic] : 0.0f;
+                    }
+                }
+            }
+        }
+
+        tinyaiSimdMatMul4BitMM(product, plan->gemmWeights, patches, plan->outChannels, depth,
+                               count, plan->scaleFactors);
+
+        /* The product is channel-major; the output keeps channels innermost */
+        for (int p = 0; p < count; p++) {
+            float *dst = output + (size_t)(p0 + p) * plan->outChannels;
+            for (int oc = 0; oc < plan->outChannels; oc++) {
+                dst[oc] = product[(size_t)oc * count + p] + (biases ? biases[oc] : 0.0f);
+            }
+        }
+    }
+
+    free(patches);
+    free(product);
+    return 0;
+}
+
+/* Blocks of Winograd tiles, run as a thread pool task */
+typedef struct {
+    const TinyAIConvPlan *plan;
+    float                *output;
+    const float          *input;
+    const float          *biases;
+    int                   tilesWide;
+    int                   tiles;
+    bool                  failed;
+} WinogradTask;
+
+static void winogradTileBlocks(void *context, size_t begin, size_t end)
+{
+    WinogradTask         *task  = (WinogradTask *)context;
+    const TinyAIConvPlan *plan  = task->plan;
+    int                   tile  = winogradTileSize(plan);
+    int                   alpha = tile + 2;
+    int                   inCh  = plan->inChannels;
+    int                   outCh = plan->outChannels;
+    int                   block = CONV_WINOGRAD_TILE_BLOCK;
+
+    /* patch/transformed: [alpha^2][block][inCh]; product: [alpha^2][block][outCh] */
+    size_t points      = (size_t)alpha * alpha;
+    float *patch       = (float *)malloc(points * inCh * sizeof(float));
+    float *rows        = (float *)malloc(points * (inCh > outCh ? inCh : outCh) * sizeof(float));
+    float *transformed = (float *)malloc(points * block * inCh * sizeof(float));
+    float *product     = (float *)malloc(points * block * outCh * sizeof(float));
+    float *result      = (float *)malloc((size_t)tile * tile * outCh * sizeof(float));
+    if (!patch || !rows || !transformed || !product || !result) {
+        task->failed = true;
+        goto cleanup;
+    }
+
+    for (size_t b = begin; b < end; b++) {
+        int first = (int)b * block;
+        int count = task->tiles - first < block ? task->tiles - first : block;
+
+        /* V = B^T d B for every tile of the block, all input channels at once */
+        for (int t = 0; t < count; t++) {
+            int originH = (first + t) / task->tilesWide * tile - plan->padding;
+            int originW = (first + t) % task->tilesWide * tile - plan->padding;
+            for (int i = 0; i < alpha; i++) {
+                for (int j = 0; j < alpha; j++) {
+                    int    inH = originH + i, inW = originW + j;
+                    float *dst = patch + ((size_t)i * alpha + j) * inCh;
+                    if (inH < 0 || inH >= plan->inHeight || inW < 0 || inW >= plan->inWidth) {
+                        memset(dst, 0, inCh * sizeof(float));
+                        continue;
+                    }
+                    memcpy(dst, task->input + ((size_t)inH * plan->inWidth + inW) * inCh,
+                           inCh * sizeof(float));
+                }
+            }
+
+            for (int j = 0; j < alpha; j++) {
+                winogradInputTransform(patch + (size_t)j * inCh, (size_t)alpha * inCh,
+                                       rows + (size_t)j * inCh, (size_t)alpha * inCh, inCh, tile);
+            }
+            for (int i = 0; i < alpha; i++) {
+                winogradInputTransform(rows + (size_t)i * alpha * inCh, inCh,
+                                       transformed + ((size_t)i * alpha * block + t) * inCh,
+                                       (size_t)block * inCh, inCh, tile);
+            }
+        }
+
+        /* M[xi] = V[xi] U[xi] for each of the alpha^2 points, each row of U shared by the block */
+        for (size_t xi = 0; xi < points; xi++) {
+            const float *u = plan->winogradWeights + xi * inCh * outCh;
+            float       *m = product + xi * block * outCh;
+            const float *v = transformed + xi * block * inCh;
+
+            memset(m, 0, (size_t)count * outCh * sizeof(float));
+            for (int ic = 0; ic < inCh; ic++) {
+                for (int t = 0; t < count; t++) {
+                    float value = v[(size_t)t * inCh + ic];
+                    if (value != 0.0f) {
+                        tinyaiSimdVecScaleAdd(m + (size_t)t * outCh, u + (size_t)ic * outCh,
+                                              value, outCh);
+                    }
+                }
+            }
+        }
+
+        /* Y = A^T M A, plus the bias, written where the tile lies inside the output */
+        for (int t = 0; t < count; t++) {
+            int outH0 = (first + t) / task->tilesWide * tile;
+            int outW0 = (first + t) % task->tilesWide * tile;
+
+            for (int j = 0; j < alpha; j++) {
+                winogradOutputTransform(product + ((size_t)j * block + t) * outCh,
+                                        (size_t)alpha * block * outCh, rows + (size_t)j * outCh,
+                                        (size_t)alpha * outCh, outCh, tile);
+            }
+            for (int i = 0; i < tile; i++) {
+                winogradOutputTransform(rows + (size_t)i * alpha * outCh, outCh,
+                                        result + (size_t)i * tile * outCh, outCh, outCh, tile);
+            }
+
+            for (int i = 0; i < tile && outH0 + i < plan->outHeight; i++) {
+                for (int j = 0; j < tile && outW0 + j < plan->outWidth; j++) {
+                    const float *src = result + ((size_t)i * tile + j) * outCh;
+                    float       *dst =
+                        task->output + ((size_t)(outH0 + i) * plan->outWidth + outW0 + j) * outCh;
+                    if (task->biases) {
+                        tinyaiSimdVecAdd(dst, src, task->biases, outCh);
+                    }
+                    else {
+                        memcpy(dst, src, outCh * sizeof(float));
+                    }
+                }
+            }
+        }
+    }
+
+cleanup:
+    free(patch);
+    free(rows);
+    free(transformed);
+    free(product);
+    free(result);
+}
+
+static int runConvPlanWinograd(const TinyAIConvPlan *plan, float *output, const float *input,
+                               const float *biases)
+{
+    int tile      = winogradTileSize(plan);
+    int tilesWide = (plan->outWidth + tile - 1) / tile;
+    int tilesHigh = (plan->outHeight + tile - 1) / tile;
+
+    WinogradTask task = {plan, output, input, biases, tilesWide, tilesWide * tilesHigh, false};
+    size_t       blocks =
+        (size_t)(task.tiles + CONV_WINOGRAD_TILE_BLOCK - 1) / CONV_WINOGRAD_TILE_BLOCK;
+
+    /* Multiply-adds of one block in the Winograd domain */
+    size_t            workPerBlock = (size_t)(tile + 2) * (tile + 2) * CONV_WINOGRAD_TILE_BLOCK *
+                          plan->inChannels * plan->outChannels;
+    TinyAIThreadPool *pool         = tinyaiGetThreadPool();
+    tinyaiParallelFor(pool, blocks, tinyaiThreadPoolGrain(pool, workPerBlock, 1),
+                      winogradTileBlocks, &task);
+
+    return task.failed ? -1 : 0;
+}
+
+int tinyaiSimdRunConvPlan(const TinyAIConvPlan *plan, float *output, const float *input,
+                          const float *biases)
+{
+    if (!plan || !output || !input) {
+        return -1;
+    }
+
+    switch (plan->algorithm) {
+    case TINYAI_SIMD_CONV_IM2COL_GEMM:
+        return runConvPlanGemm(plan, output, input, biases);
+    case TINYAI_SIMD_CONV_WINOGRAD_F2:
+    case TINYAI_SIMD_CONV_WINOGRAD_F4:
+        return runConvPlanWinograd(plan, output, input, biases);
+    default:
+        conv2d4BitDirect(output, input, plan->weights, biases, plan->scaleFactors, plan->inWidth,
+                         plan->inHeight, plan->inChannels, plan->outWidth, plan->outHeight,
+                         plan->outChannels, plan->kernelSize, plan->stride, plan->padding);
+        return 0;
+    }
+}
+
+/**
+ * Public API for 2D convolution with 4-bit quantized weights
+ *
+ * Picks the algorithm for the layer shape; the weight transforms of the
+ * im2col and Winograd paths are redone on every call, so layers that run
+ * repeatedly should hold a plan from tinyaiSimdCreateConvPlan instead.
+ */
+void tinyaiSimdConv2d4Bit(float *output, const float *input, const uint8_t *weights,
+                          const float *biases, const float *scaleFactors, int inWidth, int inHeight,
+                          int inChannels, int outWidth, int outHeight, int outChannels,
+                          int kernelSize, int stride, int padding)
+{
+    int algorithm = tinyaiSimdSelectConvAlgorithm(inChannels, outWidth, outHeight, outChannels,
+                                                  kernelSize, stride);
+    if (algorithm != TINYAI_SIMD_CONV_DIRECT) {
+        TinyAIConvPlan *plan = tinyaiSimdCreateConvPlan(
+            weights, scaleFactors, inWidth, inHeight, inChannels, outWidth, outHeight,
+            outChannels, kernelSize, stride, padding, algorithm);
+        int status = tinyaiSimdRunConvPlan(plan, output, input, biases);
+        tinyaiSimdDestroyConvPlan(plan);
+        if (status == 0) {
+            return;
+        }
+    }
+
+    conv2d4BitDirect(output, input, weights, biases, scaleFactors, inWidth, inHeight, inChannels,
+                     outWidth, outHeight, outChannels, kernelSize, stride, padding);
+}
+
 /**
  * Depthwise convolution with 4-bit quantized weights (reference implementation)
  *
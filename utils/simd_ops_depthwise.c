@@ -17,10 +17,11 @@
 #include <intrin.h>
 #define HAS_SSE2_SUPPORT 1
 #if (_MSC_VER >= 1600) /* Visual Studio 2010 and later */
-#define HAS_AVX_SUPPORT 1
 #endif
 #if (_MSC_VER >= 1700) /* Visual Studio 2012 and later */
+#include <immintrin.h>
 #define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2
 #endif
 #elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
 /* GCC/Clang on x86 */
@@ -29,14 +30,16 @@
 #include <emmintrin.h>
 #define HAS_SSE2_SUPPORT 1
 #endif
-#if defined(__AVX__)
-#include <immintrin.h>
-#define HAS_AVX_SUPPORT 1
-#endif
-#if defined(__AVX2__)
+/* The AVX2 kernel is compiled with its own target and picked at runtime */
+#if defined(__clang__) || __GNUC__ >= 5
 #include <immintrin.h>
 #define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2 __attribute__((target("avx2,fma")))
 #endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* AArch64: NEON is part of the base architecture */
+#include <arm_neon.h>
+#define HAS_NEON_SUPPORT 1
 #endif
 
 /**
@@ -216,10 +219,12 @@ void tinyaiDepthwiseConv2d4BitSSE2(float *output, const float *input, const uint
 /**
  * AVX2-optimized implementation of depthwise convolution with 4-bit quantized weights
  */
-void tinyaiDepthwiseConv2d4BitAVX2(float *output, const float *input, const uint8_t *weights,
-                                   const float *biases, const float *scaleFactors, int inWidth,
-                                   int inHeight, int inChannels, int outWidth, int outHeight,
-                                   int multiplier, int kernelSize, int stride, int padding)
+TINYAI_TARGET_AVX2 void tinyaiDepthwiseConv2d4BitAVX2(float *output, const float *input,
+                                                      const uint8_t *weights, const float *biases,
+                                                      const float *scaleFactors, int inWidth,
+                                                      int inHeight, int inChannels, int outWidth,
+                                                      int outHeight, int multiplier,
+                                                      int kernelSize, int stride, int padding)
 {
     int outChannels = inChannels * multiplier;
 
@@ -289,14 +294,7 @@ void tinyaiDepthwiseConv2d4BitAVX2(float *output, const float *input, const uint
                             __m256 inVec = _mm256_loadu_ps(inVals);
 
                             /* Multiply and accumulate */
-#if defined(__FMA__)
-                            /* Use FMA if available */
                             sumVec = _mm256_fmadd_ps(inVec, weightVec, sumVec);
-#else
-                            /* Regular multiply and add */
-                            __m256 prodVec = _mm256_mul_ps(inVec, weightVec);
-                            sumVec         = _mm256_add_ps(sumVec, prodVec);
-#endif
                         }
                     }
 
@@ -314,6 +312,115 @@ void tinyaiDepthwiseConv2d4BitAVX2(float *output, const float *input, const uint
 }
 #endif
 
+#if defined(HAS_NEON_SUPPORT)
+/* Sixteen 4-bit weights (8 bytes, low nibble first) as four vectors of floats */
+static inline void depthwiseWeightsNEON(const uint8_t *src, float32x4_t w[4])
+{
+    uint8x8_t  packed = vld1_u8(src);
+    uint8x8_t  lo     = vand_u8(packed, vdup_n_u8(0x0F));
+    uint8x8_t  hi     = vshr_n_u8(packed, 4);
+    uint8x16_t nib    = vcombine_u8(vzip1_u8(lo, hi), vzip2_u8(lo, hi));
+    int8x16_t  q      = vsubq_s8(vreinterpretq_s8_u8(nib), vdupq_n_s8(8));
+
+    int16x8_t q0 = vmovl_s8(vget_low_s8(q));
+    int16x8_t q1 = vmovl_high_s8(q);
+    w[0]         = vcvtq_f32_s32(vmovl_s16(vget_low_s16(q0)));
+    w[1]         = vcvtq_f32_s32(vmovl_high_s16(q0));
+    w[2]         = vcvtq_f32_s32(vmovl_s16(vget_low_s16(q1)));
+    w[3]         = vcvtq_f32_s32(vmovl_high_s16(q1));
+}
+
+/**
+ * NEON-optimized implementation of depthwise convolution with 4-bit quantized weights
+ *
+ * With a multiplier of one, input channel c feeds output channel c, so 16
+ * channels of a position are contiguous in the input, the output and (for an
+ * even channel count, from a byte boundary) the weights. Vectors run across
+ * those channels; the last channels of a position are computed one at a
+ * time. Other multipliers use the reference implementation.
+ */
+void tinyaiDepthwiseConv2d4BitNEON(float *output, const float *input, const uint8_t *weights,
+                                   const float *biases, const float *scaleFactors, int inWidth,
+                                   int inHeight, int inChannels, int outWidth, int outHeight,
+                                   int multiplier, int kernelSize, int stride, int padding)
+{
+    if (multiplier != 1) {
+        tinyaiDepthwiseConv2d4BitReference(output, input, weights, biases, scaleFactors, inWidth,
+                                           inHeight, inChannels, outWidth, outHeight, multiplier,
+                                           kernelSize, stride, padding);
+        return;
+    }
+
+    int cTail = (inChannels % 2 == 0) ? inChannels / 16 * 16 : 0;
+
+    for (int oh = 0; oh < outHeight; oh++) {
+        for (int ow = 0; ow < outWidth; ow++) {
+            int    inStartH = oh * stride - padding;
+            int    inStartW = ow * stride - padding;
+            float *dst      = output + (oh * outWidth + ow) * inChannels;
+
+            for (int c = 0; c < cTail; c += 16) {
+                float32x4_t acc[4] = {vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f),
+                                      vdupq_n_f32(0.0f)};
+
+                for (int kh = 0; kh < kernelSize; kh++) {
+                    int inH = inStartH + kh;
+                    if (inH < 0 || inH >= inHeight)
+                        continue;
+
+                    for (int kw = 0; kw < kernelSize; kw++) {
+                        int inW = inStartW + kw;
+                        if (inW < 0 || inW >= inWidth)
+                            continue;
+
+                        const float *in         = input + (inH * inWidth + inW) * inChannels + c;
+                        int          weightBase = (kh * kernelSize + kw) * inChannels + c;
+
+                        float32x4_t w[4];
+                        depthwiseWeightsNEON(weights + weightBase / 2, w);
+                        for (int v = 0; v < 4; v++) {
+                            acc[v] = vfmaq_f32(acc[v], w[v], vld1q_f32(in + 4 * v));
+                        }
+                    }
+                }
+
+                /* Per-channel scale and bias */
+                for (int v = 0; v < 4; v++) {
+                    float32x4_t bias =
+                        biases ? vld1q_f32(biases + c + 4 * v) : vdupq_n_f32(0.0f);
+                    vst1q_f32(dst + c + 4 * v,
+                              vfmaq_f32(bias, acc[v], vld1q_f32(scaleFactors + c + 4 * v)));
+                }
+            }
+
+            /* Remaining channels */
+            for (int c = cTail; c < inChannels; c++) {
+                float sum = 0.0f;
+                for (int kh = 0; kh < kernelSize; kh++) {
+                    int inH = inStartH + kh;
+                    if (inH < 0 || inH >= inHeight)
+                        continue;
+
+                    for (int kw = 0; kw < kernelSize; kw++) {
+                        int inW = inStartW + kw;
+                        if (inW < 0 || inW >= inWidth)
+                            continue;
+
+                        int     weightIdx = (kh * kernelSize + kw) * inChannels + c;
+                        uint8_t packed    = weights[weightIdx / 2];
+                        uint8_t nibble =
+                            (weightIdx % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+                        sum += input[(inH * inWidth + inW) * inChannels + c] *
+                               (float)((int)nibble - 8);
+                    }
+                }
+                dst[c] = (biases ? biases[c] : 0.0f) + sum * scaleFactors[c];
+            }
+        }
+    }
+}
+#endif
+
 /**
  * Update the main depthwise convolution function to use the appropriate
  * SIMD implementation based on the available hardware
@@ -323,15 +430,9 @@ void tinyaiSimdDepthwiseConv2d4Bit(float *output, const float *input, const uint
                                    int inHeight, int inChannels, int outWidth, int outHeight,
                                    int multiplier, int kernelSize, int stride, int padding)
 {
-    /* Check if SIMD is available and which version */
-    extern bool g_simdInitialized;
-    extern bool g_hasSSE2;
-    extern bool g_hasAVX;
-    extern bool g_hasAVX2;
-
     /* Use the most advanced SIMD version available */
 #if defined(HAS_AVX2_SUPPORT)
-    if (g_hasAVX2) {
+    if (tinyaiSimdHasAVX2()) {
         tinyaiDepthwiseConv2d4BitAVX2(output, input, weights, biases, scaleFactors, inWidth,
                                       inHeight, inChannels, outWidth, outHeight, multiplier,
                                       kernelSize, stride, padding);
@@ -340,7 +441,7 @@ void tinyaiSimdDepthwiseConv2d4Bit(float *output, const float *input, const uint
 #endif
 
 #if defined(HAS_SSE2_SUPPORT)
-    if (g_hasSSE2) {
+    if (tinyaiSimdAvailable()) {
         tinyaiDepthwiseConv2d4BitSSE2(output, input, weights, biases, scaleFactors, inWidth,
                                       inHeight, inChannels, outWidth, outHeight, multiplier,
                                       kernelSize, stride, padding);
@@ -348,6 +449,15 @@ void tinyaiSimdDepthwiseConv2d4Bit(float *output, const float *input, const uint
     }
 #endif
 
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        tinyaiDepthwiseConv2d4BitNEON(output, input, weights, biases, scaleFactors, inWidth,
+                                      inHeight, inChannels, outWidth, outHeight, multiplier,
+                                      kernelSize, stride, padding);
+        return;
+    }
+#endif
+
     /* Fallback to reference implementation */
     tinyaiDepthwiseConv2d4BitReference(output, input, weights, biases, scaleFactors, inWidth,
                                        inHeight, inChannels, outWidth, outHeight, multiplier,
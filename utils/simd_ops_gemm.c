@@ -0,0 +1,516 @@
+/**
+ * @file simd_ops_gemm.c
+ * @brief Blocked matrix-matrix multiplication for 4-bit weights
+ *
+ * tinyaiSimdMatMul4BitMM is organized as a packed GEMM. A block of B
+ * (KC rows x NC columns) is copied into NR-wide panels, a block of the
+ * 4-bit matrix (MC rows x KC columns) is dequantized into MR-tall panels,
+ * and an MR x NR microkernel keeps the whole output tile in registers
+ * while it streams one panel of each. KC, MC and NC come from the cache
+ * sizes so that a B panel stays in L1 and the packed A block in L2. The
+ * output is split into MC x NC tiles that run on the shared thread pool.
+ */
+
+#include "simd_ops.h"
+#include "cache_opt.h"
+#include "thread_pool.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* SIMD detection and platform-specific includes */
+#if defined(_MSC_VER)
+/* Windows/MSVC */
+#include <intrin.h>
+#define HAS_SSE2_SUPPORT 1
+#if (_MSC_VER >= 1700) /* Visual Studio 2012 and later */
+#include <immintrin.h>
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2
+#endif
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/* GCC/Clang on x86 */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAS_SSE2_SUPPORT 1
+#endif
+/* The AVX2 kernel is compiled with its own target and picked at runtime */
+#if defined(__clang__) || __GNUC__ >= 5
+#include <immintrin.h>
+#define HAS_AVX2_SUPPORT 1
+#define TINYAI_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* AArch64: NEON is part of the base architecture */
+#include <arm_neon.h>
+#define HAS_NEON_SUPPORT 1
+#endif
+
+/* Microkernel tile: rows of A by columns of B held in registers */
+#define GEMM_MR 6
+#define GEMM_NR 16
+
+/* Cache blocking, computed once from the cache sizes */
+typedef struct {
+    int kc; /* Depth of a block; a KC x NR panel of B and KC x MR of A fill half of L1 */
+    int mc; /* Rows of a packed A block, which fills half of L2 */
+    int nc; /* Columns of a packed B block, which stays within a quarter of L3 */
+} GemmBlocking;
+
+static GemmBlocking g_gemmBlocking;
+static bool         g_gemmBlockingInitialized = false;
+
+static int clampMultiple(size_t value, int multiple, int minValue, int maxValue)
+{
+    size_t rounded = value / (size_t)multiple * (size_t)multiple;
+    if (rounded < (size_t)minValue) {
+        return minValue;
+    }
+    return rounded > (size_t)maxValue ? maxValue : (int)rounded;
+}
+
+static GemmBlocking gemmBlocking(void)
+{
+    if (!g_gemmBlockingInitialized) {
+        TinyAICacheInfo info = tinyai_get_cache_info();
+        GemmBlocking    blocking;
+
+        blocking.kc = clampMultiple(info.l1dCacheSize / 2 / ((GEMM_MR + GEMM_NR) * sizeof(float)),
+                                    8, 64, 512);
+        blocking.mc = clampMultiple(info.l2CacheSize / 2 / (blocking.kc * sizeof(float)), GEMM_MR,
+                                    GEMM_MR, 1020);
+        blocking.nc = clampMultiple(info.l3CacheSize / 4 / (blocking.kc * sizeof(float)), GEMM_NR,
+                                    GEMM_NR, 4096);
+
+        g_gemmBlocking            = blocking;
+        g_gemmBlockingInitialized = true;
+    }
+    return g_gemmBlocking;
+}
+
+/**
+ * Microkernel: c[i * ldc + j] (+)= sum_k a[k * MR + i] * b[k * NR + j]
+ *
+ * a is one packed MR-row panel and b one packed NR-column panel, both kc
+ * deep. With accumulate set the tile is added to c, otherwise it replaces it.
+ */
+typedef void (*GemmKernel)(int kc, const float *a, const float *b, float *c, int ldc,
+                           int accumulate);
+
+static void gemmKernelReference(int kc, const float *a, const float *b, float *c, int ldc,
+                                int accumulate)
+{
+    float acc[GEMM_MR][GEMM_NR];
+    memset(acc, 0, sizeof(acc));
+
+    for (int k = 0; k < kc; k++) {
+        for (int i = 0; i < GEMM_MR; i++) {
+            for (int j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += a[i] * b[j];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    for (int i = 0; i < GEMM_MR; i++) {
+        for (int j = 0; j < GEMM_NR; j++) {
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + acc[i][j] : acc[i][j];
+        }
+    }
+}
+
+#if defined(HAS_AVX2_SUPPORT)
+/* AVX2 microkernel: 6 x 16 accumulators in twelve registers, one broadcast of A per row */
+static TINYAI_TARGET_AVX2 void gemmKernelAVX2(int kc, const float *a, const float *b, float *c,
+                                              int ldc, int accumulate)
+{
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (int k = 0; k < kc; k++) {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+        __m256 ai;
+
+        ai  = _mm256_broadcast_ss(a);
+        c00 = _mm256_fmadd_ps(ai, b0, c00);
+        c01 = _mm256_fmadd_ps(ai, b1, c01);
+        ai  = _mm256_broadcast_ss(a + 1);
+        c10 = _mm256_fmadd_ps(ai, b0, c10);
+        c11 = _mm256_fmadd_ps(ai, b1, c11);
+        ai  = _mm256_broadcast_ss(a + 2);
+        c20 = _mm256_fmadd_ps(ai, b0, c20);
+        c21 = _mm256_fmadd_ps(ai, b1, c21);
+        ai  = _mm256_broadcast_ss(a + 3);
+        c30 = _mm256_fmadd_ps(ai, b0, c30);
+        c31 = _mm256_fmadd_ps(ai, b1, c31);
+        ai  = _mm256_broadcast_ss(a + 4);
+        c40 = _mm256_fmadd_ps(ai, b0, c40);
+        c41 = _mm256_fmadd_ps(ai, b1, c41);
+        ai  = _mm256_broadcast_ss(a + 5);
+        c50 = _mm256_fmadd_ps(ai, b0, c50);
+        c51 = _mm256_fmadd_ps(ai, b1, c51);
+
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    __m256 tile[GEMM_MR][2] = {{c00, c01}, {c10, c11}, {c20, c21},
+                               {c30, c31}, {c40, c41}, {c50, c51}};
+    for (int i = 0; i < GEMM_MR; i++) {
+        float *row = c + i * ldc;
+        if (accumulate) {
+            tile[i][0] = _mm256_add_ps(tile[i][0], _mm256_loadu_ps(row));
+            tile[i][1] = _mm256_add_ps(tile[i][1], _mm256_loadu_ps(row + 8));
+        }
+        _mm256_storeu_ps(row, tile[i][0]);
+        _mm256_storeu_ps(row + 8, tile[i][1]);
+    }
+}
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+/* SSE2 microkernel: the 6 x 16 tile as two 6 x 8 halves, each in twelve registers */
+static void gemmKernelSSE2(int kc, const float *a, const float *b, float *c, int ldc,
+                           int accumulate)
+{
+    for (int half = 0; half < GEMM_NR; half += 8) {
+        const float *ap  = a;
+        const float *bp  = b + half;
+        __m128       acc[GEMM_MR][2];
+        for (int i = 0; i < GEMM_MR; i++) {
+            acc[i][0] = _mm_setzero_ps();
+            acc[i][1] = _mm_setzero_ps();
+        }
+
+        for (int k = 0; k < kc; k++) {
+            __m128 b0 = _mm_loadu_ps(bp);
+            __m128 b1 = _mm_loadu_ps(bp + 4);
+            for (int i = 0; i < GEMM_MR; i++) {
+                __m128 ai = _mm_set1_ps(ap[i]);
+                acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(ai, b0));
+                acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(ai, b1));
+            }
+            ap += GEMM_MR;
+            bp += GEMM_NR;
+        }
+
+        for (int i = 0; i < GEMM_MR; i++) {
+            float *row = c + i * ldc + half;
+            if (accumulate) {
+                acc[i][0] = _mm_add_ps(acc[i][0], _mm_loadu_ps(row));
+                acc[i][1] = _mm_add_ps(acc[i][1], _mm_loadu_ps(row + 4));
+            }
+            _mm_storeu_ps(row, acc[i][0]);
+            _mm_storeu_ps(row + 4, acc[i][1]);
+        }
+    }
+}
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+/* NEON microkernel: the full 6 x 16 tile in 24 of the 32 vector registers */
+static void gemmKernelNEON(int kc, const float *a, const float *b, float *c, int ldc,
+                           int accumulate)
+{
+    float32x4_t acc[GEMM_MR][4];
+    for (int i = 0; i < GEMM_MR; i++) {
+        for (int v = 0; v < 4; v++) {
+            acc[i][v] = vdupq_n_f32(0.0f);
+        }
+    }
+
+    for (int k = 0; k < kc; k++) {
+        float32x4_t bv[4] = {vld1q_f32(b), vld1q_f32(b + 4), vld1q_f32(b + 8), vld1q_f32(b + 12)};
+        for (int i = 0; i < GEMM_MR; i++) {
+            for (int v = 0; v < 4; v++) {
+                acc[i][v] = vfmaq_n_f32(acc[i][v], bv[v], a[i]);
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_NR;
+    }
+
+    for (int i = 0; i < GEMM_MR; i++) {
+        float *row = c + i * ldc;
+        for (int v = 0; v < 4; v++) {
+            float32x4_t value = accumulate ? vaddq_f32(acc[i][v], vld1q_f32(row + 4 * v))
+                                           : acc[i][v];
+            vst1q_f32(row + 4 * v, value);
+        }
+    }
+}
+#endif
+
+/* Pick the widest microkernel the CPU supports */
+static GemmKernel selectGemmKernel(void)
+{
+#if defined(HAS_AVX2_SUPPORT)
+    if (tinyaiSimdHasAVX2()) {
+        return gemmKernelAVX2;
+    }
+#endif
+
+#if defined(HAS_NEON_SUPPORT)
+    if (tinyaiSimdHasNEON()) {
+        return gemmKernelNEON;
+    }
+#endif
+
+#if defined(HAS_SSE2_SUPPORT)
+    if (tinyaiSimdAvailable()) {
+        return gemmKernelSSE2;
+    }
+#endif
+
+    return gemmKernelReference;
+}
+
+/* Dequantize rows [row0, row0 + rows) and columns [k0, k0 + kc) of A into MR-row panels,
+   padding the last panel with zero rows; the scale of each row is folded into its weights */
+static void packA(float *dst, const uint8_t *a, const float *scaleFactors, int colsA, int row0,
+                  int rows, int k0, int kc)
+{
+    int bytesPerRow = (colsA + 1) / 2;
+
+    for (int p = 0; p < rows; p += GEMM_MR) {
+        float *panel = dst + (size_t)p * kc;
+        for (int i = 0; i < GEMM_MR; i++) {
+            if (p + i >= rows) {
+                for (int k = 0; k < kc; k++) {
+                    panel[k * GEMM_MR + i] = 0.0f;
+                }
+                continue;
+            }
+
+            /* Blocks start at a multiple of KC, which is even, so every byte holds a column pair */
+            const uint8_t *rowData = a + (size_t)(row0 + p + i) * bytesPerRow + k0 / 2;
+            float          scale   = scaleFactors[row0 + p + i];
+            float         *col     = panel + i;
+            int            k       = 0;
+            for (; k + 2 <= kc; k += 2) {
+                uint8_t packed = rowData[k / 2];
+                col[0]         = (float)((int)(packed & 0x0F) - 8) * scale;
+                col[GEMM_MR]   = (float)((int)(packed >> 4) - 8) * scale;
+                col += 2 * GEMM_MR;
+            }
+            if (k < kc) {
+                *col = (float)((int)(rowData[k / 2] & 0x0F) - 8) * scale;
+            }
+        }
+    }
+}
+
+/* Copy rows [k0, k0 + kc) and columns [col0, col0 + cols) of B into NR-column panels,
+   padding the last panel with zero columns */
+static void packB(float *dst, const float *b, int colsB, int k0, int kc, int col0, int cols)
+{
+    for (int p = 0; p < cols; p += GEMM_NR) {
+        float *panel = dst + (size_t)p * kc;
+        int    width = cols - p < GEMM_NR ? cols - p : GEMM_NR;
+
+        for (int k = 0; k < kc; k++) {
+            const float *src = b + (size_t)(k0 + k) * colsB + col0 + p;
+            memcpy(panel + k * GEMM_NR, src, width * sizeof(float));
+            for (int j = width; j < GEMM_NR; j++) {
+                panel[k * GEMM_NR + j] = 0.0f;
+            }
+        }
+    }
+}
+
+/* Output tiles of a 4-bit matrix-matrix product, run as a thread pool task */
+typedef struct {
+    float         *out;
+    const uint8_t *a;
+    const float   *b;
+    const float   *scaleFactors;
+    int            rowsA;
+    int            colsA;
+    int            colsB;
+    int            mc;     /* Rows of an output tile, a multiple of GEMM_MR */
+    int            nc;     /* Columns of an output tile, a multiple of GEMM_NR */
+    int            kc;     /* Depth of a packed block */
+    int            mTiles; /* Output tiles down the rows */
+    GemmKernel     kernel;
+} Gemm4BitTask;
+
+/* Straightforward product of one output tile, used when the packing buffers cannot be allocated */
+static void gemmTileReference(const Gemm4BitTask *task, int row0, int rows, int col0, int cols)
+{
+    int bytesPerRow = (task->colsA + 1) / 2;
+
+    for (int r = row0; r < row0 + rows; r++) {
+        const uint8_t *rowData = task->a + (size_t)r * bytesPerRow;
+        for (int c = col0; c < col0 + cols; c++) {
+            float sum = 0.0f;
+            for (int k = 0; k < task->colsA; k++) {
+                uint8_t packed = rowData[k / 2];
+                uint8_t nibble = (k % 2 == 0) ? (packed & 0x0F) : ((packed >> 4) & 0x0F);
+                sum += (float)((int)nibble - 8) * task->b[(size_t)k * task->colsB + c];
+            }
+            task->out[(size_t)r * task->colsB + c] = sum * task->scaleFactors[r];
+        }
+    }
+}
+
+static void gemm4BitTiles(void *context, size_t begin, size_t end)
+{
+    const Gemm4BitTask *task = (const Gemm4BitTask *)context;
+
+    float *packedA = (float *)malloc((size_t)task->mc * task->kc * sizeof(float));
+    float *packedB = (float *)malloc((size_t)task->nc * task->kc * sizeof(float));
+
+    for (size_t tile = begin; tile < end; tile++) {
+        int row0 = (int)(tile % (size_t)task->mTiles) * task->mc;
+        int col0 = (int)(tile / (size_t)task->mTiles) * task->nc;
+        int rows = task->rowsA - row0 < task->mc ? task->rowsA - row0 : task->mc;
+        int cols = task->colsB - col0 < task->nc ? task->colsB - col0 : task->nc;
+
+        if (!packedA || !packedB) {
+            gemmTileReference(task, row0, rows, col0, cols);
+            continue;
+        }
+
+        for (int k0 = 0; k0 < task->colsA; k0 += task->kc) {
+            int kc         = task->colsA - k0 < task->kc ? task->colsA - k0 : task->kc;
+            int accumulate = k0 > 0;
+
+            packB(packedB, task->b, task->colsB, k0, kc, col0, cols);
+            packA(packedA, task->a, task->scaleFactors, task->colsA, row0, rows, k0, kc);
+
+            for (int j = 0; j < cols; j += GEMM_NR) {
+                const float *panelB = packedB + (size_t)j * kc;
+                int          width  = cols - j < GEMM_NR ? cols - j : GEMM_NR;
+
+                for (int i = 0; i < rows; i += GEMM_MR) {
+                    const float *panelA = packedA + (size_t)i * kc;
+                    int          height = rows - i < GEMM_MR ? rows - i : GEMM_MR;
+                    float       *dst    = task->out + (size_t)(row0 + i) * task->colsB + col0 + j;
+
+                    if (height == GEMM_MR && width == GEMM_NR) {
+                        task->kernel(kc, panelA, panelB, dst, task->colsB, accumulate);
+                        continue;
+                    }
+
+                    /* Partial tile at the bottom or right edge goes through a scratch tile */
+                    float edge[GEMM_MR * GEMM_NR];
+                    task->kernel(kc, panelA, panelB, edge, GEMM_NR, 0);
+                    for (int r = 0; r < height; r++) {
+                        for (int c = 0; c < width; c++) {
+                            float *value = dst + (size_t)r * task->colsB + c;
+                            *value = accumulate ? *value + edge[r * GEMM_NR + c]
+                                                : edge[r * GEMM_NR + c];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    free(packedA);
+    free(packedB);
+}
+
+/* Matrix-vector product for each column of B, for batches too small to pack */
+static void matMul4BitColumns(float *out, const uint8_t *a, const float *b, int rowsA, int colsA,
+                              int colsB, const float *scaleFactors)
+{
+    float *temp   = (float *)malloc(rowsA * sizeof(float));
+    float *column = (float *)malloc(colsA * sizeof(float));
+
+    if (temp && column) {
+        for (int colB = 0; colB < colsB; colB++) {
+            /* Extract column from B */
+            for (int i = 0; i < colsA; i++) {
+                column[i] = b[i * colsB + colB];
+            }
+
+            /* Multiply A by this column */
+            tinyaiSimdMatMul4Bit(temp, a, column, rowsA, colsA, scaleFactors);
+
+            /* Store results in output */
+            for (int rowA = 0; rowA < rowsA; rowA++) {
+                out[rowA * colsB + colB] = temp[rowA];
+            }
+        }
+    }
+
+    free(column);
+    free(temp);
+}
+
+void tinyaiSimdMatMul4BitMM(float *out, const uint8_t *a, const float *b, int rowsA, int colsA,
+                            int colsB, const float *scaleFactors)
+{
+    if (rowsA <= 0 || colsB <= 0) {
+        return;
+    }
+
+    /* A single column of B is a matrix-vector product */
+    if (colsB == 1) {
+        tinyaiSimdMatMul4Bit(out, a, b, rowsA, colsA, scaleFactors);
+        return;
+    }
+
+    /* Narrower than one microkernel tile, dequantizing A costs more than the packed kernel saves */
+    if (colsB < GEMM_NR) {
+        matMul4BitColumns(out, a, b, rowsA, colsA, colsB, scaleFactors);
+        return;
+    }
+
+    if (colsA <= 0) {
+        memset(out, 0, (size_t)rowsA * colsB * sizeof(float));
+        return;
+    }
+
+    GemmBlocking      blocking = gemmBlocking();
+    TinyAIThreadPool *pool     = tinyaiGetThreadPool();
+
+    Gemm4BitTask task;
+    task.out          = out;
+    task.a            = a;
+    task.b            = b;
+    task.scaleFactors = scaleFactors;
+    task.rowsA        = rowsA;
+    task.colsA        = colsA;
+    task.colsB        = colsB;
+    task.kc           = blocking.kc;
+    task.mc           = blocking.mc;
+    task.nc           = blocking.nc;
+    task.kernel       = selectGemmKernel();
+
+    /* Do not allocate more than the matrices need */
+    int rowsRounded = (rowsA + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+    int colsRounded = (colsB + GEMM_NR - 1) / GEMM_NR * GEMM_NR;
+    if (task.kc > colsA) {
+        task.kc = colsA;
+    }
+    if (task.mc > rowsRounded) {
+        task.mc = rowsRounded;
+    }
+    if (task.nc > colsRounded) {
+        task.nc = colsRounded;
+    }
+
+    /* Small batches have a single column tile, so split the rows finer to give every thread one */
+    int threads = tinyaiThreadPoolSize(pool);
+    int nTiles  = (colsB + task.nc - 1) / task.nc;
+    if (threads > 1 && nTiles < threads) {
+        int perThread = (rowsA + threads - 1) / threads;
+        perThread     = (perThread + GEMM_MR - 1) / GEMM_MR * GEMM_MR;
+        if (perThread < task.mc) {
+            task.mc = perThread;
+        }
+    }
+    task.mTiles = (rowsA + task.mc - 1) / task.mc;
+
+    size_t workPerTile = (size_t)task.mc * task.nc * colsA;
+    tinyaiParallelFor(pool, (size_t)task.mTiles * nTiles,
+                      tinyaiThreadPoolGrain(pool, workPerTile, 1), gemm4BitTiles, &task);
+}
@@ -5,6 +5,7 @@
 
 #include "sparse_ops.h"
 #include "memory.h"
+#include "thread_pool.h"
 #include <assert.h>
 #include <float.h>
 #include <math.h>
@@ -20,6 +21,61 @@
 #include <emmintrin.h>
 #include <xmmintrin.h>
 #define TINYAI_SIMD_SSE
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TINYAI_SIMD_NEON
+#endif
+
+#if defined(TINYAI_SIMD_AVX) || defined(TINYAI_SIMD_SSE)
+/**
+ * Unpack 8 packed 4-bit values (4 bytes, low nibble first) into two float vectors
+ */
+static inline void sparseUnpackNibblesSSE2(const uint8_t *bytes, __m128 *lo, __m128 *hi)
+{
+    int32_t bits;
+    memcpy(&bits, bytes, sizeof(bits));
+
+    __m128i packed = _mm_cvtsi32_si128(bits);
+    __m128i mask   = _mm_set1_epi8(0x0F);
+    __m128i q8     = _mm_unpacklo_epi8(_mm_and_si128(packed, mask),
+                                       _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+    __m128i zero   = _mm_setzero_si128();
+    __m128i q16    = _mm_unpacklo_epi8(q8, zero);
+
+    *lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q16, zero));
+    *hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(q16, zero));
+}
+#endif
+
+#ifdef TINYAI_SIMD_AVX
+/**
+ * Fused multiply-add when the target has FMA, separate multiply and add otherwise
+ */
+static inline __m256 sparseFmaAVX(__m256 a, __m256 b, __m256 c)
+{
+#ifdef __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+static inline float sparseHorizontalSumAVX(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum        = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum        = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#ifdef TINYAI_SIMD_SSE
+static inline float sparseHorizontalSumSSE(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+    return _mm_cvtss_f32(v);
+}
 #endif
 
 /**
@@ -81,6 +137,118 @@ TinyAICSRMatrix *tinyaiCreateCSRMatrixFromDense(const float *dense, int32_t rows
     return csr;
 }
 
+/* Delta-encoded column indices of 4-bit CSR matrices */
+
+/**
+ * Encode the gap between two columns of a row, writing it to out unless out
+ * is NULL; returns the bytes it takes
+ */
+static int32_t csrEncodeDelta(uint8_t *out, int32_t prevCol, int32_t col)
+{
+    int32_t delta = col - prevCol;
+
+    if (delta < TINYAI_CSR_DELTA_ESCAPE) {
+        if (out) {
+            out[0] = (uint8_t)delta;
+        }
+        return 1;
+    }
+
+    if (delta < 0xFFFF) {
+        if (out) {
+            out[0] = TINYAI_CSR_DELTA_ESCAPE;
+            out[1] = (uint8_t)(delta & 0xFF);
+            out[2] = (uint8_t)(delta >> 8);
+        }
+        return 3;
+    }
+
+    /* Gaps too wide for 16 bits store the absolute column */
+    if (out) {
+        out[0] = TINYAI_CSR_DELTA_ESCAPE;
+        out[1] = 0xFF;
+        out[2] = 0xFF;
+        for (int k = 0; k < 4; k++) {
+            out[3 + k] = (uint8_t)((uint32_t)col >> (8 * k));
+        }
+    }
+    return 7;
+}
+
+/**
+ * Decode the next column index of a row from its delta stream
+ */
+static inline int32_t csrNextColumn(const uint8_t **deltas, int32_t col)
+{
+    const uint8_t *p = *deltas;
+
+    if (p[0] != TINYAI_CSR_DELTA_ESCAPE) {
+        *deltas = p + 1;
+        return col + p[0];
+    }
+
+    int32_t delta = p[1] | (p[2] << 8);
+    if (delta != 0xFFFF) {
+        *deltas = p + 3;
+        return col + delta;
+    }
+
+    *deltas = p + 7;
+    return (int32_t)((uint32_t)p[3] | ((uint32_t)p[4] << 8) | ((uint32_t)p[5] << 16) |
+                     ((uint32_t)p[6] << 24));
+}
+
+/**
+ * Decode the next 8 column indices of a row, returning the last one
+ *
+ * Runs of 8 one-byte gaps, the common case, are prefix-summed in a vector;
+ * the stream's padding keeps the 8-byte load in bounds.
+ */
+static inline int32_t csrDecodeColumns8(const uint8_t **deltas, int32_t col, int32_t *cols)
+{
+#if defined(TINYAI_SIMD_AVX) || defined(TINYAI_SIMD_SSE)
+    __m128i bytes   = _mm_loadl_epi64((const __m128i *)*deltas);
+    __m128i escapes = _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)TINYAI_CSR_DELTA_ESCAPE));
+    if ((_mm_movemask_epi8(escapes) & 0xFF) == 0) {
+        /* Inclusive prefix sum over 16-bit lanes (at most 8 * 254) */
+        __m128i zero = _mm_setzero_si128();
+        __m128i sums = _mm_unpacklo_epi8(bytes, zero);
+        sums         = _mm_add_epi16(sums, _mm_slli_si128(sums, 2));
+        sums         = _mm_add_epi16(sums, _mm_slli_si128(sums, 4));
+        sums         = _mm_add_epi16(sums, _mm_slli_si128(sums, 8));
+
+        __m128i base = _mm_set1_epi32(col);
+        _mm_storeu_si128((__m128i *)cols, _mm_add_epi32(base, _mm_unpacklo_epi16(sums, zero)));
+        _mm_storeu_si128((__m128i *)(cols + 4),
+                         _mm_add_epi32(base, _mm_unpackhi_epi16(sums, zero)));
+        *deltas += 8;
+        return cols[7];
+    }
+#elif defined(TINYAI_SIMD_NEON)
+    uint8x8_t bytes = vld1_u8(*deltas);
+    if (vmaxv_u8(bytes) != TINYAI_CSR_DELTA_ESCAPE) {
+        /* Inclusive prefix sum over 16-bit lanes (at most 8 * 254) */
+        uint16x8_t zero = vdupq_n_u16(0);
+        uint16x8_t sums = vmovl_u8(bytes);
+        sums            = vaddq_u16(sums, vextq_u16(zero, sums, 7));
+        sums            = vaddq_u16(sums, vextq_u16(zero, sums, 6));
+        sums            = vaddq_u16(sums, vextq_u16(zero, sums, 4));
+
+        int32x4_t base = vdupq_n_s32(col);
+        vst1q_s32(cols, vaddq_s32(base, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(sums)))));
+        vst1q_s32(cols + 4, vaddq_s32(base, vreinterpretq_s32_u32(vmovl_high_u16(sums))));
+        *deltas += 8;
+        return cols[7];
+    }
+#endif
+
+    for (int k = 0; k < 8; k++) {
+        col     = csrNextColumn(deltas, col);
+        cols[k] = col;
+    }
+    return col;
+}
+
 /**
  * Create a 4-bit quantized CSR matrix from dense matrix data with sparsity threshold
  */
@@ -91,16 +259,20 @@ TinyAICSRMatrix4Bit *tinyaiCreateCSRMatrix4BitFromDense(const float *dense, int3
         return NULL;
     }
 
-    /* First pass: count non-zero elements and find min/max values */
-    int32_t nnz    = 0;
-    float   minVal = FLT_MAX;
-    float   maxVal = -FLT_MAX;
+    /* First pass: count non-zero elements and delta bytes, and find min/max values */
+    int32_t nnz        = 0;
+    int32_t deltaBytes = 0;
+    float   minVal     = FLT_MAX;
+    float   maxVal     = -FLT_MAX;
 
     for (int32_t i = 0; i < rows; i++) {
+        int32_t prevCol = 0;
         for (int32_t j = 0; j < cols; j++) {
             float val = dense[i * cols + j];
             if (fabsf(val) >= threshold) {
                 nnz++;
+                deltaBytes += csrEncodeDelta(NULL, prevCol, j);
+                prevCol = j;
                 if (val < minVal)
                     minVal = val;
                 if (val > maxVal)
@@ -110,14 +282,15 @@ TinyAICSRMatrix4Bit *tinyaiCreateCSRMatrix4BitFromDense(const float *dense, int3
     }
 
     /* Allocate CSR matrix */
-    TinyAICSRMatrix4Bit *csr = (TinyAICSRMatrix4Bit *)malloc(sizeof(TinyAICSRMatrix4Bit));
+    TinyAICSRMatrix4Bit *csr = (TinyAICSRMatrix4Bit *)calloc(1, sizeof(TinyAICSRMatrix4Bit));
     if (!csr) {
         return NULL;
     }
 
-    csr->rows = rows;
-    csr->cols = cols;
-    csr->nnz  = nnz;
+    csr->rows       = rows;
+    csr->cols       = cols;
+    csr->nnz        = nnz;
+    csr->deltaBytes = deltaBytes;
 
     /* Calculate quantization parameters */
     float range    = maxVal - minVal;
@@ -128,10 +301,11 @@ TinyAICSRMatrix4Bit *tinyaiCreateCSRMatrix4BitFromDense(const float *dense, int3
     /* Each qvalue takes 4 bits, so we need nnz/2 bytes (rounded up) */
     size_t qvaluesSize = (nnz + 1) / 2;
     csr->qvalues       = (uint8_t *)malloc(qvaluesSize);
-    csr->colIndices    = (int32_t *)malloc(nnz * sizeof(int32_t));
+    csr->colDeltas     = (uint8_t *)calloc(deltaBytes + TINYAI_CSR_DELTA_PADDING, 1);
+    csr->deltaPtrs     = (int32_t *)malloc((rows + 1) * sizeof(int32_t));
     csr->rowPtrs       = (int32_t *)malloc((rows + 1) * sizeof(int32_t));
 
-    if (!csr->qvalues || !csr->colIndices || !csr->rowPtrs) {
+    if (!csr->qvalues || !csr->colDeltas || !csr->deltaPtrs || !csr->rowPtrs) {
         tinyaiCSRMatrix4BitFree(csr);
         return NULL;
     }
@@ -140,10 +314,13 @@ TinyAICSRMatrix4Bit *tinyaiCreateCSRMatrix4BitFromDense(const float *dense, int3
     memset(csr->qvalues, 0, qvaluesSize);
 
     /* Second pass: fill in CSR matrix */
-    csr->rowPtrs[0] = 0;
-    int32_t idx     = 0;
+    csr->rowPtrs[0]   = 0;
+    csr->deltaPtrs[0] = 0;
+    int32_t idx       = 0;
+    int32_t deltaIdx  = 0;
 
     for (int32_t i = 0; i < rows; i++) {
+        int32_t prevCol = 0;
         for (int32_t j = 0; j < cols; j++) {
             float val = dense[i * cols + j];
             if (fabsf(val) >= threshold) {
@@ -159,11 +336,13 @@ TinyAICSRMatrix4Bit *tinyaiCreateCSRMatrix4BitFromDense(const float *dense, int3
                     csr->qvalues[idx / 2] |= (qval << 4);
                 }
 
-                csr->colIndices[idx] = j;
+                deltaIdx += csrEncodeDelta(&csr->colDeltas[deltaIdx], prevCol, j);
+                prevCol = j;
                 idx++;
             }
         }
-        csr->rowPtrs[i + 1] = idx;
+        csr->rowPtrs[i + 1]   = idx;
+        csr->deltaPtrs[i + 1] = deltaIdx;
     }
 
     return csr;
@@ -209,8 +388,10 @@ bool tinyaiCSRMatrix4BitToDense(const TinyAICSRMatrix4Bit *csr, float *dense)
 
     /* Fill in non-zero values */
     for (int32_t i = 0; i < csr->rows; i++) {
-        int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
+        int32_t        rowStart = csr->rowPtrs[i];
+        int32_t        rowEnd   = csr->rowPtrs[i + 1];
+        const uint8_t *deltas   = &csr->colDeltas[csr->deltaPtrs[i]];
+        int32_t        col      = 0;
 
         for (int32_t j = rowStart; j < rowEnd; j++) {
             /* Extract 4-bit value */
@@ -225,7 +406,7 @@ bool tinyaiCSRMatrix4BitToDense(const TinyAICSRMatrix4Bit *csr, float *dense)
             /* Dequantize */
             float val = qval * csr->scale + csr->zeroPoint;
 
-            int32_t col                = csr->colIndices[j];
+            col                        = csrNextColumn(&deltas, col);
             dense[i * csr->cols + col] = val;
         }
     }
@@ -270,8 +451,12 @@ void tinyaiCSRMatrix4BitFree(TinyAICSRMatrix4Bit *csr)
         free(csr->qvalues);
     }
 
-    if (csr->colIndices) {
-        free(csr->colIndices);
+    if (csr->colDeltas) {
+        free(csr->colDeltas);
+    }
+
+    if (csr->deltaPtrs) {
+        free(csr->deltaPtrs);
     }
 
     if (csr->rowPtrs) {
@@ -282,49 +467,47 @@ void tinyaiCSRMatrix4BitFree(TinyAICSRMatrix4Bit *csr)
 }
 
 /**
- * Perform sparse matrix-vector multiplication: y = A * x
+ * Scalar CSR matrix-vector product over rows [rowBegin, rowEnd)
  */
-bool tinyaiCSRMatrixVectorMul(const TinyAICSRMatrix *csr, const float *x, float *y)
+static void csrRowsScalar(const TinyAICSRMatrix *csr, const float *x, float *y, int32_t rowBegin,
+                          int32_t rowEnd)
 {
-    if (!csr || !x || !y) {
-        return false;
-    }
-
-    /* Initialize output vector to zero */
-    memset(y, 0, csr->rows * sizeof(float));
-
-    /* Perform CSR matrix-vector multiplication */
-    for (int32_t i = 0; i < csr->rows; i++) {
-        int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
-
-        for (int32_t j = rowStart; j < rowEnd; j++) {
-            int32_t col = csr->colIndices[j];
-            y[i] += csr->values[j] * x[col];
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
+        float rowSum = 0.0f;
+        for (int32_t j = csr->rowPtrs[i]; j < csr->rowPtrs[i + 1]; j++) {
+            rowSum += csr->values[j] * x[csr->colIndices[j]];
         }
+        y[i] = rowSum;
     }
-
-    return true;
 }
 
 /**
- * Perform 4-bit quantized sparse matrix-vector multiplication: y = A * x
+ * Perform sparse matrix-vector multiplication: y = A * x
  */
-bool tinyaiCSRMatrix4BitVectorMul(const TinyAICSRMatrix4Bit *csr, const float *x, float *y)
+bool tinyaiCSRMatrixVectorMul(const TinyAICSRMatrix *csr, const float *x, float *y)
 {
     if (!csr || !x || !y) {
         return false;
     }
 
-    /* Initialize output vector to zero */
-    memset(y, 0, csr->rows * sizeof(float));
-
-    /* Perform CSR matrix-vector multiplication */
-    for (int32_t i = 0; i < csr->rows; i++) {
-        int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
+    csrRowsScalar(csr, x, y, 0, csr->rows);
+    return true;
+}
 
-        for (int32_t j = rowStart; j < rowEnd; j++) {
+/**
+ * Scalar 4-bit CSR matrix-vector product over rows [rowBegin, rowEnd)
+ */
+static void csr4BitRowsScalar(const TinyAICSRMatrix4Bit *csr, const float *x, float *y,
+                              int32_t rowBegin, int32_t rowEnd)
+{
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
+        int32_t        rowStart = csr->rowPtrs[i];
+        int32_t        rowStop  = csr->rowPtrs[i + 1];
+        const uint8_t *deltas   = &csr->colDeltas[csr->deltaPtrs[i]];
+        int32_t        col      = 0;
+        float          rowSum   = 0.0f;
+
+        for (int32_t j = rowStart; j < rowStop; j++) {
             /* Extract 4-bit value */
             uint8_t qval;
             if (j % 2 == 0) {
@@ -337,38 +520,45 @@ bool tinyaiCSRMatrix4BitVectorMul(const TinyAICSRMatrix4Bit *csr, const float *x
             /* Dequantize */
             float val = qval * csr->scale + csr->zeroPoint;
 
-            int32_t col = csr->colIndices[j];
-            y[i] += val * x[col];
+            col = csrNextColumn(&deltas, col);
+            rowSum += val * x[col];
         }
-    }
 
-    return true;
+        y[i] = rowSum;
+    }
 }
 
-#ifdef TINYAI_SIMD_AVX
 /**
- * Perform SIMD-accelerated sparse matrix-vector multiplication: y = A * x (AVX version)
+ * Perform 4-bit quantized sparse matrix-vector multiplication: y = A * x
  */
-bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, float *y)
+bool tinyaiCSRMatrix4BitVectorMul(const TinyAICSRMatrix4Bit *csr, const float *x, float *y)
 {
     if (!csr || !x || !y) {
         return false;
     }
 
-    /* Initialize output vector to zero */
-    memset(y, 0, csr->rows * sizeof(float));
+    csr4BitRowsScalar(csr, x, y, 0, csr->rows);
+    return true;
+}
 
+#ifdef TINYAI_SIMD_AVX
+/**
+ * SIMD CSR matrix-vector product over rows [rowBegin, rowEnd) (AVX version)
+ */
+static void csrRowsSIMD(const TinyAICSRMatrix *csr, const float *x, float *y, int32_t rowBegin,
+                        int32_t rowEnd)
+{
     /* Perform CSR matrix-vector multiplication with AVX */
-    for (int32_t i = 0; i < csr->rows; i++) {
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
         int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
+        int32_t rowStop  = csr->rowPtrs[i + 1];
 
         /* Process 8 elements at a time using AVX */
         int32_t j   = rowStart;
         __m256  sum = _mm256_setzero_ps();
 
         /* Process 8 elements at a time */
-        for (; j + 7 < rowEnd; j += 8) {
+        for (; j + 7 < rowStop; j += 8) {
             /* Load values and indices */
             __m256 values = _mm256_loadu_ps(&csr->values[j]);
 
@@ -398,156 +588,91 @@ bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, fl
         }
 
         /* Process remaining elements */
-        for (; j < rowEnd; j++) {
+        for (; j < rowStop; j++) {
             int32_t col = csr->colIndices[j];
             rowSum += csr->values[j] * x[col];
         }
 
         y[i] = rowSum;
     }
-
-    return true;
 }
 
 /**
- * Perform SIMD-accelerated 4-bit quantized sparse matrix-vector multiplication: y = A * x (AVX
- * version)
+ * SIMD 4-bit CSR matrix-vector product over rows [rowBegin, rowEnd) (AVX version)
+ *
+ * Each row is summed as scale * sum(q * x) + zeroPoint * sum(x), so the
+ * quantized values never need dequantizing one by one.
  */
-bool tinyaiCSRMatrix4BitVectorMulSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y)
+static void csr4BitRowsSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y,
+                            int32_t rowBegin, int32_t rowEnd)
 {
-    if (!csr || !x || !y) {
-        return false;
-    }
-
-    /* Initialize output vector to zero */
-    memset(y, 0, csr->rows * sizeof(float));
-
-    /* Create constants for dequantization */
-    __m256 vscale = _mm256_set1_ps(csr->scale);
-    __m256 vzero  = _mm256_set1_ps(csr->zeroPoint);
-
-    /* Perform CSR matrix-vector multiplication with AVX */
-    for (int32_t i = 0; i < csr->rows; i++) {
-        int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
-
-        /* Process in chunks of 8 (for AVX) */
-        int32_t j   = rowStart;
-        __m256  sum = _mm256_setzero_ps();
-
-        /* Ensure we process aligned chunks of 16 elements (8 bytes in 4-bit format) */
-        int32_t alignedEnd = rowStart + ((rowEnd - rowStart) / 16) * 16;
-
-        for (; j < alignedEnd; j += 16) {
-            /* Load 8 bytes (16 quantized values) */
-            uint8_t qvals[8];
-            for (int k = 0; k < 8; k++) {
-                qvals[k] = csr->qvalues[(j + k * 2) / 2];
-            }
-
-            /* First 8 values (lower 4 bits of each byte) */
-            int32_t cols1[8];
-            float   vals1[8];
-
-            for (int k = 0; k < 8; k++) {
-                /* Extract and dequantize values */
-                uint8_t qval = qvals[k] & 0x0F;
-                vals1[k]     = qval * csr->scale + csr->zeroPoint;
-
-                /* Get column indices */
-                cols1[k] = csr->colIndices[j + k * 2];
-            }
-
-            /* Load x values for first 8 */
-            __m256 xvals1 = _mm256_set_ps(x[cols1[7]], x[cols1[6]], x[cols1[5]], x[cols1[4]],
-                                          x[cols1[3]], x[cols1[2]], x[cols1[1]], x[cols1[0]]);
-
-            /* Load dequantized values for first 8 */
-            __m256 vvals1 = _mm256_loadu_ps(vals1);
-
-            /* Multiply and accumulate first 8 */
-            sum = _mm256_add_ps(sum, _mm256_mul_ps(vvals1, xvals1));
-
-            /* Second 8 values (upper 4 bits of each byte) */
-            int32_t cols2[8];
-            float   vals2[8];
-
-            for (int k = 0; k < 8; k++) {
-                /* Extract and dequantize values */
-                uint8_t qval = (qvals[k] >> 4) & 0x0F;
-                vals2[k]     = qval * csr->scale + csr->zeroPoint;
-
-                /* Get column indices */
-                cols2[k] = csr->colIndices[j + k * 2 + 1];
-            }
-
-            /* Load x values for second 8 */
-            __m256 xvals2 = _mm256_set_ps(x[cols2[7]], x[cols2[6]], x[cols2[5]], x[cols2[4]],
-                                          x[cols2[3]], x[cols2[2]], x[cols2[1]], x[cols2[0]]);
-
-            /* Load dequantized values for second 8 */
-            __m256 vvals2 = _mm256_loadu_ps(vals2);
-
-            /* Multiply and accumulate second 8 */
-            sum = _mm256_add_ps(sum, _mm256_mul_ps(vvals2, xvals2));
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
+        int32_t        rowStart = csr->rowPtrs[i];
+        int32_t        rowStop  = csr->rowPtrs[i + 1];
+        const uint8_t *deltas   = &csr->colDeltas[csr->deltaPtrs[i]];
+        int32_t        col      = 0;
+        int32_t        j        = rowStart;
+        float          qxSum    = 0.0f;
+        float          xSum     = 0.0f;
+
+        /* A row starting in the high nibble of a byte takes one element first */
+        if ((j & 1) && j < rowStop) {
+            col        = csrNextColumn(&deltas, col);
+            float xval = x[col];
+            qxSum += (float)((csr->qvalues[j / 2] >> 4) & 0x0F) * xval;
+            xSum += xval;
+            j++;
         }
 
-        /* Reduce sum vector to single value */
-        float temp[8];
-        _mm256_storeu_ps(temp, sum);
-        float rowSum = 0.0f;
-        for (int k = 0; k < 8; k++) {
-            rowSum += temp[k];
+        /* 8 elements (4 bytes, low nibble first) at a time */
+        __m256 qxVec = _mm256_setzero_ps();
+        __m256 xVec  = _mm256_setzero_ps();
+        for (; j + 8 <= rowStop; j += 8) {
+            int32_t cols[8];
+            col = csrDecodeColumns8(&deltas, col, cols);
+            __m256 xv = _mm256_setr_ps(x[cols[0]], x[cols[1]], x[cols[2]], x[cols[3]],
+                                       x[cols[4]], x[cols[5]], x[cols[6]], x[cols[7]]);
+            __m128 qLo, qHi;
+            sparseUnpackNibblesSSE2(&csr->qvalues[j / 2], &qLo, &qHi);
+            qxVec = sparseFmaAVX(_mm256_insertf128_ps(_mm256_castps128_ps256(qLo), qHi, 1), xv,
+                                 qxVec);
+            xVec  = _mm256_add_ps(xVec, xv);
         }
+        qxSum += sparseHorizontalSumAVX(qxVec);
+        xSum += sparseHorizontalSumAVX(xVec);
 
         /* Process remaining elements */
-        for (; j < rowEnd; j++) {
-            /* Extract 4-bit value */
-            uint8_t qval;
-            if (j % 2 == 0) {
-                qval = csr->qvalues[j / 2] & 0x0F;
-            }
-            else {
-                qval = (csr->qvalues[j / 2] >> 4) & 0x0F;
-            }
-
-            /* Dequantize */
-            float val = qval * csr->scale + csr->zeroPoint;
-
-            int32_t col = csr->colIndices[j];
-            rowSum += val * x[col];
+        for (; j < rowStop; j++) {
+            uint8_t qval = (j % 2 == 0) ? (csr->qvalues[j / 2] & 0x0F)
+                                        : ((csr->qvalues[j / 2] >> 4) & 0x0F);
+            col          = csrNextColumn(&deltas, col);
+            float xval   = x[col];
+            qxSum += (float)qval * xval;
+            xSum += xval;
         }
 
-        y[i] = rowSum;
+        y[i] = csr->scale * qxSum + csr->zeroPoint * xSum;
     }
-
-    return true;
 }
 
 #elif defined(TINYAI_SIMD_SSE)
 /**
- * Perform SIMD-accelerated sparse matrix-vector multiplication: y = A * x (SSE version)
+ * SIMD CSR matrix-vector product over rows [rowBegin, rowEnd) (SSE version)
  */
-bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, float *y)
+static void csrRowsSIMD(const TinyAICSRMatrix *csr, const float *x, float *y, int32_t rowBegin,
+                        int32_t rowEnd)
 {
-    if (!csr || !x || !y) {
-        return false;
-    }
-
-    /* Initialize output vector to zero */
-    memset(y, 0, csr->rows * sizeof(float));
-
     /* Perform CSR matrix-vector multiplication with SSE */
-    for (int32_t i = 0; i < csr->rows; i++) {
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
         int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
+        int32_t rowStop  = csr->rowPtrs[i + 1];
 
         /* Process 4 elements at a time using SSE */
         int32_t j   = rowStart;
         __m128  sum = _mm_setzero_ps();
 
         /* Process 4 elements at a time */
-        for (; j + 3 < rowEnd; j += 4) {
+        for (; j + 3 < rowStop; j += 4) {
             /* Load values and indices */
             __m128 values = _mm_loadu_ps(&csr->values[j]);
 
@@ -569,139 +694,324 @@ bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, fl
         float rowSum = temp[0] + temp[1] + temp[2] + temp[3];
 
         /* Process remaining elements */
-        for (; j < rowEnd; j++) {
+        for (; j < rowStop; j++) {
             int32_t col = csr->colIndices[j];
             rowSum += csr->values[j] * x[col];
         }
 
         y[i] = rowSum;
     }
-
-    return true;
 }
 
 /**
- * Perform SIMD-accelerated 4-bit quantized sparse matrix-vector multiplication: y = A * x (SSE
- * version)
+ * SIMD 4-bit CSR matrix-vector product over rows [rowBegin, rowEnd) (SSE version)
+ *
+ * Each row is summed as scale * sum(q * x) + zeroPoint * sum(x), so the
+ * quantized values never need dequantizing one by one.
  */
-bool tinyaiCSRMatrix4BitVectorMulSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y)
+static void csr4BitRowsSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y,
+                            int32_t rowBegin, int32_t rowEnd)
 {
-    if (!csr || !x || !y) {
-        return false;
-    }
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
+        int32_t        rowStart = csr->rowPtrs[i];
+        int32_t        rowStop  = csr->rowPtrs[i + 1];
+        const uint8_t *deltas   = &csr->colDeltas[csr->deltaPtrs[i]];
+        int32_t        col      = 0;
+        int32_t        j        = rowStart;
+        float          qxSum    = 0.0f;
+        float          xSum     = 0.0f;
+
+        /* A row starting in the high nibble of a byte takes one element first */
+        if ((j & 1) && j < rowStop) {
+            col        = csrNextColumn(&deltas, col);
+            float xval = x[col];
+            qxSum += (float)((csr->qvalues[j / 2] >> 4) & 0x0F) * xval;
+            xSum += xval;
+            j++;
+        }
 
-    /* Initialize output vector to zero */
-    memset(y, 0, csr->rows * sizeof(float));
+        /* 8 elements (4 bytes, low nibble first) at a time, as two halves */
+        __m128 qxVec = _mm_setzero_ps();
+        __m128 xVec  = _mm_setzero_ps();
+        for (; j + 8 <= rowStop; j += 8) {
+            int32_t cols[8];
+            col       = csrDecodeColumns8(&deltas, col, cols);
+            __m128 x0 = _mm_setr_ps(x[cols[0]], x[cols[1]], x[cols[2]], x[cols[3]]);
+            __m128 x1 = _mm_setr_ps(x[cols[4]], x[cols[5]], x[cols[6]], x[cols[7]]);
+
+            __m128 qLo, qHi;
+            sparseUnpackNibblesSSE2(&csr->qvalues[j / 2], &qLo, &qHi);
+            qxVec = _mm_add_ps(qxVec, _mm_add_ps(_mm_mul_ps(qLo, x0), _mm_mul_ps(qHi, x1)));
+            xVec  = _mm_add_ps(xVec, _mm_add_ps(x0, x1));
+        }
+        qxSum += sparseHorizontalSumSSE(qxVec);
+        xSum += sparseHorizontalSumSSE(xVec);
+        /* Process remaining elements */
+        for (; j < rowStop; j++) {
+            uint8_t qval = (j % 2 == 0) ? (csr->qvalues[j / 2] & 0x0F)
+                                        : ((csr->qvalues[j / 2] >> 4) & 0x0F);
+            col          = csrNextColumn(&deltas, col);
+            float xval   = x[col];
+            qxSum += (float)qval * xval;
+            xSum += xval;
+        }
 
-    /* Create constants for dequantization */
-    __m128 vscale = _mm_set1_ps(csr->scale);
-    __m128 vzero  = _mm_set1_ps(csr->zeroPoint);
+        y[i] = csr->scale * qxSum + csr->zeroPoint * xSum;
+    }
+}
+#elif defined(TINYAI_SIMD_NEON)
+/**
+ * Gather four x values by column index
+ */
+static inline float32x4_t gatherNEON(const float *x, const int32_t *cols)
+{
+    float32x4_t v = vdupq_n_f32(x[cols[0]]);
+    v             = vsetq_lane_f32(x[cols[1]], v, 1);
+    v             = vsetq_lane_f32(x[cols[2]], v, 2);
+    return vsetq_lane_f32(x[cols[3]], v, 3);
+}
 
-    /* Perform CSR matrix-vector multiplication with SSE */
-    for (int32_t i = 0; i < csr->rows; i++) {
+/**
+ * SIMD CSR matrix-vector product over rows [rowBegin, rowEnd) (NEON version)
+ */
+static void csrRowsSIMD(const TinyAICSRMatrix *csr, const float *x, float *y, int32_t rowBegin,
+                        int32_t rowEnd)
+{
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
         int32_t rowStart = csr->rowPtrs[i];
-        int32_t rowEnd   = csr->rowPtrs[i + 1];
-
-        /* Process in chunks of 4 (for SSE) */
-        int32_t j   = rowStart;
-        __m128  sum = _mm_setzero_ps();
-
-        /* Ensure we process aligned chunks of 8 elements (4 bytes in 4-bit format) */
-        int32_t alignedEnd = rowStart + ((rowEnd - rowStart) / 8) * 8;
-
-        for (; j < alignedEnd; j += 8) {
-            /* Load 4 bytes (8 quantized values) */
-            uint8_t qvals[4];
-            for (int k = 0; k < 4; k++) {
-                qvals[k] = csr->qvalues[(j + k * 2) / 2];
-            }
-
-            /* First 4 values (lower 4 bits of each byte) */
-            int32_t cols1[4];
-            float   vals1[4];
-
-            for (int k = 0; k < 4; k++) {
-                /* Extract and dequantize values */
-                uint8_t qval = qvals[k] & 0x0F;
-                vals1[k]     = qval * csr->scale + csr->zeroPoint;
-
-                /* Get column indices */
-                cols1[k] = csr->colIndices[j + k * 2];
-            }
-
-            /* Load x values for first 4 */
-            __m128 xvals1 = _mm_set_ps(x[cols1[3]], x[cols1[2]], x[cols1[1]], x[cols1[0]]);
-
-            /* Load dequantized values for first 4 */
-            __m128 vvals1 = _mm_loadu_ps(vals1);
-
-            /* Multiply and accumulate first 4 */
-            sum = _mm_add_ps(sum, _mm_mul_ps(vvals1, xvals1));
-
-            /* Second 4 values (upper 4 bits of each byte) */
-            int32_t cols2[4];
-            float   vals2[4];
-
-            for (int k = 0; k < 4; k++) {
-                /* Extract and dequantize values */
-                uint8_t qval = (qvals[k] >> 4) & 0x0F;
-                vals2[k]     = qval * csr->scale + csr->zeroPoint;
-
-                /* Get column indices */
-                cols2[k] = csr->colIndices[j + k * 2 + 1];
-            }
+        int32_t rowStop  = csr->rowPtrs[i + 1];
+
+        /* Two accumulators of 4 elements each hide the latency of the gathers */
+        int32_t     j    = rowStart;
+        float32x4_t sum0 = vdupq_n_f32(0.0f);
+        float32x4_t sum1 = vdupq_n_f32(0.0f);
+        for (; j + 8 <= rowStop; j += 8) {
+            sum0 = vfmaq_f32(sum0, vld1q_f32(&csr->values[j]), gatherNEON(x, &csr->colIndices[j]));
+            sum1 = vfmaq_f32(sum1, vld1q_f32(&csr->values[j + 4]),
+                             gatherNEON(x, &csr->colIndices[j + 4]));
+        }
+        float rowSum = vaddvq_f32(vaddq_f32(sum0, sum1));
 
-            /* Load x values for second 4 */
-            __m128 xvals2 = _mm_set_ps(x[cols2[3]], x[cols2[2]], x[cols2[1]], x[cols2[0]]);
+        /* Process remaining elements */
+        for (; j < rowStop; j++) {
+            rowSum += csr->values[j] * x[csr->colIndices[j]];
+        }
 
-            /* Load dequantized values for second 4 */
-            __m128 vvals2 = _mm_loadu_ps(vals2);
+        y[i] = rowSum;
+    }
+}
 
-            /* Multiply and accumulate second 4 */
-            sum = _mm_add_ps(sum, _mm_mul_ps(vvals2, xvals2));
+/**
+ * SIMD 4-bit CSR matrix-vector product over rows [rowBegin, rowEnd) (NEON version)
+ *
+ * Each row is summed as scale * sum(q * x) + zeroPoint * sum(x), so the
+ * quantized values never need dequantizing one by one.
+ */
+static void csr4BitRowsSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y,
+                            int32_t rowBegin, int32_t rowEnd)
+{
+    for (int32_t i = rowBegin; i < rowEnd; i++) {
+        int32_t        rowStart = csr->rowPtrs[i];
+        int32_t        rowStop  = csr->rowPtrs[i + 1];
+        const uint8_t *deltas   = &csr->colDeltas[csr->deltaPtrs[i]];
+        int32_t        col      = 0;
+        int32_t        j        = rowStart;
+        float          qxSum    = 0.0f;
+        float          xSum     = 0.0f;
+
+        /* A row starting in the high nibble of a byte takes one element first */
+        if ((j & 1) && j < rowStop) {
+            col        = csrNextColumn(&deltas, col);
+            float xval = x[col];
+            qxSum += (float)((csr->qvalues[j / 2] >> 4) & 0x0F) * xval;
+            xSum += xval;
+            j++;
         }
 
-        /* Reduce sum vector to single value */
-        float temp[4];
-        _mm_storeu_ps(temp, sum);
-        float rowSum = temp[0] + temp[1] + temp[2] + temp[3];
+        /* 8 elements (4 bytes, low nibble first) at a time */
+        float32x4_t qxVec = vdupq_n_f32(0.0f);
+        float32x4_t xVec  = vdupq_n_f32(0.0f);
+        for (; j + 8 <= rowStop; j += 8) {
+            int32_t cols[8];
+            col = csrDecodeColumns8(&deltas, col, cols);
+
+            uint32_t bits;
+            memcpy(&bits, &csr->qvalues[j / 2], sizeof(bits));
+            uint8x8_t  packed = vreinterpret_u8_u32(vdup_n_u32(bits));
+            uint8x8_t  q      = vzip1_u8(vand_u8(packed, vdup_n_u8(0x0F)), vshr_n_u8(packed, 4));
+            uint16x8_t q16    = vmovl_u8(q);
+
+            float32x4_t x0 = gatherNEON(x, cols);
+            float32x4_t x1 = gatherNEON(x, cols + 4);
+            qxVec          = vfmaq_f32(qxVec, vcvtq_f32_u32(vmovl_u16(vget_low_u16(q16))), x0);
+            qxVec          = vfmaq_f32(qxVec, vcvtq_f32_u32(vmovl_high_u16(q16)), x1);
+            xVec           = vaddq_f32(xVec, vaddq_f32(x0, x1));
+        }
+        qxSum += vaddvq_f32(qxVec);
+        xSum += vaddvq_f32(xVec);
 
         /* Process remaining elements */
-        for (; j < rowEnd; j++) {
-            /* Extract 4-bit value */
-            uint8_t qval;
-            if (j % 2 == 0) {
-                qval = csr->qvalues[j / 2] & 0x0F;
-            }
-            else {
-                qval = (csr->qvalues[j / 2] >> 4) & 0x0F;
-            }
-
-            /* Dequantize */
-            float val = qval * csr->scale + csr->zeroPoint;
-
-            int32_t col = csr->colIndices[j];
-            rowSum += val * x[col];
+        for (; j < rowStop; j++) {
+            uint8_t qval = (j % 2 == 0) ? (csr->qvalues[j / 2] & 0x0F)
+                                        : ((csr->qvalues[j / 2] >> 4) & 0x0F);
+            col          = csrNextColumn(&deltas, col);
+            float   xval = x[col];
+            qxSum += (float)qval * xval;
+            xSum += xval;
         }
 
-        y[i] = rowSum;
+        y[i] = csr->scale * qxSum + csr->zeroPoint * xSum;
     }
-
-    return true;
 }
+
 #else
 /* Non-SIMD fallback implementations */
-bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, float *y)
+static void csrRowsSIMD(const TinyAICSRMatrix *csr, const float *x, float *y, int32_t rowBegin,
+                        int32_t rowEnd)
 {
-    return tinyaiCSRMatrixVectorMul(csr, x, y);
+    csrRowsScalar(csr, x, y, rowBegin, rowEnd);
 }
 
-bool tinyaiCSRMatrix4BitVectorMulSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y)
+static void csr4BitRowsSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y,
+                            int32_t rowBegin, int32_t rowEnd)
 {
-    return tinyaiCSRMatrix4BitVectorMul(csr, x, y);
+    csr4BitRowsScalar(csr, x, y, rowBegin, rowEnd);
 }
 #endif
 
+/**
+ * Perform SIMD-accelerated sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, float *y)
+{
+    if (!csr || !x || !y) {
+        return false;
+    }
+
+    csrRowsSIMD(csr, x, y, 0, csr->rows);
+    return true;
+}
+
+/**
+ * Perform SIMD-accelerated 4-bit quantized sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiCSRMatrix4BitVectorMulSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y)
+{
+    if (!csr || !x || !y) {
+        return false;
+    }
+
+    csr4BitRowsSIMD(csr, x, y, 0, csr->rows);
+    return true;
+}
+
+/* Merge-path parts per pool thread */
+#define SPMV_PARTS_PER_THREAD 4
+
+/**
+ * Arguments shared by the merge-path tasks of a parallel SpMV
+ *
+ * The diagonal r + rowPtrs[r] counts rows plus nonzeros up to row r, so
+ * cutting it into equal parts gives every task the same number of output
+ * writes and multiply-adds however unevenly the nonzeros are spread.
+ */
+typedef struct {
+    const TinyAICSRMatrix     *csr;
+    const TinyAICSRMatrix4Bit *csr4;
+    const int32_t             *rowPtrs;
+    const float               *x;
+    float                     *y;
+    int32_t                    rows;
+    size_t                     parts;
+    size_t                     diagonal;
+} SpMVTask;
+
+/**
+ * First row whose merge-path diagonal reaches the start of a part
+ */
+static int32_t spmvPartRow(const SpMVTask *task, size_t part)
+{
+    size_t  target = task->diagonal * part / task->parts;
+    int32_t lo     = 0;
+    int32_t hi     = task->rows;
+
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if ((size_t)mid + (size_t)task->rowPtrs[mid] < target) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static void spmvParts(void *context, size_t begin, size_t end)
+{
+    const SpMVTask *task     = (const SpMVTask *)context;
+    int32_t         rowBegin = spmvPartRow(task, begin);
+    int32_t         rowEnd   = spmvPartRow(task, end);
+
+    if (task->csr) {
+        csrRowsSIMD(task->csr, task->x, task->y, rowBegin, rowEnd);
+    }
+    else {
+        csr4BitRowsSIMD(task->csr4, task->x, task->y, rowBegin, rowEnd);
+    }
+}
+
+/**
+ * Split an SpMV into merge-path parts and run them on the shared thread pool
+ */
+static void spmvParallel(SpMVTask *task, int32_t nnz)
+{
+    TinyAIThreadPool *pool = tinyaiGetThreadPool();
+
+    /* A few parts per worker so one heavy row does not idle the others */
+    task->diagonal = (size_t)task->rows + (size_t)nnz;
+    task->parts    = (size_t)tinyaiThreadPoolSize(pool) * SPMV_PARTS_PER_THREAD;
+    if (task->parts > task->diagonal) {
+        task->parts = task->diagonal;
+    }
+    if (task->parts == 0) {
+        return;
+    }
+
+    size_t grain = tinyaiThreadPoolGrain(pool, task->diagonal / task->parts + 1, 1);
+    tinyaiParallelFor(pool, task->parts, grain, spmvParts, task);
+}
+
+/**
+ * Perform multi-threaded sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiCSRMatrixVectorMulParallel(const TinyAICSRMatrix *csr, const float *x, float *y)
+{
+    if (!csr || !x || !y) {
+        return false;
+    }
+
+    SpMVTask task = {csr, NULL, csr->rowPtrs, x, y, csr->rows, 0, 0};
+    spmvParallel(&task, csr->nnz);
+    return true;
+}
+
+/**
+ * Perform multi-threaded 4-bit quantized sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiCSRMatrix4BitVectorMulParallel(const TinyAICSRMatrix4Bit *csr, const float *x,
+                                          float *y)
+{
+    if (!csr || !x || !y) {
+        return false;
+    }
+
+    SpMVTask task = {NULL, csr, csr->rowPtrs, x, y, csr->rows, 0, 0};
+    spmvParallel(&task, csr->nnz);
+    return true;
+}
+
 /**
  * Calculate memory usage of CSR matrix in bytes
  */
@@ -739,9 +1049,9 @@ size_t tinyaiCSRMatrix4BitMemoryUsage(const TinyAICSRMatrix4Bit *csr)
     memoryUsage += sizeof(TinyAICSRMatrix4Bit);
 
     /* Size of arrays */
-    memoryUsage += (csr->nnz + 1) / 2;                /* qvalues (4-bit packed) */
-    memoryUsage += csr->nnz * sizeof(int32_t);        /* colIndices */
-    memoryUsage += (csr->rows + 1) * sizeof(int32_t); /* rowPtrs */
+    memoryUsage += (csr->nnz + 1) / 2;                            /* qvalues (4-bit packed) */
+    memoryUsage += csr->deltaBytes + TINYAI_CSR_DELTA_PADDING;    /* colDeltas */
+    memoryUsage += 2 * (size_t)(csr->rows + 1) * sizeof(int32_t); /* deltaPtrs and rowPtrs */
 
     return memoryUsage;
 }
@@ -781,3 +1091,1490 @@ float tinyaiCSRMatrix4BitCompressionRatio(const TinyAICSRMatrix4Bit *csr)
 
     return (float)denseSize / (float)sparseSize;
 }
+
+/* Block-sparse (BSR) matrices */
+
+/**
+ * Check that a block height is one of the supported BSR shapes
+ */
+static bool bsrValidBlockRows(int32_t blockRows)
+{
+    return blockRows == 1 || blockRows == 4 || blockRows == 8;
+}
+
+/**
+ * Find the blocks of a dense matrix holding at least one value above the threshold
+ *
+ * Fills colIndices and rowPtrs when they are given; always returns the number
+ * of blocks found.
+ */
+static int32_t bsrBuildPattern(const float *dense, int32_t rows, int32_t cols, int32_t blockRows,
+                               float threshold, int32_t *colIndices, int32_t *rowPtrs)
+{
+    int32_t blockRowCount = (rows + blockRows - 1) / blockRows;
+    int32_t blockColCount = (cols + TINYAI_BSR_BLOCK_COLS - 1) / TINYAI_BSR_BLOCK_COLS;
+    int32_t count         = 0;
+
+    if (rowPtrs) {
+        rowPtrs[0] = 0;
+    }
+
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        int32_t rowEnd = (br + 1) * blockRows < rows ? (br + 1) * blockRows : rows;
+
+        for (int32_t bc = 0; bc < blockColCount; bc++) {
+            int32_t colStart = bc * TINYAI_BSR_BLOCK_COLS;
+            int32_t colEnd   = colStart + TINYAI_BSR_BLOCK_COLS < cols
+                                   ? colStart + TINYAI_BSR_BLOCK_COLS
+                                   : cols;
+            bool    nonZero  = false;
+
+            for (int32_t i = br * blockRows; i < rowEnd && !nonZero; i++) {
+                for (int32_t j = colStart; j < colEnd; j++) {
+                    if (fabsf(dense[i * cols + j]) >= threshold) {
+                        nonZero = true;
+                        break;
+                    }
+                }
+            }
+
+            if (nonZero) {
+                if (colIndices) {
+                    colIndices[count] = bc;
+                }
+                count++;
+            }
+        }
+
+        if (rowPtrs) {
+            rowPtrs[br + 1] = count;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Copy one block out of a dense matrix, zero padding the edges and dropping
+ * values below the threshold
+ */
+static void bsrGatherBlock(const float *dense, int32_t rows, int32_t cols, int32_t blockRows,
+                           int32_t br, int32_t bc, float threshold, float *block)
+{
+    for (int32_t r = 0; r < blockRows; r++) {
+        for (int32_t c = 0; c < TINYAI_BSR_BLOCK_COLS; c++) {
+            int32_t i   = br * blockRows + r;
+            int32_t j   = bc * TINYAI_BSR_BLOCK_COLS + c;
+            float   val = (i < rows && j < cols) ? dense[i * cols + j] : 0.0f;
+
+            block[r * TINYAI_BSR_BLOCK_COLS + c] = fabsf(val) >= threshold ? val : 0.0f;
+        }
+    }
+}
+
+/**
+ * Extract the 4-bit value at a given index of a packed array
+ */
+static inline uint8_t bsrNibble(const uint8_t *qvalues, int32_t idx)
+{
+    return (idx % 2 == 0) ? (qvalues[idx / 2] & 0x0F) : ((qvalues[idx / 2] >> 4) & 0x0F);
+}
+
+/**
+ * Create a BSR matrix from dense matrix data with a sparsity threshold
+ */
+TinyAIBSRMatrix *tinyaiCreateBSRMatrixFromDense(const float *dense, int32_t rows, int32_t cols,
+                                                int32_t blockRows, float threshold)
+{
+    if (!dense || rows <= 0 || cols <= 0 || !bsrValidBlockRows(blockRows)) {
+        return NULL;
+    }
+
+    /* First pass: count non-zero blocks */
+    int32_t nnzBlocks     = bsrBuildPattern(dense, rows, cols, blockRows, threshold, NULL, NULL);
+    int32_t blockRowCount = (rows + blockRows - 1) / blockRows;
+    int32_t blockSize     = blockRows * TINYAI_BSR_BLOCK_COLS;
+    int32_t allocBlocks   = nnzBlocks > 0 ? nnzBlocks : 1;
+
+    /* Allocate BSR matrix */
+    TinyAIBSRMatrix *bsr = (TinyAIBSRMatrix *)calloc(1, sizeof(TinyAIBSRMatrix));
+    if (!bsr) {
+        return NULL;
+    }
+
+    bsr->rows      = rows;
+    bsr->cols      = cols;
+    bsr->blockRows = blockRows;
+    bsr->nnzBlocks = nnzBlocks;
+
+    /* Allocate arrays */
+    bsr->values     = (float *)malloc((size_t)allocBlocks * blockSize * sizeof(float));
+    bsr->colIndices = (int32_t *)malloc(allocBlocks * sizeof(int32_t));
+    bsr->rowPtrs    = (int32_t *)malloc((blockRowCount + 1) * sizeof(int32_t));
+
+    if (!bsr->values || !bsr->colIndices || !bsr->rowPtrs) {
+        tinyaiBSRMatrixFree(bsr);
+        return NULL;
+    }
+
+    /* Second pass: record the block pattern and copy the blocks */
+    bsrBuildPattern(dense, rows, cols, blockRows, threshold, bsr->colIndices, bsr->rowPtrs);
+
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        for (int32_t k = bsr->rowPtrs[br]; k < bsr->rowPtrs[br + 1]; k++) {
+            bsrGatherBlock(dense, rows, cols, blockRows, br, bsr->colIndices[k], threshold,
+                           &bsr->values[(size_t)k * blockSize]);
+        }
+    }
+
+    return bsr;
+}
+
+/**
+ * Create a 4-bit quantized BSR matrix from dense matrix data with sparsity threshold
+ */
+TinyAIBSRMatrix4Bit *tinyaiCreateBSRMatrix4BitFromDense(const float *dense, int32_t rows,
+                                                        int32_t cols, int32_t blockRows,
+                                                        float threshold)
+{
+    if (!dense || rows <= 0 || cols <= 0 || !bsrValidBlockRows(blockRows)) {
+        return NULL;
+    }
+
+    /* First pass: count non-zero blocks */
+    int32_t nnzBlocks     = bsrBuildPattern(dense, rows, cols, blockRows, threshold, NULL, NULL);
+    int32_t blockRowCount = (rows + blockRows - 1) / blockRows;
+    int32_t blockSize     = blockRows * TINYAI_BSR_BLOCK_COLS;
+    int32_t allocBlocks   = nnzBlocks > 0 ? nnzBlocks : 1;
+
+    /* Allocate BSR matrix */
+    TinyAIBSRMatrix4Bit *bsr = (TinyAIBSRMatrix4Bit *)calloc(1, sizeof(TinyAIBSRMatrix4Bit));
+    if (!bsr) {
+        return NULL;
+    }
+
+    bsr->rows      = rows;
+    bsr->cols      = cols;
+    bsr->blockRows = blockRows;
+    bsr->nnzBlocks = nnzBlocks;
+
+    /* Allocate arrays; a block row of 8 values packs into 4 bytes */
+    bsr->qvalues    = (uint8_t *)calloc((size_t)allocBlocks * blockSize / 2, 1);
+    bsr->scales     = (float *)malloc(allocBlocks * sizeof(float));
+    bsr->zeroPoints = (float *)malloc(allocBlocks * sizeof(float));
+    bsr->colIndices = (int32_t *)malloc(allocBlocks * sizeof(int32_t));
+    bsr->rowPtrs    = (int32_t *)malloc((blockRowCount + 1) * sizeof(int32_t));
+
+    if (!bsr->qvalues || !bsr->scales || !bsr->zeroPoints || !bsr->colIndices || !bsr->rowPtrs) {
+        tinyaiBSRMatrix4BitFree(bsr);
+        return NULL;
+    }
+
+    /* Second pass: record the block pattern and quantize the blocks */
+    bsrBuildPattern(dense, rows, cols, blockRows, threshold, bsr->colIndices, bsr->rowPtrs);
+
+    float block[8 * TINYAI_BSR_BLOCK_COLS];
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        for (int32_t k = bsr->rowPtrs[br]; k < bsr->rowPtrs[br + 1]; k++) {
+            bsrGatherBlock(dense, rows, cols, blockRows, br, bsr->colIndices[k], threshold, block);
+
+            /* The range always includes zero so pruned values stay exactly zero */
+            float minVal = 0.0f;
+            float maxVal = 0.0f;
+            for (int32_t e = 0; e < blockSize; e++) {
+                minVal = fminf(minVal, block[e]);
+                maxVal = fmaxf(maxVal, block[e]);
+            }
+
+            float scale = (maxVal - minVal) / 15.0f; /* 4-bit range is 0-15 */
+            if (scale <= 0.0f) {
+                scale = 1.0f;
+            }
+            float zeroLevel    = fminf(15.0f, fmaxf(0.0f, roundf(-minVal / scale)));
+            bsr->scales[k]     = scale;
+            bsr->zeroPoints[k] = -zeroLevel * scale;
+
+            /* Pack two 4-bit values per byte, low nibble first */
+            uint8_t *qblock = &bsr->qvalues[(size_t)k * blockSize / 2];
+            for (int32_t e = 0; e < blockSize; e++) {
+                float   level = roundf(block[e] / scale) + zeroLevel;
+                uint8_t qval  = (uint8_t)fmaxf(0.0f, fminf(level, 15.0f));
+                qblock[e / 2] |= (e % 2 == 0) ? qval : (uint8_t)(qval << 4);
+            }
+        }
+    }
+
+    return bsr;
+}
+
+/**
+ * Convert a BSR matrix to dense format
+ */
+bool tinyaiBSRMatrixToDense(const TinyAIBSRMatrix *bsr, float *dense)
+{
+    if (!bsr || !dense) {
+        return false;
+    }
+
+    int32_t blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+    int32_t blockSize     = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+
+    /* Initialize dense matrix to zeros */
+    memset(dense, 0, bsr->rows * bsr->cols * sizeof(float));
+
+    /* Scatter the stored blocks, skipping the edge padding */
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        for (int32_t k = bsr->rowPtrs[br]; k < bsr->rowPtrs[br + 1]; k++) {
+            const float *block = &bsr->values[(size_t)k * blockSize];
+
+            for (int32_t r = 0; r < bsr->blockRows; r++) {
+                int32_t i = br * bsr->blockRows + r;
+                for (int32_t c = 0; c < TINYAI_BSR_BLOCK_COLS; c++) {
+                    int32_t j = bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS + c;
+                    if (i < bsr->rows && j < bsr->cols) {
+                        dense[i * bsr->cols + j] = block[r * TINYAI_BSR_BLOCK_COLS + c];
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Convert a 4-bit quantized BSR matrix to dense format
+ */
+bool tinyaiBSRMatrix4BitToDense(const TinyAIBSRMatrix4Bit *bsr, float *dense)
+{
+    if (!bsr || !dense) {
+        return false;
+    }
+
+    int32_t blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+    int32_t blockSize     = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+
+    /* Initialize dense matrix to zeros */
+    memset(dense, 0, bsr->rows * bsr->cols * sizeof(float));
+
+    /* Dequantize and scatter the stored blocks, skipping the edge padding */
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        for (int32_t k = bsr->rowPtrs[br]; k < bsr->rowPtrs[br + 1]; k++) {
+            const uint8_t *qblock = &bsr->qvalues[(size_t)k * blockSize / 2];
+
+            for (int32_t r = 0; r < bsr->blockRows; r++) {
+                int32_t i = br * bsr->blockRows + r;
+                for (int32_t c = 0; c < TINYAI_BSR_BLOCK_COLS; c++) {
+                    int32_t j = bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS + c;
+                    if (i < bsr->rows && j < bsr->cols) {
+                        uint8_t qval = bsrNibble(qblock, r * TINYAI_BSR_BLOCK_COLS + c);
+                        dense[i * bsr->cols + j] = qval * bsr->scales[k] + bsr->zeroPoints[k];
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Free memory used by a BSR matrix
+ */
+void tinyaiBSRMatrixFree(TinyAIBSRMatrix *bsr)
+{
+    if (!bsr) {
+        return;
+    }
+
+    if (bsr->values) {
+        free(bsr->values);
+    }
+
+    if (bsr->colIndices) {
+        free(bsr->colIndices);
+    }
+
+    if (bsr->rowPtrs) {
+        free(bsr->rowPtrs);
+    }
+
+    free(bsr);
+}
+
+/**
+ * Free memory used by a 4-bit quantized BSR matrix
+ */
+void tinyaiBSRMatrix4BitFree(TinyAIBSRMatrix4Bit *bsr)
+{
+    if (!bsr) {
+        return;
+    }
+
+    if (bsr->qvalues) {
+        free(bsr->qvalues);
+    }
+
+    if (bsr->scales) {
+        free(bsr->scales);
+    }
+
+    if (bsr->zeroPoints) {
+        free(bsr->zeroPoints);
+    }
+
+    if (bsr->colIndices) {
+        free(bsr->colIndices);
+    }
+
+    if (bsr->rowPtrs) {
+        free(bsr->rowPtrs);
+    }
+
+    free(bsr);
+}
+
+/*
+ * Block row kernels
+ *
+ * Each kernel returns the dot product of one matrix row with x over the stored
+ * blocks [start, end) of its block row. Those blocks lie fully inside the
+ * matrix, so every block row is one unaligned 8-wide load of weights and one
+ * of x; the caller handles a partial block on the right edge.
+ */
+
+#ifdef TINYAI_SIMD_AVX
+static float bsrRowDot(const TinyAIBSRMatrix *bsr, int32_t r, int32_t start, int32_t end,
+                       const float *x)
+{
+    int32_t     blockSize = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    const float *values   = &bsr->values[r * TINYAI_BSR_BLOCK_COLS];
+
+    /* Two accumulators hide the FMA latency */
+    __m256  sum0 = _mm256_setzero_ps();
+    __m256  sum1 = _mm256_setzero_ps();
+    int32_t k    = start;
+    for (; k + 1 < end; k += 2) {
+        const float *x0 = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        const float *x1 = &x[bsr->colIndices[k + 1] * TINYAI_BSR_BLOCK_COLS];
+        sum0 = sparseFmaAVX(_mm256_loadu_ps(&values[(size_t)k * blockSize]), _mm256_loadu_ps(x0),
+                            sum0);
+        sum1 = sparseFmaAVX(_mm256_loadu_ps(&values[(size_t)(k + 1) * blockSize]),
+                            _mm256_loadu_ps(x1), sum1);
+    }
+    if (k < end) {
+        const float *x0 = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        sum0 = sparseFmaAVX(_mm256_loadu_ps(&values[(size_t)k * blockSize]), _mm256_loadu_ps(x0),
+                            sum0);
+    }
+
+    return sparseHorizontalSumAVX(_mm256_add_ps(sum0, sum1));
+}
+
+static float bsrRowDot4Bit(const TinyAIBSRMatrix4Bit *bsr, int32_t r, int32_t start,
+                           int32_t end, const float *x)
+{
+    int32_t        blockBytes = bsr->blockRows * TINYAI_BSR_BLOCK_COLS / 2;
+    const uint8_t *qvalues    = &bsr->qvalues[r * TINYAI_BSR_BLOCK_COLS / 2];
+
+    /* Dequantize each block row in registers, then multiply it in one FMA */
+    __m256 sum = _mm256_setzero_ps();
+    for (int32_t k = start; k < end; k++) {
+        __m128 lo, hi;
+        sparseUnpackNibblesSSE2(&qvalues[(size_t)k * blockBytes], &lo, &hi);
+        __m256 q = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+        __m256 w =
+            sparseFmaAVX(q, _mm256_set1_ps(bsr->scales[k]), _mm256_set1_ps(bsr->zeroPoints[k]));
+        const float *xb = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        sum             = sparseFmaAVX(w, _mm256_loadu_ps(xb), sum);
+    }
+
+    return sparseHorizontalSumAVX(sum);
+}
+
+#elif defined(TINYAI_SIMD_SSE)
+static float bsrRowDot(const TinyAIBSRMatrix *bsr, int32_t r, int32_t start, int32_t end,
+                       const float *x)
+{
+    int32_t     blockSize = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    const float *values   = &bsr->values[r * TINYAI_BSR_BLOCK_COLS];
+
+    /* One accumulator per half of the 8-wide block row */
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (int32_t k = start; k < end; k++) {
+        const float *w  = &values[(size_t)k * blockSize];
+        const float *xb = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        sum0            = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(w), _mm_loadu_ps(xb)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(w + 4), _mm_loadu_ps(xb + 4)));
+    }
+
+    return sparseHorizontalSumSSE(_mm_add_ps(sum0, sum1));
+}
+
+static float bsrRowDot4Bit(const TinyAIBSRMatrix4Bit *bsr, int32_t r, int32_t start,
+                           int32_t end, const float *x)
+{
+    int32_t        blockBytes = bsr->blockRows * TINYAI_BSR_BLOCK_COLS / 2;
+    const uint8_t *qvalues    = &bsr->qvalues[r * TINYAI_BSR_BLOCK_COLS / 2];
+
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (int32_t k = start; k < end; k++) {
+        __m128 lo, hi;
+        sparseUnpackNibblesSSE2(&qvalues[(size_t)k * blockBytes], &lo, &hi);
+
+        __m128       scale = _mm_set1_ps(bsr->scales[k]);
+        __m128       zero  = _mm_set1_ps(bsr->zeroPoints[k]);
+        const float *xb    = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        lo                 = _mm_add_ps(_mm_mul_ps(lo, scale), zero);
+        hi                 = _mm_add_ps(_mm_mul_ps(hi, scale), zero);
+        sum0               = _mm_add_ps(sum0, _mm_mul_ps(lo, _mm_loadu_ps(xb)));
+        sum1               = _mm_add_ps(sum1, _mm_mul_ps(hi, _mm_loadu_ps(xb + 4)));
+    }
+
+    return sparseHorizontalSumSSE(_mm_add_ps(sum0, sum1));
+}
+
+#elif defined(TINYAI_SIMD_NEON)
+static float bsrRowDot(const TinyAIBSRMatrix *bsr, int32_t r, int32_t start, int32_t end,
+                       const float *x)
+{
+    int32_t     blockSize = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    const float *values   = &bsr->values[r * TINYAI_BSR_BLOCK_COLS];
+
+    /* One accumulator per half of the 8-wide block row */
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (int32_t k = start; k < end; k++) {
+        const float *w  = &values[(size_t)k * blockSize];
+        const float *xb = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        sum0            = vfmaq_f32(sum0, vld1q_f32(w), vld1q_f32(xb));
+        sum1            = vfmaq_f32(sum1, vld1q_f32(w + 4), vld1q_f32(xb + 4));
+    }
+
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+static float bsrRowDot4Bit(const TinyAIBSRMatrix4Bit *bsr, int32_t r, int32_t start,
+                           int32_t end, const float *x)
+{
+    int32_t        blockBytes = bsr->blockRows * TINYAI_BSR_BLOCK_COLS / 2;
+    const uint8_t *qvalues    = &bsr->qvalues[r * TINYAI_BSR_BLOCK_COLS / 2];
+
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (int32_t k = start; k < end; k++) {
+        uint32_t bits;
+        memcpy(&bits, &qvalues[(size_t)k * blockBytes], sizeof(bits));
+        uint8x8_t  packed = vreinterpret_u8_u32(vdup_n_u32(bits));
+        uint8x8_t  q      = vzip1_u8(vand_u8(packed, vdup_n_u8(0x0F)), vshr_n_u8(packed, 4));
+        uint16x8_t q16    = vmovl_u8(q);
+
+        float32x4_t  scale = vdupq_n_f32(bsr->scales[k]);
+        float32x4_t  zero  = vdupq_n_f32(bsr->zeroPoints[k]);
+        float32x4_t  lo    = vfmaq_f32(zero, vcvtq_f32_u32(vmovl_u16(vget_low_u16(q16))), scale);
+        float32x4_t  hi    = vfmaq_f32(zero, vcvtq_f32_u32(vmovl_high_u16(q16)), scale);
+        const float *xb    = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        sum0               = vfmaq_f32(sum0, lo, vld1q_f32(xb));
+        sum1               = vfmaq_f32(sum1, hi, vld1q_f32(xb + 4));
+    }
+
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+
+#else
+static float bsrRowDot(const TinyAIBSRMatrix *bsr, int32_t r, int32_t start, int32_t end,
+                       const float *x)
+{
+    int32_t blockSize = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    float   sum       = 0.0f;
+
+    for (int32_t k = start; k < end; k++) {
+        const float *w  = &bsr->values[(size_t)k * blockSize + r * TINYAI_BSR_BLOCK_COLS];
+        const float *xb = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        for (int32_t c = 0; c < TINYAI_BSR_BLOCK_COLS; c++) {
+            sum += w[c] * xb[c];
+        }
+    }
+
+    return sum;
+}
+
+static float bsrRowDot4Bit(const TinyAIBSRMatrix4Bit *bsr, int32_t r, int32_t start,
+                           int32_t end, const float *x)
+{
+    int32_t blockSize = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    float   sum       = 0.0f;
+
+    for (int32_t k = start; k < end; k++) {
+        const uint8_t *qblock = &bsr->qvalues[(size_t)k * blockSize / 2];
+        const float   *xb     = &x[bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS];
+        for (int32_t c = 0; c < TINYAI_BSR_BLOCK_COLS; c++) {
+            uint8_t qval = bsrNibble(qblock, r * TINYAI_BSR_BLOCK_COLS + c);
+            sum += (qval * bsr->scales[k] + bsr->zeroPoints[k]) * xb[c];
+        }
+    }
+
+    return sum;
+}
+#endif
+
+/**
+ * Perform block-sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiBSRMatrixVectorMul(const TinyAIBSRMatrix *bsr, const float *x, float *y)
+{
+    if (!bsr || !x || !y) {
+        return false;
+    }
+
+    int32_t blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+    int32_t blockSize     = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        int32_t start = bsr->rowPtrs[br];
+        int32_t end   = bsr->rowPtrs[br + 1];
+
+        /* Block columns are sorted, so only the last block can cross the right edge */
+        int32_t fullEnd = end;
+        if (end > start &&
+            (bsr->colIndices[end - 1] + 1) * TINYAI_BSR_BLOCK_COLS > bsr->cols) {
+            fullEnd = end - 1;
+        }
+
+        for (int32_t r = 0; r < bsr->blockRows; r++) {
+            int32_t i = br * bsr->blockRows + r;
+            if (i >= bsr->rows) {
+                break;
+            }
+
+            float sum = bsrRowDot(bsr, r, start, fullEnd, x);
+
+            /* Partial block on the right edge */
+            if (fullEnd < end) {
+                int32_t      col0 = bsr->colIndices[fullEnd] * TINYAI_BSR_BLOCK_COLS;
+                const float *w =
+                    &bsr->values[(size_t)fullEnd * blockSize + r * TINYAI_BSR_BLOCK_COLS];
+                for (int32_t j = col0; j < bsr->cols; j++) {
+                    sum += w[j - col0] * x[j];
+                }
+            }
+
+            y[i] = sum;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Perform 4-bit quantized block-sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiBSRMatrix4BitVectorMul(const TinyAIBSRMatrix4Bit *bsr, const float *x, float *y)
+{
+    if (!bsr || !x || !y) {
+        return false;
+    }
+
+    int32_t blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+    int32_t blockSize     = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+
+    for (int32_t br = 0; br < blockRowCount; br++) {
+        int32_t start = bsr->rowPtrs[br];
+        int32_t end   = bsr->rowPtrs[br + 1];
+
+        /* Block columns are sorted, so only the last block can cross the right edge */
+        int32_t fullEnd = end;
+        if (end > start &&
+            (bsr->colIndices[end - 1] + 1) * TINYAI_BSR_BLOCK_COLS > bsr->cols) {
+            fullEnd = end - 1;
+        }
+
+        for (int32_t r = 0; r < bsr->blockRows; r++) {
+            int32_t i = br * bsr->blockRows + r;
+            if (i >= bsr->rows) {
+                break;
+            }
+
+            float sum = bsrRowDot4Bit(bsr, r, start, fullEnd, x);
+
+            /* Partial block on the right edge */
+            if (fullEnd < end) {
+                int32_t        col0   = bsr->colIndices[fullEnd] * TINYAI_BSR_BLOCK_COLS;
+                const uint8_t *qblock = &bsr->qvalues[(size_t)fullEnd * blockSize / 2];
+                for (int32_t j = col0; j < bsr->cols; j++) {
+                    uint8_t qval = bsrNibble(qblock, r * TINYAI_BSR_BLOCK_COLS + (j - col0));
+                    sum += (qval * bsr->scales[fullEnd] + bsr->zeroPoints[fullEnd]) * x[j];
+                }
+            }
+
+            y[i] = sum;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Sparse x dense products
+ *
+ * Every kernel adds sum_t weights[t] * X[col(t), :] to one row of Y, where
+ * col(t) is cols[t] or, for the dense rows of a BSR block, colBase + t. The
+ * batch is swept in register tiles so each weight is broadcast once per tile.
+ */
+
+#ifdef TINYAI_SIMD_AVX
+static void spmmRowAccumulate(float *yRow, const float *x, int32_t batch, const float *weights,
+                              const int32_t *cols, int32_t colBase, int32_t count)
+{
+    int32_t c = 0;
+
+    for (; c + 32 <= batch; c += 32) {
+        __m256 acc0 = _mm256_loadu_ps(&yRow[c]);
+        __m256 acc1 = _mm256_loadu_ps(&yRow[c + 8]);
+        __m256 acc2 = _mm256_loadu_ps(&yRow[c + 16]);
+        __m256 acc3 = _mm256_loadu_ps(&yRow[c + 24]);
+        for (int32_t t = 0; t < count; t++) {
+            const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+            __m256       w    = _mm256_set1_ps(weights[t]);
+            acc0              = sparseFmaAVX(w, _mm256_loadu_ps(xRow), acc0);
+            acc1              = sparseFmaAVX(w, _mm256_loadu_ps(xRow + 8), acc1);
+            acc2              = sparseFmaAVX(w, _mm256_loadu_ps(xRow + 16), acc2);
+            acc3              = sparseFmaAVX(w, _mm256_loadu_ps(xRow + 24), acc3);
+        }
+        _mm256_storeu_ps(&yRow[c], acc0);
+        _mm256_storeu_ps(&yRow[c + 8], acc1);
+        _mm256_storeu_ps(&yRow[c + 16], acc2);
+        _mm256_storeu_ps(&yRow[c + 24], acc3);
+    }
+
+    for (; c + 8 <= batch; c += 8) {
+        __m256 acc = _mm256_loadu_ps(&yRow[c]);
+        for (int32_t t = 0; t < count; t++) {
+            const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+            acc = sparseFmaAVX(_mm256_set1_ps(weights[t]), _mm256_loadu_ps(xRow), acc);
+        }
+        _mm256_storeu_ps(&yRow[c], acc);
+    }
+
+    for (; c < batch; c++) {
+        float sum = yRow[c];
+        for (int32_t t = 0; t < count; t++) {
+            sum += weights[t] * x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+        }
+        yRow[c] = sum;
+    }
+}
+
+#elif defined(TINYAI_SIMD_SSE)
+static void spmmRowAccumulate(float *yRow, const float *x, int32_t batch, const float *weights,
+                              const int32_t *cols, int32_t colBase, int32_t count)
+{
+    int32_t c = 0;
+
+    for (; c + 16 <= batch; c += 16) {
+        __m128 acc0 = _mm_loadu_ps(&yRow[c]);
+        __m128 acc1 = _mm_loadu_ps(&yRow[c + 4]);
+        __m128 acc2 = _mm_loadu_ps(&yRow[c + 8]);
+        __m128 acc3 = _mm_loadu_ps(&yRow[c + 12]);
+        for (int32_t t = 0; t < count; t++) {
+            const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+            __m128       w    = _mm_set1_ps(weights[t]);
+            acc0              = _mm_add_ps(acc0, _mm_mul_ps(w, _mm_loadu_ps(xRow)));
+            acc1              = _mm_add_ps(acc1, _mm_mul_ps(w, _mm_loadu_ps(xRow + 4)));
+            acc2              = _mm_add_ps(acc2, _mm_mul_ps(w, _mm_loadu_ps(xRow + 8)));
+            acc3              = _mm_add_ps(acc3, _mm_mul_ps(w, _mm_loadu_ps(xRow + 12)));
+        }
+        _mm_storeu_ps(&yRow[c], acc0);
+        _mm_storeu_ps(&yRow[c + 4], acc1);
+        _mm_storeu_ps(&yRow[c + 8], acc2);
+        _mm_storeu_ps(&yRow[c + 12], acc3);
+    }
+
+    for (; c + 4 <= batch; c += 4) {
+        __m128 acc = _mm_loadu_ps(&yRow[c]);
+        for (int32_t t = 0; t < count; t++) {
+            const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(xRow)));
+        }
+        _mm_storeu_ps(&yRow[c], acc);
+    }
+
+    for (; c < batch; c++) {
+        float sum = yRow[c];
+        for (int32_t t = 0; t < count; t++) {
+            sum += weights[t] * x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+        }
+        yRow[c] = sum;
+    }
+}
+
+#elif defined(TINYAI_SIMD_NEON)
+static void spmmRowAccumulate(float *yRow, const float *x, int32_t batch, const float *weights,
+                              const int32_t *cols, int32_t colBase, int32_t count)
+{
+    int32_t c = 0;
+
+    for (; c + 16 <= batch; c += 16) {
+        float32x4_t acc0 = vld1q_f32(&yRow[c]);
+        float32x4_t acc1 = vld1q_f32(&yRow[c + 4]);
+        float32x4_t acc2 = vld1q_f32(&yRow[c + 8]);
+        float32x4_t acc3 = vld1q_f32(&yRow[c + 12]);
+        for (int32_t t = 0; t < count; t++) {
+            const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+            acc0              = vfmaq_n_f32(acc0, vld1q_f32(xRow), weights[t]);
+            acc1              = vfmaq_n_f32(acc1, vld1q_f32(xRow + 4), weights[t]);
+            acc2              = vfmaq_n_f32(acc2, vld1q_f32(xRow + 8), weights[t]);
+            acc3              = vfmaq_n_f32(acc3, vld1q_f32(xRow + 12), weights[t]);
+        }
+        vst1q_f32(&yRow[c], acc0);
+        vst1q_f32(&yRow[c + 4], acc1);
+        vst1q_f32(&yRow[c + 8], acc2);
+        vst1q_f32(&yRow[c + 12], acc3);
+    }
+
+    for (; c + 4 <= batch; c += 4) {
+        float32x4_t acc = vld1q_f32(&yRow[c]);
+        for (int32_t t = 0; t < count; t++) {
+            const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+            acc               = vfmaq_n_f32(acc, vld1q_f32(xRow), weights[t]);
+        }
+        vst1q_f32(&yRow[c], acc);
+    }
+
+    for (; c < batch; c++) {
+        float sum = yRow[c];
+        for (int32_t t = 0; t < count; t++) {
+            sum += weights[t] * x[(size_t)(cols ? cols[t] : colBase + t) * batch + c];
+        }
+        yRow[c] = sum;
+    }
+}
+
+#else
+static void spmmRowAccumulate(float *yRow, const float *x, int32_t batch, const float *weights,
+                              const int32_t *cols, int32_t colBase, int32_t count)
+{
+    for (int32_t t = 0; t < count; t++) {
+        const float *xRow = &x[(size_t)(cols ? cols[t] : colBase + t) * batch];
+        for (int32_t c = 0; c < batch; c++) {
+            yRow[c] += weights[t] * xRow[c];
+        }
+    }
+}
+#endif
+
+/**
+ * Arguments shared by the row-range tasks of a sparse x dense product
+ */
+typedef struct {
+    const TinyAICSRMatrix *csr;
+    const TinyAIBSRMatrix *bsr;
+    const float           *x;
+    float                 *y;
+    int32_t                batch;
+} SpMMTask;
+
+static void csrDenseMatMulRows(void *context, size_t begin, size_t end)
+{
+    const SpMMTask        *task = (const SpMMTask *)context;
+    const TinyAICSRMatrix *csr  = task->csr;
+
+    for (size_t i = begin; i < end; i++) {
+        float  *yRow  = &task->y[i * task->batch];
+        int32_t start = csr->rowPtrs[i];
+
+        memset(yRow, 0, task->batch * sizeof(float));
+        spmmRowAccumulate(yRow, task->x, task->batch, &csr->values[start],
+                          &csr->colIndices[start], 0, csr->rowPtrs[i + 1] - start);
+    }
+}
+
+static void bsrDenseMatMulBlockRows(void *context, size_t begin, size_t end)
+{
+    const SpMMTask        *task      = (const SpMMTask *)context;
+    const TinyAIBSRMatrix *bsr       = task->bsr;
+    int32_t                blockSize = bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+
+    for (size_t br = begin; br < end; br++) {
+        for (int32_t r = 0; r < bsr->blockRows; r++) {
+            int32_t i = (int32_t)br * bsr->blockRows + r;
+            if (i >= bsr->rows) {
+                break;
+            }
+
+            float *yRow = &task->y[(size_t)i * task->batch];
+            memset(yRow, 0, task->batch * sizeof(float));
+
+            /* Each block row is 8 consecutive columns; the right edge may be partial */
+            for (int32_t k = bsr->rowPtrs[br]; k < bsr->rowPtrs[br + 1]; k++) {
+                int32_t colBase = bsr->colIndices[k] * TINYAI_BSR_BLOCK_COLS;
+                int32_t count   = bsr->cols - colBase < TINYAI_BSR_BLOCK_COLS
+                                      ? bsr->cols - colBase
+                                      : TINYAI_BSR_BLOCK_COLS;
+                spmmRowAccumulate(yRow, task->x, task->batch,
+                                  &bsr->values[(size_t)k * blockSize + r * TINYAI_BSR_BLOCK_COLS],
+                                  NULL, colBase, count);
+            }
+        }
+    }
+}
+
+/**
+ * Multiply a CSR matrix with a dense matrix: Y = A * X
+ */
+bool tinyaiCSRMatrixDenseMatMul(const TinyAICSRMatrix *csr, const float *x, int32_t batch,
+                                float *y)
+{
+    if (!csr || !x || !y || batch <= 0) {
+        return false;
+    }
+
+    SpMMTask task = {csr, NULL, x, y, batch};
+
+    /* Balance tasks on the average work per row */
+    TinyAIThreadPool *pool       = tinyaiGetThreadPool();
+    size_t            workPerRow = ((size_t)csr->nnz / csr->rows + 1) * batch;
+    size_t            grain      = tinyaiThreadPoolGrain(pool, workPerRow, 1);
+    tinyaiParallelFor(pool, csr->rows, grain, csrDenseMatMulRows, &task);
+
+    return true;
+}
+
+/**
+ * Multiply a BSR matrix with a dense matrix: Y = A * X
+ */
+bool tinyaiBSRMatrixDenseMatMul(const TinyAIBSRMatrix *bsr, const float *x, int32_t batch,
+                                float *y)
+{
+    if (!bsr || !x || !y || batch <= 0) {
+        return false;
+    }
+
+    SpMMTask task          = {NULL, bsr, x, y, batch};
+    int32_t  blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+
+    /* Balance tasks on the average work per block row */
+    size_t            blocksPerRow = (size_t)bsr->nnzBlocks / blockRowCount + 1;
+    TinyAIThreadPool *pool         = tinyaiGetThreadPool();
+    size_t            grain        = tinyaiThreadPoolGrain(
+        pool, blocksPerRow * bsr->blockRows * TINYAI_BSR_BLOCK_COLS * batch, 1);
+    tinyaiParallelFor(pool, blockRowCount, grain, bsrDenseMatMulBlockRows, &task);
+
+    return true;
+}
+
+/* Output positions unrolled per sparse convolution chunk, capped so its buffers stay within this */
+#define SPARSE_CONV_CHUNK_BYTES (256 * 1024)
+
+/**
+ * Sparse 2D convolution with CSR weights over the im2col K dimension
+ */
+bool tinyaiCSRMatrixConv2d(const TinyAICSRMatrix *csr, const float *input, const float *biases,
+                           float *output, int inWidth, int inHeight, int inChannels, int outWidth,
+                           int outHeight, int kernelSize, int stride, int padding)
+{
+    if (!csr || !input || !output || inWidth <= 0 || inHeight <= 0 || inChannels <= 0 ||
+        outWidth <= 0 || outHeight <= 0 || kernelSize <= 0 || stride <= 0 ||
+        csr->cols != kernelSize * kernelSize * inChannels) {
+        return false;
+    }
+
+    /* Chunk of output positions whose patches and results fit the budget */
+    size_t positions = (size_t)outWidth * outHeight;
+    size_t chunk     = SPARSE_CONV_CHUNK_BYTES / (sizeof(float) * (csr->cols + csr->rows));
+    chunk            = chunk < 8 ? 8 : chunk & ~(size_t)7;
+    if (chunk > positions) {
+        chunk = positions;
+    }
+
+    float   *patches = (float *)malloc((size_t)csr->cols * chunk * sizeof(float));
+    float   *result  = (float *)malloc((size_t)csr->rows * chunk * sizeof(float));
+    int32_t *used    = (int32_t *)malloc(csr->cols * sizeof(int32_t));
+    uint8_t *read    = (uint8_t *)calloc(csr->cols, 1);
+    if (!patches || !result || !used || !read) {
+        free(patches);
+        free(result);
+        free(used);
+        free(read);
+        return false;
+    }
+
+    /* Patch rows no filter reads are never unrolled */
+    int32_t usedCount = 0;
+    for (int32_t j = 0; j < csr->nnz; j++) {
+        read[csr->colIndices[j]] = 1;
+    }
+    for (int32_t k = 0; k < csr->cols; k++) {
+        if (read[k]) {
+            used[usedCount++] = k;
+        }
+    }
+
+    bool success = true;
+    for (size_t first = 0; first < positions && success; first += chunk) {
+        int32_t count = (int32_t)(positions - first < chunk ? positions - first : chunk);
+
+        /* Row k of the patch matrix holds element k of the patch of every position */
+        for (int32_t u = 0; u < usedCount; u++) {
+            int32_t k   = used[u];
+            int     ic  = k % inChannels;
+            int     tap = k / inChannels;
+            int     kh  = tap / kernelSize;
+            int     kw  = tap % kernelSize;
+            float  *row = &patches[(size_t)k * count];
+            int     oy  = (int)(first / outWidth);
+            int     ox  = (int)(first % outWidth);
+
+            /* One run per output row, zero where the tap falls into the padding */
+            for (int32_t p = 0; p < count; oy++, ox = 0) {
+                int32_t run = outWidth - ox < count - p ? outWidth - ox : count - p;
+                int     iy  = oy * stride - padding + kh;
+                if (iy < 0 || iy >= inHeight) {
+                    memset(&row[p], 0, run * sizeof(float));
+                    p += run;
+                    continue;
+                }
+
+                const float *src = &input[(size_t)iy * inWidth * inChannels + ic];
+                int          ix  = ox * stride - padding + kw;
+                for (int32_t q = 0; q < run; q++, ix += stride) {
+                    row[p + q] = (unsigned)ix < (unsigned)inWidth ? src[(size_t)ix * inChannels]
+                                                                  : 0.0f;
+                }
+                p += run;
+            }
+        }
+
+        success = tinyaiCSRMatrixDenseMatMul(csr, patches, count, result);
+
+        /* Back to the channels-last layout, adding the biases */
+        for (int32_t p = 0; p < count && success; p++) {
+            float *pixel = &output[(first + p) * csr->rows];
+            for (int32_t oc = 0; oc < csr->rows; oc++) {
+                pixel[oc] = result[(size_t)oc * count + p] + (biases ? biases[oc] : 0.0f);
+            }
+        }
+    }
+
+    free(patches);
+    free(result);
+    free(used);
+    free(read);
+
+    return success;
+}
+
+/**
+ * Calculate memory usage of BSR matrix in bytes
+ */
+size_t tinyaiBSRMatrixMemoryUsage(const TinyAIBSRMatrix *bsr)
+{
+    if (!bsr) {
+        return 0;
+    }
+
+    size_t blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+    size_t memoryUsage   = 0;
+
+    /* Size of the struct itself */
+    memoryUsage += sizeof(TinyAIBSRMatrix);
+
+    /* Size of arrays */
+    size_t blockSize = (size_t)bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    memoryUsage += bsr->nnzBlocks * blockSize * sizeof(float); /* values */
+    memoryUsage += bsr->nnzBlocks * sizeof(int32_t);           /* colIndices */
+    memoryUsage += (blockRowCount + 1) * sizeof(int32_t);      /* rowPtrs */
+
+    return memoryUsage;
+}
+
+/**
+ * Calculate memory usage of 4-bit quantized BSR matrix in bytes
+ */
+size_t tinyaiBSRMatrix4BitMemoryUsage(const TinyAIBSRMatrix4Bit *bsr)
+{
+    if (!bsr) {
+        return 0;
+    }
+
+    size_t blockRowCount = (bsr->rows + bsr->blockRows - 1) / bsr->blockRows;
+    size_t memoryUsage   = 0;
+
+    /* Size of the struct itself */
+    memoryUsage += sizeof(TinyAIBSRMatrix4Bit);
+
+    /* Size of arrays */
+    size_t blockSize = (size_t)bsr->blockRows * TINYAI_BSR_BLOCK_COLS;
+    memoryUsage += bsr->nnzBlocks * blockSize / 2;        /* qvalues (4-bit packed) */
+    memoryUsage += 2 * bsr->nnzBlocks * sizeof(float);    /* scales and zeroPoints */
+    memoryUsage += bsr->nnzBlocks * sizeof(int32_t);      /* colIndices */
+    memoryUsage += (blockRowCount + 1) * sizeof(int32_t); /* rowPtrs */
+
+    return memoryUsage;
+}
+
+/**
+ * Calculate compression ratio of a BSR matrix compared to dense matrix storage
+ */
+float tinyaiBSRMatrixCompressionRatio(const TinyAIBSRMatrix *bsr)
+{
+    if (!bsr) {
+        return 0.0f;
+    }
+
+    size_t denseSize  = bsr->rows * bsr->cols * sizeof(float);
+    size_t sparseSize = tinyaiBSRMatrixMemoryUsage(bsr);
+
+    return (float)denseSize / (float)sparseSize;
+}
+
+/**
+ * Calculate compression ratio of a 4-bit quantized BSR matrix compared to dense matrix storage
+ */
+float tinyaiBSRMatrix4BitCompressionRatio(const TinyAIBSRMatrix4Bit *bsr)
+{
+    if (!bsr) {
+        return 0.0f;
+    }
+
+    size_t denseSize  = bsr->rows * bsr->cols * sizeof(float);
+    size_t sparseSize = tinyaiBSRMatrix4BitMemoryUsage(bsr);
+
+    return (float)denseSize / (float)sparseSize;
+}
+
+/* N:M structured sparse matrices */
+
+/**
+ * Bytes of 2-bit position metadata in each row of an N:M matrix
+ */
+static inline int32_t nmPositionStride(const TinyAINMMatrix *nm)
+{
+    return (nm->groupsPerRow * nm->n + 3) / 4;
+}
+
+/**
+ * Extract the position of a kept value within its group
+ */
+static inline int32_t nmPosition(const uint8_t *positions, int32_t idx)
+{
+    return (positions[idx / 4] >> ((idx % 4) * 2)) & 0x03;
+}
+
+/**
+ * Create an N:M structured sparse matrix from dense matrix data
+ */
+TinyAINMMatrix *tinyaiCreateNMMatrixFromDense(const float *dense, int32_t rows, int32_t cols,
+                                              int32_t n, int32_t m)
+{
+    if (!dense || rows <= 0 || cols <= 0 || m < 1 || m > 4 || n < 1 || n > m) {
+        return NULL;
+    }
+
+    TinyAINMMatrix *nm = (TinyAINMMatrix *)calloc(1, sizeof(TinyAINMMatrix));
+    if (!nm) {
+        return NULL;
+    }
+
+    nm->rows         = rows;
+    nm->cols         = cols;
+    nm->n            = n;
+    nm->m            = m;
+    nm->groupsPerRow = (cols + m - 1) / m;
+
+    /* Allocate arrays */
+    int32_t stride = nmPositionStride(nm);
+    nm->values     = (float *)malloc((size_t)rows * nm->groupsPerRow * n * sizeof(float));
+    nm->positions  = (uint8_t *)calloc((size_t)rows * stride, 1);
+
+    if (!nm->values || !nm->positions) {
+        tinyaiNMMatrixFree(nm);
+        return NULL;
+    }
+
+    for (int32_t i = 0; i < rows; i++) {
+        float   *values    = &nm->values[(size_t)i * nm->groupsPerRow * n];
+        uint8_t *positions = &nm->positions[(size_t)i * stride];
+
+        for (int32_t g = 0; g < nm->groupsPerRow; g++) {
+            const float *group     = &dense[i * cols + g * m];
+            int32_t      groupSize = (g + 1) * m <= cols ? m : cols - g * m;
+            bool         keep[4]   = {false, false, false, false};
+
+            /* Keep the n largest magnitudes; ties keep the earlier value */
+            for (int32_t kept = 0; kept < n && kept < groupSize; kept++) {
+                int32_t largest = -1;
+                for (int32_t j = 0; j < groupSize; j++) {
+                    if (!keep[j] && (largest < 0 || fabsf(group[j]) > fabsf(group[largest]))) {
+                        largest = j;
+                    }
+                }
+                keep[largest] = true;
+            }
+
+            /* Store in column order; a short last group is padded with zeros at position 0 */
+            int32_t idx = g * n;
+            for (int32_t j = 0; j < groupSize; j++) {
+                if (keep[j]) {
+                    values[idx] = group[j];
+                    positions[idx / 4] |= (uint8_t)(j << ((idx % 4) * 2));
+                    idx++;
+                }
+            }
+            for (; idx < (g + 1) * n; idx++) {
+                values[idx] = 0.0f;
+            }
+        }
+    }
+
+    return nm;
+}
+
+/**
+ * Convert an N:M structured sparse matrix to dense format
+ */
+bool tinyaiNMMatrixToDense(const TinyAINMMatrix *nm, float *dense)
+{
+    if (!nm || !dense) {
+        return false;
+    }
+
+    int32_t stride = nmPositionStride(nm);
+
+    /* Initialize dense matrix to zeros */
+    memset(dense, 0, nm->rows * nm->cols * sizeof(float));
+
+    /* Accumulate so the zero padding of a short last group cannot overwrite a value */
+    for (int32_t i = 0; i < nm->rows; i++) {
+        const float   *values    = &nm->values[(size_t)i * nm->groupsPerRow * nm->n];
+        const uint8_t *positions = &nm->positions[(size_t)i * stride];
+
+        for (int32_t k = 0; k < nm->groupsPerRow * nm->n; k++) {
+            int32_t col = (k / nm->n) * nm->m + nmPosition(positions, k);
+            dense[i * nm->cols + col] += values[k];
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Free memory used by an N:M structured sparse matrix
+ */
+void tinyaiNMMatrixFree(TinyAINMMatrix *nm)
+{
+    if (!nm) {
+        return;
+    }
+
+    if (nm->values) {
+        free(nm->values);
+    }
+
+    if (nm->positions) {
+        free(nm->positions);
+    }
+
+    free(nm);
+}
+
+/*
+ * Row kernels
+ *
+ * out[b] accumulates the dot product of row r with input b (count <= 4). The
+ * 2:4 kernels cover whole steps of groups with shuffles and return the first
+ * group they left for the scalar kernel.
+ */
+
+static void nmRowDotsScalar(const TinyAINMMatrix *nm, int32_t r, int32_t gStart, const float *x,
+                            int32_t count, float *out)
+{
+    const float   *values    = &nm->values[(size_t)r * nm->groupsPerRow * nm->n];
+    const uint8_t *positions = &nm->positions[(size_t)r * nmPositionStride(nm)];
+
+    for (int32_t k = gStart * nm->n; k < nm->groupsPerRow * nm->n; k++) {
+        int32_t col = (k / nm->n) * nm->m + nmPosition(positions, k);
+        for (int32_t b = 0; b < count; b++) {
+            out[b] += values[k] * x[(size_t)b * nm->cols + col];
+        }
+    }
+}
+
+#if defined(TINYAI_SIMD_AVX) && defined(__AVX2__)
+#define TINYAI_NM_SHUFFLE_KERNEL
+
+/* Columns covered by one step of the 2:4 kernels: 4 groups, 8 kept values */
+#define TINYAI_NM24_STEP_COLS 16
+
+/**
+ * Decode 4 groups of 2:4 positions into in-lane permutes and load their weights
+ *
+ * The gathered x comes out as groups 0,2 | 1,3, so the weights are reordered
+ * to match.
+ */
+static inline __m256 nmDecode24AVX2(const float *values, const uint8_t *positions, int32_t g,
+                                    __m256i *idxLo, __m256i *idxHi)
+{
+    /* Shift counts bringing each kept value's 2-bit position into place */
+    __m256i meta = _mm256_set1_epi32(positions[g / 2] | (positions[g / 2 + 1] << 8));
+    *idxLo       = _mm256_srlv_epi32(meta, _mm256_setr_epi32(0, 2, 0, 2, 4, 6, 4, 6));
+    *idxHi       = _mm256_srlv_epi32(meta, _mm256_setr_epi32(8, 10, 8, 10, 12, 14, 12, 14));
+
+    __m256d w = _mm256_castps_pd(_mm256_loadu_ps(&values[g * 2]));
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(w, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+/**
+ * Gather the 8 x values selected by 4 groups of 2:4 positions
+ */
+static inline __m256 nmGather24AVX2(const float *x, __m256i idxLo, __m256i idxHi)
+{
+    __m256 lo = _mm256_permutevar_ps(_mm256_loadu_ps(x), idxLo);
+    __m256 hi = _mm256_permutevar_ps(_mm256_loadu_ps(x + 8), idxHi);
+    return _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+static inline float nmHorizontalSumAVX2(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum        = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum        = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+static int32_t nmRowDot24(const TinyAINMMatrix *nm, int32_t r, const float *x, float *out)
+{
+    const float   *values    = &nm->values[(size_t)r * nm->groupsPerRow * 2];
+    const uint8_t *positions = &nm->positions[(size_t)r * nmPositionStride(nm)];
+    __m256         acc       = _mm256_setzero_ps();
+
+    int32_t g = 0;
+    for (; g * 4 + TINYAI_NM24_STEP_COLS <= nm->cols; g += 4) {
+        __m256i idxLo, idxHi;
+        __m256  w = nmDecode24AVX2(values, positions, g, &idxLo, &idxHi);
+        acc       = _mm256_fmadd_ps(w, nmGather24AVX2(&x[g * 4], idxLo, idxHi), acc);
+    }
+
+    *out += nmHorizontalSumAVX2(acc);
+    return g;
+}
+
+static int32_t nmRowDot24x4(const TinyAINMMatrix *nm, int32_t r, const float *x, float *out)
+{
+    const float   *values    = &nm->values[(size_t)r * nm->groupsPerRow * 2];
+    const uint8_t *positions = &nm->positions[(size_t)r * nmPositionStride(nm)];
+    const float   *x0        = x;
+    const float   *x1        = x0 + nm->cols;
+    const float   *x2        = x1 + nm->cols;
+    const float   *x3        = x2 + nm->cols;
+    __m256         acc0      = _mm256_setzero_ps();
+    __m256         acc1      = _mm256_setzero_ps();
+    __m256         acc2      = _mm256_setzero_ps();
+    __m256         acc3      = _mm256_setzero_ps();
+
+    /* The positions are decoded once and reused for all four inputs */
+    int32_t g = 0;
+    for (; g * 4 + TINYAI_NM24_STEP_COLS <= nm->cols; g += 4) {
+        __m256i idxLo, idxHi;
+        __m256  w = nmDecode24AVX2(values, positions, g, &idxLo, &idxHi);
+        acc0      = _mm256_fmadd_ps(w, nmGather24AVX2(&x0[g * 4], idxLo, idxHi), acc0);
+        acc1      = _mm256_fmadd_ps(w, nmGather24AVX2(&x1[g * 4], idxLo, idxHi), acc1);
+        acc2      = _mm256_fmadd_ps(w, nmGather24AVX2(&x2[g * 4], idxLo, idxHi), acc2);
+        acc3      = _mm256_fmadd_ps(w, nmGather24AVX2(&x3[g * 4], idxLo, idxHi), acc3);
+    }
+
+    out[0] += nmHorizontalSumAVX2(acc0);
+    out[1] += nmHorizontalSumAVX2(acc1);
+    out[2] += nmHorizontalSumAVX2(acc2);
+    out[3] += nmHorizontalSumAVX2(acc3);
+    return g;
+}
+
+#elif defined(TINYAI_SIMD_NEON)
+#define TINYAI_NM_SHUFFLE_KERNEL
+
+/* Columns covered by one step of the 2:4 kernels: 2 groups, 4 kept values */
+#define TINYAI_NM24_STEP_COLS 8
+
+/**
+ * Decode 2 groups of 2:4 positions into byte indices of a 32-byte table lookup
+ * and load their weights
+ */
+static inline float32x4_t nmDecode24NEON(const float *values, const uint8_t *positions, int32_t g,
+                                         uint8x16_t *tbl)
+{
+    static const int32_t  shiftCounts[4] = {0, -2, -4, -6};
+    static const uint32_t groupBase[4]   = {0, 0, 4, 4};
+
+    uint32x4_t pos = vandq_u32(vshlq_u32(vdupq_n_u32(positions[g / 2]), vld1q_s32(shiftCounts)),
+                               vdupq_n_u32(0x03));
+    uint32x4_t idx = vaddq_u32(pos, vld1q_u32(groupBase));
+    *tbl = vreinterpretq_u8_u32(vaddq_u32(vmulq_n_u32(idx, 0x04040404), vdupq_n_u32(0x03020100)));
+
+    return vld1q_f32(&values[g * 2]);
+}
+
+/**
+ * Gather the 4 x values selected by 2 groups of 2:4 positions
+ */
+static inline float32x4_t nmGather24NEON(const float *x, uint8x16_t tbl)
+{
+    uint8x16x2_t xt = {
+        {vreinterpretq_u8_f32(vld1q_f32(x)), vreinterpretq_u8_f32(vld1q_f32(x + 4))}};
+    return vreinterpretq_f32_u8(vqtbl2q_u8(xt, tbl));
+}
+
+static int32_t nmRowDot24(const TinyAINMMatrix *nm, int32_t r, const float *x, float *out)
+{
+    const float   *values    = &nm->values[(size_t)r * nm->groupsPerRow * 2];
+    const uint8_t *positions = &nm->positions[(size_t)r * nmPositionStride(nm)];
+    float32x4_t    acc       = vdupq_n_f32(0.0f);
+
+    int32_t g = 0;
+    for (; g * 4 + TINYAI_NM24_STEP_COLS <= nm->cols; g += 2) {
+        uint8x16_t  tbl;
+        float32x4_t w = nmDecode24NEON(values, positions, g, &tbl);
+        acc           = vfmaq_f32(acc, w, nmGather24NEON(&x[g * 4], tbl));
+    }
+
+    *out += vaddvq_f32(acc);
+    return g;
+}
+
+static int32_t nmRowDot24x4(const TinyAINMMatrix *nm, int32_t r, const float *x, float *out)
+{
+    const float   *values    = &nm->values[(size_t)r * nm->groupsPerRow * 2];
+    const uint8_t *positions = &nm->positions[(size_t)r * nmPositionStride(nm)];
+    const float   *x0        = x;
+    const float   *x1        = x0 + nm->cols;
+    const float   *x2        = x1 + nm->cols;
+    const float   *x3        = x2 + nm->cols;
+    float32x4_t    acc0      = vdupq_n_f32(0.0f);
+    float32x4_t    acc1      = vdupq_n_f32(0.0f);
+    float32x4_t    acc2      = vdupq_n_f32(0.0f);
+    float32x4_t    acc3      = vdupq_n_f32(0.0f);
+
+    /* The positions are decoded once and reused for all four inputs */
+    int32_t g = 0;
+    for (; g * 4 + TINYAI_NM24_STEP_COLS <= nm->cols; g += 2) {
+        uint8x16_t  tbl;
+        float32x4_t w = nmDecode24NEON(values, positions, g, &tbl);
+        acc0          = vfmaq_f32(acc0, w, nmGather24NEON(&x0[g * 4], tbl));
+        acc1          = vfmaq_f32(acc1, w, nmGather24NEON(&x1[g * 4], tbl));
+        acc2          = vfmaq_f32(acc2, w, nmGather24NEON(&x2[g * 4], tbl));
+        acc3          = vfmaq_f32(acc3, w, nmGather24NEON(&x3[g * 4], tbl));
+    }
+
+    out[0] += vaddvq_f32(acc0);
+    out[1] += vaddvq_f32(acc1);
+    out[2] += vaddvq_f32(acc2);
+    out[3] += vaddvq_f32(acc3);
+    return g;
+}
+#endif
+
+/**
+ * Dot products of row r with up to four inputs
+ */
+static void nmRowDots(const TinyAINMMatrix *nm, int32_t r, const float *x, int32_t count,
+                      float *out)
+{
+    int32_t g = 0;
+
+    for (int32_t b = 0; b < count; b++) {
+        out[b] = 0.0f;
+    }
+
+#ifdef TINYAI_NM_SHUFFLE_KERNEL
+    if (nm->n == 2 && nm->m == 4) {
+        if (count == 4) {
+            g = nmRowDot24x4(nm, r, x, out);
+        }
+        else {
+            for (int32_t b = 0; b < count; b++) {
+                g = nmRowDot24(nm, r, &x[(size_t)b * nm->cols], &out[b]);
+            }
+        }
+    }
+#endif
+
+    nmRowDotsScalar(nm, r, g, x, count, out);
+}
+
+/**
+ * Perform N:M structured sparse matrix-vector multiplication: y = A * x
+ */
+bool tinyaiNMMatrixVectorMul(const TinyAINMMatrix *nm, const float *x, float *y)
+{
+    if (!nm || !x || !y) {
+        return false;
+    }
+
+    for (int32_t i = 0; i < nm->rows; i++) {
+        nmRowDots(nm, i, x, 1, &y[i]);
+    }
+
+    return true;
+}
+
+/**
+ * Multiply an N:M structured sparse matrix with a batch of vectors: Y = X * A^T
+ */
+bool tinyaiNMMatrixMatMul(const TinyAINMMatrix *nm, const float *x, int32_t batch, float *y)
+{
+    if (!nm || !x || !y || batch <= 0) {
+        return false;
+    }
+
+    float out[4];
+    for (int32_t b = 0; b < batch; b += 4) {
+        int32_t count = batch - b < 4 ? batch - b : 4;
+
+        for (int32_t i = 0; i < nm->rows; i++) {
+            nmRowDots(nm, i, &x[(size_t)b * nm->cols], count, out);
+            for (int32_t k = 0; k < count; k++) {
+                y[(size_t)(b + k) * nm->rows + i] = out[k];
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Calculate memory usage of N:M structured sparse matrix in bytes
+ */
+size_t tinyaiNMMatrixMemoryUsage(const TinyAINMMatrix *nm)
+{
+    if (!nm) {
+        return 0;
+    }
+
+    size_t memoryUsage = 0;
+
+    /* Size of the struct itself */
+    memoryUsage += sizeof(TinyAINMMatrix);
+
+    /* Size of arrays */
+    memoryUsage += (size_t)nm->rows * nm->groupsPerRow * nm->n * sizeof(float); /* values */
+    memoryUsage += (size_t)nm->rows * nmPositionStride(nm); /* positions (2-bit packed) */
+
+    return memoryUsage;
+}
+
+/**
+ * Calculate compression ratio of an N:M structured sparse matrix compared to dense storage
+ */
+float tinyaiNMMatrixCompressionRatio(const TinyAINMMatrix *nm)
+{
+    if (!nm) {
+        return 0.0f;
+    }
+
+    size_t denseSize  = nm->rows * nm->cols * sizeof(float);
+    size_t sparseSize = tinyaiNMMatrixMemoryUsage(nm);
+
+    return (float)denseSize / (float)sparseSize;
+}
@@ -11,6 +11,7 @@
 #define TINYAI_SPARSE_OPS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -53,20 +54,102 @@ typedef struct {
     int32_t  nnz;        /* Number of non-zero elements */
 } TinyAICOOMatrix;
 
+/**
+ * Escape byte of the delta-encoded column indices of a 4-bit CSR matrix
+ *
+ * Each row's column indices are stored as the gap to the previous column
+ * (the first one as the column itself): a gap below the escape takes one
+ * byte; otherwise the escape is followed by the gap as a little-endian
+ * uint16, or, for gaps of 0xFFFF and more, by 0xFFFF and the absolute
+ * column as a little-endian int32.
+ */
+#define TINYAI_CSR_DELTA_ESCAPE 0xFF
+
+/**
+ * Zero bytes padding the end of the column deltas, so SIMD decoders can load
+ * 8 of them at any position in the stream
+ */
+#define TINYAI_CSR_DELTA_PADDING 8
+
 /**
  * 4-bit quantized CSR matrix format
+ *
+ * Column indices are delta-encoded (see TINYAI_CSR_DELTA_ESCAPE), so a typical
+ * index costs one byte instead of four next to its half-byte value.
  */
 typedef struct {
     uint8_t *qvalues;    /* Quantized non-zero values (4-bit packed) */
-    int32_t *colIndices; /* Column indices for each non-zero value */
-    int32_t *rowPtrs;    /* Pointers to start of each row in values and colIndices */
+    uint8_t *colDeltas;  /* Delta-encoded column indices, padded with zero bytes */
+    int32_t *deltaPtrs;  /* Pointers to start of each row in colDeltas */
+    int32_t *rowPtrs;    /* Pointers to start of each row in qvalues */
     float    scale;      /* Scale factor for quantization */
     float    zeroPoint;  /* Zero point for quantization */
     int32_t  rows;       /* Number of rows */
     int32_t  cols;       /* Number of columns */
     int32_t  nnz;        /* Number of non-zero elements */
+    int32_t  deltaBytes; /* Bytes of colDeltas, not counting the padding */
 } TinyAICSRMatrix4Bit;
 
+/**
+ * Number of columns in every block of a block-sparse (BSR) matrix; one block
+ * row spans a full 256-bit float vector
+ */
+#define TINYAI_BSR_BLOCK_COLS 8
+
+/**
+ * Block Sparse Row (BSR) format for sparse matrices
+ *
+ * The matrix is tiled into blockRows x TINYAI_BSR_BLOCK_COLS blocks (blockRows
+ * is 1, 4 or 8) and only blocks holding at least one non-zero are stored, each
+ * as a dense row-major tile. Blocks on the right and bottom edges are padded
+ * with zeros.
+ */
+typedef struct {
+    float   *values;     /* Stored blocks, blockRows * TINYAI_BSR_BLOCK_COLS values each */
+    int32_t *colIndices; /* Block column index of each stored block */
+    int32_t *rowPtrs;    /* Pointers to start of each block row in colIndices */
+    int32_t  rows;       /* Number of rows */
+    int32_t  cols;       /* Number of columns */
+    int32_t  blockRows;  /* Rows per block (1, 4 or 8) */
+    int32_t  nnzBlocks;  /* Number of stored blocks */
+} TinyAIBSRMatrix;
+
+/**
+ * 4-bit quantized BSR matrix format
+ *
+ * Every block carries its own scale and zero point (value = q * scale + zeroPoint),
+ * chosen so that zero is represented exactly.
+ */
+typedef struct {
+    uint8_t *qvalues;    /* Quantized blocks (4-bit packed, low nibble first) */
+    float   *scales;     /* Scale factor of each stored block */
+    float   *zeroPoints; /* Zero point of each stored block */
+    int32_t *colIndices; /* Block column index of each stored block */
+    int32_t *rowPtrs;    /* Pointers to start of each block row in colIndices */
+    int32_t  rows;       /* Number of rows */
+    int32_t  cols;       /* Number of columns */
+    int32_t  blockRows;  /* Rows per block (1, 4 or 8) */
+    int32_t  nnzBlocks;  /* Number of stored blocks */
+} TinyAIBSRMatrix4Bit;
+
+/**
+ * N:M structured sparse matrix format
+ *
+ * Every group of m consecutive columns in a row keeps exactly n values, stored
+ * densely with a 2-bit position inside the group instead of a column index.
+ * Groups hold at most 4 columns (m <= 4), so 2:4 sparsity halves the weight
+ * bandwidth at 1/16 the index overhead of CSR.
+ */
+typedef struct {
+    float   *values;       /* Kept values, n per group, row-major */
+    uint8_t *positions;    /* 2-bit position of each kept value in its group, 4 per byte */
+    int32_t  rows;         /* Number of rows */
+    int32_t  cols;         /* Number of columns */
+    int32_t  n;            /* Values kept per group */
+    int32_t  m;            /* Columns per group (at most 4) */
+    int32_t  groupsPerRow; /* Number of groups in each row (last one may be partial) */
+} TinyAINMMatrix;
+
 /**
  * Create a CSR matrix from dense matrix data with a sparsity threshold
  *
@@ -163,6 +246,35 @@ bool tinyaiCSRMatrixVectorMulSIMD(const TinyAICSRMatrix *csr, const float *x, fl
  */
 bool tinyaiCSRMatrix4BitVectorMulSIMD(const TinyAICSRMatrix4Bit *csr, const float *x, float *y);
 
+/**
+ * Perform multi-threaded sparse matrix-vector multiplication: y = A * x
+ *
+ * Rows are split across the shared thread pool by cumulative nonzeros
+ * (merge-path style) rather than by row count, so pruned matrices with very
+ * uneven rows still keep every worker busy. Rows are never split, so the
+ * result matches tinyaiCSRMatrixVectorMulSIMD exactly.
+ *
+ * @param csr CSR matrix A
+ * @param x Input vector x
+ * @param y Output vector y (must be pre-allocated with csr->rows elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiCSRMatrixVectorMulParallel(const TinyAICSRMatrix *csr, const float *x, float *y);
+
+/**
+ * Perform multi-threaded 4-bit quantized sparse matrix-vector multiplication: y = A * x
+ *
+ * Same partitioning as tinyaiCSRMatrixVectorMulParallel; the result matches
+ * tinyaiCSRMatrix4BitVectorMulSIMD exactly.
+ *
+ * @param csr 4-bit quantized CSR matrix A
+ * @param x Input vector x
+ * @param y Output vector y (must be pre-allocated with csr->rows elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiCSRMatrix4BitVectorMulParallel(const TinyAICSRMatrix4Bit *csr, const float *x,
+                                          float *y);
+
 /**
  * Calculate memory usage of CSR matrix in bytes
  *
@@ -195,6 +307,254 @@ float tinyaiCSRMatrixCompressionRatio(const TinyAICSRMatrix *csr);
  */
 float tinyaiCSRMatrix4BitCompressionRatio(const TinyAICSRMatrix4Bit *csr);
 
+/**
+ * Create a BSR matrix from dense matrix data with a sparsity threshold
+ *
+ * A block is stored when any of its values reaches the threshold; values below
+ * the threshold inside a stored block are stored as zero.
+ *
+ * @param dense Dense matrix data (row-major)
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param blockRows Rows per block (1, 4 or 8)
+ * @param threshold Values with absolute magnitude below this threshold are treated as zero
+ * @return BSR matrix (must be freed with tinyaiBSRMatrixFree)
+ */
+TinyAIBSRMatrix *tinyaiCreateBSRMatrixFromDense(const float *dense, int32_t rows, int32_t cols,
+                                                int32_t blockRows, float threshold);
+
+/**
+ * Create a 4-bit quantized BSR matrix from dense matrix data with sparsity threshold
+ *
+ * @param dense Dense matrix data (row-major)
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param blockRows Rows per block (1, 4 or 8)
+ * @param threshold Values with absolute magnitude below this threshold are treated as zero
+ * @return 4-bit quantized BSR matrix (must be freed with tinyaiBSRMatrix4BitFree)
+ */
+TinyAIBSRMatrix4Bit *tinyaiCreateBSRMatrix4BitFromDense(const float *dense, int32_t rows,
+                                                        int32_t cols, int32_t blockRows,
+                                                        float threshold);
+
+/**
+ * Convert a BSR matrix to dense format
+ *
+ * @param bsr BSR matrix to convert
+ * @param dense Output dense matrix (row-major, must be pre-allocated with rows*cols elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiBSRMatrixToDense(const TinyAIBSRMatrix *bsr, float *dense);
+
+/**
+ * Convert a 4-bit quantized BSR matrix to dense format
+ *
+ * @param bsr 4-bit quantized BSR matrix to convert
+ * @param dense Output dense matrix (row-major, must be pre-allocated with rows*cols elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiBSRMatrix4BitToDense(const TinyAIBSRMatrix4Bit *bsr, float *dense);
+
+/**
+ * Free memory used by a BSR matrix
+ *
+ * @param bsr BSR matrix to free
+ */
+void tinyaiBSRMatrixFree(TinyAIBSRMatrix *bsr);
+
+/**
+ * Free memory used by a 4-bit quantized BSR matrix
+ *
+ * @param bsr 4-bit quantized BSR matrix to free
+ */
+void tinyaiBSRMatrix4BitFree(TinyAIBSRMatrix4Bit *bsr);
+
+/**
+ * Perform block-sparse matrix-vector multiplication: y = A * x
+ *
+ * Each stored block is multiplied with full-width vector FMAs where SIMD is
+ * available, so the format pays off at moderate (50-80%) block sparsity.
+ *
+ * @param bsr BSR matrix A
+ * @param x Input vector x
+ * @param y Output vector y (must be pre-allocated with bsr->rows elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiBSRMatrixVectorMul(const TinyAIBSRMatrix *bsr, const float *x, float *y);
+
+/**
+ * Multiply a CSR matrix with a dense matrix: Y = A * X
+ *
+ * X holds one input per column (csr->cols x batch, row-major), so each
+ * non-zero is loaded once and applied to a whole row of X with SIMD. Rows of
+ * A are split across the shared thread pool.
+ *
+ * @param csr CSR matrix A
+ * @param x Dense input matrix X (csr->cols x batch, row-major)
+ * @param batch Number of columns of X and Y
+ * @param y Output matrix Y (csr->rows x batch, row-major, must be pre-allocated)
+ * @return true on success, false on failure
+ */
+bool tinyaiCSRMatrixDenseMatMul(const TinyAICSRMatrix *csr, const float *x, int32_t batch,
+                                float *y);
+
+/**
+ * Multiply a BSR matrix with a dense matrix: Y = A * X
+ *
+ * Same layout and threading as tinyaiCSRMatrixDenseMatMul, with block rows
+ * split across the shared thread pool.
+ *
+ * @param bsr BSR matrix A
+ * @param x Dense input matrix X (bsr->cols x batch, row-major)
+ * @param batch Number of columns of X and Y
+ * @param y Output matrix Y (bsr->rows x batch, row-major, must be pre-allocated)
+ * @return true on success, false on failure
+ */
+bool tinyaiBSRMatrixDenseMatMul(const TinyAIBSRMatrix *bsr, const float *x, int32_t batch,
+                                float *y);
+
+/**
+ * Sparse 2D convolution with CSR weights over the im2col K dimension
+ *
+ * Row oc of the matrix holds the filter of output channel oc, with column
+ * (kh * kernelSize + kw) * inChannels + ic. Output positions are unrolled in
+ * chunks into a patch matrix holding only the rows some filter reads, then
+ * multiplied with tinyaiCSRMatrixDenseMatMul.
+ *
+ * @param csr Filters (outChannels x kernelSize^2 * inChannels)
+ * @param input Input feature map (inHeight x inWidth x inChannels)
+ * @param biases Bias of each output channel (may be NULL)
+ * @param output Output feature map (outHeight x outWidth x csr->rows, must be pre-allocated)
+ * @param inWidth Width of input feature map
+ * @param inHeight Height of input feature map
+ * @param inChannels Number of input channels
+ * @param outWidth Width of output feature map
+ * @param outHeight Height of output feature map
+ * @param kernelSize Size of the square kernel
+ * @param stride Stride of the convolution
+ * @param padding Padding size
+ * @return true on success, false on failure
+ */
+bool tinyaiCSRMatrixConv2d(const TinyAICSRMatrix *csr, const float *input, const float *biases,
+                           float *output, int inWidth, int inHeight, int inChannels, int outWidth,
+                           int outHeight, int kernelSize, int stride, int padding);
+
+/**
+ * Perform 4-bit quantized block-sparse matrix-vector multiplication: y = A * x
+ *
+ * @param bsr 4-bit quantized BSR matrix A
+ * @param x Input vector x
+ * @param y Output vector y (must be pre-allocated with bsr->rows elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiBSRMatrix4BitVectorMul(const TinyAIBSRMatrix4Bit *bsr, const float *x, float *y);
+
+/**
+ * Calculate memory usage of BSR matrix in bytes
+ *
+ * @param bsr BSR matrix
+ * @return Memory usage in bytes
+ */
+size_t tinyaiBSRMatrixMemoryUsage(const TinyAIBSRMatrix *bsr);
+
+/**
+ * Calculate memory usage of 4-bit quantized BSR matrix in bytes
+ *
+ * @param bsr 4-bit quantized BSR matrix
+ * @return Memory usage in bytes
+ */
+size_t tinyaiBSRMatrix4BitMemoryUsage(const TinyAIBSRMatrix4Bit *bsr);
+
+/**
+ * Calculate compression ratio of a BSR matrix compared to dense matrix storage
+ *
+ * @param bsr BSR matrix
+ * @return Compression ratio (dense size / sparse size)
+ */
+float tinyaiBSRMatrixCompressionRatio(const TinyAIBSRMatrix *bsr);
+
+/**
+ * Calculate compression ratio of a 4-bit quantized BSR matrix compared to dense matrix storage
+ *
+ * @param bsr 4-bit quantized BSR matrix
+ * @return Compression ratio (dense size / sparse size)
+ */
+float tinyaiBSRMatrix4BitCompressionRatio(const TinyAIBSRMatrix4Bit *bsr);
+
+/**
+ * Create an N:M structured sparse matrix from dense matrix data
+ *
+ * Each group of m columns keeps its n largest magnitudes, so the input does not
+ * need to be pruned first (see tinyaiPruneMatrixNM).
+ *
+ * @param dense Dense matrix data (row-major)
+ * @param rows Number of rows
+ * @param cols Number of columns
+ * @param n Values kept per group (1 to m)
+ * @param m Columns per group (1 to 4)
+ * @return N:M matrix (must be freed with tinyaiNMMatrixFree)
+ */
+TinyAINMMatrix *tinyaiCreateNMMatrixFromDense(const float *dense, int32_t rows, int32_t cols,
+                                              int32_t n, int32_t m);
+
+/**
+ * Convert an N:M structured sparse matrix to dense format
+ *
+ * @param nm N:M matrix to convert
+ * @param dense Output dense matrix (row-major, must be pre-allocated with rows*cols elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiNMMatrixToDense(const TinyAINMMatrix *nm, float *dense);
+
+/**
+ * Free memory used by an N:M structured sparse matrix
+ *
+ * @param nm N:M matrix to free
+ */
+void tinyaiNMMatrixFree(TinyAINMMatrix *nm);
+
+/**
+ * Perform N:M structured sparse matrix-vector multiplication: y = A * x
+ *
+ * 2:4 matrices gather x with in-register shuffles driven by the position
+ * metadata where SIMD is available.
+ *
+ * @param nm N:M matrix A
+ * @param x Input vector x
+ * @param y Output vector y (must be pre-allocated with nm->rows elements)
+ * @return true on success, false on failure
+ */
+bool tinyaiNMMatrixVectorMul(const TinyAINMMatrix *nm, const float *x, float *y);
+
+/**
+ * Multiply an N:M structured sparse matrix with a batch of vectors: Y = X * A^T
+ *
+ * The position metadata of each group is decoded once for up to four inputs.
+ *
+ * @param nm N:M matrix A
+ * @param x Input vectors (batch x nm->cols, row-major)
+ * @param batch Number of input vectors
+ * @param y Output vectors (batch x nm->rows, row-major)
+ * @return true on success, false on failure
+ */
+bool tinyaiNMMatrixMatMul(const TinyAINMMatrix *nm, const float *x, int32_t batch, float *y);
+
+/**
+ * Calculate memory usage of N:M structured sparse matrix in bytes
+ *
+ * @param nm N:M matrix
+ * @return Memory usage in bytes
+ */
+size_t tinyaiNMMatrixMemoryUsage(const TinyAINMMatrix *nm);
+
+/**
+ * Calculate compression ratio of an N:M structured sparse matrix compared to dense storage
+ *
+ * @param nm N:M matrix
+ * @return Compression ratio (dense size / sparse size)
+ */
+float tinyaiNMMatrixCompressionRatio(const TinyAINMMatrix *nm);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,830 @@
+/**
+ * @file thread_pool.c
+ * @brief Implementation of the work-stealing thread pool for TinyAI kernels
+ */
+
+#include "thread_pool.h"
+#include "../core/config.h"
+#include "../core/memory.h"
+#include "cancel.h"
+#include "energy.h"
+#include "numa.h"
+#include "trace.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Include threading support */
+#ifdef _WIN32
+#include <process.h>
+#include <windows.h>
+typedef HANDLE ThreadHandle;
+#else
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_t ThreadHandle;
+#endif
+
+/* Upper bound on pool size, whatever the configuration asks for */
+#define MAX_THREADS 256
+
+/* Initial slots of a task deque; it doubles when full */
+#define DEQUE_MIN_CAPACITY 64
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION Mutex;
+typedef volatile LONG    AtomicCount;
+typedef volatile LONG64  AtomicTime;
+#else
+typedef pthread_mutex_t Mutex;
+typedef long            AtomicCount;
+typedef uint64_t        AtomicTime;
+#endif
+
+/* A range of a parallel loop, or a task of a group */
+typedef struct {
+    TinyAIParallelTask range; /* Range task, or NULL for a group task */
+    TinyAITaskFunc     func;
+    void              *context;
+    size_t             begin;
+    size_t             end;
+    TinyAITaskGroup   *group;
+    TinyAICancelToken *cancel; /* Token of the thread that queued the task */
+} Task;
+
+/* Tasks of one thread; the owner works at the tail, thieves take from the head */
+typedef struct {
+    Task  *tasks;
+    size_t capacity; /* A power of two */
+    size_t head;
+    size_t     tail;
+    Mutex      lock;
+    AtomicTime busyNs; /* Time its threads spent running tasks, while tracking */
+} TaskDeque;
+
+/* Tasks that must all finish before a wait returns */
+struct TinyAITaskGroup {
+    TinyAIThreadPool *pool;
+    AtomicCount       pending;
+};
+
+/* Thread pool structure */
+struct TinyAIThreadPool {
+    int           numThreads; /* Threads running tasks, including the caller */
+    size_t        minWork;    /* Minimum multiply-adds per task */
+    ThreadHandle *workers;    /* numThreads - 1 worker threads */
+    int           numWorkers; /* Number of workers actually started */
+    int           numNodes;   /* NUMA nodes the workers are pinned across (0 = not pinned) */
+    int           nextWorker; /* Index claimed by the next worker to start */
+
+    /* One deque per worker, then one for threads outside the pool */
+    TaskDeque  *deques;
+    AtomicCount queued;   /* Tasks in all deques */
+    AtomicCount nextNode;  /* Spreads tasks with an affinity across a node's workers */
+    bool        shutdown;
+    bool        trackBusy; /* Count the time each deque's threads spend running tasks */
+
+    /* Idle threads sleep on wake, guarded by lock */
+    Mutex lock;
+#ifdef _WIN32
+    CONDITION_VARIABLE wake;
+#else
+    pthread_cond_t wake;
+#endif
+};
+
+/* Pool the calling thread works for, and its deque there */
+static THREAD_LOCAL TinyAIThreadPool *t_pool  = NULL;
+static THREAD_LOCAL int               t_deque = 0;
+
+/* Whether the calling thread is inside a task whose time is being counted */
+static THREAD_LOCAL bool t_countingBusy = false;
+
+/* Pool the built-in kernels started on this thread use instead of the shared one */
+static THREAD_LOCAL TinyAIThreadPool *t_kernelPool     = NULL;
+static THREAD_LOCAL bool              t_kernelOverride = false;
+
+/* Shared pool used by the built-in kernels */
+static TinyAIThreadPool *g_sharedPool        = NULL;
+static bool              g_sharedPoolCreated = false;
+#ifdef _WIN32
+static SRWLOCK g_sharedPoolLock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t g_sharedPoolLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void initMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static void destroyMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+static void lockMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static void unlockMutex(Mutex *mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+/* Add to a counter, returning the new value */
+static long atomicAdd(AtomicCount *count, long delta)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd(count, delta) + delta;
+#else
+    return __atomic_add_fetch(count, delta, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static long atomicLoad(AtomicCount *count)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(count, 0, 0);
+#else
+    return __atomic_load_n(count, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static void atomicAddTime(AtomicTime *time, uint64_t delta)
+{
+#ifdef _WIN32
+    InterlockedExchangeAdd64(time, (LONG64)delta);
+#else
+    __atomic_add_fetch(time, delta, __ATOMIC_RELAXED);
+#endif
+}
+
+static uint64_t atomicLoadTime(const AtomicTime *time)
+{
+#ifdef _WIN32
+    return (uint64_t)InterlockedCompareExchange64((AtomicTime *)time, 0, 0);
+#else
+    return __atomic_load_n(time, __ATOMIC_RELAXED);
+#endif
+}
+
+/* Wake one sleeping thread, or all of them */
+static void wakeThreads(TinyAIThreadPool *pool, bool all)
+{
+    lockMutex(&pool->lock);
+#ifdef _WIN32
+    if (all) {
+        WakeAllConditionVariable(&pool->wake);
+    }
+    else {
+        WakeConditionVariable(&pool->wake);
+    }
+#else
+    if (all) {
+        pthread_cond_broadcast(&pool->wake);
+    }
+    else {
+        pthread_cond_signal(&pool->wake);
+    }
+#endif
+    unlockMutex(&pool->lock);
+}
+
+/* Sleep until woken (pool lock held) */
+static void sleepThread(TinyAIThreadPool *pool)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(&pool->wake, &pool->lock, INFINITE);
+#else
+    pthread_cond_wait(&pool->wake, &pool->lock);
+#endif
+}
+
+/* Get the number of online CPUs */
+static int onlineCpuCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+#endif
+}
+
+/* Queue tasks at the tail of a deque; false if it cannot grow */
+static bool pushTasks(TinyAIThreadPool *pool, int index, const Task *tasks, size_t count)
+{
+    TaskDeque *deque = &pool->deques[index];
+
+    lockMutex(&deque->lock);
+    size_t needed = deque->tail - deque->head + count;
+    if (needed > deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity : DEQUE_MIN_CAPACITY;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        Task *grown = (Task *)TINYAI_MALLOC(capacity * sizeof(Task));
+        if (!grown) {
+            unlockMutex(&deque->lock);
+            return false;
+        }
+        for (size_t i = deque->head; i < deque->tail; i++) {
+            grown[i - deque->head] = deque->tasks[i & (deque->capacity - 1)];
+        }
+        if (deque->tasks) {
+            TINYAI_FREE(deque->tasks);
+        }
+        deque->tail -= deque->head;
+        deque->head     = 0;
+        deque->tasks    = grown;
+        deque->capacity = capacity;
+    }
+    for (size_t i = 0; i < count; i++) {
+        deque->tasks[deque->tail++ & (deque->capacity - 1)] = tasks[i];
+    }
+    unlockMutex(&deque->lock);
+
+    atomicAdd(&pool->queued, (long)count);
+    wakeThreads(pool, count > 1);
+    return true;
+}
+
+/* Take a task from the tail (the owner) or the head (a thief) of a deque */
+static bool popTask(TinyAIThreadPool *pool, int index, bool steal, Task *task)
+{
+    TaskDeque *deque = &pool->deques[index];
+    bool       found = false;
+
+    lockMutex(&deque->lock);
+    if (deque->head != deque->tail) {
+        size_t slot = steal ? deque->head++ : --deque->tail;
+        *task       = deque->tasks[slot & (deque->capacity - 1)];
+        found       = true;
+    }
+    unlockMutex(&deque->lock);
+
+    if (found) {
+        atomicAdd(&pool->queued, -1);
+    }
+    return found;
+}
+
+/* Find work: own deque first, then tasks from outside, then other workers, same node first */
+static bool takeTask(TinyAIThreadPool *pool, int self, Task *task)
+{
+    if (atomicLoad(&pool->queued) == 0) {
+        return false;
+    }
+    if (self < pool->numWorkers && popTask(pool, self, false, task)) {
+        return true;
+    }
+    if (popTask(pool, pool->numWorkers, true, task)) {
+        return true;
+    }
+
+    for (int pass = pool->numNodes > 1 ? 0 : 1; pass < 2; pass++) {
+        for (int i = 1; i <= pool->numWorkers; i++) {
+            int victim = (self + i) % pool->numWorkers;
+            if (victim == self ||
+                (pass == 0 && victim % pool->numNodes != self % pool->numNodes)) {
+                continue;
+            }
+            if (popTask(pool, victim, true, task)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Deque the calling thread queues tasks on */
+static int currentDeque(const TinyAIThreadPool *pool)
+{
+    return t_pool == pool ? t_deque : pool->numWorkers;
+}
+
+/* Start timing work on the calling thread; 0 when not tracking, or already timing an outer task */
+static uint64_t beginBusy(const TinyAIThreadPool *pool)
+{
+    if (!pool || !pool->trackBusy || t_countingBusy) {
+        return 0;
+    }
+    t_countingBusy = true;
+    return tinyaiTraceNow();
+}
+
+static void endBusy(TinyAIThreadPool *pool, uint64_t start)
+{
+    if (start != 0) {
+        t_countingBusy = false;
+        atomicAddTime(&pool->deques[currentDeque(pool)].busyNs, tinyaiTraceNow() - start);
+    }
+}
+
+/* Run a range of a loop on the calling thread */
+static void runRange(TinyAIThreadPool *pool, TinyAIParallelTask task, void *context, size_t begin,
+                     size_t end)
+{
+    uint64_t start = beginBusy(pool);
+    task(context, begin, end);
+    endBusy(pool, start);
+}
+
+/*
+ * Run a task under the token of the thread that queued it, and count it off
+ * its group. Ranges of a cancelled loop are skipped; group tasks always run,
+ * since they may own what they were handed.
+ */
+static void runTask(TinyAIThreadPool *pool, const Task *task)
+{
+    TinyAICancelToken *previous = tinyaiUseCancelToken(task->cancel);
+    uint64_t           start    = beginBusy(pool);
+    if (task->range) {
+        if (!tinyaiCancelRequested(task->cancel)) {
+            task->range(task->context, task->begin, task->end);
+        }
+    }
+    else {
+        task->func(task->context);
+    }
+    endBusy(pool, start);
+    tinyaiUseCancelToken(previous);
+
+    if (atomicAdd(&task->group->pending, -1) == 0) {
+        wakeThreads(pool, true);
+    }
+}
+
+/* Run queued tasks until a group has finished */
+static void helpUntilDone(TinyAIThreadPool *pool, TinyAITaskGroup *group)
+{
+    int self = currentDeque(pool);
+
+    while (atomicLoad(&group->pending) > 0) {
+        Task task;
+        if (takeTask(pool, self, &task)) {
+            runTask(pool, &task);
+            continue;
+        }
+
+        lockMutex(&pool->lock);
+        while (atomicLoad(&group->pending) > 0 && atomicLoad(&pool->queued) == 0) {
+            sleepThread(pool);
+        }
+        unlockMutex(&pool->lock);
+    }
+}
+
+/* Worker thread: run tasks, sleep while there are none, repeat */
+#ifdef _WIN32
+static unsigned __stdcall workerThreadFunc(void *param)
+{
+#else
+static void *workerThreadFunc(void *param)
+{
+#endif
+    TinyAIThreadPool *pool = (TinyAIThreadPool *)param;
+
+    lockMutex(&pool->lock);
+    int index = pool->nextWorker++;
+    unlockMutex(&pool->lock);
+
+    if (pool->numNodes > 1) {
+        /* Workers go round-robin across the nodes, so each streams from its own memory */
+        tinyaiNumaBindThread(index % pool->numNodes);
+    }
+    t_pool  = pool;
+    t_deque = index;
+
+    for (;;) {
+        Task task;
+        if (takeTask(pool, index, &task)) {
+            runTask(pool, &task);
+            continue;
+        }
+
+        lockMutex(&pool->lock);
+        while (!pool->shutdown && atomicLoad(&pool->queued) == 0) {
+            sleepThread(pool);
+        }
+        bool shutdown = pool->shutdown;
+        unlockMutex(&pool->lock);
+        if (shutdown) {
+            break;
+        }
+    }
+
+#ifdef _WIN32
+    _endthreadex(0);
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * Create a thread pool
+ */
+TinyAIThreadPool *tinyaiCreateThreadPool(int numThreads, size_t minWork)
+{
+    if (numThreads < 0) {
+        return NULL;
+    }
+    if (numThreads == 0) {
+        numThreads = onlineCpuCount();
+    }
+    if (numThreads > MAX_THREADS) {
+        numThreads = MAX_THREADS;
+    }
+
+    TinyAIThreadPool *pool = (TinyAIThreadPool *)TINYAI_MALLOC(sizeof(TinyAIThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+    memset(pool, 0, sizeof(TinyAIThreadPool));
+    pool->numThreads = numThreads;
+    pool->minWork    = minWork > 0 ? minWork : TINYAI_PARALLEL_MIN_WORK;
+    pool->numNodes   = tinyaiNumaGetMode() != TINYAI_NUMA_OFF ? tinyaiNumaNodeCount() : 0;
+
+    /* Deques exist for every worker up front, so thieves never see them change */
+    pool->deques = (TaskDeque *)TINYAI_MALLOC((size_t)numThreads * sizeof(TaskDeque));
+    if (!pool->deques) {
+        TINYAI_FREE(pool);
+        return NULL;
+    }
+    memset(pool->deques, 0, (size_t)numThreads * sizeof(TaskDeque));
+    for (int i = 0; i < numThreads; i++) {
+        initMutex(&pool->deques[i].lock);
+    }
+    if (numThreads > 1) {
+        pool->workers =
+            (ThreadHandle *)TINYAI_MALLOC((size_t)(numThreads - 1) * sizeof(ThreadHandle));
+        if (!pool->workers) {
+            for (int i = 0; i < numThreads; i++) {
+                destroyMutex(&pool->deques[i].lock);
+            }
+            TINYAI_FREE(pool->deques);
+            TINYAI_FREE(pool);
+            return NULL;
+        }
+    }
+
+    initMutex(&pool->lock);
+#ifdef _WIN32
+    InitializeConditionVariable(&pool->wake);
+#else
+    pthread_cond_init(&pool->wake, NULL);
+#endif
+
+    /* Workers are counted before they start, since outside callers use the last deque */
+    pool->numWorkers = numThreads - 1;
+    for (int i = 0; i < numThreads - 1; i++) {
+#ifdef _WIN32
+        pool->workers[i] = (HANDLE)_beginthreadex(NULL, 0, workerThreadFunc, pool, 0, NULL);
+        bool started     = pool->workers[i] != NULL;
+#else
+        bool started = pthread_create(&pool->workers[i], NULL, workerThreadFunc, pool) == 0;
+#endif
+        if (!started) {
+            pool->numWorkers = i;
+            tinyaiDestroyThreadPool(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+/**
+ * Stop the workers of a thread pool and free it
+ */
+void tinyaiDestroyThreadPool(TinyAIThreadPool *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    lockMutex(&pool->lock);
+    pool->shutdown = true;
+    unlockMutex(&pool->lock);
+    wakeThreads(pool, true);
+
+    for (int i = 0; i < pool->numWorkers; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->workers[i], INFINITE);
+        CloseHandle(pool->workers[i]);
+#else
+        pthread_join(pool->workers[i], NULL);
+#endif
+    }
+
+    destroyMutex(&pool->lock);
+#ifndef _WIN32
+    pthread_cond_destroy(&pool->wake);
+#endif
+    for (int i = 0; i < pool->numThreads; i++) {
+        destroyMutex(&pool->deques[i].lock);
+        if (pool->deques[i].tasks) {
+            TINYAI_FREE(pool->deques[i].tasks);
+        }
+    }
+    TINYAI_FREE(pool->deques);
+
+    if (pool->workers) {
+        TINYAI_FREE(pool->workers);
+    }
+    TINYAI_FREE(pool);
+}
+
+/**
+ * Get the number of threads that run tasks
+ */
+int tinyaiThreadPoolSize(const TinyAIThreadPool *pool)
+{
+    return pool ? pool->numThreads : 1;
+}
+
+/**
+ * Get the smallest number of iterations worth running as a separate task
+ */
+size_t tinyaiThreadPoolGrain(const TinyAIThreadPool *pool, size_t workPerItem, size_t alignment)
+{
+    size_t minWork = pool ? pool->minWork : TINYAI_PARALLEL_MIN_WORK;
+    if (workPerItem == 0) {
+        workPerItem = 1;
+    }
+    if (alignment == 0) {
+        alignment = 1;
+    }
+
+    size_t grain = (minWork + workPerItem - 1) / workPerItem;
+    grain        = (grain + alignment - 1) / alignment * alignment;
+    return grain > 0 ? grain : alignment;
+}
+
+/**
+ * Start or stop counting the time each thread spends running tasks
+ */
+void tinyaiThreadPoolTrackBusyTime(TinyAIThreadPool *pool, bool enable)
+{
+    if (!pool) {
+        return;
+    }
+    pool->trackBusy = false;
+    if (enable) {
+        for (int i = 0; i < pool->numThreads; i++) {
+            pool->deques[i].busyNs = 0;
+        }
+        pool->trackBusy = true;
+    }
+}
+
+/**
+ * Get the time each thread spent running tasks since tracking started
+ */
+int tinyaiThreadPoolGetBusyTime(const TinyAIThreadPool *pool, uint64_t *busyNs, int maxThreads)
+{
+    if (!pool || !busyNs) {
+        return 0;
+    }
+
+    int count = pool->numWorkers + 1 < maxThreads ? pool->numWorkers + 1 : maxThreads;
+    for (int i = 0; i < count; i++) {
+        busyNs[i] = atomicLoadTime(&pool->deques[i].busyNs);
+    }
+    return count;
+}
+
+/**
+ * Run a task over [0, count) split into contiguous ranges
+ */
+void tinyaiParallelFor(TinyAIThreadPool *pool, size_t count, size_t grain,
+                       TinyAIParallelTask task, void *context)
+{
+    if (!task || count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    /* Split into at most one task per thread, each at least grain iterations */
+    size_t numTasks = count / grain;
+    if (pool && (size_t)pool->numThreads < numTasks) {
+        numTasks = (size_t)pool->numThreads;
+    }
+    if (!pool || pool->numWorkers == 0 || numTasks < 2) {
+        runRange(pool, task, context, 0, count);
+        return;
+    }
+
+    size_t grains = (count + grain - 1) / grain;
+    size_t chunk  = (grains + numTasks - 1) / numTasks * grain;
+    numTasks      = (count + chunk - 1) / chunk;
+
+    /* Queue every range but the first, which the caller runs itself */
+    TinyAITaskGroup    group  = {pool, 0};
+    TinyAICancelToken *cancel = tinyaiCurrentCancelToken();
+    Task               ranges[MAX_THREADS];
+    for (size_t i = 1; i < numTasks; i++) {
+        Task *range    = &ranges[i - 1];
+        range->range   = task;
+        range->func    = NULL;
+        range->context = context;
+        range->begin   = i * chunk;
+        range->end     = range->begin + chunk < count ? range->begin + chunk : count;
+        range->group   = &group;
+        range->cancel  = cancel;
+    }
+    group.pending = (AtomicCount)(numTasks - 1);
+    if (!pushTasks(pool, currentDeque(pool), ranges, numTasks - 1)) {
+        runRange(pool, task, context, 0, count);
+        return;
+    }
+
+    runRange(pool, task, context, 0, chunk);
+    helpUntilDone(pool, &group);
+}
+
+/**
+ * Create a task group
+ */
+TinyAITaskGroup *tinyaiCreateTaskGroup(TinyAIThreadPool *pool)
+{
+    TinyAITaskGroup *group = (TinyAITaskGroup *)TINYAI_MALLOC(sizeof(TinyAITaskGroup));
+    if (group) {
+        group->pool    = pool;
+        group->pending = 0;
+    }
+    return group;
+}
+
+/**
+ * Wait for a task group and free it
+ */
+void tinyaiDestroyTaskGroup(TinyAITaskGroup *group)
+{
+    if (group) {
+        tinyaiTaskGroupWait(group);
+        TINYAI_FREE(group);
+    }
+}
+
+/**
+ * Queue a task in a group
+ */
+void tinyaiTaskGroupRun(TinyAITaskGroup *group, TinyAITaskFunc task, void *context, int node)
+{
+    if (!group || !task) {
+        return;
+    }
+
+    TinyAIThreadPool *pool = group->pool;
+    if (!pool || pool->numWorkers == 0) {
+        task(context);
+        return;
+    }
+
+    /* A node hint sends the task to one of the node's workers, round-robin */
+    int target = currentDeque(pool);
+    if (node >= 0 && pool->numNodes > 1 && node < pool->numNodes && node < pool->numWorkers) {
+        int perNode = (pool->numWorkers - node + pool->numNodes - 1) / pool->numNodes;
+        int turn    = (int)((unsigned long)atomicAdd(&pool->nextNode, 1) % (unsigned)perNode);
+        target      = node + turn * pool->numNodes;
+    }
+
+    Task queued = {NULL, task, context, 0, 0, group, tinyaiCurrentCancelToken()};
+    atomicAdd(&group->pending, 1);
+    if (!pushTasks(pool, target, &queued, 1)) {
+        atomicAdd(&group->pending, -1);
+        uint64_t start = beginBusy(pool);
+        task(context);
+        endBusy(pool, start);
+    }
+}
+
+/**
+ * Wait until every task queued in a group has finished
+ */
+void tinyaiTaskGroupWait(TinyAITaskGroup *group)
+{
+    if (group && group->pool && atomicLoad(&group->pending) > 0) {
+        helpUntilDone(group->pool, group);
+    }
+}
+
+/**
+ * Get the shared thread pool used by the built-in kernels
+ */
+TinyAIThreadPool *tinyaiGetThreadPool(void)
+{
+    TinyAIThreadPool *pool;
+
+    if (t_kernelOverride) {
+        return t_kernelPool;
+    }
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&g_sharedPoolLock);
+#else
+    pthread_mutex_lock(&g_sharedPoolLock);
+#endif
+
+    if (!g_sharedPoolCreated) {
+        /* The energy profile wakes fewer workers for longer bursts of work */
+        int minWork = TINYAI_PARALLEL_MIN_WORK;
+        if (tinyaiGetExecutionProfile() == TINYAI_PROFILE_ENERGY) {
+            minWork *= TINYAI_ENERGY_WORK_SCALE;
+        }
+        int numThreads = tinyaiProfileThreads(tinyaiConfigGetInt("system.threads", 1));
+        minWork        = tinyaiConfigGetInt("system.parallel_min_work", minWork);
+
+        /* A single-threaded configuration needs no pool at all */
+        if (numThreads == 0 || numThreads > 1) {
+            g_sharedPool = tinyaiCreateThreadPool(numThreads, minWork > 0 ? (size_t)minWork : 0);
+            if (g_sharedPool && g_sharedPool->numThreads < 2) {
+                tinyaiDestroyThreadPool(g_sharedPool);
+                g_sharedPool = NULL;
+            }
+        }
+        g_sharedPoolCreated = true;
+    }
+    pool = g_sharedPool;
+
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&g_sharedPoolLock);
+#else
+    pthread_mutex_unlock(&g_sharedPoolLock);
+#endif
+
+    return pool;
+}
+
+/**
+ * Route the built-in kernels started on this thread to another pool
+ */
+TinyAIThreadPoolScope tinyaiUseThreadPool(TinyAIThreadPool *pool)
+{
+    TinyAIThreadPoolScope previous = {t_kernelPool, t_kernelOverride};
+
+    t_kernelPool     = pool;
+    t_kernelOverride = true;
+    return previous;
+}
+
+/**
+ * Undo a tinyaiUseThreadPool call
+ */
+void tinyaiRestoreThreadPool(TinyAIThreadPoolScope scope)
+{
+    t_kernelPool     = scope.pool;
+    t_kernelOverride = scope.active;
+}
+
+/**
+ * Destroy the shared thread pool
+ */
+void tinyaiShutdownThreadPool(void)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&g_sharedPoolLock);
+#else
+    pthread_mutex_lock(&g_sharedPoolLock);
+#endif
+
+    tinyaiDestroyThreadPool(g_sharedPool);
+    g_sharedPool        = NULL;
+    g_sharedPoolCreated = false;
+
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&g_sharedPoolLock);
+#else
+    pthread_mutex_unlock(&g_sharedPoolLock);
+#endif
+}
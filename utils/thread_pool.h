@@ -0,0 +1,243 @@
+/**
+ * @file thread_pool.h
+ * @brief Work-stealing thread pool for TinyAI kernels
+ *
+ * Splits the iterations of a data-parallel loop (output columns of a GEMV,
+ * attention heads, convolution channels) across a fixed set of worker
+ * threads, and runs groups of independent tasks. The calling thread always
+ * runs one share of the work itself, and loops too small to amortize the
+ * hand-off stay on the calling thread.
+ *
+ * Each worker keeps its own deque of tasks: it runs the newest of its own
+ * tasks first and, when it runs dry, steals the oldest from the others
+ * (workers on the same NUMA node first). Threads waiting for their tasks run
+ * queued tasks meanwhile, so loops nested inside tasks and loops started by
+ * several threads at once all share the workers without deadlocking.
+ */
+
+#ifndef TINYAI_THREAD_POOL_H
+#define TINYAI_THREAD_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Default minimum work per task, in multiply-adds
+ *
+ * Overridden by the "system.parallel_min_work" configuration key.
+ */
+#define TINYAI_PARALLEL_MIN_WORK 32768
+
+/**
+ * Thread pool (opaque)
+ */
+typedef struct TinyAIThreadPool TinyAIThreadPool;
+
+/**
+ * Task run by tinyaiParallelFor on one range of iterations
+ *
+ * @param context Caller-supplied context
+ * @param begin First iteration of the range
+ * @param end One past the last iteration of the range
+ */
+typedef void (*TinyAIParallelTask)(void *context, size_t begin, size_t end);
+
+/**
+ * Task run by a task group
+ *
+ * @param context Caller-supplied context
+ */
+typedef void (*TinyAITaskFunc)(void *context);
+
+/**
+ * Group of tasks waited for together (opaque)
+ */
+typedef struct TinyAITaskGroup TinyAITaskGroup;
+
+/**
+ * Affinity hint for tasks that may run on any node
+ */
+#define TINYAI_AFFINITY_ANY -1
+
+/**
+ * Create a thread pool
+ *
+ * When the "system.numa" configuration key selects a NUMA mode, workers are
+ * pinned to the nodes round-robin (see numa.h).
+ *
+ * @param numThreads Total threads including the caller (0 = one per online CPU)
+ * @param minWork Minimum work per task in multiply-adds (0 = TINYAI_PARALLEL_MIN_WORK)
+ * @return New thread pool or NULL on error
+ */
+TinyAIThreadPool *tinyaiCreateThreadPool(int numThreads, size_t minWork);
+
+/**
+ * Stop the workers of a thread pool and free it
+ *
+ * @param pool Thread pool to free
+ */
+void tinyaiDestroyThreadPool(TinyAIThreadPool *pool);
+
+/**
+ * Get the number of threads that run tasks, including the caller
+ *
+ * @param pool Thread pool (NULL counts as a single thread)
+ * @return Thread count
+ */
+int tinyaiThreadPoolSize(const TinyAIThreadPool *pool);
+
+/**
+ * Get the smallest number of iterations worth running as a separate task
+ *
+ * @param pool Thread pool (NULL uses TINYAI_PARALLEL_MIN_WORK)
+ * @param workPerItem Multiply-adds per iteration
+ * @param alignment Task boundaries are rounded to a multiple of this (0 = 1)
+ * @return Minimum iterations per task, a multiple of alignment
+ */
+size_t tinyaiThreadPoolGrain(const TinyAIThreadPool *pool, size_t workPerItem, size_t alignment);
+
+/**
+ * Start or stop counting the time each thread spends running tasks
+ *
+ * Starting resets the counts. A task's time includes waits for loops it
+ * starts itself; nested tasks are not counted twice.
+ *
+ * @param pool Thread pool
+ * @param enable Whether to count
+ */
+void tinyaiThreadPoolTrackBusyTime(TinyAIThreadPool *pool, bool enable);
+
+/**
+ * Get the time each thread spent running tasks since tracking started
+ *
+ * Entry i is worker i, and the last entry sums the threads outside the pool
+ * that ran loops on it (normally the one caller), so the spread of the
+ * entries shows how evenly the work was split.
+ *
+ * @param pool Thread pool
+ * @param busyNs Receives one time in nanoseconds per thread
+ * @param maxThreads Capacity of busyNs
+ * @return Number of entries written (tinyaiThreadPoolSize when it fits)
+ */
+int tinyaiThreadPoolGetBusyTime(const TinyAIThreadPool *pool, uint64_t *busyNs, int maxThreads);
+
+/**
+ * Run a task over [0, count) split into contiguous ranges
+ *
+ * Every range except the last holds a multiple of grain iterations, and no
+ * task gets fewer than grain iterations, so count < 2 * grain runs serially
+ * on the calling thread. Ranges are disjoint, so tasks may write to
+ * per-iteration outputs without locking. Calls may be nested inside tasks
+ * or made from several threads at once. Ranges run under the cancellation
+ * token installed on the calling thread (see cancel.h), and queued ranges
+ * not yet started when it is cancelled are skipped.
+ *
+ * @param pool Thread pool (NULL runs serially)
+ * @param count Number of iterations
+ * @param grain Minimum iterations per task (0 = 1)
+ * @param task Task to run
+ * @param context Context passed to every task
+ */
+void tinyaiParallelFor(TinyAIThreadPool *pool, size_t count, size_t grain,
+                       TinyAIParallelTask task, void *context);
+
+/**
+ * Create a task group
+ *
+ * @param pool Thread pool the tasks run on (NULL runs every task as it is queued)
+ * @return New task group or NULL on error
+ */
+TinyAITaskGroup *tinyaiCreateTaskGroup(TinyAIThreadPool *pool);
+
+/**
+ * Wait for the tasks of a group and free it
+ *
+ * @param group Task group to free
+ */
+void tinyaiDestroyTaskGroup(TinyAITaskGroup *group);
+
+/**
+ * Queue a task in a group
+ *
+ * Tasks queued from a worker go on that worker's deque. A node hint sends the
+ * task to a worker pinned to that node instead, so it runs near the memory it
+ * reads unless another thread steals it. A task that cannot be queued runs
+ * on the calling thread before this returns. Tasks run under the calling
+ * thread's cancellation token, and run even once it is cancelled.
+ *
+ * @param group Task group
+ * @param task Task to run
+ * @param context Context passed to the task
+ * @param node NUMA node the task prefers (TINYAI_AFFINITY_ANY for none)
+ */
+void tinyaiTaskGroupRun(TinyAITaskGroup *group, TinyAITaskFunc task, void *context, int node);
+
+/**
+ * Wait until every task queued in a group has finished
+ *
+ * The calling thread runs queued tasks while it waits. Tasks may queue more
+ * tasks in their own group.
+ *
+ * @param group Task group
+ */
+void tinyaiTaskGroupWait(TinyAITaskGroup *group);
+
+/**
+ * Get the shared thread pool used by the built-in kernels
+ *
+ * Created on first use from the "system.threads" (0 = one per online CPU,
+ * default 1) and "system.parallel_min_work" configuration keys. The energy
+ * execution profile caps the threads and scales up the default minimum work
+ * (see energy.h).
+ *
+ * @return Shared thread pool, or NULL when kernels should run serially
+ */
+TinyAIThreadPool *tinyaiGetThreadPool(void);
+
+/**
+ * Kernel pool of a thread, saved by tinyaiUseThreadPool
+ */
+typedef struct {
+    TinyAIThreadPool *pool;
+    bool              active;
+} TinyAIThreadPoolScope;
+
+/**
+ * Route the built-in kernels started on this thread to another pool
+ *
+ * Until restored, tinyaiGetThreadPool on the calling thread returns pool
+ * instead of the shared pool, so one model can run on its own pool, or
+ * serially, without changing the configuration for everything else. Only the
+ * calling thread is affected; kernels nested in tasks on workers still see
+ * the shared pool.
+ *
+ * @param pool Pool the kernels use (NULL runs them serially)
+ * @return Previous setting, for tinyaiRestoreThreadPool
+ */
+TinyAIThreadPoolScope tinyaiUseThreadPool(TinyAIThreadPool *pool);
+
+/**
+ * Undo a tinyaiUseThreadPool call
+ *
+ * @param scope Setting returned by the matching tinyaiUseThreadPool
+ */
+void tinyaiRestoreThreadPool(TinyAIThreadPoolScope scope);
+
+/**
+ * Destroy the shared thread pool
+ *
+ * The next tinyaiGetThreadPool call re-reads the configuration. Must not be
+ * called while kernels are running on other threads.
+ */
+void tinyaiShutdownThreadPool(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_THREAD_POOL_H */
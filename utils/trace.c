@@ -0,0 +1,257 @@
+/**
+ * @file trace.c
+ * @brief Implementation of per-thread trace spans and Chrome trace export
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* A finished span */
+typedef struct {
+    const char *name;
+    uint64_t    start; /* tinyaiTraceNow() time */
+    uint64_t    duration;
+    int64_t     arg;
+} TraceSpan;
+
+/*
+ * Spans of one thread. Only the owner writes a buffer; it publishes count
+ * with a release store, so an export sees whole spans. A buffer belongs to
+ * the trace of its epoch; on the first span of a newer trace the owner
+ * empties it, so starting a trace never touches another thread's buffer.
+ */
+typedef struct TraceBuffer {
+    TraceSpan          *spans;
+    size_t              capacity;
+    size_t              count;
+    size_t              dropped;
+    unsigned            epoch;
+    int                 tid;
+    const char         *name;
+    struct TraceBuffer *next;
+} TraceBuffer;
+
+int tinyaiTraceActive = 0;
+
+static TraceBuffer *g_buffers  = NULL; /* Every buffer; they live as long as the process */
+static unsigned     g_epoch    = 0;    /* Trace number, bumped by every start */
+static size_t       g_capacity = TINYAI_TRACE_DEFAULT_SPANS;
+static uint64_t     g_base     = 0; /* Clock at the start of the trace */
+static int          g_nextTid  = 0;
+
+static THREAD_LOCAL TraceBuffer *t_buffer = NULL;
+static THREAD_LOCAL const char  *t_name   = NULL;
+
+uint64_t tinyaiTraceNow(void)
+{
+    uint64_t now;
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER        counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    now = (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+          (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull /
+              (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+    return now ? now : 1;
+}
+
+/* The calling thread's buffer, emptied for the current trace */
+static TraceBuffer *threadBuffer(void)
+{
+    unsigned     epoch  = __atomic_load_n(&g_epoch, __ATOMIC_ACQUIRE);
+    TraceBuffer *buffer = t_buffer;
+    if (buffer && buffer->epoch == epoch) {
+        return buffer;
+    }
+
+    if (!buffer) {
+        buffer = (TraceBuffer *)calloc(1, sizeof(TraceBuffer));
+        if (!buffer) {
+            return NULL;
+        }
+        buffer->tid   = __atomic_add_fetch(&g_nextTid, 1, __ATOMIC_RELAXED);
+        buffer->name  = t_name;
+        buffer->epoch = epoch - 1;
+        buffer->next  = __atomic_load_n(&g_buffers, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&g_buffers, &buffer->next, buffer, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+        t_buffer = buffer;
+    }
+
+    /* Empty it for the new trace, at that trace's size */
+    __atomic_store_n(&buffer->count, 0, __ATOMIC_RELAXED);
+    buffer->dropped = 0;
+    size_t capacity = __atomic_load_n(&g_capacity, __ATOMIC_RELAXED);
+    if (buffer->capacity != capacity) {
+        TraceSpan *spans = (TraceSpan *)realloc(buffer->spans, capacity * sizeof(TraceSpan));
+        if (!spans) {
+            return NULL;
+        }
+        buffer->spans    = spans;
+        buffer->capacity = capacity;
+    }
+    __atomic_store_n(&buffer->epoch, epoch, __ATOMIC_RELEASE);
+    return buffer;
+}
+
+void tinyaiTraceSpan(const char *name, uint64_t start, int64_t arg)
+{
+    uint64_t     end    = tinyaiTraceNow();
+    TraceBuffer *buffer = threadBuffer();
+    if (!buffer) {
+        return;
+    }
+
+    size_t count = buffer->count;
+    if (count == buffer->capacity) {
+        __atomic_store_n(&buffer->dropped, buffer->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    TraceSpan *span = &buffer->spans[count];
+    span->name      = name;
+    span->start     = start;
+    span->duration  = end - start;
+    span->arg       = arg;
+    __atomic_store_n(&buffer->count, count + 1, __ATOMIC_RELEASE);
+}
+
+void tinyaiTraceSetThreadName(const char *name)
+{
+    t_name = name;
+    if (t_buffer) {
+        t_buffer->name = name;
+    }
+}
+
+bool tinyaiTraceStart(size_t spansPerThread)
+{
+    __atomic_store_n(&g_capacity, spansPerThread ? spansPerThread : TINYAI_TRACE_DEFAULT_SPANS,
+                     __ATOMIC_RELAXED);
+    g_base = tinyaiTraceNow();
+    __atomic_add_fetch(&g_epoch, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&tinyaiTraceActive, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void tinyaiTraceStop(void)
+{
+    __atomic_store_n(&tinyaiTraceActive, 0, __ATOMIC_RELEASE);
+}
+
+/* Spans of the current trace in a buffer, or 0 if it has none */
+static size_t bufferSpans(const TraceBuffer *buffer)
+{
+    unsigned epoch = __atomic_load_n(&g_epoch, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&buffer->epoch, __ATOMIC_ACQUIRE) != epoch) {
+        return 0;
+    }
+    return __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+}
+
+void tinyaiTraceGetStats(TinyAITraceStats *stats)
+{
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    for (TraceBuffer *buffer = __atomic_load_n(&g_buffers, __ATOMIC_ACQUIRE); buffer;
+         buffer              = buffer->next) {
+        size_t spans = bufferSpans(buffer);
+        if (spans > 0) {
+            stats->spans += spans;
+            stats->dropped += __atomic_load_n(&buffer->dropped, __ATOMIC_RELAXED);
+            stats->threads++;
+        }
+    }
+}
+
+/* Write a string as a JSON string, for names that are not plain literals */
+static void writeJsonName(FILE *file, const char *name)
+{
+    fputc('"', file);
+    for (const char *p = name; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', file);
+        }
+        if ((unsigned char)*p >= 0x20) {
+            fputc(*p, file);
+        }
+    }
+    fputc('"', file);
+}
+
+bool tinyaiTraceWrite(const char *path)
+{
+    FILE *file = path ? fopen(path, "w") : NULL;
+    if (!file) {
+        fprintf(stderr, "Failed to open trace file: %s\n", path ? path : "(null)");
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                  "\"args\":{\"name\":\"tinyai\"}}");
+
+    for (TraceBuffer *buffer = __atomic_load_n(&g_buffers, __ATOMIC_ACQUIRE); buffer;
+         buffer              = buffer->next) {
+        size_t spans = bufferSpans(buffer);
+        if (spans == 0) {
+            continue;
+        }
+
+        if (buffer->name) {
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                          "\"args\":{\"name\":",
+                    buffer->tid);
+            writeJsonName(file, buffer->name);
+            fprintf(file, "}}");
+        }
+
+        /* Complete events, in microseconds since the trace started */
+        for (size_t i = 0; i < spans; i++) {
+            const TraceSpan *span  = &buffer->spans[i];
+            uint64_t         start = span->start > g_base ? span->start - g_base : 0;
+            fprintf(file, ",\n{\"name\":");
+            writeJsonName(file, span->name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    buffer->tid, start / 1000.0, span->duration / 1000.0);
+            if (span->arg != TINYAI_TRACE_NO_ARG) {
+                fprintf(file, ",\"args\":{\"value\":%lld}", (long long)span->arg);
+            }
+            fputc('}', file);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    bool written = !ferror(file);
+    if (fclose(file) != 0) {
+        written = false;
+    }
+    if (!written) {
+        fprintf(stderr, "Failed to write trace file: %s\n", path);
+    }
+    return written;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file trace.h
+ * @brief Timed trace spans, exported as Chrome trace JSON
+ *
+ * A span covers one piece of work on one thread: tokenizing a prompt, a
+ * layer of a forward pass, a step of attention, an MCP call, an HTTP
+ * request. Spans go to a buffer of the thread that ran them, so recording
+ * takes no lock, and tinyaiTraceWrite() merges every thread's spans into a
+ * file that chrome://tracing and Perfetto (ui.perfetto.dev) open directly.
+ *
+ * While tracing is off a span costs one relaxed load and a branch; building
+ * with TINYAI_NO_TRACE removes spans altogether.
+ *
+ *     uint64_t span = TINYAI_TRACE_BEGIN();
+ *     ... work ...
+ *     TINYAI_TRACE_END_ARG(span, "layer", layerIndex);
+ *
+ * A span that is never ended (an early error return, say) is simply not
+ * recorded. Names must be string literals or otherwise outlive the trace.
+ */
+
+#ifndef TINYAI_TRACE_H
+#define TINYAI_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Spans a thread buffers when tinyaiTraceStart() is given 0
+ */
+#define TINYAI_TRACE_DEFAULT_SPANS (64 * 1024)
+
+/**
+ * Span argument meaning "none"
+ */
+#define TINYAI_TRACE_NO_ARG INT64_MIN
+
+/**
+ * Nonzero while spans are recorded; read through the macros
+ */
+extern int tinyaiTraceActive;
+
+/**
+ * Trace statistics
+ */
+typedef struct {
+    size_t spans;   /* Spans recorded since tracing started */
+    size_t dropped; /* Spans lost to full thread buffers */
+    int    threads; /* Threads that recorded spans */
+} TinyAITraceStats;
+
+/**
+ * Start recording spans, discarding those of an earlier trace
+ *
+ * @param spansPerThread Capacity of each thread's buffer (0 for the default)
+ * @return true on success
+ */
+bool tinyaiTraceStart(size_t spansPerThread);
+
+/**
+ * Stop recording spans; recorded spans stay until the next start
+ */
+void tinyaiTraceStop(void);
+
+/**
+ * Write the recorded spans as Chrome trace JSON
+ *
+ * @param path Output file
+ * @return true on success
+ */
+bool tinyaiTraceWrite(const char *path);
+
+/**
+ * Get statistics of the current trace
+ *
+ * @param stats Receives the statistics
+ */
+void tinyaiTraceGetStats(TinyAITraceStats *stats);
+
+/**
+ * Name the calling thread in traces
+ *
+ * @param name Thread name; a literal, or a string that outlives the trace
+ */
+void tinyaiTraceSetThreadName(const char *name);
+
+/**
+ * Current trace clock
+ *
+ * @return Monotonic time in nanoseconds, never 0
+ */
+uint64_t tinyaiTraceNow(void);
+
+/**
+ * Record a span that started at a tinyaiTraceNow() time and ends now
+ *
+ * @param name Span name
+ * @param start Start time
+ * @param arg Value shown with the span, or TINYAI_TRACE_NO_ARG
+ */
+void tinyaiTraceSpan(const char *name, uint64_t start, int64_t arg);
+
+#ifndef TINYAI_NO_TRACE
+#define TINYAI_TRACE_BEGIN()                                                                       \
+    (__atomic_load_n(&tinyaiTraceActive, __ATOMIC_RELAXED) ? tinyaiTraceNow() : 0)
+#define TINYAI_TRACE_END_ARG(start, name, arg)                                                     \
+    do {                                                                                           \
+        if (start) {                                                                               \
+            tinyaiTraceSpan(name, start, arg);                                                     \
+        }                                                                                          \
+    } while (0)
+#else
+#define TINYAI_TRACE_BEGIN() ((uint64_t)0)
+#define TINYAI_TRACE_END_ARG(start, name, arg) ((void)(start))
+#endif
+
+#define TINYAI_TRACE_END(start, name) TINYAI_TRACE_END_ARG(start, name, TINYAI_TRACE_NO_ARG)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_TRACE_H */
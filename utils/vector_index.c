@@ -0,0 +1,880 @@
+/**
+ * @file vector_index.c
+ * @brief Implementation of the HNSW nearest-neighbor index over int8 embeddings
+ */
+
+#include "vector_index.h"
+#include "../core/memory.h"
+#include "simd_ops.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Defaults of zero parameters */
+#define DEFAULT_NEIGHBORS 16
+#define DEFAULT_EF_CONSTRUCTION 100
+#define DEFAULT_EF_SEARCH 64
+
+/* Layers above the bottom one a node may reach; a draw past it is clamped */
+#define MAX_LEVEL 16
+
+/* Nodes the arrays first grow to */
+#define INITIAL_CAPACITY 64
+
+/* Saved header, also the index's parameters and counts in memory */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t metric;     /* TinyAIVectorMetric */
+    uint32_t neighbors;  /* M */
+    uint32_t efConstruction;
+    uint32_t efSearch;
+    uint32_t count;      /* Nodes */
+    uint32_t upperCount; /* Upper-layer lists over all nodes */
+    uint32_t entryPoint; /* Node searches start from */
+    int32_t  maxLevel;   /* Top layer of the entry point (-1 when empty) */
+    uint32_t reserved;
+    uint64_t rng;        /* State of the layer draws */
+    uint64_t reserved2;
+} IndexHeader;
+
+struct TinyAIVectorIndex {
+    IndexHeader header;        /* Parameters and counts, as saved */
+    uint32_t    capacity;      /* Nodes the arrays hold */
+    uint32_t    upperCapacity; /* Upper-layer lists upperLinks holds */
+    uint64_t   *ids;           /* Id of each node */
+    float      *scales;        /* Dequantization scale of each vector */
+    float      *norms;         /* Squared norm of each dequantized vector */
+    uint32_t   *levels;        /* Top layer of each node */
+    uint32_t   *upperStart;    /* First upper-layer list of each node (one per layer above 0) */
+    int8_t     *vectors;       /* [capacity x dimension] */
+    uint32_t   *links;         /* Bottom layer: count, then up to 2M neighbors, per node */
+    uint32_t   *upperLinks;    /* Layers above: count, then up to M neighbors, per list */
+    void       *mapping;       /* File the arrays point into (NULL: they are on the heap) */
+    size_t      mappingSize;
+};
+
+/* A vector distances are measured from */
+typedef struct {
+    const int8_t *bytes;
+    float         scale;
+    float         norm; /* Squared norm */
+} IndexQuery;
+
+/* A node and its distance from the query */
+typedef struct {
+    float    distance;
+    uint32_t node;
+} Candidate;
+
+/* Binary min-heap of candidates; pushing negated distances makes it a max-heap */
+typedef struct {
+    Candidate *items;
+    uint32_t   size;
+    uint32_t   capacity;
+} CandidateHeap;
+
+/* Per-call memory of a layer search */
+typedef struct {
+    uint8_t      *visited;   /* One bit per node */
+    size_t        visitedBytes;
+    CandidateHeap frontier;  /* Nodes left to expand, closest first */
+    CandidateHeap results;   /* Best ef nodes so far, farthest first */
+    Candidate    *sorted;    /* Results closest first */
+    Candidate    *selected;  /* Neighbors chosen for a node */
+    Candidate    *neighbors; /* Links of a new node while linking back to it */
+    uint32_t     *skipped;   /* Candidates passed over while choosing neighbors */
+} SearchScratch;
+
+/* ----------------- Layout ----------------- */
+
+static uint32_t maxLinks(const TinyAIVectorIndex *index, int level)
+{
+    return level == 0 ? 2 * index->header.neighbors : index->header.neighbors;
+}
+
+/* Link list of a node on a layer: count, then the neighbors */
+static uint32_t *nodeLinks(const TinyAIVectorIndex *index, uint32_t node, int level)
+{
+    if (level == 0) {
+        return index->links + (size_t)node * (2 * index->header.neighbors + 1);
+    }
+    return index->upperLinks +
+           (size_t)(index->upperStart[node] + (uint32_t)level - 1) * (index->header.neighbors + 1);
+}
+
+static size_t alignOffset(size_t offset)
+{
+    return (offset + TINYAI_VECTOR_INDEX_ALIGNMENT - 1) / TINYAI_VECTOR_INDEX_ALIGNMENT *
+           TINYAI_VECTOR_INDEX_ALIGNMENT;
+}
+
+/* Bytes of each saved array, in file order */
+static void arraySizes(const IndexHeader *header, size_t sizes[8])
+{
+    size_t count = header->count;
+    sizes[0]     = count * sizeof(uint64_t);
+    sizes[1]     = count * sizeof(float);
+    sizes[2]     = count * sizeof(float);
+    sizes[3]     = count * sizeof(uint32_t);
+    sizes[4]     = count * sizeof(uint32_t);
+    sizes[5]     = count * header->dimension;
+    sizes[6]     = count * (2 * (size_t)header->neighbors + 1) * sizeof(uint32_t);
+    sizes[7]     = (size_t)header->upperCount * (header->neighbors + 1) * sizeof(uint32_t);
+}
+
+/* Array addresses of an index, in file order */
+static void arrayAddresses(TinyAIVectorIndex *index, void **arrays[8])
+{
+    arrays[0] = (void **)&index->ids;
+    arrays[1] = (void **)&index->scales;
+    arrays[2] = (void **)&index->norms;
+    arrays[3] = (void **)&index->levels;
+    arrays[4] = (void **)&index->upperStart;
+    arrays[5] = (void **)&index->vectors;
+    arrays[6] = (void **)&index->links;
+    arrays[7] = (void **)&index->upperLinks;
+}
+
+/* ----------------- Distances ----------------- */
+
+static float queryDistance(const TinyAIVectorIndex *index, const IndexQuery *query, uint32_t node)
+{
+    uint32_t dimension = index->header.dimension;
+    int32_t  dot       = tinyaiSimdDotInt8(query->bytes, index->vectors + (size_t)node * dimension,
+                                           (int)dimension);
+    float    product   = (float)dot * query->scale * index->scales[node];
+
+    switch ((TinyAIVectorMetric)index->header.metric) {
+    case TINYAI_VECTOR_L2:
+        return query->norm + index->norms[node] - 2.0f * product;
+    case TINYAI_VECTOR_DOT:
+        return -product;
+    default:
+        return 1.0f - product;
+    }
+}
+
+static IndexQuery nodeQuery(const TinyAIVectorIndex *index, uint32_t node)
+{
+    IndexQuery query = {index->vectors + (size_t)node * index->header.dimension,
+                        index->scales[node], index->norms[node]};
+    return query;
+}
+
+/* Quantize a vector, normalized first under the cosine metric; returns its squared norm */
+static float quantizeVector(const TinyAIVectorIndex *index, const float *vector, float *scratch,
+                            int8_t *bytes, float *scale)
+{
+    int dimension = (int)index->header.dimension;
+
+    if (index->header.metric == TINYAI_VECTOR_COSINE) {
+        float norm = sqrtf(tinyaiSimdDot(vector, vector, dimension));
+        for (int i = 0; i < dimension; i++) {
+            scratch[i] = norm > 0.0f ? vector[i] / norm : 0.0f;
+        }
+        vector = scratch;
+    }
+
+    *scale = tinyaiSimdQuantizeInt8(bytes, vector, dimension);
+    return (float)tinyaiSimdDotInt8(bytes, bytes, dimension) * *scale * *scale;
+}
+
+/* ----------------- Heaps ----------------- */
+
+static bool heapPush(CandidateHeap *heap, float distance, uint32_t node)
+{
+    if (heap->size == heap->capacity) {
+        uint32_t   capacity = heap->capacity ? heap->capacity * 2 : 64;
+        Candidate *items =
+            (Candidate *)TINYAI_REALLOC(heap->items, (size_t)capacity * sizeof(Candidate));
+        if (!items) {
+            return false;
+        }
+        heap->items    = items;
+        heap->capacity = capacity;
+    }
+
+    uint32_t i = heap->size++;
+    while (i > 0 && heap->items[(i - 1) / 2].distance > distance) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i              = (i - 1) / 2;
+    }
+    heap->items[i].distance = distance;
+    heap->items[i].node     = node;
+    return true;
+}
+
+static Candidate heapPop(CandidateHeap *heap)
+{
+    Candidate top  = heap->items[0];
+    Candidate last = heap->items[--heap->size];
+    uint32_t  i    = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if (child + 1 < heap->size &&
+            heap->items[child + 1].distance < heap->items[child].distance) {
+            child++;
+        }
+        if (heap->items[child].distance >= last.distance) {
+            break;
+        }
+        heap->items[i] = heap->items[child];
+        i              = child;
+    }
+    if (heap->size > 0) {
+        heap->items[i] = last;
+    }
+    return top;
+}
+
+/* ----------------- Search ----------------- */
+
+static bool initScratch(SearchScratch *scratch, const TinyAIVectorIndex *index, uint32_t nodes,
+                        uint32_t ef)
+{
+    memset(scratch, 0, sizeof(SearchScratch));
+    uint32_t sortedSize   = ef > 2 * index->header.neighbors + 1 ? ef
+                                                                 : 2 * index->header.neighbors + 1;
+    scratch->visitedBytes = (nodes + 7) / 8;
+    scratch->visited      = (uint8_t *)TINYAI_MALLOC(scratch->visitedBytes);
+    scratch->sorted       = (Candidate *)TINYAI_MALLOC(sortedSize * sizeof(Candidate));
+    scratch->selected     = (Candidate *)TINYAI_MALLOC(sortedSize * sizeof(Candidate));
+    scratch->neighbors    = (Candidate *)TINYAI_MALLOC(sortedSize * sizeof(Candidate));
+    scratch->skipped      = (uint32_t *)TINYAI_MALLOC(sortedSize * sizeof(uint32_t));
+    return scratch->visited && scratch->sorted && scratch->selected && scratch->neighbors &&
+           scratch->skipped;
+}
+
+static void freeScratch(SearchScratch *scratch)
+{
+    TINYAI_FREE(scratch->visited);
+    TINYAI_FREE(scratch->frontier.items);
+    TINYAI_FREE(scratch->results.items);
+    TINYAI_FREE(scratch->sorted);
+    TINYAI_FREE(scratch->selected);
+    TINYAI_FREE(scratch->neighbors);
+    TINYAI_FREE(scratch->skipped);
+}
+
+/* Walk one layer towards the query while a neighbor is closer */
+static Candidate greedyClosest(const TinyAIVectorIndex *index, const IndexQuery *query,
+                               Candidate current, int level)
+{
+    bool moved = true;
+    while (moved) {
+        moved                 = false;
+        const uint32_t *links = nodeLinks(index, current.node, level);
+        for (uint32_t i = 1; i <= links[0]; i++) {
+            float distance = queryDistance(index, query, links[i]);
+            if (distance < current.distance) {
+                current.distance = distance;
+                current.node     = links[i];
+                moved            = true;
+            }
+        }
+    }
+    return current;
+}
+
+/*
+ * Best-first search of one layer from an entry node, keeping the ef closest
+ * nodes seen; leaves them in scratch->sorted, closest first, and returns how many
+ */
+static int searchLayer(const TinyAIVectorIndex *index, const IndexQuery *query, Candidate entry,
+                       uint32_t ef, int level, SearchScratch *scratch)
+{
+    memset(scratch->visited, 0, scratch->visitedBytes);
+    scratch->frontier.size = 0;
+    scratch->results.size  = 0;
+
+    scratch->visited[entry.node / 8] |= (uint8_t)(1u << (entry.node % 8));
+    if (!heapPush(&scratch->frontier, entry.distance, entry.node) ||
+        !heapPush(&scratch->results, -entry.distance, entry.node)) {
+        return -1;
+    }
+
+    while (scratch->frontier.size > 0) {
+        Candidate nearest = heapPop(&scratch->frontier);
+        if (nearest.distance > -scratch->results.items[0].distance) {
+            /* Every node left is farther than the worst result */
+            break;
+        }
+
+        const uint32_t *links = nodeLinks(index, nearest.node, level);
+        for (uint32_t i = 1; i <= links[0]; i++) {
+            uint32_t node = links[i];
+            uint8_t  bit  = (uint8_t)(1u << (node % 8));
+            if (scratch->visited[node / 8] & bit) {
+                continue;
+            }
+            scratch->visited[node / 8] |= bit;
+
+            float distance = queryDistance(index, query, node);
+            if (scratch->results.size < ef || distance < -scratch->results.items[0].distance) {
+                if (!heapPush(&scratch->frontier, distance, node) ||
+                    !heapPush(&scratch->results, -distance, node)) {
+                    return -1;
+                }
+                if (scratch->results.size > ef) {
+                    heapPop(&scratch->results);
+                }
+            }
+        }
+    }
+
+    /* The max-heap pops farthest first */
+    int found = (int)scratch->results.size;
+    for (int i = found - 1; i >= 0; i--) {
+        Candidate worst    = heapPop(&scratch->results);
+        worst.distance     = -worst.distance;
+        scratch->sorted[i] = worst;
+    }
+    return found;
+}
+
+/* ----------------- Insertion ----------------- */
+
+/*
+ * Pick up to limit neighbors from candidates sorted closest first, skipping a
+ * candidate closer to an already chosen neighbor than to the base node so the
+ * links spread in different directions; skipped ones fill any room left
+ */
+static uint32_t selectNeighbors(const TinyAIVectorIndex *index, const Candidate *candidates,
+                                uint32_t count, uint32_t limit, Candidate *selected,
+                                uint32_t *skipped)
+{
+    uint32_t chosen     = 0;
+    uint32_t numSkipped = 0;
+
+    for (uint32_t i = 0; i < count && chosen < limit; i++) {
+        IndexQuery candidate = nodeQuery(index, candidates[i].node);
+        bool       diverse   = true;
+        for (uint32_t j = 0; j < chosen && diverse; j++) {
+            diverse = queryDistance(index, &candidate, selected[j].node) >= candidates[i].distance;
+        }
+
+        if (diverse) {
+            selected[chosen++] = candidates[i];
+        }
+        else {
+            skipped[numSkipped++] = i;
+        }
+    }
+
+    for (uint32_t i = 0; i < numSkipped && chosen < limit; i++) {
+        selected[chosen++] = candidates[skipped[i]];
+    }
+    return chosen;
+}
+
+/* Link a neighbor back to a new node, re-selecting its links when they are full */
+static void linkBack(TinyAIVectorIndex *index, uint32_t neighbor, uint32_t node, int level,
+                     SearchScratch *scratch)
+{
+    uint32_t *links = nodeLinks(index, neighbor, level);
+    uint32_t  limit = maxLinks(index, level);
+    if (links[0] < limit) {
+        links[++links[0]] = node;
+        return;
+    }
+
+    IndexQuery base = nodeQuery(index, neighbor);
+    uint32_t   count = 0;
+    for (uint32_t i = 1; i <= links[0]; i++) {
+        scratch->sorted[count].node     = links[i];
+        scratch->sorted[count].distance = queryDistance(index, &base, links[i]);
+        count++;
+    }
+    scratch->sorted[count].node     = node;
+    scratch->sorted[count].distance = queryDistance(index, &base, node);
+    count++;
+
+    /* Insertion sort: lists hold at most 2M + 1 entries */
+    for (uint32_t i = 1; i < count; i++) {
+        Candidate item = scratch->sorted[i];
+        uint32_t  j    = i;
+        while (j > 0 && scratch->sorted[j - 1].distance > item.distance) {
+            scratch->sorted[j] = scratch->sorted[j - 1];
+            j--;
+        }
+        scratch->sorted[j] = item;
+    }
+
+    links[0] = selectNeighbors(index, scratch->sorted, count, limit, scratch->selected,
+                               scratch->skipped);
+    for (uint32_t i = 0; i < links[0]; i++) {
+        links[i + 1] = scratch->selected[i].node;
+    }
+}
+
+/* Draw a node's top layer: level l is reached with probability M^-l */
+static int drawLevel(TinyAIVectorIndex *index)
+{
+    /* xorshift64* */
+    uint64_t x = index->header.rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    index->header.rng = x;
+
+    double uniform = (double)((x * 0x2545F4914F6CDD1DULL) >> 11) / 9007199254740992.0;
+    double level   = -log(1.0 - uniform) / log((double)index->header.neighbors);
+    return level < MAX_LEVEL ? (int)level : MAX_LEVEL;
+}
+
+static bool growArray(void **array, size_t size)
+{
+    void *grown = TINYAI_REALLOC(*array, size);
+    if (!grown) {
+        return false;
+    }
+    *array = grown;
+    return true;
+}
+
+/* Make room for one more node with the given number of upper-layer lists */
+static bool reserveNode(TinyAIVectorIndex *index, uint32_t upperLists)
+{
+    IndexHeader *header = &index->header;
+
+    if (header->count == index->capacity) {
+        size_t capacity = index->capacity ? (size_t)index->capacity * 2 : INITIAL_CAPACITY;
+        size_t linkSize = (2 * (size_t)header->neighbors + 1) * sizeof(uint32_t);
+        if (capacity > UINT32_MAX ||
+            !growArray((void **)&index->ids, capacity * sizeof(uint64_t)) ||
+            !growArray((void **)&index->scales, capacity * sizeof(float)) ||
+            !growArray((void **)&index->norms, capacity * sizeof(float)) ||
+            !growArray((void **)&index->levels, capacity * sizeof(uint32_t)) ||
+            !growArray((void **)&index->upperStart, capacity * sizeof(uint32_t)) ||
+            !growArray((void **)&index->vectors, capacity * header->dimension) ||
+            !growArray((void **)&index->links, capacity * linkSize)) {
+            return false;
+        }
+        index->capacity = (uint32_t)capacity;
+    }
+
+    if (header->upperCount + upperLists > index->upperCapacity) {
+        size_t capacity = index->upperCapacity ? (size_t)index->upperCapacity * 2 : 16;
+        while (capacity < (size_t)header->upperCount + upperLists) {
+            capacity *= 2;
+        }
+        size_t listSize = ((size_t)header->neighbors + 1) * sizeof(uint32_t);
+        if (capacity > UINT32_MAX || !growArray((void **)&index->upperLinks, capacity * listSize)) {
+            return false;
+        }
+        index->upperCapacity = (uint32_t)capacity;
+    }
+    return true;
+}
+
+/* Copy a mapped index to the heap so it can grow */
+static bool detachMapping(TinyAIVectorIndex *index)
+{
+    if (!index->mapping) {
+        return true;
+    }
+
+    size_t sizes[8];
+    void **arrays[8];
+    arraySizes(&index->header, sizes);
+    arrayAddresses(index, arrays);
+
+    void *copies[8] = {NULL};
+    bool  ok        = true;
+    for (int i = 0; i < 8 && ok; i++) {
+        copies[i] = TINYAI_MALLOC(sizes[i] ? sizes[i] : 1);
+        ok        = copies[i] != NULL;
+        if (ok) {
+            memcpy(copies[i], *arrays[i], sizes[i]);
+        }
+    }
+    if (!ok) {
+        for (int i = 0; i < 8; i++) {
+            TINYAI_FREE(copies[i]);
+        }
+        return false;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(index->mapping);
+#else
+    munmap(index->mapping, index->mappingSize);
+#endif
+    index->mapping = NULL;
+    for (int i = 0; i < 8; i++) {
+        *arrays[i] = copies[i];
+    }
+    index->capacity      = index->header.count;
+    index->upperCapacity = index->header.upperCount;
+    return true;
+}
+
+/* ----------------- Public API ----------------- */
+
+TinyAIVectorIndex *tinyaiCreateVectorIndex(const TinyAIVectorIndexParams *params)
+{
+    if (!params || params->dimension == 0 || (unsigned)params->metric > TINYAI_VECTOR_DOT ||
+        params->neighbors == 1 || params->neighbors > 128) {
+        return NULL;
+    }
+
+    TinyAIVectorIndex *index = (TinyAIVectorIndex *)TINYAI_MALLOC(sizeof(TinyAIVectorIndex));
+    if (!index) {
+        return NULL;
+    }
+    memset(index, 0, sizeof(TinyAIVectorIndex));
+
+    IndexHeader *header    = &index->header;
+    header->magic          = TINYAI_VECTOR_INDEX_MAGIC;
+    header->version        = TINYAI_VECTOR_INDEX_VERSION;
+    header->dimension      = params->dimension;
+    header->metric         = (uint32_t)params->metric;
+    header->neighbors      = params->neighbors ? params->neighbors : DEFAULT_NEIGHBORS;
+    header->efConstruction = params->efConstruction ? params->efConstruction
+                                                    : DEFAULT_EF_CONSTRUCTION;
+    header->efSearch       = params->efSearch ? params->efSearch : DEFAULT_EF_SEARCH;
+    header->maxLevel       = -1;
+    header->rng            = params->seed ? params->seed : 0x9E3779B97F4A7C15ULL;
+    return index;
+}
+
+void tinyaiDestroyVectorIndex(TinyAIVectorIndex *index)
+{
+    if (!index) {
+        return;
+    }
+
+    if (index->mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(index->mapping);
+#else
+        munmap(index->mapping, index->mappingSize);
+#endif
+    }
+    else {
+        TINYAI_FREE(index->ids);
+        TINYAI_FREE(index->scales);
+        TINYAI_FREE(index->norms);
+        TINYAI_FREE(index->levels);
+        TINYAI_FREE(index->upperStart);
+        TINYAI_FREE(index->vectors);
+        TINYAI_FREE(index->links);
+        TINYAI_FREE(index->upperLinks);
+    }
+    TINYAI_FREE(index);
+}
+
+int tinyaiVectorIndexAdd(TinyAIVectorIndex *index, uint64_t id, const float *vector)
+{
+    if (!index || !vector || index->header.count == UINT32_MAX || !detachMapping(index)) {
+        return -1;
+    }
+
+    IndexHeader *header = &index->header;
+    int          level  = drawLevel(index);
+    if (!reserveNode(index, (uint32_t)level)) {
+        return -1;
+    }
+
+    /* Store the node with empty link lists */
+    uint32_t node   = header->count;
+    float   *floats = (float *)TINYAI_MALLOC(header->dimension * sizeof(float));
+    if (!floats) {
+        return -1;
+    }
+    index->ids[node]   = id;
+    index->norms[node] = quantizeVector(index, vector, floats,
+                                        index->vectors + (size_t)node * header->dimension,
+                                        &index->scales[node]);
+    TINYAI_FREE(floats);
+    index->levels[node]     = (uint32_t)level;
+    index->upperStart[node] = header->upperCount;
+    header->upperCount += (uint32_t)level;
+    for (int l = 0; l <= level; l++) {
+        nodeLinks(index, node, l)[0] = 0;
+    }
+
+    if (header->maxLevel < 0) {
+        header->entryPoint = node;
+        header->maxLevel   = level;
+        header->count++;
+        return 0;
+    }
+
+    SearchScratch scratch;
+    if (!initScratch(&scratch, index, node + 1, header->efConstruction)) {
+        freeScratch(&scratch);
+        return -1;
+    }
+
+    /* Descend to the node's top layer, then link it on every layer from there down */
+    IndexQuery query   = nodeQuery(index, node);
+    Candidate  current = {queryDistance(index, &query, header->entryPoint), header->entryPoint};
+    for (int l = header->maxLevel; l > level; l--) {
+        current = greedyClosest(index, &query, current, l);
+    }
+
+    int result = 0;
+    for (int l = level < header->maxLevel ? level : header->maxLevel; l >= 0; l--) {
+        int found = searchLayer(index, &query, current, header->efConstruction, l, &scratch);
+        if (found <= 0) {
+            result = -1;
+            break;
+        }
+        current = scratch.sorted[0];
+
+        /* Linking back re-selects neighbors in the scratch, so keep the new links aside */
+        uint32_t *links  = nodeLinks(index, node, l);
+        uint32_t  chosen = selectNeighbors(index, scratch.sorted, (uint32_t)found,
+                                           header->neighbors, scratch.neighbors, scratch.skipped);
+        links[0]         = chosen;
+        for (uint32_t i = 0; i < chosen; i++) {
+            links[i + 1] = scratch.neighbors[i].node;
+        }
+        for (uint32_t i = 0; i < chosen; i++) {
+            linkBack(index, scratch.neighbors[i].node, node, l, &scratch);
+        }
+    }
+    freeScratch(&scratch);
+    if (result != 0) {
+        header->upperCount -= (uint32_t)level;
+        return -1;
+    }
+
+    if (level > header->maxLevel) {
+        header->entryPoint = node;
+        header->maxLevel   = level;
+    }
+    header->count++;
+    return 0;
+}
+
+int tinyaiVectorIndexAddBatch(TinyAIVectorIndex *index, const uint64_t *ids,
+                              const float *vectors, uint32_t count)
+{
+    if (!index || !ids || !vectors) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (tinyaiVectorIndexAdd(index, ids[i], vectors + (size_t)i * index->header.dimension) !=
+            0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int tinyaiVectorIndexSearch(const TinyAIVectorIndex *index, const float *query, uint32_t k,
+                            uint32_t ef, TinyAIVectorMatch *matches)
+{
+    if (!index || !query || !matches || k == 0) {
+        return -1;
+    }
+
+    const IndexHeader *header = &index->header;
+    if (header->count == 0) {
+        return 0;
+    }
+    ef = ef ? ef : header->efSearch;
+    ef = ef < k ? k : ef;
+
+    float  *floats = (float *)TINYAI_MALLOC(header->dimension * sizeof(float));
+    int8_t *bytes  = (int8_t *)TINYAI_MALLOC(header->dimension);
+    SearchScratch scratch;
+    bool          ok = floats && bytes && initScratch(&scratch, index, header->count, ef);
+    int           found = -1;
+    if (ok) {
+        IndexQuery quantized;
+        quantized.bytes = bytes;
+        quantized.norm  = quantizeVector(index, query, floats, bytes, &quantized.scale);
+
+        Candidate current = {queryDistance(index, &quantized, header->entryPoint),
+                             header->entryPoint};
+        for (int l = header->maxLevel; l > 0; l--) {
+            current = greedyClosest(index, &quantized, current, l);
+        }
+
+        found = searchLayer(index, &quantized, current, ef, 0, &scratch);
+        found = found < (int)k ? found : (int)k;
+        for (int i = 0; i < found; i++) {
+            matches[i].id       = index->ids[scratch.sorted[i].node];
+            matches[i].distance = scratch.sorted[i].distance;
+        }
+    }
+
+    if (floats && bytes) {
+        freeScratch(&scratch);
+    }
+    TINYAI_FREE(floats);
+    TINYAI_FREE(bytes);
+    return found;
+}
+
+uint32_t tinyaiVectorIndexSize(const TinyAIVectorIndex *index)
+{
+    return index ? index->header.count : 0;
+}
+
+int tinyaiSaveVectorIndex(const TinyAIVectorIndex *index, const char *path)
+{
+    if (!index || !path) {
+        return -1;
+    }
+
+    /* Written through a temporary file, so processes mapping the old index keep it intact */
+    char tempPath[4096];
+    if (snprintf(tempPath, sizeof(tempPath), "%s.tmp", path) >= (int)sizeof(tempPath)) {
+        return -1;
+    }
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    size_t sizes[8];
+    void **arrays[8];
+    arraySizes(&index->header, sizes);
+    arrayAddresses((TinyAIVectorIndex *)index, arrays);
+
+    static const uint8_t padding[TINYAI_VECTOR_INDEX_ALIGNMENT] = {0};
+    size_t               offset = sizeof(IndexHeader);
+    bool                 ok     = fwrite(&index->header, sizeof(IndexHeader), 1, file) == 1;
+    for (int i = 0; i < 8 && ok; i++) {
+        size_t start = alignOffset(offset);
+        ok           = fwrite(padding, 1, start - offset, file) == start - offset &&
+             fwrite(*arrays[i], 1, sizes[i], file) == sizes[i];
+        offset = start + sizes[i];
+    }
+    ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (!ok || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return -1;
+    }
+    return 0;
+}
+
+TinyAIVectorIndex *tinyaiLoadVectorIndex(const char *path)
+{
+    if (!path) {
+        return NULL;
+    }
+
+    void  *data = NULL;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        size           = (size_t)fileSize.QuadPart;
+        HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(file, &st) == 0 && st.st_size > 0) {
+        size = (size_t)st.st_size;
+        data = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+    close(file);
+#endif
+    if (!data) {
+        return NULL;
+    }
+
+    TinyAIVectorIndex *index = (TinyAIVectorIndex *)TINYAI_MALLOC(sizeof(TinyAIVectorIndex));
+    if (!index) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(data, size);
+#endif
+        return NULL;
+    }
+    memset(index, 0, sizeof(TinyAIVectorIndex));
+    index->mapping     = data;
+    index->mappingSize = size;
+
+    /* Check the header, then that every array fits the file */
+    IndexHeader *header = &index->header;
+    bool         ok     = size >= sizeof(IndexHeader);
+    if (ok) {
+        memcpy(header, data, sizeof(IndexHeader));
+        ok = header->magic == TINYAI_VECTOR_INDEX_MAGIC &&
+             header->version == TINYAI_VECTOR_INDEX_VERSION && header->dimension > 0 &&
+             header->metric <= TINYAI_VECTOR_DOT && header->neighbors > 1 &&
+             header->neighbors <= 128 && header->maxLevel <= MAX_LEVEL &&
+             (header->count == 0 ? header->maxLevel == -1
+                                 : header->maxLevel >= 0 && header->entryPoint < header->count);
+    }
+
+    size_t sizes[8];
+    void **arrays[8];
+    size_t offset = sizeof(IndexHeader);
+    arraySizes(header, sizes);
+    arrayAddresses(index, arrays);
+    for (int i = 0; i < 8 && ok; i++) {
+        offset     = alignOffset(offset);
+        ok         = offset <= size && sizes[i] <= size - offset;
+        *arrays[i] = (uint8_t *)data + offset;
+        offset += sizes[i];
+    }
+
+    /* Upper-layer lists and links must stay inside the index */
+    uint64_t upperLists = 0;
+    for (uint32_t node = 0; ok && node < header->count; node++) {
+        ok = index->levels[node] <= MAX_LEVEL &&
+             (uint64_t)index->upperStart[node] + index->levels[node] <= header->upperCount;
+        upperLists += index->levels[node];
+        for (int l = 0; ok && l <= (int)index->levels[node]; l++) {
+            const uint32_t *links = nodeLinks(index, node, l);
+            ok                    = links[0] <= maxLinks(index, l);
+            for (uint32_t i = 1; ok && i <= links[0]; i++) {
+                ok = links[i] < header->count && index->levels[links[i]] >= (uint32_t)l;
+            }
+        }
+    }
+    ok = ok && upperLists == header->upperCount &&
+         (header->count == 0 || index->levels[header->entryPoint] == (uint32_t)header->maxLevel);
+
+    if (!ok) {
+        tinyaiDestroyVectorIndex(index);
+        return NULL;
+    }
+    index->capacity      = header->count;
+    index->upperCapacity = header->upperCount;
+    return index;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file vector_index.h
+ * @brief Approximate nearest-neighbor index over int8 embeddings
+ *
+ * A hierarchical navigable small world (HNSW) graph for semantic search over
+ * text embeddings (tinyaiEmbedTextBatch) or image features. Vectors are
+ * stored as int8 with one scale each (tinyaiSimdQuantizeInt8), a quarter of
+ * their float size, and compared with integer SIMD dot products; queries
+ * are quantized the same way. Each node keeps up to 2M links on the bottom
+ * layer and M on the sparser layers above, so a search descends greedily
+ * from the top layer and visits a few hundred nodes instead of all of them.
+ *
+ * Vectors are inserted one at a time, and the index can grow while it is
+ * searched between inserts. Searches may run concurrently with each other
+ * but not with inserts. A saved index is laid out as it is held in memory,
+ * so loading maps the file instead of reading it: processes searching the
+ * same index share its pages, and the first insert copies it to the heap.
+ */
+
+#ifndef TINYAI_VECTOR_INDEX_H
+#define TINYAI_VECTOR_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Index file format
+ *
+ * A little-endian header (magic, version, parameters, counts), then the ids,
+ * scales, squared norms, levels, upper-layer list starts, int8 vectors,
+ * bottom-layer links and upper-layer links, each array starting on a
+ * TINYAI_VECTOR_INDEX_ALIGNMENT boundary.
+ */
+#define TINYAI_VECTOR_INDEX_MAGIC 0x58444956 /* "VIDX" in ASCII */
+#define TINYAI_VECTOR_INDEX_VERSION 1
+#define TINYAI_VECTOR_INDEX_ALIGNMENT 64
+
+/**
+ * Distance between vectors; smaller is closer
+ */
+typedef enum {
+    TINYAI_VECTOR_COSINE = 0, /* 1 - cosine similarity (vectors normalized on insert) */
+    TINYAI_VECTOR_L2,         /* Squared Euclidean distance */
+    TINYAI_VECTOR_DOT         /* Negative dot product */
+} TinyAIVectorMetric;
+
+/**
+ * Index parameters
+ */
+typedef struct {
+    uint32_t           dimension;      /* Floats per vector */
+    TinyAIVectorMetric metric;         /* Distance searched by */
+    uint32_t           neighbors;      /* M, links per node above the bottom layer (0 = 16) */
+    uint32_t           efConstruction; /* Candidates kept while linking an insert (0 = 100) */
+    uint32_t           efSearch;       /* Candidates kept by searches by default (0 = 64) */
+    uint64_t           seed;           /* Seed of the layer draws */
+} TinyAIVectorIndexParams;
+
+/**
+ * One search result
+ */
+typedef struct {
+    uint64_t id;       /* Id given on insert */
+    float    distance; /* Distance to the query under the index's metric */
+} TinyAIVectorMatch;
+
+/**
+ * Vector index (opaque)
+ */
+typedef struct TinyAIVectorIndex TinyAIVectorIndex;
+
+/**
+ * Create an empty vector index
+ *
+ * @param params Index parameters
+ * @return New index or NULL on error
+ */
+TinyAIVectorIndex *tinyaiCreateVectorIndex(const TinyAIVectorIndexParams *params);
+
+/**
+ * Free a vector index, unmapping it if it was loaded
+ *
+ * @param index Index to free
+ */
+void tinyaiDestroyVectorIndex(TinyAIVectorIndex *index);
+
+/**
+ * Insert a vector
+ *
+ * The vector is quantized to int8 and linked into the graph right away, so
+ * the next search can find it. Ids are the caller's and need not be unique.
+ *
+ * @param index Index to modify
+ * @param id Id returned by searches that find the vector
+ * @param vector Vector of the index's dimension
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiVectorIndexAdd(TinyAIVectorIndex *index, uint64_t id, const float *vector);
+
+/**
+ * Insert a batch of vectors, in order
+ *
+ * @param index Index to modify
+ * @param ids Id of each vector
+ * @param vectors Vectors [count x dimension]
+ * @param count Number of vectors
+ * @return 0 on success, non-zero on error (vectors before the failing one stay inserted)
+ */
+int tinyaiVectorIndexAddBatch(TinyAIVectorIndex *index, const uint64_t *ids,
+                              const float *vectors, uint32_t count);
+
+/**
+ * Find the approximate nearest neighbors of a query
+ *
+ * @param index Index to search
+ * @param query Vector of the index's dimension
+ * @param k Most matches to return
+ * @param ef Candidates kept while searching, raised to k if lower (0 = the index's efSearch);
+ *           more candidates find more of the true neighbors at a higher cost
+ * @param matches Output matches, closest first (k entries)
+ * @return Number of matches, or -1 on error
+ */
+int tinyaiVectorIndexSearch(const TinyAIVectorIndex *index, const float *query, uint32_t k,
+                            uint32_t ef, TinyAIVectorMatch *matches);
+
+/**
+ * Get the number of vectors in an index
+ *
+ * @param index Index to query
+ * @return Number of vectors (0 for NULL)
+ */
+uint32_t tinyaiVectorIndexSize(const TinyAIVectorIndex *index);
+
+/**
+ * Write an index to a file
+ *
+ * @param index Index to save
+ * @param path Output path
+ * @return 0 on success, non-zero on error
+ */
+int tinyaiSaveVectorIndex(const TinyAIVectorIndex *index, const char *path);
+
+/**
+ * Map an index saved by tinyaiSaveVectorIndex
+ *
+ * The index reads the file's pages in place; they are shared with every
+ * other process mapping the same file. The first insert copies the index
+ * to the heap, and the file is never written.
+ *
+ * @param path Index file
+ * @return Loaded index or NULL on error (missing, truncated or corrupt file)
+ */
+TinyAIVectorIndex *tinyaiLoadVectorIndex(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TINYAI_VECTOR_INDEX_H */